@@ -42,7 +42,12 @@
 #include <boost/program_options.hpp>
 #include <boost/version.hpp>
 #include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <unordered_set>
 namespace po = boost::program_options;
 
@@ -50,6 +55,8 @@ namespace po = boost::program_options;
 #include "btreeRamCloud/Btree.h"
 #include "ClientLeaseAgent.h"
 #include "IndexLookup.h"
+#include "LatencyHistogram.h"
+#include "ObjectFinder.h"
 #include "TimeTrace.h"
 #include "Transaction.h"
 #include "Util.h"
@@ -143,6 +150,20 @@ int spannedOps = 0;
 // For doWorkload-based experiments tells how long to run before exiting.
 int seconds = 10;
 
+// For readOpenLoop and writeOpenLoop: the number of load levels to
+// measure, spread evenly up to --targetOps per client.
+static int loadLevels = 10;
+
+// For ycsb: the number of requests each client keeps outstanding.
+static int pipelineDepth = 16;
+
+// For traceReplay: the trace file to replay.
+static string traceFile;     // NOLINT
+
+// For traceReplay: the trace is replayed this many times faster than it
+// was captured.
+static double traceSpeedup = 1.0;
+
 // If true print alternate sample format that includes the timestamp
 // for each sample along with its duration.
 bool fullSamples = false;
@@ -1823,6 +1844,70 @@ getMetrics(ClientMetrics& metrics, int clientCount)
     }
 }
 
+/**
+ * Clients invoke this method to return a latency distribution to the
+ * master, which collects it with getHistogram.
+ *
+ * \param name
+ *      Identifies the histogram; the master must use the same name.
+ * \param histogram
+ *      The distribution to return.
+ */
+void
+sendHistogram(const char* name, const LatencyHistogram& histogram)
+{
+    Buffer buffer;
+    histogram.serialize(&buffer);
+    string key = keyVal(clientIndex, name);
+    cluster->write(controlTable, key.c_str(), downCast<uint16_t>(key.length()),
+            buffer.getRange(0, buffer.size()), buffer.size());
+}
+
+/**
+ * Masters invoke this method to add up the latency distributions that
+ * clients returned with sendHistogram. This method waits for clients to
+ * return their histograms, if they haven't already.
+ *
+ * \param name
+ *      Identifies the histogram (the name passed to sendHistogram).
+ * \param clientCount
+ *      Histograms will be read from this many clients, starting at 0.
+ * \param[out] total
+ *      The clients' histograms are merged into this one.
+ */
+void
+getHistogram(const char* name, int clientCount, LatencyHistogram* total)
+{
+    for (int client = 0; client < clientCount; client++) {
+        Buffer buffer;
+        string key = keyVal(client, name);
+        waitForObject(controlTable, key.c_str(),
+                downCast<uint16_t>(key.length()), NULL, buffer);
+        LatencyHistogram histogram;
+        uint32_t offset = 0;
+        if (!histogram.deserialize(&buffer, &offset)) {
+            throw Exception(HERE, format("malformed histogram %s from "
+                    "client %d", name, client));
+        }
+        total->merge(histogram);
+    }
+}
+
+/**
+ * Given a latency distribution in nanoseconds, return one of its
+ * percentiles in microseconds.
+ *
+ * \param histogram
+ *      The distribution.
+ * \param fraction
+ *      Which percentile to return, such as 0.99.
+ */
+double
+percentileMicros(const LatencyHistogram& histogram, double fraction)
+{
+    return 1e-03 * static_cast<double>(histogram.getPercentile(fraction));
+}
+
 /**
  * Obtain a list of available servers in the cluster from the coordinator.
  *
@@ -4995,6 +5080,860 @@ doWorkload(OpType type)
     sendCommand(NULL, "done", 1, numClients-1);
 }
 
+// The following structures and functions are used by traceReplay.
+
+// One request from a trace file.
+struct TraceRequest {
+    enum Op { READ, WRITE, REMOVE, NUM_OPS };
+
+    TraceRequest()
+        : time(0)
+        , offsetNs(0)
+        , op(READ)
+        , table(0)
+        , key()
+        , valueLength(0)
+    {}
+
+    // Time at which the request was issued in the original workload, in
+    // microseconds (the origin is arbitrary until loadTrace finishes).
+    double time;
+
+    // When to issue the request, in nanoseconds after the replay starts
+    // (filled in by loadTrace, after scaling by --traceSpeedup).
+    uint64_t offsetNs;
+
+    // The operation to perform.
+    Op op;
+
+    // Index of the request's table in the tableNames list returned by
+    // loadTrace.
+    uint32_t table;
+
+    // The object's key.
+    string key;
+
+    // For writes, the number of bytes in the new value.
+    uint32_t valueLength;
+};
+
+// The requests of one of the original clients (a "stream" in the trace),
+// in the order they were issued, along with the state of the one that is
+// currently being replayed. Requests from a stream are replayed one at a
+// time, so the replay has the same concurrency as the original workload.
+struct TraceStream {
+    TraceStream()
+        : requests()
+        , next(0)
+        , issueTime(0)
+        , readRpc()
+        , writeRpc()
+        , removeRpc()
+        , value()
+    {}
+
+    std::vector<TraceRequest> requests;
+
+    // Index in requests of the next request to issue (or of the one that
+    // is outstanding).
+    size_t next;
+
+    // Time (in Cycles::rdtsc ticks) when the outstanding request was
+    // issued, or 0 if no request is outstanding.
+    uint64_t issueTime;
+
+    // Exactly one of these is constructed while a request is outstanding.
+    Tub<ReadRpc> readRpc;
+    Tub<WriteRpc> writeRpc;
+    Tub<RemoveRpc> removeRpc;
+
+    // Holds the value returned by reads.
+    Buffer value;
+
+    DISALLOW_COPY_AND_ASSIGN(TraceStream);
+};
+
+// What each client measures while replaying its part of a trace; each
+// client returns this to client 0 with sendTraceResults.
+struct TraceResults {
+    TraceResults()
+        : elapsedSeconds(0)
+        , errors(0)
+        , latency()
+        , lag()
+    {}
+
+    // Time from the start of the replay until the last request completed.
+    double elapsedSeconds;
+
+    // Number of requests that failed with an exception (other than reads
+    // and removes of objects that didn't exist).
+    uint64_t errors;
+
+    // For each TraceRequest::Op, the time from issuing each request until
+    // it completed, in nanoseconds.
+    LatencyHistogram latency[TraceRequest::NUM_OPS];
+
+    // How far behind its original schedule each request was issued, in
+    // nanoseconds: this grows if the cluster can't keep up with the trace,
+    // since a stream can't issue a request until the previous one returns.
+    LatencyHistogram lag;
+};
+
+/**
+ * Read a trace for traceReplay. Each line of the file describes one
+ * request, in the form
+ *
+ *     <time> <stream> <op> <table> <key> [<valueLength>]
+ *
+ * where <time> is when the request was issued, in microseconds from any
+ * origin (lines needn't be sorted); <stream> is an integer identifying the
+ * client (or connection) that issued it; <op> is "read", "write" or
+ * "remove"; <table> is the name of a table; <key> is the object's key,
+ * which must not contain white space; and <valueLength> is the number of
+ * bytes written (writes only). Empty lines and lines starting with "#"
+ * are ignored.
+ *
+ * \param fileName
+ *      Name of the trace file; it must be accessible on every client.
+ * \param[out] streams
+ *      Filled in with the requests of the streams that this client should
+ *      replay (stream s is replayed by client s % numClients).
+ * \param[out] tableNames
+ *      Filled in with the names of all of the tables in the trace.
+ * \param[out] populate
+ *      If non-NULL, filled in with the objects in the trace that are read
+ *      or removed before being written (as <table index, key>), so they
+ *      can be created before the replay starts.
+ * \return
+ *      The duration of the trace, in seconds (after scaling by
+ *      --traceSpeedup).
+ */
+double
+loadTrace(const string& fileName, std::map<uint32_t, TraceStream>* streams,
+        std::vector<string>* tableNames,
+        std::set<std::pair<uint32_t, string>>* populate)
+{
+    std::ifstream file(fileName.c_str());
+    if (!file) {
+        throw Exception(HERE, format("couldn't open trace file '%s'",
+                fileName.c_str()));
+    }
+
+    std::map<string, uint32_t> tables;
+    std::map<std::pair<uint32_t, string>, std::pair<double, bool>> firstUse;
+    double first = 0, last = 0;
+    bool empty = true;
+    string line;
+    for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+        if (line.empty() || (line[0] == '#')) {
+            continue;
+        }
+        std::istringstream fields(line);
+        TraceRequest request;
+        uint32_t stream;
+        string op, table;
+        if (!(fields >> request.time >> stream >> op >> table >>
+                request.key)) {
+            throw Exception(HERE, format("%s:%d: malformed request",
+                    fileName.c_str(), lineNumber));
+        }
+        if (op == "read") {
+            request.op = TraceRequest::READ;
+        } else if (op == "write") {
+            request.op = TraceRequest::WRITE;
+            if (!(fields >> request.valueLength)) {
+                throw Exception(HERE, format("%s:%d: write has no value "
+                        "length", fileName.c_str(), lineNumber));
+            }
+        } else if (op == "remove") {
+            request.op = TraceRequest::REMOVE;
+        } else {
+            throw Exception(HERE, format("%s:%d: unknown operation '%s'",
+                    fileName.c_str(), lineNumber, op.c_str()));
+        }
+        if (tables.find(table) == tables.end()) {
+            tables[table] = downCast<uint32_t>(tableNames->size());
+            tableNames->push_back(table);
+        }
+        request.table = tables[table];
+
+        if (empty || (request.time < first)) {
+            first = request.time;
+        }
+        if (empty || (request.time > last)) {
+            last = request.time;
+        }
+        empty = false;
+        if (populate != NULL) {
+            std::pair<uint32_t, string> object(request.table, request.key);
+            auto use = firstUse.find(object);
+            if ((use == firstUse.end()) ||
+                    (request.time < use->second.first)) {
+                firstUse[object] = std::make_pair(request.time,
+                        request.op == TraceRequest::WRITE);
+            }
+        }
+        if ((stream % numClients) == static_cast<uint32_t>(clientIndex)) {
+            (*streams)[stream].requests.push_back(request);
+        }
+    }
+
+    foreach (auto& entry, firstUse) {
+        if (!entry.second.second) {
+            populate->insert(entry.first);
+        }
+    }
+    for (auto& entry : *streams) {
+        std::vector<TraceRequest>& requests = entry.second.requests;
+        std::stable_sort(requests.begin(), requests.end(),
+                [](const TraceRequest& a, const TraceRequest& b) {
+                    return a.time < b.time;
+                });
+        foreach (TraceRequest& request, requests) {
+            request.offsetNs = static_cast<uint64_t>(
+                    (request.time - first) * 1e03 / traceSpeedup);
+        }
+    }
+    return (last - first) * 1e-06 / traceSpeedup;
+}
+
+/**
+ * Replay the requests of a collection of trace streams, each at its
+ * original time (relative to the start of the replay) or as soon as the
+ * stream's previous request completes, whichever is later.
+ *
+ * \param streams
+ *      The streams to replay.
+ * \param tableIds
+ *      Identifier for each of the trace's tables.
+ * \param[out] results
+ *      The latency of each request and how late it was issued are
+ *      recorded here.
+ */
+void
+replayStreams(std::map<uint32_t, TraceStream>* streams,
+        std::vector<uint64_t>& tableIds, TraceResults* results)
+{
+    string value;
+    size_t active = streams->size();
+    uint64_t start = Cycles::rdtsc();
+    uint64_t now = start;
+    while (active > 0) {
+        cluster->clientContext->dispatch->poll();
+        now = Cycles::rdtsc();
+        for (auto& entry : *streams) {
+            TraceStream& stream = entry.second;
+            if (stream.next >= stream.requests.size()) {
+                continue;
+            }
+            TraceRequest& request = stream.requests[stream.next];
+
+            if (stream.issueTime != 0) {
+                // A request is outstanding; see if it has finished.
+                try {
+                    if (stream.readRpc) {
+                        if (!stream.readRpc->isReady())
+                            continue;
+                        stream.readRpc->wait();
+                    } else if (stream.writeRpc) {
+                        if (!stream.writeRpc->isReady())
+                            continue;
+                        stream.writeRpc->wait();
+                    } else {
+                        if (!stream.removeRpc->isReady())
+                            continue;
+                        stream.removeRpc->wait();
+                    }
+                } catch (ObjectDoesntExistException& e) {
+                    // The trace may well read objects that don't exist.
+                } catch (ClientException& e) {
+                    results->errors++;
+                }
+                now = Cycles::rdtsc();
+                results->latency[request.op].record(
+                        Cycles::toNanoseconds(now - stream.issueTime));
+                stream.readRpc.destroy();
+                stream.writeRpc.destroy();
+                stream.removeRpc.destroy();
+                stream.issueTime = 0;
+                stream.next++;
+                if (stream.next >= stream.requests.size()) {
+                    active--;
+                    continue;
+                }
+            }
+
+            // Issue the stream's next request if its time has come.
+            TraceRequest& nextRequest = stream.requests[stream.next];
+            uint64_t scheduled = start +
+                    Cycles::fromNanoseconds(nextRequest.offsetNs);
+            if (now < scheduled) {
+                continue;
+            }
+            results->lag.record(Cycles::toNanoseconds(now - scheduled));
+            uint64_t tableId = tableIds[nextRequest.table];
+            const char* key = nextRequest.key.c_str();
+            uint16_t keyLength = downCast<uint16_t>(nextRequest.key.size());
+            stream.issueTime = now;
+            if (nextRequest.op == TraceRequest::READ) {
+                stream.readRpc.construct(cluster, tableId, key, keyLength,
+                        &stream.value);
+            } else if (nextRequest.op == TraceRequest::WRITE) {
+                if (value.size() < nextRequest.valueLength) {
+                    value.resize(nextRequest.valueLength, 'x');
+                }
+                stream.writeRpc.construct(cluster, tableId, key, keyLength,
+                        value.data(), nextRequest.valueLength);
+            } else {
+                stream.removeRpc.construct(cluster, tableId, key, keyLength);
+            }
+        }
+    }
+    results->elapsedSeconds = Cycles::toSeconds(now - start);
+}
+
+/**
+ * Return the results of a client's part of a trace replay to the master.
+ *
+ * \param results
+ *      What the client measured.
+ */
+void
+sendTraceResults(const TraceResults& results)
+{
+    sendMetrics(results.elapsedSeconds, static_cast<double>(results.errors));
+    for (int op = 0; op < TraceRequest::NUM_OPS; op++) {
+        sendHistogram(format("traceLatency%d", op).c_str(),
+                results.latency[op]);
+    }
+    sendHistogram("traceLag", results.lag);
+}
+
+// Replays a captured request trace (given by --traceFile; see loadTrace
+// for its format) with its original timing and concurrency, spreading the
+// trace's streams across all of the clients, and reports the throughput
+// and latency percentiles for each kind of request.
+void
+traceReplay()
+{
+    if (traceFile.empty()) {
+        printf("traceReplay needs a trace; use --traceFile\n");
+        return;
+    }
+    std::map<uint32_t, TraceStream> streams;
+    std::vector<string> tableNames;
+    std::set<std::pair<uint32_t, string>> populate;
+    double duration = loadTrace(traceFile, &streams, &tableNames,
+            (clientIndex == 0) ? &populate : NULL);
+
+    if (clientIndex > 0) {
+        setSlaveState("ready");
+        char command[20];
+        getCommand(command, sizeof(command));
+        if (strcmp(command, "run") != 0) {
+            RAMCLOUD_LOG(ERROR, "unknown command %s", command);
+            return;
+        }
+        std::vector<uint64_t> tableIds;
+        foreach (string& name, tableNames) {
+            tableIds.push_back(cluster->getTableId(name.c_str()));
+        }
+        setSlaveState("running");
+        TraceResults results;
+        replayStreams(&streams, tableIds, &results);
+        sendTraceResults(results);
+        setSlaveState("done");
+        return;
+    }
+
+    // This is the master client: create the trace's tables and the objects
+    // it reads before writing them, then start everyone.
+    std::vector<uint64_t> tableIds;
+    foreach (string& name, tableNames) {
+        tableIds.push_back(cluster->createTable(name.c_str()));
+    }
+    string value(objectSize, 'x');
+    foreach (auto& object, populate) {
+        cluster->write(tableIds[object.first], object.second.c_str(),
+                downCast<uint16_t>(object.second.size()), value.data(),
+                downCast<uint32_t>(value.size()));
+    }
+    for (int slave = 1; slave < numClients; slave++) {
+        waitSlave(slave, "ready", 600.0);
+    }
+    sendCommand("run", "running", 1, numClients-1);
+    TraceResults clientResults;
+    replayStreams(&streams, tableIds, &clientResults);
+    sendTraceResults(clientResults);
+    for (int slave = 1; slave < numClients; slave++) {
+        waitSlave(slave, "done", duration + 600.0);
+    }
+
+    // Add up everyone's results.
+    TraceResults results;
+    ClientMetrics metrics;
+    getMetrics(metrics, numClients);
+    results.elapsedSeconds = max(metrics[0]);
+    results.errors = static_cast<uint64_t>(sum(metrics[1]));
+    for (int op = 0; op < TraceRequest::NUM_OPS; op++) {
+        getHistogram(format("traceLatency%d", op).c_str(), numClients,
+                &results.latency[op]);
+    }
+    getHistogram("traceLag", numClients, &results.lag);
+    foreach (string& name, tableNames) {
+        cluster->dropTable(name.c_str());
+    }
+
+    static const char* opNames[] = {"read", "write", "remove"};
+    uint64_t total = 0;
+    for (int op = 0; op < TraceRequest::NUM_OPS; op++) {
+        total += results.latency[op].getCount();
+    }
+    printf("# RAMCloud replay of trace %s by %d clients (speedup %.2f).\n",
+            traceFile.c_str(), numClients, traceSpeedup);
+    printf("# All times are in microseconds. \"lag\" is how far behind its\n"
+            "# original time each request was issued.\n");
+    printf("# Generated by 'clusterperf.py traceReplay'\n");
+    printf("#\n");
+    printf("# trace length %.1f s, replay %.1f s, %.1f kOps/s, "
+            "%lu errors\n", duration, results.elapsedSeconds,
+            static_cast<double>(total) * 1e-03 / results.elapsedSeconds,
+            results.errors);
+    printf("#\n");
+    printf("#     op      count   median      90%%      99%%    99.9%%"
+            "      max\n");
+    printf("#----------------------------------------------------------"
+            "------\n");
+    for (int op = 0; op <= TraceRequest::NUM_OPS; op++) {
+        LatencyHistogram& histogram = (op < TraceRequest::NUM_OPS)
+                ? results.latency[op] : results.lag;
+        if (histogram.getCount() == 0) {
+            continue;
+        }
+        printf("%8s %10lu %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+                (op < TraceRequest::NUM_OPS) ? opNames[op] : "lag",
+                histogram.getCount(),
+                percentileMicros(histogram, 0.5),
+                percentileMicros(histogram, 0.9),
+                percentileMicros(histogram, 0.99),
+                percentileMicros(histogram, 0.999),
+                percentileMicros(histogram, 1.0));
+    }
+}
+
+// The following definitions implement the ycsb benchmark: a driver for the
+// YCSB core workloads A-F that runs natively on the C++ client instead of
+// through YCSB's Java client, so that its numbers reflect RAMCloud rather
+// than JNI and threads. Each client keeps --pipelineDepth requests
+// outstanding with asynchronous RPCs.
+
+/**
+ * The operation mix and request distribution of one YCSB core workload
+ * (see workloads/workload[a-f] in the YCSB distribution).
+ */
+struct YcsbWorkload {
+    const char* name;
+    int percent[5];         // Percentage of each YcsbOp.
+    bool latest;            // Requests favor the most recently inserted
+                            // records, rather than being zipfian over all
+                            // of them.
+};
+
+enum YcsbOp { YCSB_READ, YCSB_UPDATE, YCSB_INSERT, YCSB_SCAN,
+              YCSB_READ_MODIFY_WRITE, YCSB_NUM_OPS };
+
+static const YcsbWorkload ycsbWorkloads[] = {
+    //                read update insert scan rmw
+    {"YCSB-A",        {50,  50,    0,     0,   0}, false},
+    {"YCSB-B",        {95,  5,     0,     0,   0}, false},
+    {"YCSB-C",        {100, 0,     0,     0,   0}, false},
+    {"YCSB-D",        {95,  0,     5,     0,   0}, true},
+    {"YCSB-E",        {0,   0,     5,     95,  0}, false},
+    {"YCSB-F",        {50,  0,     0,     0,   50}, false},
+};
+
+// A scan in workload E reads between 1 and this many records, uniformly.
+// RAMCloud can't enumerate keys in order, so a scan is a multiRead of
+// consecutive record numbers.
+#define YCSB_MAX_SCAN_LENGTH 100
+
+/**
+ * Return the key of a YCSB record. As in YCSB, record numbers are hashed
+ * so that popular records (the low numbers) are scattered over all of the
+ * table's tablets.
+ */
+static string
+ycsbKey(uint64_t recordNumber)
+{
+    // 64-bit FNV-1a, as in YCSB's Utils.FNVhash64.
+    uint64_t hash = 0xcbf29ce484222325UL;
+    for (int i = 0; i < 8; i++) {
+        hash ^= recordNumber & 0xff;
+        hash *= 1099511628211UL;
+        recordNumber >>= 8;
+    }
+    return format("user%lu", hash);
+}
+
+/**
+ * One outstanding ycsb request.
+ */
+struct YcsbSlot {
+    YcsbSlot()
+        : op(YCSB_READ)
+        , startTime(0)
+        , key()
+        , readRpc()
+        , writeRpc()
+        , scan()
+        , value()
+        , scanKeys()
+        , scanValues()
+        , scanObjects()
+        , scanRequests()
+    {}
+
+    YcsbOp op;
+    uint64_t startTime;         // When the request was issued; 0 means
+                                // the slot is free.
+    string key;
+    Tub<ReadRpc> readRpc;
+    Tub<WriteRpc> writeRpc;
+    Tub<MultiRead> scan;
+    Buffer value;
+    std::vector<string> scanKeys;
+    Tub<ObjectBuffer> scanValues[YCSB_MAX_SCAN_LENGTH];
+    std::vector<MultiReadObject> scanObjects;
+    MultiReadObject* scanRequests[YCSB_MAX_SCAN_LENGTH];
+
+    DISALLOW_COPY_AND_ASSIGN(YcsbSlot);
+};
+
+/**
+ * What one client measured while running a ycsb workload.
+ */
+struct YcsbResults {
+    YcsbResults()
+        : elapsedSeconds(0)
+        , errors(0)
+        , notFound(0)
+        , latency()
+    {}
+
+    // Time from the start of the run until the last request completed.
+    double elapsedSeconds;
+
+    // Requests that failed with an exception.
+    uint64_t errors;
+
+    // Records that were read (or scanned) but didn't exist; with several
+    // clients inserting, a "latest" read may get ahead of an insert.
+    uint64_t notFound;
+
+    // For each YcsbOp, the time from issuing each request until it
+    // completed, in nanoseconds.
+    LatencyHistogram latency[YCSB_NUM_OPS];
+};
+
+/**
+ * Load this client's share of the records of a ycsb table, in multiWrite
+ * batches.
+ *
+ * \param recordCount
+ *      Number of records in the table; this client loads record numbers
+ *      equal to its index modulo the number of clients.
+ */
+static void
+loadYcsb(uint64_t recordCount)
+{
+    const uint32_t batchSize = 100;
+    string value(objectSize, 'x');
+    std::vector<string> keys;
+    std::vector<MultiWriteObject> objects;
+    std::vector<MultiWriteObject*> requests;
+    for (uint64_t i = clientIndex; i < recordCount; i += numClients) {
+        keys.push_back(ycsbKey(i));
+        if (keys.size() == batchSize || i + numClients >= recordCount) {
+            objects.clear();
+            requests.clear();
+            objects.reserve(keys.size());
+            foreach (string& key, keys) {
+                objects.emplace_back(dataTable, key.data(),
+                        downCast<uint16_t>(key.size()), value.data(),
+                        downCast<uint32_t>(value.size()));
+                requests.push_back(&objects.back());
+            }
+            cluster->multiWrite(requests.data(),
+                    downCast<uint32_t>(requests.size()));
+            keys.clear();
+        }
+    }
+}
+
+/**
+ * Run a ycsb workload on this client: keep pipelineDepth requests
+ * outstanding until the given time has passed.
+ *
+ * \param workload
+ *      Operation mix and distribution.
+ * \param recordCount
+ *      Number of records loaded by loadYcsb.
+ * \param[out] results
+ *      Latencies and error counts are recorded here.
+ */
+static void
+runYcsb(const YcsbWorkload& workload, uint64_t recordCount,
+        YcsbResults* results)
+{
+    ZipfianGenerator zipfian(recordCount);
+    std::unique_ptr<YcsbSlot[]> slots(new YcsbSlot[pipelineDepth]);
+    string value(objectSize, 'y');
+    const RejectRules* noRejectRules = NULL;
+    // Records inserted by this client; clients interleave their inserts
+    // so that they never pick the same record number.
+    uint64_t inserts = 0;
+    uint64_t latestRecord = recordCount - 1;
+
+    uint64_t start = Cycles::rdtsc();
+    uint64_t stop = start + Cycles::fromSeconds(seconds);
+    uint64_t now = start;
+    bool issuing = true;
+    int active = 0;
+    while (issuing || active > 0) {
+        cluster->clientContext->dispatch->poll();
+        now = Cycles::rdtsc();
+        issuing = issuing && (now < stop);
+        for (int i = 0; i < pipelineDepth; i++) {
+            YcsbSlot& slot = slots[i];
+            if (slot.startTime != 0) {
+                // See whether the slot's request has finished.
+                try {
+                    if (slot.readRpc) {
+                        if (!slot.readRpc->isReady())
+                            continue;
+                        slot.readRpc->wait();
+                        slot.readRpc.destroy();
+                        if (slot.op == YCSB_READ_MODIFY_WRITE) {
+                            // The read is done; now the write.
+                            slot.writeRpc.construct(cluster, dataTable,
+                                    slot.key.data(),
+                                    downCast<uint16_t>(slot.key.size()),
+                                    value.data(),
+                                    downCast<uint32_t>(value.size()),
+                                    noRejectRules, asyncReplication);
+                            continue;
+                        }
+                    } else if (slot.writeRpc) {
+                        if (!slot.writeRpc->isReady())
+                            continue;
+                        slot.writeRpc->wait();
+                    } else {
+                        if (!slot.scan->isReady())
+                            continue;
+                        slot.scan->wait();
+                        foreach (MultiReadObject& object, slot.scanObjects) {
+                            if (object.status == STATUS_OBJECT_DOESNT_EXIST)
+                                results->notFound++;
+                            else if (object.status != STATUS_OK)
+                                results->errors++;
+                        }
+                    }
+                } catch (ObjectDoesntExistException& e) {
+                    results->notFound++;
+                } catch (ClientException& e) {
+                    results->errors++;
+                }
+                results->latency[slot.op].record(
+                        Cycles::toNanoseconds(now - slot.startTime));
+                slot.readRpc.destroy();
+                slot.writeRpc.destroy();
+                slot.scan.destroy();
+                slot.startTime = 0;
+                active--;
+            }
+            if (!issuing) {
+                continue;
+            }
+
+            // Pick the next operation and the record it works on.
+            uint32_t choice = downCast<uint32_t>(generateRandom() % 100);
+            int op = 0;
+            while (op < YCSB_NUM_OPS - 1 &&
+                    choice >= static_cast<uint32_t>(workload.percent[op])) {
+                choice -= workload.percent[op];
+                op++;
+            }
+            slot.op = static_cast<YcsbOp>(op);
+            uint64_t skew = std::min(zipfian.nextNumber(), recordCount - 1);
+            uint64_t record = workload.latest
+                    ? latestRecord - std::min(skew, latestRecord) : skew;
+            slot.startTime = now;
+            active++;
+            switch (slot.op) {
+            case YCSB_INSERT:
+                record = recordCount + inserts * numClients + clientIndex;
+                inserts++;
+                latestRecord = record;
+                // Fall through.
+            case YCSB_UPDATE:
+                slot.key = ycsbKey(record);
+                slot.writeRpc.construct(cluster, dataTable, slot.key.data(),
+                        downCast<uint16_t>(slot.key.size()), value.data(),
+                        downCast<uint32_t>(value.size()), noRejectRules,
+                        asyncReplication);
+                break;
+            case YCSB_SCAN: {
+                uint32_t length = downCast<uint32_t>(
+                        generateRandom() % YCSB_MAX_SCAN_LENGTH + 1);
+                slot.scanKeys.clear();
+                slot.scanObjects.clear();
+                slot.scanObjects.reserve(length);
+                for (uint32_t k = 0; k < length; k++)
+                    slot.scanKeys.push_back(ycsbKey(record + k));
+                for (uint32_t k = 0; k < length; k++) {
+                    slot.scanValues[k].destroy();
+                    slot.scanObjects.emplace_back(dataTable,
+                            slot.scanKeys[k].data(),
+                            downCast<uint16_t>(slot.scanKeys[k].size()),
+                            &slot.scanValues[k]);
+                    slot.scanRequests[k] = &slot.scanObjects[k];
+                }
+                slot.scan.construct(cluster, slot.scanRequests, length);
+                break;
+            }
+            default:
+                slot.key = ycsbKey(record);
+                slot.readRpc.construct(cluster, dataTable, slot.key.data(),
+                        downCast<uint16_t>(slot.key.size()), &slot.value);
+                break;
+            }
+        }
+    }
+    results->elapsedSeconds = Cycles::toSeconds(now - start);
+}
+
+/**
+ * Return the results of a client's part of a ycsb run to the master.
+ */
+static void
+sendYcsbResults(const YcsbResults& results)
+{
+    sendMetrics(results.elapsedSeconds, static_cast<double>(results.errors),
+            static_cast<double>(results.notFound));
+    for (int op = 0; op < YCSB_NUM_OPS; op++) {
+        sendHistogram(format("ycsbLatency%d", op).c_str(),
+                results.latency[op]);
+    }
+}
+
+// Runs one of the YCSB core workloads (--workload YCSB-A through YCSB-F)
+// on all of the clients: they load --numObjects records (1000000 by
+// default) of --size bytes, then keep --pipelineDepth requests outstanding
+// each for --seconds, and the throughput and latency percentiles for each
+// kind of operation are reported.
+void
+ycsb()
+{
+    const YcsbWorkload* selected = NULL;
+    foreach (const YcsbWorkload& candidate, ycsbWorkloads) {
+        if (workload == candidate.name)
+            selected = &candidate;
+    }
+    if (selected == NULL) {
+        printf("ycsb: unknown workload %s; use YCSB-A through YCSB-F\n",
+                workload.c_str());
+        return;
+    }
+    uint64_t recordCount = (numObjects != 1) ? numObjects : 1000000;
+
+    if (clientIndex > 0) {
+        char command[20];
+        getCommand(command, sizeof(command));
+        if (strcmp(command, "load") != 0) {
+            RAMCLOUD_LOG(ERROR, "unknown command %s", command);
+            return;
+        }
+        setSlaveState("loading");
+        loadYcsb(recordCount);
+        setSlaveState("loaded");
+        getCommand(command, sizeof(command));
+        if (strcmp(command, "run") != 0) {
+            RAMCLOUD_LOG(ERROR, "unknown command %s", command);
+            return;
+        }
+        setSlaveState("running");
+        YcsbResults results;
+        runYcsb(*selected, recordCount, &results);
+        sendYcsbResults(results);
+        setSlaveState("done");
+        return;
+    }
+
+    // This is the master client: everyone loads its share of the records,
+    // then everyone runs the workload.
+    sendCommand("load", "loading", 1, numClients-1);
+    loadYcsb(recordCount);
+    for (int slave = 1; slave < numClients; slave++) {
+        waitSlave(slave, "loaded", 600.0);
+    }
+    sendCommand("run", "running", 1, numClients-1);
+    YcsbResults clientResults;
+    runYcsb(*selected, recordCount, &clientResults);
+    sendYcsbResults(clientResults);
+    for (int slave = 1; slave < numClients; slave++) {
+        waitSlave(slave, "done", 60.0);
+    }
+
+    // Add up everyone's results.
+    YcsbResults results;
+    ClientMetrics metrics;
+    getMetrics(metrics, numClients);
+    results.elapsedSeconds = max(metrics[0]);
+    results.errors = static_cast<uint64_t>(sum(metrics[1]));
+    results.notFound = static_cast<uint64_t>(sum(metrics[2]));
+    for (int op = 0; op < YCSB_NUM_OPS; op++) {
+        getHistogram(format("ycsbLatency%d", op).c_str(), numClients,
+                &results.latency[op]);
+    }
+
+    static const char* opNames[] = {"read", "update", "insert", "scan",
+            "rmw"};
+    uint64_t total = 0;
+    for (int op = 0; op < YCSB_NUM_OPS; op++) {
+        total += results.latency[op].getCount();
+    }
+    printf("# RAMCloud %s with %lu records of %d bytes, %d clients with\n"
+            "# %d requests outstanding each.\n", selected->name,
+            recordCount, objectSize, numClients, pipelineDepth);
+    printf("# All times are in microseconds; a scan is a multiRead of\n"
+            "# consecutive records.\n");
+    printf("# Generated by 'clusterperf.py ycsb'\n");
+    printf("#\n");
+    printf("# %.1f s, %.1f kOps/s, %lu errors, %lu records not found\n",
+            results.elapsedSeconds,
+            static_cast<double>(total) * 1e-03 / results.elapsedSeconds,
+            results.errors, results.notFound);
+    printf("#\n");
+    printf("#     op      count   median      90%%      99%%    99.9%%"
+            "      max\n");
+    printf("#----------------------------------------------------------"
+            "------\n");
+    for (int op = 0; op < YCSB_NUM_OPS; op++) {
+        LatencyHistogram& histogram = results.latency[op];
+        if (histogram.getCount() == 0) {
+            continue;
+        }
+        printf("%8s %10lu %8.1f %8.1f %8.1f %8.1f %8.1f\n", opNames[op],
+                histogram.getCount(),
+                percentileMicros(histogram, 0.5),
+                percentileMicros(histogram, 0.9),
+                percentileMicros(histogram, 0.99),
+                percentileMicros(histogram, 0.999),
+                percentileMicros(histogram, 1.0));
+    }
+}
+
 // This benchmark measures test consistency guarantee of transaction
 // by several clients trasfer balances among many objects.
 void
@@ -5569,6 +6508,212 @@ netBandwidth()
             "slowest client");
 }
 
+/**
+ * Keep a fixed number of echo, read, or write RPCs outstanding to one
+ * server for a while (closed-loop load), and measure them. This is the
+ * inner loop of the transportMatrix test.
+ *
+ * \param op
+ *      "echo", "read", or "write".
+ * \param receiver
+ *      Service locator of the server that receives echo RPCs; it should be
+ *      the master of dataTable, so that all three operations go to the
+ *      same server.
+ * \param size
+ *      For echos, the size of both the request and the response; for reads
+ *      and writes, the size of each object.
+ * \param concurrency
+ *      Number of RPCs outstanding at once (at most 64). Slot i of the
+ *      pipeline always reads or writes the object with key makeKey(i).
+ * \param seconds
+ *      How long to generate load.
+ * \param keyLength
+ *      Size of each key in dataTable, in bytes.
+ * \param latency
+ *      The latency of each RPC, in nanoseconds, is recorded here.
+ * \param[out] activeCycles
+ *      Filled in with the number of cycles this client spent issuing RPCs
+ *      and in calls to Dispatch::poll that did useful work; this is the
+ *      client's CPU cost, without the time it spent spinning idle.
+ * \return
+ *      Elapsed time, in seconds, from the start of the run until the last
+ *      RPC completed.
+ */
+double
+closedLoopRpcs(const char* op, const string& receiver, uint32_t size,
+        int concurrency, double seconds, uint16_t keyLength,
+        LatencyHistogram* latency, uint64_t* activeCycles)
+{
+#define MAX_CONCURRENCY 64
+    Tub<EchoRpc> echoRpcs[MAX_CONCURRENCY];
+    Tub<ReadRpc> readRpcs[MAX_CONCURRENCY];
+    Tub<WriteRpc> writeRpcs[MAX_CONCURRENCY];
+    Buffer responses[MAX_CONCURRENCY];
+    uint64_t startTimes[MAX_CONCURRENCY];
+    std::vector<char> keys(MAX_CONCURRENCY * keyLength);
+    string value(size, 'x');
+    concurrency = std::min(concurrency, MAX_CONCURRENCY);
+    for (int i = 0; i < concurrency; i++) {
+        makeKey(i, keyLength, &keys[i * keyLength]);
+    }
+
+    *activeCycles = 0;
+    int outstanding = 0;
+    uint64_t start = Cycles::rdtsc();
+    uint64_t stop = start + Cycles::fromSeconds(seconds);
+    uint64_t now = start;
+    while ((now < stop) || (outstanding > 0)) {
+        uint64_t pollStart = Cycles::rdtsc();
+        if (cluster->clientContext->dispatch->poll() > 0) {
+            *activeCycles += Cycles::rdtsc() - pollStart;
+        }
+        now = Cycles::rdtsc();
+        for (int i = 0; i < concurrency; i++) {
+            if (echoRpcs[i] || readRpcs[i] || writeRpcs[i]) {
+                try {
+                    if (echoRpcs[i]) {
+                        if (!echoRpcs[i]->isReady())
+                            continue;
+                        echoRpcs[i]->wait();
+                    } else if (readRpcs[i]) {
+                        if (!readRpcs[i]->isReady())
+                            continue;
+                        readRpcs[i]->wait();
+                    } else {
+                        if (!writeRpcs[i]->isReady())
+                            continue;
+                        writeRpcs[i]->wait();
+                    }
+                } catch (ClientException& e) {
+                    RAMCLOUD_LOG(NOTICE, "%s RPC failed with exception %s",
+                            op, e.toString());
+                }
+                echoRpcs[i].destroy();
+                readRpcs[i].destroy();
+                writeRpcs[i].destroy();
+                now = Cycles::rdtsc();
+                latency->record(Cycles::toNanoseconds(now - startTimes[i]));
+                outstanding--;
+            }
+            if (now >= stop)
+                continue;
+
+            // This slot is free: start the next RPC in it.
+            uint64_t issueStart = Cycles::rdtsc();
+            startTimes[i] = issueStart;
+            if (strcmp(op, "echo") == 0) {
+                echoRpcs[i].construct(cluster, receiver.c_str(),
+                        value.data(), size, size, &responses[i]);
+            } else if (strcmp(op, "read") == 0) {
+                readRpcs[i].construct(cluster, dataTable,
+                        &keys[i * keyLength], keyLength, &responses[i]);
+            } else {
+                writeRpcs[i].construct(cluster, dataTable,
+                        &keys[i * keyLength], keyLength, value.data(),
+                        size);
+            }
+            now = Cycles::rdtsc();
+            *activeCycles += now - issueStart;
+            outstanding++;
+        }
+    }
+    return Cycles::toSeconds(now - start);
+#undef MAX_CONCURRENCY
+}
+
+/**
+ * Return the cycles that the master of dataTable has spent doing useful
+ * work in its dispatch and worker threads, according to its PerfStats.
+ */
+uint64_t
+serverActiveCycles()
+{
+    Buffer statsBuffer;
+    cluster->objectServerControl(dataTable, "0", 1,
+            WireFormat::ControlOp::GET_PERF_STATS, NULL, 0, &statsBuffer);
+    const PerfStats* stats = statsBuffer.getStart<PerfStats>();
+    return stats->dispatchActiveCycles + stats->workerActiveCycles;
+}
+
+// Measure echos, reads, and writes of various sizes, with various numbers of
+// RPCs outstanding, all to a single server. This produces one table per
+// run; clusterperf.py runs it once for each transport that works on the
+// cluster and merges the tables, so that transports can be compared.
+void
+transportMatrix()
+{
+    if (clientIndex != 0)
+        return;
+    const uint16_t keyLength = 30;
+#define NUM_SIZES 5
+    uint32_t sizes[NUM_SIZES] = {100, 1000, 10000, 100000, 1000000};
+#define NUM_CONCURRENCIES 3
+    int concurrencies[NUM_CONCURRENCIES] = {1, 4, 16};
+    const char* ops[] = {"echo", "read", "write"};
+    double cellSeconds = (seconds > 0) ? seconds : 1.0;
+
+    ServerId master = cluster->clientContext->objectFinder->lookupTablet(
+            dataTable, 0)->tablet.serverId;
+    using ServerMap = std::map<uint64_t, std::pair<string, ServiceMask>>;
+    ServerMap servers;
+    getServerList(&servers);
+    ServerMap::iterator it = servers.find(master.getId());
+    if (it == servers.end()) {
+        RAMCLOUD_LOG(ERROR, "Master of table %lu is not up", dataTable);
+        return;
+    }
+    const string& receiver = it->second.first;
+
+    printf("# RAMCloud echos, reads, and writes to a single server, with\n"
+            "# a fixed number of RPCs outstanding from one client. Echo\n"
+            "# requests and responses both have the given size; reads and\n"
+            "# writes use objects of that size. CPU times are time spent\n"
+            "# doing useful work per operation (client: issuing RPCs and\n"
+            "# polls that found work; server: dispatch and worker\n"
+            "# threads).\n");
+    printf("# Generated by 'clusterperf.py transportMatrix'\n");
+    printf("#\n");
+    printf("# Op       Size  Outst     kops     MB/s   Median      99%%"
+            "   Client   Server\n");
+    printf("#                                            (us)     (us)"
+            "  CPU(us)  CPU(us)\n");
+    printf("#---------------------------------------------------------"
+            "------------------\n");
+    for (int s = 0; s < NUM_SIZES; s++) {
+        uint32_t size = sizes[s];
+        fillTable(dataTable, 64, keyLength, size);
+        for (const char* op : ops) {
+            for (int c = 0; c < NUM_CONCURRENCIES; c++) {
+                int concurrency = concurrencies[c];
+                cluster->logMessageAll(NOTICE,
+                        "Starting %s test for %u bytes with %d outstanding",
+                        op, size, concurrency);
+                LatencyHistogram latency;
+                uint64_t clientCycles;
+                uint64_t serverStart = serverActiveCycles();
+                double elapsed = closedLoopRpcs(op, receiver, size,
+                        concurrency, cellSeconds, keyLength, &latency,
+                        &clientCycles);
+                uint64_t serverCycles = serverActiveCycles() - serverStart;
+                double numOps = static_cast<double>(latency.getCount());
+                if (numOps == 0) {
+                    numOps = 1;
+                }
+                printf("%-6s %8u %6d %8.1f %8.1f %8.1f %8.1f %8.2f %8.2f\n",
+                        op, size, concurrency, numOps / elapsed * 1e-03,
+                        numOps * size / elapsed / 1e06,
+                        percentileMicros(latency, 0.5),
+                        percentileMicros(latency, 0.99),
+                        Cycles::toSeconds(clientCycles) / numOps * 1e06,
+                        Cycles::toSeconds(serverCycles) / numOps * 1e06);
+                fflush(stdout);
+            }
+        }
+    }
+#undef NUM_SIZES
+#undef NUM_CONCURRENCIES
+}
+
 // Each client reads a single object from each master.  Good for
 // testing that each host in the cluster can send/receive RPCs
 // from every other host.
@@ -6071,6 +7216,421 @@ readNotFound()
     printTime("readNotFound", t, "read object that doesn't exist");
 }
 
+/**
+ * Return a random time between arrivals in a Poisson process.
+ *
+ * \param rate
+ *      Average number of arrivals per second.
+ * \return
+ *      The interval, in Cycles::rdtsc ticks.
+ */
+uint64_t
+poissonInterval(double rate)
+{
+    // A uniform value in (0, 1], from the top 53 bits of a random number.
+    double uniform = std::ldexp(static_cast<double>(generateRandom() >> 11)
+            + 1.0, -53);
+    return Cycles::fromSeconds(-std::log(uniform) / rate);
+}
+
+/**
+ * Generate open-loop load: issue requests for random objects in dataTable
+ * at the times of a Poisson process, without waiting for earlier requests
+ * to complete. Latencies are measured from the time each request should
+ * have been sent, so if all of the outstanding-request slots are busy,
+ * the time a request spends waiting for one counts against it (this
+ * avoids the "coordinated omission" of closed-loop measurements, which
+ * hide queueing delays by slowing down when the servers do).
+ *
+ * \param read
+ *      True means issue reads; false means overwrite the objects.
+ * \param rate
+ *      Average number of requests to issue per second.
+ * \param seconds
+ *      How long to issue requests for; this method returns once the last
+ *      one completes.
+ * \param numObjects
+ *      Requests are for objects with keys generated by makeKey from
+ *      0..numObjects-1 (see fillTable).
+ * \param keyLength
+ *      Size of each key, in bytes.
+ * \param[out] latency
+ *      The latency of each request, in nanoseconds, is recorded here.
+ * \param[out] timeline
+ *      If not NULL, the latency of each request is also recorded in entry
+ *      i of this vector, where i is the number of \a bucketSeconds
+ *      intervals between the start of the run and the time the request
+ *      should have been sent. The vector is grown as needed.
+ * \param bucketSeconds
+ *      Width of the intervals in \a timeline.
+ * \return
+ *      Elapsed time, in seconds, from the start of the run until the last
+ *      request completed.
+ */
+double
+openLoopLoad(bool read, double rate, double seconds, int numObjects,
+        uint16_t keyLength, LatencyHistogram* latency,
+        std::vector<LatencyHistogram>* timeline = NULL,
+        double bucketSeconds = 0.1)
+{
+    // Maximum number of requests outstanding at once from this client.
+#define MAX_OUTSTANDING 128
+    Tub<ReadRpc> readRpcs[MAX_OUTSTANDING];
+    Tub<WriteRpc> writeRpcs[MAX_OUTSTANDING];
+    Buffer values[MAX_OUTSTANDING];
+    std::vector<char> keys(MAX_OUTSTANDING * keyLength);
+    uint64_t intendedTime[MAX_OUTSTANDING];
+    string value(objectSize, 'x');
+
+    int outstanding = 0;
+    uint64_t start = Cycles::rdtsc();
+    uint64_t stop = start + Cycles::fromSeconds(seconds);
+    uint64_t bucketCycles = Cycles::fromSeconds(bucketSeconds);
+    uint64_t nextSend = start + poissonInterval(rate);
+    uint64_t now = start;
+    while ((nextSend < stop) || (outstanding > 0)) {
+        cluster->clientContext->dispatch->poll();
+        now = Cycles::rdtsc();
+        for (int i = 0; i < MAX_OUTSTANDING; i++) {
+            if (readRpcs[i] || writeRpcs[i]) {
+                if (read) {
+                    if (!readRpcs[i]->isReady())
+                        continue;
+                    readRpcs[i]->wait();
+                    readRpcs[i].destroy();
+                } else {
+                    if (!writeRpcs[i]->isReady())
+                        continue;
+                    writeRpcs[i]->wait();
+                    writeRpcs[i].destroy();
+                }
+                now = Cycles::rdtsc();
+                uint64_t ns = Cycles::toNanoseconds(now - intendedTime[i]);
+                latency->record(ns);
+                if (timeline != NULL) {
+                    size_t bucket = (intendedTime[i] - start) / bucketCycles;
+                    if (timeline->size() <= bucket)
+                        timeline->resize(bucket + 1);
+                    (*timeline)[bucket].record(ns);
+                }
+                outstanding--;
+            }
+            if ((nextSend > now) || (nextSend >= stop))
+                continue;
+
+            // This slot is free and a request is due (or overdue).
+            char* key = &keys[i * keyLength];
+            makeKey(downCast<int>(generateRandom() % numObjects), keyLength,
+                    key);
+            if (read) {
+                readRpcs[i].construct(cluster, dataTable, key, keyLength,
+                        &values[i]);
+            } else {
+                writeRpcs[i].construct(cluster, dataTable, key, keyLength,
+                        value.data(), downCast<uint32_t>(value.size()));
+            }
+            intendedTime[i] = nextSend;
+            nextSend += poissonInterval(rate);
+            outstanding++;
+        }
+    }
+    return Cycles::toSeconds(now - start);
+#undef MAX_OUTSTANDING
+}
+
+/**
+ * This method implements the readOpenLoop and writeOpenLoop tests: all of
+ * the clients generate open-loop load (see openLoopLoad) on one server at
+ * a series of increasing rates, to produce a curve of latency versus
+ * throughput.
+ *
+ * \param read
+ *      True means measure reads, false means measure overwrites.
+ */
+void
+openLoopCommon(bool read)
+{
+    const int numObjects = 100000;
+    const uint16_t keyLength = 30;
+    int levels = std::max(loadLevels, 1);
+    double maxRate = (targetOps > 0) ? targetOps : 100000;
+    double levelSeconds = std::max(static_cast<double>(seconds) / levels,
+            1.0);
+
+    if (clientIndex > 0) {
+        // Slaves generate load at the rate given in each "run" command.
+        while (true) {
+            char command[20];
+            getCommand(command, sizeof(command));
+            double rate;
+            if (sscanf(command, "run %lf", &rate) == 1) {
+                setSlaveState("running");
+                LatencyHistogram latency;
+                double elapsed = openLoopLoad(read, rate, levelSeconds,
+                        numObjects, keyLength, &latency);
+                sendMetrics(static_cast<double>(latency.getCount()),
+                        elapsed);
+                sendHistogram("openLoopLatency", latency);
+                setSlaveState("idle");
+            } else if (strcmp(command, "done") == 0) {
+                setSlaveState("done");
+                return;
+            } else {
+                RAMCLOUD_LOG(ERROR, "unknown command %s", command);
+                return;
+            }
+        }
+    }
+
+    // This is the master client.
+    fillTable(dataTable, numObjects, keyLength, objectSize);
+    const char* op = read ? "read" : "write";
+    printf("# RAMCloud %s latency versus throughput with open-loop load:\n"
+            "# %d clients each issue %ss of %d-byte objects (chosen\n"
+            "# uniformly from %d) to a single server, with Poisson arrivals\n"
+            "# and up to 128 requests outstanding per client. Latencies\n"
+            "# are measured from each request's intended send time.\n",
+            op, numClients, op, objectSize, numObjects);
+    printf("# Generated by 'clusterperf.py %sOpenLoop'\n", op);
+    printf("#\n");
+    printf("# Offered   Achieved   Median      90%%      99%%    99.9%%"
+            "      Max\n");
+    printf("# (kops)    (kops)     (us)       (us)     (us)     (us)"
+            "      (us)\n");
+    printf("#----------------------------------------------------------"
+            "--------\n");
+    for (int level = 1; level <= levels; level++) {
+        double rate = maxRate * level / levels;
+        sendCommand(format("run %.0f", rate).c_str(), "running", 1,
+                numClients-1);
+        LatencyHistogram clientLatency;
+        double elapsed = openLoopLoad(read, rate, levelSeconds, numObjects,
+                keyLength, &clientLatency);
+        sendMetrics(static_cast<double>(clientLatency.getCount()), elapsed);
+        sendHistogram("openLoopLatency", clientLatency);
+        for (int slave = 1; slave < numClients; slave++) {
+            waitSlave(slave, "idle", levelSeconds + 10.0);
+        }
+
+        ClientMetrics metrics;
+        getMetrics(metrics, numClients);
+        LatencyHistogram latency;
+        getHistogram("openLoopLatency", numClients, &latency);
+        printf("%8.1f   %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+                rate * numClients * 1e-03,
+                sum(metrics[0]) / max(metrics[1]) * 1e-03,
+                percentileMicros(latency, 0.5),
+                percentileMicros(latency, 0.9),
+                percentileMicros(latency, 0.99),
+                percentileMicros(latency, 0.999),
+                percentileMicros(latency, 1.0));
+    }
+    sendCommand("done", "done", 1, numClients-1);
+}
+
+// Generate open-loop read load at increasing rates and measure latency at
+// each rate (see openLoopCommon).
+void
+readOpenLoop()
+{
+    openLoopCommon(true);
+}
+
+/**
+ * Runs the background activity of one of the *Interference tests below, in
+ * a thread of its own with its own RamCloud object, so that the blocking
+ * calls it makes don't delay the foreground requests.
+ *
+ * \param activity
+ *      "cleaner", "migration", or "recovery".
+ * \param delaySeconds
+ *      How long to wait before starting the activity.
+ * \param activitySeconds
+ *      For "cleaner", how long to keep overwriting objects.
+ * \param numObjects
+ *      Number of objects in dataTable (see fillTable).
+ * \param keyLength
+ *      Size of each key in dataTable, in bytes.
+ * \param target
+ *      For "migration", the server that dataTable is migrated to.
+ * \param victimTable
+ *      For "recovery", a table whose master is killed.
+ * \param[out] startTime
+ *      Cycles::rdtsc() time when the activity started.
+ * \param[out] endTime
+ *      Cycles::rdtsc() time when the activity completed.
+ */
+void
+runBackgroundActivity(string activity, double delaySeconds,
+        double activitySeconds, int numObjects, uint16_t keyLength,
+        ServerId target, uint64_t victimTable, uint64_t* startTime,
+        uint64_t* endTime)
+{
+    RamCloud client(context->options);
+    Cycles::sleep(downCast<uint64_t>(delaySeconds * 1e06));
+    *startTime = Cycles::rdtsc();
+    if (activity == "cleaner") {
+        // Overwrite objects as fast as possible; once the log is full
+        // enough, each overwrite has to be paid for by cleaning.
+        string value(objectSize, 'y');
+        std::vector<char> key(keyLength);
+        uint64_t stop = *startTime + Cycles::fromSeconds(activitySeconds);
+        while (Cycles::rdtsc() < stop) {
+            makeKey(downCast<int>(generateRandom() % numObjects), keyLength,
+                    key.data());
+            client.write(dataTable, key.data(), keyLength, value.data(),
+                    downCast<uint32_t>(value.size()));
+        }
+    } else if (activity == "migration") {
+        client.migrateTablet(dataTable, 0, ~0UL, target);
+    } else {
+        client.testingKill(victimTable, "0", 1);
+        client.testingWaitForAllTabletsNormal(victimTable);
+    }
+    *endTime = Cycles::rdtsc();
+}
+
+/**
+ * This method implements the cleanerInterference, migrationInterference,
+ * and recoveryInterference tests: it generates steady open-loop reads (see
+ * openLoopLoad) to the master of dataTable, starts a background activity
+ * partway through, and prints the latency of the reads over time, so the
+ * impact of the background activity on foreground requests can be seen.
+ *
+ * \param activity
+ *      "cleaner": another client overwrites the objects of dataTable as
+ *      fast as it can; run the servers with little memory (clusterperf.py
+ *      does) so that the log cleaner has to run at high utilization.
+ *      "migration": dataTable is migrated to another master (the reads
+ *      follow it).
+ *      "recovery": the master of another table is killed; the master of
+ *      dataTable takes part in the recovery as a backup and usually as
+ *      a recovery master.
+ */
+void
+backgroundInterference(const char* activity)
+{
+    if (clientIndex != 0)
+        return;
+
+    const int numObjects = 100000;
+    const uint16_t keyLength = 30;
+    const double bucketSeconds = 0.1;
+    double rate = (targetOps > 0) ? targetOps : 20000;
+    double runSeconds = std::max(seconds, 5);
+    double delaySeconds = runSeconds / 5;
+    fillTable(dataTable, numObjects, keyLength, objectSize);
+
+    ServerId owner = cluster->clientContext->objectFinder->lookupTablet(
+            dataTable, 0)->tablet.serverId;
+    ServerId target;
+    uint64_t victimTable = 0;
+    if (strcmp(activity, "migration") == 0) {
+        std::map<uint64_t, std::pair<string, ServiceMask>> servers;
+        getServerList(&servers);
+        for (auto& server : servers) {
+            if (server.second.second.has(WireFormat::MASTER_SERVICE) &&
+                    ServerId(server.first) != owner) {
+                target = ServerId(server.first);
+                break;
+            }
+        }
+        if (!target.isValid()) {
+            printf("# migrationInterference needs at least 2 masters\n");
+            return;
+        }
+    } else if (strcmp(activity, "recovery") == 0) {
+        // Tables are assigned to masters in turn; keep creating them until
+        // one lands somewhere other than dataTable.
+        for (int i = 0; i < 20; i++) {
+            string name = format("interferenceVictim%d", i);
+            uint64_t tableId = cluster->createTable(name.c_str());
+            ServerId master = cluster->clientContext->objectFinder->
+                    lookupTablet(tableId, 0)->tablet.serverId;
+            if (master != owner) {
+                victimTable = tableId;
+                break;
+            }
+        }
+        if (victimTable == 0) {
+            printf("# recoveryInterference needs at least 2 masters\n");
+            return;
+        }
+        fillTable(victimTable, numObjects, keyLength, objectSize);
+        cluster->write(victimTable, "0", 1, "victim", 6);
+    }
+
+    uint64_t activityStart = 0, activityEnd = 0;
+    std::thread background(runBackgroundActivity, string(activity),
+            delaySeconds, runSeconds - 2 * delaySeconds, numObjects,
+            keyLength, target, victimTable, &activityStart, &activityEnd);
+    LatencyHistogram latency;
+    std::vector<LatencyHistogram> timeline;
+    uint64_t start = Cycles::rdtsc();
+    double elapsed = openLoopLoad(true, rate, runSeconds, numObjects,
+            keyLength, &latency, &timeline, bucketSeconds);
+    background.join();
+
+    printf("# RAMCloud read latency over time with open-loop load (%.0f\n"
+            "# reads/s of %d-byte objects, Poisson arrivals) while a\n"
+            "# background %s runs. Times are seconds from the start of the\n"
+            "# run; '*' marks intervals that overlap the %s, which ran\n"
+            "# from %.2f to %.2f seconds.\n",
+            rate, objectSize, activity, activity,
+            Cycles::toSeconds(activityStart - start),
+            (activityEnd > 0) ? Cycles::toSeconds(activityEnd - start)
+                              : elapsed);
+    printf("# Generated by 'clusterperf.py %sInterference'\n", activity);
+    printf("#\n");
+    printf("#   Time    kops   Median      99%%    99.9%%      Max\n");
+    printf("#    (s)              (us)     (us)     (us)     (us)\n");
+    printf("#----------------------------------------------------------\n");
+    for (size_t i = 0; i < timeline.size(); i++) {
+        uint64_t bucketStart = start + Cycles::fromSeconds(
+                static_cast<double>(i) * bucketSeconds);
+        uint64_t bucketEnd = bucketStart + Cycles::fromSeconds(bucketSeconds);
+        bool active = (bucketEnd > activityStart) &&
+                ((activityEnd == 0) || (bucketStart < activityEnd));
+        printf("%8.1f %7.1f %8.1f %8.1f %8.1f %8.1f %s\n",
+                static_cast<double>(i) * bucketSeconds,
+                static_cast<double>(timeline[i].getCount()) /
+                        bucketSeconds * 1e-03,
+                percentileMicros(timeline[i], 0.5),
+                percentileMicros(timeline[i], 0.99),
+                percentileMicros(timeline[i], 0.999),
+                percentileMicros(timeline[i], 1.0),
+                active ? "*" : "");
+    }
+    printf("# Overall: median %.1f us, 99%% %.1f us, 99.9%% %.1f us, "
+            "max %.1f us\n",
+            percentileMicros(latency, 0.5), percentileMicros(latency, 0.99),
+            percentileMicros(latency, 0.999), percentileMicros(latency, 1.0));
+}
+
+// Measure read latency over time while the log cleaner runs at high
+// utilization (see backgroundInterference).
+void
+cleanerInterference()
+{
+    backgroundInterference("cleaner");
+}
+
+// Measure read latency over time while the table being read migrates to
+// another master (see backgroundInterference).
+void
+migrationInterference()
+{
+    backgroundInterference("migration");
+}
+
+// Measure read latency over time while another master is recovered (see
+// backgroundInterference).
+void
+recoveryInterference()
+{
+    backgroundInterference("recovery");
+}
+
 /**
  * This method contains the core of the "readRandom" test; it is
  * shared by the master and slaves.
@@ -6571,6 +8131,14 @@ writeInterference()
     interferenceCommon(false);
 }
 
+// Generate open-loop write load at increasing rates and measure latency at
+// each rate (see openLoopCommon).
+void
+writeOpenLoop()
+{
+    openLoopCommon(false);
+}
+
 /**
  * This method implements the client-0 (master) functionality for
  * linearizableWriteThroughput.
@@ -6853,6 +8421,7 @@ struct TestInfo {
 TestInfo tests[] = {
     {"basic", basic},
     {"broadcast", broadcast},
+    {"cleanerInterference", cleanerInterference},
     {"echo_basic", echo_basic},
     {"echo_incast", echo_incast},
     {"indexBasic", indexBasic},
@@ -6861,6 +8430,8 @@ TestInfo tests[] = {
     {"indexScalability", indexScalability},
     {"indexWriteDist", indexWriteDist},
     {"indexReadDist", indexReadDist},
+    {"traceReplay", traceReplay},
+    {"transportMatrix", transportMatrix},
     {"transaction_oneMaster", transaction_oneMaster},
     {"transaction_collision", transaction_collision},
     {"transactionContention", transactionContention},
@@ -6873,6 +8444,7 @@ TestInfo tests[] = {
     {"multiRead_colocation", multiRead_colocation},
     {"multiWrite_oneMaster", multiWrite_oneMaster},
     {"multiReadThroughput", multiReadThroughput},
+    {"migrationInterference", migrationInterference},
     {"netBandwidth", netBandwidth},
     {"readAllToAll", readAllToAll},
     {"readDist", readDist},
@@ -6881,16 +8453,20 @@ TestInfo tests[] = {
     {"readInterference", readInterference},
     {"readLoaded", readLoaded},
     {"readNotFound", readNotFound},
+    {"readOpenLoop", readOpenLoop},
     {"readRandom", readRandom},
     {"readThroughput", readThroughput},
     {"readVaryingKeyLength", readVaryingKeyLength},
+    {"recoveryInterference", recoveryInterference},
     {"writeVaryingKeyLength", writeVaryingKeyLength},
     {"writeAsyncSync", writeAsyncSync},
     {"writeDistRandom", writeDistRandom},
     {"writeDistWorkload", writeDistWorkload},
     {"writeInterference", writeInterference},
+    {"writeOpenLoop", writeOpenLoop},
     {"writeThroughput", writeThroughput},
     {"workloadThroughput", workloadThroughput},
+    {"ycsb", ycsb},
 };
 
 int
@@ -6927,7 +8503,7 @@ try
                 "measurements")
         ("workload", po::value<string>(&workload)->default_value("YCSB-A"),
                 "Workload of additional load generating clients"
-                "(YCSB-A, YCSB-B, YCSB-C)")
+                "(YCSB-A, YCSB-B, YCSB-C); for ycsb, YCSB-A through YCSB-F")
         ("targetOps", po::value<int>(&targetOps)->default_value(0),
                 "Operations per second that each load generating client"
                 "will try to achieve (0 means run as fast as possible)")
@@ -6951,6 +8527,21 @@ try
         ("seconds", po::value<int>(&seconds)->default_value(30),
                 "Number of seconds to run the experiment for; "
                 "only applies to doWorkload based experiments.")
+        ("loadLevels", po::value<int>(&loadLevels)->default_value(10),
+                "For readOpenLoop and writeOpenLoop, the number of load "
+                "levels to measure, spread evenly up to --targetOps per "
+                "client (or 100000 if --targetOps is 0); --seconds is "
+                "divided among them")
+        ("pipelineDepth",
+                po::value<int>(&pipelineDepth)->default_value(16),
+                "For ycsb, the number of requests each client keeps "
+                "outstanding")
+        ("traceFile", po::value<string>(&traceFile),
+                "For traceReplay, the request trace to replay (it must be "
+                "readable on every client)")
+        ("traceSpeedup", po::value<double>(&traceSpeedup)->default_value(1.0),
+                "For traceReplay, replay the trace this many times faster "
+                "than it was captured")
         ("fullSamples", po::bool_switch(&fullSamples),
                 "Print alternate format for latency samples that includes "
                 "timestamps for each of the samples.");
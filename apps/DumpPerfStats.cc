@@ -25,6 +25,9 @@ namespace po = boost::program_options;
 #include "Cycles.h"
 #include "PerfStats.h"
 #include "RamCloud.h"
+#include "RpcCacheStats.h"
+#include "RpcLatencyStats.h"
+#include "TableUsageStats.h"
 
 using namespace RAMCloud;
 
@@ -37,6 +40,15 @@ class StatDumper {
         , stats()
         , currentStats{&stats[1]}
         , previousStats{&stats[0]}
+        , latencies()
+        , currentLatencies{&latencies[1]}
+        , previousLatencies{&latencies[0]}
+        , cacheStats()
+        , currentCacheStats{&cacheStats[1]}
+        , previousCacheStats{&cacheStats[0]}
+        , usage()
+        , currentUsage{&usage[1]}
+        , previousUsage{&usage[0]}
     {
     }
 
@@ -64,6 +76,26 @@ class StatDumper {
         printf("%s\n",
            PerfStats::printClusterStats(previousStats, currentStats).c_str());
 
+        std::swap(currentLatencies, previousLatencies);
+        ramcloud.serverControlAll(
+            WireFormat::ControlOp::GET_RPC_LATENCIES, NULL, 0,
+            currentLatencies);
+        printf("%s\n", RpcLatencyStats::printClusterLatencies(
+            previousLatencies, currentLatencies).c_str());
+
+        std::swap(currentCacheStats, previousCacheStats);
+        ramcloud.serverControlAll(
+            WireFormat::ControlOp::GET_RPC_CACHE_STATS, NULL, 0,
+            currentCacheStats);
+        printf("%s\n", RpcCacheStats::printClusterCacheStats(
+            previousCacheStats, currentCacheStats).c_str());
+
+        std::swap(currentUsage, previousUsage);
+        ramcloud.serverControlAll(
+            WireFormat::ControlOp::GET_TABLE_USAGE, NULL, 0, currentUsage);
+        printf("%s\n", TableUsageStats::printClusterUsage(
+            previousUsage, currentUsage).c_str());
+
         merge();
     }
 
@@ -81,6 +113,21 @@ class StatDumper {
     Buffer* currentStats;
     Buffer* previousStats;
 
+    // Same as above, for GET_RPC_LATENCIES.
+    Buffer latencies[2];
+    Buffer* currentLatencies;
+    Buffer* previousLatencies;
+
+    // Same as above, for GET_RPC_CACHE_STATS.
+    Buffer cacheStats[2];
+    Buffer* currentCacheStats;
+    Buffer* previousCacheStats;
+
+    // Same as above, for GET_TABLE_USAGE.
+    Buffer usage[2];
+    Buffer* currentUsage;
+    Buffer* previousUsage;
+
     DISALLOW_COPY_AND_ASSIGN(StatDumper);
 };
 
@@ -0,0 +1,1247 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * A memcached frontend for RAMCloud, so that existing memcached clients can
+ * use a RAMCloud cluster without being changed. It speaks both the text and
+ * the binary memcached protocols and stores every item as an object in a
+ * single table.
+ *
+ * Connections are spread over a few worker threads, each with a RamCloud
+ * client of its own. Whenever a connection has several requests waiting
+ * (a multi-key get, a run of GETKQs, a pipeline of sets...), consecutive
+ * requests of the same kind are sent to RAMCloud as a single multiRead,
+ * multiWrite or multiRemove, so that batches cost one round trip to each
+ * master rather than one per item.
+ */
+
+#include <endian.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+#include <unordered_set>
+
+#include "ClientException.h"
+#include "Common.h"
+#include "OptionParser.h"
+#include "RamCloud.h"
+#include "ShortMacros.h"
+
+using namespace RAMCloud;
+
+namespace {
+
+/// Magic bytes that start binary protocol requests and responses.
+enum {
+    BINARY_REQUEST = 0x80,
+    BINARY_RESPONSE = 0x81,
+};
+
+/// Binary protocol opcodes that are supported.
+enum BinaryOpcode {
+    OP_GET = 0x00,
+    OP_SET = 0x01,
+    OP_ADD = 0x02,
+    OP_REPLACE = 0x03,
+    OP_DELETE = 0x04,
+    OP_QUIT = 0x07,
+    OP_GETQ = 0x09,
+    OP_NOOP = 0x0a,
+    OP_VERSION = 0x0b,
+    OP_GETK = 0x0c,
+    OP_GETKQ = 0x0d,
+    OP_SETQ = 0x11,
+    OP_ADDQ = 0x12,
+    OP_REPLACEQ = 0x13,
+    OP_DELETEQ = 0x14,
+    OP_QUITQ = 0x17,
+};
+
+/// Binary protocol response statuses.
+enum BinaryStatus {
+    BIN_OK = 0x00,
+    BIN_KEY_NOT_FOUND = 0x01,
+    BIN_KEY_EXISTS = 0x02,
+    BIN_VALUE_TOO_LARGE = 0x03,
+    BIN_INVALID_ARGUMENTS = 0x04,
+    BIN_UNKNOWN_COMMAND = 0x81,
+    BIN_INTERNAL_ERROR = 0x84,
+};
+
+/// The header of every binary protocol packet; all fields are big-endian.
+struct BinaryHeader {
+    uint8_t magic;
+    uint8_t opcode;
+    uint16_t keyLength;
+    uint8_t extrasLength;
+    uint8_t dataType;
+    uint16_t status;            ///< vbucket id in requests.
+    uint32_t totalBodyLength;   ///< Extras, key and value.
+    uint32_t opaque;            ///< Echoed back in the response.
+    uint64_t cas;
+} __attribute__((packed));
+static_assert(sizeof(BinaryHeader) == 24, "BinaryHeader must be 24 bytes");
+
+/// Memcached reads expiration times larger than this as absolute Unix
+/// times rather than as a number of seconds from now.
+const uint32_t MAX_RELATIVE_EXPIRATION = 60 * 60 * 24 * 30;
+
+/// Longest key memcached accepts.
+const size_t MAX_KEY_LENGTH = 250;
+
+/// Longest text protocol command line accepted (not counting data blocks).
+const size_t MAX_LINE_LENGTH = 2048;
+
+/// Reported by the version command.
+const char VERSION[] = "1.4.0-ramcloud";
+
+/// Configuration shared by all of the workers.
+struct Config {
+    uint64_t tableId;       ///< Table that holds all of the items.
+    uint32_t maxValueLength;    ///< Larger items are refused.
+    uint32_t maxBatch;          ///< Most items per multi-op.
+};
+
+/**
+ * One request from a client, parsed from either protocol.
+ */
+struct Command {
+    enum Kind { GET, STORE, DELETE, NOOP, VERSION, QUIT, ERROR };
+    enum Mode { SET, ADD, REPLACE, CAS };
+
+    Command()
+        : kind(ERROR), mode(SET), binary(false), opcode(0), opaque(0)
+        , quiet(false), withKey(false), withCas(false), lastKey(false)
+        , key(), value(), expiration(0), cas(0), error()
+        , errorStatus(BIN_UNKNOWN_COMMAND)
+    {}
+
+    Kind kind;
+    Mode mode;          ///< Which storage command, for STORE.
+    bool binary;        ///< Came in through the binary protocol.
+    uint8_t opcode;     ///< Binary opcode, echoed in the response.
+    uint32_t opaque;    ///< Binary opaque value, echoed in the response.
+    bool quiet;         ///< Binary "Q" opcodes and text "noreply": leave
+                        ///< out responses for the common case.
+    bool withKey;       ///< Binary GETK(Q): return the key as well.
+    bool withCas;       ///< Text "gets": return cas values.
+    bool lastKey;       ///< Text get: the last key, so send "END" after it.
+    string key;
+    string value;       ///< For STORE: the item's 32-bit flags, in host
+                        ///< order, followed by its data; this is what is
+                        ///< stored in RAMCloud.
+    uint32_t expiration;    ///< For STORE: memcached exptime; 0 means never.
+    uint64_t cas;       ///< For CAS: the version the item must have.
+    string error;       ///< For ERROR: text response, or binary message.
+    BinaryStatus errorStatus;   ///< For binary ERRORs.
+};
+
+/**
+ * The result of executing a Command, in memcached terms.
+ */
+enum Outcome {
+    OK,             ///< Stored, deleted or found.
+    NOT_FOUND,
+    EXISTS,         ///< CAS version mismatch.
+    NOT_STORED,     ///< ADD of an existing item or REPLACE of a missing one.
+    SERVER_ERROR,
+};
+
+/**
+ * A client connection and its buffered input and output.
+ */
+struct Connection {
+    explicit Connection(int fd)
+        : fd(fd), input(), output(), outputStart(0), closing(false)
+    {}
+    ~Connection()
+    {
+        close(fd);
+    }
+
+    int fd;
+    string input;           ///< Received and not yet parsed.
+    string output;          ///< Responses not yet sent.
+    size_t outputStart;     ///< Bytes of #output already sent.
+    bool closing;           ///< Close once #output has been sent.
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+/**
+ * Split a text command line into its space-separated tokens.
+ */
+std::vector<string>
+tokenize(const char* line, size_t length)
+{
+    std::vector<string> tokens;
+    size_t i = 0;
+    while (i < length) {
+        while (i < length && line[i] == ' ')
+            i++;
+        size_t start = i;
+        while (i < length && line[i] != ' ')
+            i++;
+        if (i > start)
+            tokens.emplace_back(line + start, i - start);
+    }
+    return tokens;
+}
+
+/**
+ * Parse a decimal number from a text command line.
+ *
+ * \return
+ *      False if \a token isn't a number or doesn't fit in \a result.
+ */
+template<typename T>
+bool
+parseNumber(const string& token, T* result)
+{
+    char* end;
+    errno = 0;
+    unsigned long long value = strtoull(token.c_str(), &end, 10);
+    if (token.empty() || *end != '\0' || errno != 0 || token[0] == '-' ||
+            value > std::numeric_limits<T>::max()) {
+        return false;
+    }
+    *result = static_cast<T>(value);
+    return true;
+}
+
+/**
+ * Turn a memcached expiration time into a RAMCloud TTL in seconds.
+ */
+uint32_t
+expirationToTtl(uint32_t expiration)
+{
+    if (expiration <= MAX_RELATIVE_EXPIRATION)
+        return expiration;
+    time_t now = time(NULL);
+    // Already expired: the shortest TTL there is.
+    if (expiration <= now)
+        return 1;
+    return static_cast<uint32_t>(expiration - now);
+}
+
+/**
+ * Prepend an item's flags to its data, in the form items are stored in.
+ */
+string
+encodeItem(uint32_t flags, const char* data, size_t length)
+{
+    string item(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    item.append(data, length);
+    return item;
+}
+
+/**
+ * Handles all of the requests on a set of connections, using a RamCloud
+ * client of its own.
+ */
+class Worker {
+  public:
+    Worker(CommandLineOptions* options, const Config& config);
+    ~Worker();
+    void addConnection(int fd);
+    void main();
+
+  PRIVATE:
+    bool parse(Connection* connection, std::vector<Command>* commands);
+    size_t parseText(Connection* connection, size_t start,
+                     std::vector<Command>* commands);
+    size_t parseBinary(Connection* connection, size_t start,
+                       std::vector<Command>* commands);
+    void execute(Connection* connection, std::vector<Command>* commands);
+    void executeGets(Connection* connection, Command* commands,
+                     size_t count);
+    void executeStores(Connection* connection, Command* commands,
+                       size_t count);
+    void executeDeletes(Connection* connection, Command* commands,
+                        size_t count);
+    void respond(Connection* connection, const Command& command,
+                 Outcome outcome, const char* item = NULL,
+                 uint32_t itemLength = 0, uint64_t version = 0,
+                 Status status = STATUS_OK);
+    void respondBinary(Connection* connection, const Command& command,
+                       BinaryStatus status, const void* extras,
+                       uint8_t extrasLength, bool withKey, const char* value,
+                       uint32_t valueLength, uint64_t cas);
+    bool readInput(Connection* connection);
+    bool writeOutput(Connection* connection);
+
+    /// This worker's own connection to the cluster.
+    RamCloud ramcloud;
+
+    /// Settings shared with the other workers.
+    const Config config;
+
+    /// New connections are handed to this worker by writing their file
+    /// descriptors to notifyPipe[1].
+    int notifyPipe[2];
+
+    /// Connections this worker looks after.
+    std::vector<Connection*> connections;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+/**
+ * Construct a Worker; its thread is started separately with main().
+ *
+ * \param options
+ *      How to reach the cluster.
+ * \param config
+ *      Settings shared by all workers.
+ */
+Worker::Worker(CommandLineOptions* options, const Config& config)
+    : ramcloud(options)
+    , config(config)
+    , notifyPipe()
+    , connections()
+{
+    if (pipe(notifyPipe) != 0)
+        DIE("Couldn't create notification pipe: %s", strerror(errno));
+}
+
+Worker::~Worker()
+{
+    foreach (Connection* connection, connections)
+        delete connection;
+    close(notifyPipe[0]);
+    close(notifyPipe[1]);
+}
+
+/**
+ * Hand a newly accepted connection to this worker. May be called from any
+ * thread.
+ */
+void
+Worker::addConnection(int fd)
+{
+    if (write(notifyPipe[1], &fd, sizeof(fd)) != sizeof(fd)) {
+        LOG(WARNING, "Couldn't hand connection to worker: %s",
+            strerror(errno));
+        close(fd);
+    }
+}
+
+/**
+ * The worker's thread: waits for input on its connections and handles it,
+ * forever.
+ */
+void
+Worker::main()
+{
+    std::vector<pollfd> pollFds;
+    while (true) {
+        pollFds.clear();
+        pollFds.push_back({notifyPipe[0], POLLIN, 0});
+        foreach (Connection* connection, connections) {
+            short events = 0;
+            // Stop reading from clients that don't read their responses.
+            if (connection->output.size() < (1 << 20) && !connection->closing)
+                events |= POLLIN;
+            if (connection->outputStart < connection->output.size())
+                events |= POLLOUT;
+            pollFds.push_back({connection->fd, events, 0});
+        }
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            DIE("poll failed: %s", strerror(errno));
+        }
+
+        std::vector<Command> commands;
+        for (size_t i = 1; i < pollFds.size(); i++) {
+            Connection* connection = connections[i - 1];
+            bool alive = true;
+            if (pollFds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                alive = readInput(connection);
+                commands.clear();
+                if (alive && !parse(connection, &commands))
+                    connection->closing = true;
+                execute(connection, &commands);
+            }
+            if (alive)
+                alive = writeOutput(connection);
+            if (!alive) {
+                delete connection;
+                connections[i - 1] = NULL;
+            }
+        }
+        connections.erase(std::remove(connections.begin(), connections.end(),
+                static_cast<Connection*>(NULL)), connections.end());
+
+        if (pollFds[0].revents & POLLIN) {
+            int fd;
+            if (read(notifyPipe[0], &fd, sizeof(fd)) == sizeof(fd))
+                connections.push_back(new Connection(fd));
+        }
+    }
+}
+
+/**
+ * Read whatever input is available on a connection.
+ *
+ * \return
+ *      False if the connection has been closed or has failed.
+ */
+bool
+Worker::readInput(Connection* connection)
+{
+    char buffer[16384];
+    while (true) {
+        ssize_t count = recv(connection->fd, buffer, sizeof(buffer),
+                             MSG_DONTWAIT);
+        if (count > 0) {
+            connection->input.append(buffer, count);
+            if (count < static_cast<ssize_t>(sizeof(buffer)))
+                return true;
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            return false;
+        // The client closed its end: answer what it sent, then close.
+        connection->closing = true;
+        return true;
+    }
+}
+
+/**
+ * Send as much pending output on a connection as the socket will take.
+ *
+ * \return
+ *      False if the connection should be closed now.
+ */
+bool
+Worker::writeOutput(Connection* connection)
+{
+    while (connection->outputStart < connection->output.size()) {
+        ssize_t count = send(connection->fd,
+                connection->output.data() + connection->outputStart,
+                connection->output.size() - connection->outputStart,
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        connection->outputStart += count;
+    }
+    connection->output.clear();
+    connection->outputStart = 0;
+    return !connection->closing;
+}
+
+/**
+ * Parse all of the complete requests in a connection's input, leaving any
+ * incomplete one there for later.
+ *
+ * \param connection
+ *      Connection whose input is parsed.
+ * \param[out] commands
+ *      Parsed requests are appended here.
+ * \return
+ *      False if the input is garbled beyond recovery; the connection
+ *      should be closed after responding to \a commands.
+ */
+bool
+Worker::parse(Connection* connection, std::vector<Command>* commands)
+{
+    size_t start = 0;
+    bool ok = true;
+    while (start < connection->input.size()) {
+        size_t consumed;
+        // The binary protocol is told apart by the magic byte that starts
+        // every request, just as memcached does it.
+        if (static_cast<uint8_t>(connection->input[start]) == BINARY_REQUEST)
+            consumed = parseBinary(connection, start, commands);
+        else
+            consumed = parseText(connection, start, commands);
+        if (consumed == 0)
+            break;
+        if (consumed == ~0lu) {
+            ok = false;
+            start = connection->input.size();
+            break;
+        }
+        start += consumed;
+    }
+    connection->input.erase(0, start);
+    return ok;
+}
+
+/**
+ * Parse one text protocol request.
+ *
+ * \param connection
+ *      Connection whose input holds the request.
+ * \param start
+ *      Offset of the request in the connection's input.
+ * \param[out] commands
+ *      The request is appended here (several times for a multi-key get).
+ * \return
+ *      The number of bytes consumed, 0 if the request isn't complete yet,
+ *      or ~0 if the input can't be parsed any further.
+ */
+size_t
+Worker::parseText(Connection* connection, size_t start,
+                  std::vector<Command>* commands)
+{
+    const string& input = connection->input;
+    size_t newline = input.find('\n', start);
+    if (newline == string::npos) {
+        if (input.size() - start > MAX_LINE_LENGTH) {
+            Command command;
+            command.error = "CLIENT_ERROR line too long";
+            commands->push_back(command);
+            return ~0lu;
+        }
+        return 0;
+    }
+    size_t lineLength = newline - start;
+    if (lineLength > 0 && input[newline - 1] == '\r')
+        lineLength--;
+    size_t consumed = newline + 1 - start;
+    std::vector<string> tokens = tokenize(input.data() + start, lineLength);
+
+    Command command;
+    if (tokens.empty()) {
+        command.error = "ERROR";
+        commands->push_back(command);
+        return consumed;
+    }
+    const string& name = tokens[0];
+    if (name == "get" || name == "gets") {
+        if (tokens.size() < 2) {
+            command.error = "ERROR";
+            commands->push_back(command);
+            return consumed;
+        }
+        for (size_t i = 1; i < tokens.size(); i++) {
+            if (tokens[i].size() > MAX_KEY_LENGTH) {
+                command.error = "CLIENT_ERROR bad command line format";
+                commands->push_back(command);
+                return consumed;
+            }
+        }
+        command.kind = Command::GET;
+        command.withCas = (name == "gets");
+        for (size_t i = 1; i < tokens.size(); i++) {
+            command.key = tokens[i];
+            command.lastKey = (i == tokens.size() - 1);
+            commands->push_back(command);
+        }
+        return consumed;
+    }
+
+    if (name == "set" || name == "add" || name == "replace" ||
+            name == "cas") {
+        bool isCas = (name == "cas");
+        size_t required = isCas ? 6 : 5;
+        uint32_t flags, length;
+        if (tokens.size() < required || tokens.size() > required + 1 ||
+                tokens[1].size() > MAX_KEY_LENGTH ||
+                !parseNumber(tokens[2], &flags) ||
+                !parseNumber(tokens[3], &command.expiration) ||
+                !parseNumber(tokens[4], &length) ||
+                (isCas && !parseNumber(tokens[5], &command.cas))) {
+            command.error = "CLIENT_ERROR bad command line format";
+            commands->push_back(command);
+            // Without a length the data block can't be skipped.
+            return ~0lu;
+        }
+        if (length > config.maxValueLength) {
+            command.error = "SERVER_ERROR object too large for cache";
+            commands->push_back(command);
+            return ~0lu;
+        }
+        if (input.size() - start < consumed + length + 2)
+            return 0;
+        const char* data = input.data() + start + consumed;
+        consumed += length + 2;
+        if (data[length] != '\r' || data[length + 1] != '\n') {
+            command.error = "CLIENT_ERROR bad data chunk";
+            commands->push_back(command);
+            return ~0lu;
+        }
+        command.kind = Command::STORE;
+        command.mode = isCas ? Command::CAS
+                : (name == "add") ? Command::ADD
+                : (name == "replace") ? Command::REPLACE
+                : Command::SET;
+        command.key = tokens[1];
+        command.value = encodeItem(flags, data, length);
+        command.quiet = (tokens.size() == required + 1 &&
+                         tokens[required] == "noreply");
+        commands->push_back(command);
+        return consumed;
+    }
+
+    if (name == "delete") {
+        // "delete <key> 0" is still accepted by memcached, so allow it.
+        size_t last = tokens.size() - 1;
+        command.quiet = (last >= 2 && tokens[last] == "noreply");
+        if (command.quiet)
+            last--;
+        if (last < 1 || last > 2 || (last == 2 && tokens[2] != "0") ||
+                tokens[1].size() > MAX_KEY_LENGTH) {
+            command.error = "CLIENT_ERROR bad command line format. "
+                    "Usage: delete <key> [noreply]";
+            commands->push_back(command);
+            return consumed;
+        }
+        command.kind = Command::DELETE;
+        command.key = tokens[1];
+        commands->push_back(command);
+        return consumed;
+    }
+
+    if (name == "version") {
+        command.kind = Command::VERSION;
+    } else if (name == "quit") {
+        command.kind = Command::QUIT;
+    } else {
+        command.error = "ERROR";
+    }
+    commands->push_back(command);
+    return consumed;
+}
+
+/**
+ * Parse one binary protocol request. Arguments and result are as for
+ * parseText.
+ */
+size_t
+Worker::parseBinary(Connection* connection, size_t start,
+                    std::vector<Command>* commands)
+{
+    const string& input = connection->input;
+    if (input.size() - start < sizeof(BinaryHeader))
+        return 0;
+    BinaryHeader header;
+    memcpy(&header, input.data() + start, sizeof(header));
+    uint32_t bodyLength = be32toh(header.totalBodyLength);
+    uint16_t keyLength = be16toh(header.keyLength);
+    Command command;
+    command.binary = true;
+    command.opcode = header.opcode;
+    command.opaque = header.opaque;
+    if (bodyLength > config.maxValueLength + 1024) {
+        command.errorStatus = BIN_VALUE_TOO_LARGE;
+        command.error = "Too large";
+        commands->push_back(command);
+        return ~0lu;
+    }
+    if (input.size() - start < sizeof(header) + bodyLength)
+        return 0;
+    size_t consumed = sizeof(header) + bodyLength;
+    if (keyLength + header.extrasLength > bodyLength) {
+        command.errorStatus = BIN_INVALID_ARGUMENTS;
+        command.error = "Invalid arguments";
+        commands->push_back(command);
+        return consumed;
+    }
+    const char* extras = input.data() + start + sizeof(header);
+    const char* key = extras + header.extrasLength;
+    const char* value = key + keyLength;
+    uint32_t valueLength = bodyLength - header.extrasLength - keyLength;
+    command.key.assign(key, keyLength);
+    command.cas = be64toh(header.cas);
+
+    bool valid = true;
+    switch (header.opcode) {
+    case OP_GETQ:
+    case OP_GETKQ:
+        command.quiet = true;
+        // Fall through.
+    case OP_GET:
+    case OP_GETK:
+        command.kind = Command::GET;
+        command.withKey = (header.opcode == OP_GETK ||
+                           header.opcode == OP_GETKQ);
+        valid = (keyLength > 0 && header.extrasLength == 0 &&
+                 valueLength == 0);
+        break;
+    case OP_SETQ:
+    case OP_ADDQ:
+    case OP_REPLACEQ:
+        command.quiet = true;
+        // Fall through.
+    case OP_SET:
+    case OP_ADD:
+    case OP_REPLACE: {
+        valid = (keyLength > 0 && header.extrasLength == 8);
+        if (!valid)
+            break;
+        uint32_t flags, expiration;
+        memcpy(&flags, extras, sizeof(flags));
+        memcpy(&expiration, extras + 4, sizeof(expiration));
+        command.kind = Command::STORE;
+        command.expiration = be32toh(expiration);
+        command.value = encodeItem(be32toh(flags), value, valueLength);
+        if (header.opcode == OP_ADD || header.opcode == OP_ADDQ)
+            command.mode = Command::ADD;
+        else if (header.opcode == OP_REPLACE || header.opcode == OP_REPLACEQ)
+            command.mode = (command.cas != 0) ? Command::CAS
+                                              : Command::REPLACE;
+        else
+            command.mode = (command.cas != 0) ? Command::CAS : Command::SET;
+        break;
+    }
+    case OP_DELETEQ:
+        command.quiet = true;
+        // Fall through.
+    case OP_DELETE:
+        command.kind = Command::DELETE;
+        valid = (keyLength > 0 && header.extrasLength == 0 &&
+                 valueLength == 0);
+        break;
+    case OP_NOOP:
+        command.kind = Command::NOOP;
+        break;
+    case OP_VERSION:
+        command.kind = Command::VERSION;
+        break;
+    case OP_QUITQ:
+        command.quiet = true;
+        // Fall through.
+    case OP_QUIT:
+        command.kind = Command::QUIT;
+        break;
+    default:
+        command.errorStatus = BIN_UNKNOWN_COMMAND;
+        command.error = "Unknown command";
+        break;
+    }
+    if (!valid || keyLength > MAX_KEY_LENGTH) {
+        command.kind = Command::ERROR;
+        command.errorStatus = BIN_INVALID_ARGUMENTS;
+        command.error = "Invalid arguments";
+    }
+    commands->push_back(command);
+    return consumed;
+}
+
+/**
+ * Execute a connection's requests in order, batching runs of consecutive
+ * gets, stores and deletes into multi-ops, and queue the responses.
+ */
+void
+Worker::execute(Connection* connection, std::vector<Command>* commands)
+{
+    size_t i = 0;
+    while (i < commands->size()) {
+        Command* first = &(*commands)[i];
+        size_t count = 1;
+        if (first->kind == Command::STORE || first->kind == Command::DELETE) {
+            // Items with TTLs are written one at a time, since multiWrite
+            // can't set TTLs. A key that repeats ends the batch, as the
+            // order of updates within a multi-op isn't defined.
+            std::unordered_set<string> keys;
+            keys.insert(first->key);
+            while (first->expiration == 0 && i + count < commands->size() &&
+                    count < config.maxBatch) {
+                const Command& next = (*commands)[i + count];
+                if (next.kind != first->kind || next.expiration != 0 ||
+                        !keys.insert(next.key).second) {
+                    break;
+                }
+                count++;
+            }
+        } else if (first->kind == Command::GET) {
+            while (i + count < commands->size() && count < config.maxBatch &&
+                    (*commands)[i + count].kind == Command::GET) {
+                count++;
+            }
+        }
+
+        switch (first->kind) {
+        case Command::GET:
+            executeGets(connection, first, count);
+            break;
+        case Command::STORE:
+            executeStores(connection, first, count);
+            break;
+        case Command::DELETE:
+            executeDeletes(connection, first, count);
+            break;
+        case Command::QUIT:
+            connection->closing = true;
+            if (first->binary && !first->quiet)
+                respond(connection, *first, OK);
+            // Whatever follows a quit is ignored.
+            return;
+        default:
+            respond(connection, *first, OK);
+            break;
+        }
+        i += count;
+    }
+}
+
+/**
+ * Read the items for a batch of gets with one multiRead.
+ */
+void
+Worker::executeGets(Connection* connection, Command* commands, size_t count)
+{
+    std::unique_ptr<Tub<ObjectBuffer>[]> values(new Tub<ObjectBuffer>[count]);
+    std::vector<MultiReadObject> objects;
+    std::vector<MultiReadObject*> requests;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        objects.emplace_back(config.tableId, commands[i].key.data(),
+                downCast<uint16_t>(commands[i].key.size()), &values[i]);
+        requests.push_back(&objects.back());
+    }
+    try {
+        ramcloud.multiRead(requests.data(), downCast<uint32_t>(count));
+    } catch (ClientException& e) {
+        for (size_t i = 0; i < count; i++)
+            objects[i].status = e.status;
+    }
+    for (size_t i = 0; i < count; i++) {
+        Status status = objects[i].status;
+        if (status == STATUS_OK) {
+            uint32_t length;
+            const char* item = static_cast<const char*>(
+                    values[i]->getValue(&length));
+            respond(connection, commands[i], OK, item, length,
+                    objects[i].version);
+        } else if (status == STATUS_OBJECT_DOESNT_EXIST) {
+            respond(connection, commands[i], NOT_FOUND);
+        } else {
+            respond(connection, commands[i], SERVER_ERROR, NULL, 0, 0,
+                    status);
+        }
+    }
+}
+
+/**
+ * Fill in the RejectRules that give a storage command its meaning.
+ */
+static void
+setRejectRules(const Command& command, RejectRules* rules)
+{
+    memset(rules, 0, sizeof(*rules));
+    switch (command.mode) {
+    case Command::SET:
+        break;
+    case Command::ADD:
+        rules->exists = 1;
+        break;
+    case Command::REPLACE:
+        rules->doesntExist = 1;
+        break;
+    case Command::CAS:
+        rules->doesntExist = 1;
+        rules->versionNeGiven = 1;
+        rules->givenVersion = command.cas;
+        break;
+    }
+}
+
+/**
+ * Translate the status of a write or remove into a memcached outcome.
+ */
+static Outcome
+storeOutcome(const Command& command, Status status)
+{
+    switch (status) {
+    case STATUS_OK:
+        return OK;
+    case STATUS_OBJECT_EXISTS:
+        return NOT_STORED;
+    case STATUS_OBJECT_DOESNT_EXIST:
+        return (command.mode == Command::REPLACE) ? NOT_STORED : NOT_FOUND;
+    case STATUS_WRONG_VERSION:
+        return EXISTS;
+    default:
+        return SERVER_ERROR;
+    }
+}
+
+/**
+ * Write the items for a batch of storage commands with one multiWrite, or
+ * with a single write if the item has a TTL.
+ */
+void
+Worker::executeStores(Connection* connection, Command* commands,
+                      size_t count)
+{
+    std::unique_ptr<RejectRules[]> rules(new RejectRules[count]);
+    for (size_t i = 0; i < count; i++)
+        setRejectRules(commands[i], &rules[i]);
+
+    if (count == 1) {
+        Command& command = commands[0];
+        uint64_t version = 0;
+        Status status = STATUS_OK;
+        try {
+            ramcloud.write(config.tableId, command.key.data(),
+                    downCast<uint16_t>(command.key.size()),
+                    command.value.data(),
+                    downCast<uint32_t>(command.value.size()), &rules[0],
+                    &version, false, expirationToTtl(command.expiration));
+        } catch (ClientException& e) {
+            status = e.status;
+        }
+        respond(connection, command, storeOutcome(command, status), NULL, 0,
+                version, status);
+        return;
+    }
+
+    std::vector<MultiWriteObject> objects;
+    std::vector<MultiWriteObject*> requests;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        objects.emplace_back(config.tableId, commands[i].key.data(),
+                downCast<uint16_t>(commands[i].key.size()),
+                commands[i].value.data(),
+                downCast<uint32_t>(commands[i].value.size()), &rules[i]);
+        requests.push_back(&objects.back());
+    }
+    try {
+        ramcloud.multiWrite(requests.data(), downCast<uint32_t>(count));
+    } catch (ClientException& e) {
+        for (size_t i = 0; i < count; i++)
+            objects[i].status = e.status;
+    }
+    for (size_t i = 0; i < count; i++) {
+        respond(connection, commands[i],
+                storeOutcome(commands[i], objects[i].status), NULL, 0,
+                objects[i].version, objects[i].status);
+    }
+}
+
+/**
+ * Remove the items for a batch of deletes with one multiRemove.
+ */
+void
+Worker::executeDeletes(Connection* connection, Command* commands,
+                       size_t count)
+{
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.doesntExist = 1;
+    std::vector<MultiRemoveObject> objects;
+    std::vector<MultiRemoveObject*> requests;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        objects.emplace_back(config.tableId, commands[i].key.data(),
+                downCast<uint16_t>(commands[i].key.size()), &rules);
+        requests.push_back(&objects.back());
+    }
+    try {
+        ramcloud.multiRemove(requests.data(), downCast<uint32_t>(count));
+    } catch (ClientException& e) {
+        for (size_t i = 0; i < count; i++)
+            objects[i].status = e.status;
+    }
+    for (size_t i = 0; i < count; i++) {
+        respond(connection, commands[i],
+                storeOutcome(commands[i], objects[i].status), NULL, 0, 0,
+                objects[i].status);
+    }
+}
+
+/**
+ * Queue the response to a request.
+ *
+ * \param connection
+ *      Where the response goes.
+ * \param command
+ *      The request being responded to.
+ * \param outcome
+ *      How the request went.
+ * \param item
+ *      For a successful get: the item as stored (flags, then data).
+ * \param itemLength
+ *      Length of \a item in bytes.
+ * \param version
+ *      Version of the item read or written; returned as its cas value.
+ * \param status
+ *      For SERVER_ERROR, what went wrong.
+ */
+void
+Worker::respond(Connection* connection, const Command& command,
+                Outcome outcome, const char* item, uint32_t itemLength,
+                uint64_t version, Status status)
+{
+    uint32_t flags = 0;
+    if (item != NULL && itemLength >= sizeof(flags)) {
+        memcpy(&flags, item, sizeof(flags));
+        item += sizeof(flags);
+        itemLength -= downCast<uint32_t>(sizeof(flags));
+    }
+
+    if (command.binary) {
+        if (command.kind == Command::ERROR) {
+            respondBinary(connection, command, command.errorStatus, NULL, 0,
+                          false, command.error.data(),
+                          downCast<uint32_t>(command.error.size()), 0);
+            return;
+        }
+        if (outcome == SERVER_ERROR) {
+            const char* message = statusToString(status);
+            respondBinary(connection, command, BIN_INTERNAL_ERROR, NULL, 0,
+                          false, message, downCast<uint32_t>(strlen(message)),
+                          0);
+            return;
+        }
+        if (outcome == OK && command.quiet)
+            return;
+        switch (command.kind) {
+        case Command::GET:
+            if (outcome == OK) {
+                uint32_t networkFlags = htobe32(flags);
+                respondBinary(connection, command, BIN_OK, &networkFlags,
+                              sizeof(networkFlags), command.withKey, item,
+                              itemLength, version);
+            } else if (!command.quiet) {
+                respondBinary(connection, command, BIN_KEY_NOT_FOUND, NULL,
+                              0, command.withKey, "Not found", 9, 0);
+            }
+            return;
+        case Command::STORE:
+        case Command::DELETE: {
+            BinaryStatus binaryStatus = BIN_OK;
+            const char* message = "";
+            if (outcome == NOT_FOUND) {
+                binaryStatus = BIN_KEY_NOT_FOUND;
+                message = "Not found";
+            } else if (outcome == EXISTS ||
+                    (outcome == NOT_STORED && command.mode == Command::ADD)) {
+                binaryStatus = BIN_KEY_EXISTS;
+                message = "Data exists for key.";
+            } else if (outcome == NOT_STORED) {
+                // A REPLACE of a missing item.
+                binaryStatus = BIN_KEY_NOT_FOUND;
+                message = "Not found";
+            }
+            respondBinary(connection, command, binaryStatus, NULL, 0, false,
+                          message, downCast<uint32_t>(strlen(message)),
+                          version);
+            return;
+        }
+        case Command::VERSION:
+            respondBinary(connection, command, BIN_OK, NULL, 0, false,
+                          VERSION, sizeof(VERSION) - 1, 0);
+            return;
+        default:
+            respondBinary(connection, command, BIN_OK, NULL, 0, false, NULL,
+                          0, 0);
+            return;
+        }
+    }
+
+    string& output = connection->output;
+    switch (command.kind) {
+    case Command::GET:
+        if (outcome == OK) {
+            if (command.withCas) {
+                output += format("VALUE %s %u %u %lu\r\n",
+                        command.key.c_str(), flags, itemLength, version);
+            } else {
+                output += format("VALUE %s %u %u\r\n", command.key.c_str(),
+                        flags, itemLength);
+            }
+            output.append(item, itemLength);
+            output += "\r\n";
+        }
+        // A key that couldn't be read is left out, like a miss: there is
+        // no way to report an error for one key of a text get.
+        if (command.lastKey)
+            output += "END\r\n";
+        return;
+    case Command::STORE:
+    case Command::DELETE:
+        if (command.quiet)
+            return;
+        switch (outcome) {
+        case OK:
+            output += (command.kind == Command::STORE) ? "STORED\r\n"
+                                                       : "DELETED\r\n";
+            break;
+        case NOT_FOUND:
+            output += "NOT_FOUND\r\n";
+            break;
+        case EXISTS:
+            output += "EXISTS\r\n";
+            break;
+        case NOT_STORED:
+            output += "NOT_STORED\r\n";
+            break;
+        case SERVER_ERROR:
+            output += format("SERVER_ERROR %s\r\n", statusToString(status));
+            break;
+        }
+        return;
+    case Command::VERSION:
+        output += format("VERSION %s\r\n", VERSION);
+        return;
+    case Command::ERROR:
+        output += command.error + "\r\n";
+        return;
+    default:
+        return;
+    }
+}
+
+/**
+ * Queue a binary protocol response.
+ *
+ * \param connection
+ *      Where the response goes.
+ * \param command
+ *      The request being responded to.
+ * \param status
+ *      Response status.
+ * \param extras
+ *      Extras to return, if any.
+ * \param extrasLength
+ *      Bytes in \a extras.
+ * \param withKey
+ *      Return the request's key as well.
+ * \param value
+ *      Value (or error message) to return, if any.
+ * \param valueLength
+ *      Bytes in \a value.
+ * \param cas
+ *      Cas value for the response.
+ */
+void
+Worker::respondBinary(Connection* connection, const Command& command,
+                      BinaryStatus status, const void* extras,
+                      uint8_t extrasLength, bool withKey, const char* value,
+                      uint32_t valueLength, uint64_t cas)
+{
+    uint16_t keyLength = withKey ? downCast<uint16_t>(command.key.size()) : 0;
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BINARY_RESPONSE;
+    header.opcode = command.opcode;
+    header.keyLength = htobe16(keyLength);
+    header.extrasLength = extrasLength;
+    header.status = htobe16(static_cast<uint16_t>(status));
+    header.totalBodyLength = htobe32(extrasLength + keyLength + valueLength);
+    header.opaque = command.opaque;
+    header.cas = htobe64(cas);
+    string& output = connection->output;
+    output.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.append(static_cast<const char*>(extras), extrasLength);
+    output.append(command.key.data(), keyLength);
+    output.append(value, valueLength);
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char *argv[])
+try
+{
+    int port = 11211;
+    int numWorkers = 4;
+    string tableName = "memcached";
+    uint32_t serverSpan = 1;
+    Config config;
+    config.maxValueLength = 1 << 20;
+    config.maxBatch = 64;
+
+    OptionsDescription proxyOptions("MemcachedProxy");
+    proxyOptions.add_options()
+        ("port,p",
+         ProgramOptions::value<int>(&port),
+         "TCP port to accept memcached connections on.")
+        ("threads,t",
+         ProgramOptions::value<int>(&numWorkers),
+         "Number of worker threads, each with its own RAMCloud client.")
+        ("table",
+         ProgramOptions::value<string>(&tableName),
+         "Table that holds the items; it is created if it doesn't exist.")
+        ("serverSpan",
+         ProgramOptions::value<uint32_t>(&serverSpan),
+         "Number of servers to spread the table across, if it is created.")
+        ("maxValueLength",
+         ProgramOptions::value<uint32_t>(&config.maxValueLength),
+         "Items with more data than this many bytes are refused.")
+        ("maxBatch",
+         ProgramOptions::value<uint32_t>(&config.maxBatch),
+         "Most items sent to RAMCloud in one multi-op.");
+
+    OptionParser optionParser(proxyOptions, argc, argv);
+    if (numWorkers < 1 || config.maxBatch < 1) {
+        fprintf(stderr, "Error: threads and maxBatch must be positive\n");
+        exit(1);
+    }
+    {
+        RamCloud ramcloud(&optionParser.options);
+        config.tableId = ramcloud.createTable(tableName.c_str(), serverSpan);
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(downCast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address),
+            sizeof(address)) != 0 || listen(listener, 1024) != 0) {
+        DIE("Couldn't listen on port %d: %s", port, strerror(errno));
+    }
+
+    std::vector<Worker*> workers;
+    for (int i = 0; i < numWorkers; i++) {
+        workers.push_back(new Worker(&optionParser.options, config));
+        std::thread(&Worker::main, workers.back()).detach();
+    }
+    LOG(NOTICE, "Serving memcached clients on port %d from table %s "
+        "(id %lu) with %d workers", port, tableName.c_str(), config.tableId,
+        numWorkers);
+
+    for (size_t next = 0; ; next = (next + 1) % workers.size()) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED)
+                LOG(WARNING, "accept failed: %s", strerror(errno));
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        workers[next]->addConnection(fd);
+    }
+} catch (const ClientException& e) {
+    LOG(ERROR, "RAMCloud exception: %s\n", e.str().c_str());
+    return 1;
+} catch (const Exception& e) {
+    LOG(ERROR, "RAMCloud exception: %s\n", e.str().c_str());
+    return 1;
+}
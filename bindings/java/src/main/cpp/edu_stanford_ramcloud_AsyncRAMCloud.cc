@@ -0,0 +1,323 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <RamCloud.h>
+#include <Cycles.h>
+
+#include "edu_stanford_ramcloud_AsyncRAMCloud.h"
+#include "JavaCommon.h"
+
+using namespace RAMCloud;
+
+/**
+ * One read or write started by cppPoll and not yet reported back to Java.
+ * The key and value are copies, since the RPCs refer to them until they
+ * complete.
+ */
+struct AsyncOperation {
+    AsyncOperation()
+        : id(0)
+        , key()
+        , value()
+        , rejectRules()
+        , readValue()
+        , readRpc()
+        , writeRpc()
+        , status(STATUS_OK)
+        , failed(false)
+        , finished(false)
+        , version(0)
+    {}
+
+    /// Identifies the operation to Java.
+    uint64_t id;
+    string key;
+    string value;
+    RejectRules rejectRules;
+
+    /// The value of a read object.
+    Buffer readValue;
+    Tub<ReadRpc> readRpc;
+    Tub<WriteRpc> writeRpc;
+
+    /// Why the operation failed, if #failed.
+    Status status;
+
+    /// True if the operation failed before its RPC could complete.
+    bool failed;
+
+    /// True once finish has collected the result into #status and
+    /// #version.
+    bool finished;
+
+    /// The version of the object, once #finished.
+    uint64_t version;
+
+    /**
+     * Returns true once the operation's RPC has completed (or failed).
+     */
+    bool
+    isReady()
+    {
+        if (failed)
+            return true;
+        try {
+            return readRpc ? readRpc->isReady() : writeRpc->isReady();
+        } catch (ClientException& e) {
+            status = e.status;
+            failed = true;
+            return true;
+        }
+    }
+
+    /**
+     * Collect the result of an operation for which isReady returned true
+     * into #status and #version (and #readValue, for reads).
+     */
+    void
+    finish()
+    {
+        if (finished)
+            return;
+        finished = true;
+        if (failed)
+            return;
+        try {
+            if (readRpc) {
+                readRpc->wait(&version);
+            } else {
+                writeRpc->wait(&version);
+            }
+        } catch (ClientException& e) {
+            status = e.status;
+        }
+    }
+};
+
+/**
+ * The C++ side of a Java AsyncRAMCloud. It has a RamCloud object of its
+ * own, used only by the Java poller thread that created it.
+ */
+struct AsyncClient {
+    AsyncClient(const char* locator, const char* clusterName)
+        : ramcloud(locator, clusterName)
+        , active()
+    {}
+
+    ~AsyncClient()
+    {
+        for (size_t i = 0; i < active.size(); i++)
+            delete active[i];
+    }
+
+    RamCloud ramcloud;
+
+    /// Operations whose RPCs have been started, in no particular order.
+    std::vector<AsyncOperation*> active;
+};
+
+/**
+ * Gets the pointer to the memory region the specified ByteBuffer points to.
+ *
+ * \param env
+ *      The current JNI environment.
+ * \param jAsyncRamCloud
+ *      The calling class.
+ * \param jByteBuffer
+ *      The java.nio.ByteBuffer object, created with
+ *      ByteBuffer.allocateDirect(), to retrieve a pointer for.
+ * \return A pointer, as a Java long, to the memory region allocated for the
+ *      specified ByteBuffer.
+ */
+JNIEXPORT jlong
+JNICALL Java_edu_stanford_ramcloud_AsyncRAMCloud_cppGetByteBufferPointer(
+        JNIEnv *env,
+        jclass jAsyncRamCloud,
+        jobject jByteBuffer) {
+    return reinterpret_cast<jlong>(env->GetDirectBufferAddress(jByteBuffer));
+}
+
+/**
+ * Create the AsyncClient for an AsyncRAMCloud. This must be called on the
+ * thread that will call cppPoll.
+ *
+ * \param env
+ *      The current JNI environment.
+ * \param jAsyncRamCloud
+ *      The calling class.
+ * \param byteBufferPointer
+ *      A pointer to the ByteBuffer through which Java and C++ will communicate.
+ *      The format for the input buffer is:
+ *          4 bytes for length of cluster locator string
+ *          NULL-terminated string for cluster locator
+ *          NULL-terminated string for cluster name
+ *      The format for the output buffer is:
+ *          4 bytes for status code of the RamCloud constructor
+ *          8 bytes for a pointer to the created AsyncClient object
+ */
+JNIEXPORT void
+JNICALL Java_edu_stanford_ramcloud_AsyncRAMCloud_cppConnect(
+        JNIEnv *env,
+        jclass jAsyncRamCloud,
+        jlong byteBufferPointer) {
+    ByteBuffer buffer(byteBufferPointer);
+    uint32_t locatorLength = buffer.read<uint32_t>();
+    char* locator = buffer.pointer + buffer.mark;
+    buffer.mark += 1 + locatorLength;
+    char* name = buffer.pointer + buffer.mark;
+
+    AsyncClient* client = NULL;
+    buffer.rewind();
+    try {
+        client = new AsyncClient(locator, name);
+    } EXCEPTION_CATCHER(buffer);
+    buffer.write(reinterpret_cast<uint64_t>(client));
+}
+
+/**
+ * Destroy an AsyncClient, abandoning any operations still in progress.
+ *
+ * \param env
+ *      The current JNI environment.
+ * \param jAsyncRamCloud
+ *      The calling class.
+ * \param clientHandle
+ *      A pointer to the AsyncClient.
+ */
+JNIEXPORT void
+JNICALL Java_edu_stanford_ramcloud_AsyncRAMCloud_cppDisconnect(
+        JNIEnv *env,
+        jclass jAsyncRamCloud,
+        jlong clientHandle) {
+    delete reinterpret_cast<AsyncClient*>(clientHandle);
+}
+
+/**
+ * Start the RPCs for newly submitted operations, then run the RamCloud
+ * event loop until at least one operation has completed (or a time limit
+ * has passed), and report all of the completed operations that fit in the
+ * buffer. Operations that don't fit are reported by the next call.
+ *
+ * \param env
+ *      The current JNI environment.
+ * \param jAsyncRamCloud
+ *      The calling class.
+ * \param byteBufferPointer
+ *      A pointer to the ByteBuffer through which Java and C++ will communicate.
+ *      The format for the input buffer is:
+ *          8 bytes for a pointer to a C++ AsyncClient object
+ *          4 bytes for the most microseconds to wait for a completion
+ *          4 bytes for the number of new operations
+ *          For each new operation:
+ *              1 byte for the type: 0 for a read, 1 for a write
+ *              8 bytes for an id for the operation
+ *              8 bytes for the ID of the table
+ *              4 bytes for the length of the key
+ *              byte array for the key
+ *              For writes only:
+ *                  4 bytes for the length of the value
+ *                  byte array for the value
+ *              12 bytes representing the RejectRules
+ *      The format for the output buffer is:
+ *          4 bytes for the number of completed operations
+ *          For each completed operation:
+ *              8 bytes for its id
+ *              4 bytes for its status code
+ *              8 bytes for the version of the object
+ *              4 bytes for the length of the value read (0 for writes and
+ *                  failed reads)
+ *              byte array for the value read
+ */
+JNIEXPORT void
+JNICALL Java_edu_stanford_ramcloud_AsyncRAMCloud_cppPoll(
+        JNIEnv *env,
+        jclass jAsyncRamCloud,
+        jlong byteBufferPointer) {
+    ByteBuffer buffer(byteBufferPointer);
+    AsyncClient* client = buffer.readPointer<AsyncClient>();
+    uint32_t waitMicros = buffer.read<uint32_t>();
+    uint32_t count = buffer.read<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        AsyncOperation* op = new AsyncOperation;
+        uint8_t type = buffer.read<uint8_t>();
+        op->id = buffer.read<uint64_t>();
+        uint64_t tableId = buffer.read<uint64_t>();
+        uint32_t keyLength = buffer.read<uint32_t>();
+        op->key.assign(static_cast<char*>(buffer.getVoidPointer(keyLength)),
+                       keyLength);
+        if (type == 1) {
+            uint32_t valueLength = buffer.read<uint32_t>();
+            op->value.assign(
+                    static_cast<char*>(buffer.getVoidPointer(valueLength)),
+                    valueLength);
+        }
+        op->rejectRules = buffer.read<RejectRules>();
+        try {
+            uint16_t length = static_cast<uint16_t>(op->key.size());
+            if (type == 1) {
+                op->writeRpc.construct(&client->ramcloud, tableId,
+                        op->key.data(), length, op->value.data(),
+                        static_cast<uint32_t>(op->value.size()),
+                        &op->rejectRules);
+            } else {
+                op->readRpc.construct(&client->ramcloud, tableId,
+                        op->key.data(), length, &op->readValue,
+                        &op->rejectRules);
+            }
+        } catch (ClientException& e) {
+            op->status = e.status;
+            op->failed = true;
+        }
+        client->active.push_back(op);
+    }
+
+    buffer.rewind();
+    buffer.mark = 4;
+    uint32_t completions = 0;
+    bool full = false;
+    uint64_t stopTime = Cycles::rdtsc() + Cycles::fromMicroseconds(waitMicros);
+    while (!client->active.empty()) {
+        client->ramcloud.poll();
+        std::vector<AsyncOperation*>& active = client->active;
+        for (size_t i = 0; i < active.size(); ) {
+            AsyncOperation* op = active[i];
+            if (!op->isReady()) {
+                i++;
+                continue;
+            }
+            op->finish();
+            uint32_t valueLength = (op->status == STATUS_OK && op->readRpc)
+                    ? op->readValue.size() : 0;
+            if (buffer.mark + 24 + valueLength > bufferSize) {
+                full = true;
+                break;
+            }
+            buffer.write(op->id);
+            buffer.write(static_cast<uint32_t>(op->status));
+            buffer.write(op->version);
+            buffer.write(valueLength);
+            op->readValue.copy(0, valueLength,
+                               buffer.getVoidPointer(valueLength));
+            completions++;
+            delete op;
+            active[i] = active.back();
+            active.pop_back();
+        }
+        if (full || completions > 0 || Cycles::rdtsc() >= stopTime)
+            break;
+    }
+    buffer.rewind();
+    buffer.write(completions);
+}
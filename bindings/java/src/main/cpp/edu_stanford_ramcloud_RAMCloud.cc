@@ -404,3 +404,125 @@ JNICALL Java_edu_stanford_ramcloud_RAMCloud_cppWrite(JNIEnv *env,
     buffer.write(version);
 }
 
+
+/**
+ * Read the current contents of an object straight into a direct ByteBuffer
+ * supplied by the caller, using a key held in another one.
+ *
+ * \param env
+ *      The current JNI environment.
+ * \param jRamCloud
+ *      The calling class.
+ * \param byteBufferPointer
+ *      A pointer to the ByteBuffer through which Java and C++ will communicate.
+ *      The format for the input buffer is:
+ *          8 bytes for a pointer to a C++ RamCloud object
+ *          8 bytes for the ID of the table to read from
+ *          4 bytes for the offset of the key in jKey
+ *          4 bytes for the length of the key
+ *          4 bytes for the offset in jValue at which to store the value
+ *          4 bytes for the space available there
+ *          12 bytes representing the RejectRules
+ *      The format for the output buffer is:
+ *          4 bytes for the status code of the read operation
+ *          8 bytes for the version of the read object
+ *          4 bytes for the size of the read value; the value is stored in
+ *              jValue only if it fits in the space available
+ * \param jKey
+ *      Direct java.nio.ByteBuffer holding the key.
+ * \param jValue
+ *      Direct java.nio.ByteBuffer in which to store the value.
+ */
+JNIEXPORT void
+JNICALL Java_edu_stanford_ramcloud_RAMCloud_cppReadDirect(
+        JNIEnv *env,
+        jclass jRamCloud,
+        jlong byteBufferPointer,
+        jobject jKey,
+        jobject jValue) {
+    ByteBuffer byteBuffer(byteBufferPointer);
+    RamCloud* ramcloud = byteBuffer.readPointer<RamCloud>();
+    uint64_t tableId = byteBuffer.read<uint64_t>();
+    uint32_t keyOffset = byteBuffer.read<uint32_t>();
+    uint32_t keyLength = byteBuffer.read<uint32_t>();
+    uint32_t valueOffset = byteBuffer.read<uint32_t>();
+    uint32_t valueSpace = byteBuffer.read<uint32_t>();
+    RejectRules rejectRules = byteBuffer.read<RejectRules>();
+    char* key = static_cast<char*>(env->GetDirectBufferAddress(jKey))
+            + keyOffset;
+    char* value = static_cast<char*>(env->GetDirectBufferAddress(jValue))
+            + valueOffset;
+    Buffer buffer;
+    uint64_t version;
+    byteBuffer.rewind();
+    try {
+        ramcloud->read(tableId,
+                       key,
+                       keyLength,
+                       &buffer,
+                       &rejectRules,
+                       &version);
+    } EXCEPTION_CATCHER(byteBuffer);
+    byteBuffer.write(version);
+    byteBuffer.write(buffer.size());
+    if (buffer.size() <= valueSpace)
+        buffer.copy(0, buffer.size(), value);
+}
+
+/**
+ * Replace the value of a given object, or create a new object if none
+ * previously existed, taking the key and value from direct ByteBuffers
+ * supplied by the caller.
+ *
+ * \param env
+ *      The current JNI environment.
+ * \param jRamCloud
+ *      The calling class.
+ * \param byteBufferPointer
+ *      A pointer to the ByteBuffer through which Java and C++ will communicate.
+ *      The format for the input buffer is:
+ *          8 bytes for a pointer to a C++ RamCloud object
+ *          8 bytes for the ID of the table to write to
+ *          4 bytes for the offset of the key in jKey
+ *          4 bytes for the length of the key
+ *          4 bytes for the offset of the value in jValue
+ *          4 bytes for the length of the value
+ *          12 bytes representing the RejectRules
+ *      The format for the output buffer is:
+ *          4 bytes for the status code of the write operation
+ *          8 bytes for the version of the object written
+ * \param jKey
+ *      Direct java.nio.ByteBuffer holding the key.
+ * \param jValue
+ *      Direct java.nio.ByteBuffer holding the value.
+ */
+JNIEXPORT void
+JNICALL Java_edu_stanford_ramcloud_RAMCloud_cppWriteDirect(
+        JNIEnv *env,
+        jclass jRamCloud,
+        jlong byteBufferPointer,
+        jobject jKey,
+        jobject jValue) {
+    ByteBuffer buffer(byteBufferPointer);
+    RamCloud* ramcloud = buffer.readPointer<RamCloud>();
+    uint64_t tableId = buffer.read<uint64_t>();
+    uint32_t keyOffset = buffer.read<uint32_t>();
+    uint32_t keyLength = buffer.read<uint32_t>();
+    uint32_t valueOffset = buffer.read<uint32_t>();
+    uint32_t valueLength = buffer.read<uint32_t>();
+    RejectRules rules = buffer.read<RejectRules>();
+    char* key = static_cast<char*>(env->GetDirectBufferAddress(jKey))
+            + keyOffset;
+    char* value = static_cast<char*>(env->GetDirectBufferAddress(jValue))
+            + valueOffset;
+    uint64_t version;
+    buffer.rewind();
+    try {
+        ramcloud->write(tableId,
+                        key, keyLength,
+                        value, valueLength,
+                        &rules,
+                        &version);
+    } EXCEPTION_CATCHER(buffer);
+    buffer.write(version);
+}
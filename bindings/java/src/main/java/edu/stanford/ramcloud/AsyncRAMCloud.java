@@ -0,0 +1,424 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+package edu.stanford.ramcloud;
+
+import java.nio.*;
+import java.util.HashMap;
+import java.util.concurrent.*;
+
+/**
+ * A non-blocking client for a RAMCloud cluster. Reads and writes return
+ * CompletableFutures at once; the RPCs are issued and completed by a single
+ * poller thread, which spends its time in native code running the C++
+ * ReadRpcs and WriteRpcs of its own RamCloud object. Any number of threads
+ * may submit operations concurrently, so a few of them can keep very many
+ * operations outstanding.
+ *
+ * Futures are completed on the poller thread, so dependent actions attached
+ * with the non-async CompletableFuture methods run there too and delay all
+ * other operations; attach slow ones with the *Async methods instead.
+ */
+public class AsyncRAMCloud implements AutoCloseable {
+    static {
+        Util.loadLibrary("ramcloud_java");
+    }
+
+    private static final int bufferCapacity = 1024 * 1024 * 2;
+
+    /**
+     * How long each native poll may wait, in microseconds, for one of the
+     * outstanding operations to complete before returning to pick up newly
+     * submitted ones.
+     */
+    private static final int pollMicros = 100;
+
+    /**
+     * Operation types, as understood by cppPoll.
+     */
+    private static final byte READ = 0;
+    private static final byte WRITE = 1;
+
+    /**
+     * Bytes cppPoll needs for an operation besides its key and value: type,
+     * id, table id, key length, value length and reject rules.
+     */
+    private static final int operationOverhead = 1 + 8 + 8 + 4 + 4 + 12;
+
+    /**
+     * One read or write, from submission until its future is completed.
+     */
+    private static class Operation {
+        byte type;
+        long tableId;
+        byte[] key;
+        byte[] value;
+        RejectRules rules;
+        CompletableFuture<RAMCloudObject> readResult;
+        CompletableFuture<Long> writeResult;
+
+        /**
+         * Returns the number of bytes the operation takes in byteBuffer.
+         */
+        int size() {
+            return operationOverhead + key.length
+                    + ((value == null) ? 0 : value.length);
+        }
+    }
+
+    /**
+     * Most operations that may be outstanding in native code at once;
+     * further ones wait in #submitted.
+     */
+    private final int maxOutstanding;
+
+    /**
+     * Operations submitted but not yet handed to native code.
+     */
+    private final LinkedBlockingQueue<Operation> submitted =
+            new LinkedBlockingQueue<Operation>();
+
+    /**
+     * Operations handed to native code, by the id they were given then.
+     * Used only by the poller thread.
+     */
+    private final HashMap<Long, Operation> outstanding =
+            new HashMap<Long, Operation>();
+
+    /**
+     * Id for the next operation handed to native code. Used only by the
+     * poller thread.
+     */
+    private long nextId = 1;
+
+    /**
+     * An operation taken from #submitted that didn't fit into the last call
+     * to cppPoll; it goes first in the next one. Used only by the poller
+     * thread.
+     */
+    private Operation carried;
+
+    /**
+     * Set by close; no operations may be submitted afterwards. Protected by
+     * this object's lock.
+     */
+    private boolean closed;
+
+    /**
+     * Shared memory between the poller thread and native code (see
+     * RAMCloud#byteBuffer).
+     */
+    private final ByteBuffer byteBuffer;
+    private final long byteBufferPointer;
+
+    /**
+     * Pointer to the C++ AsyncClient that owns the RamCloud object.
+     */
+    private long clientHandle;
+
+    /**
+     * Completed once the poller thread has connected to the cluster.
+     */
+    private final CompletableFuture<Void> connected =
+            new CompletableFuture<Void>();
+
+    private final Thread poller;
+
+    /**
+     * Connect to a RAMCloud cluster.
+     *
+     * @param locator
+     *            Describes how to locate the coordinator; see
+     *            RAMCloud#RAMCloud(String, String).
+     * @param clusterName
+     *            Name of the cluster; see RAMCloud#RAMCloud(String, String).
+     * @param maxOutstanding
+     *            Most operations that are in progress at once. Operations
+     *            submitted beyond that wait until others complete.
+     */
+    public AsyncRAMCloud(final String locator, final String clusterName,
+                         int maxOutstanding) {
+        this.maxOutstanding = maxOutstanding;
+        byteBuffer = ByteBuffer.allocateDirect(bufferCapacity);
+        byteBuffer.order(ByteOrder.LITTLE_ENDIAN);
+        byteBufferPointer = cppGetByteBufferPointer(byteBuffer);
+        poller = new Thread(new Runnable() {
+            public void run() {
+                pollerMain(locator, clusterName);
+            }
+        }, "RAMCloud poller");
+        poller.setDaemon(true);
+        poller.start();
+        try {
+            connected.join();
+        } catch (CompletionException ex) {
+            throw (RuntimeException) ex.getCause();
+        }
+    }
+
+    /**
+     * Connect to a RAMCloud cluster, with the default cluster name "main"
+     * and at most 100000 operations in progress at once.
+     *
+     * @see #AsyncRAMCloud(String, String, int)
+     */
+    public AsyncRAMCloud(String locator) {
+        this(locator, "main", 100000);
+    }
+
+    /**
+     * Wait for the operations already submitted to complete, then
+     * disconnect from the cluster. Operations may not be submitted
+     * afterwards.
+     */
+    @Override
+    public void close() {
+        synchronized (this) {
+            closed = true;
+        }
+        poller.interrupt();
+        try {
+            poller.join();
+        } catch (InterruptedException ex) {
+            Thread.currentThread().interrupt();
+        }
+    }
+
+    /**
+     * Start reading the current contents of an object.
+     *
+     * @param tableId
+     *            The table containing the desired object (return value from a
+     *            previous call to getTableId).
+     * @param key
+     *            Variable length key that uniquely identifies the object within
+     *            tableId. It must not be changed until the read completes.
+     * @param rules
+     *            If non-NULL, specifies conditions under which the read should
+     *            be aborted with an error.
+     * @return A future for the key, value, and version of the object; it
+     *         completes exceptionally with a ClientException if the read
+     *         fails.
+     */
+    public CompletableFuture<RAMCloudObject> readAsync(long tableId,
+                                                       byte[] key,
+                                                       RejectRules rules) {
+        Operation op = new Operation();
+        op.type = READ;
+        op.tableId = tableId;
+        op.key = key;
+        op.rules = rules;
+        op.readResult = new CompletableFuture<RAMCloudObject>();
+        submit(op);
+        return op.readResult;
+    }
+
+    /**
+     * Start reading the current contents of an object.
+     *
+     * @see #readAsync(long, byte[], edu.stanford.ramcloud.RejectRules)
+     */
+    public CompletableFuture<RAMCloudObject> readAsync(long tableId,
+                                                       String key) {
+        return readAsync(tableId, key.getBytes(), null);
+    }
+
+    /**
+     * Start replacing the value of a given object, or creating a new object
+     * if none previously existed.
+     *
+     * @param tableId
+     *            The table containing the desired object (return value from a
+     *            previous call to getTableId).
+     * @param key
+     *            Variable length key that uniquely identifies the object within
+     *            tableId. It must not be changed until the write completes.
+     * @param value
+     *            The new value for the object. It must not be changed until
+     *            the write completes.
+     * @param rules
+     *            If non-NULL, specifies conditions under which the write should
+     *            be aborted with an error.
+     * @return A future for the new version of the object; it completes
+     *         exceptionally with a ClientException if the write fails.
+     */
+    public CompletableFuture<Long> writeAsync(long tableId, byte[] key,
+                                              byte[] value,
+                                              RejectRules rules) {
+        Operation op = new Operation();
+        op.type = WRITE;
+        op.tableId = tableId;
+        op.key = key;
+        op.value = value;
+        op.rules = rules;
+        op.writeResult = new CompletableFuture<Long>();
+        submit(op);
+        return op.writeResult;
+    }
+
+    /**
+     * Start replacing the value of a given object.
+     *
+     * @see #writeAsync(long, byte[], byte[], edu.stanford.ramcloud.RejectRules)
+     */
+    public CompletableFuture<Long> writeAsync(long tableId, String key,
+                                              String value) {
+        return writeAsync(tableId, key.getBytes(), value.getBytes(), null);
+    }
+
+    /**
+     * Queue an operation for the poller thread.
+     */
+    private void submit(Operation op) {
+        if (op.size() > bufferCapacity - 16) {
+            throw new IllegalArgumentException("object too large");
+        }
+        synchronized (this) {
+            if (closed) {
+                throw new IllegalStateException("AsyncRAMCloud is closed");
+            }
+            submitted.add(op);
+        }
+    }
+
+    /**
+     * Returns true once close has been called and every operation submitted
+     * has completed.
+     */
+    private boolean finished() {
+        synchronized (this) {
+            return closed && submitted.isEmpty() && carried == null
+                    && outstanding.isEmpty();
+        }
+    }
+
+    /**
+     * The poller thread: connect, then alternate between handing submitted
+     * operations to native code and completing the futures of those that
+     * native code reports as done.
+     */
+    private void pollerMain(String locator, String clusterName) {
+        try {
+            connect(locator, clusterName);
+        } catch (RuntimeException ex) {
+            connected.completeExceptionally(ex);
+            return;
+        }
+        connected.complete(null);
+
+        while (!finished()) {
+            Operation op = carried;
+            carried = null;
+            if (op == null) {
+                try {
+                    op = outstanding.isEmpty()
+                            ? submitted.poll(1, TimeUnit.SECONDS)
+                            : submitted.poll();
+                } catch (InterruptedException ex) {
+                    // close was called; finished() decides what's left.
+                    continue;
+                }
+            }
+            if (op == null && outstanding.isEmpty()) {
+                continue;
+            }
+
+            byteBuffer.rewind();
+            byteBuffer.putLong(clientHandle)
+                    .putInt(pollMicros)
+                    .putInt(0);
+            int count = 0;
+            while (op != null) {
+                if (outstanding.size() >= maxOutstanding
+                        || op.size() > byteBuffer.remaining()) {
+                    carried = op;
+                    break;
+                }
+                long id = nextId++;
+                byteBuffer.put(op.type)
+                        .putLong(id)
+                        .putLong(op.tableId)
+                        .putInt(op.key.length)
+                        .put(op.key);
+                if (op.type == WRITE) {
+                    byteBuffer.putInt(op.value.length).put(op.value);
+                }
+                byteBuffer.put(RAMCloud.getRejectRulesBytes(op.rules));
+                outstanding.put(id, op);
+                count++;
+                op = submitted.poll();
+            }
+            byteBuffer.putInt(12, count);
+
+            cppPoll(byteBufferPointer);
+            byteBuffer.rewind();
+            int completions = byteBuffer.getInt();
+            for (int i = 0; i < completions; i++) {
+                Operation done = outstanding.remove(byteBuffer.getLong());
+                int status = byteBuffer.getInt();
+                long version = byteBuffer.getLong();
+                int valueLength = byteBuffer.getInt();
+                RuntimeException error = null;
+                try {
+                    ClientException.checkStatus(status);
+                } catch (ClientException ex) {
+                    error = ex;
+                }
+                if (done.type == READ) {
+                    if (error != null) {
+                        done.readResult.completeExceptionally(error);
+                        continue;
+                    }
+                    byte[] value = new byte[valueLength];
+                    byteBuffer.get(value);
+                    done.readResult.complete(
+                            new RAMCloudObject(done.key, value, version));
+                } else if (error != null) {
+                    done.writeResult.completeExceptionally(error);
+                } else {
+                    done.writeResult.complete(version);
+                }
+            }
+        }
+        cppDisconnect(clientHandle);
+        clientHandle = 0;
+    }
+
+    /**
+     * Create the C++ AsyncClient. This must happen on the poller thread:
+     * a RamCloud object only polls for network events from the thread that
+     * created it.
+     */
+    private void connect(String locator, String clusterName) {
+        byteBuffer.rewind();
+        byteBuffer.putInt(locator.length())
+                .put(locator.getBytes())
+                .put((byte) 0)
+                .put(clusterName.getBytes())
+                .put((byte) 0);
+        cppConnect(byteBufferPointer);
+        byteBuffer.rewind();
+        ClientException.checkStatus(byteBuffer.getInt());
+        clientHandle = byteBuffer.getLong();
+    }
+
+    // Declarations for native methods in c++ file
+    private static native long cppGetByteBufferPointer(ByteBuffer byteBuffer);
+
+    private static native void cppConnect(long byteBufferPointer);
+
+    private static native void cppDisconnect(long clientHandle);
+
+    private static native void cppPoll(long byteBufferPointer);
+}
@@ -67,6 +67,37 @@ public class RAMCloud {
         return out;
     }
 
+    /**
+     * Appends the 12-byte representation of the given RejectRules (see
+     * getRejectRulesBytes) to byteBuffer, without allocating anything.
+     *
+     * @param rules
+     *            RejectRules to append, or null for none.
+     */
+    private void putRejectRules(RejectRules rules) {
+        if (rules == null) {
+            byteBuffer.put(defaultRejectRules);
+            return;
+        }
+        byteBuffer.putLong(rules.getGivenVersion())
+                .put((byte) (rules.rejectIfDoesntExist() ? 1 : 0))
+                .put((byte) (rules.rejectIfExists() ? 1 : 0))
+                .put((byte) (rules.rejectIfVersionLeGiven() ? 1 : 0))
+                .put((byte) (rules.rejectIfVersionNeGiven() ? 1 : 0));
+    }
+
+    /**
+     * Throws IllegalArgumentException unless the given ByteBuffer was created
+     * with ByteBuffer.allocateDirect(), so that native code can use its
+     * memory in place.
+     */
+    private static void checkDirect(ByteBuffer buffer) {
+        if (!buffer.isDirect()) {
+            throw new IllegalArgumentException(
+                    "ByteBuffer must be allocated with allocateDirect()");
+        }
+    }
+
     /**
      * Pointer to the underlying C++ RAMCloud object associated with this
      * object.
@@ -371,6 +402,94 @@ public class RAMCloud {
         return version;
     }
 
+    /**
+     * Read the current contents of an object into a direct ByteBuffer. Unlike
+     * the other read methods, this allocates nothing: the key is used in
+     * place, and the value is copied once, straight from the RPC response
+     * into the caller's buffer. Buffers may be reused across calls.
+     *
+     * @param tableId
+     *            The table containing the desired object (return value from a
+     *            previous call to getTableId).
+     * @param key
+     *            A direct ByteBuffer whose remaining bytes (from its position
+     *            to its limit) are the key. Its position is not changed.
+     * @param value
+     *            A direct ByteBuffer; the object's value is stored at its
+     *            position, which is then advanced past the value.
+     * @param rules
+     *            If non-NULL, specifies conditions under which the read should
+     *            be aborted with an error.
+     * @return The version of the object.
+     * @throws BufferOverflowException
+     *            If the value doesn't fit in the remaining space of value;
+     *            nothing is stored in that case.
+     */
+    public long read(long tableId, ByteBuffer key, ByteBuffer value,
+                     RejectRules rules) {
+        checkDirect(key);
+        checkDirect(value);
+        byteBuffer.rewind();
+        byteBuffer.putLong(ramcloudClusterHandle)
+                .putLong(tableId)
+                .putInt(key.position())
+                .putInt(key.remaining())
+                .putInt(value.position())
+                .putInt(value.remaining());
+        putRejectRules(rules);
+        cppReadDirect(byteBufferPointer, key, value);
+        byteBuffer.rewind();
+        checkStatus(byteBuffer.getInt());
+        long version = byteBuffer.getLong();
+        int valueLength = byteBuffer.getInt();
+        if (valueLength > value.remaining()) {
+            throw new BufferOverflowException();
+        }
+        value.position(value.position() + valueLength);
+        return version;
+    }
+
+    /**
+     * Replace the value of a given object, or create a new object if none
+     * previously existed, from direct ByteBuffers. Unlike the other write
+     * methods, this allocates nothing and the key and value are used in
+     * place; they are copied only into the RPC request.
+     *
+     * @param tableId
+     *            The table containing the desired object (return value from a
+     *            previous call to getTableId).
+     * @param key
+     *            A direct ByteBuffer whose remaining bytes are the key. Its
+     *            position is not changed.
+     * @param value
+     *            A direct ByteBuffer whose remaining bytes are the new value
+     *            for the object. Its position is not changed.
+     * @param rules
+     *            If non-NULL, specifies conditions under which the write should
+     *            be aborted with an error.
+     * @return The version number of the object is returned. If the operation
+     *         was successful this will be the new version for the object. If
+     *         the operation failed then the version number returned is the
+     *         current version of the object, or 0 if the object does not exist.
+     */
+    public long write(long tableId, ByteBuffer key, ByteBuffer value,
+                      RejectRules rules) {
+        checkDirect(key);
+        checkDirect(value);
+        byteBuffer.rewind();
+        byteBuffer.putLong(ramcloudClusterHandle)
+                .putLong(tableId)
+                .putInt(key.position())
+                .putInt(key.remaining())
+                .putInt(value.position())
+                .putInt(value.remaining());
+        putRejectRules(rules);
+        cppWriteDirect(byteBufferPointer, key, value);
+        byteBuffer.rewind();
+        checkStatus(byteBuffer.getInt());
+        return byteBuffer.getLong();
+    }
+
     /**
      * Create a new table, if it doesn't already exist.
      *
@@ -539,6 +658,14 @@ public class RAMCloud {
 
     private static native void cppWrite(long byteBufferPointer);
 
+    private static native void cppReadDirect(long byteBufferPointer,
+                                             ByteBuffer key,
+                                             ByteBuffer value);
+
+    private static native void cppWriteDirect(long byteBufferPointer,
+                                              ByteBuffer key,
+                                              ByteBuffer value);
+
     private static native void cppMultiRemove(long ramcloudClusterHandle,
                                               long[] tableIds,
                                               byte[][] objects,
@@ -16,6 +16,8 @@
 package edu.stanford.ramcloud.test;
 
 import java.lang.reflect.Method;
+import java.nio.BufferOverflowException;
+import java.nio.ByteBuffer;
 
 import static edu.stanford.ramcloud.ClientException.*;
 import edu.stanford.ramcloud.*;
@@ -234,6 +236,42 @@ public class RAMCloudTest {
         assertEquals(version, obj.getVersion());
     }
     
+    @Test
+    public void readWrite_directByteBuffers() {
+        ByteBuffer keyBuffer = ByteBuffer.allocateDirect(100);
+        keyBuffer.put(key.getBytes()).flip();
+        ByteBuffer valueBuffer = ByteBuffer.allocateDirect(100);
+        valueBuffer.put("xxtestValue".getBytes()).flip().position(2);
+        long version = ramcloud.write(tableId, keyBuffer, valueBuffer, null);
+        assertEquals(0, keyBuffer.position());
+        assertEquals("testValue", ramcloud.read(tableId, key).getValue());
+
+        valueBuffer.clear().position(1);
+        assertEquals(version,
+                ramcloud.read(tableId, keyBuffer, valueBuffer, null));
+        assertEquals(10, valueBuffer.position());
+        byte[] value = new byte[9];
+        valueBuffer.position(1);
+        valueBuffer.get(value);
+        assertEquals("testValue", new String(value));
+
+        valueBuffer.clear().limit(8);
+        try {
+            ramcloud.read(tableId, keyBuffer, valueBuffer, null);
+            fail();
+        } catch (BufferOverflowException ex) {
+            // Good
+        }
+        assertEquals(0, valueBuffer.position());
+
+        try {
+            ramcloud.read(tableId, keyBuffer, ByteBuffer.allocate(100), null);
+            fail();
+        } catch (IllegalArgumentException ex) {
+            // Good
+        }
+    }
+
     @Test
     public void write_stringKeyByteValueWithRejectRules() {
         RejectRules rules = new RejectRules();
@@ -12,6 +12,9 @@
 # ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
 # OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
+# For throughput-sensitive code see ramcloud_ext (built by "make python-ext"),
+# a native module with zero-copy values, multi-ops and asynchronous reads.
+
 # Note in order for this module to work you must have libramcloud.so
 # somewhere in a system library path and have run /sbin/ldconfig since
 # installing it
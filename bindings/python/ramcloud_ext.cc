@@ -0,0 +1,841 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ * \file
+ * A CPython extension module, ramcloud_ext, that talks to RAMCloud through
+ * the C++ client library directly. It avoids the per-call marshaling of the
+ * ctypes binding in ramcloud.py, and it hands back object values without
+ * copying them: a read returns a Value, which keeps the RPC's response
+ * Buffer alive and exports its bytes through the buffer protocol, so that
+ * memoryview(value) or numpy.frombuffer(value) look straight at the network
+ * buffer. Multi-reads, multi-writes and asynchronous reads are supported so
+ * that batches can be issued without a round trip per object.
+ *
+ * The module holds the GIL while it uses a client; a RamCloud object must
+ * not be used by several threads at once, so each Python thread that wants
+ * to issue requests in parallel should open its own Client.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "Common.h"
+#include "RamCloud.h"
+#include "ClientException.h"
+#include "ObjectBuffer.h"
+
+using namespace RAMCloud;
+
+#ifndef Py_TPFLAGS_HAVE_NEWBUFFER
+#define Py_TPFLAGS_HAVE_NEWBUFFER 0
+#endif
+
+/// ramcloud_ext.Error: raised for any status other than STATUS_OK. Its
+/// "status" attribute holds the numeric Status.
+static PyObject* RamCloudError;
+
+/**
+ * Translate the exception currently being handled into a Python exception.
+ * Must be called from within a catch block.
+ *
+ * \return
+ *      Always NULL, so that callers can return its result.
+ */
+static PyObject*
+raiseCurrentException()
+{
+    try {
+        throw;
+    } catch (ClientException& e) {
+        PyObject* error = PyObject_CallFunction(RamCloudError, "is",
+                static_cast<int>(e.status), statusToString(e.status));
+        if (error != NULL) {
+            PyObject* status = PyLong_FromLong(e.status);
+            PyObject_SetAttrString(error, "status", status);
+            Py_XDECREF(status);
+            PyErr_SetObject(RamCloudError, error);
+            Py_DECREF(error);
+        }
+    } catch (std::exception& e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+    } catch (...) {
+        PyErr_SetString(PyExc_RuntimeError, "unknown C++ exception");
+    }
+    return NULL;
+}
+
+/**
+ * Fill in RejectRules from their Python form, the tuple returned by
+ * ramcloud.RejectRules._as_tuple(): (object_doesnt_exist, object_exists,
+ * version_eq_given, version_gt_given, given_version).
+ *
+ * \param tuple
+ *      The Python argument; None means no reject rules.
+ * \param[out] rules
+ *      Filled in if \a tuple isn't None.
+ * \param[out] result
+ *      Set to \a rules, or to NULL if \a tuple is None.
+ * \return
+ *      False, with a Python exception set, if \a tuple is malformed.
+ */
+static bool
+parseRejectRules(PyObject* tuple, RejectRules* rules,
+                 const RejectRules** result)
+{
+    *result = NULL;
+    if (tuple == NULL || tuple == Py_None)
+        return true;
+    int doesntExist, exists, versionEq, versionGt;
+    unsigned long long givenVersion;
+    if (!PyArg_ParseTuple(tuple, "iiiiK;reject_rules must be a tuple "
+            "(doesnt_exist, exists, version_eq, version_gt, version)",
+            &doesntExist, &exists, &versionEq, &versionGt, &givenVersion)) {
+        return false;
+    }
+    memset(rules, 0, sizeof(*rules));
+    rules->doesntExist = doesntExist ? 1 : 0;
+    rules->exists = exists ? 1 : 0;
+    rules->versionLeGiven = versionEq ? 1 : 0;
+    rules->versionNeGiven = versionGt ? 1 : 0;
+    rules->givenVersion = givenVersion;
+    *result = rules;
+    return true;
+}
+
+/**
+ * ramcloud_ext.Value: the value of an object that was read. It owns the
+ * Buffer the response arrived in and exports the value's bytes, read-only,
+ * through the buffer protocol.
+ */
+struct ValueObject {
+    PyObject_HEAD
+    Buffer* buffer;     ///< Holds the value; freed with this object unless
+                        ///< it belongs to #objectBuffer.
+    Tub<ObjectBuffer>* objectBuffer;  ///< If not NULL, holds #buffer and is
+                                      ///< freed instead of it.
+    PyObject* client;   ///< The Client the value was read with; a response
+                        ///< may refer to its transport's memory.
+    uint32_t offset;    ///< Where the value starts in #buffer.
+    uint32_t length;    ///< Number of bytes in the value.
+};
+
+static PyTypeObject ValueType;
+
+/**
+ * Wrap a Buffer in a new Value, which takes ownership of it.
+ *
+ * \param buffer
+ *      Buffer holding the value; deleted when the Value is (or right away,
+ *      if the Value couldn't be allocated).
+ * \param objectBuffer
+ *      If not NULL, \a buffer is the ObjectBuffer in this Tub, and the Tub
+ *      is deleted instead.
+ * \param offset
+ *      Where the value starts in \a buffer.
+ * \param length
+ *      Number of bytes in the value.
+ * \param client
+ *      The Client that read the value; kept alive as long as the Value.
+ */
+static PyObject*
+newValue(Buffer* buffer, Tub<ObjectBuffer>* objectBuffer, uint32_t offset,
+         uint32_t length, PyObject* client)
+{
+    ValueObject* self = PyObject_New(ValueObject, &ValueType);
+    if (self == NULL) {
+        if (objectBuffer != NULL)
+            delete objectBuffer;
+        else
+            delete buffer;
+        return NULL;
+    }
+    self->buffer = buffer;
+    self->objectBuffer = objectBuffer;
+    Py_INCREF(client);
+    self->client = client;
+    self->offset = offset;
+    self->length = length;
+    return reinterpret_cast<PyObject*>(self);
+}
+
+static void
+Value_dealloc(ValueObject* self)
+{
+    if (self->objectBuffer != NULL)
+        delete self->objectBuffer;
+    else
+        delete self->buffer;
+    Py_DECREF(self->client);
+    PyObject_Del(self);
+}
+
+static int
+Value_getbuffer(ValueObject* self, Py_buffer* view, int flags)
+{
+    // getRange only copies if the value is split across several chunks of
+    // the Buffer; small values and those received in one packet are not.
+    static char empty[1];
+    void* start = empty;
+    if (self->length > 0)
+        start = self->buffer->getRange(self->offset, self->length);
+    return PyBuffer_FillInfo(view, reinterpret_cast<PyObject*>(self), start,
+                             self->length, 1, flags);
+}
+
+static Py_ssize_t
+Value_length(ValueObject* self)
+{
+    return self->length;
+}
+
+static PyBufferProcs Value_as_buffer;
+static PySequenceMethods Value_as_sequence;
+
+/**
+ * Turn the response to a read into a (Value, version) tuple.
+ *
+ * \param value
+ *      The Buffer passed to the read; ownership passes to the result.
+ * \param version
+ *      The version of the object that was read.
+ * \param client
+ *      The Client that read the value.
+ */
+static PyObject*
+newReadResult(Buffer* value, uint64_t version, PyObject* client)
+{
+    PyObject* result = newValue(value, NULL, 0, value->size(), client);
+    if (result == NULL)
+        return NULL;
+    return Py_BuildValue("(NK)", result,
+                         static_cast<unsigned long long>(version));
+}
+
+/**
+ * ramcloud_ext.Client: a connection to a RAMCloud cluster.
+ */
+struct ClientObject {
+    PyObject_HEAD
+    RamCloud* ramcloud;     ///< NULL until the client is initialized.
+};
+
+static PyTypeObject ClientType;
+
+static int
+Client_init(ClientObject* self, PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = {"locator", "cluster_name", NULL};
+    const char* locator;
+    const char* clusterName = "main";
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|s",
+            const_cast<char**>(kwlist), &locator, &clusterName)) {
+        return -1;
+    }
+    try {
+        delete self->ramcloud;
+        self->ramcloud = NULL;
+        self->ramcloud = new RamCloud(locator, clusterName);
+    } catch (...) {
+        raiseCurrentException();
+        return -1;
+    }
+    return 0;
+}
+
+static void
+Client_dealloc(ClientObject* self)
+{
+    delete self->ramcloud;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+/**
+ * Make sure a Client has been initialized before it is used.
+ */
+static bool
+checkClient(ClientObject* self)
+{
+    if (self->ramcloud == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "Client is not connected");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Check that a key fits in the 16-bit length RAMCloud allows.
+ */
+static bool
+checkKey(const Py_buffer* key)
+{
+    if (key->len > UINT16_MAX) {
+        PyErr_SetString(PyExc_ValueError, "key is longer than 65535 bytes");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * ramcloud_ext.AsyncRead: a read that has been started and not collected
+ * yet; returned by Client.read_async.
+ */
+struct AsyncReadObject {
+    PyObject_HEAD
+    ClientObject* client;   ///< Keeps the RamCloud alive while we use it.
+    PyObject* key;          ///< Keeps the key alive as long as the RPC.
+    Py_buffer keyView;      ///< The bytes of #key.
+    Buffer* value;          ///< Where the response goes; NULL once handed
+                            ///< off to a Value.
+    ReadRpc* rpc;           ///< NULL once the result has been collected.
+};
+
+static PyTypeObject AsyncReadType;
+
+static void
+AsyncRead_dealloc(AsyncReadObject* self)
+{
+    delete self->rpc;
+    delete self->value;
+    if (self->key != NULL)
+        PyBuffer_Release(&self->keyView);
+    Py_XDECREF(self->key);
+    Py_XDECREF(self->client);
+    PyObject_Del(self);
+}
+
+static PyObject*
+AsyncRead_is_ready(AsyncReadObject* self)
+{
+    try {
+        return PyBool_FromLong(self->rpc == NULL || self->rpc->isReady());
+    } catch (...) {
+        return raiseCurrentException();
+    }
+}
+
+static PyObject*
+AsyncRead_wait(AsyncReadObject* self)
+{
+    if (self->rpc == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "read was already collected");
+        return NULL;
+    }
+    uint64_t version;
+    try {
+        self->rpc->wait(&version);
+    } catch (...) {
+        delete self->rpc;
+        self->rpc = NULL;
+        return raiseCurrentException();
+    }
+    delete self->rpc;
+    self->rpc = NULL;
+    Buffer* value = self->value;
+    self->value = NULL;
+    return newReadResult(value, version,
+                         reinterpret_cast<PyObject*>(self->client));
+}
+
+static PyMethodDef AsyncRead_methods[] = {
+    {"is_ready", reinterpret_cast<PyCFunction>(AsyncRead_is_ready),
+     METH_NOARGS, "True once wait() would not block."},
+    {"wait", reinterpret_cast<PyCFunction>(AsyncRead_wait), METH_NOARGS,
+     "Wait for the read to finish and return (value, version)."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyObject*
+Client_create_table(ClientObject* self, PyObject* args)
+{
+    const char* name;
+    unsigned int serverSpan = 1;
+    if (!checkClient(self) ||
+            !PyArg_ParseTuple(args, "s|I", &name, &serverSpan)) {
+        return NULL;
+    }
+    try {
+        return PyLong_FromUnsignedLongLong(
+                self->ramcloud->createTable(name, serverSpan));
+    } catch (...) {
+        return raiseCurrentException();
+    }
+}
+
+static PyObject*
+Client_drop_table(ClientObject* self, PyObject* args)
+{
+    const char* name;
+    if (!checkClient(self) || !PyArg_ParseTuple(args, "s", &name))
+        return NULL;
+    try {
+        self->ramcloud->dropTable(name);
+    } catch (...) {
+        return raiseCurrentException();
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject*
+Client_get_table_id(ClientObject* self, PyObject* args)
+{
+    const char* name;
+    if (!checkClient(self) || !PyArg_ParseTuple(args, "s", &name))
+        return NULL;
+    try {
+        return PyLong_FromUnsignedLongLong(self->ramcloud->getTableId(name));
+    } catch (...) {
+        return raiseCurrentException();
+    }
+}
+
+static PyObject*
+Client_read(ClientObject* self, PyObject* args)
+{
+    unsigned long long tableId;
+    Py_buffer key;
+    PyObject* rejectArg = NULL;
+    if (!checkClient(self) ||
+            !PyArg_ParseTuple(args, "Ks*|O", &tableId, &key, &rejectArg)) {
+        return NULL;
+    }
+    RejectRules rules;
+    const RejectRules* rejectRules;
+    if (!checkKey(&key) ||
+            !parseRejectRules(rejectArg, &rules, &rejectRules)) {
+        PyBuffer_Release(&key);
+        return NULL;
+    }
+    Buffer* value = new Buffer();
+    uint64_t version;
+    try {
+        self->ramcloud->read(tableId, key.buf,
+                static_cast<uint16_t>(key.len), value, rejectRules,
+                &version);
+    } catch (...) {
+        PyBuffer_Release(&key);
+        delete value;
+        return raiseCurrentException();
+    }
+    PyBuffer_Release(&key);
+    return newReadResult(value, version, reinterpret_cast<PyObject*>(self));
+}
+
+static PyObject*
+Client_write(ClientObject* self, PyObject* args)
+{
+    unsigned long long tableId;
+    Py_buffer key, value;
+    PyObject* rejectArg = NULL;
+    if (!checkClient(self) || !PyArg_ParseTuple(args, "Ks*s*|O", &tableId,
+            &key, &value, &rejectArg)) {
+        return NULL;
+    }
+    RejectRules rules;
+    const RejectRules* rejectRules;
+    PyObject* result = NULL;
+    if (!checkKey(&key) ||
+            !parseRejectRules(rejectArg, &rules, &rejectRules)) {
+        goto done;
+    }
+    if (value.len > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "value is too long");
+        goto done;
+    }
+    try {
+        uint64_t version;
+        self->ramcloud->write(tableId, key.buf,
+                static_cast<uint16_t>(key.len), value.buf,
+                static_cast<uint32_t>(value.len), rejectRules, &version);
+        result = PyLong_FromUnsignedLongLong(version);
+    } catch (...) {
+        raiseCurrentException();
+    }
+  done:
+    PyBuffer_Release(&key);
+    PyBuffer_Release(&value);
+    return result;
+}
+
+static PyObject*
+Client_remove(ClientObject* self, PyObject* args)
+{
+    unsigned long long tableId;
+    Py_buffer key;
+    PyObject* rejectArg = NULL;
+    if (!checkClient(self) ||
+            !PyArg_ParseTuple(args, "Ks*|O", &tableId, &key, &rejectArg)) {
+        return NULL;
+    }
+    RejectRules rules;
+    const RejectRules* rejectRules;
+    PyObject* result = NULL;
+    if (checkKey(&key) &&
+            parseRejectRules(rejectArg, &rules, &rejectRules)) {
+        try {
+            uint64_t version;
+            self->ramcloud->remove(tableId, key.buf,
+                    static_cast<uint16_t>(key.len), rejectRules, &version);
+            result = PyLong_FromUnsignedLongLong(version);
+        } catch (...) {
+            raiseCurrentException();
+        }
+    }
+    PyBuffer_Release(&key);
+    return result;
+}
+
+/**
+ * Parse a multi-op request list: a sequence of tuples that each start with
+ * (table_id, key), followed by a value if \a withValues. Fills in one entry
+ * of \a tableIds and \a keys (and \a values) per request; on success the
+ * caller must release every Py_buffer, on failure they have been released.
+ */
+static bool
+parseMultiOps(PyObject* list, bool withValues,
+              std::vector<uint64_t>* tableIds, std::vector<Py_buffer>* keys,
+              std::vector<Py_buffer>* values)
+{
+    PyObject* seq = PySequence_Fast(list, "requests must be a sequence");
+    if (seq == NULL)
+        return false;
+    Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+    tableIds->reserve(count);
+    keys->reserve(count);
+    if (withValues)
+        values->reserve(count);
+    bool ok = true;
+    for (Py_ssize_t i = 0; ok && i < count; i++) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        unsigned long long tableId;
+        Py_buffer key, value;
+        if (withValues) {
+            ok = PyArg_ParseTuple(item, "Ks*s*;each request must be "
+                    "(table_id, key, value)", &tableId, &key, &value);
+        } else {
+            ok = PyArg_ParseTuple(item, "Ks*;each request must be "
+                    "(table_id, key)", &tableId, &key);
+        }
+        if (!ok)
+            break;
+        tableIds->push_back(tableId);
+        keys->push_back(key);
+        if (withValues)
+            values->push_back(value);
+        if (!checkKey(&key) || (withValues && value.len > UINT32_MAX)) {
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_ValueError, "value is too long");
+            ok = false;
+        }
+    }
+    Py_DECREF(seq);
+    if (!ok) {
+        foreach (Py_buffer& key, *keys)
+            PyBuffer_Release(&key);
+        foreach (Py_buffer& value, *values)
+            PyBuffer_Release(&value);
+    }
+    return ok;
+}
+
+static PyObject*
+Client_multi_read(ClientObject* self, PyObject* args)
+{
+    PyObject* list;
+    std::vector<uint64_t> tableIds;
+    std::vector<Py_buffer> keys, unused;
+    if (!checkClient(self) || !PyArg_ParseTuple(args, "O", &list) ||
+            !parseMultiOps(list, false, &tableIds, &keys, &unused)) {
+        return NULL;
+    }
+    // Each response gets a Tub of its own, so that its Value can take it
+    // over and outlive the others.
+    size_t count = keys.size();
+    std::vector<Tub<ObjectBuffer>*> values;
+    std::vector<MultiReadObject> objects;
+    std::vector<MultiReadObject*> requests;
+    values.reserve(count);
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        values.push_back(new Tub<ObjectBuffer>());
+        objects.emplace_back(tableIds[i], keys[i].buf,
+                static_cast<uint16_t>(keys[i].len), values[i]);
+        requests.push_back(&objects.back());
+    }
+
+    PyObject* result = NULL;
+    try {
+        if (count > 0) {
+            self->ramcloud->multiRead(requests.data(),
+                                      downCast<uint32_t>(count));
+        }
+        result = PyList_New(count);
+        for (size_t i = 0; result != NULL && i < count; i++) {
+            if (objects[i].status == STATUS_OBJECT_DOESNT_EXIST) {
+                Py_INCREF(Py_None);
+                PyList_SET_ITEM(result, i, Py_None);
+                continue;
+            }
+            if (objects[i].status != STATUS_OK)
+                ClientException::throwException(HERE, objects[i].status);
+            uint32_t offset, length;
+            ObjectBuffer* buffer = values[i]->get();
+            buffer->getValueOffset(&offset);
+            buffer->getValue(&length);
+            PyObject* value = newValue(buffer, values[i], offset, length,
+                                       reinterpret_cast<PyObject*>(self));
+            values[i] = NULL;
+            PyObject* entry = (value == NULL) ? NULL : Py_BuildValue("(NK)",
+                    value, static_cast<unsigned long long>(
+                    objects[i].version));
+            if (entry == NULL) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, i, entry);
+        }
+    } catch (...) {
+        Py_CLEAR(result);
+        raiseCurrentException();
+    }
+    foreach (Tub<ObjectBuffer>* value, values)
+        delete value;
+    foreach (Py_buffer& key, keys)
+        PyBuffer_Release(&key);
+    return result;
+}
+
+static PyObject*
+Client_multi_write(ClientObject* self, PyObject* args)
+{
+    PyObject* list;
+    std::vector<uint64_t> tableIds;
+    std::vector<Py_buffer> keys, values;
+    if (!checkClient(self) || !PyArg_ParseTuple(args, "O", &list) ||
+            !parseMultiOps(list, true, &tableIds, &keys, &values)) {
+        return NULL;
+    }
+    size_t count = keys.size();
+    std::vector<MultiWriteObject> objects;
+    std::vector<MultiWriteObject*> requests;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        objects.emplace_back(tableIds[i], keys[i].buf,
+                static_cast<uint16_t>(keys[i].len), values[i].buf,
+                static_cast<uint32_t>(values[i].len));
+        requests.push_back(&objects.back());
+    }
+
+    PyObject* result = NULL;
+    try {
+        if (count > 0) {
+            self->ramcloud->multiWrite(requests.data(),
+                                       downCast<uint32_t>(count));
+        }
+        foreach (MultiWriteObject& object, objects) {
+            if (object.status != STATUS_OK)
+                ClientException::throwException(HERE, object.status);
+        }
+        result = PyList_New(count);
+        for (size_t i = 0; result != NULL && i < count; i++) {
+            PyObject* version = PyLong_FromUnsignedLongLong(
+                    objects[i].version);
+            if (version == NULL) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, i, version);
+        }
+    } catch (...) {
+        raiseCurrentException();
+    }
+    foreach (Py_buffer& key, keys)
+        PyBuffer_Release(&key);
+    foreach (Py_buffer& value, values)
+        PyBuffer_Release(&value);
+    return result;
+}
+
+static PyObject*
+Client_read_async(ClientObject* self, PyObject* args)
+{
+    unsigned long long tableId;
+    PyObject* key;
+    if (!checkClient(self) || !PyArg_ParseTuple(args, "KO", &tableId, &key))
+        return NULL;
+    AsyncReadObject* read = PyObject_New(AsyncReadObject, &AsyncReadType);
+    if (read == NULL)
+        return NULL;
+    Py_INCREF(self);
+    read->client = self;
+    read->key = NULL;
+    read->value = NULL;
+    read->rpc = NULL;
+    PyObject* result = reinterpret_cast<PyObject*>(read);
+    if (PyObject_GetBuffer(key, &read->keyView, PyBUF_SIMPLE) != 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    Py_INCREF(key);
+    read->key = key;
+    if (!checkKey(&read->keyView)) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    try {
+        read->value = new Buffer();
+        read->rpc = new ReadRpc(self->ramcloud, tableId, read->keyView.buf,
+                static_cast<uint16_t>(read->keyView.len), read->value);
+    } catch (...) {
+        Py_DECREF(result);
+        return raiseCurrentException();
+    }
+    return result;
+}
+
+static PyObject*
+Client_poll(ClientObject* self)
+{
+    if (!checkClient(self))
+        return NULL;
+    try {
+        self->ramcloud->poll();
+    } catch (...) {
+        return raiseCurrentException();
+    }
+    Py_RETURN_NONE;
+}
+
+#define CLIENT_METHOD(name, flags, doc) \
+    {#name, reinterpret_cast<PyCFunction>(Client_##name), flags, doc}
+
+static PyMethodDef Client_methods[] = {
+    CLIENT_METHOD(create_table, METH_VARARGS,
+            "create_table(name, server_span=1) -> table id"),
+    CLIENT_METHOD(drop_table, METH_VARARGS, "drop_table(name)"),
+    CLIENT_METHOD(get_table_id, METH_VARARGS, "get_table_id(name) -> id"),
+    CLIENT_METHOD(read, METH_VARARGS,
+            "read(table_id, key, reject_rules=None) -> (Value, version)"),
+    CLIENT_METHOD(write, METH_VARARGS,
+            "write(table_id, key, value, reject_rules=None) -> version"),
+    CLIENT_METHOD(remove, METH_VARARGS,
+            "remove(table_id, key, reject_rules=None) -> version"),
+    CLIENT_METHOD(multi_read, METH_VARARGS,
+            "multi_read([(table_id, key), ...]) -> [(Value, version) or "
+            "None for objects that don't exist, ...]"),
+    CLIENT_METHOD(multi_write, METH_VARARGS,
+            "multi_write([(table_id, key, value), ...]) -> [version, ...]"),
+    CLIENT_METHOD(read_async, METH_VARARGS,
+            "read_async(table_id, key) -> AsyncRead; the read proceeds "
+            "while the client is used for other requests or polled"),
+    CLIENT_METHOD(poll, METH_NOARGS,
+            "Make progress on outstanding asynchronous reads."),
+    {NULL, NULL, 0, NULL}
+};
+
+#undef CLIENT_METHOD
+
+/**
+ * Fill in the type objects; C++ has no designated initializers to do it
+ * statically.
+ */
+static void
+initTypes()
+{
+    Value_as_buffer.bf_getbuffer =
+            reinterpret_cast<getbufferproc>(Value_getbuffer);
+    Value_as_sequence.sq_length = reinterpret_cast<lenfunc>(Value_length);
+    ValueType.tp_name = "ramcloud_ext.Value";
+    ValueType.tp_basicsize = sizeof(ValueObject);
+    ValueType.tp_dealloc = reinterpret_cast<destructor>(Value_dealloc);
+    ValueType.tp_as_buffer = &Value_as_buffer;
+    ValueType.tp_as_sequence = &Value_as_sequence;
+    ValueType.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+    ValueType.tp_doc = "The value of an object, exported zero-copy through "
+            "the buffer protocol.";
+
+    AsyncReadType.tp_name = "ramcloud_ext.AsyncRead";
+    AsyncReadType.tp_basicsize = sizeof(AsyncReadObject);
+    AsyncReadType.tp_dealloc = reinterpret_cast<destructor>(
+            AsyncRead_dealloc);
+    AsyncReadType.tp_flags = Py_TPFLAGS_DEFAULT;
+    AsyncReadType.tp_doc = "A read started by Client.read_async.";
+    AsyncReadType.tp_methods = AsyncRead_methods;
+
+    ClientType.tp_name = "ramcloud_ext.Client";
+    ClientType.tp_basicsize = sizeof(ClientObject);
+    ClientType.tp_dealloc = reinterpret_cast<destructor>(Client_dealloc);
+    ClientType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ClientType.tp_doc = "Client(locator, cluster_name='main'): a connection "
+            "to a RAMCloud cluster.";
+    ClientType.tp_methods = Client_methods;
+    ClientType.tp_init = reinterpret_cast<initproc>(Client_init);
+    ClientType.tp_new = PyType_GenericNew;
+}
+
+/**
+ * Create the module object and add the types and exception to it.
+ */
+static PyObject*
+createModule()
+{
+#if PY_MAJOR_VERSION >= 3
+    static PyModuleDef moduleDef = {
+        PyModuleDef_HEAD_INIT, "ramcloud_ext",
+        "Native RAMCloud client binding.", -1, NULL, NULL, NULL, NULL, NULL
+    };
+    PyObject* module = PyModule_Create(&moduleDef);
+#else
+    PyObject* module = Py_InitModule3("ramcloud_ext", NULL,
+            "Native RAMCloud client binding.");
+#endif
+    if (module == NULL)
+        return NULL;
+    initTypes();
+    if (PyType_Ready(&ValueType) < 0 || PyType_Ready(&AsyncReadType) < 0 ||
+            PyType_Ready(&ClientType) < 0) {
+        return NULL;
+    }
+    RamCloudError = PyErr_NewException(
+            const_cast<char*>("ramcloud_ext.Error"), NULL, NULL);
+    if (RamCloudError == NULL)
+        return NULL;
+    PyModule_AddObject(module, "Error", RamCloudError);
+    Py_INCREF(&ClientType);
+    PyModule_AddObject(module, "Client",
+                       reinterpret_cast<PyObject*>(&ClientType));
+    Py_INCREF(&ValueType);
+    PyModule_AddObject(module, "Value",
+                       reinterpret_cast<PyObject*>(&ValueType));
+    Py_INCREF(&AsyncReadType);
+    PyModule_AddObject(module, "AsyncRead",
+                       reinterpret_cast<PyObject*>(&AsyncReadType));
+    return module;
+}
+
+#if PY_MAJOR_VERSION >= 3
+PyMODINIT_FUNC
+PyInit_ramcloud_ext()
+{
+    return createModule();
+}
+#else
+PyMODINIT_FUNC
+initramcloud_ext()
+{
+    createModule();
+}
+#endif
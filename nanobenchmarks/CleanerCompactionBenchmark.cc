@@ -13,6 +13,9 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <atomic>
+#include <thread>
+
 #include "ClientException.h"
 #include "Cycles.h"
 #include "Logger.h"
@@ -86,10 +89,52 @@ class CleanerCompactionBenchmark {
         delete objectManager;
     }
 
+    /**
+     * Read random objects out of the first 'numObjects' keys until 'stop'
+     * is set, counting each read in 'reads'. This stands in for the
+     * foreground reads whose cache contents compaction competes with.
+     */
+    void
+    readObjects(uint64_t numObjects, std::atomic<bool>* stop,
+                std::atomic<uint64_t>* reads)
+    {
+        uint64_t count = 0;
+        while (!stop->load(std::memory_order_relaxed)) {
+            uint64_t keyVal = generateRandom() % numObjects;
+            Key key(0, &keyVal, sizeof(keyVal));
+            Buffer buffer;
+            objectManager->readObject(key, &buffer, NULL, NULL);
+            count++;
+        }
+        reads->store(count);
+    }
+
+    /**
+     * Measure how many objects a foreground thread reads per second while
+     * 'work' runs.
+     */
+    template<typename Work>
+    double
+    readThroughput(uint64_t numObjects, Work work)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> reads(0);
+        std::thread reader(&CleanerCompactionBenchmark::readObjects, this,
+                           numObjects, &stop, &reads);
+        uint64_t before = Cycles::rdtsc();
+        work();
+        uint64_t ticks = Cycles::rdtsc() - before;
+        stop = true;
+        reader.join();
+        return static_cast<double>(reads) / Cycles::toSeconds(ticks);
+    }
+
     void
-    run(uint32_t numSegments, uint32_t dataLen)
+    run(uint32_t numSegments, uint32_t dataLen, bool nonTemporal)
     {
         tabletManager.addTablet(0, 0, ~0UL, TabletManager::NORMAL);
+        if (!nonTemporal)
+            objectManager->segmentManager.setNonTemporalCopyBytes(~0u, ~0u);
 
         /*
          * Fill up 'numSegments' worth of segments in the log with objects of
@@ -128,15 +173,25 @@ class CleanerCompactionBenchmark {
         }
 
         /*
-         * Now compact each segment.
+         * Now compact each segment, while another thread reads objects.
+         * Measure the reader on its own first, to see how much compaction
+         * slows it down.
          */
-        uint64_t before = Cycles::rdtsc();
-        for (uint32_t i = 0; i < numSegments; i++)
-            objectManager->log.cleaner->doMemoryCleaning();
-        uint64_t ticks = Cycles::rdtsc() - before;
+        double idleReads = readThroughput(nextKeyVal, [] {
+            usleep(500 * 1000);
+        });
+        uint64_t ticks = 0;
+        double compactionReads = readThroughput(nextKeyVal, [&] {
+            uint64_t before = Cycles::rdtsc();
+            for (uint32_t i = 0; i < numSegments; i++)
+                objectManager->log.cleaner->doMemoryCleaning();
+            ticks = Cycles::rdtsc() - before;
+        });
 
         LogCleanerMetrics::InMemory<>* metrics =
             &objectManager->log.cleaner->inMemoryMetrics;
+        printf("%u-byte objects, %s copies into survivors\n", dataLen,
+            nonTemporal ? "non-temporal" : "ordinary");
         printf("Compaction took %lu ms (%.2f%% in callbacks)\n",
             Cycles::toNanoseconds(ticks) / 1000 / 1000,
             100.0 * Cycles::toSeconds(metrics->relocationCallbackTicks) /
@@ -155,6 +210,9 @@ class CleanerCompactionBenchmark {
             Cycles::toSeconds((metrics->relocationCallbackTicks -
                                metrics->relocationAppendTicks) /
                               metrics->totalRelocationCallbacks) * 1.0e9);
+        printf("  Foreground readThroughput:    %.0f reads/s idle, "
+            "%.0f reads/s during compaction (%.1f%%)\n",
+            idleReads, compactionReads, 100.0 * compactionReads / idleReads);
     }
 
     DISALLOW_COPY_AND_ASSIGN(CleanerCompactionBenchmark);
@@ -166,12 +224,15 @@ int
 main()
 {
     uint32_t numSegments = 600 / 8; // = 72.
-    uint32_t dataBytes[] = { 100, 0 };
+    uint32_t dataBytes[] = { 100, 1000, 0 };
 
     for (int i = 0; dataBytes[i] != 0; i++) {
-        printf("==========================\n");
-        RAMCloud::CleanerCompactionBenchmark rsb("2048", "10%", numSegments);
-        rsb.run(numSegments, dataBytes[i]);
+        for (int nonTemporal = 0; nonTemporal < 2; nonTemporal++) {
+            printf("==========================\n");
+            RAMCloud::CleanerCompactionBenchmark rsb("2048", "10%",
+                                                     numSegments);
+            rsb.run(numSegments, dataBytes[i], nonTemporal);
+        }
     }
 
     return 0;
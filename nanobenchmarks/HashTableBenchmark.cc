@@ -112,41 +112,67 @@ hashTableBenchmark(uint64_t nkeys, uint64_t nlines)
 
     printf("Starting lookups in 3 seconds (get your measurements ready!)\n");
     sleep(3);
-    printf("running lookup measurements...");
-    fflush(stdout);
 
-    // don't use a CycleCounter, as we may want to run without PERF_COUNTERS
-    uint64_t lookupCycles = Cycles::rdtsc();
-    for (i = 0; i < nkeys; i++) {
-        Key key(0, &i, sizeof(i));
-        uint64_t reference = 0;
-        bool success = false;
-        _unused(success);
-
-        ht.lookup(key.getHash(), c);
-        while (!c.isDone()) {
-            reference = c.getReference();
-            TestObject* candidateObject =
-                reinterpret_cast<TestObject*>(reference);
-            Key candidateKey(0,
-                             &candidateObject->key,
-                             sizeof(candidateObject->key));
-            if (candidateKey == key) {
-                success = true;
-                break;
+    // Time lookups once with each way of scanning cache lines for matching
+    // secondary hashes that this machine supports.
+    struct {
+        HashTable::MatchImplementation implementation;
+        const char* name;
+    } implementations[] = {
+        { HashTable::MATCH_SCALAR, "scalar" },
+        { HashTable::MATCH_SSE41, "SSE 4.1" },
+        { HashTable::MATCH_AVX2, "AVX2" },
+    };
+    HashTable::MatchImplementation original =
+        HashTable::getMatchImplementation();
+    for (uint32_t impl = 0; impl < arrayLength(implementations); impl++) {
+        if (HashTable::setMatchImplementation(
+                implementations[impl].implementation) !=
+                implementations[impl].implementation) {
+            printf("skipping %s lookups: not supported by this processor\n",
+                   implementations[impl].name);
+            continue;
+        }
+        printf("running %s lookup measurements...",
+               implementations[impl].name);
+        fflush(stdout);
+
+        // don't use a CycleCounter, as we may want to run without
+        // PERF_COUNTERS
+        uint64_t lookupCycles = Cycles::rdtsc();
+        for (i = 0; i < nkeys; i++) {
+            Key key(0, &i, sizeof(i));
+            uint64_t reference = 0;
+            bool success = false;
+            _unused(success);
+
+            ht.lookup(key.getHash(), c);
+            while (!c.isDone()) {
+                reference = c.getReference();
+                TestObject* candidateObject =
+                    reinterpret_cast<TestObject*>(reference);
+                Key candidateKey(0,
+                                 &candidateObject->key,
+                                 sizeof(candidateObject->key));
+                if (candidateKey == key) {
+                    success = true;
+                    break;
+                }
+                c.next();
             }
-            c.next();
+            assert(success);
+            assert(reinterpret_cast<TestObject*>(reference)->key == i);
         }
-        assert(success);
-        assert(reinterpret_cast<TestObject*>(reference)->key == i);
-    }
-    i = Cycles::rdtsc() - lookupCycles;
-    printf("done!\n");
+        i = Cycles::rdtsc() - lookupCycles;
+        printf("done!\n");
 
-    printf("== lookup() took %.3f s ==\n", Cycles::toSeconds(i));
+        printf("== %s lookup() took %.3f s ==\n", implementations[impl].name,
+               Cycles::toSeconds(i));
 
-    printf("    external avg: %lu ticks, %lu nsec\n", i / nkeys,
-        Cycles::toNanoseconds(i / nkeys));
+        printf("    external avg: %lu ticks, %lu nsec\n", i / nkeys,
+            Cycles::toNanoseconds(i / nkeys));
+    }
+    HashTable::setMatchImplementation(original);
 
     uint64_t *histogram = static_cast<uint64_t *>(
         Memory::xmalloc(HERE, nlines * sizeof(histogram[0])));
@@ -0,0 +1,137 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * A performance benchmark for lookups in the in-memory IndexTree, using
+ * string keys with a long common prefix, such as "user:0000012345".
+ */
+
+#include <algorithm>
+
+#include "Common.h"
+#include "Context.h"
+#include "Cycles.h"
+#include "IndexTree.h"
+#include "OptionParser.h"
+
+namespace RAMCloud {
+
+void
+indexTreeBenchmark(uint64_t numKeys, string keyPrefix)
+{
+    std::vector<string> keys;
+    keys.reserve(numKeys);
+    for (uint64_t i = 0; i < numKeys; i++)
+        keys.push_back(format("%s%010lu", keyPrefix.c_str(), i));
+    std::vector<uint64_t> order;
+    order.reserve(numKeys);
+    for (uint64_t i = 0; i < numKeys; i++)
+        order.push_back(i);
+    std::random_shuffle(order.begin(), order.end());
+
+    printf("index tree keys: %lu\n", numKeys);
+    printf("key length: %lu\n", keys.empty() ? 0 : keys[0].length());
+    printf("populating tree...");
+    fflush(stdout);
+    IndexTree tree;
+    uint64_t insertCycles = Cycles::rdtsc();
+    foreach (uint64_t i, order) {
+        tree.insert(BtreeEntry(keys[i].c_str(),
+                               downCast<KeyLength>(keys[i].length()), i));
+    }
+    insertCycles = Cycles::rdtsc() - insertCycles;
+    printf("done!\n");
+    printf("== insert() took %.3f s ==\n", Cycles::toSeconds(insertCycles));
+    printf("    external avg: %lu ticks, %lu nsec\n",
+           insertCycles / numKeys,
+           Cycles::toNanoseconds(insertCycles / numKeys));
+
+    // Time lookups once with each way of scanning the heads of nodes that
+    // this machine supports.
+    struct {
+        IndexTree::SearchImplementation implementation;
+        const char* name;
+    } implementations[] = {
+        { IndexTree::SEARCH_SCALAR, "scalar" },
+        { IndexTree::SEARCH_SSE42, "SSE 4.2" },
+        { IndexTree::SEARCH_AVX2, "AVX2" },
+    };
+    IndexTree::SearchImplementation original =
+        IndexTree::getSearchImplementation();
+    for (uint32_t impl = 0; impl < arrayLength(implementations); impl++) {
+        if (IndexTree::setSearchImplementation(
+                implementations[impl].implementation) !=
+                implementations[impl].implementation) {
+            printf("skipping %s lookups: not supported by this processor\n",
+                   implementations[impl].name);
+            continue;
+        }
+        printf("running %s lookup measurements...",
+               implementations[impl].name);
+        fflush(stdout);
+
+        uint64_t found = 0;
+        uint64_t lookupCycles = Cycles::rdtsc();
+        foreach (uint64_t i, order) {
+            IndexTree::iterator it = tree.lower_bound(BtreeEntry(
+                    keys[i].c_str(), downCast<KeyLength>(keys[i].length()),
+                    0UL));
+            if (it != tree.end() && (*it).pKHash == i)
+                found++;
+        }
+        lookupCycles = Cycles::rdtsc() - lookupCycles;
+        printf("done!\n");
+        if (found != numKeys) {
+            printf("ERROR: only found %lu of %lu keys\n", found, numKeys);
+        }
+
+        printf("== %s lower_bound() took %.3f s ==\n",
+               implementations[impl].name, Cycles::toSeconds(lookupCycles));
+        printf("    external avg: %lu ticks, %lu nsec\n",
+               lookupCycles / numKeys,
+               Cycles::toNanoseconds(lookupCycles / numKeys));
+    }
+    IndexTree::setSearchImplementation(original);
+}
+
+} // namespace RAMCloud
+
+int
+main(int argc, char **argv)
+{
+    using namespace RAMCloud;
+
+    Context context(true);
+
+    uint64_t numberOfKeys;
+    string keyPrefix;
+
+    OptionsDescription benchmarkOptions("IndexTreeBenchmark");
+    benchmarkOptions.add_options()
+        ("NumberOfKeys,n",
+         ProgramOptions::value<uint64_t>(&numberOfKeys)->
+            default_value(1000000),
+         "Number of keys to insert into the IndexTree")
+        ("KeyPrefix,p",
+         ProgramOptions::value<string>(&keyPrefix)->
+            default_value("user:"),
+         "String that every key starts with");
+
+    OptionParser optionParser(benchmarkOptions, argc, argv);
+
+    indexTreeBenchmark(numberOfKeys, keyPrefix);
+    return 0;
+}
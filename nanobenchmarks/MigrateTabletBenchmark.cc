@@ -18,6 +18,7 @@
 #include "Logger.h"
 #include "MasterService.h"
 #include "Memory.h"
+#include "MigrationSender.h"
 #include "SegmentIterator.h"
 #include "Seglet.h"
 #include "Tablets.pb.h"
@@ -117,27 +118,19 @@ class MigrateTabletBenchmark {
         metrics->temp.count8 =
         metrics->temp.count9 = 0;
 
-        Tub<Segment> transferSeg{};
-
-        uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
-        uint64_t totalBytes = 0;
-
         // Now run the send side of a fake migration.
+        MigrationSender sender(&context, service, ServerId(), 0, 0lu, ~0lu,
+                1, 1);
         uint64_t before = Cycles::rdtsc();
-        for (int i = 0; i < numSegments; i++) {
-            Segment* s = segments[i];
-            SegmentIterator it{*s};
-            while (!it.isDone()) {
-                Status r = service->migrateSingleLogEntry(
-                                it, transferSeg, entryTotals, totalBytes,
-                                0, 0lu, ~0lu,
-                                ServerId{});
-                if (r != STATUS_OK) {
-                    printf("Catastrophic failure\n");
-                    exit(-1);
-                }
-                it.next();
+        try {
+            for (int i = 0; i < numSegments; i++) {
+                SegmentIterator it{*segments[i]};
+                sender.scanSegment(it);
             }
+            sender.finish();
+        } catch (ClientException& e) {
+            printf("Catastrophic failure\n");
+            exit(-1);
         }
         uint64_t ticks = Cycles::rdtsc() - before;
 
@@ -36,6 +36,7 @@
 #include <cstdatomic>
 #endif
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -46,6 +47,7 @@
 #include "CycleCounter.h"
 #include "Dispatch.h"
 #include "Fence.h"
+#include "Key.h"
 #include "LockTable.h"
 #include "Memory.h"
 #include "MurmurHash3.h"
@@ -261,6 +263,13 @@ double bufferAppendCopy500()
     return bufferAppendCommon<500>();
 }
 
+// Measure the cost of appendCopy'ing 2000 bytes to a Buffer (this
+// exceeds the Buffer's internal storage)
+double bufferAppendCopy2000()
+{
+    return bufferAppendCommon<2000>();
+}
+
 // Measure the cost of appendExternal'ing 1 bytes to a Buffer
 double bufferAppendExternal1()
 {
@@ -592,6 +601,37 @@ double dispatchPoll()
     return Cycles::toSeconds(stop - start)/count;
 }
 
+// Measure the cost of Dispatch::poll with 10 Pollers that never find any
+// work. If cold is true, all but one of them are cold (see
+// Dispatch::Poller::setMaxSkip), as rarely-used pollers would be.
+template<bool cold>
+double dispatchPollIdle()
+{
+    class IdlePoller : public Dispatch::Poller {
+      public:
+        explicit IdlePoller(Dispatch* dispatch)
+            : Dispatch::Poller(dispatch, "IdlePoller") {}
+        int poll() {
+            return 0;
+        }
+    };
+    int count = 1000000;
+    Dispatch dispatch(false);
+    std::vector<std::unique_ptr<IdlePoller>> pollers;
+    for (int i = 0; i < 10; i++) {
+        pollers.emplace_back(new IdlePoller(&dispatch));
+        if (cold && (i > 0)) {
+            pollers.back()->setMaxSkip(64);
+        }
+    }
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++) {
+        dispatch.poll();
+    }
+    uint64_t stop = Cycles::rdtsc();
+    return Cycles::toSeconds(stop - start)/count;
+}
+
 // Measure the cost of a 32-bit divide. Divides don't take a constant
 // number of cycles. Values were chosen here semi-randomly to depict a
 // fairly expensive scenario. Someone with fancy ALU knowledge could
@@ -770,6 +810,28 @@ double hashTableLookup()
     return Cycles::toSeconds((stop - start) / numLookups);
 }
 
+// Compare two equal keys that aren't in the same place, as the hash table
+// does when it verifies a candidate object during a lookup.
+template <int keyLength>
+double keyCompare()
+{
+    int count = 1000000;
+    char buf1[keyLength], buf2[keyLength];
+    memset(buf1, 'k', sizeof(buf1));
+    memset(buf2, 'k', sizeof(buf2));
+    Key key1(1, buf1, sizeof(buf1));
+    Key key2(1, buf2, sizeof(buf2));
+    int equal = 0;
+
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++)
+        equal += (key1 == key2);
+    uint64_t stop = Cycles::rdtsc();
+
+    discard(&equal);
+    return Cycles::toSeconds(stop - start)/count;
+}
+
 // Measure the cost of an lfence instruction.
 double lfence()
 {
@@ -1509,6 +1571,28 @@ double vectorPushPop()
     return Cycles::toSeconds(stop - start)/(count*3);
 }
 
+// Benchmark the key hash used by tables created with Key::WYHASH, on
+// cached data; compare with murmur3, which the other tables use.
+template <int keyLength>
+double wyhash()
+{
+    int count = 100000;
+    char buf[keyLength];
+    memset(buf, 0, sizeof(buf));
+    uint64_t tableId = 99;
+    Key::setHashFunction(tableId, Key::WYHASH);
+    KeyHash sum = 0;
+
+    uint64_t start = Cycles::rdtsc();
+    for (int i = 0; i < count; i++)
+        sum += Key::getHash(tableId, buf, sizeof(buf));
+    uint64_t stop = Cycles::rdtsc();
+
+    Key::setHashFunction(tableId, Key::MURMUR3);
+    discard(&sum);
+    return Cycles::toSeconds(stop - start)/count;
+}
+
 // The following struct and table define each performance test in terms of
 // a string name and a function that implements the test.
 struct TestInfo {
@@ -1547,6 +1631,8 @@ TestInfo tests[] = {
      "appendCopy 250 bytes to a buffer"},
     {"bufferAppendCopy500", bufferAppendCopy500,
      "appendCopy 500 bytes to a buffer"},
+    {"bufferAppendCopy2000", bufferAppendCopy2000,
+     "appendCopy 2000 bytes to a buffer (extra storage)"},
     {"bufferAppendExternal1", bufferAppendExternal1,
      "appendExternal 1 byte to a buffer"},
     {"bufferAppendExternal50", bufferAppendExternal50,
@@ -1593,6 +1679,10 @@ TestInfo tests[] = {
      "Convert a rdtsc result to (uint64_t) nanoseconds"},
     {"dispatchPoll", dispatchPoll,
      "Dispatch::poll (no timers or pollers)"},
+    {"dispatchPollCold", dispatchPollIdle<true>,
+     "Dispatch::poll (1 hot and 9 cold idle pollers)"},
+    {"dispatchPollHot", dispatchPollIdle<false>,
+     "Dispatch::poll (10 idle hot pollers)"},
     {"div32", div32,
      "32-bit integer division instruction"},
     {"div64", div64,
@@ -1611,6 +1701,12 @@ TestInfo tests[] = {
      "Key lookup in a 1GB HashTable"},
     {"hashTableLookupPf", hashTableLookup<20>,
      "Key lookup in a 1GB HashTable with prefetching"},
+    {"keyCompare8", keyCompare<8>,
+     "Compare two equal 8-byte keys"},
+    {"keyCompare12", keyCompare<12>,
+     "Compare two equal 12-byte keys (generic path)"},
+    {"keyCompare16", keyCompare<16>,
+     "Compare two equal 16-byte keys"},
     {"lfence", lfence,
      "Lfence instruction"},
     {"lockInDispThrd", lockInDispThrd,
@@ -1689,6 +1785,10 @@ TestInfo tests[] = {
      "Lookup in std::unordered_map<uint64_t, uint64_t>"},
     {"vectorPushPop", vectorPushPop,
      "Push and pop a std::vector"},
+    {"wyhash", wyhash<1>,
+     "64-bit wyhash-style key hash on 1 byte of data"},
+    {"wyhash", wyhash<256>,
+     "64-bit wyhash-style key hash on 256 bytes of data"},
 };
 
 /**
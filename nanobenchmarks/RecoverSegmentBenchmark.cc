@@ -18,6 +18,7 @@
 #include "Logger.h"
 #include "MasterService.h"
 #include "Memory.h"
+#include "RecoverySegmentBuilder.h"
 #include "SegmentIterator.h"
 #include "Seglet.h"
 #include "Tablets.pb.h"
@@ -34,6 +35,13 @@ class RecoverSegmentBenchmark {
     MasterService* service;
     size_t numSegments;
     bool hwThreadsBeforeCores;
+    /// Number of versions of each key written (each in the same segment).
+    uint32_t versionsPerKey;
+    /// If true, the segments are turned into recovery segments (as backups
+    /// would) before they are replayed.
+    bool buildFirst;
+    /// If true, building recovery segments leaves out superseded versions.
+    bool dedup;
 
     std::atomic<size_t> next;
     std::vector<Segment*> segments;
@@ -45,13 +53,19 @@ class RecoverSegmentBenchmark {
         string logSize,
         string hashTableSize,
         size_t numSegments,
-        bool hwThreadsBeforeCores)
+        bool hwThreadsBeforeCores,
+        uint32_t versionsPerKey,
+        bool buildFirst,
+        bool dedup)
         : context()
         , config(ServerConfig::forTesting())
         , serverList(&context)
         , service(NULL)
         , numSegments{numSegments}
         , hwThreadsBeforeCores{hwThreadsBeforeCores}
+        , versionsPerKey{std::max(versionsPerKey, 1u)}
+        , buildFirst{buildFirst || dedup}
+        , dedup{dedup}
         , next{}
         , segments{}
         , nReady{}
@@ -124,19 +138,27 @@ class RecoverSegmentBenchmark {
     {
         /*
          * Allocate numSegments Segments and fill them up with objects of
-         * size dataLen. These will be the Segments that we recover.
+         * size dataLen, versionsPerKey versions of each key in turn. These
+         * will be the Segments that we recover.
          */
         uint64_t numObjects = 0;
         uint64_t nextKeyVal = 0;
         for (size_t i = 0; i < numSegments; i++) {
             segments.push_back(new Segment());
+            if (buildFirst) {
+                SegmentHeader header(1, i, Segment::DEFAULT_SEGMENT_SIZE);
+                segments[i]->append(LOG_ENTRY_TYPE_SEGHEADER,
+                                    &header, sizeof(header));
+            }
             while (1) {
-                Key key(0, &nextKeyVal, sizeof(nextKeyVal));
+                uint64_t keyVal = nextKeyVal / versionsPerKey;
+                Key key(0, &keyVal, sizeof(keyVal));
 
                 char objectData[dataLen];
 
                 Buffer dataBuffer;
-                Object object(key, objectData, dataLen, 0, 0, dataBuffer);
+                Object object(key, objectData, dataLen,
+                              nextKeyVal % versionsPerKey + 1, 0, dataBuffer);
 
                 Buffer buffer;
                 object.assembleForLog(buffer);
@@ -148,6 +170,41 @@ class RecoverSegmentBenchmark {
             segments[i]->close();
         }
 
+        /*
+         * Optionally split each segment into a recovery segment the way a
+         * backup would, and replay those instead.
+         */
+        uint64_t buildTicks = 0;
+        uint64_t recoveryBytes = 0;
+        if (buildFirst) {
+            ProtoBuf::RecoveryPartition partitions;
+            ProtoBuf::Tablets::Tablet& tablet(*partitions.add_tablet());
+            tablet.set_table_id(0);
+            tablet.set_start_key_hash(0);
+            tablet.set_end_key_hash(~0UL);
+            tablet.set_state(ProtoBuf::Tablets::Tablet::NORMAL);
+            tablet.set_user_data(0);
+            tablet.set_ctime_log_head_id(0);
+            tablet.set_ctime_log_head_offset(0);
+            for (Segment*& segment : segments) {
+                Buffer buffer;
+                segment->appendToBuffer(buffer);
+                SegmentCertificate certificate;
+                segment->getAppendedLength(&certificate);
+                const void* contigSeg = buffer.getRange(0, buffer.size());
+
+                Segment* recoverySegment = new Segment();
+                uint64_t start = Cycles::rdtsc();
+                RecoverySegmentBuilder::build(contigSeg, buffer.size(),
+                                              certificate, 1, partitions,
+                                              recoverySegment, dedup);
+                buildTicks += Cycles::rdtsc() - start;
+                recoveryBytes += recoverySegment->getAppendedLength();
+                delete segment;
+                segment = recoverySegment;
+            }
+        }
+
         /* Update the list of Tablets */
         service->tabletManager.addTablet(0, 0, ~0UL, TabletManager::NORMAL);
 
@@ -200,7 +257,14 @@ class RecoverSegmentBenchmark {
         uint64_t totalSegmentBytes = uint64_t(numSegments) *
                                      Segment::DEFAULT_SEGMENT_SIZE;
 
-        printf("%lu threads\n", nThreads);
+        printf("%lu threads, %u versions per key\n", nThreads,
+               versionsPerKey);
+        if (buildFirst) {
+            printf("Building recovery segments%s took %lu ms; they hold "
+                "%lu bytes\n", dedup ? " with dedup" : "",
+                RAMCloud::Cycles::toNanoseconds(buildTicks) / 1000 / 1000,
+                recoveryBytes);
+        }
         printf("Recovery of %lu %uKB Segments with %u byte Objects took %lu "
             "ms\n", numSegments, Segment::DEFAULT_SEGMENT_SIZE / 1024,
             dataLen, RAMCloud::Cycles::toNanoseconds(ticks) / 1000 / 1000);
@@ -272,9 +336,12 @@ main(int argc, char* argv[])
     std::vector<uint32_t> dataLen{ 64, 128, 256, 512, 1024, 2048, 8192 };
     std::vector<size_t> nThreads{ 1, 2, 4, 8, 16 };
     bool hwThreadsBeforeCores = false;
+    uint32_t versionsPerKey = 1;
+    bool buildFirst = false;
+    bool dedup = false;
 
     int c;
-    while ((c = getopt(argc, argv, "t:s:h")) != -1) {
+    while ((c = getopt(argc, argv, "t:s:hv:bd")) != -1) {
       switch (c) {
         case 't':
           nThreads.clear();
@@ -287,6 +354,15 @@ main(int argc, char* argv[])
         case 'h':
           hwThreadsBeforeCores = true;
           break;
+        case 'v':
+          versionsPerKey = RAMCloud::downCast<uint32_t>(atol(optarg));
+          break;
+        case 'b':
+          buildFirst = true;
+          break;
+        case 'd':
+          dedup = true;
+          break;
       }
     }
 
@@ -295,7 +371,9 @@ main(int argc, char* argv[])
             printf("==========================\n");
             RAMCloud::RecoverSegmentBenchmark rsb{"8192", "10%",
                                                   numSegments,
-                                                  hwThreadsBeforeCores};;
+                                                  hwThreadsBeforeCores,
+                                                  versionsPerKey,
+                                                  buildFirst, dedup};
             rsb.run(len, threads);
         }
     }
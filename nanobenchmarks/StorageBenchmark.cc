@@ -0,0 +1,811 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * This program measures the storage paths of a master in isolation: raw
+ * Buffer operations, Segment::append, Log::append, ObjectManager::writeObject,
+ * relocation of entries by the log cleaner (ObjectManager::relocate) and
+ * recovery replay (ObjectManager::replaySegment). Each benchmark is run once
+ * for every combination of object size, key distribution and log utilization
+ * it depends on, and reports the average time per operation.
+ *
+ * Results can be written to a JSON file with --json; a file written that way
+ * can later be given to --baseline, in which case every result is compared
+ * against the baseline and the program exits with status 1 if any of them
+ * got slower by more than --threshold percent.
+ */
+
+#include <cmath>
+#include <fstream>
+
+#include "Cycles.h"
+#include "Logger.h"
+#include "LogEntryRelocator.h"
+#include "MasterTableMetadata.h"
+#include "ObjectManager.h"
+#include "OptionParser.h"
+#include "SegmentIterator.h"
+#include "Seglet.h"
+#include "StringUtil.h"
+#include "TabletManager.h"
+
+namespace RAMCloud {
+
+/**
+ * One combination of the parameters that benchmarks are run with.
+ */
+struct Parameters {
+    Parameters()
+        : objectSize(0)
+        , distribution()
+        , utilization(0)
+        , segments(0)
+        , logSize()
+        , hashTableSize()
+    {}
+
+    /// Length of the value of each object, in bytes.
+    uint32_t objectSize;
+
+    /// Name of the key distribution: "uniform" or "zipfian".
+    string distribution;
+
+    /// Percentage of the data in the log that is live; determines how many
+    /// distinct keys are written.
+    int utilization;
+
+    /// Number of segments' worth of data each benchmark writes.
+    uint32_t segments;
+
+    /// Log and hash table sizes for benchmarks that need an ObjectManager, in
+    /// the format accepted by ServerConfig::setLogAndHashTableSize.
+    string logSize;
+    string hashTableSize;
+};
+
+/**
+ * The outcome of one benchmark run.
+ */
+struct Result {
+    Result()
+        : name()
+        , operations(0)
+        , bytes(0)
+        , seconds(0)
+    {}
+
+    /// Benchmark name followed by the parameters it used, e.g.
+    /// "relocate/size=100/dist=zipfian/util=90".
+    string name;
+
+    /// Number of operations timed.
+    uint64_t operations;
+
+    /// Total number of object bytes those operations handled.
+    uint64_t bytes;
+
+    /// Total time spent in the timed operations.
+    double seconds;
+
+    double
+    nsPerOp() const
+    {
+        return (operations == 0) ? 0 : 1e09 * seconds /
+                static_cast<double>(operations);
+    }
+
+    double
+    mbPerSec() const
+    {
+        return (seconds == 0) ? 0 : static_cast<double>(bytes) / seconds /
+                (1024 * 1024);
+    }
+};
+
+/**
+ * Used to generate zipfian distributed random numbers where the distribution
+ * is skewed toward the lower integers. This is the same algorithm as the
+ * ZipfianGenerator in ClusterPerf (from "Quickly Generating Billion-Record
+ * Synthetic Databases", Jim Gray et al, SIGMOD 1994).
+ */
+class ZipfianGenerator {
+  public:
+    explicit ZipfianGenerator(uint64_t n, double theta = 0.99)
+        : n(n)
+        , theta(theta)
+        , alpha(1 / (1 - theta))
+        , zetan(zeta(n, theta))
+        , eta((1 - pow(2.0 / static_cast<double>(n), 1 - theta)) /
+              (1 - zeta(2, theta) / zetan))
+    {}
+
+    uint64_t
+    nextNumber()
+    {
+        double u = static_cast<double>(generateRandom()) /
+                   static_cast<double>(~0UL);
+        double uz = u * zetan;
+        if (uz < 1)
+            return 0;
+        if (uz < 1 + std::pow(0.5, theta))
+            return 1;
+        return static_cast<uint64_t>(static_cast<double>(n) *
+                                     std::pow(eta*u - eta + 1.0, alpha));
+    }
+
+  private:
+    const uint64_t n;
+    const double theta;
+    const double alpha;
+    const double zetan;
+    const double eta;
+
+    static double
+    zeta(uint64_t n, double theta)
+    {
+        double sum = 0;
+        for (uint64_t i = 0; i < n; i++)
+            sum = sum + 1.0/(std::pow(static_cast<double>(i + 1), theta));
+        return sum;
+    }
+};
+
+/**
+ * Picks keys between 0 and numKeys-1 according to the distribution named in
+ * the benchmark parameters.
+ */
+class KeyChooser {
+  public:
+    KeyChooser(uint64_t numKeys, const string& distribution)
+        : numKeys(numKeys)
+        , zipfian()
+    {
+        if (distribution == "zipfian")
+            zipfian.construct(numKeys);
+    }
+
+    uint64_t
+    next()
+    {
+        if (zipfian)
+            return zipfian->nextNumber() % numKeys;
+        return generateRandom() % numKeys;
+    }
+
+  private:
+    uint64_t numKeys;
+    Tub<ZipfianGenerator> zipfian;
+
+    DISALLOW_COPY_AND_ASSIGN(KeyChooser);
+};
+
+/**
+ * Returns the number of bytes one object with the given value length
+ * occupies in a segment, including its entry header.
+ */
+static uint32_t
+entryLength(uint32_t objectSize)
+{
+    uint64_t keyInt = 0;
+    Key key(0, &keyInt, sizeof(keyInt));
+    std::vector<char> value(objectSize);
+    Buffer dataBuffer;
+    Object object(key, value.data(), objectSize, 0, 0, dataBuffer);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    Segment::appendLogHeader(LOG_ENTRY_TYPE_OBJ, buffer.size(), &buffer);
+    return buffer.size();
+}
+
+/**
+ * Returns the number of distinct keys to write so that, once 'segments'
+ * segments have been filled, roughly 'utilization' percent of the objects
+ * in them are live.
+ */
+static uint64_t
+keyCount(const Parameters& p)
+{
+    uint64_t perSegment = Segment::DEFAULT_SEGMENT_SIZE /
+            entryLength(p.objectSize);
+    return std::max(uint64_t(1), perSegment * p.segments * p.utilization / 100);
+}
+
+/**
+ * A master's storage stack (ObjectManager and everything it needs) with no
+ * replication, no cleaner and one tablet covering all of table 0.
+ */
+class StorageBenchmark {
+  public:
+    Context context;
+    ClusterClock clusterClock;
+    ClientLeaseValidator clientLeaseValidator;
+    ServerConfig config;
+    ServerList serverList;
+    TabletManager tabletManager;
+    MasterTableMetadata masterTableMetadata;
+    UnackedRpcResults unackedRpcResults;
+    TransactionManager transactionManager;
+    TxRecoveryManager txRecoveryManager;
+    ServerId serverId;
+    ObjectManager* objectManager;
+
+    explicit StorageBenchmark(const Parameters& p)
+        : context()
+        , clusterClock()
+        , clientLeaseValidator(&context, &clusterClock)
+        , config(ServerConfig::forTesting())
+        , serverList(&context)
+        , tabletManager()
+        , masterTableMetadata()
+        , unackedRpcResults(&context,
+                            NULL,
+                            &clientLeaseValidator,
+                            &tabletManager)
+        , transactionManager(&context, NULL, &unackedRpcResults, &tabletManager)
+        , txRecoveryManager(&context)
+        , serverId(1, 1)
+        , objectManager(NULL)
+    {
+        config.localLocator = "bogus";
+        config.coordinatorLocator = "bogus";
+        config.setLogAndHashTableSize(p.logSize, p.hashTableSize);
+        config.services = {};
+        config.master.numReplicas = 0;
+        config.master.disableLogCleaner = true;
+        config.segmentSize = Segment::DEFAULT_SEGMENT_SIZE;
+        config.segletSize = Seglet::DEFAULT_SEGLET_SIZE;
+        objectManager = new ObjectManager(&context,
+                                          &serverId,
+                                          &config,
+                                          &tabletManager,
+                                          &masterTableMetadata,
+                                          &unackedRpcResults,
+                                          &transactionManager,
+                                          &txRecoveryManager);
+        unackedRpcResults.resetFreer(objectManager);
+        tabletManager.addTablet(0, 0, ~0UL, TabletManager::NORMAL);
+    }
+
+    ~StorageBenchmark()
+    {
+        delete objectManager;
+    }
+
+    /**
+     * Write objects with writeObject until 'p.segments' segments have been
+     * closed. Every key is written once, in order, and after that keys are
+     * overwritten according to the key distribution.
+     *
+     * \param p
+     *      Parameters of the benchmark.
+     * \param[out] closed
+     *      The segments that were closed are appended here, oldest first.
+     * \param[out] result
+     *      Filled in with the time spent in writeObject.
+     */
+    void
+    fillLog(const Parameters& p, std::vector<LogSegment*>* closed,
+            Result* result)
+    {
+        uint64_t numKeys = keyCount(p);
+        KeyChooser chooser(numKeys, p.distribution);
+        std::vector<char> value(p.objectSize);
+        LogSegment* lastHead = NULL;
+        uint64_t ticks = 0;
+        for (uint64_t i = 0; closed->size() < p.segments; i++) {
+            uint64_t keyInt = (i < numKeys) ? i : chooser.next();
+            Key key(0, &keyInt, sizeof(keyInt));
+            Buffer dataBuffer;
+            Object object(key, value.data(), p.objectSize, 0, 0, dataBuffer);
+
+            uint64_t start = Cycles::rdtsc();
+            Status status = objectManager->writeObject(object, NULL, NULL);
+            ticks += Cycles::rdtsc() - start;
+            if (status != STATUS_OK)
+                DIE("Failed to write object (%s); increase --logSize",
+                    statusToString(status));
+            result->operations++;
+            result->bytes += p.objectSize;
+
+            LogSegment* current = head();
+            if (current != lastHead) {
+                if (lastHead != NULL)
+                    closed->push_back(lastHead);
+                lastHead = current;
+            }
+        }
+        result->seconds = Cycles::toSeconds(ticks);
+    }
+
+    /**
+     * Returns the log's current head segment.
+     */
+    LogSegment*
+    head()
+    {
+        return objectManager->log.head;
+    }
+
+    /**
+     * Append one entry directly to the log, bypassing the hash table.
+     */
+    bool
+    logAppend(Buffer& buffer)
+    {
+        return objectManager->log.append(LOG_ENTRY_TYPE_OBJ, buffer);
+    }
+
+    /**
+     * Allocate a survivor segment for relocate(), the same way the log
+     * cleaner does (but from the regular side log pool, since the cleaner's
+     * reserve is only a few segments).
+     */
+    LogSegment*
+    allocSurvivor()
+    {
+        LogSegment* survivor =
+                objectManager->segmentManager.allocSideSegment();
+        if (survivor == NULL)
+            DIE("Out of memory for survivor segments; increase --logSize");
+        return survivor;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(StorageBenchmark);
+};
+
+/**
+ * Measure Buffer::appendCopy of one value followed by Buffer::reset.
+ */
+void
+bufferAppendCopy(const Parameters& p, Result* result)
+{
+    std::vector<char> value(p.objectSize);
+    const uint64_t count = 1000000;
+    Buffer buffer;
+    uint64_t start = Cycles::rdtsc();
+    for (uint64_t i = 0; i < count; i++) {
+        buffer.appendCopy(value.data(), p.objectSize);
+        buffer.reset();
+    }
+    result->seconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+    result->operations = count;
+    result->bytes = count * p.objectSize;
+}
+
+/**
+ * Measure Buffer::getRange on a value split across two external chunks,
+ * which forces the range to be copied into contiguous space.
+ */
+void
+bufferGetRange(const Parameters& p, Result* result)
+{
+    std::vector<char> value(p.objectSize);
+    uint32_t half = p.objectSize / 2;
+    const uint64_t count = 1000000;
+    Buffer buffer;
+    uint64_t ticks = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        buffer.appendExternal(value.data(), half);
+        buffer.appendExternal(value.data() + half, p.objectSize - half);
+        uint64_t start = Cycles::rdtsc();
+        buffer.getRange(0, p.objectSize);
+        ticks += Cycles::rdtsc() - start;
+        buffer.reset();
+    }
+    result->seconds = Cycles::toSeconds(ticks);
+    result->operations = count;
+    result->bytes = count * p.objectSize;
+}
+
+/**
+ * Measure Segment::append of pre-assembled objects into standalone segments.
+ */
+void
+segmentAppend(const Parameters& p, Result* result)
+{
+    uint64_t keyInt = 0;
+    Key key(0, &keyInt, sizeof(keyInt));
+    std::vector<char> value(p.objectSize);
+    Buffer dataBuffer;
+    Object object(key, value.data(), p.objectSize, 0, 0, dataBuffer);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+
+    uint64_t ticks = 0;
+    for (uint32_t i = 0; i < p.segments; i++) {
+        Segment segment;
+        uint64_t start = Cycles::rdtsc();
+        while (segment.append(LOG_ENTRY_TYPE_OBJ, buffer))
+            result->operations++;
+        ticks += Cycles::rdtsc() - start;
+    }
+    result->seconds = Cycles::toSeconds(ticks);
+    result->bytes = result->operations * p.objectSize;
+}
+
+/**
+ * Measure Log::append of pre-assembled objects (no hash table updates).
+ */
+void
+logAppend(const Parameters& p, Result* result)
+{
+    StorageBenchmark bench(p);
+    uint64_t keyInt = 0;
+    Key key(0, &keyInt, sizeof(keyInt));
+    std::vector<char> value(p.objectSize);
+    Buffer dataBuffer;
+    Object object(key, value.data(), p.objectSize, 0, 0, dataBuffer);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+
+    bench.logAppend(buffer);
+    uint64_t lastSegmentId = bench.head()->id + p.segments;
+    uint64_t start = Cycles::rdtsc();
+    while (bench.head()->id < lastSegmentId) {
+        if (!bench.logAppend(buffer))
+            DIE("Log::append failed; increase --logSize");
+        result->operations++;
+    }
+    result->seconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+    result->bytes = result->operations * p.objectSize;
+}
+
+/**
+ * Measure ObjectManager::writeObject (log append plus hash table update,
+ * including the tombstones written for overwrites).
+ */
+void
+writeObject(const Parameters& p, Result* result)
+{
+    StorageBenchmark bench(p);
+    std::vector<LogSegment*> closed;
+    bench.fillLog(p, &closed, result);
+}
+
+/**
+ * Measure ObjectManager::relocate: fill the log, then move every entry of
+ * the closed segments into survivor segments, as the cleaner would. Dead
+ * entries are part of the count, since the cleaner has to examine them too.
+ */
+void
+relocate(const Parameters& p, Result* result)
+{
+    StorageBenchmark bench(p);
+    std::vector<LogSegment*> closed;
+    Result fill;
+    bench.fillLog(p, &closed, &fill);
+
+    ObjectManager* objectManager = bench.objectManager;
+    LogSegment* survivor = bench.allocSurvivor();
+    uint64_t ticks = 0;
+    foreach (LogSegment* segment, closed) {
+        for (SegmentIterator it(*segment); !it.isDone(); it.next()) {
+            LogEntryType type = it.getType();
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            Log::Reference reference = segment->getReference(it.getOffset());
+
+            uint64_t start = Cycles::rdtsc();
+            while (1) {
+                LogEntryRelocator relocator(survivor, buffer.size());
+                objectManager->relocate(type, buffer, reference, relocator);
+                if (!relocator.failed())
+                    break;
+                survivor->close();
+                survivor = bench.allocSurvivor();
+            }
+            ticks += Cycles::rdtsc() - start;
+            result->operations++;
+            result->bytes += buffer.size();
+        }
+    }
+    survivor->close();
+    result->seconds = Cycles::toSeconds(ticks);
+}
+
+/**
+ * Measure ObjectManager::replaySegment on standalone segments holding
+ * objects whose keys follow the key distribution; lower utilizations mean
+ * more replayed objects are superseded by newer versions.
+ */
+void
+replaySegment(const Parameters& p, Result* result)
+{
+    StorageBenchmark bench(p);
+    KeyChooser chooser(keyCount(p), p.distribution);
+    std::vector<char> value(p.objectSize);
+    std::vector<Segment*> segments;
+    uint64_t version = 1;
+    for (uint32_t i = 0; i < p.segments; i++) {
+        Segment* segment = new Segment();
+        segments.push_back(segment);
+        while (1) {
+            uint64_t keyInt = chooser.next();
+            Key key(0, &keyInt, sizeof(keyInt));
+            Buffer dataBuffer;
+            Object object(key, value.data(), p.objectSize, version, 0,
+                          dataBuffer);
+            Buffer buffer;
+            object.assembleForLog(buffer);
+            if (!segment->append(LOG_ENTRY_TYPE_OBJ, buffer))
+                break;
+            version++;
+            result->operations++;
+        }
+        segment->close();
+    }
+
+    ObjectManager* objectManager = bench.objectManager;
+    SideLog sideLog(objectManager->getLog());
+    ObjectManager::TombstoneProtector _(objectManager);
+    uint64_t ticks = 0;
+    foreach (Segment* segment, segments) {
+        Buffer buffer;
+        segment->appendToBuffer(buffer);
+        SegmentCertificate certificate;
+        segment->getAppendedLength(&certificate);
+        const void* contiguous = buffer.getRange(0, buffer.size());
+        SegmentIterator it(contiguous, buffer.size(), certificate);
+
+        uint64_t start = Cycles::rdtsc();
+        objectManager->replaySegment(&sideLog, it);
+        ticks += Cycles::rdtsc() - start;
+        delete segment;
+    }
+    sideLog.commit();
+    result->seconds = Cycles::toSeconds(ticks);
+    result->bytes = result->operations * p.objectSize;
+}
+
+/**
+ * Describes one benchmark and which parameters it depends on; benchmarks
+ * are run once per distinct combination of the parameters they use.
+ */
+struct BenchmarkInfo {
+    const char* name;
+    void (*func)(const Parameters&, Result*);
+    bool usesDistribution;
+    bool usesUtilization;
+    const char* description;
+};
+
+BenchmarkInfo benchmarks[] = {
+    {"bufferAppendCopy", bufferAppendCopy, false, false,
+     "Buffer::appendCopy of one value, then Buffer::reset"},
+    {"bufferGetRange", bufferGetRange, false, false,
+     "Buffer::getRange of a value split across 2 external chunks"},
+    {"segmentAppend", segmentAppend, false, false,
+     "Segment::append of an assembled object"},
+    {"logAppend", logAppend, false, false,
+     "Log::append of an assembled object"},
+    {"writeObject", writeObject, true, true,
+     "ObjectManager::writeObject (log append + hash table)"},
+    {"relocate", relocate, true, true,
+     "ObjectManager::relocate, per entry scanned"},
+    {"replaySegment", replaySegment, true, true,
+     "ObjectManager::replaySegment, per entry replayed"},
+};
+
+/**
+ * Parse a comma-separated list of integers (e.g. "100,1000").
+ */
+static std::vector<uint32_t>
+parseList(const string& list)
+{
+    std::vector<uint32_t> values;
+    foreach (const string& item, StringUtil::split(list, ',')) {
+        if (!item.empty())
+            values.push_back(downCast<uint32_t>(strtoul(item.c_str(),
+                                                        NULL, 10)));
+    }
+    return values;
+}
+
+/**
+ * Write results as JSON, one result per line (readBaseline depends on that).
+ */
+static void
+writeJson(const string& fileName, const std::vector<Result>& results)
+{
+    FILE* f = fopen(fileName.c_str(), "w");
+    if (f == NULL)
+        DIE("Couldn't open %s: %s", fileName.c_str(), strerror(errno));
+    fprintf(f, "{\n  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"operations\": %lu, "
+                "\"nsPerOp\": %.2f, \"mbPerSec\": %.2f}%s\n",
+                r.name.c_str(), r.operations, r.nsPerOp(), r.mbPerSec(),
+                (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+/**
+ * Read the nsPerOp of each result from a file written by writeJson.
+ */
+static std::map<string, double>
+readBaseline(const string& fileName)
+{
+    std::map<string, double> baseline;
+    std::ifstream in(fileName.c_str());
+    if (!in)
+        DIE("Couldn't open baseline %s", fileName.c_str());
+    string line;
+    while (std::getline(in, line)) {
+        const string nameTag = "\"name\": \"";
+        const string nsTag = "\"nsPerOp\": ";
+        size_t name = line.find(nameTag);
+        size_t ns = line.find(nsTag);
+        if (name == string::npos || ns == string::npos)
+            continue;
+        name += nameTag.size();
+        size_t nameEnd = line.find('"', name);
+        if (nameEnd == string::npos)
+            continue;
+        baseline[line.substr(name, nameEnd - name)] =
+                strtod(line.c_str() + ns + nsTag.size(), NULL);
+    }
+    return baseline;
+}
+
+/**
+ * Print how each result compares to the baseline.
+ *
+ * \return
+ *      The number of results that are slower than the baseline by more
+ *      than 'threshold' percent.
+ */
+static int
+compareToBaseline(const std::vector<Result>& results,
+                  const std::map<string, double>& baseline, double threshold)
+{
+    int regressions = 0;
+    printf("\n%-45s %12s %12s %8s\n", "Comparison with baseline",
+           "baseline", "current", "change");
+    foreach (const Result& r, results) {
+        std::map<string, double>::const_iterator it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) {
+            printf("%-45s %12s %10.1fns\n", r.name.c_str(), "-", r.nsPerOp());
+            continue;
+        }
+        double change = 100 * (r.nsPerOp() - it->second) / it->second;
+        bool regressed = change > threshold;
+        if (regressed)
+            regressions++;
+        printf("%-45s %10.1fns %10.1fns %+7.1f%%%s\n", r.name.c_str(),
+               it->second, r.nsPerOp(), change,
+               regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+}  // namespace RAMCloud
+
+using namespace RAMCloud;
+
+int
+main(int argc, char* argv[])
+try
+{
+    Parameters p;
+    string sizes, utilizations, distributions, only, jsonFile, baselineFile;
+    double threshold;
+
+    OptionsDescription benchOptions("StorageBenchmark");
+    benchOptions.add_options()
+        ("benchmarks",
+         ProgramOptions::value<string>(&only)->default_value(""),
+         "Comma-separated names of the benchmarks to run (default: all).")
+        ("sizes",
+         ProgramOptions::value<string>(&sizes)->default_value("100,1000"),
+         "Comma-separated object value sizes, in bytes.")
+        ("distributions",
+         ProgramOptions::value<string>(&distributions)->
+            default_value("uniform,zipfian"),
+         "Comma-separated key distributions: \"uniform\" and/or "
+         "\"zipfian\".")
+        ("utilizations",
+         ProgramOptions::value<string>(&utilizations)->
+            default_value("50,90"),
+         "Comma-separated percentages of live data in the log.")
+        ("segments",
+         ProgramOptions::value<uint32_t>(&p.segments)->default_value(20),
+         "Number of segments' worth of data each benchmark writes.")
+        ("logSize",
+         ProgramOptions::value<string>(&p.logSize)->default_value("2048"),
+         "Log memory for benchmarks that use an ObjectManager, in MB.")
+        ("hashTableSize",
+         ProgramOptions::value<string>(&p.hashTableSize)->
+            default_value("10%"),
+         "Hash table memory, in MB or as a percentage of the log.")
+        ("json",
+         ProgramOptions::value<string>(&jsonFile)->default_value(""),
+         "Write the results as JSON to this file.")
+        ("baseline",
+         ProgramOptions::value<string>(&baselineFile)->default_value(""),
+         "Compare the results with a file written earlier by --json.")
+        ("threshold",
+         ProgramOptions::value<double>(&threshold)->default_value(10),
+         "Percentage slowdown relative to the baseline that counts as a "
+         "regression.");
+    OptionParser optionParser(benchOptions, argc, argv);
+    Logger::get().setLogLevels(WARNING);
+
+    std::vector<string> selected = StringUtil::split(only, ',');
+    std::vector<string> distributionList =
+            StringUtil::split(distributions, ',');
+    foreach (const string& d, distributionList) {
+        if (d != "uniform" && d != "zipfian")
+            DIE("Unknown key distribution \"%s\"", d.c_str());
+    }
+    std::vector<uint32_t> sizeList = parseList(sizes);
+    std::vector<uint32_t> utilizationList = parseList(utilizations);
+    foreach (uint32_t u, utilizationList) {
+        if (u < 1 || u > 100)
+            DIE("Utilization must be between 1 and 100, not %u", u);
+    }
+
+    std::vector<Result> results;
+    foreach (BenchmarkInfo& info, benchmarks) {
+        if (!only.empty() && std::find(selected.begin(), selected.end(),
+                info.name) == selected.end())
+            continue;
+        std::vector<string> dists = info.usesDistribution ?
+                distributionList : std::vector<string>{"uniform"};
+        std::vector<uint32_t> utils = info.usesUtilization ?
+                utilizationList : std::vector<uint32_t>{100};
+        foreach (uint32_t size, sizeList) {
+            foreach (const string& dist, dists) {
+                foreach (uint32_t util, utils) {
+                    p.objectSize = size;
+                    p.distribution = dist;
+                    p.utilization = downCast<int>(util);
+                    Result result;
+                    result.name = format("%s/size=%u", info.name, size);
+                    if (info.usesDistribution)
+                        result.name += "/dist=" + dist;
+                    if (info.usesUtilization)
+                        result.name += format("/util=%u", util);
+                    info.func(p, &result);
+                    printf("%-45s %10.1fns %10.1fMB/s  %s\n",
+                           result.name.c_str(), result.nsPerOp(),
+                           result.mbPerSec(), info.description);
+                    fflush(stdout);
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    if (!jsonFile.empty())
+        writeJson(jsonFile, results);
+    if (!baselineFile.empty()) {
+        int regressions = compareToBaseline(results,
+                readBaseline(baselineFile), threshold);
+        if (regressions > 0) {
+            printf("%d result(s) regressed by more than %.1f%%\n",
+                   regressions, threshold);
+            return 1;
+        }
+    }
+    return 0;
+}
+catch (std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+}
@@ -304,6 +304,14 @@ def run_test(
         client_args['--spannedOps'] = options.spannedOps
     if options.fullSamples:
         client_args['--fullSamples'] = ''
+    if options.loadLevels != None:
+        client_args['--loadLevels'] = options.loadLevels
+    if options.pipelineDepth != None:
+        client_args['--pipelineDepth'] = options.pipelineDepth
+    if options.traceFile != None:
+        client_args['--traceFile'] = options.traceFile
+    if options.traceSpeedup != None:
+        client_args['--traceSpeedup'] = options.traceSpeedup
     if options.seconds:
         client_args['--seconds'] = options.seconds
     test.function(test.name, options, cluster_args, client_args)
@@ -343,6 +351,19 @@ def basic(name, options, cluster_args, client_args):
         cluster_args['timeout'] = 250
     default(name, options, cluster_args, client_args)
 
+def backgroundInterference(name, options, cluster_args, client_args):
+    # Migration and recovery need a second master, and recovery also needs
+    # backups for the killed master's replicas.
+    if options.num_servers == None:
+        cluster_args['num_servers'] = 4
+    if name == 'cleanerInterference':
+        # Keep the log small, so that the cleaner has to run at high
+        # utilization (100000 objects of 100 bytes take about 20 MB).
+        defaultTo(cluster_args, 'master_args', '-t 64')
+    if cluster_args['timeout'] < 200:
+        cluster_args['timeout'] = 200
+    default(name, options, cluster_args, client_args)
+
 def broadcast(name, options, cluster_args, client_args):
     if 'num_clients' not in cluster_args:
         cluster_args['num_clients'] = 10
@@ -568,6 +589,50 @@ def netBandwidth(name, options, cluster_args, client_args):
         client_args['--size'] = 1024*1024;
     default(name, options, cluster_args, client_args)
 
+def transportMatrix(name, options, cluster_args, client_args):
+    """
+    Run the transportMatrix test once for each transport in
+    options.transports (by default, every transport that TransportManager
+    knows about), and print the results as a single table with an extra
+    column for the transport. Transports that can't be used on this
+    cluster (no driver for their hardware, or not compiled in) are listed
+    in a comment and skipped.
+    """
+    if 'master_args' not in cluster_args:
+        cluster_args['master_args'] = '-t 4000'
+    if cluster_args['timeout'] < 250:
+        cluster_args['timeout'] = 250
+    cluster_args['replicas'] = 0
+    if options.num_servers == None:
+        cluster_args['num_servers'] = 1
+    if options.transports != None:
+        transports = options.transports.split(',')
+    else:
+        transports = ['tcp', 'basic+udp', 'basic+infud', 'infrc',
+                'basic+dpdk', 'basic+sf', 'basic+xdp']
+    printedHeader = False
+    unavailable = []
+    for transport in transports:
+        cluster_args['transport'] = transport
+        try:
+            cluster.run(client='%s/apps/ClusterPerf %s %s' %
+                    (config.hooks.get_remote_obj_path(),
+                     flatten_args(client_args), name), **cluster_args)
+        except Exception as e:
+            unavailable.append('%s (%s)' % (transport,
+                    str(e).split('\n')[0]))
+            continue
+        for line in get_client_log().splitlines():
+            if line.startswith('#'):
+                if not printedHeader:
+                    print('#            %s' % (line[1:]))
+            elif line.strip() != '':
+                print('%-12s %s' % (transport, line))
+        printedHeader = True
+        sys.stdout.flush()
+    for transport in unavailable:
+        print('# Not available: %s' % (transport))
+
 def readAllToAll(name, options, cluster_args, client_args):
     cluster_args['backup_disks_per_server'] = 0
     cluster_args['replicas'] = 0
@@ -646,6 +711,22 @@ def readThroughput(name, options, cluster_args, client_args):
         return
     default(name, options, cluster_args, client_args)
 
+def traceReplay(name, options, cluster_args, client_args):
+    if options.traceFile == None:
+        print("The traceReplay benchmark needs a trace; use --traceFile")
+        return
+    # The replay takes as long as the trace (divided by any speedup), so
+    # allow plenty of time; use --timeout for longer traces.
+    if cluster_args['timeout'] < 600:
+        cluster_args['timeout'] = 600
+    default(name, options, cluster_args, client_args)
+
+def ycsb(name, options, cluster_args, client_args):
+    # Loading the records takes a while before the --seconds of the run.
+    if cluster_args['timeout'] < options.seconds + 300:
+        cluster_args['timeout'] = options.seconds + 300
+    default(name, options, cluster_args, client_args)
+
 def txCollision(name, options, cluster_args, client_args):
     if cluster_args['timeout'] < 100:
         cluster_args['timeout'] = 100
@@ -810,6 +891,7 @@ simple_tests = [
 ]
 
 graph_tests = [
+    Test("cleanerInterference", backgroundInterference),
     Test("indexBasic", indexBasic),
     Test("indexRange", indexRange),
     Test("indexMultiple", indexMultiple),
@@ -827,9 +909,12 @@ graph_tests = [
     Test("readDistWorkload", workloadDist),
     Test("readInterference", default),
     Test("readLoaded", readLoaded),
+    Test("readOpenLoop", default),
     Test("readRandom", readRandom),
     Test("readThroughput", readThroughput),
     Test("readVaryingKeyLength", default),
+    Test("traceReplay", traceReplay),
+    Test("transportMatrix", transportMatrix),
     Test("transaction_collision", txCollision),
     Test("transaction_oneMaster", multiOp),
     Test("transactionContention", transactionThroughput),
@@ -841,9 +926,13 @@ graph_tests = [
     Test("writeDistRandom", writeDist),
     Test("writeDistWorkload", workloadDist),
     Test("writeInterference", default),
+    Test("writeOpenLoop", default),
+    Test("ycsb", ycsb),
     Test("writeThroughput", readThroughput),
     Test("workloadThroughput", readThroughput),
     Test("migrateLoaded", migrateLoaded),
+    Test("migrationInterference", backgroundInterference),
+    Test("recoveryInterference", backgroundInterference),
 ]
 
 if __name__ == '__main__':
@@ -904,14 +993,20 @@ if __name__ == '__main__':
             help='Ethernet port that the DPDK driver should use')
     parser.add_option('-T', '--transport', default='basic+infud',
             help='Transport to use for communication with servers')
+    parser.add_option('--transports', metavar='LIST',
+            help='Comma-separated list of transports to compare in the '
+            'transportMatrix test (default: all that TransportManager '
+            'supports)')
     parser.add_option('-v', '--verbose', action='store_true', default=False,
             help='Print progress messages')
     parser.add_option('-w', '--warmup', type=int,
             help='Number of times to execute operating before '
             'starting measurements')
     parser.add_option('--workload', default='YCSB-A',
-            choices=['YCSB-A', 'YCSB-B', 'YCSB-C', 'WRITE-ONLY'],
-            help='Name of workload to run on extra clients to generate load')
+            choices=['YCSB-A', 'YCSB-B', 'YCSB-C', 'YCSB-D', 'YCSB-E',
+                     'YCSB-F', 'WRITE-ONLY'],
+            help='Name of workload to run on extra clients to generate load; '
+                 'ycsb accepts YCSB-A through YCSB-F')
     parser.add_option('--targetOps', type=int,
             help='Operations per second that each load generating client '
             'will try to achieve')
@@ -955,6 +1050,19 @@ if __name__ == '__main__':
             action='store_true', default=False, dest='fullSamples',
             help='Run with alternate sample format that includes sample '
                  'timestamps along with their durations.')
+    parser.add_option('--loadLevels', type=int, dest='loadLevels',
+            help='For readOpenLoop and writeOpenLoop, the number of load '
+                 'levels to measure, up to --targetOps per client; the '
+                 'benchmark\'s --seconds are divided among them.')
+    parser.add_option('--pipelineDepth', type=int, dest='pipelineDepth',
+            help='For ycsb, the number of requests each client keeps '
+                 'outstanding.')
+    parser.add_option('--traceFile', dest='traceFile',
+            help='For traceReplay, the request trace to replay; it must be '
+                 'readable at the same path on every client machine.')
+    parser.add_option('--traceSpeedup', type=float, dest='traceSpeedup',
+            help='For traceReplay, replay the trace this many times faster '
+                 'than it was captured.')
     parser.add_option('--superuser', action='store_true', default=False,
             help='Start the cluster and clients as superuser')
     (options, args) = parser.parse_args()
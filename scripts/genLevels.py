@@ -42,6 +42,9 @@ import sys
 # the Opcode enum in WireFormat.h.
 
 callees = {
+    "APPEND":                ["BACKUP_WRITE"],
+    "BACKUP_WRITE_CHAIN":    ["BACKUP_WRITE"],
+    "BULK_LOAD":             ["BACKUP_WRITE"],
     "COORD_SPLIT_AND_MIGRATE_INDEXLET":
                              ["SPLIT_AND_MIGRATE_INDEXLET",
                               "TAKE_TABLET_OWNERSHIP",
@@ -52,21 +55,28 @@ callees = {
     "DROP_INDEX":            ["DROP_TABLET_OWNERSHIP"],
     "DROP_TABLE":            ["TAKE_TABLET_OWNERSHIP"],
     "FILL_WITH_TEST_DATA":   ["BACKUP_WRITE"],
+    "GET_CACHED_TABLE_CONFIG": ["GET_TABLE_CONFIG"],
     "GET_HEAD_OF_LOG":       ["BACKUP_WRITE"],
     "HINT_SERVER_CRASHED":   ["PING"],
     "INCREMENT":             ["BACKUP_WRITE"],
+    "INDEX_ENTRY_BATCH":     ["BACKUP_WRITE"],
     "INSERT_INDEX_ENTRY":    ["BACKUP_WRITE"],
+    "LOOKUP_INDEX_KEYS_AND_READ": ["BACKUP_WRITE"],
     "MIGRATE_TABLET":        ["RECEIVE_MIGRATION_DATA",
                               "REASSIGN_TABLET_OWNERSHIP"],
-    "MULTI_OP":              ["BACKUP_WRITE", "INSERT_INDEX_ENTRY",
-                              "REMOVE_INDEX_ENTRY"],
-    "READ":                  ["BACKUP_WRITE"],
+    "MULTI_OP":              ["BACKUP_WRITE", "INDEX_ENTRY_BATCH",
+                              "INSERT_INDEX_ENTRY", "REMOVE_INDEX_ENTRY"],
+    "PATCH":                 ["BACKUP_WRITE"],
+    "READ":                  ["BACKUP_WRITE", "UPDATE_HOT_REPLICA"],
     "READ_HASHES":           ["BACKUP_WRITE"],
     "READ_KEYS_AND_VALUE":   ["BACKUP_WRITE"],
+    "READ_RANGE":            ["BACKUP_WRITE"],
+    "READ_TABLE_SNAPSHOT":   ["BACKUP_WRITE"],
     "REASSIGN_TABLET_OWNERSHIP": ["TAKE_TABLET_OWNERSHIP"],
     "RECEIVE_MIGRATION_DATA":["BACKUP_WRITE"],
     "RECOVER":               ["BACKUP_GETRECOVERYDATA", "BACKUP_WRITE"],
-    "REMOVE":                ["BACKUP_WRITE", "REMOVE_INDEX_ENTRY"],
+    "REMOVE":                ["BACKUP_WRITE", "INDEX_ENTRY_BATCH",
+                              "REMOVE_INDEX_ENTRY", "UPDATE_HOT_REPLICA"],
     "REMOVE_INDEX_ENTRY":    ["BACKUP_WRITE"],
     "SERVER_CONTROL_ALL":    ["SERVER_CONTROL"],
     "SPLIT_AND_MIGRATE_INDEXLET":
@@ -76,8 +86,9 @@ callees = {
     "TX_HINT_FAILED":        ["BACKUP_WRITE"],
     "TX_PREPARE":            ["BACKUP_WRITE"],
     "TX_REQUEST_ABORT":      ["BACKUP_WRITE"],
-    "WRITE":                 ["BACKUP_WRITE", "INSERT_INDEX_ENTRY",
-                              "REMOVE_INDEX_ENTRY"],
+    "WRITE":                 ["BACKUP_WRITE", "INDEX_ENTRY_BATCH",
+                              "INSERT_INDEX_ENTRY", "REMOVE_INDEX_ENTRY",
+                              "UPDATE_HOT_REPLICA"],
 }
 
 # The following dictionary maps from the name of an opcode to its
@@ -163,6 +163,9 @@ coordinator.metric('recoveryTicks', 'elapsed time during recoveries')
 coordinator.metric('recoveryBuildReplicaMapTicks',
                    'time contacting backups and finding replicas for crashed '
                    'master')
+coordinator.metric('recoveryPartitionTicks',
+                   'time partitioning the crashed master\'s tablets and '
+                   'telling backups about the partitions')
 coordinator.metric('recoveryStartTicks', 'time in Recovery::start')
 coordinator.metric('recoveryCompleteTicks',
     'time sending recovery complete RPCs to backups')
@@ -276,6 +279,10 @@ backup.metric('writeClearTicks',
     'time clearing segment memory during segment open')
 backup.metric('writeCopyBytes', 'bytes written to backup segments')
 backup.metric('writeCopyTicks', 'time copying data to backup segments')
+backup.metric('writePlacedBytes',
+    'bytes written to backup segments that the transport received in place')
+backup.metric('writeCopyFromReplicaBytes',
+    'bytes written to backup segments from other replicas on the backup')
 backup.metric('storageWriteCount', 'number of segment writes to disk')
 backup.metric('storageWriteBytes', 'bytes written to disk')
 backup.metric('storageWriteTicks', 'time writing to disk')
@@ -283,6 +290,10 @@ backup.metric('filterTicks', 'time filtering segments')
 backup.metric('primaryLoadCount', 'number of primary segments requested')
 backup.metric('secondaryLoadCount', 'number of secondary segments requested')
 backup.metric('storageType', '1 = in-memory, 2 = on-disk')
+backup.metric('stagedFlushCount',
+    'number of batches of staged replicas flushed to disk')
+backup.metric('stagedFramesFlushed',
+    'number of staged replicas flushed to disk after they were closed')
 backup.metric('uncommittedFramesFreed', 'number of segment frames freed before being fully flushed to disk')
 
 # This class records basic statistics for RPCs (count & execution time).
@@ -180,16 +180,57 @@ def recover(num_servers,
     stats = {}
     stats['metrics'] = recoverymetrics.parseRecovery(recovery_logs)
     report = recoverymetrics.makeReport(stats['metrics']).jsonable()
+    phaseReport = recoverymetrics.makePhaseReport(stats['metrics']).jsonable()
     f = open('%s/metrics' % recovery_logs, 'w')
     getDumpstr().print_report(report, file=f)
+    getDumpstr().print_report(phaseReport, file=f)
     f.close()
     stats['run'] = recovery_logs
     stats['count'] = num_objects
     stats['size'] = object_size
     stats['ns'] = stats['metrics'].client.recoveryNs
     stats['report'] = report
+    stats['phaseReport'] = phaseReport
     return stats
 
+def sweep(sizes, total_bytes, **kwargs):
+    """Run one recovery for each object size in sizes, each with about
+    total_bytes of live objects on the crashed master, and print a table
+    with the time of each phase of each recovery (the slowest server's, for
+    phases that run on several servers).
+
+    @param sizes: Object sizes in bytes.
+    @type  sizes: C{list} of C{int}
+
+    @param total_bytes: Bytes of object data to fill the old master with.
+    @type  total_bytes: C{int}
+
+    @param kwargs: Other arguments for recover().
+
+    @return: A list with the stats returned by recover() for each run.
+    """
+    runs = []
+    for size in sizes:
+        kwargs['object_size'] = size
+        kwargs['num_objects'] = max(1, total_bytes // size)
+        runs.append(insist(**kwargs))
+
+    phases = [phase for phase, points in
+              recoverymetrics.phaseTimes(runs[0]['metrics'])]
+    print('%-40s' % 'Object size (bytes)' +
+          ''.join(['%10d' % (run['size']) for run in runs]))
+    print('%-40s' % 'Objects' +
+          ''.join(['%10d' % (run['count']) for run in runs]))
+    print('%-40s' % 'Recovery time (ms)' +
+          ''.join(['%10.1f' % (run['ns'] / 1e6) for run in runs]))
+    for i, phase in enumerate(phases):
+        line = '%-40s' % ('%s (ms)' % phase)
+        for run in runs:
+            points = recoverymetrics.phaseTimes(run['metrics'])[i][1]
+            line += '%10.1f' % (max([0] + [p[1] for p in points]) * 1e3)
+        print(line)
+    return runs
+
 def insist(*args, **kwargs):
     """Keep trying recoveries until the damn thing succeeds"""
     while True:
@@ -272,6 +313,14 @@ if __name__ == '__main__':
     parser.add_option('--trend',
             dest='trends', action='append',
             help='Add to dumpstr trend line (may be repeated)')
+    parser.add_option('--phases', action='store_true', default=False,
+            help='Print only the time each backup and recovery master '
+                 'spent in each phase of the recovery, and upload nothing')
+    parser.add_option('--sweepSizes', metavar='SIZES', default='',
+            dest='sweep_sizes',
+            help='Comma-separated object sizes: run one recovery for each, '
+                 'with as much data as --size and --numObjects give, and '
+                 'print a table of the time spent in each recovery phase')
     (options, args) = parser.parse_args()
 
     args = {}
@@ -298,9 +347,18 @@ if __name__ == '__main__':
     args['master_args'] = options.master_args
     args['backup_args'] = options.backup_args
 
+    if options.sweep_sizes:
+        sizes = [int(size) for size in options.sweep_sizes.split(',')]
+        sweep(sizes, options.size * options.num_objects, **args)
+        sys.exit(0)
+
     try:
         stats = recover(**args)
 
+        if options.phases:
+            getDumpstr().print_report(stats['phaseReport'])
+            sys.exit(0)
+
         # set up trend points for dumpstr
         trends = ['recovery']
         if options.trends is not None:
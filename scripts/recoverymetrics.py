@@ -33,7 +33,7 @@ import sys
 
 from common import *
 
-__all__ = ['parseRecovery', 'makeReport']
+__all__ = ['parseRecovery', 'makeReport', 'makePhaseReport', 'phaseTimes']
 
 ### Utilities:
 
@@ -994,6 +994,74 @@ def makeReport(data):
 
     return report
 
+def phaseTimes(data):
+    """Break a recovery down into its phases.
+
+    Returns a list of (phase name, points) pairs in the order the phases
+    start, where points is a list of (serverId, seconds) pairs giving the
+    time each server that took part in the phase spent in it. Phases on the
+    coordinator have a single point. The phases overlap: recovery masters
+    replay and re-replicate while backups are still reading and filtering
+    replicas.
+    """
+
+    coord = data.coordinator
+    masters = data.masters
+    backups = data.backups
+
+    def on_coordinator(fun):
+        return [(coord.serverId, fun(coord) / coord.clockFrequency)]
+
+    def on_masters(fun):
+        return [(m.serverId, fun(m) / m.clockFrequency) for m in masters]
+
+    def on_backups(fun):
+        return [(b.serverId, fun(b) / b.clockFrequency) for b in backups]
+
+    # Logs from servers predating a metric have an empty AttrDict for it.
+    def ticks(value):
+        return value or 0
+
+    return [
+        ('Failure detection',
+         [(coord.serverId, data.client.failureDetectionNs / 1e9)]),
+        ('Partitioning',
+         on_coordinator(lambda c:
+                        ticks(c.coordinator.recoveryPartitionTicks))),
+        ('Finding replicas',
+         on_coordinator(lambda c:
+                        c.coordinator.recoveryBuildReplicaMapTicks -
+                        ticks(c.coordinator.recoveryPartitionTicks))),
+        ('Backup read',
+         on_backups(lambda b: b.backup.storageReadTicks)),
+        ('Recovery segment build',
+         on_backups(lambda b: b.backup.filterTicks)),
+        ('Transfer (masters stalled on backups)',
+         on_masters(lambda m: m.master.segmentReadStallTicks)),
+        ('Replay',
+         on_masters(lambda m: m.master.recoverSegmentTicks -
+                              m.master.backupInRecoverTicks)),
+        ('Re-replication',
+         on_masters(lambda m: m.master.replicationTicks)),
+        ('Final log sync',
+         on_masters(lambda m: m.master.logSyncTicks)),
+        ('Recovery master total',
+         on_masters(lambda m: m.master.recoveryTicks)),
+        ('Backup total',
+         on_backups(lambda b: b.backup.recoveryTicks)),
+    ]
+
+def makePhaseReport(data):
+    """Generate a report with the time each backup and recovery master
+    spent in each phase of the recovery (see phaseTimes)."""
+
+    recoveryTime = data.client.recoveryNs / 1e9
+    report = Report()
+    section = report.add(Section('Recovery Phases'))
+    for phase, points in phaseTimes(data):
+        section.ms(phase, points, total=recoveryTime)
+    return report
+
 def main():
     ### Parse command line options
     parser = OptionParser()
@@ -1003,6 +1071,9 @@ def main():
     parser.add_option('-a', '--all',
         dest='all', action='store_true',
         help='Print out all raw data not just a sample')
+    parser.add_option('-p', '--phases',
+        dest='phases', action='store_true',
+        help='Print only the time each server spent in each recovery phase')
     options, args = parser.parse_args()
     if len(args) > 0:
         recovery_dir = args[0]
@@ -1017,7 +1088,10 @@ def main():
         else:
             rawSample(data)
 
-    report = makeReport(data).jsonable()
+    if options.phases:
+        report = makePhaseReport(data).jsonable()
+    else:
+        report = makeReport(data).jsonable()
     getDumpstr().print_report(report)
 
 if __name__ == '__main__':
@@ -0,0 +1,283 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2026 Stanford University
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""
+This program stitches the RpcTrace events found in the time traces of
+several machines into one timeline per sampled request, and prints the
+request's critical path: how much of its latency went to each network
+hop, to queueing on each server, and to execution on each server.
+
+Usage: rpctrace.py [options] trace_file trace_file ...
+
+Each trace file holds the time trace of one process (a client or a server),
+either as returned by the GET_TIME_TRACE server control or as printed to a
+log by LOG_TIME_TRACE. Processes are named after their files in the output.
+
+The time traces of different machines use unrelated time origins. Their
+offsets are estimated from the traced RPCs themselves: every RPC whose
+sender and receiver are both traced yields an NTP-style estimate from its
+four timestamps (send, arrival, finish, reply), and the median estimate
+for each pair of processes is used. This program should be run from the
+top-level RAMCloud source directory (it reads opcode names from
+src/WireFormat.h).
+"""
+
+from __future__ import division, print_function
+from optparse import OptionParser
+import os
+import re
+import sys
+
+# Matches one RpcTrace event in time trace output; see eventFormats in
+# src/RpcTrace.cc.
+eventPattern = re.compile(r'([0-9.]+) ns \(\+ *[-0-9.]+ ns\): '
+        r'rpctrace ([0-9]+) span ([0-9]+): (sent|reply received|'
+        r'request arrived|service started|service finished),? '
+        r'opcode ([0-9]+)(?:, parent ([0-9]+))?')
+
+def read_opcode_names():
+    """
+    Returns a dictionary mapping opcode numbers to names, read from
+    src/WireFormat.h (an empty dictionary if the file can't be found).
+    """
+    names = {}
+    if not os.path.exists("src/WireFormat.h"):
+        return names
+    inEnum = False
+    for line in open("src/WireFormat.h"):
+        if not inEnum:
+            inEnum = "enum Opcode {" in line
+            continue
+        if "};" in line:
+            break
+        match = re.match(' *([^ ]*) *= *([0-9]*),', line)
+        if match:
+            names[int(match.group(2))] = match.group(1)
+    return names
+
+class Span:
+    """
+    Holds everything known about one traced RPC. The client side (send,
+    reply) and the server side (arrive, start, finish) generally come from
+    different trace files. All times are in nanoseconds, in the time base
+    of the file they came from, until align() converts them.
+    """
+    def __init__(self, trace, span):
+        self.trace = trace
+        self.span = span
+        self.opcode = None
+        self.parent = 0
+        self.client = None
+        self.server = None
+        self.send = None
+        self.reply = None
+        self.arrive = None
+        self.start = None
+        self.finish = None
+        self.children = []
+
+    def complete(self):
+        """
+        Returns True if both sides of the RPC were captured.
+        """
+        return ((self.send is not None) and (self.reply is not None) and
+                (self.arrive is not None) and (self.start is not None) and
+                (self.finish is not None))
+
+def read_spans(files):
+    """
+    Parse the given trace files and return a dictionary mapping
+    (trace id, span id) to Span objects.
+    """
+    spans = {}
+    for name in files:
+        for line in open(name):
+            match = eventPattern.search(line)
+            if not match:
+                continue
+            time = float(match.group(1))
+            key = (int(match.group(2)), int(match.group(3)))
+            event = match.group(4)
+            if key not in spans:
+                spans[key] = Span(key[0], key[1])
+            span = spans[key]
+            span.opcode = int(match.group(5))
+            if event == "sent":
+                # Retries reuse the span; the last send is the one that
+                # got answered.
+                span.client = name
+                span.send = time
+                span.parent = int(match.group(6))
+            elif event == "reply received":
+                if span.reply is None:
+                    span.reply = time
+            elif event == "request arrived":
+                span.server = name
+                span.arrive = time
+            elif event == "service started":
+                span.start = time
+            elif event == "service finished":
+                span.finish = time
+    return spans
+
+def median(values):
+    values = sorted(values)
+    middle = len(values) // 2
+    if len(values) % 2:
+        return values[middle]
+    return (values[middle - 1] + values[middle]) / 2
+
+def compute_offsets(spans, files):
+    """
+    Estimate the clock offset of each trace file relative to the first
+    one. Returns a dictionary mapping file names to offsets in ns (time
+    in the first file = time in the other file - offset); files that
+    couldn't be related to the first one are missing.
+    """
+    samples = {}
+    for span in spans.values():
+        if not span.complete() or (span.client == span.server):
+            continue
+        estimate = ((span.arrive - span.send) +
+                (span.finish - span.reply)) / 2
+        samples.setdefault((span.client, span.server), []).append(estimate)
+        samples.setdefault((span.server, span.client), []).append(-estimate)
+
+    offsets = {files[0]: 0.0}
+    pending = [files[0]]
+    while pending:
+        known = pending.pop()
+        for (a, b), estimates in samples.items():
+            if (a == known) and (b not in offsets):
+                offsets[b] = offsets[a] + median(estimates)
+                pending.append(b)
+    return offsets
+
+def align(spans, offsets):
+    """
+    Convert the times in each span to the time base of the first file.
+    Spans with a side in a file whose offset is unknown are dropped.
+    """
+    for key in list(spans.keys()):
+        span = spans[key]
+        if ((span.client is not None) and (span.client not in offsets)) or \
+                ((span.server is not None) and (span.server not in offsets)):
+            del spans[key]
+            continue
+        if span.client is not None:
+            span.send -= offsets[span.client]
+            if span.reply is not None:
+                span.reply -= offsets[span.client]
+        if span.server is not None:
+            offset = offsets[span.server]
+            span.arrive -= offset
+            if span.start is not None:
+                span.start -= offset
+            if span.finish is not None:
+                span.finish -= offset
+
+def critical_path(span, names, pieces, depth):
+    """
+    Append to pieces the critical path of a complete span, as a list of
+    (depth, description, duration in ns). Within the server's execution,
+    the path works backwards from the finish time, following whichever
+    child RPC completed last before each point.
+    """
+    opName = names.get(span.opcode, "opcode %d" % (span.opcode))
+    pieces.append((depth, "%s: %s -> %s" % (opName, span.client,
+            span.server), span.arrive - span.send))
+    pieces.append((depth, "%s: queued on %s" % (opName, span.server),
+            span.start - span.arrive))
+
+    # Walk backwards from the finish time, collecting (child, time
+    # executing on the server after that child replied).
+    chain = []
+    t = span.finish
+    children = [c for c in span.children if c.complete()]
+    while True:
+        candidates = [c for c in children
+                if (c.reply <= t) and (c.send >= span.start)]
+        if not candidates:
+            break
+        child = max(candidates, key=lambda c: c.reply)
+        chain.append((child, t - child.reply))
+        t = child.send
+        children = [c for c in children if c.reply <= t]
+    pieces.append((depth, "%s: executing on %s" % (opName, span.server),
+            t - span.start))
+    for child, after in reversed(chain):
+        critical_path(child, names, pieces, depth + 1)
+        pieces.append((depth, "%s: executing on %s" % (opName, span.server),
+                after))
+    pieces.append((depth, "%s: %s -> %s" % (opName, span.server,
+            span.client), span.reply - span.finish))
+
+def print_trace(root, names):
+    """
+    Print the critical path of one sampled request.
+    """
+    opName = names.get(root.opcode, "opcode %d" % (root.opcode))
+    print("Trace %d: %s from %s, %.1f us" % (root.trace, opName,
+            root.client, (root.reply - root.send) / 1000))
+    pieces = []
+    critical_path(root, names, pieces, 1)
+    for depth, description, duration in pieces:
+        if duration < 0.05:
+            # Pieces that round to zero (e.g. when a child RPC is issued
+            # the moment service starts) only add clutter.
+            continue
+        print("%s%-60s %9.1f ns" % ("  " * depth, description, duration))
+    print("")
+
+def main():
+    parser = OptionParser(description=
+            'Stitch the RpcTrace events in several time traces into a '
+            'critical-path breakdown for each sampled request.',
+            usage='%prog [options] trace_file trace_file ...',
+            conflict_handler='resolve')
+    parser.add_option('-t', '--trace', type=int, dest='trace',
+            help='Print only the request with this trace id')
+    (options, files) = parser.parse_args()
+    if len(files) == 0:
+        parser.print_help()
+        sys.exit(1)
+
+    names = read_opcode_names()
+    spans = read_spans(files)
+    offsets = compute_offsets(spans, files)
+    for name in files:
+        if name not in offsets:
+            sys.stderr.write("No traced RPCs connect %s to %s; ignoring "
+                    "it\n" % (name, files[0]))
+        elif name != files[0]:
+            print("Clock offset of %s: %.1f ns" % (name, offsets[name]))
+    print("")
+    align(spans, offsets)
+
+    roots = []
+    for span in spans.values():
+        parent = spans.get((span.trace, span.parent))
+        if parent is not None:
+            parent.children.append(span)
+        elif span.complete() and (span.parent == 0):
+            roots.append(span)
+    roots.sort(key=lambda s: s.send)
+    for root in roots:
+        if (options.trace is None) or (options.trace == root.trace):
+            print_trace(root, names)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2026 Stanford University
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""
+This program decodes a time trace file written by a server's flight
+recorder (the --timeTraceFile option; see TimeTrace::FlightRecorder) and
+prints the events of all threads merged in time order, in the same form
+as TimeTrace::getTrace. Use --start and --end to print only a window
+around a latency spike.
+"""
+
+from __future__ import division, print_function
+from optparse import OptionParser
+import re
+import struct
+import sys
+
+MAGIC = 0x52545452
+FORMAT = 1
+EVENT = 2
+LOST = 3
+
+# printf length modifiers that Python's % operator doesn't understand.
+lengthModifiers = re.compile(
+        r'%([-+ #0]*[0-9]*(?:\.[0-9]+)?)(?:hh|h|ll|l|z|j|t)([diouxXc])')
+
+def pythonFormat(format):
+    """
+    Convert a C format string from a TimeTrace record into one that works
+    with Python's % operator.
+    """
+    return lengthModifiers.sub(r'%\1\2', format)
+
+def readEvents(f):
+    """
+    Read a flight recorder file and return (cyclesPerSecond, events, lost),
+    where events is a list of (timestamp, thread, message) tuples in the
+    order they appear in the file, and lost maps from thread index to the
+    number of events that were dropped.
+    """
+    data = f.read()
+    magic, version, cyclesPerSecond = struct.unpack_from('<IId', data, 0)
+    if magic != MAGIC:
+        raise Exception('not a time trace file')
+    if version != 1:
+        raise Exception('unknown time trace file version %d' % (version))
+    offset = struct.calcsize('<IId')
+
+    formats = {}
+    events = []
+    lost = {}
+    while offset < len(data):
+        recordType = struct.unpack_from('<B', data, offset)[0]
+        if recordType == FORMAT:
+            id, length = struct.unpack_from('<IH', data, offset + 1)
+            offset += 7
+            formats[id] = pythonFormat(
+                    data[offset:offset + length].decode('utf-8', 'replace'))
+            offset += length
+        elif recordType == EVENT:
+            fields = struct.unpack_from('<HIQIIII', data, offset + 1)
+            offset += 31
+            thread, formatId, timestamp = fields[0:3]
+            format = formats[formatId]
+            try:
+                message = format % fields[3:3 + format.count('%')
+                        - 2 * format.count('%%')]
+            except (TypeError, ValueError):
+                message = format
+            events.append((timestamp, thread, message))
+        elif recordType == LOST:
+            thread, count = struct.unpack_from('<HQ', data, offset + 1)
+            offset += 11
+            lost[thread] = lost.get(thread, 0) + count
+        else:
+            raise Exception('bad record type %d at offset %d' %
+                    (recordType, offset))
+    return cyclesPerSecond, events, lost
+
+def main():
+    parser = OptionParser(description=
+            'Print the events in a time trace file written by a server\'s '
+            'flight recorder, merged in time order.',
+            usage='%prog [options] file',
+            conflict_handler='resolve')
+    parser.add_option('--start', type=float, dest='start', default=0.0,
+            metavar='MS', help='Skip events that happened less than this '
+            'many milliseconds after the first one')
+    parser.add_option('--end', type=float, dest='end', default=None,
+            metavar='MS', help='Skip events that happened more than this '
+            'many milliseconds after the first one')
+    parser.add_option('--threads', action='store_true', default=False,
+            dest='threads', help='Prefix each event with the index of the '
+            'thread that recorded it')
+    (options, args) = parser.parse_args()
+    if len(args) != 1:
+        parser.print_help()
+        sys.exit(1)
+
+    with open(args[0], 'rb') as f:
+        cyclesPerSecond, events, lost = readEvents(f)
+    for thread in sorted(lost):
+        print('Thread %d lost %d events' % (thread, lost[thread]),
+                file=sys.stderr)
+    if not events:
+        print('No time trace events to print')
+        return
+
+    events.sort(key=lambda event: event[0])
+    firstTime = events[0][0]
+    prevNs = None
+    for timestamp, thread, message in events:
+        ns = (timestamp - firstTime) * 1e09 / cyclesPerSecond
+        if ns < options.start * 1e06:
+            continue
+        if options.end is not None and ns > options.end * 1e06:
+            break
+        if prevNs is None:
+            prevNs = ns
+        prefix = '[%2d] ' % (thread) if options.threads else ''
+        print('%8.1f ns (+%6.1f ns): %s%s' % (ns, ns - prevNs, prefix,
+                message))
+        prevNs = ns
+
+if __name__ == '__main__':
+    main()
@@ -50,13 +50,15 @@ AbstractLog::AbstractLog(LogEntryHandlers* entryHandlers,
       segmentSize(segmentSize),
       head(NULL),
       appendLock("AbstractLog::appendLock"),
+      pendingAppends(NULL),
       totalLiveBytes(0),
       maxLiveBytes(0),
       metrics()
 {
     SegletAllocator& alloc = segmentManager->getAllocator();
     maxLiveBytes = static_cast<uint64_t>(0.95 * alloc.getSegletSize() *
-            static_cast<double>(alloc.getTotalCount(SegletAllocator::DEFAULT)));
+            static_cast<double>(alloc.getTotalCount(SegletAllocator::DEFAULT) +
+                                alloc.getTotalCount(SegletAllocator::FLASH)));
 }
 
 /**
@@ -69,6 +71,14 @@ AbstractLog::AbstractLog(LogEntryHandlers* entryHandlers,
  * sync() method must be invoked after appending. Until sync() is called, the
  * data may or may not have been made durable.
  *
+ * Concurrent callers of this method are combined: each caller publishes its
+ * request on #pendingAppends, and whichever thread gets the append lock
+ * performs every request published so far before releasing it. Under
+ * contention this means the head segment's metadata stays in one core's
+ * cache for a whole batch of appends, and the append lock changes hands once
+ * per batch rather than once per write. The per-thread PerfStats for bytes
+ * appended are charged to the thread that did the combining.
+ *
  * \param appends
  *      Array containing the entries to append. References to the entries
  *      are also returned here.
@@ -82,9 +92,88 @@ bool
 AbstractLog::append(AppendVector* appends, uint32_t numAppends)
 {
     CycleCounter<uint64_t> _(&metrics.totalAppendTicks);
-    SpinLock::Guard lock(appendLock);
-    metrics.totalAppendCalls++;
 
+    PendingAppend request(appends, numAppends);
+    request.next = pendingAppends.load(std::memory_order_relaxed);
+    while (!pendingAppends.compare_exchange_weak(request.next, &request,
+            std::memory_order_release, std::memory_order_relaxed)) {
+        // request.next was updated with the current list head; retry.
+    }
+
+    // While another thread holds the lock it is most likely performing our
+    // request, so watch for that (only reading the lock, so its cache line
+    // isn't stolen from the holder) and try for the lock once it looks
+    // free. If the holder takes unusually long, block in SpinLock::lock,
+    // which knows when to sleep.
+    uint64_t spinDeadline = 0;
+    while (!request.done.load(std::memory_order_acquire)) {
+        if (appendLock.isLocked()) {
+            if (spinDeadline == 0) {
+                spinDeadline = Cycles::rdtsc() +
+                        Cycles::fromNanoseconds(COMBINE_SPIN_NS);
+            }
+            if (Cycles::rdtsc() < spinDeadline) {
+                __asm__ __volatile__("pause" ::: "memory");
+                continue;
+            }
+            appendLock.lock();
+        } else if (!appendLock.try_lock()) {
+            continue;
+        }
+        SpinLock::Guard lock(appendLock, std::adopt_lock);
+        spinDeadline = 0;
+
+        // Take every request published so far (ours included) and perform
+        // them in the order they arrived.
+        PendingAppend* pending =
+                pendingAppends.exchange(NULL, std::memory_order_acquire);
+        PendingAppend* inOrder = NULL;
+        while (pending != NULL) {
+            PendingAppend* next = pending->next;
+            pending->next = inOrder;
+            inOrder = pending;
+            pending = next;
+        }
+        while (inOrder != NULL) {
+            // The owner may return (destroying its request) as soon as it
+            // sees done set, so read the link first.
+            PendingAppend* next = inOrder->next;
+            metrics.totalAppendCalls++;
+            try {
+                inOrder->result = appendAtomically(lock, inOrder->appends,
+                                                   inOrder->numAppends);
+            } catch (...) {
+                inOrder->exception = std::current_exception();
+            }
+            inOrder->done.store(true, std::memory_order_release);
+            inOrder = next;
+        }
+    }
+
+    if (request.exception)
+        std::rethrow_exception(request.exception);
+    return request.result;
+}
+
+/**
+ * Helper for append(AppendVector*, uint32_t) that appends one set of entries
+ * atomically. See that method for details.
+ *
+ * \param lock
+ *      Ensures that the caller holds the append lock; not actually used.
+ * \param appends
+ *      Array containing the entries to append. References to the entries
+ *      are also returned here.
+ * \param numAppends
+ *      Number of entries in the appends array.
+ * \return
+ *      True if the append succeeded, false if there was insufficient space
+ *      to complete the operation.
+ */
+bool
+AbstractLog::appendAtomically(const SpinLock::Guard& lock,
+                              AppendVector* appends, uint32_t numAppends)
+{
     uint32_t lengths[numAppends];
     for (uint32_t i = 0; i < numAppends; i++)
         lengths[i] = appends[i].buffer.size();
@@ -94,14 +183,19 @@ AbstractLog::append(AppendVector* appends, uint32_t numAppends)
             return false;
     }
 
-    if (head->isEmergencyHead)
+    if (head->isEmergencyHead) {
+        metrics.totalNoSpaceAppends++;
         return false;
+    }
 
     if (!head->hasSpaceFor(lengths, numAppends))
         throw FatalError(HERE, "too much data to append to one segment");
 
     LogSegment* headBefore = head;
     for (uint32_t i = 0; i < numAppends; i++) {
+        appends[i].omitted = (appends[i].omitFromSegmentId == head->id);
+        if (appends[i].omitted)
+            continue;
         bool enoughSpace = append(lock,
                                   appends[i].type,
                                   appends[i].buffer,
@@ -140,8 +234,10 @@ AbstractLog::append(Buffer *logBuffer, Reference *references,
             return false;
     }
 
-    if (head->isEmergencyHead)
+    if (head->isEmergencyHead) {
+        metrics.totalNoSpaceAppends++;
         return false;
+    }
 
     if (!head->hasSpaceFor(logBuffer->size()))
         throw FatalError(HERE, "too much data to append to one segment");
@@ -199,7 +295,8 @@ AbstractLog::free(Reference reference)
     if (type == LOG_ENTRY_TYPE_OBJ ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
-        type == LOG_ENTRY_TYPE_TXPLIST)
+        type == LOG_ENTRY_TYPE_TXPLIST ||
+        type == LOG_ENTRY_TYPE_OBJDELTA)
         totalLiveBytes -= lengthWithMetadata;
 }
 
@@ -216,8 +313,14 @@ AbstractLog::getMetrics(ProtoBuf::LogMetrics& m)
     m.set_ticks_per_second(Cycles::perSecond());
     m.set_total_append_ticks(metrics.totalAppendTicks);
     m.set_total_no_space_ticks(metrics.totalNoSpaceTicks);
+    m.set_total_no_space_appends(metrics.totalNoSpaceAppends);
+    uint64_t noSpaceStart = metrics.noSpaceStart;
+    m.set_current_no_space_ticks(noSpaceStart == 0 ? 0 :
+            Cycles::rdtsc() - noSpaceStart);
     m.set_total_bytes_appended(metrics.totalBytesAppended);
     m.set_total_metadata_bytes_appended(metrics.totalMetadataBytesAppended);
+    m.set_total_padding_bytes(metrics.totalPaddingBytes);
+    m.set_total_straddling_entries(metrics.totalStraddlingEntries);
 
     segmentManager->getMetrics(*m.mutable_segment_metrics());
     segmentManager->getAllocator().getMetrics(*m.mutable_seglet_metrics());
@@ -390,12 +493,16 @@ AbstractLog::append(const SpinLock::Guard& lock,
     // Try to append. If we can't, try to allocate a new head to get more space.
     Reference reference;
     uint32_t bytesUsedBefore = head->getAppendedLength();
+    uint32_t paddingBefore = head->getPaddingBytes();
+    uint32_t straddlingBefore = head->getStraddlingEntries();
     bool enoughSpace = head->append(type, buffer, length, &reference);
     if (!enoughSpace) {
         if (!allocNewWritableHead())
             return false;
 
         bytesUsedBefore = head->getAppendedLength();
+        paddingBefore = head->getPaddingBytes();
+        straddlingBefore = head->getStraddlingEntries();
         if (!head->append(type, buffer, length, &reference)) {
             LOG(ERROR, "Entry too big to append to log: %u bytes of type %d",
                 length, static_cast<int>(type));
@@ -406,7 +513,14 @@ AbstractLog::append(const SpinLock::Guard& lock,
     if (outReference != NULL)
         *outReference = reference;
 
-    uint32_t lengthWithMetadata = head->getAppendedLength() - bytesUsedBefore;
+    // Padding put in front of the entry is dead from the start, so it
+    // doesn't count towards the entry's length.
+    uint32_t padding = head->getPaddingBytes() - paddingBefore;
+    uint32_t lengthWithMetadata = head->getAppendedLength() - bytesUsedBefore -
+                                  padding;
+    metrics.totalPaddingBytes += padding;
+    metrics.totalStraddlingEntries +=
+            head->getStraddlingEntries() - straddlingBefore;
 
     // Update log statistics so that the cleaner can make intelligent decisions
     // when trying to reclaim memory.
@@ -414,7 +528,8 @@ AbstractLog::append(const SpinLock::Guard& lock,
     if (type == LOG_ENTRY_TYPE_OBJ ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
-        type == LOG_ENTRY_TYPE_TXPLIST)
+        type == LOG_ENTRY_TYPE_TXPLIST ||
+        type == LOG_ENTRY_TYPE_OBJDELTA)
         totalLiveBytes += lengthWithMetadata;
 
     PerfStats::threadStats.logBytesAppended += lengthWithMetadata;
@@ -473,6 +588,7 @@ AbstractLog::append(const SpinLock::Guard& lock,
     LogEntryType type;
     uint32_t entryDataLength = 0;
     uint32_t bytesUsedBefore = head->getAppendedLength();
+    uint32_t straddlingBefore = head->getStraddlingEntries();
     bool enoughSpace = head->append(buffer, &entryDataLength,
                                     &type, &reference);
     if (!enoughSpace) {
@@ -480,6 +596,7 @@ AbstractLog::append(const SpinLock::Guard& lock,
             return false;
 
         bytesUsedBefore = head->getAppendedLength();
+        straddlingBefore = head->getStraddlingEntries();
         if (!head->append(buffer, &entryDataLength, &type, &reference)) {
             LOG(ERROR, "Entry too big to append to log: %u bytes of type %d",
                 entryDataLength, static_cast<int>(type));
@@ -491,6 +608,8 @@ AbstractLog::append(const SpinLock::Guard& lock,
         *outReference = reference;
 
     uint32_t lengthWithMetadata = head->getAppendedLength() - bytesUsedBefore;
+    metrics.totalStraddlingEntries +=
+            head->getStraddlingEntries() - straddlingBefore;
 
     if (entryLength)
         *entryLength = lengthWithMetadata;
@@ -501,7 +620,8 @@ AbstractLog::append(const SpinLock::Guard& lock,
     if (type == LOG_ENTRY_TYPE_OBJ ||
         type == LOG_ENTRY_TYPE_RPCRESULT ||
         type == LOG_ENTRY_TYPE_PREP ||
-        type == LOG_ENTRY_TYPE_TXPLIST)
+        type == LOG_ENTRY_TYPE_TXPLIST ||
+        type == LOG_ENTRY_TYPE_OBJDELTA)
         totalLiveBytes += lengthWithMetadata;
 
     PerfStats::threadStats.logBytesAppended += lengthWithMetadata;
@@ -571,26 +691,33 @@ AbstractLog::allocNewWritableHead()
     // failure and let the client retry. Hopefully the cleaner will free up
     // more memory soon.
     if (newHead == NULL || head->isEmergencyHead) {
-        if (!metrics.noSpaceTimer)
+        if (!metrics.noSpaceTimer) {
             metrics.noSpaceTimer.construct(&metrics.totalNoSpaceTicks);
+            metrics.noSpaceStart = Cycles::rdtsc();
+        }
+        metrics.totalNoSpaceAppends++;
         RAMCLOUD_CLOG(NOTICE, "No clean segments available; deferring "
                 "operations until cleaner runs");
         return false;
     }
 
-    if (metrics.noSpaceTimer)
+    if (metrics.noSpaceTimer) {
         metrics.noSpaceTimer.destroy();
+        metrics.noSpaceStart = 0;
+    }
 
     // Recompute maxLiveBytes. We do this here because the value can
     // change over time due to seglets being removed from the default
     // pool for other uses. Steve Rumble suggests that the correct
     // percentage of memory we allow to be used for live data is 98%,
     // but this code is more conservative because we expect performance
-    // to degrade at even lower utilizations.
+    // to degrade at even lower utilizations. Seglets on flash count too,
+    // since the cleaner moves cold objects there.
 
     SegletAllocator& alloc = segmentManager->getAllocator();
     maxLiveBytes = static_cast<uint64_t>(0.95 * alloc.getSegletSize() *
-            static_cast<double>(alloc.getTotalCount(SegletAllocator::DEFAULT)));
+            static_cast<double>(alloc.getTotalCount(SegletAllocator::DEFAULT) +
+                                alloc.getTotalCount(SegletAllocator::FLASH)));
 
     return true;
 }
@@ -17,6 +17,7 @@
 #define RAMCLOUD_ABSTRACTLOG_H
 
 #include <atomic>
+#include <exception>
 #include <stdint.h>
 #include <unordered_map>
 #include <vector>
@@ -76,7 +77,9 @@ class AbstractLog {
         AppendVector()
             : type(LOG_ENTRY_TYPE_INVALID),
               buffer(),
-              reference()
+              reference(),
+              omitFromSegmentId(Segment::INVALID_SEGMENT_ID),
+              omitted(false)
         {
         }
 
@@ -88,6 +91,16 @@ class AbstractLog {
 
         /// A log reference to the entry once appended is returned here.
         Reference reference;
+
+        /// If the entries end up in the segment with this identifier, this
+        /// one is left out (and #omitted is set) rather than appended. Used
+        /// for tombstones that would land in the same segment as the object
+        /// they kill.
+        uint64_t omitFromSegmentId;
+
+        /// Set to true if the entry was left out because of
+        /// #omitFromSegmentId; #reference is not valid in that case.
+        bool omitted;
     };
 
     /**
@@ -210,8 +223,52 @@ class AbstractLog {
                 Buffer& buffer,
                 Reference* outReference = NULL,
                 uint64_t* outTickCounter = NULL);
+    bool appendAtomically(const SpinLock::Guard& lock,
+                          AppendVector* appends,
+                          uint32_t numAppends);
     bool allocNewWritableHead();
 
+    /// How long append(AppendVector*, uint32_t) waits for another thread to
+    /// perform its request before blocking on #appendLock instead.
+    static const uint64_t COMBINE_SPIN_NS = 10000;
+
+    /**
+     * A request to append(AppendVector*, uint32_t) that is waiting to be
+     * performed by whichever thread holds the append lock. These live on
+     * the requesting thread's stack until #done is set.
+     */
+    struct PendingAppend {
+        PendingAppend(AppendVector* appends, uint32_t numAppends)
+            : appends(appends),
+              numAppends(numAppends),
+              result(false),
+              exception(),
+              done(false),
+              next(NULL)
+        {
+        }
+
+        /// The entries to append; see append(AppendVector*, uint32_t).
+        AppendVector* appends;
+
+        /// Number of entries in #appends.
+        uint32_t numAppends;
+
+        /// Return value of the append, valid once #done is set.
+        bool result;
+
+        /// Set if the append threw; rethrown in the requesting thread.
+        std::exception_ptr exception;
+
+        /// Set by the thread that performed the append once it is complete.
+        std::atomic<bool> done;
+
+        /// Next (earlier) request in #pendingAppends.
+        PendingAppend* next;
+
+        DISALLOW_COPY_AND_ASSIGN(PendingAppend);
+    };
+
     /// Various handlers for entries appended to this log. Used to obtain
     /// timestamps and to relocate entries during cleaning.
     LogEntryHandlers* entryHandlers;
@@ -248,6 +305,10 @@ class AbstractLog {
     /// segment in the presence of multiple appending threads.
     SpinLock appendLock;
 
+    /// Requests for atomic multi-entry appends that have not yet been
+    /// performed, most recent first. See append(AppendVector*, uint32_t).
+    std::atomic<PendingAppend*> pendingAppends;
+
     // Total amount of log space occupied by long-term data such as
     // objects. Excludes data that can eventually be cleaned, such
     // as tombstones.
@@ -271,8 +332,12 @@ class AbstractLog {
               totalAppendTicks(0),
               totalNoSpaceTicks(0),
               noSpaceTimer(),
+              noSpaceStart(0),
+              totalNoSpaceAppends(0),
               totalBytesAppended(0),
-              totalMetadataBytesAppended(0)
+              totalMetadataBytesAppended(0),
+              totalPaddingBytes(0),
+              totalStraddlingEntries(0)
         {
         }
 
@@ -286,9 +351,12 @@ class AbstractLog {
             other->metrics.totalAppendCalls += totalAppendCalls;
             other->metrics.totalAppendTicks += totalAppendTicks;
             other->metrics.totalNoSpaceTicks += totalNoSpaceTicks;
+            other->metrics.totalNoSpaceAppends += totalNoSpaceAppends;
             other->metrics.totalBytesAppended += totalBytesAppended;
             other->metrics.totalMetadataBytesAppended +=
                 totalMetadataBytesAppended;
+            other->metrics.totalPaddingBytes += totalPaddingBytes;
+            other->metrics.totalStraddlingEntries += totalStraddlingEntries;
         }
 
         /// Reset the metrics for the log to the initial/empty state.
@@ -316,6 +384,15 @@ class AbstractLog {
         /// not, and destructed when we can append again.
         Tub<CycleCounter<uint64_t>> noSpaceTimer;
 
+        /// Cycles::rdtsc() time when #noSpaceTimer was started, or 0 if the
+        /// log can currently append. Lets getMetrics() report a stall that
+        /// is still in progress.
+        uint64_t noSpaceStart;
+
+        /// Total number of appends that failed because the log was out of
+        /// memory (the callers are told to retry later).
+        uint64_t totalNoSpaceAppends;
+
         /// Total number of useful user bytes appended to the log. This does not
         /// include any segment metadata.
         uint64_t totalBytesAppended;
@@ -324,6 +401,14 @@ class AbstractLog {
         /// #totalBytesAppended value is equal to the grand total of bytes
         /// appended to the log.
         uint64_t totalMetadataBytesAppended;
+
+        /// Total number of bytes of padding appended to keep entries from
+        /// spanning seglets (see Segment::setContiguousEntryBytes()).
+        uint64_t totalPaddingBytes;
+
+        /// Total number of entries appended that span seglets anyway,
+        /// because they are too large to be padded.
+        uint64_t totalStraddlingEntries;
     } metrics;
 
     DISALLOW_COPY_AND_ASSIGN(AbstractLog);
@@ -155,6 +155,75 @@ TEST_F(AbstractLogTest, append_multiple_basics) {
     delete[] data;
 }
 
+TEST_F(AbstractLogTest, append_multiple_combined) {
+    char data[100];
+
+    // Simulate two other threads that have published requests but not yet
+    // acquired the append lock: the first will fit, the second never can.
+    Log::AppendVector other;
+    other.type = LOG_ENTRY_TYPE_OBJ;
+    other.buffer.appendExternal(data, sizeof(data));
+    AbstractLog::PendingAppend otherRequest(&other, 1);
+
+    char* tooBig = new char[serverConfig.segmentSize + 1];
+    Log::AppendVector huge;
+    huge.type = LOG_ENTRY_TYPE_OBJ;
+    huge.buffer.appendExternal(tooBig, serverConfig.segmentSize + 1);
+    AbstractLog::PendingAppend hugeRequest(&huge, 1);
+
+    otherRequest.next = NULL;
+    hugeRequest.next = &otherRequest;
+    l.pendingAppends = &hugeRequest;
+
+    Log::AppendVector mine;
+    mine.type = LOG_ENTRY_TYPE_OBJTOMB;
+    mine.buffer.appendExternal(data, sizeof(data) - 1);
+    uint64_t callsBefore = l.AbstractLog::metrics.totalAppendCalls;
+    EXPECT_TRUE(l.append(&mine, 1));
+    EXPECT_EQ(callsBefore + 3, l.AbstractLog::metrics.totalAppendCalls);
+    EXPECT_EQ(static_cast<AbstractLog::PendingAppend*>(NULL),
+              l.pendingAppends.load());
+
+    EXPECT_TRUE(otherRequest.done);
+    EXPECT_TRUE(otherRequest.result);
+    EXPECT_FALSE(otherRequest.exception);
+
+    // The failure is handed back to its own requester, not to us.
+    EXPECT_TRUE(hugeRequest.done);
+    EXPECT_TRUE(hugeRequest.exception);
+    EXPECT_THROW(std::rethrow_exception(hugeRequest.exception), FatalError);
+
+    Buffer buffer;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, l.getEntry(other.reference, buffer));
+    EXPECT_EQ(sizeof(data), buffer.size());
+    delete[] tooBig;
+}
+
+TEST_F(AbstractLogTest, append_multiple_omitted) {
+    char data[100];
+    Log::AppendVector v[2];
+    v[0].type = LOG_ENTRY_TYPE_OBJ;
+    v[0].buffer.appendExternal(data, sizeof(data));
+    v[1].type = LOG_ENTRY_TYPE_OBJTOMB;
+    v[1].buffer.appendExternal(data, sizeof(data) - 1);
+
+    // Entries going into some other segment are appended as usual.
+    v[1].omitFromSegmentId = l.head->id + 1;
+    EXPECT_TRUE(l.append(v, 2));
+    EXPECT_FALSE(v[1].omitted);
+    Buffer buffer;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJTOMB, l.getEntry(v[1].reference, buffer));
+
+    uint32_t headLength = l.head->getAppendedLength();
+    v[1].omitFromSegmentId = l.head->id;
+    EXPECT_TRUE(l.append(v, 2));
+    EXPECT_TRUE(v[1].omitted);
+    buffer.reset();
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, l.getEntry(v[0].reference, buffer));
+    EXPECT_EQ(sizeof(data), buffer.size());
+    EXPECT_EQ(headLength + 2 + sizeof(data), l.head->getAppendedLength());
+}
+
 TEST_F(AbstractLogTest, append_multipleLogEntries) {
     Log::Reference references[2];
     Buffer logBuffer;
@@ -304,6 +373,8 @@ TEST_F(AbstractLogTest, allocNewWritableHead) {
     EXPECT_FALSE(ml.allocNewWritableHead());
     EXPECT_EQ(reinterpret_cast<LogSegment*>(0xdeadbeef), ml.head);
     EXPECT_TRUE(ml.metrics.noSpaceTimer);
+    EXPECT_NE(0U, ml.metrics.noSpaceStart);
+    EXPECT_EQ(1U, ml.metrics.totalNoSpaceAppends);
     EXPECT_EQ("allocNewWritableHead: No clean segments available; deferring "
             "operations until cleaner runs", TestLog::get());
 
@@ -311,6 +382,7 @@ TEST_F(AbstractLogTest, allocNewWritableHead) {
     EXPECT_TRUE(ml.allocNewWritableHead());
     EXPECT_EQ(&ml.segment, ml.head);
     EXPECT_FALSE(ml.metrics.noSpaceTimer);
+    EXPECT_EQ(0U, ml.metrics.noSpaceStart);
     EXPECT_NE(0U, ml.metrics.totalNoSpaceTicks);
     EXPECT_EQ(37729075lu, ml.maxLiveBytes);
 
@@ -318,6 +390,7 @@ TEST_F(AbstractLogTest, allocNewWritableHead) {
     EXPECT_FALSE(ml.allocNewWritableHead());
     EXPECT_EQ(&ml.segment, ml.head);
     EXPECT_TRUE(ml.metrics.noSpaceTimer);
+    EXPECT_EQ(2U, ml.metrics.totalNoSpaceAppends);
 }
 
 TEST_F(AbstractLogTest, getMemoryStats) {
@@ -20,6 +20,7 @@
 #include "Cycles.h"
 #include "FailSession.h"
 #include "ServerTracker.h"
+#include "ThreadId.h"
 
 namespace RAMCloud {
 bool AbstractServerList::skipServerIdCheck = false;
@@ -36,6 +37,9 @@ AbstractServerList::AbstractServerList(Context* context)
     , version(0)
     , trackers()
     , mutex()
+    , snapshot(NULL)
+    , retiredSnapshots()
+    , readers()
 {
     context->serverList = this;
 }
@@ -53,6 +57,10 @@ AbstractServerList::~AbstractServerList()
         if (trackers[i])
             trackers[i]->setParent(NULL);
     }
+
+    delete snapshot.load();
+    foreach (Snapshot* retired, retiredSnapshots)
+        delete retired;
 }
 
 /**
@@ -70,6 +78,17 @@ AbstractServerList::~AbstractServerList()
 string
 AbstractServerList::getLocator(ServerId id)
 {
+    {
+        SnapshotReader reader(this);
+        if (reader.snapshot != NULL) {
+            const ServerDetails* details = reader.snapshot->get(id);
+            if (details != NULL)
+                return details->serviceLocator;
+            throw ServerListException(HERE,
+                    format("Invalid ServerId (%s)", id.toString().c_str()));
+        }
+    }
+
     Lock _(mutex);
     ServerDetails* details = iget(id);
     if (details != NULL)
@@ -95,6 +114,14 @@ AbstractServerList::getLocator(ServerId id)
  */
 ServerStatus
 AbstractServerList::getStatus(ServerId id) {
+    {
+        SnapshotReader reader(this);
+        if (reader.snapshot != NULL) {
+            const ServerDetails* details = reader.snapshot->get(id);
+            return details == NULL ? ServerStatus::REMOVE : details->status;
+        }
+    }
+
     Lock _(mutex);
     ServerDetails* details = iget(id);
     if (details == NULL) {
@@ -115,6 +142,14 @@ AbstractServerList::getStatus(ServerId id) {
  */
 bool
 AbstractServerList::isUp(ServerId id) {
+    {
+        SnapshotReader reader(this);
+        if (reader.snapshot != NULL) {
+            const ServerDetails* details = reader.snapshot->get(id);
+            return (details != NULL) && (details->status == ServerStatus::UP);
+        }
+    }
+
     Lock _(mutex);
     ServerDetails* details = iget(id);
     return (details != NULL) && (details->status == ServerStatus::UP);
@@ -136,6 +171,18 @@ AbstractServerList::getSession(ServerId id)
     // session and open new sessions in parallel.  In addition, it's
     // possible that a server could be deleted while a session is being
     // opened for it.
+    {
+        // Fast path: the session is already cached.
+        SnapshotReader reader(this);
+        if (reader.snapshot != NULL) {
+            const ServerDetails* details = reader.snapshot->get(id);
+            if ((details == NULL) || (details->status != ServerStatus::UP))
+                return FailSession::get();
+            if (details->session != NULL)
+                return details->session;
+        }
+    }
+
     string locator;
     {
         Lock _(mutex);
@@ -190,12 +237,15 @@ AbstractServerList::getSession(ServerId id)
     // list, assuming this ServerId is still valid and no one else has put a
     // session there first.
     {
-        Lock _(mutex);
+        Lock lock(mutex);
         ServerDetails* details = iget(id);
         if (details == NULL)
             return FailSession::get();
-        if (details->session == NULL)
+        if (details->session == NULL) {
             details->session = session;
+            if (snapshot.load() != NULL)
+                publishSnapshot(lock);
+        }
         return details->session;
     }
 }
@@ -210,10 +260,12 @@ AbstractServerList::getSession(ServerId id)
 void
 AbstractServerList::flushSession(ServerId id)
 {
-    Lock _(mutex);
+    Lock lock(mutex);
     ServerDetails* details = iget(id);
     if (details != NULL) {
         details->session = NULL;
+        if (snapshot.load() != NULL)
+            publishSnapshot(lock);
         RAMCLOUD_TEST_LOG("flushed session for id %s", id.toString().c_str());
     }
 }
@@ -225,6 +277,12 @@ AbstractServerList::flushSession(ServerId id)
  */
 bool
 AbstractServerList::contains(ServerId id) {
+    {
+        SnapshotReader reader(this);
+        if (reader.snapshot != NULL)
+            return reader.snapshot->get(id) != NULL;
+    }
+
     Lock _(mutex);
 
     return iget(id) != NULL;
@@ -265,10 +323,15 @@ ServerId
 AbstractServerList::nextServer(ServerId prev, ServiceMask services,
         bool* end, bool includeCrashed)
 {
-    Lock _(mutex);
+    SnapshotReader reader(this);
+    Lock lock(mutex, std::defer_lock);
+    if (reader.snapshot == NULL)
+        lock.lock();
+    const Snapshot* current = reader.snapshot;
+
     uint32_t startIndex = prev.isValid() ? prev.indexNumber() : -1U;
     uint32_t index = startIndex;
-    size_t size = isize();
+    size_t size = current != NULL ? current->servers.size() : isize();
     if (end != NULL)
         *end = false;
 
@@ -282,7 +345,8 @@ AbstractServerList::nextServer(ServerId prev, ServiceMask services,
             if (size == 0)
                 break;
         }
-        ServerDetails* details = iget(index);
+        const ServerDetails* details = current != NULL ?
+                current->servers[index].get() : iget(index);
         if ((details != NULL)
                 && ((details->status == ServerStatus::UP) || includeCrashed)
                 && details->services.hasAll(services)) {
@@ -361,6 +425,77 @@ AbstractServerList::unregisterTracker(ServerTrackerInterface& tracker)
     }
 }
 
+/**
+ * Free the snapshots in #retiredSnapshots if no thread can still be
+ * reading them, i.e. no thread holds a SnapshotReader. (A reader created
+ * after a snapshot was replaced can only load its replacement, and every
+ * count in #readers is incremented before the pointer is loaded, so seeing
+ * each count at zero, one after another, is enough.) Otherwise the
+ * snapshots are kept for a later call.
+ *
+ * \param lock
+ *      Ensures that the caller holds #mutex; not actually used.
+ */
+void
+AbstractServerList::freeRetiredSnapshots(const Lock& lock)
+{
+    foreach (ReaderCount& reader, readers) {
+        if (reader.count.load() != 0)
+            return;
+    }
+    foreach (Snapshot* retired, retiredSnapshots)
+        delete retired;
+    retiredSnapshots.clear();
+}
+
+/**
+ * Replace #snapshot with a fresh copy of the list. Subclasses that want
+ * lookups to proceed without #mutex call this after every change to their
+ * entries; once they have, this class republishes whenever it changes a
+ * cached session. Copying the whole list costs O(servers) per update, but
+ * updates are rare compared to lookups.
+ *
+ * \param lock
+ *      Ensures that the caller holds #mutex; not actually used.
+ */
+void
+AbstractServerList::publishSnapshot(const Lock& lock)
+{
+    Snapshot* fresh = new Snapshot();
+    size_t size = isize();
+    fresh->servers.resize(size);
+    for (uint32_t n = 0; n < size; n++) {
+        ServerDetails* details = iget(n);
+        if (details != NULL)
+            fresh->servers[n].construct(*details);
+    }
+    Snapshot* old = snapshot.exchange(fresh);
+    if (old != NULL)
+        retiredSnapshots.push_back(old);
+    freeRetiredSnapshots(lock);
+}
+
+/**
+ * Construct a SnapshotReader; see the class documentation.
+ *
+ * \param list
+ *      The list whose snapshot will be read.
+ */
+AbstractServerList::SnapshotReader::SnapshotReader(AbstractServerList* list)
+    : snapshot(NULL)
+    , reader(list->readers[ThreadId::get() % NUM_READER_COUNTS])
+{
+    // Announce ourselves before loading the pointer, so that
+    // freeRetiredSnapshots can't free the snapshot underneath us.
+    reader.count.fetch_add(1);
+    snapshot = list->snapshot.load();
+}
+
+AbstractServerList::SnapshotReader::~SnapshotReader()
+{
+    reader.count.fetch_sub(1);
+}
+
 /**
  * Get the version of this list, as set by #setVersion. Used to tell whether or
  * not the list of out of date with the coordinator (and other hosts).
@@ -438,11 +573,17 @@ AbstractServerList::toString(ServerStatus status)
 string
 AbstractServerList::toString()
 {
-    Lock lock(mutex);
+    SnapshotReader reader(this);
+    Lock lock(mutex, std::defer_lock);
+    if (reader.snapshot == NULL)
+        lock.lock();
+    const Snapshot* current = reader.snapshot;
 
     string result;
-    for (uint32_t n = 0; n < isize(); n++) {
-        ServerDetails* server = iget(n);
+    size_t size = current != NULL ? current->servers.size() : isize();
+    for (uint32_t n = 0; n < size; n++) {
+        const ServerDetails* server = current != NULL ?
+                current->servers[n].get() : iget(n);
         if (!server)
             continue;
 
@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_ABSTRACTSERVERLIST_H
 #define RAMCLOUD_ABSTRACTSERVERLIST_H
 
+#include <atomic>
 #include <mutex>
 
 #include "Common.h"
@@ -261,6 +262,8 @@ class AbstractServerList {
     string toString();
 
   PROTECTED:
+    typedef std::unique_lock<std::mutex> Lock;
+
     /// Internal Use Only - Does not grab locks
 
     /**
@@ -288,6 +291,71 @@ class AbstractServerList {
      */
     virtual size_t isize() const = 0;
 
+    /**
+     * An immutable copy of the list that the lookup methods (isUp,
+     * getSession, nextServer, ...) search without acquiring #mutex, so
+     * that they never wait behind an update that is being applied or a
+     * tracker being registered. See publishSnapshot().
+     */
+    struct Snapshot {
+        Snapshot() : servers() {}
+
+        /**
+         * Return the details of the given server, or NULL if it isn't in
+         * the list.
+         */
+        const ServerDetails*
+        get(ServerId id) const
+        {
+            uint32_t index = id.indexNumber();
+            if (index < servers.size() && servers[index] &&
+                    servers[index]->serverId == id) {
+                return servers[index].get();
+            }
+            return NULL;
+        }
+
+        /// Copy of iget(index) for each index; empty for free slots.
+        std::vector<Tub<ServerDetails>> servers;
+    };
+
+    /**
+     * Number of threads currently reading #snapshot, padded to a cache
+     * line of its own. Threads are spread over the #readers array by
+     * thread id, so they don't write to each other's lines.
+     */
+    struct ReaderCount {
+        ReaderCount() : count(0) {}
+        std::atomic<uint32_t> count;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+    };
+
+    /**
+     * Makes #snapshot safe to use for the lifetime of this object: the
+     * snapshot loaded here won't be freed until it is destroyed.
+     */
+    class SnapshotReader {
+      public:
+        explicit SnapshotReader(AbstractServerList* list);
+        ~SnapshotReader();
+
+        /// The current snapshot, or NULL if the subclass doesn't publish
+        /// snapshots (the caller must then acquire #mutex and use iget).
+        const Snapshot* snapshot;
+
+      private:
+        /// Count incremented by the constructor.
+        ReaderCount& reader;
+
+        DISALLOW_COPY_AND_ASSIGN(SnapshotReader);
+    };
+
+    /// Number of entries in #readers.
+    static const uint32_t NUM_READER_COUNTS = 64;
+
+    void freeRetiredSnapshots(const Lock& lock);
+    void publishSnapshot(const Lock& lock);
+
     /// Shared RAMCloud information.
     Context* context;
 
@@ -315,7 +383,24 @@ class AbstractServerList {
     /// modify any state in the server list.
     mutable std::mutex mutex;
 
-    typedef std::unique_lock<std::mutex> Lock;
+    /**
+     * Latest copy of the list, or NULL until the subclass first calls
+     * publishSnapshot() (CoordinatorServerList never does, so its lookups
+     * always acquire #mutex). Replaced with #mutex held, and read without
+     * it (see SnapshotReader).
+     */
+    std::atomic<Snapshot*> snapshot;
+
+    /**
+     * Snapshots that have been replaced but that SnapshotReaders may still
+     * be using. Protected by #mutex.
+     */
+    std::vector<Snapshot*> retiredSnapshots;
+
+    /// Counts of threads holding a SnapshotReader; a retired snapshot can
+    /// be freed once every count has been seen to be zero after it was
+    /// replaced.
+    ReaderCount readers[NUM_READER_COUNTS];
 
     /**
      * The following variable is set to true during unit tests to skip
@@ -199,6 +199,40 @@ ProxyPingRpc::wait()
     return respHdr->replyNanoseconds;
 }
 
+/**
+ * Wait for a proxyPing RPC to complete, but give up if the proxy doesn't
+ * respond in time.
+ *
+ * \param timeoutNanoseconds
+ *      Return after this many nanoseconds even if the proxy hasn't
+ *      responded yet.
+ *
+ * \return
+ *      The amount of time it took the target server to respond to the ping
+ *      request. All ones is returned if the proxy didn't receive a response
+ *      within its timeout period, or if the proxy itself didn't respond
+ *      within \a timeoutNanoseconds or has crashed.
+ */
+uint64_t
+ProxyPingRpc::wait(uint64_t timeoutNanoseconds)
+{
+    uint64_t abortTime = Cycles::rdtsc() +
+            Cycles::fromNanoseconds(timeoutNanoseconds);
+    if (!waitInternal(context->dispatch, abortTime)) {
+        TEST_LOG("timeout");
+        return ~0UL;
+    }
+    if (serverCrashed) {
+        TEST_LOG("server doesn't exist");
+        return ~0UL;
+    }
+    if (responseHeader->status != STATUS_OK)
+        ClientException::throwException(HERE, responseHeader->status);
+    const WireFormat::ProxyPing::Response* respHdr(
+            getResponseHeader<WireFormat::ProxyPing>());
+    return respHdr->replyNanoseconds;
+}
+
 
 /**
  * This RPC is used to invoke a variety of miscellaneous operations on a server,
@@ -237,6 +271,81 @@ AdminClient::serverControl(Context* context, ServerId serverId,
     rpc.wait();
 }
 
+/**
+ * Constructor for ForwardServerListRpc: starts passing server list updates
+ * on to another server.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param serverId
+ *      Server to send the updates to.
+ * \param updates
+ *      Buffer holding the updates, in the format of an UpdateServerList
+ *      request (Parts followed by serialized server lists). The rpc refers
+ *      to this memory, so it must not change until the rpc completes.
+ * \param offset
+ *      Offset in \a updates of the first Part.
+ * \param length
+ *      Number of bytes of Parts and server lists, starting at \a offset.
+ * \param subtree
+ *      Servers that \a serverId should in turn pass the updates to.
+ * \param subtreeSize
+ *      Number of entries in \a subtree.
+ * \param fanout
+ *      Maximum number of servers any one server forwards to directly.
+ */
+ForwardServerListRpc::ForwardServerListRpc(Context* context,
+        ServerId serverId, Buffer* updates, uint32_t offset,
+        uint32_t length, const ServerId* subtree, uint32_t subtreeSize,
+        uint32_t fanout)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::UpdateServerList::Response))
+{
+    WireFormat::UpdateServerList::Request* reqHdr(
+            allocHeader<WireFormat::UpdateServerList>(serverId));
+    reqHdr->forwardCount = subtreeSize;
+    reqHdr->fanout = fanout;
+    request.appendExternal(updates, offset, length);
+    for (uint32_t i = 0; i < subtreeSize; i++) {
+        request.emplaceAppend<
+                WireFormat::UpdateServerList::Request::ForwardTarget>()
+                ->serverId = subtree[i].getId();
+    }
+    send();
+}
+
+/**
+ * Wait for a ForwardServerListRpc to complete.
+ *
+ * \param[out] results
+ *      The ForwardResults for the servers in the subtree are appended here.
+ * \return
+ *      The server list version of the target server after applying the
+ *      updates.
+ * \throw ServerNotUpException
+ *      The target server couldn't be reached.
+ */
+uint64_t
+ForwardServerListRpc::wait(Buffer* results)
+{
+    waitAndCheckErrors();
+    const WireFormat::UpdateServerList::Response* respHdr(
+            getResponseHeader<WireFormat::UpdateServerList>());
+    uint32_t resultsOffset = sizeof32(*respHdr);
+    results->append(response, resultsOffset,
+            response->size() - resultsOffset);
+    return respHdr->currentVersion;
+}
+
+// See ServerIdRpcWrapper::handleTransportError.
+bool
+ForwardServerListRpc::handleTransportError()
+{
+    context->serverList->flushSession(id);
+    serverCrashed = true;
+    return true;
+}
+
 /**
  * Constructor for ServerControlRpc: initiates an RPC in the same way as
  * #AdminClient::serverControl, but returns once the RPC has been initiated,
@@ -93,11 +93,34 @@ class ProxyPingRpc : public ServerIdRpcWrapper {
             uint64_t timeoutNanoseconds);
     ~ProxyPingRpc() {}
     uint64_t wait();
+    uint64_t wait(uint64_t timeoutNanoseconds);
 
     PRIVATE:
     DISALLOW_COPY_AND_ASSIGN(ProxyPingRpc);
 };
 
+/**
+ * Passes server list updates on from one server to another, as part of the
+ * tree over which the coordinator disseminates them (see
+ * AdminService::updateServerList). Unlike most ServerIdRpcWrappers, this
+ * one gives up after the first transport error: the coordinator retries
+ * servers that couldn't be reached directly.
+ */
+class ForwardServerListRpc : public ServerIdRpcWrapper {
+  public:
+    ForwardServerListRpc(Context* context, ServerId serverId,
+            Buffer* updates, uint32_t offset, uint32_t length,
+            const ServerId* subtree, uint32_t subtreeSize, uint32_t fanout);
+    ~ForwardServerListRpc() {}
+    uint64_t wait(Buffer* results);
+
+  PROTECTED:
+    virtual bool handleTransportError();
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ForwardServerListRpc);
+};
+
 /**
  * Encapsulates the state of a AdminClient::serverControl operation,
  * allowing it to execute asynchronously.
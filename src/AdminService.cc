@@ -22,6 +22,9 @@
 #include "RawMetrics.h"
 #include "ShortMacros.h"
 #include "PerfStats.h"
+#include "RpcCacheStats.h"
+#include "RpcLatencyStats.h"
+#include "TableUsageStats.h"
 #include "AdminClient.h"
 #include "AdminService.h"
 #include "ServerList.h"
@@ -315,6 +318,29 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
                 return;
             }
         }
+        case WireFormat::START_DISPATCH_ACTIVITY:
+        {
+            if (rpc->requestPayload->getOffset<uint32_t>(reqOffset) == NULL) {
+                respHdr->common.status = STATUS_MESSAGE_TOO_SHORT;
+                return;
+            }
+            const uint32_t* sampleInterval =
+                    static_cast<const uint32_t*>(inputData);
+            context->dispatch->startActivityProfiler(*sampleInterval);
+            break;
+        }
+        case WireFormat::STOP_DISPATCH_ACTIVITY:
+        {
+            context->dispatch->stopActivityProfiler();
+            break;
+        }
+        case WireFormat::GET_DISPATCH_ACTIVITY:
+        {
+            string s = context->dispatch->getActivityProfile();
+            respHdr->outputLength = downCast<uint32_t>(s.length());
+            rpc->replyPayload->appendCopy(s.c_str(), respHdr->outputLength);
+            break;
+        }
         case WireFormat::GET_PERF_STATS:
         {
             PerfStats stats;
@@ -325,6 +351,52 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
             rpc->replyPayload->appendCopy(&stats, respHdr->outputLength);
             break;
         }
+        case WireFormat::GET_RPC_LATENCIES:
+        {
+            uint32_t startLength = rpc->replyPayload->size();
+            RpcLatencyStats::collect(rpc->replyPayload);
+            respHdr->outputLength = rpc->replyPayload->size() - startLength;
+            break;
+        }
+        case WireFormat::GET_RPC_CACHE_STATS:
+        {
+            uint32_t startLength = rpc->replyPayload->size();
+            RpcCacheStats::collect(rpc->replyPayload);
+            respHdr->outputLength = rpc->replyPayload->size() - startLength;
+            break;
+        }
+        case WireFormat::GET_TABLE_USAGE:
+        {
+            uint32_t startLength = rpc->replyPayload->size();
+            TableUsageStats::collect(rpc->replyPayload);
+            respHdr->outputLength = rpc->replyPayload->size() - startLength;
+            break;
+        }
+        case WireFormat::GET_LOG_HEALTH:
+        {
+            if (context->getMasterService() == NULL) {
+                respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+                return;
+            }
+            uint32_t startLength = rpc->replyPayload->size();
+            context->getMasterService()->objectManager.getLogHealthMonitor()
+                    ->collect(rpc->replyPayload);
+            respHdr->outputLength = rpc->replyPayload->size() - startLength;
+            break;
+        }
+        case WireFormat::GET_HOT_KEYS:
+        {
+            MasterService* master = context->getMasterService();
+            if (master == NULL) {
+                respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
+                return;
+            }
+            uint32_t startLength = rpc->replyPayload->size();
+            master->getHotKeySketch()->collect(rpc->replyPayload,
+                    &master->tabletManager);
+            respHdr->outputLength = rpc->replyPayload->size() - startLength;
+            break;
+        }
         case WireFormat::GET_TIME_TRACE:
         {
             string s = TimeTrace::getTrace();
@@ -394,6 +466,9 @@ AdminService::serverControl(const WireFormat::ServerControl::Request* reqHdr,
 
 /**
  * Top-level service method to handle the UPDATE_SERVER_LIST request.
+ * If the request names other servers to forward to, they are updated too,
+ * before responding (see forwardServerList), and the response says how
+ * each of them fared.
  *
  * \copydetails Service::ping
  */
@@ -407,19 +482,33 @@ AdminService::updateServerList(
         respHdr->common.status = STATUS_UNIMPLEMENTED_REQUEST;
         return;
     }
-    uint32_t reqOffset = sizeof32(*reqHdr);
+    uint32_t partsOffset = sizeof32(*reqHdr);
+    uint32_t reqOffset = partsOffset;
     uint32_t reqLen = rpc->requestPayload->size();
 
+    // The servers to forward to are at the very end of the request.
+    uint32_t targetsLength = reqHdr->forwardCount * sizeof32(
+            WireFormat::UpdateServerList::Request::ForwardTarget);
+    if (targetsLength > reqLen - reqOffset) {
+        LOG(WARNING, "UpdateServerList request claims %u servers to forward "
+                "to, but has room for only %lu", reqHdr->forwardCount,
+                (reqLen - reqOffset) / sizeof(
+                WireFormat::UpdateServerList::Request::ForwardTarget));
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+    uint32_t partsEnd = reqLen - targetsLength;
+
     // Repeatedly apply the server lists in the RPC while we haven't reached
-    // the end of the RPC.
-    while (reqOffset < reqLen) {
+    // the end of them.
+    while (reqOffset < partsEnd) {
         ProtoBuf::ServerList list;
         auto* part = rpc->requestPayload->getOffset<
                     WireFormat::UpdateServerList::Request::Part>(reqOffset);
         reqOffset += sizeof32(*part);
 
         // Bounds check on rpc size.
-        if (part == NULL || reqOffset + part->serverListLength > reqLen) {
+        if (part == NULL || reqOffset + part->serverListLength > partsEnd) {
             LOG(WARNING, "A partial UpdateServerList request is detected. "
                     "Perhaps limit the number of ProtoBufs the Coordinator"
                     "ServerList can batch into one rpc.");
@@ -432,6 +521,100 @@ AdminService::updateServerList(
                                    part->serverListLength, &list);
         reqOffset += part->serverListLength;
         respHdr->currentVersion = serverList->applyServerList(list);
+
+        // The coordinator stamps its table configuration version on
+        // updates, so that masters know when their copies are out of date.
+        MasterService* master = context->getMasterService();
+        if (master != NULL && list.has_table_config_version()) {
+            master->tableConfigCache.setLatestVersion(
+                    list.table_config_epoch(), list.table_config_version());
+        }
+    }
+
+    if (reqHdr->forwardCount > 0) {
+        typedef WireFormat::UpdateServerList::Request::ForwardTarget Target;
+        vector<ServerId> targets;
+        targets.reserve(reqHdr->forwardCount);
+        for (uint32_t offset = partsEnd; offset < reqLen;
+                offset += sizeof32(Target)) {
+            Target* target = rpc->requestPayload->getOffset<Target>(offset);
+            targets.push_back(ServerId(target->serverId));
+        }
+        forwardServerList(rpc->requestPayload, partsOffset,
+                partsEnd - partsOffset, targets, reqHdr->fanout,
+                rpc->replyPayload);
+    }
+}
+
+/**
+ * Pass server list updates on to other servers. The servers are divided
+ * into at most \a fanout groups of about the same size, and the updates are
+ * sent to the first server in each group, which forwards them to the rest
+ * of its group in the same way; so the updates spread over a tree whose
+ * depth grows only logarithmically with the number of servers, and the
+ * coordinator only needs to send one rpc to reach all of them.
+ *
+ * \param updates
+ *      Buffer holding the updates, in the format of an UpdateServerList
+ *      request.
+ * \param offset
+ *      Offset in \a updates of the first Part.
+ * \param length
+ *      Number of bytes of Parts and server lists, starting at \a offset.
+ * \param targets
+ *      Servers to pass the updates on to.
+ * \param fanout
+ *      Maximum number of servers to send to directly; 0 is treated as 1.
+ * \param[out] results
+ *      One WireFormat::UpdateServerList::Response::ForwardResult for each
+ *      server in \a targets is appended here.
+ */
+void
+AdminService::forwardServerList(Buffer* updates, uint32_t offset,
+        uint32_t length, const vector<ServerId>& targets, uint32_t fanout,
+        Buffer* results)
+{
+    typedef WireFormat::UpdateServerList::Response::ForwardResult Result;
+    size_t groups = std::min<size_t>(std::max(fanout, 1u), targets.size());
+    LOG(DEBUG, "Forwarding server list updates to %lu servers in %lu groups",
+            targets.size(), groups);
+
+    // Start all the rpcs, then wait for them in order. Entry i of both
+    // vectors describes the group starting at targets[groupStart[i]].
+    vector<size_t> groupStart;
+    vector<std::unique_ptr<ForwardServerListRpc>> rpcs;
+    size_t start = 0;
+    for (size_t i = 0; i < groups; i++) {
+        size_t size = (targets.size() - start) / (groups - i);
+        groupStart.push_back(start);
+        rpcs.emplace_back(new ForwardServerListRpc(context, targets[start],
+                updates, offset, length, targets.data() + start + 1,
+                downCast<uint32_t>(size - 1), fanout));
+        start += size;
+    }
+    groupStart.push_back(targets.size());
+
+    for (size_t i = 0; i < groups; i++) {
+        Result* result = results->emplaceAppend<Result>();
+        result->serverId = targets[groupStart[i]].getId();
+        result->currentVersion = 0;
+        try {
+            result->currentVersion = rpcs[i]->wait(results);
+            result->status = STATUS_OK;
+        } catch (const ServerNotUpException& e) {
+            // As far as we know, nobody in the group got the updates; the
+            // coordinator will retry them.
+            LOG(NOTICE, "Couldn't forward server list updates to %s",
+                    targets[groupStart[i]].toString().c_str());
+            for (size_t j = groupStart[i]; j < groupStart[i + 1]; j++) {
+                if (j != groupStart[i])
+                    result = results->emplaceAppend<Result>();
+                result->serverId = targets[j].getId();
+                result->currentVersion = 0;
+                result->status = STATUS_SERVER_NOT_UP;
+            }
+        }
+        rpcs[i].reset();
     }
 }
 
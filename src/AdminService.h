@@ -34,6 +34,9 @@ class AdminService : public Service {
     void dispatch(WireFormat::Opcode opcode, Rpc* rpc);
 
   PRIVATE:
+    void forwardServerList(Buffer* updates, uint32_t offset,
+            uint32_t length, const vector<ServerId>& targets,
+            uint32_t fanout, Buffer* results);
     void getMetrics(const WireFormat::GetMetrics::Request* reqHdr,
             WireFormat::GetMetrics::Response* respHdr,
             Rpc* rpc);
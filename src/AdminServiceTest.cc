@@ -24,13 +24,19 @@
 #include "CoordinatorServerList.h"
 #include "CoordinatorService.h"
 #include "FailSession.h"
+#include "HotKeySketch.h"
 #include "Key.h"
+#include "LogHealthMonitor.h"
 #include "MasterService.h"
+#include "MockCluster.h"
 #include "MockExternalStorage.h"
 #include "RamCloud.h"
 #include "RawMetrics.h"
+#include "RpcCacheStats.h"
+#include "RpcLatencyStats.h"
 #include "ServerList.h"
 #include "ServerMetrics.h"
+#include "TableUsageStats.h"
 #include "Tablets.pb.h"
 #include "TimeTrace.h"
 #include "TransportManager.h"
@@ -517,6 +523,27 @@ TEST_F(AdminServiceTest, serverControl_DipatchProfilerBasics) {
     stream.close();
     remove("pollingTimesTestFile.txt");
 
+    // Testing START/STOP/GET_DISPATCH_ACTIVITY.
+    uint32_t sampleInterval = 3;
+    AdminClient::serverControl(&context, serverId,
+                              WireFormat::START_DISPATCH_ACTIVITY,
+                              &sampleInterval, sizeof32(sampleInterval),
+                              &output);
+    EXPECT_EQ(3u, adminService.context->dispatch->activitySampleInterval);
+    AdminClient::serverControl(&context, serverId,
+                              WireFormat::STOP_DISPATCH_ACTIVITY, "", 0,
+                              &output);
+    EXPECT_EQ(0u, adminService.context->dispatch->activitySampleInterval);
+    AdminClient::serverControl(&context, serverId,
+                              WireFormat::GET_DISPATCH_ACTIVITY, "", 0,
+                              &output);
+    EXPECT_TRUE(TestUtil::contains(TestUtil::toString(&output),
+            "Activity profile: "));
+    EXPECT_THROW(AdminClient::serverControl(&context, serverId,
+                                           WireFormat::START_DISPATCH_ACTIVITY,
+                                           "", 0, &output),
+                 MessageTooShortError);
+
     // Testing unimplemented ControlOp.
     EXPECT_THROW(AdminClient::serverControl(&context, serverId,
                                            WireFormat::ControlOp(0),
@@ -548,6 +575,91 @@ TEST_F(AdminServiceTest, serverControl_DispatchProfilerExceptions) {
                 , RequestFormatError);
 }
 
+TEST_F(AdminServiceTest, serverControl_getRpcLatencies) {
+    Buffer output;
+    RpcLatencyStats::record(WireFormat::READ, 100, 200);
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_RPC_LATENCIES, "", 0, &output);
+    RpcLatencyStats::Collection stats;
+    EXPECT_TRUE(RpcLatencyStats::parse(&output, 0, output.size(), &stats));
+    EXPECT_LE(1u, stats[WireFormat::READ].service.getCount());
+}
+
+TEST_F(AdminServiceTest, serverControl_getRpcCacheStats) {
+    Buffer output;
+    RpcCacheStats::Reading reading = {};
+    RpcCacheStats::mockReading = &reading;
+    RpcCacheStats::setSampleInterval(1);
+    RpcCacheStats::threadStats = NULL;
+    EXPECT_TRUE(RpcCacheStats::startSample());
+    reading.values[RpcCacheStats::LLC_MISSES] = 7;
+    RpcCacheStats::finishSample(WireFormat::READ);
+    RpcCacheStats::setSampleInterval(0);
+    RpcCacheStats::mockReading = NULL;
+
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_RPC_CACHE_STATS, "", 0, &output);
+    RpcCacheStats::Collection stats;
+    EXPECT_TRUE(RpcCacheStats::parse(&output, 0, output.size(), &stats));
+    EXPECT_LE(1u, stats[WireFormat::READ].samples);
+    EXPECT_LE(7u, stats[WireFormat::READ].events[RpcCacheStats::LLC_MISSES]);
+}
+
+TEST_F(AdminServiceTest, serverControl_getTableUsage) {
+    Buffer output;
+    TableUsageStats::recordRead(12, 100);
+    TableUsageStats::finishRequest(0, 0);
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_TABLE_USAGE, "", 0, &output);
+    TableUsageStats::Collection stats;
+    EXPECT_TRUE(TableUsageStats::parse(&output, 0, output.size(), &stats));
+    EXPECT_LE(1u, stats[12].readCount);
+    EXPECT_LE(100u, stats[12].readBytes);
+}
+
+TEST_F(AdminServiceTest, serverControl_getLogHealth) {
+    Buffer output;
+    EXPECT_THROW(AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_LOG_HEALTH, "", 0, &output),
+            UnimplementedRequestError);
+
+    addMasterService();
+    LogHealthMonitor::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.refusedAppends = 7;
+    masterService->objectManager.getLogHealthMonitor()->addSample(sample);
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_LOG_HEALTH, "", 0, &output);
+    std::vector<LogHealthMonitor::Sample> samples;
+    EXPECT_TRUE(LogHealthMonitor::parse(&output, 0, output.size(),
+            &samples));
+    ASSERT_EQ(1u, samples.size());
+    EXPECT_EQ(7u, samples[0].refusedAppends);
+}
+
+TEST_F(AdminServiceTest, serverControl_getHotKeys) {
+    Buffer output;
+    EXPECT_THROW(AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_HOT_KEYS, "", 0, &output),
+            UnimplementedRequestError);
+
+    addMasterService();
+    masterService->tabletManager.addTablet(5, 0, ~0UL, TabletManager::NORMAL);
+    HotKeySketch* sketch = masterService->getHotKeySketch();
+    sketch->sampleInterval = 1;
+    HotKeySketch::countdown = 0;
+    Key key(5, "hot", 3);
+    sketch->recordRead(key);
+    AdminClient::serverControl(&context, serverId,
+            WireFormat::GET_HOT_KEYS, "", 0, &output);
+    std::vector<HotKeySketch::HotKey> keys;
+    EXPECT_TRUE(HotKeySketch::parse(&output, 0, output.size(), &keys));
+    ASSERT_EQ(1u, keys.size());
+    EXPECT_EQ(5u, keys[0].tableId);
+    EXPECT_EQ("hot", keys[0].key);
+    EXPECT_EQ(1u, keys[0].reads);
+}
+
 TEST_F(AdminServiceTest, serverControl_getTimeTrace) {
     Buffer output;
 
@@ -713,4 +825,35 @@ TEST_F(AdminServiceTest, updateServerList_multi) {
     EXPECT_EQ(3lu, respHdr->currentVersion);
 }
 
+TEST_F(AdminServiceTest, updateServerList_forward) {
+    Context context2;
+    MockCluster cluster(&context2);
+    CoordinatorServerList* source =
+            cluster.coordinatorContext.coordinatorServerList;
+    source->setUpdateFanout(2);
+    ServerConfig config = ServerConfig::forTesting();
+    config.services = {WireFormat::ADMIN_SERVICE};
+    vector<Server*> servers;
+    for (int i = 0; i < 6; i++)
+        servers.push_back(cluster.addServer(config));
+
+    // Updates about the later servers reach the earlier ones through
+    // each other.
+    TestLog::Enable _("forwardServerList", NULL);
+    ServerId id = source->enlistServer({WireFormat::MASTER_SERVICE}, 0, 100,
+            "mock:host=extra");
+    cluster.syncCoordinatorServerList();
+    EXPECT_EQ("forwardServerList: Forwarding server list updates to 5 "
+            "servers in 2 groups | forwardServerList: Forwarding server list "
+            "updates to 1 servers in 1 groups | forwardServerList: "
+            "Forwarding server list updates to 2 servers in 2 groups",
+            TestLog::get());
+    foreach (Server* server, servers) {
+        ServerList* list = static_cast<ServerList*>(
+                server->context->serverList);
+        EXPECT_EQ(source->version, list->getVersion());
+        EXPECT_EQ("mock:host=extra", list->getLocator(id));
+    }
+}
+
 } // namespace RAMCloud
@@ -111,6 +111,64 @@ BackupClient::getRecoveryData(Context* context,
     return rpc.wait();
 }
 
+/**
+ * Constructor for FindRecoveryKeyRpc: asks a backup which of its replicas
+ * of a crashed master certainly hold nothing for a key in their recovery
+ * segments for a partition, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup to ask.
+ * \param recoveryId
+ *      Which recovery this master is performing; see GetRecoveryDataRpc.
+ * \param masterId
+ *      The id of the crashed master being recovered.
+ * \param partitionId
+ *      The partition this master is recovering.
+ * \param keyHash
+ *      Hash of the key to look for (see Key::getHash()).
+ */
+FindRecoveryKeyRpc::FindRecoveryKeyRpc(Context* context, ServerId backupId,
+                                       uint64_t recoveryId, ServerId masterId,
+                                       uint64_t partitionId, uint64_t keyHash)
+    : ServerIdRpcWrapper(context, backupId,
+            sizeof(WireFormat::BackupFindRecoveryKey::Response))
+{
+    WireFormat::BackupFindRecoveryKey::Request* reqHdr(
+            allocHeader<WireFormat::BackupFindRecoveryKey>(backupId));
+    reqHdr->recoveryId = recoveryId;
+    reqHdr->masterId = masterId.getId();
+    reqHdr->partitionId = partitionId;
+    reqHdr->keyHash = keyHash;
+    send();
+}
+
+/**
+ * Wait for a FindRecoveryKeyRpc to complete.
+ *
+ * \param[out] absentFrom
+ *      The ids of the segments whose recovery segments on the backup have
+ *      no entries for the key are appended here.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+FindRecoveryKeyRpc::wait(std::vector<uint64_t>* absentFrom)
+{
+    waitAndCheckErrors();
+    const WireFormat::BackupFindRecoveryKey::Response* respHdr =
+            getResponseHeader<WireFormat::BackupFindRecoveryKey>();
+    uint32_t offset = sizeof32(*respHdr);
+    for (uint32_t i = 0; i < respHdr->segmentIdCount; ++i) {
+        absentFrom->push_back(*response->getOffset<uint64_t>(offset));
+        offset += sizeof32(uint64_t);
+    }
+}
+
 /**
  * Constructor for GetRecoveryDataRpc: initiates an RPC in the same way as
  * #BackupClient::getRecoveryData, but returns once the RPC has been initiated,
@@ -245,6 +303,9 @@ RecoveryCompleteRpc::RecoveryCompleteRpc(Context* context, ServerId backupId,
  *      use of mispartitioned segments.
  * \param masterId
  *      The id of the master whose data is to be recovered.
+ * \param coldStart
+ *      True if this recovery is part of a whole-cluster restart; see
+ *      MasterRecoveryManager::setClusterRestart.
  *
  * \return
  *      The return value is an object that describes all of the segment
@@ -254,9 +315,11 @@ StartReadingDataRpc::Result
 BackupClient::startReadingData(Context* context,
                                ServerId backupId,
                                uint64_t recoveryId,
-                               ServerId masterId)
+                               ServerId masterId,
+                               bool coldStart)
 {
-    StartReadingDataRpc rpc(context, backupId, recoveryId, masterId);
+    StartReadingDataRpc rpc(context, backupId, recoveryId, masterId,
+                            coldStart);
     return rpc.wait();
 }
 
@@ -276,11 +339,15 @@ BackupClient::startReadingData(Context* context,
  *      use of mispartitioned segments.
  * \param masterId
  *      The id of the master whose data is to be recovered.
+ * \param coldStart
+ *      True if this recovery is part of a whole-cluster restart; see
+ *      MasterRecoveryManager::setClusterRestart.
  */
 StartReadingDataRpc::StartReadingDataRpc(Context* context,
                                          ServerId backupId,
                                          uint64_t recoveryId,
-                                         ServerId masterId)
+                                         ServerId masterId,
+                                         bool coldStart)
     : ServerIdRpcWrapper(context, backupId,
             sizeof(WireFormat::BackupStartReadingData::Response))
 {
@@ -288,6 +355,7 @@ StartReadingDataRpc::StartReadingDataRpc(Context* context,
             allocHeader<WireFormat::BackupStartReadingData>(backupId));
     reqHdr->recoveryId = recoveryId;
     reqHdr->masterId = masterId.getId();
+    reqHdr->coldStart = coldStart;
     send();
 }
 
@@ -369,16 +437,23 @@ StartReadingDataRpc::wait()
  *      The partition ids inside each entry act as an index describing which
  *      recovery segment for a particular replica each object should be placed
  *      in.
+ * \param fragments
+ *      Where the erasure-coded fragments of the segments of which
+ *      \a backupId holds a fragment are, so that it can rebuild them.
+ *      May be NULL if it holds none.
  */
 void
 BackupClient::StartPartitioningReplicas(Context* context,
                                ServerId backupId,
                                uint64_t recoveryId,
                                ServerId masterId,
-                               const ProtoBuf::RecoveryPartition* partitions)
+                               const ProtoBuf::RecoveryPartition* partitions,
+                               const std::vector<
+                                   StartPartitioningRpc::FragmentLocation>*
+                                   fragments)
 {
     StartPartitioningRpc rpc(context, backupId, recoveryId,
-                            masterId, partitions);
+                            masterId, partitions, fragments);
     rpc.wait();
 }
 
@@ -404,13 +479,16 @@ BackupClient::StartPartitioningReplicas(Context* context,
  *      The partition ids inside each entry act as an index describing which
  *      recovery segment for a particular replica each object should be placed
  *      in.
+ * \param fragments
+ *      See BackupClient::StartPartitioningReplicas.
  */
 StartPartitioningRpc::StartPartitioningRpc(
     Context* context,
     ServerId backupId,
     uint64_t recoveryId,
     ServerId masterId,
-    const ProtoBuf::RecoveryPartition* partitions)
+    const ProtoBuf::RecoveryPartition* partitions,
+    const std::vector<FragmentLocation>* fragments)
     : ServerIdRpcWrapper(context, backupId,
             sizeof(WireFormat::BackupStartPartitioningReplicas::Response))
 {
@@ -420,6 +498,12 @@ StartPartitioningRpc::StartPartitioningRpc(
     reqHdr->masterId = masterId.getId();
     reqHdr->partitionsLength = ProtoBuf::serializeToRequest(&request,
             partitions);
+    reqHdr->fragmentCount = 0;
+    if (fragments != NULL) {
+        reqHdr->fragmentCount = downCast<uint32_t>(fragments->size());
+        foreach (const FragmentLocation& location, *fragments)
+            request.appendCopy(&location, sizeof(location));
+    }
     send();
 }
 
@@ -602,6 +686,23 @@ BackupClient::writeSegment(Context* context,
  *      Whether this particular replica should be loaded and filtered at the
  *      start of master recovery (as opposed to having it loaded and filtered
  *      on demand. May be reset on each subsequent write.
+ * \param pieces
+ *      If not NULL, the backup is to assemble the data from these instead:
+ *      together they cover \a length bytes starting at \a offset, and
+ *      only those with a sourceSegmentId of 0 are sent from \a segment;
+ *      the rest are copied out of other replicas on the backup (see
+ *      WireFormat::BackupWriteFromReplicas).
+ * \param forwardTo
+ *      If not NULL, the backup is to pass the write on to each of these
+ *      backups as well before replying (see WireFormat::BackupWriteChain);
+ *      wait() then reports which of them have it. Must be NULL if
+ *      \a pieces isn't.
+ * \param remotelyWritten
+ *      If true, the data has already been placed in the replica's buffer
+ *      on the backup with Transport::Session::writeRemote, so it isn't
+ *      sent; the rpc only tells the backup it's there (and carries
+ *      \a certificate and the flags). Requires \a pieces and \a forwardTo
+ *      to be NULL.
  */
 WriteSegmentRpc::WriteSegmentRpc(Context* context,
                                  ServerId backupId,
@@ -614,10 +715,79 @@ WriteSegmentRpc::WriteSegmentRpc(Context* context,
                                  const SegmentCertificate* certificate,
                                  bool open,
                                  bool close,
-                                 bool primary)
-    : ServerIdRpcWrapper(context, backupId,
-                         sizeof(WireFormat::BackupWrite::Response))
+                                 bool primary,
+                                 const std::vector<WireFormat::
+                                     BackupWriteFromReplicas::Piece>* pieces,
+                                 const std::vector<ServerId>* forwardTo,
+                                 bool remotelyWritten)
+    : ServerIdRpcWrapper(context, backupId, forwardTo
+                         ? sizeof(WireFormat::BackupWriteChain::Response)
+                         : sizeof(WireFormat::BackupWrite::Response))
+    , fromReplicas(pieces != NULL)
+    , chained(forwardTo != NULL)
 {
+    assert(!(fromReplicas && chained));
+    assert(!(remotelyWritten && (fromReplicas || chained)));
+    if (fromReplicas) {
+        WireFormat::BackupWriteFromReplicas::Request* reqHdr(
+                allocHeader<WireFormat::BackupWriteFromReplicas>(backupId));
+        reqHdr->masterId = masterId.getId();
+        reqHdr->segmentId = segmentId;
+        reqHdr->segmentEpoch = segmentEpoch;
+        reqHdr->offset = offset;
+        reqHdr->length = length;
+        reqHdr->certificateIncluded = (certificate != NULL);
+        if (reqHdr->certificateIncluded)
+            reqHdr->certificate = *certificate;
+        else
+            reqHdr->certificate = SegmentCertificate();
+        reqHdr->open = open;
+        reqHdr->close = close;
+        reqHdr->primary = primary;
+        reqHdr->pieceCount = downCast<uint32_t>(pieces->size());
+        request.appendCopy(pieces->data(), downCast<uint32_t>(
+                pieces->size() * sizeof((*pieces)[0])));
+        uint32_t pieceOffset = offset;
+        foreach (const WireFormat::BackupWriteFromReplicas::Piece& piece,
+                 *pieces) {
+            if (piece.sourceSegmentId == 0)
+                segment->appendToBuffer(request, pieceOffset, piece.length);
+            pieceOffset += piece.length;
+        }
+        CycleCounter<RawMetric> _(
+                &metrics->master.replicationPostingWriteRpcTicks);
+        send();
+        return;
+    }
+
+    if (chained) {
+        WireFormat::BackupWriteChain::Request* reqHdr(
+                allocHeader<WireFormat::BackupWriteChain>(backupId));
+        reqHdr->masterId = masterId.getId();
+        reqHdr->segmentId = segmentId;
+        reqHdr->segmentEpoch = segmentEpoch;
+        reqHdr->offset = offset;
+        reqHdr->length = length;
+        reqHdr->certificateIncluded = (certificate != NULL);
+        if (reqHdr->certificateIncluded)
+            reqHdr->certificate = *certificate;
+        else
+            reqHdr->certificate = SegmentCertificate();
+        reqHdr->open = open;
+        reqHdr->close = close;
+        reqHdr->primary = primary;
+        reqHdr->forwardCount = downCast<uint32_t>(forwardTo->size());
+        assert(reqHdr->forwardCount <=
+               WireFormat::BackupWriteChain::MAX_FORWARDS);
+        foreach (ServerId id, *forwardTo)
+            request.emplaceAppend<uint64_t>(id.getId());
+        segment->appendToBuffer(request, offset, length);
+        CycleCounter<RawMetric> _(
+                &metrics->master.replicationPostingWriteRpcTicks);
+        send();
+        return;
+    }
+
     WireFormat::BackupWrite::Request* reqHdr(
             allocHeader<WireFormat::BackupWrite>(backupId));
     reqHdr->masterId = masterId.getId();
@@ -633,7 +803,8 @@ WriteSegmentRpc::WriteSegmentRpc(Context* context,
     reqHdr->open = open;
     reqHdr->close = close;
     reqHdr->primary = primary;
-    if (segment)
+    reqHdr->remotelyWritten = remotelyWritten;
+    if (segment && !remotelyWritten)
         segment->appendToBuffer(request, offset, length);
     CycleCounter<RawMetric> _(&metrics->master.replicationPostingWriteRpcTicks);
     send();
@@ -642,14 +813,359 @@ WriteSegmentRpc::WriteSegmentRpc(Context* context,
 /**
  * Wait for a writeSegment RPC to complete.
  *
+ * \param[out] forwardedMask
+ *      If not NULL, set to WireFormat::BackupWriteChain::Response::
+ *      forwardedMask if the write was passed on to other backups, and to
+ *      0 otherwise.
+ * \return
+ *      The write load the backup reported; see
+ *      WireFormat::BackupWrite::Response::writeLoad.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+uint32_t
+WriteSegmentRpc::wait(uint32_t* forwardedMask)
+{
+    waitAndCheckErrors();
+    if (forwardedMask)
+        *forwardedMask = 0;
+    if (fromReplicas) {
+        return getResponseHeader<WireFormat::BackupWriteFromReplicas>()->
+                writeLoad;
+    }
+    if (chained) {
+        const WireFormat::BackupWriteChain::Response* respHdr =
+                getResponseHeader<WireFormat::BackupWriteChain>();
+        if (forwardedMask)
+            *forwardedMask = respHdr->forwardedMask;
+        return respHdr->writeLoad;
+    }
+    return getResponseHeader<WireFormat::BackupWrite>()->writeLoad;
+}
+
+/**
+ * Constructor for ForwardWriteRpc: starts a BackupWrite carrying the same
+ * write as a BackupWriteChain, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup to pass the write on to.
+ * \param chainHdr
+ *      Header of the BackupWriteChain that carried the write. The write is
+ *      passed on on behalf of the master named in it, but never as a
+ *      primary replica.
+ * \param data
+ *      Buffer holding the data to write; it must not change until the RPC
+ *      completes.
+ * \param dataOffset
+ *      Offset in \a data of the first of the chainHdr->length bytes.
+ */
+ForwardWriteRpc::ForwardWriteRpc(Context* context,
+                                 ServerId backupId,
+                                 const WireFormat::BackupWriteChain::Request*
+                                     chainHdr,
+                                 Buffer* data,
+                                 uint32_t dataOffset)
+    : ServerIdRpcWrapper(context, backupId,
+                         sizeof(WireFormat::BackupWrite::Response))
+{
+    WireFormat::BackupWrite::Request* reqHdr(
+            allocHeader<WireFormat::BackupWrite>(backupId));
+    reqHdr->masterId = chainHdr->masterId;
+    reqHdr->segmentId = chainHdr->segmentId;
+    reqHdr->segmentEpoch = chainHdr->segmentEpoch;
+    reqHdr->offset = chainHdr->offset;
+    reqHdr->length = chainHdr->length;
+    reqHdr->open = chainHdr->open;
+    reqHdr->close = chainHdr->close;
+    reqHdr->primary = false;
+    reqHdr->certificateIncluded = chainHdr->certificateIncluded;
+    reqHdr->certificate = chainHdr->certificate;
+    request.appendExternal(data, dataOffset, chainHdr->length);
+    send();
+}
+
+/**
+ * Constructor for GetWriteTargetRpc: asks a backup where a master may write
+ * the data of an open replica directly into its memory, but returns once
+ * the RPC has been initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup holding the replica.
+ * \param masterId
+ *      The id of the master to which the segment belongs.
+ * \param segmentId
+ *      The segment whose replica is to be written; its replica must have
+ *      been opened on the backup.
+ */
+GetWriteTargetRpc::GetWriteTargetRpc(Context* context, ServerId backupId,
+                                     ServerId masterId, uint64_t segmentId)
+    : ServerIdRpcWrapper(context, backupId,
+            sizeof(WireFormat::BackupGetWriteTarget::Response))
+{
+    WireFormat::BackupGetWriteTarget::Request* reqHdr(
+            allocHeader<WireFormat::BackupGetWriteTarget>(backupId));
+    reqHdr->masterId = masterId.getId();
+    reqHdr->segmentId = segmentId;
+    send();
+}
+
+/**
+ * Wait for a GetWriteTargetRpc to complete.
+ *
+ * \param[out] key
+ *      Set to the key to present with one-sided writes to the returned
+ *      address.
+ * \return
+ *      Address on the backup of the first byte of the replica, or 0 if the
+ *      backup can't take one-sided writes to it.
+ *
  * \throw ServerNotUpException
  *      The intended server for this RPC is not part of the cluster;
  *      if it ever existed, it has since crashed.
  */
+uint64_t
+GetWriteTargetRpc::wait(uint32_t* key)
+{
+    waitAndCheckErrors();
+    const WireFormat::BackupGetWriteTarget::Response* respHdr =
+            getResponseHeader<WireFormat::BackupGetWriteTarget>();
+    *key = respHdr->key;
+    return respHdr->address;
+}
+
+/**
+ * Constructor for WriteFragmentRpc: stores one erasure-coded fragment of a
+ * closed segment on a backup, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup that will store the fragment.
+ * \param masterId
+ *      The id of the master to which the segment belongs.
+ * \param segmentId
+ *      The segment the fragment was encoded from.
+ * \param segmentEpoch
+ *      The epoch of the segment; see WireFormat::BackupWrite.
+ * \param certificate
+ *      Certificate of the whole segment, used to check it once recovery has
+ *      rebuilt it from its fragments.
+ * \param fragmentIndex
+ *      Which fragment of the segment this is.
+ * \param dataFragments
+ *      Number of data fragments (k) the segment was split into.
+ * \param parityFragments
+ *      Number of parity fragments (m) computed for the segment.
+ * \param primary
+ *      Whether the backup should rebuild the segment in the background as
+ *      soon as a recovery of \a masterId starts.
+ * \param data
+ *      The fragment; must remain valid until the rpc completes.
+ * \param length
+ *      Bytes in \a data.
+ * \param fromReplica
+ *      True means the backup holds a closed replica of the segment and
+ *      computes the fragment from it; \a data is only used to checksum
+ *      what it should get, and isn't sent.
+ */
+WriteFragmentRpc::WriteFragmentRpc(Context* context, ServerId backupId,
+                                   ServerId masterId, uint64_t segmentId,
+                                   uint64_t segmentEpoch,
+                                   const SegmentCertificate* certificate,
+                                   uint32_t fragmentIndex,
+                                   uint32_t dataFragments,
+                                   uint32_t parityFragments, bool primary,
+                                   const void* data, uint32_t length,
+                                   bool fromReplica)
+    : ServerIdRpcWrapper(context, backupId,
+            sizeof(WireFormat::BackupWriteFragment::Response))
+{
+    WireFormat::BackupWriteFragment::Request* reqHdr(
+            allocHeader<WireFormat::BackupWriteFragment>(backupId));
+    reqHdr->masterId = masterId.getId();
+    reqHdr->segmentId = segmentId;
+    reqHdr->segmentEpoch = segmentEpoch;
+    reqHdr->certificate = *certificate;
+    reqHdr->fragmentIndex = downCast<uint8_t>(fragmentIndex);
+    reqHdr->dataFragments = downCast<uint8_t>(dataFragments);
+    reqHdr->parityFragments = downCast<uint8_t>(parityFragments);
+    reqHdr->primary = primary;
+    reqHdr->fromReplica = fromReplica;
+    reqHdr->length = length;
+    Crc32C checksum;
+    checksum.update(data, length);
+    reqHdr->checksum = checksum.getResult();
+    if (!fromReplica)
+        request.appendExternal(data, length);
+    send();
+}
+
+/**
+ * Constructor for GetFragmentRpc: fetches the erasure-coded fragment of a
+ * segment that a backup holds, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup holding the fragment.
+ * \param masterId
+ *      The id of the master to which the segment belongs.
+ * \param segmentId
+ *      The segment whose fragment is wanted.
+ * \param[out] response
+ *      The fragment is returned here.
+ */
+GetFragmentRpc::GetFragmentRpc(Context* context, ServerId backupId,
+                               ServerId masterId, uint64_t segmentId,
+                               Buffer* response)
+    : ServerIdRpcWrapper(context, backupId,
+            sizeof(WireFormat::BackupGetFragment::Response), response)
+{
+    WireFormat::BackupGetFragment::Request* reqHdr(
+            allocHeader<WireFormat::BackupGetFragment>(backupId));
+    reqHdr->masterId = masterId.getId();
+    reqHdr->segmentId = segmentId;
+    send();
+}
+
+/**
+ * Wait for a GetFragmentRpc to complete; on return the response buffer
+ * holds just the fragment.
+ *
+ * \param[out] certificate
+ *      Set to the certificate of the whole segment the fragment was
+ *      encoded from. Fragments only belong together if these match.
+ * \return
+ *      Which fragment of the segment was returned.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+uint32_t
+GetFragmentRpc::wait(SegmentCertificate* certificate)
+{
+    waitAndCheckErrors();
+    const WireFormat::BackupGetFragment::Response* respHdr =
+            getResponseHeader<WireFormat::BackupGetFragment>();
+    *certificate = respHdr->certificate;
+    uint32_t fragmentIndex = respHdr->fragmentIndex;
+
+    // respHdr off limits.
+    response->truncateFront(sizeof(WireFormat::BackupGetFragment::Response));
+    return fragmentIndex;
+}
+
+/**
+ * Constructor for WriteSegmentBatchRpc: prepares an empty batch; writes are
+ * added with appendSegment() and the rpc is started with send().
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup that will store the replicas.
+ * \param masterId
+ *      The id of the master to which the data belongs.
+ */
+WriteSegmentBatchRpc::WriteSegmentBatchRpc(Context* context,
+                                           ServerId backupId,
+                                           ServerId masterId)
+    : ServerIdRpcWrapper(context, backupId,
+                         sizeof(WireFormat::BackupWriteBatch::Response))
+    , count(0)
+{
+    WireFormat::BackupWriteBatch::Request* reqHdr(
+            allocHeader<WireFormat::BackupWriteBatch>(backupId));
+    reqHdr->masterId = masterId.getId();
+    reqHdr->count = 0;
+}
+
+/**
+ * Add a write to one replica to the batch. The arguments have the same
+ * meaning as for WriteSegmentRpc; see its constructor. Must not be called
+ * after send().
+ */
 void
-WriteSegmentRpc::wait()
+WriteSegmentBatchRpc::appendSegment(uint64_t segmentId,
+                                    uint64_t segmentEpoch,
+                                    const Segment* segment,
+                                    uint32_t offset,
+                                    uint32_t length,
+                                    const SegmentCertificate* certificate,
+                                    bool open,
+                                    bool close,
+                                    bool primary)
+{
+    WireFormat::BackupWriteBatch::Part* part =
+        static_cast<WireFormat::BackupWriteBatch::Part*>(
+            request.alloc(sizeof(WireFormat::BackupWriteBatch::Part)));
+    part->segmentId = segmentId;
+    part->segmentEpoch = segmentEpoch;
+    part->offset = offset;
+    part->length = length;
+    part->open = open;
+    part->close = close;
+    part->primary = primary;
+    part->certificateIncluded = (certificate != NULL);
+    if (part->certificateIncluded)
+        part->certificate = *certificate;
+    else
+        part->certificate = SegmentCertificate();
+    if (segment)
+        segment->appendToBuffer(request, offset, length);
+    count++;
+}
+
+/**
+ * Start the rpc once all of its writes have been added.
+ */
+void
+WriteSegmentBatchRpc::send()
+{
+    request.getStart<WireFormat::BackupWriteBatch::Request>()->count = count;
+    CycleCounter<RawMetric> _(&metrics->master.replicationPostingWriteRpcTicks);
+    ServerIdRpcWrapper::send();
+}
+
+/**
+ * Wait for the rpc to complete and report the outcome of one of its writes.
+ *
+ * \param index
+ *      Which write to report on: 0 for the first one passed to
+ *      appendSegment(), and so on.
+ *
+ * \return
+ *      The write load the backup reported; see
+ *      WireFormat::BackupWrite::Response::writeLoad.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ * \throw ClientException
+ *      The backup rejected this particular write; the exception is the
+ *      same one a WriteSegmentRpc for it would have thrown.
+ */
+uint32_t
+WriteSegmentBatchRpc::wait(uint32_t index)
 {
     waitAndCheckErrors();
+    uint32_t statusOffset = sizeof32(WireFormat::BackupWriteBatch::Response) +
+                            index * sizeof32(Status);
+    const Status* status = response->getOffset<Status>(statusOffset);
+    if (status == NULL)
+        throw MessageTooShortError(HERE);
+    if (*status != STATUS_OK)
+        ClientException::throwException(HERE, *status);
+    return getResponseHeader<WireFormat::BackupWriteBatch>()->writeLoad;
 }
 
 } // namespace RAMCloud
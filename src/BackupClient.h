@@ -45,6 +45,23 @@ class FreeSegmentRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(FreeSegmentRpc);
 };
 
+/**
+ * Asks a backup which replicas of a crashed master have no entries for a
+ * key in their recovery segments for a partition; see
+ * WireFormat::BackupFindRecoveryKey.
+ */
+class FindRecoveryKeyRpc : public ServerIdRpcWrapper {
+  public:
+    FindRecoveryKeyRpc(Context* context, ServerId backupId,
+                       uint64_t recoveryId, ServerId masterId,
+                       uint64_t partitionId, uint64_t keyHash);
+    ~FindRecoveryKeyRpc() {}
+    void wait(std::vector<uint64_t>* absentFrom);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(FindRecoveryKeyRpc);
+};
+
 /**
  * Encapsulates the state of a BackupClient::getRecoveryData operation,
  * allowing it to execute asynchronously.
@@ -155,7 +172,8 @@ class StartReadingDataRpc : public ServerIdRpcWrapper {
     };
 
     StartReadingDataRpc(Context* context, ServerId backupId,
-                        uint64_t recoveryId, ServerId masterId);
+                        uint64_t recoveryId, ServerId masterId,
+                        bool coldStart = false);
     ~StartReadingDataRpc() {}
     Result wait();
 
@@ -169,9 +187,12 @@ class StartReadingDataRpc : public ServerIdRpcWrapper {
  */
 class StartPartitioningRpc : public ServerIdRpcWrapper {
   public:
+    typedef WireFormat::BackupStartPartitioningReplicas::FragmentLocation
+            FragmentLocation;
     StartPartitioningRpc(Context* context, ServerId backupId,
                         uint64_t recoveryId, ServerId masterId,
-                        const ProtoBuf::RecoveryPartition* partitions);
+                        const ProtoBuf::RecoveryPartition* partitions,
+                        const std::vector<FragmentLocation>* fragments = NULL);
     ~StartPartitioningRpc() {}
     /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
     void wait() {waitAndCheckErrors();}
@@ -191,14 +212,119 @@ class WriteSegmentRpc : public ServerIdRpcWrapper {
                     uint64_t segmentId, uint64_t segmentEpoch,
                     const Segment* segment, uint32_t offset, uint32_t length,
                     const SegmentCertificate* certificate,
-                    bool open, bool close, bool primary);
+                    bool open, bool close, bool primary,
+                    const std::vector<WireFormat::BackupWriteFromReplicas::
+                                      Piece>* pieces = NULL,
+                    const std::vector<ServerId>* forwardTo = NULL,
+                    bool remotelyWritten = false);
     ~WriteSegmentRpc() {}
-    void wait();
+    uint32_t wait(uint32_t* forwardedMask = NULL);
 
   PRIVATE:
+    /// True if this is a BackupWriteFromReplicas rather than a BackupWrite.
+    bool fromReplicas;
+
+    /// True if this is a BackupWriteChain rather than a BackupWrite.
+    bool chained;
+
     DISALLOW_COPY_AND_ASSIGN(WriteSegmentRpc);
 };
 
+/**
+ * Used by a backup to pass on a write that arrived in a BackupWriteChain
+ * to one of the other backups named in it.
+ */
+class ForwardWriteRpc : public ServerIdRpcWrapper {
+  public:
+    ForwardWriteRpc(Context* context, ServerId backupId,
+                    const WireFormat::BackupWriteChain::Request* chainHdr,
+                    Buffer* data, uint32_t dataOffset);
+    ~ForwardWriteRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ForwardWriteRpc);
+};
+
+/**
+ * Asks a backup where in its memory the data of an open replica may be
+ * placed with one-sided RDMA writes; see WireFormat::BackupGetWriteTarget.
+ */
+class GetWriteTargetRpc : public ServerIdRpcWrapper {
+  public:
+    GetWriteTargetRpc(Context* context, ServerId backupId, ServerId masterId,
+                      uint64_t segmentId);
+    ~GetWriteTargetRpc() {}
+    uint64_t wait(uint32_t* key);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(GetWriteTargetRpc);
+};
+
+/**
+ * Stores one erasure-coded fragment of a closed segment on a backup; see
+ * WireFormat::BackupWriteFragment.
+ */
+class WriteFragmentRpc : public ServerIdRpcWrapper {
+  public:
+    WriteFragmentRpc(Context* context, ServerId backupId, ServerId masterId,
+                     uint64_t segmentId, uint64_t segmentEpoch,
+                     const SegmentCertificate* certificate,
+                     uint32_t fragmentIndex, uint32_t dataFragments,
+                     uint32_t parityFragments, bool primary,
+                     const void* data, uint32_t length,
+                     bool fromReplica = false);
+    ~WriteFragmentRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(WriteFragmentRpc);
+};
+
+/**
+ * Fetches the erasure-coded fragment of a segment that a backup holds; see
+ * WireFormat::BackupGetFragment.
+ */
+class GetFragmentRpc : public ServerIdRpcWrapper {
+  public:
+    GetFragmentRpc(Context* context, ServerId backupId, ServerId masterId,
+                   uint64_t segmentId, Buffer* response);
+    ~GetFragmentRpc() {}
+    uint32_t wait(SegmentCertificate* certificate);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(GetFragmentRpc);
+};
+
+/**
+ * Carries writes to replicas of several segments from one master to one
+ * backup in a single rpc. Unlike the other wrappers the rpc isn't sent by
+ * the constructor: the caller adds writes with appendSegment() and then
+ * calls send().
+ */
+class WriteSegmentBatchRpc : public ServerIdRpcWrapper {
+  public:
+    WriteSegmentBatchRpc(Context* context, ServerId backupId,
+                         ServerId masterId);
+    ~WriteSegmentBatchRpc() {}
+    void appendSegment(uint64_t segmentId, uint64_t segmentEpoch,
+                       const Segment* segment, uint32_t offset,
+                       uint32_t length, const SegmentCertificate* certificate,
+                       bool open, bool close, bool primary);
+    /// Return the number of writes added with appendSegment().
+    uint32_t getSegmentCount() const { return count; }
+    void send();
+    uint32_t wait(uint32_t index);
+
+  PRIVATE:
+    /// Number of writes added with appendSegment().
+    uint32_t count;
+
+    DISALLOW_COPY_AND_ASSIGN(WriteSegmentBatchRpc);
+};
+
 /**
  * This class implements RPC requests that are sent to backup servers
  * to manage segment replicas. The class contains only static methods,
@@ -221,10 +347,13 @@ class BackupClient {
     static void recoveryComplete(Context* context, ServerId backupId,
             ServerId masterId);
     static StartReadingDataRpc::Result startReadingData(Context* context,
-            ServerId backupId, uint64_t recoveryId, ServerId masterId);
+            ServerId backupId, uint64_t recoveryId, ServerId masterId,
+            bool coldStart = false);
     static void StartPartitioningReplicas(Context* context, ServerId backupId,
             uint64_t recoveryId, ServerId masterId,
-            const ProtoBuf::RecoveryPartition* partitions);
+            const ProtoBuf::RecoveryPartition* partitions,
+            const std::vector<StartPartitioningRpc::FragmentLocation>*
+                fragments = NULL);
     static void writeSegment(Context* context, ServerId backupId,
             ServerId masterId, uint64_t segmentId, uint64_t segmentEpoch,
             const Segment* segment, uint32_t offset, uint32_t length,
@@ -0,0 +1,418 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "BackupFragmentStore.h"
+#include "ClientException.h"
+#include "FrameCompression.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+// --- BackupFragmentStore ---
+
+/**
+ * Create a BackupFragmentStore.
+ *
+ * \param storage
+ *      Where fragments are stored; frames are opened on it as needed.
+ * \param segmentSize
+ *      Size of a replica, and of each frame of \a storage.
+ */
+BackupFragmentStore::BackupFragmentStore(BackupStorage* storage,
+                                         size_t segmentSize)
+    : storage(storage)
+    , segmentSize(segmentSize)
+    , maxSlots(downCast<uint32_t>((storage->getMetadataSize() -
+                                   sizeof(Header)) /
+                                  sizeof(BackupFragmentMetadata)))
+    , openGroups()
+{
+}
+
+BackupFragmentStore::~BackupFragmentStore()
+{
+}
+
+/**
+ * Store a fragment in the next free slot of a storage frame, opening a new
+ * frame if there is none. Returns once the fragment and its metadata are
+ * on storage (or buffered, as \a sync says).
+ *
+ * \param sync
+ *      Passed to BackupStorage::open() for a new frame; true means the
+ *      fragment is written synchronously.
+ * \param metadata
+ *      Describes the fragment; stored with it and returned by
+ *      getMetadata() on the frame returned.
+ * \param source
+ *      Holds the metadata.length bytes of the fragment.
+ * \param sourceOffset
+ *      Offset in \a source of the fragment.
+ * \return
+ *      A frame holding just the fragment. The slot is given up when the
+ *      last reference to it is dropped.
+ *
+ * \throw BackupOpenRejectedException
+ *      If storage has no room for another frame.
+ */
+BackupStorage::FrameRef
+BackupFragmentStore::store(bool sync, const BackupFragmentMetadata& metadata,
+                           Buffer& source, uint32_t sourceOffset)
+{
+    assert(metadata.dataFragments > 0);
+    uint32_t slotLength = downCast<uint32_t>(segmentSize /
+                                             metadata.dataFragments);
+    if (metadata.length > slotLength)
+        slotLength = downCast<uint32_t>(segmentSize);
+
+    std::shared_ptr<Group> group;
+    auto it = openGroups.find(slotLength);
+    if (it != openGroups.end()) {
+        group = it->second;
+        if (group->wasLoaded()) {
+            // Storage rejects appends to a frame loaded for a recovery.
+            openGroups.erase(it);
+            group.reset();
+        }
+    }
+    if (!group) {
+        BackupStorage::FrameRef frame =
+            storage->open(sync, ServerId(metadata.replica.logId),
+                          metadata.replica.segmentId);
+        uint32_t slotCount = std::min(
+            downCast<uint32_t>(segmentSize / slotLength), maxSlots);
+        group = std::make_shared<Group>(frame, segmentSize, slotLength,
+                                        slotCount);
+        if (slotCount > 1)
+            openGroups[slotLength] = group;
+    }
+
+    uint32_t index = group->used++;
+    *group->getRecord(index) = metadata;
+    if (group->used == group->slotCount)
+        openGroups.erase(slotLength);
+    try {
+        group->frame->append(source, sourceOffset, metadata.length,
+                             index * slotLength, group->metadata.get(),
+                             sizeof(Header) + group->slotCount *
+                                 sizeof(BackupFragmentMetadata));
+        if (group->used == group->slotCount)
+            group->frame->close();
+    } catch (...) {
+        // Leave the slot unused; the frame isn't used for more fragments.
+        memset(group->getRecord(index), 0, sizeof(BackupFragmentMetadata));
+        openGroups.erase(slotLength);
+        throw;
+    }
+    return BackupStorage::FrameRef(new Slot(group, index));
+}
+
+/**
+ * Find the fragments in a frame of storage found on startup, if it holds
+ * fragments (see BackupStorage::loadAllMetadata()).
+ *
+ * \param frame
+ *      Frame whose metadata has been loaded from storage.
+ * \param[out] slots
+ *      A frame is appended for each intact fragment in \a frame; see
+ *      store(). \a frame is released to storage once they are all freed.
+ * \return
+ *      True if \a frame holds fragments (even if none of them is intact),
+ *      false if it holds something else, such as a replica.
+ */
+bool
+BackupFragmentStore::restore(BackupStorage::FrameRef frame,
+                             std::vector<BackupStorage::FrameRef>* slots)
+{
+    const Header* header = static_cast<const Header*>(frame->getMetadata());
+    if (!header->checkIntegrity())
+        return false;
+    if (header->slotCount > maxSlots || header->slotLength == 0 ||
+            uint64_t(header->slotLength) * header->slotCount > segmentSize) {
+        LOG(WARNING, "Frame of fragments found on storage has %u slots of "
+            "%u bytes, which don't fit; ignoring it", header->slotCount,
+            header->slotLength);
+        return true;
+    }
+
+    auto group = std::make_shared<Group>(frame, segmentSize,
+                                         header->slotLength,
+                                         header->slotCount);
+    group->used = group->slotCount;
+    memcpy(group->metadata.get(), header,
+           sizeof(Header) + header->slotCount * sizeof(BackupFragmentMetadata));
+    for (uint32_t i = 0; i < group->slotCount; i++) {
+        const BackupFragmentMetadata* record = group->getRecord(i);
+        if (record->checkIntegrity() && record->length <= group->slotLength)
+            slots->emplace_back(new Slot(group, i));
+    }
+    return true;
+}
+
+// --- BackupFragmentStore::Group ---
+
+/**
+ * Create a Group with no slots used yet.
+ *
+ * \param frame
+ *      Storage frame to hold the fragments; open unless it was found on
+ *      storage at startup.
+ * \param segmentSize
+ *      Size of \a frame.
+ * \param slotLength
+ *      Bytes set aside for each fragment.
+ * \param slotCount
+ *      Number of fragments \a frame holds.
+ */
+BackupFragmentStore::Group::Group(BackupStorage::FrameRef frame,
+                                  size_t segmentSize,
+                                  uint32_t slotLength,
+                                  uint32_t slotCount)
+    : frame(frame)
+    , segmentSize(segmentSize)
+    , slotLength(slotLength)
+    , slotCount(slotCount)
+    , used(0)
+    , metadata(new char[sizeof(Header) +
+                        slotCount * sizeof(BackupFragmentMetadata)]())
+    , mutex()
+    , loads(0)
+    , loadStarted(false)
+    , expanded()
+{
+    Header header(slotLength, slotCount);
+    memcpy(metadata.get(), &header, sizeof(header));
+}
+
+BackupFragmentStore::Group::~Group()
+{
+}
+
+/// Return the metadata record of slot \a index.
+BackupFragmentMetadata*
+BackupFragmentStore::Group::getRecord(uint32_t index)
+{
+    return reinterpret_cast<BackupFragmentMetadata*>(
+        metadata.get() + sizeof(Header) +
+        index * sizeof(BackupFragmentMetadata));
+}
+
+/**
+ * Start loading the frame for a Slot; see Slot::startLoading().
+ *
+ * \param loaded
+ *      The Slot's flag saying whether it is counted in #loads; set.
+ */
+void
+BackupFragmentStore::Group::startLoading(bool* loaded)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    if (*loaded)
+        return;
+    *loaded = true;
+    ++loads;
+    loadStarted = true;
+    frame->startLoading();
+}
+
+/**
+ * Return the data of the frame, once it is loaded; see Slot::load(). Only
+ * valid between startLoading() and the matching unload().
+ */
+void*
+BackupFragmentStore::Group::load()
+{
+    void* data = frame->load();
+    std::lock_guard<std::mutex> _(mutex);
+    if (expanded)
+        return expanded.get();
+    if (!FrameCompression::isCompressed(data))
+        return data;
+    try {
+        std::unique_ptr<char[]> buffer(new char[segmentSize]);
+        FrameCompression::decompress(data, segmentSize, buffer.get(),
+                                     segmentSize);
+        expanded = std::move(buffer);
+    } catch (const FrameCompressionException& e) {
+        // The checksums of the fragments will reject whatever is here.
+        LOG(WARNING, "Frame of fragments is damaged: %s", e.what());
+        return data;
+    }
+    return expanded.get();
+}
+
+/**
+ * Undo startLoading() for a Slot; see Slot::unload().
+ *
+ * \param loaded
+ *      The Slot's flag saying whether it is counted in #loads; cleared.
+ */
+void
+BackupFragmentStore::Group::unload(bool* loaded)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    if (!*loaded)
+        return;
+    *loaded = false;
+    if (--loads > 0)
+        return;
+    expanded.reset();
+    frame->unload();
+}
+
+/**
+ * Return true if a Slot is loaded.
+ *
+ * \param loaded
+ *      The Slot's flag saying whether it is counted in #loads.
+ */
+bool
+BackupFragmentStore::Group::isLoaded(bool* loaded)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    return *loaded && frame->isLoaded();
+}
+
+/// Return true once any Slot of this group has been loaded.
+bool
+BackupFragmentStore::Group::wasLoaded()
+{
+    std::lock_guard<std::mutex> _(mutex);
+    return loadStarted;
+}
+
+// --- BackupFragmentStore::Slot ---
+
+/**
+ * Present one slot of a group as a frame.
+ *
+ * \param group
+ *      Group holding the fragment.
+ * \param index
+ *      Which of \a group's slots holds the fragment.
+ */
+BackupFragmentStore::Slot::Slot(std::shared_ptr<Group> group, uint32_t index)
+    : group(group)
+    , index(index)
+    , loaded(false)
+{
+}
+
+BackupFragmentStore::Slot::~Slot()
+{
+    group->unload(&loaded);
+}
+
+// See BackupStorage::Frame::wasAppendedToByCurrentProcess().
+bool
+BackupFragmentStore::Slot::wasAppendedToByCurrentProcess()
+{
+    return group->frame->wasAppendedToByCurrentProcess();
+}
+
+/// Does nothing: the metadata is restored by BackupFragmentStore::restore().
+void
+BackupFragmentStore::Slot::loadMetadata()
+{
+}
+
+/// Return the BackupFragmentMetadata of the fragment.
+const void*
+BackupFragmentStore::Slot::getMetadata()
+{
+    return group->getRecord(index);
+}
+
+// See BackupStorage::Frame::startLoading().
+void
+BackupFragmentStore::Slot::startLoading()
+{
+    group->startLoading(&loaded);
+}
+
+// See BackupStorage::Frame::isLoaded().
+bool
+BackupFragmentStore::Slot::isLoaded()
+{
+    return group->isLoaded(&loaded);
+}
+
+// See BackupStorage::Frame::unload().
+void
+BackupFragmentStore::Slot::unload()
+{
+    group->unload(&loaded);
+}
+
+/// Always false: fragments are stored whole.
+bool
+BackupFragmentStore::Slot::currentlyOpen()
+{
+    return false;
+}
+
+/**
+ * Return a pointer to the fragment, loading its frame from storage if
+ * needed; see BackupStorage::Frame::load().
+ */
+void*
+BackupFragmentStore::Slot::load()
+{
+    startLoading();
+    return static_cast<char*>(group->load()) + index * group->slotLength;
+}
+
+/**
+ * Reject the write: fragments are stored whole.
+ *
+ * \throw BackupBadSegmentIdException
+ *      Always.
+ */
+void
+BackupFragmentStore::Slot::append(Buffer& source,
+                                  size_t sourceOffset,
+                                  size_t length,
+                                  size_t destinationOffset,
+                                  const void* metadata,
+                                  size_t metadataLength)
+{
+    throw BackupBadSegmentIdException(HERE);
+}
+
+/// Does nothing: fragments are stored closed.
+void
+BackupFragmentStore::Slot::close()
+{
+}
+
+/**
+ * Reject the reopen: a fragment can't be appended to.
+ *
+ * \throw BackupBadSegmentIdException
+ *      Always.
+ */
+void
+BackupFragmentStore::Slot::reopen(size_t length)
+{
+    throw BackupBadSegmentIdException(HERE);
+}
+
+/// Does nothing: the slot is given up when the Slot is destroyed.
+void
+BackupFragmentStore::Slot::free()
+{
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,225 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_BACKUPFRAGMENTSTORE_H
+#define RAMCLOUD_BACKUPFRAGMENTSTORE_H
+
+#include <map>
+#include <mutex>
+
+#include "Common.h"
+#include "BackupMasterRecovery.h"
+#include "BackupStorage.h"
+
+namespace RAMCloud {
+
+/**
+ * Packs the erasure-coded fragments of segments (see ReedSolomon and
+ * ReplicatedSegment) stored on a backup into storage frames. A fragment of
+ * a segment encoded with k data fragments is about 1/k of the segment, so
+ * a frame of its own would mostly go to waste; instead each frame is split
+ * into slots of segmentSize / k bytes, each holding one fragment of any
+ * segment of any master.
+ *
+ * Each fragment is handed out as a frame of its own (a Slot), whose
+ * metadata is the fragment's BackupFragmentMetadata, so BackupService
+ * keeps fragments in its map of frames alongside replicas. Slots are
+ * filled in order and never reused; a frame goes back to storage once
+ * every fragment in it has been freed. The frame being filled stays open
+ * on storage until its last slot is.
+ *
+ * The metadata of each frame is a Header followed by the
+ * BackupFragmentMetadata of each of its slots, all rewritten with every
+ * fragment stored, so that restore() finds the fragments again when the
+ * backup restarts.
+ *
+ * store() and restore() must only be called from BackupService's worker
+ * thread; the Slots they return may be loaded from any thread.
+ */
+class BackupFragmentStore {
+  PUBLIC:
+    BackupFragmentStore(BackupStorage* storage, size_t segmentSize);
+    ~BackupFragmentStore();
+
+    BackupStorage::FrameRef store(bool sync,
+                                  const BackupFragmentMetadata& metadata,
+                                  Buffer& source, uint32_t sourceOffset);
+    bool restore(BackupStorage::FrameRef frame,
+                 std::vector<BackupStorage::FrameRef>* slots);
+
+  PRIVATE:
+    /**
+     * Stored at the start of the metadata of each storage frame holding
+     * fragments; the BackupFragmentMetadata of each slot follows it.
+     */
+    class Header {
+      PUBLIC:
+        /// Stored in #format; distinguishes fragment frames from replicas.
+        static const uint32_t FORMAT = 0x52534731; // "RSG1"
+
+        Header(uint32_t slotLength, uint32_t slotCount)
+            : format(FORMAT)
+            , slotLength(slotLength)
+            , slotCount(slotCount)
+            , checksum()
+        {
+            checksum = calculateChecksum();
+        }
+
+        /// Return true if the header is intact and in a known format.
+        bool checkIntegrity() const {
+            return format == FORMAT && calculateChecksum() == checksum;
+        }
+
+        /// Always #FORMAT.
+        uint32_t format;
+
+        /// Bytes set aside for each fragment in the frame.
+        uint32_t slotLength;
+
+        /// Number of fragments the frame holds.
+        uint32_t slotCount;
+
+      PRIVATE:
+        /// Checksum of the fields above #checksum.
+        Crc32C::ResultType calculateChecksum() const {
+            Crc32C calculatedChecksum;
+            calculatedChecksum.update(this, static_cast<unsigned>
+                                      (sizeof(*this) - sizeof(checksum)));
+            return calculatedChecksum.getResult();
+        }
+
+        /// Checksum of all the above fields. Must come last in the class.
+        Crc32C::ResultType checksum;
+    } __attribute__((packed));
+    static_assert(sizeof(Header) == 16, "Unexpected padding in Header");
+
+    /**
+     * A storage frame split into slots, and the metadata most recently
+     * written to it. Shared by the Slots handed out for it, so the frame
+     * is released once none of them is left.
+     */
+    struct Group {
+        Group(BackupStorage::FrameRef frame, size_t segmentSize,
+              uint32_t slotLength, uint32_t slotCount);
+        ~Group();
+
+        BackupFragmentMetadata* getRecord(uint32_t index);
+        void startLoading(bool* loaded);
+        void* load();
+        void unload(bool* loaded);
+        bool isLoaded(bool* loaded);
+        bool wasLoaded();
+
+        /// Storage frame holding the fragments.
+        BackupStorage::FrameRef frame;
+
+        /// Size of a replica; bounds the frame's data.
+        const size_t segmentSize;
+
+        /// Bytes set aside for each fragment in #frame.
+        const uint32_t slotLength;
+
+        /// Number of slots in #frame.
+        const uint32_t slotCount;
+
+        /// Number of slots filled so far.
+        uint32_t used;
+
+        /// Header and records as last written to the frame's metadata.
+        std::unique_ptr<char[]> metadata;
+
+        /// Protects the fields below, which Slots may touch concurrently.
+        std::mutex mutex;
+
+        /// Number of Slots in this group that are loaded.
+        uint32_t loads;
+
+        /// True once any Slot in the group has been loaded; no more
+        /// fragments can be appended to the frame after that.
+        bool loadStarted;
+
+        /**
+         * The frame's data, if storage kept it compressed (see
+         * FrameCompression); kept while any Slot is loaded.
+         */
+        std::unique_ptr<char[]> expanded;
+
+        DISALLOW_COPY_AND_ASSIGN(Group);
+    };
+
+    /**
+     * One fragment in a Group, presented as a closed frame of its own.
+     * Fragments are written whole by BackupFragmentStore::store(), so the
+     * methods for writing to a frame reject any attempt.
+     */
+    class Slot : public BackupStorage::Frame {
+      PUBLIC:
+        Slot(std::shared_ptr<Group> group, uint32_t index);
+        ~Slot();
+
+        bool wasAppendedToByCurrentProcess();
+        void loadMetadata();
+        const void* getMetadata();
+        void startLoading();
+        bool isLoaded();
+        void unload();
+        bool currentlyOpen();
+        void* load();
+        void append(Buffer& source,
+                    size_t sourceOffset,
+                    size_t length,
+                    size_t destinationOffset,
+                    const void* metadata,
+                    size_t metadataLength);
+        void close();
+        void reopen(size_t length);
+        void free();
+
+      PRIVATE:
+        /// The frame this fragment is stored in.
+        std::shared_ptr<Group> group;
+
+        /// Which slot of #group this is.
+        const uint32_t index;
+
+        /// True if this slot is counted in Group::loads; protected by
+        /// Group::mutex.
+        bool loaded;
+
+        DISALLOW_COPY_AND_ASSIGN(Slot);
+    };
+
+    /// Where fragments are stored.
+    BackupStorage* storage;
+
+    /// Size of a replica, and of each storage frame.
+    const size_t segmentSize;
+
+    /// Number of records that fit in the metadata of a storage frame.
+    const uint32_t maxSlots;
+
+    /**
+     * Groups that still have free slots, by their slot length. Fragments
+     * of segments encoded with the same k go in the same group.
+     */
+    std::map<uint32_t, std::shared_ptr<Group>> openGroups;
+
+    DISALLOW_COPY_AND_ASSIGN(BackupFragmentStore);
+};
+
+} // namespace RAMCloud
+
+#endif
@@ -0,0 +1,224 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "BackupFragmentStore.h"
+#include "InMemoryStorage.h"
+
+namespace RAMCloud {
+
+struct BackupFragmentStoreTest : public ::testing::Test {
+    InMemoryStorage storage;
+    BackupFragmentStore store;
+
+    BackupFragmentStoreTest()
+        : storage(1024, 4, 0)
+        , store(&storage, 1024)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+    }
+
+    /// Store fragment \a index of segment \a segmentId, which is encoded
+    /// with \a k data fragments; its data is the first \a length bytes of
+    /// \a data.
+    BackupStorage::FrameRef
+    storeFragment(uint64_t segmentId, uint8_t index, uint8_t k,
+                  const char* data = "frag", uint32_t length = 5)
+    {
+        Buffer fragment;
+        fragment.appendExternal(data, length);
+        SegmentCertificate certificate;
+        certificate.segmentLength = length * k;
+        Crc32C checksum;
+        checksum.update(data, length);
+        BackupReplicaMetadata replica(certificate, 99, segmentId, 1024, 0,
+                                      true, index == 0);
+        BackupFragmentMetadata metadata(replica, index, k, 1, length,
+                                        checksum.getResult());
+        return store.store(true, metadata, fragment, 0);
+    }
+
+    /// Return the storage frame holding the fragment in \a frame.
+    BackupStorage::FrameRef
+    groupFrame(BackupStorage::FrameRef frame)
+    {
+        return static_cast<BackupFragmentStore::Slot*>(frame.get())->
+            group->frame;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BackupFragmentStoreTest);
+};
+
+TEST_F(BackupFragmentStoreTest, store) {
+    BackupStorage::FrameRef first = storeFragment(88, 0, 2, "abcd");
+    EXPECT_EQ(3u, storage.freeMap.count());
+    EXPECT_TRUE(groupFrame(first)->currentlyOpen());
+    EXPECT_FALSE(first->currentlyOpen());
+    const BackupFragmentMetadata* metadata =
+        BackupFragmentMetadata::find(first->getMetadata());
+    ASSERT_TRUE(metadata != NULL);
+    EXPECT_EQ(88lu, metadata->replica.segmentId);
+    EXPECT_EQ(0u, metadata->fragmentIndex);
+
+    // The next fragment of that geometry goes in the second slot of the
+    // same frame, which is then full.
+    BackupStorage::FrameRef second = storeFragment(89, 1, 2, "efgh");
+    EXPECT_EQ(3u, storage.freeMap.count());
+    EXPECT_EQ(groupFrame(first), groupFrame(second));
+    EXPECT_FALSE(groupFrame(second)->currentlyOpen());
+    EXPECT_EQ(1u, BackupFragmentMetadata::find(
+                      second->getMetadata())->fragmentIndex);
+    char* data = static_cast<char*>(groupFrame(first)->load());
+    EXPECT_STREQ("abcd", data);
+    EXPECT_STREQ("efgh", data + 512);
+    EXPECT_STREQ("abcd", static_cast<char*>(first->load()));
+    EXPECT_STREQ("efgh", static_cast<char*>(second->load()));
+
+    // The metadata of the frame describes both slots.
+    BackupStorage::FrameRef frame = groupFrame(first);
+    std::vector<BackupStorage::FrameRef> slots;
+    BackupFragmentStore restored(&storage, 1024);
+    EXPECT_TRUE(restored.restore(frame, &slots));
+    ASSERT_EQ(2u, slots.size());
+    EXPECT_EQ(89lu, BackupFragmentMetadata::find(
+                        slots[1]->getMetadata())->replica.segmentId);
+    slots.clear();
+
+    // Other geometries get frames of their own.
+    BackupStorage::FrameRef third = storeFragment(90, 0, 4);
+    EXPECT_EQ(2u, storage.freeMap.count());
+    EXPECT_NE(groupFrame(first), groupFrame(third));
+    EXPECT_EQ(256u, static_cast<BackupFragmentStore::Slot*>(third.get())->
+                        group->slotLength);
+}
+
+TEST_F(BackupFragmentStoreTest, store_largeFragment) {
+    // Longer than segmentSize / k; it gets a frame of its own.
+    std::vector<char> data(600, 'x');
+    BackupStorage::FrameRef frame = storeFragment(88, 0, 2, data.data(),
+                                                  downCast<uint32_t>(
+                                                      data.size()));
+    EXPECT_FALSE(groupFrame(frame)->currentlyOpen());
+    EXPECT_EQ(0u, store.openGroups.size());
+    EXPECT_EQ(0, memcmp(data.data(), frame->load(), data.size()));
+}
+
+TEST_F(BackupFragmentStoreTest, store_metadataLimitsSlots) {
+    BackupStorage::FrameRef frame = storeFragment(88, 0, 16);
+    EXPECT_EQ(store.maxSlots, static_cast<BackupFragmentStore::Slot*>(
+                                  frame.get())->group->slotCount);
+    EXPECT_LT(store.maxSlots, 16u);
+}
+
+TEST_F(BackupFragmentStoreTest, store_groupLoaded) {
+    BackupStorage::FrameRef first = storeFragment(88, 0, 2);
+    first->load();
+    // Storage won't append to the frame any more.
+    BackupStorage::FrameRef second = storeFragment(89, 0, 2);
+    EXPECT_NE(groupFrame(first), groupFrame(second));
+    EXPECT_EQ(2u, storage.freeMap.count());
+}
+
+TEST_F(BackupFragmentStoreTest, store_openRejected) {
+    std::vector<BackupStorage::FrameRef> frames;
+    for (int i = 0; i < 4; i++)
+        frames.push_back(storeFragment(88 + i, 0, 1));
+    EXPECT_THROW(storeFragment(92, 0, 1), BackupOpenRejectedException);
+}
+
+TEST_F(BackupFragmentStoreTest, slotsFreed) {
+    BackupStorage::FrameRef first = storeFragment(88, 0, 2);
+    BackupStorage::FrameRef second = storeFragment(89, 1, 2);
+    EXPECT_EQ(3u, storage.freeMap.count());
+    first.reset();
+    EXPECT_EQ(3u, storage.freeMap.count());
+    second.reset();
+    EXPECT_EQ(4u, storage.freeMap.count());
+}
+
+TEST_F(BackupFragmentStoreTest, slotLoading) {
+    BackupStorage::FrameRef first = storeFragment(88, 0, 2);
+    BackupStorage::FrameRef second = storeFragment(89, 1, 2);
+    BackupFragmentStore::Group* group =
+        static_cast<BackupFragmentStore::Slot*>(first.get())->group.get();
+    EXPECT_FALSE(first->isLoaded());
+    first->load();
+    second->startLoading();
+    EXPECT_TRUE(first->isLoaded());
+    EXPECT_EQ(2u, group->loads);
+
+    // The frame stays loaded until neither slot needs it.
+    first->unload();
+    first->unload();
+    EXPECT_FALSE(first->isLoaded());
+    EXPECT_EQ(1u, group->loads);
+    second.reset();
+    EXPECT_EQ(0u, group->loads);
+}
+
+TEST_F(BackupFragmentStoreTest, slotRejectsWrites) {
+    BackupStorage::FrameRef frame = storeFragment(88, 0, 2);
+    Buffer source;
+    EXPECT_THROW(frame->append(source, 0, 0, 0, NULL, 0),
+                 BackupBadSegmentIdException);
+    EXPECT_THROW(frame->reopen(0), BackupBadSegmentIdException);
+}
+
+TEST_F(BackupFragmentStoreTest, restore) {
+    BackupStorage::FrameRef first = storeFragment(88, 0, 4);
+    BackupStorage::FrameRef second = storeFragment(89, 1, 4);
+    BackupStorage::FrameRef frame = groupFrame(first);
+    auto group = static_cast<BackupFragmentStore::Slot*>(first.get())->group;
+    // Damage the record of the second fragment.
+    group->getRecord(1)->fragmentChecksum++;
+    Buffer empty;
+    frame->append(empty, 0, 0, 0, group->metadata.get(),
+                  sizeof(BackupFragmentStore::Header) +
+                      4 * sizeof(BackupFragmentMetadata));
+
+    std::vector<BackupStorage::FrameRef> slots;
+    BackupFragmentStore restored(&storage, 1024);
+    EXPECT_TRUE(restored.restore(frame, &slots));
+    // The two unused slots have no records either.
+    ASSERT_EQ(1u, slots.size());
+    EXPECT_EQ(88lu, BackupFragmentMetadata::find(
+                        slots[0]->getMetadata())->replica.segmentId);
+    EXPECT_STREQ("frag", static_cast<char*>(slots[0]->load()));
+}
+
+TEST_F(BackupFragmentStoreTest, restore_notFragments) {
+    BackupStorage::FrameRef frame = storage.open(true, ServerId(), 0);
+    SegmentCertificate certificate;
+    BackupReplicaMetadata metadata(certificate, 99, 88, 1024, 0, true, true);
+    Buffer empty;
+    frame->append(empty, 0, 0, 0, &metadata, sizeof(metadata));
+
+    std::vector<BackupStorage::FrameRef> slots;
+    EXPECT_FALSE(store.restore(frame, &slots));
+    EXPECT_EQ(0u, slots.size());
+}
+
+TEST_F(BackupFragmentStoreTest, restore_badGeometry) {
+    BackupStorage::FrameRef frame = storage.open(true, ServerId(), 0);
+    BackupFragmentStore::Header header(1024, 2);
+    Buffer empty;
+    frame->append(empty, 0, 0, 0, &header, sizeof(header));
+
+    std::vector<BackupStorage::FrameRef> slots;
+    EXPECT_TRUE(store.restore(frame, &slots));
+    EXPECT_EQ(0u, slots.size());
+}
+
+}  // namespace RAMCloud
@@ -13,10 +13,15 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
+#include "BackupClient.h"
 #include "BackupMasterRecovery.h"
 #include "BackupService.h"
+#include "FrameCompression.h"
 #include "Object.h"
 #include "RecoverySegmentBuilder.h"
+#include "ReedSolomon.h"
 #include "ShortMacros.h"
 
 namespace RAMCloud {
@@ -34,6 +39,9 @@ SpinLock BackupMasterRecovery::deletionMutex
  * doesn't start any of them. See start() for details on the first phase of
  * master recovery which is initiated by the coordinator.
  *
+ * \param context
+ *      Overall information about this server; used to fetch erasure-coded
+ *      fragments of segments from other backups.
  * \param taskQueue
  *      Task queue which will provide the context to filter loaded replicas in
  *      the background. Not used until just before start() completes. This
@@ -53,12 +61,23 @@ SpinLock BackupMasterRecovery::deletionMutex
  * \param segmentSize
  *      Size of the replicas on storage. Needed for bounds-checking on the
  *      SegmentIterators which walk the stored replicas.
+ * \param buildThreadCount
+ *      Number of threads that build recovery segments from primary replicas
+ *      in parallel, including the task queue thread. Values above 1 start
+ *      helper threads once partitioning begins.
+ * \param dedup
+ *      If true, objects and tombstones superseded by newer versions of the
+ *      same keys within a replica are left out of its recovery segments.
  */
-BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
+BackupMasterRecovery::BackupMasterRecovery(Context* context,
+                                           TaskQueue& taskQueue,
                                            uint64_t recoveryId,
                                            ServerId crashedMasterId,
-                                           uint32_t segmentSize)
+                                           uint32_t segmentSize,
+                                           uint32_t buildThreadCount,
+                                           bool dedup)
     : Task(taskQueue)
+    , context(context)
     , recoveryId(recoveryId)
     , crashedMasterId(crashedMasterId)
     , partitions()
@@ -69,6 +88,8 @@ BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
     , firstSecondaryReplica()
     , numPrimaries(0)
     , segmentIdToReplica()
+    , fragmentLocations()
+    , pendingFragments()
     , logDigest()
     , logDigestSegmentId(~0lu)
     , logDigestSegmentEpoch()
@@ -77,6 +98,12 @@ BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
     , recoveryTicks()
     , readingDataTicks()
     , buildingStartTicks()
+    , buildThreadCount(std::max(buildThreadCount, 1u))
+    , dedup(dedup)
+    , buildLock("BackupMasterRecovery::buildLock")
+    , buildsInProgress(0)
+    , builders()
+    , stopBuilders(false)
     , testingExtractDigest()
     , testingSkipBuild()
     , destroyer(taskQueue, this)
@@ -89,6 +116,9 @@ BackupMasterRecovery::BackupMasterRecovery(TaskQueue& taskQueue,
  * distinct task to clean up the BackupMasterRecovery instance.
  */
 BackupMasterRecovery::~BackupMasterRecovery() {
+    stopBuilders = true;
+    foreach (std::thread& builder, builders)
+        builder.join();
     LOG(NOTICE, "Freeing recovery state on backup for crashed master %s "
             "(recovery %lu), including %lu filtered replicas",
             crashedMasterId.toString().c_str(), recoveryId,
@@ -225,10 +255,14 @@ BackupMasterRecovery::start(const std::vector<BackupStorage::FrameRef>& frames,
  *
  * \param partitions
  *       The partitioning scheme by which the replicas should be split
+ * \param fragments
+ *       Where the fragments of the segments of which this backup holds an
+ *       erasure-coded fragment are; see rebuildSegment().
  */
 void
 BackupMasterRecovery::setPartitionsAndSchedule(
-                          ProtoBuf::RecoveryPartition partitions)
+                          ProtoBuf::RecoveryPartition partitions,
+                          const std::vector<FragmentLocation>& fragments)
 {
     assert(startCompleted);
 
@@ -239,6 +273,8 @@ BackupMasterRecovery::setPartitionsAndSchedule(
     }
 
     this->partitions.construct(partitions);
+    foreach (const FragmentLocation& location, fragments)
+        fragmentLocations[location.segmentId].push_back(location);
 
     for (int i = 0; i < partitions.tablet_size(); ++i) {
         numPartitions = std::max(numPartitions,
@@ -320,7 +356,27 @@ BackupMasterRecovery::getRecoverySegment(uint64_t recoveryId,
     }
     Replica* replica = replicaIt->second;
 
-    if (!replica->metadata->primary || DISABLE_BACKGROUND_BUILDING) {
+    if (!replica->metadata->primary && replica->fragment) {
+        // Rebuilding the segment waits on other backups; leave it to the
+        // task queue thread, and have the recovery master come back.
+        bool queue;
+        {
+            SpinLock::Guard _(buildLock);
+            queue = !replica->claimed;
+            if (queue) {
+                replica->claimed = true;
+                pendingFragments.push_back(replica);
+            }
+        }
+        if (queue) {
+            LOG(DEBUG, "Requested segment <%s,%lu> is a secondary fragment, "
+                "queuing it to be rebuilt",
+                crashedMasterId.toString().c_str(), segmentId);
+            SpinLock::Guard lock(deletionMutex);
+            if (!pendingDeletion)
+                schedule();
+        }
+    } else if (!replica->metadata->primary || DISABLE_BACKGROUND_BUILDING) {
         LOG(DEBUG, "Requested segment <%s,%lu> is secondary, "
             "starting build of recovery segments now",
             crashedMasterId.toString().c_str(), segmentId);
@@ -363,6 +419,56 @@ BackupMasterRecovery::getRecoverySegment(uint64_t recoveryId,
     return STATUS_OK;
 }
 
+/**
+ * Find the replicas whose recovery segments for a partition hold no
+ * entries for a key. Used by recovery masters that want to serve the key
+ * before they have replayed all of their partition: once every segment
+ * not listed by some backup has been replayed, the key is fully recovered.
+ * Replicas that haven't been built yet, or failed to build, are taken to
+ * hold the key.
+ *
+ * \param recoveryId
+ *      Which recovery the recovery master is performing; see
+ *      getRecoverySegment().
+ * \param partitionId
+ *      The partition the recovery master is recovering.
+ * \param keyHash
+ *      Hash of the key (see Key::getHash()).
+ * \param[out] absentFrom
+ *      The segment ids of replicas whose recovery segments for
+ *      \a partitionId certainly have no entries for the key are appended
+ *      here.
+ * \throw BackupBadSegmentIdException
+ *      If a different recovery id was given.
+ */
+void
+BackupMasterRecovery::findKey(uint64_t recoveryId, int partitionId,
+                              KeyHash keyHash,
+                              std::vector<uint64_t>* absentFrom)
+{
+    if (this->recoveryId != recoveryId) {
+        LOG(ERROR, "Asked to find a key for recovery %lu, but current "
+            "recovery for that master is %lu", recoveryId, this->recoveryId);
+        throw BackupBadSegmentIdException(HERE);
+    }
+
+    Fence::lfence();
+    foreach (Replica& replica, replicas) {
+        if (!replica.built || !replica.recoverySegments ||
+                partitionId >= numPartitions)
+            continue;
+        if (replica.keyFilters.empty())
+            replica.keyFilters.resize(numPartitions);
+        std::vector<uint64_t>& filter = replica.keyFilters[partitionId];
+        if (filter.empty()) {
+            RecoverySegmentBuilder::buildKeyFilter(
+                    replica.recoverySegments[partitionId], &filter);
+        }
+        if (!RecoverySegmentBuilder::mayContainKey(filter, keyHash))
+            absentFrom->push_back(replica.metadata->segmentId);
+    }
+}
+
 /**
  * Inform this recovery that it should cleanup and release all resources as
  * soon as possible (including any references to frames, which may allow them
@@ -406,15 +512,40 @@ BackupMasterRecovery::getRecoveryId()
 void
 BackupMasterRecovery::performTask()
 {
+    Replica* fragment = NULL;
+    {
+        SpinLock::Guard _(buildLock);
+        if (!pendingFragments.empty()) {
+            fragment = pendingFragments.front();
+            pendingFragments.pop_front();
+        }
+    }
+    if (fragment) {
+        buildRecoverySegments(*fragment);
+        SpinLock::Guard lock(deletionMutex);
+        if (!pendingDeletion)
+            schedule();
+    }
+
     if (DISABLE_BACKGROUND_BUILDING)
         return;
 
-    if (nextToBuild == firstSecondaryReplica) {
-        readingDataTicks.destroy();
-        uint64_t ns =
-            Cycles::toNanoseconds(Cycles::rdtsc() - buildingStartTicks);
-        LOG(NOTICE, "Took %lu ms to filter %lu primary replicas",
-            ns / 1000 / 1000, numPrimaries);
+    bool done;
+    {
+        SpinLock::Guard _(buildLock);
+        while (nextToBuild != firstSecondaryReplica && nextToBuild->claimed)
+            ++nextToBuild;
+        done = (nextToBuild == firstSecondaryReplica && buildsInProgress == 0);
+    }
+    if (done) {
+        // Only the first time; this also runs for fragments queued later.
+        if (readingDataTicks) {
+            readingDataTicks.destroy();
+            uint64_t ns =
+                Cycles::toNanoseconds(Cycles::rdtsc() - buildingStartTicks);
+            LOG(NOTICE, "Took %lu ms to filter %lu primary replicas",
+                ns / 1000 / 1000, numPrimaries);
+        }
         return;
     }
 
@@ -424,20 +555,100 @@ BackupMasterRecovery::performTask()
             schedule();
     }
 
-    if (!nextToBuild->frame->isLoaded()) {
+    if (builders.empty()) {
+        for (uint32_t i = 1; i < buildThreadCount; ++i)
+            builders.emplace_back(&BackupMasterRecovery::builderMain, this);
+    }
+
+    Replica* replica = claimLoadedPrimary();
+    if (!replica) {
         // Can't afford to log here at any level; generates tons of logging.
         return;
     }
+    buildPrimary(*replica);
+}
+
+// - private -
+
+/**
+ * Find a primary replica that has finished loading and that no other thread
+ * is filtering, and claim it for the caller. Replicas are claimed in the
+ * order of #replicas, except that a replica may be skipped while it is
+ * still loading if one a little after it (within the window described
+ * by #buildThreadCount) has already loaded. Thread-safe.
+ *
+ * \return
+ *      The claimed replica, which the caller must pass to buildPrimary(), or
+ *      NULL if no unclaimed primary replica within the window has loaded yet.
+ */
+BackupMasterRecovery::Replica*
+BackupMasterRecovery::claimLoadedPrimary()
+{
+    SpinLock::Guard _(buildLock);
+    while (nextToBuild != firstSecondaryReplica && nextToBuild->claimed)
+        ++nextToBuild;
+
+    uint32_t window = 2 * buildThreadCount - 1;
+    auto it = nextToBuild;
+    for (uint32_t i = 0; i < window && it != firstSecondaryReplica;
+         ++i, ++it) {
+        if (it->claimed || !it->frame->isLoaded())
+            continue;
+        it->claimed = true;
+        ++buildsInProgress;
+        return &*it;
+    }
+    return NULL;
+}
+
+/**
+ * Build the recovery segments for a primary replica returned by
+ * claimLoadedPrimary() and release its in-memory copy. Thread-safe for
+ * distinct replicas.
+ *
+ * \param replica
+ *      Replica claimed by the caller through claimLoadedPrimary().
+ */
+void
+BackupMasterRecovery::buildPrimary(Replica& replica)
+{
     LOG(DEBUG, "Starting to build recovery segments for (<%s,%lu>)",
-        crashedMasterId.toString().c_str(), nextToBuild->metadata->segmentId);
-    buildRecoverySegments(*nextToBuild);
+        crashedMasterId.toString().c_str(), replica.metadata->segmentId);
+    buildRecoverySegments(replica);
     LOG(DEBUG, "Done building recovery segments for (<%s,%lu>)",
-        crashedMasterId.toString().c_str(), nextToBuild->metadata->segmentId);
-    nextToBuild->frame->unload();
-    ++nextToBuild;
+        crashedMasterId.toString().c_str(), replica.metadata->segmentId);
+    // Other backups rebuilding the segment may still fetch a fragment (see
+    // BackupService::getFragment()), so it stays in memory.
+    if (!replica.fragment)
+        replica.frame->unload();
+
+    SpinLock::Guard _(buildLock);
+    --buildsInProgress;
 }
 
-// - private -
+/**
+ * Main loop of the helper threads in #builders: filter primary replicas as
+ * their loads complete, alongside performTask(), until every primary has
+ * been claimed or this recovery is destroyed.
+ */
+void
+BackupMasterRecovery::builderMain()
+{
+    while (!stopBuilders) {
+        Replica* replica = claimLoadedPrimary();
+        if (replica) {
+            buildPrimary(*replica);
+            continue;
+        }
+        {
+            SpinLock::Guard _(buildLock);
+            if (nextToBuild == firstSecondaryReplica)
+                return;
+        }
+        // Nothing has loaded yet; loads typically take milliseconds.
+        usleep(100);
+    }
+}
 
 /**
  * Append replica information and the log digest (if any) to \a responseBuffer
@@ -460,7 +671,11 @@ BackupMasterRecovery::populateStartResponse(Buffer* responseBuffer,
         responseBuffer->emplaceAppend<
                 WireFormat::BackupStartReadingData::Replica>(
                 replica.metadata->segmentId, replica.metadata->segmentEpoch,
-                replica.metadata->closed);
+                replica.metadata->closed,
+                replica.fragment ? replica.fragment->fragmentIndex
+                                 : uint8_t(0),
+                replica.fragment ? replica.fragment->dataFragments
+                                 : uint8_t(0));
         ++response->replicaCount;
         if (replica.metadata->primary)
             ++response->primaryReplicaCount;
@@ -513,8 +728,8 @@ BackupMasterRecovery::populateStartResponse(Buffer* responseBuffer,
  *
  * This method is NOT thread-safe for multiple simulatenous calls for the SAME
  * replica. Multiple invocations for different replicas is OK and expected.
- * BackupMasterRecovery serializes the processing of primary replicas via a
- * TaskQueue; primary replicas are ONLY processed by that task (performTask()).
+ * Primary replicas are ONLY processed by performTask() and the #builders
+ * threads, each of which first claims the replica (claimLoadedPrimary()).
  * Secondaries are ONLY processed by the backup worker thread. Since the worker
  * thread serializes all rpcs secondary processing is serialized. Since the two
  * sets are disjoint it all works out.
@@ -542,19 +757,39 @@ BackupMasterRecovery::buildRecoverySegments(Replica& replica)
     CycleCounter<RawMetric> _(&metrics->backup.filterTicks);
 
     std::unique_ptr<Segment[]> recoverySegments(new Segment[numPartitions]);
+    std::unique_ptr<char[]> expandedData;
+    std::unique_ptr<char[]> rebuiltData;
+    uint32_t replicaLength = segmentSize;
     uint64_t start = Cycles::rdtsc();
     try {
+        // Storage may have kept a closed replica compressed; expand it here
+        // rather than on the storage IO thread so that it overlaps with
+        // other loads and is spread across the build threads.
+        // Fragment frames expand themselves (see BackupFragmentStore).
+        if (!replica.fragment &&
+                FrameCompression::isCompressed(replicaData)) {
+            expandedData.reset(new char[segmentSize]);
+            FrameCompression::decompress(replicaData, segmentSize,
+                                         expandedData.get(), segmentSize);
+            replicaData = expandedData.get();
+        }
+        if (replica.fragment) {
+            replicaLength = rebuildSegment(replica, replicaData, &rebuiltData);
+            replicaData = rebuiltData.get();
+        }
         if (!testingSkipBuild) {
             assert(partitions);
-            RecoverySegmentBuilder::build(replicaData, segmentSize,
+            RecoverySegmentBuilder::build(replicaData, replicaLength,
                                           replica.metadata->certificate,
                                           numPartitions,
                                           *partitions,
-                                          recoverySegments.get());
+                                          recoverySegments.get(),
+                                          dedup);
         }
     } catch (const Exception& e) {
-        // Can throw SegmentIteratorException or SegmentRecoveryFailedException.
-        // Exception is a little broad, but it catches them both; hopefully we
+        // Can throw SegmentIteratorException, SegmentRecoveryFailedException,
+        // or FrameCompressionException.
+        // Exception is a little broad, but it catches them all; hopefully we
         // don't try to recover from anything else too serious.
         LOG(NOTICE, "Couldn't build recovery segments for <%s,%lu>: %s",
             crashedMasterId.toString().c_str(),
@@ -575,14 +810,127 @@ BackupMasterRecovery::buildRecoverySegments(Replica& replica)
     replica.built = true;
 }
 
+/**
+ * Rebuild a segment from the erasure-coded fragment \a replica holds and
+ * enough of its other fragments, fetched from the backups that hold them
+ * (see setPartitionsAndSchedule()). Data fragments are fetched first, since
+ * the segment then needs no decoding; parity fragments are only fetched if
+ * some of those can't be had. Only fragments encoded from the same version
+ * of the segment (their certificates match) are combined. Blocks on rpcs to
+ * other backups, so it must never run on the backup worker thread.
+ *
+ * \param replica
+ *      Replica holding a fragment.
+ * \param fragment
+ *      The fragment \a replica holds.
+ * \param[out] segment
+ *      Set to a buffer holding the rebuilt segment.
+ * \return
+ *      The number of bytes at \a segment that may be iterated.
+ * \throw SegmentRecoveryFailedException
+ *      The fragment is damaged or too few intact matching fragments could
+ *      be collected.
+ */
+uint32_t
+BackupMasterRecovery::rebuildSegment(Replica& replica, const void* fragment,
+                                     std::unique_ptr<char[]>* segment)
+{
+    const BackupFragmentMetadata* metadata = replica.fragment;
+    uint64_t segmentId = replica.metadata->segmentId;
+    uint32_t k = metadata->dataFragments;
+    uint32_t n = k + metadata->parityFragments;
+    uint32_t length = metadata->length;
+    Crc32C checksum;
+    checksum.update(fragment, length);
+    if (metadata->fragmentIndex >= n ||
+            checksum.getResult() != metadata->fragmentChecksum) {
+        LOG(WARNING, "Fragment of <%s,%lu> failed its checksum",
+            crashedMasterId.toString().c_str(), segmentId);
+        throw SegmentRecoveryFailedException(HERE);
+    }
+
+    segment->reset(new char[n * length]);
+    void* fragments[n];
+    bool present[n];
+    for (uint32_t i = 0; i < n; i++) {
+        fragments[i] = segment->get() + i * length;
+        present[i] = false;
+    }
+    memcpy(fragments[metadata->fragmentIndex], fragment, length);
+    present[metadata->fragmentIndex] = true;
+    uint32_t collected = 1;
+
+    std::vector<FragmentLocation> candidates;
+    auto it = fragmentLocations.find(segmentId);
+    if (it != fragmentLocations.end())
+        candidates = it->second;
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const FragmentLocation& a, const FragmentLocation& b) {
+                         return a.fragmentIndex < b.fragmentIndex;
+                     });
+
+    // Fetch as many as are still needed at a time, in parallel.
+    size_t next = 0;
+    while (collected < k && next < candidates.size()) {
+        uint32_t wanted = k - collected;
+        std::unique_ptr<Buffer[]> responses(new Buffer[wanted]);
+        std::unique_ptr<Tub<GetFragmentRpc>[]> rpcs(
+            new Tub<GetFragmentRpc>[wanted]);
+        uint32_t count = 0;
+        while (count < wanted && next < candidates.size()) {
+            const FragmentLocation& location = candidates[next++];
+            if (location.fragmentIndex >= n || present[location.fragmentIndex])
+                continue;
+            rpcs[count].construct(context, ServerId(location.backupId),
+                                  crashedMasterId, segmentId,
+                                  &responses[count]);
+            count++;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            try {
+                SegmentCertificate certificate;
+                uint32_t index = rpcs[i]->wait(&certificate);
+                if (index < n && present[index])
+                    continue;
+                if (index >= n ||
+                        !(certificate == replica.metadata->certificate) ||
+                        responses[i].size() != length) {
+                    LOG(NOTICE, "Ignoring fragment %u of <%s,%lu>: it wasn't "
+                        "encoded from the same segment as this one", index,
+                        crashedMasterId.toString().c_str(), segmentId);
+                    continue;
+                }
+                responses[i].copy(0, length, fragments[index]);
+                present[index] = true;
+                ++collected;
+            } catch (const ClientException& e) {
+                LOG(NOTICE, "Couldn't fetch a fragment of <%s,%lu>: %s",
+                    crashedMasterId.toString().c_str(), segmentId, e.what());
+            }
+        }
+    }
+
+    ReedSolomon code(k, metadata->parityFragments);
+    if (collected < k || !code.reconstruct(fragments, present, length)) {
+        LOG(WARNING, "Only %u of the %u fragments needed to rebuild <%s,%lu> "
+            "could be collected", collected, k,
+            crashedMasterId.toString().c_str(), segmentId);
+        throw SegmentRecoveryFailedException(HERE);
+    }
+    return k * length;
+}
+
 // -- BackupMasterRecovery --
 
 BackupMasterRecovery::Replica::Replica(const BackupStorage::FrameRef& frame)
     : frame(frame)
     , metadata(static_cast<const BackupReplicaMetadata*>(frame->getMetadata()))
+    , fragment(BackupFragmentMetadata::find(frame->getMetadata()))
     , recoverySegments()
     , recoveryException()
     , built()
+    , claimed()
+    , keyFilters()
 {
 }
 
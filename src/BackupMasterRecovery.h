@@ -16,6 +16,10 @@
 #ifndef RAMCLOUD_BACKUPMASTERRECOVERY_H
 #define RAMCLOUD_BACKUPMASTERRECOVERY_H
 
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
 #include "Common.h"
 #include "BackupStorage.h"
 #include "Log.h"
@@ -28,6 +32,7 @@
 namespace RAMCloud {
 
 class BackupReplicaMetadata;
+class BackupFragmentMetadata;
 
 /**
   * This class represents a mechanism for deleting other tasks. After it is
@@ -73,10 +78,14 @@ class TaskKiller : public Task {
  * 2) Calls to performTask() are serialized.
  * 3) FrameRefs delivered to start() remain valid until destruction.
  *
- * Primary replicas are ONLY filtered by the task queue thread serially.
- * Secondary replicas are ONLY filtered by the sole backup worked thread
- * (and, hence, serially, as well).
- * The only miniscule synchronization it to ensure that all built
+ * Primary replicas are ONLY filtered by the task queue thread and, if
+ * #buildThreadCount is more than 1, by helper threads owned by this
+ * instance; #buildLock makes sure each primary is claimed by exactly one
+ * of them. Secondary replicas are ONLY filtered by the sole backup worked
+ * thread (and, hence, serially), except for those holding erasure-coded
+ * fragments: the worker thread queues those for the task queue thread,
+ * since rebuilding them waits on other backups.
+ * The only other synchronization is to ensure that all built
  * recovery segment information is flushed to main memory before it is used
  * by getRecoverySegment().
  *
@@ -87,21 +96,31 @@ class TaskKiller : public Task {
 class BackupMasterRecovery : public Task {
   PUBLIC:
     typedef WireFormat::BackupStartReadingData::Response StartResponse;
+    typedef WireFormat::BackupStartPartitioningReplicas::FragmentLocation
+            FragmentLocation;
 
-    BackupMasterRecovery(TaskQueue& taskQueue,
+    BackupMasterRecovery(Context* context,
+                         TaskQueue& taskQueue,
                          uint64_t recoveryId,
                          ServerId crashedMasterId,
-                         uint32_t segmentSize);
+                         uint32_t segmentSize,
+                         uint32_t buildThreadCount = 1,
+                         bool dedup = false);
     ~BackupMasterRecovery();
     void start(const std::vector<BackupStorage::FrameRef>& frames,
                Buffer* buffer,
                StartResponse* response);
-    void setPartitionsAndSchedule(ProtoBuf::RecoveryPartition partitions);
+    void setPartitionsAndSchedule(ProtoBuf::RecoveryPartition partitions,
+                                  const std::vector<FragmentLocation>&
+                                      fragments =
+                                          std::vector<FragmentLocation>());
     Status getRecoverySegment(uint64_t recoveryId,
                               uint64_t segmentId,
                               int partitionId,
                               Buffer* buffer,
                               SegmentCertificate* certificate);
+    void findKey(uint64_t recoveryId, int partitionId, KeyHash keyHash,
+                 std::vector<uint64_t>* absentFrom);
     void free();
     uint64_t getRecoveryId();
     void performTask();
@@ -110,9 +129,20 @@ class BackupMasterRecovery : public Task {
     void populateStartResponse(Buffer* buffer,
                                StartResponse* response);
     struct Replica;
+    Replica* claimLoadedPrimary();
+    void buildPrimary(Replica& replica);
+    void builderMain();
     void buildRecoverySegments(Replica& replica);
+    uint32_t rebuildSegment(Replica& replica, const void* fragment,
+                            std::unique_ptr<char[]>* segment);
     bool getLogDigest(Replica& replica, Buffer* digestBuffer);
 
+    /**
+     * Overall information about this server; used to fetch fragments from
+     * other backups.
+     */
+    Context* context;
+
     /**
      * Which master recovery this is for. The coordinator may schedule
      * multiple recoveries for a single master (though, it only schedules one
@@ -186,6 +216,13 @@ class BackupMasterRecovery : public Task {
          */
         const BackupReplicaMetadata* metadata;
 
+        /**
+         * If the frame holds an erasure-coded fragment of the segment
+         * rather than a full replica, its metadata (of which #metadata is
+         * the start); otherwise NULL.
+         */
+        const BackupFragmentMetadata* fragment;
+
         /**
          * Once filtered points to the start of an array of #numPartitions
          * recovery segments. Constructed in buildRecoverySegments() and
@@ -220,6 +257,22 @@ class BackupMasterRecovery : public Task {
          */
         bool built;
 
+        /**
+         * Set once a thread has taken responsibility for building the
+         * recovery segments of this (primary) replica; see
+         * claimLoadedPrimary(). Also set for secondary fragments once they
+         * are queued in #pendingFragments. Protected by #buildLock.
+         */
+        bool claimed;
+
+        /**
+         * Summaries of which keys each of the #recoverySegments holds, built
+         * on demand by findKey() (see RecoverySegmentBuilder::
+         * buildKeyFilter()); empty until then. Only touched by findKey(),
+         * which BackupService serializes with its other rpcs.
+         */
+        std::vector<std::vector<uint64_t>> keyFilters;
+
         DISALLOW_COPY_AND_ASSIGN(Replica);
     };
 
@@ -238,9 +291,10 @@ class BackupMasterRecovery : public Task {
     std::deque<Replica> replicas;
 
     /**
-     * Tracks which primary replica is the next to be filtered in the
-     * background. Set initially in start() when replicas is constructed,
-     * and used/incremented in performTask() as replicas are filtered.
+     * Tracks the first primary replica that no thread has claimed for
+     * filtering in the background yet. Set initially in start() when
+     * replicas is constructed, and advanced by claimLoadedPrimary() as
+     * replicas are claimed. Protected by #buildLock once filtering starts.
      */
     std::deque<Replica>::iterator nextToBuild;
 
@@ -265,6 +319,23 @@ class BackupMasterRecovery : public Task {
      */
     std::unordered_map<uint64_t, Replica*> segmentIdToReplica;
 
+    /**
+     * For each segment of which this backup holds an erasure-coded
+     * fragment rather than a full replica, where the segment's other
+     * fragments are (see rebuildSegment()). Set by
+     * setPartitionsAndSchedule() before any replica is filtered.
+     */
+    std::unordered_map<uint64_t, std::vector<FragmentLocation>>
+        fragmentLocations;
+
+    /**
+     * Secondary replicas holding fragments that recovery masters have asked
+     * for. Unlike other secondaries these are filtered by performTask(),
+     * since rebuilding them waits on other backups and must not tie up the
+     * backup worker thread. Protected by #buildLock.
+     */
+    std::deque<Replica*> pendingFragments;
+
     /**
      * Caches the log digest extracted from the replicas for this
      * crashed master, if any.
@@ -319,6 +390,46 @@ class BackupMasterRecovery : public Task {
      */
     uint64_t buildingStartTicks;
 
+    /**
+     * Number of threads that filter primary replicas in parallel: the task
+     * queue thread plus (buildThreadCount - 1) helpers in #builders.
+     * Also bounds how far past #nextToBuild filtering may run ahead of the
+     * order in #replicas (2 * buildThreadCount - 1 replicas), so
+     * a replica whose load finished early can be filtered while an earlier
+     * one is still being read, without straying far from the order in
+     * which recovery masters will ask for them.
+     */
+    uint32_t buildThreadCount;
+
+    /**
+     * Passed to RecoverySegmentBuilder::build: if true, objects and
+     * tombstones superseded within a replica are left out of its recovery
+     * segments.
+     */
+    const bool dedup;
+
+    /**
+     * Protects #nextToBuild, Replica::claimed, #pendingFragments, and
+     * #buildsInProgress among the threads filtering replicas in the
+     * background.
+     */
+    SpinLock buildLock;
+
+    /**
+     * Number of primary replicas claimed whose recovery segments haven't
+     * finished building. Protected by #buildLock.
+     */
+    uint32_t buildsInProgress;
+
+    /**
+     * Helper threads running builderMain(); started by the first
+     * performTask() after setPartitionsAndSchedule(), joined on destruction.
+     */
+    std::vector<std::thread> builders;
+
+    /// Tells the threads in #builders to exit; set on destruction.
+    std::atomic<bool> stopBuilders;
+
     /**
      * If set call this function instead of
      * RecoverySegmentBuilder::extractDigest() during start().
@@ -485,6 +596,109 @@ class BackupReplicaMetadata {
 static_assert(sizeof(BackupReplicaMetadata) == 42,
               "Unexpected padding in BackupReplicaMetadata");
 
+/**
+ * Metadata stored along with each erasure-coded fragment of a segment (see
+ * ReedSolomon and BackupFragmentStore). It starts with the
+ * BackupReplicaMetadata the segment's replicas would carry, so code that
+ * only needs the segment's identity treats fragments and replicas alike,
+ * and the rest says which fragment it is. Full replicas keep their
+ * BackupReplicaMetadata alone, laid out exactly as before fragments
+ * existed; find() tells the two apart.
+ */
+class BackupFragmentMetadata {
+  PUBLIC:
+    /// Stored in #format; changes whenever the layout of this class does.
+    static const uint32_t FORMAT = 0x52534631; // "RSF1"
+
+    /**
+     * Create metadata and seal it with a checksum.
+     * See below for the meaning of each of the fields.
+     */
+    BackupFragmentMetadata(const BackupReplicaMetadata& replica,
+                           uint8_t fragmentIndex,
+                           uint8_t dataFragments,
+                           uint8_t parityFragments,
+                           uint32_t length,
+                           uint32_t fragmentChecksum)
+        : replica(replica)
+        , format(FORMAT)
+        , fragmentIndex(fragmentIndex)
+        , dataFragments(dataFragments)
+        , parityFragments(parityFragments)
+        , length(length)
+        , fragmentChecksum(fragmentChecksum)
+        , checksum()
+    {
+        checksum = calculateChecksum();
+    }
+
+    /**
+     * Return true if the fields of this metadata (including #replica) are
+     * intact and in the format this code understands.
+     */
+    bool checkIntegrity() const {
+        return format == FORMAT && replica.checkIntegrity() &&
+               calculateChecksum() == checksum;
+    }
+
+    /**
+     * Return the fragment metadata at the start of a frame's metadata (see
+     * BackupStorage::Frame::getMetadata()), or NULL if the frame holds
+     * something else, such as a full replica.
+     */
+    static const BackupFragmentMetadata* find(const void* metadata) {
+        const BackupFragmentMetadata* fragment =
+            static_cast<const BackupFragmentMetadata*>(metadata);
+        if (!fragment->checkIntegrity())
+            return NULL;
+        return fragment;
+    }
+
+    /**
+     * Identifies the segment the fragment belongs to, just as it would a
+     * full replica; its certificate covers the whole segment.
+     */
+    BackupReplicaMetadata replica;
+
+    /// Always #FORMAT; distinguishes fragments from full replicas.
+    uint32_t format;
+
+    /// Which of the segment's fragments this is; data fragments come first.
+    uint8_t fragmentIndex;
+
+    /// Number of fragments (k) needed to rebuild the segment.
+    uint8_t dataFragments;
+
+    /// Number of parity fragments (m) the segment was encoded with.
+    uint8_t parityFragments;
+
+    /// Bytes in the fragment.
+    uint32_t length;
+
+    /**
+     * Crc32C of the fragment data; checked before the fragment is used to
+     * rebuild its segment.
+     */
+    uint32_t fragmentChecksum;
+
+  PRIVATE:
+    /// Checksum of the fields above #checksum.
+    Crc32C::ResultType calculateChecksum() const {
+        Crc32C calculatedChecksum;
+        calculatedChecksum.update(this, static_cast<unsigned>
+                                  (sizeof(*this) - sizeof(checksum)));
+        return calculatedChecksum.getResult();
+    }
+
+    /**
+     * Checksum of all the above fields. Must come last in the class.
+     * Populated on construction; can be checked with checkIntegrity().
+     */
+    Crc32C::ResultType checksum;
+} __attribute__((packed));
+static_assert(sizeof(BackupFragmentMetadata) == 61,
+              "Unexpected padding in BackupFragmentMetadata");
+
 } // namespace RAMCloud
 
 #endif
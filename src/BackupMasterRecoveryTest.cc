@@ -14,9 +14,11 @@
  */
 
 #include "TestUtil.h"
+#include "BackupFragmentStore.h"
 #include "BackupMasterRecovery.h"
 #include "InMemoryStorage.h"
 #include "LogEntryTypes.h"
+#include "Object.h"
 #include "ProtoBuf.h"
 #include "ShortMacros.h"
 #include "StringUtil.h"
@@ -27,20 +29,24 @@
 namespace RAMCloud {
 
 struct BackupMasterRecoveryTest : public ::testing::Test {
+    Context context;
     TaskQueue taskQueue;
     ProtoBuf::RecoveryPartition partitions;
     uint32_t segmentSize;
     InMemoryStorage storage;
+    BackupFragmentStore fragmentStore;
     std::vector<BackupStorage::FrameRef> frames;
     Buffer source;
     ServerId crashedMasterId;
     Tub<BackupMasterRecovery> recovery;
 
     BackupMasterRecoveryTest()
-        : taskQueue()
+        : context()
+        , taskQueue()
         , partitions()
         , segmentSize()
         , storage(1024, 6, 0)
+        , fragmentStore(&storage, 1024)
         , frames()
         , source()
         , crashedMasterId(99, 0)
@@ -58,7 +64,8 @@ struct BackupMasterRecoveryTest : public ::testing::Test {
             ProtoBuf::Tablets::Tablet& tablet(*partitions.add_tablet());
             tablet = tablets.tablet(i);
         }
-        recovery.construct(taskQueue, 456lu, ServerId{99, 0}, segmentSize);
+        recovery.construct(&context, taskQueue, 456lu, ServerId{99, 0},
+                           segmentSize);
     }
 
     void
@@ -77,6 +84,26 @@ struct BackupMasterRecoveryTest : public ::testing::Test {
         frames.back()->append(source, 0, 0, 0, &metadata, sizeof(metadata));
     }
 
+    /// Store fragment \a index of a segment encoded with \a k + 1 fragments
+    /// in #fragmentStore; its data is \a data, and the whole segment is 5k
+    /// bytes long.
+    void
+    mockFragment(uint64_t segmentId, bool primary, uint8_t index, uint8_t k,
+                 const char* data = "frag", bool screwItUp = false)
+    {
+        Buffer fragment;
+        fragment.appendExternal(data, 5);
+        SegmentCertificate certificate;
+        certificate.segmentLength = 5 * k;
+        Crc32C checksum;
+        checksum.update(data, screwItUp ? 4 : 5);
+        BackupReplicaMetadata replica(certificate, crashedMasterId.getId(),
+                                      segmentId, 1024, 0, true, primary);
+        BackupFragmentMetadata metadata(replica, index, k, 1, 5,
+                                        checksum.getResult());
+        frames.push_back(fragmentStore.store(true, metadata, fragment, 0));
+    }
+
     DISALLOW_COPY_AND_ASSIGN(BackupMasterRecoveryTest);
 };
 
@@ -196,8 +223,31 @@ TEST_F(BackupMasterRecoveryTest, start) {
                                         - 11));
 }
 
+TEST_F(BackupMasterRecoveryTest, start_fragments) {
+    mockFragment(88, true, 0, 2);
+    mockFragment(89, false, 2, 2);
+    Buffer buffer;
+    auto response = buffer.emplaceAppend<BackupMasterRecovery::StartResponse>();
+    recovery->start(frames, &buffer, response);
+    ASSERT_EQ(2u, response->replicaCount);
+    EXPECT_EQ(1u, response->primaryReplicaCount);
+
+    buffer.truncateFront(sizeof32(BackupMasterRecovery::StartResponse));
+    typedef WireFormat::BackupStartReadingData::Replica WireReplica;
+    const WireReplica* replica = buffer.getStart<WireReplica>();
+    EXPECT_EQ(88lu, replica->segmentId);
+    EXPECT_EQ(0u, replica->fragmentIndex);
+    EXPECT_EQ(2u, replica->dataFragments);
+    buffer.truncateFront(sizeof32(WireReplica));
+    replica = buffer.getStart<WireReplica>();
+    EXPECT_EQ(89lu, replica->segmentId);
+    EXPECT_EQ(2u, replica->fragmentIndex);
+    EXPECT_EQ(2u, replica->dataFragments);
+}
+
 TEST_F(BackupMasterRecoveryTest, setPartitionsAndSchedule) {
-    recovery.construct(taskQueue, 456lu, ServerId{99, 0}, segmentSize);
+    recovery.construct(&context, taskQueue, 456lu, ServerId{99, 0},
+                       segmentSize);
 
     TestLog::Enable _;
     recovery->startCompleted = true;
@@ -284,6 +334,31 @@ TEST_F(BackupMasterRecoveryTest, getRecoverySegment) {
                  buffer.getOffset<char>(buffer.size() - 10));
 }
 
+TEST_F(BackupMasterRecoveryTest, getRecoverySegment_secondaryFragment) {
+    recovery.construct(&context, taskQueue, 456lu, ServerId{99, 0}, 1024);
+    mockFragment(88, false, 1, 1);
+    recovery->testingSkipBuild = true;
+    recovery->start(frames, NULL, NULL);
+    recovery->setPartitionsAndSchedule(partitions);
+    taskQueue.performTask();
+
+    // Rebuilding waits on other backups, so it is left to the task queue.
+    EXPECT_THROW(recovery->getRecoverySegment(456, 88, 0, NULL, NULL),
+                 RetryException);
+    EXPECT_TRUE(recovery->replicas[0].claimed);
+    EXPECT_EQ(1u, recovery->pendingFragments.size());
+    EXPECT_THROW(recovery->getRecoverySegment(456, 88, 0, NULL, NULL),
+                 RetryException);
+    EXPECT_EQ(1u, recovery->pendingFragments.size());
+
+    // With k = 1 the one fragment here is enough.
+    EXPECT_TRUE(recovery->isScheduled());
+    taskQueue.performTask();
+    EXPECT_EQ(0u, recovery->pendingFragments.size());
+    EXPECT_EQ(STATUS_OK,
+              recovery->getRecoverySegment(456, 88, 0, NULL, NULL));
+}
+
 TEST_F(BackupMasterRecoveryTest, getRecoverySegment_exceptionDuringBuild) {
     mockMetadata(88);
     recovery->start(frames, NULL, NULL);
@@ -307,10 +382,46 @@ TEST_F(BackupMasterRecoveryTest, getRecoverySegment_badArgs) {
                  BackupBadSegmentIdException);
 }
 
+TEST_F(BackupMasterRecoveryTest, findKey) {
+    mockMetadata(88, true, true);
+    mockMetadata(89, true, true);
+    recovery->testingExtractDigest = &mockExtractDigest;
+    recovery->testingSkipBuild = true;
+    recovery->start(frames, NULL, NULL);
+    recovery->setPartitionsAndSchedule(partitions);
+
+    // Nothing is built yet, so any replica may hold the key.
+    std::vector<uint64_t> absentFrom;
+    KeyHash keyHash = Key(2, "8", 1).getHash();
+    recovery->findKey(456, 0, keyHash, &absentFrom);
+    EXPECT_EQ(0u, absentFrom.size());
+
+    for (int i = 0; i < 10 && recovery->isScheduled(); ++i)
+        taskQueue.performTask();
+    Key key(2, "8", 1);
+    Buffer dataBuffer;
+    Object object(key, "value", 6, 0, 0, dataBuffer);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    ASSERT_TRUE(recovery->replicas[0].recoverySegments[0].append(
+        LOG_ENTRY_TYPE_OBJ, buffer));
+    recovery->findKey(456, 0, keyHash, &absentFrom);
+    ASSERT_EQ(1u, absentFrom.size());
+    EXPECT_EQ(89u, absentFrom[0]);
+
+    // Partitions beyond the last one have no recovery segments.
+    absentFrom.clear();
+    recovery->findKey(456, 5, keyHash, &absentFrom);
+    EXPECT_EQ(0u, absentFrom.size());
+
+    EXPECT_THROW(recovery->findKey(455, 0, keyHash, &absentFrom),
+                 BackupBadSegmentIdException);
+}
+
 TEST_F(BackupMasterRecoveryTest, free) {
     std::unique_ptr<BackupMasterRecovery> recovery(
-        new BackupMasterRecovery(taskQueue, 456lu, ServerId{99, 0},
-                                 segmentSize));
+        new BackupMasterRecovery(&context, taskQueue, 456lu,
+                                 ServerId{99, 0}, segmentSize));
     TestLog::Enable _;
     recovery->free();
     taskQueue.performTask();
@@ -334,10 +445,10 @@ TEST_F(BackupMasterRecoveryTest, performTask) {
     taskQueue.performTask();
     EXPECT_EQ(
         "schedule: scheduled | "
-        "performTask: Starting to build recovery segments for (<99.0,88>) | "
+        "buildPrimary: Starting to build recovery segments for (<99.0,88>) | "
         "buildRecoverySegments: <99.0,88> recovery segments took 0 ms to "
             "construct, notifying other threads | "
-        "performTask: Done building recovery segments for (<99.0,88>)",
+        "buildPrimary: Done building recovery segments for (<99.0,88>)",
         TestLog::get());
     TestLog::reset();
     taskQueue.performTask();
@@ -345,6 +456,50 @@ TEST_F(BackupMasterRecoveryTest, performTask) {
         TestLog::get());
 }
 
+TEST_F(BackupMasterRecoveryTest, performTask_multipleBuildThreads) {
+    recovery.construct(&context, taskQueue, 456lu, ServerId{99, 0},
+                       segmentSize, 3);
+    for (uint64_t segmentId = 88; segmentId < 94; ++segmentId)
+        mockMetadata(segmentId, true, true);
+    recovery->testingSkipBuild = true;
+    recovery->start(frames, NULL, NULL);
+    recovery->setPartitionsAndSchedule(partitions);
+    for (int i = 0; i < 10000 && recovery->isScheduled(); ++i) {
+        taskQueue.performTask();
+        usleep(100);
+    }
+    EXPECT_FALSE(recovery->isScheduled());
+    EXPECT_EQ(2lu, recovery->builders.size());
+    EXPECT_EQ(0u, recovery->buildsInProgress);
+    foreach (auto& replica, recovery->replicas) {
+        EXPECT_TRUE(replica.claimed);
+        EXPECT_TRUE(replica.built);
+    }
+}
+
+TEST_F(BackupMasterRecoveryTest, claimLoadedPrimary) {
+    recovery.construct(&context, taskQueue, 456lu, ServerId{99, 0},
+                       segmentSize, 2);
+    mockMetadata(88, true, true);
+    mockMetadata(89, true, true);
+    mockMetadata(90, true, true);
+    mockMetadata(91, true, true);
+    mockMetadata(92);
+    recovery->start(frames, NULL, NULL);
+
+    // Pretend some other thread is still filtering the first replica.
+    recovery->replicas[0].claimed = true;
+    EXPECT_EQ(&recovery->replicas[1], recovery->claimLoadedPrimary());
+    EXPECT_EQ(&recovery->replicas[1], &*recovery->nextToBuild);
+    // Replicas claimed at the front of the window are skipped over.
+    recovery->replicas[2].claimed = true;
+    EXPECT_EQ(&recovery->replicas[3], recovery->claimLoadedPrimary());
+    EXPECT_EQ(2u, recovery->buildsInProgress);
+    EXPECT_TRUE(recovery->claimLoadedPrimary() == NULL);
+    EXPECT_TRUE(recovery->nextToBuild == recovery->firstSecondaryReplica);
+    EXPECT_FALSE(recovery->replicas[4].claimed);
+}
+
 namespace {
 bool buildRecoverySegmentsFilter(string s) {
     return s == "buildRecoverySegments";
@@ -369,6 +524,36 @@ TEST_F(BackupMasterRecoveryTest, buildRecoverySegments) {
     EXPECT_TRUE(recovery->replicas.at(0).built);
 }
 
+TEST_F(BackupMasterRecoveryTest, buildRecoverySegments_fragment) {
+    recovery.construct(&context, taskQueue, 456lu, ServerId{99, 0}, 1024);
+    mockFragment(88, true, 0, 2);
+    mockFragment(89, true, 0, 2, "frag", true);
+    mockFragment(90, true, 1, 1);
+    recovery->testingSkipBuild = true;
+    recovery->start(frames, NULL, NULL);
+    std::vector<BackupMasterRecovery::FragmentLocation> locations;
+    recovery->setPartitionsAndSchedule(partitions, locations);
+    TestLog::Enable _;
+
+    // Replicas are in reverse order.
+    recovery->buildRecoverySegments(recovery->replicas.at(2));
+    EXPECT_TRUE(StringUtil::contains(TestLog::get(),
+        "rebuildSegment: Only 1 of the 2 fragments needed to rebuild "
+        "<99.0,88> could be collected"));
+    EXPECT_TRUE(recovery->replicas.at(2).recoveryException);
+
+    TestLog::reset();
+    recovery->buildRecoverySegments(recovery->replicas.at(1));
+    EXPECT_TRUE(StringUtil::contains(TestLog::get(),
+        "rebuildSegment: Fragment of <99.0,89> failed its checksum"));
+    EXPECT_TRUE(recovery->replicas.at(1).recoveryException);
+
+    // A parity fragment alone rebuilds a segment with k = 1.
+    recovery->buildRecoverySegments(recovery->replicas.at(0));
+    EXPECT_FALSE(recovery->replicas.at(0).recoveryException);
+    EXPECT_TRUE(recovery->replicas.at(0).recoverySegments);
+}
+
 TEST_F(BackupMasterRecoveryTest, buildRecoverySegments_buildThrows) {
     mockMetadata(88, true, true);
     recovery->start(frames, NULL, NULL);
@@ -38,6 +38,20 @@ BackupStats::getExpectedReadMs() {
            1024 / 1024 / expectedReadMBytesPerSec);
 }
 
+/**
+ * Return the write load the backup last reported, or 0 if it hasn't
+ * reported one within the last #WRITE_LOAD_LIFETIME_MS.
+ */
+uint32_t
+BackupStats::getWriteLoad() {
+    if (writeLoad == 0 ||
+        Cycles::toNanoseconds(Cycles::rdtsc() - writeLoadCycles) >
+            uint64_t(WRITE_LOAD_LIFETIME_MS) * 1000 * 1000) {
+        return 0;
+    }
+    return writeLoad;
+}
+
 // --- BackupSelector ---
 
 /**
@@ -106,8 +120,10 @@ BackupSelector::selectPrimary(uint32_t numBackups,
 
 /**
  * Choose a random backup that does not conflict with an existing set of
- * backups. The ServerId will be invalid if there are no more machines to
- * choose from.
+ * backups. Backups that recently reported a write load of at least
+ * OVERLOADED_WRITE_LOAD are passed over in favor of others, up to
+ * MAX_OVERLOADED_SKIPS times. The ServerId will be invalid if there are no
+ * more machines to choose from.
  * \param numBackups
  *      The number of entries in the \a backupIds array.
  * \param backupIds
@@ -120,12 +136,18 @@ BackupSelector::selectSecondary(uint32_t numBackups,
                                 const ServerId backupIds[])
 {
     int attempts;
+    uint32_t overloadedSkips = 0;
     for (attempts = 0; attempts < 100; attempts++) {
         applyTrackerChanges();
         ServerId id = tracker.getRandomServerIdWithService(
             WireFormat::BACKUP_SERVICE);
         if (id.isValid() &&
             !conflictWithAny(id, numBackups, backupIds)) {
+            if (overloadedSkips < MAX_OVERLOADED_SKIPS &&
+                getWriteLoad(id) >= OVERLOADED_WRITE_LOAD) {
+                ++overloadedSkips;
+                continue;
+            }
             okToLogNextProblem = true;
             return id;
         }
@@ -155,6 +177,38 @@ BackupSelector::signalFreedPrimary(const ServerId backupId)
     --stats->primaryReplicaCount;
 }
 
+/**
+ * Record the write load a backup reported in reply to a replica write, so
+ * that selectSecondary() and ReplicatedSegment can steer work away from
+ * backups that are falling behind.
+ * \param backupId
+ *      The ServerId of the backup that replied.
+ * \param writeLoad
+ *      The load it reported; see WireFormat::BackupWrite::Response.
+ */
+void
+BackupSelector::updateWriteLoad(const ServerId backupId, uint32_t writeLoad)
+{
+    BackupStats* stats = findStats(backupId);
+    if (stats == NULL)
+        return;
+    stats->writeLoad = writeLoad;
+    stats->writeLoadCycles = Cycles::rdtsc();
+}
+
+/**
+ * Return the write load \a backupId most recently reported, or 0 if it
+ * hasn't reported one lately (or isn't known to this selector).
+ */
+uint32_t
+BackupSelector::getWriteLoad(const ServerId backupId)
+{
+    BackupStats* stats = findStats(backupId);
+    if (stats == NULL)
+        return 0;
+    return stats->getWriteLoad();
+}
+
 // - private -
 
 /**
@@ -200,6 +254,21 @@ BackupSelector::applyTrackerChanges()
     }
 }
 
+/**
+ * Return the BackupStats for \a backupId, or NULL if the tracker has no
+ * stats for it (for example, because it has been removed from the cluster
+ * since a replica was placed on it).
+ */
+BackupStats*
+BackupSelector::findStats(const ServerId backupId)
+{
+    try {
+        return tracker[backupId];
+    } catch (const Exception& e) {
+        return NULL;
+    }
+}
+
 /**
  * Return whether it is unwise to place a replica on \a backup given
  * that a replica exists on backup \a otherBackupId.
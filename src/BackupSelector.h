@@ -33,9 +33,12 @@ struct BackupStats {
         : primaryReplicaCount(0)
         , expectedReadMBytesPerSec(0)
         , replicationId(0)
+        , writeLoad(0)
+        , writeLoadCycles(0)
     {}
 
     uint32_t getExpectedReadMs();
+    uint32_t getWriteLoad();
 
     /// Number of primary replicas this master has stored on the backup.
     uint32_t primaryReplicaCount;
@@ -45,6 +48,21 @@ struct BackupStats {
 
     /// Replication group Id of the backup.
     uint64_t replicationId;
+
+    /// Write load the backup reported in its last reply to a replica write;
+    /// see WireFormat::BackupWrite::Response::writeLoad.
+    uint32_t writeLoad;
+
+    /// Cycles::rdtsc() when #writeLoad was reported.
+    uint64_t writeLoadCycles;
+
+    /**
+     * A reported write load is ignored once it is this old. Writes to a
+     * backup that is thought to be overloaded are delayed and then go
+     * elsewhere, so it may be a while before it can report again; this
+     * keeps a stale report from steering work away from it forever.
+     */
+    enum { WRITE_LOAD_LIFETIME_MS = 500 };
 };
 
 /// Tracks BackupStats; a ReplicaManager processes ServerListChanges.
@@ -60,7 +78,31 @@ class BaseBackupSelector {
     virtual ServerId selectSecondary(uint32_t numBackups,
                                      const ServerId backupIds[]) = 0;
     virtual void signalFreedPrimary(const ServerId backupId) = 0;
+
+    /**
+     * Record the write load a backup reported in reply to a replica write;
+     * see WireFormat::BackupWrite::Response::writeLoad. Selectors that
+     * don't balance on write load ignore it.
+     */
+    virtual void updateWriteLoad(const ServerId backupId, uint32_t writeLoad)
+    {}
+
+    /**
+     * Return the most recent write load reported by a backup, or 0 if
+     * there is no recent report.
+     */
+    virtual uint32_t getWriteLoad(const ServerId backupId) { return 0; }
+
     virtual ~BaseBackupSelector() {}
+
+    /**
+     * A backup reporting a write load at least this high is falling behind
+     * on flushing replicas to storage: new replicas are placed elsewhere if
+     * possible and writes to it yield rpc slots to other backups (see
+     * ReplicatedSegment::writeThrottled()). Chosen to leave the backup
+     * some headroom before it starts rejecting opens outright.
+     */
+    enum { OVERLOADED_WRITE_LOAD = 75 };
 };
 
 /**
@@ -77,9 +119,12 @@ class BackupSelector : public BaseBackupSelector {
     virtual ServerId selectSecondary(uint32_t numBackups,
                                      const ServerId backupIds[]);
     void signalFreedPrimary(const ServerId backupId);
+    void updateWriteLoad(const ServerId backupId, uint32_t writeLoad);
+    uint32_t getWriteLoad(const ServerId backupId);
 
   PROTECTED:
     void applyTrackerChanges();
+    BackupStats* findStats(const ServerId backupId);
     bool conflictWithAny(const ServerId backupId,
                          uint32_t numBackups,
                          const ServerId backupIds[]) const;
@@ -123,6 +168,13 @@ class BackupSelector : public BaseBackupSelector {
      */
     bool okToLogNextProblem;
 
+    /**
+     * selectSecondary() passes over at most this many overloaded backups
+     * before settling for one; when most of the cluster is overloaded
+     * there is no point searching for the rest.
+     */
+    enum { MAX_OVERLOADED_SKIPS = 5 };
+
   PRIVATE:
     bool conflict(const ServerId backupId,
                   const ServerId otherBackupId) const;
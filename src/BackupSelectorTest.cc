@@ -19,6 +19,7 @@
 
 #include "TestUtil.h"
 #include "Common.h"
+#include "Cycles.h"
 #include "MockCluster.h"
 #include "ServiceMask.h"
 #include "ShortMacros.h"
@@ -84,6 +85,23 @@ TEST_F(BackupSelectorTest, backupStats_getExpectedReadMs) {
     EXPECT_EQ(960u, stats.getExpectedReadMs());
 }
 
+TEST_F(BackupSelectorTest, backupStats_getWriteLoad) {
+    BackupStats stats;
+    EXPECT_EQ(0u, stats.getWriteLoad());
+
+    Cycles::mockCyclesPerSec = 1e09;
+    Cycles::mockTscValue = 1000;
+    stats.writeLoad = 80;
+    stats.writeLoadCycles = 1000;
+    EXPECT_EQ(80u, stats.getWriteLoad());
+    Cycles::mockTscValue = 1000 + 500 * 1000 * 1000;
+    EXPECT_EQ(80u, stats.getWriteLoad());
+    Cycles::mockTscValue++;
+    EXPECT_EQ(0u, stats.getWriteLoad()); // stale
+    Cycles::mockTscValue = 0;
+    Cycles::mockCyclesPerSec = 0;
+}
+
 struct BackgroundEnlistBackup {
     explicit BackgroundEnlistBackup(Context* context)
         : context(context) {}
@@ -208,6 +226,32 @@ TEST_F(BackupSelectorTest, selectSecondary) {
     EXPECT_EQ(ServerId(4, 0), id);
 }
 
+TEST_F(BackupSelectorTest, selectSecondary_skipOverloaded) {
+    MockRandom _(1);
+    std::vector<ServerId> ids;
+    addDifferentHosts(ids);
+    selector->applyTrackerChanges();
+    selector->updateWriteLoad(ids[0], BackupSelector::OVERLOADED_WRITE_LOAD);
+    selector->updateWriteLoad(ids[1], 99);
+    selector->updateWriteLoad(ids[2], 10);
+
+    ServerId id = selector->selectSecondary(0, NULL);
+    EXPECT_EQ(ids[2], id);
+}
+
+TEST_F(BackupSelectorTest, selectSecondary_allOverloaded) {
+    MockRandom _(1);
+    std::vector<ServerId> ids;
+    addDifferentHosts(ids);
+    selector->applyTrackerChanges();
+    foreach (ServerId backupId, ids)
+        selector->updateWriteLoad(backupId, 100);
+
+    // Settles for an overloaded backup after skipping a few.
+    ServerId id = selector->selectSecondary(0, NULL);
+    EXPECT_EQ(ids[BackupSelector::MAX_OVERLOADED_SKIPS], id);
+}
+
 TEST_F(BackupSelectorTest, selectSecondary_logThrottling) {
     // First problem: generate a log message.
     TestLog::reset();
@@ -250,6 +294,20 @@ TEST_F(BackupSelectorTest, signalFreedPrimary) {
     EXPECT_EQ(9u, stats->primaryReplicaCount);
 }
 
+TEST_F(BackupSelectorTest, updateWriteLoad) {
+    std::vector<ServerId> ids;
+    addEqualHosts(ids);
+    selector->applyTrackerChanges();
+    selector->updateWriteLoad(ids[0], 42);
+    EXPECT_EQ(42u, selector->tracker[ids[0]]->writeLoad);
+    EXPECT_EQ(42u, selector->getWriteLoad(ids[0]));
+    EXPECT_EQ(0u, selector->getWriteLoad(ids[1]));
+
+    // Unknown backups are ignored.
+    selector->updateWriteLoad(ServerId(99, 0), 42);
+    EXPECT_EQ(0u, selector->getWriteLoad(ServerId(99, 0)));
+}
+
 #if 0
 // This test should run forever, hence why it is commented out.
 // Occasionally, when self-doubt mounts, it is worth running, though.
@@ -13,16 +13,22 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <set>
+
 #include "BackupService.h"
 #include "Buffer.h"
 #include "ClientException.h"
 #include "Cycles.h"
+#include "FrameCompression.h"
 #include "InMemoryStorage.h"
 #include "PerfStats.h"
+#include "PmemStorage.h"
+#include "ReedSolomon.h"
 #include "ServerConfig.h"
 #include "ShortMacros.h"
 #include "MultiFileStorage.h"
 #include "Status.h"
+#include "TransportManager.h"
 
 namespace RAMCloud {
 
@@ -45,8 +51,10 @@ BackupService::BackupService(Context* context,
     , config(config)
     , formerServerId()
     , storage()
+    , fragmentStore()
     , frames()
     , recoveries()
+    , restoredReplicas()
     , segmentSize(config->segmentSize)
     , readSpeed()
     , bytesWritten(0)
@@ -60,9 +68,22 @@ BackupService::BackupService(Context* context,
 {
     context->services[WireFormat::BACKUP_SERVICE] = this;
     if (config->backup.inMemory) {
-        storage.reset(new InMemoryStorage(config->segmentSize,
-                                          config->backup.numSegmentFrames,
-                                          config->backup.writeRateLimit));
+        InMemoryStorage* inMemoryStorage =
+                new InMemoryStorage(config->segmentSize,
+                                    config->backup.numSegmentFrames,
+                                    config->backup.writeRateLimit,
+                                    config->backup.remoteWrites);
+        storage.reset(inMemoryStorage);
+        if (config->backup.remoteWrites) {
+            context->transportManager->registerMemory(
+                    inMemoryStorage->getFrameMemory(),
+                    config->segmentSize * config->backup.numSegmentFrames);
+        }
+    } else if (config->backup.pmem) {
+        storage.reset(new PmemStorage(config->segmentSize,
+                                      config->backup.numSegmentFrames,
+                                      config->backup.writeRateLimit,
+                                      config->backup.file.c_str()));
     } else {
         size_t maxWriteBuffers = config->backup.maxNonVolatileBuffers;
         if (maxWriteBuffers == 0) {
@@ -78,10 +99,16 @@ BackupService::BackupService(Context* context,
                                            config->backup.writeRateLimit,
                                            maxWriteBuffers,
                                            config->backup.file.c_str(),
-                                           O_DIRECT | O_SYNC));
+                                           O_DIRECT | O_SYNC,
+                                           config->backup.useIoUring,
+                                           config->backup.ioQueueDepth,
+                                           config->backup.compressReplicas,
+                                           config->backup.writeBackStaging));
     }
     if (storage->getMetadataSize() < sizeof(BackupReplicaMetadata))
         DIE("Storage metadata block too small to hold BackupReplicaMetadata");
+    fragmentStore.construct(storage.get(), segmentSize);
+    context->transportManager->setRequestPlacer(this);
 
     benchmark();
 
@@ -117,6 +144,7 @@ BackupService::BackupService(Context* context,
 BackupService::~BackupService()
 {
     context->services[WireFormat::BACKUP_SERVICE] = NULL;
+    context->transportManager->setRequestPlacer(NULL);
     // Stop the garbage collector.
     taskQueue.halt();
     if (gcThread)
@@ -190,14 +218,26 @@ BackupService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
     CycleCounter<RawMetric> serviceTicks(&metrics->backup.serviceTicks);
 
     switch (opcode) {
+        case WireFormat::BackupFindRecoveryKey::opcode:
+            callHandler<WireFormat::BackupFindRecoveryKey, BackupService,
+                        &BackupService::findRecoveryKey>(rpc);
+            break;
         case WireFormat::BackupFree::opcode:
             callHandler<WireFormat::BackupFree, BackupService,
                         &BackupService::freeSegment>(rpc);
             break;
+        case WireFormat::BackupGetFragment::opcode:
+            callHandler<WireFormat::BackupGetFragment, BackupService,
+                        &BackupService::getFragment>(rpc);
+            break;
         case WireFormat::BackupGetRecoveryData::opcode:
             callHandler<WireFormat::BackupGetRecoveryData, BackupService,
                         &BackupService::getRecoveryData>(rpc);
             break;
+        case WireFormat::BackupGetWriteTarget::opcode:
+            callHandler<WireFormat::BackupGetWriteTarget, BackupService,
+                        &BackupService::getWriteTarget>(rpc);
+            break;
         case WireFormat::BackupRecoveryComplete::opcode:
             callHandler<WireFormat::BackupRecoveryComplete, BackupService,
                         &BackupService::recoveryComplete>(rpc);
@@ -215,11 +255,67 @@ BackupService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::BackupWrite, BackupService,
                         &BackupService::writeSegment>(rpc);
             break;
+        case WireFormat::BackupWriteBatch::opcode:
+            callHandler<WireFormat::BackupWriteBatch, BackupService,
+                        &BackupService::writeSegmentBatch>(rpc);
+            break;
+        case WireFormat::BackupWriteFromReplicas::opcode:
+            callHandler<WireFormat::BackupWriteFromReplicas, BackupService,
+                        &BackupService::writeSegmentFromReplicas>(rpc);
+            break;
+        case WireFormat::BackupWriteChain::opcode:
+            callHandler<WireFormat::BackupWriteChain, BackupService,
+                        &BackupService::writeSegmentChain>(rpc);
+            break;
+        case WireFormat::BackupWriteFragment::opcode:
+            callHandler<WireFormat::BackupWriteFragment, BackupService,
+                        &BackupService::writeFragment>(rpc);
+            break;
         default:
             throw UnimplementedRequestError(HERE);
     }
 }
 
+/**
+ * Tell a recovery master which replicas of the crashed master it is
+ * recovering hold no entries for a key in their recovery segments for its
+ * partition (see BackupMasterRecovery::findKey()), so that it can serve
+ * the key once it has replayed the rest.
+ *
+ * \param reqHdr
+ *      Header of the Rpc request which contains the Rpc arguments.
+ * \param respHdr
+ *      Header for the Rpc response.
+ * \param rpc
+ *      The Rpc being serviced. The segment ids follow \a respHdr.
+ *
+ * \throw BackupBadSegmentIdException
+ *      If the master isn't under recovery on this backup.
+ */
+void
+BackupService::findRecoveryKey(
+    const WireFormat::BackupFindRecoveryKey::Request* reqHdr,
+    WireFormat::BackupFindRecoveryKey::Response* respHdr,
+    Rpc* rpc)
+{
+    ServerId crashedMasterId(reqHdr->masterId);
+    auto recoveryIt = recoveries.find(crashedMasterId);
+    if (recoveryIt == recoveries.end()) {
+        LOG(WARNING, "Asked to find a key in recovery segments for %s but "
+            "the master wasn't under recovery on the backup",
+            crashedMasterId.toString().c_str());
+        throw BackupBadSegmentIdException(HERE);
+    }
+
+    std::vector<uint64_t> absentFrom;
+    recoveryIt->second->findKey(reqHdr->recoveryId,
+                                downCast<int>(reqHdr->partitionId),
+                                reqHdr->keyHash, &absentFrom);
+    respHdr->segmentIdCount = downCast<uint32_t>(absentFrom.size());
+    foreach (uint64_t segmentId, absentFrom)
+        rpc->replyPayload->appendCopy(&segmentId, sizeof(segmentId));
+}
+
 /**
  * Enqueues the release of the replica for the specified segment from permanent
  * storage which will allow the storage to be reused. After this call completes
@@ -255,6 +351,64 @@ BackupService::freeSegment(const WireFormat::BackupFree::Request* reqHdr,
     frames.erase(it);
 }
 
+/**
+ * Return the erasure-coded fragment of a segment held by this backup, so
+ * that another backup can rebuild the segment for a master recovery (see
+ * BackupMasterRecovery::rebuildSegment()).
+ *
+ * \param reqHdr
+ *      Header of the Rpc request which contains the Rpc arguments.
+ * \param respHdr
+ *      Header for the Rpc response; the fragment follows it.
+ * \param rpc
+ *      The Rpc being serviced.
+ *
+ * \throw BackupBadSegmentIdException
+ *      If this backup holds no fragment of the segment.
+ * \throw SegmentRecoveryFailedException
+ *      If the fragment is damaged.
+ */
+void
+BackupService::getFragment(
+    const WireFormat::BackupGetFragment::Request* reqHdr,
+    WireFormat::BackupGetFragment::Response* respHdr,
+    Rpc* rpc)
+{
+    ServerId masterId(reqHdr->masterId);
+    auto it = frames.find({masterId, reqHdr->segmentId});
+    const BackupFragmentMetadata* metadata = NULL;
+    if (it != frames.end())
+        metadata = BackupFragmentMetadata::find(it->second->getMetadata());
+    if (metadata == NULL) {
+        LOG(NOTICE, "Asked for a fragment of <%s,%lu> but none is stored "
+            "here", masterId.toString().c_str(), reqHdr->segmentId);
+        throw BackupBadSegmentIdException(HERE);
+    }
+
+    // A recovery of the master may be rebuilding from the frame on other
+    // threads; it is only unloaded again if this rpc loaded it and no
+    // recovery could be using it.
+    BackupStorage::FrameRef frame = it->second;
+    bool wasLoaded = frame->isLoaded();
+    const void* data = frame->load();
+    Crc32C checksum;
+    checksum.update(data, metadata->length);
+    if (checksum.getResult() != metadata->fragmentChecksum) {
+        if (!wasLoaded && recoveries.find(masterId) == recoveries.end())
+            frame->unload();
+        LOG(WARNING, "Fragment of <%s,%lu> failed its checksum",
+            masterId.toString().c_str(), reqHdr->segmentId);
+        throw SegmentRecoveryFailedException(HERE);
+    }
+
+    respHdr->certificate = metadata->replica.certificate;
+    respHdr->fragmentIndex = metadata->fragmentIndex;
+    respHdr->length = metadata->length;
+    rpc->replyPayload->appendCopy(data, metadata->length);
+    if (!wasLoaded && recoveries.find(masterId) == recoveries.end())
+        frame->unload();
+}
+
 /**
  * Return the data for a particular tablet that was recovered by a call
  * to startReadingData().
@@ -308,6 +462,44 @@ BackupService::getRecoveryData(
     LOG(DEBUG, "getRecoveryData complete");
 }
 
+/**
+ * Tell a master where in this backup's memory it may place the data of one
+ * of its open replicas with one-sided RDMA writes, if the storage and one
+ * of the transports allow that (see BackupStorage::Frame::
+ * getRemoteWriteBuffer()). The master then sends BackupWrites with
+ * remotelyWritten set, which carry no data.
+ *
+ * \param reqHdr
+ *      Header of the Rpc request which contains the Rpc arguments.
+ * \param respHdr
+ *      Header for the Rpc response; its address is left 0 if the replica
+ *      isn't open here or can't be written remotely.
+ * \param rpc
+ *      The Rpc being serviced.
+ */
+void
+BackupService::getWriteTarget(
+    const WireFormat::BackupGetWriteTarget::Request* reqHdr,
+    WireFormat::BackupGetWriteTarget::Response* respHdr,
+    Rpc* rpc)
+{
+    ServerId masterId(reqHdr->masterId);
+    checkCallerInCluster(masterId);
+
+    respHdr->address = 0;
+    respHdr->key = 0;
+    auto frameIt = frames.find({masterId, reqHdr->segmentId});
+    if (frameIt == frames.end())
+        return;
+    void* buffer = frameIt->second->getRemoteWriteBuffer();
+    uint32_t key;
+    if (buffer != NULL && context->transportManager->getRemoteKey(
+            buffer, segmentSize, &key)) {
+        respHdr->address = reinterpret_cast<uint64_t>(buffer);
+        respHdr->key = key;
+    }
+}
+
 /**
  * Perform once-only initialization for the backup service after having
  * enlisted the process with the coordinator.
@@ -388,11 +580,21 @@ BackupService::restartFromStorage()
         gcTasks;
 
     std::vector<BackupStorage::FrameRef> allFrames = storage->loadAllMetadata();
+    // Frames holding fragments are replaced by a frame for each fragment.
+    std::vector<BackupStorage::FrameRef> fragments;
+    foreach (BackupStorage::FrameRef& frame, allFrames) {
+        if (fragmentStore->restore(frame, &fragments))
+            frame.reset();
+    }
+    allFrames.insert(allFrames.end(), fragments.begin(), fragments.end());
     foreach (BackupStorage::FrameRef& frame, allFrames) {
+        if (!frame)
+            continue;
         const BackupReplicaMetadata* metadata =
             static_cast<const BackupReplicaMetadata*>(frame->getMetadata());
         if (!metadata->checkIntegrity())
             continue;
+        bool fragment = BackupFragmentMetadata::find(metadata) != NULL;
         if (metadata->segmentCapacity != segmentSize) {
             LOG(ERROR, "On-storage replica metadata indicates a different "
                 "segment size than the backup service was told to use; "
@@ -402,8 +604,9 @@ BackupService::restartFromStorage()
             continue;
         }
         const ServerId masterId(metadata->logId);
-        LOG(NOTICE, "Found stored replica <%s,%lu> on backup storage in "
+        LOG(NOTICE, "Found stored %s <%s,%lu> on backup storage in "
                    "frame which was %s",
+            fragment ? "fragment of" : "replica",
             masterId.toString().c_str(),
             metadata->segmentId, metadata->closed ? "closed" : "open");
 
@@ -416,6 +619,10 @@ BackupService::restartFromStorage()
         }
         frames[MasterSegmentIdPair(masterId, metadata->segmentId)] =
             frame;
+        if (metadata->closed && metadata->primary && !fragment) {
+            restoredReplicas.push_back(
+                MasterSegmentIdPair(masterId, metadata->segmentId));
+        }
         if (gcTasks.find(masterId) == gcTasks.end()) {
             gcTasks[masterId] =
                 new GarbageCollectReplicasFoundOnStorageTask(*this, masterId);
@@ -431,6 +638,41 @@ BackupService::restartFromStorage()
         1000. * Cycles::toSeconds(restartTime.stop()));
 }
 
+/**
+ * Start loading every closed primary replica found on storage at startup
+ * whose master is not up, in the order the replicas are laid out on
+ * storage. Used when the whole cluster restarts: rather than reading the
+ * replicas of one crashed master after another, seeking back and forth
+ * between them, each disk is read once from start to end on behalf of all
+ * recoveries. Each replica is bucketed into the recovery segments of all
+ * of its master's partitions as soon as its recovery is partitioned, just
+ * as in an ordinary recovery.
+ *
+ * This only has an effect the first time it is called after
+ * restartFromStorage.
+ */
+void
+BackupService::loadRestoredReplicas()
+{
+    std::set<ServerId> masters;
+    size_t loaded = 0;
+    foreach (const MasterSegmentIdPair& replica, restoredReplicas) {
+        if (context->serverList->isUp(replica.masterId))
+            continue;
+        auto it = frames.find(replica);
+        if (it == frames.end())
+            continue;
+        it->second->startLoading();
+        masters.insert(replica.masterId);
+        ++loaded;
+    }
+    if (loaded > 0) {
+        LOG(NOTICE, "Cold start: loading %lu primary replicas of %lu crashed "
+            "masters in storage order", loaded, masters.size());
+    }
+    restoredReplicas.clear();
+}
+
 /**
  * Begin reading disk data for a Master, returning a list of backed
  * up Segments this backup has for the Master.
@@ -454,6 +696,8 @@ BackupService::startReadingData(
         Rpc* rpc)
 {
     ServerId crashedMasterId(reqHdr->masterId);
+    if (reqHdr->coldStart)
+        loadRestoredReplicas();
 
     bool mustCreateRecovery = false;
     auto recoveryIt = recoveries.find(crashedMasterId);
@@ -474,10 +718,11 @@ BackupService::startReadingData(
     }
     BackupMasterRecovery* recovery;
     if (mustCreateRecovery) {
-        recovery = new BackupMasterRecovery(taskQueue,
-                                            reqHdr->recoveryId,
-                                            crashedMasterId,
-                                            segmentSize);
+        recovery = new BackupMasterRecovery(
+                context, taskQueue, reqHdr->recoveryId, crashedMasterId,
+                segmentSize,
+                config->backup.recoveryBuildThreads,
+                config->backup.recoveryDedup);
         recoveries[crashedMasterId] = recovery;
     }
     recovery = recoveries[crashedMasterId];
@@ -525,7 +770,168 @@ BackupService::startPartitioningReplicas(
     ProtoBuf::RecoveryPartition partitions;
     ProtoBuf::parseFromResponse(rpc->requestPayload, sizeof(*reqHdr),
                                 reqHdr->partitionsLength, &partitions);
-    recovery->setPartitionsAndSchedule(partitions);
+    typedef WireFormat::BackupStartPartitioningReplicas::FragmentLocation
+            FragmentLocation;
+    std::vector<FragmentLocation> fragments;
+    uint32_t offset = sizeof32(*reqHdr) + reqHdr->partitionsLength;
+    for (uint32_t i = 0; i < reqHdr->fragmentCount; i++) {
+        const FragmentLocation* location =
+            rpc->requestPayload->getOffset<FragmentLocation>(offset);
+        if (location == NULL)
+            throw MessageTooShortError(HERE);
+        fragments.push_back(*location);
+        offset += sizeof32(*location);
+    }
+    // Building recovery segments hashes the keys of every object replayed.
+    foreach (const ProtoBuf::Tablets::Tablet& tablet, partitions.tablet()) {
+        Key::setHashFunction(tablet.table_id(),
+                Key::HashFunction(tablet.key_hash()));
+    }
+    recovery->setPartitionsAndSchedule(partitions, fragments);
+}
+
+/**
+ * Store an erasure-coded fragment of a closed segment (see
+ * ReplicatedSegment) in place of a full replica of it. The fragment is
+ * packed into a frame with fragments of other segments (see
+ * BackupFragmentStore) and written at once. Idempotent; anything stored
+ * for the segment before is replaced unless it is the same fragment.
+ *
+ * If the request says so, the fragment isn't carried by the rpc: this
+ * backup computes it from its closed replica of the segment, which the
+ * fragment then replaces. This way a master converting a segment's
+ * replicas into fragments needn't send their data again.
+ *
+ * \param reqHdr
+ *      Header of the Rpc request which contains the Rpc arguments except
+ *      the fragment, which follows reqHdr.
+ * \param respHdr
+ *      Header for the Rpc response.
+ * \param rpc
+ *      The Rpc being serviced.
+ *
+ * \throw BackupOpenRejectedException
+ *      If there is no room for the fragment on storage.
+ * \throw BackupBadSegmentIdException
+ *      If the fragment is to be computed from a replica, but this backup
+ *      holds no closed replica of the segment matching the request; the
+ *      master should send the fragment instead.
+ * \throw RequestFormatError
+ *      If the fragment is malformed or doesn't match its checksum.
+ */
+void
+BackupService::writeFragment(
+        const WireFormat::BackupWriteFragment::Request* reqHdr,
+        WireFormat::BackupWriteFragment::Response* respHdr,
+        Rpc* rpc)
+{
+    ServerId masterId(reqHdr->masterId);
+    checkCallerInCluster(masterId);
+
+    uint32_t k = reqHdr->dataFragments;
+    uint32_t m = reqHdr->parityFragments;
+    if (k == 0 || reqHdr->fragmentIndex >= k + m || k + m > 256 ||
+            reqHdr->certificate.segmentLength > segmentSize ||
+            reqHdr->length !=
+                (reqHdr->certificate.segmentLength + k - 1) / k) {
+        throw RequestFormatError(HERE);
+    }
+
+    MasterSegmentIdPair key(masterId, reqHdr->segmentId);
+    auto it = frames.find(key);
+    const BackupFragmentMetadata* stored = NULL;
+    if (it != frames.end()) {
+        stored = BackupFragmentMetadata::find(it->second->getMetadata());
+        if (stored != NULL && stored->fragmentIndex == reqHdr->fragmentIndex &&
+                stored->replica.certificate == reqHdr->certificate) {
+            LOG(NOTICE, "Fragment %u of <%s,%lu> is already stored; treating "
+                "the request as noop", reqHdr->fragmentIndex,
+                masterId.toString().c_str(), reqHdr->segmentId);
+            return;
+        }
+    }
+
+    Buffer fragment;
+    uint32_t fragmentOffset = sizeof32(*reqHdr);
+    Buffer* source = rpc->requestPayload;
+    if (reqHdr->fromReplica) {
+        const BackupReplicaMetadata* metadata = NULL;
+        if (it != frames.end() && stored == NULL &&
+                !it->second->currentlyOpen()) {
+            metadata = static_cast<const BackupReplicaMetadata*>(
+                it->second->getMetadata());
+        }
+        if (metadata == NULL || !metadata->closed ||
+                !(metadata->certificate == reqHdr->certificate)) {
+            LOG(NOTICE, "Can't compute fragment %u of <%s,%lu>: no matching "
+                "closed replica of it here", reqHdr->fragmentIndex,
+                masterId.toString().c_str(), reqHdr->segmentId);
+            throw BackupBadSegmentIdException(HERE);
+        }
+
+        // As in getFragment(), a recovery may be using the replica.
+        BackupStorage::FrameRef replica = it->second;
+        bool wasLoaded = replica->isLoaded();
+        const void* data = replica->load();
+        std::unique_ptr<char[]> expanded;
+        try {
+            if (FrameCompression::isCompressed(data)) {
+                expanded.reset(new char[segmentSize]);
+                FrameCompression::decompress(data, segmentSize,
+                                             expanded.get(), segmentSize);
+                data = expanded.get();
+            }
+            ReedSolomon(k, m).encodeFragment(data,
+                    reqHdr->certificate.segmentLength, reqHdr->fragmentIndex,
+                    fragment.alloc(reqHdr->length));
+        } catch (const FrameCompressionException& e) {
+            LOG(WARNING, "Replica of <%s,%lu> is damaged: %s",
+                masterId.toString().c_str(), reqHdr->segmentId, e.what());
+        }
+        if (!wasLoaded && recoveries.find(masterId) == recoveries.end())
+            replica->unload();
+        if (fragment.size() == 0)
+            throw BackupBadSegmentIdException(HERE);
+        source = &fragment;
+        fragmentOffset = 0;
+    } else if (fragmentOffset + reqHdr->length > source->size()) {
+        throw MessageTooShortError(HERE);
+    }
+
+    Crc32C checksum;
+    checksum.update(*source, fragmentOffset, reqHdr->length);
+    if (checksum.getResult() != reqHdr->checksum) {
+        LOG(WARNING, "Fragment %u of <%s,%lu> %s", reqHdr->fragmentIndex,
+            masterId.toString().c_str(), reqHdr->segmentId,
+            reqHdr->fromReplica ? "doesn't match the replica here" :
+                                  "arrived damaged");
+        if (reqHdr->fromReplica)
+            throw BackupBadSegmentIdException(HERE);
+        throw RequestFormatError(HERE);
+    }
+
+    // The master only places a fragment on a backup that holds nothing
+    // else it still needs of the segment.
+    if (it != frames.end())
+        frames.erase(it);
+
+    LOG(DEBUG, "Storing fragment %u of <%s,%lu>", reqHdr->fragmentIndex,
+        masterId.toString().c_str(), reqHdr->segmentId);
+    BackupReplicaMetadata replica(reqHdr->certificate, masterId.getId(),
+                                  reqHdr->segmentId, segmentSize,
+                                  reqHdr->segmentEpoch, true,
+                                  reqHdr->primary);
+    BackupFragmentMetadata metadata(replica, reqHdr->fragmentIndex,
+                                    reqHdr->dataFragments,
+                                    reqHdr->parityFragments, reqHdr->length,
+                                    reqHdr->checksum);
+    frames[key] = fragmentStore->store(config->backup.sync, metadata,
+                                       *source, fragmentOffset);
+    if (!reqHdr->fromReplica) {
+        metrics->backup.writeCopyBytes += reqHdr->length;
+        PerfStats::threadStats.backupBytesReceived += reqHdr->length;
+    }
+    bytesWritten += reqHdr->length;
 }
 
 /**
@@ -567,10 +973,276 @@ BackupService::writeSegment(const WireFormat::BackupWrite::Request* reqHdr,
                             Rpc* rpc)
 {
     ServerId masterId(reqHdr->masterId);
-    uint64_t segmentId = reqHdr->segmentId;
+    checkCallerInCluster(masterId);
+
+    WireFormat::BackupWriteBatch::Part part = {
+        reqHdr->segmentId, reqHdr->segmentEpoch, reqHdr->offset,
+        reqHdr->length, reqHdr->open, reqHdr->close, reqHdr->primary,
+        reqHdr->certificateIncluded, reqHdr->certificate
+    };
+    writeReplica(masterId, part, *rpc->requestPayload, sizeof(*reqHdr),
+                 reqHdr->remotelyWritten);
+    respHdr->writeLoad = storage->getWriteLoad();
+}
+
+/**
+ * Perform a replica write from a master and pass it on to the backups
+ * holding the segment's other replicas, so that the master needn't send
+ * the data to each of them itself. The writes to the other backups are
+ * started before the local one and all run in parallel; the reply is sent
+ * once every one of them has finished.
+ *
+ * A backup that couldn't be reached or rejected the write doesn't fail the
+ * rpc: its bit in the response's forwardedMask is left clear, and the
+ * master sends it the write directly.
+ *
+ * \param reqHdr
+ *      Header of the Rpc request; the ids of the backups to pass the write
+ *      on to and then the data follow it.
+ * \param respHdr
+ *      Header for the Rpc response.
+ * \param rpc
+ *      The Rpc being serviced.
+ *
+ * \throw RequestFormatError
+ *      If the request names more than BackupWriteChain::MAX_FORWARDS
+ *      backups.
+ */
+void
+BackupService::writeSegmentChain(
+        const WireFormat::BackupWriteChain::Request* reqHdr,
+        WireFormat::BackupWriteChain::Response* respHdr,
+        Rpc* rpc)
+{
+    ServerId masterId(reqHdr->masterId);
+    checkCallerInCluster(masterId);
+
+    uint32_t count = reqHdr->forwardCount;
+    if (count > WireFormat::BackupWriteChain::MAX_FORWARDS)
+        throw RequestFormatError(HERE);
+    Buffer* payload = rpc->requestPayload;
+    uint32_t idOffset = sizeof32(*reqHdr);
+    uint32_t dataOffset = idOffset + count * sizeof32(uint64_t);
+    if (uint64_t(dataOffset) + reqHdr->length > payload->size())
+        throw MessageTooShortError(HERE);
+
+    Tub<ForwardWriteRpc> forwards[WireFormat::BackupWriteChain::MAX_FORWARDS];
+    ServerId forwardIds[WireFormat::BackupWriteChain::MAX_FORWARDS];
+    for (uint32_t i = 0; i < count; i++) {
+        forwardIds[i] = ServerId(*payload->getOffset<uint64_t>(
+                idOffset + i * sizeof32(uint64_t)));
+        forwards[i].construct(context, forwardIds[i], reqHdr, payload,
+                              dataOffset);
+    }
+
+    WireFormat::BackupWriteBatch::Part part = {
+        reqHdr->segmentId, reqHdr->segmentEpoch, reqHdr->offset,
+        reqHdr->length, reqHdr->open, reqHdr->close, reqHdr->primary,
+        reqHdr->certificateIncluded, reqHdr->certificate
+    };
+    writeReplica(masterId, part, *payload, dataOffset);
+
+    respHdr->forwardedMask = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        try {
+            forwards[i]->wait();
+            respHdr->forwardedMask |= 1u << i;
+        } catch (const ClientException& e) {
+            LOG(NOTICE, "Couldn't pass write to replica of segment <%s,%lu> "
+                "on to backup %s (status %s); leaving it to the master",
+                masterId.toString().c_str(), reqHdr->segmentId,
+                forwardIds[i].toString().c_str(), statusToSymbol(e.status));
+        }
+    }
+    respHdr->writeLoad = storage->getWriteLoad();
+}
+
+/**
+ * Perform several replica writes from one master, as if each had arrived
+ * in its own BackupWrite rpc. The writes are applied in order; a write that
+ * fails doesn't stop the ones after it, and its error is reported in the
+ * status for that write rather than for the whole rpc.
+ *
+ * \param reqHdr
+ *      Header of the Rpc request; the parts and their data follow it.
+ * \param respHdr
+ *      Header for the Rpc response; a Status for each part is appended
+ *      after it.
+ * \param rpc
+ *      The Rpc being serviced.
+ */
+void
+BackupService::writeSegmentBatch(
+        const WireFormat::BackupWriteBatch::Request* reqHdr,
+        WireFormat::BackupWriteBatch::Response* respHdr,
+        Rpc* rpc)
+{
+    ServerId masterId(reqHdr->masterId);
+    checkCallerInCluster(masterId);
+
+    Buffer* payload = rpc->requestPayload;
+    uint32_t offset = sizeof(*reqHdr);
+    for (uint32_t i = 0; i < reqHdr->count; i++) {
+        const WireFormat::BackupWriteBatch::Part* part =
+            payload->getOffset<WireFormat::BackupWriteBatch::Part>(offset);
+        if (part == NULL ||
+                offset + sizeof(*part) + part->length > payload->size()) {
+            LOG(WARNING, "Backup write batch from %s was truncated at "
+                "part %u of %u", masterId.toString().c_str(), i,
+                reqHdr->count);
+            throw MessageTooShortError(HERE);
+        }
+        offset += sizeof32(*part);
+
+        Status status = STATUS_OK;
+        try {
+            writeReplica(masterId, *part, *payload, offset);
+        } catch (ClientException& e) {
+            status = e.status;
+        }
+        rpc->replyPayload->emplaceAppend<Status>(status);
+        offset += part->length;
+    }
+    respHdr->writeLoad = storage->getWriteLoad();
+    respHdr->count = reqHdr->count;
+}
+
+/**
+ * Perform a replica write whose data is assembled from ranges of other
+ * replicas of the same master that are stored on this backup, interspersed
+ * with bytes carried in the rpc. The log cleaner uses this to replicate
+ * survivor segments: most of a survivor is live entries copied verbatim out
+ * of the segments being cleaned, and backups that hold replicas of those
+ * segments needn't receive them again.
+ *
+ * Nothing is written unless every piece can be found, so a master that gets
+ * an error back can simply retry the write with all of its data.
+ *
+ * \param reqHdr
+ *      Header of the Rpc request; the pieces and then the literal bytes
+ *      follow it.
+ * \param respHdr
+ *      Header for the Rpc response.
+ * \param rpc
+ *      The Rpc being serviced.
+ *
+ * \throw BackupBadSegmentIdException
+ *      If a source replica isn't on this backup, isn't closed, or doesn't
+ *      hold the bytes a piece refers to.
+ * \throw RequestFormatError
+ *      If the pieces don't add up to the length of the write.
+ */
+void
+BackupService::writeSegmentFromReplicas(
+        const WireFormat::BackupWriteFromReplicas::Request* reqHdr,
+        WireFormat::BackupWriteFromReplicas::Response* respHdr,
+        Rpc* rpc)
+{
+    ServerId masterId(reqHdr->masterId);
+    checkCallerInCluster(masterId);
+
+    typedef WireFormat::BackupWriteFromReplicas::Piece Piece;
+    Buffer* payload = rpc->requestPayload;
+    uint32_t pieceOffset = sizeof32(*reqHdr);
+    if (pieceOffset + uint64_t(reqHdr->pieceCount) * sizeof(Piece) >
+            payload->size()) {
+        throw MessageTooShortError(HERE);
+    }
+    uint32_t literalOffset = pieceOffset +
+        reqHdr->pieceCount * sizeof32(Piece);
+
+    // Source replicas this rpc loaded into memory; unloaded again when done
+    // so that cleaning doesn't leave buffers pinned on the backup.
+    std::vector<BackupStorage::FrameRef> loaded;
+    Buffer data;
+    uint64_t total = 0;
+    uint64_t copied = 0;
+    try {
+        for (uint32_t i = 0; i < reqHdr->pieceCount; i++) {
+            const Piece* piece = payload->getOffset<Piece>(pieceOffset);
+            pieceOffset += sizeof32(*piece);
+            total += piece->length;
+            if (piece->sourceSegmentId == 0) {
+                if (uint64_t(literalOffset) + piece->length > payload->size())
+                    throw MessageTooShortError(HERE);
+                payload->copy(literalOffset, piece->length,
+                              data.alloc(piece->length));
+                literalOffset += piece->length;
+                continue;
+            }
+
+            auto it = frames.find({masterId, piece->sourceSegmentId});
+            if (it == frames.end() || it->second->currentlyOpen()) {
+                LOG(NOTICE, "Can't build a replica of <%s,%lu> from segment "
+                    "%lu: no closed replica of it here",
+                    masterId.toString().c_str(), reqHdr->segmentId,
+                    piece->sourceSegmentId);
+                throw BackupBadSegmentIdException(HERE);
+            }
+            BackupStorage::FrameRef source = it->second;
+            const BackupReplicaMetadata* metadata =
+                static_cast<const BackupReplicaMetadata*>(
+                    source->getMetadata());
+            if (BackupFragmentMetadata::find(metadata) != NULL) {
+                LOG(NOTICE, "Can't build a replica of <%s,%lu> from segment "
+                    "%lu: only a fragment of it is here",
+                    masterId.toString().c_str(), reqHdr->segmentId,
+                    piece->sourceSegmentId);
+                throw BackupBadSegmentIdException(HERE);
+            }
+            if (uint64_t(piece->sourceOffset) + piece->length >
+                    metadata->certificate.segmentLength) {
+                LOG(WARNING, "Piece [%u, %u) is beyond the end of replica "
+                    "<%s,%lu>", piece->sourceOffset,
+                    piece->sourceOffset + piece->length,
+                    masterId.toString().c_str(), piece->sourceSegmentId);
+                throw BackupBadSegmentIdException(HERE);
+            }
+            if (!source->isLoaded() &&
+                    std::find(loaded.begin(), loaded.end(), source) ==
+                    loaded.end()) {
+                loaded.push_back(source);
+            }
+            const char* replica = static_cast<const char*>(source->load());
+            memcpy(data.alloc(piece->length), replica + piece->sourceOffset,
+                   piece->length);
+            copied += piece->length;
+        }
+    } catch (...) {
+        foreach (BackupStorage::FrameRef& source, loaded)
+            source->unload();
+        throw;
+    }
+    foreach (BackupStorage::FrameRef& source, loaded)
+        source->unload();
 
+    if (total != reqHdr->length) {
+        LOG(WARNING, "Pieces of write to <%s,%lu> add up to %lu bytes, "
+            "not %u", masterId.toString().c_str(), reqHdr->segmentId,
+            total, reqHdr->length);
+        throw RequestFormatError(HERE);
+    }
+    WireFormat::BackupWriteBatch::Part part = {
+        reqHdr->segmentId, reqHdr->segmentEpoch, reqHdr->offset,
+        reqHdr->length, reqHdr->open, reqHdr->close, reqHdr->primary,
+        reqHdr->certificateIncluded, reqHdr->certificate
+    };
+    writeReplica(masterId, part, data, 0);
+    metrics->backup.writeCopyFromReplicaBytes += copied;
+    respHdr->writeLoad = storage->getWriteLoad();
+}
+
+/**
+ * Reject a write from a master that isn't (or is no longer) part of the
+ * cluster; see "Zombies" in designNotes.
+ *
+ * \throw CallerNotInClusterException
+ *      \a masterId isn't up in this server's server list.
+ */
+void
+BackupService::checkCallerInCluster(ServerId masterId)
+{
     if  (!context->serverList->isUp(masterId) && !testingSkipCallerIdCheck) {
-        // See "Zombies" in designNotes.
         LOG(WARNING, "Received backup write request from server %s which is "
             "not in server list version %lu:\n%s",
             masterId.toString().c_str(),
@@ -578,13 +1250,53 @@ BackupService::writeSegment(const WireFormat::BackupWrite::Request* reqHdr,
             context->serverList->toString().c_str());
         throw CallerNotInClusterException(HERE);
     }
+}
+
+/**
+ * Apply one write to a replica; does the work for writeSegment() and
+ * writeSegmentBatch().
+ *
+ * \param masterId
+ *      Master that owns the replica.
+ * \param part
+ *      Describes the write: which replica, where the data goes, and whether
+ *      to open or close the replica.
+ * \param payload
+ *      Buffer holding the data to write.
+ * \param dataOffset
+ *      Offset in \a payload of the first of the part.length bytes to write.
+ * \param remotelyWritten
+ *      True means the master has already placed the data in the replica's
+ *      buffer (see getWriteTarget()); \a payload is ignored.
+ *
+ * \throw BackupBadSegmentIdException
+ *      If the segment is not open.
+ */
+void
+BackupService::writeReplica(ServerId masterId,
+                            const WireFormat::BackupWriteBatch::Part& part,
+                            Buffer& payload, uint32_t dataOffset,
+                            bool remotelyWritten)
+{
+    uint64_t segmentId = part.segmentId;
+
     auto frameIt = frames.find({masterId, segmentId});
     BackupStorage::FrameRef frame;
-    if (frameIt != frames.end())
+    if (frameIt != frames.end()) {
         frame = frameIt->second;
+        if (part.open &&
+                BackupFragmentMetadata::find(frame->getMetadata()) != NULL) {
+            // The master lost enough of the segment's fragments that it is
+            // replicating the segment again; the old fragment goes.
+            LOG(NOTICE, "Replacing fragment of <%s,%lu> with a replica",
+                masterId.toString().c_str(), segmentId);
+            frames.erase(frameIt);
+            frame.reset();
+        }
+    }
 
     if (frame && !frame->wasAppendedToByCurrentProcess()) {
-        if (reqHdr->open) {
+        if (part.open) {
             // We get here if a backup crashes, restarts, reloads a
             // replica from disk, and then the master detects the crash and
             // tries to re-replicate the segment that lost a replica on
@@ -604,7 +1316,7 @@ BackupService::writeSegment(const WireFormat::BackupWrite::Request* reqHdr,
     }
 
     // Perform open, if any.
-    if (reqHdr->open && !frame) {
+    if (part.open && !frame) {
         LOG(DEBUG, "Opening <%s,%lu>", masterId.toString().c_str(),
             segmentId);
         frame = storage->open(config->backup.sync, masterId, segmentId);
@@ -631,28 +1343,94 @@ BackupService::writeSegment(const WireFormat::BackupWrite::Request* reqHdr,
         }
         CycleCounter<RawMetric> __(&metrics->backup.writeCopyTicks);
         Tub<BackupReplicaMetadata> metadata;
-        if (reqHdr->certificateIncluded) {
-            metadata.construct(reqHdr->certificate,
+        if (part.certificateIncluded) {
+            metadata.construct(part.certificate,
                                masterId.getId(), segmentId,
                                segmentSize,
-                               reqHdr->segmentEpoch,
-                               reqHdr->close, reqHdr->primary);
+                               part.segmentEpoch,
+                               part.close, part.primary);
         }
-        frame->append(*rpc->requestPayload, sizeof(*reqHdr),
-                      reqHdr->length, reqHdr->offset,
-                      metadata.get(), sizeof(*metadata));
-        metrics->backup.writeCopyBytes += reqHdr->length;
-        PerfStats::threadStats.backupBytesReceived += reqHdr->length;
-        bytesWritten += reqHdr->length;
+        // The transport may have received the data straight into the
+        // replica (see placeRequest()).
+        void* data = NULL;
+        char* receiveBuffer = static_cast<char*>(frame->getReceiveBuffer());
+        if (!remotelyWritten && receiveBuffer != NULL &&
+                payload.peek(dataOffset, &data) >= part.length &&
+                data == receiveBuffer + part.offset) {
+            remotelyWritten = true;
+            metrics->backup.writePlacedBytes += part.length;
+        }
+        if (remotelyWritten) {
+            frame->appendRemotelyWritten(part.length, part.offset,
+                                         metadata.get(), sizeof(*metadata));
+        } else {
+            frame->append(payload, dataOffset, part.length, part.offset,
+                          metadata.get(), sizeof(*metadata));
+        }
+        metrics->backup.writeCopyBytes += part.length;
+        PerfStats::threadStats.backupBytesReceived += part.length;
+        bytesWritten += part.length;
     }
 
     // Perform close, if any.
-    if (reqHdr->close) {
+    if (part.close) {
         LOG(DEBUG, "Closing <%s,%lu>", masterId.toString().c_str(), segmentId);
         frame->close();
     }
 }
 
+/**
+ * See Transport::RequestPlacer::getPrefixLength(). Only BACKUP_WRITE
+ * requests are placed.
+ */
+uint32_t
+BackupService::getPrefixLength()
+{
+    return sizeof32(WireFormat::BackupWrite::Request);
+}
+
+/**
+ * Invoked by transports once the header of a request has arrived: if it is
+ * a BACKUP_WRITE to a replica open on this backup, have the data received
+ * directly into the replica's buffer at the offset it is written to, so
+ * writeReplica() needn't copy it. See Transport::RequestPlacer.
+ *
+ * Runs on a transport's receiving thread, so it gives up rather than wait
+ * for a request being serviced. The frame is pinned until the request is
+ * destroyed, so its buffer can't be reused for another replica meanwhile.
+ * A write placed this way but then rejected only changes bytes beyond what
+ * has been appended, or bytes being rewritten with the same data.
+ */
+void*
+BackupService::placeRequest(const void* prefix, uint32_t requestLength,
+                            uint32_t* length, std::shared_ptr<void>* pin)
+{
+    const WireFormat::BackupWrite::Request* reqHdr =
+            static_cast<const WireFormat::BackupWrite::Request*>(prefix);
+    if (reqHdr->common.opcode != WireFormat::BACKUP_WRITE ||
+            reqHdr->common.service != WireFormat::BACKUP_SERVICE ||
+            reqHdr->remotelyWritten || reqHdr->length == 0 ||
+            requestLength != sizeof(*reqHdr) + reqHdr->length ||
+            reqHdr->offset > segmentSize ||
+            reqHdr->length > segmentSize - reqHdr->offset) {
+        return NULL;
+    }
+
+    Lock lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return NULL;
+    auto frameIt = frames.find({ServerId(reqHdr->masterId),
+                                reqHdr->segmentId});
+    if (frameIt == frames.end())
+        return NULL;
+    char* buffer = static_cast<char*>(frameIt->second->getReceiveBuffer());
+    if (buffer == NULL)
+        return NULL;
+    *length = reqHdr->length;
+    *pin = frameIt->second;
+    return buffer + reqHdr->offset;
+}
+
 /**
  * Runs garbage collection tasks.
  */
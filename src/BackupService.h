@@ -21,6 +21,7 @@
 
 #include "Common.h"
 #include "BackupClient.h"
+#include "BackupFragmentStore.h"
 #include "BackupMasterRecovery.h"
 #include "BackupStorage.h"
 #include "CoordinatorClient.h"
@@ -28,6 +29,7 @@
 #include "Service.h"
 #include "ServerConfig.h"
 #include "TaskQueue.h"
+#include "Transport.h"
 
 namespace RAMCloud {
 
@@ -37,7 +39,8 @@ namespace RAMCloud {
  * masters crash.
  */
 class BackupService : public Service
-                    , ServerTracker<void>::Callback {
+                    , ServerTracker<void>::Callback
+                    , Transport::RequestPlacer {
   PUBLIC:
     BackupService(Context* context, const ServerConfig* config);
     virtual ~BackupService();
@@ -51,16 +54,29 @@ class BackupService : public Service
     void freeSegment(const WireFormat::BackupFree::Request* reqHdr,
                      WireFormat::BackupFree::Response* respHdr,
                      Rpc* rpc);
+    void findRecoveryKey(
+        const WireFormat::BackupFindRecoveryKey::Request* reqHdr,
+        WireFormat::BackupFindRecoveryKey::Response* respHdr,
+        Rpc* rpc);
+    void getFragment(
+        const WireFormat::BackupGetFragment::Request* reqHdr,
+        WireFormat::BackupGetFragment::Response* respHdr,
+        Rpc* rpc);
     void getRecoveryData(
         const WireFormat::BackupGetRecoveryData::Request* reqHdr,
         WireFormat::BackupGetRecoveryData::Response* respHdr,
         Rpc* rpc);
+    void getWriteTarget(
+        const WireFormat::BackupGetWriteTarget::Request* reqHdr,
+        WireFormat::BackupGetWriteTarget::Response* respHdr,
+        Rpc* rpc);
     void killAllStorage();
     void recoveryComplete(
         const WireFormat::BackupRecoveryComplete::Request* reqHdr,
         WireFormat::BackupRecoveryComplete::Response* respHdr,
         Rpc* rpc);
     void restartFromStorage();
+    void loadRestoredReplicas();
     void startReadingData(
         const WireFormat::BackupStartReadingData::Request* reqHdr,
         WireFormat::BackupStartReadingData::Response* respHdr,
@@ -69,10 +85,32 @@ class BackupService : public Service
         const WireFormat::BackupStartPartitioningReplicas::Request* reqHdr,
         WireFormat::BackupStartPartitioningReplicas::Response* respHdr,
         Rpc* rpc);
+    void writeFragment(const WireFormat::BackupWriteFragment::Request* req,
+                       WireFormat::BackupWriteFragment::Response* resp,
+                       Rpc* rpc);
     void writeSegment(const WireFormat::BackupWrite::Request* req,
                       WireFormat::BackupWrite::Response* resp,
                       Rpc* rpc);
+    void writeSegmentBatch(const WireFormat::BackupWriteBatch::Request* req,
+                           WireFormat::BackupWriteBatch::Response* resp,
+                           Rpc* rpc);
+    void writeSegmentChain(
+        const WireFormat::BackupWriteChain::Request* req,
+        WireFormat::BackupWriteChain::Response* resp,
+        Rpc* rpc);
+    void writeSegmentFromReplicas(
+        const WireFormat::BackupWriteFromReplicas::Request* req,
+        WireFormat::BackupWriteFromReplicas::Response* resp,
+        Rpc* rpc);
+    void checkCallerInCluster(ServerId masterId);
+    void writeReplica(ServerId masterId,
+                      const WireFormat::BackupWriteBatch::Part& part,
+                      Buffer& payload, uint32_t dataOffset,
+                      bool remotelyWritten = false);
     void gcMain();
+    uint32_t getPrefixLength();
+    void* placeRequest(const void* prefix, uint32_t requestLength,
+                       uint32_t* length, std::shared_ptr<void>* pin);
     void initOnceEnlisted();
     void trackerChangesEnqueued();
 
@@ -114,6 +152,12 @@ class BackupService : public Service
     std::unique_ptr<BackupStorage> storage;
   PRIVATE:
 
+    /**
+     * Packs erasure-coded fragments of segments into frames of #storage.
+     * Constructed along with #storage; must also come before #frames.
+     */
+    Tub<BackupFragmentStore> fragmentStore;
+
     /// Type of the key for the frame map.
     struct MasterSegmentIdPair {
         MasterSegmentIdPair(ServerId masterId, uint64_t segmentId)
@@ -149,6 +193,14 @@ class BackupService : public Service
      */
     std::map<ServerId, BackupMasterRecovery*> recoveries;
 
+    /**
+     * Closed primary replicas found on storage by restartFromStorage, in
+     * the order they are laid out there. Loaded all at once by
+     * loadRestoredReplicas when the first recovery of a whole-cluster
+     * restart reaches this backup, then cleared.
+     */
+    std::vector<MasterSegmentIdPair> restoredReplicas;
+
     /// The uniform size of each segment this backup deals with.
     const uint32_t segmentSize;
 
@@ -25,6 +25,7 @@
 #include "Key.h"
 #include "ServerListBuilder.h"
 #include "MultiFileStorage.h"
+#include "ReedSolomon.h"
 #include "ShortMacros.h"
 #include "StringUtil.h"
 #include "TabletsBuilder.h"
@@ -265,6 +266,27 @@ TEST_F(BackupServiceTest, freeSegment_underRecovery) {
     EXPECT_EQ(totalFrames - 1, storage->freeMap.count());
 }
 
+TEST_F(BackupServiceTest, getFragment) {
+    SegmentCertificate certificate;
+    certificate.segmentLength = 10;
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 0, &certificate, 1, 2,
+                     1, false, "fragm", 5).wait();
+
+    Buffer response;
+    SegmentCertificate returned;
+    GetFragmentRpc rpc(&context, backupId, {99, 0}, 88, &response);
+    EXPECT_EQ(1u, rpc.wait(&returned));
+    EXPECT_EQ(10u, returned.segmentLength);
+    EXPECT_EQ(5u, response.size());
+    EXPECT_EQ("fragm", string(response.getStart<char>(), 5));
+
+    openSegment({99, 0}, 89);
+    GetFragmentRpc replicaRpc(&context, backupId, {99, 0}, 89, &response);
+    EXPECT_THROW(replicaRpc.wait(&returned), BackupBadSegmentIdException);
+    GetFragmentRpc missingRpc(&context, backupId, {99, 0}, 90, &response);
+    EXPECT_THROW(missingRpc.wait(&returned), BackupBadSegmentIdException);
+}
+
 TEST_F(BackupServiceTest, getRecoveryData) {
     openSegment({99, 0}, 88);
     closeSegment({99, 0}, 88);
@@ -294,6 +316,31 @@ TEST_F(BackupServiceTest, getRecoveryData) {
                 BackupBadSegmentIdException);
 }
 
+TEST_F(BackupServiceTest, getWriteTarget) {
+    uint32_t key = 1;
+    openSegment({99, 0}, 88);
+    // InMemoryStorage that wasn't registered can't be written remotely.
+    EXPECT_EQ(0u,
+              GetWriteTargetRpc(&context, backupId, {99, 0}, 88).wait(&key));
+    EXPECT_EQ(0u, key);
+
+    cluster->transport.remoteWrites = true;
+    config.backup.remoteWrites = true;
+    Server* other = cluster->addServer(config);
+    other->backup->testingSkipCallerIdCheck = true;
+    // The replica isn't open there.
+    EXPECT_EQ(0u, GetWriteTargetRpc(&context, other->serverId,
+                                    {99, 0}, 88).wait(&key));
+    backupId = other->serverId;
+    openSegment({99, 0}, 88);
+    uint64_t address =
+        GetWriteTargetRpc(&context, backupId, {99, 0}, 88).wait(&key);
+    BackupStorage::FrameRef frame =
+        other->backup->frames.find({{99, 0}, 88})->second;
+    EXPECT_EQ(frame->getRemoteWriteBuffer(), reinterpret_cast<void*>(address));
+    EXPECT_NE(0u, key);
+}
+
 TEST_F(BackupServiceTest, restartFromStorage)
 {
     ServerConfig config = ServerConfig::forTesting();
@@ -400,6 +447,114 @@ TEST_F(BackupServiceTest, restartFromStorage)
     unlink(config.backup.file.c_str());
 }
 
+TEST_F(BackupServiceTest, restartFromStorage_restoredReplicas) {
+    ServerConfig config = ServerConfig::forTesting();
+    config.backup.inMemory = false;
+    config.segmentSize = 4096;
+    config.backup.numSegmentFrames = 4;
+    config.backup.file = "/tmp/ramcloud-backup-service-test-delete-this";
+    config.services = {BACKUP_SERVICE};
+    config.clusterName = "testing";
+
+    server = cluster->addServer(config);
+    backup = server->backup.get();
+    MultiFileStorage* storage =
+        static_cast<MultiFileStorage*>(backup->storage.get());
+
+    Buffer empty;
+    SegmentCertificate certificate;
+    Tub<BackupReplicaMetadata> metadata;
+    // Closed primary, open primary, closed secondary, closed primary.
+    uint64_t segmentIds[] = {88, 89, 90, 91};
+    bool closed[] = {true, false, true, true};
+    bool primary[] = {true, true, false, true};
+    for (int i = 0; i < 4; ++i) {
+        metadata.construct(certificate, 70, segmentIds[i], config.segmentSize,
+                           0, closed[i], primary[i]);
+        BackupStorage::FrameRef frame = storage->open(true, ServerId(), 0);
+        frame->append(empty, 0, 0, 0, &metadata, sizeof(metadata));
+    }
+
+    backup->restartFromStorage();
+    ASSERT_EQ(2lu, backup->restoredReplicas.size());
+    EXPECT_EQ(88lu, backup->restoredReplicas[0].segmentId);
+    EXPECT_EQ(91lu, backup->restoredReplicas[1].segmentId);
+
+    unlink(config.backup.file.c_str());
+}
+
+TEST_F(BackupServiceTest, restartFromStorage_fragments) {
+    ServerConfig config = ServerConfig::forTesting();
+    config.backup.inMemory = false;
+    config.backup.sync = true;
+    config.segmentSize = 4096;
+    config.backup.numSegmentFrames = 4;
+    config.backup.file = "/tmp/ramcloud-backup-service-test-delete-this";
+    config.services = {BACKUP_SERVICE};
+    config.clusterName = "testing";
+
+    server = cluster->addServer(config);
+    backup = server->backup.get();
+    backup->testingSkipCallerIdCheck = true;
+    backupId = server->serverId;
+    MultiFileStorage* storage =
+        static_cast<MultiFileStorage*>(backup->storage.get());
+
+    SegmentCertificate certificate;
+    certificate.segmentLength = 10;
+    WriteFragmentRpc(&context, backupId, {70, 0}, 88, 0, &certificate, 0, 2,
+                     1, true, "first", 5).wait();
+    WriteFragmentRpc(&context, backupId, {70, 0}, 89, 0, &certificate, 2, 2,
+                     1, false, "third", 5).wait();
+    openSegment({70, 0}, 90);
+
+    // Forget everything, as if the backup had just started.
+    backup->frames.clear();
+    backup->fragmentStore.construct(storage, config.segmentSize);
+    TestLog::Enable _("restartFromStorage", NULL);
+    backup->restartFromStorage();
+
+    EXPECT_TRUE(StringUtil::contains(TestLog::get(),
+        "restartFromStorage: Found stored fragment of <70.0,88> "
+        "on backup storage in frame which was closed"));
+    EXPECT_TRUE(StringUtil::contains(TestLog::get(),
+        "restartFromStorage: Found stored replica <70.0,90> "
+        "on backup storage in frame which was open"));
+    EXPECT_EQ(3lu, backup->frames.size());
+    BackupStorage::FrameRef frame = backup->frames[{{70, 0}, 89}];
+    const BackupFragmentMetadata* metadata =
+        BackupFragmentMetadata::find(frame->getMetadata());
+    ASSERT_TRUE(metadata != NULL);
+    EXPECT_EQ(2u, metadata->fragmentIndex);
+    EXPECT_EQ("third", string(static_cast<char*>(frame->load()), 5));
+    // Fragments aren't read on a cold start; recoveries rebuild them.
+    EXPECT_EQ(0lu, backup->restoredReplicas.size());
+
+    unlink(config.backup.file.c_str());
+}
+
+TEST_F(BackupServiceTest, loadRestoredReplicas) {
+    openSegment({99, 0}, 88);
+    closeSegment({99, 0}, 88);
+    openSegment({99, 0}, 89);
+    closeSegment({99, 0}, 89);
+    backup->restoredReplicas.push_back({{99, 0}, 88});
+    backup->restoredReplicas.push_back({{99, 0}, 89});
+    // Freed since startup; skipped.
+    backup->restoredReplicas.push_back({{99, 0}, 90});
+
+    TestLog::Enable _("loadRestoredReplicas");
+    BackupClient::startReadingData(&context, backupId, 456lu, {99, 0}, true);
+    EXPECT_EQ("loadRestoredReplicas: Cold start: loading 2 primary replicas "
+              "of 1 crashed masters in storage order", TestLog::get());
+    EXPECT_EQ(0lu, backup->restoredReplicas.size());
+
+    // Only the first cold start request loads anything.
+    TestLog::reset();
+    BackupClient::startReadingData(&context, backupId, 456lu, {99, 0}, true);
+    EXPECT_EQ("", TestLog::get());
+}
+
 TEST_F(BackupServiceTest, startReadingData) {
     openSegment({99, 0}, 88);
     closeSegment({99, 0}, 88);
@@ -447,6 +602,153 @@ TEST_F(BackupServiceTest, startReadingData) {
             , TestLog::get());
 }
 
+TEST_F(BackupServiceTest, writeFragment) {
+    SegmentCertificate certificate;
+    certificate.segmentLength = 10;
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 3, &certificate, 2, 2,
+                     1, true, "parit", 5).wait();
+    auto frameIt = backup->frames.find({{99, 0}, 88});
+    ASSERT_NE(backup->frames.end(), frameIt);
+    BackupStorage::FrameRef frame = frameIt->second;
+    EXPECT_FALSE(frame->currentlyOpen());
+    const BackupFragmentMetadata* metadata =
+        BackupFragmentMetadata::find(frame->getMetadata());
+    ASSERT_TRUE(metadata != NULL);
+    EXPECT_TRUE(metadata->replica.closed);
+    EXPECT_TRUE(metadata->replica.primary);
+    EXPECT_EQ(3u, metadata->replica.segmentEpoch);
+    EXPECT_EQ(2u, metadata->fragmentIndex);
+    EXPECT_EQ(2u, metadata->dataFragments);
+    EXPECT_EQ(1u, metadata->parityFragments);
+    EXPECT_EQ(5u, metadata->length);
+    EXPECT_EQ("parit", string(static_cast<char*>(frame->load()), 5));
+
+    // Retries leave the fragment alone.
+    TestLog::Enable _("writeFragment", NULL);
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 3, &certificate, 2, 2,
+                     1, true, "parit", 5).wait();
+    EXPECT_EQ(frame, backup->frames.find({{99, 0}, 88})->second);
+    EXPECT_EQ("writeFragment: Fragment 2 of <99.0,88> is already stored; "
+              "treating the request as noop", TestLog::get());
+
+    // A fragment encoded from a later version of the segment replaces it.
+    certificate.segmentLength = 8;
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 3, &certificate, 2, 2,
+                     1, true, "newer", 5).wait();
+    frame = backup->frames.find({{99, 0}, 88})->second;
+    EXPECT_EQ(8u, BackupFragmentMetadata::find(frame->getMetadata())->
+                      replica.certificate.segmentLength);
+    EXPECT_EQ("newer", string(static_cast<char*>(frame->load()), 5));
+}
+
+TEST_F(BackupServiceTest, writeFragment_sharesFrames) {
+    auto storage = static_cast<InMemoryStorage*>(backup->storage.get());
+    size_t totalFrames = storage->freeMap.count();
+    SegmentCertificate certificate;
+    certificate.segmentLength = 10;
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 0, &certificate, 0, 2,
+                     1, true, "first", 5).wait();
+    WriteFragmentRpc(&context, backupId, {99, 0}, 89, 0, &certificate, 1, 2,
+                     1, false, "other", 5).wait();
+    EXPECT_EQ(totalFrames - 1, storage->freeMap.count());
+
+    // Each fragment is in a slot of half a segment.
+    BackupStorage::FrameRef first = backup->frames[{{99, 0}, 88}];
+    BackupStorage::FrameRef other = backup->frames[{{99, 0}, 89}];
+    EXPECT_EQ(static_cast<char*>(first->load()) + config.segmentSize / 2,
+              static_cast<char*>(other->load()));
+    EXPECT_EQ("first", string(static_cast<char*>(first->load()), 5));
+    EXPECT_EQ("other", string(static_cast<char*>(other->load()), 5));
+    EXPECT_EQ(1u, BackupFragmentMetadata::find(
+                      other->getMetadata())->fragmentIndex);
+    first.reset();
+    other.reset();
+
+    // The frame goes back to storage once both are freed.
+    BackupClient::freeSegment(&context, backupId, {99, 0}, 88);
+    EXPECT_EQ(totalFrames - 1, storage->freeMap.count());
+    BackupClient::freeSegment(&context, backupId, {99, 0}, 89);
+    EXPECT_EQ(totalFrames, storage->freeMap.count());
+}
+
+TEST_F(BackupServiceTest, writeFragment_fromReplica) {
+    Segment segment;
+    segment.append(LOG_ENTRY_TYPE_OBJ, "abcdefghijklmnopq", 17);
+    SegmentCertificate certificate;
+    uint32_t length = segment.getAppendedLength(&certificate);
+    BackupClient::writeSegment(&context, backupId, {99, 0}, 88, 0, &segment,
+                               0, length, &certificate, true, true, true);
+    std::vector<char> data(length);
+    segment.copyOut(0, data.data(), length);
+    ReedSolomon erasureCode(2, 1);
+    uint32_t fragmentLength = erasureCode.getFragmentLength(length);
+    std::vector<char> fragment(fragmentLength);
+    erasureCode.encodeFragment(data.data(), length, 2, fragment.data());
+
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 0, &certificate, 2, 2,
+                     1, false, fragment.data(), fragmentLength, true).wait();
+    BackupStorage::FrameRef frame = backup->frames[{{99, 0}, 88}];
+    const BackupFragmentMetadata* metadata =
+        BackupFragmentMetadata::find(frame->getMetadata());
+    ASSERT_TRUE(metadata != NULL);
+    EXPECT_EQ(2u, metadata->fragmentIndex);
+    EXPECT_EQ(fragmentLength, metadata->length);
+    EXPECT_EQ(0, memcmp(fragment.data(), frame->load(), fragmentLength));
+}
+
+TEST_F(BackupServiceTest, writeFragment_fromReplicaNoMatch) {
+    Segment segment;
+    segment.append(LOG_ENTRY_TYPE_OBJ, "abcdefghijklmnopq", 17);
+    SegmentCertificate certificate;
+    uint32_t length = segment.getAppendedLength(&certificate);
+    std::vector<char> fragment((length + 1) / 2);
+
+    // No replica.
+    WriteFragmentRpc missingRpc(&context, backupId, {99, 0}, 88, 0,
+                                &certificate, 0, 2, 1, true, fragment.data(),
+                                downCast<uint32_t>(fragment.size()), true);
+    EXPECT_THROW(missingRpc.wait(), BackupBadSegmentIdException);
+
+    // Replica still open.
+    BackupClient::writeSegment(&context, backupId, {99, 0}, 88, 0, &segment,
+                               0, length, &certificate, true, false, true);
+    WriteFragmentRpc openRpc(&context, backupId, {99, 0}, 88, 0,
+                             &certificate, 0, 2, 1, true, fragment.data(),
+                             downCast<uint32_t>(fragment.size()), true);
+    EXPECT_THROW(openRpc.wait(), BackupBadSegmentIdException);
+
+    // Closed replica of another version of the segment.
+    BackupClient::writeSegment(&context, backupId, {99, 0}, 88, 0, &segment,
+                               length, 0, &certificate, false, true, false);
+    SegmentCertificate otherCertificate = certificate;
+    otherCertificate.checksum++;
+    WriteFragmentRpc otherRpc(&context, backupId, {99, 0}, 88, 0,
+                              &otherCertificate, 0, 2, 1, true,
+                              fragment.data(),
+                              downCast<uint32_t>(fragment.size()), true);
+    EXPECT_THROW(otherRpc.wait(), BackupBadSegmentIdException);
+
+    // The fragment computed doesn't match the checksum of the master's.
+    WriteFragmentRpc badRpc(&context, backupId, {99, 0}, 88, 0,
+                            &certificate, 0, 2, 1, true, fragment.data(),
+                            downCast<uint32_t>(fragment.size()), true);
+    EXPECT_THROW(badRpc.wait(), BackupBadSegmentIdException);
+
+    // The replica is left alone each time.
+    BackupStorage::FrameRef frame = backup->frames[{{99, 0}, 88}];
+    EXPECT_TRUE(BackupFragmentMetadata::find(frame->getMetadata()) == NULL);
+    EXPECT_EQ(length, toMetadata(frame->getMetadata())->
+                          certificate.segmentLength);
+}
+
+TEST_F(BackupServiceTest, writeFragment_badIndex) {
+    SegmentCertificate certificate;
+    WriteFragmentRpc rpc(&context, backupId, {99, 0}, 88, 0, &certificate,
+                         3, 2, 1, false, "parit", 5);
+    EXPECT_THROW(rpc.wait(), RequestFormatError);
+    EXPECT_EQ(backup->frames.end(), backup->frames.find({{99, 0}, 88}));
+}
+
 TEST_F(BackupServiceTest, writeSegment) {
     openSegment({99, 0}, 88);
     // test for idempotence
@@ -485,7 +787,7 @@ TEST_F(BackupServiceTest, writeSegment_segmentClosed) {
     closeSegment(ServerId(99, 0), 88);
     TestLog::reset();
     writeRawString({99, 0}, 88, 10, "test");
-    EXPECT_EQ("writeSegment: Write requested for closed replica <99.0,88>; "
+    EXPECT_EQ("writeReplica: Write requested for closed replica <99.0,88>; "
             "treating the request as noop", TestLog::get());
 }
 
@@ -574,6 +876,224 @@ TEST_F(BackupServiceTest, writeSegment_openSegmentOutOfStorage) {
         BackupOpenRejectedException);
 }
 
+TEST_F(BackupServiceTest, writeSegment_remotelyWritten) {
+    Segment segment;
+    segment.copyIn(10, "test", 5);
+    SegmentCertificate certificate;
+    openSegment({99, 0}, 88);
+    WriteSegmentRpc notRegistered(&context, backupId, {99, 0}, 88, 0,
+                                  &segment, 10, 5, &certificate, false,
+                                  false, true, NULL, NULL, true);
+    EXPECT_THROW(notRegistered.wait(), BackupBadSegmentIdException);
+
+    cluster->transport.remoteWrites = true;
+    config.backup.remoteWrites = true;
+    Server* other = cluster->addServer(config);
+    other->backup->testingSkipCallerIdCheck = true;
+    backupId = other->serverId;
+    openSegment({99, 0}, 88);
+    uint32_t key;
+    uint64_t address =
+        GetWriteTargetRpc(&context, backupId, {99, 0}, 88).wait(&key);
+    Buffer data;
+    segment.appendToBuffer(data, 10, 5);
+    EXPECT_TRUE(context.serverList->getSession(backupId)->writeRemote(
+            address + 10, key, &data, 0, 5));
+    WriteSegmentRpc rpc(&context, backupId, {99, 0}, 88, 0, &segment, 10, 5,
+                        &certificate, false, false, true, NULL, NULL, true);
+    // Only the header is sent.
+    EXPECT_EQ(sizeof(BackupWrite::Request), rpc.request.size());
+    rpc.wait();
+
+    BackupStorage::FrameRef frame =
+        other->backup->frames.find({{99, 0}, 88})->second;
+    EXPECT_STREQ("test", static_cast<char*>(frame->load()) + 10);
+    EXPECT_TRUE(toMetadata(frame->getMetadata())->primary);
+}
+
+TEST_F(BackupServiceTest, writeSegment_placedByTransport) {
+    config.backup.inMemory = false;
+    config.segmentSize = 4096;
+    config.backup.file = "/tmp/ramcloud-backup-service-test-delete-this";
+    Server* other = cluster->addServer(config);
+    BackupService* diskBackup = other->backup.get();
+    diskBackup->testingSkipCallerIdCheck = true;
+    backupId = other->serverId;
+    openSegment({99, 0}, 88);
+
+    BackupWrite::Request reqHdr;
+    reqHdr.common.opcode = BACKUP_WRITE;
+    reqHdr.common.service = BACKUP_SERVICE;
+    reqHdr.masterId = ServerId(99, 0).getId();
+    reqHdr.segmentId = 88;
+    reqHdr.offset = 10;
+    reqHdr.length = 5;
+    uint32_t requestLength = sizeof32(reqHdr) + 5;
+    uint32_t length = 0;
+    std::shared_ptr<void> pin;
+
+    // Not a write to a replica open here.
+    reqHdr.segmentId = 87;
+    EXPECT_TRUE(NULL == diskBackup->placeRequest(&reqHdr, requestLength,
+                                                 &length, &pin));
+    reqHdr.segmentId = 88;
+    EXPECT_TRUE(NULL == diskBackup->placeRequest(&reqHdr, requestLength + 1,
+                                                 &length, &pin));
+    // In-memory storage doesn't take placed writes.
+    EXPECT_TRUE(NULL == backup->placeRequest(&reqHdr, requestLength,
+                                             &length, &pin));
+
+    char* placed = static_cast<char*>(diskBackup->placeRequest(
+            &reqHdr, requestLength, &length, &pin));
+    BackupStorage::FrameRef frame =
+        diskBackup->frames.find({{99, 0}, 88})->second;
+    EXPECT_EQ(static_cast<char*>(frame->getReceiveBuffer()) + 10, placed);
+    EXPECT_EQ(5u, length);
+    EXPECT_EQ(frame.get(), pin.get());
+
+    // The transport receives the data into place.
+    memcpy(placed, "test", 5);
+    Buffer payload;
+    payload.appendCopy(&reqHdr);
+    payload.appendExternal(placed, 5);
+    BackupWriteBatch::Part part = {88, 0, 10, 5, false, false, true,
+                                   false, SegmentCertificate()};
+    uint64_t placedBytes = metrics->backup.writePlacedBytes;
+    diskBackup->writeReplica({99, 0}, part, payload, sizeof32(reqHdr));
+    EXPECT_EQ(placedBytes + 5, metrics->backup.writePlacedBytes);
+    EXPECT_STREQ("test", static_cast<char*>(frame->load()) + 10);
+
+    pin.reset();
+    frame.reset();
+    unlink(config.backup.file.c_str());
+}
+
+TEST_F(BackupServiceTest, writeSegmentBatch) {
+    openSegment({99, 0}, 88);
+    Segment segment;
+    segment.copyIn(10, "test", 5);
+    SegmentCertificate certificate;
+    WriteSegmentBatchRpc rpc(&context, backupId, {99, 0});
+    rpc.appendSegment(88, 0, &segment, 10, 5, &certificate,
+                      false, false, true);
+    rpc.appendSegment(77, 0, &segment, 10, 5, &certificate,
+                      false, false, true); // not open
+    rpc.appendSegment(89, 0, NULL, 0, 0, NULL, true, false, false);
+    rpc.send();
+
+    rpc.wait(0);
+    EXPECT_THROW(rpc.wait(1), BackupBadSegmentIdException);
+    rpc.wait(2);
+    auto frameIt = backup->frames.find({{99, 0}, 88});
+    EXPECT_STREQ("test",
+                 static_cast<char*>(frameIt->second->load()) + 10);
+    EXPECT_NE(backup->frames.end(), backup->frames.find({{99, 0}, 89}));
+}
+
+TEST_F(BackupServiceTest, writeSegmentBatch_checkCallerId) {
+    backup->testingSkipCallerIdCheck = false;
+    WriteSegmentBatchRpc rpc(&context, backupId, {99, 0});
+    rpc.appendSegment(89, 0, NULL, 0, 0, NULL, true, false, false);
+    rpc.send();
+    EXPECT_THROW(rpc.wait(0), CallerNotInClusterException);
+}
+
+TEST_F(BackupServiceTest, writeSegmentFromReplicas) {
+    Segment source;
+    source.append(LOG_ENTRY_TYPE_OBJ, "copied entry", 13);
+    SegmentCertificate certificate;
+    uint32_t sourceLength = source.getAppendedLength(&certificate);
+    BackupClient::writeSegment(&context, backupId, {99, 0}, 88, 0, &source,
+                               0, sourceLength, &certificate,
+                               true, true, false);
+
+    Segment survivor;
+    survivor.copyIn(0, "head", 5);
+    survivor.copyIn(5 + sourceLength, "tail", 5);
+    std::vector<BackupWriteFromReplicas::Piece> pieces = {
+        {0, 0, 5}, {88, 0, sourceLength}, {0, 0, 5}
+    };
+    WriteSegmentRpc rpc(&context, backupId, {99, 0}, 89, 0, &survivor, 0,
+                        sourceLength + 10, NULL, true, true, false, &pieces);
+    rpc.wait();
+
+    auto frameIt = backup->frames.find({{99, 0}, 89});
+    ASSERT_NE(backup->frames.end(), frameIt);
+    const char* replica = static_cast<char*>(frameIt->second->load());
+    EXPECT_STREQ("head", replica);
+    char expected[sourceLength];
+    source.copyOut(0, expected, sourceLength);
+    EXPECT_EQ(0, memcmp(expected, replica + 5, sourceLength));
+    EXPECT_STREQ("tail", replica + 5 + sourceLength);
+}
+
+TEST_F(BackupServiceTest, writeSegmentFromReplicas_sourceNotClosed) {
+    openSegment({99, 0}, 88);
+    Segment survivor;
+    std::vector<BackupWriteFromReplicas::Piece> pieces = {{88, 0, 5}};
+    WriteSegmentRpc rpc(&context, backupId, {99, 0}, 89, 0, &survivor, 0,
+                        5, NULL, true, true, false, &pieces);
+    EXPECT_THROW(rpc.wait(), BackupBadSegmentIdException);
+    // Nothing was written, so the master can just send the data instead.
+    EXPECT_EQ(backup->frames.end(), backup->frames.find({{99, 0}, 89}));
+}
+
+TEST_F(BackupServiceTest, writeSegmentFromReplicas_sourceIsFragment) {
+    SegmentCertificate certificate;
+    certificate.segmentLength = 10;
+    WriteFragmentRpc(&context, backupId, {99, 0}, 88, 0, &certificate, 0, 2,
+                     1, false, "fragm", 5).wait();
+    Segment survivor;
+    std::vector<BackupWriteFromReplicas::Piece> pieces = {{88, 0, 5}};
+    WriteSegmentRpc rpc(&context, backupId, {99, 0}, 89, 0, &survivor, 0,
+                        5, NULL, true, true, false, &pieces);
+    EXPECT_THROW(rpc.wait(), BackupBadSegmentIdException);
+}
+
+TEST_F(BackupServiceTest, writeSegmentFromReplicas_badLength) {
+    Segment survivor;
+    std::vector<BackupWriteFromReplicas::Piece> pieces = {{0, 0, 5}};
+    WriteSegmentRpc rpc(&context, backupId, {99, 0}, 89, 0, &survivor, 0,
+                        6, NULL, true, true, false, &pieces);
+    EXPECT_THROW(rpc.wait(), RequestFormatError);
+}
+
+TEST_F(BackupServiceTest, writeSegmentChain) {
+    Server* other = cluster->addServer(config);
+    other->backup->testingSkipCallerIdCheck = true;
+    Segment segment;
+    segment.copyIn(10, "test", 5);
+    SegmentCertificate certificate;
+    std::vector<ServerId> forwardTo = {other->serverId, {98, 0}};
+    WriteSegmentRpc rpc(&context, backupId, {99, 0}, 88, 0, &segment, 10, 5,
+                        &certificate, true, false, true, NULL, &forwardTo);
+    uint32_t forwardedMask;
+    rpc.wait(&forwardedMask);
+    // The write couldn't be passed on to the backup that doesn't exist.
+    EXPECT_EQ(1u, forwardedMask);
+
+    auto frameIt = backup->frames.find({{99, 0}, 88});
+    ASSERT_NE(backup->frames.end(), frameIt);
+    EXPECT_STREQ("test", static_cast<char*>(frameIt->second->load()) + 10);
+    EXPECT_TRUE(toMetadata(frameIt->second->getMetadata())->primary);
+    frameIt = other->backup->frames.find({{99, 0}, 88});
+    ASSERT_NE(other->backup->frames.end(), frameIt);
+    EXPECT_STREQ("test", static_cast<char*>(frameIt->second->load()) + 10);
+    EXPECT_FALSE(toMetadata(frameIt->second->getMetadata())->primary);
+}
+
+TEST_F(BackupServiceTest, writeSegmentChain_tooManyForwards) {
+    Buffer request, response;
+    BackupWriteChain::Request* reqHdr =
+        request.emplaceAppend<BackupWriteChain::Request>();
+    reqHdr->masterId = 99;
+    reqHdr->forwardCount = BackupWriteChain::MAX_FORWARDS + 1;
+    Service::Rpc rpc(NULL, &request, &response);
+    EXPECT_THROW(backup->writeSegmentChain(reqHdr,
+                 response.emplaceAppend<BackupWriteChain::Response>(), &rpc),
+                 RequestFormatError);
+}
+
 TEST_F(BackupServiceTest, GarbageCollectDownServerTask) {
     openSegment({99, 0}, 88);
     openSegment({99, 0}, 89);
@@ -584,7 +1104,8 @@ TEST_F(BackupServiceTest, GarbageCollectDownServerTask) {
     EXPECT_NE(backup->frames.end(), backup->frames.find({{99, 1}, 88}));
 
     backup->recoveries[ServerId{99, 0}] =
-        new BackupMasterRecovery(backup->taskQueue, 456, {99, 0}, 0);
+        new BackupMasterRecovery(&context, backup->taskQueue, 456, {99, 0},
+                                 0);
     EXPECT_NE(backup->recoveries.end(), backup->recoveries.find({99, 0}));
 
     typedef BackupService::GarbageCollectDownServerTask Task;
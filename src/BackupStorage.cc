@@ -14,11 +14,46 @@
  */
 
 #include "BackupStorage.h"
+#include "ClientException.h"
 #include "CycleCounter.h"
 #include "ShortMacros.h"
 
 namespace RAMCloud {
 
+// --- BackupStorage::Frame ---
+
+/**
+ * Like append(), except that the data has already been placed in the
+ * buffer returned by getRemoteWriteBuffer() (by a master) or by
+ * getReceiveBuffer() (by a transport), so there is nothing to copy; the
+ * data and metadata are otherwise handled just as append() would.
+ * The default implementation is for storage whose getRemoteWriteBuffer()
+ * and getReceiveBuffer() return NULL, in which case this shouldn't be
+ * called.
+ *
+ * \param length
+ *      Bytes the master wrote to the frame starting at \a destinationOffset.
+ * \param destinationOffset
+ *      Offset into the frame where the master wrote the data.
+ * \param metadata
+ *      See append().
+ * \param metadataLength
+ *      See append().
+ *
+ * \throw BackupBadSegmentIdException
+ *      If this storage can't be written remotely.
+ */
+void
+BackupStorage::Frame::appendRemotelyWritten(size_t length,
+                                            size_t destinationOffset,
+                                            const void* metadata,
+                                            size_t metadataLength)
+{
+    LOG(ERROR, "Master claims to have written replica data remotely, but "
+        "this storage can't be written remotely");
+    throw BackupBadSegmentIdException(HERE);
+}
+
 // --- BackupStorage ---
 
 BackupStorage::BackupStorage(size_t segmentSize,
@@ -30,6 +65,22 @@ BackupStorage::BackupStorage(size_t segmentSize,
 {
 }
 
+/**
+ * Report how far storage is behind the data masters are sending to it, so
+ * masters can place new replicas elsewhere and slow down before this backup
+ * has to start rejecting them. The default implementation is for storage
+ * that can't fall behind and always returns 0.
+ *
+ * \return
+ *      Percentage (0-100) of the buffers available to hold replica data
+ *      that hasn't been written to storage yet that are in use.
+ */
+uint32_t
+BackupStorage::getWriteLoad()
+{
+    return 0;
+}
+
 /**
  * Report the read speed of this storage in MB/s.
  *
@@ -260,6 +260,31 @@ class BackupStorage {
                             const void* metadata,
                             size_t metadataLength) = 0;
 
+        /**
+         * Return the memory holding this frame's replica data while it is
+         * open, if that memory was registered with the transports so that
+         * masters may fill it with one-sided RDMA writes (see
+         * Transport::Session::writeRemote); only then may
+         * appendRemotelyWritten() be used. The default is for storage that
+         * doesn't support this and returns NULL.
+         */
+        virtual void* getRemoteWriteBuffer() { return NULL; }
+
+        /**
+         * Return the memory holding this frame's replica data while it is
+         * open and may be appended to, so that transports can receive
+         * replica writes directly into it (see Transport::RequestPlacer);
+         * data found there is then added with appendRemotelyWritten()
+         * rather than copied by append(). The default is for storage that
+         * doesn't support this and returns NULL.
+         */
+        virtual void* getReceiveBuffer() { return NULL; }
+
+        virtual void appendRemotelyWritten(size_t length,
+                                           size_t destinationOffset,
+                                           const void* metadata,
+                                           size_t metadataLength);
+
         /**
          * Mark this frame as closed. Once all data has been flushed to storage
          * in-memory buffers for this frame will be released. For synchronous
@@ -311,6 +336,7 @@ class BackupStorage {
     virtual ~BackupStorage() {}
 
     virtual uint32_t benchmark(BackupStrategy backupStrategy);
+    virtual uint32_t getWriteLoad();
     void sleepToThrottleWrites(size_t count, uint64_t ticks) const;
 
     /**
@@ -442,7 +468,7 @@ class BackupStorage {
     virtual void fry() = 0;
 
     /// See #storageType.
-    enum class Type { UNKNOWN = 0, MEMORY = 1, DISK = 2 };
+    enum class Type { UNKNOWN = 0, MEMORY = 1, DISK = 2, PMEM = 3 };
 
   PROTECTED:
     /**
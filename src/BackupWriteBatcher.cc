@@ -0,0 +1,257 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "BackupWriteBatcher.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Create a BackupWriteBatcher; it does nothing until add() is called.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param taskQueue
+ *      The ReplicaManager's queue; the batcher schedules itself on it to
+ *      send batches after one pass over the pending work.
+ * \param masterId
+ *      Server id of the master whose replicas are written. The pointed-to
+ *      value may change until the master enlists; it is read each time a
+ *      batch is started.
+ * \param writeRpcsInFlight
+ *      ReplicaManager's count of write rpcs in flight; incremented for each
+ *      batch started and decremented when the batch is freed.
+ * \param maxSegmentsPerBatch
+ *      A batch is sent as soon as it holds this many writes.
+ * \param maxBytesPerBatch
+ *      A batch is sent as soon as it holds at least this many bytes of
+ *      replica data.
+ */
+BackupWriteBatcher::BackupWriteBatcher(Context* context,
+                                       TaskQueue& taskQueue,
+                                       const ServerId* masterId,
+                                       uint32_t& writeRpcsInFlight,
+                                       uint32_t maxSegmentsPerBatch,
+                                       uint32_t maxBytesPerBatch)
+    : Task(taskQueue)
+    , context(context)
+    , masterId(masterId)
+    , writeRpcsInFlight(writeRpcsInFlight)
+    , maxSegmentsPerBatch(maxSegmentsPerBatch)
+    , maxBytesPerBatch(maxBytesPerBatch)
+    , pending()
+{
+}
+
+/**
+ * Queue a write to a replica to be sent along with other writes to the same
+ * backup. The write arguments have the same meaning as for WriteSegmentRpc;
+ * the ones not described here are documented there.
+ *
+ * If no batch is being collected for \a backupId a new one is started,
+ * which counts as a new rpc in flight; callers that are throttling rpcs
+ * should check hasRoom() first.
+ *
+ * \param backupId
+ *      Backup the replica is stored on.
+ * \param part
+ *      Set to the identifier of this write within the returned batch, to be
+ *      passed to Batch::wait() and Batch::cancel().
+ * \return
+ *      The batch the write was added to. The caller must hold on to it until
+ *      it has waited for or canceled the write.
+ */
+std::shared_ptr<BackupWriteBatcher::Batch>
+BackupWriteBatcher::add(ServerId backupId,
+                        uint64_t segmentId, uint64_t segmentEpoch,
+                        const Segment* segment, uint32_t offset,
+                        uint32_t length,
+                        const SegmentCertificate* certificate,
+                        bool open, bool close, bool primary,
+                        uint32_t* part)
+{
+    if (!hasRoom(backupId)) {
+        auto it = pending.find(backupId);
+        if (it != pending.end()) {
+            it->second->send();
+            pending.erase(it);
+        }
+        pending[backupId] = std::make_shared<Batch>(context, backupId,
+                                                    *masterId,
+                                                    writeRpcsInFlight);
+        schedule();
+    }
+    std::shared_ptr<Batch> batch = pending[backupId];
+
+    Batch::Part newPart = {
+        segmentId, segmentEpoch, segment, offset, length,
+        certificate != NULL,
+        certificate ? *certificate : SegmentCertificate(),
+        open, close, primary, false, 0
+    };
+    *part = downCast<uint32_t>(batch->parts.size());
+    batch->parts.push_back(newPart);
+    batch->bytes += length;
+
+    if (batch->parts.size() >= maxSegmentsPerBatch ||
+            batch->bytes >= maxBytesPerBatch) {
+        batch->send();
+        pending.erase(backupId);
+    }
+    return batch;
+}
+
+/**
+ * Return true if a write to \a backupId passed to add() would join a batch
+ * that is already counted as in flight, rather than starting a new one.
+ */
+bool
+BackupWriteBatcher::hasRoom(ServerId backupId)
+{
+    auto it = pending.find(backupId);
+    if (it == pending.end())
+        return false;
+    const Batch& batch = *it->second;
+    return batch.parts.size() < maxSegmentsPerBatch &&
+           batch.bytes < maxBytesPerBatch;
+}
+
+/**
+ * Send every batch that is still collecting writes. Runs once the
+ * TaskQueue has made a pass over the work that was scheduled when the
+ * oldest of them was started.
+ */
+void
+BackupWriteBatcher::performTask()
+{
+    foreach (auto& entry, pending)
+        entry.second->send();
+    pending.clear();
+}
+
+// --- BackupWriteBatcher::Batch ---
+
+/**
+ * Start an empty batch; it counts as a write rpc in flight until it is
+ * freed.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param backupId
+ *      Backup every write in the batch is destined for.
+ * \param masterId
+ *      Master the replicas belong to.
+ * \param writeRpcsInFlight
+ *      ReplicaManager's count of write rpcs in flight.
+ */
+BackupWriteBatcher::Batch::Batch(Context* context, ServerId backupId,
+                                 ServerId masterId,
+                                 uint32_t& writeRpcsInFlight)
+    : context(context)
+    , backupId(backupId)
+    , masterId(masterId)
+    , writeRpcsInFlight(writeRpcsInFlight)
+    , parts()
+    , bytes(0)
+    , sent(false)
+    , rpc()
+{
+    ++writeRpcsInFlight;
+}
+
+/**
+ * Cancel the rpc if it is still outstanding and release its rpc slot.
+ */
+BackupWriteBatcher::Batch::~Batch()
+{
+    if (rpc)
+        rpc->cancel();
+    --writeRpcsInFlight;
+}
+
+/**
+ * Return true if the writes in this batch have been sent and the backup's
+ * response (or an error) has arrived, so that wait() won't block.
+ */
+bool
+BackupWriteBatcher::Batch::isReady()
+{
+    if (!sent)
+        return false;
+    return !rpc || rpc->isReady();
+}
+
+/**
+ * Wait for a write in this batch to complete. Throws the same exceptions
+ * WriteSegmentRpc::wait() would for the write if it had been sent alone.
+ *
+ * \param part
+ *      Identifier returned by BackupWriteBatcher::add() for the write.
+ * \return
+ *      The write load the backup reported; see WriteSegmentRpc::wait().
+ */
+uint32_t
+BackupWriteBatcher::Batch::wait(uint32_t part)
+{
+    assert(sent && !parts[part].cancelled);
+    return rpc->wait(parts[part].index);
+}
+
+/**
+ * Indicate that a Replica is no longer interested in the outcome of one of
+ * the writes in this batch. If the batch hasn't been sent yet the write
+ * is dropped from it; otherwise the write still happens (the other writes
+ * in the rpc are unaffected) but its result is ignored. This is safe in
+ * the same way as canceling a WriteSegmentRpc is: see
+ * ReplicatedSegment::free().
+ *
+ * \param part
+ *      Identifier returned by BackupWriteBatcher::add() for the write.
+ */
+void
+BackupWriteBatcher::Batch::cancel(uint32_t part)
+{
+    parts[part].cancelled = true;
+}
+
+/**
+ * Build the rpc from the writes that haven't been canceled and start it.
+ * If every write was canceled nothing is sent.
+ */
+void
+BackupWriteBatcher::Batch::send()
+{
+    assert(!sent);
+    sent = true;
+    foreach (Part& part, parts) {
+        if (part.cancelled)
+            continue;
+        if (!rpc)
+            rpc.construct(context, backupId, masterId);
+        part.index = rpc->getSegmentCount();
+        rpc->appendSegment(part.segmentId, part.segmentEpoch, part.segment,
+                           part.offset, part.length,
+                           part.certificateIncluded ? &part.certificate
+                                                    : NULL,
+                           part.open, part.close, part.primary);
+    }
+    if (rpc) {
+        TEST_LOG("Sending %u writes to backup %s", rpc->getSegmentCount(),
+                 backupId.toString().c_str());
+        rpc->send();
+    }
+}
+
+} // namespace RAMCloud
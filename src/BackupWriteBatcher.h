@@ -0,0 +1,160 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_BACKUPWRITEBATCHER_H
+#define RAMCLOUD_BACKUPWRITEBATCHER_H
+
+#include <memory>
+#include <unordered_map>
+
+#include "Common.h"
+#include "BackupClient.h"
+#include "TaskQueue.h"
+
+namespace RAMCloud {
+
+/**
+ * Combines replica writes that ReplicatedSegments would otherwise send to
+ * the same backup in separate BackupWrite rpcs into one BackupWriteBatch
+ * rpc. This matters when many segments have small writes outstanding at
+ * once (for example, when the cleaner closes a batch of survivor segments
+ * or side logs commit): each rpc has a fixed cost on both the master and the
+ * backup, and every rpc counts against
+ * ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT.
+ *
+ * Writes handed to add() are held in a per-backup batch until either the
+ * batch is full or the ReplicaManager's TaskQueue has made one pass over
+ * the work that was pending when the batch was started (the batcher is
+ * itself a Task in that queue, so it runs after all the segments that were
+ * already scheduled). This bounds the extra latency of a write to one pass
+ * over the replication work, which is time the write would likely have
+ * spent waiting for an rpc slot anyway.
+ *
+ * A batch counts as a single rpc in flight from the time it is started until
+ * the last write in it has been waited for or canceled.
+ *
+ * Like the rest of the replication module, this class relies on the caller
+ * holding ReplicaManager::dataMutex.
+ */
+class BackupWriteBatcher : public Task {
+  PUBLIC:
+    /**
+     * A group of writes to the same backup that travel in one rpc. Each
+     * Replica with a write in the batch holds a reference to it; the batch
+     * is freed when the last of those (and the batcher) let go of it.
+     */
+    class Batch {
+      PUBLIC:
+        Batch(Context* context, ServerId backupId, ServerId masterId,
+              uint32_t& writeRpcsInFlight);
+        ~Batch();
+        bool isReady();
+        uint32_t wait(uint32_t part);
+        void cancel(uint32_t part);
+
+      PRIVATE:
+        void send();
+
+        /// Arguments of one write until the batch is sent.
+        struct Part {
+            uint64_t segmentId;
+            uint64_t segmentEpoch;
+            const Segment* segment;
+            uint32_t offset;
+            uint32_t length;
+            bool certificateIncluded;
+            SegmentCertificate certificate;
+            bool open;
+            bool close;
+            bool primary;
+
+            /// True once the write's Replica has lost interest in it.
+            bool cancelled;
+
+            /// Index of this write in the rpc, once sent.
+            uint32_t index;
+        };
+
+        /// Shared RAMCloud information.
+        Context* context;
+
+        /// Backup every write in the batch is destined for.
+        const ServerId backupId;
+
+        /// Master the replicas belong to.
+        const ServerId masterId;
+
+        /// ReplicaManager's count of write rpcs in flight; see #Batch().
+        uint32_t& writeRpcsInFlight;
+
+        /// Writes in the order they were added.
+        std::vector<Part> parts;
+
+        /// Sum of the lengths of #parts.
+        uint32_t bytes;
+
+        /// True once send() has been called.
+        bool sent;
+
+        /// The rpc carrying the writes that weren't canceled before send().
+        Tub<WriteSegmentBatchRpc> rpc;
+
+        friend class BackupWriteBatcher;
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+    };
+
+    BackupWriteBatcher(Context* context,
+                       TaskQueue& taskQueue,
+                       const ServerId* masterId,
+                       uint32_t& writeRpcsInFlight,
+                       uint32_t maxSegmentsPerBatch,
+                       uint32_t maxBytesPerBatch = 1024 * 1024);
+    ~BackupWriteBatcher() {}
+
+    std::shared_ptr<Batch> add(ServerId backupId,
+                               uint64_t segmentId, uint64_t segmentEpoch,
+                               const Segment* segment, uint32_t offset,
+                               uint32_t length,
+                               const SegmentCertificate* certificate,
+                               bool open, bool close, bool primary,
+                               uint32_t* part);
+    bool hasRoom(ServerId backupId);
+    void performTask();
+
+  PRIVATE:
+    /// Shared RAMCloud information.
+    Context* context;
+
+    /// Id of the master whose replicas are written; set once enlisted.
+    const ServerId* masterId;
+
+    /// ReplicaManager's count of write rpcs in flight to all backups.
+    uint32_t& writeRpcsInFlight;
+
+    /// A batch is sent as soon as it holds this many writes.
+    const uint32_t maxSegmentsPerBatch;
+
+    /// A batch is sent as soon as it holds at least this many bytes.
+    const uint32_t maxBytesPerBatch;
+
+    /// Batches that haven't been sent yet; at most one per backup.
+    std::unordered_map<ServerId, std::shared_ptr<Batch>> pending;
+
+    DISALLOW_COPY_AND_ASSIGN(BackupWriteBatcher);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_BACKUPWRITEBATCHER_H
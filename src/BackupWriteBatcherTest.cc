@@ -0,0 +1,181 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "BackupWriteBatcher.h"
+#include "MockTransport.h"
+#include "Segment.h"
+#include "ServerList.h"
+#include "TransportManager.h"
+
+namespace RAMCloud {
+
+using namespace WireFormat; // NOLINT
+
+struct BackupWriteBatcherTest : public ::testing::Test {
+    Context context;
+    TaskQueue taskQueue;
+    ServerList serverList;
+    MockTransport transport;
+    TransportManager::MockRegistrar mockRegistrar;
+    const ServerId masterId;
+    const ServerId backupId;
+    uint32_t writeRpcsInFlight;
+    Segment segment;
+    BackupWriteBatcher batcher;
+
+    BackupWriteBatcherTest()
+        : context()
+        , taskQueue()
+        , serverList(&context)
+        , transport(&context)
+        , mockRegistrar(&context, transport)
+        , masterId(999, 0)
+        , backupId(1, 0)
+        , writeRpcsInFlight(0)
+        , segment()
+        , batcher(&context, taskQueue, &masterId, writeRpcsInFlight, 3, 100)
+    {
+        serverList.testingAdd({backupId, "mock:host=backup1",
+                               {WireFormat::BACKUP_SERVICE}, 100,
+                               ServerStatus::UP});
+        segment.append(LOG_ENTRY_TYPE_OBJ, "0123456789", 10);
+    }
+
+    /// Add a write of \a length bytes of #segment for \a segmentId.
+    std::shared_ptr<BackupWriteBatcher::Batch>
+    add(uint64_t segmentId, uint32_t length, uint32_t* part)
+    {
+        return batcher.add(backupId, segmentId, 0, &segment, 0, length,
+                           NULL, true, false, true, part);
+    }
+
+    /// Number of writes in the request of the \a index'th rpc sent.
+    uint32_t
+    sentCount(size_t index)
+    {
+        return transport.output.at(index).second.
+                   getStart<BackupWriteBatch::Request>()->count;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BackupWriteBatcherTest);
+};
+
+TEST_F(BackupWriteBatcherTest, add) {
+    uint32_t part0, part1;
+    auto batch0 = add(10, 5, &part0);
+    auto batch1 = add(11, 5, &part1);
+    EXPECT_EQ(batch0, batch1);
+    EXPECT_EQ(0u, part0);
+    EXPECT_EQ(1u, part1);
+    EXPECT_EQ(10u, batch0->bytes);
+    EXPECT_EQ(1u, writeRpcsInFlight);
+    EXPECT_TRUE(batcher.isScheduled());
+    EXPECT_TRUE(transport.output.empty());
+    EXPECT_FALSE(batch0->isReady());
+}
+
+TEST_F(BackupWriteBatcherTest, add_sendWhenFull) {
+    uint32_t part;
+    auto batch = add(10, 1, &part);
+    add(11, 1, &part);
+    EXPECT_TRUE(batcher.hasRoom(backupId));
+    add(12, 1, &part);
+    EXPECT_FALSE(batcher.hasRoom(backupId));
+    ASSERT_EQ(1u, transport.output.size());
+    EXPECT_EQ(3u, sentCount(0));
+
+    // The next write starts a new batch.
+    auto next = add(13, 1, &part);
+    EXPECT_NE(batch, next);
+    EXPECT_EQ(0u, part);
+    EXPECT_EQ(2u, writeRpcsInFlight);
+}
+
+TEST_F(BackupWriteBatcherTest, add_sendWhenEnoughBytes) {
+    BackupWriteBatcher small(&context, taskQueue, &masterId,
+                             writeRpcsInFlight, 3, 8);
+    uint32_t part;
+    auto batch = small.add(backupId, 10, 0, &segment, 0, 10, NULL,
+                           true, false, true, &part);
+    EXPECT_TRUE(batch->sent);
+    EXPECT_EQ(1u, transport.output.size());
+}
+
+TEST_F(BackupWriteBatcherTest, hasRoom) {
+    EXPECT_FALSE(batcher.hasRoom(backupId));
+    uint32_t part;
+    auto batch = add(10, 5, &part);
+    EXPECT_TRUE(batcher.hasRoom(backupId));
+    EXPECT_FALSE(batcher.hasRoom(ServerId(2, 0)));
+}
+
+TEST_F(BackupWriteBatcherTest, performTask) {
+    uint32_t part;
+    auto batch = add(10, 5, &part);
+    batcher.performTask();
+    EXPECT_TRUE(batch->sent);
+    EXPECT_TRUE(batcher.pending.empty());
+    ASSERT_EQ(1u, transport.output.size());
+    EXPECT_EQ(1u, sentCount(0));
+}
+
+TEST_F(BackupWriteBatcherTest, Batch_destructor) {
+    uint32_t part;
+    {
+        auto batch = add(10, 5, &part);
+        batcher.performTask();
+        EXPECT_EQ(1u, writeRpcsInFlight);
+    }
+    EXPECT_EQ(0u, writeRpcsInFlight);
+}
+
+TEST_F(BackupWriteBatcherTest, Batch_wait) {
+    uint32_t part0, part1;
+    transport.setInput("0 40 2 0 12"); // second write rejected
+    auto batch = add(10, 5, &part0);
+    add(11, 5, &part1);
+    batcher.performTask();
+    EXPECT_TRUE(batch->isReady());
+    EXPECT_EQ(40u, batch->wait(part0));
+    EXPECT_THROW(batch->wait(part1), BackupBadSegmentIdException);
+}
+
+TEST_F(BackupWriteBatcherTest, Batch_cancel) {
+    uint32_t part0, part1;
+    transport.setInput("0 0 1 0");
+    auto batch = add(10, 5, &part0);
+    add(11, 5, &part1);
+    batch->cancel(part0);
+    batcher.performTask();
+    ASSERT_EQ(1u, transport.output.size());
+    EXPECT_EQ(1u, sentCount(0));
+    Buffer& request = transport.output[0].second;
+    EXPECT_EQ(11u, request.getOffset<BackupWriteBatch::Part>(
+                       sizeof32(BackupWriteBatch::Request))->segmentId);
+    batch->wait(part1);
+}
+
+TEST_F(BackupWriteBatcherTest, Batch_send_allCancelled) {
+    uint32_t part;
+    auto batch = add(10, 5, &part);
+    batch->cancel(part);
+    batcher.performTask();
+    EXPECT_TRUE(batch->sent);
+    EXPECT_FALSE(batch->rpc);
+    EXPECT_TRUE(transport.output.empty());
+}
+
+}  // namespace RAMCloud
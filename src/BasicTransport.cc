@@ -41,6 +41,11 @@ namespace {
     }
 }
 
+// Defined here because MessageAccumulator's constructor takes them through
+// Tub::construct, which binds them to references.
+const uint8_t BasicTransport::FROM_CLIENT;
+const uint8_t BasicTransport::FROM_SERVER;
+
 /**
  * Construct a new BasicTransport.
  * 
@@ -70,12 +75,20 @@ BasicTransport::BasicTransport(Context* context, const ServiceLocator* locator,
     , serverRpcPool()
     , clientRpcPool()
     , outgoingRpcs()
+    , recentClientRpc(NULL)
     , outgoingRequests()
     , incomingRpcs()
+    , recentServerRpc(NULL)
     , outgoingResponses()
+    , transmittedServerRpcs()
     , serverTimerList()
     , roundTripBytes(getRoundTripBytes(locator))
     , grantIncrement(5*maxDataPerPacket)
+    , highestPriority(driver->getHighestPacketPriority())
+    , highestScheduledPriority(0)
+    , unscheduledCutoffs()
+    , maxGrantedMessages(getOvercommitment(locator))
+    , grantableMessages()
     , timerInterval(0)
     , nextTimeoutCheck(0)
     , timeoutCheckDeadline(0)
@@ -87,6 +100,7 @@ BasicTransport::BasicTransport(Context* context, const ServiceLocator* locator,
     // we don't want those delays to result in RPC timeouts.
     , timeoutIntervals(40)
     , pingIntervals(3)
+    , peerLossStats()
 {
     // Set up the timer to trigger at 2 ms intervals. We use this choice
     // (as of 11/2015) because the Linux kernel appears to buffer packets
@@ -95,12 +109,28 @@ BasicTransport::BasicTransport(Context* context, const ServiceLocator* locator,
     timerInterval = Cycles::fromMicroseconds(2000);
     nextTimeoutCheck = Cycles::rdtsc() + timerInterval;
 
+    // Split the driver's priority levels: the lower half carries scheduled
+    // bytes and the upper half unscheduled bytes. Unscheduled cutoffs grow
+    // geometrically from a single packet, so that single-packet RPCs get
+    // the highest level.
+    if (highestPriority > 0) {
+        highestScheduledPriority = (highestPriority + 1)/2 - 1;
+        uint32_t cutoff = maxDataPerPacket;
+        for (int i = highestPriority; i > highestScheduledPriority + 1; i--) {
+            unscheduledCutoffs.push_back(cutoff);
+            cutoff *= 4;
+        }
+    }
+
     LOG(NOTICE, "BasicTransport parameters: maxDataPerPacket %u, "
             "roundTripBytes %u, grantIncrement %u, pingIntervals %d, "
-            "timeoutIntervals %d, timerInterval %.2f ms",
+            "timeoutIntervals %d, timerInterval %.2f ms, "
+            "highestPriority %d, highestScheduledPriority %d, "
+            "maxGrantedMessages %u",
             maxDataPerPacket, roundTripBytes,
             grantIncrement, pingIntervals, timeoutIntervals,
-            Cycles::toSeconds(timerInterval)*1e3);
+            Cycles::toSeconds(timerInterval)*1e3, highestPriority,
+            highestScheduledPriority, maxGrantedMessages);
 }
 
 /**
@@ -152,6 +182,9 @@ BasicTransport::deleteClientRpc(ClientRpc* clientRpc)
     timeTrace("deleting client RPC, sequence %u",
             downCast<uint32_t>(clientRpc->sequence));
     outgoingRpcs.erase(clientRpc->sequence);
+    if (recentClientRpc == clientRpc) {
+        recentClientRpc = NULL;
+    }
     if (clientRpc->transmitPending) {
         erase(outgoingRequests, *clientRpc);
     }
@@ -175,6 +208,9 @@ BasicTransport::deleteServerRpc(ServerRpc* serverRpc)
     timeTrace("deleting server RPC, sequence %u",
             downCast<uint32_t>(serverRpc->rpcId.sequence));
     incomingRpcs.erase(serverRpc->rpcId);
+    if (recentServerRpc == serverRpc) {
+        recentServerRpc = NULL;
+    }
     if (serverRpc->sendingResponse) {
         erase(outgoingResponses, *serverRpc);
     }
@@ -184,6 +220,60 @@ BasicTransport::deleteServerRpc(ServerRpc* serverRpc)
     serverRpcPool.destroy(serverRpc);
 }
 
+/**
+ * Log the packet loss counters for each peer (see LossStats), then reset
+ * them.
+ */
+void
+BasicTransport::dumpStats()
+{
+    for (auto& entry : peerLossStats) {
+        LossStats& stats = entry.second;
+        LOG(NOTICE, "Packet loss with %s: %lu RESENDs sent after timeouts, "
+                "%lu fast RESENDs sent, %lu retransmissions (%lu bytes)",
+                entry.first.c_str(), stats.resends, stats.fastResends,
+                stats.retransmissions, stats.retransmittedBytes);
+    }
+    peerLossStats.clear();
+}
+
+/**
+ * Return the packet loss counters for a peer, creating them if needed.
+ *
+ * \param peer
+ *      Address of the peer.
+ */
+BasicTransport::LossStats&
+BasicTransport::getLossStats(const Driver::Address* peer)
+{
+    return peerLossStats[peer->toString()];
+}
+
+/**
+ * Parse the "overcommit" option in a service locator, which specifies how
+ * many incoming messages we grant to at once (see maxGrantedMessages).
+ *
+ * \param locator
+ *      Service locator that may contain an "overcommit" option. If NULL,
+ *      or if the option is missing, then a default is supplied.
+ */
+uint32_t
+BasicTransport::getOvercommitment(const ServiceLocator* locator)
+{
+    if ((locator != NULL) && locator->hasOption("overcommit")) {
+        char* end;
+        uint32_t value = downCast<uint32_t>(strtoul(
+                locator->getOption("overcommit").c_str(), &end, 10));
+        if ((*end == 0) && (value != 0)) {
+            return value;
+        }
+        LOG(ERROR, "Bad BasicTransport overcommit option value '%s' "
+                "(expected positive integer); ignoring option",
+                locator->getOption("overcommit").c_str());
+    }
+    return 8;
+}
+
 /**
  * Parse option values in a service locator to determine how many bytes
  * of data must be sent to cover the round-trip latency of a connection.
@@ -241,6 +331,26 @@ BasicTransport::getRoundTripBytes(const ServiceLocator* locator)
     return roundTripBytes;
 }
 
+/**
+ * Returns the priority level at which the unscheduled bytes of a message
+ * should be sent (shorter messages get higher levels).
+ *
+ * \param messageSize
+ *      Total length of the message, in bytes.
+ */
+int
+BasicTransport::getUnscheduledPriority(uint32_t messageSize)
+{
+    int priority = highestPriority;
+    foreach (uint32_t cutoff, unscheduledCutoffs) {
+        if (messageSize <= cutoff) {
+            return priority;
+        }
+        priority--;
+    }
+    return priority;
+}
+
 /**
  * Return a printable symbol for the opcode field from a packet.
  * \param opcode
@@ -295,6 +405,10 @@ BasicTransport::opcodeSymbol(uint8_t opcode) {
  *      Normally, a partial packet will get sent only if it's the last
  *      packet in the message. However, if this parameter is true then
  *      partial packets will be sent anywhere in the message.
+ * \param scheduledPriority
+ *      Priority level for bytes beyond the first roundTripBytes of the
+ *      message, as specified by the receiver in its latest GRANT. Earlier
+ *      bytes use getUnscheduledPriority.
  * \return
  *      The number of bytes of data actually transmitted (may be 0 in
  *      some situations).
@@ -302,12 +416,18 @@ BasicTransport::opcodeSymbol(uint8_t opcode) {
 uint32_t
 BasicTransport::sendBytes(const Driver::Address* address, RpcId rpcId,
         Buffer* message, uint32_t offset, uint32_t maxBytes,
-        uint8_t flags, bool partialOK)
+        uint8_t flags, bool partialOK, int scheduledPriority)
 {
     uint32_t messageSize = message->size();
+    int unscheduledPriority = getUnscheduledPriority(messageSize);
 
     uint32_t curOffset = offset;
     uint32_t bytesSent = 0;
+
+    // Let the driver hand all of the packets to the NIC (or kernel) at
+    // once. The batch must be flushed before returning: the caller may
+    // delete the message right afterwards.
+    driver->startBatch();
     while ((curOffset < messageSize) && (bytesSent < maxBytes)) {
         // Don't send less-than-full-size packets except for the last packet
         // of the message (unless the caller explicitly requested it).
@@ -319,19 +439,22 @@ BasicTransport::sendBytes(const Driver::Address* address, RpcId rpcId,
             }
             bytesThisPacket = maxBytes - bytesSent;
         }
+        int priority = (curOffset < roundTripBytes) ? unscheduledPriority
+                : scheduledPriority;
         if (bytesThisPacket == messageSize) {
             // Entire message fits in a single packet.
             AllDataHeader header(rpcId, flags, downCast<uint16_t>(messageSize));
             Buffer::Iterator iter(message, 0, messageSize);
-            driver->sendPacket(address, &header, &iter);
+            driver->sendPacket(address, &header, &iter, priority);
         } else {
             DataHeader header(rpcId, message->size(), curOffset, flags);
             Buffer::Iterator iter(message, curOffset, bytesThisPacket);
-            driver->sendPacket(address, &header, &iter);
+            driver->sendPacket(address, &header, &iter, priority);
         }
         bytesSent += bytesThisPacket;
         curOffset += bytesThisPacket;
     }
+    driver->flushBatch();
 
     timeTrace("sent data, sequence %u, offset %u, length %u",
             downCast<uint32_t>(rpcId.sequence), offset, bytesSent);
@@ -395,7 +518,8 @@ BasicTransport::headerToString(const void* packet, uint32_t packetLength)
             }
             const BasicTransport::GrantHeader* grant =
                     static_cast<const BasicTransport::GrantHeader*>(packet);
-            result += format(", offset %u", grant->offset);
+            result += format(", offset %u, priority %u", grant->offset,
+                    grant->priority);
             break;
         }
         case BasicTransport::PacketOpcode::LOG_TIME_TRACE:
@@ -412,10 +536,12 @@ BasicTransport::headerToString(const void* packet, uint32_t packetLength)
             const BasicTransport::ResendHeader* resend =
                     static_cast<const BasicTransport::ResendHeader*>(
                     packet);
-            result += format(", offset %u, length %u%s",
+            result += format(", offset %u, length %u%s%s",
                     resend->offset, resend->length,
                     common->flags & BasicTransport::RESTART
-                            ? ", RESTART" : "");
+                            ? ", RESTART" : "",
+                    common->flags & BasicTransport::FAST_RESEND
+                            ? ", FAST_RESEND" : "");
             break;
         }
         case BasicTransport::PacketOpcode::ACK:
@@ -459,6 +585,10 @@ BasicTransport::tryToTransmitData()
             driver->getTransmitQueueSpace(context->dispatch->currentTime)));
     uint32_t maxBytes;
 
+    // Hand all of the packets from this call to the driver as one batch,
+    // so it can pass them to the NIC together.
+    driver->startBatch();
+
     // Each iteration of the following loop transmits data packets for
     // a single request or response.
     while (transmitQueueSpace >= maxDataPerPacket) {
@@ -506,6 +636,10 @@ BasicTransport::tryToTransmitData()
                 // Can't transmit this message: waiting for grants.
                 continue;
             }
+            if (rpc->transmitOffset >= rpc->replyPayload.size()) {
+                // Fully transmitted; in transmittedServerRpcs.
+                continue;
+            }
             if ((rpc->replyPayload.size() < 10000)
                     ? (rpc->replyPayload.size() < minLength)
                     : ((minLength >= 10000)
@@ -527,7 +661,8 @@ BasicTransport::tryToTransmitData()
                     clientRpc->session->serverAddress,
                     RpcId(clientId, clientRpc->sequence),
                     clientRpc->request, clientRpc->transmitOffset,
-                    maxBytes, FROM_CLIENT|clientRpc->needGrantFlag);
+                    maxBytes, FROM_CLIENT|clientRpc->needGrantFlag, false,
+                    clientRpc->scheduledPriority);
             assert(bytesSent > 0);     // Otherwise, infinite loop.
             clientRpc->transmitOffset += bytesSent;
             clientRpc->lastTransmitTime = Cycles::rdtsc();
@@ -545,7 +680,8 @@ BasicTransport::tryToTransmitData()
             int bytesSent = sendBytes(serverRpc->clientAddress,
                     serverRpc->rpcId, &serverRpc->replyPayload,
                     serverRpc->transmitOffset, maxBytes,
-                    FROM_SERVER|serverRpc->needGrantFlag);
+                    FROM_SERVER|serverRpc->needGrantFlag, false,
+                    serverRpc->scheduledPriority);
             assert(bytesSent > 0);     // Otherwise, infinite loop.
             serverRpc->transmitOffset += bytesSent;
             serverRpc->lastTransmitTime = Cycles::rdtsc();
@@ -556,17 +692,105 @@ BasicTransport::tryToTransmitData()
                 // this data is lost we won't be able to retransmit it (the
                 // whole RPC will be retried). However, this approach is
                 // simpler and faster in the common case where data isn't lost.
-                deleteServerRpc(serverRpc);
+                // The deletion waits until the batch has been flushed.
+                transmittedServerRpcs.push_back(serverRpc);
             }
         } else {
             // There are no messages with data that can be transmitted.
             break;
         }
     }
+    driver->flushBatch();
+    foreach (ServerRpc* serverRpc, transmittedServerRpcs)
+        deleteServerRpc(serverRpc);
+    transmittedServerRpcs.clear();
 
     return result;
 }
 
+/**
+ * This method is invoked when a DATA packet that asks for GRANTs arrives
+ * for a partially received message. It updates the message's position in
+ * grantableMessages, then sends any GRANTs that are now needed.
+ *
+ * \param message
+ *      The message that the packet belongs to.
+ * \param totalLength
+ *      Total length of the message, from the packet.
+ */
+void
+BasicTransport::updateGrants(MessageAccumulator* message,
+        uint32_t totalLength)
+{
+    if (message->grantLinks.is_linked()) {
+        erase(grantableMessages, *message);
+    } else if (message->totalLength != 0) {
+        // We have already granted the entire message.
+        return;
+    }
+    message->totalLength = totalLength;
+
+    // Note: this is a linear scan, like the one in tryToTransmitData;
+    // the list holds only messages that are waiting for GRANTs.
+    uint32_t remaining = message->bytesRemaining();
+    GrantableMessageList::iterator it = grantableMessages.begin();
+    while ((it != grantableMessages.end())
+            && (it->bytesRemaining() <= remaining)) {
+        it++;
+    }
+    grantableMessages.insert(it, *message);
+    sendGrants();
+}
+
+/**
+ * This method implements the receiver side of message scheduling. The
+ * first maxGrantedMessages messages in grantableMessages (those with the
+ * fewest bytes remaining) are kept granted at least roundTripBytes beyond
+ * the data received so far; the rest get no GRANTs until messages ahead
+ * of them finish. Each GRANT also carries a priority based on the
+ * message's rank, so that the network itself favors the shortest ones.
+ */
+void
+BasicTransport::sendGrants()
+{
+    int priority = highestScheduledPriority;
+    uint32_t numGranted = 0;
+    for (GrantableMessageList::iterator it = grantableMessages.begin();
+            (it != grantableMessages.end())
+            && (numGranted < maxGrantedMessages); numGranted++) {
+        MessageAccumulator* message = &(*it);
+
+        // Advance the iterator now, so it won't get invalidated if we
+        // remove the message below.
+        it++;
+
+        uint32_t received = message->buffer->size();
+        bool needOffset = message->grantOffset < (received + roundTripBytes);
+        if (needOffset || (message->grantPriority != priority)) {
+            if (needOffset) {
+                message->grantOffset = received + roundTripBytes
+                        + grantIncrement;
+            }
+            message->grantPriority = priority;
+            timeTrace("sending GRANT, sequence %u, offset %u, priority %u",
+                    downCast<uint32_t>(message->rpcId.sequence),
+                    message->grantOffset, downCast<uint32_t>(priority));
+            GrantHeader grant(message->rpcId, message->grantOffset,
+                    downCast<uint8_t>(priority), message->whoFrom);
+            driver->sendPacket(message->sender, &grant, NULL,
+                    highestPriority);
+        }
+        if (message->grantOffset >= message->totalLength) {
+            // The sender can now transmit the rest of the message on its
+            // own.
+            erase(grantableMessages, *message);
+        }
+        if (priority > 0) {
+            priority--;
+        }
+    }
+}
+
 /**
  * Construct a new client session.
  *
@@ -705,29 +929,34 @@ BasicTransport::handlePacket(Driver::Received* received)
     if (!(common->flags & FROM_CLIENT)) {
         // This packet was sent by the server, and it pertains to an RPC
         // for which we are the client.
-        ClientRpcMap::iterator it = outgoingRpcs.find(
-                common->rpcId.sequence);
-        if (it == outgoingRpcs.end()) {
-            // We have no record of this RPC; most likely this packet
-            // pertains to an earlier RPC that we've already finished
-            // with (e.g., we might have sent a RESEND just before the
-            // server since the response). Discard the packet.
-            if (common->opcode == LOG_TIME_TRACE) {
-                // For LOG_TIME_TRACE requests, dump the trace anyway.
-                LOG(NOTICE, "Client received LOG_TIME_TRACE request from "
-                        "server %s for (unknown) sequence %lu",
-                        received->sender->toString().c_str(),
+        ClientRpc* clientRpc = recentClientRpc;
+        if ((clientRpc == NULL)
+                || (clientRpc->sequence != common->rpcId.sequence)) {
+            ClientRpcMap::iterator it = outgoingRpcs.find(
+                    common->rpcId.sequence);
+            if (it == outgoingRpcs.end()) {
+                // We have no record of this RPC; most likely this packet
+                // pertains to an earlier RPC that we've already finished
+                // with (e.g., we might have sent a RESEND just before the
+                // server since the response). Discard the packet.
+                if (common->opcode == LOG_TIME_TRACE) {
+                    // For LOG_TIME_TRACE requests, dump the trace anyway.
+                    LOG(NOTICE, "Client received LOG_TIME_TRACE request from "
+                            "server %s for (unknown) sequence %lu",
+                            received->sender->toString().c_str(),
+                            common->rpcId.sequence);
+                    TimeTrace::record(
+                            "client received LOG_TIME_TRACE for sequence %u",
+                            downCast<uint32_t>(common->rpcId.sequence));
+                    TimeTrace::printToLogBackground(context->dispatch);
+                }
+                TEST_LOG("Discarding unknown packet, sequence %lu",
                         common->rpcId.sequence);
-                TimeTrace::record(
-                        "client received LOG_TIME_TRACE for sequence %u",
-                        downCast<uint32_t>(common->rpcId.sequence));
-                TimeTrace::printToLogBackground(context->dispatch);
+                return;
             }
-            TEST_LOG("Discarding unknown packet, sequence %lu",
-                    common->rpcId.sequence);
-            return;
+            clientRpc = it->second;
+            recentClientRpc = clientRpc;
         }
-        ClientRpc* clientRpc = it->second;
         clientRpc->silentIntervals = 0;
         switch (common->opcode) {
             // ALL_DATA from server
@@ -771,7 +1000,9 @@ BasicTransport::handlePacket(Driver::Received* received)
                         downCast<uint32_t>(header->common.rpcId.sequence),
                         header->offset, received->len, header->common.flags);
                 if (!clientRpc->accumulator) {
-                    clientRpc->accumulator.construct(this, clientRpc->response);
+                    clientRpc->accumulator.construct(this, clientRpc->response,
+                            clientRpc->session->serverAddress,
+                            header->common.rpcId, FROM_CLIENT);
                 }
                 retainPacket = clientRpc->accumulator->addPacket(header,
                         received->len);
@@ -787,24 +1018,12 @@ BasicTransport::handlePacket(Driver::Received* received)
                     }
                     clientRpc->notifier->completed();
                     deleteClientRpc(clientRpc);
-                } else {
-                    // See if we need to output a GRANT.
-                    if ((header->common.flags & NEED_GRANT) &&
-                            (clientRpc->grantOffset <
-                            (clientRpc->response->size() + roundTripBytes)) &&
-                            (clientRpc->grantOffset < header->totalLength)) {
-                        clientRpc->grantOffset = clientRpc->response->size()
-                                + roundTripBytes + grantIncrement;
-                        timeTrace(
-                                "client sending GRANT, sequence %u, offset %u",
-                                downCast<uint32_t>(
-                                header->common.rpcId.sequence),
-                                clientRpc->grantOffset);
-                        GrantHeader grant(header->common.rpcId,
-                                clientRpc->grantOffset, FROM_CLIENT);
-                        driver->sendPacket(clientRpc->session->serverAddress,
-                                &grant, NULL);
-                    }
+
+                    // Another message may now be eligible for GRANTs.
+                    sendGrants();
+                } else if (header->common.flags & NEED_GRANT) {
+                    updateGrants(clientRpc->accumulator.get(),
+                            header->totalLength);
                 }
                 if (retainPacket) {
                     uint32_t dummy;
@@ -824,6 +1043,7 @@ BasicTransport::handlePacket(Driver::Received* received)
                 if (header->offset > clientRpc->transmitLimit) {
                     clientRpc->transmitLimit = header->offset;
                 }
+                clientRpc->scheduledPriority = header->priority;
                 return;
             }
 
@@ -853,7 +1073,6 @@ BasicTransport::handlePacket(Driver::Received* received)
                     clientRpc->response->reset();
                     clientRpc->transmitOffset = 0;
                     clientRpc->transmitLimit = header->length;
-                    clientRpc->grantOffset = 0;
                     clientRpc->resendLimit = 0;
                     clientRpc->accumulator.destroy();
                     if (!clientRpc->transmitPending) {
@@ -868,18 +1087,20 @@ BasicTransport::handlePacket(Driver::Received* received)
                     clientRpc->transmitLimit = resendEnd;
                 }
                 if ((header->offset >= clientRpc->transmitOffset)
-                        || ((Cycles::rdtsc() - clientRpc->lastTransmitTime)
-                        < timerInterval)) {
+                        || (!(header->common.flags & FAST_RESEND)
+                        && ((Cycles::rdtsc() - clientRpc->lastTransmitTime)
+                        < timerInterval))) {
                     // One of two things has happened: either (a) we haven't
                     // yet sent the requested bytes for the first time (there
                     // must be other outgoing traffic with higher priority)
-                    // or (b) we transmitted data recently. In either case,
-                    // it's unlikely that bytes have been lost, so don't
-                    // retransmit; just return an ACK so the server knows
-                    // we're still alive.
+                    // or (b) we transmitted data recently (and the server
+                    // doesn't know for sure that the bytes were lost). In
+                    // either case, it's unlikely that bytes have been lost,
+                    // so don't retransmit; just return an ACK so the server
+                    // knows we're still alive.
                     AckHeader ack(header->common.rpcId, FROM_CLIENT);
                     driver->sendPacket(clientRpc->session->serverAddress,
-                            &ack, NULL);
+                            &ack, NULL, highestPriority);
                     return;
 
                 }
@@ -891,12 +1112,16 @@ BasicTransport::handlePacket(Driver::Received* received)
                         received->sender->toString().c_str(),
                         header->common.rpcId.sequence, header->offset,
                         header->length, elapsedMicros);
-                sendBytes(clientRpc->session->serverAddress,
+                uint32_t bytesSent = sendBytes(
+                        clientRpc->session->serverAddress,
                         header->common.rpcId, clientRpc->request,
                         header->offset, header->length,
                         FROM_CLIENT|RETRANSMISSION|clientRpc->needGrantFlag,
-                        true);
+                        true, clientRpc->scheduledPriority);
                 clientRpc->lastTransmitTime = Cycles::rdtsc();
+                LossStats& stats = getLossStats(received->sender);
+                stats.retransmissions++;
+                stats.retransmittedBytes += bytesSent;
                 return;
             }
 
@@ -921,9 +1146,17 @@ BasicTransport::handlePacket(Driver::Received* received)
 
         // Find the record for this RPC, if one exists.
         ServerRpc* serverRpc = NULL;
-        ServerRpcMap::iterator it = incomingRpcs.find(common->rpcId);
-        if (it != incomingRpcs.end()) {
-            serverRpc = it->second;
+        if ((recentServerRpc != NULL)
+                && (recentServerRpc->rpcId == common->rpcId)) {
+            serverRpc = recentServerRpc;
+        } else {
+            ServerRpcMap::iterator it = incomingRpcs.find(common->rpcId);
+            if (it != incomingRpcs.end()) {
+                serverRpc = it->second;
+            }
+        }
+        if (serverRpc != NULL) {
+            recentServerRpc = serverRpc;
             serverRpc->silentIntervals = 0;
         }
 
@@ -985,8 +1218,11 @@ BasicTransport::handlePacket(Driver::Received* received)
                             header->common.rpcId);
                     nextServerSequenceNumber++;
                     incomingRpcs[header->common.rpcId] = serverRpc;
+                    recentServerRpc = serverRpc;
                     serverRpc->accumulator.construct(this,
-                            &serverRpc->requestPayload);
+                            &serverRpc->requestPayload,
+                            serverRpc->clientAddress, header->common.rpcId,
+                            FROM_SERVER);
                     serverTimerList.push_back(*serverRpc);
                 } else if (serverRpc->requestComplete) {
                     // We've already received the full message, so
@@ -1014,27 +1250,17 @@ BasicTransport::handlePacket(Driver::Received* received)
                     }
                     erase(serverTimerList, *serverRpc);
                     serverRpc->requestComplete = true;
-                    context->workerManager->handleRpc(serverRpc);
-                } else {
-                    // See if we need to output a GRANT.
-                    if ((header->common.flags & NEED_GRANT) &&
-                            (serverRpc->grantOffset <
-                            (serverRpc->requestPayload.size()
-                            + roundTripBytes)) &&
-                            (serverRpc->grantOffset < header->totalLength)) {
-                        serverRpc->grantOffset =
-                                serverRpc->requestPayload.size()
-                                + roundTripBytes + grantIncrement;
-                        timeTrace(
-                                "server sending GRANT, sequence %u, offset %u",
-                                downCast<uint32_t>(
-                                header->common.rpcId.sequence),
-                                serverRpc->grantOffset);
-                        GrantHeader grant(header->common.rpcId,
-                                serverRpc->grantOffset, FROM_SERVER);
-                        driver->sendPacket(serverRpc->clientAddress,
-                                &grant, NULL);
+
+                    // The request no longer needs GRANTs; another message
+                    // may now be eligible for them.
+                    if (serverRpc->accumulator->grantLinks.is_linked()) {
+                        erase(grantableMessages, *serverRpc->accumulator);
                     }
+                    sendGrants();
+                    context->workerManager->handleRpc(serverRpc);
+                } else if (header->common.flags & NEED_GRANT) {
+                    updateGrants(serverRpc->accumulator.get(),
+                            header->totalLength);
                 }
                 serverDataDone:
                 if (retainPacket) {
@@ -1063,6 +1289,7 @@ BasicTransport::handlePacket(Driver::Received* received)
                 if (header->offset > serverRpc->transmitLimit) {
                     serverRpc->transmitLimit = header->offset;
                 }
+                serverRpc->scheduledPriority = header->priority;
                 return;
             }
 
@@ -1098,7 +1325,8 @@ BasicTransport::handlePacket(Driver::Received* received)
                             downCast<uint32_t>(common->rpcId.sequence));
                     ResendHeader resend(header->common.rpcId, 0,
                             roundTripBytes, FROM_SERVER|RESTART);
-                    driver->sendPacket(received->sender, &resend, NULL);
+                    driver->sendPacket(received->sender, &resend, NULL,
+                            highestPriority);
                     return;
                 }
                 uint32_t resendEnd = header->offset + header->length;
@@ -1108,19 +1336,22 @@ BasicTransport::handlePacket(Driver::Received* received)
                 }
                 if (!serverRpc->sendingResponse
                         || (header->offset >= serverRpc->transmitOffset)
-                        || ((Cycles::rdtsc() - serverRpc->lastTransmitTime)
-                        < timerInterval)) {
+                        || (!(header->common.flags & FAST_RESEND)
+                        && ((Cycles::rdtsc() - serverRpc->lastTransmitTime)
+                        < timerInterval))) {
                     // One of two things has happened: either (a) we haven't
                     // yet sent the requested bytes for the first time (there
                     // must be other outgoing traffic with higher priority)
                     // or (b) we transmitted data recently, so it might have
-                    // crossed paths with the RESEND request. In either case,
+                    // crossed paths with the RESEND request (unless it is a
+                    // FAST_RESEND, which is only sent for data known to be
+                    // lost). In either case,
                     // it's unlikely that bytes have been lost, so don't
                     // retransmit; just return an ACK so the client knows
                     // we're still alive.
                     AckHeader ack(serverRpc->rpcId, FROM_SERVER);
                     driver->sendPacket(serverRpc->clientAddress,
-                            &ack, NULL);
+                            &ack, NULL, highestPriority);
                     return;
                 }
                 double elapsedMicros = Cycles::toSeconds(Cycles::rdtsc()
@@ -1131,12 +1362,15 @@ BasicTransport::handlePacket(Driver::Received* received)
                         received->sender->toString().c_str(),
                         header->common.rpcId.sequence, header->offset,
                         header->length, elapsedMicros);
-                sendBytes(serverRpc->clientAddress,
+                uint32_t bytesSent = sendBytes(serverRpc->clientAddress,
                         serverRpc->rpcId, &serverRpc->replyPayload,
                         header->offset, header->length,
                         RETRANSMISSION|FROM_SERVER|serverRpc->needGrantFlag,
-                        true);
+                        true, serverRpc->scheduledPriority);
                 serverRpc->lastTransmitTime = Cycles::rdtsc();
+                LossStats& stats = getLossStats(received->sender);
+                stats.retransmissions++;
+                stats.retransmittedBytes += bytesSent;
                 return;
             }
 
@@ -1207,13 +1441,29 @@ BasicTransport::ServerRpc::sendReply()
  *      The complete message will be assembled here; caller should ensure
  *      that this is initially empty. The caller owns the storage for this
  *      and must ensure that it persists as long as this object persists.
+ * \param sender
+ *      Where the message is coming from (GRANTs and RESENDs go here). The
+ *      caller must ensure that this persists as long as this object.
+ * \param rpcId
+ *      The RPC that the message belongs to.
+ * \param whoFrom
+ *      Must be either FROM_CLIENT, indicating that we are the client, or
+ *      FROM_SERVER, indicating that we are the server.
  */
 BasicTransport::MessageAccumulator::MessageAccumulator(BasicTransport* t,
-        Buffer* buffer)
+        Buffer* buffer, const Driver::Address* sender, RpcId rpcId,
+        uint8_t whoFrom)
     : t(t)
     , buffer(buffer)
     , fragments()
+    , fastResendOffset(0)
     , grantOffset(0)
+    , sender(sender)
+    , rpcId(rpcId)
+    , whoFrom(whoFrom)
+    , totalLength(0)
+    , grantPriority(-1)
+    , grantLinks()
 { }
 
 /**
@@ -1229,6 +1479,9 @@ BasicTransport::MessageAccumulator::~MessageAccumulator()
         t->driver->release(fragment.header);
     }
     fragments.clear();
+    if (grantLinks.is_linked()) {
+        erase(t->grantableMessages, *this);
+    }
 }
 
 /**
@@ -1256,6 +1509,7 @@ BasicTransport::MessageAccumulator::addPacket(DataHeader *header,
         // Can't append this packet into the buffer because some prior
         // data is missing. Save the packet for later.
         fragments[header->offset] = MessageFragment(header, length);
+        requestFastRetransmission();
         return true;
     }
 
@@ -1291,10 +1545,10 @@ BasicTransport::MessageAccumulator::addPacket(DataHeader *header,
  *      Total size of the packet at *header (including header).
  * \return
  *      True means that (some of) the data in this fragment was
- *      incorporated into the message buffer. False means that
- *      the data in this fragment is entirely redundant, so we
- *      didn't save any pointers to it (the caller may want to
- *      free this packet).
+ *      incorporated into the message buffer by reference. False means
+ *      that the data in this fragment is entirely redundant or was
+ *      copied, so we didn't save any pointers to it (the caller may want
+ *      to free this packet).
  */
 bool
 BasicTransport::MessageAccumulator::appendFragment(DataHeader *header,
@@ -1306,16 +1560,59 @@ BasicTransport::MessageAccumulator::appendFragment(DataHeader *header,
         // This entire fragment is redundant.
         return false;
     }
-    Driver::PayloadChunk::appendToBuffer(buffer,
-            reinterpret_cast<char*>(header) + sizeof32(DataHeader)
-            + bytesToSkip, length - bytesToSkip, t->driver,
-            reinterpret_cast<char*>(header));
+    char* data = reinterpret_cast<char*>(header) + sizeof32(DataHeader)
+            + bytesToSkip;
+    if (t->driver->receiveBuffersLow()) {
+        // Normally the packet buffer is kept as part of the message, to
+        // avoid copying. But a large message holds on to many buffers until
+        // the RPC is done with it, so when the driver runs short, copy the
+        // data instead and let the packet go back to the driver right away.
+        buffer->appendCopy(data, length - bytesToSkip);
+        return false;
+    }
+    Driver::PayloadChunk::appendToBuffer(buffer, data, length - bytesToSkip,
+            t->driver, reinterpret_cast<char*>(header));
     return true;
 }
 
 /**
- * This method is invoked to issue a RESEND packet when it appears that
- * packets have been lost. It is used by both servers and clients.
+ * This method is invoked when a packet arrives out of order. If enough
+ * packets have now arrived after a gap in the message that the gap is
+ * unlikely to be mere reordering, it asks the sender to retransmit just
+ * that gap with a FAST_RESEND, rather than waiting for checkTimeouts to
+ * notice the silence. Only the gap just before the FAST_RESEND_PACKETS'th
+ * packet from the end is considered, so each arriving packet costs
+ * O(log n) regardless of how much of the message is outstanding.
+ */
+void
+BasicTransport::MessageAccumulator::requestFastRetransmission()
+{
+    if (fragments.size() < FAST_RESEND_PACKETS) {
+        return;
+    }
+    FragmentMap::iterator it = std::prev(fragments.end(),
+            FAST_RESEND_PACKETS);
+    uint32_t gapStart = buffer->size();
+    if (it != fragments.begin()) {
+        FragmentMap::iterator previous = std::prev(it);
+        gapStart = previous->first + previous->second.length
+                - sizeof32(DataHeader);
+    }
+    gapStart = std::max(gapStart, fastResendOffset);
+    uint32_t gapEnd = it->first;
+    if (gapStart >= gapEnd) {
+        return;
+    }
+    sendResend(sender, rpcId, gapStart, gapEnd, whoFrom|FAST_RESEND);
+    fastResendOffset = gapEnd;
+}
+
+/**
+ * This method is invoked to issue RESEND packets when it appears that
+ * packets have been lost. It is used by both servers and clients. One
+ * RESEND is sent for each gap before a saved fragment (up to
+ * MAX_RESEND_RANGES of them), so data that has already arrived isn't
+ * sent again.
  * 
  * \param t
  *      Overall information about the transport.
@@ -1348,13 +1645,28 @@ BasicTransport::MessageAccumulator::requestRetransmission(BasicTransport *t,
         DIE("Bad fragment pointer: %p", &fragments);
     }
     uint32_t endOffset;
-    FragmentMap::iterator it = fragments.begin();
+
+    if (!fragments.empty()) {
+        // Retransmit each gap between the data we have.
+        uint32_t start = buffer->size();
+        uint32_t ranges = 0;
+        endOffset = start;
+        for (FragmentMap::iterator it = fragments.begin();
+                (it != fragments.end()) && (ranges < MAX_RESEND_RANGES);
+                it++) {
+            if (it->first > start) {
+                sendResend(address, rpcId, start, it->first, whoFrom);
+                endOffset = it->first;
+                ranges++;
+            }
+            start = std::max(start, it->first + it->second.length
+                    - sizeof32(DataHeader));
+        }
+        return endOffset;
+    }
 
     // Compute the end of the retransmission range.
-    if (it != fragments.end()) {
-        // Retransmit the entire gap up to the first fragment.
-        endOffset = it->first;
-    } else if (grantOffset > 0) {
+    if (grantOffset > 0) {
         // Retransmit everything that we've asked the sender to send:
         // we don't seem to have received any of it.
         endOffset = grantOffset;
@@ -1365,19 +1677,60 @@ BasicTransport::MessageAccumulator::requestRetransmission(BasicTransport *t,
         endOffset = roundTripBytes;
     }
     assert(endOffset > buffer->size());
-    if (whoFrom == FROM_SERVER) {
+    sendResend(address, rpcId, buffer->size(), endOffset, whoFrom);
+    return endOffset;
+}
+
+/**
+ * Send a RESEND packet for a range of the message and count it in the
+ * sender's LossStats.
+ *
+ * \param address
+ *      Network address to which the RESEND should be sent.
+ * \param rpcId
+ *      Unique identifier for the RPC in question.
+ * \param offset
+ *      Offset of the first byte to retransmit.
+ * \param endOffset
+ *      Offset of the byte just after the last one to retransmit.
+ * \param flags
+ *      Flags for the RESEND: FROM_CLIENT or FROM_SERVER, plus FAST_RESEND
+ *      if the range is known to be lost.
+ */
+void
+BasicTransport::MessageAccumulator::sendResend(const Driver::Address* address,
+        RpcId rpcId, uint32_t offset, uint32_t endOffset, uint8_t flags)
+{
+    if ((flags & FROM_CLIENT) == FROM_SERVER) {
         timeTrace("server requesting retransmission of bytes %u-%u, "
-                "sequence %u", buffer->size(), endOffset,
-                downCast<uint32_t>(rpcId.sequence));
+                "sequence %u, flags %u", offset, endOffset,
+                downCast<uint32_t>(rpcId.sequence), flags);
     } else {
         timeTrace("client requesting retransmission of bytes %u-%u, "
-                "sequence %u", buffer->size(), endOffset,
-                downCast<uint32_t>(rpcId.sequence));
+                "sequence %u, flags %u", offset, endOffset,
+                downCast<uint32_t>(rpcId.sequence), flags);
     }
-    ResendHeader resend(rpcId, buffer->size(), endOffset - buffer->size(),
-            whoFrom);
-    t->driver->sendPacket(address, &resend, NULL);
-    return endOffset;
+    ResendHeader resend(rpcId, offset, endOffset - offset, flags);
+    t->driver->sendPacket(address, &resend, NULL, t->highestPriority);
+    LossStats& stats = t->getLossStats(address);
+    if (flags & FAST_RESEND) {
+        stats.fastResends++;
+    } else {
+        stats.resends++;
+    }
+}
+
+/**
+ * Returns true if we have received all of the data that we have allowed
+ * the sender to transmit and are deliberately withholding further GRANTs
+ * (shorter messages are ahead of this one), so silence from the sender
+ * is expected rather than a sign of lost packets.
+ */
+bool
+BasicTransport::MessageAccumulator::waitingForGrant()
+{
+    return grantLinks.is_linked() && fragments.empty()
+            && (buffer->size() >= std::max(grantOffset, t->roundTripBytes));
 }
 
 /**
@@ -1460,6 +1813,17 @@ BasicTransport::checkTimeouts()
             it++;
             continue;
         }
+        if (clientRpc->accumulator
+                && clientRpc->accumulator->waitingForGrant()) {
+            // We're withholding GRANTs for this response, so the server's
+            // silence is expected; just let it know we're still alive.
+            clientRpc->silentIntervals = 0;
+            AckHeader ack(RpcId(clientId, sequence), FROM_CLIENT);
+            driver->sendPacket(clientRpc->session->serverAddress, &ack, NULL,
+                    highestPriority);
+            it++;
+            continue;
+        }
         clientRpc->silentIntervals++;
 
         // Advance the iterator here, so that it won't get invalidated if
@@ -1492,10 +1856,8 @@ BasicTransport::checkTimeouts()
                         downCast<uint32_t>(sequence));
                 ResendHeader resend(RpcId(clientId, sequence), 0,
                         roundTripBytes, FROM_CLIENT);
-                // The RESEND packet is effectively a grant...
-                clientRpc->grantOffset = roundTripBytes;
                 driver->sendPacket(clientRpc->session->serverAddress,
-                        &resend, NULL);
+                        &resend, NULL, highestPriority);
             }
         } else {
             // We have received part of the response. If the server has gone
@@ -1507,7 +1869,8 @@ BasicTransport::checkTimeouts()
                         clientRpc->accumulator->requestRetransmission(this,
                         clientRpc->session->serverAddress,
                         RpcId(clientId, sequence),
-                        clientRpc->grantOffset, roundTripBytes, FROM_CLIENT);
+                        clientRpc->accumulator->grantOffset, roundTripBytes,
+                        FROM_CLIENT);
             }
         }
     }
@@ -1523,6 +1886,17 @@ BasicTransport::checkTimeouts()
             it++;
             continue;
         }
+        if (!serverRpc->requestComplete
+                && serverRpc->accumulator->waitingForGrant()) {
+            // We're withholding GRANTs for this request, so the client's
+            // silence is expected; just let it know we're still alive.
+            serverRpc->silentIntervals = 0;
+            AckHeader ack(serverRpc->rpcId, FROM_SERVER);
+            driver->sendPacket(serverRpc->clientAddress, &ack, NULL,
+                    highestPriority);
+            it++;
+            continue;
+        }
         serverRpc->silentIntervals++;
 
         // Advance the iterator now, so it won't get invalidated if we
@@ -1553,9 +1927,14 @@ BasicTransport::checkTimeouts()
             serverRpc->resendLimit =
                     serverRpc->accumulator->requestRetransmission(this,
                     serverRpc->clientAddress, serverRpc->rpcId,
-                    serverRpc->grantOffset, roundTripBytes, FROM_SERVER);
+                    serverRpc->accumulator->grantOffset, roundTripBytes,
+                    FROM_SERVER);
         }
     }
+
+    // RPCs deleted above (or cancelled since the last check) may have made
+    // room for other messages to receive GRANTs.
+    sendGrants();
 }
 
 }  // namespace RAMCloud
@@ -30,6 +30,14 @@ namespace RAMCloud {
 /**
  * This class implements a simple transport that uses the Driver mechanism
  * for datagram-based packet delivery.
+ *
+ * Long messages are scheduled by their receivers: a sender transmits the
+ * first roundTripBytes of a message unilaterally, then waits for GRANTs.
+ * Each receiver grants to a few incoming messages at a time, shortest
+ * remaining first (SRPT), and tells each sender which network priority to
+ * use for the granted bytes; unscheduled bytes use higher priorities,
+ * chosen by message size. This keeps short RPCs from queueing behind large
+ * transfers when many senders converge on one receiver.
  */
 class BasicTransport : public Transport {
   PRIVATE:
@@ -50,6 +58,7 @@ class BasicTransport : public Transport {
     void registerMemory(void* base, size_t bytes) {
         driver->registerMemory(base, bytes);
     }
+    void dumpStats();
 
   PRIVATE:
     /**
@@ -139,13 +148,29 @@ class BasicTransport : public Transport {
      */
     class MessageAccumulator {
       public:
-        MessageAccumulator(BasicTransport* t, Buffer* buffer);
+        MessageAccumulator(BasicTransport* t, Buffer* buffer,
+                const Driver::Address* sender, RpcId rpcId, uint8_t whoFrom);
         ~MessageAccumulator();
         bool addPacket(DataHeader *header, uint32_t length);
         bool appendFragment(DataHeader *header, uint32_t length);
+        void requestFastRetransmission();
         uint32_t requestRetransmission(BasicTransport *t,
                 const Driver::Address* address, RpcId grantOffset,
                 uint32_t limit, uint32_t roundTripBytes, uint8_t whoFrom);
+        void sendResend(const Driver::Address* address, RpcId rpcId,
+                uint32_t offset, uint32_t endOffset, uint8_t flags);
+        bool waitingForGrant();
+
+        /**
+         * Returns the number of bytes of the message that haven't been
+         * assembled yet; the scheduler grants to the messages with the
+         * fewest remaining bytes first.
+         */
+        uint32_t bytesRemaining()
+        {
+            return (totalLength > buffer->size())
+                    ? totalLength - buffer->size() : 0;
+        }
 
         /// Transport that is managing this object.
         BasicTransport* t;
@@ -177,14 +202,44 @@ class BasicTransport : public Transport {
         /// more preceding packets have not yet been received. Each
         /// key is an offset in the message; each value describes the
         /// corresponding fragment, which is a stolen Driver::Received.
+        /// The gaps between fragments are exactly the data that is
+        /// missing, so RESENDs ask for those ranges only.
         typedef std::map<uint32_t, MessageFragment>FragmentMap;
         FragmentMap fragments;
 
+        /// Gaps in the message that end at or before this offset have
+        /// already been requested with a FAST_RESEND. Each gap is requested
+        /// that way at most once; if the retransmission is lost too, the
+        /// timer in checkTimeouts requests it again.
+        uint32_t fastResendOffset;
+
         /// Offset into the message of the most recent GRANT packet
         /// we have sent (i.e., we've already authorized the sender to
-        /// transmit bytes up to this point in the message).
+        /// transmit bytes up to this point in the message), or 0 if we
+        /// haven't sent any GRANTs.
         uint32_t grantOffset;
 
+        /// Where GRANTs for this message should be sent.
+        const Driver::Address* sender;
+
+        /// The RPC this message belongs to.
+        RpcId rpcId;
+
+        /// FROM_CLIENT if we are the client for the RPC (this is a
+        /// response), FROM_SERVER if we are the server (this is a request).
+        uint8_t whoFrom;
+
+        /// Total length of the message, from its DATA packets; 0 until
+        /// the sender has asked for GRANTs.
+        uint32_t totalLength;
+
+        /// Priority level from the most recent GRANT we have sent for
+        /// this message, or -1 if we haven't sent any GRANTs.
+        int grantPriority;
+
+        /// Used to link this object into t->grantableMessages.
+        IntrusiveListHook grantLinks;
+
       PRIVATE:
         DISALLOW_COPY_AND_ASSIGN(MessageAccumulator);
     };
@@ -227,9 +282,9 @@ class BasicTransport : public Transport {
         /// data bytes of the request.
         uint64_t lastTransmitTime;
 
-        /// Offset from the most recent GRANT packet we have sent for
-        /// the response for this RPC, or 0 if we haven't sent any GRANTs.
-        uint32_t grantOffset;
+        /// Priority level for request bytes beyond the unscheduled ones,
+        /// from the most recent GRANT received from the server.
+        int scheduledPriority;
 
         /// The sum of the offset and length fields from the most recent
         /// RESEND we have sent, 0 if no RESEND has been sent for this
@@ -266,7 +321,7 @@ class BasicTransport : public Transport {
             , transmitLimit(0)
             , transmitSequenceNumber(0)
             , lastTransmitTime(0)
-            , grantOffset(0)
+            , scheduledPriority(0)
             , resendLimit(0)
             , silentIntervals(0)
             , needGrantFlag(0)
@@ -320,9 +375,9 @@ class BasicTransport : public Transport {
         /// data bytes of the response.
         uint64_t lastTransmitTime;
 
-        /// Offset from the most recent GRANT packet we have sent for
-        /// the request message, or 0 if we haven't sent any GRANTs.
-        uint32_t grantOffset;
+        /// Priority level for response bytes beyond the unscheduled ones,
+        /// from the most recent GRANT received from the client.
+        int scheduledPriority;
 
         /// The sum of the offset and length fields from the most recent
         /// RESEND we have sent, 0 if no RESEND has been sent for this
@@ -365,7 +420,7 @@ class BasicTransport : public Transport {
             , transmitLimit(0)
             , transmitSequenceNumber(0)
             , lastTransmitTime(0)
-            , grantOffset(0)
+            , scheduledPriority(0)
             , resendLimit(0)
             , silentIntervals(0)
             , requestComplete(false)
@@ -430,11 +485,46 @@ class BasicTransport : public Transport {
     //                           the server has no knowledge of this request,
     //                           so the client should reset its state to
     //                           indicate that everything needs to be resent.
+    // FAST_RESEND:              Used only in RESEND packets: the receiver
+    //                           has since received FAST_RESEND_PACKETS
+    //                           packets that follow the requested range, so
+    //                           the range was lost; retransmit it right away
+    //                           even if data was transmitted recently.
     static const uint8_t FROM_CLIENT =    1;
     static const uint8_t FROM_SERVER =    0;
     static const uint8_t NEED_GRANT =     2;
     static const uint8_t RETRANSMISSION = 4;
     static const uint8_t RESTART =        8;
+    static const uint8_t FAST_RESEND =    16;
+
+    /// A gap in an incoming message is assumed lost (rather than
+    /// reordered) once this many packets following it have arrived.
+    static const uint32_t FAST_RESEND_PACKETS = 3;
+
+    /// Most RESEND packets sent for one message by a single call to
+    /// requestRetransmission.
+    static const uint32_t MAX_RESEND_RANGES = 8;
+
+    /**
+     * Counts packet losses involving one peer; see dumpStats().
+     */
+    struct LossStats {
+        /// RESENDs we sent to the peer because the timer expired.
+        uint64_t resends;
+
+        /// RESENDs we sent to the peer with FAST_RESEND.
+        uint64_t fastResends;
+
+        /// Times we retransmitted data at the peer's request.
+        uint64_t retransmissions;
+
+        /// Bytes of message data in those retransmissions.
+        uint64_t retransmittedBytes;
+
+        LossStats()
+            : resends(0), fastResends(0), retransmissions(0),
+              retransmittedBytes(0) {}
+    };
 
     /**
      * Describes the wire format for an ALL_DATA packet, which contains an
@@ -486,9 +576,14 @@ class BasicTransport : public Transport {
                                      // sender should now transmit all data up
                                      // to (but not including) this offset, if
                                      // it hasn't already.
+        uint8_t priority;            // Priority level the sender should use
+                                     // for the granted bytes (the receiver's
+                                     // SRPT rank for this message).
 
-        GrantHeader(RpcId rpcId, uint32_t offset, uint8_t flags)
-            : common(PacketOpcode::GRANT, rpcId, flags), offset(offset) {}
+        GrantHeader(RpcId rpcId, uint32_t offset, uint8_t priority,
+                uint8_t flags)
+            : common(PacketOpcode::GRANT, rpcId, flags), offset(offset),
+              priority(priority) {}
     } __attribute__((packed));
 
     /**
@@ -557,14 +652,20 @@ class BasicTransport : public Transport {
     void checkTimeouts();
     void deleteClientRpc(ClientRpc* clientRpc);
     void deleteServerRpc(ServerRpc* serverRpc);
+    LossStats& getLossStats(const Driver::Address* peer);
+    uint32_t getOvercommitment(const ServiceLocator* locator);
     uint32_t getRoundTripBytes(const ServiceLocator* locator);
+    int getUnscheduledPriority(uint32_t messageSize);
     void handlePacket(Driver::Received* received);
     static string headerToString(const void* header, uint32_t headerLength);
     static string opcodeSymbol(uint8_t opcode);
     uint32_t sendBytes(const Driver::Address* address, RpcId rpcId,
             Buffer* message, uint32_t offset, uint32_t maxBytes,
-            uint8_t flags, bool partialOK = false);
+            uint8_t flags, bool partialOK = false,
+            int scheduledPriority = 0);
+    void sendGrants();
     int tryToTransmitData();
+    void updateGrants(MessageAccumulator* message, uint32_t totalLength);
 
     /// Shared RAMCloud information.
     Context* context;
@@ -621,6 +722,12 @@ class BasicTransport : public Transport {
     typedef std::map<uint64_t, ClientRpc*> ClientRpcMap;
     ClientRpcMap outgoingRpcs;
 
+    /// The RPC in outgoingRpcs that the most recent packet from a server
+    /// belonged to, or NULL. The packets of a multi-packet response tend to
+    /// arrive back to back, so handlePacket checks this before searching
+    /// outgoingRpcs.
+    ClientRpc* recentClientRpc;
+
     /// Holds RPCs for which we are the client, and for which the
     /// request message has not yet been completely transmitted (once
     /// the last byte of the request has been transmitted for the first
@@ -639,6 +746,10 @@ class BasicTransport : public Transport {
     typedef std::unordered_map<RpcId, ServerRpc*, RpcId::Hasher> ServerRpcMap;
     ServerRpcMap incomingRpcs;
 
+    /// The RPC in incomingRpcs that the most recent packet from a client
+    /// belonged to, or NULL; see recentClientRpc.
+    ServerRpc* recentServerRpc;
+
     /// Holds RPCs for which we are the server, and whose response is
     /// partially transmitted (the response is ready to be sent, but the
     /// last byte has not yet been sent). An RPC may be in both
@@ -647,6 +758,11 @@ class BasicTransport : public Transport {
             OutgoingResponseList;
     OutgoingResponseList outgoingResponses;
 
+    /// Used by tryToTransmitData to hold RPCs whose last response byte it
+    /// has sent; they are only deleted once the driver has flushed the
+    /// batch, since held packets may still refer to their responses.
+    std::vector<ServerRpc*> transmittedServerRpcs;
+
     /// Subset of the objects in incomingRpcs that require monitoring by
     /// the timer. We keep this as a separate list so that the timer doesn't
     /// have to consider RPCs currently being executed (which could be a
@@ -668,6 +784,36 @@ class BasicTransport : public Transport {
     /// GRANTS, but it can result in additional buffering in the network.
     uint32_t grantIncrement;
 
+    /// Highest priority level supported by the driver. Control packets
+    /// (GRANT, RESEND, ACK) are always sent at this level.
+    int highestPriority;
+
+    /// Levels 0 through this one are used for scheduled bytes (those sent
+    /// in response to GRANTs); the higher levels are used for the
+    /// unscheduled bytes at the start of each message. If the driver has
+    /// only one level, everything shares it.
+    int highestScheduledPriority;
+
+    /// Unscheduled bytes of a message of at most unscheduledCutoffs[i]
+    /// bytes are sent at priority highestPriority - i, so short messages
+    /// preempt the first round-trip of longer ones; messages longer than
+    /// the last cutoff use the lowest unscheduled level.
+    std::vector<uint32_t> unscheduledCutoffs;
+
+    /// Maximum number of incoming messages that we grant to at once (the
+    /// "degree of overcommitment"). Granting to more than one sender keeps
+    /// our downlink busy when some senders are slow to respond, at the cost
+    /// of more buffering in the network.
+    uint32_t maxGrantedMessages;
+
+    /// Incoming messages whose senders are waiting for GRANTs, in
+    /// increasing order of bytesRemaining (shortest remaining first). Only
+    /// the first maxGrantedMessages of these receive GRANTs; a message
+    /// leaves the list once all of its bytes have been granted.
+    INTRUSIVE_LIST_TYPEDEF(MessageAccumulator, grantLinks)
+            GrantableMessageList;
+    GrantableMessageList grantableMessages;
+
     /// Specifies the interval between calls to checkTimeouts, in units
     /// of rdtsc ticks.
     uint64_t timerInterval;
@@ -691,6 +837,12 @@ class BasicTransport : public Transport {
     /// RESEND request, assuming the response was lost.
     uint32_t pingIntervals;
 
+    /// Packet loss counters for each peer we have exchanged RESENDs or
+    /// retransmissions with, keyed by the peer's address (see
+    /// Driver::Address::toString). Only touched when packets are lost;
+    /// cleared by dumpStats().
+    std::unordered_map<string, LossStats> peerLossStats;
+
     DISALLOW_COPY_AND_ASSIGN(BasicTransport);
 };
 
@@ -156,6 +156,29 @@ TEST_F(BasicTransportTest, sanityCheck) {
 
 TEST_F(BasicTransportTest, constructor) {
     EXPECT_EQ(9618u, transport.roundTripBytes);
+    EXPECT_EQ(0, transport.highestScheduledPriority);
+    EXPECT_EQ(0u, transport.unscheduledCutoffs.size());
+}
+
+// Driver with 8 priority levels.
+class PriorityMockDriver : public MockDriver {
+  public:
+    PriorityMockDriver() : MockDriver(BasicTransport::headerToString) {}
+    int getHighestPacketPriority() { return 7; }
+};
+
+TEST_F(BasicTransportTest, constructor_priorityLevels) {
+    BasicTransport transport2(&context, NULL, new PriorityMockDriver, 1);
+    EXPECT_EQ(7, transport2.highestPriority);
+    EXPECT_EQ(3, transport2.highestScheduledPriority);
+    uint32_t packet = transport2.maxDataPerPacket;
+    ASSERT_EQ(3u, transport2.unscheduledCutoffs.size());
+    EXPECT_EQ(packet, transport2.unscheduledCutoffs[0]);
+    EXPECT_EQ(16*packet, transport2.unscheduledCutoffs[2]);
+    EXPECT_EQ(7, transport2.getUnscheduledPriority(packet));
+    EXPECT_EQ(6, transport2.getUnscheduledPriority(packet + 1));
+    EXPECT_EQ(5, transport2.getUnscheduledPriority(16*packet));
+    EXPECT_EQ(4, transport2.getUnscheduledPriority(16*packet + 1));
 }
 
 TEST_F(BasicTransportTest, deleteClientRpc) {
@@ -228,6 +251,17 @@ TEST_F(BasicTransportTest, getRoundTripBytes_bogusRttOption) {
             "'5zzz' (expected positive integer); ignoring option",
             TestLog::get());
 }
+TEST_F(BasicTransportTest, getOvercommitment) {
+    EXPECT_EQ(8u, transport.getOvercommitment(NULL));
+    ServiceLocator locator("mock:overcommit=3");
+    EXPECT_EQ(3u, transport.getOvercommitment(&locator));
+    ServiceLocator locator2("mock:overcommit=0");
+    TestLog::reset();
+    EXPECT_EQ(8u, transport.getOvercommitment(&locator2));
+    EXPECT_EQ("getOvercommitment: Bad BasicTransport overcommit option "
+            "value '0' (expected positive integer); ignoring option",
+            TestLog::get());
+}
 TEST_F(BasicTransportTest, getRoundTripBytes_roundUpToEvenPackets) {
     transport.maxDataPerPacket = 100;
     ServiceLocator locator("mock:gbs=1,rttMicros=9");
@@ -462,8 +496,8 @@ TEST_F(BasicTransportTest, Session_cancelRequest) {
 
 TEST_F(BasicTransportTest, Session_getRpcInfo) {
     Transport::RpcNotifier notifier1, notifier2;
-    WireFormat::RequestCommon header1 = {WireFormat::PING, 0};
-    WireFormat::RequestCommon header2 = {WireFormat::READ, 0};
+    WireFormat::RequestCommon header1 = {WireFormat::PING, 0, 0, 0};
+    WireFormat::RequestCommon header2 = {WireFormat::READ, 0, 0, 0};
     Buffer request1, request2;
     Buffer response1, response2;
     request1.appendCopy(&header1);
@@ -590,7 +624,7 @@ TEST_F(BasicTransportTest, handlePacket_dataFromServer_basics) {
             BasicTransport::DataHeader(BasicTransport::RpcId(666, 1), 10, 0,
             BasicTransport::NEED_GRANT | BasicTransport::FROM_SERVER), "abcde");
     EXPECT_STREQ("completed: 0, failed: 0", wrapper.getState());
-    EXPECT_EQ("GRANT FROM_CLIENT, rpcId 666.1, offset 1505",
+    EXPECT_EQ("GRANT FROM_CLIENT, rpcId 666.1, offset 1505, priority 0",
             driver->outputLog);
     EXPECT_EQ("abcde", TestUtil::toString(&wrapper.response));
     EXPECT_EQ(1u, Driver::Received::stealCount);
@@ -644,7 +678,7 @@ TEST_F(BasicTransportTest, handlePacket_dataFromServer_dontIssueGrant) {
             BasicTransport::DataHeader(BasicTransport::RpcId(666, 1), 15, 0,
             BasicTransport::NEED_GRANT|BasicTransport::FROM_SERVER),
             "abcde");
-    EXPECT_EQ("GRANT FROM_CLIENT, rpcId 666.1, offset 1505",
+    EXPECT_EQ("GRANT FROM_CLIENT, rpcId 666.1, offset 1505, priority 0",
             driver->outputLog);
 
     // Second packet of response (still not complete, but no need for
@@ -687,14 +721,15 @@ TEST_F(BasicTransportTest, handlePacket_grantFromServer) {
     // First grant doesn't get past transmitLimit.
     handlePacket("mock:server=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(666, 1), 10,
-            BasicTransport::FROM_SERVER));
+            0, BasicTransport::FROM_SERVER));
     EXPECT_EQ(10lu, clientRpc->transmitLimit);
 
     // Second grant is far enough out to enable more bytes to be sent.
     handlePacket("mock:server=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(666, 1), 15,
-            BasicTransport::FROM_SERVER));
+            3, BasicTransport::FROM_SERVER));
     EXPECT_EQ(15lu, clientRpc->transmitLimit);
+    EXPECT_EQ(3, clientRpc->scheduledPriority);
 }
 TEST_F(BasicTransportTest, handlePacket_logTimeTraceFromServer) {
     MockWrapper wrapper("message1");
@@ -859,7 +894,7 @@ TEST_F(BasicTransportTest, handlePacket_dataFromClient_basics) {
     ASSERT_TRUE(it != transport.incomingRpcs.end());
     BasicTransport::ServerRpc* serverRpc = it->second;
     EXPECT_FALSE(serverRpc->requestComplete);
-    EXPECT_EQ("GRANT FROM_SERVER, rpcId 100.101, offset 1500",
+    EXPECT_EQ("GRANT FROM_SERVER, rpcId 100.101, offset 1500, priority 0",
             driver->outputLog);
     EXPECT_EQ(2u, transport.nextServerSequenceNumber);
 
@@ -870,7 +905,7 @@ TEST_F(BasicTransportTest, handlePacket_dataFromClient_basics) {
             0, BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
             "01234");
     EXPECT_FALSE(serverRpc->requestComplete);
-    EXPECT_EQ(1500u, serverRpc->grantOffset);
+    EXPECT_EQ(1500u, serverRpc->accumulator->grantOffset);
     EXPECT_EQ("", driver->outputLog);
     EXPECT_EQ(1lu, transport.incomingRpcs.size());
     EXPECT_EQ(1lu, transport.serverTimerList.size());
@@ -933,6 +968,30 @@ TEST_F(BasicTransportTest, handlePacket_dataFromClient_extraneousPacket) {
     EXPECT_TRUE(serverRpc != NULL);
     EXPECT_EQ("message1", TestUtil::toString(&serverRpc->requestPayload));
 }
+TEST_F(BasicTransportTest, handlePacket_recentServerRpc) {
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 20,
+            0, BasicTransport::FROM_CLIENT), "0123456789");
+    BasicTransport::ServerRpc* serverRpc = transport.recentServerRpc;
+    ASSERT_TRUE(serverRpc != NULL);
+    EXPECT_EQ(BasicTransport::RpcId(100, 101), serverRpc->rpcId);
+
+    // A packet for another RPC takes over the cache; the next packet of
+    // the first one is still found through incomingRpcs.
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 102), 20,
+            0, BasicTransport::FROM_CLIENT), "abcdefghij");
+    EXPECT_NE(serverRpc, transport.recentServerRpc);
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 20,
+            10, BasicTransport::FROM_CLIENT), "ABCDEFGHIJ");
+    EXPECT_EQ(serverRpc, transport.recentServerRpc);
+    EXPECT_EQ("0123456789ABCDEFGHIJ",
+            TestUtil::toString(&serverRpc->requestPayload));
+
+    transport.deleteServerRpc(serverRpc);
+    EXPECT_TRUE(transport.recentServerRpc == NULL);
+}
 TEST_F(BasicTransportTest, handlePacket_grantFromClient_bogusGrants) {
     prepareToRespond();
     transport.roundTripBytes = 5;
@@ -941,7 +1000,7 @@ TEST_F(BasicTransportTest, handlePacket_grantFromClient_bogusGrants) {
     // GRANT arriving for unknown RpcID: bogus.
     handlePacket("mock:client=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(5, 6), 10,
-            BasicTransport::FROM_CLIENT));
+            0, BasicTransport::FROM_CLIENT));
     EXPECT_EQ("handlePacket: unexpected GRANT from client mock:client=1, "
             "id (5,6), grantOffset 10",
             TestLog::get());
@@ -950,7 +1009,7 @@ TEST_F(BasicTransportTest, handlePacket_grantFromClient_bogusGrants) {
     TestLog::reset();
     handlePacket("mock:client=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(100, 101), 10,
-            BasicTransport::FROM_CLIENT));
+            0, BasicTransport::FROM_CLIENT));
     EXPECT_EQ("handlePacket: unexpected GRANT from client mock:client=1, "
             "id (100,101), grantOffset 10",
             TestLog::get());
@@ -976,7 +1035,7 @@ TEST_F(BasicTransportTest, handlePacket_grantFromClient) {
     // First, send redundant grant (do nothing).
     handlePacket("mock:client=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(100, 101), 5,
-            BasicTransport::FROM_CLIENT));
+            0, BasicTransport::FROM_CLIENT));
     transport.tryToTransmitData();
     EXPECT_EQ("", driver->outputLog);
     EXPECT_EQ(5u, serverRpc->transmitLimit);
@@ -984,7 +1043,7 @@ TEST_F(BasicTransportTest, handlePacket_grantFromClient) {
     // Second grant should allow more data to be transmitted.
     handlePacket("mock:client=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(100, 101), 15,
-            BasicTransport::FROM_CLIENT));
+            0, BasicTransport::FROM_CLIENT));
     transport.tryToTransmitData();
     EXPECT_EQ("DATA FROM_SERVER, rpcId 100.101, totalLength 20, offset 5, "
             "NEED_GRANT 56789 | "
@@ -997,7 +1056,7 @@ TEST_F(BasicTransportTest, handlePacket_grantFromClient) {
     driver->outputLog.clear();
     handlePacket("mock:client=1",
             BasicTransport::GrantHeader(BasicTransport::RpcId(100, 101), 25,
-            BasicTransport::FROM_CLIENT));
+            0, BasicTransport::FROM_CLIENT));
     EXPECT_EQ(25u, serverRpc->transmitLimit);
     transport.tryToTransmitData();
     EXPECT_EQ("DATA FROM_SERVER, rpcId 100.101, totalLength 20, offset 15, "
@@ -1093,6 +1152,30 @@ TEST_F(BasicTransportTest, handlePacket_resendFromClient_sendBytes) {
             "NEED_GRANT, RETRANSMISSION 56789abc",
             driver->outputLog);
     EXPECT_EQ(1001010lu, serverRpc->lastTransmitTime);
+    BasicTransport::LossStats& stats =
+            transport.peerLossStats["mock:client=1"];
+    EXPECT_EQ(1u, stats.retransmissions);
+    EXPECT_EQ(8u, stats.retransmittedBytes);
+    Cycles::mockTscValue = 0;
+}
+TEST_F(BasicTransportTest, handlePacket_resendFromClient_fastResend) {
+    // Unlike a RESEND from the timer, a FAST_RESEND is honored even if we
+    // transmitted recently.
+    Cycles::mockTscValue = 1000000;
+    transport.timerInterval = 1000;
+    prepareToRespond();
+    transport.roundTripBytes = 15;
+    transport.maxDataPerPacket = 15;
+    transport.incomingRpcs[BasicTransport::RpcId(100, 101)]->sendReply();
+
+    driver->outputLog.clear();
+    Cycles::mockTscValue += 10;
+    handlePacket("mock:client=1",
+            BasicTransport::ResendHeader(BasicTransport::RpcId(100, 101),
+            5, 8, BasicTransport::FROM_CLIENT|BasicTransport::FAST_RESEND));
+    EXPECT_EQ("DATA FROM_SERVER, rpcId 100.101, totalLength 20, offset 5, "
+            "NEED_GRANT, RETRANSMISSION 56789abc",
+            driver->outputLog);
     Cycles::mockTscValue = 0;
 }
 TEST_F(BasicTransportTest, handlePacket_ackFromClient) {
@@ -1110,6 +1193,16 @@ TEST_F(BasicTransportTest, handlePacket_unknownOpcodeFromClient) {
             "mock:client=1", TestLog::get());
 }
 
+TEST_F(BasicTransportTest, dumpStats) {
+    transport.peerLossStats["mock:client=1"].fastResends = 2;
+    transport.peerLossStats["mock:client=1"].retransmissions = 3;
+    transport.peerLossStats["mock:client=1"].retransmittedBytes = 400;
+    transport.dumpStats();
+    EXPECT_EQ("dumpStats: Packet loss with mock:client=1: 0 RESENDs sent "
+            "after timeouts, 2 fast RESENDs sent, 3 retransmissions "
+            "(400 bytes)", TestLog::get());
+    EXPECT_EQ(0u, transport.peerLossStats.size());
+}
 TEST_F(BasicTransportTest, sendReply_basics) {
     transport.roundTripBytes = 10;
     transport.maxDataPerPacket = 10;
@@ -1135,6 +1228,76 @@ TEST_F(BasicTransportTest, sendReply_needGrantFlag) {
             driver->outputLog);
 }
 
+TEST_F(BasicTransportTest, sendGrants_shortestRemainingFirst) {
+    transport.roundTripBytes = 10;
+    transport.grantIncrement = 5;
+    transport.highestScheduledPriority = 3;
+    transport.maxGrantedMessages = 2;
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(1, 1), 50, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    EXPECT_EQ("GRANT FROM_SERVER, rpcId 1.1, offset 25, priority 3",
+            driver->outputLog);
+
+    // A shorter message takes over the highest priority.
+    driver->outputLog.clear();
+    handlePacket("mock:client=2",
+            BasicTransport::DataHeader(BasicTransport::RpcId(2, 1), 30, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    EXPECT_EQ("GRANT FROM_SERVER, rpcId 2.1, offset 25, priority 3 | "
+            "GRANT FROM_SERVER, rpcId 1.1, offset 25, priority 2",
+            driver->outputLog);
+
+    // Only the first maxGrantedMessages messages get GRANTs, and a
+    // message leaves the list once it has been granted completely.
+    driver->outputLog.clear();
+    handlePacket("mock:client=3",
+            BasicTransport::DataHeader(BasicTransport::RpcId(3, 1), 20, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    EXPECT_EQ("GRANT FROM_SERVER, rpcId 3.1, offset 25, priority 3 | "
+            "GRANT FROM_SERVER, rpcId 2.1, offset 25, priority 2",
+            driver->outputLog);
+    EXPECT_EQ(2u, transport.grantableMessages.size());
+    EXPECT_EQ(2u, transport.grantableMessages.front().rpcId.clientId);
+}
+TEST_F(BasicTransportTest, sendGrants_afterMessageCompletes) {
+    transport.roundTripBytes = 10;
+    transport.grantIncrement = 5;
+    transport.maxGrantedMessages = 1;
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(1, 1), 50, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    handlePacket("mock:client=2",
+            BasicTransport::DataHeader(BasicTransport::RpcId(2, 1), 30, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(1, 1), 50, 10,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(1, 1), 50, 20,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "01234");
+    BasicTransport::ServerRpc* serverRpc =
+            transport.incomingRpcs[BasicTransport::RpcId(1, 1)];
+    EXPECT_TRUE(serverRpc->accumulator->waitingForGrant());
+
+    // The first message gets GRANTs again once the second one is done.
+    driver->outputLog.clear();
+    handlePacket("mock:client=2",
+            BasicTransport::DataHeader(BasicTransport::RpcId(2, 1), 30, 10,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "01234567890123456789");
+    EXPECT_EQ("GRANT FROM_SERVER, rpcId 1.1, offset 40, priority 0",
+            driver->outputLog);
+    EXPECT_FALSE(serverRpc->accumulator->waitingForGrant());
+}
+
 TEST_F(BasicTransportTest, MessageAccumulator_destructor) {
     handlePacket("mock:client=1",
             BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 20, 5,
@@ -1255,6 +1418,22 @@ TEST_F(BasicTransportTest, appendFragment_truncateFragments) {
     EXPECT_EQ("xxxxxyyyyzzzz", TestUtil::toString(&serverRpc->requestPayload));
     EXPECT_EQ(0u, driver->releaseCount);
 }
+TEST_F(BasicTransportTest, appendFragment_copyWhenReceiveBuffersLow) {
+    driver->receiveBuffersAreLow = true;
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 20, 5,
+            BasicTransport::FROM_CLIENT), "56789");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 20, 0,
+            BasicTransport::FROM_CLIENT), "01234");
+    BasicTransport::ServerRpcMap::iterator it =
+            transport.incomingRpcs.find(BasicTransport::RpcId(100, 101));
+    ASSERT_TRUE(it != transport.incomingRpcs.end());
+    BasicTransport::ServerRpc* serverRpc = it->second;
+    EXPECT_EQ(0u, serverRpc->accumulator->fragments.size());
+    EXPECT_EQ("0123456789", TestUtil::toString(&serverRpc->requestPayload));
+    EXPECT_EQ(2u, driver->releaseCount);
+}
 
 TEST_F(BasicTransportTest, requestRetransmission) {
     transport.roundTripBytes = 100;
@@ -1299,6 +1478,73 @@ TEST_F(BasicTransportTest, requestRetransmission) {
     EXPECT_EQ("RESEND FROM_SERVER, rpcId 100.101, offset 5, length 10",
             driver->outputLog);
 }
+TEST_F(BasicTransportTest, requestRetransmission_eachGap) {
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 40, 0,
+            BasicTransport::FROM_CLIENT), "01234");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 40, 10,
+            BasicTransport::FROM_CLIENT), "abcde");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 40, 20,
+            BasicTransport::FROM_CLIENT), "ABCDE");
+    BasicTransport::ServerRpc* serverRpc =
+            transport.incomingRpcs[BasicTransport::RpcId(100, 101)];
+    driver->outputLog.clear();
+    uint32_t limit = serverRpc->accumulator->requestRetransmission(
+            &transport, &address1, BasicTransport::RpcId(100, 101), 40, 100,
+            BasicTransport::FROM_SERVER);
+    EXPECT_EQ(20u, limit);
+    EXPECT_EQ("RESEND FROM_SERVER, rpcId 100.101, offset 5, length 5 | "
+            "RESEND FROM_SERVER, rpcId 100.101, offset 15, length 5",
+            driver->outputLog);
+    EXPECT_EQ(2u, transport.peerLossStats["mock:node=1"].resends);
+}
+TEST_F(BasicTransportTest, requestFastRetransmission) {
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 0,
+            BasicTransport::FROM_CLIENT), "01234");
+    driver->outputLog.clear();
+
+    // Bytes 5-9 are missing; nothing happens until 3 packets follow them.
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 10,
+            BasicTransport::FROM_CLIENT), "abcde");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 15,
+            BasicTransport::FROM_CLIENT), "fghij");
+    EXPECT_EQ("", driver->outputLog);
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 20,
+            BasicTransport::FROM_CLIENT), "klmno");
+    EXPECT_EQ("RESEND FROM_SERVER, rpcId 100.101, offset 5, length 5, "
+            "FAST_RESEND", driver->outputLog);
+
+    // The same gap isn't requested again.
+    driver->outputLog.clear();
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 25,
+            BasicTransport::FROM_CLIENT), "pqrst");
+    EXPECT_EQ("", driver->outputLog);
+
+    // A second gap, at bytes 30-34.
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 35,
+            BasicTransport::FROM_CLIENT), "ABCDE");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 40,
+            BasicTransport::FROM_CLIENT), "FGHIJ");
+    EXPECT_EQ("", driver->outputLog);
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(100, 101), 50, 45,
+            BasicTransport::FROM_CLIENT), "KLMNO");
+    EXPECT_EQ("RESEND FROM_SERVER, rpcId 100.101, offset 30, length 5, "
+            "FAST_RESEND", driver->outputLog);
+    BasicTransport::ServerRpc* serverRpc =
+            transport.incomingRpcs[BasicTransport::RpcId(100, 101)];
+    EXPECT_EQ(35u, serverRpc->accumulator->fastResendOffset);
+    EXPECT_EQ(2u, transport.peerLossStats["mock:client=1"].fastResends);
+}
 
 TEST_F(BasicTransportTest, poll_nothingToDo) {
     transport.nextTimeoutCheck = ~0;
@@ -1499,6 +1745,37 @@ TEST_F(BasicTransportTest, checkTimeouts_serverAbortsRequest) {
     EXPECT_EQ("deleteServerRpc: RpcId (100, 101)",
             TestLog::get());
 }
+TEST_F(BasicTransportTest, checkTimeouts_withholdingGrants) {
+    transport.roundTripBytes = 10;
+    transport.grantIncrement = 5;
+    transport.maxGrantedMessages = 1;
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(1, 1), 50, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    handlePacket("mock:client=2",
+            BasicTransport::DataHeader(BasicTransport::RpcId(2, 1), 30, 0,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "0123456789");
+    handlePacket("mock:client=1",
+            BasicTransport::DataHeader(BasicTransport::RpcId(1, 1), 50, 10,
+            BasicTransport::NEED_GRANT|BasicTransport::FROM_CLIENT),
+            "012345678901234");
+    BasicTransport::ServerRpc* serverRpc =
+            transport.incomingRpcs[BasicTransport::RpcId(1, 1)];
+    serverRpc->silentIntervals = 5;
+    driver->outputLog.clear();
+
+    // The client that we're not granting to gets ACKs rather than
+    // RESENDs, and its RPC doesn't time out.
+    transport.checkTimeouts();
+    transport.checkTimeouts();
+    EXPECT_EQ("ACK FROM_SERVER, rpcId 1.1 | "
+            "ACK FROM_SERVER, rpcId 1.1 | "
+            "RESEND FROM_SERVER, rpcId 2.1, offset 10, length 15",
+            driver->outputLog);
+    EXPECT_EQ(0u, serverRpc->silentIntervals);
+}
 TEST_F(BasicTransportTest, checkTimeouts_sendResendFromServer) {
     transport.roundTripBytes = 100;
     transport.grantIncrement = 50;
@@ -48,9 +48,43 @@ struct BindTransport : public Transport {
             DISALLOW_COPY_AND_ASSIGN(ServerRpc);
     };
 
+    /**
+     * If a BindTransport has one of these (see #rpcModel), it is told
+     * about every RPC the transport delivers; SimulatedCluster uses this
+     * to charge simulated time for RPCs.
+     */
+    struct RpcModel {
+        virtual ~RpcModel() {}
+
+        /**
+         * Called just before a server handles an RPC.
+         *
+         * \param locator
+         *      Service locator of the server.
+         * \param request
+         *      The request message.
+         */
+        virtual void startRpc(const string& locator, Buffer* request) = 0;
+
+        /**
+         * Called once the server has produced its response; any RPCs the
+         * server issued in between were made on its behalf.
+         *
+         * \param locator
+         *      Service locator of the server.
+         * \param request
+         *      The request message.
+         * \param response
+         *      The response message.
+         */
+        virtual void finishRpc(const string& locator, Buffer* request,
+                Buffer* response) = 0;
+    };
+
     explicit BindTransport(Context* context)
         : context(context), servers(), abortCounter(0), errorMessage(),
-          serverRpcPool()
+          serverRpcPool(), registeredRegions(), remoteReads(false),
+          remoteWrites(false), rpcModel(NULL)
     { }
 
     string
@@ -88,6 +122,34 @@ struct BindTransport : public Transport {
         return context->transportManager->getSession("mock:");
     }
 
+    void registerMemory(void* base, size_t bytes) {
+        registeredRegions.push_back({static_cast<char*>(base), bytes});
+    }
+
+    bool getRemoteKey(const void* address, size_t length, uint32_t* key) {
+        uint32_t region = findRegion(address, length);
+        if ((!remoteReads && !remoteWrites) || region == 0)
+            return false;
+        *key = region;
+        return true;
+    }
+
+    /**
+     * Returns 1 + the index in #registeredRegions of the region containing
+     * a range of memory, or 0 if there is no such region. This is used as
+     * the key for accessing the region remotely.
+     */
+    uint32_t findRegion(const void* address, size_t length) {
+        const char* start = static_cast<const char*>(address);
+        for (size_t i = 0; i < registeredRegions.size(); i++) {
+            const char* base = registeredRegions[i].first;
+            if (start >= base &&
+                    start + length <= base + registeredRegions[i].second)
+                return downCast<uint32_t>(i + 1);
+        }
+        return 0;
+    }
+
     struct BindServerRpc : public ServerRpc {
         BindServerRpc() {}
         void sendReply() {}
@@ -105,6 +167,27 @@ struct BindTransport : public Transport {
 
         void abort() {}
         void cancelRequest(RpcNotifier* notifier) {}
+        bool readRemote(uint64_t remoteAddress, uint32_t remoteKey,
+                        uint32_t length, void* dest)
+        {
+            // Servers share our address space, so a remote read is a copy.
+            const void* source = reinterpret_cast<const void*>(remoteAddress);
+            if (!transport.remoteReads || remoteKey == 0 ||
+                    transport.findRegion(source, length) != remoteKey)
+                return false;
+            memcpy(dest, source, length);
+            return true;
+        }
+        bool writeRemote(uint64_t remoteAddress, uint32_t remoteKey,
+                         Buffer* source, uint32_t offset, uint32_t length)
+        {
+            void* dest = reinterpret_cast<void*>(remoteAddress);
+            if (!transport.remoteWrites || remoteKey == 0 ||
+                    transport.findRegion(dest, length) != remoteKey)
+                return false;
+            source->copy(offset, length, dest);
+            return true;
+        }
         string getRpcInfo()
         {
             if (lastNotifier == NULL)
@@ -143,7 +226,13 @@ struct BindTransport : public Transport {
                 transport.errorMessage = "";
                 return;
             }
+            if (transport.rpcModel != NULL)
+                transport.rpcModel->startRpc(serviceLocator, request);
             Service::handleRpc(context, &rpc);
+            if (transport.rpcModel != NULL) {
+                transport.rpcModel->finishRpc(serviceLocator, request,
+                        response);
+            }
 
             if (!dontNotify) {
                 notifier->completed();
@@ -196,6 +285,18 @@ struct BindTransport : public Transport {
      */
     ServerRpcPool<ServerRpc> serverRpcPool;
 
+    /// Base and size of each region passed to registerMemory.
+    std::vector<std::pair<char*, size_t>> registeredRegions;
+
+    /// If true, sessions support Session::readRemote of registered memory.
+    bool remoteReads;
+
+    /// If true, sessions support Session::writeRemote of registered memory.
+    bool remoteWrites;
+
+    /// If non-NULL, told about every RPC delivered (see RpcModel).
+    RpcModel* rpcModel;
+
     DISALLOW_COPY_AND_ASSIGN(BindTransport);
 };
 
@@ -13,13 +13,38 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <pthread.h>
+
 #include "Buffer.h"
 #include "Memory.h"
+#include "PerfStats.h"
+#include "SpinLock.h"
 #include "Syscall.h"
 
 namespace RAMCloud {
 
 uint32_t Buffer::allocationLogThreshold = 4000;
+__thread Buffer::FreeList Buffer::threadPools[Buffer::NUM_POOLS];
+
+/// See Buffer::getSharedPool.
+struct Buffer::SharedPool {
+    SharedPool()
+        : mutex("Buffer::SharedPool")
+        , lists()
+    {}
+
+    /// Protects lists.
+    SpinLock mutex;
+
+    /// Free blocks, one list for each pool.
+    FreeList lists[NUM_POOLS];
+};
+
+/// Used to return the blocks in a thread's pools when the thread exits;
+/// see Buffer::registerThreadPools.
+static pthread_key_t threadPoolKey;
+static pthread_once_t threadPoolKeyOnce = PTHREAD_ONCE_INIT;
+static __thread bool threadPoolsRegistered = false;
 
 /**
  * Default object used to make system calls.
@@ -43,7 +68,7 @@ Buffer::Buffer()
     , cursorChunk(NULL)
     , cursorOffset(~0)
     , extraAppendBytes(0)
-    , allocations()
+    , allocations(NULL)
     , availableLength(sizeof32(internalAllocation) - PREPEND_SPACE)
     , firstAvailable(reinterpret_cast<char*>(internalAllocation)
             + PREPEND_SPACE)
@@ -472,8 +497,10 @@ Buffer::getNewAllocation(uint32_t bytesNeeded, uint32_t* bytesAllocated)
     // allocated for the buffer.
     bytesNeeded += sizeof32(internalAllocation) + totalAllocatedBytes;
     bytesNeeded = (bytesNeeded+7) & ~0x7;
-    char* newAllocation = static_cast<char*>(Memory::xmalloc(HERE,
-            bytesNeeded));
+    Allocation* allocation = allocateBlock(bytesNeeded + sizeof32(Allocation));
+    allocation->next = allocations;
+    allocations = allocation;
+    char* newAllocation = reinterpret_cast<char*>(allocation + 1);
     totalAllocatedBytes += bytesNeeded;
     if (totalAllocatedBytes >= Buffer::allocationLogThreshold) {
         RAMCLOUD_LOG(NOTICE, "buffer has consumed %u bytes of extra storage, "
@@ -481,14 +508,145 @@ Buffer::getNewAllocation(uint32_t bytesNeeded, uint32_t* bytesAllocated)
                 totalAllocatedBytes, bytesNeeded);
         Buffer::allocationLogThreshold = 2*totalAllocatedBytes;
     }
-    if (!allocations) {
-        allocations.construct();
-    }
-    allocations->push_back(newAllocation);
     *bytesAllocated = bytesNeeded;
     return newAllocation;
 }
 
+/**
+ * Obtain a block of storage for getNewAllocation: from the current
+ * thread's pool for blocks of that size if possible, then from the
+ * shared pool, and only then from malloc. In steady state this means
+ * that large requests and replies don't call malloc at all.
+ *
+ * \param bytes
+ *      Minimum size of the block, including its Allocation header.
+ * \return
+ *      The new block; its pool field has been filled in.
+ */
+Buffer::Allocation*
+Buffer::allocateBlock(uint32_t bytes)
+{
+    PerfStats::threadStats.bufferAllocations++;
+    uint32_t pool = 0;
+    while ((pool < NUM_POOLS) && ((1u << (MIN_POOL_SHIFT + pool)) < bytes))
+        pool++;
+    Allocation* allocation = NULL;
+    if (pool < NUM_POOLS) {
+        bytes = 1u << (MIN_POOL_SHIFT + pool);
+        FreeList* list = &threadPools[pool];
+        if (list->head == NULL) {
+            // Blocks of this size are freed on a different thread than
+            // the one that needs them (e.g. replies are built by workers
+            // and released by the dispatch thread); see if any have been
+            // passed back through the shared pool.
+            SharedPool* shared = getSharedPool();
+            SpinLock::Guard _(shared->mutex);
+            list = &shared->lists[pool];
+            allocation = list->head;
+            if (allocation != NULL) {
+                list->head = allocation->next;
+                list->count--;
+            }
+        } else {
+            allocation = list->head;
+            list->head = allocation->next;
+            list->count--;
+        }
+    }
+    if (allocation == NULL) {
+        PerfStats::threadStats.bufferMallocs++;
+        allocation = static_cast<Allocation*>(Memory::xmalloc(HERE, bytes));
+        allocation->pool = pool;
+    }
+    return allocation;
+}
+
+/**
+ * Returns the pool of free blocks shared by all threads. It is created on
+ * first use (Buffers are used by static initializers) and never destroyed
+ * (Buffers are also destroyed by static destructors).
+ */
+Buffer::SharedPool*
+Buffer::getSharedPool()
+{
+    static SharedPool* pool = new SharedPool();
+    return pool;
+}
+
+/**
+ * Arrange for the blocks in the current thread's pools to be released
+ * when the thread exits.
+ */
+void
+Buffer::registerThreadPools()
+{
+    struct Creator {
+        static void createKey()
+        {
+            pthread_key_create(&threadPoolKey, &Buffer::releaseThreadPools);
+        }
+    };
+    pthread_once(&threadPoolKeyOnce, &Creator::createKey);
+    // The key's destructor only runs if the value is non-NULL.
+    pthread_setspecific(threadPoolKey, &threadPoolsRegistered);
+    threadPoolsRegistered = true;
+}
+
+/**
+ * Return a block obtained from allocateBlock: to the current thread's pool
+ * if it has room, else to the shared pool if it has room, else to malloc.
+ *
+ * \param allocation
+ *      The block; it must no longer be in use.
+ */
+void
+Buffer::releaseAllocation(Allocation* allocation)
+{
+    uint32_t pool = allocation->pool;
+    if (pool < NUM_POOLS) {
+        FreeList* list = &threadPools[pool];
+        if (list->count < (THREAD_POOL_BYTES >> (MIN_POOL_SHIFT + pool))) {
+            if (expect_false(!threadPoolsRegistered))
+                registerThreadPools();
+            allocation->next = list->head;
+            list->head = allocation;
+            list->count++;
+            return;
+        }
+        SharedPool* shared = getSharedPool();
+        SpinLock::Guard _(shared->mutex);
+        list = &shared->lists[pool];
+        if (list->count < (SHARED_POOL_BYTES >> (MIN_POOL_SHIFT + pool))) {
+            allocation->next = list->head;
+            list->head = allocation;
+            list->count++;
+            return;
+        }
+    }
+    free(allocation);
+}
+
+/**
+ * Invoked when a thread that has pooled blocks exits: frees all of them.
+ *
+ * \param unused
+ *      Value associated with threadPoolKey; not used.
+ */
+void
+Buffer::releaseThreadPools(void* unused)
+{
+    for (uint32_t pool = 0; pool < NUM_POOLS; pool++) {
+        FreeList* list = &threadPools[pool];
+        while (list->head != NULL) {
+            Allocation* allocation = list->head;
+            list->head = allocation->next;
+            free(allocation);
+        }
+        list->count = 0;
+    }
+    threadPoolsRegistered = false;
+}
+
 /**
  * Return the number of discontiguous chunks of storage used by the buffer.
  */
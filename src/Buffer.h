@@ -37,7 +37,8 @@ class Syscall;
  *
  * In some cases, the storage for chunks is managed internally by the
  * buffer (about 1KB of storage is available automatically, and additional
- * storage will be malloc-ed if needed). Methods such as alloc, allocAux,
+ * storage comes from per-thread pools of free blocks, falling back to
+ * malloc if they are empty). Methods such as alloc, allocAux,
  * emplaceAppend, emplacePrepend, and appendCopy use internal storage.
  *
  * In other cases, the storage for chunks is provided from outside the
@@ -278,7 +279,50 @@ class Buffer {
     uint32_t write(uint32_t offset, uint32_t length, FILE* f);
 
   PRIVATE:
+    /**
+     * Each block of storage obtained by getNewAllocation starts with
+     * one of these; it links the blocks of a Buffer so that reset can
+     * release them, and it links free blocks in the pools.
+     */
+    struct Allocation {
+        /// Next block of the same Buffer, or of the same free list.
+        Allocation* next;
+
+        /// Index of the pool that the block belongs to, or NUM_POOLS if
+        /// it was too large to be pooled.
+        uint32_t pool;
+
+        /// Keeps the storage after the header 8-byte aligned.
+        uint32_t padding;
+    };
+
+    /// Free blocks of one size.
+    struct FreeList {
+        Allocation* head;
+        uint32_t count;
+    };
+
+    /// Free blocks shared by all threads; see releaseAllocation.
+    struct SharedPool;
+
+    /// Blocks (including their Allocation headers) of 2^MIN_POOL_SHIFT,
+    /// 2^(MIN_POOL_SHIFT+1), ... bytes are recycled through NUM_POOLS
+    /// pools; larger blocks are always malloc-ed and freed.
+    static const uint32_t MIN_POOL_SHIFT = 10;
+    static const uint32_t NUM_POOLS = 9;
+
+    /// Each thread keeps at most this many bytes of free blocks of each
+    /// size; beyond that, free blocks go to the shared pool, which keeps
+    /// at most SHARED_POOL_BYTES of each size.
+    static const uint32_t THREAD_POOL_BYTES = 256*1024;
+    static const uint32_t SHARED_POOL_BYTES = 1024*1024;
+
+    static Allocation* allocateBlock(uint32_t bytes);
     char* getNewAllocation(uint32_t bytesNeeded, uint32_t* bytesAllocated);
+    static SharedPool* getSharedPool();
+    static void registerThreadPools();
+    static void releaseAllocation(Allocation* allocation);
+    static void releaseThreadPools(void* unused);
 
     /**
      * This method implements both the destructor and the reset method.
@@ -301,18 +345,17 @@ class Buffer {
             current = next;
         }
 
-        // Free any malloc-ed memory.
-        if (allocations) {
-            for (uint32_t i = 0; i < allocations->size(); i++) {
-                free((*allocations)[i]);
-            }
-            if (isReset) {
-                allocations->clear();
-            }
+        // Give back any extra storage.
+        Allocation* allocation = allocations;
+        while (allocation != NULL) {
+            Allocation* next = allocation->next;
+            releaseAllocation(allocation);
+            allocation = next;
         }
 
         // Reset state.
         if (isReset) {
+            allocations = NULL;
             totalLength = 0;
             firstChunk = lastChunk = cursorChunk = NULL;
             cursorOffset = ~0;
@@ -355,10 +398,9 @@ class Buffer {
     /// part of the buffer, e.g. to service alloc and allocAux requests.
 
     /// If we must dynamically allocate space, this variable keeps
-    /// track of all the allocations so they can be freed by reset. This is
-    /// a Tub so that we don't have to construct and destroy the vector
-    /// unless it is actually used (which is fairly rare).
-    Tub<std::vector<void*>> allocations;
+    /// track of all the allocations (most recent first) so they can be
+    /// released by reset; NULL if there are none.
+    Allocation* allocations;
 
     /// In some situations we have extra storage space available that
     /// isn't part of a Chunk. When this happens, the variables below
@@ -379,6 +421,9 @@ class Buffer {
     /// value gets doubled.
     static uint32_t allocationLogThreshold;
 
+    /// Free blocks cached by the current thread, one list for each pool.
+    static __thread FreeList threadPools[NUM_POOLS];
+
     /// This variable provides some initial storage for the Buffer's use;
     /// by including this directly as part of the Buffer, we can usually
     /// get by without having to call malloc, which is expensive. The first
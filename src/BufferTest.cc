@@ -20,6 +20,7 @@
 #include "Buffer.h"
 #include "Logger.h"
 #include "MockSyscall.h"
+#include "PerfStats.h"
 
 namespace RAMCloud {
 
@@ -77,6 +78,18 @@ class BufferTest: public ::testing::Test {
         return bigData;
     }
 
+    /// Returns the number of extra allocations made by a Buffer.
+    uint32_t
+    countAllocations(Buffer* buffer)
+    {
+        uint32_t count = 0;
+        for (Buffer::Allocation* allocation = buffer->allocations;
+                allocation != NULL; allocation = allocation->next) {
+            count++;
+        }
+        return count;
+    }
+
     void openFile() {
         strncpy(fileName, "/tmp/ramcloud-buffer-test-delete-this-XXXXXX",
                 sizeof(fileName));
@@ -200,8 +213,7 @@ TEST_F(BufferTest, alloc_allocateNewSpace) {
     buffer.availableLength = 200;
     buffer.alloc(400 - sizeof32(Buffer::Chunk));
     EXPECT_EQ(1000u, buffer.extraAppendBytes);
-    EXPECT_TRUE(buffer.allocations);
-    EXPECT_EQ(1u, buffer.allocations->size());
+    EXPECT_EQ(1u, countAllocations(&buffer));
 }
 TEST_F(BufferTest, alloc_checkChunkLinks) {
     // Allocate three chunks: 1st and 3rd with new, 2nd with appendChunk.
@@ -478,8 +490,7 @@ TEST_F(BufferTest, getNewAllocation) {
     EXPECT_TRUE(result != NULL);
     EXPECT_EQ(1200u, actualLength);
     EXPECT_EQ(1200u, buffer.totalAllocatedBytes);
-    EXPECT_TRUE(buffer.allocations);
-    EXPECT_EQ(1u, buffer.allocations->size());
+    EXPECT_EQ(1u, countAllocations(&buffer));
     EXPECT_EQ("", TestLog::get());
 
     // Second allocation: check for log message about threshold.
@@ -487,13 +498,73 @@ TEST_F(BufferTest, getNewAllocation) {
     EXPECT_TRUE(result != NULL);
     EXPECT_EQ(2800u, actualLength);
     EXPECT_EQ(4000u, buffer.totalAllocatedBytes);
-    EXPECT_EQ(2u, buffer.allocations->size());
+    EXPECT_EQ(2u, countAllocations(&buffer));
     EXPECT_EQ("getNewAllocation: buffer has consumed 4000 bytes of "
             "extra storage, current allocation: 2800 bytes",
             TestLog::get());
     EXPECT_EQ(8000u, Buffer::allocationLogThreshold);
 }
 
+TEST_F(BufferTest, allocateBlock_pools) {
+    Buffer::releaseThreadPools(NULL);
+    PerfStats::threadStats.bufferAllocations = 0;
+    PerfStats::threadStats.bufferMallocs = 0;
+
+    // Sizes are rounded up to the next pool.
+    Buffer::Allocation* block = Buffer::allocateBlock(1500);
+    EXPECT_EQ(1u, block->pool);
+    EXPECT_EQ(1u, PerfStats::threadStats.bufferMallocs);
+    Buffer::releaseAllocation(block);
+    EXPECT_EQ(1u, Buffer::threadPools[1].count);
+
+    // A freed block is reused, without calling malloc.
+    Buffer::Allocation* block2 = Buffer::allocateBlock(2048);
+    EXPECT_EQ(block, block2);
+    EXPECT_EQ(0u, Buffer::threadPools[1].count);
+    EXPECT_EQ(2u, PerfStats::threadStats.bufferAllocations);
+    EXPECT_EQ(1u, PerfStats::threadStats.bufferMallocs);
+    Buffer::releaseAllocation(block2);
+
+    // Blocks larger than the largest pool aren't pooled.
+    block = Buffer::allocateBlock(1u << 20);
+    EXPECT_EQ(static_cast<uint32_t>(Buffer::NUM_POOLS), block->pool);
+    Buffer::releaseAllocation(block);
+    Buffer::releaseThreadPools(NULL);
+    EXPECT_EQ(0u, Buffer::threadPools[1].count);
+}
+
+TEST_F(BufferTest, releaseAllocation_sharedPool) {
+    Buffer::releaseThreadPools(NULL);
+
+    // The largest pool holds only one block per thread; the next one
+    // goes to the shared pool, and is found there when the thread's
+    // pool is empty.
+    uint32_t pool = Buffer::NUM_POOLS - 1;
+    uint32_t bytes = 1u << (Buffer::MIN_POOL_SHIFT + pool);
+    Buffer::Allocation* block1 = Buffer::allocateBlock(bytes);
+    Buffer::Allocation* block2 = Buffer::allocateBlock(bytes);
+    Buffer::releaseAllocation(block1);
+    Buffer::releaseAllocation(block2);
+    EXPECT_EQ(1u, Buffer::threadPools[pool].count);
+    EXPECT_EQ(block1, Buffer::allocateBlock(bytes));
+    PerfStats::threadStats.bufferMallocs = 0;
+    EXPECT_EQ(block2, Buffer::allocateBlock(bytes));
+    EXPECT_EQ(0u, PerfStats::threadStats.bufferMallocs);
+    Buffer::releaseAllocation(block1);
+    Buffer::releaseAllocation(block2);
+    Buffer::releaseThreadPools(NULL);
+}
+
+TEST_F(BufferTest, resetInternal_reusesAllocations) {
+    Buffer buffer;
+    buffer.alloc(1500);
+    Buffer::Allocation* first = buffer.allocations;
+    buffer.reset();
+    EXPECT_TRUE(buffer.allocations == NULL);
+    buffer.alloc(1500);
+    EXPECT_EQ(first, buffer.allocations);
+}
+
 TEST_F(BufferTest, getNumberChunks) {
     Buffer buffer;
     EXPECT_EQ(0u, buffer.getNumberChunks());
@@ -987,7 +1058,7 @@ TEST_F(BufferTest, resetInternal_partial) {
     buffer->alloc(1500);
     buffer->alloc(3000);
     buffer->appendChunk(&chunk2);
-    EXPECT_EQ(2u, buffer->allocations->size());
+    EXPECT_EQ(2u, countAllocations(buffer));
     buffer->cursorChunk = buffer->firstChunk;
     buffer->cursorOffset = 6;
     TestLog::reset();
@@ -996,7 +1067,7 @@ TEST_F(BufferTest, resetInternal_partial) {
             "~TestChunk: Destroyed chunk containing '0123'",
             TestLog::get());
     EXPECT_EQ(4510u, buffer->totalLength);
-    EXPECT_EQ(2u, buffer->allocations->size());
+    EXPECT_TRUE(buffer->allocations != NULL);
 }
 
 TEST_F(BufferTest, resetInternal_full) {
@@ -1007,7 +1078,7 @@ TEST_F(BufferTest, resetInternal_full) {
     buffer.alloc(1500);
     buffer.alloc(3000);
     buffer.appendChunk(&chunk2);
-    EXPECT_EQ(2u, buffer.allocations->size());
+    EXPECT_EQ(2u, countAllocations(&buffer));
     buffer.cursorChunk = buffer.firstChunk;
     buffer.cursorOffset = 6;
     TestLog::reset();
@@ -1022,7 +1093,7 @@ TEST_F(BufferTest, resetInternal_full) {
     EXPECT_EQ(nullChunk, buffer.cursorChunk);
     EXPECT_EQ(~0u, buffer.cursorOffset);
     EXPECT_EQ(0u, buffer.extraAppendBytes);
-    EXPECT_EQ(0u, buffer.allocations->size());
+    EXPECT_EQ(0u, countAllocations(&buffer));
     EXPECT_EQ(900u, buffer.availableLength);
     EXPECT_EQ(100u, buffer.firstAvailable - INTERNAL_ALLOC);
     EXPECT_EQ(0u, buffer.totalAllocatedBytes);
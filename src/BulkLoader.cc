@@ -0,0 +1,292 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "BulkLoader.h"
+#include "ClientException.h"
+#include "FrameCompression.h"
+#include "Object.h"
+#include "ObjectFinder.h"
+#include "RamCloud.h"
+#include "SegmentIterator.h"
+#include "WallTime.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a BulkLoader; objects are only sent to masters as segments fill
+ * up or when flush() is called.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this loader.
+ * \param tableId
+ *      Table to load objects into.
+ * \param maxOutstanding
+ *      Upper limit on the number of segments being loaded at once; once it
+ *      is reached, add() waits for the oldest of them to finish.
+ * \param compress
+ *      True means each segment is compressed before it is sent (if that
+ *      makes it smaller); worthwhile when the network is the bottleneck,
+ *      such as between datacenters.
+ */
+BulkLoader::BulkLoader(RamCloud* ramcloud, uint64_t tableId,
+        uint32_t maxOutstanding, bool compress)
+    : ramcloud(ramcloud)
+    , tableId(tableId)
+    , maxOutstanding(std::max(maxOutstanding, 1u))
+    , compress(compress)
+    , loadedBytes(0)
+    , sentBytes(0)
+    , openBatches()
+    , sentBatches()
+{
+}
+
+/**
+ * Destructor for BulkLoader. Objects that haven't been loaded by a call to
+ * flush() are discarded, and may or may not end up in the table.
+ */
+BulkLoader::~BulkLoader()
+{
+    for (auto& entry : openBatches)
+        delete entry.second;
+    foreach (Batch* batch, sentBatches)
+        delete batch;
+}
+
+/**
+ * Add an object to the table. The object may not have been loaded yet when
+ * this method returns; call flush() to make sure it has.
+ *
+ * \param key
+ *      Primary key for the object; it does not necessarily have to be null
+ *      terminated.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param value
+ *      Address of the object's value.
+ * \param valueLength
+ *      Size in bytes of the value.
+ *
+ * \throw RequestTooLargeException
+ *      The object is too large to fit in a segment.
+ */
+void
+BulkLoader::add(const void* key, uint16_t keyLength, const void* value,
+        uint32_t valueLength)
+{
+    Key objectKey(tableId, key, keyLength);
+    Buffer keysAndValue;
+    Object object(objectKey, value, valueLength, LOADED_VERSION,
+            WallTime::secondsTimestamp(), keysAndValue);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    append(LOG_ENTRY_TYPE_OBJ, objectKey.getHash(), buffer);
+}
+
+/**
+ * Add an entry that is already in log format, such as one copied from
+ * another master's log. Unlike objects passed to add(), objects keep their
+ * version: an object replaces any older version of the same key, and a
+ * tombstone deletes it. Entries older than the ones already in the table
+ * are ignored, so adding an entry twice is harmless.
+ *
+ * \param type
+ *      LOG_ENTRY_TYPE_OBJ, LOG_ENTRY_TYPE_OBJTOMB or LOG_ENTRY_TYPE_OBJDELTA.
+ * \param entry
+ *      The entry, in log format. Its table id must be the one given to the
+ *      constructor (see Object::changeTableId()).
+ *
+ * \throw RequestTooLargeException
+ *      The entry is too large to fit in a segment.
+ */
+void
+BulkLoader::addEntry(LogEntryType type, Buffer& entry)
+{
+    append(type, Key(type, entry).getHash(), entry);
+}
+
+/**
+ * Load every object added so far, and wait until all of them are durable.
+ */
+void
+BulkLoader::flush()
+{
+    // Finishing a batch may put objects back in open batches (see
+    // finishOldest), so keep going until both lists are empty.
+    while (!openBatches.empty() || !sentBatches.empty()) {
+        if (openBatches.empty()) {
+            finishOldest();
+            continue;
+        }
+        Batch* batch = openBatches.begin()->second;
+        openBatches.erase(openBatches.begin());
+        send(batch);
+    }
+}
+
+/**
+ * Add an entry to the batch for the tablet it currently belongs to,
+ * sending the batch first if it is full.
+ *
+ * \param type
+ *      Type of the entry.
+ * \param keyHash
+ *      Hash of the entry's primary key.
+ * \param entry
+ *      The entry, in log format.
+ */
+void
+BulkLoader::append(LogEntryType type, uint64_t keyHash, Buffer& entry)
+{
+    while (true) {
+        uint64_t startKeyHash = ramcloud->clientContext->objectFinder->
+                lookupTablet(tableId, keyHash)->tablet.startKeyHash;
+        Batch*& batch = openBatches[startKeyHash];
+        if (batch == NULL)
+            batch = new Batch(keyHash);
+        if (batch->segment.append(type, entry))
+            return;
+        Batch* fullBatch = batch;
+        openBatches.erase(startKeyHash);
+        if (fullBatch->segment.getAppendedLength() == 0) {
+            delete fullBatch;
+            throw RequestTooLargeException(HERE);
+        }
+
+        // Sending may wait for older batches and move their entries to
+        // other batches, so look up this entry's batch again afterwards.
+        send(fullBatch);
+    }
+}
+
+/**
+ * Wait for the oldest outstanding BULK_LOAD RPC to finish. If the master
+ * rejected it because it no longer owns all of the entries (e.g. the tablet
+ * was split or migrated), the entries are added again according to the
+ * (refreshed) tablet map.
+ */
+void
+BulkLoader::finishOldest()
+{
+    std::unique_ptr<Batch> batch(sentBatches.front());
+    sentBatches.pop_front();
+    if (batch->rpc->wait()) {
+        loadedBytes += batch->rpc->segmentBytes;
+        sentBytes += batch->rpc->sentBytes;
+        return;
+    }
+    for (SegmentIterator it(batch->segment); !it.isDone(); it.next()) {
+        Buffer buffer;
+        it.appendToBuffer(buffer);
+        append(it.getType(), Key(it.getType(), buffer).getHash(), buffer);
+    }
+}
+
+/**
+ * Start loading a batch, first waiting for older batches if there are
+ * already too many outstanding. Takes ownership of \a batch.
+ */
+void
+BulkLoader::send(Batch* batch)
+{
+    batch->segment.close();
+    while (sentBatches.size() >= maxOutstanding)
+        finishOldest();
+    batch->rpc.construct(ramcloud, tableId, batch->keyHash, &batch->segment,
+            compress);
+    sentBatches.push_back(batch);
+}
+
+/**
+ * Constructor for BulkLoadRpc: asks the master that owns \a keyHash to load
+ * all of the entries in \a segment, and returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      Table that all of the entries in \a segment belong to.
+ * \param keyHash
+ *      Identifies the tablet (and hence the master) that all of the entries
+ *      in \a segment belong to.
+ * \param segment
+ *      Entries to load: objects, tombstones and object deltas. It must not
+ *      change or go away until the RPC has completed.
+ * \param compress
+ *      True means the segment is sent compressed with FrameCompression,
+ *      unless that wouldn't make it any smaller.
+ */
+BulkLoadRpc::BulkLoadRpc(RamCloud* ramcloud, uint64_t tableId,
+        uint64_t keyHash, Segment* segment, bool compress)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, keyHash,
+            sizeof(WireFormat::BulkLoad::Response))
+    , segmentBytes(0)
+    , sentBytes(0)
+{
+    WireFormat::BulkLoad::Request* reqHdr(
+            allocHeader<WireFormat::BulkLoad>());
+    reqHdr->tableId = tableId;
+    segmentBytes = segment->getAppendedLength(&reqHdr->certificate);
+    reqHdr->segmentBytes = segmentBytes;
+    if (compress) {
+        Buffer contents;
+        segment->appendToBuffer(contents);
+        uint32_t headerBytes = request.size();
+        void* frame = request.alloc(segmentBytes);
+        sentBytes = downCast<uint32_t>(FrameCompression::compress(
+                contents.getRange(0, segmentBytes), segmentBytes,
+                frame, segmentBytes));
+        request.truncate(headerBytes + sentBytes);
+    }
+    if (sentBytes == 0)
+        sentBytes = segment->appendToBuffer(request);
+    send();
+}
+
+// See RpcWrapper for documentation.
+bool
+BulkLoadRpc::checkStatus()
+{
+    // Don't retry: the segment may span tablets that no longer live on one
+    // master. Refresh the tablet map so the caller can sort the entries out
+    // again.
+    if (responseHeader->status == STATUS_UNKNOWN_TABLET)
+        context->objectFinder->flush(tableId);
+    return true;
+}
+
+/**
+ * Wait for a BULK_LOAD RPC to complete.
+ *
+ * \return
+ *      True if the entries were loaded. False if the master didn't own all
+ *      of them; in that case none were loaded.
+ *
+ * \throw ClientException
+ *      The master rejected the segment for any other reason.
+ */
+bool
+BulkLoadRpc::wait()
+{
+    waitInternal(context->dispatch);
+    if (responseHeader->status == STATUS_UNKNOWN_TABLET)
+        return false;
+    if (responseHeader->status != STATUS_OK)
+        ClientException::throwException(HERE, responseHeader->status);
+    return true;
+}
+
+} // namespace RAMCloud
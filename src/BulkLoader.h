@@ -0,0 +1,162 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_BULKLOADER_H
+#define RAMCLOUD_BULKLOADER_H
+
+#include <deque>
+#include <map>
+
+#include "ObjectRpcWrapper.h"
+#include "Segment.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+class RamCloud;
+
+/**
+ * Sends one segment of entries built by a BulkLoader to the master that
+ * owns them, optionally compressed. Unlike other ObjectRpcWrappers, this RPC
+ * is not retried if the master doesn't own all of the entries: the tablet
+ * map may have changed since the segment was built, so the caller has to
+ * sort its entries out again (see wait()).
+ */
+class BulkLoadRpc : public ObjectRpcWrapper {
+  public:
+    BulkLoadRpc(RamCloud* ramcloud, uint64_t tableId, uint64_t keyHash,
+            Segment* segment, bool compress = false);
+    ~BulkLoadRpc() {}
+    bool wait();
+
+    /// Bytes of segment data carried by this RPC, before compression.
+    uint32_t segmentBytes;
+
+    /// Bytes of segment data actually sent, after compression.
+    uint32_t sentBytes;
+
+  PROTECTED:
+    virtual bool checkStatus();
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(BulkLoadRpc);
+};
+
+/**
+ * Loads large numbers of new objects into a table much faster than writing
+ * them one at a time. Objects are packed into segments on the client, one
+ * per tablet, and each full segment is handed to its master in a single
+ * BULK_LOAD RPC, which replays it the same way migrated data is replayed:
+ * the objects bypass the normal write path and are replicated a segment at
+ * a time.
+ *
+ * Bulk loading is meant for filling tables that aren't yet in use:
+ * - A loaded object never replaces an existing object with the same key.
+ * - Secondary indexes aren't updated.
+ * - An object may become readable shortly before its master has made it
+ *   durable; objects are only guaranteed to be durable once flush() has
+ *   returned.
+ *
+ * A loader can also apply changes copied from another log (see
+ * addEntry(), used by GeoReplicator): objects keep their versions and
+ * replace older versions of the same key, and tombstones delete them,
+ * exactly as when a crashed master's log is replayed during recovery.
+ *
+ * Each tablet being loaded holds an 8 MB segment on the client until it
+ * fills up or flush() is called. This class is not thread-safe.
+ */
+class BulkLoader {
+  PUBLIC:
+    BulkLoader(RamCloud* ramcloud, uint64_t tableId,
+            uint32_t maxOutstanding = 4, bool compress = false);
+    ~BulkLoader();
+    void add(const void* key, uint16_t keyLength, const void* value,
+            uint32_t valueLength);
+    void addEntry(LogEntryType type, Buffer& entry);
+    void flush();
+
+    /// Bytes of log entries loaded so far, counting only segments whose
+    /// BULK_LOAD has completed.
+    uint64_t getLoadedBytes() const { return loadedBytes; }
+
+    /// Bytes actually sent for the segments counted by getLoadedBytes();
+    /// smaller if the segments were compressed.
+    uint64_t getSentBytes() const { return sentBytes; }
+
+    /// Version number given to all loaded objects.
+    static const uint64_t LOADED_VERSION = 1;
+
+  PRIVATE:
+    /**
+     * Entries headed for a single tablet, and the RPC that carries them
+     * once the segment holding them is full.
+     */
+    struct Batch {
+        explicit Batch(uint64_t keyHash)
+            : segment()
+            , keyHash(keyHash)
+            , rpc()
+        {}
+
+        /// Entries to be loaded, in log format.
+        Segment segment;
+
+        /// Hash of one of the keys in #segment; used to find the master
+        /// to send it to.
+        uint64_t keyHash;
+
+        /// Carries #segment once it has been sent.
+        Tub<BulkLoadRpc> rpc;
+
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+    };
+
+    void append(LogEntryType type, uint64_t keyHash, Buffer& entry);
+    void finishOldest();
+    void send(Batch* batch);
+
+    /// Overall client state information.
+    RamCloud* ramcloud;
+
+    /// Table that objects are loaded into.
+    uint64_t tableId;
+
+    /// Upper limit on the number of BULK_LOAD RPCs outstanding at once.
+    uint32_t maxOutstanding;
+
+    /// True means segments are compressed before they are sent, which
+    /// trades client and master CPU time for network bandwidth.
+    bool compress;
+
+    /// See getLoadedBytes().
+    uint64_t loadedBytes;
+
+    /// See getSentBytes().
+    uint64_t sentBytes;
+
+    /// Batches still being filled, keyed by the first key hash of the
+    /// tablet they belong to.
+    std::map<uint64_t, Batch*> openBatches;
+
+    /// Batches that have been sent but not yet acknowledged, oldest first.
+    std::deque<Batch*> sentBatches;
+
+    DISALLOW_COPY_AND_ASSIGN(BulkLoader);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_BULKLOADER_H
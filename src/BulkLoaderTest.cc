@@ -0,0 +1,211 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "BulkLoader.h"
+#include "ClientException.h"
+#include "MockCluster.h"
+#include "Object.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class BulkLoaderTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    ServerConfig masterConfig;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+
+    BulkLoaderTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , masterConfig(ServerConfig::forTesting())
+        , ramcloud()
+        , tableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        masterConfig.services = {WireFormat::MASTER_SERVICE,
+                                 WireFormat::ADMIN_SERVICE};
+        masterConfig.master.numReplicas = 0;
+        masterConfig.localLocator = "mock:host=master1";
+        cluster.addServer(masterConfig);
+        ramcloud.construct(&context, "mock:host=coordinator");
+
+        tableId = ramcloud->createTable("table1");
+    }
+
+    /// Returns the value of an object, followed by its version.
+    string
+    read(const char* key)
+    {
+        Buffer value;
+        uint64_t version;
+        ramcloud->read(tableId, key, downCast<uint16_t>(strlen(key)),
+                &value, NULL, &version);
+        return format("%s v%lu", TestUtil::toString(&value).c_str(),
+                version);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(BulkLoaderTest);
+};
+
+TEST_F(BulkLoaderTest, add_flush) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    loader.add("object1", 7, "value1", 6);
+    loader.add("object2", 7, "value2", 6);
+    EXPECT_EQ(1u, loader.openBatches.size());
+    EXPECT_EQ(0u, loader.sentBatches.size());
+    EXPECT_THROW(read("object1"), ObjectDoesntExistException);
+
+    loader.flush();
+    EXPECT_EQ(0u, loader.openBatches.size());
+    EXPECT_EQ(0u, loader.sentBatches.size());
+    EXPECT_EQ("value1 v1", read("object1"));
+    EXPECT_EQ("value2 v1", read("object2"));
+}
+
+TEST_F(BulkLoaderTest, add_existingObjectWins) {
+    ramcloud->write(tableId, "object1", 7, "old");
+    BulkLoader loader(ramcloud.get(), tableId);
+    loader.add("object1", 7, "new", 3);
+    loader.flush();
+    EXPECT_EQ("old v1", read("object1"));
+
+    // Versions keep increasing after a loaded object is removed.
+    loader.add("object2", 7, "value2", 6);
+    loader.flush();
+    ramcloud->remove(tableId, "object2", 7);
+    ramcloud->write(tableId, "object2", 7, "again");
+    Buffer value;
+    uint64_t version;
+    ramcloud->read(tableId, "object2", 7, &value, NULL, &version);
+    EXPECT_GT(version, static_cast<uint64_t>(BulkLoader::LOADED_VERSION));
+}
+
+TEST_F(BulkLoaderTest, addEntry) {
+    ramcloud->write(tableId, "object1", 7, "old");
+    ramcloud->write(tableId, "object2", 7, "old");
+    BulkLoader loader(ramcloud.get(), tableId);
+
+    // Entries from another log keep their versions: a newer object
+    // replaces the current one, and a newer tombstone deletes it.
+    Key key1(tableId, "object1", 7);
+    Buffer keysAndValue;
+    Object object(key1, "new", 3, 100, 0, keysAndValue);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    loader.addEntry(LOG_ENTRY_TYPE_OBJ, buffer);
+
+    Key key2(tableId, "object2", 7);
+    Buffer keysAndValue2;
+    Object object2(key2, "dead", 4, 100, 0, keysAndValue2);
+    ObjectTombstone tombstone(object2, 0, 0);
+    Buffer tombstoneBuffer;
+    tombstone.assembleForLog(tombstoneBuffer);
+    loader.addEntry(LOG_ENTRY_TYPE_OBJTOMB, tombstoneBuffer);
+    loader.flush();
+
+    EXPECT_EQ("new v100", read("object1"));
+    EXPECT_THROW(read("object2"), ObjectDoesntExistException);
+    EXPECT_GT(loader.getLoadedBytes(), 0u);
+    EXPECT_EQ(loader.getLoadedBytes(), loader.getSentBytes());
+}
+
+TEST_F(BulkLoaderTest, add_compressed) {
+    BulkLoader loader(ramcloud.get(), tableId, 4, true);
+    string value(100000, 'x');
+    loader.add("object1", 7, value.c_str(), downCast<uint32_t>(value.size()));
+    loader.flush();
+    Buffer buffer;
+    ramcloud->read(tableId, "object1", 7, &buffer);
+    EXPECT_EQ(value, TestUtil::toString(&buffer));
+    EXPECT_LT(loader.getSentBytes() * 10, loader.getLoadedBytes());
+}
+
+TEST_F(BulkLoaderTest, append_segmentFull) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    string value(Segment::DEFAULT_SEGMENT_SIZE / 4, 'x');
+    for (int i = 0; i < 4; i++) {
+        string key = format("object%d", i);
+        loader.add(key.c_str(), downCast<uint16_t>(key.size()),
+                value.c_str(), downCast<uint32_t>(value.size()));
+    }
+    EXPECT_EQ(1u, loader.openBatches.size());
+    EXPECT_EQ(1u, loader.sentBatches.size());
+
+    loader.flush();
+    for (int i = 0; i < 4; i++) {
+        string key = format("object%d", i);
+        Buffer buffer;
+        ramcloud->read(tableId, key.c_str(), downCast<uint16_t>(key.size()),
+                &buffer);
+        EXPECT_EQ(value.size(), buffer.size());
+    }
+}
+
+TEST_F(BulkLoaderTest, append_objectTooLarge) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    string value(Segment::DEFAULT_SEGMENT_SIZE, 'x');
+    EXPECT_THROW(loader.add("object1", 7, value.c_str(),
+            downCast<uint32_t>(value.size())), RequestTooLargeException);
+    EXPECT_EQ(0u, loader.openBatches.size());
+    EXPECT_EQ(0u, loader.sentBatches.size());
+}
+
+TEST_F(BulkLoaderTest, finishOldest_tabletMoved) {
+    BulkLoader loader(ramcloud.get(), tableId);
+    loader.add("object1", 7, "value1", 6);
+    loader.add("object2", 7, "value2", 6);
+    EXPECT_EQ(1u, loader.openBatches.size());
+
+    // Move one of the objects' key hashes to another master, so that the
+    // batch (built for a single tablet) spans two masters.
+    ServerConfig master2Config = masterConfig;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+    uint64_t hash1 = Key(tableId, "object1", 7).getHash();
+    uint64_t hash2 = Key(tableId, "object2", 7).getHash();
+    uint64_t splitKeyHash = std::max(hash1, hash2);
+    ramcloud->splitTablet("table1", splitKeyHash);
+    ramcloud->migrateTablet(tableId, splitKeyHash, ~0UL, master2->serverId);
+
+    loader.flush();
+    EXPECT_EQ("value1 v1", read("object1"));
+    EXPECT_EQ("value2 v1", read("object2"));
+}
+
+TEST_F(BulkLoaderTest, bulkLoadRpc_wrongTable) {
+    // Masters refuse objects from other tables than the one named in the
+    // request.
+    Segment segment;
+    Key key(tableId + 1, "object1", 7);
+    Buffer keysAndValue;
+    Object object(key, "value1", 6, 1, 0, keysAndValue);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    segment.append(LOG_ENTRY_TYPE_OBJ, buffer);
+
+    BulkLoadRpc rpc(ramcloud.get(), tableId,
+            Key(tableId, "object1", 7).getHash(), &segment);
+    EXPECT_THROW(rpc.wait(), RequestFormatError);
+}
+
+}  // namespace RAMCloud
@@ -55,6 +55,27 @@ struct rc_multiReadHelper {
     DISALLOW_COPY_AND_ASSIGN(rc_multiReadHelper);
 };
 
+/**
+ * An asynchronous read or write started by rc_readAsync or rc_writeAsync;
+ * C callers see only a pointer to it.
+ */
+struct rc_asyncOp {
+    rc_asyncOp(void* buf, uint32_t maxLength)
+        : readRpc()
+        , writeRpc()
+        , value()
+        , buf(buf)
+        , maxLength(maxLength)
+        {}
+    Tub<ReadRpc> readRpc;    ///< The RPC, for reads.
+    Tub<WriteRpc> writeRpc;  ///< The RPC, for writes.
+    Buffer value;   ///< The value of a read object, before it is copied
+    void *buf;      ///< Where the caller wants the value of a read object
+    uint32_t maxLength;   ///< The size of the buffer *buf in bytes
+
+    DISALLOW_COPY_AND_ASSIGN(rc_asyncOp);
+};
+
 /**
  * Create a new client connection to a RAMCloud cluster.
  *
@@ -471,6 +492,212 @@ rc_write(struct rc_client* client, uint64_t tableId,
     return STATUS_OK;
 }
 
+// Asynchronous calls let a C user keep many requests outstanding at once.
+// rc_readAsync and rc_writeAsync start a request and return a handle for
+// it; rc_poll runs the client's event loop, rc_isReady says whether a
+// request has completed, and rc_wait (which must be called exactly once
+// for each handle) returns its result and frees the handle.
+
+/**
+ * Start reading an object, without waiting for the result.
+ *
+ * \param client
+ *      Handle for the RAMCloud connection.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId. It must not change until rc_wait is called.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ * \param buf
+ *      rc_wait copies the contents of the object here, straight from the
+ *      response; it must stay valid until then.
+ * \param maxLength
+ *      Number of bytes of space available at buf: if the object is
+ *      larger than this that only this many bytes will be copied to
+ *      buf.
+ * \param[out] op
+ *      If the return value is STATUS_OK, a handle for the read is returned
+ *      here; it must be passed to rc_wait.
+ *
+ * \return
+ *      0 means the read was started, anything else indicates an error.
+ */
+Status
+rc_readAsync(struct rc_client* client, uint64_t tableId,
+        const void* key, uint16_t keyLength,
+        const struct RejectRules* rejectRules,
+        void* buf, uint32_t maxLength, struct rc_asyncOp** op)
+{
+    *op = NULL;
+    rc_asyncOp* newOp = new rc_asyncOp(buf, maxLength);
+    try {
+        newOp->readRpc.construct(client->client, tableId, key, keyLength,
+                &newOp->value, rejectRules);
+    } catch (ClientException& e) {
+        delete newOp;
+        return e.status;
+    }
+    catch (std::exception& e) {
+        delete newOp;
+        RAMCLOUD_LOG(ERROR, "An unhandled C++ Exception occurred: %s",
+                e.what());
+        return STATUS_INTERNAL_ERROR;
+    } catch (...) {
+        delete newOp;
+        RAMCLOUD_LOG(ERROR, "An unknown, unhandled C++ Exception occurred");
+        return STATUS_INTERNAL_ERROR;
+    }
+    *op = newOp;
+    return STATUS_OK;
+}
+
+/**
+ * Start writing an object, without waiting for the result.
+ *
+ * \param client
+ *      Handle for the RAMCloud connection.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId. It must not change until rc_wait is called.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      The new contents for the object; sent from here without being
+ *      copied first, so it must not change until rc_wait is called.
+ * \param length
+ *      Size in bytes of the new contents.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the write
+ *      should be aborted with an error.
+ * \param[out] op
+ *      If the return value is STATUS_OK, a handle for the write is returned
+ *      here; it must be passed to rc_wait.
+ *
+ * \return
+ *      0 means the write was started, anything else indicates an error.
+ */
+Status
+rc_writeAsync(struct rc_client* client, uint64_t tableId,
+        const void* key, uint16_t keyLength,
+        const void* buf, uint32_t length,
+        const struct RejectRules* rejectRules, struct rc_asyncOp** op)
+{
+    *op = NULL;
+    rc_asyncOp* newOp = new rc_asyncOp(NULL, 0);
+    try {
+        newOp->writeRpc.construct(client->client, tableId, key, keyLength,
+                buf, length, rejectRules);
+    } catch (ClientException& e) {
+        delete newOp;
+        return e.status;
+    }
+    catch (std::exception& e) {
+        delete newOp;
+        RAMCLOUD_LOG(ERROR, "An unhandled C++ Exception occurred: %s",
+                e.what());
+        return STATUS_INTERNAL_ERROR;
+    } catch (...) {
+        delete newOp;
+        RAMCLOUD_LOG(ERROR, "An unknown, unhandled C++ Exception occurred");
+        return STATUS_INTERNAL_ERROR;
+    }
+    *op = newOp;
+    return STATUS_OK;
+}
+
+/**
+ * Returns nonzero once an asynchronous read or write has completed, so
+ * that rc_wait will return without blocking. This doesn't itself wait for
+ * network events; call rc_poll for that.
+ *
+ * \param op
+ *      Handle returned by rc_readAsync or rc_writeAsync.
+ */
+int
+rc_isReady(struct rc_asyncOp* op)
+{
+    try {
+        return op->readRpc ? op->readRpc->isReady() : op->writeRpc->isReady();
+    } catch (...) {
+        // rc_wait will report the error.
+        return 1;
+    }
+}
+
+/**
+ * Wait for an asynchronous read or write to complete and return its
+ * result; this frees the handle.
+ *
+ * \param op
+ *      Handle returned by rc_readAsync or rc_writeAsync. It must not be
+ *      used again after this function returns.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] actualLength
+ *      If non-NULL, the total size of a read object is stored here; this
+ *      may be larger than the maxLength given to rc_readAsync. 0 for
+ *      writes.
+ *
+ * \return
+ *      0 means success, anything else indicates an error.
+ */
+Status
+rc_wait(struct rc_asyncOp* op, uint64_t* version, uint32_t* actualLength)
+{
+    Status status = STATUS_OK;
+    if (actualLength != NULL)
+        *actualLength = 0;
+    try {
+        if (op->readRpc) {
+            op->readRpc->wait(version);
+            if (actualLength != NULL)
+                *actualLength = op->value.size();
+            uint32_t bytesToCopy = op->value.size();
+            if (bytesToCopy > op->maxLength) {
+                bytesToCopy = op->maxLength;
+            }
+            op->value.copy(0, bytesToCopy, op->buf);
+        } else {
+            op->writeRpc->wait(version);
+        }
+    } catch (ClientException& e) {
+        status = e.status;
+    }
+    catch (std::exception& e) {
+        RAMCLOUD_LOG(ERROR, "An unhandled C++ Exception occurred: %s",
+                e.what());
+        status = STATUS_INTERNAL_ERROR;
+    } catch (...) {
+        RAMCLOUD_LOG(ERROR, "An unknown, unhandled C++ Exception occurred");
+        status = STATUS_INTERNAL_ERROR;
+    }
+    delete op;
+    return status;
+}
+
+/**
+ * Check for network events and make progress on outstanding asynchronous
+ * requests. Callers that keep requests outstanding with rc_readAsync and
+ * rc_writeAsync should call this whenever they have nothing else to do.
+ *
+ * \param client
+ *      Handle for the RAMCloud connection.
+ */
+void
+rc_poll(struct rc_client* client)
+{
+    client->client->poll();
+}
+
 // Multi-op calls require three steps from the C user.  A first bunch of calls
 // constructs the C++ Multi{Read,Write,Remove}Object objects, the second
 // step issues the multi-op RPC, and in a last step a bunch of calls destructs
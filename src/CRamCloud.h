@@ -34,6 +34,7 @@ using namespace RAMCloud;
 struct RamCloud;
 struct rc_client;
 #endif
+struct rc_asyncOp;
 
 typedef enum MultiOp {
   MULTI_OP_INCREMENT = 0,
@@ -93,6 +94,21 @@ Status    rc_write(struct rc_client* client, uint64_t tableId,
                              const struct RejectRules* rejectRules,
                              uint64_t* version);
 
+Status    rc_readAsync(struct rc_client* client, uint64_t tableId,
+                       const void* key, uint16_t keyLength,
+                       const struct RejectRules* rejectRules,
+                       void* buf, uint32_t maxLength,
+                       struct rc_asyncOp** op);
+Status    rc_writeAsync(struct rc_client* client, uint64_t tableId,
+                        const void* key, uint16_t keyLength,
+                        const void* buf, uint32_t length,
+                        const struct RejectRules* rejectRules,
+                        struct rc_asyncOp** op);
+int       rc_isReady(struct rc_asyncOp* op);
+Status    rc_wait(struct rc_asyncOp* op, uint64_t* version,
+                  uint32_t* actualLength);
+void      rc_poll(struct rc_client* client);
+
 void      rc_multiIncrementCreate(uint64_t tableId,
                                   const void *key, uint16_t keyLength,
                                   int64_t incrementInt64,
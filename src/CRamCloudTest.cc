@@ -467,6 +467,56 @@ TEST_F(CRamCloudTest, rc_write_TableDoesntExist) {
     EXPECT_EQ(status, STATUS_TABLE_DOESNT_EXIST);
 }
 
+TEST_F(CRamCloudTest, rc_async_basics) {
+    rc_asyncOp* writes[2];
+    std::string value2("defg");
+    status = rc_writeAsync(client, tableId1, key.data(), keyLength,
+                           value.data(), valueLength, NULL, &writes[0]);
+    EXPECT_EQ(STATUS_OK, status);
+    status = rc_writeAsync(client, tableId1, "key2", 4,
+                           value2.data(), 4, NULL, &writes[1]);
+    EXPECT_EQ(STATUS_OK, status);
+    uint64_t version = 0;
+    uint32_t actualLength = 99;
+    for (int i = 0; i < 1000 && !rc_isReady(writes[1]); i++)
+        rc_poll(client);
+    EXPECT_EQ(STATUS_OK, rc_wait(writes[1], &version, &actualLength));
+    EXPECT_GT(version, 0u);
+    EXPECT_EQ(0u, actualLength);
+    EXPECT_EQ(STATUS_OK, rc_wait(writes[0], NULL, NULL));
+
+    char buf1[10], buf2[2];
+    rc_asyncOp* read1;
+    rc_asyncOp* read2;
+    EXPECT_EQ(STATUS_OK, rc_readAsync(client, tableId1, key.data(),
+                                      keyLength, NULL, buf1, sizeof(buf1),
+                                      &read1));
+    EXPECT_EQ(STATUS_OK, rc_readAsync(client, tableId1, "key2", 4, NULL,
+                                      buf2, sizeof(buf2), &read2));
+    uint64_t version2 = 0;
+    EXPECT_EQ(STATUS_OK, rc_wait(read2, &version2, &actualLength));
+    EXPECT_EQ(version, version2);
+    EXPECT_EQ(4u, actualLength);
+    EXPECT_EQ("de", std::string(buf2, 2));
+    EXPECT_EQ(STATUS_OK, rc_wait(read1, NULL, &actualLength));
+    EXPECT_EQ(value, std::string(buf1, actualLength));
+}
+
+TEST_F(CRamCloudTest, rc_async_errors) {
+    char buf;
+    uint32_t actualLength = 99;
+    rc_asyncOp* op;
+    EXPECT_EQ(STATUS_OK, rc_readAsync(client, tableId1, "0", 1, NULL, &buf, 1,
+                                      &op));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, rc_wait(op, NULL, &actualLength));
+    EXPECT_EQ(0u, actualLength);
+
+    EXPECT_EQ(STATUS_OK, rc_writeAsync(client, 101, "0", 1, "x", 1, NULL,
+                                       &op));
+    EXPECT_TRUE(rc_isReady(op));
+    EXPECT_EQ(STATUS_TABLE_DOESNT_EXIST, rc_wait(op, NULL, NULL));
+}
+
 TEST_F(CRamCloudTest, rc_multiIncrement) {
     unsigned char *mIncrementObjects = reinterpret_cast<unsigned char *>
         (malloc(numMultiOps * szMultiOpIncrement));
@@ -92,13 +92,20 @@ CleanableSegmentManager::getSegmentToCompact()
     SpinLock::Guard guard(lock);
     update(guard);
 
-    if (compactionCandidates.empty())
+    // Compacting a segment on flash wouldn't free any memory.
+    LogSegment* segment = NULL;
+    foreach (LogSegment& candidate, compactionCandidates) {
+        if (!candidate.onFlash) {
+            segment = &candidate;
+            break;
+        }
+    }
+    if (segment == NULL)
         return NULL;
 
-    LogSegment& segment = *compactionCandidates.begin();
-    eraseFromAll(&segment, guard);
+    eraseFromAll(segment, guard);
     segmentsToCleaner++;
-    return &segment;
+    return segment;
 }
 
 void
@@ -258,6 +265,10 @@ CleanableSegmentManager::update(const SpinLock::Guard& guard)
  * getSegmentToCompact() methods return better candidates. Otherwise, we would
  * not know which tombstones are dead.
  *
+ * Candidates whose tombstones were all summarized by an earlier scan are
+ * rechecked from their summaries instead, and several of them may be handled
+ * before a segment is actually scanned.
+ *
  * Note that this method will drop the monitor lock while scanning the segment
  * to avoid holding up other threads. While being scanned, the segment will not
  * be present in the costBenefitCandidate nor in the compactionCandidate trees.
@@ -268,10 +279,24 @@ CleanableSegmentManager::scanSegmentTombstones(const SpinLock::Guard& guard)
 {
     if (SCAN_TOMBSTONES_EVERY_N_SEGMENTS == 0)
         return;
+
+    for (int i = 0; i < MAX_SUMMARY_RECHECKS_PER_SCAN; i++) {
+        if (tombstoneScanCandidates.empty())
+            return;
+        LogSegment& s = *tombstoneScanCandidates.begin();
+        if (!s.tombstoneSummaryComplete)
+            break;
+        eraseFromAll(&s, guard);
+        countDeadTombstones(&s);
+        insertInAll(&s, guard);
+    }
+
     if (tombstoneScans > (segmentsToCleaner / SCAN_TOMBSTONES_EVERY_N_SEGMENTS))
         return;
     if (tombstoneScanCandidates.empty())
         return;
+    if (tombstoneScanCandidates.begin()->tombstoneSummaryComplete)
+        return;
 
     tombstoneScans++;
 
@@ -282,11 +307,29 @@ CleanableSegmentManager::scanSegmentTombstones(const SpinLock::Guard& guard)
     eraseFromAll(&s, guard);
     lock.unlock();
 
+    summarizeSegmentTombstones(&s);
+    countDeadTombstones(&s);
+
+    lock.lock();
+    insertInAll(&s, guard);
+}
+
+/**
+ * Iterate over a segment's tombstones and record which segments they point
+ * into in LogSegment::tombstoneTargets, replacing any earlier summary.
+ *
+ * \param s
+ *      The segment to summarize. It must not be in any of the candidate
+ *      trees, since the monitor lock need not be held.
+ */
+void
+CleanableSegmentManager::summarizeSegmentTombstones(LogSegment* s)
+{
+    std::map<uint64_t, LogSegment::TombstoneTarget> targets;
+    bool complete = true;
     uint32_t tombstonesScanned = 0;
-    uint32_t deadTombstones = 0;
-    uint32_t deadTombstoneLengths = 0;
-    uint32_t totalTombstones = s.entryCounts[LOG_ENTRY_TYPE_OBJTOMB];
-    for (SegmentIterator it(s); !it.isDone(); it.next()) {
+    uint32_t totalTombstones = s->entryCounts[LOG_ENTRY_TYPE_OBJTOMB];
+    for (SegmentIterator it(*s); !it.isDone(); it.next()) {
         // Bail out early if we've seen all of the tombstones. If the LogCleaner
         // compacts segments with tombstones at the front we can avoid looking
         // at most of the segment.
@@ -305,26 +348,71 @@ CleanableSegmentManager::scanSegmentTombstones(const SpinLock::Guard& guard)
         // references are removed asynchronously.
         Key key(tomb.getTableId(), tomb.getKey(), tomb.getKeyLength());
         if (context->getMasterService()->objectManager.keyPointsAtReference(
-                key, s.getReference(it.getOffset())))
+                key, s->getReference(it.getOffset()))) {
+            complete = false;
             continue;
-        if (!segmentManager.doesIdExist(tomb.getSegmentId())) {
-            deadTombstones++;
-            // Magic constant indicates the likely full length
-            // in the log. Should add a static method to Segment that computes
-            // this properly.
-            deadTombstoneLengths += it.getLength() + 2;
         }
+
+        uint64_t segmentId = tomb.getSegmentId();
+        std::map<uint64_t, LogSegment::TombstoneTarget>::iterator target =
+            targets.find(segmentId);
+        if (target == targets.end()) {
+            target = targets.insert(std::make_pair(segmentId,
+                LogSegment::TombstoneTarget(segmentId, 0, 0))).first;
+        }
+        target->second.count++;
+        // Magic constant indicates the likely full length
+        // in the log. Should add a static method to Segment that computes
+        // this properly.
+        target->second.length += it.getLength() + 2;
     }
 
-    s.deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB] = deadTombstones;
-    s.deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB] = deadTombstoneLengths;
-    s.cachedCleaningCostBenefitScore = computeCleaningCostBenefitScore(&s);
-    s.cachedCompactionCostBenefitScore = computeCompactionCostBenefitScore(&s);
-    s.cachedTombstoneScanScore = computeTombstoneScanScore(&s);
-    s.lastTombstoneScanTimestamp = WallTime::secondsTimestamp();
+    s->tombstoneTargets.clear();
+    s->tombstoneTargets.reserve(targets.size());
+    std::map<uint64_t, LogSegment::TombstoneTarget>::iterator it;
+    for (it = targets.begin(); it != targets.end(); it++)
+        s->tombstoneTargets.push_back(it->second);
+    s->tombstoneSummaryComplete = complete;
 
-    lock.lock();
-    insertInAll(&s, guard);
+    // Tombstones already known to be dead are in the new summary again.
+    s->deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB] = 0;
+    s->deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB] = 0;
+}
+
+/**
+ * Update the dead tombstone statistics and cached scores of a segment from
+ * its tombstone summary: tombstones are dead once the segment they point into
+ * has been freed. Targets found to be gone are counted and then dropped from
+ * the summary, since segment ids are never reused. Also resets the time since
+ * the segment was last scanned.
+ *
+ * \param s
+ *      The segment to update. It must not be in any of the candidate trees.
+ */
+void
+CleanableSegmentManager::countDeadTombstones(LogSegment* s)
+{
+    uint32_t deadTombstones = s->deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB];
+    uint32_t deadTombstoneLengths = s->deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB];
+
+    size_t live = 0;
+    for (size_t i = 0; i < s->tombstoneTargets.size(); i++) {
+        LogSegment::TombstoneTarget& target = s->tombstoneTargets[i];
+        if (segmentManager.doesIdExist(target.segmentId)) {
+            s->tombstoneTargets[live++] = target;
+            continue;
+        }
+        deadTombstones += target.count;
+        deadTombstoneLengths += target.length;
+    }
+    s->tombstoneTargets.resize(live, LogSegment::TombstoneTarget(0, 0, 0));
+
+    s->deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB] = deadTombstones;
+    s->deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB] = deadTombstoneLengths;
+    s->cachedCleaningCostBenefitScore = computeCleaningCostBenefitScore(s);
+    s->cachedCompactionCostBenefitScore = computeCompactionCostBenefitScore(s);
+    s->lastTombstoneScanTimestamp = WallTime::secondsTimestamp();
+    s->cachedTombstoneScanScore = computeTombstoneScanScore(s);
 }
 
 /**
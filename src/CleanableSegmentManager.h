@@ -17,6 +17,7 @@
 #define RAMCLOUD_CLEANABLESEGMENTMANAGER_H
 
 #include <thread>
+#include <map>
 #include <vector>
 
 #include "Common.h"
@@ -82,6 +83,8 @@ class CleanableSegmentManager {
   PRIVATE:
     void update(const SpinLock::Guard& guard);
     void scanSegmentTombstones(const SpinLock::Guard& guard);
+    void summarizeSegmentTombstones(LogSegment* s);
+    void countDeadTombstones(LogSegment* s);
     uint64_t computeCleaningCostBenefitScore(LogSegment* s);
     uint64_t computeCompactionCostBenefitScore(LogSegment* s);
     uint64_t computeTombstoneScanScore(LogSegment* s);
@@ -115,6 +118,14 @@ class CleanableSegmentManager {
     /// performance in a number of benchmarks, and relatively low overhead).
     enum { SCAN_TOMBSTONES_EVERY_N_SEGMENTS = 5 };
 
+    /// Segments whose tombstones were all summarized by an earlier scan (see
+    /// LogSegment::tombstoneSummaryComplete) are rechecked from the summary,
+    /// which costs one segment id lookup per segment the tombstones point
+    /// into. Up to this many of them are rechecked each time
+    /// scanSegmentTombstones() is called, without counting against the
+    /// SCAN_TOMBSTONES_EVERY_N_SEGMENTS throttle.
+    enum { MAX_SUMMARY_RECHECKS_PER_SCAN = 10 };
+
     /// This context is used for reaching into the hash table to query the
     /// liveness of tombstones, because tombstones that are still referenced by
     /// the hash table cannot be safely cleaned.
@@ -152,4 +152,54 @@ TEST_F(CleanableSegmentManagerTest, update) {
               csm.toString());
 }
 
+TEST_F(CleanableSegmentManagerTest, scanSegmentTombstones_recheckSummaries) {
+    CleanableSegmentManager& csm = cleaner.cleanableSegments;
+    SpinLock::Guard guard(csm.lock);
+
+    for (int i = 0; i < 4; i++)
+        segmentManager.allocHeadSegment();
+    csm.update(guard);
+    ASSERT_EQ(3u, csm.tombstoneScanCandidates.size());
+
+    // Rechecking summaries doesn't wait for the scanning throttle.
+    csm.tombstoneScans = 1;
+    foreach (LogSegment& s, csm.tombstoneScanCandidates) {
+        s.tombstoneTargets.push_back(LogSegment::TombstoneTarget(2, 3, 90));
+        s.tombstoneTargets.push_back(LogSegment::TombstoneTarget(1000, 2, 70));
+        s.tombstoneSummaryComplete = true;
+    }
+    csm.scanSegmentTombstones(guard);
+
+    ASSERT_EQ(3u, csm.tombstoneScanCandidates.size());
+    foreach (LogSegment& s, csm.tombstoneScanCandidates) {
+        EXPECT_EQ(2u, s.deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB]);
+        EXPECT_EQ(70u, s.deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB]);
+        ASSERT_EQ(1u, s.tombstoneTargets.size());
+        EXPECT_EQ(2u, s.tombstoneTargets[0].segmentId);
+    }
+    EXPECT_EQ(1u, csm.tombstoneScans);
+}
+
+TEST_F(CleanableSegmentManagerTest, countDeadTombstones) {
+    CleanableSegmentManager& csm = cleaner.cleanableSegments;
+    LogSegment* s = segmentManager.allocHeadSegment();
+    s->deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB] = 1;
+    s->deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB] = 30;
+    s->lastTombstoneScanTimestamp = 0;
+    s->tombstoneTargets.push_back(LogSegment::TombstoneTarget(999, 4, 100));
+    s->tombstoneTargets.push_back(LogSegment::TombstoneTarget(s->id, 1, 25));
+    s->tombstoneTargets.push_back(LogSegment::TombstoneTarget(1000, 2, 60));
+
+    csm.countDeadTombstones(s);
+    EXPECT_EQ(7u, s->deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB]);
+    EXPECT_EQ(190u, s->deadEntryLengths[LOG_ENTRY_TYPE_OBJTOMB]);
+    ASSERT_EQ(1u, s->tombstoneTargets.size());
+    EXPECT_EQ(s->id, s->tombstoneTargets[0].segmentId);
+    EXPECT_NE(0u, s->lastTombstoneScanTimestamp);
+
+    // Targets already counted aren't counted again.
+    csm.countDeadTombstones(s);
+    EXPECT_EQ(7u, s->deadEntryCounts[LOG_ENTRY_TYPE_OBJTOMB]);
+}
+
 }  // namespace RAMCloud
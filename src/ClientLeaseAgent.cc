@@ -37,6 +37,21 @@ ClientLeaseAgent::ClientLeaseAgent(RamCloud* ramcloud)
     , renewLeaseRpc()
 {}
 
+/**
+ * Return an estimate of the current cluster-time (encoded): the timestamp of
+ * the latest lease plus the time that has passed since it was requested.
+ * Like getLease, this may block until a valid lease has been obtained.
+ */
+uint64_t
+ClientLeaseAgent::getClusterTime()
+{
+    getLease();
+    SpinLock::Guard _(mutex);
+    ClusterTimeDuration elapsed = ClusterTimeDuration::fromNanoseconds(
+            Cycles::toNanoseconds(Cycles::rdtsc() - lastRenewalTimeCycles));
+    return (ClusterTime(lease.timestamp) + elapsed).getEncoded();
+}
+
 /**
  * Return a valid client lease.  If a valid client lease has not been issued or
  * the lease is about to expire, this method will block until it is able to
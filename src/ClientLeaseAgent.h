@@ -36,6 +36,7 @@ class RamCloud;
 class ClientLeaseAgent {
   public:
     explicit ClientLeaseAgent(RamCloud* ramcloud);
+    uint64_t getClusterTime();
     WireFormat::ClientLease getLease();
     void poll();
 
@@ -50,6 +50,17 @@ class ClientLeaseAgentTest : public ::testing::Test {
     DISALLOW_COPY_AND_ASSIGN(ClientLeaseAgentTest);
 };
 
+TEST_F(ClientLeaseAgentTest, getClusterTime) {
+    leaseAgent.lastRenewalTimeCycles = Cycles::fromNanoseconds(1000000);
+    leaseAgent.leaseExpirationCycles = Cycles::fromNanoseconds(100000000);
+    Cycles::mockTscValue = Cycles::fromNanoseconds(6000000);
+    WireFormat::ClientLease l = {0, 90000000, 2000000};
+    leaseAgent.lease = l;
+    uint64_t time = leaseAgent.getClusterTime();
+    EXPECT_LE(6999000U, time);
+    EXPECT_GE(7001000U, time);
+}
+
 TEST_F(ClientLeaseAgentTest, getLease_basic) {
     leaseAgent.lastRenewalTimeCycles = 0;
     Cycles::mockTscValue = Cycles::fromNanoseconds(5000);
@@ -35,6 +35,15 @@ const uint64_t RESERVATION_LIMIT = 1000;
 /// small enough such that the reservation agent is constantly being run.
 const uint64_t RESERVATIONS_LOW = 250;
 
+/// Defines the number of leaseIds reserved by each external storage object.
+/// The expired leases of a block are tracked in a 64-bit mask, so this can't
+/// be more than 64.
+const uint64_t LEASE_BLOCK_SIZE = 64;
+
+/// Defines the largest number of expired leases the cleaner removes in one
+/// pass; each block touched by the pass costs one external storage write.
+const uint32_t CLEAN_BATCH_SIZE = 1000;
+
 /// Defines the prefix for objects stored in external storage by this module.
 const std::string STORAGE_PREFIX = "clientLeaseAuthority";
 
@@ -46,6 +55,7 @@ ClientLeaseAuthority::ClientLeaseAuthority(Context* context)
     , maxReservedLeaseId(0)
     , leaseMap()
     , expirationOrder()
+    , leaseBlocks()
     , reservationAgent(context, this)
     , cleaner(context, this)
 {}
@@ -95,31 +105,48 @@ ClientLeaseAuthority::recover()
     vector<ExternalStorage::Object> objects;
     context->externalStorage->getChildren(STORAGE_PREFIX.c_str(), &objects);
 
-    // We can safely make the approximation that every reserved lease was
-    // issued with the exception of the largest reserved leaseId.
     foreach (ExternalStorage::Object& object, objects) {
         try {
             std::string name = object.name;
-            uint64_t leaseId = std::stoull(name);
+            uint64_t firstId = std::stoull(name);
+
+            // Objects without a value were written before leaseIds were
+            // reserved in blocks, and each reserve a single leaseId.
+            LeaseBlock block = {1, 0};
+            if (object.length > 0) {
+                std::string value(object.value, object.length);
+                if (sscanf(value.c_str(), "%lu %lx", &block.size,
+                           &block.expired) != 2
+                        || block.size == 0
+                        || block.size > LEASE_BLOCK_SIZE) {
+                    LOG(ERROR, "Couldn't recover ClientLease block %lu "
+                            "because its value '%s' is malformed", firstId,
+                            value.c_str());
+                    continue;
+                }
+            }
+            leaseBlocks[firstId] = block;
+            maxReservedLeaseId = std::max(maxReservedLeaseId,
+                                          firstId + block.size - 1);
+        } catch (std::invalid_argument& e) {
+            LOG(ERROR, "Couldn't recover ClientLease because lease object name "
+                    "'%s' is not an integer", object.name);
+        }
+    }
 
-            // Keep track of the largest reserved leaseId and only auto "renew"
-            // the other leaseIds.
-            if (maxReservedLeaseId == 0) {
-                maxReservedLeaseId = leaseId;
+    // We can safely make the approximation that every reserved lease that
+    // hasn't expired was issued, with the exception of the largest reserved
+    // leaseId.
+    ClusterTime leaseExpiration = clock.getTime() + LeaseCommon::LEASE_TERM;
+    foreach (LeaseBlockMap::value_type& entry, leaseBlocks) {
+        for (uint64_t i = 0; i < entry.second.size; i++) {
+            uint64_t leaseId = entry.first + i;
+            if ((entry.second.expired & (1UL << i)) != 0
+                    || leaseId == maxReservedLeaseId) {
                 continue;
-            } else if (leaseId > maxReservedLeaseId) {
-                uint64_t temp = maxReservedLeaseId;
-                maxReservedLeaseId = leaseId;
-                leaseId = temp;
             }
-
-            ClusterTime leaseExpiration = clock.getTime() +
-                                          LeaseCommon::LEASE_TERM;
             leaseMap[leaseId] = leaseExpiration;
             expirationOrder.insert({leaseExpiration, leaseId});
-        } catch (std::invalid_argument& e) {
-            LOG(ERROR, "Couldn't recover ClientLease because lease object name "
-                    "'%s' is not an integer", object.name);
         }
     }
 
@@ -154,6 +181,35 @@ ClientLeaseAuthority::renewLease(uint64_t leaseId)
     return clientLease;
 }
 
+/**
+ * Renew a batch of leases with a single acquisition of the module's lock;
+ * used by agents that renew the leases of many clients at once. Each lease
+ * is handled as in "renewLease".
+ *
+ * \param count
+ *      Number of leases to renew.
+ * \param leaseIds
+ *      The leaseIds that clients wish to renew if possible; a leaseId of 0
+ *      requests a new lease.
+ * \param[out] leases
+ *      Array of at least count elements; leases[i] is set to the renewed or
+ *      new lease for leaseIds[i].
+ */
+void
+ClientLeaseAuthority::renewLeases(uint32_t count, const uint64_t* leaseIds,
+                                  WireFormat::ClientLease* leases)
+{
+    SpinLock::Guard lock(mutex);
+    for (uint32_t i = 0; i < count; i++) {
+        leases[i] = renewLeaseInternal(leaseIds[i], lock);
+    }
+
+    // Poke reservation agent if we are getting close to running out of leases.
+    if (maxReservedLeaseId - lastIssuedLeaseId < RESERVATIONS_LOW) {
+        reservationAgent.start(0);
+    }
+}
+
 /**
  * Start background timers to perform lease reservation and cleaning and also
  * start the cluster clock updater.
@@ -190,7 +246,7 @@ void
 ClientLeaseAuthority::LeaseReservationAgent::handleTimerEvent()
 {
     SpinLock::Guard lock(leaseAuthority->mutex);
-    leaseAuthority->reserveNextLease(lock);
+    leaseAuthority->reserveLeaseBlock(lock);
     uint64_t reservationCount = leaseAuthority->maxReservedLeaseId -
                                 leaseAuthority->lastIssuedLeaseId;
     if (reservationCount < RESERVATION_LIMIT) {
@@ -219,7 +275,7 @@ ClientLeaseAuthority::LeaseCleaner::LeaseCleaner(Context* context,
 void
 ClientLeaseAuthority::LeaseCleaner::handleTimerEvent()
 {
-    if (leaseAuthority->cleanNextLease()) {
+    if (leaseAuthority->cleanExpiredLeases()) {
         // Cleaning pass not complete; reschedule for immediate execution.
         this->start(0);
     } else {
@@ -233,26 +289,75 @@ ClientLeaseAuthority::LeaseCleaner::handleTimerEvent()
 }
 
 /**
- * Expire the next lease whose term has elapsed. If the term of the next lease
- * to be expired has not yet elapsed, this call has no effect.
+ * Expire a batch of leases whose terms have elapsed, updating the external
+ * storage object of each block they belong to once. If the term of the next
+ * lease to be expired has not yet elapsed, this call has no effect.
  *
  * \return
- *      Return true if a lease was able to be cleaned.  Returning false implies
- *      there are no more leases that can be cleaned at this moment.
+ *      Return true if a full batch of leases was cleaned, so more leases may
+ *      be ready for cleaning.  Returning false implies there are no more
+ *      leases that can be cleaned at this moment.
  */
 bool
-ClientLeaseAuthority::cleanNextLease()
+ClientLeaseAuthority::cleanExpiredLeases()
 {
     SpinLock::Guard _(mutex);
-    ExpirationOrderSet::iterator it = expirationOrder.begin();
-    if (it != expirationOrder.end() && it->leaseExpiration < clock.getTime()) {
-        uint64_t leaseId = it->leaseId;
+    ClusterTime now = clock.getTime();
+    ExpirationOrderSet::iterator end = expirationOrder.begin();
+    std::set<uint64_t> touchedBlocks;
+    uint32_t count = 0;
+    for (; end != expirationOrder.end() && end->leaseExpiration < now &&
+            count < CLEAN_BATCH_SIZE; ++end, ++count) {
+        uint64_t leaseId = end->leaseId;
+        LeaseBlockMap::iterator block = leaseBlocks.upper_bound(leaseId);
+        if (block != leaseBlocks.begin()) {
+            --block;
+            if (leaseId - block->first < block->second.size) {
+                block->second.expired |= 1UL << (leaseId - block->first);
+                touchedBlocks.insert(block->first);
+                continue;
+            }
+        }
+
+        // Not part of any known block; the lease has its own object.
         context->externalStorage->remove(getLeaseObjName(leaseId).c_str());
-        expirationOrder.erase(it);
-        leaseMap.erase(leaseId);
-        return true;
     }
-    return false;
+
+    // The expirations must be durable before the leases are dropped here;
+    // otherwise a recovered coordinator could revive leases that servers
+    // already considered expired.
+    foreach (uint64_t firstId, touchedBlocks) {
+        LeaseBlock& block = leaseBlocks[firstId];
+        uint64_t allExpired = (block.size == 64) ? ~0UL
+                                                 : (1UL << block.size) - 1;
+        if (block.expired == allExpired) {
+            context->externalStorage->remove(getLeaseObjName(firstId).c_str());
+            leaseBlocks.erase(firstId);
+        } else {
+            std::string value = getBlockValue(block);
+            context->externalStorage->set(ExternalStorage::Hint::UPDATE,
+                                          getLeaseObjName(firstId).c_str(),
+                                          value.c_str(),
+                                          downCast<int>(value.length()));
+        }
+    }
+
+    for (ExpirationOrderSet::iterator it = expirationOrder.begin();
+            it != end; ++it) {
+        leaseMap.erase(it->leaseId);
+    }
+    expirationOrder.erase(expirationOrder.begin(), end);
+    return count == CLEAN_BATCH_SIZE;
+}
+
+/**
+ * Return the value of the external storage object that describes the given
+ * block of leases.
+ */
+std::string
+ClientLeaseAuthority::getBlockValue(const LeaseBlock& block)
+{
+    return format("%lu %lx", block.size, block.expired);
 }
 
 /**
@@ -300,7 +405,7 @@ ClientLeaseAuthority::renewLeaseInternal(uint64_t leaseId,
             RAMCLOUD_LOG(WARNING,
                          "Lease reservations are not keeping up; "
                          "maxReservedLeaseId = %lu", maxReservedLeaseId);
-            reserveNextLease(lock);
+            reserveLeaseBlock(lock);
         }
     }
 
@@ -315,19 +420,23 @@ ClientLeaseAuthority::renewLeaseInternal(uint64_t leaseId,
 }
 
 /**
- * Persist the next available leaseId to external storage.
+ * Persist the next block of available leaseIds to external storage.
  *
  * \param lock
  *      Ensures that caller has acquired mutex; not actually used here.
  */
 void
-ClientLeaseAuthority::reserveNextLease(const SpinLock::Guard& lock)
+ClientLeaseAuthority::reserveLeaseBlock(const SpinLock::Guard& lock)
 {
-    uint64_t nextLeaseId = maxReservedLeaseId + 1;
+    uint64_t firstId = maxReservedLeaseId + 1;
+    LeaseBlock block = {LEASE_BLOCK_SIZE, 0};
+    std::string value = getBlockValue(block);
     context->externalStorage->set(ExternalStorage::Hint::CREATE,
-                                  getLeaseObjName(nextLeaseId).c_str(),
-                                  "", 0);
-    maxReservedLeaseId = nextLeaseId;
+                                  getLeaseObjName(firstId).c_str(),
+                                  value.c_str(),
+                                  downCast<int>(value.length()));
+    leaseBlocks[firstId] = block;
+    maxReservedLeaseId = firstId + LEASE_BLOCK_SIZE - 1;
 }
 
 } // namespace RAMCloud
@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_CLIENTLEASEAUTHORITY_H
 #define RAMCLOUD_CLIENTLEASEAUTHORITY_H
 
+#include <map>
 #include <set>
 #include <unordered_map>
 
@@ -36,6 +37,12 @@ namespace RAMCloud {
  * module (this is managed by the ClientLeaseAgent).  Servers in their part must
  * contact this module to check the validity of client leases. This module
  * ensures that no leaseId will be issued more than once.
+ *
+ * LeaseIds are reserved on external storage in blocks of LEASE_BLOCK_SIZE
+ * consecutive ids, one object per block, and the object of a block records
+ * which of its leases have expired. This keeps the external storage traffic
+ * (and the number of objects there) proportional to the number of blocks
+ * rather than the number of clients.
  */
 class ClientLeaseAuthority {
   PUBLIC:
@@ -43,6 +50,8 @@ class ClientLeaseAuthority {
     WireFormat::ClientLease getLeaseInfo(uint64_t leaseId);
     void recover();
     WireFormat::ClientLease renewLease(uint64_t leaseId);
+    void renewLeases(uint32_t count, const uint64_t* leaseIds,
+                     WireFormat::ClientLease* leases);
     void startUpdaters();
 
   PRIVATE:
@@ -135,14 +144,36 @@ class ClientLeaseAuthority {
     typedef std::set<ExpirationOrderElem> ExpirationOrderSet;
     ExpirationOrderSet expirationOrder;
 
+    /**
+     * Describes a block of consecutive leaseIds that was reserved with a
+     * single external storage object. The object's name is derived from the
+     * first leaseId of the block and its value is the textual form of this
+     * structure (see getBlockValue).
+     */
+    struct LeaseBlock {
+        /// Number of leaseIds in the block, at most 64 (blocks recovered
+        /// from the one-object-per-lease format hold a single id).
+        uint64_t size;
+
+        /// Bit i is set once leaseId "first + i" has expired. The block's
+        /// object is removed once all of its leases have expired.
+        uint64_t expired;
+    };
+
+    /// Maps from the first leaseId of each block whose object exists on
+    /// external storage to the block's description.
+    typedef std::map<uint64_t, LeaseBlock> LeaseBlockMap;
+    LeaseBlockMap leaseBlocks;
+
     LeaseReservationAgent reservationAgent;
     LeaseCleaner cleaner;
 
-    bool cleanNextLease();
+    bool cleanExpiredLeases();
+    std::string getBlockValue(const LeaseBlock& block);
     std::string getLeaseObjName(uint64_t leaseId);
     WireFormat::ClientLease renewLeaseInternal(uint64_t leaseId,
                                                const SpinLock::Guard& lock);
-    void reserveNextLease(const SpinLock::Guard& lock);
+    void reserveLeaseBlock(const SpinLock::Guard& lock);
 
     DISALLOW_COPY_AND_ASSIGN(ClientLeaseAuthority);
 };
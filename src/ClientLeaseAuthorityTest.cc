@@ -98,6 +98,48 @@ TEST_F(ClientLeaseAuthorityTest, recover_basic) {
     EXPECT_EQ(700000UL, leaseAuthority->maxReservedLeaseId);
 }
 
+TEST_F(ClientLeaseAuthorityTest, recover_blocks) {
+    // Leases 1 and 3 of the first block have expired.
+    storage.getChildrenNames.push("1");
+    storage.getChildrenValues.push("64 5");
+    storage.getChildrenNames.push("65");
+    storage.getChildrenValues.push("64 0");
+
+    leaseAuthority->recover();
+
+    EXPECT_EQ(125U, leaseAuthority->leaseMap.size());
+    EXPECT_EQ(125U, leaseAuthority->expirationOrder.size());
+    EXPECT_TRUE(leaseAuthority->leaseMap.end() ==
+                leaseAuthority->leaseMap.find(1));
+    EXPECT_TRUE(leaseAuthority->leaseMap.end() !=
+                leaseAuthority->leaseMap.find(2));
+    EXPECT_TRUE(leaseAuthority->leaseMap.end() ==
+                leaseAuthority->leaseMap.find(3));
+    EXPECT_TRUE(leaseAuthority->leaseMap.end() !=
+                leaseAuthority->leaseMap.find(127));
+    EXPECT_TRUE(leaseAuthority->leaseMap.end() ==
+                leaseAuthority->leaseMap.find(128));
+    EXPECT_EQ(2U, leaseAuthority->leaseBlocks.size());
+    EXPECT_EQ(5UL, leaseAuthority->leaseBlocks[1].expired);
+    EXPECT_EQ(127UL, leaseAuthority->lastIssuedLeaseId);
+    EXPECT_EQ(128UL, leaseAuthority->maxReservedLeaseId);
+}
+
+TEST_F(ClientLeaseAuthorityTest, recover_badBlock) {
+    storage.getChildrenNames.push("1");
+    storage.getChildrenValues.push("junk");
+
+    TestLog::reset();
+
+    leaseAuthority->recover();
+
+    EXPECT_EQ("recover: Couldn't recover ClientLease block 1 because its "
+            "value 'junk' is malformed", TestLog::get());
+    EXPECT_EQ(0U, leaseAuthority->leaseMap.size());
+    EXPECT_EQ(0U, leaseAuthority->leaseBlocks.size());
+    EXPECT_EQ(0UL, leaseAuthority->maxReservedLeaseId);
+}
+
 TEST_F(ClientLeaseAuthorityTest, recover_empty) {
     EXPECT_EQ(0U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(0U, leaseAuthority->expirationOrder.size());
@@ -142,15 +184,33 @@ TEST_F(ClientLeaseAuthorityTest, renewLease) {
     EXPECT_TRUE(leaseAuthority->reservationAgent.isRunning());
 }
 
+TEST_F(ClientLeaseAuthorityTest, renewLeases) {
+    leaseAuthority->maxReservedLeaseId = 1000;
+    uint64_t leaseIds[3] = {0, 0, 1};
+    WireFormat::ClientLease leases[3];
+    leaseAuthority->renewLeases(3, leaseIds, leases);
+    EXPECT_EQ(1U, leases[0].leaseId);
+    EXPECT_EQ(2U, leases[1].leaseId);
+    EXPECT_EQ(1U, leases[2].leaseId);
+    EXPECT_EQ(2U, leaseAuthority->leaseMap.size());
+    EXPECT_EQ(2U, leaseAuthority->expirationOrder.size());
+    EXPECT_FALSE(leaseAuthority->reservationAgent.isRunning());
+
+    leaseAuthority->lastIssuedLeaseId = 900;
+    leaseAuthority->renewLeases(1, leaseIds, leases);
+    EXPECT_EQ(901U, leases[0].leaseId);
+    EXPECT_TRUE(leaseAuthority->reservationAgent.isRunning());
+}
+
 TEST_F(ClientLeaseAuthorityTest, leaseReservationAgent_handleTimerEvent) {
     EXPECT_EQ(0U, leaseAuthority->lastIssuedLeaseId);
     EXPECT_EQ(0U, leaseAuthority->maxReservedLeaseId);
     leaseAuthority->reservationAgent.handleTimerEvent();
     EXPECT_EQ(0U, leaseAuthority->lastIssuedLeaseId);
-    EXPECT_EQ(1U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(64U, leaseAuthority->maxReservedLeaseId);
     EXPECT_TRUE(leaseAuthority->reservationAgent.isRunning());
     leaseAuthority->reservationAgent.stop();
-    leaseAuthority->maxReservedLeaseId = 1000 - 1;
+    leaseAuthority->maxReservedLeaseId = 1000 - 64;
     leaseAuthority->reservationAgent.handleTimerEvent();
     EXPECT_EQ(0U, leaseAuthority->lastIssuedLeaseId);
     EXPECT_EQ(1000U, leaseAuthority->maxReservedLeaseId);
@@ -209,7 +269,7 @@ TEST_F(ClientLeaseAuthorityTest, expirationOrder) {
     EXPECT_TRUE(it == leaseAuthority->expirationOrder.end());
 }
 
-TEST_F(ClientLeaseAuthorityTest, cleanNextLease) {
+TEST_F(ClientLeaseAuthorityTest, cleanExpiredLeases) {
     // Time dependent test.
     leaseAuthority->leaseMap[25] = ClusterTime(0);
     leaseAuthority->expirationOrder.insert({ClusterTime(0), 25});
@@ -219,19 +279,15 @@ TEST_F(ClientLeaseAuthorityTest, cleanNextLease) {
     EXPECT_EQ(2U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(2U, leaseAuthority->expirationOrder.size());
 
+    // Leases outside of any block have their own objects.
     storage.log.clear();
-    EXPECT_TRUE(leaseAuthority->cleanNextLease());
-    EXPECT_EQ("remove(clientLeaseAuthority/25)", storage.log);
-    EXPECT_EQ(1U, leaseAuthority->leaseMap.size());
-    EXPECT_EQ(1U, leaseAuthority->expirationOrder.size());
-
-    storage.log.clear();
-    EXPECT_TRUE(leaseAuthority->cleanNextLease());
-    EXPECT_EQ("remove(clientLeaseAuthority/4294967297)", storage.log);
+    EXPECT_FALSE(leaseAuthority->cleanExpiredLeases());
+    EXPECT_EQ("remove(clientLeaseAuthority/25); "
+              "remove(clientLeaseAuthority/4294967297)", storage.log);
     EXPECT_EQ(0U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(0U, leaseAuthority->expirationOrder.size());
 
-    EXPECT_FALSE(leaseAuthority->cleanNextLease());
+    EXPECT_FALSE(leaseAuthority->cleanExpiredLeases());
     EXPECT_EQ(0U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(0U, leaseAuthority->expirationOrder.size());
 
@@ -243,15 +299,46 @@ TEST_F(ClientLeaseAuthorityTest, cleanNextLease) {
     EXPECT_EQ(2U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(2U, leaseAuthority->expirationOrder.size());
 
-    EXPECT_TRUE(leaseAuthority->cleanNextLease());
+    EXPECT_FALSE(leaseAuthority->cleanExpiredLeases());
+    EXPECT_EQ(1U, leaseAuthority->leaseMap.size());
+    EXPECT_EQ(1U, leaseAuthority->expirationOrder.size());
+
+    EXPECT_FALSE(leaseAuthority->cleanExpiredLeases());
     EXPECT_EQ(1U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(1U, leaseAuthority->expirationOrder.size());
+}
 
-    EXPECT_FALSE(leaseAuthority->cleanNextLease());
+TEST_F(ClientLeaseAuthorityTest, cleanExpiredLeases_blocks) {
+    // Time dependent test.
+    leaseAuthority->leaseBlocks[1] = {64, 0};
+    leaseAuthority->leaseBlocks[65] = {64, ~0UL & ~(1UL << 3)};
+    leaseAuthority->leaseMap[1] = ClusterTime(0);
+    leaseAuthority->expirationOrder.insert({ClusterTime(0), 1});
+    leaseAuthority->leaseMap[3] = ClusterTime(0);
+    leaseAuthority->expirationOrder.insert({ClusterTime(0), 3});
+    leaseAuthority->leaseMap[68] = ClusterTime(0);
+    leaseAuthority->expirationOrder.insert({ClusterTime(0), 68});
+    leaseAuthority->leaseMap[2] = ClusterTime(60000);
+    leaseAuthority->expirationOrder.insert({ClusterTime(60000), 2});
+
+    // Each block is written once; a block whose leases have all expired is
+    // removed.
+    storage.log.clear();
+    EXPECT_FALSE(leaseAuthority->cleanExpiredLeases());
+    EXPECT_EQ("set(UPDATE, clientLeaseAuthority/1); "
+              "remove(clientLeaseAuthority/65)", storage.log);
+    EXPECT_EQ("64 5", storage.setData);
+    EXPECT_EQ(1U, leaseAuthority->leaseBlocks.size());
+    EXPECT_EQ(5UL, leaseAuthority->leaseBlocks[1].expired);
     EXPECT_EQ(1U, leaseAuthority->leaseMap.size());
     EXPECT_EQ(1U, leaseAuthority->expirationOrder.size());
 }
 
+TEST_F(ClientLeaseAuthorityTest, getBlockValue) {
+    ClientLeaseAuthority::LeaseBlock block = {64, 0xa5};
+    EXPECT_EQ("64 a5", leaseAuthority->getBlockValue(block));
+}
+
 TEST_F(ClientLeaseAuthorityTest, getLeaseObjName) {
     EXPECT_EQ("clientLeaseAuthority/12345",
               leaseAuthority->getLeaseObjName(12345));
@@ -293,7 +380,7 @@ TEST_F(ClientLeaseAuthorityTest, renewLeaseInternal_new) {
                 leaseAuthority->expirationOrder.find(
                         {leaseAuthority->leaseMap[1], 1}));
     EXPECT_EQ(1U, leaseAuthority->lastIssuedLeaseId);
-    EXPECT_EQ(2U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(64U, leaseAuthority->maxReservedLeaseId);
 
     WireFormat::ClientLease lease2 =
             leaseAuthority->renewLeaseInternal(0, lock);
@@ -304,13 +391,13 @@ TEST_F(ClientLeaseAuthorityTest, renewLeaseInternal_new) {
                 leaseAuthority->expirationOrder.find(
                         {leaseAuthority->leaseMap[2], 2}));
     EXPECT_EQ(2U, leaseAuthority->lastIssuedLeaseId);
-    EXPECT_EQ(3U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(64U, leaseAuthority->maxReservedLeaseId);
 
-    leaseAuthority->reserveNextLease(lock);
-    leaseAuthority->reserveNextLease(lock);
-    leaseAuthority->reserveNextLease(lock);
+    leaseAuthority->reserveLeaseBlock(lock);
+    leaseAuthority->reserveLeaseBlock(lock);
+    leaseAuthority->reserveLeaseBlock(lock);
 
-    EXPECT_EQ(6U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(256U, leaseAuthority->maxReservedLeaseId);
 
     WireFormat::ClientLease lease3 =
             leaseAuthority->renewLeaseInternal(0, lock);
@@ -321,7 +408,7 @@ TEST_F(ClientLeaseAuthorityTest, renewLeaseInternal_new) {
                 leaseAuthority->expirationOrder.find(
                         {leaseAuthority->leaseMap[3], 3}));
     EXPECT_EQ(3U, leaseAuthority->lastIssuedLeaseId);
-    EXPECT_EQ(6U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(256U, leaseAuthority->maxReservedLeaseId);
 }
 
 TEST_F(ClientLeaseAuthorityTest, renewLeaseInternal_reservationsNotKeepingUp) {
@@ -337,24 +424,29 @@ TEST_F(ClientLeaseAuthorityTest, renewLeaseInternal_reservationsNotKeepingUp) {
     EXPECT_EQ(11U, lease.leaseId);
 
     EXPECT_EQ(11U, leaseAuthority->lastIssuedLeaseId);
-    EXPECT_EQ(12U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(64U, leaseAuthority->maxReservedLeaseId);
 
+    leaseAuthority->lastIssuedLeaseId = 63;
     TestLog::Enable _("renewLeaseInternal");
     TestLog::reset();
     lease = leaseAuthority->renewLeaseInternal(0, lock);
+    EXPECT_EQ(64U, lease.leaseId);
     EXPECT_EQ("renewLeaseInternal: Lease reservations are not keeping up; "
-              "maxReservedLeaseId = 12",
+              "maxReservedLeaseId = 64",
               TestLog::get());
+    EXPECT_EQ(128U, leaseAuthority->maxReservedLeaseId);
 }
 
-TEST_F(ClientLeaseAuthorityTest, reserveNextLease) {
+TEST_F(ClientLeaseAuthorityTest, reserveLeaseBlock) {
     SpinLock::Guard lock(leaseAuthority->mutex);
     storage.log.clear();
     leaseAuthority->maxReservedLeaseId = 4294967296;
     EXPECT_EQ(4294967296U, leaseAuthority->maxReservedLeaseId);
-    leaseAuthority->reserveNextLease(lock);
+    leaseAuthority->reserveLeaseBlock(lock);
     EXPECT_EQ("set(CREATE, clientLeaseAuthority/4294967297)", storage.log);
-    EXPECT_EQ(4294967297U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ("64 0", storage.setData);
+    EXPECT_EQ(4294967360U, leaseAuthority->maxReservedLeaseId);
+    EXPECT_EQ(64UL, leaseAuthority->leaseBlocks[4294967297].size);
 }
 
 }  // namespace RAMCloud
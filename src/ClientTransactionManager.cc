@@ -15,14 +15,23 @@
 
 #include "ClientTransactionManager.h"
 #include "ClientTransactionTask.h"
+#include "Cycles.h"
+#include "RamCloud.h"
 
 namespace RAMCloud {
 
+// Defined here because recordOutcome passes them to std::min and std::max,
+// which take references.
+const uint64_t ClientTransactionManager::MIN_BACKOFF_MICROS;
+const uint64_t ClientTransactionManager::MAX_BACKOFF_MICROS;
+
 /**
  * Constructor for the client transaction manager.
  */
 ClientTransactionManager::ClientTransactionManager()
     : taskList()
+    , backoffMicros(0)
+    , nextStartTime(0)
 {}
 
 /**
@@ -46,6 +55,29 @@ ClientTransactionManager::poll()
     }
 }
 
+/**
+ * Called by a ClientTransactionTask once it has decided whether to commit.
+ * After an abort, the client's next transaction is delayed by a random
+ * amount, so that clients contending for the same objects stop aborting
+ * each other; the range of the delay doubles with each consecutive abort.
+ *
+ * \param committed
+ *      True means the transaction committed, false means it aborted.
+ */
+void
+ClientTransactionManager::recordOutcome(bool committed)
+{
+    if (committed) {
+        backoffMicros = 0;
+        nextStartTime = 0;
+        return;
+    }
+    backoffMicros = std::min(std::max(2 * backoffMicros, MIN_BACKOFF_MICROS),
+                             MAX_BACKOFF_MICROS);
+    nextStartTime = Cycles::rdtsc() +
+            Cycles::fromMicroseconds(generateRandom() % (backoffMicros + 1));
+}
+
 /**
  * Add a transaction task that needs to be run to the manager.  The transaction
  * commit protocol is considered started once it has been added to this the
@@ -61,5 +93,23 @@ ClientTransactionManager::startTransactionTask(
     taskList.push_back(taskPtr);
 }
 
+/**
+ * Called when a transaction is created: if recent transactions aborted,
+ * wait out the delay chosen by recordOutcome before the new one reads
+ * anything. Outstanding tasks (such as the decisions of the transaction
+ * that aborted) keep running in the meantime.
+ *
+ * \param ramcloud
+ *      The client that owns this manager.
+ */
+void
+ClientTransactionManager::waitToStartTransaction(RamCloud* ramcloud)
+{
+    while (Cycles::rdtsc() < nextStartTime) {
+        poll();
+        ramcloud->poll();
+    }
+}
+
 
 } // end RAMCloud
@@ -43,11 +43,26 @@ class ClientTransactionManager {
   PUBLIC:
     ClientTransactionManager();
     void poll();
+    void recordOutcome(bool committed);
     void startTransactionTask(std::shared_ptr<ClientTransactionTask>& taskPtr);
+    void waitToStartTransaction(RamCloud* ramcloud);
 
   PRIVATE:
+    /// Bounds on #backoffMicros once a transaction has aborted.
+    static const uint64_t MIN_BACKOFF_MICROS = 2;
+    static const uint64_t MAX_BACKOFF_MICROS = 1000;
+
     std::list< std::shared_ptr<ClientTransactionTask> > taskList;
 
+    /// Upper bound, in microseconds, on the random delay before this
+    /// client's next transaction starts. Doubles with each consecutive
+    /// abort (see recordOutcome); 0 after a commit.
+    uint64_t backoffMicros;
+
+    /// New transactions don't start before this time (in Cycles::rdtsc
+    /// ticks); see waitToStartTransaction.
+    uint64_t nextStartTime;
+
     DISALLOW_COPY_AND_ASSIGN(ClientTransactionManager);
 };
 
@@ -61,6 +61,35 @@ TEST_F(ClientTransactionManagerTest, poll) {
     EXPECT_EQ(1U, txManager.taskList.size());
 }
 
+TEST_F(ClientTransactionManagerTest, recordOutcome) {
+    uint64_t before = Cycles::rdtsc();
+    txManager.recordOutcome(false);
+    EXPECT_EQ(2U, txManager.backoffMicros);
+    EXPECT_LE(before, txManager.nextStartTime);
+    EXPECT_GE(Cycles::rdtsc() + Cycles::fromMicroseconds(2),
+              txManager.nextStartTime);
+    txManager.recordOutcome(false);
+    EXPECT_EQ(4U, txManager.backoffMicros);
+    for (int i = 0; i < 20; i++) {
+        txManager.recordOutcome(false);
+    }
+    EXPECT_EQ(1000U, txManager.backoffMicros);
+
+    txManager.recordOutcome(true);
+    EXPECT_EQ(0U, txManager.backoffMicros);
+    EXPECT_EQ(0U, txManager.nextStartTime);
+}
+
+TEST_F(ClientTransactionManagerTest, waitToStartTransaction) {
+    // Tasks keep running during the wait.
+    txManager.taskList.push_back(taskPtr);
+    taskPtr.get()->state = ClientTransactionTask::DONE;
+    txManager.nextStartTime = Cycles::rdtsc() + Cycles::fromMicroseconds(100);
+    txManager.waitToStartTransaction(&ramcloud);
+    EXPECT_LE(txManager.nextStartTime, Cycles::rdtsc());
+    EXPECT_EQ(0U, txManager.taskList.size());
+}
+
 TEST_F(ClientTransactionManagerTest, startTransactionTask) {
     EXPECT_EQ(0U, txManager.taskList.size());
     txManager.startTransactionTask(taskPtr);
@@ -33,10 +33,12 @@ namespace RAMCloud {
 ClientTransactionTask::ClientTransactionTask(RamCloud* ramcloud)
     : ramcloud(ramcloud)
     , readOnly(true)
+    , snapshotTime(0)
     , participantCount(0)
     , participantList()
     , state(INIT)
     , decision(WireFormat::TxDecision::UNDECIDED)
+    , prepareClusterTime(0)
     , lease()
     , txId(0)
     , prepareRpcs()
@@ -164,6 +166,8 @@ ClientTransactionTask::performTask()
                         ClientException::throwException(HERE,
                                                         STATUS_INTERNAL_ERROR);
                 }
+                ramcloud->transactionManager->recordOutcome(
+                        decision == WireFormat::TxDecision::COMMIT);
             }
         }
         if (state == DECISION) {
@@ -224,6 +228,19 @@ ClientTransactionTask::performTask()
 void
 ClientTransactionTask::initTask()
 {
+    // Snapshot reads are consistent by themselves; the servers are told
+    // nothing about them.
+    if (snapshotTime != 0) {
+        CommitCacheMap::iterator it = commitCache.begin();
+        while (it != commitCache.end()) {
+            if (it->second.type == CacheEntry::READ) {
+                it = commitCache.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
     lease = ramcloud->clientLeaseAgent->getLease();
     // First RPC id is used to identify the transaction.  One additional RPC
     // id is needed for each operation in the transation.
@@ -550,6 +567,7 @@ void
 ClientTransactionTask::ClientTransactionRpcWrapper::send()
 {
     state = IN_PROGRESS;
+    RpcTrace::recordSend(&request);
     session->sendRequest(&request, response, this);
 }
 
@@ -577,6 +595,8 @@ ClientTransactionTask::DecisionRpc::DecisionRpc(RamCloud* ramcloud,
     reqHdr->transactionId = task->txId;
     reqHdr->recovered = false;
     reqHdr->participantCount = 0;
+    if (task->snapshotTime != 0)
+        reqHdr->commitTime = task->prepareClusterTime + 1;
 }
 
 /**
@@ -666,15 +686,22 @@ ClientTransactionTask::PrepareRpc::PrepareRpc(RamCloud* ramcloud,
     : ClientTransactionRpcWrapper(ramcloud,
                                   session,
                                   task,
-                                  sizeof(WireFormat::TxDecision::Response))
+                                  sizeof(WireFormat::TxPrepare::Response))
     , reqHdr(allocHeader<WireFormat::TxPrepare>())
 {
     reqHdr->lease = task->lease;
     reqHdr->clientTxId = task->txId;
     reqHdr->ackId = ramcloud->rpcTracker->ackId();
-    reqHdr->participantCount = task->participantCount;
     reqHdr->opCount = 0;
-    request.appendExternal(&task->participantList);
+    reqHdr->snapshotTime = task->snapshotTime;
+    // Masters only validate the versions read by a read-only transaction
+    // and have no use for its participant list.
+    if (task->readOnly) {
+        reqHdr->participantCount = 0;
+    } else {
+        reqHdr->participantCount = task->participantCount;
+        request.appendExternal(&task->participantList);
+    }
 }
 
 /**
@@ -764,6 +791,8 @@ ClientTransactionTask::PrepareRpc::wait()
 
     WireFormat::TxPrepare::Response* respHdr =
             response->getStart<WireFormat::TxPrepare::Response>();
+    if (respHdr->clusterTime > task->prepareClusterTime)
+        task->prepareClusterTime = respHdr->clusterTime;
     return respHdr->vote;
 }
 
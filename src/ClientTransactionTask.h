@@ -99,6 +99,12 @@ class ClientTransactionTask : public RpcTracker::TrackedRpc {
     /// the read-only optimization can be used.
     bool readOnly;
 
+    /// If nonzero, the transaction runs with snapshot isolation: its reads
+    /// came from a snapshot at this encoded ClusterTime, so they needn't be
+    /// validated, and only its writes and removes are prepared (and abort
+    /// if a conflicting change committed after the snapshot).
+    uint64_t snapshotTime;
+
   PRIVATE:
     /// Number of participant objects/operations.
     uint32_t participantCount;
@@ -115,6 +121,12 @@ class ClientTransactionTask : public RpcTracker::TrackedRpc {
     /// This transaction's decision to either COMMIT or ABORT.
     WireFormat::TxDecision::Decision decision;
 
+    /// Largest ClusterTime (encoded) returned by the participants' prepare
+    /// responses. A snapshot-isolation transaction commits just after it,
+    /// so that snapshots that didn't see it prepared can't see it
+    /// committed either.
+    uint64_t prepareClusterTime;
+
     /// Lease information for to this transaction.
     WireFormat::ClientLease lease;
 
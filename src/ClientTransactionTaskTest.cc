@@ -15,6 +15,7 @@
 
 #include "TestUtil.h"       //Has to be first, compiler complains
 #include "ClientTransactionTask.h"
+#include "ClientTransactionManager.h"
 #include "ClientLeaseAgent.h"
 #include "MockCluster.h"
 #include "RpcTracker.h"
@@ -547,6 +548,7 @@ TEST_F(ClientTransactionTaskTest, performTask_setDecision) {
     EXPECT_EQ(WireFormat::TxDecision::ABORT, transactionTask->decision);
     EXPECT_EQ("performTask: Move from PREPARE to DECISION phase.",
               TestLog::get());
+    EXPECT_EQ(2U, ramcloud->transactionManager->backoffMicros);
 
     transactionTask->state = ClientTransactionTask::INIT;
     transactionTask->decision = WireFormat::TxDecision::COMMIT;
@@ -555,6 +557,7 @@ TEST_F(ClientTransactionTaskTest, performTask_setDecision) {
     EXPECT_EQ(WireFormat::TxDecision::COMMIT, transactionTask->decision);
     EXPECT_EQ("performTask: Move from PREPARE to DONE phase; optimized.",
               TestLog::get());
+    EXPECT_EQ(0U, ramcloud->transactionManager->backoffMicros);
 
     transactionTask->state = ClientTransactionTask::INIT;
     // Set to bad value.
@@ -1110,6 +1113,7 @@ TEST_F(ClientTransactionTaskTest, PrepareRpc_constructor) {
                 ramcloud->clientContext->transportManager->getSession(
                 "mock:host=master1");
     transactionTask->lease.leaseId = 42;
+    transactionTask->readOnly = false;
     transactionTask->participantCount = 2;
     transactionTask->participantList.emplaceAppend<WireFormat::TxParticipant>(
             1, 2, 3);
@@ -1131,6 +1135,22 @@ TEST_F(ClientTransactionTaskTest, PrepareRpc_constructor) {
               rpcToString(&rpc));
 }
 
+TEST_F(ClientTransactionTaskTest, PrepareRpc_constructor_readOnly) {
+    Transport::SessionRef session =
+                ramcloud->clientContext->transportManager->getSession(
+                "mock:host=master1");
+    transactionTask->lease.leaseId = 42;
+    transactionTask->participantCount = 1;
+    transactionTask->participantList.emplaceAppend<WireFormat::TxParticipant>(
+            1, 2, 3);
+
+    ClientTransactionTask::PrepareRpc rpc(
+            ramcloud.get(), session, transactionTask.get());
+    EXPECT_EQ("PrepareRpc :: id{42, 0} ackId{0} participantCount{0} opCount{0}"
+              " ParticipantList[ ] OpSet[ ]",
+              rpcToString(&rpc));
+}
+
 TEST_F(ClientTransactionTaskTest, PrepareRpc_appendOp_read) {
     insertRead(tableId1, "0", 1);
     transactionTask->readOnly = false;
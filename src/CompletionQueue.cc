@@ -0,0 +1,133 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <algorithm>
+#include <memory>
+
+#include "CompletionQueue.h"
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct an empty CompletionQueue.
+ *
+ * \param ramcloud
+ *      The RAMCloud object used for every RPC started on this queue.
+ */
+CompletionQueue::CompletionQueue(RamCloud* ramcloud)
+    : ramcloud(ramcloud)
+    , outstanding()
+    , lock("CompletionQueue::lock")
+    , notified()
+    , waiting()
+{
+}
+
+/**
+ * Destructor for CompletionQueue: RPCs whose callbacks haven't run yet are
+ * canceled, and their callbacks never run.
+ */
+CompletionQueue::~CompletionQueue()
+{
+    foreach (Entry* entry, outstanding)
+        delete entry;
+}
+
+/**
+ * Give the transports a chance to run (see RamCloud::poll), then invoke the
+ * callbacks of the RPCs that have become ready. RPCs that need to be retried
+ * are retried here.
+ *
+ * \return
+ *      The number of callbacks invoked.
+ */
+uint32_t
+CompletionQueue::poll()
+{
+    ramcloud->poll();
+
+    std::vector<Entry*> candidates;
+    {
+        SpinLock::Guard _(lock);
+        candidates.swap(notified);
+        foreach (Entry* entry, candidates)
+            entry->notified = false;
+    }
+    candidates.insert(candidates.end(), waiting.begin(), waiting.end());
+    waiting.clear();
+
+    // A wrapper that was retried while being checked may have been notified
+    // as well as put on #waiting.
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        Entry* entry = candidates[i];
+        bool ready;
+        try {
+            ready = entry->checkReady();
+        } catch (...) {
+            // The callback's wait() will throw the same exception.
+            ready = true;
+        }
+        if (!ready) {
+            if (!entry->inProgress())
+                waiting.push_back(entry);
+            continue;
+        }
+        outstanding.erase(entry);
+        std::unique_ptr<Entry> owner(entry);
+        try {
+            entry->finish();
+        } catch (...) {
+            // Leave the rest for the next poll.
+            waiting.insert(waiting.end(), candidates.begin() + i + 1,
+                           candidates.end());
+            throw;
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Poll until every RPC started on this queue (including any started by
+ * callbacks) has completed and its callback has run.
+ */
+void
+CompletionQueue::waitAll()
+{
+    while (!outstanding.empty())
+        poll();
+}
+
+/**
+ * Record that the transport has heard back about an entry's RPC. May be
+ * invoked on the dispatch thread.
+ */
+void
+CompletionQueue::notify(Entry* entry)
+{
+    SpinLock::Guard _(lock);
+    if (!entry->notified) {
+        entry->notified = true;
+        notified.push_back(entry);
+    }
+}
+
+} // namespace RAMCloud
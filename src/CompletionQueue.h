@@ -0,0 +1,197 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_COMPLETIONQUEUE_H
+#define RAMCLOUD_COMPLETIONQUEUE_H
+
+#include <functional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "RamCloud.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * Runs client RPCs asynchronously and invokes a callback when each one
+ * completes, so that one thread can keep thousands of RPCs in flight
+ * without managing the wrappers itself or checking each of them with
+ * isReady().
+ *
+ * Any RpcWrapper subclass whose constructor takes the RamCloud object as its
+ * first argument (ReadRpc, WriteRpc, RemoveRpc, ...) can be started with
+ * start(). The queue owns the wrapper: its callback receives the wrapper
+ * once it is ready, typically calls wait() on it to collect the results
+ * (which doesn't block at that point), and the queue then deletes it.
+ *
+ * Wrappers tell the queue when the transport delivers their response (by
+ * way of RpcNotifier::completed() or failed()), so each call to poll() only
+ * looks at the RPCs that have heard back, plus the few that are waiting to
+ * be retried, rather than at everything in flight. poll() must be called
+ * regularly (or use waitAll()); callbacks run inside it, on the calling
+ * thread, in no particular order, and may start more RPCs.
+ *
+ * Like RamCloud, this class is not thread-safe: it must only be used by the
+ * thread that uses its RamCloud object.
+ */
+class CompletionQueue {
+  PUBLIC:
+    explicit CompletionQueue(RamCloud* ramcloud);
+    ~CompletionQueue();
+
+    /**
+     * Start an RPC, to be completed by poll().
+     *
+     * \tparam Rpc
+     *      RpcWrapper subclass to construct, such as ReadRpc.
+     * \param onComplete
+     *      Invoked by poll() with the wrapper once it is ready; the wrapper
+     *      is deleted when this returns.
+     * \param args
+     *      Arguments for Rpc's constructor, after the RamCloud object.
+     */
+    template<typename Rpc, typename... Args>
+    void
+    start(std::function<void(Rpc*)> onComplete, Args&&... args)
+    {
+        Op<Rpc>* op = new Op<Rpc>(this, onComplete, ramcloud,
+                                  std::forward<Args>(args)...);
+        outstanding.insert(op);
+        op->started();
+    }
+
+    /// Returns the number of RPCs whose callback hasn't run yet.
+    size_t
+    size() const
+    {
+        return outstanding.size();
+    }
+
+    uint32_t poll();
+    void waitAll();
+
+  PRIVATE:
+    /**
+     * The part of an Op that doesn't depend on the wrapper type.
+     */
+    class Entry {
+      public:
+        explicit Entry(CompletionQueue* queue)
+            : queue(queue)
+            , notified(false)
+        {}
+        virtual ~Entry() {}
+
+        /// Returns true if the wrapper is ready (see RpcWrapper::isReady);
+        /// this is also where failed RPCs get retried.
+        virtual bool checkReady() = 0;
+
+        /// Returns true if the wrapper is waiting for a response from the
+        /// transport, which will notify the queue when it arrives.
+        virtual bool inProgress() = 0;
+
+        /// Invoke the callback with the wrapper.
+        virtual void finish() = 0;
+
+        /// The queue that owns this entry.
+        CompletionQueue* queue;
+
+        /// True if the entry is in CompletionQueue::notified. Protected by
+        /// CompletionQueue::lock.
+        bool notified;
+
+        DISALLOW_COPY_AND_ASSIGN(Entry);
+    };
+
+    /**
+     * A wrapper of RPC type Rpc that notifies its queue whenever the
+     * transport delivers a response or an error.
+     */
+    template<typename Rpc>
+    class Op : public Rpc, public Entry {
+      public:
+        template<typename... Args>
+        Op(CompletionQueue* queue, std::function<void(Rpc*)> onComplete,
+           RamCloud* ramcloud, Args&&... args)
+            : Rpc(ramcloud, std::forward<Args>(args)...)
+            , Entry(queue)
+            , onComplete(onComplete)
+        {}
+
+        /// Called once the Op is fully constructed: the wrapper's
+        /// constructor may have finished (or never sent) the RPC before
+        /// notifications reached this class.
+        void
+        started()
+        {
+            if (!inProgress())
+                queue->notify(this);
+        }
+
+        void
+        completed()
+        {
+            Rpc::completed();
+            queue->notify(this);
+        }
+
+        void
+        failed()
+        {
+            Rpc::failed();
+            queue->notify(this);
+        }
+
+        bool checkReady() { return Rpc::isReady(); }
+        bool inProgress() { return this->getState() == Rpc::IN_PROGRESS; }
+        void finish() { onComplete(this); }
+
+      PRIVATE:
+        /// Callback passed to CompletionQueue::start().
+        std::function<void(Rpc*)> onComplete;
+
+        DISALLOW_COPY_AND_ASSIGN(Op);
+    };
+
+    void notify(Entry* entry);
+
+    /// Overall client state information.
+    RamCloud* ramcloud;
+
+    /// Every entry whose callback hasn't run yet; they are owned by the
+    /// queue.
+    std::unordered_set<Entry*> outstanding;
+
+    /// Protects #notified, which transports may add to from the dispatch
+    /// thread.
+    SpinLock lock;
+
+    /// Entries whose wrappers have heard from the transport since they were
+    /// last checked.
+    std::vector<Entry*> notified;
+
+    /// Entries that weren't ready when last checked and aren't waiting for
+    /// the transport either (e.g., an RPC backing off before a retry); they
+    /// are checked on every poll().
+    std::vector<Entry*> waiting;
+
+    DISALLOW_COPY_AND_ASSIGN(CompletionQueue);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_COMPLETIONQUEUE_H
@@ -0,0 +1,136 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "CompletionQueue.h"
+#include "MockCluster.h"
+
+namespace RAMCloud {
+
+class CompletionQueueTest : public ::testing::Test {
+  public:
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+    uint16_t keyLength;
+    Tub<CompletionQueue> queue;
+
+    CompletionQueueTest()
+        : context()
+        , cluster(&context)
+        , ramcloud()
+        , tableId(-1)
+        , keyLength(7)
+        , queue()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table1");
+        ramcloud->write(tableId, "object1", 7, "value1");
+        queue.construct(ramcloud.get());
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(CompletionQueueTest);
+};
+
+TEST_F(CompletionQueueTest, basics) {
+    Buffer value;
+    string results;
+    queue->start<WriteRpc>([&results](WriteRpc* rpc) {
+            rpc->wait();
+            results += " write";
+        }, tableId, "object2", keyLength, "value2", 6);
+    queue->start<ReadRpc>([&results](ReadRpc* rpc) {
+            rpc->wait();
+            results += " read";
+        }, tableId, "object1", keyLength, &value);
+    EXPECT_EQ(2u, queue->size());
+
+    queue->waitAll();
+    EXPECT_EQ(0u, queue->size());
+    EXPECT_NE(string::npos, results.find("write"));
+    EXPECT_NE(string::npos, results.find("read"));
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(0u, queue->poll());
+}
+
+TEST_F(CompletionQueueTest, poll_error) {
+    Buffer value;
+    bool threw = false;
+    queue->start<ReadRpc>([&threw](ReadRpc* rpc) {
+            try {
+                rpc->wait();
+            } catch (ObjectDoesntExistException& e) {
+                threw = true;
+            }
+        }, tableId, "missing", keyLength, &value);
+    queue->waitAll();
+    EXPECT_TRUE(threw);
+}
+
+TEST_F(CompletionQueueTest, poll_callbackStartsRpc) {
+    Buffer value;
+    int count = 0;
+    queue->start<WriteRpc>([&](WriteRpc* rpc) {
+            rpc->wait();
+            count++;
+            queue->start<ReadRpc>([&count](ReadRpc* rpc) {
+                    rpc->wait();
+                    count++;
+                }, tableId, "object2", keyLength, &value);
+        }, tableId, "object2", keyLength, "value2", 6);
+    queue->waitAll();
+    EXPECT_EQ(2, count);
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+}
+
+TEST_F(CompletionQueueTest, poll_callbackThrows) {
+    Buffer value1, value2;
+    int count = 0;
+    for (int i = 0; i < 2; i++) {
+        queue->start<ReadRpc>([&count](ReadRpc* rpc) {
+                count++;
+                throw RetryException(HERE);
+            }, tableId, "object1", keyLength, i == 0 ? &value1 : &value2);
+    }
+    EXPECT_THROW(queue->poll(), RetryException);
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(1u, queue->size());
+    EXPECT_THROW(queue->poll(), RetryException);
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(0u, queue->size());
+}
+
+TEST_F(CompletionQueueTest, poll_coalescedRead) {
+    // Coalesced reads never hear from a transport themselves.
+    ramcloud->enableCoalescing(1000000);
+    Buffer value;
+    queue->start<ReadRpc>([](ReadRpc* rpc) { rpc->wait(); },
+                          tableId, "object1", keyLength, &value);
+    queue->poll();
+    EXPECT_EQ(1u, queue->waiting.size());
+    ramcloud->disableCoalescing();
+    queue->waitAll();
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+}
+
+}  // namespace RAMCloud
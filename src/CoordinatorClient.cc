@@ -17,6 +17,8 @@
 #include "CoordinatorSession.h"
 #include "ShortMacros.h"
 #include "ProtoBuf.h"
+#include "RpcTrace.h"
+#include "TransportManager.h"
 
 namespace RAMCloud {
 
@@ -405,17 +407,101 @@ CoordinatorClient::getTableConfig(Context* context,
  *      Overall information about this RAMCloud server or client.
  * \param tableId
  *      The id of a table whose tablet configuration is to be fetched.
+ * \param knownEpoch
+ *      The epoch returned by wait() for an earlier fetch of this table's
+ *      configuration, or 0.
+ * \param knownVersion
+ *      The version returned by wait() along with \a knownEpoch. If
+ *      nonzero (and the coordinator hasn't restarted since) the coordinator
+ *      only returns the tablets that have changed since then. 0 means
+ *      fetch the whole configuration.
+ * \param flatFormat
+ *      True means the coordinator returns a FlatTableConfig, which must be
+ *      collected with the corresponding wait() method; false means it
+ *      returns a ProtoBuf::TableConfig.
+ * \param masterLocator
+ *      If nonempty, the request is sent to this master as a
+ *      GET_CACHED_TABLE_CONFIG, which it answers from its copy of the
+ *      configuration (see TableConfigCache), rather than to the
+ *      coordinator. If the master can't be reached or doesn't answer
+ *      successfully, the request goes to the coordinator after all.
  */
-GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId)
+GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId,
+        uint64_t knownEpoch, uint64_t knownVersion, bool flatFormat,
+        const string& masterLocator)
     : CoordinatorRpcWrapper(context,
             sizeof(WireFormat::GetTableConfig::Response))
+    , flatFormat(flatFormat)
+    , masterLocator(masterLocator)
 {
-    WireFormat::GetTableConfig::Request* reqHdr(
-            allocHeader<WireFormat::GetTableConfig>());
+    WireFormat::GetTableConfig::Request* reqHdr;
+    if (masterLocator.empty())
+        reqHdr = allocHeader<WireFormat::GetTableConfig>();
+    else
+        reqHdr = allocHeader<WireFormat::GetCachedTableConfig>();
     reqHdr->tableId = tableId;
+    reqHdr->knownEpoch = knownEpoch;
+    reqHdr->knownVersion = knownVersion;
+    reqHdr->flatFormat = flatFormat;
     send();
 }
 
+// See RpcWrapper for documentation.
+bool
+GetTableConfigRpc::checkStatus()
+{
+    if (masterLocator.empty())
+        return true;
+    const WireFormat::ResponseCommon* responseCommon =
+            response->getStart<WireFormat::ResponseCommon>();
+    LOG(NOTICE, "Master %s returned %s for table configuration; asking "
+            "the coordinator instead", masterLocator.c_str(),
+            statusToSymbol(responseCommon->status));
+    fallBackToCoordinator();
+    send();
+    return false;
+}
+
+// See RpcWrapper for documentation.
+bool
+GetTableConfigRpc::handleTransportError()
+{
+    if (masterLocator.empty())
+        return CoordinatorRpcWrapper::handleTransportError();
+    context->transportManager->flushSession(masterLocator);
+    fallBackToCoordinator();
+    send();
+    return false;
+}
+
+// See RpcWrapper for documentation.
+void
+GetTableConfigRpc::send()
+{
+    if (masterLocator.empty()) {
+        CoordinatorRpcWrapper::send();
+        return;
+    }
+    session = context->transportManager->getSession(masterLocator);
+    state = IN_PROGRESS;
+    RpcTrace::recordSend(&request);
+    session->sendRequest(&request, response, this);
+}
+
+/**
+ * Redirect a request that was sent to a master to the coordinator
+ * instead; the caller must send it again.
+ */
+void
+GetTableConfigRpc::fallBackToCoordinator()
+{
+    masterLocator.clear();
+    WireFormat::GetTableConfig::Request* reqHdr =
+            request.getStart<WireFormat::GetTableConfig::Request>();
+    reqHdr->common.opcode = WireFormat::GetTableConfig::opcode;
+    reqHdr->common.service = WireFormat::GetTableConfig::service;
+}
+
 /**
  * Wait for a getTableConfig RPC to complete, and return the
  * same results as #CoordinatorClient::getTableConfig.
@@ -425,17 +511,83 @@ GetTableConfigRpc::GetTableConfigRpc(Context* context, uint64_t tableId)
  *      in the table given by tableId argument passed to the constructor.
  *      If the table does not exist, then the result will contain no tablets
  *      and indexes.
+ * \param[out] epoch
+ *      If non-NULL, filled in with the epoch of the coordinator's
+ *      configuration versions; pass it to a later rpc along with
+ *      \a version.
+ * \param[out] version
+ *      If non-NULL, filled in with the version of the configuration
+ *      returned.
+ * \return
+ *      True means the rpc asked for changes since a known version and
+ *      \a tableConfig only contains the tablets that changed since then
+ *      (plus all of the indexes); the caller must merge them into its
+ *      copy. False means \a tableConfig is complete.
  */
-void
-GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig)
+bool
+GetTableConfigRpc::wait(ProtoBuf::TableConfig* tableConfig, uint64_t* epoch,
+        uint64_t* version)
+{
+    assert(!flatFormat);
+    const WireFormat::GetTableConfig::Response* respHdr = waitForResponse();
+    ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
+                                respHdr->tableConfigLength, tableConfig);
+    if (epoch != NULL)
+        *epoch = respHdr->configEpoch;
+    if (version != NULL)
+        *version = respHdr->configVersion;
+    return respHdr->incremental != 0;
+}
+
+/**
+ * Wait for a getTableConfig RPC that asked for the flat format to complete.
+ * This is the same as the other wait() method, except that the
+ * configuration is decoded in place in the response.
+ *
+ * \param[out] tableConfig
+ *      Refers to the configuration in the response, so it is only valid
+ *      until this RPC is destroyed or restarted.
+ * \param[out] epoch
+ *      See the other wait() method.
+ * \param[out] version
+ *      See the other wait() method.
+ * \return
+ *      See the other wait() method.
+ * \throw ResponseFormatError
+ *      The configuration in the response was malformed.
+ */
+bool
+GetTableConfigRpc::wait(FlatTableConfig* tableConfig, uint64_t* epoch,
+        uint64_t* version)
+{
+    assert(flatFormat);
+    const WireFormat::GetTableConfig::Response* respHdr = waitForResponse();
+    if (!tableConfig->parse(response, sizeof(*respHdr),
+                            respHdr->tableConfigLength)) {
+        throw ResponseFormatError(HERE);
+    }
+    if (epoch != NULL)
+        *epoch = respHdr->configEpoch;
+    if (version != NULL)
+        *version = respHdr->configVersion;
+    return respHdr->incremental != 0;
+}
+
+/**
+ * Wait for a getTableConfig RPC to complete and check its status.
+ *
+ * \return
+ *      The response header.
+ */
+const WireFormat::GetTableConfig::Response*
+GetTableConfigRpc::waitForResponse()
 {
     waitInternal(context->dispatch);
     const WireFormat::GetTableConfig::Response* respHdr(
             getResponseHeader<WireFormat::GetTableConfig>());
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
-    ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
-                                respHdr->tableConfigLength, tableConfig);
+    return respHdr;
 }
 
 /**
@@ -704,6 +856,81 @@ RenewLeaseRpc::wait()
 
     return respHdr->lease;
 }
+
+/**
+ * Renew several leases with one RPC; used by agents that hold the leases of
+ * many clients. Each lease is handled as in #CoordinatorClient::renewLease.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param count
+ *      Number of leases to renew.
+ * \param leaseIds
+ *      Ids of the leases to be renewed if possible.  Use 0 (invalid id) to
+ *      request a new lease.
+ * \param[out] leases
+ *      Array of at least count elements; leases[i] is set to the valid lease
+ *      for leaseIds[i], which is a new lease if leaseIds[i] has expired or is
+ *      invalid.
+ */
+void
+CoordinatorClient::renewLeases(Context* context, uint32_t count,
+        const uint64_t* leaseIds, WireFormat::ClientLease* leases)
+{
+    RenewLeasesRpc rpc(context, count, leaseIds);
+    rpc.wait(leases);
+}
+
+/**
+ * Constructor for RenewLeasesRpc: initiates an RPC in the same way as
+ * #CoordinatorClient::renewLeases, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server or client.
+ * \param count
+ *      Number of leases to renew.
+ * \param leaseIds
+ *      Ids of the leases to be renewed if possible.  The array is copied
+ *      before this method returns.
+ */
+RenewLeasesRpc::RenewLeasesRpc(Context* context, uint32_t count,
+        const uint64_t* leaseIds)
+    : CoordinatorRpcWrapper(context,
+            sizeof(WireFormat::RenewLeases::Response))
+    , count(count)
+{
+    WireFormat::RenewLeases::Request* reqHdr(
+            allocHeader<WireFormat::RenewLeases>());
+    reqHdr->leaseCount = count;
+    request.appendCopy(leaseIds, count * sizeof32(uint64_t));
+    send();
+}
+
+/**
+ * Wait for a renewLeases RPC to complete, and return the same results as
+ * #CoordinatorClient::renewLeases.
+ *
+ * \param[out] leases
+ *      Array of at least as many elements as leases were requested; filled
+ *      in with valid ClientLeases.
+ */
+void
+RenewLeasesRpc::wait(WireFormat::ClientLease* leases)
+{
+    waitInternal(context->dispatch);
+    const WireFormat::RenewLeases::Response* respHdr(
+            getResponseHeader<WireFormat::RenewLeases>());
+    if (respHdr->common.status != STATUS_OK)
+        ClientException::throwException(HERE, respHdr->common.status);
+
+    uint32_t length = count * sizeof32(WireFormat::ClientLease);
+    if (respHdr->leaseCount != count ||
+            response->size() < sizeof32(*respHdr) + length) {
+        throw MessageTooShortError(HERE);
+    }
+    response->copy(sizeof32(*respHdr), length, leases);
+}
 /**
  * This RPC is used to invoke ServerControl on every server in the cluster; it
  * returns all of the responses.
@@ -23,6 +23,7 @@
 
 #include "ClientException.h"
 #include "CoordinatorRpcWrapper.h"
+#include "FlatTableConfig.h"
 #include "ServiceMask.h"
 #include "ServerId.h"
 #include "ServerConfig.pb.h"
@@ -64,6 +65,8 @@ class CoordinatorClient {
             bool successful);
     static WireFormat::ClientLease renewLease(Context* context,
             uint64_t leaseId);
+    static void renewLeases(Context* context, uint32_t count,
+            const uint64_t* leaseIds, WireFormat::ClientLease* leases);
     static void sendServerList(Context* context, ServerId destination);
     static void serverControlAll(Context* context,
             WireFormat::ControlOp controlOp, const void* inputData = NULL,
@@ -155,11 +158,31 @@ class GetServerListRpc : public CoordinatorRpcWrapper {
  */
 class GetTableConfigRpc : public CoordinatorRpcWrapper {
     public:
-    explicit GetTableConfigRpc(Context* context, uint64_t tableId);
+    GetTableConfigRpc(Context* context, uint64_t tableId,
+            uint64_t knownEpoch = 0, uint64_t knownVersion = 0,
+            bool flatFormat = false, const string& masterLocator = "");
     ~GetTableConfigRpc() {}
-    void wait(ProtoBuf::TableConfig* tableConfig);
+    bool wait(ProtoBuf::TableConfig* tableConfig, uint64_t* epoch = NULL,
+            uint64_t* version = NULL);
+    bool wait(FlatTableConfig* tableConfig, uint64_t* epoch = NULL,
+            uint64_t* version = NULL);
+
+    PROTECTED:
+    virtual bool checkStatus();
+    virtual bool handleTransportError();
+    virtual void send();
 
     PRIVATE:
+    void fallBackToCoordinator();
+    const WireFormat::GetTableConfig::Response* waitForResponse();
+
+    /// Copy of the constructor argument: which encoding was asked for.
+    const bool flatFormat;
+
+    /// Locator of the master the request is sent to instead of the
+    /// coordinator; empty once the request goes to the coordinator.
+    string masterLocator;
+
     DISALLOW_COPY_AND_ASSIGN(GetTableConfigRpc);
 };
 
@@ -226,6 +249,24 @@ class RenewLeaseRpc : public CoordinatorRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(RenewLeaseRpc);
 };
 
+/**
+ * Encapsulates the state of a CoordinatorClient::renewLeases
+ * request, allowing it to execute asynchronously.
+ */
+class RenewLeasesRpc : public CoordinatorRpcWrapper {
+    public:
+    RenewLeasesRpc(Context* context, uint32_t count,
+                   const uint64_t* leaseIds);
+    ~RenewLeasesRpc() {}
+    void wait(WireFormat::ClientLease* leases);
+
+    PRIVATE:
+    /// Number of leases requested.
+    uint32_t count;
+
+    DISALLOW_COPY_AND_ASSIGN(RenewLeasesRpc);
+};
+
 /**
  * Encapsulates the state of a CoordinatorClient::sendServerList
  * request, allowing it to execute asynchronously.
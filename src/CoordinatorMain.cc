@@ -24,6 +24,7 @@
 #include "PortAlarm.h"
 #include "ServerId.h"
 #include "TableManager.h"
+#include "TabletBalancer.h"
 #include "TransportManager.h"
 #include "WorkerManager.h"
 
@@ -51,12 +52,47 @@ main(int argc, char *argv[])
     Logger::installCrashBacktraceHandlers();
     string localLocator("???");
     uint32_t deadServerTimeout;
+    uint32_t maxActiveRecoveries;
     uint32_t maxCores;
     bool reset;
     bool neverKill;
+    bool onDemandRecovery;
+    bool clusterRestart;
+    uint32_t replicationGroupSize;
+    uint32_t serverListFanout;
+    TabletBalancer::Config balancerConfig;
     try {
         OptionsDescription coordinatorOptions("Coordinator");
         coordinatorOptions.add_options()
+            ("balanceImbalance",
+             ProgramOptions::value<double>(&balancerConfig.imbalance)->
+                default_value(0.25),
+             "The tablet balancer moves load off of a master when its reads "
+             "and writes per second exceed the average over all masters by "
+             "more than this fraction of the average.")
+            ("balanceInterval",
+             ProgramOptions::value<double>(
+                &balancerConfig.intervalSeconds)->default_value(0),
+             "Number of seconds between rounds of the tablet balancer, which "
+             "measures the load on each master and splits and migrates hot "
+             "tablets to even it out. 0 disables the balancer.")
+            ("balanceMaxMoves",
+             ProgramOptions::value<uint32_t>(
+                &balancerConfig.maxMovesPerRound)->default_value(1),
+             "Maximum number of tablets the tablet balancer migrates in one "
+             "round. After moving tablets it waits a round to measure them "
+             "again before moving anything else.")
+            ("balanceMinOpsPerSecond",
+             ProgramOptions::value<double>(
+                &balancerConfig.minOpsPerSecond)->default_value(10000),
+             "The tablet balancer leaves masters alone while they serve fewer "
+             "reads and writes per second than this.")
+            ("clusterRestart",
+             ProgramOptions::bool_switch(&clusterRestart),
+             "If specified, the masters of a cluster that was shut down are "
+             "recovered together: the recoveries all run at once and each "
+             "backup reads the replicas it holds for them in a single pass "
+             "over its storage.")
             ("deadServerTimeout,d",
              ProgramOptions::value<uint32_t>(&deadServerTimeout)->
                 default_value(250),
@@ -65,6 +101,13 @@ main(int argc, char *argv[])
             "timeout, the slower real crashes are responded to. The shorter "
             "the timeout, the greater the chance is of falsely deciding a "
             "machine is down when it's not.")
+            ("maxActiveRecoveries",
+             ProgramOptions::value<uint32_t>(&maxActiveRecoveries)->
+                default_value(1),
+             "Maximum number of crashed masters to recover at once. When "
+             "several masters crash together (e.g., a rack fails), raising "
+             "this lets their recoveries proceed in parallel, sharing the "
+             "surviving masters as recovery masters.")
             ("maxCores",
             ProgramOptions::value<uint32_t>(
                 &maxCores)->default_value(4),
@@ -78,11 +121,33 @@ main(int argc, char *argv[])
              ProgramOptions::bool_switch(&neverKill),
              "If specified, the coordinator will never attempt to kill any "
              "master or remove it from the server list.")
+            ("onDemandRecovery",
+             ProgramOptions::bool_switch(&onDemandRecovery),
+             "If specified, clients are directed to each recovery master as "
+             "soon as it starts replaying its partition, so that keys can be "
+             "read before the whole partition is replayed. The masters must "
+             "be started with --onDemandRecovery too.")
+            ("replicationGroupSize",
+             ProgramOptions::value<uint32_t>(&replicationGroupSize)->
+                default_value(3),
+             "Number of backups in each replication group, for masters "
+             "using MinCopysets. Must match their --replicas, or the number "
+             "of fragments they store closed segments as "
+             "(--erasureCodeDataFragments plus --erasureCodeParityFragments) "
+             "if that is larger.")
             ("reset",
              ProgramOptions::bool_switch(&reset),
              "If specified, the coordinator will not attempt to recover "
              "any existing cluster state; it will start a new cluster "
-             "from scratch.");
+             "from scratch.")
+            ("serverListFanout",
+             ProgramOptions::value<uint32_t>(&serverListFanout)->
+                default_value(8),
+             "Server list updates are sent to one server, which forwards "
+             "them to at most this many others, each of which forwards them "
+             "on in turn, so the coordinator sends few RPCs even in large "
+             "clusters. 0 means the coordinator sends every server its own "
+             "updates.");
 
         OptionParser optionParser(coordinatorOptions, argc, argv);
 
@@ -144,7 +209,16 @@ main(int argc, char *argv[])
                                               deadServerTimeout,
                                               false,
                                               neverKill);
+        context.coordinatorServerList->setUpdateFanout(serverListFanout);
+        context.coordinatorServerList->setReplicationGroupSize(
+                replicationGroupSize);
+        context.recoveryManager->setMaxActiveRecoveries(maxActiveRecoveries);
+        context.recoveryManager->setOnDemandRecovery(onDemandRecovery);
+        context.recoveryManager->setClusterRestart(clusterRestart);
         AdminService adminService(&context, NULL, NULL);
+        TabletBalancer balancer(&context, &coordinatorService.tableManager,
+                                balancerConfig);
+        balancer.start();
         while (true) {
             context.dispatch->poll();
         }
@@ -59,6 +59,7 @@ CoordinatorRpcWrapper::send()
 {
     session = context->coordinatorSession->getSession();
     state = IN_PROGRESS;
+    RpcTrace::recordSend(&request);
     session->sendRequest(&request, response, this);
 }
 
@@ -14,6 +14,7 @@
  */
 
 #include <list>
+#include <set>
 #include <unordered_map>
 
 #include "ServerListEntry.pb.h"
@@ -26,6 +27,7 @@
 #include "MasterRecoveryManager.h"
 #include "ServerTracker.h"
 #include "ShortMacros.h"
+#include "TableManager.h"
 #include "TransportManager.h"
 #include "Context.h"
 
@@ -60,6 +62,7 @@ CoordinatorServerList::CoordinatorServerList(Context* context)
     , numUpdatingServers(0)
     , replicationGroupSize(3)
     , maxReplicationId(0)
+    , updateFanout(0)
 {
     context->coordinatorServerList = this;
 }
@@ -249,6 +252,10 @@ CoordinatorServerList::recover(uint64_t lastCompletedUpdate)
     vector<ExternalStorage::Object> objects;
     context->externalStorage->getChildren("servers", &objects);
 
+    // Entries whose updates have been rescheduled, to be written back to
+    // external storage.
+    vector<ExternalStorage::Write> rescheduled;
+
     // Each iteration through the following loop processes information
     // for one entry in the server list.
     foreach (ExternalStorage::Object& object, objects) {
@@ -362,10 +369,14 @@ CoordinatorServerList::recover(uint64_t lastCompletedUpdate)
             // Must save the to ExternalStorage to guarantee durability
             // of the new sequence numbers for updates (otherwise, another
             // coordinator crash before the updates are completed could
-            // cause the updates never to be finished).
-            entry->sync(context->externalStorage);
+            // cause the updates never to be finished). The entries are
+            // written together once they have all been processed; that's
+            // safe because none of the updates can be marked finished on
+            // external storage until recovery completes.
+            entry->sync(&rescheduled);
         }
     }
+    context->externalStorage->setMultiple(rescheduled);
 
     // Repair inconsistencies in the replication groups.
     repairReplicationGroups(lock);
@@ -536,6 +547,43 @@ CoordinatorServerList::setMasterRecoveryInfo(
     }
 }
 
+/**
+ * Choose whether incremental server list updates are sent to each server
+ * by the coordinator or forwarded from server to server. With N servers
+ * and a fanout of F, the coordinator sends one RPC per
+ * MAX_SERVERS_PER_UPDATE_TREE servers for each batch of updates instead of
+ * N RPCs, and the updates reach every server after about log_F(N) hops. New servers are always sent a full list
+ * directly.
+ *
+ * \param fanout
+ *      Maximum number of servers each server forwards updates to; 0 means
+ *      don't forward.
+ */
+void
+CoordinatorServerList::setUpdateFanout(uint32_t fanout)
+{
+    Lock _(mutex);
+    updateFanout = fanout;
+}
+
+/**
+ * Change the number of backups in each replication group (used by masters
+ * running MinCopysets). Groups of any other size are broken up and their
+ * backups regrouped.
+ *
+ * \param size
+ *      Number of backups per replication group: the number of replicas
+ *      masters keep of each segment, or the number of fragments they store
+ *      closed segments as if that is larger.
+ */
+void
+CoordinatorServerList::setReplicationGroupSize(uint32_t size)
+{
+    Lock lock(mutex);
+    replicationGroupSize = size;
+    repairReplicationGroups(lock);
+}
+
 //////////////////////////////////////////////////////////////////////
 // CoordinatorServerList Private Methods
 //////////////////////////////////////////////////////////////////////
@@ -1064,6 +1112,31 @@ CoordinatorServerList::pruneUpdates(const Lock& lock)
         listUpToDate.notify_all();
 }
 
+/**
+ * Add the current version of the tablet configuration to a server list
+ * that is about to be pushed to a server, so that a master can tell whether
+ * the table configurations it caches for clients may be out of date (see
+ * TableConfigCache).
+ *
+ * \param protoBuf
+ *      The full list or update to be sent.
+ */
+void
+CoordinatorServerList::stampTableConfigVersion(
+        ProtoBuf::ServerList* protoBuf) const
+{
+    if (context->tableManager == NULL)
+        return;
+    uint64_t epoch, version;
+    context->tableManager->getConfigVersion(&epoch, &version);
+
+    // No tablet has changed yet, so nothing cached can be out of date.
+    if (version == 0)
+        return;
+    protoBuf->set_table_config_epoch(epoch);
+    protoBuf->set_table_config_version(version);
+}
+
 /**
  * Blocks until all of the cluster is up-to-date.
  */
@@ -1156,8 +1229,10 @@ CoordinatorServerList::checkUpdates()
             rpc->wait();
             workSuccess(rpc->id, rpc->getResponseHeader<
                     WireFormat::UpdateServerList>()->currentVersion);
+            forwardingDone(rpc, true);
         } catch (const ServerNotUpException& e) {
             workFailed(rpc->id);
+            forwardingDone(rpc, false);
         }
         (*it)->destroy();
         spareRpcs.push_back(*it);
@@ -1184,6 +1259,45 @@ CoordinatorServerList::checkUpdates()
     }
 }
 
+/**
+ * Add to an incremental update RPC all of the other servers that need
+ * exactly the same updates and aren't already being updated, so that the
+ * RPC's target forwards the updates to them. Invoked by getWork; each
+ * server added counts as updating, just like the target, until
+ * forwardingDone is invoked.
+ *
+ * \param lock
+ *      Explicitly needs CoordinatorServerList lock.
+ * \param rpc
+ *      RPC that has just been constructed for \a root, with all of its
+ *      updates.
+ * \param root
+ *      The server \a rpc is addressed to; its updateVersion has already
+ *      been advanced (but not its verifiedVersion).
+ */
+void
+CoordinatorServerList::addForwardTargets(const Lock& lock,
+        UpdateServerListRpc* rpc, Entry* root)
+{
+    vector<ServerId> targets;
+    for (size_t i = 0; i < serverList.size() &&
+            targets.size() < MAX_SERVERS_PER_UPDATE_TREE - 1; i++) {
+        Entry* server = serverList[i].entry.get();
+        if (server == NULL || server == root ||
+                server->status != ServerStatus::UP ||
+                !server->services.has(WireFormat::ADMIN_SERVICE) ||
+                server->verifiedVersion != root->verifiedVersion ||
+                server->updateVersion != server->verifiedVersion) {
+            continue;
+        }
+        server->updateVersion = root->updateVersion;
+        numUpdatingServers++;
+        targets.push_back(server->serverId);
+    }
+    if (!targets.empty())
+        rpc->forwardTo(targets, updateFanout);
+}
+
 /**
  * Attempts to find servers that require updates and don't already
  * have outstanding update rpcs.
@@ -1249,11 +1363,17 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
                     ProtoBuf::ServerList fullList;
                     serialize(lock, &fullList, {WireFormat::MASTER_SERVICE,
                             WireFormat::BACKUP_SERVICE});
+                    stampTableConfigVersion(&fullList);
                     rpc->construct(context, server->serverId, &fullList);
                     server->updateVersion = version;
                 } else {
                     // Incremental update(s). Create an RPC containing all
-                    // the updates that this server hasn't yet seen.
+                    // the updates that this server hasn't yet seen, merged
+                    // into a single delta as long as their versions are
+                    // consecutive.
+                    ProtoBuf::ServerList delta;
+                    delta.set_type(ProtoBuf::ServerList_Type_UPDATE);
+                    uint64_t baseVersion = 0;
                     int updatesInRpc = 0;
                     for (size_t i = 0; i < updates.size(); i++) {
                         ServerListUpdate* update = &updates[i];
@@ -1261,17 +1381,30 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
                             continue;
                         }
                         if (updatesInRpc == 0) {
-                            rpc->construct(context, server->serverId,
-                                    &update->incremental);
-                        } else {
-                            (*rpc)->appendServerList(&update->incremental);
+                            baseVersion = update->version - 1;
+                        } else if (update->version !=
+                                delta.version_number() + 1) {
+                            break;
                         }
-                        server->updateVersion = update->version;
+                        foreach (const ProtoBuf::ServerList_Entry& entry,
+                                update->incremental.server()) {
+                            *delta.add_server() = entry;
+                        }
+                        delta.set_version_number(update->version);
                         updatesInRpc++;
                         if (updatesInRpc >= MAX_UPDATES_PER_RPC) {
                             break;
                         }
                     }
+                    if (updatesInRpc > 1) {
+                        delta.set_base_version(baseVersion);
+                    }
+                    stampTableConfigVersion(&delta);
+                    rpc->construct(context, server->serverId, &delta);
+                    server->updateVersion = delta.version_number();
+                    if (updateFanout > 0) {
+                        addForwardTargets(lock, rpc->get(), server);
+                    }
                 }
 
                 numUpdatingServers++;
@@ -1309,6 +1442,47 @@ CoordinatorServerList::getWork(Tub<UpdateServerListRpc>* rpc) {
     return false;
 }
 
+/**
+ * Invoked when an update RPC completes to invoke workSuccess or workFailed
+ * for each of the servers it was supposed to be forwarded to (see
+ * addForwardTargets).
+ *
+ * \param rpc
+ *      The completed RPC.
+ * \param succeeded
+ *      True means the RPC's target responded, so the response says which
+ *      of the forwarding targets were updated; false means none of them
+ *      can be assumed to have been.
+ */
+void
+CoordinatorServerList::forwardingDone(UpdateServerListRpc* rpc,
+        bool succeeded)
+{
+    typedef WireFormat::UpdateServerList::Response::ForwardResult Result;
+    if (rpc->forwardTargets.empty())
+        return;
+
+    std::set<uint64_t> remaining;
+    foreach (ServerId id, rpc->forwardTargets)
+        remaining.insert(id.getId());
+    if (succeeded) {
+        Buffer* response = rpc->response;
+        uint32_t offset = sizeof32(WireFormat::UpdateServerList::Response);
+        for (; offset + sizeof32(Result) <= response->size();
+                offset += sizeof32(Result)) {
+            const Result* result = response->getOffset<Result>(offset);
+            if (remaining.erase(result->serverId) == 0)
+                continue;
+            if (result->status == STATUS_OK)
+                workSuccess(ServerId(result->serverId), result->currentVersion);
+            else
+                workFailed(ServerId(result->serverId));
+        }
+    }
+    foreach (uint64_t id, remaining)
+        workFailed(ServerId(id));
+}
+
 /**
  * Signals the success of updater to complete an update RPC. This
  * will update internal metadata to allow the target server to be
@@ -1445,6 +1619,7 @@ CoordinatorServerList::UpdateServerListRpc::UpdateServerListRpc(
             const ProtoBuf::ServerList* list)
     : ServerIdRpcWrapper(context, serverId,
             sizeof(WireFormat::UpdateServerList::Response))
+    , forwardTargets()
 {
     allocHeader<WireFormat::UpdateServerList>(serverId);
 
@@ -1491,6 +1666,34 @@ CoordinatorServerList::UpdateServerListRpc::appendServerList(
 }
 
 
+/**
+ * Ask the target server to pass the updates in this RPC on to other
+ * servers (see AdminService::updateServerList). This must be invoked after
+ * the last appendServerList and before send().
+ *
+ * \param targets
+ *      Servers that need exactly the same updates as the target.
+ * \param fanout
+ *      Maximum number of servers that any one server forwards to directly.
+ */
+void
+CoordinatorServerList::UpdateServerListRpc::forwardTo(
+        const vector<ServerId>& targets, uint32_t fanout)
+{
+    assert(this->getState() == NOT_STARTED);
+    WireFormat::UpdateServerList::Request* reqHdr = request.getStart<
+            WireFormat::UpdateServerList::Request>();
+    reqHdr->forwardCount += downCast<uint32_t>(targets.size());
+    reqHdr->fanout = fanout;
+    foreach (ServerId id, targets) {
+        request.emplaceAppend<
+                WireFormat::UpdateServerList::Request::ForwardTarget>()
+                ->serverId = id.getId();
+        forwardTargets.push_back(id);
+    }
+}
+
+
 //////////////////////////////////////////////////////////////////////
 // CoordinatorServerList::Entry Methods
 //////////////////////////////////////////////////////////////////////
@@ -1563,6 +1766,22 @@ CoordinatorServerList::Entry::serialize(ProtoBuf::ServerList_Entry* dest) const
  */
 void
 CoordinatorServerList::Entry::sync(ExternalStorage* externalStorage)
+{
+    vector<ExternalStorage::Write> writes;
+    sync(&writes);
+    externalStorage->setMultiple(writes);
+}
+
+/**
+ * Prepare a persistent copy of a server list entry, like the other sync
+ * method, but add it to a batch of writes for ExternalStorage::setMultiple
+ * rather than writing it right away.
+ *
+ * \param writes
+ *      The write for this entry is appended here.
+ */
+void
+CoordinatorServerList::Entry::sync(vector<ExternalStorage::Write>* writes)
 {
     ProtoBuf::ServerListEntry externalInfo;
     externalInfo.set_services(services.serialize());
@@ -1588,7 +1807,6 @@ CoordinatorServerList::Entry::sync(ExternalStorage* externalStorage)
 
     string str;
     externalInfo.SerializeToString(&str);
-    externalStorage->set(ExternalStorage::UPDATE, objectName, str.c_str(),
-            downCast<int>(str.length()));
+    writes->emplace_back(ExternalStorage::UPDATE, objectName, str);
 }
 } // namespace RAMCloud
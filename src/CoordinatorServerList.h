@@ -68,6 +68,11 @@ class CoordinatorServerList : public AbstractServerList{
     /// batching, small enough that we never overflow the RPC size limit).
     static const int MAX_UPDATES_PER_RPC = 100;
 
+    /// Maximum number of servers to send one UPDATE_SERVER_LIST RPC to
+    /// when updates are forwarded from server to server (see
+    /// setUpdateFanout).
+    static const uint32_t MAX_SERVERS_PER_UPDATE_TREE = 1000;
+
     /**
      * This class represents one entry in the CoordinatorServerList. Each
      * entry describes a specific server in the system and contains the
@@ -87,6 +92,7 @@ class CoordinatorServerList : public AbstractServerList{
         Entry& operator=(const Entry& other) = default;
         void serialize(ProtoBuf::ServerList_Entry* dest) const;
         void sync(ExternalStorage* externalStorage);
+        void sync(vector<ExternalStorage::Write>* writes);
 
         bool isMaster() const {
             return (status == ServerStatus::UP) &&
@@ -176,6 +182,8 @@ class CoordinatorServerList : public AbstractServerList{
     virtual void serverCrashed(ServerId serverId);
     bool setMasterRecoveryInfo(ServerId serverId,
                 const ProtoBuf::MasterRecoveryInfo* recoveryInfo);
+    void setReplicationGroupSize(uint32_t size);
+    void setUpdateFanout(uint32_t fanout);
     void startUpdater();
 
   PRIVATE:
@@ -219,6 +227,12 @@ class CoordinatorServerList : public AbstractServerList{
 
       PRIVATE:
         bool appendServerList(const ProtoBuf::ServerList* list);
+        void forwardTo(const vector<ServerId>& targets, uint32_t fanout);
+
+        /// Servers that the target server should forward the updates to;
+        /// see forwardTo.
+        vector<ServerId> forwardTargets;
+
         DISALLOW_COPY_AND_ASSIGN(UpdateServerListRpc);
     };
 
@@ -313,6 +327,7 @@ class CoordinatorServerList : public AbstractServerList{
     void serialize(const Lock& lock, ProtoBuf::ServerList* protoBuf) const;
     void serialize(const Lock& lock, ProtoBuf::ServerList* protoBuf,
                    ServiceMask services) const;
+    void stampTableConfigVersion(ProtoBuf::ServerList* protoBuf) const;
 
     /// Functions related to replication groups.
     bool assignReplicationGroup(const Lock& lock, uint64_t replicationId,
@@ -331,7 +346,10 @@ class CoordinatorServerList : public AbstractServerList{
     bool isClusterUpToDate(const Lock& lock);
     void pruneUpdates(const Lock& lock);
 
+    void addForwardTargets(const Lock& lock, UpdateServerListRpc* rpc,
+                           Entry* root);
     bool getWork(Tub<UpdateServerListRpc>* rpc);
+    void forwardingDone(UpdateServerListRpc* rpc, bool succeeded);
     void workSuccess(ServerId id, uint64_t currentVersion);
     void workFailed(ServerId id);
     void waitForWork();
@@ -416,9 +434,8 @@ class CoordinatorServerList : public AbstractServerList{
     uint32_t numUpdatingServers;
 
     /**
-     * The number of backups in a replication group. Currently there is
-     * no way to set this value based on cluster configuration information
-     * (RAM-555).
+     * The number of backups in a replication group; see
+     * setReplicationGroupSize().
      */
     uint32_t replicationGroupSize;
 
@@ -427,6 +444,17 @@ class CoordinatorServerList : public AbstractServerList{
      * Note: id 0 is never used.
      */
     uint64_t maxReplicationId;
+
+    /**
+     * If nonzero, incremental updates are disseminated over trees of
+     * servers: an UPDATE_SERVER_LIST RPC is sent to one server along with
+     * a list of other servers that need exactly the same updates, and each
+     * server forwards to at most this many others (see
+     * AdminService::updateServerList). Zero means every server is sent its
+     * own RPC by the coordinator.
+     */
+    uint32_t updateFanout;
+
     DISALLOW_COPY_AND_ASSIGN(CoordinatorServerList);
 };
 } // namespace RAMCloud
@@ -228,7 +228,9 @@ class CoordinatorServerListTest : public ::testing::Test {
         result.append(format("opcode: %s", WireFormat::opcodeSymbol(
                 request->common.opcode)));
         uint32_t offset = sizeof32(*request);
-        while (offset <totalLength) {
+        uint32_t targetsOffset = totalLength - request->forwardCount *
+                sizeof32(WireFormat::UpdateServerList::Request::ForwardTarget);
+        while (offset < targetsOffset) {
             const WireFormat::UpdateServerList::Request::Part* part =
                     buffer->getOffset<
                     WireFormat::UpdateServerList::Request::Part>(offset);
@@ -251,6 +253,16 @@ class CoordinatorServerListTest : public ::testing::Test {
                     pb.ShortDebugString().c_str()));
             offset += part->serverListLength;
         }
+        if (request->forwardCount > 0) {
+            result.append(format(", fanout: %u, forward to:",
+                    request->fanout));
+            for (; offset < totalLength; offset += sizeof32(
+                    WireFormat::UpdateServerList::Request::ForwardTarget)) {
+                result.append(" " + ServerId(buffer->getOffset<
+                        WireFormat::UpdateServerList::Request::ForwardTarget>(
+                        offset)->serverId).toString());
+            }
+        }
         return result;
     }
 
@@ -835,6 +847,23 @@ TEST_F(CoordinatorServerListTest, setMasterRecoveryInfo_noSuchServer) {
     EXPECT_EQ("", cluster.externalStorage.log);
 }
 
+TEST_F(CoordinatorServerListTest, setReplicationGroupSize) {
+    sl->serverList.resize(10);
+    for (int i = 1; i <= 6; i++) {
+        sl->serverList[i].entry.construct(ServerId(i, 0), "server",
+                ServiceMask({WireFormat::BACKUP_SERVICE}));
+        sl->serverList[i].entry->status = ServerStatus::UP;
+        sl->serverList[i].entry->replicationId = (i <= 3) ? 1 : 0;
+    }
+    TestLog::Enable _("repairReplicationGroups");
+    sl->setReplicationGroupSize(6);
+    EXPECT_EQ(6u, sl->replicationGroupSize);
+    EXPECT_EQ("repairReplicationGroups: Removing replication group 1 "
+            "(has 3 members)", TestLog::get());
+    for (int i = 1; i <= 6; i++)
+        EXPECT_EQ(2lu, sl->serverList[i].entry->replicationId);
+}
+
 //////////////////////////////////////////////////////////////////////
 // Unit Tests for CoordinatorServerList Private Methods
 //////////////////////////////////////////////////////////////////////
@@ -1301,6 +1330,22 @@ TEST_F(CoordinatorServerListTest, pruneUpdates_cleanupRemovedServer) {
     EXPECT_FALSE(sl->serverList[id1.indexNumber()].entry);
 }
 
+TEST_F(CoordinatorServerListTest, stampTableConfigVersion) {
+    // No tablet has changed yet.
+    ProtoBuf::ServerList list;
+    sl->stampTableConfigVersion(&list);
+    EXPECT_FALSE(list.has_table_config_version());
+
+    TableManager* tableManager = &service->tableManager;
+    tableManager->testCreateTable("foo", 1);
+    tableManager->testAddTablet({1, 0, ~0lu, {1, 0}, Tablet::NORMAL, {2, 3}});
+    sl->stampTableConfigVersion(&list);
+    uint64_t epoch, version;
+    tableManager->getConfigVersion(&epoch, &version);
+    EXPECT_EQ(epoch, list.table_config_epoch());
+    EXPECT_EQ(1U, list.table_config_version());
+}
+
 TEST_F(CoordinatorServerListTest, sync) {
     // Test that sync wakes up thread and flushes all updates
     sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 100,
@@ -1308,7 +1353,7 @@ TEST_F(CoordinatorServerListTest, sync) {
     transport->setInput("0 1 0");
 
     sl->sync();
-    EXPECT_EQ("sendRequest: 0x30023 1 0 11 273 0 /0 /x18/0",
+    EXPECT_EQ("sendRequest: 0x30023 0 0 1 0 0 0 11 273 0 /0 /x18/0",
             transport->outputLog);
     transport->clearOutput();
 
@@ -1519,15 +1564,13 @@ TEST_F(CoordinatorServerListTest, getWork_incrementalUpdates) {
             "protobuf: server { services: 1 server_id: 2 "
             "service_locator: \"mock:host=server2\" "
             "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
-            "version_number: 5 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 3 "
+            "server { services: 1 server_id: 3 "
             "service_locator: \"mock:host=server3\" "
             "expected_read_mbytes_per_sec: 0 status: 1 replication_id: 0 } "
-            "version_number: 6 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 2 "
+            "server { services: 1 server_id: 2 "
             "service_locator: \"mock:host=server2\" "
             "expected_read_mbytes_per_sec: 0 status: 2 replication_id: 0 } "
-            "version_number: 7 type: UPDATE",
+            "version_number: 7 type: UPDATE base_version: 4",
             parseUpdateRequest(&rpc->request));
     EXPECT_EQ(4lu, sl->lastScan.minVersion);
     CoordinatorServerList::Entry* e = sl->getEntry(id4);
@@ -1552,11 +1595,10 @@ TEST_F(CoordinatorServerListTest, getWork_skipEntriesAlreadySeen) {
             "protobuf: server { services: 1 server_id: 3 "
             "service_locator: \"mock:host=server3\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
-            "version_number: 3 type: UPDATE, "
-            "protobuf: server { services: 1 server_id: 4 "
+            "server { services: 1 server_id: 4 "
             "service_locator: \"mock:host=server4\" "
             "expected_read_mbytes_per_sec: 0 status: 0 replication_id: 0 } "
-            "version_number: 4 type: UPDATE",
+            "version_number: 4 type: UPDATE base_version: 2",
             parseUpdateRequest(&rpc->request));
     EXPECT_EQ(4lu, e->updateVersion);
 }
@@ -1613,6 +1655,89 @@ TEST_F(CoordinatorServerListTest, getWork_noUpdatableServers) {
 static const uint64_t UNINITIALIZED_VERSION =
         CoordinatorServerList::UNINITIALIZED_VERSION;
 
+TEST_F(CoordinatorServerListTest, getWork_forwarding) {
+    sl->setUpdateFanout(2);
+    ServerId id1 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server1");
+    ServerId id2 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server2");
+    ServerId id3 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server3");
+    sl->enlistServer({WireFormat::MASTER_SERVICE}, 0, 0,
+            "mock:host=server4");
+    ServerId id5 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server5");
+    foreach (ServerId id, std::vector<ServerId>({id1, id2, id3})) {
+        CoordinatorServerList::Entry* e = sl->getEntry(id);
+        e->updateVersion = e->verifiedVersion = 3;
+    }
+    sl->getEntry(id5)->updateVersion = sl->getEntry(id5)->verifiedVersion = 4;
+
+    // Servers 1-3 need the same updates, so one RPC covers all of them;
+    // server 4 can't be updated and server 5 needs different updates.
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(id1, rpc->id);
+    EXPECT_TRUE(TestUtil::contains(parseUpdateRequest(&rpc->request),
+            "version_number: 5 type: UPDATE base_version: 3, "
+            "fanout: 2, forward to: 2.0 3.0"));
+    EXPECT_EQ(5lu, sl->getEntry(id2)->updateVersion);
+    EXPECT_EQ(5lu, sl->getEntry(id3)->updateVersion);
+    EXPECT_EQ(3lu, sl->numUpdatingServers);
+
+    EXPECT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(id5, rpc->id);
+    EXPECT_TRUE(TestUtil::contains(parseUpdateRequest(&rpc->request),
+            "version_number: 5 type: UPDATE"));
+    EXPECT_FALSE(TestUtil::contains(parseUpdateRequest(&rpc->request),
+            "forward"));
+    EXPECT_EQ(4lu, sl->numUpdatingServers);
+}
+
+TEST_F(CoordinatorServerListTest, forwardingDone) {
+    typedef WireFormat::UpdateServerList::Response::ForwardResult Result;
+    sl->setUpdateFanout(2);
+    ServerId id1 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server1");
+    ServerId id2 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server2");
+    ServerId id3 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server3");
+    ServerId id4 = sl->enlistServer({WireFormat::ADMIN_SERVICE}, 0, 0,
+            "mock:host=server4");
+    foreach (ServerId id, std::vector<ServerId>({id1, id2, id3, id4})) {
+        CoordinatorServerList::Entry* e = sl->getEntry(id);
+        e->updateVersion = e->verifiedVersion = 2;
+    }
+    ASSERT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(4lu, sl->numUpdatingServers);
+
+    // Server 2 was updated, server 3 couldn't be reached, and server 4
+    // isn't mentioned at all.
+    rpc->response->fillFromString("0 4 0");
+    Result* result = rpc->response->emplaceAppend<Result>();
+    result->serverId = id2.getId();
+    result->currentVersion = 4;
+    result->status = STATUS_OK;
+    result = rpc->response->emplaceAppend<Result>();
+    result->serverId = id3.getId();
+    result->currentVersion = 0;
+    result->status = STATUS_SERVER_NOT_UP;
+    sl->workSuccess(rpc->id, 4);
+    sl->forwardingDone(rpc.get(), true);
+    EXPECT_EQ(4lu, sl->getEntry(id2)->verifiedVersion);
+    EXPECT_EQ(2lu, sl->getEntry(id3)->verifiedVersion);
+    EXPECT_EQ(2lu, sl->getEntry(id3)->updateVersion);
+    EXPECT_EQ(2lu, sl->getEntry(id4)->updateVersion);
+    EXPECT_EQ(0lu, sl->numUpdatingServers);
+
+    // If the target didn't respond, none of the others count as updated.
+    ASSERT_TRUE(sl->getWork(&rpc));
+    EXPECT_EQ(2lu, sl->numUpdatingServers);
+    sl->workFailed(rpc->id);
+    sl->forwardingDone(rpc.get(), false);
+    EXPECT_EQ(0lu, sl->numUpdatingServers);
+}
+
 TEST_F(CoordinatorServerListTest, workSuccess) {
     uint64_t initialVersion = sl->version;
 
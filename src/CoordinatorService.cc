@@ -19,6 +19,7 @@
 
 #include "BackupClient.h"
 #include "CoordinatorService.h"
+#include "FlatTableConfig.h"
 #include "MasterClient.h"
 #include "ProtoBuf.h"
 #include "Recovery.h"
@@ -216,6 +217,10 @@ CoordinatorService::dispatch(WireFormat::Opcode opcode,
             callHandler<WireFormat::RenewLease, CoordinatorService,
                         &CoordinatorService::renewLease>(rpc);
             break;
+        case WireFormat::RenewLeases::opcode:
+            callHandler<WireFormat::RenewLeases, CoordinatorService,
+                        &CoordinatorService::renewLeases>(rpc);
+            break;
         case WireFormat::ServerControlAll::opcode:
             callHandler<WireFormat::ServerControlAll, CoordinatorService,
                         &CoordinatorService::serverControlAll>(rpc);
@@ -312,7 +317,10 @@ CoordinatorService::createTable(
                                  reqHdr->nameLength);
     uint32_t serverSpan = reqHdr->serverSpan;
 
-    respHdr->tableId = tableManager.createTable(name, serverSpan);
+    respHdr->tableId = tableManager.createTable(name, serverSpan, ServerId(),
+            Key::HashFunction(reqHdr->keyHash));
+    respHdr->keyHash = downCast<uint8_t>(
+            Key::getHashFunction(respHdr->tableId));
 }
 
 /**
@@ -477,9 +485,19 @@ CoordinatorService::getTableConfig(
         Rpc* rpc)
 {
     ProtoBuf::TableConfig tableConfig;
-    tableManager.serializeTableConfig(&tableConfig, reqHdr->tableId);
-    respHdr->tableConfigLength = serializeToResponse(rpc->replyPayload,
-                                                     &tableConfig);
+    uint64_t epoch = reqHdr->knownEpoch;
+    uint64_t version = reqHdr->knownVersion;
+    respHdr->incremental = tableManager.serializeTableConfig(&tableConfig,
+            reqHdr->tableId, &epoch, &version);
+    respHdr->configEpoch = epoch;
+    respHdr->configVersion = version;
+    if (reqHdr->flatFormat) {
+        respHdr->tableConfigLength = FlatTableConfig::encode(tableConfig,
+                                                             rpc->replyPayload);
+    } else {
+        respHdr->tableConfigLength = serializeToResponse(rpc->replyPayload,
+                                                         &tableConfig);
+    }
 }
 
 /**
@@ -498,6 +516,7 @@ CoordinatorService::getTableId(
     try {
         uint64_t tableId = tableManager.getTableId(name);
         respHdr->tableId = tableId;
+        respHdr->keyHash = downCast<uint8_t>(Key::getHashFunction(tableId));
     } catch (TableManager::NoSuchTable& e) {
         respHdr->common.status = STATUS_TABLE_DOESNT_EXIST;
         return;
@@ -615,6 +634,33 @@ CoordinatorService::renewLease(
     respHdr->lease = leaseAuthority.renewLease(reqHdr->leaseId);
 }
 
+/**
+ * Handle the RENEW_LEASES RPC.
+ *
+ * \copydetails Service::ping
+ */
+void
+CoordinatorService::renewLeases(
+    const WireFormat::RenewLeases::Request* reqHdr,
+    WireFormat::RenewLeases::Response* respHdr,
+    Rpc* rpc)
+{
+    uint32_t count = reqHdr->leaseCount;
+    const uint64_t* leaseIds = static_cast<const uint64_t*>(
+            rpc->requestPayload->getRange(sizeof32(*reqHdr),
+                                          count * sizeof32(uint64_t)));
+    if (count > 0 && leaseIds == NULL) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+
+    WireFormat::ClientLease* leases =
+            static_cast<WireFormat::ClientLease*>(rpc->replyPayload->alloc(
+                    count * sizeof(WireFormat::ClientLease)));
+    leaseAuthority.renewLeases(count, leaseIds, leases);
+    respHdr->leaseCount = count;
+}
+
 /**
  * Send ServerControl RPCs to all servers in the ServerList.
  *
@@ -109,6 +109,9 @@ class CoordinatorService : public Service {
     void renewLease(const WireFormat::RenewLease::Request* reqHdr,
                     WireFormat::RenewLease::Response* respHdr,
                     Rpc* rpc);
+    void renewLeases(const WireFormat::RenewLeases::Request* reqHdr,
+                     WireFormat::RenewLeases::Response* respHdr,
+                     Rpc* rpc);
     void serverControlAll(const WireFormat::ServerControlAll::Request* reqHdr,
             WireFormat::ServerControlAll::Response* respHdr,
             Rpc* rpc);
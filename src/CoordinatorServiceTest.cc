@@ -232,6 +232,106 @@ TEST_F(CoordinatorServiceTest, getTableConfig_indexInfo) {
     EXPECT_EQ("", tableConfigProtoBuf.ShortDebugString());
 }
 
+TEST_F(CoordinatorServiceTest, getTableConfig_incremental) {
+    uint64_t tableId = ramcloud->createTable("foo", 2);
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t epoch = 0, version = 0;
+    GetTableConfigRpc rpc(&context, tableId);
+    EXPECT_FALSE(rpc.wait(&tableConfig, &epoch, &version));
+    EXPECT_EQ(2, tableConfig.tablet_size());
+
+    service->tableManager.splitTablet(tableId,
+            0xc000000000000000);
+    tableConfig.Clear();
+    GetTableConfigRpc rpc2(&context, tableId, epoch, version);
+    EXPECT_TRUE(rpc2.wait(&tableConfig, &epoch, &version));
+    ASSERT_EQ(2, tableConfig.tablet_size());
+    EXPECT_EQ(0x8000000000000000U, tableConfig.tablet(0).start_key_hash());
+    EXPECT_EQ(0xc000000000000000U, tableConfig.tablet(1).start_key_hash());
+    EXPECT_EQ("mock:host=master", tableConfig.tablet(1).service_locator());
+}
+
+TEST_F(CoordinatorServiceTest, getTableConfig_fromMaster) {
+    uint64_t tableId = ramcloud->createTable("foo", 2);
+    service->tableManager.splitTablet(tableId, 0xc000000000000000);
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t epoch = 0, version = 0;
+    GetTableConfigRpc rpc(&context, tableId, 0, 0, false, "mock:host=master");
+    EXPECT_FALSE(rpc.wait(&tableConfig, &epoch, &version));
+    EXPECT_EQ(3, tableConfig.tablet_size());
+    EXPECT_EQ(1U, master->tableConfigCache.configs.count(tableId));
+
+    // Masters always return the whole configuration.
+    service->tableManager.splitTablet(tableId, 0xe000000000000000);
+    tableConfig.Clear();
+    GetTableConfigRpc rpc2(&context, tableId, epoch, version, false,
+            "mock:host=master");
+    EXPECT_FALSE(rpc2.wait(&tableConfig, &epoch, &version));
+    EXPECT_EQ(4, tableConfig.tablet_size());
+}
+
+TEST_F(CoordinatorServiceTest, getTableConfig_fromMasterFallsBack) {
+    uint64_t tableId = ramcloud->createTable("foo", 2);
+    ProtoBuf::TableConfig tableConfig;
+
+    // Can't reach the master.
+    GetTableConfigRpc rpc(&context, tableId, 0, 0, false, "mock:host=bogus");
+    EXPECT_FALSE(rpc.wait(&tableConfig));
+    EXPECT_EQ(2, tableConfig.tablet_size());
+    EXPECT_EQ("", rpc.masterLocator);
+
+    // Not a master.
+    tableConfig.Clear();
+    GetTableConfigRpc rpc2(&context, tableId, 0, 0, false,
+            "mock:host=coordinator");
+    EXPECT_FALSE(rpc2.wait(&tableConfig));
+    EXPECT_EQ(2, tableConfig.tablet_size());
+    EXPECT_EQ("", rpc2.masterLocator);
+}
+
+TEST_F(CoordinatorServiceTest, getTableConfig_flatFormat) {
+    uint64_t tableId = ramcloud->createTable("foo", 2);
+    ramcloud->createIndex(tableId, 2, 1);
+    FlatTableConfig tableConfig;
+    uint64_t epoch = 0, version = 0;
+    GetTableConfigRpc rpc(&context, tableId, 0, 0, true);
+    EXPECT_FALSE(rpc.wait(&tableConfig, &epoch, &version));
+    ASSERT_EQ(2u, tableConfig.getTabletCount());
+    EXPECT_EQ(0x8000000000000000U,
+              tableConfig.getTablet(1).startKeyHash);
+    EXPECT_EQ(1u, tableConfig.getTablet(1).serverId);
+    EXPECT_EQ("mock:host=master", string(
+            tableConfig.getString(tableConfig.getTablet(1).locatorOffset),
+            tableConfig.getTablet(1).locatorLength));
+    ASSERT_EQ(1u, tableConfig.getIndexletCount());
+    EXPECT_EQ(2u, tableConfig.getIndexlet(0).indexId);
+
+    service->tableManager.splitTablet(tableId, 0xc000000000000000);
+    FlatTableConfig changes;
+    GetTableConfigRpc rpc2(&context, tableId, epoch, version, true);
+    EXPECT_TRUE(rpc2.wait(&changes, &epoch, &version));
+    ASSERT_EQ(2u, changes.getTabletCount());
+    EXPECT_EQ(0xc000000000000000U, changes.getTablet(1).startKeyHash);
+}
+
+TEST_F(CoordinatorServiceTest, getTableConfig_objectFinderMergesChanges) {
+    uint64_t tableId = ramcloud->createTable("foo", 2);
+    ObjectFinder* objectFinder = ramcloud->clientContext->objectFinder;
+    EXPECT_EQ(0U, objectFinder->lookupTablet(tableId, 0x10)->
+            tablet.startKeyHash);
+
+    service->tableManager.splitTablet(tableId, 0x1000);
+    objectFinder->flush(tableId);
+    TabletWithLocator* tablet = objectFinder->lookupTablet(tableId, 0x10);
+    EXPECT_EQ(0xfffU, tablet->tablet.endKeyHash);
+    tablet = objectFinder->lookupTablet(tableId, 0x2000);
+    EXPECT_EQ(0x1000U, tablet->tablet.startKeyHash);
+    EXPECT_EQ(0x7fffffffffffffffU, tablet->tablet.endKeyHash);
+    tablet = objectFinder->lookupTablet(tableId, ~0lu);
+    EXPECT_EQ(0x8000000000000000U, tablet->tablet.startKeyHash);
+    EXPECT_EQ("mock:host=master", tablet->serviceLocator);
+}
+
 TEST_F(CoordinatorServiceTest, getTableConfig_invalid) {
     ramcloud->createTable("bar");
     ProtoBuf::TableConfig tableConfig;
@@ -15,6 +15,11 @@
 
 // RAMCloud pragma [CPPLINT=0]
 
+#if __SSE4_2__
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
 #include "Crc32C.h"
 #include "Logger.h"
 #include "ShortMacros.h"
@@ -36,12 +41,163 @@ haveSse42() {
         LOG(DEBUG, "Processor does not have SSE 4.2");
     return ret;
 }
+
+bool
+havePclmul() {
+    uint32_t a, b, c, d;
+    CPUID(1, a, b, c, d);
+    return (c & (1 << 1)) != 0;
+}
+
+/// The CRC32C polynomial, bit-reversed.
+const uint32_t POLY = 0x82f63b78;
+
+/**
+ * Multiply two polynomials modulo POLY, in the bit-reversed representation
+ * used by the crc32 instruction (the most significant bit holds the
+ * coefficient of x^0).
+ */
+uint32_t
+multModP(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31;
+    uint32_t product = 0;
+    for (;;) {
+        if (a & m) {
+            product ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? ((b >> 1) ^ POLY) : (b >> 1);
+    }
+    return product;
+}
+
+/**
+ * Return x^n modulo POLY (bit-reversed).
+ */
+uint32_t
+xPowModP(uint64_t n)
+{
+    uint32_t result = 1u << 31;             // x^0
+    uint32_t square = 1u << 30;             // x^1
+    while (n != 0) {
+        if (n & 1)
+            result = multModP(result, square);
+        square = multModP(square, square);
+        n >>= 1;
+    }
+    return result;
+}
 } // anonymous namespace
 
 #if __SSE4_2__
 bool Crc32C::haveHardware = haveSse42();
+bool Crc32C::haveInterleaved = haveHardware && havePclmul();
+
+/**
+ * Advance a raw CRC32C register value over \a bytes zero bytes; that is,
+ * multiply it by x^(8*bytes) modulo POLY. If crcA is the register after
+ * the data A, and crcB is the register obtained by starting from 0 and
+ * processing B, then the register after A followed by B is
+ * shift(crcA, |B|) ^ crcB.
+ *
+ * \param crc
+ *      Register value to shift.
+ * \param constant
+ *      x^(8*bytes - 33) modulo POLY; the extra x^-33 compensates for the
+ *      x^32 that the crc32 instruction multiplies by and the 1-bit offset
+ *      of the carry-less product of two reversed values.
+ */
+static inline uint32_t __attribute__((target("pclmul")))
+shift(uint32_t crc, uint32_t constant)
+{
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc),
+            _mm_cvtsi32_si128(constant), 0);
+    return downCast<uint32_t>(_mm_crc32_u64(0,
+            static_cast<uint64_t>(_mm_cvtsi128_si64(product))));
+}
+
+/**
+ * Run the crc32 instruction over three adjacent blocks of \a blockBytes
+ * each, as three independent dependency chains, and combine the results.
+ * The instruction has a latency of 3 cycles but a throughput of 1 per
+ * cycle, so this is about three times as fast as a single chain.
+ *
+ * \param crc
+ *      Raw register value before the blocks.
+ * \param p
+ *      First word of the first block.
+ * \param blockBytes
+ *      Size of each block; a multiple of 8.
+ * \param constant
+ *      See shift(); for blockBytes.
+ * \return
+ *      Raw register value after the three blocks.
+ */
+static inline uint32_t __attribute__((target("pclmul")))
+threeBlocks(uint32_t crc, const uint64_t* p, uint32_t blockBytes,
+        uint32_t constant)
+{
+    uint32_t words = blockBytes / 8;
+    uint64_t crc0 = crc;
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (const uint64_t* end = p + words; p < end; p++) {
+        crc0 = _mm_crc32_u64(crc0, p[0]);
+        crc1 = _mm_crc32_u64(crc1, p[words]);
+        crc2 = _mm_crc32_u64(crc2, p[2 * words]);
+    }
+    crc = shift(downCast<uint32_t>(crc0), constant) ^
+            downCast<uint32_t>(crc1);
+    return shift(crc, constant) ^ downCast<uint32_t>(crc2);
+}
+
+/**
+ * Version of intelCrc32C for large inputs, which runs three streams of
+ * crc32 instructions in parallel and merges them with carry-less
+ * multiplies. Used by Crc32C::update on machines with SSE 4.2 and
+ * PCLMULQDQ.
+ *
+ * \param crc
+ *      Raw register value before the data.
+ * \param buffer
+ *      Data to checksum.
+ * \param bytes
+ *      Length of the data.
+ * \return
+ *      Raw register value after the data.
+ */
+uint32_t
+Crc32C::interleavedCrc32C(uint32_t crc, const void* buffer, uint64_t bytes)
+{
+    static const uint32_t longConstant = xPowModP(8 * LONG_BLOCK - 33);
+    static const uint32_t shortConstant = xPowModP(8 * SHORT_BLOCK - 33);
+
+    const uint64_t* p = static_cast<const uint64_t*>(buffer);
+    while (bytes >= 3 * LONG_BLOCK) {
+        crc = threeBlocks(crc, p, LONG_BLOCK, longConstant);
+        p += 3 * LONG_BLOCK / 8;
+        bytes -= 3 * LONG_BLOCK;
+    }
+    while (bytes >= 3 * SHORT_BLOCK) {
+        crc = threeBlocks(crc, p, SHORT_BLOCK, shortConstant);
+        p += 3 * SHORT_BLOCK / 8;
+        bytes -= 3 * SHORT_BLOCK;
+    }
+    return intelCrc32C(crc, p, bytes);
+}
 #else
 bool Crc32C::haveHardware = false;
+bool Crc32C::haveInterleaved = false;
+
+/// Never used when SSE 4.2 isn't enabled at compile-time.
+uint32_t
+Crc32C::interleavedCrc32C(uint32_t crc, const void* buffer, uint64_t bytes)
+{
+    return intelCrc32C(crc, buffer, bytes);
+}
 #endif
 
 } // namespace RAMCloud
@@ -162,7 +162,10 @@ softwareCrc32C(uint32_t crc, const void* data, uint64_t length)
  * This function uses the "crc32" instruction found in Intel Nehalem and later
  * processors. On processors without that instruction, it calculates the same
  * function much more slowly in software (just under 400 MB/sec in software vs
- * just under 2000 MB/sec in hardware on Westmere boxes).
+ * just under 2000 MB/sec in hardware on Westmere boxes). Inputs of at least
+ * INTERLEAVE_BYTES are checksummed as three interleaved streams when the
+ * processor also has PCLMULQDQ, which roughly triples the throughput of the
+ * crc32 instruction.
  */
 class Crc32C {
   public:
@@ -200,8 +203,13 @@ class Crc32C {
     Crc32C&
     update(const void* buffer, uint32_t bytes)
     {
-        result = useHardware ? intelCrc32C(result, buffer, bytes)
-                             : softwareCrc32C(result, buffer, bytes);
+        if (!useHardware) {
+            result = softwareCrc32C(result, buffer, bytes);
+        } else if (bytes >= INTERLEAVE_BYTES && haveInterleaved) {
+            result = interleavedCrc32C(result, buffer, bytes);
+        } else {
+            result = intelCrc32C(result, buffer, bytes);
+        }
         return *this;
     }
 
@@ -249,9 +257,26 @@ class Crc32C {
     }
 
   PRIVATE:
+    static uint32_t interleavedCrc32C(uint32_t crc, const void* buffer,
+                                      uint64_t bytes);
+
+    /// Sizes of each of the three streams in interleavedCrc32C: large
+    /// inputs are processed LONG_BLOCK bytes per stream, and what
+    /// remains SHORT_BLOCK bytes per stream (combining the streams costs
+    /// about as much as 30 bytes of input).
+    static const uint32_t LONG_BLOCK = 8192;
+    static const uint32_t SHORT_BLOCK = 256;
+
+    /// Smaller inputs are always checksummed with a single stream.
+    static const uint32_t INTERLEAVE_BYTES = 3 * SHORT_BLOCK;
+
     /// Whether this machine has Intel's CRC32C instruction.
     static bool haveHardware;
 
+    /// Whether this machine also has PCLMULQDQ, so that interleavedCrc32C
+    /// can be used.
+    static bool haveInterleaved;
+
     /// Whether this checksum instance should use Intel's CRC32C instruction.
     bool useHardware;
 
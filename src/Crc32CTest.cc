@@ -126,6 +126,33 @@ TEST_P(Crc32CTest, updateFromBuffer) {
     EXPECT_EQ(c.result, d.result);
 }
 
+TEST_P(Crc32CTest, interleaved) {
+    if (forceSoftware || !Crc32C::haveInterleaved)
+        return;
+    std::vector<uint8_t> data(3 * Crc32C::LONG_BLOCK + 2000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = downCast<uint8_t>(generateRandom());
+
+    // Lengths around the cutoffs for single streams, short blocks and
+    // long blocks; the expected results come from a single stream.
+    uint32_t lengths[] = {Crc32C::INTERLEAVE_BYTES,
+                          Crc32C::INTERLEAVE_BYTES + 1,
+                          Crc32C::INTERLEAVE_BYTES + 777,
+                          3 * Crc32C::LONG_BLOCK,
+                          3 * Crc32C::LONG_BLOCK + 1999};
+    foreach (uint32_t length, lengths) {
+        EXPECT_EQ(intelCrc32C(~0u, &data[0], length),
+                  Crc32C::interleavedCrc32C(~0u, &data[0], length))
+                << "length " << length;
+        EXPECT_EQ(intelCrc32C(0x1234, &data[0], length),
+                  Crc32C::interleavedCrc32C(0x1234, &data[0], length));
+
+        // Crc32C::update picks the interleaved version by itself.
+        EXPECT_EQ(intelCrc32C(~0u, &data[0], length),
+                  Crc32C().update(&data[0], length).result);
+    }
+}
+
 TEST_P(Crc32CTest, assignmentOperator) {
     Crc32C a;
     a.update(&a, sizeof(a));
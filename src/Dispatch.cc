@@ -71,18 +71,34 @@ Dispatch::Dispatch(bool hasDedicatedThread)
     , readyEvents(0)
     , fileInvocationSerial(0)
     , timerMutex("Dispatch::timerMutex")
-    , timers()
+    , timerWheel()
+    , timerWheelOccupied()
+    , timerWheelTime(0)
+    , expiredTimers()
+    , numTimers(0)
     , earliestTriggerTime(0)
     , ownerId(ThreadId::get())
     , mutex("Dispatch::mutex")
     , lockNeeded(0)
     , locked(0)
+    , sleeping(0)
+    , idleSpinCycles(0)
+    , spinCycles(0)
     , hasDedicatedThread(hasDedicatedThread)
     , slowPollerCycles(Cycles::fromSeconds(.05))
     , profilerFlag(false)
     , totalElements(0)
     , pollingTimes(NULL)
     , nextInd(0)
+    , activitySampleInterval(0)
+    , lastActivitySampleInterval(0)
+    , pollsUntilSample(0)
+    , activitySampled(false)
+    , activities()
+    , sampledPollActivity(&activities["(all sampled polls)"])
+    , lockoutActivity(&activities["(locked out by other threads)"])
+    , fileActivity(&activities["(file handlers)"])
+    , timerActivity(&activities["(timer handlers)"])
 {
     exitPipeFds[0] = exitPipeFds[1] = -1;
 }
@@ -110,6 +126,8 @@ Dispatch::~Dispatch()
     for (uint32_t i = 0; i < pollers.size(); i++) {
         pollers[i]->owner = NULL;
         pollers[i]->slot = -1;
+        pollers[i]->busyActivity = NULL;
+        pollers[i]->idleActivity = NULL;
     }
     pollers.clear();
     for (uint32_t i = 0; i < files.size(); i++) {
@@ -123,10 +141,13 @@ Dispatch::~Dispatch()
     readyFd = -1;
     {
         std::lock_guard<SpinLock> lock(timerMutex);
-        while (timers.size() > 0) {
-            Timer* t = timers.back();
-            t->stopInternal(lock);
-            t->owner = NULL;
+        for (int bucket = -1; numTimers > 0; bucket++) {
+            std::vector<Timer*>& timers = timerBucket(bucket);
+            while (timers.size() > 0) {
+                Timer* t = timers.back();
+                t->stopInternal(lock);
+                t->owner = NULL;
+            }
         }
     }
     cleanProfiler();
@@ -154,6 +175,15 @@ Dispatch::poll()
         pollingTimes[nextInd] = currentTime - previous;
         nextInd = (nextInd + 1) % totalElements;
     }
+    activitySampled = false;
+    if (activitySampleInterval != 0) {
+        pollsUntilSample--;
+        if (pollsUntilSample == 0) {
+            pollsUntilSample = activitySampleInterval;
+            activitySampled = true;
+        }
+    }
+    uint64_t pollStart = currentTime;
     if (((currentTime - previous) > slowPollerCycles) && (previous != 0)
             && hasDedicatedThread) {
         LOG(WARNING, "Long gap in dispatcher: %.1f ms",
@@ -174,14 +204,45 @@ Dispatch::poll()
             LOG(WARNING, "Long lockout in poller: %.1f ms",
                     Cycles::toSeconds(newCurrent - currentTime)*1e03);
         }
+        if (activitySampled) {
+            lockoutActivity->cycles += newCurrent - currentTime;
+            lockoutActivity->count++;
+        }
         currentTime = newCurrent;
     }
+    uint64_t pollerStart = currentTime;
     for (uint32_t i = 0; i < pollers.size(); i++) {
+        Poller* poller = pollers[i];
+        if (poller->skipsLeft != 0) {
+            poller->skipsLeft--;
+            continue;
+        }
 #if DEBUG_SLOW_POLLERS
         uint64_t ticks = 0;
         CycleCounter<> counter(&ticks);
 #endif
-        result += pollers[i]->poll();
+        // Fetch the fields first: the poller may delete itself.
+        ActivityCounter* busy = poller->busyActivity;
+        ActivityCounter* idle = poller->idleActivity;
+        uint32_t maxSkip = poller->maxSkip;
+        int work = poller->poll();
+        result += work;
+        if ((maxSkip != 0) && (i < pollers.size()) && (pollers[i] == poller)) {
+            if (work > 0) {
+                poller->skipInterval = 0;
+            } else {
+                poller->skipInterval = std::min(
+                        std::max(2*poller->skipInterval, 1u), maxSkip);
+                poller->skipsLeft = poller->skipInterval;
+            }
+        }
+        if (activitySampled) {
+            uint64_t now = Cycles::rdtsc();
+            ActivityCounter* activity = (work > 0) ? busy : idle;
+            activity->cycles += now - pollerStart;
+            activity->count++;
+            pollerStart = now;
+        }
 #if DEBUG_SLOW_POLLERS
         counter.stop();
         if (ticks > slowPollerCycles) {
@@ -214,6 +275,7 @@ Dispatch::poll()
             // an event was being reported.
             // events &= file->events;
             if (events != 0) {
+                ActivityTimer activity(this, fileActivity);
                 file->handleFileEvent(events);
                 result++;
             }
@@ -232,8 +294,8 @@ Dispatch::poll()
     }
     if (currentTime >= earliestTriggerTime) {
         std::lock_guard<SpinLock> lock(timerMutex);
-        // Looks like a timer may have triggered. Check all the timers and
-        // invoke any that have triggered.
+        // Looks like a timer may have triggered. Move all of the timers
+        // that have triggered into expiredTimers, then invoke them.
         //
         // There are two goals here:
         // * Invoke every timer that has triggered.
@@ -241,29 +303,32 @@ Dispatch::poll()
         //   handler for a timer reschedules the timer in the past, don't
         //   run it a second time; otherwise an infinite loop could result).
         //
-        // The goals are (mostly) met by processing the Timers in reverse
-        // order (highest array element first). If the handler for one
-        // timer A stops another timer B, this could cause a timer C that
-        // was already processed to move into B's slot in the timers
-        // vector, which could cause it to be invoked multiple times.
+        // The goals are (mostly) met by processing expiredTimers in reverse
+        // order (highest array element first): timers started by handlers
+        // are appended, beyond the part still to be processed. If the
+        // handler for one timer A stops another timer B, this could cause
+        // a timer C that was already processed to move into B's slot in
+        // the vector, which could cause it to be invoked multiple times.
         // However, we can't get stuck: i drops by 1 in each iteration
         // through the loop.
-        for (int i = downCast<int>(timers.size()) - 1 ; i >= 0; --i) {
-            Timer* timer = timers[i];
+        advanceTimers(currentTime + 1);
+        for (int i = downCast<int>(expiredTimers.size()) - 1 ; i >= 0; --i) {
+            Timer* timer = expiredTimers[i];
             if (timer->triggerTime <= currentTime) {
                 timer->stopInternal(lock);
                 {
                     // Release the lock while the handler is running,
                     // to avoid deadlocks.
                     Unlock<SpinLock> unlock(timerMutex);
+                    ActivityTimer activity(this, timerActivity);
                     timer->handleTimerEvent();
                 }
                 result++;
-                if (i >= downCast<int>(timers.size())) {
+                if (i >= downCast<int>(expiredTimers.size())) {
                     // A whole bunch of timers got deleted while this
                     // handler was running; make sure we keep i inside
                     // the bounds of the array.
-                    i = downCast<int>(timers.size());
+                    i = downCast<int>(expiredTimers.size());
                 }
             }
         }
@@ -272,13 +337,12 @@ Dispatch::poll()
         // in the loop above, because one timer handler could delete
         // another, which can rearrange the list and cause us to miss
         // a trigger time.
-        earliestTriggerTime = ~(0ull);
-        for (uint32_t i = 0; i < timers.size(); i++) {
-            Timer* timer = timers[i];
-            if (timer->triggerTime < earliestTriggerTime) {
-                earliestTriggerTime = timer->triggerTime;
-            }
-        }
+        updateEarliestTriggerTime();
+    }
+    if (activitySampled) {
+        sampledPollActivity->cycles += Cycles::rdtsc() - pollStart;
+        sampledPollActivity->count++;
+        activitySampled = false;
     }
     return result;
 }
@@ -293,11 +357,128 @@ Dispatch::run()
 {
     PerfStats::registerStats(&PerfStats::threadStats);
     uint64_t prev;
+    uint64_t lastBusy = Cycles::rdtsc();
     while (true) {
         prev = currentTime;
         if (poll() > 0) {
             PerfStats::threadStats.dispatchActiveCycles +=
                     currentTime - prev;
+            lastBusy = currentTime;
+        } else if ((idleSpinCycles != 0) &&
+                ((currentTime - lastBusy) >= spinCycles)) {
+            // Whether or not we actually slept, don't consider sleeping
+            // again until we've spun for another full window.
+            sleep();
+            lastBusy = Cycles::rdtsc();
+        }
+    }
+}
+
+/**
+ * Arrange for #run to stop polling when there has been no work for a while,
+ * and block in the kernel until there is work again. This trades some
+ * latency for the first request after an idle period (the time to wake up
+ * the thread) for the CPU time that polling would burn. Sleeping only
+ * happens when every Poller agrees (see Poller::canSleep); otherwise the
+ * dispatcher keeps polling as usual.
+ *
+ * \param micros
+ *      How long to poll without finding any work before sleeping. 0 means
+ *      never sleep, which is the default and gives the lowest latency.
+ *      This is only a starting point: if the dispatch thread keeps getting
+ *      woken up right after going to sleep, the window grows (up to
+ *      MAX_SPIN_FACTOR times this value), and it shrinks back when the
+ *      thread sleeps undisturbed.
+ */
+void
+Dispatch::setIdleSpinTime(uint32_t micros)
+{
+    idleSpinCycles = Cycles::fromMicroseconds(micros);
+    spinCycles = idleSpinCycles;
+}
+
+/**
+ * Block the dispatch thread until there might be work for it: a file
+ * becomes ready, another thread wants the Dispatch::Lock or invokes
+ * #wakeUp, or the next timer is due. Invoked by #run when it has found no
+ * work for a while.
+ *
+ * \return
+ *      True means the thread slept; false means it didn't, because some
+ *      Poller can't be left unpolled or because work was already waiting.
+ */
+bool
+Dispatch::sleep()
+{
+    // Announce that we're going to sleep before checking for work, so
+    // that anyone who adds work after our checks will see #sleeping and
+    // wake us up. This pairs with the fence in #wakeUp.
+    sleeping.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool canSleep = (readyFd < 0) && (lockNeeded.load() == 0);
+    for (uint32_t i = 0; canSleep && (i < pollers.size()); i++) {
+        canSleep = pollers[i]->canSleep();
+    }
+    uint64_t start = Cycles::rdtsc();
+    uint64_t wakeTime = start + Cycles::fromMicroseconds(MAX_SLEEP_MICROS);
+    if (earliestTriggerTime < wakeTime) {
+        wakeTime = earliestTriggerTime;
+    }
+    if (!canSleep || (wakeTime <= start)) {
+        sleeping.store(0);
+        return false;
+    }
+
+    uint64_t nanos = Cycles::toNanoseconds(wakeTime - start);
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(nanos / 1000000000);
+    timeout.tv_nsec = static_cast<long>(nanos % 1000000000); // NOLINT
+    bool timedOut = false;
+    if (sys->futexWait(reinterpret_cast<int*>(&sleeping), 1, &timeout)
+            == -1) {
+        // EWOULDBLOCK means someone already woke us up, and EINTR is
+        // harmless too: we'll just check for work right away.
+        if (errno == ETIMEDOUT) {
+            timedOut = true;
+        } else if ((errno != EWOULDBLOCK) && (errno != EINTR)) {
+            LOG(ERROR, "futexWait failed in Dispatch::sleep: %s",
+                    strerror(errno));
+        }
+    }
+    sleeping.store(0);
+    uint64_t slept = Cycles::rdtsc() - start;
+
+    // Whatever woke us up may be work for a cold poller; don't make it
+    // wait out its backoff.
+    for (uint32_t i = 0; i < pollers.size(); i++) {
+        pollers[i]->skipsLeft = 0;
+    }
+    PerfStats::threadStats.dispatchSleepCycles += slept;
+    PerfStats::threadStats.dispatchSleeps++;
+
+    // If work showed up sooner than we would have stopped spinning, the
+    // wakeup cost was added to that request's latency for nothing; spin
+    // longer next time. Undisturbed sleeps mean that the load really is
+    // low, so drift back toward the configured window.
+    if (!timedOut && (slept < spinCycles)) {
+        spinCycles = std::min(2*spinCycles, MAX_SPIN_FACTOR*idleSpinCycles);
+    } else if (timedOut) {
+        spinCycles = std::max(spinCycles/2, idleSpinCycles);
+    }
+    return true;
+}
+
+/**
+ * Does the work of #wakeUp once it has seen that the dispatch thread may
+ * be sleeping.
+ */
+void
+Dispatch::wakeUpSlow()
+{
+    if (sleeping.exchange(0) != 0) {
+        if (sys->futexWake(reinterpret_cast<int*>(&sleeping), 1) == -1) {
+            LOG(ERROR, "futexWake failed in Dispatch::wakeUp: %s",
+                    strerror(errno));
         }
     }
 }
@@ -381,6 +562,100 @@ Dispatch::dumpProfile(const char* fileName) {
     }
 }
 
+/**
+ * Start the activity profiler, which breaks down the time of the dispatch
+ * thread by what it was doing: which poller found work (or found none),
+ * file and timer handlers, waiting for other threads to release the
+ * dispatch lock, and anything else that charges its time to a named
+ * counter with ActivityTimer (WorkerManager does, by RPC opcode). It is
+ * cheap enough to leave running: only one out of every \a sampleInterval
+ * iterations of #poll is timed, with a few rdtsc calls. Any counts from
+ * an earlier run of the profiler are discarded.
+ *
+ * \param sampleInterval
+ *      Time one out of this many polling iterations; 1 times all of them.
+ *      0 stops the profiler.
+ */
+void
+Dispatch::startActivityProfiler(uint32_t sampleInterval)
+{
+    Lock lock(this);
+    for (std::map<string, ActivityCounter>::iterator it = activities.begin();
+            it != activities.end(); it++) {
+        it->second = ActivityCounter();
+    }
+    activitySampleInterval = sampleInterval;
+    lastActivitySampleInterval = sampleInterval;
+    pollsUntilSample = sampleInterval;
+}
+
+/**
+ * Stop the activity profiler. Its counts are kept, so
+ * getActivityProfile() still returns them.
+ */
+void
+Dispatch::stopActivityProfiler()
+{
+    Lock lock(this);
+    activitySampleInterval = 0;
+}
+
+/**
+ * Return the activity profiler counter with a given name, creating it if
+ * needed. The counter lives as long as this object does; it is normally
+ * fetched once and then updated with ActivityTimer.
+ *
+ * Like the Poller constructor, this must be invoked either in the dispatch
+ * thread or with a Dispatch::Lock held.
+ *
+ * \param name
+ *      Identifies the activity in the output of getActivityProfile().
+ *      All callers passing the same name share a counter.
+ */
+Dispatch::ActivityCounter*
+Dispatch::getActivityCounter(const string& name)
+{
+    assert((locked.load() != 0) || isDispatchThread());
+    return &activities[name];
+}
+
+/**
+ * Return a human-readable summary of what the activity profiler has
+ * found: one line for each activity that was seen, busiest first, giving
+ * its share of the dispatch thread's polling time, its estimated number
+ * of invocations and the average time of each.
+ */
+string
+Dispatch::getActivityProfile()
+{
+    Lock lock(this);
+    uint64_t interval = lastActivitySampleInterval;
+    double total = static_cast<double>(sampledPollActivity->cycles);
+    string result = format("Activity profile: %lu polls sampled "
+            "(1 in %lu), %.1f ms of polling\n", sampledPollActivity->count,
+            interval,
+            Cycles::toSeconds(sampledPollActivity->cycles) * 1e03);
+
+    std::vector<std::pair<uint64_t, string>> sorted;
+    for (std::map<string, ActivityCounter>::iterator it = activities.begin();
+            it != activities.end(); it++) {
+        if ((it->second.count != 0) && (&it->second != sampledPollActivity))
+            sorted.push_back(std::make_pair(it->second.cycles, it->first));
+    }
+    std::sort(sorted.rbegin(), sorted.rend());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const ActivityCounter& counter = activities[sorted[i].second];
+        result.append(format("%-40s %6.2f%% %12lu calls %9.1f ns/call\n",
+                sorted[i].second.c_str(),
+                (total == 0) ? 0.0 :
+                        100.0 * static_cast<double>(counter.cycles) / total,
+                counter.count * interval,
+                Cycles::toSeconds(counter.cycles) * 1e09 /
+                        static_cast<double>(counter.count)));
+    }
+    return result;
+}
+
 /**
  * Releases allocated resources for dispatch profiling.
  */
@@ -406,10 +681,17 @@ Dispatch::cleanProfiler() {
 Dispatch::Poller::Poller(Dispatch* dispatch, const string& pollerName)
     : owner(dispatch)
     , pollerName(pollerName)
+    , busyActivity(NULL)
+    , idleActivity(NULL)
+    , maxSkip(0)
+    , skipInterval(0)
+    , skipsLeft(0)
     , slot(downCast<int>(owner->pollers.size()))
 {
     CHECK_LOCK;
     owner->pollers.push_back(this);
+    busyActivity = &owner->activities[pollerName];
+    idleActivity = &owner->activities[pollerName + " (idle)"];
 }
 
 /**
@@ -436,6 +718,28 @@ Dispatch::Poller::~Poller()
     slot = -1;
 }
 
+/**
+ * Choose how often the dispatcher invokes this poller. Pollers that
+ * watch for latency-critical work, such as the receive queue of a NIC,
+ * should stay hot (the default) and be invoked on every pass through the
+ * polling loop. Pollers that rarely find work can be made cold, so that
+ * the dispatcher backs off exponentially while they stay idle and spends
+ * that time on the hot pollers instead. A cold poller is invoked on every
+ * pass again as soon as it finds work, and after the dispatcher sleeps.
+ *
+ * \param maxSkip
+ *      Largest number of consecutive passes through the polling loop
+ *      that may skip this poller; this bounds the extra delay before it
+ *      notices new work. 0 makes the poller hot.
+ */
+void
+Dispatch::Poller::setMaxSkip(uint32_t maxSkip)
+{
+    this->maxSkip = maxSkip;
+    skipInterval = 0;
+    skipsLeft = 0;
+}
+
 /**
  * Construct a file handler.
  *
@@ -632,6 +936,7 @@ try {
             // modification of readyFd.
             Fence::sfence();
             owner->readyFd = events[i].data.fd;
+            owner->wakeUp();
         }
     }
 } catch (const std::exception& e) {
@@ -642,6 +947,179 @@ try {
     throw;
 }
 
+/**
+ * Add a timer to the timer wheel, based on its trigger time. The caller
+ * must hold timerMutex.
+ *
+ * \param timer
+ *      Timer to add; must not be running.
+ */
+void
+Dispatch::addTimer(Timer* timer)
+{
+    std::vector<Timer*>* timers = &expiredTimers;
+    timer->bucket = -1;
+    if (timer->triggerTime >= timerWheelTime) {
+        uint64_t diff = timer->triggerTime ^ timerWheelTime;
+        int level = (diff == 0) ? 0 :
+                (63 - __builtin_clzll(diff)) / TIMER_WHEEL_BITS;
+        uint32_t slot = downCast<uint32_t>(
+                (timer->triggerTime >> (level * TIMER_WHEEL_BITS)) &
+                (TIMER_WHEEL_SLOTS - 1));
+        timer->bucket = level * TIMER_WHEEL_SLOTS + slot;
+        timerWheelOccupied[level] |= 1lu << slot;
+        timers = &timerWheel[level][slot];
+    }
+    timer->slot = downCast<int>(timers->size());
+    timers->push_back(timer);
+    numTimers++;
+}
+
+/**
+ * Advance timerWheelTime, moving every timer whose trigger time is earlier
+ * than the new time into expiredTimers. The caller must hold timerMutex.
+ *
+ * \param time
+ *      New value for timerWheelTime; nothing happens if this isn't later
+ *      than the current value.
+ */
+void
+Dispatch::advanceTimers(uint64_t time)
+{
+    const uint64_t mask = TIMER_WHEEL_SLOTS - 1;
+    while (timerWheelTime < time) {
+        // Expire the buckets at level 0 that are due. Level 0 never holds
+        // timers earlier than timerWheelTime, so start there.
+        bool lastGroup = (time >> TIMER_WHEEL_BITS) ==
+                (timerWheelTime >> TIMER_WHEEL_BITS);
+        uint64_t due = timerWheelOccupied[0] &
+                (~0lu << (timerWheelTime & mask));
+        if (lastGroup)
+            due &= (1lu << (time & mask)) - 1;
+        while (due != 0) {
+            uint32_t slot = downCast<uint32_t>(__builtin_ctzll(due));
+            due &= due - 1;
+            foreach (Timer* timer, timerWheel[0][slot]) {
+                timer->bucket = -1;
+                timer->slot = downCast<int>(expiredTimers.size());
+                expiredTimers.push_back(timer);
+            }
+            timerWheel[0][slot].clear();
+            timerWheelOccupied[0] &= ~(1lu << slot);
+        }
+        if (lastGroup) {
+            timerWheelTime = time;
+            return;
+        }
+
+        // Level 0 is now empty. Skip ahead to the first nonempty bucket
+        // at a higher level, and cascade it.
+        int level = 1;
+        while ((level < TIMER_WHEEL_LEVELS) &&
+                (timerWheelOccupied[level] == 0)) {
+            level++;
+        }
+        if (level == TIMER_WHEEL_LEVELS) {
+            timerWheelTime = time;
+            return;
+        }
+        uint32_t slot = downCast<uint32_t>(
+                __builtin_ctzll(timerWheelOccupied[level]));
+        int shift = (level + 1) * TIMER_WHEEL_BITS;
+        uint64_t next = (shift >= 64) ? 0 : (timerWheelTime >> shift) << shift;
+        next |= uint64_t(slot) << (level * TIMER_WHEEL_BITS);
+        if (next > time) {
+            timerWheelTime = time;
+            return;
+        }
+        timerWheelTime = next;
+        cascadeTimers(level, slot);
+    }
+}
+
+/**
+ * Redistribute the timers in one bucket of the timer wheel to lower
+ * levels; called when timerWheelTime reaches the start of the bucket.
+ * The caller must hold timerMutex.
+ *
+ * \param level
+ *      Level of the bucket in timerWheel; must be at least 1.
+ * \param slot
+ *      Index of the bucket within its level.
+ */
+void
+Dispatch::cascadeTimers(int level, uint32_t slot)
+{
+    std::vector<Timer*> timers;
+    timers.swap(timerWheel[level][slot]);
+    timerWheelOccupied[level] &= ~(1lu << slot);
+    numTimers -= downCast<uint32_t>(timers.size());
+    foreach (Timer* timer, timers)
+        addTimer(timer);
+}
+
+/**
+ * Remove a timer from the timer wheel. The caller must hold timerMutex.
+ *
+ * \param timer
+ *      Timer to remove; must be running.
+ */
+void
+Dispatch::removeTimer(Timer* timer)
+{
+    // Overwrite the timer's slot with the last timer in its bucket.
+    std::vector<Timer*>& timers = timerBucket(timer->bucket);
+    timers[timer->slot] = timers.back();
+    timers[timer->slot]->slot = timer->slot;
+    timers.pop_back();
+    if (timers.empty() && (timer->bucket >= 0)) {
+        timerWheelOccupied[timer->bucket / TIMER_WHEEL_SLOTS] &=
+                ~(1lu << (timer->bucket % TIMER_WHEEL_SLOTS));
+    }
+    timer->slot = -1;
+    numTimers--;
+}
+
+/**
+ * Return the list of timers identified by a value of Timer::bucket.
+ */
+std::vector<Dispatch::Timer*>&
+Dispatch::timerBucket(int bucket)
+{
+    if (bucket < 0)
+        return expiredTimers;
+    return timerWheel[bucket / TIMER_WHEEL_SLOTS][bucket % TIMER_WHEEL_SLOTS];
+}
+
+/**
+ * Recompute earliestTriggerTime from the timer wheel. For timers above
+ * level 0 this uses the start time of their bucket, which may be a bit
+ * early; the poll at that time just cascades the bucket. The caller must
+ * hold timerMutex.
+ */
+void
+Dispatch::updateEarliestTriggerTime()
+{
+    earliestTriggerTime = ~(0ull);
+    foreach (Timer* timer, expiredTimers) {
+        if (timer->triggerTime < earliestTriggerTime) {
+            earliestTriggerTime = timer->triggerTime;
+        }
+    }
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (timerWheelOccupied[level] == 0)
+            continue;
+        uint64_t slot = __builtin_ctzll(timerWheelOccupied[level]);
+        int shift = (level + 1) * TIMER_WHEEL_BITS;
+        uint64_t start = (shift >= 64) ? 0 :
+                (timerWheelTime >> shift) << shift;
+        start |= slot << (level * TIMER_WHEEL_BITS);
+        if (start < earliestTriggerTime)
+            earliestTriggerTime = start;
+        break;
+    }
+}
+
 /**
  * Return true if the given fd has some event ready.
  */
@@ -669,7 +1147,7 @@ Dispatch::fdIsReady(int fd)
  *      Dispatch object that will manage this timer.
  */
 Dispatch::Timer::Timer(Dispatch* dispatch)
-    : owner(dispatch), triggerTime(0), slot(-1)
+    : owner(dispatch), triggerTime(0), slot(-1), bucket(-1)
 {
 }
 
@@ -683,7 +1161,7 @@ Dispatch::Timer::Timer(Dispatch* dispatch)
  *      returned by #Cycles::rdtsc).
  */
 Dispatch::Timer::Timer(Dispatch* dispatch, uint64_t cycles)
-        : owner(dispatch), triggerTime(0), slot(-1)
+        : owner(dispatch), triggerTime(0), slot(-1), bucket(-1)
 {
     start(cycles);
 }
@@ -732,13 +1210,15 @@ Dispatch::Timer::start(uint64_t rdtscTime)
     }
     std::lock_guard<SpinLock> lock(owner->timerMutex);
 
+    if (slot >= 0)
+        owner->removeTimer(this);
     triggerTime = rdtscTime;
-    if (slot < 0) {
-        slot = downCast<unsigned>(owner->timers.size());
-        owner->timers.push_back(this);
-    }
+    owner->addTimer(this);
     if (triggerTime < owner->earliestTriggerTime) {
         owner->earliestTriggerTime = triggerTime;
+
+        // The dispatch thread may be sleeping until the old trigger time.
+        owner->wakeUp();
     }
 }
 
@@ -752,19 +1232,13 @@ Dispatch::Timer::start(uint64_t rdtscTime)
 void
 Dispatch::Timer::stopInternal(std::lock_guard<SpinLock>& lock)
 {
-    // Remove this Timer from the timers vector by overwriting its slot
-    // with the timer that used to be the last one in the vector.
-    //
-    // Note: this approach using a vector is reentrant.  It is safe
-    // to delete a Timer while executing a timer callback, which means
-    // that Dispatch::poll is in the middle of scanning the list of all
-    // Timers; the worst that will happen is that the Timer that got
-    // moved may be invoked twice in the current scan (but only if it
-    // ran, rescheduled itself, and its new trigger time has passed).
-    owner->timers[slot] = owner->timers.back();
-    owner->timers[slot]->slot = slot;
-    owner->timers.pop_back();
-    slot = -1;
+    // Note: removeTimer is reentrant.  It is safe to delete a Timer
+    // while executing a timer callback, which means that Dispatch::poll
+    // is in the middle of scanning expiredTimers; the worst that will
+    // happen is that the Timer that got moved may be invoked twice in
+    // the current scan (but only if it ran, rescheduled itself, and its
+    // new trigger time has passed).
+    owner->removeTimer(this);
 }
 
 /**
@@ -826,6 +1300,7 @@ Dispatch::Lock::Lock(Dispatch* dispatch)
     Fence::sfence();
     Fence::lfence();
     dispatch->lockNeeded.store(1);
+    dispatch->wakeUp();
     while (dispatch->locked.load() == 0) {
         // Empty loop: spin-wait for the dispatch thread to lock itself.
     }
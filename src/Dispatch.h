@@ -21,10 +21,12 @@
 #else
 #include <cstdatomic>
 #endif
+#include <map>
 #include <thread>
 
 #include "Common.h"
 #include "Atomic.h"
+#include "Cycles.h"
 #include "ThreadId.h"
 #include "Tub.h"
 #include "SpinLock.h"
@@ -66,6 +68,29 @@ class Dispatch {
 
     int poll();
     void run() __attribute__ ((noreturn));
+    void setIdleSpinTime(uint32_t micros);
+
+    /**
+     * Make sure the dispatch thread notices new work: if it is sleeping
+     * (see #setIdleSpinTime), wake it up. This must be invoked after
+     * making work visible to a Poller whose #Poller::canSleep method
+     * returns true, if the work comes from a thread other than the
+     * dispatch thread.
+     */
+    void
+    wakeUp()
+    {
+        if (idleSpinCycles == 0) {
+            return;
+        }
+
+        // The store that made the work visible must complete before
+        // we look at #sleeping (see #sleep).
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load() != 0) {
+            wakeUpSlow();
+        }
+    }
 
     /// The return value from rdtsc at the beginning of the last call to
     /// #poll.  May be read from multiple threads, so must be volatile.
@@ -82,9 +107,67 @@ class Dispatch {
 
     void dumpProfile(const char* fileName);
 
+    /**
+     * Dispatch-thread time charged to one activity (a poller, a kind of
+     * RPC, etc.) by the activity profiler; see #startActivityProfiler.
+     * Only sampled iterations of #poll are counted.
+     */
+    struct ActivityCounter {
+        ActivityCounter()
+            : cycles(0)
+            , count(0)
+        {}
+
+        /// Total Cycles::rdtsc ticks spent in the activity.
+        uint64_t cycles;
+
+        /// Number of times the activity ran.
+        uint64_t count;
+    };
+
+    /**
+     * Charges the time from construction to destruction of an object to
+     * an ActivityCounter, if the current iteration of Dispatch::poll is
+     * being sampled by the activity profiler (otherwise this costs one
+     * test). Must only be used in the dispatch thread.
+     */
+    class ActivityTimer {
+      public:
+        ActivityTimer(Dispatch* dispatch, ActivityCounter* counter)
+            : counter(dispatch->activitySampled ? counter : NULL)
+            , startTime(0)
+        {
+            if (this->counter != NULL) {
+                startTime = Cycles::rdtsc();
+            }
+        }
+
+        ~ActivityTimer()
+        {
+            if (counter != NULL) {
+                counter->cycles += Cycles::rdtsc() - startTime;
+                counter->count++;
+            }
+        }
+
+      PRIVATE:
+        /// Where to charge the time; NULL if the iteration isn't sampled.
+        ActivityCounter* counter;
+
+        /// Cycles::rdtsc() time when this object was constructed.
+        uint64_t startTime;
+
+        DISALLOW_COPY_AND_ASSIGN(ActivityTimer);
+    };
+
+    void startActivityProfiler(uint32_t sampleInterval);
+    void stopActivityProfiler();
+    ActivityCounter* getActivityCounter(const string& name);
+    string getActivityProfile();
+
     /**
      * A Poller object is invoked once each time through the dispatcher's
-     * inner polling loop.
+     * inner polling loop, unless it has been marked cold with setMaxSkip.
      */
     class Poller {
       public:
@@ -101,6 +184,23 @@ class Dispatch {
          */
         virtual int poll() = 0;
 
+        /**
+         * This method is invoked by the dispatcher when it has found no
+         * work for a while and would like to block in the kernel instead
+         * of polling (see Dispatch::setIdleSpinTime). A Poller that
+         * returns true promises that it has no work pending right now, and
+         * that anyone who gives it work from another thread will invoke
+         * Dispatch::wakeUp afterwards. Pollers that watch hardware queues
+         * directly can't make that promise, so the default is false, which
+         * keeps the dispatcher polling.
+         */
+        virtual bool canSleep()
+        {
+            return false;
+        }
+
+        void setMaxSkip(uint32_t maxSkip);
+
       PROTECTED:
         /// The Dispatch object that owns this Poller.  NULL means the
         /// Dispatch has been deleted.
@@ -112,6 +212,26 @@ class Dispatch {
         string pollerName;
 
       PRIVATE:
+        /// Activity profiler counters for calls to #poll that found work
+        /// and calls that didn't (shared by all pollers with the same
+        /// name); NULL once the Dispatch has been deleted.
+        ActivityCounter* busyActivity;
+        ActivityCounter* idleActivity;
+
+        /// 0 means this poller is hot: it is invoked on every pass through
+        /// the polling loop. Otherwise it is cold, and each call to #poll
+        /// that finds no work doubles the number of passes skipped before
+        /// the next call, up to this many (see setMaxSkip).
+        uint32_t maxSkip;
+
+        /// Number of passes skipped after the most recent call to #poll;
+        /// 0 if that call found work.
+        uint32_t skipInterval;
+
+        /// Number of passes through the polling loop left to skip before
+        /// this poller is invoked again.
+        uint32_t skipsLeft;
+
         /// Index of this Poller in Dispatch::pollers.  Allows deletion
         /// without having to scan all the entries in pollers. -1 means
         /// this poller isn't currently in Dispatch::pollers (happens
@@ -210,12 +330,17 @@ class Dispatch {
         uint64_t triggerTime;
 
         /// If >= 0 this timer is running, and the value contains the
-        /// index of this Timer in Dispatch::timers. <0 means this
-        /// timer is not currently running, and isn't in Dispatch::timers.
-        /// Among other things, this value allows a timer to be deleted
-        /// without having to scan all the entries in timers.
+        /// index of this Timer in its bucket of the timer wheel (see
+        /// #bucket). <0 means this timer is not currently running, and
+        /// isn't in the wheel. Among other things, this value allows a
+        /// timer to be deleted without having to scan its bucket.
         int slot;
 
+        /// If the timer is running, identifies the list that holds it:
+        /// level * TIMER_WHEEL_SLOTS + slot for Dispatch::timerWheel, or
+        /// -1 for Dispatch::expiredTimers.
+        int bucket;
+
         friend class Dispatch;
         DISALLOW_COPY_AND_ASSIGN(Timer);
     };
@@ -251,6 +376,23 @@ class Dispatch {
     static void epollThreadMain(Dispatch* owner);
     static bool fdIsReady(int fd);
     void cleanProfiler();
+    bool sleep();
+    void wakeUpSlow();
+    void addTimer(Timer* timer);
+    void advanceTimers(uint64_t time);
+    void cascadeTimers(int level, uint32_t slot);
+    void removeTimer(Timer* timer);
+    std::vector<Timer*>& timerBucket(int bucket);
+    void updateEarliestTriggerTime();
+
+    /// The dispatch thread never blocks for longer than this, so that
+    /// anything that gives it work without invoking #wakeUp is delayed by
+    /// at most this much.
+    static const uint32_t MAX_SLEEP_MICROS = 10000;
+
+    /// When sleeping turns out to hurt latency, #run lengthens its spin
+    /// window, up to this multiple of #idleSpinCycles.
+    static const uint32_t MAX_SPIN_FACTOR = 16;
 
     // Keeps track of all of the pollers currently defined.  We don't
     // use an intrusive list here because it isn't reentrant: we need
@@ -291,14 +433,41 @@ class Dispatch {
     // of a File.
     int fileInvocationSerial;
 
-    // Protects all accesses to timers and write accesses to
-    // earliestTriggerTime.
+    // Protects all accesses to the timer wheel (the variables below
+    // through numTimers) and write accesses to earliestTriggerTime.
     SpinLock timerMutex;
 
-    // Keeps track of all of the timers that are currently active.  We
-    // don't use an intrusive list here because it isn't reentrant: we need
-    // to add/remove elements while the dispatcher is traversing the list.
-    std::vector<Timer*> timers;
+    // Active timers are kept in a hierarchical timing wheel, so that
+    // starting and stopping a timer takes constant time and poll never
+    // scans timers that aren't due. Level L of the wheel has
+    // TIMER_WHEEL_SLOTS buckets, each covering 2^(TIMER_WHEEL_BITS * L)
+    // cycles. A timer is kept at the level of the highest group of
+    // TIMER_WHEEL_BITS bits in which its trigger time differs from
+    // timerWheelTime, in the bucket given by its trigger time's bits in
+    // that group. When timerWheelTime reaches the start of a bucket above
+    // level 0, the bucket's timers are moved to lower levels ("cascaded");
+    // each timer cascades at most TIMER_WHEEL_LEVELS - 1 times. Buckets are
+    // vectors rather than intrusive lists so that timers can be added and
+    // removed while poll is running timer handlers.
+    static const int TIMER_WHEEL_BITS = 6;
+    static const uint32_t TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+    static const int TIMER_WHEEL_LEVELS = (64 + TIMER_WHEEL_BITS - 1) /
+            TIMER_WHEEL_BITS;
+    std::vector<Timer*> timerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+    // Bit i of element L is set if timerWheel[L][i] is nonempty.
+    uint64_t timerWheelOccupied[TIMER_WHEEL_LEVELS];
+
+    // Every timer whose trigger time is earlier than this is in
+    // expiredTimers, and every other running timer is in timerWheel.
+    uint64_t timerWheelTime;
+
+    // Timers whose trigger time has passed (they will be invoked by the
+    // next call to poll that gets to them).
+    std::vector<Timer*> expiredTimers;
+
+    // Total number of running timers.
+    uint32_t numTimers;
 
     // Optimization for timers: no timer will trigger sooner than this time
     // (measured in cycles).
@@ -324,6 +493,20 @@ class Dispatch {
     // Nonzero means the dispatch thread is locked.
     Atomic<int> locked;
 
+    // Nonzero means the dispatch thread is (about to be) blocked in
+    // futexWait on this word; see #sleep and #wakeUp.
+    Atomic<int> sleeping;
+
+    // How long (in Cycles::rdtsc ticks) #run keeps polling without finding
+    // work before it puts the dispatch thread to sleep. 0 means never
+    // sleep (the default).
+    uint64_t idleSpinCycles;
+
+    // The spin window currently in use by #run: starts at idleSpinCycles,
+    // and grows when the dispatch thread is woken up soon after it went to
+    // sleep (a sign that sleeping is adding latency to bursty traffic).
+    uint64_t spinCycles;
+
     /**
      * True if there is a thread which owns this dispatch (this is
      * true on RAMCloud servers).
@@ -357,6 +540,32 @@ class Dispatch {
     // last valid data point that's been taken.
     uint64_t nextInd;
 
+    // The activity profiler times one out of this many iterations of #poll;
+    // 0 means it is off. See #startActivityProfiler.
+    uint32_t activitySampleInterval;
+
+    // The sample interval of the most recent run of the activity profiler
+    // (it remains valid once the profiler stops); used to scale its counts.
+    uint32_t lastActivitySampleInterval;
+
+    // Number of #poll iterations until the next one to be sampled.
+    uint32_t pollsUntilSample;
+
+    // True while the current iteration of #poll is being sampled by the
+    // activity profiler.
+    bool activitySampled;
+
+    // The activity profiler's counters, by activity name. Elements are
+    // never removed (even when the Poller etc. they describe goes away),
+    // so pointers to them stay valid for the life of the Dispatch.
+    std::map<string, ActivityCounter> activities;
+
+    // Counters for the activities built into #poll.
+    ActivityCounter* sampledPollActivity;
+    ActivityCounter* lockoutActivity;
+    ActivityCounter* fileActivity;
+    ActivityCounter* timerActivity;
+
     static Syscall *sys;
 
     friend class Poller;
@@ -43,6 +43,15 @@ int DispatchExec::poll()
     return foundWork;
 }
 
+/**
+ * The dispatcher may sleep whenever there are no requests waiting:
+ * addRequest wakes it up.
+ */
+bool DispatchExec::canSleep()
+{
+    return requests[removeIndex].data.full == 0;
+}
+
 /**
  * Construct a DispatchExec.
  */
@@ -68,6 +77,7 @@ DispatchExec::DispatchExec(Dispatch* dispatch)
         // clear at the outset.
         memset(requests, 0, NUM_WORKER_REQUESTS * sizeof(pad));
         Fence::sfence();
+        setMaxSkip(MAX_SKIP);
 }
 
 /**
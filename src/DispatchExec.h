@@ -109,6 +109,7 @@ class DispatchExec : public Dispatch::Poller {
         explicit DispatchExec(Dispatch* dispatch);
         ~DispatchExec();
         virtual int poll();
+        virtual bool canSleep();
         void sync(uint64_t id);
 
         /**
@@ -162,6 +163,7 @@ class DispatchExec : public Dispatch::Poller {
             if (addIndex == NUM_WORKER_REQUESTS)
                 addIndex = 0;
             totalAdds++;
+            owner->wakeUp();
 
             // It is most likely that the next LambdaBox is already empty, so
             // we should prefetch it now to save time on the next invocation.
@@ -176,6 +178,11 @@ class DispatchExec : public Dispatch::Poller {
         // behind before blocking worker threads.
         static const uint16_t NUM_WORKER_REQUESTS = 100;
 
+        // Requests from worker threads are rare compared with the network
+        // traffic that the transport pollers handle, so this poller is
+        // cold: an idle dispatcher skips it for up to this many passes.
+        static const uint32_t MAX_SKIP = 8;
+
         // This is a circular buffer which contains the requests that are being
         // enqueued by the worker threads.
         LambdaBox* requests;
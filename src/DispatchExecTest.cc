@@ -54,6 +54,11 @@ class PrintArg : public DispatchExec::Lambda {
     DISALLOW_COPY_AND_ASSIGN(PrintArg);
 };
 
+TEST_F(DispatchExecTest, constructor) {
+    EXPECT_EQ(static_cast<uint32_t>(DispatchExec::MAX_SKIP),
+              dispatchExec.maxSkip);
+}
+
 TEST_F(DispatchExecTest, basics) {
     EXPECT_EQ(0, dispatchExec.poll());
     EXPECT_EQ(dispatchExec.addIndex, 0);
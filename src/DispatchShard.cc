@@ -0,0 +1,249 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "DispatchShard.h"
+#include "PerfStats.h"
+#include "ServiceLocator.h"
+#include "ShortMacros.h"
+#include "TransportManager.h"
+#include "WorkerManager.h"
+
+namespace RAMCloud {
+
+__thread DispatchShard* DispatchShard::current = NULL;
+
+/**
+ * Start a shard's dispatch thread and have it listen on the server's
+ * locators; returns once it is listening.
+ *
+ * \param context
+ *      The server's main context. Requests are served by its WorkerManager,
+ *      which must already exist.
+ * \param localLocator
+ *      Locators to listen on, as for TransportManager::initialize(). Each
+ *      one is given the reusePort option, so that all of the shards can
+ *      listen on it.
+ * \throw Exception
+ *      The shard couldn't listen on \a localLocator.
+ */
+DispatchShard::DispatchShard(Context* context, const string& localLocator)
+    : context(context)
+    , listeningLocators()
+    , startupError()
+    , requests()
+    , replies()
+    , requestPoller()
+    , ready(false)
+    , exiting(false)
+    , thread()
+{
+    assert(context->workerManager != NULL);
+    requestPoller.construct(this);
+    thread.construct(threadMain, this, withReusePort(localLocator));
+    while (!ready.load()) {
+        usleep(1000);
+    }
+    if (!startupError.empty()) {
+        thread->join();
+        thread.destroy();
+        throw Exception(HERE, startupError);
+    }
+}
+
+/**
+ * Stop the shard's thread and close its transports. The server must no
+ * longer be executing any RPCs the shard received.
+ */
+DispatchShard::~DispatchShard()
+{
+    exiting = true;
+    if (thread)
+        thread->join();
+}
+
+/**
+ * Transports running on this shard's thread pass incoming RPCs here (by
+ * way of WorkerManager::handleRpc()); they are handed over to the main
+ * dispatch thread to be served.
+ *
+ * \param rpc
+ *      RPC object containing a fully-formed request that is ready for
+ *      service.
+ */
+void
+DispatchShard::handleRpc(Transport::ServerRpc* rpc)
+{
+    rpc->shard = this;
+    requests.push(rpc);
+}
+
+/**
+ * Arrange for the reply to an RPC this shard received to be sent from the
+ * shard's thread. May be invoked from any thread; the caller must not touch
+ * \a rpc afterwards.
+ */
+void
+DispatchShard::sendReply(Transport::ServerRpc* rpc)
+{
+    replies.push(rpc);
+}
+
+/**
+ * Return \a locators with the reusePort option added to each locator that
+ * doesn't already specify it.
+ */
+string
+DispatchShard::withReusePort(const string& locators)
+{
+    string result;
+    foreach (const ServiceLocator& locator,
+            ServiceLocator::parseServiceLocators(locators)) {
+        string original = locator.getOriginalString();
+        if (!locator.hasOption("reusePort")) {
+            if (original[original.size() - 1] != ':')
+                original += ",";
+            original += "reusePort=1";
+        }
+        if (!result.empty())
+            result += ";";
+        result += original;
+    }
+    return result;
+}
+
+/**
+ * Main program of a shard's thread: creates the shard's Context and
+ * transports, then polls its Dispatch until the shard is destroyed.
+ *
+ * \param shard
+ *      The shard this thread runs.
+ * \param localLocator
+ *      Locators to listen on.
+ */
+void
+DispatchShard::threadMain(DispatchShard* shard, string localLocator)
+{
+    current = shard;
+    PerfStats::registerStats(&PerfStats::threadStats);
+
+    // The Context's Dispatch belongs to this thread. Its transports deliver
+    // requests to the server's WorkerManager, which sends them back to
+    // handleRpc() because #current is set.
+    Context context(true);
+    context.workerManager = shard->context->workerManager;
+    try {
+        ReplyPoller replyPoller(context.dispatch, shard);
+        context.transportManager->initialize(localLocator.c_str());
+        shard->listeningLocators =
+                context.transportManager->getListeningLocatorsString();
+        shard->ready = true;
+
+        while (!shard->exiting.load()) {
+            context.dispatch->poll();
+        }
+    } catch (const Exception& e) {
+        if (!shard->ready) {
+            shard->startupError = e.message;
+            shard->ready = true;
+        } else {
+            LOG(ERROR, "Dispatch shard failed: %s", e.what());
+        }
+    }
+    // The WorkerManager belongs to the server's context.
+    context.workerManager = NULL;
+}
+
+// --- DispatchShard::RpcQueue ---
+
+/// Add \a rpc to the end of the queue.
+void
+DispatchShard::RpcQueue::push(Transport::ServerRpc* rpc)
+{
+    SpinLock::Guard _(lock);
+    rpcs.push_back(rpc);
+    nonEmpty.store(true, std::memory_order_release);
+}
+
+/**
+ * Remove every RPC in the queue.
+ *
+ * \param batch
+ *      Must be empty; filled with the RPCs in the queue, in order. Its
+ *      storage is kept by the queue for later pushes.
+ * \return
+ *      True if any RPCs were removed.
+ */
+bool
+DispatchShard::RpcQueue::takeAll(std::vector<Transport::ServerRpc*>* batch)
+{
+    if (!nonEmpty.load(std::memory_order_acquire))
+        return false;
+    SpinLock::Guard _(lock);
+    batch->swap(rpcs);
+    nonEmpty.store(false, std::memory_order_relaxed);
+    return !batch->empty();
+}
+
+// --- DispatchShard::RequestPoller ---
+
+/**
+ * Construct a RequestPoller on the main dispatch thread of \a shard's
+ * server.
+ */
+DispatchShard::RequestPoller::RequestPoller(DispatchShard* shard)
+    : Dispatch::Poller(shard->context->dispatch, "DispatchShard::Requests")
+    , shard(shard)
+    , batch()
+{
+}
+
+/// Pass the shard's newly received requests to the WorkerManager.
+int
+DispatchShard::RequestPoller::poll()
+{
+    if (!shard->requests.takeAll(&batch))
+        return 0;
+    foreach (Transport::ServerRpc* rpc, batch)
+        shard->context->workerManager->handleRpc(rpc);
+    batch.clear();
+    return 1;
+}
+
+// --- DispatchShard::ReplyPoller ---
+
+/**
+ * Construct a ReplyPoller on the shard's own Dispatch.
+ */
+DispatchShard::ReplyPoller::ReplyPoller(Dispatch* dispatch,
+                                        DispatchShard* shard)
+    : Dispatch::Poller(dispatch, "DispatchShard::Replies")
+    , shard(shard)
+    , batch()
+{
+}
+
+/// Send the replies the main dispatch thread has passed back.
+int
+DispatchShard::ReplyPoller::poll()
+{
+    if (!shard->replies.takeAll(&batch))
+        return 0;
+    foreach (Transport::ServerRpc* rpc, batch)
+        rpc->sendReply();
+    batch.clear();
+    return 1;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,180 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_DISPATCHSHARD_H
+#define RAMCLOUD_DISPATCHSHARD_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+#include "Dispatch.h"
+#include "SpinLock.h"
+#include "Transport.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+/**
+ * Runs a server's listening transports on a dispatch thread of their own,
+ * so that receiving requests and sending replies for incoming RPCs can be
+ * spread over several cores instead of all happening on the server's one
+ * dispatch thread.
+ *
+ * Each shard has its own Context (and with it a Dispatch, with its own
+ * pollers and timers, and a TransportManager) whose thread creates and
+ * polls the transports for the server's local locators. All of the shards
+ * listen on the same locators: sockets are opened with SO_REUSEPORT, so the
+ * kernel partitions clients (and with them their sessions) among the
+ * shards. The server's main dispatch thread then no longer listens itself;
+ * it keeps running the WorkerManager and the transports for the server's
+ * own outgoing RPCs.
+ *
+ * Requests a shard's transports receive are passed to the main dispatch
+ * thread, which hands them out to workers as before; when an RPC completes
+ * its reply is passed back to the shard that received it, whose thread
+ * sends it. Both hand-offs go through RpcQueues, which never make a dispatch
+ * thread wait for another to make room (unlike DispatchExec, which could
+ * deadlock two dispatch threads that are feeding each other).
+ *
+ * Only transports that can share a port between sockets can be sharded:
+ * basic+udp and tcp.
+ */
+class DispatchShard {
+  PUBLIC:
+    DispatchShard(Context* context, const string& localLocator);
+    ~DispatchShard();
+
+    /// Returns the locators this shard's transports are listening on.
+    const string& getListeningLocatorsString() const {
+        return listeningLocators;
+    }
+
+    void handleRpc(Transport::ServerRpc* rpc);
+    void sendReply(Transport::ServerRpc* rpc);
+
+    /// The shard whose dispatch thread is the calling thread, or NULL if
+    /// the caller isn't running on a shard's thread.
+    static __thread DispatchShard* current;
+
+  PRIVATE:
+    /**
+     * A queue of RPCs passed from one thread to another. Any number of
+     * threads may add to it; one thread takes everything queued at once.
+     */
+    class RpcQueue {
+      public:
+        RpcQueue()
+            : lock("DispatchShard::RpcQueue")
+            , rpcs()
+            , nonEmpty(false)
+        {}
+        void push(Transport::ServerRpc* rpc);
+        bool takeAll(std::vector<Transport::ServerRpc*>* batch);
+
+      PRIVATE:
+        /// Serializes access to #rpcs.
+        SpinLock lock;
+
+        /// RPCs in the order they were pushed.
+        std::vector<Transport::ServerRpc*> rpcs;
+
+        /// True if #rpcs may be non-empty; lets the consumer check for work
+        /// without taking #lock.
+        std::atomic<bool> nonEmpty;
+
+        DISALLOW_COPY_AND_ASSIGN(RpcQueue);
+    };
+
+    /**
+     * Runs on the main dispatch thread and passes requests received by the
+     * shard to the WorkerManager.
+     */
+    class RequestPoller : public Dispatch::Poller {
+      public:
+        explicit RequestPoller(DispatchShard* shard);
+        virtual int poll();
+
+      PRIVATE:
+        /// The shard whose requests are handled.
+        DispatchShard* shard;
+
+        /// Requests taken from DispatchShard::requests, kept to reuse its
+        /// storage.
+        std::vector<Transport::ServerRpc*> batch;
+
+        DISALLOW_COPY_AND_ASSIGN(RequestPoller);
+    };
+
+    /**
+     * Runs on the shard's dispatch thread and sends the replies passed back
+     * by the main dispatch thread.
+     */
+    class ReplyPoller : public Dispatch::Poller {
+      public:
+        ReplyPoller(Dispatch* dispatch, DispatchShard* shard);
+        virtual int poll();
+
+      PRIVATE:
+        /// The shard whose replies are sent.
+        DispatchShard* shard;
+
+        /// Replies taken from DispatchShard::replies, kept to reuse its
+        /// storage.
+        std::vector<Transport::ServerRpc*> batch;
+
+        DISALLOW_COPY_AND_ASSIGN(ReplyPoller);
+    };
+
+    static string withReusePort(const string& locators);
+    static void threadMain(DispatchShard* shard, string localLocator);
+
+    /// The server's main context; its WorkerManager serves this shard's
+    /// requests.
+    Context* context;
+
+    /// See getListeningLocatorsString(); set by the shard's thread before
+    /// #ready.
+    string listeningLocators;
+
+    /// If the shard's thread couldn't start listening, describes why; set
+    /// before #ready.
+    string startupError;
+
+    /// Requests received by the shard, waiting for the main dispatch thread.
+    RpcQueue requests;
+
+    /// Replies waiting to be sent by the shard's thread.
+    RpcQueue replies;
+
+    /// Polls #requests on the main dispatch thread.
+    Tub<RequestPoller> requestPoller;
+
+    /// Set by the shard's thread once it is listening (or has failed to).
+    std::atomic<bool> ready;
+
+    /// Set to tell the shard's thread to exit.
+    std::atomic<bool> exiting;
+
+    /// Creates the shard's transports and polls its Dispatch.
+    Tub<std::thread> thread;
+
+    DISALLOW_COPY_AND_ASSIGN(DispatchShard);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_DISPATCHSHARD_H
@@ -0,0 +1,118 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "DispatchShard.h"
+#include "MockTransport.h"
+#include "MockWrapper.h"
+#include "TcpTransport.h"
+#include "WorkerManager.h"
+
+namespace RAMCloud {
+
+class DispatchShardTest : public ::testing::Test {
+  public:
+    Context context;
+    TestLog::Enable logEnabler;
+
+    DispatchShardTest()
+        : context()
+        , logEnabler()
+    {
+        context.workerManager = new WorkerManager(&context);
+        context.workerManager->testingSaveRpcs = 1;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(DispatchShardTest);
+};
+
+TEST_F(DispatchShardTest, sanityCheck) {
+    // Both shards listen on the same port; whichever one the kernel picks
+    // receives the request and sends the reply.
+    DispatchShard shard0(&context, "tcp:host=localhost,port=11010");
+    DispatchShard shard1(&context, "tcp:host=localhost,port=11010");
+    EXPECT_EQ("tcp:host=localhost,port=11010,reusePort=1",
+              shard0.getListeningLocatorsString());
+
+    TcpTransport client(&context);
+    ServiceLocator locator("tcp:host=localhost,port=11010");
+    Transport::SessionRef session = client.getSession(&locator);
+    MockWrapper rpc("request1");
+    session->sendRequest(&rpc.request, &rpc.response, &rpc);
+
+    Transport::ServerRpc* serverRpc = context.workerManager->waitForRpc(1.0);
+    ASSERT_TRUE(serverRpc != NULL);
+    EXPECT_EQ("request1", TestUtil::toString(&serverRpc->requestPayload));
+    EXPECT_TRUE(serverRpc->shard == &shard0 || serverRpc->shard == &shard1);
+
+    serverRpc->replyPayload.fillFromString("response1");
+    context.workerManager->sendReply(serverRpc);
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc));
+    EXPECT_EQ("response1", TestUtil::toString(&rpc.response));
+}
+
+TEST_F(DispatchShardTest, constructor_listenError) {
+    // A socket bound without SO_REUSEPORT keeps the shard from binding.
+    ServiceLocator locator("tcp:host=localhost,port=11011");
+    TcpTransport server(&context, &locator);
+    EXPECT_THROW(DispatchShard(&context, "tcp:host=localhost,port=11011"),
+                 Exception);
+}
+
+TEST_F(DispatchShardTest, handleRpc) {
+    MockTransport transport(&context);
+    DispatchShard shard(&context, "tcp:host=localhost,port=11012");
+    MockTransport::MockServerRpc* rpc =
+            new MockTransport::MockServerRpc(&transport, "abcdefgh");
+    shard.handleRpc(rpc);
+    EXPECT_EQ(&shard, rpc->shard);
+
+    // The request reaches the WorkerManager once the main dispatch thread
+    // polls.
+    EXPECT_EQ(rpc, context.workerManager->waitForRpc(1.0));
+    rpc->shard = NULL;
+    context.workerManager->sendReply(rpc);
+}
+
+TEST_F(DispatchShardTest, withReusePort) {
+    EXPECT_EQ("tcp:host=a,port=1,reusePort=1;"
+              "basic+udp:host=b,port=2,reusePort=0;"
+              "fast+udp:reusePort=1",
+              DispatchShard::withReusePort("tcp:host=a,port=1;"
+                                           "basic+udp:host=b,port=2,"
+                                           "reusePort=0;"
+                                           "fast+udp:"));
+}
+
+TEST_F(DispatchShardTest, RpcQueue) {
+    MockTransport transport(&context);
+    DispatchShard::RpcQueue queue;
+    std::vector<Transport::ServerRpc*> batch;
+    EXPECT_FALSE(queue.takeAll(&batch));
+
+    MockTransport::MockServerRpc rpc0(&transport, "0");
+    MockTransport::MockServerRpc rpc1(&transport, "1");
+    queue.push(&rpc0);
+    queue.push(&rpc1);
+    EXPECT_TRUE(queue.takeAll(&batch));
+    ASSERT_EQ(2u, batch.size());
+    EXPECT_EQ(&rpc0, batch[0]);
+    EXPECT_EQ(&rpc1, batch[1]);
+
+    batch.clear();
+    EXPECT_FALSE(queue.takeAll(&batch));
+}
+
+}  // namespace RAMCloud
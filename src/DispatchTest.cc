@@ -17,6 +17,7 @@
 #include "Cycles.h"
 #include "Dispatch.h"
 #include "MockSyscall.h"
+#include "PerfStats.h"
 #include "TransportManager.h"
 #include "WorkerManager.h"
 
@@ -82,6 +83,39 @@ class CountPoller : public Dispatch::Poller {
     DISALLOW_COPY_AND_ASSIGN(CountPoller);
 };
 
+// The following class is used for testing: it counts its invocations and
+// finds work only when told to.
+class IdlePoller : public Dispatch::Poller {
+  public:
+    explicit IdlePoller(Dispatch* dispatch)
+            : Dispatch::Poller(dispatch, "IdlePoller"), count(0), work(0) { }
+    int poll() {
+        count++;
+        return work;
+    }
+    int count;
+    int work;
+  private:
+    DISALLOW_COPY_AND_ASSIGN(IdlePoller);
+};
+
+// The following class is used for testing: it never finds any work, and
+// lets the dispatcher sleep unless told otherwise.
+class SleepyPoller : public Dispatch::Poller {
+  public:
+    explicit SleepyPoller(Dispatch* dispatch)
+            : Dispatch::Poller(dispatch, "SleepyPoller"), sleepOk(true) { }
+    int poll() {
+        return 0;
+    }
+    bool canSleep() {
+        return sleepOk;
+    }
+    bool sleepOk;
+  private:
+    DISALLOW_COPY_AND_ASSIGN(SleepyPoller);
+};
+
 // The following class is used for testing: it generates a log message
 // identifying this timer whenever it is invoked.
 class DummyTimer : public Dispatch::Timer {
@@ -476,6 +510,121 @@ TEST_F(DispatchTest, poll_handlerDeletesTimers) {
     EXPECT_EQ("timer t4 invoked; timer t1 invoked", *localLog);
 }
 
+TEST_F(DispatchTest, poll_coldPoller) {
+    IdlePoller hot(&dispatch);
+    IdlePoller cold(&dispatch);
+    cold.setMaxSkip(4);
+
+    // The cold poller runs on passes 1, 3, 6, 11, and 16: the gaps double
+    // up to 4 skipped passes.
+    for (int i = 0; i < 20; i++) {
+        dispatch.poll();
+    }
+    EXPECT_EQ(20, hot.count);
+    EXPECT_EQ(5, cold.count);
+    EXPECT_EQ(4u, cold.skipInterval);
+    EXPECT_EQ(0u, cold.skipsLeft);
+
+    // Once it finds work, it runs on every pass again.
+    cold.work = 1;
+    dispatch.poll();
+    dispatch.poll();
+    EXPECT_EQ(7, cold.count);
+    EXPECT_EQ(0u, cold.skipInterval);
+
+    cold.work = 0;
+    dispatch.poll();
+    EXPECT_EQ(1u, cold.skipsLeft);
+    cold.setMaxSkip(0);
+    for (int i = 0; i < 5; i++) {
+        dispatch.poll();
+    }
+    EXPECT_EQ(13, cold.count);
+}
+
+TEST_F(DispatchTest, poll_coldPollerDeletesItself) {
+    IdlePoller hot(&dispatch);
+    DummyPoller* cold = new DummyPoller("cold", 0, &dispatch);
+    cold->setMaxSkip(4);
+    cold->deleteWhenInvoked(cold);
+    dispatch.poll();
+    EXPECT_EQ(1u, dispatch.pollers.size());
+    EXPECT_EQ(0u, hot.skipsLeft);
+}
+
+TEST_F(DispatchTest, poll_activityProfiler) {
+    DummyPoller p1("p1", 0, &dispatch);
+    SleepyPoller p2(&dispatch);
+    DummyTimer t1("t1", &dispatch);
+    dispatch.poll();
+    EXPECT_EQ(0u, dispatch.activities["DummyPoller"].count);
+
+    dispatch.startActivityProfiler(2);
+    t1.start(0);
+    dispatch.poll();
+    EXPECT_FALSE(dispatch.activitySampled);
+    EXPECT_EQ(0u, dispatch.activities["DummyPoller"].count);
+    t1.start(0);
+    dispatch.poll();
+    EXPECT_FALSE(dispatch.activitySampled);
+    EXPECT_EQ(1u, dispatch.activities["DummyPoller"].count);
+    EXPECT_EQ(0u, dispatch.activities["DummyPoller (idle)"].count);
+    EXPECT_EQ(1u, dispatch.activities["SleepyPoller (idle)"].count);
+    EXPECT_EQ(0u, dispatch.activities["SleepyPoller"].count);
+    EXPECT_EQ(1u, dispatch.timerActivity->count);
+    EXPECT_EQ(1u, dispatch.sampledPollActivity->count);
+
+    dispatch.stopActivityProfiler();
+    dispatch.poll();
+    dispatch.poll();
+    EXPECT_EQ(1u, dispatch.sampledPollActivity->count);
+
+    // Restarting the profiler discards old counts.
+    dispatch.startActivityProfiler(1);
+    EXPECT_EQ(0u, dispatch.activities["DummyPoller"].count);
+    dispatch.poll();
+    EXPECT_EQ(1u, dispatch.activities["DummyPoller"].count);
+}
+
+TEST_F(DispatchTest, ActivityTimer) {
+    Dispatch::ActivityCounter* counter =
+            dispatch.getActivityCounter("test");
+    EXPECT_EQ(counter, dispatch.getActivityCounter("test"));
+    {
+        Dispatch::ActivityTimer timer(&dispatch, counter);
+    }
+    EXPECT_EQ(0u, counter->count);
+    dispatch.activitySampled = true;
+    {
+        Cycles::mockTscValue = 1000;
+        Dispatch::ActivityTimer timer(&dispatch, counter);
+        Cycles::mockTscValue = 1250;
+    }
+    EXPECT_EQ(1u, counter->count);
+    EXPECT_EQ(250u, counter->cycles);
+}
+
+TEST_F(DispatchTest, getActivityProfile) {
+    dispatch.startActivityProfiler(4);
+    dispatch.getActivityCounter("rpc READ")->cycles = 300;
+    dispatch.getActivityCounter("rpc READ")->count = 3;
+    dispatch.getActivityCounter("rpc WRITE")->cycles = 100;
+    dispatch.getActivityCounter("rpc WRITE")->count = 1;
+    dispatch.sampledPollActivity->cycles = 1000;
+    dispatch.sampledPollActivity->count = 10;
+    dispatch.stopActivityProfiler();
+    string profile = dispatch.getActivityProfile();
+    EXPECT_TRUE(TestUtil::contains(profile, "10 polls sampled (1 in 4)"));
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(
+            "rpc READ  *30.00%  *12 calls", profile));
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(
+            "rpc WRITE  *10.00%  *4 calls", profile));
+
+    // Busiest activities come first.
+    EXPECT_LT(profile.find("rpc READ"), profile.find("rpc WRITE"));
+    EXPECT_FALSE(TestUtil::contains(profile, "(timer handlers)"));
+}
+
 // No tests for Dispatch::run: it doesn't return, so can't test (it's
 // pretty simple anyway).
 
@@ -534,6 +683,109 @@ TEST_F(DispatchTest, Poller_reentrant) {
             *localLog);
 }
 
+TEST_F(DispatchTest, Poller_canSleep_default) {
+    DummyPoller p1("p1", 0, &dispatch);
+    EXPECT_FALSE(p1.canSleep());
+}
+
+TEST_F(DispatchTest, setIdleSpinTime) {
+    EXPECT_EQ(0u, dispatch.idleSpinCycles);
+    dispatch.setIdleSpinTime(100);
+    EXPECT_EQ(Cycles::fromMicroseconds(100), dispatch.idleSpinCycles);
+    EXPECT_EQ(dispatch.idleSpinCycles, dispatch.spinCycles);
+}
+
+TEST_F(DispatchTest, sleep_workPending) {
+    SleepyPoller poller(&dispatch);
+    dispatch.setIdleSpinTime(100);
+    dispatch.earliestTriggerTime = ~0lu;
+    uint64_t sleeps = PerfStats::threadStats.dispatchSleeps;
+
+    poller.sleepOk = false;
+    EXPECT_FALSE(dispatch.sleep());
+    poller.sleepOk = true;
+
+    dispatch.lockNeeded.store(1);
+    EXPECT_FALSE(dispatch.sleep());
+    dispatch.lockNeeded.store(0);
+
+    dispatch.readyFd = 3;
+    EXPECT_FALSE(dispatch.sleep());
+    dispatch.readyFd = -1;
+
+    // A timer is already due.
+    dispatch.earliestTriggerTime = 0;
+    EXPECT_FALSE(dispatch.sleep());
+
+    EXPECT_EQ(0, dispatch.sleeping.load());
+    EXPECT_EQ(sleeps, PerfStats::threadStats.dispatchSleeps);
+}
+
+TEST_F(DispatchTest, sleep_adjustSpinWindow) {
+    SleepyPoller poller(&dispatch);
+    dispatch.setIdleSpinTime(100);
+    dispatch.earliestTriggerTime = ~0lu;
+    uint64_t window = dispatch.spinCycles;
+    uint64_t sleeps = PerfStats::threadStats.dispatchSleeps;
+
+    // Woken up right away: spin longer next time, up to a limit.
+    sys->futexWaitErrno = EWOULDBLOCK;
+    EXPECT_TRUE(dispatch.sleep());
+    EXPECT_EQ(sleeps + 1, PerfStats::threadStats.dispatchSleeps);
+    EXPECT_EQ(2*window, dispatch.spinCycles);
+    for (int i = 0; i < 10; i++) {
+        sys->futexWaitErrno = EWOULDBLOCK;
+        dispatch.sleep();
+    }
+    EXPECT_EQ(Dispatch::MAX_SPIN_FACTOR*window, dispatch.spinCycles);
+
+    // Slept undisturbed: drift back down.
+    sys->futexWaitErrno = ETIMEDOUT;
+    EXPECT_TRUE(dispatch.sleep());
+    EXPECT_EQ(Dispatch::MAX_SPIN_FACTOR*window/2, dispatch.spinCycles);
+    EXPECT_EQ(0, dispatch.sleeping.load());
+}
+
+TEST_F(DispatchTest, sleep_resetColdPollers) {
+    SleepyPoller poller(&dispatch);
+    poller.setMaxSkip(8);
+    dispatch.setIdleSpinTime(100);
+    dispatch.earliestTriggerTime = ~0lu;
+    dispatch.poll();
+    EXPECT_EQ(1u, poller.skipsLeft);
+    sys->futexWaitErrno = EWOULDBLOCK;
+    EXPECT_TRUE(dispatch.sleep());
+    EXPECT_EQ(0u, poller.skipsLeft);
+}
+
+TEST_F(DispatchTest, sleep_untilTimer) {
+    SleepyPoller poller(&dispatch);
+    dispatch.setIdleSpinTime(100);
+    uint64_t start = Cycles::rdtsc();
+    dispatch.earliestTriggerTime = start + Cycles::fromMicroseconds(1000);
+    EXPECT_TRUE(dispatch.sleep());
+    EXPECT_GE(Cycles::rdtsc(), dispatch.earliestTriggerTime);
+}
+
+TEST_F(DispatchTest, wakeUp) {
+    SleepyPoller poller(&dispatch);
+    dispatch.setIdleSpinTime(100);
+    dispatch.earliestTriggerTime = ~0lu;
+    std::thread waker([this] {
+        while (dispatch.sleeping.load() == 0) {
+            // Wait for the dispatch thread to start sleeping.
+        }
+        dispatch.wakeUp();
+    });
+    uint64_t start = Cycles::rdtsc();
+    EXPECT_TRUE(dispatch.sleep());
+    waker.join();
+
+    // Without the wakeup we would have slept for MAX_SLEEP_MICROS.
+    EXPECT_LT(Cycles::toMicroseconds(Cycles::rdtsc() - start),
+            Dispatch::MAX_SLEEP_MICROS/2);
+}
+
 TEST_F(DispatchTest, File_constructor_errorInEpollCreate) {
     sys->epollCreateErrno = EPERM;
     try {
@@ -780,13 +1032,13 @@ TEST_F(DispatchTest, epollThreadMain_signalEventsAndExit) {
 TEST_F(DispatchTest, Timer_constructorDestructor) {
     DummyTimer* t1 = new DummyTimer("t1", &dispatch);
     DummyTimer* t2 = new DummyTimer("t2", 100, &dispatch);
-    EXPECT_EQ(1U, dispatch.timers.size());
+    EXPECT_EQ(1U, dispatch.numTimers);
     EXPECT_EQ(-1, t1->slot);
     EXPECT_EQ(0, t2->slot);
     EXPECT_EQ(100UL, t2->triggerTime);
     delete t1;
     delete t2;
-    EXPECT_EQ(0U, dispatch.timers.size());
+    EXPECT_EQ(0U, dispatch.numTimers);
 }
 
 // Make sure that a timer can safely be deleted from a timer
@@ -800,7 +1052,7 @@ TEST_F(DispatchTest, Timer_reentrant) {
     Cycles::mockTscValue = 300;
     dispatch.poll();
     EXPECT_EQ("timer t2 invoked", *localLog);
-    EXPECT_EQ(1U, dispatch.timers.size());
+    EXPECT_EQ(1U, dispatch.numTimers);
 }
 
 TEST_F(DispatchTest, Timer_isRunning) {
@@ -820,12 +1072,83 @@ TEST_F(DispatchTest, Timer_start) {
     EXPECT_EQ(210UL, t1.triggerTime);
     EXPECT_EQ(0, t1.slot);
     EXPECT_EQ(200UL, dispatch.earliestTriggerTime);
+    EXPECT_EQ(static_cast<int>(Dispatch::TIMER_WHEEL_SLOTS) + 3, t1.bucket);
     t2.start(190);
     EXPECT_EQ(190UL, dispatch.earliestTriggerTime);
-    EXPECT_EQ(1, t2.slot);
+    EXPECT_EQ(0, t2.slot);
+    EXPECT_EQ(static_cast<int>(Dispatch::TIMER_WHEEL_SLOTS) + 2, t2.bucket);
     t1.start(300);
     EXPECT_EQ(300UL, t1.triggerTime);
     EXPECT_EQ(0, t1.slot);
+    EXPECT_EQ(static_cast<int>(Dispatch::TIMER_WHEEL_SLOTS) + 4, t1.bucket);
+    EXPECT_EQ(2U, dispatch.numTimers);
+}
+
+TEST_F(DispatchTest, addTimer) {
+    DummyTimer t1("t1", &dispatch), t2("t2", &dispatch);
+    DummyTimer t3("t3", &dispatch);
+    dispatch.timerWheelTime = 0x1000;
+    t1.start(0x1005);
+    EXPECT_EQ(5, t1.bucket);
+    EXPECT_EQ(1lu << 5, dispatch.timerWheelOccupied[0]);
+    t2.start(0x3000045);
+    EXPECT_EQ(4 * static_cast<int>(Dispatch::TIMER_WHEEL_SLOTS) + 3,
+              t2.bucket);
+    EXPECT_EQ(1lu << 3, dispatch.timerWheelOccupied[4]);
+
+    // Trigger time already passed.
+    t3.start(0xfff);
+    EXPECT_EQ(-1, t3.bucket);
+    EXPECT_EQ(0, t3.slot);
+    EXPECT_EQ(1U, dispatch.expiredTimers.size());
+
+    t1.stop();
+    EXPECT_EQ(0lu, dispatch.timerWheelOccupied[0]);
+}
+
+TEST_F(DispatchTest, advanceTimers) {
+    DummyTimer t1("t1", &dispatch), t2("t2", &dispatch);
+    DummyTimer t3("t3", &dispatch), t4("t4", &dispatch);
+    t1.start(100);
+    t2.start(5000);
+    t3.start(5001);
+    t4.start(1lu << 40);
+
+    dispatch.advanceTimers(101);
+    EXPECT_EQ(101lu, dispatch.timerWheelTime);
+    ASSERT_EQ(1U, dispatch.expiredTimers.size());
+    EXPECT_EQ(&t1, dispatch.expiredTimers[0]);
+
+    // The bucket holding t2 and t3 is cascaded down to level 0.
+    dispatch.advanceTimers(5001);
+    EXPECT_EQ(5001lu, dispatch.timerWheelTime);
+    ASSERT_EQ(2U, dispatch.expiredTimers.size());
+    EXPECT_EQ(&t2, dispatch.expiredTimers[1]);
+    EXPECT_EQ(9, t3.bucket);
+
+    // Skip ahead over empty buckets without walking through them.
+    dispatch.advanceTimers((1lu << 40) + 1);
+    EXPECT_EQ(4U, dispatch.expiredTimers.size());
+    EXPECT_EQ(4U, dispatch.numTimers);
+}
+
+TEST_F(DispatchTest, updateEarliestTriggerTime) {
+    DummyTimer t1("t1", &dispatch), t2("t2", &dispatch);
+    dispatch.updateEarliestTriggerTime();
+    EXPECT_EQ(~0lu, dispatch.earliestTriggerTime);
+
+    // Above level 0, the start of the bucket is used.
+    t1.start(5000);
+    dispatch.updateEarliestTriggerTime();
+    EXPECT_EQ(4096lu, dispatch.earliestTriggerTime);
+    dispatch.advanceTimers(4097);
+    dispatch.updateEarliestTriggerTime();
+    EXPECT_EQ(4992lu, dispatch.earliestTriggerTime);
+
+    dispatch.timerWheelTime = 6000;
+    t2.start(10);
+    dispatch.updateEarliestTriggerTime();
+    EXPECT_EQ(10lu, dispatch.earliestTriggerTime);
 }
 
 TEST_F(DispatchTest, Timer_start_dispatchDeleted) {
@@ -845,11 +1168,11 @@ TEST_F(DispatchTest, Timer_stop) {
     EXPECT_EQ(0, t1.slot);
     t1.stop();
     EXPECT_EQ(-1, t1.slot);
-    EXPECT_EQ(2U, dispatch.timers.size());
+    EXPECT_EQ(2U, dispatch.numTimers);
     EXPECT_EQ(0, t3.slot);
     t1.stop();
     EXPECT_EQ(-1, t1.slot);
-    EXPECT_EQ(2U, dispatch.timers.size());
+    EXPECT_EQ(2U, dispatch.numTimers);
 }
 
 TEST_F(DispatchTest, Lock_inDispatchThread) {
@@ -78,6 +78,10 @@ DpdkDriver::DpdkDriver()
     : context(NULL)
     , packetBufPool()
     , packetBufsUtilized(0)
+    , packetBufLock("DpdkDriver::packetBufLock")
+    , receiveQueues()
+    , nextReceiveQueue(0)
+    , stopReceiveThreads(false)
     , locatorString()
     , localMac()
     , portId(0)
@@ -111,12 +115,22 @@ DpdkDriver::DpdkDriver()
  *      Overall information about the RAMCloud server or client.
  * \param port
  *      Selects which physical port to use for communication.
+ * \param queues
+ *      Number of NIC receive queues to spread incoming packets over with
+ *      receive-side scaling. With 1 (the default) the dispatch thread polls
+ *      the NIC itself; with more, each queue gets its own polling thread
+ *      that copies packets out of the NIC and hands them to the dispatch
+ *      thread, which takes that work off the dispatch thread.
  */
 
-DpdkDriver::DpdkDriver(Context* context, int port)
+DpdkDriver::DpdkDriver(Context* context, int port, int queues)
     : context(context)
     , packetBufPool()
     , packetBufsUtilized(0)
+    , packetBufLock("DpdkDriver::packetBufLock")
+    , receiveQueues()
+    , nextReceiveQueue(0)
+    , stopReceiveThreads(false)
     , locatorString()
     , localMac()
     , portId(0)
@@ -188,10 +202,36 @@ DpdkDriver::DpdkDriver(Context* context, int port)
     localMac.construct(mac.addr_bytes);
     locatorString = format("dpdk:mac=%s", localMac->toString().c_str());
 
+    // Decide how many receive queues to use; the NIC may support fewer
+    // than were asked for.
+    struct rte_eth_dev_info devInfo;
+    rte_eth_dev_info_get(portId, &devInfo);
+    uint16_t numQueues = 1;
+    if (queues > 1) {
+        numQueues = downCast<uint16_t>(
+                std::min(queues, static_cast<int>(devInfo.max_rx_queues)));
+        if (numQueues < queues) {
+            LOG(WARNING, "Ethernet port %u supports only %u receive queues; "
+                    "using %u instead of %d", portId, devInfo.max_rx_queues,
+                    numQueues, queues);
+        }
+    }
+
     // configure some default NIC port parameters
     memset(&portConf, 0, sizeof(portConf));
     portConf.rxmode.max_rx_pkt_len = ETHER_MAX_VLAN_FRAME_LEN;
-    rte_eth_dev_configure(portId, 1, 1, &portConf);
+    if (numQueues > 1) {
+        // Let the NIC hash incoming packets over the receive queues. Raw
+        // Ethernet frames can only be spread by NICs that hash on L2
+        // payload; others deliver them all to queue 0, which still moves
+        // the polling and copying off the dispatch thread.
+        portConf.rxmode.mq_mode = ETH_MQ_RX_RSS;
+        portConf.rx_adv_conf.rss_conf.rss_hf =
+                (ETH_RSS_IP | ETH_RSS_UDP | ETH_RSS_TCP | ETH_RSS_L2_PAYLOAD)
+                & devInfo.flow_type_rss_offloads;
+    }
+    // Only the dispatch thread transmits, so one transmit queue suffices.
+    rte_eth_dev_configure(portId, numQueues, 1, &portConf);
 
     // Set up a NIC/HW-based filter on the ethernet type so that only
     // traffic to a particular port is received by this driver.
@@ -212,7 +252,9 @@ DpdkDriver::DpdkDriver(Context* context, int port)
 
     // setup and initialize the receive and transmit NIC queues,
     // and activate the port.
-    rte_eth_rx_queue_setup(portId, 0, NDESC, 0, NULL, packetPool);
+    for (uint16_t queue = 0; queue < numQueues; queue++) {
+        rte_eth_rx_queue_setup(portId, queue, NDESC, 0, NULL, packetPool);
+    }
     rte_eth_tx_queue_setup(portId, 0, NDESC, 0, NULL);
     ret = rte_eth_dev_start(portId);
     if (ret != 0) {
@@ -262,9 +304,25 @@ DpdkDriver::DpdkDriver(Context* context, int port)
                 rte_strerror(rte_errno)));
     }
 
+    if (numQueues > 1) {
+        for (uint16_t queue = 0; queue < numQueues; queue++) {
+            ReceiveQueue* receiveQueue = new ReceiveQueue(queue);
+            receiveQueues.push_back(receiveQueue);
+            receiveQueue->ready = rte_ring_create(
+                    format("dpdk_rx_ring_%u", queue).c_str(), RX_RING_SIZE,
+                    SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ);
+            if (NULL == receiveQueue->ready) {
+                throw DriverException(HERE, format(
+                        "Failed to allocate ring for receive queue %u: %s",
+                        queue, rte_strerror(rte_errno)));
+            }
+        }
+    }
+
     LOG(NOTICE, "DpdkDriver locator: %s, bandwidth: %d Mbits/sec, "
-            "maxTransmitQueueSize: %u bytes",
-            locatorString.c_str(), bandwidthMbps, maxTransmitQueueSize);
+            "maxTransmitQueueSize: %u bytes, receive queues: %u",
+            locatorString.c_str(), bandwidthMbps, maxTransmitQueueSize,
+            numQueues);
 
     // DPDK during initialization (rte_eal_init()) pins the running thread
     // to a single processor. This becomes a problem as the master worker
@@ -274,6 +332,13 @@ DpdkDriver::DpdkDriver(Context* context, int port)
     // single core. Revert this, by restoring the affinity to the default
     // (all cores).
     Util::clearCpuAffinity();
+
+    // Start the receive threads only now, so that they don't inherit the
+    // affinity described above.
+    foreach (ReceiveQueue* receiveQueue, receiveQueues) {
+        receiveQueue->thread.construct(receiveThreadMain, this,
+                receiveQueue);
+    }
 }
 
 /**
@@ -281,6 +346,21 @@ DpdkDriver::DpdkDriver(Context* context, int port)
  */
 DpdkDriver::~DpdkDriver()
 {
+    stopReceiveThreads = true;
+    foreach (ReceiveQueue* receiveQueue, receiveQueues) {
+        if (receiveQueue->thread)
+            receiveQueue->thread->join();
+        // Return packets that were never collected by receivePackets().
+        void* entry;
+        while (receiveQueue->ready != NULL &&
+                rte_ring_sc_dequeue(receiveQueue->ready, &entry) == 0) {
+            packetBufsUtilized--;
+            packetBufPool.destroy(static_cast<ReceivedBuf*>(entry));
+        }
+        delete receiveQueue;
+    }
+    receiveQueues.clear();
+
     if (packetBufsUtilized != 0)
         LOG(ERROR, "DpdkDriver deleted with %d packets still in use",
             packetBufsUtilized);
@@ -318,29 +398,54 @@ void
 DpdkDriver::receivePackets(uint32_t maxPackets,
             std::vector<Received>* receivedPackets)
 {
-#define MAX_PACKETS_AT_ONCE 32
     if (maxPackets > MAX_PACKETS_AT_ONCE) {
         maxPackets = MAX_PACKETS_AT_ONCE;
     }
     struct rte_mbuf* mPkts[MAX_PACKETS_AT_ONCE];
 
+    // Packets already copied out of the NIC by the receive threads.
+    uint32_t collectedPkts = 0;
+    uint32_t incomingPkts = 0;
+    if (receiveQueues.empty()) {
 #if TIME_TRACE
-    uint64_t timestamp = Cycles::rdtsc();
+        uint64_t timestamp = Cycles::rdtsc();
 #endif
-    // attempt to dequeue a batch of received packets from the NIC
-    // as well as from the loopback ring.
-    uint32_t incomingPkts = rte_eth_rx_burst(portId, 0, mPkts,
-            downCast<uint16_t>(maxPackets));
+        // attempt to dequeue a batch of received packets from the NIC
+        // as well as from the loopback ring.
+        incomingPkts = rte_eth_rx_burst(portId, 0, mPkts,
+                downCast<uint16_t>(maxPackets));
 
-    if (incomingPkts > 0) {
+        if (incomingPkts > 0) {
 #if TIME_TRACE
-        TimeTrace::record(timestamp, "DpdkDriver about to receive packets");
-        TimeTrace::record("DpdkDriver received %u packets", incomingPkts);
+            TimeTrace::record(timestamp,
+                    "DpdkDriver about to receive packets");
+            TimeTrace::record("DpdkDriver received %u packets",
+                    incomingPkts);
 #endif
+        }
+    } else {
+        // Start with a different queue each time, so that a busy queue
+        // can't keep the others from being drained.
+        uint32_t numQueues = downCast<uint32_t>(receiveQueues.size());
+        for (uint32_t i = 0; i < numQueues && collectedPkts < maxPackets;
+                i++) {
+            ReceiveQueue* queue =
+                    receiveQueues[(nextReceiveQueue + i) % numQueues];
+            void* entry;
+            while (collectedPkts < maxPackets &&
+                    rte_ring_sc_dequeue(queue->ready, &entry) == 0) {
+                ReceivedBuf* buffer = static_cast<ReceivedBuf*>(entry);
+                receivedPackets->emplace_back(buffer->sender.get(), this,
+                        buffer->length, buffer->payload);
+                collectedPkts++;
+            }
+        }
+        nextReceiveQueue = (nextReceiveQueue + 1) % numQueues;
     }
+
     uint32_t loopbackPkts = rte_ring_count(loopbackRing);
-    if (incomingPkts + loopbackPkts > maxPackets) {
-        loopbackPkts = maxPackets - incomingPkts;
+    if (collectedPkts + incomingPkts + loopbackPkts > maxPackets) {
+        loopbackPkts = maxPackets - collectedPkts - incomingPkts;
     }
     for (uint32_t i = 0; i < loopbackPkts; i++) {
         rte_ring_dequeue(loopbackRing,
@@ -351,47 +456,11 @@ DpdkDriver::receivePackets(uint32_t maxPackets,
     // Process received packets by constructing appropriate Received
     // objects and copying the payload from the DPDK packet buffers.
     for (uint32_t i = 0; i < totalPkts; i++) {
-        struct rte_mbuf* m = mPkts[i];
-        rte_prefetch0(rte_pktmbuf_mtod(m, void *));
-        if (m->nb_segs > 1) {
-            RAMCLOUD_CLOG(WARNING,
-                    "Can't handle packet with %u segments; discarding",
-                    m->nb_segs);
-            rte_pktmbuf_free(m);
-            continue;
-        }
-
-        struct ether_hdr* ethHdr = rte_pktmbuf_mtod(m, struct ether_hdr*);
-        uint16_t ether_type = ethHdr->ether_type;
-        uint32_t headerLength = ETHER_HDR_LEN;
-        char* payload = reinterpret_cast<char *>(ethHdr + 1);
-        if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_VLAN)) {
-            struct vlan_hdr* vlanHdr =
-                    reinterpret_cast<struct vlan_hdr*>(payload);
-            ether_type = vlanHdr->eth_proto;
-            headerLength += VLAN_TAG_LEN;
-            payload += VLAN_TAG_LEN;
-        }
-        if (!hasHardwareFilter) {
-            // Perform packet filtering by software to skip irrelevant
-            // packets such as ipmi or kernel TCP/IP traffics.
-            if (ether_type !=
-                    rte_cpu_to_be_16(NetUtil::EthPayloadType::RAMCLOUD)) {
-                rte_pktmbuf_free(m);
-                continue;
-            }
+        ReceivedBuf* buffer = copyPacket(mPkts[i]);
+        if (buffer != NULL) {
+            receivedPackets->emplace_back(buffer->sender.get(), this,
+                    buffer->length, buffer->payload);
         }
-
-        PerfStats::threadStats.networkInputBytes += rte_pktmbuf_pkt_len(m);
-        PacketBuf* buffer = packetBufPool.construct();
-        packetBufsUtilized++;
-        buffer->sender.construct(ethHdr->s_addr.addr_bytes);
-        uint32_t length = rte_pktmbuf_pkt_len(m) - headerLength;
-        assert(length <= MAX_PAYLOAD_SIZE);
-        rte_memcpy(buffer->payload, payload, length);
-        receivedPackets->emplace_back(buffer->sender.get(), this,
-                length, buffer->payload);
-        rte_pktmbuf_free(m);
     }
 }
 
@@ -399,16 +468,16 @@ DpdkDriver::receivePackets(uint32_t maxPackets,
 void
 DpdkDriver::release(char *payload)
 {
-    // Must sync with the dispatch thread, since this method could potentially
-    // be invoked in a worker.
-    Dispatch::Lock _(context->dispatch);
+    // Must sync with the dispatch thread and the receive threads, since
+    // this method could potentially be invoked in a worker.
+    SpinLock::Guard _(packetBufLock);
 
-    // Note: the payload is actually contained in a PacketBuf structure,
+    // Note: the payload is actually contained in a ReceivedBuf structure,
     // which we return to a pool for reuse later.
     packetBufsUtilized--;
     assert(packetBufsUtilized >= 0);
-    packetBufPool.destroy(
-        reinterpret_cast<PacketBuf*>(payload - OFFSET_OF(PacketBuf, payload)));
+    packetBufPool.destroy(reinterpret_cast<ReceivedBuf*>(
+            payload - OFFSET_OF(ReceivedBuf, payload)));
 }
 
 // See docs in Driver class.
@@ -516,6 +585,102 @@ DpdkDriver::sendPacket(const Address* addr,
     PerfStats::threadStats.networkOutputBytes += frameLength;
 }
 
+/**
+ * Copy a packet that arrived from the NIC or the loopback ring into a
+ * packet buffer from #packetBufPool, and free the DPDK buffer it arrived in.
+ * May be invoked on the dispatch thread or on a receive thread.
+ *
+ * \param m
+ *      The received packet; always freed.
+ * \return
+ *      The packet buffer holding the frame's payload and sender, which
+ *      must eventually be passed to release(), or NULL if the packet was
+ *      discarded (because it isn't a RAMCloud packet or because it spans
+ *      several DPDK buffers).
+ */
+DpdkDriver::ReceivedBuf*
+DpdkDriver::copyPacket(struct rte_mbuf* m)
+{
+    rte_prefetch0(rte_pktmbuf_mtod(m, void *));
+    if (m->nb_segs > 1) {
+        RAMCLOUD_CLOG(WARNING,
+                "Can't handle packet with %u segments; discarding",
+                m->nb_segs);
+        rte_pktmbuf_free(m);
+        return NULL;
+    }
+
+    struct ether_hdr* ethHdr = rte_pktmbuf_mtod(m, struct ether_hdr*);
+    uint16_t ether_type = ethHdr->ether_type;
+    uint32_t headerLength = ETHER_HDR_LEN;
+    char* payload = reinterpret_cast<char *>(ethHdr + 1);
+    if (ether_type == rte_cpu_to_be_16(ETHER_TYPE_VLAN)) {
+        struct vlan_hdr* vlanHdr =
+                reinterpret_cast<struct vlan_hdr*>(payload);
+        ether_type = vlanHdr->eth_proto;
+        headerLength += VLAN_TAG_LEN;
+        payload += VLAN_TAG_LEN;
+    }
+    if (!hasHardwareFilter) {
+        // Perform packet filtering by software to skip irrelevant
+        // packets such as ipmi or kernel TCP/IP traffics.
+        if (ether_type !=
+                rte_cpu_to_be_16(NetUtil::EthPayloadType::RAMCLOUD)) {
+            rte_pktmbuf_free(m);
+            return NULL;
+        }
+    }
+
+    PerfStats::threadStats.networkInputBytes += rte_pktmbuf_pkt_len(m);
+    ReceivedBuf* buffer;
+    {
+        SpinLock::Guard _(packetBufLock);
+        buffer = packetBufPool.construct();
+        packetBufsUtilized++;
+    }
+    buffer->sender.construct(ethHdr->s_addr.addr_bytes);
+    buffer->length = rte_pktmbuf_pkt_len(m) - headerLength;
+    assert(buffer->length <= MAX_PAYLOAD_SIZE);
+    rte_memcpy(buffer->payload, payload, buffer->length);
+    rte_pktmbuf_free(m);
+    return buffer;
+}
+
+/**
+ * Main loop of the thread that polls one NIC receive queue when the driver
+ * uses several: packets are copied out of the NIC as they arrive and queued
+ * for receivePackets() on the dispatch thread.
+ *
+ * \param driver
+ *      The driver that owns the queue.
+ * \param queue
+ *      The queue this thread serves.
+ */
+void
+DpdkDriver::receiveThreadMain(DpdkDriver* driver, ReceiveQueue* queue)
+{
+    PerfStats::registerStats(&PerfStats::threadStats);
+    struct rte_mbuf* mPkts[MAX_PACKETS_AT_ONCE];
+    while (!driver->stopReceiveThreads.load(std::memory_order_relaxed)) {
+        // Don't take more packets off the NIC than can be handed over;
+        // if the dispatch thread falls behind, the receive queue fills and
+        // the NIC drops packets, just as it would without this thread.
+        uint32_t room = std::min(rte_ring_free_count(queue->ready),
+                static_cast<uint32_t>(MAX_PACKETS_AT_ONCE));
+        if (room == 0) {
+            continue;
+        }
+        uint32_t count = rte_eth_rx_burst(driver->portId, queue->queueId,
+                mPkts, downCast<uint16_t>(room));
+        for (uint32_t i = 0; i < count; i++) {
+            ReceivedBuf* buffer = driver->copyPacket(mPkts[i]);
+            if (buffer != NULL) {
+                rte_ring_sp_enqueue(queue->ready, buffer);
+            }
+        }
+    }
+}
+
 // See docs in Driver class.
 string
 DpdkDriver::getServiceLocator()
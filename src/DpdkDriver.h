@@ -18,6 +18,8 @@
 #ifndef RAMCLOUD_DPDKDRIVER_H
 #define RAMCLOUD_DPDKDRIVER_H
 
+#include <atomic>
+#include <thread>
 #include <vector>
 
 #include "Dispatch.h"
@@ -27,6 +29,7 @@
 #include "ObjectPool.h"
 #include "QueueEstimator.h"
 #include "ServiceLocator.h"
+#include "SpinLock.h"
 #include "Tub.h"
 
 // Number of descriptors to allocate for the tx/rx rings
@@ -35,6 +38,11 @@
 // documentation of `rte_mempool_create` suggests that the optimum value
 // (in terms of memory usage) of this number is a power of two minus one.
 #define NB_MBUF 8191
+// Maximum number of packets taken from a receive queue in one burst.
+#define MAX_PACKETS_AT_ONCE 32
+// Number of entries in the ring that carries packets from each receive
+// thread to the dispatch thread; must be a power of two.
+#define RX_RING_SIZE 1024
 // per-element size for the packet buffer memory pool
 #define MBUF_SIZE (2048 + static_cast<uint32_t>(sizeof(struct rte_mbuf)) \
                    + RTE_PKTMBUF_HEADROOM)
@@ -57,7 +65,7 @@ class DpdkDriver : public Driver
 #if TESTING
     explicit DpdkDriver();
 #endif
-    explicit DpdkDriver(Context* context, int port = 0);
+    explicit DpdkDriver(Context* context, int port = 0, int queues = 1);
     virtual ~DpdkDriver();
     virtual int getHighestPacketPriority();
     virtual uint32_t getMaxPacketSize();
@@ -99,15 +107,72 @@ class DpdkDriver : public Driver
 
     typedef Driver::PacketBuf<MacAddress, MAX_PAYLOAD_SIZE> PacketBuf;
 
+    /// A PacketBuf together with the number of valid bytes in its payload,
+    /// so that a receive thread can hand a finished packet to the dispatch
+    /// thread through a ring.
+    struct ReceivedBuf : public PacketBuf {
+        ReceivedBuf()
+            : PacketBuf()
+            , length(0)
+        {}
+
+        /// Number of bytes of #payload that hold the packet.
+        uint32_t length;
+    };
+
+    /**
+     * One NIC receive queue served by its own polling thread; used only
+     * when the driver was created with more than one queue.
+     */
+    struct ReceiveQueue {
+        explicit ReceiveQueue(uint16_t queueId)
+            : queueId(queueId)
+            , ready(NULL)
+            , thread()
+        {}
+
+        /// DPDK id of the NIC receive queue.
+        uint16_t queueId;
+
+        /// Single-producer, single-consumer ring of ReceivedBuf pointers
+        /// filled by #thread and drained by receivePackets().
+        struct rte_ring* ready;
+
+        /// Runs receiveThreadMain() for this queue.
+        Tub<std::thread> thread;
+
+        DISALLOW_COPY_AND_ASSIGN(ReceiveQueue);
+    };
+
+    ReceivedBuf* copyPacket(struct rte_mbuf* m);
+    static void receiveThreadMain(DpdkDriver* driver, ReceiveQueue* queue);
+
     Context* context;
 
     /// Holds packet buffers that are no longer in use, for use in future
     /// requests; saves the overhead of calling malloc/free for each request.
-    ObjectPool<PacketBuf> packetBufPool;
+    ObjectPool<ReceivedBuf> packetBufPool;
 
     /// Tracks number of outstanding allocated payloads.  For detecting leaks.
     int packetBufsUtilized;
 
+    /// Serializes access to #packetBufPool and #packetBufsUtilized, which
+    /// are used by the receive threads, the dispatch thread and (through
+    /// release()) worker threads.
+    SpinLock packetBufLock;
+
+    /// One entry per NIC receive queue when the driver polls multiple
+    /// queues from receive threads; empty when the dispatch thread polls
+    /// the single queue itself in receivePackets().
+    std::vector<ReceiveQueue*> receiveQueues;
+
+    /// Index in #receiveQueues of the queue receivePackets() drains first
+    /// next time; rotated so that no queue is starved.
+    uint32_t nextReceiveQueue;
+
+    /// Set to tell the receive threads to exit.
+    std::atomic<bool> stopReceiveThreads;
+
     /// The original ServiceLocator string. May be empty if the constructor
     /// argument was NULL. May also differ if dynamic ports are used.
     string locatorString;
@@ -55,6 +55,14 @@ TEST_F(DpdkDriverTest, getHighestPacketPriority) {
     EXPECT_EQ(3, driver.getHighestPacketPriority());
 }
 
+TEST_F(DpdkDriverTest, release) {
+    DpdkDriver::ReceivedBuf* buffer = driver.packetBufPool.construct();
+    driver.packetBufsUtilized++;
+    driver.release(buffer->payload);
+    EXPECT_EQ(0, driver.packetBufsUtilized);
+    EXPECT_EQ(0lu, driver.packetBufPool.outstandingObjects);
+}
+
 TEST_F(DpdkDriverTest, sendPacket_success) {
     PerfStats::threadStats.networkOutputBytes = 0;
     driver.lowestPriorityAvail = 1;
@@ -312,6 +312,19 @@ class Driver {
     virtual void receivePackets(uint32_t maxPackets,
             std::vector<Received>* receivedPackets) = 0;
 
+    /**
+     * Returns true if the driver is running short of packet buffers for
+     * incoming packets, for example because many of them are still held
+     * by partially received messages. Transports should then copy the
+     * data out of new packets and release them right away, rather than
+     * keeping them until the messages are complete. Drivers that never run
+     * short (or don't know) return false.
+     */
+    virtual bool receiveBuffersLow()
+    {
+        return false;
+    }
+
     /**
      * Associates a contiguous region of memory to a NIC so that the memory
      * addresses within that region become direct memory accessible (DMA) for
@@ -327,6 +340,23 @@ class Driver {
      */
     virtual void registerMemory(void* base, size_t bytes) {}
 
+    /**
+     * Tells the driver that a burst of sendPacket calls is about to begin
+     * (for example, the packets of one message, or everything a transport
+     * sends during one poll). Until the matching call to flushBatch the
+     * driver may hold packets and then hand them to the NIC or kernel
+     * together, which amortizes per-packet costs such as system calls.
+     * Calls may nest; packets are only flushed by the outermost flushBatch.
+     */
+    virtual void startBatch() {}
+
+    /**
+     * Ends a burst of sendPacket calls started by startBatch; once the
+     * outermost burst has ended, any packets the driver held are
+     * transmitted before this method returns.
+     */
+    virtual void flushBatch() {}
+
     /**
      * Send a single packet out over this Driver. The packet will not
      * necessarily have been transmitted before this method returns.  If an
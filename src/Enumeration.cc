@@ -15,6 +15,9 @@
 
 #include "Enumeration.h"
 #include "Object.h"
+#include "ObjectManager.h"
+#include "SegmentIterator.h"
+#include "WallTime.h"
 
 namespace RAMCloud {
 
@@ -30,6 +33,9 @@ struct EnumerateBucketArgs {
     /// client, which may differ from the tablet owned by this master.
     uint64_t requestedTabletStartHash;
 
+    /// The largest key hash value requested by the client.
+    uint64_t requestedLastHash;
+
     /// Log containing the objects we're enumerating.
     Log* log;
 
@@ -72,6 +78,7 @@ enumerateBucket(uint64_t reference, void* cookie)
     KeyHash keyHash = key.getHash();
     if (key.getTableId() != args.tableId ||
         keyHash < args.requestedTabletStartHash ||
+        args.requestedLastHash < keyHash ||
         args.iter->top().tabletEndHash < keyHash) {
         return;
     }
@@ -82,7 +89,8 @@ enumerateBucket(uint64_t reference, void* cookie)
          frameIndex >= 0; frameIndex--) {
         const EnumerationIterator::Frame& frame =
                 args.iter->get(downCast<uint32_t>(frameIndex));
-        if (frame.tabletStartHash <= keyHash &&
+        if (frame.logId == 0 &&
+            frame.tabletStartHash <= keyHash &&
             keyHash <= frame.tabletEndHash) {
 
             uint64_t secondaryHash = 0;
@@ -107,9 +115,88 @@ enumerateBucket(uint64_t reference, void* cookie)
     args.objectReferences->push_back(Log::Reference(reference));
 }
 
+/**
+ * Used internally by Enumeration::completeInLogOrder to remember an
+ * object of the tablet found in the log while the hash table bucket for
+ * its key is being prefetched.
+ */
+struct LogOrderCandidate {
+    LogOrderCandidate()
+        : offset(0)
+        , reference()
+        , keyHash(0)
+    {
+    }
+
+    /// Offset of the object's entry within its segment.
+    uint32_t offset;
+
+    /// Location of the object's entry in the log.
+    Log::Reference reference;
+
+    /// Hash of the object's key.
+    KeyHash keyHash;
+};
+
+/**
+ * Decide whether an object found while walking the log is the current
+ * version of that object, i.e. whether it should be enumerated.
+ *
+ * \param log
+ *      The log containing the object.
+ * \param objectMap
+ *      The hash table of objects living on this server.
+ * \param candidate
+ *      The object found in the log.
+ * \param[out] current
+ *      If the object is current, set to the reference the hash table holds
+ *      for it. Usually that is where it was found, but the cleaner may
+ *      have relocated it since the segment being walked was listed.
+ * \return
+ *      True if the object is current, false if it has been overwritten or
+ *      removed.
+ */
+static bool
+findCurrentObject(Log& log, HashTable& objectMap,
+                  const LogOrderCandidate& candidate,
+                  Log::Reference* current)
+{
+    // Comparing references is enough for nearly all objects, and touches
+    // nothing but the (prefetched) bucket.
+    HashTable::Candidates candidates;
+    objectMap.lookup(candidate.keyHash, candidates);
+    for (; !candidates.isDone(); candidates.next()) {
+        if (candidates.getReference() == candidate.reference.toInteger()) {
+            *current = candidate.reference;
+            return true;
+        }
+    }
+
+    // A relocated copy has the same version as the one found.
+    Buffer buffer;
+    LogEntryType type = log.getEntry(candidate.reference, buffer);
+    Key key(type, buffer);
+    uint64_t version = Object(buffer).getVersion();
+    objectMap.lookup(candidate.keyHash, candidates);
+    for (; !candidates.isDone(); candidates.next()) {
+        Log::Reference reference(candidates.getReference());
+        Buffer candidateBuffer;
+        LogEntryType candidateType = log.getEntry(reference, candidateBuffer);
+        if (candidateType != LOG_ENTRY_TYPE_OBJ)
+            continue;
+        Key candidateKey(candidateType, candidateBuffer);
+        if (key == candidateKey) {
+            *current = reference;
+            return Object(candidateBuffer).getVersion() == version;
+        }
+    }
+    return false;
+}
+
 /**
  * Appends objects to a buffer. Each object is a uint32_t size and a complete,
- * serialized Object.
+ * serialized Object. Objects that have expired are skipped, and compressed
+ * values are expanded.
  *
  * \param log
  *      The log containing the objects.
@@ -124,22 +211,55 @@ enumerateBucket(uint64_t reference, void* cookie)
  *      and data. True means that the returned objects have
  *      been truncated so that the object data (normally the last
  *      field of the object) is omitted.       
+ * \param filter
+ *      If not NULL, only objects passing this filter are appended, and
+ *      their values are replaced with the projected parts.
+ * \param objectManager
+ *      If not NULL, the objects are fetched with
+ *      ObjectManager::getObjectEntry rather than straight from \a log.
+ * \return
+ *      The index in \a references of the first object that didn't fit, or
+ *      -1 if they all did.
  */
 static int64_t
 appendObjectsToBuffer(Log& log,
                       Buffer* buffer,
                       std::vector<Log::Reference>& references,
-                      uint32_t maxBytes, bool keysOnly)
+                      uint32_t maxBytes, bool keysOnly,
+                      const EnumerationFilter* filter,
+                      ObjectManager* objectManager)
 {
+    uint32_t now = WallTime::secondsTimestamp();
     for (uint32_t index = 0; index < references.size(); index++) {
         Buffer objectBuffer;
-        log.getEntry(references[index], objectBuffer);
+        if (objectManager != NULL) {
+            objectManager->getObjectEntry(references[index], objectBuffer);
+        } else {
+            log.getEntry(references[index], objectBuffer);
+        }
 
         Object object(objectBuffer);
+        if (object.isExpired(now))
+            continue;
+
+        // Clients get values as they were written.
+        Buffer expanded;
+        if (object.isCompressed()) {
+            object.decompressValue(expanded);
+            objectBuffer.reset();
+            object.assembleForLog(objectBuffer);
+        }
+        if (filter != NULL && !filter->matches(object, objectBuffer))
+            continue;
+
+        // The value comes last, so the keys and header are a prefix.
+        uint32_t dataLength = object.getValueLength();
+        uint32_t headerAndKeysLength = objectBuffer.size() - dataLength;
         uint32_t length = objectBuffer.size();
         if (keysOnly) {
-            uint32_t dataLength = object.getValueLength();
-            length -= dataLength;
+            length = headerAndKeysLength;
+        } else if (filter != NULL) {
+            length = headerAndKeysLength + filter->getValueLength(object);
         }
 
         if (buffer->size() + sizeof(length) + length > maxBytes) {
@@ -147,7 +267,12 @@ appendObjectsToBuffer(Log& log,
         }
 
         buffer->emplaceAppend<uint32_t>(length);
-        buffer->append(&objectBuffer, 0, length);
+        if (keysOnly || filter == NULL) {
+            buffer->append(&objectBuffer, 0, length);
+        } else {
+            buffer->append(&objectBuffer, 0, headerAndKeysLength);
+            filter->appendValue(object, objectBuffer, buffer);
+        }
     }
 
     return -1;
@@ -217,6 +342,9 @@ class ObjectHashComparator {
  *      field of the object) is omitted.
  * \param requestedTabletStartHash
  *      The start hash of the tablet as requested by the client.
+ * \param requestedLastHash
+ *      Objects with key hashes greater than this are not returned; ~0 to
+ *      enumerate the whole tablet.
  * \param actualTabletStartHash
  *      The start hash of the tablet that actually lives on this server.
  * \param actualTabletEndHash
@@ -234,20 +362,38 @@ class ObjectHashComparator {
  *      A Buffer to hold the resulting objects.
  * \param maxPayloadBytes
  *      The maximum number of bytes of objects to be returned.
+ * \param filter
+ *      If not NULL, only objects passing this filter are returned, with
+ *      the projected parts of their values (see EnumerationFilter). Must
+ *      stay valid until #complete() returns.
+ * \param objectManager
+ *      If not NULL, the ObjectManager that owns \a log and \a objectMap;
+ *      objects are then returned with any data appended to them (see
+ *      ObjectManager::appendObject).
+ * \param logId
+ *      Zero means objects are enumerated in the order of the buckets of
+ *      \a objectMap. Otherwise they are enumerated in the order of \a log
+ *      (see #completeInLogOrder), and this is the ServerId of this master,
+ *      which identifies the log in \a iter.
  */
 Enumeration::Enumeration(uint64_t tableId,
                          bool keysOnly,
                          uint64_t requestedTabletStartHash,
+                         uint64_t requestedLastHash,
                          uint64_t actualTabletStartHash,
                          uint64_t actualTabletEndHash,
                          uint64_t* nextTabletStartHash,
                          EnumerationIterator& iter,
                          Log& log,
                          HashTable& objectMap,
-                         Buffer& payload, uint32_t maxPayloadBytes)
+                         Buffer& payload, uint32_t maxPayloadBytes,
+                         const EnumerationFilter* filter,
+                         ObjectManager* objectManager,
+                         uint64_t logId)
     : tableId(tableId)
     , keysOnly(keysOnly)
     , requestedTabletStartHash(requestedTabletStartHash)
+    , requestedLastHash(requestedLastHash)
     , actualTabletStartHash(actualTabletStartHash)
     , actualTabletEndHash(actualTabletEndHash)
     , nextTabletStartHash(nextTabletStartHash)
@@ -256,6 +402,9 @@ Enumeration::Enumeration(uint64_t tableId,
     , objectMap(objectMap)
     , payload(payload)
     , maxPayloadBytes(maxPayloadBytes)
+    , filter(filter)
+    , objectManager(objectManager)
+    , logId(logId)
 {
 }
 
@@ -269,6 +418,11 @@ Enumeration::Enumeration(uint64_t tableId,
 void
 Enumeration::complete()
 {
+    if (logId != 0) {
+        completeInLogOrder();
+        return;
+    }
+
     // Check iterator state to see if the tablet configuration has
     // changed since the last call to enumerateTablet().
     if (iter.size() == 0 ||
@@ -291,6 +445,7 @@ Enumeration::complete()
     EnumerateBucketArgs args;
     args.tableId = tableId;
     args.requestedTabletStartHash = requestedTabletStartHash;
+    args.requestedLastHash = requestedLastHash;
     args.log = &log;
     args.iter = &iter;
     args.objectReferences = &objectRefs;
@@ -300,7 +455,8 @@ Enumeration::complete()
         bucketStart = payload.size();
         objectMap.forEachInBucket(enumerateBucket, cookie, bucketIndex);
         int64_t overflow = appendObjectsToBuffer(log, &payload, objectRefs,
-                                                 maxPayloadBytes, keysOnly);
+                                                 maxPayloadBytes, keysOnly,
+                                                 filter, objectManager);
         payloadFull = overflow >= 0;
         if (payloadFull) {
             break;
@@ -320,7 +476,8 @@ Enumeration::complete()
             std::sort(objectRefs.begin(), objectRefs.end(), comparator);
 
             int64_t overflow = appendObjectsToBuffer(log, &payload, objectRefs,
-                                                     maxPayloadBytes, keysOnly);
+                                                     maxPayloadBytes, keysOnly,
+                                                     filter, objectManager);
             if (overflow >= 0) {
                 LogEntryType type;
                 Buffer buffer;
@@ -350,4 +507,137 @@ Enumeration::complete()
     }
 }
 
+/**
+ * Does the work of #complete() for enumerations in log order. Rather than
+ * walking the hash table and reading each object wherever it is in the
+ * log, this walks the segments of the log in order of their identifiers,
+ * starting where the last RPC left off, and looks up the objects of the
+ * tablet in the hash table (whose buckets are prefetched a few objects
+ * ahead) only to check that they are current. The log is thus read
+ * sequentially, which makes scanning whole tablets much faster.
+ *
+ * The guarantees are weaker than in hash table order, though. Each object
+ * that exists throughout the enumeration is still returned at least once,
+ * but it may be returned again if it is overwritten, or if the cleaner
+ * relocates it into a segment the enumeration hasn't reached yet (or one
+ * behind it, which the enumeration then goes back to; see
+ * LogSegment::relocationGeneration). If the tablet moves to another master
+ * or changes its boundaries, its enumeration starts over.
+ */
+void
+Enumeration::completeInLogOrder()
+{
+    LogSegmentVector segments;
+    uint64_t relocationGeneration;
+    log.getSegments(segments, &relocationGeneration);
+
+    // A position in another log, or within other tablet boundaries, tells
+    // nothing about what has been enumerated here.
+    if (iter.size() == 0 ||
+        iter.top().logId != logId ||
+        iter.top().tabletStartHash != actualTabletStartHash ||
+        iter.top().tabletEndHash != actualTabletEndHash) {
+        iter.clear();
+        iter.push(EnumerationIterator::Frame(
+            actualTabletStartHash, actualTabletEndHash, 0, 0, 0, logId));
+    }
+    EnumerationIterator::Frame& frame = iter.top();
+
+    // Objects that the cleaner moved into survivors behind the position,
+    // since the last RPC began, may have come from segments ahead of it
+    // that are gone now: go back to the first of those survivors. And a
+    // compacted copy of the segment at the position has its entries at
+    // different offsets.
+    foreach (LogSegment* segment, segments) {
+        if (segment->relocationGeneration <= frame.relocationGeneration)
+            continue;
+        if (segment->id == frame.segmentId) {
+            frame.segmentOffset = 0;
+        } else if (segment->isSurvivor && segment->id < frame.segmentId) {
+            frame.segmentId = segment->id;
+            frame.segmentOffset = 0;
+        }
+    }
+    frame.relocationGeneration = relocationGeneration;
+
+    uint32_t initialPayloadLength = payload.size();
+    bool payloadFull = false;
+    std::vector<Log::Reference> objectRefs;
+    std::vector<uint32_t> offsets;
+    LogOrderCandidate candidates[PREFETCH_CANDIDATES];
+    foreach (LogSegment* segment, segments) {
+        if (segment->id < frame.segmentId)
+            continue;
+        uint32_t offset = 0;
+        if (segment->id == frame.segmentId)
+            offset = frame.segmentOffset;
+        uint32_t limit = segment->getAppendedLength();
+        frame.segmentId = segment->id;
+        frame.segmentOffset = std::max(offset, limit);
+        if (offset >= limit)
+            continue;
+
+        SegmentIterator it(*segment);
+        it.setLimit(limit);
+        it.setOffset(offset);
+        objectRefs.clear();
+        offsets.clear();
+        uint32_t numCandidates = 0;
+        while (true) {
+            bool done = it.isDone();
+            if (!done && it.getType() == LOG_ENTRY_TYPE_OBJ) {
+                Buffer buffer;
+                it.appendToBuffer(buffer);
+                Key key(LOG_ENTRY_TYPE_OBJ, buffer);
+                KeyHash keyHash = key.getHash();
+                if (key.getTableId() == tableId &&
+                    requestedTabletStartHash <= keyHash &&
+                    keyHash <= requestedLastHash &&
+                    keyHash <= frame.tabletEndHash) {
+                    LogOrderCandidate& candidate = candidates[numCandidates];
+                    candidate.offset = it.getOffset();
+                    candidate.reference = it.getReference();
+                    candidate.keyHash = keyHash;
+                    objectMap.prefetchBucket(keyHash);
+                    numCandidates++;
+                }
+            }
+            if (numCandidates == PREFETCH_CANDIDATES ||
+                (done && numCandidates > 0)) {
+                for (uint32_t i = 0; i < numCandidates; i++) {
+                    Log::Reference current;
+                    if (findCurrentObject(log, objectMap, candidates[i],
+                                          &current)) {
+                        objectRefs.push_back(current);
+                        offsets.push_back(candidates[i].offset);
+                    }
+                }
+                numCandidates = 0;
+            }
+            if (done)
+                break;
+            it.next();
+        }
+
+        int64_t overflow = appendObjectsToBuffer(log, &payload, objectRefs,
+                                                 maxPayloadBytes, keysOnly,
+                                                 filter, objectManager);
+        if (overflow >= 0) {
+            frame.segmentOffset = offsets[overflow];
+            payloadFull = true;
+            break;
+        }
+    }
+
+    // Check end of tablet.
+    *nextTabletStartHash = requestedTabletStartHash;
+    if (!payloadFull && payload.size() == initialPayloadLength) {
+        while (iter.size() > 0 &&
+               iter.top().tabletEndHash <= actualTabletEndHash) {
+            iter.pop();
+        }
+        *nextTabletStartHash = actualTabletEndHash + 1;
+    }
+}
+
 } // namespace RAMCloud
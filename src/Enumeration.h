@@ -17,12 +17,15 @@
 #define RAMCLOUD_ENUMERATION_H
 
 #include "Buffer.h"
+#include "EnumerationFilter.h"
 #include "EnumerationIterator.h"
 #include "HashTable.h"
 #include "Log.h"
 
 namespace RAMCloud {
 
+class ObjectManager;
+
 /**
  * The Enumeration class encapsulates the server-side logic for
  * servicing an EnumerationRPC. This class is intended to be
@@ -33,22 +36,39 @@ namespace RAMCloud {
  * until the buffer fills up. The Enumeration also updates the
  * provided EnumerationIterator with the state necessary to resume on
  * the next EnumerationRPC.
+ *
+ * Alternatively, clients can ask for a full-table scan in log order (see
+ * #completeInLogOrder), which walks the segments of the log sequentially
+ * instead and consults the hash table only to tell which of the entries
+ * found are live.
  */
 class Enumeration {
   public:
     Enumeration(uint64_t tableId,
                 bool keysOnly,
                 uint64_t requestedTabletStartHash,
+                uint64_t requestedLastHash,
                 uint64_t actualTabletStartHash,
                 uint64_t actualTabletEndHash,
                 uint64_t* nextTabletStartHash,
                 EnumerationIterator& iter,
                 Log& log,
                 HashTable& objectMap,
-                Buffer& payload, uint32_t maxPayloadBytes);
+                Buffer& payload, uint32_t maxPayloadBytes,
+                const EnumerationFilter* filter = NULL,
+                ObjectManager* objectManager = NULL,
+                uint64_t logId = 0);
     void complete();
 
   PRIVATE:
+    void completeInLogOrder();
+
+    /**
+     * Number of candidate entries whose hash table buckets are prefetched
+     * together by #completeInLogOrder before any of them are looked up.
+     */
+    enum { PREFETCH_CANDIDATES = 8 };
+
     /// The table containing the tablet being enumerated.
     uint64_t tableId;
 
@@ -61,6 +81,9 @@ class Enumeration {
     /// The start hash of the tablet as requested by the client.
     uint64_t requestedTabletStartHash;
 
+    /// Objects with key hashes greater than this are not returned.
+    uint64_t requestedLastHash;
+
     /// The start hash of the tablet that actually lives on this server.
     uint64_t actualTabletStartHash;
 
@@ -84,6 +107,20 @@ class Enumeration {
 
     /// The maximum number of bytes of objects to be returned.
     uint32_t maxPayloadBytes;
+
+    /// Selects the objects returned and the parts of their values; NULL
+    /// means every object is returned whole.
+    const EnumerationFilter* filter;
+
+    /// If not NULL, objects are fetched through this ObjectManager, so
+    /// that data appended to them is included; otherwise they are read
+    /// straight from #log.
+    ObjectManager* objectManager;
+
+    /// Zero means the objects are enumerated in hash table order; otherwise
+    /// they are enumerated in log order, and this identifies the log (it is
+    /// the ServerId of this master).
+    uint64_t logId;
 };
 
 }
@@ -0,0 +1,291 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "EnumerationFilter.h"
+#include "ClientException.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a filter that passes every object and returns whole values.
+ */
+EnumerationFilter::EnumerationFilter()
+    : keyPrefix()
+    , predicates()
+    , projections()
+{
+}
+
+/**
+ * Parse an EnumerationFilter from a request Buffer.
+ *
+ * \param buffer
+ *      A request Buffer.
+ * \param offset
+ *      The offset into the buffer at which to read the filter.
+ * \param length
+ *      The length of the filter in bytes; 0 means the filter passes every
+ *      object and returns whole values.
+ *
+ * \throw RequestFormatError
+ *      The filter is malformed or doesn't fit in \a length bytes.
+ */
+EnumerationFilter::EnumerationFilter(Buffer& buffer, uint32_t offset,
+                                     uint32_t length)
+    : keyPrefix()
+    , predicates()
+    , projections()
+{
+    if (length == 0)
+        return;
+    uint32_t end = offset + length;
+    if (end < offset || end > buffer.size())
+        throw RequestFormatError(HERE);
+
+    const WireFormat::Enumerate::FilterHeader* header =
+            buffer.getOffset<WireFormat::Enumerate::FilterHeader>(offset);
+    offset += sizeof32(*header);
+    if (header == NULL || offset > end)
+        throw RequestFormatError(HERE);
+
+    if (header->keyPrefixLength > end - offset)
+        throw RequestFormatError(HERE);
+    keyPrefix.resize(header->keyPrefixLength);
+    buffer.copy(offset, header->keyPrefixLength, &keyPrefix[0]);
+    offset += header->keyPrefixLength;
+
+    for (uint8_t i = 0; i < header->numPredicates; i++) {
+        const WireFormat::Enumerate::Predicate* predicate =
+                buffer.getOffset<WireFormat::Enumerate::Predicate>(offset);
+        if (end - offset < sizeof32(*predicate))
+            throw RequestFormatError(HERE);
+        offset += sizeof32(*predicate);
+        if (predicate->length > end - offset ||
+                predicate->comparison > GREATER_OR_EQUAL) {
+            throw RequestFormatError(HERE);
+        }
+        string operand(predicate->length, '\0');
+        buffer.copy(offset, predicate->length, &operand[0]);
+        offset += predicate->length;
+        predicates.emplace_back(predicate->offset,
+                static_cast<Comparison>(predicate->comparison), operand);
+    }
+
+    for (uint8_t i = 0; i < header->numProjections; i++) {
+        const WireFormat::Enumerate::Projection* projection =
+                buffer.getOffset<WireFormat::Enumerate::Projection>(offset);
+        if (end - offset < sizeof32(*projection))
+            throw RequestFormatError(HERE);
+        offset += sizeof32(*projection);
+        projections.emplace_back(projection->offset, projection->length);
+    }
+}
+
+/**
+ * Only return objects whose values satisfy a condition. An object must
+ * satisfy every predicate added to be returned. A filter holds at most 255
+ * predicates.
+ *
+ * \param offset
+ *      Offset in the value of the first byte to compare.
+ * \param comparison
+ *      Outcome of comparing the value bytes with \a operand (as memcmp
+ *      does: the value bytes come first) for which the predicate holds.
+ * \param operand
+ *      Bytes to compare with those of the value; copied.
+ * \param length
+ *      Number of bytes at \a operand, and of value bytes compared.
+ */
+void
+EnumerationFilter::addPredicate(uint32_t offset, Comparison comparison,
+                                const void* operand, uint16_t length)
+{
+    predicates.emplace_back(offset, comparison,
+            string(static_cast<const char*>(operand), length));
+}
+
+/**
+ * Return a range of bytes of the values of the objects enumerated. Ranges
+ * are returned in the order they were added, concatenated; parts of a
+ * range past the end of a value are left out. A filter holds at most 255
+ * projections.
+ *
+ * \param offset
+ *      Offset in the value of the first byte to return.
+ * \param length
+ *      Number of bytes to return.
+ */
+void
+EnumerationFilter::addProjection(uint32_t offset, uint32_t length)
+{
+    projections.emplace_back(offset, length);
+}
+
+/**
+ * Only return objects whose primary keys start with the given bytes.
+ *
+ * \param prefix
+ *      First byte of the prefix; copied.
+ * \param length
+ *      Number of bytes at \a prefix; 0 passes every key.
+ */
+void
+EnumerationFilter::setKeyPrefix(const void* prefix, uint16_t length)
+{
+    keyPrefix.assign(static_cast<const char*>(prefix), length);
+}
+
+/**
+ * Append the projected part of an object's value to a buffer (all of it if
+ * there are no projections).
+ *
+ * \param object
+ *      An object that passed #matches().
+ * \param objectBuffer
+ *      Holds exactly the serialized form of \a object.
+ * \param[out] buffer
+ *      Buffer to append to; getValueLength(object) bytes are appended.
+ */
+void
+EnumerationFilter::appendValue(Object& object, Buffer& objectBuffer,
+                               Buffer* buffer) const
+{
+    uint32_t valueLength = object.getValueLength();
+    uint32_t valueStart = objectBuffer.size() - valueLength;
+    if (projections.empty()) {
+        buffer->append(&objectBuffer, valueStart, valueLength);
+        return;
+    }
+    foreach (const Projection& projection, projections) {
+        if (projection.offset >= valueLength)
+            continue;
+        uint32_t length = std::min(projection.length,
+                                   valueLength - projection.offset);
+        buffer->append(&objectBuffer, valueStart + projection.offset,
+                       length);
+    }
+}
+
+/**
+ * Return the number of value bytes #appendValue() would return for an
+ * object.
+ */
+uint32_t
+EnumerationFilter::getValueLength(Object& object) const
+{
+    uint32_t valueLength = object.getValueLength();
+    if (projections.empty())
+        return valueLength;
+    uint32_t length = 0;
+    foreach (const Projection& projection, projections) {
+        if (projection.offset < valueLength) {
+            length += std::min(projection.length,
+                               valueLength - projection.offset);
+        }
+    }
+    return length;
+}
+
+/**
+ * Decide whether an object passes the filter.
+ *
+ * \param object
+ *      The object to check.
+ * \param objectBuffer
+ *      Holds exactly the serialized form of \a object.
+ * \return
+ *      True if the primary key of \a object starts with the key prefix and
+ *      its value satisfies every predicate.
+ */
+bool
+EnumerationFilter::matches(Object& object, Buffer& objectBuffer) const
+{
+    if (!keyPrefix.empty()) {
+        KeyLength keyLength = 0;
+        const void* key = object.getKey(0, &keyLength);
+        if (key == NULL || keyLength < keyPrefix.size() ||
+                memcmp(key, keyPrefix.data(), keyPrefix.size()) != 0) {
+            return false;
+        }
+    }
+
+    uint32_t valueLength = object.getValueLength();
+    uint32_t valueStart = objectBuffer.size() - valueLength;
+    foreach (const Predicate& predicate, predicates) {
+        uint32_t length = downCast<uint32_t>(predicate.operand.size());
+        if (predicate.offset > valueLength ||
+                length > valueLength - predicate.offset) {
+            return false;
+        }
+        int result = 0;
+        if (length > 0) {
+            const void* bytes = objectBuffer.getRange(
+                    valueStart + predicate.offset, length);
+            result = memcmp(bytes, predicate.operand.data(), length);
+        }
+        bool holds = false;
+        switch (predicate.comparison) {
+            case EQUAL:             holds = (result == 0); break;
+            case NOT_EQUAL:         holds = (result != 0); break;
+            case LESS:              holds = (result < 0);  break;
+            case LESS_OR_EQUAL:     holds = (result <= 0); break;
+            case GREATER:           holds = (result > 0);  break;
+            case GREATER_OR_EQUAL:  holds = (result >= 0); break;
+        }
+        if (!holds)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Append the serialized form of the filter to a buffer.
+ *
+ * \param buffer
+ *      Buffer to append to; usually a request.
+ * \return
+ *      The number of bytes appended.
+ */
+uint32_t
+EnumerationFilter::serialize(Buffer& buffer) const
+{
+    uint32_t start = buffer.size();
+    WireFormat::Enumerate::FilterHeader* header =
+            buffer.emplaceAppend<WireFormat::Enumerate::FilterHeader>();
+    header->keyPrefixLength = downCast<uint16_t>(keyPrefix.size());
+    header->numPredicates = downCast<uint8_t>(predicates.size());
+    header->numProjections = downCast<uint8_t>(projections.size());
+    buffer.appendCopy(keyPrefix.data(), header->keyPrefixLength);
+
+    foreach (const Predicate& predicate, predicates) {
+        WireFormat::Enumerate::Predicate* part =
+                buffer.emplaceAppend<WireFormat::Enumerate::Predicate>();
+        part->offset = predicate.offset;
+        part->length = downCast<uint16_t>(predicate.operand.size());
+        part->comparison = downCast<uint8_t>(predicate.comparison);
+        buffer.appendCopy(predicate.operand.data(), part->length);
+    }
+
+    foreach (const Projection& projection, projections) {
+        WireFormat::Enumerate::Projection* part =
+                buffer.emplaceAppend<WireFormat::Enumerate::Projection>();
+        part->offset = projection.offset;
+        part->length = projection.length;
+    }
+    return buffer.size() - start;
+}
+
+} // namespace RAMCloud
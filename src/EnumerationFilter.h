@@ -0,0 +1,116 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_ENUMERATIONFILTER_H
+#define RAMCLOUD_ENUMERATIONFILTER_H
+
+#include "Common.h"
+#include "Buffer.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+/**
+ * Describes which objects a table enumeration returns and which parts of
+ * their values, so that masters can drop everything else before it is put
+ * on the network. A client builds a filter and passes it to
+ * TableEnumerator (or RamCloud::enumerateTable); it is sent along with
+ * every ENUMERATE request, and the master evaluates it while enumerating.
+ *
+ * An object passes the filter if its primary key starts with the key
+ * prefix and every predicate holds. A predicate compares a range of bytes
+ * of the value with an operand, byte by byte as unsigned values (memcmp),
+ * so fixed-width big-endian fields compare numerically; it fails if the
+ * value is too short to hold the range. The value returned for an object
+ * that passes is the concatenation of the projected byte ranges, each cut
+ * short at the end of the value; with no projections the whole value is
+ * returned. The keys are always returned whole.
+ *
+ * The serialized form is a WireFormat::Enumerate::FilterHeader followed by
+ * the key prefix, then each WireFormat::Enumerate::Predicate followed by
+ * its operand, then WireFormat::Enumerate::Projections.
+ */
+class EnumerationFilter {
+  public:
+    /// How a range of value bytes is compared with a predicate's operand.
+    enum Comparison {
+        EQUAL = 0,
+        NOT_EQUAL = 1,
+        LESS = 2,
+        LESS_OR_EQUAL = 3,
+        GREATER = 4,
+        GREATER_OR_EQUAL = 5,
+    };
+
+    EnumerationFilter();
+    EnumerationFilter(Buffer& buffer, uint32_t offset, uint32_t length);
+
+    void addPredicate(uint32_t offset, Comparison comparison,
+                      const void* operand, uint16_t length);
+    void addProjection(uint32_t offset, uint32_t length);
+    void setKeyPrefix(const void* prefix, uint16_t length);
+
+    void appendValue(Object& object, Buffer& objectBuffer,
+                     Buffer* buffer) const;
+    uint32_t getValueLength(Object& object) const;
+    bool matches(Object& object, Buffer& objectBuffer) const;
+    uint32_t serialize(Buffer& buffer) const;
+
+  PRIVATE:
+    /// A condition the value of an object must satisfy.
+    struct Predicate {
+        Predicate(uint32_t offset, Comparison comparison, string operand)
+            : offset(offset)
+            , comparison(comparison)
+            , operand(operand)
+        {}
+
+        /// Offset in the value of the first byte compared.
+        uint32_t offset;
+
+        /// Outcome of the comparison that makes the predicate hold.
+        Comparison comparison;
+
+        /// Bytes compared with those of the value.
+        string operand;
+    };
+
+    /// A range of value bytes to return.
+    struct Projection {
+        Projection(uint32_t offset, uint32_t length)
+            : offset(offset)
+            , length(length)
+        {}
+
+        /// Offset in the value of the first byte returned.
+        uint32_t offset;
+
+        /// Number of bytes returned.
+        uint32_t length;
+    };
+
+    /// Only objects whose primary key starts with this are returned.
+    string keyPrefix;
+
+    /// Conditions an object's value must satisfy to be returned.
+    std::vector<Predicate> predicates;
+
+    /// Parts of the value returned; empty means the whole value.
+    std::vector<Projection> projections;
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_ENUMERATIONFILTER_H
@@ -0,0 +1,190 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ClientException.h"
+#include "EnumerationFilter.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+class EnumerationFilterTest : public ::testing::Test {
+  public:
+    Buffer objectBuffer;
+    Tub<Object> object;
+
+    EnumerationFilterTest()
+        : objectBuffer()
+        , object()
+    {
+    }
+
+    /// Make #object (serialized in #objectBuffer) hold \a key and \a value.
+    void
+    setObject(const char* key, const char* value)
+    {
+        Key primaryKey(1, key, downCast<KeyLength>(strlen(key)));
+        Buffer dataBuffer;
+        Object newObject(primaryKey, value, downCast<uint32_t>(strlen(value)),
+                         1, 0, dataBuffer);
+        objectBuffer.reset();
+        newObject.assembleForLog(objectBuffer);
+        object.construct(objectBuffer);
+    }
+
+    /// Return the value that #object would be returned with.
+    string
+    projectedValue(const EnumerationFilter& filter)
+    {
+        Buffer buffer;
+        filter.appendValue(*object, objectBuffer, &buffer);
+        EXPECT_EQ(filter.getValueLength(*object), buffer.size());
+        return TestUtil::toString(&buffer);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(EnumerationFilterTest);
+};
+
+TEST_F(EnumerationFilterTest, constructor_fromBufferEmpty) {
+    Buffer buffer;
+    EnumerationFilter filter(buffer, 0, 0);
+    setObject("key", "value");
+    EXPECT_TRUE(filter.matches(*object, objectBuffer));
+    EXPECT_EQ("value", projectedValue(filter));
+}
+
+TEST_F(EnumerationFilterTest, constructor_fromBufferMalformed) {
+    EnumerationFilter filter;
+    filter.setKeyPrefix("user:", 5);
+    filter.addPredicate(0, EnumerationFilter::EQUAL, "abc", 3);
+    filter.addProjection(1, 2);
+    Buffer buffer;
+    buffer.appendCopy("xx", 2);
+    uint32_t length = filter.serialize(buffer);
+
+    // Every truncation of the filter is rejected.
+    for (uint32_t i = 1; i < length; i++) {
+        EXPECT_THROW(EnumerationFilter(buffer, 2, i), RequestFormatError);
+    }
+    EXPECT_THROW(EnumerationFilter(buffer, 2, length + 1),
+                 RequestFormatError);
+
+    WireFormat::Enumerate::Predicate* predicate =
+            buffer.getOffset<WireFormat::Enumerate::Predicate>(
+            2 + sizeof32(WireFormat::Enumerate::FilterHeader) + 5);
+    predicate->comparison = 99;
+    EXPECT_THROW(EnumerationFilter(buffer, 2, length), RequestFormatError);
+}
+
+TEST_F(EnumerationFilterTest, serialize) {
+    EnumerationFilter filter;
+    filter.setKeyPrefix("user:", 5);
+    filter.addPredicate(2, EnumerationFilter::GREATER, "b", 1);
+    filter.addPredicate(0, EnumerationFilter::NOT_EQUAL, "zz", 2);
+    filter.addProjection(1, 2);
+    filter.addProjection(4, 1);
+    Buffer buffer;
+    uint32_t length = filter.serialize(buffer);
+    EXPECT_EQ(buffer.size(), length);
+
+    EnumerationFilter copy(buffer, 0, length);
+    EXPECT_EQ("user:", copy.keyPrefix);
+    ASSERT_EQ(2U, copy.predicates.size());
+    EXPECT_EQ(2U, copy.predicates[0].offset);
+    EXPECT_EQ(EnumerationFilter::GREATER, copy.predicates[0].comparison);
+    EXPECT_EQ("b", copy.predicates[0].operand);
+    EXPECT_EQ(EnumerationFilter::NOT_EQUAL, copy.predicates[1].comparison);
+    EXPECT_EQ("zz", copy.predicates[1].operand);
+    ASSERT_EQ(2U, copy.projections.size());
+    EXPECT_EQ(1U, copy.projections[0].offset);
+    EXPECT_EQ(2U, copy.projections[0].length);
+    EXPECT_EQ(4U, copy.projections[1].offset);
+    EXPECT_EQ(1U, copy.projections[1].length);
+}
+
+TEST_F(EnumerationFilterTest, appendValue) {
+    EnumerationFilter filter;
+    filter.addProjection(4, 2);
+    filter.addProjection(0, 1);
+    filter.addProjection(5, 10);
+    filter.addProjection(20, 1);
+    setObject("key", "abcdefg");
+    EXPECT_EQ("efafg", projectedValue(filter));
+}
+
+TEST_F(EnumerationFilterTest, matches_keyPrefix) {
+    EnumerationFilter filter;
+    filter.setKeyPrefix("user:", 5);
+    setObject("user:17", "value");
+    EXPECT_TRUE(filter.matches(*object, objectBuffer));
+    setObject("user:", "value");
+    EXPECT_TRUE(filter.matches(*object, objectBuffer));
+    setObject("user", "value");
+    EXPECT_FALSE(filter.matches(*object, objectBuffer));
+    setObject("item:17", "value");
+    EXPECT_FALSE(filter.matches(*object, objectBuffer));
+}
+
+TEST_F(EnumerationFilterTest, matches_comparisons) {
+    setObject("key", "aaMMzz");
+    struct {
+        EnumerationFilter::Comparison comparison;
+        const char* operand;
+        bool expected;
+    } cases[] = {
+        { EnumerationFilter::EQUAL, "MM", true },
+        { EnumerationFilter::EQUAL, "MN", false },
+        { EnumerationFilter::NOT_EQUAL, "MN", true },
+        { EnumerationFilter::LESS, "MN", true },
+        { EnumerationFilter::LESS, "MM", false },
+        { EnumerationFilter::LESS_OR_EQUAL, "MM", true },
+        { EnumerationFilter::GREATER, "ML", true },
+        { EnumerationFilter::GREATER, "MM", false },
+        { EnumerationFilter::GREATER_OR_EQUAL, "MM", true },
+        { EnumerationFilter::GREATER_OR_EQUAL, "\xff", false },
+    };
+    for (uint32_t i = 0; i < arrayLength(cases); i++) {
+        EnumerationFilter filter;
+        filter.addPredicate(2, cases[i].comparison, cases[i].operand,
+                downCast<uint16_t>(strlen(cases[i].operand)));
+        EXPECT_EQ(cases[i].expected, filter.matches(*object, objectBuffer))
+                << "case " << i;
+    }
+}
+
+TEST_F(EnumerationFilterTest, matches_allPredicates) {
+    EnumerationFilter filter;
+    filter.addPredicate(0, EnumerationFilter::GREATER_OR_EQUAL, "b", 1);
+    filter.addPredicate(0, EnumerationFilter::LESS, "d", 1);
+    setObject("key", "c");
+    EXPECT_TRUE(filter.matches(*object, objectBuffer));
+    setObject("key", "d");
+    EXPECT_FALSE(filter.matches(*object, objectBuffer));
+    setObject("key", "a");
+    EXPECT_FALSE(filter.matches(*object, objectBuffer));
+}
+
+TEST_F(EnumerationFilterTest, matches_valueTooShort) {
+    EnumerationFilter filter;
+    filter.addPredicate(3, EnumerationFilter::NOT_EQUAL, "xx", 2);
+    setObject("key", "abcde");
+    EXPECT_TRUE(filter.matches(*object, objectBuffer));
+    setObject("key", "abcd");
+    EXPECT_FALSE(filter.matches(*object, objectBuffer));
+    setObject("key", "");
+    EXPECT_FALSE(filter.matches(*object, objectBuffer));
+}
+
+}  // namespace RAMCloud
@@ -33,16 +33,33 @@ namespace RAMCloud {
  * \param bucketNextHash
  *      The next key hash to iterate when resuming inside a
  *      bucket that was too large to fit inside a single RPC.
+ * \param logId
+ *      Zero for enumerations in hash table order, otherwise the ServerId
+ *      of the master whose log is being enumerated in log order.
+ * \param segmentId
+ *      For enumerations in log order: the segment to resume with.
+ * \param segmentOffset
+ *      For enumerations in log order: the offset within \a segmentId to
+ *      resume at.
+ * \param relocationGeneration
+ *      For enumerations in log order: the relocation generation of the log
+ *      when the last RPC began.
  */
 EnumerationIterator::Frame::Frame(uint64_t tabletStartHash,
                                   uint64_t tabletEndHash,
                                   uint64_t numBuckets, uint64_t bucketIndex,
-                                  uint64_t bucketNextHash)
+                                  uint64_t bucketNextHash, uint64_t logId,
+                                  uint64_t segmentId, uint32_t segmentOffset,
+                                  uint64_t relocationGeneration)
     : tabletStartHash(tabletStartHash)
     , tabletEndHash(tabletEndHash)
     , numBuckets(numBuckets)
     , bucketIndex(bucketIndex)
     , bucketNextHash(bucketNextHash)
+    , logId(logId)
+    , segmentId(segmentId)
+    , segmentOffset(segmentOffset)
+    , relocationGeneration(relocationGeneration)
 {
 }
 
@@ -66,7 +83,9 @@ EnumerationIterator::EnumerationIterator(Buffer& buffer,
         frames.push_back(Frame(
             frame.tablet_start_hash(), frame.tablet_end_hash(),
             frame.num_buckets(), frame.bucket_index(),
-            frame.bucket_next_hash()));
+            frame.bucket_next_hash(), frame.log_id(),
+            frame.segment_id(), frame.segment_offset(),
+            frame.relocation_generation()));
     }
 }
 
@@ -157,6 +176,12 @@ EnumerationIterator::serialize(Buffer& buffer)
         part.set_num_buckets(frame.numBuckets);
         part.set_bucket_index(frame.bucketIndex);
         part.set_bucket_next_hash(frame.bucketNextHash);
+        if (frame.logId != 0) {
+            part.set_log_id(frame.logId);
+            part.set_segment_id(frame.segmentId);
+            part.set_segment_offset(frame.segmentOffset);
+            part.set_relocation_generation(frame.relocationGeneration);
+        }
     }
     ProtoBuf::serializeToResponse(&buffer, &message);
 
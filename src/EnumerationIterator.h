@@ -76,7 +76,9 @@ class EnumerationIterator {
     struct Frame {
         Frame(uint64_t tabletStartHash, uint64_t tabletEndHash,
               uint64_t numBuckets, uint64_t bucketIndex,
-              uint64_t bucketNextHash);
+              uint64_t bucketNextHash, uint64_t logId = 0,
+              uint64_t segmentId = 0, uint32_t segmentOffset = 0,
+              uint64_t relocationGeneration = 0);
 
         /// The smallest key hash value for the tablet being enumerated.
         uint64_t tabletStartHash;
@@ -102,6 +104,29 @@ class EnumerationIterator {
         /// in a table of size \c numBuckets, and if its key hash is less
         /// than this, then it has already been enumerated.
         uint64_t bucketNextHash;
+
+        /// Zero for frames of enumerations in hash table order. Otherwise
+        /// the frame describes an enumeration in log order (see
+        /// Enumeration::completeInLogOrder) through the log of the master
+        /// with this ServerId; none of the bucket fields are used then,
+        /// and such a frame excludes nothing on any other master.
+        uint64_t logId;
+
+        /// For frames of enumerations in log order: the segment to resume
+        /// with. Objects in the range given by \c tabletStartHash and
+        /// \c tabletEndHash that were live in segments with smaller
+        /// identifiers have already been enumerated.
+        uint64_t segmentId;
+
+        /// For frames of enumerations in log order: the offset within
+        /// \c segmentId of the first entry that hasn't been examined.
+        uint32_t segmentOffset;
+
+        /// For frames of enumerations in log order: the segments added to
+        /// the log by the cleaner before the last RPC of the enumeration
+        /// began have LogSegment::relocationGeneration values no larger
+        /// than this.
+        uint64_t relocationGeneration;
     };
 
     EnumerationIterator(Buffer& buffer, uint32_t offset, uint32_t length);
@@ -81,6 +81,27 @@ ExternalStorage::getWorkspace()
     return workspace.c_str();
 }
 
+/**
+ * Set the values of several objects, as if by calling set for each of
+ * them in order, but with as few round trips to the storage system as it
+ * allows (ZooKeeper, for example, can apply all of them in a single
+ * atomic operation). This default implementation just invokes set for
+ * each object.
+ *
+ * \param writes
+ *      Objects to write, and their new values.
+ *
+ * \throws LostLeadershipException
+ */
+void
+ExternalStorage::setMultiple(const vector<Write>& writes)
+{
+    foreach (const Write& write, writes) {
+        set(write.flavor, write.name.c_str(), write.value.data(),
+                downCast<int>(write.value.size()));
+    }
+}
+
 // See header file for documentation.
 void
 ExternalStorage::setWorkspace(const char* pathPrefix)
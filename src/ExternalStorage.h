@@ -134,6 +134,28 @@ class ExternalStorage {
         UPDATE                     // An existing object is being overwritten.
     };
 
+    /**
+     * Describes one object to write with setMultiple: the arguments that
+     * would otherwise be passed to set.
+     */
+    struct Write {
+        Write(Hint flavor, const char* name, const string& value)
+            : flavor(flavor)
+            , name(name)
+            , value(value)
+        {}
+
+        /// See the corresponding argument to set.
+        Hint flavor;
+
+        /// Name of the object; relative names are concatenated to the
+        /// current workspace.
+        string name;
+
+        /// New contents of the object.
+        string value;
+    };
+
     ExternalStorage();
     virtual ~ExternalStorage() {}
 
@@ -281,6 +303,8 @@ class ExternalStorage {
     virtual void set(Hint flavor, const char* name, const char* value,
             int valueLength = -1) = 0;
 
+    virtual void setMultiple(const vector<Write>& writes);
+
     /**
      * Specify the current workspace for the application. This is
      * equivalent to a working directory: if a node name specified to
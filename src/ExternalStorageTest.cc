@@ -55,6 +55,15 @@ TEST_F(ExternalStorageTest, getFullName) {
             storage.getFullName("/first/second/third"));
 }
 
+TEST_F(ExternalStorageTest, setMultiple_default) {
+    vector<ExternalStorage::Write> writes;
+    writes.emplace_back(ExternalStorage::CREATE, "/a", "value1");
+    writes.emplace_back(ExternalStorage::UPDATE, "/b", "value2");
+    storage.setMultiple(writes);
+    EXPECT_EQ("set(CREATE, /a); set(UPDATE, /b)", storage.log);
+    EXPECT_EQ("value2", storage.setData);
+}
+
 TEST_F(ExternalStorageTest, get_templated_basics) {
     ProtoBuf::TableManager info;
     info.set_next_table_id(123);
@@ -15,6 +15,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <algorithm>
 
 #include "Common.h"
 #include "AdminClient.h"
@@ -167,6 +168,13 @@ FailureDetector::pingRandomServer()
             LOG(DEBUG, "Ping succeeded to server %s (%s) in %.1f us",
                 pingee.toString().c_str(), locator.c_str(),
                 1e06*Cycles::toSeconds(Cycles::rdtsc() - start));
+        } else if (probeIndirectly(pingee)) {
+            // Someone else can reach the server, so it's alive; and since
+            // they answered us, we don't appear to be cut off either.
+            probesWithoutResponse = 0;
+            LOG(NOTICE, "Ping timeout to server id %s (locator \"%s\"), "
+                "but indirect probe succeeded",
+                pingee.toString().c_str(), locator.c_str());
         } else {
             // Server appears to have crashed; notify the coordinator.
             LOG(WARNING, "Ping timeout to server id %s (locator \"%s\")",
@@ -192,4 +200,58 @@ FailureDetector::pingRandomServer()
         probesWithoutResponse = 0;
     }
 }
+
+/**
+ * Ask up to INDIRECT_PROBES other servers, chosen at random, to ping a
+ * server that didn't answer our own ping, and wait for their verdicts.
+ *
+ * \param target
+ *      The server that didn't respond.
+ * \return
+ *      True if at least one of the other servers got a response from
+ *      \a target; false if none did, or there was no one else to ask.
+ */
+bool
+FailureDetector::probeIndirectly(ServerId target)
+{
+    std::vector<ServerId> proxies;
+    for (int attempts = 0; (attempts < 4*INDIRECT_PROBES)
+            && (proxies.size() < size_t(INDIRECT_PROBES)); attempts++) {
+        ServerId proxy = serverTracker.getRandomServerIdWithService(
+            WireFormat::ADMIN_SERVICE);
+        if (!proxy.isValid() || proxy == ourServerId || proxy == target ||
+                std::find(proxies.begin(), proxies.end(), proxy)
+                != proxies.end()) {
+            continue;
+        }
+        proxies.push_back(proxy);
+    }
+    if (proxies.empty())
+        return false;
+
+    // Issue all of the probes before waiting for any of them.
+    Tub<ProxyPingRpc> rpcs[INDIRECT_PROBES];
+    for (size_t i = 0; i < proxies.size(); i++) {
+        rpcs[i].construct(context, proxies[i], target,
+                INDIRECT_TIMEOUT_USECS * 1000UL);
+    }
+    uint64_t deadline = Cycles::rdtsc() + Cycles::fromNanoseconds(
+            (INDIRECT_TIMEOUT_USECS + TIMEOUT_USECS) * 1000UL);
+    for (size_t i = 0; i < proxies.size(); i++) {
+        uint64_t now = Cycles::rdtsc();
+        uint64_t timeout = (now < deadline)
+                ? Cycles::toNanoseconds(deadline - now) : 0;
+        try {
+            if (rpcs[i]->wait(timeout) != ~0UL) {
+                LOG(DEBUG, "Server %s reached server %s on our behalf",
+                    proxies[i].toString().c_str(),
+                    target.toString().c_str());
+                return true;
+            }
+        } catch (const ClientException& e) {
+            // The proxy couldn't help; that says nothing about the target.
+        }
+    }
+    return false;
+}
 } // namespace
@@ -32,9 +32,13 @@ namespace RAMCloud {
 /**
  * This class instantiates and manages the failure detector. Each RAMCloud
  * server should have an instantiation of this class that randomly pings
- * other servers in the cluster. If any pings time out, the coordinator
- * is warned of a possible failure via the HintServerCrashed RPC. It is then
- * up to the coordinator to make a diagnosis. This class simply reports
+ * other servers in the cluster. If a ping times out, a few other servers
+ * are asked to ping the same server on our behalf (in the style of SWIM's
+ * indirect probes); only if none of them gets a response either is the
+ * coordinator warned of a possible failure via the HintServerCrashed RPC.
+ * Indirect probes filter out problems between just the two servers, which
+ * is what allows the probes to be frequent and their timeouts short. It is
+ * then up to the coordinator to make a diagnosis. This class simply reports
  * possible symptoms that it sees.
  *
  * Once you contruct a FailureDetector you may use start() and halt() to
@@ -50,17 +54,27 @@ class FailureDetector {
 
   PRIVATE:
     /// Number of microseconds between probes.
-    static const int PROBE_INTERVAL_USECS = 100 * 1000;
+    static const int PROBE_INTERVAL_USECS = 20 * 1000;
 
     /**
      * Number of microseconds before a probe is considered to have timed out.
      * Some machines have be known to freeze for approximately 250ms, but this
-     * threshold is intentionally smaller. We allow the coordinator to try again
-     * with a longer timeout for those false-positives. If the coordinator ends
-     * up becoming a bottleneck we may need to increase this timeout and move to
-     * an asynchronous model.
+     * threshold is intentionally smaller. Indirect probes (see
+     * INDIRECT_PROBES) weed out most false positives before the coordinator
+     * hears about them, and we allow the coordinator to try again with a
+     * longer timeout for the rest. If the coordinator ends up becoming a
+     * bottleneck we may need to increase this timeout and move to an
+     * asynchronous model.
      */
-    static const int TIMEOUT_USECS = 50 * 1000;
+    static const int TIMEOUT_USECS = 10 * 1000;
+
+    /// When a probe times out, this many other servers (if there are that
+    /// many) are asked to ping the server with a ProxyPing RPC.
+    static const int INDIRECT_PROBES = 3;
+
+    /// How long servers asked for an indirect probe wait for the server
+    /// they ping, in microseconds.
+    static const int INDIRECT_TIMEOUT_USECS = 20 * 1000;
 
     static_assert(TIMEOUT_USECS <= PROBE_INTERVAL_USECS,
                   "Timeout us should be less than probe interval.");
@@ -81,7 +95,7 @@ class FailureDetector {
 
     /// If probesWithoutResponse reaches this value, then check with the
     /// coordinator to make sure we're still in the cluster.
-    static const int MAX_FAILED_PROBES = 5;
+    static const int MAX_FAILED_PROBES = 25;
 
     /// Failure detector thread
     Tub<std::thread>     thread;
@@ -91,6 +105,7 @@ class FailureDetector {
 
     static void detectorThreadEntry(FailureDetector* detector, Context* ctx);
     void pingRandomServer();
+    bool probeIndirectly(ServerId target);
     void alertCoordinator(ServerId serverId, string locator);
 
     DISALLOW_COPY_AND_ASSIGN(FailureDetector);
@@ -40,6 +40,7 @@ class FailureDetectorTest : public ::testing::Test {
     TestLog::Enable logEnabler;
     MockTransport mockTransport;
     MockTransport coordTransport;
+    MockTransport proxyTransport;
     FailureDetector *fd;
 
     FailureDetectorTest()
@@ -48,10 +49,12 @@ class FailureDetectorTest : public ::testing::Test {
           logEnabler(),
           mockTransport(&context),
           coordTransport(&context),
+          proxyTransport(&context),
           fd(NULL)
     {
         context.transportManager->registerMock(&mockTransport, "mock");
         context.transportManager->registerMock(&coordTransport, "coord");
+        context.transportManager->registerMock(&proxyTransport, "proxy");
         context.coordinatorSession->setLocation("coord:");
         fd = new FailureDetector(&context, ServerId(57, 27342));
     }
@@ -154,4 +157,35 @@ TEST_F(FailureDetectorTest, pingRandomServer_tooManyFailedProbes) {
     EXPECT_EQ(0, fd->probesWithoutResponse);
 }
 
+TEST_F(FailureDetectorTest, probeIndirectly_noProxies) {
+    MockRandom _(1);
+    addServer(ServerId(1, 0), "mock:");
+    EXPECT_FALSE(fd->probeIndirectly(ServerId(1, 0)));
+    EXPECT_EQ("", proxyTransport.outputLog);
+}
+
+TEST_F(FailureDetectorTest, probeIndirectly_targetReached) {
+    MockRandom _(1);
+    addServer(ServerId(1, 0), "mock:");
+    addServer(ServerId(2, 0), "proxy:");
+    addServer(ServerId(3, 0), "proxy:");
+    // The first proxy doesn't hear from the target, the second one does.
+    proxyTransport.setInput("0 0xffffffff 0xffffffff");
+    proxyTransport.setInput("0 5 0");
+    EXPECT_TRUE(fd->probeIndirectly(ServerId(1, 0)));
+    EXPECT_EQ(2u, proxyTransport.output.size());
+}
+
+TEST_F(FailureDetectorTest, probeIndirectly_targetUnreachable) {
+    TestLog::Enable logSilencer("wait", NULL);
+    MockRandom _(1);
+    addServer(ServerId(1, 0), "mock:");
+    addServer(ServerId(2, 0), "proxy:");
+    addServer(ServerId(3, 0), "proxy:");
+    // One proxy reports failure; the other never answers.
+    proxyTransport.setInput("0 0xffffffff 0xffffffff");
+    EXPECT_FALSE(fd->probeIndirectly(ServerId(1, 0)));
+    EXPECT_EQ("wait: timeout", TestLog::get());
+}
+
 } // namespace RAMCloud
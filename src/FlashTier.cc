@@ -0,0 +1,108 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FlashTier.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Map a file on local flash. Its previous contents, if any, are ignored.
+ *
+ * \param path
+ *      The file to map. It is created if it doesn't exist, and a regular
+ *      file is resized to \a length bytes; a block device is used as is and
+ *      must be at least that large.
+ * \param length
+ *      Number of bytes to map; rounded down to a multiple of \a alignment.
+ * \param alignment
+ *      The mapping starts on a multiple of this many bytes; it must be a
+ *      power of two. This is the seglet size, so that references into
+ *      seglets on flash can be handled just like those into memory.
+ * \throw FatalError
+ *      If the file could not be opened, resized or mapped.
+ */
+FlashTier::FlashTier(const string& path, uint64_t length, uint32_t alignment)
+    : length(length / alignment * alignment)
+    , block(NULL)
+{
+    assert((alignment & (alignment - 1)) == 0);
+    int fd = open(path.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd == -1) {
+        throw FatalError(HERE, format("Could not open flash tier file [%s]",
+                path.c_str()), errno);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (S_ISREG(info.st_mode) &&
+            ftruncate(fd, this->length) != 0)) {
+        int error = errno;
+        close(fd);
+        throw FatalError(HERE, format("Could not resize flash tier file [%s] "
+                "to %lu bytes", path.c_str(), this->length), error);
+    }
+
+    // Reserve enough address space to find an aligned start in, then map
+    // the file over that start.
+    size_t reserved = this->length + alignment;
+    void* reservation = mmap(NULL, reserved, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw FatalError(HERE, "Could not reserve address space for the "
+                "flash tier", error);
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(reservation);
+    uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    void* p = mmap(reinterpret_cast<void*>(aligned), this->length,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (p == MAP_FAILED) {
+        munmap(reservation, reserved);
+        throw FatalError(HERE, format("Could not mmap flash tier file [%s]",
+                path.c_str()), error);
+    }
+    if (aligned > start)
+        munmap(reservation, aligned - start);
+    if (aligned + this->length < start + reserved) {
+        munmap(reinterpret_cast<void*>(aligned + this->length),
+               start + reserved - aligned - this->length);
+    }
+    block = static_cast<uint8_t*>(p);
+
+    // Entries are read a few at a time from all over the file; reading
+    // ahead would just push other pages out of memory.
+    madvise(block, this->length, MADV_RANDOM);
+
+    LOG(NOTICE, "Mapped %lu MB of flash from [%s] at %p",
+        this->length / (1 << 20), path.c_str(), p);
+}
+
+/**
+ * Unmap the file. Seglets carved out of it must no longer be in use.
+ */
+FlashTier::~FlashTier()
+{
+    if (munmap(block, length) != 0)
+        LOG(WARNING, "munmap of flash tier failed with %d", errno);
+}
+
+} // namespace RAMCloud
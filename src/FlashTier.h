@@ -0,0 +1,66 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_FLASHTIER_H
+#define RAMCLOUD_FLASHTIER_H
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * A file (or block device) on local flash, mapped into memory so that seglets
+ * can be carved out of it just like out of the DRAM block. The log cleaner
+ * writes survivor segments full of cold objects into these seglets (see
+ * SegletAllocator::FLASH), so a master can hold more data than fits in its
+ * memory. Everything that reaches log entries through references (reads,
+ * the cleaner, re-replication, log iteration) works unchanged on them: the
+ * kernel reads pages in from flash when they are touched and may drop them
+ * from memory again once they have been written back.
+ *
+ * Nothing on flash needs to survive a restart, since backups hold the
+ * durable copies of all segments.
+ */
+class FlashTier {
+  public:
+    FlashTier(const string& path, uint64_t length, uint32_t alignment);
+    ~FlashTier();
+
+    /// Returns the first byte of the mapping.
+    uint8_t* get() { return block; }
+
+    /**
+     * Returns true if the given address lies within the mapping.
+     */
+    bool
+    contains(const void* p) const
+    {
+        const uint8_t* address = static_cast<const uint8_t*>(p);
+        return (address >= block) && (address < block + length);
+    }
+
+    /// Number of bytes mapped at #block.
+    const uint64_t length;
+
+  PRIVATE:
+    /// The mapping itself; aligned as the constructor was asked to.
+    uint8_t* block;
+
+    DISALLOW_COPY_AND_ASSIGN(FlashTier);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_FLASHTIER_H
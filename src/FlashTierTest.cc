@@ -0,0 +1,80 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/stat.h>
+
+#include "TestUtil.h"
+
+#include "FlashTier.h"
+
+namespace RAMCloud {
+
+class FlashTierTest : public ::testing::Test {
+  public:
+    const char* path;
+
+    FlashTierTest()
+        : path("/tmp/ramcloud-flash-tier-test-delete-this")
+    {
+        unlink(path);
+    }
+
+    ~FlashTierTest()
+    {
+        unlink(path);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(FlashTierTest);
+};
+
+TEST_F(FlashTierTest, constructor) {
+    uint32_t alignment = 64 * 1024;
+    FlashTier flash(path, 10 * alignment + 100, alignment);
+    EXPECT_EQ(10u * alignment, flash.length);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(flash.get()) % alignment);
+
+    struct stat info;
+    ASSERT_EQ(0, stat(path, &info));
+    EXPECT_EQ(static_cast<off_t>(10 * alignment), info.st_size);
+}
+
+TEST_F(FlashTierTest, constructor_badFile) {
+    EXPECT_THROW(FlashTier("/nonexistent/directory/file", 1 << 20, 4096),
+                 FatalError);
+}
+
+TEST_F(FlashTierTest, writesReachTheFile) {
+    {
+        FlashTier flash(path, 1 << 20, 4096);
+        memcpy(flash.get() + 5000, "flash!", 6);
+    }
+    FILE* f = fopen(path, "r");
+    ASSERT_TRUE(f != NULL);
+    char contents[6];
+    fseek(f, 5000, SEEK_SET);
+    EXPECT_EQ(6u, fread(contents, 1, 6, f));
+    fclose(f);
+    EXPECT_EQ("flash!", string(contents, 6));
+}
+
+TEST_F(FlashTierTest, contains) {
+    FlashTier flash(path, 1 << 20, 4096);
+    EXPECT_TRUE(flash.contains(flash.get()));
+    EXPECT_TRUE(flash.contains(flash.get() + flash.length - 1));
+    EXPECT_FALSE(flash.contains(flash.get() + flash.length));
+    EXPECT_FALSE(flash.contains(flash.get() - 1));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,205 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <unordered_map>
+
+#include "FlatTableConfig.h"
+
+namespace RAMCloud {
+
+const FlatTableConfig::Header FlatTableConfig::EMPTY = {0, 0};
+
+namespace {
+
+/**
+ * Collects the string area of an encoding, storing each distinct string
+ * only once.
+ */
+struct StringArea {
+    StringArea()
+        : bytes()
+        , offsets()
+    {}
+
+    /**
+     * Returns the offset of a string within the area, adding it if it
+     * isn't there yet.
+     */
+    uint32_t
+    intern(const string& s)
+    {
+        std::unordered_map<string, uint32_t>::iterator it = offsets.find(s);
+        if (it != offsets.end())
+            return it->second;
+        uint32_t offset = downCast<uint32_t>(bytes.size());
+        bytes.append(s);
+        offsets[s] = offset;
+        return offset;
+    }
+
+    /// The contents of the area.
+    string bytes;
+
+    /// Maps each string in #bytes to its offset.
+    std::unordered_map<string, uint32_t> offsets;
+};
+
+} // anonymous namespace
+
+/**
+ * Append the encoding of a table's configuration to a buffer.
+ *
+ * \param config
+ *      The configuration to encode, as produced by
+ *      TableManager::serializeTableConfig.
+ * \param buffer
+ *      The encoding is appended here.
+ * \return
+ *      The number of bytes appended to \a buffer.
+ */
+uint32_t
+FlatTableConfig::encode(const ProtoBuf::TableConfig& config, Buffer* buffer)
+{
+    uint32_t start = buffer->size();
+    StringArea strings;
+    std::vector<TabletEntry> tablets;
+    std::vector<IndexletEntry> indexlets;
+
+    foreach (const ProtoBuf::TableConfig::Tablet& tablet, config.tablet()) {
+        TabletEntry entry;
+        entry.startKeyHash = tablet.start_key_hash();
+        entry.endKeyHash = tablet.end_key_hash();
+        entry.serverId = tablet.server_id();
+        entry.ctimeLogHeadId = tablet.ctime_log_head_id();
+        entry.ctimeLogHeadOffset = tablet.ctime_log_head_offset();
+        entry.locatorOffset = strings.intern(tablet.service_locator());
+        entry.locatorLength =
+                downCast<uint16_t>(tablet.service_locator().size());
+        entry.state = downCast<uint8_t>(tablet.state());
+        entry.keyHash = downCast<uint8_t>(tablet.key_hash());
+        tablets.push_back(entry);
+    }
+    foreach (const ProtoBuf::TableConfig::Index& index, config.index()) {
+        foreach (const ProtoBuf::TableConfig::Index::Indexlet& indexlet,
+                index.indexlet()) {
+            IndexletEntry entry;
+            entry.serverId = indexlet.server_id();
+            entry.startKeyOffset = strings.intern(indexlet.start_key());
+            entry.endKeyOffset = strings.intern(indexlet.end_key());
+            entry.locatorOffset = strings.intern(indexlet.service_locator());
+            entry.startKeyLength =
+                    downCast<uint16_t>(indexlet.start_key().size());
+            entry.endKeyLength = downCast<uint16_t>(indexlet.end_key().size());
+            entry.locatorLength =
+                    downCast<uint16_t>(indexlet.service_locator().size());
+            entry.indexId = downCast<uint8_t>(index.index_id());
+            indexlets.push_back(entry);
+        }
+    }
+
+    Header* header = buffer->emplaceAppend<Header>();
+    header->tabletCount = downCast<uint32_t>(tablets.size());
+    header->indexletCount = downCast<uint32_t>(indexlets.size());
+    if (!tablets.empty()) {
+        buffer->appendCopy(&tablets[0],
+                downCast<uint32_t>(tablets.size() * sizeof(TabletEntry)));
+    }
+    if (!indexlets.empty()) {
+        buffer->appendCopy(&indexlets[0],
+                downCast<uint32_t>(indexlets.size() * sizeof(IndexletEntry)));
+    }
+    if (!strings.bytes.empty()) {
+        buffer->appendCopy(strings.bytes.data(),
+                downCast<uint32_t>(strings.bytes.size()));
+    }
+    return buffer->size() - start;
+}
+
+/**
+ * Construct an empty configuration: it has no tablets or indexlets until
+ * parse() is called.
+ */
+FlatTableConfig::FlatTableConfig()
+    : header(&EMPTY)
+    , tablets(NULL)
+    , indexlets(NULL)
+    , strings(NULL)
+{
+}
+
+/**
+ * Refer to an encoding produced by encode(). Nothing is copied out of the
+ * buffer (unless the encoding is split across several chunks of it), so the
+ * buffer must not change while this object is in use.
+ *
+ * \param buffer
+ *      Holds the encoding.
+ * \param offset
+ *      Offset of the first byte of the encoding within \a buffer.
+ * \param length
+ *      Number of bytes in the encoding.
+ * \return
+ *      True means the encoding is well-formed. False means it is truncated
+ *      or refers outside itself; this object is left empty.
+ */
+bool
+FlatTableConfig::parse(Buffer* buffer, uint32_t offset, uint32_t length)
+{
+    header = &EMPTY;
+    if (length < sizeof32(Header))
+        return false;
+    const char* start = static_cast<const char*>(
+            buffer->getRange(offset, length));
+    if (start == NULL)
+        return false;
+    const Header* newHeader = reinterpret_cast<const Header*>(start);
+    uint64_t entriesLength = sizeof(Header) +
+            uint64_t(newHeader->tabletCount) * sizeof(TabletEntry) +
+            uint64_t(newHeader->indexletCount) * sizeof(IndexletEntry);
+    if (entriesLength > length)
+        return false;
+    uint64_t stringsLength = length - entriesLength;
+
+    const TabletEntry* newTablets =
+            reinterpret_cast<const TabletEntry*>(start + sizeof(Header));
+    const IndexletEntry* newIndexlets =
+            reinterpret_cast<const IndexletEntry*>(
+            newTablets + newHeader->tabletCount);
+    for (uint32_t i = 0; i < newHeader->tabletCount; i++) {
+        const TabletEntry& tablet = newTablets[i];
+        if (uint64_t(tablet.locatorOffset) + tablet.locatorLength >
+                stringsLength)
+            return false;
+    }
+    for (uint32_t i = 0; i < newHeader->indexletCount; i++) {
+        const IndexletEntry& indexlet = newIndexlets[i];
+        if (uint64_t(indexlet.startKeyOffset) + indexlet.startKeyLength >
+                stringsLength ||
+                uint64_t(indexlet.endKeyOffset) + indexlet.endKeyLength >
+                stringsLength ||
+                uint64_t(indexlet.locatorOffset) + indexlet.locatorLength >
+                stringsLength)
+            return false;
+    }
+
+    header = newHeader;
+    tablets = newTablets;
+    indexlets = newIndexlets;
+    strings = start + entriesLength;
+    return true;
+}
+
+} // namespace RAMCloud
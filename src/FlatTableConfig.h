@@ -0,0 +1,138 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_FLATTABLECONFIG_H
+#define RAMCLOUD_FLATTABLECONFIG_H
+
+#include "Common.h"
+#include "Buffer.h"
+#include "TableConfig.pb.h"
+
+namespace RAMCloud {
+
+/**
+ * A fixed-layout binary encoding of a ProtoBuf::TableConfig, which clients
+ * can read in place in the response Buffer: there is nothing to parse and
+ * nothing to allocate. The coordinator uses it to answer GET_TABLE_CONFIG
+ * requests from ObjectFinder, which rebuilds its tablet map straight from
+ * the entries.
+ *
+ * An encoding is a Header, followed by Header::tabletCount TabletEntry
+ * structures, Header::indexletCount IndexletEntry structures and a string
+ * area holding the service locators and index keys. Each service locator
+ * appears in the string area only once, however many tablets and indexlets
+ * it serves.
+ */
+class FlatTableConfig {
+  public:
+    /// Starts an encoding.
+    struct Header {
+        uint32_t tabletCount;
+        uint32_t indexletCount;
+    } __attribute__((packed));
+
+    /// One tablet; see ProtoBuf::TableConfig::Tablet.
+    struct TabletEntry {
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+        uint64_t serverId;
+        uint64_t ctimeLogHeadId;
+        uint32_t ctimeLogHeadOffset;
+        uint32_t locatorOffset;     // Offset of the service locator within
+                                    // the string area.
+        uint16_t locatorLength;     // Bytes in the service locator.
+        uint8_t state;              // A ProtoBuf::TableConfig::Tablet::State.
+        uint8_t keyHash;            // The table's Key::HashFunction.
+    } __attribute__((packed));
+
+    /// One indexlet; see ProtoBuf::TableConfig::Index::Indexlet.
+    struct IndexletEntry {
+        uint64_t serverId;
+        uint32_t startKeyOffset;    // Offsets of the keys and service
+        uint32_t endKeyOffset;      // locator within the string area.
+        uint32_t locatorOffset;
+        uint16_t startKeyLength;
+        uint16_t endKeyLength;
+        uint16_t locatorLength;
+        uint8_t indexId;            // Index the indexlet belongs to.
+    } __attribute__((packed));
+
+    static uint32_t encode(const ProtoBuf::TableConfig& config,
+            Buffer* buffer);
+
+    FlatTableConfig();
+    bool parse(Buffer* buffer, uint32_t offset, uint32_t length);
+
+    /// Returns the number of tablets in the encoding.
+    uint32_t getTabletCount() const { return header->tabletCount; }
+
+    /// Returns the number of indexlets in the encoding.
+    uint32_t getIndexletCount() const { return header->indexletCount; }
+
+    /**
+     * Returns the tablet with the given position, which must be less
+     * than getTabletCount().
+     */
+    const TabletEntry&
+    getTablet(uint32_t i) const
+    {
+        assert(i < getTabletCount());
+        return tablets[i];
+    }
+
+    /**
+     * Returns the indexlet with the given position, which must be less
+     * than getIndexletCount().
+     */
+    const IndexletEntry&
+    getIndexlet(uint32_t i) const
+    {
+        assert(i < getIndexletCount());
+        return indexlets[i];
+    }
+
+    /**
+     * Returns the bytes at an offset within the string area, such as
+     * TabletEntry::locatorOffset. They are not null-terminated.
+     */
+    const char*
+    getString(uint32_t offset) const
+    {
+        return strings + offset;
+    }
+
+  PRIVATE:
+    /// The start of the encoding; an empty Header until parse() succeeds.
+    const Header* header;
+
+    /// The tablet entries, which immediately follow #header.
+    const TabletEntry* tablets;
+
+    /// The indexlet entries, which immediately follow #tablets.
+    const IndexletEntry* indexlets;
+
+    /// The string area, which immediately follows #indexlets.
+    const char* strings;
+
+    /// Used by #header before anything has been parsed.
+    static const Header EMPTY;
+
+    DISALLOW_COPY_AND_ASSIGN(FlatTableConfig);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_FLATTABLECONFIG_H
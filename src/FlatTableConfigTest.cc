@@ -0,0 +1,142 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+
+#include "FlatTableConfig.h"
+
+namespace RAMCloud {
+
+class FlatTableConfigTest : public ::testing::Test {
+  public:
+    ProtoBuf::TableConfig config;
+    Buffer buffer;
+
+    FlatTableConfigTest()
+        : config()
+        , buffer()
+    {
+        addTablet(0, 0x7fff, 1, "mock:host=one");
+        addTablet(0x8000, ~0UL, 2, "mock:host=two");
+        ProtoBuf::TableConfig::Index* index = config.add_index();
+        index->set_index_id(3);
+        index->set_index_type(0);
+        ProtoBuf::TableConfig::Index::Indexlet* indexlet =
+                index->add_indexlet();
+        indexlet->set_start_key("a");
+        indexlet->set_end_key("mno");
+        indexlet->set_server_id(1);
+        indexlet->set_service_locator("mock:host=one");
+    }
+
+    void
+    addTablet(uint64_t start, uint64_t end, uint64_t serverId,
+            const char* locator)
+    {
+        ProtoBuf::TableConfig::Tablet* tablet = config.add_tablet();
+        tablet->set_table_id(1);
+        tablet->set_start_key_hash(start);
+        tablet->set_end_key_hash(end);
+        tablet->set_state(ProtoBuf::TableConfig::Tablet::RECOVERING);
+        tablet->set_server_id(serverId);
+        tablet->set_service_locator(locator);
+        tablet->set_ctime_log_head_id(10 + serverId);
+        tablet->set_ctime_log_head_offset(20);
+    }
+
+    string
+    getString(FlatTableConfig& flat, uint32_t offset, uint16_t length)
+    {
+        return string(flat.getString(offset), length);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(FlatTableConfigTest);
+};
+
+TEST_F(FlatTableConfigTest, encodeAndParse) {
+    buffer.appendCopy("xyz", 3);
+    uint32_t length = FlatTableConfig::encode(config, &buffer);
+    EXPECT_EQ(buffer.size() - 3, length);
+
+    FlatTableConfig flat;
+    ASSERT_TRUE(flat.parse(&buffer, 3, length));
+    ASSERT_EQ(2u, flat.getTabletCount());
+    const FlatTableConfig::TabletEntry& tablet = flat.getTablet(1);
+    EXPECT_EQ(0x8000u, tablet.startKeyHash);
+    EXPECT_EQ(~0UL, tablet.endKeyHash);
+    EXPECT_EQ(2u, tablet.serverId);
+    EXPECT_EQ(12u, tablet.ctimeLogHeadId);
+    EXPECT_EQ(20u, tablet.ctimeLogHeadOffset);
+    EXPECT_EQ(ProtoBuf::TableConfig::Tablet::RECOVERING, tablet.state);
+    EXPECT_EQ("mock:host=two",
+              getString(flat, tablet.locatorOffset, tablet.locatorLength));
+
+    ASSERT_EQ(1u, flat.getIndexletCount());
+    const FlatTableConfig::IndexletEntry& indexlet = flat.getIndexlet(0);
+    EXPECT_EQ(3u, indexlet.indexId);
+    EXPECT_EQ(1u, indexlet.serverId);
+    EXPECT_EQ("a", getString(flat, indexlet.startKeyOffset,
+                             indexlet.startKeyLength));
+    EXPECT_EQ("mno", getString(flat, indexlet.endKeyOffset,
+                               indexlet.endKeyLength));
+    EXPECT_EQ("mock:host=one", getString(flat, indexlet.locatorOffset,
+                                         indexlet.locatorLength));
+}
+
+TEST_F(FlatTableConfigTest, encode_locatorsStoredOnce) {
+    FlatTableConfig::encode(config, &buffer);
+    FlatTableConfig flat;
+    ASSERT_TRUE(flat.parse(&buffer, 0, buffer.size()));
+    EXPECT_EQ(flat.getTablet(0).locatorOffset,
+              flat.getIndexlet(0).locatorOffset);
+    EXPECT_EQ(sizeof(FlatTableConfig::Header) +
+              2 * sizeof(FlatTableConfig::TabletEntry) +
+              sizeof(FlatTableConfig::IndexletEntry) +
+              strlen("mock:host=one") + strlen("mock:host=two") + 4,
+              buffer.size());
+}
+
+TEST_F(FlatTableConfigTest, encode_empty) {
+    config.Clear();
+    EXPECT_EQ(sizeof(FlatTableConfig::Header),
+              FlatTableConfig::encode(config, &buffer));
+    FlatTableConfig flat;
+    EXPECT_TRUE(flat.parse(&buffer, 0, buffer.size()));
+    EXPECT_EQ(0u, flat.getTabletCount());
+    EXPECT_EQ(0u, flat.getIndexletCount());
+}
+
+TEST_F(FlatTableConfigTest, parse_malformed) {
+    FlatTableConfig flat;
+    EXPECT_EQ(0u, flat.getTabletCount());
+    uint32_t length = FlatTableConfig::encode(config, &buffer);
+
+    // Truncated entries.
+    EXPECT_FALSE(flat.parse(&buffer, 0, 4));
+    EXPECT_FALSE(flat.parse(&buffer, 0,
+            downCast<uint32_t>(sizeof(FlatTableConfig::Header) +
+                               sizeof(FlatTableConfig::TabletEntry))));
+
+    // Truncated string area.
+    EXPECT_FALSE(flat.parse(&buffer, 0, length - 1));
+    EXPECT_EQ(0u, flat.getTabletCount());
+
+    // Beyond the end of the buffer.
+    EXPECT_FALSE(flat.parse(&buffer, 1, length));
+    EXPECT_TRUE(flat.parse(&buffer, 0, length));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,135 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <zlib.h>
+
+#include "Crc32C.h"
+#include "FrameCompression.h"
+
+namespace RAMCloud {
+
+/**
+ * Compress the data of a closed replica.
+ *
+ * \param source
+ *      Replica data to compress.
+ * \param length
+ *      Bytes of valid data at \a source.
+ * \param destination
+ *      Where the compressed replica (header included) is written.
+ * \param capacity
+ *      Bytes available at \a destination.
+ * \return
+ *      The number of bytes of \a destination that must be stored, or 0 if
+ *      compression wouldn't make the replica any smaller (in which case the
+ *      caller should store \a source as is).
+ */
+size_t
+FrameCompression::compress(const void* source, size_t length,
+                           void* destination, size_t capacity)
+{
+    if (capacity <= sizeof(Header) || length == 0)
+        return 0;
+    Header* header = static_cast<Header*>(destination);
+    uLongf compressedLength = capacity - sizeof(Header);
+    int r = compress2(reinterpret_cast<Bytef*>(header + 1), &compressedLength,
+                      static_cast<const Bytef*>(source), length,
+                      Z_BEST_SPEED);
+    if (r != Z_OK || sizeof(Header) + compressedLength >= length)
+        return 0;
+
+    header->magic = MAGIC;
+    header->compressedLength = downCast<uint32_t>(compressedLength);
+    header->uncompressedLength = downCast<uint32_t>(length);
+    header->checksum = header->computeChecksum();
+    return sizeof(Header) + compressedLength;
+}
+
+/**
+ * Return true if \a frame points to a replica produced by compress() rather
+ * than to raw segment data.
+ */
+bool
+FrameCompression::isCompressed(const void* frame)
+{
+    const Header* header = static_cast<const Header*>(frame);
+    return header->magic == MAGIC &&
+           header->checksum == header->computeChecksum();
+}
+
+/**
+ * Return the number of bytes a compressed replica occupies on storage,
+ * header included. Only valid if isCompressed(\a frame) is true.
+ */
+size_t
+FrameCompression::storedLength(const void* frame)
+{
+    const Header* header = static_cast<const Header*>(frame);
+    return sizeof(Header) + header->compressedLength;
+}
+
+/**
+ * Expand a replica produced by compress(). Bytes of \a destination beyond
+ * the original replica length are left untouched; as with an uncompressed
+ * frame, the segment certificate says how much of the replica is valid.
+ *
+ * \param frame
+ *      Compressed replica, for which isCompressed() must be true.
+ * \param frameLength
+ *      Bytes of valid data at \a frame; bounds how far the header may
+ *      claim the compressed data extends.
+ * \param destination
+ *      Where the original replica data is written.
+ * \param capacity
+ *      Bytes available at \a destination.
+ * \throw FrameCompressionException
+ *      The replica is damaged or doesn't fit in \a capacity bytes.
+ */
+void
+FrameCompression::decompress(const void* frame, size_t frameLength,
+                             void* destination, size_t capacity)
+{
+    const Header* header = static_cast<const Header*>(frame);
+    if (storedLength(frame) > frameLength ||
+        header->uncompressedLength > capacity) {
+        throw FrameCompressionException(HERE,
+            format("compressed replica claims %u bytes expanding to %u, "
+                   "but only %lu bytes were stored and %lu fit in a segment",
+                   header->compressedLength, header->uncompressedLength,
+                   frameLength, capacity));
+    }
+
+    uLongf length = capacity;
+    int r = uncompress(static_cast<Bytef*>(destination), &length,
+                       reinterpret_cast<const Bytef*>(header + 1),
+                       header->compressedLength);
+    if (r != Z_OK || length != header->uncompressedLength) {
+        throw FrameCompressionException(HERE,
+            format("failed to decompress replica: zlib error %d, expanded "
+                   "to %lu of %u bytes", r, length,
+                   header->uncompressedLength));
+    }
+}
+
+/// Checksum of the fields of the header that precede #checksum.
+uint32_t
+FrameCompression::Header::computeChecksum() const
+{
+    Crc32C crc;
+    crc.update(this, downCast<uint32_t>(offsetof(Header, checksum)));
+    return crc.getResult();
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,87 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_FRAMECOMPRESSION_H
+#define RAMCLOUD_FRAMECOMPRESSION_H
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * Thrown by FrameCompression::decompress() if a compressed replica is
+ * damaged.
+ */
+struct FrameCompressionException : public Exception {
+    FrameCompressionException(const CodeLocation& where, std::string msg)
+        : Exception(where, msg) {}
+};
+
+/**
+ * Converts closed replicas to and from the compressed form backups may keep
+ * them in on storage. A compressed replica starts with a small header whose
+ * first byte can never begin a valid segment (every segment starts with a
+ * SegmentHeader entry), so isCompressed() can tell the two forms apart
+ * without any help from the replica's metadata; this lets compressed and
+ * uncompressed replicas coexist in the same storage, including across
+ * restarts and changes of configuration. BulkLoader uses the same format
+ * for the segments it sends, when asked to compress them.
+ *
+ * All the functions are static. This class cannot be instantiated.
+ */
+class FrameCompression {
+  PUBLIC:
+    static size_t compress(const void* source, size_t length,
+                           void* destination, size_t capacity);
+    static bool isCompressed(const void* frame);
+    static size_t storedLength(const void* frame);
+    static void decompress(const void* frame, size_t frameLength,
+                           void* destination, size_t capacity);
+
+    /// Smallest possible compressed replica: isCompressed() reads this many
+    /// bytes of its argument.
+    static size_t headerLength() { return sizeof(Header); }
+
+  PRIVATE:
+    /**
+     * Placed at the start of each compressed replica.
+     */
+    struct Header {
+        /// Always #MAGIC; the low byte is not a valid log entry header.
+        uint32_t magic;
+
+        /// Bytes of compressed data following this header.
+        uint32_t compressedLength;
+
+        /// Bytes of replica data the compressed data expands to.
+        uint32_t uncompressedLength;
+
+        /// Crc32C of the fields above; guards against chance matches.
+        uint32_t checksum;
+
+        uint32_t computeChecksum() const;
+    } __attribute__((packed));
+    static_assert(sizeof(Header) == 16, "FrameCompression::Header changed");
+
+    /// '?' is log entry type 63 with a one-byte length, which is unused.
+    static const uint32_t MAGIC = 0x7a4c463f;
+
+    // Disallow construction.
+    FrameCompression() {}
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_FRAMECOMPRESSION_H
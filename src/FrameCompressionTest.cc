@@ -0,0 +1,111 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "FrameCompression.h"
+#include "LogMetadata.h"
+#include "Segment.h"
+
+namespace RAMCloud {
+
+struct FrameCompressionTest : public ::testing::Test {
+    std::string replica;
+    std::string compressed;
+
+    FrameCompressionTest()
+        : replica()
+        , compressed(8192, '\0')
+    {
+        for (int i = 0; i < 100; i++)
+            replica += "{\"name\": \"value\", \"count\": 12345}";
+    }
+
+    size_t
+    compress()
+    {
+        return FrameCompression::compress(replica.c_str(), replica.size(),
+                                          &compressed[0], compressed.size());
+    }
+};
+
+TEST_F(FrameCompressionTest, compress) {
+    size_t length = compress();
+    EXPECT_LT(0lu, length);
+    EXPECT_GT(replica.size() / 4, length);
+    EXPECT_TRUE(FrameCompression::isCompressed(compressed.c_str()));
+    EXPECT_EQ(length, FrameCompression::storedLength(compressed.c_str()));
+}
+
+TEST_F(FrameCompressionTest, compress_notWorthIt) {
+    std::string random(1000, '\0');
+    for (size_t i = 0; i < random.size(); i++)
+        random[i] = static_cast<char>(generateRandom());
+    EXPECT_EQ(0lu, FrameCompression::compress(random.c_str(), random.size(),
+                                              &compressed[0],
+                                              compressed.size()));
+    EXPECT_EQ(0lu, FrameCompression::compress(replica.c_str(), 0,
+                                              &compressed[0],
+                                              compressed.size()));
+}
+
+TEST_F(FrameCompressionTest, isCompressed) {
+    EXPECT_FALSE(FrameCompression::isCompressed(replica.c_str()));
+
+    // A real segment never looks compressed.
+    Segment segment;
+    SegmentHeader header(1, 2, 1000);
+    segment.append(LOG_ENTRY_TYPE_SEGHEADER, &header, sizeof(header));
+    Buffer buffer;
+    segment.appendToBuffer(buffer);
+    EXPECT_FALSE(FrameCompression::isCompressed(
+            buffer.getRange(0, buffer.size())));
+
+    compress();
+    EXPECT_TRUE(FrameCompression::isCompressed(compressed.c_str()));
+    compressed[5]++;
+    EXPECT_FALSE(FrameCompression::isCompressed(compressed.c_str()));
+}
+
+TEST_F(FrameCompressionTest, decompress) {
+    size_t length = compress();
+    std::string expanded(replica.size() + 10, '*');
+    FrameCompression::decompress(compressed.c_str(), length,
+                                 &expanded[0], expanded.size());
+    EXPECT_EQ(replica, expanded.substr(0, replica.size()));
+    EXPECT_EQ("**********", expanded.substr(replica.size()));
+}
+
+TEST_F(FrameCompressionTest, decompress_truncated) {
+    size_t length = compress();
+    std::string expanded(replica.size(), '\0');
+    EXPECT_THROW(FrameCompression::decompress(compressed.c_str(), length - 1,
+                                              &expanded[0], expanded.size()),
+                 FrameCompressionException);
+    EXPECT_THROW(FrameCompression::decompress(compressed.c_str(), length,
+                                              &expanded[0],
+                                              expanded.size() - 1),
+                 FrameCompressionException);
+}
+
+TEST_F(FrameCompressionTest, decompress_corrupt) {
+    size_t length = compress();
+    compressed[length - 3]++;
+    std::string expanded(replica.size(), '\0');
+    EXPECT_THROW(FrameCompression::decompress(compressed.c_str(), length,
+                                              &expanded[0], expanded.size()),
+                 FrameCompressionException);
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,354 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "ClientException.h"
+#include "Cycles.h"
+#include "Dispatch.h"
+#include "GeoReplicator.h"
+#include "Object.h"
+#include "ObjectFinder.h"
+#include "RamCloud.h"
+#include "ShortMacros.h"
+#include "TableEnumerator.h"
+
+namespace RAMCloud {
+
+// Defined here because replicate() passes it through Tub::construct, which
+// binds it to a reference.
+const uint32_t GeoReplicator::READ_BYTES;
+
+/**
+ * Construct a GeoReplicator. Nothing is replicated until replicate() is
+ * called.
+ *
+ * \param source
+ *      Cluster holding the table to replicate.
+ * \param sourceTableId
+ *      Table to replicate.
+ * \param destination
+ *      Cluster to replicate the table to; usually a different one from
+ *      \a source.
+ * \param destinationTableId
+ *      Table in \a destination that receives the contents of the source
+ *      table. Objects it already holds are kept unless the source table has
+ *      a higher version of them.
+ * \param compress
+ *      True means batches are compressed before they are sent to the
+ *      destination cluster.
+ */
+GeoReplicator::GeoReplicator(RamCloud* source, uint64_t sourceTableId,
+        RamCloud* destination, uint64_t destinationTableId, bool compress)
+    : source(source)
+    , sourceTableId(sourceTableId)
+    , destinationTableId(destinationTableId)
+    , loader(destination, destinationTableId, 4, compress)
+    , streams()
+    , startTime(Cycles::rdtsc())
+    , nextRefresh(0)
+    , metrics()
+{
+}
+
+/**
+ * Destructor for GeoReplicator. Changes that were read but not yet applied
+ * may or may not end up in the destination table.
+ */
+GeoReplicator::~GeoReplicator()
+{
+    for (auto& entry : streams)
+        delete entry.second;
+}
+
+/**
+ * Return counters describing the progress of replication.
+ */
+GeoReplicator::Metrics
+GeoReplicator::getMetrics()
+{
+    uint64_t oldest = ~0UL;
+    for (auto& entry : streams) {
+        Stream* stream = entry.second;
+        oldest = std::min(oldest, stream->replicatedThrough != 0 ?
+                stream->replicatedThrough : startTime);
+    }
+    uint64_t now = Cycles::rdtsc();
+    Metrics result = metrics;
+    result.lagSeconds = streams.empty() ? Cycles::toSeconds(now - startTime)
+                                        : Cycles::toSeconds(now - oldest);
+    result.masters = downCast<uint32_t>(streams.size());
+    result.bytesLoaded = loader.getLoadedBytes();
+    result.bytesSent = loader.getSentBytes();
+    return result;
+}
+
+/**
+ * Ship the changes made to the source table since the last call to the
+ * destination table, and wait until they have been applied there. This
+ * reads the logs of all of the source masters in parallel, but bounds the
+ * amount read from each one, so a busy table may take several calls to
+ * catch up.
+ *
+ * \return
+ *      True if every change durable in the source cluster when this method
+ *      was called has been applied to the destination table.
+ *
+ * \throw TableDoesntExistException
+ *      The source table doesn't exist.
+ * \throw ClientException
+ *      The destination cluster refused the changes.
+ */
+bool
+GeoReplicator::replicate()
+{
+    if (Cycles::rdtsc() >= nextRefresh)
+        refreshStreams();
+
+    foreach (auto& entry, streams) {
+        Stream* stream = entry.second;
+        try {
+            if (!stream->positioned)
+                startStream(stream);
+            copyTablets(stream);
+        } catch (ServerNotUpException& e) {
+            stream->failed = true;
+        }
+        stream->caughtUp = false;
+        stream->bytesThisPass = 0;
+    }
+
+    // Keep one READ_LOG_CHANGES outstanding to each master until it has
+    // caught up, lost changes, or used up its share of this pass.
+    bool isDispatchThread = source->clientContext->dispatch->isDispatchThread();
+    while (true) {
+        bool allDone = true;
+        foreach (auto& entry, streams) {
+            Stream* stream = entry.second;
+            if (stream->failed || stream->caughtUp || !stream->positioned ||
+                    stream->bytesThisPass >= MAX_BYTES_PER_PASS) {
+                continue;
+            }
+            allDone = false;
+            if (stream->rpc) {
+                if (!stream->rpc->isReady())
+                    continue;
+                readChanges(stream);
+                continue;
+            }
+            stream->rpcStartTime = Cycles::rdtsc();
+            stream->rpc.construct(source->clientContext, stream->masterId,
+                    sourceTableId, stream->position, READ_BYTES,
+                    &stream->changes);
+        }
+        if (allDone)
+            break;
+        if (isDispatchThread)
+            source->clientContext->dispatch->poll();
+    }
+
+    loader.flush();
+
+    bool caughtUp = true;
+    for (auto it = streams.begin(); it != streams.end(); ) {
+        Stream* stream = it->second;
+        if (stream->caughtUp)
+            stream->replicatedThrough = stream->rpcStartTime;
+        else
+            caughtUp = false;
+        if (stream->failed || (stream->retired && stream->caughtUp)) {
+            if (stream->failed) {
+                // The master's tablets are being recovered elsewhere; the
+                // masters that get them will copy them.
+                LOG(NOTICE, "Stopped following master %s: it crashed",
+                        stream->masterId.toString().c_str());
+                nextRefresh = 0;
+                caughtUp = false;
+            }
+            delete stream;
+            it = streams.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    return caughtUp;
+}
+
+/**
+ * Add one entry from a source log to the destination table.
+ *
+ * \param type
+ *      LOG_ENTRY_TYPE_OBJ, LOG_ENTRY_TYPE_OBJTOMB or LOG_ENTRY_TYPE_OBJDELTA.
+ * \param entry
+ *      The entry, as stored in the source log.
+ */
+void
+GeoReplicator::apply(LogEntryType type, Buffer& entry)
+{
+    if (sourceTableId == destinationTableId) {
+        loader.addEntry(type, entry);
+        return;
+    }
+    Buffer converted;
+    if (type == LOG_ENTRY_TYPE_OBJ) {
+        Object object(entry);
+        object.changeTableId(destinationTableId);
+        object.assembleForLog(converted);
+    } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
+        ObjectTombstone tombstone(entry);
+        tombstone.changeTableId(destinationTableId);
+        tombstone.assembleForLog(converted);
+    } else {
+        ObjectDelta delta(entry);
+        delta.changeTableId(destinationTableId);
+        delta.assembleForLog(converted);
+    }
+    loader.addEntry(type, converted);
+}
+
+/**
+ * Copy every tablet of a stream that hasn't been copied since the stream's
+ * position was taken, by enumerating it.
+ */
+void
+GeoReplicator::copyTablets(Stream* stream)
+{
+    for (auto& tablet : stream->tablets) {
+        if (stream->copiedTablets.count(tablet.first))
+            continue;
+        TableEnumerator enumerator(*source, TableEnumerator::Cursor(
+                sourceTableId, tablet.first, tablet.second), false);
+        while (enumerator.hasNext()) {
+            uint32_t size;
+            const void* object;
+            enumerator.next(&size, &object);
+            Buffer buffer;
+            buffer.appendExternal(object, size);
+            apply(LOG_ENTRY_TYPE_OBJ, buffer);
+            metrics.objectsCopied++;
+        }
+        stream->copiedTablets.insert(tablet.first);
+    }
+}
+
+/**
+ * Collect the result of a stream's READ_LOG_CHANGES and apply the changes
+ * it returned.
+ */
+void
+GeoReplicator::readChanges(Stream* stream)
+{
+    typedef WireFormat::ReadLogChanges::Change Change;
+
+    LogPosition previous = stream->position;
+    bool lost;
+    try {
+        lost = !stream->rpc->wait(&stream->position);
+    } catch (ServerNotUpException& e) {
+        stream->rpc.destroy();
+        stream->failed = true;
+        return;
+    }
+    stream->rpc.destroy();
+    if (lost) {
+        LOG(WARNING, "Changes to table %lu on master %s were lost before "
+                "they could be replicated; copying its tablets again",
+                sourceTableId, stream->masterId.toString().c_str());
+        metrics.resyncs++;
+        stream->positioned = false;
+        stream->replicatedThrough = 0;
+        return;
+    }
+
+    uint32_t length = stream->changes.size();
+    if (length == 0 && stream->position == previous) {
+        stream->caughtUp = true;
+        return;
+    }
+    uint32_t offset = 0;
+    while (offset < length) {
+        const Change* change = stream->changes.getOffset<Change>(offset);
+        offset += sizeof32(Change);
+        Buffer entry;
+        entry.append(&stream->changes, offset, change->length);
+        apply(static_cast<LogEntryType>(change->type), entry);
+        offset += change->length;
+        metrics.changesRead++;
+    }
+    metrics.changeBytesRead += length;
+    stream->bytesThisPass += length;
+}
+
+/**
+ * Bring #streams in line with the current tablet map of the source table:
+ * add a stream for each new master, and note which tablets each master now
+ * owns.
+ */
+void
+GeoReplicator::refreshStreams()
+{
+    ObjectFinder* finder = source->clientContext->objectFinder;
+    finder->flush(sourceTableId);
+    std::map<uint64_t, std::map<uint64_t, uint64_t>> owners;
+    uint64_t keyHash = 0;
+    while (true) {
+        Tablet tablet = finder->lookupTablet(sourceTableId, keyHash)->tablet;
+        owners[tablet.serverId.getId()][tablet.startKeyHash] =
+                tablet.endKeyHash;
+        if (tablet.endKeyHash == ~0UL)
+            break;
+        keyHash = tablet.endKeyHash + 1;
+    }
+
+    for (auto& entry : streams) {
+        if (!owners.count(entry.first)) {
+            entry.second->retired = true;
+            entry.second->tablets.clear();
+        }
+    }
+    for (auto& owner : owners) {
+        Stream*& stream = streams[owner.first];
+        if (stream == NULL)
+            stream = new Stream(ServerId(owner.first));
+        stream->retired = false;
+        stream->tablets = owner.second;
+
+        // A tablet that leaves and comes back has to be copied again.
+        for (auto it = stream->copiedTablets.begin();
+                it != stream->copiedTablets.end(); ) {
+            if (stream->tablets.count(*it))
+                ++it;
+            else
+                it = stream->copiedTablets.erase(it);
+        }
+    }
+    nextRefresh = Cycles::rdtsc() +
+            Cycles::fromNanoseconds(REFRESH_INTERVAL_MS * 1000000UL);
+}
+
+/**
+ * Start (or restart) following a master's log from its current head. All
+ * of its tablets are copied again afterwards, since changes made before
+ * the new position will not be read.
+ */
+void
+GeoReplicator::startStream(Stream* stream)
+{
+    stream->position = MasterClient::getHeadOfLog(source->clientContext,
+            stream->masterId);
+    stream->positioned = true;
+    stream->copiedTablets.clear();
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,218 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_GEOREPLICATOR_H
+#define RAMCLOUD_GEOREPLICATOR_H
+
+#include <map>
+#include <set>
+
+#include "BulkLoader.h"
+#include "LogMetadata.h"
+#include "MasterClient.h"
+#include "ServerId.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+class RamCloud;
+
+/**
+ * Keeps a table in another RAMCloud cluster (typically in another
+ * datacenter) up to date with a table in this one, asynchronously. The
+ * source cluster's write path is untouched: this class follows the logs
+ * of the masters that own the source table with READ_LOG_CHANGES, and
+ * applies the objects, tombstones and object deltas it finds to the
+ * destination table with compressed BULK_LOAD segments (see BulkLoader).
+ *
+ * Each source master is followed separately, from a LogPosition taken when
+ * the replicator first sees the master. Its tablets are then copied once
+ * with a table enumeration, and from there on only changes are shipped.
+ * Entries are applied as during recovery: the highest version of each key
+ * wins, so the copy and the changes may overlap, batches may be resent, and
+ * tablets may move in either cluster.
+ *
+ * If a source master's cleaner drops changes before they were read (see
+ * MasterClient::readLogChanges) or the master crashes, its tablets are
+ * copied again from a new position. Objects deleted during such a gap are
+ * not deleted in the destination table; #Metrics::resyncs counts the gaps.
+ *
+ * The destination only receives entries that are durable in the source
+ * cluster, and it is consistent per key but not across keys. Secondary
+ * indexes of the destination table are not updated.
+ *
+ * Like RamCloud, this class is not thread-safe; the caller invokes
+ * replicate() in a loop, typically in a dedicated process.
+ */
+class GeoReplicator {
+  PUBLIC:
+    /**
+     * Describes the progress of replication; see getMetrics().
+     */
+    struct Metrics {
+        /// Every change made to the source table more than this many
+        /// seconds ago has been applied to the destination table.
+        double lagSeconds;
+
+        /// Number of source masters being followed.
+        uint32_t masters;
+
+        /// Objects, tombstones and object deltas read from source logs.
+        uint64_t changesRead;
+
+        /// Bytes of log entries read from source logs.
+        uint64_t changeBytesRead;
+
+        /// Objects copied by full copies of tablets.
+        uint64_t objectsCopied;
+
+        /// Bytes of log entries applied to the destination table.
+        uint64_t bytesLoaded;
+
+        /// Bytes sent to the destination cluster for #bytesLoaded; smaller
+        /// when compression pays off.
+        uint64_t bytesSent;
+
+        /// Times a source master's tablets had to be copied again because
+        /// changes were lost.
+        uint64_t resyncs;
+    };
+
+    GeoReplicator(RamCloud* source, uint64_t sourceTableId,
+            RamCloud* destination, uint64_t destinationTableId,
+            bool compress = true);
+    ~GeoReplicator();
+    Metrics getMetrics();
+    bool replicate();
+
+    /// Most bytes of changes requested from a master in one READ_LOG_CHANGES.
+    static const uint32_t READ_BYTES = 1024 * 1024;
+
+    /// Most bytes of changes read from one master in a call to replicate(),
+    /// so that a busy master doesn't hold up the others.
+    static const uint32_t MAX_BYTES_PER_PASS = 16 * READ_BYTES;
+
+    /// The tablet map of the source table is refreshed at most this often.
+    static const uint32_t REFRESH_INTERVAL_MS = 1000;
+
+  PRIVATE:
+    /**
+     * Replication state for one master of the source table.
+     */
+    struct Stream {
+        explicit Stream(ServerId masterId)
+            : masterId(masterId)
+            , position(0, 0)
+            , positioned(false)
+            , tablets()
+            , copiedTablets()
+            , retired(false)
+            , failed(false)
+            , caughtUp(false)
+            , bytesThisPass(0)
+            , rpc()
+            , changes()
+            , rpcStartTime(0)
+            , replicatedThrough(0)
+        {}
+
+        /// The source master whose log is being followed.
+        ServerId masterId;
+
+        /// Where the next READ_LOG_CHANGES continues in the master's log.
+        LogPosition position;
+
+        /// False means #position hasn't been taken yet, or changes were
+        /// lost since it was; the stream has to start over.
+        bool positioned;
+
+        /// Tablets of the source table owned by the master, as a map from
+        /// start key hash to end key hash.
+        std::map<uint64_t, uint64_t> tablets;
+
+        /// Start key hashes of the tablets in #tablets that have been
+        /// copied since #position was taken.
+        std::set<uint64_t> copiedTablets;
+
+        /// True means the master no longer owns any of the source table.
+        /// Its remaining changes are still read, then the stream is deleted.
+        bool retired;
+
+        /// True means the master has crashed; the stream is deleted.
+        bool failed;
+
+        /// True means every change durable when #rpcStartTime was taken has
+        /// been read.
+        bool caughtUp;
+
+        /// Bytes of changes read in the current call to replicate().
+        uint32_t bytesThisPass;
+
+        /// Outstanding READ_LOG_CHANGES, if any.
+        Tub<ReadLogChangesRpc> rpc;
+
+        /// Response of #rpc.
+        Buffer changes;
+
+        /// Cycles::rdtsc() time when #rpc was sent.
+        uint64_t rpcStartTime;
+
+        /// Cycles::rdtsc() time before which all the changes to the
+        /// master's tablets have been applied to the destination, or 0 if
+        /// it hasn't caught up yet.
+        uint64_t replicatedThrough;
+
+        DISALLOW_COPY_AND_ASSIGN(Stream);
+    };
+
+    void apply(LogEntryType type, Buffer& entry);
+    void copyTablets(Stream* stream);
+    void readChanges(Stream* stream);
+    void refreshStreams();
+    void startStream(Stream* stream);
+
+    /// Cluster holding the table that is replicated.
+    RamCloud* source;
+
+    /// Table that is replicated.
+    uint64_t sourceTableId;
+
+    /// Table in the destination cluster that receives the changes.
+    uint64_t destinationTableId;
+
+    /// Sends entries to the masters of the destination table.
+    BulkLoader loader;
+
+    /// One stream for each master that owns (or recently owned) part of the
+    /// source table, keyed by server id.
+    std::map<uint64_t, Stream*> streams;
+
+    /// Cycles::rdtsc() time at which the replicator was created; the lag of
+    /// streams that haven't caught up yet is measured from here.
+    uint64_t startTime;
+
+    /// Cycles::rdtsc() time after which the source tablet map is refreshed.
+    uint64_t nextRefresh;
+
+    /// Counters reported by getMetrics().
+    Metrics metrics;
+
+    DISALLOW_COPY_AND_ASSIGN(GeoReplicator);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_GEOREPLICATOR_H
@@ -0,0 +1,153 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ClientException.h"
+#include "GeoReplicator.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class GeoReplicatorTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    ServerConfig masterConfig;
+    Tub<RamCloud> ramcloud;
+    uint64_t sourceTableId;
+    uint64_t destinationTableId;
+
+    GeoReplicatorTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , masterConfig(ServerConfig::forTesting())
+        , ramcloud()
+        , sourceTableId(-1)
+        , destinationTableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        masterConfig.services = {WireFormat::MASTER_SERVICE,
+                                 WireFormat::ADMIN_SERVICE};
+        masterConfig.master.numReplicas = 0;
+        masterConfig.localLocator = "mock:host=master1";
+        cluster.addServer(masterConfig);
+        ramcloud.construct(&context, "mock:host=coordinator");
+
+        // Both tables live in the same cluster here; the replicator only
+        // sees two RamCloud objects either way.
+        sourceTableId = ramcloud->createTable("source");
+        destinationTableId = ramcloud->createTable("destination");
+    }
+
+    /// Returns the value of an object in the destination table.
+    string
+    read(const char* key)
+    {
+        Buffer value;
+        try {
+            ramcloud->read(destinationTableId, key,
+                    downCast<uint16_t>(strlen(key)), &value);
+        } catch (ObjectDoesntExistException& e) {
+            return "missing";
+        }
+        return TestUtil::toString(&value);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(GeoReplicatorTest);
+};
+
+TEST_F(GeoReplicatorTest, replicate_copyThenChanges) {
+    ramcloud->write(sourceTableId, "object1", 7, "before");
+    GeoReplicator replicator(ramcloud.get(), sourceTableId, ramcloud.get(),
+            destinationTableId);
+    EXPECT_TRUE(replicator.replicate());
+    EXPECT_EQ("before", read("object1"));
+    EXPECT_EQ(1u, replicator.getMetrics().objectsCopied);
+    EXPECT_EQ(1u, replicator.getMetrics().masters);
+
+    ramcloud->write(sourceTableId, "object1", 7, "after");
+    ramcloud->write(sourceTableId, "object2", 7, "value2");
+    ramcloud->write(sourceTableId, "object3", 7, "value3");
+    ramcloud->remove(sourceTableId, "object3", 7);
+    EXPECT_TRUE(replicator.replicate());
+    EXPECT_EQ("after", read("object1"));
+    EXPECT_EQ("value2", read("object2"));
+    EXPECT_EQ("missing", read("object3"));
+
+    GeoReplicator::Metrics metrics = replicator.getMetrics();
+    EXPECT_EQ(4u, metrics.changesRead);
+    EXPECT_EQ(1u, metrics.objectsCopied);
+    EXPECT_EQ(0u, metrics.resyncs);
+    EXPECT_GT(metrics.bytesLoaded, 0u);
+    EXPECT_LT(metrics.lagSeconds, 10.0);
+}
+
+TEST_F(GeoReplicatorTest, replicate_olderChangesIgnored) {
+    // The destination already has a newer version of the object; the copy
+    // must not roll it back.
+    ramcloud->write(sourceTableId, "object1", 7, "source");
+    ramcloud->write(destinationTableId, "object1", 7, "a");
+    ramcloud->write(destinationTableId, "object1", 7, "b");
+    GeoReplicator replicator(ramcloud.get(), sourceTableId, ramcloud.get(),
+            destinationTableId);
+    EXPECT_TRUE(replicator.replicate());
+    EXPECT_EQ("b", read("object1"));
+}
+
+TEST_F(GeoReplicatorTest, replicate_compressed) {
+    GeoReplicator replicator(ramcloud.get(), sourceTableId, ramcloud.get(),
+            destinationTableId, true);
+    EXPECT_TRUE(replicator.replicate());
+    string value(10000, 'x');
+    for (int i = 0; i < 10; i++) {
+        string key = format("object%d", i);
+        ramcloud->write(sourceTableId, key.c_str(),
+                downCast<uint16_t>(key.size()), value.c_str(),
+                downCast<uint32_t>(value.size()));
+    }
+    EXPECT_TRUE(replicator.replicate());
+    Buffer buffer;
+    ramcloud->read(destinationTableId, "object9", 7, &buffer);
+    EXPECT_EQ(value, TestUtil::toString(&buffer));
+    GeoReplicator::Metrics metrics = replicator.getMetrics();
+    EXPECT_LT(metrics.bytesSent * 10, metrics.bytesLoaded);
+}
+
+TEST_F(GeoReplicatorTest, replicate_tabletMoves) {
+    GeoReplicator replicator(ramcloud.get(), sourceTableId, ramcloud.get(),
+            destinationTableId);
+    EXPECT_TRUE(replicator.replicate());
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+    ramcloud->write(sourceTableId, "object1", 7, "value1");
+    ramcloud->migrateTablet(sourceTableId, 0, ~0UL, master2->serverId);
+    ramcloud->write(sourceTableId, "object2", 7, "value2");
+
+    // The first master is followed until its remaining changes have been
+    // read, and the new one copies the tablet it received.
+    replicator.nextRefresh = 0;
+    EXPECT_TRUE(replicator.replicate());
+    EXPECT_EQ(1u, replicator.getMetrics().masters);
+    EXPECT_EQ("value1", read("object1"));
+    EXPECT_EQ("value2", read("object2"));
+}
+
+}  // namespace RAMCloud
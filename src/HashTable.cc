@@ -13,11 +13,42 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <immintrin.h>
+
 #include "Common.h"
 #include "HashTable.h"
 
 namespace RAMCloud {
 
+namespace {
+/// Entry bits that must equal the secondary hash (shifted into place) with
+/// the chain bit clear for the entry to be a candidate.
+const uint64_t HASH_AND_CHAIN_MASK = 0xffff800000000000UL;
+
+/// Entry bits holding the reference; all zero for an empty entry.
+const uint64_t REFERENCE_MASK = 0x00007fffffffffffUL;
+
+bool
+haveSse41()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+bool
+haveAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+} // anonymous namespace
+
+// Start out with the portable version so that lookups during static
+// initialization are safe, then switch to the fastest supported one.
+HashTable::MatchFunction HashTable::findMatches = HashTable::findMatchesScalar;
+static HashTable::MatchImplementation initialMatchImplementation =
+    HashTable::setMatchImplementation(HashTable::MATCH_BEST_AVAILABLE);
+
 /**
  * Reinitialize a hash table entry as unused.
  */
@@ -148,13 +179,147 @@ HashTable::Entry::pack(uint64_t hash, bool chain, uint64_t ptr)
     this->value = ((hash << 48) | (c << 47) | ptr);
 }
 
+/**
+ * Scan a cache line for references with a given secondary hash, one entry
+ * at a time. This is the fallback for processors without SSE 4.1 and the
+ * reference the vector versions are tested against.
+ * \param cl
+ *      The cache line to scan.
+ * \param secondaryHash
+ *      The secondary hash bits (16 bits) computed from the key.
+ * \return
+ *      A bit mask in which bit i is set if entry i of \a cl holds a
+ *      reference whose secondary hash is \a secondaryHash.
+ */
+uint32_t
+HashTable::findMatchesScalar(const CacheLine* cl, uint64_t secondaryHash)
+{
+    uint32_t matches = 0;
+    for (uint32_t i = 0; i < ENTRIES_PER_CACHE_LINE; i++) {
+        if (cl->entries[i].hashMatches(secondaryHash))
+            matches |= 1U << i;
+    }
+    return matches;
+}
+
+/**
+ * SSE 4.1 version of #findMatchesScalar(); compares two entries per
+ * instruction. Only called if the processor supports SSE 4.1.
+ */
+__attribute__((target("sse4.1")))
+uint32_t
+HashTable::findMatchesSse41(const CacheLine* cl, uint64_t secondaryHash)
+{
+    const __m128i* p = reinterpret_cast<const __m128i*>(cl->entries);
+    const __m128i hashMask = _mm_set1_epi64x(
+            static_cast<int64_t>(HASH_AND_CHAIN_MASK));
+    const __m128i referenceMask = _mm_set1_epi64x(
+            static_cast<int64_t>(REFERENCE_MASK));
+    const __m128i expected = _mm_set1_epi64x(
+            static_cast<int64_t>(secondaryHash << 48));
+    const __m128i zero = _mm_setzero_si128();
+
+    uint32_t matches = 0;
+    for (uint32_t i = 0; i < ENTRIES_PER_CACHE_LINE / 2; i++) {
+        __m128i v = _mm_loadu_si128(p + i);
+        __m128i hit = _mm_cmpeq_epi64(_mm_and_si128(v, hashMask), expected);
+        __m128i empty = _mm_cmpeq_epi64(_mm_and_si128(v, referenceMask), zero);
+        int bits = _mm_movemask_pd(_mm_castsi128_pd(
+                _mm_andnot_si128(empty, hit)));
+        matches |= static_cast<uint32_t>(bits) << (2 * i);
+    }
+    return matches;
+}
+
+/**
+ * AVX2 version of #findMatchesScalar(); compares four entries per
+ * instruction, so a whole cache line takes two. Only called if the
+ * processor supports AVX2.
+ */
+__attribute__((target("avx2")))
+uint32_t
+HashTable::findMatchesAvx2(const CacheLine* cl, uint64_t secondaryHash)
+{
+    const __m256i* p = reinterpret_cast<const __m256i*>(cl->entries);
+    const __m256i hashMask = _mm256_set1_epi64x(
+            static_cast<int64_t>(HASH_AND_CHAIN_MASK));
+    const __m256i referenceMask = _mm256_set1_epi64x(
+            static_cast<int64_t>(REFERENCE_MASK));
+    const __m256i expected = _mm256_set1_epi64x(
+            static_cast<int64_t>(secondaryHash << 48));
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i lo = _mm256_loadu_si256(p);
+    __m256i hi = _mm256_loadu_si256(p + 1);
+    __m256i loHit = _mm256_andnot_si256(
+            _mm256_cmpeq_epi64(_mm256_and_si256(lo, referenceMask), zero),
+            _mm256_cmpeq_epi64(_mm256_and_si256(lo, hashMask), expected));
+    __m256i hiHit = _mm256_andnot_si256(
+            _mm256_cmpeq_epi64(_mm256_and_si256(hi, referenceMask), zero),
+            _mm256_cmpeq_epi64(_mm256_and_si256(hi, hashMask), expected));
+    int loBits = _mm256_movemask_pd(_mm256_castsi256_pd(loHit));
+    int hiBits = _mm256_movemask_pd(_mm256_castsi256_pd(hiHit));
+    return static_cast<uint32_t>(loBits) | (static_cast<uint32_t>(hiBits) << 4);
+}
+
+/**
+ * Choose how cache lines are scanned during lookups. This is normally
+ * decided automatically at start up, but benchmarks and tests use it to
+ * compare the implementations.
+ * \param implementation
+ *      The desired implementation. If the processor does not support it,
+ *      the best supported one is used instead.
+ * \return
+ *      The implementation actually in use.
+ */
+HashTable::MatchImplementation
+HashTable::setMatchImplementation(MatchImplementation implementation)
+{
+    if (implementation == MATCH_BEST_AVAILABLE ||
+            (implementation == MATCH_AVX2 && !haveAvx2()) ||
+            (implementation == MATCH_SSE41 && !haveSse41())) {
+        implementation = haveAvx2() ? MATCH_AVX2 :
+                (haveSse41() ? MATCH_SSE41 : MATCH_SCALAR);
+    }
+
+    switch (implementation) {
+    case MATCH_AVX2:
+        findMatches = findMatchesAvx2;
+        break;
+    case MATCH_SSE41:
+        findMatches = findMatchesSse41;
+        break;
+    default:
+        findMatches = findMatchesScalar;
+        implementation = MATCH_SCALAR;
+        break;
+    }
+    return implementation;
+}
+
+/**
+ * Return which implementation is currently used to scan cache lines during
+ * lookups; see #setMatchImplementation().
+ */
+HashTable::MatchImplementation
+HashTable::getMatchImplementation()
+{
+    if (findMatches == findMatchesAvx2)
+        return MATCH_AVX2;
+    if (findMatches == findMatchesSse41)
+        return MATCH_SSE41;
+    return MATCH_SCALAR;
+}
+
 /**
  * Construct an empty set of candidates.
  */
 HashTable::Candidates::Candidates()
-    : bucket(NULL)
+    : hashTable(NULL)
+    , bucket(NULL)
     , index()
     , secondaryHash()
+    , inlineValue(NULL)
 {
 }
 
@@ -164,14 +329,29 @@ HashTable::Candidates::Candidates()
  * given secondaryHash.
  */
 void
-HashTable::Candidates::init(CacheLine* cl, uint64_t secondaryHash)
+HashTable::Candidates::init(HashTable* hashTable, CacheLine* cl,
+                            uint64_t secondaryHash, InlineValue* inlineValue)
 {
+    this->hashTable = hashTable;
     bucket = cl;
     index = -1;
     this->secondaryHash = secondaryHash;
+    this->inlineValue = inlineValue;
     next();
 }
 
+/**
+ * Empty the bucket's InlineValue if it is a copy of the candidate currently
+ * pointed to by the iterator, which is about to change.
+ */
+void
+HashTable::Candidates::invalidateInlineValue()
+{
+    if (inlineValue != NULL &&
+            inlineValue->reference == bucket->entries[index].getReference())
+        inlineValue->reference = 0;
+}
+
 /**
  * Obtain the reference for the candidate currently pointed to by the
  * iterator. If there is no next candidate, 0 is returned.
@@ -191,8 +371,10 @@ HashTable::Candidates::getReference()
 void
 HashTable::Candidates::setReference(uint64_t reference)
 {
-    if (bucket != NULL)
+    if (bucket != NULL) {
+        invalidateInlineValue();
         bucket->entries[index].setReference(secondaryHash, reference);
+    }
 }
 
 /**
@@ -202,8 +384,12 @@ HashTable::Candidates::setReference(uint64_t reference)
 void
 HashTable::Candidates::remove()
 {
-    if (bucket != NULL)
+    if (bucket != NULL) {
+        invalidateInlineValue();
         bucket->entries[index].clear();
+        if (hashTable != NULL)
+            hashTable->numEntries--;
+    }
 }
 
 /**
@@ -224,21 +410,20 @@ HashTable::Candidates::next()
         if (bucket == NULL)
             return;
 
-        // Resume in the current cache line.
+        // Resume in the current cache line, just past the last candidate.
         index++;
-        Entry* candidate = &bucket->entries[index];
-        while (index < ENTRIES_PER_CACHE_LINE) {
-            if (candidate->hashMatches(secondaryHash)) {
-                // The hash within the hash table entry matches, so with
-                // high probability this is the pointer we're looking
-                // for. We'll report this index to the user of this
-                // class in the next getReference() call so that they
-                // can verify the match.
-                return;
-            }
-            candidate++;
-            index++;
+        uint32_t matches = findMatches(bucket, secondaryHash) &
+                           ~((1U << index) - 1);
+        if (matches != 0) {
+            // The hash within the hash table entry matches, so with
+            // high probability this is the pointer we're looking
+            // for. We'll report this index to the user of this
+            // class in the next getReference() call so that they
+            // can verify the match.
+            index = static_cast<uint32_t>(__builtin_ctz(matches));
+            return;
         }
+        index = ENTRIES_PER_CACHE_LINE;
     }
 }
 
@@ -257,12 +442,31 @@ HashTable::Candidates::isDone()
  * \param[in] numBuckets
  *      The number of buckets in the new hash table. This should be a power
  *      of two.
+ * \param[in] maxNumBuckets
+ *      The largest number of buckets the table may grow to (see
+ *      #startResize()). Rounded down to a power of two. 0, or any value not
+ *      larger than numBuckets, means the table never grows.
+ * \param[in] inlineValues
+ *      If true, the table keeps an InlineValue next to each bucket (see
+ *      #findInlineValue()). This costs another cache line of memory per
+ *      bucket.
  * \throw Exception
  *      An exception is thrown if numBuckets is 0.
  */
-HashTable::HashTable(uint64_t numBuckets)
+HashTable::HashTable(uint64_t numBuckets, uint64_t maxNumBuckets,
+                     bool inlineValues)
     : numBuckets(BitOps::powerOfTwoLessOrEqual(numBuckets))
+    , initialNumBuckets(this->numBuckets)
+    , maxNumBuckets(maxNumBuckets <= this->numBuckets ? this->numBuckets :
+                    BitOps::powerOfTwoLessOrEqual(maxNumBuckets))
     , buckets(this->numBuckets * sizeof(CacheLine))
+    , inlineValues()
+    , resizeBuckets()
+    , resizeInlineValues()
+    , nextBucketToMigrate(0)
+    , retiredBuckets()
+    , retiredNumBuckets(0)
+    , numEntries(0)
 {
     if (numBuckets != this->numBuckets) {
         RAMCLOUD_LOG(DEBUG,
@@ -273,17 +477,41 @@ HashTable::HashTable(uint64_t numBuckets)
 
     if (numBuckets == 0)
         throw Exception(HERE, "HashTable numBuckets == 0?!");
+
+    if (inlineValues) {
+        this->inlineValues.reset(new LargeBlockOfMemory<InlineValue>(
+                this->numBuckets * sizeof(InlineValue)));
+    }
 }
 
 /**
  * Destructor for HashTable.
  */
 HashTable::~HashTable()
+{
+    freeOverflowLines(buckets.get(), numBuckets);
+    if (resizeBuckets)
+        freeOverflowLines(resizeBuckets->get(), 2 * numBuckets);
+    if (retiredBuckets)
+        freeOverflowLines(retiredBuckets->get(), retiredNumBuckets);
+}
+
+/**
+ * Free all overflow cache lines chained onto the buckets of an array and
+ * break the chains. The array itself is not freed.
+ *
+ * \param bucketArray
+ *      The first bucket of the array.
+ * \param count
+ *      Number of buckets in the array.
+ */
+void
+HashTable::freeOverflowLines(CacheLine* bucketArray, uint64_t count)
 {
     uint32_t lastEntryIndex = ENTRIES_PER_CACHE_LINE - 1;
 
-    for (uint64_t i = 0; i < numBuckets; ++i) {
-        CacheLine* currBucket = &buckets.get()[i];
+    for (uint64_t i = 0; i < count; ++i) {
+        CacheLine* currBucket = &bucketArray[i];
 
         // Skip the first bucket and break the chain
         Entry* last = &currBucket->entries[lastEntryIndex];
@@ -320,7 +548,7 @@ HashTable::lookup(KeyHash keyHash, Candidates& candidates)
     // caller as it examines possible candidates.
     uint64_t secondaryHash;
     CacheLine *bucket = findBucket(keyHash, &secondaryHash);
-    candidates.init(bucket, secondaryHash);
+    candidates.init(this, bucket, secondaryHash, findInlineValue(keyHash));
 }
 
 /**
@@ -339,8 +567,31 @@ void
 HashTable::insert(KeyHash keyHash, uint64_t reference)
 {
     uint64_t secondaryHash;
-    int overflowBuckets = 0;
     CacheLine* bucket = findBucket(keyHash, &secondaryHash);
+    insertInBucket(bucket,
+                   findBucketIndex(numBuckets, keyHash, &secondaryHash),
+                   secondaryHash, reference);
+    numEntries++;
+}
+
+/**
+ * Helper for #insert() and #migrateBucket(): place a reference in the first
+ * free entry of a bucket, allocating an overflow cache line if needed.
+ *
+ * \param bucket
+ *      The first cache line of the bucket to insert into.
+ * \param bucketIndex
+ *      Index of the bucket; only used for logging.
+ * \param secondaryHash
+ *      The secondary hash bits (16 bits) of the key.
+ * \param reference
+ *      Reference to the new element to insert into the hash table.
+ */
+void
+HashTable::insertInBucket(CacheLine* bucket, uint64_t bucketIndex,
+                          uint64_t secondaryHash, uint64_t reference)
+{
+    int overflowBuckets = 0;
     while (true) {
         Entry* entry = bucket->entries;
         for (size_t i = 0; i < ENTRIES_PER_CACHE_LINE; i++) {
@@ -359,8 +610,7 @@ HashTable::insert(KeyHash keyHash, uint64_t reference)
         if (bucket == NULL) {
             // no empty space found, allocate a new cache line
             RAMCLOUD_CLOG(NOTICE, "Allocating overflow bucket %d for index %lu",
-                    overflowBuckets,
-                    findBucketIndex(numBuckets, keyHash, &secondaryHash));
+                    overflowBuckets, bucketIndex);
             void *buf = Memory::xmemalign(HERE, sizeof(CacheLine),
                                           sizeof(CacheLine));
             bucket = static_cast<CacheLine *>(buf);
@@ -389,9 +639,36 @@ uint64_t
 HashTable::forEachInBucket(void (*callback)(uint64_t, void *),
                            void *cookie,
                            uint64_t bucket)
+{
+    if (bucket < nextBucketToMigrate) {
+        // This bucket has already been split into two buckets of the
+        // array being resized into.
+        CacheLine* newBuckets = resizeBuckets->get();
+        return forEachInChain(&newBuckets[bucket], callback, cookie) +
+               forEachInChain(&newBuckets[bucket + numBuckets], callback,
+                              cookie);
+    }
+    return forEachInChain(&buckets.get()[bucket], callback, cookie);
+}
+
+/**
+ * Apply the given callback function to each element stored in one chain
+ * of cache lines.
+ * \param cl
+ *      The first cache line of the chain.
+ * \param callback
+ *      The callback to fire on each element stored in the chain.
+ * \param cookie
+ *      An opaque parameter to pass to the callback function.
+ * \return
+ *      The total number of callbacks fired.
+ */
+uint64_t
+HashTable::forEachInChain(CacheLine* cl,
+                          void (*callback)(uint64_t, void *),
+                          void *cookie)
 {
     uint64_t numCalls = 0;
-    CacheLine *cl = &buckets.get()[bucket];
     while (1) {
         for (uint32_t j = 0; j < ENTRIES_PER_CACHE_LINE; j++) {
             Entry *e = &cl->entries[j];
@@ -441,6 +718,60 @@ HashTable::prefetchBucket(KeyHash keyHash)
     prefetch(findBucket(keyHash, &dummy));
 }
 
+/**
+ * Returns true if the table keeps an InlineValue next to each bucket.
+ */
+bool
+HashTable::hasInlineValues() const
+{
+    return static_cast<bool>(inlineValues);
+}
+
+/**
+ * Find the InlineValue kept next to the bucket of a given key. The caller
+ * may read it or fill it in with a copy of an object in the bucket, subject
+ * to the same locking as the bucket itself; whatever it holds is only valid
+ * if InlineValue::matches() the key.
+ *
+ * \param keyHash
+ *      Hash of the key whose bucket to use.
+ * \return
+ *      The InlineValue, or NULL if the table doesn't keep them.
+ */
+HashTable::InlineValue*
+HashTable::findInlineValue(KeyHash keyHash)
+{
+    if (!inlineValues)
+        return NULL;
+    uint64_t secondaryHash;
+    uint64_t bucketIndex = findBucketIndex(numBuckets, keyHash,
+                                           &secondaryHash);
+    if (bucketIndex < nextBucketToMigrate) {
+        bucketIndex = findBucketIndex(2 * numBuckets, keyHash,
+                                      &secondaryHash);
+        return &resizeInlineValues->get()[bucketIndex];
+    }
+    return &inlineValues->get()[bucketIndex];
+}
+
+/**
+ * Empty the InlineValue next to the bucket of a given key if it is a copy
+ * of a given entry. This must be invoked whenever an object is changed
+ * without replacing its reference in the table.
+ *
+ * \param keyHash
+ *      Hash of the key of the object.
+ * \param reference
+ *      Reference of the object's entry in the table.
+ */
+void
+HashTable::invalidateInlineValue(KeyHash keyHash, uint64_t reference)
+{
+    InlineValue* inlineValue = findInlineValue(keyHash);
+    if (inlineValue != NULL && inlineValue->reference == reference)
+        inlineValue->reference = 0;
+}
+
 /**
  * Return the number of bytes per cache line.
  */
@@ -461,7 +792,8 @@ HashTable::entriesPerCacheLine()
 }
 
 /**
- * Returns the number of buckets allocated to the table.
+ * Returns the number of buckets allocated to the table. While a resize is
+ * in progress this is the size of the table being migrated away from.
  */
 uint64_t
 HashTable::getNumBuckets() const
@@ -469,6 +801,182 @@ HashTable::getNumBuckets() const
     return numBuckets;
 }
 
+/**
+ * Returns the number of buckets the table was constructed with. The bucket
+ * index of any key in a table of this size is a suffix of its index in the
+ * current table, no matter how many times the table has grown.
+ */
+uint64_t
+HashTable::getInitialNumBuckets() const
+{
+    return initialNumBuckets;
+}
+
+/**
+ * Returns the number of references currently stored in the table.
+ */
+uint64_t
+HashTable::getNumEntries() const
+{
+    return numEntries;
+}
+
+/**
+ * Returns true if the table is full enough that it should grow, growth is
+ * allowed, and no resize is currently in progress.
+ */
+bool
+HashTable::needsResize() const
+{
+    return !resizeBuckets && numBuckets < maxNumBuckets &&
+           numEntries > numBuckets * MAX_ENTRIES_PER_BUCKET;
+}
+
+/**
+ * Returns true if #startResize() has been called but #finishResize() has
+ * not.
+ */
+bool
+HashTable::isResizing() const
+{
+    return static_cast<bool>(resizeBuckets);
+}
+
+/**
+ * While a resize is in progress, returns the index of the next bucket
+ * that #migrateBucket() will move. Returns 0 otherwise.
+ */
+uint64_t
+HashTable::getNextBucketToMigrate() const
+{
+    return nextBucketToMigrate;
+}
+
+/**
+ * Begin doubling the size of the table. This allocates the new bucket
+ * array but does not move any entries; lookups and insertions keep using
+ * the old array until each bucket is moved by #migrateBucket().
+ *
+ * Concurrent operations on the table may continue while this runs, but only
+ * one thread may drive a resize at a time. Any array still retired from a
+ * previous resize is released first.
+ */
+void
+HashTable::startResize()
+{
+    assert(!resizeBuckets);
+    assert(nextBucketToMigrate == 0);
+    releaseRetiredBuckets();
+    resizeBuckets.reset(new LargeBlockOfMemory<CacheLine>(
+            2 * numBuckets * sizeof(CacheLine)));
+    if (inlineValues) {
+        resizeInlineValues.reset(new LargeBlockOfMemory<InlineValue>(
+                2 * numBuckets * sizeof(InlineValue)));
+    }
+    RAMCLOUD_LOG(NOTICE, "Growing hash table from %lu to %lu buckets "
+            "(%lu entries)", numBuckets, 2 * numBuckets, getNumEntries());
+}
+
+/**
+ * Move the entries of the next unmigrated bucket (see
+ * #nextBucketToMigrate) into the new bucket array. The caller must hold
+ * whatever lock protects that bucket from concurrent modification. The old
+ * bucket is left intact for the benefit of unlocked readers; it is freed
+ * along with the rest of the old array by #releaseRetiredBuckets().
+ *
+ * \param keyHashFunction
+ *      Invoked to obtain the full key hash of each entry, which determines
+ *      which of the two new buckets it belongs in.
+ * \param cookie
+ *      Opaque parameter passed to keyHashFunction.
+ * \return
+ *      True if every bucket has now been migrated and the caller should
+ *      invoke #finishResize(); false if there is more work to do.
+ */
+bool
+HashTable::migrateBucket(KeyHashFunction keyHashFunction, void* cookie)
+{
+    assert(resizeBuckets);
+    uint64_t index = nextBucketToMigrate;
+    assert(index < numBuckets);
+    CacheLine* newBuckets = resizeBuckets->get();
+    uint64_t newNumBuckets = 2 * numBuckets;
+
+    CacheLine* cl = &buckets.get()[index];
+    while (cl != NULL) {
+        for (uint32_t j = 0; j < ENTRIES_PER_CACHE_LINE; j++) {
+            Entry* e = &cl->entries[j];
+            if (e->isAvailable() || e->getChainPointer() != NULL)
+                continue;
+            uint64_t reference = e->getReference();
+            uint64_t secondaryHash;
+            uint64_t newIndex = findBucketIndex(newNumBuckets,
+                    keyHashFunction(reference, cookie), &secondaryHash);
+            assert(e->hashMatches(secondaryHash));
+            assert((newIndex & (numBuckets - 1)) == index);
+            insertInBucket(&newBuckets[newIndex], newIndex, secondaryHash,
+                           reference);
+        }
+        cl = cl->entries[ENTRIES_PER_CACHE_LINE - 1].getChainPointer();
+    }
+
+    nextBucketToMigrate = index + 1;
+    return nextBucketToMigrate == numBuckets;
+}
+
+/**
+ * Complete a resize once every bucket has been migrated: the new array
+ * becomes the table and the old one is retired (see
+ * #releaseRetiredBuckets()).
+ *
+ * The caller must guarantee that no other thread is performing lookups,
+ * insertions or removals while this runs (ObjectManager, for instance,
+ * holds every bucket lock).
+ */
+void
+HashTable::finishResize()
+{
+    assert(resizeBuckets);
+    assert(nextBucketToMigrate == numBuckets);
+    releaseRetiredBuckets();
+
+    buckets.swap(*resizeBuckets);
+    retiredBuckets = std::move(resizeBuckets);
+    // Inline values are only read with locks held, so the old ones can go
+    // right away.
+    if (inlineValues)
+        inlineValues = std::move(resizeInlineValues);
+    retiredNumBuckets = numBuckets;
+    numBuckets *= 2;
+    nextBucketToMigrate = 0;
+}
+
+/**
+ * Returns true if an old bucket array is waiting to be released by
+ * #releaseRetiredBuckets().
+ */
+bool
+HashTable::hasRetiredBuckets() const
+{
+    return static_cast<bool>(retiredBuckets);
+}
+
+/**
+ * Free the bucket array replaced by the last #finishResize(), if there is
+ * one. The caller must ensure that there are no unlocked readers of the
+ * table that might still be traversing it (e.g. by waiting for all RPCs
+ * that were in progress at the time of the resize to finish).
+ */
+void
+HashTable::releaseRetiredBuckets()
+{
+    if (!retiredBuckets)
+        return;
+    freeOverflowLines(retiredBuckets->get(), retiredNumBuckets);
+    retiredBuckets.reset();
+    retiredNumBuckets = 0;
+}
+
 /**
  * Find the bucket index corresponding to a particular key.
  * This also calculates the secondary hash bits used to disambiguate entries
@@ -512,6 +1020,10 @@ HashTable::CacheLine*
 HashTable::findBucket(KeyHash keyHash, uint64_t *secondaryHash) //const
 {
     uint64_t bucketIndex = findBucketIndex(numBuckets, keyHash, secondaryHash);
+    if (bucketIndex < nextBucketToMigrate) {
+        bucketIndex = findBucketIndex(2 * numBuckets, keyHash, secondaryHash);
+        return &resizeBuckets->get()[bucketIndex];
+    }
     return &buckets.get()[bucketIndex];
 }
 
@@ -16,6 +16,9 @@
 #ifndef RAMCLOUD_HASHTABLE_H
 #define RAMCLOUD_HASHTABLE_H
 
+#include <atomic>
+#include <memory>
+
 #include "Common.h"
 #include "BitOps.h"
 #include "CycleCounter.h"
@@ -39,6 +42,14 @@ namespace RAMCloud {
  *
  * This code is not thread-safe.
  *
+ * The table can optionally grow online (see #startResize()): the bucket array
+ * is doubled and old buckets are migrated into the new array a few at a time,
+ * so no single operation ever has to rebuild the whole table.
+ *
+ * The table can also optionally keep an InlineValue next to each bucket: a
+ * copy of one small object held in that bucket, so that reads of it (hot
+ * counters, for instance) need not touch the log.
+ *
  * \section impl Implementation Details
  *
  * The HashTable is an array of #buckets, indexed by the hash of the two
@@ -169,7 +180,85 @@ class HashTable {
     static_assert(sizeof(CacheLine) == sizeof(Entry) * ENTRIES_PER_CACHE_LINE,
                   "HashTable entries don't fit evenly into a cacheline");
 
+    /**
+     * Signature of the routines that scan a CacheLine for references whose
+     * secondary hash matches. Bit i of the result is set if entry i holds a
+     * reference (not a chain pointer and not empty) with the given secondary
+     * hash.
+     */
+    typedef uint32_t (*MatchFunction)(const CacheLine* cl,
+                                      uint64_t secondaryHash);
+    static uint32_t findMatchesScalar(const CacheLine* cl,
+                                      uint64_t secondaryHash);
+    static uint32_t findMatchesSse41(const CacheLine* cl,
+                                     uint64_t secondaryHash);
+    static uint32_t findMatchesAvx2(const CacheLine* cl,
+                                    uint64_t secondaryHash);
+
+    /**
+     * The routine used to scan cache lines during lookups. Chosen at start
+     * up based on the instruction sets the processor supports; see
+     * #setMatchImplementation().
+     */
+    static MatchFunction findMatches;
+
   public:
+    /**
+     * The longest value an InlineValue can hold.
+     */
+    static const uint32_t MAX_INLINE_VALUE_LENGTH = 8;
+
+    /**
+     * The longest primary key an InlineValue can hold.
+     */
+    static const uint32_t MAX_INLINE_KEY_LENGTH = 30;
+
+    /**
+     * A copy of a small object stored in a bucket, kept on its own cache
+     * line next to the bucket (see #findInlineValue()). The table never
+     * fills these in itself; it only empties one when the entry it was
+     * copied from is replaced or removed through Candidates, or when the
+     * table is resized. The owner of the table must empty it if the object
+     * changes in any other way (see #invalidateInlineValue()).
+     */
+    struct InlineValue {
+        /**
+         * Return whether this holds a copy of the object named by a key.
+         */
+        bool
+        matches(Key& key) const
+        {
+            return reference != 0 && tableId == key.getTableId() &&
+                   keyLength == key.getStringKeyLength() &&
+                   memcmp(this->key, key.getStringKey(), keyLength) == 0;
+        }
+
+        /// Reference of the entry this is a copy of; 0 means the slot is
+        /// empty.
+        uint64_t reference;
+
+        /// Version of the object.
+        uint64_t version;
+
+        /// Table the object belongs to.
+        uint64_t tableId;
+
+        /// The object's value; only the first #valueLength bytes are used.
+        uint8_t value[MAX_INLINE_VALUE_LENGTH];
+
+        /// Length of the object's value.
+        uint8_t valueLength;
+
+        /// Length of the object's primary key.
+        uint8_t keyLength;
+
+        /// The object's primary key; only the first #keyLength bytes are
+        /// used.
+        char key[MAX_INLINE_KEY_LENGTH];
+    };
+    static_assert(sizeof(InlineValue) == BYTES_PER_CACHE_LINE,
+                  "HashTable::InlineValue is not a cache line long");
+
     /**
      * This class is essentially an iterator for potential matches found during
      * a lookup operation. This exists because the HashTable::lookup() method
@@ -200,7 +289,13 @@ class HashTable {
         bool isDone();
 
       PRIVATE:
-        void init(CacheLine* cl, uint64_t secondaryHash);
+        void init(HashTable* hashTable, CacheLine* cl, uint64_t secondaryHash,
+                  InlineValue* inlineValue);
+        void invalidateInlineValue();
+
+        /// The table that produced these candidates. Used to keep its entry
+        /// count up to date when a candidate is removed.
+        HashTable* hashTable;
 
         /// Pointer to the hash table bucket we're currently iterating over.
         CacheLine* bucket;
@@ -214,10 +309,37 @@ class HashTable {
         /// the log and compared.
         uint64_t secondaryHash;
 
+        /// The InlineValue of the bucket, or NULL if the table doesn't keep
+        /// them. It is emptied if the candidate it was copied from changes.
+        InlineValue* inlineValue;
+
         friend class HashTable;
     };
 
-    explicit HashTable(uint64_t numBuckets);
+    /**
+     * Callback used during a resize to recover the full key hash of an entry
+     * from its reference (entries only store 16 bits of the hash).
+     */
+    typedef KeyHash (*KeyHashFunction)(uint64_t reference, void* cookie);
+
+    /**
+     * The ways in which a cache line can be scanned for matching secondary
+     * hashes. The vector versions compare all entries of a cache line at
+     * once and are only used if the processor supports them.
+     */
+    enum MatchImplementation {
+        MATCH_SCALAR,
+        MATCH_SSE41,
+        MATCH_AVX2,
+        MATCH_BEST_AVAILABLE,
+    };
+
+    static MatchImplementation setMatchImplementation(
+                                        MatchImplementation implementation);
+    static MatchImplementation getMatchImplementation();
+
+    explicit HashTable(uint64_t numBuckets, uint64_t maxNumBuckets = 0,
+                       bool inlineValues = false);
     ~HashTable();
     void lookup(KeyHash keyHash, Candidates& candidates);
     void insert(KeyHash keyHash, uint64_t reference);
@@ -226,9 +348,22 @@ class HashTable {
                              uint64_t bucket);
     uint64_t forEach(void (*callback)(uint64_t, void *), void *cookie);
     void prefetchBucket(KeyHash keyHash);
+    bool hasInlineValues() const;
+    InlineValue* findInlineValue(KeyHash keyHash);
+    void invalidateInlineValue(KeyHash keyHash, uint64_t reference);
     static uint32_t bytesPerCacheLine();
     static uint32_t entriesPerCacheLine();
     uint64_t getNumBuckets() const;
+    uint64_t getInitialNumBuckets() const;
+    uint64_t getNumEntries() const;
+    bool needsResize() const;
+    bool isResizing() const;
+    uint64_t getNextBucketToMigrate() const;
+    void startResize();
+    bool migrateBucket(KeyHashFunction keyHashFunction, void* cookie);
+    void finishResize();
+    bool hasRetiredBuckets() const;
+    void releaseRetiredBuckets();
     static uint64_t findBucketIndex(uint64_t numBuckets,
                                     KeyHash keyHash,
                                     uint64_t *secondaryHash);
@@ -240,11 +375,40 @@ class HashTable {
     struct CacheLine;
 
     CacheLine * findBucket(KeyHash keyHash, uint64_t *secondaryHash);
+    static uint64_t forEachInChain(CacheLine* cl,
+                                   void (*callback)(uint64_t, void *),
+                                   void *cookie);
+    static void freeOverflowLines(CacheLine* bucketArray, uint64_t count);
+    void insertInBucket(CacheLine* bucket, uint64_t bucketIndex,
+                        uint64_t secondaryHash, uint64_t reference);
+
+    /**
+     * Growth is triggered once the table holds more than this many entries
+     * per bucket on average. Beyond this point a noticeable fraction of
+     * buckets needs overflow cache lines.
+     */
+    static const uint64_t MAX_ENTRIES_PER_BUCKET = ENTRIES_PER_CACHE_LINE / 2;
 
     /**
-     * The number of buckets allocated to the table.
+     * The number of buckets allocated to the table. While a resize is in
+     * progress this is still the size of the old array (#buckets); bucket
+     * indexes passed to and from this class are always relative to it.
      */
-    const uint64_t numBuckets;
+    uint64_t numBuckets;
+
+    /**
+     * The number of buckets the table was constructed with. Since the table
+     * only ever doubles, the low bits of a key hash that select a bucket in
+     * a table of this size never change, which lets callers stripe locks
+     * across buckets in a way that is stable across resizes.
+     */
+    const uint64_t initialNumBuckets;
+
+    /**
+     * The table will not grow past this many buckets. Equal to
+     * #initialNumBuckets if growth is disabled.
+     */
+    const uint64_t maxNumBuckets;
 
     /**
      * The array of buckets.
@@ -252,6 +416,49 @@ class HashTable {
      */
     LargeBlockOfMemory<CacheLine> buckets;
 
+    /**
+     * If the table keeps inline values, the InlineValue of each bucket in
+     * #buckets. NULL otherwise.
+     */
+    std::unique_ptr<LargeBlockOfMemory<InlineValue>> inlineValues;
+
+    /**
+     * While a resize is in progress, the array of 2 * #numBuckets buckets
+     * that entries are being migrated into. NULL otherwise.
+     */
+    std::unique_ptr<LargeBlockOfMemory<CacheLine>> resizeBuckets;
+
+    /**
+     * While a resize is in progress and the table keeps inline values, the
+     * InlineValue of each bucket in #resizeBuckets. NULL otherwise. Inline
+     * values aren't migrated; the new ones start out empty.
+     */
+    std::unique_ptr<LargeBlockOfMemory<InlineValue>> resizeInlineValues;
+
+    /**
+     * Buckets of the old array with index less than this have been migrated
+     * to #resizeBuckets; lookups and insertions for them go to the new array.
+     * Always 0 when no resize is in progress.
+     */
+    std::atomic<uint64_t> nextBucketToMigrate;
+
+    /**
+     * The bucket array that was replaced by the most recent resize. It (and
+     * its overflow cache lines) are kept intact until the owner knows that no
+     * unlocked readers can still be referencing it; see
+     * #releaseRetiredBuckets().
+     */
+    std::unique_ptr<LargeBlockOfMemory<CacheLine>> retiredBuckets;
+
+    /// Number of buckets in #retiredBuckets.
+    uint64_t retiredNumBuckets;
+
+    /**
+     * Number of references currently stored in the table. Used to decide
+     * when the table should grow.
+     */
+    std::atomic<uint64_t> numEntries;
+
     friend void hashTableBenchmark(uint64_t nkeys, uint64_t nlines);
     DISALLOW_COPY_AND_ASSIGN(HashTable);
 };
@@ -225,6 +225,47 @@ TEST_F(HashTableEntryTest, hashMatches) {
     EXPECT_TRUE(!e.hashMatches(0xfeedUL));
 }
 
+TEST_F(HashTableEntryTest, findMatches) {
+    HashTable::CacheLine cl;
+    for (uint32_t i = 0; i < HashTable::ENTRIES_PER_CACHE_LINE; i++)
+        cl.entries[i].clear();
+    cl.entries[0].setReference(0xbeefUL, 0x1UL);
+    cl.entries[2].setReference(0xfeedUL, 0x2UL);
+    cl.entries[3].setReference(0xbeefUL, 0x3UL);
+    cl.entries[5].setReference(0UL, 0x4UL);
+    cl.entries[7].setChainPointer(reinterpret_cast<HashTable::CacheLine*>(
+        0x1UL));
+
+    HashTable::MatchImplementation implementations[] = {
+        HashTable::MATCH_SCALAR,
+        HashTable::MATCH_SSE41,
+        HashTable::MATCH_AVX2,
+    };
+    HashTable::MatchImplementation original =
+        HashTable::getMatchImplementation();
+    foreach (HashTable::MatchImplementation impl, implementations) {
+        HashTable::setMatchImplementation(impl);
+        EXPECT_EQ(0x09U, HashTable::findMatches(&cl, 0xbeefUL));
+        EXPECT_EQ(0x04U, HashTable::findMatches(&cl, 0xfeedUL));
+        // Empty entries and the chain pointer have a zero hash too.
+        EXPECT_EQ(0x20U, HashTable::findMatches(&cl, 0UL));
+        EXPECT_EQ(0x00U, HashTable::findMatches(&cl, 0x1234UL));
+    }
+    HashTable::setMatchImplementation(original);
+}
+
+TEST_F(HashTableEntryTest, setMatchImplementation) {
+    HashTable::MatchImplementation original =
+        HashTable::getMatchImplementation();
+    EXPECT_EQ(HashTable::MATCH_SCALAR,
+              HashTable::setMatchImplementation(HashTable::MATCH_SCALAR));
+    EXPECT_EQ(HashTable::MATCH_SCALAR, HashTable::getMatchImplementation());
+    EXPECT_NE(HashTable::MATCH_BEST_AVAILABLE,
+              HashTable::setMatchImplementation(
+                    HashTable::MATCH_BEST_AVAILABLE));
+    HashTable::setMatchImplementation(original);
+}
+
 /**
  * Unit tests for HashTable.
  */
@@ -821,4 +862,171 @@ TEST_F(HashTableTest, forEach) {
         EXPECT_EQ(1U, checkoff[i].count);
 }
 
+/**
+ * HashTable::KeyHashFunction for tables whose references point directly at
+ * TestObjects.
+ */
+static KeyHash
+test_resize_keyHash(uint64_t reference, void *cookie)
+{
+    TestObject* obj = reinterpret_cast<TestObject*>(reference);
+    Key key(obj->tableId, obj->stringKeyPtr, obj->stringKeyLength);
+    return key.getHash();
+}
+
+TEST_F(HashTableTest, needsResize) {
+    HashTable fixed(2);
+    HashTable growable(2, 8);
+    EXPECT_EQ(2UL, growable.getInitialNumBuckets());
+    for (uint64_t i = 0; i < 2 * HashTable::MAX_ENTRIES_PER_BUCKET; i++) {
+        fixed.insert(i, i + 1);
+        growable.insert(i, i + 1);
+    }
+    EXPECT_FALSE(growable.needsResize());
+    fixed.insert(100, 101);
+    growable.insert(100, 101);
+    EXPECT_EQ(2 * HashTable::MAX_ENTRIES_PER_BUCKET + 1,
+              growable.getNumEntries());
+    EXPECT_FALSE(fixed.needsResize());
+    EXPECT_TRUE(growable.needsResize());
+
+    growable.startResize();
+    EXPECT_TRUE(growable.isResizing());
+    EXPECT_FALSE(growable.needsResize());
+}
+
+TEST_F(HashTableTest, resize) {
+    HashTable ht(2, 4);
+    uint32_t arrayLen = 64;
+    TestObject objects[arrayLen] = {};
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        objects[i].setKey(format("%u", i));
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        replace(&ht, key, objects[i].u64Address());
+    }
+    EXPECT_TRUE(ht.needsResize());
+
+    TestLog::Enable _;
+    ht.startResize();
+    EXPECT_EQ("startResize: Growing hash table from 2 to 4 buckets "
+              "(64 entries)", TestLog::get());
+    EXPECT_EQ(2UL, ht.getNumBuckets());
+    EXPECT_EQ(0UL, ht.getNextBucketToMigrate());
+
+    // Half way through the migration everything must still be reachable,
+    // and each old bucket index must still enumerate its own keys.
+    EXPECT_FALSE(ht.migrateBucket(test_resize_keyHash, NULL));
+    EXPECT_EQ(1UL, ht.getNextBucketToMigrate());
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        uint64_t outRef;
+        EXPECT_TRUE(lookup(&ht, key, outRef));
+        EXPECT_EQ(objects[i].u64Address(), outRef);
+    }
+    EXPECT_EQ(arrayLen, ht.forEach(test_forEach_callback,
+                                   reinterpret_cast<void *>(57)));
+
+    // Entries added mid-resize to a migrated bucket go to the new array.
+    TestObject extra(0, "extra");
+    Key extraKey(extra.tableId, extra.stringKeyPtr, extra.stringKeyLength);
+    uint64_t unused;
+    uint64_t extraBucket = HashTable::findBucketIndex(2, extraKey.getHash(),
+                                                      &unused);
+    if (extraBucket == 0) {
+        ht.insert(extraKey.getHash(), extra.u64Address());
+        EXPECT_GE(ht.resizeBuckets->get() + 4,
+                  ht.findBucket(extraKey.getHash(), &unused));
+        EXPECT_LE(ht.resizeBuckets->get(),
+                  ht.findBucket(extraKey.getHash(), &unused));
+    }
+
+    EXPECT_TRUE(ht.migrateBucket(test_resize_keyHash, NULL));
+    ht.finishResize();
+    EXPECT_FALSE(ht.isResizing());
+    EXPECT_TRUE(ht.hasRetiredBuckets());
+    EXPECT_EQ(4UL, ht.getNumBuckets());
+    EXPECT_EQ(0UL, ht.getNextBucketToMigrate());
+    ht.releaseRetiredBuckets();
+    EXPECT_FALSE(ht.hasRetiredBuckets());
+
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        Key key(objects[i].tableId, objects[i].stringKeyPtr,
+                objects[i].stringKeyLength);
+        uint64_t outRef;
+        EXPECT_TRUE(lookup(&ht, key, outRef));
+        EXPECT_EQ(objects[i].u64Address(), outRef);
+        EXPECT_EQ(HashTable::findBucketIndex(4, key.getHash(), &unused),
+                  static_cast<uint64_t>(ht.findBucket(key.getHash(), &unused) -
+                                        ht.buckets.get()));
+    }
+
+    // Already at the maximum size.
+    EXPECT_FALSE(ht.needsResize());
+}
+
+TEST_F(HashTableTest, remove_updatesNumEntries) {
+    HashTable ht(1024);
+    TestObject a(0, "0");
+    Key aKey(a.tableId, a.stringKeyPtr, a.stringKeyLength);
+    ht.insert(aKey.getHash(), a.u64Address());
+    EXPECT_EQ(1UL, ht.getNumEntries());
+
+    HashTable::Candidates candidates;
+    ht.lookup(aKey.getHash(), candidates);
+    ASSERT_FALSE(candidates.isDone());
+    candidates.remove();
+    EXPECT_EQ(0UL, ht.getNumEntries());
+}
+
+TEST_F(HashTableTest, inlineValues) {
+    HashTable plain(1024);
+    EXPECT_FALSE(plain.hasInlineValues());
+    EXPECT_TRUE(plain.findInlineValue(0) == NULL);
+
+    HashTable ht(2, 4, true);
+    EXPECT_TRUE(ht.hasInlineValues());
+    TestObject a(0, "0");
+    TestObject b(0, "1");
+    Key aKey(a.tableId, a.stringKeyPtr, a.stringKeyLength);
+    Key bKey(b.tableId, b.stringKeyPtr, b.stringKeyLength);
+    ht.insert(aKey.getHash(), a.u64Address());
+    ht.insert(bKey.getHash(), b.u64Address());
+
+    HashTable::InlineValue* inlineValue = ht.findInlineValue(aKey.getHash());
+    ASSERT_TRUE(inlineValue != NULL);
+    EXPECT_FALSE(inlineValue->matches(aKey));
+    inlineValue->reference = a.u64Address();
+    inlineValue->tableId = 0;
+    inlineValue->keyLength = 1;
+    inlineValue->key[0] = '0';
+    EXPECT_TRUE(inlineValue->matches(aKey));
+    EXPECT_FALSE(inlineValue->matches(bKey));
+
+    // Only changes to the entry it was copied from empty it.
+    ht.invalidateInlineValue(aKey.getHash(), b.u64Address());
+    EXPECT_TRUE(inlineValue->matches(aKey));
+    HashTable::Candidates candidates;
+    ht.lookup(aKey.getHash(), candidates);
+    while (!candidates.isDone() &&
+            candidates.getReference() != a.u64Address())
+        candidates.next();
+    ASSERT_FALSE(candidates.isDone());
+    candidates.setReference(b.u64Address());
+    EXPECT_FALSE(inlineValue->matches(aKey));
+
+    inlineValue->reference = b.u64Address();
+    ht.invalidateInlineValue(aKey.getHash(), b.u64Address());
+    EXPECT_FALSE(inlineValue->matches(aKey));
+
+    // Resizing empties them.
+    inlineValue->reference = b.u64Address();
+    ht.startResize();
+    while (!ht.migrateBucket(test_resize_keyHash, NULL)) {}
+    EXPECT_FALSE(ht.findInlineValue(aKey.getHash())->matches(aKey));
+    ht.finishResize();
+    EXPECT_FALSE(ht.findInlineValue(aKey.getHash())->matches(aKey));
+}
+
 } // namespace RAMCloud
@@ -0,0 +1,425 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "HotKeyReplicator.h"
+#include "ClientException.h"
+#include "Cycles.h"
+#include "HotKeySketch.h"
+#include "MasterClient.h"
+#include "PerfStats.h"
+#include "ServerList.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+// Defined here because they are bound to references: by std::min in the
+// constructor and by Tub::construct in push().
+const uint32_t HotKeyReplicator::MAX_REPLICAS_PER_KEY;
+const uint32_t HotKeyReplicator::LEASE_MICROS;
+
+/**
+ * Construct a HotKeyReplicator.
+ *
+ * \param context
+ *      Overall information about this server.
+ * \param serverId
+ *      This master's server id; it needn't be valid yet.
+ * \param sketch
+ *      Finds this master's hot objects. If it is disabled, no objects are
+ *      replicated.
+ * \param tabletManager
+ *      This master's tablets.
+ * \param numReplicas
+ *      Number of other masters that should hold replicas of each hot object
+ *      owned by this one (at most MAX_REPLICAS_PER_KEY); 0 means hot
+ *      objects aren't replicated, though replicas pushed by other masters
+ *      are still served.
+ */
+HotKeyReplicator::HotKeyReplicator(Context* context, const ServerId* serverId,
+        HotKeySketch* sketch, TabletManager* tabletManager,
+        uint32_t numReplicas)
+    : context(context)
+    , serverId(serverId)
+    , sketch(sketch)
+    , tabletManager(tabletManager)
+    , numReplicas(std::min(numReplicas, MAX_REPLICAS_PER_KEY))
+    , sampleInterval(SAMPLE_INTERVAL)
+    , hotReadsPerSecond(HOT_READS_PER_SECOND)
+    , refreshCycles(Cycles::fromMicroseconds(REFRESH_MICROS))
+    , leaseCycles(Cycles::fromMicroseconds(LEASE_MICROS))
+    , mutex("HotKeyReplicator::mutex")
+    , lastRefresh(0)
+    , hotKeys()
+    , replicas()
+{
+    if (this->numReplicas > 0 && !sketch->isEnabled()) {
+        LOG(WARNING, "Hot objects won't be replicated, because the hot key "
+                "sketch is disabled (see --hotKeySampleInterval)");
+    }
+}
+
+/**
+ * If an object is hot, append the service locators of the masters that hold
+ * its replicas to a read response (in the format described in
+ * WireFormat::Read::Response).
+ *
+ * \param key
+ *      Identifies the object.
+ * \param buffer
+ *      The locators are appended here.
+ * \return
+ *      The number of locators appended.
+ */
+uint8_t
+HotKeyReplicator::appendReplicaLocators(Key& key, Buffer* buffer)
+{
+    std::vector<ServerId> targets;
+    {
+        SpinLock::Guard _(mutex);
+        if (hotKeys.empty())
+            return 0;
+        std::map<ObjectId, HotKey>::iterator it = hotKeys.find(
+                ObjectId(key.getTableId(), string(
+                static_cast<const char*>(key.getStringKey()),
+                key.getStringKeyLength())));
+        if (it == hotKeys.end())
+            return 0;
+        targets = it->second.replicas;
+    }
+
+    uint8_t count = 0;
+    foreach (ServerId id, targets) {
+        string locator;
+        try {
+            locator = context->serverList->getLocator(id);
+        } catch (const ServerListException& e) {
+            continue;
+        }
+        *buffer->emplaceAppend<uint16_t>() =
+                downCast<uint16_t>(locator.size());
+        buffer->appendCopy(locator.data(), downCast<uint32_t>(locator.size()));
+        count++;
+    }
+    return count;
+}
+
+/**
+ * This method is invoked after an object owned by this master has been
+ * written or removed; if the object is hot, its replicas are updated
+ * before this method returns.
+ *
+ * \param key
+ *      Identifies the object.
+ * \param value
+ *      The object's new value (ignored if \a removed is true).
+ * \param length
+ *      Size in bytes of the value.
+ * \param version
+ *      The object's new version (or its last version, if it was removed).
+ * \param removed
+ *      True means the object was removed.
+ */
+void
+HotKeyReplicator::objectChanged(Key& key, const void* value, uint32_t length,
+        uint64_t version, bool removed)
+{
+    std::vector<ServerId> targets;
+    {
+        SpinLock::Guard _(mutex);
+        if (hotKeys.empty())
+            return;
+        std::map<ObjectId, HotKey>::iterator it = hotKeys.find(
+                ObjectId(key.getTableId(), string(
+                static_cast<const char*>(key.getStringKey()),
+                key.getStringKeyLength())));
+        if (it == hotKeys.end())
+            return;
+        targets = it->second.replicas;
+        if (removed)
+            hotKeys.erase(it);
+        else
+            it->second.pushTime = Cycles::rdtsc();
+    }
+    push(key, targets, value, length, version, removed);
+}
+
+/**
+ * Read the replica of an object owned by another master, if this master
+ * holds one whose lease hasn't run out.
+ *
+ * \param key
+ *      Identifies the object.
+ * \param[out] value
+ *      If the replica is found, the object's value is appended here.
+ * \param[out] version
+ *      If the replica is found, the object's version is returned here.
+ * \return
+ *      True means the replica was found; false means the read must go to
+ *      the object's master.
+ */
+bool
+HotKeyReplicator::readReplica(Key& key, Buffer* value, uint64_t* version)
+{
+    SpinLock::Guard _(mutex);
+    if (replicas.empty())
+        return false;
+    std::map<ObjectId, Replica>::iterator it = replicas.find(
+            ObjectId(key.getTableId(), string(
+            static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength())));
+    if (it == replicas.end())
+        return false;
+    Replica& replica = it->second;
+    if (Cycles::rdtsc() >= replica.leaseExpiration) {
+        replicas.erase(it);
+        return false;
+    }
+    value->appendCopy(replica.value.data(),
+                      downCast<uint32_t>(replica.value.size()));
+    *version = replica.version;
+    return true;
+}
+
+/**
+ * This method is invoked after this master has read one of its objects for
+ * a client (and recorded the read in the HotKeySketch). If the read is
+ * sampled, the set of hot objects is refreshed when it is due; and if the
+ * object is hot and its replicas are due to be refreshed, they are pushed
+ * before this method returns.
+ *
+ * \param key
+ *      Identifies the object.
+ * \param buffer
+ *      Holds the object's value.
+ * \param offset
+ *      Offset of the value in \a buffer.
+ * \param length
+ *      Size in bytes of the value.
+ * \param version
+ *      The object's version.
+ */
+void
+HotKeyReplicator::recordRead(Key& key, Buffer* buffer, uint32_t offset,
+        uint32_t length, uint64_t version)
+{
+    if (PerfStats::threadStats.readCount % sampleInterval != 0)
+        return;
+
+    uint64_t now = Cycles::rdtsc();
+    bool refresh = false;
+    {
+        SpinLock::Guard _(mutex);
+        if (now - lastRefresh >= refreshCycles) {
+            lastRefresh = now;
+            refresh = true;
+        }
+    }
+    if (refresh)
+        refreshHotKeys();
+
+    ObjectId id(key.getTableId(), string(
+            static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    std::vector<ServerId> targets;
+    {
+        SpinLock::Guard _(mutex);
+        std::map<ObjectId, HotKey>::iterator it = hotKeys.find(id);
+        if (it == hotKeys.end())
+            return;
+        HotKey& hotKey = it->second;
+        if (hotKey.replicas.empty() ||
+                now - hotKey.pushTime < leaseCycles / 2)
+            return;
+        hotKey.pushTime = now;
+        targets = hotKey.replicas;
+    }
+    push(key, targets, buffer->getRange(offset, length), length, version,
+         false);
+}
+
+/**
+ * Store, refresh or drop the replica of an object owned by another master;
+ * this is the server side of UPDATE_HOT_REPLICA.
+ *
+ * \param key
+ *      Identifies the object.
+ * \param value
+ *      The object's value.
+ * \param length
+ *      Size in bytes of the value.
+ * \param version
+ *      The object's version.
+ * \param leaseMicros
+ *      The replica may be served for this long.
+ * \param remove
+ *      True means the object was removed, so the replica is dropped.
+ */
+void
+HotKeyReplicator::updateReplica(Key& key, const void* value, uint32_t length,
+        uint64_t version, uint32_t leaseMicros, bool remove)
+{
+    ObjectId id(key.getTableId(), string(
+            static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength()));
+    uint64_t now = Cycles::rdtsc();
+    SpinLock::Guard _(mutex);
+    std::map<ObjectId, Replica>::iterator it = replicas.find(id);
+    if (remove) {
+        if (it != replicas.end())
+            replicas.erase(it);
+        return;
+    }
+    if (it == replicas.end()) {
+        if (replicas.size() >= MAX_REPLICAS) {
+            for (it = replicas.begin(); it != replicas.end(); ) {
+                if (now >= it->second.leaseExpiration)
+                    it = replicas.erase(it);
+                else
+                    it++;
+            }
+            if (replicas.size() >= MAX_REPLICAS)
+                return;
+        }
+        it = replicas.insert({id, Replica()}).first;
+    } else if (it->second.version > version) {
+        // A push of an older version that was overtaken by a newer one.
+        return;
+    }
+    Replica& replica = it->second;
+    replica.value.assign(static_cast<const char*>(value), length);
+    replica.version = version;
+    replica.leaseExpiration = now + Cycles::fromMicroseconds(leaseMicros);
+}
+
+/**
+ * Pick the masters that will hold the replicas of a newly hot object.
+ * Objects are spread over the cluster by key hash.
+ *
+ * \param keyHash
+ *      Hash of the object's key.
+ * \param[out] replicas
+ *      The chosen masters (at most #numReplicas) are appended here.
+ */
+void
+HotKeyReplicator::chooseReplicas(KeyHash keyHash,
+        std::vector<ServerId>* replicas)
+{
+    size_t size = context->serverList->size();
+    if (size == 0)
+        return;
+    ServerId id(downCast<uint32_t>(keyHash % size), 0);
+    for (size_t i = 0; i < size && replicas->size() < numReplicas; i++) {
+        id = context->serverList->nextServer(id, {WireFormat::MASTER_SERVICE});
+        if (!id.isValid())
+            break;
+        if (id == *serverId || std::find(replicas->begin(), replicas->end(),
+                id) != replicas->end())
+            continue;
+        replicas->push_back(id);
+    }
+}
+
+/**
+ * Send an object to the masters holding its replicas and wait for them to
+ * acknowledge it. Masters that have crashed are dropped from the object's
+ * replicas.
+ *
+ * \param key
+ *      Identifies the object.
+ * \param targets
+ *      The masters to send the object to.
+ * \param value
+ *      The object's value (ignored if \a removed is true).
+ * \param length
+ *      Size in bytes of the value.
+ * \param version
+ *      The object's version.
+ * \param removed
+ *      True means the object was removed, so its replicas are dropped.
+ */
+void
+HotKeyReplicator::push(Key& key, const std::vector<ServerId>& targets,
+        const void* value, uint32_t length, uint64_t version, bool removed)
+{
+    Tub<UpdateHotReplicaRpc> rpcs[MAX_REPLICAS_PER_KEY];
+    size_t count = std::min(targets.size(), size_t(MAX_REPLICAS_PER_KEY));
+    for (size_t i = 0; i < count; i++) {
+        rpcs[i].construct(context, targets[i], key.getTableId(),
+                key.getStringKey(), key.getStringKeyLength(), value, length,
+                version, LEASE_MICROS, removed);
+    }
+
+    std::vector<ServerId> failed;
+    for (size_t i = 0; i < count; i++) {
+        try {
+            rpcs[i]->wait();
+        } catch (const ServerNotUpException& e) {
+            failed.push_back(targets[i]);
+        }
+    }
+    if (failed.empty() || removed)
+        return;
+
+    SpinLock::Guard _(mutex);
+    std::map<ObjectId, HotKey>::iterator it = hotKeys.find(
+            ObjectId(key.getTableId(), string(
+            static_cast<const char*>(key.getStringKey()),
+            key.getStringKeyLength())));
+    if (it == hotKeys.end())
+        return;
+    std::vector<ServerId>& replicas = it->second.replicas;
+    foreach (ServerId id, failed) {
+        replicas.erase(std::remove(replicas.begin(), replicas.end(), id),
+                       replicas.end());
+    }
+}
+
+/**
+ * Look up this master's hot keys in the sketch: objects read at least
+ * #hotReadsPerSecond times per second become hot (choosing masters for
+ * their replicas), and hot objects that have cooled off, or whose tablets
+ * have moved elsewhere, stop being hot. A newly hot object is pushed to
+ * its replicas by the next sampled read of it.
+ */
+void
+HotKeyReplicator::refreshHotKeys()
+{
+    // Query the sketch without holding our lock, so that reads of hot
+    // objects never wait for it.
+    std::vector<HotKeySketch::HotKey> keys;
+    sketch->getHotKeys(tabletManager, &keys);
+
+    SpinLock::Guard _(mutex);
+    std::map<ObjectId, HotKey> newHotKeys;
+    foreach (const HotKeySketch::HotKey& key, keys) {
+        if (HotKeySketch::toOpsPerSecond(key.reads) < hotReadsPerSecond)
+            continue;
+        ObjectId id(key.tableId, key.key);
+        std::map<ObjectId, HotKey>::iterator it = hotKeys.find(id);
+        if (it != hotKeys.end()) {
+            newHotKeys[id] = it->second;
+            continue;
+        }
+        HotKey& hotKey = newHotKeys[id];
+        chooseReplicas(key.keyHash, &hotKey.replicas);
+        LOG(NOTICE, "Object <%lu, 0x%lx> is hot; replicating it on "
+                "%lu other masters", key.tableId, key.keyHash,
+                hotKey.replicas.size());
+    }
+    hotKeys.swap(newHotKeys);
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,181 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_HOTKEYREPLICATOR_H
+#define RAMCLOUD_HOTKEYREPLICATOR_H
+
+#include <map>
+
+#include "Buffer.h"
+#include "Key.h"
+#include "ServerId.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+class Context;
+class HotKeySketch;
+class TabletManager;
+
+/**
+ * Keeps read replicas of a master's hottest objects on other masters, so
+ * that reads of a single very popular object can be spread over several
+ * servers. Each master has one of these, which plays two roles:
+ *
+ * - For objects this master owns, it asks the master's HotKeySketch for
+ *   its hottest keys every REFRESH_MICROS. An object read at least
+ *   #hotReadsPerSecond times per second becomes hot: a few other masters
+ *   are chosen to hold replicas of it, and it is pushed to them with
+ *   UPDATE_HOT_REPLICA. The replicas are pushed again whenever the object
+ *   is written or removed, and every half lease period while it stays hot
+ *   (checked on one out of every #sampleInterval reads served by a thread,
+ *   as counted in PerfStats). An object whose read rate drops below
+ *   #hotReadsPerSecond stops being hot.
+ *
+ * - For objects owned by other masters, it holds the replicas they pushed
+ *   here. A replica is only served until its lease runs out, so it is
+ *   never more than one lease period older than the owner's copy; the
+ *   owner's crash or a tablet migration just lets it expire.
+ *
+ * Clients only read replicas of tables for which they have called
+ * RamCloud::enableReplicaReads(); read responses from the owner tell them
+ * where the replicas are (see WireFormat::Read).
+ *
+ * This class is thread-safe.
+ */
+class HotKeyReplicator {
+  PUBLIC:
+    HotKeyReplicator(Context* context, const ServerId* serverId,
+                     HotKeySketch* sketch, TabletManager* tabletManager,
+                     uint32_t numReplicas);
+
+    uint8_t appendReplicaLocators(Key& key, Buffer* buffer);
+    void objectChanged(Key& key, const void* value, uint32_t length,
+                       uint64_t version, bool removed);
+    bool readReplica(Key& key, Buffer* value, uint64_t* version);
+    void recordRead(Key& key, Buffer* buffer, uint32_t offset,
+                    uint32_t length, uint64_t version);
+    void updateReplica(Key& key, const void* value, uint32_t length,
+                       uint64_t version, uint32_t leaseMicros, bool remove);
+
+    /// Returns true if this master replicates its hot objects.
+    bool isEnabled() const {
+        return numReplicas > 0;
+    }
+
+    /// Upper limit on the number of replicas of each hot object.
+    static const uint32_t MAX_REPLICAS_PER_KEY = 8;
+
+  PRIVATE:
+    /// Objects are identified by table id and primary key.
+    typedef std::pair<uint64_t, string> ObjectId;
+
+    /// An object owned by this master that is currently hot.
+    struct HotKey {
+        HotKey() : replicas(), pushTime(0) {}
+
+        /// Masters that hold replicas of the object.
+        std::vector<ServerId> replicas;
+
+        /// Cycles::rdtsc() time when the replicas were last pushed.
+        uint64_t pushTime;
+    };
+
+    /// A replica of an object owned by another master.
+    struct Replica {
+        Replica() : value(), version(0), leaseExpiration(0) {}
+
+        /// The object's value as of #version.
+        string value;
+
+        /// Version of the object.
+        uint64_t version;
+
+        /// The replica is served until Cycles::rdtsc() reaches this.
+        uint64_t leaseExpiration;
+    };
+
+    void chooseReplicas(KeyHash keyHash, std::vector<ServerId>* replicas);
+    void push(Key& key, const std::vector<ServerId>& targets,
+              const void* value, uint32_t length, uint64_t version,
+              bool removed);
+    void refreshHotKeys();
+
+    /// Default for #sampleInterval.
+    static const uint32_t SAMPLE_INTERVAL = 64;
+
+    /// Default for #hotReadsPerSecond.
+    static const uint32_t HOT_READS_PER_SECOND = 10000;
+
+    /// How often the hot objects are looked up in the sketch, in
+    /// microseconds.
+    static const uint32_t REFRESH_MICROS = 100000;
+
+    /// How long replicas pushed by this master may be served, in
+    /// microseconds.
+    static const uint32_t LEASE_MICROS = 200000;
+
+    /// Upper limit on the number of replicas held for other masters.
+    static const uint32_t MAX_REPLICAS = 10000;
+
+    /// Overall information about this server.
+    Context* context;
+
+    /// This master's server id (owned by MasterService).
+    const ServerId* serverId;
+
+    /// Finds this master's hot objects (owned by MasterService).
+    HotKeySketch* sketch;
+
+    /// This master's tablets (owned by MasterService); used to tell which
+    /// of the sketch's keys this master still owns.
+    TabletManager* tabletManager;
+
+    /// Number of replicas kept of each hot object; 0 means hot objects
+    /// aren't replicated.
+    uint32_t numReplicas;
+
+    /// Only one out of this many reads (per thread) checks whether the hot
+    /// objects should be refreshed or their replicas pushed.
+    uint32_t sampleInterval;
+
+    /// Objects read at least this often, according to #sketch, are hot.
+    double hotReadsPerSecond;
+
+    /// REFRESH_MICROS in Cycles::rdtsc() ticks.
+    uint64_t refreshCycles;
+
+    /// LEASE_MICROS in Cycles::rdtsc() ticks.
+    uint64_t leaseCycles;
+
+    /// Protects all of the members below.
+    SpinLock mutex;
+
+    /// Cycles::rdtsc() time when the hot objects were last refreshed.
+    uint64_t lastRefresh;
+
+    /// Objects owned by this master that are replicated elsewhere.
+    std::map<ObjectId, HotKey> hotKeys;
+
+    /// Replicas held here for objects owned by other masters.
+    std::map<ObjectId, Replica> replicas;
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeyReplicator);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_HOTKEYREPLICATOR_H
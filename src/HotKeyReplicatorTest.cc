@@ -0,0 +1,214 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "HotKeyReplicator.h"
+#include "MasterService.h"
+#include "MockCluster.h"
+#include "ObjectFinder.h"
+#include "RamCloud.h"
+#include "Server.h"
+
+namespace RAMCloud {
+
+class HotKeyReplicatorTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    MasterService* owner;
+    MasterService* other;
+    uint64_t tableId;
+
+    HotKeyReplicatorTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , owner(NULL)
+        , other(NULL)
+        , tableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        config.master.hotKeyReplicas = 1;
+        owner = cluster.addServer(config)->master.get();
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table1");
+        ramcloud->write(tableId, "object1", 7, "value1");
+
+        // Added after the table was created, so that it owns no tablets.
+        config.localLocator = "mock:host=master2";
+        other = cluster.addServer(config)->master.get();
+        cluster.syncCoordinatorServerList();
+
+        // Make every read count, and a single one make an object hot.
+        owner->hotKeySketch.sampleInterval = 1;
+        HotKeySketch::countdown = 0;
+        owner->hotKeyReplicator.sampleInterval = 1;
+        owner->hotKeyReplicator.refreshCycles = 0;
+        owner->hotKeyReplicator.hotReadsPerSecond =
+                HotKeySketch::toOpsPerSecond(1);
+    }
+
+    /// Returns the value of the replica of object1 on the other master,
+    /// or "none".
+    string
+    replicaValue()
+    {
+        Key key(tableId, "object1", 7);
+        Buffer value;
+        uint64_t version;
+        if (!other->hotKeyReplicator.readReplica(key, &value, &version))
+            return "none";
+        return TestUtil::toString(&value);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeyReplicatorTest);
+};
+
+TEST_F(HotKeyReplicatorTest, recordRead_becomesHot) {
+    owner->hotKeyReplicator.hotReadsPerSecond =
+            HotKeySketch::toOpsPerSecond(2);
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(0u, owner->hotKeyReplicator.hotKeys.size());
+    EXPECT_EQ("none", replicaValue());
+
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(1u, owner->hotKeyReplicator.hotKeys.size());
+    EXPECT_EQ("value1", replicaValue());
+}
+
+TEST_F(HotKeyReplicatorTest, recordRead_pushOnlyEveryHalfLease) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", replicaValue());
+
+    // The replica's lease is still fresh, so the next read doesn't push
+    // the object again.
+    other->hotKeyReplicator.replicas.clear();
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("none", replicaValue());
+
+    owner->hotKeyReplicator.hotKeys.begin()->second.pushTime = 0;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", replicaValue());
+}
+
+TEST_F(HotKeyReplicatorTest, objectChanged) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ramcloud->write(tableId, "object1", 7, "value2");
+    EXPECT_EQ("value2", replicaValue());
+    ramcloud->remove(tableId, "object1", 7);
+    EXPECT_EQ("none", replicaValue());
+    EXPECT_EQ(0u, owner->hotKeyReplicator.hotKeys.size());
+}
+
+TEST_F(HotKeyReplicatorTest, readReplica_leaseExpired) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    other->hotKeyReplicator.replicas.begin()->second.leaseExpiration = 0;
+    EXPECT_EQ("none", replicaValue());
+    EXPECT_EQ(0u, other->hotKeyReplicator.replicas.size());
+}
+
+TEST_F(HotKeyReplicatorTest, updateReplica_olderVersion) {
+    Key key(tableId, "object1", 7);
+    other->hotKeyReplicator.updateReplica(key, "new", 3, 5, 1000000, false);
+    other->hotKeyReplicator.updateReplica(key, "old", 3, 4, 1000000, false);
+    EXPECT_EQ("new", replicaValue());
+    other->hotKeyReplicator.updateReplica(key, NULL, 0, 6, 1000000, true);
+    EXPECT_EQ("none", replicaValue());
+}
+
+TEST_F(HotKeyReplicatorTest, recordRead_refreshOnlyWhenDue) {
+    HotKeyReplicator& replicator = owner->hotKeyReplicator;
+    replicator.refreshCycles = Cycles::fromSeconds(1000);
+    replicator.lastRefresh = Cycles::rdtsc();
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(0u, replicator.hotKeys.size());
+
+    replicator.lastRefresh = 0;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(1u, replicator.hotKeys.size());
+}
+
+TEST_F(HotKeyReplicatorTest, refreshHotKeys) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    HotKeyReplicator& replicator = owner->hotKeyReplicator;
+    ASSERT_EQ(1u, replicator.hotKeys.size());
+    replicator.hotKeys.begin()->second.pushTime = 5;
+
+    // Objects that stay hot keep their state.
+    replicator.refreshHotKeys();
+    ASSERT_EQ(1u, replicator.hotKeys.size());
+    EXPECT_EQ(5u, replicator.hotKeys.begin()->second.pushTime);
+
+    // Keys that are written but not read aren't hot.
+    ramcloud->write(tableId, "object2", 7, "value2");
+    replicator.refreshHotKeys();
+    EXPECT_EQ(1u, replicator.hotKeys.size());
+
+    // Read less often than the threshold: no longer hot.
+    replicator.hotReadsPerSecond = HotKeySketch::toOpsPerSecond(100);
+    replicator.refreshHotKeys();
+    EXPECT_EQ(0u, replicator.hotKeys.size());
+}
+
+TEST_F(HotKeyReplicatorTest, replicaReads) {
+    ramcloud->enableReplicaReads(tableId);
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ObjectFinder* finder = ramcloud->clientContext->objectFinder;
+    ASSERT_EQ(1u, finder->hotReplicas.size());
+    EXPECT_EQ("mock:host=master2",
+              finder->hotReplicas.begin()->second.locators[0]);
+
+    // Reads now alternate between the replica and the master; make the
+    // replica's value differ to tell them apart.
+    Key key(tableId, "object1", 7);
+    other->hotKeyReplicator.updateReplica(key, "replica", 7, ~0UL, 1000000,
+                                          false);
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("replica", TestUtil::toString(&value));
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+
+    // A replica that has lost the object sends the read back to the
+    // master.
+    other->hotKeyReplicator.replicas.clear();
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+}
+
+TEST_F(HotKeyReplicatorTest, replicaReads_notEnabled) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(0u, ramcloud->clientContext->objectFinder->hotReplicas.size());
+}
+
+}  // namespace RAMCloud
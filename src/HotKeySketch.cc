@@ -0,0 +1,293 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "Common.h"
+#include "Cycles.h"
+#include "HotKeySketch.h"
+#include "TabletManager.h"
+
+namespace RAMCloud {
+
+__thread uint32_t HotKeySketch::countdown = 0;
+
+/**
+ * Construct a HotKeySketch.
+ *
+ * \param sampleInterval
+ *      Only one out of this many reads and writes (per thread) is recorded
+ *      in the sketch; 0 means nothing is recorded.
+ */
+HotKeySketch::HotKeySketch(uint32_t sampleInterval)
+    : sampleInterval(sampleInterval)
+    , decayCycles(Cycles::fromMicroseconds(DECAY_MICROS))
+    , mutex("HotKeySketch::mutex")
+    , lastDecay(Cycles::rdtsc())
+    , tables()
+{
+}
+
+/**
+ * Append the hot keys of this master to a buffer; this is the response to
+ * the GET_HOT_KEYS server control. Use parse() to read it.
+ *
+ * \param buffer
+ *      The hot keys are appended here.
+ * \param tabletManager
+ *      The master's tablets; used to find the tablet containing each key.
+ */
+void
+HotKeySketch::collect(Buffer* buffer, TabletManager* tabletManager)
+{
+    std::vector<HotKey> keys;
+    getHotKeys(tabletManager, &keys);
+    Header* header = buffer->emplaceAppend<Header>();
+    header->sampleInterval = sampleInterval;
+    header->count = downCast<uint32_t>(keys.size());
+    foreach (const HotKey& key, keys) {
+        Entry* entry = buffer->emplaceAppend<Entry>();
+        entry->tableId = key.tableId;
+        entry->startKeyHash = key.startKeyHash;
+        entry->endKeyHash = key.endKeyHash;
+        entry->keyHash = key.keyHash;
+        entry->count = key.count;
+        entry->error = key.error;
+        entry->reads = key.reads;
+        entry->writes = key.writes;
+        entry->keyLength = downCast<uint16_t>(key.key.size());
+        buffer->appendCopy(key.key.data(), entry->keyLength);
+    }
+}
+
+/**
+ * Halve all counts, and forget candidates and tables whose counts reach
+ * zero. The caller must hold #mutex.
+ */
+void
+HotKeySketch::decay()
+{
+    std::unordered_map<uint64_t, TableSketch>::iterator table =
+            tables.begin();
+    while (table != tables.end()) {
+        TableSketch& sketch = table->second;
+        for (uint32_t row = 0; row < CM_DEPTH; row++) {
+            for (uint32_t column = 0; column < CM_WIDTH; column++)
+                sketch.cells[row][column] >>= 1;
+        }
+        std::vector<Counter> survivors;
+        sketch.index.clear();
+        foreach (Counter& counter, sketch.counters) {
+            counter.count >>= 1;
+            counter.error >>= 1;
+            counter.reads >>= 1;
+            counter.writes >>= 1;
+            if (counter.count == 0)
+                continue;
+            sketch.index[counter.keyHash] =
+                    downCast<uint32_t>(survivors.size());
+            survivors.push_back(counter);
+        }
+        sketch.counters.swap(survivors);
+        if (sketch.counters.empty()) {
+            table = tables.erase(table);
+        } else {
+            table++;
+        }
+    }
+}
+
+/**
+ * Return the current hot keys of this master: the candidates of every table,
+ * grouped by tablet (in order of table id and key hash range) and sorted by
+ * decreasing count within each tablet. Keys in tablets this master no
+ * longer owns are left out. This is meant for use by other modules on the
+ * master, such as load balancing and hot key replication.
+ *
+ * \param tabletManager
+ *      The master's tablets; used to find the tablet containing each key.
+ * \param[out] keys
+ *      The hot keys are appended here.
+ */
+void
+HotKeySketch::getHotKeys(TabletManager* tabletManager,
+        std::vector<HotKey>* keys)
+{
+    size_t first = keys->size();
+    {
+        SpinLock::Guard _(mutex);
+        if (Cycles::rdtsc() - lastDecay >= decayCycles) {
+            lastDecay = Cycles::rdtsc();
+            decay();
+        }
+        for (std::unordered_map<uint64_t, TableSketch>::iterator table =
+                tables.begin(); table != tables.end(); table++) {
+            foreach (const Counter& counter, table->second.counters) {
+                HotKey key;
+                key.tableId = table->first;
+                key.keyHash = counter.keyHash;
+                key.count = counter.count * sampleInterval;
+                key.error = counter.error * sampleInterval;
+                key.reads = counter.reads * sampleInterval;
+                key.writes = counter.writes * sampleInterval;
+                key.key = counter.key;
+                keys->push_back(key);
+            }
+        }
+    }
+
+    // Look up tablets without holding our lock, so that hot paths that
+    // record samples never wait for the TabletManager.
+    size_t last = first;
+    for (size_t i = first; i < keys->size(); i++) {
+        HotKey& key = (*keys)[i];
+        TabletManager::Tablet tablet;
+        if (!tabletManager->getTablet(key.tableId, key.keyHash, &tablet))
+            continue;
+        key.startKeyHash = tablet.startKeyHash;
+        key.endKeyHash = tablet.endKeyHash;
+        (*keys)[last++] = key;
+    }
+    keys->resize(last);
+    std::sort(keys->begin() + first, keys->end(),
+            [](const HotKey& a, const HotKey& b) {
+        if (a.tableId != b.tableId)
+            return a.tableId < b.tableId;
+        if (a.startKeyHash != b.startKeyHash)
+            return a.startKeyHash < b.startKeyHash;
+        return a.count > b.count;
+    });
+}
+
+/**
+ * Parse the output of collect().
+ *
+ * \param buffer
+ *      Contains the output of collect().
+ * \param offset
+ *      Offset within buffer of the first byte of that output.
+ * \param length
+ *      Number of bytes of output.
+ * \param[out] keys
+ *      The hot keys are appended here, in the order described in
+ *      getHotKeys().
+ * \return
+ *      True means success; false means the output was malformed.
+ */
+bool
+HotKeySketch::parse(Buffer* buffer, uint32_t offset, uint32_t length,
+        std::vector<HotKey>* keys)
+{
+    uint32_t end = offset + length;
+    const Header* header = buffer->getOffset<Header>(offset);
+    if ((header == NULL) || (length < sizeof32(Header)))
+        return false;
+    offset += sizeof32(Header);
+    for (uint32_t i = 0; i < header->count; i++) {
+        if (offset + sizeof32(Entry) > end)
+            return false;
+        const Entry* entry = buffer->getOffset<Entry>(offset);
+        offset += sizeof32(Entry);
+        if (offset + entry->keyLength > end)
+            return false;
+        HotKey key;
+        key.tableId = entry->tableId;
+        key.startKeyHash = entry->startKeyHash;
+        key.endKeyHash = entry->endKeyHash;
+        key.keyHash = entry->keyHash;
+        key.count = entry->count;
+        key.error = entry->error;
+        key.reads = entry->reads;
+        key.writes = entry->writes;
+        key.key.resize(entry->keyLength);
+        buffer->copy(offset, entry->keyLength, &key.key[0]);
+        offset += entry->keyLength;
+        keys->push_back(key);
+    }
+    return offset == end;
+}
+
+/**
+ * Add one sampled operation to the sketch.
+ *
+ * \param key
+ *      The object that was read or written.
+ * \param read
+ *      True for a read, false for a write.
+ */
+void
+HotKeySketch::record(Key& key, bool read)
+{
+    KeyHash keyHash = key.getHash();
+    uint64_t now = Cycles::rdtsc();
+    SpinLock::Guard _(mutex);
+    if (now - lastDecay >= decayCycles) {
+        lastDecay = now;
+        decay();
+    }
+    TableSketch& sketch = tables[key.getTableId()];
+
+    // Update the Count-Min sketch, using double hashing to pick the
+    // column in each row.
+    uint32_t estimate = ~0u;
+    uint64_t h1 = keyHash & 0xffffffff;
+    uint64_t h2 = (keyHash >> 32) | 1;
+    for (uint32_t row = 0; row < CM_DEPTH; row++) {
+        uint32_t& cell = sketch.cells[row][(h1 + row * h2) % CM_WIDTH];
+        cell++;
+        estimate = std::min(estimate, cell);
+    }
+
+    std::unordered_map<KeyHash, uint32_t>::iterator it =
+            sketch.index.find(keyHash);
+    Counter* counter;
+    if (it != sketch.index.end()) {
+        counter = &sketch.counters[it->second];
+        counter->count++;
+    } else {
+        uint32_t slot;
+        uint64_t error = 0;
+        if (sketch.counters.size() < COUNTERS_PER_TABLE) {
+            slot = downCast<uint32_t>(sketch.counters.size());
+            sketch.counters.push_back(Counter());
+        } else {
+            slot = 0;
+            for (uint32_t i = 1; i < sketch.counters.size(); i++) {
+                if (sketch.counters[i].count < sketch.counters[slot].count)
+                    slot = i;
+            }
+            error = sketch.counters[slot].count;
+            if (estimate <= error)
+                return;
+            sketch.index.erase(sketch.counters[slot].keyHash);
+        }
+        counter = &sketch.counters[slot];
+        counter->keyHash = keyHash;
+        counter->key.assign(static_cast<const char*>(key.getStringKey()),
+                key.getStringKeyLength());
+        counter->count = error + 1;
+        counter->error = error;
+        counter->reads = 0;
+        counter->writes = 0;
+        sketch.index[keyHash] = slot;
+    }
+    if (read) {
+        counter->reads++;
+    } else {
+        counter->writes++;
+    }
+}
+
+} // namespace RAMCloud
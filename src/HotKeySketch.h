@@ -0,0 +1,245 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_HOTKEYSKETCH_H
+#define RAMCLOUD_HOTKEYSKETCH_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "Buffer.h"
+#include "Key.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+class TabletManager;
+
+/**
+ * Finds the most frequently accessed keys of a master, so that hot spots
+ * can be seen rather than guessed at. One out of every few reads and writes
+ * (per thread) is fed into a Space-Saving sketch, which tracks a small,
+ * fixed number of candidate keys per table together with an upper bound on
+ * how much each count is overestimated. A Count-Min sketch in front of it
+ * keeps keys that are seen only once from evicting real candidates: a new
+ * key only replaces the weakest candidate once its Count-Min estimate is
+ * larger than that candidate's count.
+ *
+ * Counts decay: they are all halved every DECAY_MICROS, so the sketch
+ * reflects recent traffic and a key accessed at a steady rate settles near
+ * twice the number of accesses per decay interval. Candidates are kept per
+ * table; they are divided among this master's tablets when the hot keys are
+ * requested (with getHotKeys or the GET_HOT_KEYS server control), so the
+ * results stay correct when tablets are split or migrated. HotKeyReplicator
+ * uses getHotKeys to pick the objects it replicates, and the coordinator's
+ * TabletBalancer fetches the hot keys of every master to move them.
+ */
+class HotKeySketch {
+  PUBLIC:
+    /// One hot key, as returned by getHotKeys() and parse().
+    struct HotKey {
+        HotKey()
+            : tableId(0), startKeyHash(0), endKeyHash(0), keyHash(0)
+            , count(0), error(0), reads(0), writes(0), key()
+        {}
+
+        /// Table containing the key.
+        uint64_t tableId;
+
+        /// Range of key hashes of the tablet containing the key.
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+
+        /// Hash of the key.
+        KeyHash keyHash;
+
+        /// Estimated number of (decayed) accesses, scaled up by the sampling
+        /// interval. This may overestimate the truth by up to #error.
+        uint64_t count;
+
+        /// Upper bound on how much #count is overestimated.
+        uint64_t error;
+
+        /// Sampled reads and writes since the key became a candidate
+        /// (decayed and scaled like #count).
+        uint64_t reads;
+        uint64_t writes;
+
+        /// The primary key.
+        string key;
+    };
+
+    explicit HotKeySketch(uint32_t sampleInterval);
+
+    /// Returns true if reads and writes are recorded in this sketch.
+    bool isEnabled() const {
+        return sampleInterval != 0;
+    }
+
+    /**
+     * Count a read of an object; only one out of every #sampleInterval
+     * reads and writes on each thread actually reaches the sketch.
+     *
+     * \param key
+     *      Identifies the object.
+     */
+    void
+    recordRead(Key& key)
+    {
+        if (expect_false(takeSample()))
+            record(key, true);
+    }
+
+    /**
+     * Count a write of an object; see recordRead.
+     *
+     * \param key
+     *      Identifies the object.
+     */
+    void
+    recordWrite(Key& key)
+    {
+        if (expect_false(takeSample()))
+            record(key, false);
+    }
+
+    /**
+     * Convert the count of a hot key into an approximate number of
+     * accesses per second.
+     *
+     * \param count
+     *      HotKey::count, or a lower bound such as count - error.
+     */
+    static double
+    toOpsPerSecond(uint64_t count)
+    {
+        // Halving every DECAY_MICROS makes a steady rate settle at about
+        // twice the number of accesses per decay interval.
+        return static_cast<double>(count) * 1e06 / (2.0 * DECAY_MICROS);
+    }
+
+    void collect(Buffer* buffer, TabletManager* tabletManager);
+    void getHotKeys(TabletManager* tabletManager, std::vector<HotKey>* keys);
+    static bool parse(Buffer* buffer, uint32_t offset, uint32_t length,
+            std::vector<HotKey>* keys);
+
+  PRIVATE:
+    /// A candidate hot key in the Space-Saving sketch of a table.
+    struct Counter {
+        Counter()
+            : keyHash(0), key(), count(0), error(0), reads(0), writes(0)
+        {}
+
+        KeyHash keyHash;
+        string key;
+        uint64_t count;
+        uint64_t error;
+        uint64_t reads;
+        uint64_t writes;
+    };
+
+    /// Number of candidate keys tracked per table.
+    static const uint32_t COUNTERS_PER_TABLE = 64;
+
+    /// Number of rows and columns of each table's Count-Min sketch.
+    static const uint32_t CM_DEPTH = 4;
+    static const uint32_t CM_WIDTH = 1024;
+
+    /// All counts are halved this often.
+    static const uint32_t DECAY_MICROS = 1000000;
+
+    /// The sketches of one table.
+    struct TableSketch {
+        TableSketch()
+            : counters()
+            , index()
+            , cells()
+        {}
+
+        /// Candidate keys; at most COUNTERS_PER_TABLE.
+        std::vector<Counter> counters;
+
+        /// Position in #counters of each candidate, by key hash.
+        std::unordered_map<KeyHash, uint32_t> index;
+
+        /// Count-Min sketch of all sampled keys of the table.
+        uint32_t cells[CM_DEPTH][CM_WIDTH];
+    };
+
+    /// Header of the output of collect(); followed by #count Entry
+    /// structures, each followed by its primary key.
+    struct Header {
+        uint32_t sampleInterval;
+        uint32_t count;
+    } __attribute__((packed));
+
+    /// One hot key in the output of collect(); see HotKey.
+    struct Entry {
+        uint64_t tableId;
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+        uint64_t keyHash;
+        uint64_t count;
+        uint64_t error;
+        uint64_t reads;
+        uint64_t writes;
+        uint16_t keyLength;
+    } __attribute__((packed));
+
+    /**
+     * Returns true if the current operation should be recorded in the
+     * sketch.
+     */
+    bool
+    takeSample()
+    {
+        if (sampleInterval == 0)
+            return false;
+        if (countdown > 1) {
+            countdown--;
+            return false;
+        }
+        countdown = sampleInterval;
+        return true;
+    }
+
+    void decay();
+    void record(Key& key, bool read);
+
+    /// Only one out of this many reads and writes (per thread) is recorded;
+    /// 0 disables the sketch.
+    uint32_t sampleInterval;
+
+    /// DECAY_MICROS in Cycles::rdtsc() ticks.
+    uint64_t decayCycles;
+
+    /// Protects all of the members below.
+    SpinLock mutex;
+
+    /// Cycles::rdtsc() time when counts were last halved.
+    uint64_t lastDecay;
+
+    /// The sketches of each table that has been sampled, by table id.
+    std::unordered_map<uint64_t, TableSketch> tables;
+
+    /// Operations left on this thread before the next sample.
+    static __thread uint32_t countdown;
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeySketch);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_HOTKEYSKETCH_H
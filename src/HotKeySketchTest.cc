@@ -0,0 +1,192 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "HotKeySketch.h"
+#include "TabletManager.h"
+
+namespace RAMCloud {
+
+class HotKeySketchTest : public ::testing::Test {
+  public:
+    TabletManager tabletManager;
+    HotKeySketch sketch;
+
+    HotKeySketchTest()
+        : tabletManager()
+        , sketch(1)
+    {
+        HotKeySketch::countdown = 0;
+        tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    }
+
+    /// Record 'count' reads of a key in table 1.
+    void
+    read(const char* stringKey, int count)
+    {
+        Key key(1, stringKey, downCast<uint16_t>(strlen(stringKey)));
+        for (int i = 0; i < count; i++)
+            sketch.recordRead(key);
+    }
+
+    /// Returns the candidate for a key in table 1, or NULL if none.
+    HotKeySketch::Counter*
+    find(const char* stringKey)
+    {
+        KeyHash keyHash = Key::getHash(1, stringKey,
+                downCast<uint16_t>(strlen(stringKey)));
+        HotKeySketch::TableSketch& table = sketch.tables[1];
+        if (table.index.find(keyHash) == table.index.end())
+            return NULL;
+        return &table.counters[table.index[keyHash]];
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(HotKeySketchTest);
+};
+
+TEST_F(HotKeySketchTest, takeSample) {
+    sketch.sampleInterval = 3;
+    EXPECT_TRUE(sketch.takeSample());
+    EXPECT_FALSE(sketch.takeSample());
+    EXPECT_FALSE(sketch.takeSample());
+    EXPECT_TRUE(sketch.takeSample());
+
+    sketch.sampleInterval = 0;
+    EXPECT_FALSE(sketch.takeSample());
+}
+
+TEST_F(HotKeySketchTest, record_newAndExistingKeys) {
+    read("alpha", 2);
+    Key key(1, "beta", 4);
+    sketch.recordWrite(key);
+
+    HotKeySketch::Counter* alpha = find("alpha");
+    ASSERT_TRUE(alpha != NULL);
+    EXPECT_EQ("alpha", alpha->key);
+    EXPECT_EQ(2u, alpha->count);
+    EXPECT_EQ(0u, alpha->error);
+    EXPECT_EQ(2u, alpha->reads);
+    EXPECT_EQ(0u, alpha->writes);
+    HotKeySketch::Counter* beta = find("beta");
+    ASSERT_TRUE(beta != NULL);
+    EXPECT_EQ(1u, beta->count);
+    EXPECT_EQ(1u, beta->writes);
+}
+
+TEST_F(HotKeySketchTest, record_replaceWeakestCandidate) {
+    for (uint32_t i = 0; i < HotKeySketch::COUNTERS_PER_TABLE; i++)
+        read(format("key%u", i).c_str(), (i == 5) ? 2 : 3);
+    EXPECT_EQ(static_cast<size_t>(HotKeySketch::COUNTERS_PER_TABLE),
+              sketch.tables[1].counters.size());
+
+    // A key seen once doesn't displace anything: its Count-Min estimate
+    // isn't above the weakest count.
+    read("newcomer", 2);
+    EXPECT_TRUE(find("newcomer") == NULL);
+    EXPECT_TRUE(find("key5") != NULL);
+
+    read("newcomer", 1);
+    HotKeySketch::Counter* newcomer = find("newcomer");
+    ASSERT_TRUE(newcomer != NULL);
+    EXPECT_EQ(3u, newcomer->count);
+    EXPECT_EQ(2u, newcomer->error);
+    EXPECT_EQ(1u, newcomer->reads);
+    EXPECT_TRUE(find("key5") == NULL);
+    EXPECT_EQ(static_cast<size_t>(HotKeySketch::COUNTERS_PER_TABLE),
+              sketch.tables[1].counters.size());
+}
+
+TEST_F(HotKeySketchTest, decay) {
+    read("alpha", 5);
+    read("beta", 1);
+    Key other(2, "gamma", 5);
+    sketch.recordRead(other);
+
+    sketch.decay();
+    EXPECT_EQ(1u, sketch.tables.size());
+    HotKeySketch::Counter* alpha = find("alpha");
+    ASSERT_TRUE(alpha != NULL);
+    EXPECT_EQ(2u, alpha->count);
+    EXPECT_EQ(2u, alpha->reads);
+    EXPECT_TRUE(find("beta") == NULL);
+    EXPECT_EQ(1u, sketch.tables[1].counters.size());
+
+    // The surviving candidate is still found through the index.
+    read("alpha", 1);
+    EXPECT_EQ(3u, find("alpha")->count);
+}
+
+TEST_F(HotKeySketchTest, getHotKeys) {
+    tabletManager.deleteTablet(1, 0, ~0UL);
+    uint64_t middle = 1UL << 63;
+    tabletManager.addTablet(1, 0, middle - 1, TabletManager::NORMAL);
+    tabletManager.addTablet(1, middle, ~0UL, TabletManager::NORMAL);
+    sketch.sampleInterval = 2;
+    HotKeySketch::countdown = 1;
+    for (int i = 0; i < 8; i++) {
+        // With a sample interval of 2, only every other call counts.
+        read(format("key%d", i).c_str(), 2 * (i + 1));
+    }
+    Key unowned(2, "gamma", 5);
+    sketch.recordRead(unowned);
+    sketch.recordRead(unowned);
+
+    std::vector<HotKeySketch::HotKey> keys;
+    sketch.getHotKeys(&tabletManager, &keys);
+    ASSERT_EQ(8u, keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(1u, keys[i].tableId);
+        EXPECT_EQ((keys[i].keyHash < middle) ? 0 : middle,
+                  keys[i].startKeyHash);
+        if (i == 0)
+            continue;
+        EXPECT_GE(keys[i].startKeyHash, keys[i - 1].startKeyHash);
+        if (keys[i].startKeyHash == keys[i - 1].startKeyHash) {
+            EXPECT_GE(keys[i - 1].count, keys[i].count);
+        }
+    }
+    std::map<string, uint64_t> counts;
+    foreach (HotKeySketch::HotKey& key, keys)
+        counts[key.key] = key.count;
+    EXPECT_EQ(2u, counts["key0"]);
+    EXPECT_EQ(16u, counts["key7"]);
+}
+
+TEST_F(HotKeySketchTest, collectAndParse) {
+    read("alpha", 3);
+    Key key(1, "beta", 4);
+    sketch.recordWrite(key);
+
+    Buffer buffer;
+    buffer.appendCopy("xyz", 3);
+    sketch.collect(&buffer, &tabletManager);
+    std::vector<HotKeySketch::HotKey> keys;
+    EXPECT_TRUE(HotKeySketch::parse(&buffer, 3, buffer.size() - 3, &keys));
+    ASSERT_EQ(2u, keys.size());
+    EXPECT_EQ("alpha", keys[0].key);
+    EXPECT_EQ(3u, keys[0].count);
+    EXPECT_EQ(3u, keys[0].reads);
+    EXPECT_EQ(0u, keys[0].startKeyHash);
+    EXPECT_EQ(~0UL, keys[0].endKeyHash);
+    EXPECT_EQ("beta", keys[1].key);
+    EXPECT_EQ(1u, keys[1].writes);
+
+    keys.clear();
+    EXPECT_FALSE(HotKeySketch::parse(&buffer, 3, buffer.size() - 4, &keys));
+    EXPECT_FALSE(HotKeySketch::parse(&buffer, 3, 4, &keys));
+}
+
+}  // namespace RAMCloud
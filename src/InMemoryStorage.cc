@@ -31,6 +31,7 @@ InMemoryStorage::Frame::Frame(InMemoryStorage* storage, size_t frameIndex)
     : storage(storage)
     , frameIndex(frameIndex)
     , buffer()
+    , allocatedBuffer()
     , isOpen()
     , isClosed()
     , appendedToByCurrentProcess()
@@ -109,7 +110,7 @@ void*
 InMemoryStorage::Frame::load()
 {
     startLoading();
-    return buffer.get();
+    return buffer;
 }
 
 /**
@@ -156,38 +157,62 @@ InMemoryStorage::Frame::append(Buffer& source,
 {
     Lock lock(storage->mutex);
     CycleCounter<uint64_t> ticks;
-    if (!isOpen) {
-        LOG(ERROR, "Tried to append to a frame but it wasn't"
-            "open on this backup");
-        throw BackupBadSegmentIdException(HERE);
-    }
-    if (loadRequested) {
-        LOG(NOTICE, "Tried to append to a frame but it was already enqueued "
-            "for load for recovery; calling master is probabaly already dead");
-        throw BackupBadSegmentIdException(HERE);
-    }
-    // Three conditions because overflow is possible on addition.
-    if (length > storage->segmentSize ||
-        destinationOffset > storage->segmentSize ||
-        length + destinationOffset > storage->segmentSize)
-    {
-        LOG(ERROR, "Out-of-bounds appended attempted on storage frame: "
-            "offset %lu, length %lu, segmentSize %lu ",
-            destinationOffset, length, storage->segmentSize);
-        throw BackupSegmentOverflowException(HERE);
-    }
-    if (metadataLength > METADATA_SIZE) {
-        LOG(ERROR, "Tried to append to a frame with metadata of length %lu "
-            "but storage only allows max length of %d",
-            metadataLength, METADATA_SIZE);
-        throw BackupSegmentOverflowException(HERE);
-    }
+    checkAppend(length, destinationOffset, metadataLength);
 
     appendedToByCurrentProcess = true;
     source.copy(downCast<uint32_t>(sourceOffset),
                 downCast<uint32_t>(length),
-                static_cast<char*>(buffer.get()) + destinationOffset);
+                buffer + destinationOffset);
+
+    if (metadata)
+        memcpy(this->metadata.get(), metadata, metadataLength);
+
+    storage->sleepToThrottleWrites(length + metadataLength, ticks.stop());
+}
+
+/**
+ * Return the memory holding this frame's replica data if the storage was
+ * constructed with remoteWrites set and the frame is open; NULL otherwise.
+ * See BackupStorage::Frame::getRemoteWriteBuffer().
+ */
+void*
+InMemoryStorage::Frame::getRemoteWriteBuffer()
+{
+    Lock lock(storage->mutex);
+    if (!storage->frameMemory || !isOpen)
+        return NULL;
+    return buffer;
+}
+
+/**
+ * Update metadata for data a master has already written into the buffer
+ * returned by getRemoteWriteBuffer(); otherwise just like append().
+ *
+ * \param length
+ *      Bytes the master wrote to the frame starting at \a destinationOffset.
+ * \param destinationOffset
+ *      Offset into the frame where the master wrote the data.
+ * \param metadata
+ *      See append().
+ * \param metadataLength
+ *      See append().
+ */
+void
+InMemoryStorage::Frame::appendRemotelyWritten(size_t length,
+                                              size_t destinationOffset,
+                                              const void* metadata,
+                                              size_t metadataLength)
+{
+    Lock lock(storage->mutex);
+    CycleCounter<uint64_t> ticks;
+    if (!storage->frameMemory) {
+        LOG(ERROR, "Master claims to have written replica data remotely, but "
+            "this storage can't be written remotely");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    checkAppend(length, destinationOffset, metadataLength);
 
+    appendedToByCurrentProcess = true;
     if (metadata)
         memcpy(this->metadata.get(), metadata, metadataLength);
 
@@ -238,6 +263,54 @@ InMemoryStorage::Frame::free()
 
 // - private -
 
+/**
+ * Throw an exception to the master performing an append if it can't be
+ * applied to this frame. The caller must hold storage->mutex.
+ *
+ * \param length
+ *      Bytes to be appended.
+ * \param destinationOffset
+ *      Offset into the frame where the data is to go.
+ * \param metadataLength
+ *      Bytes of metadata to go with the data.
+ *
+ * \throw BackupBadSegmentIdException
+ *      If the frame isn't open or a load has been requested.
+ * \throw BackupSegmentOverflowException
+ *      If the data or metadata doesn't fit.
+ */
+void
+InMemoryStorage::Frame::checkAppend(size_t length, size_t destinationOffset,
+                                    size_t metadataLength)
+{
+    if (!isOpen) {
+        LOG(ERROR, "Tried to append to a frame but it wasn't"
+            "open on this backup");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    if (loadRequested) {
+        LOG(NOTICE, "Tried to append to a frame but it was already enqueued "
+            "for load for recovery; calling master is probabaly already dead");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    // Three conditions because overflow is possible on addition.
+    if (length > storage->segmentSize ||
+        destinationOffset > storage->segmentSize ||
+        length + destinationOffset > storage->segmentSize)
+    {
+        LOG(ERROR, "Out-of-bounds appended attempted on storage frame: "
+            "offset %lu, length %lu, segmentSize %lu ",
+            destinationOffset, length, storage->segmentSize);
+        throw BackupSegmentOverflowException(HERE);
+    }
+    if (metadataLength > METADATA_SIZE) {
+        LOG(ERROR, "Tried to append to a frame with metadata of length %lu "
+            "but storage only allows max length of %d",
+            metadataLength, METADATA_SIZE);
+        throw BackupSegmentOverflowException(HERE);
+    }
+}
+
 /**
  * Open the frame, resetting its state to accept appends for a new replica.
  * Open is not synchronous itself. Even after return from open() if this
@@ -255,8 +328,13 @@ InMemoryStorage::Frame::open()
     Lock _(storage->mutex);
     if (isOpen || isClosed)
         return;
-    buffer.reset(new char[storage->segmentSize]);
-    memset(buffer.get(), '\0', storage->segmentSize); // Quiet valgrind.
+    if (storage->frameMemory) {
+        buffer = storage->frameMemory.get() + frameIndex * storage->segmentSize;
+    } else {
+        allocatedBuffer.reset(new char[storage->segmentSize]);
+        buffer = allocatedBuffer.get();
+    }
+    memset(buffer, '\0', storage->segmentSize); // Quiet valgrind.
     isOpen = true;
     isClosed = false;
     memset(metadata.get(), '\0', METADATA_SIZE);
@@ -276,14 +354,21 @@ InMemoryStorage::Frame::open()
  *      When specified, writes to this storage instance should be
  *      limited to at most the given rate (in megabytes per second).
  *      The special value 0 turns off throttling.
+ * \param remoteWrites
+ *      If true, memory for all frames is allocated now, in a single block
+ *      (see getFrameMemory()), so that masters may write replica data into
+ *      it directly once the caller has registered it; otherwise each frame
+ *      allocates its memory when it is opened.
  */
 InMemoryStorage::InMemoryStorage(size_t segmentSize,
                                  size_t frameCount,
-                                 size_t writeRateLimit)
+                                 size_t writeRateLimit,
+                                 bool remoteWrites)
     : BackupStorage(segmentSize, Type::MEMORY, writeRateLimit)
     , mutex()
     , frames()
     , frameCount(frameCount)
+    , frameMemory(remoteWrites ? new char[segmentSize * frameCount] : NULL)
     , freeMap(frameCount)
     , lastAllocatedFrame(FreeMap::npos)
 {
@@ -68,6 +68,11 @@ class InMemoryStorage : public BackupStorage {
                     size_t destinationOffset,
                     const void* metadata,
                     size_t metadataLength);
+        void* getRemoteWriteBuffer();
+        void appendRemotelyWritten(size_t length,
+                                   size_t destinationOffset,
+                                   const void* metadata,
+                                   size_t metadataLength);
         void close();
         void reopen(size_t length);
         void free();
@@ -76,6 +81,8 @@ class InMemoryStorage : public BackupStorage {
 
       PRIVATE:
         void open();
+        void checkAppend(size_t length, size_t destinationOffset,
+                         size_t metadataLength);
 
         bool isSynced() const;
 
@@ -86,10 +93,17 @@ class InMemoryStorage : public BackupStorage {
         const size_t frameIndex;
 
         /**
-         * Buffer where replica data is stored.
-         * Reset on free() to release memory when the frame isn't in use.
+         * Buffer where replica data is stored: #allocatedBuffer, or this
+         * frame's part of InMemoryStorage::frameMemory if there is one.
+         * Set on open().
          */
-        std::unique_ptr<char[]> buffer;
+        char* buffer;
+
+        /**
+         * Memory allocated for #buffer when the storage has no
+         * InMemoryStorage::frameMemory; replaced on each open().
+         */
+        std::unique_ptr<char[]> allocatedBuffer;
 
         /**
          * Tracks whether a replica has been opened (either initially or
@@ -136,7 +150,8 @@ class InMemoryStorage : public BackupStorage {
 
     InMemoryStorage(size_t segmentSize,
                     size_t frameCount,
-                    size_t writeRateLimit);
+                    size_t writeRateLimit,
+                    bool remoteWrites = false);
 
     FrameRef open(bool sync, ServerId masterId, uint64_t segmentId);
     size_t getMetadataSize();
@@ -148,6 +163,15 @@ class InMemoryStorage : public BackupStorage {
     void quiesce();
     void fry();
 
+    /**
+     * Return the memory holding the data of all frames, which the caller
+     * should register with the transports (see
+     * TransportManager::registerMemory) so that masters may write replica
+     * data into it directly; its size is segmentSize * frameCount. NULL
+     * unless the storage was constructed with remoteWrites set.
+     */
+    char* getFrameMemory() { return frameMemory.get(); }
+
   PRIVATE:
     /// Maximum size of metadata for each frame.
     enum { METADATA_SIZE = MultiFileStorage::METADATA_SIZE };
@@ -167,6 +191,15 @@ class InMemoryStorage : public BackupStorage {
     /// The number of replicas this storage can store simultaneously.
     const size_t frameCount;
 
+    /**
+     * If frames are to be written remotely, one block holding the data of
+     * all of them, allocated up front so it can be registered with the
+     * transports once; frame i uses the segmentSize bytes starting at
+     * i * segmentSize. Otherwise empty, and each frame allocates its own
+     * buffer when it is opened.
+     */
+    std::unique_ptr<char[]> frameMemory;
+
     /// Type of the freeMap.  A bitmap.
     typedef boost::dynamic_bitset<> FreeMap;
     /// Keeps a bit set for each frame in frames indicating if it is free.
@@ -57,6 +57,37 @@ TEST_F(InMemoryStorageTest, Frame_append) {
     EXPECT_STREQ(test, metadata);
 }
 
+TEST_F(InMemoryStorageTest, Frame_getRemoteWriteBuffer) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    EXPECT_TRUE(frame->getRemoteWriteBuffer() == NULL);
+
+    InMemoryStorage remoteStorage(segmentSize, segmentFrames, 0, true);
+    BackupStorage::FrameRef first = remoteStorage.open(false, ServerId(), 0);
+    BackupStorage::FrameRef second = remoteStorage.open(false, ServerId(), 1);
+    EXPECT_EQ(remoteStorage.getFrameMemory(), first->getRemoteWriteBuffer());
+    EXPECT_EQ(remoteStorage.getFrameMemory() + segmentSize,
+              second->getRemoteWriteBuffer());
+    first->close();
+    EXPECT_TRUE(first->getRemoteWriteBuffer() == NULL);
+}
+
+TEST_F(InMemoryStorageTest, Frame_appendRemotelyWritten) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    EXPECT_THROW(frame->appendRemotelyWritten(5, 0, test, testLength + 1),
+                 BackupBadSegmentIdException);
+
+    InMemoryStorage remoteStorage(segmentSize, segmentFrames, 0, true);
+    BackupStorage::FrameRef remoteFrame =
+        remoteStorage.open(false, ServerId(), 0);
+    EXPECT_THROW(remoteFrame->appendRemotelyWritten(5, segmentSize, NULL, 0),
+                 BackupSegmentOverflowException);
+    memcpy(remoteFrame->getRemoteWriteBuffer(), test, testLength + 1);
+    remoteFrame->appendRemotelyWritten(5, 0, test, testLength + 1);
+    EXPECT_TRUE(remoteFrame->wasAppendedToByCurrentProcess());
+    EXPECT_STREQ(test, bytes(remoteFrame->load()));
+    EXPECT_STREQ(test, static_cast<const char*>(remoteFrame->getMetadata()));
+}
+
 TEST_F(InMemoryStorageTest, open) {
     BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
     EXPECT_EQ(0, storage->freeMap[0]);
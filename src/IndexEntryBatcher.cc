@@ -0,0 +1,226 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "IndexEntryBatcher.h"
+#include "Dispatch.h"
+#include "ObjectFinder.h"
+
+namespace RAMCloud {
+
+/**
+ * Constructor for IndexEntryBatcher.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server; used to find the
+ *      index servers and to send rpcs to them.
+ * \param maxEntriesPerBatch
+ *      Largest number of entries sent in one IndexEntryBatchRpc.
+ * \param maxBytesPerBatch
+ *      No more entries are added to an IndexEntryBatchRpc once its keys
+ *      add up to this many bytes.
+ */
+IndexEntryBatcher::IndexEntryBatcher(Context* context,
+                                     uint32_t maxEntriesPerBatch,
+                                     uint32_t maxBytesPerBatch)
+    : context(context)
+    , maxEntriesPerBatch(maxEntriesPerBatch)
+    , maxBytesPerBatch(maxBytesPerBatch)
+    , mutex("IndexEntryBatcher")
+    , servers()
+{
+}
+
+/**
+ * Begin applying a set of index entries. The entries are sent right away to
+ * index servers that have no batch in flight; the others get them with
+ * their next batch. The caller must eventually call wait() on \a updates.
+ *
+ * \param updates
+ *      Entries to insert and remove. No more entries may be added to it.
+ */
+void
+IndexEntryBatcher::start(Updates* updates)
+{
+    if (updates->entries.empty())
+        return;
+
+    // Find the servers before taking the lock, since this may have to fetch
+    // the configuration of the table from the coordinator.
+    std::vector<Transport::SessionRef> sessions;
+    sessions.reserve(updates->entries.size());
+    foreach (Entry& entry, updates->entries) {
+        bool indexDoesntExist = false;
+        Transport::SessionRef session = context->objectFinder->tryLookup(
+                entry.tableId, entry.indexId, entry.key, entry.keyLength,
+                &indexDoesntExist);
+        if (!session) {
+            // Leave this one to wait(); it doesn't need to share the lock
+            // for that, since no other thread has seen the entry.
+            entry.status = indexDoesntExist ? STATUS_INDEX_DOESNT_EXIST
+                                            : STATUS_RETRY;
+            entry.done = true;
+        }
+        sessions.push_back(session);
+    }
+
+    SpinLock::Guard lock(mutex);
+    for (size_t i = 0; i < updates->entries.size(); i++) {
+        if (!sessions[i])
+            continue;
+        Server& server = servers[sessions[i].get()];
+        server.session = sessions[i];
+        server.pending.push_back(&updates->entries[i]);
+    }
+    for (auto it = servers.begin(); it != servers.end(); ++it) {
+        Server& server = it->second;
+        if (!server.rpc && !server.pending.empty())
+            sendBatch(server, lock);
+    }
+}
+
+/**
+ * Wait for a set of index entries passed to start() to be applied. While
+ * waiting, this method also collects the results of any batch that
+ * completes and sends the entries that queued up behind it, whoever they
+ * belong to. Entries that didn't succeed in a batch are then redone one at a
+ * time, with InsertIndexEntryRpcs and RemoveIndexEntryRpcs.
+ *
+ * \param updates
+ *      Entries previously passed to start().
+ *
+ * \throw ClientException
+ *      An index server rejected one of the entries; this is the same
+ *      exception an InsertIndexEntryRpc or RemoveIndexEntryRpc for it would
+ *      have thrown.
+ */
+void
+IndexEntryBatcher::wait(Updates* updates)
+{
+    if (updates->entries.empty())
+        return;
+
+    // Servers have a separate dispatch thread that makes progress on the
+    // rpcs; in unit tests we're in the dispatch thread and must poll it.
+    bool isDispatchThread = context->dispatch->isDispatchThread();
+    while (true) {
+        {
+            SpinLock::Guard lock(mutex);
+            poll(lock);
+            bool done = true;
+            foreach (Entry& entry, updates->entries) {
+                if (!entry.done) {
+                    done = false;
+                    break;
+                }
+            }
+            if (done)
+                break;
+        }
+        if (isDispatchThread)
+            context->dispatch->poll();
+    }
+
+    // No other thread refers to the entries anymore.
+    size_t numEntries = updates->entries.size();
+    Tub<InsertIndexEntryRpc> inserts[numEntries];
+    Tub<RemoveIndexEntryRpc> removes[numEntries];
+    for (size_t i = 0; i < numEntries; i++) {
+        Entry& entry = updates->entries[i];
+        if (entry.status == STATUS_OK)
+            continue;
+        if (entry.remove) {
+            removes[i].construct(context, entry.tableId, entry.indexId,
+                    entry.key, entry.keyLength, entry.primaryKeyHash);
+        } else {
+            inserts[i].construct(context, entry.tableId, entry.indexId,
+                    entry.key, entry.keyLength, entry.primaryKeyHash);
+        }
+    }
+    for (size_t i = 0; i < numEntries; i++) {
+        if (inserts[i])
+            inserts[i]->wait();
+        if (removes[i])
+            removes[i]->wait();
+    }
+}
+
+/**
+ * Collect the results of every batch that has completed, and send the next
+ * batch to each of those servers if it has pending entries.
+ *
+ * \param lock
+ *      Ensures that the caller holds #mutex.
+ */
+void
+IndexEntryBatcher::poll(const SpinLock::Guard& lock)
+{
+    for (auto it = servers.begin(); it != servers.end(); ) {
+        Server& server = it->second;
+        if (server.rpc) {
+            bool failed = false;
+            try {
+                if (!server.rpc->isReady()) {
+                    ++it;
+                    continue;
+                }
+            } catch (ClientException& e) {
+                failed = true;
+            }
+            for (uint32_t i = 0; i < server.sent.size(); i++) {
+                Entry* entry = server.sent[i];
+                entry->status = failed ? STATUS_RETRY
+                                       : server.rpc->getStatus(i);
+                entry->done = true;
+            }
+            server.sent.clear();
+            server.rpc.destroy();
+        }
+        if (server.pending.empty()) {
+            it = servers.erase(it);
+        } else {
+            sendBatch(server, lock);
+            ++it;
+        }
+    }
+}
+
+/**
+ * Send as many of a server's pending entries as fit in one batch.
+ *
+ * \param server
+ *      Server with pending entries and no batch in flight.
+ * \param lock
+ *      Ensures that the caller holds #mutex.
+ */
+void
+IndexEntryBatcher::sendBatch(Server& server, const SpinLock::Guard& lock)
+{
+    assert(!server.rpc && server.sent.empty());
+    server.rpc.construct(server.session);
+    uint32_t bytes = 0;
+    while (!server.pending.empty() &&
+            server.rpc->getEntryCount() < maxEntriesPerBatch &&
+            bytes < maxBytesPerBatch) {
+        Entry* entry = server.pending.front();
+        server.pending.pop_front();
+        server.rpc->appendEntry(entry->tableId, entry->indexId, entry->key,
+                entry->keyLength, entry->primaryKeyHash, entry->remove);
+        bytes += entry->keyLength;
+        server.sent.push_back(entry);
+    }
+    server.rpc->send();
+}
+
+} // namespace RAMCloud
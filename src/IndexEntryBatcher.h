@@ -0,0 +1,183 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_INDEXENTRYBATCHER_H
+#define RAMCLOUD_INDEXENTRYBATCHER_H
+
+#include <deque>
+#include <unordered_map>
+
+#include "Common.h"
+#include "Key.h"
+#include "MasterClient.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * Sends the index entry insertions and removals that a data master makes
+ * when objects with secondary keys are written or removed. Rather than one
+ * InsertIndexEntryRpc or RemoveIndexEntryRpc for each secondary key, the
+ * entries bound for the same index server are combined into
+ * IndexEntryBatchRpcs, across all the worker threads updating indexes at
+ * the same time.
+ *
+ * Batching works like group commit in Log::sync: at most one rpc is in
+ * flight to each index server. Entries handed to start() while one is
+ * outstanding queue up behind it, and whichever waiting thread notices the
+ * rpc complete sends everything that queued up in the meantime as the next
+ * batch. A server with no rpc in flight gets the entries right away, so an
+ * uncontended update costs no more than before.
+ *
+ * Entries are applied in the order they were started. Any entry that
+ * didn't succeed in a batch (the indexlet moved, the server crashed, ...)
+ * is redone by wait() with an individual rpc, which handles all the
+ * retries exactly as before.
+ *
+ * This class is thread-safe.
+ */
+class IndexEntryBatcher {
+  PUBLIC:
+    /**
+     * The index entries to insert and remove for one or more objects,
+     * collected by a caller and handed to start() and wait() as a whole.
+     * Entries may not be added once the Updates have been started, and the
+     * keys must stay unchanged until wait() returns.
+     */
+    class Updates {
+      PUBLIC:
+        Updates()
+            : entries()
+        {}
+
+        void
+        insert(uint64_t tableId, uint8_t indexId, const void* key,
+               KeyLength keyLength, KeyHash primaryKeyHash)
+        {
+            entries.emplace_back(tableId, indexId, key, keyLength,
+                                 primaryKeyHash, false);
+        }
+
+        void
+        remove(uint64_t tableId, uint8_t indexId, const void* key,
+               KeyLength keyLength, KeyHash primaryKeyHash)
+        {
+            entries.emplace_back(tableId, indexId, key, keyLength,
+                                 primaryKeyHash, true);
+        }
+
+        /// Return the number of entries added so far.
+        size_t size() const { return entries.size(); }
+
+      PRIVATE:
+        /// A single index entry and its progress.
+        struct Entry {
+            Entry(uint64_t tableId, uint8_t indexId, const void* key,
+                  KeyLength keyLength, KeyHash primaryKeyHash, bool remove)
+                : tableId(tableId)
+                , indexId(indexId)
+                , key(key)
+                , keyLength(keyLength)
+                , primaryKeyHash(primaryKeyHash)
+                , remove(remove)
+                , done(false)
+                , status(STATUS_OK)
+            {}
+
+            uint64_t tableId;
+            uint8_t indexId;
+            const void* key;
+            KeyLength keyLength;
+            KeyHash primaryKeyHash;
+
+            /// True to remove the entry, false to insert it.
+            bool remove;
+
+            /// Set (with IndexEntryBatcher::mutex held) once the batch
+            /// carrying this entry has completed or the entry couldn't be
+            /// batched at all.
+            bool done;
+
+            /// Outcome once #done is set; anything but STATUS_OK means wait()
+            /// must redo the entry on its own.
+            Status status;
+        };
+
+        /// Entries in the order they were added.
+        std::vector<Entry> entries;
+
+        friend class IndexEntryBatcher;
+        DISALLOW_COPY_AND_ASSIGN(Updates);
+    };
+
+    explicit IndexEntryBatcher(Context* context,
+                               uint32_t maxEntriesPerBatch = 1000,
+                               uint32_t maxBytesPerBatch = 1024 * 1024);
+    ~IndexEntryBatcher() {}
+
+    void start(Updates* updates);
+    void wait(Updates* updates);
+
+  PRIVATE:
+    typedef Updates::Entry Entry;
+
+    /// Batching state for one index server.
+    struct Server {
+        Server()
+            : session()
+            , pending()
+            , sent()
+            , rpc()
+        {}
+
+        /// Session all the entries below are sent on.
+        Transport::SessionRef session;
+
+        /// Entries waiting for #rpc to finish before they can be sent.
+        std::deque<Entry*> pending;
+
+        /// Entries carried by #rpc, in order.
+        std::vector<Entry*> sent;
+
+        /// The batch in flight to this server, if any.
+        Tub<IndexEntryBatchRpc> rpc;
+    };
+
+    void poll(const SpinLock::Guard& lock);
+    void sendBatch(Server& server, const SpinLock::Guard& lock);
+
+    /// Shared RAMCloud information.
+    Context* context;
+
+    /// A batch never holds more than this many entries.
+    const uint32_t maxEntriesPerBatch;
+
+    /// A batch is closed once its keys add up to at least this many bytes.
+    const uint32_t maxBytesPerBatch;
+
+    /// Protects #servers and the #Entry::done and #Entry::status fields of
+    /// every entry that has been started.
+    SpinLock mutex;
+
+    /// Index servers with entries in flight or pending, indexed by session.
+    /// A server is dropped once it has neither.
+    std::unordered_map<Transport::Session*, Server> servers;
+
+    DISALLOW_COPY_AND_ASSIGN(IndexEntryBatcher);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_INDEXENTRYBATCHER_H
@@ -0,0 +1,159 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "IndexEntryBatcher.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class IndexEntryBatcherTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+    Tub<IndexEntryBatcher> batcher;
+
+    IndexEntryBatcherTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , tableId()
+        , batcher()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::BACKUP_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table");
+        ramcloud->createIndex(tableId, 1, 0);
+        ramcloud->createIndex(tableId, 2, 0);
+        batcher.construct(ramcloud->clientContext);
+    }
+
+    /// Return the number of entries for \a key in index \a indexId.
+    uint32_t
+    countEntries(uint8_t indexId, const char* key)
+    {
+        Buffer responseBuffer;
+        uint32_t numHashes;
+        uint16_t nextKeyLength;
+        uint64_t nextKeyHash;
+        KeyLength keyLength = downCast<KeyLength>(strlen(key));
+        ramcloud->lookupIndexKeys(tableId, indexId, key, keyLength, 0,
+                key, keyLength, 100, &responseBuffer, &numHashes,
+                &nextKeyLength, &nextKeyHash);
+        return numHashes;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(IndexEntryBatcherTest);
+};
+
+TEST_F(IndexEntryBatcherTest, start_oneBatchPerServer) {
+    IndexEntryBatcher::Updates updates;
+    updates.insert(tableId, 1, "air", 3, 10);
+    updates.insert(tableId, 2, "earth", 5, 10);
+    updates.insert(tableId, 1, "air", 3, 11);
+    TestLog::Enable _("indexEntryBatch");
+    batcher->start(&updates);
+    batcher->wait(&updates);
+    EXPECT_EQ("indexEntryBatch: applied 3 entries", TestLog::get());
+    EXPECT_EQ(2U, countEntries(1, "air"));
+    EXPECT_EQ(1U, countEntries(2, "earth"));
+    EXPECT_EQ(0U, batcher->servers.size());
+}
+
+TEST_F(IndexEntryBatcherTest, start_queuesBehindBatchInFlight) {
+    IndexEntryBatcher::Updates first;
+    first.insert(tableId, 1, "air", 3, 10);
+    IndexEntryBatcher::Updates second;
+    second.insert(tableId, 1, "earth", 5, 10);
+    second.remove(tableId, 1, "air", 3, 10);
+
+    TestLog::Enable _("indexEntryBatch");
+    batcher->start(&first);
+    batcher->start(&second);
+    ASSERT_EQ(1U, batcher->servers.size());
+    IndexEntryBatcher::Server& server = batcher->servers.begin()->second;
+    EXPECT_TRUE(server.rpc);
+    EXPECT_EQ(1U, server.sent.size());
+    EXPECT_EQ(2U, server.pending.size());
+
+    // Waiting for the second batch also finishes the first.
+    batcher->wait(&second);
+    EXPECT_TRUE(first.entries[0].done);
+    EXPECT_EQ("indexEntryBatch: applied 1 entries | "
+              "indexEntryBatch: applied 2 entries", TestLog::get());
+    batcher->wait(&first);
+    EXPECT_EQ(0U, countEntries(1, "air"));
+    EXPECT_EQ(1U, countEntries(1, "earth"));
+}
+
+TEST_F(IndexEntryBatcherTest, sendBatch_limits) {
+    batcher.construct(ramcloud->clientContext, 2, 4);
+    IndexEntryBatcher::Updates updates;
+    updates.insert(tableId, 1, "a", 1, 10);
+    updates.insert(tableId, 1, "b", 1, 10);
+    updates.insert(tableId, 1, "c", 1, 10);
+    updates.insert(tableId, 1, "long key", 8, 10);
+    updates.insert(tableId, 1, "d", 1, 10);
+    TestLog::Enable _("indexEntryBatch");
+    batcher->start(&updates);
+    batcher->wait(&updates);
+    EXPECT_EQ("indexEntryBatch: applied 2 entries | "
+              "indexEntryBatch: applied 2 entries | "
+              "indexEntryBatch: applied 1 entries", TestLog::get());
+}
+
+TEST_F(IndexEntryBatcherTest, wait_redoesFailedEntries) {
+    // Make sure the index configuration is cached, so that the batch is the
+    // next rpc sent.
+    bool indexDoesntExist;
+    EXPECT_TRUE(ramcloud->clientContext->objectFinder->tryLookup(
+            tableId, 1, "air", 3, &indexDoesntExist));
+
+    IndexEntryBatcher::Updates updates;
+    updates.insert(tableId, 1, "air", 3, 10);
+    updates.insert(tableId, 1, "earth", 5, 10);
+    cluster.transport.abortCounter = 1;
+    TestLog::Enable _("indexEntryBatch");
+    batcher->start(&updates);
+    batcher->wait(&updates);
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(1U, countEntries(1, "air"));
+    EXPECT_EQ(1U, countEntries(1, "earth"));
+}
+
+TEST_F(IndexEntryBatcherTest, wait_indexDoesntExist) {
+    IndexEntryBatcher::Updates updates;
+    updates.insert(tableId, 3, "air", 3, 10);
+    batcher->start(&updates);
+    EXPECT_TRUE(updates.entries[0].done);
+    EXPECT_EQ(STATUS_INDEX_DOESNT_EXIST, updates.entries[0].status);
+    batcher->wait(&updates);
+    EXPECT_EQ(0U, batcher->servers.size());
+}
+
+}  // namespace RAMCloud
@@ -42,11 +42,13 @@ IndexLookup::IndexLookup(
         IndexKey::IndexKeyRange keyRange)
     : ramcloud(ramcloud)
     , lookupRpc()
+    , readBatchSize(MIN_PKHASHES_PER_RPC)
     , tableId(tableId)
     , keyRange(keyRange)
     , nextKey(NULL)
     , nextKeyLength(0)
     , nextKeyHash(0)
+    , pendingHashes()
     , numInserted(0)
     , numRemoved(0)
     , numAssigned(0)
@@ -109,9 +111,13 @@ IndexLookup::isReady()
         // Handle the completion of a LookupIndexKeys RPC.
         if (lookupRpc.status == SENT && lookupRpc.rpc->isReady()) {
             uint16_t oldKeyLength = nextKeyLength; // should be 0 for first rpc.
+            uint32_t numReadHashes, numObjects;
             lookupRpc.rpc->wait(&lookupRpc.numHashes, &nextKeyLength,
-                    &nextKeyHash);
-            lookupRpc.offset = sizeof32(WireFormat::LookupIndexKeys::Response);
+                    &nextKeyHash, &numReadHashes, &numObjects);
+            lookupRpc.offset =
+                    sizeof32(WireFormat::LookupIndexKeysAndRead::Response);
+            uint32_t off = lookupRpc.offset
+                + (lookupRpc.numHashes * (uint32_t) sizeof(KeyHash));
 
             // Save the "next key" information from this response,
             // which will be used as the starting key for the next
@@ -123,18 +129,28 @@ IndexLookup::isReady()
                         free(nextKey);
                     nextKey = malloc(nextKeyLength);
                 }
-                uint32_t off = lookupRpc.offset
-                    + (lookupRpc.numHashes * (uint32_t) sizeof(KeyHash));
                 lookupRpc.resp.copy(off, nextKeyLength, nextKey);
             }
+            if (numReadHashes > 0) {
+                adoptLookupObjects(numReadHashes, numObjects,
+                        off + nextKeyLength);
+            }
             lookupRpc.status = RESULT_READY;
         }
 
         // Rule 2:
-        // If a returned lookupIndexKeys RPC still has some activeHashes
-        // unread, copy as much of them into activeHashes as possible.
+        // Copy as many of the PKHashes returned by lookups into activeHashes
+        // as possible, oldest first; the rest wait in pendingHashes, which
+        // frees lookupRpc.resp for the next lookup.
+        while (!pendingHashes.empty()
+                && numInserted - numRemoved < MAX_NUM_PK) {
+            activeHashes[numInserted & ARRAY_MASK] = pendingHashes.front();
+            activeRpcIds[numInserted & ARRAY_MASK] = RPC_ID_NOT_ASSIGNED;
+            pendingHashes.pop_front();
+            numInserted++;
+        }
         if (lookupRpc.status == RESULT_READY && lookupRpc.numHashes > 0) {
-            while (lookupRpc.numHashes > 0
+            while (pendingHashes.empty() && lookupRpc.numHashes > 0
                     && numInserted - numRemoved < MAX_NUM_PK) {
                 // Possible optimization: Consider copying all PKHashes at once.
                 // Greg's note: probably wont help much, as of fall 2014 most
@@ -146,20 +162,29 @@ IndexLookup::isReady()
                 lookupRpc.numHashes--;
                 numInserted++;
             }
+            while (lookupRpc.numHashes > 0) {
+                pendingHashes.push_back(
+                        *lookupRpc.resp.getOffset<KeyHash>(lookupRpc.offset));
+                lookupRpc.offset += sizeof32(KeyHash);
+                lookupRpc.numHashes--;
+            }
         }
 
         // Rule 3:
         // If a returned lookupIndexKeys RPC has no unread PKHashes,
-        // issue the next lookupIndexKeys RPC, if another RPC is still needed,
+        // issue the next lookupIndexKeys RPC, if another RPC is still needed
+        // and not too many PKHashes are already waiting for activeHashes,
         // and set the status of the RPC to free if another RPC is not needed
         // (and the lookup is all done).
         if (lookupRpc.status == RESULT_READY && lookupRpc.numHashes == 0) {
             // Here we exploit the fact that 'nextKeyLength == 0'
             // indicates the index server contains the index key up to lastKey
             if (nextKeyLength == 0) {
-                finishedLookup = true;
-                lookupRpc.status = FREE;
-            } else {
+                if (pendingHashes.empty()) {
+                    finishedLookup = true;
+                    lookupRpc.status = FREE;
+                }
+            } else if (pendingHashes.size() < MAX_ALLOWED_HASHES) {
                 lookupRpc.rpc.construct(ramcloud, tableId, keyRange.indexId,
                         nextKey, nextKeyLength, nextKeyHash,
                         keyRange.lastKey, keyRange.lastKeyLength,
@@ -202,7 +227,7 @@ IndexLookup::isReady()
                     // read RPC obey index order.
                     // This check is useful during retries after server crashes.
                     && readRpcs[i].maxPos < numAssigned
-                    && readRpcs[i].numHashes < MAX_PKHASHES_PER_RPC) {
+                    && readRpcs[i].numHashes < readBatchSize) {
                 readactiveRpcId = i;
                 break;
             }
@@ -237,15 +262,26 @@ IndexLookup::isReady()
         }
     }
 
+    uint8_t numReadsInFlight = 0;
+    for (uint8_t i = 0; i < NUM_READ_RPCS; i++) {
+        if (readRpcs[i].status == SENT)
+            numReadsInFlight++;
+    }
+
     // Start to check rules for every readHashes RPC.
     for (uint8_t i = 0; i < NUM_READ_RPCS; i++) {
         // Rule 7:
         // If some readHashes RPC has enough PKHashes to send
-        // or all PKHashes have been assigned, launch that RPC.
+        // or all PKHashes have been assigned, launch that RPC. Also launch
+        // it if there is nothing else to assign to it for now and too few
+        // RPCs are outstanding to keep the data servers busy.
         if (readRpcs[i].status == LOADING
-                && (readRpcs[i].numHashes >= MAX_PKHASHES_PER_RPC
-                    || finishedLookup)) {
+                && (readRpcs[i].numHashes >= readBatchSize
+                    || finishedLookup
+                    || (numAssigned == numInserted
+                        && numReadsInFlight < MIN_READS_IN_FLIGHT))) {
             launchReadRpc(i);
+            numReadsInFlight++;
         }
 
         // Rule 8:
@@ -254,10 +290,20 @@ IndexLookup::isReady()
         if (readRpcs[i].status == SENT
                 && readRpcs[i].rpc->isReady()) {
             receivedReadHashes = true;
+            uint32_t hashesPerResponse;
             uint32_t numProcessedPKHashes =
-                    readRpcs[i].rpc->wait(&readRpcs[i].numUnreadObjects);
+                    readRpcs[i].rpc->wait(&readRpcs[i].numUnreadObjects,
+                    &hashesPerResponse);
             readRpcs[i].offset = sizeof32(WireFormat::ReadHashes::Response);
             readRpcs[i].status = RESULT_READY;
+            numReadsInFlight--;
+            if (hashesPerResponse > 0) {
+                readBatchSize = hashesPerResponse;
+                if (readBatchSize < MIN_PKHASHES_PER_RPC)
+                    readBatchSize = MIN_PKHASHES_PER_RPC;
+                if (readBatchSize > MAX_PKHASHES_PER_RPC)
+                    readBatchSize = MAX_PKHASHES_PER_RPC;
+            }
             // Update objectFinder if no pKHashes got processed in a readRpc.
             if (numProcessedPKHashes == 0)
                 ramcloud->clientContext->objectFinder->flush(tableId);
@@ -332,6 +378,65 @@ IndexLookup::isReady()
     return false;
 }
 
+/**
+ * This method is invoked when a lookup RPC returns the objects for some of
+ * its key hashes, because the index server also stores (that part of) the
+ * table. If possible, the objects are handed to a free ReadRpc as if it had
+ * just read them, so these hashes need no READ_HASHES round trip. If all the
+ * hashes don't fit in activeHashes or no ReadRpc is free, the objects are
+ * ignored and the hashes are read as usual.
+ *
+ * \param numReadHashes
+ *      The objects for this many of the returned key hashes, starting
+ *      with the first one not yet copied to activeHashes, are in
+ *      lookupRpc.resp.
+ * \param numObjects
+ *      Number of objects in lookupRpc.resp.
+ * \param objectsOffset
+ *      Offset in lookupRpc.resp of the first object.
+ */
+void
+IndexLookup::adoptLookupObjects(uint32_t numReadHashes, uint32_t numObjects,
+        uint32_t objectsOffset)
+{
+    // The hashes of earlier lookups have all been copied to activeHashes
+    // (see Rule 3), so unless some are still pending these will go in next
+    // and stay in index order.
+    if (!pendingHashes.empty() || numReadHashes > lookupRpc.numHashes ||
+            MAX_NUM_PK - (numInserted - numRemoved) < numReadHashes)
+        return;
+    uint8_t i = 0;
+    while (i < NUM_READ_RPCS && readRpcs[i].status != FREE)
+        i++;
+    if (i == NUM_READ_RPCS)
+        return;
+
+    // The objects must be copied: lookupRpc.resp is reused by the next
+    // lookup while they are still being returned to the client.
+    ReadRpc& readRpc = readRpcs[i];
+    uint32_t objectsLength = lookupRpc.resp.size() - objectsOffset;
+    readRpc.resp.reset();
+    if (objectsLength > 0) {
+        lookupRpc.resp.copy(objectsOffset, objectsLength,
+                readRpc.resp.alloc(objectsLength));
+    }
+    readRpc.offset = 0;
+    readRpc.numUnreadObjects = numObjects;
+    readRpc.numHashes = numReadHashes;
+    readRpc.session = Transport::SessionRef();
+    readRpc.status = RESULT_READY;
+
+    for (uint32_t h = 0; h < numReadHashes; h++) {
+        activeHashes[numInserted & ARRAY_MASK]
+            = *lookupRpc.resp.getOffset<KeyHash>(lookupRpc.offset);
+        activeRpcIds[numInserted & ARRAY_MASK] = i;
+        lookupRpc.offset += sizeof32(KeyHash);
+        lookupRpc.numHashes--;
+        numInserted++;
+    }
+    readRpc.maxPos = numInserted - 1;
+}
+
 /**
  * Wait until either another object in the proper index range
  * is available or all objects have been returned.
@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_INDEXLOOKUP_H
 #define RAMCLOUD_INDEXLOOKUP_H
 
+#include <deque>
+
 #include "RamCloud.h"
 #include "IndexKey.h"
 
@@ -65,8 +67,8 @@ class IndexLookup {
 
     /// Struct for lookupIndexKeys RPC.
     struct LookupRpc {
-        /// The tub that contains RamCloud::LookupIndexKeysRpc.
-        Tub<LookupIndexKeysRpc> rpc;
+        /// The tub that contains the RamCloud::LookupIndexKeysAndReadRpc.
+        Tub<LookupIndexKeysAndReadRpc> rpc;
 
         /// The status of rpc.
         RpcStatus status;
@@ -129,6 +131,8 @@ class IndexLookup {
         {}
     };
 
+    void adoptLookupObjects(uint32_t numReadHashes, uint32_t numObjects,
+            uint32_t objectsOffset);
     void launchReadRpc(uint8_t i);
 
     /// Overall client state information.
@@ -145,12 +149,29 @@ class IndexLookup {
     //////////////////////////////////////////////////////////////////////////
 
     /// Max number of allowed ReadRpc's.
-    static const uint8_t NUM_READ_RPCS = 10;
+    static const uint8_t NUM_READ_RPCS = 32;
 
     /// Max number of PKHashes that will be sent in a single
     /// RamCloud::ReadHashesRpc.
     static const uint32_t MAX_PKHASHES_PER_RPC = 256;
 
+    /// Number of PKHashes a RamCloud::ReadHashesRpc is filled with before
+    /// any data server has told us how many fit in a response (and the
+    /// least readBatchSize ever drops to).
+    static const uint32_t MIN_PKHASHES_PER_RPC = 16;
+
+    /// While fewer than this many ReadRpc's are outstanding, a LOADING one
+    /// is sent as soon as all available PKHashes have been assigned, rather
+    /// than waiting for it to fill up; this keeps data servers busy while
+    /// the next lookup is on its way.
+    static const uint8_t MIN_READS_IN_FLIGHT = 8;
+
+    /// Number of PKHashes to put in a RamCloud::ReadHashesRpc before it is
+    /// sent. It follows the hashesPerResponse hints returned by data
+    /// servers, within [MIN_PKHASHES_PER_RPC, MAX_PKHASHES_PER_RPC], so that
+    /// requests ask for about as many objects as fit in one response.
+    uint32_t readBatchSize;
+
     /// A special value to be assigned to any activeRpcIds[i] when the
     /// corresponding PKHash (given by activeHashes[i]) has not been
     /// assigned to any ongoing RamCloud::ReadHashesRpc's.
@@ -192,6 +213,13 @@ class IndexLookup {
     /// to be returned in the next RamCloud::LookupIndexKeysRpc.
     uint64_t nextKeyHash;
 
+    /// PKHashes returned by lookups that didn't fit in activeHashes yet.
+    /// Moving them here frees lookupRpc.resp, so the next lookup can be
+    /// prefetched while the client is still working through earlier
+    /// objects; at most MAX_ALLOWED_HASHES are held before that lookup is
+    /// issued.
+    std::deque<KeyHash> pendingHashes;
+
     //////////////////////////////////////////////////////////////////////////
     // The following declarations are used to manage a collection
     // of "active hashes". This is a circular buffer of primary key
@@ -145,6 +145,9 @@ TEST_F(IndexLookupTest, isReady_lookupComplete) {
     respBuffer->emplaceAppend<uint16_t>(uint16_t(nextKeyLen));
     // nextKeyHash
     respBuffer->emplaceAppend<uint64_t>(0);
+    // numReadHashes and numObjects
+    respBuffer->emplaceAppend<uint32_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
     for (KeyHash i = 0; i < 10; i++) {
         respBuffer->emplaceAppend<KeyHash>(i);
     }
@@ -168,6 +171,8 @@ TEST_F(IndexLookupTest, isReady_activeHashes) {
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(10);
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint16_t>(uint16_t(0));
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint64_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
     for (KeyHash i = 0; i < 10; i++) {
         indexLookup.lookupRpc.rpc->response->emplaceAppend<KeyHash>(i);
     }
@@ -191,6 +196,8 @@ TEST_F(IndexLookupTest, isReady_issueNextLookup) {
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(10);
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint16_t>(uint16_t(1));
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint64_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
     for (KeyHash i = 0; i < 10; i++) {
         indexLookup.lookupRpc.rpc->response->emplaceAppend<KeyHash>(i);
     }
@@ -216,6 +223,8 @@ TEST_F(IndexLookupTest, isReady_allLookupCompleted) {
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(10);
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint16_t>(uint16_t(0));
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint64_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
     for (KeyHash i = 0; i < 10; i++) {
         indexLookup.lookupRpc.rpc->response->emplaceAppend<KeyHash>(i);
     }
@@ -226,6 +235,113 @@ TEST_F(IndexLookupTest, isReady_allLookupCompleted) {
     EXPECT_TRUE(indexLookup.finishedLookup);
 }
 
+// Rule 1, when the lookup also returned objects.
+TEST_F(IndexLookupTest, isReady_lookupReturnedObjects) {
+    TestLog::Enable _;
+    IndexLookup indexLookup(ramcloud.get(), 10, azKeyRange);
+    Buffer* respBuffer = indexLookup.lookupRpc.rpc->response;
+    respBuffer->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
+    respBuffer->emplaceAppend<uint32_t>(3);
+    respBuffer->emplaceAppend<uint16_t>(uint16_t(0));
+    respBuffer->emplaceAppend<uint64_t>(0);
+    // numReadHashes and numObjects
+    respBuffer->emplaceAppend<uint32_t>(2);
+    respBuffer->emplaceAppend<uint32_t>(1);
+    for (KeyHash i = 0; i < 3; i++) {
+        respBuffer->emplaceAppend<KeyHash>(i);
+    }
+    respBuffer->emplaceAppend<uint64_t>(5);
+    respBuffer->emplaceAppend<uint32_t>(4);
+    respBuffer->appendCopy("abcd", 4);
+    indexLookup.lookupRpc.rpc->completed();
+    indexLookup.isReady();
+
+    // The first two hashes are served by the objects that came back.
+    IndexLookup::ReadRpc& readRpc = indexLookup.readRpcs[0];
+    EXPECT_EQ(IndexLookup::RESULT_READY, readRpc.status);
+    EXPECT_FALSE(readRpc.rpc);
+    EXPECT_EQ(2U, readRpc.numHashes);
+    EXPECT_EQ(1U, readRpc.numUnreadObjects);
+    EXPECT_EQ(1U, readRpc.maxPos);
+    EXPECT_EQ(16U, readRpc.resp.size());
+    EXPECT_EQ(5U, *readRpc.resp.getOffset<uint64_t>(0));
+    EXPECT_EQ(0, indexLookup.activeRpcIds[0]);
+    EXPECT_EQ(0, indexLookup.activeRpcIds[1]);
+
+    // The last one has to be read separately.
+    EXPECT_EQ(3U, indexLookup.numInserted);
+    EXPECT_EQ(1, indexLookup.activeRpcIds[2]);
+    EXPECT_EQ(1U, indexLookup.readRpcs[1].numHashes);
+    EXPECT_EQ(IndexLookup::SENT, indexLookup.readRpcs[1].status);
+}
+
+TEST_F(IndexLookupTest, isReady_lookupReturnedObjectsNoFreeReadRpc) {
+    TestLog::Enable _;
+    IndexLookup indexLookup(ramcloud.get(), 10, azKeyRange);
+    for (uint8_t i = 0; i < IndexLookup::NUM_READ_RPCS; i++) {
+        indexLookup.readRpcs[i].status = IndexLookup::RESULT_READY;
+        indexLookup.readRpcs[i].numUnreadObjects = 1;
+    }
+    Buffer* respBuffer = indexLookup.lookupRpc.rpc->response;
+    respBuffer->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
+    respBuffer->emplaceAppend<uint32_t>(1);
+    respBuffer->emplaceAppend<uint16_t>(uint16_t(0));
+    respBuffer->emplaceAppend<uint64_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(1);
+    respBuffer->emplaceAppend<uint32_t>(1);
+    respBuffer->emplaceAppend<KeyHash>(0);
+    respBuffer->emplaceAppend<uint64_t>(5);
+    respBuffer->emplaceAppend<uint32_t>(4);
+    respBuffer->appendCopy("abcd", 4);
+    indexLookup.lookupRpc.rpc->completed();
+    indexLookup.isReady();
+
+    // The objects are dropped and the hash is read as usual.
+    EXPECT_EQ(1U, indexLookup.numInserted);
+    EXPECT_EQ(static_cast<uint8_t>(IndexLookup::RPC_ID_NOT_ASSIGNED),
+              indexLookup.activeRpcIds[0]);
+}
+
+TEST_F(IndexLookupTest, isReady_prefetchNextLookup) {
+    TestLog::Enable _;
+    IndexLookup indexLookup(ramcloud.get(), 10, azKeyRange);
+    // Leave room in activeHashes for just two of the returned hashes.
+    indexLookup.numInserted = IndexLookup::MAX_NUM_PK;
+    indexLookup.numAssigned = IndexLookup::MAX_NUM_PK;
+    indexLookup.numRemoved = 2;
+    for (size_t i = 0; i < IndexLookup::MAX_NUM_PK; i++)
+        indexLookup.activeRpcIds[i] = 0;
+    Buffer* respBuffer = indexLookup.lookupRpc.rpc->response;
+    respBuffer->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
+    respBuffer->emplaceAppend<uint32_t>(5);
+    respBuffer->emplaceAppend<uint16_t>(uint16_t(1));
+    respBuffer->emplaceAppend<uint64_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
+    for (KeyHash i = 0; i < 5; i++) {
+        respBuffer->emplaceAppend<KeyHash>(i);
+    }
+    respBuffer->emplaceAppend<char>('b');
+    indexLookup.lookupRpc.rpc->completed();
+    indexLookup.isReady();
+
+    // The next lookup goes out while three hashes still wait for room.
+    EXPECT_EQ(IndexLookup::MAX_NUM_PK + 2, indexLookup.numInserted);
+    EXPECT_EQ(3U, indexLookup.pendingHashes.size());
+    EXPECT_EQ(2U, indexLookup.pendingHashes.front());
+    EXPECT_EQ(IndexLookup::SENT, indexLookup.lookupRpc.status);
+    EXPECT_EQ("mock:indexserver=1",
+            indexLookup.lookupRpc.rpc->session->serviceLocator);
+
+    // Once the client makes room, the pending hashes go in first.
+    indexLookup.numRemoved += 3;
+    indexLookup.isReady();
+    EXPECT_EQ(IndexLookup::MAX_NUM_PK + 5, indexLookup.numInserted);
+    EXPECT_EQ(0U, indexLookup.pendingHashes.size());
+    EXPECT_EQ(4U, indexLookup.activeHashes[4]);
+    EXPECT_FALSE(indexLookup.finishedLookup);
+}
+
 // Rule 5:
 // Try to assign the current key hash to an existing RPC to the same server.
 TEST_F(IndexLookupTest, isReady_assignPKHashesToSameServer) {
@@ -236,6 +352,8 @@ TEST_F(IndexLookupTest, isReady_assignPKHashesToSameServer) {
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(10);
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint16_t>(uint16_t(0));
     indexLookup.lookupRpc.rpc->response->emplaceAppend<uint64_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
+    indexLookup.lookupRpc.rpc->response->emplaceAppend<uint32_t>(0);
     for (KeyHash i = 0; i < 10; i++) {
         indexLookup.lookupRpc.rpc->response->emplaceAppend<KeyHash>(i);
     }
@@ -250,6 +368,62 @@ TEST_F(IndexLookupTest, isReady_assignPKHashesToSameServer) {
 }
 
 // Adds bogus index entries for an object that shouldn't be in range query.
+// Rule 7:
+// Launch a partly filled readRpc if nothing else is outstanding.
+TEST_F(IndexLookupTest, isReady_launchPartialReadWhenIdle) {
+    TestLog::Enable _;
+    IndexLookup indexLookup(ramcloud.get(), 10, azKeyRange);
+    Buffer* respBuffer = indexLookup.lookupRpc.rpc->response;
+    respBuffer->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
+    respBuffer->emplaceAppend<uint32_t>(10);
+    respBuffer->emplaceAppend<uint16_t>(uint16_t(1));
+    respBuffer->emplaceAppend<uint64_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
+    for (KeyHash i = 0; i < 10; i++) {
+        respBuffer->emplaceAppend<KeyHash>(i);
+    }
+    respBuffer->emplaceAppend<char>('b');
+    indexLookup.lookupRpc.rpc->completed();
+    indexLookup.isReady();
+
+    // More hashes are coming, but there is nothing else to read meanwhile.
+    EXPECT_FALSE(indexLookup.finishedLookup);
+    EXPECT_EQ(10U, indexLookup.readRpcs[0].numHashes);
+    EXPECT_EQ(IndexLookup::SENT, indexLookup.readRpcs[0].status);
+}
+
+// Rule 8:
+// Size later readRpcs from the hint in the response.
+TEST_F(IndexLookupTest, isReady_readBatchSizeFollowsHint) {
+    TestLog::Enable _;
+    IndexLookup indexLookup(ramcloud.get(), 10, azKeyRange);
+    EXPECT_EQ(16U, indexLookup.readBatchSize);
+    Buffer* respBuffer = indexLookup.lookupRpc.rpc->response;
+    respBuffer->emplaceAppend<WireFormat::ResponseCommon>()->status = STATUS_OK;
+    respBuffer->emplaceAppend<uint32_t>(2);
+    respBuffer->emplaceAppend<uint16_t>(uint16_t(0));
+    respBuffer->emplaceAppend<uint64_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
+    respBuffer->emplaceAppend<uint32_t>(0);
+    respBuffer->emplaceAppend<KeyHash>(0);
+    respBuffer->emplaceAppend<KeyHash>(1);
+    indexLookup.lookupRpc.rpc->completed();
+    indexLookup.isReady();
+    ASSERT_EQ(IndexLookup::SENT, indexLookup.readRpcs[0].status);
+
+    WireFormat::ReadHashes::Response* readResp =
+            indexLookup.readRpcs[0].rpc->response->emplaceAppend<
+            WireFormat::ReadHashes::Response>();
+    readResp->common.status = STATUS_OK;
+    readResp->numHashes = 2;
+    readResp->numObjects = 0;
+    readResp->hashesPerResponse = 100;
+    indexLookup.readRpcs[0].rpc->completed();
+    indexLookup.isReady();
+    EXPECT_EQ(100U, indexLookup.readBatchSize);
+}
+
 TEST_F(IndexLookupTest, getNext_filtering) {
     ramcloud.construct(&context, "mock:host=coordinator");
     uint64_t tableId = ramcloud->createTable("table");
@@ -314,4 +488,37 @@ TEST_F(IndexLookupTest, getNext_filtering) {
 
     EXPECT_FALSE(indexLookup2.getNext());
 }
+
+// The index and the table are on the same server, so the objects come back
+// with the lookup and no READ_HASHES is needed.
+TEST_F(IndexLookupTest, getNext_objectsReturnedWithLookup) {
+    ramcloud.construct(&context, "mock:host=coordinator");
+    uint64_t tableId = ramcloud->createTable("table");
+    ramcloud->createIndex(tableId, 1, 0);
+
+    KeyInfo keyList[2];
+    keyList[0].keyLength = 11;
+    keyList[0].key = "primaryKey1";
+    keyList[1].keyLength = 1;
+    keyList[1].key = "a";
+    ramcloud->write(tableId, 2, keyList, "value1");
+    keyList[0].key = "primaryKey2";
+    keyList[1].key = "b";
+    ramcloud->write(tableId, 2, keyList, "value2");
+
+    IndexLookup indexLookup(ramcloud.get(), tableId, azKeyRange);
+    EXPECT_TRUE(indexLookup.getNext());
+    Object* obj = indexLookup.currentObject();
+    EXPECT_STREQ("primaryKey1", StringUtil::binaryToString(
+            obj->getKey(), obj->getKeyLength(0)).c_str());
+    EXPECT_TRUE(indexLookup.getNext());
+    obj = indexLookup.currentObject();
+    EXPECT_STREQ("primaryKey2", StringUtil::binaryToString(
+            obj->getKey(), obj->getKeyLength(0)).c_str());
+    EXPECT_FALSE(indexLookup.getNext());
+
+    for (uint8_t i = 0; i < IndexLookup::NUM_READ_RPCS; i++) {
+        EXPECT_FALSE(indexLookup.readRpcs[i].rpc);
+    }
+}
 } // namespace ramcloud
@@ -117,6 +117,7 @@ IndexRpcWrapper::send()
             tableId, indexId, key, keyLength, &indexDoesntExist);
     if (session) {
         state = IN_PROGRESS;
+        RpcTrace::recordSend(&request);
         session->sendRequest(&request, response, this);
     } else if (indexDoesntExist) {
         handleIndexDoesntExist();
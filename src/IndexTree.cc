@@ -0,0 +1,744 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <endian.h>
+#include <immintrin.h>
+
+#include "IndexTree.h"
+
+namespace RAMCloud {
+
+namespace {
+bool
+haveSse42()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+bool
+haveAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+} // anonymous namespace
+
+const int64_t IndexTree::UNUSED_HEAD;
+
+// Start out with the portable version so that searches during static
+// initialization are safe, then switch to the fastest supported one.
+IndexTree::CountFunction IndexTree::countHeadsBelow =
+    IndexTree::countHeadsBelowScalar;
+static IndexTree::SearchImplementation initialSearchImplementation =
+    IndexTree::setSearchImplementation(IndexTree::SEARCH_BEST_AVAILABLE);
+
+/**
+ * Choose how the heads of nodes are scanned during searches. This is
+ * normally decided automatically at start up, but benchmarks and tests use
+ * it to compare the implementations.
+ * \param implementation
+ *      The desired implementation. If the processor does not support it,
+ *      the best supported one is used instead.
+ * \return
+ *      The implementation actually in use.
+ */
+IndexTree::SearchImplementation
+IndexTree::setSearchImplementation(SearchImplementation implementation)
+{
+    if (implementation == SEARCH_BEST_AVAILABLE ||
+            (implementation == SEARCH_AVX2 && !haveAvx2()) ||
+            (implementation == SEARCH_SSE42 && !haveSse42())) {
+        implementation = haveAvx2() ? SEARCH_AVX2 :
+                (haveSse42() ? SEARCH_SSE42 : SEARCH_SCALAR);
+    }
+
+    switch (implementation) {
+    case SEARCH_AVX2:
+        countHeadsBelow = countHeadsBelowAvx2;
+        break;
+    case SEARCH_SSE42:
+        countHeadsBelow = countHeadsBelowSse42;
+        break;
+    default:
+        countHeadsBelow = countHeadsBelowScalar;
+        implementation = SEARCH_SCALAR;
+        break;
+    }
+    return implementation;
+}
+
+/**
+ * Return which implementation is currently used to scan the heads of nodes
+ * during searches; see #setSearchImplementation().
+ */
+IndexTree::SearchImplementation
+IndexTree::getSearchImplementation()
+{
+    if (countHeadsBelow == countHeadsBelowAvx2)
+        return SEARCH_AVX2;
+    if (countHeadsBelow == countHeadsBelowSse42)
+        return SEARCH_SSE42;
+    return SEARCH_SCALAR;
+}
+
+/**
+ * Construct an empty tree.
+ */
+IndexTree::IndexTree()
+    : root(new Leaf())
+    , numEntries(0)
+{
+}
+
+IndexTree::~IndexTree()
+{
+    freeNode(root);
+}
+
+/**
+ * Remove all entries from the tree.
+ */
+void
+IndexTree::clear()
+{
+    freeNode(root);
+    root = new Leaf();
+    numEntries = 0;
+}
+
+/**
+ * Remove an entry from the tree.
+ *
+ * \param entry
+ *      The entry to remove.
+ * \return
+ *      True if the entry was removed, false if it wasn't in the tree.
+ */
+bool
+IndexTree::erase(const BtreeEntry& entry)
+{
+    Entry probe = makeProbe(entry);
+    bool rootEmpty = false;
+    if (!eraseFrom(root, probe, &rootEmpty))
+        return false;
+    numEntries--;
+
+    if (rootEmpty && !root->leaf) {
+        delete static_cast<Inner*>(root);
+        root = new Leaf();
+    }
+    // Drop levels that no longer do any routing.
+    while (!root->leaf && root->count == 0) {
+        Inner* inner = static_cast<Inner*>(root);
+        root = inner->children[0];
+        delete inner;
+    }
+    return true;
+}
+
+/**
+ * Check whether the tree contains an entry.
+ *
+ * \param entry
+ *      The entry to look for.
+ * \return
+ *      True if the tree contains an entry with the same key and primary key
+ *      hash, false otherwise.
+ */
+bool
+IndexTree::exists(const BtreeEntry& entry)
+{
+    iterator it = lower_bound(entry);
+    return it != end() &&
+            compare(it.leaf->entries[it.slot], makeProbe(entry)) == 0;
+}
+
+/**
+ * Add an entry to the tree. The tree keeps its own copy of the key.
+ *
+ * \param entry
+ *      The entry to add.
+ * \return
+ *      True if the entry was added, false if it was already in the tree.
+ */
+bool
+IndexTree::insert(const BtreeEntry& entry)
+{
+    Entry probe = makeProbe(entry);
+    Entry separator = Entry();
+    bool inserted = false;
+    Node* sibling = insertInto(root, probe, &separator, &inserted);
+    if (sibling != NULL) {
+        Inner* newRoot = new Inner();
+        newRoot->keys[0] = separator;
+        newRoot->children[0] = root;
+        newRoot->children[1] = sibling;
+        newRoot->count = 1;
+        updateHeads(newRoot, newRoot->keys);
+        root = newRoot;
+    }
+    if (inserted)
+        numEntries++;
+    return inserted;
+}
+
+/**
+ * Find the first entry in the tree that is not less than a given entry.
+ *
+ * \param entry
+ *      The entry to search for; it need not be in the tree.
+ * \return
+ *      An iterator positioned at the first entry greater than or equal to
+ *      \a entry, or end() if there is no such entry.
+ */
+IndexTree::iterator
+IndexTree::lower_bound(const BtreeEntry& entry)
+{
+    Entry probe = makeProbe(entry);
+    Node* node = root;
+    while (!node->leaf) {
+        Inner* inner = static_cast<Inner*>(node);
+        node = inner->children[upperBoundSlot(inner, inner->keys, probe)];
+    }
+    Leaf* leaf = static_cast<Leaf*>(node);
+    uint16_t slot = lowerBoundSlot(leaf, leaf->entries, probe);
+    if (slot == leaf->count) {
+        // Empty leaves are always unlinked (except for an empty root, which
+        // has no neighbours), so the next leaf starts with the answer.
+        leaf = leaf->next;
+        slot = 0;
+    }
+    return iterator(leaf, slot);
+}
+
+/**
+ * Remove every entry whose key is greater than or equal to a given key,
+ * regardless of its primary key hash. This is used when part of an
+ * indexlet is migrated away.
+ *
+ * \param key
+ *      Key of the first entries to be removed.
+ * \param keyLength
+ *      Number of bytes in key.
+ */
+void
+IndexTree::truncate(const void* key, KeyLength keyLength)
+{
+    BtreeEntry first(key, keyLength, 0UL);
+    iterator it = lower_bound(first);
+    while (it != end()) {
+        erase(*it);
+        it = lower_bound(first);
+    }
+}
+
+/**
+ * Compare two entries.
+ *
+ * \return
+ *      A negative value if a is ordered before b, zero if they are equal,
+ *      and a positive value if a is ordered after b.
+ */
+int
+IndexTree::compare(const Entry& a, const Entry& b)
+{
+    uint64_t prefixA, prefixB;
+    memcpy(&prefixA, a.prefix, sizeof(prefixA));
+    memcpy(&prefixB, b.prefix, sizeof(prefixB));
+    prefixA = be64toh(prefixA);
+    prefixB = be64toh(prefixB);
+    if (prefixA != prefixB)
+        return prefixA < prefixB ? -1 : 1;
+
+    // The prefixes match. If either key fits in its prefix, it is a prefix
+    // of the other key (the padding matched the other key's bytes), so the
+    // shorter key comes first.
+    int result = 0;
+    if (a.keyLength > PREFIX_LENGTH && b.keyLength > PREFIX_LENGTH) {
+        result = memcmp(a.key + PREFIX_LENGTH, b.key + PREFIX_LENGTH,
+                        std::min(a.keyLength, b.keyLength) - PREFIX_LENGTH);
+    }
+    if (result == 0)
+        result = a.keyLength - b.keyLength;
+    if (result != 0)
+        return result;
+
+    if (a.pKHash != b.pKHash)
+        return a.pKHash < b.pKHash ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Return a copy of an entry that owns its own copy of the key.
+ */
+IndexTree::Entry
+IndexTree::copyEntry(const Entry& entry)
+{
+    Entry copy = entry;
+    if (entry.keyLength > PREFIX_LENGTH) {
+        char* key = static_cast<char*>(malloc(entry.keyLength));
+        memcpy(key, entry.key, entry.keyLength);
+        copy.key = key;
+    } else {
+        copy.key = NULL;
+    }
+    return copy;
+}
+
+/**
+ * Release the storage owned by an entry created by copyEntry.
+ */
+void
+IndexTree::freeEntry(Entry& entry)
+{
+    free(const_cast<char*>(entry.key));
+    entry.key = NULL;
+}
+
+/**
+ * Return a pointer to the full key of an entry.
+ */
+const void*
+IndexTree::getKey(const Entry& entry)
+{
+    return entry.key != NULL ? entry.key : entry.prefix;
+}
+
+/**
+ * Build an Entry to compare against those in the tree. The result refers
+ * to the key of \a entry rather than copying it.
+ */
+IndexTree::Entry
+IndexTree::makeProbe(const BtreeEntry& entry)
+{
+    Entry probe;
+    memset(probe.prefix, 0, sizeof(probe.prefix));
+    if (entry.keyLength > 0) {
+        memcpy(probe.prefix, entry.key,
+               std::min<size_t>(entry.keyLength, PREFIX_LENGTH));
+    }
+    probe.pKHash = entry.pKHash;
+    probe.key = static_cast<const char*>(entry.key);
+    probe.keyLength = entry.keyLength;
+    return probe;
+}
+
+/**
+ * Return the head of a sequence of key bytes: its first 8 bytes, padded
+ * with zeroes, as a big-endian integer with the sign bit flipped. Heads
+ * compare (as signed integers) the same way as the bytes they come from,
+ * except that sequences whose heads are equal may still differ.
+ *
+ * \param bytes
+ *      First of the bytes.
+ * \param length
+ *      Number of bytes at \a bytes; only the first 8 are used.
+ */
+int64_t
+IndexTree::makeHead(const char* bytes, size_t length)
+{
+    uint64_t head = 0;
+    if (length > 0)
+        memcpy(&head, bytes, std::min<size_t>(length, sizeof(head)));
+    return static_cast<int64_t>(be64toh(head) ^ (1UL << 63));
+}
+
+/**
+ * Search the entries or keys of a node.
+ *
+ * \param node
+ *      Node being searched.
+ * \param entries
+ *      The entries of \a node if it is a Leaf, its keys if it is an Inner.
+ * \param probe
+ *      The entry to search for.
+ * \param upper
+ *      False to find the first entry not less than \a probe, true to find
+ *      the first entry greater than \a probe.
+ * \return
+ *      The index of that entry, or node->count if there is none.
+ */
+uint16_t
+IndexTree::findSlot(const Node* node, const Entry* entries,
+                    const Entry& probe, bool upper)
+{
+    uint16_t count = node->count;
+    if (count == 0)
+        return 0;
+
+    // All the keys of the node start with the same prefixLength bytes, so
+    // unless the probe does too, it goes before or after all of them.
+    const char* probeKey = static_cast<const char*>(getKey(probe));
+    uint16_t prefixLength = node->prefixLength;
+    if (prefixLength > 0) {
+        int result = memcmp(probeKey, getKey(entries[0]),
+                            std::min(probe.keyLength, prefixLength));
+        if (result == 0 && probe.keyLength < prefixLength)
+            result = -1;
+        if (result < 0)
+            return 0;
+        if (result > 0)
+            return count;
+    }
+
+    // Entries with smaller heads are less than the probe and those with
+    // larger heads are greater; only the ones in between need a full
+    // comparison.
+    int64_t head = makeHead(probeKey + prefixLength,
+                            probe.keyLength - prefixLength);
+    uint32_t low = std::min<uint32_t>(count,
+                                      countHeadsBelow(node->heads, head));
+    uint32_t high = count;
+    if (head != UNUSED_HEAD) {
+        high = std::min<uint32_t>(count,
+                                  countHeadsBelow(node->heads, head + 1));
+    }
+    while (low < high) {
+        uint32_t middle = (low + high) / 2;
+        int result = compare(entries[middle], probe);
+        if (result < 0 || (upper && result == 0))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return static_cast<uint16_t>(low);
+}
+
+/**
+ * Return the index of the first of the sorted entries of \a node that is
+ * not less than \a probe, or node->count if there is none.
+ */
+uint16_t
+IndexTree::lowerBoundSlot(const Node* node, const Entry* entries,
+                          const Entry& probe)
+{
+    return findSlot(node, entries, probe, false);
+}
+
+/**
+ * Return the index of the first of the sorted entries of \a node that is
+ * greater than \a probe, or node->count if there is none.
+ */
+uint16_t
+IndexTree::upperBoundSlot(const Node* node, const Entry* entries,
+                          const Entry& probe)
+{
+    return findSlot(node, entries, probe, true);
+}
+
+/**
+ * Recompute the shared prefix and the heads of a node after its entries or
+ * keys have changed.
+ *
+ * \param node
+ *      Node whose entries changed.
+ * \param entries
+ *      The entries of \a node if it is a Leaf, its keys if it is an Inner.
+ */
+void
+IndexTree::updateHeads(Node* node, const Entry* entries)
+{
+    // The keys are sorted, so the prefix shared by the first and the last
+    // is shared by all of them.
+    uint16_t prefixLength = 0;
+    if (node->count > 0) {
+        const Entry& first = entries[0];
+        const Entry& last = entries[node->count - 1];
+        const char* firstKey = static_cast<const char*>(getKey(first));
+        const char* lastKey = static_cast<const char*>(getKey(last));
+        uint16_t limit = std::min(first.keyLength, last.keyLength);
+        while (prefixLength < limit &&
+                firstKey[prefixLength] == lastKey[prefixLength]) {
+            prefixLength++;
+        }
+    }
+    node->prefixLength = prefixLength;
+
+    for (uint16_t i = 0; i < node->count; i++) {
+        const char* key = static_cast<const char*>(getKey(entries[i]));
+        node->heads[i] = makeHead(key + prefixLength,
+                                  entries[i].keyLength - prefixLength);
+    }
+    for (uint32_t i = node->count; i < SLOTS; i++)
+        node->heads[i] = UNUSED_HEAD;
+}
+
+/**
+ * Return the number of the SLOTS heads at \a heads that are less than
+ * \a head.
+ */
+uint32_t
+IndexTree::countHeadsBelowScalar(const int64_t* heads, int64_t head)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < SLOTS; i++)
+        count += (heads[i] < head);
+    return count;
+}
+
+/**
+ * SSE 4.2 version of #countHeadsBelowScalar(); compares two heads per
+ * instruction. Only called if the processor supports SSE 4.2.
+ */
+__attribute__((target("sse4.2")))
+uint32_t
+IndexTree::countHeadsBelowSse42(const int64_t* heads, int64_t head)
+{
+    const __m128i* p = reinterpret_cast<const __m128i*>(heads);
+    const __m128i probe = _mm_set1_epi64x(head);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < SLOTS / 2; i++) {
+        __m128i below = _mm_cmpgt_epi64(probe, _mm_loadu_si128(p + i));
+        count += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(below)));
+    }
+    return count;
+}
+
+/**
+ * AVX2 version of #countHeadsBelowScalar(); compares four heads per
+ * instruction. Only called if the processor supports AVX2.
+ */
+__attribute__((target("avx2")))
+uint32_t
+IndexTree::countHeadsBelowAvx2(const int64_t* heads, int64_t head)
+{
+    const __m256i* p = reinterpret_cast<const __m256i*>(heads);
+    const __m256i probe = _mm256_set1_epi64x(head);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < SLOTS / 4; i++) {
+        __m256i below = _mm256_cmpgt_epi64(probe, _mm256_loadu_si256(p + i));
+        count += __builtin_popcount(
+                _mm256_movemask_pd(_mm256_castsi256_pd(below)));
+    }
+    return count;
+}
+
+/**
+ * Remove an entry from a subtree.
+ *
+ * \param node
+ *      Root of the subtree.
+ * \param probe
+ *      The entry to remove.
+ * \param[out] nodeEmpty
+ *      Set to true if \a node no longer holds any entries; the caller must
+ *      then free it (a leaf having been unlinked by the caller first).
+ * \return
+ *      True if the entry was found and removed.
+ */
+bool
+IndexTree::eraseFrom(Node* node, const Entry& probe, bool* nodeEmpty)
+{
+    if (node->leaf) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        uint16_t slot = lowerBoundSlot(leaf, leaf->entries, probe);
+        if (slot == leaf->count || compare(leaf->entries[slot], probe) != 0)
+            return false;
+        freeEntry(leaf->entries[slot]);
+        memmove(&leaf->entries[slot], &leaf->entries[slot + 1],
+                (leaf->count - slot - 1) * sizeof(Entry));
+        leaf->count--;
+        updateHeads(leaf, leaf->entries);
+        *nodeEmpty = (leaf->count == 0);
+        return true;
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    uint16_t slot = upperBoundSlot(inner, inner->keys, probe);
+    Node* child = inner->children[slot];
+    bool childEmpty = false;
+    if (!eraseFrom(child, probe, &childEmpty))
+        return false;
+    if (!childEmpty)
+        return true;
+
+    if (child->leaf) {
+        unlinkLeaf(static_cast<Leaf*>(child));
+        delete static_cast<Leaf*>(child);
+    } else {
+        delete static_cast<Inner*>(child);
+    }
+
+    if (inner->count == 0) {
+        // That was the only child.
+        *nodeEmpty = true;
+        return true;
+    }
+
+    // Drop the child along with one of the separators next to it.
+    uint16_t keySlot = static_cast<uint16_t>(slot > 0 ? slot - 1 : 0);
+    freeEntry(inner->keys[keySlot]);
+    memmove(&inner->keys[keySlot], &inner->keys[keySlot + 1],
+            (inner->count - keySlot - 1) * sizeof(Entry));
+    memmove(&inner->children[slot], &inner->children[slot + 1],
+            (inner->count - slot) * sizeof(Node*));
+    inner->count--;
+    updateHeads(inner, inner->keys);
+    return true;
+}
+
+/**
+ * Free a subtree along with all the keys it owns.
+ */
+void
+IndexTree::freeNode(Node* node)
+{
+    if (node->leaf) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        for (uint16_t i = 0; i < leaf->count; i++)
+            freeEntry(leaf->entries[i]);
+        delete leaf;
+    } else {
+        Inner* inner = static_cast<Inner*>(node);
+        for (uint16_t i = 0; i < inner->count; i++)
+            freeEntry(inner->keys[i]);
+        for (uint16_t i = 0; i <= inner->count; i++)
+            freeNode(inner->children[i]);
+        delete inner;
+    }
+}
+
+/**
+ * Add an entry to a subtree, splitting nodes that overflow on the way back
+ * up.
+ *
+ * \param node
+ *      Root of the subtree.
+ * \param probe
+ *      The entry to add (see makeProbe); it is copied if it gets added.
+ * \param[out] separator
+ *      If \a node was split, this is set to an entry owning a copy of the
+ *      first key of the new sibling; the caller is responsible for it.
+ * \param[out] inserted
+ *      Set to true if the entry was added, false if it was already there.
+ * \return
+ *      The new sibling to the right of \a node if \a node was split,
+ *      otherwise NULL.
+ */
+IndexTree::Node*
+IndexTree::insertInto(Node* node, const Entry& probe, Entry* separator,
+                      bool* inserted)
+{
+    if (node->leaf) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        uint16_t slot = lowerBoundSlot(leaf, leaf->entries, probe);
+        if (slot < leaf->count && compare(leaf->entries[slot], probe) == 0) {
+            *inserted = false;
+            return NULL;
+        }
+        *inserted = true;
+
+        Leaf* sibling = NULL;
+        if (leaf->count == SLOTS) {
+            // Move the upper half into a new leaf, then insert into
+            // whichever half the entry belongs in.
+            sibling = new Leaf();
+            uint16_t half = SLOTS / 2;
+            memcpy(sibling->entries, &leaf->entries[half],
+                   (SLOTS - half) * sizeof(Entry));
+            sibling->count = static_cast<uint16_t>(SLOTS - half);
+            leaf->count = half;
+            sibling->prev = leaf;
+            sibling->next = leaf->next;
+            if (leaf->next != NULL)
+                leaf->next->prev = sibling;
+            leaf->next = sibling;
+            if (slot > half) {
+                leaf = sibling;
+                slot = static_cast<uint16_t>(slot - half);
+            }
+        }
+
+        memmove(&leaf->entries[slot + 1], &leaf->entries[slot],
+                (leaf->count - slot) * sizeof(Entry));
+        leaf->entries[slot] = copyEntry(probe);
+        leaf->count++;
+        if (sibling == NULL) {
+            updateHeads(leaf, leaf->entries);
+            return NULL;
+        }
+
+        Leaf* original = static_cast<Leaf*>(node);
+        updateHeads(original, original->entries);
+        updateHeads(sibling, sibling->entries);
+        *separator = copyEntry(sibling->entries[0]);
+        return sibling;
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    uint16_t slot = upperBoundSlot(inner, inner->keys, probe);
+    Entry childSeparator = Entry();
+    Node* newChild = insertInto(inner->children[slot], probe,
+                                &childSeparator, inserted);
+    if (newChild == NULL)
+        return NULL;
+
+    if (inner->count < SLOTS) {
+        memmove(&inner->keys[slot + 1], &inner->keys[slot],
+                (inner->count - slot) * sizeof(Entry));
+        memmove(&inner->children[slot + 2], &inner->children[slot + 1],
+                (inner->count - slot) * sizeof(Node*));
+        inner->keys[slot] = childSeparator;
+        inner->children[slot + 1] = newChild;
+        inner->count++;
+        updateHeads(inner, inner->keys);
+        return NULL;
+    }
+
+    // The node is full: lay out all SLOTS + 1 keys in order, keep the lower
+    // half here, push the middle key up and move the rest to a new node.
+    Entry keys[SLOTS + 1];
+    Node* children[SLOTS + 2];
+    memcpy(keys, inner->keys, slot * sizeof(Entry));
+    keys[slot] = childSeparator;
+    memcpy(&keys[slot + 1], &inner->keys[slot],
+           (SLOTS - slot) * sizeof(Entry));
+    memcpy(children, inner->children, (slot + 1) * sizeof(Node*));
+    children[slot + 1] = newChild;
+    memcpy(&children[slot + 2], &inner->children[slot + 1],
+           (SLOTS - slot) * sizeof(Node*));
+
+    uint16_t middle = (SLOTS + 1) / 2;
+    Inner* sibling = new Inner();
+    memcpy(inner->keys, keys, middle * sizeof(Entry));
+    memcpy(inner->children, children, (middle + 1) * sizeof(Node*));
+    inner->count = middle;
+    *separator = keys[middle];
+    memcpy(sibling->keys, &keys[middle + 1],
+           (SLOTS - middle) * sizeof(Entry));
+    memcpy(sibling->children, &children[middle + 1],
+           (SLOTS + 1 - middle) * sizeof(Node*));
+    sibling->count = static_cast<uint16_t>(SLOTS - middle);
+    updateHeads(inner, inner->keys);
+    updateHeads(sibling, sibling->keys);
+    return sibling;
+}
+
+/**
+ * Remove a leaf from the list of leaves.
+ */
+void
+IndexTree::unlinkLeaf(Leaf* leaf)
+{
+    if (leaf->prev != NULL)
+        leaf->prev->next = leaf->next;
+    if (leaf->next != NULL)
+        leaf->next->prev = leaf->prev;
+    leaf->prev = NULL;
+    leaf->next = NULL;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,279 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_INDEXTREE_H
+#define RAMCLOUD_INDEXTREE_H
+
+#include "Common.h"
+#include "Key.h"
+#include "btreeRamCloud/Btree.h"
+
+namespace RAMCloud {
+
+/**
+ * An ordered set of index entries (secondary key, primary key hash) kept
+ * entirely in DRAM. IndexletManager uses one of these per indexlet when
+ * indexlets are kept in memory (see ServerConfig::Master::inMemoryIndexlets)
+ * instead of an IndexBtree, whose nodes are objects that must be read out
+ * of the log and deserialized on every access.
+ *
+ * This is a B+ tree of pointer-linked nodes. Each entry keeps the first
+ * few bytes of its key inline, so short keys need no other storage.
+ * Besides its entries, each node keeps a contiguous array of fixed-width
+ * "heads": the 8 key bytes that follow the prefix shared by all keys in the
+ * node, as integers that order the same way as the keys. Searching a node
+ * first counts the heads below the probe's head, which touches a few cache
+ * lines and no keys at all and is done with SIMD instructions where the
+ * processor supports them; whole keys are only compared among the entries
+ * whose heads tie with the probe's. Leaves are doubly linked for range
+ * scans. Entries are ordered the same
+ * way as BtreeEntry: by key (as in IndexKey::keyCompare), then by primary
+ * key hash.
+ *
+ * Nodes aren't merged when they underflow; a node is only freed once it
+ * becomes empty. This keeps removal simple, and index entries that are
+ * removed tend to be replaced by nearby ones anyway.
+ *
+ * This class isn't thread-safe; IndexletManager serializes accesses to each
+ * tree with the lock of its indexlet.
+ */
+class IndexTree {
+  PRIVATE:
+    /// Maximum number of entries in a leaf, and of keys in an inner node.
+    enum { SLOTS = 32 };
+
+    /// Number of key bytes each Entry keeps inline.
+    enum { PREFIX_LENGTH = 8 };
+
+    /// Value of Node::heads for slots past Node::count.
+    static const int64_t UNUSED_HEAD = INT64_MAX;
+
+    /**
+     * A single index entry, or a copy of one used as a separator in an
+     * inner node. Entries are moved between nodes by plain copies; the node
+     * holding an entry owns its key.
+     */
+    struct Entry {
+        /// The first PREFIX_LENGTH bytes of the key, padded with zeroes.
+        char prefix[PREFIX_LENGTH];
+
+        /// Hash of the primary key of the object indexed by this entry.
+        uint64_t pKHash;
+
+        /// The whole key, in storage allocated with malloc, if it didn't fit
+        /// in #prefix; NULL otherwise. Entries built by makeProbe point at
+        /// the caller's key instead and own nothing.
+        const char* key;
+
+        /// Number of bytes in the key.
+        KeyLength keyLength;
+    };
+
+    /// Fields common to both kinds of nodes.
+    struct Node {
+        explicit Node(bool leaf)
+            : leaf(leaf)
+            , count(0)
+            , prefixLength(0)
+            , heads()
+        {
+            for (uint32_t i = 0; i < SLOTS; i++)
+                heads[i] = UNUSED_HEAD;
+        }
+
+        /// True if this is a Leaf, false if it is an Inner.
+        bool leaf;
+
+        /// Number of entries in a Leaf, or of keys in an Inner.
+        uint16_t count;
+
+        /// Number of leading key bytes shared by all the keys in the node.
+        uint16_t prefixLength;
+
+        /// heads[i] is the head (see makeHead) of the bytes of key i past
+        /// the #prefixLength shared ones. Heads are sorted like the keys;
+        /// unused slots hold UNUSED_HEAD, so that searches can always scan
+        /// all SLOTS of them. Kept up to date by updateHeads.
+        int64_t heads[SLOTS];
+    };
+
+    /// A node holding the index entries themselves.
+    struct Leaf : public Node {
+        Leaf()
+            : Node(true)
+            , entries()
+            , prev(NULL)
+            , next(NULL)
+        {}
+
+        /// The first #count of these are valid, in order.
+        Entry entries[SLOTS];
+
+        /// Neighbouring leaves in entry order, or NULL at either end.
+        Leaf* prev;
+        Leaf* next;
+    };
+
+    /**
+     * A node routing lookups to its children: children[i] holds the entries
+     * e with keys[i - 1] <= e < keys[i].
+     */
+    struct Inner : public Node {
+        Inner()
+            : Node(false)
+            , keys()
+            , children()
+        {}
+
+        /// Separators; the first #count are valid.
+        Entry keys[SLOTS];
+
+        /// The first #count + 1 of these are valid.
+        Node* children[SLOTS + 1];
+    };
+
+  PUBLIC:
+    /**
+     * Walks the entries of an IndexTree in order. Iterators are invalidated
+     * by any modification of the tree.
+     */
+    class iterator {
+      public:
+        iterator()
+            : leaf(NULL)
+            , slot(0)
+        {}
+
+        /// Return the entry the iterator is positioned at.
+        BtreeEntry
+        operator*() const
+        {
+            const Entry& entry = leaf->entries[slot];
+            return BtreeEntry(getKey(entry), entry.keyLength, entry.pKHash);
+        }
+
+        /// Advance to the next entry in the tree.
+        iterator&
+        operator++()
+        {
+            if (++slot >= leaf->count) {
+                leaf = leaf->next;
+                slot = 0;
+            }
+            return *this;
+        }
+
+        bool
+        operator==(const iterator& other) const
+        {
+            return leaf == other.leaf && slot == other.slot;
+        }
+
+        bool
+        operator!=(const iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+      PRIVATE:
+        iterator(Leaf* leaf, uint16_t slot)
+            : leaf(leaf)
+            , slot(slot)
+        {}
+
+        /// Leaf holding the current entry; NULL once past the last entry.
+        Leaf* leaf;
+
+        /// Index of the current entry in #leaf.
+        uint16_t slot;
+
+        friend class IndexTree;
+    };
+
+    /**
+     * The ways in which the heads of a node can be scanned during searches.
+     * The vector versions compare 2 or 4 heads per instruction and are only
+     * used if the processor supports them.
+     */
+    enum SearchImplementation {
+        SEARCH_SCALAR,
+        SEARCH_SSE42,
+        SEARCH_AVX2,
+        SEARCH_BEST_AVAILABLE,
+    };
+
+    static SearchImplementation setSearchImplementation(
+                                        SearchImplementation implementation);
+    static SearchImplementation getSearchImplementation();
+
+    IndexTree();
+    ~IndexTree();
+
+    void clear();
+    bool erase(const BtreeEntry& entry);
+    bool exists(const BtreeEntry& entry);
+    bool insert(const BtreeEntry& entry);
+    iterator lower_bound(const BtreeEntry& entry);
+    void truncate(const void* key, KeyLength keyLength);
+
+    /// Return an iterator positioned past the last entry of the tree.
+    iterator end() { return iterator(); }
+
+    /// Return the number of entries in the tree.
+    size_t size() const { return numEntries; }
+
+  PRIVATE:
+    static int compare(const Entry& a, const Entry& b);
+    static Entry copyEntry(const Entry& entry);
+    static void freeEntry(Entry& entry);
+    static const void* getKey(const Entry& entry);
+    static int64_t makeHead(const char* bytes, size_t length);
+    static Entry makeProbe(const BtreeEntry& entry);
+    static uint16_t findSlot(const Node* node, const Entry* entries,
+                             const Entry& probe, bool upper);
+    static uint16_t lowerBoundSlot(const Node* node, const Entry* entries,
+                                   const Entry& probe);
+    static uint16_t upperBoundSlot(const Node* node, const Entry* entries,
+                                   const Entry& probe);
+    static void updateHeads(Node* node, const Entry* entries);
+
+    /// Signature of the functions that count how many of the SLOTS heads
+    /// of a node are less than a given head.
+    typedef uint32_t (*CountFunction)(const int64_t* heads, int64_t head);
+    static uint32_t countHeadsBelowScalar(const int64_t* heads, int64_t head);
+    static uint32_t countHeadsBelowSse42(const int64_t* heads, int64_t head);
+    static uint32_t countHeadsBelowAvx2(const int64_t* heads, int64_t head);
+
+    /// The fastest of the functions above that this processor supports.
+    static CountFunction countHeadsBelow;
+
+    bool eraseFrom(Node* node, const Entry& probe, bool* nodeEmpty);
+    void freeNode(Node* node);
+    Node* insertInto(Node* node, const Entry& probe, Entry* separator,
+                     bool* inserted);
+    void unlinkLeaf(Leaf* leaf);
+
+    /// Root of the tree; an empty Leaf if the tree holds no entries.
+    Node* root;
+
+    /// Number of entries in the tree.
+    size_t numEntries;
+
+    DISALLOW_COPY_AND_ASSIGN(IndexTree);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_INDEXTREE_H
@@ -0,0 +1,302 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "TestUtil.h"
+#include "IndexTree.h"
+
+namespace RAMCloud {
+
+class IndexTreeTest : public ::testing::Test {
+  public:
+    IndexTree tree;
+
+    IndexTreeTest()
+        : tree()
+    {
+    }
+
+    /// Return the entries of the tree, in order, as "key:hash" strings.
+    string
+    contents()
+    {
+        string result;
+        for (IndexTree::iterator it = tree.lower_bound(BtreeEntry());
+                it != tree.end(); ++it) {
+            BtreeEntry entry = *it;
+            if (!result.empty())
+                result += " ";
+            result += format("%s:%lu",
+                    string(static_cast<const char*>(entry.key),
+                           entry.keyLength).c_str(),
+                    entry.pKHash);
+        }
+        return result;
+    }
+
+    /// Return a key that sorts in the same order as i.
+    static string
+    keyFor(int i)
+    {
+        return format("key%08d", i);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(IndexTreeTest);
+};
+
+TEST_F(IndexTreeTest, insert) {
+    EXPECT_TRUE(tree.insert(BtreeEntry("b", 1)));
+    EXPECT_TRUE(tree.insert(BtreeEntry("a", 2)));
+    EXPECT_TRUE(tree.insert(BtreeEntry("b", 0)));
+    EXPECT_FALSE(tree.insert(BtreeEntry("b", 1)));
+    EXPECT_EQ(3U, tree.size());
+    EXPECT_EQ("a:2 b:0 b:1", contents());
+}
+
+TEST_F(IndexTreeTest, insert_copiesKeys) {
+    char key[] = "a rather long key";
+    tree.insert(BtreeEntry(key, 1));
+    key[0] = 'x';
+    EXPECT_EQ("a rather long key:1", contents());
+}
+
+TEST_F(IndexTreeTest, insert_splits) {
+    std::vector<int> order;
+    for (int i = 0; i < 5000; i++)
+        order.push_back(i);
+    std::random_shuffle(order.begin(), order.end());
+    foreach (int i, order) {
+        string key = keyFor(i);
+        EXPECT_TRUE(tree.insert(BtreeEntry(key.c_str(), uint64_t(i))));
+    }
+    EXPECT_FALSE(tree.root->leaf);
+    EXPECT_EQ(5000U, tree.size());
+
+    int expected = 0;
+    for (IndexTree::iterator it = tree.lower_bound(BtreeEntry());
+            it != tree.end(); ++it) {
+        EXPECT_EQ(uint64_t(expected), (*it).pKHash);
+        expected++;
+    }
+    EXPECT_EQ(5000, expected);
+    for (int i = 0; i < 5000; i++) {
+        string key = keyFor(i);
+        EXPECT_TRUE(tree.exists(BtreeEntry(key.c_str(), uint64_t(i))));
+    }
+}
+
+TEST_F(IndexTreeTest, erase) {
+    tree.insert(BtreeEntry("a", 1));
+    tree.insert(BtreeEntry("b", 2));
+    EXPECT_FALSE(tree.erase(BtreeEntry("a", 2)));
+    EXPECT_TRUE(tree.erase(BtreeEntry("a", 1)));
+    EXPECT_FALSE(tree.erase(BtreeEntry("a", 1)));
+    EXPECT_EQ(1U, tree.size());
+    EXPECT_EQ("b:2", contents());
+}
+
+TEST_F(IndexTreeTest, erase_freesEmptyNodes) {
+    std::vector<int> order;
+    for (int i = 0; i < 5000; i++) {
+        string key = keyFor(i);
+        tree.insert(BtreeEntry(key.c_str(), uint64_t(i)));
+        order.push_back(i);
+    }
+    std::random_shuffle(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); i++) {
+        string key = keyFor(order[i]);
+        EXPECT_TRUE(tree.erase(BtreeEntry(key.c_str(), uint64_t(order[i]))));
+        if (i == order.size() / 2) {
+            // The survivors are still all reachable, in order.
+            int count = 0;
+            uint64_t last = 0;
+            for (IndexTree::iterator it = tree.lower_bound(BtreeEntry());
+                    it != tree.end(); ++it) {
+                if (count > 0) {
+                    EXPECT_LT(last, (*it).pKHash);
+                }
+                last = (*it).pKHash;
+                count++;
+            }
+            EXPECT_EQ(tree.size(), size_t(count));
+        }
+    }
+    EXPECT_EQ(0U, tree.size());
+    EXPECT_TRUE(tree.root->leaf);
+    EXPECT_TRUE(tree.lower_bound(BtreeEntry()) == tree.end());
+}
+
+TEST_F(IndexTreeTest, exists) {
+    tree.insert(BtreeEntry("air", 1));
+    EXPECT_TRUE(tree.exists(BtreeEntry("air", 1)));
+    EXPECT_FALSE(tree.exists(BtreeEntry("air", 2)));
+    EXPECT_FALSE(tree.exists(BtreeEntry("ai", 1)));
+    EXPECT_FALSE(tree.exists(BtreeEntry("airy", 1)));
+}
+
+TEST_F(IndexTreeTest, lower_bound) {
+    tree.insert(BtreeEntry("air", 5));
+    tree.insert(BtreeEntry("earth", 6));
+    tree.insert(BtreeEntry("fire", 7));
+
+    EXPECT_EQ(5U, (*tree.lower_bound(BtreeEntry("a", 0))).pKHash);
+    EXPECT_EQ(5U, (*tree.lower_bound(BtreeEntry("air", 5))).pKHash);
+    EXPECT_EQ(6U, (*tree.lower_bound(BtreeEntry("air", 6))).pKHash);
+    EXPECT_EQ(7U, (*tree.lower_bound(BtreeEntry("f", 0))).pKHash);
+    EXPECT_TRUE(tree.lower_bound(BtreeEntry("g", 0)) == tree.end());
+}
+
+TEST_F(IndexTreeTest, lower_bound_acrossLeaves) {
+    for (int i = 0; i < 1000; i += 2) {
+        string key = keyFor(i);
+        tree.insert(BtreeEntry(key.c_str(), uint64_t(i)));
+    }
+    for (int i = 1; i < 999; i += 2) {
+        string key = keyFor(i);
+        EXPECT_EQ(uint64_t(i + 1),
+                  (*tree.lower_bound(BtreeEntry(key.c_str(), 0))).pKHash);
+    }
+    string key = keyFor(999);
+    EXPECT_TRUE(tree.lower_bound(BtreeEntry(key.c_str(), 0)) == tree.end());
+}
+
+TEST_F(IndexTreeTest, truncate) {
+    for (int i = 0; i < 1000; i++) {
+        string key = keyFor(i);
+        tree.insert(BtreeEntry(key.c_str(), uint64_t(i)));
+    }
+    string split = keyFor(300);
+    tree.truncate(split.c_str(), downCast<KeyLength>(split.length()));
+    EXPECT_EQ(300U, tree.size());
+    string last = keyFor(299);
+    EXPECT_TRUE(tree.exists(BtreeEntry(last.c_str(), 299)));
+    EXPECT_FALSE(tree.exists(BtreeEntry(split.c_str(), 300)));
+}
+
+TEST_F(IndexTreeTest, clear) {
+    for (int i = 0; i < 100; i++) {
+        string key = keyFor(i);
+        tree.insert(BtreeEntry(key.c_str(), uint64_t(i)));
+    }
+    tree.clear();
+    EXPECT_EQ(0U, tree.size());
+    EXPECT_EQ("", contents());
+    tree.insert(BtreeEntry("a", 1));
+    EXPECT_EQ("a:1", contents());
+}
+
+TEST_F(IndexTreeTest, findSlot_allImplementations) {
+    for (int i = 0; i < 1000; i += 2) {
+        string key = "user:" + keyFor(i);
+        tree.insert(BtreeEntry(key.c_str(), uint64_t(i)));
+    }
+    IndexTree::SearchImplementation original =
+        IndexTree::getSearchImplementation();
+    IndexTree::SearchImplementation implementations[] = {
+        IndexTree::SEARCH_SCALAR,
+        IndexTree::SEARCH_SSE42,
+        IndexTree::SEARCH_AVX2,
+    };
+    foreach (IndexTree::SearchImplementation implementation,
+             implementations) {
+        IndexTree::setSearchImplementation(implementation);
+        for (int i = 1; i < 999; i += 2) {
+            string key = "user:" + keyFor(i);
+            EXPECT_EQ(uint64_t(i + 1),
+                      (*tree.lower_bound(BtreeEntry(key.c_str(), 0))).pKHash);
+            key = "user:" + keyFor(i + 1);
+            EXPECT_TRUE(tree.exists(BtreeEntry(key.c_str(), uint64_t(i + 1))));
+        }
+    }
+    IndexTree::setSearchImplementation(original);
+}
+
+TEST_F(IndexTreeTest, findSlot_outsideSharedPrefix) {
+    tree.insert(BtreeEntry("user:b", 1));
+    tree.insert(BtreeEntry("user:c", 2));
+    EXPECT_EQ(5U, tree.root->prefixLength);
+
+    EXPECT_EQ(1U, (*tree.lower_bound(BtreeEntry("user", 0))).pKHash);
+    EXPECT_EQ(1U, (*tree.lower_bound(BtreeEntry("a", 0))).pKHash);
+    EXPECT_TRUE(tree.lower_bound(BtreeEntry("user:d", 0)) == tree.end());
+    EXPECT_TRUE(tree.lower_bound(BtreeEntry("z", 0)) == tree.end());
+}
+
+TEST_F(IndexTreeTest, findSlot_headsTie) {
+    tree.insert(BtreeEntry("0123456789b", 1));
+    tree.insert(BtreeEntry("0123456789a", 2));
+    tree.insert(BtreeEntry("01234567", 3));
+    tree.insert(BtreeEntry("01234567\0", 9, 4));
+    EXPECT_EQ(8U, tree.root->prefixLength);
+    // The zero byte is indistinguishable from padding.
+    EXPECT_EQ(tree.root->heads[0], tree.root->heads[1]);
+    EXPECT_LT(tree.root->heads[1], tree.root->heads[2]);
+
+    EXPECT_EQ(4U, (*tree.lower_bound(BtreeEntry("01234567\0", 9, 0))).pKHash);
+    EXPECT_EQ(2U, (*tree.lower_bound(BtreeEntry("0123456789", 0))).pKHash);
+    EXPECT_EQ(1U, (*tree.lower_bound(BtreeEntry("0123456789b", 0))).pKHash);
+    EXPECT_TRUE(tree.lower_bound(BtreeEntry("0123456789c", 0)) == tree.end());
+}
+
+TEST_F(IndexTreeTest, updateHeads) {
+    tree.insert(BtreeEntry("prefix:bb", 1));
+    EXPECT_EQ(9U, tree.root->prefixLength);
+    tree.insert(BtreeEntry("prefix:a", 2));
+    EXPECT_EQ(7U, tree.root->prefixLength);
+    EXPECT_LT(tree.root->heads[0], tree.root->heads[1]);
+    EXPECT_EQ(IndexTree::UNUSED_HEAD, tree.root->heads[2]);
+    tree.erase(BtreeEntry("prefix:a", 2));
+    EXPECT_EQ(9U, tree.root->prefixLength);
+    EXPECT_EQ(IndexTree::UNUSED_HEAD, tree.root->heads[1]);
+
+    // Both halves of a split node are updated.
+    for (int i = 0; i < IndexTree::SLOTS; i++) {
+        string key = "prefix:bb" + keyFor(i);
+        tree.insert(BtreeEntry(key.c_str(), 0));
+    }
+    ASSERT_FALSE(tree.root->leaf);
+    IndexTree::Inner* root = static_cast<IndexTree::Inner*>(tree.root);
+    EXPECT_EQ(9U, root->children[0]->prefixLength);
+    EXPECT_EQ(18U, root->children[1]->prefixLength);
+}
+
+TEST_F(IndexTreeTest, compare) {
+    IndexTree::Entry a = IndexTree::makeProbe(BtreeEntry("abc", 1));
+    IndexTree::Entry b = IndexTree::makeProbe(BtreeEntry("abd", 0));
+    EXPECT_GT(0, IndexTree::compare(a, b));
+    EXPECT_LT(0, IndexTree::compare(b, a));
+
+    // Keys ordered by pKHash when they are the same.
+    b = IndexTree::makeProbe(BtreeEntry("abc", 2));
+    EXPECT_GT(0, IndexTree::compare(a, b));
+    EXPECT_EQ(0, IndexTree::compare(a, a));
+
+    // A key sorts before longer keys it is a prefix of, even if those
+    // continue with zero bytes.
+    b = IndexTree::makeProbe(BtreeEntry("abc\0", 4, 0));
+    EXPECT_GT(0, IndexTree::compare(a, b));
+
+    // Long keys that differ after the inline prefix.
+    a = IndexTree::makeProbe(BtreeEntry("0123456789a", 9));
+    b = IndexTree::makeProbe(BtreeEntry("0123456789b", 0));
+    EXPECT_GT(0, IndexTree::compare(a, b));
+    b = IndexTree::makeProbe(BtreeEntry("0123456789", 0));
+    EXPECT_LT(0, IndexTree::compare(a, b));
+    b = IndexTree::makeProbe(BtreeEntry("01234567", 0));
+    EXPECT_LT(0, IndexTree::compare(a, b));
+}
+
+}  // namespace RAMCloud
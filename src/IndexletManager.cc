@@ -22,11 +22,24 @@
 
 namespace RAMCloud {
 
-IndexletManager::IndexletManager(Context* context, ObjectManager* objectManager)
+/**
+ * Construct an IndexletManager.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server.
+ * \param objectManager
+ *      Stores the objects holding the persistent copy of index entries.
+ * \param inMemoryIndexlets
+ *      If true, keep indexlets in in-memory trees; see
+ *      ServerConfig::Master::inMemoryIndexlets.
+ */
+IndexletManager::IndexletManager(Context* context, ObjectManager* objectManager,
+        bool inMemoryIndexlets)
     : context(context)
     , indexletMap()
     , mutex("IndexletManager")
     , objectManager(objectManager)
+    , inMemoryIndexlets(inMemoryIndexlets)
 {
 }
 
@@ -59,7 +72,8 @@ IndexletManager::IndexletManager(Context* context, ObjectManager* objectManager)
  * \param nextNodeId
  *      The lowest node id that the next node allocated for this indexlet
  *      is allowed to have. This is used to ensure that we don't
- *      reuse existing node ids after crash recovery.
+ *      reuse existing node ids after crash recovery. Ignored for indexlets
+ *      kept in memory.
  * 
  * \return
  *      True if indexlet was added, false if it already existed.
@@ -91,7 +105,14 @@ IndexletManager::addIndexlet(
         if (indexlet->state != state) {
             LOG(NOTICE, "Changing state of this indexlet from %d to %d.",
                     indexlet->state, state);
+            Indexlet::State oldState = indexlet->state;
             indexlet->state = state;
+            if (oldState == Indexlet::RECOVERING &&
+                    state == Indexlet::NORMAL && indexlet->tree != NULL) {
+                Lock indexletLock(indexlet->indexletMutex);
+                indexletMapLock.unlock();
+                rebuildTree(indexlet, indexletLock);
+            }
         }
 
         LOG(NOTICE, "Returning success.");
@@ -99,15 +120,19 @@ IndexletManager::addIndexlet(
 
     } else {
         // Add a new indexlet.
-        IndexBtree *bt;
-        if (nextNodeId == 0)
+        IndexBtree *bt = NULL;
+        IndexTree* tree = NULL;
+        if (inMemoryIndexlets)
+            tree = new IndexTree();
+        else if (nextNodeId == 0)
             bt = new IndexBtree(backingTableId, objectManager);
         else
             bt = new IndexBtree(backingTableId, objectManager, nextNodeId);
 
         indexletMap.insert(std::make_pair(TableAndIndexId{tableId, indexId},
                 Indexlet(firstKey, firstKeyLength, firstNotOwnedKey,
-                        firstNotOwnedKeyLength, bt, state)));
+                        firstNotOwnedKeyLength, bt, state, tree,
+                        backingTableId)));
 
         return true;
     }
@@ -117,6 +142,8 @@ IndexletManager::addIndexlet(
  * Transition the state field associated with a given indexlet from a specific
  * old state to a given new state. This is typically used when recovery has
  * completed and a indexlet is changed from the RECOVERING to NORMAL state.
+ * An indexlet kept in memory has its tree rebuilt from the backing table
+ * when it moves from RECOVERING to NORMAL.
  *
  * \param tableId
  *      Id for a particular table.
@@ -168,6 +195,12 @@ IndexletManager::changeState(uint64_t tableId, uint8_t indexId,
     }
 
     indexlet->state = newState;
+    if (oldState == Indexlet::RECOVERING && newState == Indexlet::NORMAL &&
+            indexlet->tree != NULL) {
+        Lock indexletLock(indexlet->indexletMutex);
+        indexletMapLock.unlock();
+        rebuildTree(indexlet, indexletLock);
+    }
     return true;
 }
 
@@ -210,6 +243,7 @@ IndexletManager::deleteIndexlet(
                 tableId, indexId);
     } else {
         delete (&it->second)->bt;
+        delete (&it->second)->tree;
         indexletMap.erase(it);
     }
 }
@@ -317,6 +351,46 @@ IndexletManager::isGreaterOrEqual(Buffer* nodeObjectValue,
             BtreeEntry{compareKey, compareKeyLength, 0UL});
 }
 
+/**
+ * Given an object from the backing table of an indexlet, check if it holds
+ * (or points to nodes holding) any entries whose key is greater than or
+ * equal to compareKey. This is used to decide which objects to send when
+ * part of an indexlet is migrated.
+ *
+ * \param indexObject
+ *      An object from the backing table of an indexlet: either a node of an
+ *      IndexBtree or, for indexlets kept in memory, a single index entry
+ *      (see writeEntryObject).
+ * \param compareKey
+ *      The key to compare against.
+ * \param compareKeyLength
+ *      Length of compareKey.
+ *
+ * \return
+ *      True if indexObject holds (or points to nodes holding) any entries
+ *      whose key is greater than or equal to compareKey; false otherwise.
+ */
+bool
+IndexletManager::isGreaterOrEqual(Object& indexObject,
+        const void* compareKey, uint16_t compareKeyLength)
+{
+    if (!inMemoryIndexlets) {
+        Buffer nodeObjectValue;
+        indexObject.appendValueToBuffer(&nodeObjectValue);
+        return isGreaterOrEqual(&nodeObjectValue, compareKey,
+                compareKeyLength);
+    }
+
+    KeyLength objectKeyLength;
+    const char* objectKey = static_cast<const char*>(
+            indexObject.getKey(0, &objectKeyLength));
+    if (objectKeyLength < sizeof(uint64_t))
+        return false;
+    return IndexKey::keyCompare(objectKey + sizeof(uint64_t),
+            downCast<uint16_t>(objectKeyLength - sizeof(uint64_t)),
+            compareKey, compareKeyLength) >= 0;
+}
+
 /**
  * For the indexlet containing truncateKey, modify metadata such that the
  * firstNotOwnedKey of that indexlet is truncateKey.
@@ -351,13 +425,21 @@ IndexletManager::truncateIndexlet(uint64_t tableId, uint8_t indexId,
     free(indexlet->firstNotOwnedKey);
     indexlet->firstNotOwnedKey = malloc(truncateKeyLength);
     memcpy(indexlet->firstNotOwnedKey, truncateKey, truncateKeyLength);
+
+    // The objects holding the entries that were dropped stay in the log:
+    // tombstones for them would be migrated along with the entries and
+    // delete them at the receiver too.
+    if (indexlet->tree != NULL) {
+        Lock indexletLock(indexlet->indexletMutex);
+        indexlet->tree->truncate(truncateKey, truncateKeyLength);
+    }
 }
 
 /**
  * Given a secondary key, find the indexlet that contains it and set its
  * nextNodeId to the given nextNodeId if the given nextNodeId is higher than
- * the current nextNodeId. If there is no just indexlet, then the function
- * does nothing.
+ * the current nextNodeId. If there is no just indexlet, or it is kept in
+ * memory (and so has no nodes), then the function does nothing.
  *
  * \param tableId
  *      Id for a particular table.
@@ -384,6 +466,8 @@ IndexletManager::setNextNodeIdIfHigher(uint64_t tableId, uint8_t indexId,
     }
 
     IndexletManager::Indexlet* indexlet = &it->second;
+    if (indexlet->bt == NULL)
+        return;
     if (indexlet->bt->getNextNodeId() < nextNodeId)
         (&it->second)->bt->setNextNodeId(nextNodeId);
 }
@@ -552,6 +636,78 @@ IndexletManager::getIndexlet(uint64_t tableId, uint8_t indexId,
     return indexletMap.end();
 }
 
+/**
+ * Struct used to pass parameters into rebuildTreeEntry through
+ * ObjectManager::forEachObjectInTable.
+ */
+struct RebuildTreeParameters {
+    /// The indexlet whose tree is being rebuilt.
+    IndexletManager::Indexlet* indexlet;
+};
+
+/**
+ * Refill the tree of an indexlet kept in memory from the objects in its
+ * backing table, which were recovered or migrated there.
+ *
+ * \param indexlet
+ *      The indexlet whose tree is to be rebuilt.
+ * \param indexletLock
+ *      Ensures that the caller holds the indexlet's lock.
+ */
+void
+IndexletManager::rebuildTree(Indexlet* indexlet, Lock& indexletLock)
+{
+    uint64_t startTicks = Cycles::rdtsc();
+    RebuildTreeParameters params = { indexlet };
+    indexlet->tree->clear();
+    objectManager->forEachObjectInTable(indexlet->backingTableId,
+            rebuildTreeEntry, &params);
+    LOG(NOTICE, "Rebuilt in-memory indexlet with backing table %lu "
+            "(%lu entries) in %.1f ms", indexlet->backingTableId,
+            indexlet->tree->size(),
+            Cycles::toSeconds(Cycles::rdtsc() - startTicks) * 1e03);
+}
+
+/**
+ * Add the index entry held in an object to the tree being rebuilt by
+ * rebuildTree, if the entry belongs to the indexlet; the backing table may
+ * still hold entries for parts of the indexlet that were migrated away.
+ *
+ * \param key
+ *      Key of the object, as written by writeEntryObject.
+ * \param cookie
+ *      Pointer to the RebuildTreeParameters of the rebuild.
+ */
+void
+IndexletManager::rebuildTreeEntry(Key& key, void* cookie)
+{
+    RebuildTreeParameters* params =
+            reinterpret_cast<RebuildTreeParameters*>(cookie);
+    Indexlet* indexlet = params->indexlet;
+
+    KeyLength objectKeyLength = key.getStringKeyLength();
+    if (objectKeyLength < sizeof(uint64_t))
+        return;
+    const char* objectKey = static_cast<const char*>(key.getStringKey());
+    uint64_t pKHash;
+    memcpy(&pKHash, objectKey, sizeof(pKHash));
+    const void* entryKey = objectKey + sizeof(uint64_t);
+    uint16_t entryKeyLength =
+            downCast<uint16_t>(objectKeyLength - sizeof(uint64_t));
+
+    if (IndexKey::keyCompare(indexlet->firstKey, indexlet->firstKeyLength,
+            entryKey, entryKeyLength) > 0) {
+        return;
+    }
+    if (indexlet->firstNotOwnedKey != NULL &&
+            IndexKey::keyCompare(entryKey, entryKeyLength,
+                    indexlet->firstNotOwnedKey,
+                    indexlet->firstNotOwnedKeyLength) >= 0) {
+        return;
+    }
+    indexlet->tree->insert(BtreeEntry(entryKey, entryKeyLength, pKHash));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ////////////////////////// Index data related functions ///////////////////////
 /////////////////////////////////// PUBLIC ////////////////////////////////////
@@ -574,6 +730,9 @@ IndexletManager::getIndexlet(uint64_t tableId, uint8_t indexId,
  *      Returns STATUS_OK if the insert succeeded.
  *      Returns STATUS_UNKNOWN_INDEXLET if the server does not own an indexlet
  *      that could contain this index entry.
+ *      For indexlets kept in memory, may also return STATUS_RETRY if the
+ *      log is out of space, or STATUS_INVALID_PARAMETER if the key is too
+ *      long to be persisted along with the primary key hash.
  */
 Status
 IndexletManager::insertEntry(uint64_t tableId, uint8_t indexId,
@@ -598,9 +757,85 @@ IndexletManager::insertEntry(uint64_t tableId, uint8_t indexId,
     indexletMapLock.unlock();
 
     BtreeEntry entry = BtreeEntry(key, keyLength, pKHash);
-    indexlet->bt->insert(entry);
+    if (indexlet->tree == NULL) {
+        indexlet->bt->insert(entry);
+        return STATUS_OK;
+    }
 
-    return STATUS_OK;
+    if (indexlet->tree->exists(entry))
+        return STATUS_OK;
+    Status status = writeEntryObject(indexlet, entry, false);
+    if (status == STATUS_OK)
+        indexlet->tree->insert(entry);
+    return status;
+}
+
+/**
+ * Helper for lookupIndexKeys: append to the response the primary key hashes
+ * of the entries of an index tree that fall in the requested range, stopping
+ * early if the response fills up.
+ *
+ * \param tree
+ *      Tree holding the entries of the indexlet: an IndexBtree or IndexTree.
+ * \param reqHdr
+ *      Header of the LOOKUP_INDEX_KEYS request.
+ * \param firstKey
+ *      Key of the first entry to return (along with the
+ *      firstAllowedKeyHash in reqHdr).
+ * \param lastKey
+ *      Key of the last entries to return.
+ * \param respHdr
+ *      Header of the response; numHashes is set here, and so are
+ *      nextKeyLength and nextKeyHash if the response filled up.
+ * \param rpc
+ *      The rpc, whose reply payload receives the hashes (and the next key,
+ *      if the response filled up).
+ * \return
+ *      True if the response filled up before all the entries in the range
+ *      were returned, false otherwise.
+ */
+template<typename Tree>
+static bool
+appendEntriesInRange(Tree* tree,
+        const WireFormat::LookupIndexKeys::Request* reqHdr,
+        const void* firstKey, const void* lastKey,
+        WireFormat::LookupIndexKeys::Response* respHdr,
+        Service::Rpc* rpc)
+{
+    // We want to use lower_bound() instead of find() because the firstKey
+    // may not correspond to a key in the indexlet.
+    auto iter = tree->lower_bound(BtreeEntry {
+            firstKey, reqHdr->firstKeyLength, reqHdr->firstAllowedKeyHash});
+    auto iterEnd = tree->end();
+
+    respHdr->numHashes = 0;
+
+    while (iter != iterEnd) {
+        BtreeEntry currEntry = *iter;
+        // If we have overshot the range to be returned (indicated by lastKey),
+        // then break. Otherwise continue appending entries to response rpc.
+        if (IndexKey::keyCompare(currEntry.key, currEntry.keyLength,
+                lastKey, reqHdr->lastKeyLength) > 0)
+        {
+            return false;
+        }
+
+        if (respHdr->numHashes < reqHdr->maxNumHashes) {
+            // Can alternatively use iter.data() instead of iter.key().pKHash,
+            // but we might want to make data NULL in the future, so might
+            // as well use the pKHash from key right away.
+            rpc->replyPayload->emplaceAppend<uint64_t>(currEntry.pKHash);
+            respHdr->numHashes += 1;
+            ++iter;
+        } else {
+            respHdr->nextKeyLength = uint16_t(currEntry.keyLength);
+            respHdr->nextKeyHash = currEntry.pKHash;
+            rpc->replyPayload->append(currEntry.key,
+                    uint32_t(currEntry.keyLength));
+            return true;
+        }
+    }
+    return false;
 }
 
 /**
@@ -651,60 +886,31 @@ IndexletManager::lookupIndexKeys(
     Lock indexletLock(indexlet->indexletMutex);
     indexletMapLock.unlock();
 
-    // We want to use lower_bound() instead of find() because the firstKey
-    // may not correspond to a key in the indexlet.
-    auto iter = indexlet->bt->lower_bound(BtreeEntry {
-            firstKey, firstKeyLength, reqHdr->firstAllowedKeyHash});
-    auto iterEnd = indexlet->bt->end();
-    bool rpcMaxedOut = false;
-
-    respHdr->numHashes = 0;
-
-    while (iter != iterEnd) {
-        BtreeEntry currEntry = *iter;
-        // If we have overshot the range to be returned (indicated by lastKey),
-        // then break. Otherwise continue appending entries to response rpc.
-        if (IndexKey::keyCompare(currEntry.key, currEntry.keyLength,
-                lastKey, lastKeyLength) > 0)
-        {
-            break;
-        }
+    bool rpcMaxedOut;
+    if (indexlet->tree != NULL) {
+        rpcMaxedOut = appendEntriesInRange(indexlet->tree, reqHdr,
+                firstKey, lastKey, respHdr, rpc);
+    } else {
+        rpcMaxedOut = appendEntriesInRange(indexlet->bt, reqHdr,
+                firstKey, lastKey, respHdr, rpc);
+    }
 
-        if (respHdr->numHashes < reqHdr->maxNumHashes) {
-            // Can alternatively use iter.data() instead of iter.key().pKHash,
-            // but we might want to make data NULL in the future, so might
-            // as well use the pKHash from key right away.
-            rpc->replyPayload->emplaceAppend<uint64_t>(currEntry.pKHash);
-            respHdr->numHashes += 1;
-            ++iter;
+    // If the reply filled up, appendEntriesInRange has already filled in
+    // the key and hash of the next entry to return.
+    if (!rpcMaxedOut) {
+        if (IndexKey::keyCompare(lastKey, lastKeyLength,
+                indexlet->firstNotOwnedKey,
+                indexlet->firstNotOwnedKeyLength) > 0) {
+            respHdr->nextKeyLength = indexlet->firstNotOwnedKeyLength;
+            respHdr->nextKeyHash = 0;
+            rpc->replyPayload->append(indexlet->firstNotOwnedKey,
+                    indexlet->firstNotOwnedKeyLength);
         } else {
-            rpcMaxedOut = true;
-            break;
+            respHdr->nextKeyHash = 0;
+            respHdr->nextKeyLength = 0;
         }
     }
 
-    if (rpcMaxedOut) {
-
-        respHdr->nextKeyLength = uint16_t(iter->keyLength);
-        respHdr->nextKeyHash = iter->pKHash;
-        rpc->replyPayload->append(iter->key, uint32_t(iter->keyLength));
-
-    } else if (IndexKey::keyCompare(
-            lastKey, lastKeyLength,
-            indexlet->firstNotOwnedKey, indexlet->firstNotOwnedKeyLength) > 0) {
-
-        respHdr->nextKeyLength = indexlet->firstNotOwnedKeyLength;
-        respHdr->nextKeyHash = 0;
-        rpc->replyPayload->append(indexlet->firstNotOwnedKey,
-                indexlet->firstNotOwnedKeyLength);
-
-    } else {
-
-        respHdr->nextKeyHash = 0;
-        respHdr->nextKeyLength = 0;
-
-    }
-
     respHdr->common.status = STATUS_OK;
 }
 
@@ -727,6 +933,8 @@ IndexletManager::lookupIndexKeys(
  *      exist.
  *      Returns STATUS_UNKNOWN_INDEXLET if the server does not own an indexlet
  *      containing this index entry.
+ *      For indexlets kept in memory, may also return STATUS_RETRY if the
+ *      log is out of space.
  */
 Status
 IndexletManager::removeEntry(uint64_t tableId, uint8_t indexId,
@@ -751,9 +959,18 @@ IndexletManager::removeEntry(uint64_t tableId, uint8_t indexId,
     // Note that we don't have to explicitly compare the key hash in value
     // since it is also a part of the key that gets compared in the tree
     // module.
-    indexlet->bt->erase(BtreeEntry {key, keyLength, pKHash});
+    BtreeEntry entry = BtreeEntry(key, keyLength, pKHash);
+    if (indexlet->tree == NULL) {
+        indexlet->bt->erase(entry);
+        return STATUS_OK;
+    }
 
-    return STATUS_OK;
+    if (!indexlet->tree->exists(entry))
+        return STATUS_OK;
+    Status status = writeEntryObject(indexlet, entry, true);
+    if (status == STATUS_OK)
+        indexlet->tree->erase(entry);
+    return status;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -795,7 +1012,67 @@ IndexletManager::existsIndexEntry(
     Lock indexletLock(indexlet->indexletMutex);
     indexletMapLock.unlock();
 
+    if (indexlet->tree != NULL)
+        return indexlet->tree->exists(BtreeEntry {key, keyLength, pKHash});
     return indexlet->bt->exists(BtreeEntry {key, keyLength, pKHash});
 }
 
+/**
+ * Persist an insertion or removal of an entry of an indexlet kept in
+ * memory. Each entry is stored as an object of its own in the indexlet's
+ * backing table, whose primary key is the primary key hash of the entry
+ * followed by its secondary key and whose value is empty; a removal writes
+ * a tombstone for that object. Recovery and migration handle these like any
+ * other objects, and rebuildTree turns them back into a tree.
+ *
+ * \param indexlet
+ *      The indexlet the entry belongs to. The caller must hold its lock.
+ * \param entry
+ *      The entry that is inserted or removed.
+ * \param remove
+ *      True if the entry is being removed, false if it is being inserted.
+ * \return
+ *      STATUS_OK if the change was persisted, STATUS_RETRY if the log is out
+ *      of space, or STATUS_INVALID_PARAMETER if the key is too long to be
+ *      stored along with the primary key hash.
+ */
+Status
+IndexletManager::writeEntryObject(Indexlet* indexlet, const BtreeEntry& entry,
+        bool remove)
+{
+    if (entry.keyLength > static_cast<KeyLength>(~0) - sizeof(uint64_t))
+        return STATUS_INVALID_PARAMETER;
+
+    Buffer keyBuffer;
+    keyBuffer.emplaceAppend<uint64_t>(entry.pKHash);
+    keyBuffer.appendCopy(entry.key, entry.keyLength);
+    Key objectKey(indexlet->backingTableId,
+            keyBuffer.getRange(0, keyBuffer.size()),
+            downCast<KeyLength>(keyBuffer.size()));
+
+    Buffer logBuffer;
+    uint32_t numEntries = 1;
+    Status status;
+    if (remove) {
+        status = objectManager->writeTombstone(objectKey, &logBuffer);
+    } else {
+        Buffer objectBuffer;
+        Object object(objectKey, "", 0, 1, 0, objectBuffer);
+        bool tombstoneAdded = false;
+        status = objectManager->prepareForLog(object, &logBuffer, NULL,
+                &tombstoneAdded);
+        if (tombstoneAdded)
+            numEntries = 2;
+    }
+    if (status != STATUS_OK)
+        return status;
+
+    // No tombstone is needed if the object doesn't exist.
+    if (logBuffer.size() == 0)
+        return STATUS_OK;
+    if (!objectManager->flushEntriesToLog(&logBuffer, numEntries))
+        return STATUS_RETRY;
+    return STATUS_OK;
+}
+
 } //namespace
@@ -25,6 +25,7 @@
 #include "Object.h"
 #include "Indexlet.h"
 #include "IndexKey.h"
+#include "IndexTree.h"
 #include "ObjectManager.h"
 #include "Service.h"
 #include "WireFormat.h"
@@ -66,10 +67,13 @@ class IndexletManager {
 
         Indexlet(const void *firstKey, uint16_t firstKeyLength,
                  const void *firstNotOwnedKey, uint16_t firstNotOwnedKeyLength,
-                 IndexBtree *bt, IndexletManager::Indexlet::State state)
+                 IndexBtree *bt, IndexletManager::Indexlet::State state,
+                 IndexTree* tree = NULL, uint64_t backingTableId = 0)
             : RAMCloud::Indexlet(firstKey, firstKeyLength, firstNotOwnedKey,
                                  firstNotOwnedKeyLength)
             , bt(bt)
+            , tree(tree)
+            , backingTableId(backingTableId)
             , state(state)
             , indexletMutex("Indexlet")
         {
@@ -78,6 +82,8 @@ class IndexletManager {
         Indexlet(const Indexlet& indexlet)
             : RAMCloud::Indexlet(indexlet)
             , bt(indexlet.bt)
+            , tree(indexlet.tree)
+            , backingTableId(indexlet.backingTableId)
             , state(indexlet.state)
             , indexletMutex("Indexlet")
         {}
@@ -100,12 +106,24 @@ class IndexletManager {
             }
 
             this->bt = indexlet.bt;
+            this->tree = indexlet.tree;
+            this->backingTableId = indexlet.backingTableId;
             this->state = indexlet.state;
             return *this;
         }
 
+        /// Entries of the indexlet, stored as tree nodes in the backing
+        /// table; NULL if the indexlet is kept in memory (see #tree).
         IndexBtree *bt;
 
+        /// Entries of the indexlet, if it is kept in memory; NULL otherwise.
+        /// Each entry is also persisted as an object in the backing table
+        /// (see IndexletManager::writeEntryObject).
+        IndexTree* tree;
+
+        /// Id of the table holding the persistent copy of #tree.
+        uint64_t backingTableId;
+
         /// The state of the tablet, see State.
         State state;
 
@@ -139,6 +157,8 @@ class IndexletManager {
             const void *key, uint16_t keyLength);
     bool isGreaterOrEqual(Buffer* nodeObjectValue,
             const void* compareKey, uint16_t compareKeyLength);
+    bool isGreaterOrEqual(Object& indexObject,
+            const void* compareKey, uint16_t compareKeyLength);
     void truncateIndexlet(uint64_t tableId, uint8_t indexId,
             const void* truncateKey, uint16_t truncateKeyLength);
     void setNextNodeIdIfHigher(uint64_t tableId, uint8_t indexId,
@@ -156,7 +176,8 @@ class IndexletManager {
             const void* key, KeyLength keyLength,
             uint64_t pKHash);
 
-    explicit IndexletManager(Context* context, ObjectManager* objectManager);
+    explicit IndexletManager(Context* context, ObjectManager* objectManager,
+            bool inMemoryIndexlets = false);
 
   PROTECTED:
     // Note: I'm using unique_lock (instead of lock_guard) with mutex because
@@ -217,6 +238,11 @@ class IndexletManager {
     /// Object Manager to handle mapping of index as objects
     ObjectManager* objectManager;
 
+    /// If true, new indexlets are kept in memory in an IndexTree, with each
+    /// entry persisted as an object of its own, instead of in an IndexBtree.
+    /// See ServerConfig::Master::inMemoryIndexlets.
+    const bool inMemoryIndexlets;
+
     /////////////////////////// Meta-data related functions //////////////////
 
     IndexletManager::IndexletMap::iterator findIndexlet(
@@ -227,12 +253,16 @@ class IndexletManager {
             const void *firstKey, uint16_t firstKeyLength,
             const void *firstNotOwnedKey, uint16_t firstNotOwnedKeyLength,
             Lock& mutex);
+    void rebuildTree(Indexlet* indexlet, Lock& indexletLock);
+    static void rebuildTreeEntry(Key& key, void* cookie);
 
     /////////////////////////// Index data related functions //////////////////
 
     bool existsIndexEntry(
             uint64_t tableId, uint8_t indexId,
             const void* key, KeyLength keyLength, uint64_t pKHash);
+    Status writeEntryObject(Indexlet* indexlet, const BtreeEntry& entry,
+            bool remove);
 
     DISALLOW_COPY_AND_ASSIGN(IndexletManager);
 };
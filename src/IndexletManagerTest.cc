@@ -1002,4 +1002,110 @@ TEST_F(IndexletManagerTest, removeEntry_keyNotFound) {
     EXPECT_EQ(STATUS_OK, removeStatus);
 }
 
+/**
+ * Read the object that persists an entry of an in-memory indexlet (see
+ * IndexletManager::writeEntryObject).
+ */
+static Status
+readEntryObject(ObjectManager* objectManager, uint64_t backingTableId,
+        const char* key, uint64_t pKHash)
+{
+    Buffer keyBuffer;
+    keyBuffer.emplaceAppend<uint64_t>(pKHash);
+    keyBuffer.appendCopy(key, downCast<uint32_t>(strlen(key)));
+    Key objectKey(backingTableId, keyBuffer.getRange(0, keyBuffer.size()),
+            downCast<KeyLength>(keyBuffer.size()));
+    Buffer value;
+    return objectManager->readObject(objectKey, &value, NULL, NULL);
+}
+
+TEST_F(IndexletManagerTest, inMemory_insertAndRemoveEntry) {
+    ObjectManager* objectManager =
+            &cluster.contexts[0]->getMasterService()->objectManager;
+    IndexletManager memIm(cluster.contexts[0], objectManager, true);
+    memIm.addIndexlet(dataTableId, 1, backingTableId, "a", 1, "k", 1);
+    IndexletManager::Indexlet* indexlet =
+            memIm.findIndexlet(dataTableId, 1, "a", 1);
+    EXPECT_TRUE(indexlet->bt == NULL);
+    ASSERT_TRUE(indexlet->tree != NULL);
+
+    EXPECT_EQ(STATUS_OK, memIm.insertEntry(dataTableId, 1, "air", 3, 5678));
+    EXPECT_EQ(STATUS_OK, memIm.insertEntry(dataTableId, 1, "air", 3, 5678));
+    EXPECT_EQ(STATUS_OK, memIm.insertEntry(dataTableId, 1, "fire", 4, 1));
+    EXPECT_EQ(2U, indexlet->tree->size());
+    EXPECT_TRUE(memIm.existsIndexEntry(dataTableId, 1, "air", 3, 5678));
+    EXPECT_EQ(STATUS_OK,
+            readEntryObject(objectManager, backingTableId, "air", 5678));
+
+    EXPECT_EQ(STATUS_OK, memIm.removeEntry(dataTableId, 1, "air", 3, 5678));
+    EXPECT_EQ(STATUS_OK, memIm.removeEntry(dataTableId, 1, "air", 3, 5678));
+    EXPECT_FALSE(memIm.existsIndexEntry(dataTableId, 1, "air", 3, 5678));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            readEntryObject(objectManager, backingTableId, "air", 5678));
+    EXPECT_TRUE(memIm.existsIndexEntry(dataTableId, 1, "fire", 4, 1));
+}
+
+TEST_F(IndexletManagerTest, inMemory_rebuildTree) {
+    ObjectManager* objectManager =
+            &cluster.contexts[0]->getMasterService()->objectManager;
+    IndexletManager memIm(cluster.contexts[0], objectManager, true);
+    memIm.addIndexlet(dataTableId, 1, backingTableId, "a", 1, "z", 1);
+    memIm.insertEntry(dataTableId, 1, "air", 3, 1);
+    memIm.insertEntry(dataTableId, 1, "earth", 5, 2);
+    memIm.insertEntry(dataTableId, 1, "water", 5, 3);
+    memIm.removeEntry(dataTableId, 1, "earth", 5, 2);
+
+    // Another manager picks up the part of the index up to "m" from the
+    // objects in the backing table, as after a recovery.
+    IndexletManager recovered(cluster.contexts[0], objectManager, true);
+    recovered.addIndexlet(dataTableId, 1, backingTableId, "a", 1, "m", 1,
+            IndexletManager::Indexlet::RECOVERING);
+    IndexletManager::Indexlet* indexlet =
+            recovered.findIndexlet(dataTableId, 1, "a", 1);
+    EXPECT_EQ(0U, indexlet->tree->size());
+
+    EXPECT_TRUE(recovered.changeState(dataTableId, 1, "a", 1, "m", 1,
+            IndexletManager::Indexlet::RECOVERING,
+            IndexletManager::Indexlet::NORMAL));
+    EXPECT_EQ(1U, indexlet->tree->size());
+    EXPECT_TRUE(recovered.existsIndexEntry(dataTableId, 1, "air", 3, 1));
+}
+
+TEST_F(IndexletManagerTest, inMemory_truncateIndexlet) {
+    ObjectManager* objectManager =
+            &cluster.contexts[0]->getMasterService()->objectManager;
+    IndexletManager memIm(cluster.contexts[0], objectManager, true);
+    memIm.addIndexlet(dataTableId, 1, backingTableId, "a", 1, "z", 1);
+    memIm.insertEntry(dataTableId, 1, "air", 3, 1);
+    memIm.insertEntry(dataTableId, 1, "water", 5, 2);
+
+    memIm.truncateIndexlet(dataTableId, 1, "m", 1);
+    IndexletManager::Indexlet* indexlet =
+            memIm.findIndexlet(dataTableId, 1, "a", 1);
+    EXPECT_EQ(1U, indexlet->tree->size());
+
+    // The object stays behind, so that it can be migrated.
+    EXPECT_EQ(STATUS_OK,
+            readEntryObject(objectManager, backingTableId, "water", 2));
+}
+
+TEST_F(IndexletManagerTest, inMemory_isGreaterOrEqual) {
+    ObjectManager* objectManager =
+            &cluster.contexts[0]->getMasterService()->objectManager;
+    IndexletManager memIm(cluster.contexts[0], objectManager, true);
+
+    uint64_t pKHash = 0x7a7a7a7a7a7a7a7a;
+    Buffer keyBuffer;
+    keyBuffer.emplaceAppend<uint64_t>(pKHash);
+    keyBuffer.appendCopy("fire", 4);
+    Key key(backingTableId, keyBuffer.getRange(0, keyBuffer.size()),
+            downCast<KeyLength>(keyBuffer.size()));
+    Buffer objectBuffer;
+    Object object(key, "", 0, 1, 0, objectBuffer);
+
+    EXPECT_TRUE(memIm.isGreaterOrEqual(object, "fire", 4));
+    EXPECT_TRUE(memIm.isGreaterOrEqual(object, "e", 1));
+    EXPECT_FALSE(memIm.isGreaterOrEqual(object, "g", 1));
+}
+
 }  // namespace RAMCloud
@@ -125,9 +125,13 @@ InfRcTransport::InfRcTransport(Context* context,
     : context(context)
     , realInfiniband()
     , infiniband()
+    , bufferSize(0)
     , rxBuffers()
     , txBuffers()
     , freeTxBuffers()
+    , txBufferCount(0)
+    , serverRxBufferCount(0)
+    , clientRxBufferCount(0)
     , serverSrq(NULL)
     , clientSrq(NULL)
     , serverRxCq(NULL)
@@ -140,7 +144,7 @@ InfRcTransport::InfRcTransport(Context* context,
     , clientPort(0)
     , serverPortMap()
     , clientSendQueue()
-    , numUsedClientSrqBuffers(MAX_SHARED_RX_QUEUE_DEPTH)
+    , numUsedClientSrqBuffers(0)
     , numFreeServerSrqBuffers(0)
     , outstandingRpcs()
     , pendingOutputBytes(0)
@@ -151,6 +155,9 @@ InfRcTransport::InfRcTransport(Context* context,
     , logMemoryBase(0)
     , logMemoryBytes(0)
     , logMemoryRegion(0)
+    , remoteReadRegions()
+    , pendingRemoteAccess(NULL)
+    , remoteAccessStatus(IBV_WC_SUCCESS)
     , serverRpcPool()
     , clientRpcPool()
     , deadQueuePairs()
@@ -278,26 +285,18 @@ InfRcTransport::InfRcTransport(Context* context,
     // and round up to the next multiple of 4096.  This approach isn't
     // perfect (for example buffers of 1<<23 bytes also seem to be slow)
     // but it will work for now.
-    uint32_t bufferSize = (getMaxRpcSize() + 4095) & ~0xfff;
-
-    rxBuffers.construct(infiniband->pd,
-                        bufferSize,
-                        uint32_t(MAX_SHARED_RX_QUEUE_DEPTH * 2));
-    uint32_t i = 0;
-    foreach (auto& bd, *rxBuffers) {
-        if (i < MAX_SHARED_RX_QUEUE_DEPTH)
-            postSrqReceiveAndKickTransmit(serverSrq, &bd);
-        else
-            postSrqReceiveAndKickTransmit(clientSrq, &bd);
-        ++i;
-    }
-    assert(numUsedClientSrqBuffers == 0);
-
-    txBuffers.construct(infiniband->pd,
-                        bufferSize,
-                        uint32_t(MAX_TX_QUEUE_DEPTH));
-    foreach (auto& bd, *txBuffers)
-        freeTxBuffers.push_back(&bd);
+    bufferSize = (getMaxRpcSize() + 4095) & ~0xfff;
+
+    // The queues and completion queues are created with their maximum
+    // depths up front, but buffers are only registered for the initial
+    // depths; more are added as the load requires (see addReceiveBuffers
+    // and addTransmitBuffers).
+    while (serverRxBufferCount < INITIAL_SHARED_RX_QUEUE_DEPTH)
+        addReceiveBuffers(serverSrq);
+    while (clientRxBufferCount < INITIAL_SHARED_RX_QUEUE_DEPTH)
+        addReceiveBuffers(clientSrq);
+    while (txBufferCount < INITIAL_TX_QUEUE_DEPTH)
+        addTransmitBuffers();
 
     // create completion queues for server receive, client receive, and
     // server/client transmit
@@ -468,7 +467,8 @@ InfRcTransport::InfRcSession::cancelRequest(
             // So, try to wait for completion, but give up after 1ms if it
             // doesn't complete.
             uint64_t start = Cycles::rdtsc();
-            while (transport->freeTxBuffers.size() != MAX_TX_QUEUE_DEPTH) {
+            while (transport->freeTxBuffers.size() !=
+                    transport->txBufferCount) {
                 transport->reapTxBuffers();
                 // Must invoke the poller to process incoming requests,
                 // in order to handle occasional situations where all of the
@@ -542,6 +542,117 @@ InfRcTransport::InfRcSession::sendRequest(Buffer* request,
     rpc->sendOrQueue();
 }
 
+// See Transport::Session::readRemote for documentation.
+bool
+InfRcTransport::InfRcSession::readRemote(uint64_t remoteAddress,
+        uint32_t remoteKey, uint32_t length, void* dest)
+{
+    InfRcTransport *t = transport;
+    if (qp == NULL || length > t->getMaxRpcSize() ||
+            t->pendingRemoteAccess != NULL) {
+        return false;
+    }
+
+    // The data lands in a transmit buffer, since they are already
+    // registered; this also keeps the read from overflowing the send queue.
+    BufferDescriptor* bd = t->getTransmitBuffer();
+    bd->messageBytes = 0;
+    bd->remoteLid = qp->getRemoteLid();
+    ibv_sge isge = {
+        reinterpret_cast<uint64_t>(bd->buffer),
+        length,
+        bd->mr->lkey
+    };
+    ibv_send_wr readWorkRequest;
+    memset(&readWorkRequest, 0, sizeof(readWorkRequest));
+    readWorkRequest.wr_id = reinterpret_cast<uint64_t>(bd);
+    readWorkRequest.next = NULL;
+    readWorkRequest.sg_list = &isge;
+    readWorkRequest.num_sge = 1;
+    readWorkRequest.opcode = IBV_WR_RDMA_READ;
+    readWorkRequest.send_flags = IBV_SEND_SIGNALED;
+    readWorkRequest.wr.rdma.remote_addr = remoteAddress;
+    readWorkRequest.wr.rdma.rkey = remoteKey;
+    ibv_send_wr* badWorkRequest;
+    if (ibv_post_send(qp->qp, &readWorkRequest, &badWorkRequest)) {
+        t->freeTxBuffers.push_back(bd);
+        return false;
+    }
+
+    t->pendingRemoteAccess = bd;
+    while (t->pendingRemoteAccess != NULL) {
+        t->reapTxBuffers();
+    }
+    if (t->remoteAccessStatus != IBV_WC_SUCCESS) {
+        // A failed RDMA operation leaves the queue pair in the error state,
+        // so the session can't be used any more.
+        LOG(NOTICE, "RDMA read of %u bytes from %s failed: %s", length,
+                serviceLocator.c_str(),
+                t->infiniband->wcStatusToString(t->remoteAccessStatus));
+        abort();
+        return false;
+    }
+
+    // The buffer is back in freeTxBuffers, but nothing else can use it
+    // until we return.
+    memcpy(dest, bd->buffer, length);
+    return true;
+}
+
+// See Transport::Session::writeRemote for documentation.
+bool
+InfRcTransport::InfRcSession::writeRemote(uint64_t remoteAddress,
+        uint32_t remoteKey, Buffer* source, uint32_t offset, uint32_t length)
+{
+    InfRcTransport *t = transport;
+    if (qp == NULL || length > t->getMaxRpcSize() ||
+            t->pendingRemoteAccess != NULL) {
+        return false;
+    }
+
+    // As in readRemote, the data goes out of a transmit buffer, since
+    // those are already registered.
+    BufferDescriptor* bd = t->getTransmitBuffer();
+    bd->messageBytes = 0;
+    bd->remoteLid = qp->getRemoteLid();
+    source->copy(offset, length, bd->buffer);
+    ibv_sge isge = {
+        reinterpret_cast<uint64_t>(bd->buffer),
+        length,
+        bd->mr->lkey
+    };
+    ibv_send_wr writeWorkRequest;
+    memset(&writeWorkRequest, 0, sizeof(writeWorkRequest));
+    writeWorkRequest.wr_id = reinterpret_cast<uint64_t>(bd);
+    writeWorkRequest.next = NULL;
+    writeWorkRequest.sg_list = &isge;
+    writeWorkRequest.num_sge = 1;
+    writeWorkRequest.opcode = IBV_WR_RDMA_WRITE;
+    writeWorkRequest.send_flags = IBV_SEND_SIGNALED;
+    writeWorkRequest.wr.rdma.remote_addr = remoteAddress;
+    writeWorkRequest.wr.rdma.rkey = remoteKey;
+    ibv_send_wr* badWorkRequest;
+    if (ibv_post_send(qp->qp, &writeWorkRequest, &badWorkRequest)) {
+        t->freeTxBuffers.push_back(bd);
+        return false;
+    }
+
+    // The completion of a reliable-connection write means the data has
+    // been placed in the server's memory.
+    t->pendingRemoteAccess = bd;
+    while (t->pendingRemoteAccess != NULL) {
+        t->reapTxBuffers();
+    }
+    if (t->remoteAccessStatus != IBV_WC_SUCCESS) {
+        LOG(NOTICE, "RDMA write of %u bytes to %s failed: %s", length,
+                serviceLocator.c_str(),
+                t->infiniband->wcStatusToString(t->remoteAccessStatus));
+        abort();
+        return false;
+    }
+    return true;
+}
+
 /**
  * Constrctor for ServerPort object
  **/
@@ -879,6 +990,69 @@ InfRcTransport::postSrqReceiveAndKickTransmit(ibv_srq* srq,
     }
 }
 
+/**
+ * Register another BUFFER_GROWTH_COUNT receive buffers and post them to
+ * a shared receive queue, unless it already holds MAX_SHARED_RX_QUEUE_DEPTH
+ * buffers. Registering buffers takes a while, so this is only invoked when
+ * a queue is about to run short.
+ *
+ * \param srq
+ *      Either #serverSrq or #clientSrq.
+ * \return
+ *      True if buffers were added, false if the queue is already at its
+ *      maximum depth.
+ */
+bool
+InfRcTransport::addReceiveBuffers(ibv_srq* srq)
+{
+    uint32_t* count = (srq == clientSrq) ? &clientRxBufferCount
+                                         : &serverRxBufferCount;
+    if (*count >= MAX_SHARED_RX_QUEUE_DEPTH)
+        return false;
+    uint32_t n = MAX_SHARED_RX_QUEUE_DEPTH - *count;
+    if (n > BUFFER_GROWTH_COUNT)
+        n = BUFFER_GROWTH_COUNT;
+    rxBuffers.emplace_back(infiniband->pd, bufferSize, n);
+
+    // Post the buffers directly rather than through
+    // postSrqReceiveAndKickTransmit: they were never counted as in use.
+    foreach (auto& bd, rxBuffers.back())
+        infiniband->postSrqReceive(srq, &bd);
+    *count += n;
+    if (srq == serverSrq)
+        numFreeServerSrqBuffers += n;
+    if (*count > INITIAL_SHARED_RX_QUEUE_DEPTH) {
+        LOG(NOTICE, "Grew %s receive buffers to %u",
+                (srq == clientSrq) ? "client" : "server", *count);
+    }
+    return true;
+}
+
+/**
+ * Register another BUFFER_GROWTH_COUNT transmit buffers and add them to
+ * #freeTxBuffers, unless there are already MAX_TX_QUEUE_DEPTH of them.
+ *
+ * \return
+ *      True if buffers were added, false if the pool is already at its
+ *      maximum size.
+ */
+bool
+InfRcTransport::addTransmitBuffers()
+{
+    if (txBufferCount >= MAX_TX_QUEUE_DEPTH)
+        return false;
+    uint32_t n = MAX_TX_QUEUE_DEPTH - txBufferCount;
+    if (n > BUFFER_GROWTH_COUNT)
+        n = BUFFER_GROWTH_COUNT;
+    txBuffers.emplace_back(infiniband->pd, bufferSize, n);
+    foreach (auto& bd, txBuffers.back())
+        freeTxBuffers.push_back(&bd);
+    txBufferCount += n;
+    if (txBufferCount > INITIAL_TX_QUEUE_DEPTH)
+        LOG(NOTICE, "Grew transmit buffers to %u", txBufferCount);
+    return true;
+}
+
 /**
  * Return a free transmit buffer, wrapped by its corresponding
  * BufferDescriptor. If there are none, block until one is available.
@@ -891,11 +1065,12 @@ InfRcTransport::postSrqReceiveAndKickTransmit(ibv_srq* srq,
 Infiniband::BufferDescriptor*
 InfRcTransport::getTransmitBuffer()
 {
-    // if we've drained our free tx buffer pool, we must wait.
+    // if we've drained our free tx buffer pool, we must add more buffers
+    // or wait.
     while (freeTxBuffers.empty()) {
         reapTxBuffers();
 
-        if (freeTxBuffers.empty()) {
+        if (freeTxBuffers.empty() && !addTransmitBuffers()) {
             // We are temporarily out of buffers. Time how long it takes
             // before a transmit buffer becomes available again (a long
             // time could indicate deadlock); in the normal case this code
@@ -919,11 +1094,13 @@ InfRcTransport::getTransmitBuffer()
                     // The first time this message is printed, log all of
                     // the target addresses still outstanding.
                     if (printDetails) {
-                        foreach (auto& bd, *txBuffers) {
-                            LOG(NOTICE, "Transmit buffer with %u bytes "
-                                    "pending for lid %u, opcode %s",
-                                    bd.messageBytes, bd.remoteLid,
-                                    getOpcodeFromBuffer(&bd));
+                        foreach (auto& buffers, txBuffers) {
+                            foreach (auto& bd, buffers) {
+                                LOG(NOTICE, "Transmit buffer with %u bytes "
+                                        "pending for lid %u, opcode %s",
+                                        bd.messageBytes, bd.remoteLid,
+                                        getOpcodeFromBuffer(&bd));
+                            }
                         }
                         printDetails = false;
                     }
@@ -962,7 +1139,12 @@ InfRcTransport::reapTxBuffers()
         BufferDescriptor* bd =
                 reinterpret_cast<BufferDescriptor*>(retArray[i].wr_id);
         pendingOutputBytes -= bd->messageBytes;
-        if (retArray[i].status != IBV_WC_SUCCESS) {
+        if (bd == pendingRemoteAccess) {
+            // The caller of InfRcSession::readRemote (or writeRemote)
+            // deals with errors.
+            remoteAccessStatus = retArray[i].status;
+            pendingRemoteAccess = NULL;
+        } else if (retArray[i].status != IBV_WC_SUCCESS) {
             LOG(ERROR, "Transmit failed for buffer %lu: destination "
                     "lid %u, status %s, opcode %s",
                     reinterpret_cast<uint64_t>(bd), bd->remoteLid,
@@ -973,7 +1155,7 @@ InfRcTransport::reapTxBuffers()
     }
 
     // Has TX just transitioned to idle?
-    if (n > 0 && freeTxBuffers.size() == MAX_TX_QUEUE_DEPTH) {
+    if (n > 0 && freeTxBuffers.size() == txBufferCount) {
         // It's now safe to delete queue pairs (see comment by declaration
         // for deadQueuePairs).
         while (!deadQueuePairs.empty()) {
@@ -985,6 +1167,22 @@ InfRcTransport::reapTxBuffers()
     return n;
 }
 
+// See Transport::getRemoteKey for documentation.
+bool
+InfRcTransport::getRemoteKey(const void* address, size_t length,
+        uint32_t* key)
+{
+    const char* start = static_cast<const char*>(address);
+    foreach (ibv_mr* region, remoteReadRegions) {
+        const char* base = static_cast<const char*>(region->addr);
+        if (start >= base && start + length <= base + region->length) {
+            *key = region->rkey;
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Obtain the maximum rpc size. This is limited by the infiniband
  * specification to 2GB(!), though we artificially limit it to a
@@ -1307,7 +1505,9 @@ InfRcTransport::ClientRpc::sendOrQueue()
 {
     assert(state == PENDING);
     InfRcTransport* const t = transport;
-    if (t->numUsedClientSrqBuffers < MAX_SHARED_RX_QUEUE_DEPTH) {
+    if (t->numUsedClientSrqBuffers >= t->clientRxBufferCount)
+        t->addReceiveBuffers(t->clientSrq);
+    if (t->numUsedClientSrqBuffers < t->clientRxBufferCount) {
         // send out the request
         if (t->outstandingRpcs.empty()) {
             t->clientRpcsActiveTime.construct(
@@ -1374,7 +1574,7 @@ InfRcTransport::Poller::poll()
                 rpc.session->sessionAlarm.rpcFinished();
                 uint32_t len = response->byte_len - sizeof32(header);
                 if (t->numUsedClientSrqBuffers >=
-                        MAX_SHARED_RX_QUEUE_DEPTH / 2) {
+                        t->clientRxBufferCount / 2) {
                     // clientSrq is low on buffers, better return this one
                     rpc.response->appendCopy(bd->buffer + sizeof(header), len);
                     t->postSrqReceiveAndKickTransmit(t->clientSrq, bd);
@@ -1473,6 +1673,8 @@ InfRcTransport::Poller::poll()
             // Measurements of the YCSB benchmarks in 7/2015 suggest that
             // a value of 4 is (barely) okay, but we now use 8 to provide a
             // larger margin of safety, even if a burst of packets arrives.
+            if (t->numFreeServerSrqBuffers < 8)
+                t->addReceiveBuffers(t->serverSrq);
             if (t->numFreeServerSrqBuffers < 8) {
                 r->requestPayload.appendCopy(bd->buffer + sizeof(header), len);
                 t->postSrqReceiveAndKickTransmit(t->serverSrq, bd);
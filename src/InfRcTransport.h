@@ -20,6 +20,7 @@
  */
 
 #include <time.h>
+#include <list>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -76,13 +77,12 @@ class InfRcTransport : public Transport {
     uint32_t getMaxRpcSize() const;
 
     /**
-     * Register a memory region with the HCA for zero-copy transmission.
-     * After registration Buffer::Chunks sent in client RPC requests can
-     * be given directly to the HCA without copying into a transmit
-     * buffer first. Callers must collectively ensure this function is only
-     * once. It is possible to extend this function to support multiple
-     * regions, but for the moment we only use it to register the
-     * Log Seglets.
+     * Register a memory region with the HCA for zero-copy transmission and
+     * one-sided remote reads and writes. After registration Buffer::Chunks
+     * sent in client RPC requests can be given directly to the HCA without
+     * copying into a transmit buffer first. Only the first region registered
+     * (the Log Seglets) is used for zero-copy transmission; later regions can
+     * only be read or written remotely (see getRemoteKey).
      *
      * \param base
      *      Starting address of the region to be registered with the HCA.
@@ -91,18 +91,23 @@ class InfRcTransport : public Transport {
      */
     void registerMemory(void* base, size_t bytes)
     {
-        assert(logMemoryRegion == NULL);
-        logMemoryRegion = ibv_reg_mr(infiniband->pd.pd, base, bytes,
-            IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE);
-        if (logMemoryRegion == NULL) {
+        ibv_mr* region = ibv_reg_mr(infiniband->pd.pd, base, bytes,
+            IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
+            IBV_ACCESS_REMOTE_READ);
+        if (region == NULL) {
             LOG(ERROR, "ibv_reg_mr failed to register %Zd bytes at %p",
                 bytes, base);
             throw TransportException(HERE, "ibv_reg_mr failed");
         }
-        logMemoryBase = reinterpret_cast<uintptr_t>(base);
-        logMemoryBytes = bytes;
+        if (logMemoryRegion == NULL) {
+            logMemoryRegion = region;
+            logMemoryBase = reinterpret_cast<uintptr_t>(base);
+            logMemoryBytes = bytes;
+        }
+        remoteReadRegions.push_back(region);
         RAMCLOUD_LOG(NOTICE, "Registered %Zd bytes at %p", bytes, base);
     }
+    bool getRemoteKey(const void* address, size_t length, uint32_t* key);
     static void setName(const char* name);
 
   PRIVATE:
@@ -172,7 +177,15 @@ class InfRcTransport : public Transport {
         uint64_t nonce;
     };
 
-    static const uint32_t MAX_SHARED_RX_QUEUE_DEPTH = 32;
+    // Each shared receive queue starts out with INITIAL_SHARED_RX_QUEUE_DEPTH
+    // buffers and grows by BUFFER_GROWTH_COUNT at a time when it runs
+    // short, up to MAX_SHARED_RX_QUEUE_DEPTH; the transmit buffer pool does
+    // the same between INITIAL_TX_QUEUE_DEPTH and MAX_TX_QUEUE_DEPTH. Every
+    // buffer is as large as the largest RPC, so idle machines keep the old
+    // footprint and only busy ones (high fan-in servers, clients with many
+    // outstanding RPCs) pay for more registered memory.
+    static const uint32_t INITIAL_SHARED_RX_QUEUE_DEPTH = 32;
+    static const uint32_t MAX_SHARED_RX_QUEUE_DEPTH = 128;
 
     // Since we always use at most 1 SGE per receive request, there is no need
     // to set this parameter any higher. In fact, larger values for this
@@ -180,7 +193,9 @@ class InfRcTransport : public Transport {
     // Infiniband controller needs to fetch more data from host memory,
     // which results in a higher number of on-controller cache misses.
     static const uint32_t MAX_SHARED_RX_SGE_COUNT = 1;
-    static const uint32_t MAX_TX_QUEUE_DEPTH = 16;
+    static const uint32_t INITIAL_TX_QUEUE_DEPTH = 16;
+    static const uint32_t MAX_TX_QUEUE_DEPTH = 64;
+    static const uint32_t BUFFER_GROWTH_COUNT = 16;
     // With 64 KB seglets 1 MB is fractured into 16 or 17 pieces, plus we
     // need an entry for the headers.
     enum { MAX_TX_SGE_COUNT = 24 };
@@ -199,6 +214,10 @@ class InfRcTransport : public Transport {
         virtual string getRpcInfo();
         virtual void sendRequest(Buffer* request, Buffer* response,
             RpcNotifier* notifier);
+        virtual bool readRemote(uint64_t remoteAddress, uint32_t remoteKey,
+            uint32_t length, void* dest);
+        virtual bool writeRemote(uint64_t remoteAddress, uint32_t remoteKey,
+            Buffer* source, uint32_t offset, uint32_t length);
 
       PRIVATE:
         // Transport that manages this session.
@@ -299,6 +318,11 @@ class InfRcTransport : public Transport {
     // Extend Infiniband::postSrqReceive by issuing queued up transmissions
     void postSrqReceiveAndKickTransmit(ibv_srq* srq, BufferDescriptor *bd);
 
+    // Register more buffers for a shared receive queue or for transmits,
+    // if they are still below their maximum depth.
+    bool addReceiveBuffers(ibv_srq* srq);
+    bool addTransmitBuffers();
+
     // Grab a transmit buffer from our free list, or wait for completions if
     // necessary.
     BufferDescriptor* getTransmitBuffer();
@@ -326,13 +350,27 @@ class InfRcTransport : public Transport {
      */
     Infiniband* infiniband;
 
-    /// Infiniband receive buffers, written directly by the HCA.
-    Tub<RegisteredBuffers> rxBuffers;
+    /// Size of each receive and transmit buffer, in bytes.
+    uint32_t bufferSize;
+
+    /// Infiniband receive buffers, written directly by the HCA; one
+    /// element for each batch registered by addReceiveBuffers.
+    std::list<RegisteredBuffers> rxBuffers;
 
-    /// Infiniband transmit buffers.
-    Tub<RegisteredBuffers> txBuffers;
+    /// Infiniband transmit buffers; one element for each batch registered
+    /// by addTransmitBuffers.
+    std::list<RegisteredBuffers> txBuffers;
     vector<BufferDescriptor*> freeTxBuffers;
 
+    /// Total number of buffers in #txBuffers.
+    uint32_t txBufferCount;
+
+    /// Total number of receive buffers ever posted to #serverSrq.
+    uint32_t serverRxBufferCount;
+
+    /// Total number of receive buffers ever posted to #clientSrq.
+    uint32_t clientRxBufferCount;
+
     ibv_srq*     serverSrq;         // shared receive work queue for server
     ibv_srq*     clientSrq;         // shared receive work queue for client
     ibv_cq*      serverRxCq;        // completion queue for incoming requests
@@ -360,7 +398,7 @@ class InfRcTransport : public Transport {
      * The number of client receive buffers that are in use, either from
      * outstandingRpcs or from RPC responses that have borrowed these buffers
      * and will return them with the PayloadChunk mechanism.
-     * Invariant: numUsedClientSrqBuffers <= MAX_SHARED_RX_QUEUE_DEPTH.
+     * Invariant: numUsedClientSrqBuffers <= clientRxBufferCount.
      */
     uint32_t numUsedClientSrqBuffers;
 
@@ -460,6 +498,20 @@ class InfRcTransport : public Transport {
     /// See registerMemory().
     ibv_mr* logMemoryRegion;
 
+    /// All of the regions registered by registerMemory (including
+    /// #logMemoryRegion); clients may read or write any of them with
+    /// one-sided RDMA operations.
+    vector<ibv_mr*> remoteReadRegions;
+
+    /// The transmit buffer receiving the data for the RDMA read issued by
+    /// InfRcSession::readRemote (or holding the data for the RDMA write
+    /// issued by InfRcSession::writeRemote), or NULL if no such operation
+    /// is in progress. reapTxBuffers resets this when it completes.
+    BufferDescriptor* pendingRemoteAccess;
+
+    /// Completion status of the most recent RDMA read or write.
+    ibv_wc_status remoteAccessStatus;
+
     /// Pool allocator for our ServerRpc objects.
     ServerRpcPool<ServerRpc> serverRpcPool;
 
@@ -209,7 +209,7 @@ TEST_F(InfRcTransportTest, InfRcSession_cancelRequest_rpcSent) {
     EXPECT_EQ(1U, client.outstandingRpcs.size());
     EXPECT_EQ(1u, client.numUsedClientSrqBuffers);
     EXPECT_EQ(1, rawSession->sessionAlarm.outstandingRpcs);
-    uint32_t totalTxBuffers = InfRcTransport::MAX_TX_QUEUE_DEPTH;
+    uint32_t totalTxBuffers = client.txBufferCount;
     EXPECT_EQ(totalTxBuffers - 1, client.freeTxBuffers.size());
     session->cancelRequest(&rpc);
     EXPECT_EQ(totalTxBuffers, client.freeTxBuffers.size());
@@ -281,6 +281,59 @@ TEST_F(InfRcTransportTest, ClientRpc_sendRequest_sessionAborted) {
     EXPECT_STREQ("completed: 0, failed: 1", rpc.getState());
 }
 
+TEST_F(InfRcTransportTest, ClientRpc_sendOrQueue_growsReceiveBuffers) {
+    TestLog::Enable _;
+    Transport::SessionRef session = client.getSession(&locator);
+    EXPECT_EQ(InfRcTransport::INITIAL_SHARED_RX_QUEUE_DEPTH,
+              client.clientRxBufferCount);
+    client.numUsedClientSrqBuffers = client.clientRxBufferCount;
+    TestLog::reset();
+    MockWrapper rpc("abcdefg");
+    session->sendRequest(&rpc.request, &rpc.response, &rpc);
+    EXPECT_EQ(0U, client.clientSendQueue.size());
+    EXPECT_EQ(1U, client.outstandingRpcs.size());
+    EXPECT_EQ(InfRcTransport::INITIAL_SHARED_RX_QUEUE_DEPTH +
+              InfRcTransport::BUFFER_GROWTH_COUNT,
+              client.clientRxBufferCount);
+    EXPECT_EQ("addReceiveBuffers: Grew client receive buffers to 48",
+              TestLog::get());
+}
+
+TEST_F(InfRcTransportTest, addReceiveBuffers_maximumDepth) {
+    uint32_t freeBuffers = server.numFreeServerSrqBuffers;
+    while (server.addReceiveBuffers(server.serverSrq)) {
+        /* Empty loop body. */
+    }
+    EXPECT_EQ(InfRcTransport::MAX_SHARED_RX_QUEUE_DEPTH,
+              server.serverRxBufferCount);
+    EXPECT_EQ(freeBuffers + InfRcTransport::MAX_SHARED_RX_QUEUE_DEPTH -
+              InfRcTransport::INITIAL_SHARED_RX_QUEUE_DEPTH,
+              server.numFreeServerSrqBuffers);
+}
+
+TEST_F(InfRcTransportTest, getTransmitBuffer_growsPool) {
+    TestLog::Enable _;
+    std::vector<Infiniband::BufferDescriptor*> taken;
+    for (uint32_t i = 0; i < InfRcTransport::INITIAL_TX_QUEUE_DEPTH; i++)
+        taken.push_back(client.getTransmitBuffer());
+    EXPECT_EQ(0U, client.freeTxBuffers.size());
+
+    taken.push_back(client.getTransmitBuffer());
+    EXPECT_EQ(InfRcTransport::INITIAL_TX_QUEUE_DEPTH +
+              InfRcTransport::BUFFER_GROWTH_COUNT, client.txBufferCount);
+    EXPECT_EQ(InfRcTransport::BUFFER_GROWTH_COUNT - 1,
+              client.freeTxBuffers.size());
+    EXPECT_EQ("addTransmitBuffers: Grew transmit buffers to 32",
+              TestLog::get());
+
+    while (client.addTransmitBuffers()) {
+        /* Empty loop body. */
+    }
+    EXPECT_EQ(InfRcTransport::MAX_TX_QUEUE_DEPTH, client.txBufferCount);
+    foreach (Infiniband::BufferDescriptor* bd, taken)
+        client.freeTxBuffers.push_back(bd);
+}
+
 TEST_F(InfRcTransportTest, ServerRpc_getClientServiceLocator) {
     Transport::SessionRef session = client.getSession(&locator);
     MockWrapper rpc("request");
@@ -69,6 +69,7 @@ InfUdDriver::InfUdDriver(Context* context, const ServiceLocator *sl,
     , mutex("InfUdDriver")
     , rxBuffersInHca(0)
     , rxBufferLogThreshold(0)
+    , rxBuffersLow(false)
     , txPool()
     , QKEY(ethernet ? 0 : 0xdeadbeef)
     , rxcq(0)
@@ -86,6 +87,12 @@ InfUdDriver::InfUdDriver(Context* context, const ServiceLocator *sl,
     , zeroCopyEnd(NULL)
     , zeroCopyRegion(NULL)
     , sendsSinceLastReap(0)
+    , batchDepth(0)
+    , heldRequests()
+    , heldSges()
+    , numHeldRequests(0)
+    , unsignaledRequests(0)
+    , postedTxBuffers()
 {
     const char *ibDeviceName = NULL;
     bool macAddressProvided = false;
@@ -208,6 +215,18 @@ InfUdDriver::~InfUdDriver()
     ibv_destroy_cq(txcq);
 }
 
+/*
+ * See docs in the ``Driver'' class.
+ */
+void
+InfUdDriver::flushBatch()
+{
+    assert(batchDepth > 0);
+    batchDepth--;
+    if ((batchDepth == 0) && (numHeldRequests > 0))
+        postHeldRequests();
+}
+
 /*
  * See docs in the ``Driver'' class.
  */
@@ -233,8 +252,11 @@ InfUdDriver::getMaxPacketSize()
 InfUdDriver::BufferDescriptor*
 InfUdDriver::getTransmitBuffer()
 {
-    // if we've drained our free tx buffer pool, we must wait.
+    // if we've drained our free tx buffer pool, we must wait. Held
+    // packets won't complete until they are posted.
     if (txPool->freeBuffers.empty()) {
+        if (numHeldRequests > 0)
+            postHeldRequests();
         reapTransmitBuffers();
         if (txPool->freeBuffers.empty()) {
             // We are temporarily out of buffers. Time how long it takes
@@ -267,6 +289,53 @@ InfUdDriver::getTransmitQueueSpace(uint64_t currentTime)
     return maxTransmitQueueSize - queueEstimator.getQueueSize(currentTime);
 }
 
+/**
+ * Hand all of the work requests in heldRequests to the NIC with a single
+ * ibv_post_send call, and empty heldRequests.
+ */
+void
+InfUdDriver::postHeldRequests()
+{
+    int count = numHeldRequests;
+    numHeldRequests = 0;
+    for (int i = 0; i < count; i++) {
+        ibv_send_wr* request = &heldRequests[i];
+        request->next = (i + 1 < count) ? &heldRequests[i + 1] : NULL;
+
+        // The last request of each post is always signaled; otherwise the
+        // buffers of an idle driver could wait forever for a completion.
+        unsignaledRequests++;
+        if ((i + 1 == count) || (unsignaledRequests >= SIGNAL_INTERVAL)) {
+            request->send_flags |= IBV_SEND_SIGNALED;
+            unsignaledRequests = 0;
+        }
+        postedTxBuffers.push_back(
+                reinterpret_cast<BufferDescriptor*>(request->wr_id));
+    }
+
+#if TIME_TRACE
+    TimeTrace::record("before postSend in InfUdDriver");
+#endif
+    ibv_send_wr *bad_txWorkRequest;
+    if (ibv_post_send(qp->qp, &heldRequests[0], &bad_txWorkRequest)) {
+        LOG(WARNING, "Error posting transmit packet: %s", strerror(errno));
+
+        // The requests starting at bad_txWorkRequest never made it to the
+        // NIC. Any earlier ones that did are freed by the next signaled
+        // completion.
+        for (ibv_send_wr* request = bad_txWorkRequest; request != NULL;
+                request = request->next) {
+            postedTxBuffers.pop_back();
+            txPool->freeBuffers.push_back(
+                    reinterpret_cast<BufferDescriptor*>(request->wr_id));
+        }
+    }
+#if TIME_TRACE
+    TimeTrace::record("posted %d packets, %d free buffers", count,
+            downCast<int>(txPool->freeBuffers.size()));
+#endif
+}
+
 /**
  * Check the NIC to see if it is ready to return transmit buffers
  * from previously-transmit packets. If there are any available,
@@ -282,7 +351,13 @@ InfUdDriver::reapTransmitBuffers()
     for (int i = 0; i < numBuffers; i++) {
         BufferDescriptor* bd =
             reinterpret_cast<BufferDescriptor*>(retArray[i].wr_id);
-        txPool->freeBuffers.push_back(bd);
+        while (!postedTxBuffers.empty()) {
+            BufferDescriptor* posted = postedTxBuffers.front();
+            postedTxBuffers.pop_front();
+            txPool->freeBuffers.push_back(posted);
+            if (posted == bd)
+                break;
+        }
 
         if (retArray[i].status != IBV_WC_SUCCESS) {
             LOG(WARNING, "Infud transmit failed: %s",
@@ -291,6 +366,15 @@ InfUdDriver::reapTransmitBuffers()
     }
 }
 
+/*
+ * See docs in the ``Driver'' class.
+ */
+void
+InfUdDriver::startBatch()
+{
+    batchDepth++;
+}
+
 /*
  * See docs in the ``Driver'' class.
  */
@@ -368,7 +452,7 @@ InfUdDriver::sendPacket(const Driver::Address* addr,
     memcpy(p, header, headerLen);
     p += headerLen;
 
-    ibv_sge sges[2];
+    ibv_sge* sges = heldSges[numHeldRequests];
     sges[0].addr = reinterpret_cast<uint64_t>(bd->buffer);
     sges[0].length = bd->packetLength;
     sges[0].lkey = bd->memoryRegion->lkey;
@@ -396,7 +480,7 @@ InfUdDriver::sendPacket(const Driver::Address* addr,
         payload->next();
     }
 
-    ibv_send_wr workRequest;
+    ibv_send_wr& workRequest = heldRequests[numHeldRequests];
     memset(&workRequest, 0, sizeof(workRequest));
 
     // This id is used to locate the BufferDescriptor from the
@@ -410,7 +494,7 @@ InfUdDriver::sendPacket(const Driver::Address* addr,
     workRequest.sg_list = sges;
     workRequest.num_sge = numSges;
     workRequest.opcode = IBV_WR_SEND;
-    workRequest.send_flags = IBV_SEND_SIGNALED;
+    workRequest.send_flags = 0;
 
     // We can get a substantial latency improvement (nearly 2usec less per RTT)
     // by inlining data with the WQE for small messages. The Verbs library
@@ -418,18 +502,11 @@ InfUdDriver::sendPacket(const Driver::Address* addr,
     if (bd->packetLength <= Infiniband::MAX_INLINE_DATA)
         workRequest.send_flags |= IBV_SEND_INLINE;
 
-#if TIME_TRACE
-    TimeTrace::record("before postSend in InfUdDriver");
-#endif
-    ibv_send_wr *bad_txWorkRequest;
-    if (ibv_post_send(qp->qp, &workRequest, &bad_txWorkRequest)) {
-        LOG(WARNING, "Error posting transmit packet: %s", strerror(errno));
-        txPool->freeBuffers.push_back(bd);
-    }
-#if TIME_TRACE
-    TimeTrace::record("sent packet with %u bytes, %d free buffers",
-            totalLength, downCast<int>(txPool->freeBuffers.size()));
-#endif
+    // Outside a batch the packet is posted right away; inside one it is
+    // held until flushBatch (or until heldRequests fills up).
+    numHeldRequests++;
+    if ((batchDepth == 0) || (numHeldRequests == MAX_HELD_REQUESTS))
+        postHeldRequests();
     queueEstimator.packetQueued(bd->packetLength, Cycles::rdtsc());
     PerfStats::threadStats.networkOutputBytes += bd->packetLength;
 
@@ -594,6 +671,7 @@ InfUdDriver::refillReceiver()
     // high. Running out of buffers is a bad thing, so we want warnings in the
     // log long before that happens.
     uint32_t freeBuffers = downCast<uint32_t>(rxPool->freeBuffers.size());
+    rxBuffersLow = (freeBuffers < LOW_RX_BUFFERS);
     if (freeBuffers <= rxBufferLogThreshold) {
         double percentUsed = 100.0*static_cast<double>(
                 TOTAL_RX_BUFFERS - freeBuffers)/TOTAL_RX_BUFFERS;
@@ -21,6 +21,8 @@
 #ifndef RAMCLOUD_INFUDDRIVER_H
 #define RAMCLOUD_INFUDDRIVER_H
 
+#include <deque>
+
 #include "Common.h"
 #include "Dispatch.h"
 #include "Driver.h"
@@ -51,8 +53,11 @@ class InfUdDriver : public Driver {
     virtual int getTransmitQueueSpace(uint64_t currentTime);
     virtual void receivePackets(uint32_t maxPackets,
             std::vector<Received>* receivedPackets);
+    virtual bool receiveBuffersLow() { return rxBuffersLow; }
     virtual void registerMemory(void* base, size_t bytes);
     virtual void release(char *payload);
+    virtual void startBatch();
+    virtual void flushBatch();
     virtual void sendPacket(const Driver::Address* addr, const void* header,
                             uint32_t headerLen, Buffer::Iterator* payload,
                             int priority = 0);
@@ -138,6 +143,7 @@ class InfUdDriver : public Driver {
     };
 
     BufferDescriptor* getTransmitBuffer();
+    void postHeldRequests();
     void reapTransmitBuffers();
     void refillReceiver();
 
@@ -152,9 +158,22 @@ class InfUdDriver : public Driver {
     /// of the HCA at once.
     static const uint32_t MAX_RX_QUEUE_DEPTH = 1000;
 
+    /// When fewer than this many receive buffers are idle, the driver
+    /// reports that it is low on them (see receiveBuffersLow).
+    static const uint32_t LOW_RX_BUFFERS = TOTAL_RX_BUFFERS / 10;
+
     /// Maximum number of transmit buffers that may be outstanding at once.
     static const uint32_t MAX_TX_QUEUE_DEPTH = 50;
 
+    /// Maximum number of transmit work requests held between startBatch
+    /// and flushBatch; the batch is posted early if it fills up.
+    static const int MAX_HELD_REQUESTS = 16;
+
+    /// Only every SIGNAL_INTERVAL'th transmit work request (plus the last
+    /// one of each post) asks the NIC for a completion; see
+    /// #postedTxBuffers.
+    static const int SIGNAL_INTERVAL = 8;
+
     /*
      * Note that in UD mode, Infiniband receivers prepend a 40-byte
      * Global Routing Header (GRH) to all incoming frames. Immediately
@@ -202,6 +221,9 @@ class InfUdDriver : public Driver {
     /// drops to this level.
     uint32_t rxBufferLogThreshold;
 
+    /// Returned by receiveBuffersLow; updated by refillReceiver.
+    bool rxBuffersLow;
+
     /// Packet buffers used to transmit outgoing packets.
     Tub<BufferPool> txPool;
 
@@ -267,6 +289,28 @@ class InfUdDriver : public Driver {
     /// Used to invoke reapTransmitBuffers after every Nth packet is sent.
     int sendsSinceLastReap;
 
+    /// Number of calls to startBatch without a matching flushBatch.
+    int batchDepth;
+
+    /// Work requests built by sendPacket but not yet posted to the NIC,
+    /// together with the scatter-gather elements they refer to. They are
+    /// posted as a single linked list, so the NIC's doorbell is rung once
+    /// for all of them.
+    ibv_send_wr heldRequests[MAX_HELD_REQUESTS];
+    ibv_sge heldSges[MAX_HELD_REQUESTS][2];
+
+    /// Number of valid entries in heldRequests.
+    int numHeldRequests;
+
+    /// Number of work requests posted since the last signaled one.
+    int unsignaledRequests;
+
+    /// Transmit buffers that have been posted to the NIC, in the order
+    /// they were posted. Completions arrive in the same order but only for
+    /// signaled work requests, so a completion frees its own buffer along
+    /// with all of the ones posted before it.
+    std::deque<BufferDescriptor*> postedTxBuffers;
+
     DISALLOW_COPY_AND_ASSIGN(InfUdDriver);
 };
 
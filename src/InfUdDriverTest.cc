@@ -88,6 +88,43 @@ TEST_F(InfUdDriverTest, basics) {
     delete serverAddress;
 }
 
+TEST_F(InfUdDriverTest, sendPacket_batch) {
+    ServiceLocator serverLocator("basic+infud:");
+    InfUdDriver server(&context, &serverLocator, false);
+    InfUdDriver client(&context, NULL, false);
+    ServiceLocator sl(server.getServiceLocator());
+    Driver::Address* serverAddress = client.newAddress(&sl);
+
+    client.startBatch();
+    client.startBatch();
+    client.sendPacket(serverAddress, "p1", 2, NULL);
+    client.sendPacket(serverAddress, "p2", 2, NULL);
+    client.flushBatch();
+    client.sendPacket(serverAddress, "p3", 2, NULL);
+    EXPECT_EQ(3, client.numHeldRequests);
+    EXPECT_STREQ("no packet arrived", receivePacket(&server));
+
+    client.flushBatch();
+    EXPECT_EQ(0, client.numHeldRequests);
+    EXPECT_EQ(3u, client.postedTxBuffers.size());
+    EXPECT_EQ(0, client.unsignaledRequests);
+    EXPECT_STREQ("p1", receivePacket(&server));
+    EXPECT_STREQ("p2", receivePacket(&server));
+    EXPECT_STREQ("p3", receivePacket(&server));
+
+    // Only the last request was signaled, but its completion returns all
+    // three buffers.
+    uint64_t start = Cycles::rdtsc();
+    while (!client.postedTxBuffers.empty()
+            && (Cycles::toSeconds(Cycles::rdtsc() - start) < .1)) {
+        client.reapTransmitBuffers();
+    }
+    EXPECT_EQ(0u, client.postedTxBuffers.size());
+    EXPECT_EQ(InfUdDriver::MAX_TX_QUEUE_DEPTH,
+            client.txPool->freeBuffers.size());
+    delete serverAddress;
+}
+
 TEST_F(InfUdDriverTest, gbsOption) {
     Cycles::mockCyclesPerSec = 2e09;
     ServiceLocator serverLocator("basic+infud:gbs=40");
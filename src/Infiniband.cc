@@ -551,7 +551,8 @@ Infiniband::QueuePair::QueuePair(Infiniband& infiniband, ibv_qp_type type,
     qpa.qp_state   = IBV_QPS_INIT;
     qpa.pkey_index = 0;
     qpa.port_num   = downCast<uint8_t>(ibPhysicalPort);
-    qpa.qp_access_flags = IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE;
+    qpa.qp_access_flags = IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
+            IBV_ACCESS_REMOTE_READ;
     qpa.qkey       = QKey;
 
     int mask = IBV_QP_STATE | IBV_QP_PORT;
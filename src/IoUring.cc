@@ -0,0 +1,208 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "IoUring.h"
+#include "ShortMacros.h"
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+namespace RAMCloud {
+
+/**
+ * Create an io_uring instance.
+ *
+ * \param entries
+ *      Number of requests that can be in flight at once. submitAndWait()
+ *      accepts any number of requests, but submits them in batches of at
+ *      most this many.
+ * \throw IoUringException
+ *      If the kernel can't provide an io_uring.
+ */
+IoUring::IoUring(uint32_t entries)
+    : mutex()
+    , ringFd(-1)
+    , sqEntries(0)
+    , sqRing(MAP_FAILED)
+    , sqRingLength(0)
+    , cqRing(MAP_FAILED)
+    , cqRingLength(0)
+    , sqes(MAP_FAILED)
+    , sqesLength(0)
+    , sqTail(NULL)
+    , sqMask(NULL)
+    , sqArray(NULL)
+    , cqHead(NULL)
+    , cqTail(NULL)
+    , cqMask(NULL)
+    , cqes(NULL)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ringFd < 0) {
+        throw IoUringException(HERE, "io_uring_setup failed", errno);
+    }
+    sqEntries = params.sq_entries;
+
+    sqRingLength = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqRingLength = params.cq_off.cqes +
+                   params.cq_entries * sizeof(struct io_uring_cqe);
+    sqesLength = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqRing = mapRing(ringFd, sqRingLength, IORING_OFF_SQ_RING);
+    cqRing = mapRing(ringFd, cqRingLength, IORING_OFF_CQ_RING);
+    sqes = mapRing(ringFd, sqesLength, IORING_OFF_SQES);
+    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+        int e = errno;
+        release();
+        throw IoUringException(HERE, "mmap of io_uring rings failed", e);
+    }
+
+    char* sq = static_cast<char*>(sqRing);
+    char* cq = static_cast<char*>(cqRing);
+    sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+}
+
+/**
+ * Unmap the rings and close the io_uring.
+ */
+IoUring::~IoUring()
+{
+    release();
+}
+
+/**
+ * Unmap whichever of the rings have been mapped and close the io_uring, if
+ * it has been opened.
+ */
+void
+IoUring::release()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqesLength);
+    if (cqRing != MAP_FAILED)
+        munmap(cqRing, cqRingLength);
+    if (sqRing != MAP_FAILED)
+        munmap(sqRing, sqRingLength);
+    if (ringFd >= 0)
+        close(ringFd);
+    sqes = cqRing = sqRing = MAP_FAILED;
+    ringFd = -1;
+}
+
+/**
+ * Issue a set of reads and writes and wait for all of them to complete.
+ * Each batch of requests is submitted with a single system call, so the
+ * kernel can keep all of the devices involved busy at once.
+ *
+ * \param requests
+ *      The requests to perform. The result of each is returned in its
+ *      Request::result field.
+ * \param count
+ *      Number of elements in \a requests.
+ */
+void
+IoUring::submitAndWait(Request* requests, size_t count)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    struct iovec iovecs[sqEntries];
+    struct io_uring_sqe* sqeArray = static_cast<struct io_uring_sqe*>(sqes);
+    struct io_uring_cqe* cqeArray = static_cast<struct io_uring_cqe*>(cqes);
+
+    size_t next = 0;
+    while (next < count) {
+        uint32_t batch = downCast<uint32_t>(
+                std::min<size_t>(count - next, sqEntries));
+
+        uint32_t tail = *sqTail;
+        for (uint32_t i = 0; i < batch; i++) {
+            Request& request = requests[next + i];
+            uint32_t index = tail & *sqMask;
+            struct io_uring_sqe* sqe = &sqeArray[index];
+            memset(sqe, 0, sizeof(*sqe));
+            iovecs[i].iov_base = request.buf;
+            iovecs[i].iov_len = request.length;
+            sqe->opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = request.fd;
+            sqe->off = request.offset;
+            sqe->addr = reinterpret_cast<uint64_t>(&iovecs[i]);
+            sqe->len = 1;
+            sqe->user_data = next + i;
+            sqArray[index] = index;
+            tail++;
+        }
+        // The kernel must see the entries before it sees the new tail.
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        uint32_t toSubmit = batch;
+        uint32_t completed = 0;
+        while (completed < batch) {
+            long r = syscall(__NR_io_uring_enter, ringFd, toSubmit,
+                             batch - completed, IORING_ENTER_GETEVENTS,
+                             NULL, 0);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                DIE("io_uring_enter failed: %s", strerror(errno));
+            }
+            toSubmit -= downCast<uint32_t>(r);
+
+            uint32_t head = *cqHead;
+            while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                struct io_uring_cqe* cqe = &cqeArray[head & *cqMask];
+                requests[cqe->user_data].result = cqe->res;
+                head++;
+                completed++;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+        next += batch;
+    }
+}
+
+/**
+ * Map one of the regions shared with the kernel for an io_uring.
+ *
+ * \param fd
+ *      The io_uring's file descriptor.
+ * \param length
+ *      Bytes to map.
+ * \param offset
+ *      Which region to map (one of the IORING_OFF_* values).
+ * \return
+ *      The mapping, or MAP_FAILED.
+ */
+void*
+IoUring::mapRing(int fd, size_t length, off_t offset)
+{
+    return mmap(NULL, length, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd, offset);
+}
+
+} // namespace RAMCloud
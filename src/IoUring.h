@@ -0,0 +1,122 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_IOURING_H
+#define RAMCLOUD_IOURING_H
+
+#include <sys/uio.h>
+#include <mutex>
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * Thrown if an IoUring can't be set up (for example, because the kernel
+ * doesn't support io_uring or it has been disabled).
+ */
+struct IoUringException : public Exception {
+    IoUringException(const CodeLocation& where, std::string msg, int errNo)
+        : Exception(where, msg, errNo) {}
+};
+
+/**
+ * A minimal wrapper around a Linux io_uring instance, used by
+ * MultiFileStorage to issue all of the IOs for a frame with a single system
+ * call and wait for them with another. Unlike POSIX aio, which glibc
+ * implements with a pool of helper threads doing blocking IO, io_uring
+ * hands every request to the kernel at once, which matters for O_DIRECT
+ * IO to fast NVMe devices.
+ *
+ * This talks to the kernel directly with the io_uring_setup and
+ * io_uring_enter system calls rather than depending on liburing.
+ *
+ * This class is thread-safe, but concurrent callers of submitAndWait()
+ * are serialized.
+ */
+class IoUring {
+  public:
+    /**
+     * Describes one read or write for submitAndWait().
+     */
+    struct Request {
+        Request()
+            : fd(-1), buf(NULL), length(0), offset(0), write(false), result(0)
+        {}
+
+        /// File to read from or write to.
+        int fd;
+
+        /// Memory to read into or write from.
+        void* buf;
+
+        /// Number of bytes to transfer.
+        size_t length;
+
+        /// Offset in #fd where the transfer starts.
+        off_t offset;
+
+        /// True for a write, false for a read.
+        bool write;
+
+        /// Set by submitAndWait(): the number of bytes transferred, or
+        /// -errno if the request failed.
+        ssize_t result;
+    };
+
+    explicit IoUring(uint32_t entries);
+    ~IoUring();
+    void submitAndWait(Request* requests, size_t count);
+
+  PRIVATE:
+    static void* mapRing(int fd, size_t length, off_t offset);
+    void release();
+
+    /// Serializes submitAndWait() callers; the rings are single-producer.
+    std::mutex mutex;
+
+    /// File descriptor returned by io_uring_setup.
+    int ringFd;
+
+    /// Number of entries in the submission queue.
+    uint32_t sqEntries;
+
+    /// Mapping of the submission queue ring, and its length.
+    void* sqRing;
+    size_t sqRingLength;
+
+    /// Mapping of the completion queue ring, and its length.
+    void* cqRing;
+    size_t cqRingLength;
+
+    /// Mapping of the submission queue entries, and its length.
+    void* sqes;
+    size_t sqesLength;
+
+    /// Pointers into #sqRing and #cqRing (see io_uring_setup(2)).
+    uint32_t* sqTail;
+    uint32_t* sqMask;
+    uint32_t* sqArray;
+    uint32_t* cqHead;
+    uint32_t* cqTail;
+    uint32_t* cqMask;
+    void* cqes;
+
+    DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_IOURING_H
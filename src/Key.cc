@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <atomic>
+
 #include "Common.h"
 #include "Key.h"
 #include "MurmurHash3.h"
@@ -21,18 +23,137 @@
 
 namespace RAMCloud {
 
+namespace {
+
+/**
+ * One bit for each table id up to Key::MAX_WYHASH_TABLE_ID; set if that
+ * table hashes its keys with Key::WYHASH. Table ids are never reused, so a
+ * bit only has to be set once in each process before the table's keys are
+ * first hashed there; it is read without locking on every hash.
+ */
+std::atomic<uint64_t> wyhashTables[(Key::MAX_WYHASH_TABLE_ID + 1) / 64];
+
+/// Multiply two 64-bit values and fold the 128-bit product into 64 bits.
+inline uint64_t
+wymix(uint64_t a, uint64_t b)
+{
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^
+           static_cast<uint64_t>(product >> 64);
+}
+
+/// Unaligned little-endian loads of 8, 4, and 1 to 3 bytes.
+inline uint64_t
+wyr8(const uint8_t* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t
+wyr4(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t
+wyr3(const uint8_t* p, uint32_t length)
+{
+    return (uint64_t(p[0]) << 16) | (uint64_t(p[length >> 1]) << 8) |
+           p[length - 1];
+}
+
+/**
+ * Hash a key for a table using Key::WYHASH. This follows the structure of
+ * Wang Yi's public domain wyhash: keys of up to 16 bytes (the common case)
+ * are read with two pairs of overlapping loads and mixed with two 64x64-bit
+ * multiplies; no loop and no per-byte work.
+ */
+inline KeyHash
+wyhash(uint64_t seed, const void* key, uint32_t length)
+{
+    static const uint64_t p0 = 0xa0761d6478bd642full;
+    static const uint64_t p1 = 0xe7037ed1a0b428dbull;
+    static const uint64_t p2 = 0x8ebc6af09c88c6e3ull;
+    static const uint64_t p3 = 0x589965cc75374cc3ull;
+
+    const uint8_t* p = static_cast<const uint8_t*>(key);
+    seed ^= wymix(seed ^ p0, p1);
+    uint64_t a, b;
+    if (expect_true(length <= 16)) {
+        if (length >= 4) {
+            uint32_t middle = (length >> 3) << 2;
+            a = (wyr4(p) << 32) | wyr4(p + middle);
+            b = (wyr4(p + length - 4) << 32) | wyr4(p + length - 4 - middle);
+        } else if (length > 0) {
+            a = wyr3(p, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        uint32_t i = length;
+        if (i > 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ p1, wyr8(p + 8) ^ seed);
+                seed1 = wymix(wyr8(p + 16) ^ p2, wyr8(p + 24) ^ seed1);
+                seed2 = wymix(wyr8(p + 32) ^ p3, wyr8(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ p1, wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    __uint128_t product = static_cast<__uint128_t>(a ^ p1) * (b ^ seed);
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+    return wymix(a ^ p0 ^ length, b ^ p1);
+}
+
+/**
+ * Compare two binary string keys of a length known at compile time. Keys of
+ * 8 and 16 bytes are by far the most common (integer and UUID keys); for
+ * those this compiles down to one or two pairs of unaligned 8-byte loads and
+ * no branches, where bcmp has to dispatch on the length and alignment first.
+ */
+template<KeyLength length>
+inline bool
+fixedLengthEqual(const void* a, const void* b)
+{
+    static_assert(length % 8 == 0, "length must be a multiple of 8 bytes");
+    const uint8_t* p = static_cast<const uint8_t*>(a);
+    const uint8_t* q = static_cast<const uint8_t*>(b);
+    uint64_t difference = 0;
+    for (KeyLength i = 0; i < length; i += 8)
+        difference |= wyr8(p + i) ^ wyr8(q + i);
+    return difference == 0;
+}
+
+} // anonymous namespace
+
 /**
  * Construct a new key object by extracting the appropriate fields from a
  * log entry. Use this method when obtaining the key from a serialized
- * object or tombstone in the log.
+ * object, tombstone, or object delta in the log.
  *
  * \param type
  *      The log entry type of this entry, as indicated by the log or segment
  *      code.
  * \param buffer
- *      Buffer pointing to the entire object or tombstone entry in a log or
- *      segment. The buffer must exist as long as this key object exists,
- *      since the key will simply point into the data in the buffer.
+ *      Buffer pointing to the entire object, tombstone, or delta entry in a
+ *      log or segment. The buffer must exist as long as this key object
+ *      exists, since the key will simply point into the data in the buffer.
  * \throw FatalError 
  *      A FatalError exception is thrown if this class does not recognize the
  *      type argument provided.
@@ -55,6 +176,12 @@ Key::Key(LogEntryType type, Buffer& buffer)
         keyLength = tomb.getKeyLength();
         key = tomb.getKey();
 
+    } else if (type == LOG_ENTRY_TYPE_OBJDELTA) {
+        ObjectDelta delta(buffer);
+        tableId = delta.getTableId();
+        keyLength = delta.getKeyLength();
+        key = delta.getKey();
+
     } else {
         throw FatalError(HERE, "unknown Log::Entry type %d", type);
     }
@@ -140,6 +267,9 @@ Key::getHash()
 KeyHash
 Key::getHash(uint64_t tableId, const void* key, KeyLength keyLength)
 {
+    if (getHashFunction(tableId) == WYHASH)
+        return wyhash(tableId, key, keyLength);
+
     // It would be nice if MurmurHash3 took a 64-bit seed so we could cheaply
     // include the full tableId. For now just cast down to 32-bits and hope for
     // the best. We used to invoke the hash function multiple times, but that
@@ -150,6 +280,84 @@ Key::getHash(uint64_t tableId, const void* key, KeyLength keyLength)
     return out[0];
 }
 
+/**
+ * Compute and cache the hashes of a batch of keys, such as the keys of a
+ * multi-read, so that later calls to getHash() on them are free. Runs of
+ * keys from the same table are hashed in a tight loop without looking up
+ * the table's hash function again; for WYHASH tables the hash is inlined,
+ * so the multiplies for consecutive keys overlap in the pipeline.
+ *
+ * \param count
+ *      Number of entries in \a keys.
+ * \param keys
+ *      Keys to hash; keys whose hash is already cached are left alone.
+ */
+void
+Key::computeHashes(uint32_t count, Key* const keys[])
+{
+    uint32_t i = 0;
+    while (i < count) {
+        uint64_t tableId = keys[i]->tableId;
+        HashFunction function = getHashFunction(tableId);
+        for (; i < count && keys[i]->tableId == tableId; i++) {
+            Key* key = keys[i];
+            if (key->hash)
+                continue;
+            if (function == WYHASH) {
+                key->hash.construct(wyhash(tableId, key->key,
+                                           key->keyLength));
+            } else {
+                key->hash.construct(getHash(tableId, key->key,
+                                            key->keyLength));
+            }
+        }
+    }
+}
+
+/**
+ * Return the function used to hash the keys of a table.
+ *
+ * \param tableId
+ *      Table whose keys are to be hashed.
+ */
+Key::HashFunction
+Key::getHashFunction(uint64_t tableId)
+{
+    if (tableId > MAX_WYHASH_TABLE_ID)
+        return MURMUR3;
+    uint64_t word = wyhashTables[tableId / 64].load(std::memory_order_relaxed);
+    return (word & (1UL << (tableId % 64))) ? WYHASH : MURMUR3;
+}
+
+/**
+ * Record the function used to hash the keys of a table. Every process that
+ * hashes keys of the table (its clients, the masters that own or recover
+ * its tablets, and backups building recovery segments for it) must call
+ * this before doing so; the table's hash function is passed along with
+ * its table configuration, tablet assignments and recovery partitions for
+ * that reason. Without a call, a table uses MURMUR3.
+ *
+ * \param tableId
+ *      Table whose hash function is being set.
+ * \param function
+ *      Hash function for the keys of \a tableId.
+ * \return
+ *      False if \a function is WYHASH but \a tableId is larger than
+ *      MAX_WYHASH_TABLE_ID, in which case the table must use MURMUR3.
+ */
+bool
+Key::setHashFunction(uint64_t tableId, HashFunction function)
+{
+    if (tableId > MAX_WYHASH_TABLE_ID)
+        return function == MURMUR3;
+    uint64_t bit = 1UL << (tableId % 64);
+    if (function == WYHASH)
+        wyhashTables[tableId / 64].fetch_or(bit);
+    else
+        wyhashTables[tableId / 64].fetch_and(~bit);
+    return true;
+}
+
 /**
  * Return a pointer to the binary string key. It is guaranteed to be contiguous
  * in memory.
@@ -196,6 +404,13 @@ Key::operator==(const Key& other) const
     if (keyLength != other.keyLength)
         return false;
 
+    // Lengths were just checked to match, so common fixed-size keys can use
+    // a comparison specialized for their length.
+    if (keyLength == 8)
+        return fixedLengthEqual<8>(key, other.key);
+    if (keyLength == 16)
+        return fixedLengthEqual<16>(key, other.key);
+
     // bcmp is used here because it's about 20-25ns faster than memcmp with
     // 8-byte strings. The problem with memcmp appears to be that GCC emits
     // an "optimization" (repz cmpsb) that is much slower than glibc's memcmp.
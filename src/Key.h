@@ -52,6 +52,24 @@ typedef uint16_t KeyLength;
  */
 class Key {
   public:
+    /**
+     * Functions a table may use to hash its keys; chosen when the table is
+     * created and fixed for its lifetime. Values are sent over the wire
+     * and stored with table metadata, so they must not change.
+     */
+    enum HashFunction {
+        /// MurmurHash3_x64_128 seeded with the low 32 bits of the table id.
+        /// Used by every table unless it asks for something else.
+        MURMUR3 = 0,
+
+        /// A wyhash-style function seeded with the full table id; several
+        /// times faster than MURMUR3 for short keys.
+        WYHASH = 1,
+    };
+
+    /// Tables with larger ids always use MURMUR3 (see setHashFunction()).
+    static const uint64_t MAX_WYHASH_TABLE_ID = (1UL << 16) - 1;
+
     Key(LogEntryType type, Buffer& buffer);
     Key(uint64_t tableId, Buffer& buffer,
         uint32_t keyOffset, KeyLength keyLength);
@@ -61,6 +79,9 @@ class Key {
     static KeyHash getHash(uint64_t tableId,
                            const void* key,
                            KeyLength keyLength);
+    static void computeHashes(uint32_t count, Key* const keys[]);
+    static HashFunction getHashFunction(uint64_t tableId);
+    static bool setHashFunction(uint64_t tableId, HashFunction function);
     const void* getStringKey() const;
     KeyLength getStringKeyLength() const;
     uint64_t getTableId() const;
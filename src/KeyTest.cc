@@ -124,6 +124,46 @@ TEST_F(KeyTest, getHash_UsesAllBits) {
     EXPECT_EQ(~0UL, observedBits);
 }
 
+TEST_F(KeyTest, getHash_wyhash) {
+    KeyHash murmur = Key::getHash(1000, "hey-hey-hey", 11);
+    EXPECT_TRUE(Key::setHashFunction(1000, Key::WYHASH));
+    EXPECT_EQ(Key::WYHASH, Key::getHashFunction(1000));
+    KeyHash wyhash = Key::getHash(1000, "hey-hey-hey", 11);
+    EXPECT_NE(murmur, wyhash);
+    EXPECT_EQ(wyhash, Key(1000, "hey-hey-hey", 11).getHash());
+    EXPECT_NE(wyhash, Key::getHash(1000, "hey-hey-hez", 11));
+
+    // Other tables are unaffected.
+    EXPECT_EQ(Key::MURMUR3, Key::getHashFunction(1001));
+
+    EXPECT_TRUE(Key::setHashFunction(1000, Key::MURMUR3));
+    EXPECT_EQ(murmur, Key::getHash(1000, "hey-hey-hey", 11));
+}
+
+TEST_F(KeyTest, computeHashes) {
+    Key::setHashFunction(1000, Key::WYHASH);
+    Key key1(1000, "a", 1);
+    Key key2(1000, "bb", 2);
+    Key key3(82, "hey-hey-hey", 11);
+    Key key4(1000, "ccc", 3);
+    key4.hash.construct(1234UL);
+    Key* keys[] = { &key1, &key2, &key3, &key4 };
+    Key::computeHashes(4, keys);
+
+    EXPECT_EQ(Key::getHash(1000, "a", 1), *key1.hash);
+    EXPECT_EQ(Key::getHash(1000, "bb", 2), *key2.hash);
+    EXPECT_EQ(0x889d47d556739eebUL, *key3.hash);
+    EXPECT_EQ(1234UL, *key4.hash);
+    Key::setHashFunction(1000, Key::MURMUR3);
+}
+
+TEST_F(KeyTest, setHashFunction_tableIdTooLarge) {
+    uint64_t tableId = Key::MAX_WYHASH_TABLE_ID + 1;
+    EXPECT_FALSE(Key::setHashFunction(tableId, Key::WYHASH));
+    EXPECT_EQ(Key::MURMUR3, Key::getHashFunction(tableId));
+    EXPECT_TRUE(Key::setHashFunction(tableId, Key::MURMUR3));
+}
+
 TEST_F(KeyTest, getStringKey) {
     const char *keyString = reinterpret_cast<const char*>(
                             Key(8274, "hi", 3).getStringKey());
@@ -153,6 +193,24 @@ TEST_F(KeyTest, operatorEquals_and_operatorNotEquals) {
     EXPECT_NE(key3, key4);
 }
 
+TEST_F(KeyTest, operatorEquals_fixedLengthKeys) {
+    // 8- and 16-byte keys take specialized paths; a difference in any word
+    // must be noticed, and the keys need not be aligned.
+    char buffer[40];
+    memcpy(buffer, "0123456789abcdef", 16);
+    memcpy(buffer + 21, "0123456789abcdef", 16);
+    EXPECT_EQ(Key(1, buffer, 8), Key(1, buffer + 21, 8));
+    EXPECT_EQ(Key(1, buffer, 16), Key(1, buffer + 21, 16));
+
+    buffer[21 + 7] = 'X';
+    EXPECT_NE(Key(1, buffer, 8), Key(1, buffer + 21, 8));
+    EXPECT_NE(Key(1, buffer, 16), Key(1, buffer + 21, 16));
+    buffer[21 + 7] = '7';
+    buffer[21 + 15] = 'X';
+    EXPECT_EQ(Key(1, buffer, 8), Key(1, buffer + 21, 8));
+    EXPECT_NE(Key(1, buffer, 16), Key(1, buffer + 21, 16));
+}
+
 TEST_F(KeyTest, toString) {
     EXPECT_EQ("<tableId: 27, key: \"ascii key\", "
               "keyLength: 9, hash: 0xe415add6e960d438>",
@@ -13,6 +13,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <pthread.h>
+#include <thread>
+
+#include "Cycles.h"
 #include "LargeBlockOfMemory.h"
 
 namespace RAMCloud {
@@ -40,6 +44,124 @@ namespace LargeBlockOfMemoryInternal {
 #else
     uint64_t nextProbeBase = (uint64_t)1 << 30;
 #endif
+
+PageSize requestedPageSize = NORMAL_PAGES;
+
+/**
+ * Return a human-readable name for a kind of page, for log messages.
+ */
+const char*
+pageSizeName(PageSize pageSize)
+{
+    switch (pageSize) {
+    case NORMAL_PAGES:
+        return "normal pages";
+    case TRANSPARENT_HUGE_PAGES:
+        return "transparent huge pages";
+    case HUGE_PAGES_2MB:
+        return "2 MB huge pages";
+    case HUGE_PAGES_1GB:
+        return "1 GB huge pages";
+    }
+    return "unknown pages";
+}
+
+/**
+ * Parse the name of a kind of page, as given on the command line.
+ *
+ * \param name
+ *      One of "none", "transparent", "2mb" or "1gb".
+ * \param[out] pageSize
+ *      The kind of page named is returned here.
+ * \return
+ *      True if the name was recognized, false otherwise.
+ */
+bool
+parsePageSize(const string& name, PageSize* pageSize)
+{
+    if (name == "none") {
+        *pageSize = NORMAL_PAGES;
+    } else if (name == "transparent") {
+        *pageSize = TRANSPARENT_HUGE_PAGES;
+    } else if (name == "2mb") {
+        *pageSize = HUGE_PAGES_2MB;
+    } else if (name == "1gb") {
+        *pageSize = HUGE_PAGES_1GB;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Fault in (and optionally pin) all of the pages of a newly mapped block,
+ * which zeros them. Master startup used to spend a long time doing this
+ * for the log and hash table one page at a time, so large blocks are
+ * split among threads, one per core, each pinned to its core; with the
+ * kernel's first-touch policy this also spreads the block's pages evenly
+ * over the machine's NUMA nodes.
+ *
+ * \param block
+ *      First byte of the block; must be page-aligned.
+ * \param length
+ *      Number of bytes in the block.
+ * \param lock
+ *      True means also mlock the pages.
+ * \return
+ *      False means mlock failed (for some part of the block).
+ */
+bool
+populate(void* block, size_t length, bool lock)
+{
+    // Don't bother with threads for blocks smaller than this per thread.
+    const size_t minBytesPerThread = 256 * 1024 * 1024;
+    // Give each thread a multiple of this, so no huge page is shared.
+    const size_t chunkAlignment = 1 << 30;
+
+    uint64_t start = Cycles::rdtsc();
+    size_t pageBytes = sysconf(_SC_PAGESIZE);
+    uint32_t numCores = std::max(1u, std::thread::hardware_concurrency());
+    size_t numThreads = std::min<size_t>(numCores,
+            std::max<size_t>(1, length / minBytesPerThread));
+    size_t chunkBytes = (length + numThreads - 1) / numThreads;
+    chunkBytes = (chunkBytes + chunkAlignment - 1) & ~(chunkAlignment - 1);
+    std::atomic<bool> failed(false);
+
+    auto populateChunk = [&](size_t core, size_t offset) {
+        if (numThreads > 1) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core % numCores, &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        }
+        uint8_t* chunk = static_cast<uint8_t*>(block) + offset;
+        size_t bytes = std::min(chunkBytes, length - offset);
+        if (lock && mlock(chunk, bytes) != 0)
+            failed = true;
+        for (size_t i = 0; i < bytes; i += pageBytes)
+            chunk[i] = 0;
+    };
+
+    // If there's only one chunk, do it in this thread (which mustn't be
+    // pinned).
+    std::vector<std::thread> threads;
+    if (numThreads == 1) {
+        populateChunk(0, 0);
+    } else {
+        for (size_t offset = 0; offset < length; offset += chunkBytes)
+            threads.emplace_back(populateChunk, threads.size(), offset);
+    }
+    foreach (std::thread& thread, threads)
+        thread.join();
+
+    if (length >= minBytesPerThread) {
+        RAMCLOUD_LOG(NOTICE, "Populated %lu MB of pages in %.1f ms using "
+                "%lu threads", length / (1 << 20),
+                Cycles::toSeconds(Cycles::rdtsc() - start) * 1e3,
+                std::max<size_t>(1, threads.size()));
+    }
+    return !failed;
+}
 }
 
 }
@@ -34,6 +34,32 @@ namespace RAMCloud {
  */
 namespace LargeBlockOfMemoryInternal {
     extern uint64_t nextProbeBase;
+
+    /**
+     * Kinds of pages that anonymous LargeBlockOfMemory allocations can be
+     * backed with. With large logs and hash tables, small pages cause a TLB
+     * miss on nearly every random access.
+     */
+    enum PageSize {
+        /// The system's normal (typically 4 KB) pages.
+        NORMAL_PAGES,
+        /// Normal pages, with the kernel asked (via madvise) to promote them
+        /// to transparent huge pages.
+        TRANSPARENT_HUGE_PAGES,
+        /// 2 MB hugetlb pages; these must be reserved by the administrator.
+        HUGE_PAGES_2MB,
+        /// 1 GB hugetlb pages; these must be reserved by the administrator.
+        HUGE_PAGES_1GB,
+    };
+
+    /// The kind of pages anonymous blocks try to get; set once at server
+    /// startup. If they can't be had, the next smaller kind is tried, down
+    /// to NORMAL_PAGES.
+    extern PageSize requestedPageSize;
+
+    const char* pageSizeName(PageSize pageSize);
+    bool parsePageSize(const string& name, PageSize* pageSize);
+    bool populate(void* block, size_t length, bool lock);
 }
 
 /**
@@ -46,7 +72,9 @@ template<typename T = void>
 struct LargeBlockOfMemory {
     /**
      * Allocates anonymous backing pages for a block of memory, pins them,
-     * and zeros them. The memory is aligned to a gigabyte boundary.
+     * and zeros them. The memory is aligned to a gigabyte boundary. The
+     * pages are of the kind in LargeBlockOfMemoryInternal::requestedPageSize,
+     * or the largest smaller kind that could be obtained (see #pageSize).
      * \param length
      *      The number of bytes of memory to allocate.
      * \throw FatalError
@@ -54,7 +82,9 @@ struct LargeBlockOfMemory {
      */
     explicit LargeBlockOfMemory(size_t length)
         : length(length)
-        , block(static_cast<T*>(mmapGigabyteAligned(length, MAP_ANONYMOUS)))
+        , mappedLength(length)
+        , pageSize(LargeBlockOfMemoryInternal::NORMAL_PAGES)
+        , block(static_cast<T*>(mmapAnonymous()))
     {
         if (block == MAP_FAILED) {
             if (length == 0)
@@ -63,6 +93,16 @@ struct LargeBlockOfMemory {
                              format("Could not allocate %lu bytes", length),
                              errno);
         }
+
+        if (LargeBlockOfMemoryInternal::requestedPageSize !=
+                LargeBlockOfMemoryInternal::NORMAL_PAGES) {
+            RAMCLOUD_LOG(NOTICE, "Allocated %lu MB block at %p using %s "
+                         "(requested %s)", length / (1 << 20),
+                         reinterpret_cast<void*>(block),
+                         LargeBlockOfMemoryInternal::pageSizeName(pageSize),
+                         LargeBlockOfMemoryInternal::pageSizeName(
+                            LargeBlockOfMemoryInternal::requestedPageSize));
+        }
     }
 
     /**
@@ -81,6 +121,8 @@ struct LargeBlockOfMemory {
      */
     LargeBlockOfMemory(string filePath, size_t length)
         : length(length),
+          mappedLength(length),
+          pageSize(LargeBlockOfMemoryInternal::NORMAL_PAGES),
           block(NULL)
     {
         const char* path = filePath.c_str();
@@ -124,20 +166,20 @@ struct LargeBlockOfMemory {
                      length, path, reinterpret_cast<void*>(block));
 
         // Fault in each mapping.
-        uint64_t pageSize = sysconf(_SC_PAGESIZE);
-        for (uint64_t i = 0; i < length; i += pageSize)
-            reinterpret_cast<uint8_t*>(block)[i] = 0;
+        LargeBlockOfMemoryInternal::populate(block, length, false);
     }
 
     ~LargeBlockOfMemory()
     {
-        if (block != NULL && munmap(block, length) != 0)
+        if (block != NULL && munmap(block, mappedLength) != 0)
             RAMCLOUD_LOG(WARNING, "munmap of large block failed with %d",
                          errno);
     }
 
     void swap(LargeBlockOfMemory<T>& other) {
         std::swap(this->length, other.length);
+        std::swap(this->mappedLength, other.mappedLength);
+        std::swap(this->pageSize, other.pageSize);
         std::swap(this->block, other.block);
     }
 
@@ -151,6 +193,13 @@ struct LargeBlockOfMemory {
     /// The number of bytes valid starting at #block.
     size_t length;
 
+    /// The number of bytes actually mapped at #block: #length rounded up to
+    /// a multiple of the huge page size if hugetlb pages are used.
+    size_t mappedLength;
+
+    /// The kind of pages backing #block.
+    LargeBlockOfMemoryInternal::PageSize pageSize;
+
     /// Just for convenience.
     static const uint64_t GIGABYTE = (uint64_t)1 << 30;
 
@@ -161,6 +210,78 @@ struct LargeBlockOfMemory {
     T* block;
 
   private:
+    /**
+     * Map #length bytes of anonymous memory with gigabyte alignment, backed
+     * by the requested kind of pages if possible (see
+     * LargeBlockOfMemoryInternal::requestedPageSize), falling back to each
+     * smaller kind in turn. Sets #mappedLength and #pageSize to match.
+     *
+     * \return
+     *      The mapped memory, or MAP_FAILED.
+     */
+    void*
+    mmapAnonymous()
+    {
+        using namespace LargeBlockOfMemoryInternal;
+        PageSize want = (length == 0) ? NORMAL_PAGES : requestedPageSize;
+
+        if (want == HUGE_PAGES_1GB) {
+            void* p = mmapHugetlb(GIGABYTE, 30);
+            if (p != MAP_FAILED) {
+                pageSize = HUGE_PAGES_1GB;
+                return p;
+            }
+            want = HUGE_PAGES_2MB;
+        }
+        if (want == HUGE_PAGES_2MB) {
+            void* p = mmapHugetlb(2 * 1024 * 1024, 21);
+            if (p != MAP_FAILED) {
+                pageSize = HUGE_PAGES_2MB;
+                return p;
+            }
+            want = TRANSPARENT_HUGE_PAGES;
+        }
+
+        mappedLength = length;
+        if (want == TRANSPARENT_HUGE_PAGES) {
+            void* p = mmapGigabyteAligned(length, MAP_ANONYMOUS, -1,
+                                          MAP_PRIVATE, true);
+            if (p != MAP_FAILED) {
+                pageSize = TRANSPARENT_HUGE_PAGES;
+                return p;
+            }
+        }
+        pageSize = NORMAL_PAGES;
+        return mmapGigabyteAligned(length, MAP_ANONYMOUS);
+    }
+
+    /**
+     * Try to map #length bytes of hugetlb pages of the given size.
+     *
+     * \param hugePageBytes
+     *      Size of each huge page in bytes.
+     * \param hugePageShift
+     *      Log2(hugePageBytes), used to request the page size from mmap.
+     * \return
+     *      The mapped memory, or MAP_FAILED if pages of this size aren't
+     *      available. On success, #mappedLength is set to the rounded-up
+     *      size actually mapped.
+     */
+    void*
+    mmapHugetlb(size_t hugePageBytes, int hugePageShift)
+    {
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+        mappedLength = (length + hugePageBytes - 1) & ~(hugePageBytes - 1);
+        void* p = mmapGigabyteAligned(mappedLength,
+                MAP_ANONYMOUS | MAP_HUGETLB | (hugePageShift << MAP_HUGE_SHIFT),
+                -1);
+        if (p == MAP_FAILED)
+            mappedLength = length;
+        return p;
+    }
+
     /**
      * Mmap the desired amount of space with gigabyte alignment (lower 30
      * bits of the address are 0). Also, ensure that all mappings are faulted
@@ -178,9 +299,15 @@ struct LargeBlockOfMemory {
      *      Extra flags to be passed to mmap(2).
      * \param[in] fd
      *      Optional file descriptor (if mmaping a file, for instance).
+     * \param[in] mapType
+     *      MAP_SHARED or MAP_PRIVATE. Transparent huge pages need the latter.
+     * \param[in] adviseHugePages
+     *      If true, ask the kernel to back the mapping with transparent huge
+     *      pages before it is faulted in. Fails if the kernel refuses.
      */
     void*
-    mmapGigabyteAligned(size_t length, int extraFlags, int fd = -1)
+    mmapGigabyteAligned(size_t length, int extraFlags, int fd = -1,
+                        int mapType = MAP_SHARED, bool adviseHugePages = false)
     {
         const int maxTries = 10000;
         int i;
@@ -190,7 +317,7 @@ struct LargeBlockOfMemory {
             void *base = mmap(reinterpret_cast<void*>(tryBase),
                               length,
                               PROT_READ | PROT_WRITE,
-                              MAP_SHARED | extraFlags,
+                              mapType | extraFlags,
                               fd,
                               0);
 
@@ -208,39 +335,38 @@ struct LargeBlockOfMemory {
         }
 
         if (i == maxTries) {
-            RAMCLOUD_LOG(ERROR, "Couldn't mmap gigabyte-aligned region");
+            if (!(extraFlags & MAP_HUGETLB))
+                RAMCLOUD_LOG(ERROR, "Couldn't mmap gigabyte-aligned region");
             return MAP_FAILED;
         }
 
         void* block = reinterpret_cast<void*>(tryBase);
 
+        if (adviseHugePages && madvise(block, length, MADV_HUGEPAGE) != 0) {
+            munmap(block, length);
+            return MAP_FAILED;
+        }
+
         // Do not pin and fault in pages if we're testing, since that just
         // slows things down considerably (we usually don't touch anywhere near
         // all of the memory we allocate).
 #if !TESTING
-#ifdef MLOCK_PAGES
-        // Pin the pages. Don't do this with the mmap() MAP_LOCKED flag since
+        // Pin the pages (if configured) and force the OS to populate
+        // backing pages. Don't pin with the mmap() MAP_LOCKED flag since
         // that slows down probing considerably (Linux might be locking down
         // pages before it knows that it can actually give us the entire
-        // range?).
-        if (mlock(block, length)) {
+        // range?). MAP_POPULATE doesn't seem to do the trick and using it
+        // makes polling mmap for aligned base addresses much slower.
+#ifdef MLOCK_PAGES
+        bool lock = true;
+#else
+        bool lock = false;
+#endif
+        if (!LargeBlockOfMemoryInternal::populate(block, length, lock)) {
             munmap(block, length);
             RAMCLOUD_LOG(ERROR, "Couldn't pin down the memory!");
             return MAP_FAILED;
         }
-#endif
-
-        // Force the OS to populate backing pages.  MAP_POPULATE doesn't seem
-        // to do the trick and using it makes polling mmap for aligned base
-        // addresses much slower.
-        uint64_t pageSize = sysconf(_SC_PAGESIZE);
-        for (uint64_t i = 0; i < length; i += pageSize) {
-            reinterpret_cast<uint8_t*>(block)[i] = 0;
-            if (!(i & ((1 << 30) - 1))) {
-                RAMCLOUD_LOG(NOTICE, "Populating pages; progress %lu of %lu MB",
-                             i / (1 << 20), length / (1 << 20));
-            }
-        }
 #endif // !TESTING
 
         // Cache last mapped address to avoid re-probing same addresses later.
@@ -0,0 +1,453 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "ClientException.h"
+#include "Dispatch.h"
+#include "LargeObject.h"
+#include "RamCloud.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+namespace {
+
+/**
+ * Issue one RPC for each of a series of chunks, keeping up to
+ * LargeObject::MAX_OUTSTANDING of them outstanding at once, and wait for
+ * all of them to complete.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param count
+ *      Number of chunks; they are started in order of their index.
+ * \param start
+ *      Invoked as start(rpc, slot, index) to construct the RPC for chunk
+ *      index in rpc, a Tub. Slot identifies rpc among those outstanding,
+ *      for callers that need per-RPC storage.
+ * \param finish
+ *      Invoked as finish(rpc, slot, index) once an RPC is ready; it must
+ *      call the RPC's wait method. Returning false means no more RPCs are
+ *      started, though the ones outstanding are still finished.
+ */
+template<typename Rpc, typename Start, typename Finish>
+void
+pipeline(RamCloud* ramcloud, uint32_t count, Start start, Finish finish)
+{
+    Tub<Rpc> rpcs[LargeObject::MAX_OUTSTANDING];
+    uint32_t indexes[LargeObject::MAX_OUTSTANDING];
+    uint32_t next = 0;
+    int outstanding = 0;
+    bool stopped = false;
+    Dispatch* dispatch = ramcloud->clientContext->dispatch;
+    bool isDispatchThread = dispatch->isDispatchThread();
+    while ((outstanding > 0) || (!stopped && (next < count))) {
+        for (int i = 0; i < LargeObject::MAX_OUTSTANDING; i++) {
+            if (rpcs[i]) {
+                if (!rpcs[i]->isReady())
+                    continue;
+                if (!finish(rpcs[i].get(), i, indexes[i]))
+                    stopped = true;
+                rpcs[i].destroy();
+                outstanding--;
+            }
+            if (stopped || (next >= count))
+                continue;
+            indexes[i] = next;
+            start(&rpcs[i], i, next);
+            next++;
+            outstanding++;
+        }
+        if (isDispatchThread)
+            dispatch->poll();
+    }
+}
+
+} // anonymous namespace
+
+/**
+ * Read the value of a large object (see RamCloud::readLarge).
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer holds the value of the
+ *      object, in contiguous memory.
+ * \param[out] version
+ *      If non-NULL, the version of the object's manifest is returned here;
+ *      it changes with every write of the object.
+ *
+ * \throw ObjectDoesntExistException
+ *      The object doesn't exist, or some of its chunks are missing.
+ */
+void
+LargeObject::read(RamCloud* ramcloud, uint64_t tableId, const void* key,
+        uint16_t keyLength, Buffer* value, uint64_t* version)
+{
+    uint64_t previousVersion = 0;
+    while (true) {
+        value->reset();
+        uint64_t manifestVersion;
+        ramcloud->read(tableId, key, keyLength, value, NULL,
+                &manifestVersion);
+        if (version != NULL)
+            *version = manifestVersion;
+        Manifest manifest;
+        if (!parseManifest(value, value->size(), &manifest))
+            return;
+        if (manifest.numChunks == 0) {
+            value->truncateFront(sizeof32(Manifest));
+            return;
+        }
+        value->reset();
+        if (readChunks(ramcloud, tableId, key, keyLength, &manifest, value))
+            return;
+
+        // A chunk was missing. Usually this means the object was written
+        // again while we were reading it, and the new write removed the
+        // old chunks; the new manifest describes the current value. If the
+        // manifest hasn't changed, though, the value has been damaged.
+        if (manifestVersion == previousVersion) {
+            value->reset();
+            throw ObjectDoesntExistException(HERE);
+        }
+        previousVersion = manifestVersion;
+    }
+}
+
+/**
+ * Delete a large object (see RamCloud::removeLarge). Nothing happens if
+ * the object doesn't exist.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ */
+void
+LargeObject::remove(RamCloud* ramcloud, uint64_t tableId, const void* key,
+        uint16_t keyLength)
+{
+    while (true) {
+        Buffer header;
+        uint64_t oldVersion;
+        uint32_t oldLength;
+        RejectRules rejectRules = {};
+        try {
+            ramcloud->readRange(tableId, key, keyLength, 0,
+                    sizeof32(Manifest), &header, NULL, &oldVersion,
+                    &oldLength);
+            rejectRules.givenVersion = oldVersion;
+            rejectRules.versionNeGiven = 1;
+            ramcloud->remove(tableId, key, keyLength, &rejectRules);
+        } catch (ObjectDoesntExistException& e) {
+            return;
+        } catch (RejectRulesException& e) {
+            // The object was written again after we read its manifest;
+            // its old chunks have been removed by that write, but the new
+            // ones are ours to remove.
+            continue;
+        }
+        Manifest manifest;
+        if (parseManifest(&header, oldLength, &manifest) &&
+                (manifest.numChunks > 0)) {
+            removeChunks(ramcloud, tableId, key, keyLength, &manifest);
+        }
+        return;
+    }
+}
+
+/**
+ * Replace the value of a large object, or create it if it doesn't exist
+ * (see RamCloud::writeLarge).
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Variable length key that uniquely identifies the object within
+ *      tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Address of the first byte of the new value.
+ * \param length
+ *      Size in bytes of the new value.
+ * \param[out] version
+ *      If non-NULL, the version of the object's new manifest is returned
+ *      here.
+ *
+ * \throw InvalidParameterException
+ *      The key is too long to derive chunk keys from it.
+ */
+void
+LargeObject::write(RamCloud* ramcloud, uint64_t tableId, const void* key,
+        uint16_t keyLength, const void* buf, uint32_t length,
+        uint64_t* version)
+{
+    Manifest manifest;
+    manifest.magic = MAGIC;
+    manifest.chunkSize = CHUNK_SIZE;
+    manifest.generation = generateRandom();
+    manifest.length = length;
+    manifest.numChunks = 0;
+    if (length > CHUNK_SIZE) {
+        // Chunk keys are 15 bytes longer than the object's key.
+        if (keyLength > UINT16_MAX - 15)
+            throw InvalidParameterException(HERE);
+        manifest.numChunks = (length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        try {
+            writeChunks(ramcloud, tableId, key, keyLength, &manifest, buf);
+        } catch (ClientException& e) {
+            removeChunks(ramcloud, tableId, key, keyLength, &manifest);
+            throw;
+        }
+    }
+    Buffer newValue;
+    newValue.appendCopy(&manifest);
+    if (manifest.numChunks == 0)
+        newValue.appendExternal(buf, length);
+    uint32_t newLength = newValue.size();
+    const void* newData = newValue.getRange(0, newLength);
+
+    // Replace the manifest, but only if it is still the one we looked at:
+    // the chunks of the value we replace are ours to remove. When writes
+    // race, each manifest is replaced exactly once, so every old set of
+    // chunks is removed exactly once.
+    while (true) {
+        Buffer header;
+        RejectRules rejectRules = {};
+        Manifest old;
+        bool replacesChunks = false;
+        try {
+            uint64_t oldVersion;
+            uint32_t oldLength;
+            ramcloud->readRange(tableId, key, keyLength, 0,
+                    sizeof32(Manifest), &header, NULL, &oldVersion,
+                    &oldLength);
+            rejectRules.givenVersion = oldVersion;
+            rejectRules.versionNeGiven = 1;
+            replacesChunks = parseManifest(&header, oldLength, &old) &&
+                    (old.numChunks > 0);
+        } catch (ObjectDoesntExistException& e) {
+            rejectRules.exists = 1;
+        }
+        try {
+            ramcloud->write(tableId, key, keyLength, newData, newLength,
+                    &rejectRules, version);
+        } catch (RejectRulesException& e) {
+            continue;
+        }
+        if (replacesChunks)
+            removeChunks(ramcloud, tableId, key, keyLength, &old);
+        return;
+    }
+}
+
+/**
+ * Return the key of one chunk of a large object.
+ *
+ * \param key
+ *      Key of the large object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param generation
+ *      Manifest::generation of the value that the chunk belongs to.
+ * \param index
+ *      Which chunk of the value (0 is the first).
+ */
+string
+LargeObject::chunkKey(const void* key, uint16_t keyLength,
+        uint64_t generation, uint32_t index)
+{
+    string result(static_cast<const char*>(key), keyLength);
+    result.append("\0LO", 3);
+    result.append(reinterpret_cast<const char*>(&generation),
+            sizeof(generation));
+    result.append(reinterpret_cast<const char*>(&index), sizeof(index));
+    return result;
+}
+
+/**
+ * Decide whether an object is the manifest of a large object.
+ *
+ * \param header
+ *      Holds at least the first sizeof(Manifest) bytes of the object's
+ *      value, if it has that many.
+ * \param valueLength
+ *      Size of the object's entire value.
+ * \param[out] manifest
+ *      If the object is a manifest, it is copied here.
+ * \return
+ *      True if the object is a manifest, false if it was written with
+ *      RamCloud::write.
+ */
+bool
+LargeObject::parseManifest(Buffer* header, uint32_t valueLength,
+        Manifest* manifest)
+{
+    if (header->size() < sizeof32(Manifest))
+        return false;
+    header->copy(0, sizeof32(Manifest), manifest);
+    if (manifest->magic != MAGIC)
+        return false;
+    if (manifest->numChunks == 0)
+        return valueLength == sizeof32(Manifest) + manifest->length;
+    return (valueLength == sizeof32(Manifest)) &&
+            (manifest->chunkSize > 0) &&
+            (manifest->numChunks == (manifest->length +
+            manifest->chunkSize - 1) / manifest->chunkSize);
+}
+
+/**
+ * Read all of the chunks of a large object into contiguous memory.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Key of the large object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param manifest
+ *      Describes the chunks to read.
+ * \param[out] value
+ *      The value is appended here.
+ * \return
+ *      False if some of the chunks didn't exist; then \a value holds
+ *      garbage.
+ */
+bool
+LargeObject::readChunks(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, const Manifest* manifest,
+        Buffer* value)
+{
+    char* dest = static_cast<char*>(value->alloc(manifest->length));
+    Buffer chunks[MAX_OUTSTANDING];
+    string keys[MAX_OUTSTANDING];
+    bool complete = true;
+    pipeline<ReadRpc>(ramcloud, manifest->numChunks,
+        [&](Tub<ReadRpc>* rpc, int slot, uint32_t index) {
+            keys[slot] = chunkKey(key, keyLength, manifest->generation,
+                    index);
+            rpc->construct(ramcloud, tableId, keys[slot].data(),
+                    downCast<uint16_t>(keys[slot].size()), &chunks[slot]);
+        },
+        [&](ReadRpc* rpc, int slot, uint32_t index) {
+            uint32_t offset = index * manifest->chunkSize;
+            uint32_t expected = std::min(manifest->chunkSize,
+                    manifest->length - offset);
+            try {
+                rpc->wait();
+            } catch (ObjectDoesntExistException& e) {
+                complete = false;
+                return false;
+            }
+            if (chunks[slot].size() != expected) {
+                complete = false;
+                return false;
+            }
+            chunks[slot].copy(0, expected, dest + offset);
+            return true;
+        });
+    return complete;
+}
+
+/**
+ * Delete all of the chunks of a large object.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Key of the large object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param manifest
+ *      Describes the chunks to delete. Chunks that don't exist are
+ *      ignored.
+ */
+void
+LargeObject::removeChunks(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, const Manifest* manifest)
+{
+    string keys[MAX_OUTSTANDING];
+    pipeline<RemoveRpc>(ramcloud, manifest->numChunks,
+        [&](Tub<RemoveRpc>* rpc, int slot, uint32_t index) {
+            keys[slot] = chunkKey(key, keyLength, manifest->generation,
+                    index);
+            rpc->construct(ramcloud, tableId, keys[slot].data(),
+                    downCast<uint16_t>(keys[slot].size()));
+        },
+        [&](RemoveRpc* rpc, int slot, uint32_t index) {
+            rpc->wait();
+            return true;
+        });
+}
+
+/**
+ * Write all of the chunks of a large object.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      The table containing the object.
+ * \param key
+ *      Key of the large object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param manifest
+ *      Describes the chunks to write.
+ * \param buf
+ *      The entire value of the object.
+ */
+void
+LargeObject::writeChunks(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, const Manifest* manifest,
+        const void* buf)
+{
+    string keys[MAX_OUTSTANDING];
+    pipeline<WriteRpc>(ramcloud, manifest->numChunks,
+        [&](Tub<WriteRpc>* rpc, int slot, uint32_t index) {
+            uint32_t offset = index * manifest->chunkSize;
+            keys[slot] = chunkKey(key, keyLength, manifest->generation,
+                    index);
+            rpc->construct(ramcloud, tableId, keys[slot].data(),
+                    downCast<uint16_t>(keys[slot].size()),
+                    static_cast<const char*>(buf) + offset,
+                    std::min(manifest->chunkSize, manifest->length - offset));
+        },
+        [&](WriteRpc* rpc, int slot, uint32_t index) {
+            rpc->wait();
+            return true;
+        });
+}
+
+} // namespace RAMCloud
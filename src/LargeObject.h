@@ -0,0 +1,115 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_LARGEOBJECT_H
+#define RAMCLOUD_LARGEOBJECT_H
+
+#include "Buffer.h"
+
+namespace RAMCloud {
+
+class RamCloud;
+
+/**
+ * Stores values that are too large for a single object (see
+ * RamCloud::writeLarge). A large value is split into chunks of CHUNK_SIZE
+ * bytes, each stored as an ordinary object in the same table, and a small
+ * manifest object under the value's own key says which chunks make up the
+ * value. Since chunk keys hash independently, the chunks of a value are
+ * spread over all of the table's tablets, and they are read and written
+ * with up to MAX_OUTSTANDING RPCs in flight at once.
+ *
+ * A write first writes all of the chunks of the new value under keys that
+ * no other write uses, then replaces the manifest, and only then removes
+ * the chunks of the value it replaced. So readers see either the old value
+ * or the new one, never a mix; a reader that loses a race with the removal
+ * of old chunks just starts over with the new manifest. If a writer
+ * crashes before replacing the manifest, the chunks it wrote are never
+ * removed.
+ *
+ * Values no larger than CHUNK_SIZE are stored in the manifest itself, so
+ * they take a single RPC to read. Objects written with RamCloud::write can
+ * be read with read(); their values are returned unchanged.
+ *
+ * Chunks are ordinary objects, and they show up in enumerations of the
+ * table. Their keys are the key of the large object followed by a zero
+ * byte, "LO", and 12 more bytes, so applications must not use keys of
+ * that form for other objects.
+ */
+class LargeObject {
+  public:
+    static void read(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, Buffer* value, uint64_t* version = NULL);
+    static void remove(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength);
+    static void write(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, const void* buf, uint32_t length,
+            uint64_t* version = NULL);
+
+    /// Size of each chunk of a large value. Chunks are kept well below the
+    /// largest object a master accepts, so that they pack well into log
+    /// segments and a value is spread over many chunks that can be
+    /// transferred in parallel.
+    static const uint32_t CHUNK_SIZE = 256 * 1024;
+
+    /// Most chunk RPCs outstanding at once for one read, write or remove.
+    static const int MAX_OUTSTANDING = 16;
+
+  PRIVATE:
+    /**
+     * The value of the object stored under the key of a large object. For
+     * values of at most CHUNK_SIZE bytes, the value itself follows the
+     * manifest.
+     */
+    struct Manifest {
+        /// Always MAGIC; distinguishes manifests from values written with
+        /// RamCloud::write.
+        uint32_t magic;
+
+        /// Size of every chunk except perhaps the last one.
+        uint32_t chunkSize;
+
+        /// Included in the keys of all of the chunks of this value; chosen
+        /// at random by each write.
+        uint64_t generation;
+
+        /// Total size of the value, in bytes.
+        uint32_t length;
+
+        /// Number of chunks the value was split into, or 0 if the value
+        /// follows the manifest.
+        uint32_t numChunks;
+    } __attribute__((packed));
+
+    static const uint32_t MAGIC = 0x4c4f424a;
+
+    static string chunkKey(const void* key, uint16_t keyLength,
+            uint64_t generation, uint32_t index);
+    static bool parseManifest(Buffer* header, uint32_t valueLength,
+            Manifest* manifest);
+    static bool readChunks(RamCloud* ramcloud, uint64_t tableId,
+            const void* key, uint16_t keyLength, const Manifest* manifest,
+            Buffer* value);
+    static void removeChunks(RamCloud* ramcloud, uint64_t tableId,
+            const void* key, uint16_t keyLength, const Manifest* manifest);
+    static void writeChunks(RamCloud* ramcloud, uint64_t tableId,
+            const void* key, uint16_t keyLength, const Manifest* manifest,
+            const void* buf);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_LARGEOBJECT_H
@@ -0,0 +1,197 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ClientException.h"
+#include "LargeObject.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+class LargeObjectTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    ServerConfig masterConfig;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+
+    LargeObjectTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , masterConfig(ServerConfig::forTesting())
+        , ramcloud()
+        , tableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        // Chunks are bigger than the objects of the default test config.
+        masterConfig.services = {WireFormat::MASTER_SERVICE,
+                                 WireFormat::ADMIN_SERVICE};
+        masterConfig.segmentSize = 1024 * 1024;
+        masterConfig.segletSize = 1024 * 1024;
+        masterConfig.maxObjectDataSize = 512 * 1024;
+        masterConfig.master.logBytes = 32 * 1024 * 1024;
+        masterConfig.master.numReplicas = 0;
+        masterConfig.localLocator = "mock:host=master1";
+        cluster.addServer(masterConfig);
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table");
+    }
+
+    /// Returns a value of the given length that differs in every chunk.
+    string
+    makeValue(uint32_t length, char first = 'a')
+    {
+        string value(length, ' ');
+        for (uint32_t i = 0; i < length; i++)
+            value[i] = static_cast<char>(first + (i / 1000) % 26);
+        return value;
+    }
+
+    /// Returns true if the given chunk of an object exists.
+    bool
+    chunkExists(const char* key, uint64_t generation, uint32_t index)
+    {
+        string chunk = LargeObject::chunkKey(key,
+                downCast<uint16_t>(strlen(key)), generation, index);
+        Buffer value;
+        try {
+            ramcloud->read(tableId, chunk.data(),
+                    downCast<uint16_t>(chunk.size()), &value);
+        } catch (ObjectDoesntExistException& e) {
+            return false;
+        }
+        return true;
+    }
+
+    /// Returns the manifest of an object written with writeLarge.
+    LargeObject::Manifest
+    getManifest(const char* key)
+    {
+        Buffer value;
+        ramcloud->read(tableId, key, downCast<uint16_t>(strlen(key)),
+                &value);
+        LargeObject::Manifest manifest;
+        EXPECT_TRUE(LargeObject::parseManifest(&value, value.size(),
+                &manifest));
+        return manifest;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(LargeObjectTest);
+};
+
+TEST_F(LargeObjectTest, write_smallValueInline) {
+    ramcloud->writeLarge(tableId, "key", 3, "abcde", 5);
+    LargeObject::Manifest manifest = getManifest("key");
+    EXPECT_EQ(0u, manifest.numChunks);
+    EXPECT_EQ(5u, manifest.length);
+
+    Buffer value;
+    ramcloud->readLarge(tableId, "key", 3, &value);
+    EXPECT_EQ("abcde", TestUtil::toString(&value));
+}
+
+TEST_F(LargeObjectTest, write_chunked) {
+    string value = makeValue(3 * LargeObject::CHUNK_SIZE + 5);
+    uint64_t version;
+    ramcloud->writeLarge(tableId, "key", 3, value.data(),
+            downCast<uint32_t>(value.size()), &version);
+    LargeObject::Manifest manifest = getManifest("key");
+    EXPECT_EQ(4u, manifest.numChunks);
+    EXPECT_TRUE(chunkExists("key", manifest.generation, 3));
+    EXPECT_FALSE(chunkExists("key", manifest.generation, 4));
+
+    Buffer buffer;
+    uint64_t readVersion;
+    ramcloud->readLarge(tableId, "key", 3, &buffer, &readVersion);
+    EXPECT_EQ(version, readVersion);
+    EXPECT_EQ(value.size(), buffer.size());
+    EXPECT_TRUE(value == TestUtil::toString(&buffer));
+    EXPECT_EQ(1u, buffer.getNumberChunks());
+}
+
+TEST_F(LargeObjectTest, write_removesReplacedChunks) {
+    string value1 = makeValue(2 * LargeObject::CHUNK_SIZE, 'a');
+    ramcloud->writeLarge(tableId, "key", 3, value1.data(),
+            downCast<uint32_t>(value1.size()));
+    LargeObject::Manifest old = getManifest("key");
+
+    string value2 = makeValue(LargeObject::CHUNK_SIZE + 1, 'A');
+    ramcloud->writeLarge(tableId, "key", 3, value2.data(),
+            downCast<uint32_t>(value2.size()));
+    EXPECT_FALSE(chunkExists("key", old.generation, 0));
+    EXPECT_FALSE(chunkExists("key", old.generation, 1));
+
+    Buffer buffer;
+    ramcloud->readLarge(tableId, "key", 3, &buffer);
+    EXPECT_TRUE(value2 == TestUtil::toString(&buffer));
+}
+
+TEST_F(LargeObjectTest, write_keyTooLong) {
+    string key(UINT16_MAX - 10, 'k');
+    string value = makeValue(LargeObject::CHUNK_SIZE + 1);
+    EXPECT_THROW(ramcloud->writeLarge(tableId, key.data(),
+            downCast<uint16_t>(key.size()), value.data(),
+            downCast<uint32_t>(value.size())), InvalidParameterException);
+}
+
+TEST_F(LargeObjectTest, read_plainObject) {
+    ramcloud->write(tableId, "key", 3, "plain value");
+    Buffer value;
+    ramcloud->readLarge(tableId, "key", 3, &value);
+    EXPECT_EQ("plain value", TestUtil::toString(&value));
+}
+
+TEST_F(LargeObjectTest, read_doesntExist) {
+    Buffer value;
+    EXPECT_THROW(ramcloud->readLarge(tableId, "key", 3, &value),
+            ObjectDoesntExistException);
+}
+
+TEST_F(LargeObjectTest, read_chunkMissing) {
+    string value = makeValue(2 * LargeObject::CHUNK_SIZE);
+    ramcloud->writeLarge(tableId, "key", 3, value.data(),
+            downCast<uint32_t>(value.size()));
+    LargeObject::Manifest manifest = getManifest("key");
+    string chunk = LargeObject::chunkKey("key", 3, manifest.generation, 1);
+    ramcloud->remove(tableId, chunk.data(), downCast<uint16_t>(chunk.size()));
+
+    Buffer buffer;
+    EXPECT_THROW(ramcloud->readLarge(tableId, "key", 3, &buffer),
+            ObjectDoesntExistException);
+    EXPECT_EQ(0u, buffer.size());
+}
+
+TEST_F(LargeObjectTest, remove) {
+    string value = makeValue(2 * LargeObject::CHUNK_SIZE);
+    ramcloud->writeLarge(tableId, "key", 3, value.data(),
+            downCast<uint32_t>(value.size()));
+    LargeObject::Manifest manifest = getManifest("key");
+    ramcloud->removeLarge(tableId, "key", 3);
+    EXPECT_FALSE(chunkExists("key", manifest.generation, 0));
+    EXPECT_FALSE(chunkExists("key", manifest.generation, 1));
+    Buffer buffer;
+    EXPECT_THROW(ramcloud->readLarge(tableId, "key", 3, &buffer),
+            ObjectDoesntExistException);
+
+    // Removing an object that doesn't exist is a no-op.
+    ramcloud->removeLarge(tableId, "key", 3);
+}
+
+}  // namespace RAMCloud
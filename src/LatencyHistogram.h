@@ -0,0 +1,223 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_LATENCYHISTOGRAM_H
+#define RAMCLOUD_LATENCYHISTOGRAM_H
+
+#include <cmath>
+
+#include "Common.h"
+#include "BitOps.h"
+#include "Buffer.h"
+
+namespace RAMCloud {
+
+/**
+ * A log-linear ("HDR"-style) histogram of latencies, cheap enough to update
+ * on every RPC. Each power of two is divided into SUB_BUCKETS equal buckets,
+ * so the bucket a sample lands in pins its value down to within about 6%,
+ * no matter how large the value is; this is what percentiles such as p999
+ * need, and fixed-width buckets (see Histogram) can't provide it over the
+ * range from nanoseconds to seconds.
+ *
+ * Samples of 2^MAX_VALUE_BITS or more (about 18 minutes, in nanoseconds)
+ * are counted in the last bucket.
+ *
+ * Recording samples isn't synchronized: each histogram should be updated by
+ * a single thread. Other threads may read it at any time, in which case
+ * they see a slightly stale copy.
+ */
+class LatencyHistogram {
+  public:
+    /// Each power of two is split into 2^SUB_BUCKET_BITS buckets.
+    static const int SUB_BUCKET_BITS = 4;
+    static const uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+
+    /// Samples up to 2^MAX_VALUE_BITS - 1 are counted precisely.
+    static const int MAX_VALUE_BITS = 40;
+
+    /// Total number of buckets in a histogram.
+    static const uint32_t NUM_BUCKETS =
+            (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    /// The format of each non-empty bucket in serialized histograms.
+    struct SerializedBucket {
+        uint16_t index;           // Which bucket.
+        uint64_t count;           // Number of samples that fell into it.
+    } __attribute__((packed));
+
+    LatencyHistogram()
+        : counts()
+    {
+    }
+
+    /**
+     * Return the index of the bucket that counts a particular value.
+     */
+    static uint32_t
+    bucketIndex(uint64_t value)
+    {
+        int bits = BitOps::findLastSet(value);
+        if (bits <= SUB_BUCKET_BITS)
+            return downCast<uint32_t>(value);
+        if (bits > MAX_VALUE_BITS)
+            return NUM_BUCKETS - 1;
+        int shift = bits - 1 - SUB_BUCKET_BITS;
+        return downCast<uint32_t>(
+                (bits - SUB_BUCKET_BITS) * SUB_BUCKETS +
+                ((value >> shift) & (SUB_BUCKETS - 1)));
+    }
+
+    /**
+     * Return the largest value counted by a particular bucket.
+     */
+    static uint64_t
+    bucketLimit(uint32_t index)
+    {
+        if (index < SUB_BUCKETS)
+            return index;
+        uint32_t shift = index / SUB_BUCKETS - 1;
+        uint64_t low = static_cast<uint64_t>(
+                SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        return low + (1UL << shift) - 1;
+    }
+
+    /**
+     * Count one sample.
+     */
+    void
+    record(uint64_t value)
+    {
+        counts[bucketIndex(value)]++;
+    }
+
+    /**
+     * Add all of the samples in another histogram to this one.
+     */
+    void
+    merge(const LatencyHistogram& other)
+    {
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+            counts[i] += other.counts[i];
+    }
+
+    /**
+     * Remove the samples in an earlier reading of this histogram, leaving
+     * just the samples recorded since then.
+     */
+    void
+    subtract(const LatencyHistogram& earlier)
+    {
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            counts[i] = (counts[i] >= earlier.counts[i])
+                    ? counts[i] - earlier.counts[i] : 0;
+        }
+    }
+
+    /**
+     * Return the total number of samples recorded.
+     */
+    uint64_t
+    getCount() const
+    {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+            total += counts[i];
+        return total;
+    }
+
+    /**
+     * Return (an upper bound on) the value below which a given fraction of
+     * the samples lie, such as 0.99 for the 99th percentile. Returns 0 if
+     * there are no samples.
+     */
+    uint64_t
+    getPercentile(double fraction) const
+    {
+        uint64_t total = getCount();
+        if (total == 0)
+            return 0;
+        uint64_t target = static_cast<uint64_t>(
+                std::ceil(fraction * static_cast<double>(total)));
+        target = std::max(target, 1UL);
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= target)
+                return bucketLimit(i);
+        }
+        return bucketLimit(NUM_BUCKETS - 1);
+    }
+
+    /**
+     * Append a compact copy of this histogram to a buffer: a uint16_t
+     * count of non-empty buckets, followed by a SerializedBucket for each.
+     */
+    void
+    serialize(Buffer* buffer) const
+    {
+        uint16_t* numBuckets = buffer->emplaceAppend<uint16_t>();
+        *numBuckets = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+            if (counts[i] == 0)
+                continue;
+            SerializedBucket* bucket =
+                    buffer->emplaceAppend<SerializedBucket>();
+            bucket->index = downCast<uint16_t>(i);
+            bucket->count = counts[i];
+            (*numBuckets)++;
+        }
+    }
+
+    /**
+     * Replace the contents of this histogram with one written by
+     * serialize().
+     *
+     * \param buffer
+     *      Holds the serialized histogram.
+     * \param[in,out] offset
+     *      Offset of the serialized histogram in \a buffer; on return, the
+     *      offset just past it.
+     * \return
+     *      False if \a buffer doesn't hold a well-formed histogram.
+     */
+    bool
+    deserialize(Buffer* buffer, uint32_t* offset)
+    {
+        memset(counts, 0, sizeof(counts));
+        const uint16_t* numBuckets = buffer->getOffset<uint16_t>(*offset);
+        if (numBuckets == NULL)
+            return false;
+        *offset += sizeof32(*numBuckets);
+        for (uint16_t i = 0; i < *numBuckets; i++) {
+            const SerializedBucket* bucket =
+                    buffer->getOffset<SerializedBucket>(*offset);
+            if (bucket == NULL || bucket->index >= NUM_BUCKETS)
+                return false;
+            counts[bucket->index] = bucket->count;
+            *offset += sizeof32(*bucket);
+        }
+        return true;
+    }
+
+  PRIVATE:
+    /// Number of samples counted in each bucket.
+    uint64_t counts[NUM_BUCKETS];
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_LATENCYHISTOGRAM_H
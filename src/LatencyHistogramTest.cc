@@ -0,0 +1,117 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "LatencyHistogram.h"
+
+namespace RAMCloud {
+
+class LatencyHistogramTest : public ::testing::Test {
+  public:
+    LatencyHistogram histogram;
+
+    LatencyHistogramTest()
+        : histogram()
+    {}
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogramTest);
+};
+
+TEST_F(LatencyHistogramTest, bucketIndex) {
+    EXPECT_EQ(0u, LatencyHistogram::bucketIndex(0));
+    EXPECT_EQ(15u, LatencyHistogram::bucketIndex(15));
+    EXPECT_EQ(16u, LatencyHistogram::bucketIndex(16));
+    EXPECT_EQ(31u, LatencyHistogram::bucketIndex(31));
+    EXPECT_EQ(32u, LatencyHistogram::bucketIndex(32));
+    EXPECT_EQ(32u, LatencyHistogram::bucketIndex(33));
+    EXPECT_EQ(33u, LatencyHistogram::bucketIndex(34));
+    EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1,
+            LatencyHistogram::bucketIndex((1UL << 40) - 1));
+    EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1,
+            LatencyHistogram::bucketIndex(~0UL));
+}
+
+TEST_F(LatencyHistogramTest, bucketLimit) {
+    EXPECT_EQ(15u, LatencyHistogram::bucketLimit(15));
+    EXPECT_EQ(31u, LatencyHistogram::bucketLimit(31));
+    EXPECT_EQ(33u, LatencyHistogram::bucketLimit(32));
+    EXPECT_EQ((1UL << 40) - 1,
+            LatencyHistogram::bucketLimit(LatencyHistogram::NUM_BUCKETS - 1));
+
+    // Every value lands in a bucket whose limit is within 1/16 of it.
+    for (uint64_t value = 1; value < (1UL << 40); value = value * 3 + 1) {
+        uint64_t limit = LatencyHistogram::bucketLimit(
+                LatencyHistogram::bucketIndex(value));
+        EXPECT_LE(value, limit);
+        EXPECT_LE(limit - value, value / 16);
+    }
+}
+
+TEST_F(LatencyHistogramTest, getPercentile) {
+    EXPECT_EQ(0u, histogram.getPercentile(0.99));
+    for (uint64_t i = 1; i <= 100; i++)
+        histogram.record(i);
+    EXPECT_EQ(100u, histogram.getCount());
+    EXPECT_EQ(1u, histogram.getPercentile(0));
+    EXPECT_EQ(51u, histogram.getPercentile(0.5));
+    EXPECT_EQ(99u, histogram.getPercentile(0.99));
+    EXPECT_EQ(103u, histogram.getPercentile(1.0));
+}
+
+TEST_F(LatencyHistogramTest, mergeAndSubtract) {
+    LatencyHistogram other;
+    histogram.record(10);
+    other.record(10);
+    other.record(1000);
+    histogram.merge(other);
+    EXPECT_EQ(3u, histogram.getCount());
+    EXPECT_EQ(1023u, histogram.getPercentile(1.0));
+
+    histogram.subtract(other);
+    EXPECT_EQ(1u, histogram.getCount());
+    EXPECT_EQ(10u, histogram.getPercentile(1.0));
+
+    // Counts never go negative.
+    histogram.subtract(other);
+    EXPECT_EQ(0u, histogram.getCount());
+}
+
+TEST_F(LatencyHistogramTest, serializeAndDeserialize) {
+    histogram.record(5);
+    histogram.record(5);
+    histogram.record(123456);
+    Buffer buffer;
+    buffer.appendCopy("x", 1);
+    histogram.serialize(&buffer);
+    EXPECT_EQ(1 + 2 + 2 * sizeof(LatencyHistogram::SerializedBucket),
+            buffer.size());
+
+    LatencyHistogram copy;
+    copy.record(99);
+    uint32_t offset = 1;
+    EXPECT_TRUE(copy.deserialize(&buffer, &offset));
+    EXPECT_EQ(buffer.size(), offset);
+    EXPECT_EQ(3u, copy.getCount());
+    EXPECT_EQ(5u, copy.getPercentile(0.5));
+    EXPECT_EQ(histogram.getPercentile(1.0), copy.getPercentile(1.0));
+
+    // Truncated.
+    buffer.truncate(buffer.size() - 1);
+    offset = 1;
+    EXPECT_FALSE(copy.deserialize(&buffer, &offset));
+}
+
+}  // namespace RAMCloud
@@ -215,5 +215,9 @@ template void LinearizableObjectRpcWrapper::fillLinearizabilityHeader
     <WireFormat::Increment::Request>(WireFormat::Increment::Request* reqHdr);
 template void LinearizableObjectRpcWrapper::fillLinearizabilityHeader
     <WireFormat::Remove::Request>(WireFormat::Remove::Request* reqHdr);
+template void LinearizableObjectRpcWrapper::fillLinearizabilityHeader
+    <WireFormat::Patch::Request>(WireFormat::Patch::Request* reqHdr);
+template void LinearizableObjectRpcWrapper::fillLinearizabilityHeader
+    <WireFormat::Append::Request>(WireFormat::Append::Request* reqHdr);
 
 } // namespace RAMCloud
@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
 #include <assert.h>
 #include <stdint.h>
 
@@ -67,6 +68,8 @@ Log::Log(Context* context,
       context(context),
       cleaner(NULL),
       syncLock("Log::syncLock"),
+      durableLock("Log::durableLock"),
+      durablePosition(),
       metrics()
 {
     cleaner = new LogCleaner(context,
@@ -115,6 +118,8 @@ Log::getMetrics(ProtoBuf::LogMetrics& m)
     AbstractLog::getMetrics(m);
     m.set_total_sync_calls(metrics.totalSyncCalls);
     m.set_total_sync_ticks(metrics.totalSyncTicks);
+    m.set_total_group_commits(metrics.totalGroupCommits);
+    m.set_total_group_commit_bytes(metrics.totalGroupCommitBytes);
     cleaner->getMetrics(*m.mutable_cleaner_metrics());
 }
 
@@ -127,6 +132,45 @@ Log::getHead() {
     return LogPosition(head->id, head->getAppendedLength());
 }
 
+/**
+ * Return the position in the log up to which every append has been fully
+ * replicated to backups. Appends made since the last call to sync(),
+ * syncTo() or rollHeadOver() may be durable already without this position
+ * reflecting it yet. Unlike getHead(), this never waits for appends.
+ */
+LogPosition
+Log::getDurablePosition()
+{
+    SpinLock::Guard _(durableLock);
+    return durablePosition;
+}
+
+/**
+ * Collect the segments that are currently part of the log, in increasing
+ * order of their identifiers. Segments that have just been cleaned are
+ * included; none of them are freed before the RPC the caller is handling
+ * completes.
+ *
+ * \param[out] outSegments
+ *      The segments are appended to this vector.
+ * \param[out] relocationGeneration
+ *      Set to SegmentManager::getRelocationGeneration() as of just before the
+ *      segments were collected: segments that the cleaner adds to the log
+ *      later on have larger values of LogSegment::relocationGeneration.
+ */
+void
+Log::getSegments(LogSegmentVector& outSegments,
+                 uint64_t* relocationGeneration)
+{
+    *relocationGeneration = segmentManager->getRelocationGeneration();
+    size_t first = outSegments.size();
+    segmentManager->getActiveSegments(0, outSegments);
+    std::sort(outSegments.begin() + first, outSegments.end(),
+            [](const LogSegment* a, const LogSegment* b) {
+                return a->id < b->id;
+            });
+}
+
 /**
  * Wait for all log appends made at the time this method is invoked to be fully
  * replicated to backups. If no appends have ever been done, this method will
@@ -136,12 +180,18 @@ Log::getHead() {
  * caller will fully sync the log and return. Doing so will propagate any
  * appends done since the last sync, including those performed by other threads.
  *
- * If a sync operation is already underway, this method will block until it
- * completes. Afterwards it will either return immediately if a previous call
- * did the work for us, or, if more replication is needed, it will sync the full
- * log contents at that time, including any appends made since this method
- * started waiting. This lets us batch backup writes and improve throughput for
- * small entries.
+ * If a sync operation is already underway, this method does not queue up
+ * behind it. Instead it waits for one of two things: either the replication
+ * round in flight (issued by the current "sync leader") covers this caller's
+ * appends, in which case it returns as soon as that round completes, or the
+ * round ends without covering them, in which case the first waiter to notice
+ * becomes the leader of the next round. A leader syncs everything appended
+ * to the head up to that moment in a single ReplicatedSegment::sync() call,
+ * so all the writers that arrived during the previous round are made durable
+ * together (group commit) and are released at once, rather than one at a
+ * time as each acquires the sync lock. This lets us batch backup writes and
+ * improve throughput for small entries. See Log::Metrics for counters that
+ * describe how well batching is working.
  *
  * An alternative to batching writes would have been to pipeline replication
  * RPCs to backups. That would probably also work just fine, but results in
@@ -149,9 +199,16 @@ Log::getHead() {
  * that may arrive out-of-order). The log also currently operates strictly
  * in-order, so there'd be no opportunity for small writes to skip ahead of
  * large ones anyway.
+ *
+ * \param minReplicas
+ *      Return once the appends are on this many backups, rather than on all
+ *      of the head's replicas (see ReplicatedSegment::sync). Such a partial
+ *      sync is not reflected in getDurablePosition(); the remaining replicas
+ *      are written in the background, and the next full sync() finds most of
+ *      its work done. The default waits for every replica.
  */
 void
-Log::sync()
+Log::sync(uint32_t minReplicas)
 {
     CycleCounter<uint64_t> __(&PerfStats::threadStats.logSyncCycles);
 
@@ -183,31 +240,47 @@ Log::sync()
     LogSegment* originalHead = head;
 
     // We have a consistent view of the current head segment, so drop the append
-    // lock and grab the sync lock. This allows other writers to append to the
-    // log while we wait. Once we grab the sync lock, take the append lock again
-    // to ensure our new view of the head is consistent.
+    // lock. This allows other writers to append to the log while we wait.
     lock.destroy();
-    SpinLock::Guard _(syncLock);
-    lock.construct(appendLock);
 
-    // See if we still have work to do. It's possible that another thread
-    // already did the syncing we needed for us.
-    if (appendedLength > originalHead->syncedLength) {
+    // Wait until either another thread's replication round covers our appends
+    // or we get to lead the next round ourselves. Once we hold the sync lock,
+    // take the append lock again to ensure our new view of the head is
+    // consistent.
+    while (appendedLength > originalHead->syncedLength) {
+        if (!waitToLeadSync(originalHead, appendedLength))
+            break;
+        SpinLock::Guard _(syncLock, std::adopt_lock);
+
+        // Another leader may have finished just before we got the lock.
+        if (appendedLength <= originalHead->syncedLength)
+            break;
+
         // Get the latest segment length and certificate. This allows us to
         // batch up other appends that came in while we were waiting.
+        lock.construct(appendLock);
         SegmentCertificate certificate;
         appendedLength = originalHead->getAppendedLength(&certificate);
 
-        // Drop the append lock. We don't want to block other appending threads
-        // while we sync.
+        // Drop the append lock. We don't want to block other appending
+        // threads while we sync.
         lock.destroy();
 
-        originalHead->replicatedSegment->sync(appendedLength, &certificate);
+        uint32_t previouslySynced = originalHead->syncedLength;
+        originalHead->replicatedSegment->sync(appendedLength, &certificate,
+                minReplicas);
+        if (minReplicas != ~0u) {
+            TEST_LOG("log synced to %u replicas", minReplicas);
+            return;
+        }
         originalHead->syncedLength = appendedLength;
+        advanceDurablePosition({originalHead->id, appendedLength});
+        metrics.totalGroupCommits++;
+        metrics.totalGroupCommitBytes += appendedLength - previouslySynced;
         TEST_LOG("log synced");
-    } else {
-        TEST_LOG("sync not needed: already fully replicated");
+        return;
     }
+    TEST_LOG("sync not needed: already fully replicated");
 }
 
 /**
@@ -239,11 +312,17 @@ Log::syncTo(Log::Reference reference)
     segment->getEntry(offset, NULL, &lengthWithMetadata);
     uint32_t desiredSyncedLength = offset + lengthWithMetadata;
 
-    SpinLock::Guard _(syncLock);
-
-    // See if we still have work to do. It's possible that another thread
-    // already did the syncing we needed for us.
-    if (desiredSyncedLength > segment->syncedLength) {
+    // As in sync(), either another thread's replication round covers our
+    // entry or we lead the next one.
+    while (desiredSyncedLength > segment->syncedLength) {
+        if (!waitToLeadSync(segment, desiredSyncedLength))
+            break;
+        SpinLock::Guard _(syncLock, std::adopt_lock);
+
+        // See if we still have work to do. It's possible that another thread
+        // already did the syncing we needed for us.
+        if (desiredSyncedLength <= segment->syncedLength)
+            break;
         Tub<SpinLock::Guard> lock;
         lock.construct(appendLock);
 
@@ -253,14 +332,19 @@ Log::syncTo(Log::Reference reference)
         // If segment != head, segment must have been closed and its replication
         // is queued already. Forcing sync of head segment will also make sure
         // that the closed segment is fully replicated.
-        uint32_t appendedLength = head->getAppendedLength(&certificate);
+        LogSegment* syncedHead = head;
+        uint32_t appendedLength = syncedHead->getAppendedLength(&certificate);
 
         // Drop the append lock. We don't want to block other appending
         // threads while we sync.
         lock.destroy();
 
-        head->replicatedSegment->sync(appendedLength, &certificate);
-        head->syncedLength = appendedLength;
+        uint32_t previouslySynced = syncedHead->syncedLength;
+        syncedHead->replicatedSegment->sync(appendedLength, &certificate);
+        syncedHead->syncedLength = appendedLength;
+        advanceDurablePosition({syncedHead->id, appendedLength});
+        metrics.totalGroupCommits++;
+        metrics.totalGroupCommitBytes += appendedLength - previouslySynced;
         TEST_LOG("log synced");
         return;
     }
@@ -282,9 +366,17 @@ Log::syncTo(Log::Reference reference)
  * want to recover that data if a failure occurrs. Fortunately, its data would
  * be at strictly lower positions in the log, so it's easy to filter during
  * recovery.
+ *
+ * \param[out] outSegments
+ *      If not NULL, every segment that is part of the log at the instant the
+ *      new head is created, except the new head itself, is appended here.
+ *      Together they hold exactly the entries appended before the returned
+ *      position (cleaner survivors among them hold copies of entries from
+ *      segments that were cleaned); see TableSnapshot. The caller must keep
+ *      them from being freed by starting a LogProtector::Activity first.
  */
 LogPosition
-Log::rollHeadOver()
+Log::rollHeadOver(LogSegmentVector* outSegments)
 {
     SpinLock::Guard lock(syncLock);
     SpinLock::Guard lock2(appendLock);
@@ -295,10 +387,20 @@ Log::rollHeadOver()
     // into the main log (by adding segments to a new log digest and syncing
     // that to disk). See RAM-489.
     head = allocNextSegment(true);
+    if (outSegments != NULL) {
+        // No appends can happen while appendLock is held, and the segment
+        // manager swaps cleaned segments for survivors atomically, so this
+        // is a consistent picture of the log.
+        size_t first = outSegments->size();
+        segmentManager->getActiveSegments(0, *outSegments);
+        outSegments->erase(std::remove(outSegments->begin() + first,
+                outSegments->end(), head), outSegments->end());
+    }
     SegmentCertificate certificate;
     uint32_t appendedLength = head->getAppendedLength(&certificate);
     head->replicatedSegment->sync(appendedLength, &certificate);
     head->syncedLength = appendedLength;
+    advanceDurablePosition({head->id, appendedLength});
 
     return LogPosition(head->id, head->getAppendedLength());
 }
@@ -307,6 +409,18 @@ Log::rollHeadOver()
  * PRIVATE METHODS
  ******************************************************************************/
 
+/**
+ * Record that everything appended before \a position has been fully
+ * replicated. The position never moves backwards.
+ */
+void
+Log::advanceDurablePosition(LogPosition position)
+{
+    SpinLock::Guard _(durableLock);
+    if (position > durablePosition)
+        durablePosition = position;
+}
+
 /**
  * Allocate a new head segment for the log. This is used by the AbstractLog
  * superclass when a new segment is needed.
@@ -329,4 +443,45 @@ Log::allocNextSegment(bool mustNotFail)
         return segmentManager->allocHeadSegment();
 }
 
+/**
+ * Used by sync() and syncTo() to wait until either another thread's
+ * replication round has covered the data they need synced, or the caller
+ * can lead the next round itself. While a round is in progress this only
+ * watches \a segment (a round can take from microseconds to milliseconds,
+ * and retrying the lock for all that time would waste a core per waiter);
+ * if it takes longer than SYNC_SPIN_NS, the caller blocks on #syncLock.
+ *
+ * \param segment
+ *      Segment containing the data to be synced.
+ * \param length
+ *      The data is covered once \a segment is synced to this offset.
+ * \return
+ *      True means the caller now holds #syncLock and must release it;
+ *      it may find the data covered by the time it gets the lock. False
+ *      means the data has already been synced.
+ */
+bool
+Log::waitToLeadSync(LogSegment* segment, uint32_t length)
+{
+    uint64_t spinDeadline = 0;
+    while (length > segment->syncedLength) {
+        if (!syncLock.isLocked()) {
+            if (syncLock.try_lock())
+                return true;
+            continue;
+        }
+        if (spinDeadline == 0) {
+            spinDeadline = Cycles::rdtsc() +
+                    Cycles::fromNanoseconds(SYNC_SPIN_NS);
+        }
+        if (Cycles::rdtsc() < spinDeadline) {
+            __asm__ __volatile__("pause" ::: "memory");
+            continue;
+        }
+        syncLock.lock();
+        return true;
+    }
+    return false;
+}
+
 } // namespace
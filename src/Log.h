@@ -79,14 +79,23 @@ class Log : public AbstractLog {
 
     void enableCleaner();
     void disableCleaner();
+    LogPosition getDurablePosition();
     LogPosition getHead();
+    void getSegments(LogSegmentVector& outSegments,
+                     uint64_t* relocationGeneration);
     void getMetrics(ProtoBuf::LogMetrics& m);
-    void sync();
+    void sync(uint32_t minReplicas = ~0u);
     void syncTo(Log::Reference reference);
-    LogPosition rollHeadOver();
+    LogPosition rollHeadOver(LogSegmentVector* outSegments = NULL);
 
   PRIVATE:
+    void advanceDurablePosition(LogPosition position);
     LogSegment* allocNextSegment(bool mustNotFail);
+    bool waitToLeadSync(LogSegment* segment, uint32_t length);
+
+    /// How long sync() and syncTo() watch for another thread's replication
+    /// round to cover their appends before blocking on #syncLock.
+    static const uint64_t SYNC_SPIN_NS = 20000;
 
     INTRUSIVE_LIST_TYPEDEF(LogSegment, listEntries) SegmentList;
 
@@ -109,6 +118,13 @@ class Log : public AbstractLog {
     /// this one must be acquired first to avoid deadlock.
     SpinLock syncLock;
 
+    /// Protects #durablePosition. Never held while waiting for backups.
+    SpinLock durableLock;
+
+    /// Every append before this position has been replicated to all of the
+    /// backups; see getDurablePosition().
+    LogPosition durablePosition;
+
     /// Various event counters and performance measurements taken during log
     /// operation.
     class Metrics {
@@ -116,6 +132,8 @@ class Log : public AbstractLog {
         Metrics()
             : totalSyncCalls(0)
             , totalSyncTicks(0)
+            , totalGroupCommits(0)
+            , totalGroupCommitBytes(0)
         {
         }
 
@@ -124,12 +142,23 @@ class Log : public AbstractLog {
 
         /// Total number of cpu cycles spent syncing appended log entries.
         uint64_t totalSyncTicks;
+
+        /// Total number of replication rounds issued by sync() and syncTo().
+        /// Each round makes durable the appends of every caller that was
+        /// waiting when it started, so totalSyncCalls divided by this is the
+        /// average group commit batch size.
+        uint64_t totalGroupCommits;
+
+        /// Total number of head segment bytes made durable by the rounds
+        /// counted in #totalGroupCommits.
+        uint64_t totalGroupCommitBytes;
     } metrics;
 
     friend class LogIterator;
     friend class SideLog;
     friend class CleanerCompactionBenchmark;
     friend class ObjectManagerBenchmark;
+    friend class StorageBenchmark;
 
     DISALLOW_COPY_AND_ASSIGN(Log);
 };
@@ -44,8 +44,10 @@ logHandler(LogCabin::Client::Debug::DebugMessage message)
     else
         level = LogLevel::ERROR;
 
-    std::string filename = format("logcabin/%s", message.filename);
-    CodeLocation where(filename.c_str(),
+    // The strings in the location must outlive this call (the logger may
+    // format the message later, and keys its collapse map on the file
+    // pointer); LogCabin's come from __FILE__ and __func__.
+    CodeLocation where(message.filename,
                        message.linenum,
                        message.function,
                        message.function /* don't have pretty function */);
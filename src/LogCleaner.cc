@@ -15,6 +15,7 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <cmath>
 
 #include "Common.h"
 #include "Fence.h"
@@ -26,9 +27,13 @@
 #include "SegmentIterator.h"
 #include "ServerConfig.h"
 #include "WallTime.h"
+#include "WorkerManager.h"
 
 namespace RAMCloud {
 
+// Number of cleaner threads started so far; used to number them.
+static volatile uint32_t threadCnt;
+
 /**
  * Construct a new LogCleaner object. The cleaner will not perform any garbage
  * collection until the start() method is invoked.
@@ -61,6 +66,11 @@ LogCleaner::LogCleaner(Context* context,
       writeCostThreshold(config->master.cleanerWriteCostThreshold),
       disableInMemoryCleaning(config->master.disableInMemoryCleaning),
       numThreads(config->master.cleanerThreadCount),
+      coldDataAge(config->master.cleanerColdDataAge),
+      largeEntryBytes(config->master.cleanerLargeEntryBytes),
+      copyOnBackups(config->master.cleanerCopyOnBackups),
+      coldDataOnFlash(coldDataAge != 0 && segmentManager.getAllocator().
+                      getTotalCount(SegletAllocator::FLASH) > 0),
       segletSize(config->segletSize),
       segmentSize(config->segmentSize),
       activeThreads(0),
@@ -72,6 +82,8 @@ LogCleaner::LogCleaner(Context* context,
       inMemoryMetrics(),
       onDiskMetrics(),
       threadMetrics(numThreads),
+      relocationJob(NULL),
+      relocationJobLock("LogCleaner::relocationJobLock"),
       threadsShouldExit(false),
       threads(),
       balancer(NULL)
@@ -100,6 +112,9 @@ LogCleaner::LogCleaner(Context* context,
     } else if (balancerArg.compare(0, 15, "tombstoneRatio:") == 0) {
         string ratio = balancerArg.substr(15);
         balancer = new TombstoneRatioBalancer(this, atof(ratio.c_str()));
+    } else if (balancerArg.compare(0, 9, "adaptive:") == 0) {
+        string ratio = balancerArg.substr(9);
+        balancer = new AdaptiveBalancer(this, atof(ratio.c_str()));
     } else {
         DIE("Unknown balancer specified: \"%s\"", balancerArg.c_str());
     }
@@ -159,7 +174,9 @@ LogCleaner::stop()
 
     threadsShouldExit = false;
 
-    /// XXX- should set threadCnt to 0 so we can clean on disk again!
+    // Restarted threads are numbered from 0 again, so that one of them may
+    // clean on disk.
+    threadCnt = 0;
 }
 
 /**
@@ -180,14 +197,13 @@ LogCleaner::getMetrics(ProtoBuf::LogMetrics_CleanerMetrics& m)
     inMemoryMetrics.serialize(*m.mutable_in_memory_metrics());
     onDiskMetrics.serialize(*m.mutable_on_disk_metrics());
     threadMetrics.serialize(*m.mutable_thread_metrics());
+    balancer->getMetrics(m);
 }
 
 /******************************************************************************
  * PRIVATE METHODS
  ******************************************************************************/
 
-static volatile uint32_t threadCnt;
-
 /**
  * Static entry point for the cleaner thread. This is invoked via the
  * std::thread() constructor. This thread performs continuous cleaning on an
@@ -267,8 +283,14 @@ LogCleaner::doWork(CleanerThreadState* state)
           }
 
         case Balancer::SLEEP:
-            goToSleep = true;
+          {
+            // Nothing to start on our own, but another thread's disk
+            // cleaning pass may have relocation work to share.
+            CycleCounter<uint64_t> __(&state->diskCleaningTicks);
+            if (!helpRelocateLiveEntries())
+                goToSleep = true;
             break;
+          }
         }
 
         threadMetrics.noteThreadStop();
@@ -333,39 +355,62 @@ LogCleaner::doMemoryCleaning()
         segment->getSegletsAllocated() * segletSize;
     uint32_t liveScannedEntryTotalLengths[TOTAL_LOG_ENTRY_TYPES] = { 0 };
 
+    // Entries are relocated in batches. The metadata for all the entries in
+    // a batch is prefetched before any of them is relocated: entries are in
+    // log order, which is random with respect to the hash table, so this
+    // overlaps cache misses that would otherwise be taken one at a time.
+    Buffer buffers[COMPACTION_BATCH_ENTRIES];
+    LogEntryType types[COMPACTION_BATCH_ENTRIES];
+    uint32_t offsets[COMPACTION_BATCH_ENTRIES];
+
     // Take two passes, writing out the tombstones first. This makes the
     // dead tombstone scanner in CleanableSegmentManager more efficient
     // since it will only need to scan the front of the segment.
     for (int tombstonePass = 1; tombstonePass >= 0 && !empty; tombstonePass--) {
-        for (SegmentIterator it(*segment); !it.isDone(); it.next()) {
-            LogEntryType type = it.getType();
-
-            if (tombstonePass && type != LOG_ENTRY_TYPE_OBJTOMB)
-                continue;
-            if (!tombstonePass && type == LOG_ENTRY_TYPE_OBJTOMB)
-                continue;
-
-            Buffer buffer;
-            it.appendToBuffer(buffer);
-            Log::Reference reference = segment->getReference(it.getOffset());
-            uint32_t bytesAppended = 0;
-            RelocStatus s = relocateEntry(type,
-                                          buffer,
-                                          reference,
-                                          survivor,
-                                          &localMetrics,
-                                          &bytesAppended);
-            if (expect_false(s == RELOCATION_FAILED))
-                throw FatalError(HERE, "Entry didn't fit into survivor!");
+        SegmentIterator it(*segment);
+        while (!it.isDone()) {
+            int batchSize = 0;
+            for (; !it.isDone() && batchSize < COMPACTION_BATCH_ENTRIES;
+                    it.next()) {
+                LogEntryType type = it.getType();
+
+                if (tombstonePass && type != LOG_ENTRY_TYPE_OBJTOMB)
+                    continue;
+                if (!tombstonePass && type == LOG_ENTRY_TYPE_OBJTOMB)
+                    continue;
+
+                Buffer& buffer = buffers[batchSize];
+                buffer.reset();
+                it.appendToBuffer(buffer);
+                entryHandlers.prefetchEntry(type, buffer);
+                types[batchSize] = type;
+                offsets[batchSize] = it.getOffset();
+                batchSize++;
+            }
 
-            localMetrics.totalEntriesScanned[type]++;
-            localMetrics.totalScannedEntryLengths[type] +=
-                buffer.size();
-            if (expect_true(s == RELOCATED)) {
-                localMetrics.totalLiveEntriesScanned[type]++;
-                localMetrics.totalLiveScannedEntryLengths[type] +=
+            for (int i = 0; i < batchSize; i++) {
+                LogEntryType type = types[i];
+                Buffer& buffer = buffers[i];
+                Log::Reference reference = segment->getReference(offsets[i]);
+                uint32_t bytesAppended = 0;
+                RelocStatus s = relocateEntry(type,
+                                              buffer,
+                                              reference,
+                                              survivor,
+                                              &localMetrics,
+                                              &bytesAppended);
+                if (expect_false(s == RELOCATION_FAILED))
+                    throw FatalError(HERE, "Entry didn't fit into survivor!");
+
+                localMetrics.totalEntriesScanned[type]++;
+                localMetrics.totalScannedEntryLengths[type] +=
                     buffer.size();
-                liveScannedEntryTotalLengths[type] += bytesAppended;
+                if (expect_true(s == RELOCATED)) {
+                    localMetrics.totalLiveEntriesScanned[type]++;
+                    localMetrics.totalLiveScannedEntryLengths[type] +=
+                        buffer.size();
+                    liveScannedEntryTotalLengths[type] += bytesAppended;
+                }
             }
         }
     }
@@ -605,6 +650,12 @@ LogCleaner::getSortedEntries(LogSegmentVector& segmentsToClean,
  * survivor segments in order and alert their owning module (MasterService,
  * usually), that they've been relocated.
  *
+ * If there are enough entries and more than one cleaner thread, the work is
+ * offered to the other cleaner threads while this one relocates: see
+ * RelocationJob. This method returns only once all of the entries have been
+ * relocated and every survivor (including those written by helpers) has been
+ * synced.
+ *
  * \param entries
  *      Vector the entries from segments being cleaned that may need to be
  *      relocated.
@@ -626,85 +677,40 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
 {
     CycleCounter<uint64_t> _(&localMetrics->relocateLiveEntriesTicks);
 
-    LogSegment* survivor = NULL;
-    uint64_t totalEntryBytesAppended = 0;
-    uint32_t currentLiveEntries[TOTAL_LOG_ENTRY_TYPES] = { 0 };
-    uint32_t currentLiveEntryLengths[TOTAL_LOG_ENTRY_TYPES] = { 0 };
-
-    foreach (Entry& entry, entries) {
-        Buffer buffer;
-        LogEntryType type = entry.reference.getEntry(
-            &segmentManager.getAllocator(), &buffer);
-        Log::Reference reference = entry.reference;
-        uint32_t bytesAppended = 0;
-        RelocStatus s = relocateEntry(type,
-                                      buffer,
-                                      reference,
-                                      survivor,
-                                      localMetrics,
-                                      &bytesAppended);
-
-        if (expect_false(s == RELOCATION_FAILED)) {
-            if (survivor != NULL) {
-                for (size_t i = 0; i < TOTAL_LOG_ENTRY_TYPES; i++) {
-                    survivor->trackNewEntries(static_cast<LogEntryType>(i),
-                                              currentLiveEntries[i],
-                                              currentLiveEntryLengths[i]);
-                }
-                memset(currentLiveEntries, 0, sizeof(currentLiveEntries));
-                memset(currentLiveEntryLengths, 0,
-                       sizeof(currentLiveEntryLengths));
-                closeSurvivor(survivor);
-            }
+    RelocationJob job(entries);
+    bool shared = (numThreads > 1 &&
+                   entries.size() > 2 * RELOCATION_CHUNK_ENTRIES);
+    if (shared) {
+        SpinLock::Guard guard(relocationJobLock);
+        relocationJob = &job;
+    }
 
-            // Allocate a survivor segment to write into. This call may block if
-            // one is not available right now.
-            CycleCounter<uint64_t> waitTicks(
-                &localMetrics->waitForFreeSurvivorsTicks);
-            survivor = segmentManager.allocSideSegment(
-                SegmentManager::FOR_CLEANING | SegmentManager::MUST_NOT_FAIL,
-                NULL);
-            assert(survivor != NULL);
-            waitTicks.stop();
-            outSurvivors.push_back(survivor);
-
-            s = relocateEntry(type,
-                              buffer,
-                              reference,
-                              survivor,
-                              localMetrics,
-                              &bytesAppended);
-            if (s == RELOCATION_FAILED)
-                throw FatalError(HERE, "Entry didn't fit into empty survivor!");
-        }
+    uint64_t totalEntryBytesAppended = relocateEntryChunks(job, outSurvivors,
+                                                           localMetrics);
 
-        localMetrics->totalEntriesScanned[type]++;
-        localMetrics->totalScannedEntryLengths[type] += buffer.size();
-        if (expect_true(s == RELOCATED)) {
-            localMetrics->totalLiveEntriesScanned[type]++;
-            localMetrics->totalLiveScannedEntryLengths[type] +=
-                buffer.size();
-            currentLiveEntries[type]++;
-            currentLiveEntryLengths[type] += bytesAppended;
+    if (shared) {
+        {
+            SpinLock::Guard guard(relocationJobLock);
+            relocationJob = NULL;
         }
 
-        totalEntryBytesAppended += bytesAppended;
-    }
+        // No new helpers can join now; wait for the current ones to finish
+        // their chunks.
+        while (job.activeHelpers.load() > 0)
+            std::this_thread::yield();
 
-    if (survivor != NULL) {
-        for (size_t i = 0; i < TOTAL_LOG_ENTRY_TYPES; i++) {
-            survivor->trackNewEntries(static_cast<LogEntryType>(i),
-                                      currentLiveEntries[i],
-                                      currentLiveEntryLengths[i]);
-        }
-        closeSurvivor(survivor);
+        SpinLock::Guard guard(job.lock);
+        outSurvivors.insert(outSurvivors.end(), job.survivors.begin(),
+                            job.survivors.end());
+        totalEntryBytesAppended += job.entryBytesAppended;
+        localMetrics->merge(job.metrics);
     }
 
     // Ensure that the survivors have been synced to backups before proceeding.
     double survivorMb = static_cast<double>(totalEntryBytesAppended);
     survivorMb /= 1e06;
     uint64_t start = Cycles::rdtsc();
-    foreach (survivor, outSurvivors) {
+    foreach (LogSegment* survivor, outSurvivors) {
         CycleCounter<uint64_t> __(&localMetrics->survivorSyncTicks);
         survivor->replicatedSegment->sync(survivor->getAppendedLength());
     }
@@ -715,6 +721,246 @@ LogCleaner::relocateLiveEntries(EntryVector& entries,
     return totalEntryBytesAppended;
 }
 
+/**
+ * Claim chunks of a RelocationJob's entries until none are left, writing
+ * the live ones out to survivor segments. The survivors are closed, but not
+ * synced. This is the common work loop of relocateLiveEntries() (the
+ * thread that owns the job) and helpRelocateLiveEntries() (other threads).
+ *
+ * If #coldDataAge is set, entries at least that many seconds old are written
+ * to a separate stream of survivors from younger entries, so that no survivor
+ * mixes the two: see #coldDataAge. Cold survivors go to flash if
+ * #coldDataOnFlash is set and flash isn't full. Likewise, if #largeEntryBytes
+ * is set, entries at least that long get survivors of their own.
+ *
+ * \param job
+ *      The entries to relocate and the index of the next unclaimed one.
+ * \param outSurvivors
+ *      The new survivor segments created by this thread are returned here.
+ * \param[out] localMetrics
+ *      Contains various performance counters that are incremented here.
+ * \return
+ *      The number of live bytes this thread appended to survivors, including
+ *      segment metadata overhead.
+ */
+uint64_t
+LogCleaner::relocateEntryChunks(RelocationJob& job,
+                            LogSegmentVector& outSurvivors,
+                            LogCleanerMetrics::OnDisk<uint64_t>* localMetrics)
+{
+    SurvivorStream streams[2][2];
+    uint64_t totalEntryBytesAppended = 0;
+    size_t numEntries = job.entries.size();
+
+    // Entries with timestamps before this are cold. 0 makes everything hot.
+    uint32_t coldCutoff = 0;
+    uint32_t now = WallTime::secondsTimestamp();
+    if (coldDataAge != 0 && now > coldDataAge)
+        coldCutoff = now - coldDataAge;
+
+    while (true) {
+        size_t first = job.nextEntry.fetch_add(RELOCATION_CHUNK_ENTRIES);
+        if (first >= numEntries)
+            break;
+        size_t last = std::min(numEntries,
+                               first + RELOCATION_CHUNK_ENTRIES);
+
+        for (size_t i = first; i < last; i++) {
+            Entry& entry = job.entries[i];
+            Buffer buffer;
+            LogEntryType type = entry.reference.getEntry(
+                &segmentManager.getAllocator(), &buffer);
+            bool cold = entry.timestamp < coldCutoff;
+            if (cold && coldDataOnFlash) {
+                cold = (type == LOG_ENTRY_TYPE_OBJ ||
+                        type == LOG_ENTRY_TYPE_OBJTOMB);
+            }
+            bool large = largeEntryBytes != 0 &&
+                    buffer.size() >= largeEntryBytes;
+            SurvivorStream& stream = streams[large][cold];
+            Log::Reference reference = entry.reference;
+            uint32_t bytesAppended = 0;
+            RelocStatus s = relocateEntry(type,
+                                          buffer,
+                                          reference,
+                                          stream.survivor,
+                                          localMetrics,
+                                          &bytesAppended);
+
+            if (expect_false(s == RELOCATION_FAILED)) {
+                closeSurvivorStream(stream);
+
+                // Allocate a survivor segment to write into. This call may
+                // block if one is not available right now.
+                CycleCounter<uint64_t> waitTicks(
+                    &localMetrics->waitForFreeSurvivorsTicks);
+                if (cold && coldDataOnFlash) {
+                    stream.survivor = segmentManager.allocSideSegment(
+                        SegmentManager::FOR_CLEANING |
+                        SegmentManager::ON_FLASH,
+                        NULL);
+                }
+                if (stream.survivor == NULL) {
+                    stream.survivor = segmentManager.allocSideSegment(
+                        SegmentManager::FOR_CLEANING |
+                        SegmentManager::MUST_NOT_FAIL,
+                        NULL);
+                }
+                assert(stream.survivor != NULL);
+                waitTicks.stop();
+                outSurvivors.push_back(stream.survivor);
+
+                s = relocateEntry(type,
+                                  buffer,
+                                  reference,
+                                  stream.survivor,
+                                  localMetrics,
+                                  &bytesAppended);
+                if (s == RELOCATION_FAILED) {
+                    throw FatalError(HERE,
+                                     "Entry didn't fit into empty survivor!");
+                }
+            }
+
+            localMetrics->totalEntriesScanned[type]++;
+            localMetrics->totalScannedEntryLengths[type] += buffer.size();
+            if (expect_true(s == RELOCATED)) {
+                localMetrics->totalLiveEntriesScanned[type]++;
+                localMetrics->totalLiveScannedEntryLengths[type] +=
+                    buffer.size();
+                stream.liveEntries[type]++;
+                stream.liveEntryLengths[type] += bytesAppended;
+                if (copyOnBackups)
+                    recordSourceRange(stream, reference, bytesAppended);
+            }
+
+            totalEntryBytesAppended += bytesAppended;
+        }
+    }
+
+    closeSurvivorStream(streams[0][0]);
+    closeSurvivorStream(streams[0][1]);
+    closeSurvivorStream(streams[1][0]);
+    closeSurvivorStream(streams[1][1]);
+
+    return totalEntryBytesAppended;
+}
+
+/**
+ * Close the survivor segment a SurvivorStream is currently writing to, if
+ * any, after recording the entries written to it since it was opened. The
+ * stream is left empty, ready for its next survivor.
+ *
+ * \param stream
+ *      The stream whose survivor is closed.
+ */
+void
+LogCleaner::closeSurvivorStream(SurvivorStream& stream)
+{
+    if (stream.survivor == NULL)
+        return;
+
+    for (size_t t = 0; t < TOTAL_LOG_ENTRY_TYPES; t++) {
+        stream.survivor->trackNewEntries(static_cast<LogEntryType>(t),
+                                         stream.liveEntries[t],
+                                         stream.liveEntryLengths[t]);
+    }
+    memset(stream.liveEntries, 0, sizeof(stream.liveEntries));
+    memset(stream.liveEntryLengths, 0, sizeof(stream.liveEntryLengths));
+    if (!stream.sourceRanges.empty()) {
+        stream.survivor->replicatedSegment->setSourceRanges(
+            stream.sourceRanges);
+        stream.sourceRanges.clear();
+    }
+    closeSurvivor(stream.survivor);
+    stream.survivor = NULL;
+}
+
+/**
+ * Note that the entry just appended to a stream's survivor came from the
+ * given segment, if its bytes there are identical, so that backups can copy
+ * it out of their replicas of that segment; see #copyOnBackups. The sources
+ * of the bytes aren't freed until the survivors have been synced, as
+ * ReplicatedSegment::setSourceRanges() requires.
+ *
+ * \param stream
+ *      Stream whose survivor the entry was just appended to.
+ * \param reference
+ *      Reference to the original entry.
+ * \param length
+ *      Number of bytes appended to the survivor for the entry, including
+ *      its header.
+ */
+void
+LogCleaner::recordSourceRange(SurvivorStream& stream,
+                              Log::Reference reference,
+                              uint32_t length)
+{
+    LogSegment* source = segmentManager.getAllocator().getOwnerSegment(
+        reinterpret_cast<const void*>(reference.toInteger()));
+    if (source == NULL || source->replicatedSegment == NULL)
+        return;
+    uint32_t sourceOffset = source->getOffset(reference);
+    uint32_t offset = stream.survivor->getAppendedLength() - length;
+    if (sourceOffset + length > source->getAppendedLength())
+        return;
+
+    // Handlers may have changed the entry while relocating it, so only
+    // bytes that are really the same can be copied on the backups.
+    uint32_t compared = 0;
+    while (compared < length) {
+        const void* original;
+        const void* copy;
+        uint32_t bytes = std::min(length - compared,
+            source->peek(sourceOffset + compared, &original));
+        bytes = std::min(bytes,
+            stream.survivor->peek(offset + compared, &copy));
+        if (memcmp(original, copy, bytes) != 0)
+            return;
+        compared += bytes;
+    }
+    stream.sourceRanges.emplace_back(offset, length,
+                                     source->replicatedSegment, sourceOffset);
+}
+
+/**
+ * If another cleaner thread is running a disk cleaning pass whose relocation
+ * work can be shared (see RelocationJob), help it by relocating chunks of
+ * its entries until there are none left.
+ *
+ * \return
+ *      True if there was a job to help with, false if there was not (in
+ *      which case nothing was done).
+ */
+bool
+LogCleaner::helpRelocateLiveEntries()
+{
+    RelocationJob* job;
+    {
+        SpinLock::Guard guard(relocationJobLock);
+        job = relocationJob;
+        if (job == NULL)
+            return false;
+        job->activeHelpers++;
+    }
+
+    LogSegmentVector survivors;
+    LogCleanerMetrics::OnDisk<uint64_t> localMetrics;
+    uint64_t bytesAppended = relocateEntryChunks(*job, survivors,
+                                                 &localMetrics);
+    {
+        SpinLock::Guard guard(job->lock);
+        job->survivors.insert(job->survivors.end(), survivors.begin(),
+                              survivors.end());
+        job->entryBytesAppended += bytesAppended;
+        job->metrics.merge(localMetrics);
+    }
+
+    // The owner may destroy the job as soon as this drops to zero.
+    job->activeHelpers--;
+    return true;
+}
+
 /**
  * Close a survivor segment we've written data to as part of a disk cleaning
  * pass and tell the replicaManager to begin flushing it asynchronously to
@@ -757,16 +1003,32 @@ LogCleaner::Balancer::isMemoryLow(CleanerThreadState* thread)
     if (T < baseThreshold)
         return false;
 
-    // Employ multiple threads only when we fail to keep up with fewer of them.
-    if (thread->threadNumber > 0) {
-        int thresh = baseThreshold + 2 * static_cast<int>(thread->threadNumber);
-        if (T < std::min(99, thresh))
-            return false;
-    }
+    if (thread->threadNumber > 0 && !isThreadNeeded(thread, T, baseThreshold))
+        return false;
 
     return true;
 }
 
+/**
+ * Decide whether a cleaner thread other than thread 0 should help out, given
+ * that memory is low.
+ *
+ * \param thread
+ *      The thread asking.
+ * \param memoryUtilization
+ *      Percentage of memory in use.
+ * \param baseThreshold
+ *      Memory utilization at which cleaning starts.
+ */
+bool
+LogCleaner::Balancer::isThreadNeeded(CleanerThreadState* thread,
+                                     int memoryUtilization, int baseThreshold)
+{
+    // Employ multiple threads only when we fail to keep up with fewer of them.
+    int thresh = baseThreshold + 2 * static_cast<int>(thread->threadNumber);
+    return memoryUtilization >= std::min(99, thresh);
+}
+
 /**
  * This method is called by the memory compactor if it failed to free any memory
  * after processing a segment. This is a pretty good signal that it might be
@@ -781,6 +1043,8 @@ LogCleaner::Balancer::compactionFailed()
 LogCleaner::Balancer::CleaningTask
 LogCleaner::Balancer::requestTask(CleanerThreadState* thread)
 {
+    tune(thread);
+
     if (isDiskCleaningNeeded(thread))
         return CLEAN_DISK;
 
@@ -853,6 +1117,147 @@ LogCleaner::TombstoneRatioBalancer::isDiskCleaningNeeded(
     return false;
 }
 
+LogCleaner::AdaptiveBalancer::AdaptiveBalancer(LogCleaner* cleaner,
+                                               double ratio)
+    : TombstoneRatioBalancer(cleaner, ratio)
+    , targetThreads(1)
+    , writeRate(0)
+    , threadCleaningRate(0)
+    , lastTuneTime(0)
+    , lastHeadSegments(0)
+    , lastBusyTicks(0)
+    , lastCompactionBytesFreed(0)
+    , lastCompactionBytesAppended(0)
+    , lastDiskBytesFreed(0)
+    , lastDiskBytesAppended(0)
+{
+    LOG(NOTICE, "Tuning cleaner threads and tombstone ratio adaptively");
+}
+
+LogCleaner::AdaptiveBalancer::~AdaptiveBalancer()
+{
+}
+
+void
+LogCleaner::AdaptiveBalancer::getMetrics(ProtoBuf::LogMetrics_CleanerMetrics& m)
+{
+    m.set_target_threads(targetThreads);
+    m.set_tombstone_ratio(ratio);
+    m.set_write_rate(static_cast<uint64_t>(writeRate));
+}
+
+bool
+LogCleaner::AdaptiveBalancer::isThreadNeeded(CleanerThreadState* thread,
+                                             int memoryUtilization,
+                                             int baseThreshold)
+{
+    return static_cast<int>(thread->threadNumber) < targetThreads;
+}
+
+/**
+ * Re-evaluate, at most every TUNE_INTERVAL_USEC, how many cleaner threads
+ * should work and how eagerly to clean on disk, based on what happened since
+ * the last evaluation. Only thread 0 does this; the others just read
+ * #targetThreads.
+ */
+void
+LogCleaner::AdaptiveBalancer::tune(CleanerThreadState* thread)
+{
+    if (thread->threadNumber != 0)
+        return;
+    uint64_t now = Cycles::rdtsc();
+    if (lastTuneTime != 0 &&
+            now - lastTuneTime < Cycles::fromMicroseconds(TUNE_INTERVAL_USEC))
+        return;
+
+    uint64_t headSegments = cleaner->segmentManager.getHeadSegmentsAllocated();
+    uint64_t busyTicks = cleaner->doWorkTicks - cleaner->doWorkSleepTicks;
+    uint64_t compactionFreed = cleaner->inMemoryMetrics.totalBytesFreed;
+    uint64_t compactionAppended =
+            cleaner->inMemoryMetrics.totalBytesAppendedToSurvivors;
+    uint64_t diskFreed = cleaner->onDiskMetrics.totalMemoryBytesFreed;
+    uint64_t diskAppended =
+            cleaner->onDiskMetrics.totalBytesAppendedToSurvivors;
+
+    if (lastTuneTime != 0) {
+        double seconds = Cycles::toSeconds(now - lastTuneTime);
+        writeRate = static_cast<double>(headSegments - lastHeadSegments) *
+                cleaner->segmentSize / seconds;
+
+        uint64_t freed = (compactionFreed - lastCompactionBytesFreed) +
+                (diskFreed - lastDiskBytesFreed);
+        double busySeconds = Cycles::toSeconds(busyTicks - lastBusyTicks);
+        if (freed > 0 && busySeconds > 0) {
+            double rate = static_cast<double>(freed) / busySeconds;
+            threadCleaningRate = (threadCleaningRate == 0) ? rate :
+                    (3 * threadCleaningRate + rate) / 4;
+        }
+
+        // Enough threads to free memory as fast as it is written, and one
+        // more each time we find ourselves falling further behind. While
+        // memory isn't low, one thread (which sleeps) will do.
+        const int T = cleaner->segmentManager.getMemoryUtilization();
+        const int L = cleaner->cleanableSegments.getLiveObjectUtilization();
+        int baseThreshold = std::max(90, (100 + L) / 2);
+        int target = targetThreads;
+        if (T < baseThreshold) {
+            target = 1;
+        } else {
+            if (threadCleaningRate > 0) {
+                target = static_cast<int>(
+                        std::ceil(writeRate / threadCleaningRate));
+            }
+            if (T >= baseThreshold + 2)
+                target = std::max(target, targetThreads + 1);
+        }
+
+        // Cleaning shouldn't delay requests: use only the cores the workers
+        // leave idle, unless memory is about to run out.
+        if (T < CRITICAL_MEMORY_UTILIZATION &&
+                cleaner->context->workerManager != NULL) {
+            int idle = downCast<int>(
+                    cleaner->context->workerManager->getIdleCores());
+            target = std::min(target, idle);
+        }
+        targetThreads = std::max(1, std::min(cleaner->numThreads, target));
+
+        // Shift work between compaction and disk cleaning, whichever copies
+        // fewer bytes per byte freed: once compaction gets more expensive
+        // than the write cost threshold, clean on disk sooner (that is what
+        // frees the tombstones that make compaction expensive); while disk
+        // cleaning is the more expensive one, leave more to compaction.
+        uint64_t cFreed = compactionFreed - lastCompactionBytesFreed;
+        uint64_t cAppended = compactionAppended - lastCompactionBytesAppended;
+        uint64_t dFreed = diskFreed - lastDiskBytesFreed;
+        uint64_t dAppended = diskAppended - lastDiskBytesAppended;
+        if (cFreed + cAppended > 0 && !cleaner->disableInMemoryCleaning) {
+            double compactionCost = (cFreed == 0) ? 1e9 :
+                    static_cast<double>(cFreed + cAppended) /
+                    static_cast<double>(cFreed);
+            double diskCost = (dFreed == 0) ? 0 :
+                    static_cast<double>(dFreed + dAppended) /
+                    static_cast<double>(dFreed);
+            if (compactionCost > cleaner->writeCostThreshold) {
+                ratio -= RATIO_STEP;
+                if (ratio < MIN_RATIO)
+                    ratio = MIN_RATIO;
+            } else if (diskCost > compactionCost) {
+                ratio += RATIO_STEP;
+                if (ratio > MAX_RATIO)
+                    ratio = MAX_RATIO;
+            }
+        }
+    }
+
+    lastTuneTime = now;
+    lastHeadSegments = headSegments;
+    lastBusyTicks = busyTicks;
+    lastCompactionBytesFreed = compactionFreed;
+    lastCompactionBytesAppended = compactionAppended;
+    lastDiskBytesFreed = diskFreed;
+    lastDiskBytesAppended = diskAppended;
+}
+
 LogCleaner::FixedBalancer::FixedBalancer(LogCleaner* cleaner,
                                          uint32_t cleaningPercentage)
     : Balancer(cleaner)
@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_LOGCLEANER_H
 #define RAMCLOUD_LOGCLEANER_H
 
+#include <atomic>
 #include <thread>
 #include <vector>
 
@@ -79,6 +80,10 @@ class LogCleaner {
     /// that we can never consume more seglets in cleaning than we free.
     enum { MAX_CLEANABLE_MEMORY_UTILIZATION = 98 };
 
+    /// The minimum amount of memory utilization we will begin cleaning at using
+    /// the in-memory cleaner.
+    enum { MIN_MEMORY_UTILIZATION = 90 };
+
     /// The following class is used to keep the cleaner from running
     /// during certain other operations (e.g., at the tail end of log
     /// iteration we need to make sure that there is no data lurking in
@@ -111,10 +116,6 @@ class LogCleaner {
     /// seglets at the ends of survivor segments.
     enum { SURVIVOR_SEGMENTS_TO_RESERVE = 15 };
 
-    /// The minimum amount of memory utilization we will begin cleaning at using
-    /// the in-memory cleaner.
-    enum { MIN_MEMORY_UTILIZATION = 90 };
-
     /// The minimum amount of backup disk utilization we will begin cleaning at
     /// using the disk cleaner. Note that the disk cleaner may also run if the
     /// in-memory cleaner is not working efficiently enough to keep up with the
@@ -162,6 +163,94 @@ class LogCleaner {
         }
     };
 
+    /// Number of entries a cleaner thread claims at a time when the live
+    /// entries of a disk cleaning pass are relocated in parallel. See
+    /// RelocationJob.
+    enum { RELOCATION_CHUNK_ENTRIES = 1024 };
+
+    /// Number of entries whose metadata the in-memory cleaner prefetches
+    /// (see LogEntryHandlers::prefetchEntry()) before relocating any of them.
+    enum { COMPACTION_BATCH_ENTRIES = 16 };
+
+    /**
+     * Shared state for relocating the sorted live entries of one disk
+     * cleaning pass with several cleaner threads. The thread running the
+     * pass publishes this in #relocationJob; idle cleaner threads then steal
+     * chunks of RELOCATION_CHUNK_ENTRIES consecutive entries from it (see
+     * helpRelocateLiveEntries()). Because the chunks are consecutive runs of
+     * the timestamp-sorted entries, every survivor segment still holds
+     * entries of similar age.
+     */
+    class RelocationJob {
+      public:
+        explicit RelocationJob(EntryVector& entries)
+            : entries(entries)
+            , nextEntry(0)
+            , activeHelpers(0)
+            , lock("LogCleaner::RelocationJob::lock")
+            , survivors()
+            , entryBytesAppended(0)
+            , metrics()
+        {
+        }
+
+        /// The entries to relocate, sorted by timestamp.
+        EntryVector& entries;
+
+        /// Index in #entries of the first entry not yet claimed.
+        std::atomic<size_t> nextEntry;
+
+        /// Number of threads other than the owner working on this job. The
+        /// owner may not destroy the job until this drops to zero.
+        std::atomic<int> activeHelpers;
+
+        /// Protects the remaining fields, which helpers add to when done.
+        SpinLock lock;
+
+        /// Survivor segments written by helpers.
+        LogSegmentVector survivors;
+
+        /// Bytes appended to #survivors by helpers.
+        uint64_t entryBytesAppended;
+
+        /// Performance counters accumulated by helpers.
+        LogCleanerMetrics::OnDisk<uint64_t> metrics;
+
+        DISALLOW_COPY_AND_ASSIGN(RelocationJob);
+    };
+
+    /**
+     * A cleaner thread's open survivor segment for one temperature and size
+     * class of data (see #coldDataAge and #largeEntryBytes), along with the
+     * live entries appended to it so far, which are added to the survivor's
+     * statistics when it is closed.
+     */
+    class SurvivorStream {
+      public:
+        SurvivorStream()
+            : survivor(NULL)
+            , liveEntries()
+            , liveEntryLengths()
+            , sourceRanges()
+        {
+        }
+
+        /// Survivor currently being written to, or NULL if none is open.
+        LogSegment* survivor;
+
+        /// Number of live entries of each type appended to #survivor.
+        uint32_t liveEntries[TOTAL_LOG_ENTRY_TYPES];
+
+        /// Bytes of live entries of each type appended to #survivor.
+        uint32_t liveEntryLengths[TOTAL_LOG_ENTRY_TYPES];
+
+        /// Entries appended to #survivor that are exact copies of their
+        /// originals; see #copyOnBackups.
+        std::vector<ReplicatedSegment::SourceRange> sourceRanges;
+
+        DISALLOW_COPY_AND_ASSIGN(SurvivorStream);
+    };
+
     class CleanerThreadState {
       public:
         CleanerThreadState()
@@ -188,9 +277,13 @@ class LogCleaner {
         virtual ~Balancer() { }
         CleaningTask requestTask(CleanerThreadState* thread);
         void compactionFailed();
+        virtual void getMetrics(ProtoBuf::LogMetrics_CleanerMetrics& m) { }
 
       PROTECTED:
         bool isMemoryLow(CleanerThreadState* thread);
+        virtual bool isThreadNeeded(CleanerThreadState* thread,
+                                    int memoryUtilization, int baseThreshold);
+        virtual void tune(CleanerThreadState* thread) { }
         virtual bool isDiskCleaningNeeded(CleanerThreadState* thread) = 0;
         LogCleaner* cleaner;
         std::atomic<uint64_t> compactionFailures;
@@ -204,11 +297,65 @@ class LogCleaner {
         TombstoneRatioBalancer(LogCleaner* cleaner, double ratio);
         ~TombstoneRatioBalancer();
 
-      PRIVATE:
+      PROTECTED:
         bool isDiskCleaningNeeded(CleanerThreadState* thread);
         double ratio;
     };
 
+    /**
+     * A TombstoneRatioBalancer that tunes itself: it decides how many cleaner
+     * threads may work by comparing the rate at which the log is written with
+     * the rate at which one thread frees memory, leaves cores to busy worker
+     * threads unless memory is nearly exhausted, and moves its tombstone
+     * ratio (and thus the share of disk cleaning) according to the write
+     * costs of compaction and of disk cleaning.
+     */
+    class AdaptiveBalancer : public TombstoneRatioBalancer {
+      public:
+        AdaptiveBalancer(LogCleaner* cleaner, double ratio);
+        ~AdaptiveBalancer();
+        void getMetrics(ProtoBuf::LogMetrics_CleanerMetrics& m);
+
+      PRIVATE:
+        bool isThreadNeeded(CleanerThreadState* thread,
+                            int memoryUtilization, int baseThreshold);
+        void tune(CleanerThreadState* thread);
+
+        /// How often the controller re-evaluates its settings.
+        static const uint32_t TUNE_INTERVAL_USEC = 100000;
+
+        /// Memory utilization at which cleaner threads may take cores
+        /// from busy worker threads.
+        static const int CRITICAL_MEMORY_UTILIZATION = 98;
+
+        /// Bounds and step size for the adjustments to #ratio.
+        static CONSTEXPR_VAR double MIN_RATIO = 0.1;
+        static CONSTEXPR_VAR double MAX_RATIO = 0.9;
+        static CONSTEXPR_VAR double RATIO_STEP = 0.05;
+
+        /// Number of cleaner threads (counting thread 0, which always may
+        /// run) that currently may work.
+        std::atomic<int> targetThreads;
+
+        /// Most recently observed rate at which the log head is written,
+        /// in bytes per second.
+        double writeRate;
+
+        /// Bytes of memory one cleaner thread frees per second it spends
+        /// cleaning (a moving average); 0 until first measured.
+        double threadCleaningRate;
+
+        /// Cycles::rdtsc() time of the last tune, and the counters it saw.
+        /// Only cleaner thread 0 tunes, so these need no synchronization.
+        uint64_t lastTuneTime;
+        uint64_t lastHeadSegments;
+        uint64_t lastBusyTicks;
+        uint64_t lastCompactionBytesFreed;
+        uint64_t lastCompactionBytesAppended;
+        uint64_t lastDiskBytesFreed;
+        uint64_t lastDiskBytesAppended;
+    };
+
     class FixedBalancer: public Balancer {
       public:
         FixedBalancer(LogCleaner* cleaner, uint32_t cleaningPercentage);
@@ -239,6 +386,13 @@ class LogCleaner {
     uint64_t relocateLiveEntries(EntryVector& entries,
                             LogSegmentVector& outSurvivors,
                             LogCleanerMetrics::OnDisk<uint64_t>* localMetrics);
+    uint64_t relocateEntryChunks(RelocationJob& job,
+                            LogSegmentVector& outSurvivors,
+                            LogCleanerMetrics::OnDisk<uint64_t>* localMetrics);
+    bool helpRelocateLiveEntries();
+    void closeSurvivorStream(SurvivorStream& stream);
+    void recordSourceRange(SurvivorStream& stream, Log::Reference reference,
+                           uint32_t length);
     void closeSurvivor(LogSegment* survivor);
     void waitForAvailableSurvivors(size_t count, uint64_t& outTicks);
 
@@ -369,6 +523,41 @@ class LogCleaner {
     /// keep up with higher write rates and memory utilizations.
     const int numThreads;
 
+    /// If nonzero, live entries at least this many seconds old (according
+    /// to their timestamps) are considered cold and are relocated into
+    /// different survivor segments than younger, hot entries. Keeping cold
+    /// data apart means those survivors stay nearly full, while the hot ones
+    /// empty out quickly and become cheap to clean, which is the bimodal
+    /// utilization the cost-benefit policy does best with. 0 disables the
+    /// segregation (timestamp sorting still groups entries by age).
+    uint32_t coldDataAge;
+
+    /// If nonzero, live entries at least this many bytes long are relocated
+    /// into different survivor segments than smaller ones. Tables of large
+    /// blobs and tables of small objects then don't share segments, so
+    /// each kind of segment fills with entries of similar size: a large
+    /// entry that doesn't fit no longer closes a survivor that small ones
+    /// could have filled, and segments of small objects empty out (and are
+    /// chosen for cleaning) at their own rate. 0 disables the segregation.
+    uint32_t largeEntryBytes;
+
+    /// If true, the survivor entries that are byte for byte copies of the
+    /// entries being cleaned are passed on to the survivor's
+    /// ReplicatedSegment, so that backups holding replicas of the segments
+    /// being cleaned copy them locally instead of receiving them again
+    /// (see ReplicatedSegment::setSourceRanges()). The cleaner's writes to
+    /// backups then carry little more than the entries that did change.
+    bool copyOnBackups;
+
+    /// If true, the survivors of cold objects and tombstones are allocated
+    /// on local flash (see SegletAllocator::FLASH) as long as there is room,
+    /// which takes them out of memory entirely. Only objects and tombstones
+    /// count as cold then: most other entries have no timestamps of their
+    /// own, so they would all look cold, and they are used by transactions
+    /// and RPC bookkeeping, which shouldn't wait for flash. Set when
+    /// #coldDataAge is and the master has a flash tier.
+    bool coldDataOnFlash;
+
     /// Size of each seglet in bytes. Used to calculate the best segment for in-
     /// memory cleaning.
     uint32_t segletSize;
@@ -418,6 +607,14 @@ class LogCleaner {
     /// Metrics kept for measuring how many threads the cleaner is using.
     LogCleanerMetrics::Threads threadMetrics;
 
+    /// The relocation work of the disk cleaning pass in progress, if other
+    /// cleaner threads may help with it; NULL otherwise. See RelocationJob.
+    RelocationJob* relocationJob;
+
+    /// Protects #relocationJob, so that a helper can't start on a job just as
+    /// its owner finishes and destroys it.
+    SpinLock relocationJobLock;
+
     /// Set by halt() to indicate that the cleaning thread(s) should exit.
     bool threadsShouldExit;
 
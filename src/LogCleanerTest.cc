@@ -61,6 +61,12 @@ class TestEntryHandlers : public LogEntryHandlers {
             relocator.append(type, oldBuffer);
     }
 
+    void
+    prefetchEntry(LogEntryType type, Buffer& buffer)
+    {
+        RAMCLOUD_TEST_LOG("type %d", downCast<int>(type));
+    }
+
     uint32_t timestamp;
     bool attemptToRelocate;
 };
@@ -287,8 +293,35 @@ TEST_F(LogCleanerTest, doWork_notifyConditionVariable) {
     thread.join();
 }
 
-// There are currently no meaningful tests for doMemoryCleaning;
-// please write some!
+static bool
+compactionFilter(string s)
+{
+    return s == "prefetchEntry" || s == "relocate";
+}
+
+TEST_F(LogCleanerTest, doMemoryCleaning_prefetchBatch) {
+    cleaner.disableInMemoryCleaning = false;
+    LogSegment* segment = segmentManager.allocHeadSegment();
+    segmentManager.allocHeadSegment(); // roll over
+    getNewCandidates();
+    ASSERT_LT(0U, segment->getLiveBytes());
+
+    // The segment's four entries fit in one batch, so all of them are
+    // prefetched before the first is relocated.
+    TestLog::Enable _(compactionFilter);
+    cleaner.doMemoryCleaning();
+    EXPECT_EQ(
+        "prefetchEntry: type 1 | "
+        "prefetchEntry: type 4 | "
+        "prefetchEntry: type 6 | "
+        "prefetchEntry: type 5 | "
+        "relocate: type 1, size 24 | "
+        "relocate: type 4, size 12 | "
+        "relocate: type 6, size 24 | "
+        "relocate: type 5, size 12",
+        TestLog::get());
+    EXPECT_EQ(1U, cleaner.inMemoryMetrics.totalSegmentsCompacted);
+}
 
 TEST_F(LogCleanerTest, doDiskCleaning) {
     // Not entirely sure what to check here. doDiskCleaning() mostly just
@@ -320,6 +353,135 @@ TEST_F(LogCleanerTest, doDiskCleaning) {
         TestLog::get());
 }
 
+TEST_F(LogCleanerTest, helpRelocateLiveEntries) {
+    EXPECT_FALSE(cleaner.helpRelocateLiveEntries());
+
+    entryHandlers.attemptToRelocate = true;
+    LogSegmentVector segments;
+    segments.push_back(segmentManager.allocHeadSegment());
+    LogCleaner::EntryVector entries;
+    LogCleanerMetrics::OnDisk<uint64_t> metrics;
+    cleaner.getSortedEntries(segments, entries, &metrics);
+    ASSERT_EQ(4U, entries.size());
+
+    LogCleaner::RelocationJob job(entries);
+    cleaner.relocationJob = &job;
+    EXPECT_TRUE(cleaner.helpRelocateLiveEntries());
+    cleaner.relocationJob = NULL;
+
+    EXPECT_EQ(0, job.activeHelpers.load());
+    EXPECT_LE(entries.size(), job.nextEntry.load());
+    EXPECT_EQ(1U, job.survivors.size());
+    EXPECT_LT(0U, job.entryBytesAppended);
+    EXPECT_EQ(4U, job.metrics.totalLiveEntriesScanned[LOG_ENTRY_TYPE_SEGHEADER]
+        + job.metrics.totalLiveEntriesScanned[LOG_ENTRY_TYPE_LOGDIGEST]
+        + job.metrics.totalLiveEntriesScanned[LOG_ENTRY_TYPE_SAFEVERSION]
+        + job.metrics.totalLiveEntriesScanned[LOG_ENTRY_TYPE_TABLESTATS]);
+
+    // Nothing left to claim: a later helper does no work.
+    LogSegmentVector survivors;
+    EXPECT_EQ(0U, cleaner.relocateEntryChunks(job, survivors, &metrics));
+    EXPECT_EQ(0U, survivors.size());
+}
+
+TEST_F(LogCleanerTest, relocateEntryChunks_hotColdSegregation) {
+    entryHandlers.attemptToRelocate = true;
+    LogSegmentVector segments;
+    segments.push_back(segmentManager.allocHeadSegment());
+    LogCleaner::EntryVector entries;
+    LogCleanerMetrics::OnDisk<uint64_t> metrics;
+    cleaner.getSortedEntries(segments, entries, &metrics);
+    ASSERT_EQ(4U, entries.size());
+    entries[0].timestamp = entries[1].timestamp = 100;
+    entries[2].timestamp = entries[3].timestamp = 1000;
+    WallTime::mockWallTimeValue = 1010;
+
+    // Segregation disabled: everything goes to one survivor.
+    LogCleaner::RelocationJob job1(entries);
+    LogSegmentVector survivors;
+    cleaner.relocateEntryChunks(job1, survivors, &metrics);
+    EXPECT_EQ(1U, survivors.size());
+
+    // The two old entries are cold; the two new ones are hot.
+    cleaner.coldDataAge = 60;
+    LogCleaner::RelocationJob job2(entries);
+    survivors.clear();
+    cleaner.relocateEntryChunks(job2, survivors, &metrics);
+    EXPECT_EQ(2U, survivors.size());
+
+    WallTime::mockWallTimeValue = 0;
+}
+
+TEST_F(LogCleanerTest, relocateEntryChunks_largeEntrySegregation) {
+    entryHandlers.attemptToRelocate = true;
+    LogSegmentVector segments;
+    segments.push_back(segmentManager.allocHeadSegment());
+    LogCleaner::EntryVector entries;
+    LogCleanerMetrics::OnDisk<uint64_t> metrics;
+    cleaner.getSortedEntries(segments, entries, &metrics);
+    ASSERT_EQ(4U, entries.size());
+
+    // Only the longest entry counts as large.
+    uint32_t longest = 0;
+    uint32_t shortest = ~0U;
+    foreach (LogCleaner::Entry& entry, entries) {
+        Buffer buffer;
+        entry.reference.getEntry(&segmentManager.getAllocator(), &buffer);
+        longest = std::max(longest, buffer.size());
+        shortest = std::min(shortest, buffer.size());
+    }
+    ASSERT_LT(shortest, longest);
+    cleaner.largeEntryBytes = longest;
+    LogCleaner::RelocationJob job(entries);
+    LogSegmentVector survivors;
+    cleaner.relocateEntryChunks(job, survivors, &metrics);
+    EXPECT_EQ(2U, survivors.size());
+}
+
+TEST_F(LogCleanerTest, recordSourceRange) {
+    entryHandlers.attemptToRelocate = true;
+    LogSegmentVector segments;
+    segments.push_back(segmentManager.allocHeadSegment());
+    LogCleaner::EntryVector entries;
+    LogCleanerMetrics::OnDisk<uint64_t> metrics;
+    cleaner.getSortedEntries(segments, entries, &metrics);
+    ASSERT_LE(2U, entries.size());
+
+    LogCleaner::SurvivorStream stream;
+    stream.survivor = segmentManager.allocSideSegment(
+        SegmentManager::FOR_CLEANING, NULL);
+    ASSERT_TRUE(stream.survivor != NULL);
+    uint32_t firstOffset = stream.survivor->getAppendedLength();
+    for (int i = 0; i < 2; i++) {
+        Buffer buffer;
+        LogEntryType type = entries[i].reference.getEntry(
+            &segmentManager.getAllocator(), &buffer);
+        uint32_t bytesAppended;
+        EXPECT_EQ(LogCleaner::RELOCATED,
+                  cleaner.relocateEntry(type, buffer, entries[i].reference,
+                                        stream.survivor, &metrics,
+                                        &bytesAppended));
+        if (i == 1) {
+            // An entry that changed while it was relocated can't be copied.
+            stream.survivor->copyIn(
+                stream.survivor->getAppendedLength() - 1, "!", 1);
+        }
+        cleaner.recordSourceRange(stream, entries[i].reference,
+                                  bytesAppended);
+    }
+
+    ASSERT_EQ(1U, stream.sourceRanges.size());
+    ReplicatedSegment::SourceRange& range = stream.sourceRanges[0];
+    EXPECT_EQ(segments[0]->replicatedSegment, range.source);
+    EXPECT_EQ(segments[0]->getOffset(entries[0].reference),
+              range.sourceOffset);
+    EXPECT_EQ(firstOffset, range.offset);
+    // The range covers the entry's header as well as its contents.
+    Buffer original;
+    entries[0].reference.getEntry(&segmentManager.getAllocator(), &original);
+    EXPECT_LT(original.size(), range.length);
+}
+
 // The tests below were disabled a long time ago by Steve Rumble and
 // never got reworked to reflect his changes, so they are currently
 // broken.
@@ -623,6 +785,80 @@ TEST_F(LogCleanerTest, relocateEntry) {
 }
 #endif
 
+TEST_F(LogCleanerTest, Balancer_isThreadNeeded) {
+    LogCleaner::CleanerThreadState thread;
+    thread.threadNumber = 2;
+    EXPECT_FALSE(cleaner.balancer->isThreadNeeded(&thread, 93, 90));
+    EXPECT_TRUE(cleaner.balancer->isThreadNeeded(&thread, 94, 90));
+    EXPECT_TRUE(cleaner.balancer->isThreadNeeded(&thread, 99, 97));
+}
+
+TEST_F(LogCleanerTest, AdaptiveBalancer_tune) {
+    SegletAllocator allocator2(serverConfig());
+    SegmentManager segmentManager2(&context, serverConfig(), &serverId,
+                                   allocator2, replicaManager,
+                                   &masterTableMetadata);
+    serverConfig()->master.cleanerThreadCount = 3;
+    LogCleaner cleaner2(&context, serverConfig(),
+                        segmentManager2, replicaManager, entryHandlers);
+    cleaner2.disableInMemoryCleaning = false;
+    cleaner2.writeCostThreshold = 4;
+    LogCleaner::AdaptiveBalancer balancer(&cleaner2, 0.4);
+    LogCleaner::CleanerThreadState thread0, thread1, thread2;
+    thread1.threadNumber = 1;
+    thread2.threadNumber = 2;
+    uint32_t segmentSize = serverConfig()->segmentSize;
+
+    // The first call only records where the counters start.
+    Cycles::mockTscValue = 1000;
+    balancer.tune(&thread0);
+    EXPECT_EQ(1000U, balancer.lastTuneTime);
+    EXPECT_EQ(1, balancer.targetThreads);
+
+    // Too early to tune again; other threads never tune.
+    Cycles::mockTscValue += Cycles::fromMicroseconds(1000);
+    balancer.tune(&thread0);
+    Cycles::mockTscValue += Cycles::fromSeconds(1.0);
+    balancer.tune(&thread1);
+    EXPECT_EQ(1000U, balancer.lastTuneTime);
+
+    // The log is written twice as fast as one thread frees memory.
+    SegmentManager::mockMemoryUtilization = 95;
+    segmentManager2.totalHeadSegments += 2;
+    cleaner2.doWorkTicks += Cycles::fromSeconds(0.5);
+    cleaner2.inMemoryMetrics.totalBytesFreed += segmentSize / 2;
+    cleaner2.inMemoryMetrics.totalBytesAppendedToSurvivors += segmentSize;
+    balancer.tune(&thread0);
+    EXPECT_NEAR(2.0 * segmentSize / 1.001, balancer.writeRate,
+                segmentSize / 100);
+    EXPECT_NEAR(segmentSize, balancer.threadCleaningRate, segmentSize / 100);
+    EXPECT_EQ(2, balancer.targetThreads);
+    EXPECT_TRUE(balancer.isThreadNeeded(&thread1, 95, 90));
+    EXPECT_FALSE(balancer.isThreadNeeded(&thread2, 95, 90));
+    EXPECT_DOUBLE_EQ(0.4, balancer.ratio);
+
+    // Compaction has become expensive: clean on disk sooner.
+    Cycles::mockTscValue += Cycles::fromSeconds(1.0);
+    cleaner2.inMemoryMetrics.totalBytesFreed += segmentSize / 10;
+    cleaner2.inMemoryMetrics.totalBytesAppendedToSurvivors += segmentSize;
+    balancer.tune(&thread0);
+    EXPECT_DOUBLE_EQ(0.35, balancer.ratio);
+
+    // Once memory is no longer low, one thread will do.
+    Cycles::mockTscValue += Cycles::fromSeconds(1.0);
+    SegmentManager::mockMemoryUtilization = 50;
+    balancer.tune(&thread0);
+    EXPECT_EQ(1, balancer.targetThreads);
+
+    ProtoBuf::LogMetrics_CleanerMetrics m;
+    balancer.getMetrics(m);
+    EXPECT_EQ(1U, m.target_threads());
+    EXPECT_DOUBLE_EQ(0.35, m.tombstone_ratio());
+
+    SegmentManager::mockMemoryUtilization = 0;
+    Cycles::mockTscValue = 0;
+}
+
 TEST_F(LogCleanerTest, Disabler_basics) {
     TestLog::Enable _;
     Tub<LogCleaner::Disabler> disabler1, disabler2;
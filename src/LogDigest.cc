@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "Common.h"
 #include "ShortMacros.h"
 #include "LogDigest.h"
@@ -32,7 +34,7 @@ LogDigest::LogDigest()
 
 /**
  * Create a new log digest and initialize it from a buffer containing a
- * previously serialized digest if the checksum is valid.
+ * previously serialized digest, in either format, if the checksum is valid.
  */
 LogDigest::LogDigest(const void* buffer, uint32_t length)
     : header(),
@@ -41,6 +43,9 @@ LogDigest::LogDigest(const void* buffer, uint32_t length)
 {
     Crc32C actualChecksum;
 
+    if (decodeCompact(static_cast<const uint8_t*>(buffer), length))
+        return;
+
     if (length < sizeof(header)) {
         LOG(WARNING, "buffer too small to hold header (length = %u)", length);
         throw LogDigestException(HERE, "buffer too small to hold header");
@@ -113,4 +118,152 @@ LogDigest::appendToBuffer(Buffer& buffer) const
         downCast<uint32_t>(sizeof(segmentIds.front()) * segmentIds.size()));
 }
 
+/**
+ * Append a varint (7 bits per byte, least significant first, with the high
+ * bit set on all but the last byte) to a vector of bytes.
+ */
+static void
+appendVarint(vector<uint8_t>* bytes, uint64_t value)
+{
+    while (value >= 0x80) {
+        bytes->push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes->push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * Read a varint written by appendVarint.
+ *
+ * \param[in,out] p
+ *      Where the varint starts; advanced past it.
+ * \param end
+ *      End of the bytes that may be read.
+ * \param[out] value
+ *      The value of the varint.
+ * \return
+ *      False means the bytes ran out (or the varint is too long to be
+ *      valid); \a value and \a p are then undefined.
+ */
+static bool
+readVarint(const uint8_t** p, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p == end)
+            return false;
+        uint8_t byte = *(*p)++;
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Append this digest to the given buffer in the compact format (see
+ * CompactHeader), or, if it has fewer than MIN_COMPACT_IDS ids or the
+ * compact format isn't smaller, in the same format as appendToBuffer. The
+ * digest must exist as long as the buffer does, in case it is the latter.
+ */
+void
+LogDigest::appendCompactToBuffer(Buffer& buffer) const
+{
+    if (segmentIds.size() < MIN_COMPACT_IDS) {
+        appendToBuffer(buffer);
+        return;
+    }
+
+    vector<uint64_t> ids(segmentIds);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    vector<uint8_t> runs;
+    uint64_t nextId = 0;
+    size_t i = 0;
+    while (i < ids.size()) {
+        size_t runEnd = i + 1;
+        while (runEnd < ids.size() && ids[runEnd] == ids[runEnd - 1] + 1)
+            runEnd++;
+        appendVarint(&runs, ids[i] - nextId);
+        appendVarint(&runs, runEnd - i - 1);
+        nextId = ids[runEnd - 1] + 1;
+        i = runEnd;
+    }
+
+    size_t compactLength = sizeof(CompactHeader) + runs.size();
+    if (compactLength >= sizeof(header) +
+            sizeof(segmentIds.front()) * segmentIds.size()) {
+        appendToBuffer(buffer);
+        return;
+    }
+
+    CompactHeader* compactHeader = buffer.emplaceAppend<CompactHeader>();
+    Crc32C runsChecksum;
+    runsChecksum.update(runs.data(), downCast<uint32_t>(runs.size()));
+    compactHeader->checksum = runsChecksum.getResult();
+    compactHeader->magic = COMPACT_MAGIC;
+    compactHeader->count = downCast<uint32_t>(ids.size());
+    buffer.appendCopy(runs.data(), downCast<uint32_t>(runs.size()));
+}
+
+/**
+ * Fill in this (empty) digest from a buffer if it holds a digest in the
+ * compact format; used by the constructor.
+ *
+ * \param buffer
+ *      The serialized digest.
+ * \param length
+ *      Number of bytes in \a buffer.
+ * \return
+ *      False means \a buffer doesn't start with a CompactHeader, so it
+ *      must be in the other format.
+ * \throw LogDigestException
+ *      The digest is in the compact format, but is corrupt.
+ */
+bool
+LogDigest::decodeCompact(const uint8_t* buffer, uint32_t length)
+{
+    if (length < sizeof(CompactHeader))
+        return false;
+    const CompactHeader* compactHeader =
+            reinterpret_cast<const CompactHeader*>(buffer);
+    if (compactHeader->magic != COMPACT_MAGIC)
+        return false;
+
+    const uint8_t* p = buffer + sizeof(CompactHeader);
+    const uint8_t* end = buffer + length;
+    Crc32C actualChecksum;
+    actualChecksum.update(p, downCast<uint32_t>(end - p));
+    if (actualChecksum.getResult() != compactHeader->checksum) {
+        LOG(WARNING, "invalid compact digest checksum (computed 0x%08x, "
+            "expect 0x%08x", actualChecksum.getResult(),
+            compactHeader->checksum);
+        throw LogDigestException(HERE, "invalid digest checksum");
+    }
+
+    uint64_t nextId = 0;
+    while (p < end) {
+        uint64_t gap, extra;
+        if (!readVarint(&p, end, &gap) || !readVarint(&p, end, &extra)) {
+            LOG(WARNING, "truncated run in compact digest");
+            throw LogDigestException(HERE, "truncated run in compact digest");
+        }
+        if (segmentIds.size() + extra >= compactHeader->count) {
+            LOG(WARNING, "compact digest has more than %u ids",
+                compactHeader->count);
+            throw LogDigestException(HERE, "too many ids in compact digest");
+        }
+        for (uint64_t id = nextId + gap; id <= nextId + gap + extra; id++)
+            addSegmentId(id);
+        nextId += gap + extra + 1;
+    }
+    if (segmentIds.size() != compactHeader->count) {
+        LOG(WARNING, "compact digest has %lu ids, expected %u",
+            segmentIds.size(), compactHeader->count);
+        throw LogDigestException(HERE, "too few ids in compact digest");
+    }
+    return true;
+}
+
 } // namespace RAMCloud
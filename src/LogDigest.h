@@ -36,6 +36,14 @@ struct LogDigestException : public Exception {
  * only find copies of all segments referenced by the head's LogDigest. If it
  * finds them all (and they pass checksums), it knows it has the complete log.
  *
+ * A digest has one entry for every segment in the log, so a master with a
+ * large log would spend a lot of every head segment (and of the bandwidth
+ * used to replicate it) on digests if each id took 8 bytes. Masters
+ * therefore write them with appendCompactToBuffer, which sorts the ids and
+ * encodes runs of consecutive ids as varint gaps and lengths. Since segment
+ * ids are handed out in order, a log that has been cleaned many times
+ * still has long runs, and its digest is a small fraction of the size. The
+ * constructor accepts either format.
  */
 class LogDigest {
   public:
@@ -45,6 +53,12 @@ class LogDigest {
     uint32_t size() const;
     uint64_t operator[](size_t index) const;
     void appendToBuffer(Buffer& buffer) const;
+    void appendCompactToBuffer(Buffer& buffer) const;
+
+    /// appendCompactToBuffer only uses the compact format for digests with
+    /// at least this many ids: smaller ones are small anyway, and stay
+    /// readable by coordinators that predate the compact format.
+    enum { MIN_COMPACT_IDS = 16 };
 
   PRIVATE:
     /**
@@ -54,6 +68,31 @@ class LogDigest {
         Crc32C::ResultType checksum;
     } __attribute__((__packed__));
 
+    /**
+     * A digest in the compact format starts with this header instead. It
+     * is followed by a pair of varints for each run of consecutive ids, in
+     * ascending order: the gap between the end of the previous run (or 0
+     * for the first run) and the run's first id, and the run's length
+     * minus one.
+     */
+    struct CompactHeader {
+        /// Checksum of the varints following the header.
+        Crc32C::ResultType checksum;
+
+        /// Always COMPACT_MAGIC. Distinguishes this format from the
+        /// other, where this is the low half of the first segment id.
+        uint32_t magic;
+
+        /// Number of segment ids in the digest.
+        uint32_t count;
+    } __attribute__((__packed__));
+
+    /// See CompactHeader::magic. Segment ids are allocated sequentially, so
+    /// no master will get to one whose low 32 bits are this.
+    static const uint32_t COMPACT_MAGIC = 0xd1c0de57;
+
+    bool decodeCompact(const uint8_t* buffer, uint32_t length);
+
     /// Copy of the current header. Updated every time another segment id is
     /// added.
     Header header;
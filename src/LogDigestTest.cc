@@ -135,4 +135,86 @@ TEST_F(LogDigestTest, appendToBuffer)
     }
 }
 
+TEST_F(LogDigestTest, appendCompactToBuffer_small)
+{
+    LogDigest d;
+    for (uint64_t i = 0; i < LogDigest::MIN_COMPACT_IDS - 1; i++)
+        d.addSegmentId(i);
+    Buffer buffer;
+    d.appendCompactToBuffer(buffer);
+    EXPECT_EQ(4U + 8 * (LogDigest::MIN_COMPACT_IDS - 1), buffer.size());
+}
+
+TEST_F(LogDigestTest, appendCompactToBuffer_runs)
+{
+    // Two runs, out of order and with a duplicate: 1000-1099 and 5-9.
+    LogDigest d;
+    for (uint64_t i = 1000; i < 1100; i++)
+        d.addSegmentId(i);
+    for (uint64_t i = 5; i < 10; i++)
+        d.addSegmentId(i);
+    d.addSegmentId(1050);
+    Buffer buffer;
+    d.appendCompactToBuffer(buffer);
+
+    // Header, then gap 5 and length 4, and gap 990 and length 99.
+    EXPECT_EQ(sizeof(LogDigest::CompactHeader) + 5, buffer.size());
+    LogDigest d2(buffer.getRange(0, buffer.size()), buffer.size());
+    ASSERT_EQ(105U, d2.size());
+    EXPECT_EQ(5U, d2[0]);
+    EXPECT_EQ(9U, d2[4]);
+    EXPECT_EQ(1000U, d2[5]);
+    EXPECT_EQ(1099U, d2[104]);
+
+    // The decoded digest can be written out again in the other format.
+    Buffer buffer2;
+    d2.appendToBuffer(buffer2);
+    LogDigest d3(buffer2.getRange(0, buffer2.size()), buffer2.size());
+    EXPECT_EQ(105U, d3.size());
+}
+
+TEST_F(LogDigestTest, appendCompactToBuffer_notSmaller)
+{
+    LogDigest d;
+    for (uint64_t i = 1; i <= LogDigest::MIN_COMPACT_IDS; i++)
+        d.addSegmentId(i << 58);
+    Buffer buffer;
+    d.appendCompactToBuffer(buffer);
+    EXPECT_EQ(4U + 8 * LogDigest::MIN_COMPACT_IDS, buffer.size());
+    LogDigest d2(buffer.getRange(0, buffer.size()), buffer.size());
+    EXPECT_EQ(1UL << 58, d2[0]);
+}
+
+TEST_F(LogDigestTest, decodeCompact_corrupt)
+{
+    TestLog::Enable _;
+    LogDigest d;
+    for (uint64_t i = 0; i < 100; i += 2)
+        d.addSegmentId(i);
+    Buffer buffer;
+    d.appendCompactToBuffer(buffer);
+    uint32_t length = buffer.size();
+    uint8_t* bytes = static_cast<uint8_t*>(buffer.getRange(0, length));
+    LogDigest::CompactHeader* header =
+            reinterpret_cast<LogDigest::CompactHeader*>(bytes);
+
+    header->count++;
+    EXPECT_THROW(LogDigest(bytes, length), LogDigestException);
+    EXPECT_EQ("decodeCompact: compact digest has 50 ids, expected 51",
+        TestLog::get());
+
+    TestLog::reset();
+    header->count -= 2;
+    EXPECT_THROW(LogDigest(bytes, length), LogDigestException);
+    EXPECT_EQ("decodeCompact: compact digest has more than 49 ids",
+        TestLog::get());
+
+    TestLog::reset();
+    header->count++;
+    bytes[length - 1]++;
+    EXPECT_THROW(LogDigest(bytes, length), LogDigestException);
+    EXPECT_EQ(0U, TestLog::get().find(
+        "decodeCompact: invalid compact digest checksum"));
+}
+
 } // namespace RAMCloud
@@ -59,6 +59,15 @@ class LogEntryHandlers {
                           Buffer& oldBuffer,
                           AbstractLog::Reference oldReference,
                           LogEntryRelocator& relocator) = 0;
+
+    /**
+     * This method may be called for an entry shortly before relocate() is
+     * called for it, so that whatever relocate() will need to look up (a
+     * hash table bucket, for instance) can be brought into the cache while
+     * other entries are being relocated. It is only a hint; the default
+     * does nothing.
+     */
+    virtual void prefetchEntry(LogEntryType type, Buffer& buffer) { }
 };
 
 } // namespace
@@ -78,12 +78,15 @@ LogEntryRelocator::append(LogEntryType type, Buffer& buffer)
     }
 
     uint32_t priorLength = segment->getAppendedLength();
+    uint32_t priorPadding = segment->getPaddingBytes();
     if (!segment->append(type, buffer, &reference)) {
         outOfSpace = true;
         return false;
     }
 
-    totalBytesAppended = segment->getAppendedLength() - priorLength;
+    // Any padding in front of the entry is dead space, not part of it.
+    totalBytesAppended = segment->getAppendedLength() - priorLength -
+                         (segment->getPaddingBytes() - priorPadding);
 
     didAppend = true;
     return true;
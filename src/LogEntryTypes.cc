@@ -50,6 +50,14 @@ toString(LogEntryType type)
         return "Transaction Decision Record";
     case LOG_ENTRY_TYPE_TXPLIST:
         return "Transaction Participant List Record";
+    case LOG_ENTRY_TYPE_OBJDELTA:
+        return "Object Delta";
+    case LOG_ENTRY_TYPE_PREPTOMBBATCH:
+        return "Transaction Prepare Tombstone Batch";
+    case LOG_ENTRY_TYPE_PADDING:
+        return "Padding";
+    case LOG_ENTRY_TYPE_SEGCHECKSUM:
+        return "Segment Content Checksum";
     default:
         return "<<Unknown>>";
     }
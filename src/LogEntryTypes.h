@@ -61,6 +61,22 @@ enum LogEntryType {
     /// See ParticipantList
     LOG_ENTRY_TYPE_TXPLIST,
 
+    /// See Object.h::ObjectDelta
+    LOG_ENTRY_TYPE_OBJDELTA,
+
+    /// See PreparedOp.h::PreparedOpTombstoneBatch
+    LOG_ENTRY_TYPE_PREPTOMBBATCH,
+
+    /// Unused space that keeps the next entry from spanning seglets; see
+    /// Segment::setContiguousEntryBytes(). Never referenced, so the cleaner
+    /// and recovery skip it.
+    LOG_ENTRY_TYPE_PADDING,
+
+    /// Checksum of every byte in the segment before it, appended when the
+    /// segment is closed; see Segment::enableContentChecksum(). Checked by
+    /// backups, and skipped by the cleaner and recovery.
+    LOG_ENTRY_TYPE_SEGCHECKSUM,
+
     /// Not a type, but rather the total number of types we have defined.
     /// This is currently restricted by the lower 6 bits in a uint8_t field
     /// in Segment.h's Segment::EntryHeader. RAMCloud will probably collapse
@@ -0,0 +1,249 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Cycles.h"
+#include "Log.h"
+#include "LogHealthMonitor.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Returns how much a counter grew between two readings (0 if it appears
+ * to have gone backwards, which can happen for the out-of-memory time
+ * when a stall ends as the counters are being read).
+ */
+static inline uint64_t
+since(uint64_t previous, uint64_t current)
+{
+    return (current > previous) ? current - previous : 0;
+}
+
+/**
+ * Construct a LogHealthMonitor. The timer isn't started; call start(0)
+ * once the log is in use.
+ *
+ * \param dispatch
+ *      The dispatcher that will be used to schedule execution of this
+ *      object.
+ * \param log
+ *      The log to monitor.
+ * \param intervalSeconds
+ *      Length of each sampling interval.
+ */
+LogHealthMonitor::LogHealthMonitor(Dispatch* dispatch, Log* log,
+        double intervalSeconds)
+    : WorkerTimer(dispatch)
+    , log(log)
+    , intervalTicks(Cycles::fromSeconds(intervalSeconds))
+    , previous()
+    , havePrevious(false)
+    , mutex("LogHealthMonitor::mutex")
+    , history()
+{
+}
+
+/**
+ * Destructor for LogHealthMonitor.
+ */
+LogHealthMonitor::~LogHealthMonitor()
+{
+    stop();
+}
+
+/**
+ * Append the samples kept by this object, oldest first, to a buffer; this
+ * is the response to the GET_LOG_HEALTH server control. The result is a
+ * sequence of Sample structures; use parse() to read it.
+ *
+ * \param buffer
+ *      The samples are appended here.
+ */
+void
+LogHealthMonitor::collect(Buffer* buffer)
+{
+    SpinLock::Guard _(mutex);
+    foreach (const Sample& sample, history) {
+        buffer->appendCopy(&sample);
+    }
+}
+
+/**
+ * Return the number of bytes of memory the cleaner freed per second during
+ * the most recent interval, or 0 if no interval has been sampled yet.
+ */
+double
+LogHealthMonitor::getCleaningBandwidth()
+{
+    SpinLock::Guard _(mutex);
+    if (history.empty())
+        return 0;
+    return history.back().cleaningBandwidth();
+}
+
+/**
+ * This method is invoked at the end of each interval; it records a sample
+ * and complains if the log is in trouble.
+ */
+void
+LogHealthMonitor::handleTimerEvent()
+{
+    ProtoBuf::LogMetrics metrics;
+    log->getMetrics(metrics);
+    Totals current = readTotals(metrics, Cycles::rdtsc());
+    if (havePrevious) {
+        Sample sample = computeSample(previous, current);
+        addSample(sample);
+        if (sample.noSpaceNs != 0) {
+            RAMCLOUD_CLOG(WARNING, "Log was out of memory for %.1f ms of "
+                    "the last %.1f s (%lu appends refused, %lu emergency "
+                    "heads); cleaner freed %.1f MB/s at write cost %.2f",
+                    static_cast<double>(sample.noSpaceNs) * 1e-6,
+                    static_cast<double>(sample.intervalNs) * 1e-9,
+                    sample.refusedAppends, sample.emergencyHeads,
+                    sample.cleaningBandwidth() / 1e6,
+                    sample.memoryWriteCost());
+        } else if (sample.freeFraction() < LOW_MEMORY_FRACTION) {
+            RAMCLOUD_CLOG(WARNING, "Log memory is low (%.1f%% free); "
+                    "cleaner freed %.1f MB/s at write cost %.2f, waited "
+                    "%.1f ms for survivor segments",
+                    100.0 * sample.freeFraction(),
+                    sample.cleaningBandwidth() / 1e6,
+                    sample.memoryWriteCost(),
+                    static_cast<double>(sample.survivorWaitNs) * 1e-6);
+        }
+    }
+    previous = current;
+    havePrevious = true;
+    start(current.timestamp + intervalTicks);
+}
+
+/**
+ * Parse the output of collect().
+ *
+ * \param buffer
+ *      Contains the output of collect().
+ * \param offset
+ *      Offset within buffer of the first byte of that output.
+ * \param length
+ *      Number of bytes of output.
+ * \param[out] samples
+ *      The samples are returned here, oldest first.
+ *
+ * \return
+ *      True for success, false if the output was malformed.
+ */
+bool
+LogHealthMonitor::parse(Buffer* buffer, uint32_t offset, uint32_t length,
+        std::vector<Sample>* samples)
+{
+    samples->clear();
+    if ((length % sizeof32(Sample)) != 0)
+        return false;
+    uint32_t end = offset + length;
+    while (offset < end) {
+        const Sample* sample = buffer->getOffset<Sample>(offset);
+        if (sample == NULL)
+            return false;
+        samples->push_back(*sample);
+        offset += sizeof32(*sample);
+    }
+    return true;
+}
+
+/**
+ * Extract the counters this class cares about from the log's metrics.
+ *
+ * \param metrics
+ *      Output of Log::getMetrics.
+ * \param timestamp
+ *      Cycles::rdtsc() time when the metrics were read.
+ */
+LogHealthMonitor::Totals
+LogHealthMonitor::readTotals(const ProtoBuf::LogMetrics& metrics,
+        uint64_t timestamp)
+{
+    const ProtoBuf::LogMetrics_CleanerMetrics_InMemoryMetrics& inMemory =
+            metrics.cleaner_metrics().in_memory_metrics();
+    const ProtoBuf::LogMetrics_CleanerMetrics_OnDiskMetrics& onDisk =
+            metrics.cleaner_metrics().on_disk_metrics();
+
+    Totals totals;
+    totals.timestamp = timestamp;
+    totals.bytesAppended = metrics.total_bytes_appended() +
+            metrics.total_metadata_bytes_appended();
+    totals.memoryBytesFreed = inMemory.total_bytes_freed() +
+            onDisk.total_memory_bytes_freed();
+    totals.diskBytesFreed = onDisk.total_disk_bytes_freed();
+    totals.compactionSurvivorBytes =
+            inMemory.total_bytes_appended_to_survivors();
+    totals.cleaningSurvivorBytes = onDisk.total_bytes_appended_to_survivors();
+    totals.survivorWaitTicks = inMemory.wait_for_free_survivor_ticks() +
+            onDisk.wait_for_free_survivors_ticks();
+    totals.emergencyHeads = metrics.segment_metrics().total_emergency_heads();
+    totals.noSpaceTicks = metrics.total_no_space_ticks() +
+            metrics.current_no_space_ticks();
+    totals.refusedAppends = metrics.total_no_space_appends();
+    totals.freeSeglets = metrics.seglet_metrics().default_pool_count();
+    totals.usableSeglets = metrics.seglet_metrics().total_usable_seglets();
+    return totals;
+}
+
+/**
+ * Compute the sample for one interval.
+ *
+ * \param previous
+ *      Counters at the start of the interval.
+ * \param current
+ *      Counters at the end of the interval.
+ */
+LogHealthMonitor::Sample
+LogHealthMonitor::computeSample(const Totals& previous, const Totals& current)
+{
+    Sample sample;
+#define DELTA(_x) since(previous._x, current._x)
+    sample.timestamp = Cycles::toNanoseconds(current.timestamp);
+    sample.intervalNs = Cycles::toNanoseconds(DELTA(timestamp));
+    sample.bytesAppended = DELTA(bytesAppended);
+    sample.memoryBytesFreed = DELTA(memoryBytesFreed);
+    sample.diskBytesFreed = DELTA(diskBytesFreed);
+    sample.compactionSurvivorBytes = DELTA(compactionSurvivorBytes);
+    sample.cleaningSurvivorBytes = DELTA(cleaningSurvivorBytes);
+    sample.survivorWaitNs = Cycles::toNanoseconds(DELTA(survivorWaitTicks));
+    sample.emergencyHeads = DELTA(emergencyHeads);
+    sample.noSpaceNs = Cycles::toNanoseconds(DELTA(noSpaceTicks));
+    sample.refusedAppends = DELTA(refusedAppends);
+#undef DELTA
+    sample.freeSeglets = current.freeSeglets;
+    sample.usableSeglets = current.usableSeglets;
+    return sample;
+}
+
+/**
+ * Add a sample to #history, discarding the oldest one if it is full.
+ *
+ * \param sample
+ *      The sample to add.
+ */
+void
+LogHealthMonitor::addSample(const Sample& sample)
+{
+    SpinLock::Guard _(mutex);
+    if (history.size() >= HISTORY_LENGTH)
+        history.pop_front();
+    history.push_back(sample);
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,211 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_LOGHEALTHMONITOR_H
+#define RAMCLOUD_LOGHEALTHMONITOR_H
+
+#include <deque>
+
+#include "Buffer.h"
+#include "SpinLock.h"
+#include "WorkerTimer.h"
+
+#include "LogMetrics.pb.h"
+
+namespace RAMCloud {
+
+class Log;
+
+/**
+ * This class implements a WorkerTimer that wakes up at regular intervals to
+ * sample the health of a master's log: how fast the cleaner is freeing
+ * memory and at what write cost, how long it waited for survivor segments,
+ * whether emergency heads were needed, and how long writers were turned
+ * away because the log was out of memory. The last few minutes of samples
+ * are kept so that they can be fetched with the GET_LOG_HEALTH server
+ * control, and a warning is logged when memory runs low or writes stall.
+ *
+ * The numbers all come from Log::getMetrics; this class only turns the
+ * cumulative counters there into rates over fixed intervals.
+ */
+class LogHealthMonitor : public WorkerTimer {
+  PUBLIC:
+    /// The state of the log over one interval. Counts are for the
+    /// interval only, not since the server started.
+    struct Sample {
+        /// Server time at the end of the interval, in nanoseconds
+        /// (Cycles::toNanoseconds of the rdtsc value).
+        uint64_t timestamp;
+
+        /// Length of the interval, in nanoseconds.
+        uint64_t intervalNs;
+
+        /// Bytes appended to the log (entries and their metadata).
+        uint64_t bytesAppended;
+
+        /// Bytes of memory freed by the cleaner, both by compaction and by
+        /// combined disk and memory cleaning.
+        uint64_t memoryBytesFreed;
+
+        /// Bytes of backup space freed by disk cleaning.
+        uint64_t diskBytesFreed;
+
+        /// Live bytes copied to survivors by in-memory compaction.
+        uint64_t compactionSurvivorBytes;
+
+        /// Live bytes copied to survivors by disk cleaning.
+        uint64_t cleaningSurvivorBytes;
+
+        /// Time the cleaner spent waiting for free survivor segments, in
+        /// nanoseconds.
+        uint64_t survivorWaitNs;
+
+        /// Emergency head segments allocated.
+        uint64_t emergencyHeads;
+
+        /// Time the log was out of memory and refused appends, in
+        /// nanoseconds.
+        uint64_t noSpaceNs;
+
+        /// Appends refused because the log was out of memory.
+        uint64_t refusedAppends;
+
+        /// Seglets free for new head segments at the end of the interval.
+        uint64_t freeSeglets;
+
+        /// Seglets usable for log data (i.e. not held in reserve).
+        uint64_t usableSeglets;
+
+        /// Bytes of memory the cleaner freed per second.
+        double
+        cleaningBandwidth() const
+        {
+            return (intervalNs == 0) ? 0 :
+                    static_cast<double>(memoryBytesFreed) * 1e9 /
+                    static_cast<double>(intervalNs);
+        }
+
+        /// Bytes written to memory per byte of memory freed (1 means the
+        /// cleaner copied nothing); 0 if no memory was freed.
+        double
+        memoryWriteCost() const
+        {
+            return (memoryBytesFreed == 0) ? 0 :
+                    static_cast<double>(memoryBytesFreed +
+                    compactionSurvivorBytes + cleaningSurvivorBytes) /
+                    static_cast<double>(memoryBytesFreed);
+        }
+
+        /// Bytes written to backups per byte of backup space freed; 0 if
+        /// no disk cleaning took place.
+        double
+        diskWriteCost() const
+        {
+            return (diskBytesFreed == 0) ? 0 :
+                    static_cast<double>(diskBytesFreed +
+                    cleaningSurvivorBytes) /
+                    static_cast<double>(diskBytesFreed);
+        }
+
+        /// Fraction of the usable seglets that were free.
+        double
+        freeFraction() const
+        {
+            return (usableSeglets == 0) ? 0 :
+                    static_cast<double>(freeSeglets) /
+                    static_cast<double>(usableSeglets);
+        }
+    } __attribute__((packed));
+
+    LogHealthMonitor(Dispatch* dispatch, Log* log,
+            double intervalSeconds = 1.0);
+    ~LogHealthMonitor();
+    void collect(Buffer* buffer);
+    double getCleaningBandwidth();
+    void handleTimerEvent();
+    static bool parse(Buffer* buffer, uint32_t offset, uint32_t length,
+            std::vector<Sample>* samples);
+
+    /// Number of samples kept; older ones are discarded.
+    static const size_t HISTORY_LENGTH = 300;
+
+    /// A warning is logged at the end of any interval in which the free
+    /// fraction of log memory is below this.
+    static constexpr double LOW_MEMORY_FRACTION = 0.05;
+
+  PRIVATE:
+    /// Cumulative counters read from the log at the end of an interval;
+    /// fields correspond to those of Sample, but times are in rdtsc ticks.
+    struct Totals {
+        Totals()
+            : timestamp(0)
+            , bytesAppended(0)
+            , memoryBytesFreed(0)
+            , diskBytesFreed(0)
+            , compactionSurvivorBytes(0)
+            , cleaningSurvivorBytes(0)
+            , survivorWaitTicks(0)
+            , emergencyHeads(0)
+            , noSpaceTicks(0)
+            , refusedAppends(0)
+            , freeSeglets(0)
+            , usableSeglets(0)
+        {}
+
+        uint64_t timestamp;
+        uint64_t bytesAppended;
+        uint64_t memoryBytesFreed;
+        uint64_t diskBytesFreed;
+        uint64_t compactionSurvivorBytes;
+        uint64_t cleaningSurvivorBytes;
+        uint64_t survivorWaitTicks;
+        uint64_t emergencyHeads;
+        uint64_t noSpaceTicks;
+        uint64_t refusedAppends;
+        uint64_t freeSeglets;
+        uint64_t usableSeglets;
+    };
+
+    static Totals readTotals(const ProtoBuf::LogMetrics& metrics,
+            uint64_t timestamp);
+    static Sample computeSample(const Totals& previous,
+            const Totals& current);
+    void addSample(const Sample& sample);
+
+    /// The log whose health is monitored.
+    Log* log;
+
+    /// Time between samples, in Cycles::rdtsc() ticks.
+    uint64_t intervalTicks;
+
+    /// Counters as of the end of the last interval; invalid until the
+    /// timer has fired once.
+    Totals previous;
+
+    /// False until #previous has been filled in.
+    bool havePrevious;
+
+    /// Protects #history, which collect() reads from RPC worker threads.
+    SpinLock mutex;
+
+    /// The most recent samples, oldest first.
+    std::deque<Sample> history;
+
+    DISALLOW_COPY_AND_ASSIGN(LogHealthMonitor);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_LOGHEALTHMONITOR_H
@@ -0,0 +1,226 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "Cycles.h"
+#include "Log.h"
+#include "LogHealthMonitor.h"
+#include "MasterTableMetadata.h"
+#include "ServerConfig.h"
+
+namespace RAMCloud {
+
+class LogHealthMonitorTestHandlers : public LogEntryHandlers {
+  public:
+    uint32_t getTimestamp(LogEntryType type, Buffer& buffer) { return 0; }
+    void relocate(LogEntryType type,
+                  Buffer& oldBuffer,
+                  Log::Reference oldReference,
+                  LogEntryRelocator& relocator) { }
+};
+
+class LogHealthMonitorTest : public ::testing::Test {
+  public:
+    Context context;
+    ServerId serverId;
+    ServerList serverList;
+    ServerConfig serverConfig;
+    ReplicaManager replicaManager;
+    MasterTableMetadata masterTableMetadata;
+    SegletAllocator allocator;
+    SegmentManager segmentManager;
+    LogHealthMonitorTestHandlers entryHandlers;
+    Log log;
+    LogHealthMonitor monitor;
+
+    LogHealthMonitorTest()
+        : context()
+        , serverId(ServerId(57, 0))
+        , serverList(&context)
+        , serverConfig(ServerConfig::forTesting())
+        , replicaManager(&context, &serverId, 0, false, false)
+        , masterTableMetadata()
+        , allocator(&serverConfig)
+        , segmentManager(&context, &serverConfig, &serverId,
+                         allocator, replicaManager, &masterTableMetadata)
+        , entryHandlers()
+        , log(&context, &serverConfig, &entryHandlers,
+              &segmentManager, &replicaManager)
+        , monitor(context.dispatch, &log)
+    {
+        log.sync();
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(LogHealthMonitorTest);
+};
+
+TEST_F(LogHealthMonitorTest, collectAndParse) {
+    LogHealthMonitor::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.bytesAppended = 10;
+    monitor.addSample(sample);
+    sample.bytesAppended = 20;
+    monitor.addSample(sample);
+
+    Buffer buffer;
+    buffer.appendCopy("abc", 3);
+    monitor.collect(&buffer);
+    std::vector<LogHealthMonitor::Sample> samples;
+    EXPECT_TRUE(LogHealthMonitor::parse(&buffer, 3, buffer.size() - 3,
+            &samples));
+    ASSERT_EQ(2u, samples.size());
+    EXPECT_EQ(10u, samples[0].bytesAppended);
+    EXPECT_EQ(20u, samples[1].bytesAppended);
+
+    // Malformed output.
+    EXPECT_FALSE(LogHealthMonitor::parse(&buffer, 3, buffer.size() - 4,
+            &samples));
+}
+
+TEST_F(LogHealthMonitorTest, getCleaningBandwidth) {
+    EXPECT_EQ(0, monitor.getCleaningBandwidth());
+    LogHealthMonitor::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.intervalNs = 500000000;
+    sample.memoryBytesFreed = 1000;
+    monitor.addSample(sample);
+    sample.memoryBytesFreed = 3000;
+    monitor.addSample(sample);
+    EXPECT_EQ(6000, monitor.getCleaningBandwidth());
+}
+
+TEST_F(LogHealthMonitorTest, handleTimerEvent) {
+    monitor.handleTimerEvent();
+    EXPECT_TRUE(monitor.havePrevious);
+    EXPECT_EQ(0u, monitor.history.size());
+    EXPECT_TRUE(monitor.isRunning());
+
+    log.append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
+    log.sync();
+    monitor.handleTimerEvent();
+    ASSERT_EQ(1u, monitor.history.size());
+    EXPECT_LT(2u, monitor.history[0].bytesAppended);
+    EXPECT_EQ(0u, monitor.history[0].noSpaceNs);
+    EXPECT_LT(0u, monitor.history[0].usableSeglets);
+    monitor.stop();
+}
+
+TEST_F(LogHealthMonitorTest, handleTimerEvent_outOfMemory) {
+    TestLog::Enable _;
+    monitor.handleTimerEvent();
+    AbstractLog::Metrics& metrics = log.AbstractLog::metrics;
+    metrics.totalNoSpaceTicks += Cycles::fromNanoseconds(3000000);
+    metrics.totalNoSpaceAppends += 4;
+    monitor.handleTimerEvent();
+    ASSERT_EQ(1u, monitor.history.size());
+    EXPECT_NEAR(3000000.0, static_cast<double>(monitor.history[0].noSpaceNs),
+            1000.0);
+    EXPECT_EQ(4u, monitor.history[0].refusedAppends);
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "Log was out of memory for 3.0 ms"));
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(), "4 appends refused"));
+    monitor.stop();
+}
+
+TEST_F(LogHealthMonitorTest, readTotals) {
+    ProtoBuf::LogMetrics metrics;
+    metrics.set_total_bytes_appended(100);
+    metrics.set_total_metadata_bytes_appended(5);
+    metrics.set_total_no_space_ticks(10);
+    metrics.set_current_no_space_ticks(7);
+    metrics.set_total_no_space_appends(3);
+    ProtoBuf::LogMetrics_CleanerMetrics* cleaner =
+            metrics.mutable_cleaner_metrics();
+    cleaner->mutable_in_memory_metrics()->set_total_bytes_freed(1000);
+    cleaner->mutable_in_memory_metrics()->
+            set_total_bytes_appended_to_survivors(200);
+    cleaner->mutable_in_memory_metrics()->
+            set_wait_for_free_survivor_ticks(1);
+    cleaner->mutable_on_disk_metrics()->set_total_memory_bytes_freed(2000);
+    cleaner->mutable_on_disk_metrics()->set_total_disk_bytes_freed(3000);
+    cleaner->mutable_on_disk_metrics()->
+            set_total_bytes_appended_to_survivors(400);
+    cleaner->mutable_on_disk_metrics()->
+            set_wait_for_free_survivors_ticks(2);
+    metrics.mutable_segment_metrics()->set_total_emergency_heads(6);
+    metrics.mutable_seglet_metrics()->set_default_pool_count(8);
+    metrics.mutable_seglet_metrics()->set_total_usable_seglets(9);
+
+    LogHealthMonitor::Totals totals =
+            LogHealthMonitor::readTotals(metrics, 555);
+    EXPECT_EQ(555u, totals.timestamp);
+    EXPECT_EQ(105u, totals.bytesAppended);
+    EXPECT_EQ(3000u, totals.memoryBytesFreed);
+    EXPECT_EQ(3000u, totals.diskBytesFreed);
+    EXPECT_EQ(200u, totals.compactionSurvivorBytes);
+    EXPECT_EQ(400u, totals.cleaningSurvivorBytes);
+    EXPECT_EQ(3u, totals.survivorWaitTicks);
+    EXPECT_EQ(6u, totals.emergencyHeads);
+    EXPECT_EQ(17u, totals.noSpaceTicks);
+    EXPECT_EQ(3u, totals.refusedAppends);
+    EXPECT_EQ(8u, totals.freeSeglets);
+    EXPECT_EQ(9u, totals.usableSeglets);
+}
+
+TEST_F(LogHealthMonitorTest, computeSample) {
+    LogHealthMonitor::Totals previous, current;
+    previous.timestamp = 1000;
+    previous.memoryBytesFreed = 500;
+    previous.noSpaceTicks = 50;
+    current.timestamp = 1000 + Cycles::fromSeconds(2.0);
+    current.memoryBytesFreed = 500 + 4000000;
+    current.diskBytesFreed = 1000;
+    current.compactionSurvivorBytes = 1000000;
+    current.cleaningSurvivorBytes = 1000000;
+    current.emergencyHeads = 2;
+    current.noSpaceTicks = 40;
+    current.freeSeglets = 1;
+    current.usableSeglets = 50;
+
+    LogHealthMonitor::Sample sample =
+            LogHealthMonitor::computeSample(previous, current);
+    EXPECT_NEAR(2e09, static_cast<double>(sample.intervalNs), 1e3);
+    EXPECT_EQ(4000000u, sample.memoryBytesFreed);
+    EXPECT_EQ(2u, sample.emergencyHeads);
+
+    // Counters that seem to go backwards read as 0.
+    EXPECT_EQ(0u, sample.noSpaceNs);
+
+    EXPECT_NEAR(2e06, sample.cleaningBandwidth(), 1e3);
+    EXPECT_DOUBLE_EQ(1.5, sample.memoryWriteCost());
+    EXPECT_DOUBLE_EQ(1001.0, sample.diskWriteCost());
+    EXPECT_DOUBLE_EQ(0.02, sample.freeFraction());
+
+    memset(&sample, 0, sizeof(sample));
+    EXPECT_EQ(0, sample.cleaningBandwidth());
+    EXPECT_EQ(0, sample.memoryWriteCost());
+    EXPECT_EQ(0, sample.diskWriteCost());
+    EXPECT_EQ(0, sample.freeFraction());
+}
+
+TEST_F(LogHealthMonitorTest, addSample) {
+    LogHealthMonitor::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    for (size_t i = 0; i < LogHealthMonitor::HISTORY_LENGTH + 2; i++) {
+        sample.bytesAppended = i;
+        monitor.addSample(sample);
+    }
+    EXPECT_EQ(static_cast<size_t>(LogHealthMonitor::HISTORY_LENGTH),
+              monitor.history.size());
+    EXPECT_EQ(2u, monitor.history.front().bytesAppended);
+}
+
+}  // namespace RAMCloud
@@ -132,6 +132,25 @@ LogIterator::next()
     }
 }
 
+/**
+ * Skip the remaining entries of the current segment and advance to the
+ * first entry of the next one. Together with getCurrentSegmentIterator
+ * (whose result may be copied), this lets callers hand whole segments to
+ * other threads instead of walking them entry by entry.
+ *
+ * This must not be invoked once onHead() has returned true: from then on
+ * the iteration has to proceed entry by entry so that it ends where the
+ * head was when it was reached.
+ */
+void
+LogIterator::nextSegment()
+{
+    assert(!headReached);
+    if (currentIterator)
+        currentIterator->setLimit(0);
+    next();
+}
+
 /**
  * Test whether or not the iterator is currently on the head of the log. When
  * iterating the head all log appends are delayed until the iterator has been
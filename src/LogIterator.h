@@ -54,6 +54,7 @@ class LogIterator {
     ~LogIterator();
 
     void next();
+    void nextSegment();
     bool onHead();
     Log::Reference getReference();
 
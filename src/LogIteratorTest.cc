@@ -241,6 +241,22 @@ TEST_F(LogIteratorTest, next_setLimitForHeadSegment) {
     EXPECT_EQ(writeCount, readCount);
 }
 
+TEST_F(LogIteratorTest, nextSegment) {
+    while (l.head == NULL || l.head->id < 3)
+        l.append(LOG_ENTRY_TYPE_OBJ, data, sizeof(data));
+
+    LogIterator i(l);
+    EXPECT_EQ(1u, i.currentSegmentId);
+    i.next();
+    i.nextSegment();
+    EXPECT_EQ(2u, i.currentSegmentId);
+    EXPECT_EQ(LOG_ENTRY_TYPE_SEGHEADER, i.getType());
+    EXPECT_FALSE(i.onHead());
+    i.nextSegment();
+    EXPECT_EQ(3u, i.currentSegmentId);
+    EXPECT_TRUE(i.onHead());
+}
+
 TEST_F(LogIteratorTest, populateSegmentList) {
         l.sync();
         LogSegment* seg1 = segmentManager.allocHeadSegment();
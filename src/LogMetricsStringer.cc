@@ -117,6 +117,9 @@ LogMetricsStringer::getServerParameters()
     s += ls + format("  Cleaner Balancer:              %s\n",
         serverConfig->master().cleaner_balancer().c_str());
 
+    s += ls + format("  Cleaner Cold Data Age:         %u s\n",
+        serverConfig->master().cleaner_cold_data_age());
+
     s += ls + format("===> LOG CONSTANTS:\n");
 
     s += ls + format("  Poll Interval:                 %d us\n",
@@ -487,6 +490,12 @@ LogMetricsStringer::getLogMetrics()
     s += ls + format("  Total Metadata Appends:        %.2f MB\n",
         d(logMetrics->total_metadata_bytes_appended()) / 1024 / 1024);
 
+    s += ls + format("  Total Seglet Padding:          %.2f MB\n",
+        d(logMetrics->total_padding_bytes()) / 1024 / 1024);
+
+    s += ls + format("  Entries Spanning Seglets:      %lu\n",
+        logMetrics->total_straddling_entries());
+
     double appendTime = Cycles::toSeconds(logMetrics->total_append_ticks(),
                                           serverHz);
     s += ls + format("  Total Time Appending:          %.3f sec (%.2f%%)\n",
@@ -14,14 +14,15 @@
  */
 
 #include "Common.h"
-#include "Dispatch.h"
 #include "LogProtector.h"
+#include "ThreadId.h"
 
 namespace RAMCloud {
 
 std::mutex LogProtector::epochProvidersMutex;
 LogProtector::EpochList LogProtector::epochProviders;
 uint64_t LogProtector::currentSystemEpoch = 1;
+LogProtector::EpochSlot LogProtector::epochSlots[NUM_EPOCH_SLOTS];
 
 /**
  * Default constructor.
@@ -89,14 +90,148 @@ LogProtector::Activity::getEarliestEpoch(int activityMask)
     }
 }
 
+/**
+ * Default constructor.
+ */
+LogProtector::Pin::Pin()
+    : epoch(0)
+    , activities(~0)
+    , slot(NULL)
+{
+}
+
+/**
+ * Destructor; releases the pin, if any.
+ */
+LogProtector::Pin::~Pin()
+{
+    release();
+}
+
+/**
+ * Pin the current epoch, so that the log state visible now is not torn down
+ * until release() is called. Must not be called while already pinned.
+ *
+ * \param activities
+ *      A bit mask indicating what sorts of actions are being performed while
+ *      the pin is held (default: ~0, which means all activities).
+ */
+void
+LogProtector::Pin::acquire(int activities)
+{
+    assert(slot == NULL);
+    slot = &epochSlots[ThreadId::get() % NUM_EPOCH_SLOTS];
+    this->activities = activities;
+
+    // The epoch must be read with the slot locked: a scan that misses this
+    // pin is then guaranteed to have started after the epoch was read, so
+    // any epoch increment it is waiting out precedes the pinned one.
+    std::lock_guard<SpinLock> guard(slot->lock);
+    epoch = LogProtector::getCurrentEpoch();
+    addPin(slot, epoch, activities);
+}
+
+/**
+ * Release the pin taken by acquire(), if any. This may be called on any
+ * thread.
+ */
+void
+LogProtector::Pin::release()
+{
+    if (slot == NULL)
+        return;
+    {
+        std::lock_guard<SpinLock> guard(slot->lock);
+        removePin(slot, epoch, activities);
+    }
+    slot = NULL;
+    epoch = 0;
+}
+
+/**
+ * Change the activities this pin protects, keeping its epoch. Narrowing them
+ * (e.g. to Transport::ServerRpc::READ_ACTIVITY once an RPC is known not to
+ * append to the log) lets waiters for other activities proceed sooner.
+ *
+ * \param activities
+ *      The new activity bit mask.
+ */
+void
+LogProtector::Pin::setActivities(int activities)
+{
+    if (slot != NULL) {
+        std::lock_guard<SpinLock> guard(slot->lock);
+        removePin(slot, epoch, this->activities);
+        addPin(slot, epoch, activities);
+    }
+    this->activities = activities;
+}
+
 //////////////////////////////////////////////////////
 /// Static members
 //////////////////////////////////////////////////////
 
+/**
+ * Count one more pin in an EpochSlot. The slot's lock must be held.
+ *
+ * \param slot
+ *      Slot to count the pin in.
+ * \param epoch
+ *      The pinned epoch.
+ * \param activities
+ *      Activity bit mask of the pin.
+ */
+void
+LogProtector::addPin(EpochSlot* slot, uint64_t epoch, int activities)
+{
+    EpochSlot::Entry* unused = NULL;
+    foreach (EpochSlot::Entry& entry, slot->entries) {
+        if (entry.pins == 0) {
+            if (unused == NULL)
+                unused = &entry;
+        } else if (entry.epoch == epoch && entry.activities == activities) {
+            entry.pins++;
+            return;
+        }
+    }
+    if (unused == NULL) {
+        slot->entries.emplace_back();
+        unused = &slot->entries.back();
+    }
+    unused->epoch = epoch;
+    unused->activities = activities;
+    unused->pins = 1;
+}
+
+/**
+ * Count one pin less in an EpochSlot. The slot's lock must be held.
+ *
+ * \param slot
+ *      Slot the pin was counted in by addPin.
+ * \param epoch
+ *      The pinned epoch.
+ * \param activities
+ *      Activity bit mask of the pin.
+ */
+void
+LogProtector::removePin(EpochSlot* slot, uint64_t epoch, int activities)
+{
+    foreach (EpochSlot::Entry& entry, slot->entries) {
+        if (entry.pins != 0 && entry.epoch == epoch &&
+                entry.activities == activities) {
+            entry.pins--;
+            return;
+        }
+    }
+    assert(false);
+}
+
 /**
  * Obtain the earliest (lowest value) epoch of any ongoing log-touching
  * activities in the system. If there are no eligible log-touching activities,
  * then the return value is -1 (i.e. the largest 64-bit unsigned integer).
+ * The cost is proportional to the number of threads, not to the number of
+ * outstanding RPCs, and no dispatch lock is needed.
  *
  * \param activityMask
  *      A bit mask of flags such as Transport::READ_ACTIVITY. Only
@@ -114,6 +249,14 @@ LogProtector::getEarliestOutstandingEpoch(int activityMask)
         it++;
     }
 
+    foreach (EpochSlot& slot, epochSlots) {
+        std::lock_guard<SpinLock> guard(slot.lock);
+        foreach (EpochSlot::Entry& entry, slot.entries) {
+            if (entry.pins != 0 && (entry.activities & activityMask) != 0)
+                earliest = std::min(entry.epoch, earliest);
+        }
+    }
+
     return earliest;
 }
 
@@ -143,15 +286,12 @@ LogProtector::incrementCurrentEpoch()
 /**
  * Waits for all conflicting activities started before now to finish.
  *
- * \param context
- *      Overall information about the RAMCloud server; used to lock the
- *      dispatcher.
  * \param activityMask
  *      A bit mask of flags such as Transport::READ_ACTIVITY. Waits only
  *      for matching activities to finish.
  */
 void
-LogProtector::wait(Context* context, int activityMask)
+LogProtector::wait(int activityMask)
 {
     // Increment the current epoch and save the last epoch any
     // currently running RPC could have been a part of
@@ -159,7 +299,6 @@ LogProtector::wait(Context* context, int activityMask)
 
     // Wait for the remainder of already running activities to finish.
     while (true) {
-        Dispatch::Lock lock(context->dispatch);
         uint64_t earliestEpoch =
             LogProtector::getEarliestOutstandingEpoch(activityMask);
         if (earliestEpoch > epoch)
@@ -18,6 +18,7 @@
 
 #include <list>
 #include "Common.h"
+#include "SpinLock.h"
 
 namespace RAMCloud {
 
@@ -40,10 +41,47 @@ namespace RAMCloud {
  * finish. This "waiting" allows read operations to safely de-reference
  * log references to the old segment which was obtained before log cleaning.
  *
+ * Activities come in two flavors. Short-lived ones tied to a thread (such as
+ * a WorkerTimer handler) use an Activity, which registers itself as an
+ * EpochProvider. Server RPCs, which are numerous and may hold references into
+ * the log until their replies have been sent, use a Pin instead: pins are
+ * counted in a fixed number of per-thread slots, so finding the earliest
+ * outstanding epoch costs O(threads) no matter how many RPCs are in flight,
+ * and needs no dispatch lock.
+ *
  * This class is a wrapper for other classes related to the log protection
  * mechanism. It has static members only to track global state.
  */
 class LogProtector {
+  PRIVATE:
+    /**
+     * Counts the pins taken by the threads that hash to it. Each slot sits
+     * in its own cache line, so that threads pinning and unpinning epochs
+     * don't contend with each other.
+     */
+    struct EpochSlot {
+        EpochSlot()
+            : lock("LogProtector::EpochSlot::lock")
+            , entries()
+        {}
+
+        /// Number of pins taken in one epoch for one set of activities.
+        struct Entry {
+            uint64_t epoch;
+            int activities;
+            uint32_t pins;
+        };
+
+        /// Protects entries. Contended only by scans for the earliest epoch
+        /// and by pins released on a different thread than they were taken.
+        SpinLock lock;
+
+        /// Entries whose pin count has dropped to zero are reused, so this
+        /// holds at most as many entries as there were distinct epochs
+        /// pinned at once.
+        vector<Entry> entries;
+    } CACHE_ALIGN;
+
   public:
     /**
      * Interface for anything that can return epoch value used for log protection.
@@ -93,6 +131,39 @@ class LogProtector {
         DISALLOW_COPY_AND_ASSIGN(Activity);
     };
 
+    /**
+     * Pins the epoch in which a long-lived log-touching operation, such as
+     * servicing a ServerRpc, started, until the operation ends (or the Pin is
+     * destroyed). Unlike Activity, a Pin may be released on a different
+     * thread than the one that acquired it.
+     */
+    class Pin {
+      public:
+        Pin();
+        ~Pin();
+        void acquire(int activities = ~0);
+        void release();
+        void setActivities(int activities);
+
+        /**
+         * The epoch pinned by this object, or 0 if it doesn't currently
+         * hold a pin.
+         */
+        uint64_t epoch;
+
+        /**
+         * A bit mask of activity flags such as Transport::READ_ACTIVITY.
+         * Indicates what the pinning operation may do with the log.
+         */
+        int activities;
+
+      PRIVATE:
+        /// The slot in which the pin is counted; NULL if not pinned.
+        EpochSlot* slot;
+
+        DISALLOW_COPY_AND_ASSIGN(Pin);
+    };
+
     /**
      * Lock-guard style guard for logProtector.
      * Automatically starts and stops LogProtector.
@@ -120,9 +191,18 @@ class LogProtector {
     static uint64_t getEarliestOutstandingEpoch(int activityMask);
     static uint64_t getCurrentEpoch();
     static uint64_t incrementCurrentEpoch();
-    static void wait(Context* context, int activityMask);
+    static void wait(int activityMask);
 
   PRIVATE:
+    static void addPin(EpochSlot* slot, uint64_t epoch, int activities);
+    static void removePin(EpochSlot* slot, uint64_t epoch, int activities);
+
+    /// Number of EpochSlots; threads are assigned to them by ThreadId.
+    static const uint32_t NUM_EPOCH_SLOTS = 64;
+
+    // Pin counts of all threads.
+    static EpochSlot epochSlots[NUM_EPOCH_SLOTS];
+
     // An unsigned integer representing the current epoch.
     static uint64_t currentSystemEpoch;
 
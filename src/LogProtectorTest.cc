@@ -27,6 +27,8 @@ class LogProtectorTest : public ::testing::Test {
         // LogProtector::epochProviders, which can cause false errors.
         // Just delete the junk.
         LogProtector::epochProviders.clear();
+        foreach (LogProtector::EpochSlot& slot, LogProtector::epochSlots)
+            slot.entries.clear();
     }
 };
 
@@ -180,8 +182,8 @@ TEST_F(LogProtectorTest, incrementCurrentEpoch) {
     EXPECT_EQ(99U, LogProtector::getCurrentEpoch());
 }
 
-static void waitCaller(Context* context, int activityMask, bool* done) {
-    LogProtector::wait(context, activityMask);
+static void waitCaller(int activityMask, bool* done) {
+    LogProtector::wait(activityMask);
     *done = true;
 }
 
@@ -198,20 +200,18 @@ TEST_F(LogProtectorTest, wait_activityMask) {
     EXPECT_EQ(19UL, LogProtector::getEarliestOutstandingEpoch(
             Transport::ServerRpc::APPEND_ACTIVITY));
 
-    Context context;
-
     // wait call should return immediately.
     LogProtector::currentSystemEpoch = 18;
-    LogProtector::wait(&context, Transport::ServerRpc::APPEND_ACTIVITY);
+    LogProtector::wait(Transport::ServerRpc::APPEND_ACTIVITY);
 
     // wait call should return immediately.
     LogProtector::currentSystemEpoch = 5;
-    LogProtector::wait(&context, ~0);
+    LogProtector::wait(~0);
 
     // Now wait call is blocked by a2 (w/ epoch = 6).
     bool done;
     LogProtector::currentSystemEpoch = 18;
-    std::thread thread(waitCaller, &context, ~0, &done);
+    std::thread thread(waitCaller, ~0, &done);
     usleep(10000);
     EXPECT_FALSE(done);
 
@@ -222,4 +222,90 @@ TEST_F(LogProtectorTest, wait_activityMask) {
     thread.join();
 }
 
+TEST_F(LogProtectorTest, pin_acquireAndRelease) {
+    LogProtector::currentSystemEpoch = 12;
+    LogProtector::Pin pin;
+    EXPECT_EQ(0U, pin.epoch);
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
+
+    pin.acquire();
+    EXPECT_EQ(12U, pin.epoch);
+    EXPECT_EQ(~0, pin.activities);
+    EXPECT_TRUE(pin.slot != NULL);
+    EXPECT_EQ(12UL, LogProtector::getEarliestOutstandingEpoch(~0));
+
+    pin.release();
+    EXPECT_EQ(0U, pin.epoch);
+    EXPECT_TRUE(pin.slot == NULL);
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
+
+    // Releasing twice is harmless.
+    pin.release();
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
+}
+
+TEST_F(LogProtectorTest, pin_destructor) {
+    LogProtector::currentSystemEpoch = 12;
+    {
+        LogProtector::Pin pin;
+        pin.acquire();
+        EXPECT_EQ(12UL, LogProtector::getEarliestOutstandingEpoch(~0));
+    }
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
+}
+
+TEST_F(LogProtectorTest, pin_sharedEntries) {
+    LogProtector::Pin p1, p2, p3;
+    LogProtector::currentSystemEpoch = 30;
+    p1.acquire();
+    p2.acquire();
+    LogProtector::currentSystemEpoch = 31;
+    p3.acquire();
+    EXPECT_EQ(p1.slot, p3.slot);
+    EXPECT_EQ(2U, p1.slot->entries.size());
+    EXPECT_EQ(2U, p1.slot->entries[0].pins);
+
+    p1.release();
+    EXPECT_EQ(30UL, LogProtector::getEarliestOutstandingEpoch(~0));
+    p2.release();
+    EXPECT_EQ(31UL, LogProtector::getEarliestOutstandingEpoch(~0));
+
+    // Entries without pins are reused.
+    LogProtector::currentSystemEpoch = 32;
+    p1.acquire();
+    EXPECT_EQ(2U, p1.slot->entries.size());
+    EXPECT_EQ(31UL, LogProtector::getEarliestOutstandingEpoch(~0));
+}
+
+static void releasePin(LogProtector::Pin* pin) {
+    pin->release();
+}
+
+TEST_F(LogProtectorTest, pin_releaseOnAnotherThread) {
+    LogProtector::currentSystemEpoch = 40;
+    LogProtector::Pin pin;
+    pin.acquire();
+    std::thread thread(releasePin, &pin);
+    thread.join();
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
+}
+
+TEST_F(LogProtectorTest, pin_setActivities) {
+    LogProtector::currentSystemEpoch = 50;
+    LogProtector::Pin pin;
+    pin.setActivities(Transport::ServerRpc::APPEND_ACTIVITY);
+    EXPECT_EQ(static_cast<int>(Transport::ServerRpc::APPEND_ACTIVITY),
+              pin.activities);
+    pin.acquire();
+    EXPECT_EQ(50UL, LogProtector::getEarliestOutstandingEpoch(~0));
+
+    LogProtector::currentSystemEpoch = 51;
+    pin.setActivities(Transport::ServerRpc::READ_ACTIVITY);
+    EXPECT_EQ(50U, pin.epoch);
+    EXPECT_EQ(50UL, LogProtector::getEarliestOutstandingEpoch(
+            Transport::ServerRpc::READ_ACTIVITY));
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(
+            Transport::ServerRpc::APPEND_ACTIVITY));
+}
+
 } // namespace RAMCloud
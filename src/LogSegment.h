@@ -84,6 +84,10 @@ class LogSegment : public Segment {
           segmentSize(segmentSize),
           creationTimestamp(creationTimestamp),
           isEmergencyHead(isEmergencyHead),
+          onFlash(false),
+          appendedAsHead(false),
+          isSurvivor(false),
+          relocationGeneration(0),
           cleanedEpoch(0),
           cachedCleaningCostBenefitScore(0),
           cachedCompactionCostBenefitScore(0),
@@ -100,7 +104,9 @@ class LogSegment : public Segment {
           entryCounts(),
           deadEntryCounts(),
           entryLengths(),
-          deadEntryLengths()
+          deadEntryLengths(),
+          tombstoneTargets(),
+          tombstoneSummaryComplete(false)
     {
         memset(entryCounts, 0, sizeof(entryCounts));
         memset(deadEntryCounts, 0, sizeof(deadEntryCounts));
@@ -247,6 +253,30 @@ class LogSegment : public Segment {
     /// that is expected to live longer.
     const bool isEmergencyHead;
 
+    /// If true, this segment's seglets are on local flash rather than in
+    /// memory (see SegletAllocator::FLASH). Such segments are cold survivors
+    /// of disk cleaning; compacting them would free no memory, so the
+    /// cleaner only ever cleans them on disk.
+    bool onFlash;
+
+    /// If true, this segment was allocated as the log head, so its entries
+    /// were appended in log order by this master's own writes rather than by
+    /// a side log (such as the cleaner's, or recovery's). A compacted copy
+    /// inherits this from the segment it replaces. See
+    /// ObjectManager::readLogChanges.
+    bool appendedAsHead;
+
+    /// If true, this segment joined the log as a survivor of disk cleaning,
+    /// filled with entries the cleaner relocated from the segments it
+    /// cleaned. Compacted copies of segments never set this.
+    bool isSurvivor;
+
+    /// Zero unless this segment is a survivor (see #isSurvivor) or a
+    /// compacted copy of another segment. Then it is the value that
+    /// SegmentManager::getRelocationGeneration() took when this segment
+    /// became part of the log; see Enumeration::completeInLogOrder.
+    uint64_t relocationGeneration;
+
     /// The epoch value when cleaning was completed on this segment. Once no
     /// more RPCs in the system exist with epochs less than or equal to this,
     /// there can be no more outstanding references into the segment and its
@@ -302,7 +332,11 @@ class LogSegment : public Segment {
     /// that bundled our replication traffic with theirs). The point is to allow
     /// batching of objects during backup writes when there are multiple threads
     /// appending to the log.
-    uint32_t syncedLength;
+    ///
+    /// Threads waiting in Log::sync() poll this without holding any lock to
+    /// find out when a replication round has covered their appends, so it is
+    /// atomic.
+    std::atomic<uint32_t> syncedLength;
 
     /// Timestamp when this segment was last compacted or created. Used by the
     /// cleaner to decide when to scan for dead tombstones. Sometimes segments
@@ -352,6 +386,39 @@ class LogSegment : public Segment {
     /// still in memory. They do not include ones on disk.
     std::atomic<uint32_t> deadEntryLengths[TOTAL_LOG_ENTRY_TYPES];
 
+    /**
+     * Tombstones in this segment that point at the same segment (the one
+     * that held the objects they deleted). A tombstone is dead exactly when
+     * that segment no longer exists, so this is all that is needed to
+     * account for them without looking at the tombstones again.
+     */
+    struct TombstoneTarget {
+        TombstoneTarget(uint64_t segmentId, uint32_t count, uint32_t length)
+            : segmentId(segmentId), count(count), length(length) {}
+
+        /// Id of the segment the tombstones' objects were written to.
+        uint64_t segmentId;
+
+        /// Number of tombstones pointing at that segment.
+        uint32_t count;
+
+        /// Bytes those tombstones use in the log, including entry headers.
+        uint32_t length;
+    };
+
+    /// Summary of this segment's tombstones, built by CleanableSegmentManager
+    /// the first time it scans them and used in place of later scans. Since
+    /// the segment is closed by then, its tombstones never change. Those the
+    /// hash table still referenced at the time are left out, since they can't
+    /// be reclaimed anyway until their references are removed.
+    std::vector<TombstoneTarget> tombstoneTargets;
+
+    /// True if every tombstone in this segment was summarized in
+    /// #tombstoneTargets, so rescanning the segment can't find any more dead
+    /// ones. False until the first scan, and after a scan that had to leave
+    /// out tombstones still referenced by the hash table.
+    bool tombstoneSummaryComplete;
+
     DISALLOW_COPY_AND_ASSIGN(LogSegment);
 };
 
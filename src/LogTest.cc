@@ -194,6 +194,17 @@ TEST_F(LogTest, enableCleaner_and_disableCleaner) {
     EXPECT_EQ("", TestLog::get());
 }
 
+TEST_F(LogTest, getDurablePosition) {
+    EXPECT_EQ(l.getHead(), l.getDurablePosition());
+    l.append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
+    EXPECT_LT(l.getDurablePosition(), l.getHead());
+    l.sync();
+    EXPECT_EQ(l.getHead(), l.getDurablePosition());
+
+    LogPosition head = l.rollHeadOver();
+    EXPECT_EQ(head, l.getDurablePosition());
+}
+
 TEST_F(LogTest, getHead) {
     EXPECT_EQ(l.getHead(),
             LogPosition(l.head->id, l.head->getAppendedLength()));
@@ -216,11 +227,11 @@ TEST_F(LogTest, sync) {
 
     TestLog::reset();
     l.append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
-    EXPECT_NE(l.head->syncedLength, l.head->getAppendedLength());
+    EXPECT_NE(l.head->syncedLength.load(), l.head->getAppendedLength());
     l.sync();
     EXPECT_EQ("sync: syncing segment 1 to offset 84 | sync: log synced",
         TestLog::get());
-    EXPECT_EQ(l.head->syncedLength, l.head->getAppendedLength());
+    EXPECT_EQ(l.head->syncedLength.load(), l.head->getAppendedLength());
 
     TestLog::reset();
     l.sync();
@@ -241,6 +252,59 @@ TEST_F(LogTest, sync) {
     EXPECT_EQ(5U, l.metrics.totalSyncCalls);
 }
 
+TEST_F(LogTest, sync_partial) {
+    TestLog::Enable _(syncFilter);
+    LogPosition durable = l.getDurablePosition();
+    l.append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
+    l.sync(1);
+    EXPECT_EQ("sync: syncing segment 1 to offset 84 | "
+              "sync: log synced to 1 replicas", TestLog::get());
+    EXPECT_NE(l.head->syncedLength.load(), l.head->getAppendedLength());
+    EXPECT_EQ(durable, l.getDurablePosition());
+
+    // A full sync still happens afterwards.
+    TestLog::reset();
+    l.sync();
+    EXPECT_EQ("sync: syncing segment 1 to offset 84 | sync: log synced",
+        TestLog::get());
+    EXPECT_EQ(l.getHead(), l.getDurablePosition());
+}
+
+TEST_F(LogTest, sync_groupCommitMetrics) {
+    l.sync();
+    uint64_t commitsBefore = l.metrics.totalGroupCommits;
+    uint64_t bytesBefore = l.metrics.totalGroupCommitBytes;
+    uint32_t syncedBefore = l.head->syncedLength;
+
+    // Several appends are made durable by one replication round.
+    l.append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
+    l.append(LOG_ENTRY_TYPE_OBJ, "ho", 2);
+    l.sync();
+    EXPECT_EQ(commitsBefore + 1, l.metrics.totalGroupCommits);
+    EXPECT_EQ(bytesBefore + l.head->getAppendedLength() - syncedBefore,
+              l.metrics.totalGroupCommitBytes);
+
+    // Nothing new to replicate: no round is issued.
+    l.sync();
+    EXPECT_EQ(commitsBefore + 1, l.metrics.totalGroupCommits);
+}
+
+TEST_F(LogTest, waitToLeadSync) {
+    l.sync();
+    l.append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
+    uint32_t appended = l.head->getAppendedLength();
+    EXPECT_FALSE(l.waitToLeadSync(l.head, l.head->syncedLength));
+
+    // The lock is free: the caller leads the round.
+    EXPECT_TRUE(l.waitToLeadSync(l.head, appended));
+    EXPECT_TRUE(l.syncLock.isLocked());
+
+    // Another round (the one above) covers the data while it is held.
+    l.head->syncedLength = appended;
+    EXPECT_FALSE(l.waitToLeadSync(l.head, appended));
+    l.syncLock.unlock();
+}
+
 TEST_F(LogSyncTest, syncTo) {
     TestLog::Enable _(syncFilter);
     l->sync();
@@ -250,15 +314,15 @@ TEST_F(LogSyncTest, syncTo) {
     TestLog::reset();
     Log::Reference reference, reference2;
     l->append(LOG_ENTRY_TYPE_OBJ, "hi", 2, &reference);
-    EXPECT_NE(l->head->syncedLength, l->head->getAppendedLength());
+    EXPECT_NE(l->head->syncedLength.load(), l->head->getAppendedLength());
     l->syncTo(reference);
     EXPECT_EQ("sync: syncing segment 1 to offset 84 | syncTo: log synced",
         TestLog::get());
-    EXPECT_EQ(l->head->syncedLength, l->head->getAppendedLength());
+    EXPECT_EQ(l->head->syncedLength.load(), l->head->getAppendedLength());
 
     TestLog::reset();
     l->append(LOG_ENTRY_TYPE_OBJ, "ho", 2, &reference2);
-    EXPECT_NE(l->head->syncedLength, l->head->getAppendedLength());
+    EXPECT_NE(l->head->syncedLength.load(), l->head->getAppendedLength());
     l->syncTo(reference);
     EXPECT_EQ("syncTo: sync not needed: entry is already replicated",
         TestLog::get());
@@ -56,6 +56,167 @@ static const char* logModuleNames[] = {
 static_assert(unsafeArrayLength(logModuleNames) == NUM_LOG_MODULES,
               "logModuleNames size does not match NUM_LOG_MODULES");
 
+__thread Logger::ThreadBuffer* Logger::threadBuffer = NULL;
+__thread uint64_t Logger::threadBufferOwner = 0;
+
+/// Source of Logger::loggerId values.
+static std::atomic<uint64_t> nextLoggerId(1);
+
+namespace {
+
+/// Largest binary record logBinary creates; longer messages (which means
+/// long string arguments) are formatted immediately instead.
+const uint32_t MAX_BINARY_RECORD = 2048;
+
+/// How long the format thread sleeps when it finds nothing to format.
+const uint32_t FORMAT_POLL_MICROS = 1000;
+
+/// Kinds of printf arguments.
+enum ArgType {
+    ARG_NONE,           // "%%": no argument
+    ARG_INT,            // int, or anything smaller (promoted to int)
+    ARG_WIDE_INT,       // long, long long, size_t, and other 64-bit integers
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_STRING,
+    ARG_POINTER,
+    ARG_UNSUPPORTED     // can't be recorded; format the message immediately
+};
+
+/**
+ * Describes one conversion specification in a printf format string.
+ */
+struct Conversion {
+    /// The character just after the conversion character.
+    const char* end;
+
+    /// Number of '*' (int arguments that precede the converted one).
+    int stars;
+
+    /// True if the precision is given as '*'.
+    bool starPrecision;
+
+    /// Precision given as digits, or -1 if none.
+    int precision;
+
+    /// Kind of argument consumed.
+    ArgType type;
+};
+
+/**
+ * Parse the printf conversion specification that starts at a '%'.
+ *
+ * \param percent
+ *      The '%' character that starts the specification.
+ */
+Conversion
+parseConversion(const char* percent)
+{
+    Conversion conversion = {percent + 1, 0, false, -1, ARG_UNSUPPORTED};
+    const char* p = percent + 1;
+    if (*p == '%') {
+        conversion.end = p + 1;
+        conversion.type = ARG_NONE;
+        return conversion;
+    }
+    while (*p != 0 && strchr("-+ #0'", *p) != NULL)
+        p++;
+    if (*p == '*') {
+        conversion.stars++;
+        p++;
+    } else {
+        while (isdigit(*p))
+            p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            conversion.stars++;
+            conversion.starPrecision = true;
+            p++;
+        } else {
+            conversion.precision = 0;
+            while (isdigit(*p)) {
+                conversion.precision = conversion.precision * 10 + (*p - '0');
+                p++;
+            }
+        }
+    }
+    bool wide = false;
+    bool longDouble = false;
+    bool half = false;
+    while (*p != 0 && strchr("hlLqjzt", *p) != NULL) {
+        if (*p == 'L')
+            longDouble = true;
+        else if (*p == 'h')
+            half = true;
+        else
+            wide = true;
+        p++;
+    }
+    if (*p == 0)
+        return conversion;
+    conversion.end = p + 1;
+    switch (*p) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            conversion.type = wide ? ARG_WIDE_INT : ARG_INT;
+            break;
+        case 'c':
+            if (!wide && !half)
+                conversion.type = ARG_INT;
+            break;
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            conversion.type = longDouble ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+            break;
+        case 's':
+            if (!wide)
+                conversion.type = ARG_STRING;
+            break;
+        case 'p':
+            conversion.type = ARG_POINTER;
+            break;
+        default:
+            // Includes %n, and %m, which depends on errno at the time
+            // of the call.
+            break;
+    }
+    return conversion;
+}
+
+/**
+ * Append a value formatted with one printf conversion to a string.
+ *
+ * \param out
+ *      The formatted value is appended here.
+ * \param spec
+ *      The conversion specification, with the length modifier that
+ *      matches the type of value.
+ * \param value
+ *      The value to format.
+ */
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+template<typename T>
+void
+appendConversion(string* out, const char* spec, T value)
+{
+    char small[64];
+    int length = snprintf(small, sizeof(small), spec, value);
+    if (length < 0)
+        return;
+    if (length < static_cast<int>(sizeof(small))) {
+        out->append(small, length);
+        return;
+    }
+    size_t start = out->size();
+    out->resize(start + length + 1);
+    snprintf(&(*out)[start], length + 1, spec, value);
+    out->resize(start + length);
+}
+#pragma GCC diagnostic warning "-Wformat-nonliteral"
+
+} // anonymous namespace
+
 /**
  * Create a new debug logger; messages will go to stderr by default. Should
  * not be called outside this class except during unit testing.
@@ -84,6 +245,11 @@ Logger::Logger(LogLevel level)
     , testingNoNotify(false)
     , testingLogTime(NULL)
     , testingStallPrintThread(false)
+    , binaryLogging(false)
+    , loggerId(nextLoggerId++)
+    , threadBuffers()
+    , formatThread()
+    , formatThreadExit(false)
 {
     setLogLevels(level);
 
@@ -106,6 +272,13 @@ Logger::Logger(LogLevel level)
  */
 Logger::~Logger()
 {
+    // Exit the format thread; it formats everything already recorded
+    // before returning.
+    if (formatThread) {
+        formatThreadExit = true;
+        formatThread->join();
+    }
+
     // Exit the print thread.
     {
         Lock lock(mutex);
@@ -118,6 +291,8 @@ Logger::~Logger()
     if (mustCloseFd)
         close(fd);
     delete[] messageBuffer;
+    foreach (ThreadBuffer* buffer, threadBuffers)
+        delete buffer;
 }
 
 /**
@@ -436,7 +611,6 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
                    const CodeLocation& where,
                    const char* fmt, ...)
 {
-    uint64_t start = Cycles::rdtsc();
     struct timespec now;
     clock_gettime(CLOCK_REALTIME, &now);
 #ifdef TESTING
@@ -444,6 +618,452 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
         now = *testingLogTime;
     }
 #endif
+    va_list ap;
+    va_start(ap, fmt);
+    // Errors are formatted right away, so that they get out even if the
+    // server is about to die (and they may come from signal handlers).
+    if (binaryLogging && level != ERROR &&
+            logBinary(collapse, module, level, where, now, fmt, ap)) {
+        va_end(ap);
+        return;
+    }
+    logFormatted(collapse, level, where, now, ThreadId::get(), fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * Record a log message in the calling thread's ThreadBuffer, for the
+ * format thread to format later; used in binary logging mode. This copies
+ * the arguments (and the characters of string arguments) but does no
+ * formatting.
+ *
+ * \param collapse
+ *      See logMessage.
+ * \param module
+ *      See logMessage.
+ * \param level
+ *      See logMessage.
+ * \param where
+ *      See logMessage. Its strings must never be freed, as is the case for
+ *      the output of #HERE.
+ * \param now
+ *      Time at which the message was logged.
+ * \param fmt
+ *      See logMessage; must never be freed (it is normally a string
+ *      literal).
+ * \param ap
+ *      The arguments of the message; this function consumes a copy.
+ * \return
+ *      True means the message was recorded (or dropped because the buffer
+ *      was full). False means the message can't be recorded, and the
+ *      caller must format it now.
+ */
+bool
+Logger::logBinary(bool collapse, LogModule module, LogLevel level,
+                  const CodeLocation& where, struct timespec now,
+                  const char* fmt, va_list ap)
+{
+    char staging[MAX_BINARY_RECORD] __attribute__((aligned(8)));
+    BinaryRecord* record = reinterpret_cast<BinaryRecord*>(staging);
+    uint32_t length = sizeof32(BinaryRecord);
+    va_list args;
+    va_copy(args, ap);
+
+    // Copy the arguments, in the order in which the format string uses
+    // them.
+    for (const char* p = strchr(fmt, '%'); p != NULL; p = strchr(p, '%')) {
+        Conversion conversion = parseConversion(p);
+        p = conversion.end;
+        if (length + conversion.stars * 8 + 16 > MAX_BINARY_RECORD) {
+            va_end(args);
+            return false;
+        }
+        int precision = conversion.precision;
+        for (int i = 0; i < conversion.stars; i++) {
+            int64_t star = va_arg(args, int);
+            memcpy(staging + length, &star, 8);
+            length += 8;
+            if (conversion.starPrecision && i == conversion.stars - 1)
+                precision = static_cast<int>(star);
+        }
+        switch (conversion.type) {
+            case ARG_NONE:
+                break;
+            case ARG_INT: {
+                int64_t value = va_arg(args, int);
+                memcpy(staging + length, &value, 8);
+                length += 8;
+                break;
+            }
+            case ARG_WIDE_INT: {
+                int64_t value = va_arg(args, long long);  // NOLINT
+                memcpy(staging + length, &value, 8);
+                length += 8;
+                break;
+            }
+            case ARG_DOUBLE: {
+                double value = va_arg(args, double);
+                memcpy(staging + length, &value, sizeof(value));
+                length += sizeof32(value);
+                break;
+            }
+            case ARG_LONG_DOUBLE: {
+                long double value = va_arg(args, long double);
+                memcpy(staging + length, &value, sizeof(value));
+                length += sizeof32(value);
+                break;
+            }
+            case ARG_POINTER: {
+                void* value = va_arg(args, void*);
+                memcpy(staging + length, &value, sizeof(value));
+                length += sizeof32(value);
+                break;
+            }
+            case ARG_STRING: {
+                const char* value = va_arg(args, const char*);
+                uint32_t stringLength = ~0U;
+                uint32_t space = MAX_BINARY_RECORD - length - 4;
+                if (value != NULL) {
+                    // Don't read past the precision: the string may not be
+                    // null-terminated.
+                    size_t limit = (precision >= 0) ? precision : space;
+                    stringLength = downCast<uint32_t>(strnlen(value,
+                            std::min(limit, size_t(space) + 1)));
+                    if (stringLength > space) {
+                        va_end(args);
+                        return false;
+                    }
+                }
+                memcpy(staging + length, &stringLength, 4);
+                length += 4;
+                if (value != NULL) {
+                    memcpy(staging + length, value, stringLength);
+                    length += stringLength;
+                }
+                break;
+            }
+            case ARG_UNSUPPORTED:
+                va_end(args);
+                return false;
+        }
+    }
+    va_end(args);
+
+    record->length = (length + 7) & ~7U;
+    record->collapse = collapse;
+    record->level = level;
+    record->format = fmt;
+    record->file = where.file;
+    record->line = where.line;
+    record->function = where.function;
+    record->prettyFunction = where.prettyFunction;
+    record->time = now;
+    record->threadId = ThreadId::get();
+
+    // Find space in the ring; the head must never catch up with the tail,
+    // since head == tail means the ring is empty.
+    ThreadBuffer* buffer = getThreadBuffer();
+    uint32_t head = buffer->head.load(std::memory_order_relaxed);
+    uint32_t tail = buffer->tail.load(std::memory_order_acquire);
+    uint32_t start = head;
+    if (head >= tail) {
+        uint32_t end = head + record->length;
+        if (end > ThreadBuffer::BYTES ||
+                (end == ThreadBuffer::BYTES && tail == 0)) {
+            // Doesn't fit at the end; wrap around to the start.
+            start = 0;
+            if (record->length >= tail) {
+                buffer->discarded++;
+                return true;
+            }
+        }
+    } else if (head + record->length >= tail) {
+        buffer->discarded++;
+        return true;
+    }
+    if (start != head && head < ThreadBuffer::BYTES) {
+        uint32_t wrap = 0;
+        memcpy(buffer->data + head, &wrap, sizeof(wrap));
+    }
+    memcpy(buffer->data + start, staging, length);
+    uint32_t newHead = start + record->length;
+    if (newHead == ThreadBuffer::BYTES)
+        newHead = 0;
+    buffer->head.store(newHead, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Return the ThreadBuffer of the calling thread, creating it if needed.
+ */
+Logger::ThreadBuffer*
+Logger::getThreadBuffer()
+{
+    if (expect_true(threadBufferOwner == loggerId))
+        return threadBuffer;
+    Lock lock(mutex);
+    int id = ThreadId::get();
+    ThreadBuffer* buffer = NULL;
+    foreach (ThreadBuffer* candidate, threadBuffers) {
+        if (candidate->threadId == id) {
+            buffer = candidate;
+            break;
+        }
+    }
+    if (buffer == NULL) {
+        buffer = new ThreadBuffer(id);
+        threadBuffers.push_back(buffer);
+    }
+    threadBuffer = buffer;
+    threadBufferOwner = loggerId;
+    return buffer;
+}
+
+/**
+ * Format all of the messages recorded in ThreadBuffers so far, oldest
+ * first, and pass them on to be printed. Only the format thread calls this.
+ *
+ * \return
+ *      True means at least one message was formatted.
+ */
+bool
+Logger::formatRecords()
+{
+    std::vector<ThreadBuffer*> buffers;
+    uint32_t discarded = 0;
+    {
+        Lock lock(mutex);
+        buffers = threadBuffers;
+    }
+    foreach (ThreadBuffer* buffer, buffers)
+        discarded += buffer->discarded.exchange(0);
+    if (discarded > 0) {
+        Lock lock(mutex);
+        discardedEntries += discarded;
+    }
+
+    bool formatted = false;
+    string message;
+    while (true) {
+        // Pick the oldest record at the tail of any buffer, so that
+        // messages from different threads come out in order.
+        ThreadBuffer* oldest = NULL;
+        BinaryRecord* oldestRecord = NULL;
+        foreach (ThreadBuffer* buffer, buffers) {
+            uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+            if (tail == buffer->head.load(std::memory_order_acquire))
+                continue;
+            BinaryRecord* record =
+                    reinterpret_cast<BinaryRecord*>(buffer->data + tail);
+            if (record->length == 0) {
+                buffer->tail.store(0, std::memory_order_release);
+                if (buffer->head.load(std::memory_order_acquire) == 0)
+                    continue;
+                record = reinterpret_cast<BinaryRecord*>(buffer->data);
+            }
+            if (oldestRecord == NULL ||
+                    Util::timespecLess(record->time, oldestRecord->time)) {
+                oldest = buffer;
+                oldestRecord = record;
+            }
+        }
+        if (oldest == NULL)
+            return formatted;
+
+        // Rebuild the message, one conversion at a time.
+        BinaryRecord* record = oldestRecord;
+        const char* arg = reinterpret_cast<const char*>(record + 1);
+        message.clear();
+        const char* fmt = record->format;
+        while (*fmt != 0) {
+            const char* percent = strchr(fmt, '%');
+            if (percent == NULL) {
+                message.append(fmt);
+                break;
+            }
+            message.append(fmt, percent - fmt);
+            Conversion conversion = parseConversion(percent);
+            fmt = conversion.end;
+            if (conversion.type == ARG_NONE) {
+                message.append("%");
+                continue;
+            }
+
+            // Substitute the '*' arguments, and use a length modifier that
+            // matches the recorded value.
+            string spec;
+            bool skipPrecision = false;
+            for (const char* p = percent; p < conversion.end - 1; p++) {
+                if (skipPrecision && *p == '*')
+                    continue;
+                if (*p == '.' && p[1] == '*') {
+                    int64_t star;
+                    memcpy(&star, arg + (conversion.stars - 1) * 8, 8);
+                    if (star < 0) {
+                        // Negative precisions are ignored.
+                        skipPrecision = true;
+                        continue;
+                    }
+                }
+                if (*p == '*') {
+                    int64_t star;
+                    int index = (p[-1] == '.') ? conversion.stars - 1 : 0;
+                    memcpy(&star, arg + index * 8, 8);
+                    spec += format("%ld", star);
+                } else if (strchr("lLqjzt", *p) == NULL) {
+                    spec += *p;
+                }
+            }
+            arg += conversion.stars * 8;
+            char conversionChar = conversion.end[-1];
+            switch (conversion.type) {
+                case ARG_INT: {
+                    int64_t value;
+                    memcpy(&value, arg, 8);
+                    arg += 8;
+                    appendConversion(&message, (spec + conversionChar).c_str(),
+                            static_cast<int>(value));
+                    break;
+                }
+                case ARG_WIDE_INT: {
+                    int64_t value;
+                    memcpy(&value, arg, 8);
+                    arg += 8;
+                    appendConversion(&message,
+                            (spec + "ll" + conversionChar).c_str(),
+                            static_cast<long long>(value));  // NOLINT
+                    break;
+                }
+                case ARG_DOUBLE: {
+                    double value;
+                    memcpy(&value, arg, sizeof(value));
+                    arg += sizeof(value);
+                    appendConversion(&message, (spec + conversionChar).c_str(),
+                            value);
+                    break;
+                }
+                case ARG_LONG_DOUBLE: {
+                    long double value;
+                    memcpy(&value, arg, sizeof(value));
+                    arg += sizeof(value);
+                    appendConversion(&message,
+                            (spec + "L" + conversionChar).c_str(), value);
+                    break;
+                }
+                case ARG_POINTER: {
+                    void* value;
+                    memcpy(&value, arg, sizeof(value));
+                    arg += sizeof(value);
+                    appendConversion(&message, (spec + conversionChar).c_str(),
+                            value);
+                    break;
+                }
+                case ARG_STRING: {
+                    uint32_t stringLength;
+                    memcpy(&stringLength, arg, 4);
+                    arg += 4;
+                    if (stringLength == ~0U) {
+                        appendConversion(&message,
+                                (spec + conversionChar).c_str(),
+                                static_cast<const char*>(NULL));
+                        break;
+                    }
+                    string value(arg, stringLength);
+                    arg += stringLength;
+                    appendConversion(&message, (spec + conversionChar).c_str(),
+                            value.c_str());
+                    break;
+                }
+                default:
+                    // logBinary never records other conversions.
+                    break;
+            }
+        }
+
+        CodeLocation where(record->file, record->line, record->function,
+                record->prettyFunction);
+        logDecoded(record->collapse, record->level, where, record->time,
+                record->threadId, "%s", message.c_str());
+        uint32_t newTail = downCast<uint32_t>(
+                reinterpret_cast<char*>(record) - oldest->data) +
+                record->length;
+        if (newTail == ThreadBuffer::BYTES)
+            newTail = 0;
+        oldest->tail.store(newTail, std::memory_order_release);
+        formatted = true;
+    }
+}
+
+/**
+ * This method is the main program for the thread that formats binary log
+ * messages (see setBinaryLogging).
+ *
+ * \param logger
+ *      The owning Logger.
+ */
+void
+Logger::formatThreadMain(Logger* logger)
+{
+    while (!logger->formatThreadExit) {
+        if (!logger->formatRecords())
+            usleep(FORMAT_POLL_MICROS);
+    }
+    logger->formatRecords();
+}
+
+/**
+ * Pass a message formatted by the format thread on to logFormatted.
+ *
+ * \param collapse
+ *      See logMessage.
+ * \param level
+ *      See logMessage.
+ * \param where
+ *      See logMessage.
+ * \param now
+ *      Time at which the message was logged.
+ * \param threadId
+ *      ThreadId of the thread that logged the message.
+ * \param fmt
+ *      See logMessage.
+ * \param ...
+ *      See logMessage.
+ */
+void
+Logger::logDecoded(bool collapse, LogLevel level, const CodeLocation& where,
+                   struct timespec now, int threadId, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    logFormatted(collapse, level, where, now, threadId, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * Format a log message and add it to the buffer of messages to print;
+ * does the work of logMessage.
+ *
+ * \param collapse
+ *      See logMessage.
+ * \param level
+ *      See logMessage.
+ * \param where
+ *      See logMessage.
+ * \param now
+ *      Time at which the message was logged.
+ * \param threadId
+ *      ThreadId of the thread that logged the message.
+ * \param fmt
+ *      See logMessage.
+ * \param ap
+ *      The arguments of the message.
+ */
+void
+Logger::logFormatted(bool collapse, LogLevel level, const CodeLocation& where,
+                     struct timespec now, int threadId, const char* fmt,
+                     va_list ap)
+{
+    uint64_t start = Cycles::rdtsc();
     Lock lock(mutex);
 
     // See if this log message should be collapsed away entirely.
@@ -490,7 +1110,9 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
 
     // Generate a message about discarded entries, if relevant.
     if (discardedEntries > 0) {
-        CodeLocation here = HERE;
+        // Attribute this to logMessage, the entry point people know.
+        CodeLocation here(__FILE__, __LINE__, "logMessage",
+                __PRETTY_FUNCTION__);
         actual = snprintf(buffer, spaceLeft,
                 "%010lu.%09lu %s:%d in %s %s[%d]: %d log messages "
                 "lost because of buffer overflow\n",
@@ -512,7 +1134,7 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
             "%010lu.%09lu %s:%d in %s %s[%d]: ",
             now.tv_sec, now.tv_nsec, where.baseFileName(), where.line,
             where.function, logLevelNames[level],
-            ThreadId::get());
+            threadId);
     if (actual >= spaceLeft) {
         // We ran out of space in the buffer (should never happen here).
         charsLost += 1 + actual - spaceLeft;
@@ -535,10 +1157,7 @@ Logger::logMessage(bool collapse, LogModule module, LogLevel level,
     }
 
     // Last, add the caller's log message.
-    va_list ap;
-    va_start(ap, fmt);
     actual = vsnprintf(buffer + charsWritten, spaceLeft, fmt, ap);
-    va_end(ap);
     if (actual >= spaceLeft) {
         // We ran out of space in the buffer.
         charsLost += 1 + actual - spaceLeft;
@@ -807,6 +1426,29 @@ Logger::reset()
     testingBufferSize = 0;
     testingLogTime = NULL;
     testingNoNotify = false;
+    binaryLogging = false;
+}
+
+/**
+ * Turn binary logging on or off. In binary logging mode, logMessage copies
+ * the format string pointer and the arguments of each message into a ring
+ * buffer of the calling thread (without taking any locks), and a background
+ * thread formats the messages, which then go through message collapsing
+ * and printing as usual. ERROR messages, and messages whose format can't be
+ * recorded (such as those with %m, or with very long strings), are still
+ * formatted right away. Messages from one thread come out in order.
+ *
+ * \param enable
+ *      True means use binary logging from now on; false means format
+ *      messages in logMessage.
+ */
+void
+Logger::setBinaryLogging(bool enable)
+{
+    Lock lock(mutex);
+    if (enable && !formatThread)
+        formatThread.construct(formatThreadMain, this);
+    binaryLogging = enable;
 }
 
 /**
@@ -820,6 +1462,13 @@ void
 Logger::sync()
 {
     Lock lock(mutex);
+    for (size_t i = 0; i < threadBuffers.size(); i++) {
+        ThreadBuffer* buffer = threadBuffers[i];
+        while (buffer->tail != buffer->head) {
+            Unlock<SpinLock> unlock(mutex);
+            usleep(100);
+        }
+    }
     while (nextToInsert != nextToPrint) {
         Unlock<SpinLock> unlock(mutex);
         usleep(100);
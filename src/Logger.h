@@ -16,10 +16,13 @@
 #ifndef RAMCLOUD_LOGGER_H
 #define RAMCLOUD_LOGGER_H
 
+#include <atomic>
 #include <condition_variable>
+#include <stdarg.h>
 #include <thread>
 #include <time.h>
 #include <unordered_map>
+#include <vector>
 
 #include "CodeLocation.h"
 #include "SpinLock.h"
@@ -72,6 +75,12 @@ enum LogModule {
  * and where the log messages should go.
  *
  * Note: this class is thread-safe.
+ *
+ * Normally logMessage formats each message while holding the Logger's lock.
+ * With setBinaryLogging(true) it only copies the format string pointer and
+ * the arguments into a ring buffer private to the calling thread, and a
+ * background thread formats the message later; this keeps log calls cheap
+ * even during bursts of messages.
  */
 class Logger {
   PRIVATE:
@@ -89,6 +98,7 @@ class Logger {
     void setLogLevel(string module, string level);
     void changeLogLevel(LogModule, int delta);
     void reset();
+    void setBinaryLogging(bool enable);
     void sync();
     void waitIfCongested();
 
@@ -136,8 +146,85 @@ class Logger {
     static void installCrashBacktraceHandlers();
 
   PRIVATE:
+    /**
+     * Header of each message recorded in a ThreadBuffer by logBinary. It is
+     * followed by the arguments of the message, in the order of the conversions
+     * in the format string: integers are stored as 8 bytes, doubles and
+     * pointers in their natural size, and strings as a 4-byte length followed
+     * by the characters (a length of ~0 means a NULL pointer).
+     */
+    struct BinaryRecord {
+        /// Total bytes in the record, including this header; always a multiple
+        /// of 8. 0 means the rest of the ring up to its end is unused, and the
+        /// next record is at the start.
+        uint32_t length;
+
+        /// Arguments of logMessage.
+        bool collapse;
+        LogLevel level;
+        const char* format;
+        const char* file;
+        uint32_t line;
+        const char* function;
+        const char* prettyFunction;
+
+        /// Time the message was logged.
+        struct timespec time;
+
+        /// ThreadId of the thread that logged the message.
+        int threadId;
+    };
+
+    /**
+     * Ring buffer holding the binary log messages of one thread. The thread
+     * adds records at #head and the format thread removes them at #tail; they
+     * synchronize only through those two variables.
+     */
+    struct ThreadBuffer {
+        explicit ThreadBuffer(int threadId)
+            : threadId(threadId)
+            , head(0)
+            , tail(0)
+            , discarded(0)
+        {}
+
+        /// Size of #data.
+        static const uint32_t BYTES = 64 * 1024;
+
+        /// ThreadId of the thread that owns this buffer.
+        const int threadId;
+
+        /// Offset in #data where the next record will be added.
+        std::atomic<uint32_t> head;
+
+        /// Offset in #data of the oldest record not yet formatted; the
+        /// buffer is empty if this equals #head.
+        std::atomic<uint32_t> tail;
+
+        /// Number of messages dropped because the buffer was full.
+        std::atomic<uint32_t> discarded;
+
+        /// Space for records.
+        char data[BYTES] __attribute__((aligned(8)));
+
+        DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+    };
+
     bool addToBuffer(const char* src, int length);
     void cleanCollapseMap(struct timespec now);
+    bool formatRecords();
+    static void formatThreadMain(Logger* logger);
+    ThreadBuffer* getThreadBuffer();
+    bool logBinary(bool collapse, LogModule module, LogLevel level,
+                   const CodeLocation& where, struct timespec now,
+                   const char* fmt, va_list ap);
+    void logDecoded(bool collapse, LogLevel level, const CodeLocation& where,
+                    struct timespec now, int threadId, const char* fmt, ...)
+        __attribute__((format(printf, 7, 8)));
+    void logFormatted(bool collapse, LogLevel level,
+                      const CodeLocation& where, struct timespec now,
+                      int threadId, const char* fmt, va_list ap)
+        __attribute__((format(printf, 7, 0)));
     static void printThreadMain(Logger* logger);
 
     /**
@@ -328,6 +415,47 @@ class Logger {
      * for unit testing. */
     volatile bool testingStallPrintThread;
 
+    // The following variables implement binary logging (see
+    // setBinaryLogging).
+
+    /**
+     * True means logMessage records messages in the calling thread's
+     * ThreadBuffer rather than formatting them.
+     */
+    std::atomic<bool> binaryLogging;
+
+    /**
+     * Identifies this Logger in #threadBufferOwner; never reused, unlike
+     * the address of the Logger.
+     */
+    const uint64_t loggerId;
+
+    /**
+     * Ring buffers of all threads that have logged in binary mode. Only
+     * grows (so the format thread can use a copy without holding #mutex);
+     * the buffers are freed when the Logger is destroyed.
+     */
+    std::vector<ThreadBuffer*> threadBuffers;
+
+    /**
+     * This thread formats the messages recorded in #threadBuffers; it is
+     * started the first time binary logging is enabled.
+     */
+    Tub<std::thread> formatThread;
+
+    /**
+     * Set to true to cause the format thread to exit (after formatting
+     * everything recorded so far) during the Logger destructor.
+     */
+    std::atomic<bool> formatThreadExit;
+
+    /**
+     * The ring buffer of the current thread, and the #loggerId of the
+     * Logger it belongs to.
+     */
+    static __thread ThreadBuffer* threadBuffer;
+    static __thread uint64_t threadBufferOwner;
+
     DISALLOW_COPY_AND_ASSIGN(Logger);
 };
 
@@ -477,6 +477,80 @@ TEST_F(LoggerTest, logMessage_messageTooLong) {
             getLog("__test.log"));
 }
 
+TEST_F(LoggerTest, logMessage_binarySameAsText) {
+    auto logMixed = [this]() {
+        logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, WARNING,
+                CodeLocation("file", 99, "func", "pretty"),
+                "%d %s %5.2f %lu %p %x %c %*d|%.*s|%Lg %hd %% %s\n",
+                -42, "str", 3.14159, 123456789012UL,
+                reinterpret_cast<void*>(0x1234), 255, 'q', 6, 7, 3, "abcdef",
+                2.5L, static_cast<short>(-3), "end");
+    };
+    logger.setLogFile("__test.log", true);
+    logMixed();
+    string text = getLog("__test.log");
+    EXPECT_NE(string::npos, text.find(
+            "-42 str  3.14 123456789012 0x1234 ff q      7|abc|2.5 -3 % end"));
+
+    logger.setLogFile("__test.log", true);
+    logger.setBinaryLogging(true);
+    logMixed();
+    EXPECT_EQ(text, getLog("__test.log"));
+}
+
+TEST_F(LoggerTest, logBinary) {
+    // Leave the format thread off, so the ThreadBuffer can be examined.
+    logger.binaryLogging = true;
+    Logger::ThreadBuffer* buffer = logger.getThreadBuffer();
+    logger.setLogFile("__test.log", true);
+    logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, WARNING,
+            CodeLocation("file", 99, "func", "pretty"), "value %d", 5);
+    uint32_t head = buffer->head;
+    EXPECT_NE(0u, head);
+    EXPECT_EQ(0u, buffer->tail);
+
+    // Errors and unsupported conversions are formatted immediately.
+    logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, ERROR,
+            CodeLocation("file", 99, "func", "pretty"), "error %d|", 6);
+    logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, WARNING,
+            CodeLocation("file", 99, "func", "pretty"), "wide %lc|", L'w');
+    EXPECT_EQ(head, buffer->head);
+
+    EXPECT_TRUE(logger.formatRecords());
+    EXPECT_EQ(head, buffer->tail);
+    EXPECT_FALSE(logger.formatRecords());
+    string log = getLog("__test.log");
+    EXPECT_NE(string::npos, log.find("error 6|"));
+    EXPECT_NE(string::npos, log.find("wide w|"));
+    EXPECT_NE(string::npos, log.find("value 5"));
+    EXPECT_LT(log.find("wide w|"), log.find("value 5"));
+
+    // The buffer is full.
+    buffer->head = 0;
+    buffer->tail = 8;
+    logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, WARNING,
+            CodeLocation("file", 99, "func", "pretty"), "value %d", 7);
+    EXPECT_EQ(1u, buffer->discarded);
+    buffer->tail = 0;
+    EXPECT_FALSE(logger.formatRecords());
+    EXPECT_EQ(0u, buffer->discarded);
+    EXPECT_EQ(1, logger.discardedEntries);
+}
+
+TEST_F(LoggerTest, logBinary_wrapAround) {
+    logger.binaryLogging = true;
+    Logger::ThreadBuffer* buffer = logger.getThreadBuffer();
+    buffer->head = buffer->tail = Logger::ThreadBuffer::BYTES - 16;
+    logger.setLogFile("__test.log", true);
+    logger.logMessage(false, RAMCLOUD_CURRENT_LOG_MODULE, WARNING,
+            CodeLocation("file", 99, "func", "pretty"), "value %d", 8);
+    EXPECT_NE(0u, buffer->head);
+    EXPECT_LT(buffer->head, buffer->tail);
+    EXPECT_TRUE(logger.formatRecords());
+    EXPECT_EQ(buffer->head, buffer->tail);
+    EXPECT_NE(string::npos, getLog("__test.log").find("value 8"));
+}
+
 TEST_F(LoggerTest, cleanCollapseMap_deleteEntries) {
     logger.collapseMap[std::make_pair("LoggerTest.cc", 1)]
         = Logger::SkipInfo({1, 200000000}, 0, "message1\n");
@@ -163,6 +163,84 @@ DropTabletOwnershipRpc::DropTabletOwnershipRpc(Context* context,
     send();
 }
 
+/**
+ * Find out how much of a master's log has been replicated to all of its
+ * backups. This is how clients learn when writes that didn't wait for all
+ * of the backups (see WireFormat::Write::Durability) have become fully
+ * durable.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ * \param target
+ *      If the master's log isn't durable up to this position yet, the master
+ *      syncs it before responding. The default only asks for the current
+ *      position, which may lag behind writes that are durable already.
+ *
+ * \return
+ *      Every entry appended to \a serverId's log before this position has
+ *      been replicated to all of its backups. It is at least \a target,
+ *      unless the target is ahead of the master's log.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed. Writes to it that weren't
+ *      durable may have been lost.
+ */
+LogPosition
+MasterClient::getDurablePosition(Context* context, ServerId serverId,
+        LogPosition target)
+{
+    GetDurablePositionRpc rpc(context, serverId, target);
+    return rpc.wait();
+}
+
+/**
+ * Constructor for GetDurablePositionRpc: initiates an RPC in the same way as
+ * #MasterClient::getDurablePosition, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ * \param target
+ *      The RPC doesn't complete until the master's log is durable up to this
+ *      position.
+ */
+GetDurablePositionRpc::GetDurablePositionRpc(Context* context,
+        ServerId serverId, LogPosition target)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::GetDurablePosition::Response))
+{
+    WireFormat::GetDurablePosition::Request* reqHdr(
+            allocHeader<WireFormat::GetDurablePosition>(serverId));
+    reqHdr->segmentId = target.getSegmentId();
+    reqHdr->segmentOffset = target.getSegmentOffset();
+    send();
+}
+
+/**
+ * Wait for a getDurablePosition RPC to complete.
+ *
+ * \return
+ *      The position up to which the master's log is durable; see
+ *      MasterClient::getDurablePosition.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+LogPosition
+GetDurablePositionRpc::wait()
+{
+    waitAndCheckErrors();
+    const WireFormat::GetDurablePosition::Response* respHdr(
+            getResponseHeader<WireFormat::GetDurablePosition>());
+    return { respHdr->segmentId, respHdr->segmentOffset };
+}
+
 /**
  * Obtain a master's log head position.
  *
@@ -226,6 +304,171 @@ GetHeadOfLogRpc::wait()
     return { respHdr->headSegmentId, respHdr->headSegmentOffset };
 }
 
+/**
+ * Retrieve the access statistics for each of a master's tablets (see
+ * TabletManager::getStatistics).
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ * \param[out] serverStats
+ *      Filled in with the master's statistics.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+MasterClient::getTabletStatistics(Context* context, ServerId serverId,
+        ProtoBuf::ServerStatistics* serverStats)
+{
+    GetTabletStatisticsRpc rpc(context, serverId);
+    rpc.wait(serverStats);
+}
+
+/**
+ * Constructor for GetTabletStatisticsRpc: initiates an RPC in the same way
+ * as #MasterClient::getTabletStatistics, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the target master.
+ */
+GetTabletStatisticsRpc::GetTabletStatisticsRpc(Context* context,
+        ServerId serverId)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::GetServerStatistics::Response))
+{
+    allocHeader<WireFormat::GetServerStatistics>();
+    send();
+}
+
+/**
+ * Wait for a getTabletStatistics RPC to complete.
+ *
+ * \param[out] serverStats
+ *      Filled in with the master's statistics.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+GetTabletStatisticsRpc::wait(ProtoBuf::ServerStatistics* serverStats)
+{
+    waitAndCheckErrors();
+    const WireFormat::GetServerStatistics::Response* respHdr(
+            getResponseHeader<WireFormat::GetServerStatistics>());
+    ProtoBuf::parseFromResponse(response, sizeof(*respHdr),
+            respHdr->serverStatsLength, serverStats);
+}
+
+/**
+ * Constructor for IndexEntryBatchRpc: prepares an empty batch; the rpc isn't
+ * sent until send() is called.
+ *
+ * \param session
+ *      Session to the index server that holds the indexlets of all the
+ *      entries that will be added.
+ */
+IndexEntryBatchRpc::IndexEntryBatchRpc(Transport::SessionRef session)
+    : RpcWrapper(sizeof(WireFormat::IndexEntryBatch::Response))
+    , count(0)
+{
+    this->session = session;
+    WireFormat::IndexEntryBatch::Request* reqHdr(
+            allocHeader<WireFormat::IndexEntryBatch>());
+    reqHdr->count = 0;
+}
+
+/**
+ * Add an index entry to the batch. Must not be called after send().
+ *
+ * \param tableId
+ *      Id of the table containing the object that the index entry points to.
+ * \param indexId
+ *      Id of the index to which this index key belongs to.
+ * \param indexKey
+ *      Blob of index key for the entry. The caller must keep it unchanged
+ *      until the rpc has completed.
+ * \param indexKeyLength
+ *      Length of index key.
+ * \param primaryKeyHash
+ *      Key hash of the primary key for the object that this index entry
+ *      maps to.
+ * \param remove
+ *      True means the entry is to be removed, false that it is to be
+ *      inserted.
+ */
+void
+IndexEntryBatchRpc::appendEntry(uint64_t tableId, uint8_t indexId,
+        const void* indexKey, KeyLength indexKeyLength,
+        uint64_t primaryKeyHash, bool remove)
+{
+    WireFormat::IndexEntryBatch::Part* part =
+            request.emplaceAppend<WireFormat::IndexEntryBatch::Part>();
+    part->tableId = tableId;
+    part->indexId = indexId;
+    part->remove = remove;
+    part->indexKeyLength = indexKeyLength;
+    part->primaryKeyHash = primaryKeyHash;
+    request.appendExternal(indexKey, indexKeyLength);
+    count++;
+}
+
+/**
+ * Report the outcome of one of the entries of a batch whose rpc has
+ * completed (isReady() returned true).
+ *
+ * \param index
+ *      Which entry to report on: 0 for the first one passed to
+ *      appendEntry(), and so on.
+ *
+ * \return
+ *      The status the index server returned for the entry, or the status of
+ *      the whole rpc if it failed. STATUS_RETRY means the rpc couldn't be
+ *      delivered.
+ */
+Status
+IndexEntryBatchRpc::getStatus(uint32_t index)
+{
+    if (getState() != FINISHED)
+        return STATUS_RETRY;
+    const WireFormat::IndexEntryBatch::Response* respHdr =
+            response->getStart<WireFormat::IndexEntryBatch::Response>();
+    if (respHdr == NULL)
+        return STATUS_RETRY;
+    if (respHdr->common.status != STATUS_OK)
+        return respHdr->common.status;
+    const Status* status = response->getOffset<Status>(
+            sizeof32(*respHdr) + index * sizeof32(Status));
+    if (status == NULL)
+        return STATUS_RETRY;
+    return *status;
+}
+
+/**
+ * Start the rpc once all of its entries have been added.
+ */
+void
+IndexEntryBatchRpc::send()
+{
+    request.getStart<WireFormat::IndexEntryBatch::Request>()->count = count;
+    RpcWrapper::send();
+}
+
+// See RpcWrapper for documentation.
+bool
+IndexEntryBatchRpc::handleTransportError()
+{
+    // Give up; the caller redoes the entries one at a time, and those rpcs
+    // will find the indexlets' new homes.
+    return true;
+}
+
 /**
  * This RPC is sent to an index server to request that it insert an index
  * entry in an indexlet it holds.
@@ -378,6 +621,73 @@ IsReplicaNeededRpc::wait()
     return respHdr->needed;
 }
 
+/**
+ * Ask a master to move one of its tablets to another master. This is the
+ * same operation as RamCloud::migrateTablet, except that the RPC goes to
+ * a particular server rather than to whoever owns the tablet. It returns
+ * once the migration has finished.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that currently owns the tablet.
+ * \param tableId
+ *      Identifier for the table containing the tablet.
+ * \param firstKeyHash
+ *      Smallest key hash in the tablet; the tablet must exist with exactly
+ *      this range on \a serverId (see splitMasterTablet).
+ * \param lastKeyHash
+ *      Largest key hash in the tablet.
+ * \param newOwnerId
+ *      Identifier for the master that should own the tablet afterwards.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+MasterClient::migrateTablet(Context* context, ServerId serverId,
+        uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+        ServerId newOwnerId)
+{
+    MasterMigrateTabletRpc rpc(context, serverId, tableId, firstKeyHash,
+            lastKeyHash, newOwnerId);
+    rpc.wait();
+}
+
+/**
+ * Constructor for MasterMigrateTabletRpc: initiates an RPC in the same way
+ * as #MasterClient::migrateTablet, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master that currently owns the tablet.
+ * \param tableId
+ *      Identifier for the table containing the tablet.
+ * \param firstKeyHash
+ *      Smallest key hash in the tablet.
+ * \param lastKeyHash
+ *      Largest key hash in the tablet.
+ * \param newOwnerId
+ *      Identifier for the master that should own the tablet afterwards.
+ */
+MasterMigrateTabletRpc::MasterMigrateTabletRpc(Context* context,
+        ServerId serverId, uint64_t tableId, uint64_t firstKeyHash,
+        uint64_t lastKeyHash, ServerId newOwnerId)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::MigrateTablet::Response))
+{
+    WireFormat::MigrateTablet::Request* reqHdr(
+            allocHeader<WireFormat::MigrateTablet>());
+    reqHdr->tableId = tableId;
+    reqHdr->firstKeyHash = firstKeyHash;
+    reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->newOwnerMasterId = newOwnerId.getId();
+    send();
+}
+
 /**
  * Request that a master decide whether it will accept a migrated indexlet
  * and set up any necessary state to begin receiving indexlet data from the
@@ -519,9 +829,113 @@ PrepForMigrationRpc::PrepForMigrationRpc(Context* context, ServerId serverId,
     reqHdr->tableId = tableId;
     reqHdr->firstKeyHash = firstKeyHash;
     reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->keyHash = downCast<uint8_t>(Key::getHashFunction(tableId));
+    send();
+}
+
+/**
+ * Fetch the changes made to a table on a master since a given position in
+ * its log, in the order they were made (see ObjectManager::readLogChanges).
+ * This lets other systems follow a table's contents without enumerating it
+ * over and over: start from MasterClient::getHeadOfLog after taking a full
+ * copy, then call this repeatedly.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master; changes are only returned for the tablets
+ *      of the table it owns.
+ * \param tableId
+ *      Identifier for the table.
+ * \param[in,out] position
+ *      Position in the master's log from which to return changes. Updated to
+ *      the position to pass in the next call.
+ * \param maxBytes
+ *      Most bytes of changes to return (at least one change is returned if
+ *      there is any).
+ * \param[out] changes
+ *      Filled in with the changes, each a WireFormat::ReadLogChanges::Change
+ *      header followed by a log entry: an object, tombstone or object delta.
+ *
+ * \return
+ *      False means the master's cleaner dropped some of the changes after
+ *      \a position before they could be read; \a changes is empty and the
+ *      caller has to start over from a full copy of the table.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+bool
+MasterClient::readLogChanges(Context* context, ServerId serverId,
+        uint64_t tableId, LogPosition* position, uint32_t maxBytes,
+        Buffer* changes)
+{
+    ReadLogChangesRpc rpc(context, serverId, tableId, *position, maxBytes,
+            changes);
+    return rpc.wait(position);
+}
+
+/**
+ * Constructor for ReadLogChangesRpc: initiates an RPC in the same way as
+ * #MasterClient::readLogChanges, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param context
+ *      Overall information about this RAMCloud server or client.
+ * \param serverId
+ *      Identifier for the master.
+ * \param tableId
+ *      Identifier for the table.
+ * \param position
+ *      Position in the master's log from which to return changes.
+ * \param maxBytes
+ *      Most bytes of changes to return.
+ * \param[out] changes
+ *      Filled in with the changes once the RPC completes.
+ */
+ReadLogChangesRpc::ReadLogChangesRpc(Context* context, ServerId serverId,
+        uint64_t tableId, LogPosition position, uint32_t maxBytes,
+        Buffer* changes)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::ReadLogChanges::Response), changes)
+{
+    changes->reset();
+    WireFormat::ReadLogChanges::Request* reqHdr(
+            allocHeader<WireFormat::ReadLogChanges>(serverId));
+    reqHdr->tableId = tableId;
+    reqHdr->segmentId = position.getSegmentId();
+    reqHdr->segmentOffset = position.getSegmentOffset();
+    reqHdr->maxBytes = maxBytes;
     send();
 }
 
+/**
+ * Wait for a readLogChanges RPC to complete.
+ *
+ * \param[out] position
+ *      Set to the position to pass in the next call, unless changes were
+ *      lost.
+ * \return
+ *      False if changes were lost; see MasterClient::readLogChanges.
+ *
+ * \throw ServerNotUpException
+ *      The intended server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+bool
+ReadLogChangesRpc::wait(LogPosition* position)
+{
+    waitAndCheckErrors();
+    const WireFormat::ReadLogChanges::Response* respHdr(
+            getResponseHeader<WireFormat::ReadLogChanges>());
+    bool changesLost = respHdr->changesLost;
+    if (!changesLost)
+        *position = {respHdr->segmentId, respHdr->segmentOffset};
+    response->truncateFront(sizeof(*respHdr));
+    return !changesLost;
+}
+
 /**
  * Request that a master add some migrated data to its storage.
  * The receiving master will not service requests on the data,
@@ -955,6 +1369,7 @@ TakeTabletOwnershipRpc::TakeTabletOwnershipRpc(
     reqHdr->tableId = tableId;
     reqHdr->firstKeyHash = firstKeyHash;
     reqHdr->lastKeyHash = lastKeyHash;
+    reqHdr->keyHash = downCast<uint8_t>(Key::getHashFunction(tableId));
     send();
 }
 
@@ -1113,4 +1528,72 @@ TxHintFailedRpc::TxHintFailedRpc(
     send();
 }
 
+/**
+ * Give another master a read replica of a hot object, or tell it that the
+ * object has changed or been removed (see HotKeyReplicator).
+ *
+ * \param context
+ *      Overall information about this RAMCloud server.
+ * \param serverId
+ *      Identifier for the master that holds (or is to hold) the replica.
+ * \param tableId
+ *      Table containing the object.
+ * \param key
+ *      Primary key of the object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param value
+ *      Current value of the object; ignored if \a remove is true.
+ * \param length
+ *      Size in bytes of the value.
+ * \param version
+ *      Version of the object.
+ * \param leaseMicros
+ *      The replica may be served for this long after it is received.
+ * \param remove
+ *      True means the object was removed, so the replica is dropped.
+ *
+ * \throw ServerNotUpException
+ *      The target server for this RPC is not part of the cluster;
+ *      if it ever existed, it has since crashed.
+ */
+void
+MasterClient::updateHotReplica(Context* context, ServerId serverId,
+        uint64_t tableId, const void* key, uint16_t keyLength,
+        const void* value, uint32_t length, uint64_t version,
+        uint32_t leaseMicros, bool remove)
+{
+    UpdateHotReplicaRpc rpc(context, serverId, tableId, key, keyLength,
+            value, length, version, leaseMicros, remove);
+    rpc.wait();
+}
+
+/**
+ * Constructor for UpdateHotReplicaRpc: initiates an RPC in the same way as
+ * #MasterClient::updateHotReplica, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \copydetails MasterClient::updateHotReplica
+ */
+UpdateHotReplicaRpc::UpdateHotReplicaRpc(Context* context, ServerId serverId,
+        uint64_t tableId, const void* key, uint16_t keyLength,
+        const void* value, uint32_t length, uint64_t version,
+        uint32_t leaseMicros, bool remove)
+    : ServerIdRpcWrapper(context, serverId,
+            sizeof(WireFormat::UpdateHotReplica::Response))
+{
+    WireFormat::UpdateHotReplica::Request* reqHdr(
+            allocHeader<WireFormat::UpdateHotReplica>(serverId));
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->length = remove ? 0 : length;
+    reqHdr->version = version;
+    reqHdr->leaseMicros = leaseMicros;
+    reqHdr->remove = remove;
+    request.append(key, keyLength);
+    if (!remove)
+        request.append(value, length);
+    send();
+}
+
 }  // namespace RAMCloud
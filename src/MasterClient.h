@@ -49,19 +49,29 @@ class MasterClient {
             uint16_t firstNotOwnedKeyLength);
     static void dropTabletOwnership(Context* context, ServerId serverId,
             uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
+    static LogPosition getDurablePosition(Context* context, ServerId serverId,
+            LogPosition target = LogPosition());
     static LogPosition getHeadOfLog(Context* context, ServerId serverId);
+    static void getTabletStatistics(Context* context, ServerId serverId,
+            ProtoBuf::ServerStatistics* serverStats);
     static void insertIndexEntry(Context* context,
             uint64_t tableId, uint8_t indexId,
             const void* indexKey, KeyLength indexKeyLength,
             uint64_t primaryKeyHash);
     static bool isReplicaNeeded(Context* context, ServerId serverId,
             ServerId backupServerId, uint64_t segmentId);
+    static void migrateTablet(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId newOwnerId);
     static void prepForIndexletMigration(Context* context, ServerId serverId,
             uint64_t tableId, uint8_t indexId, uint64_t backingTableId,
             const void* firstKey, uint16_t firstKeyLength,
             const void* firstNotOwnedKey, uint16_t firstNotOwnedKeyLength);
     static void prepForMigration(Context* context, ServerId serverId,
             uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash);
+    static bool readLogChanges(Context* context, ServerId serverId,
+            uint64_t tableId, LogPosition* position, uint32_t maxBytes,
+            Buffer* changes);
     static void recover(Context* context, ServerId serverId,
             uint64_t recoveryId, ServerId crashedServerId,
             uint64_t partitionId,
@@ -93,6 +103,10 @@ class MasterClient {
     static void txHintFailed(Context* context, uint64_t tableId,
             uint64_t keyHash, uint64_t leaseId, uint64_t clientTransactionId,
             uint32_t participantCount, WireFormat::TxParticipant *participants);
+    static void updateHotReplica(Context* context, ServerId serverId,
+            uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* value, uint32_t length, uint64_t version,
+            uint32_t leaseMicros, bool remove);
 
   private:
     MasterClient();
@@ -132,6 +146,23 @@ class DropTabletOwnershipRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(DropTabletOwnershipRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::getDurablePosition
+ * request, allowing it to execute asynchronously. With a target position,
+ * the RPC completes when the master's log is durable up to it, so an
+ * outstanding one serves as a notification that earlier writes are safe.
+ */
+class GetDurablePositionRpc : public ServerIdRpcWrapper {
+  public:
+    GetDurablePositionRpc(Context* context, ServerId serverId,
+            LogPosition target = LogPosition());
+    ~GetDurablePositionRpc() {}
+    LogPosition wait();
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(GetDurablePositionRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::getHeadOfLog
  * request, allowing it to execute asynchronously.
@@ -146,6 +177,51 @@ class GetHeadOfLogRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(GetHeadOfLogRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::getTabletStatistics
+ * request, allowing it to execute asynchronously.
+ */
+class GetTabletStatisticsRpc : public ServerIdRpcWrapper {
+  public:
+    GetTabletStatisticsRpc(Context* context, ServerId serverId);
+    ~GetTabletStatisticsRpc() {}
+    void wait(ProtoBuf::ServerStatistics* serverStats);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(GetTabletStatisticsRpc);
+};
+
+/**
+ * Carries several index entry insertions and removals from a data master to
+ * one index server in a single rpc. Unlike the other wrappers the rpc isn't
+ * sent by the constructor: the caller adds entries with appendEntry() and
+ * then calls send(). Nothing is retried here, not even on the failure of the
+ * session; IndexEntryBatcher redoes any entry that didn't succeed with an
+ * InsertIndexEntryRpc or RemoveIndexEntryRpc, which know how to find the
+ * right server.
+ */
+class IndexEntryBatchRpc : public RpcWrapper {
+  public:
+    explicit IndexEntryBatchRpc(Transport::SessionRef session);
+    ~IndexEntryBatchRpc() {}
+    void appendEntry(uint64_t tableId, uint8_t indexId,
+            const void* indexKey, KeyLength indexKeyLength,
+            uint64_t primaryKeyHash, bool remove);
+    /// Return the number of entries added with appendEntry().
+    uint32_t getEntryCount() const { return count; }
+    Status getStatus(uint32_t index);
+    void send();
+
+  PROTECTED:
+    virtual bool handleTransportError();
+
+  PRIVATE:
+    /// Number of entries added with appendEntry().
+    uint32_t count;
+
+    DISALLOW_COPY_AND_ASSIGN(IndexEntryBatchRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::insertIndexEntry
  * request, allowing it to execute asynchronously.
@@ -179,6 +255,23 @@ class IsReplicaNeededRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(IsReplicaNeededRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::migrateTablet
+ * request, allowing it to execute asynchronously.
+ */
+class MasterMigrateTabletRpc : public ServerIdRpcWrapper {
+  public:
+    MasterMigrateTabletRpc(Context* context, ServerId serverId,
+            uint64_t tableId, uint64_t firstKeyHash, uint64_t lastKeyHash,
+            ServerId newOwnerId);
+    ~MasterMigrateTabletRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(MasterMigrateTabletRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::prepForIndexletMigration
  * request, allowing it to execute asynchronously.
@@ -214,6 +307,21 @@ class PrepForMigrationRpc : public ServerIdRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(PrepForMigrationRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::readLogChanges
+ * request, allowing it to execute asynchronously.
+ */
+class ReadLogChangesRpc : public ServerIdRpcWrapper {
+  public:
+    ReadLogChangesRpc(Context* context, ServerId serverId, uint64_t tableId,
+            LogPosition position, uint32_t maxBytes, Buffer* changes);
+    ~ReadLogChangesRpc() {}
+    bool wait(LogPosition* position);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ReadLogChangesRpc);
+};
+
 /**
  * Encapsulates the state of a MasterClient::receiveMigrationData
  * request, allowing it to execute asynchronously.
@@ -355,6 +463,24 @@ class TxHintFailedRpc : public ObjectRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(TxHintFailedRpc);
 };
 
+/**
+ * Encapsulates the state of a MasterClient::updateHotReplica
+ * request, allowing it to execute asynchronously.
+ */
+class UpdateHotReplicaRpc : public ServerIdRpcWrapper {
+  public:
+    UpdateHotReplicaRpc(Context* context, ServerId serverId,
+            uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* value, uint32_t length, uint64_t version,
+            uint32_t leaseMicros, bool remove);
+    ~UpdateHotReplicaRpc() {}
+    /// \copydoc ServerIdRpcWrapper::waitAndCheckErrors
+    void wait() {waitAndCheckErrors();}
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(UpdateHotReplicaRpc);
+};
+
 } // namespace RAMCloud
 
 #endif // RAMCLOUD_MASTERCLIENT_H
@@ -14,6 +14,7 @@
  */
 
 #include "MasterRecoveryManager.h"
+#include "Cycles.h"
 #include "ShortMacros.h"
 
 namespace RAMCloud {
@@ -47,10 +48,13 @@ class MaybeStartRecoveryTask : public Task {
     void performTask()
     {
         std::vector<Recovery*> alreadyActive;
-        while (!mgr.waitingRecoveries.empty() &&
-               mgr.activeRecoveries.size() < mgr.maxActiveRecoveries)
-        {
+        while (!mgr.waitingRecoveries.empty()) {
             Recovery* recovery = mgr.waitingRecoveries.front();
+            // The recoveries of a whole-cluster restart all run at once so
+            // that backups read their storage once for all of them.
+            if (!recovery->coldStart &&
+                mgr.activeRecoveries.size() >= mgr.maxActiveRecoveries)
+                break;
             // Do not allow two recoveries for the same crashed master
             // at the same time. This can happen if one recovery fails
             // and schedules another. The second may get started before
@@ -132,9 +136,11 @@ class EnqueueMasterRecoveryTask : public Task {
      */
     void performTask()
     {
+        bool coldStart = mgr.clusterRestart && !mgr.coldStartFinished;
         mgr.waitingRecoveries.push(new Recovery(mgr.context, mgr.taskQueue,
                                 &mgr.tableManager, &mgr.tracker,
-                                &mgr, crashedServerId, masterRecoveryInfo));
+                                &mgr, crashedServerId, masterRecoveryInfo,
+                                mgr.onDemandRecovery, coldStart));
         (new MaybeStartRecoveryTask(mgr))->schedule();
         delete this;
     }
@@ -221,29 +227,32 @@ class RecoveryMasterFinishedTask : public Task {
 
         if (successful) {
             // Update tablet map to point to new owner and mark as available.
+            // All of the tablets are updated at once, so that each table
+            // is only written to external storage once.
+            vector<Tablet> recovered;
             foreach (const auto& tablet, recoveryPartition.tablet()) {
                 // The caller has filled in recoveryPartition with new service
                 // locator and server id of the recovery master, so just copy
                 // it over.  Record the log position of the recovery master at
                 // creation of this new tablet assignment. The value is the
                 // position of the head at the very start of recovery.
-                try {
-                    LOG(DEBUG, "Modifying tablet map to set recovery master %s "
-                        "as master for %lu, %lu, %lu",
-                        ServerId(tablet.server_id()).toString().c_str(),
-                        tablet.table_id(), tablet.start_key_hash(),
-                        tablet.end_key_hash());
-                    mgr.tableManager.tabletRecovered(
-                        tablet.table_id(),
-                        tablet.start_key_hash(), tablet.end_key_hash(),
-                        ServerId(tablet.server_id()),
-                        {tablet.ctime_log_head_id(),
-                                tablet.ctime_log_head_offset()});
-                } catch (const Exception& e) {
-                    // JIRA Issue: RAM-661: What should we do here?
-                    DIE("Entry wasn't in the list anymore; "
-                        "we need to handle this sensibly");
-                }
+                LOG(DEBUG, "Modifying tablet map to set recovery master %s "
+                    "as master for %lu, %lu, %lu",
+                    ServerId(tablet.server_id()).toString().c_str(),
+                    tablet.table_id(), tablet.start_key_hash(),
+                    tablet.end_key_hash());
+                recovered.emplace_back(tablet.table_id(),
+                    tablet.start_key_hash(), tablet.end_key_hash(),
+                    ServerId(tablet.server_id()), Tablet::NORMAL,
+                    LogPosition(tablet.ctime_log_head_id(),
+                                tablet.ctime_log_head_offset()));
+            }
+            try {
+                mgr.tableManager.tabletsRecovered(recovered);
+            } catch (const Exception& e) {
+                // JIRA Issue: RAM-661: What should we do here?
+                DIE("Entry wasn't in the list anymore; "
+                    "we need to handle this sensibly");
             }
 
             foreach (const auto& indexlet, recoveryPartition.indexlet()) {
@@ -386,8 +395,14 @@ MasterRecoveryManager::MasterRecoveryManager(Context* context,
     , waitingRecoveries()
     , activeRecoveries()
     , maxActiveRecoveries(1u)
+    , onDemandRecovery(false)
+    , clusterRestart(false)
+    , coldStartFinished(false)
     , taskQueue()
     , tracker(context, this)
+    , retryMutex()
+    , retries()
+    , retryTimer(this)
     , doNotStartRecoveries(false)
     , startRecoveriesEvenIfNoThread(false)
     , skipRescheduleDelay(false)
@@ -446,6 +461,53 @@ MasterRecoveryManager::halt()
     thread.destroy();
 }
 
+/**
+ * Change the number of recoveries that may run at once. This is invoked
+ * during coordinator startup, before any recoveries start.
+ *
+ * \param max
+ *      Maximum number of recoveries to have in progress at once; 0 is
+ *      treated as 1.
+ */
+void
+MasterRecoveryManager::setMaxActiveRecoveries(uint32_t max)
+{
+    maxActiveRecoveries = std::max(max, 1u);
+}
+
+/**
+ * Choose whether recovery masters serve reads on demand while they replay
+ * (see Recovery::onDemand). This is invoked during coordinator startup,
+ * before any recoveries start; the recovery masters must be configured
+ * the same way (see ServerConfig::Master::onDemandRecovery).
+ *
+ * \param enabled
+ *      True means direct clients to recovery masters as soon as they start.
+ */
+void
+MasterRecoveryManager::setOnDemandRecovery(bool enabled)
+{
+    onDemandRecovery = enabled;
+}
+
+/**
+ * Choose whether the coordinator is bringing up a whole cluster that was
+ * shut down, in which case the recoveries of all of its old masters are
+ * carried out together as a cold start (see Recovery::coldStart): every
+ * recovery enqueued until the first of them finishes runs at once,
+ * regardless of #maxActiveRecoveries, and each backup reads all of the
+ * replicas it holds for these masters in a single pass over its storage.
+ * This is invoked during coordinator startup, before any recoveries start.
+ *
+ * \param enabled
+ *      True means recover the masters of the previous cluster together.
+ */
+void
+MasterRecoveryManager::setClusterRestart(bool enabled)
+{
+    clusterRestart = enabled;
+}
+
 /**
  * Mark the tablets belonging to a now crashed server as RECOVERING and enqueue
  * the recovery of the crashed master's tablets; actual recovery happens
@@ -501,7 +563,7 @@ class ApplyTrackerChangesTask : public Task {
             if (event == SERVER_CRASHED || event == SERVER_REMOVED) {
                 Recovery* recovery = mgr.tracker[server.serverId];
                 if (!recovery)
-                    break;
+                    continue;
                 LOG(NOTICE, "Recovery master %s crashed while recovering "
                     "a partition of server %s",
                     server.serverId.toString().c_str(),
@@ -556,6 +618,8 @@ MasterRecoveryManager::recoveryFinished(Recovery* recovery)
         recovery->getRecoveryId(),
         recovery->crashedServerId.toString().c_str(),
         activeRecoveries.size() - 1);
+    if (recovery->coldStart)
+        coldStartFinished = true;
     if (recovery->wasCompletelySuccessful()) {
         // Remove recovered server from the server list and broadcast
         // the change to the cluster.
@@ -575,16 +639,22 @@ MasterRecoveryManager::recoveryFinished(Recovery* recovery)
 
         // Delay a while before rescheduling; otherwise the coordinator
         // will flood its log with recovery messages in situations
-        // were there aren't enough resources to recover.
-        if (!skipRescheduleDelay) {
-            usleep(2000000);
+        // were there aren't enough resources to recover. The delay is
+        // handled by #retryTimer so that other recoveries can make
+        // progress in the meantime.
+        if (skipRescheduleDelay) {
+            // Enqueue will schedule a MaybeStartRecoveryTask.
+            (new EnqueueMasterRecoveryTask(*this,
+                                           recovery->crashedServerId,
+                                           recovery->masterRecoveryInfo))->
+                                                                schedule();
+        } else {
+            std::lock_guard<std::mutex> _(retryMutex);
+            retries.emplace_back(Cycles::rdtsc() + Cycles::fromSeconds(2.0),
+                    recovery->crashedServerId, recovery->masterRecoveryInfo);
+            if (!retryTimer.isRunning())
+                retryTimer.start(retries.front().time);
         }
-
-        // Enqueue will schedule a MaybeStartRecoveryTask.
-        (new EnqueueMasterRecoveryTask(*this,
-                                       recovery->crashedServerId,
-                                       recovery->masterRecoveryInfo))->
-                                                            schedule();
     }
 
     activeRecoveries.erase(recovery->getRecoveryId());
@@ -651,6 +721,37 @@ MasterRecoveryManager::recoveryMasterFinished(
 
 // - private -
 
+/**
+ * Construct a RetryTimer; it does nothing until started.
+ *
+ * \param mgr
+ *      The manager whose #retries this timer reschedules.
+ */
+MasterRecoveryManager::RetryTimer::RetryTimer(MasterRecoveryManager* mgr)
+    : WorkerTimer(mgr->context->dispatch)
+    , mgr(mgr)
+{
+}
+
+/**
+ * Enqueue each of the recoveries in #retries whose time has come, and
+ * restart the timer for the next one, if any.
+ */
+void
+MasterRecoveryManager::RetryTimer::handleTimerEvent()
+{
+    std::lock_guard<std::mutex> _(mgr->retryMutex);
+    uint64_t now = Cycles::rdtsc();
+    while (!mgr->retries.empty() && mgr->retries.front().time <= now) {
+        const Retry& retry = mgr->retries.front();
+        (new EnqueueMasterRecoveryTask(*mgr, retry.crashedServerId,
+                                       retry.masterRecoveryInfo))->schedule();
+        mgr->retries.pop_front();
+    }
+    if (!mgr->retries.empty())
+        start(mgr->retries.front().time);
+}
+
 /**
  * Drive the next step in any ongoing recoveries; start new
  * recoveries if they were blocked on other recoveries. Exits
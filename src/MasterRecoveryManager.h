@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_MASTERRECOVERYMANAGER_H
 #define RAMCLOUD_MASTERRECOVERYMANAGER_H
 
+#include <deque>
+#include <mutex>
 #include <thread>
 
 #include "CoordinatorServerList.h"
@@ -25,6 +27,7 @@
 #include "ServerTracker.h"
 #include "TableManager.h"
 #include "Tub.h"
+#include "WorkerTimer.h"
 
 namespace RAMCloud {
 
@@ -58,6 +61,9 @@ class MasterRecoveryManager : public Recovery::Owner
 
     void start();
     void halt();
+    void setMaxActiveRecoveries(uint32_t max);
+    void setOnDemandRecovery(bool enabled);
+    void setClusterRestart(bool enabled);
 
     void startMasterRecovery(CoordinatorServerList::Entry crashedServer);
     bool recoveryMasterFinished(uint64_t recoveryId,
@@ -71,6 +77,39 @@ class MasterRecoveryManager : public Recovery::Owner
     virtual void recoveryFinished(Recovery* recovery);
 
   PRIVATE:
+    /**
+     * Reschedules recoveries that failed to recover everything once a delay
+     * has passed; see recoveryFinished.
+     */
+    class RetryTimer : public WorkerTimer {
+      public:
+        explicit RetryTimer(MasterRecoveryManager* mgr);
+        virtual void handleTimerEvent();
+
+        /// The manager whose #retries this timer reschedules.
+        MasterRecoveryManager* mgr;
+
+        DISALLOW_COPY_AND_ASSIGN(RetryTimer);
+    };
+
+    /// A failed recovery waiting to be retried; see #retries.
+    struct Retry {
+        Retry(uint64_t time, ServerId crashedServerId,
+              const ProtoBuf::MasterRecoveryInfo& masterRecoveryInfo)
+            : time(time)
+            , crashedServerId(crashedServerId)
+            , masterRecoveryInfo(masterRecoveryInfo)
+        {}
+
+        /// Cycles::rdtsc() time at which to retry.
+        uint64_t time;
+
+        /// The server to recover, and its recovery info as of the failed
+        /// recovery (see EnqueueMasterRecoveryTask).
+        ServerId crashedServerId;
+        ProtoBuf::MasterRecoveryInfo masterRecoveryInfo;
+    };
+
     void main();
 
     /// Shared RAMCloud information.
@@ -104,16 +143,33 @@ class MasterRecoveryManager : public Recovery::Owner
      * Recoveries which are actively in progress in the cluster.  Maps recovery
      * ids to an ongoing recovery. Used to reassociate recovery masters which
      * finished recovery to the recovery that was recovering them.  The size of
-     * this map is less than or equal to #maxActiveRecoveries at all times.
+     * this map is less than or equal to #maxActiveRecoveries, except during a
+     * cold start (see setClusterRestart).
      */
     RecoveryMap activeRecoveries;
 
     /**
-     * Maximum number of concurrent recoveries to attempt. Right now anything
-     * higher than 1 will fail (likely with deadlock).
+     * Maximum number of concurrent recoveries to attempt. Concurrent
+     * recoveries share the cluster's masters: each choice of recovery
+     * masters only considers masters that aren't already recovering a
+     * partition for another recovery, and partitions that can't get a
+     * recovery master are retried in a follow up recovery.
      */
     uint32_t maxActiveRecoveries;
 
+    /// Passed to each new Recovery; see Recovery::onDemand.
+    bool onDemandRecovery;
+
+    /// True means the first recoveries are a cold start; see
+    /// setClusterRestart.
+    bool clusterRestart;
+
+    /**
+     * Set once the first cold start recovery has finished; recoveries
+     * enqueued after that (including follow ups) are ordinary ones.
+     */
+    bool coldStartFinished;
+
     /**
      * Enqueues recoveries that are ready to take steps toward completion
      * and makes progress on enqueued recoveries whenever
@@ -131,6 +187,21 @@ class MasterRecoveryManager : public Recovery::Owner
      */
     RecoveryTracker tracker;
 
+    /// Protects #retries, which is also used by #retryTimer's handler.
+    std::mutex retryMutex;
+
+    /**
+     * Recoveries that failed to recover all of their tablets and will be
+     * retried once their time comes, oldest first. Failed recoveries are
+     * retried after a delay so that the coordinator doesn't flood its log
+     * when there aren't enough resources to recover, but the delay mustn't
+     * hold up #taskQueue, or it would stall all of the other recoveries.
+     */
+    std::deque<Retry> retries;
+
+    /// Enqueues the recoveries in #retries when their times come.
+    RetryTimer retryTimer;
+
     /**
      * Prevents startMasterRecovery() from actually starting recovery and,
      * instead, logs arguments to the call. Used for unit testing.
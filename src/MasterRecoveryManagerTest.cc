@@ -209,6 +209,19 @@ TEST_F(MasterRecoveryManagerTest, recoveryFinished) {
     EXPECT_EQ(0lu, mgr->activeRecoveries.size());
 }
 
+TEST_F(MasterRecoveryManagerTest, recoveryFinished_coldStart) {
+    Lock lock(mutex); // For calls to internal functions without real lock.
+    ServerId serverId = addMaster(lock, ServerStatus::CRASHED);
+    Recovery* recovery = new Recovery(&context, mgr->taskQueue, tableManager,
+                                      &mgr->tracker, NULL, serverId, {},
+                                      false, true);
+    mgr->activeRecoveries[recovery->recoveryId] = recovery;
+    recovery->status = Recovery::ALL_RECOVERY_MASTERS_FINISHED;
+    EXPECT_FALSE(mgr->coldStartFinished);
+    mgr->recoveryFinished(recovery);
+    EXPECT_TRUE(mgr->coldStartFinished);
+}
+
 TEST_F(MasterRecoveryManagerTest, recoveryFinishedUnsuccessful) {
     Lock lock(mutex); // For calls to internal functions without real lock.
     EXPECT_EQ(0lu, serverList->version);
@@ -229,6 +242,34 @@ TEST_F(MasterRecoveryManagerTest, recoveryFinishedUnsuccessful) {
     EXPECT_EQ(0lu, mgr->activeRecoveries.size());
 }
 
+TEST_F(MasterRecoveryManagerTest, recoveryFinishedUnsuccessful_delayed) {
+    Lock lock(mutex); // For calls to internal functions without real lock.
+    ServerId serverId = addMaster(lock, ServerStatus::CRASHED);
+    Recovery* recovery = new Recovery(&context, mgr->taskQueue, tableManager,
+                                      &mgr->tracker, NULL, serverId,  {});
+    recovery->unsuccessfulRecoveryMasters = 1;
+    mgr->skipRescheduleDelay = false;
+    ASSERT_EQ(0lu, mgr->taskQueue.outstandingTasks());
+    mgr->recoveryFinished(recovery);
+
+    // Nothing is enqueued until the timer fires, and then only the
+    // recoveries whose time has come.
+    EXPECT_EQ(0lu, mgr->taskQueue.outstandingTasks());
+    EXPECT_EQ(0lu, mgr->activeRecoveries.size());
+    ASSERT_EQ(1lu, mgr->retries.size());
+    EXPECT_TRUE(mgr->retryTimer.isRunning());
+    mgr->retryTimer.stop();
+    mgr->retries.emplace_back(~0lu, ServerId(5, 0),
+                              ProtoBuf::MasterRecoveryInfo());
+    mgr->retries.front().time = 0;
+    mgr->retryTimer.handleTimerEvent();
+    EXPECT_EQ(1lu, mgr->taskQueue.outstandingTasks());
+    ASSERT_EQ(1lu, mgr->retries.size());
+    EXPECT_EQ(ServerId(5, 0), mgr->retries.front().crashedServerId);
+    EXPECT_TRUE(mgr->retryTimer.isRunning());
+    mgr->retryTimer.stop();
+}
+
 TEST_F(MasterRecoveryManagerTest, recoveryMasterFinishedNoSuchRecovery) {
     Lock lock(mutex); // For calls to internal functions without real lock.
     ServerId serverId = addMaster(lock, ServerStatus::CRASHED);
@@ -432,6 +473,46 @@ TEST_F(MasterRecoveryManagerTest,
     EXPECT_EQ(2lu, mgr->activeRecoveries.size());
 }
 
+TEST_F(MasterRecoveryManagerTest, MaybeStartRecoveryTask_coldStart) {
+    Lock lock(mutex); // For calls to internal functions without real lock.
+    tableManager->testCreateTable("t0", 0);
+    tableManager->testCreateTable("t1", 1);
+    tableManager->testCreateTable("t2", 2);
+    tableManager->testAddTablet({0, 0, ~0lu, {1, 0}, Tablet::NORMAL, {2, 3}});
+    tableManager->testAddTablet({1, 0, ~0lu, {2, 0}, Tablet::NORMAL, {2, 3}});
+    tableManager->testAddTablet({2, 0, ~0lu, {3, 0}, Tablet::NORMAL, {2, 3}});
+
+    ServerId id1 = addMaster(lock, ServerStatus::CRASHED);
+    ServerId id2 = addMaster(lock, ServerStatus::CRASHED);
+    ServerId id3 = addMaster(lock, ServerStatus::CRASHED);
+
+    mgr->setClusterRestart(true);
+    mgr->startMasterRecovery((*serverList)[id1]);
+    mgr->startMasterRecovery((*serverList)[id2]);
+    mgr->taskQueue.performTask();
+    mgr->taskQueue.performTask();
+    mgr->coldStartFinished = true;
+    mgr->startMasterRecovery((*serverList)[id3]);
+    mgr->taskQueue.performTask();
+    // Three MaybeStartRecoveryTasks now on taskQueue.
+
+    EXPECT_EQ(1u, mgr->maxActiveRecoveries);
+    EXPECT_EQ(3lu, mgr->waitingRecoveries.size());
+    TestLog::Enable _;
+    mgr->taskQueue.performTask();
+    EXPECT_EQ("schedule: scheduled | "
+              "performTask: Starting recovery of server 1.0 "
+                  "(now 1 active recoveries) | "
+              "schedule: scheduled | "
+              "performTask: Starting recovery of server 2.0 "
+                  "(now 2 active recoveries) | "
+              "performTask: 1 recoveries blocked waiting for other recoveries",
+              TestLog::get());
+    EXPECT_FALSE(mgr->waitingRecoveries.front()->coldStart);
+    foreach (const auto& active, mgr->activeRecoveries)
+        EXPECT_TRUE(active.second->coldStart);
+}
+
 TEST_F(MasterRecoveryManagerTest,
        MaybeStartRecoveryTaskServerAlreadyRecovering)
 {
@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <exception>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -22,12 +23,16 @@
 #include "Dispatch.h"
 #include "Enumeration.h"
 #include "EnumerationIterator.h"
+#include "FlatTableConfig.h"
+#include "FrameCompression.h"
 #include "IndexKey.h"
 #include "LogIterator.h"
 #include "LogProtector.h"
 #include "MasterClient.h"
 #include "MasterService.h"
+#include "MigrationSender.h"
 #include "ObjectBuffer.h"
+#include "ParallelSegmentReplay.h"
 #include "PerfCounter.h"
 #include "ProtoBuf.h"
 #include "RawMetrics.h"
@@ -85,10 +90,13 @@ MasterService::MasterService(Context* context, const ServerConfig* config)
                     &masterTableMetadata,
                     &unackedRpcResults,
                     &transactionManager,
-                    &txRecoveryManager)
+                    &txRecoveryManager,
+                    &clusterClock)
     , tabletManager()
     , txRecoveryManager(context)
-    , indexletManager(context, &objectManager)
+    , indexletManager(context, &objectManager,
+                      config->master.inMemoryIndexlets)
+    , indexEntryBatcher(context)
     , clusterClock()
     , clientLeaseValidator(context, &clusterClock)
     , unackedRpcResults(context,
@@ -99,12 +107,22 @@ MasterService::MasterService(Context* context, const ServerConfig* config)
                          objectManager.getLog(),
                          &unackedRpcResults,
                          &tabletManager)
+    , tableConfigCache(context)
     , disableCount(0)
     , initCalled(false)
     , logEverSynced(false)
     , masterTableMetadata()
     , maxResponseRpcLen(Transport::MAX_RPC_LEN)
     , migrationMonitor(this)
+    , pendingIncrementsLock("MasterService::pendingIncrementsLock")
+    , pendingIncrements()
+    , hotKeySketch(config->master.hotKeySampleInterval)
+    , hotKeyReplicator(context, &serverId, &hotKeySketch, &tabletManager,
+            config->master.hotKeyReplicas)
+    , onDemandRecovery(context)
+    , openSnapshotsLock("MasterService::openSnapshotsLock")
+    , openSnapshots()
+    , nextSnapshotId(generateRandom())
 {
     context->services[WireFormat::MASTER_SERVICE] = this;
 }
@@ -134,6 +152,14 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
     }
 
     switch (opcode) {
+        case WireFormat::Append::opcode:
+            callHandler<WireFormat::Append, MasterService,
+                        &MasterService::append>(rpc);
+            break;
+        case WireFormat::BulkLoad::opcode:
+            callHandler<WireFormat::BulkLoad, MasterService,
+                        &MasterService::bulkLoad>(rpc);
+            break;
         case WireFormat::DropTabletOwnership::opcode:
             callHandler<WireFormat::DropTabletOwnership, MasterService,
                         &MasterService::dropTabletOwnership>(rpc);
@@ -150,6 +176,14 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::Enumerate, MasterService,
                         &MasterService::enumerate>(rpc);
             break;
+        case WireFormat::GetCachedTableConfig::opcode:
+            callHandler<WireFormat::GetCachedTableConfig, MasterService,
+                        &MasterService::getCachedTableConfig>(rpc);
+            break;
+        case WireFormat::GetDurablePosition::opcode:
+            callHandler<WireFormat::GetDurablePosition, MasterService,
+                        &MasterService::getDurablePosition>(rpc);
+            break;
         case WireFormat::GetHeadOfLog::opcode:
             callHandler<WireFormat::GetHeadOfLog, MasterService,
                         &MasterService::getHeadOfLog>(rpc);
@@ -170,6 +204,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::Increment, MasterService,
                         &MasterService::increment>(rpc);
             break;
+        case WireFormat::IndexEntryBatch::opcode:
+            callHandler<WireFormat::IndexEntryBatch, MasterService,
+                        &MasterService::indexEntryBatch>(rpc);
+            break;
         case WireFormat::InsertIndexEntry::opcode:
             callHandler<WireFormat::InsertIndexEntry, MasterService,
                         &MasterService::insertIndexEntry>(rpc);
@@ -182,6 +220,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::LookupIndexKeys, MasterService,
                         &MasterService::lookupIndexKeys>(rpc);
             break;
+        case WireFormat::LookupIndexKeysAndRead::opcode:
+            callHandler<WireFormat::LookupIndexKeysAndRead, MasterService,
+                        &MasterService::lookupIndexKeysAndRead>(rpc);
+            break;
         case WireFormat::MigrateTablet::opcode:
             callHandler<WireFormat::MigrateTablet, MasterService,
                         &MasterService::migrateTablet>(rpc);
@@ -194,6 +236,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::MultiOp, MasterService,
                         &MasterService::multiOp>(rpc);
             break;
+        case WireFormat::Patch::opcode:
+            callHandler<WireFormat::Patch, MasterService,
+                        &MasterService::patch>(rpc);
+            break;
         case WireFormat::PrepForIndexletMigration::opcode:
             callHandler<WireFormat::PrepForIndexletMigration, MasterService,
                         &MasterService::prepForIndexletMigration>(rpc);
@@ -210,6 +256,18 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::ReadKeysAndValue, MasterService,
                         &MasterService::readKeysAndValue>(rpc);
             break;
+        case WireFormat::ReadLogChanges::opcode:
+            callHandler<WireFormat::ReadLogChanges, MasterService,
+                        &MasterService::readLogChanges>(rpc);
+            break;
+        case WireFormat::ReadRange::opcode:
+            callHandler<WireFormat::ReadRange, MasterService,
+                        &MasterService::readRange>(rpc);
+            break;
+        case WireFormat::ReadTableSnapshot::opcode:
+            callHandler<WireFormat::ReadTableSnapshot, MasterService,
+                        &MasterService::readTableSnapshot>(rpc);
+            break;
         case WireFormat::ReceiveMigrationData::opcode:
             callHandler<WireFormat::ReceiveMigrationData, MasterService,
                         &MasterService::receiveMigrationData>(rpc);
@@ -222,6 +280,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::RemoveIndexEntry, MasterService,
                         &MasterService::removeIndexEntry>(rpc);
             break;
+        case WireFormat::Scan::opcode:
+            callHandler<WireFormat::Scan, MasterService,
+                        &MasterService::scan>(rpc);
+            break;
         case WireFormat::SplitAndMigrateIndexlet::opcode:
             callHandler<WireFormat::SplitAndMigrateIndexlet, MasterService,
                         &MasterService::splitAndMigrateIndexlet>(rpc);
@@ -254,6 +316,10 @@ MasterService::dispatch(WireFormat::Opcode opcode, Rpc* rpc)
             callHandler<WireFormat::TxPrepare, MasterService,
                         &MasterService::txPrepare>(rpc);
             break;
+        case WireFormat::UpdateHotReplica::opcode:
+            callHandler<WireFormat::UpdateHotReplica, MasterService,
+                        &MasterService::updateHotReplica>(rpc);
+            break;
         case WireFormat::Write::opcode:
             callHandler<WireFormat::Write, MasterService,
                         &MasterService::write>(rpc);
@@ -313,6 +379,201 @@ volatile int MasterService::pauseIncrement = 0;
 volatile int MasterService::continueIncrement = 0;
 #endif
 
+/**
+ * Top-level server method to handle the APPEND request, which adds bytes
+ * to the end of an object's value (creating the object if it doesn't
+ * exist) without rewriting the rest of the value.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::append(const WireFormat::Append::Request* reqHdr,
+        WireFormat::Append::Response* respHdr,
+        Rpc* rpc)
+{
+    assert(reqHdr->rpcId > 0);
+    UnackedRpcHandle rh(&unackedRpcResults,
+                        reqHdr->lease, reqHdr->rpcId, reqHdr->ackId);
+    if (rh.isDuplicate()) {
+        *respHdr = parseRpcResult<WireFormat::Append>(rh.resultLoc());
+        rpc->sendReply();
+        return;
+    }
+
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->keyLength);
+    uint32_t dataOffset = reqOffset + reqHdr->keyLength;
+    if (stringKey == NULL ||
+            rpc->requestPayload->size() - dataOffset < reqHdr->length) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        rpc->sendReply();
+        return;
+    }
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+
+    RejectRules rejectRules = reqHdr->rejectRules;
+    uint64_t rpcResultPtr;
+    respHdr->common.status = STATUS_OK;
+    RpcResult rpcResult(
+            reqHdr->tableId, key.getHash(),
+            reqHdr->lease.leaseId, reqHdr->rpcId, reqHdr->ackId,
+            respHdr, sizeof(*respHdr));
+    respHdr->common.status = objectManager.appendObject(key,
+            rpc->requestPayload, dataOffset, reqHdr->length, &rejectRules,
+            &respHdr->version, &rpcResult, &rpcResultPtr);
+
+    if (respHdr->common.status == STATUS_OK) {
+        objectManager.syncChanges();
+        rh.recordCompletion(rpcResultPtr);
+    } else if (respHdr->common.status != STATUS_RETRY &&
+               respHdr->common.status != STATUS_UNKNOWN_TABLET) {
+        objectManager.writeRpcResultOnly(&rpcResult, &rpcResultPtr);
+        rh.recordCompletion(rpcResultPtr);
+    }
+}
+
+/**
+ * Helper for write: append a WireFormat::Write::Position to a response,
+ * for a client that didn't wait for its write to be fully durable. The
+ * current head of the log is after the object just written.
+ *
+ * \param replyPayload
+ *      Response of the write; the response header is already in it.
+ */
+void
+MasterService::appendWritePosition(Buffer* replyPayload)
+{
+    LogPosition head = objectManager.getLog()->getHead();
+    WireFormat::Write::Position* position =
+            replyPayload->emplaceAppend<WireFormat::Write::Position>();
+    position->masterId = serverId.getId();
+    position->segmentId = head.getSegmentId();
+    position->segmentOffset = head.getSegmentOffset();
+}
+
+/**
+ * Top-level server method to handle the BULK_LOAD request, which adds all
+ * of the entries in a segment built by the client (see BulkLoader) to this
+ * master. The segment is replayed into side logs the same way as migration
+ * data, so the entries are replicated a segment at a time rather than one
+ * at a time.
+ *
+ * Besides new objects, the segment may hold tombstones and object deltas
+ * copied from another log (see GeoReplicator); they are applied as during
+ * recovery. Loaded objects never replace existing objects with the same or
+ * a higher version, so resending a segment is harmless. Secondary indexes
+ * are not updated. Objects may be readable shortly before the RPC returns;
+ * they are only guaranteed to be durable once it has.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::bulkLoad(const WireFormat::BulkLoad::Request* reqHdr,
+        WireFormat::BulkLoad::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t segmentBytes = reqHdr->segmentBytes;
+    SegmentCertificate certificate = reqHdr->certificate;
+    rpc->requestPayload->truncateFront(sizeof(*reqHdr));
+    uint32_t payloadBytes = rpc->requestPayload->size();
+    const void* segmentMemory =
+            rpc->requestPayload->getRange(0, payloadBytes);
+    if (segmentMemory == NULL || payloadBytes > segmentBytes) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+
+    // A shorter payload holds the segment compressed.
+    std::unique_ptr<char[]> expanded;
+    if (payloadBytes < segmentBytes) {
+        try {
+            if (payloadBytes < FrameCompression::headerLength() ||
+                    !FrameCompression::isCompressed(segmentMemory)) {
+                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+                return;
+            }
+            expanded.reset(new char[segmentBytes]);
+            FrameCompression::decompress(segmentMemory, payloadBytes,
+                    expanded.get(), segmentBytes);
+        } catch (FrameCompressionException& e) {
+            LOG(WARNING, "Bulk load of table %lu rejected: %s",
+                    reqHdr->tableId, e.what());
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            return;
+        }
+        segmentMemory = expanded.get();
+    }
+    SegmentIterator it(segmentMemory, segmentBytes, certificate);
+    try {
+        it.checkMetadataIntegrity();
+    } catch (SegmentIteratorException& e) {
+        LOG(WARNING, "Bulk load of table %lu rejected: %s",
+                reqHdr->tableId, e.what());
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+
+    // Check every entry before replaying any of them, so that a bad segment
+    // is rejected as a whole. Entries usually all fall in one tablet, so
+    // only look up another one when a key hash falls outside the last.
+    SegmentIterator replayIt(it);
+    TabletManager::Tablet tablet;
+    bool haveTablet = false;
+    uint64_t maxVersion = 0;
+    uint32_t entryCount = 0;
+    for (; !it.isDone(); it.next()) {
+        Buffer buffer;
+        it.appendToBuffer(buffer);
+        LogEntryType type = it.getType();
+        uint64_t version;
+        bool intact;
+        if (type == LOG_ENTRY_TYPE_OBJ) {
+            Object object(buffer);
+            version = object.getVersion();
+            intact = object.checkIntegrity();
+        } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
+            ObjectTombstone tombstone(buffer);
+            version = tombstone.getObjectVersion();
+            intact = tombstone.checkIntegrity();
+        } else if (type == LOG_ENTRY_TYPE_OBJDELTA) {
+            ObjectDelta delta(buffer);
+            version = delta.getVersion();
+            intact = delta.checkIntegrity();
+        } else {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            return;
+        }
+        Key key(type, buffer);
+        if (key.getTableId() != reqHdr->tableId ||
+                version == VERSION_NONEXISTENT || !intact) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            return;
+        }
+        KeyHash keyHash = key.getHash();
+        if (!haveTablet || keyHash < tablet.startKeyHash ||
+                keyHash > tablet.endKeyHash) {
+            if (!tabletManager.getTablet(key, &tablet) ||
+                    tablet.state != TabletManager::NORMAL) {
+                respHdr->common.status = STATUS_UNKNOWN_TABLET;
+                return;
+            }
+            haveTablet = true;
+        }
+        maxVersion = std::max(maxVersion, version);
+        entryCount++;
+    }
+
+    ObjectManager::TombstoneProtector p(&objectManager);
+    objectManager.raiseSafeVersion(maxVersion + 1);
+    ParallelSegmentReplay replay(&objectManager,
+            config->master.migrationReplayThreads, NULL);
+    replay.replaySegment(replayIt);
+    replay.commit();
+    LOG(DEBUG, "Bulk loaded %u entries (%u bytes) into table %lu",
+            entryCount, segmentBytes, reqHdr->tableId);
+}
+
 /**
  * Top-level server method to handle the DROP_TABLET_OWNERSHIP request.
  *
@@ -441,6 +702,8 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
 
     EnumerationIterator iter(*rpc->requestPayload,
             downCast<uint32_t>(sizeof(*reqHdr)), reqHdr->iteratorBytes);
+    EnumerationFilter filter(*rpc->requestPayload,
+            sizeof32(*reqHdr) + reqHdr->iteratorBytes, reqHdr->filterBytes);
 
     // Put at most maxPayloadBytes of enumerated objects in the reply. This
     // limit is used to leave enough room in the reply buffer for the response
@@ -449,12 +712,14 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
             Transport::MAX_RPC_LEN - sizeof(*respHdr) - (1 << 20));
     Enumeration enumeration(
             reqHdr->tableId, reqHdr->keysOnly,
-            reqHdr->tabletFirstHash,
+            reqHdr->tabletFirstHash, reqHdr->lastHash,
             actualTabletStartHash, actualTabletEndHash,
             &respHdr->tabletFirstHash, iter,
             *objectManager.getLog(),
             *objectManager.getObjectMap(),
-            *rpc->replyPayload, maxPayloadBytes);
+            *rpc->replyPayload, maxPayloadBytes,
+            reqHdr->filterBytes != 0 ? &filter : NULL, &objectManager,
+            reqHdr->logOrder ? serverId.getId() : 0);
     enumeration.complete();
     respHdr->payloadBytes = rpc->replyPayload->size()
             - downCast<uint32_t>(sizeof(*respHdr));
@@ -464,6 +729,60 @@ MasterService::enumerate(const WireFormat::Enumerate::Request* reqHdr,
     respHdr->iteratorBytes = iteratorBytes;
 }
 
+/**
+ * Handle the GET_CACHED_TABLE_CONFIG request, which clients send to masters
+ * in place of GET_TABLE_CONFIG to the coordinator (see
+ * ObjectFinder::enableMasterConfigFetches): return this master's copy of
+ * the table's configuration.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::getCachedTableConfig(
+        const WireFormat::GetCachedTableConfig::Request* reqHdr,
+        WireFormat::GetCachedTableConfig::Response* respHdr,
+        Rpc* rpc)
+{
+    ProtoBuf::TableConfig tableConfig;
+    uint64_t epoch, version;
+    tableConfigCache.getTableConfig(reqHdr->tableId, reqHdr->knownEpoch,
+            reqHdr->knownVersion, &tableConfig, &epoch, &version);
+    respHdr->configEpoch = epoch;
+    respHdr->configVersion = version;
+    respHdr->incremental = 0;
+    if (reqHdr->flatFormat) {
+        respHdr->tableConfigLength = FlatTableConfig::encode(tableConfig,
+                                                             rpc->replyPayload);
+    } else {
+        respHdr->tableConfigLength = serializeToResponse(rpc->replyPayload,
+                                                         &tableConfig);
+    }
+}
+
+/**
+ * Top-level server method to handle the GET_DURABLE_POSITION request, which
+ * clients use to find out when writes that didn't wait for all of the
+ * backups have become fully durable. If the position the client is waiting
+ * for isn't durable yet, the log is synced first, so the response doubles
+ * as a notification that the client's writes are safe.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::getDurablePosition(
+        const WireFormat::GetDurablePosition::Request* reqHdr,
+        WireFormat::GetDurablePosition::Response* respHdr,
+        Rpc* rpc)
+{
+    Log* log = objectManager.getLog();
+    LogPosition target(reqHdr->segmentId, reqHdr->segmentOffset);
+    if (log->getDurablePosition() < target)
+        log->sync();
+    LogPosition durable = log->getDurablePosition();
+    respHdr->segmentId = durable.getSegmentId();
+    respHdr->segmentOffset = durable.getSegmentOffset();
+}
+
 /**
  * Top-level server method to handle the GET_HEAD_OF_LOG request.
  */
@@ -653,6 +972,10 @@ MasterService::increment(const WireFormat::Increment::Request* reqHdr,
  * Helper function used by increment and multiIncrement to perform the atomic
  * read, increment, write cycle.  Does _not_ sync changes in order to allow
  * for batched synchronization.
+ *
+ * If config->master.combineIncrements is set, unconditional increments of
+ * the same object by concurrent RPCs are combined into a single write (see
+ * combineIncrement()).
  * \param key
  *      The key of the object.  If the object does not exist, it is created as
  *      zero before incrementing.
@@ -694,6 +1017,15 @@ MasterService::incrementObject(Key *key,
             WireFormat::Increment::Response* respHdr,
             uint64_t *rpcResultPtr)
 {
+    if (config->master.combineIncrements && !rejectRules.doesntExist &&
+            !rejectRules.exists && !rejectRules.versionLeGiven &&
+            !rejectRules.versionNeGiven) {
+        PendingIncrement increment(key, asInt64, asDouble, newVersion, status,
+                reqHdr, respHdr, rpcResultPtr);
+        combineIncrement(&increment);
+        return;
+    }
+
     // Read the object and add integer or floating point values in case
     // the summands are non-zero.  It is possible to do both an integer
     // addition and a floating point addition.
@@ -798,6 +1130,208 @@ MasterService::incrementObject(Key *key,
     *asDouble = newValue.asDouble;
 }
 
+/**
+ * Helper for incrementObject() that lets concurrent increments of the same
+ * object share a single write. If no other thread is incrementing the
+ * object, this one performs the increment at once, along with any that
+ * queue up for the object in the meantime; once it is done, the first of
+ * those still queued (if any) takes over. Otherwise the increment is queued
+ * and this thread waits until another one has performed it or it must take
+ * over.
+ *
+ * Since the object is read and written once per batch, a hot counter gets
+ * one new version in the log per batch rather than one per increment.
+ *
+ * \param increment
+ *      The increment to perform; its results are filled in before this
+ *      returns.
+ */
+void
+MasterService::combineIncrement(PendingIncrement* increment)
+{
+    KeyHash keyHash = increment->key->getHash();
+    {
+        SpinLock::Guard _(pendingIncrementsLock);
+        auto it = pendingIncrements.find(keyHash);
+        if (it == pendingIncrements.end()) {
+            pendingIncrements[keyHash];
+            increment->state = PendingIncrement::LEADING;
+        } else {
+            it->second.push_back(increment);
+        }
+    }
+    while (increment->state == PendingIncrement::WAITING) {
+        // Another thread is writing the object; wait for it to perform
+        // this increment or to hand it over.
+    }
+    if (increment->state == PendingIncrement::DONE)
+        return;
+
+    // Increments of other keys that happen to have the same hash are left
+    // for the next thread to take over.
+    std::vector<PendingIncrement*> batch;
+    batch.push_back(increment);
+    {
+        SpinLock::Guard _(pendingIncrementsLock);
+        std::deque<PendingIncrement*>& queue = pendingIncrements[keyHash];
+        for (auto it = queue.begin(); it != queue.end(); ) {
+            if (*(*it)->key == *increment->key) {
+                batch.push_back(*it);
+                it = queue.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    std::exception_ptr exception;
+    try {
+        performIncrements(batch);
+    } catch (...) {
+        // The exception is passed on to this thread's client once the
+        // object has been handed over; the others must retry for
+        // themselves.
+        exception = std::current_exception();
+        for (size_t i = 1; i < batch.size(); i++)
+            *batch[i]->status = STATUS_RETRY;
+    }
+    for (size_t i = 1; i < batch.size(); i++)
+        batch[i]->state = PendingIncrement::DONE;
+
+    {
+        SpinLock::Guard _(pendingIncrementsLock);
+        auto it = pendingIncrements.find(keyHash);
+        if (it->second.empty()) {
+            pendingIncrements.erase(it);
+        } else {
+            it->second.front()->state = PendingIncrement::LEADING;
+            it->second.pop_front();
+        }
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+/**
+ * Perform a batch of unconditional increments of the same object with a
+ * single read-increment-write cycle, each one seeing the result of the
+ * ones before it. The linearizability records of all of the increments
+ * are written atomically with the object. Does _not_ sync changes.
+ *
+ * \param batch
+ *      The increments to perform; see combineIncrement(). Their results
+ *      (status, new version and new value) are filled in here.
+ */
+void
+MasterService::performIncrements(std::vector<PendingIncrement*>& batch)
+{
+    // See incrementObject().
+    union IncrementValue {
+        int64_t asInt64;
+        double asDouble;
+    };
+
+    Key* key = batch[0]->key;
+    size_t done = 0;
+    while (done < batch.size()) {
+        IncrementValue oldValue;
+        ObjectBuffer value;
+        uint64_t version = VERSION_NONEXISTENT;
+        Status status = objectManager.readObject(*key, &value, NULL, &version);
+        if (status == STATUS_OBJECT_DOESNT_EXIST) {
+            oldValue.asInt64 = 0;
+            status = STATUS_OK;
+        } else if (status == STATUS_OK) {
+            uint32_t dataLen;
+            oldValue.asInt64 = *value.get<int64_t>(&dataLen);
+            if (dataLen != sizeof(oldValue))
+                status = STATUS_INVALID_OBJECT;
+        }
+        if (status != STATUS_OK) {
+            for (size_t i = done; i < batch.size(); i++)
+                *batch[i]->status = status;
+            return;
+        }
+
+        // Each response records the object's new version, so it must be
+        // known before the write. That is only possible if the object
+        // exists; otherwise it is created by an increment on its own.
+        size_t end = batch.size();
+        uint64_t newVersion = version + 1;
+        uint64_t* outVersion = &newVersion;
+        if (version == VERSION_NONEXISTENT) {
+            end = done + 1;
+            if (batch[done]->respHdr != NULL)
+                outVersion = &batch[done]->respHdr->version;
+        }
+
+        std::vector<IncrementValue> newValues;
+        std::deque<RpcResult> rpcResults;
+        std::vector<RpcResult*> rpcResultPointers;
+        IncrementValue newValue = oldValue;
+        for (size_t i = done; i < end; i++) {
+            PendingIncrement* increment = batch[i];
+            WireFormat::Increment::Response* respHdr = increment->respHdr;
+            if (*increment->asInt64 != 0) {
+                newValue.asInt64 += *increment->asInt64;
+                if (respHdr) respHdr->newValue.asInt64 = newValue.asInt64;
+            }
+            if (*increment->asDouble != 0.0) {
+                newValue.asDouble += *increment->asDouble;
+                if (respHdr) respHdr->newValue.asDouble = newValue.asDouble;
+            }
+            newValues.push_back(newValue);
+
+            if (respHdr) {
+                const WireFormat::Increment::Request* reqHdr =
+                        increment->reqHdr;
+                respHdr->common.status = STATUS_OK;
+                respHdr->version = newVersion;
+                rpcResults.emplace_back(reqHdr->tableId, key->getHash(),
+                        reqHdr->lease.leaseId, reqHdr->rpcId, reqHdr->ackId,
+                        respHdr, sizeof32(*respHdr));
+                rpcResultPointers.push_back(&rpcResults.back());
+            }
+        }
+
+        Buffer newValueBuffer;
+        Object::appendKeysAndValueToBuffer(*key, &newValue, sizeof(newValue),
+                                           &newValueBuffer);
+        Object newObject(key->getTableId(), 0, 0, newValueBuffer);
+        RejectRules updateRejectRules;
+        memset(&updateRejectRules, 0, sizeof(updateRejectRules));
+        updateRejectRules.givenVersion = version;
+        updateRejectRules.versionNeGiven = true;
+        std::vector<uint64_t> rpcResultPtrs(rpcResultPointers.size());
+        status = objectManager.writeObject(newObject, &updateRejectRules,
+                outVersion, NULL, downCast<uint32_t>(rpcResultPointers.size()),
+                rpcResultPointers.data(), rpcResultPtrs.data());
+        if (status == STATUS_WRONG_VERSION) {
+            TEST_LOG("retry after version mismatch");
+            continue;
+        }
+        if (end - done > 1)
+            TEST_LOG("combined %lu increments", end - done);
+
+        size_t resultIndex = 0;
+        for (size_t i = done; i < end; i++) {
+            PendingIncrement* increment = batch[i];
+            *increment->status = status;
+            if (status != STATUS_OK)
+                continue;
+            *increment->newVersion = *outVersion;
+            *increment->asInt64 = newValues[i - done].asInt64;
+            *increment->asDouble = newValues[i - done].asDouble;
+            if (increment->respHdr != NULL) {
+                if (increment->rpcResultPtr != NULL)
+                    *increment->rpcResultPtr = rpcResultPtrs[resultIndex];
+                resultIndex++;
+            }
+        }
+        done = end;
+    }
+}
+
 /**
  * Top-level server method to handle the READ_HASHES request.
  *
@@ -810,11 +1344,22 @@ MasterService::readHashes(
         Rpc* rpc)
 {
     uint32_t reqOffset = sizeof32(*reqHdr);
+    uint32_t maxLength = maxResponseRpcLen - sizeof32(*respHdr);
+    uint32_t initialLength = rpc->replyPayload->size();
 
     objectManager.readHashes(reqHdr->tableId, reqHdr->numHashes,
-            rpc->requestPayload, reqOffset,
-            maxResponseRpcLen - sizeof32(*respHdr),
+            rpc->requestPayload, reqOffset, maxLength,
             rpc->replyPayload, &respHdr->numHashes, &respHdr->numObjects);
+
+    // Tell the client how many hashes it could usefully send next time,
+    // judging by the objects returned now.
+    respHdr->hashesPerResponse = 0;
+    uint32_t length = rpc->replyPayload->size() - initialLength;
+    if (respHdr->numObjects > 0 && length > 0) {
+        uint32_t averageLength = length / respHdr->numObjects;
+        respHdr->hashesPerResponse =
+                maxLength / std::max(averageLength, 1u);
+    }
 }
 
 /**
@@ -839,6 +1384,59 @@ MasterService::initOnceEnlisted()
     initCalled = true;
 }
 
+/**
+ * Top-level server method to handle the INDEX_ENTRY_BATCH request, which
+ * a data master sends to insert and remove several index entries at once.
+ * The entries are applied in order, and a status is returned for each of
+ * them, so that the sender can redo the ones that weren't applied here.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::indexEntryBatch(
+        const WireFormat::IndexEntryBatch::Request* reqHdr,
+        WireFormat::IndexEntryBatch::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    if (reqHdr->count > rpc->requestPayload->size() /
+            sizeof32(WireFormat::IndexEntryBatch::Part)) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+    Status* statuses = static_cast<Status*>(
+            rpc->replyPayload->alloc(reqHdr->count * sizeof32(Status)));
+    for (uint32_t i = 0; i < reqHdr->count; i++) {
+        const WireFormat::IndexEntryBatch::Part* part =
+                rpc->requestPayload->getOffset<
+                WireFormat::IndexEntryBatch::Part>(reqOffset);
+        if (part == NULL) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            return;
+        }
+        reqOffset += sizeof32(*part);
+        const void* indexKey = rpc->requestPayload->getRange(reqOffset,
+                part->indexKeyLength);
+        if (indexKey == NULL) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            return;
+        }
+        reqOffset += part->indexKeyLength;
+
+        if (part->remove) {
+            statuses[i] = indexletManager.removeEntry(part->tableId,
+                    part->indexId, indexKey, part->indexKeyLength,
+                    part->primaryKeyHash);
+        } else {
+            statuses[i] = indexletManager.insertEntry(part->tableId,
+                    part->indexId, indexKey, part->indexKeyLength,
+                    part->primaryKeyHash);
+        }
+    }
+    respHdr->count = reqHdr->count;
+    TEST_LOG("applied %u entries", reqHdr->count);
+}
+
 /**
  * Top-level server method to handle the INSERT_INDEX_ENTRY request;
  * As an index server, this function inserts an entry to an index.
@@ -896,6 +1494,47 @@ MasterService::lookupIndexKeys(
     indexletManager.lookupIndexKeys(reqHdr, respHdr, rpc);
 }
 
+/**
+ * Top-level server method to handle the LOOKUP_INDEX_KEYS_AND_READ request.
+ * The lookup is done exactly as for LOOKUP_INDEX_KEYS; then the objects
+ * matching as many of the resulting key hashes as possible are read and
+ * returned too, which saves the client a READ_HASHES round trip when the
+ * indexed table lives on this server.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::lookupIndexKeysAndRead(
+        const WireFormat::LookupIndexKeysAndRead::Request* reqHdr,
+        WireFormat::LookupIndexKeysAndRead::Response* respHdr,
+        Rpc* rpc)
+{
+    indexletManager.lookupIndexKeys(reqHdr, &respHdr->lookup, rpc);
+    // On errors the reply has already been sent.
+    if (respHdr->lookup.common.status != STATUS_OK ||
+            respHdr->lookup.numHashes == 0)
+        return;
+
+    // The objects are appended to the reply, so the hashes are copied
+    // out of it first.
+    uint32_t hashesLength = respHdr->lookup.numHashes * 8;
+    Buffer pKHashes;
+    pKHashes.appendCopy(rpc->replyPayload->getRange(sizeof32(*respHdr),
+            hashesLength), hashesLength);
+
+    // readHashes stops at the first hash whose tablet isn't here, and
+    // the client reads the objects for the rest with READ_HASHES.
+    try {
+        objectManager.readHashes(reqHdr->tableId, respHdr->lookup.numHashes,
+                &pKHashes, 0, maxResponseRpcLen - sizeof32(*respHdr),
+                rpc->replyPayload, &respHdr->numReadHashes,
+                &respHdr->numObjects);
+    } catch (RetryException& e) {
+        // The tablet is being migrated; whatever was read before that was
+        // noticed is still good.
+    }
+}
+
 /**
  * Helper function to avoid code duplication in migrateTablet which copies a log
  * entry to a segment for migration if it is a live log entry.
@@ -910,7 +1549,7 @@ MasterService::lookupIndexKeys(
  *      The iterator that points at the object we are attempting to migrate.
  * \param[out] transferSeg
  *      Segment object that we append objects to, and possibly send when it gets
- *      full.
+ *      full (after which it refers to a new, empty segment).
  * \param[out] entryTotals
  *      Array indexed by type of the total number of log entries copied into
  *      segments for transfer thus far, which we increment whenever we append an
@@ -925,10 +1564,10 @@ MasterService::lookupIndexKeys(
  *      Lowest key hash that will be migrated.
  * \param lastKeyHash
  *      Highest key hash that will be migrated.
- * \param receiver
- *      ServerId of the master that is receiving the migration data. Each time
- *      a transfer segment fills, this server will be sent an RPC containing
- *      the data.
+ * \param sender
+ *      Each time a transfer segment fills, it is passed to this object's
+ *      send method, which ships it to the master receiving the migration
+ *      data. NULL means full segments are simply discarded.
  * \return
  *      Returns STATUS_OK on success (either the entry is ignored or
  *      successfully added to the segment) or another status failure (an entry
@@ -937,13 +1576,13 @@ MasterService::lookupIndexKeys(
 Status
 MasterService::migrateSingleLogEntry(
         SegmentIterator& it,
-        Tub<Segment>& transferSeg,
+        std::unique_ptr<Segment>& transferSeg,
         uint64_t entryTotals[],
         uint64_t& totalBytes,
         uint64_t tableId,
         uint64_t firstKeyHash,
         uint64_t lastKeyHash,
-        ServerId receiver)
+        MigrationSender* sender)
 {
     LogEntryType type = it.getType();
     if (type != LOG_ENTRY_TYPE_OBJ &&
@@ -951,8 +1590,10 @@ MasterService::migrateSingleLogEntry(
         type != LOG_ENTRY_TYPE_RPCRESULT &&
         type != LOG_ENTRY_TYPE_PREP &&
         type != LOG_ENTRY_TYPE_PREPTOMB &&
+        type != LOG_ENTRY_TYPE_PREPTOMBBATCH &&
         type != LOG_ENTRY_TYPE_TXDECISION &&
-        type != LOG_ENTRY_TYPE_TXPLIST)
+        type != LOG_ENTRY_TYPE_TXPLIST &&
+        type != LOG_ENTRY_TYPE_OBJDELTA)
     {
         // We aren't interested in any other types.
         TEST_LOG("Ignoring log entry type %s",
@@ -965,7 +1606,8 @@ MasterService::migrateSingleLogEntry(
     uint64_t entryTableId = 0;
     KeyHash entryKeyHash = 0;
 
-    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJTOMB) {
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJTOMB ||
+            type == LOG_ENTRY_TYPE_OBJDELTA) {
         Key key(type, buffer);
         entryTableId = key.getTableId();
         entryKeyHash = key.getHash();
@@ -983,6 +1625,17 @@ MasterService::migrateSingleLogEntry(
         PreparedOpTombstone opTomb(buffer, 0);
         entryTableId = opTomb.header.tableId;
         entryKeyHash = opTomb.header.keyHash;
+    } else if (type == LOG_ENTRY_TYPE_PREPTOMBBATCH) {
+        PreparedOpTombstoneBatch batch(buffer);
+        foreach (PreparedOpTombstoneBatch::Record& record, batch.records) {
+            entryTableId = record.tableId;
+            entryKeyHash = record.keyHash;
+            if (entryTableId != tableId)
+                continue;
+            if (entryKeyHash < firstKeyHash || entryKeyHash > lastKeyHash)
+                continue;
+            break;
+        }
     } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
         TxDecisionRecord record(buffer);
         entryTableId = record.getTableId();
@@ -1043,22 +1696,17 @@ MasterService::migrateSingleLogEntry(
     PerfStats::threadStats.migrationPhase1Bytes += buffer.size();
 
     if (!transferSeg)
-        transferSeg.construct();
+        transferSeg.reset(new Segment());
 
 #if !MIGRATION_SKIP_APPEND
     // If we can't fit it, send the current buffer and retry.
     if (!transferSeg->append(type, buffer)) {
         transferSeg->close();
         LOG(DEBUG, "Sending migration segment");
-        if (expect_true(receiver != ServerId{})) {
-#if !MIGRATION_SKIP_TX
-            MasterClient::receiveMigrationData(context, receiver,
-                    transferSeg.get(), tableId, firstKeyHash);
-#endif
-        }
+        if (expect_true(sender != NULL))
+            sender->send(std::move(transferSeg));
 
-        transferSeg.destroy();
-        transferSeg.construct();
+        transferSeg.reset(new Segment());
 
         // If it doesn't fit this time, we're in trouble.
         if (!transferSeg->append(type, buffer)) {
@@ -1095,7 +1743,8 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
 
     // Mark this request as read-only, to avoid deadlock when performing
     // epoch-related waits below.
-    rpc->worker->rpc->activities = Transport::ServerRpc::READ_ACTIVITY;
+    rpc->worker->rpc->logProtectorPin.setActivities(
+            Transport::ServerRpc::READ_ACTIVITY);
 
     // Find the tablet we're trying to move. We only support migration
     // when the tablet to be migrated consists of a range within a single,
@@ -1133,30 +1782,26 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         context->serverList->toString(receiver).c_str());
 
     // We'll send over objects in Segment containers for better network
-    // efficiency and convenience.
-    Tub<Segment> transferSeg;
-
-    uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
-    uint64_t totalBytes = 0;
+    // efficiency and convenience. The sender scans segments with several
+    // threads and keeps several transfer segments in flight, so that
+    // scanning, transmission, and replay on the receiver overlap.
+    MigrationSender sender(context, this, receiver, tableId, firstKeyHash,
+            lastKeyHash, config->master.migrationThreads,
+            config->master.migrationSegmentsInFlight);
 
     LogIterator it(*objectManager.getLog());
     // Phase 1: scan the log from oldest to newest entries until we reach
-    // the head segment.
+    // the head segment. The segments before the head are immutable, so
+    // they are handed out whole to the sender's threads.
     CycleCounter<> phase1Cycles{};
     if (!it.isDone()) {
-        while (true) {
-            Status error = migrateSingleLogEntry(
-                    *it.getCurrentSegmentIterator(),
-                    transferSeg, entryTotals, totalBytes,
-                    tableId, firstKeyHash, lastKeyHash,
-                    receiver);
-            if (error) return;
-
-            if (it.onHead())
-                break;
-            it.next();
+        while (!it.onHead()) {
+            sender.scanSegment(*it.getCurrentSegmentIterator());
+            it.nextSegment();
         }
+        sender.scanEntry(*it.getCurrentSegmentIterator());
     }
+    sender.waitForScans();
     PerfStats::threadStats.migrationPhase1Cycles += phase1Cycles.stop();
 
     // Phase 2: block new writes and let current writes finish
@@ -1164,8 +1809,12 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         tabletManager.changeState(tableId, firstKeyHash, lastKeyHash,
                 TabletManager::NORMAL, TabletManager::LOCKED_FOR_MIGRATION);
 
+        // Writes to the tablet will soon happen on the receiver, where
+        // they can't invalidate our remote read hints.
+        objectManager.invalidateRemoteReads();
+
         // Wait for the remainder of already running writes to finish.
-        LogProtector::wait(context, Transport::ServerRpc::APPEND_ACTIVITY);
+        LogProtector::wait(Transport::ServerRpc::APPEND_ACTIVITY);
     }
 
     // Phase 3: finish iterating over the remaining log entries.
@@ -1173,21 +1822,11 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
         it.next();
         if (it.isDone())
             break;
-        Status error = migrateSingleLogEntry(
-                *it.getCurrentSegmentIterator(),
-                transferSeg, entryTotals, totalBytes,
-                tableId, firstKeyHash, lastKeyHash,
-                receiver);
-        if (error) return;
+        sender.scanEntry(*it.getCurrentSegmentIterator());
     }
 
-    if (transferSeg) {
-        transferSeg->close();
-        LOG(DEBUG, "Sending last migration segment");
-        MasterClient::receiveMigrationData(context, receiver,
-                transferSeg.get(), tableId, firstKeyHash);
-        transferSeg.destroy();
-    }
+    // Send whatever is left and wait for the receiver to replay it all.
+    sender.finish();
 
     // Now that all data has been transferred, we can reassign ownership of
     // the tablet. If this succeeds, we are free to drop the tablet. The
@@ -1205,10 +1844,11 @@ MasterService::migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
     LOG(NOTICE, "Migration succeeded for tablet [0x%lx,0x%lx] in "
             "tableId %lu; sent %lu objects and %lu tombstones to %s, "
             "%lu bytes in total",
-            firstKeyHash, lastKeyHash, tableId, entryTotals[LOG_ENTRY_TYPE_OBJ],
-            entryTotals[LOG_ENTRY_TYPE_OBJTOMB],
+            firstKeyHash, lastKeyHash, tableId,
+            sender.entryTotals[LOG_ENTRY_TYPE_OBJ],
+            sender.entryTotals[LOG_ENTRY_TYPE_OBJTOMB],
             context->serverList->toString(receiver).c_str(),
-            totalBytes);
+            sender.totalBytes);
 
     bool removed = tabletManager.deleteTablet(tableId,
                                               firstKeyHash,
@@ -1240,6 +1880,7 @@ MasterService::multiOp(const WireFormat::MultiOp::Request* reqHdr,
             multiIncrement(reqHdr, respHdr, rpc);
             break;
         case WireFormat::MultiOp::OpType::READ:
+        case WireFormat::MultiOp::OpType::PACKED_READ:
             multiRead(reqHdr, respHdr, rpc);
             break;
         case WireFormat::MultiOp::OpType::REMOVE:
@@ -1332,6 +1973,69 @@ MasterService::multiIncrement(const WireFormat::MultiOp::Request* reqHdr,
     rpc->sendReply();
 }
 
+/**
+ * Extract one part of a PACKED_READ multiOp request.
+ *
+ * \param payload
+ *      The request.
+ * \param[in,out] offset
+ *      Offset of the part within \a payload; advanced past it.
+ * \param[in,out] tableId
+ *      The table of the previous part; set to the table of this one.
+ * \param[out] rejectRules
+ *      Set to the part's reject rules.
+ * \param[out] key
+ *      Set to the part's key, which is contiguous in \a payload.
+ * \param[out] keyLength
+ *      Set to the number of bytes in \a key.
+ * \return
+ *      False means the part was malformed or truncated, or didn't name a
+ *      table even though it was the first part.
+ */
+static bool
+readPackedReadPart(Buffer* payload, uint32_t* offset, Tub<uint64_t>* tableId,
+        RejectRules* rejectRules, const void** key, uint16_t* keyLength)
+{
+    typedef WireFormat::MultiOp::Request::PackedReadPart PackedReadPart;
+    const PackedReadPart* part = payload->getOffset<PackedReadPart>(*offset);
+    if (part == NULL)
+        return false;
+    *offset += sizeof32(*part);
+    if (part->flags & PackedReadPart::NEW_TABLE) {
+        const uint64_t* newTableId = payload->getOffset<uint64_t>(*offset);
+        if (newTableId == NULL)
+            return false;
+        tableId->construct(*newTableId);
+        *offset += sizeof32(uint64_t);
+    } else if (!*tableId) {
+        return false;
+    }
+    memset(rejectRules, 0, sizeof(*rejectRules));
+    if (part->flags & PackedReadPart::REJECT_RULES) {
+        const RejectRules* rules = payload->getOffset<RejectRules>(*offset);
+        if (rules == NULL)
+            return false;
+        *rejectRules = *rules;
+        *offset += sizeof32(RejectRules);
+    }
+    uint32_t length = 0;
+    for (uint32_t i = 0; ; i++) {
+        const uint8_t* byte = payload->getOffset<uint8_t>(*offset);
+        if (byte == NULL || i == PackedReadPart::MAX_KEY_LENGTH_BYTES)
+            return false;
+        *offset += 1;
+        length |= uint32_t(*byte & 0x7f) << (7 * i);
+        if ((*byte & 0x80) == 0)
+            break;
+    }
+    if (length > UINT16_MAX)
+        return false;
+    *keyLength = downCast<uint16_t>(length);
+    *key = payload->getRange(*offset, *keyLength);
+    *offset += *keyLength;
+    return *key != NULL;
+}
+
 /**
  * Top-level server method to handle the MULTI_READ request.
  *
@@ -1362,58 +2066,93 @@ MasterService::multiRead(const WireFormat::MultiOp::Request* reqHdr,
     respHdr->count = numRequests;
     uint32_t oldResponseLength = rpc->replyPayload->size();
 
-    // Each iteration extracts one request from request rpc, finds the
-    // corresponding object, and appends the response to the response rpc.
-    for (uint32_t i = 0; ; i++) {
-        // If the RPC response has exceeded the legal limit, truncate it
-        // to the last object that fits below the limit (the client will
-        // retry the objects we don't return).
-        uint32_t newLength = rpc->replyPayload->size();
-        if (newLength > maxResponseRpcLen) {
-            rpc->replyPayload->truncate(oldResponseLength);
-            respHdr->count = i-1;
-            break;
-        } else {
-            oldResponseLength = newLength;
-        }
-        if (i >= numRequests) {
-            // The loop-termination check is done here rather than in the
-            // "for" statement above so that we have a chance to do the
-            // size check above even for every object inserted, including
-            // the last object and those with STATUS_OBJECT_DOESNT_EXIST.
-            break;
+    // Requests are handed to the object manager in batches so that it can
+    // overlap the cache misses of all the lookups in a batch.
+    const uint32_t maxBatch = ObjectManager::MAX_PREFETCH_BATCH;
+    Tub<Key> keys[maxBatch];
+    Key* keyPointers[maxBatch];
+    RejectRules rejectRules[maxBatch];
+    uint64_t versions[maxBatch];
+    Status statuses[maxBatch];
+    bool packed = (reqHdr->type == WireFormat::MultiOp::OpType::PACKED_READ);
+    Tub<uint64_t> tableId;
+
+    for (uint32_t i = 0; i < numRequests; ) {
+        // Extract the next batch of requests from the request rpc.
+        uint32_t batchSize = 0;
+        bool formatError = false;
+        while (batchSize < maxBatch && i + batchSize < numRequests) {
+            const void* stringKey;
+            uint16_t keyLength;
+            if (packed) {
+                if (!readPackedReadPart(rpc->requestPayload, &reqOffset,
+                        &tableId, &rejectRules[batchSize], &stringKey,
+                        &keyLength)) {
+                    formatError = true;
+                    break;
+                }
+            } else {
+                const WireFormat::MultiOp::Request::ReadPart *currentReq =
+                        rpc->requestPayload->getOffset<
+                        WireFormat::MultiOp::Request::ReadPart>(reqOffset);
+                if (currentReq == NULL) {
+                    formatError = true;
+                    break;
+                }
+                reqOffset += sizeof32(WireFormat::MultiOp::Request::ReadPart);
+                keyLength = currentReq->keyLength;
+                stringKey = rpc->requestPayload->getRange(reqOffset,
+                        keyLength);
+                reqOffset += keyLength;
+                if (stringKey == NULL) {
+                    formatError = true;
+                    break;
+                }
+                tableId.construct(currentReq->tableId);
+                rejectRules[batchSize] = currentReq->rejectRules;
+            }
+
+            keys[batchSize].construct(*tableId, stringKey, keyLength);
+            keyPointers[batchSize] = keys[batchSize].get();
+            versions[batchSize] = 0;
+            batchSize++;
         }
 
-        const WireFormat::MultiOp::Request::ReadPart *currentReq =
-                rpc->requestPayload->getOffset<
-                WireFormat::MultiOp::Request::ReadPart>(reqOffset);
-        reqOffset += sizeof32(WireFormat::MultiOp::Request::ReadPart);
+        Buffer values[batchSize];
+        objectManager.readObjects(batchSize, keyPointers, rejectRules, values,
+                versions, statuses);
+
+        // Append the response for each object in the batch to the response
+        // rpc.
+        for (uint32_t j = 0; j < batchSize; j++, i++) {
+            WireFormat::MultiOp::Response::ReadPart* currentResp =
+                   rpc->replyPayload->emplaceAppend<
+                   WireFormat::MultiOp::Response::ReadPart>();
+            currentResp->status = statuses[j];
+            currentResp->version = versions[j];
+            if (statuses[j] == STATUS_OK) {
+                uint32_t initialLength = rpc->replyPayload->size();
+                rpc->replyPayload->append(&values[j]);
+                currentResp->length =
+                        rpc->replyPayload->size() - initialLength;
+            }
 
-        const void* stringKey = rpc->requestPayload->getRange(
-                reqOffset, currentReq->keyLength);
-        reqOffset += currentReq->keyLength;
+            // If the RPC response has exceeded the legal limit, truncate it
+            // to the last object that fits below the limit (the client will
+            // retry the objects we don't return).
+            uint32_t newLength = rpc->replyPayload->size();
+            if (newLength > maxResponseRpcLen) {
+                rpc->replyPayload->truncate(oldResponseLength);
+                respHdr->count = i;
+                return;
+            }
+            oldResponseLength = newLength;
+        }
 
-        if (stringKey == NULL) {
+        if (formatError) {
             respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
             break;
         }
-
-        Key key(currentReq->tableId, stringKey, currentReq->keyLength);
-
-        WireFormat::MultiOp::Response::ReadPart* currentResp =
-               rpc->replyPayload->emplaceAppend<
-               WireFormat::MultiOp::Response::ReadPart>();
-
-        uint32_t initialLength = rpc->replyPayload->size();
-        RejectRules rejectRules = currentReq->rejectRules;
-        currentResp->status = objectManager.readObject(
-                key, rpc->replyPayload, &rejectRules,
-                &currentResp->version);
-
-        if (currentResp->status != STATUS_OK)
-            continue;
-
-        currentResp->length = rpc->replyPayload->size() - initialLength;
     }
 }
 
@@ -1499,12 +2238,16 @@ MasterService::multiRemove(const WireFormat::MultiOp::Request* reqHdr,
     // reqHdr, respHdr, and rpc are off-limits now!
 
     // Delete old index entries if any.
+    Tub<Object> oldObjects[numRequests];
+    IndexEntryBatcher::Updates indexUpdates;
     for (uint32_t i = 0; i < numRequests; i++) {
         if (objectBuffers[i].size() > 0) {
-            Object oldObject(objectBuffers[i]);
-            requestRemoveIndexEntries(oldObject);
+            oldObjects[i].construct(objectBuffers[i]);
+            requestRemoveIndexEntries(*oldObjects[i], &indexUpdates);
         }
     }
+    indexEntryBatcher.start(&indexUpdates);
+    indexEntryBatcher.wait(&indexUpdates);
 }
 
 /**
@@ -1538,46 +2281,70 @@ MasterService::multiWrite(const WireFormat::MultiOp::Request* reqHdr,
     // Buffer on stack.
     Buffer oldObjectBuffers[numRequests];
 
-    // Each iteration extracts one request from the rpc, writes the object
-    // if possible, and appends a status and version to the response buffer.
-    for (uint32_t i = 0; i < numRequests; i++) {
-        const WireFormat::MultiOp::Request::WritePart *currentReq =
-                rpc->requestPayload->getOffset<
-                WireFormat::MultiOp::Request::WritePart>(reqOffset);
+    // Requests are handed to the object manager in batches so that it can
+    // overlap the cache misses of all the lookups in a batch.
+    const uint32_t maxBatch = ObjectManager::MAX_PREFETCH_BATCH;
+    Tub<Object> objects[maxBatch];
+    Object* objectPointers[maxBatch];
+    RejectRules rejectRules[maxBatch];
+    uint64_t versions[maxBatch];
+    Status statuses[maxBatch];
+    WireFormat::MultiOp::Response::WritePart* responses[maxBatch];
+
+    for (uint32_t i = 0; i < numRequests; ) {
+        // Extract the next batch of requests from the rpc and append a
+        // response part for each to the response buffer.
+        uint32_t batchSize = 0;
+        bool formatError = false;
+        IndexEntryBatcher::Updates indexUpdates;
+        while (batchSize < maxBatch && i + batchSize < numRequests) {
+            const WireFormat::MultiOp::Request::WritePart *currentReq =
+                    rpc->requestPayload->getOffset<
+                    WireFormat::MultiOp::Request::WritePart>(reqOffset);
 
-        if (currentReq == NULL) {
-            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-            break;
-        }
+            if (currentReq == NULL) {
+                formatError = true;
+                break;
+            }
 
-        reqOffset += sizeof32(WireFormat::MultiOp::Request::WritePart);
+            reqOffset += sizeof32(WireFormat::MultiOp::Request::WritePart);
 
-        if (rpc->requestPayload->size() < reqOffset + currentReq->length) {
-            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-            break;
+            if (rpc->requestPayload->size() < reqOffset + currentReq->length) {
+                formatError = true;
+                break;
+            }
+            responses[batchSize] = rpc->replyPayload->emplaceAppend<
+                    WireFormat::MultiOp::Response::WritePart>();
+
+            objects[batchSize].construct(currentReq->tableId, 0, 0,
+                    *(rpc->requestPayload), reqOffset, currentReq->length);
+            objectPointers[batchSize] = objects[batchSize].get();
+            rejectRules[batchSize] = currentReq->rejectRules;
+            versions[batchSize] = 0;
+            reqOffset += currentReq->length;
+            requestInsertIndexEntries(*objects[batchSize], &indexUpdates);
+            batchSize++;
         }
-        WireFormat::MultiOp::Response::WritePart* currentResp =
-                rpc->replyPayload->emplaceAppend<
-                WireFormat::MultiOp::Response::WritePart>();
-
-        Object object(currentReq->tableId, 0, 0, *(rpc->requestPayload),
-                reqOffset, currentReq->length);
-
-        // Insert new index entries, if any, before writing object (for strong
-        // consistency).
-        requestInsertIndexEntries(object);
 
-        // Write the object.
-        RejectRules rejectRules = currentReq->rejectRules;
-        try {
-            currentResp->status = objectManager.writeObject(
-                    object, &rejectRules, &currentResp->version,
-                    &oldObjectBuffers[i]);
+        // Insert new index entries, if any, before writing the objects (for
+        // strong consistency). The entries of the whole batch travel
+        // together.
+        indexEntryBatcher.start(&indexUpdates);
+        indexEntryBatcher.wait(&indexUpdates);
+
+        // Write the objects.
+        objectManager.writeObjects(batchSize, objectPointers, rejectRules,
+                versions, &oldObjectBuffers[i], statuses);
+        for (uint32_t j = 0; j < batchSize; j++) {
+            responses[j]->status = statuses[j];
+            responses[j]->version = versions[j];
         }
-        catch (RetryException& e) {
-            currentResp->status = STATUS_RETRY;
+        i += batchSize;
+
+        if (formatError) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            break;
         }
-        reqOffset += currentReq->length;
     }
 
     // By design, our response will be shorter than the request. This ensures
@@ -1595,12 +2362,71 @@ MasterService::multiWrite(const WireFormat::MultiOp::Request* reqHdr,
 
     // It is possible that some of the writes overwrote pre-existing values.
     // So, delete old index entries if any.
+    Tub<Object> oldObjects[numRequests];
+    IndexEntryBatcher::Updates indexUpdates;
     for (uint32_t i = 0; i < numRequests; i++) {
         if (oldObjectBuffers[i].size() > 0) {
-            Object oldObject(oldObjectBuffers[i]);
-            requestRemoveIndexEntries(oldObject);
+            oldObjects[i].construct(oldObjectBuffers[i]);
+            requestRemoveIndexEntries(*oldObjects[i], &indexUpdates);
         }
     }
+    indexEntryBatcher.start(&indexUpdates);
+    indexEntryBatcher.wait(&indexUpdates);
+}
+
+/**
+ * Top-level server method to handle the PATCH request, which replaces or
+ * appends a range of bytes in an object's value.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::patch(const WireFormat::Patch::Request* reqHdr,
+        WireFormat::Patch::Response* respHdr,
+        Rpc* rpc)
+{
+    assert(reqHdr->rpcId > 0);
+    UnackedRpcHandle rh(&unackedRpcResults,
+                        reqHdr->lease, reqHdr->rpcId, reqHdr->ackId);
+    if (rh.isDuplicate()) {
+        *respHdr = parseRpcResult<WireFormat::Patch>(rh.resultLoc());
+        rpc->sendReply();
+        return;
+    }
+
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->keyLength);
+    uint32_t dataOffset = reqOffset + reqHdr->keyLength;
+    if (stringKey == NULL ||
+            rpc->requestPayload->size() - dataOffset < reqHdr->length) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        rpc->sendReply();
+        return;
+    }
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+
+    RejectRules rejectRules = reqHdr->rejectRules;
+    uint64_t rpcResultPtr;
+    respHdr->common.status = STATUS_OK;
+    RpcResult rpcResult(
+            reqHdr->tableId, key.getHash(),
+            reqHdr->lease.leaseId, reqHdr->rpcId, reqHdr->ackId,
+            respHdr, sizeof(*respHdr));
+    respHdr->common.status = objectManager.patchObject(key, reqHdr->offset,
+            rpc->requestPayload, dataOffset, reqHdr->length, &rejectRules,
+            &respHdr->version, &rpcResult, &rpcResultPtr);
+
+    if (respHdr->common.status == STATUS_OK) {
+        objectManager.syncChanges();
+        rh.recordCompletion(rpcResultPtr);
+    } else if (respHdr->common.status != STATUS_RETRY &&
+               respHdr->common.status != STATUS_UNKNOWN_TABLET) {
+        // As in write: record the failure so that a retry of this rpc
+        // gets the same answer.
+        objectManager.writeRpcResultOnly(&rpcResult, &rpcResultPtr);
+        rh.recordCompletion(rpcResultPtr);
+    }
 }
 
 /**
@@ -1670,6 +2496,9 @@ MasterService::prepForMigration(
 {
     // Open question: Are there situations where we should decline this request?
 
+    // The data that follows is hashed by the table's function.
+    Key::setHashFunction(reqHdr->tableId, Key::HashFunction(reqHdr->keyHash));
+
     // Try to add the tablet. If it fails, there's some overlapping tablet.
     bool added = tabletManager.addTablet(reqHdr->tableId,
             reqHdr->firstKeyHash, reqHdr->lastKeyHash,
@@ -1745,13 +2574,52 @@ MasterService::read(const WireFormat::Read::Request* reqHdr,
     RejectRules rejectRules = reqHdr->rejectRules;
     bool valueOnly = true;
     uint32_t initialLength = rpc->replyPayload->size();
+    RemoteReadTable::Hint hint;
     respHdr->common.status = objectManager.readObject(
-            key, rpc->replyPayload, &rejectRules, &respHdr->version, valueOnly);
+            key, rpc->replyPayload, &rejectRules, &respHdr->version, valueOnly,
+            reqHdr->wantRemoteReadHint ? &hint : NULL);
 
+    if (respHdr->common.status == STATUS_UNKNOWN_TABLET &&
+            reqHdr->allowReplica &&
+            hotKeyReplicator.readReplica(key, rpc->replyPayload,
+                                         &respHdr->version)) {
+        respHdr->common.status = STATUS_OK;
+        respHdr->length = rpc->replyPayload->size() - initialLength;
+        respHdr->fromReplica = 1;
+        return;
+    }
+    if (respHdr->common.status == STATUS_UNKNOWN_TABLET) {
+        // The tablet may be one we are still recovering.
+        OnDemandRecovery::KeyState state = onDemandRecovery.checkKey(key);
+        if (state == OnDemandRecovery::PENDING) {
+            throw RetryException(HERE, 100, 1000,
+                    "object is still being recovered");
+        }
+        if (state == OnDemandRecovery::READY) {
+            respHdr->common.status = objectManager.readRecoveringObject(
+                    key, rpc->replyPayload, &rejectRules, &respHdr->version);
+            if (respHdr->common.status == STATUS_OK) {
+                respHdr->length = rpc->replyPayload->size() - initialLength;
+                TEST_LOG("read key being recovered");
+            }
+            return;
+        }
+    }
     if (respHdr->common.status != STATUS_OK)
         return;
 
     respHdr->length = rpc->replyPayload->size() - initialLength;
+    respHdr->remoteReadSlot = hint.slotAddress;
+    respHdr->remoteReadSlotKey = hint.slotKey;
+    respHdr->remoteReadObjectKey = hint.objectKey;
+    hotKeySketch.recordRead(key);
+    if (hotKeyReplicator.isEnabled()) {
+        hotKeyReplicator.recordRead(key, rpc->replyPayload, initialLength,
+                                    respHdr->length, respHdr->version);
+        if (reqHdr->allowReplica)
+            respHdr->hotReplicaCount = hotKeyReplicator.appendReplicaLocators(
+                    key, rpc->replyPayload);
+    }
 }
 
 /**
@@ -1777,27 +2645,183 @@ MasterService::readKeysAndValue(
         WireFormat::ReadKeysAndValue::Response* respHdr,
         Rpc* rpc)
 {
-    uint32_t reqOffset = sizeof32(*reqHdr);
-    const void* stringKey = rpc->requestPayload->getRange(
-            reqOffset, reqHdr->keyLength);
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->keyLength);
+
+    if (stringKey == NULL) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        rpc->sendReply();
+        return;
+    }
+
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+
+    RejectRules rejectRules = reqHdr->rejectRules;
+    uint32_t initialLength = rpc->replyPayload->size();
+    if (reqHdr->snapshotTime != 0) {
+        respHdr->common.status = objectManager.readSnapshotObject(key,
+                reqHdr->snapshotTime, rpc->replyPayload, &respHdr->version);
+    } else {
+        respHdr->common.status = objectManager.readObject(
+                key, rpc->replyPayload, &rejectRules, &respHdr->version);
+    }
+
+    if (respHdr->common.status != STATUS_OK)
+        return;
+
+    respHdr->length = rpc->replyPayload->size() - initialLength;
+}
+
+/**
+ * Top-level server method to handle the READ_LOG_CHANGES request, which
+ * returns the changes made to a table since a position in the log (see
+ * ObjectManager::readLogChanges). Clients pull one batch at a time, so a
+ * slow consumer only holds back itself.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::readLogChanges(
+        const WireFormat::ReadLogChanges::Request* reqHdr,
+        WireFormat::ReadLogChanges::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t initialLength = rpc->replyPayload->size();
+    uint32_t maxBytes = std::min(reqHdr->maxBytes,
+            downCast<uint32_t>(Transport::MAX_RPC_LEN - initialLength));
+    LogPosition position(reqHdr->segmentId, reqHdr->segmentOffset);
+    respHdr->changesLost = !objectManager.readLogChanges(reqHdr->tableId,
+            &position, rpc->replyPayload, initialLength + maxBytes);
+    respHdr->segmentId = position.getSegmentId();
+    respHdr->segmentOffset = position.getSegmentOffset();
+    respHdr->length = rpc->replyPayload->size() - initialLength;
+}
+
+/**
+ * Top-level server method to handle the READ_RANGE request, which returns
+ * only part of an object's value.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::readRange(const WireFormat::ReadRange::Request* reqHdr,
+        WireFormat::ReadRange::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->keyLength);
+
+    if (stringKey == NULL) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        rpc->sendReply();
+        return;
+    }
+
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+
+    // The value is only referenced here, not copied, so trimming it to the
+    // requested range before it goes into the reply is cheap.
+    RejectRules rejectRules = reqHdr->rejectRules;
+    Buffer value;
+    respHdr->common.status = objectManager.readObject(
+            key, &value, &rejectRules, &respHdr->version, true);
+    if (respHdr->common.status != STATUS_OK)
+        return;
+
+    respHdr->valueLength = value.size();
+    if (reqHdr->offset < value.size()) {
+        respHdr->length = std::min(reqHdr->length,
+                                   value.size() - reqHdr->offset);
+        rpc->replyPayload->append(&value, reqHdr->offset, respHdr->length);
+    }
+}
+
+/**
+ * Top-level server method to handle the READ_TABLE_SNAPSHOT request, which
+ * returns the objects of one tablet as they were at a single instant (see
+ * TableSnapshot). The first request for a tablet takes the snapshot; the
+ * client then passes the returned snapshot id back until the whole tablet
+ * has been returned.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::readTableSnapshot(
+        const WireFormat::ReadTableSnapshot::Request* reqHdr,
+        WireFormat::ReadTableSnapshot::Response* respHdr,
+        Rpc* rpc)
+{
+    OpenSnapshot open;
+    std::vector<OpenSnapshot> expired;
+    {
+        SpinLock::Guard _(openSnapshotsLock);
+        uint64_t now = Cycles::rdtsc();
+        uint64_t idleCycles = Cycles::fromSeconds(SNAPSHOT_IDLE_SECONDS);
+        for (std::unordered_map<uint64_t, OpenSnapshot>::iterator it =
+                openSnapshots.begin(); it != openSnapshots.end(); ) {
+            if (it->second.lastUsed + idleCycles <= now) {
+                expired.push_back(std::move(it->second));
+                it = openSnapshots.erase(it);
+            } else {
+                it++;
+            }
+        }
+        if (reqHdr->snapshotId != 0) {
+            std::unordered_map<uint64_t, OpenSnapshot>::iterator it =
+                    openSnapshots.find(reqHdr->snapshotId);
+            if (it != openSnapshots.end() &&
+                    it->second.tableId == reqHdr->tableId) {
+                open = std::move(it->second);
+                openSnapshots.erase(it);
+            }
+        }
+    }
 
-    if (stringKey == NULL) {
-        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-        rpc->sendReply();
+    if (reqHdr->snapshotId == 0) {
+        TabletManager::Tablet tablet;
+        if (!tabletManager.getTablet(reqHdr->tableId,
+                reqHdr->tabletFirstHash, &tablet) ||
+                tablet.state != TabletManager::NORMAL) {
+            respHdr->common.status = STATUS_UNKNOWN_TABLET;
+            return;
+        }
+        // As for enumerations, the tablet may have been merged with the one
+        // before it since the client looked it up; only return the part
+        // the client asked for.
+        open.snapshot.reset(new TableSnapshot(&objectManager,
+                reqHdr->tableId, reqHdr->tabletFirstHash, tablet.endKeyHash));
+        open.tableId = reqHdr->tableId;
+        open.tabletEndHash = tablet.endKeyHash;
+    } else if (!open.snapshot) {
+        // Discarded after sitting idle, or taken by an earlier incarnation
+        // of this server (or by another master that owned the tablet).
+        respHdr->common.status = STATUS_SNAPSHOT_TOO_OLD;
         return;
     }
 
-    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
-
-    RejectRules rejectRules = reqHdr->rejectRules;
+    // Leave room in the reply for one more object beyond the limit, as
+    // enumeration does.
+    uint32_t maxPayloadBytes = downCast<uint32_t>(
+            Transport::MAX_RPC_LEN - sizeof(*respHdr) - (1 << 20));
     uint32_t initialLength = rpc->replyPayload->size();
-    respHdr->common.status = objectManager.readObject(
-            key, rpc->replyPayload, &rejectRules, &respHdr->version);
-
-    if (respHdr->common.status != STATUS_OK)
+    bool more = open.snapshot->next(rpc->replyPayload, maxPayloadBytes);
+    respHdr->payloadBytes = rpc->replyPayload->size() - initialLength;
+    if (!more) {
+        respHdr->snapshotId = 0;
+        respHdr->tabletFirstHash = open.tabletEndHash + 1;
         return;
+    }
 
-    respHdr->length = rpc->replyPayload->size() - initialLength;
+    respHdr->tabletFirstHash = reqHdr->tabletFirstHash;
+    open.lastUsed = Cycles::rdtsc();
+    SpinLock::Guard _(openSnapshotsLock);
+    uint64_t id = reqHdr->snapshotId;
+    while (id == 0 || openSnapshots.find(id) != openSnapshots.end())
+        id = nextSnapshotId++;
+    respHdr->snapshotId = id;
+    openSnapshots[id] = std::move(open);
 }
 
 /**
@@ -1858,14 +2882,19 @@ MasterService::receiveMigrationData(
     SegmentIterator it(segmentMemory, segmentBytes, certificate);
     it.checkMetadataIntegrity();
 
-    SideLog sideLog(objectManager.getLog());
+    // Several of these rpcs may be replayed at once (on different worker
+    // threads) for the same tablet; replay copes with entries arriving
+    // out of order. Each segment may also be replayed by several threads.
     if (reqHdr->isIndexletData) {
         // In case we're receiving data corresponding to an indexlet, compute
         // the nextNodeId while replaying segment.
         LOG(DEBUG, "Recovering nextNodeId.");
         std::unordered_map<uint64_t, uint64_t> nextNodeIdMap;
         nextNodeIdMap[tableId] = 0;
-        objectManager.replaySegment(&sideLog, it, &nextNodeIdMap);
+        ParallelSegmentReplay replay(&objectManager,
+                config->master.migrationReplayThreads, &nextNodeIdMap);
+        replay.replaySegment(it);
+        replay.commit();
         if (nextNodeIdMap[tableId] > 0) {
             const void* key = rpc->requestPayload->getRange(
                     0, reqHdr->keyLength);
@@ -1875,9 +2904,11 @@ MasterService::receiveMigrationData(
                     nextNodeIdMap[tableId]);
         }
     } else {
-        objectManager.replaySegment(&sideLog, it);
+        ParallelSegmentReplay replay(&objectManager,
+                config->master.migrationReplayThreads, NULL);
+        replay.replaySegment(it);
+        replay.commit();
     }
-    sideLog.commit();
 }
 
 /**
@@ -1935,6 +2966,10 @@ MasterService::remove(const WireFormat::Remove::Request* reqHdr,
                                            // written.
                                            // Otherwise, RPC state should reset
                                            // especially for STATUS_RETRY.
+        if (hotKeyReplicator.isEnabled()) {
+            hotKeyReplicator.objectChanged(key, NULL, 0, respHdr->version,
+                                           true);
+        }
     } else if (respHdr->common.status != STATUS_RETRY &&
                respHdr->common.status != STATUS_UNKNOWN_TABLET) {
         // Above status requires a client to retry. We should not write
@@ -1992,9 +3027,15 @@ MasterService::removeIndexEntry(
  * to the index servers.
  * \param object
  *      Object for which index entries are to be inserted.
+ * \param updates
+ *      If NULL, the entries are inserted before this method returns.
+ *      Otherwise they are only added to these updates, and the caller
+ *      applies them with indexEntryBatcher (along with those for other
+ *      objects, for example). The object must not go away until then.
  */
 void
-MasterService::requestInsertIndexEntries(Object& object)
+MasterService::requestInsertIndexEntries(Object& object,
+        IndexEntryBatcher::Updates* updates)
 {
     KeyCount keyCount = object.getKeyCount();
     if (keyCount <= 1)
@@ -2006,9 +3047,10 @@ MasterService::requestInsertIndexEntries(Object& object)
     KeyHash primaryKeyHash =
             Key(tableId, primaryKey, primaryKeyLength).getHash();
 
-    Tub<InsertIndexEntryRpc> rpcs[keyCount-1];
+    IndexEntryBatcher::Updates ownUpdates;
+    if (updates == NULL)
+        updates = &ownUpdates;
 
-    // Send rpcs to all index servers involved.
     for (KeyCount keyIndex = 1; keyIndex <= keyCount - 1; keyIndex++) {
         KeyLength keyLength;
         const void* key = object.getKey(keyIndex, &keyLength);
@@ -2021,16 +3063,14 @@ MasterService::requestInsertIndexEntries(Object& object)
                             keyLength).c_str(),
                     primaryKeyHash);
 
-            rpcs[keyIndex-1].construct(this->context, tableId, keyIndex,
+            updates->insert(tableId, keyIndex,
                     key, keyLength, primaryKeyHash);
         }
     }
 
-    // Wait to receive response to all rpcs.
-    for (KeyCount keyIndex = 1; keyIndex <= keyCount - 1; keyIndex++) {
-        if (rpcs[keyIndex-1]) {
-            rpcs[keyIndex-1]->wait();
-        }
+    if (updates == &ownUpdates) {
+        indexEntryBatcher.start(updates);
+        indexEntryBatcher.wait(updates);
     }
 }
 
@@ -2041,9 +3081,14 @@ MasterService::requestInsertIndexEntries(Object& object)
  * \param object
  *      Information about the object for which index entries are to be
  *      deleted.
+ * \param updates
+ *      If NULL, the entries are removed before this method returns.
+ *      Otherwise they are only added to these updates; see
+ *      requestInsertIndexEntries.
  */
 void
-MasterService::requestRemoveIndexEntries(Object& object)
+MasterService::requestRemoveIndexEntries(Object& object,
+        IndexEntryBatcher::Updates* updates)
 {
     KeyCount keyCount = object.getKeyCount();
     if (keyCount <= 1)
@@ -2055,9 +3100,10 @@ MasterService::requestRemoveIndexEntries(Object& object)
     KeyHash primaryKeyHash =
             Key(tableId, primaryKey, primaryKeyLength).getHash();
 
-    Tub<RemoveIndexEntryRpc> rpcs[keyCount-1];
+    IndexEntryBatcher::Updates ownUpdates;
+    if (updates == NULL)
+        updates = &ownUpdates;
 
-    // Send rpcs to all index servers involved.
     for (KeyCount keyIndex = 1; keyIndex <= keyCount - 1; keyIndex++) {
         KeyLength keyLength;
         const void* key = object.getKey(keyIndex, &keyLength);
@@ -2070,16 +3116,14 @@ MasterService::requestRemoveIndexEntries(Object& object)
                             keyLength).c_str(),
                     primaryKeyHash);
 
-            rpcs[keyIndex-1].construct(this->context, tableId, keyIndex,
+            updates->remove(tableId, keyIndex,
                     key, keyLength, primaryKeyHash);
         }
     }
 
-    // Wait to receive response to all rpcs.
-    for (KeyCount keyIndex = 1; keyIndex <= keyCount - 1; keyIndex++) {
-        if (rpcs[keyIndex-1]) {
-            rpcs[keyIndex-1]->wait();
-        }
+    if (updates == &ownUpdates) {
+        indexEntryBatcher.start(updates);
+        indexEntryBatcher.wait(updates);
     }
 }
 
@@ -2179,11 +3223,8 @@ MasterService::migrateSingleIndexObject(
         // the destination.
 
         Object object(logEntryBuffer);
-        Buffer nodeObjectValue;
-        object.appendValueToBuffer(&nodeObjectValue);
-
         if (!indexletManager.isGreaterOrEqual(
-                &nodeObjectValue, splitKey, splitKeyLength)) {
+                object, splitKey, splitKeyLength)) {
             LOG(DEBUG, "Found entry that doesn't belong to "
                     "the partition being migrated. Continuing to the next.");
             return 0;
@@ -2247,6 +3288,78 @@ MasterService::migrateSingleIndexObject(
     return 0;
 }
 
+/**
+ * Top-level server method to handle the SCAN request, which returns the
+ * objects of a table in a range of primary keys, in key order (see
+ * ObjectManager::scanObjects). Tablets are still partitioned by key hash,
+ * so every master holding part of the table has some of the keys in any
+ * range; the client scans them all and merges the results. The tablets
+ * that were scanned are returned too, so that the client can tell whether
+ * it missed any.
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::scan(const WireFormat::Scan::Request* reqHdr,
+        WireFormat::Scan::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* startKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->startKeyLength);
+    reqOffset += reqHdr->startKeyLength;
+    const void* endKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->endKeyLength);
+    if ((startKey == NULL && reqHdr->startKeyLength > 0) ||
+            (endKey == NULL && reqHdr->endKeyLength > 0)) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        rpc->sendReply();
+        return;
+    }
+
+    TabletManager::Tablet tablet;
+    if (!tabletManager.getTablet(reqHdr->tableId, reqHdr->keyHash, &tablet) ||
+            tablet.state != TabletManager::NORMAL) {
+        respHdr->common.status = STATUS_UNKNOWN_TABLET;
+        return;
+    }
+
+    vector<TabletManager::Tablet> before;
+    tabletManager.getTablets(&before);
+    uint32_t tabletBytes = 0;
+    foreach (TabletManager::Tablet& t, before) {
+        if (t.tableId == reqHdr->tableId)
+            tabletBytes += sizeof32(WireFormat::Scan::Tablet);
+    }
+    respHdr->more = objectManager.scanObjects(reqHdr->tableId,
+            startKey, reqHdr->startKeyLength, endKey, reqHdr->endKeyLength,
+            reqHdr->maxObjects, Transport::MAX_RPC_LEN - tabletBytes,
+            rpc->replyPayload, &respHdr->numObjects);
+
+    // Only tablets that were in the NORMAL state both before and after the
+    // scan are known to have been scanned completely.
+    vector<TabletManager::Tablet> after;
+    tabletManager.getTablets(&after);
+    respHdr->numTablets = 0;
+    foreach (TabletManager::Tablet& t, after) {
+        if (t.tableId != reqHdr->tableId || t.state != TabletManager::NORMAL)
+            continue;
+        foreach (TabletManager::Tablet& old, before) {
+            if (old.tableId == t.tableId &&
+                    old.startKeyHash == t.startKeyHash &&
+                    old.endKeyHash == t.endKeyHash &&
+                    old.state == TabletManager::NORMAL) {
+                WireFormat::Scan::Tablet* scanned = rpc->replyPayload->
+                        emplaceAppend<WireFormat::Scan::Tablet>();
+                scanned->startKeyHash = t.startKeyHash;
+                scanned->endKeyHash = t.endKeyHash;
+                respHdr->numTablets++;
+                break;
+            }
+        }
+    }
+}
+
 /**
  * Top-level server method to handle the SPLIT_AND_MIGRAGE_INDEXLET request.
  *
@@ -2273,7 +3386,8 @@ MasterService::splitAndMigrateIndexlet(
 
     // Mark this request as read-only, to avoid deadlock when performing
     // epoch-related waits below.
-    rpc->worker->rpc->activities = Transport::ServerRpc::READ_ACTIVITY;
+    rpc->worker->rpc->logProtectorPin.setActivities(
+            Transport::ServerRpc::READ_ACTIVITY);
 
     if (splitKey == NULL) {
         throw FatalError(HERE, "Ill-formed RPC in splitAndMigrateIndexlet.");
@@ -2354,7 +3468,7 @@ MasterService::splitAndMigrateIndexlet(
                 tableId, indexId, splitKey, splitKeyLength);
 
         // Wait for the remainder of already running writes to finish.
-        LogProtector::wait(context, Transport::ServerRpc::APPEND_ACTIVITY);
+        LogProtector::wait(Transport::ServerRpc::APPEND_ACTIVITY);
     }
 
     // Phase 3: finish iterating over the remaining log entries.
@@ -2449,6 +3563,7 @@ MasterService::takeTabletOwnership(
         logEverSynced = true;
     }
 
+    Key::setHashFunction(reqHdr->tableId, Key::HashFunction(reqHdr->keyHash));
     bool added = tabletManager.addTablet(reqHdr->tableId,
             reqHdr->firstKeyHash, reqHdr->lastKeyHash,
             TabletManager::NORMAL);
@@ -2579,47 +3694,15 @@ MasterService::txDecision(const WireFormat::TxDecision::Request* reqHdr,
         transactionManager.markTransactionRecovered(txId);
     }
 
-    if (reqHdr->decision == WireFormat::TxDecision::COMMIT) {
-        for (uint32_t i = 0; i < participantCount; ++i) {
-            TabletManager::Tablet tablet;
-            if (!tabletManager.getTablet(participants[i].tableId,
-                                         participants[i].keyHash,
-                                         &tablet)
-                 || tablet.state != TabletManager::NORMAL) {
-                respHdr->common.status = STATUS_UNKNOWN_TABLET;
-                rpc->sendReply();
-                return;
-            }
-
-            uint64_t opPtr = transactionManager.getOp(reqHdr->leaseId,
-                                                      participants[i].rpcId);
-
-            // Skip if object is not prepared since it is already committed.
-            if (!opPtr) {
-                continue;
-            }
-
-            Buffer opBuffer;
-            Log::Reference opRef(opPtr);
-            objectManager.getLog()->getEntry(opRef, opBuffer);
-            PreparedOp op(opBuffer, 0, opBuffer.size());
-
-            Status status = STATUS_REQUEST_FORMAT_ERROR;
-            if (op.header.type == WireFormat::TxPrepare::READ) {
-                status = objectManager.commitRead(op, opRef);
-            } else if (op.header.type == WireFormat::TxPrepare::REMOVE) {
-                status = objectManager.commitRemove(op, opRef);
-            } else if (op.header.type == WireFormat::TxPrepare::WRITE) {
-                status = objectManager.commitWrite(op, opRef);
-            }
-
-            if (status != STATUS_OK) {
-                respHdr->common.status = status;
-                rpc->sendReply();
-                return;
-            }
-        }
-    } else if (reqHdr->decision == WireFormat::TxDecision::ABORT) {
+    if (reqHdr->decision == WireFormat::TxDecision::COMMIT ||
+            reqHdr->decision == WireFormat::TxDecision::ABORT) {
+        // Gather the operations that are still prepared, so that the
+        // decision can be logged for all of them at once.
+        Buffer opBuffers[participantCount];
+        Tub<PreparedOp> ops[participantCount];
+        PreparedOp* opPtrs[participantCount];
+        Log::Reference opRefs[participantCount];
+        uint32_t numOps = 0;
         for (uint32_t i = 0; i < participantCount; ++i) {
             TabletManager::Tablet tablet;
             if (!tabletManager.getTablet(participants[i].tableId,
@@ -2640,18 +3723,30 @@ MasterService::txDecision(const WireFormat::TxDecision::Request* reqHdr,
                 continue;
             }
 
-            Buffer opBuffer;
-            Log::Reference opRef(opPtr);
-            objectManager.getLog()->getEntry(opRef, opBuffer);
-            PreparedOp op(opBuffer, 0, opBuffer.size());
-
-            Status status = objectManager.commitRead(op, opRef);
-
-            if (status != STATUS_OK) {
-                respHdr->common.status = status;
+            opRefs[numOps] = Log::Reference(opPtr);
+            objectManager.getLog()->getEntry(opRefs[numOps],
+                                             opBuffers[numOps]);
+            ops[numOps].construct(opBuffers[numOps], 0,
+                                  opBuffers[numOps].size());
+            if (ops[numOps]->header.type != WireFormat::TxPrepare::READ &&
+                    ops[numOps]->header.type != WireFormat::TxPrepare::REMOVE &&
+                    ops[numOps]->header.type != WireFormat::TxPrepare::WRITE) {
+                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
                 rpc->sendReply();
                 return;
             }
+            opPtrs[numOps] = ops[numOps].get();
+            numOps++;
+        }
+
+        Status status = objectManager.commitPreparedOps(numOps, opPtrs,
+                opRefs,
+                reqHdr->decision == WireFormat::TxDecision::COMMIT,
+                reqHdr->commitTime);
+        if (status != STATUS_OK) {
+            respHdr->common.status = status;
+            rpc->sendReply();
+            return;
         }
     } else if (reqHdr->decision == WireFormat::TxDecision::RECOVERED) {
         for (uint32_t i = 0; i < participantCount; ++i) {
@@ -2857,12 +3952,30 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
 
     reqOffset += sizeof32(WireFormat::TxParticipant) * participantCount;
 
+    // Read-only transactions are only validated, and don't need their
+    // participant list since nothing about them is ever recovered.
+    const WireFormat::TxPrepare::OpType* firstType =
+            rpc->requestPayload->getOffset<WireFormat::TxPrepare::OpType>(
+            reqOffset);
+    if (firstType != NULL && *firstType == WireFormat::TxPrepare::READONLY) {
+        txValidateReadOnly(reqHdr, respHdr, rpc, reqOffset);
+        return;
+    }
+
     if (participantCount == 0 || participants == NULL) {
         respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
         rpc->sendReply();
         return;
     }
 
+    // When this request carries every operation of the transaction, this is
+    // the only server involved and the transaction can be committed in one
+    // step.
+    if (reqHdr->opCount == participantCount && firstType != NULL) {
+        txPrepareSingleServer(reqHdr, respHdr, rpc, reqOffset);
+        return;
+    }
+
     ParticipantList participantList(participants,
                                     participantCount,
                                     reqHdr->lease.leaseId,
@@ -2886,7 +3999,6 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
 
     // 2. Process operations.
     uint32_t numRequests = reqHdr->opCount;
-    uint32_t numReadOnly = 0;
 
     clusterClock.updateClock(ClusterTime(reqHdr->lease.timestamp));
 
@@ -2987,48 +4099,6 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
                          currentReq->length);
 
             reqOffset += currentReq->length;
-        } else if (*type == WireFormat::TxPrepare::READONLY) {
-            numReadOnly++;
-            const WireFormat::TxPrepare::Request::ReadOp *currentReq =
-                    rpc->requestPayload->getOffset<
-                    WireFormat::TxPrepare::Request::ReadOp>(reqOffset);
-
-            reqOffset += sizeof32(WireFormat::TxPrepare::Request::ReadOp);
-
-            if (currentReq == NULL || rpc->requestPayload->size() <
-                                      reqOffset + currentReq->keyLength) {
-                respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
-                respHdr->vote = WireFormat::TxPrepare::ABORT;
-                break;
-            }
-            tableId = currentReq->tableId;
-            rpcId = currentReq->rpcId;
-            rejectRules = currentReq->rejectRules;
-
-            buffer.emplaceAppend<KeyCount>((unsigned char) 1);
-            buffer.emplaceAppend<CumulativeKeyLength>(currentReq->keyLength);
-            buffer.appendExternal(rpc->requestPayload, reqOffset,
-                                  currentReq->keyLength);
-
-            op.construct(*type, txId.clientLeaseId, txId.clientTransactionId,
-                         rpcId,
-                         tableId, 0, 0,
-                         buffer);
-
-            reqOffset += currentReq->keyLength;
-
-            // Since we prepare not to write anything on log and sync with
-            // backup and it is still safe without linearizability,
-            // we skip all linearizability mechanism for READONLY transactions.
-            bool isCommitVote;
-            respHdr->common.status = objectManager.prepareReadOnly(
-                    *op, &rejectRules, &isCommitVote);
-            if (!isCommitVote || respHdr->common.status != STATUS_OK) {
-                respHdr->vote = WireFormat::TxPrepare::ABORT;
-                break;
-            }
-            respHdr->vote = WireFormat::TxPrepare::PREPARED;
-            continue;
         } else {
             respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
             break;
@@ -3067,7 +4137,7 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
         try {
             respHdr->common.status = objectManager.prepareOp(
                     *op, &rejectRules, &newOpPtr, &isCommitVote,
-                    &rpcResult, &rpcResultPtr);
+                    &rpcResult, &rpcResultPtr, reqHdr->snapshotTime);
         } catch (RetryException& e) {
             objectManager.syncChanges();
             throw;
@@ -3084,66 +4154,266 @@ MasterService::txPrepare(const WireFormat::TxPrepare::Request* reqHdr,
         rh->recordCompletion(rpcResultPtr);
     }
 
-    // when it is a single server transaction, we commit the transaction
-    // preemptively, so that a client doesn't need to send decision RPC.
-    // Assume that if there is at least one READ-ONLY request they should all
-    // be READ-ONLY and thus not need a decision phase.
-    if (numReadOnly == 0 && numRequests == participantCount &&
-            respHdr->common.status == STATUS_OK &&
-            respHdr->vote == WireFormat::TxPrepare::PREPARED) {
-        for (uint32_t i = 0; i < participantCount; ++i) {
-            uint64_t opPtr = transactionManager.getOp(reqHdr->lease.leaseId,
-                                                      participants[i].rpcId);
+    // By design, our response will be shorter than the request. This ensures
+    // that the response can go back in a single RPC.
+    assert(rpc->replyPayload->size() <= Transport::MAX_RPC_LEN);
 
-            // Skip if object is not prepared since it is already committed.
-            if (!opPtr) {
-                continue;
-            }
+    // All of the individual writes were done asynchronously. Sync the objects
+    // now to propagate them in bulk to backups.
+    objectManager.syncChanges();
 
-            Buffer opBuffer;
-            Log::Reference opRef(opPtr);
-            objectManager.getLog()->getEntry(opRef, opBuffer);
-            PreparedOp op(opBuffer, 0, opBuffer.size());
+    // Snapshot-isolation transactions commit after the time of every
+    // participant (see ClientTransactionTask::commitTime).
+    respHdr->clusterTime = clusterClock.getTime().getEncoded();
 
-            Status status = STATUS_REQUEST_FORMAT_ERROR;
+    // Respond to the client RPC now. Removing old index entries can be
+    // done asynchronously while maintaining strong consistency.
+    rpc->sendReply();
+}
 
-            if (op.header.type == WireFormat::TxPrepare::READ) {
-                status = objectManager.commitRead(op, opRef);
-            } else if (op.header.type == WireFormat::TxPrepare::REMOVE) {
-                status = objectManager.commitRemove(op, opRef);
-            } else if (op.header.type == WireFormat::TxPrepare::WRITE) {
-                status = objectManager.commitWrite(op, opRef);
-            }
+/**
+ * Helper for txPrepare that handles a TX_PREPARE request carrying every
+ * operation of its transaction, which means that this server is the only
+ * participant. Rather than preparing the operations and then committing
+ * them, the transaction is committed directly (or aborted) with
+ * ObjectManager::commitTransaction. No ParticipantList, PreparedOps or
+ * PreparedOpTombstones are logged and the transaction is never registered
+ * with the TransactionManager, since it is never left in a prepared state
+ * that would need recovery.
+ *
+ * \param reqHdr
+ *      Header from the incoming RPC request.
+ * \param[out] respHdr
+ *      Header for the response that will be returned to the client.
+ * \param[out] rpc
+ *      Complete information about the remote procedure call.
+ * \param reqOffset
+ *      Offset of the first operation in the request.
+ */
+void
+MasterService::txPrepareSingleServer(
+        const WireFormat::TxPrepare::Request* reqHdr,
+        WireFormat::TxPrepare::Response* respHdr,
+        Rpc* rpc, uint32_t reqOffset)
+{
+    using WireFormat::TxPrepare;
+    uint32_t numOps = reqHdr->opCount;
+    Buffer* payload = rpc->requestPayload;
 
-            // When an error happens in preemptive commit, we just respond
-            // with the regular response (vote == PREPARED) to the prepare RPC.
-            // Possible causes are tablet migration and slow log cleaner.
-            // All of them can be resolved by retry of txDecision.
-            if (status != STATUS_OK) {
-                objectManager.syncChanges();
-                rpc->sendReply();
-                return;
+    clusterClock.updateClock(ClusterTime(reqHdr->lease.timestamp));
+
+    // 1. Extract the operations from the request.
+    Tub<PreparedOp> ops[numOps];
+    PreparedOp* opPointers[numOps];
+    Buffer keyBuffers[numOps];
+    RejectRules rejectRules[numOps];
+    for (uint32_t i = 0; i < numOps; i++) {
+        const TxPrepare::OpType* type =
+                payload->getOffset<TxPrepare::OpType>(reqOffset);
+        bool keyOnly = false;
+        uint64_t tableId = 0, rpcId = 0;
+        uint32_t keyLength = 0;
+        if (type != NULL && *type == TxPrepare::WRITE) {
+            const TxPrepare::Request::WriteOp* currentReq =
+                    payload->getOffset<TxPrepare::Request::WriteOp>(reqOffset);
+            reqOffset += sizeof32(TxPrepare::Request::WriteOp);
+            if (currentReq != NULL &&
+                    payload->size() >= reqOffset + currentReq->length) {
+                rejectRules[i] = currentReq->rejectRules;
+                ops[i].construct(TxPrepare::WRITE, reqHdr->lease.leaseId,
+                        reqHdr->clientTxId, currentReq->rpcId,
+                        currentReq->tableId, 0, 0, *payload, reqOffset,
+                        currentReq->length);
+                reqOffset += currentReq->length;
+            }
+        } else if (type != NULL && (*type == TxPrepare::READ ||
+                                    *type == TxPrepare::READONLY)) {
+            const TxPrepare::Request::ReadOp* currentReq =
+                    payload->getOffset<TxPrepare::Request::ReadOp>(reqOffset);
+            reqOffset += sizeof32(TxPrepare::Request::ReadOp);
+            if (currentReq != NULL) {
+                keyOnly = true;
+                tableId = currentReq->tableId;
+                rpcId = currentReq->rpcId;
+                keyLength = currentReq->keyLength;
+                rejectRules[i] = currentReq->rejectRules;
             }
+        } else if (type != NULL && *type == TxPrepare::REMOVE) {
+            const TxPrepare::Request::RemoveOp* currentReq =
+                    payload->getOffset<TxPrepare::Request::RemoveOp>(
+                    reqOffset);
+            reqOffset += sizeof32(TxPrepare::Request::RemoveOp);
+            if (currentReq != NULL) {
+                keyOnly = true;
+                tableId = currentReq->tableId;
+                rpcId = currentReq->rpcId;
+                keyLength = currentReq->keyLength;
+                rejectRules[i] = currentReq->rejectRules;
+            }
+        }
 
-            transactionManager.removeOp(reqHdr->lease.leaseId,
-                                        participants[i].rpcId);
+        // READ and REMOVE operations carry just a key.
+        if (keyOnly && payload->size() >= reqOffset + keyLength) {
+            keyBuffers[i].emplaceAppend<KeyCount>((unsigned char) 1);
+            keyBuffers[i].emplaceAppend<CumulativeKeyLength>(
+                    downCast<KeyLength>(keyLength));
+            keyBuffers[i].appendExternal(payload, reqOffset, keyLength);
+            ops[i].construct(*type == TxPrepare::REMOVE ? TxPrepare::REMOVE
+                                                        : TxPrepare::READ,
+                    reqHdr->lease.leaseId, reqHdr->clientTxId, rpcId,
+                    tableId, 0, 0, keyBuffers[i]);
+            reqOffset += keyLength;
+        }
+        if (!ops[i]) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            respHdr->vote = TxPrepare::ABORT;
+            rpc->sendReply();
+            return;
         }
-        respHdr->vote = WireFormat::TxPrepare::COMMITTED;
+        opPointers[i] = ops[i].get();
     }
 
-    // By design, our response will be shorter than the request. This ensures
-    // that the response can go back in a single RPC.
-    assert(rpc->replyPayload->size() <= Transport::MAX_RPC_LEN);
+    // 2. If this is a retry, the transaction was already decided: the
+    // RpcResults of all of its operations were logged together.
+    std::vector<UnackedRpcHandle> rpcHandles;
+    rpcHandles.reserve(numOps);
+    for (uint32_t i = 0; i < numOps; i++) {
+        uint64_t rpcId = ops[i]->header.rpcId;
+        rpcHandles.emplace_back(&unackedRpcResults, reqHdr->lease, rpcId,
+                                reqHdr->ackId);
+        if (rpcHandles.back().isDuplicate()) {
+            respHdr->vote =
+                    parsePrepRpcResult(rpcHandles.back().resultLoc());
+            rpc->sendReply();
+            return;
+        }
+    }
 
-    // All of the individual writes were done asynchronously. Sync the objects
-    // now to propagate them in bulk to backups.
+    // 3. Commit.
+    TxPrepare::Vote vote = TxPrepare::COMMITTED;
+    Tub<RpcResult> rpcResults[numOps];
+    RpcResult* rpcResultPointers[numOps];
+    uint64_t rpcResultPtrs[numOps];
+    for (uint32_t i = 0; i < numOps; i++) {
+        KeyLength pKeyLen;
+        const void* pKey = ops[i]->object.getKey(0, &pKeyLen);
+        uint64_t tableId = ops[i]->object.getTableId();
+        uint64_t rpcId = ops[i]->header.rpcId;
+        rpcResults[i].construct(tableId, Key::getHash(tableId, pKey, pKeyLen),
+                reqHdr->lease.leaseId, rpcId, reqHdr->ackId,
+                &vote, sizeof32(vote));
+        rpcResultPointers[i] = rpcResults[i].get();
+    }
+
+    bool isCommitted;
+    try {
+        respHdr->common.status = objectManager.commitTransaction(numOps,
+                opPointers, rejectRules, rpcResultPointers, rpcResultPtrs,
+                &isCommitted, reqHdr->snapshotTime);
+    } catch (RetryException& e) {
+        objectManager.syncChanges();
+        throw;
+    }
+    if (respHdr->common.status != STATUS_OK || !isCommitted) {
+        // Nothing was written; a retry of this request will simply be
+        // executed again, as the handles forget the rpcs.
+        respHdr->vote = TxPrepare::ABORT;
+        rpc->sendReply();
+        return;
+    }
+    for (uint32_t i = 0; i < numOps; i++)
+        rpcHandles[i].recordCompletion(rpcResultPtrs[i]);
+    respHdr->vote = TxPrepare::COMMITTED;
+
+    // Make the transaction durable before telling the client it committed.
     objectManager.syncChanges();
+    rpc->sendReply();
+}
 
-    // Respond to the client RPC now. Removing old index entries can be
-    // done asynchronously while maintaining strong consistency.
+/**
+ * Helper for txPrepare that handles a TX_PREPARE request for a read-only
+ * transaction. Each operation carries the version of the object that the
+ * transaction read, and the transaction can commit if every one of them is
+ * still current and not locked by a transaction in progress. The objects
+ * are compared against on the spot: nothing is locked or logged, the
+ * transaction isn't registered with the TransactionManager, and no
+ * linearizability records are kept (a retry just validates again).
+ *
+ * \param reqHdr
+ *      Header from the incoming RPC request.
+ * \param[out] respHdr
+ *      Header for the response that will be returned to the client.
+ * \param[out] rpc
+ *      Complete information about the remote procedure call.
+ * \param reqOffset
+ *      Offset of the first operation in the request.
+ */
+void
+MasterService::txValidateReadOnly(
+        const WireFormat::TxPrepare::Request* reqHdr,
+        WireFormat::TxPrepare::Response* respHdr,
+        Rpc* rpc, uint32_t reqOffset)
+{
+    using WireFormat::TxPrepare;
+    Buffer* payload = rpc->requestPayload;
+
+    respHdr->common.status = STATUS_OK;
+    respHdr->vote = TxPrepare::PREPARED;
+    for (uint32_t i = 0; i < reqHdr->opCount; i++) {
+        const TxPrepare::Request::ReadOp* currentReq =
+                payload->getOffset<TxPrepare::Request::ReadOp>(reqOffset);
+        reqOffset += sizeof32(TxPrepare::Request::ReadOp);
+        const void* keyString = NULL;
+        if (currentReq != NULL && currentReq->type == TxPrepare::READONLY) {
+            keyString = payload->getRange(reqOffset, currentReq->keyLength);
+        }
+        if (keyString == NULL) {
+            respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+            respHdr->vote = TxPrepare::ABORT;
+            break;
+        }
+        Key key(currentReq->tableId, keyString, currentReq->keyLength);
+        reqOffset += currentReq->keyLength;
+
+        RejectRules rejectRules = currentReq->rejectRules;
+        bool isCommitVote;
+        respHdr->common.status = objectManager.validateReadOnly(key,
+                &rejectRules, &isCommitVote);
+        if (!isCommitVote || respHdr->common.status != STATUS_OK) {
+            respHdr->vote = TxPrepare::ABORT;
+            break;
+        }
+    }
     rpc->sendReply();
 }
 
+/**
+ * Top-level server method to handle the UPDATE_HOT_REPLICA request, which
+ * another master sends to store, refresh or drop the replica of one of its
+ * hot objects here (see HotKeyReplicator).
+ *
+ * \copydetails Service::ping
+ */
+void
+MasterService::updateHotReplica(
+        const WireFormat::UpdateHotReplica::Request* reqHdr,
+        WireFormat::UpdateHotReplica::Response* respHdr,
+        Rpc* rpc)
+{
+    uint32_t reqOffset = sizeof32(*reqHdr);
+    const void* stringKey = rpc->requestPayload->getRange(
+            reqOffset, reqHdr->keyLength);
+    const void* value = rpc->requestPayload->getRange(
+            reqOffset + reqHdr->keyLength, reqHdr->length);
+    if (stringKey == NULL || (value == NULL && reqHdr->length > 0)) {
+        respHdr->common.status = STATUS_REQUEST_FORMAT_ERROR;
+        return;
+    }
+    Key key(reqHdr->tableId, stringKey, reqHdr->keyLength);
+    hotKeyReplicator.updateReplica(key, value, reqHdr->length,
+            reqHdr->version, reqHdr->leaseMicros, reqHdr->remove);
+}
+
 /**
  * Top-level server method to handle the WRITE request.
  *
@@ -3159,6 +4429,12 @@ MasterService::write(const WireFormat::Write::Request* reqHdr,
                         reqHdr->lease, reqHdr->rpcId, reqHdr->ackId);
     if (rh.isDuplicate()) {
         *respHdr = parseRpcResult<WireFormat::Write>(rh.resultLoc());
+        if (respHdr->common.status == STATUS_OK &&
+                reqHdr->durability != WireFormat::Write::ALL_REPLICAS) {
+            // The original write may not be durable yet; the head is a safe
+            // (if late) position for the client to wait for.
+            appendWritePosition(rpc->replyPayload);
+        }
         rpc->sendReply();
         return;
     }
@@ -3170,6 +4446,8 @@ MasterService::write(const WireFormat::Write::Request* reqHdr,
     // This is also used to get key information to update indexes as needed.
     Object object(reqHdr->tableId, 0, 0, *(rpc->requestPayload),
             sizeof32(*reqHdr));
+    if (reqHdr->ttl != 0)
+        object.setExpiry(WallTime::secondsTimestamp() + reqHdr->ttl);
 
     // Insert new index entries, if any, before writing object.
     requestInsertIndexEntries(object);
@@ -3197,11 +4475,28 @@ MasterService::write(const WireFormat::Write::Request* reqHdr,
             &rpcResult, &rpcResultPtr);
 
     if (respHdr->common.status == STATUS_OK) {
-        objectManager.syncChanges();
+        if (reqHdr->durability == WireFormat::Write::ALL_REPLICAS) {
+            objectManager.syncChanges();
+        } else {
+            // Tell the client where the object ended up, so that it can find
+            // out later when the write became fully durable.
+            appendWritePosition(rpc->replyPayload);
+            bool oneBackup =
+                    reqHdr->durability == WireFormat::Write::ONE_BACKUP;
+            objectManager.syncChanges(oneBackup ? 1 : 0);
+        }
         rh.recordCompletion(rpcResultPtr); // Complete only if RpcResult is
                                            // written.
                                            // Otherwise, RPC state should reset
                                            // especially for STATUS_RETRY.
+        Key key(reqHdr->tableId, pKey, pKeyLen);
+        hotKeySketch.recordWrite(key);
+        if (hotKeyReplicator.isEnabled()) {
+            uint32_t valueLength;
+            const void* value = object.getValue(&valueLength);
+            hotKeyReplicator.objectChanged(key, value, valueLength,
+                                           respHdr->version, false);
+        }
     } else if (respHdr->common.status != STATUS_RETRY &&
                respHdr->common.status != STATUS_UNKNOWN_TABLET) {
         // Above status requires a client to retry. We should not write
@@ -3507,10 +4802,12 @@ MasterService::recover(uint64_t recoveryId, ServerId masterId,
     auto notStarted = replicas.begin();
     auto replicasEnd = replicas.end();
 
-    // The SideLog we'll append recovered entries to. It will be committed after
-    // replay completes on all segments, making all of the recovered data
-    // durable.
-    SideLog sideLog(objectManager.getLog());
+    // Replays recovered entries into one SideLog per replay thread. They
+    // will be committed after replay completes on all segments, making all
+    // of the recovered data durable.
+    ParallelSegmentReplay replay(&objectManager,
+                                 config->master.recoveryReplayThreads,
+                                 &nextNodeIdMap);
 
     // Start RPCs
     auto replicaIt = notStarted;
@@ -3625,7 +4922,9 @@ MasterService::recover(uint64_t recoveryId, ServerId masterId,
                                     ReplicatedSegment::recoveryStart),
                             task->replica.segmentId, responseLen);
                 }
-                objectManager.replaySegment(&sideLog, it, &nextNodeIdMap);
+                replay.replaySegment(it);
+                if (config->master.onDemandRecovery)
+                    onDemandRecovery.segmentReplayed(task->replica.segmentId);
                 usefulTime += Cycles::rdtsc() - startUseful;
                 TEST_LOG("Segment %lu replay complete",
                          task->replica.segmentId);
@@ -3684,6 +4983,30 @@ MasterService::recover(uint64_t recoveryId, ServerId masterId,
                 ++notStarted;
             }
 
+            // Segments that may hold keys clients are waiting for come
+            // first (see OnDemandRecovery).
+            uint64_t urgentId;
+            while (!task && onDemandRecovery.nextUrgentSegment(&urgentId)) {
+                if (contains(runningSet, urgentId))
+                    continue;
+                foreach (auto it, segmentIdToBackups.equal_range(urgentId)) {
+                    Replica& replica = *it.second;
+                    if (replica.state != Replica::State::NOT_STARTED)
+                        continue;
+                    LOG(DEBUG, "Starting getRecoveryData from %s for segment "
+                            "%lu on channel %ld (requested by a read)",
+                            context->serverList->toString(
+                                    replica.backupId).c_str(),
+                            replica.segmentId, &task - &tasks[0]);
+                    task.construct(context, recoveryId, masterId,
+                            partitionId, replica);
+                    replica.state = Replica::State::WAITING;
+                    runningSet.insert(replica.segmentId);
+                    ++metrics->master.segmentReadCount;
+                    break;
+                }
+            }
+
             // Find the next NOT_STARTED entry that isn't in-flight
             // from another entry.
             auto replicaIt = notStarted;
@@ -3725,7 +5048,7 @@ MasterService::recover(uint64_t recoveryId, ServerId masterId,
                 0 - metrics->transport.infiniband.transmitActiveTicks;
         metrics->master.logSyncPostingWriteRpcTicks =
                 0 - metrics->master.replicationPostingWriteRpcTicks;
-        sideLog.commit();
+        replay.commit();
         metrics->master.logSyncBytes += metrics->transport.transmit.byteCount;
         metrics->master.logSyncTransmitCopyTicks +=
                 metrics->transport.transmit.copyTicks;
@@ -3827,6 +5150,8 @@ MasterService::recover(const WireFormat::Recover::Request* reqHdr,
     // own them yet).
     foreach (const ProtoBuf::Tablets::Tablet& newTablet,
              recoveryPartition.tablet()) {
+        Key::setHashFunction(newTablet.table_id(),
+                Key::HashFunction(newTablet.key_hash()));
         bool added = tabletManager.addTablet(newTablet.table_id(),
                 newTablet.start_key_hash(), newTablet.end_key_hash(),
                 TabletManager::NOT_READY);
@@ -3852,6 +5177,13 @@ MasterService::recover(const WireFormat::Recover::Request* reqHdr,
     // Record the log position before recovery started.
     LogPosition headOfLog = objectManager.getLog()->rollHeadOver();
 
+    if (config->master.onDemandRecovery) {
+        onDemandRecovery.start(recoveryId, crashedServerId, partitionId,
+                recoveryPartition);
+        foreach (const Replica& replica, replicas)
+            onDemandRecovery.addReplica(replica.backupId, replica.segmentId);
+    }
+
     // Recover Segments, firing ObjectManager::replaySegment for each one.
     bool successful = false;
     try {
@@ -4002,6 +5334,7 @@ MasterService::recover(const WireFormat::Recover::Request* reqHdr,
         objectManager.removeOrphanedObjects();
         transactionManager.removeOrphanedOps();
     }
+    onDemandRecovery.finish();
 }
 
 } // namespace RAMCloud
@@ -16,6 +16,9 @@
 #ifndef RAMCLOUD_MASTERSERVICE_H
 #define RAMCLOUD_MASTERSERVICE_H
 
+#include <deque>
+#include <unordered_map>
+
 #include "Common.h"
 #include "ClientLeaseValidator.h"
 #include "ClusterClock.h"
@@ -24,10 +27,14 @@
 #include "LogCleaner.h"
 #include "LogIterator.h"
 #include "HashTable.h"
+#include "HotKeyReplicator.h"
+#include "HotKeySketch.h"
+#include "IndexEntryBatcher.h"
 #include "MasterTableMetadata.h"
 #include "Object.h"
 #include "ObjectFinder.h"
 #include "ObjectManager.h"
+#include "OnDemandRecovery.h"
 #include "ReplicaManager.h"
 #include "RpcResult.h"
 #include "SegmentIterator.h"
@@ -38,6 +45,8 @@
 #include "Service.h"
 #include "SideLog.h"
 #include "SpinLock.h"
+#include "TableConfigCache.h"
+#include "TableSnapshot.h"
 #include "TabletManager.h"
 #include "TransactionManager.h"
 #include "TxRecoveryManager.h"
@@ -51,6 +60,7 @@ namespace RAMCloud {
 namespace MasterServiceInternal {
 class RecoveryTask;
 }
+class MigrationSender;
 
 /**
  * An object of this class represents a RAMCloud server, which can
@@ -63,6 +73,7 @@ class MasterService : public Service {
     virtual ~MasterService();
 
     void dispatch(WireFormat::Opcode opcode, Rpc* rpc);
+    HotKeySketch* getHotKeySketch() { return &hotKeySketch; }
 
     /*
      * The following class is used to temporarily disable the servicing of
@@ -112,6 +123,12 @@ class MasterService : public Service {
      */
     IndexletManager indexletManager;
 
+    /**
+     * Sends the index entry insertions and removals for objects written and
+     * removed on this master to the index servers, in batches.
+     */
+    IndexEntryBatcher indexEntryBatcher;
+
     /**
      * Keeps track of the logically most recent cluster-time that this master
      * service either directly or indirectly received from the coordinator.
@@ -135,6 +152,12 @@ class MasterService : public Service {
      */
     TransactionManager transactionManager;
 
+    /**
+     * Copies of table configurations that this master hands out to
+     * clients on behalf of the coordinator.
+     */
+    TableConfigCache tableConfigCache;
+
 #ifdef TESTING
     /// Used to pause the read-increment-write cycle in incrementObject
     /// between the read and the write.  While paused, a second thread can
@@ -148,6 +171,13 @@ class MasterService : public Service {
 #endif
 
   PRIVATE:
+    void append(const WireFormat::Append::Request* reqHdr,
+                WireFormat::Append::Response* respHdr,
+                Rpc* rpc);
+    void appendWritePosition(Buffer* replyPayload);
+    void bulkLoad(const WireFormat::BulkLoad::Request* reqHdr,
+                WireFormat::BulkLoad::Response* respHdr,
+                Rpc* rpc);
     void dropTabletOwnership(
                 const WireFormat::DropTabletOwnership::Request* reqHdr,
                 WireFormat::DropTabletOwnership::Response* respHdr,
@@ -162,6 +192,14 @@ class MasterService : public Service {
     void enumerate(const WireFormat::Enumerate::Request* reqHdr,
                 WireFormat::Enumerate::Response* respHdr,
                 Rpc* rpc);
+    void getCachedTableConfig(
+                const WireFormat::GetCachedTableConfig::Request* reqHdr,
+                WireFormat::GetCachedTableConfig::Response* respHdr,
+                Rpc* rpc);
+    void getDurablePosition(
+                const WireFormat::GetDurablePosition::Request* reqHdr,
+                WireFormat::GetDurablePosition::Response* respHdr,
+                Rpc* rpc);
     void getHeadOfLog(const WireFormat::GetHeadOfLog::Request* reqHdr,
                 WireFormat::GetHeadOfLog::Response* respHdr,
                 Rpc* rpc);
@@ -187,11 +225,17 @@ class MasterService : public Service {
                 const WireFormat::Increment::Request* reqHdr = NULL,
                 WireFormat::Increment::Response* respHdr = NULL,
                 uint64_t *rpcResultPtr = NULL);
+    struct PendingIncrement;
+    void combineIncrement(PendingIncrement* increment);
+    void performIncrements(std::vector<PendingIncrement*>& batch);
     void readHashes(
                 const WireFormat::ReadHashes::Request* reqHdr,
                 WireFormat::ReadHashes::Response* respHdr,
                 Rpc* rpc);
     void initOnceEnlisted();
+    void indexEntryBatch(const WireFormat::IndexEntryBatch::Request* reqHdr,
+                WireFormat::IndexEntryBatch::Response* respHdr,
+                Rpc* rpc);
     void insertIndexEntry(const WireFormat::InsertIndexEntry::Request* reqHdr,
                 WireFormat::InsertIndexEntry::Response* respHdr,
                 Rpc* rpc);
@@ -201,6 +245,10 @@ class MasterService : public Service {
     void lookupIndexKeys(const WireFormat::LookupIndexKeys::Request* reqHdr,
                 WireFormat::LookupIndexKeys::Response* respHdr,
                 Rpc* rpc);
+    void lookupIndexKeysAndRead(
+                const WireFormat::LookupIndexKeysAndRead::Request* reqHdr,
+                WireFormat::LookupIndexKeysAndRead::Response* respHdr,
+                Rpc* rpc);
     int migrateSingleIndexObject(
                 ServerId newOwnerMasterId, uint64_t tableId, uint8_t indexId,
                 uint64_t currentBackingTableId, uint64_t newBackingTableId,
@@ -213,13 +261,13 @@ class MasterService : public Service {
                 WireFormat::SplitAndMigrateIndexlet::Response* respHdr);
   public: // For MigrateTabletBenchmark.
     Status migrateSingleLogEntry(SegmentIterator& it,
-                Tub<Segment>& transferSeg,
+                std::unique_ptr<Segment>& transferSeg,
                 uint64_t entryTotals[],
                 uint64_t& totalBytes,
                 uint64_t tableId,
                 uint64_t firstKeyHash,
                 uint64_t lastKeyHash,
-                ServerId receiver);
+                MigrationSender* sender);
   PRIVATE:
     void migrateTablet(const WireFormat::MigrateTablet::Request* reqHdr,
                 WireFormat::MigrateTablet::Response* respHdr,
@@ -239,6 +287,9 @@ class MasterService : public Service {
     void multiWrite(const WireFormat::MultiOp::Request* reqHdr,
                 WireFormat::MultiOp::Response* respHdr,
                 Rpc* rpc);
+    void patch(const WireFormat::Patch::Request* reqHdr,
+                WireFormat::Patch::Response* respHdr,
+                Rpc* rpc);
     void prepForIndexletMigration(
                 const WireFormat::PrepForIndexletMigration::Request* reqHdr,
                 WireFormat::PrepForIndexletMigration::Response* respHdr,
@@ -252,6 +303,16 @@ class MasterService : public Service {
     void readKeysAndValue(const WireFormat::ReadKeysAndValue::Request* reqHdr,
                 WireFormat::ReadKeysAndValue::Response* respHdr,
                 Rpc* rpc);
+    void readLogChanges(const WireFormat::ReadLogChanges::Request* reqHdr,
+                WireFormat::ReadLogChanges::Response* respHdr,
+                Rpc* rpc);
+    void readRange(const WireFormat::ReadRange::Request* reqHdr,
+                WireFormat::ReadRange::Response* respHdr,
+                Rpc* rpc);
+    void readTableSnapshot(
+                const WireFormat::ReadTableSnapshot::Request* reqHdr,
+                WireFormat::ReadTableSnapshot::Response* respHdr,
+                Rpc* rpc);
     void receiveMigrationData(
                 const WireFormat::ReceiveMigrationData::Request* reqHdr,
                 WireFormat::ReceiveMigrationData::Response* respHdr,
@@ -262,8 +323,13 @@ class MasterService : public Service {
     void removeIndexEntry(const WireFormat::RemoveIndexEntry::Request* reqHdr,
                 WireFormat::RemoveIndexEntry::Response* respHdr,
                 Rpc* rpc);
-    void requestInsertIndexEntries(Object& object);
-    void requestRemoveIndexEntries(Object& object);
+    void requestInsertIndexEntries(Object& object,
+                IndexEntryBatcher::Updates* updates = NULL);
+    void requestRemoveIndexEntries(Object& object,
+                IndexEntryBatcher::Updates* updates = NULL);
+    void scan(const WireFormat::Scan::Request* reqHdr,
+                WireFormat::Scan::Response* respHdr,
+                Rpc* rpc);
     void splitAndMigrateIndexlet(
                 const WireFormat::SplitAndMigrateIndexlet::Request* reqHdr,
                 WireFormat::SplitAndMigrateIndexlet::Response* respHdr,
@@ -295,6 +361,18 @@ class MasterService : public Service {
                 const WireFormat::TxPrepare::Request* reqHdr,
                 WireFormat::TxPrepare::Response* respHdr,
                 Rpc* rpc);
+    void txPrepareSingleServer(
+                const WireFormat::TxPrepare::Request* reqHdr,
+                WireFormat::TxPrepare::Response* respHdr,
+                Rpc* rpc, uint32_t reqOffset);
+    void txValidateReadOnly(
+                const WireFormat::TxPrepare::Request* reqHdr,
+                WireFormat::TxPrepare::Response* respHdr,
+                Rpc* rpc, uint32_t reqOffset);
+    void updateHotReplica(
+                const WireFormat::UpdateHotReplica::Request* reqHdr,
+                WireFormat::UpdateHotReplica::Response* respHdr,
+                Rpc* rpc);
     void write(const WireFormat::Write::Request* reqHdr,
                 WireFormat::Write::Response* respHdr,
                 Rpc* rpc);
@@ -439,6 +517,112 @@ class MasterService : public Service {
     };
     MigrationMonitor migrationMonitor;
 
+    /**
+     * An increment of an object that may be combined with concurrent
+     * increments of the same object into a single write; see
+     * combineIncrement(). The fields other than #state are the arguments
+     * of incrementObject().
+     */
+    struct PendingIncrement {
+        PendingIncrement(Key* key, int64_t* asInt64, double* asDouble,
+                         uint64_t* newVersion, Status* status,
+                         const WireFormat::Increment::Request* reqHdr,
+                         WireFormat::Increment::Response* respHdr,
+                         uint64_t* rpcResultPtr)
+            : key(key)
+            , asInt64(asInt64)
+            , asDouble(asDouble)
+            , newVersion(newVersion)
+            , status(status)
+            , reqHdr(reqHdr)
+            , respHdr(respHdr)
+            , rpcResultPtr(rpcResultPtr)
+            , state(WAITING)
+        {}
+
+        Key* key;
+        int64_t* asInt64;
+        double* asDouble;
+        uint64_t* newVersion;
+        Status* status;
+        const WireFormat::Increment::Request* reqHdr;
+        WireFormat::Increment::Response* respHdr;
+        uint64_t* rpcResultPtr;
+
+        /// WAITING while queued in #pendingIncrements; LEADING once the
+        /// thread that owns this increment must perform it (along with any
+        /// others queued for the object); DONE once another thread has
+        /// performed it and filled in the results.
+        std::atomic<int> state;
+
+        enum { WAITING, LEADING, DONE };
+
+        DISALLOW_COPY_AND_ASSIGN(PendingIncrement);
+    };
+
+    /// Protects #pendingIncrements.
+    SpinLock pendingIncrementsLock;
+
+    /**
+     * Increments waiting for the object they increment to be written by
+     * another thread, indexed by key hash. A key hash is present while some
+     * thread is performing increments of it.
+     */
+    std::unordered_map<KeyHash, std::deque<PendingIncrement*>>
+            pendingIncrements;
+
+    /**
+     * Tracks the most frequently read and written keys of this master.
+     */
+    HotKeySketch hotKeySketch;
+
+    /**
+     * Replicates this master's hot objects (as found by #hotKeySketch) on
+     * other masters, and serves replicas of other masters' hot objects.
+     */
+    HotKeyReplicator hotKeyReplicator;
+
+    /**
+     * Serves reads of the partition this master is recovering, if any,
+     * while it is replayed; only used if config->master.onDemandRecovery.
+     */
+    OnDemandRecovery onDemandRecovery;
+
+    /**
+     * A TableSnapshot of one tablet that a client is reading with
+     * READ_TABLE_SNAPSHOT.
+     */
+    struct OpenSnapshot {
+        OpenSnapshot()
+            : snapshot(), tableId(0), tabletEndHash(0), lastUsed(0)
+        {}
+
+        std::unique_ptr<TableSnapshot> snapshot;
+        uint64_t tableId;
+
+        /// Last key hash of the tablet; the client continues after it.
+        uint64_t tabletEndHash;
+
+        /// Cycles::rdtsc() time of the most recent READ_TABLE_SNAPSHOT.
+        uint64_t lastUsed;
+    };
+
+    /// Snapshots that no client has read for this long are discarded, so
+    /// that clients that go away don't pin log segments forever.
+    static const uint32_t SNAPSHOT_IDLE_SECONDS = 60;
+
+    /// Protects #openSnapshots and #nextSnapshotId.
+    SpinLock openSnapshotsLock;
+
+    /// Snapshots being read with READ_TABLE_SNAPSHOT, by id. A snapshot is
+    /// taken out of this map while a request reads it.
+    std::unordered_map<uint64_t, OpenSnapshot> openSnapshots;
+
+    /// Id to give the next snapshot. It starts at a random value, so that a
+    /// client of an earlier incarnation of this server can't pick up
+    /// someone else's snapshot.
+    uint64_t nextSnapshotId;
+
 ///////////////////////////////////////////////////////////////////////////////
 /////Recovery related code. This should eventually move into its own file./////
 ///////////////////////////////////////////////////////////////////////////////
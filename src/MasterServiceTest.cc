@@ -359,6 +359,64 @@ bool tabletCompare(const TabletManager::Tablet &a,
         return a.startKeyHash < b.startKeyHash;
 }
 
+TEST_F(MasterServiceTest, append_basics) {
+    uint64_t version;
+    ramcloud->append(1, "0", 1, "abc", 3, NULL, &version);
+    EXPECT_EQ(1U, version);
+    ramcloud->append(1, "0", 1, "def", 3, NULL, &version);
+    EXPECT_EQ(2U, version);
+
+    Buffer value;
+    ramcloud->read(1, "0", 1, &value, NULL, &version);
+    EXPECT_EQ("abcdef", TestUtil::toString(&value));
+    EXPECT_EQ(2U, version);
+
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.versionNeGiven = true;
+    rules.givenVersion = 1;
+    EXPECT_THROW(ramcloud->append(1, "0", 1, "g", 1, &rules, &version),
+            WrongVersionException);
+    EXPECT_EQ(2U, version);
+
+    // Enumeration returns the objects with the appended data.
+    Buffer iter, nextIter, objects;
+    EnumerateTableRpc rpc(ramcloud.get(), 1, false, 0, iter, objects);
+    rpc.wait(nextIter);
+    Buffer buffer;
+    buffer.appendExternal(objects.getRange(4, objects.size() - 4),
+            objects.size() - 4);
+    Object object(buffer);
+    EXPECT_EQ(2U, object.getVersion());
+    EXPECT_EQ("abcdef", string(reinterpret_cast<const char*>(
+            object.getValue()), 6));
+}
+
+TEST_F(MasterServiceTest, append_linearizable) {
+    ramcloud->write(1, "0", 1, "abc", 3);
+
+    AppendRpc appendRpc(ramcloud.get(), 1, "0", 1, "d", 1);
+    while (!appendRpc.isReady()) {
+        ramcloud->poll();
+    }
+    uint64_t version;
+    appendRpc.wait(&version);
+    EXPECT_EQ(2U, version);
+
+    // A retry must not append a second time.
+    WireFormat::Append::Request* reqHdr =
+        appendRpc.request.getStart<WireFormat::Append::Request>();
+    WireFormat::Append::Response respHdr;
+    Service::Rpc rpc(NULL, &appendRpc.request, appendRpc.response);
+    service->append(reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(2U, respHdr.version);
+
+    Buffer value;
+    ramcloud->read(1, "0", 1, &value);
+    EXPECT_EQ("abcd", TestUtil::toString(&value));
+}
+
 TEST_F(MasterServiceTest, dispatch_initializationNotFinished) {
     Buffer request, response;
     Service::Rpc rpc(NULL, &request, &response);
@@ -623,6 +681,87 @@ TEST_F(MasterServiceTest, enumerate_mergeTablet) {
     EXPECT_EQ(0U, objects.size());
 }
 
+TEST_F(MasterServiceTest, enumerate_logOrder) {
+    uint64_t version;
+    service->tabletManager.addTablet(2, 0, ~0UL, TabletManager::NORMAL);
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    ramcloud->write(1, "1", 1, "ghijkl", 6);
+    ramcloud->write(1, "0", 1, "mnopqr", 6, NULL, &version);
+    ramcloud->write(2, "2", 1, "stuvwx", 6);
+
+    // Objects come back in the order they were last written, once each.
+    Buffer iter, nextIter, finalIter, objects;
+    EnumerateTableRpc rpc(ramcloud.get(), 1, false, 0, iter, objects,
+            NULL, ~0UL, true);
+    EXPECT_EQ(0U, rpc.wait(nextIter));
+    EXPECT_EQ(76U, objects.size());
+    Object object1(objects, 4, 34);
+    EXPECT_EQ("1", string(reinterpret_cast<const char*>(
+            object1.getKey()), 1));
+    Object object2(objects, 42, 34);
+    EXPECT_EQ("0", string(reinterpret_cast<const char*>(
+            object2.getKey()), 1));
+    EXPECT_EQ(version, object2.getVersion());
+    EXPECT_EQ("mnopqr", string(reinterpret_cast<const char*>(
+            object2.getValue()), 6));
+
+    EnumerationIterator state(nextIter, 0, nextIter.size());
+    ASSERT_EQ(1U, state.size());
+    EXPECT_EQ(masterServer->serverId.getId(), state.top().logId);
+    EXPECT_EQ(service->objectManager.getLog()->getHead().getSegmentId(),
+            state.top().segmentId);
+
+    EnumerateTableRpc rpc2(ramcloud.get(), 1, false, 0, nextIter, objects,
+            NULL, ~0UL, true);
+    EXPECT_EQ(0U, rpc2.wait(finalIter));
+    EXPECT_EQ(0U, objects.size());
+}
+
+TEST_F(MasterServiceTest, enumerate_logOrderSurvivor) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    LogSegment* head = service->objectManager.segmentManager.getHeadSegment();
+
+    // Pretend the enumeration has passed the head already.
+    Buffer iter, nextIter, objects;
+    EnumerationIterator initialIter(iter, 0, 0);
+    initialIter.push(EnumerationIterator::Frame(0, ~0UL, 0, 0, 0,
+            masterServer->serverId.getId(), head->id + 1, 0, 0));
+    initialIter.serialize(iter);
+    EnumerateTableRpc rpc(ramcloud.get(), 1, false, 0, iter, objects,
+            NULL, ~0UL, true);
+    rpc.wait(nextIter);
+    EXPECT_EQ(0U, objects.size());
+
+    // If the cleaner has added a survivor behind the position since then,
+    // the enumeration goes back to it.
+    head->isSurvivor = true;
+    head->relocationGeneration = 1;
+    iter.reset();
+    initialIter.serialize(iter);
+    EnumerateTableRpc rpc2(ramcloud.get(), 1, false, 0, iter, objects,
+            NULL, ~0UL, true);
+    rpc2.wait(nextIter);
+    EXPECT_EQ(38U, objects.size());
+    head->isSurvivor = false;
+    head->relocationGeneration = 0;
+}
+
+TEST_F(MasterServiceTest, getDurablePosition) {
+    Log* log = service->objectManager.getLog();
+    LogPosition durable = log->getDurablePosition();
+    EXPECT_EQ(durable, MasterClient::getDurablePosition(&context,
+            masterServer->serverId));
+
+    // Appends that haven't been synced are only reported once a client
+    // asks for them.
+    log->append(LOG_ENTRY_TYPE_OBJ, "hi", 2);
+    LogPosition head = log->getHead();
+    EXPECT_EQ(durable, MasterClient::getDurablePosition(&context,
+            masterServer->serverId));
+    EXPECT_EQ(head, MasterClient::getDurablePosition(&context,
+            masterServer->serverId, head));
+}
+
 TEST_F(MasterServiceTest, getHeadOfLog) {
     EXPECT_EQ(LogPosition(2, 88),
             MasterClient::getHeadOfLog(&context, masterServer->serverId));
@@ -645,8 +784,11 @@ TEST_F(MasterServiceTest, getServerStatistics) {
     ramcloud->getServerStatistics("mock:host=master", serverStats);
     EXPECT_TRUE(StringUtil::startsWith(serverStats.ShortDebugString(),
             "tabletentry { table_id: 1 start_key_hash: 0 "
-            "end_key_hash: 18446744073709551615 number_read_and_writes: 4 } "
-            "spin_lock_stats { locks { name:"));
+            "end_key_hash: 18446744073709551615 number_read_and_writes: 4 "
+            "read_count: 3 write_count: 1 access_histogram: "));
+    EXPECT_EQ(8, serverStats.tabletentry(0).access_histogram_size());
+    EXPECT_TRUE(StringUtil::contains(serverStats.ShortDebugString(),
+            " } spin_lock_stats { locks { name:"));
 
     MasterClient::splitMasterTablet(&context, masterServer->serverId, 1,
             (~0UL/2));
@@ -868,6 +1010,84 @@ TEST_F(MasterServiceTest, increment_parallel) {
     EXPECT_EQ(2, value);
 }
 
+TEST_F(MasterServiceTest, increment_combined) {
+    const_cast<ServerConfig*>(service->config)->master.combineIncrements =
+            true;
+    int64_t value = 1;
+    ramcloud->write(1, "key0", 4, &value, sizeof(value));
+    EXPECT_EQ(3, ramcloud->incrementInt64(1, "key0", 4, 2));
+    EXPECT_EQ(3, ramcloud->incrementInt64(1, "key1", 4, 3));
+    EXPECT_TRUE(service->pendingIncrements.empty());
+}
+
+TEST_F(MasterServiceTest, performIncrements) {
+    int64_t value = 1;
+    uint64_t version;
+    ramcloud->write(1, "key0", 4, &value, sizeof(value), NULL, &version);
+    Key key(1, "key0", 4);
+
+    int64_t asInt64[3] = {1, 2, 3};
+    double asDouble[3] = {0, 0, 0};
+    uint64_t newVersions[3];
+    Status statuses[3];
+    WireFormat::Increment::Request reqHdr;
+    memset(&reqHdr, 0, sizeof(reqHdr));
+    reqHdr.tableId = 1;
+    reqHdr.lease.leaseId = 1;
+    reqHdr.rpcId = 10;
+    WireFormat::Increment::Response respHdr;
+    memset(&respHdr, 0, sizeof(respHdr));
+    uint64_t rpcResultPtr = 0;
+    MasterService::PendingIncrement first(&key, &asInt64[0], &asDouble[0],
+            &newVersions[0], &statuses[0], NULL, NULL, NULL);
+    MasterService::PendingIncrement second(&key, &asInt64[1], &asDouble[1],
+            &newVersions[1], &statuses[1], &reqHdr, &respHdr, &rpcResultPtr);
+    MasterService::PendingIncrement third(&key, &asInt64[2], &asDouble[2],
+            &newVersions[2], &statuses[2], NULL, NULL, NULL);
+    std::vector<MasterService::PendingIncrement*> batch =
+            {&first, &second, &third};
+
+    TestLog::Enable _("performIncrements");
+    service->performIncrements(batch);
+    EXPECT_EQ("performIncrements: combined 3 increments", TestLog::get());
+    EXPECT_EQ(2, asInt64[0]);
+    EXPECT_EQ(4, asInt64[1]);
+    EXPECT_EQ(7, asInt64[2]);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(STATUS_OK, statuses[i]);
+        EXPECT_EQ(version + 1, newVersions[i]);
+    }
+    EXPECT_EQ(4, respHdr.newValue.asInt64);
+    EXPECT_EQ(version + 1, respHdr.version);
+    EXPECT_NE(0UL, rpcResultPtr);
+
+    Buffer buffer;
+    ramcloud->read(1, "key0", 4, &buffer);
+    buffer.copy(0, sizeof(value), &value);
+    EXPECT_EQ(7, value);
+}
+
+TEST_F(MasterServiceTest, performIncrements_objectDoesntExist) {
+    Key key(1, "key0", 4);
+    int64_t asInt64[2] = {5, 6};
+    double asDouble[2] = {0, 0};
+    uint64_t newVersions[2];
+    Status statuses[2];
+    MasterService::PendingIncrement first(&key, &asInt64[0], &asDouble[0],
+            &newVersions[0], &statuses[0], NULL, NULL, NULL);
+    MasterService::PendingIncrement second(&key, &asInt64[1], &asDouble[1],
+            &newVersions[1], &statuses[1], NULL, NULL, NULL);
+    std::vector<MasterService::PendingIncrement*> batch = {&first, &second};
+
+    // The object has to be created by the first increment on its own.
+    TestLog::Enable _("performIncrements");
+    service->performIncrements(batch);
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(5, asInt64[0]);
+    EXPECT_EQ(11, asInt64[1]);
+    EXPECT_EQ(newVersions[0] + 1, newVersions[1]);
+}
+
 TEST_F(MasterServiceTest, migrateSingleLogEntry_basic) {
     // Populate segment
     Key key(1, "1", 1);
@@ -876,14 +1096,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_basic) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0xffffffffffffffff;
-    ServerId receiver(1);
 
     Status error;
     for (; !it.isDone(); it.next()) {
@@ -892,7 +1111,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_basic) {
                 *it.getCurrentSegmentIterator(),
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -911,14 +1130,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongTable) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 2;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0xffffffffffffffff;
-    ServerId receiver(1);
 
     Status error;
     for (; !it.isDone(); it.next()) {
@@ -927,7 +1145,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongTable) {
                 *it.getCurrentSegmentIterator(),
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -947,14 +1165,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongKeyHash) {
     EXPECT_EQ(STATUS_OK, service->objectManager.writeObject(obj, 0, 0));
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
-    ServerId receiver(1);
 
     Status error;
     for (; !it.isDone(); it.next()) {
@@ -963,7 +1180,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_wrongKeyHash) {
                 *it.getCurrentSegmentIterator(),
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -1002,14 +1219,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
         ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_RPCRESULT, buffer));
     }
 
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
-    ServerId receiver(1);
 
     TestLog::reset();
     Status error;
@@ -1019,7 +1235,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_rpcResult) {
                 it,
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -1090,14 +1306,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
         ASSERT_TRUE(segment.append(LOG_ENTRY_TYPE_PREPTOMB, buffer));
     }
 
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = keyToMigrate.getTableId();
     uint64_t firstKeyHash = keyToMigrate.getHash();
     uint64_t lastKeyHash = keyToMigrate.getHash();
-    ServerId receiver(1);
 
     TestLog::reset();
     Status error;
@@ -1107,7 +1322,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_prepAndprepTomb) {
                 it,
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -1150,14 +1365,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_decisionRecord) {
     }
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
-    ServerId receiver(1);
 
     TestLog::reset();
     Status error;
@@ -1166,7 +1380,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_decisionRecord) {
                 *it.getCurrentSegmentIterator(),
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -1235,14 +1449,13 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_participantList) {
     }
 
     LogIterator it(*service->objectManager.getLog());
-    Tub<Segment> transferSeg;
+    std::unique_ptr<Segment> transferSeg;
 
     uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES] = {0};
     uint64_t totalBytes = 0;
     uint64_t tableId = 1;
     uint64_t firstKeyHash = 0x0;
     uint64_t lastKeyHash = 0x0;
-    ServerId receiver(1);
 
     TestLog::reset();
     Status error;
@@ -1251,7 +1464,7 @@ TEST_F(MasterServiceTest, migrateSingleLogEntry_participantList) {
                 *it.getCurrentSegmentIterator(),
                 transferSeg, entryTotals, totalBytes,
                 tableId, firstKeyHash, lastKeyHash,
-                receiver);
+                NULL);
         if (error) break;
     }
 
@@ -1346,7 +1559,6 @@ TEST_F(MasterServiceTest, migrateTablet_movingData) {
     EXPECT_GT(LogProtector::getCurrentEpoch(), oldEpcoh);
     EXPECT_EQ("migrateTablet: Migrating tablet [0x0,0xffffffffffffffff] "
             "in tableId 1 to server 3.0 at mock:host=master2 | "
-            "migrateTablet: Sending last migration segment | "
             "migrateTablet: Migration succeeded for tablet "
             "[0x0,0xffffffffffffffff] in tableId 1; sent 1 objects and "
             "0 tombstones to server 3.0 at mock:host=master2, 92 bytes in total"
@@ -1365,6 +1577,44 @@ TEST_F(MasterServiceTest, migrateTablet_movingData) {
     EXPECT_LT(ctimeCoord, master2HeadPositionAfter);
 }
 
+TEST_F(MasterServiceTest, migrateTablet_parallel) {
+    masterServer->config.master.migrationThreads = 3;
+    masterServer->config.master.migrationSegmentsInFlight = 2;
+    ramcloud->createTable("migrationTable");
+    uint64_t tbl = ramcloud->getTableId("migrationTable");
+
+    // Enough data to fill several log segments, so the scanning threads
+    // each get some.
+    string value(4000, 'x');
+    for (int i = 0; i < 300; i++) {
+        string key = format("key%d", i);
+        ramcloud->write(tbl, key.c_str(), downCast<uint16_t>(key.length()),
+                value.c_str(), downCast<uint32_t>(value.length()));
+    }
+    ramcloud->remove(tbl, "key7", 4);
+    EXPECT_LT(2lu, service->objectManager.log.head->id);
+
+    ServerConfig master2Config = masterConfig;
+    master2Config.master.numReplicas = 0;
+    master2Config.master.migrationReplayThreads = 2;
+    master2Config.localLocator = "mock:host=master2";
+    Server* master2 = cluster.addServer(master2Config);
+    master2->master->objectManager.log.sync();
+
+    TestLog::Enable _("migrateTablet", NULL);
+    ramcloud->migrateTablet(tbl, 0, -1, master2->serverId);
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "sent 300 objects and 1 tombstones"));
+
+    EXPECT_EQ(master2->serverId, cluster.coordinator->tableManager.getTablet(
+            tbl, 0).serverId);
+    Buffer buffer;
+    ramcloud->read(tbl, "key299", 6, &buffer);
+    EXPECT_EQ(value.length(), buffer.size());
+    EXPECT_THROW(ramcloud->read(tbl, "key7", 4, &buffer),
+            ObjectDoesntExistException);
+}
+
 TEST_F(MasterServiceTest, multiIncrement_basics) {
     uint64_t tableId1 = ramcloud->createTable("table1");
 
@@ -1487,6 +1737,53 @@ TEST_F(MasterServiceTest, multiRead_bufferSizeExceeded) {
             50));
 }
 
+TEST_F(MasterServiceTest, multiRead_packedMalformedRequests) {
+    typedef WireFormat::MultiOp::Request::PackedReadPart PackedReadPart;
+    uint64_t tableId1 = ramcloud->createTable("table1");
+    WireFormat::MultiOp::Request reqHdr;
+    WireFormat::MultiOp::Response respHdr;
+    reqHdr.common.opcode = downCast<uint16_t>(WireFormat::MULTI_OP);
+    reqHdr.common.service = downCast<uint16_t>(WireFormat::MASTER_SERVICE);
+    reqHdr.count = 1;
+    reqHdr.type = WireFormat::MultiOp::OpType::PACKED_READ;
+
+    Buffer requestPayload;
+    Buffer replyPayload;
+    requestPayload.appendExternal(&reqHdr, sizeof32(reqHdr));
+    replyPayload.appendExternal(&respHdr, sizeof32(respHdr));
+    Service::Rpc rpc(NULL, &requestPayload, &replyPayload);
+
+    // The first part doesn't name a table.
+    requestPayload.emplaceAppend<uint8_t>(uint8_t(0));
+    requestPayload.emplaceAppend<uint8_t>(uint8_t(1));
+    requestPayload.appendCopy("0", 1);
+    respHdr.common.status = STATUS_OK;
+    service->multiRead(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, respHdr.common.status);
+
+    // The key length never ends.
+    requestPayload.truncate(sizeof32(reqHdr));
+    requestPayload.emplaceAppend<uint8_t>(
+            static_cast<uint8_t>(PackedReadPart::NEW_TABLE));
+    requestPayload.emplaceAppend<uint64_t>(tableId1);
+    requestPayload.emplaceAppend<uint8_t>(uint8_t(0x81));
+    respHdr.common.status = STATUS_OK;
+    service->multiRead(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, respHdr.common.status);
+
+    // Cross-validation: a complete part works.
+    requestPayload.truncate(requestPayload.size() - 1);
+    requestPayload.emplaceAppend<uint8_t>(uint8_t(1));
+    requestPayload.appendCopy("0", 1);
+    replyPayload.truncate(sizeof32(respHdr));
+    respHdr.common.status = STATUS_OK;
+    service->multiRead(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            replyPayload.getOffset<WireFormat::MultiOp::Response::ReadPart>(
+            sizeof32(respHdr))->status);
+}
+
 TEST_F(MasterServiceTest, multiRead_unknownTable) {
     // Table 99 will be directed to the server, but the server
     // doesn't know about it.
@@ -1765,6 +2062,64 @@ TEST_F(MasterServiceTest, multiWrite_malformedRequests) {
     EXPECT_EQ(STATUS_OK, respHdr.common.status);
 }
 
+TEST_F(MasterServiceTest, patch_basics) {
+    KeyInfo keyList[2];
+    keyList[0].keyLength = 2;
+    keyList[0].key = "ha";
+    keyList[1].keyLength = 2;
+    keyList[1].key = "hi";
+    ramcloud->write(1, 2, keyList, "abcdef", NULL, NULL, false);
+
+    uint64_t version;
+    ramcloud->patch(1, "ha", 2, 1, "XY", 2, NULL, &version);
+    EXPECT_EQ(2U, version);
+    ramcloud->patch(1, "ha", 2, 6, "!", 1, NULL, &version);
+    EXPECT_EQ(3U, version);
+
+    ObjectBuffer keysAndValue;
+    ramcloud->readKeysAndValue(1, "ha", 2, &keysAndValue);
+    EXPECT_EQ("aXYdef!", string(reinterpret_cast<const char*>(
+            keysAndValue.getValue()), 7));
+    EXPECT_EQ(2U, keysAndValue.getNumKeys());
+    EXPECT_EQ("hi", string(reinterpret_cast<const char *>(
+            keysAndValue.getKey(1)), 2));
+}
+
+TEST_F(MasterServiceTest, patch_errors) {
+    EXPECT_THROW(ramcloud->patch(1, "0", 1, 0, "XY", 2),
+            ObjectDoesntExistException);
+    ramcloud->write(1, "0", 1, "abc", 3);
+    uint64_t version;
+    EXPECT_THROW(ramcloud->patch(1, "0", 1, 4, "XY", 2, NULL, &version),
+            InvalidParameterException);
+    EXPECT_EQ(1U, version);
+}
+
+TEST_F(MasterServiceTest, patch_linearizable) {
+    ramcloud->write(1, "0", 1, "abc", 3);
+
+    PatchRpc patchRpc(ramcloud.get(), 1, "0", 1, 3, "d", 1);
+    while (!patchRpc.isReady()) {
+        ramcloud->poll();
+    }
+    uint64_t version;
+    patchRpc.wait(&version);
+    EXPECT_EQ(2U, version);
+
+    // A retry must not append a second time.
+    WireFormat::Patch::Request* reqHdr =
+        patchRpc.request.getStart<WireFormat::Patch::Request>();
+    WireFormat::Patch::Response respHdr;
+    Service::Rpc rpc(NULL, &patchRpc.request, patchRpc.response);
+    service->patch(reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(2U, respHdr.version);
+
+    Buffer value;
+    ramcloud->read(1, "0", 1, &value);
+    EXPECT_EQ("abcd", TestUtil::toString(&value));
+}
+
 TEST_F(MasterServiceTest, prepForMigration) {
     service->tabletManager.addTablet(5, 27, 873, TabletManager::NORMAL);
 
@@ -1897,6 +2252,13 @@ TEST_F(MasterServiceTest, readHashes) {
     respOffset += obj1Length;
     EXPECT_EQ("obj0value", string(reinterpret_cast<const char*>(o1.getValue()),
             o1.getValueLength()));
+
+    // The hint says how many objects of this size fit in a response.
+    uint32_t maxLength = service->maxResponseRpcLen
+            - sizeof32(WireFormat::ReadHashes::Response);
+    EXPECT_EQ(maxLength / (12 + obj1Length),
+            responseBuffer.getStart<WireFormat::ReadHashes::Response>()->
+            hashesPerResponse);
 }
 
 TEST_F(MasterServiceTest, read_basics) {
@@ -1967,6 +2329,127 @@ TEST_F(MasterServiceTest, read_rejectRules) {
     EXPECT_EQ(1U, version);
 }
 
+TEST_F(MasterServiceTest, readLogChanges) {
+    LogPosition position = MasterClient::getHeadOfLog(&context,
+            masterServer->serverId);
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    ramcloud->remove(1, "0", 1);
+
+    Buffer changes;
+    EXPECT_TRUE(MasterClient::readLogChanges(&context,
+            masterServer->serverId, 1, &position, 1000, &changes));
+    uint32_t offset = 0;
+    vector<LogEntryType> types;
+    while (offset < changes.size()) {
+        WireFormat::ReadLogChanges::Change* change = changes.getOffset<
+                WireFormat::ReadLogChanges::Change>(offset);
+        types.push_back(static_cast<LogEntryType>(change->type));
+        offset += sizeof32(*change) + change->length;
+    }
+    ASSERT_EQ(2U, types.size());
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, types[0]);
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJTOMB, types[1]);
+
+    LogPosition end = position;
+    EXPECT_TRUE(MasterClient::readLogChanges(&context,
+            masterServer->serverId, 1, &position, 1000, &changes));
+    EXPECT_EQ(0U, changes.size());
+    EXPECT_EQ(end, position);
+}
+
+TEST_F(MasterServiceTest, readRange) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    Buffer value;
+    uint64_t version;
+    uint32_t valueLength;
+    ramcloud->readRange(1, "0", 1, 2, 3, &value, NULL, &version, &valueLength);
+    EXPECT_EQ("cde", TestUtil::toString(&value));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ(6U, valueLength);
+
+    // Ranges are clipped to the end of the value.
+    ramcloud->readRange(1, "0", 1, 4, 10, &value);
+    EXPECT_EQ("ef", TestUtil::toString(&value));
+    ramcloud->readRange(1, "0", 1, 6, 10, &value);
+    EXPECT_EQ(0U, value.size());
+
+    EXPECT_THROW(ramcloud->readRange(1, "5", 1, 0, 1, &value),
+            ObjectDoesntExistException);
+}
+
+/**
+ * Returns the objects in a buffer filled by READ_TABLE_SNAPSHOT as
+ * "key:value" strings.
+ */
+static string
+snapshotObjects(Buffer* buffer)
+{
+    string result;
+    uint32_t offset = 0;
+    while (offset < buffer->size()) {
+        uint32_t length = *buffer->getOffset<uint32_t>(offset);
+        offset += sizeof32(length);
+        Object object(*buffer, offset, length);
+        KeyLength keyLength;
+        const char* key = static_cast<const char*>(
+                object.getKey(0, &keyLength));
+        uint32_t valueLength;
+        const char* value = static_cast<const char*>(
+                object.getValue(&valueLength));
+        result += (result.empty() ? "" : " ") + string(key, keyLength) +
+                ":" + string(value, valueLength);
+        offset += length;
+    }
+    return result;
+}
+
+TEST_F(MasterServiceTest, readTableSnapshot) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    uint64_t snapshotId = 0;
+    Buffer objects;
+    EXPECT_EQ(0U, ramcloud->readTableSnapshot(1, 0, &snapshotId, &objects));
+    EXPECT_EQ(0U, snapshotId);
+    EXPECT_EQ("0:abcdef", snapshotObjects(&objects));
+    EXPECT_EQ(0U, service->openSnapshots.size());
+}
+
+TEST_F(MasterServiceTest, readTableSnapshot_continue) {
+    ramcloud->write(1, "0", 1, "abcdef", 6);
+    MasterService::OpenSnapshot& open = service->openSnapshots[7];
+    open.snapshot.reset(new TableSnapshot(&service->objectManager, 1));
+    open.tableId = 1;
+    open.tabletEndHash = ~0UL;
+    open.lastUsed = Cycles::rdtsc();
+    ramcloud->write(1, "0", 1, "ghijkl", 6);
+
+    uint64_t snapshotId = 7;
+    Buffer objects;
+    EXPECT_EQ(0U, ramcloud->readTableSnapshot(1, 0, &snapshotId, &objects));
+    EXPECT_EQ(0U, snapshotId);
+    EXPECT_EQ("0:abcdef", snapshotObjects(&objects));
+    EXPECT_EQ(0U, service->openSnapshots.size());
+
+    // The snapshot is gone once it has been read completely.
+    snapshotId = 7;
+    EXPECT_THROW(ramcloud->readTableSnapshot(1, 0, &snapshotId, &objects),
+            SnapshotTooOldException);
+}
+
+TEST_F(MasterServiceTest, readTableSnapshot_idle) {
+    MasterService::OpenSnapshot& open = service->openSnapshots[7];
+    open.snapshot.reset(new TableSnapshot(&service->objectManager, 1));
+    open.tableId = 1;
+    open.tabletEndHash = ~0UL;
+    open.lastUsed = Cycles::rdtsc() - Cycles::fromSeconds(
+            MasterService::SNAPSHOT_IDLE_SECONDS + 1);
+
+    uint64_t snapshotId = 7;
+    Buffer objects;
+    EXPECT_THROW(ramcloud->readTableSnapshot(1, 0, &snapshotId, &objects),
+            SnapshotTooOldException);
+    EXPECT_EQ(0U, service->openSnapshots.size());
+}
+
 TEST_F(MasterServiceTest, receiveMigrationData) {
     Segment s;
 
@@ -2363,6 +2846,28 @@ TEST_F(MasterServiceTest, requestRemoveIndexEntries_basics) {
 }
 
 
+TEST_F(MasterServiceTest, scan) {
+    ramcloud->write(1, "b", 1, "2", 1);
+    ramcloud->write(1, "a", 1, "1", 1);
+    Key a(1, "a", 1);
+    Key b(1, "b", 1);
+    uint64_t split = std::max(a.getHash(), b.getHash());
+    service->tabletManager.splitTablet(1, split);
+    service->tabletManager.changeState(1, split, ~0UL, TabletManager::NORMAL,
+            TabletManager::NOT_READY);
+
+    // Only tablets in the NORMAL state are scanned and reported.
+    Buffer response;
+    ScanRpc rpc(ramcloud.get(), 1, 0, "", 0, "", 0, 10, &response);
+    uint32_t numObjects;
+    vector<WireFormat::Scan::Tablet> tablets;
+    EXPECT_FALSE(rpc.wait(&numObjects, &tablets));
+    ASSERT_EQ(1U, tablets.size());
+    EXPECT_EQ(0U, tablets[0].startKeyHash);
+    EXPECT_EQ(split - 1, tablets[0].endKeyHash);
+    EXPECT_EQ(1U, numObjects);
+}
+
 TEST_F(MasterServiceTest, splitAndMigrateIndexlet_indexletNotOnServer) {
     ServerConfig master2Config = masterConfig;
     master2Config.master.numReplicas = 0;
@@ -3531,10 +4036,13 @@ TEST_F(MasterServiceTest, txPrepare_singleRpcOptimization) {
                                 value.getRange(0, value.size())),
                                 value.size()));
     }
+    TestLog::Enable _("commitTransaction");
     service->txPrepare(&reqHdr, &respHdr, &rpc);
 
     EXPECT_EQ(STATUS_OK, respHdr.common.status);
     EXPECT_EQ(TxPrepare::COMMITTED, respHdr.vote);
+    EXPECT_EQ("commitTransaction: committed 3 operations in 6 log entries",
+              TestLog::get());
 
     // 4. Check outcome of Prepare.
     EXPECT_EQ(0U, service->transactionManager.items.size());
@@ -3557,6 +4065,18 @@ TEST_F(MasterServiceTest, txPrepare_singleRpcOptimization) {
     EXPECT_EQ("new", string(reinterpret_cast<const char*>(
                             value.getRange(0, value.size())),
                             value.size()));
+
+    // 5. A retry of the same rpc returns the recorded vote without
+    // applying the operations again.
+    TestLog::reset();
+    respBuffer.reset();
+    service->txPrepare(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::COMMITTED, respHdr.vote);
+    EXPECT_EQ("", TestLog::get());
+    value.reset();
+    ramcloud->read(1, "key3", 4, &value, NULL, &version);
+    EXPECT_EQ(4U, version);
 }
 
 TEST_F(MasterServiceTest, txPrepare_readOnly) {
@@ -3903,6 +4423,95 @@ TEST_F(MasterServiceTest, txPrepare_readOnly_failByVer) {
     EXPECT_FALSE(isObjectLocked(key3));
 }
 
+TEST_F(MasterServiceTest, txPrepare_readOnly_noParticipantList) {
+    ramcloud->write(1, "key1", 4, "item1", 5);
+    ramcloud->write(1, "key2", 4, "item2", 5);
+
+    using WireFormat::TxPrepare;
+    Key key1(1, "key1", 4);
+    Key key2(1, "key2", 4);
+
+    WireFormat::TxPrepare::Request reqHdr;
+    WireFormat::TxPrepare::Response respHdr;
+    Buffer reqBuffer, respBuffer;
+    Service::Rpc rpc(NULL, &reqBuffer, &respBuffer);
+
+    reqHdr.common.opcode = WireFormat::Opcode::TX_PREPARE;
+    reqHdr.common.service = WireFormat::MASTER_SERVICE;
+    reqHdr.lease = {1, 10, 5};
+    reqHdr.clientTxId = 9;
+    reqHdr.ackId = 8;
+    reqHdr.participantCount = 0;
+    reqHdr.opCount = 2;
+    reqBuffer.appendCopy(&reqHdr, sizeof32(reqHdr));
+
+    RejectRules rejectRules = {1UL, false, false, false, true};
+    TxPrepare::Request::ReadOp op1(key1.getTableId(), 10,
+                                   key1.getStringKeyLength(),
+                                   rejectRules, true);
+    reqBuffer.appendExternal(&op1, sizeof32(op1));
+    reqBuffer.appendExternal(key1.getStringKey(), key1.getStringKeyLength());
+    rejectRules = {2UL, false, false, false, true};
+    TxPrepare::Request::ReadOp op2(key2.getTableId(), 11,
+                                   key2.getStringKeyLength(),
+                                   rejectRules, true);
+    reqBuffer.appendExternal(&op2, sizeof32(op2));
+    reqBuffer.appendExternal(key2.getStringKey(), key2.getStringKeyLength());
+
+    LogPosition head = service->objectManager.getLog()->getHead();
+    service->txPrepare(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::PREPARED, respHdr.vote);
+
+    // Nothing was logged, locked or registered.
+    EXPECT_EQ(head, service->objectManager.getLog()->getHead());
+    EXPECT_EQ(0U, service->transactionManager.items.size());
+    EXPECT_FALSE(isObjectLocked(key1));
+    EXPECT_FALSE(isObjectLocked(key2));
+
+    // A later version of an object aborts the transaction.
+    ramcloud->write(1, "key2", 4, "item2", 5);
+    service->txPrepare(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_OK, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
+}
+
+TEST_F(MasterServiceTest, txPrepare_readOnly_mixedOps) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "key1", 4);
+    ramcloud->write(1, "key1", 4, "item1", 5);
+
+    WireFormat::TxPrepare::Request reqHdr;
+    WireFormat::TxPrepare::Response respHdr;
+    Buffer reqBuffer, respBuffer;
+    Service::Rpc rpc(NULL, &reqBuffer, &respBuffer);
+
+    reqHdr.common.opcode = WireFormat::Opcode::TX_PREPARE;
+    reqHdr.common.service = WireFormat::MASTER_SERVICE;
+    reqHdr.lease = {1, 10, 5};
+    reqHdr.clientTxId = 9;
+    reqHdr.ackId = 8;
+    reqHdr.participantCount = 0;
+    reqHdr.opCount = 2;
+    reqBuffer.appendCopy(&reqHdr, sizeof32(reqHdr));
+
+    RejectRules rejectRules = {1UL, false, false, false, true};
+    TxPrepare::Request::ReadOp op1(key1.getTableId(), 10,
+                                   key1.getStringKeyLength(),
+                                   rejectRules, true);
+    reqBuffer.appendExternal(&op1, sizeof32(op1));
+    reqBuffer.appendExternal(key1.getStringKey(), key1.getStringKeyLength());
+    TxPrepare::Request::ReadOp op2(key1.getTableId(), 11,
+                                   key1.getStringKeyLength(),
+                                   rejectRules, false);
+    reqBuffer.appendExternal(&op2, sizeof32(op2));
+    reqBuffer.appendExternal(key1.getStringKey(), key1.getStringKeyLength());
+
+    service->txPrepare(&reqHdr, &respHdr, &rpc);
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, respHdr.common.status);
+    EXPECT_EQ(TxPrepare::ABORT, respHdr.vote);
+}
+
 TEST_F(MasterServiceTest, write_basics) {
     ObjectBuffer value;
     uint64_t version;
@@ -3944,21 +4553,62 @@ TEST_F(MasterServiceTest, write_basics) {
     EXPECT_EQ(3U, version);
 }
 
+TEST_F(MasterServiceTest, write_durability) {
+    Log* log = service->objectManager.getLog();
+    ServerId masterId;
+    LogPosition position;
+
+    // Memory only: nothing is replicated until the client asks for it.
+    TestLog::Enable _("sync");
+    WriteRpc rpc(ramcloud.get(), 1, "key0", 4, "item0", 5, NULL, false, 0,
+            WireFormat::Write::MEMORY_ONLY);
+    rpc.wait(NULL, &masterId, &position);
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(masterServer->serverId, masterId);
+    EXPECT_EQ(log->getHead(), position);
+    EXPECT_LT(log->getDurablePosition(), position);
+    EXPECT_EQ(position, MasterClient::getDurablePosition(&context, masterId,
+            position));
+
+    // One backup: the write is replicated, but the durable position only
+    // advances with the next full sync.
+    TestLog::reset();
+    WriteRpc rpc2(ramcloud.get(), 1, "key0", 4, "item1", 5, NULL, false, 0,
+            WireFormat::Write::ONE_BACKUP);
+    rpc2.wait(NULL, &masterId, &position);
+    EXPECT_NE(string::npos, TestLog::get().find("log synced to 1 replicas"));
+    EXPECT_LT(log->getDurablePosition(), position);
+    EXPECT_EQ(position, MasterClient::getDurablePosition(&context, masterId,
+            position));
+
+    // All replicas: already durable, so there is nothing to wait for.
+    WriteRpc rpc3(ramcloud.get(), 1, "key0", 4, "item2", 5);
+    rpc3.wait(NULL, &masterId, &position);
+    EXPECT_FALSE(masterId.isValid());
+    EXPECT_EQ(LogPosition(), position);
+    EXPECT_EQ(log->getHead(), log->getDurablePosition());
+}
+
 TEST_F(MasterServiceTest, write_safeVersionNumberUpdate) {
     ObjectBuffer value;
     uint64_t version;
 
     SegmentManager* segmentManager = &service->objectManager.segmentManager;
+    uint64_t blockSize = SegmentManager::VERSION_BLOCK_SIZE;
     segmentManager->safeVersion = 1UL; // reset safeVersion
+    foreach (SegmentManager::VersionBlock& block,
+             segmentManager->versionBlocks) {
+        block.next = 0;
+    }
     // initial data to original table
     //         Table, Key, KeyLen, Data, Len, rejectRule, Version
     ramcloud->write(1, "k0", 2, "value0", 6, NULL, &version);
-    EXPECT_EQ(1U, version); // safeVersion++ is given
+    EXPECT_EQ(1U, version); // first of a new block is given
     ramcloud->readKeysAndValue(1,  "k0", 2, &value);
     EXPECT_EQ("value0", string(reinterpret_cast<const char*>(
             value.getValue()), 6));
     EXPECT_EQ(1U, version); // current object version returned
-    EXPECT_EQ(2U, segmentManager->safeVersion); // incremented
+    EXPECT_EQ(blockSize, segmentManager->safeVersion); // block reserved
 
     // original key to original table
     ramcloud->write(1, "k0", 2, "value1", 6, NULL, &version);
@@ -3967,17 +4617,17 @@ TEST_F(MasterServiceTest, write_safeVersionNumberUpdate) {
     EXPECT_EQ("value1", string(reinterpret_cast<const char*>(
             value.getValue()), 6));
     EXPECT_EQ(2U, version); // current object version returned
-    EXPECT_EQ(2U, segmentManager->safeVersion); // unchanged
+    EXPECT_EQ(blockSize, segmentManager->safeVersion); // unchanged
 
-    segmentManager->safeVersion = 29UL; // increase safeVersion
+    segmentManager->raiseSafeVersion(2000); // increase safeVersion
     // different key to original table
     ramcloud->write(1, "k1", 2, "value3", 6, NULL, &version);
-    EXPECT_EQ(29U, version);  // safeVersion++ is given
+    EXPECT_EQ(2000U, version);  // cached block abandoned
     ramcloud->readKeysAndValue(1, "k1", 2, &value);
     EXPECT_EQ("value3", string(reinterpret_cast<const char*>(
             value.getValue()), 6));
-    EXPECT_EQ(29U, version);  // current object version returned
-    EXPECT_EQ(30U, segmentManager->safeVersion); // incremented
+    EXPECT_EQ(2000U, version);  // current object version returned
+    EXPECT_EQ(2 * blockSize, segmentManager->safeVersion); // block reserved
 
     // original key to original table
     ramcloud->write(1, "k0", 2, "value4", 6, NULL, &version);
@@ -3986,7 +4636,7 @@ TEST_F(MasterServiceTest, write_safeVersionNumberUpdate) {
     EXPECT_EQ("value4", string(reinterpret_cast<const char*>(
             value.getValue()), 6));
     EXPECT_EQ(3U, version); // current object version returned
-    EXPECT_EQ(30U, segmentManager->safeVersion); // unchanged
+    EXPECT_EQ(2 * blockSize, segmentManager->safeVersion); // unchanged
 }
 
 TEST_F(MasterServiceTest, write_rejectRules) {
@@ -4095,6 +4745,19 @@ genRandomString(char* str, const int length) {
     str[length - 1] = 0;
 }
 
+TEST_F(MasterServiceTest, write_ttl) {
+    WallTime::mockWallTimeValue = 1000;
+    ramcloud->write(1, "k0", 2, "value0", 6, NULL, NULL, false, 10);
+    Buffer value;
+    ramcloud->read(1, "k0", 2, &value);
+    EXPECT_EQ("value0", TestUtil::toString(&value));
+
+    WallTime::mockWallTimeValue = 1010;
+    EXPECT_THROW(ramcloud->read(1, "k0", 2, &value),
+            ObjectDoesntExistException);
+    WallTime::mockWallTimeValue = 0;
+}
+
 TEST_F(MasterServiceTest, write_varyingKeyLength) {
     uint16_t keyLengths[] = {
             1, 5, 10, 15, 20, 25, 30, 35, 40, 45, 50,
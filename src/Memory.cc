@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <emmintrin.h>
+
 #include "Memory.h"
 
 namespace RAMCloud {
@@ -104,5 +106,62 @@ xstrdup(const CodeLocation& where, const char* str)
     return p;
 }
 
+/**
+ * Copy memory like memcpy(3), but write the destination's whole cache lines
+ * with non-temporal (streaming) stores, which go straight to memory instead
+ * of filling the caches. This is for large copies of data that is unlikely to
+ * be read again soon, which would otherwise evict data that is (such as the
+ * hash table and hot objects on a master). Partial cache lines at either end
+ * are copied normally.
+ *
+ * Streaming stores are weakly ordered, so this ends with a store fence:
+ * once it returns, the copy is visible to other threads just as after a
+ * memcpy.
+ *
+ * \param destination
+ *      Where to copy to.
+ * \param source
+ *      Where to copy from. Must not overlap with the destination.
+ * \param length
+ *      Number of bytes to copy.
+ */
+void
+copyNonTemporal(void* destination, const void* source, size_t length)
+{
+    uint8_t* dst = static_cast<uint8_t*>(destination);
+    const uint8_t* src = static_cast<const uint8_t*>(source);
+
+    size_t misalignment = reinterpret_cast<uintptr_t>(dst) %
+            CACHE_LINE_SIZE;
+    if (misalignment != 0) {
+        size_t head = std::min(length, CACHE_LINE_SIZE - misalignment);
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        length -= head;
+    }
+
+    if (length >= CACHE_LINE_SIZE) {
+        while (length >= CACHE_LINE_SIZE) {
+            const __m128i* in = reinterpret_cast<const __m128i*>(src);
+            __m128i* out = reinterpret_cast<__m128i*>(dst);
+            __m128i a = _mm_loadu_si128(in);
+            __m128i b = _mm_loadu_si128(in + 1);
+            __m128i c = _mm_loadu_si128(in + 2);
+            __m128i d = _mm_loadu_si128(in + 3);
+            _mm_stream_si128(out, a);
+            _mm_stream_si128(out + 1, b);
+            _mm_stream_si128(out + 2, c);
+            _mm_stream_si128(out + 3, d);
+            dst += CACHE_LINE_SIZE;
+            src += CACHE_LINE_SIZE;
+            length -= CACHE_LINE_SIZE;
+        }
+        _mm_sfence();
+    }
+
+    memcpy(dst, src, length);
+}
+
 } // namespace Memory
 } // namespace RAMCloud
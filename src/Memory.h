@@ -24,6 +24,7 @@ namespace Memory {
 void* xmalloc(const CodeLocation& where, size_t len);
 void* xmemalign(const CodeLocation& where, size_t alignment, size_t len);
 char* xstrdup(const CodeLocation& where, const char* str);
+void copyNonTemporal(void* destination, const void* source, size_t length);
 
 /**
  * Simpler type for use in creating unique_ptrs which call specific function for
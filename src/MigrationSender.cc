@@ -0,0 +1,375 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "MigrationSender.h"
+#include "ClientException.h"
+#include "MasterService.h"
+#include "PerfStats.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a MigrationSender and start its scanning threads.
+ *
+ * \param context
+ *      Overall information about this server.
+ * \param master
+ *      Master that owns the tablet being migrated.
+ * \param receiver
+ *      Master the tablet is being migrated to, which must already have been
+ *      prepared with a PREP_FOR_MIGRATION rpc. An invalid id means that
+ *      transfer segments are filled but not sent anywhere.
+ * \param tableId
+ *      Table containing the tablet being migrated.
+ * \param firstKeyHash
+ *      Lowest key hash of the range being migrated.
+ * \param lastKeyHash
+ *      Highest key hash of the range being migrated.
+ * \param numThreads
+ *      Number of threads to scan segments with, including the caller's.
+ *      0 is treated as 1.
+ * \param maxSegmentsInFlight
+ *      Maximum number of RECEIVE_MIGRATION_DATA rpcs to have outstanding
+ *      at once. 0 is treated as 1.
+ */
+MigrationSender::MigrationSender(Context* context, MasterService* master,
+            ServerId receiver, uint64_t tableId, uint64_t firstKeyHash,
+            uint64_t lastKeyHash, uint32_t numThreads,
+            uint32_t maxSegmentsInFlight)
+    : entryTotals()
+    , totalBytes(0)
+    , context(context)
+    , master(master)
+    , receiver(receiver)
+    , tableId(tableId)
+    , firstKeyHash(firstKeyHash)
+    , lastKeyHash(lastKeyHash)
+    , maxSegmentsInFlight(std::max(maxSegmentsInFlight, 1u))
+    , scanners()
+    , threads()
+    , mutex()
+    , scansChanged()
+    , transfersChanged()
+    , scanQueue()
+    , scansRunning(0)
+    , transfers()
+    , transfersInFlight(0)
+    , error()
+    , exiting(false)
+{
+    numThreads = std::max(numThreads, 1u);
+    for (uint32_t i = 0; i < numThreads; ++i)
+        scanners.emplace_back(new Scanner());
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.emplace_back(&MigrationSender::scannerMain, this, i);
+}
+
+/**
+ * Stop the scanning threads. Any rpcs still outstanding (which only happens
+ * if finish() wasn't invoked or threw) are canceled.
+ */
+MigrationSender::~MigrationSender()
+{
+    {
+        Lock _(mutex);
+        exiting = true;
+        scansChanged.notify_all();
+    }
+    foreach (std::thread& thread, threads)
+        thread.join();
+}
+
+/**
+ * Wait until everything passed to scanSegment() and scanEntry() has been
+ * scanned and all of the migrated entries have been received by the new
+ * owner. Afterwards #entryTotals and #totalBytes describe everything sent.
+ *
+ * \throw Exception
+ *      Rethrows the first exception any thread hit while scanning or
+ *      sending (e.g. ServerNotUpException if the receiver crashed, or
+ *      InternalError if an entry couldn't be added to a transfer segment).
+ */
+void
+MigrationSender::finish()
+{
+    waitForScans();
+
+    foreach (auto& scanner, scanners) {
+        if (scanner->transferSeg) {
+            scanner->transferSeg->close();
+            LOG(DEBUG, "Sending last migration segment");
+            send(std::move(scanner->transferSeg));
+        }
+    }
+
+    Lock lock(mutex);
+    while (transfersInFlight > 0) {
+        if (transfers.empty())
+            transfersChanged.wait(lock);
+        else
+            waitForOldestTransfer(lock);
+    }
+
+    for (size_t i = 0; i < scanners.size(); ++i) {
+        Scanner& scanner = *scanners[i];
+        for (int type = 0; type < TOTAL_LOG_ENTRY_TYPES; ++type)
+            entryTotals[type] += scanner.entryTotals[type];
+        totalBytes += scanner.totalBytes;
+
+        // Our threads' PerfStats aren't registered (they don't live long
+        // enough), so count their bytes as the caller's.
+        if (i > 0)
+            PerfStats::threadStats.migrationPhase1Bytes += scanner.totalBytes;
+    }
+}
+
+/**
+ * Migrate the entry an iterator refers to, if it belongs to the tablet,
+ * using the caller's thread.
+ *
+ * \param it
+ *      Iterator positioned at the entry to consider; it is not advanced.
+ * \throw InternalError
+ *      The entry couldn't be added to a transfer segment.
+ */
+void
+MigrationSender::scanEntry(SegmentIterator& it)
+{
+    migrate(*scanners[0], it);
+}
+
+/**
+ * Migrate all of the entries of a segment that belong to the tablet. The
+ * segment is scanned by the caller's thread if there are no others;
+ * otherwise it is queued for one of them and this method returns right
+ * away (use waitForScans() to wait for it). Scanned segments must not be
+ * freed until waitForScans() or finish() returns.
+ *
+ * \param it
+ *      Iterator positioned at the first entry to scan.
+ */
+void
+MigrationSender::scanSegment(const SegmentIterator& it)
+{
+    if (threads.empty()) {
+        SegmentIterator copy(it);
+        scan(*scanners[0], copy);
+        return;
+    }
+    Lock _(mutex);
+    scanQueue.push_back(it);
+    scansChanged.notify_one();
+}
+
+/**
+ * Send a full transfer segment to the receiver, first waiting for earlier
+ * segments if the maximum number are already outstanding. This is invoked
+ * by MasterService::migrateSingleLogEntry whenever a transfer segment
+ * fills.
+ *
+ * \param segment
+ *      Closed transfer segment to send; kept until its rpc completes.
+ * \throw Exception
+ *      An earlier rpc that this method waited for failed.
+ */
+void
+MigrationSender::send(std::unique_ptr<Segment> segment)
+{
+#if MIGRATION_SKIP_TX
+    return;
+#endif
+    if (receiver == ServerId())
+        return;
+
+    Lock lock(mutex);
+    while (transfersInFlight >= maxSegmentsInFlight) {
+        if (transfers.empty())
+            transfersChanged.wait(lock);
+        else
+            waitForOldestTransfer(lock);
+    }
+    transfersInFlight++;
+    lock.unlock();
+
+    std::unique_ptr<Transfer> transfer;
+    try {
+        transfer.reset(new Transfer(context, receiver, std::move(segment),
+                tableId, firstKeyHash));
+    } catch (...) {
+        lock.lock();
+        transfersInFlight--;
+        transfersChanged.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    transfers.push_back(std::move(transfer));
+    transfersChanged.notify_all();
+}
+
+/**
+ * Wait until every segment passed to scanSegment() has been scanned, using
+ * the caller's thread to scan segments that no other thread has started
+ * yet. Rpcs for the full transfer segments may still be outstanding.
+ *
+ * \throw Exception
+ *      Rethrows the first exception any thread hit while scanning.
+ */
+void
+MigrationSender::waitForScans()
+{
+    Lock lock(mutex);
+    while (!scanQueue.empty()) {
+        SegmentIterator it(scanQueue.front());
+        scanQueue.pop_front();
+        lock.unlock();
+        scan(*scanners[0], it);
+        lock.lock();
+    }
+    while (scansRunning > 0)
+        scansChanged.wait(lock);
+    if (error) {
+        std::exception_ptr scanError = error;
+        error = nullptr;
+        std::rethrow_exception(scanError);
+    }
+}
+
+// - private -
+
+/**
+ * Migrate one entry, if it belongs to the tablet, into a scanner's transfer
+ * segment.
+ *
+ * \param scanner
+ *      Scanner whose transfer segment and counts to use.
+ * \param it
+ *      Iterator positioned at the entry to consider.
+ * \throw InternalError
+ *      The entry couldn't be added to a transfer segment.
+ */
+void
+MigrationSender::migrate(Scanner& scanner, SegmentIterator& it)
+{
+    Status status = master->migrateSingleLogEntry(it, scanner.transferSeg,
+            scanner.entryTotals, scanner.totalBytes, tableId, firstKeyHash,
+            lastKeyHash, this);
+    if (status != STATUS_OK)
+        ClientException::throwException(HERE, status);
+}
+
+/**
+ * Migrate all of the remaining entries of a segment that belong to the
+ * tablet into a scanner's transfer segments.
+ *
+ * \param scanner
+ *      Scanner whose transfer segments and counts to use.
+ * \param it
+ *      Iterator positioned at the first entry to scan; advanced to the end.
+ */
+void
+MigrationSender::scan(Scanner& scanner, SegmentIterator& it)
+{
+    SegmentReadAhead readAhead(it);
+    for (; !it.isDone(); it.next()) {
+        readAhead.advance();
+        migrate(scanner, it);
+    }
+}
+
+/**
+ * Main loop of the threads in #threads: scan segments from #scanQueue
+ * until the MigrationSender is destroyed.
+ *
+ * \param index
+ *      Which entry of #scanners this thread uses.
+ */
+void
+MigrationSender::scannerMain(uint32_t index)
+{
+    Scanner& scanner = *scanners[index];
+    Lock lock(mutex);
+    while (true) {
+        while (!exiting && scanQueue.empty())
+            scansChanged.wait(lock);
+        if (exiting)
+            return;
+        SegmentIterator it(scanQueue.front());
+        scanQueue.pop_front();
+        scansRunning++;
+        lock.unlock();
+
+        std::exception_ptr scanError;
+        try {
+            scan(scanner, it);
+        } catch (...) {
+            scanError = std::current_exception();
+        }
+
+        lock.lock();
+        if (scanError && !error)
+            error = scanError;
+        scansRunning--;
+        scansChanged.notify_all();
+    }
+}
+
+/**
+ * Wait for the oldest outstanding rpc to complete and free its transfer
+ * segment. Other threads may send or wait for other rpcs meanwhile.
+ *
+ * \param lock
+ *      Lock on #mutex, held by the caller; released while waiting.
+ * \throw Exception
+ *      The rpc failed.
+ */
+void
+MigrationSender::waitForOldestTransfer(Lock& lock)
+{
+    std::unique_ptr<Transfer> transfer(std::move(transfers.front()));
+    transfers.pop_front();
+    lock.unlock();
+
+    std::exception_ptr rpcError;
+    try {
+        transfer->rpc.wait();
+    } catch (...) {
+        rpcError = std::current_exception();
+    }
+    transfer.reset();
+
+    lock.lock();
+    transfersInFlight--;
+    transfersChanged.notify_all();
+    if (rpcError)
+        std::rethrow_exception(rpcError);
+}
+
+// -- MigrationSender::Transfer --
+
+/**
+ * Start sending a transfer segment.
+ */
+MigrationSender::Transfer::Transfer(Context* context, ServerId receiver,
+            std::unique_ptr<Segment> segment, uint64_t tableId,
+            uint64_t firstKeyHash)
+    : segment(std::move(segment))
+    , rpc(context, receiver, this->segment.get(), tableId, firstKeyHash,
+          false, 0, 0, NULL, 0)
+{
+}
+
+} // namespace RAMCloud
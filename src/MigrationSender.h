@@ -0,0 +1,187 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_MIGRATIONSENDER_H
+#define RAMCLOUD_MIGRATIONSENDER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Common.h"
+#include "LogEntryTypes.h"
+#include "MasterClient.h"
+#include "Segment.h"
+#include "SegmentIterator.h"
+#include "ServerId.h"
+
+namespace RAMCloud {
+
+class MasterService;
+
+/**
+ * Sends the entries of one tablet to its new owner during tablet migration
+ * (see MasterService::migrateTablet). Log segments are scanned for the
+ * tablet's entries by several threads at once, each filling its own transfer
+ * segments (see MasterService::migrateSingleLogEntry), and full transfer
+ * segments are shipped in RECEIVE_MIGRATION_DATA rpcs with several of them
+ * in flight, so scanning, transmission, and replay on the receiver (which
+ * handles each rpc on its own worker thread) all overlap.
+ *
+ * With one thread and one segment in flight this is exactly the original
+ * sequential migration: the caller's thread scans every segment and waits
+ * for each rpc before filling the next transfer segment.
+ *
+ * The caller's thread uses scanner 0; the others are used by threads owned
+ * by this instance. scanSegment(), scanEntry(), waitForScans() and finish()
+ * must be called from one thread at a time.
+ */
+class MigrationSender {
+  PUBLIC:
+    MigrationSender(Context* context, MasterService* master,
+                ServerId receiver, uint64_t tableId, uint64_t firstKeyHash,
+                uint64_t lastKeyHash, uint32_t numThreads,
+                uint32_t maxSegmentsInFlight);
+    ~MigrationSender();
+    void finish();
+    void scanEntry(SegmentIterator& it);
+    void scanSegment(const SegmentIterator& it);
+    void send(std::unique_ptr<Segment> segment);
+    void waitForScans();
+
+    /// Number of entries of each type sent so far; only complete after
+    /// finish() returns.
+    uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES];
+
+    /// Number of bytes of log entries sent so far; only complete after
+    /// finish() returns.
+    uint64_t totalBytes;
+
+  PRIVATE:
+    /**
+     * State private to each thread scanning segments.
+     */
+    struct Scanner {
+        Scanner()
+            : transferSeg()
+            , entryTotals()
+            , totalBytes(0)
+        {}
+
+        /// Segment this scanner is filling with entries to send; NULL if it
+        /// hasn't found any since the last one was sent.
+        std::unique_ptr<Segment> transferSeg;
+
+        /// Counts of entries this scanner has migrated, by type; folded
+        /// into MigrationSender::entryTotals by finish().
+        uint64_t entryTotals[TOTAL_LOG_ENTRY_TYPES];
+
+        /// Bytes of entries this scanner has migrated; folded into
+        /// MigrationSender::totalBytes by finish().
+        uint64_t totalBytes;
+
+        DISALLOW_COPY_AND_ASSIGN(Scanner);
+    };
+
+    /**
+     * A transfer segment and the rpc sending it (which refers to the
+     * segment's memory, so the rpc must finish first).
+     */
+    struct Transfer {
+        Transfer(Context* context, ServerId receiver,
+                 std::unique_ptr<Segment> segment, uint64_t tableId,
+                 uint64_t firstKeyHash);
+
+        std::unique_ptr<Segment> segment;
+        ReceiveMigrationDataRpc rpc;
+
+        DISALLOW_COPY_AND_ASSIGN(Transfer);
+    };
+
+    void migrate(Scanner& scanner, SegmentIterator& it);
+    void scan(Scanner& scanner, SegmentIterator& it);
+    void scannerMain(uint32_t index);
+    void waitForOldestTransfer(std::unique_lock<std::mutex>& lock);
+
+    /// Overall information about this server.
+    Context* context;
+
+    /// Does the filtering of log entries; see
+    /// MasterService::migrateSingleLogEntry.
+    MasterService* master;
+
+    /// Master receiving the tablet; an invalid id means transfer segments
+    /// are filled but never sent (for benchmarks).
+    ServerId receiver;
+
+    /// The range of the tablet being migrated.
+    uint64_t tableId;
+    uint64_t firstKeyHash;
+    uint64_t lastKeyHash;
+
+    /// Maximum number of RECEIVE_MIGRATION_DATA rpcs outstanding at once.
+    uint32_t maxSegmentsInFlight;
+
+    /**
+     * One entry per scanning thread; entry 0 is used by the caller's thread
+     * and the rest by #threads.
+     */
+    std::vector<std::unique_ptr<Scanner>> scanners;
+
+    /// Threads running scannerMain() for scanners 1 and up.
+    std::vector<std::thread> threads;
+
+    /// Protects all of the fields below.
+    std::mutex mutex;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    /// Notified when segments are queued for scanning, when a thread
+    /// finishes scanning one, and when the threads should exit.
+    std::condition_variable scansChanged;
+
+    /// Notified when a transfer is added to #transfers or finishes.
+    std::condition_variable transfersChanged;
+
+    /// Segments waiting for a thread to scan them, oldest first.
+    std::deque<SegmentIterator> scanQueue;
+
+    /// Number of threads currently scanning a segment from #scanQueue.
+    uint32_t scansRunning;
+
+    /// Transfers whose rpcs are outstanding, oldest first.
+    std::deque<std::unique_ptr<Transfer>> transfers;
+
+    /**
+     * Number of rpcs outstanding (or about to be sent), including those in
+     * #transfers and those that a thread has taken off #transfers to wait
+     * for; never more than #maxSegmentsInFlight.
+     */
+    uint32_t transfersInFlight;
+
+    /// The first exception thrown by one of #threads while scanning.
+    std::exception_ptr error;
+
+    /// Set to tell the threads in #threads to exit.
+    bool exiting;
+
+    DISALLOW_COPY_AND_ASSIGN(MigrationSender);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_MIGRATIONSENDER_H
@@ -0,0 +1,121 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "MigrationSender.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+class MigrationSenderTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    ServerConfig masterConfig;
+    MasterService* master;
+    std::vector<std::unique_ptr<Segment>> segments;
+
+    MigrationSenderTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , masterConfig(ServerConfig::forTesting())
+        , master()
+        , segments()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+        masterConfig.services = {WireFormat::MASTER_SERVICE,
+                                 WireFormat::ADMIN_SERVICE};
+        master = cluster.addServer(masterConfig)->master.get();
+    }
+
+    /**
+     * Add a segment to #segments holding one object in each of tables 1
+     * and 2 for every key in \a keys.
+     */
+    void
+    addSegment(std::vector<string> keys)
+    {
+        segments.emplace_back(new Segment());
+        foreach (string& key, keys) {
+            for (uint64_t tableId = 1; tableId <= 2; tableId++) {
+                Key k(tableId, key.c_str(), downCast<uint16_t>(key.length()));
+                Buffer dataBuffer;
+                Object object(k, "value", 6, 1, 0, dataBuffer);
+                Buffer objectBuffer;
+                object.assembleForLog(objectBuffer);
+                EXPECT_TRUE(segments.back()->append(LOG_ENTRY_TYPE_OBJ,
+                        objectBuffer));
+            }
+        }
+        segments.back()->close();
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(MigrationSenderTest);
+};
+
+TEST_F(MigrationSenderTest, constructor_clamps) {
+    MigrationSender sender(&context, master, ServerId(), 1, 0, ~0lu, 0, 0);
+    EXPECT_EQ(1u, sender.scanners.size());
+    EXPECT_EQ(0u, sender.threads.size());
+    EXPECT_EQ(1u, sender.maxSegmentsInFlight);
+}
+
+TEST_F(MigrationSenderTest, scanSegment_inline) {
+    addSegment({"a", "b", "c"});
+    MigrationSender sender(&context, master, ServerId(), 1, 0, ~0lu, 1, 1);
+    SegmentIterator it(*segments[0]);
+    sender.scanSegment(it);
+    EXPECT_TRUE(sender.scanQueue.empty());
+    EXPECT_EQ(3u, sender.scanners[0]->entryTotals[LOG_ENTRY_TYPE_OBJ]);
+    EXPECT_TRUE(sender.scanners[0]->transferSeg);
+}
+
+TEST_F(MigrationSenderTest, finish_threads) {
+    addSegment({"a", "b", "c"});
+    addSegment({"d", "e"});
+    addSegment({"f"});
+    addSegment({"g", "h", "i", "j"});
+    MigrationSender sender(&context, master, ServerId(), 1, 0, ~0lu, 3, 2);
+    EXPECT_EQ(2u, sender.threads.size());
+    foreach (auto& segment, segments) {
+        SegmentIterator it(*segment);
+        sender.scanSegment(it);
+    }
+
+    // Only entries of table 1 are picked up, and every scanner's counts
+    // end up in the totals.
+    sender.finish();
+    EXPECT_EQ(10u, sender.entryTotals[LOG_ENTRY_TYPE_OBJ]);
+    EXPECT_LT(0u, sender.totalBytes);
+    EXPECT_TRUE(sender.scanQueue.empty());
+    EXPECT_EQ(0u, sender.scansRunning);
+    foreach (auto& scanner, sender.scanners)
+        EXPECT_FALSE(scanner->transferSeg);
+}
+
+TEST_F(MigrationSenderTest, finish_receiverNotUp) {
+    addSegment({"a"});
+    MigrationSender sender(&context, master, ServerId(99, 0), 1, 0, ~0lu,
+            2, 1);
+    SegmentIterator it(*segments[0]);
+    sender.scanSegment(it);
+    EXPECT_THROW(sender.finish(), ServerNotUpException);
+    EXPECT_EQ(0u, sender.transfersInFlight);
+}
+
+}  // namespace RAMCloud
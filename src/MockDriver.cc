@@ -29,6 +29,7 @@ MockDriver::MockDriver()
             , releaseCount(0)
             , incomingPackets()
             , transmitQueueSpace(10000)
+            , receiveBuffersAreLow(false)
 {
 }
 
@@ -47,6 +48,7 @@ MockDriver::MockDriver(HeaderToString headerToString)
             , releaseCount(0)
             , incomingPackets()
             , transmitQueueSpace(10000)
+            , receiveBuffersAreLow(false)
 {
 }
 
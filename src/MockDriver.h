@@ -81,6 +81,7 @@ class MockDriver : public Driver {
     }
     virtual void receivePackets(uint32_t maxPackets,
             std::vector<Received>* receivedPackets);
+    virtual bool receiveBuffersLow() { return receiveBuffersAreLow; }
     virtual void release(char *payload);
     virtual void sendPacket(const Address* addr,
                             const void* header,
@@ -136,6 +137,9 @@ class MockDriver : public Driver {
     // Returned as the result of getTransmitQueueSpace.
     uint32_t transmitQueueSpace;
 
+    // Returned as the result of receiveBuffersLow.
+    bool receiveBuffersAreLow;
+
     DISALLOW_COPY_AND_ASSIGN(MockDriver);
 };
 
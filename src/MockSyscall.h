@@ -43,7 +43,8 @@ class MockSyscall : public Syscall {
                     ioctlRetriesToSuccess(0), listenErrno(0), pipeErrno(0),
                     recvErrno(0), recvEof(false), recvfromErrno(0),
                     recvfromEof(false), recvmmsgErrno(0),
-                    sendmsgErrno(0), sendmsgReturnCount(-1),
+                    sendmmsgErrno(0), sendmsgErrno(0),
+                    sendmsgReturnCount(-1),
                     sendtoErrno(0), sendtoReturnCount(-1), setsockoptErrno(0),
                     socketErrno(0), writeErrno(0) {}
 
@@ -139,10 +140,11 @@ class MockSyscall : public Syscall {
     }
 
     int futexWaitErrno;
-    int futexWait(int *addr, int value) {
+    int futexWait(int *addr, int value,
+            const struct timespec* timeout = NULL) {
         if (futexWaitErrno == 0) {
             return static_cast<int>(::syscall(SYS_futex, addr, FUTEX_WAIT,
-                    value, NULL, NULL, 0));
+                    value, timeout, NULL, 0));
         }
         errno = futexWaitErrno;
         futexWaitErrno = 0;
@@ -229,6 +231,18 @@ class MockSyscall : public Syscall {
         return -1;
     }
 
+    // Uses the same controls as recv.
+    ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags) {
+        if (recvEof) {
+            return 0;
+        }
+        if (recvErrno == 0) {
+            return ::recvmsg(sockfd, msg, flags);
+        }
+        errno = recvErrno;
+        return -1;
+    }
+
     int recvfromErrno;
     bool recvfromEof;
     ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags,
@@ -255,6 +269,16 @@ class MockSyscall : public Syscall {
 
     }
 
+    int sendmmsgErrno;
+    int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+            int flags) {
+        if (sendmmsgErrno != 0) {
+            errno = sendmmsgErrno;
+            return -1;
+        }
+        return ::sendmmsg(sockfd, msgvec, vlen, flags);
+    }
+
     int sendmsgErrno;
     int sendmsgReturnCount;
     ssize_t sendmsg(int sockfd, const msghdr *msg, int flags) {
@@ -186,9 +186,6 @@ MockTransport::MockServerRpc::MockServerRpc(MockTransport* transport,
     if (message != NULL) {
         requestPayload.fillFromString(message);
     }
-
-    // set this to avoid handleRpc's sanity check
-    epoch = 1;
 }
 
 /**
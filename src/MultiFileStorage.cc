@@ -27,6 +27,7 @@
 #include "ClientException.h"
 #include "CycleCounter.h"
 #include "Cycles.h"
+#include "FrameCompression.h"
 #include "Memory.h"
 #include "RawMetrics.h"
 #include "ShortMacros.h"
@@ -83,6 +84,7 @@ MultiFileStorage::Frame::Frame(MultiFileStorage* storage, size_t frameIndex)
     , appendedToByCurrentProcess(false)
     , appendedLength(0)
     , committedLength(0)
+    , storedLength(storage->segmentSize)
     , appendedMetadata(Memory::xmemalign(HERE,
                                          BUFFER_ALIGNMENT,
                                          METADATA_SIZE),
@@ -241,7 +243,7 @@ MultiFileStorage::Frame::isLoaded()
  * loaded from storage into memory. If the replica is already in memory a load
  * from disk is avoided. If the replica buffer is dirty this call blocks until
  * all data has been flushed to disk to ensure that recoveries only use durable
- * data.
+ * data (unless the buffer itself is durable; see #writeBackStaging).
  *
  * After this call the start of new appends to this frame are rejected until
  * this frame is recycled for use with another replica (via open()).
@@ -256,7 +258,7 @@ MultiFileStorage::Frame::load()
             testingHadToWaitForBufferOnLoad = true;
             continue;
         }
-        if (!isSynced()) {
+        if (!isSynced() && !storage->writeBackStaging) {
             testingHadToWaitForSyncOnLoad = true;
             continue;
         }
@@ -274,8 +276,10 @@ MultiFileStorage::Frame::unload()
 {
     Lock lock(storage->mutex);
     assert(loadRequested);
-    buffer.reset();
     loadRequested = false;
+    // With write-back staging the buffer may hold the only copy.
+    if (isSynced() || !isWriteBuffer)
+        buffer.reset();
 }
 
 /**
@@ -316,6 +320,76 @@ MultiFileStorage::Frame::append(Buffer& source,
                                  size_t metadataLength)
 {
     Lock lock(storage->mutex);
+    appendData(lock, &source, sourceOffset, length, destinationOffset,
+               metadata, metadataLength);
+}
+
+/**
+ * Return the buffer for this frame's replica data while appends to it are
+ * allowed, or NULL; see BackupStorage::Frame::getReceiveBuffer(). The
+ * buffer stays valid until the frame is freed.
+ */
+void*
+MultiFileStorage::Frame::getReceiveBuffer()
+{
+    Lock _(storage->mutex);
+    if (!isOpen || loadRequested)
+        return NULL;
+    return buffer.get();
+}
+
+/**
+ * Update metadata for data a transport has already received into the
+ * buffer returned by getReceiveBuffer(); otherwise just like append().
+ *
+ * \param length
+ *      Bytes received into the frame starting at \a destinationOffset.
+ * \param destinationOffset
+ *      Offset into the frame where the data was received.
+ * \param metadata
+ *      See append().
+ * \param metadataLength
+ *      See append().
+ */
+void
+MultiFileStorage::Frame::appendRemotelyWritten(size_t length,
+                                               size_t destinationOffset,
+                                               const void* metadata,
+                                               size_t metadataLength)
+{
+    Lock lock(storage->mutex);
+    appendData(lock, NULL, 0, length, destinationOffset,
+               metadata, metadataLength);
+}
+
+/**
+ * Does the work of append() and appendRemotelyWritten().
+ *
+ * \param lock
+ *      Lock on the storage mutex which must be held before calling.
+ * \param source
+ *      Buffer containing the data to be copied into the frame, or NULL if
+ *      the data is already in place.
+ * \param sourceOffset
+ *      See append().
+ * \param length
+ *      See append().
+ * \param destinationOffset
+ *      See append().
+ * \param metadata
+ *      See append().
+ * \param metadataLength
+ *      See append().
+ */
+void
+MultiFileStorage::Frame::appendData(Lock& lock,
+                                    Buffer* source,
+                                    size_t sourceOffset,
+                                    size_t length,
+                                    size_t destinationOffset,
+                                    const void* metadata,
+                                    size_t metadataLength)
+{
     if (!isOpen) {
         LOG(WARNING, "Tried to append to a frame but it wasn't "
             "open on this backup; this can happen legitimately if a master's "
@@ -345,9 +419,11 @@ MultiFileStorage::Frame::append(Buffer& source,
     }
 
     appendedToByCurrentProcess = true;
-    source.copy(downCast<uint32_t>(sourceOffset),
-                downCast<uint32_t>(length),
-                static_cast<char*>(buffer.get()) + destinationOffset);
+    if (source != NULL) {
+        source->copy(downCast<uint32_t>(sourceOffset),
+                     downCast<uint32_t>(length),
+                     static_cast<char*>(buffer.get()) + destinationOffset);
+    }
 
     // Update appendedLength, but only if it would get larger (there are
     // situations where older data could get rewritten, such as a delayed
@@ -365,9 +441,13 @@ MultiFileStorage::Frame::append(Buffer& source,
     if (!isSynced()) {
         if (sync) {
             performWrite(lock);
-        } else {
+        } else if (!storage->compressClosedFrames &&
+                   !storage->writeBackStaging) {
             schedule(lock, LOW);
         }
+        // Otherwise the data stays in the (non-volatile) buffer until
+        // close(), so that it can be compressed or batched with other
+        // frames and written just once.
     }
 }
 
@@ -401,6 +481,9 @@ MultiFileStorage::Frame::close()
                 isWriteBuffer = false;
             }
         }
+    } else if (storage->writeBackStaging) {
+        storage->stagedFrames.insert(frameIndex);
+        storage->flusher.schedule(lock);
     } else {
         // This frame was already scheduled for I/O previously, but
         // at low priority. Now that it's closed, raise the priority
@@ -420,6 +503,11 @@ MultiFileStorage::Frame::performTask()
     Lock lock(storage->mutex);
     if (epoch != scheduledInEpoch)
         return;
+    // With more than one IO thread this frame may have been rescheduled
+    // while another thread is still doing its IO; that thread reschedules
+    // the frame itself if more work arrived in the meantime.
+    if (performingIo)
+        return;
     performingIo = true;
     if (!isSynced()) {
         performWrite(lock);
@@ -450,6 +538,7 @@ MultiFileStorage::Frame::free()
     }
     ++epoch;
     deschedule();
+    storage->stagedFrames.erase(frameIndex);
     if (!isSynced())
         CycleCounter<RawMetric> _(&metrics->backup.uncommittedFramesFreed);
     isOpen = false;
@@ -462,6 +551,7 @@ MultiFileStorage::Frame::free()
     // appears to be !isSynced().
     appendedLength = 0;
     committedLength = 0;
+    storedLength = storage->segmentSize;
     memset(appendedMetadata.get(), '\0', METADATA_SIZE);
     appendedMetadataLength = 1;
     appendedMetadataVersion = 0;
@@ -486,6 +576,13 @@ MultiFileStorage::Frame::reopen(size_t length)
     load();
 
     Lock _(storage->mutex);
+    if (FrameCompression::isCompressed(buffer.get())) {
+        // Appends must go to the replica data, not its compressed form.
+        BufferPtr expanded = storage->allocateBuffer();
+        FrameCompression::decompress(buffer.get(), storage->segmentSize,
+                                     expanded.get(), storage->segmentSize);
+        buffer = std::move(expanded);
+    }
     appendedLength = length;
     committedLength = length;
     isOpen = true;
@@ -535,10 +632,12 @@ MultiFileStorage::Frame::open(bool sync, ServerId masterId, uint64_t segmentId)
     storage->writeBuffersInUse++;
     isOpen = true;
     isClosed = false;
-    this->sync = sync;
+    // A staged buffer is as durable as storage; see #writeBackStaging.
+    this->sync = sync && !storage->writeBackStaging;
     isWriteBuffer = true;
     appendedLength = 0;
     committedLength = 0;
+    storedLength = storage->segmentSize;
     memset(appendedMetadata.get(), '\0', METADATA_SIZE);
     appendedMetadataLength = 1;
     appendedMetadataVersion = 0;
@@ -556,6 +655,9 @@ MultiFileStorage::Frame::open(bool sync, ServerId masterId, uint64_t segmentId)
  * \param buf
  *     Pointer to the buffer that the Frame's data will be written to. Must
  *     be large enough to hold an entire segment.
+ * \param count
+ *     Number of bytes to read from the start of the Frame; a multiple of
+ *     BLOCK_SIZE, or the segment size to read the whole Frame.
  * \param frameIndex
  *     Identifies which Frame to fetch from disk.
  * \param usingDevNull
@@ -563,48 +665,45 @@ MultiFileStorage::Frame::open(bool sync, ServerId masterId, uint64_t segmentId)
  *     reads cause the method to DIE.
  */
 void
-MultiFileStorage::unlockedRead(Frame::Lock& lock, void* buf, size_t frameIndex,
-                               bool usingDevNull)
+MultiFileStorage::unlockedRead(Frame::Lock& lock, void* buf, size_t count,
+                               size_t frameIndex, bool usingDevNull)
 {
     lock.unlock();
     CycleCounter<RawMetric> _(&metrics->backup.storageReadTicks);
 
-    // Use asynchronous IO to initiate concurrent IO operations on all of the
-    // storage files to read the replica in parallel.
-    // Keep one control block for each file.
-    struct aiocb cbs[fds.size()];
-    // Linux documentation recommends clearing control blocks before use.
-    memset(cbs, 0, sizeof(struct aiocb) * fds.size());
+    // Initiate concurrent IO operations on all of the storage files to read
+    // the replica in parallel: one request for each file holding any of
+    // the first #count bytes.
+    IoUring::Request requests[fds.size()];
+    size_t numRequests = 0;
     size_t frameletStart = offsetOfFramelet(frameIndex);
-    for (size_t fileIndex = 0; fileIndex < fds.size(); fileIndex++) {
+    size_t remaining = count;
+    for (size_t fileIndex = 0;
+         fileIndex < fds.size() && remaining > 0; fileIndex++) {
         size_t frameletSize = bytesInFramelet(fileIndex);
-        struct aiocb* cb = &cbs[fileIndex];
-        cb->aio_fildes = fds[fileIndex];
-        cb->aio_offset = frameletStart;
-        cb->aio_buf = static_cast<char*>(buf) + (frameletSize * fileIndex);
-        cb->aio_nbytes = frameletSize;
-        aio_read(cb);
+        IoUring::Request& request = requests[numRequests++];
+        request.fd = fds[fileIndex];
+        request.offset = frameletStart;
+        request.buf = buf;
+        request.length = std::min(frameletSize, remaining);
+        remaining -= request.length;
+        buf = static_cast<char*>(buf) + frameletSize;
     }
+    performIo(requests, numRequests);
 
-    // Wait for all of the IO operations to complete.
-    for (size_t i = 0; i < fds.size(); i++) {
-        struct aiocb* cb = &cbs[i];
-        aio_suspend(&cb, 1, NULL);
-        ssize_t r = aio_return(cb);
-        if (r == -1) {
+    for (size_t i = 0; i < numRequests; i++) {
+        IoUring::Request& request = requests[i];
+        ssize_t r = request.result;
+        if (r < 0) {
             DIE("Failed to read replica: %s, "
                 "reading %lu bytes from backup file %lu at offset %lu.",
-                strerror(aio_error(cb)), cb->aio_nbytes, i,
-                cb->aio_offset);
-        } else if (r != downCast<ssize_t>(cb->aio_nbytes)) {
+                strerror(downCast<int>(-r)), request.length, i,
+                request.offset);
+        } else if (r != downCast<ssize_t>(request.length)) {
             if (!usingDevNull)
                 DIE("Failure performing asynchronous IO (short read: "
-                    "wanted %lu, got %lu at offset %lu in file %lu; "
-                    "errno %d: %s)",
-                    cb->aio_nbytes, r, cb->aio_offset, i,
-                    aio_error(cb), strerror(aio_error(cb)));
-            else
-                assert(aio_error(cb) == 0);
+                    "wanted %lu, got %lu at offset %lu in file %lu)",
+                    request.length, r, request.offset, i);
         }
     }
 
@@ -648,15 +747,11 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
     off_t frameletStart = offsetOfFramelet(frameIndex);
     off_t offsetInFramelet = offsetInFrame;
 
-    // Use asynchronous IO to initiate concurrent IO operations on all of the
-    // storage files to read the replica in parallel.
-    // Keep one control block for each file, plus an extra (the last one) for
-    // metadata.
-    struct aiocb cbs[fds.size() + 1];
-    // Linux documentation recommends clearing control blocks before use. Also,
-    // zeroing everything out makes it safe to call aio_suspend on any control
-    // blocks that don't end up being used.
-    memset(cbs, 0, sizeof(struct aiocb) * (fds.size() + 1));
+    // Initiate concurrent IO operations on all of the storage files to write
+    // the replica in parallel: at most one request for each file, plus an
+    // extra one for metadata.
+    IoUring::Request requests[fds.size() + 1];
+    size_t numRequests = 0;
     for (size_t fileIndex = 0; remaining > 0; fileIndex++) {
         size_t frameletSize = bytesInFramelet(fileIndex);
         if (static_cast<size_t>(offsetInFramelet) > frameletSize) {
@@ -667,12 +762,12 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
 
         size_t bytesToWrite = std::min(frameletSize - offsetInFramelet,
                                        remaining);
-        struct aiocb* cb = &cbs[fileIndex];
-        cb->aio_fildes = fds[fileIndex];
-        cb->aio_offset = frameletStart + offsetInFramelet;
-        cb->aio_buf = buf;
-        cb->aio_nbytes = bytesToWrite;
-        aio_write(cb);
+        IoUring::Request& request = requests[numRequests++];
+        request.fd = fds[fileIndex];
+        request.offset = frameletStart + offsetInFramelet;
+        request.buf = buf;
+        request.length = bytesToWrite;
+        request.write = true;
 
         remaining -= bytesToWrite;
         buf = static_cast<char*>(buf) + bytesToWrite;
@@ -680,49 +775,49 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
     }
 
     // Metadata gets its own IO operation.
-    struct aiocb* metadataCb = &cbs[fds.size()];
-    metadataCb->aio_fildes = fds[0];
-    metadataCb->aio_offset = offsetOfFrameMetadata(frameIndex);
-    metadataCb->aio_buf = metadataBuf;
-    metadataCb->aio_nbytes = metadataCount;
-    aio_write(metadataCb);
-
-    // Wait for all of the IO operations to complete.
-    bool firstSlowIO = true;
-    for (size_t i = 0; i < fds.size() + 1; i++) {
-        struct aiocb* cb = &cbs[i];
-        aio_suspend(&cb, 1, NULL);
-        ssize_t r = aio_return(cb);
-        if (r == -1) {
-            if (i == fds.size())
+    IoUring::Request& metadataRequest = requests[numRequests++];
+    metadataRequest.fd = fds[0];
+    metadataRequest.offset = offsetOfFrameMetadata(frameIndex);
+    metadataRequest.buf = metadataBuf;
+    metadataRequest.length = metadataCount;
+    metadataRequest.write = true;
+
+    performIo(requests, numRequests);
+
+    for (size_t i = 0; i < numRequests; i++) {
+        IoUring::Request& request = requests[i];
+        bool isMetadata = (i == numRequests - 1);
+        ssize_t r = request.result;
+        if (r < 0) {
+            if (isMetadata)
                 DIE("Failed to write metadata for replica: %s, "
-                    "writing %lu bytes to backup file %lu at offset %lu.",
-                    strerror(aio_error(cb)),
-                    cb->aio_nbytes, i, cb->aio_offset);
+                    "writing %lu bytes to backup file 0 at offset %lu.",
+                    strerror(downCast<int>(-r)),
+                    request.length, request.offset);
             else
                 DIE("Failed to write replica: %s, "
                     "writing %lu bytes to backup file %lu at offset %lu.",
-                    strerror(aio_error(cb)),
-                    cb->aio_nbytes, i, cb->aio_offset);
-        } else if (r != downCast<ssize_t>(cb->aio_nbytes)) {
-            if (i == fds.size())
+                    strerror(downCast<int>(-r)),
+                    request.length, i, request.offset);
+        } else if (r != downCast<ssize_t>(request.length)) {
+            if (isMetadata)
                 DIE("Unexpectedly short write to metadata for replica, "
                     "file 0 at offset %lu, "
                     "expected length %lu, actual write length %lu",
-                    cb->aio_offset, cb->aio_nbytes, r);
+                    request.offset, request.length, r);
             else
                 DIE("Unexpectedly short write to replica, "
                     "file %lu at offset %lu, "
                     "expected length %lu, actual write length %lu",
-                    i, cb->aio_offset, cb->aio_nbytes, r);
-        }
-        double elapsedSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
-        if ((elapsedSeconds > 0.1) && firstSlowIO) {
-            firstSlowIO = false;
-            LOG(WARNING, "Slow write to replica storage on device %lu: %.1f ms "
-                    "for %lu bytes", i, elapsedSeconds*1e03, cb->aio_nbytes);
+                    i, request.offset, request.length, r);
         }
     }
+    double elapsedSeconds = Cycles::toSeconds(Cycles::rdtsc() - start);
+    if (elapsedSeconds > 0.1) {
+        LOG(WARNING, "Slow write to replica storage: %.1f ms for %lu bytes "
+                "across %lu device(s)", elapsedSeconds*1e03,
+                count + metadataCount, numRequests - 1);
+    }
 
     // Reduce our bandwidth (if so configured) by delaying this operation.
     sleepToThrottleWrites(count + metadataCount, Cycles::rdtsc() - start);
@@ -733,6 +828,49 @@ MultiFileStorage::unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
     lock.lock();
 }
 
+/**
+ * Issue a set of reads and writes to the storage files concurrently and
+ * wait for all of them to finish, using #ioUring if it was set up and POSIX
+ * asynchronous IO otherwise.
+ *
+ * \param requests
+ *      The IOs to perform. The outcome of each is returned in its
+ *      IoUring::Request::result: bytes transferred, or -errno.
+ * \param count
+ *      Number of elements in \a requests.
+ */
+void
+MultiFileStorage::performIo(IoUring::Request* requests, size_t count)
+{
+    if (ioUring) {
+        ioUring->submitAndWait(requests, count);
+        return;
+    }
+
+    // Keep one control block for each request. Linux documentation
+    // recommends clearing control blocks before use.
+    struct aiocb cbs[count];
+    memset(cbs, 0, sizeof(struct aiocb) * count);
+    for (size_t i = 0; i < count; i++) {
+        struct aiocb* cb = &cbs[i];
+        cb->aio_fildes = requests[i].fd;
+        cb->aio_offset = requests[i].offset;
+        cb->aio_buf = requests[i].buf;
+        cb->aio_nbytes = requests[i].length;
+        if (requests[i].write)
+            aio_write(cb);
+        else
+            aio_read(cb);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        struct aiocb* cb = &cbs[i];
+        aio_suspend(&cb, 1, NULL);
+        ssize_t r = aio_return(cb);
+        requests[i].result = (r == -1) ? -aio_error(cb) : r;
+    }
+}
+
 namespace {
 /**
  * Round \a offset down to a block boundary.
@@ -769,15 +907,16 @@ MultiFileStorage::Frame::performRead(Lock& lock)
     assert(loadRequested);
     BufferPtr buffer = storage->allocateBuffer();
 
+    const size_t storedLength = this->storedLength;
     if (testingSkipRealIo) {
-        TEST_LOG("count %lu frameIndex %lu", storage->segmentSize, frameIndex);
+        TEST_LOG("count %lu frameIndex %lu", storedLength, frameIndex);
     } else {
         ++metrics->backup.storageReadCount;
-        metrics->backup.storageReadBytes += storage->segmentSize;
+        metrics->backup.storageReadBytes += storedLength;
         ++PerfStats::threadStats.backupReadOps;
-        PerfStats::threadStats.backupReadBytes += storage->segmentSize;
+        PerfStats::threadStats.backupReadBytes += storedLength;
         // Lock released during this call; assume any field could have changed.
-        storage->unlockedRead(lock, buffer.get(), frameIndex,
+        storage->unlockedRead(lock, buffer.get(), storedLength, frameIndex,
                               storage->usingDevNull);
     }
 
@@ -801,7 +940,7 @@ MultiFileStorage::Frame::performWrite(Lock& lock)
 
     const size_t startOfFirstDirtyBlock = roundDown(committedLength);
     const size_t startOfNextCleanBlock = roundUp(appendedLength);
-    const size_t dirtyLength = startOfNextCleanBlock - startOfFirstDirtyBlock;
+    size_t dirtyLength = startOfNextCleanBlock - startOfFirstDirtyBlock;
 
     char* firstDirtyBlock =
         static_cast<char*>(buffer.get()) + startOfFirstDirtyBlock;
@@ -815,6 +954,25 @@ MultiFileStorage::Frame::performWrite(Lock& lock)
     memcpy(metadataBlock, appendedMetadata.get(), appendedMetadataLength);
     const size_t appendedMetadataVersion = this->appendedMetadataVersion;
 
+    // A closed replica that hasn't been written at all yet can be stored
+    // compressed; no more appends can arrive, so it is safe to compress it
+    // without the lock.
+    BufferPtr compressed(NULL, storage->bufferDeleter);
+    if (storage->compressClosedFrames && isClosed && committedLength == 0 &&
+        appendedLength > 0) {
+        compressed = storage->allocateBuffer();
+        lock.unlock();
+        size_t compressedLength =
+            FrameCompression::compress(buffer.get(), appendedLength,
+                                       compressed.get(), storage->segmentSize);
+        lock.lock();
+        if (compressedLength > 0) {
+            firstDirtyBlock = static_cast<char*>(compressed.get());
+            dirtyLength = roundUp(compressedLength);
+            storedLength = dirtyLength;
+        }
+    }
+
     if (testingSkipRealIo) {
         TEST_LOG("sourceBufferOffset %lu count %lu frameIndex %lu",
                  startOfFirstDirtyBlock, dirtyLength, frameIndex);
@@ -835,6 +993,7 @@ MultiFileStorage::Frame::performWrite(Lock& lock)
     // just before the write.
     committedLength = appendedLength;
     committedMetadataVersion = appendedMetadataVersion;
+    compressed.reset();
 
     // Release the in-memory copy if it won't be used again.
     if (isClosed && isSynced() && !loadRequested && buffer) {
@@ -859,6 +1018,80 @@ MultiFileStorage::Frame::isSynced() const
            (appendedMetadataVersion == committedMetadataVersion);
 }
 
+// --- MultiFileStorage::Flusher ---
+
+/**
+ * Create a task that writes out the staged frames of \a storage; it does
+ * nothing until scheduled.
+ */
+MultiFileStorage::Flusher::Flusher(MultiFileStorage* storage)
+    : PriorityTask(storage->ioQueue)
+    , storage(storage)
+    , flushing(false)
+{
+}
+
+MultiFileStorage::Flusher::~Flusher()
+{
+    deschedule();
+}
+
+/**
+ * Schedule the flusher after a frame was staged. Staged frames are written
+ * at LOW priority so that they don't delay recovery reads, until three
+ * quarters of the write buffers are in use; from then on at HIGH priority,
+ * so that masters aren't turned away for long.
+ *
+ * \param lock
+ *      Lock on the storage mutex which must be held before calling.
+ *      Not actually used; just here to sanity check locking.
+ */
+void
+MultiFileStorage::Flusher::schedule(Frame::Lock& lock)
+{
+    if (storage->writeBuffersInUse * 4 >= storage->maxWriteBuffers * 3)
+        PriorityTask::schedule(HIGH);
+    else
+        PriorityTask::schedule(LOW);
+}
+
+/**
+ * Write up to FLUSH_BATCH_FRAMES staged frames to storage, lowest frame
+ * index first. Frames with adjacent indexes are adjacent in every storage
+ * file (see offsetOfFramelet()), so a backlog of staged frames turns into
+ * long sequential runs on the disks. Reschedules itself if frames remain.
+ */
+void
+MultiFileStorage::Flusher::performTask()
+{
+    Frame::Lock lock(storage->mutex);
+    if (flushing)
+        return;
+    flushing = true;
+    uint64_t flushed = 0;
+    while (flushed < FLUSH_BATCH_FRAMES && !storage->stagedFrames.empty()) {
+        size_t frameIndex = *storage->stagedFrames.begin();
+        storage->stagedFrames.erase(storage->stagedFrames.begin());
+        Frame& frame = storage->frames[frameIndex];
+        // A frame that is already doing IO gets rescheduled by whoever is
+        // doing it, if it still needs writing.
+        if (frame.isSynced() || frame.performingIo)
+            continue;
+        frame.performingIo = true;
+        // Releases the lock during IO; free() waits for performingIo.
+        frame.performWrite(lock);
+        frame.performingIo = false;
+        flushed++;
+    }
+    if (flushed > 0) {
+        ++metrics->backup.stagedFlushCount;
+        metrics->backup.stagedFramesFlushed += flushed;
+    }
+    flushing = false;
+    if (!storage->stagedFrames.empty())
+        schedule(lock);
+}
+
 // --- MultiFileStorage::BufferDeleter ---
 
 /**
@@ -920,13 +1153,34 @@ MultiFileStorage::BufferDeleter::operator()(void* buffer)
  * \param openFlags
  *      Extra flags for use while opening files in filePathsStr (default to 0,
  *      O_DIRECT may be used to disable the OS buffer cache.
+ * \param useIoUring
+ *      If true, issue IO through an io_uring rather than POSIX aio. Falls
+ *      back to aio (with a warning) if the kernel doesn't support it.
+ * \param ioQueueDepth
+ *      Number of frames whose IO may be outstanding at once. Each frame's IO
+ *      is already striped across all of the files, so values larger than 1
+ *      keep the devices busy while one frame's IO is finishing (e.g. several
+ *      replicas being loaded for recovery at once). Loads are still started
+ *      in the order they were requested.
+ * \param compressClosedFrames
+ *      If true, hold replicas opened without sync in memory until they are
+ *      closed and then store them compressed; loads of those replicas then
+ *      return the compressed form (see FrameCompression).
+ * \param writeBackStaging
+ *      If true, replica buffers are durable (battery, UPS or NVDIMM backed)
+ *      and closed replicas are flushed to storage in the background; see
+ *      #writeBackStaging.
  */
 MultiFileStorage::MultiFileStorage(size_t segmentSize,
                                    size_t frameCount,
                                    size_t writeRateLimit,
                                    size_t maxWriteBuffers,
                                    const char* filePathsStr,
-                                   int openFlags)
+                                   int openFlags,
+                                   bool useIoUring,
+                                   uint32_t ioQueueDepth,
+                                   bool compressClosedFrames,
+                                   bool writeBackStaging)
     : BackupStorage(segmentSize, Type::DISK, writeRateLimit)
     , mutex()
     , ioQueue()
@@ -937,12 +1191,17 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
     , freeMap(frameCount)
     , lastAllocatedFrame(FreeMap::npos)
     , openFlags(openFlags)
+    , compressClosedFrames(compressClosedFrames)
+    , writeBackStaging(writeBackStaging)
+    , stagedFrames()
     , fds()
     , usingDevNull(filePathsStr != NULL && string(filePathsStr) == "/dev/null")
     , writeBuffersInUse(0)
     , maxWriteBuffers(maxWriteBuffers)
     , bufferDeleter(this)
     , buffers()
+    , ioUring()
+    , flusher(this)
 {
     assert(filePathsStr);
 
@@ -1014,11 +1273,27 @@ MultiFileStorage::MultiFileStorage(size_t segmentSize,
     for (size_t frame = 0; frame < frameCount; ++frame)
         frames.emplace_back(this, frame);
 
-    ioQueue.start();
+    if (useIoUring) {
+        try {
+            // Room for every framelet of a frame plus its metadata.
+            ioUring.construct(downCast<uint32_t>(fds.size() + 1));
+        } catch (IoUringException& e) {
+            LOG(WARNING, "Could not set up io_uring for backup storage (%s); "
+                "falling back to POSIX asynchronous IO", e.what());
+        }
+    }
+
+    ioQueue.start(ioQueueDepth);
 
+    if (writeBackStaging) {
+        LOG(NOTICE, "Backup storage is using write-back staging: replica "
+            "buffers are assumed to survive power failures");
+    }
     LOG(NOTICE, "Backup storage opened with %lu bytes available; allocated %lu "
-            "frame(s) across %lu file(s) with %lu bytes per frame",
-            frameCount * segmentSize, frameCount, fds.size(), segmentSize);
+            "frame(s) across %lu file(s) with %lu bytes per frame; up to %u "
+            "frame(s) of IO outstanding",
+            frameCount * segmentSize, frameCount, fds.size(), segmentSize,
+            std::max(ioQueueDepth, 1u));
 }
 
 /// Close the files.
@@ -1125,9 +1400,21 @@ MultiFileStorage::benchmark(BackupStrategy backupStrategy)
 {
     uint32_t r = BackupStorage::benchmark(backupStrategy);
     lastAllocatedFrame = FreeMap::npos;
+    LOG(NOTICE, "Backup storage benchmark used the %s IO engine",
+        getIoEngineName());
     return r;
 }
 
+/**
+ * Return the name of the mechanism used to issue IO to the storage files:
+ * "io_uring" or "posix aio".
+ */
+const char*
+MultiFileStorage::getIoEngineName()
+{
+    return ioUring ? "io_uring" : "posix aio";
+}
+
 /**
  * Returns the maximum number of bytes of metadata that can be stored
  * which each append(). Also, how many bytes of getMetadata() are safe
@@ -1141,6 +1428,23 @@ MultiFileStorage::getMetadataSize()
     return METADATA_SIZE;
 }
 
+/**
+ * Return the percentage of the write buffers (see #maxWriteBuffers) that
+ * are in use. Buffers are released as replicas are written to storage, so
+ * this rises when the disk can't keep up; open() rejects new replicas when
+ * it reaches 100.
+ */
+uint32_t
+MultiFileStorage::getWriteLoad()
+{
+    Lock lock(mutex);
+    if (maxWriteBuffers == 0)
+        return 100;
+    return downCast<uint32_t>(
+            std::min(writeBuffersInUse, maxWriteBuffers) * 100 /
+            maxWriteBuffers);
+}
+
 /**
  * Marks ALL storage frames as allocated, initializes frame state based on
  * metadata if its metadata is valid, and blows away any in-memory copies of
@@ -1157,10 +1461,48 @@ MultiFileStorage::getMetadataSize()
 std::vector<BackupStorage::FrameRef>
 MultiFileStorage::loadAllMetadata()
 {
+    uint64_t start = Cycles::rdtsc();
+
+    // Each frame's metadata is a single block between its framelets in the
+    // first file, so reading them one at a time costs a full device round
+    // trip per frame. Issue them METADATA_LOAD_BATCH at a time instead, so
+    // the device can work on many at once.
+    for (size_t first = 0; first < frames.size();
+            first += METADATA_LOAD_BATCH) {
+        size_t count = std::min<size_t>(METADATA_LOAD_BATCH,
+                                        frames.size() - first);
+        IoUring::Request requests[count];
+        for (size_t i = 0; i < count; i++) {
+            Frame& frame = frames[first + i];
+            IoUring::Request& request = requests[i];
+            request.fd = fds[0];
+            request.offset = offsetOfFrameMetadata(frame.frameIndex);
+            request.buf = frame.appendedMetadata.get();
+            request.length = METADATA_SIZE;
+        }
+        performIo(requests, count);
+
+        for (size_t i = 0; i < count; i++) {
+            IoUring::Request& request = requests[i];
+            ssize_t r = request.result;
+            if (r < 0) {
+                DIE("Failed to read metadata stored in frame %lu: %s, "
+                    "starting offset %lu, length %d",
+                    first + i, strerror(downCast<int>(-r)), request.offset,
+                    METADATA_SIZE);
+            } else if (r != METADATA_SIZE) {
+                DIE("Failed to read metadata stored in frame %lu: reached "
+                    "end of file, starting offset %lu, length %d",
+                    first + i, request.offset, METADATA_SIZE);
+            }
+        }
+    }
+    LOG(NOTICE, "Loaded the metadata of %lu frame(s) in %.1f ms",
+        frames.size(), Cycles::toSeconds(Cycles::rdtsc() - start) * 1e03);
+
     std::vector<FrameRef> ret;
     ret.reserve(frames.size());
     foreach (Frame& frame, frames) {
-        frame.loadMetadata();
         assert(freeMap[frame.frameIndex] == 1);
         freeMap[frame.frameIndex] = 0;
 
@@ -1330,6 +1672,14 @@ MultiFileStorage::loadSuperblock()
 void
 MultiFileStorage::quiesce()
 {
+    if (writeBackStaging) {
+        // Open frames are staged too; push everything out now.
+        Lock lock(mutex);
+        foreach (Frame& frame, frames) {
+            if (!frame.isSynced() && frame.buffer)
+                frame.schedule(lock, PriorityTask::HIGH);
+        }
+    }
     foreach (const Frame& frame, frames) {
         uint64_t start = Cycles::rdtsc();
         while (true) {
@@ -16,10 +16,12 @@
 #ifndef RAMCLOUD_MULTIFILESTORAGE_H
 #define RAMCLOUD_MULTIFILESTORAGE_H
 
+#include <set>
 #include <stack>
 
 #include "Common.h"
 #include "BackupStorage.h"
+#include "IoUring.h"
 #include "PriorityTaskQueue.h"
 
 namespace RAMCloud {
@@ -79,6 +81,11 @@ class MultiFileStorage : public BackupStorage {
                     size_t destinationOffset,
                     const void* metadata,
                     size_t metadataLength);
+        void* getReceiveBuffer();
+        void appendRemotelyWritten(size_t length,
+                                   size_t destinationOffset,
+                                   const void* metadata,
+                                   size_t metadataLength);
         void close();
         void reopen(size_t length);
         void free();
@@ -87,6 +94,13 @@ class MultiFileStorage : public BackupStorage {
 
       PRIVATE:
         void open(bool sync, ServerId masterId, uint64_t segmentId);
+        void appendData(Lock& lock,
+                        Buffer* source,
+                        size_t sourceOffset,
+                        size_t length,
+                        size_t destinationOffset,
+                        const void* metadata,
+                        size_t metadataLength);
 
         void performRead(Lock& lock);
         void performWrite(Lock& lock);
@@ -168,6 +182,14 @@ class MultiFileStorage : public BackupStorage {
         /// Of #appendedLength how much has been stored durably.
         size_t committedLength;
 
+        /**
+         * Bytes at the start of this frame on storage that must be read to
+         * load the replica. Less than the segment size only if this process
+         * stored the replica compressed (see FrameCompression); after a
+         * restart the whole frame is read.
+         */
+        size_t storedLength;
+
         /**
          * Metadata given on the most recent call to append. Starts zeroed
          * on construction. Reset to the metadata stored on disk is
@@ -228,12 +250,17 @@ class MultiFileStorage : public BackupStorage {
                      size_t writeRateLimit,
                      size_t maxNonVolatileBuffers,
                      const char* filePaths,
-                     int openFlags = 0);
+                     int openFlags = 0,
+                     bool useIoUring = false,
+                     uint32_t ioQueueDepth = 1,
+                     bool compressClosedFrames = false,
+                     bool writeBackStaging = false);
     ~MultiFileStorage();
 
     FrameRef open(bool sync, ServerId masterId, uint64_t segmentId);
     uint32_t benchmark(BackupStrategy backupStrategy);
     size_t getMetadataSize();
+    uint32_t getWriteLoad();
     std::vector<FrameRef> loadAllMetadata();
     void resetSuperblock(ServerId serverId,
                                  const string& clusterName,
@@ -243,6 +270,7 @@ class MultiFileStorage : public BackupStorage {
     void fry();
 
     BufferPtr allocateBuffer();
+    const char* getIoEngineName();
 
     /**
      * Internal use only; block size of storage. Needed to deal
@@ -259,16 +287,54 @@ class MultiFileStorage : public BackupStorage {
      */
     enum { METADATA_SIZE = BLOCK_SIZE };
 
+    /**
+     * Most staged frames written by one invocation of the Flusher (see
+     * #writeBackStaging), so that a long backlog doesn't keep recovery
+     * reads waiting.
+     */
+    enum { FLUSH_BATCH_FRAMES = 8 };
+
+    /**
+     * Most metadata blocks read at once by loadAllMetadata() at backup
+     * startup.
+     */
+    enum { METADATA_LOAD_BATCH = 128 };
+
   PRIVATE:
+    /**
+     * Writes closed, staged frames to storage in the background, in order
+     * of their position on storage (see #writeBackStaging).
+     */
+    class Flusher : public PriorityTask {
+      PUBLIC:
+        explicit Flusher(MultiFileStorage* storage);
+        ~Flusher();
+        void performTask();
+        void schedule(Frame::Lock& lock);
+
+        /// Storage whose #stagedFrames this flushes.
+        MultiFileStorage* storage;
+
+        /**
+         * True while an invocation of performTask() is writing frames; with
+         * more than one IO thread a second invocation leaves the frames to
+         * the first one.
+         */
+        bool flushing;
+
+        DISALLOW_COPY_AND_ASSIGN(Flusher);
+    };
+
     size_t bytesInFramelet(size_t fileIndex) const;
     off_t offsetOfFramelet(size_t frameIndex) const;
     off_t offsetOfFrameMetadata(size_t frameIndex) const;
     off_t offsetOfSuperblockFrame(size_t superblockIndex) const;
-    void unlockedRead(Frame::Lock& lock, void* buf, size_t frameIndex,
-                      bool usingDevNull);
+    void unlockedRead(Frame::Lock& lock, void* buf, size_t count,
+                      size_t frameIndex, bool usingDevNull);
     void unlockedWrite(Frame::Lock& lock, void* buf, size_t count,
                        size_t frameIndex, off_t offsetInFrame,
                        void* metadataBuf, size_t metadataCount);
+    void performIo(IoUring::Request* requests, size_t count);
 
     void reserveSpace(int fd);
     Tub<Superblock> tryLoadSuperblock(uint32_t superblockFrame);
@@ -317,6 +383,35 @@ class MultiFileStorage : public BackupStorage {
     /// Extra flags for use while opening filePath (e.g. O_DIRECT | O_SYNC).
     int openFlags;
 
+    /**
+     * If true, replicas opened without sync are held in memory until they
+     * are closed and then written once in compressed form (see
+     * FrameCompression), trading CPU for storage bandwidth on both the
+     * write and the recovery read.
+     */
+    const bool compressClosedFrames;
+
+    /**
+     * If true, the buffers of replicas are assumed to survive power
+     * failures (the backup's DRAM is protected by a battery, UPS or NVDIMMs),
+     * so they form a write-back staging tier in front of the storage files:
+     * appends never wait for storage (even for replicas opened with sync),
+     * data stays in memory until the replica is closed, and closed replicas
+     * are written by #flusher in batches, in frame order, at LOW priority
+     * unless buffers are running out. Loads are served from the buffer
+     * without waiting for the write. open() still rejects new replicas once
+     * #maxWriteBuffers are in use, which pushes back on masters when the
+     * disks can't keep up.
+     */
+    const bool writeBackStaging;
+
+    /**
+     * Indexes of closed frames whose data is still only in memory; used
+     * only with #writeBackStaging. Sorted, so that frames which are
+     * adjacent on storage get written one after another.
+     */
+    std::set<size_t> stagedFrames;
+
     /**
      * The file descriptors of the storage files. See bytesInFramelet() for
      * details on how data is divided between files.
@@ -359,6 +454,15 @@ class MultiFileStorage : public BackupStorage {
      */
     std::stack<void*, std::vector<void*>> buffers;
 
+    /**
+     * If constructed (see the useIoUring constructor argument), all IO to
+     * the storage files is issued through this; otherwise POSIX aio is used.
+     */
+    Tub<IoUring> ioUring;
+
+    /// Writes out #stagedFrames; see #writeBackStaging.
+    Flusher flusher;
+
     DISALLOW_COPY_AND_ASSIGN(MultiFileStorage);
 };
 
@@ -15,6 +15,7 @@
 
 #include "TestUtil.h"
 #include "BackupMasterRecovery.h"
+#include "FrameCompression.h"
 #include "MultiFileStorage.h"
 #include "StringUtil.h"
 
@@ -492,6 +493,43 @@ TEST_F(MultiFileStorageTest, unlockedWriteWholeSegment) {
     }
 }
 
+TEST_F(MultiFileStorageTest, unlockedWrite_ioUring) {
+    // Same as unlockedWriteWholeSegment, but through io_uring, and striped
+    // across three files.
+    std::string threeFiles = std::string(filePath31) + "," + filePath32
+                             + "," + filePath33;
+    storage3.destroy();
+    storage3.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       threeFiles.c_str(), O_DIRECT | O_SYNC, true);
+    if (!storage3->ioUring)
+        return; // Kernel has no io_uring; the aio fallback is tested above.
+    EXPECT_STREQ("io_uring", storage3->getIoEngineName());
+
+    Memory::unique_ptr_free data(
+        Memory::xmemalign(HERE, getpagesize(), segmentSize),
+        std::free);
+    memset(data.get(), 'x', segmentSize - 1);
+    static_cast<char*>(data.get())[segmentSize - 1] = '\0';
+    Buffer source;
+    source.appendExternal(data.get(), segmentSize);
+
+    Frame::testingSkipRealIo = false;
+    BackupStorage::FrameRef frameRef = storage3->open(false, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(source, 0, segmentSize, 0, test, testLength + 1);
+    while (!frame->isSynced());
+
+    // Force a read from disk.
+    frame->buffer.reset();
+    {
+        Frame::Lock lock(frame->storage->mutex);
+        frame->loadRequested = true;
+        frame->performRead(lock);
+    }
+    EXPECT_STREQ(bytes(data.get()), bytes(frame->load()));
+    EXPECT_STREQ(test, bytes(const_cast<void*>(frame->getMetadata())));
+}
+
 TEST_F(MultiFileStorageTest, unlockedWriteMiddleOfSegment) {
     // This test also implicitly tests unlockedRead.
     size_t dataLen1 = BLOCK_SIZE + BLOCK_SIZE / 2;
@@ -538,6 +576,22 @@ TEST_F(MultiFileStorageTest, unlockedWriteMiddleOfSegment) {
     }
 }
 
+TEST_F(MultiFileStorageTest, Frame_appendRemotelyWritten) {
+    storage1->ioQueue.halt();
+    BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    char* receiveBuffer = static_cast<char*>(frame->getReceiveBuffer());
+    EXPECT_EQ(frame->buffer.get(), receiveBuffer);
+    memcpy(receiveBuffer + 5, test, testLength + 1);
+    frame->appendRemotelyWritten(testLength + 1, 5, test, testLength + 1);
+    EXPECT_EQ(testLength + 6, frame->appendedLength);
+    EXPECT_TRUE(frame->isScheduled());
+    EXPECT_STREQ(test, static_cast<char*>(frame->buffer.get()) + 5);
+
+    frame->startLoading();
+    EXPECT_TRUE(NULL == frame->getReceiveBuffer());
+}
+
 TEST_F(MultiFileStorageTest, Frame_performWrite) {
     storage1->ioQueue.halt();
     BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
@@ -592,6 +646,23 @@ TEST_F(MultiFileStorageTest, Frame_performWriteLoadWaiting) {
     EXPECT_TRUE(frame->isScheduled());
 }
 
+TEST_F(MultiFileStorageTest, Frame_performTaskIoAlreadyInProgress) {
+    storage1->ioQueue.halt();
+    BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(testSource, 0, 5, 0, test, testLength + 1);
+    frame->deschedule();
+    TestLog::Enable _;
+    frame->performingIo = true;
+    frame->performTask();
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_FALSE(frame->isSynced());
+    frame->performingIo = false;
+    frame->performTask();
+    EXPECT_EQ("performWrite: sourceBufferOffset 0 count 512 frameIndex 0",
+              TestLog::get());
+}
+
 TEST_F(MultiFileStorageTest, Frame_performWriteSmokeTestOffsets) {
     testSource.reset();
     char garbage[1024];
@@ -671,6 +742,113 @@ TEST_F(MultiFileStorageTest, Frame_performRead) {
     EXPECT_TRUE(frame->buffer);
 }
 
+TEST_F(MultiFileStorageTest, Frame_compressClosedFrames) {
+    Frame::testingSkipRealIo = false;
+    storage1.destroy();
+    storage1.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       filePath1, O_DIRECT | O_SYNC, false, 1, true);
+    storage1->ioQueue.halt();
+    std::string data(segmentSize, 'x');
+    Buffer source;
+    source.appendExternal(data.c_str(), segmentSize);
+
+    BackupStorage::FrameRef frameRef = storage1->open(false, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    frame->append(source, 0, segmentSize, 0, test, testLength + 1);
+    EXPECT_FALSE(frame->isScheduled());
+    frame->close();
+    EXPECT_TRUE(frame->isScheduled());
+    frame->performTask();
+    EXPECT_TRUE(frame->isSynced());
+    EXPECT_FALSE(frame->buffer);
+    EXPECT_EQ(size_t(BLOCK_SIZE), frame->storedLength);
+
+    frame->startLoading();
+    frame->performTask();
+    void* replica = frame->load();
+    ASSERT_TRUE(FrameCompression::isCompressed(replica));
+    std::string expanded(segmentSize, '\0');
+    FrameCompression::decompress(replica, BLOCK_SIZE, &expanded[0],
+                                 segmentSize);
+    EXPECT_TRUE(data == expanded);
+}
+
+TEST_F(MultiFileStorageTest, Frame_writeBackStaging) {
+    storage1.destroy();
+    storage1.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       filePath1, O_DIRECT | O_SYNC, false, 1, false, true);
+    storage1->ioQueue.halt();
+
+    BackupStorage::FrameRef frameRef = storage1->open(true, ServerId(), 0);
+    Frame* frame = static_cast<Frame*>(frameRef.get());
+    TestLog::Enable _;
+    frame->append(testSource, 0, 5, 0, test, testLength + 1);
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_FALSE(frame->isScheduled());
+    EXPECT_FALSE(frame->isSynced());
+
+    frame->close();
+    EXPECT_EQ(1u, storage1->stagedFrames.count(0));
+    EXPECT_TRUE(storage1->flusher.isScheduled());
+    EXPECT_TRUE(frame->buffer);
+
+    // Loads don't wait for the staged data to reach storage.
+    frame->load();
+    EXPECT_FALSE(frame->testingHadToWaitForSyncOnLoad);
+    frame->unload();
+    EXPECT_TRUE(frame->buffer);
+
+    storage1->flusher.deschedule();
+    storage1->flusher.performTask();
+    EXPECT_EQ("performWrite: sourceBufferOffset 0 count 512 frameIndex 0",
+              TestLog::get());
+    EXPECT_TRUE(frame->isSynced());
+    EXPECT_FALSE(frame->buffer);
+    EXPECT_EQ(0u, storage1->stagedFrames.size());
+    EXPECT_EQ(0lu, storage1->writeBuffersInUse);
+    EXPECT_FALSE(storage1->flusher.isScheduled());
+}
+
+TEST_F(MultiFileStorageTest, Flusher_performTask) {
+    storage1.destroy();
+    storage1.construct(segmentSize, segmentFrames, 0, segmentFrames,
+                       filePath1, O_DIRECT | O_SYNC, false, 1, false, true);
+    storage1->ioQueue.halt();
+
+    std::vector<BackupStorage::FrameRef> frameRefs;
+    for (uint64_t segmentId = 0; segmentId < 3; segmentId++) {
+        frameRefs.push_back(storage1->open(false, ServerId(), segmentId));
+        frameRefs.back()->append(testSource, 0, 5, 0, test, testLength + 1);
+    }
+    for (int i = 2; i >= 0; i--)
+        frameRefs[i]->close();
+    // A freed frame is no longer staged.
+    frameRefs[1].reset();
+    EXPECT_EQ(2u, storage1->stagedFrames.size());
+
+    TestLog::Enable _;
+    storage1->flusher.deschedule();
+    storage1->flusher.performTask();
+    EXPECT_EQ("performWrite: sourceBufferOffset 0 count 512 frameIndex 0 | "
+              "performWrite: sourceBufferOffset 0 count 512 frameIndex 2",
+              TestLog::get());
+    EXPECT_EQ(0u, storage1->stagedFrames.size());
+}
+
+TEST_F(MultiFileStorageTest, Flusher_schedule) {
+    storage1->ioQueue.halt();
+    Frame::Lock lock(storage1->mutex);
+    storage1->writeBuffersInUse = 2;
+    storage1->flusher.schedule(lock);
+    EXPECT_EQ(PriorityTask::LOW, storage1->flusher.entry->priority);
+    storage1->flusher.deschedule();
+    storage1->writeBuffersInUse = 3;
+    storage1->flusher.schedule(lock);
+    EXPECT_EQ(PriorityTask::HIGH, storage1->flusher.entry->priority);
+    storage1->flusher.deschedule();
+    storage1->writeBuffersInUse = 0;
+}
+
 TEST_F(MultiFileStorageTest, constructor) {
     struct stat s;
     stat(filePath1, &s);
@@ -736,6 +914,21 @@ TEST_F(MultiFileStorageTest, open_tooManyBuffersInUse) {
                  BackupOpenRejectedException);
 }
 
+TEST_F(MultiFileStorageTest, getWriteLoad) {
+    size_t maxWriteBuffers = storage1->maxWriteBuffers;
+    storage1->writeBuffersInUse = 0;
+    EXPECT_EQ(0u, storage1->getWriteLoad());
+    storage1->maxWriteBuffers = 4;
+    storage1->writeBuffersInUse = 3;
+    EXPECT_EQ(75u, storage1->getWriteLoad());
+    storage1->writeBuffersInUse = 5;
+    EXPECT_EQ(100u, storage1->getWriteLoad());
+    storage1->maxWriteBuffers = 0;
+    EXPECT_EQ(100u, storage1->getWriteLoad());
+    storage1->maxWriteBuffers = maxWriteBuffers;
+    storage1->writeBuffersInUse = 0;
+}
+
 TEST_F(MultiFileStorageTest, loadAllMetadata) {
     uint8_t ones[storage1->getMetadataSize()];
     memset(ones, 0xff, sizeof(ones));
@@ -752,6 +945,24 @@ TEST_F(MultiFileStorageTest, loadAllMetadata) {
     EXPECT_EQ(storage1->frames.size(), frames.size());
 }
 
+TEST_F(MultiFileStorageTest, loadAllMetadata_eachFrame) {
+    writeReplica(1, 10, 99LU, 11LU, true, true);
+    writeReplica(3, 20, 99LU, 33LU, false, true);
+    auto frames = storage1->loadAllMetadata();
+    ASSERT_EQ(4u, frames.size());
+    auto metadata = [&frames](size_t i) {
+        return static_cast<const BackupReplicaMetadata*>(
+                frames[i]->getMetadata());
+    };
+    EXPECT_FALSE(metadata(0)->checkIntegrity());
+    EXPECT_TRUE(metadata(1)->checkIntegrity());
+    EXPECT_EQ(11LU, metadata(1)->segmentId);
+    EXPECT_FALSE(metadata(2)->checkIntegrity());
+    EXPECT_TRUE(metadata(3)->checkIntegrity());
+    EXPECT_EQ(33LU, metadata(3)->segmentId);
+    EXPECT_EQ(20LU, static_cast<Frame*>(frames[3].get())->appendedLength);
+}
+
 TEST_F(MultiFileStorageTest, resetSuperblock) {
     for (uint32_t expectedVersion = 1; expectedVersion < 3; ++expectedVersion) {
         storage1->resetSuperblock({9999, expectedVersion}, "hasso");
@@ -478,6 +478,7 @@ void
 MultiOp::PartRpc::send()
 {
     state = IN_PROGRESS;
+    RpcTrace::recordSend(&request);
     session->sendRequest(&request, response, this);
 }
 
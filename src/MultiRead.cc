@@ -18,10 +18,6 @@
 
 namespace RAMCloud {
 
-// Default RejectRules to use if none are provided by the caller: rejects
-// nothing.
-static RejectRules defaultRejectRules;
-
 /**
  * Constructor for MultiRead objects: initiates one or more RPCs for a
  * multiRead operation, but returns once the RPCs have been initiated,
@@ -41,6 +37,9 @@ MultiRead::MultiRead(RamCloud* ramcloud,
         : MultiOp(ramcloud, type,
                   reinterpret_cast<MultiOpObject* const *>(requests),
                   numRequests)
+        , lastBuffer(NULL)
+        , lastBufferSize(0)
+        , lastTableId(0)
 {
     for (uint32_t i = 0; i < numRequests; i++) {
         requests[i]->value->destroy();
@@ -62,15 +61,36 @@ MultiRead::MultiRead(RamCloud* ramcloud,
 void
 MultiRead::appendRequest(MultiOpObject* request, Buffer* buf)
 {
+    typedef WireFormat::MultiOp::Request::PackedReadPart PackedReadPart;
     MultiReadObject* req = reinterpret_cast<MultiReadObject*>(request);
 
-    // Add the current object to the list of those being
-    // fetched by this RPC.
-    buf->emplaceAppend<WireFormat::MultiOp::Request::ReadPart>(
-            req->tableId, req->keyLength,
-            req->rejectRules ? *req->rejectRules :
-                               defaultRejectRules);
+    // Add the current object to the list of those being fetched by this
+    // RPC. If the last part appended was for the same table and is still
+    // at the end of this request (MultiOp truncates parts that don't fit),
+    // the table id can be left out.
+    PackedReadPart* part = buf->emplaceAppend<PackedReadPart>();
+    part->flags = 0;
+    if (buf != lastBuffer || buf->size() - sizeof32(*part) != lastBufferSize
+            || req->tableId != lastTableId) {
+        part->flags |= PackedReadPart::NEW_TABLE;
+        buf->emplaceAppend<uint64_t>(req->tableId);
+    }
+    if (req->rejectRules != NULL) {
+        part->flags |= PackedReadPart::REJECT_RULES;
+        buf->emplaceAppend<RejectRules>(*req->rejectRules);
+    }
+    uint32_t keyLength = req->keyLength;
+    while (keyLength >= 0x80) {
+        buf->emplaceAppend<uint8_t>(
+                static_cast<uint8_t>((keyLength & 0x7f) | 0x80));
+        keyLength >>= 7;
+    }
+    buf->emplaceAppend<uint8_t>(downCast<uint8_t>(keyLength));
     buf->appendCopy(req->key, req->keyLength);
+
+    lastBuffer = buf;
+    lastBufferSize = buf->size();
+    lastTableId = req->tableId;
 }
 
 /**
@@ -30,7 +30,7 @@ namespace RAMCloud {
 
 class MultiRead : public MultiOp {
     static const WireFormat::MultiOp::OpType type =
-                                        WireFormat::MultiOp::OpType::READ;
+                                    WireFormat::MultiOp::OpType::PACKED_READ;
   PUBLIC:
     MultiRead(RamCloud* ramcloud,
               MultiReadObject* const requests[],
@@ -41,6 +41,17 @@ class MultiRead : public MultiOp {
     bool readResponse(MultiOpObject* request, Buffer* response,
                       uint32_t* respOffset);
 
+  PRIVATE:
+    /// The buffer that appendRequest last appended to, and its size
+    /// afterwards. Used to tell whether the part appended last is still
+    /// the last part in that request, in which case the next part needn't
+    /// repeat its table id.
+    Buffer* lastBuffer;
+    uint32_t lastBufferSize;
+
+    /// The table of the part appendRequest last appended.
+    uint64_t lastTableId;
+
     DISALLOW_COPY_AND_ASSIGN(MultiRead);
 };
 
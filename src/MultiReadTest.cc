@@ -260,11 +260,60 @@ TEST_F(MultiReadTest, appendRequest) {
     request.appendRequest(requests[0], &buf);
     dif = buf.size() - before;
 
-    uint32_t expected_size = sizeof32(WireFormat::MultiOp::Request::ReadPart) +
-                    requests[0]->keyLength;
+    // Flags, table id, one byte of key length, key.
+    uint32_t expected_size = 1 + 8 + 1 + requests[0]->keyLength;
     EXPECT_EQ(expected_size, dif);
 }
 
+TEST_F(MultiReadTest, appendRequest_sharedTableId) {
+    typedef WireFormat::MultiOp::Request::PackedReadPart PackedReadPart;
+    RejectRules rules = {5, 0, 0, 0, 1};
+    objects[1].rejectRules = &rules;
+    MultiReadObject* requests[] = {&objects[0], &objects[1], &objects[3]};
+    Buffer buf;
+    MultiRead request(ramcloud.get(), requests, 0);
+    request.wait();
+
+    request.appendRequest(requests[0], &buf);
+    uint32_t second = buf.size();
+    request.appendRequest(requests[1], &buf);
+    uint32_t third = buf.size();
+    request.appendRequest(requests[2], &buf);
+
+    EXPECT_EQ(static_cast<uint8_t>(PackedReadPart::NEW_TABLE),
+              *buf.getOffset<uint8_t>(0));
+    EXPECT_EQ(tableId1, *buf.getOffset<uint64_t>(1));
+    EXPECT_EQ(static_cast<uint8_t>(PackedReadPart::REJECT_RULES),
+              *buf.getOffset<uint8_t>(second));
+    EXPECT_EQ(5U, buf.getOffset<RejectRules>(second + 1)->givenVersion);
+    EXPECT_EQ(1 + sizeof32(RejectRules) + 1 + 9, third - second);
+    EXPECT_EQ(static_cast<uint8_t>(PackedReadPart::NEW_TABLE),
+              *buf.getOffset<uint8_t>(third));
+
+    // Once a part has been truncated away, the next one can't rely on its
+    // table id.
+    buf.truncate(third);
+    request.appendRequest(requests[2], &buf);
+    EXPECT_EQ(static_cast<uint8_t>(PackedReadPart::NEW_TABLE),
+              *buf.getOffset<uint8_t>(third));
+}
+
+TEST_F(MultiReadTest, appendRequest_longKey) {
+    char key[300];
+    memset(key, 'k', sizeof(key));
+    objects[0].key = key;
+    objects[0].keyLength = 300;
+    MultiReadObject* requests[] = {&objects[0]};
+    Buffer buf;
+    MultiRead request(ramcloud.get(), requests, 0);
+    request.wait();
+
+    request.appendRequest(requests[0], &buf);
+    EXPECT_EQ(1 + 8 + 2 + 300U, buf.size());
+    EXPECT_EQ(0xacU, *buf.getOffset<uint8_t>(9));
+    EXPECT_EQ(0x02U, *buf.getOffset<uint8_t>(10));
+}
+
 TEST_F(MultiReadTest, readResponse_shortResponse) {
     // This test checks for proper handling of responses that are
     // too short.
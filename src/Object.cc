@@ -13,10 +13,13 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <zlib.h>
+
 #include "Common.h"
 #include "Crc32C.h"
 #include "Object.h"
 #include "RamCloud.h"
+#include "ShortMacros.h"
 
 namespace RAMCloud {
 
@@ -56,6 +59,9 @@ Object::Object(uint64_t tableId,
     : header(tableId,
              timestamp,
              version),
+      expiry(0),
+      compactHeader(false),
+      deferChecksum(false),
       keysAndValueLength(),
       keysAndValue(),
       keysAndValueBuffer(&keysAndValueBuffer),
@@ -112,6 +118,9 @@ Object::Object(Key& key,
     : header(key.getTableId(),
              timestamp,
              version),
+      expiry(0),
+      compactHeader(false),
+      deferChecksum(false),
       keysAndValueLength(),
       keysAndValue(),
       keysAndValueBuffer(),
@@ -161,22 +170,32 @@ Object::Object(Key& key,
  *      starting at offset.
  */
 Object::Object(Buffer& buffer, uint32_t offset, uint32_t length)
-    : header(*buffer.getOffset<Header>(offset)),
+    : header(0, 0, 0),
+      expiry(0),
+      compactHeader(false),
+      deferChecksum(false),
       keysAndValueLength(),
       keysAndValue(),
       keysAndValueBuffer(&buffer),
-      keysAndValueOffset(offset + sizeof32(header)),
+      keysAndValueOffset(offset),
       keyOffsets(NULL)
 {
+    // A compact object may be shorter than a full header.
+    uint32_t available = std::min(sizeof32(Header), buffer.size() - offset);
+    keysAndValueOffset += parseHeader(buffer.getRange(offset, available),
+                                      available);
+    if (header.timestamp & EXPIRY_FLAG) {
+        expiry = *buffer.getOffset<uint32_t>(keysAndValueOffset);
+        keysAndValueOffset += sizeof32(expiry);
+    }
+
     // If length is not specified, compute the length of keysAndValue
     if (length == 0)
-        keysAndValueLength = buffer.size() - offset -
-                             sizeof32(header);
-    else
-        keysAndValueLength = length - sizeof32(header);
+        length = buffer.size() - offset;
+    keysAndValueLength = length - (keysAndValueOffset - offset);
 
     void* retPtr;
-    if (buffer.peek(offset + sizeof32(header), &retPtr) >= keysAndValueLength)
+    if (buffer.peek(keysAndValueOffset, &retPtr) >= keysAndValueLength)
         keysAndValue = static_cast<char*>(retPtr);
 }
 
@@ -193,14 +212,25 @@ Object::Object(Buffer& buffer, uint32_t offset, uint32_t length)
  *      Total length of the object in bytes.
  */
 Object::Object(const void* buffer, uint32_t length)
-    : header(*reinterpret_cast<const Header*>(buffer)),
-      keysAndValueLength(length - sizeof32(header)),
-      keysAndValue(reinterpret_cast<const void*>(reinterpret_cast<
-                   const uint8_t*>(buffer) + sizeof32(header))),
+    : header(0, 0, 0),
+      expiry(0),
+      compactHeader(false),
+      deferChecksum(false),
+      keysAndValueLength(),
+      keysAndValue(),
       keysAndValueBuffer(),
       keysAndValueOffset(0),
       keyOffsets(NULL)
 {
+    uint32_t headerLength = parseHeader(buffer, length);
+    keysAndValueLength = length - headerLength;
+    keysAndValue = static_cast<const uint8_t*>(buffer) + headerLength;
+    if (header.timestamp & EXPIRY_FLAG) {
+        memcpy(&expiry, keysAndValue, sizeof(expiry));
+        keysAndValue = static_cast<const uint8_t*>(keysAndValue) +
+                sizeof(expiry);
+        keysAndValueLength -= sizeof32(expiry);
+    }
 }
 
 /**
@@ -213,8 +243,12 @@ Object::Object(const void* buffer, uint32_t length)
 void
 Object::assembleForLog(Buffer& buffer)
 {
-    header.checksum = computeChecksum();
-    buffer.append(&header, sizeof32(header));
+    header.checksum = deferChecksum ? 0 : computeChecksum();
+    bool compact = hasCompactHeader();
+    serializeHeader(header, compact, deferChecksum, buffer.alloc(compact ?
+            sizeof32(CompactHeader) : sizeof32(Header)));
+    if (expiry != 0)
+        buffer.append(&expiry, sizeof32(expiry));
     appendKeysAndValueToBuffer(buffer);
 }
 
@@ -231,10 +265,135 @@ void
 Object::assembleForLog(void* memBlock)
 {
     uint8_t *dst = reinterpret_cast<uint8_t*>(memBlock);
-    header.checksum = computeChecksum();
+    header.checksum = deferChecksum ? 0 : computeChecksum();
 
-    memcpy(dst, &header, sizeof32(header));
-    memcpy(dst + sizeof32(header), getKeysAndValue(), keysAndValueLength);
+    dst += serializeHeader(header, hasCompactHeader(), deferChecksum, dst);
+    if (expiry != 0) {
+        memcpy(dst, &expiry, sizeof32(expiry));
+        dst += sizeof32(expiry);
+    }
+    memcpy(dst, getKeysAndValue(), keysAndValueLength);
+}
+
+/**
+ * Append the full object to a buffer as assembleForLog() would, except
+ * that the value is compressed. Nothing is appended if that wouldn't make
+ * the object any smaller.
+ *
+ * \param buffer
+ *      The buffer to append a serialized version of this object to.
+ * \return
+ *      True if the object was appended. False means the caller should use
+ *      assembleForLog() instead.
+ */
+bool
+Object::assembleCompressedForLog(Buffer& buffer)
+{
+    uint32_t valueOffset;
+    if (isCompressed() || !getValueOffset(&valueOffset))
+        return false;
+    uint32_t valueLength = keysAndValueLength - valueOffset;
+    if (valueLength == 0)
+        return false;
+
+    std::vector<Bytef> data(sizeof(valueLength) + compressBound(valueLength));
+    memcpy(&data[0], &valueLength, sizeof(valueLength));
+    uLongf compressedLength = data.size() - sizeof(valueLength);
+    int r = compress2(&data[sizeof(valueLength)], &compressedLength,
+                      static_cast<const Bytef*>(getValue()), valueLength,
+                      Z_BEST_SPEED);
+    uint32_t dataLength = downCast<uint32_t>(sizeof(valueLength) +
+                                             compressedLength);
+    if (r != Z_OK || dataLength >= valueLength)
+        return false;
+
+    // As in computeChecksum(), but over the compressed value.
+    Header logHeader = header;
+    logHeader.timestamp |= COMPRESSED_FLAG;
+    logHeader.checksum = 0;
+    if (!deferChecksum) {
+        Crc32C crc;
+        crc.update(reinterpret_cast<uint8_t*>(&logHeader) +
+                   sizeof(logHeader.checksum),
+                   downCast<uint32_t>(sizeof(logHeader) -
+                   sizeof(logHeader.checksum)));
+        if (expiry != 0)
+            crc.update(&expiry, sizeof32(expiry));
+        if (keysAndValueBuffer) {
+            crc.update(*keysAndValueBuffer, keysAndValueOffset, valueOffset);
+        } else {
+            crc.update(keysAndValue, valueOffset);
+        }
+        crc.update(&data[0], dataLength);
+        logHeader.checksum = crc.getResult();
+    }
+
+    bool compact = hasCompactHeader();
+    serializeHeader(logHeader, compact, deferChecksum, buffer.alloc(compact ?
+            sizeof32(CompactHeader) : sizeof32(Header)));
+    if (expiry != 0)
+        buffer.appendCopy(&expiry, sizeof32(expiry));
+    if (keysAndValueBuffer) {
+        buffer.append(keysAndValueBuffer, keysAndValueOffset, valueOffset);
+    } else {
+        buffer.append(keysAndValue, valueOffset);
+    }
+    buffer.appendCopy(&data[0], dataLength);
+    return true;
+}
+
+/**
+ * Expand the value of an object that was stored with
+ * assembleCompressedForLog(). Afterwards this object describes the keys and
+ * the original value, exactly as if the value had never been compressed.
+ * Objects whose values aren't compressed are left alone.
+ *
+ * \param buffer
+ *      The keys and expanded value are appended here. This must not be the
+ *      buffer holding the object, and it must outlive any further use of
+ *      this object.
+ */
+void
+Object::decompressValue(Buffer& buffer)
+{
+    uint32_t valueOffset;
+    if (!isCompressed() || !getValueOffset(&valueOffset))
+        return;
+    uint32_t dataLength = keysAndValueLength - valueOffset;
+    const Bytef* data = static_cast<const Bytef*>(getValue());
+    uint32_t valueLength = 0;
+    if (dataLength >= sizeof(valueLength))
+        memcpy(&valueLength, data, sizeof(valueLength));
+
+    uint32_t start = buffer.size();
+    if (keysAndValueBuffer) {
+        buffer.append(keysAndValueBuffer, keysAndValueOffset, valueOffset);
+    } else {
+        buffer.append(keysAndValue, valueOffset);
+    }
+    uLongf length = valueLength;
+    int r = Z_DATA_ERROR;
+    if (dataLength >= sizeof(valueLength)) {
+        r = uncompress(static_cast<Bytef*>(buffer.alloc(valueLength)),
+                       &length, data + sizeof(valueLength),
+                       dataLength - sizeof32(valueLength));
+    }
+    if (r != Z_OK || length != valueLength) {
+        DIE("failed to decompress object value: zlib error %d, expanded to "
+            "%lu of %u bytes", r, length, valueLength);
+    }
+
+    header.timestamp &= ~COMPRESSED_FLAG;
+    keysAndValueLength = valueOffset + valueLength;
+    keysAndValueBuffer = &buffer;
+    keysAndValueOffset = start;
+    keysAndValue = NULL;
+    keyOffsets = NULL;
+    void* retPtr;
+    if (buffer.peek(start, &retPtr) >= keysAndValueLength)
+        keysAndValue = retPtr;
+    if (!hasDeferredChecksum())
+        header.checksum = computeChecksum();
 }
 
 /**
@@ -700,7 +859,51 @@ Object::getVersion()
 uint32_t
 Object::getTimestamp()
 {
-    return header.timestamp;
+    return header.timestamp & ~(EXPIRY_FLAG | COMPRESSED_FLAG);
+}
+
+/**
+ * Obtain the time at which this object expires, in the units of
+ * WallTime::secondsTimestamp(), or 0 if it never expires.
+ */
+uint32_t
+Object::getExpiry()
+{
+    return expiry;
+}
+
+/**
+ * Return true if this object has expired.
+ *
+ * \param now
+ *      The current time, as returned by WallTime::secondsTimestamp().
+ */
+bool
+Object::isExpired(uint32_t now)
+{
+    return expiry != 0 && now >= expiry;
+}
+
+/**
+ * Return true if the value of this object is stored compressed (see
+ * assembleCompressedForLog()) and hasn't been expanded by decompressValue().
+ */
+bool
+Object::isCompressed()
+{
+    return (header.timestamp & COMPRESSED_FLAG) != 0;
+}
+
+/**
+ * Return true if assembleForLog() stores this object with a CompactHeader
+ * (or, for an object read from the log, if it was stored that way). See
+ * setCompactHeader().
+ */
+bool
+Object::hasCompactHeader()
+{
+    return compactHeader && header.tableId <= MAX_COMPACT_TABLE_ID &&
+            header.version <= MAX_COMPACT_VERSION;
 }
 
 /**
@@ -709,20 +912,35 @@ Object::getTimestamp()
 uint32_t
 Object::getSerializedLength()
 {
-    return sizeof32(header) + keysAndValueLength;
+    return (hasCompactHeader() ? sizeof32(CompactHeader) : sizeof32(header)) +
+            (expiry != 0 ? sizeof32(expiry) : 0) + keysAndValueLength;
 }
 
 /**
  * Compute a checksum on the object and determine whether or not it matches
  * what is stored in the object. Returns true if the checksum looks ok,
- * otherwise returns false.
+ * otherwise returns false. Objects written with a deferred checksum (see
+ * setDeferredChecksum()) always look ok: they are protected by the content
+ * checksum of the segment they were written to instead.
  */
 bool
 Object::checkIntegrity()
 {
+    if (hasDeferredChecksum())
+        return true;
     return computeChecksum() == header.checksum;
 }
 
+/**
+ * Return true if this object was stored (or, for one not yet written to the
+ * log, is to be stored) without its own checksum; see setDeferredChecksum().
+ */
+bool
+Object::hasDeferredChecksum()
+{
+    return deferChecksum;
+}
+
 /* Set the version for this object */
 void
 Object::setVersion(uint64_t version)
@@ -734,7 +952,58 @@ Object::setVersion(uint64_t version)
 void
 Object::setTimestamp(uint32_t timestamp)
 {
-    header.timestamp = timestamp;
+    const uint32_t flags = EXPIRY_FLAG | COMPRESSED_FLAG;
+    header.timestamp = (timestamp & ~flags) | (header.timestamp & flags);
+}
+
+/**
+ * Choose the header assembleForLog() and assembleCompressedForLog() store
+ * this object with.
+ *
+ * \param compact
+ *      True means a CompactHeader is used if the table id and version of the
+ *      object fit in one; false means a full Header is always used.
+ */
+void
+Object::setCompactHeader(bool compact)
+{
+    compactHeader = compact;
+}
+
+/**
+ * Choose whether assembleForLog() and assembleCompressedForLog() compute a
+ * checksum for this object. Computing it is the largest cost of a write
+ * after copying the value, so masters whose segments carry content
+ * checksums (see Segment::enableContentChecksum()) may leave it out and
+ * mark the object with DEFERRED_CHECKSUM_FLAG instead; corruption of the
+ * object is then caught when its segment is verified on a backup during
+ * recovery.
+ *
+ * \param defer
+ *      True means no checksum is computed for the object.
+ */
+void
+Object::setDeferredChecksum(bool defer)
+{
+    deferChecksum = defer;
+}
+
+/**
+ * Set the time at which this object expires; it is then treated as if it
+ * didn't exist. This makes the serialized object 4 bytes longer.
+ *
+ * \param expiry
+ *      Expiry time, in the units of WallTime::secondsTimestamp(), or 0
+ *      if the object should never expire.
+ */
+void
+Object::setExpiry(uint32_t expiry)
+{
+    this->expiry = expiry;
+    if (expiry != 0)
+        header.timestamp |= EXPIRY_FLAG;
+    else
+        header.timestamp &= ~EXPIRY_FLAG;
 }
 
 /**
@@ -754,6 +1023,8 @@ Object::applyChecksum(Crc32C *crc)
                &header) + sizeof(header.checksum)),
                downCast<uint32_t>(sizeof(header) -
                sizeof(header.checksum)));
+    if (expiry != 0)
+        crc->update(&expiry, sizeof32(expiry));
 
     // then compute the checksum on keysAndValue.
     if (keysAndValue) {
@@ -780,6 +1051,8 @@ Object::computeChecksum()
                &header) + sizeof(header.checksum)),
                downCast<uint32_t>(sizeof(header) -
                sizeof(header.checksum)));
+    if (expiry != 0)
+        crc.update(&expiry, sizeof32(expiry));
 
     // then compute the checksum on keysAndValue.
     if (keysAndValue) {
@@ -793,29 +1066,73 @@ Object::computeChecksum()
 }
 
 /**
- * Given a pointer to a contiguous Object in memory, compute and return
- * its checksum.
- * \param object
- *      Pointer to the beginning of the object. This object contains the
- *      header and keysAndValue
- * \param totalLength
- *      Total length of the object in bytes, including the header, keys
- *      and value
+ * Copy a serialized object header to memory.
+ *
+ * \param header
+ *      The header to copy, with its checksum already computed.
+ * \param compact
+ *      True means the header is stored as a CompactHeader; the table id and
+ *      version must fit in one.
+ * \param deferredChecksum
+ *      True means the object is stored without a checksum, which is recorded
+ *      with DEFERRED_CHECKSUM_FLAG.
+ * \param destination
+ *      Where the header is written; must have room for it.
+ * \return
+ *      The number of bytes written.
  */
 uint32_t
-Object::computeChecksum(const Object::Header* object,
-                        uint32_t totalLength)
+Object::serializeHeader(const Header& header, bool compact,
+                        bool deferredChecksum, void* destination)
 {
-    Crc32C crc;
-    crc.update(reinterpret_cast<const void *>(
-               reinterpret_cast<const uint8_t *>(
-               object) + sizeof(header.checksum)),
-               downCast<uint32_t>(sizeof(header) -
-               sizeof(header.checksum)));
+    uint64_t flags = deferredChecksum ? DEFERRED_CHECKSUM_FLAG : 0;
+    if (!compact) {
+        Header stored = header;
+        stored.version |= flags;
+        memcpy(destination, &stored, sizeof(stored));
+        return sizeof32(stored);
+    }
+    assert(header.tableId <= MAX_COMPACT_TABLE_ID &&
+           header.version <= MAX_COMPACT_VERSION);
+    CompactHeader compactHeader;
+    compactHeader.checksum = header.checksum;
+    compactHeader.timestamp = header.timestamp;
+    compactHeader.tableIdAndVersion = COMPACT_FLAG | flags |
+            (header.tableId << 48) | header.version;
+    memcpy(destination, &compactHeader, sizeof(compactHeader));
+    return sizeof32(compactHeader);
+}
 
-    uint32_t len = totalLength - sizeof32(Header);
-    crc.update(&object->keysAndData[0], len);
-    return crc.getResult();
+/**
+ * Fill in #header, #compactHeader and #deferChecksum from the header at the
+ * start of a serialized object.
+ *
+ * \param stored
+ *      First byte of the serialized object.
+ * \param length
+ *      Number of bytes available at \a stored; at least the length of the
+ *      header the object was stored with.
+ * \return
+ *      The length of the stored header.
+ */
+uint32_t
+Object::parseHeader(const void* stored, uint32_t length)
+{
+    CompactHeader compact = {0, 0, 0};
+    memcpy(&compact, stored, std::min(length, sizeof32(compact)));
+    deferChecksum = (compact.tableIdAndVersion & DEFERRED_CHECKSUM_FLAG) != 0;
+    if ((compact.tableIdAndVersion & COMPACT_FLAG) == 0) {
+        memcpy(&header, stored, std::min(length, sizeof32(header)));
+        header.version &= ~DEFERRED_CHECKSUM_FLAG;
+        return sizeof32(header);
+    }
+    header.checksum = compact.checksum;
+    header.timestamp = compact.timestamp;
+    header.version = compact.tableIdAndVersion & MAX_COMPACT_VERSION;
+    header.tableId = (compact.tableIdAndVersion >> 48) &
+            MAX_COMPACT_TABLE_ID;
+    compactHeader = true;
+    return sizeof32(compact);
 }
 
 /**
@@ -1056,6 +1373,213 @@ ObjectTombstone::computeChecksum()
     return crc.getResult();
 }
 
+/**
+ * Construct a new delta appending data to an object. Use this constructor
+ * when generating new deltas to be written to the log.
+ *
+ * Neither the key nor the data may be mutated after this call, since the
+ * checksum is computed during construction.
+ *
+ * \param key
+ *      Primary key of the object the data is appended to.
+ * \param version
+ *      Version of the object once the data has been appended.
+ * \param timestamp
+ *      The creation time of this delta, as returned by the WallTime module.
+ * \param data
+ *      Buffer containing the data to append.
+ * \param dataOffset
+ *      Offset of the data in \a data.
+ * \param dataLength
+ *      Number of bytes to append.
+ */
+ObjectDelta::ObjectDelta(Key& key, uint64_t version, uint32_t timestamp,
+                         Buffer& data, uint32_t dataOffset, uint32_t dataLength)
+    : header(key.getTableId(),
+             version,
+             timestamp,
+             key.getStringKeyLength()),
+      deltaBuffer(&data),
+      key(key.getStringKey()),
+      keyOffset(0),
+      dataOffset(dataOffset),
+      dataLength(dataLength)
+{
+    header.checksum = computeChecksum();
+}
+
+/**
+ * Construct a delta by deserializing an existing one. Use this constructor
+ * when reading deltas from the log or from individual log segments.
+ *
+ * \param buffer
+ *      Buffer pointing to a complete serialized delta. It is the caller's
+ *      responsibility to make sure that the buffer passed in actually
+ *      contains a full delta. If it does not, then behavior is undefined.
+ * \param offset
+ *      Starting offset in the buffer where the delta begins.
+ * \param length
+ *      Total length of the delta in bytes. A length of 0 means that the
+ *      delta occupies the entire buffer starting at offset.
+ */
+ObjectDelta::ObjectDelta(Buffer& buffer, uint32_t offset, uint32_t length)
+    : header(*buffer.getOffset<Header>(offset)),
+      deltaBuffer(&buffer),
+      key(NULL),
+      keyOffset(offset + sizeof32(Header)),
+      dataOffset(offset + sizeof32(Header) + header.keyLength),
+      dataLength()
+{
+    if (length == 0)
+        length = buffer.size() - offset;
+    dataLength = length - sizeof32(Header) - header.keyLength;
+}
+
+/**
+ * Append the serialized delta (header, primary key, and data) to the
+ * provided buffer.
+ *
+ * \param buffer
+ *      The buffer to append a serialized version of this delta to.
+ */
+void
+ObjectDelta::assembleForLog(Buffer& buffer)
+{
+    buffer.appendCopy(&header, sizeof32(header));
+    if (key) {
+        buffer.append(key, getKeyLength());
+    } else {
+        buffer.append(deltaBuffer, keyOffset, getKeyLength());
+    }
+    appendDataToBuffer(buffer);
+}
+
+/**
+ * Append the data this delta adds to the object's value to a buffer.
+ *
+ * \param buffer
+ *      The buffer to append the data to.
+ */
+void
+ObjectDelta::appendDataToBuffer(Buffer& buffer)
+{
+    buffer.append(deltaBuffer, dataOffset, dataLength);
+}
+
+/**
+ * Change the tableId for the delta, and correspondingly, recompute
+ * the checksum.
+ *
+ * \param newTableId
+ *      The tableId that this delta should refer to.
+ */
+void
+ObjectDelta::changeTableId(uint64_t newTableId)
+{
+    header.tableId = newTableId;
+    header.checksum = computeChecksum();
+}
+
+/**
+ * Obtain the 64-bit table identifier of the object this delta belongs to.
+ */
+uint64_t
+ObjectDelta::getTableId()
+{
+    return header.tableId;
+}
+
+/**
+ * Obtain a pointer to a contiguous copy of the primary key of the object
+ * this delta belongs to. Note that if the key is not already contiguous, it
+ * will be copied.
+ */
+const void*
+ObjectDelta::getKey()
+{
+    if (key)
+        return key;
+
+    return deltaBuffer->getRange(keyOffset, getKeyLength());
+}
+
+/**
+ * Obtain the length of the primary key of the object this delta belongs to.
+ */
+KeyLength
+ObjectDelta::getKeyLength()
+{
+    return header.keyLength;
+}
+
+/**
+ * Obtain the version of the object once this delta has been applied.
+ */
+uint64_t
+ObjectDelta::getVersion()
+{
+    return header.version;
+}
+
+/**
+ * Obtain the timestamp associated with this delta. See WallTime.cc for
+ * interpreting the timestamp.
+ */
+uint32_t
+ObjectDelta::getTimestamp()
+{
+    return header.timestamp;
+}
+
+/**
+ * Obtain the number of bytes this delta appends to the object's value.
+ */
+uint32_t
+ObjectDelta::getDataLength()
+{
+    return dataLength;
+}
+
+/**
+ * Compute a checksum on the delta and determine whether or not it matches
+ * what is stored in it. Returns true if the checksum looks ok, otherwise
+ * returns false.
+ */
+bool
+ObjectDelta::checkIntegrity()
+{
+    return computeChecksum() == header.checksum;
+}
+
+/**
+ * Compute the total length of the serialized delta.
+ */
+uint32_t
+ObjectDelta::getSerializedLength()
+{
+    return sizeof32(Header) + getKeyLength() + dataLength;
+}
+
+/**
+ * Compute the delta's checksum and return it.
+ */
+uint32_t
+ObjectDelta::computeChecksum()
+{
+    assert(OFFSET_OF(Header, checksum) ==
+        (sizeof(header) - sizeof(header.checksum)));
+
+    Crc32C crc;
+    crc.update(&header, downCast<uint32_t>(OFFSET_OF(Header, checksum)));
+    if (key) {
+        crc.update(key, getKeyLength());
+    } else {
+        crc.update(*deltaBuffer, keyOffset, getKeyLength());
+    }
+    crc.update(*deltaBuffer, dataOffset, dataLength);
+    return crc.getResult();
+}
+
 /**
  * Construct a safeVersion objectg
  *
@@ -78,6 +78,26 @@ struct KeyOffsets
  *
  * If Key_i is not present, CumulativeKeyLength_i = CumulativeKeyLength_i-1.
  * Consequently, Length_i = 0
+ *
+ * Objects that expire (see setExpiry()) have the EXPIRY_FLAG bit set in the
+ * header's timestamp and a 32-bit expiry time between the header and
+ * keysAndValue. Other objects don't pay for the field.
+ *
+ * Objects written with assembleCompressedForLog() have the COMPRESSED_FLAG
+ * bit set in the header's timestamp, and their "Data" is the 32-bit length
+ * of the original value followed by the value compressed with zlib. The
+ * keys are never compressed. Until decompressValue() is called, getValue()
+ * and related methods describe the compressed form.
+ *
+ * Objects in tables with small ids may be stored with a CompactHeader in
+ * place of the Header (see setCompactHeader()), saving 8 bytes. The two are
+ * told apart by COMPACT_FLAG; checksums are computed over the fields of a
+ * full Header either way, so an object can be converted from one form to
+ * the other without recomputing its checksum.
+ *
+ * Objects may also be stored without a checksum (see setDeferredChecksum()),
+ * in which case the segment they are written to is checksummed as a whole.
+ * Such objects have DEFERRED_CHECKSUM_FLAG set in the stored version.
  */
 class Object {
   public:
@@ -91,6 +111,8 @@ class Object {
 
     void assembleForLog(Buffer& buffer);
     void assembleForLog(void* buffer);
+    bool assembleCompressedForLog(Buffer& buffer);
+    void decompressValue(Buffer& buffer);
     void appendValueToBuffer(Buffer* buffer);
     static void appendKeysAndValueToBuffer(
             uint64_t tableId, KeyCount numKeys, KeyInfo *keyList,
@@ -123,11 +145,33 @@ class Object {
     uint32_t getKeysAndValueLength();
     uint64_t getVersion();
     uint32_t getTimestamp();
+    uint32_t getExpiry();
+    bool isExpired(uint32_t now);
+    bool isCompressed();
+    bool hasCompactHeader();
+    bool hasDeferredChecksum();
     uint32_t getSerializedLength();
 
     bool checkIntegrity();
     void setVersion(uint64_t version);
     void setTimestamp(uint32_t timestamp);
+    void setExpiry(uint32_t expiry);
+    void setCompactHeader(bool compact);
+    void setDeferredChecksum(bool defer);
+
+    /// Set in Header::timestamp if an expiry time follows the header.
+    /// Timestamps count seconds from 2011 (see WallTime), so this bit and
+    /// COMPRESSED_FLAG are otherwise unused (until 2045).
+    static const uint32_t EXPIRY_FLAG = 1U << 31;
+
+    /// Set in Header::timestamp if the value is stored compressed.
+    static const uint32_t COMPRESSED_FLAG = 1U << 30;
+
+    /// Set in the stored Header::version (or in
+    /// CompactHeader::tableIdAndVersion) of objects written without a
+    /// checksum. The timestamp has no bit to spare past 2027, but versions
+    /// never come near 2^62.
+    static const uint64_t DEFERRED_CHECKSUM_FLAG = 1UL << 62;
 
 //  PRIVATE:
     /**
@@ -163,6 +207,8 @@ class Object {
         uint32_t checksum;
 
         /// Object creation/modification timestamp. WallTime.cc is the clock.
+        /// The top two bits are EXPIRY_FLAG and COMPRESSED_FLAG rather than
+        /// part of the time.
         uint32_t timestamp;
 
         /// Version of the object. Set to some initial value upon object
@@ -181,9 +227,37 @@ class Object {
     static_assert(sizeof(Header) == 24,
         "Unexpected serialized Object size");
 
+    /**
+     * Smaller form of Header, used for objects whose table id and version
+     * fit in the bits of a full Header's version that are never used.
+     */
+    struct CompactHeader {
+        /// As in Header.
+        uint32_t checksum;
 
-    static uint32_t computeChecksum(const Object::Header* object,
-                                    uint32_t totalLength);
+        /// As in Header.
+        uint32_t timestamp;
+
+        /// COMPACT_FLAG, then DEFERRED_CHECKSUM_FLAG, then the table id
+        /// (14 bits), then the version (48 bits). This overlays
+        /// Header::version, whose top bit is always 0.
+        uint64_t tableIdAndVersion;
+    } __attribute__((__packed__));
+    static_assert(sizeof(CompactHeader) == 16,
+        "Unexpected serialized compact Object header size");
+
+    /// Set in CompactHeader::tableIdAndVersion.
+    static const uint64_t COMPACT_FLAG = 1UL << 63;
+
+    /// Largest table id that fits in a CompactHeader.
+    static const uint64_t MAX_COMPACT_TABLE_ID = (1UL << 14) - 1;
+
+    /// Largest version that fits in a CompactHeader.
+    static const uint64_t MAX_COMPACT_VERSION = (1UL << 48) - 1;
+
+    static uint32_t serializeHeader(const Header& header, bool compact,
+                                    bool deferredChecksum, void* destination);
+    uint32_t parseHeader(const void* stored, uint32_t length);
     uint32_t computeChecksum();
     void applyChecksum(Crc32C *crc);
 
@@ -191,6 +265,18 @@ class Object {
     /// Copy of the object header that is in, or will be written to, the log.
     Header header;
 
+    /// Time at which the object expires, in WallTime seconds, or 0 if it
+    /// never does. Stored after the header only if it is not 0.
+    uint32_t expiry;
+
+    /// True if the object is stored, or is to be stored, with a
+    /// CompactHeader when its table id and version allow it.
+    bool compactHeader;
+
+    /// True if the object is to be stored (or, for one read from the log,
+    /// was stored) without a checksum; see setDeferredChecksum().
+    bool deferChecksum;
+
     /// Length that includes the number of keys, the key lengths, the keys
     /// and the value. This isn't stored in Header since it can be computed
     /// as needed.
@@ -358,6 +444,129 @@ class ObjectTombstone {
     DISALLOW_COPY_AND_ASSIGN(ObjectTombstone);
 };
 
+/**
+ * This class describes the format of an object delta stored in the log and
+ * provides methods to construct new ones and interpret ones that have already
+ * been written.
+ *
+ * A delta records bytes appended to the value of an existing object without
+ * rewriting the object (see ObjectManager::appendObject). The object's current
+ * contents are the object entry followed by the data of each of its deltas,
+ * in version order; the version of the last delta is the object's version.
+ * When serialized in the log, a delta consists of a header, the primary key
+ * of the object, and the appended data:
+ *
+ *       +----------------+-----------------+--------------------+
+ *       |  Delta Header  | Primary Key ... | Appended Data ...  |
+ *       +----------------+-----------------+--------------------+
+ *
+ * Deltas do not keep track of which object entry they belong to; the master
+ * holding them does that in memory. During recovery a delta is applied to
+ * the object whose version is one less than its own.
+ */
+class ObjectDelta {
+  public:
+    ObjectDelta(Key& key, uint64_t version, uint32_t timestamp,
+            Buffer& data, uint32_t dataOffset, uint32_t dataLength);
+    explicit ObjectDelta(Buffer& buffer, uint32_t offset = 0,
+            uint32_t length = 0);
+
+    void assembleForLog(Buffer& buffer);
+    void appendDataToBuffer(Buffer& buffer);
+
+    void changeTableId(uint64_t newTableId);
+
+    uint64_t getTableId();
+    const void* getKey();
+    KeyLength getKeyLength();
+    uint64_t getVersion();
+    uint32_t getTimestamp();
+    uint32_t getDataLength();
+
+    bool checkIntegrity();
+    uint32_t getSerializedLength();
+    uint32_t computeChecksum();
+
+  //PRIVATE:
+    /**
+     * This data structure defines the format of an object delta stored in a
+     * master server's log. The primary key and then the appended data follow
+     * it.
+     */
+    class Header {
+      public:
+        /**
+         * Construct a serialized object delta header.
+         *
+         * \param tableId
+         *      The 64-bit identifier for the table the object is in.
+         * \param version
+         *      Version of the object once this delta has been applied.
+         * \param timestamp
+         *      The creation time of this delta, as returned by the WallTime
+         *      module.
+         * \param keyLength
+         *      Length of the object's primary key.
+         */
+        Header(uint64_t tableId,
+               uint64_t version,
+               uint32_t timestamp,
+               KeyLength keyLength)
+            : tableId(tableId),
+              version(version),
+              timestamp(timestamp),
+              keyLength(keyLength),
+              checksum(0)
+        {
+        }
+
+        /// Table to which the object belongs.
+        uint64_t tableId;
+
+        /// Version of the object with this delta applied; one more than the
+        /// version of the object (or delta) it is applied to.
+        uint64_t version;
+
+        /// Delta creation timestamp. WallTime.cc is the clock.
+        uint32_t timestamp;
+
+        /// Length of the primary key following this header.
+        KeyLength keyLength;
+
+        /// CRC32C checksum covering everything but this field, including the
+        /// key and the data.
+        uint32_t checksum;
+
+        /// Following this class will be the key and then the data. This
+        /// member is only here to denote this.
+        char keyAndData[0];
+    } __attribute__((__packed__));
+    static_assert(sizeof(Header) == 26,
+        "Unexpected serialized ObjectDelta size");
+
+    /// Copy of the delta header that is in, or will be written to, the log.
+    Header header;
+
+    /// Buffer holding the key and the data: the caller's key for a new delta,
+    /// or the entire serialized delta when reading one from the log.
+    Buffer* deltaBuffer;
+
+    /// Pointer to the key of a new delta; NULL when reading one from the log.
+    const void* key;
+
+    /// Offset of the key in #deltaBuffer, for a delta read from the log.
+    uint32_t keyOffset;
+
+    /// Offset of the data in #deltaBuffer. For a new delta, #deltaBuffer is
+    /// the caller's data buffer.
+    uint32_t dataOffset;
+
+    /// Number of bytes appended to the object's value by this delta.
+    uint32_t dataLength;
+
+    DISALLOW_COPY_AND_ASSIGN(ObjectDelta);
+};
+
 /**
  *  A log entry to record safeVersion number for recovery.
  *  See \see #safeVersion in Log.h .
@@ -13,11 +13,14 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "Cycles.h"
 #include "Dispatch.h"
 #include "IndexKey.h"
 #include "ObjectFinder.h"
 #include "FailSession.h"
+#include "ThreadId.h"
 
 namespace RAMCloud {
 
@@ -25,29 +28,48 @@ namespace RAMCloud {
  * The implementation of ObjectFinder::TableConfigFetcher that is used for
  * normal execution. This class is not thread-safe; requests to the class
  * must be serialized externally.
+ *
+ * The fetcher keeps its own copy of the configuration of every table it
+ * has fetched, along with the coordinator's version number for it, so that
+ * refetching a table (which ObjectFinder does after flushing it, e.g. when
+ * a tablet it knew about has moved or is being recovered) only transfers
+ * the tablets that have changed since. Each table has its own outstanding
+ * RPC, so all of the threads waiting for a table share one fetch and
+ * threads waiting for different tables don't restart each other's fetches.
  */
 class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
   public:
     explicit RealTableConfigFetcher(Context* context)
         : context(context)
-        , getTableConfigRpc()
-        , tableId()
+        , fetches()
+        , configs()
+        , fromMasters(false)
     {}
 
     /**
-     * This method deletes the currently cached outstanding RPC, restoring
-     * this object to its original pristine state.
+     * This method deletes the currently cached outstanding RPCs and table
+     * configurations, restoring this object to its original pristine state.
      */
     void clear()
     {
-        getTableConfigRpc.destroy();
+        fetches.clear();
+        configs.clear();
+    }
+
+    /**
+     * Send fetches to masters this fetcher already knows about, rather
+     * than to the coordinator, whenever there are any.
+     */
+    void enableMasterFetches()
+    {
+        fromMasters = true;
     }
 
     /**
      * Attempt to retrieve the configuration information of a table from the
      * coordinator.
      *
-     * \param[in] requestedTableId
+     * \param[in] tableId
      *      The id of the table whose tablet configuration is to be retrieved.
      * \param[out] tableMap
      *      Reference to ObjectFinder::tableMap.
@@ -66,83 +88,199 @@ class RealTableConfigFetcher : public ObjectFinder::TableConfigFetcher {
      *      The coordinator has no record of the table.
      */
     bool
-    tryGetTableConfig(uint64_t requestedTableId,
+    tryGetTableConfig(uint64_t tableId,
                       std::map<TabletKey, TabletWithLocator>* tableMap,
                       std::multimap<std::pair<uint64_t, uint8_t>,
                                     IndexletWithLocator>* tableIndexMap)
     {
-        if (!getTableConfigRpc) {
-            tableId = requestedTableId;
-            getTableConfigRpc.construct(context, requestedTableId);
+        CachedConfig& cached = configs[tableId];
+        Tub<GetTableConfigRpc>& rpc = fetches[tableId];
+        if (!rpc) {
+            rpc.construct(context, tableId, cached.epoch, cached.version,
+                          true, fromMasters ? pickMaster(tableId) : "");
         }
-
-        if (!getTableConfigRpc->isReady()) {
+        if (!rpc->isReady()) {
             return false;
         }
 
-        ProtoBuf::TableConfig tableConfig;
+        // The configuration is read in place in the rpc's response, so the
+        // rpc must live until we're done with it.
+        FlatTableConfig tableConfig;
+        bool incremental;
         try {
-            getTableConfigRpc->wait(&tableConfig);
+            incremental = rpc->wait(&tableConfig, &cached.epoch,
+                    &cached.version);
         } catch (TableDoesntExistException& e) {
-            clear();
+            fetches.erase(tableId);
+            configs.erase(tableId);
             throw e;
         }
+        applyChanges(tableId, &cached.tablets, tableConfig, incremental);
 
-        for (const ProtoBuf::TableConfig::Tablet& tablet :
-                tableConfig.tablet()) {
-            Tablet rawTablet(*tableId,
-                             tablet.start_key_hash(),
-                             tablet.end_key_hash(),
-                             ServerId(tablet.server_id()),
-                             Tablet::Status(tablet.state()),
-                             LogPosition(tablet.ctime_log_head_id(),
-                                         tablet.ctime_log_head_offset()));
-
+        for (const std::pair<Tablet, string>& tablet : cached.tablets) {
             tableMap->emplace(
-                    TabletKey{*tableId, tablet.start_key_hash()},
-                    TabletWithLocator(rawTablet, tablet.service_locator()));
+                    TabletKey{tableId, tablet.first.startKeyHash},
+                    TabletWithLocator(tablet.first, tablet.second));
+        }
+
+        for (uint32_t i = 0; i < tableConfig.getIndexletCount(); i++) {
+            const FlatTableConfig::IndexletEntry& indexlet =
+                    tableConfig.getIndexlet(i);
+            IndexletWithLocator indexletWithLocator(
+                    tableConfig.getString(indexlet.startKeyOffset),
+                    indexlet.startKeyLength,
+                    tableConfig.getString(indexlet.endKeyOffset),
+                    indexlet.endKeyLength,
+                    string(tableConfig.getString(indexlet.locatorOffset),
+                           indexlet.locatorLength));
+            tableIndexMap->emplace(
+                    std::make_pair(tableId, indexlet.indexId),
+                    indexletWithLocator);
         }
+        fetches.erase(tableId);
 
-        for (const ProtoBuf::TableConfig::Index& index : tableConfig.index()) {
-            for (const ProtoBuf::TableConfig::Index::Indexlet& indexlet :
-                    index.indexlet()) {
-                const string &startKey = indexlet.start_key();
-                const string &endKey = indexlet.end_key();
-                Indexlet rawIndexlet(startKey.c_str(),
-                                     downCast<KeyLength>(startKey.length()),
-                                     endKey.c_str(),
-                                     downCast<KeyLength>(endKey.length()));
-                IndexletWithLocator indexletWithLocator(
-                        rawIndexlet, indexlet.service_locator());
-
-                tableIndexMap->emplace(
-                        std::make_pair(*tableId, index.index_id()),
-                        indexletWithLocator);
+        // Don't remember tables that don't exist: there's nothing to
+        // save by asking for changes to them.
+        if (cached.tablets.empty())
+            configs.erase(tableId);
+        return true;
+    }
+
+  private:
+    /**
+     * Bring this fetcher's copy of a table's tablets up to date with a
+     * configuration returned by GetTableConfigRpc::wait.
+     *
+     * \param tableId
+     *      The table that \a tablets belong to.
+     * \param tablets
+     *      The tablets as of an earlier version of the configuration;
+     *      modified to be the tablets of the new version.
+     * \param config
+     *      The new configuration.
+     * \param incremental
+     *      True means \a config only contains the tablets that have changed
+     *      since the earlier version; false means it contains all of them.
+     */
+    static void
+    applyChanges(uint64_t tableId, std::vector<std::pair<Tablet, string>>*
+            tablets, const FlatTableConfig& config, bool incremental)
+    {
+        // Tablets always partition the key hash space, so the old tablets
+        // that overlap changed ones are exactly those that no longer exist
+        // in that form.
+        std::vector<std::pair<Tablet, string>> merged;
+        if (incremental) {
+            for (const std::pair<Tablet, string>& tablet : *tablets) {
+                bool replaced = false;
+                for (uint32_t i = 0; i < config.getTabletCount(); i++) {
+                    const FlatTableConfig::TabletEntry& changed =
+                            config.getTablet(i);
+                    if (tablet.first.startKeyHash <= changed.endKeyHash &&
+                            changed.startKeyHash <= tablet.first.endKeyHash) {
+                        replaced = true;
+                        break;
+                    }
+                }
+                if (!replaced)
+                    merged.push_back(tablet);
             }
         }
+        for (uint32_t i = 0; i < config.getTabletCount(); i++) {
+            const FlatTableConfig::TabletEntry& changed = config.getTablet(i);
+            Key::setHashFunction(tableId, Key::HashFunction(changed.keyHash));
+            Tablet rawTablet(tableId,
+                             changed.startKeyHash,
+                             changed.endKeyHash,
+                             ServerId(changed.serverId),
+                             Tablet::Status(changed.state),
+                             LogPosition(changed.ctimeLogHeadId,
+                                         changed.ctimeLogHeadOffset));
+            merged.push_back(std::make_pair(rawTablet,
+                    string(config.getString(changed.locatorOffset),
+                           changed.locatorLength)));
+        }
+        tablets->swap(merged);
+    }
 
-        if (*tableId == requestedTableId) {
-            clear();
-            return true;
-        } else {
-            // The RPC processed above isn't the one we want; initiate a new
-            // RPC for the table we currently request.
-            tableId = requestedTableId;
-            getTableConfigRpc.construct(context, requestedTableId);
-            return false;
+    /**
+     * Choose a master to fetch a table's configuration from: one that owns
+     * a tablet of the table, if this fetcher knows of any, or else one that
+     * owns a tablet of some other table. Any master can answer for any
+     * table, but one that serves the table has probably been asked for its
+     * configuration before. Picking at random spreads the fetches of many
+     * clients over the masters.
+     *
+     * \param tableId
+     *      The table whose configuration is to be fetched.
+     * \return
+     *      The master's service locator, or an empty string if this fetcher
+     *      doesn't know of any masters, in which case the fetch goes to the
+     *      coordinator.
+     */
+    string
+    pickMaster(uint64_t tableId)
+    {
+        vector<const string*> locators;
+        std::unordered_map<uint64_t, CachedConfig>::iterator it =
+                configs.find(tableId);
+        if (it != configs.end()) {
+            for (const std::pair<Tablet, string>& tablet : it->second.tablets) {
+                if (!tablet.second.empty())
+                    locators.push_back(&tablet.second);
+            }
         }
+        if (locators.empty()) {
+            for (const std::pair<const uint64_t, CachedConfig>& config :
+                    configs) {
+                for (const std::pair<Tablet, string>& tablet :
+                        config.second.tablets) {
+                    if (!tablet.second.empty())
+                        locators.push_back(&tablet.second);
+                }
+            }
+        }
+        if (locators.empty())
+            return "";
+        return *locators[generateRandom() % locators.size()];
     }
 
-  private:
+    /**
+     * This fetcher's copy of a table's configuration.
+     */
+    struct CachedConfig {
+        CachedConfig()
+            : tablets()
+            , epoch(0)
+            , version(0)
+        {}
+
+        /// The table's tablets and their service locators as of #version.
+        /// Indexes are always sent in full, so they aren't kept here.
+        std::vector<std::pair<Tablet, string>> tablets;
+
+        /// Returned by the coordinator along with #version; passed back to
+        /// it to ask for what changed since #version.
+        uint64_t epoch;
+
+        /// The coordinator's version number for #tablets; 0 means this
+        /// fetcher doesn't have the table's configuration yet.
+        uint64_t version;
+    };
+
     Context* const context;
 
-    /// The outstanding RPC currently cached by this table config fetcher.
-    Tub<GetTableConfigRpc> getTableConfigRpc;
+    /// The outstanding RPCs currently cached by this table config fetcher,
+    /// indexed by the table whose configuration each is fetching.
+    std::unordered_map<uint64_t, Tub<GetTableConfigRpc>> fetches;
+
+    /// Copies of the configurations of the tables fetched, indexed by
+    /// table id.
+    std::unordered_map<uint64_t, CachedConfig> configs;
 
-    /// The table whose configuration information is being fetched using the
-    /// above RPC. The value in the tub is only defined when there is an
-    /// outstanding RPC.
-    Tub<uint64_t> tableId;
+    /// True means fetches go to masters when possible; see
+    /// ObjectFinder::enableMasterConfigFetches.
+    bool fromMasters;
 
     DISALLOW_COPY_AND_ASSIGN(RealTableConfigFetcher);
 };
@@ -158,7 +296,25 @@ ObjectFinder::ObjectFinder(Context* context)
     , tableConfigFetcher(new RealTableConfigFetcher(context))
     , tableIndexMap()
     , tableMap()
+    , snapshot(new Snapshot())
+    , retiredSnapshots()
+    , readers()
+    , anyReplicaReads(false)
+    , replicaReadTables()
+    , hotReplicas()
+    , hedgedReadTables()
+    , readLatencies()
+{
+}
+
+/**
+ * Destructor.
+ */
+ObjectFinder::~ObjectFinder()
 {
+    foreach (Snapshot* retired, retiredSnapshots)
+        delete retired;
+    delete snapshot.load();
 }
 
 /**
@@ -189,6 +345,58 @@ ObjectFinder::debugString() const
     return result.str();
 }
 
+/**
+ * Hedge reads of a table: once a read has waited longer than 95% of recent
+ * reads from the same server took, send a duplicate to another server that
+ * holds the object (a read replica if it went to the master, the master if
+ * it went to a replica) and take whichever response comes first. This
+ * implies enableReplicaReads, and only helps for hot objects that have
+ * replicas.
+ *
+ * \param tableId
+ *      The table whose reads are hedged.
+ */
+void
+ObjectFinder::enableHedgedReads(uint64_t tableId)
+{
+    SpinLock::Guard guard(mutex);
+    replicaReadTables.insert(tableId);
+    hedgedReadTables.insert(tableId);
+    anyReplicaReads = true;
+}
+
+/**
+ * Fetch table configurations from masters rather than from the coordinator
+ * whenever this client knows of any masters (i.e., for all but its first
+ * table). Masters answer from their copies of the configurations (see
+ * TableConfigCache), which are brought up to date from the coordinator
+ * when a client asks for something newer, so this spreads the fetches of
+ * many clients over the masters, particularly the refetches that follow a
+ * crash. If a master doesn't answer, the fetch goes to the coordinator.
+ */
+void
+ObjectFinder::enableMasterConfigFetches()
+{
+    SpinLock::Guard guard(mutex);
+    tableConfigFetcher->enableMasterFetches();
+}
+
+/**
+ * Let reads of a table go to read replicas of hot objects on masters other
+ * than their owners (see HotKeyReplicator). Such reads may return a value
+ * up to one replica lease period old.
+ *
+ * \param tableId
+ *      The table whose reads may be served by replicas.
+ */
+void
+ObjectFinder::enableReplicaReads(uint64_t tableId)
+{
+    SpinLock::Guard guard(mutex);
+    replicaReadTables.insert(tableId);
+    anyReplicaReads = true;
+}
+
 /**
  * This method is invoked when the caller has reason to believe that
  * the configuration information for particular table is out-of-date.
@@ -227,7 +435,10 @@ ObjectFinder::flushSession(uint64_t tableId, KeyHash keyHash)
     if (tabletWithLocator != NULL) {
         context->transportManager->flushSession(
                 tabletWithLocator->serviceLocator);
-        tabletWithLocator->session = NULL;
+        if (tabletWithLocator->session) {
+            tabletWithLocator->session = NULL;
+            publishSnapshot(guard);
+        }
     }
 }
 
@@ -277,7 +488,16 @@ ObjectFinder::flushImpl(const SpinLock::Guard& guard, uint64_t tableId)
     TabletKey end {tableId, std::numeric_limits<KeyHash>::max()};
     TabletIter lower = tableMap.lower_bound(start);
     TabletIter upper = tableMap.upper_bound(end);
+    bool inSnapshot = false;
+    for (TabletIter it = lower; it != upper; ++it) {
+        if (it->second.tablet.status == Tablet::Status::NORMAL &&
+                it->second.session) {
+            inSnapshot = true;
+        }
+    }
     tableMap.erase(lower, upper);
+    if (inSnapshot)
+        publishSnapshot(guard);
 
     IndexletIter indexLower = tableIndexMap.lower_bound
             (std::make_pair(tableId, 0));
@@ -286,6 +506,30 @@ ObjectFinder::flushImpl(const SpinLock::Guard& guard, uint64_t tableId)
     tableIndexMap.erase(indexLower, indexUpper);
 }
 
+/**
+ * Free the snapshots in #retiredSnapshots if no thread can still be
+ * reading them, i.e. no thread is in lookupInSnapshot. (A thread that
+ * enters lookupInSnapshot after a snapshot was replaced can only load its
+ * replacement, and every count in #readers is incremented before the
+ * pointer is loaded, so seeing each count at zero, one after another, is
+ * enough.) If some thread is inside, the snapshots are kept for a later
+ * call.
+ *
+ * \param guard
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+ObjectFinder::freeRetiredSnapshots(const SpinLock::Guard& guard)
+{
+    foreach (ReaderCount& reader, readers) {
+        if (reader.count.load() != 0)
+            return;
+    }
+    foreach (Snapshot* retired, retiredSnapshots)
+        delete retired;
+    retiredSnapshots.clear();
+}
+
 /**
  * Find information about the tablet containing a key in a given table.
  *
@@ -310,8 +554,16 @@ Transport::SessionRef
 ObjectFinder::lookup(uint64_t tableId, const void* key, KeyLength keyLength)
 {
     // No lock needed: doesn't access ObjectFinder object.
-    KeyHash keyHash = Key::getHash(tableId, key, keyLength);
-    return lookup(tableId, keyHash);
+    // The key is rehashed each time around, since fetching the table's
+    // configuration tells us which function hashes its keys.
+    Transport::SessionRef session;
+    while (true) {
+        session = tryLookup(tableId, key, keyLength);
+        if (session) return session;
+        if (context->dispatch->isDispatchThread()) {
+            context->dispatch->poll();
+        }
+    }
 }
 
 /**
@@ -423,6 +675,48 @@ ObjectFinder::lookupIndexletInCache(const SpinLock::Guard& guard,
     return NULL;
 }
 
+/**
+ * Look for the session of the tablet containing a key hash in #snapshot,
+ * without acquiring any locks.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param keyHash
+ *      A hash value in the space of key hashes.
+ * \param[out] session
+ *      Set to the session for the tablet's master if it was found.
+ * \return
+ *      True means the tablet was found, is NORMAL, and has a session.
+ *      False means the caller must use the slower tryLookupTablet.
+ */
+bool
+ObjectFinder::lookupInSnapshot(uint64_t tableId, KeyHash keyHash,
+        Transport::SessionRef* session)
+{
+    // Announce ourselves before loading the pointer, so that
+    // freeRetiredSnapshots can't free the snapshot underneath us; see
+    // there.
+    ReaderCount& reader = readers[ThreadId::get() % NUM_READER_COUNTS];
+    reader.count.fetch_add(1);
+    const Snapshot* current = snapshot.load();
+
+    bool found = false;
+    TabletKey key{tableId, keyHash};
+    vector<TabletKey>::const_iterator it = std::upper_bound(
+            current->starts.begin(), current->starts.end(), key);
+    if (it != current->starts.begin()) {
+        size_t i = it - current->starts.begin() - 1;
+        if (current->starts[i].tableId == tableId &&
+                keyHash <= current->ends[i]) {
+            *session = current->sessions[i];
+            found = true;
+        }
+    }
+
+    reader.count.fetch_sub(1);
+    return found;
+}
+
 /**
  * Lookup the master for a particular tablet in the local cache of
  * configuration information.
@@ -454,6 +748,154 @@ ObjectFinder::lookupTabletInCache(const SpinLock::Guard& guard,
     return NULL;
 }
 
+/**
+ * Replace #snapshot with a fresh copy of the NORMAL tablets in tableMap
+ * that have sessions. This must be invoked whenever one of those is
+ * removed or changes, so that lookupInSnapshot never returns stale
+ * information.
+ *
+ * \param guard
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+ObjectFinder::publishSnapshot(const SpinLock::Guard& guard)
+{
+    Snapshot* fresh = new Snapshot();
+    for (TabletIter it = tableMap.begin(); it != tableMap.end(); ++it) {
+        const TabletWithLocator& tabletWithLocator = it->second;
+        if (tabletWithLocator.tablet.status != Tablet::Status::NORMAL ||
+                !tabletWithLocator.session) {
+            continue;
+        }
+        fresh->starts.push_back(it->first);
+        fresh->ends.push_back(tabletWithLocator.tablet.endKeyHash);
+        fresh->sessions.push_back(tabletWithLocator.session);
+    }
+    retiredSnapshots.push_back(snapshot.exchange(fresh));
+    freeRetiredSnapshots(guard);
+}
+
+/**
+ * Returns true if enableReplicaReads has been invoked for a table.
+ *
+ * \param tableId
+ *      Identifier for the table.
+ */
+bool
+ObjectFinder::replicaReadsEnabled(uint64_t tableId)
+{
+    if (!anyReplicaReads)
+        return false;
+    SpinLock::Guard guard(mutex);
+    return replicaReadTables.find(tableId) != replicaReadTables.end();
+}
+
+/**
+ * Returns how long a read of a hedged table (see enableHedgedReads) that
+ * was sent to a given server should wait before it is hedged.
+ *
+ * \param serviceLocator
+ *      The server the read was sent to.
+ * \return
+ *      The delay in rdtsc ticks, or 0 if too few reads from the server
+ *      have been timed to tell yet.
+ */
+uint64_t
+ObjectFinder::getHedgeDelay(const string& serviceLocator)
+{
+    SpinLock::Guard guard(mutex);
+    std::unordered_map<string, ReadLatencies>::iterator it =
+            readLatencies.find(serviceLocator);
+    if (it == readLatencies.end())
+        return 0;
+    return it->second.hedgeDelay;
+}
+
+/**
+ * Find the masters that hold the tablets of a table, fetching the table's
+ * configuration from the coordinator if it isn't cached.
+ *
+ * \param tableId
+ *      The table of interest.
+ * \param[out] locators
+ *      The service locators of the masters are appended here, each once.
+ * \param[out] keyHashes
+ *      If non-NULL, the first key hash of one of the tablets of each master
+ *      is appended here, in the same order as \a locators; a request for
+ *      that key hash goes to that master.
+ *
+ * \throw TableDoesntExistException
+ *      The coordinator has no record of the table.
+ */
+void
+ObjectFinder::getTableLocators(uint64_t tableId, vector<string>* locators,
+        vector<KeyHash>* keyHashes)
+{
+    SpinLock::Guard guard(mutex);
+    TabletKey start {tableId, 0U};
+    TabletKey end {tableId, std::numeric_limits<KeyHash>::max()};
+    if (tableMap.lower_bound(start) == tableMap.upper_bound(end)) {
+        while (!tableConfigFetcher->tryGetTableConfig(
+                tableId, &tableMap, &tableIndexMap)) {
+            context->dispatch->poll();
+        }
+    }
+    TabletIter lower = tableMap.lower_bound(start);
+    TabletIter upper = tableMap.upper_bound(end);
+    if (lower == upper)
+        throw TableDoesntExistException(HERE);
+    std::set<string> seen;
+    for (; lower != upper; ++lower) {
+        const string& locator = lower->second.serviceLocator;
+        if (seen.insert(locator).second) {
+            locators->push_back(locator);
+            if (keyHashes != NULL)
+                keyHashes->push_back(lower->second.tablet.startKeyHash);
+        }
+    }
+}
+
+/**
+ * Returns true if reads of the given table are hedged (see
+ * enableHedgedReads).
+ */
+bool
+ObjectFinder::hedgedReadsEnabled(uint64_t tableId)
+{
+    if (!anyReplicaReads)
+        return false;
+    SpinLock::Guard guard(mutex);
+    return hedgedReadTables.find(tableId) != hedgedReadTables.end();
+}
+
+/**
+ * Record how long a read of a hedged table took, for getHedgeDelay.
+ *
+ * \param serviceLocator
+ *      The server the read was sent to.
+ * \param cycles
+ *      The time from sending the read until its response arrived (or a
+ *      hedge's did), in rdtsc ticks.
+ */
+void
+ObjectFinder::recordReadLatency(const string& serviceLocator, uint64_t cycles)
+{
+    SpinLock::Guard guard(mutex);
+    ReadLatencies& latencies = readLatencies[serviceLocator];
+    latencies.samples[latencies.count % LATENCY_SAMPLES] = cycles;
+    latencies.count++;
+    if (latencies.count < LATENCY_SAMPLES || latencies.count % 16 != 0)
+        return;
+
+    // Hedging a read doubles its cost, so never hedge reads that are
+    // merely a bit slower than usual.
+    uint64_t sorted[LATENCY_SAMPLES];
+    std::copy(latencies.samples, latencies.samples + LATENCY_SAMPLES, sorted);
+    uint64_t* p95 = sorted + LATENCY_SAMPLES * 95 / 100;
+    std::nth_element(sorted, p95, sorted + LATENCY_SAMPLES);
+    latencies.hedgeDelay = std::max(*p95, Cycles::fromMicroseconds(10));
+}
+
 /**
  * This method deletes all cached information, restoring the object
  * to its original pristine state. It's used primarily to force cached
@@ -463,10 +905,38 @@ ObjectFinder::lookupTabletInCache(const SpinLock::Guard& guard,
  */
 void ObjectFinder::reset()
 {
-    SpinLock::Guard _(mutex);
+    SpinLock::Guard guard(mutex);
     tableMap.clear();
     tableIndexMap.clear();
     tableConfigFetcher->clear();
+    hotReplicas.clear();
+    readLatencies.clear();
+    publishSnapshot(guard);
+}
+
+/**
+ * Record where the read replicas of a hot object are, as reported by the
+ * object's master in response to a read.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param keyHash
+ *      Hash of the object's primary key.
+ * \param locators
+ *      Service locators of the masters holding replicas of the object;
+ *      empty means it has none (any recorded earlier are forgotten).
+ */
+void
+ObjectFinder::setHotReplicas(uint64_t tableId, KeyHash keyHash,
+        const vector<string>& locators)
+{
+    std::pair<uint64_t, KeyHash> id(tableId, keyHash);
+    SpinLock::Guard guard(mutex);
+    if (locators.empty()) {
+        hotReplicas.erase(id);
+        return;
+    }
+    hotReplicas[id].locators = locators;
 }
 
 /**
@@ -515,17 +985,39 @@ ObjectFinder::tryLookup(uint64_t tableId, const void* key, KeyLength keyLength)
 Transport::SessionRef
 ObjectFinder::tryLookup(uint64_t tableId, KeyHash keyHash)
 {
-    // No lock needed: doesn't access ObjectFinder object.
-    TabletWithLocator* tabletWithLocator = tryLookupTablet(tableId, keyHash);
-    if (tabletWithLocator == NULL) {
-        return Transport::SessionRef();
+    // Fast path: no lock needed.
+    Transport::SessionRef session;
+    if (lookupInSnapshot(tableId, keyHash, &session))
+        return session;
+
+    string serviceLocator;
+    {
+        SpinLock::Guard guard(mutex);
+        TabletWithLocator* tabletWithLocator =
+                tryLookupTablet(guard, tableId, keyHash);
+        if (tabletWithLocator == NULL) {
+            return Transport::SessionRef();
+        }
+        if (tabletWithLocator->session) {
+            return tabletWithLocator->session;
+        }
+        serviceLocator = tabletWithLocator->serviceLocator;
     }
 
-    if (!tabletWithLocator->session) {
-        tabletWithLocator->session = context->transportManager->getSession(
-                tabletWithLocator->serviceLocator);
+    // Opening a session can take a while, so don't hold the lock. The
+    // tablet could be flushed meanwhile; only cache the session if the
+    // tablet is still there.
+    session = context->transportManager->getSession(serviceLocator);
+    SpinLock::Guard guard(mutex);
+    TabletKey key{tableId, keyHash};
+    TabletWithLocator* tabletWithLocator = lookupTabletInCache(guard, &key);
+    if (tabletWithLocator != NULL && !tabletWithLocator->session &&
+            tabletWithLocator->serviceLocator == serviceLocator) {
+        tabletWithLocator->session = session;
+        if (tabletWithLocator->tablet.status == Tablet::Status::NORMAL)
+            publishSnapshot(guard);
     }
-    return tabletWithLocator->session;
+    return session;
 }
 
 /**
@@ -567,6 +1059,38 @@ ObjectFinder::tryLookup(uint64_t tableId, uint8_t indexId,
     return indexletWithLocator->session;
 }
 
+/**
+ * Choose where to send a read of a hot object whose table allows replica
+ * reads: reads rotate among the object's master and the masters holding
+ * its replicas.
+ *
+ * \param tableId
+ *      The table containing the object.
+ * \param keyHash
+ *      Hash of the object's primary key.
+ * \return
+ *      A session to a master holding a replica of the object, or NULL if
+ *      the read should go to the object's master (use tryLookup).
+ */
+Transport::SessionRef
+ObjectFinder::tryLookupReplica(uint64_t tableId, KeyHash keyHash)
+{
+    string locator;
+    {
+        SpinLock::Guard guard(mutex);
+        std::map<std::pair<uint64_t, KeyHash>, HotReplicas>::iterator it =
+                hotReplicas.find(std::make_pair(tableId, keyHash));
+        if (it == hotReplicas.end())
+            return Transport::SessionRef();
+        HotReplicas& replicas = it->second;
+        size_t choice = replicas.next++ % (replicas.locators.size() + 1);
+        if (choice == replicas.locators.size())
+            return Transport::SessionRef();
+        locator = replicas.locators[choice];
+    }
+    return context->transportManager->getSession(locator);
+}
+
 /**
  * Lookup the indexlet containing the given key.
  *
@@ -651,6 +1175,20 @@ TabletWithLocator*
 ObjectFinder::tryLookupTablet(uint64_t tableId, KeyHash keyHash)
 {
     SpinLock::Guard guard(mutex);
+    return tryLookupTablet(guard, tableId, keyHash);
+}
+
+/**
+ * Does all the work of the other tryLookupTablet method (which has the
+ * same parameters and results) for callers that already hold the lock.
+ *
+ * \param guard
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+TabletWithLocator*
+ObjectFinder::tryLookupTablet(const SpinLock::Guard& guard, uint64_t tableId,
+        KeyHash keyHash)
+{
     // First lookup the tablet in our local cache
     TabletKey key{tableId, keyHash};
     TabletWithLocator* tabletWithLocator = lookupTabletInCache(guard, &key);
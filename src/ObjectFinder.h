@@ -17,7 +17,10 @@
 #define RAMCLOUD_OBJECTFINDER_H
 
 #include <boost/function.hpp>
+#include <atomic>
 #include <map>
+#include <set>
+#include <unordered_map>
 
 #include "Common.h"
 #include "CoordinatorClient.h"
@@ -120,6 +123,7 @@ class ObjectFinder {
     class TableConfigFetcher; // forward declaration, see full declaration below
 
     explicit ObjectFinder(Context* context);
+    ~ObjectFinder();
 
     /*
      * Used only for debug purposes. This function created a string
@@ -127,6 +131,9 @@ class ObjectFinder {
      */
     string debugString() const;
 
+    void enableHedgedReads(uint64_t tableId);
+    void enableMasterConfigFetches();
+    void enableReplicaReads(uint64_t tableId);
     void flush(uint64_t tableId);
     void flushSession(uint64_t tableId, KeyHash keyHash);
     void flushSession(uint64_t tableId, uint8_t indexId,
@@ -138,7 +145,15 @@ class ObjectFinder {
 
     TabletWithLocator* lookupTablet(uint64_t tableId, KeyHash keyHash);
 
+    uint64_t getHedgeDelay(const string& serviceLocator);
+    void getTableLocators(uint64_t tableId, vector<string>* locators,
+            vector<KeyHash>* keyHashes = NULL);
+    bool hedgedReadsEnabled(uint64_t tableId);
+    void recordReadLatency(const string& serviceLocator, uint64_t cycles);
+    bool replicaReadsEnabled(uint64_t tableId);
     void reset();
+    void setHotReplicas(uint64_t tableId, KeyHash keyHash,
+                        const vector<string>& locators);
 
     Transport::SessionRef tryLookup(uint64_t tableId, const void* key,
                                     KeyLength keyLength);
@@ -146,12 +161,51 @@ class ObjectFinder {
     Transport::SessionRef tryLookup(uint64_t tableId, uint8_t indexId,
                                     const void* key, KeyLength keyLength,
                                     bool* indexDoesntExist);
+    Transport::SessionRef tryLookupReplica(uint64_t tableId,
+                                           KeyHash keyHash);
 
     void waitForTabletDown(uint64_t tableId);
     void waitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs = ~0lu);
 
   PRIVATE:
+    /**
+     * An immutable copy of the tablets in tableMap that tryLookup can use
+     * without acquiring #mutex: those that are NORMAL and already have a
+     * session. The tablets are kept in sorted arrays, so a lookup is a
+     * binary search over contiguous memory.
+     */
+    struct Snapshot {
+        Snapshot() : starts(), ends(), sessions() {}
+
+        /// Table and first key hash of each tablet, in increasing order.
+        vector<TabletKey> starts;
+
+        /// Last key hash of the tablet in the same position of #starts.
+        vector<KeyHash> ends;
+
+        /// Session for the tablet in the same position of #starts.
+        vector<Transport::SessionRef> sessions;
+    };
+
+    /**
+     * Number of threads currently searching #snapshot, padded to a cache
+     * line of its own. Threads are spread over the #readers array by
+     * thread id, so they don't write to each other's lines.
+     */
+    struct ReaderCount {
+        ReaderCount() : count(0) {}
+        std::atomic<uint32_t> count;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+    };
+
+    /// Number of entries in #readers.
+    static const uint32_t NUM_READER_COUNTS = 64;
+
     void flushImpl(const SpinLock::Guard& guard, uint64_t tableId);
+    void freeRetiredSnapshots(const SpinLock::Guard& guard);
+    bool lookupInSnapshot(uint64_t tableId, KeyHash keyHash,
+                          Transport::SessionRef* session);
+    void publishSnapshot(const SpinLock::Guard& guard);
 
     IndexletWithLocator* lookupIndexletInCache(const SpinLock::Guard& guard,
                                                uint64_t tableId,
@@ -167,6 +221,8 @@ class ObjectFinder {
                                            KeyLength keyLength,
                                            bool* indexDoesntExist);
     TabletWithLocator* tryLookupTablet(uint64_t tableId, KeyHash keyHash);
+    TabletWithLocator* tryLookupTablet(const SpinLock::Guard& guard,
+                                       uint64_t tableId, KeyHash keyHash);
 
     /**
      * Shared RAMCloud information.
@@ -205,6 +261,74 @@ class ObjectFinder {
     std::map<TabletKey, TabletWithLocator> tableMap;
     typedef std::map<TabletKey, TabletWithLocator>::iterator TabletIter;
 
+    /**
+     * The current Snapshot of tableMap; never NULL. It is replaced (by
+     * publishSnapshot, with #mutex held) whenever a tablet it contains is
+     * flushed or a tablet gets a session, and is read without any lock.
+     */
+    std::atomic<Snapshot*> snapshot;
+
+    /**
+     * Snapshots that have been replaced but that threads in
+     * lookupInSnapshot may still be reading. Protected by #mutex.
+     */
+    vector<Snapshot*> retiredSnapshots;
+
+    /// Counts of threads inside lookupInSnapshot; a retired snapshot can
+    /// be freed once every count has been seen to be zero after it was
+    /// replaced.
+    ReaderCount readers[NUM_READER_COUNTS];
+
+    /// Where the read replicas of one hot object are.
+    struct HotReplicas {
+        HotReplicas() : locators(), next(0) {}
+
+        /// Service locators of the masters holding replicas.
+        vector<string> locators;
+
+        /// Used to rotate reads among the master and the replicas.
+        size_t next;
+    };
+
+    /// True once enableReplicaReads has been invoked for any table; lets
+    /// replicaReadsEnabled skip the lock in the common case.
+    std::atomic<bool> anyReplicaReads;
+
+    /// Tables whose reads may be served by replicas. Protected by #mutex.
+    std::set<uint64_t> replicaReadTables;
+
+    /// Hot objects in the tables in #replicaReadTables, indexed by table id
+    /// and key hash. Protected by #mutex.
+    std::map<std::pair<uint64_t, KeyHash>, HotReplicas> hotReplicas;
+
+    /// Tables whose reads are hedged (see enableHedgedReads); a subset of
+    /// #replicaReadTables. Protected by #mutex.
+    std::set<uint64_t> hedgedReadTables;
+
+    /// Number of read latencies kept for each master.
+    static const uint32_t LATENCY_SAMPLES = 64;
+
+    /// Recent latencies of hedged-table reads sent to one master; used to
+    /// pick the delay after which they are hedged.
+    struct ReadLatencies {
+        ReadLatencies() : samples(), count(0), hedgeDelay(0) {}
+
+        /// The most recent LATENCY_SAMPLES latencies, in rdtsc ticks, in
+        /// a ring indexed by #count.
+        uint64_t samples[LATENCY_SAMPLES];
+
+        /// Number of latencies recorded (including ones since overwritten).
+        uint64_t count;
+
+        /// The 95th percentile of #samples, recomputed every so often;
+        /// 0 until the ring has filled, which means don't hedge.
+        uint64_t hedgeDelay;
+    };
+
+    /// Read latencies of masters, indexed by service locator. Protected by
+    /// #mutex.
+    std::unordered_map<string, ReadLatencies> readLatencies;
+
     DISALLOW_COPY_AND_ASSIGN(ObjectFinder);
 };
 
@@ -219,6 +343,9 @@ class ObjectFinder::TableConfigFetcher {
 
     virtual void clear() {};
 
+    /// See ObjectFinder::enableMasterConfigFetches.
+    virtual void enableMasterFetches() {}
+
     virtual bool tryGetTableConfig(
             uint64_t tableId,
             std::map<TabletKey, TabletWithLocator>* tableMap,
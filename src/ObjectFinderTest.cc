@@ -287,6 +287,46 @@ TEST_F(ObjectFinderTest, tryLookup_keyHash) {
     EXPECT_EQ(session, objectFinder->tryLookup(1, 9999lu));
 }
 
+TEST_F(ObjectFinderTest, tryLookup_snapshot) {
+    // Tablets enter the snapshot once they have a session.
+    EXPECT_EQ(0U, objectFinder->snapshot.load()->starts.size());
+    Transport::SessionRef session = objectFinder->tryLookup(2, 10lu);
+    ASSERT_TRUE(session != NULL);
+    ObjectFinder::Snapshot* snapshot = objectFinder->snapshot.load();
+    ASSERT_EQ(1U, snapshot->starts.size());
+    EXPECT_EQ(2U, snapshot->starts[0].tableId);
+    EXPECT_EQ(0U, snapshot->starts[0].keyHash);
+    EXPECT_EQ(1000U, snapshot->ends[0]);
+
+    // Later lookups are served from the snapshot.
+    uint32_t called = refresher->called;
+    EXPECT_EQ(session, objectFinder->tryLookup(2, 1000lu));
+    EXPECT_EQ(called, refresher->called);
+    EXPECT_EQ(snapshot, objectFinder->snapshot.load());
+
+    // Other tablets take the slow path and are added.
+    EXPECT_EQ("mock:host=server6",
+            objectFinder->tryLookup(2, 1001lu)->serviceLocator);
+    EXPECT_EQ(2U, objectFinder->snapshot.load()->starts.size());
+    EXPECT_EQ(0U, objectFinder->retiredSnapshots.size());
+
+    // Flushing the table removes its tablets.
+    objectFinder->flush(2);
+    EXPECT_EQ(0U, objectFinder->snapshot.load()->starts.size());
+}
+
+TEST_F(ObjectFinderTest, freeRetiredSnapshots) {
+    SpinLock::Guard guard(objectFinder->mutex);
+    objectFinder->readers[3].count = 1;
+    objectFinder->publishSnapshot(guard);
+    objectFinder->publishSnapshot(guard);
+    EXPECT_EQ(2U, objectFinder->retiredSnapshots.size());
+
+    objectFinder->readers[3].count = 0;
+    objectFinder->publishSnapshot(guard);
+    EXPECT_EQ(0U, objectFinder->retiredSnapshots.size());
+}
+
 TEST_F(ObjectFinderTest, tryLookup_index_noSuchIndex) {
     bool indexDoesntExist;
     Transport::SessionRef session = objectFinder->tryLookup(2, 99, "abc", 3,
@@ -487,4 +527,61 @@ TEST_F(ObjectFinderTest, flushSession_index) {
     objectFinder->flushSession(99, 0);
 }
 
+TEST_F(ObjectFinderTest, getTableLocators) {
+    vector<string> locators;
+    objectFinder->getTableLocators(2, &locators);
+    ASSERT_EQ(2u, locators.size());
+    EXPECT_EQ("mock:host=server2", locators[0]);
+    EXPECT_EQ("mock:host=server6", locators[1]);
+    EXPECT_EQ(1u, refresher->called);
+
+    // Masters holding several tablets are listed once, and cached
+    // configurations are used.
+    locators.clear();
+    objectFinder->getTableLocators(3, &locators);
+    ASSERT_EQ(1u, locators.size());
+    EXPECT_EQ("mock:host=server3", locators[0]);
+    EXPECT_EQ(1u, refresher->called);
+
+    // Each master also comes with a key hash that leads to it.
+    locators.clear();
+    vector<KeyHash> keyHashes;
+    objectFinder->getTableLocators(2, &locators, &keyHashes);
+    ASSERT_EQ(2u, keyHashes.size());
+    EXPECT_EQ(0u, keyHashes[0]);
+    EXPECT_EQ(1000u, keyHashes[1]);
+
+    EXPECT_THROW(objectFinder->getTableLocators(99, &locators),
+            TableDoesntExistException);
+}
+
+TEST_F(ObjectFinderTest, getHedgeDelay) {
+    uint64_t floor = Cycles::fromMicroseconds(10);
+    EXPECT_EQ(0U, objectFinder->getHedgeDelay("mock:host=server0"));
+    for (uint64_t i = 1; i < ObjectFinder::LATENCY_SAMPLES; i++) {
+        objectFinder->recordReadLatency("mock:host=server0",
+                floor * (i % 8 == 0 ? 100 : 2));
+    }
+    EXPECT_EQ(0U, objectFinder->getHedgeDelay("mock:host=server0"));
+
+    // The ring is full: 8 of the 64 reads were slow, so the slow ones are
+    // beyond the 95th percentile.
+    objectFinder->recordReadLatency("mock:host=server0", floor * 100);
+    EXPECT_EQ(floor * 100, objectFinder->getHedgeDelay("mock:host=server0"));
+    EXPECT_EQ(0U, objectFinder->getHedgeDelay("mock:host=server1"));
+
+    // Fast servers are never hedged sooner than the floor.
+    for (uint64_t i = 0; i < ObjectFinder::LATENCY_SAMPLES; i++)
+        objectFinder->recordReadLatency("mock:host=server1", 1);
+    EXPECT_EQ(floor, objectFinder->getHedgeDelay("mock:host=server1"));
+}
+
+TEST_F(ObjectFinderTest, hedgedReadsEnabled) {
+    EXPECT_FALSE(objectFinder->hedgedReadsEnabled(1));
+    objectFinder->enableHedgedReads(1);
+    EXPECT_TRUE(objectFinder->hedgedReadsEnabled(1));
+    EXPECT_TRUE(objectFinder->replicaReadsEnabled(1));
+    EXPECT_FALSE(objectFinder->hedgedReadsEnabled(2));
+}
+
 }  // namespace RAMCloud
@@ -20,10 +20,12 @@
 #include "EnumerationIterator.h"
 #include "IndexletManager.h"
 #include "LogEntryRelocator.h"
+#include "LogProtector.h"
 #include "ObjectManager.h"
 #include "Object.h"
 #include "PerfStats.h"
 #include "ShortMacros.h"
+#include "TableUsageStats.h"
 #include "RawMetrics.h"
 #include "Tub.h"
 #include "ProtoBuf.h"
@@ -67,6 +69,10 @@ namespace RAMCloud {
  *      Pointer to the master's TxRecoveryManager instance.  This keeps track
  *      of ongoing transaction recoveries; these recoveries may need records
  *      stored in the log.
+ * \param clusterClock
+ *      The master's cluster-time. If non-NULL (and
+ *      master.snapshotRetentionMs is nonzero), superseded versions of
+ *      objects are retained for snapshot reads and stamped with this clock.
  */
 ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                 const ServerConfig* config,
@@ -74,7 +80,8 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
                 MasterTableMetadata* masterTableMetadata,
                 UnackedRpcResults* unackedRpcResults,
                 TransactionManager* transactionManager,
-                TxRecoveryManager* txRecoveryManager)
+                TxRecoveryManager* txRecoveryManager,
+                ClusterClock* clusterClock)
     : context(context)
     , config(config)
     , tabletManager(tabletManager)
@@ -86,20 +93,54 @@ ObjectManager::ObjectManager(Context* context, ServerId* serverId,
     , replicaManager(context, serverId,
                      config->master.numReplicas,
                      config->master.useMinCopysets,
-                     config->master.allowLocalBackup)
+                     config->master.allowLocalBackup,
+                     config->master.replicationWriteBatchSegments,
+                     uint64_t(config->master.replicationCleanerRateLimit)
+                         << 20,
+                     config->master.replicationChain,
+                     config->master.replicationRemoteWrites,
+                     config->master.erasureCodeDataFragments,
+                     config->master.erasureCodeParityFragments)
     , segmentManager(context, config, serverId,
                      allocator, replicaManager, masterTableMetadata)
     , log(context, config, this, &segmentManager, &replicaManager)
-    , objectMap(config->master.hashTableBytes / HashTable::bytesPerCacheLine())
+    , logHealthMonitor(context->dispatch, &log)
+    , writeAdmission()
+    , objectMap(config->master.hashTableBytes / HashTable::bytesPerCacheLine(),
+                config->master.maxHashTableBytes /
+                        HashTable::bytesPerCacheLine(),
+                config->master.inlineSmallValues)
     , anyWrites(false)
     , hashTableBucketLocks()
+    , clusterClock(clusterClock)
+    , historyStart()
+    , hashTableResizeLock("ObjectManager::hashTableResizeLock")
+    , retiredBucketsEpoch(0)
+    , nextRetiredBucketsCheck(0)
     , lockTable(1000, log)
     , mutex("ObjectManager::mutex")
     , tombstoneRemover(this, &objectMap)
     , tombstoneProtectorCount(0)
+    , remoteReadTable()
+    , orderedKeys()
+    , orderedKeysBuildMutex()
 {
     for (size_t i = 0; i < arrayLength(hashTableBucketLocks); i++)
         hashTableBucketLocks[i].setName("hashTableBucketLock");
+    if (config->master.remoteReadSlots > 0) {
+        // This must follow segmentManager's construction, so that the log
+        // memory is the first region registered with the transports.
+        remoteReadTable.construct(context, config->master.remoteReadSlots,
+                allocator.getBaseAddress(), allocator.getTotalBytes());
+    }
+    if (config->master.writeAdmissionUtilization > 0 ||
+            config->master.tableQuotaPercent > 0) {
+        writeAdmission.construct(&segmentManager, &logHealthMonitor,
+                masterTableMetadata,
+                config->master.writeAdmissionUtilization,
+                config->master.logBytes / 100 *
+                        config->master.tableQuotaPercent);
+    }
 }
 
 /**
@@ -145,6 +186,7 @@ ObjectManager::initOnceEnlisted()
 
     if (!config->master.disableLogCleaner)
         log.enableCleaner();
+    logHealthMonitor.start(0);
 }
 
 /**
@@ -233,7 +275,14 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
             if (type != LOG_ENTRY_TYPE_OBJ)
                 continue;
 
-            Object object(candidateBuffer);
+            Buffer objectBuffer;
+            materializeObject(lock, candidateRef, candidateBuffer,
+                    objectBuffer);
+            Object object(objectBuffer);
+            if (object.isExpired(WallTime::secondsTimestamp()))
+                continue;
+            Buffer expanded;
+            object.decompressValue(expanded);
 
             // Candidate may have only partially matching primary key hash.
             if (object.getPKHash() == pKHash) {
@@ -250,6 +299,8 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
                 PerfStats::threadStats.readObjectBytes += valueLength;
                 PerfStats::threadStats.readKeyBytes +=
                         object.getKeysAndValueLength() - valueLength;
+                TableUsageStats::recordRead(object.getTableId(),
+                        valueLength);
             }
         }
 
@@ -262,6 +313,132 @@ ObjectManager::readHashes(const uint64_t tableId, uint32_t reqNumHashes,
     }
 }
 
+/**
+ * Return the changes made to a table since a given position in the log, in
+ * log order, for change data capture. Each change is an object, tombstone or
+ * object delta exactly as it was appended to the log, preceded by a
+ * WireFormat::ReadLogChanges::Change header. The changes refer to log memory
+ * directly; the caller must keep the log from freeing it (RPC handlers are
+ * protected by their epoch).
+ *
+ * Only entries that are durable on backups are returned, and only those
+ * appended through the log head: objects arriving by migration or recovery
+ * go through side logs and are not seen here.
+ *
+ * Readers that fall behind the cleaner lose changes: cleaning or compacting
+ * a segment drops the dead objects and tombstones in it, and moves the rest.
+ * This is detected and reported, at which point the caller has to start
+ * over from a full copy of the table (see TableSnapshot). A reader keeping
+ * up with the head rarely hits this, since the cleaner prefers older
+ * segments.
+ *
+ * \param tableId
+ *      Only return changes to this table.
+ * \param[in,out] position
+ *      Return changes appended at or after this position, such as one
+ *      returned by Log::rollHeadOver(). Updated to the position from which
+ *      to continue.
+ * \param[out] changes
+ *      Changes are appended to this buffer.
+ * \param maxBytes
+ *      Stop before \a changes would grow beyond this many bytes, except that
+ *      at least one change is returned if there is any.
+ * \return
+ *      False if some changes since \a position may have been dropped, in
+ *      which case nothing is returned and \a position is unchanged;
+ *      true otherwise, even if no changes were found.
+ */
+bool
+ObjectManager::readLogChanges(uint64_t tableId, LogPosition* position,
+                Buffer* changes, uint32_t maxBytes)
+{
+    typedef WireFormat::ReadLogChanges::Change Change;
+
+    // Bounds the time spent skipping over entries of other tables.
+    const uint32_t maxEntriesExamined = 10000;
+
+    LogSegmentVector segments;
+    segmentManager.getActiveSegments(position->getSegmentId(), segments);
+
+    // Checking after listing the segments is conservative: a segment
+    // cleaned in between is still in the list (and can't be freed while
+    // this RPC is running), but the changes are reported as lost anyway.
+    if (segmentManager.getCleanedHeadSegmentIdLimit() >
+            position->getSegmentId()) {
+        return false;
+    }
+
+    std::sort(segments.begin(), segments.end(),
+            [](const LogSegment* a, const LogSegment* b) {
+                return a->id < b->id;
+            });
+
+    uint32_t startingSize = changes->size();
+    uint32_t examined = 0;
+    foreach (LogSegment* segment, segments) {
+        if (!segment->appendedAsHead)
+            continue;
+
+        // Once a segment is closed and all of it is durable, readers can
+        // move on to the next one; until then only read what has been
+        // replicated, and stop there so that changes stay in log order.
+        bool closed = segment->closedCommitted.load();
+        SegmentIterator it(*segment);
+        uint32_t limit = segment->getAppendedLength();
+        if (!closed)
+            limit = std::min(limit, segment->syncedLength.load());
+        uint32_t offset = 0;
+        if (segment->id == position->getSegmentId())
+            offset = position->getSegmentOffset();
+        if (offset >= limit) {
+            if (!closed)
+                return true;
+            *position = LogPosition(segment->id + 1, 0);
+            continue;
+        }
+        it.setLimit(limit);
+        it.setOffset(offset);
+
+        for (; !it.isDone(); it.next()) {
+            if (++examined > maxEntriesExamined) {
+                *position = LogPosition(segment->id, it.getOffset());
+                return true;
+            }
+            LogEntryType type = it.getType();
+            if (type != LOG_ENTRY_TYPE_OBJ &&
+                    type != LOG_ENTRY_TYPE_OBJTOMB &&
+                    type != LOG_ENTRY_TYPE_OBJDELTA) {
+                continue;
+            }
+            Buffer entry;
+            it.appendToBuffer(entry);
+            Key key(type, entry);
+            if (key.getTableId() != tableId)
+                continue;
+
+            uint32_t length = entry.size();
+            if (changes->size() != startingSize &&
+                    changes->size() + sizeof(Change) + length > maxBytes) {
+                *position = LogPosition(segment->id, it.getOffset());
+                return true;
+            }
+            Change* change = changes->emplaceAppend<Change>();
+            change->type = downCast<uint8_t>(type);
+            change->length = length;
+            changes->append(&entry);
+        }
+
+        if (!closed) {
+            *position = LogPosition(segment->id, limit);
+            return true;
+        }
+        // Segment identifiers only grow, so this skips just the segment
+        // that was read.
+        *position = LogPosition(segment->id + 1, 0);
+    }
+    return true;
+}
+
 /**
  * This method is used by replaySegment() to prefetch the hash table bucket
  * corresponding to the next entry to be replayed. Doing so avoids a cache
@@ -286,7 +463,7 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
         KeyLength primaryKeyLen = 0;
         const void *primaryKey = prefetchObj.getKey(0, &primaryKeyLen);
 
-        Key key(obj->tableId, primaryKey, primaryKeyLen);
+        Key key(prefetchObj.getTableId(), primaryKey, primaryKeyLen);
         objectMap.prefetchBucket(key.getHash());
     } else if (it->getType() == LOG_ENTRY_TYPE_OBJTOMB) {
         const ObjectTombstone::Header* tomb =
@@ -297,6 +474,332 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
     }
 }
 
+/**
+ * Warm the cache for a batch of upcoming operations on the given keys. This
+ * is a two-stage software prefetch pipeline: first the hash table bucket of
+ * every key is prefetched, and only once all of those loads are in flight
+ * are the buckets scanned, so that the log entries they point to can be
+ * prefetched in turn. By the time the caller works through the batch, both
+ * the dependent cache misses of each lookup (bucket, then log entry) should
+ * have been overlapped with those of the other keys.
+ *
+ * Nothing is read from the log and no state is modified, so it is always
+ * safe (if useless) to prefetch keys that are not subsequently used.
+ *
+ * \param numKeys
+ *      Number of entries in \a keys.
+ * \param keys
+ *      Keys that are about to be looked up.
+ */
+void
+ObjectManager::prefetchObjects(uint32_t numKeys, Key* keys[])
+{
+    Key::computeHashes(numKeys, keys);
+    for (uint32_t i = 0; i < numKeys; i++)
+        objectMap.prefetchBucket(keys[i]->getHash());
+
+    for (uint32_t i = 0; i < numKeys; i++) {
+        HashTableBucketLock lock(*this, *keys[i]);
+        HashTable::Candidates candidates;
+        objectMap.lookup(keys[i]->getHash(), candidates);
+        while (!candidates.isDone()) {
+            // Log references are pointers to the start of the entry.
+            prefetch(reinterpret_cast<const void*>(
+                        candidates.getReference()), PREFETCH_LOG_ENTRY_BYTES);
+            candidates.next();
+        }
+    }
+}
+
+/**
+ * Append data to the value of an object, creating the object if it doesn't
+ * exist. Rather than rewriting the object, only a small ObjectDelta entry
+ * holding the new bytes is added to the log, so the cost of an append is
+ * proportional to the data appended rather than to the size of the object.
+ * Once an object has #MAX_OBJECT_DELTAS deltas, the next append writes the
+ * whole object again as writeObject() would; the cleaner also folds the
+ * deltas back into the object when it relocates it. As with writeObject(),
+ * the change is not durable until syncChanges() is called.
+ *
+ * \param key
+ *      Key of the object to append to.
+ * \param data
+ *      Buffer holding the bytes to append.
+ * \param dataOffset
+ *      Offset within \a data of the first byte to append.
+ * \param dataLength
+ *      Number of bytes to append.
+ * \param rejectRules
+ *      If non-NULL, use the specified rules to perform a conditional append.
+ *      They are checked against the current version of the object.
+ * \param[out] outVersion
+ *      If non-NULL, the version of the object after the append is returned
+ *      here, or the current version if the append was rejected.
+ * \param rpcResult
+ *      If non-NULL, this is appended to the log atomically with the new
+ *      entry; see writeObject().
+ * \param[out] rpcResultPtr
+ *      If non-NULL, pointer to the RpcResult in log is returned.
+ * \return
+ *      STATUS_OK if the data was appended, or any other status that
+ *      writeObject() may return.
+ */
+Status
+ObjectManager::appendObject(Key& key, Buffer* data, uint32_t dataOffset,
+                uint32_t dataLength, RejectRules* rejectRules,
+                uint64_t* outVersion, RpcResult* rpcResult,
+                uint64_t* rpcResultPtr)
+{
+    // If the whole object has to be written, that is done by writeObject()
+    // after releasing the bucket lock, conditional on the state that was
+    // seen here; if some other write slipped in between, start over.
+    RejectRules updateRejectRules;
+    while (1) {
+        Buffer keysAndValue;
+        Tub<Object> newObject;
+        uint64_t currentVersion = VERSION_NONEXISTENT;
+        {
+            objectMap.prefetchBucket(key.getHash());
+            HashTableBucketLock lock(*this, key);
+
+            // If the tablet doesn't exist in the NORMAL state, we must plead
+            // ignorance.
+            TabletManager::Tablet tablet;
+            if (!tabletManager->getTablet(key, &tablet))
+                return STATUS_UNKNOWN_TABLET;
+            if (tablet.state != TabletManager::NORMAL) {
+                if (tablet.state == TabletManager::LOCKED_FOR_MIGRATION)
+                    throw RetryException(HERE, 1000, 2000,
+                            "Tablet is currently locked for migration!");
+                return STATUS_UNKNOWN_TABLET;
+            }
+
+            // If key is locked due to an in-progress transaction, we must
+            // wait.
+            if (lockTable.isLockAcquired(key)) {
+                RAMCLOUD_CLOG(NOTICE, "Retrying because of transaction lock");
+                return STATUS_RETRY;
+            }
+
+            LogEntryType currentType;
+            Buffer currentBuffer;
+            Log::Reference currentReference;
+            if (!lookup(lock, key, currentType, currentBuffer, &currentVersion,
+                        &currentReference) ||
+                    currentType != LOG_ENTRY_TYPE_OBJ ||
+                    Object(currentBuffer).isExpired(
+                            WallTime::secondsTimestamp())) {
+                currentVersion = VERSION_NONEXISTENT;
+            }
+
+            if (rejectRules != NULL) {
+                Status status = rejectOperation(rejectRules, currentVersion);
+                if (status != STATUS_OK) {
+                    if (outVersion != NULL)
+                        *outVersion = currentVersion;
+                    return status;
+                }
+            }
+
+            memset(&updateRejectRules, 0, sizeof(updateRejectRules));
+            if (currentVersion == VERSION_NONEXISTENT) {
+                updateRejectRules.exists = true;
+                newObject.construct(key, data->getRange(dataOffset, dataLength),
+                        dataLength, 0, 0, keysAndValue);
+            } else {
+                std::vector<uint64_t>* chain =
+                        findDeltaChain(lock, currentReference);
+                if (chain != NULL && chain->size() >= MAX_OBJECT_DELTAS) {
+                    updateRejectRules.versionNeGiven = true;
+                    updateRejectRules.givenVersion = currentVersion;
+                    Object currentObject(currentBuffer);
+                    currentObject.appendKeysAndValueToBuffer(keysAndValue);
+                    keysAndValue.append(data, dataOffset, dataLength);
+                    newObject.construct(key.getTableId(), 0, 0, keysAndValue);
+                    newObject->setExpiry(currentObject.getExpiry());
+                }
+            }
+
+            if (!newObject) {
+                ObjectDelta delta(key, currentVersion + 1,
+                        WallTime::secondsTimestamp(), *data, dataOffset,
+                        dataLength);
+
+                // As in writeObject(), the delta and the rpcResult must be
+                // written atomically.
+                Log::AppendVector appends[2];
+                delta.assembleForLog(appends[0].buffer);
+                appends[0].type = LOG_ENTRY_TYPE_OBJDELTA;
+                if (!log.hasSpaceFor(appends[0].buffer.size())) {
+                    throw RetryException(HERE, 1000, 2000,
+                            "Memory capacity exceeded");
+                }
+
+                // The version must be set before the rpcResult, which
+                // holds the response, is assembled.
+                if (outVersion != NULL)
+                    *outVersion = delta.getVersion();
+                if (rpcResult) {
+                    rpcResult->assembleForLog(appends[1].buffer);
+                    appends[1].type = LOG_ENTRY_TYPE_RPCRESULT;
+                }
+
+                if (!log.append(appends, rpcResult ? 2 : 1)) {
+                    // The log is out of space. Tell the client to retry and
+                    // hope that the cleaner makes space soon.
+                    throw RetryException(HERE, 1000, 2000,
+                            "Must wait for cleaner");
+                }
+
+                invalidateRemoteRead(lock, key);
+                objectMap.invalidateInlineValue(key.getHash(),
+                        currentReference.toInteger());
+                objectDeltas[lock.getIndex()].chains[
+                        currentReference.toInteger()].push_back(
+                        appends[0].reference.toInteger());
+                if (rpcResult && rpcResultPtr)
+                    *rpcResultPtr = appends[1].reference.toInteger();
+
+                // The version the delta applies to lives on only as part
+                // of the new one, so snapshots from before now can't see it.
+                recordVersion(lock, key, VersionHistory::NOT_RETAINED);
+
+                tabletManager->incrementWriteCount(key);
+                ++PerfStats::threadStats.writeCount;
+                PerfStats::threadStats.writeObjectBytes += dataLength;
+                TableUsageStats::recordWrite(tablet.tableId, dataLength);
+                TableStats::increment(masterTableMetadata,
+                        tablet.tableId,
+                        appends[0].buffer.size() + appends[1].buffer.size(),
+                        rpcResult ? 2 : 1);
+                TEST_LOG("delta: %u bytes, version %lu",
+                        appends[0].buffer.size(), delta.getVersion());
+                return STATUS_OK;
+            }
+        }
+
+        Status status = writeObject(*newObject, &updateRejectRules,
+                outVersion, NULL, rpcResult, rpcResultPtr);
+        if (status != STATUS_WRONG_VERSION && status != STATUS_OBJECT_EXISTS)
+            return status;
+        TEST_LOG("retry after concurrent write");
+    }
+}
+
+/**
+ * Fetch an object from the log, given the reference to it in the hash table,
+ * the same way lookup() would: if data has been appended to the object, the
+ * buffer describes the object with its deltas applied (see
+ * materializeObject()).
+ *
+ * \param reference
+ *      Reference to an object entry, as found in #objectMap.
+ * \param[out] buffer
+ *      The object is appended to this buffer.
+ */
+void
+ObjectManager::getObjectEntry(Log::Reference reference, Buffer& buffer)
+{
+    Buffer entryBuffer;
+    LogEntryType type = log.getEntry(reference, entryBuffer);
+    Key key(type, entryBuffer);
+    HashTableBucketLock lock(*this, key);
+    materializeObject(lock, reference, entryBuffer, buffer);
+}
+
+/**
+ * Replace a range of bytes in the value of an existing object, or append to
+ * it, leaving its keys and the rest of its value as they are. A new version
+ * of the object is written exactly as writeObject() would, so the change is
+ * not durable until syncChanges() is called. The object's keys don't change,
+ * so no index entries need to be updated.
+ *
+ * \param key
+ *      Key of the object to patch.
+ * \param offset
+ *      Offset within the current value of the first byte to replace. Must be
+ *      no greater than the value's length; if equal, the data is appended.
+ *      The value grows if the data extends beyond its current end.
+ * \param data
+ *      Buffer holding the new bytes.
+ * \param dataOffset
+ *      Offset within \a data of the first new byte.
+ * \param dataLength
+ *      Number of new bytes.
+ * \param rejectRules
+ *      If non-NULL, use the specified rules to perform a conditional patch.
+ *      They are checked against the version being patched.
+ * \param[out] outVersion
+ *      If non-NULL, the version of the new object is returned here, or the
+ *      current version if the patch was rejected, as in writeObject().
+ * \param rpcResult
+ *      If non-NULL, this is appended to the log atomically with the new
+ *      object; see writeObject().
+ * \param[out] rpcResultPtr
+ *      If non-NULL, pointer to the RpcResult in log is returned.
+ * \return
+ *      STATUS_OK if the object was patched, STATUS_OBJECT_DOESNT_EXIST if
+ *      there is no object to patch, STATUS_INVALID_PARAMETER if \a offset is
+ *      beyond the end of its value, or any other status that readObject() or
+ *      writeObject() may return.
+ */
+Status
+ObjectManager::patchObject(Key& key, uint32_t offset, Buffer* data,
+                uint32_t dataOffset, uint32_t dataLength,
+                RejectRules* rejectRules, uint64_t* outVersion,
+                RpcResult* rpcResult, uint64_t* rpcResultPtr)
+{
+    // The splice is done outside the bucket lock, so the write is made
+    // conditional on the version that was read; if some other write
+    // slipped in between, start over with the newer version.
+    RejectRules updateRejectRules;
+    memset(&updateRejectRules, 0, sizeof(updateRejectRules));
+    updateRejectRules.versionNeGiven = true;
+    while (1) {
+        Buffer keysAndValue;
+        uint64_t version = VERSION_NONEXISTENT;
+        Status status = readObject(key, &keysAndValue, rejectRules, &version);
+        if (status != STATUS_OK) {
+            if (outVersion != NULL)
+                *outVersion = version;
+            return status;
+        }
+
+        Object current(key.getTableId(), 0, 0, keysAndValue);
+        uint32_t valueOffset;
+        current.getValueOffset(&valueOffset);
+        uint32_t valueLength = current.getValueLength();
+        if (offset > valueLength) {
+            if (outVersion != NULL)
+                *outVersion = version;
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        // Keys and the untouched parts of the value are appended by
+        // reference; only the new bytes are copied.
+        Buffer newKeysAndValue;
+        uint32_t patchStart = valueOffset + offset;
+        newKeysAndValue.append(&keysAndValue, 0, patchStart);
+        newKeysAndValue.append(data, dataOffset, dataLength);
+        if (offset + dataLength < valueLength) {
+            newKeysAndValue.append(&keysAndValue, patchStart + dataLength,
+                    valueLength - offset - dataLength);
+        }
+
+        Object newObject(key.getTableId(), 0, 0, newKeysAndValue);
+        updateRejectRules.givenVersion = version;
+        status = writeObject(newObject, &updateRejectRules, outVersion, NULL,
+                rpcResult, rpcResultPtr);
+        if (status != STATUS_WRONG_VERSION) {
+            if (status == STATUS_OK) {
+                TEST_LOG("patched %u bytes at offset %u", dataLength, offset);
+            }
+            return status;
+        }
+        TEST_LOG("retry after version mismatch");
+    }
+}
+
 /**
  * Read an object previously written to this ObjectManager.
  *
@@ -322,15 +825,50 @@ ObjectManager::prefetchHashTableBucket(SegmentIterator* it)
 Status
 ObjectManager::readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
-                bool valueOnly)
+                bool valueOnly, RemoteReadTable::Hint* remoteReadHint)
 {
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
+    uint64_t remoteReadEpoch = 0;
+    if (remoteReadHint != NULL && remoteReadTable)
+        remoteReadEpoch = remoteReadTable->getEpoch();
 
     // If the tablet doesn't exist in the NORMAL state, we must plead ignorance.
     if (!tabletManager->checkAndIncrementReadCount(key))
         return STATUS_UNKNOWN_TABLET;
 
+    // Small objects may be copied next to their hash table bucket, in which
+    // case the log needn't be touched. Remote read hints need the log entry.
+    HashTable::InlineValue* inlineValue = NULL;
+    if (remoteReadHint == NULL)
+        inlineValue = objectMap.findInlineValue(key.getHash());
+    if (inlineValue != NULL && inlineValue->matches(key)) {
+        if (outVersion != NULL)
+            *outVersion = inlineValue->version;
+        if (rejectRules != NULL) {
+            Status status = rejectOperation(rejectRules, inlineValue->version);
+            if (status != STATUS_OK)
+                return status;
+        }
+        uint32_t keysLength = sizeof32(KeyCount) +
+                sizeof32(CumulativeKeyLength) + inlineValue->keyLength;
+        if (!valueOnly) {
+            KeyCount keyCount = 1;
+            CumulativeKeyLength keyLength = inlineValue->keyLength;
+            outBuffer->appendCopy(&keyCount, sizeof32(keyCount));
+            outBuffer->appendCopy(&keyLength, sizeof32(keyLength));
+            outBuffer->appendCopy(inlineValue->key, keyLength);
+        }
+        outBuffer->appendCopy(inlineValue->value, inlineValue->valueLength);
+        ++PerfStats::threadStats.readCount;
+        PerfStats::threadStats.readObjectBytes += inlineValue->valueLength;
+        PerfStats::threadStats.readKeyBytes += keysLength;
+        TableUsageStats::recordRead(key.getTableId(),
+                inlineValue->valueLength);
+        TEST_LOG("read inline value");
+        return STATUS_OK;
+    }
+
     Buffer buffer;
     LogEntryType type;
     uint64_t version;
@@ -339,6 +877,11 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
     if (!found || type != LOG_ENTRY_TYPE_OBJ)
         return STATUS_OBJECT_DOESNT_EXIST;
 
+    // Expired objects are left for the cleaner to reclaim.
+    Object object(buffer);
+    if (object.isExpired(WallTime::secondsTimestamp()))
+        return STATUS_OBJECT_DOESNT_EXIST;
+
     if (outVersion != NULL)
         *outVersion = version;
 
@@ -351,7 +894,21 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
     // Ensure the object being read is replicated durably.
     log.syncTo(reference);
 
-    Object object(buffer);
+    // Objects with deltas aren't contiguous in the log, so they can't be
+    // read remotely, and remote readers can't check expiry times or expand
+    // compressed values.
+    if (remoteReadHint != NULL && remoteReadTable &&
+            findDeltaChain(lock, reference) == NULL &&
+            object.getExpiry() == 0 && !object.isCompressed()) {
+        remoteReadTable->publish(key, version, buffer, remoteReadEpoch,
+                remoteReadHint);
+    }
+
+    Buffer expanded;
+    object.decompressValue(expanded);
+    if (inlineValue != NULL)
+        saveInlineValue(lock, *inlineValue, key, object, reference, version);
+
     if (valueOnly) {
         object.appendValueToBuffer(outBuffer);
     } else {
@@ -362,10 +919,199 @@ ObjectManager::readObject(Key& key, Buffer* outBuffer,
     PerfStats::threadStats.readObjectBytes += valueLength;
     PerfStats::threadStats.readKeyBytes +=
             object.getKeysAndValueLength() - valueLength;
+    TableUsageStats::recordRead(key.getTableId(), valueLength);
 
     return STATUS_OK;
 }
 
+/**
+ * Read the value of an object in a tablet that this master is still
+ * recovering (see OnDemandRecovery). The caller must know that every
+ * segment that may hold the key has already been replayed. Unlike
+ * readObject this doesn't wait for the object to be replicated: replayed
+ * objects sit in side logs that are only committed once recovery ends, but
+ * the crashed master's backups already hold them durably.
+ *
+ * \param key
+ *      Key of the object being read.
+ * \param outBuffer
+ *      Buffer to which the value of the object is appended, if found.
+ * \param rejectRules
+ *      If non-NULL, use the specified rules to perform a conditional read.
+ * \param outVersion
+ *      If non-NULL and the object is found, the version is returned here.
+ * \return
+ *      STATUS_OK if the object was read, STATUS_UNKNOWN_TABLET if its tablet
+ *      isn't being recovered here, or the status from a failed lookup or
+ *      from the reject rules.
+ */
+Status
+ObjectManager::readRecoveringObject(Key& key, Buffer* outBuffer,
+                RejectRules* rejectRules, uint64_t* outVersion)
+{
+    HashTableBucketLock lock(*this, key);
+    TabletManager::Tablet tablet;
+    if (!tabletManager->getTablet(key, &tablet) ||
+            tablet.state != TabletManager::NOT_READY) {
+        return STATUS_UNKNOWN_TABLET;
+    }
+
+    Buffer buffer;
+    LogEntryType type;
+    uint64_t version;
+    bool found = lookup(lock, key, type, buffer, &version, NULL);
+    if (!found || type != LOG_ENTRY_TYPE_OBJ)
+        return STATUS_OBJECT_DOESNT_EXIST;
+
+    Object object(buffer);
+    if (object.isExpired(WallTime::secondsTimestamp()))
+        return STATUS_OBJECT_DOESNT_EXIST;
+
+    if (outVersion != NULL)
+        *outVersion = version;
+
+    if (rejectRules != NULL) {
+        Status status = rejectOperation(rejectRules, version);
+        if (status != STATUS_OK)
+            return status;
+    }
+
+    Buffer expanded;
+    object.decompressValue(expanded);
+    object.appendValueToBuffer(outBuffer);
+    ++PerfStats::threadStats.readCount;
+    PerfStats::threadStats.readObjectBytes += object.getValueLength();
+    return STATUS_OK;
+}
+
+/**
+ * Read an object as it was at a given cluster-time, from the versions kept
+ * in #versionHistory if it has changed since. This master's cluster-time is
+ * advanced to the snapshot time, so that changes made from now on are
+ * stamped after it and can't creep into the snapshot.
+ *
+ * \param key
+ *      Key of the object being read.
+ * \param snapshotTime
+ *      Encoded cluster-time of the snapshot.
+ * \param outBuffer
+ *      Buffer to populate with the object, if it existed at that time.
+ * \param outVersion
+ *      If non-NULL and the object is found, its version is returned here.
+ * \param valueOnly
+ *      If true, then only the value portion of the object is written to
+ *      outBuffer. Otherwise, keys and value are written to outBuffer.
+ * \return
+ *      STATUS_OK if the object was read. STATUS_SNAPSHOT_TOO_OLD if this
+ *      master doesn't retain the version the snapshot would see,
+ *      STATUS_RETRY if a transaction that may commit before the snapshot
+ *      time has the object locked, or the same failures as readObject().
+ */
+Status
+ObjectManager::readSnapshotObject(Key& key, uint64_t snapshotTime,
+                Buffer* outBuffer, uint64_t* outVersion, bool valueOnly)
+{
+    objectMap.prefetchBucket(key.getHash());
+    HashTableBucketLock lock(*this, key);
+
+    if (!tabletManager->checkAndIncrementReadCount(key))
+        return STATUS_UNKNOWN_TABLET;
+    if (isSnapshotTooOld(snapshotTime))
+        return STATUS_SNAPSHOT_TOO_OLD;
+
+    // A prepared transaction may still commit at a time before the
+    // snapshot; the snapshot can't be read until it is decided.
+    if (lockTable.isLockAcquired(key))
+        return STATUS_RETRY;
+    clusterClock->updateClock(ClusterTime(snapshotTime));
+
+    Buffer buffer;
+    uint64_t reference;
+    if (versionHistory[lock.getIndex()].find(key.getHash(), snapshotTime,
+            &reference)) {
+        if (reference == VersionHistory::NO_OBJECT)
+            return STATUS_OBJECT_DOESNT_EXIST;
+        if (reference == VersionHistory::NOT_RETAINED)
+            return STATUS_SNAPSHOT_TOO_OLD;
+        log.getEntry(Log::Reference(reference), buffer);
+
+        // Versions are recorded by key hash; another key with the same
+        // hash could have taken this one's place.
+        Key oldKey(LOG_ENTRY_TYPE_OBJ, buffer);
+        if (oldKey != key)
+            return STATUS_SNAPSHOT_TOO_OLD;
+        TEST_LOG("read retained version");
+    } else {
+        LogEntryType type;
+        Log::Reference currentReference;
+        if (!lookup(lock, key, type, buffer, NULL, &currentReference) ||
+                type != LOG_ENTRY_TYPE_OBJ) {
+            return STATUS_OBJECT_DOESNT_EXIST;
+        }
+        log.syncTo(currentReference);
+    }
+
+    Object object(buffer);
+    if (object.isExpired(WallTime::secondsTimestamp()))
+        return STATUS_OBJECT_DOESNT_EXIST;
+    if (outVersion != NULL)
+        *outVersion = object.getVersion();
+
+    Buffer expanded;
+    object.decompressValue(expanded);
+    if (valueOnly) {
+        object.appendValueToBuffer(outBuffer);
+    } else {
+        object.appendKeysAndValueToBuffer(*outBuffer);
+    }
+    ++PerfStats::threadStats.readCount;
+    PerfStats::threadStats.readObjectBytes += object.getValueLength();
+    TableUsageStats::recordRead(key.getTableId(), object.getValueLength());
+    return STATUS_OK;
+}
+
+/**
+ * Read a batch of objects previously written to this ObjectManager. This
+ * is equivalent to calling readObject() once for each key, but the hash
+ * table buckets and log entries for all of the keys are prefetched up front
+ * (see prefetchObjects()) so that their cache misses overlap rather than
+ * being taken one after another.
+ *
+ * \param numObjects
+ *      Number of objects to read; each of the following arrays must have at
+ *      least this many elements. See #MAX_PREFETCH_BATCH.
+ * \param keys
+ *      Keys of the objects being read.
+ * \param rejectRules
+ *      If non-NULL, rejectRules[i] is used to perform a conditional read of
+ *      keys[i]. See readObject().
+ * \param outBuffers
+ *      The value of object i, if found, is appended to outBuffers[i].
+ * \param outVersions
+ *      If non-NULL, the version of object i is returned in outVersions[i],
+ *      as in readObject().
+ * \param[out] outStatuses
+ *      The status of each read is returned here; see readObject().
+ * \param valueOnly
+ *      If true, then only the value portion of each object is written to
+ *      its buffer. Otherwise, keys and value are written.
+ */
+void
+ObjectManager::readObjects(uint32_t numObjects, Key* keys[],
+                RejectRules* rejectRules, Buffer* outBuffers,
+                uint64_t* outVersions, Status* outStatuses,
+                bool valueOnly)
+{
+    prefetchObjects(numObjects, keys);
+
+    for (uint32_t i = 0; i < numObjects; i++) {
+        outStatuses[i] = readObject(*keys[i], &outBuffers[i],
+                (rejectRules != NULL) ? &rejectRules[i] : NULL,
+                (outVersions != NULL) ? &outVersions[i] : NULL,
+                valueOnly);
+    }
+}
+
 /**
  * Remove an object previously written to this ObjectManager.
  *
@@ -482,8 +1228,10 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
                           tablet.tableId,
                           appends[0].buffer.size() + appends[1].buffer.size(),
                           rpcResult ? 2 : 1);
+    TableUsageStats::recordWrite(tablet.tableId, 0);
     segmentManager.raiseSafeVersion(object.getVersion() + 1);
-    log.free(reference);
+    if (!retainVersion(lock, key, &reference))
+        freeObject(lock, reference, &log);
     remove(lock, key);
     return STATUS_OK;
 }
@@ -496,6 +1244,7 @@ ObjectManager::removeObject(Key& key, RejectRules* rejectRules,
 void
 ObjectManager::removeOrphanedObjects()
 {
+    invalidateRemoteReads();
     for (uint64_t i = 0; i < objectMap.getNumBuckets(); i++) {
         HashTableBucketLock lock(*this, i);
         CleanupParameters params = { this , &lock };
@@ -503,6 +1252,128 @@ ObjectManager::removeOrphanedObjects()
     }
 }
 
+/**
+ * Invoke a callback on the key of every live object in a table. Used to
+ * rebuild in-memory structures (such as in-memory indexlets) from objects
+ * that were recovered or migrated into a table.
+ *
+ * \param tableId
+ *      Identifier of the table whose objects are to be visited.
+ * \param callback
+ *      Invoked once for each object, with the object's key and \a cookie.
+ *      It is called with a hash table bucket lock held, so it must not call
+ *      back into this ObjectManager.
+ * \param cookie
+ *      Opaque value passed to \a callback.
+ */
+void
+ObjectManager::forEachObjectInTable(uint64_t tableId, ObjectCallback callback,
+        void* cookie)
+{
+    TableScanParameters params = { this, tableId, callback, cookie };
+    for (uint64_t i = 0; i < objectMap.getNumBuckets(); i++) {
+        HashTableBucketLock lock(*this, i);
+        objectMap.forEachInBucket(visitObjectInTable, &params, i);
+    }
+}
+
+/**
+ * Prevent clients from reading any object remotely (at least until they
+ * read it again with an RPC). This must be invoked whenever this master
+ * stops serving a tablet, after the tablet's state has changed.
+ */
+void
+ObjectManager::invalidateRemoteReads()
+{
+    if (remoteReadTable)
+        remoteReadTable->clear();
+}
+
+/**
+ * Return the objects of a table whose primary keys fall in a range, in key
+ * order. Only objects in tablets that this master owns in the NORMAL state
+ * are returned. The first scan of a table gathers the keys of all of its
+ * objects into #orderedKeys; after that, only the keys in the range are
+ * visited.
+ *
+ * \param tableId
+ *      Identifier of the table.
+ * \param startKey
+ *      Smallest primary key to return (see OrderedKeyIndex::getKeys for how
+ *      keys are ordered).
+ * \param startKeyLength
+ *      Length of \a startKey in bytes; 0 means the range starts with the
+ *      smallest key in the table.
+ * \param endKey
+ *      Objects with this key or larger ones are not returned.
+ * \param endKeyLength
+ *      Length of \a endKey in bytes; 0 means the range has no end.
+ * \param maxObjects
+ *      Return at most this many objects.
+ * \param maxBytes
+ *      Stop adding objects once \a response would grow larger than this
+ *      (at least one object is returned if there is one).
+ * \param[out] response
+ *      Each object is appended here as a WireFormat::Scan::Object header
+ *      followed by the object's keys and value.
+ * \param[out] numObjects
+ *      Set to the number of objects appended to \a response.
+ * \return
+ *      True means the range may hold more objects after the last one
+ *      returned; the scan can be continued from the key that follows it.
+ */
+bool
+ObjectManager::scanObjects(uint64_t tableId, const void* startKey,
+        KeyLength startKeyLength, const void* endKey, KeyLength endKeyLength,
+        uint32_t maxObjects, uint32_t maxBytes, Buffer* response,
+        uint32_t* numObjects)
+{
+    *numObjects = 0;
+    if (!orderedKeys.isReady(tableId))
+        buildOrderedKeys(tableId);
+
+    // Keys are copied out of the index a batch at a time, since the index
+    // can't be locked while objects are read (writers lock a bucket and
+    // then the index).
+    string nextKey(static_cast<const char*>(startKey), startKeyLength);
+    vector<string> keys;
+    bool more = true;
+    while (more && *numObjects < maxObjects) {
+        keys.clear();
+        more = orderedKeys.getKeys(tableId, nextKey.data(),
+                downCast<KeyLength>(nextKey.size()), endKey, endKeyLength,
+                std::min(maxObjects - *numObjects, 100U), &keys);
+        for (size_t i = 0; i < keys.size(); i++) {
+            Key key(tableId, keys[i].data(),
+                    downCast<KeyLength>(keys[i].size()));
+            uint32_t start = response->size();
+            WireFormat::Scan::Object* header =
+                    response->emplaceAppend<WireFormat::Scan::Object>();
+            uint64_t version;
+            Status status = readObject(key, response, NULL, &version);
+            if (status != STATUS_OK) {
+                // Stale keys in the index, and objects in tablets that
+                // aren't ours, are skipped.
+                response->truncate(start);
+                continue;
+            }
+            if (response->size() > maxBytes && *numObjects > 0) {
+                response->truncate(start);
+                return true;
+            }
+            header->version = version;
+            header->length = response->size() - start - sizeof32(*header);
+            (*numObjects)++;
+        }
+        if (more) {
+            // The smallest key that comes after the last one returned.
+            nextKey = keys.back();
+            nextKey.push_back('\0');
+        }
+    }
+    return more;
+}
+
 /**
  * This class is used by replaySegment to increment the number of times that
  * that method returns, regardless of the return path. That counter is used
@@ -536,6 +1407,59 @@ class DelayedIncrementer {
     DISALLOW_COPY_AND_ASSIGN(DelayedIncrementer);
 };
 
+/**
+ * Decide whether the entry an iterator points at should be replayed by
+ * this partition. See ReplayPartition.
+ *
+ * \param it
+ *      Iterator positioned at the entry in question.
+ * \param type
+ *      Type of the entry at \a it.
+ * \return
+ *      True if replaySegment() should replay the entry for this partition.
+ */
+bool
+ObjectManager::ReplayPartition::owns(SegmentIterator& it,
+                                     LogEntryType type) const
+{
+    KeyHash keyHash;
+    if (type == LOG_ENTRY_TYPE_OBJ) {
+        const Object::Header* header =
+            it.getContiguous<Object::Header>(NULL, 0);
+        Object object(header, it.getLength());
+        KeyLength keyLength = 0;
+        const void* keyString = object.getKey(0, &keyLength);
+        keyHash = Key(object.getTableId(), keyString, keyLength).getHash();
+    } else if (type == LOG_ENTRY_TYPE_OBJTOMB ||
+               type == LOG_ENTRY_TYPE_OBJDELTA) {
+        Buffer buffer;
+        it.appendToBuffer(buffer);
+        keyHash = Key(type, buffer).getHash();
+    } else {
+        return ownsOtherEntries;
+    }
+
+    uint64_t unused;
+    uint64_t bucket = HashTable::findBucketIndex(numBuckets, keyHash, &unused);
+    return bucket >= firstBucket && bucket < endBucket;
+}
+
+/**
+ * Make sure that version numbers allocated from now on for new objects
+ * are at least \a minimum. This is needed when objects arrive with
+ * versions that weren't allocated by this master (e.g. bulk-loaded
+ * objects), so that recreating one of them after it is removed can't
+ * reuse a version number.
+ *
+ * \param minimum
+ *      Lowest version number that may be allocated afterwards.
+ */
+void
+ObjectManager::raiseSafeVersion(uint64_t minimum)
+{
+    segmentManager.raiseSafeVersion(minimum);
+}
+
 /**
  * A wrapper function for replaySegment
  *
@@ -578,10 +1502,16 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it)
  * \param nextNodeIdMap
  *       A unordered map that keeps track of the nextNodeId in
  *       each indexlet table.
+ * \param partition
+ *       If not NULL, only replay the entries of the segment that belong to
+ *       this partition. Used to replay one segment from several threads at
+ *       once, each with its own \a sideLog and \a nextNodeIdMap; see
+ *       ParallelSegmentReplay.
  */
 void
 ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
-    std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap)
+    std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap,
+    const ReplayPartition* partition)
 {
     uint64_t startReplicationTicks = metrics->master.replicaManagerTicks;
     uint64_t startReplicationPostingWriteRpcTicks =
@@ -592,6 +1522,14 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
         DIE("Must hold a TombstoneProtector when replaying segments");
     }
 
+    // The objects replayed here come without the versions they superseded
+    // on the master they were written to, so earlier snapshots can't be
+    // served.
+    if (clusterClock != NULL) {
+        historyStart.updateClock(ClusterTime(
+                clusterClock->getTime().getEncoded() + 1));
+    }
+
     // Metrics can be very expense (they're atomic operations), so we aggregate
     // as much as we can in local variables and update the counters once at the
     // end of this method.
@@ -608,11 +1546,18 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
     uint64_t safeVersionRecoveryCount = 0;
     uint64_t safeVersionNonRecoveryCount = 0;
 
+    // Two-stage software pipeline: entries are prefetched several entries
+    // ahead of the replay, so by the time prefetcher reaches one its key
+    // can be hashed without a cache miss; the hash table bucket is then
+    // prefetched two entries before it is needed.
+    SegmentReadAhead readAhead(it);
     SegmentIterator prefetcher = it;
     prefetcher.next();
+    prefetcher.next();
 
     uint64_t bytesIterated = 0;
     for (; expect_true(!it.isDone()); it.next()) {
+        readAhead.advance();
         prefetchHashTableBucket(&prefetcher);
         prefetcher.next();
 
@@ -620,10 +1565,16 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
         if (bytesIterated > 50000) {
             bytesIterated = 0;
-            replicaManager.proceed();
+            // When replaying in parallel, one partition driving
+            // replication is enough.
+            if (!partition || partition->ownsOtherEntries)
+                replicaManager.proceed();
         }
         bytesIterated += it.getLength();
 
+        if (partition && !partition->owns(it, type))
+            continue;
+
         recoverySegmentEntryCount++;
         recoverySegmentEntryBytes += it.getLength();
 
@@ -638,13 +1589,13 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
             KeyLength primaryKeyLen = 0;
             const void *primaryKey = replayObj.getKey(0, &primaryKeyLen);
 
-            Key key(recoveryObj->tableId, primaryKey, primaryKeyLen);
+            Key key(replayObj.getTableId(), primaryKey, primaryKeyLen);
 
             // If table is an BTree table,i.e., tableId exists in
             // nextNodeIdMap, update nextNodeId of its table.
             if (nextNodeIdMap) {
                 std::unordered_map<uint64_t, uint64_t>::iterator iter
-                    = nextNodeIdMap->find(recoveryObj->tableId);
+                    = nextNodeIdMap->find(replayObj.getTableId());
                 if (iter != nextNodeIdMap->end()) {
                     const uint64_t *bTreeKey =
                         reinterpret_cast<const uint64_t*>(primaryKey);
@@ -656,12 +1607,11 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
             bool checksumIsValid = ({
                 CycleCounter<uint64_t> c(&verifyChecksumTicks);
-                Object::computeChecksum(recoveryObj, it.getLength()) ==
-                    recoveryObj->checksum;
+                replayObj.checkIntegrity();
             });
             if (expect_false(!checksumIsValid)) {
                 LOG(WARNING, "bad object checksum! key: %s, version: %lu",
-                    key.toString().c_str(), recoveryObj->version);
+                    key.toString().c_str(), replayObj.getVersion());
                 // JIRA Issue: RAM-673:
                 // Should throw and try another segment replica.
             }
@@ -688,7 +1638,7 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                 }
 
                 // Throw new object away if the hash table version is newer
-                if (recoveryObj->version <= currentVersion) {
+                if (replayObj.getVersion() <= currentVersion) {
                     objectDiscardCount++;
                     continue;
                 }
@@ -710,26 +1660,44 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
                     // Track the death of the object
                     liveObjectBytes -= currentBuffer.size();
-                    sideLog->free(currentReference);
+                    freeObject(lock, currentReference, sideLog);
                     liveObjectCount--;
                 }
             }
 
             // Add the incoming object or tombstone to our log and update
-            // the hash table to refer to it.
+            // the hash table to refer to it. An object written without a
+            // checksum was protected by the content checksum of its
+            // segment; if our segments don't have one, it gets a checksum
+            // of its own now.
             Log::Reference newObjReference;
             {
                 CycleCounter<uint64_t> _(&segmentAppendTicks);
-                sideLog->append(LOG_ENTRY_TYPE_OBJ,
-                                recoveryObj,
-                                it.getLength(),
-                                &newObjReference);
+                if (expect_false(replayObj.hasDeferredChecksum() &&
+                        !config->master.deferObjectChecksums)) {
+                    Buffer checksummed;
+                    replayObj.setDeferredChecksum(false);
+                    replayObj.assembleForLog(checksummed);
+                    sideLog->append(LOG_ENTRY_TYPE_OBJ, checksummed,
+                                    &newObjReference);
+                } else {
+                    sideLog->append(LOG_ENTRY_TYPE_OBJ,
+                                    recoveryObj,
+                                    it.getLength(),
+                                    &newObjReference);
+                }
                 TableStats::increment(masterTableMetadata,
                                       key.getTableId(),
                                       it.getLength(),
                                       1);
             }
             replace(lock, key, newObjReference);
+            orderedKeys.insert(key);
+
+            // Deltas for this version of the object may have been replayed
+            // before it.
+            if (expect_false(!objectDeltas[lock.getIndex()].pending.empty()))
+                replayObjectDeltas(lock, key, NULL, sideLog);
 
             // JIRA Issue: RAM-674:
             // If master runs out of space during recovery, this master
@@ -821,13 +1789,14 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
 
                     // Track the death of the object
                     liveObjectBytes -= currentBuffer.size();
-                    sideLog->free(currentReference);
+                    freeObject(lock, currentReference, sideLog);
                     liveObjectCount--;
 
                     // Optimization to avoid appending two tombstones with the
                     // same version for the same key to the log.
                     if (recoverVersion == currentVersion) {
                         replace(lock, key, newTombReference);
+                        recordReplayedTombstone(lock, key);
                         continue;
                     }
 
@@ -863,6 +1832,28 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                     buffer.size(),
                     1);
             replace(lock, key, newTombReference);
+            recordReplayedTombstone(lock, key);
+        } else if (type == LOG_ENTRY_TYPE_OBJDELTA) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            Key key(type, buffer);
+
+            ObjectDelta delta(buffer);
+            bool checksumIsValid = ({
+                CycleCounter<uint64_t> c(&verifyChecksumTicks);
+                delta.checkIntegrity();
+            });
+            if (expect_false(!checksumIsValid)) {
+                LOG(WARNING, "bad object delta checksum! key: %s, "
+                    "version: %lu", key.toString().c_str(),
+                    delta.getVersion());
+                // JIRA Issue: RAM-673:
+                // Should throw and try another segment replica.
+            }
+
+            HashTableBucketLock lock(*this, key);
+            objectAppendCount += replayObjectDeltas(lock, key, &buffer,
+                                                    sideLog);
         } else if (type == LOG_ENTRY_TYPE_SAFEVERSION) {
             // LOG_ENTRY_TYPE_SAFEVERSION is duplicated to all the
             // partitions in BackupService::buildRecoverySegments()
@@ -1047,6 +2038,45 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
                 transactionManager->markOpDeleted(opTomb.header.clientLeaseId,
                                                   opTomb.header.rpcId);
             }
+        } else if (type == LOG_ENTRY_TYPE_PREPTOMBBATCH) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+
+            PreparedOpTombstoneBatch batch(buffer);
+            uint64_t leaseId = batch.header.clientLeaseId;
+
+            if (expect_false(!batch.checkIntegrity())) {
+                LOG(WARNING, "bad preparedOpTombstoneBatch checksum! "
+                             "leaseId: %lu, count: %u",
+                             leaseId, batch.header.count);
+            }
+
+            // Each record is handled like a PreparedOpTombstone; the batch
+            // is needed if any of its PreparedOps was (or may yet be)
+            // recovered.
+            bool needed = false;
+            foreach (PreparedOpTombstoneBatch::Record& record,
+                     batch.records) {
+                if (transactionManager->isOpDeleted(leaseId, record.rpcId) ||
+                    transactionManager->getOp(leaseId, record.rpcId)) {
+                    needed = true;
+                    transactionManager->removeOp(leaseId, record.rpcId);
+                }
+                transactionManager->markOpDeleted(leaseId, record.rpcId);
+            }
+
+            if (needed && batch.header.count > 0) {
+                // write to log (with lazy backup flush)
+                Log::Reference newReference;
+                CycleCounter<uint64_t> _(&segmentAppendTicks);
+                sideLog->append(LOG_ENTRY_TYPE_PREPTOMBBATCH,
+                                buffer,
+                                &newReference);
+                TableStats::increment(masterTableMetadata,
+                        batch.records[0].tableId,
+                        buffer.size(),
+                        1);
+            }
         } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
             Buffer buffer;
             it.appendToBuffer(buffer);
@@ -1119,6 +2149,10 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
     metrics->master.tombstoneDiscardCount += tombstoneDiscardCount;
     metrics->master.safeVersionRecoveryCount += safeVersionRecoveryCount;
     metrics->master.safeVersionNonRecoveryCount += safeVersionNonRecoveryCount;
+
+    // Replay inserts entries much faster than normal writes, so migrate
+    // enough buckets to keep up with what was just added.
+    growHashTable(recoverySegmentEntryCount);
 }
 
 /**
@@ -1127,11 +2161,18 @@ ObjectManager::replaySegment(SideLog* sideLog, SegmentIterator& it,
  * the change is committed to stable storage. Prior to invoking this, no
  * guarantees are made about the consistency of backup and master views of the
  * log since the previous syncChanges() operation.
+ *
+ * \param minReplicas
+ *      Return once the changes are on this many backups rather than on all
+ *      of them (see Log::sync). 0 means the changes are left in memory until
+ *      a later sync; the default waits for all of the replicas.
  */
 void
-ObjectManager::syncChanges()
+ObjectManager::syncChanges(uint32_t minReplicas)
 {
-    log.sync();
+    if (minReplicas > 0)
+        log.sync(minReplicas);
+    growHashTable(HASH_TABLE_BUCKETS_PER_SYNC);
 }
 
 /**
@@ -1180,11 +2221,58 @@ Status
 ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
                 uint64_t* outVersion, Buffer* removedObjBuffer,
                 RpcResult* rpcResult, uint64_t* rpcResultPtr)
+{
+    uint64_t unusedRpcResultPtr;
+    return writeObject(newObject, rejectRules, outVersion, removedObjBuffer,
+            rpcResult ? 1 : 0, &rpcResult,
+            rpcResultPtr ? rpcResultPtr : &unusedRpcResultPtr);
+}
+
+/**
+ * Write an object as the other writeObject() does, along with any number of
+ * linearizability records. This is used when one write completes several
+ * RPCs at once (see MasterService::incrementObject()).
+ *
+ * \param newObject
+ *      The new object to be written to the log; see the other writeObject().
+ * \param rejectRules
+ *      Specifies conditions under which the write should be aborted with an
+ *      error. May be NULL if no special reject conditions are desired.
+ * \param[out] outVersion
+ *      If non-NULL, the version number of the new object is returned here;
+ *      see the other writeObject().
+ * \param[out] removedObjBuffer
+ *      If non-NULL, pointer to the buffer in log for the object being removed
+ *      is returned.
+ * \param numRpcResults
+ *      Number of elements in \a rpcResults and \a rpcResultPtrs.
+ * \param rpcResults
+ *      These are appended to the log atomically with the other record(s)
+ *      for the write.
+ * \param[out] rpcResultPtrs
+ *      Pointers to the RpcResults in the log are returned here.
+ * \return
+ *      STATUS_OK if the object was written. Otherwise, for example,
+ *      STATUS_UKNOWN_TABLE may be returned.
+ */
+Status
+ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
+                uint64_t* outVersion, Buffer* removedObjBuffer,
+                uint32_t numRpcResults, RpcResult* rpcResults[],
+                uint64_t rpcResultPtrs[])
 {
     uint16_t keyLength = 0;
     const void *keyString = newObject.getKey(0, &keyLength);
     Key key(newObject.getTableId(), keyString, keyLength);
 
+    // Writes that the cleaner can't keep up with, or that would take a
+    // table past its quota, are turned away before any work is done for
+    // them.
+    if (writeAdmission) {
+        writeAdmission->admit(newObject.getTableId(),
+                newObject.getSerializedLength());
+    }
+
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
 
@@ -1211,6 +2299,10 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     Log::Reference currentReference;
     uint64_t currentVersion = VERSION_NONEXISTENT;
 
+    // Version that the reject rules see: an expired object doesn't exist
+    // for them, though the new version must still be higher than its.
+    uint64_t visibleVersion = VERSION_NONEXISTENT;
+
     HashTable::Candidates currentHashTableEntry;
 
     if (lookup(lock, key, currentType, currentBuffer, 0,
@@ -1221,6 +2313,8 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
         } else {
             Object currentObject(currentBuffer);
             currentVersion = currentObject.getVersion();
+            if (!currentObject.isExpired(WallTime::secondsTimestamp()))
+                visibleVersion = currentVersion;
             // Return a pointer to the buffer in log for the object being
             // overwritten.
             if (removedObjBuffer != NULL) {
@@ -1230,10 +2324,10 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     }
 
     if (rejectRules != NULL) {
-        Status status = rejectOperation(rejectRules, currentVersion);
+        Status status = rejectOperation(rejectRules, visibleVersion);
         if (status != STATUS_OK) {
             if (outVersion != NULL)
-                *outVersion = currentVersion;
+                *outVersion = visibleVersion;
             return status;
         }
     }
@@ -1267,9 +2361,9 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     // for the old deleted version. Both cases lead to consistency problems.
     // The same argument holds for linearizability records; the linearizability
     // record should exist if and only if new object is written.
-    Log::AppendVector appends[2 + (rpcResult ? 1 : 0)];
+    Log::AppendVector appends[2 + numRpcResults];
 
-    newObject.assembleForLog(appends[0].buffer);
+    assembleObjectForLog(newObject, appends[0].buffer);
     appends[0].type = LOG_ENTRY_TYPE_OBJ;
 
     // Note: only check for enough space for the object (tombstones
@@ -1281,32 +2375,46 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     if (tombstone) {
         tombstone->assembleForLog(appends[1].buffer);
         appends[1].type = LOG_ENTRY_TYPE_OBJTOMB;
+
+        // If the new object lands in the same segment as the version it
+        // replaces, the tombstone can be left out: the two versions are
+        // freed together when that segment is cleaned, a backup replica
+        // that holds the new version also holds the old one, and replay
+        // keeps whichever version is higher. This saves the log space
+        // (and cleaner copying) of a tombstone, which repeats the whole
+        // key, for every hot key that is overwritten in quick succession.
+        if (config->master.omitSameSegmentTombstones)
+            appends[1].omitFromSegmentId = tombstone->getSegmentId();
     }
 
     if (outVersion != NULL)
         *outVersion = newObject.getVersion();
 
     int rpcResultIndex = 1 + (tombstone ? 1 : 0);
-    if (rpcResult) {
-        rpcResult->assembleForLog(appends[rpcResultIndex].buffer);
-        appends[rpcResultIndex].type = LOG_ENTRY_TYPE_RPCRESULT;
+    for (uint32_t i = 0; i < numRpcResults; i++) {
+        rpcResults[i]->assembleForLog(appends[rpcResultIndex + i].buffer);
+        appends[rpcResultIndex + i].type = LOG_ENTRY_TYPE_RPCRESULT;
     }
 
-    if (!log.append(appends, (tombstone ? 2 : 1) + (rpcResult ? 1 : 0))) {
+    if (!log.append(appends, rpcResultIndex + numRpcResults)) {
         // The log is out of space. Tell the client to retry and hope
         // that the cleaner makes space soon.
         throw RetryException(HERE, 1000, 2000, "Must wait for cleaner");
     }
 
+    invalidateRemoteRead(lock, key);
     if (tombstone) {
         currentHashTableEntry.setReference(appends[0].reference.toInteger());
-        log.free(currentReference);
+        if (!retainVersion(lock, key, &currentReference))
+            freeObject(lock, currentReference, &log);
     } else {
         objectMap.insert(key.getHash(), appends[0].reference.toInteger());
+        orderedKeys.insert(key);
+        retainVersion(lock, key, NULL);
     }
 
-    if (rpcResult && rpcResultPtr)
-        *rpcResultPtr = appends[rpcResultIndex].reference.toInteger();
+    for (uint32_t i = 0; i < numRpcResults; i++)
+        rpcResultPtrs[i] = appends[rpcResultIndex + i].reference.toInteger();
 
     tabletManager->incrementWriteCount(key);
     ++PerfStats::threadStats.writeCount;
@@ -1314,28 +2422,32 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     PerfStats::threadStats.writeObjectBytes += valueLength;
     PerfStats::threadStats.writeKeyBytes +=
             newObject.getKeysAndValueLength() - valueLength;
+    TableUsageStats::recordWrite(key.getTableId(), valueLength);
 
     TEST_LOG("object: %u bytes, version %lu",
         appends[0].buffer.size(), newObject.getVersion());
 
-    if (tombstone) {
+    if (tombstone && appends[1].omitted) {
+        TEST_LOG("tombstone omitted, version %lu",
+            tombstone->getObjectVersion());
+    } else if (tombstone) {
         TEST_LOG("tombstone: %u bytes, version %lu",
             appends[1].buffer.size(), tombstone->getObjectVersion());
     }
-    if (rpcResult) {
+    for (uint32_t i = 0; i < numRpcResults; i++) {
         TEST_LOG("rpcResult: %u bytes",
-            appends[rpcResultIndex].buffer.size());
+            appends[rpcResultIndex + i].buffer.size());
     }
 
     {
         uint64_t byteCount = appends[0].buffer.size();
         uint64_t recordCount = 1;
-        if (tombstone) {
+        if (tombstone && !appends[1].omitted) {
             byteCount += appends[1].buffer.size();
             recordCount += 1;
         }
-        if (rpcResult) {
-            byteCount += appends[rpcResultIndex].buffer.size();
+        for (uint32_t i = 0; i < numRpcResults; i++) {
+            byteCount += appends[rpcResultIndex + i].buffer.size();
             recordCount += 1;
         }
 
@@ -1348,6 +2460,62 @@ ObjectManager::writeObject(Object& newObject, RejectRules* rejectRules,
     return STATUS_OK;
 }
 
+/**
+ * Write a batch of objects. This is equivalent to calling writeObject() once
+ * for each object, except that the hash table buckets and current log
+ * entries of all the objects' keys are prefetched up front (see
+ * prefetchObjects()). As with writeObject(), the writes are not durable
+ * until syncChanges() is called.
+ *
+ * \param numObjects
+ *      Number of objects to write; each of the following arrays must have
+ *      at least this many elements. See #MAX_PREFETCH_BATCH.
+ * \param objects
+ *      The objects to write.
+ * \param rejectRules
+ *      If non-NULL, rejectRules[i] is used to perform a conditional write of
+ *      objects[i]. See writeObject().
+ * \param outVersions
+ *      If non-NULL, the version of object i is returned in outVersions[i],
+ *      as in writeObject().
+ * \param removedObjBuffers
+ *      If non-NULL, removedObjBuffers[i] is filled in with the object that
+ *      objects[i] replaced, if any. See writeObject().
+ * \param[out] outStatuses
+ *      The status of each write is returned here; see writeObject(). Writes
+ *      that writeObject() would have aborted with a RetryException are
+ *      reported as STATUS_RETRY and do not affect the rest of the batch.
+ */
+void
+ObjectManager::writeObjects(uint32_t numObjects, Object* objects[],
+                RejectRules* rejectRules, uint64_t* outVersions,
+                Buffer* removedObjBuffers, Status* outStatuses)
+{
+    Tub<Key> keys[numObjects];
+    Key* keyPointers[numObjects];
+    for (uint32_t i = 0; i < numObjects; i++) {
+        uint16_t keyLength = 0;
+        const void *keyString = objects[i]->getKey(0, &keyLength);
+        keys[i].construct(objects[i]->getTableId(), keyString, keyLength);
+        keyPointers[i] = keys[i].get();
+    }
+
+    prefetchObjects(numObjects, keyPointers);
+
+    for (uint32_t i = 0; i < numObjects; i++) {
+        try {
+            outStatuses[i] = writeObject(*objects[i],
+                    (rejectRules != NULL) ? &rejectRules[i] : NULL,
+                    (outVersions != NULL) ? &outVersions[i] : NULL,
+                    (removedObjBuffers != NULL) ?
+                        &removedObjBuffers[i] : NULL);
+        }
+        catch (RetryException& e) {
+            outStatuses[i] = STATUS_RETRY;
+        }
+    }
+}
+
 /**
  * Write the RpcResult log-entry indicating that transaction prepare has failed
  * and transition should be aborted.
@@ -1436,6 +2604,11 @@ ObjectManager::writeRpcResultOnly(RpcResult* rpcResult, uint64_t* rpcResultPtr)
  *      linearizability.
  * \param[out] rpcResultPtr
  *      The pointer to the RpcResult in log is returned.
+ * \param snapshotTime
+ *      If nonzero, the transaction runs with snapshot isolation and read
+ *      from a snapshot taken at this (encoded) cluster-time: the vote is to
+ *      abort if the object has changed since then, or if changes since
+ *      then can't be told any more (see readSnapshotObject()).
  * \return
  *      STATUS_OK if the object was written. Otherwise, for example,
  *      STATUS_UNKNOWN_TABLE may be returned.
@@ -1443,7 +2616,8 @@ ObjectManager::writeRpcResultOnly(RpcResult* rpcResult, uint64_t* rpcResultPtr)
 Status
 ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
                 uint64_t* newOpPtr, bool* isCommitVote,
-                RpcResult* rpcResult, uint64_t* rpcResultPtr)
+                RpcResult* rpcResult, uint64_t* rpcResultPtr,
+                uint64_t snapshotTime)
 {
     *isCommitVote = false;
     if (!anyWrites) {
@@ -1484,10 +2658,30 @@ ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
         RAMCLOUD_LOG(DEBUG,
                 "TxPrepare fail. Key: %.*s, object is already locked",
                 keyLength, reinterpret_cast<const char*>(keyString));
+        ++PerfStats::threadStats.txLockConflictAborts;
+        writePrepareFail(rpcResult, rpcResultPtr);
+        return STATUS_OK;
+    }
+
+    // Under snapshot isolation only write-write conflicts abort: the first
+    // transaction to commit a change to the object after the snapshot wins.
+    if (snapshotTime != 0 && (isSnapshotTooOld(snapshotTime) ||
+            versionHistory[lock.getIndex()].getLastChange(key.getHash()) >
+            snapshotTime)) {
+        RAMCLOUD_LOG(DEBUG,
+                "TxPrepare fail. Key: %.*s, object changed after snapshot "
+                "%lu", keyLength, reinterpret_cast<const char*>(keyString),
+                snapshotTime);
+        ++PerfStats::threadStats.txLockConflictAborts;
         writePrepareFail(rpcResult, rpcResultPtr);
         return STATUS_OK;
     }
 
+    // The transaction will commit after its snapshot, so this master's
+    // clock (returned in the prepare response) mustn't be behind it.
+    if (snapshotTime != 0)
+        clusterClock->updateClock(ClusterTime(snapshotTime));
+
     LogEntryType currentType = LOG_ENTRY_TYPE_INVALID;
     Buffer currentBuffer;
     Log::Reference currentReference;
@@ -1515,6 +2709,7 @@ ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
                     keyLength, reinterpret_cast<const char*>(keyString),
                     statusToString(status),
                     rejectRules->givenVersion, currentVersion);
+            ++PerfStats::threadStats.txRejectRuleAborts;
             writePrepareFail(rpcResult, rpcResultPtr);
             return STATUS_OK;
         }
@@ -1591,51 +2786,29 @@ ObjectManager::prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
 }
 
 /**
- * Process prepare request for ReadOnly operation.
- * It just checks the lock of the corresponding object and compares version
- * (by rejectRules). It writes no data on the log.
+ * Validate one object read by a read-only transaction: check that the
+ * version the transaction read is still the current one, and that no
+ * transaction in progress has the object locked. Nothing is locked or
+ * written to the log, so a read-only transaction never holds up writers,
+ * and the validation doesn't need to be recovered if this server crashes.
  *
- * \param newOp
- *      The preparedOperation to be written to the log. It does not have
- *      a valid version and timestamp. So this function will update the version,
- *      timestamp and the checksum of the object before writing to the log.
+ * \param key
+ *      Key of the object that was read.
  * \param rejectRules
- *      Specifies conditions under which the prepare should be aborted with an
- *      error. May be NULL if no special reject conditions are desired.
- *
+ *      Conditions under which the transaction must abort; the version the
+ *      transaction read is passed here, with versionNeGiven set.
  * \param[out] isCommitVote
- *      Vote result after prepare is returned.
+ *      Set to true if the read is still valid, or false if the transaction
+ *      must abort.
  * \return
- *      STATUS_OK if we can decide commit-vote or abort-vote.
- *      STATUS_UNKNOWN_TABLE may be returned.
+ *      STATUS_OK if a vote was decided, or STATUS_UNKNOWN_TABLET if the
+ *      object isn't in a tablet owned by this server.
  */
 Status
-ObjectManager::prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
+ObjectManager::validateReadOnly(Key& key, RejectRules* rejectRules,
                 bool* isCommitVote)
 {
     *isCommitVote = false;
-    if (!anyWrites) {
-        // This is the first write; use this as a trigger to update the
-        // cluster configuration information and open a session with each
-        // backup, so it won't slow down recovery benchmarks.  This is a
-        // temporary hack, and needs to be replaced with a more robust
-        // approach to updating cluster configuration information.
-        anyWrites = true;
-
-        // Empty coordinator locator means we're in test mode, so skip this.
-        if (!context->coordinatorSession->getLocation().empty()) {
-            ProtoBuf::ServerList backups;
-            CoordinatorClient::getBackupList(context, &backups);
-            TransportManager& transportManager =
-                *context->transportManager;
-            foreach(auto& backup, backups.server())
-                transportManager.getSession(backup.service_locator());
-        }
-    }
-
-    uint16_t keyLength = 0;
-    const void *keyString = newOp.object.getKey(0, &keyLength);
-    Key key(newOp.object.getTableId(), keyString, keyLength);
 
     objectMap.prefetchBucket(key.getHash());
     HashTableBucketLock lock(*this, key);
@@ -1647,11 +2820,14 @@ ObjectManager::prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
     if (tablet.state != TabletManager::NORMAL)
         return STATUS_UNKNOWN_TABLET;
 
-    // If the key is already locked, abort.
+    // A transaction that has prepared a change to the object may still
+    // commit; the read can't be serialized with respect to it.
     if (lockTable.isLockAcquired(key)) {
         RAMCLOUD_LOG(DEBUG,
                 "TxPrepare(readOnly) fail. Key: %.*s, object is already locked",
-                keyLength, reinterpret_cast<const char*>(keyString));
+                key.getStringKeyLength(),
+                reinterpret_cast<const char*>(key.getStringKey()));
+        ++PerfStats::threadStats.txLockConflictAborts;
         return STATUS_OK;
     }
 
@@ -1659,31 +2835,27 @@ ObjectManager::prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
     Buffer currentBuffer;
     Log::Reference currentReference;
     uint64_t currentVersion = VERSION_NONEXISTENT;
-
-    HashTable::Candidates currentHashTableEntry;
-
-    if (lookup(lock, key, currentType, currentBuffer, 0,
-               &currentReference, &currentHashTableEntry)) {
+    if (lookup(lock, key, currentType, currentBuffer, 0, &currentReference)) {
         if (currentType == LOG_ENTRY_TYPE_OBJTOMB) {
-            removeIfTombstone(currentReference.toInteger(), this);
+            CleanupParameters params = { this , &lock };
+            removeIfTombstone(currentReference.toInteger(), &params);
         } else {
             Object currentObject(currentBuffer);
             currentVersion = currentObject.getVersion();
         }
     }
 
-    if (rejectRules != NULL) {
-        Status status = rejectOperation(rejectRules, currentVersion);
-        if (status != STATUS_OK) {
-            RAMCLOUD_LOG(DEBUG, "TxPrepare(readOnly) fail. Type: %d Key: %.*s, "
-                "RejectRule outcome: %s rejectRule.givenVersion %lu "
-                "currentVersion %lu",
-                    newOp.header.type,
-                    keyLength, reinterpret_cast<const char*>(keyString),
-                    statusToString(status),
-                    rejectRules->givenVersion, currentVersion);
-            return STATUS_OK;
-        }
+    Status status = rejectOperation(rejectRules, currentVersion);
+    if (status != STATUS_OK) {
+        RAMCLOUD_LOG(DEBUG, "TxPrepare(readOnly) fail. Key: %.*s, "
+            "RejectRule outcome: %s rejectRule.givenVersion %lu "
+            "currentVersion %lu",
+            key.getStringKeyLength(),
+            reinterpret_cast<const char*>(key.getStringKey()),
+            statusToString(status), rejectRules->givenVersion,
+            currentVersion);
+        ++PerfStats::threadStats.txRejectRuleAborts;
+        return STATUS_OK;
     }
     *isCommitVote = true;
     return STATUS_OK;
@@ -1842,6 +3014,10 @@ ObjectManager::commitRead(PreparedOp& op, Log::Reference& refToPreparedOp)
  * \param[out] removedObjBuffer
  *      If non-NULL, pointer to the buffer in log for the object being removed
  *      is returned.
+ * \param commitTime
+ *      Encoded cluster-time the transaction committed at, which the removal
+ *      is recorded with for snapshot reads; 0 means this master's
+ *      cluster-time.
  * \return
  *      Returns STATUS_OK if the remove succeeded. Other status values indicate
  *      different failures (tablet doesn't exist, reject rules applied, etc).
@@ -1849,7 +3025,8 @@ ObjectManager::commitRead(PreparedOp& op, Log::Reference& refToPreparedOp)
 Status
 ObjectManager::commitRemove(PreparedOp& op,
                             Log::Reference& refToPreparedOp,
-                            Buffer* removedObjBuffer)
+                            Buffer* removedObjBuffer,
+                            uint64_t commitTime)
 {
     uint16_t keyLength = 0;
     const void *keyString = op.object.getKey(0, &keyLength);
@@ -1928,9 +3105,11 @@ ObjectManager::commitRemove(PreparedOp& op,
                               byteCount,
                               recordCount);
     }
+    TableUsageStats::recordWrite(tombstone.getTableId(), 0);
 
     segmentManager.raiseSafeVersion(object.getVersion() + 1);
-    log.free(reference);
+    if (!retainVersion(lock, key, &reference, commitTime))
+        freeObject(lock, reference, &log);
     log.free(refToPreparedOp);
     transactionManager->removeOp(op.header.clientId, op.header.rpcId);
     remove(lock, key);
@@ -1948,6 +3127,10 @@ ObjectManager::commitRemove(PreparedOp& op,
  * \param[out] removedObjBuffer
  *      If non-NULL, pointer to the buffer in log for the object being removed
  *      is returned.
+ * \param commitTime
+ *      Encoded cluster-time the transaction committed at, which the new
+ *      version is recorded with for snapshot reads; 0 means this master's
+ *      cluster-time.
  * \return
  *      STATUS_OK if the object was written. Otherwise, for example,
  *      STATUS_UKNOWN_TABLE may be returned.
@@ -1955,7 +3138,8 @@ ObjectManager::commitRemove(PreparedOp& op,
 Status
 ObjectManager::commitWrite(PreparedOp& op,
                            Log::Reference& refToPreparedOp,
-                           Buffer* removedObjBuffer)
+                           Buffer* removedObjBuffer,
+                           uint64_t commitTime)
 {
     uint16_t keyLength = 0;
     const void *keyString = op.object.getKey(0, &keyLength);
@@ -2016,59 +3200,576 @@ ObjectManager::commitWrite(PreparedOp& op,
     byteCount += appends[0].buffer.size();
     recordCount++;
 
-    op.object.assembleForLog(appends[1].buffer);
+    assembleObjectForLog(op.object, appends[1].buffer);
     appends[1].type = LOG_ENTRY_TYPE_OBJ;
     byteCount += appends[1].buffer.size();
     recordCount++;
 
-    if (!newKey) {
-        tombstone->assembleForLog(appends[2].buffer);
-        appends[2].type = LOG_ENTRY_TYPE_OBJTOMB;
-        byteCount += appends[2].buffer.size();
-        recordCount++;
+    if (!newKey) {
+        tombstone->assembleForLog(appends[2].buffer);
+        appends[2].type = LOG_ENTRY_TYPE_OBJTOMB;
+        byteCount += appends[2].buffer.size();
+        recordCount++;
+    }
+
+    if (!log.hasSpaceFor(appends[1].buffer.size())) {
+        // We must bound the amount of live data to ensure deletes are possible
+        throw RetryException(HERE, 1000, 2000, "Log is out of space!");
+    }
+
+    if (!log.append(appends, size)) {
+        // The log is out of space. Tell the client to retry and hope
+        // that either the cleaner makes space soon or we shift load
+        // off of this server.
+        return STATUS_RETRY;
+    }
+
+    // Release the lock now that the transaction is committed to log.
+    if (!lockTable.releaseLock(key, refToPreparedOp)) {
+        // If we were not able to release the lock there is a bug somewhere.
+        RAMCLOUD_LOG(ERROR,
+                     "While committing transaction, lock already released "
+                     "when it should not be. Key: %.*s PrepareRef: %lu",
+                     keyLength, reinterpret_cast<const char*>(keyString),
+                     refToPreparedOp.toInteger());
+    }
+
+    TableStats::increment(masterTableMetadata,
+                          prepOpTombstone.header.tableId,
+                          byteCount,
+                          recordCount);
+    ++PerfStats::threadStats.writeCount;
+    uint32_t valueLength = op.object.getValueLength();
+    PerfStats::threadStats.writeObjectBytes += valueLength;
+    PerfStats::threadStats.writeKeyBytes +=
+            op.object.getKeysAndValueLength() - valueLength;
+    TableUsageStats::recordWrite(op.object.getTableId(), valueLength);
+
+    log.free(refToPreparedOp);
+    transactionManager->removeOp(op.header.clientId, op.header.rpcId);
+
+    invalidateRemoteRead(lock, key);
+    if (!newKey) {
+        currentHashTableEntry.setReference(appends[1].reference.toInteger());
+        if (!retainVersion(lock, key, &oldReference, commitTime))
+            freeObject(lock, oldReference, &log);
+    } else {
+        objectMap.insert(key.getHash(), appends[1].reference.toInteger());
+        orderedKeys.insert(key);
+        retainVersion(lock, key, NULL, commitTime);
+    }
+    return STATUS_OK;
+}
+
+/**
+ * Apply the decision of a transaction to all of its operations prepared on
+ * this server, in one step. Unlike calling commitRead(), commitRemove() or
+ * commitWrite() for each operation, the PreparedOps are retired by a single
+ * PreparedOpTombstoneBatch, and everything the decision writes (the batch,
+ * new objects and tombstones for replaced objects) goes to the log in one
+ * atomic append.
+ *
+ * \param numOps
+ *      Number of operations; each of the following arrays must have this
+ *      many elements.
+ * \param ops
+ *      Operations prepared by one transaction (all with the same lease id).
+ *      Operations that are no longer prepared, because a concurrent
+ *      TxDecision already handled them, are skipped.
+ * \param refsToPreparedOps
+ *      refsToPreparedOps[i] is the reference to the log entry of ops[i].
+ * \param commit
+ *      True if the transaction committed; false if it aborted, in which case
+ *      the operations are released without modifying any objects (as by
+ *      commitRead()).
+ * \param commitTime
+ *      Encoded cluster-time the transaction committed at, which modified
+ *      objects are recorded with for snapshot reads; 0 means this master's
+ *      cluster-time.
+ * \return
+ *      STATUS_OK if the decision was applied, STATUS_UNKNOWN_TABLET if one
+ *      of the objects isn't in a tablet owned by this server, or
+ *      STATUS_RETRY if the log is out of space. Nothing has been written
+ *      unless STATUS_OK is returned.
+ *
+ * \throw RetryException
+ *      There isn't enough room in the log for the new objects.
+ */
+Status
+ObjectManager::commitPreparedOps(uint32_t numOps, PreparedOp* ops[],
+                Log::Reference refsToPreparedOps[], bool commit,
+                uint64_t commitTime)
+{
+    if (numOps == 0)
+        return STATUS_OK;
+
+    Tub<Key> keys[numOps];
+    uint64_t buckets[numOps];
+    std::vector<std::pair<uint64_t, uint32_t>> lockOrder;
+    lockOrder.reserve(numOps);
+    for (uint32_t i = 0; i < numOps; i++) {
+        uint16_t keyLength = 0;
+        const void *keyString = ops[i]->object.getKey(0, &keyLength);
+        keys[i].construct(ops[i]->object.getTableId(), keyString, keyLength);
+        uint64_t unused;
+        buckets[i] = HashTable::findBucketIndex(objectMap.getNumBuckets(),
+                                                keys[i]->getHash(), &unused);
+        objectMap.prefetchBucket(keys[i]->getHash());
+        lockOrder.emplace_back(getBucketLockIndex(buckets[i]), i);
+    }
+
+    // As in commitTransaction(), each bucket lock is taken once, in order.
+    std::sort(lockOrder.begin(), lockOrder.end());
+    Tub<HashTableBucketLock> locks[numOps];
+    HashTableBucketLock* lockOf[numOps];
+    for (uint32_t i = 0; i < numOps; i++) {
+        uint32_t op = lockOrder[i].second;
+        if (i == 0 || lockOrder[i].first != lockOrder[i - 1].first) {
+            locks[i].construct(*this, buckets[op]);
+            lockOf[op] = locks[i].get();
+        } else {
+            lockOf[op] = lockOf[lockOrder[i - 1].second];
+        }
+    }
+
+    // Skip operations that are no longer prepared. We need to check this
+    // after holding the HashTableBucketLocks since there can be a concurrent
+    // TxDecision RPC.
+    bool live[numOps];
+    uint32_t numLive = 0;
+    uint64_t tableIds[numOps];
+    for (uint32_t i = 0; i < numOps; i++) {
+        live[i] = transactionManager->getOp(ops[i]->header.clientId,
+                                            ops[i]->header.rpcId) != 0;
+        if (!live[i])
+            continue;
+        numLive++;
+
+        // If the tablet doesn't exist in the NORMAL state, we must plead
+        // ignorance.
+        TabletManager::Tablet tablet;
+        if (!tabletManager->getTablet(*keys[i], &tablet))
+            return STATUS_UNKNOWN_TABLET;
+        if (tablet.state != TabletManager::NORMAL)
+            return STATUS_UNKNOWN_TABLET;
+        tableIds[i] = tablet.tableId;
+    }
+    if (numLive == 0)
+        return STATUS_OK;
+
+    // The batch goes first; each committed write or remove then adds its
+    // object and/or a tombstone for the object it replaces.
+    PreparedOpTombstoneBatch batch(ops[0]->header.clientId);
+    Buffer currentBuffers[numOps];
+    Log::Reference currentReferences[numOps];
+    HashTable::Candidates candidates[numOps];
+    Tub<ObjectTombstone> tombstones[numOps];
+    Log::AppendVector appends[1 + 2 * numOps];
+    uint32_t numAppends = 1;
+    uint32_t objectIndexes[numOps];
+    uint64_t byteCounts[numOps];
+    uint32_t objectBytes = 0;
+    for (uint32_t i = 0; i < numOps; i++) {
+        objectIndexes[i] = ~0U;
+        byteCounts[i] = 0;
+        if (!live[i])
+            continue;
+        PreparedOp& op = *ops[i];
+        batch.add(op, log.getSegmentId(refsToPreparedOps[i]));
+        if (!commit || op.header.type == WireFormat::TxPrepare::READ)
+            continue;
+
+        LogEntryType type;
+        bool exists = lookup(*lockOf[i], *keys[i], type, currentBuffers[i],
+                             NULL, &currentReferences[i], &candidates[i]) &&
+                type == LOG_ENTRY_TYPE_OBJ;
+        if (op.header.type == WireFormat::TxPrepare::WRITE) {
+            objectIndexes[i] = numAppends;
+            assembleObjectForLog(op.object, appends[numAppends].buffer);
+            appends[numAppends].type = LOG_ENTRY_TYPE_OBJ;
+            objectBytes += appends[numAppends].buffer.size();
+            byteCounts[i] += appends[numAppends].buffer.size();
+            numAppends++;
+        } else if (!exists) {
+            static RejectRules defaultRejectRules;
+            return rejectOperation(&defaultRejectRules, VERSION_NONEXISTENT);
+        }
+        if (exists) {
+            Object object(currentBuffers[i]);
+            tombstones[i].construct(object,
+                                    log.getSegmentId(currentReferences[i]),
+                                    WallTime::secondsTimestamp());
+            tombstones[i]->assembleForLog(appends[numAppends].buffer);
+            appends[numAppends].type = LOG_ENTRY_TYPE_OBJTOMB;
+            byteCounts[i] += appends[numAppends].buffer.size();
+            numAppends++;
+        }
+    }
+    batch.assembleForLog(appends[0].buffer);
+    appends[0].type = LOG_ENTRY_TYPE_PREPTOMBBATCH;
+
+    if (!log.hasSpaceFor(objectBytes)) {
+        // We must bound the amount of live data to ensure deletes are possible
+        throw RetryException(HERE, 1000, 2000, "Log is out of space!");
+    }
+
+    if (!log.append(appends, numAppends)) {
+        // The log is out of space. Tell the client to retry and hope
+        // that either the cleaner makes space soon or we shift load
+        // off of this server.
+        return STATUS_RETRY;
+    }
+
+    // The batch is accounted to the table of its first operation, which is
+    // also the one its removal is charged to when it is cleaned.
+    TableStats::increment(masterTableMetadata,
+                          batch.records[0].tableId,
+                          appends[0].buffer.size(),
+                          1);
+    for (uint32_t i = 0; i < numOps; i++) {
+        if (!live[i])
+            continue;
+        PreparedOp& op = *ops[i];
+        Key& key = *keys[i];
+        HashTableBucketLock& lock = *lockOf[i];
+
+        // Release the lock now that the transaction is committed to log.
+        if (!lockTable.releaseLock(key, refsToPreparedOps[i])) {
+            // If we were not able to release the lock there is a bug
+            // somewhere.
+            RAMCLOUD_LOG(ERROR,
+                         "While committing transaction, lock already "
+                         "released when it should not be. Key: %.*s "
+                         "PrepareRef: %lu",
+                         key.getStringKeyLength(),
+                         reinterpret_cast<const char*>(key.getStringKey()),
+                         refsToPreparedOps[i].toInteger());
+        }
+        log.free(refsToPreparedOps[i]);
+        transactionManager->removeOp(op.header.clientId, op.header.rpcId);
+
+        if (byteCounts[i] != 0) {
+            TableStats::increment(masterTableMetadata,
+                                  tableIds[i],
+                                  byteCounts[i],
+                                  (objectIndexes[i] != ~0U) +
+                                  (tombstones[i] ? 1 : 0));
+        }
+        if (objectIndexes[i] != ~0U) {
+            uint64_t reference =
+                    appends[objectIndexes[i]].reference.toInteger();
+            invalidateRemoteRead(lock, key);
+            if (tombstones[i]) {
+                candidates[i].setReference(reference);
+                if (!retainVersion(lock, key, &currentReferences[i],
+                        commitTime)) {
+                    freeObject(lock, currentReferences[i], &log);
+                }
+            } else {
+                objectMap.insert(key.getHash(), reference);
+                orderedKeys.insert(key);
+                retainVersion(lock, key, NULL, commitTime);
+            }
+            ++PerfStats::threadStats.writeCount;
+            uint32_t valueLength = op.object.getValueLength();
+            PerfStats::threadStats.writeObjectBytes += valueLength;
+            PerfStats::threadStats.writeKeyBytes +=
+                    op.object.getKeysAndValueLength() - valueLength;
+            TableUsageStats::recordWrite(key.getTableId(), valueLength);
+        } else if (tombstones[i]) {
+            Object object(currentBuffers[i]);
+            TableUsageStats::recordWrite(key.getTableId(), 0);
+            segmentManager.raiseSafeVersion(object.getVersion() + 1);
+            if (!retainVersion(lock, key, &currentReferences[i], commitTime))
+                freeObject(lock, currentReferences[i], &log);
+            remove(lock, key);
+        }
+    }
+
+    TEST_LOG("decided %u operations in %u log entries", numLive, numAppends);
+    return STATUS_OK;
+}
+
+/**
+ * Commit all of the operations of a transaction that only involves this
+ * server, in one step: the operations are checked, and if they can all
+ * go ahead their objects, tombstones and RpcResults are written to the log
+ * in a single atomic append. Since nothing is ever in a prepared state,
+ * no PreparedOps, PreparedOpTombstones or ParticipantList are logged and
+ * no transaction locks are taken; the hash table bucket locks of all the
+ * keys are held instead, for the duration of this call. As with
+ * writeObject(), the changes are not durable until syncChanges() is called.
+ *
+ * \param numOps
+ *      Number of operations in the transaction; each of the following
+ *      arrays must have this many elements.
+ * \param ops
+ *      The operations of the transaction (READ, REMOVE or WRITE); the keys
+ *      must all differ. The version and timestamp of written objects are
+ *      filled in by this method.
+ * \param rejectRules
+ *      rejectRules[i] specifies the conditions under which ops[i] must not
+ *      go ahead.
+ * \param rpcResults
+ *      The RpcResult to log with each operation, recording its vote for
+ *      linearizability.
+ * \param[out] rpcResultPtrs
+ *      If the transaction committed, the log references of the RpcResults
+ *      are returned here.
+ * \param[out] isCommitted
+ *      Set to true if the transaction committed, or false if an operation
+ *      was rejected or one of the objects is locked by a transaction in
+ *      progress; in that case nothing has been written.
+ * \param snapshotTime
+ *      If nonzero, the transaction runs with snapshot isolation; it is
+ *      rejected if any of the objects changed after this cluster-time (see
+ *      prepareOp()).
+ * \return
+ *      STATUS_OK, unless the request was malformed or one of the objects
+ *      isn't in a tablet owned by this server (STATUS_UNKNOWN_TABLET).
+ *      Nothing has been written in that case either.
+ *
+ * \throw RetryException
+ *      The log is out of space; nothing has been written.
+ */
+Status
+ObjectManager::commitTransaction(uint32_t numOps, PreparedOp* ops[],
+                RejectRules* rejectRules, RpcResult* rpcResults[],
+                uint64_t* rpcResultPtrs, bool* isCommitted,
+                uint64_t snapshotTime)
+{
+    *isCommitted = false;
+    if (!anyWrites) {
+        // This is the first write; use this as a trigger to update the
+        // cluster configuration information and open a session with each
+        // backup, so it won't slow down recovery benchmarks.  This is a
+        // temporary hack, and needs to be replaced with a more robust
+        // approach to updating cluster configuration information.
+        anyWrites = true;
+
+        // Empty coordinator locator means we're in test mode, so skip this.
+        if (!context->coordinatorSession->getLocation().empty()) {
+            ProtoBuf::ServerList backups;
+            CoordinatorClient::getBackupList(context, &backups);
+            TransportManager& transportManager =
+                *context->transportManager;
+            foreach(auto& backup, backups.server())
+                transportManager.getSession(backup.service_locator());
+        }
+    }
+
+    Tub<Key> keys[numOps];
+    uint64_t buckets[numOps];
+    std::vector<std::pair<uint64_t, uint32_t>> lockOrder;
+    lockOrder.reserve(numOps);
+    for (uint32_t i = 0; i < numOps; i++) {
+        uint16_t keyLength = 0;
+        const void *keyString = ops[i]->object.getKey(0, &keyLength);
+        keys[i].construct(ops[i]->object.getTableId(), keyString, keyLength);
+        for (uint32_t j = 0; j < i; j++) {
+            if (keys[j]->getHash() == keys[i]->getHash() &&
+                    *keys[j] == *keys[i]) {
+                return STATUS_REQUEST_FORMAT_ERROR;
+            }
+        }
+        uint64_t unused;
+        buckets[i] = HashTable::findBucketIndex(objectMap.getNumBuckets(),
+                                                keys[i]->getHash(), &unused);
+        objectMap.prefetchBucket(keys[i]->getHash());
+        lockOrder.emplace_back(getBucketLockIndex(buckets[i]), i);
+    }
+
+    // Several keys may share a bucket lock, which must only be taken once.
+    // Taking the locks in order of their index ensures that concurrent
+    // transactions can't deadlock.
+    std::sort(lockOrder.begin(), lockOrder.end());
+    Tub<HashTableBucketLock> locks[numOps];
+    HashTableBucketLock* lockOf[numOps];
+    for (uint32_t i = 0; i < numOps; i++) {
+        uint32_t op = lockOrder[i].second;
+        if (i == 0 || lockOrder[i].first != lockOrder[i - 1].first) {
+            locks[i].construct(*this, buckets[op]);
+            lockOf[op] = locks[i].get();
+        } else {
+            lockOf[op] = lockOf[lockOrder[i - 1].second];
+        }
+    }
+
+    // Check every operation before writing anything.
+    Buffer currentBuffers[numOps];
+    Log::Reference currentReferences[numOps];
+    uint64_t currentVersions[numOps];
+    uint64_t tableIds[numOps];
+    for (uint32_t i = 0; i < numOps; i++) {
+        Key& key = *keys[i];
+
+        // If the tablet doesn't exist in the NORMAL state, we must plead
+        // ignorance.
+        TabletManager::Tablet tablet;
+        if (!tabletManager->getTablet(key, &tablet))
+            return STATUS_UNKNOWN_TABLET;
+        if (tablet.state != TabletManager::NORMAL)
+            return STATUS_UNKNOWN_TABLET;
+        tableIds[i] = tablet.tableId;
+
+        // If the key is locked by a transaction in progress, abort.
+        if (lockTable.isLockAcquired(key)) {
+            RAMCLOUD_LOG(DEBUG, "Transaction commit fail. Key: %.*s, object "
+                    "is already locked", key.getStringKeyLength(),
+                    reinterpret_cast<const char*>(key.getStringKey()));
+            ++PerfStats::threadStats.txLockConflictAborts;
+            return STATUS_OK;
+        }
+
+        // Under snapshot isolation, abort if the object changed after the
+        // snapshot was taken.
+        if (snapshotTime != 0 && (isSnapshotTooOld(snapshotTime) ||
+                versionHistory[lockOf[i]->getIndex()].getLastChange(
+                key.getHash()) > snapshotTime)) {
+            RAMCLOUD_LOG(DEBUG, "Transaction commit fail. Key: %.*s, object "
+                    "changed after snapshot %lu", key.getStringKeyLength(),
+                    reinterpret_cast<const char*>(key.getStringKey()),
+                    snapshotTime);
+            ++PerfStats::threadStats.txLockConflictAborts;
+            return STATUS_OK;
+        }
+
+        LogEntryType currentType = LOG_ENTRY_TYPE_INVALID;
+        currentVersions[i] = VERSION_NONEXISTENT;
+        if (lookup(*lockOf[i], key, currentType, currentBuffers[i], 0,
+                   &currentReferences[i])) {
+            if (currentType == LOG_ENTRY_TYPE_OBJTOMB) {
+                CleanupParameters params = { this , lockOf[i] };
+                removeIfTombstone(currentReferences[i].toInteger(), &params);
+                currentBuffers[i].reset();
+            } else {
+                Object currentObject(currentBuffers[i]);
+                currentVersions[i] = currentObject.getVersion();
+            }
+        }
+
+        Status status = rejectOperation(&rejectRules[i], currentVersions[i]);
+        if (status != STATUS_OK) {
+            RAMCLOUD_LOG(DEBUG, "Transaction commit fail. Type: %d Key: %.*s, "
+                "RejectRule outcome: %s rejectRule.givenVersion %lu "
+                "currentVersion %lu", ops[i]->header.type,
+                key.getStringKeyLength(),
+                reinterpret_cast<const char*>(key.getStringKey()),
+                statusToString(status), rejectRules[i].givenVersion,
+                currentVersions[i]);
+            ++PerfStats::threadStats.txRejectRuleAborts;
+            return STATUS_OK;
+        }
     }
 
-    if (!log.hasSpaceFor(appends[1].buffer.size())) {
-        // We must bound the amount of live data to ensure deletes are possible
-        throw RetryException(HERE, 1000, 2000, "Log is out of space!");
+    // Each operation contributes its RpcResult, plus an object and/or a
+    // tombstone for the old version when it modifies an object.
+    Tub<ObjectTombstone> tombstones[numOps];
+    Log::AppendVector appends[3 * numOps];
+    uint32_t numAppends = 0;
+    uint32_t rpcResultIndexes[numOps];
+    uint32_t objectIndexes[numOps];
+    uint32_t objectBytes = 0;
+    for (uint32_t i = 0; i < numOps; i++) {
+        PreparedOp& op = *ops[i];
+        bool exists = currentVersions[i] != VERSION_NONEXISTENT;
+        objectIndexes[i] = ~0U;
+        if (op.header.type == WireFormat::TxPrepare::WRITE) {
+            // Existing objects get a bump in version, new objects start from
+            // the next version allocated in the table.
+            op.object.setVersion(exists ? currentVersions[i] + 1
+                                        : segmentManager.allocateVersion());
+            op.object.setTimestamp(WallTime::secondsTimestamp());
+            objectIndexes[i] = numAppends;
+            assembleObjectForLog(op.object, appends[numAppends].buffer);
+            appends[numAppends].type = LOG_ENTRY_TYPE_OBJ;
+            objectBytes += appends[numAppends].buffer.size();
+            numAppends++;
+        } else if (op.header.type != WireFormat::TxPrepare::REMOVE) {
+            // READ operations only check the version.
+            exists = false;
+        }
+        if (exists) {
+            Object object(currentBuffers[i]);
+            tombstones[i].construct(object,
+                                    log.getSegmentId(currentReferences[i]),
+                                    WallTime::secondsTimestamp());
+            tombstones[i]->assembleForLog(appends[numAppends].buffer);
+            appends[numAppends].type = LOG_ENTRY_TYPE_OBJTOMB;
+            numAppends++;
+        }
+        rpcResultIndexes[i] = numAppends;
+        rpcResults[i]->assembleForLog(appends[numAppends].buffer);
+        appends[numAppends].type = LOG_ENTRY_TYPE_RPCRESULT;
+        numAppends++;
     }
 
-    if (!log.append(appends, size)) {
+    // Note: only check for enough space for the objects (tombstones and
+    // RpcResults don't get included in the limit, since they can be cleaned).
+    if (!log.hasSpaceFor(objectBytes)) {
+        throw RetryException(HERE, 1000, 2000, "Memory capacity exceeded");
+    }
+    if (!log.append(appends, numAppends)) {
         // The log is out of space. Tell the client to retry and hope
-        // that either the cleaner makes space soon or we shift load
-        // off of this server.
-        return STATUS_RETRY;
+        // that the cleaner makes space soon.
+        throw RetryException(HERE, 1000, 2000, "Must wait for cleaner");
     }
 
-    // Release the lock now that the transaction is committed to log.
-    if (!lockTable.releaseLock(key, refToPreparedOp)) {
-        // If we were not able to release the lock there is a bug somewhere.
-        RAMCLOUD_LOG(ERROR,
-                     "While committing transaction, lock already released "
-                     "when it should not be. Key: %.*s PrepareRef: %lu",
-                     keyLength, reinterpret_cast<const char*>(keyString),
-                     refToPreparedOp.toInteger());
+    // Now that the log has all of the transaction, update the hash table.
+    // All of its changes become visible to snapshots at the same time,
+    // after the snapshot the transaction read from.
+    if (snapshotTime != 0)
+        clusterClock->updateClock(ClusterTime(snapshotTime));
+    uint64_t commitTime = retainsVersions() ? stampVersion(0) : 0;
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < numOps; i++) {
+        Key& key = *keys[i];
+        HashTableBucketLock& lock = *lockOf[i];
+        uint64_t byteCount = 0;
+        uint64_t recordCount = rpcResultIndexes[i] + 1 - next;
+        for (; next <= rpcResultIndexes[i]; next++)
+            byteCount += appends[next].buffer.size();
+        TableStats::increment(masterTableMetadata, tableIds[i], byteCount,
+                              recordCount);
+        rpcResultPtrs[i] = appends[rpcResultIndexes[i]].reference.toInteger();
+
+        if (objectIndexes[i] != ~0U) {
+            uint64_t reference =
+                    appends[objectIndexes[i]].reference.toInteger();
+            invalidateRemoteRead(lock, key);
+            if (tombstones[i]) {
+                LogEntryType type;
+                Buffer buffer;
+                HashTable::Candidates candidates;
+                lookup(lock, key, type, buffer, NULL, NULL, &candidates);
+                candidates.setReference(reference);
+                if (!retainVersion(lock, key, &currentReferences[i],
+                        commitTime)) {
+                    freeObject(lock, currentReferences[i], &log);
+                }
+            } else {
+                objectMap.insert(key.getHash(), reference);
+                orderedKeys.insert(key);
+                retainVersion(lock, key, NULL, commitTime);
+            }
+            tabletManager->incrementWriteCount(key);
+            ++PerfStats::threadStats.writeCount;
+            uint32_t valueLength = ops[i]->object.getValueLength();
+            PerfStats::threadStats.writeObjectBytes += valueLength;
+            PerfStats::threadStats.writeKeyBytes +=
+                    ops[i]->object.getKeysAndValueLength() - valueLength;
+            TableUsageStats::recordWrite(key.getTableId(), valueLength);
+        } else if (tombstones[i]) {
+            invalidateRemoteRead(lock, key);
+            segmentManager.raiseSafeVersion(currentVersions[i] + 1);
+            if (!retainVersion(lock, key, &currentReferences[i], commitTime))
+                freeObject(lock, currentReferences[i], &log);
+            remove(lock, key);
+        }
     }
 
-    TableStats::increment(masterTableMetadata,
-                          prepOpTombstone.header.tableId,
-                          byteCount,
-                          recordCount);
-    ++PerfStats::threadStats.writeCount;
-    uint32_t valueLength = op.object.getValueLength();
-    PerfStats::threadStats.writeObjectBytes += valueLength;
-    PerfStats::threadStats.writeKeyBytes +=
-            op.object.getKeysAndValueLength() - valueLength;
-
-    log.free(refToPreparedOp);
-    transactionManager->removeOp(op.header.clientId, op.header.rpcId);
-
-    if (!newKey) {
-        currentHashTableEntry.setReference(appends[1].reference.toInteger());
-        log.free(oldReference);
-    } else {
-        objectMap.insert(key.getHash(), appends[1].reference.toInteger());
-    }
+    TEST_LOG("committed %u operations in %u log entries", numOps, numAppends);
+    *isCommitted = true;
     return STATUS_OK;
 }
 
@@ -2146,6 +3847,7 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
             objectMap.prefetchBucket(key.getHash());
             HashTableBucketLock lock(*this, key);
 
+            invalidateRemoteRead(lock, key);
             if (lookup(lock, key, currentType, currentBuffer, &currentVersion,
                        &currentReference, &currentHashTableEntry)) {
 
@@ -2153,15 +3855,17 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
                     CleanupParameters params = { this , &lock };
                     removeIfTombstone(currentReference.toInteger(), &params);
                     objectMap.insert(key.getHash(), references[i].toInteger());
+                    orderedKeys.insert(key);
                 }
 
                 if (currentType == LOG_ENTRY_TYPE_OBJ) {
                     currentHashTableEntry.setReference(
                                     references[i].toInteger());
-                    log.free(currentReference);
+                    freeObject(lock, currentReference, &log);
                 }
             } else {
                 objectMap.insert(key.getHash(), references[i].toInteger());
+                orderedKeys.insert(key);
             }
 
             tabletManager->incrementWriteCount(key);
@@ -2191,7 +3895,7 @@ ObjectManager::flushEntriesToLog(Buffer *logBuffer, uint32_t& numEntries)
                 // the object so far in the log
                 if (currentVersion == tombstone.getObjectVersion()) {
                     remove(lock, key);
-                    log.free(currentReference);
+                    freeObject(lock, currentReference, &log);
                     segmentManager.raiseSafeVersion(currentVersion + 1);
                 }
             }
@@ -2305,7 +4009,8 @@ ObjectManager::prepareForLog(Object& newObject, Buffer *logBuffer,
     uint32_t valueOffset = 0;
 
     newObject.getValueOffset(&valueOffset);
-    objectOffset = lengthBefore + sizeof32(Object::Header) + valueOffset;
+    objectOffset = lengthBefore + newObject.getSerializedLength() -
+            newObject.getKeysAndValueLength() + valueOffset;
 
     void* target = logBuffer->alloc(newObject.getSerializedLength());
     newObject.assembleForLog(target);
@@ -2394,12 +4099,34 @@ ObjectManager::getTimestamp(LogEntryType type, Buffer& buffer)
         return getObjectTimestamp(buffer);
     else if (type == LOG_ENTRY_TYPE_OBJTOMB)
         return getTombstoneTimestamp(buffer);
+    else if (type == LOG_ENTRY_TYPE_OBJDELTA)
+        return getObjectDeltaTimestamp(buffer);
     else if (type == LOG_ENTRY_TYPE_TXDECISION)
         return getTxDecisionRecordTimestamp(buffer);
     else
         return 0;
 }
 
+/**
+ * Prefetch the hash table bucket that relocate() will look in for an entry
+ * that is about to be cleaned. The cleaner calls this for a batch of entries
+ * before relocating any of them, so that their cache misses overlap.
+ *
+ * \param type
+ *      Type of the entry that will be cleaned.
+ * \param buffer
+ *      Buffer pointing to the entry in the log.
+ */
+void
+ObjectManager::prefetchEntry(LogEntryType type, Buffer& buffer)
+{
+    if (type == LOG_ENTRY_TYPE_OBJ || type == LOG_ENTRY_TYPE_OBJTOMB ||
+            type == LOG_ENTRY_TYPE_OBJDELTA) {
+        Key key(type, buffer);
+        objectMap.prefetchBucket(key.getHash());
+    }
+}
+
 /**
  * Relocate and update metadata for an object, tombstone, etc. that is being
  * cleaned. The cleaner invokes this method for every entry it comes across
@@ -2428,12 +4155,16 @@ ObjectManager::relocate(LogEntryType type, Buffer& oldBuffer,
         relocateObject(oldBuffer, oldReference, relocator);
     else if (type == LOG_ENTRY_TYPE_OBJTOMB)
         relocateTombstone(oldBuffer, oldReference, relocator);
+    else if (type == LOG_ENTRY_TYPE_OBJDELTA)
+        relocateObjectDelta(oldBuffer, oldReference, relocator);
     else if (type == LOG_ENTRY_TYPE_RPCRESULT)
         relocateRpcResult(oldBuffer, relocator);
     else if (type == LOG_ENTRY_TYPE_PREP)
         relocatePreparedOp(oldBuffer, oldReference, relocator);
     else if (type == LOG_ENTRY_TYPE_PREPTOMB)
         relocatePreparedOpTombstone(oldBuffer, relocator);
+    else if (type == LOG_ENTRY_TYPE_PREPTOMBBATCH)
+        relocatePreparedOpTombstoneBatch(oldBuffer, relocator);
     else if (type == LOG_ENTRY_TYPE_TXDECISION)
         relocateTxDecisionRecord(oldBuffer, relocator);
     else if (type == LOG_ENTRY_TYPE_TXPLIST)
@@ -2454,7 +4185,9 @@ ObjectManager::TombstoneRemover::TombstoneRemover(
                 ObjectManager* objectManager,
                 HashTable* objectMap)
     : WorkerTimer(objectManager->context->dispatch)
-    , currentBucket(0)
+    , currentStripe(0)
+    , currentKeyHash(0)
+    , stripeEnd(0)
     , objectManager(objectManager)
     , objectMap(objectMap)
 {
@@ -2467,21 +4200,39 @@ ObjectManager::TombstoneRemover::TombstoneRemover(
 void
 ObjectManager::TombstoneRemover::handleTimerEvent()
 {
-    for (int i = 0; i < 100; i++) {
-        if (currentBucket >= objectMap->getNumBuckets()) {
+    uint64_t numStripes = objectManager->getNumBucketLocksInUse();
+    int bucketsVisited = 0;
+    while (bucketsVisited < 100) {
+        if (currentStripe >= numStripes) {
             LOG(NOTICE, "Tombstone cleanup complete");
             return;
         }
 
-        HashTableBucketLock lock(*objectManager, currentBucket);
-        CleanupParameters params = { objectManager, &lock };
-        objectMap->forEachInBucket(removeIfTombstone, &params, currentBucket);
+        // Bucket number currentStripe is covered by lock currentStripe.
+        HashTableBucketLock lock(*objectManager, currentStripe);
+        std::vector<KeyHash>& keyHashes =
+                objectManager->replayedTombstones[lock.getIndex()];
+        if (currentKeyHash == 0)
+            stripeEnd = keyHashes.size();
+        while (currentKeyHash < stripeEnd && bucketsVisited < 100) {
+            objectManager->removeReplayedTombstones(lock,
+                    keyHashes[currentKeyHash]);
+            ++currentKeyHash;
+            ++bucketsVisited;
+        }
+        if (currentKeyHash < stripeEnd)
+            break;
 
-        ++currentBucket;
+        keyHashes.erase(keyHashes.begin(), keyHashes.begin() + stripeEnd);
+        if (keyHashes.empty())
+            std::vector<KeyHash>().swap(keyHashes);
+        objectManager->discardPendingDeltas(lock);
+        ++currentStripe;
+        currentKeyHash = 0;
     }
 
-    // If we get here, it means that we haven't finished scanning the entire
-    // hash table. Reschedule ourselves to run again, after any other
+    // If we get here, it means that we haven't finished with all of the
+    // replayed tombstones. Reschedule ourselves to run again, after any other
     // WorkerTimers that may be ready.
     start(0);
 }
@@ -2508,7 +4259,11 @@ ObjectManager::TombstoneProtector::~TombstoneProtector()
     SpinLock::Guard guard(objectManager->mutex);
     --objectManager->tombstoneProtectorCount;
     if (objectManager->tombstoneProtectorCount == 0) {
-        objectManager->tombstoneRemover.currentBucket = 0;
+        // Replay may have recorded more tombstones in stripes that were
+        // already handled, so start over. Key hashes already handled in the
+        // current stripe are just visited again.
+        objectManager->tombstoneRemover.currentStripe = 0;
+        objectManager->tombstoneRemover.currentKeyHash = 0;
         objectManager->tombstoneRemover.start(0);
     }
 }
@@ -2550,6 +4305,16 @@ ObjectManager::dumpSegment(Segment* segment)
                     tombstone.getTableId(),
                     tombstone.getKeyLength(),
                     static_cast<const char*>(tombstone.getKey()));
+        } else if (type == LOG_ENTRY_TYPE_OBJDELTA) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            ObjectDelta delta(buffer);
+            result += format("%sobjectDelta at offset %u, length %u with "
+                    "tableId %lu, key '%.*s', version %lu",
+                    separator, it.getOffset(), it.getLength(),
+                    delta.getTableId(), delta.getKeyLength(),
+                    static_cast<const char*>(delta.getKey()),
+                    delta.getVersion());
         } else if (type == LOG_ENTRY_TYPE_SAFEVERSION) {
             Buffer buffer;
             it.appendToBuffer(buffer);
@@ -2587,6 +4352,18 @@ ObjectManager::dumpSegment(Segment* segment)
                     separator, it.getOffset(), it.getLength(),
                     opTomb.header.tableId, opTomb.header.keyHash,
                     opTomb.header.clientLeaseId, opTomb.header.rpcId);
+        } else if (type == LOG_ENTRY_TYPE_PREPTOMBBATCH) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            PreparedOpTombstoneBatch batch(buffer);
+            result += format("%spreparedOpTombstoneBatch at offset %u, "
+                    "length %u with leaseId %lu, rpcIds",
+                    separator, it.getOffset(), it.getLength(),
+                    batch.header.clientLeaseId);
+            foreach (PreparedOpTombstoneBatch::Record& record,
+                     batch.records) {
+                result += format(" %lu", record.rpcId);
+            }
         } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
             Buffer buffer;
             it.appendToBuffer(buffer);
@@ -2616,52 +4393,502 @@ ObjectManager::dumpSegment(Segment* segment)
 }
 
 /**
- * Callback used by the Log to determine the modification timestamp of an
- * Object. Timestamps are stored in the Object itself, rather than in the
- * Log, since not all Log entries need timestamps and other parts of the
- * system (or clients) may care about Object modification times.
+ * Callback used by the Log to determine the modification timestamp of an
+ * Object. Timestamps are stored in the Object itself, rather than in the
+ * Log, since not all Log entries need timestamps and other parts of the
+ * system (or clients) may care about Object modification times.
+ *
+ * \param buffer
+ *      Buffer pointing to the object the timestamp is to be extracted from.
+ * \return
+ *      The Object's modification timestamp.
+ */
+uint32_t
+ObjectManager::getObjectTimestamp(Buffer& buffer)
+{
+    Object object(buffer);
+    return object.getTimestamp();
+}
+
+/**
+ * Callback used by the Log to determine the age of an ObjectDelta.
+ *
+ * \param buffer
+ *      Buffer pointing to the delta the timestamp is to be extracted from.
+ * \return
+ *      The delta's creation timestamp.
+ */
+uint32_t
+ObjectManager::getObjectDeltaTimestamp(Buffer& buffer)
+{
+    ObjectDelta delta(buffer);
+    return delta.getTimestamp();
+}
+
+/**
+ * Callback used by the Log to determine the age of Tombstone.
+ *
+ * \param buffer
+ *      Buffer pointing to the tombstone the timestamp is to be extracted from.
+ * \return
+ *      The tombstone's creation timestamp.
+ */
+uint32_t
+ObjectManager::getTombstoneTimestamp(Buffer& buffer)
+{
+    ObjectTombstone tomb(buffer);
+    return tomb.getTimestamp();
+}
+
+/**
+ * Method used by the Lod to determine the age of a TxDecisionRecord.
+ *
+ * \param buffer
+ *      Buffer pointing to the transaction decision record from which the
+ *      timestamp is to be extracted.
+ * \return
+ *      The record's creation timestamp.
+ */
+uint32_t
+ObjectManager::getTxDecisionRecordTimestamp(Buffer& buffer)
+{
+    TxDecisionRecord record(buffer);
+    return record.getTimestamp();
+}
+
+/**
+ * Map a hash table bucket index to the index of the lock in
+ * #hashTableBucketLocks that protects it. The mapping only depends on the
+ * low bits of the index shared by every size the table has had, so a key
+ * keeps the same lock even if #objectMap grows.
+ *
+ * \param bucket
+ *      Index of a bucket in #objectMap (or any key hash).
+ */
+uint64_t
+ObjectManager::getBucketLockIndex(uint64_t bucket)
+{
+    uint64_t numLocks = arrayLength(hashTableBucketLocks);
+    assert(BitOps::isPowerOfTwo(numLocks));
+    return bucket & (objectMap.getInitialNumBuckets() - 1) & (numLocks - 1);
+}
+
+/**
+ * Return the number of #hashTableBucketLocks that getBucketLockIndex() maps
+ * buckets to: bucket i, for i below this count, is covered by lock i.
+ */
+uint64_t
+ObjectManager::getNumBucketLocksInUse()
+{
+    return std::min<uint64_t>(arrayLength(hashTableBucketLocks),
+            objectMap.getInitialNumBuckets());
+}
+
+/**
+ * HashTable::KeyHashFunction used when migrating #objectMap buckets during
+ * a resize: returns the key hash of the object or tombstone a hash table
+ * entry refers to.
+ *
+ * \param reference
+ *      Log reference stored in the hash table.
+ * \param cookie
+ *      The ObjectManager that owns the hash table.
+ */
+KeyHash
+ObjectManager::getKeyHashForReference(uint64_t reference, void* cookie)
+{
+    ObjectManager* objectManager = static_cast<ObjectManager*>(cookie);
+    Buffer buffer;
+    LogEntryType type = objectManager->log.getEntry(Log::Reference(reference),
+                                                    buffer);
+    Key key(type, buffer);
+    return key.getHash();
+}
+
+/**
+ * Make incremental progress on growing #objectMap. If the table is full
+ * enough to need more buckets, this starts a resize; if a resize is in
+ * progress, a few more buckets are migrated to the new array; once every
+ * bucket has been migrated the new array is installed. This is invoked
+ * from the write path so the cost of a resize is spread across many
+ * writes rather than stalling the server.
+ *
+ * Bucket locks are only acquired with try_lock, so this never blocks and
+ * is safe to invoke even if the caller already holds one of them. Work that
+ * can't be done now is simply picked up by a later call.
+ *
+ * \param maxBuckets
+ *      Upper bound on the number of buckets to migrate in this call.
+ */
+void
+ObjectManager::growHashTable(uint64_t maxBuckets)
+{
+    if (expect_true(!objectMap.isResizing() && !objectMap.needsResize() &&
+            !objectMap.hasRetiredBuckets())) {
+        return;
+    }
+
+    if (!hashTableResizeLock.try_lock())
+        return;
+    std::lock_guard<SpinLock> guard(hashTableResizeLock, std::adopt_lock);
+
+    // The array replaced by the last resize may only be freed once no RPC
+    // that started before the switch (e.g. an unlocked enumeration) can
+    // still be looking at it.
+    if (objectMap.hasRetiredBuckets() &&
+            Cycles::rdtsc() >= nextRetiredBucketsCheck) {
+        uint64_t earliestEpoch = LogProtector::getEarliestOutstandingEpoch(~0);
+        if (retiredBucketsEpoch < earliestEpoch) {
+            objectMap.releaseRetiredBuckets();
+        } else {
+            nextRetiredBucketsCheck = Cycles::rdtsc() +
+                    Cycles::fromMicroseconds(1000);
+        }
+    }
+
+    if (!objectMap.isResizing()) {
+        if (!objectMap.needsResize() || objectMap.hasRetiredBuckets())
+            return;
+        objectMap.startResize();
+    }
+
+    // Every bucket may already have been moved by an earlier call that
+    // couldn't take all the locks to install the new array.
+    for (uint64_t i = 0; i < maxBuckets &&
+            objectMap.getNextBucketToMigrate() < objectMap.getNumBuckets();
+            i++) {
+        SpinLock& lock = hashTableBucketLocks[
+                getBucketLockIndex(objectMap.getNextBucketToMigrate())];
+        if (!lock.try_lock())
+            return;
+        objectMap.migrateBucket(getKeyHashForReference, this);
+        lock.unlock();
+    }
+    if (objectMap.getNextBucketToMigrate() < objectMap.getNumBuckets())
+        return;
+
+    // Installing the new array requires exclusive access to the whole
+    // table. Back off and retry on a later call if anyone is busy.
+    uint64_t numLocks = arrayLength(hashTableBucketLocks);
+    uint64_t locked = 0;
+    while (locked < numLocks && hashTableBucketLocks[locked].try_lock())
+        locked++;
+    if (locked == numLocks) {
+        objectMap.finishResize();
+        retiredBucketsEpoch = LogProtector::incrementCurrentEpoch() - 1;
+        nextRetiredBucketsCheck = 0;
+        LOG(NOTICE, "Hash table now has %lu buckets",
+                objectMap.getNumBuckets());
+    }
+    while (locked > 0)
+        hashTableBucketLocks[--locked].unlock();
+}
+
+/**
+ * Append an object that is about to be written to the log to a buffer. The
+ * object's value is compressed if it is at least
+ * config->master.valueCompressionThreshold bytes long and that makes the
+ * object smaller; see Object::assembleCompressedForLog(). No checksum is
+ * computed for it if config->master.deferObjectChecksums is set.
+ *
+ * \param object
+ *      The object to append.
+ * \param buffer
+ *      The serialized object is appended here.
+ */
+void
+ObjectManager::assembleObjectForLog(Object& object, Buffer& buffer)
+{
+    object.setCompactHeader(config->master.compactObjectHeaders);
+    object.setDeferredChecksum(config->master.deferObjectChecksums);
+    uint32_t threshold = config->master.valueCompressionThreshold;
+    if (threshold != 0 && object.getValueLength() >= threshold) {
+        uint32_t length = buffer.size();
+        if (object.assembleCompressedForLog(buffer)) {
+            TEST_LOG("compressed %u-byte object to %u bytes",
+                    object.getSerializedLength(), buffer.size() - length);
+            return;
+        }
+    }
+    object.assembleForLog(buffer);
+}
+
+/**
+ * Copy an object that has just been read into the InlineValue of its hash
+ * table bucket, so that readObject() can answer the next read of it without
+ * touching the log. Nothing is copied unless the object is small, has a
+ * single key and no deltas, and never expires.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param inlineValue
+ *      The InlineValue of the object's bucket; see
+ *      HashTable::findInlineValue().
+ * \param key
+ *      Key of the object.
+ * \param object
+ *      The object, with its value decompressed.
+ * \param reference
+ *      Reference to the object entry, as found in #objectMap.
+ * \param version
+ *      Version of the object.
+ */
+void
+ObjectManager::saveInlineValue(HashTableBucketLock& lock,
+                HashTable::InlineValue& inlineValue, Key& key, Object& object,
+                Log::Reference reference, uint64_t version)
+{
+    uint32_t valueLength;
+    const void* value = object.getValue(&valueLength);
+    if (value == NULL || valueLength > HashTable::MAX_INLINE_VALUE_LENGTH ||
+            key.getStringKeyLength() > HashTable::MAX_INLINE_KEY_LENGTH ||
+            object.getKeyCount() != 1 || object.getExpiry() != 0 ||
+            findDeltaChain(lock, reference) != NULL) {
+        return;
+    }
+
+    inlineValue.reference = reference.toInteger();
+    inlineValue.version = version;
+    inlineValue.tableId = key.getTableId();
+    memcpy(inlineValue.value, value, valueLength);
+    inlineValue.valueLength = downCast<uint8_t>(valueLength);
+    inlineValue.keyLength = downCast<uint8_t>(key.getStringKeyLength());
+    memcpy(inlineValue.key, key.getStringKey(), inlineValue.keyLength);
+}
+
+/**
+ * Fold the deltas of an object into a new, complete copy of the object at
+ * the head of the log. This is used by the cleaner when it relocates an
+ * object with deltas: the relocator can't be used, since the new entry is
+ * larger than the old one.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param key
+ *      Key of the object.
+ * \param oldBuffer
+ *      Buffer pointing to the object entry being cleaned.
+ * \param oldReference
+ *      Reference to the object entry being cleaned.
+ * \param candidates
+ *      Hash table entry pointing at \a oldReference; it is updated to
+ *      point at the new object.
+ * \param[out] newReference
+ *      Reference to the new object, which the caller must sync to backups
+ *      before the cleaner frees the old one.
+ * \return
+ *      True if the object was written. False means the log head is out of
+ *      space; the object is left alone.
+ */
+bool
+ObjectManager::compactObject(HashTableBucketLock& lock, Key& key,
+                Buffer& oldBuffer, Log::Reference oldReference,
+                HashTable::Candidates& candidates,
+                Log::Reference* newReference)
+{
+    Buffer currentBuffer;
+    materializeObject(lock, oldReference, oldBuffer, currentBuffer);
+    Object current(currentBuffer);
+    Buffer keysAndValue;
+    current.appendKeysAndValueToBuffer(keysAndValue);
+    Object object(key.getTableId(), current.getVersion(),
+            current.getTimestamp(), keysAndValue);
+    object.setExpiry(current.getExpiry());
+
+    Log::AppendVector append;
+    assembleObjectForLog(object, append.buffer);
+    append.type = LOG_ENTRY_TYPE_OBJ;
+    if (!log.append(&append, 1))
+        return false;
+
+    // The old entry disappears with the segment being cleaned, so it needs
+    // no tombstone and isn't freed here; the deltas elsewhere in the log are
+    // older than the new object and are ignored if they are ever replayed.
+    uint32_t numDeltas = freeDeltaChain(lock, oldReference, &log);
+    invalidateRemoteRead(lock, key);
+    candidates.setReference(append.reference.toInteger());
+    *newReference = append.reference;
+
+    TableStats::increment(masterTableMetadata, key.getTableId(),
+            append.buffer.size(), 1);
+    TableStats::decrement(masterTableMetadata, key.getTableId(),
+            oldBuffer.size(), 1);
+    TEST_LOG("folded %u deltas into %u bytes, version %lu", numDeltas,
+            append.buffer.size(), object.getVersion());
+    return true;
+}
+
+/**
+ * Drop the deltas that replaySegment() held on to for objects that never
+ * showed up in the right version (see replayObjectDeltas()). This is done
+ * along with removing tombstones, once no more segments are being replayed.
+ *
+ * \param lock
+ *      Hash table bucket lock whose share of the deltas is dropped.
+ */
+void
+ObjectManager::discardPendingDeltas(HashTableBucketLock& lock)
+{
+    ObjectDeltas& deltas = objectDeltas[lock.getIndex()];
+    if (expect_false(!deltas.pending.empty())) {
+        TEST_LOG("discarding %lu deltas", deltas.pending.size());
+        deltas.pending.clear();
+    }
+}
+
+/**
+ * Find the deltas that apply to an object.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param reference
+ *      Reference to the object entry, as found in #objectMap.
+ * \return
+ *      The references of the object's deltas, oldest first, or NULL if it
+ *      has none. This is only valid while \a lock is held.
+ */
+std::vector<uint64_t>*
+ObjectManager::findDeltaChain(HashTableBucketLock& lock,
+                Log::Reference reference)
+{
+    ObjectDeltas& deltas = objectDeltas[lock.getIndex()];
+    if (expect_true(deltas.chains.empty()))
+        return NULL;
+    auto it = deltas.chains.find(reference.toInteger());
+    if (it == deltas.chains.end())
+        return NULL;
+    return &it->second;
+}
+
+/**
+ * Free an object entry that is no longer needed, along with any deltas
+ * that apply to it.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param reference
+ *      Reference to the object entry.
+ * \param fromLog
+ *      Log (or SideLog) to free the entries from.
+ */
+void
+ObjectManager::freeObject(HashTableBucketLock& lock, Log::Reference reference,
+                AbstractLog* fromLog)
+{
+    freeDeltaChain(lock, reference, fromLog);
+    fromLog->free(reference);
+}
+
+/**
+ * Free the deltas that apply to an object, but not the object itself.
  *
- * \param buffer
- *      Buffer pointing to the object the timestamp is to be extracted from.
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param reference
+ *      Reference to the object entry.
+ * \param fromLog
+ *      Log (or SideLog) to free the entries from.
  * \return
- *      The Object's modification timestamp.
+ *      The number of deltas freed.
  */
 uint32_t
-ObjectManager::getObjectTimestamp(Buffer& buffer)
+ObjectManager::freeDeltaChain(HashTableBucketLock& lock,
+                Log::Reference reference, AbstractLog* fromLog)
 {
-    Object object(buffer);
-    return object.getTimestamp();
+    ObjectDeltas& deltas = objectDeltas[lock.getIndex()];
+    if (expect_true(deltas.chains.empty()))
+        return 0;
+    auto it = deltas.chains.find(reference.toInteger());
+    if (it == deltas.chains.end())
+        return 0;
+    uint32_t numDeltas = downCast<uint32_t>(it->second.size());
+    foreach (uint64_t delta, it->second)
+        fromLog->free(Log::Reference(delta));
+    deltas.chains.erase(it);
+    return numDeltas;
 }
 
 /**
- * Callback used by the Log to determine the age of Tombstone.
+ * Append an object to a buffer with all of its deltas applied. The result
+ * has the same format as an object entry in the log: a copy of the object's
+ * header, carrying the version and timestamp of the last delta, followed by
+ * the keys and value of the object entry and the data of each delta, all by
+ * reference (except for a compressed value, which is expanded). The checksum
+ * in the header is that of the object entry, so it doesn't cover the deltas.
+ * If the object has no deltas, the entry itself is appended.
  *
- * \param buffer
- *      Buffer pointing to the tombstone the timestamp is to be extracted from.
- * \return
- *      The tombstone's creation timestamp.
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param reference
+ *      Reference to the object entry, as found in #objectMap.
+ * \param entryBuffer
+ *      Buffer pointing to the object entry in the log.
+ * \param[out] buffer
+ *      The object is appended to this buffer.
  */
-uint32_t
-ObjectManager::getTombstoneTimestamp(Buffer& buffer)
+void
+ObjectManager::materializeObject(HashTableBucketLock& lock,
+                Log::Reference reference, Buffer& entryBuffer, Buffer& buffer)
 {
-    ObjectTombstone tomb(buffer);
-    return tomb.getTimestamp();
+    std::vector<uint64_t>* chain = findDeltaChain(lock, reference);
+    if (expect_true(chain == NULL)) {
+        buffer.append(&entryBuffer);
+        return;
+    }
+    appendObjectWithDeltas(entryBuffer, *chain, buffer);
 }
 
 /**
- * Method used by the Lod to determine the age of a TxDecisionRecord.
+ * Append an object to a buffer with the given deltas applied, in the format
+ * described for materializeObject(). The caller must make sure that none of
+ * the entries can be freed while the buffer is in use.
  *
- * \param buffer
- *      Buffer pointing to the transaction decision record from which the
- *      timestamp is to be extracted.
- * \return
- *      The record's creation timestamp.
+ * \param entryBuffer
+ *      Buffer pointing to the object entry in the log.
+ * \param chain
+ *      References to the deltas to apply, oldest first; must not be empty.
+ * \param[out] buffer
+ *      The object is appended to this buffer.
  */
-uint32_t
-ObjectManager::getTxDecisionRecordTimestamp(Buffer& buffer)
+void
+ObjectManager::appendObjectWithDeltas(Buffer& entryBuffer,
+                const std::vector<uint64_t>& chain, Buffer& buffer)
 {
-    TxDecisionRecord record(buffer);
-    return record.getTimestamp();
+    // Deltas extend the original value, so a compressed one is expanded.
+    Object object(entryBuffer);
+    Buffer expanded;
+    object.decompressValue(expanded);
+
+    Buffer lastBuffer;
+    log.getEntry(Log::Reference(chain.back()), lastBuffer);
+    ObjectDelta last(lastBuffer);
+    Object::Header* header = buffer.emplaceAppend<Object::Header>(
+            object.header);
+    header->version = last.getVersion();
+    header->timestamp = last.getTimestamp() |
+            (header->timestamp & Object::EXPIRY_FLAG);
+    uint32_t expiry = object.getExpiry();
+    if (expiry != 0)
+        buffer.appendCopy(&expiry, sizeof32(expiry));
+    object.appendKeysAndValueToBuffer(buffer);
+    foreach (uint64_t deltaReference, chain) {
+        Buffer deltaBuffer;
+        log.getEntry(Log::Reference(deltaReference), deltaBuffer);
+        ObjectDelta delta(deltaBuffer);
+        delta.appendDataToBuffer(buffer);
+    }
 }
 
 /**
@@ -2679,9 +4906,9 @@ ObjectManager::getTxDecisionRecordTimestamp(Buffer& buffer)
  *      The type of the log entry is returned here.
  * \param[out] buffer
  *      The entry, if found, is appended to this buffer. Note that the data
- *      pointed to by this buffer will be exactly the data in the log. The
- *      cleaner uses this fact to check whether an object in a segment is
- *      alive by comparing the pointer in the hash table (see #relocateObject).
+ *      pointed to by this buffer will be exactly the data in the log, except
+ *      for objects with deltas: these are described as the object with its
+ *      deltas applied (see materializeObject()).
  * \param[out] outVersion
  *      The version of the object or tombstone, when one is found, stored in
  *      this optional parameter.
@@ -2715,10 +4942,16 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
         Key candidateKey(type, candidateBuffer);
         if (key == candidateKey) {
             outType = type;
-            buffer.append(&candidateBuffer);
+            uint32_t offset = buffer.size();
+            if (type == LOG_ENTRY_TYPE_OBJ) {
+                materializeObject(lock, candidateRef, candidateBuffer,
+                        buffer);
+            } else {
+                buffer.append(&candidateBuffer);
+            }
             if (outVersion != NULL) {
                 if (type == LOG_ENTRY_TYPE_OBJ) {
-                    Object o(candidateBuffer);
+                    Object o(buffer, offset);
                     *outVersion = o.getVersion();
                 } else {
                     ObjectTombstone o(candidateBuffer);
@@ -2738,6 +4971,141 @@ ObjectManager::lookup(HashTableBucketLock& lock, Key& key,
     return false;
 }
 
+/**
+ * Return the encoded cluster-time before which snapshots are no longer
+ * served: master.snapshotRetentionMs before this master's cluster-time.
+ * Versions superseded before then are forgotten (see #versionHistory).
+ */
+uint64_t
+ObjectManager::getHistoryLowWater()
+{
+    if (!retainsVersions())
+        return 0;
+    uint64_t now = clusterClock->getTime().getEncoded();
+    uint64_t retention = ClusterTimeDuration::fromNanoseconds(
+            int64_t(config->master.snapshotRetentionMs) * 1000000)
+            .toNanoseconds();
+    return (now > retention) ? now - retention : 0;
+}
+
+/**
+ * Return true if a snapshot taken at the given time can't be served by this
+ * master, because old versions aren't retained at all, or not for that long.
+ *
+ * \param snapshotTime
+ *      Encoded cluster-time at which the snapshot was taken.
+ */
+bool
+ObjectManager::isSnapshotTooOld(uint64_t snapshotTime)
+{
+    return !retainsVersions() ||
+            snapshotTime < getHistoryLowWater() ||
+            snapshotTime < historyStart.getTime().getEncoded();
+}
+
+/**
+ * Record in #versionHistory that the current version of an object has just
+ * been superseded, and forget (freeing them from the log) the versions of
+ * other objects covered by the same lock that no snapshot can see any more.
+ * Does nothing unless retainsVersions().
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held.
+ * \param key
+ *      Key of the object.
+ * \param reference
+ *      Log reference of the superseded version, which must no longer be in
+ *      the hash table and mustn't be freed by the caller; or one of
+ *      VersionHistory::NO_OBJECT and VersionHistory::NOT_RETAINED.
+ * \param commitTime
+ *      Encoded cluster-time at which the change becomes visible; 0 means
+ *      now (see stampVersion()).
+ */
+void
+ObjectManager::recordVersion(HashTableBucketLock& lock, Key& key,
+                uint64_t reference, uint64_t commitTime)
+{
+    if (!retainsVersions())
+        return;
+    VersionHistory& history = versionHistory[lock.getIndex()];
+    uint64_t stamp = stampVersion(commitTime);
+
+    // Changes to a key are stamped in order, even if a transaction's commit
+    // time was chosen before an earlier change was made here.
+    uint64_t lastChange = history.getLastChange(key.getHash());
+    if (stamp < lastChange)
+        stamp = lastChange;
+    history.record(key.getHash(), reference, stamp);
+
+    std::vector<uint64_t> freed;
+    history.prune(getHistoryLowWater(), &freed);
+    foreach (uint64_t oldReference, freed)
+        log.free(Log::Reference(oldReference));
+}
+
+/**
+ * Called when the current version of an object is superseded (by a new
+ * version or a removal) to keep the old version for snapshot reads, if
+ * versions are retained at all; see recordVersion().
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held.
+ * \param key
+ *      Key of the object.
+ * \param oldReference
+ *      Log reference of the superseded version; NULL if the key didn't have
+ *      an object before.
+ * \param commitTime
+ *      Encoded cluster-time at which the change becomes visible; 0 means
+ *      now.
+ * \return
+ *      True if the old version is kept, in which case the caller must not
+ *      free it; false if the caller must free it as usual.
+ */
+bool
+ObjectManager::retainVersion(HashTableBucketLock& lock, Key& key,
+                Log::Reference* oldReference, uint64_t commitTime)
+{
+    if (!retainsVersions())
+        return false;
+    if (oldReference == NULL) {
+        recordVersion(lock, key, VersionHistory::NO_OBJECT, commitTime);
+        return false;
+    }
+
+    // An object with deltas isn't one log entry, and its deltas are freed
+    // along with it; it isn't worth keeping track of them for snapshots.
+    if (findDeltaChain(lock, *oldReference) != NULL) {
+        recordVersion(lock, key, VersionHistory::NOT_RETAINED, commitTime);
+        return false;
+    }
+    recordVersion(lock, key, oldReference->toInteger(), commitTime);
+    return true;
+}
+
+/**
+ * Choose the cluster-time at which a change to an object becomes visible to
+ * snapshot reads, and make sure this master's cluster-time doesn't fall
+ * behind it (so later snapshots see the change).
+ *
+ * \param commitTime
+ *      Encoded commit time of the transaction making the change, or 0 for a
+ *      change that isn't part of a distributed transaction; such changes
+ *      are stamped just after this master's cluster-time.
+ * \return
+ *      The encoded time to record the change with.
+ */
+uint64_t
+ObjectManager::stampVersion(uint64_t commitTime)
+{
+    if (commitTime == 0)
+        commitTime = clusterClock->getTime().getEncoded() + 1;
+    clusterClock->updateClock(ClusterTime(commitTime));
+    return commitTime;
+}
+
 /**
  * Remove an object from the hash table, if it exists in it. Return whether or
  * not it was found and removed.
@@ -2763,7 +5131,9 @@ ObjectManager::remove(HashTableBucketLock& lock, Key& key)
         LogEntryType type = log.getEntry(candidateRef, buffer);
         Key candidateKey(type, buffer);
         if (key == candidateKey) {
+            invalidateRemoteRead(lock, key);
             candidates.remove();
+            orderedKeys.erase(key);
             return true;
         }
         candidates.next();
@@ -2771,6 +5141,40 @@ ObjectManager::remove(HashTableBucketLock& lock, Key& key)
     return false;
 }
 
+/**
+ * Adds the key of an object to #orderedKeys; used by buildOrderedKeys.
+ *
+ * \param key
+ *      Key of an object, on callback from forEachObjectInTable().
+ * \param cookie
+ *      Pointer to the OrderedKeyIndex to add the key to.
+ */
+void
+ObjectManager::addOrderedKey(Key& key, void* cookie)
+{
+    static_cast<OrderedKeyIndex*>(cookie)->insert(key);
+}
+
+/**
+ * Start keeping the primary keys of a table in #orderedKeys, and add the
+ * keys of the table's objects that are already in the hash table. Returns
+ * once the index can be used for scans.
+ *
+ * \param tableId
+ *      Identifier of the table.
+ */
+void
+ObjectManager::buildOrderedKeys(uint64_t tableId)
+{
+    std::lock_guard<std::mutex> _(orderedKeysBuildMutex);
+    if (orderedKeys.isReady(tableId))
+        return;
+    LOG(NOTICE, "Building ordered key index for table %lu", tableId);
+    orderedKeys.startBuilding(tableId);
+    forEachObjectInTable(tableId, addOrderedKey, &orderedKeys);
+    orderedKeys.finishBuilding(tableId);
+}
+
 /**
  * Removes an object from the hash table and frees it from the log if
  * it belongs to a tablet that doesn't exist in the master's TabletManager.
@@ -2802,10 +5206,37 @@ ObjectManager::removeIfOrphanedObject(uint64_t reference, void *cookie)
         TEST_LOG("removing orphaned object at ref %lu", reference);
         bool r = objectManager->remove(*params->lock, key);
         assert(r);
-        objectManager->log.free(Log::Reference(reference));
+        objectManager->freeObject(*params->lock, Log::Reference(reference),
+                &objectManager->log);
     }
 }
 
+/**
+ * Passes the key of an object to the callback given to forEachObjectInTable
+ * if the object belongs to the table being scanned.
+ *
+ * \param reference
+ *      Reference into the log for an entry, on callback from
+ *      objectMap->forEachInBucket().
+ * \param cookie
+ *      Pointer to the TableScanParameters of the scan.
+ */
+void
+ObjectManager::visitObjectInTable(uint64_t reference, void *cookie)
+{
+    TableScanParameters* params =
+            reinterpret_cast<TableScanParameters*>(cookie);
+    Buffer buffer;
+    LogEntryType type = params->objectManager->log.getEntry(
+            Log::Reference(reference), buffer);
+    if (type != LOG_ENTRY_TYPE_OBJ)
+        return;
+
+    Key key(type, buffer);
+    if (key.getTableId() == params->tableId)
+        params->callback(key, params->cookie);
+}
+
 /**
  * This function is a callback used to purge the tombstones from the hash
  * table after a recovery has taken place. It is invoked by HashTable::
@@ -2845,6 +5276,9 @@ ObjectManager::removeIfTombstone(uint64_t maybeTomb, void *cookie)
             TEST_LOG("discarding");
             bool r = objectManager->remove(*params->lock, key);
             assert(r);
+        } else {
+            // Try again after the next recovery.
+            objectManager->recordReplayedTombstone(*params->lock, key);
         }
 
         // Tombstones are not explicitly freed in the log. The cleaner will
@@ -2861,13 +5295,57 @@ ObjectManager::removeIfTombstone(uint64_t maybeTomb, void *cookie)
 void
 ObjectManager::removeTombstones()
 {
-    for (uint64_t i = 0; i < objectMap.getNumBuckets(); i++) {
+    for (uint64_t i = 0; i < getNumBucketLocksInUse(); i++) {
         HashTableBucketLock lock(*this, i);
-        CleanupParameters params = { this , &lock };
-        objectMap.forEachInBucket(removeIfTombstone, &params, i);
+        std::vector<KeyHash> keyHashes;
+        keyHashes.swap(replayedTombstones[lock.getIndex()]);
+        foreach (KeyHash keyHash, keyHashes)
+            removeReplayedTombstones(lock, keyHash);
+        discardPendingDeltas(lock);
     }
 }
 
+/**
+ * Note that replaySegment() has just put a tombstone into #objectMap, so
+ * that the bucket holding it is visited when tombstones are removed once
+ * replay is over.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held.
+ * \param key
+ *      Key of the tombstone.
+ */
+void
+ObjectManager::recordReplayedTombstone(HashTableBucketLock& lock, Key& key)
+{
+    replayedTombstones[lock.getIndex()].push_back(key.getHash());
+}
+
+/**
+ * Remove the tombstones that are no longer needed from the #objectMap bucket
+ * a key hash recorded by recordReplayedTombstone() maps to (see
+ * removeIfTombstone()). Tombstones that must be kept are recorded again.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held.
+ * \param keyHash
+ *      Key hash of a replayed tombstone.
+ */
+void
+ObjectManager::removeReplayedTombstones(HashTableBucketLock& lock,
+        KeyHash keyHash)
+{
+    // The table can't finish growing while the lock is held, so this bucket
+    // index is good until we're done with it.
+    uint64_t secondaryHash;
+    uint64_t bucket = HashTable::findBucketIndex(objectMap.getNumBuckets(),
+            keyHash, &secondaryHash);
+    CleanupParameters params = { this , &lock };
+    objectMap.forEachInBucket(removeIfTombstone, &params, bucket);
+}
+
 /**
  * Check a set of RejectRules against the current state of an object
  * to decide whether an operation is allowed.
@@ -2906,7 +5384,10 @@ ObjectManager::rejectOperation(const RejectRules* rejectRules, uint64_t version)
  *
  * This callback will decide if the object is still alive. If it is, it must
  * use the relocator to move it to a new location and atomically update the
- * hash table.
+ * hash table. A live object with deltas is instead rewritten with its deltas
+ * folded in (see compactObject()), which is how delta chains get compacted.
+ * Objects whose expiry time has passed are removed from the hash table
+ * instead, so the cleaner reclaims them without anyone removing them.
  *
  * \param oldBuffer
  *      Buffer pointing to the object's current location, which will soon be
@@ -2928,41 +5409,150 @@ ObjectManager::relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
                 LogEntryRelocator& relocator)
 {
     Key key(LOG_ENTRY_TYPE_OBJ, oldBuffer);
+    Log::Reference compactedReference;
+    {
+        HashTableBucketLock lock(*this, key);
+
+        // Note that we do not query the TabletManager to see if this object
+        // belongs to a live tablet since that would create considerable
+        // contention for the TabletManager. We can do this safely because
+        // tablet drops synchronously purge the hash table of any objects
+        // corresponding to the tablet. Were we not to purge the objects,
+        // we could migrate a tablet away and back again while maintaining
+        // references to old objects (that could have been deleted on the
+        // intermediate master before migrating back).
+
+        // It's much faster not to use lookup and replace here, but to
+        // scan the hash table bucket ourselves. We already have the
+        // reference, so there's no need for a key comparison, and we
+        // can easily avoid looping over the bucket twice this way for
+        // live objects.
+        HashTable::Candidates candidates;
+        objectMap.lookup(key.getHash(), candidates);
+        while (!candidates.isDone()) {
+            if (candidates.getReference() != oldReference.toInteger()) {
+                candidates.next();
+                continue;
+            }
+
+            // An expired object is dropped rather than moved. It needs no
+            // tombstone: it goes away with the segment being cleaned, and
+            // any older versions of it already have tombstones. Objects
+            // locked by a transaction are kept until it finishes.
+            std::vector<uint64_t>* chain = findDeltaChain(lock, oldReference);
+            Object object(oldBuffer);
+            if (object.isExpired(WallTime::secondsTimestamp()) &&
+                    !lockTable.isLockAcquired(key)) {
+                // Each delta added one to the version.
+                uint64_t version = object.getVersion() +
+                        (chain != NULL ? chain->size() : 0);
+                invalidateRemoteRead(lock, key);
+                freeDeltaChain(lock, oldReference, &log);
+                candidates.remove();
+                segmentManager.raiseSafeVersion(version + 1);
+                TableStats::decrement(masterTableMetadata,
+                                      key.getTableId(),
+                                      oldBuffer.size(),
+                                      1);
+                TEST_LOG("dropped expired object, version %lu", version);
+                return;
+            }
+
+            // An object with deltas is rewritten with the deltas folded in,
+            // if there is room at the head of the log.
+            if (chain != NULL && compactObject(lock, key, oldBuffer,
+                    oldReference, candidates, &compactedReference)) {
+                break;
+            }
+
+            // Try to relocate this live object. If we fail, just return. The
+            // cleaner will allocate more memory and retry.
+            if (!relocator.append(LOG_ENTRY_TYPE_OBJ, oldBuffer))
+                return;
+            TableUsageStats::recordCleanerBytes(key.getTableId(),
+                    oldBuffer.size());
+
+            invalidateRemoteRead(lock, key);
+            uint64_t newReference = relocator.getNewReference().toInteger();
+            candidates.setReference(newReference);
+            if (chain != NULL) {
+                ObjectDeltas& deltas = objectDeltas[lock.getIndex()];
+                std::vector<uint64_t> deltaReferences;
+                deltaReferences.swap(*chain);
+                deltas.chains.erase(oldReference.toInteger());
+                deltas.chains[newReference].swap(deltaReferences);
+            }
+            return;
+        }
+
+        if (candidates.isDone()) {
+            // An old version kept for snapshots isn't moved (the tombstone
+            // that follows it may not outlive this segment), so snapshots
+            // can no longer read it.
+            VersionHistory& history = versionHistory[lock.getIndex()];
+            if (history.size() > 0 && history.discard(key.getHash(),
+                    oldReference.toInteger())) {
+                TEST_LOG("discarded retained version");
+            }
+
+            // No reference was found meaning object will be cleaned.  We
+            // should update the stats accordingly.
+            TableStats::decrement(masterTableMetadata,
+                                  key.getTableId(),
+                                  oldBuffer.size(),
+                                  1);
+            return;
+        }
+    }
+
+    // The cleaner drops the old object once the segments it relocated
+    // entries to are durable; the compacted copy went to the head of the
+    // log instead, so it must be made durable here.
+    log.syncTo(compactedReference);
+}
+
+/**
+ * Callback used by the LogCleaner when it's cleaning a Segment and comes
+ * across an ObjectDelta. The delta is alive if it is part of the delta chain
+ * of the object its key refers to; if so, it is relocated and the chain is
+ * updated to point at its new location.
+ *
+ * \param oldBuffer
+ *      Buffer pointing to the delta's current location, which will soon be
+ *      invalidated.
+ * \param oldReference
+ *      Reference to the old delta in the log.
+ * \param relocator
+ *      The relocator may be used to store the delta in a new location if it
+ *      is still alive. If relocation fails, the callback just returns and
+ *      the cleaner will allocate more memory and retry.
+ */
+void
+ObjectManager::relocateObjectDelta(Buffer& oldBuffer,
+                Log::Reference oldReference, LogEntryRelocator& relocator)
+{
+    Key key(LOG_ENTRY_TYPE_OBJDELTA, oldBuffer);
     HashTableBucketLock lock(*this, key);
 
-    // Note that we do not query the TabletManager to see if this object
-    // belongs to a live tablet since that would create considerable
-    // contention for the TabletManager. We can do this safely because
-    // tablet drops synchronously purge the hash table of any objects
-    // corresponding to the tablet. Were we not to purge the objects,
-    // we could migrate a tablet away and back again while maintaining
-    // references to old objects (that could have been deleted on the
-    // intermediate master before migrating back).
-
-    // It's much faster not to use lookup and replace here, but to
-    // scan the hash table bucket ourselves. We already have the
-    // reference, so there's no need for a key comparison, and we
-    // can easily avoid looping over the bucket twice this way for
-    // live objects.
+    // Deltas are relocated as they are; chains are only folded into their
+    // objects when the objects themselves are cleaned (see relocateObject).
     HashTable::Candidates candidates;
     objectMap.lookup(key.getHash(), candidates);
-    while (!candidates.isDone()) {
-        if (candidates.getReference() != oldReference.toInteger()) {
-            candidates.next();
+    for (; !candidates.isDone(); candidates.next()) {
+        Log::Reference candidateRef(candidates.getReference());
+        std::vector<uint64_t>* chain = findDeltaChain(lock, candidateRef);
+        if (chain == NULL)
             continue;
-        }
-
-        // Try to relocate this live object. If we fail, just return. The
-        // cleaner will allocate more memory and retry.
-        if (!relocator.append(LOG_ENTRY_TYPE_OBJ, oldBuffer))
+        foreach (uint64_t& deltaReference, *chain) {
+            if (deltaReference != oldReference.toInteger())
+                continue;
+            if (!relocator.append(LOG_ENTRY_TYPE_OBJDELTA, oldBuffer))
+                return;
+            deltaReference = relocator.getNewReference().toInteger();
             return;
-
-        candidates.setReference(relocator.getNewReference().toInteger());
-        return;
+        }
     }
 
-    // No reference was found meaning object will be cleaned.  We should update
-    // the stats accordingly.
     TableStats::decrement(masterTableMetadata,
                           key.getTableId(),
                           oldBuffer.size(),
@@ -3144,6 +5734,49 @@ ObjectManager::relocatePreparedOpTombstone(Buffer& oldBuffer,
     }
 }
 
+/**
+ * Method used by the LogCleaner when it's cleaning a Segment and comes across
+ * a PreparedOpTombstoneBatch.
+ *
+ * The batch is still alive as long as the segment of any of the PreparedOps
+ * it refers to exists. If it is, it must move the record to a new location.
+ *
+ * \param oldBuffer
+ *      Buffer pointing to the batch's current location, which will soon be
+ *      invalidated.
+ * \param relocator
+ *      The relocator may be used to store the batch in a new location if it
+ *      is still alive. It also provides a reference to the new location and
+ *      keeps track of whether this call wanted the batch anymore or not.
+ *
+ *      It is possible that relocation may fail (because more memory needs to
+ *      be allocated). In this case, the callback should just return. The
+ *      cleaner will note the failure, allocate more memory, and try again.
+ */
+void
+ObjectManager::relocatePreparedOpTombstoneBatch(Buffer& oldBuffer,
+        LogEntryRelocator& relocator)
+{
+    PreparedOpTombstoneBatch batch(oldBuffer);
+
+    foreach (PreparedOpTombstoneBatch::Record& record, batch.records) {
+        if (log.segmentExists(record.segmentId)) {
+            // Try to relocate it. If it fails, just return. The cleaner will
+            // allocate more memory and retry.
+            relocator.append(LOG_ENTRY_TYPE_PREPTOMBBATCH, oldBuffer);
+            return;
+        }
+    }
+
+    // The batch will be dropped/"cleaned" so stats should be updated.
+    if (batch.header.count > 0) {
+        TableStats::decrement(masterTableMetadata,
+                              batch.records[0].tableId,
+                              oldBuffer.size(),
+                              1);
+    }
+}
+
 /**
  * Callback used by the LogCleaner when it's cleaning a Segment and comes
  * across a Tombstone.
@@ -3201,6 +5834,8 @@ ObjectManager::relocateTombstone(Buffer& oldBuffer, Log::Reference oldReference,
         // allocate more memory and retry.
         if (!relocator.append(LOG_ENTRY_TYPE_OBJTOMB, oldBuffer))
             return;
+        TableUsageStats::recordCleanerBytes(tomb.getTableId(),
+                oldBuffer.size());
         if (hashReferenceExists)
             candidates.setReference(relocator.getNewReference().toInteger());
     } else {
@@ -3283,14 +5918,119 @@ ObjectManager::replace(HashTableBucketLock& lock, Key& key,
         LogEntryType type = log.getEntry(candidateRef, buffer);
         Key candidateKey(type, buffer);
         if (key == candidateKey) {
+            invalidateRemoteRead(lock, key);
             candidates.setReference(reference.toInteger());
             return true;
         }
         candidates.next();
     }
 
+    invalidateRemoteRead(lock, key);
     objectMap.insert(key.getHash(), reference.toInteger());
     return false;
 }
 
+/**
+ * Apply deltas replayed by replaySegment() to the object they belong to.
+ * A delta applies to the version of the object one less than its own; the
+ * result is written to the side log as a complete object, so objects never
+ * have delta chains after replay. Deltas replayed before the version they
+ * apply to are kept until it shows up (or replay ends), and deltas older
+ * than the current version are dropped.
+ *
+ * \param lock
+ *      This method must be invoked with the appropriate hash table bucket
+ *      lock already held. This parameter exists to help ensure correct
+ *      caller behaviour.
+ * \param key
+ *      Key of the object.
+ * \param deltaBuffer
+ *      A delta from the segment being replayed, or NULL to just apply any
+ *      kept deltas that fit the current version of the object.
+ * \param sideLog
+ *      Pointer to the SideLog in which replayed data is stored.
+ * \return
+ *      The number of deltas applied.
+ */
+uint32_t
+ObjectManager::replayObjectDeltas(HashTableBucketLock& lock, Key& key,
+                Buffer* deltaBuffer, SideLog* sideLog)
+{
+    ObjectDeltas& deltas = objectDeltas[lock.getIndex()];
+    uint32_t applied = 0;
+    Buffer pendingBuffer;
+    while (1) {
+        LogEntryType currentType;
+        Buffer currentBuffer;
+        Log::Reference currentReference;
+        uint64_t currentVersion = VERSION_NONEXISTENT;
+        bool found = lookup(lock, key, currentType, currentBuffer,
+                &currentVersion, &currentReference);
+        bool currentEntryIsObject = found &&
+                currentType == LOG_ENTRY_TYPE_OBJ;
+
+        if (deltaBuffer == NULL) {
+            if (!currentEntryIsObject)
+                return applied;
+            auto range = deltas.pending.equal_range(key.getHash());
+            auto it = range.first;
+            for (; it != range.second; ++it) {
+                Buffer buffer;
+                buffer.appendExternal(it->second.data(),
+                        downCast<uint32_t>(it->second.size()));
+                ObjectDelta delta(buffer);
+                Key deltaKey(LOG_ENTRY_TYPE_OBJDELTA, buffer);
+                if (deltaKey == key && delta.getVersion() == currentVersion + 1)
+                    break;
+            }
+            if (it == range.second)
+                return applied;
+            pendingBuffer.reset();
+            pendingBuffer.appendCopy(it->second.data(),
+                    downCast<uint32_t>(it->second.size()));
+            deltas.pending.erase(it);
+            deltaBuffer = &pendingBuffer;
+        }
+
+        ObjectDelta delta(*deltaBuffer);
+        if (found && currentVersion >= delta.getVersion())
+            return applied;
+        if (!currentEntryIsObject || currentVersion + 1 != delta.getVersion()) {
+            uint32_t length = deltaBuffer->size();
+            deltas.pending.emplace(key.getHash(), string(
+                    static_cast<const char*>(deltaBuffer->getRange(0, length)),
+                    length));
+            return applied;
+        }
+
+        Object current(currentBuffer);
+        Buffer expanded;
+        current.decompressValue(expanded);
+        Buffer keysAndValue;
+        current.appendKeysAndValueToBuffer(keysAndValue);
+        delta.appendDataToBuffer(keysAndValue);
+        Object object(key.getTableId(), delta.getVersion(),
+                delta.getTimestamp(), keysAndValue);
+        object.setExpiry(current.getExpiry());
+        Buffer objectBuffer;
+        object.assembleForLog(objectBuffer);
+
+        // As when replaying objects, a tombstone keeps the old version from
+        // coming back after another crash.
+        ObjectTombstone tombstone(current, log.getSegmentId(currentReference),
+                WallTime::secondsTimestamp());
+        Buffer tombstoneBuffer;
+        tombstone.assembleForLog(tombstoneBuffer);
+        sideLog->append(LOG_ENTRY_TYPE_OBJTOMB, tombstoneBuffer);
+        Log::Reference newReference;
+        sideLog->append(LOG_ENTRY_TYPE_OBJ, objectBuffer, &newReference);
+        TableStats::increment(masterTableMetadata, key.getTableId(),
+                tombstoneBuffer.size() + objectBuffer.size(), 2);
+        freeObject(lock, currentReference, sideLog);
+        replace(lock, key, newReference);
+        applied++;
+        deltaBuffer = NULL;
+    }
+}
+
 } //enamespace RAMCloud
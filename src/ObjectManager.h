@@ -17,16 +17,20 @@
 #define RAMCLOUD_OBJECTMANAGER_H
 
 #include "Common.h"
+#include "ClusterClock.h"
 #include "Log.h"
 #include "SideLog.h"
 #include "LogEntryHandlers.h"
+#include "LogHealthMonitor.h"
 #include "HashTable.h"
 #include "IndexKey.h"
 #include "Object.h"
+#include "OrderedKeyIndex.h"
 #include "ParticipantList.h"
 #include "PreparedOp.h"
 #include "SegmentManager.h"
 #include "SegmentIterator.h"
+#include "RemoteReadTable.h"
 #include "ReplicaManager.h"
 #include "RpcResult.h"
 #include "ServerConfig.h"
@@ -37,6 +41,8 @@
 #include "TxRecoveryManager.h"
 #include "MasterTableMetadata.h"
 #include "UnackedRpcResults.h"
+#include "VersionHistory.h"
+#include "WriteAdmission.h"
 #include "LockTable.h"
 
 namespace RAMCloud {
@@ -64,7 +70,8 @@ class ObjectManager : public LogEntryHandlers,
                 MasterTableMetadata* masterTableMetadata,
                 UnackedRpcResults* unackedRpcResults,
                 TransactionManager* transactionManager,
-                TxRecoveryManager* txRecoveryManager);
+                TxRecoveryManager* txRecoveryManager,
+                ClusterClock* clusterClock = NULL);
     virtual ~ObjectManager();
     virtual void freeLogEntry(Log::Reference ref);
     void initOnceEnlisted();
@@ -73,36 +80,87 @@ class ObjectManager : public LogEntryHandlers,
                 Buffer* pKHashes, uint32_t initialPKHashesOffset,
                 uint32_t maxLength, Buffer* response, uint32_t* respNumHashes,
                 uint32_t* numObjects);
+    bool readLogChanges(uint64_t tableId, LogPosition* position,
+                Buffer* changes, uint32_t maxBytes);
     void prefetchHashTableBucket(SegmentIterator* it);
+    Status appendObject(Key& key, Buffer* data, uint32_t dataOffset,
+                uint32_t dataLength, RejectRules* rejectRules,
+                uint64_t* outVersion, RpcResult* rpcResult = NULL,
+                uint64_t* rpcResultPtr = NULL);
+    void getObjectEntry(Log::Reference reference, Buffer& buffer);
+    Status patchObject(Key& key, uint32_t offset, Buffer* data,
+                uint32_t dataOffset, uint32_t dataLength,
+                RejectRules* rejectRules, uint64_t* outVersion,
+                RpcResult* rpcResult = NULL, uint64_t* rpcResultPtr = NULL);
     Status readObject(Key& key, Buffer* outBuffer,
                 RejectRules* rejectRules, uint64_t* outVersion,
+                bool valueOnly = false,
+                RemoteReadTable::Hint* remoteReadHint = NULL);
+    Status readSnapshotObject(Key& key, uint64_t snapshotTime,
+                Buffer* outBuffer, uint64_t* outVersion,
+                bool valueOnly = false);
+    Status readRecoveringObject(Key& key, Buffer* outBuffer,
+                RejectRules* rejectRules, uint64_t* outVersion);
+    void readObjects(uint32_t numObjects, Key* keys[],
+                RejectRules* rejectRules, Buffer* outBuffers,
+                uint64_t* outVersions, Status* outStatuses,
                 bool valueOnly = false);
     Status removeObject(Key& key, RejectRules* rejectRules,
                 uint64_t* outVersion, Buffer* removedObjBuffer = NULL,
                 RpcResult* rpcResult = NULL, uint64_t* rpcResultPtr = NULL);
     void removeOrphanedObjects();
+    void invalidateRemoteReads();
+    bool scanObjects(uint64_t tableId, const void* startKey,
+                KeyLength startKeyLength, const void* endKey,
+                KeyLength endKeyLength, uint32_t maxObjects,
+                uint32_t maxBytes, Buffer* response, uint32_t* numObjects);
+
+    /// Signature of the callbacks passed to forEachObjectInTable.
+    typedef void (*ObjectCallback)(Key& key, void* cookie);
+    void forEachObjectInTable(uint64_t tableId, ObjectCallback callback,
+                void* cookie);
+    void raiseSafeVersion(uint64_t minimum);
+    struct ReplayPartition;
     void replaySegment(SideLog* sideLog, SegmentIterator& it,
-                std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap);
+                std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap,
+                const ReplayPartition* partition = NULL);
     void replaySegment(SideLog* sideLog, SegmentIterator& it);
-    void syncChanges();
+    void syncChanges(uint32_t minReplicas = ~0u);
     Status writeObject(Object& newObject, RejectRules* rejectRules,
                 uint64_t* outVersion, Buffer* removedObjBuffer = NULL,
                 RpcResult* rpcResult = NULL, uint64_t* rpcResultPtr = NULL);
+    Status writeObject(Object& newObject, RejectRules* rejectRules,
+                uint64_t* outVersion, Buffer* removedObjBuffer,
+                uint32_t numRpcResults, RpcResult* rpcResults[],
+                uint64_t rpcResultPtrs[]);
+    void writeObjects(uint32_t numObjects, Object* objects[],
+                RejectRules* rejectRules, uint64_t* outVersions,
+                Buffer* removedObjBuffers, Status* outStatuses);
     bool keyPointsAtReference(Key& k, AbstractLog::Reference oldReference);
     void writePrepareFail(RpcResult* rpcResult, uint64_t* rpcResultPtr);
     void writeRpcResultOnly(RpcResult* rpcResult, uint64_t* rpcResultPtr);
     Status prepareOp(PreparedOp& newOp, RejectRules* rejectRules,
                 uint64_t* newOpPtr, bool* isCommitVote,
-                RpcResult* rpcResult, uint64_t* rpcResultPtr);
-    Status prepareReadOnly(PreparedOp& newOp, RejectRules* rejectRules,
+                RpcResult* rpcResult, uint64_t* rpcResultPtr,
+                uint64_t snapshotTime = 0);
+    Status validateReadOnly(Key& key, RejectRules* rejectRules,
                 bool* isCommitVote);
     Status tryGrabTxLock(Object& objToLock, Log::Reference& ref);
     Status writeTxDecisionRecord(TxDecisionRecord& record);
     Status commitRead(PreparedOp& op, Log::Reference& refToPreparedOp);
     Status commitRemove(PreparedOp& op, Log::Reference& refToPreparedOp,
-                        Buffer* removedObjBuffer = NULL);
+                        Buffer* removedObjBuffer = NULL,
+                        uint64_t commitTime = 0);
     Status commitWrite(PreparedOp& op, Log::Reference& refToPreparedOp,
-                        Buffer* removedObjBuffer = NULL);
+                        Buffer* removedObjBuffer = NULL,
+                        uint64_t commitTime = 0);
+    Status commitPreparedOps(uint32_t numOps, PreparedOp* ops[],
+                Log::Reference refsToPreparedOps[], bool commit,
+                uint64_t commitTime = 0);
+    Status commitTransaction(uint32_t numOps, PreparedOp* ops[],
+                RejectRules* rejectRules, RpcResult* rpcResults[],
+                uint64_t* rpcResultPtrs, bool* isCommitted,
+                uint64_t snapshotTime = 0);
 
     /**
      * The following three methods are used when multiple log entries
@@ -115,13 +173,22 @@ class ObjectManager : public LogEntryHandlers,
     Status writeTombstone(Key& key, Buffer *logBuffer);
 
     /**
-     * The following two methods are used by the log cleaner. They aren't
+     * The following three methods are used by the log cleaner. They aren't
      * intended to be called from any other modules.
      */
     uint32_t getTimestamp(LogEntryType type, Buffer& buffer);
+    void prefetchEntry(LogEntryType type, Buffer& buffer);
     void relocate(LogEntryType type, Buffer& oldBuffer,
                 Log::Reference oldReference, LogEntryRelocator& relocator);
 
+    /**
+     * Suggested maximum number of objects to pass to readObjects() and
+     * writeObjects() at once. Larger batches work, but the cache lines
+     * prefetched for the first objects are increasingly likely to have been
+     * evicted by the time they are used.
+     */
+    static const uint32_t MAX_PREFETCH_BATCH = 16;
+
     /**
      * The following methods exist because our current abstraction doesn't quite
      * cut it in terms of hiding object storage information from MasterService.
@@ -131,6 +198,7 @@ class ObjectManager : public LogEntryHandlers,
      * If you're considering using these methods, please think twice.
      */
     Log* getLog() { return &log; }
+    LogHealthMonitor* getLogHealthMonitor() { return &logHealthMonitor; }
     ReplicaManager* getReplicaManager() { return &replicaManager; }
     HashTable* getObjectMap() { return &objectMap; }
 
@@ -154,6 +222,50 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneProtector);
     };
 
+    /**
+     * Selects the part of a recovery segment that one of several concurrent
+     * replaySegment() calls on the same segment should replay (see
+     * ParallelSegmentReplay). Objects and tombstones are split up by the
+     * hash table bucket their key falls in, so each partition only ever
+     * takes its own range of HashTableBucketLocks and every version of a key
+     * lands in the same SideLog. All other entries (safe versions, rpc
+     * results, transaction records) are replayed by partition 0 alone,
+     * which preserves their relative order.
+     */
+    struct ReplayPartition {
+        /**
+         * \param numBuckets
+         *      Number of buckets in the hash table when replay started.
+         *      Must be the same for all partitions. The ranges stay disjoint
+         *      even if the hash table grows in the meantime, since growing
+         *      only splits each bucket in two.
+         * \param index
+         *      Which of the \a count partitions this is.
+         * \param count
+         *      Total number of partitions the segment is being split into.
+         */
+        ReplayPartition(uint64_t numBuckets, uint32_t index, uint32_t count)
+            : numBuckets(numBuckets)
+            , firstBucket(numBuckets * index / count)
+            , endBucket(numBuckets * (index + 1) / count)
+            , ownsOtherEntries(index == 0)
+        {}
+
+        bool owns(SegmentIterator& it, LogEntryType type) const;
+
+        /// Hash table size used to map keys to buckets.
+        uint64_t numBuckets;
+
+        /// First bucket whose objects and tombstones belong to this partition.
+        uint64_t firstBucket;
+
+        /// One past the last bucket that belongs to this partition.
+        uint64_t endBucket;
+
+        /// True if entries without a key are replayed by this partition.
+        bool ownsOtherEntries;
+    };
+
   PRIVATE:
     /**
      * An instance of this class locks the bucket of the hash table that a given
@@ -178,6 +290,7 @@ class ObjectManager : public LogEntryHandlers,
          */
         HashTableBucketLock(ObjectManager& objectManager, Key& key)
             : lock(NULL)
+            , index(0)
         {
             uint64_t unused;
             uint64_t bucket = HashTable::findBucketIndex(
@@ -197,6 +310,7 @@ class ObjectManager : public LogEntryHandlers,
          */
         HashTableBucketLock(ObjectManager& objectManager, uint64_t bucket)
             : lock(NULL)
+            , index(0)
         {
             takeBucketLock(objectManager, bucket);
         }
@@ -206,6 +320,10 @@ class ObjectManager : public LogEntryHandlers,
             lock->unlock();
         }
 
+        /// Return the index of the lock held in
+        /// ObjectManager::hashTableBucketLocks.
+        uint64_t getIndex() const { return index; }
+
       PRIVATE:
         /**
          * Helper method that actually acquires the appropriate bucket lock.
@@ -220,10 +338,8 @@ class ObjectManager : public LogEntryHandlers,
         takeBucketLock(ObjectManager& objectManager, uint64_t bucket)
         {
             assert(lock == NULL);
-            uint32_t numLocks = arrayLength(objectManager.hashTableBucketLocks);
-            assert(BitOps::isPowerOfTwo(numLocks));
-            uint64_t lockIndex = bucket & (numLocks - 1);
-            lock = &objectManager.hashTableBucketLocks[lockIndex];
+            index = objectManager.getBucketLockIndex(bucket);
+            lock = &objectManager.hashTableBucketLocks[index];
             lock->lock();
         }
 
@@ -231,6 +347,9 @@ class ObjectManager : public LogEntryHandlers,
         /// constructor and will release in the destructor.
         SpinLock* lock;
 
+        /// Index of #lock in ObjectManager::hashTableBucketLocks.
+        uint64_t index;
+
         DISALLOW_COPY_AND_ASSIGN(HashTableBucketLock);
     };
 
@@ -248,9 +367,29 @@ class ObjectManager : public LogEntryHandlers,
         ObjectManager::HashTableBucketLock* lock;
     };
 
+    /**
+     * Struct used to pass parameters into visitObjectInTable through the
+     * generic HashTable::forEachInBucket method.
+     */
+    struct TableScanParameters {
+        /// Pointer to the ObjectManager class owning the hash table.
+        ObjectManager* objectManager;
+
+        /// Only objects in this table are passed to #callback.
+        uint64_t tableId;
+
+        /// Invoked for each live object in the table.
+        ObjectCallback callback;
+
+        /// Passed to #callback.
+        void* cookie;
+    };
+
     /**
      * This object executes in the background (as a WorkerTimer) to remove
-     * tombstones that were added to the objectMap by replaySegment().
+     * tombstones that were added to the objectMap by replaySegment(). It only
+     * visits the buckets listed in #replayedTombstones, rather than the whole
+     * hash table.
      */
     class TombstoneRemover : public WorkerTimer {
       public:
@@ -259,8 +398,18 @@ class ObjectManager : public LogEntryHandlers,
         void handleTimerEvent();
 
       PRIVATE:
-        /// Which bucket of #objectMap should be cleaned out next.
-        uint64_t currentBucket;
+        /// Index of the entry in #replayedTombstones (and so of the bucket
+        /// lock) being worked on.
+        uint64_t currentStripe;
+
+        /// How many of the key hashes recorded for #currentStripe have been
+        /// handled so far.
+        size_t currentKeyHash;
+
+        /// Number of key hashes that were recorded for #currentStripe when
+        /// work on it started. Any recorded after that (for tombstones that
+        /// could not be removed yet) are left for the next sweep.
+        size_t stripeEnd;
 
         /// The ObjectManager that owns the hash table to remove tombstones
         /// from in the #recoveryCleanup callback.
@@ -274,8 +423,60 @@ class ObjectManager : public LogEntryHandlers,
         DISALLOW_COPY_AND_ASSIGN(TombstoneRemover);
     };
 
+    /**
+     * State kept for the objects covered by one of #hashTableBucketLocks
+     * that have had data appended to them (see appendObject()). Each
+     * instance may only be accessed with the corresponding lock held.
+     */
+    struct ObjectDeltas {
+        ObjectDeltas()
+            : chains()
+            , pending()
+        {}
+
+        /// References of the ObjectDelta entries that apply to each object,
+        /// oldest first, indexed by the reference of the object entry that
+        /// #objectMap points at. Objects without deltas have no chain.
+        std::unordered_map<uint64_t, std::vector<uint64_t>> chains;
+
+        /// Copies of deltas that replaySegment() came across before the
+        /// version of the object they apply to, indexed by key hash. They
+        /// are discarded once replay is over (see discardPendingDeltas()).
+        std::unordered_multimap<KeyHash, string> pending;
+    };
+
+    /**
+     * An object's data is appended as a delta entry only while it has
+     * fewer than this many deltas; the next append rewrites the whole object
+     * instead, so that reading an object never has to gather more than this
+     * many pieces. The cleaner also folds an object's deltas back into it
+     * when it relocates the object.
+     */
+    static const uint32_t MAX_OBJECT_DELTAS = 16;
+
+    /**
+     * Maximum number of hash table buckets migrated by each syncChanges()
+     * call while #objectMap is being resized.
+     */
+    static const uint64_t HASH_TABLE_BUCKETS_PER_SYNC = 8;
+
+    /**
+     * Number of bytes prefetched at the start of each candidate log entry
+     * by prefetchObjects(): enough for the entry and object headers and a
+     * short key, which is what the key comparison in lookup() touches.
+     */
+    static const uint32_t PREFETCH_LOG_ENTRY_BYTES = 128;
+
     static string dumpSegment(Segment* segment);
+    void prefetchObjects(uint32_t numKeys, Key* keys[]);
+    static void addOrderedKey(Key& key, void* cookie);
+    void buildOrderedKeys(uint64_t tableId);
+    uint64_t getBucketLockIndex(uint64_t bucket);
+    uint64_t getNumBucketLocksInUse();
+    static KeyHash getKeyHashForReference(uint64_t reference, void* cookie);
+    void growHashTable(uint64_t maxBuckets);
     uint32_t getObjectTimestamp(Buffer& buffer);
+    uint32_t getObjectDeltaTimestamp(Buffer& buffer);
     uint32_t getTombstoneTimestamp(Buffer& buffer);
     uint32_t getTxDecisionRecordTimestamp(Buffer& buffer);
     bool lookup(HashTableBucketLock& lock, Key& key,
@@ -284,24 +485,80 @@ class ObjectManager : public LogEntryHandlers,
                 Log::Reference* outReference = NULL,
                 HashTable::Candidates* outCandidates = NULL);
     friend void recoveryCleanup(uint64_t maybeTomb, void *cookie);
+    void assembleObjectForLog(Object& object, Buffer& buffer);
+    bool compactObject(HashTableBucketLock& lock, Key& key,
+                Buffer& oldBuffer, Log::Reference oldReference,
+                HashTable::Candidates& candidates,
+                Log::Reference* newReference);
+    void discardPendingDeltas(HashTableBucketLock& lock);
+    std::vector<uint64_t>* findDeltaChain(HashTableBucketLock& lock,
+                Log::Reference reference);
+    uint32_t freeDeltaChain(HashTableBucketLock& lock,
+                Log::Reference reference, AbstractLog* fromLog);
+    void freeObject(HashTableBucketLock& lock, Log::Reference reference,
+                AbstractLog* fromLog);
+    void materializeObject(HashTableBucketLock& lock,
+                Log::Reference reference, Buffer& entryBuffer,
+                Buffer& buffer);
+    void appendObjectWithDeltas(Buffer& entryBuffer,
+                const std::vector<uint64_t>& chain, Buffer& buffer);
+    void saveInlineValue(HashTableBucketLock& lock,
+                HashTable::InlineValue& inlineValue, Key& key, Object& object,
+                Log::Reference reference, uint64_t version);
+
+    /**
+     * Keep clients from reading an object remotely at its current location;
+     * see RemoteReadTable::invalidate.
+     */
+    void invalidateRemoteRead(HashTableBucketLock& lock, Key& key)
+    {
+        if (remoteReadTable)
+            remoteReadTable->invalidate(key);
+    }
+
+    /**
+     * Return true if this master keeps superseded versions of objects for
+     * snapshot reads; see #versionHistory.
+     */
+    bool retainsVersions() const
+    {
+        return clusterClock != NULL && config->master.snapshotRetentionMs > 0;
+    }
+
+    uint64_t getHistoryLowWater();
+    bool isSnapshotTooOld(uint64_t snapshotTime);
+    void recordVersion(HashTableBucketLock& lock, Key& key,
+                uint64_t reference, uint64_t commitTime = 0);
+    bool retainVersion(HashTableBucketLock& lock, Key& key,
+                Log::Reference* oldReference, uint64_t commitTime = 0);
+    uint64_t stampVersion(uint64_t commitTime);
     bool remove(HashTableBucketLock& lock, Key& key);
     static void removeIfOrphanedObject(uint64_t reference, void *cookie);
     static void removeIfTombstone(uint64_t maybeTomb, void *cookie);
+    static void visitObjectInTable(uint64_t reference, void *cookie);
     void removeTombstones();
+    void recordReplayedTombstone(HashTableBucketLock& lock, Key& key);
+    void removeReplayedTombstones(HashTableBucketLock& lock, KeyHash keyHash);
     Status rejectOperation(const RejectRules* rejectRules, uint64_t version)
                 __attribute__((warn_unused_result));
     void relocateObject(Buffer& oldBuffer, Log::Reference oldReference,
                 LogEntryRelocator& relocator);
+    void relocateObjectDelta(Buffer& oldBuffer, Log::Reference oldReference,
+                LogEntryRelocator& relocator);
     void relocatePreparedOp(Buffer& oldBuffer, Log::Reference oldReference,
                 LogEntryRelocator& relocator);
     void relocatePreparedOpTombstone(Buffer& oldBuffer,
                                      LogEntryRelocator& relocator);
+    void relocatePreparedOpTombstoneBatch(Buffer& oldBuffer,
+            LogEntryRelocator& relocator);
     void relocateRpcResult(Buffer& oldBuffer, LogEntryRelocator& relocator);
     void relocateTombstone(Buffer& oldBuffer, Log::Reference oldReference,
             LogEntryRelocator& relocator);
     void relocateTxDecisionRecord(
             Buffer& oldBuffer, LogEntryRelocator& relocator);
     bool replace(HashTableBucketLock& lock, Key& key, Log::Reference reference);
+    uint32_t replayObjectDeltas(HashTableBucketLock& lock, Key& key,
+                Buffer* deltaBuffer, SideLog* sideLog);
 
     /**
      * Shared RAMCloud information.
@@ -369,6 +626,20 @@ class ObjectManager : public LogEntryHandlers,
      */
     Log log;
 
+    /**
+     * Samples the health of #log at regular intervals once the server has
+     * enlisted.
+     */
+    LogHealthMonitor logHealthMonitor;
+
+    /**
+     * Paces writes once log memory is nearly full and enforces table
+     * quotas; see WriteAdmission. Only constructed if
+     * master.writeAdmissionUtilization or master.tableQuotaPercent is
+     * nonzero.
+     */
+    Tub<WriteAdmission> writeAdmission;
+
     /**
      * The (table ID, key, keyLength) to #RAMCloud::Object pointer map for all
      * objects stored on this server. Before accessing objects via the hash
@@ -394,6 +665,63 @@ class ObjectManager : public LogEntryHandlers,
      */
     UnnamedSpinLock hashTableBucketLocks[1024];
 
+    /**
+     * Deltas of the objects covered by each of #hashTableBucketLocks.
+     */
+    ObjectDeltas objectDeltas[1024];
+
+    /**
+     * Key hashes of the tombstones that replaySegment() has put into
+     * #objectMap and that haven't been removed yet, grouped by the index of
+     * the #hashTableBucketLocks lock covering them. Each vector may only be
+     * accessed with the corresponding lock held. This lets the tombstones be
+     * removed after recovery without scanning the whole hash table.
+     */
+    std::vector<KeyHash> replayedTombstones[1024];
+
+    /**
+     * Cluster-time of this master, used to stamp the versions recorded in
+     * #versionHistory and to tell how old a snapshot is. NULL means no
+     * versions are retained (ObjectManagers outside MasterService).
+     */
+    ClusterClock* clusterClock;
+
+    /**
+     * Superseded versions of the objects covered by each of
+     * #hashTableBucketLocks, kept for config->master.snapshotRetentionMs
+     * so that reads can be served from snapshots of the past. Each may only
+     * be accessed with the corresponding lock held.
+     */
+    VersionHistory versionHistory[1024];
+
+    /**
+     * Snapshots taken before this cluster-time can't be served: objects
+     * replayed from a recovery or migration arrive without their history,
+     * so versions they superseded elsewhere are unknown here.
+     */
+    ClusterClock historyStart;
+
+    /**
+     * Serializes the threads that drive an online resize of #objectMap (see
+     * growHashTable()). It is only ever acquired with try_lock: whoever holds
+     * it does the resizing work and everyone else simply moves on.
+     */
+    SpinLock hashTableResizeLock;
+
+    /**
+     * Last LogProtector epoch that an RPC could have been part of when the
+     * most recent resize of #objectMap retired the old bucket array. The old
+     * array is freed once all such RPCs have completed.
+     */
+    uint64_t retiredBucketsEpoch;
+
+    /**
+     * Cycles::rdtsc() time before which growHashTable() won't check again
+     * whether the retired bucket array can be freed. Checking requires the
+     * dispatch lock, so it is rate limited.
+     */
+    uint64_t nextRetiredBucketsCheck;
+
     /**
      * Locks objects during transactions.
      */
@@ -416,8 +744,29 @@ class ObjectManager : public LogEntryHandlers,
      */
     int tombstoneProtectorCount;
 
+    /**
+     * Locates objects for clients that read them with one-sided RDMA;
+     * empty unless config->master.remoteReadSlots is nonzero.
+     */
+    Tub<RemoteReadTable> remoteReadTable;
+
+    /**
+     * The primary keys of the tables that have been scanned, in order (see
+     * scanObjects()). Keys are added and removed with the hash table bucket
+     * lock held, at the same time as the hash table is updated.
+     */
+    OrderedKeyIndex orderedKeys;
+
+    /**
+     * Serializes buildOrderedKeys(), so that a table's keys are only
+     * gathered once and scans wait until they have been.
+     */
+    std::mutex orderedKeysBuildMutex;
+
     friend class CleanerCompactionBenchmark;
+    friend class TableSnapshot;
     friend class ObjectManagerBenchmark;
+    friend class StorageBenchmark;
 
     DISALLOW_COPY_AND_ASSIGN(ObjectManager);
 };
@@ -139,6 +139,32 @@ class ObjectManagerTest : public ::testing::Test,
         return buffer.size();
     }
 
+    /**
+     * Build a properly formatted segment containing a single ObjectDelta.
+     * This segment may be passed directly to the ObjectManager::replaySegment()
+     * routine.
+     */
+    uint32_t
+    buildRecoverySegment(char *segmentBuf, uint64_t segmentCapacity,
+                         ObjectDelta& delta,
+                         SegmentCertificate* outCertificate)
+    {
+        Segment s;
+        Buffer newDeltaBuffer;
+        delta.assembleForLog(newDeltaBuffer);
+        bool success = s.append(LOG_ENTRY_TYPE_OBJDELTA, newDeltaBuffer);
+        EXPECT_TRUE(success);
+        s.close();
+
+        Buffer buffer;
+        s.appendToBuffer(buffer);
+        EXPECT_GE(segmentCapacity, buffer.size());
+        buffer.copy(0, buffer.size(), segmentBuf);
+        s.getAppendedLength(outCertificate);
+
+        return buffer.size();
+    }
+
     /**
      * Build a properly formatted segment containing a single safeVersion.
      * This segment may be passed directly to the ObjectManager::replaySegment()
@@ -346,6 +372,7 @@ class ObjectManagerTest : public ::testing::Test,
         {
             ObjectManager::HashTableBucketLock lock(objectManager, key);
             objectManager.replace(lock, key, reference);
+            objectManager.recordReplayedTombstone(lock, key);
         }
         TableStats::increment(&masterTableMetadata,
                               key.getTableId(),
@@ -439,8 +466,8 @@ class ObjectManagerTest : public ::testing::Test,
         if (entry != NULL) {
             return format("found=true tableId=%lu byteCount=%lu recordCount=%lu"
                        , tableId
-                       , entry->stats.byteCount
-                       , entry->stats.recordCount);
+                       , entry->stats.getByteCount()
+                       , entry->stats.getRecordCount());
 
         } else {
             return format("found=false tableId=%lu"
@@ -462,6 +489,16 @@ class ObjectManagerTest : public ::testing::Test,
             fakeLock, key, unusedType, unusedBuffer, NULL, outReference);
     }
 
+    /**
+     * Return the deltas kept under the hash table bucket lock for a key.
+     */
+    ObjectManager::ObjectDeltas&
+    deltasFor(Key& key)
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        return objectManager.objectDeltas[lock.getIndex()];
+    }
+
     /**
      * This is simply a convenience wrapper for the ReplaySegment test. Given
      * the individual components of an object's key (tableId, string, length),
@@ -494,6 +531,168 @@ TEST_F(ObjectManagerTest, constructor) {
     EXPECT_EQ(ServerId(5), *objectManager.replicaManager.masterId);
 }
 
+TEST_F(ObjectManagerTest, appendObject) {
+    Key key(0, "1", 1);
+    Buffer data;
+    data.appendCopy("..XY", 4);
+    uint64_t version;
+
+    // The first append creates the object.
+    TestLog::Enable _("appendObject");
+    EXPECT_EQ(STATUS_OK,
+            objectManager.appendObject(key, &data, 0, 2, NULL, &version));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ("", TestLog::get());
+
+    // Later ones only write deltas.
+    EXPECT_EQ(STATUS_OK,
+            objectManager.appendObject(key, &data, 2, 2, NULL, &version));
+    EXPECT_EQ(2U, version);
+    EXPECT_EQ("appendObject: delta: 29 bytes, version 2", TestLog::get());
+    EXPECT_EQ(STATUS_OK,
+            objectManager.appendObject(key, &data, 3, 1, NULL, &version));
+    EXPECT_EQ(3U, version);
+
+    Buffer value;
+    EXPECT_EQ(STATUS_OK,
+            objectManager.readObject(key, &value, NULL, &version, true));
+    EXPECT_EQ("..XYY", TestUtil::toString(&value));
+    EXPECT_EQ(3U, version);
+
+    // The keys and the version are those of the object with its deltas.
+    value.reset();
+    objectManager.readObject(key, &value, NULL, NULL, false);
+    Object appended(0, 0, 0, value);
+    KeyLength keyLength;
+    const void* primaryKey = appended.getKey(0, &keyLength);
+    EXPECT_EQ("1", string(reinterpret_cast<const char*>(primaryKey),
+                          keyLength));
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        LogEntryType type;
+        Buffer buffer;
+        EXPECT_TRUE(objectManager.lookup(lock, key, type, buffer,
+                &version, NULL));
+        EXPECT_EQ(3U, version);
+        EXPECT_EQ(3U, Object(buffer).getVersion());
+    }
+
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.versionNeGiven = true;
+    rules.givenVersion = 2;
+    EXPECT_EQ(STATUS_WRONG_VERSION,
+            objectManager.appendObject(key, &data, 0, 2, &rules, &version));
+    EXPECT_EQ(3U, version);
+
+    Key unknown(1, "1", 1);
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET,
+            objectManager.appendObject(unknown, &data, 0, 2, NULL, &version));
+}
+
+TEST_F(ObjectManagerTest, appendObject_chainFull) {
+    Key key(0, "1", 1);
+    Buffer data;
+    data.appendCopy("x", 1);
+    uint64_t version;
+    for (uint32_t i = 0; i <= ObjectManager::MAX_OBJECT_DELTAS; i++) {
+        EXPECT_EQ(STATUS_OK,
+                objectManager.appendObject(key, &data, 0, 1, NULL, &version));
+    }
+    EXPECT_EQ(1U, deltasFor(key).chains.size());
+
+    // The next append writes the whole object, which drops the deltas.
+    TestLog::Enable _("appendObject");
+    EXPECT_EQ(STATUS_OK,
+            objectManager.appendObject(key, &data, 0, 1, NULL, &version));
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(ObjectManager::MAX_OBJECT_DELTAS + 2, version);
+    EXPECT_EQ(0U, deltasFor(key).chains.size());
+
+    Buffer value;
+    objectManager.readObject(key, &value, NULL, NULL, true);
+    EXPECT_EQ(string(ObjectManager::MAX_OBJECT_DELTAS + 2, 'x'),
+            TestUtil::toString(&value));
+}
+
+TEST_F(ObjectManagerTest, appendObject_overwrite) {
+    Key key(0, "1", 1);
+    Buffer data;
+    data.appendCopy("abc", 3);
+    objectManager.appendObject(key, &data, 0, 3, NULL, NULL);
+    objectManager.appendObject(key, &data, 0, 3, NULL, NULL);
+    EXPECT_EQ(1U, deltasFor(key).chains.size());
+
+    Buffer buffer;
+    Object obj(key, "new", 3, 0, 0, buffer);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, NULL, NULL));
+    EXPECT_EQ(0U, deltasFor(key).chains.size());
+    Buffer value;
+    objectManager.readObject(key, &value, NULL, NULL, true);
+    EXPECT_EQ("new", TestUtil::toString(&value));
+
+    objectManager.appendObject(key, &data, 0, 3, NULL, NULL);
+    EXPECT_EQ(1U, deltasFor(key).chains.size());
+    EXPECT_EQ(STATUS_OK, objectManager.removeObject(key, NULL, NULL));
+    EXPECT_EQ(0U, deltasFor(key).chains.size());
+}
+
+TEST_F(ObjectManagerTest, patchObject) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "1", 1);
+    Buffer data;
+    data.appendCopy("..XY", 4);
+    uint64_t version;
+
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+            objectManager.patchObject(key, 0, &data, 2, 2, NULL, &version));
+
+    Buffer buffer;
+    Object obj(key, "abcdef", 6, 0, 0, buffer);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+
+    // Replace bytes in the middle.
+    TestLog::Enable _("patchObject");
+    EXPECT_EQ(STATUS_OK,
+            objectManager.patchObject(key, 2, &data, 2, 2, NULL, &version));
+    EXPECT_EQ(2U, version);
+    EXPECT_EQ("patchObject: patched 2 bytes at offset 2", TestLog::get());
+    Buffer value;
+    objectManager.readObject(key, &value, NULL, NULL, true);
+    EXPECT_EQ("abXYef", TestUtil::toString(&value));
+
+    // Append, then run past the end.
+    EXPECT_EQ(STATUS_OK,
+            objectManager.patchObject(key, 6, &data, 2, 2, NULL, &version));
+    EXPECT_EQ(STATUS_OK,
+            objectManager.patchObject(key, 7, &data, 1, 3, NULL, &version));
+    EXPECT_EQ(4U, version);
+    value.reset();
+    objectManager.readObject(key, &value, NULL, NULL, true);
+    EXPECT_EQ("abXYefX.XY", TestUtil::toString(&value));
+
+    // The keys are kept.
+    value.reset();
+    objectManager.readObject(key, &value, NULL, NULL, false);
+    Object patched(1, 0, 0, value);
+    KeyLength keyLength;
+    const void* primaryKey = patched.getKey(0, &keyLength);
+    EXPECT_EQ("1", string(reinterpret_cast<const char*>(primaryKey),
+                          keyLength));
+
+    EXPECT_EQ(STATUS_INVALID_PARAMETER,
+            objectManager.patchObject(key, 11, &data, 2, 2, NULL, &version));
+    EXPECT_EQ(4U, version);
+
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.versionNeGiven = true;
+    rules.givenVersion = 3;
+    EXPECT_EQ(STATUS_WRONG_VERSION,
+            objectManager.patchObject(key, 0, &data, 2, 2, &rules, &version));
+    EXPECT_EQ(4U, version);
+}
+
 TEST_F(ObjectManagerTest, readHashes) {
     uint64_t tableId = 0;
     uint8_t numKeys = 2;
@@ -565,6 +764,96 @@ TEST_F(ObjectManagerTest, readHashes) {
                                   o1.getValueLength()));
 }
 
+/// Describe the changes returned by ObjectManager::readLogChanges, one
+/// "type tableId:key" per change.
+static string
+describeLogChanges(Buffer& changes)
+{
+    string result;
+    uint32_t offset = 0;
+    while (offset < changes.size()) {
+        WireFormat::ReadLogChanges::Change* change = changes.getOffset<
+                WireFormat::ReadLogChanges::Change>(offset);
+        offset += sizeof32(*change);
+        LogEntryType type = static_cast<LogEntryType>(change->type);
+        Buffer entry;
+        entry.append(&changes, offset, change->length);
+        Key key(type, entry);
+        if (!result.empty())
+            result += ", ";
+        result += format("%s %lu:%s", LogEntryTypeHelpers::toString(type),
+                key.getTableId(), string(static_cast<const char*>(
+                key.getStringKey()), key.getStringKeyLength()).c_str());
+        offset += change->length;
+    }
+    return result;
+}
+
+TEST_F(ObjectManagerTest, readLogChanges) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    LogPosition position = objectManager.log.rollHeadOver();
+    Key key(1, "a", 1);
+    Buffer buffer;
+    Object object(key, "1", 1, 0, 0, buffer);
+    objectManager.writeObject(object, 0, 0);
+    Key otherKey(0, "b", 1);
+    Buffer otherBuffer;
+    Object otherObject(otherKey, "2", 1, 0, 0, otherBuffer);
+    objectManager.writeObject(otherObject, 0, 0);
+    objectManager.removeObject(key, NULL, NULL);
+
+    // Nothing is returned before it is durable.
+    Buffer changes;
+    EXPECT_TRUE(objectManager.readLogChanges(1, &position, &changes, 1000));
+    EXPECT_EQ("", describeLogChanges(changes));
+    LogPosition start = position;
+
+    objectManager.syncChanges();
+    EXPECT_TRUE(objectManager.readLogChanges(1, &position, &changes, 1000));
+    EXPECT_EQ("Object 1:a, Object Tombstone 1:a",
+            describeLogChanges(changes));
+    EXPECT_EQ(start.getSegmentId(), position.getSegmentId());
+    EXPECT_EQ(objectManager.log.head->syncedLength.load(),
+            position.getSegmentOffset());
+
+    changes.reset();
+    EXPECT_TRUE(objectManager.readLogChanges(1, &position, &changes, 1000));
+    EXPECT_EQ("", describeLogChanges(changes));
+}
+
+TEST_F(ObjectManagerTest, readLogChanges_maxBytes) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    LogPosition position = objectManager.log.rollHeadOver();
+    for (int i = 0; i < 2; i++) {
+        Key key(1, i == 0 ? "a" : "b", 1);
+        Buffer buffer;
+        Object object(key, "1", 1, 0, 0, buffer);
+        objectManager.writeObject(object, 0, 0);
+    }
+    objectManager.syncChanges();
+
+    Buffer changes;
+    EXPECT_TRUE(objectManager.readLogChanges(1, &position, &changes, 1));
+    EXPECT_EQ("Object 1:a", describeLogChanges(changes));
+    changes.reset();
+    EXPECT_TRUE(objectManager.readLogChanges(1, &position, &changes, 1));
+    EXPECT_EQ("Object 1:b", describeLogChanges(changes));
+}
+
+TEST_F(ObjectManagerTest, readLogChanges_changesLost) {
+    LogPosition position = objectManager.log.rollHeadOver();
+    Buffer changes;
+    objectManager.segmentManager.cleanedHeadSegmentIdLimit =
+            position.getSegmentId();
+    EXPECT_TRUE(objectManager.readLogChanges(0, &position, &changes, 1000));
+
+    LogPosition start = position;
+    objectManager.segmentManager.cleanedHeadSegmentIdLimit =
+            position.getSegmentId() + 1;
+    EXPECT_FALSE(objectManager.readLogChanges(0, &position, &changes, 1000));
+    EXPECT_EQ(start, position);
+}
+
 TEST_F(ObjectManagerTest, readObject) {
     Buffer buffer;
     Key key(1, "1", 1);
@@ -614,12 +903,184 @@ TEST_F(ObjectManagerTest, readObject) {
         tabletManager.toString());
 }
 
+TEST_F(ObjectManagerTest, readObject_expired) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object object(key, "item0", 5, 0, 0, value);
+    object.setExpiry(100);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL, NULL));
+
+    Buffer buffer;
+    WallTime::mockWallTimeValue = 99;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0, true));
+    EXPECT_EQ("item0", TestUtil::toString(&buffer));
+
+    WallTime::mockWallTimeValue = 100;
+    buffer.reset();
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+        objectManager.readObject(key, &buffer, 0, 0));
+
+    // An expired object doesn't satisfy "exists" reject rules.
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.exists = 1;
+    Object object2(key, "item1", 5, 0, 0, value);
+    uint64_t version;
+    EXPECT_EQ(STATUS_OK,
+        objectManager.writeObject(object2, &rules, &version));
+    buffer.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0, true));
+    EXPECT_EQ("item1", TestUtil::toString(&buffer));
+    WallTime::mockWallTimeValue = 0;
+}
+
+TEST_F(ObjectManagerTest, readObject_inlineValue) {
+    HashTable& objectMap = objectManager.objectMap;
+    objectMap.inlineValues.reset(new LargeBlockOfMemory<HashTable::InlineValue>(
+            objectMap.getNumBuckets() * sizeof(HashTable::InlineValue)));
+    Key key(0, "counter", 7);
+    Buffer value;
+    Object object(key, "12345678", 8, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL, NULL));
+
+    // The first read goes to the log and leaves a copy behind.
+    TestLog::Enable _("readObject");
+    Buffer fromLog;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &fromLog, 0, 0));
+    EXPECT_EQ("", TestLog::get());
+    uint64_t version;
+    Buffer buffer;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, &version));
+    EXPECT_EQ("readObject: read inline value", TestLog::get());
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ(TestUtil::toString(&fromLog), TestUtil::toString(&buffer));
+    buffer.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0, true));
+    EXPECT_EQ("12345678", TestUtil::toString(&buffer));
+
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.exists = 1;
+    EXPECT_EQ(STATUS_OBJECT_EXISTS,
+        objectManager.readObject(key, &buffer, &rules, 0));
+
+    // Overwrites and appends both discard the copy.
+    Object object2(key, "abc", 3, 0, 0, value);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object2, NULL, NULL));
+    TestLog::reset();
+    buffer.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0, true));
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ("abc", TestUtil::toString(&buffer));
+
+    Buffer data;
+    data.appendCopy("de", 2);
+    EXPECT_EQ(STATUS_OK,
+            objectManager.appendObject(key, &data, 0, 2, NULL, NULL));
+    buffer.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &buffer, 0, 0, true));
+    EXPECT_EQ("abcde", TestUtil::toString(&buffer));
+    EXPECT_EQ("", TestLog::get());
+}
+
+TEST_F(ObjectManagerTest, readObjects) {
+    Key key1(1, "1", 1);
+    Key key2(1, "2", 1);
+    Key key3(1, "3", 1);
+    storeObject(key1, "hi", 93);
+    storeObject(key3, "there", 94);
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+
+    Key* keys[] = { &key1, &key2, &key3 };
+    RejectRules rules[3];
+    memset(rules, 0, sizeof(rules));
+    rules[2].exists = 1;
+    Buffer buffers[3];
+    uint64_t versions[3] = { 0, 0, 0 };
+    Status statuses[3];
+    objectManager.readObjects(3, keys, rules, buffers, versions, statuses,
+                              true);
+
+    EXPECT_EQ(STATUS_OK, statuses[0]);
+    EXPECT_EQ(93UL, versions[0]);
+    EXPECT_EQ("hi", TestUtil::toString(&buffers[0]));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, statuses[1]);
+    EXPECT_EQ(0U, buffers[1].size());
+    EXPECT_EQ(STATUS_OBJECT_EXISTS, statuses[2]);
+    EXPECT_EQ(94UL, versions[2]);
+    EXPECT_EQ(0U, buffers[2].size());
+}
+
 static bool
 antiGetEntryFilter(string s)
 {
     return s != "getEntry";
 }
 
+TEST_F(ObjectManagerTest, readSnapshotObject) {
+    Key key(0, "key0", 4);
+    Buffer buffer;
+    uint64_t version;
+
+    // Versions aren't retained unless configured.
+    objectManager.clusterClock = &clusterClock;
+    EXPECT_EQ(STATUS_SNAPSHOT_TOO_OLD, objectManager.readSnapshotObject(
+            key, 1, &buffer, &version, true));
+    masterConfig.master.snapshotRetentionMs = 1000;
+
+    Buffer dataBuffer;
+    Object first(key, "first", 5, 0, 0, dataBuffer);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(first, NULL, NULL));
+    Buffer dataBuffer2;
+    Object second(key, "second", 6, 0, 0, dataBuffer2);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(second, NULL, NULL));
+    EXPECT_EQ(2U, clusterClock.getTime().getEncoded());
+
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, objectManager.readSnapshotObject(
+            key, 0, &buffer, &version, true));
+
+    TestLog::Enable _("readSnapshotObject");
+    EXPECT_EQ(STATUS_OK, objectManager.readSnapshotObject(
+            key, 1, &buffer, &version, true));
+    EXPECT_EQ("first", TestUtil::toString(&buffer));
+    EXPECT_EQ(1U, version);
+    EXPECT_EQ("readSnapshotObject: read retained version", TestLog::get());
+
+    TestLog::reset();
+    buffer.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readSnapshotObject(
+            key, 2, &buffer, &version, true));
+    EXPECT_EQ("second", TestUtil::toString(&buffer));
+    EXPECT_EQ(2U, version);
+    EXPECT_EQ("", TestLog::get());
+
+    // Once the retention period has passed, the old versions are forgotten
+    // by the next change covered by the same lock.
+    clusterClock.updateClock(ClusterTime(2000000000));
+    EXPECT_EQ(STATUS_SNAPSHOT_TOO_OLD, objectManager.readSnapshotObject(
+            key, 1, &buffer, &version, true));
+    Buffer dataBuffer3;
+    Object third(key, "third", 5, 0, 0, dataBuffer3);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(third, NULL, NULL));
+    ObjectManager::HashTableBucketLock lock(objectManager, key);
+    EXPECT_EQ(1U, objectManager.versionHistory[lock.getIndex()].size());
+}
+
+TEST_F(ObjectManagerTest, readSnapshotObject_locked) {
+    Key key(0, "key0", 4);
+    Buffer buffer;
+    objectManager.clusterClock = &clusterClock;
+    masterConfig.master.snapshotRetentionMs = 1000;
+
+    Log::Reference lockRef = storePreparedOp(key);
+    EXPECT_TRUE(objectManager.lockTable.tryAcquireLock(key, lockRef));
+    EXPECT_EQ(STATUS_RETRY, objectManager.readSnapshotObject(
+            key, 1, &buffer, NULL, true));
+    EXPECT_TRUE(objectManager.lockTable.releaseLock(key, lockRef));
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST, objectManager.readSnapshotObject(
+            key, 1, &buffer, NULL, true));
+}
+
 TEST_F(ObjectManagerTest, removeObject) {
     Key key(1, "1", 1);
     storeObject(key, "hi", 93);
@@ -809,6 +1270,74 @@ TEST_F(ObjectManagerTest, replaySegment_nextNodeIdMap) {
               , verifyMetadata(0));
 }
 
+TEST_F(ObjectManagerTest, replaySegment_partitioned) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+
+    // Find a key for each half of the hash table.
+    string keyStrings[2];
+    for (int i = 0; keyStrings[0].empty() || keyStrings[1].empty(); ++i) {
+        string keyString = format("key%d", i);
+        Key key(0, keyString.c_str(), downCast<KeyLength>(keyString.size()));
+        uint64_t unused;
+        uint64_t bucket = HashTable::findBucketIndex(numBuckets,
+                                                     key.getHash(), &unused);
+        string& half = keyStrings[bucket < numBuckets / 2 ? 0 : 1];
+        if (half.empty())
+            half = keyString;
+    }
+    Key key0(0, keyStrings[0].c_str(),
+             downCast<KeyLength>(keyStrings[0].size()));
+    Key key1(0, keyStrings[1].c_str(),
+             downCast<KeyLength>(keyStrings[1].size()));
+
+    Segment segment;
+    Key* keys[] = { &key0, &key1 };
+    foreach (Key* key, keys) {
+        Buffer dataBuffer;
+        Object object(*key, "value", 6, 1, 0, dataBuffer);
+        Buffer objectBuffer;
+        object.assembleForLog(objectBuffer);
+        EXPECT_TRUE(segment.append(LOG_ENTRY_TYPE_OBJ, objectBuffer));
+    }
+    ObjectSafeVersion safeVer(1000UL);
+    Buffer safeVerBuffer;
+    safeVer.assembleForLog(safeVerBuffer);
+    EXPECT_TRUE(segment.append(LOG_ENTRY_TYPE_SAFEVERSION, safeVerBuffer));
+    segment.close();
+    SegmentCertificate certificate;
+    segment.getAppendedLength(&certificate);
+    Buffer buffer;
+    segment.appendToBuffer(buffer);
+
+    SideLog sl(&objectManager.log);
+    Tub<SegmentIterator> it;
+    Buffer value;
+    LogEntryType type;
+
+    ObjectManager::ReplayPartition second(numBuckets, 1, 2);
+    EXPECT_EQ(numBuckets / 2, second.firstBucket);
+    EXPECT_EQ(numBuckets, second.endBucket);
+    EXPECT_FALSE(second.ownsOtherEntries);
+    it.construct(buffer.getRange(0, buffer.size()), buffer.size(),
+                 certificate);
+    objectManager.replaySegment(&sl, *it, NULL, &second);
+    verifyRecoveryObject(key1, "value");
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key0);
+        EXPECT_FALSE(objectManager.lookup(lock, key0, type, value));
+    }
+    EXPECT_GT(1000UL, objectManager.segmentManager.safeVersion);
+
+    ObjectManager::ReplayPartition first(numBuckets, 0, 2);
+    EXPECT_TRUE(first.ownsOtherEntries);
+    it.construct(buffer.getRange(0, buffer.size()), buffer.size(),
+                 certificate);
+    objectManager.replaySegment(&sl, *it, NULL, &first);
+    verifyRecoveryObject(key0, "value");
+    EXPECT_EQ(1000UL, objectManager.segmentManager.safeVersion);
+}
+
 TEST_F(ObjectManagerTest, replaySegment_tombstoneSynthesis) {
     ObjectManager::TombstoneProtector p(&objectManager);
     uint32_t segLen = 8192;
@@ -884,6 +1413,82 @@ TEST_F(ObjectManagerTest, replaySegment_tombstoneSegmentId) {
     EXPECT_EQ(t3.getObjectVersion(), 2U);
 }
 
+TEST_F(ObjectManagerTest, replaySegment_objectDelta) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    uint32_t segLen = 8192;
+    char seg[segLen];
+    uint32_t len;
+    SideLog sl(&objectManager.log);
+    Tub<SegmentIterator> it;
+    SegmentCertificate certificate;
+
+    Key key0(0, "key0", 4);
+    Buffer data;
+    data.appendCopy("XYZ", 3);
+    ObjectDelta delta2(key0, 2, 0, data, 0, 1);
+    ObjectDelta delta3(key0, 3, 0, data, 1, 2);
+
+    // A delta that arrives before its object is held until the object does.
+    len = buildRecoverySegment(seg, segLen, delta2, &certificate);
+    it.construct(&seg[0], len, certificate);
+    objectManager.replaySegment(&sl, *it);
+    EXPECT_EQ(1U, deltasFor(key0).pending.size());
+    len = buildRecoverySegment(seg, segLen, delta3, &certificate);
+    it.construct(&seg[0], len, certificate);
+    objectManager.replaySegment(&sl, *it);
+    EXPECT_EQ(2U, deltasFor(key0).pending.size());
+
+    len = buildRecoverySegment(seg, segLen, key0, 1, "ab", &certificate);
+    it.construct(&seg[0], len, certificate);
+    objectManager.replaySegment(&sl, *it);
+    EXPECT_EQ(0U, deltasFor(key0).pending.size());
+
+    Buffer value;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key0);
+        LogEntryType type;
+        Buffer buffer;
+        ASSERT_TRUE(objectManager.lookup(lock, key0, type, buffer));
+        Object object(buffer);
+        EXPECT_EQ(3U, object.getVersion());
+        object.appendValueToBuffer(&value);
+    }
+    EXPECT_EQ(string("ab\0XYZ", 6), string(static_cast<const char*>(
+            value.getRange(0, value.size())), value.size()));
+
+    // Stale deltas are ignored.
+    len = buildRecoverySegment(seg, segLen, delta2, &certificate);
+    it.construct(&seg[0], len, certificate);
+    objectManager.replaySegment(&sl, *it);
+    EXPECT_EQ(0U, deltasFor(key0).pending.size());
+}
+
+TEST_F(ObjectManagerTest, replaySegment_objectDeltaDiscarded) {
+    uint32_t segLen = 8192;
+    char seg[segLen];
+    uint32_t len;
+    SideLog sl(&objectManager.log);
+    Tub<SegmentIterator> it;
+    SegmentCertificate certificate;
+
+    Key key0(0, "key0", 4);
+    Buffer data;
+    data.appendCopy("XYZ", 3);
+    ObjectDelta delta(key0, 5, 0, data, 0, 3);
+    {
+        ObjectManager::TombstoneProtector p(&objectManager);
+        len = buildRecoverySegment(seg, segLen, delta, &certificate);
+        it.construct(&seg[0], len, certificate);
+        objectManager.replaySegment(&sl, *it);
+        EXPECT_EQ(1U, deltasFor(key0).pending.size());
+    }
+
+    TestLog::Enable _("discardPendingDeltas");
+    objectManager.removeTombstones();
+    EXPECT_EQ("discardPendingDeltas: discarding 1 deltas", TestLog::get());
+    EXPECT_EQ(0U, deltasFor(key0).pending.size());
+}
+
 TEST_F(ObjectManagerTest, replaySegment) {
     ObjectManager::TombstoneProtector p(&objectManager);
     uint32_t segLen = 8192;
@@ -1287,8 +1892,9 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
     uint64_t deadRpcId = 3;
 
     UnackedRpcResults *unackedRpcResults = objectManager.unackedRpcResults;
-    EXPECT_EQ(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
+    EXPECT_EQ(unackedRpcResults->getShard(expectedLeaseId).clients.end(),
+              unackedRpcResults->getShard(expectedLeaseId).clients.find(
+                      expectedLeaseId));
 
     {
         SegmentCertificate certificate;
@@ -1300,9 +1906,10 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
 
     objectManager.replaySegment(&sl, *it);
 
-    EXPECT_NE(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
-    EXPECT_EQ(1U, unackedRpcResults->clients.size());
+    EXPECT_NE(unackedRpcResults->getShard(expectedLeaseId).clients.end(),
+              unackedRpcResults->getShard(expectedLeaseId).clients.find(
+                      expectedLeaseId));
+    EXPECT_EQ(1U, unackedRpcResults->getNumClients());
 
     // Test noop case.
 
@@ -1316,9 +1923,10 @@ TEST_F(ObjectManagerTest, replaySegment_rpcResult) {
 
     objectManager.replaySegment(&sl, *it);
 
-    EXPECT_NE(unackedRpcResults->clients.end(),
-              unackedRpcResults->clients.find(expectedLeaseId));
-    EXPECT_EQ(1U, unackedRpcResults->clients.size());
+    EXPECT_NE(unackedRpcResults->getShard(expectedLeaseId).clients.end(),
+              unackedRpcResults->getShard(expectedLeaseId).clients.find(
+                      expectedLeaseId));
+    EXPECT_EQ(1U, unackedRpcResults->getNumClients());
 }
 
 TEST_F(ObjectManagerTest, replaySegment_preparedOp_basics) {
@@ -1584,16 +2192,140 @@ TEST_F(ObjectManagerTest, replaySegment_ParticipantList) {
 
 }
 
-static bool
-writeObjectFilter(string s)
+/// Describe the objects returned by ObjectManager::scanObjects, as
+/// "key=value" pairs.
+static string
+describeScan(uint64_t tableId, Buffer& objects, uint32_t numObjects)
 {
-    return s == "writeObject";
+    string result;
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < numObjects; i++) {
+        WireFormat::Scan::Object* header =
+                objects.getOffset<WireFormat::Scan::Object>(offset);
+        offset += sizeof32(*header);
+        Object object(tableId, header->version, 0, objects, offset,
+                header->length);
+        offset += header->length;
+        KeyLength keyLength;
+        const char* key = static_cast<const char*>(
+                object.getKey(0, &keyLength));
+        uint32_t valueLength;
+        const char* value = static_cast<const char*>(
+                object.getValue(&valueLength));
+        if (!result.empty())
+            result += " ";
+        result += string(key, keyLength) + "=" + string(value, valueLength);
+    }
+    return result;
 }
 
-TEST_F(ObjectManagerTest, writeObject) {
-    Key key(1, "1", 1);
+TEST_F(ObjectManagerTest, scanObjects) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    const char* keys[] = {"b", "a", "d", "c"};
+    for (const char* k : keys) {
+        Key key(1, k, 1);
+        Buffer buffer;
+        Object object(key, k, 1, 0, 0, buffer);
+        objectManager.writeObject(object, 0, 0);
+    }
+
+    // The first scan gathers the keys.
+    Buffer objects;
+    uint32_t numObjects;
+    EXPECT_FALSE(objectManager.scanObjects(1, "", 0, "", 0, 10, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ("a=a b=b c=c d=d", describeScan(1, objects, numObjects));
+    objects.reset();
+    EXPECT_FALSE(objectManager.scanObjects(1, "b", 1, "d", 1, 10, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ("b=b c=c", describeScan(1, objects, numObjects));
+
+    // Later writes and removes are reflected.
+    Key key(1, "bb", 2);
     Buffer buffer;
-    // create an object just so that buffer will be populated with the key
+    Object object(key, "x", 1, 0, 0, buffer);
+    objectManager.writeObject(object, 0, 0);
+    Key removed(1, "c", 1);
+    objectManager.removeObject(removed, NULL, NULL);
+    objects.reset();
+    EXPECT_FALSE(objectManager.scanObjects(1, "b", 1, "", 0, 10, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ("b=b bb=x d=d", describeScan(1, objects, numObjects));
+}
+
+TEST_F(ObjectManagerTest, scanObjects_limits) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    const char* keys[] = {"a", "b", "c"};
+    for (const char* k : keys) {
+        Key key(1, k, 1);
+        Buffer buffer;
+        Object object(key, k, 1, 0, 0, buffer);
+        objectManager.writeObject(object, 0, 0);
+    }
+
+    Buffer objects;
+    uint32_t numObjects;
+    EXPECT_TRUE(objectManager.scanObjects(1, "", 0, "", 0, 2, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ("a=a b=b", describeScan(1, objects, numObjects));
+
+    // At least one object is returned, however small maxBytes is.
+    objects.reset();
+    EXPECT_TRUE(objectManager.scanObjects(1, "b", 1, "", 0, 10, 1,
+            &objects, &numObjects));
+    EXPECT_EQ("b=b", describeScan(1, objects, numObjects));
+}
+
+TEST_F(ObjectManagerTest, scanObjects_tabletNotNormal) {
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "a", 1);
+    Buffer buffer;
+    Object object(key, "a", 1, 0, 0, buffer);
+    objectManager.writeObject(object, 0, 0);
+    tabletManager.changeState(1, 0, ~0UL, TabletManager::NORMAL,
+            TabletManager::NOT_READY);
+
+    Buffer objects;
+    uint32_t numObjects;
+    EXPECT_FALSE(objectManager.scanObjects(1, "", 0, "", 0, 10, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ(0U, numObjects);
+}
+
+TEST_F(ObjectManagerTest, scanObjects_replayedObjects) {
+    Buffer objects;
+    uint32_t numObjects;
+    EXPECT_FALSE(objectManager.scanObjects(0, "", 0, "", 0, 10, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ(0U, numObjects);
+
+    ObjectManager::TombstoneProtector p(&objectManager);
+    uint32_t segLen = 8192;
+    char seg[segLen];
+    SideLog sl(&objectManager.log);
+    Tub<SegmentIterator> it;
+    Key key0(0, "key0", 4);
+    SegmentCertificate certificate;
+    uint32_t len = buildRecoverySegment(seg, segLen, key0, 1, "recovered",
+            &certificate);
+    it.construct(&seg[0], len, certificate);
+    objectManager.replaySegment(&sl, *it);
+
+    EXPECT_FALSE(objectManager.scanObjects(0, "", 0, "", 0, 10, 1000000,
+            &objects, &numObjects));
+    EXPECT_EQ(1U, numObjects);
+}
+
+static bool
+writeObjectFilter(string s)
+{
+    return s == "writeObject";
+}
+
+TEST_F(ObjectManagerTest, writeObject) {
+    Key key(1, "1", 1);
+    Buffer buffer;
+    // create an object just so that buffer will be populated with the key
     // and the value. This keeps the abstractions intact
     Object obj(key, "value", 5, 0, 0, buffer);
 
@@ -1643,6 +2375,135 @@ TEST_F(ObjectManagerTest, writeObject) {
     objectManager.getLog()->totalLiveBytes = original;
 }
 
+TEST_F(ObjectManagerTest, writeObject_omitSameSegmentTombstones) {
+    masterConfig.master.omitSameSegmentTombstones = true;
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Key key(1, "a", 1);
+    Buffer buffer;
+    Object obj(key, "value", 5, 0, 0, buffer);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+
+    // The current version is in the head: no tombstone.
+    TestLog::Enable _(writeObjectFilter);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+    EXPECT_EQ("writeObject: object: 33 bytes, version 2 | "
+              "writeObject: tombstone omitted, version 1", TestLog::get());
+    EXPECT_EQ("found=true tableId=1 byteCount=66 recordCount=2"
+              , verifyMetadata(1));
+
+    // The current version is in an older segment: tombstone as usual.
+    objectManager.log.rollHeadOver();
+    TestLog::reset();
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+    EXPECT_EQ("writeObject: object: 33 bytes, version 3 | "
+              "writeObject: tombstone: 33 bytes, version 2", TestLog::get());
+
+    Buffer value;
+    objectManager.readObject(key, &value, 0, 0);
+    EXPECT_EQ("value", TestUtil::toString(&value));
+}
+
+TEST_F(ObjectManagerTest, writeObject_compressed) {
+    masterConfig.master.valueCompressionThreshold = 100;
+    Key key(0, "key0", 4);
+    string value(1000, 'x');
+    Buffer buffer;
+    Object object(key, value.data(), 1000, 0, 0, buffer);
+
+    TestLog::Enable _("assembleObjectForLog");
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL, NULL));
+    EXPECT_EQ(0U, TestLog::get().find(
+            "assembleObjectForLog: compressed 1031-byte object"));
+
+    LogEntryType type;
+    Buffer entry;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, type, entry));
+    }
+    EXPECT_TRUE(Object(entry).isCompressed());
+    EXPECT_GT(100U, entry.size());
+
+    Buffer out;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &out, 0, 0, true));
+    EXPECT_EQ(value, string(static_cast<const char*>(
+            out.getRange(0, out.size())), out.size()));
+
+    // Appended data goes in a delta on top of the compressed object.
+    Buffer data;
+    data.appendCopy("yz", 2);
+    EXPECT_EQ(STATUS_OK,
+            objectManager.appendObject(key, &data, 0, 2, NULL, NULL));
+    EXPECT_EQ(1U, deltasFor(key).chains.size());
+    out.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &out, 0, 0, true));
+    EXPECT_EQ(value + "yz", string(static_cast<const char*>(
+            out.getRange(0, out.size())), out.size()));
+
+    // Values shorter than the threshold are stored as they are.
+    TestLog::reset();
+    Key key2(0, "key1", 4);
+    Buffer buffer2;
+    Object object2(key2, value.data(), 99, 0, 0, buffer2);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object2, NULL, NULL));
+    EXPECT_EQ("", TestLog::get());
+}
+
+TEST_F(ObjectManagerTest, writeObject_compactHeaders) {
+    masterConfig.master.compactObjectHeaders = true;
+    Key key(0, "1", 1);
+    Buffer buffer;
+    Object object(key, "value", 5, 0, 0, buffer);
+
+    TestLog::Enable _(writeObjectFilter);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL, NULL));
+    EXPECT_EQ("writeObject: object: 25 bytes, version 1", TestLog::get());
+
+    LogEntryType type;
+    Buffer entry;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, type, entry));
+    }
+    Object stored(entry);
+    EXPECT_TRUE(stored.hasCompactHeader());
+    EXPECT_TRUE(stored.checkIntegrity());
+    EXPECT_EQ(1U, stored.getVersion());
+
+    Buffer out;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &out, 0, 0, true));
+    EXPECT_EQ("value", TestUtil::toString(&out));
+}
+
+TEST_F(ObjectManagerTest, writeObjects) {
+    Key key1(1, "1", 1);
+    Key key2(2, "2", 1);
+    Buffer buffer1, buffer2;
+    Object obj1(key1, "value", 5, 0, 0, buffer1);
+    Object obj2(key2, "value", 5, 0, 0, buffer2);
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    tabletManager.addTablet(2, 0, ~0UL, TabletManager::LOCKED_FOR_MIGRATION);
+
+    Object* objects[] = { &obj1, &obj2 };
+    uint64_t versions[2] = { 0, 0 };
+    Buffer removed[2];
+    Status statuses[2];
+    objectManager.writeObjects(2, objects, NULL, versions, removed, statuses);
+    EXPECT_EQ(STATUS_OK, statuses[0]);
+    EXPECT_EQ(1UL, versions[0]);
+    EXPECT_EQ(STATUS_RETRY, statuses[1]);
+
+    // Overwrite the first object; the old version should be returned.
+    objectManager.writeObjects(1, objects, NULL, versions, removed, statuses);
+    EXPECT_EQ(STATUS_OK, statuses[0]);
+    EXPECT_EQ(2UL, versions[0]);
+    EXPECT_NE(0U, removed[0].size());
+
+    Buffer value;
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key1, &value, 0, 0, true));
+    EXPECT_EQ("value", TestUtil::toString(&value));
+}
+
 TEST_F(ObjectManagerTest, writeObject_returnRemovedObj) {
     tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
     Key key(1, "a", 1);
@@ -1751,6 +2612,39 @@ TEST_F(ObjectManagerTest, prepareOp) {
     objectManager.getLog()->totalLiveBytes = original;
 }
 
+TEST_F(ObjectManagerTest, prepareOp_snapshot) {
+    using WireFormat::TxPrepare;
+    Key key(0, "key0", 4);
+    objectManager.clusterClock = &clusterClock;
+    masterConfig.master.snapshotRetentionMs = 1000;
+    Buffer dataBuffer;
+    Object object(key, "value", 5, 0, 0, dataBuffer);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL, NULL));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, NULL, NULL));
+
+    Buffer buffer;
+    PreparedOp op(TxPrepare::WRITE, 1, 10, 10, key, "new", 3, 0, 0, buffer);
+    WireFormat::TxPrepare::Vote vote;
+    RpcResult rpcResult(0, key.getHash(), 1, 10, 9, &vote, sizeof(vote));
+    uint64_t newOpPtr, rpcResultPtr;
+    bool isCommit;
+
+    // The object was overwritten after the snapshot was taken.
+    uint64_t aborts = PerfStats::threadStats.txLockConflictAborts;
+    EXPECT_EQ(STATUS_OK, objectManager.prepareOp(op, 0, &newOpPtr, &isCommit,
+            &rpcResult, &rpcResultPtr, 1));
+    EXPECT_EQ(aborts + 1, PerfStats::threadStats.txLockConflictAborts);
+    EXPECT_FALSE(objectManager.lockTable.isLockAcquired(key));
+
+    // A snapshot taken after the change may write the object, and the
+    // clock is pushed past the snapshot.
+    EXPECT_EQ(STATUS_OK, objectManager.prepareOp(op, 0, &newOpPtr, &isCommit,
+            &rpcResult, &rpcResultPtr, 500));
+    EXPECT_EQ(aborts + 1, PerfStats::threadStats.txLockConflictAborts);
+    EXPECT_TRUE(objectManager.lockTable.isLockAcquired(key));
+    EXPECT_EQ(500U, clusterClock.getTime().getEncoded());
+}
+
 TEST_F(ObjectManagerTest, writeTxDecisionRecord) {
     TxDecisionRecord record(1, 2, 21, 1, WireFormat::TxDecision::ABORT, 50);
     record.addParticipant(1, 2, 3);
@@ -1977,6 +2871,231 @@ TEST_F(ObjectManagerTest, commitWrite) {
                             value.size()));
 }
 
+TEST_F(ObjectManagerTest, commitPreparedOps) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    Key key2(1, "2", 1);
+    Key key3(1, "3", 1);
+    Buffer buffer, buffer2;
+    Buffer value;
+    bool isCommit;
+    uint64_t opPtrs[3];
+    uint64_t ver;
+
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Object obj1(key1, "one", 3, 0, 0, buffer2);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj1, 0, 0));
+    Object obj2(key2, "two", 3, 0, 0, buffer2);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, 0, 0));
+
+    PreparedOp op1(TxPrepare::READ, 1, 10, 10, key1, "", 0, 0, 0, buffer);
+    PreparedOp op2(TxPrepare::REMOVE, 1, 10, 11, key2, "", 0, 0, 0, buffer);
+    PreparedOp op3(TxPrepare::WRITE, 1, 10, 12, key3, "new", 3, 0, 0,
+                   buffer);
+    PreparedOp* ops[3] = {&op1, &op2, &op3};
+    Log::Reference opRefs[3];
+    WireFormat::TxPrepare::Vote vote;
+    uint64_t rpcResultPtr;
+    for (uint32_t i = 0; i < 3; i++) {
+        Key key(ops[i]->object.getTableId(), ops[i]->object.getKey(),
+                ops[i]->object.getKeyLength());
+        RpcResult rpcResult(key.getTableId(), key.getHash(), 1,
+                            ops[i]->header.rpcId, 9, &vote, sizeof(vote));
+        EXPECT_EQ(STATUS_OK, objectManager.prepareOp(*ops[i], 0, &opPtrs[i],
+                &isCommit, &rpcResult, &rpcResultPtr));
+        EXPECT_TRUE(isCommit);
+        opRefs[i] = Log::Reference(opPtrs[i]);
+    }
+
+    // Nothing is buffered, so nothing is written.
+    TestLog::Enable _("commitPreparedOps");
+    EXPECT_EQ(STATUS_OK, objectManager.commitPreparedOps(3, ops, opRefs,
+                                                         true));
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(STATUS_RETRY, objectManager.writeObject(obj1, 0, 0));
+
+    // COMMIT: one batch, a tombstone for key2 and a new object for key3.
+    for (uint32_t i = 0; i < 3; i++) {
+        objectManager.transactionManager->bufferOp(ops[i]->getTransactionId(),
+                ops[i]->header.rpcId, opPtrs[i]);
+    }
+    EXPECT_EQ(STATUS_OK, objectManager.commitPreparedOps(3, ops, opRefs,
+                                                         true));
+    EXPECT_EQ("commitPreparedOps: decided 3 operations in 3 log entries",
+              TestLog::get());
+    EXPECT_EQ(0U, objectManager.transactionManager->items.size());
+
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key1, &value, 0, &ver,
+                                                  true));
+    EXPECT_EQ(1U, ver);
+    value.reset();
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+              objectManager.readObject(key2, &value, 0, 0, true));
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key3, &value, 0, 0, true));
+    EXPECT_EQ("new", string(reinterpret_cast<const char*>(
+                            value.getRange(0, value.size())),
+                            value.size()));
+
+    // Locks are released.
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj1, 0, 0));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj2, 0, 0));
+}
+
+TEST_F(ObjectManagerTest, commitPreparedOps_abort) {
+    using WireFormat::TxPrepare;
+    Key key(1, "1", 1);
+    Buffer buffer, buffer2;
+    Buffer value;
+    bool isCommit;
+    uint64_t opPtr;
+
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    Object obj(key, "old", 3, 0, 0, buffer2);
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+
+    PreparedOp op(TxPrepare::WRITE, 1, 10, 10, key, "new", 3, 0, 0, buffer);
+    WireFormat::TxPrepare::Vote vote;
+    RpcResult rpcResult(key.getTableId(), key.getHash(),
+                        1, 10, 9, &vote, sizeof(vote));
+    uint64_t rpcResultPtr;
+    EXPECT_EQ(STATUS_OK, objectManager.prepareOp(
+                       op, 0, &opPtr, &isCommit, &rpcResult, &rpcResultPtr));
+    objectManager.transactionManager->bufferOp(op.getTransactionId(),
+                                               op.header.rpcId, opPtr);
+
+    PreparedOp* ops[1] = {&op};
+    Log::Reference opRefs[1] = {Log::Reference(opPtr)};
+    TestLog::Enable _("commitPreparedOps");
+    EXPECT_EQ(STATUS_OK, objectManager.commitPreparedOps(1, ops, opRefs,
+                                                         false));
+    EXPECT_EQ("commitPreparedOps: decided 1 operations in 1 log entries",
+              TestLog::get());
+
+    // The object is unchanged and unlocked.
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key, &value, 0, 0, true));
+    EXPECT_EQ("old", string(reinterpret_cast<const char*>(
+                            value.getRange(0, value.size())),
+                            value.size()));
+    EXPECT_EQ(STATUS_OK, objectManager.writeObject(obj, 0, 0));
+}
+
+TEST_F(ObjectManagerTest, commitTransaction) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    Key key2(1, "2", 1);
+    Key key3(1, "3", 1);
+    Buffer buffer, buffer1, buffer2, buffer3;
+    Buffer value;
+    uint64_t ver;
+    bool isCommitted;
+
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+    storeObject(key2, "old2", 1);
+    storeObject(key3, "old3", 1);
+
+    PreparedOp op1(TxPrepare::WRITE, 1, 10, 10, key1, "new1", 4, 0, 0,
+                   buffer1);
+    PreparedOp op2(TxPrepare::WRITE, 1, 10, 11, key2, "new2", 4, 0, 0,
+                   buffer2);
+    PreparedOp op3(TxPrepare::REMOVE, 1, 10, 12, key3, "", 0, 0, 0,
+                   buffer3);
+    PreparedOp* ops[] = {&op1, &op2, &op3};
+    RejectRules rejectRules[3];
+    memset(rejectRules, 0, sizeof(rejectRules));
+
+    TxPrepare::Vote vote = TxPrepare::COMMITTED;
+    RpcResult result1(1, key1.getHash(), 1, 10, 9, &vote, sizeof(vote));
+    RpcResult result2(1, key2.getHash(), 1, 11, 9, &vote, sizeof(vote));
+    RpcResult result3(1, key3.getHash(), 1, 12, 9, &vote, sizeof(vote));
+    RpcResult* rpcResults[] = {&result1, &result2, &result3};
+    uint64_t rpcResultPtrs[3] = {0, 0, 0};
+
+    // A reject rule fails: nothing is written.
+    rejectRules[1].versionNeGiven = 1;
+    rejectRules[1].givenVersion = 5;
+    uint64_t aborts = PerfStats::threadStats.txRejectRuleAborts;
+    EXPECT_EQ(STATUS_OK, objectManager.commitTransaction(3, ops,
+            rejectRules, rpcResults, rpcResultPtrs, &isCommitted));
+    EXPECT_FALSE(isCommitted);
+    EXPECT_EQ(aborts + 1, PerfStats::threadStats.txRejectRuleAborts);
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+              objectManager.readObject(key1, &value, 0, &ver));
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key3, &value, 0, &ver));
+
+    // Commit.
+    memset(rejectRules, 0, sizeof(rejectRules));
+    TestLog::Enable _("commitTransaction");
+    EXPECT_EQ(STATUS_OK, objectManager.commitTransaction(3, ops,
+            rejectRules, rpcResults, rpcResultPtrs, &isCommitted));
+    EXPECT_TRUE(isCommitted);
+    EXPECT_EQ("commitTransaction: committed 3 operations in 7 log entries",
+              TestLog::get());
+    EXPECT_NE(0U, rpcResultPtrs[0]);
+    EXPECT_NE(0U, rpcResultPtrs[2]);
+
+    value.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key1, &value, 0, &ver));
+    EXPECT_EQ("new1", TestUtil::toString(&value));
+    value.reset();
+    EXPECT_EQ(STATUS_OK, objectManager.readObject(key2, &value, 0, &ver));
+    EXPECT_EQ("new2", TestUtil::toString(&value));
+    EXPECT_EQ(2U, ver);
+    EXPECT_EQ(STATUS_OBJECT_DOESNT_EXIST,
+              objectManager.readObject(key3, &value, 0, &ver));
+}
+
+TEST_F(ObjectManagerTest, commitTransaction_errors) {
+    using WireFormat::TxPrepare;
+    Key key1(1, "1", 1);
+    Key key2(2, "2", 1);
+    Buffer buffer1, buffer2, buffer3;
+    bool isCommitted;
+
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+
+    PreparedOp op1(TxPrepare::WRITE, 1, 10, 10, key1, "a", 1, 0, 0, buffer1);
+    PreparedOp op2(TxPrepare::WRITE, 1, 10, 11, key1, "b", 1, 0, 0, buffer2);
+    PreparedOp op3(TxPrepare::WRITE, 1, 10, 12, key2, "c", 1, 0, 0, buffer3);
+    RejectRules rejectRules[2];
+    memset(rejectRules, 0, sizeof(rejectRules));
+    TxPrepare::Vote vote = TxPrepare::COMMITTED;
+    RpcResult result1(1, key1.getHash(), 1, 10, 9, &vote, sizeof(vote));
+    RpcResult result2(1, key1.getHash(), 1, 11, 9, &vote, sizeof(vote));
+    RpcResult* rpcResults[] = {&result1, &result2};
+    uint64_t rpcResultPtrs[2];
+
+    // Same key twice.
+    PreparedOp* twice[] = {&op1, &op2};
+    EXPECT_EQ(STATUS_REQUEST_FORMAT_ERROR, objectManager.commitTransaction(
+            2, twice, rejectRules, rpcResults, rpcResultPtrs,
+            &isCommitted));
+    EXPECT_FALSE(isCommitted);
+
+    // Table not owned by this server.
+    PreparedOp* unknown[] = {&op1, &op3};
+    EXPECT_EQ(STATUS_UNKNOWN_TABLET, objectManager.commitTransaction(
+            2, unknown, rejectRules, rpcResults, rpcResultPtrs,
+            &isCommitted));
+    EXPECT_FALSE(isCommitted);
+
+    // Key locked by a transaction in progress.
+    Buffer buffer4;
+    PreparedOp prepared(TxPrepare::WRITE, 1, 20, 20, key1, "x", 1, 0, 0,
+                        buffer4);
+    RpcResult result4(1, key1.getHash(), 1, 20, 19, &vote, sizeof(vote));
+    uint64_t newOpPtr, rpcResultPtr;
+    bool isCommit;
+    EXPECT_EQ(STATUS_OK, objectManager.prepareOp(prepared, 0, &newOpPtr,
+            &isCommit, &result4, &rpcResultPtr));
+    PreparedOp* locked[] = {&op1};
+    uint64_t aborts = PerfStats::threadStats.txLockConflictAborts;
+    EXPECT_EQ(STATUS_OK, objectManager.commitTransaction(
+            1, locked, rejectRules, rpcResults, rpcResultPtrs,
+            &isCommitted));
+    EXPECT_FALSE(isCommitted);
+    EXPECT_EQ(aborts + 1, PerfStats::threadStats.txLockConflictAborts);
+}
+
 TEST_F(ObjectManagerTest, flushEntriesToLog) {
 
     tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
@@ -2162,8 +3281,8 @@ TEST_F(ObjectManagerTest, TombstoneRemover_handleTimerEvent_noWorkToDo) {
     storeTombstone(key1);
 
     TestLog::reset();
-    objectManager.tombstoneRemover.currentBucket =
-            objectManager.objectMap.getNumBuckets();
+    objectManager.tombstoneRemover.currentStripe =
+            objectManager.getNumBucketLocksInUse();
     objectManager.tombstoneRemover.handleTimerEvent();
     EXPECT_EQ("handleTimerEvent: Tombstone cleanup complete",
             TestLog::get());
@@ -2176,39 +3295,64 @@ TEST_F(ObjectManagerTest, TombstoneRemover_handleTimerEvent_doWork) {
     Buffer buffer;
     TestLog::Enable logEnabler("handleTimerEvent");
 
-    // Create two tombstones; both had better get removed.
-    Key key1(0, "key1", 4);
-    storeTombstone(key1);
-    Key key2(0, "key2", 4);
-    storeTombstone(key2);
+    // Create more tombstones than are handled in one go; all had better get
+    // removed.
+    std::vector<string> keys;
+    for (int i = 0; i < 150; i++) {
+        keys.push_back(format("key%d", i));
+        Key key(0, keys.back().c_str(), downCast<uint16_t>(keys.back().size()));
+        storeTombstone(key);
+    }
 
     TestLog::reset();
-    objectManager.tombstoneRemover.currentBucket = 0;
+    objectManager.tombstoneRemover.currentStripe = 0;
     objectManager.tombstoneRemover.handleTimerEvent();
-    EXPECT_EQ(100lu, objectManager.tombstoneRemover.currentBucket);
     EXPECT_TRUE(objectManager.tombstoneRemover.isRunning());
     EXPECT_EQ("", TestLog::get());
 
-    while (true) {
-        uint64_t oldCurrent = objectManager.tombstoneRemover.currentBucket;
-        objectManager.tombstoneRemover.handleTimerEvent();
-        if (!TestLog::get().empty()) {
-            break;
-        }
-        EXPECT_LT(oldCurrent, objectManager.tombstoneRemover.currentBucket);
-    }
+    objectManager.tombstoneRemover.handleTimerEvent();
     EXPECT_EQ("handleTimerEvent: Tombstone cleanup complete",
             TestLog::get());
-    EXPECT_EQ(objectManager.objectMap.getNumBuckets(),
-            objectManager.tombstoneRemover.currentBucket);
+    EXPECT_EQ(objectManager.getNumBucketLocksInUse(),
+            objectManager.tombstoneRemover.currentStripe);
+    foreach (string& stringKey, keys) {
+        Key key(0, stringKey.c_str(), downCast<uint16_t>(stringKey.size()));
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_FALSE(objectManager.lookup(lock, key, type, buffer, 0, 0));
+        EXPECT_EQ(0u,
+                objectManager.replayedTombstones[lock.getIndex()].size());
+    }
+}
+
+TEST_F(ObjectManagerTest, removeTombstones_keepsNotReadyTombstones) {
+    LogEntryType type;
+    Buffer buffer;
+    tabletManager.addTablet(1, 0, ~0UL, TabletManager::NOT_READY);
+    Key key0(0, "key0", 4);
+    storeTombstone(key0);
+    Key key1(1, "key1", 4);
+    storeTombstone(key1);
+
+    objectManager.removeTombstones();
     {
-        ObjectManager::HashTableBucketLock lock(objectManager, key1);
-        EXPECT_FALSE(objectManager.lookup(lock, key1, type, buffer, 0, 0));
+        ObjectManager::HashTableBucketLock lock(objectManager, key0);
+        EXPECT_FALSE(objectManager.lookup(lock, key0, type, buffer, 0, 0));
     }
     {
-        ObjectManager::HashTableBucketLock lock(objectManager, key2);
-        EXPECT_FALSE(objectManager.lookup(lock, key2, type, buffer, 0, 0));
+        // The tombstone stays, and is looked at again next time.
+        ObjectManager::HashTableBucketLock lock(objectManager, key1);
+        EXPECT_TRUE(objectManager.lookup(lock, key1, type, buffer, 0, 0));
+        std::vector<KeyHash>& recorded =
+                objectManager.replayedTombstones[lock.getIndex()];
+        ASSERT_EQ(1u, recorded.size());
+        EXPECT_EQ(key1.getHash(), recorded[0]);
     }
+
+    tabletManager.changeState(1, 0, ~0UL, TabletManager::NOT_READY,
+            TabletManager::NORMAL);
+    objectManager.removeTombstones();
+    ObjectManager::HashTableBucketLock lock(objectManager, key1);
+    EXPECT_FALSE(objectManager.lookup(lock, key1, type, buffer, 0, 0));
 }
 
 TEST_F(ObjectManagerTest, TombstoneProtector) {
@@ -2216,7 +3360,7 @@ TEST_F(ObjectManagerTest, TombstoneProtector) {
     Tub<ObjectManager::TombstoneProtector> protector1, protector2;
     protector1.construct(&objectManager);
     protector2.construct(&objectManager);
-    objectManager.tombstoneRemover.currentBucket = 1000;
+    objectManager.tombstoneRemover.currentStripe = 1000;
     EXPECT_EQ(2, objectManager.tombstoneProtectorCount);
 
     protector2.destroy();
@@ -2226,7 +3370,7 @@ TEST_F(ObjectManagerTest, TombstoneProtector) {
     protector1.destroy();
     EXPECT_EQ(0, objectManager.tombstoneProtectorCount);
     EXPECT_TRUE(objectManager.tombstoneRemover.isRunning());
-    EXPECT_EQ(0lu, objectManager.tombstoneRemover.currentBucket);
+    EXPECT_EQ(0lu, objectManager.tombstoneRemover.currentStripe);
 
     // Constructing a TombstoneProtector should stop the WorkerTimer.
     protector1.construct(&objectManager);
@@ -2242,6 +3386,32 @@ TEST_F(ObjectManagerTest, TombstoneProtector) {
             TestLog::get());
 }
 
+TEST_F(ObjectManagerTest, growHashTable_bucketLockHeldAtLastMigration) {
+    HashTable& objectMap = objectManager.objectMap;
+    uint64_t numBuckets = objectMap.getNumBuckets();
+    ASSERT_LT(1u, numBuckets);
+    objectMap.startResize();
+    objectManager.growHashTable(numBuckets - 1);
+    EXPECT_EQ(numBuckets - 1, objectMap.getNextBucketToMigrate());
+
+    // Someone holding a lock keeps the new array from being installed
+    // once the last bucket is moved.
+    SpinLock& lock = objectManager.hashTableBucketLocks[0];
+    lock.lock();
+    objectManager.growHashTable(1);
+    EXPECT_TRUE(objectMap.isResizing());
+    EXPECT_EQ(numBuckets, objectMap.getNextBucketToMigrate());
+    objectManager.growHashTable(1);
+    EXPECT_EQ(numBuckets, objectMap.getNextBucketToMigrate());
+    lock.unlock();
+
+    // A later call finishes without migrating anything more.
+    objectManager.growHashTable(1);
+    EXPECT_FALSE(objectMap.isResizing());
+    EXPECT_EQ(2 * numBuckets, objectMap.getNumBuckets());
+    EXPECT_EQ(0u, objectMap.getNextBucketToMigrate());
+}
+
 TEST_F(ObjectManagerTest, lookup_object) {
     Key key(1, "1", 1);
     Buffer buffer;
@@ -2504,6 +3674,140 @@ TEST_F(ObjectManagerTest, relocateObject_objectAlive) {
               oldBuffer.getStart<uint8_t>());
 }
 
+TEST_F(ObjectManagerTest, relocateObject_compactsDeltas) {
+    Key key(0, "key0", 4);
+    Buffer data;
+    data.appendCopy("item0", 5);
+    objectManager.appendObject(key, &data, 0, 5, NULL, NULL);
+    objectManager.appendObject(key, &data, 4, 1, NULL, NULL);
+    objectManager.appendObject(key, &data, 0, 4, NULL, NULL);
+
+    LogEntryType oldType;
+    Buffer oldBuffer;
+    Log::Reference oldReference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, oldType, oldBuffer, 0,
+                &oldReference));
+    }
+    Buffer entryBuffer;
+    objectManager.log.getEntry(oldReference, entryBuffer);
+
+    TestLog::Enable _("compactObject");
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJ, entryBuffer,
+                           oldReference, relocator);
+    EXPECT_FALSE(relocator.didAppend);
+    EXPECT_EQ(0U, TestLog::get().find(
+            "compactObject: folded 2 deltas into"));
+    EXPECT_EQ(0U, deltasFor(key).chains.size());
+
+    LogEntryType newType;
+    Buffer newBuffer;
+    Log::Reference newReference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, newType, newBuffer, 0,
+                &newReference));
+    }
+    EXPECT_NE(oldReference, newReference);
+    Object object(newBuffer);
+    EXPECT_TRUE(object.checkIntegrity());
+    EXPECT_EQ(3U, object.getVersion());
+    Buffer value;
+    object.appendValueToBuffer(&value);
+    EXPECT_EQ("item00item", TestUtil::toString(&value));
+}
+
+TEST_F(ObjectManagerTest, relocateObject_expired) {
+    Key key(0, "key0", 4);
+    Buffer value;
+    Object object(key, "item0", 5, 0, 0, value);
+    object.setExpiry(100);
+    objectManager.writeObject(object, NULL, NULL);
+    EXPECT_EQ("found=true tableId=0 byteCount=40 recordCount=1"
+              , verifyMetadata(0));
+
+    LogEntryType oldType;
+    Buffer oldBuffer;
+    Log::Reference oldReference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, oldType, oldBuffer, 0,
+                &oldReference));
+    }
+
+    // Not yet expired: the object is relocated as usual.
+    WallTime::mockWallTimeValue = 99;
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJ, oldBuffer,
+                           oldReference, relocator);
+    EXPECT_TRUE(relocator.didAppend);
+
+    Buffer newBuffer;
+    Log::Reference newReference;
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_TRUE(objectManager.lookup(lock, key, oldType, newBuffer, 0,
+                &newReference));
+    }
+
+    TestLog::Enable _("relocateObject");
+    WallTime::mockWallTimeValue = 100;
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJ, newBuffer,
+                           newReference, relocator2);
+    WallTime::mockWallTimeValue = 0;
+    EXPECT_FALSE(relocator2.didAppend);
+    EXPECT_EQ(0U, TestLog::get().find(
+            "relocateObject: dropped expired object"));
+    EXPECT_EQ("found=true tableId=0 byteCount=0 recordCount=0"
+              , verifyMetadata(0));
+    {
+        ObjectManager::HashTableBucketLock lock(objectManager, key);
+        EXPECT_FALSE(objectManager.lookup(lock, key, oldType, newBuffer));
+    }
+}
+
+TEST_F(ObjectManagerTest, relocateObjectDelta) {
+    Key key(0, "key0", 4);
+    Buffer data;
+    data.appendCopy("item0", 5);
+    objectManager.appendObject(key, &data, 0, 5, NULL, NULL);
+    objectManager.appendObject(key, &data, 0, 5, NULL, NULL);
+
+    Log::Reference objectReference;
+    EXPECT_TRUE(lookup(key, &objectReference));
+    std::vector<uint64_t>& chain =
+            deltasFor(key).chains[objectReference.toInteger()];
+    ASSERT_EQ(1U, chain.size());
+    Log::Reference oldReference(chain[0]);
+    Buffer oldBuffer;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJDELTA,
+            objectManager.log.getEntry(oldReference, oldBuffer));
+
+    // A live delta is moved, and its chain follows it.
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJDELTA, oldBuffer,
+                           oldReference, relocator);
+    EXPECT_TRUE(relocator.didAppend);
+    EXPECT_EQ(relocator.getNewReference().toInteger(), chain[0]);
+    Buffer value;
+    objectManager.readObject(key, &value, NULL, NULL, true);
+    EXPECT_EQ("item0item0", TestUtil::toString(&value));
+
+    // A delta that is no longer in a chain is dropped.
+    LogEntryRelocator relocator2(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_OBJDELTA, oldBuffer,
+                           oldReference, relocator2);
+    EXPECT_FALSE(relocator2.didAppend);
+}
+
 TEST_F(ObjectManagerTest, relocateObject_objectDeleted) {
     Key key(0, "key0", 4);
 
@@ -2886,6 +4190,69 @@ TEST_F(ObjectManagerTest, relocatePreparedOpTombstone_clean) {
     EXPECT_FALSE(relocator.didAppend);
 }
 
+TEST_F(ObjectManagerTest, relocatePreparedOpTombstoneBatch_relocate) {
+    Key key(0, "key0", 4);
+    Buffer buffer;
+    bool success = false;
+
+    Buffer value;
+    PreparedOp op(WireFormat::TxPrepare::WRITE, 1UL, 10UL, 10UL,
+                  key, "item1", 5, 0, 0, value);
+    op.assembleForLog(buffer);
+
+    Log::Reference prepReference;
+    success = objectManager.log.append(LOG_ENTRY_TYPE_PREP,
+                                       buffer,
+                                       &prepReference);
+    objectManager.log.sync();
+    EXPECT_TRUE(success);
+
+    // Only the second record refers to a segment that still exists.
+    PreparedOpTombstoneBatch batch(1UL);
+    batch.add(op, 0xBAD);
+    batch.add(op, objectManager.log.getSegmentId(prepReference));
+    buffer.reset();
+    batch.assembleForLog(buffer);
+
+    Log::Reference batchReference;
+    success = objectManager.log.append(
+        LOG_ENTRY_TYPE_PREPTOMBBATCH, buffer, &batchReference);
+    objectManager.log.sync();
+    EXPECT_TRUE(success);
+
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_PREPTOMBBATCH, buffer,
+                           batchReference, relocator);
+    EXPECT_TRUE(relocator.didAppend);
+}
+
+TEST_F(ObjectManagerTest, relocatePreparedOpTombstoneBatch_clean) {
+    Key key(0, "key0", 4);
+    Buffer buffer;
+    bool success = false;
+
+    Buffer value;
+    PreparedOp op(WireFormat::TxPrepare::WRITE, 1UL, 10UL, 10UL,
+                  key, "item1", 5, 0, 0, value);
+    PreparedOpTombstoneBatch batch(1UL);
+    batch.add(op, 0xBAD);
+    batch.add(op, 0xBAD + 1);
+    batch.assembleForLog(buffer);
+
+    Log::Reference batchReference;
+    success = objectManager.log.append(
+        LOG_ENTRY_TYPE_PREPTOMBBATCH, buffer, &batchReference);
+    objectManager.log.sync();
+    EXPECT_TRUE(success);
+
+    LogEntryRelocator relocator(
+        objectManager.segmentManager.getHeadSegment(), 1000);
+    objectManager.relocate(LOG_ENTRY_TYPE_PREPTOMBBATCH, buffer,
+                           batchReference, relocator);
+    EXPECT_FALSE(relocator.didAppend);
+}
+
 TEST_F(ObjectManagerTest, relocateTombstone_basics) {
     TestLog::Enable _(&segmentExists);
     Key key(0, "key0", 4);
@@ -122,6 +122,7 @@ ObjectRpcWrapper::send()
         session = context->objectFinder->tryLookup(tableId, keyHash);
         if (session) {
             state = IN_PROGRESS;
+            RpcTrace::recordSend(&request);
             session->sendRequest(&request, response, this);
         } else {
             retry(0, 0);
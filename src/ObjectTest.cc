@@ -468,6 +468,69 @@ TEST_F(ObjectTest, assembleForLog_contigMemory) {
 
 }
 
+TEST_F(ObjectTest, assembleCompressedForLog) {
+    Key key(57, "key", 3);
+    string value(1000, 'x');
+    Buffer buffer;
+    Object object(key, value.data(), 1000, 75, 723, buffer);
+    object.setExpiry(2000);
+
+    Buffer log;
+    EXPECT_TRUE(object.assembleCompressedForLog(log));
+    EXPECT_GT(100U, log.size());
+    Object compressed(log);
+    EXPECT_TRUE(compressed.isCompressed());
+    EXPECT_TRUE(compressed.checkIntegrity());
+    EXPECT_EQ(75U, compressed.getVersion());
+    EXPECT_EQ(723U, compressed.getTimestamp());
+    EXPECT_EQ(2000U, compressed.getExpiry());
+    EXPECT_EQ("key", string(static_cast<const char*>(compressed.getKey()), 3));
+
+    // Compressing again is pointless.
+    Buffer log2;
+    EXPECT_FALSE(compressed.assembleCompressedForLog(log2));
+    EXPECT_EQ(0U, log2.size());
+
+    // So is compressing tiny values.
+    Buffer smallBuffer;
+    Object small(key, "abc", 3, 75, 723, smallBuffer);
+    EXPECT_FALSE(small.assembleCompressedForLog(log2));
+    EXPECT_EQ(0U, log2.size());
+}
+
+TEST_F(ObjectTest, decompressValue) {
+    Key key(57, "key", 3);
+    string value(1000, 'x');
+    Buffer buffer;
+    Object object(key, value.data(), 1000, 75, 723, buffer);
+    Buffer log;
+    EXPECT_TRUE(object.assembleCompressedForLog(log));
+
+    Object compressed(log);
+    Buffer expanded;
+    compressed.decompressValue(expanded);
+    EXPECT_FALSE(compressed.isCompressed());
+    EXPECT_TRUE(compressed.checkIntegrity());
+    EXPECT_EQ(723U, compressed.getTimestamp());
+    EXPECT_EQ("key", string(static_cast<const char*>(compressed.getKey()), 3));
+    uint32_t valueLength;
+    const void* data = compressed.getValue(&valueLength);
+    EXPECT_EQ(1000U, valueLength);
+    EXPECT_EQ(value, string(static_cast<const char*>(data), valueLength));
+
+    // The object now assembles as if it had never been compressed.
+    Buffer log2;
+    compressed.assembleForLog(log2);
+    Buffer log3;
+    object.assembleForLog(log3);
+    EXPECT_EQ(TestUtil::toString(&log3), TestUtil::toString(&log2));
+
+    // Uncompressed objects are left alone.
+    expanded.reset();
+    compressed.decompressValue(expanded);
+    EXPECT_EQ(0U, expanded.size());
+}
+
 TEST_F(ObjectTest, appendValueToBuffer) {
     for (uint32_t i = 0; i < arrayLength(objects); i++) {
         Object& object = *objects[i];
@@ -765,6 +828,138 @@ TEST_F(ObjectTest, getTimestamp) {
         EXPECT_EQ(723U, objects[i]->getTimestamp());
 }
 
+TEST_F(ObjectTest, setCompactHeader) {
+    Object& object = *objectDataFromBuffer;
+    object.setCompactHeader(true);
+    object.setExpiry(1000);
+    EXPECT_TRUE(object.hasCompactHeader());
+    EXPECT_EQ(40U, object.getSerializedLength());
+
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    EXPECT_EQ(40U, buffer.size());
+    char contiguous[40];
+    object.assembleForLog(contiguous);
+    EXPECT_EQ(0, memcmp(contiguous, buffer.getRange(0, 40), 40));
+
+    Object fromBuffer(buffer);
+    Object fromVoidPointer(contiguous, 40);
+    Object* parsed[] = { &fromBuffer, &fromVoidPointer };
+    for (uint32_t i = 0; i < arrayLength(parsed); i++) {
+        EXPECT_TRUE(parsed[i]->hasCompactHeader());
+        EXPECT_EQ(57U, parsed[i]->getTableId());
+        EXPECT_EQ(75U, parsed[i]->getVersion());
+        EXPECT_EQ(723U, parsed[i]->getTimestamp());
+        EXPECT_EQ(1000U, parsed[i]->getExpiry());
+        EXPECT_TRUE(parsed[i]->checkIntegrity());
+        EXPECT_EQ("YO!", string(reinterpret_cast<const char*>(
+                parsed[i]->getValue())));
+    }
+
+    // The checksum covers the same fields either way, so the header can
+    // change form without recomputing it.
+    EXPECT_EQ(object.computeChecksum(), fromBuffer.header.checksum);
+    fromBuffer.setCompactHeader(false);
+    EXPECT_TRUE(fromBuffer.checkIntegrity());
+    EXPECT_EQ(48U, fromBuffer.getSerializedLength());
+
+    // Versions and table ids that don't fit get a full header.
+    object.setVersion(Object::MAX_COMPACT_VERSION + 1);
+    EXPECT_FALSE(object.hasCompactHeader());
+    EXPECT_EQ(48U, object.getSerializedLength());
+    Key largeKey(Object::MAX_COMPACT_TABLE_ID + 1, "ha", 3);
+    Buffer largeBuffer;
+    Object large(largeKey, "YO!", 4, 75, 723, largeBuffer);
+    large.setCompactHeader(true);
+    EXPECT_FALSE(large.hasCompactHeader());
+}
+
+TEST_F(ObjectTest, setDeferredChecksum) {
+    Object& object = *objectDataFromBuffer;
+    object.setDeferredChecksum(true);
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    char contiguous[44];
+    object.assembleForLog(contiguous);
+    EXPECT_EQ(0, memcmp(contiguous, buffer.getRange(0, 44), 44));
+
+    Object deferred(buffer);
+    EXPECT_TRUE(deferred.hasDeferredChecksum());
+    EXPECT_EQ(object.getVersion(), deferred.getVersion());
+    EXPECT_TRUE(deferred.checkIntegrity());
+    EXPECT_EQ("YO!", string(reinterpret_cast<const char*>(
+            deferred.getValue())));
+
+    // Compressed objects can be deferred too.
+    Key key(57, "key", 3);
+    string value(1000, 'x');
+    Buffer valueBuffer;
+    Object large(key, value.data(), 1000, 75, 723, valueBuffer);
+    large.setDeferredChecksum(true);
+    Buffer log;
+    EXPECT_TRUE(large.assembleCompressedForLog(log));
+    Object compressed(log);
+    EXPECT_TRUE(compressed.hasDeferredChecksum());
+
+    // So can compact ones.
+    large.setCompactHeader(true);
+    Buffer compactLog;
+    large.assembleForLog(compactLog);
+    Object compact(compactLog);
+    EXPECT_TRUE(compact.hasCompactHeader());
+    EXPECT_TRUE(compact.hasDeferredChecksum());
+    EXPECT_EQ(57U, compact.getTableId());
+    EXPECT_EQ(75U, compact.getVersion());
+
+    // Reassembling without deferral gives the object a real checksum.
+    Buffer checksummed;
+    deferred.setDeferredChecksum(false);
+    deferred.assembleForLog(checksummed);
+    Object fromChecksummed(checksummed);
+    EXPECT_FALSE(fromChecksummed.hasDeferredChecksum());
+    EXPECT_EQ(object.computeChecksum(), fromChecksummed.header.checksum);
+    EXPECT_TRUE(fromChecksummed.checkIntegrity());
+
+    // A checksum that is merely zero doesn't skip the check.
+    Buffer zeroed;
+    fromChecksummed.assembleForLog(zeroed);
+    zeroed.getStart<Object::Header>()->checksum = 0;
+    Object damaged(zeroed);
+    EXPECT_FALSE(damaged.hasDeferredChecksum());
+    EXPECT_FALSE(damaged.checkIntegrity());
+}
+
+TEST_F(ObjectTest, setExpiry) {
+    Object& object = *objectDataFromBuffer;
+    object.setExpiry(1000);
+    EXPECT_EQ(723U, object.getTimestamp());
+    EXPECT_EQ(48U, object.getSerializedLength());
+    EXPECT_FALSE(object.isExpired(999));
+    EXPECT_TRUE(object.isExpired(1000));
+
+    Buffer buffer;
+    object.assembleForLog(buffer);
+    EXPECT_EQ(48U, buffer.size());
+    Object fromBuffer(buffer);
+    Object fromVoidPointer(buffer.getRange(0, buffer.size()), buffer.size());
+    Object* parsed[] = { &fromBuffer, &fromVoidPointer };
+    for (uint32_t i = 0; i < arrayLength(parsed); i++) {
+        EXPECT_EQ(1000U, parsed[i]->getExpiry());
+        EXPECT_EQ(723U, parsed[i]->getTimestamp());
+        EXPECT_TRUE(parsed[i]->checkIntegrity());
+        EXPECT_EQ(20U, parsed[i]->getKeysAndValueLength());
+        EXPECT_EQ("ha", string(reinterpret_cast<const char*>(
+                parsed[i]->getKey())));
+        EXPECT_EQ("YO!", string(reinterpret_cast<const char*>(
+                parsed[i]->getValue())));
+    }
+
+    object.setExpiry(0);
+    EXPECT_EQ(723U, object.getTimestamp());
+    EXPECT_EQ(44U, object.getSerializedLength());
+    EXPECT_FALSE(object.isExpired(~0U));
+}
+
 TEST_F(ObjectTest, getSerializedLength) {
     EXPECT_EQ(44U, objects[0]->getSerializedLength());
     EXPECT_EQ(44U, objects[1]->getSerializedLength());
@@ -1090,4 +1285,48 @@ TEST_F(ObjectTombstoneTest, getActualSerializedLength) {
         EXPECT_EQ(37U, tombstones[i]->getSerializedLength());
 }
 
+TEST(ObjectDeltaTest, assembleForLog) {
+    Key key(572, "key!", 4);
+    Buffer data;
+    data.appendCopy("..data!", 7);
+    ObjectDelta delta(key, 58, 723, data, 2, 5);
+    EXPECT_EQ(sizeof32(ObjectDelta::Header) + 9, delta.getSerializedLength());
+
+    Buffer buffer;
+    buffer.appendCopy("junk", 4);
+    delta.assembleForLog(buffer);
+    EXPECT_EQ(4 + delta.getSerializedLength(), buffer.size());
+
+    ObjectDelta fromLog(buffer, 4, buffer.size() - 4);
+    EXPECT_EQ(572U, fromLog.getTableId());
+    EXPECT_EQ("key!", string(reinterpret_cast<const char*>(fromLog.getKey()),
+                             fromLog.getKeyLength()));
+    EXPECT_EQ(58U, fromLog.getVersion());
+    EXPECT_EQ(723U, fromLog.getTimestamp());
+    EXPECT_EQ(5U, fromLog.getDataLength());
+    EXPECT_TRUE(fromLog.checkIntegrity());
+    EXPECT_EQ(delta.computeChecksum(), fromLog.computeChecksum());
+
+    Buffer value;
+    fromLog.appendDataToBuffer(value);
+    EXPECT_EQ("data!", TestUtil::toString(&value));
+}
+
+TEST(ObjectDeltaTest, checkIntegrity) {
+    Key key(572, "key!", 4);
+    Buffer data;
+    data.appendCopy("data!", 5);
+    ObjectDelta delta(key, 58, 723, data, 0, 5);
+    Buffer buffer;
+    delta.assembleForLog(buffer);
+
+    uint8_t* last = static_cast<uint8_t*>(
+            buffer.getRange(buffer.size() - 1, 1));
+    *last = static_cast<uint8_t>(~*last);
+    ObjectDelta corrupt(buffer);
+    EXPECT_FALSE(corrupt.checkIntegrity());
+    *last = static_cast<uint8_t>(~*last);
+    EXPECT_TRUE(corrupt.checkIntegrity());
+}
+
 } // namespace RAMCloud
@@ -0,0 +1,275 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "OnDemandRecovery.h"
+#include "BackupClient.h"
+#include "ClientException.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct an OnDemandRecovery that isn't recovering anything yet.
+ *
+ * \param context
+ *      Overall information about this server.
+ */
+OnDemandRecovery::OnDemandRecovery(Context* context)
+    : context(context)
+    , mutex("OnDemandRecovery::mutex")
+    , active(false)
+    , recoveryId(0)
+    , crashedMasterId()
+    , partitionId(0)
+    , tablets()
+    , backups()
+    , unreplayed()
+    , probing()
+    , pending()
+    , ready()
+    , urgent()
+{
+}
+
+/**
+ * Begin serving reads of a partition that is about to be replayed. The
+ * segments to be replayed must be added with addReplica() before any of
+ * them is replayed.
+ *
+ * \param recoveryId
+ *      The recovery being performed; passed on to the backups.
+ * \param crashedMasterId
+ *      The master whose partition is being recovered.
+ * \param partitionId
+ *      The partition of the crashed master being recovered here.
+ * \param partition
+ *      The tablets of the partition.
+ */
+void
+OnDemandRecovery::start(uint64_t recoveryId, ServerId crashedMasterId,
+        uint64_t partitionId, const ProtoBuf::RecoveryPartition& partition)
+{
+    SpinLock::Guard _(mutex);
+    active = true;
+    this->recoveryId = recoveryId;
+    this->crashedMasterId = crashedMasterId;
+    this->partitionId = partitionId;
+    tablets.clear();
+    foreach (const ProtoBuf::Tablets::Tablet& tablet, partition.tablet()) {
+        tablets.push_back({tablet.table_id(), tablet.start_key_hash(),
+                           tablet.end_key_hash()});
+    }
+}
+
+/**
+ * Record a replica of one of the segments to be replayed.
+ *
+ * \param backupId
+ *      The backup holding the replica.
+ * \param segmentId
+ *      The segment it is a replica of.
+ */
+void
+OnDemandRecovery::addReplica(ServerId backupId, uint64_t segmentId)
+{
+    SpinLock::Guard _(mutex);
+    ++unreplayed[segmentId];
+    if (std::find(backups.begin(), backups.end(), backupId) == backups.end())
+        backups.push_back(backupId);
+}
+
+/**
+ * Find out whether a key of a tablet being recovered can be read yet. The
+ * first time a key is asked for, the backups are asked which segments can't
+ * hold it; this is done without holding the lock, and other threads asking
+ * for the same key meanwhile are told it's PENDING.
+ *
+ * \param key
+ *      The key a client wants to read.
+ * \return
+ *      See KeyState. For PENDING, the segments that may hold the key will
+ *      be returned by nextUrgentSegment().
+ */
+OnDemandRecovery::KeyState
+OnDemandRecovery::checkKey(Key& key)
+{
+    KeyId keyId(key.getTableId(), key.getHash());
+    uint64_t recoveryId;
+    ServerId crashedMasterId;
+    uint64_t partitionId;
+    std::vector<ServerId> backups;
+    {
+        SpinLock::Guard _(mutex);
+        if (!active || !inPartition(keyId))
+            return NOT_RECOVERING;
+        if (contains(ready, keyId))
+            return READY;
+        if (contains(pending, keyId) || contains(probing, keyId))
+            return PENDING;
+        probing.insert(keyId);
+        recoveryId = this->recoveryId;
+        crashedMasterId = this->crashedMasterId;
+        partitionId = this->partitionId;
+        backups = this->backups;
+    }
+
+    // A backup that doesn't answer can't rule out any of its segments.
+    std::vector<Tub<FindRecoveryKeyRpc>> rpcs(backups.size());
+    for (size_t i = 0; i < backups.size(); i++) {
+        rpcs[i].construct(context, backups[i], recoveryId, crashedMasterId,
+                          partitionId, keyId.second);
+    }
+    std::map<uint64_t, uint32_t> absentReplicas;
+    for (size_t i = 0; i < backups.size(); i++) {
+        std::vector<uint64_t> absentFrom;
+        try {
+            rpcs[i]->wait(&absentFrom);
+        } catch (const ClientException& e) {
+            LOG(NOTICE, "Couldn't find out which segments on backup %s can't "
+                "hold key hash 0x%lx: %s", backups[i].toString().c_str(),
+                keyId.second, e.what());
+            continue;
+        }
+        foreach (uint64_t segmentId, absentFrom)
+            ++absentReplicas[segmentId];
+    }
+
+    SpinLock::Guard _(mutex);
+    probing.erase(keyId);
+    if (!active || this->recoveryId != recoveryId)
+        return NOT_RECOVERING;
+
+    std::set<uint64_t> segments;
+    findSegments(absentReplicas, &segments);
+    if (segments.empty()) {
+        ready.insert(keyId);
+        return READY;
+    }
+    urgent.insert(urgent.end(), segments.begin(), segments.end());
+    pending[keyId].swap(segments);
+    return PENDING;
+}
+
+/**
+ * Return the segment that should be replayed next because a pending key
+ * may be in it, if there is one.
+ *
+ * \param[out] segmentId
+ *      Set to the segment to replay next if the result is true.
+ * \return
+ *      True if there was such a segment; false means the segments can
+ *      be replayed in any order.
+ */
+bool
+OnDemandRecovery::nextUrgentSegment(uint64_t* segmentId)
+{
+    SpinLock::Guard _(mutex);
+    while (!urgent.empty()) {
+        uint64_t next = urgent.front();
+        urgent.pop_front();
+        if (contains(unreplayed, next)) {
+            *segmentId = next;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Record that a segment has been replayed completely, so that the pending
+ * keys that are in no other unreplayed segment become readable.
+ *
+ * \param segmentId
+ *      The segment that was replayed.
+ */
+void
+OnDemandRecovery::segmentReplayed(uint64_t segmentId)
+{
+    SpinLock::Guard _(mutex);
+    unreplayed.erase(segmentId);
+    for (auto it = pending.begin(); it != pending.end(); ) {
+        it->second.erase(segmentId);
+        if (it->second.empty()) {
+            ready.insert(it->first);
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Stop serving reads of the partition, because its recovery has finished
+ * (whether or not it succeeded). Reads of its tablets are then handled
+ * according to their state in the TabletManager alone.
+ */
+void
+OnDemandRecovery::finish()
+{
+    SpinLock::Guard _(mutex);
+    active = false;
+    tablets.clear();
+    backups.clear();
+    unreplayed.clear();
+    pending.clear();
+    ready.clear();
+    urgent.clear();
+}
+
+/**
+ * Find the unreplayed segments that may hold a key. A segment is only
+ * ruled out if each of its replicas was: replicas of the crashed master's
+ * head segment may be of different lengths. The caller must hold #mutex.
+ *
+ * \param absentReplicas
+ *      For each segment, the number of backups that said their replica of
+ *      it has no entries for the key.
+ * \param[out] segments
+ *      The segments that may hold the key are added here.
+ */
+void
+OnDemandRecovery::findSegments(
+        const std::map<uint64_t, uint32_t>& absentReplicas,
+        std::set<uint64_t>* segments)
+{
+    foreach (auto& entry, unreplayed) {
+        auto absent = absentReplicas.find(entry.first);
+        if (absent == absentReplicas.end() || absent->second < entry.second)
+            segments->insert(entry.first);
+    }
+}
+
+/**
+ * Returns true if a key lies within the partition being recovered.
+ * The caller must hold #mutex.
+ *
+ * \param keyId
+ *      The key in question.
+ */
+bool
+OnDemandRecovery::inPartition(const KeyId& keyId)
+{
+    foreach (const TabletRange& tablet, tablets) {
+        if (tablet.tableId == keyId.first &&
+                tablet.startKeyHash <= keyId.second &&
+                keyId.second <= tablet.endKeyHash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace RAMCloud
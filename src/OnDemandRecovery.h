@@ -0,0 +1,133 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_ONDEMANDRECOVERY_H
+#define RAMCLOUD_ONDEMANDRECOVERY_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Common.h"
+#include "Key.h"
+#include "RecoveryPartition.pb.h"
+#include "ServerId.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+class Context;
+
+/**
+ * Lets a recovery master serve reads of the tablets it is recovering before
+ * it has replayed its whole partition. A key can be read once every segment
+ * of the crashed master that may hold it has been replayed; which segments
+ * those are is found by asking the backups, which check the key against a
+ * filter of the keys in their recovery segments for the partition (see
+ * WireFormat::BackupFindRecoveryKey). The segments that may hold a key that
+ * is asked for but not yet readable are replayed next, so that keys being
+ * read become available after a few segments rather than after all of
+ * them; until then the reads are retried.
+ *
+ * MasterService::recover() calls start() and finish() around the replay
+ * of a partition, and segmentReplayed() after each segment; reads of the
+ * partition's (NOT_READY) tablets call checkKey().
+ *
+ * This class is thread-safe.
+ */
+class OnDemandRecovery {
+  PUBLIC:
+    /// What checkKey() found out about a key.
+    enum KeyState {
+        /// The key isn't in a partition being recovered here.
+        NOT_RECOVERING,
+        /// Every segment that may hold the key has been replayed.
+        READY,
+        /// The key can't be read yet; its segments will be replayed next.
+        PENDING,
+    };
+
+    explicit OnDemandRecovery(Context* context);
+
+    void start(uint64_t recoveryId, ServerId crashedMasterId,
+               uint64_t partitionId,
+               const ProtoBuf::RecoveryPartition& partition);
+    void addReplica(ServerId backupId, uint64_t segmentId);
+    KeyState checkKey(Key& key);
+    bool nextUrgentSegment(uint64_t* segmentId);
+    void segmentReplayed(uint64_t segmentId);
+    void finish();
+
+  PRIVATE:
+    /// Keys are tracked by table id and key hash; different keys with the
+    /// same hash just wait for the segments of both.
+    typedef std::pair<uint64_t, KeyHash> KeyId;
+
+    /// A range of key hashes of one table in the partition being recovered.
+    struct TabletRange {
+        uint64_t tableId;
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+    };
+
+    void findSegments(const std::map<uint64_t, uint32_t>& absentReplicas,
+                      std::set<uint64_t>* segments);
+    bool inPartition(const KeyId& keyId);
+
+    /// Overall information about this server.
+    Context* context;
+
+    /// Protects all of the members below.
+    SpinLock mutex;
+
+    /// True between start() and finish().
+    bool active;
+
+    /// The recovery being performed; see start().
+    uint64_t recoveryId;
+    ServerId crashedMasterId;
+    uint64_t partitionId;
+
+    /// The tablets of the partition being recovered.
+    std::vector<TabletRange> tablets;
+
+    /// The backups holding replicas of the crashed master's segments.
+    std::vector<ServerId> backups;
+
+    /// Segments not yet replayed, with their number of replicas.
+    std::map<uint64_t, uint32_t> unreplayed;
+
+    /// Keys whose backups are being asked about by some checkKey().
+    std::set<KeyId> probing;
+
+    /// Keys asked for that can't be read yet, with the segments that may
+    /// hold them and haven't been replayed.
+    std::map<KeyId, std::set<uint64_t>> pending;
+
+    /// Keys asked for whose segments have all been replayed.
+    std::set<KeyId> ready;
+
+    /// Segments holding pending keys, in the order they were asked for;
+    /// may include segments that have since been replayed.
+    std::deque<uint64_t> urgent;
+
+    DISALLOW_COPY_AND_ASSIGN(OnDemandRecovery);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_ONDEMANDRECOVERY_H
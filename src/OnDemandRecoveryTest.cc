@@ -0,0 +1,165 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "OnDemandRecovery.h"
+#include "TabletsBuilder.h"
+
+namespace RAMCloud {
+
+class OnDemandRecoveryTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    ServerId backupId;
+    ProtoBuf::RecoveryPartition partition;
+    OnDemandRecovery recovery;
+
+    OnDemandRecoveryTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , backupId()
+        , partition()
+        , recovery(&context)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.localLocator = "mock:host=backup1";
+        config.services = {WireFormat::BACKUP_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        Server* server = cluster.addServer(config);
+        server->backup->testingSkipCallerIdCheck = true;
+        backupId = server->serverId;
+
+        ProtoBuf::Tablets tablets;
+        TabletsBuilder{tablets}
+            (1, 0lu, ~0lu, TabletsBuilder::RECOVERING, 0lu)
+            (2, 0lu, 10lu, TabletsBuilder::RECOVERING, 0lu);
+        for (int i = 0; i < tablets.tablet_size(); i++)
+            *partition.add_tablet() = tablets.tablet(i);
+    }
+
+    static string
+    toString(const std::set<uint64_t>& segments)
+    {
+        string result;
+        foreach (uint64_t segmentId, segments) {
+            if (!result.empty())
+                result += " ";
+            result += format("%lu", segmentId);
+        }
+        return result;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(OnDemandRecoveryTest);
+};
+
+TEST_F(OnDemandRecoveryTest, checkKey_notRecovering) {
+    Key key(1, "a", 1);
+    EXPECT_EQ(OnDemandRecovery::NOT_RECOVERING, recovery.checkKey(key));
+
+    recovery.start(5, ServerId(99, 0), 0, partition);
+    Key otherTable(3, "a", 1);
+    EXPECT_EQ(OnDemandRecovery::NOT_RECOVERING,
+              recovery.checkKey(otherTable));
+    Key outsideRange(2, "a", 1);
+    ASSERT_LT(10lu, outsideRange.getHash());
+    EXPECT_EQ(OnDemandRecovery::NOT_RECOVERING,
+              recovery.checkKey(outsideRange));
+    EXPECT_EQ(OnDemandRecovery::READY, recovery.checkKey(key));
+
+    recovery.finish();
+    EXPECT_EQ(OnDemandRecovery::NOT_RECOVERING, recovery.checkKey(key));
+}
+
+TEST_F(OnDemandRecoveryTest, checkKey_backupCantTell) {
+    // The backup isn't recovering the master, so it can't rule out any of
+    // its segments.
+    recovery.start(5, ServerId(99, 0), 0, partition);
+    recovery.addReplica(backupId, 10);
+    recovery.addReplica(backupId, 11);
+    Key key(1, "a", 1);
+    EXPECT_EQ(OnDemandRecovery::PENDING, recovery.checkKey(key));
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "Couldn't find out which segments on backup " +
+            backupId.toString() + " can't hold key hash"));
+
+    // Only the first query asks the backups.
+    TestLog::reset();
+    EXPECT_EQ(OnDemandRecovery::PENDING, recovery.checkKey(key));
+    EXPECT_EQ("", TestLog::get());
+
+    recovery.segmentReplayed(11);
+    EXPECT_EQ(OnDemandRecovery::PENDING, recovery.checkKey(key));
+    recovery.segmentReplayed(10);
+    EXPECT_EQ(OnDemandRecovery::READY, recovery.checkKey(key));
+    EXPECT_EQ(0u, recovery.pending.size());
+}
+
+TEST_F(OnDemandRecoveryTest, findSegments) {
+    recovery.unreplayed[10] = 2;
+    recovery.unreplayed[11] = 1;
+    recovery.unreplayed[12] = 1;
+    std::map<uint64_t, uint32_t> absentReplicas;
+    absentReplicas[10] = 1;
+    absentReplicas[11] = 1;
+    absentReplicas[13] = 1;
+    std::set<uint64_t> segments;
+    recovery.findSegments(absentReplicas, &segments);
+    EXPECT_EQ("10 12", toString(segments));
+
+    absentReplicas[10] = 2;
+    segments.clear();
+    recovery.findSegments(absentReplicas, &segments);
+    EXPECT_EQ("12", toString(segments));
+}
+
+TEST_F(OnDemandRecoveryTest, nextUrgentSegment) {
+    recovery.start(5, ServerId(99, 0), 0, partition);
+    recovery.addReplica(backupId, 10);
+    recovery.addReplica(backupId, 11);
+    recovery.addReplica(backupId, 12);
+    uint64_t segmentId = 0;
+    EXPECT_FALSE(recovery.nextUrgentSegment(&segmentId));
+
+    Key key(1, "a", 1);
+    recovery.checkKey(key);
+    recovery.segmentReplayed(10);
+    EXPECT_TRUE(recovery.nextUrgentSegment(&segmentId));
+    EXPECT_EQ(11u, segmentId);
+    EXPECT_TRUE(recovery.nextUrgentSegment(&segmentId));
+    EXPECT_EQ(12u, segmentId);
+    EXPECT_FALSE(recovery.nextUrgentSegment(&segmentId));
+}
+
+TEST_F(OnDemandRecoveryTest, finish) {
+    recovery.start(5, ServerId(99, 0), 0, partition);
+    recovery.addReplica(backupId, 10);
+    Key key(1, "a", 1);
+    recovery.checkKey(key);
+    recovery.finish();
+    EXPECT_FALSE(recovery.active);
+    EXPECT_EQ(0u, recovery.backups.size());
+    EXPECT_EQ(0u, recovery.unreplayed.size());
+    EXPECT_EQ(0u, recovery.pending.size());
+    EXPECT_EQ(0u, recovery.urgent.size());
+}
+
+}  // namespace RAMCloud
@@ -234,6 +234,28 @@ OptionParser::setup(int argc, char* argv[])
                 default_value(0),
              "Selects the Ethernet port that the DPDK driver should use, "
              "or -1 if DPDK should not be enabled.")
+            ("dpdkQueues",
+             ProgramOptions::value<int>(&options.dpdkQueues)->
+                default_value(1),
+             "Number of NIC receive queues the DPDK driver spreads incoming "
+             "packets over, each polled by its own thread; 1 means the "
+             "dispatch thread polls the NIC itself.")
+            ("xdpInterface",
+             ProgramOptions::value<string>(&options.xdpInterface)->
+                default_value(""),
+             "Selects the network interface that the AF_XDP driver "
+             "(basic+xdp) should use; empty means AF_XDP is not enabled.")
+            ("xdpQueue",
+             ProgramOptions::value<uint32_t>(&options.xdpQueue)->
+                default_value(0),
+             "Receive queue of --xdpInterface that the AF_XDP driver binds "
+             "to; RAMCloud packets must be steered to it.")
+            ("maxCachedSessions",
+             ProgramOptions::value<uint32_t>(&options.maxCachedSessions)->
+                default_value(0),
+             "Most sessions to keep open to servers that aren't in use; "
+             "the least recently used idle sessions beyond this are closed "
+             "(and reopened when needed). 0 means no limit.")
             ("portTimeout",
              ProgramOptions::value<int32_t>(&options.portTimeout)->
                 default_value(-1), // Overriding to the initial value.
@@ -46,6 +46,10 @@ class CommandLineOptions {
         , portTimeout(0)
         , clusterName()
         , dpdkPort(0)
+        , dpdkQueues(1)
+        , xdpInterface()
+        , xdpQueue(0)
+        , maxCachedSessions(0)
     {
     }
 
@@ -118,6 +122,42 @@ class CommandLineOptions {
         return dpdkPort;
     }
 
+    /**
+     * Returns the number of NIC receive queues the DPDK network driver
+     * should spread incoming packets over; see DpdkDriver.
+     */
+    int getDpdkQueues() const
+    {
+        return dpdkQueues;
+    }
+
+    /**
+     * Returns the name of the network interface the AF_XDP network driver
+     * should use, or an empty string if it shouldn't be enabled.
+     */
+    const string& getXdpInterface() const
+    {
+        return xdpInterface;
+    }
+
+    /**
+     * Returns the receive queue of getXdpInterface() that the AF_XDP
+     * network driver should bind to.
+     */
+    uint32_t getXdpQueue() const
+    {
+        return xdpQueue;
+    }
+
+    /**
+     * Returns the most sessions a TransportManager should keep open once
+     * they are idle; 0 means there is no limit.
+     */
+    uint32_t getMaxCachedSessions() const
+    {
+        return maxCachedSessions;
+    }
+
     string coordinatorLocator;      ///< See getCoordinatorLocator().
     string localLocator;            ///< See getLocalLocator().
     string externalStorageLocator;  ///< See getExternalStorageLocator().
@@ -126,6 +166,10 @@ class CommandLineOptions {
     int32_t  portTimeout;           ///< See getSessionTimeout().
     string clusterName;             ///< See getClusterName().
     int dpdkPort;                   ///< See getDpdkPort().
+    int dpdkQueues;                 ///< See getDpdkQueues().
+    string xdpInterface;            ///< See getXdpInterface().
+    uint32_t xdpQueue;              ///< See getXdpQueue().
+    uint32_t maxCachedSessions;     ///< See getMaxCachedSessions().
 };
 
 /**
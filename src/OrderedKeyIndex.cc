@@ -0,0 +1,198 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "IndexKey.h"
+#include "IndexTree.h"
+#include "OrderedKeyIndex.h"
+
+namespace RAMCloud {
+
+struct OrderedKeyIndex::Table {
+    Table()
+        : tree()
+        , ready(false)
+    {}
+
+    /// The primary keys of the table's objects on this master.
+    IndexTree tree;
+
+    /// False while the tree is still being filled in from the hash table;
+    /// it can't be used for scans until then.
+    bool ready;
+
+    DISALLOW_COPY_AND_ASSIGN(Table);
+};
+
+OrderedKeyIndex::OrderedKeyIndex()
+    : mutex("OrderedKeyIndex::mutex")
+    , tables()
+    , numTables(0)
+{
+}
+
+OrderedKeyIndex::~OrderedKeyIndex()
+{
+    for (auto& entry : tables)
+        delete entry.second;
+}
+
+/**
+ * Forget the primary key of an object that is no longer in the hash table.
+ * Nothing happens unless the key's table is indexed.
+ *
+ * \param key
+ *      Key of the object.
+ */
+void
+OrderedKeyIndex::erase(Key& key)
+{
+    if (numTables.load() == 0)
+        return;
+    SpinLock::Guard _(mutex);
+    auto it = tables.find(key.getTableId());
+    if (it == tables.end())
+        return;
+    it->second->tree.erase(BtreeEntry(key.getStringKey(),
+            key.getStringKeyLength(), key.getHash()));
+}
+
+/**
+ * Indicate that all of a table's objects have been added to its index
+ * since startBuilding was called, so that it can be used for scans.
+ *
+ * \param tableId
+ *      Identifier of the table; startBuilding must have been called for it.
+ */
+void
+OrderedKeyIndex::finishBuilding(uint64_t tableId)
+{
+    SpinLock::Guard _(mutex);
+    auto it = tables.find(tableId);
+    assert(it != tables.end());
+    it->second->ready = true;
+}
+
+/**
+ * Return the primary keys in a range, in order. The table must be ready
+ * (see isReady).
+ *
+ * \param tableId
+ *      Identifier of the table.
+ * \param startKey
+ *      Smallest key to return. Keys are ordered by their bytes, and shorter
+ *      keys come before longer keys they are a prefix of.
+ * \param startKeyLength
+ *      Length of \a startKey in bytes; 0 means the range starts with the
+ *      smallest key in the table.
+ * \param endKey
+ *      Keys from this one on are not returned.
+ * \param endKeyLength
+ *      Length of \a endKey in bytes; 0 means the range has no end.
+ * \param maxKeys
+ *      Return at most this many keys.
+ * \param[out] keys
+ *      The keys are appended here, in order.
+ * \return
+ *      True means that \a maxKeys keys were returned and the range holds
+ *      more keys after them; false means all of the keys in the range
+ *      were returned.
+ */
+bool
+OrderedKeyIndex::getKeys(uint64_t tableId, const void* startKey,
+        KeyLength startKeyLength, const void* endKey, KeyLength endKeyLength,
+        uint32_t maxKeys, vector<string>* keys)
+{
+    SpinLock::Guard _(mutex);
+    auto table = tables.find(tableId);
+    if (table == tables.end())
+        return false;
+    assert(table->second->ready);
+    IndexTree& tree = table->second->tree;
+    uint32_t count = 0;
+    for (IndexTree::iterator it = tree.lower_bound(
+                BtreeEntry(startKey, startKeyLength, 0UL));
+            it != tree.end(); ++it) {
+        BtreeEntry entry = *it;
+        if (endKeyLength != 0 && IndexKey::keyCompare(entry.key,
+                entry.keyLength, endKey, endKeyLength) >= 0) {
+            break;
+        }
+        if (count == maxKeys)
+            return true;
+        keys->emplace_back(static_cast<const char*>(entry.key),
+                entry.keyLength);
+        count++;
+    }
+    return false;
+}
+
+/**
+ * Record the primary key of an object that has been added to the hash
+ * table. Nothing happens unless the key's table is indexed (or being
+ * indexed). Recording a key that is already there is harmless.
+ *
+ * \param key
+ *      Key of the object.
+ */
+void
+OrderedKeyIndex::insert(Key& key)
+{
+    if (numTables.load() == 0)
+        return;
+    SpinLock::Guard _(mutex);
+    auto it = tables.find(key.getTableId());
+    if (it == tables.end())
+        return;
+    it->second->tree.insert(BtreeEntry(key.getStringKey(),
+            key.getStringKeyLength(), key.getHash()));
+}
+
+/**
+ * Returns true if a table's index has been built, so that getKeys can be
+ * used on it.
+ *
+ * \param tableId
+ *      Identifier of the table.
+ */
+bool
+OrderedKeyIndex::isReady(uint64_t tableId)
+{
+    SpinLock::Guard _(mutex);
+    auto it = tables.find(tableId);
+    return it != tables.end() && it->second->ready;
+}
+
+/**
+ * Start indexing a table. From now on, insert and erase keep the table's
+ * index up to date; the caller must then insert the keys of all of the
+ * table's objects that are already in the hash table, and call
+ * finishBuilding. Keys must be inserted with the bucket lock of the hash
+ * table held, so that none of them can be missed, or erased before they
+ * are inserted.
+ *
+ * \param tableId
+ *      Identifier of the table. Nothing happens if it is already indexed.
+ */
+void
+OrderedKeyIndex::startBuilding(uint64_t tableId)
+{
+    SpinLock::Guard _(mutex);
+    if (tables.find(tableId) != tables.end())
+        return;
+    tables[tableId] = new Table();
+    numTables.add(1);
+}
+
+} // namespace RAMCloud
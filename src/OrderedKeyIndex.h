@@ -0,0 +1,80 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_ORDEREDKEYINDEX_H
+#define RAMCLOUD_ORDEREDKEYINDEX_H
+
+#include <unordered_map>
+
+#include "Common.h"
+#include "Atomic.h"
+#include "Key.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * Keeps the primary keys of the objects of some tables on a master in key
+ * order, alongside the hash table, so that ObjectManager::scanObjects can
+ * return the objects in a range of keys without visiting every object of
+ * the table. Each table has its own IndexTree, whose entries are primary
+ * keys and their key hashes.
+ *
+ * A table is only indexed once it has been scanned: ObjectManager builds
+ * the table's tree from the hash table the first time (see startBuilding)
+ * and keeps it up to date from then on. Entries may outlive their objects
+ * (for example, when a tombstone replaces an object during recovery), so
+ * every key returned by getKeys must be looked up in the hash table before
+ * it is used; the index never misses an object, though.
+ *
+ * This class is thread-safe.
+ */
+class OrderedKeyIndex {
+  PUBLIC:
+    OrderedKeyIndex();
+    ~OrderedKeyIndex();
+
+    void erase(Key& key);
+    void finishBuilding(uint64_t tableId);
+    bool getKeys(uint64_t tableId, const void* startKey,
+            KeyLength startKeyLength, const void* endKey,
+            KeyLength endKeyLength, uint32_t maxKeys, vector<string>* keys);
+    void insert(Key& key);
+    bool isReady(uint64_t tableId);
+    void startBuilding(uint64_t tableId);
+
+  PRIVATE:
+    /// The index of a single table. It is defined in OrderedKeyIndex.cc,
+    /// since IndexTree can't be included here: that would make
+    /// ObjectManager.h include itself.
+    struct Table;
+
+    /// Serializes all accesses to #tables and the trees in them.
+    SpinLock mutex;
+
+    /// The tables being indexed, by table identifier.
+    std::unordered_map<uint64_t, Table*> tables;
+
+    /// Number of entries in #tables. Lets insert and erase return without
+    /// taking #mutex on masters that have never been asked for a scan,
+    /// which is by far the common case.
+    Atomic<int> numTables;
+
+    DISALLOW_COPY_AND_ASSIGN(OrderedKeyIndex);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_ORDEREDKEYINDEX_H
@@ -0,0 +1,92 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "OrderedKeyIndex.h"
+
+namespace RAMCloud {
+
+class OrderedKeyIndexTest : public ::testing::Test {
+  public:
+    OrderedKeyIndex index;
+
+    OrderedKeyIndexTest()
+        : index()
+    {}
+
+    void
+    insert(uint64_t tableId, string key)
+    {
+        Key k(tableId, key.data(), downCast<KeyLength>(key.size()));
+        index.insert(k);
+    }
+
+    string
+    getKeys(const string& start, const string& end, uint32_t maxKeys = 100)
+    {
+        vector<string> keys;
+        bool more = index.getKeys(1, start.data(),
+                downCast<KeyLength>(start.size()), end.data(),
+                downCast<KeyLength>(end.size()), maxKeys, &keys);
+        string result;
+        foreach (string& key, keys)
+            result += key + " ";
+        return result + (more ? "more" : "done");
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(OrderedKeyIndexTest);
+};
+
+TEST_F(OrderedKeyIndexTest, insert_onlyIndexedTables) {
+    insert(1, "a");
+    index.startBuilding(1);
+    EXPECT_FALSE(index.isReady(1));
+    insert(1, "b");
+    insert(2, "c");
+    index.finishBuilding(1);
+    EXPECT_TRUE(index.isReady(1));
+    EXPECT_FALSE(index.isReady(2));
+    EXPECT_EQ("b done", getKeys("", ""));
+}
+
+TEST_F(OrderedKeyIndexTest, erase) {
+    index.startBuilding(1);
+    index.finishBuilding(1);
+    insert(1, "a");
+    insert(1, "b");
+    Key key(1, "a", 1);
+    index.erase(key);
+    index.erase(key);
+    EXPECT_EQ("b done", getKeys("", ""));
+}
+
+TEST_F(OrderedKeyIndexTest, getKeys) {
+    index.startBuilding(1);
+    index.finishBuilding(1);
+    insert(1, "b");
+    insert(1, "abc");
+    insert(1, "ab");
+    insert(1, "c");
+    insert(1, "b");
+    EXPECT_EQ("ab abc b c done", getKeys("", ""));
+    EXPECT_EQ("abc b done", getKeys("abc", "c"));
+    EXPECT_EQ("b c done", getKeys("abd", ""));
+    EXPECT_EQ("ab abc more", getKeys("", "", 2));
+    EXPECT_EQ("b c done", getKeys("b", "", 2));
+    EXPECT_EQ("done", getKeys("d", ""));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,208 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ParallelSegmentReplay.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a ParallelSegmentReplay and start its replay threads.
+ *
+ * \param objectManager
+ *      ObjectManager to replay segments into. The caller must hold a
+ *      TombstoneProtector on it for as long as segments are being replayed.
+ * \param numThreads
+ *      Number of threads to replay each segment with, including the
+ *      caller's. 0 is treated as 1.
+ * \param nextNodeIdMap
+ *      Map of B+ tree next node ids to update as objects are replayed (see
+ *      ObjectManager::replaySegment()), or NULL. If there is more than one
+ *      thread the updates are only visible after commit().
+ */
+ParallelSegmentReplay::ParallelSegmentReplay(ObjectManager* objectManager,
+            uint32_t numThreads,
+            std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap)
+    : objectManager(objectManager)
+    , nextNodeIdMap(nextNodeIdMap)
+    , replayers()
+    , threads()
+    , mutex()
+    , changes()
+    , segment(NULL)
+    , segmentsPosted(0)
+    , threadsReplaying(0)
+    , error()
+    , exiting(false)
+{
+    numThreads = std::max(numThreads, 1u);
+    uint64_t numBuckets = objectManager->getObjectMap()->getNumBuckets();
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        replayers.emplace_back(new Replayer(objectManager,
+                {numBuckets, i, numThreads}, i > 0 ? nextNodeIdMap : NULL));
+    }
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.emplace_back(&ParallelSegmentReplay::replayerMain, this, i);
+}
+
+/**
+ * Stop the replay threads. Anything replayed since the last commit() is
+ * aborted when the SideLogs are destroyed.
+ */
+ParallelSegmentReplay::~ParallelSegmentReplay()
+{
+    {
+        Lock _(mutex);
+        exiting = true;
+        changes.notify_all();
+    }
+    foreach (std::thread& thread, threads)
+        thread.join();
+}
+
+/**
+ * Replay a recovery segment, returning once all threads have finished
+ * their part of it.
+ *
+ * \param it
+ *      Iterator positioned at the start of the recovery segment. The caller
+ *      is expected to have already checked the segment's metadata
+ *      integrity.
+ * \throw Exception
+ *      Rethrows the first exception any thread hit while replaying. The
+ *      other threads still finish replaying their parts first.
+ */
+void
+ParallelSegmentReplay::replaySegment(SegmentIterator& it)
+{
+    if (threads.empty()) {
+        replay(*replayers[0], it);
+        return;
+    }
+
+    Lock lock(mutex);
+    segment = &it;
+    ++segmentsPosted;
+    threadsReplaying = downCast<uint32_t>(threads.size());
+    error = nullptr;
+    changes.notify_all();
+    lock.unlock();
+
+    std::exception_ptr callerError;
+    try {
+        SegmentIterator copy(it);
+        replay(*replayers[0], copy);
+    } catch (...) {
+        callerError = std::current_exception();
+    }
+
+    lock.lock();
+    while (threadsReplaying > 0)
+        changes.wait(lock);
+    segment = NULL;
+    if (callerError)
+        std::rethrow_exception(callerError);
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/**
+ * Commit the SideLog of each thread, in thread order, making everything
+ * replayed so far part of the log and durable on backups. Also folds the
+ * threads' next node ids back into the caller's map.
+ */
+void
+ParallelSegmentReplay::commit()
+{
+    foreach (auto& replayer, replayers)
+        replayer->sideLog.commit();
+
+    if (!nextNodeIdMap)
+        return;
+    for (size_t i = 1; i < replayers.size(); ++i) {
+        foreach (auto& entry, replayers[i]->nextNodeIdMap) {
+            uint64_t& nextNodeId = (*nextNodeIdMap)[entry.first];
+            nextNodeId = std::max(nextNodeId, entry.second);
+        }
+    }
+}
+
+// - private -
+
+/**
+ * Replay this replayer's part of a segment.
+ */
+void
+ParallelSegmentReplay::replay(Replayer& replayer, SegmentIterator& it)
+{
+    bool partitioned = replayers.size() > 1;
+    std::unordered_map<uint64_t, uint64_t>* map = nextNodeIdMap;
+    if (partitioned && &replayer != replayers[0].get())
+        map = nextNodeIdMap ? &replayer.nextNodeIdMap : NULL;
+    objectManager->replaySegment(&replayer.sideLog, it, map,
+                                 partitioned ? &replayer.partition : NULL);
+}
+
+/**
+ * Main loop of the threads in #threads: wait for a segment to be posted by
+ * replaySegment(), replay this thread's part of it, and report back.
+ *
+ * \param index
+ *      Which entry of #replayers this thread uses.
+ */
+void
+ParallelSegmentReplay::replayerMain(uint32_t index)
+{
+    Replayer& replayer = *replayers[index];
+    uint64_t segmentsSeen = 0;
+    Lock lock(mutex);
+    while (true) {
+        while (!exiting && segmentsPosted == segmentsSeen)
+            changes.wait(lock);
+        if (exiting)
+            return;
+        segmentsSeen = segmentsPosted;
+        SegmentIterator it(*segment);
+        lock.unlock();
+
+        std::exception_ptr replayError;
+        try {
+            replay(replayer, it);
+        } catch (...) {
+            replayError = std::current_exception();
+        }
+
+        lock.lock();
+        if (replayError && !error)
+            error = replayError;
+        --threadsReplaying;
+        changes.notify_all();
+    }
+}
+
+// -- ParallelSegmentReplay::Replayer --
+
+ParallelSegmentReplay::Replayer::Replayer(ObjectManager* objectManager,
+            ObjectManager::ReplayPartition partition,
+            std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap)
+    : sideLog(objectManager->getLog())
+    , partition(partition)
+    , nextNodeIdMap()
+{
+    if (nextNodeIdMap)
+        this->nextNodeIdMap = *nextNodeIdMap;
+}
+
+} // namespace RAMCloud
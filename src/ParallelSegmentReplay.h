@@ -0,0 +1,135 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_PARALLELSEGMENTREPLAY_H
+#define RAMCLOUD_PARALLELSEGMENTREPLAY_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "Common.h"
+#include "ObjectManager.h"
+#include "SegmentIterator.h"
+#include "SideLog.h"
+
+namespace RAMCloud {
+
+/**
+ * Replays recovery segments into an ObjectManager using several threads.
+ * Every segment is replayed by all threads at once, each taking the
+ * objects and tombstones whose keys fall in its own range of hash table
+ * buckets (see ObjectManager::ReplayPartition) and appending them to its
+ * own SideLog, so the threads neither share a SideLog nor contend for
+ * HashTableBucketLocks. commit() then commits the SideLogs one after the
+ * other in a fixed order.
+ *
+ * With a single thread this is exactly a plain SideLog plus calls to
+ * ObjectManager::replaySegment() on the caller's thread.
+ *
+ * The caller's thread replays partition 0; the others are replayed by
+ * threads owned by this instance. replaySegment() and commit() must be
+ * called from one thread at a time.
+ */
+class ParallelSegmentReplay {
+  PUBLIC:
+    ParallelSegmentReplay(ObjectManager* objectManager, uint32_t numThreads,
+                std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap);
+    ~ParallelSegmentReplay();
+    void replaySegment(SegmentIterator& it);
+    void commit();
+
+  PRIVATE:
+    /**
+     * State private to each thread replaying segments.
+     */
+    struct Replayer {
+        Replayer(ObjectManager* objectManager,
+                 ObjectManager::ReplayPartition partition,
+                 std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap);
+
+        /// Where this replayer appends the entries it replays.
+        SideLog sideLog;
+
+        /// Which part of each segment this replayer is responsible for.
+        ObjectManager::ReplayPartition partition;
+
+        /**
+         * Private copy of the caller's nextNodeIdMap (if any), merged back
+         * into it by commit(). Unused for the caller's own replayer.
+         */
+        std::unordered_map<uint64_t, uint64_t> nextNodeIdMap;
+
+        DISALLOW_COPY_AND_ASSIGN(Replayer);
+    };
+
+    void replay(Replayer& replayer, SegmentIterator& it);
+    void replayerMain(uint32_t index);
+
+    /// Replays segments into this ObjectManager.
+    ObjectManager* objectManager;
+
+    /**
+     * Caller's map of B+ tree next node ids, updated by replay; may be
+     * NULL. See ObjectManager::replaySegment().
+     */
+    std::unordered_map<uint64_t, uint64_t>* nextNodeIdMap;
+
+    /**
+     * One entry per replay thread; entry 0 is used by the caller's thread
+     * and the rest by #threads.
+     */
+    std::vector<std::unique_ptr<Replayer>> replayers;
+
+    /// Threads running replayerMain() for replayers 1 and up.
+    std::vector<std::thread> threads;
+
+    /// Protects all of the fields below.
+    std::mutex mutex;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    /**
+     * Notified when a new segment is posted for replay, when a thread
+     * finishes its part of one, and when the threads should exit.
+     */
+    std::condition_variable changes;
+
+    /// Segment being replayed, or NULL if there is none.
+    SegmentIterator* segment;
+
+    /**
+     * Incremented each time a new segment is posted; lets each thread tell
+     * a new segment from one it has already replayed.
+     */
+    uint64_t segmentsPosted;
+
+    /// Threads in #threads that haven't finished replaying #segment yet.
+    uint32_t threadsReplaying;
+
+    /// The first exception thrown by a thread while replaying #segment.
+    std::exception_ptr error;
+
+    /// Set to tell the threads in #threads to exit.
+    bool exiting;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelSegmentReplay);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_PARALLELSEGMENTREPLAY_H
@@ -0,0 +1,172 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ParallelSegmentReplay.h"
+#include "Segment.h"
+
+namespace RAMCloud {
+
+class ParallelSegmentReplayTest : public ::testing::Test,
+                                  public AbstractLog::ReferenceFreer {
+  public:
+    Context context;
+    ClusterClock clusterClock;
+    ClientLeaseValidator clientLeaseValidator;
+    ServerId serverId;
+    ServerList serverList;
+    ServerConfig masterConfig;
+    MasterTableMetadata masterTableMetadata;
+    ObjectManager objectManager;
+    UnackedRpcResults unackedRpcResults;
+    TransactionManager transactionManager;
+    TxRecoveryManager txRecoveryManager;
+    TabletManager tabletManager;
+    Segment segment;
+    SegmentCertificate certificate;
+    Buffer segmentBuffer;
+
+    ParallelSegmentReplayTest()
+        : context()
+        , clusterClock()
+        , clientLeaseValidator(&context, &clusterClock)
+        , serverId(5)
+        , serverList(&context)
+        , masterConfig(ServerConfig::forTesting())
+        , masterTableMetadata()
+        , objectManager(&context,
+                        &serverId,
+                        &masterConfig,
+                        &tabletManager,
+                        &masterTableMetadata,
+                        &unackedRpcResults,
+                        &transactionManager,
+                        &txRecoveryManager)
+        , unackedRpcResults(&context,
+                            this,
+                            &clientLeaseValidator,
+                            &tabletManager)
+        , transactionManager(&context,
+                             objectManager.getLog(),
+                             &unackedRpcResults,
+                             &tabletManager)
+        , txRecoveryManager(&context)
+        , tabletManager()
+        , segment()
+        , certificate()
+        , segmentBuffer()
+    {
+        objectManager.initOnceEnlisted();
+        tabletManager.addTablet(0, 0, ~0UL, TabletManager::NORMAL);
+
+        // A recovery segment with objects whose 8-byte keys are the numbers
+        // 1 through NUM_OBJECTS, so they also look like B+ tree node ids.
+        for (uint64_t id = 1; id <= NUM_OBJECTS; id++) {
+            Key key(0, &id, sizeof(id));
+            Buffer dataBuffer;
+            Object object(key, "value", 6, 1, 0, dataBuffer);
+            Buffer objectBuffer;
+            object.assembleForLog(objectBuffer);
+            EXPECT_TRUE(segment.append(LOG_ENTRY_TYPE_OBJ, objectBuffer));
+        }
+        segment.close();
+        segment.getAppendedLength(&certificate);
+        segment.appendToBuffer(segmentBuffer);
+    }
+
+    virtual void freeLogEntry(Log::Reference ref) {
+        objectManager.getLog()->free(ref);
+    }
+
+    /// Replay the segment built by the constructor.
+    void
+    replay(ParallelSegmentReplay& replay)
+    {
+        SegmentIterator it(segmentBuffer.getRange(0, segmentBuffer.size()),
+                           segmentBuffer.size(), certificate);
+        replay.replaySegment(it);
+    }
+
+    /// Return the number of objects from the constructor in the hash table.
+    uint64_t
+    countObjects()
+    {
+        uint64_t count = 0;
+        for (uint64_t id = 1; id <= NUM_OBJECTS; id++) {
+            Key key(0, &id, sizeof(id));
+            Buffer value;
+            if (objectManager.readObject(key, &value, NULL, NULL) == STATUS_OK)
+                count++;
+        }
+        return count;
+    }
+
+    enum { NUM_OBJECTS = 30 };
+    DISALLOW_COPY_AND_ASSIGN(ParallelSegmentReplayTest);
+};
+
+TEST_F(ParallelSegmentReplayTest, constructor) {
+    ParallelSegmentReplay replay(&objectManager, 3, NULL);
+    EXPECT_EQ(3lu, replay.replayers.size());
+    EXPECT_EQ(2lu, replay.threads.size());
+    uint64_t numBuckets = objectManager.objectMap.getNumBuckets();
+    EXPECT_EQ(0lu, replay.replayers[0]->partition.firstBucket);
+    EXPECT_EQ(replay.replayers[1]->partition.firstBucket,
+              replay.replayers[0]->partition.endBucket);
+    EXPECT_EQ(numBuckets, replay.replayers[2]->partition.endBucket);
+
+    ParallelSegmentReplay single(&objectManager, 0, NULL);
+    EXPECT_EQ(1lu, single.replayers.size());
+    EXPECT_EQ(0lu, single.threads.size());
+}
+
+TEST_F(ParallelSegmentReplayTest, replaySegment_singleThread) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    ParallelSegmentReplay replay(&objectManager, 1, NULL);
+    this->replay(replay);
+    EXPECT_EQ(uint64_t(NUM_OBJECTS), countObjects());
+}
+
+TEST_F(ParallelSegmentReplayTest, replaySegment_multipleThreads) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    ParallelSegmentReplay replay(&objectManager, 3, NULL);
+    this->replay(replay);
+    EXPECT_EQ(uint64_t(NUM_OBJECTS), countObjects());
+    EXPECT_EQ(0u, replay.threadsReplaying);
+    int sideLogsUsed = 0;
+    foreach (auto& replayer, replay.replayers) {
+        if (!replayer->sideLog.segments.empty())
+            sideLogsUsed++;
+    }
+    EXPECT_LT(1, sideLogsUsed);
+
+    // Replaying the same segment again is harmless.
+    this->replay(replay);
+    EXPECT_EQ(uint64_t(NUM_OBJECTS), countObjects());
+}
+
+TEST_F(ParallelSegmentReplayTest, commit) {
+    ObjectManager::TombstoneProtector p(&objectManager);
+    std::unordered_map<uint64_t, uint64_t> nextNodeIdMap;
+    nextNodeIdMap[0] = 0;
+    ParallelSegmentReplay replay(&objectManager, 3, &nextNodeIdMap);
+    this->replay(replay);
+    replay.commit();
+    EXPECT_EQ(uint64_t(NUM_OBJECTS + 1), nextNodeIdMap[0]);
+    foreach (auto& replayer, replay.replayers)
+        EXPECT_TRUE(replayer->sideLog.segments.empty());
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,220 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "ParallelTableEnumerator.h"
+#include "Dispatch.h"
+
+namespace RAMCloud {
+
+/**
+ * Constructor for ParallelTableEnumerator objects.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster to use for this
+ *      enumeration.
+ * \param tableId
+ *      Identifier for the table to enumerate.
+ * \param keysOnly
+ *      False means that full objects are returned, containing both keys
+ *      and data. True means that the returned objects have
+ *      been truncated so that the object data (normally the last
+ *      field of the object) is omitted.
+ * \param maxOutstanding
+ *      Largest number of tablets to have an enumerate rpc outstanding to
+ *      at once. Each one may return up to about 7 MB of objects, which are
+ *      held until the caller has read them.
+ * \param filter
+ *      If not NULL, the masters only return the objects passing this
+ *      filter, and only the projected parts of their values (which is what
+ *      nextKeyAndData then returns as data). The filter is copied.
+ *
+ * \throw TableDoesntExistException
+ *      The coordinator has no record of the table.
+ */
+ParallelTableEnumerator::ParallelTableEnumerator(RamCloud& ramcloud,
+        uint64_t tableId, bool keysOnly, uint32_t maxOutstanding,
+        const EnumerationFilter* filter)
+    : ramcloud(ramcloud)
+    , tableId(tableId)
+    , keysOnly(keysOnly)
+    , maxOutstanding(maxOutstanding > 0 ? maxOutstanding : 1)
+    , filter()
+    , streams()
+    , ready()
+    , outstanding(0)
+    , done(false)
+{
+    if (filter != NULL)
+        this->filter.construct(*filter);
+    foreach (const TableEnumerator::Cursor& cursor,
+            TableEnumerator::split(ramcloud, tableId, 0)) {
+        streams.emplace_back(cursor);
+    }
+}
+
+/**
+ * Test if any objects remain to be enumerated from the table.
+ *
+ * \result
+ *      True if any objects remain, or false otherwise.
+ */
+bool
+ParallelTableEnumerator::hasNext()
+{
+    requestMoreObjects();
+    return !done;
+}
+
+/**
+ * Return the next object in the table, in the same form as
+ * TableEnumerator::next. The object stays valid until the next call to
+ * any method of this class.
+ *
+ * \param[out] size
+ *      After a successful return, this field will hold the size of
+ *      the object in bytes.
+ * \param[out] object
+ *      After a successful return, this will point to contiguous
+ *      memory containing an instance of Object immediately followed
+ *      by its key and data payloads. NULL is returned to indicate
+ *      that the enumeration is complete.
+ */
+void
+ParallelTableEnumerator::next(uint32_t* size, const void** object)
+{
+    *size = 0;
+    *object = NULL;
+
+    requestMoreObjects();
+    if (done) return;
+
+    Stream* stream = ready.front();
+    uint32_t objectSize =
+            *stream->objects.getOffset<uint32_t>(stream->nextOffset);
+    stream->nextOffset += sizeof32(uint32_t);
+    *object = stream->objects.getRange(stream->nextOffset, objectSize);
+    *size = objectSize;
+    stream->nextOffset += objectSize;
+}
+
+/**
+ * Return the next object in the enumeration, if any, in the same form as
+ * TableEnumerator::nextKeyAndData.
+ *
+ * \param[out] keyLength
+ *      After successful return, this field holds the size of the key in bytes.
+ * \param[out] key
+ *      After a successful return, this points to contiguous memory containing
+ *      the key. NULL is returned to indicate enumeration is complete.
+ * \param[out] dataLength
+ *      After successful return, this field holds the size of the data in bytes.
+ * \param[out] data
+ *      After a successful return, this points to contiguous memory containing
+ *      the data. NULL is returned if keysOnly was set in the constructor.
+ */
+void
+ParallelTableEnumerator::nextKeyAndData(uint32_t* keyLength, const void** key,
+                                        uint32_t* dataLength, const void** data)
+{
+    *keyLength = 0;
+    *key = NULL;
+    *dataLength = 0;
+    *data = NULL;
+
+    uint32_t size = 0;
+    const void* buffer = NULL;
+    next(&size, &buffer);
+    if (done) return;
+
+    Object object(buffer, size);
+    *keyLength = object.getKeyLength();
+    *key = object.getKey();
+    if (!keysOnly) {
+        *data = object.getValue(dataLength);
+    }
+}
+
+/**
+ * Used internally by #hasNext() and #next() to retrieve objects. Sets the
+ * #done field if enumeration is complete; otherwise the front stream in
+ * #ready has at least one object left to read. Streams that need more
+ * objects get an rpc sent to them, up to #maxOutstanding at a time.
+ */
+void
+ParallelTableEnumerator::requestMoreObjects()
+{
+    if (done)
+        return;
+    if (!ready.empty()) {
+        Stream* stream = ready.front();
+        if (stream->nextOffset < stream->objects.size())
+            return;
+        // The caller is done with these objects, so the stream's buffers
+        // can be reused for its next rpc.
+        ready.pop_front();
+    }
+
+    // When invoked in RAMCloud servers there is a separate dispatch thread,
+    // so we just busy-wait here. When invoked on RAMCloud clients we're in
+    // the dispatch thread so we have to invoke the dispatcher while waiting.
+    bool isDispatchThread =
+            ramcloud.clientContext->dispatch->isDispatchThread();
+    while (true) {
+        bool allDone = true;
+        foreach (Stream& stream, streams) {
+            if (stream.done)
+                continue;
+            allDone = false;
+            if (stream.rpc) {
+                if (!stream.rpc->isReady())
+                    continue;
+                stream.tabletStartHash = stream.rpc->wait(stream.state);
+                stream.rpc.destroy();
+                outstanding--;
+                if (stream.objects.size() > 0) {
+                    stream.nextOffset = 0;
+                    ready.push_back(&stream);
+                    continue;
+                }
+                if (stream.tabletStartHash == 0 ||
+                        stream.tabletStartHash > stream.lastHash) {
+                    stream.done = true;
+                    continue;
+                }
+            }
+            if (stream.nextOffset < stream.objects.size()) {
+                // The caller hasn't read these objects yet.
+                continue;
+            }
+            if (outstanding < maxOutstanding) {
+                stream.rpc.construct(&ramcloud, tableId, keysOnly,
+                        stream.tabletStartHash, stream.state, stream.objects,
+                        filter.get(), stream.lastHash);
+                outstanding++;
+            }
+        }
+        if (!ready.empty())
+            return;
+        if (allDone) {
+            done = true;
+            return;
+        }
+        if (isDispatchThread)
+            ramcloud.clientContext->dispatch->poll();
+    }
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,133 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_PARALLELTABLEENUMERATOR_H
+#define RAMCLOUD_PARALLELTABLEENUMERATOR_H
+
+#include <deque>
+
+#include "TableEnumerator.h"
+
+namespace RAMCloud {
+
+/**
+ * Enumerates the objects in a table like TableEnumerator, but keeps an
+ * enumerate rpc outstanding to several tablets at once rather than walking
+ * the tablets one at a time. While the caller reads the objects returned by
+ * one tablet, the masters of the others are already collecting the next
+ * objects, so a table spread over many masters is enumerated at the speed
+ * of the slowest of them rather than their sum.
+ *
+ * The table is split into one stream per tablet (see TableEnumerator::split)
+ * and objects are returned in the order the streams' rpcs complete, so
+ * unlike TableEnumerator the order isn't deterministic. Each object that
+ * existed throughout the enumeration is still returned exactly once.
+ *
+ * Like RamCloud, this class is not thread-safe. To enumerate a table from
+ * several threads instead, divide it with TableEnumerator::split and have
+ * each thread enumerate its cursors with a TableEnumerator on its own
+ * RamCloud object.
+ */
+class ParallelTableEnumerator {
+  public:
+    ParallelTableEnumerator(RamCloud& ramcloud, uint64_t tableId,
+                            bool keysOnly, uint32_t maxOutstanding = 8,
+                            const EnumerationFilter* filter = NULL);
+    ~ParallelTableEnumerator() {}
+    bool hasNext();
+    void next(uint32_t* size, const void** object);
+    void nextKeyAndData(uint32_t* keyLength, const void** key,
+                        uint32_t* dataLength, const void** data);
+
+  PRIVATE:
+    /**
+     * The enumeration of one range of key hashes, initially one tablet.
+     */
+    struct Stream {
+        explicit Stream(const TableEnumerator::Cursor& cursor)
+            : tabletStartHash(cursor.firstHash)
+            , lastHash(cursor.lastHash)
+            , done(false)
+            , state()
+            , objects()
+            , nextOffset(0)
+            , rpc()
+        {}
+
+        /// Where the next rpc continues the enumeration.
+        uint64_t tabletStartHash;
+
+        /// Largest key hash in this stream.
+        uint64_t lastHash;
+
+        /// Set to true once every object of the stream has been received.
+        bool done;
+
+        /// Opaque state of the enumeration, managed by the server.
+        Buffer state;
+
+        /// Objects last received from the server; the rpc in flight (if
+        /// any) fills this in, so a new rpc can only be sent once the
+        /// caller has consumed all of them.
+        Buffer objects;
+
+        /// The next offset to read within #objects.
+        uint32_t nextOffset;
+
+        /// Enumerate rpc in flight for this stream, if any.
+        Tub<EnumerateTableRpc> rpc;
+
+        DISALLOW_COPY_AND_ASSIGN(Stream);
+    };
+
+    void requestMoreObjects();
+
+    /// The RamCloud master object.
+    RamCloud& ramcloud;
+
+    /// The table being enumerated.
+    uint64_t tableId;
+
+    /// False means that full objects are returned, containing both keys
+    /// and data. True means that the object data is omitted.
+    bool keysOnly;
+
+    /// At most this many enumerate rpcs are in flight at once.
+    uint32_t maxOutstanding;
+
+    /// If constructed, only the objects passing this filter are returned,
+    /// with the projected parts of their values.
+    Tub<EnumerationFilter> filter;
+
+    /// One entry for each range of the table, in hash order.
+    std::deque<Stream> streams;
+
+    /// Streams whose #Stream::objects haven't been read yet, in the order
+    /// their rpcs completed. The front one is being read by the caller.
+    std::deque<Stream*> ready;
+
+    /// Number of streams with an rpc in flight.
+    uint32_t outstanding;
+
+    /// Set to true when the entire enumeration has completed.
+    bool done;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelTableEnumerator);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_PARALLELTABLEENUMERATOR_H
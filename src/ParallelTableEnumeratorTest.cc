@@ -0,0 +1,145 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "ParallelTableEnumerator.h"
+
+namespace RAMCloud {
+
+class ParallelTableEnumeratorTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    RamCloud ramcloud;
+    uint64_t tableId;
+
+    ParallelTableEnumeratorTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud(&context, "mock:host=coordinator")
+        , tableId()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        config.localLocator = "mock:host=master2";
+        cluster.addServer(config);
+        config.localLocator = "mock:host=master3";
+        cluster.addServer(config);
+
+        tableId = ramcloud.createTable("table", 3);
+        for (int i = 0; i < 20; i++) {
+            string key = format("%d", i);
+            string value = format("value%d", i);
+            ramcloud.write(tableId, key.c_str(),
+                    downCast<uint16_t>(key.length()),
+                    value.c_str(), downCast<uint32_t>(value.length()));
+        }
+    }
+
+    /// Return "key=value" for every object \a iter enumerates, sorted.
+    string
+    enumerate(ParallelTableEnumerator& iter)
+    {
+        std::set<string> results;
+        uint32_t count = 0;
+        while (iter.hasNext()) {
+            uint32_t keyLength, dataLength;
+            const void* key;
+            const void* data;
+            iter.nextKeyAndData(&keyLength, &key, &dataLength, &data);
+            string entry(static_cast<const char*>(key), keyLength);
+            if (data != NULL) {
+                entry += "=" + string(static_cast<const char*>(data),
+                                      dataLength);
+            }
+            results.insert(entry);
+            count++;
+            EXPECT_LE(iter.outstanding, iter.maxOutstanding);
+        }
+        EXPECT_EQ(count, results.size());
+        string result;
+        foreach (const string& entry, results)
+            result += (result.empty() ? "" : " ") + entry;
+        return result;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelTableEnumeratorTest);
+};
+
+TEST_F(ParallelTableEnumeratorTest, constructor) {
+    ParallelTableEnumerator iter(ramcloud, tableId, false, 0);
+    EXPECT_EQ(3U, iter.streams.size());
+    EXPECT_EQ(1U, iter.maxOutstanding);
+    EXPECT_EQ(0U, iter.outstanding);
+}
+
+TEST_F(ParallelTableEnumeratorTest, basics) {
+    ParallelTableEnumerator iter(ramcloud, tableId, false);
+    EXPECT_EQ("0=value0 1=value1 10=value10 11=value11 12=value12 "
+              "13=value13 14=value14 15=value15 16=value16 17=value17 "
+              "18=value18 19=value19 2=value2 3=value3 4=value4 5=value5 "
+              "6=value6 7=value7 8=value8 9=value9", enumerate(iter));
+    EXPECT_FALSE(iter.hasNext());
+    uint32_t size;
+    const void* object;
+    iter.next(&size, &object);
+    EXPECT_EQ(0U, size);
+    EXPECT_TRUE(object == NULL);
+    foreach (ParallelTableEnumerator::Stream& stream, iter.streams)
+        EXPECT_TRUE(stream.done);
+}
+
+TEST_F(ParallelTableEnumeratorTest, requestMoreObjects_rpcPerStream) {
+    ParallelTableEnumerator iter(ramcloud, tableId, true, 3);
+    EXPECT_TRUE(iter.hasNext());
+
+    // Every stream had an rpc sent right away, and nothing is sent again
+    // to a stream whose objects haven't been read yet.
+    uint32_t withObjects = 0;
+    foreach (ParallelTableEnumerator::Stream& stream, iter.streams) {
+        if (stream.rpc)
+            continue;
+        EXPECT_LT(stream.nextOffset, stream.objects.size());
+        withObjects++;
+    }
+    EXPECT_EQ(withObjects, iter.ready.size());
+    EXPECT_EQ(3U, withObjects + iter.outstanding);
+}
+
+TEST_F(ParallelTableEnumeratorTest, requestMoreObjects_oneOutstanding) {
+    ParallelTableEnumerator iter(ramcloud, tableId, true, 1);
+    EXPECT_EQ("0 1 10 11 12 13 14 15 16 17 18 19 2 3 4 5 6 7 8 9",
+              enumerate(iter));
+}
+
+TEST_F(ParallelTableEnumeratorTest, filter) {
+    EnumerationFilter filter;
+    filter.setKeyPrefix("1", 1);
+    filter.addProjection(5, 2);
+    ParallelTableEnumerator iter(ramcloud, tableId, false, 2, &filter);
+    EXPECT_EQ("1=1 10=10 11=11 12=12 13=13 14=14 15=15 16=16 17=17 18=18 "
+              "19=19", enumerate(iter));
+}
+
+}  // namespace RAMCloud
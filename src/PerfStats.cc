@@ -16,6 +16,7 @@
 #include "Cycles.h"
 #include "Minimal.h"
 #include "PerfStats.h"
+#include "RpcCacheStats.h"
 #include "ServerId.h"
 #include "WireFormat.h"
 
@@ -92,6 +93,9 @@ PerfStats::collectStats(PerfStats* total)
         total->logSyncCycles += stats->logSyncCycles;
         total->segmentUnopenedCycles += stats->segmentUnopenedCycles;
         total->workerActiveCycles += stats->workerActiveCycles;
+        total->dispatchSleepCycles += stats->dispatchSleepCycles;
+        total->dispatchSleeps += stats->dispatchSleeps;
+        total->workerSleepCycles += stats->workerSleepCycles;
         total->btreeNodeReads += stats->btreeNodeReads;
         total->btreeNodeWrites += stats->btreeNodeWrites;
         total->btreeBytesRead += stats->btreeBytesRead;
@@ -99,6 +103,8 @@ PerfStats::collectStats(PerfStats* total)
         total->btreeNodeSplits += stats->btreeNodeSplits;
         total->btreeNodeCoalesces += stats->btreeNodeCoalesces;
         total->btreeRebalances += stats->btreeRebalances;
+        total->txLockConflictAborts += stats->txLockConflictAborts;
+        total->txRejectRuleAborts += stats->txRejectRuleAborts;
         total->compactorInputBytes += stats->compactorInputBytes;
         total->compactorSurvivorBytes += stats->compactorSurvivorBytes;
         total->compactorActiveCycles += stats->compactorActiveCycles;
@@ -117,6 +123,12 @@ PerfStats::collectStats(PerfStats* total)
         total->migrationPhase1Cycles += stats->migrationPhase1Cycles;
         total->networkInputBytes += stats->networkInputBytes;
         total->networkOutputBytes += stats->networkOutputBytes;
+        total->rpcCacheSamples += stats->rpcCacheSamples;
+        total->rpcLlcMisses += stats->rpcLlcMisses;
+        total->rpcRemoteAccesses += stats->rpcRemoteAccesses;
+        total->rpcInstructions += stats->rpcInstructions;
+        total->bufferAllocations += stats->bufferAllocations;
+        total->bufferMallocs += stats->bufferMallocs;
         total->temp1 += stats->temp1;
         total->temp2 += stats->temp2;
         total->temp3 += stats->temp3;
@@ -173,6 +185,14 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "Worker load factor",
             formatMetricRatio(&diff, "workerActiveCycles", "collectionTime",
             " %8.3f").c_str()));
+    result.append(format("%-30s %s\n", "Dispatcher sleep factor",
+            formatMetricRatio(&diff, "dispatchSleepCycles", "collectionTime",
+            " %8.3f").c_str()));
+    result.append(format("%-30s %s\n", "Dispatcher sleeps/sec",
+            formatMetricRate(&diff, "dispatchSleeps", " %8.1f").c_str()));
+    result.append(format("%-30s %s\n", "Worker sleep factor",
+            formatMetricRatio(&diff, "workerSleepCycles", "collectionTime",
+            " %8.3f").c_str()));
 
     result.append("\nReads:\n");
     result.append(format("%-30s %s\n", "  Objects read (K)",
@@ -270,6 +290,14 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "  Node re-balances",
             formatMetric(&diff, "btreeRebalances", " %8.0f").c_str()));
 
+    result.append("\nTransactions:\n");
+    result.append(format("%-30s %s\n", "  Aborts for locks held/sec",
+            formatMetricRate(&diff, "txLockConflictAborts",
+            " %8.1f").c_str()));
+    result.append(format("%-30s %s\n", "  Aborts for reject rules/sec",
+            formatMetricRate(&diff, "txRejectRuleAborts",
+            " %8.1f").c_str()));
+
     result.append("\nBackup service:\n");
     result.append(format("%-30s %s\n", "  Backup bytes received (MB/s)",
             formatMetricRate(&diff, "backupBytesReceived",
@@ -314,6 +342,30 @@ PerfStats::printClusterStats(Buffer* first, Buffer* second)
     result.append(format("%-30s %s\n", "  Output bytes (MB/s)",
             formatMetricRate(&diff, "networkOutputBytes",
             " %8.2f", 1e-6).c_str()));
+
+    result.append("\nCache behavior (sampled RPCs):\n");
+    result.append(format("%-30s %s\n", "  RPCs sampled",
+            formatMetric(&diff, "rpcCacheSamples", " %8.0f").c_str()));
+    result.append(format("%-30s %s\n", "  LLC misses/RPC",
+            formatMetricRatio(&diff, "rpcLlcMisses", "rpcCacheSamples",
+            " %8.1f").c_str()));
+    result.append(format("%-30s %s\n", "  DRAM bytes/RPC",
+            formatMetricRatio(&diff, "rpcLlcMisses", "rpcCacheSamples",
+            " %8.0f", RpcCacheStats::CACHE_LINE_BYTES).c_str()));
+    result.append(format("%-30s %s\n", "  Remote-node loads/RPC",
+            formatMetricRatio(&diff, "rpcRemoteAccesses", "rpcCacheSamples",
+            " %8.1f").c_str()));
+    result.append(format("%-30s %s\n", "  LLC misses/K instructions",
+            formatMetricRatio(&diff, "rpcLlcMisses", "rpcInstructions",
+            " %8.2f", 1e3).c_str()));
+
+    result.append("\nBuffers:\n");
+    result.append(format("%-30s %s\n", "  Extra allocations/sec (K)",
+            formatMetricRate(&diff, "bufferAllocations",
+            " %8.1f", 1e-3).c_str()));
+    result.append(format("%-30s %s\n", "  Mallocs/allocation",
+            formatMetricRatio(&diff, "bufferMallocs", "bufferAllocations",
+            " %8.3f").c_str()));
     return result;
 }
 
@@ -372,6 +424,9 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(writeKeyBytes);
         ADD_METRIC(dispatchActiveCycles);
         ADD_METRIC(workerActiveCycles);
+        ADD_METRIC(dispatchSleepCycles);
+        ADD_METRIC(dispatchSleeps);
+        ADD_METRIC(workerSleepCycles);
         ADD_METRIC(btreeNodeReads);
         ADD_METRIC(btreeNodeWrites);
         ADD_METRIC(btreeBytesRead);
@@ -379,6 +434,8 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(btreeNodeSplits);
         ADD_METRIC(btreeNodeCoalesces);
         ADD_METRIC(btreeRebalances);
+        ADD_METRIC(txLockConflictAborts);
+        ADD_METRIC(txRejectRuleAborts);
         ADD_METRIC(logBytesAppended);
         ADD_METRIC(replicationRpcs);
         ADD_METRIC(logSyncCycles);
@@ -401,6 +458,12 @@ PerfStats::clusterDiff(Buffer* before, Buffer* after,
         ADD_METRIC(migrationPhase1Cycles);
         ADD_METRIC(networkInputBytes);
         ADD_METRIC(networkOutputBytes);
+        ADD_METRIC(rpcCacheSamples);
+        ADD_METRIC(rpcLlcMisses);
+        ADD_METRIC(rpcRemoteAccesses);
+        ADD_METRIC(rpcInstructions);
+        ADD_METRIC(bufferAllocations);
+        ADD_METRIC(bufferMallocs);
         ADD_METRIC(temp1);
         ADD_METRIC(temp2);
         ADD_METRIC(temp3);
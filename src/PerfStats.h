@@ -89,6 +89,18 @@ struct PerfStats {
     /// as a worker.
     uint64_t workerActiveCycles;
 
+    /// Total time (in Cycles::rdtsc ticks) the dispatch thread spent blocked
+    /// in the kernel waiting for work, rather than polling (see
+    /// Dispatch::setIdleSpinTime).
+    uint64_t dispatchSleepCycles;
+
+    /// Number of times the dispatch thread went to sleep waiting for work.
+    uint64_t dispatchSleeps;
+
+    /// Total time (in Cycles::rdtsc ticks) worker threads spent blocked in
+    /// the kernel waiting for RPCs, rather than polling.
+    uint64_t workerSleepCycles;
+
     //--------------------------------------------------------------------
     // Statistics for index operations. Only one copy of PerfStats is
     // kept for all indexing structures, so the numbers below are
@@ -121,6 +133,19 @@ struct PerfStats {
     /// the BtreeEntries between the two (incurs 3 node writes)
     uint64_t btreeRebalances;
 
+    //--------------------------------------------------------------------
+    // Statistics for transactions follow below. Each vote to abort is
+    // counted once, under the first reason found for it.
+    //--------------------------------------------------------------------
+    /// Number of transaction prepares that voted to abort because an object
+    /// was locked by another transaction in progress.
+    uint64_t txLockConflictAborts;
+
+    /// Number of transaction prepares that voted to abort because an object
+    /// failed the transaction's reject rules (typically because it changed
+    /// since the transaction read it).
+    uint64_t txRejectRuleAborts;
+
     //--------------------------------------------------------------------
     // Statistics for log replication follow below. These metrics are
     // related to new information appended to the head segment (i.e., not
@@ -228,6 +253,37 @@ struct PerfStats {
     /// Total bytes transmitted on the network by all transports.
     uint64_t networkOutputBytes;
 
+    //--------------------------------------------------------------------
+    // Statistics from hardware performance counters follow below. They
+    // cover only the requests sampled by RpcCacheStats (which also keeps
+    // them for each opcode).
+    //--------------------------------------------------------------------
+
+    /// Number of requests whose counters were measured.
+    uint64_t rpcCacheSamples;
+
+    /// Total last-level cache misses during the sampled requests.
+    uint64_t rpcLlcMisses;
+
+    /// Total loads served from another NUMA node's memory during the
+    /// sampled requests.
+    uint64_t rpcRemoteAccesses;
+
+    /// Total instructions executed during the sampled requests.
+    uint64_t rpcInstructions;
+
+    //--------------------------------------------------------------------
+    // Statistics for Buffer storage follow below.
+    //--------------------------------------------------------------------
+
+    /// Number of times a Buffer needed storage beyond its internal
+    /// allocation.
+    uint64_t bufferAllocations;
+
+    /// Number of those allocations that couldn't be satisfied from the
+    /// Buffer pools and had to call malloc.
+    uint64_t bufferMallocs;
+
     //--------------------------------------------------------------------
     // Statistics for space used by log in memory and backups.
     // Note: these are NOT counter based statistics.
@@ -0,0 +1,627 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PmemStorage.h"
+#include "ClientException.h"
+#include "Buffer.h"
+#include "Crc32C.h"
+#include "CycleCounter.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+namespace {
+/**
+ * Layout of each superblock image in the file; the checksum covers the
+ * superblock.
+ */
+struct SuperblockContents {
+    SuperblockContents()
+        : superblock()
+        , checksum()
+    {}
+    BackupStorage::Superblock superblock;
+    Crc32C::ResultType checksum;
+} __attribute__((packed));
+}
+
+// --- PmemStorage::Frame ---
+
+/**
+ * Create a Frame associated with the region of the mapping that may hold a
+ * replica in storage.
+ */
+PmemStorage::Frame::Frame(PmemStorage* storage, size_t frameIndex)
+    : storage(storage)
+    , frameIndex(frameIndex)
+    , metadata(storage->base + storage->offsetOfFrame(frameIndex))
+    , data(metadata + METADATA_SIZE)
+    , isOpen()
+    , isClosed()
+    , appendedToByCurrentProcess()
+    , loadRequested()
+{
+}
+
+// See InMemoryStorage::Frame::wasAppendedToByCurrentProcess.
+bool
+PmemStorage::Frame::wasAppendedToByCurrentProcess()
+{
+    return appendedToByCurrentProcess;
+}
+
+/**
+ * No-op for PmemStorage; the metadata is always mapped.
+ */
+void
+PmemStorage::Frame::loadMetadata()
+{
+}
+
+/**
+ * Return a pointer to the most recently appended metadata for this frame.
+ * The same warnings as for InMemoryStorage::Frame::getMetadata apply: only
+ * call this when the frame isn't accepting appends.
+ */
+const void*
+PmemStorage::Frame::getMetadata()
+{
+    return metadata;
+}
+
+/**
+ * Prevents any further append() calls from being accepted; the replica
+ * data is already addressable, so there is nothing to read.
+ */
+void
+PmemStorage::Frame::startLoading()
+{
+    Lock lock(storage->mutex);
+    loadRequested = true;
+}
+
+/**
+ * Returns true if calling load() would not block, which is always the case
+ * for PmemStorage.
+ */
+bool
+PmemStorage::Frame::isLoaded()
+{
+    return true;
+}
+
+/**
+ * Return a pointer to the replica data for recovery. This points directly
+ * into persistent memory, so no copy is made; the data stays valid until
+ * the frame is reused. Prevents any further append() calls from being
+ * accepted.
+ */
+void*
+PmemStorage::Frame::load()
+{
+    startLoading();
+    return data;
+}
+
+/**
+ * Has no effect for PmemStorage.
+ */
+void
+PmemStorage::Frame::unload()
+{
+}
+
+/**
+ * Append data to frame and update metadata. The data is durable before the
+ * metadata is written, and both are durable when this returns, so a backup
+ * that crashes never finds metadata describing data that isn't there.
+ * See InMemoryStorage::Frame::append for the rules for calling this.
+ *
+ * \param source
+ *      Buffer contained the data to be copied into the frame.
+ * \param sourceOffset
+ *      Offset into \a source where data should be copied from.
+ * \param length
+ *      Bytes to copy to the frame starting at \a sourceOffset in \a source.
+ * \param destinationOffset
+ *      Offset into the frame where the source data should be copied.
+ * \param metadata
+ *      Metadata which should be written to storage immediately after the data
+ *      appended is written. May be NULL if there is no updated metadata to
+ *      commit to storage along with this data.
+ * \param metadataLength
+ *      Bytes of metadata pointed to by \a metadata. Ignored if \a metadata
+ *      is NULL.
+ */
+void
+PmemStorage::Frame::append(Buffer& source,
+                           size_t sourceOffset,
+                           size_t length,
+                           size_t destinationOffset,
+                           const void* metadata,
+                           size_t metadataLength)
+{
+    Lock lock(storage->mutex);
+    CycleCounter<uint64_t> ticks;
+    if (!isOpen) {
+        LOG(ERROR, "Tried to append to a frame but it wasn't "
+            "open on this backup");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    if (loadRequested) {
+        LOG(NOTICE, "Tried to append to a frame but it was already enqueued "
+            "for load for recovery; calling master is probably already dead");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    // Three conditions because overflow is possible on addition.
+    if (length > storage->segmentSize ||
+        destinationOffset > storage->segmentSize ||
+        length + destinationOffset > storage->segmentSize)
+    {
+        LOG(ERROR, "Out-of-bounds appended attempted on storage frame: "
+            "offset %lu, length %lu, segmentSize %lu ",
+            destinationOffset, length, storage->segmentSize);
+        throw BackupSegmentOverflowException(HERE);
+    }
+    if (metadataLength > METADATA_SIZE) {
+        LOG(ERROR, "Tried to append to a frame with metadata of length %lu "
+            "but storage only allows max length of %d",
+            metadataLength, METADATA_SIZE);
+        throw BackupSegmentOverflowException(HERE);
+    }
+
+    appendedToByCurrentProcess = true;
+    source.copy(downCast<uint32_t>(sourceOffset),
+                downCast<uint32_t>(length),
+                data + destinationOffset);
+    storage->persist(data + destinationOffset, length);
+
+    if (metadata) {
+        memcpy(this->metadata, metadata, metadataLength);
+        storage->persist(this->metadata, metadataLength);
+    }
+
+    storage->sleepToThrottleWrites(length + metadataLength, ticks.stop());
+}
+
+/**
+ * Mark this frame as closed. Calls to close after a call to load() throw
+ * BackupBadSegmentIdException which should kill the calling master; in this
+ * case recovery has already started for them so they are likely already dead.
+ */
+void
+PmemStorage::Frame::close()
+{
+    Lock lock(storage->mutex);
+    if (isClosed)
+        return;
+    if (loadRequested) {
+        LOG(NOTICE, "Tried to close a frame but it was already enqueued "
+            "for load for recovery; calling master is probably already dead");
+        throw BackupBadSegmentIdException(HERE);
+    }
+    isOpen = false;
+    isClosed = true;
+}
+
+// See BackupStorage.h for documentation.
+void
+PmemStorage::Frame::reopen(size_t length)
+{
+    Lock lock(storage->mutex);
+    isOpen = true;
+    isClosed = false;
+    loadRequested = false;
+}
+
+/**
+ * Do not call; see BackupStorage::freeFrame().
+ * Make this frame available for reuse; data previously stored in this frame
+ * may or may not be part of future recoveries.
+ */
+void
+PmemStorage::Frame::free()
+{
+    Lock lock(storage->mutex);
+    isOpen = false;
+    isClosed = false;
+    storage->freeMap[frameIndex] = 1;
+}
+
+// - private -
+
+/**
+ * Open the frame, resetting its state to accept appends for a new replica.
+ * The old metadata is cleared (durably) so that a crash before the first
+ * append doesn't leave the former replica looking valid; any of its data
+ * that is left behind is caught by the checksums during recovery.
+ *
+ * Idempotence: Duplicate calls to open() are ignored until the frame is freed.
+ * Calling open() after the frame is freed will reset this frame for reuse
+ * with an new replica.
+ */
+void
+PmemStorage::Frame::open()
+{
+    Lock _(storage->mutex);
+    if (isOpen || isClosed)
+        return;
+    isOpen = true;
+    isClosed = false;
+    memset(metadata, '\0', METADATA_SIZE);
+    storage->persist(metadata, METADATA_SIZE);
+    loadRequested = false;
+}
+
+// --- PmemStorage ---
+
+/**
+ * Create a PmemStorage, mapping (and, if needed, creating or growing) the
+ * file that holds the replicas.
+ *
+ * \param segmentSize
+ *      The size in bytes of the segments this storage will deal with.
+ * \param frameCount
+ *      The number of segments this storage can store simultaneously.
+ * \param writeRateLimit
+ *      When specified, writes to this storage instance should be
+ *      limited to at most the given rate (in megabytes per second).
+ *      The special value 0 turns off throttling.
+ * \param filePath
+ *      A file on a DAX filesystem (e.g. /mnt/pmem0/backup) to store the
+ *      replicas in. Any other file works too, but durability then relies
+ *      on msync.
+ * \throw BackupStorageException
+ *      If the file can't be opened, sized, or mapped.
+ */
+PmemStorage::PmemStorage(size_t segmentSize,
+                         size_t frameCount,
+                         size_t writeRateLimit,
+                         const char* filePath)
+    : BackupStorage(segmentSize, Type::PMEM, writeRateLimit)
+    , mutex()
+    , frames()
+    , frameCount(frameCount)
+    , freeMap(frameCount)
+    , lastAllocatedFrame(FreeMap::npos)
+    , superblock()
+    , lastSuperblockFrame(1)
+    , fd(-1)
+    , base(NULL)
+    , mappedBytes(offsetOfFrame(frameCount))
+    , directAccess(false)
+{
+    fd = ::open(filePath, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) {
+        throw BackupStorageException(HERE,
+            format("Failed to open persistent memory file %s", filePath),
+            errno);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 ||
+        (downCast<size_t>(st.st_size) < mappedBytes &&
+         ftruncate(fd, mappedBytes) == -1)) {
+        int e = errno;
+        ::close(fd);
+        throw BackupStorageException(HERE,
+            format("Failed to size persistent memory file %s", filePath), e);
+    }
+
+    void* mapping = MAP_FAILED;
+#ifdef MAP_SYNC
+    mapping = mmap(NULL, mappedBytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+    directAccess = mapping != MAP_FAILED;
+#endif
+    if (mapping == MAP_FAILED) {
+        LOG(WARNING, "%s isn't on a DAX filesystem; durability of replicas "
+            "will rely on msync, which is slow", filePath);
+        mapping = mmap(NULL, mappedBytes, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        int e = errno;
+        ::close(fd);
+        throw BackupStorageException(HERE,
+            format("Failed to map persistent memory file %s", filePath), e);
+    }
+    base = static_cast<char*>(mapping);
+
+    for (size_t frame = 0; frame < frameCount; ++frame)
+        frames.emplace_back(this, frame);
+    freeMap.set();
+
+    LOG(NOTICE, "Backup storage in %s: %lu frames of %lu bytes, %s",
+        filePath, frameCount, segmentSize,
+        directAccess ? "direct access" : "through the page cache");
+}
+
+/**
+ * Unmap and close the persistent memory file. Everything appended is
+ * already durable.
+ */
+PmemStorage::~PmemStorage()
+{
+    munmap(base, mappedBytes);
+    ::close(fd);
+}
+
+/**
+ * Allocate a frame on storage, resetting its state to accept appends for a
+ * new replica. See InMemoryStorage::open for the caller's obligations.
+ *
+ * \param sync
+ *      Ignored for PmemStorage. All append() calls store data
+ *      synchronously.
+ * \param masterId
+ *      The server that owns the segment associated with this replica.
+ * \param segmentId
+ *      Unique identifier (in the log of masterId) of the segment
+ *      associated with this replica.
+ * \return
+ *      Reference to a frame through which handles all IO for a single
+ *      replica. Maintains a reference count; when destroyed if the
+ *      reference count drops to zero the frame will be freed for reuse with
+ *      another replica.
+ */
+BackupStorage::FrameRef
+PmemStorage::open(bool sync, ServerId masterId, uint64_t segmentId)
+{
+    Lock lock(mutex);
+    FreeMap::size_type next = freeMap.find_next(lastAllocatedFrame);
+    if (next == FreeMap::npos) {
+        next = freeMap.find_first();
+        if (next == FreeMap::npos) {
+            RAMCLOUD_CLOG(NOTICE, "Rejecting open: no free storage frames");
+            throw BackupOpenRejectedException(HERE);
+        }
+    }
+    lastAllocatedFrame = next;
+    size_t frameIndex = next;
+    assert(freeMap[frameIndex] == 1);
+    freeMap[frameIndex] = 0;
+    Frame* frame = &frames[frameIndex];
+    lock.unlock();
+    frame->open();
+    return {frame, BackupStorage::freeFrame};
+}
+
+// See InMemoryStorage::getMetadataSize.
+size_t
+PmemStorage::getMetadataSize()
+{
+    return METADATA_SIZE;
+}
+
+/**
+ * Marks ALL storage frames as allocated. This should only be performed at
+ * backup startup. The caller is reponsible for freeing the frames if the
+ * metadata indicates the replica data stored there isn't useful.
+ *
+ * \return
+ *      Pointer to every frame which has various uses depending on the
+ *      metadata that is found in that frame. BackupService code is expected
+ *      to examine the metadata and either free the frame or take note of the
+ *      metadata in the frame for potential use in future recoveries.
+ */
+std::vector<BackupStorage::FrameRef>
+PmemStorage::loadAllMetadata()
+{
+    std::vector<FrameRef> ret;
+    ret.reserve(frames.size());
+    foreach (auto& frame, frames) {
+        frame.loadMetadata();
+        assert(freeMap[frame.frameIndex] == 1);
+        freeMap[frame.frameIndex] = 0;
+        ret.push_back({&frame, BackupStorage::freeFrame});
+    }
+    return ret;
+}
+
+/**
+ * Durably record a new superblock; see MultiFileStorage::resetSuperblock,
+ * which this mirrors: the older of the two images is overwritten first so
+ * that a crash in the middle leaves the other intact.
+ *
+ * \param serverId
+ *      The server id of the process using this storage.
+ * \param clusterName
+ *      Controls the reuse of replicas stored on this backup; see
+ *      MultiFileStorage::resetSuperblock.
+ * \param frameSkipMask
+ *      Used for testing. Setting frameSkipMask to 0x1 skips writing the
+ *      first superblock image, 0x2 skips the second, and 0x3 skips both.
+ */
+void
+PmemStorage::resetSuperblock(ServerId serverId,
+                             const string& clusterName,
+                             const uint32_t frameSkipMask)
+{
+    SuperblockContents contents;
+    contents.superblock =
+        Superblock(superblock.version + 1, serverId, clusterName.c_str());
+    Crc32C crc;
+    crc.update(&contents.superblock, sizeof(contents.superblock));
+    contents.checksum = crc.getResult();
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        const uint32_t nextFrame = (lastSuperblockFrame + 1) % 2;
+        if (!((frameSkipMask >> nextFrame) & 0x01)) {
+            char* image = base + nextFrame * SUPERBLOCK_SIZE;
+            memcpy(image, &contents, sizeof(contents));
+            persist(image, sizeof(contents));
+            LOG(DEBUG, "Superblock frame %u written", nextFrame);
+        }
+        lastSuperblockFrame = nextFrame;
+    }
+
+    superblock = contents.superblock;
+}
+
+/**
+ * Read both superblock images and return the most up-to-date and complete
+ * superblock since the last resetSuperblock().
+ *
+ * \return
+ *      The most up-to-date complete superblock found on storage.  If no
+ *      superblock can be found a default superblock is returned which
+ *      indicates no prior backup instance left behind intelligible
+ *      traces of life on storage.
+ */
+BackupStorage::Superblock
+PmemStorage::loadSuperblock()
+{
+    Tub<Superblock> left = tryLoadSuperblock(0);
+    Tub<Superblock> right = tryLoadSuperblock(1);
+
+    bool chooseLeft = false;
+    if (left && right) {
+        chooseLeft = left->version >= right->version;
+    } else if (!left && !right) {
+        LOG(WARNING,
+            "Backup couldn't find existing superblock; "
+            "starting as fresh backup.");
+        right.construct();
+        chooseLeft = false;
+    } else {
+        chooseLeft = left;
+    }
+
+    if (chooseLeft) {
+        superblock = *left;
+        lastSuperblockFrame = 0;
+    } else {
+        superblock = *right;
+        lastSuperblockFrame = 1;
+    }
+
+    LOG(DEBUG,
+        "Reloading backup superblock (version %lu, superblockFrame %u) "
+        "from previous run", superblock.version, lastSuperblockFrame);
+    return superblock;
+}
+
+/**
+ * No-op for PmemStorage; append() is always synchronous.
+ */
+void
+PmemStorage::quiesce()
+{
+}
+
+/**
+ * Scribble on the metadata of every frame and both superblock images so
+ * that no replicas are found on storage by future backups.
+ */
+void
+PmemStorage::fry()
+{
+    memset(base, '\0', 2 * SUPERBLOCK_SIZE);
+    persist(base, 2 * SUPERBLOCK_SIZE);
+    foreach (Frame& frame, frames) {
+        memset(frame.metadata, '\0', METADATA_SIZE);
+        persist(frame.metadata, METADATA_SIZE);
+    }
+}
+
+// - private -
+
+/**
+ * Return the offset in the file of a frame's metadata block; the replica
+ * data follows it. Frames start after the two superblock images.
+ *
+ * \param frameIndex
+ *      Frame to locate; frameCount gives the size of the file.
+ */
+size_t
+PmemStorage::offsetOfFrame(size_t frameIndex) const
+{
+    return 2 * SUPERBLOCK_SIZE + frameIndex * (METADATA_SIZE + segmentSize);
+}
+
+/**
+ * Make a range of the mapping durable. With a DAX mapping the cache lines
+ * are flushed and fenced, which is all it takes; otherwise the dirty pages
+ * are written back with msync.
+ *
+ * \param address
+ *      First byte of the range, in the mapping.
+ * \param length
+ *      Bytes in the range.
+ */
+void
+PmemStorage::persist(const void* address, size_t length)
+{
+    if (length == 0)
+        return;
+    uintptr_t start = reinterpret_cast<uintptr_t>(address);
+    uintptr_t end = start + length;
+    if (directAccess) {
+        start &= ~(uintptr_t(CACHE_LINE_SIZE) - 1);
+        for (uintptr_t line = start; line < end; line += CACHE_LINE_SIZE)
+            _mm_clflush(reinterpret_cast<const void*>(line));
+        _mm_sfence();
+        return;
+    }
+    uintptr_t pageSize = downCast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    start &= ~(pageSize - 1);
+    if (msync(reinterpret_cast<void*>(start), end - start, MS_SYNC) == -1) {
+        DIE("Failed to flush backup storage; cannot continue safely: %s",
+            strerror(errno));
+    }
+}
+
+/**
+ * Check one of the superblock images.
+ *
+ * \param superblockFrame
+ *      Which of the two superblock images to check.
+ * \return
+ *      The superblock stored at \a superblockFrame if its checksum is
+ *      correct; otherwise empty.
+ */
+Tub<BackupStorage::Superblock>
+PmemStorage::tryLoadSuperblock(uint32_t superblockFrame)
+{
+    SuperblockContents contents;
+    memcpy(&contents, base + superblockFrame * SUPERBLOCK_SIZE,
+           sizeof(contents));
+
+    Crc32C crc;
+    crc.update(&contents.superblock, sizeof(contents.superblock));
+    uint32_t checksum = crc.getResult();
+    if (contents.checksum != checksum) {
+        LOG(NOTICE, "Stored superblock had a bad checksum: "
+            "stored checksum was %x, but stored data had checksum %x",
+            contents.checksum, checksum);
+        return {};
+    }
+    char& endOfName =
+        contents.superblock.clusterName[
+            sizeof(contents.superblock.clusterName) - 1];
+    if (endOfName != '\0')
+        DIE("Stored superblock's cluster name should end in \\0; "
+            "this should never happen unless there is a software bug");
+
+    return { contents.superblock };
+}
+
+} // namespace RAMCloud
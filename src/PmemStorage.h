@@ -0,0 +1,193 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_PMEMSTORAGE_H
+#define RAMCLOUD_PMEMSTORAGE_H
+
+#include <deque>
+
+#include "Common.h"
+#include "BackupStorage.h"
+#include "MultiFileStorage.h"
+
+namespace RAMCloud {
+
+/**
+ * A BackupStorage backend which keeps replicas in persistent memory (for
+ * example, a file on a DAX filesystem backed by NVDIMMs or CXL memory).
+ * The whole file is mapped into the address space: append() copies data
+ * straight into a frame's mapping and makes it durable by flushing the CPU
+ * cache lines it touched, with no block IO or staging buffers, and load()
+ * returns a pointer into the mapping, so recovery segments are built from
+ * replicas without copying them first.
+ *
+ * If the file can't be mapped with MAP_SYNC (e.g. it isn't on a DAX
+ * filesystem) the mapping goes through the page cache and data is made
+ * durable with msync instead; that is slow, but handy for testing.
+ *
+ * The file contains two superblock images (see resetSuperblock) followed by
+ * the frames, each of which is a metadata block followed by a segment's
+ * worth of replica data. Appends are always synchronous.
+ */
+class PmemStorage : public BackupStorage {
+  public:
+    /**
+     * Represents the region of the mapping which holds a single replica.
+     * PmemStorage keeps exactly one frame for each such region; frames get
+     * reused for different replicas making a frame something of a state
+     * machine. See InMemoryStorage::Frame, which this mirrors, except that
+     * the data and metadata live in persistent memory.
+     */
+    class Frame : public BackupStorage::Frame {
+      PUBLIC:
+        typedef std::unique_lock<std::mutex> Lock;
+
+        Frame(PmemStorage* storage, size_t frameIndex);
+
+        bool wasAppendedToByCurrentProcess();
+
+        void loadMetadata();
+        const void* getMetadata();
+
+        void startLoading();
+        bool isLoaded();
+        bool currentlyOpen() {return isOpen;}
+        void* load();
+        void unload();
+
+        void append(Buffer& source,
+                    size_t sourceOffset,
+                    size_t length,
+                    size_t destinationOffset,
+                    const void* metadata,
+                    size_t metadataLength);
+        void close();
+        void reopen(size_t length);
+        void free();
+
+      PRIVATE:
+        void open();
+
+        /// Storage where this frame resides.
+        PmemStorage* storage;
+
+        /// Index of the frame in #storage.frames. Used to mark the frame free.
+        const size_t frameIndex;
+
+        /// Metadata block of this frame, in the mapping.
+        char* metadata;
+
+        /// Replica data of this frame, in the mapping.
+        char* data;
+
+        /**
+         * Tracks whether a replica has been opened (either initially or
+         * since the time of the last free). False if #isClosed.
+         */
+        bool isOpen;
+
+        /**
+         * Tracks whether a replica has been closed (either initially or
+         * since the time of the last free). False if #isOpen.
+         */
+        bool isClosed;
+
+        /// See BackupStorage::Frame::wasAppendedToByCurrentProcess.
+        bool appendedToByCurrentProcess;
+
+        /// True if the replica data has been requested; appends are
+        /// rejected afterwards.
+        bool loadRequested;
+
+        friend class PmemStorage;
+        DISALLOW_COPY_AND_ASSIGN(Frame);
+    };
+
+    PmemStorage(size_t segmentSize,
+                size_t frameCount,
+                size_t writeRateLimit,
+                const char* filePath);
+    ~PmemStorage();
+
+    FrameRef open(bool sync, ServerId masterId, uint64_t segmentId);
+    size_t getMetadataSize();
+    std::vector<FrameRef> loadAllMetadata();
+    void resetSuperblock(ServerId serverId,
+                         const string& clusterName,
+                         uint32_t frameSkipMask = 0);
+    Superblock loadSuperblock();
+    void quiesce();
+    void fry();
+
+  PRIVATE:
+    /// Maximum size of metadata for each frame; the same as for disks so
+    /// that BackupReplicaMetadata fits.
+    enum { METADATA_SIZE = MultiFileStorage::METADATA_SIZE };
+
+    /// Space reserved for each of the two superblock images.
+    enum { SUPERBLOCK_SIZE = 4096 };
+    static_assert(sizeof(Superblock) + sizeof(uint32_t) <= SUPERBLOCK_SIZE,
+                  "Superblock doesn't fit in its space on storage");
+
+    size_t offsetOfFrame(size_t frameIndex) const;
+    void persist(const void* address, size_t length);
+    Tub<Superblock> tryLoadSuperblock(uint32_t superblockFrame);
+
+    /// Protects concurrent operations on storage and all of its frames.
+    std::mutex mutex;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    /// One Frame for each replica-sized region of the mapping.
+    std::deque<Frame> frames;
+
+    /// The number of replicas this storage can store simultaneously.
+    const size_t frameCount;
+
+    /// Type of the freeMap.  A bitmap.
+    typedef boost::dynamic_bitset<> FreeMap;
+    /// Keeps a bit set for each frame in frames indicating if it is free.
+    FreeMap freeMap;
+
+    /// Most recently allocated frame; frames are allocated in FIFO order,
+    /// as in InMemoryStorage.
+    FreeMap::size_type lastAllocatedFrame;
+
+    /// Holds the most recent image of the superblock.
+    Superblock superblock;
+
+    /// Tracks which of the superblock images was most recently written.
+    uint32_t lastSuperblockFrame;
+
+    /// File descriptor of the persistent memory file.
+    int fd;
+
+    /// Start of the mapping of the whole file.
+    char* base;
+
+    /// Number of bytes in the mapping.
+    size_t mappedBytes;
+
+    /**
+     * True if the file is mapped with MAP_SYNC, so flushing cache lines
+     * makes data durable; false means msync is needed.
+     */
+    bool directAccess;
+
+    DISALLOW_COPY_AND_ASSIGN(PmemStorage);
+};
+
+} // namespace RAMCloud
+
+#endif
@@ -0,0 +1,158 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "PmemStorage.h"
+
+namespace RAMCloud {
+
+class PmemStorageTest : public ::testing::Test {
+  public:
+    typedef PmemStorage::Frame Frame;
+
+    const char* test;
+    uint32_t testLength;
+    Buffer testSource;
+    uint32_t segmentFrames;
+    uint32_t segmentSize;
+    const char* filePath;
+    Tub<PmemStorage> storage;
+
+    PmemStorageTest()
+        : test("test")
+        , testLength(downCast<uint32_t>(strlen(test)))
+        , testSource()
+        , segmentFrames(4)
+        , segmentSize(4096)
+        , filePath("/tmp/ramcloud-pmem-storage-test-delete-this")
+        , storage()
+    {
+        Logger::get().setLogLevels(SILENT_LOG_LEVEL);
+        testSource.appendExternal(test, testLength + 1);
+        unlink(filePath);
+        storage.construct(segmentSize, segmentFrames, 0, filePath);
+    }
+
+    ~PmemStorageTest()
+    {
+        storage.destroy();
+        unlink(filePath);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(PmemStorageTest);
+};
+
+TEST_F(PmemStorageTest, constructor) {
+    struct stat st;
+    ASSERT_EQ(0, stat(filePath, &st));
+    EXPECT_EQ(storage->offsetOfFrame(segmentFrames),
+              downCast<size_t>(st.st_size));
+    EXPECT_EQ(segmentFrames, storage->frames.size());
+    EXPECT_TRUE(storage->freeMap.all());
+}
+
+TEST_F(PmemStorageTest, open) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    EXPECT_EQ(0u, storage->freeMap[0]);
+    EXPECT_EQ(1u, storage->freeMap[1]);
+    frame.reset();
+    EXPECT_EQ(1u, storage->freeMap[0]);
+
+    std::vector<BackupStorage::FrameRef> frames;
+    for (uint32_t i = 0; i < segmentFrames; ++i)
+        frames.push_back(storage->open(false, ServerId(), 0));
+    EXPECT_THROW(storage->open(false, ServerId(), 0),
+                 BackupOpenRejectedException);
+}
+
+TEST_F(PmemStorageTest, Frame_append) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    frame->append(testSource, 0, testLength + 1, 10, test, testLength + 1);
+    void* replica = frame->load();
+    EXPECT_EQ(storage->base + storage->offsetOfFrame(0) +
+              PmemStorage::METADATA_SIZE, replica);
+    EXPECT_STREQ("test", static_cast<char*>(replica) + 10);
+    EXPECT_STREQ("test", static_cast<const char*>(frame->getMetadata()));
+
+    // No appends after load.
+    EXPECT_THROW(frame->append(testSource, 0, 1, 0, NULL, 0),
+                 BackupBadSegmentIdException);
+}
+
+TEST_F(PmemStorageTest, Frame_appendOverflow) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    EXPECT_THROW(frame->append(testSource, 0, 2, segmentSize - 1, NULL, 0),
+                 BackupSegmentOverflowException);
+    EXPECT_THROW(frame->append(testSource, 0, 1, 0, test,
+                               PmemStorage::METADATA_SIZE + 1),
+                 BackupSegmentOverflowException);
+}
+
+TEST_F(PmemStorageTest, Frame_openClearsMetadata) {
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    frame->append(testSource, 0, testLength + 1, 0, test, testLength + 1);
+    frame->close();
+    frame.reset();
+    storage->lastAllocatedFrame = PmemStorage::FreeMap::npos;
+    frame = storage->open(false, ServerId(), 0);
+    EXPECT_STREQ("", static_cast<const char*>(frame->getMetadata()));
+}
+
+TEST_F(PmemStorageTest, replicasSurviveRestart) {
+    storage->resetSuperblock(ServerId(5, 1), "testing");
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    frame->append(testSource, 0, testLength + 1, 0, test, testLength + 1);
+    frame->close();
+    frame.reset();
+    storage.destroy();
+
+    storage.construct(segmentSize, segmentFrames, 0, filePath);
+    BackupStorage::Superblock superblock = storage->loadSuperblock();
+    EXPECT_EQ(ServerId(5, 1), superblock.getServerId());
+    EXPECT_STREQ("testing", superblock.getClusterName());
+    std::vector<BackupStorage::FrameRef> frames = storage->loadAllMetadata();
+    ASSERT_EQ(segmentFrames, frames.size());
+    EXPECT_STREQ("test", static_cast<const char*>(frames[0]->getMetadata()));
+    EXPECT_STREQ("test", static_cast<char*>(frames[0]->load()));
+}
+
+TEST_F(PmemStorageTest, loadSuperblock) {
+    storage->resetSuperblock(ServerId(1, 0), "old");
+    storage->resetSuperblock(ServerId(2, 0), "new", 0x1);
+    BackupStorage::Superblock superblock = storage->loadSuperblock();
+    EXPECT_EQ(2u, superblock.version);
+    EXPECT_STREQ("new", superblock.getClusterName());
+
+    // A damaged image is ignored in favor of the other one.
+    ++storage->base[PmemStorage::SUPERBLOCK_SIZE];
+    superblock = storage->loadSuperblock();
+    EXPECT_EQ(1u, superblock.version);
+    EXPECT_STREQ("old", superblock.getClusterName());
+
+    ++storage->base[0];
+    superblock = storage->loadSuperblock();
+    EXPECT_EQ(0u, superblock.version);
+}
+
+TEST_F(PmemStorageTest, fry) {
+    storage->resetSuperblock(ServerId(1, 0), "testing");
+    BackupStorage::FrameRef frame = storage->open(false, ServerId(), 0);
+    frame->append(testSource, 0, testLength + 1, 0, test, testLength + 1);
+    storage->fry();
+    EXPECT_STREQ("", static_cast<const char*>(frame->getMetadata()));
+    EXPECT_EQ(0u, storage->loadSuperblock().version);
+}
+
+}  // namespace RAMCloud
@@ -281,4 +281,102 @@ PreparedOpTombstone::computeChecksum()
     return crc.getResult();
 }
 
+/**
+ * Construct an empty batch, to which the tombstones of a transaction's
+ * operations are then added.
+ *
+ * \param leaseId
+ *      leaseId of the client that initiated the transaction.
+ */
+PreparedOpTombstoneBatch::PreparedOpTombstoneBatch(uint64_t leaseId)
+    : header(leaseId)
+    , records()
+{
+}
+
+/**
+ * Construct a batch by deserializing one from the log or from a log segment.
+ *
+ * \param buffer
+ *      Buffer pointing to a complete serialized batch, starting at offset 0.
+ *      It is the caller's responsibility to make sure that the buffer
+ *      actually contains a full batch. If it does not, then behavior is
+ *      undefined.
+ */
+PreparedOpTombstoneBatch::PreparedOpTombstoneBatch(Buffer& buffer)
+    : header(*buffer.getStart<Header>())
+    , records(header.count)
+{
+    if (header.count > 0) {
+        buffer.copy(sizeof32(Header), header.count * sizeof32(Record),
+                    &records[0]);
+    }
+}
+
+/**
+ * Add the tombstone of a completed PreparedOp to the batch.
+ *
+ * \param op
+ *      The PreparedOp being marked as completed; it must have been issued
+ *      under the batch's lease.
+ * \param segmentId
+ *      The 64-bit identifier of the segment in which the PreparedOp exists.
+ */
+void
+PreparedOpTombstoneBatch::add(PreparedOp& op, uint64_t segmentId)
+{
+    assert(op.header.clientId == header.clientLeaseId);
+    uint64_t tableId = op.object.getTableId();
+    Record record = {tableId,
+                     Key::getHash(tableId,
+                                  op.object.getKey(),
+                                  op.object.getKeyLength()),
+                     op.header.rpcId,
+                     segmentId};
+    records.push_back(record);
+    header.count = downCast<uint32_t>(records.size());
+}
+
+/**
+ * Append the serialized batch to the provided buffer.
+ *
+ * \param buffer
+ *      The buffer to append all data to. The batch must not change until
+ *      the buffer is no longer needed.
+ */
+void
+PreparedOpTombstoneBatch::assembleForLog(Buffer& buffer)
+{
+    header.checksum = computeChecksum();
+    buffer.appendExternal(&header, sizeof32(Header));
+    if (header.count > 0) {
+        buffer.appendExternal(&records[0], header.count * sizeof32(Record));
+    }
+}
+
+/**
+ * Compute a checksum on the batch and determine whether or not it matches
+ * what is stored in it. Returns true if the checksum looks ok, otherwise
+ * returns false.
+ */
+bool
+PreparedOpTombstoneBatch::checkIntegrity()
+{
+    return computeChecksum() == header.checksum;
+}
+
+/**
+ * Compute the batch's checksum and return it.
+ */
+uint32_t
+PreparedOpTombstoneBatch::computeChecksum()
+{
+    Crc32C crc;
+    crc.update(&header,
+               downCast<uint32_t>(sizeof(header) - sizeof(header.checksum)));
+    if (header.count > 0)
+        crc.update(&records[0], header.count * sizeof32(Record));
+    return crc.getResult();
+}
+
 } // namespace RAMCloud
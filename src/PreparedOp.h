@@ -192,6 +192,84 @@ class PreparedOpTombstone {
     DISALLOW_COPY_AND_ASSIGN(PreparedOpTombstone);
 };
 
+/**
+ * A compact replacement for the PreparedOpTombstones of several operations
+ * of one transaction that are decided together on this master (see
+ * ObjectManager::commitPreparedOps). The lease id is stored once, and the
+ * whole batch costs one log entry header and one checksum, so each operation
+ * takes 32 bytes instead of a 44-byte tombstone plus its entry header.
+ *
+ * A batch is needed for as long as any of the PreparedOps it refers to may
+ * still be in the log, which is until the last of their segments is gone.
+ * During recovery it is given to every partition that owns one of its
+ * operations. When stored in the log, a batch has the following layout:
+ *
+ * +--------+----------+-----+------------+
+ * | Header | Record 0 | ... | Record n-1 |
+ * +--------+----------+-----+------------+
+ */
+class PreparedOpTombstoneBatch {
+  public:
+    explicit PreparedOpTombstoneBatch(uint64_t leaseId);
+    explicit PreparedOpTombstoneBatch(Buffer& buffer);
+
+    void add(PreparedOp& op, uint64_t segmentId);
+    void assembleForLog(Buffer& buffer);
+    bool checkIntegrity();
+    uint32_t computeChecksum();
+
+    /**
+     * This data structure defines the format of a batch's header stored in
+     * a master server's log.
+     */
+    class Header {
+      public:
+        explicit Header(uint64_t leaseId)
+            : clientLeaseId(leaseId)
+            , count(0)
+            , checksum(0)
+        {
+        }
+
+        /// leaseId of the client that initiated the transaction; it applies
+        /// to all of the records.
+        uint64_t clientLeaseId;
+
+        /// Number of records following the header.
+        uint32_t count;
+
+        /// CRC32C checksum covering everything but this field, including
+        /// the records.
+        uint32_t checksum;
+    } __attribute__((__packed__));
+
+    /**
+     * Everything a PreparedOpTombstone says about its operation, other than
+     * the lease id.
+     */
+    struct Record {
+        /// TableId for log distribution during recovery.
+        uint64_t tableId;
+
+        /// KeyHash for log distribution during recovery.
+        KeyHash keyHash;
+
+        /// rpcId given for the prepare of the operation.
+        uint64_t rpcId;
+
+        /// The log segment that the dead preparedOp was in.
+        uint64_t segmentId;
+    } __attribute__((__packed__));
+
+    /// Copy of the batch header that is in, or will be written to, the log.
+    Header header;
+
+    /// Copies of the records, in the order they were added or logged.
+    std::vector<Record> records;
+
+    DISALLOW_COPY_AND_ASSIGN(PreparedOpTombstoneBatch);
+};
+
 }
 
 #endif // RAMCLOUD_PREPAREDOP_H
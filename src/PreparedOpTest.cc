@@ -399,4 +399,49 @@ TEST_F(PreparedOpTombstoneTest, checkIntegrity) {
     }
 }
 
+TEST_F(PreparedOpTombstoneTest, batch_add) {
+    PreparedOpTombstoneBatch batch(1UL);
+    EXPECT_EQ(0U, batch.header.count);
+    batch.add(*preparedOp, 999UL);
+    batch.add(*preparedOp, 1000UL);
+    EXPECT_EQ(2U, batch.header.count);
+    EXPECT_EQ(572UL, batch.records[1].tableId);
+    EXPECT_EQ(keyHash, batch.records[1].keyHash);
+    EXPECT_EQ(10UL, batch.records[1].rpcId);
+    EXPECT_EQ(1000UL, batch.records[1].segmentId);
+}
+
+TEST_F(PreparedOpTombstoneTest, batch_assembleForLog) {
+    PreparedOpTombstoneBatch batch(1UL);
+    batch.add(*preparedOp, 999UL);
+    batch.add(*preparedOp, 1000UL);
+    Buffer buffer;
+    batch.assembleForLog(buffer);
+    EXPECT_EQ(sizeof(PreparedOpTombstoneBatch::Header) +
+              2 * sizeof(PreparedOpTombstoneBatch::Record), buffer.size());
+
+    PreparedOpTombstoneBatch batch2(buffer);
+    EXPECT_EQ(1UL, batch2.header.clientLeaseId);
+    EXPECT_EQ(2U, batch2.header.count);
+    EXPECT_EQ(999UL, batch2.records[0].segmentId);
+    EXPECT_EQ(1000UL, batch2.records[1].segmentId);
+    EXPECT_TRUE(batch2.checkIntegrity());
+}
+
+TEST_F(PreparedOpTombstoneTest, batch_checkIntegrity) {
+    PreparedOpTombstoneBatch batch(1UL);
+    batch.add(*preparedOp, 999UL);
+    Buffer buffer;
+    batch.assembleForLog(buffer);
+    EXPECT_TRUE(batch.checkIntegrity());
+
+    batch.records[0].rpcId++;
+    EXPECT_FALSE(batch.checkIntegrity());
+    batch.records[0].rpcId--;
+    EXPECT_TRUE(batch.checkIntegrity());
+
+    batch.header.clientLeaseId++;
+    EXPECT_FALSE(batch.checkIntegrity());
+}
+
 }
@@ -107,7 +107,7 @@ PriorityTask::deschedule()
 PriorityTaskQueue::PriorityTaskQueue()
     : mutex()
     , changes()
-    , thread()
+    , threads()
     , running(true)
     , tasks(PriorityTaskQueue::entryLessThan)
     , entryPool()
@@ -159,8 +159,7 @@ PriorityTaskQueue::performTask()
     if (!task)
         return;
     task->performTask();
-    ++doneCount;
-    changes.notify_all();
+    taskDone();
 }
 
 /**
@@ -187,8 +186,7 @@ PriorityTaskQueue::performTasksUntilHalt()
 {
     while (PriorityTask* task = getNextTask(true)) {
         task->performTask();
-        ++doneCount;
-        changes.notify_all();
+        taskDone();
     }
 }
 
@@ -219,7 +217,7 @@ try {
 /**
  * Notify any executing calls to performTaskUntilHalt() that they should
  * exit as soon as they finish executing any currently executing task, if
- * any. This includes the thread created by start() if it was called.
+ * any. This includes the threads created by start() if it was called.
  */
 void
 PriorityTaskQueue::halt()
@@ -228,23 +226,30 @@ PriorityTaskQueue::halt()
     running = false;
     changes.notify_all();
     lock.unlock();
-    if (thread)
-        thread->join();
-    thread.destroy();
+    foreach (std::thread& thread, threads)
+        thread.join();
+    threads.clear();
 }
 
 /**
  * Start performing enqueued tasks in the background.
  * Calling start() on an instance that is already started has no effect.
+ *
+ * \param numThreads
+ *      Number of threads to perform tasks with. Each runs one task at a
+ *      time, so this bounds how many tasks execute concurrently; tasks
+ *      that share state must synchronize among themselves if this is
+ *      more than 1.
  */
 void
-PriorityTaskQueue::start()
+PriorityTaskQueue::start(uint32_t numThreads)
 {
     Lock _(mutex);
-    if (thread)
+    if (!threads.empty())
         return;
     running = true;
-    thread.construct(&PriorityTaskQueue::main, this);
+    for (uint32_t i = 0; i < std::max(numThreads, 1u); ++i)
+        threads.emplace_back(&PriorityTaskQueue::main, this);
 }
 
 /**
@@ -360,6 +365,18 @@ PriorityTaskQueue::getNextTask(bool sleepIfIdle)
     return task;
 }
 
+/**
+ * Record that a task returned from getNextTask() has finished executing and
+ * wake up anyone waiting on it (e.g. quiesce()).
+ */
+void
+PriorityTaskQueue::taskDone()
+{
+    Lock _(mutex);
+    ++doneCount;
+    changes.notify_all();
+}
+
 /**
  * Returns true if \a left should be done LATER THAN \a right.
  * Based on the priority of the tasks and then using the order the tasks
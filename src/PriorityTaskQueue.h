@@ -156,7 +156,7 @@ class PriorityTaskQueue {
     void performTask();
     void performTasksUntilHalt();
     void main();
-    void start();
+    void start(uint32_t numThreads = 1);
     void halt();
 
     void quiesce();
@@ -170,6 +170,7 @@ class PriorityTaskQueue {
     void deschedule(Lock& lock, PriorityTask* task);
 
     PriorityTask* getNextTask(bool sleepIfIdle);
+    void taskDone();
     typedef PriorityTask::PriorityQueueEntry PriorityQueueEntry;
     static bool entryLessThan(const PriorityQueueEntry* left,
                               const PriorityQueueEntry* right);
@@ -188,10 +189,10 @@ class PriorityTaskQueue {
     std::condition_variable changes;
 
     /**
-     * If start() is call, drives main() waiting for new tasks and performing
-     * them one-at-a-time. Exits if halt() is called.
+     * If start() is called, each drives main() waiting for new tasks and
+     * performing them one-at-a-time. Exit if halt() is called.
      */
-    Tub<std::thread> thread;
+    std::vector<std::thread> threads;
 
     /// If false exit (from performTasksUntilHalt()) on the next task pop.
     bool running;
@@ -137,6 +137,24 @@ TEST_F(PriorityTaskQueueTest, startHalt)
     taskQueue.halt();
 }
 
+TEST_F(PriorityTaskQueueTest, startMultipleThreads)
+{
+    taskQueue.start(3);
+    EXPECT_EQ(3lu, taskQueue.threads.size());
+    taskQueue.start(5);
+    EXPECT_EQ(3lu, taskQueue.threads.size());
+
+    task1.schedule(PriorityTask::LOW);
+    task2.schedule(PriorityTask::NORMAL);
+    for (int i = 0; i < 1000 && taskQueue.doneCount < 2; ++i)
+        usleep(1000);
+    taskQueue.halt();
+    EXPECT_EQ(0lu, taskQueue.threads.size());
+    EXPECT_EQ(1, task1.count);
+    EXPECT_EQ(1, task2.count);
+    EXPECT_EQ(2lu, taskQueue.doneCount);
+}
+
 TEST_F(PriorityTaskQueueTest, schedule)
 {
     task1.schedule(PriorityTask::LOW);
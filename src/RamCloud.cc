@@ -16,11 +16,15 @@
 #include <stdarg.h>
 
 #include "RamCloud.h"
+#include "AdminClient.h"
 #include "ClientLeaseAgent.h"
 #include "ClientTransactionManager.h"
 #include "CoordinatorClient.h"
 #include "CoordinatorSession.h"
 #include "Dispatch.h"
+#include "EnumerationFilter.h"
+#include "IndexKey.h"
+#include "LargeObject.h"
 #include "LinearizableObjectRpcWrapper.h"
 #include "FailSession.h"
 #include "MasterClient.h"
@@ -31,6 +35,9 @@
 #include "Object.h"
 #include "ObjectFinder.h"
 #include "ProtoBuf.h"
+#include "ReadCache.h"
+#include "RemoteReader.h"
+#include "RpcCoalescer.h"
 #include "RpcTracker.h"
 #include "ShortMacros.h"
 #include "TimeTrace.h"
@@ -60,6 +67,9 @@ RamCloud::RamCloud(CommandLineOptions* options)
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , coalescer(new RpcCoalescer(this))
+    , remoteReader(new RemoteReader(this))
+    , readCache(new ReadCache(this))
 {
     coordinatorLocator = options->getExternalStorageLocator();
     if (coordinatorLocator.size() == 0) {
@@ -82,6 +92,9 @@ RamCloud::RamCloud(Context* context)
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , coalescer(new RpcCoalescer(this))
+    , remoteReader(new RemoteReader(this))
+    , readCache(new ReadCache(this))
 {
     coordinatorLocator = context->options->getExternalStorageLocator();
     if (coordinatorLocator.size() == 0) {
@@ -101,6 +114,9 @@ RamCloud::RamCloud(const char* locator, const char* clusterName)
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , coalescer(new RpcCoalescer(this))
+    , remoteReader(new RemoteReader(this))
+    , readCache(new ReadCache(this))
 {
     clientContext->coordinatorSession->setLocation(locator, clusterName);
 }
@@ -112,6 +128,9 @@ RamCloud::RamCloud(Context* context, const char* locator,
     , clientLeaseAgent(new ClientLeaseAgent(this))
     , rpcTracker(new RpcTracker())
     , transactionManager(new ClientTransactionManager())
+    , coalescer(new RpcCoalescer(this))
+    , remoteReader(new RemoteReader(this))
+    , readCache(new ReadCache(this))
 {
     clientContext->coordinatorSession->setLocation(locator, clusterName);
 }
@@ -122,6 +141,9 @@ RamCloud::RamCloud(Context* context, const char* locator,
 
 RamCloud::~RamCloud()
 {
+    delete readCache;
+    delete remoteReader;
+    delete coalescer;
     delete clientLeaseAgent;
 
     delete rpcTracker;
@@ -146,6 +168,111 @@ RamCloud::poll()
     // anything (the dispatch thread will be polling continuously).
     if (clientContext->dispatch->isDispatchThread())
         clientContext->dispatch->poll();
+    coalescer->poll();
+}
+
+/**
+ * Add bytes to the end of an object's value, creating the object if it
+ * doesn't exist. Only the new bytes are sent to the server and written to
+ * its log, so the cost of an append doesn't depend on the size of the
+ * existing value.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Address of the first of the bytes to append.
+ * \param length
+ *      Number of bytes to append.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the append
+ *      should be aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ *      If the operation was successful this will be the new version for
+ *      the object; otherwise it is the current version, or 0 if the object
+ *      does not exist.
+ *
+ * \exception RejectRulesException
+ */
+void
+RamCloud::append(uint64_t tableId, const void* key, uint16_t keyLength,
+        const void* buf, uint32_t length,
+        const RejectRules* rejectRules, uint64_t* version)
+{
+    AppendRpc rpc(this, tableId, key, keyLength, buf, length, rejectRules);
+    rpc.wait(version);
+}
+
+/**
+ * Constructor for AppendRpc: initiates an RPC in the same way as
+ * #RamCloud::append, but returns once the RPC has been initiated, without
+ * waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Address of the first of the bytes to append.
+ * \param length
+ *      Number of bytes to append.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the append
+ *      should be aborted with an error.
+ */
+AppendRpc::AppendRpc(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, const void* buf,
+        uint32_t length, const RejectRules* rejectRules)
+    : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key, keyLength,
+            sizeof(WireFormat::Append::Response))
+{
+    ramcloud->readCache->invalidate(tableId, key, keyLength);
+    WireFormat::Append::Request* reqHdr(allocHeader<WireFormat::Append>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->length = length;
+    reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
+    request.append(key, keyLength);
+    request.append(buf, length);
+    fillLinearizabilityHeader<WireFormat::Append::Request>(reqHdr);
+    send();
+}
+
+/**
+ * Wait for an append RPC to complete, and return the same results as
+ * #RamCloud::append.
+ *
+ * \param[out] version
+ *      If non-NULL, the current version number of the object is
+ *      returned here.
+ */
+void
+AppendRpc::wait(uint64_t* version)
+{
+    waitInternal(context->dispatch);
+    const WireFormat::Append::Response* respHdr(
+            getResponseHeader<WireFormat::Append>());
+    if (version != NULL)
+        *version = respHdr->version;
+
+    if (respHdr->common.status != STATUS_OK)
+        ClientException::throwException(HERE, respHdr->common.status);
 }
 
 /**
@@ -229,6 +356,12 @@ CoordSplitAndMigrateIndexletRpc::CoordSplitAndMigrateIndexletRpc(
  *      to this number of servers according to their hash. This is a temporary
  *      work-around until tablet migration is complete; until then, we must
  *      place tablets on servers statically.
+ * \param keyHash
+ *      Function used to hash the keys of the table (defaults to
+ *      Key::MURMUR3). Key::WYHASH is faster, but can't be used for tables
+ *      whose id is larger than Key::MAX_WYHASH_TABLE_ID; the table is
+ *      given Key::MURMUR3 in that case. Ignored if the table already
+ *      exists.
  *
  * \return
  *      The return value is an identifier for the created table; this is
@@ -236,9 +369,10 @@ CoordSplitAndMigrateIndexletRpc::CoordSplitAndMigrateIndexletRpc(
  *      involving the table.
  */
 uint64_t
-RamCloud::createTable(const char* name, uint32_t serverSpan)
+RamCloud::createTable(const char* name, uint32_t serverSpan,
+        Key::HashFunction keyHash)
 {
-    CreateTableRpc rpc(this, name, serverSpan);
+    CreateTableRpc rpc(this, name, serverSpan, keyHash);
     return rpc.wait();
 }
 
@@ -254,9 +388,12 @@ RamCloud::createTable(const char* name, uint32_t serverSpan)
  * \param serverSpan
  *      The number of servers across which this table will be divided
  *      (defaults to 1).
+ * \param keyHash
+ *      Function used to hash the keys of the table (defaults to
+ *      Key::MURMUR3).
  */
 CreateTableRpc::CreateTableRpc(RamCloud* ramcloud,
-        const char* name, uint32_t serverSpan)
+        const char* name, uint32_t serverSpan, Key::HashFunction keyHash)
     : CoordinatorRpcWrapper(ramcloud->clientContext,
             sizeof(WireFormat::CreateTable::Response))
 {
@@ -265,6 +402,7 @@ CreateTableRpc::CreateTableRpc(RamCloud* ramcloud,
             allocHeader<WireFormat::CreateTable>());
     reqHdr->nameLength = length;
     reqHdr->serverSpan = serverSpan;
+    reqHdr->keyHash = downCast<uint8_t>(keyHash);
     request.append(name, length);
     send();
 }
@@ -284,6 +422,8 @@ CreateTableRpc::wait()
             getResponseHeader<WireFormat::CreateTable>());
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
+    Key::setHashFunction(respHdr->tableId,
+            Key::HashFunction(respHdr->keyHash));
     return respHdr->tableId;
 }
 
@@ -445,6 +585,16 @@ DropIndexRpc::DropIndexRpc(RamCloud* ramcloud, uint64_t tableId,
     send();
 }
 
+/**
+ * Stop coalescing reads and writes (see enableCoalescing). Operations that
+ * are being held for coalescing are sent right away.
+ */
+void
+RamCloud::disableCoalescing()
+{
+    coalescer->disable();
+}
+
 /**
  * Send a message to a given server and cause that server to echo with the
  * exact same message.
@@ -557,6 +707,118 @@ EchoRpc::wait()
     assert(respHdr->length == response->size());
 }
 
+/**
+ * Start coalescing the single-object reads and writes issued with ReadRpc
+ * and WriteRpc (and hence RamCloud::read and RamCloud::write) into MultiRead
+ * and MultiWrite operations. This helps clients that keep many independent
+ * asynchronous reads and writes outstanding at once: they get the
+ * efficiency of the multi-ops without changing their code. Coalesced writes
+ * are not linearizable; writes with more than one key and async writes are
+ * never coalesced. See RpcCoalescer for details.
+ *
+ * \param windowMicros
+ *      A read or write is held for at most this long waiting for others to
+ *      join it, provided the client polls (with RamCloud::poll or isReady);
+ *      waiting for any of the held operations sends them all at once.
+ */
+void
+RamCloud::enableCoalescing(uint32_t windowMicros)
+{
+    coalescer->enable(windowMicros);
+}
+
+/**
+ * Let RamCloud::read serve repeated reads of an object from a client-side
+ * cache. A cached object is served locally for a lease period after it was
+ * read; the first read after that asks the master for the object only if
+ * its version has changed, so staleness is bounded by the lease period.
+ * Writes, removes, increments and appends issued through this RamCloud
+ * object (but not multi-ops or transactions) drop the cached copy at once;
+ * writes by other clients are only seen once the lease runs out. Reads with
+ * reject rules and asynchronous ReadRpcs always go to the master. See
+ * ReadCache for details.
+ *
+ * \param leaseMicros
+ *      How long an object may be served from the cache without checking
+ *      with its master.
+ * \param maxEntries
+ *      Upper limit on the number of objects cached at any given time; 0
+ *      disables the cache.
+ */
+void
+RamCloud::enableReadCache(uint32_t leaseMicros, uint32_t maxEntries)
+{
+    readCache->enable(leaseMicros, maxEntries);
+}
+
+/**
+ * Bound the tail latency of reads of a table by hedging them: a read that
+ * has waited longer than 95% of recent reads from the same master did is
+ * sent again to another master holding the object, and the first response
+ * wins. Only hot objects have copies on other masters, so this implies
+ * enableReplicaReads (and its relaxed consistency) for the table. Reads
+ * with reject rules are never hedged.
+ *
+ * \param tableId
+ *      The table whose reads are hedged.
+ */
+void
+RamCloud::enableHedgedReads(uint64_t tableId)
+{
+    clientContext->objectFinder->enableHedgedReads(tableId);
+}
+
+/**
+ * Fetch table configurations from masters rather than from the coordinator,
+ * once this client knows of some masters. This takes load off the
+ * coordinator when there are many clients, particularly when they all
+ * refetch configurations after a crash; see
+ * ObjectFinder::enableMasterConfigFetches.
+ */
+void
+RamCloud::enableMasterConfigFetches()
+{
+    clientContext->objectFinder->enableMasterConfigFetches();
+}
+
+/**
+ * Let reads of a table be served by read replicas of hot objects, on
+ * masters other than the objects' owners (see HotKeyReplicator; masters
+ * only replicate hot objects if started with --hotKeyReplicas). This
+ * relaxes consistency for the table: a read served by a replica may
+ * return a value up to one replica lease period old, though writes and
+ * removes through the master reach the replicas before they complete.
+ * Reads with reject rules always go to the object's master.
+ *
+ * \param tableId
+ *      The table whose reads may be served by replicas.
+ */
+void
+RamCloud::enableReplicaReads(uint64_t tableId)
+{
+    clientContext->objectFinder->enableReplicaReads(tableId);
+}
+
+/**
+ * Let RamCloud::read fetch objects with one-sided RDMA reads of the
+ * masters' memory instead of RPCs, when the transport supports it (only
+ * InfRcTransport does) and the masters were started with a remote read
+ * table (--remoteReadSlots). An object is read remotely once a read RPC
+ * has returned a hint for it; any conflict with a concurrent write, the
+ * cleaner, or migration sends the read back to the RPC path. Reads with
+ * reject rules and asynchronous ReadRpcs always use RPCs. See RemoteReader
+ * for details.
+ *
+ * \param maxHints
+ *      Upper limit on the number of objects that can be read remotely at
+ *      any given time; 0 disables remote reads.
+ */
+void
+RamCloud::enableRemoteReads(uint32_t maxHints)
+{
+    remoteReader->enable(maxHints);
+}
+
 /**
  * This method provides the core of table enumeration. It is invoked
  * repeatedly to enumerate a table; each invocation returns the next
@@ -594,6 +856,20 @@ EchoRpc::wait()
  *      tablet. When this happens, the return value will be set to
  *      point to the next tablet, or will be set to zero if this is
  *      the end of the entire table.
+ * \param filter
+ *      If not NULL, only the objects passing this filter are returned,
+ *      with the projected parts of their values; see EnumerationFilter.
+ *      The same filter must be passed on every call of an enumeration.
+ * \param lastHash
+ *      Only objects whose key hashes are no greater than this are
+ *      returned; enumeration of the range is finished once the return
+ *      value is zero or greater than this. Used by TableEnumerator to
+ *      enumerate part of a table.
+ * \param logOrder
+ *      True means the masters return objects in the order of their logs
+ *      rather than of their hash tables. That scans much faster, but an
+ *      object may be returned more than once (see Enumeration). The same
+ *      value must be passed on every call of an enumeration.
  *
  * \return
  *       The return value is a key hash indicating where to continue
@@ -605,10 +881,11 @@ EchoRpc::wait()
  */
 uint64_t
 RamCloud::enumerateTable(uint64_t tableId, bool keysOnly,
-        uint64_t tabletFirstHash, Buffer& state, Buffer& objects)
+        uint64_t tabletFirstHash, Buffer& state, Buffer& objects,
+        const EnumerationFilter* filter, uint64_t lastHash, bool logOrder)
 {
-    EnumerateTableRpc rpc(this, tableId, keysOnly,
-                            tabletFirstHash, state, objects);
+    EnumerateTableRpc rpc(this, tableId, keysOnly, tabletFirstHash, state,
+                          objects, filter, lastHash, logOrder);
     return rpc.wait(state);
 }
 
@@ -641,9 +918,19 @@ RamCloud::enumerateTable(uint64_t tableId, bool keysOnly,
  * \param[out] objects
  *      After a successful return, this buffer will contain zero or
  *      more objects from the requested tablet.
+ * \param filter
+ *      If not NULL, only the objects passing this filter are returned,
+ *      with the projected parts of their values; see EnumerationFilter.
+ * \param lastHash
+ *      Only objects whose key hashes are no greater than this are
+ *      returned.
+ * \param logOrder
+ *      True means the master returns objects in the order of its log; see
+ *      #RamCloud::enumerateTable.
  */
 EnumerateTableRpc::EnumerateTableRpc(RamCloud* ramcloud, uint64_t tableId,
-        bool keysOnly, uint64_t tabletFirstHash, Buffer& state, Buffer& objects)
+        bool keysOnly, uint64_t tabletFirstHash, Buffer& state, Buffer& objects,
+        const EnumerationFilter* filter, uint64_t lastHash, bool logOrder)
     : ObjectRpcWrapper(ramcloud->clientContext, tableId, tabletFirstHash,
             sizeof(WireFormat::Enumerate::Response), &objects)
 {
@@ -652,9 +939,14 @@ EnumerateTableRpc::EnumerateTableRpc(RamCloud* ramcloud, uint64_t tableId,
     reqHdr->tableId = tableId;
     reqHdr->keysOnly = keysOnly;
     reqHdr->tabletFirstHash = tabletFirstHash;
+    reqHdr->lastHash = lastHash;
+    reqHdr->logOrder = logOrder;
     reqHdr->iteratorBytes = state.size();
     for (Buffer::Iterator it(&state); !it.isDone(); it.next())
         request.append(it.getData(), it.getLength());
+    reqHdr->filterBytes = 0;
+    if (filter != NULL)
+        reqHdr->filterBytes = filter->serialize(request);
     send();
 }
 
@@ -1153,6 +1445,8 @@ GetTableIdRpc::wait()
             getResponseHeader<WireFormat::GetTableId>());
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
+    Key::setHashFunction(respHdr->tableId,
+            Key::HashFunction(respHdr->keyHash));
     return respHdr->tableId;
 }
 
@@ -1226,6 +1520,7 @@ IncrementDoubleRpc::IncrementDoubleRpc(RamCloud* ramcloud, uint64_t tableId,
     : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key, keyLength,
             sizeof(WireFormat::Increment::Response))
 {
+    ramcloud->readCache->invalidate(tableId, key, keyLength);
     WireFormat::Increment::Request* reqHdr(
             allocHeader<WireFormat::Increment>());
     reqHdr->tableId = tableId;
@@ -1330,6 +1625,7 @@ IncrementInt64Rpc::IncrementInt64Rpc(RamCloud* ramcloud, uint64_t tableId,
     : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key, keyLength,
             sizeof(WireFormat::Increment::Response))
 {
+    ramcloud->readCache->invalidate(tableId, key, keyLength);
     WireFormat::Increment::Request* reqHdr(
             allocHeader<WireFormat::Increment>());
     reqHdr->tableId = tableId;
@@ -1463,17 +1759,23 @@ ReadHashesRpc::ReadHashesRpc(RamCloud* ramcloud, uint64_t tableId,
  *              currently being sent), or
  *      (d) No object if the server has appended enough data (objects) to the
  *              response rpc that it cannot fit any more objects.
+ * \param[out] hashesPerResponse
+ *      If non-NULL, the server's estimate of how many key hashes would fill
+ *      one response, given the size of the objects it just returned; 0 if
+ *      it returned no objects.
  * \return
  *      Number of key hashes for which corresponding objects are being
  *      returned, or for which no matching objects were found.
  */
 uint32_t
-ReadHashesRpc::wait(uint32_t* numObjects)
+ReadHashesRpc::wait(uint32_t* numObjects, uint32_t* hashesPerResponse)
 {
     simpleWait(context);
     const WireFormat::ReadHashes::Response* respHdr(
             getResponseHeader<WireFormat::ReadHashes>());
     *numObjects = respHdr->numObjects;
+    if (hashesPerResponse != NULL)
+        *hashesPerResponse = respHdr->hashesPerResponse;
     return respHdr->numHashes;
 }
 
@@ -1781,6 +2083,107 @@ LookupIndexKeysRpc::wait(uint32_t* numHashes, uint16_t* nextKeyLength,
     *nextKeyHash = respHdr->nextKeyHash;
 }
 
+/**
+ * Constructor for LookupIndexKeysAndReadRpc: starts the lookup of the
+ * primary key hashes for a range of index keys, just as LookupIndexKeysRpc
+ * does, and asks the index server to return the matching objects as well.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      Id of the table in which lookup is to be done.
+ * \param indexId
+ *      Id of the index for which keys have to be compared.
+ *      Must be greater than 0. Id 0 is reserved for "primary key".
+ * \param firstKey
+ *      Starting key for the key range in which keys are to be matched,
+ *      as for LookupIndexKeysRpc.
+ * \param firstKeyLength
+ *      Length in bytes of the firstKey.
+ * \param firstAllowedKeyHash
+ *      Smallest primary key hash value allowed for firstKey.
+ * \param lastKey
+ *      Ending key for the key range in which keys are to be matched,
+ *      as for LookupIndexKeysRpc.
+ * \param lastKeyLength
+ *      Length in byes of the lastKey.
+ * \param maxNumHashes
+ *      Maximum number of hashes that the server is allowed to return
+ *      in a single rpc.
+ *
+ * \param[out] responseBuffer
+ *      Response buffer returned on wait(). After the header, this holds the
+ *      key hashes, then the next key, then the objects, in the format
+ *      described by WireFormat::LookupIndexKeysAndRead.
+ */
+LookupIndexKeysAndReadRpc::LookupIndexKeysAndReadRpc(
+        RamCloud* ramcloud, uint64_t tableId, uint8_t indexId,
+        const void* firstKey, uint16_t firstKeyLength,
+        uint64_t firstAllowedKeyHash,
+        const void* lastKey, uint16_t lastKeyLength,
+        uint32_t maxNumHashes, Buffer* responseBuffer)
+    : IndexRpcWrapper(ramcloud->clientContext, tableId, indexId,
+            firstKey, firstKeyLength,
+            sizeof(WireFormat::LookupIndexKeysAndRead::Response),
+            responseBuffer)
+{
+    WireFormat::LookupIndexKeysAndRead::Request* reqHdr(
+            allocHeader<WireFormat::LookupIndexKeysAndRead>());
+    reqHdr->tableId = tableId;
+    reqHdr->indexId = indexId;
+    reqHdr->firstKeyLength = firstKeyLength;
+    reqHdr->firstAllowedKeyHash = firstAllowedKeyHash;
+    reqHdr->lastKeyLength = lastKeyLength;
+    reqHdr->maxNumHashes = maxNumHashes;
+    request.append(firstKey, firstKeyLength);
+    request.append(lastKey, lastKeyLength);
+    send();
+}
+
+// See IndexRpcWrapper for documentation.
+void
+LookupIndexKeysAndReadRpc::handleIndexDoesntExist()
+{
+    response->reset();
+    WireFormat::LookupIndexKeysAndRead::Response* respHdr =
+            response->emplaceAppend<
+                    WireFormat::LookupIndexKeysAndRead::Response>();
+    memset(respHdr, 0, sizeof(*respHdr));
+    respHdr->lookup.common.status = STATUS_OK;
+}
+
+/**
+ * Wait for a lookupIndexKeysAndRead RPC to complete.
+ *
+ * \param[out] numHashes
+ *      Return the number of objects that matched the lookup, for which
+ *      the primary key hashes are being returned here.
+ * \param[out] nextKeyLength
+ *      Length of nextKey in bytes.
+ * \param[out] nextKeyHash
+ *      Results starting at nextKey + nextKeyHash couldn't be returned.
+ *      Client can send another request according to this.
+ * \param[out] numReadHashes
+ *      The objects for the first this many of the returned key hashes are
+ *      in the response; those for the others must be read separately.
+ * \param[out] numObjects
+ *      Number of objects in the response.
+ */
+void
+LookupIndexKeysAndReadRpc::wait(uint32_t* numHashes, uint16_t* nextKeyLength,
+        uint64_t* nextKeyHash, uint32_t* numReadHashes, uint32_t* numObjects)
+{
+    simpleWait(context);
+
+    const WireFormat::LookupIndexKeysAndRead::Response* respHdr(
+            getResponseHeader<WireFormat::LookupIndexKeysAndRead>());
+    *numHashes = respHdr->lookup.numHashes;
+    *nextKeyLength = respHdr->lookup.nextKeyLength;
+    *nextKeyHash = respHdr->lookup.nextKeyHash;
+    *numReadHashes = respHdr->numReadHashes;
+    *numObjects = respHdr->numObjects;
+}
+
 /**
  * Request that the master owning a particular tablet migrate it
  * to another designated master.
@@ -1919,7 +2322,9 @@ RamCloud::multiWrite(MultiWriteObject* requests[], uint32_t numRequests)
 }
 
 /**
- * Read the current contents of an object.
+ * Overwrite part of the value of an existing object, or append to it,
+ * without sending the rest of the value. The keys and the other bytes
+ * of the value are unchanged.
  *
  * \param tableId
  *      The table containing the desired object (return value from
@@ -1931,57 +2336,41 @@ RamCloud::multiWrite(MultiWriteObject* requests[], uint32_t numRequests)
  *      the RPC.
  * \param keyLength
  *      Size in bytes of the key.
- * \param[out] value
- *      After a successful return, this Buffer will hold the
- *      contents of the desired object - only the value portion of the object.
+ * \param offset
+ *      Offset within the object's current value of the first byte to
+ *      overwrite. Must not exceed the value's length; pass the length to
+ *      append. The value grows if the new bytes extend past its end.
+ * \param buf
+ *      Address of the first of the new bytes.
+ * \param length
+ *      Number of new bytes.
  * \param rejectRules
- *      If non-NULL, specifies conditions under which the read
+ *      If non-NULL, specifies conditions under which the patch
  *      should be aborted with an error.
  * \param[out] version
  *      If non-NULL, the version number of the object is returned here.
- */
-void
-RamCloud::read(uint64_t tableId, const void* key, uint16_t keyLength,
-        Buffer* value, const RejectRules* rejectRules, uint64_t* version)
-{
-    ReadRpc rpc(this, tableId, key, keyLength, value, rejectRules);
-    rpc.wait(version);
-}
-
-/**
- * Read the current contents of an object including the keys and the value.
+ *      If the operation was successful this will be the new version for
+ *      the object; otherwise it is the current version, or 0 if the object
+ *      does not exist.
  *
- * \param tableId
- *      The table containing the desired object (return value from
- *      a previous call to getTableId).
- * \param key
- *      Primary key for the object within tableId.
- *      It does not necessarily have to be null terminated.  The caller must
- *      ensure that the storage for this key is unchanged through the life of
- *      the RPC.
- * \param keyLength
- *      Size in bytes of the key.
- * \param[out] value
- *      After a successful return, this ObjectBuffer will hold the
- *      contents of the desired object including the keys and the value.
- * \param rejectRules
- *      If non-NULL, specifies conditions under which the read
- *      should be aborted with an error.
- * \param[out] version
- *      If non-NULL, the version number of the object is returned here.
+ * \exception ObjectDoesntExistException
+ * \exception InvalidParameterException
+ *      \a offset is beyond the end of the object's value.
+ * \exception RejectRulesException
  */
 void
-RamCloud::readKeysAndValue(uint64_t tableId, const void* key,
-        uint16_t keyLength, ObjectBuffer* value,
+RamCloud::patch(uint64_t tableId, const void* key, uint16_t keyLength,
+        uint32_t offset, const void* buf, uint32_t length,
         const RejectRules* rejectRules, uint64_t* version)
 {
-    ReadKeysAndValueRpc rpc(this, tableId, key, keyLength, value, rejectRules);
+    PatchRpc rpc(this, tableId, key, keyLength, offset, buf, length,
+            rejectRules);
     rpc.wait(version);
 }
 
 /**
- * Constructor for ReadRpc: initiates an RPC in the same way as
- * #RamCloud::read, but returns once the RPC has been initiated, without
+ * Constructor for PatchRpc: initiates an RPC in the same way as
+ * #RamCloud::patch, but returns once the RPC has been initiated, without
  * waiting for it to complete.
  *
  * \param ramcloud
@@ -1996,48 +2385,358 @@ RamCloud::readKeysAndValue(uint64_t tableId, const void* key,
  *      the RPC.
  * \param keyLength
  *      Size in bytes of the key.
- * \param[out] value
- *      After a successful return, this Buffer will hold the
- *      contents of the desired object.
+ * \param offset
+ *      Offset within the object's current value of the first byte to
+ *      overwrite.
+ * \param buf
+ *      Address of the first of the new bytes.
+ * \param length
+ *      Number of new bytes.
  * \param rejectRules
- *      If non-NULL, specifies conditions under which the read
+ *      If non-NULL, specifies conditions under which the patch
  *      should be aborted with an error.
  */
-ReadRpc::ReadRpc(RamCloud* ramcloud, uint64_t tableId,
-        const void* key, uint16_t keyLength, Buffer* value,
-        const RejectRules* rejectRules)
-    : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
-            sizeof(WireFormat::Read::Response), value)
+PatchRpc::PatchRpc(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, uint32_t offset,
+        const void* buf, uint32_t length, const RejectRules* rejectRules)
+    : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key, keyLength,
+            sizeof(WireFormat::Patch::Response))
 {
-    value->reset();
-    WireFormat::Read::Request* reqHdr(allocHeader<WireFormat::Read>());
+    WireFormat::Patch::Request* reqHdr(allocHeader<WireFormat::Patch>());
     reqHdr->tableId = tableId;
     reqHdr->keyLength = keyLength;
+    reqHdr->offset = offset;
+    reqHdr->length = length;
     reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
     request.append(key, keyLength);
+    request.append(buf, length);
+    fillLinearizabilityHeader<WireFormat::Patch::Request>(reqHdr);
     send();
 }
 
 /**
- * Wait for the RPC to complete, and return the same results as
- * #RamCloud::read.
+ * Wait for a patch RPC to complete, and return the same results as
+ * #RamCloud::patch.
  *
  * \param[out] version
- *      If non-NULL, the version number of the object is returned here.
+ *      If non-NULL, the current version number of the object is
+ *      returned here.
  */
 void
-ReadRpc::wait(uint64_t* version)
+PatchRpc::wait(uint64_t* version)
 {
     waitInternal(context->dispatch);
-    const WireFormat::Read::Response* respHdr(
-            getResponseHeader<WireFormat::Read>());
+    const WireFormat::Patch::Response* respHdr(
+            getResponseHeader<WireFormat::Patch>());
     if (version != NULL)
         *version = respHdr->version;
 
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
+}
 
-    // Truncate the response Buffer so that it consists of nothing
+/**
+ * Read the current contents of an object.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the
+ *      contents of the desired object - only the value portion of the object.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ */
+void
+RamCloud::read(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, const RejectRules* rejectRules, uint64_t* version)
+{
+    if (rejectRules == NULL && readCache->isEnabled()) {
+        readCache->read(tableId, key, keyLength, value, version);
+        return;
+    }
+    if (rejectRules == NULL && remoteReader->isEnabled() &&
+            remoteReader->read(tableId, key, keyLength, value, version))
+        return;
+    ReadRpc rpc(this, tableId, key, keyLength, value, rejectRules);
+    rpc.wait(version);
+}
+
+/**
+ * Read the current contents of an object including the keys and the value.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Primary key for the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this ObjectBuffer will hold the
+ *      contents of the desired object including the keys and the value.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ */
+void
+RamCloud::readKeysAndValue(uint64_t tableId, const void* key,
+        uint16_t keyLength, ObjectBuffer* value,
+        const RejectRules* rejectRules, uint64_t* version)
+{
+    ReadKeysAndValueRpc rpc(this, tableId, key, keyLength, value, rejectRules);
+    rpc.wait(version);
+}
+
+/**
+ * Constructor for ReadRpc: initiates an RPC in the same way as
+ * #RamCloud::read, but returns once the RPC has been initiated, without
+ * waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the
+ *      contents of the desired object.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ */
+ReadRpc::ReadRpc(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, Buffer* value,
+        const RejectRules* rejectRules)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
+            sizeof(WireFormat::Read::Response), value)
+    , coalescedOp()
+    , remoteReader(NULL)
+    , allowReplica(false)
+    , sentToReplica(false)
+    , hedged(false)
+    , hedgeSentToReplica(false)
+    , timedSession()
+    , sendTime(0)
+{
+    value->reset();
+    if (ramcloud->coalescer->isEnabled()) {
+        coalescedOp = ramcloud->coalescer->addRead(tableId, key, keyLength,
+                                                   rejectRules);
+        return;
+    }
+    WireFormat::Read::Request* reqHdr(allocHeader<WireFormat::Read>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
+    if (ramcloud->remoteReader->isEnabled()) {
+        reqHdr->wantRemoteReadHint = 1;
+        remoteReader = ramcloud->remoteReader;
+    }
+    if (rejectRules == NULL &&
+            context->objectFinder->replicaReadsEnabled(tableId)) {
+        reqHdr->allowReplica = 1;
+        allowReplica = true;
+        hedged = context->objectFinder->hedgedReadsEnabled(tableId);
+    }
+    request.append(key, keyLength);
+    send();
+}
+
+// See RpcWrapper for documentation.
+bool
+ReadRpc::checkStatus()
+{
+    if (sentToReplica && responseHeader->status == STATUS_UNKNOWN_TABLET) {
+        // The replica's lease ran out (or it never got the object); go
+        // to the object's master, which will say whether it is still hot.
+        context->objectFinder->setHotReplicas(tableId, keyHash, {});
+        send();
+        return false;
+    }
+    return ObjectRpcWrapper::checkStatus();
+}
+
+// See RpcWrapper for documentation.
+bool
+ReadRpc::handleTransportError()
+{
+    if (sentToReplica) {
+        context->transportManager->flushSession(session->serviceLocator);
+        session = NULL;
+        context->objectFinder->setHotReplicas(tableId, keyHash, {});
+        send();
+        return false;
+    }
+    return ObjectRpcWrapper::handleTransportError();
+}
+
+// See RpcWrapper for documentation.
+void
+ReadRpc::send()
+{
+    if (allowReplica) {
+        Transport::SessionRef replica =
+                context->objectFinder->tryLookupReplica(tableId, keyHash);
+        if (replica) {
+            sentToReplica = true;
+            session = replica;
+            state = IN_PROGRESS;
+            RpcTrace::recordSend(&request);
+            session->sendRequest(&request, response, this);
+            startHedgeTimer();
+            return;
+        }
+    }
+    sentToReplica = false;
+    ObjectRpcWrapper::send();
+    startHedgeTimer();
+}
+
+// See RpcWrapper for documentation.
+Transport::SessionRef
+ReadRpc::getHedgeSession()
+{
+    if (sentToReplica) {
+        hedgeSentToReplica = false;
+        try {
+            return context->objectFinder->tryLookup(tableId, keyHash);
+        } catch (TableDoesntExistException& e) {
+            return Transport::SessionRef();
+        }
+    }
+
+    // tryLookupReplica rotates among the master and the replicas, so the
+    // second try gets a replica if the first picked the master.
+    for (int i = 0; i < 2; i++) {
+        Transport::SessionRef replica =
+                context->objectFinder->tryLookupReplica(tableId, keyHash);
+        if (replica && replica != session) {
+            hedgeSentToReplica = true;
+            return replica;
+        }
+    }
+    return Transport::SessionRef();
+}
+
+// See RpcWrapper for documentation.
+void
+ReadRpc::hedgeCompleted()
+{
+    sentToReplica = hedgeSentToReplica;
+}
+
+/**
+ * Invoked by send once the request is on its way: if the read may be
+ * hedged, start timing it and arrange for the hedge.
+ */
+void
+ReadRpc::startHedgeTimer()
+{
+    if (!hedged || !session)
+        return;
+    timedSession = session;
+    sendTime = Cycles::rdtsc();
+    uint64_t delay = context->objectFinder->getHedgeDelay(
+            session->serviceLocator);
+    hedgeTime = (delay == 0) ? 0 : sendTime + delay;
+}
+
+/**
+ * Indicates whether the read has completed (see RpcWrapper::isReady).
+ */
+bool
+ReadRpc::isReady()
+{
+    if (coalescedOp)
+        return coalescedOp->coalescer->isReady(coalescedOp.get());
+    bool ready = ObjectRpcWrapper::isReady();
+    if (ready && timedSession) {
+        context->objectFinder->recordReadLatency(
+                timedSession->serviceLocator, Cycles::rdtsc() - sendTime);
+        timedSession = NULL;
+    }
+    return ready;
+}
+
+/**
+ * Wait for the RPC to complete, and return the same results as
+ * #RamCloud::read.
+ *
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ */
+void
+ReadRpc::wait(uint64_t* version)
+{
+    if (coalescedOp) {
+        coalescedOp->coalescer->wait(coalescedOp.get());
+        const MultiReadObject& read = *coalescedOp->read;
+        if (version != NULL)
+            *version = read.version;
+        if (read.status != STATUS_OK)
+            ClientException::throwException(HERE, read.status);
+        uint32_t length;
+        const void* data = coalescedOp->readValue->getValue(&length);
+        response->appendCopy(data, length);
+        return;
+    }
+
+    waitInternal(context->dispatch);
+    const WireFormat::Read::Response* respHdr(
+            getResponseHeader<WireFormat::Read>());
+    if (version != NULL)
+        *version = respHdr->version;
+
+    if (respHdr->common.status != STATUS_OK)
+        ClientException::throwException(HERE, respHdr->common.status);
+    if (remoteReader != NULL && !respHdr->fromReplica)
+        remoteReader->addHint(tableId, keyHash, session, respHdr);
+
+    // The object's master says where its replicas are, if it has any.
+    uint32_t valueEnd = sizeof32(*respHdr) + respHdr->length;
+    if (allowReplica && !respHdr->fromReplica) {
+        vector<string> locators;
+        uint32_t offset = valueEnd;
+        for (uint8_t i = 0; i < respHdr->hotReplicaCount; i++) {
+            const uint16_t* length = response->getOffset<uint16_t>(offset);
+            if (length == NULL)
+                break;
+            offset += sizeof32(*length);
+            const char* locator = static_cast<const char*>(
+                    response->getRange(offset, *length));
+            if (locator == NULL)
+                break;
+            locators.emplace_back(locator, *length);
+            offset += *length;
+        }
+        context->objectFinder->setHotReplicas(tableId, keyHash, locators);
+        response->truncate(valueEnd);
+    }
+
+    // Truncate the response Buffer so that it consists of nothing
     // but the object data.
     response->truncateFront(sizeof(*respHdr));
     assert(respHdr->length == response->size());
@@ -2067,10 +2766,15 @@ ReadRpc::wait(uint64_t* version)
  * \param rejectRules
  *      If non-NULL, specifies conditions under which the read
  *      should be aborted with an error.
+ * \param snapshotTime
+ *      If nonzero, read the object as it was at this encoded ClusterTime
+ *      (\a rejectRules are then ignored); the wait method throws
+ *      SnapshotTooOldException if the server no longer retains that
+ *      version.
  */
 ReadKeysAndValueRpc::ReadKeysAndValueRpc(RamCloud* ramcloud, uint64_t tableId,
         const void* key, uint16_t keyLength, ObjectBuffer* value,
-        const RejectRules* rejectRules)
+        const RejectRules* rejectRules, uint64_t snapshotTime)
     : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
             sizeof(WireFormat::ReadKeysAndValue::Response), value)
 {
@@ -2080,6 +2784,7 @@ ReadKeysAndValueRpc::ReadKeysAndValueRpc(RamCloud* ramcloud, uint64_t tableId,
     reqHdr->tableId = tableId;
     reqHdr->keyLength = keyLength;
     reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
+    reqHdr->snapshotTime = snapshotTime;
     request.append(key, keyLength);
     send();
 }
@@ -2109,6 +2814,251 @@ ReadKeysAndValueRpc::wait(uint64_t* version)
     assert(respHdr->length == response->size());
 }
 
+/**
+ * Read the current value of an object written with writeLarge. The chunks
+ * of the value are fetched with many RPCs in parallel, and they are
+ * assembled into contiguous memory in the caller's Buffer.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the value of the
+ *      object. Objects written with #write can be read too; their values
+ *      are returned unchanged.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ *
+ * \exception ObjectDoesntExistException
+ */
+void
+RamCloud::readLarge(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, uint64_t* version)
+{
+    LargeObject::read(this, tableId, key, keyLength, value, version);
+}
+
+/**
+ * Read part of the value of an object; only the requested bytes are
+ * returned by the server.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param offset
+ *      Offset within the object's value of the first byte to read.
+ * \param length
+ *      Maximum number of bytes to read. Fewer are returned if the value
+ *      ends first; none if \a offset is at or beyond its end.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the requested
+ *      bytes of the object's value.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] valueLength
+ *      If non-NULL, the length of the object's entire value is returned
+ *      here.
+ */
+void
+RamCloud::readRange(uint64_t tableId, const void* key, uint16_t keyLength,
+        uint32_t offset, uint32_t length, Buffer* value,
+        const RejectRules* rejectRules, uint64_t* version,
+        uint32_t* valueLength)
+{
+    ReadRangeRpc rpc(this, tableId, key, keyLength, offset, length, value,
+            rejectRules);
+    rpc.wait(version, valueLength);
+}
+
+/**
+ * Constructor for ReadRangeRpc: initiates an RPC in the same way as
+ * #RamCloud::readRange, but returns once the RPC has been initiated,
+ * without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.  The caller must
+ *      ensure that the storage for this key is unchanged through the life of
+ *      the RPC.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param offset
+ *      Offset within the object's value of the first byte to read.
+ * \param length
+ *      Maximum number of bytes to read.
+ * \param[out] value
+ *      After a successful return, this Buffer will hold the requested
+ *      bytes of the object's value.
+ * \param rejectRules
+ *      If non-NULL, specifies conditions under which the read
+ *      should be aborted with an error.
+ */
+ReadRangeRpc::ReadRangeRpc(RamCloud* ramcloud, uint64_t tableId,
+        const void* key, uint16_t keyLength, uint32_t offset,
+        uint32_t length, Buffer* value, const RejectRules* rejectRules)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, key, keyLength,
+            sizeof(WireFormat::ReadRange::Response), value)
+{
+    value->reset();
+    WireFormat::ReadRange::Request* reqHdr(
+            allocHeader<WireFormat::ReadRange>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyLength = keyLength;
+    reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
+    reqHdr->offset = offset;
+    reqHdr->length = length;
+    request.append(key, keyLength);
+    send();
+}
+
+/**
+ * Wait for the RPC to complete, and return the same results as
+ * #RamCloud::readRange.
+ *
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \param[out] valueLength
+ *      If non-NULL, the length of the object's entire value is returned
+ *      here.
+ */
+void
+ReadRangeRpc::wait(uint64_t* version, uint32_t* valueLength)
+{
+    waitInternal(context->dispatch);
+    const WireFormat::ReadRange::Response* respHdr(
+            getResponseHeader<WireFormat::ReadRange>());
+    if (version != NULL)
+        *version = respHdr->version;
+
+    if (respHdr->common.status != STATUS_OK)
+        ClientException::throwException(HERE, respHdr->common.status);
+    if (valueLength != NULL)
+        *valueLength = respHdr->valueLength;
+
+    // Truncate the response Buffer so that it consists of nothing
+    // but the requested bytes.
+    response->truncateFront(sizeof(*respHdr));
+    assert(respHdr->length == response->size());
+}
+
+/**
+ * Read part of a table as it was at one instant: each master takes a
+ * snapshot of a tablet when it is first asked for it (see TableSnapshot),
+ * and returns its objects over as many calls as needed. Different tablets
+ * are snapshotted at different times. SnapshotEnumerator provides a more
+ * convenient interface.
+ *
+ * \param tableId
+ *      The table to read.
+ * \param tabletFirstHash
+ *      Where to continue. The caller should provide zero on the initial
+ *      call, and the return value from the previous call afterwards.
+ * \param[in,out] snapshotId
+ *      Identifies the snapshot of the current tablet; opaque to the caller.
+ *      It should be zero on the initial call, and is then updated by each
+ *      call, which must be given its new value.
+ * \param[out] objects
+ *      After a successful return, this buffer will contain zero or more
+ *      objects from the snapshot, each preceded by its size as a uint32_t
+ *      (the same format as #enumerateTable). Zero objects doesn't mean the
+ *      tablet is finished: the master may still be reading its log.
+ *
+ * \return
+ *      The starting key hash of the tablet where reading should continue;
+ *      it must be passed to the next call as \a tabletFirstHash. A zero
+ *      return value with a zero \a snapshotId means that the whole table
+ *      has been read.
+ *
+ * \throw SnapshotTooOldException
+ *      The master discarded the snapshot (e.g. because it wasn't read for
+ *      a long time, or the master crashed or gave away the tablet).
+ */
+uint64_t
+RamCloud::readTableSnapshot(uint64_t tableId, uint64_t tabletFirstHash,
+        uint64_t* snapshotId, Buffer* objects)
+{
+    ReadTableSnapshotRpc rpc(this, tableId, tabletFirstHash, *snapshotId,
+            objects);
+    return rpc.wait(snapshotId);
+}
+
+/**
+ * Constructor for ReadTableSnapshotRpc: initiates an RPC in the same way as
+ * #RamCloud::readTableSnapshot, but returns once the RPC has been
+ * initiated, without waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table to read.
+ * \param tabletFirstHash
+ *      Where to continue; see #RamCloud::readTableSnapshot.
+ * \param snapshotId
+ *      Identifies the snapshot of the current tablet, or zero to take a new
+ *      one; see #RamCloud::readTableSnapshot.
+ * \param[out] objects
+ *      After a successful return, this buffer will contain zero or more
+ *      objects from the snapshot.
+ */
+ReadTableSnapshotRpc::ReadTableSnapshotRpc(RamCloud* ramcloud,
+        uint64_t tableId, uint64_t tabletFirstHash, uint64_t snapshotId,
+        Buffer* objects)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, tabletFirstHash,
+            sizeof(WireFormat::ReadTableSnapshot::Response), objects)
+{
+    WireFormat::ReadTableSnapshot::Request* reqHdr(
+            allocHeader<WireFormat::ReadTableSnapshot>());
+    reqHdr->tableId = tableId;
+    reqHdr->tabletFirstHash = tabletFirstHash;
+    reqHdr->snapshotId = snapshotId;
+    send();
+}
+
+/**
+ * Wait for a readTableSnapshot RPC to complete, and return the same
+ * results as #RamCloud::readTableSnapshot.
+ *
+ * \param[out] snapshotId
+ *      The snapshot id to pass to the next call.
+ * \return
+ *      Where to continue; see #RamCloud::readTableSnapshot.
+ */
+uint64_t
+ReadTableSnapshotRpc::wait(uint64_t* snapshotId)
+{
+    simpleWait(context);
+    const WireFormat::ReadTableSnapshot::Response* respHdr(
+            getResponseHeader<WireFormat::ReadTableSnapshot>());
+    *snapshotId = respHdr->snapshotId;
+    uint64_t result = respHdr->tabletFirstHash;
+
+    // Truncate the response Buffer so that it consists of nothing
+    // but the objects.
+    response->truncateFront(sizeof(*respHdr));
+    assert(respHdr->payloadBytes == response->size());
+    return result;
+}
+
 /**
  * Delete an object from a table. If the object does not currently exist
  * then the operation succeeds without doing anything (unless rejectRules
@@ -2139,6 +3089,26 @@ RamCloud::remove(uint64_t tableId, const void* key, uint16_t keyLength,
     rpc.wait(version);
 }
 
+/**
+ * Delete an object written with writeLarge, including all of the chunks
+ * of its value. If the object does not currently exist then the operation
+ * succeeds without doing anything.
+ *
+ * \param tableId
+ *      The table containing the object to be deleted (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.
+ * \param keyLength
+ *      Size in bytes of the key.
+ */
+void
+RamCloud::removeLarge(uint64_t tableId, const void* key, uint16_t keyLength)
+{
+    LargeObject::remove(this, tableId, key, keyLength);
+}
+
 /**
  * Constructor for RemoveRpc: initiates an RPC in the same way as
  * #RamCloud::remove, but returns once the RPC has been initiated, without
@@ -2165,6 +3135,7 @@ RemoveRpc::RemoveRpc(RamCloud* ramcloud, uint64_t tableId,
     : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key, keyLength,
             sizeof(WireFormat::Remove::Response))
 {
+    ramcloud->readCache->invalidate(tableId, key, keyLength);
     WireFormat::Remove::Request* reqHdr(allocHeader<WireFormat::Remove>());
     reqHdr->tableId = tableId;
     reqHdr->keyLength = keyLength;
@@ -2195,6 +3166,267 @@ RemoveRpc::wait(uint64_t* version)
         ClientException::throwException(HERE, respHdr->common.status);
 }
 
+/**
+ * Read the objects of a table whose primary keys fall in a range, in key
+ * order. Keys are ordered by their bytes, and a key comes before the
+ * longer keys it is a prefix of.
+ *
+ * Tablets are partitioned by key hash, so any range of keys is spread over
+ * all of the masters of the table. A SCAN request goes to each of them at
+ * once; each master keeps the keys of the table in order (it builds that
+ * index the first time the table is scanned) and returns its objects in
+ * the range, and the results are merged here. For a table with a single
+ * tablet, the scan takes one round trip to one master.
+ *
+ * \param tableId
+ *      The table containing the desired objects (return value from
+ *      a previous call to getTableId).
+ * \param startKey
+ *      Smallest primary key to return. It does not necessarily have to be
+ *      null terminated.
+ * \param startKeyLength
+ *      Size in bytes of \a startKey; 0 means the range starts with the
+ *      smallest key in the table.
+ * \param endKey
+ *      Objects with this primary key or larger ones are not returned.
+ * \param endKeyLength
+ *      Size in bytes of \a endKey; 0 means the range has no end.
+ * \param maxObjects
+ *      Return at most this many objects. Fewer may be returned even if the
+ *      range holds more, since each response is limited in size.
+ * \param[out] objects
+ *      The objects, in key order. Each is a WireFormat::Scan::Object header
+ *      followed by the object's keys and value, which can be parsed with
+ *      the Object constructor that takes keys and a value.
+ * \param[out] numObjects
+ *      Set to the number of objects in \a objects.
+ * \return
+ *      True means the range may hold more objects after the last one
+ *      returned. To continue, scan again from the smallest key that follows
+ *      the last one: the last key with a zero byte appended.
+ *
+ * \throw TableDoesntExistException
+ *      The coordinator has no record of the table.
+ */
+bool
+RamCloud::scan(uint64_t tableId, const void* startKey, uint16_t startKeyLength,
+        const void* endKey, uint16_t endKeyLength, uint32_t maxObjects,
+        Buffer* objects, uint32_t* numObjects)
+{
+    objects->reset();
+    *numObjects = 0;
+    if (maxObjects == 0)
+        return true;
+
+    /// The objects returned by one master that haven't been merged yet.
+    struct Cursor {
+        Cursor()
+            : response()
+            , offset(0)
+            , remaining(0)
+            , key(NULL)
+            , keyLength(0)
+            , recordLength(0)
+        {}
+
+        /// Point #key and #recordLength at the object at #offset.
+        void
+        load(uint64_t tableId)
+        {
+            if (remaining == 0)
+                return;
+            const WireFormat::Scan::Object* header =
+                    response.getOffset<WireFormat::Scan::Object>(offset);
+            Object object(tableId, header->version, 0, response,
+                    offset + sizeof32(*header), header->length);
+            key = object.getKey(0, &keyLength);
+            recordLength = sizeof32(*header) + header->length;
+        }
+
+        Buffer response;
+        uint32_t offset;
+        uint32_t remaining;
+        const void* key;
+        KeyLength keyLength;
+        uint32_t recordLength;
+
+        DISALLOW_COPY_AND_ASSIGN(Cursor);
+    };
+
+    while (true) {
+        vector<string> locators;
+        vector<KeyHash> keyHashes;
+        clientContext->objectFinder->getTableLocators(tableId, &locators,
+                &keyHashes);
+        size_t count = keyHashes.size();
+        std::unique_ptr<Cursor[]> cursors(new Cursor[count]);
+        std::unique_ptr<Tub<ScanRpc>[]> rpcs(new Tub<ScanRpc>[count]);
+        for (size_t i = 0; i < count; i++) {
+            rpcs[i].construct(this, tableId, keyHashes[i], startKey,
+                    startKeyLength, endKey, endKeyLength, maxObjects,
+                    &cursors[i].response);
+        }
+
+        // A master that stopped early may have more objects after its last
+        // one, and those may come before other masters' objects; nothing
+        // past the smallest such last key can be returned.
+        vector<WireFormat::Scan::Tablet> tablets;
+        Tub<string> cutoff;
+        for (size_t i = 0; i < count; i++) {
+            bool more = rpcs[i]->wait(&cursors[i].remaining, &tablets);
+            uint32_t last = 0;
+            for (uint32_t n = 1; n < cursors[i].remaining; n++) {
+                last += sizeof32(WireFormat::Scan::Object) + cursors[i].response
+                        .getOffset<WireFormat::Scan::Object>(last)->length;
+            }
+            cursors[i].offset = last;
+            cursors[i].load(tableId);
+            if (more && cursors[i].remaining > 0 && (!cutoff ||
+                    IndexKey::keyCompare(cursors[i].key, cursors[i].keyLength,
+                    cutoff->data(), downCast<uint16_t>(cutoff->size())) < 0)) {
+                cutoff.construct(static_cast<const char*>(cursors[i].key),
+                        cursors[i].keyLength);
+            }
+            cursors[i].offset = 0;
+            cursors[i].load(tableId);
+        }
+
+        // Unless the masters together scanned every tablet of the table
+        // exactly once, the table was reconfigured while the requests were
+        // being sent; look it up again and start over.
+        std::sort(tablets.begin(), tablets.end(),
+                [](const WireFormat::Scan::Tablet& a,
+                   const WireFormat::Scan::Tablet& b) {
+                    return a.startKeyHash < b.startKeyHash;
+                });
+        bool complete = !tablets.empty() && tablets[0].startKeyHash == 0 &&
+                tablets.back().endKeyHash == ~0UL;
+        for (size_t i = 1; complete && i < tablets.size(); i++) {
+            complete = tablets[i - 1].endKeyHash != ~0UL &&
+                    tablets[i].startKeyHash == tablets[i - 1].endKeyHash + 1;
+        }
+        if (!complete) {
+            LOG(DEBUG, "Scan of table %lu missed some tablets; retrying",
+                    tableId);
+            clientContext->objectFinder->flush(tableId);
+            usleep(200);
+            continue;
+        }
+
+        while (*numObjects < maxObjects) {
+            Cursor* next = NULL;
+            for (size_t i = 0; i < count; i++) {
+                Cursor* c = &cursors[i];
+                if (c->remaining > 0 && (next == NULL ||
+                        IndexKey::keyCompare(c->key, c->keyLength,
+                        next->key, next->keyLength) < 0)) {
+                    next = c;
+                }
+            }
+            if (next == NULL || (cutoff && IndexKey::keyCompare(next->key,
+                    next->keyLength, cutoff->data(),
+                    downCast<uint16_t>(cutoff->size())) > 0)) {
+                break;
+            }
+            objects->appendCopy(next->response.getRange(next->offset,
+                    next->recordLength), next->recordLength);
+            (*numObjects)++;
+            next->offset += next->recordLength;
+            next->remaining--;
+            next->load(tableId);
+        }
+
+        if (cutoff)
+            return true;
+        for (size_t i = 0; i < count; i++) {
+            if (cursors[i].remaining > 0)
+                return true;
+        }
+        return false;
+    }
+}
+
+/**
+ * Constructor for ScanRpc: sends a SCAN request to one of the masters of
+ * a table, for the objects it holds in a range of keys (see
+ * RamCloud::scan). Returns once the RPC has been initiated, without
+ * waiting for it to complete.
+ *
+ * \param ramcloud
+ *      The RAMCloud object that governs this RPC.
+ * \param tableId
+ *      The table containing the desired objects.
+ * \param keyHash
+ *      A key hash in one of the master's tablets of the table; selects the
+ *      master.
+ * \param startKey
+ *      Smallest primary key to return. The caller must ensure that the
+ *      storage for this key is unchanged through the life of the RPC.
+ * \param startKeyLength
+ *      Size in bytes of \a startKey; 0 means the range starts with the
+ *      smallest key in the table.
+ * \param endKey
+ *      Objects with this primary key or larger ones are not returned.
+ * \param endKeyLength
+ *      Size in bytes of \a endKey; 0 means the range has no end.
+ * \param maxObjects
+ *      Return at most this many objects.
+ * \param[out] response
+ *      Holds the objects once the RPC completes, in the format described
+ *      for RamCloud::scan.
+ */
+ScanRpc::ScanRpc(RamCloud* ramcloud, uint64_t tableId, uint64_t keyHash,
+        const void* startKey, uint16_t startKeyLength, const void* endKey,
+        uint16_t endKeyLength, uint32_t maxObjects, Buffer* response)
+    : ObjectRpcWrapper(ramcloud->clientContext, tableId, keyHash,
+            sizeof(WireFormat::Scan::Response), response)
+{
+    WireFormat::Scan::Request* reqHdr(allocHeader<WireFormat::Scan>());
+    reqHdr->tableId = tableId;
+    reqHdr->keyHash = keyHash;
+    reqHdr->startKeyLength = startKeyLength;
+    reqHdr->endKeyLength = endKeyLength;
+    reqHdr->maxObjects = maxObjects;
+    request.append(startKey, startKeyLength);
+    request.append(endKey, endKeyLength);
+    send();
+}
+
+/**
+ * Wait for a scan RPC to complete.
+ *
+ * \param[out] numObjects
+ *      Set to the number of objects returned; the response buffer holds
+ *      nothing but them.
+ * \param[out] tablets
+ *      The tablets of the table that the master scanned are appended here.
+ * \return
+ *      True means the master may have more objects in the range after the
+ *      last one returned.
+ */
+bool
+ScanRpc::wait(uint32_t* numObjects, vector<WireFormat::Scan::Tablet>* tablets)
+{
+    waitInternal(context->dispatch);
+    const WireFormat::Scan::Response* respHdr(
+            getResponseHeader<WireFormat::Scan>());
+    if (respHdr->common.status != STATUS_OK)
+        ClientException::throwException(HERE, respHdr->common.status);
+
+    *numObjects = respHdr->numObjects;
+    bool more = respHdr->more;
+    uint32_t tabletsOffset = response->size() -
+            respHdr->numTablets * sizeof32(WireFormat::Scan::Tablet);
+    for (uint32_t offset = tabletsOffset; offset < response->size();
+            offset += sizeof32(WireFormat::Scan::Tablet)) {
+        tablets->push_back(
+                *response->getOffset<WireFormat::Scan::Tablet>(offset));
+    }
+    response->truncate(tabletsOffset);
+    response->truncateFront(sizeof(*respHdr));
+    return more;
+}
+
 /**
  * This RPC is used to invoke a variety of miscellaneous operations
  * on a server, such as starting and stopping special timing
@@ -2690,6 +3922,49 @@ RamCloud::testingWaitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs)
     clientContext->objectFinder->waitForAllTabletsNormal(tableId, timeoutNs);
 }
 
+/**
+ * Open sessions to all of the masters holding a table before it is used,
+ * so that a short-lived client doesn't pay for session and connection
+ * setup on its first request to each of them. The table's configuration
+ * is fetched with a single request to the coordinator; then a session is
+ * opened to each master and a GET_SERVER_ID request is sent on all of
+ * them at once. For most transports opening a session only sets up local
+ * state, and the connection itself is made by the first request, so
+ * connections to all of the masters are set up in parallel. (InfRc
+ * exchanges queue pair information while opening each session; those
+ * exchanges share one socket and still happen one after another.)
+ *
+ * Masters that can't be reached are skipped: requests to them will deal
+ * with the problem as usual.
+ *
+ * \param tableId
+ *      The table whose masters to connect to.
+ *
+ * \throw TableDoesntExistException
+ *      The coordinator has no record of the table.
+ */
+void
+RamCloud::warmSessions(uint64_t tableId)
+{
+    vector<string> locators;
+    clientContext->objectFinder->getTableLocators(tableId, &locators);
+
+    auto rpcs = std::unique_ptr<Tub<GetServerIdRpc>[]>(
+            new Tub<GetServerIdRpc>[locators.size()]);
+    for (size_t i = 0; i < locators.size(); i++) {
+        rpcs[i].construct(clientContext,
+                clientContext->transportManager->getSession(locators[i]));
+    }
+    for (size_t i = 0; i < locators.size(); i++) {
+        try {
+            rpcs[i]->wait();
+        } catch (TransportException& e) {
+            LOG(NOTICE, "Couldn't warm up session to %s: %s",
+                    locators[i].c_str(), e.what());
+        }
+    }
+}
+
 /**
  * Replace the value of a given object, or create a new object if none
  * previously existed.
@@ -2721,16 +3996,20 @@ RamCloud::testingWaitForAllTabletsNormal(uint64_t tableId, uint64_t timeoutNs)
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
  *      Data loss may occur!
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after it is written:
+ *      from then on it is treated as if it didn't exist, and the server
+ *      reclaims its space without it being removed.
  *
  * \exception RejectRulesException
  */
 void
 RamCloud::write(uint64_t tableId, const void* key, uint16_t keyLength,
         const void* buf, uint32_t length, const RejectRules* rejectRules,
-        uint64_t* version, bool async)
+        uint64_t* version, bool async, uint32_t ttl)
 {
     WriteRpc rpc(this, tableId, key, keyLength, buf, length, rejectRules,
-            async);
+            async, ttl);
     rpc.wait(version);
 }
 
@@ -2763,19 +4042,23 @@ RamCloud::write(uint64_t tableId, const void* key, uint16_t keyLength,
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
  *      Data loss may occur!
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after it is written:
+ *      from then on it is treated as if it didn't exist, and the server
+ *      reclaims its space without it being removed.
  *
  * \exception RejectRulesException
  */
 void
 RamCloud::write(uint64_t tableId, const void* key, uint16_t keyLength,
         const char* value, const RejectRules* rejectRules, uint64_t* version,
-        bool async)
+        bool async, uint32_t ttl)
 {
     uint32_t valueLength =
             (value == NULL) ? 0 : downCast<uint32_t>(strlen(value));
 
     WriteRpc rpc(this, tableId, key, keyLength, value, valueLength,
-                    rejectRules, async);
+                    rejectRules, async, ttl);
     rpc.wait(version);
 }
 
@@ -2816,16 +4099,20 @@ RamCloud::write(uint64_t tableId, const void* key, uint16_t keyLength,
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
  *      Data loss may occur!
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after it is written:
+ *      from then on it is treated as if it didn't exist, and the server
+ *      reclaims its space without it being removed.
  *
  * \exception RejectRulesException
  */
 void
 RamCloud::write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyList,
         const void* buf, uint32_t length, const RejectRules* rejectRules,
-        uint64_t* version, bool async)
+        uint64_t* version, bool async, uint32_t ttl)
 {
     WriteRpc rpc(this, tableId, numKeys, keyList, buf, length, rejectRules,
-            async);
+            async, ttl);
     rpc.wait(version);
 }
 
@@ -2863,21 +4150,56 @@ RamCloud::write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyList,
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
  *      Data loss may occur!
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after it is written:
+ *      from then on it is treated as if it didn't exist, and the server
+ *      reclaims its space without it being removed.
  *
  * \exception RejectRulesException
  */
 void
 RamCloud::write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyList,
         const char* value, const RejectRules* rejectRules, uint64_t* version,
-        bool async)
+        bool async, uint32_t ttl)
 {
     uint32_t valueLength =
             (value == NULL) ? 0 : downCast<uint32_t>(strlen(value));
     WriteRpc rpc(this, tableId, numKeys, keyList, value,
-            valueLength, rejectRules, async);
+            valueLength, rejectRules, async, ttl);
     rpc.wait(version);
 }
 
+/**
+ * Replace the value of a given object, or create a new object if none
+ * previously existed, without the limit on value size of #write. Large
+ * values are split into chunks that are stored as separate objects and
+ * written with many RPCs in parallel; the new value becomes visible to
+ * readLarge all at once, after all of its chunks have been written.
+ * Objects written this way must be read with readLarge and removed with
+ * removeLarge.
+ *
+ * \param tableId
+ *      The table containing the desired object (return value from
+ *      a previous call to getTableId).
+ * \param key
+ *      Variable length key that uniquely identifies the object within tableId.
+ *      It does not necessarily have to be null terminated.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param buf
+ *      Address of the first byte of the new contents for the object.
+ * \param length
+ *      Size in bytes of the new contents for the object.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ */
+void
+RamCloud::writeLarge(uint64_t tableId, const void* key, uint16_t keyLength,
+        const void* buf, uint32_t length, uint64_t* version)
+{
+    LargeObject::write(this, tableId, key, keyLength, buf, length, version);
+}
+
 /**
  * Constructor for WriteRpc: initiates an RPC in the same way as
  * #RamCloud::write, but returns once the RPC has been initiated, without
@@ -2906,31 +4228,60 @@ RamCloud::write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyList,
  *      should be aborted with an error.
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
- *      Data loss may occur!
+ *      Data loss may occur! Same as passing WireFormat::Write::MEMORY_ONLY
+ *      for \a durability.
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after it is written:
+ *      from then on it is treated as if it didn't exist, and the server
+ *      reclaims its space without it being removed.
+ * \param durability
+ *      How many of the object's replicas must be on backups before the write
+ *      completes. Writes that don't wait for all of them can find out when
+ *      they become fully durable with the position returned by wait(); see
+ *      MasterClient::getDurablePosition.
  */
 WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
         const void* key, uint16_t keyLength, const void* buf, uint32_t length,
-        const RejectRules* rejectRules, bool async)
-    : LinearizableObjectRpcWrapper(ramcloud, true, tableId, key,
-            keyLength, sizeof(WireFormat::Write::Response))
+        const RejectRules* rejectRules, bool async, uint32_t ttl,
+        WireFormat::Write::Durability durability)
+    : LinearizableObjectRpcWrapper(ramcloud,
+            async || ttl != 0 || durability != WireFormat::Write::ALL_REPLICAS
+            || !ramcloud->coalescer->isEnabled(), tableId,
+            key, keyLength, sizeof(WireFormat::Write::Response))
+    , coalescedOp()
 {
-    WireFormat::Write::Request* reqHdr(allocHeader<WireFormat::Write>());
-    reqHdr->tableId = tableId;
-
-    uint32_t totalLength = 0;
     uint16_t currentKeyLength = 0;
     if (keyLength)
         currentKeyLength = keyLength;
     else
         currentKeyLength = static_cast<uint16_t>(strlen(
                                static_cast<const char *>(key)));
+    ramcloud->readCache->invalidate(tableId, key, currentKeyLength);
+
+    // Coalesced writes travel in MultiWrite RPCs, which aren't linearizable
+    // (hence linearizability is turned off above) and can't carry a ttl or
+    // a durability level.
+    if (async)
+        durability = WireFormat::Write::MEMORY_ONLY;
+    if (durability == WireFormat::Write::ALL_REPLICAS && ttl == 0 &&
+            ramcloud->coalescer->isEnabled()) {
+        coalescedOp = ramcloud->coalescer->addWrite(tableId, key,
+                currentKeyLength, buf, length, rejectRules);
+        return;
+    }
+
+    WireFormat::Write::Request* reqHdr(allocHeader<WireFormat::Write>());
+    reqHdr->tableId = tableId;
+
+    uint32_t totalLength = 0;
 
     Key primaryKey(tableId, key, currentKeyLength);
     Object::appendKeysAndValueToBuffer(primaryKey, buf, length,
                                        &request, false, &totalLength);
 
     reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
-    reqHdr->async = async;
+    reqHdr->durability = downCast<uint8_t>(durability);
+    reqHdr->ttl = ttl;
     reqHdr->length = totalLength;
 
     fillLinearizabilityHeader<WireFormat::Write::Request>(reqHdr);
@@ -2967,15 +4318,36 @@ WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
  *      should be aborted with an error.
  * \param async
  *      If true, the new object will not be immediately replicated to backups.
- *      Data loss may occur!
+ *      Data loss may occur! Same as passing WireFormat::Write::MEMORY_ONLY
+ *      for \a durability.
+ * \param ttl
+ *      If nonzero, the object expires this many seconds after it is written:
+ *      from then on it is treated as if it didn't exist, and the server
+ *      reclaims its space without it being removed.
+ * \param durability
+ *      How many of the object's replicas must be on backups before the write
+ *      completes. Writes that don't wait for all of them can find out when
+ *      they become fully durable with the position returned by wait(); see
+ *      MasterClient::getDurablePosition.
  */
 WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
         uint8_t numKeys, KeyInfo *keyList, const void* buf, uint32_t length,
-        const RejectRules* rejectRules, bool async)
+        const RejectRules* rejectRules, bool async, uint32_t ttl,
+        WireFormat::Write::Durability durability)
     : LinearizableObjectRpcWrapper(ramcloud, true, tableId,
             keyList[0].key, keyList[0].keyLength,
             sizeof(WireFormat::Write::Response))
+    , coalescedOp()
 {
+    uint16_t primaryKeyLength = keyList[0].keyLength;
+    if (primaryKeyLength == 0)
+        primaryKeyLength = static_cast<uint16_t>(strlen(
+                static_cast<const char *>(keyList[0].key)));
+    ramcloud->readCache->invalidate(tableId, keyList[0].key,
+                                    primaryKeyLength);
+    if (async)
+        durability = WireFormat::Write::MEMORY_ONLY;
+
     WireFormat::Write::Request* reqHdr(allocHeader<WireFormat::Write>());
     reqHdr->tableId = tableId;
 
@@ -2985,7 +4357,8 @@ WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
     Object::appendKeysAndValueToBuffer(tableId, numKeys, keyList,
                     buf, length, &request, &totalLength);
     reqHdr->rejectRules = rejectRules ? *rejectRules : defaultRejectRules;
-    reqHdr->async = async;
+    reqHdr->durability = downCast<uint8_t>(durability);
+    reqHdr->ttl = ttl;
     reqHdr->length = totalLength;
 
     fillLinearizabilityHeader<WireFormat::Write::Request>(reqHdr);
@@ -2993,6 +4366,17 @@ WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
     send();
 }
 
+/**
+ * Indicates whether the write has completed (see RpcWrapper::isReady).
+ */
+bool
+WriteRpc::isReady()
+{
+    if (coalescedOp)
+        return coalescedOp->coalescer->isReady(coalescedOp.get());
+    return LinearizableObjectRpcWrapper::isReady();
+}
+
 /**
  * Wait for a write RPC to complete, and return the same results as
  * #RamCloud::write.
@@ -3000,16 +4384,49 @@ WriteRpc::WriteRpc(RamCloud* ramcloud, uint64_t tableId,
  * \param[out] version
  *      If non-NULL, the current version number of the object is
  *      returned here.
+ * \param[out] masterId
+ *      If non-NULL, the master that wrote the object is returned here, or
+ *      an invalid ServerId if the write was already fully durable when it
+ *      completed.
+ * \param[out] position
+ *      If non-NULL, a position in the log of \a masterId after the object
+ *      is returned here: the write is fully durable once
+ *      MasterClient::getDurablePosition reaches it. Zero if \a masterId
+ *      is invalid.
  */
 void
-WriteRpc::wait(uint64_t* version)
+WriteRpc::wait(uint64_t* version, ServerId* masterId, LogPosition* position)
 {
+    if (coalescedOp) {
+        coalescedOp->coalescer->wait(coalescedOp.get());
+        const MultiWriteObject& write = *coalescedOp->write;
+        if (version != NULL)
+            *version = write.version;
+        if (masterId != NULL)
+            *masterId = ServerId();
+        if (position != NULL)
+            *position = LogPosition();
+        if (write.status != STATUS_OK)
+            ClientException::throwException(HERE, write.status);
+        return;
+    }
+
     waitInternal(context->dispatch);
     const WireFormat::Write::Response* respHdr(
             getResponseHeader<WireFormat::Write>());
 
     if (version != NULL)
         *version = respHdr->version;
+    const WireFormat::Write::Position* durability =
+            response->getOffset<WireFormat::Write::Position>(
+            sizeof32(*respHdr));
+    if (masterId != NULL)
+        *masterId = durability ? ServerId(durability->masterId) : ServerId();
+    if (position != NULL) {
+        *position = durability ? LogPosition(durability->segmentId,
+                                             durability->segmentOffset)
+                               : LogPosition();
+    }
 
     if (respHdr->common.status != STATUS_OK)
         ClientException::throwException(HERE, respHdr->common.status);
@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_RAMCLOUD_H
 #define RAMCLOUD_RAMCLOUD_H
 
+#include <memory>
+
 #include "CoordinatorRpcWrapper.h"
 #include "IndexRpcWrapper.h"
 #include "LinearizableObjectRpcWrapper.h"
@@ -29,13 +31,18 @@
 #include "ServerStatistics.pb.h"
 
 namespace RAMCloud {
+struct CoalescedOp;
 class ClientLeaseAgent;
 class ClientTransactionManager;
+class EnumerationFilter;
 class MultiIncrementObject;
 class MultiReadObject;
 class MultiRemoveObject;
 class MultiWriteObject;
 class ObjectFinder;
+class ReadCache;
+class RemoteReader;
+class RpcCoalescer;
 class RpcTracker;
 
 /**
@@ -66,18 +73,32 @@ struct KeyInfo
  */
 class RamCloud {
   public:
+    void append(uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* buf, uint32_t length,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL);
     void coordSplitAndMigrateIndexlet(
             ServerId newOwner, uint64_t tableId, uint8_t indexId,
             const void* splitKey, KeyLength splitKeyLength);
-    uint64_t createTable(const char* name, uint32_t serverSpan = 1);
+    uint64_t createTable(const char* name, uint32_t serverSpan = 1,
+            Key::HashFunction keyHash = Key::MURMUR3);
     void dropTable(const char* name);
     void createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
             uint8_t numIndexlets = 1);
     void dropIndex(uint64_t tableId, uint8_t indexId);
+    void disableCoalescing();
     void echo(const char* serviceLocator, const void* message, uint32_t length,
          uint32_t echoLength, Buffer* echo);
+    void enableCoalescing(uint32_t windowMicros = 10);
+    void enableHedgedReads(uint64_t tableId);
+    void enableMasterConfigFetches();
+    void enableReplicaReads(uint64_t tableId);
+    void enableReadCache(uint32_t leaseMicros = 1000,
+            uint32_t maxEntries = 10000);
+    void enableRemoteReads(uint32_t maxHints = 10000);
     uint64_t enumerateTable(uint64_t tableId, bool keysOnly,
-         uint64_t tabletFirstHash, Buffer& state, Buffer& objects);
+         uint64_t tabletFirstHash, Buffer& state, Buffer& objects,
+         const EnumerationFilter* filter = NULL, uint64_t lastHash = ~0UL,
+         bool logOrder = false);
     void getLogMetrics(const char* serviceLocator,
             ProtoBuf::LogMetrics& logMetrics);
     ServerMetrics getMetrics(uint64_t tableId, const void* key,
@@ -122,14 +143,29 @@ class RamCloud {
             uint16_t keyLength, WireFormat::ControlOp controlOp,
             const void* inputData = NULL, uint32_t inputLength = 0,
             Buffer* outputData = NULL);
+    void patch(uint64_t tableId, const void* key, uint16_t keyLength,
+            uint32_t offset, const void* buf, uint32_t length,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL);
     void read(uint64_t tableId, const void* key, uint16_t keyLength,
             Buffer* value, const RejectRules* rejectRules = NULL,
             uint64_t* version = NULL);
     void readKeysAndValue(uint64_t tableId, const void* key, uint16_t keyLength,
             ObjectBuffer* value, const RejectRules* rejectRules = NULL,
             uint64_t* version = NULL);
+    void readLarge(uint64_t tableId, const void* key, uint16_t keyLength,
+            Buffer* value, uint64_t* version = NULL);
+    void readRange(uint64_t tableId, const void* key, uint16_t keyLength,
+            uint32_t offset, uint32_t length, Buffer* value,
+            const RejectRules* rejectRules = NULL, uint64_t* version = NULL,
+            uint32_t* valueLength = NULL);
+    uint64_t readTableSnapshot(uint64_t tableId, uint64_t tabletFirstHash,
+            uint64_t* snapshotId, Buffer* objects);
     void remove(uint64_t tableId, const void* key, uint16_t keyLength,
             const RejectRules* rejectRules = NULL, uint64_t* version = NULL);
+    void removeLarge(uint64_t tableId, const void* key, uint16_t keyLength);
+    bool scan(uint64_t tableId, const void* startKey, uint16_t startKeyLength,
+            const void* endKey, uint16_t endKeyLength, uint32_t maxObjects,
+            Buffer* objects, uint32_t* numObjects);
     void serverControlAll(WireFormat::ControlOp controlOp,
             const void* inputData = NULL, uint32_t inputLength = 0,
             Buffer* outputData = NULL);
@@ -146,20 +182,23 @@ class RamCloud {
     void setRuntimeOption(const char* option, const char* value);
     void testingWaitForAllTabletsNormal(uint64_t tableId,
             uint64_t timeoutNs = ~0lu);
+    void warmSessions(uint64_t tableId);
     void write(uint64_t tableId, const void* key, uint16_t keyLength,
             const void* buf, uint32_t length,
             const RejectRules* rejectRules = NULL, uint64_t* version = NULL,
-            bool async = false);
+            bool async = false, uint32_t ttl = 0);
     void write(uint64_t tableId, const void* key, uint16_t keyLength,
             const char* value, const RejectRules* rejectRules = NULL,
-            uint64_t* version = NULL, bool async = false);
+            uint64_t* version = NULL, bool async = false, uint32_t ttl = 0);
     void write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyInfo,
             const void* buf, uint32_t length,
             const RejectRules* rejectRules = NULL, uint64_t* version = NULL,
-            bool async = false);
+            bool async = false, uint32_t ttl = 0);
     void write(uint64_t tableId, uint8_t numKeys, KeyInfo *keyInfo,
             const char* value, const RejectRules* rejectRules = NULL,
-            uint64_t* version = NULL, bool async = false);
+            uint64_t* version = NULL, bool async = false, uint32_t ttl = 0);
+    void writeLarge(uint64_t tableId, const void* key, uint16_t keyLength,
+            const void* buf, uint32_t length, uint64_t* version = NULL);
 
     void poll();
     explicit RamCloud(CommandLineOptions* options);
@@ -198,11 +237,30 @@ class RamCloud {
     ClientLeaseAgent *clientLeaseAgent;
     RpcTracker *rpcTracker;
     ClientTransactionManager *transactionManager;
+    RpcCoalescer *coalescer;
+    RemoteReader *remoteReader;
+    ReadCache *readCache;
 
   private:
     DISALLOW_COPY_AND_ASSIGN(RamCloud);
 };
 
+/**
+ * Encapsulates the state of a RamCloud::append operation,
+ * allowing it to execute asynchronously.
+ */
+class AppendRpc : public LinearizableObjectRpcWrapper {
+  public:
+    AppendRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, const void* buf, uint32_t length,
+            const RejectRules* rejectRules = NULL);
+    ~AppendRpc() {}
+    void wait(uint64_t* version = NULL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(AppendRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::coordSplitAndMigrateIndexlet operation,
  * allowing it to execute asynchronously.
@@ -227,7 +285,8 @@ class CoordSplitAndMigrateIndexletRpc : public CoordinatorRpcWrapper {
 class CreateTableRpc : public CoordinatorRpcWrapper {
   public:
     CreateTableRpc(RamCloud* ramcloud, const char* name,
-            uint32_t serverSpan = 1);
+            uint32_t serverSpan = 1,
+            Key::HashFunction keyHash = Key::MURMUR3);
     ~CreateTableRpc() {}
     uint64_t wait();
 
@@ -310,7 +369,9 @@ class EchoRpc : public RpcWrapper {
 class EnumerateTableRpc : public ObjectRpcWrapper {
   public:
     EnumerateTableRpc(RamCloud* ramcloud, uint64_t tableId, bool keysOnly,
-            uint64_t tabletFirstHash, Buffer& iter, Buffer& objects);
+            uint64_t tabletFirstHash, Buffer& iter, Buffer& objects,
+            const EnumerationFilter* filter = NULL, uint64_t lastHash = ~0UL,
+            bool logOrder = false);
     ~EnumerateTableRpc() {}
     uint64_t wait(Buffer& nextIter);
 
@@ -479,7 +540,7 @@ class ReadHashesRpc : public ObjectRpcWrapper {
             Buffer* pKHashes, Buffer* response);
     ~ReadHashesRpc() {}
     /// \copydoc RpcWrapper::docForWait
-    uint32_t wait(uint32_t* numObjects);
+    uint32_t wait(uint32_t* numObjects, uint32_t* hashesPerResponse = NULL);
 
   PRIVATE:
     DISALLOW_COPY_AND_ASSIGN(ReadHashesRpc);
@@ -543,6 +604,30 @@ class LookupIndexKeysRpc : public IndexRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(LookupIndexKeysRpc);
 };
 
+/**
+ * Looks up primary key hashes in an index, as LookupIndexKeysRpc does, and
+ * also returns the objects matching as many of them as the index server can
+ * read locally. Used by IndexLookup to skip the ReadHashesRpc for indexes
+ * co-located with their tables.
+ */
+class LookupIndexKeysAndReadRpc : public IndexRpcWrapper {
+  public:
+    LookupIndexKeysAndReadRpc(RamCloud* ramcloud, uint64_t tableId,
+            uint8_t indexId, const void* firstKey, uint16_t firstKeyLength,
+            uint64_t firstAllowedKeyHash,
+            const void* lastKey, uint16_t lastKeyLength,
+            uint32_t maxNumHashes, Buffer* responseBuffer);
+    ~LookupIndexKeysAndReadRpc() {}
+
+    void handleIndexDoesntExist();
+    void wait(uint32_t* numHashes, uint16_t* nextKeyLength,
+            uint64_t* nextKeyHash, uint32_t* numReadHashes,
+            uint32_t* numObjects);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(LookupIndexKeysAndReadRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::migrateTablet operation,
  * allowing it to execute asynchronously.
@@ -931,6 +1016,22 @@ struct MultiWriteObject : public MultiOpObject {
     }
 };
 
+/**
+ * Encapsulates the state of a RamCloud::patch operation,
+ * allowing it to execute asynchronously.
+ */
+class PatchRpc : public LinearizableObjectRpcWrapper {
+  public:
+    PatchRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, uint32_t offset, const void* buf,
+            uint32_t length, const RejectRules* rejectRules = NULL);
+    ~PatchRpc() {}
+    void wait(uint64_t* version = NULL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(PatchRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::read operation,
  * allowing it to execute asynchronously.
@@ -941,9 +1042,49 @@ class ReadRpc : public ObjectRpcWrapper {
             uint16_t keyLength, Buffer* value,
             const RejectRules* rejectRules = NULL);
     ~ReadRpc() {}
+    bool isReady();
     void wait(uint64_t* version = NULL);
 
+  PROTECTED:
+    virtual bool checkStatus();
+    virtual Transport::SessionRef getHedgeSession();
+    virtual bool handleTransportError();
+    virtual void hedgeCompleted();
+    virtual void send();
+
   PRIVATE:
+    void startHedgeTimer();
+
+    /// If the read was handed to RamCloud::coalescer instead of being
+    /// sent as an RPC of its own, its state there.
+    std::shared_ptr<CoalescedOp> coalescedOp;
+
+    /// If non-NULL, the read asked the master for a remote read hint,
+    /// which is recorded here.
+    RemoteReader* remoteReader;
+
+    /// True means the read may be served by a hot key replica (see
+    /// ObjectFinder::enableReplicaReads).
+    bool allowReplica;
+
+    /// True means the request was last sent to a replica rather than to
+    /// the object's master.
+    bool sentToReplica;
+
+    /// True means the read may be hedged (see
+    /// ObjectFinder::enableHedgedReads).
+    bool hedged;
+
+    /// True means the hedge, if any, was sent to a replica.
+    bool hedgeSentToReplica;
+
+    /// If non-NULL, the session the request was last sent on; the read's
+    /// latency is recorded for it when the read completes.
+    Transport::SessionRef timedSession;
+
+    /// Cycles::rdtsc when the request was last sent on #timedSession.
+    uint64_t sendTime;
+
     DISALLOW_COPY_AND_ASSIGN(ReadRpc);
 };
 
@@ -956,7 +1097,7 @@ class ReadKeysAndValueRpc : public ObjectRpcWrapper {
   public:
     ReadKeysAndValueRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
             uint16_t keyLength, ObjectBuffer* value,
-            const RejectRules* rejectRules = NULL);
+            const RejectRules* rejectRules = NULL, uint64_t snapshotTime = 0);
     ~ReadKeysAndValueRpc() {}
     void wait(uint64_t* version = NULL);
 
@@ -964,6 +1105,37 @@ class ReadKeysAndValueRpc : public ObjectRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(ReadKeysAndValueRpc);
 };
 
+/**
+ * Encapsulates the state of a RamCloud::readRange operation,
+ * allowing it to execute asynchronously.
+ */
+class ReadRangeRpc : public ObjectRpcWrapper {
+  public:
+    ReadRangeRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
+            uint16_t keyLength, uint32_t offset, uint32_t length,
+            Buffer* value, const RejectRules* rejectRules = NULL);
+    ~ReadRangeRpc() {}
+    void wait(uint64_t* version = NULL, uint32_t* valueLength = NULL);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ReadRangeRpc);
+};
+
+/**
+ * Encapsulates the state of a RamCloud::readTableSnapshot operation,
+ * allowing it to execute asynchronously.
+ */
+class ReadTableSnapshotRpc : public ObjectRpcWrapper {
+  public:
+    ReadTableSnapshotRpc(RamCloud* ramcloud, uint64_t tableId,
+            uint64_t tabletFirstHash, uint64_t snapshotId, Buffer* objects);
+    ~ReadTableSnapshotRpc() {}
+    uint64_t wait(uint64_t* snapshotId);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ReadTableSnapshotRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::remove operation,
  * allowing it to execute asynchronously.
@@ -995,6 +1167,24 @@ class ObjectServerControlRpc : public ObjectRpcWrapper {
     DISALLOW_COPY_AND_ASSIGN(ObjectServerControlRpc);
 };
 
+/**
+ * Encapsulates the state of a SCAN request to one of the masters of a
+ * table; RamCloud::scan sends one of these to each master at once.
+ */
+class ScanRpc : public ObjectRpcWrapper {
+  public:
+    ScanRpc(RamCloud* ramcloud, uint64_t tableId, uint64_t keyHash,
+            const void* startKey, uint16_t startKeyLength,
+            const void* endKey, uint16_t endKeyLength, uint32_t maxObjects,
+            Buffer* response);
+    ~ScanRpc() {}
+    bool wait(uint32_t* numObjects,
+            vector<WireFormat::Scan::Tablet>* tablets);
+
+  PRIVATE:
+    DISALLOW_COPY_AND_ASSIGN(ScanRpc);
+};
+
 /**
  * Encapsulates the state of a RamCloud::setRuntimeOption operation,
  * allowing it to execute asynchronously.
@@ -1035,16 +1225,26 @@ class WriteRpc : public LinearizableObjectRpcWrapper {
   public:
     WriteRpc(RamCloud* ramcloud, uint64_t tableId, const void* key,
             uint16_t keyLength, const void* buf, uint32_t length,
-            const RejectRules* rejectRules = NULL, bool async = false);
+            const RejectRules* rejectRules = NULL, bool async = false,
+            uint32_t ttl = 0, WireFormat::Write::Durability durability =
+                    WireFormat::Write::ALL_REPLICAS);
     // this constructor will be used when the object has multiple keys
     WriteRpc(RamCloud* ramcloud, uint64_t tableId,
             uint8_t numKeys, KeyInfo *keyInfo,
             const void* buf, uint32_t length,
-            const RejectRules* rejectRules = NULL, bool async = false);
+            const RejectRules* rejectRules = NULL, bool async = false,
+            uint32_t ttl = 0, WireFormat::Write::Durability durability =
+                    WireFormat::Write::ALL_REPLICAS);
     ~WriteRpc() {}
-    void wait(uint64_t* version = NULL);
+    bool isReady();
+    void wait(uint64_t* version = NULL, ServerId* masterId = NULL,
+            LogPosition* position = NULL);
 
   PRIVATE:
+    /// If the write was handed to RamCloud::coalescer instead of being
+    /// sent as an RPC of its own, its state there.
+    std::shared_ptr<CoalescedOp> coalescedOp;
+
     DISALLOW_COPY_AND_ASSIGN(WriteRpc);
 };
 
@@ -719,6 +719,68 @@ TEST_F(RamCloudTest, writeNullValue) {
     EXPECT_EQ(0U, valueLength);
 }
 
+TEST_F(RamCloudTest, warmSessions) {
+    TransportManager* manager = context.transportManager;
+    manager->flushSession("mock:host=master1");
+    manager->flushSession("mock:host=master2");
+    ramcloud->warmSessions(tableId3);
+    EXPECT_EQ(1u, manager->sessionCache.count("mock:host=master1"));
+    EXPECT_EQ(1u, manager->sessionCache.count("mock:host=master2"));
+
+    EXPECT_THROW(ramcloud->warmSessions(99), TableDoesntExistException);
+}
+
+/// Return the primary keys of the objects returned by RamCloud::scan.
+static string
+scanKeys(uint64_t tableId, Buffer& objects, uint32_t numObjects)
+{
+    string result;
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < numObjects; i++) {
+        WireFormat::Scan::Object* header =
+                objects.getOffset<WireFormat::Scan::Object>(offset);
+        offset += sizeof32(*header);
+        Object object(tableId, header->version, 0, objects, offset,
+                header->length);
+        offset += header->length;
+        KeyLength keyLength;
+        const void* key = object.getKey(0, &keyLength);
+        if (!result.empty())
+            result += " ";
+        result += string(static_cast<const char*>(key), keyLength);
+    }
+    return result;
+}
+
+TEST_F(RamCloudTest, scan) {
+    // The tablets of table3 are spread over both masters, so the results
+    // from each have to be merged.
+    for (int i = 9; i >= 0; i--) {
+        string key = format("k%d", i);
+        ramcloud->write(tableId3, key.data(), 2, "value", 5);
+    }
+    Buffer objects;
+    uint32_t numObjects;
+    EXPECT_FALSE(ramcloud->scan(tableId3, "", 0, "", 0, 100, &objects,
+            &numObjects));
+    EXPECT_EQ("k0 k1 k2 k3 k4 k5 k6 k7 k8 k9",
+            scanKeys(tableId3, objects, numObjects));
+
+    EXPECT_FALSE(ramcloud->scan(tableId3, "k3", 2, "k6", 2, 100, &objects,
+            &numObjects));
+    EXPECT_EQ("k3 k4 k5", scanKeys(tableId3, objects, numObjects));
+
+    EXPECT_TRUE(ramcloud->scan(tableId3, "", 0, "", 0, 4, &objects,
+            &numObjects));
+    EXPECT_EQ("k0 k1 k2 k3", scanKeys(tableId3, objects, numObjects));
+    EXPECT_FALSE(ramcloud->scan(tableId3, "k3\0", 3, "", 0, 6, &objects,
+            &numObjects));
+    EXPECT_EQ("k4 k5 k6 k7 k8 k9", scanKeys(tableId3, objects, numObjects));
+
+    EXPECT_THROW(ramcloud->scan(99, "", 0, "", 0, 1, &objects, &numObjects),
+            TableDoesntExistException);
+}
+
 TEST_F(RamCloudTest, readHashes) {
     uint64_t tableId = ramcloud->createTable("table");
     ramcloud->createIndex(tableId, 1, 0);
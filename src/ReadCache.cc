@@ -0,0 +1,186 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "ReadCache.h"
+#include "ClientException.h"
+#include "Cycles.h"
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a ReadCache; it is disabled until enable() is called.
+ *
+ * \param ramcloud
+ *      The RAMCloud object whose reads may be served from the cache.
+ */
+ReadCache::ReadCache(RamCloud* ramcloud)
+    : ramcloud(ramcloud)
+    , entries()
+    , lruList()
+    , leaseCycles(0)
+    , maxEntries(0)
+{
+}
+
+/**
+ * Turn the cache on or off (see RamCloud::enableReadCache).
+ *
+ * \param leaseMicros
+ *      How long an object may be served from the cache before it must be
+ *      revalidated with its master.
+ * \param maxEntries
+ *      Upper limit on the number of objects cached at any given time; 0
+ *      disables the cache.
+ */
+void
+ReadCache::enable(uint32_t leaseMicros, uint32_t maxEntries)
+{
+    leaseCycles = Cycles::fromMicroseconds(leaseMicros);
+    this->maxEntries = maxEntries;
+    while (entries.size() > maxEntries) {
+        entries.erase(lruList.front());
+        lruList.pop_front();
+    }
+}
+
+/**
+ * Drop the cached copy of an object, if there is one. This is invoked
+ * whenever the object is modified through this RamCloud object.
+ *
+ * \param tableId
+ *      Table containing the object.
+ * \param key
+ *      Primary key of the object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ */
+void
+ReadCache::invalidate(uint64_t tableId, const void* key, uint16_t keyLength)
+{
+    if (entries.empty())
+        return;
+    EntryMap::iterator it = entries.find(EntryId(tableId,
+            string(static_cast<const char*>(key), keyLength)));
+    if (it == entries.end())
+        return;
+    lruList.erase(it->second.lruPosition);
+    entries.erase(it);
+}
+
+/**
+ * Read an object, using the cached copy if its lease hasn't run out. The
+ * arguments and exceptions are the same as for RamCloud::read (without
+ * reject rules).
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Primary key of the object.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      The value of the object is returned here.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ */
+void
+ReadCache::read(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, uint64_t* version)
+{
+    EntryId id(tableId, string(static_cast<const char*>(key), keyLength));
+    // The lease starts before the RPC is sent, so that the cached value is
+    // never older than the lease period.
+    uint64_t now = Cycles::rdtsc();
+    uint64_t leaseExpiration = now + leaseCycles;
+    EntryMap::iterator it = entries.find(id);
+    if (it == entries.end()) {
+        uint64_t newVersion;
+        ReadRpc rpc(ramcloud, tableId, key, keyLength, value);
+        rpc.wait(&newVersion);
+        if (version != NULL)
+            *version = newVersion;
+        insert(id, value, newVersion, leaseExpiration);
+        return;
+    }
+
+    Entry& entry = it->second;
+    if (now >= entry.leaseExpiration) {
+        // Only have the master return the object if it has a newer version.
+        RejectRules rejectRules;
+        memset(&rejectRules, 0, sizeof(rejectRules));
+        rejectRules.givenVersion = entry.version;
+        rejectRules.versionLeGiven = 1;
+        uint64_t newVersion;
+        try {
+            ReadRpc rpc(ramcloud, tableId, key, keyLength, value,
+                        &rejectRules);
+            rpc.wait(&newVersion);
+        } catch (WrongVersionException&) {
+            newVersion = entry.version;
+        } catch (ClientException&) {
+            invalidate(tableId, key, keyLength);
+            throw;
+        }
+        if (newVersion != entry.version) {
+            if (version != NULL)
+                *version = newVersion;
+            invalidate(tableId, key, keyLength);
+            insert(id, value, newVersion, leaseExpiration);
+            return;
+        }
+        entry.leaseExpiration = leaseExpiration;
+    }
+
+    lruList.splice(lruList.end(), lruList, entry.lruPosition);
+    value->reset();
+    value->appendCopy(entry.value.data(),
+                      downCast<uint32_t>(entry.value.size()));
+    if (version != NULL)
+        *version = entry.version;
+}
+
+/**
+ * Add an object to the cache, evicting the least recently read one if the
+ * cache is full.
+ *
+ * \param id
+ *      Identifies the object; must not be in the cache already.
+ * \param value
+ *      The object's value.
+ * \param version
+ *      The object's version.
+ * \param leaseExpiration
+ *      See Entry::leaseExpiration.
+ */
+void
+ReadCache::insert(const EntryId& id, Buffer* value, uint64_t version,
+        uint64_t leaseExpiration)
+{
+    if (entries.size() >= maxEntries) {
+        entries.erase(lruList.front());
+        lruList.pop_front();
+    }
+    Entry& entry = entries[id];
+    uint32_t length = value->size();
+    entry.value.assign(static_cast<const char*>(
+            value->getRange(0, length)), length);
+    entry.version = version;
+    entry.leaseExpiration = leaseExpiration;
+    entry.lruPosition = lruList.insert(lruList.end(), id);
+}
+
+} // namespace RAMCloud
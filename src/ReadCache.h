@@ -0,0 +1,109 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_READCACHE_H
+#define RAMCLOUD_READCACHE_H
+
+#include <list>
+#include <map>
+
+#include "Buffer.h"
+
+namespace RAMCloud {
+
+class RamCloud;
+
+/**
+ * Lets RamCloud::read serve repeated reads of the same objects out of a
+ * client-side cache instead of sending read RPCs. It is off unless
+ * RamCloud::enableReadCache() is called.
+ *
+ * Each cached object carries a lease: until it runs out, reads of the
+ * object are served locally, so a cached value is never more than one lease
+ * period older than the master's copy. Once a lease has run out, the next
+ * read revalidates the object with a read RPC whose reject rules carry the
+ * cached version; if the object hasn't changed the master rejects the read
+ * without returning its value, and the lease is simply renewed.
+ *
+ * Masters can't send RPCs to clients, so other clients' writes are only
+ * noticed when a lease runs out. Writes, removes, increments and appends
+ * issued through the same RamCloud object (other than multi-ops and
+ * transactions) drop the cached copy right away.
+ *
+ * Like RamCloud, this class is not thread-safe.
+ */
+class ReadCache {
+  PUBLIC:
+    explicit ReadCache(RamCloud* ramcloud);
+
+    void enable(uint32_t leaseMicros, uint32_t maxEntries);
+    void invalidate(uint64_t tableId, const void* key, uint16_t keyLength);
+    void read(uint64_t tableId, const void* key, uint16_t keyLength,
+              Buffer* value, uint64_t* version);
+
+    /// Returns true if reads should go through the cache.
+    bool isEnabled() const {
+        return maxEntries > 0;
+    }
+
+  PRIVATE:
+    /// Cached objects are indexed by table id and primary key.
+    typedef std::pair<uint64_t, string> EntryId;
+
+    /// One cached object.
+    struct Entry {
+        Entry() : value(), version(0), leaseExpiration(0), lruPosition() {}
+
+        /// The object's value as of #version.
+        string value;
+
+        /// Version of the object that #value belongs to.
+        uint64_t version;
+
+        /// Reads are served from the cache until Cycles::rdtsc() reaches
+        /// this; afterwards the object must be revalidated.
+        uint64_t leaseExpiration;
+
+        /// This entry's position in #lruList.
+        std::list<EntryId>::iterator lruPosition;
+    };
+
+    typedef std::map<EntryId, Entry> EntryMap;
+
+    void insert(const EntryId& id, Buffer* value, uint64_t version,
+                uint64_t leaseExpiration);
+
+    /// Overall client state information.
+    RamCloud* ramcloud;
+
+    /// Objects read recently.
+    EntryMap entries;
+
+    /// Ids of all of the objects in #entries, least recently read first.
+    std::list<EntryId> lruList;
+
+    /// How long a lease lasts, in Cycles::rdtsc() ticks.
+    uint64_t leaseCycles;
+
+    /// Upper limit on the size of #entries; 0 means the cache is off.
+    uint32_t maxEntries;
+
+    DISALLOW_COPY_AND_ASSIGN(ReadCache);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_READCACHE_H
@@ -0,0 +1,177 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "ClientException.h"
+#include "MockCluster.h"
+#include "PerfStats.h"
+#include "RamCloud.h"
+#include "ReadCache.h"
+
+namespace RAMCloud {
+
+class ReadCacheTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    Tub<RamCloud> otherClient;
+    uint64_t tableId;
+
+    ReadCacheTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , otherClient()
+        , tableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        ramcloud.construct(&context, "mock:host=coordinator");
+        otherClient.construct(&context, "mock:host=coordinator");
+
+        tableId = ramcloud->createTable("table1");
+        ramcloud->write(tableId, "object1", 7, "value1");
+    }
+
+    /// Returns the number of reads masters have performed (in this thread).
+    uint64_t
+    readCount()
+    {
+        return PerfStats::threadStats.readCount;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ReadCacheTest);
+};
+
+TEST_F(ReadCacheTest, disabledByDefault) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(0u, ramcloud->readCache->entries.size());
+}
+
+TEST_F(ReadCacheTest, enable_shrink) {
+    ramcloud->enableReadCache(1000000, 2);
+    ramcloud->write(tableId, "object2", 7, "value2");
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ramcloud->read(tableId, "object2", 7, &value);
+    ramcloud->enableReadCache(1000000, 1);
+    EXPECT_EQ(1u, ramcloud->readCache->entries.size());
+    EXPECT_EQ("object2", ramcloud->readCache->lruList.front().second);
+    ramcloud->enableReadCache(1000000, 0);
+    EXPECT_EQ(0u, ramcloud->readCache->entries.size());
+}
+
+TEST_F(ReadCacheTest, invalidate) {
+    ramcloud->enableReadCache(1000000);
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(1u, ramcloud->readCache->entries.size());
+    ramcloud->write(tableId, "object1", 7, "value2");
+    EXPECT_EQ(0u, ramcloud->readCache->entries.size());
+    EXPECT_EQ(0u, ramcloud->readCache->lruList.size());
+
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    ramcloud->remove(tableId, "object1", 7);
+    EXPECT_EQ(0u, ramcloud->readCache->entries.size());
+}
+
+TEST_F(ReadCacheTest, read_cached) {
+    ramcloud->enableReadCache(1000000);
+    Buffer value;
+    uint64_t version1, version2;
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version1);
+    EXPECT_EQ(reads + 1, readCount());
+
+    // Another client's write isn't seen until the lease runs out.
+    otherClient->write(tableId, "object1", 7, "value2");
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version2);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(version1, version2);
+}
+
+TEST_F(ReadCacheTest, read_leaseExpiredUnchanged) {
+    ramcloud->enableReadCache(0);
+    Buffer value;
+    uint64_t version1, version2;
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version1);
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version2);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(version1, version2);
+    EXPECT_EQ(1u, ramcloud->readCache->entries.size());
+}
+
+TEST_F(ReadCacheTest, read_leaseExpiredChanged) {
+    ramcloud->enableReadCache(0);
+    Buffer value;
+    uint64_t version1, version2;
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version1);
+    otherClient->write(tableId, "object1", 7, "value2");
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version2);
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    EXPECT_GT(version2, version1);
+    EXPECT_EQ("value2",
+            ramcloud->readCache->entries.begin()->second.value);
+}
+
+TEST_F(ReadCacheTest, read_leaseExpiredRemoved) {
+    ramcloud->enableReadCache(0);
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    otherClient->remove(tableId, "object1", 7);
+    EXPECT_THROW(ramcloud->read(tableId, "object1", 7, &value),
+                 ObjectDoesntExistException);
+    EXPECT_EQ(0u, ramcloud->readCache->entries.size());
+}
+
+TEST_F(ReadCacheTest, read_rejectRules) {
+    ramcloud->enableReadCache(1000000);
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.doesntExist = 1;
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value, &rules);
+    EXPECT_EQ(reads + 1, readCount());
+}
+
+TEST_F(ReadCacheTest, insert_evict) {
+    ramcloud->enableReadCache(1000000, 1);
+    ramcloud->write(tableId, "object2", 7, "value2");
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ramcloud->read(tableId, "object2", 7, &value);
+    EXPECT_EQ(1u, ramcloud->readCache->entries.size());
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object2", 7, &value);
+    EXPECT_EQ(reads, readCount());
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+}
+
+}  // namespace RAMCloud
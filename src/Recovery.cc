@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
 #include <cmath>
@@ -20,6 +22,7 @@
 #include "Recovery.h"
 #include "BackupClient.h"
 #include "Buffer.h"
+#include "Cycles.h"
 #include "MasterClient.h"
 #include "ParallelRun.h"
 #include "ShortMacros.h"
@@ -58,6 +61,12 @@ namespace RAMCloud {
  *      an equal segmentId with a lesser epoch is not eligible to be used
  *      for recovery (both for log digest and object data purposes).
  *      Stored in and provided by the coordinator server list.
+ * \param onDemand
+ *      True means the recovery masters serve reads on demand while they
+ *      replay, so clients should be directed to them right away.
+ * \param coldStart
+ *      True means this is one of the recoveries of a whole-cluster restart;
+ *      see MasterRecoveryManager::setClusterRestart.
  */
 Recovery::Recovery(Context* context,
                    TaskQueue& taskQueue,
@@ -65,11 +74,14 @@ Recovery::Recovery(Context* context,
                    RecoveryTracker* tracker,
                    Owner* owner,
                    ServerId crashedServerId,
-                   const ProtoBuf::MasterRecoveryInfo& recoveryInfo)
+                   const ProtoBuf::MasterRecoveryInfo& recoveryInfo,
+                   bool onDemand,
+                   bool coldStart)
     : Task(taskQueue)
     , context(context)
     , crashedServerId(crashedServerId)
     , masterRecoveryInfo(recoveryInfo)
+    , coldStart(coldStart)
     , dataToRecover()
     , tableManager(tableManager)
     , tracker(tracker)
@@ -81,6 +93,10 @@ Recovery::Recovery(Context* context,
     , numPartitions()
     , successfulRecoveryMasters()
     , unsuccessfulRecoveryMasters()
+    , recoveryMastersStartTime()
+    , recoveryMasterCycles()
+    , slowestRecoveryMasterCycles()
+    , onDemand(onDemand)
     , testingBackupStartTaskSendCallback()
     , testingMasterStartTaskSendCallback()
     , testingBackupEndTaskSendCallback()
@@ -288,7 +304,9 @@ struct Partition {
 /**
  * Divides the tablets belonging to a master into partitions, where the number
  * of bytes and number of records in each partition is limited (to ensure fast
- * crash recovery) and there are as few partitions as possible.
+ * crash recovery), there are as few partitions as possible, and the data is
+ * spread as evenly as possible among them (the recovery finishes only when
+ * its slowest recovery master does).
  *
  * Partitions are set by serializing the tablet entry into dataToRecover and
  * setting partitionId in the entry's "user_data".
@@ -324,47 +342,72 @@ Recovery::partitionTablets(vector<Tablet> tablets,
 
     splitTablets(&tablets, estimator);
 
-    // An "open" partition has been partially assigned to but is not full.
-    std::vector<Partition> openPartitions;
-    foreach (Tablet& tablet, tablets) {
-        bool done = false;
-        size_t numOpenPartitions = openPartitions.size();
-        // From a few ramdomly selected open partitions, assign the tablet to
-        // the first open partition that fits.  If none of these partitions fit,
-        // create a new partition.
-        for (size_t i = 0; i < std::min(numOpenPartitions, 5lu); i++) {
-            size_t j = generateRandom() % numOpenPartitions;
-            Partition& partition = openPartitions[j];
-            if (partition.fits(estimator->estimate(&tablet))) {
-                partition.add(estimator->estimate(&tablet));
-                ProtoBuf::Tablets::Tablet& entry =
-                                            *dataToRecover.add_tablet();
-                tablet.serialize(entry);
-                entry.set_user_data(partition.partitionId);
-                // If the partition is mostly full, remove the partition
-                if (partition.usage() > 0.9) {
-                    partition = openPartitions.back();
-                    openPartitions.pop_back();
-                }
-                done = true;
-                break;
-            }
+    // The partitions are packed longest-processing-time first: tablets are
+    // placed in decreasing order of size, each in the least full partition
+    // it fits in, starting with as many partitions as the total size demands.
+    // Compared to filling one partition after another, this spreads the
+    // data evenly so that recovery isn't held up by one straggling recovery
+    // master with a full partition while the others have little to do.
+    uint64_t totalBytes = 0;
+    uint64_t totalRecords = 0;
+    std::vector<std::pair<double, size_t>> order;
+    for (size_t i = 0; i < tablets.size(); ++i) {
+        TableStats::Estimator::Estimate estimate =
+                estimator->estimate(&tablets[i]);
+        totalBytes += estimate.byteCount;
+        totalRecords += estimate.recordCount;
+        Partition single(0);
+        single.add(estimate);
+        order.emplace_back(-single.usage(), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    uint64_t minPartitions = std::max(
+            (totalBytes + PARTITION_MAX_BYTES - 1) / PARTITION_MAX_BYTES,
+            (totalRecords + PARTITION_MAX_RECORDS - 1) / PARTITION_MAX_RECORDS);
+    std::vector<Partition> partitions;
+    for (uint64_t i = 0; i < std::min(minPartitions, uint64_t(tablets.size()));
+            i++) {
+        partitions.emplace_back(i);
+    }
+
+    std::vector<uint64_t> partitionIds(tablets.size());
+    foreach (const auto& entry, order) {
+        TableStats::Estimator::Estimate estimate =
+                estimator->estimate(&tablets[entry.second]);
+        Partition* best = NULL;
+        foreach (Partition& partition, partitions) {
+            if (partition.fits(estimate) &&
+                    (best == NULL || partition.usage() < best->usage()))
+                best = &partition;
         }
-        if (!done) {
-            // This tablet did not fit in any of the open partitions we tried,
-            // so make a new partition.
-            Partition partition(numPartitions++);
-            partition.add(estimator->estimate(&tablet));
-            ProtoBuf::Tablets::Tablet& entry = *dataToRecover.add_tablet();
-            tablet.serialize(entry);
-            entry.set_user_data(partition.partitionId);
-            // If the partition still has room for more tablets, add it to the
-            // available set of partitions.
-            if (partition.usage() <= 0.9) {
-                openPartitions.push_back(partition);
-            }
+        if (best == NULL) {
+            // This tablet did not fit in any of the partitions, so make a
+            // new one.
+            partitions.emplace_back(partitions.size());
+            best = &partitions.back();
         }
+        best->add(estimate);
+        partitionIds[entry.second] = best->partitionId;
+    }
+
+    for (size_t i = 0; i < tablets.size(); ++i) {
+        ProtoBuf::Tablets::Tablet& entry = *dataToRecover.add_tablet();
+        tablets[i].serialize(entry);
+        entry.set_user_data(partitionIds[i]);
     }
+    numPartitions = downCast<uint32_t>(partitions.size());
+
+    double maxUsage = 0;
+    double totalUsage = 0;
+    foreach (Partition& partition, partitions) {
+        maxUsage = std::max(maxUsage, partition.usage());
+        totalUsage += partition.usage();
+    }
+    LOG(NOTICE, "Divided %lu tablets into %u partitions; estimated fullness "
+        "is %.0f%% on average and %.0f%% at most", tablets.size(),
+        numPartitions, numPartitions ? 100 * totalUsage / numPartitions : 0.0,
+        100 * maxUsage);
 }
 
 /**
@@ -479,7 +522,7 @@ BackupStartTask::send()
         backupId.toString().c_str());
     if (!testingCallback) {
         rpc.construct(recovery->context, backupId, recovery->recoveryId,
-                      recovery->crashedServerId);
+                      recovery->crashedServerId, recovery->coldStart);
     } else {
         testingCallback->backupStartTaskSend(result);
     }
@@ -584,7 +627,8 @@ BackupStartTask::wait()
 
 BackupStartPartitionTask::BackupStartPartitionTask(Recovery* recovery,
                                                    ServerId backupServerId)
-        : done()
+        : fragments()
+        , done()
         , rpc()
         , backupServerId(backupServerId)
         , recovery(recovery)
@@ -598,7 +642,8 @@ BackupStartPartitionTask::send()
     LOG(DEBUG, "Sending StartPartitioning: %s",
         backupServerId.toString().c_str());
     rpc.construct(recovery->context, backupServerId, recovery->recoveryId,
-                recovery->crashedServerId, &(recovery->dataToRecover));
+                recovery->crashedServerId, &(recovery->dataToRecover),
+                &fragments);
 }
 
 void
@@ -623,7 +668,8 @@ BackupStartPartitionTask::wait()
 /**
  * Given lists of replicas provided by backups determine whether all
  * the segments in a log digest are claimed to be available on at
- * least one backup.
+ * least one backup, or can be rebuilt from erasure-coded fragments
+ * spread across enough backups.
  *
  * \param tasks
  *      Already run tasks holding the results of startReadingData calls
@@ -636,8 +682,9 @@ BackupStartPartitionTask::wait()
  *      successful and complete.
  *
  * \return
- *      True if at least one replica is available on some backup for
- *      every segment mentioned in the log digest.
+ *      True if at least one replica, or enough distinct fragments to
+ *      rebuild one, is available for every segment mentioned in the log
+ *      digest.
  */
 bool
 verifyLogComplete(Tub<BackupStartTask> tasks[],
@@ -645,9 +692,18 @@ verifyLogComplete(Tub<BackupStartTask> tasks[],
                  const LogDigest& digest)
 {
     std::unordered_set<uint64_t> replicaSet;
+    std::unordered_map<uint64_t, std::set<uint8_t>> fragmentSets;
     for (size_t i = 0; i < taskCount; ++i) {
-        foreach (auto replica, tasks[i]->result.replicas)
-            replicaSet.insert(replica.segmentId);
+        foreach (auto replica, tasks[i]->result.replicas) {
+            if (!replica.dataFragments) {
+                replicaSet.insert(replica.segmentId);
+                continue;
+            }
+            auto& fragmentSet = fragmentSets[replica.segmentId];
+            fragmentSet.insert(replica.fragmentIndex);
+            if (fragmentSet.size() >= replica.dataFragments)
+                replicaSet.insert(replica.segmentId);
+        }
     }
 
     uint32_t missing = 0;
@@ -673,6 +729,54 @@ verifyLogComplete(Tub<BackupStartTask> tasks[],
     return !missing;
 }
 
+/**
+ * Tell each backup holding an erasure-coded fragment where the other
+ * fragments of that segment are, so it can collect enough of them to
+ * rebuild the segment when a recovery master asks for it.
+ *
+ * \param startTasks
+ *      Already run tasks holding the results of startReadingData calls
+ *      to all of the available backups.
+ * \param partitionTasks
+ *      Tasks which will send startPartitioningReplicas to the same backups;
+ *      partitionTasks[i] must be for the backup of startTasks[i]. Their
+ *      #fragments lists are filled in.
+ * \param taskCount
+ *      Number of elements in #startTasks and #partitionTasks.
+ */
+void
+assignFragmentLocations(Tub<BackupStartTask> startTasks[],
+                        Tub<BackupStartPartitionTask> partitionTasks[],
+                        size_t taskCount)
+{
+    typedef StartPartitioningRpc::FragmentLocation FragmentLocation;
+    std::unordered_map<uint64_t, vector<FragmentLocation>> locations;
+    for (size_t i = 0; i < taskCount; ++i) {
+        foreach (const auto& replica, startTasks[i]->result.replicas) {
+            if (!replica.dataFragments)
+                continue;
+            locations[replica.segmentId].emplace_back(
+                replica.segmentId, startTasks[i]->backupId.getId(),
+                replica.fragmentIndex);
+        }
+    }
+    if (locations.empty())
+        return;
+
+    for (size_t i = 0; i < taskCount; ++i) {
+        auto& fragments = partitionTasks[i]->fragments;
+        fragments.clear();
+        foreach (const auto& replica, startTasks[i]->result.replicas) {
+            if (!replica.dataFragments)
+                continue;
+            foreach (const auto& location, locations[replica.segmentId]) {
+                if (location.backupId != startTasks[i]->backupId.getId())
+                    fragments.push_back(location);
+            }
+        }
+    }
+}
+
 /**
  * Extract log digest and table stats from all the startReadingData results.
  * If multiple log digests are found the one from the replica with the
@@ -897,13 +1001,19 @@ Recovery::startBackups()
     }
 
     /* Broadcast 2: partition replicas into tablets for recovery masters */
-    TableStats::Estimator estimator(tableStats);
-    partitionTablets(tablets, &estimator);
-    LOG(NOTICE, "Partition Scheme for Recovery:\n%s",
-                dataToRecover.DebugString().c_str());
-
-    parallelRun(backupPartitionTasks.get(), backups.size(),
-            maxActiveBackupHosts);
+    {
+        CycleCounter<RawMetric>
+            _(&metrics->coordinator.recoveryPartitionTicks);
+        TableStats::Estimator estimator(tableStats);
+        partitionTablets(tablets, &estimator);
+        LOG(NOTICE, "Partition Scheme for Recovery:\n%s",
+                    dataToRecover.DebugString().c_str());
+        assignFragmentLocations(backupStartTasks.get(),
+                                backupPartitionTasks.get(), backups.size());
+
+        parallelRun(backupPartitionTasks.get(), backups.size(),
+                maxActiveBackupHosts);
+    }
 
     replicaMap = buildReplicaMap(backupStartTasks.get(), backups.size(),
                                  tracker, headId);
@@ -963,6 +1073,10 @@ struct MasterStartTask {
         try {
             if (!testingCallback)
                 rpc->wait();
+            if (recovery.onDemand) {
+                recovery.tableManager->setRecoveryMaster(dataToRecover,
+                                                         serverId);
+            }
             done = true;
             return;
         } catch (const ServerNotUpException& e) {
@@ -1009,15 +1123,49 @@ Recovery::startRecoveryMasters()
         "partitions", recoveryId, crashedServerId.toString().c_str(),
         numPartitions);
 
+    recoveryMastersStartTime = Cycles::rdtsc();
+
     // Set up the tasks to execute the RPCs.
     std::vector<ServerId> masters =
         tracker->getServersWithService(WireFormat::MASTER_SERVICE);
     std::random_shuffle(masters.begin(), masters.end(), randomNumberGenerator);
+
+    // If the crashed master was restarted (e.g. for an upgrade), the new
+    // process enlists at the same locator; it goes first so that it gets
+    // back a share of its predecessor's data, rather than the restart
+    // permanently shifting load onto the other masters. Otherwise prefer
+    // the masters that own the fewest tablets, since they are likely to
+    // have the most free memory and the least load (this includes tablets
+    // recently recovered by other recoveries). The shuffle breaks ties.
+    string crashedLocator;
+    try {
+        crashedLocator = tracker->getLocator(crashedServerId);
+    } catch (const Exception& e) {
+        // The crashed server is already gone from the tracker.
+    }
+    std::unordered_map<uint64_t, uint32_t> tabletCounts =
+        tableManager->getTabletCounts();
+    std::vector<std::pair<uint32_t, size_t>> order;
+    for (size_t i = 0; i < masters.size(); ++i) {
+        uint32_t rank = tabletCounts[masters[i].getId()] + 1;
+        if (!crashedLocator.empty() &&
+                tracker->getLocator(masters[i]) == crashedLocator) {
+            LOG(NOTICE, "Server %s is a restart of crashed server %s; "
+                "using it as a recovery master first",
+                masters[i].toString().c_str(),
+                crashedServerId.toString().c_str());
+            rank = 0;
+        }
+        order.emplace_back(rank, i);
+    }
+    std::sort(order.begin(), order.end());
+
     uint32_t started = 0;
     Tub<MasterStartTask> recoverTasks[numPartitions];
-    foreach (ServerId master, masters) {
+    foreach (const auto& candidate, order) {
         if (started == numPartitions)
             break;
+        ServerId master = masters[candidate.second];
         Recovery* preexistingRecovery = (*tracker)[master];
         if (!preexistingRecovery) {
             auto& task = recoverTasks[started];
@@ -1103,8 +1251,18 @@ Recovery::recoveryMasterFinished(ServerId recoveryMasterId,
 
     if (successful) {
         ++successfulRecoveryMasters;
+        uint64_t cycles = Cycles::rdtsc() - recoveryMastersStartTime;
+        recoveryMasterCycles += cycles;
+        slowestRecoveryMasterCycles =
+                std::max(slowestRecoveryMasterCycles, cycles);
+        LOG(NOTICE, "Recovery master %s recovered its partition for crashed "
+            "server %s in %.1f ms", recoveryMasterId.toString().c_str(),
+            crashedServerId.toString().c_str(),
+            Cycles::toSeconds(cycles) * 1e3);
     } else {
         ++unsuccessfulRecoveryMasters;
+        if (onDemand && recoveryMasterId.isValid())
+            tableManager->clearRecoveryMaster(recoveryMasterId);
         if (recoveryMasterId.isValid())
             LOG(NOTICE, "Recovery master %s failed to recover its partition "
                 "for crashed server %s",
@@ -1116,6 +1274,16 @@ Recovery::recoveryMasterFinished(ServerId recoveryMasterId,
         successfulRecoveryMasters + unsuccessfulRecoveryMasters;
     if (completedRecoveryMasters == numPartitions) {
         recoveryTicks.destroy();
+        if (successfulRecoveryMasters > 0) {
+            // If the partitions are well balanced, the slowest recovery
+            // master finishes close to the average.
+            LOG(NOTICE, "Recovery masters for crashed server %s took %.1f ms "
+                "on average and %.1f ms at most",
+                crashedServerId.toString().c_str(),
+                Cycles::toSeconds(recoveryMasterCycles) * 1e3
+                    / successfulRecoveryMasters,
+                Cycles::toSeconds(slowestRecoveryMasterCycles) * 1e3);
+        }
         status = ALL_RECOVERY_MASTERS_FINISHED;
 #if BCAST_INLINE
         broadcastRecoveryComplete();
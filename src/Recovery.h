@@ -86,6 +86,9 @@ class BackupStartPartitionTask {
     void send();
     void wait();
 
+    /// Where the other fragments of each erasure-coded segment this backup
+    /// holds a fragment of are; filled in by assignFragmentLocations().
+    std::vector<StartPartitioningRpc::FragmentLocation> fragments;
 
   PRIVATE:
     bool done;
@@ -99,6 +102,9 @@ class BackupStartPartitionTask {
 bool verifyLogComplete(Tub<BackupStartTask> tasks[],
                        size_t taskCount,
                        const LogDigest& digest);
+void assignFragmentLocations(Tub<BackupStartTask> startTasks[],
+                             Tub<BackupStartPartitionTask> partitionTasks[],
+                             size_t taskCount);
 Tub<std::tuple<uint64_t, LogDigest, TableStats::Digest*>>
 findLogDigest(Tub<BackupStartTask> tasks[], size_t taskCount);
 vector<WireFormat::Recover::Replica> buildReplicaMap(
@@ -145,7 +151,9 @@ class Recovery : public Task {
              RecoveryTracker* tracker,
              Owner* owner,
              ServerId crashedServerId,
-             const ProtoBuf::MasterRecoveryInfo& recoveryInfo);
+             const ProtoBuf::MasterRecoveryInfo& recoveryInfo,
+             bool onDemand = false,
+             bool coldStart = false);
     ~Recovery();
 
     virtual void performTask();
@@ -173,6 +181,15 @@ class Recovery : public Task {
      */
     const ProtoBuf::MasterRecoveryInfo masterRecoveryInfo;
 
+    /**
+     * True means this recovery is one of many started together when the
+     * whole cluster restarts: it is started even if the recovery manager
+     * limits concurrent recoveries, and backups are told to read the
+     * replicas of all of the crashed masters in a single pass over their
+     * storage (see BackupService::loadRestoredReplicas).
+     */
+    const bool coldStart;
+
     /// Defines max number of bytes a tablet partition should accommodate.
     static const uint64_t PARTITION_MAX_BYTES = 500*1024*1024;
     /// Defines the max number of records a tablet partition should accommodate.
@@ -276,6 +293,24 @@ class Recovery : public Task {
      */
     uint32_t unsuccessfulRecoveryMasters;
 
+    /**
+     * Cycles::rdtsc() when startRecoveryMasters started the recovery
+     * masters; used to report how long each of them took.
+     */
+    uint64_t recoveryMastersStartTime;
+
+    /// Total and largest number of cycles the successful recovery masters
+    /// took, measured from #recoveryMastersStartTime.
+    uint64_t recoveryMasterCycles;
+    uint64_t slowestRecoveryMasterCycles;
+
+    /**
+     * True means recovery masters serve reads on demand while they replay
+     * their partitions, so clients are directed to each one as soon as it
+     * has started (see TableManager::setRecoveryMaster).
+     */
+    const bool onDemand;
+
   PUBLIC:
     /**
      * If non-NULL then this callback is invoked instead of
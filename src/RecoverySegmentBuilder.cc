@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <unordered_map>
+
 #include "RecoverySegmentBuilder.h"
 #include "Object.h"
 #include "RpcResult.h"
@@ -51,6 +53,12 @@ namespace RAMCloud {
  *      Array of Segments to which objects will be appended to construct
  *      recovery segments. Guaranteed to have numPartitions elements
  *      (not the same as the number of entries in \a partitions).
+ * \param dedup
+ *      If true, objects and tombstones that are superseded by a newer
+ *      version of the same key within this replica are left out of the
+ *      recovery segments (see findSupersededEntries()). Recovery masters
+ *      would discard them during replay anyway; dropping them here saves
+ *      copying and transferring them.
  * \throw SegmentIteratorException
  *      If the metadata of the replica doesn't match up with the certificate.
  *      Either the replica or the certificate is incorrect, corrupt, or
@@ -63,11 +71,16 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
                               const SegmentCertificate& certificate,
                               int numPartitions,
                               const ProtoBuf::RecoveryPartition& partitions,
-                              Segment* recoverySegments)
+                              Segment* recoverySegments,
+                              bool dedup)
 {
     SegmentIterator it(buffer, length, certificate);
     it.checkMetadataIntegrity();
 
+    std::unordered_set<uint32_t> superseded;
+    if (dedup)
+        findSupersededEntries(buffer, length, certificate, &superseded);
+
     // Buffer must be retained for iteration to provide storage for header.
     Buffer headerBuffer;
     const SegmentHeader* header = NULL;
@@ -84,8 +97,12 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
             && type != LOG_ENTRY_TYPE_RPCRESULT
             && type != LOG_ENTRY_TYPE_PREP
             && type != LOG_ENTRY_TYPE_PREPTOMB
+            && type != LOG_ENTRY_TYPE_PREPTOMBBATCH
             && type != LOG_ENTRY_TYPE_TXDECISION
-            && type != LOG_ENTRY_TYPE_TXPLIST)
+            && type != LOG_ENTRY_TYPE_TXPLIST
+            && type != LOG_ENTRY_TYPE_OBJDELTA)
+            continue;
+        if (!superseded.empty() && superseded.count(it.getOffset()))
             continue;
 
         if (header == NULL) {
@@ -140,35 +157,34 @@ RecoverySegmentBuilder::build(const void* buffer, uint32_t length,
             continue;
         }
 
-        if (type == LOG_ENTRY_TYPE_OBJ) {
-            Object object(entryBuffer);
-            tableId = object.getTableId();
-            keyHash = Key::getHash(tableId,
-                                   object.getKey(), object.getKeyLength());
-        } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
-            ObjectTombstone tomb(entryBuffer);
-            tableId = tomb.getTableId();
-            keyHash = Key::getHash(tableId,
-                                   tomb.getKey(), tomb.getKeyLength());
-        } else if (type == LOG_ENTRY_TYPE_RPCRESULT) {
-            RpcResult rpcResult(entryBuffer);
-            tableId = rpcResult.getTableId();
-            keyHash = rpcResult.getKeyHash();
-        } else if (type == LOG_ENTRY_TYPE_PREP) {
-            PreparedOp op(entryBuffer, 0, entryBuffer.size());
-            tableId = op.object.getTableId();
-            keyHash = Key::getHash(tableId,
-                                   op.object.getKey(),
-                                   op.object.getKeyLength());
-        } else if (type == LOG_ENTRY_TYPE_PREPTOMB) {
-            PreparedOpTombstone opTomb(entryBuffer, 0);
-            tableId = opTomb.header.tableId;
-            keyHash = opTomb.header.keyHash;
-        } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
-            TxDecisionRecord decisionRecord(entryBuffer);
-            tableId = decisionRecord.getTableId();
-            keyHash = decisionRecord.getKeyHash();
-        } else {
+        if (type == LOG_ENTRY_TYPE_PREPTOMBBATCH) {
+            // Copy the batch once to each partition that owns one of its
+            // operations.
+            PreparedOpTombstoneBatch batch(entryBuffer);
+            std::unordered_set<uint64_t> copiedTo;
+            foreach (PreparedOpTombstoneBatch::Record& record,
+                     batch.records) {
+                const auto* partition = whichPartition(record.tableId,
+                                                       record.keyHash,
+                                                       partitions);
+                if (!partition)
+                    continue;
+                uint64_t partitionId = partition->user_data();
+                if (!copiedTo.insert(partitionId).second)
+                    continue;
+                if (!recoverySegments[partitionId].append(type,
+                                                          entryBuffer)) {
+                    LOG(WARNING, "Failure appending to a recovery segment "
+                            "for a replica of <%s,%lu>",
+                            ServerId(header->logId).toString().c_str(),
+                            header->segmentId);
+                    throw SegmentRecoveryFailedException(HERE);
+                }
+            }
+            continue;
+        }
+
+        if (!getEntryKey(type, entryBuffer, &tableId, &keyHash)) {
             LOG(WARNING, "Unknown LogEntry (id=%u)", type);
             throw SegmentRecoveryFailedException(HERE);
         }
@@ -263,8 +279,273 @@ RecoverySegmentBuilder::extractDigest(const void* buffer, uint32_t length,
     return foundDigest;
 }
 
+/**
+ * Summarize which keys a recovery segment holds entries for, so that
+ * a backup can quickly tell recovery masters which segments they needn't
+ * replay before serving a particular key (see
+ * BackupMasterRecovery::findKey()). The summary is a Bloom filter over
+ * key hashes, with about eight bits per entry and two probes per key, so
+ * mayContainKey() gives about 5% false positives and no false negatives.
+ *
+ * \param recoverySegment
+ *      Recovery segment built by build().
+ * \param[out] filter
+ *      Replaced with the filter; never empty.
+ */
+void
+RecoverySegmentBuilder::buildKeyFilter(Segment& recoverySegment,
+                                       std::vector<uint64_t>* filter)
+{
+    std::vector<KeyHash> keyHashes;
+    for (SegmentIterator it(recoverySegment); !it.isDone(); it.next()) {
+        LogEntryType type = it.getType();
+        Buffer entryBuffer;
+        it.appendToBuffer(entryBuffer);
+        uint64_t tableId;
+        KeyHash keyHash;
+        if (type == LOG_ENTRY_TYPE_TXPLIST) {
+            ParticipantList plist(entryBuffer);
+            for (uint32_t i = 0; i < plist.getParticipantCount(); ++i)
+                keyHashes.push_back(plist.participants[i].keyHash);
+        } else if (type == LOG_ENTRY_TYPE_PREPTOMBBATCH) {
+            PreparedOpTombstoneBatch batch(entryBuffer);
+            foreach (PreparedOpTombstoneBatch::Record& record,
+                     batch.records)
+                keyHashes.push_back(record.keyHash);
+        } else if (getEntryKey(type, entryBuffer, &tableId, &keyHash)) {
+            keyHashes.push_back(keyHash);
+        }
+    }
+
+    size_t words = 1;
+    while (words * 64 < keyHashes.size() * 8)
+        words *= 2;
+    filter->assign(words, 0);
+    foreach (KeyHash keyHash, keyHashes) {
+        uint64_t bit0, bit1;
+        getKeyFilterBits(keyHash, words, &bit0, &bit1);
+        (*filter)[bit0 / 64] |= 1lu << (bit0 % 64);
+        (*filter)[bit1 / 64] |= 1lu << (bit1 % 64);
+    }
+}
+
+/**
+ * Check a filter made by buildKeyFilter() for a key.
+ *
+ * \param filter
+ *      Filter made by buildKeyFilter().
+ * \param keyHash
+ *      Hash of the key (see Key::getHash()).
+ * \return
+ *      False if the recovery segment the filter was made from has no
+ *      entries for the key; true if it may have.
+ */
+bool
+RecoverySegmentBuilder::mayContainKey(const std::vector<uint64_t>& filter,
+                                      KeyHash keyHash)
+{
+    uint64_t bit0, bit1;
+    getKeyFilterBits(keyHash, filter.size(), &bit0, &bit1);
+    return (filter[bit0 / 64] & (1lu << (bit0 % 64))) &&
+           (filter[bit1 / 64] & (1lu << (bit1 % 64)));
+}
+
 // - private -
 
+/**
+ * Find the table and key hash of a log entry that refers to a single key.
+ *
+ * \param type
+ *      Type of the entry.
+ * \param entryBuffer
+ *      Contents of the entry.
+ * \param[out] tableId
+ *      Set to the table the entry belongs to.
+ * \param[out] keyHash
+ *      Set to the hash of the key the entry is for.
+ * \return
+ *      False if entries of this type don't refer to a single key, in
+ *      which case the outputs are left unchanged.
+ */
+bool
+RecoverySegmentBuilder::getEntryKey(LogEntryType type, Buffer& entryBuffer,
+                                    uint64_t* tableId, KeyHash* keyHash)
+{
+    if (type == LOG_ENTRY_TYPE_OBJ) {
+        Object object(entryBuffer);
+        *tableId = object.getTableId();
+        *keyHash = Key::getHash(*tableId,
+                                object.getKey(), object.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
+        ObjectTombstone tomb(entryBuffer);
+        *tableId = tomb.getTableId();
+        *keyHash = Key::getHash(*tableId,
+                                tomb.getKey(), tomb.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_OBJDELTA) {
+        ObjectDelta delta(entryBuffer);
+        *tableId = delta.getTableId();
+        *keyHash = Key::getHash(*tableId,
+                                delta.getKey(), delta.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_RPCRESULT) {
+        RpcResult rpcResult(entryBuffer);
+        *tableId = rpcResult.getTableId();
+        *keyHash = rpcResult.getKeyHash();
+    } else if (type == LOG_ENTRY_TYPE_PREP) {
+        PreparedOp op(entryBuffer, 0, entryBuffer.size());
+        *tableId = op.object.getTableId();
+        *keyHash = Key::getHash(*tableId,
+                                op.object.getKey(),
+                                op.object.getKeyLength());
+    } else if (type == LOG_ENTRY_TYPE_PREPTOMB) {
+        PreparedOpTombstone opTomb(entryBuffer, 0);
+        *tableId = opTomb.header.tableId;
+        *keyHash = opTomb.header.keyHash;
+    } else if (type == LOG_ENTRY_TYPE_TXDECISION) {
+        TxDecisionRecord decisionRecord(entryBuffer);
+        *tableId = decisionRecord.getTableId();
+        *keyHash = decisionRecord.getKeyHash();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Pick the two bits of a key filter that represent a key.
+ *
+ * \param keyHash
+ *      Hash of the key.
+ * \param words
+ *      Size of the filter in 64-bit words; a power of two.
+ * \param[out] bit0
+ *      Set to the first bit.
+ * \param[out] bit1
+ *      Set to the second bit.
+ */
+void
+RecoverySegmentBuilder::getKeyFilterBits(KeyHash keyHash, size_t words,
+                                         uint64_t* bit0, uint64_t* bit1)
+{
+    uint64_t mask = words * 64 - 1;
+    *bit0 = keyHash & mask;
+    *bit1 = ((keyHash >> 32) ^ (keyHash * 0x9e3779b97f4a7c15lu)) & mask;
+}
+
+/**
+ * Find the objects and tombstones in a replica that are superseded by a
+ * newer object or tombstone for the same key in the same replica. Only the
+ * newest version of each key needs to be recovered: replay on the recovery
+ * master keeps the highest version it sees, and a newer object or tombstone
+ * filters older objects from other replicas just as well as an older
+ * tombstone would. Versions are compared rather than positions, since
+ * survivor segments written by the cleaner needn't keep entries in the
+ * order they were written. A tombstone wins a tie with the object it
+ * deletes.
+ *
+ * Keys with an object delta or a prepared operation in the replica are
+ * left alone, since those entries refer to a particular older version.
+ *
+ * \param buffer
+ *      Contiguous region of \a length bytes that contains the replica contents.
+ * \param length
+ *      Bytes which contain replica data starting at \a buffer.
+ * \param certificate
+ *      Certificate to use to iterate the replica at \a buffer; its integrity
+ *      must already have been checked.
+ * \param[out] superseded
+ *      The offsets within the replica of the entries that can be left out
+ *      of recovery segments are added to this set.
+ */
+void
+RecoverySegmentBuilder::findSupersededEntries(const void* buffer,
+                                  uint32_t length,
+                                  const SegmentCertificate& certificate,
+                                  std::unordered_set<uint32_t>* superseded)
+{
+    struct Newest {
+        Newest()
+            : version(0), tombstone(false), offset(-1), pinned(false)
+            , older()
+        {}
+        uint64_t version;
+        bool tombstone;
+        uint32_t offset;
+        bool pinned;
+        /// Offsets of the entries known to be older than this one.
+        std::vector<uint32_t> older;
+    };
+    // Keyed by the table id followed by the key bytes.
+    std::unordered_map<string, Newest> newest;
+
+    for (SegmentIterator it(buffer, length, certificate);
+         !it.isDone(); it.next()) {
+        LogEntryType type = it.getType();
+        if (type != LOG_ENTRY_TYPE_OBJ && type != LOG_ENTRY_TYPE_OBJTOMB &&
+            type != LOG_ENTRY_TYPE_OBJDELTA && type != LOG_ENTRY_TYPE_PREP)
+            continue;
+
+        Buffer entryBuffer;
+        it.appendToBuffer(entryBuffer);
+        uint64_t tableId;
+        const void* key;
+        uint32_t keyLength;
+        uint64_t version = 0;
+        if (type == LOG_ENTRY_TYPE_OBJ) {
+            Object object(entryBuffer);
+            tableId = object.getTableId();
+            key = object.getKey();
+            keyLength = object.getKeyLength();
+            version = object.getVersion();
+        } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
+            ObjectTombstone tomb(entryBuffer);
+            tableId = tomb.getTableId();
+            key = tomb.getKey();
+            keyLength = tomb.getKeyLength();
+            version = tomb.getObjectVersion();
+        } else if (type == LOG_ENTRY_TYPE_OBJDELTA) {
+            ObjectDelta delta(entryBuffer);
+            tableId = delta.getTableId();
+            key = delta.getKey();
+            keyLength = delta.getKeyLength();
+        } else {
+            PreparedOp op(entryBuffer, 0, entryBuffer.size());
+            tableId = op.object.getTableId();
+            key = op.object.getKey();
+            keyLength = op.object.getKeyLength();
+        }
+
+        string keyString(reinterpret_cast<const char*>(&tableId),
+                         sizeof(tableId));
+        keyString.append(static_cast<const char*>(key), keyLength);
+        Newest& entry = newest[keyString];
+        if (type == LOG_ENTRY_TYPE_OBJDELTA || type == LOG_ENTRY_TYPE_PREP) {
+            entry.pinned = true;
+            continue;
+        }
+
+        bool tombstone = (type == LOG_ENTRY_TYPE_OBJTOMB);
+        if (entry.offset == static_cast<uint32_t>(-1)) {
+            // First version seen for this key.
+        } else if (version > entry.version ||
+                   (version == entry.version && tombstone &&
+                    !entry.tombstone)) {
+            entry.older.push_back(entry.offset);
+        } else {
+            entry.older.push_back(it.getOffset());
+            continue;
+        }
+        entry.version = version;
+        entry.tombstone = tombstone;
+        entry.offset = it.getOffset();
+    }
+
+    for (auto& keyAndEntry : newest) {
+        const Newest& entry = keyAndEntry.second;
+        if (!entry.pinned)
+            superseded->insert(entry.older.begin(), entry.older.end());
+    }
+}
+
 /**
  * Returns true if the entry is alive and should be recovered, otherwise
  * false if it should be ignored.
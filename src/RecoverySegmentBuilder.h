@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <unordered_set>
+
 #include "Common.h"
 #include "Buffer.h"
 #include "Key.h"
@@ -45,11 +47,23 @@ class RecoverySegmentBuilder {
                       const SegmentCertificate& certificate,
                       int numPartitions,
                       const ProtoBuf::RecoveryPartition& partitions,
-                      Segment* recoverySegments);
+                      Segment* recoverySegments,
+                      bool dedup);
     static bool extractDigest(const void* buffer, uint32_t length,
                               const SegmentCertificate& certificate,
                               Buffer* digestBuffer, Buffer* tableStatsBuffer);
+    static void buildKeyFilter(Segment& recoverySegment,
+                               std::vector<uint64_t>* filter);
+    static bool mayContainKey(const std::vector<uint64_t>& filter,
+                              KeyHash keyHash);
   PRIVATE:
+    static void findSupersededEntries(const void* buffer, uint32_t length,
+                                  const SegmentCertificate& certificate,
+                                  std::unordered_set<uint32_t>* superseded);
+    static bool getEntryKey(LogEntryType type, Buffer& entryBuffer,
+                            uint64_t* tableId, KeyHash* keyHash);
+    static void getKeyFilterBits(KeyHash keyHash, size_t words,
+                                 uint64_t* bit0, uint64_t* bit1);
     static bool isEntryAlive(const LogPosition& position,
                              const ProtoBuf::Tablets::Tablet* tablet);
     static const ProtoBuf::Tablets::Tablet*
@@ -64,6 +64,55 @@ struct RecoverySegmentBuilderTest : public ::testing::Test {
         }
     }
 
+    /**
+     * Append an object with the given key and version in table 1 to
+     * \a segment, along with a tombstone for it if \a tombstone is set.
+     */
+    void
+    appendObject(LogSegment* segment, const char* key, uint64_t version,
+                 bool tombstone = false)
+    {
+        Key k(1, key, downCast<uint16_t>(strlen(key)));
+        Buffer dataBuffer;
+        Object object(k, "value", 6, version, 0, dataBuffer);
+        Buffer buffer;
+        if (tombstone) {
+            ObjectTombstone tomb(object, 0, 0);
+            tomb.assembleForLog(buffer);
+            ASSERT_TRUE(segment->append(LOG_ENTRY_TYPE_OBJTOMB, buffer));
+        } else {
+            object.assembleForLog(buffer);
+            ASSERT_TRUE(segment->append(LOG_ENTRY_TYPE_OBJ, buffer));
+        }
+    }
+
+    /**
+     * Describe the objects, tombstones and prepared operations in
+     * \a segment by their versions.
+     */
+    string
+    versions(Segment* segment)
+    {
+        string result;
+        for (SegmentIterator it(*segment); !it.isDone(); it.next()) {
+            Buffer buffer;
+            it.appendToBuffer(buffer);
+            string entry;
+            if (it.getType() == LOG_ENTRY_TYPE_OBJ) {
+                entry = format("object %lu", Object(buffer).getVersion());
+            } else if (it.getType() == LOG_ENTRY_TYPE_OBJTOMB) {
+                entry = format("tombstone %lu",
+                               ObjectTombstone(buffer).getObjectVersion());
+            } else if (it.getType() == LOG_ENTRY_TYPE_PREP) {
+                entry = "preparedOp";
+            } else {
+                continue;
+            }
+            result += (result.empty() ? "" : " | ") + entry;
+        }
+        return result;
+    }
+
     DISALLOW_COPY_AND_ASSIGN(RecoverySegmentBuilderTest);
 };
 
@@ -238,7 +287,8 @@ TEST_F(RecoverySegmentBuilderTest, build) {
 
     std::unique_ptr<Segment[]> recoverySegments(new Segment[2]);
     TestLog::Enable _;
-    build(buf, length, certificate, 2, partitions, recoverySegments.get());
+    build(buf, length, certificate, 2, partitions, recoverySegments.get(),
+          false);
     EXPECT_TRUE(StringUtil::contains(TestLog::get(),
         "Couldn't place object"));
     EXPECT_TRUE(StringUtil::contains(TestLog::get(),
@@ -270,7 +320,8 @@ TEST_F(RecoverySegmentBuilderTest, build) {
 
     certificate.checksum = 0;
     EXPECT_THROW(
-        build(buf, length, certificate, 2, partitions, recoverySegments.get()),
+        build(buf, length, certificate, 2, partitions, recoverySegments.get(),
+              false),
         SegmentIteratorException);
 }
 
@@ -290,7 +341,8 @@ TEST_F(RecoverySegmentBuilderTest, build_safeVersionEntries) {
     ASSERT_TRUE(segment->copyOut(0, buf, length));
 
     std::unique_ptr<Segment[]> recoverySegments(new Segment[3]);
-    build(buf, length, certificate, 3, partitions, recoverySegments.get());
+    build(buf, length, certificate, 3, partitions, recoverySegments.get(),
+          false);
 
     EXPECT_EQ("safeVersion at offset 0, length 12 with version 1 | "
             "safeVersion at offset 14, length 12 with version 99",
@@ -303,6 +355,51 @@ TEST_F(RecoverySegmentBuilderTest, build_safeVersionEntries) {
             ObjectManager::dumpSegment(&recoverySegments[2]));
 }
 
+TEST_F(RecoverySegmentBuilderTest, build_dedup) {
+    auto build = RecoverySegmentBuilder::build;
+    LogSegment* segment = segmentManager.allocHeadSegment();
+
+    // Key '2' (partition 0): only the newest version is kept, whatever
+    // the order of the entries, and a tombstone wins over its object.
+    appendObject(segment, "2", 1);
+    appendObject(segment, "2", 3, true);
+    appendObject(segment, "2", 3);
+    appendObject(segment, "2", 2);
+    appendObject(segment, "2", 1, true);
+
+    // Key '1' (partition 1): a prepared operation keeps all versions.
+    appendObject(segment, "1", 1);
+    appendObject(segment, "1", 2);
+    {
+        Key key(1, "1", 1);
+        Buffer dataBuffer;
+        PreparedOp op(WireFormat::TxPrepare::WRITE,
+                      1UL, 10UL, 10UL,
+                      key, "hello", 6, 0, 0, dataBuffer);
+        Buffer buffer;
+        op.assembleForLog(buffer);
+        ASSERT_TRUE(segment->append(LOG_ENTRY_TYPE_PREP, buffer));
+    }
+
+    SegmentCertificate certificate;
+    uint32_t length = segment->getAppendedLength(&certificate);
+    char buf[serverConfig.segmentSize];
+    ASSERT_TRUE(segment->copyOut(0, buf, length));
+
+    std::unique_ptr<Segment[]> recoverySegments(new Segment[2]);
+    build(buf, length, certificate, 2, partitions, recoverySegments.get(),
+          false);
+    EXPECT_EQ("object 1 | tombstone 3 | object 3 | object 2 | tombstone 1",
+              versions(&recoverySegments[0]));
+
+    recoverySegments.reset(new Segment[2]);
+    build(buf, length, certificate, 2, partitions, recoverySegments.get(),
+          true);
+    EXPECT_EQ("tombstone 3", versions(&recoverySegments[0]));
+    EXPECT_EQ("object 1 | object 2 | preparedOp",
+              versions(&recoverySegments[1]));
+}
+
 TEST_F(RecoverySegmentBuilderTest, build_participantList) {
     auto build = RecoverySegmentBuilder::build;
 
@@ -323,7 +420,8 @@ TEST_F(RecoverySegmentBuilderTest, build_participantList) {
     ASSERT_TRUE(segment->copyOut(0, buf, length));
 
     std::unique_ptr<Segment[]> recoverySegments(new Segment[2]);
-    build(buf, length, certificate, 2, partitions, recoverySegments.get());
+    build(buf, length, certificate, 2, partitions, recoverySegments.get(),
+          false);
 
     EXPECT_EQ("safeVersion at offset 0, length 12 with version 1 | "
             "participantList at offset 14, length 96 with "
@@ -333,6 +431,43 @@ TEST_F(RecoverySegmentBuilderTest, build_participantList) {
             ObjectManager::dumpSegment(&recoverySegments[1]));
 }
 
+TEST_F(RecoverySegmentBuilderTest, buildKeyFilter) {
+    LogSegment* segment = segmentManager.allocHeadSegment();
+    appendObject(segment, "2", 1);
+    appendObject(segment, "2", 2, true);
+    appendObject(segment, "3", 1);
+
+    Segment empty;
+    std::vector<uint64_t> filter;
+    RecoverySegmentBuilder::buildKeyFilter(empty, &filter);
+    EXPECT_EQ(1u, filter.size());
+    EXPECT_FALSE(RecoverySegmentBuilder::mayContainKey(filter,
+            Key(1, "2", 1).getHash()));
+
+    RecoverySegmentBuilder::buildKeyFilter(*segment, &filter);
+    EXPECT_EQ(1u, filter.size());
+    EXPECT_TRUE(RecoverySegmentBuilder::mayContainKey(filter,
+            Key(1, "2", 1).getHash()));
+    EXPECT_TRUE(RecoverySegmentBuilder::mayContainKey(filter,
+            Key(1, "3", 1).getHash()));
+    int falsePositives = 0;
+    for (int i = 100; i < 200; i++) {
+        string key = format("%d", i);
+        if (RecoverySegmentBuilder::mayContainKey(filter,
+                Key(1, key.c_str(), downCast<uint16_t>(key.size()))
+                    .getHash())) {
+            falsePositives++;
+        }
+    }
+    EXPECT_GT(10, falsePositives);
+
+    // The filter grows to keep at least 8 bits per entry.
+    for (int i = 0; i < 20; i++)
+        appendObject(segment, "4", i);
+    RecoverySegmentBuilder::buildKeyFilter(*segment, &filter);
+    EXPECT_EQ(4u, filter.size());
+}
+
 TEST_F(RecoverySegmentBuilderTest, extractDigest) {
     auto extractDigest = RecoverySegmentBuilder::extractDigest;
     LogSegment* segment = segmentManager.allocHeadSegment();
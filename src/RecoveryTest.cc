@@ -670,6 +670,53 @@ TEST_F(RecoveryTest, partitionTablets_all_partitions_open) {
     EXPECT_EQ(20lu, recovery->numPartitions);
 }
 
+TEST_F(RecoveryTest, partitionTablets_balanced) {
+    // Four large tablets and two small ones fit in two partitions; the
+    // large ones must be spread out first so that each partition ends up
+    // with two large tablets and a small one.
+    Lock lock(mutex);     // To trick TableManager internal calls.
+    Tub<Recovery> recovery;
+    Recovery::Owner* own = static_cast<Recovery::Owner*>(NULL);
+    for (uint64_t i = 1; i <= 6; i++) {
+        tableManager.testCreateTable(TestUtil::toString(i).c_str(), i);
+        tableManager.testAddTablet(
+            {i,  0,  9, {99, 0}, Tablet::RECOVERING, {}});
+    }
+    recovery.construct(&context, taskQueue, &tableManager, &tracker, own,
+                       ServerId(99), recoveryInfo);
+    auto tablets = tableManager.markAllTabletsRecovering(ServerId(99));
+
+    char buffer[sizeof(TableStats::DigestHeader) +
+                6 * sizeof(TableStats::DigestEntry)];
+    TableStats::Digest* digest = reinterpret_cast<TableStats::Digest*>(buffer);
+    digest->header.entryCount = 6;
+    digest->header.otherBytesPerKeyHash = 0;
+    digest->header.otherRecordsPerKeyHash = 0;
+    for (uint64_t i = 0; i < 6; i++) {
+        double fraction = (i < 2) ? 0.01 : 0.04;
+        digest->entries[i].tableId = i + 1;
+        digest->entries[i].bytesPerKeyHash =
+                fraction * Recovery::PARTITION_MAX_BYTES;
+        digest->entries[i].recordsPerKeyHash =
+                fraction * Recovery::PARTITION_MAX_RECORDS;
+    }
+    TableStats::Estimator e(digest);
+
+    recovery->partitionTablets(tablets, &e);
+    EXPECT_EQ(2lu, recovery->numPartitions);
+    uint32_t tablets0 = 0;
+    uint32_t smallTablets0 = 0;
+    foreach (const auto& tablet, recovery->dataToRecover.tablet()) {
+        if (tablet.user_data() == 0) {
+            tablets0++;
+            if (tablet.table_id() <= 2)
+                smallTablets0++;
+        }
+    }
+    EXPECT_EQ(3u, tablets0);
+    EXPECT_EQ(1u, smallTablets0);
+}
+
 /**
  * Used to sort tablets first by their tableId then start keyhash.
  *
@@ -932,6 +979,50 @@ TEST_F(RecoveryTest, verifyLogComplete) {
     EXPECT_TRUE(verifyLogComplete(tasks, 1, digest));
 }
 
+TEST_F(RecoveryTest, verifyLogComplete_fragments) {
+    LogDigest digest;
+    digest.addSegmentId(10);
+
+    Tub<BackupStartTask> tasks[2];
+    Recovery recovery(&context, taskQueue, &tableManager, &tracker, NULL,
+            {1, 0}, recoveryInfo);
+    tasks[0].construct(&recovery, ServerId(2, 0));
+    tasks[1].construct(&recovery, ServerId(3, 0));
+
+    TestLog::Enable _;
+    // Two copies of the same fragment aren't enough to rebuild from.
+    tasks[0]->result.replicas = {{10, 0, true, 1, 2}};
+    tasks[1]->result.replicas = {{10, 0, true, 1, 2}};
+    EXPECT_FALSE(verifyLogComplete(tasks, 2, digest));
+    tasks[1]->result.replicas = {{10, 0, true, 2, 2}};
+    EXPECT_TRUE(verifyLogComplete(tasks, 2, digest));
+}
+
+TEST_F(RecoveryTest, assignFragmentLocations) {
+    Tub<BackupStartTask> startTasks[3];
+    Tub<BackupStartPartitionTask> partitionTasks[3];
+    Recovery recovery(&context, taskQueue, &tableManager, &tracker, NULL,
+            {1, 0}, recoveryInfo);
+    for (uint32_t i = 0; i < 3; ++i) {
+        startTasks[i].construct(&recovery, ServerId(i + 2, 0));
+        partitionTasks[i].construct(&recovery, ServerId(i + 2, 0));
+    }
+    startTasks[0]->result.replicas = {{10, 0, true, 0, 2}, {11, 0, true}};
+    startTasks[1]->result.replicas = {{10, 0, true, 1, 2}, {11, 0, true}};
+    startTasks[2]->result.replicas = {{10, 0, true, 2, 2}, {12, 0, true}};
+
+    assignFragmentLocations(startTasks, partitionTasks, 3);
+    auto& fragments = partitionTasks[0]->fragments;
+    ASSERT_EQ(2u, fragments.size());
+    EXPECT_EQ(10u, fragments[0].segmentId);
+    EXPECT_EQ(ServerId(3, 0).getId(), fragments[0].backupId);
+    EXPECT_EQ(1u, fragments[0].fragmentIndex);
+    EXPECT_EQ(ServerId(4, 0).getId(), fragments[1].backupId);
+    EXPECT_EQ(2u, fragments[1].fragmentIndex);
+    EXPECT_EQ(2u, partitionTasks[1]->fragments.size());
+    EXPECT_EQ(2u, partitionTasks[2]->fragments.size());
+}
+
 TEST_F(RecoveryTest, findLogDigest) {
     recoveryInfo.set_min_open_segment_id(10);
     recoveryInfo.set_min_open_segment_epoch(1);
@@ -1159,6 +1250,73 @@ TEST_F(RecoveryTest, startRecoveryMasters_tooFewIdleMasters) {
     EXPECT_FALSE(recovery.wasCompletelySuccessful());
 }
 
+TEST_F(RecoveryTest, startRecoveryMasters_prefersLeastLoadedMasters) {
+    struct Cb : public MasterStartTaskTestingCallback {
+        void masterStartTaskSend(uint64_t recoveryId,
+            ServerId crashedServerId, uint32_t partitionId,
+            const ProtoBuf::RecoveryPartition& recoveryPartition,
+            const WireFormat::Recover::Replica replicaMap[],
+            size_t replicaMapSize)
+        {}
+    } callback;
+    Lock lock(mutex);     // To trick TableManager internal calls.
+    addServersToTracker(3, {WireFormat::MASTER_SERVICE});
+    tableManager.testCreateTable("t", 123);
+    tableManager.testAddTablet({123,  0,  9, {99, 0}, Tablet::RECOVERING, {}});
+    tableManager.testCreateTable("u", 124);
+    tableManager.testAddTablet({124,  0,  9, {1, 0}, Tablet::NORMAL, {}});
+    tableManager.testAddTablet({124, 10, 19, {2, 0}, Tablet::NORMAL, {}});
+    tableManager.testAddTablet({124, 20, 29, {2, 0}, Tablet::NORMAL, {}});
+    Recovery recovery(&context, taskQueue, &tableManager, &tracker, NULL,
+                      {99, 0}, recoveryInfo);
+    recovery.partitionTablets(
+                tableManager.markAllTabletsRecovering({99, 0}), NULL);
+    recovery.testingMasterStartTaskSendCallback = &callback;
+    recovery.startRecoveryMasters();
+
+    // Server 3 owns no tablets, so it recovers the only partition.
+    EXPECT_EQ(1u, recovery.numPartitions);
+    EXPECT_TRUE(tracker[ServerId(1, 0)] == NULL);
+    EXPECT_TRUE(tracker[ServerId(2, 0)] == NULL);
+    EXPECT_EQ(&recovery, tracker[ServerId(3, 0)]);
+}
+
+TEST_F(RecoveryTest, startRecoveryMasters_prefersRestartedMaster) {
+    struct Cb : public MasterStartTaskTestingCallback {
+        void masterStartTaskSend(uint64_t recoveryId,
+            ServerId crashedServerId, uint32_t partitionId,
+            const ProtoBuf::RecoveryPartition& recoveryPartition,
+            const WireFormat::Recover::Replica replicaMap[],
+            size_t replicaMapSize)
+        {}
+    } callback;
+    Lock lock(mutex);     // To trick TableManager internal calls.
+    addServersToTracker(3, {WireFormat::MASTER_SERVICE});
+    // Server 99 crashed and was restarted as server 2.
+    tracker.enqueueChange({{99, 0}, "mock:host=server2",
+                           {WireFormat::MASTER_SERVICE}, 100,
+                           ServerStatus::CRASHED}, SERVER_ADDED);
+    ServerDetails details;
+    ServerChangeEvent event;
+    while (tracker.getChange(details, event));
+    tableManager.testCreateTable("t", 123);
+    tableManager.testAddTablet({123,  0,  9, {99, 0}, Tablet::RECOVERING, {}});
+    tableManager.testCreateTable("u", 124);
+    tableManager.testAddTablet({124,  0,  9, {2, 0}, Tablet::NORMAL, {}});
+    Recovery recovery(&context, taskQueue, &tableManager, &tracker, NULL,
+                      {99, 0}, recoveryInfo);
+    recovery.partitionTablets(
+                tableManager.markAllTabletsRecovering({99, 0}), NULL);
+    recovery.testingMasterStartTaskSendCallback = &callback;
+    TestLog::Enable _;
+    recovery.startRecoveryMasters();
+
+    EXPECT_EQ(1u, recovery.numPartitions);
+    EXPECT_EQ(&recovery, tracker[ServerId(2, 0)]);
+    EXPECT_TRUE(TestUtil::contains(TestLog::get(),
+            "Server 2.0 is a restart of crashed server 99.0"));
+}
+
 /**
  * Slightly different than the tooFewIdleMasters case above: because
  * no recovery master get started we need to make sure recovery doesn't
@@ -0,0 +1,404 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#if __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "ReedSolomon.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+namespace {
+
+/**
+ * Log and antilog tables for GF(2^8) with the primitive polynomial
+ * x^8 + x^4 + x^3 + x^2 + 1 (0x11d). The antilog table is doubled so that
+ * multiply() can index it with the sum of two logs without a modulo.
+ */
+struct GaloisTables {
+    GaloisTables()
+        : exp()
+        , log()
+    {
+        uint32_t x = 1;
+        for (uint32_t i = 0; i < 255; i++) {
+            exp[i] = downCast<uint8_t>(x);
+            exp[i + 255] = downCast<uint8_t>(x);
+            log[x] = downCast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100)
+                x ^= 0x11d;
+        }
+        exp[510] = exp[0];
+        exp[511] = exp[1];
+    }
+
+    uint8_t exp[512];
+    uint8_t log[256];
+};
+
+const GaloisTables&
+tables()
+{
+    static GaloisTables galoisTables;
+    return galoisTables;
+}
+
+/**
+ * Fragments are encoded in pieces of this many bytes, so that the slice of
+ * each output fragment being accumulated stays in the L1 cache while every
+ * input fragment is folded into it.
+ */
+const size_t ENCODE_CHUNK_BYTES = 4096;
+
+} // anonymous namespace
+
+/**
+ * Construct a code with the given geometry.
+ *
+ * \param dataFragments
+ *      Number of data fragments (k) each buffer is split into; must be at
+ *      least 1.
+ * \param parityFragments
+ *      Number of parity fragments (m) computed from the data fragments.
+ *      Up to m fragments may be lost and still be reconstructed.
+ * \throw FatalError
+ *      k is 0 or k + m exceeds the 256 elements of GF(2^8).
+ */
+ReedSolomon::ReedSolomon(uint32_t dataFragments, uint32_t parityFragments)
+    : dataFragments(dataFragments)
+    , parityFragments(parityFragments)
+    , generator()
+{
+    if (dataFragments == 0 || dataFragments + parityFragments > 256) {
+        throw FatalError(HERE, format("invalid Reed-Solomon geometry %u+%u",
+                                      dataFragments, parityFragments));
+    }
+
+    const uint32_t k = dataFragments;
+    generator.resize((k + parityFragments) * k, 0);
+    for (uint32_t i = 0; i < k; i++)
+        generator[i * k + i] = 1;
+
+    // Cauchy rows: element (i, j) is 1 / (x_i + y_j) with x_i = k + i and
+    // y_j = j, which are all distinct so the sum is never zero.
+    for (uint32_t i = 0; i < parityFragments; i++) {
+        for (uint32_t j = 0; j < k; j++) {
+            uint8_t sum = downCast<uint8_t>((k + i) ^ j);
+            generator[(k + i) * k + j] = inverse(sum);
+        }
+    }
+}
+
+/**
+ * Compute the parity fragments for a set of data fragments.
+ *
+ * \param data
+ *      Array of getDataFragments() pointers to the data fragments, each
+ *      \a length bytes long.
+ * \param parity
+ *      Array of getParityFragments() pointers to buffers of \a length bytes
+ *      that are overwritten with the parity fragments.
+ * \param length
+ *      Size of each fragment in bytes.
+ */
+void
+ReedSolomon::encode(const void* const data[], void* const parity[],
+                    size_t length) const
+{
+    const uint32_t k = dataFragments;
+    for (size_t offset = 0; offset < length; offset += ENCODE_CHUNK_BYTES) {
+        size_t bytes = std::min(ENCODE_CHUNK_BYTES, length - offset);
+        for (uint32_t p = 0; p < parityFragments; p++) {
+            uint8_t* out = static_cast<uint8_t*>(parity[p]) + offset;
+            memset(out, 0, bytes);
+            for (uint32_t j = 0; j < k; j++) {
+                const uint8_t* in =
+                    static_cast<const uint8_t*>(data[j]) + offset;
+                multiplyAdd(generator[(k + p) * k + j], in, out, bytes);
+            }
+        }
+    }
+}
+
+/**
+ * Compute a single fragment of a buffer: the buffer is split into k
+ * zero-padded pieces of getFragmentLength(\a bufferLength) bytes, as
+ * encode() expects them, and fragment \a index of the result is produced.
+ * Lets a holder of the whole buffer produce any one fragment without
+ * building the others.
+ *
+ * \param buffer
+ *      The buffer to encode.
+ * \param bufferLength
+ *      Bytes in \a buffer; nothing past them is read.
+ * \param index
+ *      Which fragment to compute: less than getDataFragments() for a piece
+ *      of the buffer itself, otherwise a parity fragment.
+ * \param[out] fragment
+ *      Overwritten with the getFragmentLength(\a bufferLength) bytes of
+ *      the fragment.
+ */
+void
+ReedSolomon::encodeFragment(const void* buffer, uint32_t bufferLength,
+                            uint32_t index, void* fragment) const
+{
+    const uint32_t k = dataFragments;
+    const uint32_t length = getFragmentLength(bufferLength);
+    const uint8_t* source = static_cast<const uint8_t*>(buffer);
+
+    // Pieces that run past the end of the buffer are padded in a copy.
+    std::unique_ptr<uint8_t[]> padded;
+    std::vector<const void*> data(k);
+    for (uint32_t j = 0; j < k; j++) {
+        uint32_t start = j * length;
+        if (start + length <= bufferLength) {
+            data[j] = source + start;
+            continue;
+        }
+        if (!padded)
+            padded.reset(new uint8_t[k * length]);
+        uint8_t* piece = padded.get() + j * length;
+        uint32_t bytes = start < bufferLength ? bufferLength - start : 0;
+        memcpy(piece, source + start, bytes);
+        memset(piece + bytes, 0, length - bytes);
+        data[j] = piece;
+    }
+
+    if (index < k) {
+        memcpy(fragment, data[index], length);
+        return;
+    }
+    uint8_t* out = static_cast<uint8_t*>(fragment);
+    memset(out, 0, length);
+    for (uint32_t j = 0; j < k; j++) {
+        multiplyAdd(generator[index * k + j],
+                    static_cast<const uint8_t*>(data[j]), out, length);
+    }
+}
+
+/**
+ * Rebuild any missing fragments from the ones that survive.
+ *
+ * \param fragments
+ *      Array of getDataFragments() + getParityFragments() pointers, data
+ *      fragments first. Every entry must point to a buffer of \a length
+ *      bytes; the buffers of missing fragments are overwritten with their
+ *      reconstructed contents.
+ * \param present
+ *      Parallel to \a fragments; true for each fragment whose buffer holds
+ *      valid contents.
+ * \param length
+ *      Size of each fragment in bytes.
+ * \return
+ *      True if every fragment was reconstructed, false if fewer than
+ *      getDataFragments() fragments were present (in which case no buffer
+ *      is modified).
+ */
+bool
+ReedSolomon::reconstruct(void* const fragments[], const bool present[],
+                         size_t length) const
+{
+    const uint32_t k = dataFragments;
+    const uint32_t n = dataFragments + parityFragments;
+
+    std::vector<uint32_t> sources;
+    for (uint32_t i = 0; i < n && sources.size() < k; i++) {
+        if (present[i])
+            sources.push_back(i);
+    }
+    if (sources.size() < k)
+        return false;
+
+    // If some data fragment is missing, solve for the data using the rows of
+    // the generator that produced the chosen surviving fragments.
+    if (sources.back() >= k) {
+        std::vector<uint8_t> decode(k * k);
+        for (uint32_t r = 0; r < k; r++) {
+            memcpy(&decode[r * k], &generator[sources[r] * k], k);
+        }
+        if (!invert(decode, k))
+            DIE("Reed-Solomon decoding matrix is singular");
+
+        for (uint32_t j = 0; j < k; j++) {
+            if (present[j])
+                continue;
+            uint8_t* out = static_cast<uint8_t*>(fragments[j]);
+            memset(out, 0, length);
+            for (uint32_t r = 0; r < k; r++) {
+                multiplyAdd(decode[j * k + r], fragments[sources[r]],
+                            out, length);
+            }
+        }
+    }
+
+    // Every data fragment is now valid; recompute any parity that is missing.
+    for (uint32_t p = 0; p < parityFragments; p++) {
+        if (present[k + p])
+            continue;
+        uint8_t* out = static_cast<uint8_t*>(fragments[k + p]);
+        memset(out, 0, length);
+        for (uint32_t j = 0; j < k; j++)
+            multiplyAdd(generator[(k + p) * k + j], fragments[j], out, length);
+    }
+    return true;
+}
+
+/**
+ * Multiply two elements of GF(2^8).
+ */
+uint8_t
+ReedSolomon::multiply(uint8_t a, uint8_t b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    const GaloisTables& t = tables();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+/**
+ * Return the multiplicative inverse of a nonzero element of GF(2^8).
+ */
+uint8_t
+ReedSolomon::inverse(uint8_t a)
+{
+    if (a == 0)
+        DIE("zero has no inverse in GF(2^8)");
+    const GaloisTables& t = tables();
+    return t.exp[255 - t.log[a]];
+}
+
+/**
+ * Multiply each byte of a region by a constant in GF(2^8) and add (XOR) the
+ * products into another region. This is the inner loop of both encoding
+ * and reconstruction.
+ *
+ * \param c
+ *      Constant to multiply by.
+ * \param source
+ *      Region of \a length bytes to multiply.
+ * \param destination
+ *      Region of \a length bytes that the products are added into. May not
+ *      overlap \a source.
+ * \param length
+ *      Size of both regions in bytes.
+ */
+void
+ReedSolomon::multiplyAdd(uint8_t c, const void* source, void* destination,
+                         size_t length)
+{
+    if (c == 0)
+        return;
+
+    const uint8_t* in = static_cast<const uint8_t*>(source);
+    uint8_t* out = static_cast<uint8_t*>(destination);
+    size_t i = 0;
+
+#if __SSSE3__
+    // Split each byte into nibbles and look up the product of c with each
+    // nibble in a 16-entry table; multiplication distributes over XOR, so
+    // XORing the two lookups gives c times the whole byte.
+    uint8_t lowProducts[16];
+    uint8_t highProducts[16];
+    for (uint8_t nibble = 0; nibble < 16; nibble++) {
+        lowProducts[nibble] = multiply(c, nibble);
+        highProducts[nibble] = multiply(c, downCast<uint8_t>(nibble << 4));
+    }
+    const __m128i low = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(lowProducts));
+    const __m128i high = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(highProducts));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(in + i));
+        __m128i lowNibbles = _mm_and_si128(bytes, mask);
+        __m128i highNibbles = _mm_and_si128(_mm_srli_epi64(bytes, 4), mask);
+        __m128i product = _mm_xor_si128(_mm_shuffle_epi8(low, lowNibbles),
+                                        _mm_shuffle_epi8(high, highNibbles));
+        __m128i* target = reinterpret_cast<__m128i*>(out + i);
+        _mm_storeu_si128(target,
+                         _mm_xor_si128(_mm_loadu_si128(target), product));
+    }
+#endif
+
+    if (c == 1) {
+        for (; i < length; i++)
+            out[i] ^= in[i];
+        return;
+    }
+    const GaloisTables& t = tables();
+    const uint32_t logC = t.log[c];
+    for (; i < length; i++) {
+        if (in[i] != 0)
+            out[i] ^= t.exp[logC + t.log[in[i]]];
+    }
+}
+
+/**
+ * Invert a square matrix over GF(2^8) in place using Gauss-Jordan
+ * elimination.
+ *
+ * \param matrix
+ *      Row-major n x n matrix; replaced by its inverse on success.
+ * \param n
+ *      Dimension of the matrix.
+ * \return
+ *      False if the matrix is singular (its contents are then undefined).
+ */
+bool
+ReedSolomon::invert(std::vector<uint8_t>& matrix, uint32_t n)
+{
+    std::vector<uint8_t> result(n * n, 0);
+    for (uint32_t i = 0; i < n; i++)
+        result[i * n + i] = 1;
+
+    for (uint32_t col = 0; col < n; col++) {
+        uint32_t pivot = col;
+        while (pivot < n && matrix[pivot * n + col] == 0)
+            pivot++;
+        if (pivot == n)
+            return false;
+        if (pivot != col) {
+            for (uint32_t j = 0; j < n; j++) {
+                std::swap(matrix[col * n + j], matrix[pivot * n + j]);
+                std::swap(result[col * n + j], result[pivot * n + j]);
+            }
+        }
+
+        uint8_t scale = inverse(matrix[col * n + col]);
+        for (uint32_t j = 0; j < n; j++) {
+            matrix[col * n + j] = multiply(matrix[col * n + j], scale);
+            result[col * n + j] = multiply(result[col * n + j], scale);
+        }
+
+        for (uint32_t row = 0; row < n; row++) {
+            uint8_t factor = matrix[row * n + col];
+            if (row == col || factor == 0)
+                continue;
+            for (uint32_t j = 0; j < n; j++) {
+                matrix[row * n + j] ^= multiply(factor, matrix[col * n + j]);
+                result[row * n + j] ^= multiply(factor, result[col * n + j]);
+            }
+        }
+    }
+    matrix.swap(result);
+    return true;
+}
+
+} // namespace RAMCloud
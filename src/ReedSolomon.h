@@ -0,0 +1,92 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_REEDSOLOMON_H
+#define RAMCLOUD_REEDSOLOMON_H
+
+#include <vector>
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * A systematic Reed-Solomon erasure code over GF(2^8), intended for storing
+ * closed segments as k data fragments plus m parity fragments (for example
+ * 4+2) instead of as full replicas. Any k of the k + m fragments are enough
+ * to rebuild all of the others.
+ *
+ * The parity rows of the generator matrix form a Cauchy matrix, so every
+ * k x k submatrix of the full generator is invertible. The inner loop
+ * (multiply a region by a constant and add it into another) uses the
+ * split-nibble PSHUFB technique when compiled with SSSE3, which RAMCloud's
+ * default -msse4.2 build includes, and a log/antilog table otherwise.
+ *
+ * Instances are immutable once constructed and are safe to share between
+ * threads.
+ */
+class ReedSolomon {
+  PUBLIC:
+    ReedSolomon(uint32_t dataFragments, uint32_t parityFragments);
+
+    void encode(const void* const data[], void* const parity[],
+                size_t length) const;
+    void encodeFragment(const void* buffer, uint32_t bufferLength,
+                        uint32_t index, void* fragment) const;
+    bool reconstruct(void* const fragments[], const bool present[],
+                     size_t length) const;
+
+    /// Return the number of data fragments (k).
+    uint32_t getDataFragments() const { return dataFragments; }
+
+    /// Return the number of parity fragments (m).
+    uint32_t getParityFragments() const { return parityFragments; }
+
+    /**
+     * Return the length of each fragment of a buffer \a length bytes long:
+     * the buffer is split into k pieces of this length, the last of which
+     * is padded with zeroes.
+     */
+    uint32_t getFragmentLength(uint32_t length) const {
+        return (length + dataFragments - 1) / dataFragments;
+    }
+
+    static uint8_t multiply(uint8_t a, uint8_t b);
+    static uint8_t inverse(uint8_t a);
+    static void multiplyAdd(uint8_t c, const void* source, void* destination,
+                            size_t length);
+
+  PRIVATE:
+    static bool invert(std::vector<uint8_t>& matrix, uint32_t n);
+
+    /// Number of data fragments (k) each segment is split into.
+    const uint32_t dataFragments;
+
+    /// Number of parity fragments (m) computed from the data fragments.
+    const uint32_t parityFragments;
+
+    /**
+     * Row-major (k + m) x k generator matrix. The first k rows are the
+     * identity (fragments 0 through k - 1 are the data itself); the
+     * remaining m rows produce the parity fragments.
+     */
+    std::vector<uint8_t> generator;
+
+    DISALLOW_COPY_AND_ASSIGN(ReedSolomon);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_REEDSOLOMON_H
@@ -0,0 +1,189 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ReedSolomon.h"
+
+namespace RAMCloud {
+
+struct ReedSolomonTest : public ::testing::Test {
+    static const uint32_t K = 4;
+    static const uint32_t M = 2;
+
+    ReedSolomon code;
+    std::vector<std::vector<uint8_t>> original;
+    std::vector<std::vector<uint8_t>> fragments;
+
+    ReedSolomonTest()
+        : code(K, M)
+        , original()
+        , fragments()
+    {
+    }
+
+    /// Contents of byte \a i of data fragment \a f.
+    static uint8_t
+    pattern(uint32_t f, size_t i)
+    {
+        return downCast<uint8_t>(((i * 7 + f * 31) ^ i >> 8) & 0xff);
+    }
+
+    /**
+     * Fill the data fragments with a deterministic pattern, encode them,
+     * and stash a copy of every fragment in #original.
+     */
+    void
+    encode(size_t length)
+    {
+        fragments.assign(K + M, std::vector<uint8_t>(length));
+        for (uint32_t f = 0; f < K; f++) {
+            for (size_t i = 0; i < length; i++)
+                fragments[f][i] = pattern(f, i);
+        }
+        const void* data[K];
+        void* parity[M];
+        for (uint32_t f = 0; f < K; f++)
+            data[f] = &fragments[f][0];
+        for (uint32_t p = 0; p < M; p++)
+            parity[p] = &fragments[K + p][0];
+        code.encode(data, parity, length);
+        original = fragments;
+    }
+
+    /// Wipe the given fragments and try to get them back.
+    bool
+    loseAndReconstruct(uint32_t first, uint32_t second)
+    {
+        bool present[K + M];
+        void* pointers[K + M];
+        for (uint32_t f = 0; f < K + M; f++) {
+            present[f] = (f != first && f != second);
+            if (!present[f])
+                memset(&fragments[f][0], 0xcc, fragments[f].size());
+            pointers[f] = &fragments[f][0];
+        }
+        return code.reconstruct(pointers, present, fragments[0].size());
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ReedSolomonTest);
+};
+
+TEST_F(ReedSolomonTest, constructor) {
+    EXPECT_EQ(4U, code.getDataFragments());
+    EXPECT_EQ(2U, code.getParityFragments());
+    EXPECT_EQ(24U, code.generator.size());
+    EXPECT_EQ(1, code.generator[0]);
+    EXPECT_EQ(0, code.generator[1]);
+    EXPECT_EQ(ReedSolomon::inverse(4 ^ 1), code.generator[4 * 4 + 1]);
+    EXPECT_THROW(ReedSolomon(0, 2), FatalError);
+    EXPECT_THROW(ReedSolomon(250, 7), FatalError);
+}
+
+TEST_F(ReedSolomonTest, multiplyAndInverse) {
+    EXPECT_EQ(0, ReedSolomon::multiply(0, 0x53));
+    EXPECT_EQ(0x53, ReedSolomon::multiply(1, 0x53));
+    // In GF(2^8) mod 0x11d, x * x^7 = x^8 = x^4 + x^3 + x^2 + 1.
+    EXPECT_EQ(0x1d, ReedSolomon::multiply(2, 0x80));
+    for (uint32_t a = 1; a < 256; a++) {
+        uint8_t b = downCast<uint8_t>(a);
+        EXPECT_EQ(1, ReedSolomon::multiply(b, ReedSolomon::inverse(b)));
+    }
+}
+
+TEST_F(ReedSolomonTest, multiplyAdd) {
+    // Long enough to exercise both the vector loop and the scalar tail.
+    uint8_t source[37];
+    uint8_t destination[37];
+    for (uint32_t i = 0; i < sizeof(source); i++) {
+        source[i] = downCast<uint8_t>((i * 13 + 5) & 0xff);
+        destination[i] = downCast<uint8_t>(i);
+    }
+    ReedSolomon::multiplyAdd(0x8e, source, destination, sizeof(source));
+    for (uint32_t i = 0; i < sizeof(source); i++) {
+        uint8_t expected = downCast<uint8_t>(
+                i ^ ReedSolomon::multiply(0x8e, source[i]));
+        EXPECT_EQ(expected, destination[i]) << "byte " << i;
+    }
+}
+
+TEST_F(ReedSolomonTest, encode_dataUnchanged) {
+    encode(1000);
+    for (uint32_t f = 0; f < K; f++) {
+        for (size_t i = 0; i < 1000; i++)
+            ASSERT_EQ(pattern(f, i), fragments[f][i]);
+    }
+    EXPECT_NE(fragments[K], fragments[K + 1]);
+}
+
+TEST_F(ReedSolomonTest, encodeFragment) {
+    // The last data fragment is short and the padding must read as zeroes.
+    const uint32_t length = 1000;
+    const uint32_t bufferLength = K * length - 3;
+    encode(length);
+    for (uint32_t i = bufferLength - 3 * length; i < length; i++)
+        fragments[K - 1][i] = 0;
+    const void* data[K];
+    void* parity[M];
+    for (uint32_t f = 0; f < K; f++)
+        data[f] = &fragments[f][0];
+    for (uint32_t p = 0; p < M; p++)
+        parity[p] = &fragments[K + p][0];
+    code.encode(data, parity, length);
+
+    std::vector<uint8_t> buffer;
+    for (uint32_t f = 0; f < K; f++)
+        buffer.insert(buffer.end(), fragments[f].begin(), fragments[f].end());
+    buffer.resize(bufferLength);
+
+    std::vector<uint8_t> fragment(length);
+    for (uint32_t f = 0; f < K + M; f++) {
+        memset(&fragment[0], 0xcc, length);
+        code.encodeFragment(&buffer[0], bufferLength, f, &fragment[0]);
+        EXPECT_TRUE(fragment == fragments[f]) << "fragment " << f;
+    }
+}
+
+TEST_F(ReedSolomonTest, reconstruct_anyTwoLost) {
+    // Odd length spanning several encode chunks.
+    encode(3 * 4096 + 11);
+    for (uint32_t first = 0; first < K + M; first++) {
+        for (uint32_t second = first; second < K + M; second++) {
+            EXPECT_TRUE(loseAndReconstruct(first, second));
+            EXPECT_TRUE(original == fragments)
+                << "lost " << first << " and " << second;
+        }
+    }
+}
+
+TEST_F(ReedSolomonTest, reconstruct_tooFewFragments) {
+    encode(64);
+    bool present[K + M] = { true, false, true, false, false, true };
+    void* pointers[K + M];
+    for (uint32_t f = 0; f < K + M; f++)
+        pointers[f] = &fragments[f][0];
+    EXPECT_FALSE(code.reconstruct(pointers, present, 64));
+    EXPECT_TRUE(original == fragments);
+}
+
+TEST_F(ReedSolomonTest, invert) {
+    std::vector<uint8_t> matrix = { 0, 1, 1, 0 };
+    EXPECT_TRUE(ReedSolomon::invert(matrix, 2));
+    EXPECT_EQ((std::vector<uint8_t>{ 0, 1, 1, 0 }), matrix);
+
+    std::vector<uint8_t> singular = { 3, 3, 3, 3 };
+    EXPECT_FALSE(ReedSolomon::invert(singular, 2));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,202 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Common.h"
+#include "Memory.h"
+#include "RemoteReadTable.h"
+#include "ShortMacros.h"
+#include "TransportManager.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a RemoteReadTable and register it with the transports.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server.
+ * \param numSlots
+ *      Number of entries in the table; must be nonzero.
+ * \param logBase
+ *      Start of the master's log memory, which must already have been
+ *      registered with the transports.
+ * \param logBytes
+ *      Number of bytes of log memory starting at \a logBase.
+ */
+RemoteReadTable::RemoteReadTable(Context* context, uint32_t numSlots,
+        const void* logBase, uint64_t logBytes)
+    : context(context)
+    , slots(NULL)
+    , numSlots(numSlots)
+    , logBase(logBase)
+    , logBytes(logBytes)
+    , slotKey(0)
+    , objectKey(0)
+    , keysState(KEYS_UNKNOWN)
+    , epoch(0)
+    , locks()
+{
+    assert(numSlots > 0);
+    size_t bytes = numSlots * sizeof(Slot);
+    slots = static_cast<Slot*>(Memory::xmemalign(HERE, 4096, bytes));
+    memset(slots, 0, bytes);
+    for (uint32_t i = 0; i < NUM_LOCKS; i++)
+        locks[i].setName("RemoteReadTable");
+    context->transportManager->registerMemory(slots, bytes);
+    LOG(NOTICE, "Remote read table has %u slots", numSlots);
+}
+
+/**
+ * Destroy a RemoteReadTable.
+ */
+RemoteReadTable::~RemoteReadTable()
+{
+    free(slots);
+}
+
+/**
+ * Publish the location of an object that a client has just read, so that
+ * the client can read it remotely next time. This must be invoked with the
+ * object's hash table bucket locked.
+ *
+ * \param key
+ *      The object's primary key.
+ * \param version
+ *      The object's version.
+ * \param object
+ *      The object's log entry, as returned by Log::getEntry.
+ * \param epoch
+ *      Value that #getEpoch returned before the caller checked that the
+ *      object's tablet is served here.
+ * \param[out] hint
+ *      Filled in with the information the client needs to find the object.
+ * \return
+ *      True means the object was published; false means it can't be read
+ *      remotely (it isn't contiguous, the transports don't support remote
+ *      reads, or the table was cleared since \a epoch).
+ */
+bool
+RemoteReadTable::publish(Key& key, uint64_t version, Buffer& object,
+        uint64_t epoch, Hint* hint)
+{
+    if (object.getNumberChunks() != 1 || !findKeys())
+        return false;
+    uint32_t length = object.size();
+    const char* address =
+            static_cast<const char*>(object.getRange(0, length));
+    const char* base = static_cast<const char*>(logBase);
+    if (address < base || address + length > base + logBytes)
+        return false;
+
+    uint32_t index = slotIndex(key.getTableId(), key.getHash());
+    Slot* slot = &slots[index];
+    {
+        SpinLock::Guard _(locks[index % NUM_LOCKS]);
+        if (this->epoch.load(std::memory_order_acquire) != epoch)
+            return false;
+
+        // Empty the slot while it's being filled in, so that remote readers
+        // can't mistake a mix of old and new fields for a valid entry.
+        slot->checksum = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->tableId = key.getTableId();
+        slot->keyHash = key.getHash();
+        slot->version = version;
+        slot->address = reinterpret_cast<uint64_t>(address);
+        slot->length = length;
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->checksum = slot->computeChecksum();
+    }
+
+    hint->slotAddress = reinterpret_cast<uint64_t>(slot);
+    hint->slotKey = slotKey;
+    hint->objectKey = objectKey;
+    return true;
+}
+
+/**
+ * Make sure clients can't read an object remotely at its current location.
+ * This must be invoked with the object's hash table bucket locked, whenever
+ * the hash table entry for its key changes.
+ *
+ * \param key
+ *      The object's primary key.
+ */
+void
+RemoteReadTable::invalidate(Key& key)
+{
+    uint32_t index = slotIndex(key.getTableId(), key.getHash());
+    Slot* slot = &slots[index];
+    SpinLock::Guard _(locks[index % NUM_LOCKS]);
+    if (slot->checksum == 0)
+        return;
+    // Other keys may share the slot; it's simpler (and just as safe) to
+    // empty it regardless.
+    slot->checksum = 0;
+}
+
+/**
+ * Empty every slot; used when this master stops serving a tablet, since
+ * writes that occur elsewhere from then on won't invalidate our slots.
+ * The caller must already have changed the tablet's state so that new
+ * reads won't publish objects from it.
+ */
+void
+RemoteReadTable::clear()
+{
+    epoch.fetch_add(1, std::memory_order_acq_rel);
+    for (uint32_t i = 0; i < numSlots; i++) {
+        SpinLock::Guard _(locks[i % NUM_LOCKS]);
+        slots[i].checksum = 0;
+    }
+}
+
+/**
+ * Look up the keys clients need in order to read the table and the log
+ * memory remotely, if that hasn't been done yet.
+ *
+ * \return
+ *      True means #slotKey and #objectKey are valid.
+ */
+bool
+RemoteReadTable::findKeys()
+{
+    int state = keysState.load(std::memory_order_acquire);
+    if (state != KEYS_UNKNOWN)
+        return state == KEYS_FOUND;
+    if (context->transportManager->getRemoteKey(slots,
+                numSlots * sizeof(Slot), &slotKey) &&
+            context->transportManager->getRemoteKey(logBase, logBytes,
+                &objectKey)) {
+        state = KEYS_FOUND;
+    } else {
+        LOG(NOTICE, "No transport supports remote reads; read hints "
+                "won't be given to clients");
+        state = KEYS_UNAVAILABLE;
+    }
+    keysState.store(state, std::memory_order_release);
+    return state == KEYS_FOUND;
+}
+
+/**
+ * Returns the index of the slot for a given object.
+ */
+uint32_t
+RemoteReadTable::slotIndex(uint64_t tableId, KeyHash keyHash) const
+{
+    return downCast<uint32_t>((keyHash ^ (tableId * 0x9e3779b97f4a7c15UL))
+            % numSlots);
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,167 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_REMOTEREADTABLE_H
+#define RAMCLOUD_REMOTEREADTABLE_H
+
+#include <atomic>
+
+#include "Common.h"
+#include "Buffer.h"
+#include "Crc32C.h"
+#include "Key.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * A table, registered with the transports for one-sided reads, that lets
+ * clients read objects straight out of a master's log memory with RDMA
+ * (see Transport::Session::readRemote) instead of sending read RPCs.
+ *
+ * The table is direct-mapped by table id and key hash. When a client asks
+ * for it, a read RPC publishes the location of the object it returns in the
+ * object's slot, and tells the client where the slot is. Later, the client
+ * reads the slot remotely, then the object it points to, and checks both
+ * (see Slot::isValid and RemoteReader); if anything doesn't match it falls
+ * back to an RPC. ObjectManager invalidates an object's slot whenever the
+ * hash table entry for its key changes (a write or remove, or the cleaner
+ * moving the object), before the operation is acknowledged, so a client
+ * that finds a valid slot sees a version that was current when it read
+ * the slot. Entire tables are wiped when tablets stop being served here.
+ *
+ * Only objects that are contiguous in log memory are published.
+ *
+ * This class is thread-safe.
+ */
+class RemoteReadTable {
+  PUBLIC:
+    /**
+     * One entry in the table. Clients read whole slots remotely, so a
+     * slot may be seen half-written; #checksum detects that.
+     */
+    struct Slot {
+        /// Identifies the object; clients check both before using the slot.
+        uint64_t tableId;
+        uint64_t keyHash;
+
+        /// Version of the object at #address.
+        uint64_t version;
+
+        /// Location of the object's log entry (in Object's log format) in
+        /// the master's address space, and its length in bytes.
+        uint64_t address;
+        uint32_t length;
+
+        /// Checksum of the preceding fields; 0 means the slot is empty.
+        uint32_t checksum;
+
+        /**
+         * Returns the checksum of all the fields except #checksum itself
+         * (never 0, so that an all-zero slot is empty).
+         */
+        uint32_t computeChecksum() const {
+            Crc32C crc;
+            crc.update(this, downCast<uint32_t>(OFFSET_OF(Slot, checksum)));
+            uint32_t result = crc.getResult();
+            return (result == 0) ? 1 : result;
+        }
+
+        /**
+         * Returns true if the slot holds a complete, consistent entry.
+         */
+        bool isValid() const {
+            return checksum != 0 && checksum == computeChecksum();
+        }
+    } __attribute__((packed));
+
+    /**
+     * What a client needs in order to read an object remotely; returned
+     * to it in read responses.
+     */
+    struct Hint {
+        Hint() : slotAddress(0), slotKey(0), objectKey(0) {}
+
+        /// Address of the object's Slot; 0 means no hint was published.
+        uint64_t slotAddress;
+
+        /// Transport key for reading the slot.
+        uint32_t slotKey;
+
+        /// Transport key for reading the log memory the slot points to.
+        uint32_t objectKey;
+    };
+
+    RemoteReadTable(Context* context, uint32_t numSlots,
+                    const void* logBase, uint64_t logBytes);
+    ~RemoteReadTable();
+
+    /**
+     * Returns a value that must be passed to #publish, read before the
+     * caller checked that it owns the object's tablet (see #clear).
+     */
+    uint64_t getEpoch() const {
+        return epoch.load(std::memory_order_acquire);
+    }
+
+    bool publish(Key& key, uint64_t version, Buffer& object,
+                 uint64_t epoch, Hint* hint);
+    void invalidate(Key& key);
+    void clear();
+
+  PRIVATE:
+    bool findKeys();
+    uint32_t slotIndex(uint64_t tableId, KeyHash keyHash) const;
+
+    /// Number of locks serializing updates of #slots; slot i is protected
+    /// by locks[i % NUM_LOCKS].
+    static const uint32_t NUM_LOCKS = 1024;
+
+    /// Shared RAMCloud information.
+    Context* context;
+
+    /// The table itself, registered with the transports.
+    Slot* slots;
+
+    /// Number of entries in #slots.
+    uint32_t numSlots;
+
+    /// The master's log memory, which published objects must live in.
+    const void* logBase;
+    uint64_t logBytes;
+
+    /// Keys clients use to read #slots and the log memory; only valid once
+    /// #keysState is KEYS_FOUND.
+    uint32_t slotKey;
+    uint32_t objectKey;
+
+    /// Whether #slotKey and #objectKey have been looked up (the transports
+    /// may not exist yet when the table is created).
+    enum { KEYS_UNKNOWN, KEYS_FOUND, KEYS_UNAVAILABLE };
+    std::atomic<int> keysState;
+
+    /// Incremented by #clear, so that publishes that were decided before
+    /// the clear don't repopulate the table after it.
+    std::atomic<uint64_t> epoch;
+
+    /// See NUM_LOCKS.
+    UnnamedSpinLock locks[NUM_LOCKS];
+
+    DISALLOW_COPY_AND_ASSIGN(RemoteReadTable);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_REMOTEREADTABLE_H
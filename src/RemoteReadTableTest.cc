@@ -0,0 +1,124 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "RemoteReadTable.h"
+
+namespace RAMCloud {
+
+class RemoteReadTableTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    char log[1000];
+    RemoteReadTable table;
+    Key key;
+    Buffer object;
+
+    RemoteReadTableTest()
+        : logEnabler()
+        , context()
+        , log()
+        , table(&context, 8, log, sizeof(log))
+        , key(12, "key1", 4)
+        , object()
+    {
+        table.keysState = RemoteReadTable::KEYS_FOUND;
+        table.slotKey = 3;
+        table.objectKey = 4;
+        object.appendExternal(log + 100, 50);
+        TestLog::reset();
+    }
+
+    RemoteReadTable::Slot*
+    slotFor(Key& key)
+    {
+        return &table.slots[table.slotIndex(key.getTableId(), key.getHash())];
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RemoteReadTableTest);
+};
+
+TEST_F(RemoteReadTableTest, publish) {
+    RemoteReadTable::Hint hint;
+    EXPECT_TRUE(table.publish(key, 7, object, table.getEpoch(), &hint));
+    RemoteReadTable::Slot* slot = slotFor(key);
+    EXPECT_TRUE(slot->isValid());
+    EXPECT_EQ(12u, slot->tableId);
+    EXPECT_EQ(key.getHash(), slot->keyHash);
+    EXPECT_EQ(7u, slot->version);
+    EXPECT_EQ(reinterpret_cast<uint64_t>(log + 100), slot->address);
+    EXPECT_EQ(50u, slot->length);
+    EXPECT_EQ(reinterpret_cast<uint64_t>(slot), hint.slotAddress);
+    EXPECT_EQ(3u, hint.slotKey);
+    EXPECT_EQ(4u, hint.objectKey);
+
+    // A torn read of the slot doesn't look valid.
+    slot->version = 8;
+    EXPECT_FALSE(slot->isValid());
+}
+
+TEST_F(RemoteReadTableTest, publish_notPublishable) {
+    RemoteReadTable::Hint hint;
+
+    // Not contiguous.
+    object.appendExternal(log + 150, 10);
+    EXPECT_FALSE(table.publish(key, 7, object, table.getEpoch(), &hint));
+
+    // Not in log memory.
+    char other[10];
+    Buffer outside;
+    outside.appendExternal(other, sizeof(other));
+    EXPECT_FALSE(table.publish(key, 7, outside, table.getEpoch(), &hint));
+
+    // The table was cleared after the caller checked its tablet.
+    Buffer good;
+    good.appendExternal(log, 10);
+    uint64_t epoch = table.getEpoch();
+    table.clear();
+    EXPECT_FALSE(table.publish(key, 7, good, epoch, &hint));
+    EXPECT_FALSE(slotFor(key)->isValid());
+    EXPECT_EQ(0u, hint.slotAddress);
+}
+
+TEST_F(RemoteReadTableTest, publish_noRemoteReads) {
+    RemoteReadTable::Hint hint;
+    table.keysState = RemoteReadTable::KEYS_UNKNOWN;
+    EXPECT_FALSE(table.publish(key, 7, object, table.getEpoch(), &hint));
+    EXPECT_EQ("findKeys: No transport supports remote reads; read hints "
+            "won't be given to clients", TestLog::get());
+    EXPECT_EQ(RemoteReadTable::KEYS_UNAVAILABLE, table.keysState.load());
+}
+
+TEST_F(RemoteReadTableTest, invalidate) {
+    RemoteReadTable::Hint hint;
+    EXPECT_TRUE(table.publish(key, 7, object, table.getEpoch(), &hint));
+    table.invalidate(key);
+    EXPECT_FALSE(slotFor(key)->isValid());
+}
+
+TEST_F(RemoteReadTableTest, clear) {
+    RemoteReadTable::Hint hint;
+    Key key2(13, "key2", 4);
+    EXPECT_TRUE(table.publish(key, 7, object, table.getEpoch(), &hint));
+    EXPECT_TRUE(table.publish(key2, 9, object, table.getEpoch(), &hint));
+    uint64_t epoch = table.getEpoch();
+    table.clear();
+    EXPECT_NE(epoch, table.getEpoch());
+    EXPECT_FALSE(slotFor(key)->isValid());
+    EXPECT_FALSE(slotFor(key2)->isValid());
+}
+
+}  // namespace RAMCloud
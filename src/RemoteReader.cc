@@ -0,0 +1,181 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "RemoteReader.h"
+#include "Dispatch.h"
+#include "Object.h"
+#include "ObjectFinder.h"
+#include "RamCloud.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a RemoteReader; it is disabled until enable() is called.
+ *
+ * \param ramcloud
+ *      The RAMCloud object whose reads may be performed remotely.
+ */
+RemoteReader::RemoteReader(RamCloud* ramcloud)
+    : ramcloud(ramcloud)
+    , hints()
+    , maxHints(0)
+{
+}
+
+/**
+ * Record the hint that a master returned in response to a read RPC.
+ *
+ * \param tableId
+ *      Table containing the object that was read.
+ * \param keyHash
+ *      Hash of the object's primary key.
+ * \param session
+ *      Session the read RPC was sent on.
+ * \param respHdr
+ *      The response to the read RPC.
+ */
+void
+RemoteReader::addHint(uint64_t tableId, KeyHash keyHash,
+        const Transport::SessionRef& session,
+        const WireFormat::Read::Response* respHdr)
+{
+    std::pair<uint64_t, KeyHash> id(tableId, keyHash);
+    if (respHdr->remoteReadSlot == 0) {
+        hints.erase(id);
+        return;
+    }
+    if (hints.size() >= maxHints && hints.find(id) == hints.end()) {
+        // Make room by dropping an arbitrary hint (one near the new one,
+        // since that's cheap to find).
+        HintMap::iterator victim = hints.lower_bound(id);
+        if (victim == hints.end())
+            victim = hints.begin();
+        hints.erase(victim);
+    }
+    Hint& hint = hints[id];
+    hint.locator = session->serviceLocator;
+    hint.slotAddress = respHdr->remoteReadSlot;
+    hint.slotKey = respHdr->remoteReadSlotKey;
+    hint.objectKey = respHdr->remoteReadObjectKey;
+}
+
+/**
+ * Start asking masters for hints, and using them to read objects
+ * remotely. This only has an effect if the transports support one-sided
+ * reads and the masters have a RemoteReadTable.
+ *
+ * \param maxHints
+ *      At most this many objects can be read remotely at once; 0 disables
+ *      remote reads.
+ */
+void
+RemoteReader::enable(uint32_t maxHints)
+{
+    this->maxHints = maxHints;
+    if (maxHints == 0)
+        hints.clear();
+}
+
+/**
+ * Try to read an object remotely, as RamCloud::read would.
+ *
+ * \param tableId
+ *      The table containing the desired object.
+ * \param key
+ *      Primary key for the object within tableId.
+ * \param keyLength
+ *      Size in bytes of the key.
+ * \param[out] value
+ *      After a successful return, this Buffer holds the contents of the
+ *      desired object - only the value portion of the object.
+ * \param[out] version
+ *      If non-NULL, the version number of the object is returned here.
+ * \return
+ *      True means the object was read; false means the caller must read it
+ *      with an RPC instead.
+ */
+bool
+RemoteReader::read(uint64_t tableId, const void* key, uint16_t keyLength,
+        Buffer* value, uint64_t* version)
+{
+    KeyHash keyHash = Key::getHash(tableId, key, keyLength);
+    HintMap::iterator it = hints.find(std::make_pair(tableId, keyHash));
+    if (it == hints.end())
+        return false;
+    Hint& hint = it->second;
+
+    // A hint for one master's memory must never be used with another: the
+    // tablet may have moved.
+    Transport::SessionRef session =
+            ramcloud->clientContext->objectFinder->lookup(tableId, keyHash);
+    if (session->serviceLocator != hint.locator) {
+        hints.erase(it);
+        return false;
+    }
+
+    Dispatch::Lock lock(ramcloud->clientContext->dispatch);
+    RemoteReadTable::Slot slot;
+    if (!session->readRemote(hint.slotAddress, hint.slotKey, sizeof32(slot),
+            &slot)) {
+        hints.erase(it);
+        return false;
+    }
+    if (!slot.isValid() || slot.tableId != tableId ||
+            slot.keyHash != keyHash ||
+            slot.length < sizeof32(Object::CompactHeader)) {
+        // The object was modified or moved since it was published; a read
+        // RPC will publish it again.
+        TEST_LOG("slot doesn't describe the object");
+        return false;
+    }
+
+    value->reset();
+    void* data = value->alloc(slot.length);
+    if (!session->readRemote(slot.address, hint.objectKey, slot.length,
+            data)) {
+        value->reset();
+        hints.erase(it);
+        return false;
+    }
+
+    // The slot may have been invalidated, and the memory reused, between
+    // the two reads.
+    Object object(data, slot.length);
+    KeyLength objectKeyLength = 0;
+    const void* objectKey = NULL;
+    uint32_t valueOffset = 0;
+    if (object.checkIntegrity())
+        objectKey = object.getKey(0, &objectKeyLength);
+    if (objectKey == NULL || object.getTableId() != tableId ||
+            object.getVersion() != slot.version ||
+            objectKeyLength != keyLength ||
+            memcmp(objectKey, key, keyLength) != 0 ||
+            !object.getValueOffset(&valueOffset)) {
+        TEST_LOG("object doesn't match slot");
+        value->reset();
+        return false;
+    }
+
+    // The header may be compact and may be followed by an expiry time.
+    uint32_t headerLength =
+            object.getSerializedLength() - object.getKeysAndValueLength();
+    value->truncateFront(headerLength + valueOffset);
+    if (version != NULL)
+        *version = slot.version;
+    return true;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,95 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_REMOTEREADER_H
+#define RAMCLOUD_REMOTEREADER_H
+
+#include <map>
+
+#include "Buffer.h"
+#include "RemoteReadTable.h"
+#include "Transport.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+class RamCloud;
+
+/**
+ * Lets RamCloud::read fetch objects with one-sided RDMA reads of the
+ * master's memory instead of read RPCs, when the transport supports it
+ * (currently only InfRcTransport does). It is off unless
+ * RamCloud::enableRemoteReads() is called.
+ *
+ * Read RPCs ask the master for a hint: the address of the object's slot
+ * in the master's RemoteReadTable. Later reads of the object read the slot
+ * remotely, then the object it points to, and check that the object is
+ * intact (the checksum in its header), has the right key, and has the
+ * version recorded in the slot. Anything that doesn't check out (an
+ * overwritten or relocated object, a slot reused by another key, a tablet
+ * that moved) makes the caller fall back to a read RPC, which also
+ * refreshes the hint.
+ *
+ * Like RamCloud, this class is not thread-safe.
+ */
+class RemoteReader {
+  PUBLIC:
+    explicit RemoteReader(RamCloud* ramcloud);
+
+    void addHint(uint64_t tableId, KeyHash keyHash,
+                 const Transport::SessionRef& session,
+                 const WireFormat::Read::Response* respHdr);
+    void enable(uint32_t maxHints);
+    bool read(uint64_t tableId, const void* key, uint16_t keyLength,
+              Buffer* value, uint64_t* version);
+
+    /// Returns true if reads should ask masters for hints.
+    bool isEnabled() const {
+        return maxHints > 0;
+    }
+
+  PRIVATE:
+    /// Where to find one object remotely.
+    struct Hint {
+        Hint() : locator(), slotAddress(0), slotKey(0), objectKey(0) {}
+
+        /// Service locator of the master that gave out the hint; hints are
+        /// only used with sessions to that master.
+        string locator;
+
+        /// See RemoteReadTable::Hint.
+        uint64_t slotAddress;
+        uint32_t slotKey;
+        uint32_t objectKey;
+    };
+
+    /// Hints are indexed by table id and key hash.
+    typedef std::map<std::pair<uint64_t, KeyHash>, Hint> HintMap;
+
+    /// Overall client state information.
+    RamCloud* ramcloud;
+
+    /// Hints for objects read recently.
+    HintMap hints;
+
+    /// Upper limit on the size of #hints; 0 means remote reads are off.
+    uint32_t maxHints;
+
+    DISALLOW_COPY_AND_ASSIGN(RemoteReader);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_REMOTEREADER_H
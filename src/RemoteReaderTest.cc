@@ -0,0 +1,170 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "PerfStats.h"
+#include "RamCloud.h"
+#include "RemoteReader.h"
+
+namespace RAMCloud {
+
+static bool
+readFilter(string s)
+{
+    return s == "read";
+}
+
+class RemoteReaderTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+
+    RemoteReaderTest()
+        : logEnabler(readFilter)
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , tableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+        cluster.transport.remoteReads = true;
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        config.master.remoteReadSlots = 64;
+        cluster.addServer(config);
+        ramcloud.construct(&context, "mock:host=coordinator");
+
+        tableId = ramcloud->createTable("table1");
+        ramcloud->write(tableId, "object1", 7, "value1");
+        TestLog::reset();
+    }
+
+    /// Returns the number of reads masters have performed (in this thread).
+    uint64_t
+    readCount()
+    {
+        return PerfStats::threadStats.readCount;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RemoteReaderTest);
+};
+
+TEST_F(RemoteReaderTest, disabledByDefault) {
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(0u, ramcloud->remoteReader->hints.size());
+}
+
+TEST_F(RemoteReaderTest, read) {
+    ramcloud->enableRemoteReads();
+    Buffer value;
+    uint64_t version1, version2;
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version1);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ(1u, ramcloud->remoteReader->hints.size());
+
+    ramcloud->read(tableId, "object1", 7, &value, NULL, &version2);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(version1, version2);
+    EXPECT_EQ("", TestLog::get());
+}
+
+TEST_F(RemoteReaderTest, read_objectOverwritten) {
+    ramcloud->enableRemoteReads();
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ramcloud->write(tableId, "object1", 7, "value2");
+
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+    EXPECT_EQ("read: slot doesn't describe the object", TestLog::get());
+
+    // The read RPC refreshed the hint.
+    TestLog::reset();
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+}
+
+TEST_F(RemoteReaderTest, read_objectMismatch) {
+    ramcloud->enableRemoteReads();
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+
+    // Make the slot disagree with the object it points to, as if the
+    // object's memory had been reused.
+    RemoteReader::Hint& hint = ramcloud->remoteReader->hints.begin()->second;
+    RemoteReadTable::Slot* slot =
+            reinterpret_cast<RemoteReadTable::Slot*>(hint.slotAddress);
+    slot->version++;
+    slot->checksum = slot->computeChecksum();
+
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ("read: object doesn't match slot", TestLog::get());
+}
+
+TEST_F(RemoteReaderTest, read_rejectRules) {
+    ramcloud->enableRemoteReads();
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.doesntExist = 1;
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value, &rules);
+    EXPECT_EQ(reads + 1, readCount());
+}
+
+TEST_F(RemoteReaderTest, read_noRemoteReads) {
+    cluster.transport.remoteReads = false;
+    ramcloud->enableRemoteReads();
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object1", 7, &value);
+    EXPECT_EQ(reads + 1, readCount());
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ(0u, ramcloud->remoteReader->hints.size());
+}
+
+TEST_F(RemoteReaderTest, addHint_evict) {
+    ramcloud->enableRemoteReads(1);
+    ramcloud->write(tableId, "object2", 7, "value2");
+    Buffer value;
+    ramcloud->read(tableId, "object1", 7, &value);
+    ramcloud->read(tableId, "object2", 7, &value);
+    EXPECT_EQ(1u, ramcloud->remoteReader->hints.size());
+    uint64_t reads = readCount();
+    ramcloud->read(tableId, "object2", 7, &value);
+    EXPECT_EQ(reads, readCount());
+    EXPECT_EQ("value2", TestUtil::toString(&value));
+}
+
+}  // namespace RAMCloud
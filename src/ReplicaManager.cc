@@ -41,12 +41,45 @@ namespace RAMCloud {
  *      replication.
  * \param allowLocalBackup
  *      Specifies whether to allow replication to the local backup.
+ * \param writeBatchSegments
+ *      Maximum number of writes to the same backup (for different segments)
+ *      to combine into a single rpc; see BackupWriteBatcher. 1 (or 0) sends
+ *      each write in its own rpc.
+ * \param cleanerReplicationRateLimit
+ *      Most bytes per second to send to backups for segments created by the
+ *      log cleaner, so that replicating them leaves bandwidth for the log
+ *      head; see ReplicationPacer. 0 means no limit.
+ * \param chainReplication
+ *      Specifies whether writes are sent only to the backup of a segment's
+ *      first replica, which passes them on to the backups of the others;
+ *      see ReplicatedSegment::buildChain(). When a backup fails its
+ *      replacement is written directly until it has caught up.
+ * \param remoteWrites
+ *      Specifies whether replica data is written into the memory of
+ *      backups that allow it with one-sided RDMA writes, so that write rpcs
+ *      needn't carry it; see ReplicatedSegment::writeRemotely().
+ * \param dataFragments
+ *      If nonzero, closed segments are stored as this many Reed-Solomon
+ *      data fragments plus \a parityFragments parity fragments, each on a
+ *      different backup, instead of as full replicas; see
+ *      ReplicatedSegment. With \a useMinCopysets, each segment's
+ *      fragments and replicas are all placed in one replication group, so
+ *      groups must have room for both.
+ * \param parityFragments
+ *      Number of parity fragments per closed segment; ignored if
+ *      \a dataFragments is 0.
  */
 ReplicaManager::ReplicaManager(Context* context,
                                const ServerId* masterId,
                                uint32_t numReplicas,
                                bool useMinCopysets,
-                               bool allowLocalBackup)
+                               bool allowLocalBackup,
+                               uint32_t writeBatchSegments,
+                               uint64_t cleanerReplicationRateLimit,
+                               bool chainReplication,
+                               bool remoteWrites,
+                               uint32_t dataFragments,
+                               uint32_t parityFragments)
     : context(context)
     , numReplicas(numReplicas)
     , backupSelector()
@@ -60,18 +93,35 @@ ReplicaManager::ReplicaManager(Context* context,
     , replicationEpoch()
     , failureMonitor(context, this)
     , replicationCounter()
+    , writeBatcher()
+    , cleanerPacer()
     , useMinCopysets(useMinCopysets)
     , allowLocalBackup(allowLocalBackup)
+    , chainReplication(chainReplication)
+    , remoteWrites(remoteWrites)
+    , erasureCode()
 {
     if (useMinCopysets) {
+        // Replication groups must be wide enough for the fragments too.
+        uint32_t groupSize = numReplicas;
+        if (dataFragments > 0 && numReplicas > 0)
+            groupSize = std::max(groupSize, dataFragments + parityFragments);
         backupSelector.reset(new MinCopysetsBackupSelector(context, masterId,
-                                                           numReplicas,
+                                                           groupSize,
                                                            allowLocalBackup));
     } else {
         backupSelector.reset(new BackupSelector(context, masterId,
                                                 numReplicas, allowLocalBackup));
     }
     replicationEpoch.construct(context, &taskQueue, masterId);
+    if (writeBatchSegments > 1) {
+        writeBatcher.construct(context, taskQueue, masterId,
+                               writeRpcsInFlight, writeBatchSegments);
+    }
+    if (cleanerReplicationRateLimit > 0)
+        cleanerPacer.construct(cleanerReplicationRateLimit);
+    if (dataFragments > 0 && numReplicas > 0)
+        erasureCode.reset(new ReedSolomon(dataFragments, parityFragments));
 }
 
 /**
@@ -422,7 +472,10 @@ ReplicaManager::allocateSegment(const Lock& lock,
                                  *replicationEpoch,
                                  dataMutex, segmentId, segment,
                                  isLogHead, *masterId, numReplicas,
-                                 &replicationCounter);
+                                 &replicationCounter, 1024 * 1024,
+                                 writeBatcher.get(), cleanerPacer.get(),
+                                 chainReplication, remoteWrites,
+                                 erasureCode.get());
     replicatedSegmentList.push_back(*replicatedSegment);
 
     // ReplicatedSegment's constructor has scheduled the open.
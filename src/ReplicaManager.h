@@ -23,9 +23,11 @@
 #include "BackupFailureMonitor.h"
 #include "BoostIntrusive.h"
 #include "BackupSelector.h"
+#include "BackupWriteBatcher.h"
 #include "CoordinatorClient.h"
 #include "UpdateReplicationEpochTask.h"
 #include "ReplicatedSegment.h"
+#include "ReedSolomon.h"
 #include "ServerTracker.h"
 #include "TaskQueue.h"
 #include "Tub.h"
@@ -68,7 +70,13 @@ class ReplicaManager
                    const ServerId* masterId,
                    uint32_t numReplicas,
                    bool useMinCopysets,
-                   bool allowLocalBackup);
+                   bool allowLocalBackup,
+                   uint32_t writeBatchSegments = 1,
+                   uint64_t cleanerReplicationRateLimit = 0,
+                   bool chainReplication = false,
+                   bool remoteWrites = false,
+                   uint32_t dataFragments = 0,
+                   uint32_t parityFragments = 0);
     ~ReplicaManager();
 
     bool isIdle();
@@ -190,6 +198,20 @@ class ReplicaManager
      */
     Tub<CycleCounter<RawMetric>> replicationCounter;
 
+    /**
+     * Combines writes to the same backup from different segments into one
+     * rpc. Only constructed if batching was enabled when this was created;
+     * passed in to and shared among ReplicatedSegments.
+     */
+    Tub<BackupWriteBatcher> writeBatcher;
+
+    /**
+     * Limits the rate at which replicas of segments created by the log
+     * cleaner are written. Only constructed if a limit was given when this
+     * was created; passed in to and shared among ReplicatedSegments.
+     */
+    Tub<ReplicationPacer> cleanerPacer;
+
     /**
      * Specifies whether to use the MinCopysets replication scheme.
      */
@@ -200,6 +222,26 @@ class ReplicaManager
      */
     bool allowLocalBackup;
 
+    /**
+     * Specifies whether the backup of each segment's first replica passes
+     * writes on to the others; see ReplicatedSegment::buildChain().
+     */
+    bool chainReplication;
+
+    /**
+     * Specifies whether replica data is placed in backups' memory with
+     * one-sided RDMA writes where possible; see
+     * ReplicatedSegment::writeRemotely().
+     */
+    bool remoteWrites;
+
+    /**
+     * If set, closed segments are stored as fragments encoded with this
+     * code rather than as full replicas; see ReplicatedSegment. Shared among
+     * ReplicatedSegments.
+     */
+    std::unique_ptr<ReedSolomon> erasureCode;
+
   PUBLIC:
     // Only used by BackupFailureMonitor.
     void handleBackupFailure(ServerId failedId);
@@ -76,6 +76,18 @@ struct ReplicaManagerTest : public ::testing::Test {
 
 };
 
+TEST_F(ReplicaManagerTest, constructorMinCopysetsWithErasureCode) {
+    // Replication groups are sized to hold each segment's fragments.
+    ReplicaManager coded(&context, &serverId, 2, true, false, 1, 0,
+                         false, false, 3, 2);
+    EXPECT_EQ(5u, coded.backupSelector->numReplicas);
+    EXPECT_TRUE(coded.erasureCode);
+
+    ReplicaManager uncoded(&context, &serverId, 2, true, false);
+    EXPECT_EQ(2u, uncoded.backupSelector->numReplicas);
+    EXPECT_FALSE(uncoded.erasureCode);
+}
+
 TEST_F(ReplicaManagerTest, isReplicaNeeded) {
     ServerDetails server;
     ServerChangeEvent event;
@@ -124,7 +136,7 @@ TEST_F(ReplicaManagerTest, allocateNonHead) {
     auto segment = mgr->allocateHead(88, &seg, NULL);
 
     ASSERT_FALSE(mgr->taskQueue.isIdle());
-    EXPECT_EQ(segment, mgr->taskQueue.tasks.front());
+    EXPECT_EQ(segment, mgr->taskQueue.peekNextTask());
     EXPECT_EQ(1u, mgr->replicatedSegmentList.size());
     EXPECT_EQ(segment, &mgr->replicatedSegmentList.front());
 
@@ -273,7 +285,7 @@ bool filter(string s) {
                        , "close"
                        , "selectPrimary"
                        , "performWrite"
-                       , "writeSegment"
+                       , "writeReplica"
                        , "performTask"
                        , "updateToAtLeast"
                        };
@@ -377,7 +389,7 @@ TEST_F(ReplicaManagerTest, endToEndBackupRecovery) {
         "performWrite: Starting replication of segment 2 replica slot 1 on "
             "backup 4.0 | "
         "performWrite: Sending open to backup 4.0 | "
-        "writeSegment: Opening <3.0,2> | "
+        "writeReplica: Opening <3.0,2> | "
         // Segment 1 goes second because it was happily durable and descheduled
         // until the failure woke it up.
         "selectPrimary: Chose server 4.0 with 0 primary replicas and 100 MB/s "
@@ -385,7 +397,7 @@ TEST_F(ReplicaManagerTest, endToEndBackupRecovery) {
         "performWrite: Starting replication of segment 1 replica slot 0 on "
             "backup 4.0 | "
         "performWrite: Sending open to backup 4.0 | "
-        "writeSegment: Opening <3.0,1> | "
+        "writeReplica: Opening <3.0,1> | "
         "performWrite: Write RPC finished for replica slot 0 | "
         "performWrite: Write RPC finished for replica slot 1 | "
         "performWrite: Write RPC finished for replica slot 0 | "
@@ -393,7 +405,7 @@ TEST_F(ReplicaManagerTest, endToEndBackupRecovery) {
         "performWrite: Sending write to backup 4.0 | "
         // Write to re-replicate segment 1 replica slot 0 and close it.
         "performWrite: Sending write to backup 4.0 | "
-        "writeSegment: Closing <3.0,1> | "
+        "writeReplica: Closing <3.0,1> | "
         "performWrite: Write RPC finished for replica slot 1 | "
         // All re-replication has been taken care of; bump the epoch number
         // on the coordinator.
@@ -13,7 +13,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <map>
+
 #include "BitOps.h"
+#include "Dispatch.h"
 #include "PerfStats.h"
 #include "ReplicatedSegment.h"
 #include "Segment.h"
@@ -79,6 +82,26 @@ enum { OBEY_SAFETY_CONSTRAINTS = true };
  * \param maxBytesPerWriteRpc
  *      Maximum bytes to send in a single write rpc; can help latency of
  *      GetRecoveryDataRequests by unclogging backups a bit.
+ * \param writeBatcher
+ *      If not NULL, writes are combined with writes for other segments to
+ *      the same backup by this batcher instead of being sent in rpcs of
+ *      their own. Shared among ReplicatedSegments.
+ * \param cleanerPacer
+ *      If not NULL and \a normalLogSegment is false, writes of this
+ *      segment's replicas are paced by it. Shared among ReplicatedSegments.
+ * \param chainReplication
+ *      True means that writes are sent to the first replica's backup only,
+ *      which passes them on to the others, whenever the replicas are in
+ *      step; see buildChain().
+ * \param remoteWrites
+ *      True means that data is written into backups' memory with one-sided
+ *      RDMA writes where possible, and the write rpcs carry none; see
+ *      writeRemotely().
+ * \param erasureCode
+ *      If not NULL, once the segment is closed it is stored as fragments
+ *      encoded with this code, each on a backup of its own, instead of as
+ *      full replicas. Segments that aren't log heads are never replicated
+ *      at all; see performEncode(). Shared among ReplicatedSegments.
  */
 ReplicatedSegment::ReplicatedSegment(Context* context,
                                      TaskQueue& taskQueue,
@@ -96,7 +119,12 @@ ReplicatedSegment::ReplicatedSegment(Context* context,
                                      uint32_t numReplicas,
                                      Tub<CycleCounter<RawMetric>>*
                                                              replicationCounter,
-                                     uint32_t maxBytesPerWriteRpc)
+                                     uint32_t maxBytesPerWriteRpc,
+                                     BackupWriteBatcher* writeBatcher,
+                                     ReplicationPacer* cleanerPacer,
+                                     bool chainReplication,
+                                     bool remoteWrites,
+                                     const ReedSolomon* erasureCode)
     : Task(taskQueue)
     , context(context)
     , backupSelector(backupSelector)
@@ -111,6 +139,10 @@ ReplicatedSegment::ReplicatedSegment(Context* context,
     , masterId(masterId)
     , segmentId(segmentId)
     , maxBytesPerWriteRpc(maxBytesPerWriteRpc)
+    , writeBatcher(writeBatcher)
+    , cleanerPacer(cleanerPacer)
+    , chainReplication(chainReplication)
+    , remoteWrites(remoteWrites)
     , queued(true, 0, 0, false)
     , queuedCertificate()
     , openLen(0)
@@ -120,6 +152,15 @@ ReplicatedSegment::ReplicatedSegment(Context* context,
     , precedingSegmentCloseCommitted(true)
     , precedingSegmentOpenCommitted(true)
     , recoveringFromLostOpenReplicas(false)
+    , copySources()
+    , copiedRanges()
+    , erasureCode(erasureCode)
+    , encoded()
+    , fragments()
+    , fragmentLength(0)
+    , encodedCertificate()
+    , replicasRetired(erasureCode && !normalLogSegment)
+    , fragmentsStale(false)
     , listEntries()
     , replicationCounter(replicationCounter)
     , unopenedStartCycles(Cycles::rdtsc())
@@ -133,6 +174,8 @@ ReplicatedSegment::ReplicatedSegment(Context* context,
     }
     queued.bytes = openLen;
     queuedCertificate = openingWriteCertificate;
+    if (erasureCode)
+        fragments.reset(new Fragment[getFragmentCount()]);
     schedule(); // schedule to replicate the opening data
 }
 
@@ -181,11 +224,29 @@ ReplicatedSegment::free()
     // the checksum stored in the replica metadata keeps this safe; if garbage
     // is sent it will not be used during recovery.
     foreach (auto& replica, replicas) {
-        if (!replica.isActive || !replica.writeRpc)
+        if (!replica.isActive)
             continue;
-        replica.writeRpc->cancel();
-        replica.writeRpc.destroy();
-        --writeRpcsInFlight;
+        if (replica.writeRpc) {
+            replica.writeRpc->cancel();
+            replica.writeRpc.destroy();
+            --writeRpcsInFlight;
+        }
+        if (replica.writeBatch) {
+            replica.writeBatch->cancel(replica.writeBatchPart);
+            replica.writeBatch.reset();
+        }
+        replica.chainPosition = 0;
+    }
+    for (uint32_t i = 0; i < getFragmentCount(); i++) {
+        Fragment& fragment = fragments[i];
+        if (fragment.writeRpc) {
+            fragment.writeRpc->cancel();
+            fragment.writeRpc.destroy();
+            --writeRpcsInFlight;
+        }
+        // Still just a replica, which is freed as such.
+        if (fragment.fromReplica && !replicasRetired)
+            fragment.reset();
     }
 
     // Segment should free itself ASAP. It must not start new write rpcs after
@@ -264,14 +325,77 @@ ReplicatedSegment::close()
     ++metrics->master.segmentCloseCount;
 }
 
+/**
+ * Tell this segment that some of its bytes are exact copies of bytes in
+ * other segments of the log (as the survivor segments the log cleaner
+ * writes are). When the segment is closed, backups that hold a closed
+ * replica of one of those segments are asked to copy the bytes from there,
+ * rather than being sent them again; only the rest of the data goes over
+ * the network (see WireFormat::BackupWriteFromReplicas). Backups that can't
+ * do that are sent all of the data as usual.
+ *
+ * Must be called before close(). The caller must guarantee the bytes are
+ * identical and that the sources won't be freed until this segment has
+ * been synced.
+ *
+ * \param ranges
+ *      The copied ranges, in increasing order of offset and not
+ *      overlapping. Ranges whose source has no closed replicas are ignored.
+ */
+void
+ReplicatedSegment::setSourceRanges(const std::vector<SourceRange>& ranges)
+{
+    Lock _(dataMutex);
+    assert(!queued.close);
+    // Fragments are encoded by this master, so there is nothing to copy.
+    if (replicasRetired)
+        return;
+    // Index in copySources of each source segment.
+    std::map<uint64_t, uint32_t> indexes;
+    for (uint32_t i = 0; i < copySources.size(); i++)
+        indexes[copySources[i].segmentId] = i;
+
+    foreach (const SourceRange& range, ranges) {
+        auto it = indexes.find(range.source->segmentId);
+        if (it == indexes.end()) {
+            it = indexes.insert({range.source->segmentId,
+                                 downCast<uint32_t>(copySources.size())}).first;
+            copySources.emplace_back(range.source->segmentId);
+            // Replicas replaced by fragments are on their way out.
+            foreach (auto& replica, range.source->replicas) {
+                if (replica.isActive && replica.committed.close &&
+                        !range.source->replicasRetired) {
+                    copySources.back().backups.push_back(replica.backupId);
+                }
+            }
+        }
+        uint32_t index = it->second;
+        if (copySources[index].backups.empty())
+            continue;
+
+        if (!copiedRanges.empty()) {
+            CopiedRange& last = copiedRanges.back();
+            if (last.source == index &&
+                    last.offset + last.length == range.offset &&
+                    last.sourceOffset + last.length == range.sourceOffset) {
+                last.length += range.length;
+                continue;
+            }
+        }
+        copiedRanges.emplace_back(range.offset, range.length, index,
+                                  range.sourceOffset);
+    }
+}
+
 /**
  * Respond to a change in cluster configuration by scheduling any work that is
  * needed to restore durability guarantees. Keep in mind a context needs to be
  * provided to actually drive the re-replication (for example,
  * BackupFailureMonitor).
- * If the server is using MinCopysets, we kill all the replicas that belong
- * to the same replication group if any of the group members fails. Otherwise,
- * we just kill the replica that belongs to the failed server.
+ * If the server is using MinCopysets, we kill all the replicas and fragments
+ * that belong to the same replication group if any of the group members
+ * fails. Otherwise, we just kill the replica or fragment that belongs to the
+ * failed server.
  *
  * \param failedId
  *      ServerId of the backup which has failed.
@@ -291,6 +415,10 @@ ReplicatedSegment::handleBackupFailure(ServerId failedId, bool useMinCopysets)
             if (replica.backupId == failedId)
                 replicationGroupFailed = true;
         }
+        for (uint32_t i = 0; i < getFragmentCount(); i++) {
+            if (fragments[i].backupId == failedId)
+                replicationGroupFailed = true;
+        }
     }
 
     bool someOpenReplicaLost = false;
@@ -317,10 +445,31 @@ ReplicatedSegment::handleBackupFailure(ServerId failedId, bool useMinCopysets)
         schedule();
         ++metrics->master.replicaRecoveries;
     }
+    for (uint32_t i = 0; i < getFragmentCount(); i++) {
+        Fragment& fragment = fragments[i];
+        if (!fragment.backupId.isValid())
+            continue;
+        if (!replicationGroupFailed && fragment.backupId != failedId)
+            continue;
+        LOG(DEBUG, "Segment %lu recovering from lost fragment %u which was "
+            "on backup %s", segmentId, i, failedId.toString().c_str());
+        if (fragment.writeRpc)
+            --writeRpcsInFlight;
+        if (fragment.freeRpc)
+            --freeRpcsInFlight;
+        fragment.reset();
+        schedule();
+        ++metrics->master.replicaRecoveries;
+    }
     if (someOpenReplicaLost) {
         ++queued.epoch;
         recoveringFromLostOpenReplicas = true;
     }
+
+    // If the backup that was passing writes on was lost, the other replicas
+    // get them directly instead.
+    if (replicas.numElements > 0 && !replicas[0].writeOutstanding())
+        finishChain(0);
 }
 
 /**
@@ -373,9 +522,17 @@ ReplicatedSegment::handleBackupFailure(ServerId failedId, bool useMinCopysets)
  *      length and certificate. This is sometimes necessary when one thread is
  *      syncing a segment, but does not want to block other threads from
  *      appending to it.
+ *
+ * \param minReplicas
+ *      Return as soon as \a offset bytes have been replicated to this many
+ *      backups, rather than to all of them; the rest of the replicas catch up
+ *      in the background (see ReplicaManager::proceed). Values at least as
+ *      large as the number of replicas, including the default, wait for all
+ *      of them. Ignored when \a offset is not provided.
  */
 void
-ReplicatedSegment::sync(uint32_t offset, SegmentCertificate* certificate)
+ReplicatedSegment::sync(uint32_t offset, SegmentCertificate* certificate,
+        uint32_t minReplicas)
 {
     CycleCounter<RawMetric> _(&metrics->master.replicaManagerTicks);
     TEST_LOG("syncing segment %lu to offset %u", segmentId, offset);
@@ -384,24 +541,8 @@ ReplicatedSegment::sync(uint32_t offset, SegmentCertificate* certificate)
     Tub<Lock> lock;
     lock.construct(dataMutex);
 
-    // Definition of synced changes if this segment isn't durably closed
-    // and is recovering from a lost replica.  In that case the data
-    // the data isn't durable until it has been replicated *along with*
-    // a durable close on the replicas as well *and* any lost, open
-    // replicas have been shot down by setting the replicationEpoch.
-    // Once this flag is cleared those conditions have been met and
-    // it is safe to use the usual definition.
-    if (!recoveringFromLostOpenReplicas) {
-        if (!normalLogSegment || precedingSegmentCloseCommitted) {
-            if (offset == ~0u) {
-                if (getCommitted().close)
-                    return;
-            } else {
-                if (getCommitted().bytes >= offset)
-                    return;
-            }
-        }
-    }
+    if (isSyncedTo(offset, minReplicas))
+        return;
 
     // If the caller did not provide the desired certificate, obtain the
     // latest one and use that.
@@ -421,17 +562,8 @@ ReplicatedSegment::sync(uint32_t offset, SegmentCertificate* certificate)
     uint64_t syncStartTicks = Cycles::rdtsc();
     while (true) {
         taskQueue.performTask();
-        if (!recoveringFromLostOpenReplicas) {
-            if (!normalLogSegment || precedingSegmentCloseCommitted) {
-                if (offset == ~0u) {
-                    if (getCommitted().close)
-                        return;
-                } else {
-                    if (getCommitted().bytes >= offset)
-                        return;
-                }
-            }
-        }
+        if (isSyncedTo(offset, minReplicas))
+            return;
         double waited = Cycles::toSeconds(Cycles::rdtsc() - syncStartTicks);
         if (waited > 10) {
             LOG(WARNING, "Log write sync has taken over 10s; seems to "
@@ -443,6 +575,39 @@ ReplicatedSegment::sync(uint32_t offset, SegmentCertificate* certificate)
     }
 }
 
+/**
+ * Return true if a call to sync() with the same arguments has nothing left
+ * to wait for. Must be called with #dataMutex held.
+ */
+bool
+ReplicatedSegment::isSyncedTo(uint32_t offset, uint32_t minReplicas) const
+{
+    // Definition of synced changes if this segment isn't durably closed
+    // and is recovering from a lost replica.  In that case the data
+    // the data isn't durable until it has been replicated *along with*
+    // a durable close on the replicas as well *and* any lost, open
+    // replicas have been shot down by setting the replicationEpoch.
+    // Once this flag is cleared those conditions have been met and
+    // it is safe to use the usual definition.
+    if (recoveringFromLostOpenReplicas)
+        return false;
+    if (normalLogSegment && !precedingSegmentCloseCommitted)
+        return false;
+    if (offset == ~0u)
+        return getCommitted().close;
+    if (minReplicas < replicas.numElements && !replicasRetired) {
+        // Replicas that are lost or being recreated elsewhere don't hold up
+        // a partial sync, as long as enough of the others have the data.
+        uint32_t count = 0;
+        foreach (auto& replica, replicas) {
+            if (replica.isActive && replica.committed.bytes >= offset)
+                count++;
+        }
+        return count >= minReplicas;
+    }
+    return getCommitted().bytes >= offset;
+}
+
 /**
  * Replace the current in-memory segment this object is providing durability for
  * with a different, but logically identical one, and return the old segment.
@@ -495,6 +660,11 @@ ReplicatedSegment::swapSegment(const Segment* newSegment)
     queued.bytes = segment->getAppendedLength(&queuedCertificate);
     foreach (auto& replica, replicas)
         replica.committed = replica.acked = replica.sent = queued;
+    // Fragments still being written come from #encoded, which doesn't
+    // change, but once it is gone they can no longer be encoded again to
+    // match the ones already written.
+    if (encoded || replicasRetired)
+        fragmentsStale = true;
 
     return oldSegment;
 }
@@ -503,6 +673,8 @@ ReplicatedSegment::swapSegment(const Segment* newSegment)
 
 /**
  * Schedule this task if the number of replicas is greater than zero.
+ * Segments created by the log cleaner are scheduled at low priority, so
+ * that work for the log head, which clients are waiting on, goes first.
  */
 void
 ReplicatedSegment::schedule()
@@ -510,7 +682,7 @@ ReplicatedSegment::schedule()
     if (replicas.empty())
         TEST_LOG("zero replicas: nothing to schedule");
     else
-        Task::schedule();
+        Task::schedule(normalLogSegment ? NORMAL : LOW);
 }
 
 /**
@@ -537,6 +709,8 @@ ReplicatedSegment::performTask()
     if (freeQueued && !recoveringFromLostOpenReplicas) {
         foreach (Replica& replica, replicas)
             performFree(replica);
+        for (uint32_t i = 0; i < getFragmentCount(); i++)
+            performFragmentFree(i);
 
         // We assume that dataMutex is held by the caller so that the
         // scheduled flag is read atomically with performing the destroy.
@@ -546,8 +720,13 @@ ReplicatedSegment::performTask()
             return;
         }
     } else if (!freeQueued) {
-        foreach (Replica& replica, replicas)
-            performWrite(replica);
+        foreach (Replica& replica, replicas) {
+            if (replicasRetired)
+                performFree(replica);
+            else
+                performWrite(replica);
+        }
+        performEncode();
     }
 
     if (unopenedStartCycles != 0) {
@@ -671,7 +850,7 @@ ReplicatedSegment::performFree(Replica& replica)
             schedule();
             return;
         }
-        if (replica.writeRpc) {
+        if (replica.writeOutstanding()) {
             // Impossible by construction. See free().
             assert(false);
         } else {
@@ -702,6 +881,13 @@ ReplicatedSegment::performWrite(Replica& replica)
         return;
     }
 
+    if (replica.chainPosition != 0) {
+        // The write is being passed on by the first replica's backup;
+        // finishChain() settles it once that replica's write completes.
+        schedule();
+        return;
+    }
+
     if (!replica.isActive) {
         // This replica does not exist yet. Choose a backup.
         // Selection of a backup is separated from the send of the open rpc
@@ -709,13 +895,8 @@ ReplicatedSegment::performWrite(Replica& replica)
         // backup unless it is discovered that that backup failed.
         // Not doing so risks the existence a lost open replica which
         // isn't recovered from properly.
-        ServerId constraints[replicas.numElements];
-        uint32_t numConstraints = 0;
-        foreach (auto& constrainingReplica, replicas) {
-            if (constrainingReplica.isActive)
-                constraints[numConstraints++] = constrainingReplica.backupId;
-            assert(numConstraints <= replicas.numElements);
-        }
+        ServerId constraints[replicas.numElements + getFragmentCount()];
+        uint32_t numConstraints = getPlacedBackups(constraints);
         ServerId backupId;
         if (replicaIsPrimary(replica)) {
             backupId = backupSelector.selectPrimary(numConstraints,
@@ -740,12 +921,17 @@ ReplicatedSegment::performWrite(Replica& replica)
         // for scheduling the task.
     }
 
-    if (replica.writeRpc) {
+    if (replica.writeOutstanding()) {
         // This replica has a write request outstanding to a backup.
-        if (replica.writeRpc->isReady()) {
+        if (replica.writeReady()) {
+            // Note whether the write rpc is ours to account for before the
+            // handlers below get a chance to reset the replica.
+            bool batched = bool(replica.writeBatch);
             // Wait for it to complete if it is ready.
             try {
-                replica.writeRpc->wait();
+                uint32_t forwardedMask;
+                uint32_t writeLoad = replica.waitForWrite(&forwardedMask);
+                backupSelector.updateWriteLoad(replica.backupId, writeLoad);
                 TEST_LOG("Write RPC finished for replica slot %ld",
                          &replica - &replicas[0]);
                 if (replica.acked.open && !replica.sent.open) {
@@ -762,6 +948,15 @@ ReplicatedSegment::performWrite(Replica& replica)
                     // constraints during recovery of lost replicas.
                     replica.committed.open = replica.acked.open;
                 }
+                if (remoteWrites && replica.acked.open &&
+                        !replica.writeTargetRequested) {
+                    // The backup has a buffer for the replica now; find out
+                    // if later writes can go straight into it.
+                    replica.writeTargetRequested = true;
+                    replica.writeTargetRpc.construct(context, replica.backupId,
+                                                     masterId, segmentId);
+                }
+                finishChain(forwardedMask);
                 if (getCommitted().open && followingSegment)
                     followingSegment->precedingSegmentOpenCommitted = true;
                 if (getCommitted().close) {
@@ -771,6 +966,10 @@ ReplicatedSegment::performWrite(Replica& replica)
                         // Don't poke at potentially non-existent segments later
                         followingSegment = NULL;
                     }
+                    // Only the closing writes use these; replacements for
+                    // replicas lost later are sent all of the data.
+                    std::vector<CopySource>().swap(copySources);
+                    std::vector<CopiedRange>().swap(copiedRanges);
                 }
             } catch (const ServerNotUpException& e) {
                 // Retry; wait for BackupFailureMonitor to call
@@ -796,14 +995,30 @@ ReplicatedSegment::performWrite(Replica& replica)
                 replica.sent = replica.acked;
                 CoordinatorClient::verifyMembership(context, masterId);
             } catch (const ClientException& e) {
-                LOG(ERROR, "Backup write RPC for segment %lu rejected by "
-                    "%s with status %s",
-                    segmentId, replica.backupId.toString().c_str(),
+                if (!replica.sentFromReplicas) {
+                    LOG(ERROR, "Backup write RPC for segment %lu rejected by "
+                        "%s with status %s",
+                        segmentId, replica.backupId.toString().c_str(),
+                        statusToSymbol(e.status));
+                    throw;
+                }
+                // The backup wrote nothing; send it all of the data instead.
+                LOG(NOTICE, "Backup %s couldn't build its replica of segment "
+                    "%lu from other replicas (status %s); sending the data",
+                    replica.backupId.toString().c_str(), segmentId,
                     statusToSymbol(e.status));
-                throw;
+                replica.sent = replica.acked;
+                replica.copyRejected = true;
+            }
+            // If the write failed, any replicas it was to be passed on to
+            // are written directly instead.
+            finishChain(0);
+            if (batched) {
+                replica.writeBatch.reset();
+            } else {
+                replica.writeRpc.destroy();
+                --writeRpcsInFlight;
             }
-            replica.writeRpc.destroy();
-            --writeRpcsInFlight;
             if (LOG_RECOVERY_REPLICATION_RPC_TIMING && recoveryStart) {
                 LOG(DEBUG, "@%7lu: Replica <%s,%lu,%lu> write <- %7u "
                     "%u rpcs out %s",
@@ -829,7 +1044,7 @@ ReplicatedSegment::performWrite(Replica& replica)
                 return;
             }
             // No outstanding write, but not yet durably open.
-            if (writeRpcsInFlight == MAX_WRITE_RPCS_IN_FLIGHT) {
+            if (writeThrottled(replica)) {
                 RAMCLOUD_CLOG(DEBUG, "Delaying open for segment %lu, "
                         "replica %lu: too many RPCs in flight", segmentId,
                         &replica - &replicas[0]);
@@ -856,14 +1071,7 @@ ReplicatedSegment::performWrite(Replica& replica)
 
             TEST_LOG("Sending open to backup %s",
                      replica.backupId.toString().c_str());
-            replica.writeRpc.construct(context, replica.backupId,
-                                       masterId, segmentId, queued.epoch,
-                                       segment, 0, length, certificateToSend,
-                                       true, false, replicaIsPrimary(replica));
-            if (replicaIsPrimary(replica)) {
-                PerfStats::threadStats.replicationRpcs++;
-            }
-            ++writeRpcsInFlight;
+            sendWrite(replica, 0, length, certificateToSend, true, false);
             if (LOG_RECOVERY_REPLICATION_RPC_TIMING && recoveryStart) {
                 LOG(DEBUG, "@%7lu: Replica <%s,%lu,%lu> write -> %7u+%7u "
                     "%u rpcs out OPEN",
@@ -901,15 +1109,23 @@ ReplicatedSegment::performWrite(Replica& replica)
             SegmentCertificate* certificateToSend = &queuedCertificate;
             replica.sentCertificate = true;
 
+            // If the backup holds bytes this segment copied from others, it
+            // gets the rest in one rpc and builds the replica itself.
+            std::vector<WireFormat::BackupWriteFromReplicas::Piece> pieces;
+            bool fromReplicas = buildPieces(replica, offset, &pieces);
+
             // Breaks atomicity of log entries, but it could happen anyway
             // if a segment gets partially written to disk.
-            if (length > maxBytesPerWriteRpc) {
+            if (!fromReplicas && length > maxBytesPerWriteRpc) {
                 length = maxBytesPerWriteRpc;
                 certificateToSend = NULL;
                 replica.sentCertificate = false;
             }
 
             bool sendClose = queued.close && (offset + length) == queued.bytes;
+            std::vector<Replica*> chain;
+            if (!fromReplicas)
+                buildChain(replica, &chain);
             if (OBEY_SAFETY_CONSTRAINTS &&
                 sendClose &&
                 followingSegment &&
@@ -926,7 +1142,9 @@ ReplicatedSegment::performWrite(Replica& replica)
                 return;
             }
 
-            if (writeRpcsInFlight == MAX_WRITE_RPCS_IN_FLIGHT) {
+            // Writes built from replicas or passed on to other backups
+            // aren't batched, so they always need an rpc slot of their own.
+            if (writeThrottled(replica, fromReplicas || !chain.empty())) {
                 RAMCLOUD_CLOG(DEBUG, "Delaying write to segment %lu, "
                         "replica %lu: too many RPCs in flight", segmentId,
                         &replica - &replicas[0]);
@@ -936,16 +1154,9 @@ ReplicatedSegment::performWrite(Replica& replica)
 
             TEST_LOG("Sending write to backup %s",
                      replica.backupId.toString().c_str());
-            replica.writeRpc.construct(context, replica.backupId, masterId,
-                                       segmentId, queued.epoch,
-                                       segment, offset, length,
-                                       certificateToSend,
-                                       false, sendClose,
-                                       replicaIsPrimary(replica));
-            if (replicaIsPrimary(replica)) {
-                PerfStats::threadStats.replicationRpcs++;
-            }
-            ++writeRpcsInFlight;
+            sendWrite(replica, offset, length, certificateToSend,
+                      false, sendClose, fromReplicas ? &pieces : NULL,
+                      chain.empty() ? NULL : &chain);
             if (LOG_RECOVERY_REPLICATION_RPC_TIMING && recoveryStart) {
                 LOG(DEBUG, "@%7lu: Replica <%s,%lu,%lu> write -> %7u+%7u "
                     "%u rpcs out %s",
@@ -957,6 +1168,10 @@ ReplicatedSegment::performWrite(Replica& replica)
             replica.sent.bytes += length;
             replica.sent.epoch = queued.epoch;
             replica.sent.close = sendClose;
+            foreach (Replica* chained, chain) {
+                chained->sent = replica.sent;
+                chained->sentCertificate = replica.sentCertificate;
+            }
             schedule();
             return;
         } else {
@@ -969,6 +1184,615 @@ ReplicatedSegment::performWrite(Replica& replica)
     assert(false); // Unreachable by construction
 }
 
+/**
+ * Make progress, if possible, in storing a closed segment as Reed-Solomon
+ * fragments (see #erasureCode), each on a backup of its own.
+ *
+ * Segments that aren't log heads are closed before anything needs them to
+ * be durable, so they are never replicated: the fragments are encoded from
+ * #segment and sent as soon as it is closed.
+ *
+ * A log head must be replicated while it is open. Once it is closed and
+ * durably replicated, the backup of each replica is asked to compute one
+ * of the fragments from the replica and keep that instead (see
+ * Fragment::fromReplica), so the data isn't sent again; only the
+ * fragments left over, if there are more fragments than replicas, are
+ * encoded and sent by this master. Once those are durable the replicas
+ * are retired: those being turned into fragments are forgotten, and any
+ * others are freed.
+ *
+ * From then on only the fragments are maintained; lost ones are written
+ * again elsewhere. If future work is required this method automatically
+ * re-schedules this segment for future attention from the ReplicaManager.
+ * \pre freeQueued must be false, otherwise behavior is undefined.
+ */
+void
+ReplicatedSegment::performEncode()
+{
+    if (!erasureCode || !queued.close)
+        return;
+
+    if (replicasRetired && fragmentsStale && !encoded &&
+            !fragmentsDurable()) {
+        // A fragment was lost after swapSegment(), so it can't be encoded
+        // again from #segment to match the others. Go back to full replicas
+        // (once the old ones have been freed), then encode afresh; the
+        // fragments that survive keep the segment recoverable meanwhile.
+        foreach (Replica& replica, replicas) {
+            if (replica.isActive) {
+                schedule();
+                return;
+            }
+        }
+        LOG(NOTICE, "Lost a fragment of segment %lu after it was compacted; "
+            "replicating it again before encoding it", segmentId);
+        replicasRetired = false;
+        fragmentsStale = false;
+        foreach (Replica& replica, replicas)
+            replica.reset(true);
+        for (uint32_t i = 0; i < getFragmentCount(); i++) {
+            fragments[i].committed = false;
+            fragments[i].fromReplica = false;
+        }
+        encoded.reset();
+        schedule();
+        return;
+    }
+
+    if (!replicasRetired) {
+        // Outstanding fragment writes are always collected, but new ones
+        // only start once the replicas are all durably closed.
+        bool start = !recoveringFromLostOpenReplicas &&
+                     getCommitted() == queued;
+        if (start) {
+            uint32_t count = std::min(replicas.numElements,
+                                      getFragmentCount());
+            for (uint32_t i = 0; i < count; i++) {
+                Fragment& fragment = fragments[i];
+                if (fragment.backupId.isValid() || !replicas[i].isActive)
+                    continue;
+                fragment.backupId = replicas[i].backupId;
+                fragment.fromReplica = true;
+            }
+        }
+        for (uint32_t i = 0; i < getFragmentCount(); i++) {
+            if (!fragments[i].fromReplica)
+                performFragmentWrite(i, start);
+        }
+        if (!start || !fragmentsDurable())
+            return;
+
+        LOG(DEBUG, "Segment %lu stored as %u fragments; retiring its "
+            "replicas", segmentId, getFragmentCount());
+        replicasRetired = true;
+        // The backups of these replicas turn them into fragments; the
+        // rest are freed by performTask().
+        for (uint32_t i = 0; i < getFragmentCount(); i++) {
+            if (!fragments[i].fromReplica)
+                continue;
+            foreach (Replica& replica, replicas) {
+                if (replica.isActive &&
+                        replica.backupId == fragments[i].backupId) {
+                    replica.reset();
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < getFragmentCount(); i++)
+        performFragmentWrite(i, true);
+    if (!fragmentsDurable())
+        return;
+
+    const_cast<Segment*>(segment)->closedCommitted = true;
+    if (fragmentsCommitted())
+        encoded.reset();
+}
+
+/**
+ * Make progress, if possible, in durably writing one fragment of a closed
+ * segment to a backup; a helper for performEncode(). If future work is
+ * required this method automatically re-schedules this segment.
+ *
+ * \param index
+ *      Which fragment to write; data fragments come first.
+ * \param start
+ *      False means only an outstanding write is collected; no new one is
+ *      started.
+ */
+void
+ReplicatedSegment::performFragmentWrite(uint32_t index, bool start)
+{
+    Fragment& fragment = fragments[index];
+    if (fragment.committed)
+        return;
+
+    if (fragment.writeRpc) {
+        if (!fragment.writeRpc->isReady()) {
+            schedule();
+            return;
+        }
+        try {
+            fragment.writeRpc->wait();
+            fragment.committed = true;
+            TEST_LOG("Fragment %u of segment %lu written to backup %s",
+                     index, segmentId, fragment.backupId.toString().c_str());
+        } catch (const BackupBadSegmentIdException& e) {
+            if (!fragment.fromReplica) {
+                LOG(ERROR, "Backup fragment write RPC for segment %lu "
+                    "rejected by %s with status %s", segmentId,
+                    fragment.backupId.toString().c_str(),
+                    statusToSymbol(e.status));
+                throw;
+            }
+            // The backup no longer has a matching replica to compute the
+            // fragment from; send it the fragment instead.
+            LOG(NOTICE, "Backup %s couldn't compute fragment %u of segment "
+                "%lu from its replica; sending it",
+                fragment.backupId.toString().c_str(), index, segmentId);
+            fragment.fromReplica = false;
+        } catch (const ServerNotUpException& e) {
+            // Retry; wait for BackupFailureMonitor to call
+            // handleBackupFailure to reset the fragment.
+            LOG(WARNING, "Couldn't write fragment to backup %s; server is "
+                "down", fragment.backupId.toString().c_str());
+        } catch (const BackupOpenRejectedException& e) {
+            // Out of room on the backup; try another one. A backup asked
+            // to compute the fragment still holds the replica, which it
+            // gives up once the fragment is stored, so keep trying there.
+            TEST_LOG("BackupOpenRejectedException");
+            if (!fragment.fromReplica) {
+                if (index == 0)
+                    backupSelector.signalFreedPrimary(fragment.backupId);
+                fragment.backupId = ServerId();
+            }
+        } catch (const CallerNotInClusterException& e) {
+            LOG(WARNING, "Backup fragment write RPC rejected by %s with "
+                "STATUS_CALLER_NOT_IN_CLUSTER",
+                fragment.backupId.toString().c_str());
+            CoordinatorClient::verifyMembership(context, masterId);
+        } catch (const ClientException& e) {
+            LOG(ERROR, "Backup fragment write RPC for segment %lu rejected "
+                "by %s with status %s", segmentId,
+                fragment.backupId.toString().c_str(),
+                statusToSymbol(e.status));
+            throw;
+        }
+        fragment.writeRpc.destroy();
+        --writeRpcsInFlight;
+        if (!fragment.committed)
+            schedule();
+        return;
+    }
+
+    if (!start)
+        return;
+
+    if (!fragment.backupId.isValid()) {
+        // Each fragment needs a backup that holds nothing else of this
+        // segment: backups keep one frame per segment.
+        ServerId constraints[replicas.numElements + getFragmentCount()];
+        uint32_t numConstraints = getPlacedBackups(constraints);
+        // The others are placed relative to the first one placed (with
+        // MinCopysets, in its replication group), which is the primary.
+        if (index != 0 && numConstraints == 0) {
+            schedule();
+            return;
+        }
+        if (index == 0) {
+            fragment.backupId = backupSelector.selectPrimary(numConstraints,
+                                                             constraints);
+        } else {
+            fragment.backupId = backupSelector.selectSecondary(numConstraints,
+                                                               constraints);
+        }
+        if (!fragment.backupId.isValid()) {
+            schedule();
+            return;
+        }
+        LOG(DEBUG, "Placing fragment %u of segment %lu on backup %s",
+            index, segmentId, fragment.backupId.toString().c_str());
+    }
+
+    // Fragments are never needed to make the log head durable, so they
+    // only get half of the rpc slots.
+    if (writeRpcsInFlight >= MAX_WRITE_RPCS_IN_FLIGHT / 2 ||
+            (!normalLogSegment && cleanerPacer && cleanerPacer->mustWait())) {
+        schedule();
+        return;
+    }
+
+    // Backups computing the fragment from their replica are still sent
+    // a checksum of it, so the fragment must be encoded here either way.
+    if (!encoded)
+        encodeFragments();
+    if (!normalLogSegment && cleanerPacer && !fragment.fromReplica)
+        cleanerPacer->sent(fragmentLength);
+    fragment.writeRpc.construct(context, fragment.backupId, masterId,
+                                segmentId, queued.epoch, &encodedCertificate,
+                                index, erasureCode->getDataFragments(),
+                                erasureCode->getParityFragments(), index == 0,
+                                encoded.get() + index * fragmentLength,
+                                fragmentLength, fragment.fromReplica);
+    ++writeRpcsInFlight;
+    schedule();
+}
+
+/**
+ * Make progress, if possible, in freeing a fragment of a segment from its
+ * backup; the fragment counterpart of performFree(). If future work is
+ * required this method automatically re-schedules this segment.
+ * \pre freeQueued must be true, otherwise behavior is undefined.
+ */
+void
+ReplicatedSegment::performFragmentFree(uint32_t index)
+{
+    Fragment& fragment = fragments[index];
+    if (!fragment.backupId.isValid())
+        return;
+
+    if (fragment.freeRpc) {
+        if (!fragment.freeRpc->isReady()) {
+            schedule();
+            return;
+        }
+        try {
+            fragment.freeRpc->wait();
+        } catch (const ServerNotUpException& e) {
+            // See performFree().
+            TEST_LOG("ServerNotUpException thrown");
+        }
+        if (index == 0)
+            backupSelector.signalFreedPrimary(fragment.backupId);
+        fragment.reset();
+        --freeRpcsInFlight;
+        return;
+    }
+
+    if (freeRpcsInFlight == MAX_FREE_RPCS_IN_FLIGHT) {
+        schedule();
+        return;
+    }
+    assert(!fragment.writeRpc); // See free().
+    fragment.freeRpc.construct(context, fragment.backupId, masterId,
+                               segmentId);
+    ++freeRpcsInFlight;
+    schedule();
+}
+
+/**
+ * Encode the closed segment into #encoded: its #queued.bytes are split into
+ * k zero-padded data fragments, followed by the m parity fragments computed
+ * from them.
+ */
+void
+ReplicatedSegment::encodeFragments()
+{
+    uint32_t k = erasureCode->getDataFragments();
+    uint32_t m = erasureCode->getParityFragments();
+    fragmentLength = erasureCode->getFragmentLength(queued.bytes);
+    encoded.reset(new uint8_t[(k + m) * fragmentLength]);
+    segment->copyOut(0, encoded.get(), queued.bytes);
+    memset(encoded.get() + queued.bytes, 0, k * fragmentLength - queued.bytes);
+
+    const void* data[k];
+    void* parity[m];
+    for (uint32_t i = 0; i < k; i++)
+        data[i] = encoded.get() + i * fragmentLength;
+    for (uint32_t i = 0; i < m; i++)
+        parity[i] = encoded.get() + (k + i) * fragmentLength;
+    erasureCode->encode(data, parity, fragmentLength);
+    encodedCertificate = queuedCertificate;
+}
+
+/**
+ * Collect the backups that hold (or are being sent) some replica or
+ * fragment of this segment; none of them may be given another.
+ *
+ * \param[out] backups
+ *      Filled in with the ids; must have room for one per replica and one
+ *      per fragment.
+ * \return
+ *      The number of ids filled in.
+ */
+uint32_t
+ReplicatedSegment::getPlacedBackups(ServerId backups[]) const
+{
+    uint32_t count = 0;
+    foreach (auto& replica, replicas) {
+        if (replica.isActive)
+            backups[count++] = replica.backupId;
+    }
+    for (uint32_t i = 0; i < getFragmentCount(); i++) {
+        if (fragments[i].backupId.isValid())
+            backups[count++] = fragments[i].backupId;
+    }
+    return count;
+}
+
+/**
+ * Return true if a new write to \a replica must wait because too many write
+ * rpcs are already in flight. A write that can join a batch which is
+ * already counted as in flight never has to wait.
+ *
+ * Once half of the rpc slots are in use, writes to a backup that reported
+ * it is overloaded (see BaseBackupSelector::OVERLOADED_WRITE_LOAD) wait as
+ * well: sending them would only add to its backlog, and the slots are better
+ * used by replicas on backups that are keeping up.
+ *
+ * Writes for segments created by the log cleaner are held back further so
+ * that they don't delay writes to the log head: they never take more than
+ * half of the rpc slots, and they are paced by #cleanerPacer, if any.
+ * Replacements for lost replicas aren't paced, since the segment is less
+ * durable than it should be until they are written.
+ *
+ * \param replica
+ *      The replica to be written.
+ * \param ownRpc
+ *      True if the write can't be batched and needs an rpc of its own.
+ */
+bool
+ReplicatedSegment::writeThrottled(Replica& replica, bool ownRpc)
+{
+    if (!normalLogSegment && cleanerPacer && !replica.replacesLostReplica &&
+            cleanerPacer->mustWait()) {
+        return true;
+    }
+    if (!ownRpc && writeBatcher && writeBatcher->hasRoom(replica.backupId))
+        return false;
+    if (writeRpcsInFlight >= MAX_WRITE_RPCS_IN_FLIGHT)
+        return true;
+    if (!normalLogSegment && writeRpcsInFlight >= MAX_WRITE_RPCS_IN_FLIGHT / 2)
+        return true;
+    return writeRpcsInFlight >= MAX_WRITE_RPCS_IN_FLIGHT / 2 &&
+           backupSelector.getWriteLoad(replica.backupId) >=
+               BaseBackupSelector::OVERLOADED_WRITE_LOAD;
+}
+
+/**
+ * Decide which other replicas, if any, the next write to \a replica should
+ * be passed on to by its backup rather than sent to them by this master.
+ * With chain replication enabled this is every other replica that is in
+ * step with the first one: it has durably opened, received just what the
+ * first replica has, and has no write outstanding. Replicas that fall
+ * behind (for instance, replacements for replicas on crashed backups, or
+ * replicas whose backup the write couldn't be passed on to) are written
+ * directly until they catch up, and then rejoin.
+ *
+ * \param replica
+ *      The replica about to be written; only writes to the first replica
+ *      are passed on.
+ * \param[out] chain
+ *      The replicas the write should be passed on to are appended here.
+ */
+void
+ReplicatedSegment::buildChain(Replica& replica, std::vector<Replica*>* chain)
+{
+    if (!chainReplication || &replica != &replicas[0])
+        return;
+    foreach (Replica& other, replicas) {
+        if (&other == &replica || !other.isActive ||
+                other.writeOutstanding() || other.freeRpc ||
+                !other.committed.open || other.sent != replica.sent ||
+                other.acked != other.sent) {
+            continue;
+        }
+        if (chain->size() == WireFormat::BackupWriteChain::MAX_FORWARDS)
+            break;
+        chain->push_back(&other);
+    }
+}
+
+/**
+ * Settle the write to the replicas that the first replica's backup was
+ * asked to pass its write on to, once that write has finished.
+ *
+ * \param forwardedMask
+ *      Identifies the replicas whose backups stored the write; see
+ *      WireFormat::BackupWriteChain::Response. Those are updated as if
+ *      their own rpcs had completed; the rest are written directly next.
+ */
+void
+ReplicatedSegment::finishChain(uint32_t forwardedMask)
+{
+    foreach (Replica& replica, replicas) {
+        if (replica.chainPosition == 0)
+            continue;
+        if (forwardedMask & (1u << (replica.chainPosition - 1))) {
+            replica.acked = replica.sent;
+            if (replica.sentCertificate)
+                replica.committed = replica.acked;
+            else
+                replica.committed.open = replica.acked.open;
+            TEST_LOG("Write passed on to replica slot %ld",
+                     &replica - &replicas[0]);
+        } else {
+            replica.sent = replica.acked;
+        }
+        replica.chainPosition = 0;
+    }
+}
+
+/**
+ * Try to place part of the segment directly in a replica's buffer on its
+ * backup with a one-sided RDMA write (see Transport::Session::writeRemote),
+ * so that the write rpc that follows needn't carry the data. This works
+ * once the backup has said where the buffer is (see Replica::
+ * writeTargetRpc); until then, and if the backup or the transport can't
+ * take such writes, the data is sent in the rpc as usual.
+ *
+ * \param replica
+ *      The replica to write.
+ * \param offset
+ *      Where in the segment the data to write starts.
+ * \param length
+ *      Number of bytes to write.
+ * \return
+ *      True if the data is now on the backup; the caller must still tell
+ *      the backup so with a BackupWrite that has remotelyWritten set.
+ */
+bool
+ReplicatedSegment::writeRemotely(Replica& replica, uint32_t offset,
+                                 uint32_t length)
+{
+    if (replica.writeTargetRpc && replica.writeTargetRpc->isReady()) {
+        try {
+            replica.writeTargetAddress =
+                replica.writeTargetRpc->wait(&replica.writeTargetKey);
+        } catch (const ClientException& e) {
+            // Includes ServerNotUpException; the write rpc will find out
+            // about that too.
+            replica.writeTargetAddress = 0;
+        }
+        replica.writeTargetRpc.destroy();
+    }
+    if (replica.writeTargetAddress == 0 || length == 0)
+        return false;
+
+    Buffer data;
+    segment->appendToBuffer(data, offset, length);
+    Transport::SessionRef session =
+        context->serverList->getSession(replica.backupId);
+    Dispatch::Lock lock(context->dispatch);
+    if (!session->writeRemote(replica.writeTargetAddress + offset,
+                              replica.writeTargetKey, &data, 0, length)) {
+        // Don't try again for this replica.
+        LOG(NOTICE, "Couldn't write replica data of segment %lu to backup "
+            "%s remotely; sending it in rpcs instead", segmentId,
+            replica.backupId.toString().c_str());
+        replica.writeTargetAddress = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Decide whether the rest of a closed segment can be written to a replica
+ * by having its backup copy ranges from its replicas of other segments (see
+ * setSourceRanges()) and, if so, describe how to assemble the data.
+ *
+ * \param replica
+ *      The replica to write.
+ * \param offset
+ *      Where in the segment the write starts; it runs to #queued.bytes.
+ * \param[out] pieces
+ *      Filled in with the pieces of the write if true is returned.
+ * \return
+ *      True if the write should be a BackupWriteFromReplicas: the segment
+ *      is closed, at least one range can be copied on the backup, and the
+ *      bytes still to be sent fit in one rpc.
+ */
+bool
+ReplicatedSegment::buildPieces(Replica& replica, uint32_t offset,
+        std::vector<WireFormat::BackupWriteFromReplicas::Piece>* pieces)
+{
+    if (copiedRanges.empty() || !queued.close ||
+            replica.replacesLostReplica || replica.copyRejected) {
+        return false;
+    }
+
+    uint32_t cursor = offset;
+    uint32_t literalBytes = 0;
+    foreach (const CopiedRange& range, copiedRanges) {
+        if (range.offset < cursor)
+            continue;
+        if (range.offset + range.length > queued.bytes)
+            break;
+        const std::vector<ServerId>& backups =
+            copySources[range.source].backups;
+        if (std::find(backups.begin(), backups.end(), replica.backupId) ==
+                backups.end()) {
+            continue;
+        }
+        if (range.offset > cursor) {
+            WireFormat::BackupWriteFromReplicas::Piece literal =
+                {0, 0, range.offset - cursor};
+            pieces->push_back(literal);
+            literalBytes += literal.length;
+        }
+        WireFormat::BackupWriteFromReplicas::Piece copy =
+            {copySources[range.source].segmentId, range.sourceOffset,
+             range.length};
+        pieces->push_back(copy);
+        cursor = range.offset + range.length;
+    }
+    if (pieces->empty())
+        return false;
+    if (cursor < queued.bytes) {
+        WireFormat::BackupWriteFromReplicas::Piece literal =
+            {0, 0, queued.bytes - cursor};
+        pieces->push_back(literal);
+        literalBytes += literal.length;
+    }
+    if (literalBytes > maxBytesPerWriteRpc) {
+        pieces->clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Start a write to a replica, either in its own rpc or, if batching is
+ * enabled, as part of a batch of writes to the same backup. The arguments
+ * are as for WriteSegmentRpc, except that \a chain lists the replicas (see
+ * buildChain()) whose backups the write is to be passed on to; writes whose
+ * data is assembled from \a pieces or that are passed on are never batched.
+ * Other writes place their data with writeRemotely() if they can, and then
+ * send an rpc of their own without it.
+ */
+void
+ReplicatedSegment::sendWrite(Replica& replica, uint32_t offset,
+                             uint32_t length,
+                             const SegmentCertificate* certificate,
+                             bool open, bool close,
+                             const std::vector<WireFormat::
+                                 BackupWriteFromReplicas::Piece>* pieces,
+                             const std::vector<Replica*>* chain)
+{
+    replica.sentFromReplicas = (pieces != NULL);
+    if (!normalLogSegment && cleanerPacer && !replica.replacesLostReplica) {
+        // Pieces copied on the backup don't cross the network.
+        uint32_t bytes = length;
+        if (pieces) {
+            bytes = 0;
+            foreach (const auto& piece, *pieces) {
+                if (piece.sourceSegmentId == 0)
+                    bytes += piece.length;
+            }
+        }
+        cleanerPacer->sent(bytes);
+    }
+    std::vector<ServerId> forwardTo;
+    if (chain) {
+        foreach (Replica* chained, *chain) {
+            forwardTo.push_back(chained->backupId);
+            chained->chainPosition = downCast<uint32_t>(forwardTo.size());
+            chained->sentFromReplicas = false;
+        }
+    }
+    bool remotelyWritten = remoteWrites && !pieces && !chain &&
+            writeRemotely(replica, offset, length);
+    if (writeBatcher && !pieces && !chain && !remotelyWritten) {
+        replica.writeBatch = writeBatcher->add(replica.backupId, segmentId,
+                                               queued.epoch, segment,
+                                               offset, length, certificate,
+                                               open, close,
+                                               replicaIsPrimary(replica),
+                                               &replica.writeBatchPart);
+    } else {
+        replica.writeRpc.construct(context, replica.backupId, masterId,
+                                   segmentId, queued.epoch, segment,
+                                   offset, length, certificate,
+                                   open, close, replicaIsPrimary(replica),
+                                   pieces, chain ? &forwardTo : NULL,
+                                   remotelyWritten);
+        ++writeRpcsInFlight;
+    }
+    if (replicaIsPrimary(replica)) {
+        PerfStats::threadStats.replicationRpcs++;
+    }
+}
+
 /**
  * Prints a ton of internal state of the replica. Useful for diagnosing why
  * a particular segment's replication is stuck.
@@ -1001,7 +1825,16 @@ ReplicatedSegment::dumpProgress()
             replica.acked.open, replica.acked.bytes, replica.acked.close,
             replica.committed.open, replica.committed.bytes,
             replica.committed.close,
-            bool(replica.writeRpc)));
+            replica.writeOutstanding()));
+    }
+    for (uint32_t i = 0; i < getFragmentCount(); i++) {
+        info.append(format(
+            "  Fragment %u on Backup %s\n"
+            "    committed: %u, from replica: %u, "
+            "write rpc outstanding: %u\n",
+            i, fragments[i].backupId.toString().c_str(),
+            fragments[i].committed, fragments[i].fromReplica,
+            bool(fragments[i].writeRpc)));
     }
     LOG(NOTICE, "\n%s", info.c_str());
 }
@@ -21,10 +21,13 @@
 #include "Common.h"
 #include "BackupClient.h"
 #include "BackupSelector.h"
+#include "BackupWriteBatcher.h"
 #include "BoostIntrusive.h"
 #include "CycleCounter.h"
 #include "UpdateReplicationEpochTask.h"
 #include "RawMetrics.h"
+#include "ReedSolomon.h"
+#include "ReplicationPacer.h"
 #include "Transport.h"
 #include "TaskQueue.h"
 #include "VarLenArray.h"
@@ -74,6 +77,15 @@ enum { LOG_RECOVERY_REPLICATION_RPC_TIMING = false };
  * state changed in a way that may cause them to need to perform work (write(),
  * close(), free(), or host failure).  ReplicatedSegments keep themselves
  * scheduled until they are in the state the log module has requested.
+ *
+ * With erasure coding enabled (see #erasureCode) closed segments are stored
+ * as k + m Reed-Solomon fragments, each on a different backup, instead of as
+ * full replicas; any k of them are enough to recover the segment. Segments
+ * that aren't log heads are encoded and sent as fragments as soon as they
+ * are closed, and never replicated. A log head is replicated as above while
+ * it is open; once it is closed the backups of its replicas turn them into
+ * fragments (see performEncode()). A lost fragment is encoded again and
+ * written elsewhere, in the same failure-driven style.
  */
 class ReplicatedSegment : public Task {
   PUBLIC:
@@ -216,6 +228,50 @@ class ReplicatedSegment : public Task {
         }
     };
 
+    /**
+     * For internal use; a segment that some of this segment's bytes were
+     * copied from, and the backups that held closed replicas of it when
+     * setSourceRanges() was called.
+     */
+    struct CopySource {
+        explicit CopySource(uint64_t segmentId)
+            : segmentId(segmentId)
+            , backups()
+        {}
+
+        /// Id of the source segment.
+        uint64_t segmentId;
+
+        /// Backups holding closed replicas of the source segment.
+        std::vector<ServerId> backups;
+    };
+
+    /**
+     * For internal use; a SourceRange whose source is identified by its
+     * index in #copySources.
+     */
+    struct CopiedRange {
+        CopiedRange(uint32_t offset, uint32_t length, uint32_t source,
+                    uint32_t sourceOffset)
+            : offset(offset)
+            , length(length)
+            , source(source)
+            , sourceOffset(sourceOffset)
+        {}
+
+        /// Offset of the bytes in this segment.
+        uint32_t offset;
+
+        /// Number of bytes copied.
+        uint32_t length;
+
+        /// Index in #copySources of the segment the bytes came from.
+        uint32_t source;
+
+        /// Offset of the bytes in the source segment.
+        uint32_t sourceOffset;
+    };
+
     /**
      * For internal use; stores all state for a single (potentially incomplete)
      * replica of a ReplicatedSegment.
@@ -230,15 +286,28 @@ class ReplicatedSegment : public Task {
             , sent()
             , freeRpc()
             , writeRpc()
+            , writeBatch()
+            , writeBatchPart(0)
+            , chainPosition(0)
+            , writeTargetRpc()
+            , writeTargetRequested(false)
+            , writeTargetAddress(0)
+            , writeTargetKey(0)
             , replacesLostReplica(false)
             , sentCertificate(false)
+            , sentFromReplicas(false)
+            , copyRejected(false)
         {}
 
         ~Replica() {
             if (writeRpc)
                 writeRpc->cancel();
+            if (writeBatch)
+                writeBatch->cancel(writeBatchPart);
             if (freeRpc)
                 freeRpc->cancel();
+            if (writeTargetRpc)
+                writeTargetRpc->cancel();
         }
 
         /**
@@ -254,6 +323,28 @@ class ReplicatedSegment : public Task {
             this->backupId = backupId;
         }
 
+        /// Return true if a write to this replica hasn't been waited for.
+        bool writeOutstanding() const {
+            return writeRpc || writeBatch;
+        }
+
+        /// Return true if waitForWrite() won't block.
+        bool writeReady() {
+            return writeRpc ? writeRpc->isReady() : writeBatch->isReady();
+        }
+
+        /**
+         * Wait for the outstanding write to complete; returns the backup's
+         * write load and throws whatever WriteSegmentRpc::wait() does.
+         * \a forwardedMask is set as by WriteSegmentRpc::wait().
+         */
+        uint32_t waitForWrite(uint32_t* forwardedMask) {
+            *forwardedMask = 0;
+            if (writeRpc)
+                return writeRpc->wait(forwardedMask);
+            return writeBatch->wait(writeBatchPart);
+        }
+
         /**
          * Reset all state associated with this replica to its initial
          * state (unallocated, unopened, no bytes committed).
@@ -314,6 +405,45 @@ class ReplicatedSegment : public Task {
         /// The outstanding write operation to this backup, if any.
         Tub<WriteSegmentRpc> writeRpc;
 
+        /**
+         * If the outstanding write to this backup was instead handed to
+         * the BackupWriteBatcher, the batch carrying it (at most one of
+         * #writeRpc and this is set). The batch, not the replica, accounts
+         * for the write in ReplicatedSegment::writeRpcsInFlight.
+         */
+        std::shared_ptr<BackupWriteBatcher::Batch> writeBatch;
+
+        /// Identifies the write within #writeBatch.
+        uint32_t writeBatchPart;
+
+        /**
+         * If nonzero, the outstanding write to this replica has no rpc of
+         * its own: the backup of the first replica is passing it on (see
+         * buildChain()), and this is the replica's position, counting from
+         * 1, among those it is passed on to.
+         */
+        uint32_t chainPosition;
+
+        /**
+         * Asks the backup where this replica's data may be placed with
+         * one-sided RDMA writes; see writeRemotely(). Only used if
+         * ReplicatedSegment::remoteWrites is set.
+         */
+        Tub<GetWriteTargetRpc> writeTargetRpc;
+
+        /// True once #writeTargetRpc has been started for this replica.
+        bool writeTargetRequested;
+
+        /**
+         * Address on the backup of the first byte of this replica, to which
+         * data may be written with Transport::Session::writeRemote, or 0 if
+         * it isn't known (or the backup doesn't allow it).
+         */
+        uint64_t writeTargetAddress;
+
+        /// Key to present with remote writes to #writeTargetAddress.
+        uint32_t writeTargetKey;
+
         // Fields below survive across failed()/start() calls.
 
         /**
@@ -333,16 +463,107 @@ class ReplicatedSegment : public Task {
          */
         bool sentCertificate;
 
+        /**
+         * True means that the most recent write RPC asked the backup to
+         * build the data from its replicas of other segments (see
+         * #copiedRanges).
+         */
+        bool sentFromReplicas;
+
+        /**
+         * True means that the backup couldn't build this replica from its
+         * replicas of other segments; all data is sent to it instead.
+         */
+        bool copyRejected;
+
         DISALLOW_COPY_AND_ASSIGN(Replica);
     };
 
+    /**
+     * For internal use; stores the state of one Reed-Solomon fragment of a
+     * closed segment (see #erasureCode).
+     */
+    struct Fragment {
+        Fragment()
+            : backupId()
+            , writeRpc()
+            , freeRpc()
+            , committed(false)
+            , fromReplica(false)
+        {}
+
+        ~Fragment() {
+            if (writeRpc)
+                writeRpc->cancel();
+            if (freeRpc)
+                freeRpc->cancel();
+        }
+
+        /// Forget the fragment, as if it had never been placed.
+        void reset() {
+            this->~Fragment();
+            new(this) Fragment;
+        }
+
+        /// Backup the fragment is (being) stored on; invalid if none yet.
+        ServerId backupId;
+
+        /// The outstanding write of the fragment, if any.
+        Tub<WriteFragmentRpc> writeRpc;
+
+        /// The outstanding free of the fragment, if any.
+        Tub<FreeSegmentRpc> freeRpc;
+
+        /// True once the backup has durably stored the fragment.
+        bool committed;
+
+        /**
+         * True if #backupId holds a closed replica of the segment and is
+         * (to be) asked to compute the fragment from it, rather than being
+         * sent the fragment; see performEncode(). The backup keeps the
+         * replica until the fragment is stored, so the segment is durable
+         * there either way.
+         */
+        bool fromReplica;
+
+        DISALLOW_COPY_AND_ASSIGN(Fragment);
+    };
+
 // --- ReplicatedSegment ---
   PUBLIC:
+    /**
+     * Describes bytes of this segment that are an exact copy of bytes in
+     * another (closed) segment of the same log; see setSourceRanges().
+     */
+    struct SourceRange {
+        SourceRange(uint32_t offset, uint32_t length,
+                    const ReplicatedSegment* source, uint32_t sourceOffset)
+            : offset(offset)
+            , length(length)
+            , source(source)
+            , sourceOffset(sourceOffset)
+        {}
+
+        /// Offset of the bytes in this segment.
+        uint32_t offset;
+
+        /// Number of bytes copied.
+        uint32_t length;
+
+        /// The segment the bytes were copied from.
+        const ReplicatedSegment* source;
+
+        /// Offset of the bytes in #source.
+        uint32_t sourceOffset;
+    };
+
     void free();
     bool isSynced() const;
     void close();
+    void setSourceRanges(const std::vector<SourceRange>& ranges);
     void handleBackupFailure(ServerId failedId, bool useMinCopysets);
-    void sync(uint32_t offset = ~0u, SegmentCertificate* certificate = NULL);
+    void sync(uint32_t offset = ~0u, SegmentCertificate* certificate = NULL,
+            uint32_t minReplicas = ~0u);
     const Segment* swapSegment(const Segment* newSegment);
 
     /**
@@ -383,21 +604,82 @@ class ReplicatedSegment : public Task {
                       ServerId masterId,
                       uint32_t numReplicas,
                       Tub<CycleCounter<RawMetric>>* replicationCounter = NULL,
-                      uint32_t maxBytesPerWriteRpc = 1024 * 1024);
+                      uint32_t maxBytesPerWriteRpc = 1024 * 1024,
+                      BackupWriteBatcher* writeBatcher = NULL,
+                      ReplicationPacer* cleanerPacer = NULL,
+                      bool chainReplication = false,
+                      bool remoteWrites = false,
+                      const ReedSolomon* erasureCode = NULL);
     ~ReplicatedSegment();
 
     void schedule();
     void performTask();
     void performFree(Replica& replica);
     void performWrite(Replica& replica);
+    bool writeThrottled(Replica& replica, bool ownRpc = false);
+    void sendWrite(Replica& replica, uint32_t offset, uint32_t length,
+                   const SegmentCertificate* certificate,
+                   bool open, bool close,
+                   const std::vector<WireFormat::BackupWriteFromReplicas::
+                                     Piece>* pieces = NULL,
+                   const std::vector<Replica*>* chain = NULL);
+    void buildChain(Replica& replica, std::vector<Replica*>* chain);
+    void finishChain(uint32_t forwardedMask);
+    bool writeRemotely(Replica& replica, uint32_t offset, uint32_t length);
+    bool buildPieces(Replica& replica, uint32_t offset,
+                     std::vector<WireFormat::BackupWriteFromReplicas::Piece>*
+                         pieces);
+
+    void performEncode();
+    void performFragmentWrite(uint32_t index, bool start);
+    void performFragmentFree(uint32_t index);
+    void encodeFragments();
+    uint32_t getPlacedBackups(ServerId backups[]) const;
 
     void dumpProgress();
+    bool isSyncedTo(uint32_t offset, uint32_t minReplicas) const;
+
+    /// Return the number of fragments (k + m) closed segments are stored as.
+    uint32_t getFragmentCount() const {
+        if (!erasureCode)
+            return 0;
+        return erasureCode->getDataFragments() +
+               erasureCode->getParityFragments();
+    }
+
+    /// Return true if every fragment of the segment is durably stored.
+    bool fragmentsCommitted() const {
+        for (uint32_t i = 0; i < getFragmentCount(); i++) {
+            if (!fragments[i].committed)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Return true if every fragment of the segment is durably stored, or
+     * is being computed by a backup from the closed replica it holds (see
+     * Fragment::fromReplica).
+     */
+    bool fragmentsDurable() const {
+        for (uint32_t i = 0; i < getFragmentCount(); i++) {
+            const Fragment& fragment = fragments[i];
+            if (!fragment.committed &&
+                    !(fragment.fromReplica && fragment.backupId.isValid()))
+                return false;
+        }
+        return true;
+    }
 
     /**
      * Returns the minimum progress any Replica has made in durably
-     * committing data to its chosen backup.
+     * committing data to its chosen backup. Once the replicas have been
+     * replaced by fragments (see #replicasRetired) the segment is either
+     * fully committed, if every fragment is durable, or not at all.
      */
     Progress getCommitted() const {
+        if (replicasRetired)
+            return fragmentsDurable() ? queued : Progress();
         Progress p = queued;
         foreach (auto& replica, replicas) {
             if (replica.isActive)
@@ -498,6 +780,34 @@ class ReplicatedSegment : public Task {
      */
     const uint32_t maxBytesPerWriteRpc;
 
+    /**
+     * If not NULL, writes to backups are handed to this rather than each
+     * being sent in its own rpc. Shared among ReplicatedSegments.
+     */
+    BackupWriteBatcher* writeBatcher;
+
+    /**
+     * If not NULL and this is a segment created by the log cleaner (see
+     * #normalLogSegment), limits the rate at which its replicas are written
+     * so that they don't compete with the log head for bandwidth. Shared
+     * among ReplicatedSegments.
+     */
+    ReplicationPacer* cleanerPacer;
+
+    /**
+     * True means that, when the replicas are in step, writes are sent only
+     * to the first replica's backup, which passes them on to the others;
+     * see buildChain().
+     */
+    const bool chainReplication;
+
+    /**
+     * True means that, once a replica is open, its data is placed directly
+     * in the backup's memory with one-sided RDMA writes if the backup and
+     * transport allow it; see writeRemotely().
+     */
+    const bool remoteWrites;
+
     /**
      * Tracks how much of a segment the log module has made available for
      * replication.
@@ -592,6 +902,60 @@ class ReplicatedSegment : public Task {
      */
     bool recoveringFromLostOpenReplicas;
 
+    /**
+     * Segments that parts of this one are copies of; see setSourceRanges().
+     * Emptied once the segment is durably closed.
+     */
+    std::vector<CopySource> copySources;
+
+    /**
+     * Ranges of this segment, in increasing order of offset, that backups
+     * holding a replica of the source can copy from it rather than receive
+     * from this master; see setSourceRanges(). Emptied once the segment is
+     * durably closed.
+     */
+    std::vector<CopiedRange> copiedRanges;
+
+    /**
+     * If not NULL, once this segment is closed it is stored as fragments
+     * encoded with this code, each on a backup of its own, instead of as
+     * full replicas; see performEncode(). Shared among ReplicatedSegments.
+     */
+    const ReedSolomon* erasureCode;
+
+    /**
+     * The fragments, back to back, each #fragmentLength bytes long. Only
+     * kept while some fragment is being written; see encodeFragments().
+     */
+    std::unique_ptr<uint8_t[]> encoded;
+
+    /// State of each of the getFragmentCount() fragments; NULL if none.
+    std::unique_ptr<Fragment[]> fragments;
+
+    /// Length of each fragment in #encoded.
+    uint32_t fragmentLength;
+
+    /// Certificate of the segment as it was when #encoded was built.
+    SegmentCertificate encodedCertificate;
+
+    /**
+     * True once the segment is stored as fragments alone: from the start
+     * for segments that aren't log heads (see #normalLogSegment), which
+     * are encoded as soon as they are closed, and for a log head once its
+     * replicas have been turned into fragments or freed. From then on only
+     * the fragments are maintained.
+     */
+    bool replicasRetired;
+
+    /**
+     * Set by swapSegment() once the replicas are retired: #segment no
+     * longer holds the bytes the fragments were encoded from, so a lost
+     * fragment can't be encoded again to match the others. Losing one
+     * makes the segment go back to full replicas, and then be encoded
+     * afresh.
+     */
+    bool fragmentsStale;
+
     /// Intrusive list entries for #ReplicaManager::replicatedSegmentList.
     IntrusiveListHook listEntries;
 
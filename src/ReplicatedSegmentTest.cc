@@ -14,9 +14,11 @@
  */
 
 #include <queue>
+#include <unordered_map>
 
 #include "TestUtil.h"
 #include "BackupSelector.h"
+#include "Cycles.h"
 #include "Memory.h"
 #include "PerfStats.h"
 #include "ReplicatedSegment.h"
@@ -46,6 +48,7 @@ struct MockBackupSelector : public BaseBackupSelector {
         : backups()
         , primaryFreed()
         , nextIndex(0)
+        , writeLoads()
     {
         makeSimpleHostList(count);
     }
@@ -68,6 +71,14 @@ struct MockBackupSelector : public BaseBackupSelector {
         primaryFreed.push_back(backupId);
     }
 
+    void updateWriteLoad(const ServerId backupId, uint32_t writeLoad) {
+        writeLoads[backupId] = writeLoad;
+    }
+
+    uint32_t getWriteLoad(const ServerId backupId) {
+        return writeLoads[backupId];
+    }
+
     void makeSimpleHostList(size_t count) {
         for (uint32_t i = 0; i < count; ++i)
             backups.push_back(ServerId(i, 0));
@@ -76,6 +87,7 @@ struct MockBackupSelector : public BaseBackupSelector {
     std::vector<ServerId> backups;
     std::vector<ServerId> primaryFreed;
     size_t nextIndex;
+    std::unordered_map<ServerId, uint32_t> writeLoads;
 };
 
 struct CountingDeleter : public ReplicatedSegment::Deleter {
@@ -99,7 +111,13 @@ struct ReplicatedSegmentTest : public ::testing::Test {
         CreateSegment(ReplicatedSegmentTest* test,
                       ReplicatedSegment* precedingSegment,
                       uint64_t segmentId,
-                      uint32_t numReplicas)
+                      uint32_t numReplicas,
+                      BackupWriteBatcher* writeBatcher = NULL,
+                      bool normalLogSegment = true,
+                      ReplicationPacer* cleanerPacer = NULL,
+                      bool chainReplication = false,
+                      bool remoteWrites = false,
+                      const ReedSolomon* erasureCode = NULL)
             : logSegment(test->data, DATA_LEN)
             , segment()
         {
@@ -117,11 +135,16 @@ struct ReplicatedSegmentTest : public ::testing::Test {
                                               test->dataMutex,
                                               segmentId,
                                               &logSegment,
-                                              true,
+                                              normalLogSegment,
                                               test->masterId,
                                               numReplicas,
                                               NULL,
-                                              MAX_BYTES_PER_WRITE));
+                                              MAX_BYTES_PER_WRITE,
+                                              writeBatcher,
+                                              cleanerPacer,
+                                              chainReplication,
+                                              remoteWrites,
+                                              erasureCode));
             // Set up ordering constraints between this new segment and the
             // prior one in the log.
             if (precedingSegment) {
@@ -208,8 +231,7 @@ struct ReplicatedSegmentTest : public ::testing::Test {
     }
 
     void reset() {
-        taskQueue.tasks.pop();
-        segment->scheduled = false;
+        taskQueue.getNextTask(false);
     }
 
     DISALLOW_COPY_AND_ASSIGN(ReplicatedSegmentTest);
@@ -226,7 +248,7 @@ TEST_F(ReplicatedSegmentTest, constructor) {
     EXPECT_EQ(openLen, segment->queued.bytes);
     EXPECT_TRUE(segment->queued.open);
     ASSERT_FALSE(taskQueue.isIdle());
-    EXPECT_EQ(segment, taskQueue.tasks.front());
+    EXPECT_EQ(segment, taskQueue.peekNextTask());
     reset();
 }
 
@@ -240,7 +262,7 @@ TEST_F(ReplicatedSegmentTest, free) {
     EXPECT_TRUE(segment->freeQueued);
     EXPECT_TRUE(segment->isScheduled());
     ASSERT_FALSE(taskQueue.isIdle());
-    EXPECT_EQ(segment, taskQueue.tasks.front());
+    EXPECT_EQ(segment, taskQueue.peekNextTask());
     reset();
 }
 
@@ -292,12 +314,35 @@ TEST_F(ReplicatedSegmentTest, isSynced) {
     reset();
 }
 
+TEST_F(ReplicatedSegmentTest, isSyncedTo) {
+    segment->replicas[0].isActive = segment->replicas[1].isActive = true;
+    segment->replicas[0].committed = {true, 20, 0, false};
+    segment->replicas[1].committed = {true, 10, 0, false};
+    segment->queued = {true, 20, 0, false};
+    EXPECT_TRUE(segment->isSyncedTo(10, ~0u));
+    EXPECT_FALSE(segment->isSyncedTo(20, ~0u));
+    EXPECT_FALSE(segment->isSyncedTo(20, 2));
+    EXPECT_TRUE(segment->isSyncedTo(20, 1));
+    EXPECT_FALSE(segment->isSyncedTo(~0u, 1));
+
+    // A lost replica holds up full syncs but not partial ones.
+    segment->replicas[0].isActive = false;
+    EXPECT_FALSE(segment->isSyncedTo(20, 1));
+    EXPECT_TRUE(segment->isSyncedTo(10, 1));
+    segment->replicas[0].isActive = true;
+
+    segment->recoveringFromLostOpenReplicas = true;
+    EXPECT_FALSE(segment->isSyncedTo(20, 1));
+    segment->recoveringFromLostOpenReplicas = false;
+    reset();
+}
+
 TEST_F(ReplicatedSegmentTest, close) {
     reset();
     segment->close();
     EXPECT_TRUE(segment->isScheduled());
     ASSERT_FALSE(taskQueue.isIdle());
-    EXPECT_EQ(segment, taskQueue.tasks.front());
+    EXPECT_EQ(segment, taskQueue.peekNextTask());
     EXPECT_TRUE(segment->queued.close);
     reset();
 }
@@ -462,6 +507,31 @@ TEST_F(ReplicatedSegmentTest, handleBackupFailureWithMinCopysets) {
     EXPECT_TRUE(segment->replicas[1].replacesLostReplica);
 }
 
+TEST_F(ReplicatedSegmentTest, handleBackupFailureWithMinCopysetsFragments) {
+    ReedSolomon erasureCode(2, 1);
+    CreateSegment create(this, NULL, segmentId + 1, numReplicas, NULL,
+                         false, NULL, false, false, &erasureCode);
+    ReplicatedSegment* encodedSegment = create.segment.get();
+    reset();
+    encodedSegment->close();
+    transport.setInput("0 0"); // write fragment 0
+    transport.setInput("0 0"); // write fragment 1
+    transport.setInput("0 0"); // write fragment 2
+    taskQueue.performTask();
+    taskQueue.performTask();
+    ASSERT_TRUE(encodedSegment->fragmentsCommitted());
+    EXPECT_EQ(backupId2, encodedSegment->fragments[1].backupId);
+
+    // Should kill all fragments if any one is down.
+    encodedSegment->handleBackupFailure(backupId2, true);
+    for (uint32_t i = 0; i < 3; i++) {
+        EXPECT_FALSE(encodedSegment->fragments[i].backupId.isValid());
+        EXPECT_FALSE(encodedSegment->fragments[i].committed);
+    }
+    EXPECT_TRUE(encodedSegment->isScheduled());
+    EXPECT_NE(encodedSegment->queued, encodedSegment->getCommitted());
+}
+
 TEST_F(ReplicatedSegmentTest, sync) {
     transport.setInput("0 0"); // write
     transport.setInput("0 0"); // write
@@ -473,11 +543,11 @@ TEST_F(ReplicatedSegmentTest, sync) {
     SegmentCertificate certificate;
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true, certificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true, certificate},
                 "abcdefghij", 10));
     transport.clearOutput();
@@ -496,11 +566,11 @@ TEST_F(ReplicatedSegmentTest, sync) {
     segment->sync(openLen + 1); // will wait until after the next send
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 10, false, false, true, true, certificate},
                 "klmnopqrst", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 10,
                  false, false, false, true, certificate},
                 "klmnopqrst ", 10));
@@ -559,9 +629,8 @@ TEST_F(ReplicatedSegmentTest, syncDoubleCheckCrossSegmentOrderingConstraints) {
     // This means newHead will be going first at 'taking turns'
     // with segment.
     {
-        Task* t = taskQueue.tasks.front();
-        taskQueue.tasks.pop();
-        taskQueue.tasks.push(t);
+        Task* t = taskQueue.getNextTask(false);
+        t->schedule();
     }
 
     // Queued order of ops would be:
@@ -580,40 +649,40 @@ TEST_F(ReplicatedSegmentTest, syncDoubleCheckCrossSegmentOrderingConstraints) {
     newHead->sync(newHead->queued.bytes);
 
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true,
                  segmentOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true,
                  segmentOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(2, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 889, 0, 0, 10, true, false, true, true,
                  newHeadOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(3, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 889, 0, 0, 10, true, false, false, true,
                  newHeadOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(4, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 0, false, true, true, true,
                  segmentFinalCertificate}));
     EXPECT_TRUE(transport.outputMatches(5, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 0, false, true, false, true,
                  segmentFinalCertificate}));
     EXPECT_TRUE(transport.outputMatches(6, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 889, 0, 10, 10, false, false, true, true,
                  newHeadFinalCertificate},
                 "klmnopqrst", 10));
     EXPECT_TRUE(transport.outputMatches(7, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 889, 0, 10, 10, false, false, false, true,
                  newHeadFinalCertificate},
                 "klmnopqrst", 10));
@@ -719,7 +788,7 @@ TEST_F(ReplicatedSegmentTest, syncRecoveringFromLostOpenReplicas) {
     SegmentCertificate certificate;
     // Opening primary write, no certificate, new epoch.
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 1, 0, 0, true, false, true, false, certificate},
                 "", 0));
     createSegment->logSegment.getAppendedLength(&certificate);
@@ -727,11 +796,11 @@ TEST_F(ReplicatedSegmentTest, syncRecoveringFromLostOpenReplicas) {
     // No actual data is sent or change to the closed flag. Just need to update
     // the epoch is all.
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 1, 10, 0, false, false, false, true, certificate}));
     // Primary write with data, certificate.
     EXPECT_TRUE(transport.outputMatches(2, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 1, 0, 10, false, false, true, true, certificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(segment->getCommitted().open);
@@ -770,12 +839,12 @@ TEST_F(ReplicatedSegmentTest, syncWaitsForCommittedEvenWhenAcked) {
     taskQueue.performTask(); // reap opens
 
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true,
                  openingCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true,
                  openingCertificate},
                 "abcdefghij", 10));
@@ -791,19 +860,19 @@ TEST_F(ReplicatedSegmentTest, syncWaitsForCommittedEvenWhenAcked) {
 
     SegmentCertificate empty;
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 21, false, false, true, false, empty},
                 "klmnopqrstuvwxyzabcde", 21));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 21, false, false, false, false, empty},
                 "klmnopqrstuvwxyzabcde", 21));
     EXPECT_TRUE(transport.outputMatches(2, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 31, 1, false, true, true, true, certificate},
                 "f", 1));
     EXPECT_TRUE(transport.outputMatches(3, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 31, 1, false, true, false, true, certificate},
                 "f", 1));
 
@@ -839,31 +908,31 @@ TEST_F(ReplicatedSegmentTest, syncOnHeaderWaitsForCloseOfPriorSegment) {
     newHead->sync(newHead->openLen);
 
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true,
                  segmentOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true,
                  segmentOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(2, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 889, 0, 0, 10, true, false, true, true,
                  newHeadOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(3, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 889, 0, 0, 10, true, false, false, true,
                  newHeadOpeningCertificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(4, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 0, false, true, true, true,
                  segmentFinalCertificate}));
     EXPECT_TRUE(transport.outputMatches(5, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 0, false, true, false, true,
                  segmentFinalCertificate}));
 }
@@ -939,11 +1008,11 @@ TEST_F(ReplicatedSegmentTest, swapSegmentThenBackupFailure) {
     newSegment.getAppendedLength(&certificate);
 
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 0, true, false, false, false, empty},
                 "", 0));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 13, false, true, false, true, certificate},
                 "new content!", 13));
 }
@@ -967,6 +1036,16 @@ TEST_F(ReplicatedSegmentTest, scheduleWithZeroReplicas) {
     EXPECT_EQ("schedule: zero replicas: nothing to schedule", TestLog::get());
 }
 
+TEST_F(ReplicatedSegmentTest, scheduleCleanerSegment) {
+    CreateSegment survivor(this, NULL, segmentId + 1, numReplicas,
+                           NULL, false);
+    taskQueue.collectScheduled();
+    ASSERT_EQ(1u, taskQueue.tasks[Task::LOW].size());
+    EXPECT_EQ(survivor.segment.get(), taskQueue.tasks[Task::LOW].front());
+    ASSERT_EQ(1u, taskQueue.tasks[Task::NORMAL].size());
+    EXPECT_EQ(segment, taskQueue.tasks[Task::NORMAL].front());
+}
+
 TEST_F(ReplicatedSegmentTest, performTaskFreeNothingToDo) {
     transport.setInput("0 0"); // write+open first replica
     transport.setInput("0 0"); // write+open second replica
@@ -1011,6 +1090,153 @@ TEST_F(ReplicatedSegmentTest, performTaskWrite) {
     reset();
 }
 
+TEST_F(ReplicatedSegmentTest, performEncode) {
+    ReedSolomon erasureCode(2, 1);
+    CreateSegment create(this, NULL, segmentId + 1, numReplicas, NULL,
+                         true, NULL, false, false, &erasureCode);
+    ReplicatedSegment* encodedSegment = create.segment.get();
+    reset();
+    encodedSegment->close();
+    // Pretend both replicas are durably closed.
+    encodedSegment->replicas[0].start(backupId1);
+    encodedSegment->replicas[1].start(backupId2);
+    foreach (auto& replica, encodedSegment->replicas) {
+        replica.sent = replica.acked = replica.committed =
+            encodedSegment->queued;
+    }
+
+    // The backups of the replicas are to compute the first two fragments
+    // from them; only the third one is sent.
+    transport.setInput("0 0"); // write fragment 2
+    taskQueue.performTask();
+    EXPECT_EQ(1u, writeRpcsInFlight);
+    EXPECT_EQ((openLen + 1) / 2, encodedSegment->fragmentLength);
+    EXPECT_EQ(backupId1, encodedSegment->fragments[0].backupId);
+    EXPECT_TRUE(encodedSegment->fragments[0].fromReplica);
+    EXPECT_EQ(backupId2, encodedSegment->fragments[1].backupId);
+    EXPECT_TRUE(encodedSegment->fragments[1].fromReplica);
+    EXPECT_FALSE(encodedSegment->fragments[1].writeRpc);
+    EXPECT_FALSE(encodedSegment->fragments[2].fromReplica);
+    EXPECT_TRUE(encodedSegment->fragments[2].writeRpc);
+    EXPECT_FALSE(encodedSegment->replicasRetired);
+
+    // With the third fragment durable the replicas are retired, and their
+    // backups are asked to turn them into fragments.
+    transport.setInput("0 0"); // write fragment 0
+    transport.setInput("0 0"); // write fragment 1
+    TestLog::Enable _("performFragmentWrite", NULL);
+    taskQueue.performTask();
+    EXPECT_EQ("performFragmentWrite: Fragment 2 of segment 889 written to "
+                  "backup 0.0", TestLog::get());
+    EXPECT_TRUE(encodedSegment->replicasRetired);
+    EXPECT_FALSE(encodedSegment->replicas[0].isActive);
+    EXPECT_FALSE(encodedSegment->replicas[1].isActive);
+    EXPECT_EQ(2u, writeRpcsInFlight);
+    for (uint32_t i = 0; i < 2; i++) {
+        Buffer& request = encodedSegment->fragments[i].writeRpc->request;
+        EXPECT_TRUE(request.getStart<
+                    WireFormat::BackupWriteFragment::Request>()->fromReplica);
+        EXPECT_EQ(sizeof(WireFormat::BackupWriteFragment::Request),
+                  request.size());
+    }
+    EXPECT_EQ(encodedSegment->queued, encodedSegment->getCommitted());
+    EXPECT_TRUE(encodedSegment->encoded);
+
+    TestLog::reset();
+    taskQueue.performTask();
+    EXPECT_EQ("performFragmentWrite: Fragment 0 of segment 889 written to "
+                  "backup 0.0 | "
+              "performFragmentWrite: Fragment 1 of segment 889 written to "
+                  "backup 1.0", TestLog::get());
+    EXPECT_EQ(0u, writeRpcsInFlight);
+    EXPECT_FALSE(encodedSegment->encoded);
+    EXPECT_EQ(encodedSegment->queued, encodedSegment->getCommitted());
+    // The replicas became fragments, so nothing is left to free.
+    EXPECT_FALSE(encodedSegment->isScheduled());
+}
+
+TEST_F(ReplicatedSegmentTest, performEncodeNotHead) {
+    ReedSolomon erasureCode(2, 1);
+    CreateSegment create(this, NULL, segmentId + 1, numReplicas, NULL,
+                         false, NULL, false, false, &erasureCode);
+    ReplicatedSegment* encodedSegment = create.segment.get();
+    EXPECT_TRUE(encodedSegment->replicasRetired);
+    reset();
+    create.logSegment.head = openLen + 10;
+
+    // Nothing is replicated while the segment is open.
+    encodedSegment->schedule();
+    taskQueue.performTask();
+    EXPECT_EQ(0u, writeRpcsInFlight);
+    EXPECT_FALSE(encodedSegment->replicas[0].isActive);
+    EXPECT_FALSE(encodedSegment->replicas[1].isActive);
+
+    encodedSegment->close();
+    transport.setInput("0 0"); // write fragment 0
+    transport.setInput("0 0"); // write fragment 1
+    transport.setInput("0 0"); // write fragment 2
+    taskQueue.performTask();
+    EXPECT_EQ(3u, writeRpcsInFlight);
+    EXPECT_EQ((openLen + 10 + 1) / 2, encodedSegment->fragmentLength);
+    for (uint32_t i = 0; i < 3; i++) {
+        EXPECT_FALSE(encodedSegment->fragments[i].fromReplica);
+        EXPECT_TRUE(encodedSegment->fragments[i].writeRpc);
+    }
+    EXPECT_FALSE(encodedSegment->replicas[0].isActive);
+    EXPECT_FALSE(create.logSegment.closedCommitted);
+    EXPECT_FALSE(encodedSegment->isSynced());
+
+    taskQueue.performTask();
+    EXPECT_EQ(0u, writeRpcsInFlight);
+    EXPECT_TRUE(encodedSegment->fragmentsCommitted());
+    EXPECT_FALSE(encodedSegment->encoded);
+    EXPECT_TRUE(create.logSegment.closedCommitted);
+    EXPECT_TRUE(encodedSegment->isSynced());
+}
+
+TEST_F(ReplicatedSegmentTest, performFragmentWriteFromReplicaRejected) {
+    ReedSolomon erasureCode(1, 1);
+    CreateSegment create(this, NULL, segmentId + 1, numReplicas, NULL,
+                         true, NULL, false, false, &erasureCode);
+    ReplicatedSegment* encodedSegment = create.segment.get();
+    reset();
+    encodedSegment->close();
+    encodedSegment->replicas[0].start(backupId1);
+    encodedSegment->replicas[1].start(backupId2);
+    foreach (auto& replica, encodedSegment->replicas) {
+        replica.sent = replica.acked = replica.committed =
+            encodedSegment->queued;
+    }
+
+    transport.setInput("12 0"); // write fragment 0 - bad segment id
+    transport.setInput("0 0"); // write fragment 1
+    taskQueue.performTask();
+    EXPECT_TRUE(encodedSegment->replicasRetired);
+    EXPECT_EQ(2u, writeRpcsInFlight);
+
+    // The first backup had no matching replica, so it is sent the data.
+    taskQueue.performTask();
+    EXPECT_FALSE(encodedSegment->fragments[0].fromReplica);
+    EXPECT_FALSE(encodedSegment->fragments[0].committed);
+    EXPECT_FALSE(encodedSegment->fragments[0].writeRpc);
+    EXPECT_TRUE(encodedSegment->fragments[1].committed);
+    EXPECT_FALSE(encodedSegment->isSynced());
+
+    transport.setInput("0 0"); // write fragment 0 again
+    taskQueue.performTask();
+    ASSERT_TRUE(encodedSegment->fragments[0].writeRpc);
+    Buffer& request = encodedSegment->fragments[0].writeRpc->request;
+    EXPECT_FALSE(request.getStart<
+                 WireFormat::BackupWriteFragment::Request>()->fromReplica);
+    EXPECT_EQ(sizeof(WireFormat::BackupWriteFragment::Request) +
+              encodedSegment->fragmentLength, request.size());
+    EXPECT_EQ(backupId1, encodedSegment->fragments[0].backupId);
+
+    taskQueue.performTask();
+    EXPECT_TRUE(encodedSegment->fragmentsCommitted());
+    EXPECT_FALSE(encodedSegment->encoded);
+}
+
 TEST_F(ReplicatedSegmentTest, updateSegmentUnopenedCycles) {
     segment->unopenedStartCycles = 1000;
     PerfStats::threadStats.segmentUnopenedCycles = 500;
@@ -1081,17 +1307,17 @@ TEST_F(ReplicatedSegmentTest, performWriteRecoveringFromLostOpenReplicas) {
     SegmentCertificate certificate;
     // Atomic re-replication open.
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 1, 0, 0, true, false, true, false, certificate},
                 "", 0));
     // Surviving replica gets epoch refreshed.
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 1, 10, 0, false, false, false, true, certificate}));
     // Re-replication write
     EXPECT_TRUE(transport.outputMatches(2, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 1, 0, 10, false, false, true, true, certificate},
                 "abcdefghij", 10));
     transport.clearOutput();
@@ -1108,11 +1334,11 @@ TEST_F(ReplicatedSegmentTest, performWriteRecoveringFromLostOpenReplicas) {
     taskQueue.performTask(); // send closes
     // Atomic close.
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 1, 10, 0, false, true, true, true, certificate}));
     // Normal close.
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 1, 10, 0, false, true, false, true, certificate}));
     transport.clearOutput();
     taskQueue.performTask(); // reap closes
@@ -1137,7 +1363,7 @@ TEST_F(ReplicatedSegmentTest, performFreeRpcIsReady) {
     segment->replicas[0].freeRpc.construct(&context, backupId1,
                                            masterId, segmentId);
     freeRpcsInFlight = 2;
-    EXPECT_STREQ("sendRequest: 0x1001c 0 0 999 0 888 0",
+    EXPECT_STREQ("sendRequest: 0x1001c 0 0 0 0 999 0 888 0",
                  transport.outputLog.c_str());
     segment->performFree(segment->replicas[0]);
     EXPECT_FALSE(segment->replicas[0].isActive);
@@ -1205,6 +1431,57 @@ TEST_F(ReplicatedSegmentTest, performFreeStartRpc) {
     reset();
 }
 
+TEST_F(ReplicatedSegmentTest, performWriteBatched) {
+    reset(); // Only the segments below take part.
+    backupSelector.backups = { backupId1 };
+    BackupWriteBatcher batcher(&context, taskQueue, &masterId,
+                               writeRpcsInFlight, 2);
+    CreateSegment first(this, NULL, 10, 1, &batcher);
+    CreateSegment second(this, NULL, 11, 1, &batcher);
+    transport.setInput("0 0 2 0 0"); // batch of two opens
+
+    taskQueue.performTask(); // first joins a new batch
+    EXPECT_TRUE(transport.output.empty());
+    EXPECT_TRUE(first.segment->replicas[0].writeBatch);
+    EXPECT_EQ(1u, writeRpcsInFlight);
+
+    taskQueue.performTask(); // second fills the batch, which is then sent
+    ASSERT_EQ(1u, transport.output.size());
+    Buffer& request = transport.output[0].second;
+    EXPECT_EQ(BACKUP_WRITE_BATCH,
+              request.getStart<BackupWriteBatch::Request>()->common.opcode);
+    EXPECT_EQ(2u, request.getStart<BackupWriteBatch::Request>()->count);
+    EXPECT_EQ(1u, writeRpcsInFlight);
+
+    taskQueue.performTask(); // batcher; nothing left to send
+    taskQueue.performTask(); // first reaps its open
+    EXPECT_TRUE(first.segment->replicas[0].committed.open);
+    EXPECT_FALSE(first.segment->replicas[0].writeOutstanding());
+    EXPECT_EQ(1u, writeRpcsInFlight);
+    taskQueue.performTask(); // second reaps its open
+    EXPECT_TRUE(second.segment->replicas[0].committed.open);
+    EXPECT_EQ(0u, writeRpcsInFlight);
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteBatchedSentAfterOnePass) {
+    reset();
+    backupSelector.backups = { backupId1 };
+    BackupWriteBatcher batcher(&context, taskQueue, &masterId,
+                               writeRpcsInFlight, 2);
+    CreateSegment first(this, NULL, 10, 1, &batcher);
+    transport.setInput("0 0 1 0");
+
+    taskQueue.performTask(); // open joins a new batch
+    EXPECT_TRUE(transport.output.empty());
+    taskQueue.performTask(); // batcher sends the partial batch
+    ASSERT_EQ(1u, transport.output.size());
+    EXPECT_EQ(1u, transport.output[0].second.
+                  getStart<BackupWriteBatch::Request>()->count);
+    taskQueue.performTask();
+    EXPECT_TRUE(first.segment->replicas[0].committed.open);
+    EXPECT_EQ(0u, writeRpcsInFlight);
+}
+
 TEST_F(ReplicatedSegmentTest, performWriteTooManyInFlight) {
     SegmentCertificate openingCertificate;
     createSegment->logSegment.getAppendedLength(&openingCertificate);
@@ -1236,7 +1513,7 @@ TEST_F(ReplicatedSegmentTest, performWriteTooManyInFlight) {
     writeRpcsInFlight = ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT - 1;
     taskQueue.performTask(); // retry writes since a slot freed up
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 10, false, false, true, true,
                  openingCertificate},
                 "klmnopqrst", 10));
@@ -1251,7 +1528,7 @@ TEST_F(ReplicatedSegmentTest, performWriteTooManyInFlight) {
 
     taskQueue.performTask(); // reap write and send the second replica's rpc
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 10, false, false, false,
                  true, openingCertificate},
                 "klmnopqrst", 10));
@@ -1270,6 +1547,72 @@ TEST_F(ReplicatedSegmentTest, performWriteTooManyInFlight) {
     EXPECT_EQ(0u, deleter.count);
 }
 
+TEST_F(ReplicatedSegmentTest, performWriteRecordsWriteLoad) {
+    transport.setInput("0 80"); // open
+    transport.setInput("0 10"); // open
+
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens
+    EXPECT_TRUE(segment->replicas[1].committed.open);
+    EXPECT_EQ(80u, backupSelector.writeLoads[backupId1]);
+    EXPECT_EQ(10u, backupSelector.writeLoads[backupId2]);
+}
+
+TEST_F(ReplicatedSegmentTest, writeThrottled) {
+    ReplicatedSegment::Replica& replica = segment->replicas[0];
+    replica.backupId = backupId1;
+    backupSelector.writeLoads[backupId1] =
+        BaseBackupSelector::OVERLOADED_WRITE_LOAD;
+
+    writeRpcsInFlight = ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT / 2 - 1;
+    EXPECT_FALSE(segment->writeThrottled(replica));
+
+    // Overloaded backups give way once half the rpc slots are taken.
+    writeRpcsInFlight = ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT / 2;
+    EXPECT_TRUE(segment->writeThrottled(replica));
+    backupSelector.writeLoads[backupId1] =
+        BaseBackupSelector::OVERLOADED_WRITE_LOAD - 1;
+    EXPECT_FALSE(segment->writeThrottled(replica));
+
+    writeRpcsInFlight = ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT;
+    EXPECT_TRUE(segment->writeThrottled(replica));
+    writeRpcsInFlight = 0;
+}
+
+TEST_F(ReplicatedSegmentTest, writeThrottled_cleanerSegment) {
+    Cycles::mockCyclesPerSec = 1e09;
+    Cycles::mockTscValue = 1000;
+    ReplicationPacer pacer(1000000);
+    CreateSegment survivor(this, NULL, segmentId + 1, 1, NULL, false, &pacer);
+    ReplicatedSegment::Replica& replica = survivor.segment->replicas[0];
+    replica.backupId = backupId1;
+    segment->replicas[0].backupId = backupId1;
+
+    // Writes for the cleaner leave half of the rpc slots to the log head.
+    writeRpcsInFlight = ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT / 2 - 1;
+    EXPECT_FALSE(survivor.segment->writeThrottled(replica));
+    writeRpcsInFlight = ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT / 2;
+    EXPECT_TRUE(survivor.segment->writeThrottled(replica));
+    EXPECT_FALSE(segment->writeThrottled(segment->replicas[0]));
+    writeRpcsInFlight = 0;
+
+    // They also wait for the pacer, unless they replace a lost replica.
+    survivor.segment->sendWrite(replica, 0, openLen, NULL, true, false);
+    replica.writeRpc.destroy();
+    writeRpcsInFlight = 0;
+    EXPECT_EQ(10000 - openLen, pacer.credit);
+    pacer.sent(10000);
+    EXPECT_TRUE(survivor.segment->writeThrottled(replica));
+    replica.replacesLostReplica = true;
+    EXPECT_FALSE(survivor.segment->writeThrottled(replica));
+    replica.replacesLostReplica = false;
+    Cycles::mockTscValue += 10000000;
+    EXPECT_FALSE(survivor.segment->writeThrottled(replica));
+
+    Cycles::mockCyclesPerSec = 0;
+    Cycles::mockTscValue = 0;
+}
+
 TEST_F(ReplicatedSegmentTest, performWriteOpen) {
     transport.setInput("0 0"); // write
     transport.setInput("0 0"); // write
@@ -1291,11 +1634,11 @@ TEST_F(ReplicatedSegmentTest, performWriteOpen) {
     SegmentCertificate certificate;
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true, certificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true, certificate},
                 "abcdefghij", 10));
 
@@ -1324,7 +1667,7 @@ TEST_F(ReplicatedSegmentTest, performWriteOpenTooManyInFlight) {
     SegmentCertificate certificate;
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true, certificate},
                 "abcdefghij", 10));
     EXPECT_EQ(ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT, writeRpcsInFlight);
@@ -1338,7 +1681,7 @@ TEST_F(ReplicatedSegmentTest, performWriteOpenTooManyInFlight) {
 
     taskQueue.performTask(); // reap write and send the second replica's rpc
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true, certificate},
                 "abcdefghij", 10));
     EXPECT_EQ(ReplicatedSegment::MAX_WRITE_RPCS_IN_FLIGHT, writeRpcsInFlight);
@@ -1401,11 +1744,11 @@ TEST_F(ReplicatedSegmentTest, performWriteRpcFailed) {
     SegmentCertificate certificate;
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 0, 10, true, false, true, true, certificate},
                 "abcdefghij", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true, certificate},
                 "abcdefghij", 10));
     transport.clearOutput();
@@ -1429,7 +1772,7 @@ TEST_F(ReplicatedSegmentTest, performWriteRpcFailed) {
 
     taskQueue.performTask();  // resend second open request
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 0, 10, true, false, false, true, certificate},
                 "abcdefghij", 10));
     transport.clearOutput();
@@ -1440,11 +1783,11 @@ TEST_F(ReplicatedSegmentTest, performWriteRpcFailed) {
     createSegment->logSegment.getAppendedLength(&certificate);
     taskQueue.performTask();  // send close requests
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 10, false, true, true, true, certificate},
                 "klmnopqrst", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 10, false, true, false, true, certificate},
                 "klmnopqrst", 10));
     transport.clearOutput();
@@ -1469,7 +1812,7 @@ TEST_F(ReplicatedSegmentTest, performWriteRpcFailed) {
 
     taskQueue.performTask();  // resend first close request
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 10, false, true, true, true, certificate},
                 "klmnopqrst", 10));
     transport.clearOutput();
@@ -1504,12 +1847,12 @@ TEST_F(ReplicatedSegmentTest, performWriteDataLargerThanLimit) {
 
     SegmentCertificate certificate;
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 21, false, false, true, false,
                  certificate},
                 "klmnopqrstuvwxyzabcde", 21));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 21, false, false, false, false,
                  certificate},
                 "klmnopqrstuvwxyzabcde", 21));
@@ -1527,12 +1870,12 @@ TEST_F(ReplicatedSegmentTest, performWriteDataLargerThanLimit) {
 
     createSegment->logSegment.getAppendedLength(&certificate);
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 31, 10, false, true, true, true,
                  certificate},
                 "fghijklmno", 10));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 31, 10, false, true, false, true,
                  certificate},
                 "fghijklmno", 10));
@@ -1567,12 +1910,12 @@ TEST_F(ReplicatedSegmentTest, performWriteClosedButLongerThanMaxTxLimit) {
     taskQueue.performTask(); // send second round
 
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 10, 21, false, false, true, false,
                  emptyCertificate},
                 "klmnopqrstuvwxyzabcde", 21));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 10, 21, false, false, false, false,
                  emptyCertificate},
                 "klmnopqrstuvwxyzabcde", 21));
@@ -1586,11 +1929,11 @@ TEST_F(ReplicatedSegmentTest, performWriteClosedButLongerThanMaxTxLimit) {
     taskQueue.performTask(); // send third (closing) round
 
     EXPECT_TRUE(transport.outputMatches(0, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 0},
                  999, 888, 0, 31, 1, false, true, true, true, certificate},
                 "f", 1));
     EXPECT_TRUE(transport.outputMatches(1, MockTransport::SEND_REQUEST,
-        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 1},
+        WrReq{{BACKUP_WRITE, BACKUP_SERVICE, 0, 0, 1},
                  999, 888, 0, 31, 1, false, true, false, true, certificate},
                 "f", 1));
     EXPECT_TRUE(segment->isScheduled());
@@ -1876,6 +2219,263 @@ TEST_F(ReplicatedSegmentTest, performWriteUnexpectedClientException) {
     reset();
 }
 
+TEST_F(ReplicatedSegmentTest, setSourceRanges) {
+    CreateSegment source(this, NULL, 777, numReplicas);
+    source.segment->replicas[0].start(backupId1);
+    source.segment->replicas[0].committed.close = true;
+    source.segment->replicas[1].start(backupId2); // still open
+    CreateSegment unreplicated(this, NULL, 776, numReplicas);
+
+    ReplicatedSegment* s = source.segment.get();
+    segment->setSourceRanges({{10, 20, s, 30},
+                              {30, 5, s, 50},  // continues the first
+                              {35, 5, unreplicated.segment.get(), 0},
+                              {40, 5, s, 0}});
+    ASSERT_EQ(2u, segment->copySources.size());
+    EXPECT_EQ(777u, segment->copySources[0].segmentId);
+    ASSERT_EQ(1u, segment->copySources[0].backups.size());
+    EXPECT_EQ(backupId1, segment->copySources[0].backups[0]);
+    EXPECT_TRUE(segment->copySources[1].backups.empty());
+    ASSERT_EQ(2u, segment->copiedRanges.size());
+    EXPECT_EQ(10u, segment->copiedRanges[0].offset);
+    EXPECT_EQ(25u, segment->copiedRanges[0].length);
+    EXPECT_EQ(40u, segment->copiedRanges[1].offset);
+    EXPECT_EQ(0u, segment->copiedRanges[1].sourceOffset);
+    reset();
+    reset();
+    reset();
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteFromReplicas) {
+    reset(); // Only the closing writes are of interest.
+    CreateSegment source(this, NULL, 777, numReplicas);
+    reset();
+    source.segment->replicas[0].start(backupId1);
+    source.segment->replicas[0].committed.close = true;
+    segment->setSourceRanges({{openLen, 20, source.segment.get(), 30}});
+    createSegment->logSegment.head = openLen + 30;
+    segment->close();
+
+    transport.setInput("0 0"); // open first replica
+    transport.setInput("0 0"); // open second replica
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens
+    transport.clearOutput();
+    transport.setInput("0 0"); // write first replica from replicas
+    transport.setInput("0 0"); // write second replica
+    taskQueue.performTask();
+
+    // The first backup holds the source: only 10 bytes need to be sent,
+    // and the whole replica is written in one rpc.
+    ASSERT_EQ(2u, transport.output.size());
+    Buffer& request = transport.output[0].second;
+    auto* reqHdr = request.getStart<BackupWriteFromReplicas::Request>();
+    EXPECT_EQ(BACKUP_WRITE_FROM_REPLICAS, reqHdr->common.opcode);
+    EXPECT_EQ(openLen, reqHdr->offset);
+    EXPECT_EQ(30u, reqHdr->length);
+    EXPECT_TRUE(reqHdr->close);
+    EXPECT_TRUE(reqHdr->certificateIncluded);
+    EXPECT_EQ(2u, reqHdr->pieceCount);
+    EXPECT_EQ(sizeof(*reqHdr) + 2 * sizeof(BackupWriteFromReplicas::Piece) +
+              10, request.size());
+    EXPECT_TRUE(segment->replicas[0].sentFromReplicas);
+    EXPECT_EQ(openLen + 30, segment->replicas[0].sent.bytes);
+
+    // The second doesn't, so it gets the data as usual.
+    EXPECT_EQ(BACKUP_WRITE, transport.output[1].second.
+                  getStart<WrReq>()->common.opcode);
+    EXPECT_EQ(uint32_t(MAX_BYTES_PER_WRITE),
+              transport.output[1].second.getStart<WrReq>()->length);
+    reset();
+    reset();
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteFromReplicasRejected) {
+    TestLog::Enable _(performWriteFilter);
+    reset();
+    CreateSegment source(this, NULL, 777, numReplicas);
+    reset();
+    source.segment->replicas[0].start(backupId1);
+    source.segment->replicas[0].committed.close = true;
+    source.segment->replicas[1].start(backupId2);
+    source.segment->replicas[1].committed.close = true;
+    segment->setSourceRanges({{openLen, 20, source.segment.get(), 30}});
+    createSegment->logSegment.head = openLen + 20;
+    segment->close();
+
+    transport.setInput("0 0"); // open first replica
+    transport.setInput("0 0"); // open second replica
+    transport.setInput("12"); // first backup can't find the source
+    transport.setInput("0 0"); // write second replica from replicas
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens
+    taskQueue.performTask(); // send writes
+    TestLog::reset();
+    taskQueue.performTask(); // reap writes
+    EXPECT_EQ("performWrite: Backup 0.0 couldn't build its replica of "
+              "segment 888 from other replicas (status "
+              "STATUS_BACKUP_BAD_SEGMENT_ID); sending the data | "
+              "performWrite: Write RPC finished for replica slot 1",
+              TestLog::get());
+    EXPECT_TRUE(segment->replicas[0].copyRejected);
+    EXPECT_EQ(openLen, segment->replicas[0].sent.bytes);
+    EXPECT_TRUE(segment->replicas[1].committed.close);
+
+    transport.clearOutput();
+    transport.setInput("0 0"); // write first replica
+    taskQueue.performTask();
+    ASSERT_EQ(1u, transport.output.size());
+    EXPECT_EQ(BACKUP_WRITE, transport.output[0].second.
+                  getStart<WrReq>()->common.opcode);
+    reset();
+    reset();
+}
+
+namespace {
+bool chainFilter(string s) {
+    return s == "performWrite" || s == "finishChain";
+}
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteChained) {
+    TestLog::Enable _(chainFilter);
+    reset();
+    CreateSegment chained(this, NULL, 777, numReplicas, NULL, true, NULL,
+                          true);
+    ReplicatedSegment* segment = chained.segment.get();
+    transport.setInput("0 0"); // open first replica
+    transport.setInput("0 0"); // open second replica
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens
+    transport.clearOutput();
+
+    // Opens go to each backup; once both replicas are open the rest of
+    // the data goes to the first backup only.
+    chained.logSegment.head = openLen + 10;
+    segment->close();
+    transport.setInput("0 0 1"); // first backup passed the write on
+    taskQueue.performTask();
+    ASSERT_EQ(1u, transport.output.size());
+    Buffer& request = transport.output[0].second;
+    auto* reqHdr = request.getStart<BackupWriteChain::Request>();
+    EXPECT_EQ(BACKUP_WRITE_CHAIN, reqHdr->common.opcode);
+    EXPECT_EQ(openLen, reqHdr->offset);
+    EXPECT_EQ(10u, reqHdr->length);
+    EXPECT_TRUE(reqHdr->close);
+    EXPECT_TRUE(reqHdr->primary);
+    EXPECT_EQ(1u, reqHdr->forwardCount);
+    EXPECT_EQ(backupId2.getId(),
+              *request.getOffset<uint64_t>(sizeof32(*reqHdr)));
+    EXPECT_EQ(sizeof(*reqHdr) + sizeof(uint64_t) + 10, request.size());
+    EXPECT_EQ(1u, segment->replicas[1].chainPosition);
+    EXPECT_FALSE(segment->replicas[1].writeOutstanding());
+    EXPECT_EQ(openLen + 10, segment->replicas[1].sent.bytes);
+    EXPECT_EQ(1u, writeRpcsInFlight);
+
+    TestLog::reset();
+    taskQueue.performTask(); // reap the write
+    EXPECT_EQ("performWrite: Write RPC finished for replica slot 0 | "
+              "finishChain: Write passed on to replica slot 1",
+              TestLog::get());
+    EXPECT_EQ(0u, segment->replicas[1].chainPosition);
+    EXPECT_TRUE(segment->replicas[1].committed.close);
+    EXPECT_TRUE(segment->getCommitted().close);
+    EXPECT_TRUE(segment->isSynced());
+    reset();
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteRemoteWritesFallBack) {
+    reset();
+    CreateSegment remote(this, NULL, 777, numReplicas, NULL, true, NULL,
+                         false, true);
+    ReplicatedSegment* segment = remote.segment.get();
+    transport.setInput("0 0"); // open first replica
+    transport.setInput("0 0"); // open second replica
+    transport.setInput("0 4096 0 7"); // first backup's write target
+    transport.setInput("0 0 0 0"); // second can't be written remotely
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens, ask for write targets
+    EXPECT_TRUE(segment->replicas[0].writeTargetRequested);
+    EXPECT_TRUE(segment->replicas[1].writeTargetRequested);
+    transport.clearOutput();
+
+    TestLog::Enable _;
+    remote.logSegment.head = openLen + 10;
+    segment->close();
+    transport.setInput("0 0");
+    transport.setInput("0 0");
+    taskQueue.performTask();
+    // MockTransport can't write remotely, so the data goes in the rpcs.
+    EXPECT_NE(string::npos, TestLog::get().find(
+        "writeRemotely: Couldn't write replica data of segment 777"));
+    EXPECT_FALSE(segment->replicas[0].writeTargetRpc);
+    EXPECT_EQ(0u, segment->replicas[0].writeTargetAddress);
+    EXPECT_EQ(0u, segment->replicas[1].writeTargetAddress);
+    ASSERT_EQ(2u, transport.output.size());
+    foreach (auto& output, transport.output) {
+        const WrReq* reqHdr = output.second.getStart<WrReq>();
+        EXPECT_FALSE(reqHdr->remotelyWritten);
+        EXPECT_EQ(sizeof(*reqHdr) + 10, output.second.size());
+    }
+
+    taskQueue.performTask(); // reap the writes
+    EXPECT_TRUE(segment->isSynced());
+    reset();
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteChainedNotPassedOn) {
+    reset();
+    CreateSegment chained(this, NULL, 777, numReplicas, NULL, true, NULL,
+                          true);
+    ReplicatedSegment* segment = chained.segment.get();
+    transport.setInput("0 0"); // open first replica
+    transport.setInput("0 0"); // open second replica
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens
+
+    chained.logSegment.head = openLen + 10;
+    segment->close();
+    transport.setInput("0 0 0"); // second backup didn't get the write
+    transport.setInput("0 0"); // write second replica directly
+    taskQueue.performTask(); // send the write to the first backup
+    transport.clearOutput();
+    taskQueue.performTask(); // reap it, write the second replica
+    EXPECT_TRUE(segment->replicas[0].committed.close);
+    EXPECT_EQ(0u, segment->replicas[1].chainPosition);
+    ASSERT_EQ(1u, transport.output.size());
+    EXPECT_EQ(BACKUP_WRITE, transport.output[0].second.
+                  getStart<WrReq>()->common.opcode);
+    EXPECT_TRUE(segment->replicas[1].writeRpc);
+
+    taskQueue.performTask(); // reap the direct write
+    EXPECT_TRUE(segment->replicas[1].committed.close);
+    reset();
+}
+
+TEST_F(ReplicatedSegmentTest, performWriteChainedFirstBackupFailed) {
+    reset();
+    CreateSegment chained(this, NULL, 777, numReplicas, NULL, true, NULL,
+                          true);
+    ReplicatedSegment* segment = chained.segment.get();
+    transport.setInput("0 0"); // open first replica
+    transport.setInput("0 0"); // open second replica
+    taskQueue.performTask(); // send opens
+    taskQueue.performTask(); // reap opens
+
+    chained.logSegment.head = openLen + 10;
+    segment->close();
+    taskQueue.performTask(); // send the write to the first backup
+    EXPECT_EQ(1u, segment->replicas[1].chainPosition);
+
+    // The second replica no longer waits on the lost backup.
+    segment->handleBackupFailure(backupId1, false);
+    EXPECT_FALSE(segment->replicas[0].isActive);
+    EXPECT_EQ(0u, segment->replicas[1].chainPosition);
+    EXPECT_EQ(openLen, segment->replicas[1].sent.bytes);
+    EXPECT_EQ(0u, writeRpcsInFlight);
+    reset();
+}
+
 TEST_F(ReplicatedSegmentTest, performWriteEnsureDurableOpensOrdered) {
     CreateSegment createSegment(this, segment, segmentId + 1, numReplicas);
     auto newHead = createSegment.segment.get();
@@ -1885,9 +2485,8 @@ TEST_F(ReplicatedSegmentTest, performWriteEnsureDurableOpensOrdered) {
     // This means newHead will be going first at 'taking turns'
     // with segment.
     {
-        Task* t = taskQueue.tasks.front();
-        taskQueue.tasks.pop();
-        taskQueue.tasks.push(t);
+        Task* t = taskQueue.getNextTask(false);
+        t->schedule();
     }
 
     TestLog::Enable _(performWriteFilter);
@@ -0,0 +1,72 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Cycles.h"
+#include "ReplicationPacer.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a ReplicationPacer; it starts out with a full bucket.
+ *
+ * \param bytesPerSecond
+ *      Long-term rate at which writes may send data; must not be 0.
+ */
+ReplicationPacer::ReplicationPacer(uint64_t bytesPerSecond)
+    : bytesPerSecond(bytesPerSecond)
+    , credit(static_cast<double>(bytesPerSecond) * BURST_SECONDS)
+    , lastRefill(Cycles::rdtsc())
+{
+    assert(bytesPerSecond > 0);
+}
+
+/**
+ * Return true if a write must be put off because the data sent recently
+ * has used up the credit; it should be retried later.
+ */
+bool
+ReplicationPacer::mustWait()
+{
+    refill();
+    return credit < 0;
+}
+
+/**
+ * Spend credit for a write that is being sent.
+ *
+ * \param bytes
+ *      Number of bytes of replica data the write carries.
+ */
+void
+ReplicationPacer::sent(uint32_t bytes)
+{
+    refill();
+    credit -= bytes;
+}
+
+/**
+ * Add the credit that has accrued since the last call.
+ */
+void
+ReplicationPacer::refill()
+{
+    uint64_t now = Cycles::rdtsc();
+    double rate = static_cast<double>(bytesPerSecond);
+    credit = std::min(rate * BURST_SECONDS,
+                      credit + rate * Cycles::toSeconds(now - lastRefill));
+    lastRefill = now;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,65 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_REPLICATIONPACER_H
+#define RAMCLOUD_REPLICATIONPACER_H
+
+#include "Common.h"
+
+namespace RAMCloud {
+
+/**
+ * Limits the rate at which a master sends replica data for the log
+ * cleaner's survivor segments to backups, so that replicating the output of
+ * a cleaning pass doesn't arrive at the backups (and use up the master's
+ * network bandwidth) in one burst that delays the writes clients are
+ * waiting on. Shared by all the ReplicatedSegments of a ReplicaManager.
+ *
+ * This is a token bucket: credit accrues at the configured rate, up to
+ * #BURST_SECONDS worth, and each write spends as much as it sends. A write
+ * may start whenever the credit isn't negative, so writes larger than the
+ * bucket are never stuck; they simply delay the ones after them.
+ *
+ * Like the rest of the replication module, this class relies on the caller
+ * holding ReplicaManager::dataMutex.
+ */
+class ReplicationPacer {
+  PUBLIC:
+    explicit ReplicationPacer(uint64_t bytesPerSecond);
+    bool mustWait();
+    void sent(uint32_t bytes);
+
+  PRIVATE:
+    void refill();
+
+    /// Most credit that can accrue, in seconds' worth of #bytesPerSecond.
+    static constexpr double BURST_SECONDS = 0.01;
+
+    /// Rate at which credit accrues.
+    const uint64_t bytesPerSecond;
+
+    /// Bytes that may still be sent before writes have to wait; negative
+    /// after a write larger than the remaining credit.
+    double credit;
+
+    /// Cycles::rdtsc() at the last refill().
+    uint64_t lastRefill;
+
+    DISALLOW_COPY_AND_ASSIGN(ReplicationPacer);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_REPLICATIONPACER_H
@@ -0,0 +1,68 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "Cycles.h"
+#include "ReplicationPacer.h"
+
+namespace RAMCloud {
+
+class ReplicationPacerTest : public ::testing::Test {
+  public:
+    ReplicationPacerTest()
+    {
+        Cycles::mockCyclesPerSec = 1e09;
+        Cycles::mockTscValue = 1000;
+    }
+
+    ~ReplicationPacerTest()
+    {
+        Cycles::mockCyclesPerSec = 0;
+        Cycles::mockTscValue = 0;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(ReplicationPacerTest);
+};
+
+TEST_F(ReplicationPacerTest, constructor) {
+    ReplicationPacer pacer(1000000);
+    EXPECT_EQ(10000, pacer.credit);
+    EXPECT_EQ(1000u, pacer.lastRefill);
+    EXPECT_FALSE(pacer.mustWait());
+}
+
+TEST_F(ReplicationPacerTest, mustWait) {
+    ReplicationPacer pacer(1000000);
+    pacer.sent(15000);
+    EXPECT_TRUE(pacer.mustWait());
+
+    // 4 ms brings back 4000 bytes of credit: still 1000 short.
+    Cycles::mockTscValue += 4000000;
+    EXPECT_TRUE(pacer.mustWait());
+    Cycles::mockTscValue += 1000000;
+    EXPECT_FALSE(pacer.mustWait());
+}
+
+TEST_F(ReplicationPacerTest, refill_capsBurst) {
+    ReplicationPacer pacer(1000000);
+    pacer.sent(5000);
+    Cycles::mockTscValue += 1000000000;
+    pacer.refill();
+    EXPECT_EQ(10000, pacer.credit);
+    EXPECT_EQ(1000001000u, pacer.lastRefill);
+}
+
+}  // namespace RAMCloud
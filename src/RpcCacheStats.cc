@@ -0,0 +1,403 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Common.h"
+#include "PerfStats.h"
+#include "RpcCacheStats.h"
+#include "ServerId.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+__thread RpcCacheStats::ThreadStats* RpcCacheStats::threadStats = NULL;
+SpinLock RpcCacheStats::mutex("RpcCacheStats");
+std::vector<RpcCacheStats::ThreadStats*> RpcCacheStats::registeredStats;
+std::atomic<uint32_t> RpcCacheStats::sampleInterval(0);
+bool RpcCacheStats::loggedFailure = false;
+RpcCacheStats::Reading* RpcCacheStats::mockReading = NULL;
+
+/**
+ * While sampling is turned off (or the counters can't be opened), a thread
+ * checks whether that has changed once every this many requests.
+ */
+static const uint32_t RECHECK_INTERVAL = 1000;
+
+/**
+ * Construct a ThreadStats with no counters open; the next request will be
+ * sampled.
+ */
+RpcCacheStats::ThreadStats::ThreadStats()
+    : fds()
+    , slots()
+    , countdown(1)
+    , start()
+    , opcodes()
+{
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        fds[i] = -1;
+        slots[i] = -1;
+    }
+}
+
+/**
+ * Worker threads call this method just before executing each request to
+ * find out whether the request should be measured; if so, the current
+ * contents of the thread's counters are saved.
+ *
+ * \return
+ *      True means the request is being sampled, and finishSample must be
+ *      called when it completes.
+ */
+bool
+RpcCacheStats::startSample()
+{
+    ThreadStats* stats = threadStats;
+    if (expect_false(stats == NULL)) {
+        if (sampleInterval.load(std::memory_order_relaxed) == 0)
+            return false;
+        stats = new ThreadStats;
+        openCounters(stats);
+        threadStats = stats;
+        std::lock_guard<SpinLock> lock(mutex);
+        registeredStats.push_back(stats);
+    }
+    if (expect_true(stats->countdown > 1)) {
+        stats->countdown--;
+        return false;
+    }
+    uint32_t interval = sampleInterval.load(std::memory_order_relaxed);
+    if ((interval == 0) || (stats->slots[LLC_MISSES] < 0)) {
+        stats->countdown = RECHECK_INTERVAL;
+        return false;
+    }
+    stats->countdown = interval;
+    return readCounters(stats, &stats->start);
+}
+
+/**
+ * Worker threads call this method after executing a request for which
+ * startSample returned true; it adds the counts for the request to the
+ * totals for its opcode.
+ *
+ * \param opcode
+ *      The request's opcode.
+ */
+void
+RpcCacheStats::finishSample(WireFormat::Opcode opcode)
+{
+    ThreadStats* stats = threadStats;
+    Reading end;
+    if (!readCounters(stats, &end))
+        return;
+
+    // If the kernel multiplexed the counters while the request executed,
+    // they only saw part of it; drop the sample rather than guess.
+    if ((end.timeRunning - stats->start.timeRunning) !=
+            (end.timeEnabled - stats->start.timeEnabled))
+        return;
+
+    OpcodeStats* opcodeStats = stats->opcodes[opcode].load();
+    if (expect_false(opcodeStats == NULL)) {
+        opcodeStats = new OpcodeStats;
+        stats->opcodes[opcode].store(opcodeStats);
+    }
+    uint64_t counts[EVENT_COUNT];
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        int slot = stats->slots[i];
+        counts[i] = (slot < 0) ? 0 :
+                end.values[slot] - stats->start.values[slot];
+        opcodeStats->events[i] += counts[i];
+    }
+    opcodeStats->samples++;
+
+    PerfStats::threadStats.rpcCacheSamples++;
+    PerfStats::threadStats.rpcLlcMisses += counts[LLC_MISSES];
+    PerfStats::threadStats.rpcRemoteAccesses += counts[REMOTE_ACCESSES];
+    PerfStats::threadStats.rpcInstructions += counts[INSTRUCTIONS];
+}
+
+/**
+ * Choose how many requests are sampled.
+ *
+ * \param interval
+ *      Each worker thread will measure one out of this many requests; 0
+ *      turns sampling off. Threads that haven't sampled a request yet
+ *      open their counters when they see a nonzero value.
+ */
+void
+RpcCacheStats::setSampleInterval(uint32_t interval)
+{
+    sampleInterval.store(interval);
+}
+
+/**
+ * Add up the statistics of all threads and append them to a buffer; this
+ * is the response to the GET_RPC_CACHE_STATS server control. The result is
+ * a uint16_t opcode for each opcode that has been sampled, each followed
+ * by its OpcodeStats.
+ *
+ * \param buffer
+ *      The statistics are appended here.
+ */
+void
+RpcCacheStats::collect(Buffer* buffer)
+{
+    Collection total;
+    {
+        std::lock_guard<SpinLock> lock(mutex);
+        foreach (ThreadStats* thread, registeredStats) {
+            for (uint16_t i = 0; i < WireFormat::ILLEGAL_RPC_TYPE; i++) {
+                OpcodeStats* stats = thread->opcodes[i].load();
+                if (stats == NULL)
+                    continue;
+                OpcodeStats& sum = total[i];
+                sum.samples += stats->samples;
+                for (int event = 0; event < EVENT_COUNT; event++)
+                    sum.events[event] += stats->events[event];
+            }
+        }
+    }
+    foreach (Collection::value_type& entry, total) {
+        buffer->emplaceAppend<uint16_t>(entry.first);
+        buffer->appendCopy(&entry.second);
+    }
+}
+
+/**
+ * Parse statistics returned by collect().
+ *
+ * \param buffer
+ *      Holds the statistics.
+ * \param offset
+ *      Offset of the statistics in \a buffer.
+ * \param length
+ *      Number of bytes of statistics.
+ * \param[out] stats
+ *      Contents are replaced with the parsed statistics.
+ * \return
+ *      False if the statistics were malformed.
+ */
+bool
+RpcCacheStats::parse(Buffer* buffer, uint32_t offset, uint32_t length,
+        Collection* stats)
+{
+    stats->clear();
+    uint32_t end = offset + length;
+    while (offset < end) {
+        const uint16_t* opcode = buffer->getOffset<uint16_t>(offset);
+        if (opcode == NULL)
+            return false;
+        offset += sizeof32(*opcode);
+        const OpcodeStats* opcodeStats =
+                buffer->getOffset<OpcodeStats>(offset);
+        if (opcodeStats == NULL)
+            return false;
+        offset += sizeof32(*opcodeStats);
+        (*stats)[*opcode] = *opcodeStats;
+    }
+    return offset == end;
+}
+
+/**
+ * Given the responses to two calls to CoordinatorClient::serverControlAll
+ * with GET_RPC_CACHE_STATS, format the cache behavior of the requests
+ * sampled between them.
+ *
+ * \param first
+ *      Response from the earlier call.
+ * \param second
+ *      Response from the later call.
+ * \return
+ *      A multi-line string, with a line for each opcode that each server
+ *      sampled in the interval, giving the average LLC misses, bytes read
+ *      from DRAM, remote-node loads and instructions per request, and the
+ *      LLC misses per thousand instructions. It ends in a newline
+ *      character.
+ */
+string
+RpcCacheStats::printClusterCacheStats(Buffer* first, Buffer* second)
+{
+    std::vector<Collection> before, after;
+    parseCluster(first, &before);
+    parseCluster(second, &after);
+
+    string result = format("%-28s %10s %12s %12s %12s %12s %8s\n", "",
+            "Samples", "LLC miss/RPC", "DRAM B/RPC", "Remote/RPC",
+            "Instrs/RPC", "MPKI");
+    for (size_t server = 0; server < after.size(); server++) {
+        bool printedServer = false;
+        foreach (Collection::value_type& entry, after[server]) {
+            OpcodeStats& stats = entry.second;
+            if (server < before.size()) {
+                Collection::iterator earlier =
+                        before[server].find(entry.first);
+                if (earlier != before[server].end()) {
+                    stats.samples -= earlier->second.samples;
+                    for (int i = 0; i < EVENT_COUNT; i++)
+                        stats.events[i] -= earlier->second.events[i];
+                }
+            }
+            if (stats.samples == 0)
+                continue;
+            if (!printedServer) {
+                result.append(format("Server index %lu:\n", server));
+                printedServer = true;
+            }
+            double samples = static_cast<double>(stats.samples);
+            double misses = static_cast<double>(stats.events[LLC_MISSES]);
+            double instructions =
+                    static_cast<double>(stats.events[INSTRUCTIONS]);
+            result.append(format("  %-26s %10lu %12.1f %12.0f %12.1f "
+                    "%12.0f %8.2f\n",
+                    WireFormat::opcodeSymbol(entry.first), stats.samples,
+                    misses / samples, misses * CACHE_LINE_BYTES / samples,
+                    static_cast<double>(stats.events[REMOTE_ACCESSES]) /
+                    samples, instructions / samples,
+                    (instructions > 0) ? 1000 * misses / instructions : 0.0));
+        }
+    }
+    return result;
+}
+
+/**
+ * Open the hardware counters for the current thread. The events are
+ * opened as a single group, so that they can all be read with one system
+ * call and are always scheduled onto the hardware together. Events that
+ * this machine can't count are left out; if the group leader (LLC_MISSES)
+ * can't be opened, nothing will be measured on this thread.
+ *
+ * \param stats
+ *      The current thread's statistics; its fds and slots are filled in.
+ */
+void
+RpcCacheStats::openCounters(ThreadStats* stats)
+{
+    if (mockReading != NULL) {
+        for (int i = 0; i < EVENT_COUNT; i++)
+            stats->slots[i] = i;
+        return;
+    }
+
+    struct EventConfig {
+        uint32_t type;
+        uint64_t config;
+        const char* name;
+    };
+    static const EventConfig configs[EVENT_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC misses"},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_NODE |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "remote-node loads"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    };
+
+    int nextSlot = 0;
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = configs[i].type;
+        attr.config = configs[i].config;
+        attr.read_format = PERF_FORMAT_GROUP |
+                PERF_FORMAT_TOTAL_TIME_ENABLED |
+                PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // Count this thread on whichever core it runs; the first event
+        // opened becomes the group leader.
+        int fd = downCast<int>(syscall(__NR_perf_event_open, &attr, 0, -1,
+                stats->fds[LLC_MISSES], 0));
+        if (fd < 0) {
+            std::lock_guard<SpinLock> lock(mutex);
+            if (!loggedFailure) {
+                LOG(NOTICE, "Can't count %s with hardware performance "
+                        "counters (%s); %s", configs[i].name,
+                        strerror(errno), (i == LLC_MISSES)
+                        ? "RPC cache statistics won't be collected"
+                        : "it will be reported as 0");
+                loggedFailure = true;
+            }
+            if (i == LLC_MISSES)
+                return;
+            continue;
+        }
+        stats->fds[i] = fd;
+        stats->slots[i] = nextSlot++;
+    }
+}
+
+/**
+ * Read all of the current thread's counters.
+ *
+ * \param stats
+ *      The current thread's statistics.
+ * \param[out] reading
+ *      Filled in with the counters' current values.
+ * \return
+ *      False if the counters couldn't be read.
+ */
+bool
+RpcCacheStats::readCounters(ThreadStats* stats, Reading* reading)
+{
+    if (mockReading != NULL) {
+        *reading = *mockReading;
+        return true;
+    }
+    ssize_t bytes = read(stats->fds[LLC_MISSES], reading, sizeof(*reading));
+    return bytes >= static_cast<ssize_t>(offsetof(Reading, values));
+}
+
+/**
+ * Divide the response to serverControlAll(GET_RPC_CACHE_STATS) among the
+ * servers it came from.
+ *
+ * \param rawData
+ *      Response buffer from a call to CoordinatorClient::serverControlAll.
+ * \param[out] results
+ *      Filled in (possibly sparsely) with the statistics of each server:
+ *      entry i holds the statistics for the server whose ServerId has
+ *      indexNumber i. Servers whose statistics were malformed are left
+ *      empty.
+ */
+void
+RpcCacheStats::parseCluster(Buffer* rawData,
+        std::vector<Collection>* results)
+{
+    results->clear();
+    uint32_t offset = sizeof(WireFormat::ServerControlAll::Response);
+    while (offset < rawData->size()) {
+        WireFormat::ServerControl::Response* header =
+                rawData->getOffset<WireFormat::ServerControl::Response>(offset);
+        offset += sizeof32(*header);
+        if ((header == NULL) ||
+                ((offset + header->outputLength) > rawData->size())) {
+            break;
+        }
+        uint32_t i = ServerId(header->serverId).indexNumber();
+        if (i >= results->size()) {
+            results->resize(i+1);
+        }
+        if (!parse(rawData, offset, header->outputLength, &results->at(i)))
+            results->at(i).clear();
+        offset += header->outputLength;
+    }
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,171 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_RPCCACHESTATS_H
+#define RAMCLOUD_RPCCACHESTATS_H
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "Buffer.h"
+#include "SpinLock.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+/**
+ * Measures the cache behavior of the RPCs a server executes, using the
+ * processor's hardware performance counters (via perf_event_open). One out
+ * of every few requests on each worker thread is sampled: the thread's
+ * counters are read just before and just after the request executes, and
+ * the differences are added to per-opcode totals. This shows, for example,
+ * whether a change to the layout of the hash table or the log actually
+ * reduces the number of cache misses per read in production.
+ *
+ * The counters are private to each worker thread, so they include only
+ * the work done by the thread itself while executing the request. Reading
+ * them costs a system call, which is why only a sample of requests is
+ * measured (see setSampleInterval). If the kernel doesn't allow access to
+ * the counters (e.g. in many virtual machines), nothing is recorded.
+ *
+ * The GET_RPC_CACHE_STATS server control returns the per-opcode totals
+ * (see collect()); the totals over all opcodes also appear in PerfStats.
+ */
+class RpcCacheStats {
+  PUBLIC:
+    /// The hardware events counted for each sampled request.
+    enum Event {
+        /// Last-level cache misses. Each one brings a cache line in from
+        /// DRAM, so this also gives the bytes read from memory.
+        LLC_MISSES = 0,
+
+        /// Loads that missed in the caches and were served from memory
+        /// attached to a different NUMA node.
+        REMOTE_ACCESSES,
+
+        /// Instructions executed.
+        INSTRUCTIONS,
+
+        EVENT_COUNT
+    };
+
+    /// Totals for one opcode over all of its sampled requests.
+    struct OpcodeStats {
+        OpcodeStats()
+            : samples(0)
+            , events()
+        {}
+
+        /// Number of requests that were measured.
+        uint64_t samples;
+
+        /// The sum of each Event's count over those requests.
+        uint64_t events[EVENT_COUNT];
+    };
+
+    /// Statistics for all of the opcodes that have been sampled, keyed by
+    /// opcode.
+    typedef std::map<uint16_t, OpcodeStats> Collection;
+
+    /// Bytes brought in from memory by each last-level cache miss.
+    static const uint32_t CACHE_LINE_BYTES = 64;
+
+    static bool startSample();
+    static void finishSample(WireFormat::Opcode opcode);
+    static void setSampleInterval(uint32_t interval);
+    static void collect(Buffer* buffer);
+    static bool parse(Buffer* buffer, uint32_t offset, uint32_t length,
+            Collection* stats);
+    static string printClusterCacheStats(Buffer* first, Buffer* second);
+
+  PRIVATE:
+    /// The contents of a thread's counters at one instant, in the
+    /// PERF_FORMAT_GROUP layout returned by read().
+    struct Reading {
+        /// Number of counters in the group.
+        uint64_t count;
+
+        /// Total time the group has been enabled, in nanoseconds.
+        uint64_t timeEnabled;
+
+        /// Total time the group has actually been counting. This is less
+        /// than timeEnabled if the kernel had to multiplex the hardware
+        /// among more counters than it has.
+        uint64_t timeRunning;
+
+        /// The value of each counter that could be opened, in the order
+        /// they were opened.
+        uint64_t values[EVENT_COUNT];
+    };
+
+    /// The counters and statistics of a single thread.
+    struct ThreadStats {
+        ThreadStats();
+
+        /// File descriptors for the counters of each Event, or -1 for
+        /// events that couldn't be opened. fds[LLC_MISSES] leads the group.
+        int fds[EVENT_COUNT];
+
+        /// For each Event, its index in Reading::values, or -1 if it isn't
+        /// being counted. If slots[LLC_MISSES] is -1, nothing is measured.
+        int slots[EVENT_COUNT];
+
+        /// The next request is sampled when this counts down to 1.
+        uint32_t countdown;
+
+        /// The counters at the start of the request being sampled.
+        Reading start;
+
+        /// Totals for each opcode; entries are allocated the first time
+        /// a request with that opcode is sampled.
+        std::atomic<OpcodeStats*> opcodes[WireFormat::ILLEGAL_RPC_TYPE];
+
+        DISALLOW_COPY_AND_ASSIGN(ThreadStats);
+    };
+
+    static void openCounters(ThreadStats* stats);
+    static bool readCounters(ThreadStats* stats, Reading* reading);
+    static void parseCluster(Buffer* rawData,
+            std::vector<Collection>* results);
+
+    /// Statistics for the current thread; NULL until it is first asked
+    /// whether to sample a request.
+    static __thread ThreadStats* threadStats;
+
+    /// Protects #registeredStats.
+    static SpinLock mutex;
+
+    /// The statistics of every thread that has sampled requests. These are
+    /// never freed, so that samples aren't lost when threads exit.
+    static std::vector<ThreadStats*> registeredStats;
+
+    /// Each worker thread samples one out of this many requests; 0 means
+    /// sampling is turned off.
+    static std::atomic<uint32_t> sampleInterval;
+
+    /// Set to true once a failure to open the counters has been logged,
+    /// so that it is only logged once per process.
+    static bool loggedFailure;
+
+    /// If non-NULL, readCounters returns this instead of reading real
+    /// counters, and openCounters pretends to succeed. Used only for
+    /// testing.
+    static Reading* mockReading;
+};
+
+} // end RAMCloud
+
+#endif  // RAMCLOUD_RPCCACHESTATS_H
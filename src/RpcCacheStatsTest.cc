@@ -0,0 +1,213 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <thread>
+
+#include "TestUtil.h"
+#include "PerfStats.h"
+#include "RpcCacheStats.h"
+#include "ServerId.h"
+
+namespace RAMCloud {
+
+class RpcCacheStatsTest : public ::testing::Test {
+  public:
+    RpcCacheStats::Reading reading;
+
+    RpcCacheStatsTest()
+        : reading()
+    {
+        RpcCacheStats::registeredStats.clear();
+        RpcCacheStats::threadStats = NULL;
+        RpcCacheStats::loggedFailure = false;
+        RpcCacheStats::mockReading = &reading;
+        RpcCacheStats::setSampleInterval(1);
+        reading.count = RpcCacheStats::EVENT_COUNT;
+    }
+
+    ~RpcCacheStatsTest()
+    {
+        RpcCacheStats::mockReading = NULL;
+        RpcCacheStats::setSampleInterval(0);
+        RpcCacheStats::threadStats = NULL;
+    }
+
+    // Sample one request (on the current thread) during which the
+    // counters advance by the given amounts. The sample interval must be 1.
+    void
+    sample(WireFormat::Opcode opcode, uint64_t misses, uint64_t remote,
+            uint64_t instructions)
+    {
+        EXPECT_TRUE(RpcCacheStats::startSample());
+        reading.timeEnabled += 1000;
+        reading.timeRunning += 1000;
+        reading.values[RpcCacheStats::LLC_MISSES] += misses;
+        reading.values[RpcCacheStats::REMOTE_ACCESSES] += remote;
+        reading.values[RpcCacheStats::INSTRUCTIONS] += instructions;
+        RpcCacheStats::finishSample(opcode);
+    }
+
+    // Append the current statistics to a buffer in the format of
+    // serverControlAll(GET_RPC_CACHE_STATS), as if they came from a single
+    // server.
+    void
+    collectForServer(Buffer* buffer, ServerId serverId)
+    {
+        buffer->reset();
+        WireFormat::ServerControlAll::Response* header =
+                buffer->emplaceAppend<WireFormat::ServerControlAll::Response>();
+        header->common.status = STATUS_OK;
+        header->serverCount = 1;
+        header->respCount = 1;
+        WireFormat::ServerControl::Response* subHead = buffer->
+                emplaceAppend<WireFormat::ServerControl::Response>();
+        subHead->common.status = STATUS_OK;
+        subHead->serverId = serverId.getId();
+        uint32_t start = buffer->size();
+        RpcCacheStats::collect(buffer);
+        subHead->outputLength = buffer->size() - start;
+        header->totalRespLength = buffer->size() - sizeof32(*header);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcCacheStatsTest);
+};
+
+TEST_F(RpcCacheStatsTest, startSample_disabled) {
+    RpcCacheStats::setSampleInterval(0);
+    EXPECT_FALSE(RpcCacheStats::startSample());
+    EXPECT_TRUE(RpcCacheStats::threadStats == NULL);
+    EXPECT_EQ(0u, RpcCacheStats::registeredStats.size());
+
+    // Turning sampling off after a thread has started only takes effect
+    // when the thread's countdown runs out.
+    RpcCacheStats::setSampleInterval(2);
+    EXPECT_TRUE(RpcCacheStats::startSample());
+    RpcCacheStats::setSampleInterval(0);
+    EXPECT_FALSE(RpcCacheStats::startSample());
+    EXPECT_FALSE(RpcCacheStats::startSample());
+    EXPECT_EQ(1000u, RpcCacheStats::threadStats->countdown);
+}
+
+TEST_F(RpcCacheStatsTest, startSample_interval) {
+    RpcCacheStats::setSampleInterval(3);
+    reading.values[0] = 44;
+    EXPECT_TRUE(RpcCacheStats::startSample());
+    EXPECT_EQ(1u, RpcCacheStats::registeredStats.size());
+    EXPECT_EQ(44u, RpcCacheStats::threadStats->start.values[0]);
+    EXPECT_FALSE(RpcCacheStats::startSample());
+    EXPECT_FALSE(RpcCacheStats::startSample());
+    EXPECT_TRUE(RpcCacheStats::startSample());
+    EXPECT_EQ(1u, RpcCacheStats::registeredStats.size());
+}
+
+TEST_F(RpcCacheStatsTest, startSample_countersUnavailable) {
+    // A thread whose counters couldn't be opened.
+    RpcCacheStats::threadStats = new RpcCacheStats::ThreadStats;
+    EXPECT_FALSE(RpcCacheStats::startSample());
+    EXPECT_EQ(1000u, RpcCacheStats::threadStats->countdown);
+}
+
+TEST_F(RpcCacheStatsTest, finishSample) {
+    PerfStats before = PerfStats::threadStats;
+    sample(WireFormat::READ, 10, 2, 1000);
+    sample(WireFormat::READ, 30, 4, 3000);
+    RpcCacheStats::OpcodeStats* stats =
+            RpcCacheStats::threadStats->opcodes[WireFormat::READ].load();
+    ASSERT_TRUE(stats != NULL);
+    EXPECT_EQ(2u, stats->samples);
+    EXPECT_EQ(40u, stats->events[RpcCacheStats::LLC_MISSES]);
+    EXPECT_EQ(6u, stats->events[RpcCacheStats::REMOTE_ACCESSES]);
+    EXPECT_EQ(4000u, stats->events[RpcCacheStats::INSTRUCTIONS]);
+    EXPECT_TRUE(RpcCacheStats::threadStats->opcodes[WireFormat::WRITE]
+            .load() == NULL);
+
+    PerfStats& after = PerfStats::threadStats;
+    EXPECT_EQ(2u, after.rpcCacheSamples - before.rpcCacheSamples);
+    EXPECT_EQ(40u, after.rpcLlcMisses - before.rpcLlcMisses);
+    EXPECT_EQ(6u, after.rpcRemoteAccesses - before.rpcRemoteAccesses);
+    EXPECT_EQ(4000u, after.rpcInstructions - before.rpcInstructions);
+}
+
+TEST_F(RpcCacheStatsTest, finishSample_multiplexed) {
+    EXPECT_TRUE(RpcCacheStats::startSample());
+    reading.timeEnabled += 1000;
+    reading.timeRunning += 400;
+    reading.values[RpcCacheStats::LLC_MISSES] += 10;
+    RpcCacheStats::finishSample(WireFormat::READ);
+    EXPECT_TRUE(RpcCacheStats::threadStats->opcodes[WireFormat::READ]
+            .load() == NULL);
+}
+
+TEST_F(RpcCacheStatsTest, finishSample_missingEvent) {
+    sample(WireFormat::READ, 1, 1, 1);
+
+    // This machine can't count remote accesses; instructions take its
+    // place in the group.
+    RpcCacheStats::threadStats->slots[RpcCacheStats::REMOTE_ACCESSES] = -1;
+    RpcCacheStats::threadStats->slots[RpcCacheStats::INSTRUCTIONS] = 1;
+    sample(WireFormat::READ, 5, 100, 0);
+    RpcCacheStats::OpcodeStats* stats =
+            RpcCacheStats::threadStats->opcodes[WireFormat::READ].load();
+    EXPECT_EQ(6u, stats->events[RpcCacheStats::LLC_MISSES]);
+    EXPECT_EQ(1u, stats->events[RpcCacheStats::REMOTE_ACCESSES]);
+    EXPECT_EQ(101u, stats->events[RpcCacheStats::INSTRUCTIONS]);
+}
+
+TEST_F(RpcCacheStatsTest, collectAndParse) {
+    sample(WireFormat::READ, 10, 1, 100);
+    std::thread thread([this] {
+        sample(WireFormat::READ, 20, 2, 200);
+        sample(WireFormat::WRITE, 40, 4, 400);
+    });
+    thread.join();
+    EXPECT_EQ(2u, RpcCacheStats::registeredStats.size());
+
+    Buffer buffer;
+    buffer.appendCopy("abc", 3);
+    RpcCacheStats::collect(&buffer);
+    RpcCacheStats::Collection stats;
+    EXPECT_TRUE(RpcCacheStats::parse(&buffer, 3, buffer.size() - 3,
+            &stats));
+    EXPECT_EQ(2u, stats.size());
+    EXPECT_EQ(2u, stats[WireFormat::READ].samples);
+    EXPECT_EQ(30u, stats[WireFormat::READ].events[0]);
+    EXPECT_EQ(1u, stats[WireFormat::WRITE].samples);
+    EXPECT_EQ(400u, stats[WireFormat::WRITE].events[2]);
+
+    // Malformed statistics.
+    EXPECT_FALSE(RpcCacheStats::parse(&buffer, 3, buffer.size() - 4,
+            &stats));
+}
+
+TEST_F(RpcCacheStatsTest, printClusterCacheStats) {
+    sample(WireFormat::READ, 100, 0, 1000);
+    sample(WireFormat::WRITE, 100, 0, 1000);
+    Buffer first, second;
+    collectForServer(&first, ServerId(1, 0));
+    sample(WireFormat::READ, 10, 2, 5000);
+    sample(WireFormat::READ, 30, 4, 15000);
+    collectForServer(&second, ServerId(1, 0));
+
+    string output = RpcCacheStats::printClusterCacheStats(&first, &second);
+    EXPECT_NE(string::npos, output.find("Server index 1:"));
+    EXPECT_NE(string::npos, output.find("  READ                       "
+            "         2         20.0         1280          3.0        "
+            "10000     2.00"));
+
+    // No WRITEs happened between the two readings.
+    EXPECT_EQ(string::npos, output.find("WRITE"));
+}
+
+}  // namespace RAMCloud
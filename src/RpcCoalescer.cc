@@ -0,0 +1,275 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "RpcCoalescer.h"
+#include "Cycles.h"
+#include "Dispatch.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a CoalescedOp; the caller then fills in #read or #write.
+ *
+ * \param coalescer
+ *      The coalescer the op will be handed to.
+ * \param tableId
+ *      Table containing the object.
+ * \param key
+ *      Primary key of the object; copied.
+ * \param keyLength
+ *      Size in bytes of \a key.
+ * \param rejectRules
+ *      If non-NULL, conditions under which the operation should be aborted
+ *      with an error; copied.
+ */
+CoalescedOp::CoalescedOp(RpcCoalescer* coalescer, uint64_t tableId,
+                         const void* key, uint16_t keyLength,
+                         const RejectRules* rejectRules)
+    : coalescer(coalescer)
+    , key(static_cast<const char*>(key), keyLength)
+    , rejectRules()
+    , value()
+    , readValue()
+    , read()
+    , write()
+    , finished(false)
+{
+    if (rejectRules != NULL)
+        this->rejectRules = *rejectRules;
+    else
+        memset(&this->rejectRules, 0, sizeof(this->rejectRules));
+}
+
+/**
+ * Construct an RpcCoalescer; it is disabled until enable() is called.
+ *
+ * \param ramcloud
+ *      The RAMCloud object whose reads and writes are coalesced.
+ */
+RpcCoalescer::RpcCoalescer(RamCloud* ramcloud)
+    : ramcloud(ramcloud)
+    , enabled(false)
+    , windowCycles(0)
+    , pending()
+    , oldestPendingTime(0)
+    , batches()
+{
+}
+
+/**
+ * Destructor for RpcCoalescer. Multi-ops still in progress are canceled;
+ * ops that were never sent stay unfinished.
+ */
+RpcCoalescer::~RpcCoalescer()
+{
+    foreach (std::unique_ptr<Batch>& batch, batches) {
+        if (batch->multiRead)
+            batch->multiRead->cancel();
+        if (batch->multiWrite)
+            batch->multiWrite->cancel();
+    }
+}
+
+/**
+ * Hand over a read that would otherwise be sent as its own ReadRpc. The
+ * arguments are the same as for ReadRpc.
+ *
+ * \return
+ *      The op; its readValue, read->status and read->version hold the
+ *      outcome once it has finished.
+ */
+std::shared_ptr<CoalescedOp>
+RpcCoalescer::addRead(uint64_t tableId, const void* key, uint16_t keyLength,
+                      const RejectRules* rejectRules)
+{
+    std::shared_ptr<CoalescedOp> op = std::make_shared<CoalescedOp>(this,
+            tableId, key, keyLength, rejectRules);
+    op->read.construct(tableId, op->key.data(), keyLength, &op->readValue,
+                       &op->rejectRules);
+    add(op);
+    return op;
+}
+
+/**
+ * Hand over a single-key write that would otherwise be sent as its own
+ * WriteRpc. The arguments are the same as for WriteRpc; \a key and \a buf
+ * are copied.
+ *
+ * \return
+ *      The op; write->status and write->version hold the outcome once it
+ *      has finished.
+ */
+std::shared_ptr<CoalescedOp>
+RpcCoalescer::addWrite(uint64_t tableId, const void* key, uint16_t keyLength,
+                       const void* buf, uint32_t length,
+                       const RejectRules* rejectRules)
+{
+    std::shared_ptr<CoalescedOp> op = std::make_shared<CoalescedOp>(this,
+            tableId, key, keyLength, rejectRules);
+    op->value.assign(static_cast<const char*>(buf), length);
+    op->write.construct(tableId, op->key.data(), keyLength,
+                        op->value.data(), length, &op->rejectRules);
+    add(op);
+    return op;
+}
+
+/**
+ * Stop coalescing new reads and writes. Ops already handed over are sent
+ * right away.
+ */
+void
+RpcCoalescer::disable()
+{
+    enabled = false;
+    flush();
+}
+
+/**
+ * Start coalescing the reads and writes of new ReadRpcs and WriteRpcs.
+ *
+ * \param windowMicros
+ *      An op is held for at most this long, waiting for others to join it,
+ *      before it is sent (provided the client calls RamCloud::poll() or
+ *      isReady() on some RPC in the meantime).
+ */
+void
+RpcCoalescer::enable(uint32_t windowMicros)
+{
+    enabled = true;
+    windowCycles = Cycles::fromMicroseconds(windowMicros);
+}
+
+/**
+ * Send all of the pending ops now.
+ */
+void
+RpcCoalescer::flush()
+{
+    if (pending.empty())
+        return;
+
+    batches.emplace_back(new Batch);
+    Batch* batch = batches.back().get();
+    batch->ops.swap(pending);
+    foreach (std::shared_ptr<CoalescedOp>& op, batch->ops) {
+        if (op->read)
+            batch->reads.push_back(op->read.get());
+        else
+            batch->writes.push_back(op->write.get());
+    }
+    TEST_LOG("sending %lu reads and %lu writes", batch->reads.size(),
+             batch->writes.size());
+
+    if (!batch->reads.empty()) {
+        batch->multiRead.construct(ramcloud, &batch->reads[0],
+                                   downCast<uint32_t>(batch->reads.size()));
+    }
+    if (!batch->writes.empty()) {
+        batch->multiWrite.construct(ramcloud, &batch->writes[0],
+                                    downCast<uint32_t>(batch->writes.size()));
+    }
+}
+
+/**
+ * Make progress on the coalesced ops and return true if \a op has finished.
+ */
+bool
+RpcCoalescer::isReady(CoalescedOp* op)
+{
+    poll();
+    return op->finished;
+}
+
+/**
+ * Send the pending ops if the oldest has been held for the whole window,
+ * and check whether the multi-ops in progress have completed. Invoked by
+ * RamCloud::poll().
+ */
+void
+RpcCoalescer::poll()
+{
+    if (!pending.empty() &&
+            Cycles::rdtsc() - oldestPendingTime >= windowCycles) {
+        flush();
+    }
+    for (auto it = batches.begin(); it != batches.end(); ) {
+        if (pollBatch(it->get())) {
+            it = batches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Wait for \a op to finish; it is sent at once if it is still pending.
+ */
+void
+RpcCoalescer::wait(CoalescedOp* op)
+{
+    if (!op->finished)
+        flush();
+
+    // See MultiOp::wait for why the dispatcher is only polled here on the
+    // dispatch thread.
+    Dispatch* dispatch = ramcloud->clientContext->dispatch;
+    bool isDispatchThread = dispatch->isDispatchThread();
+    while (!isReady(op)) {
+        if (isDispatchThread)
+            dispatch->poll();
+    }
+}
+
+/**
+ * Add an op to #pending, sending the pending ops if there are enough of
+ * them or the oldest has been held for the whole window.
+ */
+void
+RpcCoalescer::add(std::shared_ptr<CoalescedOp> op)
+{
+    uint64_t now = Cycles::rdtsc();
+    if (pending.empty())
+        oldestPendingTime = now;
+    pending.push_back(op);
+    if (pending.size() >= MAX_PENDING_OPS ||
+            now - oldestPendingTime >= windowCycles) {
+        flush();
+    }
+}
+
+/**
+ * Make progress on the multi-ops of a batch; once both are done, mark the
+ * batch's ops finished.
+ *
+ * \return
+ *      True if the batch is done and can be discarded.
+ */
+bool
+RpcCoalescer::pollBatch(Batch* batch)
+{
+    bool done = true;
+    if (batch->multiRead && !batch->multiRead->isReady())
+        done = false;
+    if (batch->multiWrite && !batch->multiWrite->isReady())
+        done = false;
+    if (!done)
+        return false;
+    foreach (std::shared_ptr<CoalescedOp>& op, batch->ops)
+        op->finished = true;
+    return true;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,164 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_RPCCOALESCER_H
+#define RAMCLOUD_RPCCOALESCER_H
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "MultiRead.h"
+#include "MultiWrite.h"
+
+namespace RAMCloud {
+
+class RpcCoalescer;
+
+/**
+ * The state of one read or write that a ReadRpc or WriteRpc handed to an
+ * RpcCoalescer instead of sending an RPC of its own. It is shared by the
+ * wrapper and the coalescer, since the multi-op that carries it may still
+ * be writing into it after the wrapper is gone.
+ */
+struct CoalescedOp {
+    CoalescedOp(RpcCoalescer* coalescer, uint64_t tableId, const void* key,
+                uint16_t keyLength, const RejectRules* rejectRules);
+
+    /// The coalescer the op was handed to.
+    RpcCoalescer* coalescer;
+
+    /// Copy of the object's key, so the caller's storage may go away.
+    string key;
+
+    /// Copy of the caller's reject rules (all zero if none were given).
+    RejectRules rejectRules;
+
+    /// Copy of the new contents of the object, for writes.
+    string value;
+
+    /// Receives the object, for reads.
+    Tub<ObjectBuffer> readValue;
+
+    /// Exactly one of these describes the operation to the multi-op; its
+    /// status and version hold the outcome once #finished is set.
+    Tub<MultiReadObject> read;
+    Tub<MultiWriteObject> write;
+
+    /// True once the multi-op carrying this op has completed.
+    bool finished;
+
+    DISALLOW_COPY_AND_ASSIGN(CoalescedOp);
+};
+
+/**
+ * Combines single-object reads and writes that a client has outstanding at
+ * the same time into MultiRead and MultiWrite operations, so that clients
+ * issuing many independent asynchronous ReadRpcs and WriteRpcs get the
+ * efficiency of multi-ops without restructuring their code. It is off
+ * unless RamCloud::enableCoalescing() is called.
+ *
+ * Ops are held until one of them is waited on, the oldest one has been
+ * held for the coalescing window, or enough of them are pending to fill
+ * several multi-op RPCs. They are then sent as one MultiRead and one
+ * MultiWrite, which group the ops by the master that ObjectFinder says
+ * owns each object, exactly as RamCloud::multiRead() would.
+ *
+ * Coalesced writes are not linearizable (MultiWrite isn't): a write that is
+ * retried after a master crash may be applied twice. Writes with more than
+ * one key and async writes are never coalesced.
+ *
+ * Like RamCloud, this class is not thread-safe.
+ */
+class RpcCoalescer {
+  PUBLIC:
+    explicit RpcCoalescer(RamCloud* ramcloud);
+    ~RpcCoalescer();
+
+    std::shared_ptr<CoalescedOp> addRead(uint64_t tableId, const void* key,
+                                         uint16_t keyLength,
+                                         const RejectRules* rejectRules);
+    std::shared_ptr<CoalescedOp> addWrite(uint64_t tableId, const void* key,
+                                          uint16_t keyLength,
+                                          const void* buf, uint32_t length,
+                                          const RejectRules* rejectRules);
+    void disable();
+    void enable(uint32_t windowMicros);
+    void flush();
+    bool isReady(CoalescedOp* op);
+    void poll();
+    void wait(CoalescedOp* op);
+
+    /// Returns true if new ReadRpcs and WriteRpcs should be coalesced.
+    bool isEnabled() const {
+        return enabled;
+    }
+
+  PRIVATE:
+    /// The pending ops are sent once this many have accumulated, even if
+    /// the window hasn't elapsed (a few multi-op RPCs' worth).
+    enum { MAX_PENDING_OPS = 100 };
+
+    /// The ops sent together in one flush(), and the multi-ops carrying them.
+    struct Batch {
+        Batch()
+            : ops()
+            , reads()
+            , writes()
+            , multiRead()
+            , multiWrite()
+        {}
+
+        /// Keeps the ops alive until the multi-ops are done with them.
+        std::vector<std::shared_ptr<CoalescedOp>> ops;
+
+        /// Request arrays for #multiRead and #multiWrite; they must not
+        /// change while those are in progress.
+        std::vector<MultiReadObject*> reads;
+        std::vector<MultiWriteObject*> writes;
+
+        Tub<MultiRead> multiRead;
+        Tub<MultiWrite> multiWrite;
+
+        DISALLOW_COPY_AND_ASSIGN(Batch);
+    };
+
+    void add(std::shared_ptr<CoalescedOp> op);
+    bool pollBatch(Batch* batch);
+
+    /// Overall client state information.
+    RamCloud* ramcloud;
+
+    /// See isEnabled().
+    bool enabled;
+
+    /// Pending ops are sent once the oldest has waited this long.
+    uint64_t windowCycles;
+
+    /// Ops that haven't been sent yet, in the order they were added.
+    std::vector<std::shared_ptr<CoalescedOp>> pending;
+
+    /// Cycles::rdtsc() time at which the oldest op in #pending was added.
+    uint64_t oldestPendingTime;
+
+    /// Batches whose multi-ops haven't completed yet.
+    std::list<std::unique_ptr<Batch>> batches;
+
+    DISALLOW_COPY_AND_ASSIGN(RpcCoalescer);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_RPCCOALESCER_H
@@ -0,0 +1,177 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "Cycles.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+#include "RpcCoalescer.h"
+
+namespace RAMCloud {
+
+static bool
+flushFilter(string s)
+{
+    return s == "flush";
+}
+
+class RpcCoalescerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    uint64_t tableId;
+
+    RpcCoalescerTest()
+        : logEnabler(flushFilter)
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , tableId(-1)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        ramcloud.construct(&context, "mock:host=coordinator");
+
+        tableId = ramcloud->createTable("table1");
+        ramcloud->write(tableId, "object1", 7, "value1");
+        ramcloud->write(tableId, "object2", 7, "value2");
+        TestLog::reset();
+    }
+
+    ~RpcCoalescerTest()
+    {
+        Cycles::mockTscValue = 0;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcCoalescerTest);
+};
+
+TEST_F(RpcCoalescerTest, disabledByDefault) {
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId, "object1", 7, &value);
+    EXPECT_FALSE(rpc.coalescedOp);
+    rpc.wait();
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+    EXPECT_EQ("", TestLog::get());
+}
+
+TEST_F(RpcCoalescerTest, reads) {
+    ramcloud->enableCoalescing(1000000);
+    Buffer value1, value2;
+    uint64_t version;
+    ReadRpc rpc1(ramcloud.get(), tableId, "object1", 7, &value1);
+    ReadRpc rpc2(ramcloud.get(), tableId, "object2", 7, &value2);
+    EXPECT_EQ(2u, ramcloud->coalescer->pending.size());
+
+    // Waiting for either read sends both in one MultiRead.
+    rpc2.wait(&version);
+    EXPECT_EQ("flush: sending 2 reads and 0 writes", TestLog::get());
+    EXPECT_EQ("value2", TestUtil::toString(&value2));
+    EXPECT_NE(0u, version);
+    EXPECT_TRUE(rpc1.isReady());
+    rpc1.wait();
+    EXPECT_EQ("value1", TestUtil::toString(&value1));
+    EXPECT_TRUE(ramcloud->coalescer->batches.empty());
+}
+
+TEST_F(RpcCoalescerTest, read_error) {
+    ramcloud->enableCoalescing(1000000);
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId, "missing", 7, &value);
+    EXPECT_THROW(rpc.wait(), ObjectDoesntExistException);
+}
+
+TEST_F(RpcCoalescerTest, writes) {
+    ramcloud->enableCoalescing(1000000);
+    uint64_t version1, version2;
+    WriteRpc rpc1(ramcloud.get(), tableId, "object1", 7, "new1", 4);
+    WriteRpc rpc2(ramcloud.get(), tableId, "object3", 7, "new3", 4);
+    rpc1.wait(&version1);
+    rpc2.wait(&version2);
+    EXPECT_EQ("flush: sending 0 reads and 2 writes", TestLog::get());
+    EXPECT_NE(0u, version1);
+
+    ramcloud->disableCoalescing();
+    Buffer value;
+    ramcloud->read(tableId, "object3", 7, &value);
+    EXPECT_EQ("new3", TestUtil::toString(&value));
+}
+
+TEST_F(RpcCoalescerTest, write_asyncNotCoalesced) {
+    ramcloud->enableCoalescing(1000000);
+    WriteRpc rpc(ramcloud.get(), tableId, "object1", 7, "new1", 4, NULL,
+                 true);
+    EXPECT_FALSE(rpc.coalescedOp);
+    rpc.wait();
+}
+
+TEST_F(RpcCoalescerTest, write_rejectRules) {
+    ramcloud->enableCoalescing(1000000);
+    RejectRules rules;
+    memset(&rules, 0, sizeof(rules));
+    rules.exists = 1;
+    WriteRpc rpc(ramcloud.get(), tableId, "object1", 7, "new1", 4, &rules);
+    EXPECT_THROW(rpc.wait(), ObjectExistsException);
+}
+
+TEST_F(RpcCoalescerTest, poll_windowElapsed) {
+    Cycles::mockTscValue = 1000;
+    ramcloud->enableCoalescing(10);
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId, "object1", 7, &value);
+    ramcloud->coalescer->poll();
+    EXPECT_EQ(1u, ramcloud->coalescer->pending.size());
+
+    Cycles::mockTscValue += Cycles::fromMicroseconds(10);
+    ramcloud->coalescer->poll();
+    EXPECT_EQ(0u, ramcloud->coalescer->pending.size());
+    EXPECT_EQ("flush: sending 1 reads and 0 writes", TestLog::get());
+    Cycles::mockTscValue = 0;
+    rpc.wait();
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+}
+
+TEST_F(RpcCoalescerTest, add_tooManyPending) {
+    ramcloud->enableCoalescing(1000000);
+    std::vector<std::shared_ptr<CoalescedOp>> ops;
+    for (int i = 0; i < RpcCoalescer::MAX_PENDING_OPS - 1; i++)
+        ops.push_back(ramcloud->coalescer->addRead(tableId, "object1", 7,
+                                                   NULL));
+    EXPECT_EQ("", TestLog::get());
+    ops.push_back(ramcloud->coalescer->addRead(tableId, "object1", 7, NULL));
+    EXPECT_EQ("flush: sending 100 reads and 0 writes", TestLog::get());
+    ramcloud->coalescer->wait(ops.back().get());
+    EXPECT_EQ(STATUS_OK, ops.back()->read->status);
+}
+
+TEST_F(RpcCoalescerTest, disable) {
+    ramcloud->enableCoalescing(1000000);
+    Buffer value;
+    ReadRpc rpc(ramcloud.get(), tableId, "object1", 7, &value);
+    ramcloud->disableCoalescing();
+    EXPECT_EQ("flush: sending 1 reads and 0 writes", TestLog::get());
+    EXPECT_FALSE(ramcloud->coalescer->isEnabled());
+    rpc.wait();
+    EXPECT_EQ("value1", TestUtil::toString(&value));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,221 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "Cycles.h"
+#include "RpcLatencyStats.h"
+#include "ServerId.h"
+
+namespace RAMCloud {
+
+__thread RpcLatencyStats::ThreadStats* RpcLatencyStats::threadStats = NULL;
+SpinLock RpcLatencyStats::mutex("RpcLatencyStats");
+std::vector<RpcLatencyStats::ThreadStats*> RpcLatencyStats::registeredStats;
+
+/**
+ * Count one request executed by the current thread.
+ *
+ * \param opcode
+ *      The request's opcode.
+ * \param queueingCycles
+ *      Time the request waited before execution began, in Cycles::rdtsc
+ *      ticks.
+ * \param serviceCycles
+ *      Time spent executing the request, in Cycles::rdtsc ticks.
+ */
+void
+RpcLatencyStats::record(WireFormat::Opcode opcode, uint64_t queueingCycles,
+        uint64_t serviceCycles)
+{
+    if (expect_false(threadStats == NULL)) {
+        threadStats = new ThreadStats;
+        std::lock_guard<SpinLock> lock(mutex);
+        registeredStats.push_back(threadStats);
+    }
+    OpcodeStats* stats = threadStats->opcodes[opcode].load();
+    if (expect_false(stats == NULL)) {
+        stats = new OpcodeStats;
+        threadStats->opcodes[opcode].store(stats);
+    }
+    stats->queueing.record(Cycles::toNanoseconds(queueingCycles));
+    stats->service.record(Cycles::toNanoseconds(serviceCycles));
+}
+
+/**
+ * Add up the statistics of all threads and append them to a buffer; this
+ * is the response to the GET_RPC_LATENCIES server control. The result is a
+ * uint16_t opcode for each opcode that has been seen, each followed by its
+ * queueing and service histograms in the format of
+ * LatencyHistogram::serialize().
+ *
+ * \param buffer
+ *      The statistics are appended here.
+ */
+void
+RpcLatencyStats::collect(Buffer* buffer)
+{
+    Collection total;
+    {
+        std::lock_guard<SpinLock> lock(mutex);
+        foreach (ThreadStats* thread, registeredStats) {
+            for (uint16_t i = 0; i < WireFormat::ILLEGAL_RPC_TYPE; i++) {
+                OpcodeStats* stats = thread->opcodes[i].load();
+                if (stats == NULL)
+                    continue;
+                total[i].queueing.merge(stats->queueing);
+                total[i].service.merge(stats->service);
+            }
+        }
+    }
+    foreach (Collection::value_type& entry, total) {
+        buffer->emplaceAppend<uint16_t>(entry.first);
+        entry.second.queueing.serialize(buffer);
+        entry.second.service.serialize(buffer);
+    }
+}
+
+/**
+ * Parse statistics returned by collect().
+ *
+ * \param buffer
+ *      Holds the statistics.
+ * \param offset
+ *      Offset of the statistics in \a buffer.
+ * \param length
+ *      Number of bytes of statistics.
+ * \param[out] stats
+ *      Contents are replaced with the parsed statistics.
+ * \return
+ *      False if the statistics were malformed.
+ */
+bool
+RpcLatencyStats::parse(Buffer* buffer, uint32_t offset, uint32_t length,
+        Collection* stats)
+{
+    stats->clear();
+    uint32_t end = offset + length;
+    while (offset < end) {
+        const uint16_t* opcode = buffer->getOffset<uint16_t>(offset);
+        if (opcode == NULL)
+            return false;
+        offset += sizeof32(*opcode);
+        OpcodeStats& opcodeStats = (*stats)[*opcode];
+        if (!opcodeStats.queueing.deserialize(buffer, &offset) ||
+                !opcodeStats.service.deserialize(buffer, &offset))
+            return false;
+    }
+    return offset == end;
+}
+
+// Returns a percentile of a histogram of nanoseconds, in microseconds.
+static double
+toMicros(const LatencyHistogram& histogram, double fraction)
+{
+    return 1e-3 * static_cast<double>(histogram.getPercentile(fraction));
+}
+
+/**
+ * Given the responses to two calls to CoordinatorClient::serverControlAll
+ * with GET_RPC_LATENCIES, format the latencies of the requests executed
+ * between them.
+ *
+ * \param first
+ *      Response from the earlier call.
+ * \param second
+ *      Response from the later call.
+ * \return
+ *      A multi-line string, with a line for each opcode that each server
+ *      executed in the interval, giving 50th, 99th and 99.9th percentile
+ *      queueing and service times. It ends in a newline character.
+ */
+string
+RpcLatencyStats::printClusterLatencies(Buffer* first, Buffer* second)
+{
+    std::vector<Collection> before, after;
+    parseCluster(first, &before);
+    parseCluster(second, &after);
+
+    string result = format("%-28s %10s %27s %27s\n", "", "",
+            "Queueing p50/p99/p999 (us)", "Service p50/p99/p999 (us)");
+    for (size_t server = 0; server < after.size(); server++) {
+        bool printedServer = false;
+        foreach (Collection::value_type& entry, after[server]) {
+            OpcodeStats& stats = entry.second;
+            if (server < before.size()) {
+                Collection::iterator earlier =
+                        before[server].find(entry.first);
+                if (earlier != before[server].end()) {
+                    stats.queueing.subtract(earlier->second.queueing);
+                    stats.service.subtract(earlier->second.service);
+                }
+            }
+            uint64_t count = stats.service.getCount();
+            if (count == 0)
+                continue;
+            if (!printedServer) {
+                result.append(format("Server index %lu:\n", server));
+                printedServer = true;
+            }
+            result.append(format("  %-26s %10lu "
+                    "%8.1f %8.1f %8.1f  %8.1f %8.1f %8.1f\n",
+                    WireFormat::opcodeSymbol(entry.first), count,
+                    toMicros(stats.queueing, 0.5),
+                    toMicros(stats.queueing, 0.99),
+                    toMicros(stats.queueing, 0.999),
+                    toMicros(stats.service, 0.5),
+                    toMicros(stats.service, 0.99),
+                    toMicros(stats.service, 0.999)));
+        }
+    }
+    return result;
+}
+
+/**
+ * Divide the response to serverControlAll(GET_RPC_LATENCIES) among the
+ * servers it came from.
+ *
+ * \param rawData
+ *      Response buffer from a call to CoordinatorClient::serverControlAll.
+ * \param[out] results
+ *      Filled in (possibly sparsely) with the statistics of each server:
+ *      entry i holds the statistics for the server whose ServerId has
+ *      indexNumber i. Servers whose statistics were malformed are left
+ *      empty.
+ */
+void
+RpcLatencyStats::parseCluster(Buffer* rawData,
+        std::vector<Collection>* results)
+{
+    results->clear();
+    uint32_t offset = sizeof(WireFormat::ServerControlAll::Response);
+    while (offset < rawData->size()) {
+        WireFormat::ServerControl::Response* header =
+                rawData->getOffset<WireFormat::ServerControl::Response>(offset);
+        offset += sizeof32(*header);
+        if ((header == NULL) ||
+                ((offset + header->outputLength) > rawData->size())) {
+            break;
+        }
+        uint32_t i = ServerId(header->serverId).indexNumber();
+        if (i >= results->size()) {
+            results->resize(i+1);
+        }
+        if (!parse(rawData, offset, header->outputLength, &results->at(i)))
+            results->at(i).clear();
+        offset += header->outputLength;
+    }
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,95 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_RPCLATENCYSTATS_H
+#define RAMCLOUD_RPCLATENCYSTATS_H
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "SpinLock.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+/**
+ * Keeps latency distributions for every RPC opcode a server executes on its
+ * worker threads, split into queueing time (from the moment the request
+ * was handed to the WorkerManager until a worker started executing it) and
+ * service time (how long the worker spent executing it). Both are always
+ * on; each worker thread updates its own histograms, so recording a sample
+ * costs a couple of increments. The GET_RPC_LATENCIES server control
+ * returns the sum over all threads (see collect()).
+ */
+class RpcLatencyStats {
+  PUBLIC:
+    /// Latency distributions for one opcode; all samples are in
+    /// nanoseconds.
+    struct OpcodeStats {
+        OpcodeStats()
+            : queueing()
+            , service()
+        {}
+
+        /// Time each request waited before a worker started it.
+        LatencyHistogram queueing;
+
+        /// Time a worker spent executing each request.
+        LatencyHistogram service;
+    };
+
+    /// Statistics for all of the opcodes that have been seen, keyed by
+    /// opcode.
+    typedef std::map<uint16_t, OpcodeStats> Collection;
+
+    static void collect(Buffer* buffer);
+    static bool parse(Buffer* buffer, uint32_t offset, uint32_t length,
+            Collection* stats);
+    static string printClusterLatencies(Buffer* first, Buffer* second);
+    static void record(WireFormat::Opcode opcode, uint64_t queueingCycles,
+            uint64_t serviceCycles);
+
+  PRIVATE:
+    /// The histograms of a single thread. Entries are allocated by the
+    /// thread the first time it executes a request with that opcode.
+    struct ThreadStats {
+        ThreadStats()
+            : opcodes()
+        {}
+        std::atomic<OpcodeStats*> opcodes[WireFormat::ILLEGAL_RPC_TYPE];
+        DISALLOW_COPY_AND_ASSIGN(ThreadStats);
+    };
+
+    static void parseCluster(Buffer* rawData,
+            std::vector<Collection>* results);
+
+    /// Statistics for the current thread; NULL until it records its first
+    /// sample.
+    static __thread ThreadStats* threadStats;
+
+    /// Protects #registeredStats.
+    static SpinLock mutex;
+
+    /// The statistics of every thread that has recorded a sample. These are
+    /// never freed, so that samples aren't lost when threads exit.
+    static std::vector<ThreadStats*> registeredStats;
+};
+
+} // end RAMCloud
+
+#endif  // RAMCLOUD_RPCLATENCYSTATS_H
@@ -0,0 +1,124 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <thread>
+
+#include "TestUtil.h"
+#include "Cycles.h"
+#include "RpcLatencyStats.h"
+#include "ServerId.h"
+
+namespace RAMCloud {
+
+class RpcLatencyStatsTest : public ::testing::Test {
+  public:
+    RpcLatencyStatsTest()
+    {
+        RpcLatencyStats::registeredStats.clear();
+        RpcLatencyStats::threadStats = NULL;
+    }
+
+    // Record a request that waited for queueingNs and took serviceNs.
+    static void
+    record(WireFormat::Opcode opcode, uint64_t queueingNs, uint64_t serviceNs)
+    {
+        RpcLatencyStats::record(opcode, Cycles::fromNanoseconds(queueingNs),
+                Cycles::fromNanoseconds(serviceNs));
+    }
+
+    // Append the current statistics to a buffer in the format of
+    // serverControlAll(GET_RPC_LATENCIES), as if they came from a single
+    // server.
+    void
+    collectForServer(Buffer* buffer, ServerId serverId)
+    {
+        buffer->reset();
+        WireFormat::ServerControlAll::Response* header =
+                buffer->emplaceAppend<WireFormat::ServerControlAll::Response>();
+        header->common.status = STATUS_OK;
+        header->serverCount = 1;
+        header->respCount = 1;
+        WireFormat::ServerControl::Response* subHead = buffer->
+                emplaceAppend<WireFormat::ServerControl::Response>();
+        subHead->common.status = STATUS_OK;
+        subHead->serverId = serverId.getId();
+        uint32_t start = buffer->size();
+        RpcLatencyStats::collect(buffer);
+        subHead->outputLength = buffer->size() - start;
+        header->totalRespLength = buffer->size() - sizeof32(*header);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcLatencyStatsTest);
+};
+
+TEST_F(RpcLatencyStatsTest, record) {
+    record(WireFormat::READ, 100, 2000);
+    record(WireFormat::READ, 100, 2000);
+    ASSERT_EQ(1u, RpcLatencyStats::registeredStats.size());
+    RpcLatencyStats::OpcodeStats* stats =
+            RpcLatencyStats::threadStats->opcodes[WireFormat::READ].load();
+    ASSERT_TRUE(stats != NULL);
+    EXPECT_EQ(2u, stats->queueing.getCount());
+    EXPECT_EQ(2u, stats->service.getCount());
+    EXPECT_TRUE(RpcLatencyStats::threadStats->opcodes[WireFormat::WRITE]
+            .load() == NULL);
+}
+
+TEST_F(RpcLatencyStatsTest, collectAndParse) {
+    record(WireFormat::READ, 100, 2000);
+    std::thread thread([] {
+        record(WireFormat::READ, 100, 4000);
+        record(WireFormat::WRITE, 300, 8000);
+    });
+    thread.join();
+    EXPECT_EQ(2u, RpcLatencyStats::registeredStats.size());
+
+    Buffer buffer;
+    buffer.appendCopy("abc", 3);
+    RpcLatencyStats::collect(&buffer);
+    RpcLatencyStats::Collection stats;
+    EXPECT_TRUE(RpcLatencyStats::parse(&buffer, 3, buffer.size() - 3,
+            &stats));
+    EXPECT_EQ(2u, stats.size());
+    EXPECT_EQ(2u, stats[WireFormat::READ].service.getCount());
+    EXPECT_EQ(1u, stats[WireFormat::WRITE].service.getCount());
+    EXPECT_NEAR(8000.0, static_cast<double>(
+            stats[WireFormat::WRITE].service.getPercentile(1.0)), 600.0);
+    EXPECT_NEAR(300.0, static_cast<double>(
+            stats[WireFormat::WRITE].queueing.getPercentile(1.0)), 30.0);
+
+    // Malformed statistics.
+    EXPECT_FALSE(RpcLatencyStats::parse(&buffer, 3, buffer.size() - 4,
+            &stats));
+}
+
+TEST_F(RpcLatencyStatsTest, printClusterLatencies) {
+    record(WireFormat::READ, 100, 2000);
+    record(WireFormat::WRITE, 100, 2000);
+    Buffer first, second;
+    collectForServer(&first, ServerId(1, 0));
+    record(WireFormat::READ, 100, 2000);
+    collectForServer(&second, ServerId(1, 0));
+
+    string output = RpcLatencyStats::printClusterLatencies(&first, &second);
+    EXPECT_NE(string::npos, output.find("Server index 1:"));
+    EXPECT_NE(string::npos, output.find("  READ "));
+
+    // No WRITEs happened between the two readings.
+    EXPECT_EQ(string::npos, output.find("WRITE"));
+}
+
+}  // namespace RAMCloud
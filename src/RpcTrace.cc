@@ -0,0 +1,89 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Cycles.h"
+#include "RpcTrace.h"
+#include "TimeTrace.h"
+
+namespace RAMCloud {
+
+__thread uint32_t RpcTrace::currentTraceId = 0;
+__thread uint32_t RpcTrace::currentSpanId = 0;
+__thread uint32_t RpcTrace::requestsUntilSample = 0;
+uint32_t RpcTrace::samplingInterval = 0;
+
+/**
+ * TimeTrace format strings for each RpcTrace::Event. scripts/rpctrace.py
+ * parses these, so keep the two in sync. The arguments are always the
+ * trace id, the span id, the opcode and the parent span id (0 when unknown).
+ */
+static const char* eventFormats[] = {
+    "rpctrace %u span %u: sent opcode %u, parent %u",
+    "rpctrace %u span %u: reply received, opcode %u",
+    "rpctrace %u span %u: request arrived, opcode %u",
+    "rpctrace %u span %u: service started, opcode %u",
+    "rpctrace %u span %u: service finished, opcode %u",
+};
+
+/**
+ * Record a TimeTrace event for a traced RPC.
+ *
+ * \param header
+ *      Header of the RPC's request; must carry a nonzero trace id.
+ * \param event
+ *      Which point in the RPC's lifetime has been reached.
+ * \param timestamp
+ *      Cycles::rdtsc time at which the event occurred; 0 means now.
+ */
+void
+RpcTrace::recordEvent(const WireFormat::RequestCommon* header, Event event,
+        uint64_t timestamp)
+{
+    if (timestamp == 0) {
+        timestamp = Cycles::rdtsc();
+    }
+    uint32_t parent = (event == SEND) ? currentSpanId : 0;
+    TimeTrace::record(timestamp, eventFormats[event], header->traceId,
+            header->spanId, header->opcode, parent);
+}
+
+/**
+ * Control how often this process starts new traces.
+ *
+ * \param interval
+ *      One out of every \a interval requests issued by each thread
+ *      outside of any existing trace starts a new trace. 0 disables
+ *      sampling; requests arriving with a trace id are still followed.
+ */
+void
+RpcTrace::setSamplingInterval(uint32_t interval)
+{
+    samplingInterval = interval;
+}
+
+/**
+ * Returns a random id for a new trace or span; never 0.
+ */
+uint32_t
+RpcTrace::newId()
+{
+    uint32_t id;
+    do {
+        id = downCast<uint32_t>(generateRandom() & 0xffffffffUL);
+    } while (id == 0);
+    return id;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,198 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_RPCTRACE_H
+#define RAMCLOUD_RPCTRACE_H
+
+#include "Buffer.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+/**
+ * RpcTrace follows a sampled fraction of requests as they fan out across
+ * the cluster (e.g. a client write, the master's worker, and the backup
+ * writes issued by its ReplicaManager), so that the per-server time traces
+ * can later be stitched into a single timeline (see scripts/rpctrace.py).
+ *
+ * A trace is started by a client: when sampling is enabled (see
+ * setSamplingInterval), every Nth outgoing request gets a fresh nonzero
+ * trace id. Each request carrying a trace id also gets a span id that
+ * identifies that particular RPC. Both travel in WireFormat::RequestCommon.
+ * While a server executes a traced request, the worker thread runs inside an
+ * RpcTrace::Scope, so any RPCs it issues inherit the trace id and name the
+ * request being served as their parent. Every traced RPC records TimeTrace
+ * events when it is sent, received, started, finished and answered; the
+ * ids are passed as TimeTrace arguments, which keeps the events as cheap as
+ * any other TimeTrace record.
+ *
+ * Requests that aren't sampled carry a zero trace id and cost a single
+ * comparison at each of the points above.
+ */
+class RpcTrace {
+  PUBLIC:
+    /**
+     * While an object of this class exists, RPCs issued by the current
+     * thread belong to the given trace and are recorded as children of
+     * the given span. Scopes nest; the previous values are restored on
+     * destruction.
+     */
+    class Scope {
+      PUBLIC:
+        /**
+         * Constructor for Scope.
+         *
+         * \param traceId
+         *      Trace to which RPCs issued by this thread should belong;
+         *      0 means they should not be traced (unless sampled).
+         * \param spanId
+         *      Span that RPCs issued by this thread should name as their
+         *      parent.
+         */
+        Scope(uint32_t traceId, uint32_t spanId)
+            : savedTraceId(currentTraceId)
+            , savedSpanId(currentSpanId)
+        {
+            currentTraceId = traceId;
+            currentSpanId = spanId;
+        }
+
+        ~Scope()
+        {
+            currentTraceId = savedTraceId;
+            currentSpanId = savedSpanId;
+        }
+
+      PRIVATE:
+        /// Values of currentTraceId and currentSpanId when this object was
+        /// constructed.
+        uint32_t savedTraceId;
+        uint32_t savedSpanId;
+
+        DISALLOW_COPY_AND_ASSIGN(Scope);
+    };
+
+    /**
+     * Returns the trace id that RPCs issued by the current thread will carry
+     * (0 means none).
+     */
+    static uint32_t
+    getTraceId()
+    {
+        return currentTraceId;
+    }
+
+    /**
+     * This method is invoked by RpcWrapper::allocHeader to fill in the
+     * trace fields of a new request header. If the current thread is
+     * working on behalf of a traced request the new RPC joins that trace;
+     * otherwise the request may be sampled as the root of a new trace.
+     *
+     * \param common
+     *      Header of the request (either WireFormat::RequestCommon or
+     *      WireFormat::RequestCommonWithId).
+     */
+    template<typename Header>
+    static void
+    stamp(Header* common)
+    {
+        uint32_t traceId = currentTraceId;
+        if (traceId == 0) {
+            if (expect_true(samplingInterval == 0)) {
+                return;
+            }
+            if (requestsUntilSample > 1) {
+                requestsUntilSample--;
+                return;
+            }
+            requestsUntilSample = samplingInterval;
+            traceId = newId();
+        }
+        common->traceId = traceId;
+        common->spanId = newId();
+    }
+
+    /**
+     * Record the fact that a request is about to be handed to a transport.
+     *
+     * \param request
+     *      The request message; nothing is recorded unless its header
+     *      carries a trace id.
+     */
+    static void
+    recordSend(Buffer* request)
+    {
+        const WireFormat::RequestCommon* header =
+                request->getStart<WireFormat::RequestCommon>();
+        if (expect_false((header != NULL) && (header->traceId != 0))) {
+            recordEvent(header, SEND);
+        }
+    }
+
+    /**
+     * Record the fact that the response to a request has arrived.
+     *
+     * \param request
+     *      The request message; nothing is recorded unless its header
+     *      carries a trace id.
+     */
+    static void
+    recordReply(Buffer* request)
+    {
+        const WireFormat::RequestCommon* header =
+                request->getStart<WireFormat::RequestCommon>();
+        if (expect_false((header != NULL) && (header->traceId != 0))) {
+            recordEvent(header, REPLY);
+        }
+    }
+
+    /// Identifies each of the events recorded for a traced RPC. These are
+    /// indexes into the eventFormats table in RpcTrace.cc.
+    enum Event {
+        SEND = 0,                     // Caller handed the request to its
+                                      // transport.
+        REPLY = 1,                    // Caller received the response.
+        ARRIVE = 2,                   // Server received the full request.
+        START = 3,                    // A worker started executing it.
+        FINISH = 4,                   // The worker finished executing it.
+    };
+
+    static void recordEvent(const WireFormat::RequestCommon* header,
+            Event event, uint64_t timestamp = 0);
+    static void setSamplingInterval(uint32_t interval);
+
+  PRIVATE:
+    static uint32_t newId();
+
+    /// Trace id for RPCs issued by this thread; 0 means none. Set by Scope.
+    static __thread uint32_t currentTraceId;
+
+    /// Span id that RPCs issued by this thread name as their parent.
+    static __thread uint32_t currentSpanId;
+
+    /// Number of untraced requests this thread will issue before it starts
+    /// a new trace.
+    static __thread uint32_t requestsUntilSample;
+
+    /// One out of every this many requests issued outside of any trace
+    /// starts a new trace; 0 (the default) disables sampling.
+    static uint32_t samplingInterval;
+
+    RpcTrace();
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_RPCTRACE_H
@@ -0,0 +1,163 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "RpcTrace.h"
+#include "TimeTrace.h"
+
+namespace RAMCloud {
+
+class RpcTraceTest : public ::testing::Test {
+  public:
+    Buffer request;
+
+    RpcTraceTest()
+        : request()
+    {
+        RpcTrace::samplingInterval = 0;
+        RpcTrace::requestsUntilSample = 0;
+        TimeTrace::reset();
+    }
+
+    ~RpcTraceTest()
+    {
+        RpcTrace::samplingInterval = 0;
+        RpcTrace::requestsUntilSample = 0;
+    }
+
+    // Reset #request to hold a fresh header for the given opcode and
+    // stamp it as RpcWrapper::allocHeader would.
+    WireFormat::RequestCommon*
+    newRequest(WireFormat::Opcode opcode)
+    {
+        request.reset();
+        WireFormat::RequestCommon* header =
+                request.emplaceAppend<WireFormat::RequestCommon>();
+        memset(header, 0, sizeof(*header));
+        header->opcode = opcode;
+        RpcTrace::stamp(header);
+        return header;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(RpcTraceTest);
+};
+
+TEST_F(RpcTraceTest, scope) {
+    EXPECT_EQ(0u, RpcTrace::getTraceId());
+    {
+        RpcTrace::Scope outer(5, 6);
+        EXPECT_EQ(5u, RpcTrace::getTraceId());
+        {
+            RpcTrace::Scope inner(0, 0);
+            EXPECT_EQ(0u, RpcTrace::getTraceId());
+        }
+        EXPECT_EQ(5u, RpcTrace::getTraceId());
+        EXPECT_EQ(6u, RpcTrace::currentSpanId);
+    }
+    EXPECT_EQ(0u, RpcTrace::getTraceId());
+    EXPECT_EQ(0u, RpcTrace::currentSpanId);
+}
+
+TEST_F(RpcTraceTest, stamp_notSampled) {
+    WireFormat::RequestCommon* header = newRequest(WireFormat::READ);
+    EXPECT_EQ(0u, header->traceId);
+    EXPECT_EQ(0u, header->spanId);
+}
+
+TEST_F(RpcTraceTest, stamp_sampling) {
+    RpcTrace::setSamplingInterval(3);
+    std::vector<uint32_t> traceIds;
+    for (int i = 0; i < 7; i++) {
+        WireFormat::RequestCommon* header = newRequest(WireFormat::READ);
+        traceIds.push_back(header->traceId);
+        if (header->traceId != 0) {
+            EXPECT_NE(0u, header->spanId);
+        }
+    }
+    EXPECT_NE(0u, traceIds[0]);
+    EXPECT_EQ(0u, traceIds[1]);
+    EXPECT_EQ(0u, traceIds[2]);
+    EXPECT_NE(0u, traceIds[3]);
+    EXPECT_EQ(0u, traceIds[4]);
+    EXPECT_EQ(0u, traceIds[5]);
+    EXPECT_NE(0u, traceIds[6]);
+
+    // Each sample starts a separate trace.
+    EXPECT_NE(traceIds[0], traceIds[3]);
+}
+
+TEST_F(RpcTraceTest, stamp_joinCurrentTrace) {
+    RpcTrace::Scope scope(5, 6);
+    WireFormat::RequestCommon* header = newRequest(WireFormat::BACKUP_WRITE);
+    EXPECT_EQ(5u, header->traceId);
+    EXPECT_NE(0u, header->spanId);
+    EXPECT_NE(6u, header->spanId);
+}
+
+TEST_F(RpcTraceTest, stamp_requestCommonWithId) {
+    RpcTrace::Scope scope(5, 6);
+    WireFormat::RequestCommonWithId header;
+    memset(&header, 0, sizeof(header));
+    header.targetId = 99;
+    RpcTrace::stamp(&header);
+    EXPECT_EQ(5u, header.traceId);
+    EXPECT_NE(0u, header.spanId);
+    EXPECT_EQ(99u, header.targetId);
+}
+
+TEST_F(RpcTraceTest, recordSend_notTraced) {
+    newRequest(WireFormat::READ);
+    RpcTrace::recordSend(&request);
+    RpcTrace::recordReply(&request);
+    EXPECT_EQ("No time trace events to print", TimeTrace::getTrace());
+
+    // A request too short to hold a header is ignored.
+    request.reset();
+    request.fillFromString("7");
+    RpcTrace::recordSend(&request);
+    EXPECT_EQ("No time trace events to print", TimeTrace::getTrace());
+}
+
+TEST_F(RpcTraceTest, recordSend_traced) {
+    RpcTrace::Scope scope(5, 6);
+    WireFormat::RequestCommon* header = newRequest(WireFormat::BACKUP_WRITE);
+    header->spanId = 77;
+    RpcTrace::recordSend(&request);
+    RpcTrace::recordReply(&request);
+    string trace = TimeTrace::getTrace();
+    EXPECT_TRUE(TestUtil::contains(trace,
+            "rpctrace 5 span 77: sent opcode 32, parent 6"));
+    EXPECT_TRUE(TestUtil::contains(trace,
+            "rpctrace 5 span 77: reply received, opcode 32"));
+}
+
+TEST_F(RpcTraceTest, recordEvent_timestamp) {
+    WireFormat::RequestCommon header;
+    memset(&header, 0, sizeof(header));
+    header.opcode = WireFormat::WRITE;
+    header.traceId = 8;
+    header.spanId = 9;
+    uint64_t now = Cycles::rdtsc();
+    RpcTrace::recordEvent(&header, RpcTrace::ARRIVE, now - 1000);
+    RpcTrace::recordEvent(&header, RpcTrace::START, now);
+    RpcTrace::recordEvent(&header, RpcTrace::FINISH);
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(
+            "rpctrace 8 span 9: request arrived, opcode 14.*"
+            "rpctrace 8 span 9: service started, opcode 14.*"
+            "rpctrace 8 span 9: service finished, opcode 14",
+            TimeTrace::getTrace()));
+}
+
+}  // namespace RAMCloud
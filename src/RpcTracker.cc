@@ -35,13 +35,11 @@ void
 RpcTracker::rpcFinished(uint64_t rpcId)
 {
     // Only need to mark receipt if the rpcId is inside window.
-    if (rpcId >= firstMissing && rpcId < firstMissing + windowSize) {
+    uint64_t first = firstMissing;
+    if (rpcId >= first && rpcId < first + windowSize) {
         rpcs[rpcId & indexMask] = NULL;
-        if (firstMissing == rpcId) {
-            firstMissing++;
-            while (!rpcs[firstMissing & indexMask] && firstMissing < nextRpcId)
-                firstMissing++;
-        }
+        finishedIds[rpcId & indexMask] = rpcId;
+        advanceFirstMissing();
     }
 }
 
@@ -60,15 +58,23 @@ uint64_t
 RpcTracker::newRpcId(TrackedRpc* ptr)
 {
     assert(ptr != NULL);
-    while (firstMissing + windowSize <= nextRpcId) {
-        RAMCLOUD_CLOG(NOTICE, "Waiting for response of RPC with id: %ld",
-                      firstMissing);
-        TrackedRpc* oldest = oldestOutstandingRpc();
-        oldest->tryFinish();
+    uint64_t rpcId = nextRpcId;
+    while (true) {
+        if (firstMissing + windowSize <= rpcId) {
+            RAMCLOUD_CLOG(NOTICE, "Waiting for response of RPC with id: %ld",
+                          firstMissing.load());
+            TrackedRpc* oldest = oldestOutstandingRpc();
+            if (oldest != NULL)
+                oldest->tryFinish();
+            rpcId = nextRpcId;
+            continue;
+        }
+        if (nextRpcId.compare_exchange_weak(rpcId, rpcId + 1))
+            break;
     }
-    assert(firstMissing + windowSize > nextRpcId);
-    rpcs[nextRpcId & indexMask] = ptr;
-    return nextRpcId++;
+    blockSizes[rpcId & indexMask] = 1;
+    rpcs[rpcId & indexMask] = ptr;
+    return rpcId;
 }
 
 /**
@@ -94,16 +100,22 @@ uint64_t
 RpcTracker::newRpcIdBlock(TrackedRpc* ptr, size_t size)
 {
     assert(ptr != NULL);
-    while (firstMissing + windowSize <= nextRpcId) {
-        RAMCLOUD_CLOG(NOTICE, "Waiting for response of RPC with id: %ld",
-                      firstMissing);
-        TrackedRpc* oldest = oldestOutstandingRpc();
-        oldest->tryFinish();
-    }
-    assert(firstMissing + windowSize > nextRpcId);
-    rpcs[nextRpcId & indexMask] = ptr;
     uint64_t blockRpcId = nextRpcId;
-    nextRpcId += size;
+    while (true) {
+        if (firstMissing + windowSize <= blockRpcId) {
+            RAMCLOUD_CLOG(NOTICE, "Waiting for response of RPC with id: %ld",
+                          firstMissing.load());
+            TrackedRpc* oldest = oldestOutstandingRpc();
+            if (oldest != NULL)
+                oldest->tryFinish();
+            blockRpcId = nextRpcId;
+            continue;
+        }
+        if (nextRpcId.compare_exchange_weak(blockRpcId, blockRpcId + size))
+            break;
+    }
+    blockSizes[blockRpcId & indexMask] = size;
+    rpcs[blockRpcId & indexMask] = ptr;
     return blockRpcId;
 }
 
@@ -123,13 +135,30 @@ RpcTracker::ackId()
 /**
  * Return the pointer to the oldest outstanding linearizable RPC.
  * \return
- *      Pointer to linearizable RPC wrapper with smallest rpdId.
+ *      Pointer to linearizable RPC wrapper with smallest rpdId, or NULL if
+ *      another thread is still in the middle of allocating its id (the
+ *      caller should try again).
  */
 RpcTracker::TrackedRpc*
 RpcTracker::oldestOutstandingRpc()
 {
-    assert(rpcs[firstMissing & indexMask]);
     return rpcs[firstMissing & indexMask];
 }
 
+/**
+ * Move #firstMissing past every RPC that has finished. Any number of threads
+ * may do this at once; each step is a compare-and-swap, so they never move
+ * it past an RPC that hasn't finished or move it backwards.
+ */
+void
+RpcTracker::advanceFirstMissing()
+{
+    uint64_t first = firstMissing;
+    while (first < nextRpcId && finishedIds[first & indexMask] == first) {
+        uint64_t next = first + blockSizes[first & indexMask];
+        if (firstMissing.compare_exchange_weak(first, next))
+            first = next;
+    }
+}
+
 } // namespace RAMCloud
@@ -16,6 +16,8 @@
 #ifndef RAMCLOUD_RPCTRACKER_H
 #define RAMCLOUD_RPCTRACKER_H
 
+#include <atomic>
+
 namespace RAMCloud {
 
 class RamCloud;
@@ -28,6 +30,13 @@ class RamCloud;
  * to keep necessary information for sending linearizable RPCs.
  * By using RpcTracker, client can fill up necessary information
  * (rpcId and ackId) on Rpc header.
+ *
+ * The methods don't take any locks, so that threads sharing a RamCloud
+ * object don't serialize on every linearizable RPC: ids are handed out
+ * with a compare-and-swap on #nextRpcId, and whichever thread finishes the
+ * oldest outstanding RPC advances #firstMissing (and hence the ackId) with
+ * another one. An RPC's record in the window is only ever touched by the
+ * thread that allocated or finished it.
  */
 class RpcTracker {
   PUBLIC:
@@ -64,7 +73,15 @@ class RpcTracker {
         : firstMissing(1)
         , nextRpcId(1)
         , rpcs()
-    {}
+        , finishedIds()
+        , blockSizes()
+    {
+        for (int i = 0; i < windowSize; i++) {
+            rpcs[i] = NULL;
+            finishedIds[i] = 0;
+            blockSizes[i] = 1;
+        }
+    }
     ~RpcTracker();
 
     void rpcFinished(uint64_t rpcId);
@@ -82,18 +99,18 @@ class RpcTracker {
     }
 
   PRIVATE:
-    void resizeRpcs(int increment);
+    void advanceFirstMissing();
 
     /**
      * Smallest rpcId among rpcs that haven't received results.
      */
-    uint64_t firstMissing;
+    std::atomic<uint64_t> firstMissing;
 
     /**
      * Next rpc id to be used for new RPC. This value increases monotonically.
      * The value 0 is reserved for error handling.
      */
-    uint64_t nextRpcId;
+    std::atomic<uint64_t> nextRpcId;
 
     /**
      * Maximum allowed distance between ackId and rpcId.
@@ -130,7 +147,22 @@ class RpcTracker {
      * As a rpcFinished is called to record receipt, it checks whether
      * we can advance firstMissing value.
      */
-    TrackedRpc* rpcs[windowSize];
+    std::atomic<TrackedRpc*> rpcs[windowSize];
+
+    /**
+     * The entry for an RPC holds its id once it has finished; until then it
+     * holds the id of an older RPC that used the same entry. Unlike a NULL
+     * entry in #rpcs, this can't be mistaken for a finished RPC while the
+     * id of a new one is being allocated.
+     */
+    std::atomic<uint64_t> finishedIds[windowSize];
+
+    /**
+     * Number of ids allocated to the RPC whose id maps to each entry: 1,
+     * except for blocks allocated with newRpcIdBlock. Ids inside a block
+     * have no entries of their own.
+     */
+    uint64_t blockSizes[windowSize];
 
     DISALLOW_COPY_AND_ASSIGN(RpcTracker);
 };
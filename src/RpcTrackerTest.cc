@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <thread>
+
 #include "TestUtil.h"
 #include "RpcTracker.h"
 
@@ -83,6 +85,7 @@ TEST_F(RpcTrackerTest, rpcFinished_basic) {
 TEST_F(RpcTrackerTest, rpcFinished_outOfBounds) {
     // Test Lower Bound
     tracker.firstMissing = 4;
+    tracker.nextRpcId = 6;
     tracker.rpcs[3 & tracker.indexMask] = w;
     tracker.rpcs[4 & tracker.indexMask] = w;
     tracker.rpcs[5 & tracker.indexMask] = w;
@@ -109,6 +112,8 @@ TEST_F(RpcTrackerTest, rpcFinished_outOfBounds) {
 
     // Test Upper Bound
     tracker.firstMissing = 4;
+    tracker.finishedIds[4 & tracker.indexMask] = 0;
+    tracker.finishedIds[5 & tracker.indexMask] = 0;
     tracker.rpcs[3 & tracker.indexMask] = w;
     tracker.rpcs[4 & tracker.indexMask] = w;
     tracker.rpcs[5 & tracker.indexMask] = w;
@@ -244,6 +249,24 @@ TEST_F(RpcTrackerTest, newRpcIdBlock_fullWindow) {
     TestLog::reset();
 }
 
+static void
+allocateAndFinish(RpcTracker* tracker, RpcTracker::TrackedRpc* w, int count)
+{
+    for (int i = 0; i < count; i++)
+        tracker->rpcFinished(tracker->newRpcId(w));
+}
+
+TEST_F(RpcTrackerTest, concurrentThreads) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++)
+        threads.emplace_back(allocateAndFinish, &tracker, w, 10000);
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(40001UL, tracker.nextRpcId);
+    EXPECT_EQ(40000UL, tracker.ackId());
+    EXPECT_FALSE(tracker.hasUnfinishedRpc());
+}
+
 TEST_F(RpcTrackerTest, ackId) {
     EXPECT_EQ(tracker.newRpcId(w), 1UL);
     EXPECT_EQ(tracker.newRpcId(w), 2UL);
@@ -44,6 +44,8 @@ RpcWrapper::RpcWrapper(uint32_t responseHeaderLength, Buffer* response)
     , state(NOT_STARTED)
     , session(NULL)
     , retryTime(0)
+    , hedgeTime(0)
+    , hedge()
     , responseHeaderLength(responseHeaderLength)
     , responseHeader(NULL)
 {
@@ -77,9 +79,101 @@ RpcWrapper::cancel()
     if ((getState() == IN_PROGRESS) && session) {
         session->cancelRequest(this);
     }
+    cancelHedge();
     state = CANCELED;
 }
 
+/**
+ * Abort the hedge for the current attempt, if there is one; the transport
+ * will no longer access it.
+ */
+void
+RpcWrapper::cancelHedge()
+{
+    hedgeTime = 0;
+    if (!hedge)
+        return;
+    if (hedge->state == IN_PROGRESS)
+        hedge->session->cancelRequest(hedge.get());
+    hedge.destroy();
+}
+
+/**
+ * Invoked by isReady for RPCs that may be hedged (see #hedgeTime): sends
+ * the hedge once it is due, and, if it returns successfully before the
+ * original request, makes its response the RPC's.
+ */
+void
+RpcWrapper::checkHedge()
+{
+    RpcState copyOfState = getState();
+    if (copyOfState != IN_PROGRESS && copyOfState != FAILED) {
+        // The original request finished first (or is being retried, in
+        // which case a new hedge may be sent for the new attempt).
+        cancelHedge();
+        return;
+    }
+    if (!hedge) {
+        if (copyOfState == FAILED || Cycles::rdtsc() < hedgeTime)
+            return;
+        Transport::SessionRef hedgeSession = getHedgeSession();
+        if (!hedgeSession) {
+            hedgeTime = 0;
+            return;
+        }
+        hedge.construct(hedgeSession);
+        RpcTrace::recordSend(&request);
+        hedgeSession->sendRequest(&request, &hedge->response, hedge.get());
+        return;
+    }
+
+    RpcState hedgeState = hedge->state;
+    Fence::lfence();
+    if (hedgeState == IN_PROGRESS) {
+        // If the original request failed, it will be retried, and the
+        // retry gets a hedge of its own.
+        if (copyOfState == FAILED)
+            cancelHedge();
+        return;
+    }
+    const WireFormat::ResponseCommon* hedgeHeader =
+            hedge->response.getStart<WireFormat::ResponseCommon>();
+    if (hedgeState == FAILED || hedgeHeader == NULL ||
+            hedgeHeader->status != STATUS_OK) {
+        // Leave the RPC to the original request.
+        cancelHedge();
+        return;
+    }
+
+    // The hedge won. Once cancelRequest returns, the transport won't touch
+    // the response buffer again, so the hedge's response can replace it.
+    if (copyOfState == IN_PROGRESS)
+        session->cancelRequest(this);
+    response->reset();
+    for (Buffer::Iterator it(&hedge->response); !it.isDone(); it.next())
+        response->appendCopy(it.getData(), it.getLength());
+    session = hedge->session;
+    cancelHedge();
+    hedgeCompleted();
+    Fence::sfence();
+    state = FINISHED;
+}
+
+/**
+ * This method is invoked by isReady to find where to send a hedge (see
+ * #hedgeTime). Subclasses that set #hedgeTime must override it; the
+ * default version returns NULL.
+ *
+ * \return
+ *      The session on which to send a duplicate of the request, or NULL
+ *      if there is nowhere else to send it.
+ */
+Transport::SessionRef
+RpcWrapper::getHedgeSession()
+{
+    return Transport::SessionRef();
+}
+
 /**
  * This method is invoked by isReady when an RPC returns with an error
  * status that isn't known to isReady. Subclasses can override the
@@ -106,7 +200,10 @@ RpcWrapper::completed() {
     // methods, it's important that it does nothing except modify
     // state. Don't add any more functionality to this method
     // unless you carefully review all of the synchronization
-    // properties of RpcWrappers!
+    // properties of RpcWrappers! (Recording a trace event is safe: it
+    // only reads the request, which nobody modifies while the RPC is
+    // in progress, and writes a thread-local trace buffer.)
+    RpcTrace::recordReply(&request);
     Fence::sfence();
     state = FINISHED;
 }
@@ -153,6 +250,8 @@ bool
 RpcWrapper::isReady() {
     // Note: in addition to indicating whether the RPC is complete,
     // this method is where all the work of retrying is implemented.
+    if (hedgeTime != 0 || hedge)
+        checkHedge();
     RpcState copyOfState = getState();
 
     if (copyOfState == FINISHED) {
@@ -164,6 +263,8 @@ RpcWrapper::isReady() {
                 response->getRange(0, responseHeaderLength));
         if ((responseHeader != NULL) &&
                 (responseHeader->status == STATUS_OK)) {
+            if (session && session->retryBackoffMicros != 0)
+                relaxRetryBackoff();
             return true;
         }
 
@@ -224,8 +325,20 @@ RpcWrapper::isReady() {
                         session->serviceLocator.c_str(),
                         WireFormat::opcodeSymbol(&request));
             }
-            retry(retryResponse->minDelayMicros,
-                    retryResponse->maxDelayMicros);
+            // Back off further if the server keeps asking us to; see
+            // Session::retryBackoffMicros.
+            uint32_t backoff = 0;
+            if (session) {
+                backoff = session->retryBackoffMicros;
+                uint32_t next = 2 * backoff;
+                if (next < MIN_RETRY_BACKOFF_MICROS)
+                    next = MIN_RETRY_BACKOFF_MICROS;
+                if (next > MAX_RETRY_BACKOFF_MICROS)
+                    next = MAX_RETRY_BACKOFF_MICROS;
+                session->retryBackoffMicros = next;
+            }
+            retry(retryResponse->minDelayMicros + backoff,
+                    retryResponse->maxDelayMicros + backoff);
             return false;
         }
 
@@ -262,6 +375,20 @@ RpcWrapper::isReady() {
     return false;
 }
 
+/**
+ * Invoked by isReady when a response arrives successfully from a server
+ * whose session has a retry backoff: shrink the backoff additively (see
+ * Session::retryBackoffMicros). Concurrent updates from other threads may
+ * be lost, which only perturbs the backoff slightly.
+ */
+void
+RpcWrapper::relaxRetryBackoff()
+{
+    uint32_t backoff = session->retryBackoffMicros;
+    session->retryBackoffMicros = (backoff > RETRY_BACKOFF_DECREASE_MICROS)
+            ? backoff - RETRY_BACKOFF_DECREASE_MICROS : 0;
+}
+
 /**
  * This method is invoked in situations where the RPC should be retried
  * after a time delay. This method sets up state for that delay; it doesn't
@@ -303,8 +430,10 @@ RpcWrapper::send()
     //   session member before invoking this method.
 
     state = IN_PROGRESS;
-    if (session)
+    if (session) {
+        RpcTrace::recordSend(&request);
         session->sendRequest(&request, response, this);
+    }
 }
 
 /**
@@ -18,6 +18,7 @@
 
 #include "Fence.h"
 #include "RpcLevel.h"
+#include "RpcTrace.h"
 #include "ServerId.h"
 #include "Transport.h"
 #include "WireFormat.h"
@@ -84,7 +85,8 @@ class RpcWrapper : public Transport::RpcNotifier {
 
     /**
      * Given an RPC type (from WireFormat), allocates a request header
-     * in the request buffer, initializes its opcode and service fields,
+     * in the request buffer, initializes its opcode and service fields
+     * (plus the trace fields, if the request is traced; see RpcTrace),
      * and zeroes everything else.
      *
      * \tparam RpcType
@@ -111,6 +113,7 @@ class RpcWrapper : public Transport::RpcNotifier {
         memset(reqHdr, 0, sizeof(*reqHdr));
         reqHdr->common.opcode = RpcType::opcode;
         reqHdr->common.service = RpcType::service;
+        RpcTrace::stamp(&reqHdr->common);
         return reqHdr;
     }
 
@@ -118,7 +121,7 @@ class RpcWrapper : public Transport::RpcNotifier {
      * Given an RPC type (from WireFormat) that uses RequestCommonWithId
      * (i.e. the request header contains a target server id), allocates a
      * request header in the request buffer, initializes its opcode,
-     * service, and targetId fields, and zeroes everything else.
+     * service, trace, and targetId fields, and zeroes everything else.
      *
      * \tparam RpcType
      *      A type from WireFormat, such as WireFormat::Read; determines
@@ -143,6 +146,7 @@ class RpcWrapper : public Transport::RpcNotifier {
         reqHdr->common.opcode = RpcType::opcode;
         reqHdr->common.service = RpcType::service;
         reqHdr->common.targetId = targetId.getId();
+        RpcTrace::stamp(&reqHdr->common);
         return reqHdr;
     }
 
@@ -205,7 +209,11 @@ class RpcWrapper : public Transport::RpcNotifier {
         return result;
     }
 
+    virtual Transport::SessionRef getHedgeSession();
     virtual bool handleTransportError();
+    /// Invoked by isReady when a hedge's response has replaced that of
+    /// the original request; #session is now the hedge's.
+    virtual void hedgeCompleted() {}
     void retry(uint32_t minDelayMicros, uint32_t maxDelayMicros);
     virtual void send();
     void simpleWait(Context* context);
@@ -236,6 +244,52 @@ class RpcWrapper : public Transport::RpcNotifier {
     /// Retry the RPC when Cycles::rdtsc reaches this value.
     uint64_t retryTime;
 
+    /// Session::retryBackoffMicros starts here after a STATUS_RETRY, and
+    /// doubles with each further one up to MAX_RETRY_BACKOFF_MICROS.
+    static const uint32_t MIN_RETRY_BACKOFF_MICROS = 50;
+    static const uint32_t MAX_RETRY_BACKOFF_MICROS = 100000;
+
+    /// Session::retryBackoffMicros shrinks by this much with each
+    /// successful response.
+    static const uint32_t RETRY_BACKOFF_DECREASE_MICROS = 10;
+
+    /// If nonzero and the RPC is still in progress when Cycles::rdtsc
+    /// reaches this value, isReady sends a duplicate of the request (a
+    /// hedge) to the session returned by getHedgeSession, and the RPC
+    /// completes with whichever response arrives first. Only subclasses
+    /// for idempotent RPCs set this, in their send methods.
+    uint64_t hedgeTime;
+
+    /**
+     * A duplicate of the request, sent to bound the RPC's latency when
+     * its first server is slow (see #hedgeTime).
+     */
+    class Hedge : public Transport::RpcNotifier {
+      public:
+        explicit Hedge(Transport::SessionRef session)
+            : response()
+            , session(session)
+            , state(IN_PROGRESS)
+        {}
+        virtual void completed() { state = FINISHED; }
+        virtual void failed() { state = FAILED; }
+
+        /// The duplicate's response.
+        Buffer response;
+
+        /// Session the duplicate was sent on.
+        Transport::SessionRef session;
+
+        /// IN_PROGRESS, FINISHED or FAILED; set by the transport like
+        /// RpcWrapper::state.
+        Atomic<RpcState> state;
+
+        DISALLOW_COPY_AND_ASSIGN(Hedge);
+    };
+
+    /// The hedge for the current attempt, if one has been sent.
+    Tub<Hedge> hedge;
+
     /// Expected size of the response header, in bytes.
     const uint32_t responseHeaderLength;
 
@@ -244,6 +298,11 @@ class RpcWrapper : public Transport::RpcNotifier {
     /// least responseHeaderLength bytes if the RPC succeeds.
     const WireFormat::ResponseCommon* responseHeader;
 
+  PRIVATE:
+    void cancelHedge();
+    void checkHedge();
+    void relaxRetryBackoff();
+
     DISALLOW_COPY_AND_ASSIGN(RpcWrapper);
 };
 
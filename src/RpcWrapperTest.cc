@@ -36,6 +36,21 @@ class LogRpcWrapper : public RpcWrapper {
     }
 };
 
+class HedgeRpcWrapper : public RpcWrapper {
+  public:
+    explicit HedgeRpcWrapper(uint32_t responseHeaderLength)
+        : RpcWrapper(responseHeaderLength)
+        , hedgeSession()
+    {}
+    virtual Transport::SessionRef getHedgeSession() {
+        return hedgeSession;
+    }
+    virtual void hedgeCompleted() {
+        TEST_LOG("hedgeCompleted called");
+    }
+    Transport::SessionRef hedgeSession;
+};
+
 class RpcWrapperTest : public ::testing::Test {
   public:
     Context context;
@@ -167,6 +182,34 @@ TEST_F(RpcWrapperTest, isReady_infoInResponse) {
     EXPECT_GE(Cycles::fromSeconds(2.0e-03), delay);
     Cycles::mockTscValue = 1000;
 }
+TEST_F(RpcWrapperTest, isReady_retryBackoff) {
+    RpcWrapper wrapper(4);
+    wrapper.session = session;
+    Cycles::mockTscValue = 1000;
+    uint32_t expected[] = {50, 100, 200};
+    for (int i = 0; i < 3; i++) {
+        uint32_t backoff = session->retryBackoffMicros;
+        wrapper.response->reset();
+        Service::prepareRetryResponse(wrapper.response, 100, 100, NULL);
+        wrapper.state = RpcWrapper::RpcState::FINISHED;
+        EXPECT_FALSE(wrapper.isReady());
+        EXPECT_EQ(expected[i], session->retryBackoffMicros.load());
+        EXPECT_EQ(int(100 + backoff), int(1e06*Cycles::toSeconds(
+                wrapper.retryTime - 1000) + 0.5));
+    }
+    Cycles::mockTscValue = 0;
+
+    // Each successful response relaxes the backoff a bit.
+    wrapper.response->reset();
+    setStatus(wrapper.response, Status::STATUS_OK);
+    wrapper.state = RpcWrapper::RpcState::FINISHED;
+    EXPECT_TRUE(wrapper.isReady());
+    EXPECT_EQ(190u, session->retryBackoffMicros.load());
+    session->retryBackoffMicros = 5;
+    EXPECT_TRUE(wrapper.isReady());
+    EXPECT_EQ(0u, session->retryBackoffMicros.load());
+}
+
 TEST_F(RpcWrapperTest, isReady_retryResponseTooShort) {
     TestLog::Enable _;
     RpcWrapper wrapper(4);
@@ -199,6 +242,80 @@ TEST_F(RpcWrapperTest, isReady_inProgress) {
     EXPECT_STREQ("IN_PROGRESS", wrapper.stateString());
 }
 
+TEST_F(RpcWrapperTest, isReady_hedgeWins) {
+    TestLog::Enable _;
+    ServiceLocator hedgeLocator("test:server=2");
+    HedgeRpcWrapper wrapper(4);
+    wrapper.hedgeSession = transport.getSession(&hedgeLocator);
+    wrapper.session = session;
+    wrapper.state = RpcWrapper::RpcState::IN_PROGRESS;
+
+    // Not due yet.
+    wrapper.hedgeTime = Cycles::rdtsc() + Cycles::fromSeconds(100);
+    EXPECT_FALSE(wrapper.isReady());
+    EXPECT_FALSE(wrapper.hedge);
+
+    wrapper.hedgeTime = Cycles::rdtsc();
+    EXPECT_FALSE(wrapper.isReady());
+    ASSERT_TRUE(wrapper.hedge);
+    EXPECT_EQ("sendRequest: ", transport.outputLog);
+    EXPECT_FALSE(wrapper.isReady());
+
+    setStatus(&wrapper.hedge->response, Status::STATUS_OK);
+    wrapper.hedge->response.appendCopy("abc", 3);
+    wrapper.hedge->completed();
+    EXPECT_TRUE(wrapper.isReady());
+    EXPECT_STREQ("FINISHED", wrapper.stateString());
+    EXPECT_EQ("sendRequest:  | cancel: ", transport.outputLog);
+    EXPECT_EQ(7U, wrapper.response->size());
+    EXPECT_EQ("abc", TestUtil::toString(wrapper.response, 4, 3));
+    EXPECT_TRUE(wrapper.session == wrapper.hedgeSession);
+    EXPECT_FALSE(wrapper.hedge);
+    EXPECT_EQ(0U, wrapper.hedgeTime);
+    EXPECT_EQ("hedgeCompleted: hedgeCompleted called", TestLog::get());
+}
+
+TEST_F(RpcWrapperTest, isReady_hedgeLoses) {
+    ServiceLocator hedgeLocator("test:server=2");
+    HedgeRpcWrapper wrapper(4);
+    wrapper.hedgeSession = transport.getSession(&hedgeLocator);
+    wrapper.session = session;
+    wrapper.state = RpcWrapper::RpcState::IN_PROGRESS;
+    wrapper.hedgeTime = Cycles::rdtsc();
+    EXPECT_FALSE(wrapper.isReady());
+    ASSERT_TRUE(wrapper.hedge);
+
+    // An error from the hedge leaves the RPC to the original request.
+    setStatus(&wrapper.hedge->response, Status::STATUS_UNKNOWN_TABLET);
+    wrapper.hedge->completed();
+    EXPECT_FALSE(wrapper.isReady());
+    EXPECT_FALSE(wrapper.hedge);
+    EXPECT_EQ(0U, wrapper.hedgeTime);
+
+    // The original request finishes while the hedge is outstanding.
+    transport.outputLog.clear();
+    wrapper.hedgeTime = Cycles::rdtsc();
+    EXPECT_FALSE(wrapper.isReady());
+    ASSERT_TRUE(wrapper.hedge);
+    setStatus(wrapper.response, Status::STATUS_OK);
+    wrapper.completed();
+    EXPECT_TRUE(wrapper.isReady());
+    EXPECT_EQ("sendRequest:  | cancel: ", transport.outputLog);
+    EXPECT_FALSE(wrapper.hedge);
+    EXPECT_TRUE(wrapper.session == session);
+}
+
+TEST_F(RpcWrapperTest, isReady_hedgeNowhereToGo) {
+    HedgeRpcWrapper wrapper(4);
+    wrapper.session = session;
+    wrapper.state = RpcWrapper::RpcState::IN_PROGRESS;
+    wrapper.hedgeTime = Cycles::rdtsc();
+    EXPECT_FALSE(wrapper.isReady());
+    EXPECT_FALSE(wrapper.hedge);
+    EXPECT_EQ(0U, wrapper.hedgeTime);
+    EXPECT_EQ("", transport.outputLog);
+}
+
 TEST_F(RpcWrapperTest, isReady_retry) {
     RpcWrapper wrapper(4);
     wrapper.session = session;
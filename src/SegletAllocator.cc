@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <sys/syscall.h>
+
 #include "Common.h"
 #include "BitOps.h"
 #include "LogSegment.h"
@@ -20,13 +22,21 @@
 #include "Segment.h"
 #include "ServerConfig.h"
 #include "ShortMacros.h"
+#include "ThreadId.h"
 
 namespace RAMCloud {
 
+namespace {
+/// Values from <numaif.h>, which we don't otherwise depend on.
+enum { MPOL_BIND_POLICY = 2, MPOL_MF_STRICT_FLAG = 1, MPOL_MF_MOVE_FLAG = 2 };
+}
+
 /**
  * Construct a new SegmentAllocator by allocating a large chunk of memory
  * and chopping it up into individual seglets of the specified size. All
- * seglets will be placed in the lowest priority "default" pool.
+ * seglets will be placed in the lowest priority "default" pool. If the
+ * configuration names a flash tier file, it is mapped and chopped up into
+ * FLASH seglets as well.
  *
  * \param config
  *      Server runtime configuration, specifying various parameters like
@@ -41,18 +51,51 @@ SegletAllocator::SegletAllocator(const ServerConfig* config)
       emergencyHeadPoolReserve(0),
       cleanerPool(),
       cleanerPoolReserve(0),
-      defaultPool(),
+      defaultPools(std::max(config->master.numaNodes, 1U)),
+      segletsPerNode(0),
+      localAllocations(0),
+      remoteAllocations(0),
       segletToSegmentTable(),
-      block(config->master.logBytes)
+      block(config->master.logBytes),
+      flash(),
+      flashPool(),
+      magazines(),
+      magazinesEnabled(defaultPools.size() == 1),
+      cachedSeglets(0),
+      cleanerPoolShort(false),
+      magazineAllocations(0),
+      magazineFrees(0),
+      poolLockAcquisitions(0),
+      poolLockContentions(0)
 {
     assert(BitOps::isPowerOfTwo(segletSize));
+    size_t numSeglets = block.length / segletSize;
+    size_t numNodes = defaultPools.size();
+    segletsPerNode = (numSeglets + numNodes - 1) / numNodes;
+
     uint8_t* segletBlock = block.get();
-    for (size_t i = 0; i < (block.length / segletSize); i++) {
+    for (size_t i = 0; i < numSeglets; i++) {
         Seglet* seglet = new Seglet(*this, segletBlock, segletSize);
         segletToSegmentTable.push_back(NULL);
-        defaultPool.push_back(seglet);
+        defaultPools[i / segletsPerNode].push_back(seglet);
         segletBlock += segletSize;
     }
+
+    if (numNodes > 1)
+        bindToNodes();
+
+    if (!config->master.flashTierFile.empty()) {
+        flash.construct(config->master.flashTierFile,
+                        config->master.flashTierBytes, segletSize);
+        uint8_t* flashSeglet = flash->get();
+        for (size_t i = 0; i < flash->length / segletSize; i++) {
+            Seglet* seglet = new Seglet(*this, flashSeglet, segletSize);
+            seglet->setSourcePool(&flashPool);
+            segletToSegmentTable.push_back(NULL);
+            flashPool.push_back(seglet);
+            flashSeglet += segletSize;
+        }
+    }
 }
 
 /**
@@ -63,8 +106,10 @@ SegletAllocator::~SegletAllocator()
 {
     size_t totalFree = emergencyHeadPool.size() +
                        cleanerPool.size() +
-                       defaultPool.size();
-    size_t expectedFree = block.length / segletSize;
+                       getDefaultFreeCount() +
+                       flashPool.size();
+    size_t expectedFree = block.length / segletSize +
+                          getTotalCount(FLASH);
 
     if (totalFree != expectedFree)
         LOG(WARNING, "Destructor called before all seglets freed!");
@@ -73,8 +118,16 @@ SegletAllocator::~SegletAllocator()
         delete s;
     foreach (Seglet* s, cleanerPool)
         delete s;
-    foreach (Seglet* s, defaultPool)
+    foreach (vector<Seglet*>& pool, defaultPools) {
+        foreach (Seglet* s, pool)
+            delete s;
+    }
+    foreach (Seglet* s, flashPool)
         delete s;
+    foreach (Magazine& magazine, magazines) {
+        foreach (Seglet* s, magazine.seglets)
+            delete s;
+    }
 }
 
 /**
@@ -95,7 +148,16 @@ SegletAllocator::getMetrics(ProtoBuf::LogMetrics_SegletMetrics& m)
     m.set_emergency_head_pool_count(emergencyHeadPool.size());
     m.set_cleaner_pool_reserve(cleanerPoolReserve);
     m.set_cleaner_pool_count(cleanerPool.size());
-    m.set_default_pool_count(defaultPool.size());
+    m.set_default_pool_count(getDefaultFreeCount());
+    foreach (vector<Seglet*>& pool, defaultPools)
+        m.add_numa_node_free_seglets(pool.size());
+    m.set_numa_local_allocations(localAllocations);
+    m.set_numa_remote_allocations(remoteAllocations);
+    m.set_cached_seglets(cachedSeglets);
+    m.set_magazine_allocations(magazineAllocations);
+    m.set_magazine_frees(magazineFrees);
+    m.set_pool_lock_acquisitions(poolLockAcquisitions);
+    m.set_pool_lock_contentions(poolLockContentions);
 }
 
 /**
@@ -116,15 +178,39 @@ SegletAllocator::alloc(AllocationType type,
                        uint32_t count,
                        vector<Seglet*>& outSeglets)
 {
-    std::lock_guard<SpinLock> guard(lock);
-
-    if (type == EMERGENCY_HEAD)
-        return allocFromPool(emergencyHeadPool, count, outSeglets);
-
-    if (type == CLEANER)
-        return allocFromPool(cleanerPool, count, outSeglets);
+    if (type == DEFAULT && magazinesEnabled &&
+            allocFromMagazine(count, outSeglets)) {
+        return true;
+    }
 
-    return allocFromPool(defaultPool, count, outSeglets);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        // If the pools are short, seglets cached in magazines (possibly
+        // including some that should have refilled the cleaner's reserve)
+        // are returned to them before trying again.
+        if (attempt == 1) {
+            if (!magazinesEnabled || cachedSeglets == 0)
+                return false;
+            drainMagazines();
+        }
+
+        lockPools();
+        std::lock_guard<SpinLock> guard(lock, std::adopt_lock);
+
+        bool success;
+        if (type == EMERGENCY_HEAD) {
+            success = allocFromPool(emergencyHeadPool, count, outSeglets);
+        } else if (type == CLEANER) {
+            success = allocFromPool(cleanerPool, count, outSeglets);
+            cleanerPoolShort = cleanerPool.size() < cleanerPoolReserve;
+        } else if (type == FLASH) {
+            success = allocFromPool(flashPool, count, outSeglets);
+        } else {
+            success = allocFromDefaultPools(count, outSeglets);
+        }
+        if (success || type == FLASH)
+            return success;
+    }
+    return false;
 }
 
 /**
@@ -148,7 +234,7 @@ SegletAllocator::initializeEmergencyHeadReserve(uint32_t numSeglets)
     if (emergencyHeadPoolReserve != 0)
         return false;
 
-    if (!allocFromPool(defaultPool, numSeglets, emergencyHeadPool))
+    if (!allocFromDefaultPools(numSeglets, emergencyHeadPool))
         return false;
 
     foreach (Seglet* seglet, emergencyHeadPool)
@@ -158,8 +244,8 @@ SegletAllocator::initializeEmergencyHeadReserve(uint32_t numSeglets)
         "%lu seglets (%lu MB) left in default pool.",
         numSeglets,
         static_cast<uint64_t>(numSeglets) * segletSize / 1024 / 1024,
-        defaultPool.size(),
-        defaultPool.size() * segletSize / 1024 / 1024);
+        getDefaultFreeCount(),
+        getDefaultFreeCount() * segletSize / 1024 / 1024);
 
     emergencyHeadPoolReserve = numSeglets;
     return true;
@@ -186,17 +272,18 @@ SegletAllocator::initializeCleanerReserve(uint32_t numSeglets)
     if (cleanerPoolReserve != 0)
         return false;
 
-    if (!allocFromPool(defaultPool, numSeglets, cleanerPool))
+    if (!allocFromDefaultPools(numSeglets, cleanerPool))
         return false;
 
     LOG(NOTICE, "Reserved %u seglets for the cleaner (%lu MB). %lu seglets "
         "(%lu MB) left in default pool.",
         numSeglets,
         static_cast<uint64_t>(numSeglets) * segletSize / 1024 / 1024,
-        defaultPool.size(),
-        defaultPool.size() * segletSize / 1024 / 1024);
+        getDefaultFreeCount(),
+        getDefaultFreeCount() * segletSize / 1024 / 1024);
 
     cleanerPoolReserve = numSeglets;
+    cleanerPoolShort = false;
     return true;
 }
 
@@ -207,40 +294,19 @@ SegletAllocator::initializeCleanerReserve(uint32_t numSeglets)
 void
 SegletAllocator::free(Seglet* seglet)
 {
-    if (DEBUG_BUILD)
+    // Scribbling on a flash seglet would cost a write to flash.
+    if (DEBUG_BUILD && seglet->getSourcePool() != &flashPool)
         memset(seglet->get(), '!', seglet->getLength());
 
-    std::lock_guard<SpinLock> guard(lock);
-
     // This seglet no longer belongs to any segment, so update that fact first.
     setOwnerSegment(seglet, NULL);
 
-    // The emergency head pool is special. Seglets that came from it must be
-    // returned to it. Futhermore, only segments that came from it should be
-    // returned.
-    //
-    // The reason is a little subtle. The problem with always preferring to put
-    // seglets into this pool if it's non-empty is that under high memory
-    // utilization we could fail to re-fill the cleaner's pool, preventing it
-    // from having enough space to work with and deadlocking the system.
-    if (seglet->getSourcePool() == &emergencyHeadPool) {
-        emergencyHeadPool.push_back(seglet);
-        return;
-    }
-
-    // Any seglets not allocated to emergency heads should be used to fill empty
-    // space in the cleaner reserve. The cleaner maintains the invariant that
-    // after every pass it has consumed no more seglets than it has freed. Thus
-    // this pool should never remain non-full for long.
-    if (cleanerPool.size() < cleanerPoolReserve) {
-        cleanerPool.push_back(seglet);
+    if (freeToMagazine(seglet))
         return;
-    }
 
-    // If we're making forward progress, any excess clean seglets accumulate in
-    // the default pool. New log heads can allocate from this to service new
-    // log appends.
-    defaultPool.push_back(seglet);
+    lockPools();
+    std::lock_guard<SpinLock> guard(lock, std::adopt_lock);
+    returnToPools(seglet);
 }
 
 /**
@@ -266,8 +332,10 @@ SegletAllocator::getFreeCount(AllocationType type)
         return emergencyHeadPool.size();
     if (type == CLEANER)
         return cleanerPool.size();
+    if (type == FLASH)
+        return flashPool.size();
     assert(type == DEFAULT);
-    return defaultPool.size();
+    return getDefaultFreeCount();
 }
 
 size_t
@@ -277,6 +345,8 @@ SegletAllocator::getTotalCount(AllocationType type)
         return emergencyHeadPoolReserve;
     if (type == CLEANER)
         return cleanerPoolReserve;
+    if (type == FLASH)
+        return flash ? flash->length / segletSize : 0;
     assert(type == DEFAULT);
     return getTotalCount() - emergencyHeadPoolReserve - cleanerPoolReserve;
 }
@@ -324,7 +394,7 @@ SegletAllocator::getMemoryUtilization()
     size_t maxDefaultPoolSize = getTotalCount() -
                                 emergencyHeadPoolReserve -
                                 cleanerPoolReserve;
-    return downCast<int>(100 * (maxDefaultPoolSize - defaultPool.size()) /
+    return downCast<int>(100 * (maxDefaultPoolSize - getDefaultFreeCount()) /
                          maxDefaultPoolSize);
 }
 
@@ -358,11 +428,169 @@ SegletAllocator::setOwnerSegment(Seglet* seglet, LogSegment* segment)
     Fence::sfence();
 }
 
+/**
+ * Allocate the requested number of seglets from the calling thread's magazine,
+ * refilling the magazine from the default pool if it is short. Nothing is
+ * allocated if the request can't be met without draining other magazines.
+ *
+ * \param count
+ *      The number of seglets to allocate.
+ * \param outSeglets
+ *      Vector to return allocated seglets in.
+ * \return
+ *      True if the full allocation succeeded, otherwise false.
+ */
+bool
+SegletAllocator::allocFromMagazine(uint32_t count, vector<Seglet*>& outSeglets)
+{
+    Magazine& magazine = magazines[ThreadId::get() % NUM_MAGAZINES];
+    std::lock_guard<SpinLock> magazineGuard(magazine.lock);
+    if (magazine.seglets.size() >= count) {
+        allocFromPool(magazine.seglets, count, outSeglets);
+        cachedSeglets -= count;
+        magazineAllocations += count;
+        return true;
+    }
+
+    lockPools();
+    std::lock_guard<SpinLock> guard(lock, std::adopt_lock);
+    vector<Seglet*>& pool = defaultPools[0];
+    if (pool.size() < count)
+        return false;
+    allocFromPool(pool, count, outSeglets);
+
+    // Take the refill along while we have the lock anyway.
+    uint32_t refill = downCast<uint32_t>(std::min<size_t>(
+        pool.size(), MAGAZINE_SIZE / 2 - std::min<size_t>(
+            magazine.seglets.size(), MAGAZINE_SIZE / 2)));
+    allocFromPool(pool, refill, magazine.seglets);
+    cachedSeglets += refill;
+    return true;
+}
+
+/**
+ * Return the seglets of all magazines to the pools. Must not be called with
+ * the monitor lock or the lock of a magazine held.
+ */
+void
+SegletAllocator::drainMagazines()
+{
+    foreach (Magazine& magazine, magazines) {
+        std::lock_guard<SpinLock> magazineGuard(magazine.lock);
+        if (magazine.seglets.empty())
+            continue;
+        lockPools();
+        std::lock_guard<SpinLock> guard(lock, std::adopt_lock);
+        foreach (Seglet* seglet, magazine.seglets)
+            returnToPools(seglet);
+        cachedSeglets -= magazine.seglets.size();
+        magazine.seglets.clear();
+    }
+}
+
+/**
+ * Try to free a seglet into the calling thread's magazine, flushing half of
+ * the magazine to the pools if it is full. Seglets that must go to a
+ * particular pool, and all seglets while the cleaner's reserve is short, are
+ * refused.
+ *
+ * \param seglet
+ *      The seglet being freed.
+ * \return
+ *      True if the seglet was taken, otherwise false.
+ */
+bool
+SegletAllocator::freeToMagazine(Seglet* seglet)
+{
+    if (!magazinesEnabled || seglet->getSourcePool() != NULL ||
+            cleanerPoolShort) {
+        return false;
+    }
+
+    Magazine& magazine = magazines[ThreadId::get() % NUM_MAGAZINES];
+    std::lock_guard<SpinLock> magazineGuard(magazine.lock);
+    magazine.seglets.push_back(seglet);
+    cachedSeglets++;
+    magazineFrees++;
+    if (magazine.seglets.size() > MAGAZINE_SIZE) {
+        lockPools();
+        std::lock_guard<SpinLock> guard(lock, std::adopt_lock);
+        for (uint32_t i = 0; i < MAGAZINE_SIZE / 2; i++) {
+            returnToPools(magazine.seglets.back());
+            magazine.seglets.pop_back();
+        }
+        cachedSeglets -= MAGAZINE_SIZE / 2;
+    }
+    return true;
+}
+
+/**
+ * Acquire the monitor lock, keeping count of how often it is contended.
+ */
+void
+SegletAllocator::lockPools()
+{
+    bool contended = !lock.try_lock();
+    if (contended)
+        lock.lock();
+    poolLockAcquisitions++;
+    if (contended)
+        poolLockContentions++;
+}
+
+/**
+ * Put a freed seglet into the pool it belongs in.
+ *
+ * This must be called with the monitor lock held.
+ */
+void
+SegletAllocator::returnToPools(Seglet* seglet)
+{
+    // The emergency head pool is special. Seglets that came from it must be
+    // returned to it. Futhermore, only segments that came from it should be
+    // returned.
+    //
+    // The reason is a little subtle. The problem with always preferring to put
+    // seglets into this pool if it's non-empty is that under high memory
+    // utilization we could fail to re-fill the cleaner's pool, preventing it
+    // from having enough space to work with and deadlocking the system.
+    if (seglet->getSourcePool() == &emergencyHeadPool) {
+        emergencyHeadPool.push_back(seglet);
+        return;
+    }
+
+    // Flash seglets are no substitute for memory in any other pool.
+    if (seglet->getSourcePool() == &flashPool) {
+        flashPool.push_back(seglet);
+        return;
+    }
+
+    // Any seglets not allocated to emergency heads should be used to fill empty
+    // space in the cleaner reserve. The cleaner maintains the invariant that
+    // after every pass it has consumed no more seglets than it has freed. Thus
+    // this pool should never remain non-full for long.
+    if (cleanerPool.size() < cleanerPoolReserve) {
+        cleanerPool.push_back(seglet);
+        cleanerPoolShort = cleanerPool.size() < cleanerPoolReserve;
+        return;
+    }
+
+    // If we're making forward progress, any excess clean seglets accumulate in
+    // the default pool of their NUMA node. New log heads can allocate from
+    // these to service new log appends.
+    defaultPools[getSegletIndex(seglet->get()) / segletsPerNode].push_back(
+        seglet);
+}
+
 size_t
 SegletAllocator::getSegletIndex(const void* p)
 {
     uintptr_t i = reinterpret_cast<uintptr_t>(p);
     uintptr_t blockBase = reinterpret_cast<uintptr_t>(block.get());
+    if (expect_false(flash && flash->contains(p))) {
+        uintptr_t flashBase = reinterpret_cast<uintptr_t>(flash->get());
+        return ((i - flashBase) >> segletSizeShift) + getTotalCount();
+    }
     if ((i < blockBase) || (i >= (blockBase + block.length))) {
         RAMCLOUD_DIE("pointer out of range; p: %p, blockBase: 0x%lu, "
                 "length: %lu",
@@ -400,4 +628,115 @@ SegletAllocator::allocFromPool(vector<Seglet*>& pool,
     return true;
 }
 
+/**
+ * Allocate the exact number of requested seglets from the default pools,
+ * preferring the pool of the NUMA node the calling thread is running on. If
+ * that node is short, another node that can satisfy the whole request is
+ * used, and only as a last resort are the seglets gathered from several
+ * nodes. If the full allocation cannot be met, allocate nothing and return
+ * false.
+ *
+ * This must be called with the monitor lock held.
+ *
+ * \param count
+ *      The number of seglets to allocate.
+ * \param outSeglets
+ *      Vector to return allocated seglets in.
+ * \return
+ *      True if the full allocation succeeded, otherwise false.
+ */
+bool
+SegletAllocator::allocFromDefaultPools(uint32_t count,
+                                       vector<Seglet*>& outSeglets)
+{
+    size_t numNodes = defaultPools.size();
+    if (numNodes == 1)
+        return allocFromPool(defaultPools[0], count, outSeglets);
+
+    if (getDefaultFreeCount() < count)
+        return false;
+
+    size_t localNode = getCurrentNode() % numNodes;
+    for (size_t i = 0; i < numNodes; i++) {
+        size_t node = (localNode + i) % numNodes;
+        if (allocFromPool(defaultPools[node], count, outSeglets)) {
+            if (node == localNode)
+                localAllocations += count;
+            else
+                remoteAllocations += count;
+            return true;
+        }
+    }
+
+    for (size_t i = 0; i < numNodes && count > 0; i++) {
+        size_t node = (localNode + i) % numNodes;
+        uint32_t n = downCast<uint32_t>(
+            std::min<size_t>(count, defaultPools[node].size()));
+        allocFromPool(defaultPools[node], n, outSeglets);
+        if (node == localNode)
+            localAllocations += n;
+        else
+            remoteAllocations += n;
+        count -= n;
+    }
+    return true;
+}
+
+/**
+ * Return the number of free seglets in all of the default pools combined,
+ * including those cached in magazines.
+ *
+ * This must be called with the monitor lock held.
+ */
+size_t
+SegletAllocator::getDefaultFreeCount()
+{
+    size_t total = cachedSeglets;
+    foreach (vector<Seglet*>& pool, defaultPools)
+        total += pool.size();
+    return total;
+}
+
+/**
+ * Return the NUMA node of the core the calling thread is running on (0 if it
+ * can't be determined).
+ */
+uint32_t
+SegletAllocator::getCurrentNode()
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+        return 0;
+    return node;
+}
+
+/**
+ * Bind each node's share of #block to that NUMA node's memory, migrating any
+ * pages already faulted in elsewhere. The first 1/N of the seglets belong to
+ * node 0, the next 1/N to node 1, and so on. Failure (for example, on a
+ * kernel without NUMA support) is logged and otherwise ignored: the
+ * per-node pools still work, they just don't improve locality.
+ */
+void
+SegletAllocator::bindToNodes()
+{
+    size_t bytesPerNode = segletsPerNode * segletSize;
+    for (size_t node = 0; node < defaultPools.size(); node++) {
+        uint8_t* start = block.get() + node * bytesPerNode;
+        size_t length = std::min(bytesPerNode,
+                                 block.length - node * bytesPerNode);
+        unsigned long nodeMask = 1UL << node; // NOLINT
+        long r = syscall(SYS_mbind, start, length, MPOL_BIND_POLICY,
+                         &nodeMask, sizeof(nodeMask) * 8,
+                         MPOL_MF_MOVE_FLAG | MPOL_MF_STRICT_FLAG);
+        if (r != 0) {
+            LOG(WARNING, "Could not bind %lu bytes of log memory to NUMA "
+                "node %lu: %s", length, node, strerror(errno));
+            return;
+        }
+    }
+    LOG(NOTICE, "Split %lu MB of log memory across %lu NUMA nodes",
+        block.length / 1024 / 1024, defaultPools.size());
+}
+
 } // end RAMCloud
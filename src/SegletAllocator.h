@@ -16,10 +16,14 @@
 #ifndef RAMCLOUD_SEGLETALLOCATOR_H
 #define RAMCLOUD_SEGLETALLOCATOR_H
 
+#include <atomic>
+
 #include "Common.h"
+#include "FlashTier.h"
 #include "LargeBlockOfMemory.h"
 #include "Seglet.h"
 #include "SpinLock.h"
+#include "Tub.h"
 
 #include "LogMetrics.pb.h"
 
@@ -56,6 +60,13 @@ class LogSegment;
  * segments and are freed by the Segment class they're assigned to, either at
  * destruction time, or when the segment is closed and told to free unused
  * seglets that have not had data appended to them.
+ *
+ * Log heads, cleaner threads and the side logs of recovery and migration all
+ * allocate and free seglets concurrently. So that they don't serialize on
+ * the monitor lock, default pool seglets are cached in small per-thread
+ * "magazines" that are refilled from, and flushed to, the pools in batches.
+ * Seglets in magazines count as free. When the pools can't satisfy an
+ * allocation, the magazines are drained before giving up.
  */
 class SegletAllocator {
   public:
@@ -63,11 +74,17 @@ class SegletAllocator {
      * All seglets are allocated from a caller-specified pool. This allows us
      * to set aside seglets and reserve them for certain purposes. This enum
      * represents the possible pools.
+     *
+     * FLASH is different from the others: its seglets are not memory, but
+     * pieces of a file on local flash (see FlashTier) that hold cold survivor
+     * segments. It is empty unless ServerConfig::Master::flashTierFile is set,
+     * and none of the counts of memory below include it unless asked.
      */
     enum AllocationType {
         EMERGENCY_HEAD,
         CLEANER,
-        DEFAULT
+        DEFAULT,
+        FLASH
     };
 
     explicit SegletAllocator(const ServerConfig* config);
@@ -90,10 +107,47 @@ class SegletAllocator {
     void setOwnerSegment(Seglet* seglet, LogSegment* segment);
 
   PRIVATE:
+    /// Number of magazines; threads are mapped to them by their ThreadId.
+    static const uint32_t NUM_MAGAZINES = 16;
+
+    /// Largest number of seglets a magazine holds. Refills and flushes move
+    /// half this many seglets at once.
+    static const uint32_t MAGAZINE_SIZE = 16;
+
+    /**
+     * A cache of free default pool seglets used by the threads that map to
+     * it. The magazine's lock may be held when acquiring the monitor lock,
+     * but not the other way around.
+     */
+    struct Magazine {
+        Magazine()
+            : lock("SegletAllocator::Magazine::lock")
+            , seglets()
+        {
+        }
+
+        /// Protects #seglets.
+        SpinLock lock;
+
+        /// The cached seglets.
+        vector<Seglet*> seglets;
+
+        DISALLOW_COPY_AND_ASSIGN(Magazine);
+    };
+
+    bool allocFromMagazine(uint32_t count, vector<Seglet*>& outSeglets);
+    void drainMagazines();
+    bool freeToMagazine(Seglet* seglet);
+    void lockPools();
+    void returnToPools(Seglet* seglet);
     size_t getSegletIndex(const void* p);
     bool allocFromPool(vector<Seglet*>& pool,
                        uint32_t count,
                        vector<Seglet*>& outSeglets);
+    bool allocFromDefaultPools(uint32_t count, vector<Seglet*>& outSeglets);
+    size_t getDefaultFreeCount();
+    static uint32_t getCurrentNode();
+    void bindToNodes();
 
     /// Size of each seglet in bytes.
     const uint32_t segletSize;
@@ -137,8 +191,21 @@ class SegletAllocator {
     /// Maximum number of seglets to reserve in the cleanerPool.
     uint32_t cleanerPoolReserve;
 
-    /// Pool holding all other seglets not otherwise reserved.
-    vector<Seglet*> defaultPool;
+    /// Pools holding all other seglets not otherwise reserved, one for each
+    /// NUMA node (see ServerConfig::Master::numaNodes). A freed seglet always
+    /// returns to the pool of the node its memory is bound to.
+    vector<vector<Seglet*>> defaultPools;
+
+    /// Number of consecutive seglets in ``block'' that belong to each NUMA
+    /// node. The seglet at index i belongs to node i / segletsPerNode.
+    size_t segletsPerNode;
+
+    /// Default pool seglets allocated from the calling thread's own NUMA node.
+    uint64_t localAllocations;
+
+    /// Default pool seglets allocated from other NUMA nodes because the
+    /// local node had too few free.
+    uint64_t remoteAllocations;
 
     /// Table mapping blocks of memory backing Seglets to their owner LogSegment
     /// objects. This allows getOwnerSegment() to look up a LogSegment object
@@ -148,6 +215,40 @@ class SegletAllocator {
     /// Single contiguous block of memory backing all of our seglets.
     LargeBlockOfMemory<uint8_t> block;
 
+    /// The flash backing FLASH seglets, if there is any. Its seglets come
+    /// after those of #block in #segletToSegmentTable.
+    Tub<FlashTier> flash;
+
+    /// Pool holding the free FLASH seglets. Seglets allocated from it always
+    /// return to it.
+    vector<Seglet*> flashPool;
+
+    /// Per-thread caches of default pool seglets. Only used when there is a
+    /// single default pool: a magazine doesn't keep track of the NUMA node of
+    /// its seglets.
+    Magazine magazines[NUM_MAGAZINES];
+
+    /// True if #magazines are used.
+    bool magazinesEnabled;
+
+    /// Total number of seglets in #magazines.
+    std::atomic<uint64_t> cachedSeglets;
+
+    /// True while cleanerPool holds fewer than cleanerPoolReserve seglets.
+    /// Freed seglets bypass the magazines then, so that they refill the
+    /// cleaner's reserve first. Only written with the monitor lock held.
+    std::atomic<bool> cleanerPoolShort;
+
+    /// Seglets allocated from, and freed to, #magazines without taking the
+    /// monitor lock.
+    std::atomic<uint64_t> magazineAllocations;
+    std::atomic<uint64_t> magazineFrees;
+
+    /// Number of times the monitor lock was acquired by alloc() and free(),
+    /// and how many of those found it already held by another thread.
+    uint64_t poolLockAcquisitions;
+    uint64_t poolLockContentions;
+
     DISALLOW_COPY_AND_ASSIGN(SegletAllocator);
 };
 
@@ -44,7 +44,7 @@ TEST_F(SegletAllocatorTest, constructor) {
     EXPECT_EQ(0U, allocator.cleanerPoolReserve);
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     EXPECT_EQ(serverConfig.master.logBytes / serverConfig.segletSize,
-        allocator.defaultPool.size());
+        allocator.defaultPools[0].size());
 }
 
 TEST_F(SegletAllocatorTest, destructor) {
@@ -74,7 +74,7 @@ TEST_F(SegletAllocatorTest, alloc) {
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     EXPECT_FALSE(allocator.alloc(SegletAllocator::CLEANER, 1, seglets));
 
-    EXPECT_EQ(318U, allocator.defaultPool.size());
+    EXPECT_EQ(318U, allocator.defaultPools[0].size());
     EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, 254, seglets));
     EXPECT_EQ(0U, allocator.cleanerPool.size());
 
@@ -88,7 +88,8 @@ TEST_F(SegletAllocatorTest, initializeEmergencyHeadReserve) {
     EXPECT_EQ(0U, allocator.emergencyHeadPool.size());
     allocator.emergencyHeadPoolReserve = 0;
 
-    uint32_t maxSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t maxSeglets =
+        downCast<uint32_t>(allocator.defaultPools[0].size());
     EXPECT_FALSE(allocator.initializeEmergencyHeadReserve(maxSeglets + 1));
     EXPECT_EQ(0U, allocator.emergencyHeadPool.size());
 
@@ -104,7 +105,8 @@ TEST_F(SegletAllocatorTest, initializeCleanerReserve) {
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     allocator.cleanerPoolReserve = 0;
 
-    uint32_t maxSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t maxSeglets =
+        downCast<uint32_t>(allocator.defaultPools[0].size());
     EXPECT_FALSE(allocator.initializeCleanerReserve(maxSeglets + 1));
     EXPECT_EQ(0U, allocator.cleanerPool.size());
 
@@ -128,17 +130,180 @@ TEST_F(SegletAllocatorTest, free) {
     allocator.emergencyHeadPool.clear();
     seglets[0]->setSourcePool(NULL);
     allocator.cleanerPoolReserve = 1;
+    allocator.cleanerPoolShort = true;
     EXPECT_EQ(0U, allocator.cleanerPool.size());
     allocator.free(seglets[0]);
     EXPECT_EQ(1U, allocator.cleanerPool.size());
+    EXPECT_FALSE(allocator.cleanerPoolShort);
 
-    uint32_t defaultSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    size_t defaultSeglets = allocator.getFreeCount(SegletAllocator::DEFAULT);
     allocator.free(seglets[1]);
-    EXPECT_EQ(defaultSeglets + 1, allocator.defaultPool.size());
+    EXPECT_EQ(defaultSeglets + 1,
+              allocator.getFreeCount(SegletAllocator::DEFAULT));
+}
+
+TEST_F(SegletAllocatorTest, magazines_allocAndFree) {
+    vector<Seglet*> seglets;
+    size_t defaultSeglets = allocator.defaultPools[0].size();
+    uint32_t refill = SegletAllocator::MAGAZINE_SIZE / 2;
+
+    // The first allocation takes a refill for the magazine along.
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, 1, seglets));
+    EXPECT_EQ(defaultSeglets - 1 - refill, allocator.defaultPools[0].size());
+    EXPECT_EQ(refill, allocator.cachedSeglets);
+    EXPECT_EQ(defaultSeglets - 1,
+              allocator.getFreeCount(SegletAllocator::DEFAULT));
+    EXPECT_EQ(1U, allocator.poolLockAcquisitions);
+
+    // The next ones are served from the magazine without the lock.
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, 2, seglets));
+    EXPECT_EQ(refill - 2, allocator.cachedSeglets);
+    EXPECT_EQ(2U, allocator.magazineAllocations);
+    EXPECT_EQ(1U, allocator.poolLockAcquisitions);
+
+    foreach (Seglet* s, seglets)
+        s->free();
+    EXPECT_EQ(refill + 1, allocator.cachedSeglets);
+    EXPECT_EQ(3U, allocator.magazineFrees);
+    EXPECT_EQ(1U, allocator.poolLockAcquisitions);
+    EXPECT_EQ(defaultSeglets,
+              allocator.getFreeCount(SegletAllocator::DEFAULT));
+
+    ProtoBuf::LogMetrics_SegletMetrics m;
+    allocator.getMetrics(m);
+    EXPECT_EQ(refill + 1, m.cached_seglets());
+    EXPECT_EQ(2U, m.magazine_allocations());
+    EXPECT_EQ(3U, m.magazine_frees());
+    EXPECT_EQ(1U, m.pool_lock_acquisitions());
+    EXPECT_EQ(0U, m.pool_lock_contentions());
+}
+
+TEST_F(SegletAllocatorTest, magazines_flushWhenFull) {
+    vector<Seglet*> seglets;
+    uint32_t count = SegletAllocator::MAGAZINE_SIZE / 2 + 1;
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, count, seglets));
+    size_t cached = allocator.cachedSeglets;
+
+    // Overfilling the magazine sends half of it back to the pool.
+    foreach (Seglet* s, seglets)
+        s->free();
+    EXPECT_EQ(cached + count - SegletAllocator::MAGAZINE_SIZE / 2,
+              allocator.cachedSeglets);
+    EXPECT_EQ(allocator.getTotalCount(),
+              allocator.getFreeCount(SegletAllocator::DEFAULT));
+}
+
+TEST_F(SegletAllocatorTest, magazines_drainWhenShort) {
+    vector<Seglet*> seglets;
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, 1, seglets));
+    EXPECT_NE(0U, allocator.cachedSeglets);
+
+    // Everything else still free must be gathered from the magazines.
+    uint32_t remaining = downCast<uint32_t>(allocator.getTotalCount() - 1);
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, remaining,
+                                seglets));
+    EXPECT_EQ(0U, allocator.cachedSeglets);
+    EXPECT_EQ(0U, allocator.getFreeCount(SegletAllocator::DEFAULT));
+    EXPECT_FALSE(allocator.alloc(SegletAllocator::DEFAULT, 1, seglets));
+
+    foreach (Seglet* s, seglets)
+        s->free();
+}
+
+TEST_F(SegletAllocatorTest, magazines_cleanerReserveFirst) {
+    vector<Seglet*> seglets;
+    allocator.initializeCleanerReserve(1);
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::DEFAULT, 1, seglets));
+    EXPECT_TRUE(allocator.alloc(SegletAllocator::CLEANER, 1, seglets));
+    EXPECT_TRUE(allocator.cleanerPoolShort);
+
+    // Freed seglets refill the cleaner's reserve before any magazine.
+    size_t cached = allocator.cachedSeglets;
+    seglets[0]->free();
+    EXPECT_EQ(1U, allocator.cleanerPool.size());
+    EXPECT_EQ(cached, allocator.cachedSeglets);
+    EXPECT_FALSE(allocator.cleanerPoolShort);
+    seglets[1]->free();
+    EXPECT_EQ(cached + 1, allocator.cachedSeglets);
+}
+
+TEST_F(SegletAllocatorTest, magazines_disabledWithNumaNodes) {
+    serverConfig.master.numaNodes = 2;
+    SegletAllocator numaAllocator(&serverConfig);
+    EXPECT_FALSE(numaAllocator.magazinesEnabled);
+    EXPECT_TRUE(allocator.magazinesEnabled);
+}
+
+TEST_F(SegletAllocatorTest, flash) {
+    const char* path = "/tmp/ramcloud-seglet-allocator-test-delete-this";
+    serverConfig.master.flashTierFile = path;
+    serverConfig.master.flashTierBytes = 4 * serverConfig.segletSize + 1;
+    Tub<SegletAllocator> flashAllocator;
+    flashAllocator.construct(&serverConfig);
+    unlink(path);
+    EXPECT_EQ(4U, flashAllocator->getTotalCount(SegletAllocator::FLASH));
+    EXPECT_EQ(4U, flashAllocator->getFreeCount(SegletAllocator::FLASH));
+    EXPECT_EQ(allocator.getTotalCount(), flashAllocator->getTotalCount());
+
+    vector<Seglet*> seglets;
+    EXPECT_FALSE(flashAllocator->alloc(SegletAllocator::FLASH, 5, seglets));
+    EXPECT_TRUE(flashAllocator->alloc(SegletAllocator::FLASH, 3, seglets));
+    EXPECT_EQ(1U, flashAllocator->getFreeCount(SegletAllocator::FLASH));
+    foreach (Seglet* seglet, seglets)
+        EXPECT_TRUE(flashAllocator->flash->contains(seglet->get()));
+
+    // Segments on flash are found like any other.
+    LogSegment* segment = reinterpret_cast<LogSegment*>(0x1234);
+    flashAllocator->setOwnerSegment(seglets[0], segment);
+    EXPECT_EQ(segment, flashAllocator->getOwnerSegment(
+        static_cast<uint8_t*>(seglets[0]->get()) + 10));
+
+    // Freed flash seglets never end up in a pool of memory.
+    flashAllocator->cleanerPoolReserve = 10;
+    size_t defaultSeglets = flashAllocator->getDefaultFreeCount();
+    foreach (Seglet* seglet, seglets)
+        seglet->free();
+    EXPECT_EQ(4U, flashAllocator->getFreeCount(SegletAllocator::FLASH));
+    EXPECT_EQ(0U, flashAllocator->cleanerPool.size());
+    EXPECT_EQ(defaultSeglets, flashAllocator->getDefaultFreeCount());
+    EXPECT_TRUE(flashAllocator->getOwnerSegment(seglets[0]->get()) == NULL);
+}
+
+TEST_F(SegletAllocatorTest, numaNodes) {
+    TestLog::Enable _;
+    serverConfig.master.numaNodes = 2;
+    SegletAllocator numaAllocator(&serverConfig);
+    size_t half = numaAllocator.getTotalCount() / 2;
+    ASSERT_EQ(2U, numaAllocator.defaultPools.size());
+    EXPECT_EQ(half, numaAllocator.segletsPerNode);
+    EXPECT_EQ(half, numaAllocator.defaultPools[0].size());
+    EXPECT_EQ(half, numaAllocator.defaultPools[1].size());
+
+    // A request that no single node can satisfy is split across both.
+    vector<Seglet*> seglets;
+    uint32_t count = downCast<uint32_t>(half + 2);
+    EXPECT_TRUE(numaAllocator.alloc(SegletAllocator::DEFAULT, count, seglets));
+    EXPECT_EQ(count, seglets.size());
+    EXPECT_EQ(half - 2, numaAllocator.getFreeCount(SegletAllocator::DEFAULT));
+    EXPECT_EQ(count, numaAllocator.localAllocations +
+                     numaAllocator.remoteAllocations);
+    EXPECT_FALSE(numaAllocator.alloc(SegletAllocator::DEFAULT,
+                                     downCast<uint32_t>(half), seglets));
+
+    // Seglets go back to the pool of the node they belong to.
+    foreach (Seglet* s, seglets)
+        s->free();
+    EXPECT_EQ(half, numaAllocator.defaultPools[0].size());
+    EXPECT_EQ(half, numaAllocator.defaultPools[1].size());
+
+    ProtoBuf::LogMetrics_SegletMetrics m;
+    numaAllocator.getMetrics(m);
+    ASSERT_EQ(2, m.numa_node_free_seglets_size());
+    EXPECT_EQ(half, m.numa_node_free_seglets(1));
 }
 
 TEST_F(SegletAllocatorTest, getFreeCount) {
-    size_t defaultSeglets = allocator.defaultPool.size();
+    size_t defaultSeglets = allocator.defaultPools[0].size();
 
     EXPECT_EQ(0U, allocator.getFreeCount(SegletAllocator::EMERGENCY_HEAD));
     allocator.initializeEmergencyHeadReserve(2);
@@ -184,22 +349,23 @@ TEST_F(SegletAllocatorTest, getMemoryUtilization) {
 
 TEST_F(SegletAllocatorTest, allocFromPool) {
     vector<Seglet*> seglets;
-    uint32_t maxSeglets = downCast<uint32_t>(allocator.defaultPool.size());
+    uint32_t maxSeglets =
+        downCast<uint32_t>(allocator.defaultPools[0].size());
 
-    EXPECT_FALSE(allocator.allocFromPool(allocator.defaultPool,
+    EXPECT_FALSE(allocator.allocFromPool(allocator.defaultPools[0],
                                          maxSeglets + 1,
                                          seglets));
 
-    EXPECT_EQ(maxSeglets, allocator.defaultPool.size());
+    EXPECT_EQ(maxSeglets, allocator.defaultPools[0].size());
     EXPECT_EQ(0U, seglets.size());
-    EXPECT_TRUE(allocator.allocFromPool(allocator.defaultPool,
+    EXPECT_TRUE(allocator.allocFromPool(allocator.defaultPools[0],
                                         maxSeglets,
                                         seglets));
-    EXPECT_EQ(0U, allocator.defaultPool.size());
+    EXPECT_EQ(0U, allocator.defaultPools[0].size());
     EXPECT_EQ(maxSeglets, seglets.size());
 
     // return to allocator
-    allocator.allocFromPool(seglets, maxSeglets, allocator.defaultPool);
+    allocator.allocFromPool(seglets, maxSeglets, allocator.defaultPools[0]);
 }
 
 } // namespace RAMCloud
@@ -17,6 +17,7 @@
 #include "BitOps.h"
 #include "Crc32C.h"
 #include "CycleCounter.h"
+#include "Memory.h"
 #include "Segment.h"
 #include "LogSegment.h"
 #include "ShortMacros.h"
@@ -45,6 +46,12 @@ Segment::Segment()
       closed(false),
       mustFreeBlocks(true),
       head(0),
+      contentChecksumEnabled(false),
+      contentChecksumAppended(false),
+      nonTemporalCopyBytes(~0u),
+      contiguousEntryBytes(0),
+      paddingBytes(0),
+      straddlingEntries(0),
       checksum()
 {
     segletBlocks.push_back(new uint8_t[segletSize]);
@@ -62,6 +69,12 @@ Segment::Segment(const vector<Seglet*>& allocatedSeglets, uint32_t segletSize)
       closed(false),
       mustFreeBlocks(false),
       head(0),
+      contentChecksumEnabled(false),
+      contentChecksumAppended(false),
+      nonTemporalCopyBytes(~0u),
+      contiguousEntryBytes(0),
+      paddingBytes(0),
+      straddlingEntries(0),
       checksum()
 {
     assert(BitOps::isPowerOfTwo(segletSize));
@@ -98,6 +111,12 @@ Segment::Segment(const void* buffer, uint32_t length)
       closed(true),
       mustFreeBlocks(false),
       head(length),
+      contentChecksumEnabled(false),
+      contentChecksumAppended(false),
+      nonTemporalCopyBytes(~0u),
+      contiguousEntryBytes(0),
+      paddingBytes(0),
+      straddlingEntries(0),
       checksum()
 {
     // We promise not to scribble on it, honest!
@@ -139,18 +158,14 @@ Segment::hasSpaceFor(uint32_t* entryLengths, uint32_t numEntries)
 
     for (uint32_t i = 0; i < numEntries; i++) {
         EntryHeader header(LOG_ENTRY_TYPE_INVALID, entryLengths[i]);
-        totalBytesNeeded += sizeof32(EntryHeader) +
-                            header.getLengthBytes() +
-                            entryLengths[i];
+        uint32_t entryBytes = sizeof32(EntryHeader) +
+                              header.getLengthBytes() +
+                              entryLengths[i];
+        totalBytesNeeded += getPadding(head + totalBytesNeeded, entryBytes) +
+                            entryBytes;
     }
 
-    uint32_t bytesLeft = 0;
-    if (!closed) {
-        uint32_t capacity = getSegletsAllocated() * segletSize;
-        bytesLeft = capacity - head;
-    }
-
-    return totalBytesNeeded <= bytesLeft;
+    return totalBytesNeeded <= getBytesLeft();
 }
 
 /**
@@ -167,13 +182,7 @@ Segment::hasSpaceFor(uint32_t* entryLengths, uint32_t numEntries)
 bool
 Segment::hasSpaceFor(uint32_t length)
 {
-    uint32_t bytesLeft = 0;
-    if (!closed) {
-        uint32_t capacity = getSegletsAllocated() * segletSize;
-        bytesLeft = capacity - head;
-    }
-
-    return length <= bytesLeft;
+    return length <= getBytesLeft();
 }
 
 /**
@@ -205,6 +214,14 @@ Segment::append(LogEntryType type,
     if (!hasSpaceFor(&length, 1))
         return false;
 
+    uint32_t entryBytes = sizeof32(entryHeader) +
+                          entryHeader.getLengthBytes() + length;
+    uint32_t padding = getPadding(head, entryBytes);
+    if (padding > 0)
+        appendPadding(padding);
+    if (straddlesSeglets(head, entryBytes))
+        straddlingEntries++;
+
     uint32_t startOffset = head;
 
     copyIn(head, &entryHeader, sizeof(entryHeader));
@@ -218,7 +235,7 @@ Segment::append(LogEntryType type,
     checksum.update(&length, entryHeader.getLengthBytes());
     head += entryHeader.getLengthBytes();
 
-    copyIn(head, buffer, length);
+    copyIn(head, buffer, length, length >= nonTemporalCopyBytes);
     head += length;
 
     if (outReference != NULL)
@@ -290,6 +307,11 @@ Segment::append(const void* buffer,
     if (!hasSpaceFor(lengthWithMetadata))
         return false;
 
+    // No padding here: callers check for space for a whole batch of these
+    // entries at once (see hasSpaceFor(uint32_t)).
+    if (straddlesSeglets(head, lengthWithMetadata))
+        straddlingEntries++;
+
     uint32_t startOffset = head;
 
     copyIn(head, entryHeader, sizeof(*entryHeader));
@@ -305,7 +327,8 @@ Segment::append(const void* buffer,
 
     const uint8_t* contigPointer = reinterpret_cast<const uint8_t*>(buffer);
     const uint8_t* entryContents = contigPointer + head - startOffset;
-    copyIn(head, entryContents, lengthWithoutMetadata);
+    copyIn(head, entryContents, lengthWithoutMetadata,
+           lengthWithoutMetadata >= nonTemporalCopyBytes);
     head += lengthWithoutMetadata;
 
     if (entryDataLength)
@@ -355,14 +378,115 @@ Segment::appendLogHeader(LogEntryType type,
  *
  * Note that this is only soft state. Neither the contents of the segment, nor
  * the certificate indicate closure. Backups have their own notion of closed
- * segments, which is propagated by the ReplicatedSegment class.
+ * segments, which is propagated by the ReplicatedSegment class. However, if
+ * enableContentChecksum() was called, a LOG_ENTRY_TYPE_SEGCHECKSUM entry
+ * covering the contents of the segment is appended here.
  */
 void
 Segment::close()
 {
+    if (contentChecksumEnabled && !closed && head > 0 &&
+            getBytesLeft(false) >= CONTENT_CHECKSUM_ENTRY_BYTES) {
+        Crc32C::ResultType contents = checksumContents(head);
+        EntryHeader entryHeader(LOG_ENTRY_TYPE_SEGCHECKSUM, sizeof32(contents));
+        uint32_t length = sizeof32(contents);
+        copyIn(head, &entryHeader, sizeof(entryHeader));
+        checksum.update(&entryHeader, sizeof(entryHeader));
+        head += sizeof32(entryHeader);
+        copyIn(head, &length, entryHeader.getLengthBytes());
+        checksum.update(&length, entryHeader.getLengthBytes());
+        head += entryHeader.getLengthBytes();
+        copyIn(head, &contents, length);
+        head += length;
+        contentChecksumAppended = true;
+    }
     closed = true;
 }
 
+/**
+ * Have close() append a checksum of the entire contents of this segment,
+ * entries included. This protects entries that carry no checksum of their
+ * own (see Object::setDeferredChecksum()): checkMetadataIntegrity() verifies
+ * it on backups before replicas are used for recovery. Entries are still
+ * unprotected until the segment is closed.
+ *
+ * The checksum is an entry of its own, so the SegmentCertificate and the
+ * segments of masters that don't enable this are unchanged. Space for it
+ * is kept free from now on.
+ */
+void
+Segment::enableContentChecksum()
+{
+    contentChecksumEnabled = true;
+}
+
+/**
+ * Have append() copy the contents of large entries into this segment with
+ * non-temporal stores (see Memory::copyNonTemporal()), so that they don't
+ * push data that is still being used out of the processor caches. Entry
+ * headers and smaller entries are always copied normally.
+ *
+ * \param bytes
+ *      Entries whose contents are at least this many bytes long are
+ *      streamed. ~0u (the default) means none are.
+ */
+void
+Segment::setNonTemporalCopyBytes(uint32_t bytes)
+{
+    nonTemporalCopyBytes = bytes;
+}
+
+/**
+ * Have append() keep entries that fit within a seglet from spanning two of
+ * them. Reading such an entry yields a single contiguous chunk, so callers
+ * don't need to gather its pieces with Buffer::getRange(). When an entry
+ * would cross a seglet boundary, a LOG_ENTRY_TYPE_PADDING entry fills the
+ * rest of the current seglet first. The padding is never referenced, so
+ * the cleaner reclaims it along with other dead space.
+ *
+ * Entries appended preformatted (see append(const void*, ...)) are never
+ * padded, since their space is reserved for a whole batch at once.
+ *
+ * \param bytes
+ *      Entries no longer than this, including their headers, are kept
+ *      within one seglet. 0 (the default) disables padding.
+ */
+void
+Segment::setContiguousEntryBytes(uint32_t bytes)
+{
+    contiguousEntryBytes = bytes;
+}
+
+/**
+ * Return the number of bytes of LOG_ENTRY_TYPE_PADDING entries appended to
+ * this segment (see setContiguousEntryBytes()).
+ */
+uint32_t
+Segment::getPaddingBytes() const
+{
+    return paddingBytes;
+}
+
+/**
+ * Return the number of entries appended to this segment that span more
+ * than one seglet. Reads of these entries return discontiguous Buffers.
+ */
+uint32_t
+Segment::getStraddlingEntries() const
+{
+    return straddlingEntries;
+}
+
+/**
+ * Return true if close() has appended a checksum of the contents of this
+ * segment.
+ */
+bool
+Segment::hasContentChecksum() const
+{
+    return contentChecksumAppended;
+}
+
 uint64_t bufferAppendTicks;
 uint64_t bufferAppendSizes;
 uint64_t bufferAppendCount;
@@ -377,9 +501,14 @@ uint64_t bufferAppendCount;
  * \param length
  *      Number of bytes in the segment to append, starting from the offset.
  *      Offset+length must not exceed the current size of the segment.
+ * \param external
+ *      If true, the buffer always refers to the segment's memory rather
+ *      than copying small pieces of it. Only use this for bytes that will
+ *      not change for the lifetime of the buffer (for example, entries).
  */
 void
-Segment::appendToBuffer(Buffer& buffer, uint32_t offset, uint32_t length) const
+Segment::appendToBuffer(Buffer& buffer, uint32_t offset, uint32_t length,
+                        bool external) const
 {
     uint32_t currentOffset = offset;
     uint32_t currentLength = length;
@@ -395,7 +524,10 @@ Segment::appendToBuffer(Buffer& buffer, uint32_t offset, uint32_t length) const
                     segletSize * segletBlocks.size(), currentOffset);
         }
 
-        buffer.append(contigPointer, contigBytes);
+        if (external)
+            buffer.appendExternal(contigPointer, contigBytes);
+        else
+            buffer.append(contigPointer, contigBytes);
 
         currentOffset += contigBytes;
         currentLength -= contigBytes;
@@ -494,7 +626,7 @@ Segment::getEntry(uint32_t offset, Buffer* buffer, uint32_t* lengthWithMetadata)
         header.getLengthBytes());
 
     if (buffer != NULL)
-        appendToBuffer(*buffer, entryDataOffset, entryDataLength);
+        appendToBuffer(*buffer, entryDataOffset, entryDataLength, true);
 
     if (lengthWithMetadata != NULL) {
         *lengthWithMetadata = entryDataLength +
@@ -770,6 +902,11 @@ Segment::checkMetadataIntegrity(const SegmentCertificate& certificate)
         copyOut(offset + sizeof32(header), &length, header.getLengthBytes());
         currentChecksum.update(&length, header.getLengthBytes());
 
+        if (header.getType() == LOG_ENTRY_TYPE_SEGCHECKSUM &&
+                !checkContents(offset, header, length)) {
+            return false;
+        }
+
         offset += (sizeof32(header) + header.getLengthBytes() + length);
         size_t segmentSize = segletBlocks.size() * segletSize;
         if (offset > segmentSize) {
@@ -799,6 +936,65 @@ Segment::checkMetadataIntegrity(const SegmentCertificate& certificate)
     return true;
 }
 
+/**
+ * Compute the checksum of the first 'length' bytes of the segment; see
+ * enableContentChecksum().
+ *
+ * \param length
+ *      Number of bytes to checksum. The segment must hold at least this
+ *      many bytes.
+ */
+Crc32C::ResultType
+Segment::checksumContents(uint32_t length) const
+{
+    Crc32C crc;
+    uint32_t offset = 0;
+    while (offset < length) {
+        const void* contigPointer = NULL;
+        uint32_t contigBytes = std::min(length - offset,
+                peek(offset, &contigPointer));
+        if (contigBytes == 0)
+            break;
+        crc.update(contigPointer, contigBytes);
+        offset += contigBytes;
+    }
+    return crc.getResult();
+}
+
+/**
+ * Check a LOG_ENTRY_TYPE_SEGCHECKSUM entry against the contents of the
+ * segment that precede it; see enableContentChecksum(). Used by
+ * checkMetadataIntegrity().
+ *
+ * \param offset
+ *      Offset of the entry in the segment.
+ * \param header
+ *      Header of the entry.
+ * \param length
+ *      Length of the entry's contents.
+ * \return
+ *      True if the checksum in the entry matches, otherwise false.
+ */
+bool
+Segment::checkContents(uint32_t offset, EntryHeader header, uint32_t length)
+{
+    Crc32C::ResultType expected = 0;
+    if (length != sizeof32(expected)) {
+        LOG(WARNING, "segment corrupt: content checksum entry at offset %u "
+            "is %u bytes long", offset, length);
+        return false;
+    }
+    copyOut(offset + sizeof32(header) + header.getLengthBytes(),
+            &expected, length);
+    Crc32C::ResultType contents = checksumContents(offset);
+    if (expected != contents) {
+        LOG(WARNING, "segment corrupt: bad content checksum (expected "
+            "0x%08x, was 0x%08x)", expected, contents);
+        return false;
+    }
+    return true;
+}
+
 /**
  * Copy data out of the segment and into a contiguous output buffer.
  *
@@ -877,6 +1073,108 @@ Segment::getEntryHeader(uint32_t offset)
     return *header;
 }
 
+/**
+ * Append LOG_ENTRY_TYPE_PADDING entries that take up exactly the given
+ * number of bytes at the head of the segment. The caller must have ensured
+ * that there is enough space. The contents of the padding are left as they
+ * were.
+ *
+ * \param bytes
+ *      Number of bytes to fill; at least sizeof(EntryHeader) + 1.
+ */
+void
+Segment::appendPadding(uint32_t bytes)
+{
+    paddingBytes += bytes;
+    while (bytes > 0) {
+        // The number of length bytes depends on the length, so some sizes
+        // can't be filled by a single entry (258 bytes, for example). Then
+        // a minimal entry is appended first, and the rest fills the gap.
+        uint32_t length = 0;
+        for (uint32_t lengthBytes = 1; lengthBytes <= 4; lengthBytes++) {
+            uint32_t candidate = bytes - sizeof32(EntryHeader) - lengthBytes;
+            EntryHeader header(LOG_ENTRY_TYPE_PADDING, candidate);
+            if (header.getLengthBytes() == lengthBytes) {
+                length = candidate;
+                break;
+            }
+        }
+
+        EntryHeader entryHeader(LOG_ENTRY_TYPE_PADDING, length);
+        copyIn(head, &entryHeader, sizeof(entryHeader));
+        checksum.update(&entryHeader, sizeof(entryHeader));
+        head += sizeof32(entryHeader);
+        copyIn(head, &length, entryHeader.getLengthBytes());
+        checksum.update(&length, entryHeader.getLengthBytes());
+        head += entryHeader.getLengthBytes();
+        head += length;
+        bytes -= sizeof32(entryHeader) + entryHeader.getLengthBytes() + length;
+    }
+}
+
+/**
+ * Return the number of padding bytes append() will put before an entry so
+ * that it doesn't span two seglets; see setContiguousEntryBytes().
+ *
+ * \param offset
+ *      Offset in the segment at which the entry would otherwise start.
+ * \param entryBytes
+ *      Length of the entry, including its header.
+ */
+uint32_t
+Segment::getPadding(uint32_t offset, uint32_t entryBytes)
+{
+    if (entryBytes > contiguousEntryBytes || entryBytes > segletSize ||
+            !straddlesSeglets(offset, entryBytes)) {
+        return 0;
+    }
+
+    // Padding is an entry itself, so it can't be smaller than a header and
+    // one length byte.
+    uint32_t padding = segletSize - (offset & (segletSize - 1));
+    if (padding < sizeof32(EntryHeader) + 1)
+        return 0;
+    return padding;
+}
+
+/**
+ * Return the number of bytes that can still be appended to the segment.
+ *
+ * \param reserveContentChecksum
+ *      If true and enableContentChecksum() was called, the space close()
+ *      needs for the content checksum is not counted.
+ */
+uint32_t
+Segment::getBytesLeft(bool reserveContentChecksum)
+{
+    if (closed)
+        return 0;
+    uint32_t bytesLeft = getSegletsAllocated() * segletSize - head;
+    if (reserveContentChecksum && contentChecksumEnabled) {
+        if (bytesLeft < CONTENT_CHECKSUM_ENTRY_BYTES)
+            return 0;
+        bytesLeft -= CONTENT_CHECKSUM_ENTRY_BYTES;
+    }
+    return bytesLeft;
+}
+
+/**
+ * Return true if an entry appended at the given offset would span more
+ * than one seglet.
+ *
+ * \param offset
+ *      Offset in the segment at which the entry starts.
+ * \param entryBytes
+ *      Length of the entry, including its header.
+ */
+bool
+Segment::straddlesSeglets(uint32_t offset, uint32_t entryBytes)
+{
+    if (segletBlocks.size() < 2 || entryBytes == 0)
+        return false;
+    return (offset & (segletSize - 1)) + entryBytes > segletSize;
+}
+
 /**
  * Copy a contiguous buffer into the segment at the specified offset.
  *
@@ -886,12 +1184,16 @@ Segment::getEntryHeader(uint32_t offset)
  *      Pointer to a buffer that will be written to the segment.
  * \param length
  *      Number of bytes in the buffer to write into the segment.
+ * \param nonTemporal
+ *      If true, the bytes are written with Memory::copyNonTemporal() rather
+ *      than memcpy, bypassing the processor caches.
  * \return
  *     The actual number of bytes copied. May be less than requested if the end
  *     of the segment is reached.
  */
 uint32_t
-Segment::copyIn(uint32_t offset, const void* buffer, uint32_t length)
+Segment::copyIn(uint32_t offset, const void* buffer, uint32_t length,
+                bool nonTemporal)
 {
     uint32_t initialLength = length;
     const uint8_t* bufferBytes = static_cast<const uint8_t*>(buffer);
@@ -902,7 +1204,12 @@ Segment::copyIn(uint32_t offset, const void* buffer, uint32_t length)
         if (contigBytes == 0)
             break;
 
-        memcpy(const_cast<void*>(contigPointer), bufferBytes, contigBytes);
+        if (nonTemporal) {
+            Memory::copyNonTemporal(const_cast<void*>(contigPointer),
+                                    bufferBytes, contigBytes);
+        } else {
+            memcpy(const_cast<void*>(contigPointer), bufferBytes, contigBytes);
+        }
         bufferBytes += contigBytes;
         offset += contigBytes;
         length -= contigBytes;
@@ -996,7 +1303,10 @@ Segment::Reference::getEntry(SegletAllocator* allocator,
                     prefetch(
                         reinterpret_cast<void*>(reference + fullHeaderLength),
                             dataLength);
-                buffer->append(
+                // Refer to the entry in place, however small: callers that
+                // copy it onward (such as a read reply) then copy it at most
+                // once, and large ones not at all.
+                buffer->appendExternal(
                     reinterpret_cast<void*>(reference + fullHeaderLength),
                     dataLength);
             }
@@ -49,7 +49,9 @@ struct SegmentException : public Exception {
  * segment requires checking the metadata contents against a "certificate",
  * which includes the checksum and the length of the segment. Entry contents
  * are not checksummed. If integrity checks are needed, the owner of the data
- * should implement and store their own entry-specific checksums.
+ * should implement and store their own entry-specific checksums, or call
+ * enableContentChecksum() to have the whole segment checksummed when it is
+ * closed.
  *
  * The log ties many segments together to form a larger logical log. By using
  * many smaller segments it can achieve more efficient garbage collection and
@@ -287,9 +289,15 @@ class Segment {
                                 uint32_t objectSize,
                                 Buffer *logBuffer);
     void close();
+    void enableContentChecksum();
+    void setNonTemporalCopyBytes(uint32_t bytes);
+    void setContiguousEntryBytes(uint32_t bytes);
+    uint32_t getPaddingBytes() const;
+    uint32_t getStraddlingEntries() const;
     void appendToBuffer(Buffer& buffer,
                         uint32_t offset,
-                        uint32_t length) const;
+                        uint32_t length,
+                        bool external = false) const;
     uint32_t appendToBuffer(Buffer& buffer);
     uint32_t getOffset(Reference reference);
     LogEntryType getEntry(uint32_t offset,
@@ -310,6 +318,7 @@ class Segment {
     uint32_t getSegletsInUse();
     bool freeUnusedSeglets();
     bool checkMetadataIntegrity(const SegmentCertificate& certificate);
+    bool hasContentChecksum() const;
     uint32_t copyOut(uint32_t offset, void* buffer, uint32_t length) const;
     Reference getReference(uint32_t offset);
 
@@ -377,7 +386,14 @@ class Segment {
 
   PRIVATE:
     EntryHeader getEntryHeader(uint32_t offset);
-    uint32_t copyIn(uint32_t offset, const void* buffer, uint32_t length);
+    void appendPadding(uint32_t bytes);
+    uint32_t getPadding(uint32_t offset, uint32_t entryBytes);
+    bool straddlesSeglets(uint32_t offset, uint32_t entryBytes);
+    uint32_t copyIn(uint32_t offset, const void* buffer, uint32_t length,
+                    bool nonTemporal = false);
+    uint32_t getBytesLeft(bool reserveContentChecksum = true);
+    Crc32C::ResultType checksumContents(uint32_t length) const;
+    bool checkContents(uint32_t offset, EntryHeader header, uint32_t length);
     uint32_t copyInFromBuffer(uint32_t segmentOffset,
                               Buffer& buffer,
                               uint32_t bufferOffset,
@@ -427,6 +443,33 @@ class Segment {
     /// Offset to the next free byte in Segment.
     uint32_t head;
 
+    /// Bytes taken by the LOG_ENTRY_TYPE_SEGCHECKSUM entry: a one-byte
+    /// EntryHeader, one length byte, and the checksum itself.
+    static const uint32_t CONTENT_CHECKSUM_ENTRY_BYTES =
+        2 + static_cast<uint32_t>(sizeof(Crc32C::ResultType));
+
+    /// If true, close() appends a checksum of the contents of the segment;
+    /// see enableContentChecksum().
+    bool contentChecksumEnabled;
+
+    /// Set once close() has appended the content checksum.
+    bool contentChecksumAppended;
+
+    /// Entries whose contents are at least this many bytes are copied in
+    /// with non-temporal stores; see setNonTemporalCopyBytes().
+    uint32_t nonTemporalCopyBytes;
+
+    /// Entries no longer than this are kept within one seglet; see
+    /// setContiguousEntryBytes().
+    uint32_t contiguousEntryBytes;
+
+    /// Bytes of padding appended so far; see getPaddingBytes().
+    uint32_t paddingBytes;
+
+    /// Entries appended so far that span seglets; see
+    /// getStraddlingEntries().
+    uint32_t straddlingEntries;
+
     /// Latest Segment checksum (crc32c). This is a checksum of all metadata
     /// in the Segment (that is, every Segment::Entry and ::Header).
     /// Any user data that is stored in the Segment is unprotected. Integrity
@@ -291,4 +291,59 @@ SegmentIterator::checkMetadataIntegrity()
         throw SegmentIteratorException(HERE, "cannot iterate: corrupt segment");
 }
 
+/**
+ * Issue software prefetches for the entry the iterator currently refers to:
+ * its header and the beginning of its contents. Nothing is read, so this
+ * never stalls; see SegmentReadAhead.
+ *
+ * \param maxBytes
+ *      Number of bytes of the entry's contents to prefetch. Prefetching
+ *      past the end of a short entry simply warms the entries after it.
+ */
+void
+SegmentIterator::prefetch(uint32_t maxBytes)
+{
+    if (isDone())
+        return;
+    const void* pointer = NULL;
+    uint32_t contigBytes = segment->peek(currentOffset, &pointer);
+    uint32_t bytes = sizeof32(currentHeader) +
+                     currentHeader.getLengthBytes() + maxBytes;
+    RAMCloud::prefetch(pointer, std::min(contigBytes, bytes));
+}
+
+/**
+ * Construct a SegmentReadAhead and prefetch the first entries it covers.
+ *
+ * \param it
+ *      Iterator to run ahead of; it should be advanced with next() and
+ *      each advance matched by a call to advance().
+ * \param depth
+ *      How many entries in front of \a it to prefetch. Deeper read-ahead
+ *      hides more latency but costs a few more cache lines in flight.
+ * \param bytes
+ *      Number of bytes of each entry's contents to prefetch.
+ */
+SegmentReadAhead::SegmentReadAhead(const SegmentIterator& it, uint32_t depth,
+                                   uint32_t bytes)
+    : ahead(it)
+    , bytes(bytes)
+{
+    for (uint32_t i = 0; i < depth; i++) {
+        ahead.prefetch(bytes);
+        ahead.next();
+    }
+}
+
+/**
+ * Prefetch the next entry and move on; called once for each entry the
+ * followed iterator steps over.
+ */
+void
+SegmentReadAhead::advance()
+{
+    ahead.prefetch(bytes);
+    ahead.next();
+}
+
 } // namespace
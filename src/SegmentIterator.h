@@ -62,6 +62,7 @@ class SegmentIterator {
     uint32_t appendToBuffer(Buffer& buffer);
     uint32_t setBufferTo(Buffer& buffer);
     void checkMetadataIntegrity();
+    void prefetch(uint32_t maxBytes);
 
     /**
      * Test if the SegmentIterator has exhausted all entries. More concretely, if
@@ -177,6 +178,41 @@ class SegmentIterator {
     Tub<uint32_t> currentLength;
 };
 
+/**
+ * A SegmentReadAhead follows a SegmentIterator a fixed number of entries
+ * ahead, prefetching the entries it passes over. Loops that walk a whole
+ * segment and touch every entry (recovery replay, migration scans) stall on
+ * a cache miss for each entry's header and again for its contents; with a
+ * SegmentReadAhead those misses overlap with the work on earlier entries.
+ *
+ * Call advance() each time the iterator being followed is advanced. The
+ * followed iterator is never modified, and prefetching has no effect on
+ * correctness, so it's safe to stop calling advance() at any point.
+ */
+class SegmentReadAhead {
+  public:
+    /// Default number of entries that the read-ahead runs in front.
+    static const uint32_t DEFAULT_DEPTH = 8;
+
+    /// Default number of bytes prefetched from each entry's contents: enough
+    /// for the object header and a typical key.
+    static const uint32_t DEFAULT_BYTES = 128;
+
+    explicit SegmentReadAhead(const SegmentIterator& it,
+                              uint32_t depth = DEFAULT_DEPTH,
+                              uint32_t bytes = DEFAULT_BYTES);
+    void advance();
+
+  PRIVATE:
+    /// Positioned #depth entries after the iterator being followed.
+    SegmentIterator ahead;
+
+    /// Bytes of each entry's contents to prefetch.
+    uint32_t bytes;
+
+    DISALLOW_COPY_AND_ASSIGN(SegmentReadAhead);
+};
+
 } // namespace
 
 #endif // !RAMCLOUD_SEGMENTITERATOR_H
@@ -214,4 +214,34 @@ TEST_F(SegmentIteratorTest, setBufferTo) {
     EXPECT_EQ(0, memcmp("this is the content", buffer.getRange(0, 20), 20));
 }
 
+TEST_F(SegmentIteratorTest, prefetch) {
+    SegmentIterator it(s);
+    it.prefetch(100);
+    EXPECT_TRUE(it.isDone());
+
+    s.append(LOG_ENTRY_TYPE_OBJ, "hi", 3);
+    SegmentIterator it2(s);
+    it2.prefetch(100000);
+    EXPECT_EQ(0U, it2.getOffset());
+    EXPECT_EQ(3U, it2.getLength());
+}
+
+TEST_F(SegmentIteratorTest, SegmentReadAhead) {
+    for (int i = 0; i < 5; i++)
+        s.append(LOG_ENTRY_TYPE_OBJ, "hi", 3);
+    SegmentIterator it(s);
+    SegmentIterator third(s);
+    third.next();
+    third.next();
+
+    SegmentReadAhead readAhead(it, 2);
+    EXPECT_EQ(0U, it.getOffset());
+    EXPECT_EQ(third.getOffset(), readAhead.ahead.getOffset());
+
+    // Running off the end of the segment is harmless.
+    for (int i = 0; i < 5; i++)
+        readAhead.advance();
+    EXPECT_TRUE(readAhead.ahead.isDone());
+}
+
 } // namespace RAMCloud
@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "Common.h"
 #include "Object.h"
 #include "LogDigest.h"
@@ -24,6 +26,7 @@
 #include "ServerConfig.h"
 #include "ServerRpcPool.h"
 #include "TableStats.h"
+#include "ThreadId.h"
 #include "MasterTableMetadata.h"
 #include "WorkerTimer.h"
 
@@ -63,8 +66,12 @@ SegmentManager::SegmentManager(Context* context,
       replicaManager(replicaManager),
       masterTableMetadata(masterTableMetadata),
       segletsPerSegment(segmentSize / allocator.getSegletSize()),
+      contentChecksums(config->master.deferObjectChecksums),
+      nonTemporalAppendBytes(NON_TEMPORAL_APPEND_BYTES),
+      nonTemporalSurvivorBytes(NON_TEMPORAL_SURVIVOR_BYTES),
       maxSegments(static_cast<uint32_t>(static_cast<double>(
-        allocator.getTotalCount() / segletsPerSegment)
+        (allocator.getTotalCount() +
+         allocator.getTotalCount(SegletAllocator::FLASH)) / segletsPerSegment)
           * config->master.diskExpansionFactor)),
       segments(NULL),
       states(NULL),
@@ -80,7 +87,13 @@ SegmentManager::SegmentManager(Context* context,
       lock("SegmentManager::lock"),
       segmentsOnDisk(0),
       segmentsOnDiskHistogram(maxSegments, 1),
+      totalEmergencyHeads(0),
+      totalHeadSegments(0),
+      cleanedHeadSegmentIdLimit(0),
+      relocationGeneration(0),
       safeVersion(1),
+      minimumVersion(1),
+      versionBlocks(),
       oldestRpcEpoch(0),
       stuckStartTime(0),
       nextMessageSeconds(0.0)
@@ -139,6 +152,7 @@ SegmentManager::getMetrics(ProtoBuf::LogMetrics_SegmentMetrics& m)
                 *m.mutable_segments_on_disk_histogram());
 
     m.set_current_segments_on_disk(segmentsOnDisk);
+    m.set_total_emergency_heads(totalEmergencyHeads);
 
     // Compile stats on the entries that exist in our segments (whether dead
     // or alive).
@@ -215,12 +229,15 @@ SegmentManager::allocHeadSegment(uint32_t flags)
             newHead = alloc(ALLOC_EMERGENCY_HEAD,
                             nextSegmentId,
                             WallTime::secondsTimestamp());
+            if (newHead != NULL)
+                totalEmergencyHeads++;
         } else {
             return NULL;
         }
     }
 
     nextSegmentId++;
+    totalHeadSegments++;
 
     writeHeader(newHead);
     if (prevHead != NULL && !prevHead->isEmergencyHead)
@@ -284,7 +301,9 @@ SegmentManager::allocHeadSegment(uint32_t flags)
  *      If the FOR_CLEANING flag is provided, the allocation will be attempted
  *      from a pool specially reserved for the cleaner. If MUST_NOT_FAIL is
  *      provided, the method will block until a segment is free. Otherwise, it
- *      will return immediately with NULL if no segment is available.
+ *      will return immediately with NULL if no segment is available. With
+ *      ON_FLASH as well, the survivor is placed on flash, and NULL is
+ *      returned if flash is full (whatever the other flags).
  *
  * \param replacing
  *      If memory compaction is being performed, this must point to the current
@@ -314,7 +333,9 @@ SegmentManager::allocSideSegment(uint32_t flags, LogSegment* replacing)
             creationTimestamp = replacing->creationTimestamp;
         }
 
-        if (flags & FOR_CLEANING)
+        if ((flags & FOR_CLEANING) && (flags & ON_FLASH))
+            s = alloc(ALLOC_FLASH_SIDELOG, id, creationTimestamp);
+        else if (flags & FOR_CLEANING)
             s = alloc(ALLOC_CLEANER_SIDELOG, id, creationTimestamp);
         else
             s = alloc(ALLOC_REGULAR_SIDELOG, id, creationTimestamp);
@@ -322,7 +343,7 @@ SegmentManager::allocSideSegment(uint32_t flags, LogSegment* replacing)
         if (s != NULL)
             break;
 
-        if ((flags & MUST_NOT_FAIL) == 0)
+        if ((flags & MUST_NOT_FAIL) == 0 || (flags & ON_FLASH))
             return NULL;
 
         guard.destroy();
@@ -390,10 +411,17 @@ SegmentManager::cleaningComplete(LogSegmentVector& clean,
 
     // Mark the new segments for insertion into the log when the next digest is
     // written and mark the cleaned segments for removal at the same point.
-    foreach (LogSegment* s, survivors)
+    foreach (LogSegment* s, survivors) {
+        s->isSurvivor = true;
         injectSideSegment(s, CLEANABLE_PENDING_DIGEST, guard);
-    foreach (LogSegment* s, clean)
+    }
+    foreach (LogSegment* s, clean) {
+        if (s->appendedAsHead) {
+            cleanedHeadSegmentIdLimit =
+                    std::max(cleanedHeadSegmentIdLimit, s->id + 1);
+        }
         freeSegment(s, true, guard);
+    }
 
     LOG(DEBUG, "Cleaning used %u seglets to free %u seglets",
         segletsUsed, segletsFreed);
@@ -425,6 +453,15 @@ SegmentManager::compactionComplete(LogSegment* oldSegment,
     oldSegment->replicatedSegment = NULL;
     newSegment->replicatedSegment->swapSegment(newSegment);
 
+    // Compaction drops dead entries (tombstones among them) and moves the
+    // rest, so readers of the original head contents must be told.
+    newSegment->appendedAsHead = oldSegment->appendedAsHead;
+    if (oldSegment->appendedAsHead) {
+        cleanedHeadSegmentIdLimit =
+                std::max(cleanedHeadSegmentIdLimit, oldSegment->id + 1);
+    }
+
+    newSegment->relocationGeneration = ++relocationGeneration;
     injectSideSegment(newSegment, NEWLY_CLEANABLE, guard);
     freeSegment(oldSegment, false, guard);
 
@@ -432,6 +469,41 @@ SegmentManager::compactionComplete(LogSegment* oldSegment,
         newSegment->getSegletsAllocated(), oldSegment->getSegletsAllocated());
 }
 
+/**
+ * Returns one more than the highest identifier of any segment allocated as
+ * the log head that has since been cleaned or compacted, or 0 if there is
+ * none. Some of the entries appended to head segments with lower identifiers
+ * may no longer be in the log; see ObjectManager::readLogChanges.
+ */
+uint64_t
+SegmentManager::getCleanedHeadSegmentIdLimit()
+{
+    SpinLock::Guard guard(lock);
+    return cleanedHeadSegmentIdLimit;
+}
+
+/**
+ * Returns the number of segments allocated as the log head so far.
+ */
+uint64_t
+SegmentManager::getHeadSegmentsAllocated()
+{
+    SpinLock::Guard guard(lock);
+    return totalHeadSegments;
+}
+
+/**
+ * Returns the largest LogSegment::relocationGeneration of any segment that
+ * has become part of the log so far (see #relocationGeneration). Segments
+ * the cleaner adds to the log after this call get larger values.
+ */
+uint64_t
+SegmentManager::getRelocationGeneration()
+{
+    SpinLock::Guard guard(lock);
+    return relocationGeneration;
+}
+
 /**
  * Mark the given segments for inclusion into the log. They will not be made
  * part of the on-disk log until the next head segment is allocated and a
@@ -661,43 +733,125 @@ SegmentManager::getMemoryUtilization()
         FREEABLE_PENDING_REFERENCES
     };
     foreach (State state, freeableStates) {
-        foreach (LogSegment& s, segmentsByState[state])
-            freeSeglets += s.getSegletsAllocated();
+        foreach (LogSegment& s, segmentsByState[state]) {
+            if (!s.onFlash)
+                freeSeglets += s.getSegletsAllocated();
+        }
     }
 
     return downCast<int>(100 * (totalSeglets - freeSeglets) / totalSeglets);
 }
 
 /**
- * Return safeVersion for newly allocated object and increment safeVersion for
- * next assignment. \see #safeVersion
+ * Change which entries are streamed into segments allocated from now on
+ * with non-temporal stores (see Segment::setNonTemporalCopyBytes()). The
+ * defaults are NON_TEMPORAL_APPEND_BYTES and NON_TEMPORAL_SURVIVOR_BYTES;
+ * benchmarks pass ~0u to compare against ordinary copies.
+ *
+ * \param appendBytes
+ *      Threshold for log heads and all side segments except survivors.
+ * \param survivorBytes
+ *      Threshold for survivor segments written by the cleaner.
+ */
+void
+SegmentManager::setNonTemporalCopyBytes(uint32_t appendBytes,
+                                        uint32_t survivorBytes)
+{
+    SpinLock::Guard _(lock);
+    nonTemporalAppendBytes = appendBytes;
+    nonTemporalSurvivorBytes = survivorBytes;
+}
+
+/**
+ * Return a version number for a newly created object. \see #safeVersion
  * semantics of version number and the purpose of the safeVersion.
  *
- * In a case, a object is repeatedly removed, recreated, removed, recreated.
- * safeVersion needs to be incremented in allocateVersion().
+ * Every call returns a distinct number, at least as large as any value
+ * passed to raiseSafeVersion() before the call. Numbers come from a block
+ * cached for the calling thread (see #versionBlocks), so concurrent writers
+ * only touch the shared #safeVersion once per VERSION_BLOCK_SIZE objects.
+ * Numbers handed out by different threads are not ordered by time, and a
+ * block that is abandoned leaves a gap; neither matters for the guarantees
+ * above.
  *
  * \return
- *      The next version available from the master vector clock.
+ *      The next version available to this thread.
  */
 uint64_t
 SegmentManager::allocateVersion() {
-    return safeVersion++;
+    VersionBlock& block = versionBlocks[ThreadId::get() % NUM_VERSION_BLOCKS];
+    uint_fast64_t version = block.next;
+    while (true) {
+        if ((version % VERSION_BLOCK_SIZE) != 0 && version >= minimumVersion) {
+            if (block.next.compare_exchange_weak(version, version + 1))
+                return version;
+            continue;
+        }
+
+        // The block is used up (or was never taken, or removals have raised
+        // the minimum past it): take a new one. If another thread sharing
+        // this slot got there first, ours is simply wasted.
+        uint64_t start = reserveVersions();
+        if (block.next.compare_exchange_strong(version, start))
+            version = start;
+    }
+}
+
+/**
+ * Take a block of version numbers from #safeVersion for allocateVersion().
+ * Since #safeVersion moves past the whole block at once, the value written
+ * to each new log head covers every version that could be handed out until
+ * the next head, and recovery keeps version numbers monotonic.
+ *
+ * \return
+ *      The first version number in the block; the block runs up to the
+ *      next multiple of VERSION_BLOCK_SIZE.
+ */
+uint64_t
+SegmentManager::reserveVersions()
+{
+    uint_fast64_t current = safeVersion;
+    while (true) {
+        // A block may not start on a multiple of the block size, since that
+        // is how allocateVersion() recognizes a used-up block.
+        uint64_t start = current;
+        if ((start % VERSION_BLOCK_SIZE) == 0)
+            start++;
+        uint64_t end = (start / VERSION_BLOCK_SIZE + 1) * VERSION_BLOCK_SIZE;
+        if (safeVersion.compare_exchange_weak(current, end))
+            return start;
+    }
 }
 
 /**
- * Ensure the safeVersion is larger than given number.
- * Return true if safeVersion is revised.
+ * Ensure the safeVersion is larger than given number, and that
+ * allocateVersion() no longer returns anything smaller; this is how an
+ * object that is removed and recreated keeps a growing version number.
+ * Return true if safeVersion is revised. Safe to call from several threads
+ * at once (e.g. parallel recovery replay); safeVersion never moves backward.
  * \param minimum
  *      The version number to be compared against safeVersion.
  * \see #safeVersion
  */
 bool
 SegmentManager::raiseSafeVersion(uint64_t minimum) {
-    if (minimum > safeVersion) {
-        safeVersion = minimum;
-        return true;
+    // Raise safeVersion first, so that a block reserved once the minimum
+    // is visible always starts at or above it.
+    bool raised = false;
+    uint_fast64_t current = safeVersion;
+    while (minimum > current) {
+        if (safeVersion.compare_exchange_weak(current, minimum)) {
+            raised = true;
+            break;
+        }
     }
-    return false;
+
+    current = minimumVersion;
+    while (minimum > current) {
+        if (minimumVersion.compare_exchange_weak(current, minimum))
+            break;
+    }
+    return raised;
 }
 
 /******************************************************************************
@@ -823,6 +977,8 @@ SegmentManager::writeDigest(LogSegment* newHead, LogSegment* prevHead)
 
     while (!segmentsByState[CLEANABLE_PENDING_DIGEST].empty()) {
         LogSegment& s = segmentsByState[CLEANABLE_PENDING_DIGEST].front();
+        if (s.isSurvivor)
+            s.relocationGeneration = ++relocationGeneration;
         changeState(s, NEWLY_CLEANABLE);
     }
 
@@ -844,8 +1000,10 @@ SegmentManager::writeDigest(LogSegment* newHead, LogSegment* prevHead)
         changeState(s, FREEABLE_PENDING_REFERENCES);
     }
 
+    // Every head gets a digest of the entire log; the compact format keeps
+    // that from eating into large logs' heads and replication bandwidth.
     Buffer buffer;
-    digest.appendToBuffer(buffer);
+    digest.appendCompactToBuffer(buffer);
     bool success = newHead->append(LOG_ENTRY_TYPE_LOGDIGEST, buffer);
     if (!success) {
         throw FatalError(HERE, format("Could not append log digest of %u bytes "
@@ -969,6 +1127,8 @@ SegmentManager::alloc(AllocPurpose purpose,
     SegletAllocator::AllocationType type = SegletAllocator::DEFAULT;
     if (purpose == ALLOC_CLEANER_SIDELOG)
         type = SegletAllocator::CLEANER;
+    else if (purpose == ALLOC_FLASH_SIDELOG)
+        type = SegletAllocator::FLASH;
     else if (purpose == ALLOC_EMERGENCY_HEAD)
         type = SegletAllocator::EMERGENCY_HEAD;
 
@@ -979,7 +1139,8 @@ SegmentManager::alloc(AllocPurpose purpose,
     }
 
     State state = HEAD;
-    if (purpose == ALLOC_REGULAR_SIDELOG || purpose == ALLOC_CLEANER_SIDELOG)
+    if (purpose == ALLOC_REGULAR_SIDELOG || purpose == ALLOC_CLEANER_SIDELOG ||
+            purpose == ALLOC_FLASH_SIDELOG)
         state = SIDELOG;
 
     segments[slot].construct(seglets,
@@ -997,6 +1158,15 @@ SegmentManager::alloc(AllocPurpose purpose,
     idToSlotMap[segmentId] = slot;
 
     LogSegment& s = *segments[slot];
+    s.onFlash = (purpose == ALLOC_FLASH_SIDELOG);
+    s.appendedAsHead = (state == HEAD);
+    if (contentChecksums)
+        s.enableContentChecksum();
+    if (purpose == ALLOC_CLEANER_SIDELOG || purpose == ALLOC_FLASH_SIDELOG)
+        s.setNonTemporalCopyBytes(nonTemporalSurvivorBytes);
+    else
+        s.setNonTemporalCopyBytes(nonTemporalAppendBytes);
+    s.setContiguousEntryBytes(CONTIGUOUS_ENTRY_BYTES);
     addToLists(s);
 
     return &s;
@@ -1019,6 +1189,7 @@ SegmentManager::allocSlot(AllocPurpose purpose)
     switch (purpose) {
     case ALLOC_HEAD:
     case ALLOC_REGULAR_SIDELOG:
+    case ALLOC_FLASH_SIDELOG:
         source = &freeSlots;
         break;
     case ALLOC_EMERGENCY_HEAD:
@@ -1148,12 +1319,8 @@ SegmentManager::freeUnreferencedSegments()
     if (freeablePending.empty())
         return;
 
-    uint64_t earliestEpoch;
-    {
-        Dispatch::Lock lock(context->dispatch);
-        earliestEpoch = LogProtector::getEarliestOutstandingEpoch(
-                            Transport::ServerRpc::READ_ACTIVITY);
-    }
+    uint64_t earliestEpoch = LogProtector::getEarliestOutstandingEpoch(
+            Transport::ServerRpc::READ_ACTIVITY);
     SegmentList::iterator it = freeablePending.begin();
 
     int skippedCount = 0;
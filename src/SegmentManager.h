@@ -105,9 +105,35 @@ class SegmentManager {
         /// The segment being allocated will be used for cleaning. This simply
         /// tells SegmentManager which pool of memory to allocate from. This
         /// flag only makes sense in the allocSideSegment method.
-        FOR_CLEANING = 2
+        FOR_CLEANING = 2,
+
+        /// Along with FOR_CLEANING, allocate a survivor for cold data with
+        /// seglets on local flash instead of memory (see
+        /// SegletAllocator::FLASH). When flash is full the allocation fails;
+        /// callers then fall back to a survivor in memory.
+        ON_FLASH = 4
+    };
+
+    /// Default thresholds for streaming entry contents into segments with
+    /// non-temporal stores (see Segment::setNonTemporalCopyBytes()). Large
+    /// values written by clients are rarely read back right away, and
+    /// survivors written by the cleaner hold data that was cold enough to
+    /// be cleaned; either would otherwise evict the hash table and hot
+    /// objects from the caches. Below a few cache lines streaming gains
+    /// nothing, since the partial lines at each end are copied normally.
+    enum : uint32_t {
+        NON_TEMPORAL_APPEND_BYTES = 4096,
+        NON_TEMPORAL_SURVIVOR_BYTES = 256
     };
 
+    /// Entries up to this size (including their headers) are kept within
+    /// a single seglet (see Segment::setContiguousEntryBytes()), so that
+    /// reading them never requires gathering pieces from several seglets.
+    /// Larger entries would waste too much space in padding. On average
+    /// entries of this size waste about size^2 / (2 * segletSize) bytes
+    /// per seglet, under 1% with the default 64 KB seglets.
+    enum : uint32_t { CONTIGUOUS_ENTRY_BYTES = 8192 };
+
     SegmentManager(Context* context,
                    const ServerConfig* config,
                    ServerId* logId,
@@ -127,6 +153,9 @@ class SegmentManager {
     void freeUnusedSideSegments(LogSegmentVector& segments);
     void cleanableSegments(LogSegmentVector& out);
     void getActiveSegments(uint64_t nextSegmentId, LogSegmentVector& list);
+    uint64_t getCleanedHeadSegmentIdLimit();
+    uint64_t getHeadSegmentsAllocated();
+    uint64_t getRelocationGeneration();
     bool initializeSurvivorReserve(uint32_t numSegments);
     LogSegment& operator[](SegmentSlot slot);
     bool doesIdExist(uint64_t id);
@@ -134,6 +163,7 @@ class SegmentManager {
     uint64_t allocateVersion();
     bool raiseSafeVersion(uint64_t minimum);
     int getMemoryUtilization();
+    void setNonTemporalCopyBytes(uint32_t appendBytes, uint32_t survivorBytes);
 
 #ifdef TESTING
     /// Used to mock the return value of getSegmentUtilization() when set to
@@ -224,11 +254,11 @@ class SegmentManager {
     INTRUSIVE_LIST_TYPEDEF(LogSegment, listEntries) SegmentList;
     INTRUSIVE_LIST_TYPEDEF(LogSegment, allListEntries) AllSegmentList;
 
-    /// The private alloc() routine allocates segments for four different
+    /// The private alloc() routine allocates segments for five different
     /// purposes: heads, emergency heads, regular SideLog segments, and
-    /// cleaner SideLog segments. These enums specify which. They affect the
-    /// pools from which segments (and seglets) are allocated, as well as the
-    /// initial states of the segments returned.
+    /// cleaner SideLog segments in memory or on flash. These enums specify
+    /// which. They affect the pools from which segments (and seglets) are
+    /// allocated, as well as the initial states of the segments returned.
     enum AllocPurpose {
         /// Allocate a head segment that entries may be appended to. The log
         /// will be rolled over to this new segment in memory and on backups.
@@ -251,7 +281,12 @@ class SegmentManager {
         /// in log cleaning. These segments are allocated from the cleaner pool.
         /// This separate pool ensures that the system does not deadlock itself
         /// by allocating all segments and having nothing left to clean with.
-        ALLOC_CLEANER_SIDELOG
+        ALLOC_CLEANER_SIDELOG,
+
+        /// Allocate a segment for cold survivors of log cleaning from the
+        /// flash pool (see SegletAllocator::FLASH). Its slot comes from the
+        /// regular slots, which include one for each segment of flash.
+        ALLOC_FLASH_SIDELOG
     };
 
     LogSegment* alloc(AllocPurpose purpose,
@@ -264,6 +299,7 @@ class SegmentManager {
     void writeHeader(LogSegment* segment);
     void writeDigest(LogSegment* newHead, LogSegment* prevHead);
     void writeSafeVersion(LogSegment* head);
+    uint64_t reserveVersions();
     void writeTableStatsDigest(LogSegment* head);
     LogSegment* getHeadSegment();
     void changeState(LogSegment& s, State newState);
@@ -299,6 +335,18 @@ class SegmentManager {
     /// The number of seglets in a full segment.
     const uint32_t segletsPerSegment;
 
+    /// If true, the contents of every segment are checksummed when it is
+    /// closed (see ServerConfig::Master::deferObjectChecksums).
+    const bool contentChecksums;
+
+    /// Non-temporal copy threshold for segments other than cleaner survivors
+    /// (see setNonTemporalCopyBytes()).
+    uint32_t nonTemporalAppendBytes;
+
+    /// Non-temporal copy threshold for cleaner survivor segments (see
+    /// setNonTemporalCopyBytes()).
+    uint32_t nonTemporalSurvivorBytes;
+
     /// Maximum number of segments we will allocate. This dictates the maximum
     /// amount of disk space that may be used on backups, which may differ from
     /// the amount of RAM in the master server if disk expansion factors larger
@@ -367,6 +415,26 @@ class SegmentManager {
     /// time a segment is allocated or freed.
     Histogram segmentsOnDiskHistogram;
 
+    /// Number of emergency head segments allocated so far. Each one means
+    /// the log ran out of memory and could only roll over to a new digest.
+    uint64_t totalEmergencyHeads;
+
+    /// Number of segments allocated as the log head so far (including
+    /// emergency heads). Multiplied by the segment size, this tracks how
+    /// fast the log is being written.
+    uint64_t totalHeadSegments;
+
+    /// One more than the highest identifier of any segment allocated as the
+    /// log head (see LogSegment::appendedAsHead) that has been cleaned or
+    /// compacted; 0 if none has been. Only ever grows.
+    uint64_t cleanedHeadSegmentIdLimit;
+
+    /// Incremented each time a segment containing entries relocated by the
+    /// cleaner becomes part of the log: survivors of disk cleaning when the
+    /// next digest is written, compacted segments right away. The segment
+    /// records the new value in LogSegment::relocationGeneration.
+    uint64_t relocationGeneration;
+
     /**
      * Safe version number for a new object in the log.
      * Single safeVersion is maintained in each master through recovery.
@@ -385,13 +453,13 @@ class SegmentManager {
      *
      * These guarantees are implemented as follows:
      *
-     * \li #safeVersion, the safe version number, contains the next available
-     * version number for any new object on the master. It is initialized to
+     * \li #safeVersion, the safe version number, is larger than any version
+     * number handed out for a new object on the master. It is initialized to
      * a small integer when the log is created and is recoverable after crashes.
      *
-     * \li When an object is created, its new version number is set to
-     * the safeVersion, and the safeVersion
-     * is incremented. See #AllocateVersion.
+     * \li When an object is created, its new version number is taken from
+     * a block of version numbers cached for the current thread, and that
+     * block was taken from below the safeVersion. See #allocateVersion.
      *
      * \li When an object is updated, its version number is incremented.
      * Note that its incremented version number does not affect the safeVersion.
@@ -405,11 +473,41 @@ class SegmentManager {
      *
      * \li When an object is removed, set the safeVersion
      * to the higher than any version number of the removed
-     * object's version number. See #RaiseSafeVersion.
+     * object's version number. See #raiseSafeVersion. Cached blocks of
+     * version numbers below that are no longer used (see #minimumVersion).
      *
      **/
     std::atomic_uint_fast64_t safeVersion;
 
+    /// No new object may be given a version number smaller than this; it is
+    /// the largest value passed to raiseSafeVersion(). Cached blocks that
+    /// fall below it are abandoned by allocateVersion().
+    std::atomic_uint_fast64_t minimumVersion;
+
+    /// Number of version numbers that allocateVersion() takes from
+    /// #safeVersion at a time. Blocks end on multiples of this, so a block
+    /// is used up once its next version number is such a multiple.
+    static const uint64_t VERSION_BLOCK_SIZE = 1024;
+
+    /**
+     * The next version number to hand out from a block of version numbers
+     * taken from #safeVersion, padded to a cache line of its own. Threads
+     * are spread over the #versionBlocks array by thread id, so new objects
+     * on different cores don't contend for a single counter. 0 means no
+     * block has been taken yet.
+     */
+    struct VersionBlock {
+        VersionBlock() : next(0) {}
+        std::atomic_uint_fast64_t next;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic_uint_fast64_t)];
+    };
+
+    /// Number of entries in #versionBlocks.
+    static const uint32_t NUM_VERSION_BLOCKS = 64;
+
+    /// Blocks of version numbers, one for each group of threads.
+    VersionBlock versionBlocks[NUM_VERSION_BLOCKS];
+
 
     /// The following variables allow us to log messages if the epoch
     /// mechanism gets "stuck", where some old RPC is never completing and
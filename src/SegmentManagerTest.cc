@@ -16,6 +16,7 @@
 #include "TestUtil.h"
 
 #include "SegmentManager.h"
+#include "ThreadId.h"
 #include "SegmentIterator.h"
 #include "LogDigest.h"
 #include "LogMetadata.h"
@@ -256,6 +257,19 @@ TEST_F(SegmentManagerTest, cleaningComplete) {
         SegmentManager::FREEABLE_PENDING_DIGEST_AND_REFERENCES].back());
     EXPECT_EQ(17531U, LogProtector::currentSystemEpoch);
     EXPECT_EQ(17530U, cleaned->cleanedEpoch);
+
+    // Only cleaning segments that were once the head can lose changes.
+    EXPECT_TRUE(cleaned->appendedAsHead);
+    EXPECT_FALSE(survivor->appendedAsHead);
+    EXPECT_EQ(cleaned->id + 1, segmentManager.getCleanedHeadSegmentIdLimit());
+
+    // Survivors get their relocation generation once they join the log.
+    EXPECT_TRUE(survivor->isSurvivor);
+    EXPECT_EQ(0U, survivor->relocationGeneration);
+    EXPECT_EQ(0U, segmentManager.getRelocationGeneration());
+    segmentManager.allocHeadSegment();
+    EXPECT_EQ(1U, survivor->relocationGeneration);
+    EXPECT_EQ(1U, segmentManager.getRelocationGeneration());
 }
 
 TEST_F(SegmentManagerTest, cleanableSegments) {
@@ -373,6 +387,54 @@ TEST_F(SegmentManagerTest, doesIdExist) {
 // getFreeSegmentCount, getMaximumSegmentCount, getSegletSize, & getSegmentSize
 // aren't paricularly interesting
 
+TEST_F(SegmentManagerTest, allocateVersion_basics) {
+    uint64_t blockSize = SegmentManager::VERSION_BLOCK_SIZE;
+    EXPECT_EQ(1U, segmentManager.allocateVersion());
+    EXPECT_EQ(blockSize, segmentManager.safeVersion);
+    EXPECT_EQ(2U, segmentManager.allocateVersion());
+    EXPECT_EQ(3U, segmentManager.allocateVersion());
+
+    // Use up the rest of the block; the next one follows it.
+    SegmentManager::VersionBlock& block = segmentManager.versionBlocks[
+            ThreadId::get() % SegmentManager::NUM_VERSION_BLOCKS];
+    block.next = blockSize - 1;
+    EXPECT_EQ(blockSize - 1, segmentManager.allocateVersion());
+    EXPECT_EQ(blockSize + 1, segmentManager.allocateVersion());
+    EXPECT_EQ(2 * blockSize, segmentManager.safeVersion);
+}
+
+TEST_F(SegmentManagerTest, allocateVersion_belowMinimum) {
+    uint64_t blockSize = SegmentManager::VERSION_BLOCK_SIZE;
+    EXPECT_EQ(1U, segmentManager.allocateVersion());
+
+    // Raising within the cached block abandons it too.
+    EXPECT_FALSE(segmentManager.raiseSafeVersion(500));
+    EXPECT_EQ(500U, segmentManager.minimumVersion);
+    EXPECT_EQ(blockSize + 1, segmentManager.allocateVersion());
+
+    EXPECT_TRUE(segmentManager.raiseSafeVersion(5000));
+    EXPECT_EQ(5000U, segmentManager.allocateVersion());
+    EXPECT_EQ(5 * blockSize, segmentManager.safeVersion);
+}
+
+TEST_F(SegmentManagerTest, reserveVersions) {
+    uint64_t blockSize = SegmentManager::VERSION_BLOCK_SIZE;
+    EXPECT_EQ(1U, segmentManager.reserveVersions());
+    EXPECT_EQ(blockSize + 1, segmentManager.reserveVersions());
+    segmentManager.safeVersion = 3 * blockSize - 2;
+    EXPECT_EQ(3 * blockSize - 2, segmentManager.reserveVersions());
+    EXPECT_EQ(3 * blockSize, segmentManager.safeVersion);
+}
+
+TEST_F(SegmentManagerTest, raiseSafeVersion) {
+    EXPECT_TRUE(segmentManager.raiseSafeVersion(10));
+    EXPECT_EQ(10U, segmentManager.safeVersion);
+    EXPECT_EQ(10U, segmentManager.minimumVersion);
+    EXPECT_FALSE(segmentManager.raiseSafeVersion(5));
+    EXPECT_EQ(10U, segmentManager.safeVersion);
+    EXPECT_EQ(10U, segmentManager.minimumVersion);
+}
+
 TEST_F(SegmentManagerTest, writeHeader) {
     LogSegment* s = segmentManager.alloc(SegmentManager::ALLOC_HEAD, 42, 8118);
     EXPECT_EQ(8118U, s->creationTimestamp);
@@ -476,6 +538,8 @@ TEST_F(SegmentManagerTest, alloc_normal) {
     EXPECT_EQ(s->slot, segmentManager.idToSlotMap[s->id]);
     EXPECT_EQ(1U, segmentManager.allSegments.size());
     EXPECT_EQ(1U, segmentManager.segmentsByState[SegmentManager::HEAD].size());
+    EXPECT_EQ(uint32_t(SegmentManager::NON_TEMPORAL_APPEND_BYTES),
+              s->nonTemporalCopyBytes);
 }
 
 TEST_F(SegmentManagerTest, alloc_emergencyHead) {
@@ -495,6 +559,13 @@ TEST_F(SegmentManagerTest, alloc_survivor) {
     EXPECT_EQ(94305U, s->creationTimestamp);
     EXPECT_FALSE(s->isEmergencyHead);
     EXPECT_EQ(SegmentManager::SIDELOG, sm->states[s->slot]);
+    EXPECT_EQ(uint32_t(SegmentManager::NON_TEMPORAL_SURVIVOR_BYTES),
+              s->nonTemporalCopyBytes);
+
+    sm->setNonTemporalCopyBytes(1000, ~0u);
+    s = sm->alloc(SegmentManager::ALLOC_REGULAR_SIDELOG, 89, 94305);
+    ASSERT_NE(static_cast<LogSegment*>(NULL), s);
+    EXPECT_EQ(1000U, s->nonTemporalCopyBytes);
 }
 
 TEST_F(SegmentManagerTest, allocSlot) {
@@ -611,9 +682,10 @@ TEST_F(SegmentManagerTest, freeUnreferencedSegments) {
     LogSegment* freeable = segmentManager.allocHeadSegment();
     segmentManager.allocHeadSegment();
 
+    LogProtector::currentSystemEpoch = 8;
     ServerRpcPool<TestServerRpc> pool;
     TestServerRpc* rpc = pool.construct();
-    rpc->epoch = 8;
+    rpc->logProtectorPin.acquire();
 
     segmentManager.changeState(*freeable,
         SegmentManager::FREEABLE_PENDING_REFERENCES);
@@ -645,9 +717,10 @@ TEST_F(SegmentManagerTest, freeUnreferencedSegments_blockByWorkerTimer) {
     LogSegment* freeable = segmentManager.allocHeadSegment();
     segmentManager.allocHeadSegment();
 
+    LogProtector::currentSystemEpoch = 8;
     ServerRpcPool<TestServerRpc> pool;
     TestServerRpc* rpc = pool.construct();
-    rpc->epoch = 8;
+    rpc->logProtectorPin.acquire();
 
     segmentManager.changeState(*freeable,
         SegmentManager::FREEABLE_PENDING_REFERENCES);
@@ -705,7 +778,7 @@ TEST_F(SegmentManagerTest, freeUnreferencedSegments_logWhenStuck) {
     LogProtector::currentSystemEpoch = 8;
     ServerRpcPool<TestServerRpc> pool;
     TestServerRpc* rpc = pool.construct();
-    rpc->epoch = 8;
+    rpc->logProtectorPin.acquire();
 
     segmentManager.changeState(*freeable,
         SegmentManager::FREEABLE_PENDING_REFERENCES);
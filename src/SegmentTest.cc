@@ -128,6 +128,79 @@ TEST_P(SegmentTest, append_blackBox) {
     }
 }
 
+TEST_P(SegmentTest, append_nonTemporal) {
+    SegmentAndAllocator segAndAlloc(GetParam());
+    Segment& s = *segAndAlloc.segment;
+    s.setNonTemporalCopyBytes(500);
+
+    // Odd lengths and offsets, so that the streamed part of each entry
+    // starts and ends in the middle of cache lines (and seglets).
+    char buf[3001];
+    for (uint32_t i = 0; i < sizeof(buf); i++)
+        buf[i] = static_cast<char>(i * 7);
+    for (uint32_t i = 1; i < sizeof(buf); i += 333) {
+        Segment::Reference ref;
+        EXPECT_TRUE(s.append(LOG_ENTRY_TYPE_OBJ, buf + i % 13, i, &ref));
+
+        Buffer buffer;
+        s.getEntry(ref, &buffer);
+        EXPECT_EQ(i, buffer.size());
+        EXPECT_EQ(0, memcmp(buf + i % 13, buffer.getRange(0, i), i));
+    }
+}
+
+TEST_F(SegmentTest, append_contiguous) {
+    SegmentAndSegletSize sizes = { 8192, 1024 };
+    SegmentAndAllocator segAndAlloc(&sizes);
+    Segment& s = *segAndAlloc.segment;
+    s.setContiguousEntryBytes(512);
+
+    // Each entry takes 303 bytes, so the fourth would span the first two
+    // seglets.
+    char buf[1500];
+    memset(buf, 'x', sizeof(buf));
+    Segment::Reference ref;
+    for (int i = 0; i < 4; i++)
+        EXPECT_TRUE(s.append(LOG_ENTRY_TYPE_OBJ, buf, 300, &ref));
+    EXPECT_EQ(1024U, s.getOffset(ref));
+    EXPECT_EQ(115U, s.getPaddingBytes());
+    EXPECT_EQ(0U, s.getStraddlingEntries());
+
+    Buffer buffer;
+    uint32_t lengthWithMetadata;
+    EXPECT_EQ(LOG_ENTRY_TYPE_PADDING,
+              s.getEntry(909, &buffer, &lengthWithMetadata));
+    EXPECT_EQ(115U, lengthWithMetadata);
+    buffer.reset();
+    s.getEntry(ref, &buffer);
+    EXPECT_EQ(1U, buffer.getNumberChunks());
+
+    // Entries over the threshold are never padded.
+    EXPECT_TRUE(s.append(LOG_ENTRY_TYPE_OBJ, buf, 1500, &ref));
+    EXPECT_EQ(1327U, s.getOffset(ref));
+    EXPECT_EQ(115U, s.getPaddingBytes());
+    EXPECT_EQ(1U, s.getStraddlingEntries());
+}
+
+TEST_F(SegmentTest, appendPadding) {
+    Segment s;
+
+    // No single entry is 258 bytes long: 256 bytes of contents need two
+    // length bytes, but 255 need only one.
+    s.appendPadding(258);
+    EXPECT_EQ(258U, s.head);
+    EXPECT_EQ(258U, s.getPaddingBytes());
+
+    Buffer buffer;
+    uint32_t lengthWithMetadata;
+    EXPECT_EQ(LOG_ENTRY_TYPE_PADDING,
+              s.getEntry(0, &buffer, &lengthWithMetadata));
+    EXPECT_EQ(2U, lengthWithMetadata);
+    EXPECT_EQ(LOG_ENTRY_TYPE_PADDING,
+              s.getEntry(2, &buffer, &lengthWithMetadata));
+    EXPECT_EQ(256U, lengthWithMetadata);
+}
+
 TEST_P(SegmentTest, append_outOfSpace) {
     SegmentAndAllocator segAndAlloc(GetParam());
     Segment& s = *segAndAlloc.segment;
@@ -269,6 +342,62 @@ TEST_P(SegmentTest, close) {
     EXPECT_TRUE(s.closed);
 }
 
+TEST_P(SegmentTest, close_contentChecksum) {
+    SegmentAndAllocator segAndAlloc(GetParam());
+    Segment& s = *segAndAlloc.segment;
+    s.append(LOG_ENTRY_TYPE_OBJ, "this is only a test!", 21);
+    SegmentCertificate before;
+    s.getAppendedLength(&before);
+
+    // Nothing changes unless content checksums are enabled.
+    Segment plain;
+    plain.append(LOG_ENTRY_TYPE_OBJ, "this is only a test!", 21);
+    plain.close();
+    SegmentCertificate certificate;
+    plain.getAppendedLength(&certificate);
+    EXPECT_FALSE(plain.hasContentChecksum());
+    EXPECT_EQ(before, certificate);
+
+    s.enableContentChecksum();
+    EXPECT_FALSE(s.hasContentChecksum());
+    s.close();
+    EXPECT_TRUE(s.hasContentChecksum());
+    s.getAppendedLength(&certificate);
+    EXPECT_EQ(before.segmentLength + Segment::CONTENT_CHECKSUM_ENTRY_BYTES,
+              certificate.segmentLength);
+    EXPECT_NE(before.checksum, certificate.checksum);
+    EXPECT_TRUE(s.checkMetadataIntegrity(certificate));
+
+    Buffer buffer;
+    EXPECT_EQ(LOG_ENTRY_TYPE_SEGCHECKSUM,
+              s.getEntry(before.segmentLength, &buffer));
+    EXPECT_EQ(s.checksumContents(before.segmentLength),
+              *buffer.getStart<Crc32C::ResultType>());
+
+    // Closing again appends nothing.
+    s.close();
+    EXPECT_EQ(certificate.segmentLength, s.getAppendedLength());
+}
+
+TEST_P(SegmentTest, close_contentChecksumReservesSpace) {
+    Segment s;
+    s.enableContentChecksum();
+
+    // An entry this long has a one-byte header and three length bytes.
+    uint32_t length = s.segletSize - Segment::CONTENT_CHECKSUM_ENTRY_BYTES - 4;
+    EXPECT_TRUE(s.hasSpaceFor(&length, 1));
+    length++;
+    EXPECT_FALSE(s.hasSpaceFor(&length, 1));
+    length--;
+
+    vector<char> contents(length);
+    EXPECT_TRUE(s.append(LOG_ENTRY_TYPE_OBJ, &contents[0], length));
+    EXPECT_FALSE(s.hasSpaceFor(1u));
+    s.close();
+    EXPECT_TRUE(s.hasContentChecksum());
+    EXPECT_EQ(s.segletSize, s.getAppendedLength());
+}
+
 TEST_P(SegmentTest, appendToBuffer_partial) {
     SegmentAndAllocator segAndAlloc(GetParam());
     Segment& s = *segAndAlloc.segment;
@@ -320,6 +449,25 @@ TEST_P(SegmentTest, getEntry_byReference) {
         reinterpret_cast<const char*>(buffer.getRange(0, 21)));
 }
 
+TEST_P(SegmentTest, getEntry_zeroCopy) {
+    SegmentAndAllocator segAndAlloc(GetParam());
+    Segment& s = *segAndAlloc.segment;
+    Segment::Reference ref;
+    s.append(LOG_ENTRY_TYPE_OBJ, "small", 6, &ref);
+
+    // Even small entries are referenced in place rather than copied.
+    Buffer buffer;
+    EXPECT_EQ(LOG_ENTRY_TYPE_OBJ, s.getEntry(ref, &buffer));
+    Buffer::Iterator it(&buffer);
+    EXPECT_EQ(1U, it.getNumberChunks());
+    EXPECT_FALSE(it.current->internal);
+    const void* p = NULL;
+    s.peek(s.getOffset(ref), &p);
+    EXPECT_LT(reinterpret_cast<uintptr_t>(p),
+              reinterpret_cast<uintptr_t>(it.getData()));
+    EXPECT_STREQ("small", reinterpret_cast<const char*>(it.getData()));
+}
+
 TEST_P(SegmentTest, getEntry_contigMem) {
     Buffer dataBuffer;
     char data[] = "this is only a test!";
@@ -535,6 +683,22 @@ TEST_P(SegmentTest, hasSpaceFor_fullLogEntry) {
     EXPECT_FALSE(s.hasSpaceFor(length + 1));
 }
 
+TEST_F(SegmentTest, hasSpaceFor_padding) {
+    SegmentAndSegletSize sizes = { 8192, 1024 };
+    SegmentAndAllocator segAndAlloc(&sizes);
+    Segment& s = *segAndAlloc.segment;
+
+    // 100 bytes are left in the next-to-last seglet, and 1124 in all. The
+    // entries take 1032 bytes, but the first needs 100 bytes of padding
+    // and the last 115 more.
+    s.head = 7068;
+    uint32_t lengths[4] = { 300, 300, 300, 120 };
+    EXPECT_TRUE(s.hasSpaceFor(lengths, 4));
+    s.setContiguousEntryBytes(512);
+    EXPECT_FALSE(s.hasSpaceFor(lengths, 4));
+    EXPECT_TRUE(s.hasSpaceFor(lengths, 3));
+}
+
 TEST_P(SegmentTest, copyOut) {
     SegmentAndAllocator segAndAlloc(GetParam());
     Segment& s = *segAndAlloc.segment;
@@ -550,6 +714,13 @@ TEST_P(SegmentTest, copyOut) {
     s.copyIn(5, src, sizeof(src));
     s.copyOut(5, buf, sizeof(src));
     EXPECT_EQ(0, memcmp(src, buf, sizeof(src)));
+
+    for (uint32_t i = 0; i < sizeof(buf); i++)
+        buf[i] = static_cast<char>(i);
+    EXPECT_EQ(sizeof32(buf), s.copyIn(200, buf, sizeof(buf), true));
+    char out[1024];
+    s.copyOut(200, out, sizeof(out));
+    EXPECT_EQ(0, memcmp(buf, out, sizeof(out)));
 }
 
 TEST_P(SegmentTest, copyIn) {
@@ -619,6 +790,33 @@ TEST_P(SegmentTest, checkMetadataIntegrity_simple) {
         "checkMetadataIntegrity: segment corrupt: bad checksum"));
 }
 
+TEST_P(SegmentTest, checkMetadataIntegrity_contentChecksum) {
+    TestLog::Enable _;
+    SegmentAndAllocator segAndAlloc(GetParam());
+    Segment& s = *segAndAlloc.segment;
+    s.enableContentChecksum();
+    s.append(LOG_ENTRY_TYPE_OBJ, "asdfhasdf", 10);
+    s.close();
+    SegmentCertificate certificate;
+    s.getAppendedLength(&certificate);
+    EXPECT_TRUE(s.checkMetadataIntegrity(certificate));
+
+    // Unlike above, scribbling on an entry's data is caught.
+    s.copyIn(2, "ASDFHASDF", 10);
+    EXPECT_FALSE(s.checkMetadataIntegrity(certificate));
+    EXPECT_TRUE(StringUtil::startsWith(TestLog::get(),
+        "checkMetadataIntegrity: segment corrupt: bad content checksum"));
+
+    // So is tampering with the checksum itself.
+    s.copyIn(2, "asdfhasdf", 10);
+    EXPECT_TRUE(s.checkMetadataIntegrity(certificate));
+    TestLog::reset();
+    s.copyIn(certificate.segmentLength - 1, "X", 1);
+    EXPECT_FALSE(s.checkMetadataIntegrity(certificate));
+    EXPECT_TRUE(StringUtil::startsWith(TestLog::get(),
+        "checkMetadataIntegrity: segment corrupt: bad content checksum"));
+}
+
 TEST_P(SegmentTest, checkMetadataIntegrity_badLength) {
     TestLog::Enable _;
     SegmentAndAllocator segAndAlloc(GetParam());
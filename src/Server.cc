@@ -46,7 +46,12 @@ Server::Server(Context* context, const ServerConfig* config)
 {
     context->coordinatorSession->setLocation(
             config->coordinatorLocator.c_str(), config->clusterName.c_str());
-    context->workerManager = new WorkerManager(context, config->maxCores-1);
+    // The WorkerManager already exists if the server's transports run on
+    // DispatchShards, which need it from the start.
+    if (context->workerManager == NULL) {
+        context->workerManager = new WorkerManager(context,
+                                                   config->maxCores-1);
+    }
 }
 
 /**
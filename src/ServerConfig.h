@@ -229,12 +229,43 @@ struct ServerConfig {
         Master(Testing) // NOLINT
             : logBytes(40 * 1024 * 1024)
             , hashTableBytes(1 * 1024 * 1024)
+            , maxHashTableBytes(0)
             , disableLogCleaner(true)
             , disableInMemoryCleaning(true)
             , diskExpansionFactor(1.0)
             , cleanerBalancer("tombstoneRatio:0.40")
             , cleanerWriteCostThreshold(0)
             , cleanerThreadCount(1)
+            , cleanerColdDataAge(0)
+            , cleanerLargeEntryBytes(0)
+            , cleanerCopyOnBackups(false)
+            , flashTierFile()
+            , flashTierBytes(0)
+            , numaNodes(1)
+            , recoveryReplayThreads(1)
+            , onDemandRecovery(false)
+            , snapshotRetentionMs(0)
+            , replicationWriteBatchSegments(1)
+            , replicationCleanerRateLimit(0)
+            , replicationChain(false)
+            , replicationRemoteWrites(false)
+            , erasureCodeDataFragments(0)
+            , erasureCodeParityFragments(0)
+            , writeAdmissionUtilization(0)
+            , tableQuotaPercent(0)
+            , remoteReadSlots(0)
+            , migrationThreads(1)
+            , migrationSegmentsInFlight(4)
+            , migrationReplayThreads(1)
+            , inMemoryIndexlets(false)
+            , valueCompressionThreshold(0)
+            , compactObjectHeaders(false)
+            , deferObjectChecksums(false)
+            , inlineSmallValues(false)
+            , combineIncrements(false)
+            , omitSameSegmentTombstones(false)
+            , hotKeyReplicas(0)
+            , hotKeySampleInterval(0)
             , numReplicas(0)
             , useMinCopysets(false)
             , allowLocalBackup(false)
@@ -248,12 +279,43 @@ struct ServerConfig {
         Master()
             : logBytes()
             , hashTableBytes()
+            , maxHashTableBytes()
             , disableLogCleaner()
             , disableInMemoryCleaning()
             , diskExpansionFactor()
             , cleanerBalancer()
             , cleanerWriteCostThreshold()
             , cleanerThreadCount()
+            , cleanerColdDataAge()
+            , cleanerLargeEntryBytes()
+            , cleanerCopyOnBackups()
+            , flashTierFile()
+            , flashTierBytes()
+            , numaNodes()
+            , recoveryReplayThreads()
+            , onDemandRecovery()
+            , snapshotRetentionMs()
+            , replicationWriteBatchSegments()
+            , replicationCleanerRateLimit()
+            , replicationChain()
+            , replicationRemoteWrites()
+            , erasureCodeDataFragments()
+            , erasureCodeParityFragments()
+            , writeAdmissionUtilization()
+            , tableQuotaPercent()
+            , remoteReadSlots()
+            , migrationThreads()
+            , migrationSegmentsInFlight()
+            , migrationReplayThreads()
+            , inMemoryIndexlets(false)
+            , valueCompressionThreshold()
+            , compactObjectHeaders(false)
+            , deferObjectChecksums(false)
+            , inlineSmallValues(false)
+            , combineIncrements(false)
+            , omitSameSegmentTombstones(false)
+            , hotKeyReplicas()
+            , hotKeySampleInterval()
             , numReplicas()
             , useMinCopysets()
             , allowLocalBackup()
@@ -267,12 +329,48 @@ struct ServerConfig {
         {
             config.set_log_bytes(logBytes);
             config.set_hash_table_bytes(hashTableBytes);
+            config.set_max_hash_table_bytes(maxHashTableBytes);
             config.set_disable_log_cleaner(disableLogCleaner);
             config.set_disable_in_memory_cleaning(disableInMemoryCleaning);
             config.set_backup_disk_expansion_factor(diskExpansionFactor);
             config.set_cleaner_balancer(cleanerBalancer);
             config.set_cleaner_write_cost_threshold(cleanerWriteCostThreshold);
             config.set_cleaner_thread_count(cleanerThreadCount);
+            config.set_cleaner_cold_data_age(cleanerColdDataAge);
+            config.set_cleaner_large_entry_bytes(cleanerLargeEntryBytes);
+            config.set_cleaner_copy_on_backups(cleanerCopyOnBackups);
+            config.set_flash_tier_file(flashTierFile);
+            config.set_flash_tier_bytes(flashTierBytes);
+            config.set_numa_nodes(numaNodes);
+            config.set_recovery_replay_threads(recoveryReplayThreads);
+            config.set_on_demand_recovery(onDemandRecovery);
+            config.set_snapshot_retention_ms(snapshotRetentionMs);
+            config.set_replication_write_batch_segments(
+                    replicationWriteBatchSegments);
+            config.set_replication_cleaner_rate_limit(
+                    replicationCleanerRateLimit);
+            config.set_replication_chain(replicationChain);
+            config.set_replication_remote_writes(replicationRemoteWrites);
+            config.set_erasure_code_data_fragments(erasureCodeDataFragments);
+            config.set_erasure_code_parity_fragments(
+                    erasureCodeParityFragments);
+            config.set_write_admission_utilization(writeAdmissionUtilization);
+            config.set_table_quota_percent(tableQuotaPercent);
+            config.set_remote_read_slots(remoteReadSlots);
+            config.set_migration_threads(migrationThreads);
+            config.set_migration_segments_in_flight(
+                    migrationSegmentsInFlight);
+            config.set_migration_replay_threads(migrationReplayThreads);
+            config.set_in_memory_indexlets(inMemoryIndexlets);
+            config.set_value_compression_threshold(valueCompressionThreshold);
+            config.set_compact_object_headers(compactObjectHeaders);
+            config.set_defer_object_checksums(deferObjectChecksums);
+            config.set_inline_small_values(inlineSmallValues);
+            config.set_combine_increments(combineIncrements);
+            config.set_omit_same_segment_tombstones(
+                    omitSameSegmentTombstones);
+            config.set_hot_key_replicas(hotKeyReplicas);
+            config.set_hot_key_sample_interval(hotKeySampleInterval);
             config.set_num_replicas(numReplicas);
             config.set_use_mincopysets(useMinCopysets);
             config.set_use_local_backup(allowLocalBackup);
@@ -287,12 +385,48 @@ struct ServerConfig {
         {
             logBytes = config.log_bytes();
             hashTableBytes = config.hash_table_bytes();
+            maxHashTableBytes = config.max_hash_table_bytes();
             disableLogCleaner = config.disable_log_cleaner();
             disableInMemoryCleaning = config.disable_in_memory_cleaning();
             diskExpansionFactor = config.backup_disk_expansion_factor();
             cleanerBalancer = config.cleaner_balancer();
             cleanerWriteCostThreshold = config.cleaner_write_cost_threshold();
             cleanerThreadCount = config.cleaner_thread_count();
+            cleanerColdDataAge = config.cleaner_cold_data_age();
+            cleanerLargeEntryBytes = config.cleaner_large_entry_bytes();
+            cleanerCopyOnBackups = config.cleaner_copy_on_backups();
+            flashTierFile = config.flash_tier_file();
+            flashTierBytes = config.flash_tier_bytes();
+            numaNodes = config.numa_nodes();
+            recoveryReplayThreads = config.recovery_replay_threads();
+            onDemandRecovery = config.on_demand_recovery();
+            snapshotRetentionMs = config.snapshot_retention_ms();
+            replicationWriteBatchSegments =
+                    config.replication_write_batch_segments();
+            replicationCleanerRateLimit =
+                    config.replication_cleaner_rate_limit();
+            replicationChain = config.replication_chain();
+            replicationRemoteWrites = config.replication_remote_writes();
+            erasureCodeDataFragments = config.erasure_code_data_fragments();
+            erasureCodeParityFragments =
+                    config.erasure_code_parity_fragments();
+            writeAdmissionUtilization = config.write_admission_utilization();
+            tableQuotaPercent = config.table_quota_percent();
+            remoteReadSlots = config.remote_read_slots();
+            migrationThreads = config.migration_threads();
+            migrationSegmentsInFlight =
+                    config.migration_segments_in_flight();
+            migrationReplayThreads = config.migration_replay_threads();
+            inMemoryIndexlets = config.in_memory_indexlets();
+            valueCompressionThreshold = config.value_compression_threshold();
+            compactObjectHeaders = config.compact_object_headers();
+            deferObjectChecksums = config.defer_object_checksums();
+            inlineSmallValues = config.inline_small_values();
+            combineIncrements = config.combine_increments();
+            omitSameSegmentTombstones =
+                    config.omit_same_segment_tombstones();
+            hotKeyReplicas = config.hot_key_replicas();
+            hotKeySampleInterval = config.hot_key_sample_interval();
             numReplicas = config.num_replicas();
             useMinCopysets = config.use_mincopysets();
             allowLocalBackup = config.use_local_backup();
@@ -304,6 +438,11 @@ struct ServerConfig {
         /// Total number of bytes to use for the HashTable.
         uint64_t hashTableBytes;
 
+        /// The HashTable starts out with hashTableBytes and grows online
+        /// (doubling each time) as objects are added, up to this many bytes.
+        /// If this is not larger than hashTableBytes, the table never grows.
+        uint64_t maxHashTableBytes;
+
         /// If true, disable the log cleaner entirely.
         bool disableLogCleaner;
 
@@ -330,6 +469,164 @@ struct ServerConfig {
         /// at the expense of CPU cycles.
         uint32_t cleanerThreadCount;
 
+        /// If nonzero, the disk cleaner writes live data at least this many
+        /// seconds old to separate survivor segments from younger data.
+        uint32_t cleanerColdDataAge;
+
+        /// If nonzero, the disk cleaner writes live entries at least this
+        /// many bytes long to separate survivor segments from smaller ones.
+        uint32_t cleanerLargeEntryBytes;
+
+        /// If true, backups build replicas of survivor segments by copying
+        /// the relocated entries out of their own replicas of the segments
+        /// being cleaned, rather than being sent them again.
+        bool cleanerCopyOnBackups;
+
+        /// If not empty, a file (or block device) on local flash to which
+        /// the disk cleaner moves survivor segments of cold objects, so that
+        /// they no longer take up memory; see FlashTier. This needs
+        /// #cleanerColdDataAge to decide what is cold.
+        string flashTierFile;
+
+        /// Number of bytes of #flashTierFile to use.
+        uint64_t flashTierBytes;
+
+        /// Number of NUMA nodes to split log memory across. Each node's share
+        /// is bound to its memory and new segments are allocated from the
+        /// node the allocating thread runs on. 1 (or 0) disables this.
+        uint32_t numaNodes;
+
+        /// Number of threads a recovery master replays each recovery segment
+        /// with; see ParallelSegmentReplay.
+        uint32_t recoveryReplayThreads;
+
+        /// Whether a recovery master serves reads of the keys it has
+        /// already replayed, and replays the segments of requested keys
+        /// first; see OnDemandRecovery.
+        bool onDemandRecovery;
+
+        /// How long (in milliseconds of cluster-time) overwritten and
+        /// removed versions of objects are kept so that snapshot reads and
+        /// snapshot-isolation transactions can see them; 0 keeps none. See
+        /// VersionHistory.
+        uint32_t snapshotRetentionMs;
+
+        /// Maximum number of replica writes to the same backup that the
+        /// ReplicaManager combines into one rpc; see BackupWriteBatcher.
+        /// 1 (or 0) sends every write in its own rpc.
+        uint32_t replicationWriteBatchSegments;
+
+        /// If nonzero, the most megabytes per second of replica data the
+        /// ReplicaManager sends for the log cleaner's survivor segments;
+        /// see ReplicationPacer.
+        uint32_t replicationCleanerRateLimit;
+
+        /// Whether the ReplicaManager sends each write to one backup, which
+        /// passes it on to the backups of the segment's other replicas; see
+        /// ReplicatedSegment::buildChain().
+        bool replicationChain;
+
+        /// Whether the ReplicaManager places replica data directly in the
+        /// memory of backups that allow it with one-sided RDMA writes; see
+        /// ReplicatedSegment::writeRemotely().
+        bool replicationRemoteWrites;
+
+        /// If nonzero, the ReplicaManager stores closed segments as this
+        /// many Reed-Solomon data fragments plus #erasureCodeParityFragments
+        /// parity fragments on distinct backups instead of as full replicas;
+        /// see ReedSolomon and ReplicatedSegment. The log head is replicated
+        /// in full while it is open.
+        uint32_t erasureCodeDataFragments;
+
+        /// Number of parity fragments each closed segment is given when
+        /// #erasureCodeDataFragments is nonzero; this many fragments can be
+        /// lost without losing the segment.
+        uint32_t erasureCodeParityFragments;
+
+        /// If nonzero, the log memory utilization (a percentage) at which
+        /// writes start to be paced to the rate of cleaning; see
+        /// WriteAdmission.
+        uint32_t writeAdmissionUtilization;
+
+        /// If nonzero, no table may take up more than this percentage of
+        /// the log's memory once the cleaner is running; writes that would
+        /// take it further are refused until the cleaner catches up. See
+        /// WriteAdmission.
+        uint32_t tableQuotaPercent;
+
+        /// Number of slots in the table through which clients locate
+        /// objects for one-sided RDMA reads; see RemoteReadTable. 0 disables
+        /// remote reads.
+        uint32_t remoteReadSlots;
+
+        /// Number of threads a master scans its log with when migrating a
+        /// tablet away; see MigrationSender.
+        uint32_t migrationThreads;
+
+        /// Maximum number of segments of migration data a master has in
+        /// flight to the receiving master at once; see MigrationSender.
+        uint32_t migrationSegmentsInFlight;
+
+        /// Number of threads a master replays each segment of incoming
+        /// migration data with; see ParallelSegmentReplay.
+        uint32_t migrationReplayThreads;
+
+        /// If true, indexlets are kept in in-memory trees (see IndexTree),
+        /// with each index entry persisted as a small object in the backing
+        /// table, rather than as trees of node objects (see IndexBtree).
+        /// All masters in a cluster must use the same setting, since index
+        /// data written one way can't be read the other way.
+        bool inMemoryIndexlets;
+
+        /// Values at least this many bytes long are stored compressed in
+        /// the log when that saves space; see
+        /// Object::assembleCompressedForLog(). 0 disables compression.
+        /// Masters can always read compressed values, so this may differ
+        /// from one master to the next.
+        uint32_t valueCompressionThreshold;
+
+        /// If true, objects whose table id and version are small enough are
+        /// stored in the log with an Object::CompactHeader rather than a
+        /// full Object::Header. Masters can always read both, so this may
+        /// differ from one master to the next.
+        bool compactObjectHeaders;
+
+        /// If true, objects are written to the log without their own
+        /// checksums, and the contents of each segment are checksummed as a
+        /// whole when it is closed instead; see Object::setDeferredChecksum()
+        /// and Segment::enableContentChecksum(). Masters can always read
+        /// both kinds of objects, so this may differ from one master to the
+        /// next.
+        bool deferObjectChecksums;
+
+        /// If true, the hash table keeps a copy of one small object (at most
+        /// HashTable::MAX_INLINE_VALUE_LENGTH bytes of value) next to each
+        /// bucket, so that reads of it are answered without touching the
+        /// log. This takes another cache line of memory per bucket.
+        bool inlineSmallValues;
+
+        /// If true, unconditional increments of the same object by
+        /// concurrent RPCs are combined into a single write of the object;
+        /// see MasterService::combineIncrement().
+        bool combineIncrements;
+
+        /// If true, overwriting an object whose current version is in the
+        /// log head writes no tombstone for that version; see
+        /// ObjectManager::writeObject(). Saves the log space and cleaner
+        /// work of tombstones (each of which repeats the object's key) for
+        /// keys that are overwritten in quick succession.
+        bool omitSameSegmentTombstones;
+
+        /// Number of other masters that hold read replicas of each of this
+        /// master's hot objects; 0 means hot objects aren't replicated. See
+        /// HotKeyReplicator.
+        uint32_t hotKeyReplicas;
+
+        /// One out of this many reads and writes (per thread) is recorded
+        /// in the sketch that finds this master's hot keys; 0 disables it.
+        /// See HotKeySketch.
+        uint32_t hotKeySampleInterval;
+
         /// Number of replicas to keep per segment stored on backups.
         uint32_t numReplicas;
 
@@ -360,6 +657,14 @@ struct ServerConfig {
             , strategy(1)
             , mockSpeed(100)
             , writeRateLimit(0)
+            , useIoUring(false)
+            , ioQueueDepth(1)
+            , recoveryBuildThreads(1)
+            , compressReplicas(false)
+            , writeBackStaging(false)
+            , pmem(false)
+            , remoteWrites(false)
+            , recoveryDedup(false)
         {}
 
         /**
@@ -377,6 +682,14 @@ struct ServerConfig {
             , strategy(1)
             , mockSpeed(0)
             , writeRateLimit(0)
+            , useIoUring(false)
+            , ioQueueDepth(1)
+            , recoveryBuildThreads(1)
+            , compressReplicas(false)
+            , writeBackStaging(false)
+            , pmem(false)
+            , remoteWrites(false)
+            , recoveryDedup(false)
         {}
 
         /**
@@ -470,6 +783,67 @@ struct ServerConfig {
          * If non-0, limit writes to backup to this many megabytes per second.
          */
         size_t writeRateLimit;
+
+        /**
+         * If true, disk-based storage issues its IO through io_uring rather
+         * than POSIX aio. Like #sync, this is a purely local setting.
+         */
+        bool useIoUring;
+
+        /**
+         * Number of replicas whose disk IO may be outstanding at once (see
+         * MultiFileStorage). A purely local setting, like #useIoUring.
+         */
+        uint32_t ioQueueDepth;
+
+        /**
+         * Number of threads that build recovery segments from primary
+         * replicas in parallel (see BackupMasterRecovery). A purely local
+         * setting, like #useIoUring.
+         */
+        uint32_t recoveryBuildThreads;
+
+        /**
+         * If true, disk-based storage stores closed replicas compressed and
+         * recovery expands them before building recovery segments. A purely
+         * local setting, like #useIoUring.
+         */
+        bool compressReplicas;
+
+        /**
+         * If true, disk-based storage treats its replica buffers as durable
+         * (the backup's DRAM is protected by a battery, UPS or NVDIMMs):
+         * appends are acknowledged once buffered, even for synchronous
+         * replicas, and closed replicas are flushed to disk in the
+         * background, in frame order. A purely local setting, like
+         * #useIoUring.
+         */
+        bool writeBackStaging;
+
+        /**
+         * If true (and #inMemory is false), #file is a file on persistent
+         * memory, such as a DAX filesystem, and replicas are stored by
+         * mapping it into memory (see PmemStorage) rather than through
+         * block IO. A purely local setting, like #useIoUring.
+         */
+        bool pmem;
+
+        /**
+         * If true (and #inMemory is true), all replica memory is allocated
+         * at startup and registered with the transports, so that masters
+         * may write replica data into it with one-sided RDMA writes (see
+         * InMemoryStorage::getFrameMemory). A purely local setting, like
+         * #useIoUring.
+         */
+        bool remoteWrites;
+
+        /**
+         * If true, recovery segments leave out objects and tombstones that
+         * are superseded by a newer version of the same key in the same
+         * replica (see RecoverySegmentBuilder::build). A purely local
+         * setting, like #useIoUring.
+         */
+        bool recoveryDedup;
     } backup;
 
   public:
@@ -156,6 +156,7 @@ ServerIdRpcWrapper::send()
     assert(context->serverList != NULL);
     session = context->serverList->getSession(id);
     state = IN_PROGRESS;
+    RpcTrace::recordSend(&request);
     session->sendRequest(&request, response, this);
 }
 
@@ -160,7 +160,7 @@ TEST_F(ServerIdRpcWrapperTest, handleTransportError_callServerCrashed) {
     id = context.coordinatorServerList->enlistServer(
             {WireFormat::MASTER_SERVICE}, 0, 100, "mock:");
     ServerIdRpcWrapper wrapper(&context, id, 4);
-    wrapper.request.fillFromString("100");
+    wrapper.request.fillFromString("100 0 0");
     wrapper.send();
     wrapper.state = RpcWrapper::RpcState::FAILED;
     wrapper.transportErrors = 2;
@@ -35,6 +35,10 @@ ServerList::ServerList(Context* context)
     : AbstractServerList(context)
     , serverList()
 {
+    // Lookups use the (empty) snapshot from the start, so they never
+    // acquire the lock.
+    Lock lock(mutex);
+    publishSnapshot(lock);
 }
 
 /**
@@ -163,9 +167,11 @@ ServerList::applyServerList(const ProtoBuf::ServerList& list)
             return version;
         }
     } else {
-        // Ignore an update unless its version number exactly follows
-        // the local version number.
-        if (list.version_number() != version + 1) {
+        // Ignore an update unless it starts exactly at the local version
+        // number.
+        uint64_t baseVersion = list.has_base_version() ?
+                list.base_version() : list.version_number() - 1;
+        if (baseVersion != version) {
             LOG(NOTICE, "Ignoring out-of order server list update with "
                     "version %lu (local server list is at version %lu)",
                     list.version_number(), version);
@@ -218,6 +224,7 @@ ServerList::applyServerList(const ProtoBuf::ServerList& list)
     }
 
     version = list.version_number();
+    publishSnapshot(lock);
     foreach (ServerTrackerInterface* tracker, trackers)
         tracker->fireCallback();
     return version;
@@ -237,6 +244,7 @@ ServerList::applyServerList(const ProtoBuf::ServerList& list)
 void
 ServerList::testingAdd(const ServerDetails server)
 {
+    Lock lock(mutex);
     uint32_t index = server.serverId.indexNumber();
     if (index >= serverList.size())
         serverList.resize(index + 1);
@@ -244,6 +252,7 @@ ServerList::testingAdd(const ServerDetails server)
     entry.construct(server);
     foreach (ServerTrackerInterface* tracker, trackers)
         tracker->enqueueChange(*entry, ServerChangeEvent::SERVER_ADDED);
+    publishSnapshot(lock);
 }
 
 /**
@@ -259,10 +268,12 @@ ServerList::testingAdd(const ServerDetails server)
 void
 ServerList::testingCrashed(ServerId serverId)
 {
+    Lock lock(mutex);
     auto& entry = serverList.at(serverId.indexNumber());
     entry->status = ServerStatus::CRASHED;
     foreach (ServerTrackerInterface* tracker, trackers)
         tracker->enqueueChange(*entry, ServerChangeEvent::SERVER_CRASHED);
+    publishSnapshot(lock);
 }
 
 /**
@@ -278,11 +289,13 @@ ServerList::testingCrashed(ServerId serverId)
 void
 ServerList::testingRemove(ServerId serverId)
 {
+    Lock lock(mutex);
     auto& entry = serverList.at(serverId.indexNumber());
     entry->status = ServerStatus::REMOVE;
     foreach (ServerTrackerInterface* tracker, trackers)
         tracker->enqueueChange(*entry, ServerChangeEvent::SERVER_REMOVED);
     entry.destroy();
+    publishSnapshot(lock);
 }
 
 } // namespace RAMCloud
@@ -68,6 +68,42 @@ TEST_F(ServerListTest, indexOperator) {
 }
 
 
+TEST_F(ServerListTest, lookupsUseSnapshot) {
+    sl.testingAdd({{1, 0}, "mock:host=one", {WireFormat::MASTER_SERVICE},
+                   100, ServerStatus::UP});
+    sl.testingAdd({{2, 0}, "mock:host=two", {WireFormat::MASTER_SERVICE},
+                   100, ServerStatus::CRASHED});
+
+    // None of these acquire the lock (they would deadlock otherwise).
+    AbstractServerList::Lock lock(sl.mutex);
+    EXPECT_TRUE(sl.isUp({1, 0}));
+    EXPECT_FALSE(sl.isUp({2, 0}));
+    EXPECT_TRUE(sl.contains({2, 0}));
+    EXPECT_FALSE(sl.contains({2, 1}));
+    EXPECT_EQ(ServerStatus::CRASHED, sl.getStatus({2, 0}));
+    EXPECT_EQ(ServerStatus::REMOVE, sl.getStatus({3, 0}));
+    EXPECT_EQ("mock:host=one", sl.getLocator({1, 0}));
+    EXPECT_THROW(sl.getLocator({3, 0}), ServerListException);
+    EXPECT_EQ(ServerId(1, 0),
+              sl.nextServer({}, {WireFormat::MASTER_SERVICE}));
+    EXPECT_EQ(ServerId(2, 0),
+              sl.nextServer({1, 0}, {WireFormat::MASTER_SERVICE}, NULL,
+                            true));
+}
+
+TEST_F(ServerListTest, publishSnapshot_retiredWhileRead) {
+    {
+        AbstractServerList::SnapshotReader reader(&sl);
+        sl.testingAdd({{1, 0}, "mock:host=one", {}, 100, ServerStatus::UP});
+        EXPECT_EQ(1u, sl.retiredSnapshots.size());
+        EXPECT_TRUE(reader.snapshot->get({1, 0}) == NULL);
+        EXPECT_TRUE(sl.snapshot.load()->get({1, 0}) != NULL);
+    }
+    sl.testingCrashed({1, 0});
+    EXPECT_EQ(0u, sl.retiredSnapshots.size());
+    EXPECT_EQ(ServerStatus::CRASHED, sl.getStatus({1, 0}));
+}
+
 TEST_F(ServerListTest, applyServerList_doubleFullLists) {
     // Apply Full List
     ProtoBuf::ServerList wholeList;
@@ -106,6 +142,33 @@ TEST_F(ServerListTest, applyServerList_wrongVersion) {
             TestLog::get());
 }
 
+TEST_F(ServerListTest, applyServerList_mergedUpdates) {
+    ProtoBuf::ServerList update;
+    ServerListBuilder{update}
+        ({}, *ServerId{1, 0}, "mock:host=one", 101, 1)
+        ({}, *ServerId{2, 0}, "mock:host=two", 102, 1)
+        ({}, *ServerId{1, 0}, "mock:host=one", 101, 1, ServerStatus::CRASHED);
+    update.set_type(ProtoBuf::ServerList_Type_UPDATE);
+    update.set_version_number(13);
+    update.set_base_version(11);
+    sl.version = 10;
+
+    TestLog::Enable _;
+    EXPECT_EQ(10lu, sl.applyServerList(update));
+    EXPECT_EQ("applyServerList: Ignoring out-of order server list update "
+            "with version 13 (local server list is at version 10)",
+            TestLog::get());
+
+    // The entries are applied in order.
+    sl.version = 11;
+    EXPECT_EQ(13lu, sl.applyServerList(update));
+    EXPECT_FALSE(sl.isUp({1, 0}));
+    EXPECT_TRUE(sl.contains({1, 0}));
+    EXPECT_TRUE(sl.isUp({2, 0}));
+    EXPECT_EQ(3lu, tr.changes.size());
+    EXPECT_EQ(ServerChangeEvent::SERVER_CRASHED, tr.changes.back().event);
+}
+
 TEST_F(ServerListTest, applyServerList_success) {
     // Apply Full List
     ProtoBuf::ServerList wholeList;
@@ -18,18 +18,26 @@
  * This file provides the main program for RAMCloud storage servers.
  */
 
+#include <memory>
+#include <vector>
+
 #include "Context.h"
 #include "CoordinatorSession.h"
+#include "DispatchShard.h"
 #if INFINIBAND
 #include "InfRcTransport.h"
+#include "LargeBlockOfMemory.h"
 #endif
 #include "MemoryMonitor.h"
 #include "OptionParser.h"
 #include "PortAlarm.h"
 #include "Server.h"
 #include "PerfStats.h"
+#include "RpcCacheStats.h"
 #include "ShortMacros.h"
+#include "TimeTrace.h"
 #include "TransportManager.h"
+#include "WorkerManager.h"
 #include "WorkerTimer.h"
 
 using namespace RAMCloud;
@@ -99,9 +107,18 @@ main(int argc, char *argv[])
     try {
         ServerConfig config = ServerConfig::forExecution();
         string masterTotalMemory, hashTableMemory;
+        uint64_t maxHashTableMegabytes;
+        uint64_t flashTierMegabytes;
+        string hugePages;
+        string tenantWeights;
+        string timeTraceFile;
 
         bool masterOnly;
         bool backupOnly;
+        uint32_t dispatchShards;
+        uint32_t dispatchSpinMicros;
+        uint32_t dispatchActivitySampling;
+        uint32_t rpcCacheSampling;
 
         OptionsDescription serverOptions("Server");
         serverOptions.add_options()
@@ -114,6 +131,37 @@ main(int argc, char *argv[])
             ("backupOnly,B",
              ProgramOptions::bool_switch(&backupOnly),
              "The server should run the backup service only (no master)")
+            ("backupPmem",
+             ProgramOptions::bool_switch(&config.backup.pmem),
+             "The backup file is on persistent memory (e.g. a DAX "
+             "filesystem); store replicas by mapping it rather than "
+             "through block IO")
+            ("backupRemoteWrites",
+             ProgramOptions::bool_switch(&config.backup.remoteWrites),
+             "With --backupInMemory, allocate all replica memory at startup "
+             "and register it with the transports, so that masters may "
+             "write replica data into it with RDMA writes rather than "
+             "sending it in rpcs")
+            ("backupRecoveryThreads",
+             ProgramOptions::value<uint32_t>(
+                &config.backup.recoveryBuildThreads)->default_value(1),
+             "Number of threads that build recovery segments from primary "
+             "replicas in parallel during a master recovery.")
+            ("backupRecoveryDedup",
+             ProgramOptions::bool_switch(&config.backup.recoveryDedup),
+             "Leave objects and tombstones that are superseded within the "
+             "same replica out of the recovery segments built from it.")
+            ("backupCompressReplicas",
+             ProgramOptions::bool_switch(&config.backup.compressReplicas),
+             "Compress closed replicas before writing them to backup storage "
+             "(and expand them during recovery), trading CPU for disk "
+             "bandwidth. Replicas opened with --sync are never compressed.")
+            ("backupWriteBackStaging",
+             ProgramOptions::bool_switch(&config.backup.writeBackStaging),
+             "Acknowledge replica writes once they are buffered in memory and "
+             "flush closed replicas to disk in the background. Only safe if "
+             "the backup's memory survives power failures (battery, UPS or "
+             "NVDIMMs).")
             ("backupStrategy",
              ProgramOptions::value<int>(&config.backup.strategy)->
                default_value(RANDOM_REFINE_AVG),
@@ -132,9 +180,54 @@ main(int argc, char *argv[])
              "Which balancing algorithm to use to schedule cleaning on disk "
              "and in-memory compaction, as well as how to orchestrate multiple "
              "cleaner threads. You will almost certainly want to use the "
-             "default value. Currently the only other option is \"fixed:X\", "
-             "where 0 <= X <= 100 represents the percentage of CPU time the "
-             "disk cleaner will be limited to (the rest is for compaction).")
+             "default value. The other options are \"fixed:X\", where "
+             "0 <= X <= 100 represents the percentage of CPU time the disk "
+             "cleaner will be limited to (the rest is for compaction), and "
+             "\"adaptive:X\", which starts out like \"tombstoneRatio:X\" "
+             "but adjusts the ratio and the number of active cleaner threads "
+             "to the observed write rate, write costs, and idle worker cores.")
+            ("combineIncrements",
+             ProgramOptions::bool_switch(&config.master.combineIncrements),
+             "Combine unconditional increments of the same object by "
+             "concurrent clients into a single write, so that a hot counter "
+             "gets one new version in the log per batch of increments.")
+            ("compactObjectHeaders",
+             ProgramOptions::bool_switch(
+                &config.master.compactObjectHeaders),
+             "Store objects in small tables with 16-byte rather than 24-byte "
+             "headers in the log. Any master can read either kind, so this "
+             "may differ from one master to the next.")
+            ("deferObjectChecksums",
+             ProgramOptions::bool_switch(
+                &config.master.deferObjectChecksums),
+             "Write objects to the log without per-object checksums, and "
+             "instead checksum the contents of each segment when it is "
+             "closed. Saves a CRC per write, but objects in the open head "
+             "segment are not protected until it is closed.")
+            ("dispatchShards",
+             ProgramOptions::value<uint32_t>(&dispatchShards)->
+                default_value(0),
+             "Number of extra dispatch threads to run the listening "
+             "transports on; each one takes a core on top of maxCores. The "
+             "kernel spreads clients among them via SO_REUSEPORT, so this "
+             "only works for the basic+udp and tcp transports. 0 means the "
+             "main dispatch thread handles all network traffic.")
+            ("dispatchActivitySampling",
+             ProgramOptions::value<uint32_t>(&dispatchActivitySampling)->
+                default_value(64),
+             "The dispatch thread's activity profiler times one out of "
+             "this many iterations of its polling loop, so that the "
+             "GET_DISPATCH_ACTIVITY server control can report where the "
+             "dispatch thread's time goes. 0 turns the profiler off.")
+            ("dispatchSpinMicros",
+             ProgramOptions::value<uint32_t>(&dispatchSpinMicros)->
+                default_value(0),
+             "If non-0, the dispatch thread stops polling after finding no "
+             "work for this many microseconds and sleeps until a request "
+             "arrives, which frees its core on idle servers. Only the tcp "
+             "transport can wake it up, so this has no effect with the "
+             "other transports. 0 means the dispatch thread always polls, "
+             "which gives the lowest latency.")
             ("detectFailures",
              ProgramOptions::value<bool>(&config.detectFailures)->
                 default_value(true),
@@ -166,12 +259,116 @@ main(int argc, char *argv[])
                 default_value("10%"),
              "Percentage or megabytes of master memory allocated to "
              "the hash table")
+            ("maxHashTableMemory",
+             ProgramOptions::value<uint64_t>(&maxHashTableMegabytes)->
+                default_value(0),
+             "Megabytes the hash table may grow to as objects are added. "
+             "The table starts out at the size given by hashTableMemory and "
+             "doubles online when it gets too full. 0 (or any value no larger "
+             "than the initial size) disables growth.")
+            ("hotKeyReplicas",
+             ProgramOptions::value<uint32_t>(
+                &config.master.hotKeyReplicas)->default_value(0),
+             "If non-0, objects this master finds to be very frequently read "
+             "are replicated on this many other masters, which serve reads "
+             "of them to clients that opt in with "
+             "RamCloud::enableReplicaReads. Replicas may lag the master by "
+             "up to a lease period. 0 means hot objects aren't replicated.")
+            ("hotKeySampleInterval",
+             ProgramOptions::value<uint32_t>(
+                &config.master.hotKeySampleInterval)->default_value(64),
+             "One out of this many reads and writes on each worker thread "
+             "is fed into a sketch that tracks this master's most "
+             "frequently accessed keys. The coordinator's tablet balancer "
+             "and --hotKeyReplicas use it, and it can be fetched with the "
+             "GET_HOT_KEYS server control. 0 disables the sketch.")
+            ("hugePages",
+             ProgramOptions::value<string>(&hugePages)->
+                default_value("none"),
+             "Kind of pages to back the log and hash table with: \"none\", "
+             "\"transparent\" (transparent huge pages), \"2mb\" or \"1gb\" "
+             "(hugetlb pages, which must be reserved beforehand). If the "
+             "requested kind can't be had, each smaller kind is tried in "
+             "turn; the kind obtained is logged.")
+            ("inMemoryIndexlets",
+             ProgramOptions::bool_switch(&config.master.inMemoryIndexlets),
+             "Keep indexlets in in-memory trees, persisting each index entry "
+             "as a small object, instead of storing tree nodes as objects. "
+             "Speeds up index lookups and updates. Must be set the same way "
+             "on all servers.")
+            ("inlineSmallValues",
+             ProgramOptions::bool_switch(&config.master.inlineSmallValues),
+             "Keep a copy of a small object (value of at most 8 bytes, such "
+             "as a counter) next to each hash table bucket, so that reads of "
+             "it don't touch the log. Doubles the memory used by the hash "
+             "table.")
+            ("ioQueueDepth",
+             ProgramOptions::value<uint32_t>(
+                &config.backup.ioQueueDepth)->default_value(1),
+             "Number of replicas whose backup storage IO may be outstanding "
+             "at once. Each replica's IO is striped across all backup files; "
+             "larger values overlap the IO of several replicas, which speeds "
+             "up loading replicas during recovery.")
+            ("ioUring",
+             ProgramOptions::bool_switch(&config.backup.useIoUring),
+             "Issue backup storage IO through io_uring instead of POSIX "
+             "aio (falls back to aio if the kernel lacks io_uring).")
             ("logCleanerThreads",
              ProgramOptions::value<uint32_t>(
                 &config.master.cleanerThreadCount)->default_value(1),
              "The number of cleaner threads controls the amount of parallelism "
              "in the cleaner. More threads will use more cores, but may be "
              "able to better keep up with high write rates.")
+            ("logCleanerColdDataAge",
+             ProgramOptions::value<uint32_t>(
+                &config.master.cleanerColdDataAge)->default_value(0),
+             "Age in seconds at which the disk cleaner considers live data "
+             "cold and writes it to different survivor segments than "
+             "younger data. 0 disables hot/cold segregation.")
+            ("logCleanerLargeEntrySize",
+             ProgramOptions::value<uint32_t>(
+                &config.master.cleanerLargeEntryBytes)->default_value(0),
+             "Size in bytes at which the disk cleaner writes live entries "
+             "(such as large blobs) to different survivor segments than "
+             "smaller ones. 0 disables size segregation.")
+            ("logCleanerCopyOnBackups",
+             ProgramOptions::bool_switch(
+                &config.master.cleanerCopyOnBackups),
+             "Have backups build replicas of the disk cleaner's survivor "
+             "segments by copying live entries out of their replicas of the "
+             "segments being cleaned, instead of sending them over the "
+             "network again.")
+            ("flashTierFile",
+             ProgramOptions::value<string>(
+                &config.master.flashTierFile)->default_value(""),
+             "File or block device on local flash that the disk cleaner "
+             "moves survivor segments of cold objects to (see "
+             "logCleanerColdDataAge), so that they no longer take up "
+             "memory. Empty keeps all data in memory.")
+            ("flashTierSize",
+             ProgramOptions::value<uint64_t>(&flashTierMegabytes)->
+                default_value(0),
+             "Megabytes of flashTierFile to use.")
+            ("numaNodes",
+             ProgramOptions::value<uint32_t>(
+                &config.master.numaNodes)->default_value(1),
+             "Number of NUMA nodes to split the master's log memory across. "
+             "Each node's share of the log is bound to that node, and new "
+             "segments come from the node of the thread allocating them. "
+             "1 disables NUMA placement.")
+            ("omitSameSegmentTombstones",
+             ProgramOptions::bool_switch(
+                &config.master.omitSameSegmentTombstones),
+             "Don't write a tombstone when an object is overwritten and its "
+             "previous version is in the same log segment as the new one. "
+             "Saves log space and cleaning for workloads that overwrite "
+             "objects with long keys frequently.")
+            ("remoteReadSlots",
+             ProgramOptions::value<uint32_t>(
+                &config.master.remoteReadSlots)->default_value(0),
+             "Number of slots in the table that lets clients read objects "
+             "with one-sided RDMA reads (InfRcTransport only). Each slot "
+             "locates one recently read object. 0 disables remote reads.")
             ("masterOnly,M",
              ProgramOptions::bool_switch(&masterOnly),
              "The server should run the master service only (no backup)")
@@ -191,15 +388,111 @@ main(int argc, char *argv[])
              "value 0 is special: it tells the server to set the "
              "limit equal to the \"segmentFrames\" value, effectively making "
              "buffering unlimited.")
+            ("migrationReplayThreads",
+             ProgramOptions::value<uint32_t>(
+                &config.master.migrationReplayThreads)->default_value(1),
+             "Number of threads a master uses to replay each segment of data "
+             "it receives when a tablet is migrated to it.")
+            ("migrationSegmentsInFlight",
+             ProgramOptions::value<uint32_t>(
+                &config.master.migrationSegmentsInFlight)->default_value(4),
+             "Maximum number of segments of data a master sends to the "
+             "receiving master at once when migrating a tablet. The receiver "
+             "replays each one on a different worker thread.")
+            ("migrationThreads",
+             ProgramOptions::value<uint32_t>(
+                &config.master.migrationThreads)->default_value(1),
+             "Number of threads a master uses to scan its log for the "
+             "objects of a tablet it is migrating to another master.")
             ("preferredIndex",
              ProgramOptions::value<uint32_t>(
                 &config.preferredIndex)->default_value(0),
              "Use this value as the index number for this server's server id, "
              "if that number isn't already in use. Can be used to ensure "
              "a reproducible assignment of server ids.")
+            ("recoveryReplayThreads",
+             ProgramOptions::value<uint32_t>(
+                &config.master.recoveryReplayThreads)->default_value(1),
+             "Number of threads a recovery master uses to replay recovery "
+             "segments. Each thread replays the objects of its own range of "
+             "hash table buckets into its own side log.")
+            ("onDemandRecovery",
+             ProgramOptions::bool_switch(&config.master.onDemandRecovery),
+             "While recovering a partition, serve reads of keys that have "
+             "already been replayed, and replay the segments that may hold "
+             "other requested keys first, asking clients to retry until "
+             "they are. The coordinator must be started with "
+             "--onDemandRecovery too, so that clients find recovery masters.")
+            ("replicationWriteBatchSegments",
+             ProgramOptions::value<uint32_t>(
+                &config.master.replicationWriteBatchSegments)->
+                    default_value(1),
+             "Maximum number of replica writes to the same backup that are "
+             "combined into a single rpc. Writes wait at most one pass over "
+             "the pending replication work to be combined. 1 disables "
+             "batching.")
+            ("replicationCleanerRateLimit",
+             ProgramOptions::value<uint32_t>(
+                &config.master.replicationCleanerRateLimit)->
+                    default_value(0),
+             "If non-0, the maximum number of megabytes per second this "
+             "master sends to backups to replicate the disk cleaner's "
+             "survivor segments, so that cleaning doesn't take bandwidth "
+             "away from writes to the log head. 0 disables the limit.")
+            ("replicationChain",
+             ProgramOptions::bool_switch(&config.master.replicationChain),
+             "Send each write to the backup of a segment's first replica "
+             "only, which passes it on to the backups of the other replicas, "
+             "so that this master's network link carries one copy of the "
+             "data rather than one per replica. Replicas that fall behind, "
+             "such as replacements for replicas lost in a backup crash, are "
+             "written directly until they catch up.")
+            ("replicationRemoteWrites",
+             ProgramOptions::bool_switch(
+                &config.master.replicationRemoteWrites),
+             "Place replica data directly in the memory of backups that "
+             "allow it (see --backupRemoteWrites) with RDMA writes, and "
+             "send them only a small rpc saying where it is. Other backups "
+             "and transports without RDMA are written as usual.")
+            ("erasureCodeDataFragments",
+             ProgramOptions::value<uint32_t>(
+                &config.master.erasureCodeDataFragments)->default_value(0),
+             "If non-0, store each closed segment as this many Reed-Solomon "
+             "data fragments plus --erasureCodeParityFragments parity "
+             "fragments, each on a different backup, instead of as "
+             "--replicas full copies. Segments written by the log cleaner "
+             "are encoded as soon as they are closed; the log head is "
+             "replicated in full while it is open, and once closed its "
+             "backups turn their replicas into fragments. Recovery "
+             "rebuilds a segment from any of its fragments that number "
+             "this many. With --useMinCopysets, the coordinator's "
+             "--replicationGroupSize must be at least the number of "
+             "fragments. 0 disables erasure coding.")
+            ("erasureCodeParityFragments",
+             ProgramOptions::value<uint32_t>(
+                &config.master.erasureCodeParityFragments)->
+                    default_value(2),
+             "Number of Reed-Solomon parity fragments given to each closed "
+             "segment when --erasureCodeDataFragments is non-0; this many "
+             "of a segment's fragments may be lost without losing it.")
+            ("writeAdmissionUtilization",
+             ProgramOptions::value<uint32_t>(
+                &config.master.writeAdmissionUtilization)->default_value(0),
+             "If non-0, the percentage of log memory in use at which this "
+             "master starts to pace writes to the rate at which the cleaner "
+             "frees memory, by asking clients to retry after a delay. 0 "
+             "lets writes go ahead until the log is full.")
             ("replicas,r",
              ProgramOptions::value<uint32_t>(&config.master.numReplicas),
              "Number of backup copies to make for each segment")
+            ("rpcCacheSampling",
+             ProgramOptions::value<uint32_t>(&rpcCacheSampling)->
+                default_value(64),
+             "Each worker thread reads the hardware performance counters "
+             "around one out of this many requests, so that the "
+             "GET_RPC_CACHE_STATS server control can report the cache "
+             "misses and remote-NUMA accesses of each kind of request. "
+             "0 turns sampling off.")
             ("segmentFrames",
              ProgramOptions::value<uint32_t>(&config.backup.numSegmentFrames)->
                 default_value(512),
@@ -209,10 +502,34 @@ main(int argc, char *argv[])
              "2NR/8M (gives the backup 2NR bytes of space); any value lower "
              "than this may cause the cluster to eventually fail to service "
              "write requests.")
+            ("snapshotRetentionMs",
+             ProgramOptions::value<uint32_t>(
+                &config.master.snapshotRetentionMs)->default_value(0),
+             "If non-0, keep the versions of objects that are overwritten or "
+             "removed for this many milliseconds, so that transactions "
+             "started with snapshot isolation can read a consistent snapshot "
+             "of the past and only abort on write-write conflicts. The "
+             "cleaner keeps these versions in the log until they expire. 0 "
+             "keeps no old versions.")
             ("sync",
              ProgramOptions::bool_switch(&config.backup.sync),
              "Make all updates completely synchronous all the way down to "
              "stable storage.")
+            ("tableQuotaPercent",
+             ProgramOptions::value<uint32_t>(
+                &config.master.tableQuotaPercent)->default_value(0),
+             "If non-0, the most log memory (a percentage) that any one table "
+             "may take up, counting versions the cleaner hasn't reclaimed "
+             "yet. Writes past it are retried once the cleaner is running, "
+             "so one table can't stall writes to all others. 0 disables "
+             "table quotas.")
+            ("timeTraceFile",
+             ProgramOptions::value<string>(&timeTraceFile)->
+                default_value(""),
+             "If non-empty, continuously append the time trace of all "
+             "threads to this file in binary form (print it with "
+             "scripts/ttdecode.py), so that latency spikes can be analyzed "
+             "after the fact. Empty keeps the trace in memory only.")
             ("totalMasterMemory,t",
 
              // Note: we have tried changing the default value below to
@@ -229,6 +546,65 @@ main(int argc, char *argv[])
              ProgramOptions::value<bool>(&config.master.useMinCopysets)->
                 default_value(false),
              "Whether to use MinCopysets or random replication")
+            ("valueCompressionThreshold",
+             ProgramOptions::value<uint32_t>(
+                &config.master.valueCompressionThreshold)->default_value(0),
+             "Values at least this many bytes long are compressed with zlib "
+             "before they are written to the log, if that makes them "
+             "smaller. Trades CPU on writes and reads for memory. 0 "
+             "disables compression.")
+            ("workerBurstCores",
+             ProgramOptions::value<int>(&WorkerManager::burstCores)->
+                default_value(0),
+             "How many worker threads beyond maxCores may run requests "
+             "that have waited more than workerSloMicros, to absorb load "
+             "spikes. 0 disables bursting.")
+            ("workerInlineNanos",
+             ProgramOptions::value<int>(&WorkerManager::inlineNanos)->
+                default_value(0),
+             "Most time (in nanoseconds) the dispatch thread may spend per "
+             "polling pass executing short requests such as small reads "
+             "itself, instead of handing them to worker threads. 0 always "
+             "uses worker threads.")
+            ("workerMaxQueue",
+             ProgramOptions::value<int>(&WorkerManager::maxQueuedRpcs)->
+                default_value(0),
+             "Most master requests that may be waiting for a worker "
+             "thread; beyond that new ones are rejected with a retry "
+             "delay scaled to the queue length, so clients back off. 0 "
+             "queues requests without limit.")
+            ("workerMaxDeferMicros",
+             ProgramOptions::value<int>(&WorkerManager::maxDeferMicros)->
+                default_value(1000),
+             "Longest time (in microseconds) a queued request that is "
+             "expected to be slow may be passed by shorter requests that "
+             "arrived after it. 0 serves queued requests in arrival order.")
+            ("workerSloMicros",
+             ProgramOptions::value<int>(&WorkerManager::sloMicros)->
+                default_value(100),
+             "Queued requests that have waited this many microseconds may "
+             "run on one of the workerBurstCores extra threads.")
+            ("workerTenantQuantumMicros",
+             ProgramOptions::value<int>(
+                &WorkerManager::tenantQuantumMicros)->default_value(0),
+             "Share the worker threads among tables by deficit round robin "
+             "once requests have to queue: each turn, a table may start "
+             "requests expected to take this many microseconds (times its "
+             "weight in workerTenantWeights). 0 queues requests without "
+             "regard to their tables.")
+            ("workerTenantWeights",
+             ProgramOptions::value<string>(&tenantWeights)->
+                default_value(""),
+             "Comma-separated tableId:weight pairs giving tables a larger "
+             "share of the workers under workerTenantQuantumMicros, e.g. "
+             "\"5:4,7:2\". Other tables have weight 1.")
+            ("workerSpinMicros",
+             ProgramOptions::value<int>(&WorkerManager::pollMicros)->
+                default_value(10000),
+             "How many microseconds an idle worker thread polls for a new "
+             "RPC before it goes to sleep. Smaller values save CPU on "
+             "lightly loaded servers; larger values avoid wakeup delays "
+             "for bursty workloads.")
             ("writeCostThreshold,w",
              ProgramOptions::value<uint32_t>(
                 &config.master.cleanerWriteCostThreshold)->default_value(8),
@@ -252,6 +628,11 @@ main(int argc, char *argv[])
         LOG(NOTICE, "Server process id: %u", getpid());
 
         Context context(true, &optionParser.options);
+        context.dispatch->setIdleSpinTime(dispatchSpinMicros);
+        context.dispatch->startActivityProfiler(dispatchActivitySampling);
+        RpcCacheStats::setSampleInterval(rpcCacheSampling);
+        if (!timeTraceFile.empty())
+            TimeTrace::startRecording(timeTraceFile.c_str());
 
         if (masterOnly && backupOnly)
             DIE("Can't specify both -B and -M options");
@@ -275,7 +656,20 @@ main(int argc, char *argv[])
 #endif
         context.transportManager->setSessionTimeout(
                 optionParser.options.getSessionTimeout());
-        context.transportManager->initialize(localLocator.c_str());
+        std::vector<std::unique_ptr<DispatchShard>> shards;
+        if (dispatchShards > 0) {
+            // The shards pass requests to the WorkerManager from the start.
+            context.workerManager = new WorkerManager(&context,
+                                                      config.maxCores - 1);
+            for (uint32_t i = 0; i < dispatchShards; i++) {
+                shards.emplace_back(new DispatchShard(&context,
+                                                      localLocator));
+            }
+            context.transportManager->setListeningLocators(
+                    shards[0]->getListeningLocatorsString());
+        } else {
+            context.transportManager->initialize(localLocator.c_str());
+        }
         // Transports may augment the local locator somewhat.
         // Make sure the server is aware of that augmented locator.
         config.localLocator =
@@ -320,9 +714,23 @@ main(int argc, char *argv[])
         // Re-parse the options to override coordinator provided defaults.
         OptionParser optionReparser(serverOptions, argc, argv);
 
+        if (!LargeBlockOfMemoryInternal::parsePageSize(hugePages,
+                &LargeBlockOfMemoryInternal::requestedPageSize)) {
+            throw Exception(HERE,
+                    format("Unknown hugePages value: %s", hugePages.c_str()));
+        }
+        if (!WorkerManager::parseTenantWeights(tenantWeights,
+                &WorkerManager::tenantWeights)) {
+            throw Exception(HERE, format("Bad workerTenantWeights value: %s",
+                    tenantWeights.c_str()));
+        }
+
         if (!backupOnly) {
             LOG(NOTICE, "Using %u backups", config.master.numReplicas);
             config.setLogAndHashTableSize(masterTotalMemory, hashTableMemory);
+            config.master.maxHashTableBytes =
+                    maxHashTableMegabytes * 1024 * 1024;
+            config.master.flashTierBytes = flashTierMegabytes * 1024 * 1024;
         }
 
         // Set PortTimeout and start portTimer
@@ -20,27 +20,22 @@
 #include "Dispatch.h"
 #include "ObjectPool.h"
 #include "Transport.h"
-#include "LogProtector.h"
 
 namespace RAMCloud {
 
 /**
  * ServerRpcPool is a fast allocator for Transport-specific subclasses
- * of ServerRpc. It also automatically tracks outstanding ServerRpcs
- * in the system by epoch, enabling other parts of the system to query
- * if RPCs less than or equal to a given epoch are still present. This
- * can be used, for example, to ensure that its safe to reclaim zero-
- * copy buffers.
+ * of ServerRpc. (The epochs of outstanding ServerRpcs are tracked by their
+ * LogProtector::Pins, wherever the RPCs were allocated.)
  */
 template<typename T = Transport::ServerRpc>
-class ServerRpcPool : public LogProtector::EpochProvider {
+class ServerRpcPool {
   public:
     /**
      * Construct a new ServerRpcPool.
      */
     ServerRpcPool()
-        : outstandingServerRpcs(),
-          pool(),
+        : pool(),
           outstandingAllocations(0)
     {
     }
@@ -64,7 +59,6 @@ class ServerRpcPool : public LogProtector::EpochProvider {
     construct(Args&&... args)
     {
         T* rpc = pool.construct(static_cast<Args&&>(args)...);
-        outstandingServerRpcs.push_back(*rpc);
         outstandingAllocations++;
         return rpc;
     }
@@ -76,40 +70,11 @@ class ServerRpcPool : public LogProtector::EpochProvider {
     void
     destroy(T* const rpc)
     {
-        outstandingServerRpcs.erase(outstandingServerRpcs.iterator_to(*rpc));
         outstandingAllocations--;
         pool.destroy(rpc);
     }
 
-    // See LogProtector::EpochProvider for documentation.
-    // Caller must hold dispatch lock.
-    uint64_t
-    getEarliestEpoch(int activityMask)
-    {
-        uint64_t earliest = -1;
-
-        ServerRpcList::iterator it = outstandingServerRpcs.begin();
-        while (it != outstandingServerRpcs.end()) {
-            if (((it->activities & activityMask) != 0) & (it->epoch != 0)) {
-                earliest = std::min(it->epoch, earliest);
-            }
-            it++;
-        }
-
-        return earliest;
-    }
-
   PRIVATE:
-    INTRUSIVE_LIST_TYPEDEF(Transport::ServerRpc, outstandingRpcListHook)
-        ServerRpcList;
-
-    // List of ServerRpcs that are being processed. RPCs are added to the
-    // list when allocated in ServerRpcPool::construct and are removed
-    // when they are destroyed in ServerRpcPool::destroy. This list may
-    // be walked to check whether a given epoch is still represented by
-    // any outstanding RPC in this pool.
-    ServerRpcList outstandingServerRpcs;
-
     /// Pool allocator backing the actual ServerRpc classes this class returns.
     ObjectPool<T> pool;
 
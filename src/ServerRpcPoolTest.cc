@@ -50,7 +50,6 @@ TEST(ServerRpcPoolTest, construct) {
     ServerRpcPool<TestServerRpc> pool;
 
     TestServerRpc* rpc = pool.construct();
-    EXPECT_EQ(true, rpc->outstandingRpcListHook.is_linked());
     EXPECT_EQ(1U, pool.outstandingAllocations);
 
     pool.destroy(rpc);
@@ -61,42 +60,12 @@ TEST(ServerRpcPoolTest, destroy) {
     ServerRpcPool<TestServerRpc> pool;
 
     TestServerRpc* rpc = pool.construct();
+    rpc->logProtectorPin.acquire();
     pool.destroy(rpc);
     EXPECT_EQ(0U, pool.outstandingAllocations);
-    EXPECT_EQ(-1UL, pool.getEarliestEpoch(~0));
-}
-
-TEST(ServerRpcPoolTest, getEarliestEpoch_basics) {
-    Context context;
-
-    LogProtector::currentSystemEpoch = 57;
-    ServerRpcPool<TestServerRpc> pool;
-    TestServerRpc* rpc = pool.construct();
-    EXPECT_EQ(-1UL, pool.getEarliestEpoch(~0));
-    rpc->epoch = 57;
-    EXPECT_EQ(57UL, pool.getEarliestEpoch(~0));
-    pool.destroy(rpc);
-
-    EXPECT_EQ(-1UL, pool.getEarliestEpoch(~0));
-}
-
-TEST(ServerRpcPoolTest, getEarliestEpoch_activityMask) {
-    Context context;
 
-    ServerRpcPool<TestServerRpc> pool;
-    TestServerRpc* rpc1 = pool.construct();
-    rpc1->epoch = 44;
-    TestServerRpc* rpc2 = pool.construct();
-    rpc2->epoch = 6;
-    TestServerRpc* rpc3 = pool.construct();
-    rpc3->epoch = 19;
-    EXPECT_EQ(6UL, pool.getEarliestEpoch(~0));
-    rpc2->activities = Transport::ServerRpc::READ_ACTIVITY;
-    EXPECT_EQ(19UL, pool.getEarliestEpoch(
-                            Transport::ServerRpc::APPEND_ACTIVITY));
-    pool.destroy(rpc1);
-    pool.destroy(rpc2);
-    pool.destroy(rpc3);
+    // Destroying an RPC releases its pin.
+    EXPECT_EQ(-1UL, LogProtector::getEarliestOutstandingEpoch(~0));
 }
 
 TEST(ServerRpcPoolGuardTest, generic) {
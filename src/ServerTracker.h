@@ -21,6 +21,7 @@
 #ifndef RAMCLOUD_SERVERTRACKER_H
 #define RAMCLOUD_SERVERTRACKER_H
 
+#include <atomic>
 #include <queue>
 
 #include "Common.h"
@@ -136,6 +137,7 @@ class ServerTracker : public ServerTrackerInterface {
         , parent(NULL)
         , serverList()
         , changes()
+        , changesPending(false)
         , lastRemovedIndex(-1)
         , eventCallback()
         , numberOfServers(0)
@@ -167,6 +169,7 @@ class ServerTracker : public ServerTrackerInterface {
         , parent(NULL)
         , serverList()
         , changes()
+        , changesPending(false)
         , lastRemovedIndex(-1)
         , eventCallback(eventCallback)
         , numberOfServers(0)
@@ -205,6 +208,7 @@ class ServerTracker : public ServerTrackerInterface {
                (event == SERVER_REMOVED &&
                 server.status == ServerStatus::REMOVE));
         changes.push(ServerChange(server, event));
+        changesPending = true;
     }
 
     /**
@@ -226,12 +230,12 @@ class ServerTracker : public ServerTrackerInterface {
     /**
      * Returns true if there are any outstanding list changes that the client
      * of this tracker may want to be aware of. Otherwise returns false.
+     * This doesn't acquire the lock, so it is cheap to poll.
      */
     bool
     hasChanges()
     {
-        SpinLock::Guard lock(mutex);
-        return !changes.empty();
+        return changesPending.load();
     }
 
     /**
@@ -318,8 +322,10 @@ class ServerTracker : public ServerTrackerInterface {
         // required only if there are remove events that we discard without
         // returning.
         while (1) {
-            if (changes.empty())
+            if (changes.empty()) {
+                changesPending = false;
                 return false;
+            }
 
             ServerChange* change = &changes.front();
             uint32_t index = change->server.serverId.indexNumber();
@@ -384,6 +390,7 @@ class ServerTracker : public ServerTrackerInterface {
                 RAMCLOUD_DIE("Unknown event type %d", static_cast<int>(event));
             }
             server = slot->server;
+            changesPending = !changes.empty();
             return true;
 
           error:
@@ -672,6 +679,10 @@ class ServerTracker : public ServerTrackerInterface {
     /// Queue of list membership changes.
     std::queue<ServerChange> changes;
 
+    /// Whether #changes is non-empty, for hasChanges() to read without
+    /// acquiring #mutex. Updated with #mutex held.
+    std::atomic<bool> changesPending;
+
     /// Previous change index. This is set when a SERVER_REMOVE event is pulled
     /// via #getChange(). On the next #getChange() invocation, we check to see
     /// if the user has NULLed out the pointer for that index and remove the
@@ -224,7 +224,7 @@ class DummyService : public Service {
 };
 
 TEST_F(ServiceTest, checkServerId) {
-    request.fillFromString("9 1 2");
+    request.fillFromString("9 0 0 1 2");
     DummyService service;
 
     // First try: service's id is invalid, so mismatch should be ignored.
@@ -264,7 +264,7 @@ TEST_F(ServiceTest, checkServerId) {
     // Fourth try: serverId in RPC is invalid, so mismatch should be ignored.
     response.reset();
     request.reset();
-    request.fillFromString("9 0 -1");
+    request.fillFromString("9 0 0 0 -1");
     message = "no exception";
     try {
         service.callHandler<DummyService::Rpc1, DummyService,
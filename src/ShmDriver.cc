@@ -0,0 +1,382 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Common.h"
+#include "ShmDriver.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+std::atomic<uint32_t> ShmDriver::nextClientId(0);
+
+/**
+ * Construct a ShmDriver, creating its receive region.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server or client.
+ * \param localServiceLocator
+ *      Specifies the name of the driver's region ("name" option), which
+ *      senders use to reach it. NULL means this is a client driver; it gets
+ *      a name that is unique on this machine.
+ *
+ * \throw DriverException
+ *      The region couldn't be created.
+ */
+ShmDriver::ShmDriver(Context* context,
+        const ServiceLocator* localServiceLocator)
+    : context(context)
+    , name()
+    , locatorString()
+    , region(NULL)
+    , nextChannel(0)
+    , packetBufPool()
+    , mutex("ShmDriver")
+    , peers()
+    , peersMutex("ShmDriver::peers")
+{
+    if (localServiceLocator != NULL) {
+        name = localServiceLocator->getOption<string>("name");
+    } else {
+        name = format("client-%d-%u", getpid(), nextClientId++);
+    }
+    if (name.empty() || name.size() >= MAX_NAME_LENGTH ||
+            name.find('/') != string::npos) {
+        throw DriverException(HERE,
+                format("ShmDriver name '%s' is invalid", name.c_str()));
+    }
+
+    // A region left behind by a process that crashed would never be read;
+    // replace it.
+    shm_unlink(regionName(name).c_str());
+    region = mapRegion(name, O_RDWR | O_CREAT | O_EXCL);
+    region->magic.store(REGION_MAGIC, std::memory_order_release);
+
+    locatorString = "shm:name=" + name;
+    LOG(NOTICE, "Locator for ShmDriver: %s", locatorString.c_str());
+}
+
+/**
+ * Destroy a ShmDriver. Its region is removed; senders notice and stop
+ * writing to it.
+ */
+ShmDriver::~ShmDriver()
+{
+    peers.clear();
+    region->closed.store(1, std::memory_order_release);
+    munmap(region, sizeof(Region));
+    shm_unlink(regionName(name).c_str());
+}
+
+// See docs in Driver class.
+uint32_t
+ShmDriver::getBandwidth()
+{
+    // Memory copies are much faster than any network; this just keeps
+    // BasicTransport from being throttled by a network-sized estimate.
+    return 100000;
+}
+
+// See docs in Driver class.
+uint32_t
+ShmDriver::getMaxPacketSize()
+{
+    return MAX_PAYLOAD_SIZE;
+}
+
+/**
+ * Return an address for a ShmDriver on this machine. The driver's region
+ * is mapped (again) here, so that a session opened to a restarted server
+ * doesn't use the previous instance's region.
+ *
+ * \param serviceLocator
+ *      Specifies the driver's name ("name" option).
+ *
+ * \throw DriverException
+ *      There is no such driver on this machine.
+ */
+Driver::Address*
+ShmDriver::newAddress(const ServiceLocator* serviceLocator)
+{
+    ShmAddress* address =
+            new ShmAddress(serviceLocator->getOption<string>("name"));
+    try {
+        address->peer = std::make_shared<Peer>(address->name, name);
+    } catch (...) {
+        delete address;
+        throw;
+    }
+    SpinLock::Guard _(peersMutex);
+    peers[address->name] = address->peer;
+    return address;
+}
+
+// See docs in Driver class.
+void
+ShmDriver::receivePackets(uint32_t maxPackets,
+            std::vector<Received>* receivedPackets)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < CHANNELS && count < maxPackets; i++) {
+        Channel* channel = &region->channels[(nextChannel + i) % CHANNELS];
+        uint64_t tail = channel->tail.load(std::memory_order_relaxed);
+        uint64_t head = channel->head.load(std::memory_order_acquire);
+        for (; tail < head && count < maxPackets; tail++, count++) {
+            Slot* slot = &channel->slots[tail % RING_SLOTS];
+            uint32_t length = slot->length;
+            if (length > MAX_PAYLOAD_SIZE) {
+                // Only a misbehaving sender could do this.
+                length = MAX_PAYLOAD_SIZE;
+            }
+            PacketBuf* buffer;
+            {
+                SpinLock::Guard _(mutex);
+                buffer = packetBufPool.construct();
+            }
+            memcpy(buffer->payload, slot->data, length);
+            buffer->sender.construct(string(channel->ownerName,
+                    strnlen(channel->ownerName, MAX_NAME_LENGTH)));
+            receivedPackets->emplace_back(buffer->sender.get(), this,
+                    length, buffer->payload);
+        }
+        channel->tail.store(tail, std::memory_order_release);
+    }
+    nextChannel = (nextChannel + 1) % CHANNELS;
+}
+
+// See docs in Driver class.
+void
+ShmDriver::release(char *payload)
+{
+    SpinLock::Guard guard(mutex);
+
+    // Note: the payload is actually contained in a PacketBuf structure,
+    // which we return to a pool for reuse later.
+    packetBufPool.destroy(
+        reinterpret_cast<PacketBuf*>(payload - OFFSET_OF(PacketBuf, payload)));
+}
+
+// See docs in Driver class.
+void
+ShmDriver::sendPacket(const Address* addr,
+                      const void* header,
+                      uint32_t headerLen,
+                      Buffer::Iterator* payload,
+                      int priority)
+{
+    uint32_t totalLength = headerLen +
+                           (payload ? payload->size() : 0);
+    assert(totalLength <= MAX_PAYLOAD_SIZE);
+
+    const ShmAddress* address = static_cast<const ShmAddress*>(addr);
+    std::shared_ptr<Peer> peer = getPeer(address);
+    if (!peer) {
+        return;
+    }
+    Channel* channel = peer->channel;
+    uint64_t head = channel->head.load(std::memory_order_relaxed);
+    if (head - channel->tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+        TEST_LOG("ring to %s is full; dropping packet",
+                 address->name.c_str());
+        return;
+    }
+
+    Slot* slot = &channel->slots[head % RING_SLOTS];
+    memcpy(slot->data, header, headerLen);
+    char* dst = slot->data + headerLen;
+    while (payload && !payload->isDone()) {
+        memcpy(dst, payload->getData(), payload->getLength());
+        dst += payload->getLength();
+        payload->next();
+    }
+    slot->length = totalLength;
+    channel->head.store(head + 1, std::memory_order_release);
+}
+
+// See docs in Driver class.
+string
+ShmDriver::getServiceLocator()
+{
+    return locatorString;
+}
+
+/**
+ * Find the mapping of an address's region, mapping it if necessary.
+ *
+ * \param address
+ *      Where a packet is to be sent.
+ * \return
+ *      The peer, or an empty pointer if the address's driver doesn't exist
+ *      (any more).
+ */
+std::shared_ptr<ShmDriver::Peer>
+ShmDriver::getPeer(const ShmAddress* address)
+{
+    if (address->peer &&
+            address->peer->region->closed.load(std::memory_order_acquire)
+            == 0) {
+        return address->peer;
+    }
+    address->peer.reset();
+
+    SpinLock::Guard _(peersMutex);
+    auto it = peers.find(address->name);
+    if (it != peers.end()) {
+        if (it->second->region->closed.load(std::memory_order_acquire)
+                == 0) {
+            address->peer = it->second;
+            return address->peer;
+        }
+        peers.erase(it);
+    }
+    try {
+        address->peer = std::make_shared<Peer>(address->name, name);
+    } catch (DriverException& e) {
+        RAMCLOUD_CLOG(NOTICE, "ShmDriver dropping packet for %s: %s",
+                address->name.c_str(), e.message.c_str());
+        return address->peer;
+    }
+    peers[address->name] = address->peer;
+    return address->peer;
+}
+
+/**
+ * Open and map a driver's region.
+ *
+ * \param name
+ *      Name of the driver.
+ * \param flags
+ *      Flags for shm_open; O_CREAT means the region is created (and sized).
+ *
+ * \throw DriverException
+ *      The region couldn't be opened or mapped.
+ */
+ShmDriver::Region*
+ShmDriver::mapRegion(const string& name, int flags)
+{
+    string path = regionName(name);
+    int fd = shm_open(path.c_str(), flags, 0600);
+    if (fd < 0) {
+        throw DriverException(HERE,
+                format("ShmDriver couldn't open %s", path.c_str()), errno);
+    }
+    if (flags & O_CREAT) {
+        if (ftruncate(fd, sizeof(Region)) != 0) {
+            int e = errno;
+            close(fd);
+            shm_unlink(path.c_str());
+            throw DriverException(HERE,
+                    format("ShmDriver couldn't size %s", path.c_str()), e);
+        }
+    } else {
+        struct stat info;
+        if (fstat(fd, &info) != 0 ||
+                static_cast<size_t>(info.st_size) < sizeof(Region)) {
+            close(fd);
+            throw DriverException(HERE,
+                    format("ShmDriver region %s isn't ready", path.c_str()));
+        }
+    }
+    void* p = mmap(NULL, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    int e = errno;
+    close(fd);
+    if (p == MAP_FAILED) {
+        if (flags & O_CREAT)
+            shm_unlink(path.c_str());
+        throw DriverException(HERE,
+                format("ShmDriver couldn't map %s", path.c_str()), e);
+    }
+    return static_cast<Region*>(p);
+}
+
+/**
+ * Return the POSIX shared memory name of a driver's region.
+ */
+string
+ShmDriver::regionName(const string& name)
+{
+    return "/ramcloud-" + name;
+}
+
+/**
+ * Map another driver's region and claim a channel in it.
+ *
+ * \param name
+ *      Name of the driver to send to.
+ * \param ownName
+ *      Name of the sending driver, to which the peer will respond.
+ *
+ * \throw DriverException
+ *      The region doesn't exist, or all of its channels are in use.
+ */
+ShmDriver::Peer::Peer(const string& name, const string& ownName)
+    : name(name)
+    , region(mapRegion(name, O_RDWR))
+    , channel(NULL)
+{
+    if (region->magic.load(std::memory_order_acquire) != REGION_MAGIC ||
+            region->closed.load(std::memory_order_acquire) != 0) {
+        munmap(region, sizeof(Region));
+        throw DriverException(HERE,
+                format("ShmDriver region for %s isn't ready", name.c_str()));
+    }
+
+    uint32_t pid = downCast<uint32_t>(getpid());
+    for (int pass = 0; pass < 2 && channel == NULL; pass++) {
+        for (uint32_t i = 0; i < CHANNELS; i++) {
+            Channel* c = &region->channels[i];
+            uint32_t owner = c->ownerPid.load();
+            if (owner == 0 && pass == 0) {
+                // Free.
+            } else if (owner != 0 && pass == 1 &&
+                    kill(static_cast<pid_t>(owner), 0) != 0 &&
+                    errno == ESRCH) {
+                // The sender crashed without releasing the channel; the
+                // new owner picks up at its head.
+            } else {
+                continue;
+            }
+            if (c->ownerPid.compare_exchange_strong(owner, pid)) {
+                channel = c;
+                break;
+            }
+        }
+    }
+    if (channel == NULL) {
+        munmap(region, sizeof(Region));
+        throw DriverException(HERE,
+                format("ShmDriver region for %s has no free channels",
+                name.c_str()));
+    }
+    memset(channel->ownerName, 0, sizeof(channel->ownerName));
+    memcpy(channel->ownerName, ownName.data(), ownName.size());
+}
+
+/**
+ * Release the channel and unmap the region.
+ */
+ShmDriver::Peer::~Peer()
+{
+    channel->ownerPid.store(0);
+    munmap(region, sizeof(Region));
+}
+
+} // namespace RAMCloud
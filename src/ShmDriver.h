@@ -0,0 +1,224 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SHMDRIVER_H
+#define RAMCLOUD_SHMDRIVER_H
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Driver.h"
+#include "ObjectPool.h"
+#include "ServiceLocator.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * A Driver that carries packets between processes on the same machine
+ * through POSIX shared memory, so that co-located clients and servers can
+ * skip the kernel network stack. It is meant to be used under
+ * BasicTransport ("basic+shm:name=..."), which provides reliability and
+ * flow control on top of it.
+ *
+ * Each driver creates a receive region named after its locator's "name"
+ * option (clients, which have no locator, get a unique name). The region is
+ * divided into a fixed number of channels; a sender claims a channel of its
+ * own the first time it talks to the region, so each channel is a lock-free
+ * single-producer single-consumer ring of packet slots. Senders copy packets
+ * straight into the slots of the ring and the receiver copies them out into
+ * pooled buffers, so a slot can be reused as soon as the packet has been
+ * handed to the transport.
+ *
+ * The driver never blocks: a packet sent to a full ring, or to a region
+ * whose owner has shut down, is dropped and left to BasicTransport to
+ * retransmit. newAddress throws if the peer's region doesn't exist, so when
+ * a server advertises "basic+shm" ahead of a network locator, clients on
+ * other machines simply fall back to the network.
+ */
+class ShmDriver : public Driver {
+  PUBLIC:
+    /// The maximum number of bytes in a packet (chosen so that a ring slot
+    /// is 8 KB).
+    static const uint32_t MAX_PAYLOAD_SIZE = 8188;
+
+    explicit ShmDriver(Context* context,
+                       const ServiceLocator* localServiceLocator = NULL);
+    virtual ~ShmDriver();
+    virtual uint32_t getBandwidth();
+    virtual uint32_t getMaxPacketSize();
+    virtual Address* newAddress(const ServiceLocator* serviceLocator);
+    virtual void receivePackets(uint32_t maxPackets,
+            std::vector<Received>* receivedPackets);
+    virtual void release(char *payload);
+    virtual void sendPacket(const Address* addr,
+                            const void* header,
+                            uint32_t headerLen,
+                            Buffer::Iterator* payload,
+                            int priority = 0);
+    virtual string getServiceLocator();
+
+  PRIVATE:
+    enum {
+        /// Longest driver name, including the terminating NUL.
+        MAX_NAME_LENGTH = 64,
+
+        /// Number of senders that can talk to one driver at once.
+        CHANNELS = 16,
+
+        /// Number of packets that can be queued in one channel.
+        RING_SLOTS = 64,
+    };
+
+    /// Identifies an initialized region.
+    static const uint64_t REGION_MAGIC = 0x52414d436c53686dUL;
+
+    /// One packet in a ring.
+    struct Slot {
+        /// Number of valid bytes in #data.
+        uint32_t length;
+        char data[MAX_PAYLOAD_SIZE];
+    };
+
+    /**
+     * A ring of packets from a single sender to the region's owner. The
+     * producer fills the slot at #head, then advances #head; the consumer
+     * copies out the slot at #tail, then advances #tail. Both only ever
+     * increase; slot i lives at slots[i % RING_SLOTS].
+     */
+    struct Channel {
+        /// Process id of the sender that owns the channel, or 0 if the
+        /// channel is free.
+        std::atomic<uint32_t> ownerPid;
+
+        /// Driver name of the owner (NUL-terminated): where responses to
+        /// the packets in this channel should be sent.
+        char ownerName[MAX_NAME_LENGTH];
+
+        /// Number of packets ever added to the ring; written by the owner.
+        alignas(64) std::atomic<uint64_t> head;
+
+        /// Number of packets ever taken from the ring; written by the
+        /// region's owner.
+        alignas(64) std::atomic<uint64_t> tail;
+
+        alignas(64) Slot slots[RING_SLOTS];
+    };
+
+    /// The layout of a driver's receive region.
+    struct Region {
+        /// REGION_MAGIC once the region has been initialized.
+        std::atomic<uint64_t> magic;
+
+        /// Nonzero once the owner has shut down; senders drop their
+        /// mappings when they see this.
+        std::atomic<uint32_t> closed;
+
+        Channel channels[CHANNELS];
+    };
+
+    /**
+     * A sender's view of another driver's region: the mapping and the
+     * channel claimed in it.
+     */
+    struct Peer {
+        Peer(const string& name, const string& ownName);
+        ~Peer();
+
+        /// Name of the peer driver.
+        string name;
+
+        /// The peer's region, mapped into this process.
+        Region* region;
+
+        /// The channel of #region that belongs to this sender.
+        Channel* channel;
+
+        DISALLOW_COPY_AND_ASSIGN(Peer);
+    };
+
+    /**
+     * The address of a ShmDriver: its name, plus a cached mapping of its
+     * region once something has been sent to it.
+     */
+    struct ShmAddress : public Driver::Address {
+        explicit ShmAddress(const string& name)
+            : name(name)
+            , peer()
+        {}
+        ShmAddress(const ShmAddress& other)
+            : Address(other)
+            , name(other.name)
+            , peer(other.peer)
+        {}
+        string toString() const {
+            return name;
+        }
+
+        /// Name of the driver.
+        string name;
+
+        /// The driver's region, if it has been mapped; filled in lazily by
+        /// sendPacket.
+        mutable std::shared_ptr<Peer> peer;
+    };
+
+    typedef Driver::PacketBuf<ShmAddress, MAX_PAYLOAD_SIZE> PacketBuf;
+
+    static Region* mapRegion(const string& name, int flags);
+    static string regionName(const string& name);
+    std::shared_ptr<Peer> getPeer(const ShmAddress* address);
+
+    /// Shared RAMCloud information.
+    Context* context;
+
+    /// Name of this driver; its region is regionName(name).
+    string name;
+
+    /// See getServiceLocator().
+    string locatorString;
+
+    /// This driver's receive region.
+    Region* region;
+
+    /// Index of the channel receivePackets looks at first, so that each
+    /// sender gets its turn at the packet limit.
+    uint32_t nextChannel;
+
+    /// Holds packet buffers that are no longer in use, for use in future
+    /// packets.
+    ObjectPool<PacketBuf> packetBufPool;
+
+    /// Used to synchronize accesses to packetBufPool.
+    SpinLock mutex;
+
+    /// Mappings of the regions this driver has sent packets to, by name.
+    std::unordered_map<string, std::shared_ptr<Peer>> peers;
+
+    /// Used to synchronize accesses to #peers (newAddress may be invoked
+    /// outside the dispatch thread).
+    SpinLock peersMutex;
+
+    /// Used to generate unique names for client drivers.
+    static std::atomic<uint32_t> nextClientId;
+
+    DISALLOW_COPY_AND_ASSIGN(ShmDriver);
+};
+
+} // end RAMCloud
+
+#endif  // RAMCLOUD_SHMDRIVER_H
@@ -0,0 +1,176 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "ShmDriver.h"
+
+namespace RAMCloud {
+class ShmDriverTest : public ::testing::Test {
+  public:
+    Context context;
+    TestLog::Enable logEnabler;
+    ServiceLocator serverLocator;
+    Tub<ShmDriver> server;
+    ShmDriver client;
+    std::unique_ptr<Driver::Address> serverAddress;
+
+    ShmDriverTest()
+        : context()
+        , logEnabler()
+        , serverLocator("shm:name=shmDriverTest")
+        , server()
+        , client(&context)
+        , serverAddress()
+    {
+        server.construct(&context, &serverLocator);
+        serverAddress.reset(client.newAddress(&serverLocator));
+    }
+
+    // Returns the contents of all the packets waiting for a driver,
+    // separated by commas.
+    string receivePackets(ShmDriver* driver, uint32_t maxPackets = 100) {
+        std::vector<Driver::Received> receivedPackets;
+        driver->receivePackets(maxPackets, &receivedPackets);
+        string result;
+        for (uint32_t i = 0; i < receivedPackets.size(); i++) {
+            if (i != 0) {
+                result.append(", ");
+            }
+            result.append(receivedPackets[i].payload,
+                    receivedPackets[i].len);
+        }
+        return result;
+    }
+
+    void sendMessage(ShmDriver *driver, const Driver::Address *address,
+            const char *header, const char *payload) {
+        Buffer message;
+        message.appendExternal(payload, downCast<uint32_t>(strlen(payload)));
+        Buffer::Iterator iterator(&message);
+        driver->sendPacket(address, header, downCast<uint32_t>(strlen(header)),
+                           &iterator);
+    }
+
+  private:
+    DISALLOW_COPY_AND_ASSIGN(ShmDriverTest);
+};
+
+TEST_F(ShmDriverTest, basics) {
+    // Send a packet from a "client" to a "server" and back again.
+    sendMessage(&client, serverAddress.get(), "header:", "sample message");
+    std::vector<Driver::Received> received;
+    server->receivePackets(10, &received);
+    ASSERT_EQ(1u, received.size());
+    EXPECT_EQ("header:sample message",
+            string(received[0].payload, received[0].len));
+    EXPECT_EQ(client.name, received[0].sender->toString());
+
+    sendMessage(server.get(), received[0].sender, "h:", "response");
+    EXPECT_EQ("h:response", receivePackets(&client));
+    EXPECT_EQ("", receivePackets(server.get()));
+}
+
+TEST_F(ShmDriverTest, constructor_clientName) {
+    ShmDriver client2(&context);
+    EXPECT_EQ(0u, client.getServiceLocator().find("shm:name=client-"));
+    EXPECT_NE(client.getServiceLocator(), client2.getServiceLocator());
+}
+
+TEST_F(ShmDriverTest, constructor_badName) {
+    ServiceLocator locator("shm:name=a/b");
+    EXPECT_THROW(ShmDriver(&context, &locator), DriverException);
+}
+
+TEST_F(ShmDriverTest, destructor_closesRegion) {
+    server.destroy();
+    EXPECT_THROW(client.newAddress(&serverLocator), DriverException);
+}
+
+TEST_F(ShmDriverTest, newAddress_noSuchDriver) {
+    ServiceLocator locator("shm:name=shmDriverTestMissing");
+    EXPECT_THROW(client.newAddress(&locator), DriverException);
+}
+
+TEST_F(ShmDriverTest, newAddress_noFreeChannels) {
+    std::vector<std::unique_ptr<ShmDriver>> clients;
+    std::vector<std::unique_ptr<Driver::Address>> addresses;
+    for (int i = 1; i < ShmDriver::CHANNELS; i++) {
+        clients.emplace_back(new ShmDriver(&context));
+        addresses.emplace_back(clients.back()->newAddress(&serverLocator));
+    }
+    ShmDriver extra(&context);
+    EXPECT_THROW(extra.newAddress(&serverLocator), DriverException);
+
+    // Channels are released when the sender's mappings go away.
+    addresses.clear();
+    clients.clear();
+    delete extra.newAddress(&serverLocator);
+}
+
+TEST_F(ShmDriverTest, receivePackets_maxPackets) {
+    sendMessage(&client, serverAddress.get(), "a", "");
+    sendMessage(&client, serverAddress.get(), "b", "");
+    sendMessage(&client, serverAddress.get(), "c", "");
+    EXPECT_EQ("a, b", receivePackets(server.get(), 2));
+    EXPECT_EQ("c", receivePackets(server.get(), 2));
+}
+
+TEST_F(ShmDriverTest, receivePackets_severalSenders) {
+    ShmDriver client2(&context);
+    std::unique_ptr<Driver::Address> address2(
+            client2.newAddress(&serverLocator));
+    sendMessage(&client, serverAddress.get(), "a", "");
+    sendMessage(&client2, address2.get(), "b", "");
+    EXPECT_EQ("a, b", receivePackets(server.get()));
+}
+
+TEST_F(ShmDriverTest, release) {
+    sendMessage(&client, serverAddress.get(), "a", "");
+    {
+        std::vector<Driver::Received> received;
+        server->receivePackets(10, &received);
+        EXPECT_EQ(1u, server->packetBufPool.outstandingObjects);
+    }
+    EXPECT_EQ(0u, server->packetBufPool.outstandingObjects);
+}
+
+TEST_F(ShmDriverTest, sendPacket_ringFull) {
+    for (int i = 0; i < ShmDriver::RING_SLOTS; i++) {
+        sendMessage(&client, serverAddress.get(), "x", "");
+    }
+    EXPECT_EQ("", TestLog::get());
+    sendMessage(&client, serverAddress.get(), "y", "");
+    EXPECT_EQ("sendPacket: ring to shmDriverTest is full; dropping packet",
+            TestLog::get());
+
+    std::vector<Driver::Received> received;
+    server->receivePackets(1000, &received);
+    EXPECT_EQ(static_cast<size_t>(ShmDriver::RING_SLOTS), received.size());
+    received.clear();
+    sendMessage(&client, serverAddress.get(), "z", "");
+    EXPECT_EQ("z", receivePackets(server.get()));
+}
+
+TEST_F(ShmDriverTest, sendPacket_peerRestarted) {
+    server.destroy();
+    sendMessage(&client, serverAddress.get(), "lost", "");
+    EXPECT_TRUE(client.peers.empty());
+
+    server.construct(&context, &serverLocator);
+    sendMessage(&client, serverAddress.get(), "found", "");
+    EXPECT_EQ("found", receivePackets(server.get()));
+}
+
+}  // namespace RAMCloud
@@ -0,0 +1,218 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "TestUtil.h"
+#include "SimulatedCluster.h"
+#include "ThreadId.h"
+
+namespace RAMCloud {
+
+const char* SimulatedCluster::CLIENT_NODE = "client";
+
+/**
+ * Create a SimulatedCluster with a running coordinator and no servers;
+ * the simulated clock starts at 0.
+ *
+ * \param context
+ *      External context, owned by the caller, that is set up to access the
+ *      cluster; see MockCluster::MockCluster. RPCs sent with it are charged
+ *      to CLIENT_NODE.
+ * \param model
+ *      Hardware to simulate.
+ */
+SimulatedCluster::SimulatedCluster(Context* context, const Model& model)
+    : cluster(context)
+    , model(model)
+    , mutex()
+    , now(0)
+    , nodes()
+    , calls()
+{
+    cluster.transport.rpcModel = this;
+}
+
+/**
+ * Destructor for SimulatedCluster. RPCs sent while the servers shut down
+ * are not charged.
+ */
+SimulatedCluster::~SimulatedCluster()
+{
+    cluster.transport.rpcModel = NULL;
+}
+
+/**
+ * Add a server to the cluster; see MockCluster::addServer. The RPCs it
+ * takes to enlist the server are charged like any other.
+ *
+ * \param config
+ *      Configuration of the new server.
+ */
+Server*
+SimulatedCluster::addServer(ServerConfig config)
+{
+    return cluster.addServer(config);
+}
+
+/**
+ * Move the caller's simulated clock forward, for example to model the
+ * time between operations of a workload.
+ *
+ * \param nanoseconds
+ *      How far to move the clock.
+ */
+void
+SimulatedCluster::advanceTime(uint64_t nanoseconds)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    now += nanoseconds;
+}
+
+/**
+ * Return the counters of one node.
+ *
+ * \param locator
+ *      Service locator of a server, or CLIENT_NODE.
+ */
+SimulatedCluster::NodeStats
+SimulatedCluster::getNodeStats(const string& locator)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    return nodes[locator].stats;
+}
+
+/**
+ * Return the caller's simulated time in nanoseconds: when the most recent
+ * RPC it sent completed (with the RPCs that RPC caused), plus any
+ * advanceTime().
+ */
+uint64_t
+SimulatedCluster::getTime()
+{
+    std::lock_guard<std::mutex> _(mutex);
+    return now;
+}
+
+/**
+ * Charge for the transmission of a request and its handling on the
+ * server, up to the point where the server would issue any RPCs of its
+ * own; see BindTransport::RpcModel.
+ */
+void
+SimulatedCluster::startRpc(const string& locator, Buffer* request)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    std::vector<Call>& stack = calls[ThreadId::get()];
+    string caller = stack.empty() ? CLIENT_NODE : stack.back().locator;
+    uint64_t start = stack.empty() ? now : stack.back().ready;
+
+    uint64_t ready = transfer(caller, locator, request->size(), start);
+    const WireFormat::RequestCommon* header =
+            request->getStart<WireFormat::RequestCommon>();
+    if (header != NULL && header->opcode == WireFormat::BACKUP_WRITE)
+        ready = useDisk(locator, request->size(), ready);
+    ready += model.serviceNs;
+    nodes[locator].stats.rpcsHandled++;
+    stack.push_back({locator, caller, ready, ready});
+}
+
+/**
+ * Charge for the rest of an RPC: waiting for the RPCs the server issued,
+ * and transmitting the response; see BindTransport::RpcModel.
+ */
+void
+SimulatedCluster::finishRpc(const string& locator, Buffer* request,
+        Buffer* response)
+{
+    std::lock_guard<std::mutex> _(mutex);
+    std::vector<Call>& stack = calls[ThreadId::get()];
+    assert(!stack.empty() && stack.back().locator == locator);
+    Call call = stack.back();
+    stack.pop_back();
+
+    uint64_t ready = std::max(call.ready, call.done);
+    const WireFormat::RequestCommon* header =
+            request->getStart<WireFormat::RequestCommon>();
+    if (header != NULL &&
+            header->opcode == WireFormat::BACKUP_GETRECOVERYDATA) {
+        ready = useDisk(locator, response->size(), ready);
+    }
+    uint64_t end = transfer(locator, call.caller, response->size(), ready);
+    if (stack.empty()) {
+        now = std::max(now, end);
+    } else {
+        stack.back().done = std::max(stack.back().done, end);
+    }
+}
+
+/**
+ * Charge for sending a message over the network. The caller must hold
+ * #mutex.
+ *
+ * \param from
+ *      Node sending the message.
+ * \param to
+ *      Node receiving the message.
+ * \param bytes
+ *      Size of the message.
+ * \param start
+ *      Simulated time at which the message is ready to send.
+ * \return
+ *      Simulated time at which the message has fully arrived.
+ */
+uint64_t
+SimulatedCluster::transfer(const string& from, const string& to,
+        uint32_t bytes, uint64_t start)
+{
+    Node& sender = nodes[from];
+    Node& receiver = nodes[to];
+    start = std::max({start, sender.transmitFree, receiver.receiveFree});
+    uint64_t end = start + static_cast<uint64_t>(bytes * 8.0 /
+            model.networkGbps);
+    sender.transmitFree = end;
+    receiver.receiveFree = end;
+    sender.stats.bytesSent += bytes;
+    receiver.stats.bytesReceived += bytes;
+    return end + model.networkLatencyNs;
+}
+
+/**
+ * Charge for a disk transfer on a node. The caller must hold #mutex.
+ *
+ * \param locator
+ *      Node whose disk is used.
+ * \param bytes
+ *      Number of bytes read or written.
+ * \param start
+ *      Simulated time at which the transfer could begin.
+ * \return
+ *      Simulated time at which the transfer is complete.
+ */
+uint64_t
+SimulatedCluster::useDisk(const string& locator, uint32_t bytes,
+        uint64_t start)
+{
+    Node& node = nodes[locator];
+    start = std::max(start, node.diskFree);
+    uint64_t duration = model.diskLatencyNs +
+            static_cast<uint64_t>(bytes * 1000.0 / model.diskMBps);
+    node.diskFree = start + duration;
+    node.stats.diskBytes += bytes;
+    node.stats.diskBusyNs += duration;
+    return node.diskFree;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,202 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SIMULATEDCLUSTER_H
+#define RAMCLOUD_SIMULATEDCLUSTER_H
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "MockCluster.h"
+
+namespace RAMCloud {
+
+/**
+ * A MockCluster whose RPCs are charged simulated time according to a
+ * model of the network and disks, so that the effect of a policy change
+ * (in the scheduler, cleaner, recovery, ...) on a cluster of a given size
+ * and hardware can be estimated in a single process.
+ *
+ * The model:
+ *  - Each node (every server, plus CLIENT_NODE for RPCs issued by the
+ *    caller) has a NIC that transmits and receives at Model::networkGbps,
+ *    and a disk that transfers Model::diskMBps after Model::diskLatencyNs.
+ *  - A message occupies the transmit side of the sender's NIC and the
+ *    receive side of the recipient's for its size divided by the network
+ *    bandwidth, starting once both are free, and arrives
+ *    Model::networkLatencyNs after that.
+ *  - Each RPC costs Model::serviceNs on the server. BACKUP_WRITE requests
+ *    also occupy the backup's disk for their size before the server
+ *    handles them, and BACKUP_GETRECOVERYDATA responses after.
+ *  - RPCs that a server issues while handling an RPC (replication,
+ *    recovery fan-out, server list updates, ...) are treated as
+ *    concurrent: each starts when the outer request arrived, and the
+ *    outer response leaves once the last of them has completed. RPCs
+ *    issued by the caller are sequential: each starts when the previous
+ *    one completed, or later if advanceTime() is called in between.
+ *
+ * BindTransport executes every RPC synchronously, and the clock only
+ * moves by modeled costs, so results don't depend on the speed of the
+ * machine running the simulation. RPCs sent by background threads (for
+ * example the coordinator's server list updater) are charged from the
+ * current time, which makes them the one source of nondeterminism.
+ */
+class SimulatedCluster : public BindTransport::RpcModel {
+  public:
+    /**
+     * Hardware parameters of the simulated cluster. The defaults describe
+     * a 10 Gb/s datacenter network and SSDs.
+     */
+    struct Model {
+        Model()
+            : networkLatencyNs(5000)
+            , networkGbps(10.0)
+            , diskLatencyNs(100000)
+            , diskMBps(500.0)
+            , serviceNs(1000)
+        {}
+
+        /// One-way delay of a message, beyond the time to transmit it.
+        uint64_t networkLatencyNs;
+
+        /// Bandwidth of each node's NIC, in each direction.
+        double networkGbps;
+
+        /// Time before a disk transfer starts.
+        uint64_t diskLatencyNs;
+
+        /// Bandwidth of each node's disk.
+        double diskMBps;
+
+        /// Processing time of an RPC on its server.
+        uint64_t serviceNs;
+    };
+
+    /**
+     * Counters for one node, as returned by getNodeStats().
+     */
+    struct NodeStats {
+        NodeStats()
+            : rpcsHandled(0)
+            , bytesSent(0)
+            , bytesReceived(0)
+            , diskBytes(0)
+            , diskBusyNs(0)
+        {}
+
+        /// RPCs the node has served.
+        uint64_t rpcsHandled;
+
+        /// Bytes of requests and responses the node has transmitted.
+        uint64_t bytesSent;
+
+        /// Bytes of requests and responses the node has received.
+        uint64_t bytesReceived;
+
+        /// Bytes the node's disk has read or written.
+        uint64_t diskBytes;
+
+        /// Simulated time the node's disk has spent on transfers.
+        uint64_t diskBusyNs;
+    };
+
+    explicit SimulatedCluster(Context* context,
+            const Model& model = Model());
+    ~SimulatedCluster();
+    Server* addServer(ServerConfig config);
+    void advanceTime(uint64_t nanoseconds);
+    NodeStats getNodeStats(const string& locator);
+    uint64_t getTime();
+    void startRpc(const string& locator, Buffer* request);
+    void finishRpc(const string& locator, Buffer* request, Buffer* response);
+
+    /// Name used in getNodeStats() for the node that issues the RPCs of
+    /// the caller.
+    static const char* CLIENT_NODE;
+
+    /// The cluster being simulated; its transport reports every RPC here.
+    MockCluster cluster;
+
+  PRIVATE:
+    /**
+     * State of one node's resources.
+     */
+    struct Node {
+        Node()
+            : transmitFree(0)
+            , receiveFree(0)
+            , diskFree(0)
+            , stats()
+        {}
+
+        /// Simulated time at which the NIC can start transmitting again.
+        uint64_t transmitFree;
+
+        /// Simulated time at which the NIC can start receiving again.
+        uint64_t receiveFree;
+
+        /// Simulated time at which the disk can start a transfer again.
+        uint64_t diskFree;
+
+        NodeStats stats;
+    };
+
+    /**
+     * An RPC that a server is handling.
+     */
+    struct Call {
+        /// The server handling the RPC.
+        string locator;
+
+        /// The node that sent the RPC.
+        string caller;
+
+        /// Simulated time at which the server is done with the request
+        /// itself; RPCs it issues start here.
+        uint64_t ready;
+
+        /// Simulated time at which the last RPC issued on behalf of this
+        /// one completed, or #ready if none.
+        uint64_t done;
+    };
+
+    uint64_t transfer(const string& from, const string& to, uint32_t bytes,
+            uint64_t start);
+    uint64_t useDisk(const string& locator, uint32_t bytes, uint64_t start);
+
+    /// Hardware being simulated.
+    Model model;
+
+    /// Serializes access to everything below, since background threads in
+    /// the cluster send RPCs too.
+    std::mutex mutex;
+
+    /// Simulated time, in nanoseconds, of the caller (see getTime()).
+    uint64_t now;
+
+    /// Resources of each node, keyed by service locator (or CLIENT_NODE).
+    std::map<string, Node> nodes;
+
+    /// For each thread sending RPCs (keyed by ThreadId), the RPCs being
+    /// handled on its stack, innermost last.
+    std::unordered_map<int, std::vector<Call>> calls;
+
+    DISALLOW_COPY_AND_ASSIGN(SimulatedCluster);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_SIMULATEDCLUSTER_H
@@ -0,0 +1,144 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "RamCloud.h"
+#include "SimulatedCluster.h"
+
+namespace RAMCloud {
+
+class SimulatedClusterTest : public ::testing::Test {
+  public:
+    Context context;
+    SimulatedCluster::Model model;
+    Tub<SimulatedCluster> cluster;
+
+    SimulatedClusterTest()
+        : context()
+        , model()
+        , cluster()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        // 8 Gb/s is one byte per nanosecond, and 1 MB/s one byte per
+        // microsecond, which keeps the arithmetic below simple.
+        model.networkLatencyNs = 1000;
+        model.networkGbps = 8.0;
+        model.diskLatencyNs = 10000;
+        model.diskMBps = 1.0;
+        model.serviceNs = 100;
+        cluster.construct(&context, model);
+    }
+
+    /// Fills \a buffer with a request of the given opcode and total size.
+    void
+    fillRequest(Buffer* buffer, WireFormat::Opcode opcode, uint32_t size)
+    {
+        WireFormat::RequestCommon* header =
+                buffer->emplaceAppend<WireFormat::RequestCommon>();
+        header->opcode = opcode;
+        header->service = WireFormat::BACKUP_SERVICE;
+        string padding(size - buffer->size(), 'x');
+        buffer->appendCopy(padding.data(),
+                downCast<uint32_t>(padding.size()));
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(SimulatedClusterTest);
+};
+
+TEST_F(SimulatedClusterTest, singleRpc) {
+    Buffer request, response;
+    fillRequest(&request, WireFormat::PING, 1000);
+    response.appendCopy(string(500, 'r').data(), 500);
+    cluster->startRpc("mock:host=a", &request);
+    cluster->finishRpc("mock:host=a", &request, &response);
+
+    // 1000 ns to transmit the request, 1000 ns latency, 100 ns service,
+    // 500 ns to transmit the response, 1000 ns latency.
+    EXPECT_EQ(3600u, cluster->getTime());
+    SimulatedCluster::NodeStats stats = cluster->getNodeStats("mock:host=a");
+    EXPECT_EQ(1u, stats.rpcsHandled);
+    EXPECT_EQ(1000u, stats.bytesReceived);
+    EXPECT_EQ(500u, stats.bytesSent);
+    stats = cluster->getNodeStats(SimulatedCluster::CLIENT_NODE);
+    EXPECT_EQ(1000u, stats.bytesSent);
+
+    cluster->advanceTime(400);
+    EXPECT_EQ(4000u, cluster->getTime());
+}
+
+TEST_F(SimulatedClusterTest, nestedRpcsAreConcurrent) {
+    Buffer request, response;
+    fillRequest(&request, WireFormat::PING, 100);
+    response.appendCopy(string(100, 'r').data(), 100);
+
+    // The request reaches A at 1100 and is processed at 1200.
+    cluster->startRpc("mock:host=a", &request);
+
+    // A's RPC to B leaves at 1200, B replies at 2400 and the reply is
+    // in at 3500.
+    cluster->startRpc("mock:host=b", &request);
+    cluster->finishRpc("mock:host=b", &request, &response);
+
+    // A's RPC to C doesn't wait for B: it leaves as soon as A's NIC is
+    // done with the first one (1300), and the reply is in at 3600.
+    cluster->startRpc("mock:host=c", &request);
+    cluster->finishRpc("mock:host=c", &request, &response);
+
+    cluster->finishRpc("mock:host=a", &request, &response);
+    EXPECT_EQ(4700u, cluster->getTime());
+}
+
+TEST_F(SimulatedClusterTest, diskTime) {
+    Buffer request, response;
+    fillRequest(&request, WireFormat::BACKUP_WRITE, 100);
+    cluster->startRpc("mock:host=a", &request);
+    cluster->finishRpc("mock:host=a", &request, &response);
+
+    // Request in at 1100, 10 us of disk latency plus 100 us for the data,
+    // 100 ns of service, 1000 ns latency for the (empty) response.
+    EXPECT_EQ(1100u + 110000u + 100u + 1000u, cluster->getTime());
+    SimulatedCluster::NodeStats stats = cluster->getNodeStats("mock:host=a");
+    EXPECT_EQ(100u, stats.diskBytes);
+    EXPECT_EQ(110000u, stats.diskBusyNs);
+
+    // GETRECOVERYDATA charges the disk for the response.
+    Buffer request2;
+    fillRequest(&request2, WireFormat::BACKUP_GETRECOVERYDATA, 100);
+    response.appendCopy(string(200, 'r').data(), 200);
+    cluster->startRpc("mock:host=a", &request2);
+    cluster->finishRpc("mock:host=a", &request2, &response);
+    stats = cluster->getNodeStats("mock:host=a");
+    EXPECT_EQ(300u, stats.diskBytes);
+}
+
+TEST_F(SimulatedClusterTest, realCluster) {
+    ServerConfig config = ServerConfig::forTesting();
+    config.services = {WireFormat::MASTER_SERVICE, WireFormat::ADMIN_SERVICE};
+    config.master.numReplicas = 0;
+    config.localLocator = "mock:host=master";
+    cluster->addServer(config);
+    RamCloud ramcloud(&context, "mock:host=coordinator");
+    uint64_t tableId = ramcloud.createTable("table");
+
+    uint64_t before = cluster->getTime();
+    uint64_t handled = cluster->getNodeStats("mock:host=master").rpcsHandled;
+    ramcloud.write(tableId, "key", 3, "value", 5);
+    EXPECT_GT(cluster->getTime(), before + 2 * model.networkLatencyNs);
+    EXPECT_LE(handled + 1,
+            cluster->getNodeStats("mock:host=master").rpcsHandled);
+}
+
+}  // namespace RAMCloud
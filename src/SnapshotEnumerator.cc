@@ -0,0 +1,148 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "SnapshotEnumerator.h"
+#include "Object.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a SnapshotEnumerator. No snapshot is taken until the first
+ * call to hasNext or next.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster to use.
+ * \param tableId
+ *      Identifier for the table to read.
+ */
+SnapshotEnumerator::SnapshotEnumerator(RamCloud& ramcloud, uint64_t tableId)
+    : ramcloud(ramcloud)
+    , tableId(tableId)
+    , tabletStartHash(0)
+    , snapshotId(0)
+    , lastTabletRead(false)
+    , done(false)
+    , objects()
+    , nextOffset(0)
+{
+}
+
+/**
+ * Test if any objects remain to be read from the table.
+ *
+ * \return
+ *      True if any objects remain, or false otherwise.
+ */
+bool
+SnapshotEnumerator::hasNext()
+{
+    requestMoreObjects();
+    return !done;
+}
+
+/**
+ * Return the next object of the table.
+ *
+ * \param[out] size
+ *      After a successful return, this field will hold the size of
+ *      the object in bytes.
+ * \param[out] object
+ *      After a successful return, this will point to contiguous
+ *      memory containing an instance of Object immediately followed
+ *      by its key and data payloads. NULL is returned to indicate
+ *      that the whole table has been read.
+ */
+void
+SnapshotEnumerator::next(uint32_t* size, const void** object)
+{
+    *size = 0;
+    *object = NULL;
+
+    requestMoreObjects();
+    if (done)
+        return;
+
+    uint32_t objectSize = *objects.getOffset<uint32_t>(nextOffset);
+    nextOffset += sizeof32(uint32_t);
+    *object = objects.getRange(nextOffset, objectSize);
+    *size = objectSize;
+    nextOffset += objectSize;
+}
+
+/**
+ * Returns the next object of the table, if any, with a more convenient
+ * interface than hasNext and next.
+ *
+ * \param[out] keyLength
+ *      After a successful return, this holds the size of the key in bytes.
+ * \param[out] key
+ *      After a successful return, this points to contiguous memory
+ *      containing the key. NULL is returned once the whole table has been
+ *      read.
+ * \param[out] dataLength
+ *      After a successful return, this holds the size of the data in bytes.
+ * \param[out] data
+ *      After a successful return, this points to contiguous memory
+ *      containing the data.
+ */
+void
+SnapshotEnumerator::nextKeyAndData(uint32_t* keyLength, const void** key,
+        uint32_t* dataLength, const void** data)
+{
+    *keyLength = 0;
+    *key = NULL;
+    *dataLength = 0;
+    *data = NULL;
+
+    uint32_t size;
+    const void* buffer;
+    next(&size, &buffer);
+    if (done)
+        return;
+
+    Object object(buffer, size);
+    *keyLength = object.getKeyLength();
+    *key = object.getKey();
+    *data = object.getValue(dataLength);
+}
+
+/**
+ * Used internally by #hasNext and #next to retrieve objects. Sets #done
+ * once the whole table has been read; otherwise #objects contains at least
+ * one more object.
+ */
+void
+SnapshotEnumerator::requestMoreObjects()
+{
+    if (done || nextOffset < objects.size())
+        return;
+
+    nextOffset = 0;
+    objects.reset();
+    while (!lastTabletRead) {
+        tabletStartHash = ramcloud.readTableSnapshot(tableId, tabletStartHash,
+                &snapshotId, &objects);
+        lastTabletRead = (snapshotId == 0 && tabletStartHash == 0);
+        if (objects.size() > 0)
+            return;
+
+        // Either the master is still reading its log for the current
+        // tablet, or that tablet is finished and the next one may be on
+        // another master.
+    }
+    done = true;
+}
+
+} // namespace RAMCloud
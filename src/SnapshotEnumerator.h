@@ -0,0 +1,77 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_SNAPSHOTENUMERATOR_H
+#define RAMCLOUD_SNAPSHOTENUMERATOR_H
+
+#include "RamCloud.h"
+
+namespace RAMCloud {
+
+/**
+ * Reads every object of a table as it was at one instant, using
+ * READ_TABLE_SNAPSHOT (see TableSnapshot). Unlike a TableEnumerator, it
+ * returns each object exactly once with the value it had when the snapshot
+ * of its tablet was taken, however the table changes in the meantime. Each
+ * tablet is snapshotted when the enumerator first reaches it, so the
+ * snapshots of different tablets are taken at different times.
+ *
+ * A master discards a snapshot that isn't read for a minute, so objects
+ * should be consumed promptly; next() throws SnapshotTooOldException if the
+ * snapshot being read has been lost.
+ */
+class SnapshotEnumerator {
+  public:
+    SnapshotEnumerator(RamCloud& ramcloud, uint64_t tableId);
+    bool hasNext();
+    void next(uint32_t* size, const void** object);
+    void nextKeyAndData(uint32_t* keyLength, const void** key,
+                        uint32_t* dataLength, const void** data);
+  PRIVATE:
+    void requestMoreObjects();
+
+    /// The RamCloud master object.
+    RamCloud& ramcloud;
+
+    /// The table being read.
+    uint64_t tableId;
+
+    /// The start hash of the tablet being read.
+    uint64_t tabletStartHash;
+
+    /// Identifies the snapshot of the tablet being read on its master; 0
+    /// before it has been taken.
+    uint64_t snapshotId;
+
+    /// Set to true once the last tablet's master has returned its final
+    /// objects, which may still be in #objects.
+    bool lastTabletRead;
+
+    /// Set to true when the entire table has been read.
+    bool done;
+
+    /// Objects last received from the server, and currently being read
+    /// out by the client.
+    Buffer objects;
+
+    /// The next offset to read within #objects.
+    uint32_t nextOffset;
+
+    DISALLOW_COPY_AND_ASSIGN(SnapshotEnumerator);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_SNAPSHOTENUMERATOR_H
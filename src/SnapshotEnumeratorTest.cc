@@ -0,0 +1,109 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "SnapshotEnumerator.h"
+
+namespace RAMCloud {
+
+class SnapshotEnumeratorTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    RamCloud ramcloud;
+
+  public:
+    SnapshotEnumeratorTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud(&context, "mock:host=coordinator")
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig config = ServerConfig::forTesting();
+        config.services = {WireFormat::MASTER_SERVICE,
+                           WireFormat::ADMIN_SERVICE};
+        config.localLocator = "mock:host=master1";
+        cluster.addServer(config);
+        config.localLocator = "mock:host=master2";
+        cluster.addServer(config);
+    }
+
+    /// Return the objects \a iter returns as "key:value" strings, in key
+    /// order.
+    string
+    readAll(SnapshotEnumerator& iter)
+    {
+        std::map<string, string> objects;
+        while (iter.hasNext()) {
+            uint32_t keyLength, dataLength;
+            const void* key;
+            const void* data;
+            iter.nextKeyAndData(&keyLength, &key, &dataLength, &data);
+            objects[string(static_cast<const char*>(key), keyLength)] =
+                    string(static_cast<const char*>(data), dataLength);
+        }
+        string result;
+        foreach (auto& object, objects) {
+            result += (result.empty() ? "" : " ") + object.first + ":" +
+                    object.second;
+        }
+        return result;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(SnapshotEnumeratorTest);
+};
+
+TEST_F(SnapshotEnumeratorTest, basics) {
+    uint64_t tableId = ramcloud.createTable("table1", 2);
+    ramcloud.write(tableId, "0", 1, "a", 1);
+    ramcloud.write(tableId, "1", 1, "b", 1);
+    ramcloud.write(tableId, "2", 1, "c", 1);
+    ramcloud.write(tableId, "3", 1, "d", 1);
+    ramcloud.write(tableId, "4", 1, "e", 1);
+
+    SnapshotEnumerator iter(ramcloud, tableId);
+    EXPECT_EQ("0:a 1:b 2:c 3:d 4:e", readAll(iter));
+    EXPECT_FALSE(iter.hasNext());
+    uint32_t size;
+    const void* object;
+    iter.next(&size, &object);
+    EXPECT_EQ(0U, size);
+    EXPECT_TRUE(object == NULL);
+}
+
+TEST_F(SnapshotEnumeratorTest, emptyTable) {
+    uint64_t tableId = ramcloud.createTable("table1", 2);
+    SnapshotEnumerator iter(ramcloud, tableId);
+    EXPECT_FALSE(iter.hasNext());
+}
+
+TEST_F(SnapshotEnumeratorTest, pointInTime) {
+    uint64_t tableId = ramcloud.createTable("table1", 1);
+    ramcloud.write(tableId, "a", 1, "old", 3);
+    ramcloud.write(tableId, "b", 1, "old", 3);
+    SnapshotEnumerator iter(ramcloud, tableId);
+    EXPECT_TRUE(iter.hasNext());
+
+    ramcloud.write(tableId, "a", 1, "new", 3);
+    ramcloud.remove(tableId, "b", 1);
+    ramcloud.write(tableId, "c", 1, "new", 3);
+    EXPECT_EQ("a:old b:old", readAll(iter));
+}
+
+}  // namespace RAMCloud
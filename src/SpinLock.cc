@@ -13,9 +13,12 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <mutex>
 #include <unordered_set>
 
+#include "BitOps.h"
 #include "Common.h"
 #include "Cycles.h"
 #include "SpinLock.h"
@@ -53,11 +56,14 @@ namespace SpinLockTable {
  * Construct a new SpinLock and give it the provided name.
  */
 SpinLock::SpinLock(string name)
-    : mutex(0)
+    : state(FREE)
     , name(name)
     , acquisitions(0)
     , contendedAcquisitions(0)
     , contendedTicks(0)
+    , parkedAcquisitions(0)
+    , spinTicks(0)
+    , waitHistogram()
     , logWaits(false)
 {
     std::lock_guard<std::mutex> lock(*SpinLockTable::lock());
@@ -71,37 +77,116 @@ SpinLock::~SpinLock()
 }
 
 /**
- * Acquire the SpinLock; blocks the thread (by continuously polling the lock)
- * until the lock has been acquired.
+ * Acquire the SpinLock; blocks the thread (by polling the lock for a while,
+ * then sleeping) until the lock has been acquired.
  */
 void
 SpinLock::lock()
 {
-    uint64_t startOfContention = 0;
-
-    while (mutex.test_and_set(std::memory_order_acquire)) {
-        if (startOfContention == 0) {
-            startOfContention = Cycles::rdtsc();
-            if (logWaits) {
-                RAMCLOUD_TEST_LOG("Waiting on SpinLock");
-            }
-        } else {
-            uint64_t now = Cycles::rdtsc();
-            if (Cycles::toSeconds(now - startOfContention) > 1.0) {
-                RAMCLOUD_LOG(WARNING,
-                        "%s SpinLock locked for one second; deadlock?",
-                        name.c_str());
-                contendedTicks += now - startOfContention;
-                startOfContention = now;
-            }
+    int expected = FREE;
+    if (expect_false(!state.compare_exchange_strong(expected, LOCKED,
+            std::memory_order_acquire))) {
+        lockSlow();
+    }
+    acquisitions++;
+}
+
+/**
+ * Print a warning if a thread has been waiting for this lock for more than
+ * a second since the last check; called periodically while waiting.
+ *
+ * \param lastCheck
+ *      Time (in rdtsc ticks) the wait began or a warning was last printed;
+ *      updated when a warning is printed.
+ */
+void
+SpinLock::checkForDeadlock(uint64_t* lastCheck)
+{
+    uint64_t now = Cycles::rdtsc();
+    if (Cycles::toSeconds(now - *lastCheck) > 1.0) {
+        RAMCLOUD_LOG(WARNING,
+                "%s SpinLock locked for one second; deadlock?",
+                name.c_str());
+        contendedTicks += now - *lastCheck;
+        *lastCheck = now;
+    }
+}
+
+/**
+ * Slow path of lock(), used when the lock is already held: spin until it
+ * shows up free or until the spin budget runs out, then sleep on the futex
+ * until unlock() wakes this thread.
+ */
+void
+SpinLock::lockSlow()
+{
+    uint64_t start = Cycles::rdtsc();
+    uint64_t lastCheck = start;
+    if (logWaits) {
+        RAMCLOUD_TEST_LOG("Waiting on SpinLock");
+    }
+
+    // spinTicks is updated by lock holders; a stale value is harmless.
+    uint64_t spinLimit = spinTicks;
+    if (spinLimit == 0)
+        spinLimit = Cycles::fromNanoseconds(MAX_SPIN_NS);
+    bool acquired = false;
+    while (Cycles::rdtsc() - start < spinLimit) {
+        int expected = FREE;
+        if (state.load(std::memory_order_relaxed) == FREE &&
+                state.compare_exchange_weak(expected, LOCKED,
+                std::memory_order_acquire)) {
+            acquired = true;
+            break;
         }
+        __asm__ __volatile__("pause" ::: "memory");
+        checkForDeadlock(&lastCheck);
     }
 
-    if (startOfContention != 0) {
-        contendedTicks += (Cycles::rdtsc() - startOfContention);
-        contendedAcquisitions++;
+    if (!acquired) {
+        // Announce that we are sleeping, so unlock() will wake us; if the
+        // lock was freed in the meantime, this acquires it. The timeout
+        // lets us keep checking for deadlock.
+        parkedAcquisitions++;
+        while (state.exchange(LOCKED_WITH_SLEEPERS,
+                std::memory_order_acquire) != FREE) {
+            struct timespec timeout = {0, 1000000};
+            syscall(SYS_futex, reinterpret_cast<int*>(&state),
+                    FUTEX_WAIT_PRIVATE, LOCKED_WITH_SLEEPERS, &timeout,
+                    NULL, 0);
+            checkForDeadlock(&lastCheck);
+        }
     }
-    acquisitions++;
+
+    uint64_t now = Cycles::rdtsc();
+    contendedTicks += now - lastCheck;
+    contendedAcquisitions++;
+    recordWait(now - start);
+}
+
+/**
+ * Update the statistics and the spin budget of the lock after a contended
+ * acquisition. The caller must hold the lock.
+ *
+ * \param waitTicks
+ *      How long the acquisition waited, in rdtsc ticks.
+ */
+void
+SpinLock::recordWait(uint64_t waitTicks)
+{
+    int bucket = BitOps::findLastSet(Cycles::toNanoseconds(waitTicks) >> 7);
+    if (bucket >= WAIT_HISTOGRAM_BUCKETS)
+        bucket = WAIT_HISTOGRAM_BUCKETS - 1;
+    waitHistogram[bucket]++;
+
+    // Spin for about twice the typical wait: long enough for the waits of a
+    // running holder, but not much longer, since waits beyond that mostly
+    // mean that the holder isn't running.
+    uint64_t minSpin = Cycles::fromNanoseconds(MIN_SPIN_NS);
+    uint64_t maxSpin = Cycles::fromNanoseconds(MAX_SPIN_NS);
+    uint64_t current = (spinTicks == 0) ? maxSpin : spinTicks;
+    uint64_t target = std::min(std::max(2 * waitTicks, minSpin), maxSpin);
+    spinTicks = current - current / 8 + target / 8;
 }
 
 /**
@@ -115,9 +200,9 @@ SpinLock::lock()
 bool
 SpinLock::try_lock()
 {
-    // test_and_set sets the flag to true and returns the previous value;
-    // if it's True, someone else is owning the lock.
-    return !mutex.test_and_set(std::memory_order_acquire);
+    int expected = FREE;
+    return state.compare_exchange_strong(expected, LOCKED,
+            std::memory_order_acquire);
 }
 
 /**
@@ -127,7 +212,11 @@ SpinLock::try_lock()
 void
 SpinLock::unlock()
 {
-    mutex.clear(std::memory_order_release);
+    if (expect_false(state.exchange(FREE, std::memory_order_release) ==
+            LOCKED_WITH_SLEEPERS)) {
+        syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAKE_PRIVATE,
+                1, NULL, NULL, 0);
+    }
 }
 
 /**
@@ -164,6 +253,13 @@ SpinLock::getStatistics(ProtoBuf::SpinLockStatistics* stats)
         lock->set_acquisitions(spin->acquisitions);
         lock->set_contended_acquisitions(spin->contendedAcquisitions);
         lock->set_contended_nsec(Cycles::toNanoseconds(spin->contendedTicks));
+        if (spin->parkedAcquisitions != 0)
+            lock->set_parked_acquisitions(spin->parkedAcquisitions);
+        int buckets = WAIT_HISTOGRAM_BUCKETS;
+        while (buckets > 0 && spin->waitHistogram[buckets - 1] == 0)
+            buckets--;
+        for (int i = 0; i < buckets; i++)
+            lock->add_wait_histogram(spin->waitHistogram[i]);
         it++;
     }
 }
@@ -25,13 +25,21 @@
 namespace RAMCloud {
 
 /**
- * This class implements locks that never block the thread: if the lock
+ * This class implements locks that rarely block the thread: if the lock
  * isn't available during a lock operation, the thread spins until the
  * lock becomes available.  SpinLocks are intended for situations where
  * locks are not held for long periods of time, such as locks used for
  * mutual exclusion.  These locks are not recursive: if a thread attempts
  * to lock a SpinLock while holding it, the thread will deadlock.
  *
+ * Spinning only pays off while the holder is running. When there are more
+ * runnable threads than cores, spinning waiters can keep the holder off
+ * the CPU, and throughput collapses. So a waiter spins only for about
+ * twice as long as contended acquisitions of this lock have recently taken
+ * (between MIN_SPIN_NS and MAX_SPIN_NS); after that it sleeps in the
+ * kernel (futex) until the holder releases the lock. Waiters spin on a
+ * plain load, so they don't bounce the lock's cache line while it is held.
+ *
  * This class implements the Boost "Lockable" concept, so SpinLocks can be
  * used with the Boost locking facilities.
  */
@@ -43,9 +51,24 @@ class SpinLock {
     bool try_lock();
     void unlock();
     void setName(string name);
+
+    /**
+     * Return true if some thread holds the lock. This is only a hint (the
+     * lock may change hands right after), meant for threads that wait for
+     * something the holder will do and want to avoid try_lock traffic
+     * while it runs.
+     */
+    bool isLocked() const
+    {
+        return state.load(std::memory_order_relaxed) != FREE;
+    }
     static void getStatistics(ProtoBuf::SpinLockStatistics* stats);
     static int numLocks();
 
+    /// Number of buckets in the histogram of wait times of each lock;
+    /// see #waitHistogram.
+    static const int WAIT_HISTOGRAM_BUCKETS = 16;
+
     /*
      * This class automatically acquires a SpinLock on construction and
      * automatically releases it on destruction.
@@ -53,8 +76,20 @@ class SpinLock {
     typedef std::lock_guard<SpinLock> Guard;
 
   PRIVATE:
-    /// Implements the lock: False means free, True means locked.
-    std::atomic_flag mutex;
+    void checkForDeadlock(uint64_t* lastCheck);
+    void lockSlow();
+    void recordWait(uint64_t waitTicks);
+
+    /// Bounds on how long a waiter spins before going to sleep.
+    static const uint64_t MIN_SPIN_NS = 1000;
+    static const uint64_t MAX_SPIN_NS = 50000;
+
+    /// Values of #state.
+    enum { FREE = 0, LOCKED = 1, LOCKED_WITH_SLEEPERS = 2 };
+
+    /// Implements the lock: FREE, LOCKED, or LOCKED_WITH_SLEEPERS, which
+    /// means that unlock() must wake up a thread sleeping on the futex.
+    std::atomic<int> state;
 
     /// Descriptive name for this SpinLock. Used to identify the purpose of
     /// the lock, what it protects, where it exists in the codebase, etc.
@@ -72,6 +107,21 @@ class SpinLock {
     /// lock due to it having already been held.
     uint64_t contendedTicks;
 
+    /// Number of contended acquisitions that slept in the kernel before
+    /// getting the lock.
+    uint64_t parkedAcquisitions;
+
+    /// How long (in processor ticks) waiters spin before sleeping; 0 means
+    /// MAX_SPIN_NS. Adapts to the wait times of recent contended
+    /// acquisitions.
+    uint64_t spinTicks;
+
+    /// Histogram of the wait times of contended acquisitions: bucket 0
+    /// counts waits shorter than 128 ns, and bucket i > 0 counts waits of
+    /// at least 64 * 2^i ns but less than twice that. The last bucket also
+    /// counts all longer waits.
+    uint64_t waitHistogram[WAIT_HISTOGRAM_BUCKETS];
+
     /// True means log when waiting for the lock; intended for unit tests only.
     bool logWaits;
 };
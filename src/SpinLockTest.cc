@@ -150,6 +150,57 @@ TEST(SpinLockTest, printWarning) {
     thread.join();
 }
 
+TEST(SpinLockTest, lockSlow_sleeps) {
+    SpinLock lock("SpinLockTest");
+    lock.spinTicks = 1;
+    lock.lock();
+
+    // Once its brief spin is over, the child must go to sleep.
+    std::thread thread(blockingChild, &lock);
+    for (int i = 0; i < 1000; i++) {
+        if (lock.state.load() == SpinLock::LOCKED_WITH_SLEEPERS)
+            break;
+        usleep(1000);
+    }
+    EXPECT_EQ(SpinLock::LOCKED_WITH_SLEEPERS, lock.state.load());
+
+    // Releasing the lock wakes it up.
+    lock.unlock();
+    thread.join();
+    EXPECT_EQ(2U, lock.acquisitions);
+    EXPECT_EQ(1U, lock.contendedAcquisitions);
+    EXPECT_EQ(1U, lock.parkedAcquisitions);
+    EXPECT_FALSE(lock.try_lock());
+}
+
+TEST(SpinLockTest, recordWait) {
+    SpinLock lock("SpinLockTest");
+    Cycles::mockCyclesPerSec = 1e09;
+
+    lock.recordWait(100);
+    EXPECT_EQ(1U, lock.waitHistogram[0]);
+    // Short waits pull the spin budget down from the maximum: a waiter
+    // spins for twice the typical wait, but at least MIN_SPIN_NS.
+    EXPECT_EQ(50000U - 50000U / 8 + 1000U / 8, lock.spinTicks);
+
+    lock.recordWait(300);
+    EXPECT_EQ(1U, lock.waitHistogram[2]);
+    for (int i = 0; i < 100; i++)
+        lock.recordWait(2000);
+    EXPECT_EQ(100U, lock.waitHistogram[4]);
+    EXPECT_NEAR(4000.0, static_cast<double>(lock.spinTicks), 10.0);
+
+    // Very long waits land in the last bucket and never push the budget
+    // past MAX_SPIN_NS.
+    for (int i = 0; i < 100; i++)
+        lock.recordWait(1000000000);
+    EXPECT_EQ(100U,
+            lock.waitHistogram[SpinLock::WAIT_HISTOGRAM_BUCKETS - 1]);
+    EXPECT_GE(50000U, lock.spinTicks);
+    EXPECT_LT(49000U, lock.spinTicks);
+    Cycles::mockCyclesPerSec = 0;
+}
+
 TEST(SpinLockTest, setName) {
     SpinLock lock("initial");
     EXPECT_EQ("initial", lock.name);
@@ -187,4 +238,22 @@ TEST(SpinLockTest, getStatistics) {
         stats.ShortDebugString()));
 }
 
+TEST(SpinLockTest, getStatistics_waitHistogram) {
+    SpinLock lock("Jimi Hendrix");
+    lock.acquisitions = 9;
+    lock.contendedAcquisitions = 4;
+    lock.parkedAcquisitions = 2;
+    lock.waitHistogram[0] = 3;
+    lock.waitHistogram[2] = 1;
+
+    ProtoBuf::SpinLockStatistics stats;
+    SpinLock::getStatistics(&stats);
+    EXPECT_TRUE(TestUtil::matchesPosixRegex(
+        "locks { name: \"Jimi Hendrix\" acquisitions: 9 "
+        "contended_acquisitions: 4 contended_nsec: 0 "
+        "parked_acquisitions: 2 wait_histogram: 3 wait_histogram: 0 "
+        "wait_histogram: 1 }",
+        stats.ShortDebugString()));
+}
+
 }  // namespace RAMCloud
@@ -142,7 +142,13 @@ typedef enum Status {
     /// Indicates that a client tried to perform transaction operations after
     /// the transaction commit had already started.
     STATUS_TX_OP_AFTER_COMMIT           = 33,
-    STATUS_MAX_VALUE                    = 33,
+
+    /// Indicates that a snapshot read asked for a time before the oldest
+    /// version the master still retains (or the master retains no old
+    /// versions at all), or that a table snapshot being read with
+    /// READ_TABLE_SNAPSHOT no longer exists on the master.
+    STATUS_SNAPSHOT_TOO_OLD             = 34,
+    STATUS_MAX_VALUE                    = 34,
 
     // Note: if you add a new status value you must make the following
     // additional updates:
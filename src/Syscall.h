@@ -87,9 +87,10 @@ class Syscall {
         return ::fcntl(fd, cmd, arg1);
     }
     VIRTUAL_FOR_TESTING
-    int futexWait(int *addr, int value) {
+    int futexWait(int *addr, int value,
+            const struct timespec* timeout = NULL) {
         return static_cast<int>(::syscall(SYS_futex, addr, FUTEX_WAIT,
-                value, NULL, NULL, 0));
+                value, timeout, NULL, 0));
     }
     VIRTUAL_FOR_TESTING
     int futexWake(int *addr, int count) {
@@ -130,6 +131,10 @@ class Syscall {
         return ::recvfrom(sockfd, buf, len, flags, from, fromLen);
     }
     VIRTUAL_FOR_TESTING
+    ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags) {
+        return ::recvmsg(sockfd, msg, flags);
+    }
+    VIRTUAL_FOR_TESTING
     ssize_t recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
             unsigned int flags, struct timespec *timeout) {
         return ::recvmmsg(sockfd, msgvec, vlen, flags, timeout);
@@ -145,6 +150,11 @@ class Syscall {
         return ::sendmsg(sockfd, msg, flags);
     }
     VIRTUAL_FOR_TESTING
+    int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+            int flags) {
+        return ::sendmmsg(sockfd, msgvec, vlen, flags);
+    }
+    VIRTUAL_FOR_TESTING
     ssize_t sendto(int socket, const void *buffer, size_t length, int flags,
            const struct sockaddr *destAddr, socklen_t destLen)
     {
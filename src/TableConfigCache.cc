@@ -0,0 +1,173 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TableConfigCache.h"
+#include "CoordinatorClient.h"
+#include "Cycles.h"
+#include "ShortMacros.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct an empty cache.
+ *
+ * \param context
+ *      Overall information about this server; used to reach the
+ *      coordinator.
+ */
+TableConfigCache::TableConfigCache(Context* context)
+    : context(context)
+    , mutex()
+    , configs()
+    , latestEpoch(0)
+    , latestVersion(0)
+{
+}
+
+/**
+ * Return the configuration of a table, fetching it from the coordinator
+ * first if this master doesn't have it or its copy may be out of date.
+ *
+ * \param tableId
+ *      The table whose configuration is wanted.
+ * \param knownEpoch
+ *      The epoch of the configuration the client already has (see
+ *      WireFormat::GetTableConfig), or 0.
+ * \param knownVersion
+ *      The version of the configuration the client already has, or 0.
+ * \param[out] tableConfig
+ *      Filled in with all of the table's tablets and indexes; left empty if
+ *      the table doesn't exist.
+ * \param[out] epoch
+ *      Filled in with the coordinator's epoch for \a tableConfig.
+ * \param[out] version
+ *      Filled in with the coordinator's version for \a tableConfig.
+ */
+void
+TableConfigCache::getTableConfig(uint64_t tableId, uint64_t knownEpoch,
+        uint64_t knownVersion, ProtoBuf::TableConfig* tableConfig,
+        uint64_t* epoch, uint64_t* version)
+{
+    uint64_t arrivalTime = Cycles::rdtsc();
+    Lock lock(mutex);
+    CachedConfig& cached = configs[tableId];
+    bool stale = (cached.fetchTime == 0) ||
+            (knownEpoch == cached.epoch && knownVersion >= cached.version) ||
+            (latestVersion != 0 && (latestEpoch != cached.epoch ||
+                                    latestVersion > cached.version));
+
+    // If a fetch started after this request arrived (another thread did it
+    // while we waited for the lock), its result is as fresh as the one we
+    // would get.
+    if (stale && cached.fetchTime < arrivalTime)
+        fetch(lock, tableId, &cached);
+
+    tableConfig->CopyFrom(cached.config);
+    *epoch = cached.epoch;
+    *version = cached.version;
+    if (cached.config.tablet_size() == 0)
+        configs.erase(tableId);
+}
+
+/**
+ * Record the configuration version that the coordinator reported with a
+ * server list update. Copies older than it will be fetched again the next
+ * time they are asked for.
+ *
+ * \param epoch
+ *      The coordinator's configuration epoch.
+ * \param version
+ *      The coordinator's configuration version when it sent the update.
+ */
+void
+TableConfigCache::setLatestVersion(uint64_t epoch, uint64_t version)
+{
+    Lock lock(mutex);
+    if (epoch == latestEpoch && version <= latestVersion)
+        return;
+    latestEpoch = epoch;
+    latestVersion = version;
+}
+
+/**
+ * Bring a copy of a table's configuration up to date with changes returned
+ * by GetTableConfigRpc::wait, in the same way as ObjectFinder does for its
+ * own copies.
+ *
+ * \param config
+ *      An earlier version of the configuration; modified to be the new
+ *      version.
+ * \param changes
+ *      The new configuration.
+ * \param incremental
+ *      True means \a changes only contains the tablets that have changed
+ *      since the earlier version; false means it contains all of them.
+ *      Either way it contains all of the indexes.
+ */
+void
+TableConfigCache::applyChanges(ProtoBuf::TableConfig* config,
+        const ProtoBuf::TableConfig& changes, bool incremental)
+{
+    // Tablets always partition the key hash space, so the old tablets
+    // that overlap changed ones are exactly those that no longer exist
+    // in that form.
+    ProtoBuf::TableConfig merged;
+    if (incremental) {
+        foreach (const ProtoBuf::TableConfig::Tablet& tablet,
+                config->tablet()) {
+            bool replaced = false;
+            foreach (const ProtoBuf::TableConfig::Tablet& changed,
+                    changes.tablet()) {
+                if (tablet.start_key_hash() <= changed.end_key_hash() &&
+                        changed.start_key_hash() <= tablet.end_key_hash()) {
+                    replaced = true;
+                    break;
+                }
+            }
+            if (!replaced)
+                *merged.add_tablet() = tablet;
+        }
+    }
+    foreach (const ProtoBuf::TableConfig::Tablet& changed, changes.tablet())
+        *merged.add_tablet() = changed;
+    *merged.mutable_index() = changes.index();
+    config->Swap(&merged);
+}
+
+/**
+ * Fetch the changes to a table's configuration from the coordinator.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param tableId
+ *      The table whose configuration is fetched.
+ * \param cached
+ *      This master's copy of the configuration; updated to the
+ *      coordinator's current version.
+ */
+void
+TableConfigCache::fetch(Lock& lock, uint64_t tableId, CachedConfig* cached)
+{
+    TEST_LOG("fetching table %lu after version %lu", tableId,
+            cached->version);
+    cached->fetchTime = Cycles::rdtsc();
+    ProtoBuf::TableConfig changes;
+    GetTableConfigRpc rpc(context, tableId, cached->epoch, cached->version);
+    bool incremental = rpc.wait(&changes, &cached->epoch, &cached->version);
+    applyChanges(&cached->config, changes, incremental);
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,113 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_TABLECONFIGCACHE_H
+#define RAMCLOUD_TABLECONFIGCACHE_H
+
+#include <mutex>
+#include <unordered_map>
+
+#include "Common.h"
+#include "TableConfig.pb.h"
+
+namespace RAMCloud {
+
+/**
+ * Copies of table configurations that a master hands out to clients in
+ * place of the coordinator (see MasterService::getTableConfig and
+ * ObjectFinder::enableMasterConfigFetches), so that client startup and the
+ * refetches that follow a crash are spread over the masters instead of all
+ * landing on the coordinator. The coordinator remains the source of truth:
+ * each copy is fetched from it (incrementally, once there is one) when it is
+ * first asked for, and again when it may be out of date. A copy may be out
+ * of date when
+ * - a client asks for a newer version than the copy (it already has that
+ *   much, and is presumably asking because its configuration led it to the
+ *   wrong master), or
+ * - the coordinator's configuration version, which it stamps on the server
+ *   list updates it pushes to this master (see setLatestVersion), has moved
+ *   past the copy.
+ * A client may still get a configuration that is slightly out of date, but
+ * that is no different from one it fetched from the coordinator a moment
+ * ago: the masters it names reject requests for tablets they don't own, and
+ * since each refetch returns something newer than the client had, it soon
+ * gets the coordinator's version.
+ *
+ * This class is thread-safe. Fetches from the coordinator are made with the
+ * lock held, so that many clients asking for the same table at once cause
+ * one fetch rather than one each.
+ */
+class TableConfigCache {
+  PUBLIC:
+    explicit TableConfigCache(Context* context);
+
+    void getTableConfig(uint64_t tableId, uint64_t knownEpoch,
+            uint64_t knownVersion, ProtoBuf::TableConfig* tableConfig,
+            uint64_t* epoch, uint64_t* version);
+    void setLatestVersion(uint64_t epoch, uint64_t version);
+
+  PRIVATE:
+    typedef std::unique_lock<std::mutex> Lock;
+
+    /**
+     * This master's copy of one table's configuration.
+     */
+    struct CachedConfig {
+        CachedConfig()
+            : epoch(0)
+            , version(0)
+            , fetchTime(0)
+            , config()
+        {}
+
+        /// The coordinator's epoch and version for #config, as returned
+        /// by GetTableConfigRpc::wait.
+        uint64_t epoch;
+        uint64_t version;
+
+        /// Cycles::rdtsc() when the latest fetch from the coordinator
+        /// started; 0 means the configuration hasn't been fetched yet.
+        uint64_t fetchTime;
+
+        /// All of the table's tablets and indexes.
+        ProtoBuf::TableConfig config;
+    };
+
+    static void applyChanges(ProtoBuf::TableConfig* config,
+            const ProtoBuf::TableConfig& changes, bool incremental);
+    void fetch(Lock& lock, uint64_t tableId, CachedConfig* cached);
+
+    /// Overall information about this server.
+    Context* context;
+
+    /// Protects all of the members below.
+    std::mutex mutex;
+
+    /// This master's copies, indexed by table id. Tables that turned out
+    /// not to exist are dropped again.
+    std::unordered_map<uint64_t, CachedConfig> configs;
+
+    /// The most recent configuration epoch and version the coordinator
+    /// reported with a server list update; see setLatestVersion.
+    uint64_t latestEpoch;
+    uint64_t latestVersion;
+
+    DISALLOW_COPY_AND_ASSIGN(TableConfigCache);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLECONFIGCACHE_H
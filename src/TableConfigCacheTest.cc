@@ -0,0 +1,178 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+#include "MockCluster.h"
+#include "RamCloud.h"
+#include "TableConfigCache.h"
+
+namespace RAMCloud {
+
+class TableConfigCacheTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    Tub<RamCloud> ramcloud;
+    TableConfigCache cache;
+    uint64_t tableId;
+    ProtoBuf::TableConfig config;
+    uint64_t epoch;
+    uint64_t version;
+
+    TableConfigCacheTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , ramcloud()
+        , cache(&context)
+        , tableId()
+        , config()
+        , epoch(0)
+        , version(0)
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+
+        ServerConfig serverConfig = ServerConfig::forTesting();
+        serverConfig.services = {WireFormat::MASTER_SERVICE,
+                                 WireFormat::ADMIN_SERVICE};
+        serverConfig.localLocator = "mock:host=master1";
+        cluster.addServer(serverConfig);
+        ramcloud.construct(&context, "mock:host=coordinator");
+        tableId = ramcloud->createTable("table1", 2);
+    }
+
+    /// Ask the cache for table1's configuration on behalf of a client
+    /// that has the given version of it.
+    void
+    get(uint64_t knownEpoch, uint64_t knownVersion)
+    {
+        config.Clear();
+        cache.getTableConfig(tableId, knownEpoch, knownVersion, &config,
+                &epoch, &version);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TableConfigCacheTest);
+};
+
+TEST_F(TableConfigCacheTest, getTableConfig_firstRequest) {
+    get(0, 0);
+    EXPECT_EQ("fetch: fetching table 1 after version 0", TestLog::get());
+    EXPECT_EQ(2, config.tablet_size());
+    EXPECT_NE(0U, epoch);
+
+    // A client with no configuration gets the copy.
+    TestLog::reset();
+    uint64_t firstVersion = version;
+    get(0, 0);
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(2, config.tablet_size());
+    EXPECT_EQ(firstVersion, version);
+}
+
+TEST_F(TableConfigCacheTest, getTableConfig_clientHasCopy) {
+    TableManager* tableManager = &cluster.coordinator->tableManager;
+    tableManager->splitTablet(tableId, 0xc000000000000000);
+    get(0, 0);
+    tableManager->splitTablet(tableId, 0xe000000000000000);
+
+    // Older than the copy: no fetch, even though the copy is out of date.
+    TestLog::reset();
+    uint64_t copyEpoch = epoch;
+    uint64_t copyVersion = version;
+    get(copyEpoch, copyVersion - 1);
+    EXPECT_EQ("", TestLog::get());
+    EXPECT_EQ(3, config.tablet_size());
+
+    // As new as the copy: fetch the changes, and merge them in.
+    get(copyEpoch, copyVersion);
+    EXPECT_EQ(format("fetch: fetching table 1 after version %lu",
+            copyVersion), TestLog::get());
+    EXPECT_EQ(4, config.tablet_size());
+    EXPECT_LT(copyVersion, version);
+
+    // A copy from another coordinator: no fetch.
+    TestLog::reset();
+    get(copyEpoch + 1, version);
+    EXPECT_EQ("", TestLog::get());
+}
+
+TEST_F(TableConfigCacheTest, getTableConfig_noSuchTable) {
+    cache.getTableConfig(99, 0, 0, &config, &epoch, &version);
+    EXPECT_EQ(0, config.tablet_size());
+    EXPECT_EQ(0U, cache.configs.count(99));
+}
+
+TEST_F(TableConfigCacheTest, setLatestVersion) {
+    get(0, 0);
+    uint64_t copyEpoch = epoch;
+    uint64_t copyVersion = version;
+
+    // Not newer than the copy.
+    TestLog::reset();
+    cache.setLatestVersion(copyEpoch, copyVersion);
+    get(0, 0);
+    EXPECT_EQ("", TestLog::get());
+
+    // Newer: the next request fetches.
+    cache.setLatestVersion(copyEpoch, copyVersion + 1);
+    get(0, 0);
+    EXPECT_EQ(format("fetch: fetching table 1 after version %lu",
+            copyVersion), TestLog::get());
+
+    // Older versions are ignored.
+    cache.setLatestVersion(copyEpoch, copyVersion);
+    EXPECT_EQ(copyVersion + 1, cache.latestVersion);
+
+    // A different epoch replaces the version.
+    cache.setLatestVersion(copyEpoch + 1, 1);
+    EXPECT_EQ(copyEpoch + 1, cache.latestEpoch);
+    EXPECT_EQ(1U, cache.latestVersion);
+}
+
+TEST_F(TableConfigCacheTest, applyChanges) {
+    ProtoBuf::TableConfig old;
+    for (uint64_t start = 0; start < 300; start += 100) {
+        ProtoBuf::TableConfig::Tablet& tablet = *old.add_tablet();
+        tablet.set_table_id(1);
+        tablet.set_start_key_hash(start);
+        tablet.set_end_key_hash(start + 99);
+        tablet.set_state(ProtoBuf::TableConfig::Tablet::NORMAL);
+        tablet.set_ctime_log_head_id(0);
+        tablet.set_ctime_log_head_offset(0);
+    }
+    old.add_index()->set_index_id(1);
+    ProtoBuf::TableConfig changes;
+    ProtoBuf::TableConfig::Tablet& merged = *changes.add_tablet();
+    merged = old.tablet(0);
+    merged.set_end_key_hash(199);
+    changes.add_index()->set_index_id(2);
+
+    ProtoBuf::TableConfig incremental(old);
+    TableConfigCache::applyChanges(&incremental, changes, true);
+    ASSERT_EQ(2, incremental.tablet_size());
+    EXPECT_EQ(200U, incremental.tablet(0).start_key_hash());
+    EXPECT_EQ(199U, incremental.tablet(1).end_key_hash());
+    ASSERT_EQ(1, incremental.index_size());
+    EXPECT_EQ(2U, incremental.index(0).index_id());
+
+    ProtoBuf::TableConfig full(old);
+    TableConfigCache::applyChanges(&full, changes, false);
+    ASSERT_EQ(1, full.tablet_size());
+    EXPECT_EQ(199U, full.tablet(0).end_key_hash());
+}
+
+}  // namespace RAMCloud
@@ -14,6 +14,7 @@
  */
 
 #include "TableEnumerator.h"
+#include "ObjectFinder.h"
 #include "ShortMacros.h"
 
 namespace RAMCloud {
@@ -31,19 +32,140 @@ namespace RAMCloud {
  *      and data. True means that the returned objects have
  *      been truncated so that the object data (normally the last
  *      field of the object) is omitted.
+ * \param filter
+ *      If not NULL, the masters only return the objects passing this
+ *      filter, and only the projected parts of their values (which is what
+ *      nextKeyAndData then returns as data). The filter is copied.
+ * \param logOrder
+ *      True means each master returns the objects in the order they are
+ *      in its log rather than in its hash table. That is much faster for
+ *      scanning whole tables, but weakens the guarantees of #next: objects
+ *      that are overwritten or moved around by the masters (e.g. by their
+ *      log cleaners) while the enumeration runs may be returned more than
+ *      once.
  */
 TableEnumerator::TableEnumerator(RamCloud& ramcloud,
                                 uint64_t tableId,
-                                bool keysOnly)
+                                bool keysOnly,
+                                const EnumerationFilter* filter,
+                                bool logOrder)
     : ramcloud(ramcloud)
     , tableId(tableId)
     , keysOnly(keysOnly)
+    , filter()
+    , logOrder(logOrder)
     , tabletStartHash(0)
+    , lastHash(~0UL)
     , done(false)
     , state()
     , objects()
     , nextOffset(0)
 {
+    if (filter != NULL)
+        this->filter.construct(*filter);
+}
+
+/**
+ * Constructor for TableEnumerator objects that enumerate only part of a
+ * table.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster to use for this
+ *      enumeration.
+ * \param cursor
+ *      The table and range of key hashes to enumerate; typically one of the
+ *      results of #split.
+ * \param keysOnly
+ *      False means that full objects are returned, containing both keys
+ *      and data. True means that the returned objects have
+ *      been truncated so that the object data (normally the last
+ *      field of the object) is omitted.
+ * \param filter
+ *      If not NULL, the masters only return the objects passing this
+ *      filter, and only the projected parts of their values (which is what
+ *      nextKeyAndData then returns as data). The filter is copied.
+ * \param logOrder
+ *      True means each master returns the objects in the order they are
+ *      in its log rather than in its hash table. That is much faster for
+ *      scanning whole tables, but weakens the guarantees of #next: objects
+ *      that are overwritten or moved around by the masters (e.g. by their
+ *      log cleaners) while the enumeration runs may be returned more than
+ *      once.
+ */
+TableEnumerator::TableEnumerator(RamCloud& ramcloud,
+                                const Cursor& cursor,
+                                bool keysOnly,
+                                const EnumerationFilter* filter,
+                                bool logOrder)
+    : ramcloud(ramcloud)
+    , tableId(cursor.tableId)
+    , keysOnly(keysOnly)
+    , filter()
+    , logOrder(logOrder)
+    , tabletStartHash(cursor.firstHash)
+    , lastHash(cursor.lastHash)
+    , done(false)
+    , state()
+    , objects()
+    , nextOffset(0)
+{
+    if (filter != NULL)
+        this->filter.construct(*filter);
+}
+
+/**
+ * Divide a table into cursors that can be enumerated independently, for
+ * example by different threads. Together the cursors cover the whole hash
+ * space of the table exactly once. Each cursor spans one or more whole
+ * tablets as of this call, so that each of them can be enumerated without
+ * contacting more masters than needed; if the tablets move or split later
+ * on, the cursors are still correct, since the masters only return the
+ * objects in the requested range.
+ *
+ * \param ramcloud
+ *      Overall information about the RAMCloud cluster.
+ * \param tableId
+ *      Identifier for the table to enumerate.
+ * \param maxCursors
+ *      Return at most this many cursors; contiguous tablets are grouped
+ *      together when the table has more tablets than this. Zero means one
+ *      cursor per tablet.
+ * \return
+ *      Cursors in increasing order of key hashes.
+ *
+ * \throw TableDoesntExistException
+ *      The coordinator has no record of the table.
+ */
+std::vector<TableEnumerator::Cursor>
+TableEnumerator::split(RamCloud& ramcloud, uint64_t tableId,
+                       uint32_t maxCursors)
+{
+    // Collect the last hash of each tablet. The tablet returned by the
+    // ObjectFinder may be invalidated by the next lookup, so copy it now.
+    std::vector<uint64_t> tabletEnds;
+    uint64_t hash = 0;
+    do {
+        TabletWithLocator* tablet =
+                ramcloud.clientContext->objectFinder->lookupTablet(tableId,
+                                                                   hash);
+        tabletEnds.push_back(tablet->tablet.endKeyHash);
+        hash = tablet->tablet.endKeyHash + 1;
+    } while (hash != 0);
+
+    size_t numTablets = tabletEnds.size();
+    size_t numCursors = numTablets;
+    if (maxCursors != 0 && maxCursors < numCursors)
+        numCursors = maxCursors;
+
+    std::vector<Cursor> cursors;
+    uint64_t firstHash = 0;
+    for (size_t i = 0; i < numCursors; i++) {
+        // Spread the tablets as evenly as possible over the cursors.
+        size_t lastTablet = (i + 1) * numTablets / numCursors - 1;
+        cursors.emplace_back(tableId, firstHash, tabletEnds[lastTablet]);
+        firstHash = tabletEnds[lastTablet] + 1;
+    }
+    return cursors;
 }
 
 /**
@@ -64,7 +186,8 @@ TableEnumerator::hasNext()
  * throughout the entire lifetime of the enumeration is guaranteed to
  * be returned exactly once.  Objects that are created after the enumeration
  * starts, or that are deleted before the enumeration completes, will be
- * returned either 0 or 1 time.
+ * returned either 0 or 1 time. (Enumerations in log order may return
+ * objects more often; see the constructor.)
  *
  * \param[out] size
  *      After a successful return, this field will hold the size of
@@ -133,7 +256,8 @@ TableEnumerator::nextObjectBlob(Buffer** buffer)
  * throughout the entire lifetime of the enumeration is guaranteed to
  * be returned exactly once.  Objects that are created after the enumeration
  * starts, or that are deleted before the enumeration completes, will be
- * returned either 0 or 1 time.
+ * returned either 0 or 1 time. (Enumerations in log order may return
+ * objects more often; see the constructor.)
  *
  * \param[out] keyLength
  *      After successful return, this field holds the size of the key in bytes.
@@ -183,12 +307,13 @@ TableEnumerator::requestMoreObjects()
     nextOffset = 0;
     while (true) {
         tabletStartHash = ramcloud.enumerateTable(tableId, keysOnly,
-                                            tabletStartHash, state, objects);
+                                            tabletStartHash, state, objects,
+                                            filter.get(), lastHash, logOrder);
         if (objects.size() > 0) {
             return;
         }
-        // End of table?
-        if (objects.size() == 0 && tabletStartHash == 0) {
+        // End of table (or of the range being enumerated)?
+        if (tabletStartHash == 0 || tabletStartHash > lastHash) {
             done = true;
             return;
         }
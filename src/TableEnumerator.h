@@ -17,6 +17,7 @@
 #define RAMCLOUD_TABLEENUMERATOR_H
 
 #include "RamCloud.h"
+#include "EnumerationFilter.h"
 #include "Object.h"
 
 namespace RAMCloud {
@@ -24,11 +25,41 @@ namespace RAMCloud {
 /**
  * This class provides the client-side interface for table enumeration;
  * each instance of this class can be used to enumerate the objects in
- * a single table.
+ * a single table, or in one range of key hashes of it (see #Cursor).
  */
 class TableEnumerator {
   public:
-    TableEnumerator(RamCloud& ramCloud, uint64_t tableId, bool keysOnly);
+    /**
+     * Identifies a range of key hashes in a table that can be enumerated
+     * independently of the rest of the table. Cursors are plain values, so
+     * they can be handed to other threads; each thread then enumerates its
+     * cursors with a TableEnumerator on its own RamCloud object.
+     */
+    struct Cursor {
+        Cursor(uint64_t tableId, uint64_t firstHash, uint64_t lastHash)
+            : tableId(tableId)
+            , firstHash(firstHash)
+            , lastHash(lastHash)
+        {}
+
+        /// The table to enumerate.
+        uint64_t tableId;
+
+        /// Smallest key hash in the range.
+        uint64_t firstHash;
+
+        /// Largest key hash in the range (inclusive).
+        uint64_t lastHash;
+    };
+
+    TableEnumerator(RamCloud& ramCloud, uint64_t tableId, bool keysOnly,
+                    const EnumerationFilter* filter = NULL,
+                    bool logOrder = false);
+    TableEnumerator(RamCloud& ramCloud, const Cursor& cursor, bool keysOnly,
+                    const EnumerationFilter* filter = NULL,
+                    bool logOrder = false);
+    static std::vector<Cursor> split(RamCloud& ramcloud, uint64_t tableId,
+                                     uint32_t maxCursors);
     bool hasNext();
     void next(uint32_t* size, const void** object);
     void nextObjectBlob(Buffer** buffer);
@@ -49,9 +80,20 @@ class TableEnumerator {
     /// field of the object) is omitted.
     bool keysOnly;
 
+    /// If constructed, only the objects passing this filter are returned,
+    /// with the projected parts of their values.
+    Tub<EnumerationFilter> filter;
+
+    /// True means the masters return objects in the order of their logs,
+    /// which is faster but may return objects more than once.
+    bool logOrder;
+
     /// The start hash of the tablet being enumerated.
     uint64_t tabletStartHash;
 
+    /// Objects with larger key hashes aren't enumerated.
+    uint64_t lastHash;
+
     /// Set to true when the entire enumeration has completed.
     bool done;
 
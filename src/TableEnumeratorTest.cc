@@ -48,6 +48,22 @@ class TableEnumeratorTest : public ::testing::Test {
         tableId1 = ramcloud.createTable("table1", 2);
     }
 
+    /// Return the keys \a iter enumerates, in order.
+    string
+    enumerateKeys(TableEnumerator& iter)
+    {
+        string result;
+        while (iter.hasNext()) {
+            uint32_t keyLength, dataLength;
+            const void* key;
+            const void* data;
+            iter.nextKeyAndData(&keyLength, &key, &dataLength, &data);
+            result += (result.empty() ? "" : " ") +
+                    string(static_cast<const char*>(key), keyLength);
+        }
+        return result;
+    }
+
     DISALLOW_COPY_AND_ASSIGN(TableEnumeratorTest);
 };
 
@@ -250,6 +266,115 @@ TEST_F(TableEnumeratorTest, keysOnly) {
     EXPECT_FALSE(iter.hasNext());
 }
 
+TEST_F(TableEnumeratorTest, filter) {
+    ramcloud.write(tableId1, "user:1", 6, "abcdef", 6);
+    ramcloud.write(tableId1, "user:2", 6, "cdefgh", 6);
+    ramcloud.write(tableId1, "user:3", 6, "efghij", 6);
+    ramcloud.write(tableId1, "item:4", 6, "ghijkl", 6);
+    ramcloud.write(tableId1, "user:5", 6, "z", 1);
+
+    EnumerationFilter filter;
+    filter.setKeyPrefix("user:", 5);
+    filter.addPredicate(0, EnumerationFilter::GREATER_OR_EQUAL, "c", 1);
+    filter.addProjection(1, 2);
+    TableEnumerator iter(ramcloud, tableId1, false, &filter);
+
+    // Objects come back in hash order.
+    std::set<string> results;
+    while (iter.hasNext()) {
+        uint32_t keyLength, dataLength;
+        const void* key;
+        const void* data;
+        iter.nextKeyAndData(&keyLength, &key, &dataLength, &data);
+        results.insert(string(static_cast<const char*>(key), keyLength) +
+                "=" + string(static_cast<const char*>(data), dataLength));
+    }
+    string result;
+    foreach (const string& entry, results)
+        result += (result.empty() ? "" : " ") + entry;
+    EXPECT_EQ("user:2=de user:3=fg user:5=", result);
+}
+
+TEST_F(TableEnumeratorTest, split) {
+    std::vector<TableEnumerator::Cursor> cursors =
+            TableEnumerator::split(ramcloud, tableId1, 0);
+    ASSERT_EQ(2U, cursors.size());
+    EXPECT_EQ(tableId1, cursors[0].tableId);
+    EXPECT_EQ(0U, cursors[0].firstHash);
+    EXPECT_EQ(cursors[0].lastHash + 1, cursors[1].firstHash);
+    EXPECT_EQ(~0UL, cursors[1].lastHash);
+
+    cursors = TableEnumerator::split(ramcloud, tableId1, 1);
+    ASSERT_EQ(1U, cursors.size());
+    EXPECT_EQ(0U, cursors[0].firstHash);
+    EXPECT_EQ(~0UL, cursors[0].lastHash);
+
+    EXPECT_THROW(TableEnumerator::split(ramcloud, tableId1 + 1, 0),
+                 TableDoesntExistException);
+}
+
+TEST_F(TableEnumeratorTest, cursor) {
+    ramcloud.write(tableId1, "0", 1, "abcdef", 6);
+    ramcloud.write(tableId1, "1", 1, "ghijkl", 6);
+    ramcloud.write(tableId1, "2", 1, "mnopqr", 6);
+    ramcloud.write(tableId1, "3", 1, "stuvwx", 6);
+    ramcloud.write(tableId1, "4", 1, "yzabcd", 6);
+
+    // Each cursor returns its own part of the table, in hash order.
+    string result;
+    foreach (const TableEnumerator::Cursor& cursor,
+            TableEnumerator::split(ramcloud, tableId1, 0)) {
+        TableEnumerator iter(ramcloud, cursor, true);
+        result += "[" + enumerateKeys(iter) + "]";
+    }
+    EXPECT_EQ("[0 4 2][1 3]", result);
+
+    // The range needn't line up with tablets; these hashes leave out
+    // "2" from the first tablet and "1" from the second.
+    TableEnumerator::Cursor cursor(tableId1, Key::getHash(tableId1, "4", 1),
+                                   Key::getHash(tableId1, "3", 1));
+    TableEnumerator iter(ramcloud, cursor, true);
+    EXPECT_EQ("0 4 3", enumerateKeys(iter));
+}
+
+TEST_F(TableEnumeratorTest, logOrder) {
+    ramcloud.write(tableId1, "4", 1, "abcdef", 6);
+    ramcloud.write(tableId1, "3", 1, "ghijkl", 6);
+    ramcloud.write(tableId1, "2", 1, "mnopqr", 6);
+    ramcloud.write(tableId1, "1", 1, "stuvwx", 6);
+    ramcloud.write(tableId1, "0", 1, "yzabcd", 6);
+
+    // Each tablet comes back in the order its objects were written
+    // (rather than "0 4 2 1 3" in hash table order).
+    TableEnumerator iter(ramcloud, tableId1, true, NULL, true);
+    EXPECT_EQ("4 2 0 3 1", enumerateKeys(iter));
+}
+
+TEST_F(TableEnumeratorTest, logOrder_rpcOverflow) {
+    uint32_t dataSize(1024 * 32);
+    char data[dataSize];
+    memset(data, 0, dataSize);
+    uint32_t totalObjects(600);
+    for (uint32_t i = 0; i < totalObjects; i++)
+        ramcloud.write(tableId1, &i, 4, data, dataSize);
+
+    // Resuming within a segment neither skips nor repeats objects.
+    std::vector<uint32_t> counts(totalObjects, 0);
+    TableEnumerator iter(ramcloud, tableId1, false, NULL, true);
+    while (iter.hasNext()) {
+        uint32_t size;
+        const void* buffer;
+        iter.next(&size, &buffer);
+        Object object(buffer, size);
+        ASSERT_EQ(4U, object.getKeyLength());
+        uint32_t key;
+        memcpy(&key, object.getKey(), 4);
+        ASSERT_LT(key, totalObjects);
+        counts[key]++;
+    }
+    EXPECT_EQ(std::vector<uint32_t>(totalObjects, 1), counts);
+}
+
 TEST_F(TableEnumeratorTest, nextKeyData) {
     uint64_t version0, version1, version2, version3, version4;
     ramcloud.write(tableId1, "0", 1, "abcdef", 6, NULL, &version0);
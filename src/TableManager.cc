@@ -13,6 +13,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <algorithm>
+
 #include "CoordinatorServerList.h"
 #include "CoordinatorService.h"
 #include "IndexKey.h"
@@ -42,6 +44,8 @@ TableManager::TableManager(Context* context,
     , directory()
     , idMap()
     , backingTableMap()
+    , configEpoch(generateRandom())
+    , configVersion(0)
 {
     context->tableManager = this;
 }
@@ -313,6 +317,9 @@ TableManager::createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
  *      creation.
  * \param serverId
  *      Id of the server on which to locate all tablets for this table.
+ * \param keyHash
+ *      Function used to hash the keys of the new table. Tables with ids
+ *      too large for Key::WYHASH get Key::MURMUR3 instead.
  *
  * \return
  *      Table id of the new table. If a table already exists with the
@@ -320,10 +327,10 @@ TableManager::createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
  */
 uint64_t
 TableManager::createTable(const char* name, uint32_t serverSpan,
-        ServerId serverId)
+        ServerId serverId, Key::HashFunction keyHash)
 {
     Lock lock(mutex);
-    return createTable(lock, name, serverSpan, serverId);
+    return createTable(lock, name, serverSpan, serverId, keyHash);
 }
 
 /**
@@ -409,6 +416,27 @@ TableManager::dropIndex(uint64_t tableId, uint8_t indexId)
     dropIndex(lock, tableId, indexId);
 }
 
+/**
+ * Return the current version of the tablet configuration, without acquiring
+ * the monitor lock. This lets CoordinatorServerList stamp server list updates
+ * with it (see TableConfigCache) while it holds its own lock; TableManager
+ * takes that lock while holding its own, so acquiring ours here could
+ * deadlock.
+ *
+ * \param[out] epoch
+ *      Filled in with #configEpoch.
+ * \param[out] version
+ *      Filled in with #configVersion. The configuration may change again at
+ *      any time, so this is only a lower bound on the version by the time
+ *      the caller looks at it.
+ */
+void
+TableManager::getConfigVersion(uint64_t* epoch, uint64_t* version)
+{
+    *epoch = configEpoch;
+    *version = configVersion;
+}
+
 /**
  * Return the tableId of the table with the given name.
  *
@@ -456,6 +484,27 @@ TableManager::getTablet(uint64_t tableId, uint64_t keyHash)
     return *findTablet(lock, table, keyHash);
 }
 
+/**
+ * Count the tablets that each server owns. This is used during crash
+ * recovery to steer recovered data toward the masters with the least
+ * data already.
+ *
+ * \return
+ *      Map from the id of each server that owns at least one tablet
+ *      (see ServerId::getId) to the number of tablets it owns.
+ */
+std::unordered_map<uint64_t, uint32_t>
+TableManager::getTabletCounts()
+{
+    Lock lock(mutex);
+    std::unordered_map<uint64_t, uint32_t> counts;
+    foreach (const IdMap::value_type& entry, idMap) {
+        foreach (Tablet* tablet, entry.second->tablets)
+            counts[tablet->serverId.getId()]++;
+    }
+    return counts;
+}
+
 /**
  * Return information about a indexlet (e.g., its key, tableId, indexId,
  * ServerId, and backingTableId), when given a backingTableId
@@ -602,6 +651,8 @@ TableManager::markAllTabletsRecovering(ServerId serverId)
         foreach (Tablet* tablet, table->tablets) {
             if (tablet->serverId == serverId) {
                 tablet->status = Tablet::RECOVERING;
+                tablet->recoveryMasterId = ServerId();
+                tabletChanged(lock, table, tablet);
                 results.push_back(*tablet);
             }
         }
@@ -669,6 +720,7 @@ TableManager::reassignTabletOwnership(
     tablet->ctime = headOfLogAtCreation;
     tablet->serverId = newOwner;
     tablet->status = Tablet::NORMAL;
+    tabletChanged(lock, table, tablet);
 
     // Record information about the new assignment in external storage,
     // in case we crash.
@@ -764,6 +816,63 @@ TableManager::recover(uint64_t lastCompletedUpdate)
     LOG(NOTICE, "Table recovery complete: %lu table(s)", directory.size());
 }
 
+/**
+ * Stop directing clients to a recovery master that was serving reads on
+ * demand (see setRecoveryMaster), because it gave up on its partition; the
+ * tablets stay RECOVERING until another recovery takes them on.
+ *
+ * \param recoveryMasterId
+ *      The recovery master that gave up.
+ */
+void
+TableManager::clearRecoveryMaster(ServerId recoveryMasterId)
+{
+    Lock lock(mutex);
+    for (Directory::iterator it = directory.begin(); it != directory.end();
+            ++it) {
+        Table* table = it->second;
+        foreach (Tablet* tablet, table->tablets) {
+            if (tablet->recoveryMasterId == recoveryMasterId) {
+                tablet->recoveryMasterId = ServerId();
+                tabletChanged(lock, table, tablet);
+            }
+        }
+    }
+}
+
+/**
+ * Record that a recovery master has started replaying a partition and
+ * serves reads for it on demand, so that serializeTableConfig directs
+ * clients to it rather than leaving them waiting until the whole
+ * partition is replayed.
+ *
+ * \param partition
+ *      The tablets the recovery master was given; the ones that are no
+ *      longer RECOVERING (or whose table no longer exists) are ignored.
+ * \param recoveryMasterId
+ *      The recovery master replaying \a partition.
+ */
+void
+TableManager::setRecoveryMaster(const ProtoBuf::RecoveryPartition& partition,
+        ServerId recoveryMasterId)
+{
+    Lock lock(mutex);
+    foreach (const ProtoBuf::Tablets::Tablet& entry, partition.tablet()) {
+        IdMap::iterator it = idMap.find(entry.table_id());
+        if (it == idMap.end())
+            continue;
+        Table* table = it->second;
+        Tablet* tablet = findTablet(lock, table, entry.start_key_hash());
+        if (tablet->status != Tablet::RECOVERING ||
+                tablet->startKeyHash != entry.start_key_hash() ||
+                tablet->endKeyHash != entry.end_key_hash()) {
+            continue;
+        }
+        tablet->recoveryMasterId = recoveryMasterId;
+        tabletChanged(lock, table, tablet);
+    }
+}
+
 /**
  * Fills in a protocol buffer with information describing which masters store
  * which pieces of data for a given table (including both tablets and indexes).
@@ -773,30 +882,62 @@ TableManager::recover(uint64_t lastCompletedUpdate)
  * \param tableId
  *      The id of the table whose configuration will be fetched. If
  *      the table doesn't exist, then the protocol buffer ends up empty.
+ * \param[in,out] epoch
+ *      If non-NULL, on entry the epoch that \a version came from (see
+ *      #configEpoch) and on return the current epoch.
+ * \param[in,out] version
+ *      If non-NULL, on entry the version of the table's configuration that
+ *      the caller already has (0 means none), and on return the current
+ *      version.
+ * \return
+ *      True means only the tablets that changed since the caller's version
+ *      were added to \a tableConfig (the indexes are always complete);
+ *      false means all of them were.
  */
-void
+bool
 TableManager::serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
-        uint64_t tableId)
+        uint64_t tableId, uint64_t* epoch, uint64_t* version)
 {
     Lock lock(mutex);
+    uint64_t knownVersion = 0;
+    if (epoch != NULL && version != NULL) {
+        if (*epoch == configEpoch && *version <= configVersion)
+            knownVersion = *version;
+        *epoch = configEpoch;
+        *version = configVersion;
+    }
     IdMap::iterator it = idMap.find(tableId);
     if (it == idMap.end())
-        return;
+        return false;
     Table* table = it->second;
 
     // filling tablets
     foreach (Tablet* tablet, table->tablets) {
+        if (knownVersion != 0) {
+            std::map<uint64_t, uint64_t>::iterator v =
+                    table->tabletVersions.find(tablet->startKeyHash);
+            if (v == table->tabletVersions.end() || v->second <= knownVersion)
+                continue;
+        }
         ProtoBuf::TableConfig::Tablet& entry(*tableConfig->add_tablet());
         tablet->serialize((ProtoBuf::Tablets::Tablet&)entry);
+        ServerId owner = tablet->serverId;
+        if (tablet->status == Tablet::RECOVERING &&
+                tablet->recoveryMasterId.isValid()) {
+            // The recovery master serves reads while it replays the tablet
+            // (it asks writers to retry), so clients may as well find it.
+            owner = tablet->recoveryMasterId;
+            entry.set_server_id(owner.getId());
+            entry.set_state(ProtoBuf::TableConfig::Tablet::NORMAL);
+        }
         try {
-            string locator = context->serverList->getLocator(
-                    tablet->serverId);
+            string locator = context->serverList->getLocator(owner);
             entry.set_service_locator(locator);
         } catch (const ServerListException& e) {
             RAMCLOUD_CLOG(NOTICE, "Server id (%s) in tablet map no longer "
                     "in server list; omitting locator for entry (tableName %s, "
                     "tableId %lu, startKeyHash 0x%lx)",
-                    tablet->serverId.toString().c_str(), table->name.c_str(),
+                    owner.toString().c_str(), table->name.c_str(),
                     tableId, tablet->startKeyHash);
         }
     }
@@ -870,7 +1011,48 @@ TableManager::splitTablet(const char* name, uint64_t splitKeyHash)
     Directory::iterator it = directory.find(name);
     if (it == directory.end())
         throw NoSuchTable(HERE);
-    Table* table = it->second;
+    splitTablet(lock, it->second, splitKeyHash);
+}
+
+/**
+ * Split a tablet into two disjoint tablets at a specific key hash; this is
+ * the same as the other splitTablet method, except that the table is
+ * identified by its id.
+ *
+ * \param tableId
+ *      Identifier of the table that contains the tablet to be split.
+ * \param splitKeyHash
+ *      Key hash to used to partition the tablet into two. Keys less than
+ *      \a splitKeyHash belong to one tablet, keys greater than or equal to
+ *      \a splitKeyHash belong to the other.
+ *
+ * \throw NoSuchTable
+ *      If tableId does not correspond to an existing table.
+ */
+void
+TableManager::splitTablet(uint64_t tableId, uint64_t splitKeyHash)
+{
+    Lock lock(mutex);
+    IdMap::iterator it = idMap.find(tableId);
+    if (it == idMap.end())
+        throw NoSuchTable(HERE);
+    splitTablet(lock, it->second, splitKeyHash);
+}
+
+/**
+ * Does the work of both splitTablet methods.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table containing the tablet to split.
+ * \param splitKeyHash
+ *      Key hash at which to split; see splitTablet.
+ */
+void
+TableManager::splitTablet(const Lock& lock, Table* table,
+        uint64_t splitKeyHash)
+{
     Tablet* tablet = findTablet(lock, table, splitKeyHash);
     if (splitKeyHash == tablet->startKeyHash)
         return;
@@ -886,6 +1068,8 @@ TableManager::splitTablet(const char* name, uint64_t splitKeyHash)
             tablet->endKeyHash, tablet->serverId, tablet->status,
             tablet->ctime));
     tablet->endKeyHash = splitKeyHash - 1;
+    tabletChanged(lock, table, tablet);
+    tabletChanged(lock, table, table->tablets.back());
 
     // Record information about the split in external storage, in case we
     // crash.
@@ -936,6 +1120,8 @@ TableManager::splitRecoveringTablet(uint64_t tableId, uint64_t splitKeyHash)
             tablet->endKeyHash, tablet->serverId, tablet->status,
             tablet->ctime));
     tablet->endKeyHash = splitKeyHash - 1;
+    tabletChanged(lock, table, tablet);
+    tabletChanged(lock, table, table->tablets.back());
 
     // No need to record anything in external storage right now. If
     // recovery completes successfully, the Table info will get written
@@ -971,33 +1157,70 @@ void
 TableManager::tabletRecovered(
         uint64_t tableId, uint64_t startKeyHash, uint64_t endKeyHash,
         ServerId serverId, LogPosition ctime)
+{
+    vector<Tablet> tablets;
+    tablets.emplace_back(tableId, startKeyHash, endKeyHash, serverId,
+            Tablet::NORMAL, ctime);
+    tabletsRecovered(tablets);
+}
+
+/**
+ * Invoked by MasterRecoveryManager after a recovery master has successfully
+ * recovered a group of tablets, to make it the owner of all of them. This
+ * is the same as invoking tabletRecovered for each tablet, except that
+ * each table involved is written to external storage just once, and all of
+ * them are written together.
+ *
+ * \param tablets
+ *      The tablets that were recovered: each must match the range of a
+ *      tablet in the tablet map, and its serverId and ctime are copied in.
+ * \throw NoSuchTablet
+ *      If one of the tablets isn't currently in the tablet map.
+ */
+void
+TableManager::tabletsRecovered(const vector<Tablet>& tablets)
 {
     Lock lock(mutex);
 
-    // Find the desired table and tablet.
-    IdMap::iterator it = idMap.find(tableId);
-    if (it == idMap.end())
-        throw NoSuchTablet(HERE);
-    Table* table = it->second;
-    Tablet* tablet = findTablet(lock, table, startKeyHash);
-    if ((tablet->startKeyHash != startKeyHash) ||
-            (tablet->endKeyHash != endKeyHash)) {
-        throw NoSuchTablet(HERE);
+    // Update in-memory data structures, remembering which tables changed.
+    vector<Table*> changedTables;
+    foreach (const Tablet& recovered, tablets) {
+        IdMap::iterator it = idMap.find(recovered.tableId);
+        if (it == idMap.end())
+            throw NoSuchTablet(HERE);
+        Table* table = it->second;
+        Tablet* tablet = findTablet(lock, table, recovered.startKeyHash);
+        if ((tablet->startKeyHash != recovered.startKeyHash) ||
+                (tablet->endKeyHash != recovered.endKeyHash)) {
+            throw NoSuchTablet(HERE);
+        }
+        tablet->serverId = recovered.serverId;
+        tablet->status = Tablet::NORMAL;
+        tablet->ctime = recovered.ctime;
+        tablet->recoveryMasterId = ServerId();
+        tabletChanged(lock, table, tablet);
+        if (std::find(changedTables.begin(), changedTables.end(), table)
+                == changedTables.end()) {
+            changedTables.push_back(table);
+        }
     }
 
-    // Update in-memory data structures.
-    tablet->serverId = serverId;
-    tablet->status = Tablet::NORMAL;
-    tablet->ctime = ctime;
-
-    // Record this update in external storage, in case we crash.  For this
+    // Record these updates in external storage, in case we crash.  For this
     // operation there is nothing to "complete" after crash recovery other
     // than restoring the table metadata, so the sequence number is set to
     // zero. THIS IS A BUG: see RAM-548.
-    ProtoBuf::Table externalInfo;
-    serializeTable(lock, table, &externalInfo);
-    externalInfo.set_sequence_number(0);
-    syncTable(lock, table, &externalInfo);
+    vector<ExternalStorage::Write> writes;
+    foreach (Table* table, changedTables) {
+        ProtoBuf::Table externalInfo;
+        serializeTable(lock, table, &externalInfo);
+        externalInfo.set_sequence_number(0);
+        string objectName("tables/");
+        objectName.append(table->name);
+        string str;
+        externalInfo.SerializeToString(&str);
+        writes.emplace_back(ExternalStorage::UPDATE, objectName.c_str(), str);
+    }
+    context->externalStorage->setMultiple(writes);
 }
 
 /**
@@ -1012,6 +1235,9 @@ TableManager::tabletRecovered(
  *      creation.
  * \param serverId
  *      Id of the server on which to locate all tablets for this table.
+ * \param keyHash
+ *      Function used to hash the keys of the new table. Tables with ids
+ *      too large for Key::WYHASH get Key::MURMUR3 instead.
  *
  * \return
  *      Table id of the new table. If a table already exists with the
@@ -1019,7 +1245,7 @@ TableManager::tabletRecovered(
  */
 uint64_t
 TableManager::createTable(const Lock& lock, const char* name,
-        uint32_t serverSpan, ServerId serverId)
+        uint32_t serverSpan, ServerId serverId, Key::HashFunction keyHash)
 {
     // See if the desired table already exists.
     Directory::iterator it = directory.find(name);
@@ -1029,6 +1255,10 @@ TableManager::createTable(const Lock& lock, const char* name,
 
     ++nextTableId;
     LOG(NOTICE, "Creating table '%s' with id %lu", name, tableId);
+    if (!Key::setHashFunction(tableId, keyHash)) {
+        LOG(WARNING, "Table id %lu is too large for the requested key hash "
+                "function; using MurmurHash3 for table '%s'", tableId, name);
+    }
 
     if (serverSpan == 0)
         serverSpan = 1;
@@ -1273,7 +1503,9 @@ TableManager::findTablet(const Lock& lock, Table* table, uint64_t keyHash)
 /**
  * This method is invoked as part of creating a new table: it sends
  * an RPC to each of the masters storing a tablet for this table, so they
- * know that they are now responsible.
+ * know that they are now responsible. All of the RPCs are sent before
+ * waiting for any of them, so a table spread over many masters is created
+ * in about the time the slowest master takes to respond.
  *
  * \param lock
  *      Ensures that the caller holds the monitor lock; not actually used.
@@ -1283,14 +1515,21 @@ TableManager::findTablet(const Lock& lock, Table* table, uint64_t keyHash)
 void
 TableManager::notifyCreate(const Lock& lock, Table* table)
 {
-    foreach (Tablet* tablet, table->tablets) {
+    size_t numTablets = table->tablets.size();
+    std::vector<Tub<TakeTabletOwnershipRpc>> rpcs(numTablets);
+    for (size_t i = 0; i < numTablets; i++) {
+        Tablet* tablet = table->tablets[i];
+        LOG(NOTICE, "Assigning table id %lu, key hashes 0x%lx-0x%lx, to "
+                "master %s",
+                table->id, tablet->startKeyHash, tablet->endKeyHash,
+                tablet->serverId.toString().c_str());
+        rpcs[i].construct(context, tablet->serverId, tablet->tableId,
+                tablet->startKeyHash, tablet->endKeyHash);
+    }
+    for (size_t i = 0; i < numTablets; i++) {
+        Tablet* tablet = table->tablets[i];
         try {
-            LOG(NOTICE, "Assigning table id %lu, key hashes 0x%lx-0x%lx, to "
-                    "master %s",
-                    table->id, tablet->startKeyHash, tablet->endKeyHash,
-                    tablet->serverId.toString().c_str());
-            MasterClient::takeTabletOwnership(context, tablet->serverId,
-                    tablet->tableId, tablet->startKeyHash, tablet->endKeyHash);
+            rpcs[i]->wait();
         } catch (ServerNotUpException& e) {
             // The master is apparently crashed. In that case, we can just
             // ignore this master; this tablet will be reinstated elsewhere
@@ -1351,26 +1590,33 @@ TableManager::notifyCreateIndex(const Lock& lock, Index* index)
 void
 TableManager::notifyDropTable(const Lock& lock, ProtoBuf::Table* info)
 {
-    // Notify all of the masters storing tablets for the table.
+    // Notify all of the masters storing tablets for the table, in parallel
+    // (see notifyCreate).
     int numTablets = info->tablet_size();
+    std::vector<Tub<DropTabletOwnershipRpc>> rpcs(numTablets);
     for (int i = 0; i < numTablets; i++) {
         const ProtoBuf::Table::Tablet& tablet = info->tablet(i);
         ServerId serverId(tablet.server_id());
+        LOG(NOTICE, "Requesting master %s to drop table id %lu, "
+                "key hashes 0x%lx-0x%lx",
+                serverId.toString().c_str(), info->id(),
+                tablet.start_key_hash(), tablet.end_key_hash());
+        rpcs[i].construct(context, serverId, info->id(),
+                tablet.start_key_hash(), tablet.end_key_hash());
+    }
+    for (int i = 0; i < numTablets; i++) {
+        const ProtoBuf::Table::Tablet& tablet = info->tablet(i);
         try {
-            LOG(NOTICE, "Requesting master %s to drop table id %lu, "
-                    "key hashes 0x%lx-0x%lx",
-                    serverId.toString().c_str(), info->id(),
-                    tablet.start_key_hash(), tablet.end_key_hash());
-            MasterClient::dropTabletOwnership(context, serverId,
-                    info->id(), tablet.start_key_hash(), tablet.end_key_hash());
+            rpcs[i]->wait();
         } catch (ServerNotUpException& e) {
             // The master has apparently crashed. This is benign (a dead
             // master can't continue serving the tablet), but log a message
             // anyway.
             LOG(NOTICE, "dropTabletOwnership skipped for master %s (table %lu, "
                     "key hashes 0x%lx-0x%lx) because server isn't running",
-                    serverId.toString().c_str(), info->id(),
-                    tablet.start_key_hash(), tablet.end_key_hash());
+                    ServerId(tablet.server_id()).toString().c_str(),
+                    info->id(), tablet.start_key_hash(),
+                    tablet.end_key_hash());
         }
     }
 
@@ -1565,6 +1811,7 @@ TableManager::recreateTable(const Lock& lock, ProtoBuf::Table* info)
                 name.c_str(), id));
     }
 
+    Key::setHashFunction(id, Key::HashFunction(info->key_hash()));
     Table* table = new Table(name.c_str(), id);
     int numTablets = info->tablet_size();
     for (int i = 0; i < numTablets; i++) {
@@ -1617,6 +1864,9 @@ TableManager::serializeTable(const Lock& lock, Table* table,
 {
     externalInfo->set_name(table->name);
     externalInfo->set_id(table->id);
+    Key::HashFunction keyHash = Key::getHashFunction(table->id);
+    if (keyHash != Key::MURMUR3)
+        externalInfo->set_key_hash(keyHash);
     foreach (Tablet* tablet, table->tablets) {
         ProtoBuf::Table::Tablet* externalTablet(externalInfo->add_tablet());
         externalTablet->set_start_key_hash(tablet->startKeyHash);
@@ -1676,6 +1926,24 @@ TableManager::syncTable(const Lock& lock, Table* table,
             downCast<int>(str.length()));
 }
 
+/**
+ * Record that a tablet's range, owner, or status has changed, so that
+ * serializeTableConfig includes it for clients whose copy of the table's
+ * configuration is older.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ * \param table
+ *      Table containing the tablet.
+ * \param tablet
+ *      The tablet that changed.
+ */
+void
+TableManager::tabletChanged(const Lock& lock, Table* table, Tablet* tablet)
+{
+    table->tabletVersions[tablet->startKeyHash] = ++configVersion;
+}
+
 /**
  * Add a new tablet to the information stored for particular table.
  * This method is intended only for testing and is not safe to use
@@ -1694,6 +1962,7 @@ TableManager::testAddTablet(const Tablet& tablet)
         throw FatalError(HERE, "table doesn't exist");
     Table* table = it->second;
     table->tablets.push_back(new Tablet(tablet));
+    tabletChanged(lock, table, table->tablets.back());
 }
 
 /**
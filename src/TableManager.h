@@ -16,11 +16,16 @@
 #ifndef RAMCLOUD_TABLEMANAGER_H
 #define RAMCLOUD_TABLEMANAGER_H
 
+#include <atomic>
+#include <map>
 #include <mutex>
+#include <unordered_map>
 
 #include "Common.h"
 #include "CoordinatorUpdateManager.h"
+#include "Key.h"
 #include "ServerId.h"
+#include "RecoveryPartition.pb.h"
 #include "Table.pb.h"
 #include "Tablet.h"
 #include "TableConfig.pb.h"
@@ -71,12 +76,15 @@ class TableManager {
     void createIndex(uint64_t tableId, uint8_t indexId, uint8_t indexType,
             uint8_t numIndexlets);
     uint64_t createTable(const char* name, uint32_t serverSpan,
-            ServerId serverId = ServerId());
+            ServerId serverId = ServerId(),
+            Key::HashFunction keyHash = Key::MURMUR3);
     string debugString(bool shortForm = false);
     void dropIndex(uint64_t tableId, uint8_t indexId);
     void dropTable(const char* name);
+    void getConfigVersion(uint64_t* epoch, uint64_t* version);
     uint64_t getTableId(const char* name);
     Tablet getTablet(uint64_t tableId, uint64_t keyHash);
+    std::unordered_map<uint64_t, uint32_t> getTabletCounts();
     bool getIndexletInfoByBackingTableId(uint64_t backingTableId,
             ProtoBuf::Indexlet& indexletInfo);
     void indexletRecovered(uint64_t tableId, uint8_t indexId,
@@ -89,12 +97,18 @@ class TableManager {
             uint64_t startKeyHash, uint64_t endKeyHash,
             uint64_t ctimeSegmentId, uint64_t ctimeSegmentOffset);
     void recover(uint64_t lastCompletedUpdate);
-    void serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
-            uint64_t tableId);
+    void clearRecoveryMaster(ServerId recoveryMasterId);
+    void setRecoveryMaster(const ProtoBuf::RecoveryPartition& partition,
+            ServerId recoveryMasterId);
+    bool serializeTableConfig(ProtoBuf::TableConfig* tableConfig,
+            uint64_t tableId, uint64_t* epoch = NULL,
+            uint64_t* version = NULL);
     void splitTablet(const char* name, uint64_t splitKeyHash);
+    void splitTablet(uint64_t tableId, uint64_t splitKeyHash);
     void splitRecoveringTablet(uint64_t tableId, uint64_t splitKeyHash);
     void tabletRecovered(uint64_t tableId, uint64_t startKeyHash,
             uint64_t endKeyHash, ServerId serverId, LogPosition ctime);
+    void tabletsRecovered(const vector<Tablet>& tablets);
 
   PRIVATE:
     /**
@@ -186,6 +200,7 @@ class TableManager {
             , id(id)
             , tablets()
             , indexMap()
+            , tabletVersions()
         {}
         ~Table();
 
@@ -202,6 +217,13 @@ class TableManager {
         /// Information about each of the indexes in the table. The
         /// entries are allocated and freed dynamically.
         IndexMap indexMap;
+
+        /// Maps from a tablet's startKeyHash to the value of
+        /// TableManager::configVersion when the tablet last changed (see
+        /// tabletChanged). Tablets without an entry haven't changed since
+        /// the table was created (or recovered by this coordinator), so
+        /// every client that has the table's configuration knows them.
+        std::map<uint64_t, uint64_t> tabletVersions;
     };
 
     /**
@@ -241,8 +263,21 @@ class TableManager {
     typedef std::unordered_map<uint64_t, Indexlet*> IndexletTableMap;
     IndexletTableMap backingTableMap;
 
+    /// Distinguishes the values of configVersion used by this instance
+    /// from those a previous coordinator handed out. Random, and fixed
+    /// for the life of the TableManager.
+    const uint64_t configEpoch;
+
+    /// Incremented every time a tablet changes (e.g., is split, moves,
+    /// or starts recovery), so clients can fetch only the tablets that
+    /// changed since the version they have; see serializeTableConfig.
+    /// Only modified with the monitor lock held, but atomic so that
+    /// getConfigVersion can read it without the lock.
+    std::atomic<uint64_t> configVersion;
+
     uint64_t createTable(const Lock& lock, const char* name,
-            uint32_t serverSpan, ServerId serverId = ServerId());
+            uint32_t serverSpan, ServerId serverId = ServerId(),
+            Key::HashFunction keyHash = Key::MURMUR3);
     void dropIndex(const Lock& lock, uint64_t tableId, uint8_t indexId);
     void dropTable(const Lock& lock, const char* name);
     TableManager::Indexlet* findIndexlet(const Lock& lock, Index* index,
@@ -258,7 +293,9 @@ class TableManager {
     Table* recreateTable(const Lock& lock, ProtoBuf::Table* info);
     void serializeTable(const Lock& lock, Table* table,
             ProtoBuf::Table* externalInfo);
+    void splitTablet(const Lock& lock, Table* table, uint64_t splitKeyHash);
     void syncNextTableId(const Lock& lock);
+    void tabletChanged(const Lock& lock, Table* table, Tablet* tablet);
     void syncTable(const Lock& lock, Table* table,
             ProtoBuf::Table* externalInfo);
     void testAddTablet(const Tablet& tablet);
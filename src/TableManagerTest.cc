@@ -303,6 +303,19 @@ TEST_F(TableManagerTest, createTable_givenServerId) {
     EXPECT_EQ(0U, master4->tabletManager.getNumTablets());
 }
 
+TEST_F(TableManagerTest, createTable_keyHash) {
+    cluster.addServer(masterConfig);
+    EXPECT_EQ(1U, tableManager->createTable("foo", 1, ServerId(),
+            Key::WYHASH));
+    EXPECT_EQ(Key::WYHASH, Key::getHashFunction(1));
+
+    ProtoBuf::TableConfig tableConfig;
+    tableManager->serializeTableConfig(&tableConfig, 1);
+    ASSERT_EQ(1, tableConfig.tablet_size());
+    EXPECT_EQ(uint32_t(Key::WYHASH), tableConfig.tablet(0).key_hash());
+    Key::setHashFunction(1, Key::MURMUR3);
+}
+
 TEST_F(TableManagerTest, dropTable_basics) {
     MasterService* master1 = cluster.addServer(masterConfig)->master.get();
     MasterService* master2 = cluster.addServer(masterConfig)->master.get();
@@ -371,6 +384,19 @@ TEST_F(TableManagerTest, getTableId) {
     EXPECT_THROW(tableManager->getTableId("bar"), TableManager::NoSuchTable);
 }
 
+TEST_F(TableManagerTest, getTabletCounts) {
+    cluster.addServer(masterConfig);
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 3, ServerId(1, 0));
+    tableManager->createTable("bar", 1, ServerId(2, 0));
+
+    std::unordered_map<uint64_t, uint32_t> counts =
+        tableManager->getTabletCounts();
+    EXPECT_EQ(2u, counts.size());
+    EXPECT_EQ(3u, counts[ServerId(1, 0).getId()]);
+    EXPECT_EQ(1u, counts[ServerId(2, 0).getId()]);
+}
+
 TEST_F(TableManagerTest, getIndexletInfoByBackingTableId) {
     cluster.addServer(masterConfig);
     cluster.addServer(masterConfig);
@@ -749,6 +775,96 @@ TEST_F(TableManagerTest, serializeTabletConfig) {
             TestLog::get());
 }
 
+TEST_F(TableManagerTest, getConfigVersion) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 1);
+    uint64_t epoch = 0, version = 0;
+    tableManager->getConfigVersion(&epoch, &version);
+    EXPECT_NE(0U, epoch);
+    EXPECT_EQ(0U, version);
+
+    tableManager->splitTablet("foo", 0x1000);
+    tableManager->getConfigVersion(&epoch, &version);
+    EXPECT_EQ(2U, version);
+}
+
+TEST_F(TableManagerTest, serializeTableConfig_incremental) {
+    cluster.addServer(masterConfig);
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    uint64_t epoch = 0;
+    uint64_t version = 0;
+
+    // No version known: everything.
+    ProtoBuf::TableConfig tableConfig;
+    EXPECT_FALSE(tableManager->serializeTableConfig(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(2, tableConfig.tablet_size());
+    EXPECT_NE(0U, epoch);
+
+    // Only the two halves of the split tablet changed.
+    tableManager->splitTablet("foo", 0x1000);
+    tableConfig.Clear();
+    uint64_t oldVersion = version;
+    EXPECT_TRUE(tableManager->serializeTableConfig(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_LT(oldVersion, version);
+    ASSERT_EQ(2, tableConfig.tablet_size());
+    EXPECT_EQ(0U, tableConfig.tablet(0).start_key_hash());
+    EXPECT_EQ(0xfffU, tableConfig.tablet(0).end_key_hash());
+    EXPECT_EQ(0x1000U, tableConfig.tablet(1).start_key_hash());
+
+    // Nothing changed since.
+    tableConfig.Clear();
+    EXPECT_TRUE(tableManager->serializeTableConfig(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(0, tableConfig.tablet_size());
+
+    // A version from a different coordinator: everything.
+    epoch++;
+    EXPECT_FALSE(tableManager->serializeTableConfig(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(3, tableConfig.tablet_size());
+
+    // A version newer than ours: everything.
+    tableConfig.Clear();
+    version += 10;
+    EXPECT_FALSE(tableManager->serializeTableConfig(&tableConfig, 1,
+            &epoch, &version));
+    EXPECT_EQ(3, tableConfig.tablet_size());
+}
+
+TEST_F(TableManagerTest, serializeTableConfig_recoveryMaster) {
+    cluster.addServer(masterConfig);
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    vector<Tablet> tablets = tableManager->markAllTabletsRecovering(
+            ServerId(1));
+    ProtoBuf::RecoveryPartition partition;
+    foreach (const Tablet& tablet, tablets)
+        tablet.serialize(*partition.add_tablet());
+
+    // While the recovery master replays, clients are sent to it.
+    tableManager->setRecoveryMaster(partition, ServerId(2));
+    ProtoBuf::TableConfig tableConfig;
+    tableManager->serializeTableConfig(&tableConfig, 1);
+    ASSERT_EQ(2, tableConfig.tablet_size());
+    EXPECT_EQ(2U, tableConfig.tablet(0).server_id());
+    EXPECT_EQ(ProtoBuf::TableConfig::Tablet::NORMAL,
+              tableConfig.tablet(0).state());
+    EXPECT_EQ("mock:host=server1", tableConfig.tablet(0).service_locator());
+    EXPECT_EQ(ServerId(1), tableManager->getTablet(1, 0).serverId);
+    EXPECT_EQ(Tablet::RECOVERING, tableManager->getTablet(1, 0).status);
+
+    // Once it gives up, clients wait for the tablet to be recovered again.
+    tableManager->clearRecoveryMaster(ServerId(2));
+    tableConfig.Clear();
+    tableManager->serializeTableConfig(&tableConfig, 1);
+    EXPECT_EQ(1U, tableConfig.tablet(0).server_id());
+    EXPECT_EQ(ProtoBuf::TableConfig::Tablet::RECOVERING,
+              tableConfig.tablet(0).state());
+}
+
 TEST_F(TableManagerTest, serializeIndexConfig) {
     cluster.addServer(masterConfig);
     cluster.addServer(masterConfig);
@@ -934,6 +1050,18 @@ TEST_F(TableManagerTest, splitTablet_tabletRecovering) {
             RetryException);
 }
 
+TEST_F(TableManagerTest, splitTablet_byId) {
+    cluster.addServer(masterConfig);
+    uint64_t tableId = tableManager->createTable("foo", 1);
+
+    tableManager->splitTablet(tableId, 0x1000);
+    EXPECT_EQ("{ foo(id 1): { 0x0-0xfff on 1.0 } "
+            "{ 0x1000-0xffffffffffffffff on 1.0 } }",
+            tableManager->debugString(true));
+    EXPECT_THROW(tableManager->splitTablet(99LU, 0x800),
+            TableManager::NoSuchTable);
+}
+
 TEST_F(TableManagerTest, splitRecoveringTablet_splitAlreadyExists) {
     cluster.addServer(masterConfig);
     uint64_t tableId = tableManager->createTable("foo", 2);
@@ -1002,6 +1130,35 @@ TEST_F(TableManagerTest, tabletRecovered_noSuchTablet) {
             serverId, ctime));
 }
 
+TEST_F(TableManagerTest, tabletsRecovered) {
+    cluster.addServer(masterConfig);
+    tableManager->createTable("foo", 2);
+    tableManager->createTable("bar", 1);
+    tableManager->directory["foo"]->tablets[0]->status = Tablet::RECOVERING;
+    tableManager->directory["foo"]->tablets[1]->status = Tablet::RECOVERING;
+    tableManager->directory["bar"]->tablets[0]->status = Tablet::RECOVERING;
+    cluster.externalStorage.log.clear();
+
+    ServerId serverId(5, 0);
+    LogPosition ctime(10, 11);
+    vector<Tablet> tablets;
+    tablets.emplace_back(1, 0, 0x7fffffffffffffff, serverId,
+            Tablet::NORMAL, ctime);
+    tablets.emplace_back(2, 0, 0xffffffffffffffff, serverId,
+            Tablet::NORMAL, ctime);
+    tablets.emplace_back(1, 0x8000000000000000, 0xffffffffffffffff,
+            serverId, Tablet::NORMAL, ctime);
+    tableManager->tabletsRecovered(tablets);
+
+    // Each table is written just once.
+    EXPECT_EQ("set(UPDATE, tables/foo); set(UPDATE, tables/bar)",
+            cluster.externalStorage.log);
+    EXPECT_EQ("{ foo(id 1): { 0x0-0x7fffffffffffffff on 5.0 } "
+            "{ 0x8000000000000000-0xffffffffffffffff on 5.0 } } "
+            "{ bar(id 2): { 0x0-0xffffffffffffffff on 5.0 } }",
+            tableManager->debugString(true));
+}
+
 TEST_F(TableManagerTest, findIndexlet) {
     TableManager::Index index(1, 1, 1);
     index.indexlets.push_back(new TableManager::Indexlet(
@@ -1047,7 +1204,8 @@ TEST_F(TableManagerTest, findTablet) {
 
 TEST_F(TableManagerTest, notifyCreate) {
     // Create a table with 4 tablets, using 2 real masters and one
-    // nonexistent master.
+    // nonexistent master. All of the RPCs are sent before any of them
+    // is waited for.
     MasterService* master1 = cluster.addServer(masterConfig)->master.get();
     MasterService* master2 = cluster.addServer(masterConfig)->master.get();
     TableManager::Table table("test", 111);
@@ -1071,11 +1229,11 @@ TEST_F(TableManagerTest, notifyCreate) {
             "key hashes 0x200-0x300, to master 2.0 | "
             "notifyCreate: Assigning table id 111, "
             "key hashes 0x400-0x500, to master 6.2 | "
+            "notifyCreate: Assigning table id 111, "
+            "key hashes 0x600-0x700, to master 2.0 | "
             "notifyCreate: takeTabletOwnership skipped for master 6.2 "
             "(table 111, key hashes 0x400-0x500) because server "
-            "isn't running | "
-            "notifyCreate: Assigning table id 111, "
-            "key hashes 0x600-0x700, to master 2.0",
+            "isn't running",
             TestLog::get());
 }
 
@@ -0,0 +1,269 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "TableSnapshot.h"
+#include "Object.h"
+#include "ObjectManager.h"
+#include "WallTime.h"
+
+namespace RAMCloud {
+
+/**
+ * Take a snapshot of a table. Writes made after this returns are not part
+ * of it; writes made before are.
+ *
+ * \param objectManager
+ *      The ObjectManager storing the table on this master.
+ * \param tableId
+ *      Identifier of the table. Only the tablets of it this master owns now
+ *      are part of the snapshot.
+ * \param firstKeyHash
+ *      Objects whose key hashes are smaller than this are left out.
+ * \param lastKeyHash
+ *      Objects whose key hashes are larger than this are left out.
+ */
+TableSnapshot::TableSnapshot(ObjectManager* objectManager, uint64_t tableId,
+        uint64_t firstKeyHash, uint64_t lastKeyHash)
+    : objectManager(objectManager)
+    , tableId(tableId)
+    , tablets()
+    , timestamp(WallTime::secondsTimestamp())
+    , activity()
+    , segments()
+    , nextSegment(0)
+    , iterator()
+    , candidates()
+    , candidateIndex()
+    , nextCandidate(0)
+{
+    vector<TabletManager::Tablet> allTablets;
+    objectManager->tabletManager->getTablets(&allTablets);
+    foreach (TabletManager::Tablet& tablet, allTablets) {
+        if (tablet.tableId != tableId || tablet.endKeyHash < firstKeyHash ||
+                tablet.startKeyHash > lastKeyHash)
+            continue;
+        tablet.startKeyHash = std::max(tablet.startKeyHash, firstKeyHash);
+        tablet.endKeyHash = std::min(tablet.endKeyHash, lastKeyHash);
+        tablets.push_back(tablet);
+    }
+
+    // The activity must be started first: a cleaned segment is only freed
+    // once every activity that started before it was cleaned has stopped,
+    // so none of the segments listed below can go away underneath us.
+    activity.start();
+    objectManager->log.rollHeadOver(&segments);
+}
+
+TableSnapshot::~TableSnapshot()
+{
+    activity.stop();
+}
+
+/**
+ * Return more objects of the table as they were when the snapshot was
+ * taken. Each object is preceded by its length as a uint32_t, just as
+ * enumeration returns them, and compressed values are expanded.
+ *
+ * While the snapshot's segments are still being read, a call may return
+ * without any objects at all; this keeps the time each call takes bounded.
+ *
+ * \param[out] buffer
+ *      Objects are appended to this buffer.
+ * \param maxBytes
+ *      Stop before \a buffer would grow beyond this many bytes, except that
+ *      at least one object is returned by calls that return any.
+ * \return
+ *      True if there is more to read and next() should be called again;
+ *      false once the whole table has been returned.
+ */
+bool
+TableSnapshot::next(Buffer* buffer, uint32_t maxBytes)
+{
+    if (nextSegment < segments.size()) {
+        scan(SCAN_ENTRIES_PER_CALL);
+        if (nextSegment < segments.size())
+            return true;
+    }
+
+    uint32_t startingSize = buffer->size();
+    while (nextCandidate < candidates.size()) {
+        uint32_t limit = (buffer->size() == startingSize) ? ~0u : maxBytes;
+        if (!appendCandidate(candidates[nextCandidate], buffer, limit))
+            return true;
+        nextCandidate++;
+    }
+    return false;
+}
+
+/**
+ * Returns true if the snapshot covers objects with the given key hash.
+ */
+bool
+TableSnapshot::ownsKeyHash(KeyHash keyHash)
+{
+    foreach (TabletManager::Tablet& tablet, tablets) {
+        if (keyHash >= tablet.startKeyHash && keyHash <= tablet.endKeyHash)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Find the candidate for a key, creating one if this is the first entry seen
+ * for it.
+ *
+ * \param key
+ *      Key of the entry.
+ * \param reference
+ *      Reference to the entry holding \a key.
+ */
+TableSnapshot::Candidate*
+TableSnapshot::findCandidate(Key& key, uint64_t reference)
+{
+    KeyHash keyHash = key.getHash();
+    auto range = candidateIndex.equal_range(keyHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        Candidate& candidate = candidates[it->second];
+        Buffer buffer;
+        LogEntryType type = objectManager->log.getEntry(
+                Log::Reference(candidate.keyReference), buffer);
+        Key other(type, buffer);
+        if (other == key)
+            return &candidate;
+    }
+    candidateIndex.insert({keyHash, candidates.size()});
+    candidates.emplace_back(reference);
+    return &candidates.back();
+}
+
+/**
+ * Read more entries from the snapshot's segments and record what they say
+ * about the table's keys, the way recovery replays a log: the newest object
+ * version wins unless a tombstone deletes it or a newer version.
+ *
+ * \param maxEntries
+ *      Return after examining this many entries, even if not all segments
+ *      have been read yet.
+ */
+void
+TableSnapshot::scan(uint32_t maxEntries)
+{
+    uint32_t entries = 0;
+    while (nextSegment < segments.size() && entries < maxEntries) {
+        if (!iterator)
+            iterator.construct(*segments[nextSegment]);
+        for (; !iterator->isDone() && entries < maxEntries;
+                iterator->next(), entries++) {
+            LogEntryType type = iterator->getType();
+            if (type != LOG_ENTRY_TYPE_OBJ &&
+                    type != LOG_ENTRY_TYPE_OBJTOMB &&
+                    type != LOG_ENTRY_TYPE_OBJDELTA) {
+                continue;
+            }
+
+            Buffer buffer;
+            iterator->appendToBuffer(buffer);
+            Key key(type, buffer);
+            if (key.getTableId() != tableId || !ownsKeyHash(key.getHash()))
+                continue;
+
+            uint64_t reference = iterator->getReference().toInteger();
+            Candidate* candidate = findCandidate(key, reference);
+            if (type == LOG_ENTRY_TYPE_OBJ) {
+                Object object(buffer);
+                if (object.getVersion() > candidate->objectVersion) {
+                    candidate->objectReference = reference;
+                    candidate->objectVersion = object.getVersion();
+                }
+            } else if (type == LOG_ENTRY_TYPE_OBJTOMB) {
+                ObjectTombstone tombstone(buffer);
+                candidate->tombstoneVersion = std::max(
+                        candidate->tombstoneVersion,
+                        tombstone.getObjectVersion());
+            } else {
+                ObjectDelta delta(buffer);
+                candidate->deltas.push_back({delta.getVersion(), reference});
+            }
+        }
+        if (iterator->isDone()) {
+            iterator.destroy();
+            nextSegment++;
+        }
+    }
+}
+
+/**
+ * Append the object a candidate stands for, if it was live when the
+ * snapshot was taken.
+ *
+ * \param candidate
+ *      Everything the scan found about one key.
+ * \param[out] buffer
+ *      The object and its length are appended here.
+ * \param maxBytes
+ *      Nothing is appended if \a buffer would grow beyond this many bytes.
+ * \return
+ *      False if the object didn't fit in \a buffer, true otherwise.
+ */
+bool
+TableSnapshot::appendCandidate(Candidate& candidate, Buffer* buffer,
+                uint32_t maxBytes)
+{
+    if (candidate.objectReference == 0)
+        return true;
+
+    // Each delta extends the version before it; any that don't build on
+    // the winning object belong to older versions.
+    std::sort(candidate.deltas.begin(), candidate.deltas.end());
+    std::vector<uint64_t> chain;
+    foreach (auto& delta, candidate.deltas) {
+        if (delta.first == candidate.objectVersion + chain.size() + 1)
+            chain.push_back(delta.second);
+    }
+    if (candidate.tombstoneVersion >= candidate.objectVersion + chain.size())
+        return true;
+
+    Log& log = objectManager->log;
+    Buffer objectBuffer;
+    Buffer entryBuffer;
+    log.getEntry(Log::Reference(candidate.objectReference), entryBuffer);
+    if (chain.empty()) {
+        objectBuffer.append(&entryBuffer);
+    } else {
+        objectManager->appendObjectWithDeltas(entryBuffer, chain,
+                objectBuffer);
+    }
+
+    Object object(objectBuffer);
+    if (object.isExpired(timestamp))
+        return true;
+    Buffer expanded;
+    if (object.isCompressed()) {
+        object.decompressValue(expanded);
+        objectBuffer.reset();
+        object.assembleForLog(objectBuffer);
+    }
+
+    uint32_t length = objectBuffer.size();
+    if (buffer->size() + sizeof(length) + length > maxBytes)
+        return false;
+    buffer->emplaceAppend<uint32_t>(length);
+    buffer->append(&objectBuffer);
+    return true;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,152 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLESNAPSHOT_H
+#define RAMCLOUD_TABLESNAPSHOT_H
+
+#include <unordered_map>
+
+#include "Common.h"
+#include "Buffer.h"
+#include "Key.h"
+#include "LogProtector.h"
+#include "LogSegment.h"
+#include "SegmentIterator.h"
+#include "TabletManager.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+class ObjectManager;
+
+/**
+ * Streams out every object of a table as it was at one instant, without
+ * blocking writes to the table and without copying its data first.
+ *
+ * Nothing in the log is ever overwritten, so the objects live at some
+ * instant are exactly the live objects among the entries appended before
+ * it. The constructor closes the log head (see Log::rollHeadOver()) and
+ * keeps the list of segments that make up the log at that moment; a
+ * LogProtector::Activity keeps the cleaner from freeing any of them while
+ * the snapshot exists. next() then reads those segments the way recovery
+ * replays them: the newest version of each key wins unless a newer
+ * tombstone deletes it, and deltas that extend the winner are applied.
+ * Writes made after the constructor returns go to newer segments and are
+ * never seen.
+ *
+ * Versions are per object rather than global, so the instant is defined by
+ * a position in the log rather than by a version number.
+ *
+ * The snapshot keeps a few words of metadata per key of the table, and the
+ * segments it pins can't be reused until it is destroyed, so snapshots
+ * should not be held longer than it takes to read them.
+ *
+ * Clients read snapshots, one tablet at a time, with READ_TABLE_SNAPSHOT
+ * (see SnapshotEnumerator and MasterService::readTableSnapshot).
+ */
+class TableSnapshot {
+  public:
+    TableSnapshot(ObjectManager* objectManager, uint64_t tableId,
+            uint64_t firstKeyHash = 0, uint64_t lastKeyHash = ~0UL);
+    ~TableSnapshot();
+    bool next(Buffer* buffer, uint32_t maxBytes);
+
+  PRIVATE:
+    /**
+     * What has been found so far in the snapshot's segments about one key.
+     */
+    struct Candidate {
+        explicit Candidate(uint64_t keyReference)
+            : keyReference(keyReference)
+            , objectReference(0)
+            , objectVersion(0)
+            , tombstoneVersion(0)
+            , deltas()
+        {
+        }
+
+        /// Reference to some entry holding this key; used to tell apart keys
+        /// whose hashes collide.
+        uint64_t keyReference;
+
+        /// Reference to the newest object entry for the key, or 0 if none
+        /// has been seen. It may still be deleted by #tombstoneVersion.
+        uint64_t objectReference;
+
+        /// Version of the object at #objectReference.
+        uint64_t objectVersion;
+
+        /// Newest version deleted by a tombstone for the key, or 0.
+        uint64_t tombstoneVersion;
+
+        /// (version, reference) of deltas newer than #objectVersion.
+        std::vector<std::pair<uint64_t, uint64_t>> deltas;
+    };
+
+    bool ownsKeyHash(KeyHash keyHash);
+    Candidate* findCandidate(Key& key, uint64_t reference);
+    void scan(uint32_t maxEntries);
+    bool appendCandidate(Candidate& candidate, Buffer* buffer,
+            uint32_t maxBytes);
+
+    /// How many log entries next() examines per call while it is still
+    /// reading the snapshot's segments, so that each call does a bounded
+    /// amount of work.
+    enum { SCAN_ENTRIES_PER_CALL = 10000 };
+
+    /// Owns the table; supplies its log and hash table.
+    ObjectManager* objectManager;
+
+    /// The table being read.
+    uint64_t tableId;
+
+    /// The tablets of #tableId this master owned when the snapshot was
+    /// taken, trimmed to the requested range of key hashes; entries for
+    /// other key hashes are ignored.
+    vector<TabletManager::Tablet> tablets;
+
+    /// Seconds timestamp at which the snapshot was taken; objects expiring
+    /// by then are left out.
+    uint32_t timestamp;
+
+    /// Keeps the segments in #segments from being freed.
+    LogProtector::Activity activity;
+
+    /// The closed segments that held the log when the snapshot was taken.
+    LogSegmentVector segments;
+
+    /// Index in #segments of the segment being scanned; equal to its size
+    /// once the scan is done.
+    size_t nextSegment;
+
+    /// Position within segments[nextSegment], if its scan has started.
+    Tub<SegmentIterator> iterator;
+
+    /// One entry for each key found in the table so far.
+    std::vector<Candidate> candidates;
+
+    /// Maps key hashes to indexes in #candidates.
+    std::unordered_multimap<KeyHash, size_t> candidateIndex;
+
+    /// Index in #candidates of the next one for next() to return, once
+    /// the scan is done.
+    size_t nextCandidate;
+
+    DISALLOW_COPY_AND_ASSIGN(TableSnapshot);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLESNAPSHOT_H
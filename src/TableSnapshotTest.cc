@@ -0,0 +1,224 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "ObjectManager.h"
+#include "TableSnapshot.h"
+
+namespace RAMCloud {
+
+class TableSnapshotTest : public ::testing::Test,
+                          public AbstractLog::ReferenceFreer {
+  public:
+    Context context;
+    ClusterClock clusterClock;
+    ClientLeaseValidator clientLeaseValidator;
+    ServerId serverId;
+    ServerList serverList;
+    ServerConfig masterConfig;
+    MasterTableMetadata masterTableMetadata;
+    ObjectManager objectManager;
+    UnackedRpcResults unackedRpcResults;
+    TransactionManager transactionManager;
+    TxRecoveryManager txRecoveryManager;
+    TabletManager tabletManager;
+
+    TableSnapshotTest()
+        : context()
+        , clusterClock()
+        , clientLeaseValidator(&context, &clusterClock)
+        , serverId(5)
+        , serverList(&context)
+        , masterConfig(ServerConfig::forTesting())
+        , masterTableMetadata()
+        , objectManager(&context,
+                        &serverId,
+                        &masterConfig,
+                        &tabletManager,
+                        &masterTableMetadata,
+                        &unackedRpcResults,
+                        &transactionManager,
+                        &txRecoveryManager)
+        , unackedRpcResults(&context,
+                            this,
+                            &clientLeaseValidator,
+                            &tabletManager)
+        , transactionManager(&context,
+                             objectManager.getLog(),
+                             &unackedRpcResults,
+                             &tabletManager)
+        , txRecoveryManager(&context)
+        , tabletManager()
+    {
+        objectManager.initOnceEnlisted();
+        tabletManager.addTablet(1, 0, ~0UL, TabletManager::NORMAL);
+        tabletManager.addTablet(2, 0, ~0UL, TabletManager::NORMAL);
+    }
+
+    void
+    write(uint64_t tableId, const char* key, const char* value)
+    {
+        Key k(tableId, key, downCast<uint16_t>(strlen(key)));
+        Buffer buffer;
+        Object object(k, value, downCast<uint32_t>(strlen(value)), 0, 0,
+                buffer);
+        EXPECT_EQ(STATUS_OK, objectManager.writeObject(object, 0, 0));
+    }
+
+    void
+    append(const char* key, const char* value)
+    {
+        Key k(1, key, downCast<uint16_t>(strlen(key)));
+        Buffer data;
+        data.appendCopy(value, downCast<uint32_t>(strlen(value)));
+        uint64_t version;
+        EXPECT_EQ(STATUS_OK, objectManager.appendObject(k, &data, 0,
+                data.size(), NULL, &version));
+    }
+
+    void
+    remove(const char* key)
+    {
+        Key k(1, key, downCast<uint16_t>(strlen(key)));
+        EXPECT_EQ(STATUS_OK, objectManager.removeObject(k, NULL, NULL));
+    }
+
+    /**
+     * Read a whole snapshot and return its objects as "key:value" strings
+     * in key order. The number of calls to next() that returned any objects
+     * is stored in \a calls, if given.
+     */
+    string
+    readAll(TableSnapshot& snapshot, uint32_t maxBytes, int* calls = NULL)
+    {
+        std::map<string, string> objects;
+        bool more = true;
+        int nonEmpty = 0;
+        while (more) {
+            Buffer buffer;
+            more = snapshot.next(&buffer, maxBytes);
+            if (buffer.size() > 0)
+                nonEmpty++;
+            uint32_t offset = 0;
+            while (offset < buffer.size()) {
+                uint32_t length = *buffer.getOffset<uint32_t>(offset);
+                offset += sizeof32(length);
+                Object object(buffer, offset, length);
+                KeyLength keyLength;
+                const char* key = static_cast<const char*>(
+                        object.getKey(0, &keyLength));
+                uint32_t valueLength;
+                const char* value = static_cast<const char*>(
+                        object.getValue(&valueLength));
+                objects[string(key, keyLength)] = string(value, valueLength);
+                offset += length;
+            }
+        }
+        if (calls != NULL)
+            *calls = nonEmpty;
+
+        string result;
+        foreach (auto& object, objects) {
+            if (!result.empty())
+                result += " ";
+            result += object.first + ":" + object.second;
+        }
+        return result;
+    }
+
+    virtual void freeLogEntry(Log::Reference ref) {}
+
+    DISALLOW_COPY_AND_ASSIGN(TableSnapshotTest);
+};
+
+TEST_F(TableSnapshotTest, next_pointInTime) {
+    write(1, "a", "a1");
+    write(1, "a", "a2");
+    write(1, "b", "b1");
+    write(1, "c", "c1");
+    append("c", "+");
+    write(1, "gone", "x");
+    remove("gone");
+    write(2, "other", "x");
+
+    TableSnapshot snapshot(&objectManager, 1);
+    write(1, "a", "a3");
+    remove("b");
+    append("c", "+");
+    write(1, "d", "d1");
+    write(1, "gone", "back");
+
+    EXPECT_EQ("a:a2 b:b1 c:c1+", readAll(snapshot, 1000));
+}
+
+TEST_F(TableSnapshotTest, next_ignoresLaterSegments) {
+    write(1, "a", "a1");
+    write(1, "b", "b1");
+    TableSnapshot snapshot(&objectManager, 1);
+    write(1, "a", "a2");
+    objectManager.log.rollHeadOver();
+    write(1, "b", "b2");
+
+    EXPECT_EQ("a:a1 b:b1", readAll(snapshot, 1000));
+}
+
+TEST_F(TableSnapshotTest, next_maxBytes) {
+    write(1, "a", "a1");
+    write(1, "b", "b1");
+    write(1, "c", "c1");
+    TableSnapshot snapshot(&objectManager, 1);
+
+    int calls;
+    EXPECT_EQ("a:a1 b:b1 c:c1", readAll(snapshot, 1, &calls));
+    EXPECT_EQ(3, calls);
+}
+
+TEST_F(TableSnapshotTest, scan_incremental) {
+    write(1, "a", "a1");
+    write(1, "b", "b1");
+    TableSnapshot snapshot(&objectManager, 1);
+
+    snapshot.scan(1);
+    EXPECT_EQ(0u, snapshot.nextSegment);
+    EXPECT_TRUE(snapshot.iterator);
+    snapshot.scan(1000);
+    EXPECT_EQ(snapshot.segments.size(), snapshot.nextSegment);
+    EXPECT_FALSE(snapshot.iterator);
+    EXPECT_EQ(2u, snapshot.candidates.size());
+}
+
+TEST_F(TableSnapshotTest, constructor_tablets) {
+    tabletManager.addTablet(3, 0, 99, TabletManager::NORMAL);
+    TableSnapshot snapshot(&objectManager, 3);
+    ASSERT_EQ(1u, snapshot.tablets.size());
+    EXPECT_TRUE(snapshot.ownsKeyHash(99));
+    EXPECT_FALSE(snapshot.ownsKeyHash(100));
+}
+
+TEST_F(TableSnapshotTest, constructor_keyHashRange) {
+    tabletManager.addTablet(3, 0, 99, TabletManager::NORMAL);
+    tabletManager.addTablet(3, 100, 199, TabletManager::NORMAL);
+    tabletManager.addTablet(3, 200, ~0UL, TabletManager::NORMAL);
+    TableSnapshot snapshot(&objectManager, 3, 50, 150);
+    ASSERT_EQ(2u, snapshot.tablets.size());
+    EXPECT_FALSE(snapshot.ownsKeyHash(49));
+    EXPECT_TRUE(snapshot.ownsKeyHash(50));
+    EXPECT_TRUE(snapshot.ownsKeyHash(150));
+    EXPECT_FALSE(snapshot.ownsKeyHash(151));
+    EXPECT_FALSE(snapshot.ownsKeyHash(250));
+}
+
+}  // namespace RAMCloud
@@ -16,11 +16,56 @@
 #include "TableStats.h"
 #include "MasterTableMetadata.h"
 #include "ShortMacros.h"
+#include "TableUsageStats.h"
+#include "ThreadId.h"
 
 namespace RAMCloud {
 
 namespace TableStats {
 
+/**
+ * Add to the byte and record counts of a table, in the calling thread's
+ * shard. Subtracting is done by adding the two's complement.
+ *
+ * \param byteCount
+ *      Number of bytes to add.
+ * \param recordCount
+ *      Number of log records to add.
+ */
+void
+Block::add(uint64_t byteCount, uint64_t recordCount)
+{
+    Shard& shard = shards[ThreadId::get() % SHARDS];
+    shard.byteCount.fetch_add(byteCount, std::memory_order_relaxed);
+    shard.recordCount.fetch_add(recordCount, std::memory_order_relaxed);
+}
+
+/**
+ * Return the number of bytes of data related to the table. Updates made
+ * concurrently may or may not be included.
+ */
+uint64_t
+Block::getByteCount() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < SHARDS; i++)
+        total += shards[i].byteCount.load(std::memory_order_relaxed);
+    return total;
+}
+
+/**
+ * Return the number of log records related to the table. Updates made
+ * concurrently may or may not be included.
+ */
+uint64_t
+Block::getRecordCount() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < SHARDS; i++)
+        total += shards[i].recordCount.load(std::memory_order_relaxed);
+    return total;
+}
+
 /**
  * Update the table status information in the event a tablet is added to keep
  * track of the number of key hash values that this master owns for the given
@@ -126,9 +171,8 @@ increment(MasterTableMetadata* mtm,
     MasterTableMetadata::Entry* entry;
     entry = mtm->findOrCreate(tableId);
 
-    SpinLock::Guard _(entry->stats.lock);
-    entry->stats.byteCount += byteCount;
-    entry->stats.recordCount += recordCount;
+    entry->stats.add(byteCount, recordCount);
+    TableUsageStats::recordLogBytes(tableId, byteCount);
 }
 
 /**
@@ -157,11 +201,8 @@ decrement(MasterTableMetadata* mtm,
     MasterTableMetadata::Entry* entry;
     entry = mtm->find(tableId);
 
-    if (entry != NULL) {
-        SpinLock::Guard _(entry->stats.lock);
-        entry->stats.byteCount -= byteCount;
-        entry->stats.recordCount -= recordCount;
-    }
+    if (entry != NULL)
+        entry->stats.add(-byteCount, -recordCount);
 }
 
 
@@ -201,6 +242,8 @@ serialize(Buffer *buf, MasterTableMetadata *mtm)
     MasterTableMetadata::scanner sc = mtm->getScanner();
     while (sc.hasNext()) {
         MasterTableMetadata::Entry* entry = sc.next();
+        uint64_t byteCount = entry->stats.getByteCount();
+        uint64_t recordCount = entry->stats.getRecordCount();
         {
             SpinLock::Guard _(entry->stats.lock);
             double keyHashCount;
@@ -217,19 +260,17 @@ serialize(Buffer *buf, MasterTableMetadata *mtm)
             }
 
 
-            if (entry->stats.byteCount >= threshold) {
+            if (byteCount >= threshold) {
                 header->entryCount++;
-                double bytesPerKeyHash = double(entry->stats.byteCount) /
-                                         keyHashCount;
-                double recordsPerKeyHash = double(entry->stats.recordCount) /
-                                           keyHashCount;
+                double bytesPerKeyHash = double(byteCount) / keyHashCount;
+                double recordsPerKeyHash = double(recordCount) / keyHashCount;
                 *(buf->emplaceAppend<DigestEntry>()) =
                         {entry->tableId, bytesPerKeyHash, recordsPerKeyHash};
 
             } else {
                 otherKeyHashCount += keyHashCount;
-                otherByteCount += entry->stats.byteCount;
-                otherRecordCount += entry->stats.recordCount;
+                otherByteCount += byteCount;
+                otherRecordCount += recordCount;
                 hasOtherEntries = true;
             }
         }
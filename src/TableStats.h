@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_TABLESTATS_H
 #define RAMCLOUD_TABLESTATS_H
 
+#include <atomic>
 #include <unordered_map>
 
 #include "Common.h"
@@ -50,26 +51,54 @@ namespace TableStats {
 /**
  * This structure represents a block of stats information for an individual
  * table on a given master.  One of these blocks is stored in each entry
- * of the MasterTableMetadata container.  Thread-safe access to this block
- * should be maintained by "acquiring" the block's SpinLock before accessing
- * the block's members.
+ * of the MasterTableMetadata container.  Thread-safe access to keyHashCount
+ * and totalOwnership should be maintained by "acquiring" the block's SpinLock.
+ *
+ * The byte and record counts change with every write, delete and cleaner
+ * pass, from many threads at once, so they don't use the lock: they are
+ * split into per-thread shards that are updated with atomic adds and summed
+ * when read (see add(), getByteCount() and getRecordCount()).
  */
 struct Block {
-    SpinLock lock;          /// Aquire this monitor lock before member access.
+    SpinLock lock;          /// Aquire this monitor lock before accessing
+                            /// keyHashCount or totalOwnership.
     uint64_t keyHashCount;  /// Number of key hashes that reside on this master.
                             /// If a master has total ownership this value is
                             /// assumed to be 2^64.
     bool totalOwnership;    /// True if this master completely owns this table.
-    uint64_t byteCount;     /// Number of bytes of data related to a table.
-    uint64_t recordCount;   /// Number of log records related to a table.
 
     Block()
         : lock("TableStats::lock")
         , keyHashCount(0)
         , totalOwnership(false)
-        , byteCount(0)
-        , recordCount(0)
-    {}
+        , shards()
+    {
+        for (int i = 0; i < SHARDS; i++) {
+            shards[i].byteCount = 0;
+            shards[i].recordCount = 0;
+        }
+    }
+
+    void add(uint64_t byteCount, uint64_t recordCount);
+    uint64_t getByteCount() const;
+    uint64_t getRecordCount() const;
+
+    /// Number of shards the counts are split into; threads share shards
+    /// when there are more of them than this.
+    static const int SHARDS = 16;
+
+    /**
+     * One thread's share of the counts. Each shard's sums wrap around when
+     * a thread removes data that another one added; the total is still
+     * right. Padded so that shards don't share cache lines.
+     */
+    struct Shard {
+        /// Number of bytes of data related to a table.
+        std::atomic<uint64_t> byteCount;
+        /// Number of log records related to a table.
+        std::atomic<uint64_t> recordCount;
+        char pad[CACHE_LINE_SIZE - 2 * sizeof(std::atomic<uint64_t>)];
+    } shards[SHARDS];
 };
 
 void addKeyHashRange(MasterTableMetadata* mtm,
@@ -13,6 +13,8 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <thread>
+
 #include "TestUtil.h"
 #include "TableStats.h"
 #include "MasterTableMetadata.h"
@@ -71,8 +73,8 @@ TEST_F(TableStatsTest, constructor_TableStats) {
     stats = new TableStats::Block();
     EXPECT_TRUE(stats != NULL);
     if (stats != NULL) {
-        EXPECT_EQ(0u, stats->byteCount);
-        EXPECT_EQ(0u, stats->recordCount);
+        EXPECT_EQ(0u, stats->getByteCount());
+        EXPECT_EQ(0u, stats->getRecordCount());
         EXPECT_TRUE(stats->lock.try_lock());
         EXPECT_FALSE(stats->lock.try_lock());
         stats->lock.unlock();
@@ -136,18 +138,12 @@ TEST_F(TableStatsTest, increment) {
     EXPECT_NE(mtm.tableMetadataMap.end(), mtm.tableMetadataMap.find(0));
     entry = mtm.find(0);
     EXPECT_FALSE(entry == NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(2u, entry->stats.byteCount);
-        EXPECT_EQ(3u, entry->stats.recordCount);
-    }
+    EXPECT_EQ(2u, entry->stats.getByteCount());
+    EXPECT_EQ(3u, entry->stats.getRecordCount());
 
     TableStats::increment(&mtm, 0, 4, 5);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(6u, entry->stats.byteCount);
-        EXPECT_EQ(8u, entry->stats.recordCount);
-    }
+    EXPECT_EQ(6u, entry->stats.getByteCount());
+    EXPECT_EQ(8u, entry->stats.getRecordCount());
 }
 
 TEST_F(TableStatsTest, decrement) {
@@ -160,21 +156,38 @@ TEST_F(TableStatsTest, decrement) {
     TableStats::increment(&mtm, 1, 10, 10);
     entry = mtm.find(1);
     EXPECT_FALSE(entry == NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(10u, entry->stats.byteCount);
-        EXPECT_EQ(10u, entry->stats.recordCount);
-    }
+    EXPECT_EQ(10u, entry->stats.getByteCount());
+    EXPECT_EQ(10u, entry->stats.getRecordCount());
 
     TableStats::decrement(&mtm, 1, 2, 3);
     EXPECT_FALSE(entry == NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(8u, entry->stats.byteCount);
-        EXPECT_EQ(7u, entry->stats.recordCount);
+    EXPECT_EQ(8u, entry->stats.getByteCount());
+    EXPECT_EQ(7u, entry->stats.getRecordCount());
+}
+
+static void
+incrementThenDecrement(MasterTableMetadata* mtm)
+{
+    for (int i = 0; i < 10000; i++) {
+        TableStats::increment(mtm, 1, 3, 2);
+        TableStats::decrement(mtm, 1, 2, 1);
     }
 }
 
+TEST_F(TableStatsTest, concurrentThreads) {
+    // Each thread decrements counts that may live in another thread's
+    // shard; only the totals have to be right.
+    TableStats::increment(&mtm, 1, 5, 5);
+    std::thread thread1(incrementThenDecrement, &mtm);
+    std::thread thread2(incrementThenDecrement, &mtm);
+    incrementThenDecrement(&mtm);
+    thread1.join();
+    thread2.join();
+    MasterTableMetadata::Entry* entry = mtm.find(1);
+    EXPECT_EQ(30005u, entry->stats.getByteCount());
+    EXPECT_EQ(30005u, entry->stats.getRecordCount());
+}
+
 TEST_F(TableStatsTest, serialize_basic) {
     // First Check an empty mtm.
     {
@@ -204,35 +217,26 @@ TEST_F(TableStatsTest, serialize_basic) {
 
     entry = mtm.find(digest->entries[0].tableId);
     EXPECT_TRUE(entry != NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(double(entry->stats.byteCount) / 10,
-                  digest->entries[0].bytesPerKeyHash);
-        EXPECT_EQ(double(entry->stats.recordCount) / 10,
-                  digest->entries[0].recordsPerKeyHash);
-    }
+    EXPECT_EQ(double(entry->stats.getByteCount()) / 10,
+              digest->entries[0].bytesPerKeyHash);
+    EXPECT_EQ(double(entry->stats.getRecordCount()) / 10,
+              digest->entries[0].recordsPerKeyHash);
     entry = NULL;
 
     entry = mtm.find(digest->entries[1].tableId);
     EXPECT_TRUE(entry != NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(double(entry->stats.byteCount) / 10,
-                  digest->entries[1].bytesPerKeyHash);
-        EXPECT_EQ(double(entry->stats.recordCount) / 10,
-                  digest->entries[1].recordsPerKeyHash);
-    }
+    EXPECT_EQ(double(entry->stats.getByteCount()) / 10,
+              digest->entries[1].bytesPerKeyHash);
+    EXPECT_EQ(double(entry->stats.getRecordCount()) / 10,
+              digest->entries[1].recordsPerKeyHash);
     entry = NULL;
 
     entry = mtm.find(digest->entries[2].tableId);
     EXPECT_TRUE(entry != NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(double(entry->stats.byteCount) / 10,
-                  digest->entries[2].bytesPerKeyHash);
-        EXPECT_EQ(double(entry->stats.recordCount) / 10,
-                  digest->entries[2].recordsPerKeyHash);
-    }
+    EXPECT_EQ(double(entry->stats.getByteCount()) / 10,
+              digest->entries[2].bytesPerKeyHash);
+    EXPECT_EQ(double(entry->stats.getRecordCount()) / 10,
+              digest->entries[2].recordsPerKeyHash);
     entry = NULL;
 
 }
@@ -346,11 +350,8 @@ TEST_F(TableStatsTest, estimator_estimate_basic) {
 
     entry = mtm.find(66);
     EXPECT_TRUE(entry != NULL);
-    {
-        SpinLock::Guard _(entry->stats.lock);
-        EXPECT_EQ(entry->stats.byteCount * 5 / 10, ret.byteCount);
-        EXPECT_EQ(entry->stats.recordCount * 5 /10, ret.recordCount);
-    }
+    EXPECT_EQ(entry->stats.getByteCount() * 5 / 10, ret.byteCount);
+    EXPECT_EQ(entry->stats.getRecordCount() * 5 /10, ret.recordCount);
     entry = NULL;
 }
 
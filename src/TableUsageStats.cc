@@ -0,0 +1,264 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "Cycles.h"
+#include "ServerId.h"
+#include "TableUsageStats.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+__thread TableUsageStats::ThreadStats* TableUsageStats::threadStats = NULL;
+__thread TableUsageStats::Counters* TableUsageStats::currentRequest = NULL;
+SpinLock TableUsageStats::mutex("TableUsageStats");
+std::vector<TableUsageStats::ThreadStats*> TableUsageStats::registeredStats;
+
+/**
+ * Add up the usage recorded by all threads and append it to a buffer; this
+ * is the response to the GET_TABLE_USAGE server control. The result is a
+ * uint64_t table id for each table that has been touched, each followed by
+ * its Counters (with workerCycles and queueingCycles converted to
+ * nanoseconds).
+ *
+ * \param buffer
+ *      The statistics are appended here.
+ */
+void
+TableUsageStats::collect(Buffer* buffer)
+{
+    Collection total;
+    {
+        std::lock_guard<SpinLock> lock(mutex);
+        foreach (ThreadStats* thread, registeredStats) {
+            std::lock_guard<SpinLock> threadLock(thread->lock);
+            foreach (auto& entry, thread->tables) {
+                Counters& sum = total[entry.first];
+                const Counters& counters = entry.second;
+                sum.readCount += counters.readCount;
+                sum.writeCount += counters.writeCount;
+                sum.readBytes += counters.readBytes;
+                sum.writeBytes += counters.writeBytes;
+                sum.logBytes += counters.logBytes;
+                sum.cleanerBytes += counters.cleanerBytes;
+                sum.workerCycles += counters.workerCycles;
+                sum.requestCount += counters.requestCount;
+                sum.queueingCycles += counters.queueingCycles;
+            }
+        }
+    }
+    foreach (Collection::value_type& entry, total) {
+        entry.second.workerCycles =
+                Cycles::toNanoseconds(entry.second.workerCycles);
+        entry.second.queueingCycles =
+                Cycles::toNanoseconds(entry.second.queueingCycles);
+        buffer->emplaceAppend<uint64_t>(entry.first);
+        buffer->appendCopy(&entry.second);
+    }
+}
+
+/**
+ * This method is invoked by worker threads when they finish executing a
+ * request; it charges the request's execution and queueing time to the
+ * first table the request touched (if any).
+ *
+ * \param cycles
+ *      Time spent executing the request, in Cycles::rdtsc ticks.
+ * \param queueingCycles
+ *      Time the request waited before a worker started executing it, in
+ *      Cycles::rdtsc ticks.
+ */
+void
+TableUsageStats::finishRequest(uint64_t cycles, uint64_t queueingCycles)
+{
+    if (currentRequest != NULL) {
+        currentRequest->workerCycles += cycles;
+        currentRequest->requestCount++;
+        currentRequest->queueingCycles += queueingCycles;
+        currentRequest = NULL;
+    }
+}
+
+/**
+ * Slow path of lookup: find or create the current thread's counters for a
+ * table and remember them for the next lookup.
+ *
+ * \param tableId
+ *      Identifies the desired table.
+ */
+TableUsageStats::Counters*
+TableUsageStats::lookupSlow(uint64_t tableId)
+{
+    if (threadStats == NULL) {
+        threadStats = new ThreadStats;
+        std::lock_guard<SpinLock> lock(mutex);
+        registeredStats.push_back(threadStats);
+    }
+    Counters* counters;
+    {
+        std::lock_guard<SpinLock> lock(threadStats->lock);
+        auto it = threadStats->tables.find(tableId);
+        if (it == threadStats->tables.end()) {
+            Counters empty = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+            it = threadStats->tables.emplace(tableId, empty).first;
+        }
+        counters = &it->second;
+    }
+    threadStats->cachedTableId = tableId;
+    threadStats->cachedCounters = counters;
+    return counters;
+}
+
+/**
+ * Parse statistics returned by collect().
+ *
+ * \param buffer
+ *      Holds the statistics.
+ * \param offset
+ *      Offset of the statistics in \a buffer.
+ * \param length
+ *      Number of bytes of statistics.
+ * \param[out] stats
+ *      Contents are replaced with the parsed statistics.
+ * \return
+ *      False if the statistics were malformed.
+ */
+bool
+TableUsageStats::parse(Buffer* buffer, uint32_t offset, uint32_t length,
+        Collection* stats)
+{
+    stats->clear();
+    uint32_t end = offset + length;
+    while (offset < end) {
+        const uint64_t* tableId = buffer->getOffset<uint64_t>(offset);
+        if (tableId == NULL)
+            return false;
+        offset += sizeof32(*tableId);
+        const Counters* counters = buffer->getOffset<Counters>(offset);
+        if (counters == NULL)
+            return false;
+        offset += sizeof32(*counters);
+        (*stats)[*tableId] = *counters;
+    }
+    return offset == end;
+}
+
+/**
+ * Given the responses to two calls to CoordinatorClient::serverControlAll
+ * with GET_TABLE_USAGE, format the resources each server used for each
+ * table between them.
+ *
+ * \param first
+ *      Response from the earlier call.
+ * \param second
+ *      Response from the later call.
+ * \return
+ *      A multi-line string, with a line for each table that each server
+ *      did work for in the interval. It ends in a newline character.
+ */
+string
+TableUsageStats::printClusterUsage(Buffer* first, Buffer* second)
+{
+    std::vector<Collection> before, after;
+    parseCluster(first, &before);
+    parseCluster(second, &after);
+
+    string result = format("%-20s %10s %10s %10s %10s %10s %10s %10s "
+            "%10s\n", "Table", "Reads", "Writes", "Read KB", "Write KB",
+            "Log KB", "Cleaner KB", "Worker ms", "Queue us");
+    for (size_t server = 0; server < after.size(); server++) {
+        bool printedServer = false;
+        foreach (Collection::value_type& entry, after[server]) {
+            Counters delta = entry.second;
+            if (server < before.size()) {
+                Collection::iterator earlier =
+                        before[server].find(entry.first);
+                if (earlier != before[server].end()) {
+                    const Counters& old = earlier->second;
+                    delta.readCount -= old.readCount;
+                    delta.writeCount -= old.writeCount;
+                    delta.readBytes -= old.readBytes;
+                    delta.writeBytes -= old.writeBytes;
+                    delta.logBytes -= old.logBytes;
+                    delta.cleanerBytes -= old.cleanerBytes;
+                    delta.workerCycles -= old.workerCycles;
+                    delta.requestCount -= old.requestCount;
+                    delta.queueingCycles -= old.queueingCycles;
+                }
+            }
+            if ((delta.readCount == 0) && (delta.writeCount == 0) &&
+                    (delta.logBytes == 0) && (delta.cleanerBytes == 0)) {
+                continue;
+            }
+            if (!printedServer) {
+                result.append(format("Server index %lu:\n", server));
+                printedServer = true;
+            }
+            // Average time the table's requests waited for a worker.
+            double queueMicros = 0;
+            if (delta.requestCount != 0) {
+                queueMicros = static_cast<double>(delta.queueingCycles) *
+                        1e-3 / static_cast<double>(delta.requestCount);
+            }
+            result.append(format("  %-18lu %10lu %10lu %10.1f %10.1f "
+                    "%10.1f %10.1f %10.2f %10.1f\n", entry.first,
+                    delta.readCount, delta.writeCount,
+                    static_cast<double>(delta.readBytes) / 1024,
+                    static_cast<double>(delta.writeBytes) / 1024,
+                    static_cast<double>(delta.logBytes) / 1024,
+                    static_cast<double>(delta.cleanerBytes) / 1024,
+                    static_cast<double>(delta.workerCycles) * 1e-6,
+                    queueMicros));
+        }
+    }
+    return result;
+}
+
+/**
+ * Divide the response to serverControlAll(GET_TABLE_USAGE) among the
+ * servers it came from.
+ *
+ * \param rawData
+ *      Response buffer from a call to CoordinatorClient::serverControlAll.
+ * \param[out] results
+ *      Filled in (possibly sparsely) with the statistics of each server:
+ *      entry i holds the statistics for the server whose ServerId has
+ *      indexNumber i. Servers whose statistics were malformed are left
+ *      empty.
+ */
+void
+TableUsageStats::parseCluster(Buffer* rawData,
+        std::vector<Collection>* results)
+{
+    results->clear();
+    uint32_t offset = sizeof(WireFormat::ServerControlAll::Response);
+    while (offset < rawData->size()) {
+        WireFormat::ServerControl::Response* header =
+                rawData->getOffset<WireFormat::ServerControl::Response>(offset);
+        offset += sizeof32(*header);
+        if ((header == NULL) ||
+                ((offset + header->outputLength) > rawData->size())) {
+            break;
+        }
+        uint32_t i = ServerId(header->serverId).indexNumber();
+        if (i >= results->size()) {
+            results->resize(i+1);
+        }
+        if (!parse(rawData, offset, header->outputLength, &results->at(i)))
+            results->at(i).clear();
+        offset += header->outputLength;
+    }
+}
+
+} // namespace RAMCloud
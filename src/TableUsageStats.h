@@ -0,0 +1,237 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLEUSAGESTATS_H
+#define RAMCLOUD_TABLEUSAGESTATS_H
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "Buffer.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+/**
+ * Charges the work a master does to the tables it does it for, so that when
+ * a server is overloaded we can tell which table is responsible. PerfStats
+ * only has server-wide totals.
+ *
+ * Each thread keeps its own counters for every table it has touched, so
+ * recording a sample normally costs a couple of increments without any
+ * synchronization; the per-thread lock is only taken when a thread sees a
+ * table for the first time, and when collect() adds up all threads. The
+ * GET_TABLE_USAGE server control returns the totals (see collect()).
+ */
+class TableUsageStats {
+  PUBLIC:
+    /// The resources used on behalf of one table. Counters only grow; to
+    /// find the usage over an interval, subtract two collections.
+    struct Counters {
+        /// Objects read (including reads of multi-ops and index lookups).
+        uint64_t readCount;
+
+        /// Objects written or removed.
+        uint64_t writeCount;
+
+        /// Value bytes returned by reads.
+        uint64_t readBytes;
+
+        /// Value bytes supplied by writes.
+        uint64_t writeBytes;
+
+        /// Bytes of log entries (objects, tombstones, linearizability
+        /// records, etc.) appended to the log for the table.
+        uint64_t logBytes;
+
+        /// Bytes of the table's live log entries that the cleaner had to
+        /// copy in order to reclaim segments.
+        uint64_t cleanerBytes;
+
+        /// Time worker threads spent executing requests for the table, in
+        /// Cycles::rdtsc ticks (collect() converts this to nanoseconds).
+        /// A request that touches several tables is charged to the first.
+        uint64_t workerCycles;
+
+        /// Requests charged to the table, as for #workerCycles.
+        uint64_t requestCount;
+
+        /// Time those requests waited for a worker thread, in
+        /// Cycles::rdtsc ticks (collect() converts this to nanoseconds).
+        /// Together with #workerCycles this gives each table's latency,
+        /// e.g. to check how well it is isolated from other tenants (see
+        /// WorkerManager::tenantQuantumMicros).
+        uint64_t queueingCycles;
+    } __attribute__((packed));
+
+    /// Usage of each table, keyed by table id.
+    typedef std::map<uint64_t, Counters> Collection;
+
+    /**
+     * Count a read of one object.
+     *
+     * \param tableId
+     *      Table containing the object.
+     * \param bytes
+     *      Length of the value that was read.
+     */
+    static void
+    recordRead(uint64_t tableId, uint64_t bytes)
+    {
+        Counters* counters = requestCounters(tableId);
+        counters->readCount++;
+        counters->readBytes += bytes;
+    }
+
+    /**
+     * Count a write (or removal) of one object.
+     *
+     * \param tableId
+     *      Table containing the object.
+     * \param bytes
+     *      Length of the value that was written (0 for removals).
+     */
+    static void
+    recordWrite(uint64_t tableId, uint64_t bytes)
+    {
+        Counters* counters = requestCounters(tableId);
+        counters->writeCount++;
+        counters->writeBytes += bytes;
+    }
+
+    /**
+     * Count log space consumed by new entries for a table.
+     *
+     * \param tableId
+     *      Table that the entries belong to.
+     * \param bytes
+     *      Total length of the entries.
+     */
+    static void
+    recordLogBytes(uint64_t tableId, uint64_t bytes)
+    {
+        lookup(tableId)->logBytes += bytes;
+    }
+
+    /**
+     * Count a live log entry relocated by the cleaner.
+     *
+     * \param tableId
+     *      Table that the entry belongs to.
+     * \param bytes
+     *      Length of the entry.
+     */
+    static void
+    recordCleanerBytes(uint64_t tableId, uint64_t bytes)
+    {
+        lookup(tableId)->cleanerBytes += bytes;
+    }
+
+    static void collect(Buffer* buffer);
+    static void finishRequest(uint64_t cycles, uint64_t queueingCycles);
+    static bool parse(Buffer* buffer, uint32_t offset, uint32_t length,
+            Collection* stats);
+    static string printClusterUsage(Buffer* first, Buffer* second);
+
+  PRIVATE:
+    /// The counters of a single thread.
+    struct ThreadStats {
+        ThreadStats()
+            : lock("TableUsageStats::ThreadStats")
+            , tables()
+            , cachedTableId(0)
+            , cachedCounters(NULL)
+        {}
+
+        /// Held while #tables is modified by its thread or read by
+        /// collect(). Individual counters are updated without it.
+        SpinLock lock;
+
+        /// Counters for each table this thread has touched. Elements never
+        /// move once inserted, so pointers to them stay valid.
+        std::unordered_map<uint64_t, Counters> tables;
+
+        /// The most recently used table and its counters (NULL if none),
+        /// so that runs of operations on the same table skip the hash
+        /// table lookup.
+        uint64_t cachedTableId;
+        Counters* cachedCounters;
+
+        DISALLOW_COPY_AND_ASSIGN(ThreadStats);
+    };
+
+    /**
+     * Return the current thread's counters for a table, creating them if
+     * needed.
+     *
+     * \param tableId
+     *      Identifies the desired table.
+     */
+    static Counters*
+    lookup(uint64_t tableId)
+    {
+        ThreadStats* thread = threadStats;
+        if (expect_true((thread != NULL) &&
+                (thread->cachedCounters != NULL) &&
+                (thread->cachedTableId == tableId))) {
+            return thread->cachedCounters;
+        }
+        return lookupSlow(tableId);
+    }
+
+    /**
+     * Same as lookup, except that the table also becomes the one charged
+     * for the worker time of the request being executed by this thread,
+     * unless the request has already touched another table.
+     *
+     * \param tableId
+     *      Identifies the desired table.
+     */
+    static Counters*
+    requestCounters(uint64_t tableId)
+    {
+        Counters* counters = lookup(tableId);
+        if (currentRequest == NULL) {
+            currentRequest = counters;
+        }
+        return counters;
+    }
+
+    static Counters* lookupSlow(uint64_t tableId);
+    static void parseCluster(Buffer* rawData,
+            std::vector<Collection>* results);
+
+    /// Statistics for the current thread; NULL until it records its first
+    /// sample.
+    static __thread ThreadStats* threadStats;
+
+    /// Counters of the table charged for the request this thread is
+    /// executing; NULL if the request hasn't touched any table yet.
+    static __thread Counters* currentRequest;
+
+    /// Protects #registeredStats.
+    static SpinLock mutex;
+
+    /// The statistics of every thread that has recorded a sample. These are
+    /// never freed, so that samples aren't lost when threads exit.
+    static std::vector<ThreadStats*> registeredStats;
+
+    TableUsageStats();
+};
+
+} // end RAMCloud
+
+#endif  // RAMCLOUD_TABLEUSAGESTATS_H
@@ -0,0 +1,151 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <thread>
+
+#include "TestUtil.h"
+#include "Cycles.h"
+#include "ServerId.h"
+#include "TableUsageStats.h"
+#include "WireFormat.h"
+
+namespace RAMCloud {
+
+class TableUsageStatsTest : public ::testing::Test {
+  public:
+    TableUsageStatsTest()
+    {
+        TableUsageStats::registeredStats.clear();
+        TableUsageStats::threadStats = NULL;
+        TableUsageStats::currentRequest = NULL;
+    }
+
+    // Append the current statistics to a buffer in the format of
+    // serverControlAll(GET_TABLE_USAGE), as if they came from a single
+    // server.
+    void
+    collectForServer(Buffer* buffer, ServerId serverId)
+    {
+        buffer->reset();
+        WireFormat::ServerControlAll::Response* header =
+                buffer->emplaceAppend<WireFormat::ServerControlAll::Response>();
+        header->common.status = STATUS_OK;
+        header->serverCount = 1;
+        header->respCount = 1;
+        WireFormat::ServerControl::Response* subHead = buffer->
+                emplaceAppend<WireFormat::ServerControl::Response>();
+        subHead->common.status = STATUS_OK;
+        subHead->serverId = serverId.getId();
+        uint32_t start = buffer->size();
+        TableUsageStats::collect(buffer);
+        subHead->outputLength = buffer->size() - start;
+        header->totalRespLength = buffer->size() - sizeof32(*header);
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TableUsageStatsTest);
+};
+
+TEST_F(TableUsageStatsTest, lookup) {
+    TableUsageStats::Counters* counters = TableUsageStats::lookup(5);
+    EXPECT_EQ(1u, TableUsageStats::registeredStats.size());
+    EXPECT_EQ(counters, TableUsageStats::lookup(5));
+    EXPECT_EQ(5u, TableUsageStats::threadStats->cachedTableId);
+    TableUsageStats::Counters* other = TableUsageStats::lookup(6);
+    EXPECT_NE(counters, other);
+    EXPECT_EQ(counters, TableUsageStats::lookup(5));
+    EXPECT_EQ(2u, TableUsageStats::threadStats->tables.size());
+    EXPECT_EQ(1u, TableUsageStats::registeredStats.size());
+    EXPECT_EQ(0u, counters->readCount);
+}
+
+TEST_F(TableUsageStatsTest, finishRequest) {
+    TableUsageStats::recordRead(5, 100);
+    TableUsageStats::recordWrite(6, 200);
+    TableUsageStats::finishRequest(1000, 40);
+    TableUsageStats::recordWrite(6, 200);
+    TableUsageStats::finishRequest(30, 2);
+
+    // A request that touched no table isn't charged to anyone.
+    TableUsageStats::finishRequest(7, 1);
+
+    EXPECT_EQ(1000u, TableUsageStats::lookup(5)->workerCycles);
+    EXPECT_EQ(1u, TableUsageStats::lookup(5)->requestCount);
+    EXPECT_EQ(40u, TableUsageStats::lookup(5)->queueingCycles);
+    EXPECT_EQ(30u, TableUsageStats::lookup(6)->workerCycles);
+    EXPECT_EQ(1u, TableUsageStats::lookup(6)->requestCount);
+    EXPECT_EQ(2u, TableUsageStats::lookup(6)->queueingCycles);
+    EXPECT_TRUE(TableUsageStats::currentRequest == NULL);
+
+    // Log and cleaner work don't decide who pays for a request.
+    TableUsageStats::recordLogBytes(7, 50);
+    TableUsageStats::recordCleanerBytes(7, 50);
+    TableUsageStats::finishRequest(11, 0);
+    EXPECT_EQ(0u, TableUsageStats::lookup(7)->workerCycles);
+}
+
+TEST_F(TableUsageStatsTest, collectAndParse) {
+    TableUsageStats::recordRead(5, 100);
+    TableUsageStats::recordLogBytes(5, 40);
+    std::thread thread([] {
+        TableUsageStats::recordRead(5, 300);
+        TableUsageStats::recordWrite(6, 200);
+        TableUsageStats::recordCleanerBytes(6, 80);
+        TableUsageStats::finishRequest(Cycles::fromNanoseconds(5000),
+                Cycles::fromNanoseconds(3000));
+    });
+    thread.join();
+    EXPECT_EQ(2u, TableUsageStats::registeredStats.size());
+
+    Buffer buffer;
+    buffer.appendCopy("abc", 3);
+    TableUsageStats::collect(&buffer);
+    TableUsageStats::Collection stats;
+    EXPECT_TRUE(TableUsageStats::parse(&buffer, 3, buffer.size() - 3,
+            &stats));
+    EXPECT_EQ(2u, stats.size());
+    EXPECT_EQ(2u, stats[5].readCount);
+    EXPECT_EQ(400u, stats[5].readBytes);
+    EXPECT_EQ(40u, stats[5].logBytes);
+    EXPECT_EQ(1u, stats[6].writeCount);
+    EXPECT_EQ(200u, stats[6].writeBytes);
+    EXPECT_EQ(80u, stats[6].cleanerBytes);
+    EXPECT_NEAR(5000.0, static_cast<double>(stats[5].workerCycles), 10.0);
+    EXPECT_EQ(1u, stats[5].requestCount);
+    EXPECT_NEAR(3000.0, static_cast<double>(stats[5].queueingCycles), 10.0);
+    EXPECT_EQ(0u, stats[6].workerCycles);
+
+    // Malformed statistics.
+    EXPECT_FALSE(TableUsageStats::parse(&buffer, 3, buffer.size() - 4,
+            &stats));
+}
+
+TEST_F(TableUsageStatsTest, printClusterUsage) {
+    TableUsageStats::recordRead(5, 1024);
+    TableUsageStats::recordWrite(6, 2048);
+    Buffer first, second;
+    collectForServer(&first, ServerId(1, 0));
+    TableUsageStats::recordRead(5, 2048);
+    collectForServer(&second, ServerId(1, 0));
+
+    string output = TableUsageStats::printClusterUsage(&first, &second);
+    EXPECT_NE(string::npos, output.find("Server index 1:"));
+    EXPECT_NE(string::npos, output.find("  5 "));
+    EXPECT_NE(string::npos, output.find("2.0"));
+
+    // Table 6 was idle between the two readings.
+    EXPECT_EQ(string::npos, output.find("  6 "));
+}
+
+}  // namespace RAMCloud
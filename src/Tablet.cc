@@ -14,6 +14,7 @@
  */
 
 #include "Tablet.h"
+#include "Key.h"
 #include "Logger.h"
 #include "ShortMacros.h"
 
@@ -42,6 +43,9 @@ Tablet::serialize(ProtoBuf::Tablets::Tablet& entry) const
         DIE("Unknown status stored in tablet map");
     entry.set_ctime_log_head_id(ctime.getSegmentId());
     entry.set_ctime_log_head_offset(ctime.getSegmentOffset());
+    Key::HashFunction hashFunction = Key::getHashFunction(tableId);
+    if (hashFunction != Key::MURMUR3)
+        entry.set_key_hash(hashFunction);
 }
 
 /**
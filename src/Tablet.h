@@ -59,6 +59,15 @@ struct Tablet {
      */
     LogPosition ctime;
 
+    /**
+     * While a RECOVERING tablet is being replayed by a recovery master that
+     * serves reads on demand (see OnDemandRecovery), the id of that master;
+     * invalid otherwise. Only kept in the coordinator's memory: it is
+     * never persisted, and a restarted coordinator just waits for such
+     * recoveries to complete.
+     */
+    ServerId recoveryMasterId;
+
     Tablet(uint64_t tableId, uint64_t startKeyHash, uint64_t endKeyHash,
             ServerId serverId, Status status, LogPosition ctime)
         : tableId(tableId)
@@ -67,6 +76,7 @@ struct Tablet {
         , serverId(serverId)
         , status(status)
         , ctime(ctime)
+        , recoveryMasterId()
     {}
 
     Tablet(const Tablet& tablet)
@@ -76,6 +86,7 @@ struct Tablet {
         , serverId(tablet.serverId)
         , status(tablet.status)
         , ctime(tablet.ctime)
+        , recoveryMasterId(tablet.recoveryMasterId)
     {}
 
     void serialize(ProtoBuf::Tablets::Tablet& entry) const;
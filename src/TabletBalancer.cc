@@ -0,0 +1,433 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <memory>
+
+#include "TabletBalancer.h"
+#include "AdminClient.h"
+#include "CoordinatorServerList.h"
+#include "Cycles.h"
+#include "HotKeySketch.h"
+#include "MasterClient.h"
+#include "ShortMacros.h"
+#include "TableManager.h"
+#include "TabletManager.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a TabletBalancer; it doesn't do anything until start is
+ * invoked.
+ *
+ * \param context
+ *      Overall information about the coordinator.
+ * \param tableManager
+ *      The coordinator's table manager.
+ * \param config
+ *      Controls how often and how aggressively tablets are moved.
+ */
+TabletBalancer::TabletBalancer(Context* context, TableManager* tableManager,
+        const Config& config)
+    : context(context)
+    , tableManager(tableManager)
+    , config(config)
+    , samples()
+    , mutex()
+    , stopped()
+    , stop(false)
+    , thread()
+{
+}
+
+/**
+ * Destroy a TabletBalancer, stopping its thread if it's running.
+ */
+TabletBalancer::~TabletBalancer()
+{
+    halt();
+}
+
+/**
+ * Run one round of balancing: measure the load on every master and move
+ * tablets away from the busiest ones if they are overloaded. This is
+ * normally invoked periodically by the balancer's thread, but it may also
+ * be invoked directly (e.g. in tests).
+ *
+ * \return
+ *      The number of tablets moved.
+ */
+uint32_t
+TabletBalancer::balance()
+{
+    vector<MasterLoad> loads;
+    if (!collectLoads(&loads))
+        return 0;
+
+    uint32_t moves = 0;
+    Move move;
+    while (moves < config.maxMovesPerRound && chooseMove(&loads, &move)) {
+        if (applyMove(move))
+            moves++;
+    }
+    return moves;
+}
+
+/**
+ * Stop the balancer's thread, if it's running, and wait for it to exit
+ * (which may take as long as a tablet migration in progress).
+ */
+void
+TabletBalancer::halt()
+{
+    if (!thread)
+        return;
+    {
+        std::lock_guard<std::mutex> _(mutex);
+        stop = true;
+    }
+    stopped.notify_all();
+    thread->join();
+    thread.destroy();
+}
+
+/**
+ * Start a thread that runs #balance every Config::intervalSeconds (unless
+ * that's 0, in which case this does nothing).
+ */
+void
+TabletBalancer::start()
+{
+    if (thread || config.intervalSeconds <= 0)
+        return;
+    stop = false;
+    LOG(NOTICE, "Balancing tablets every %.1f seconds",
+            config.intervalSeconds);
+    thread.construct(&TabletBalancer::main, this);
+}
+
+/**
+ * Carry out a move chosen by chooseMove: split the tablet if only part of
+ * it is to move, then have its master migrate it.
+ *
+ * \param move
+ *      Describes what to move.
+ * \return
+ *      True means the range was migrated; false means the move was
+ *      abandoned (the tablet changed since it was measured, or a step
+ *      failed; a message has been logged).
+ */
+bool
+TabletBalancer::applyMove(const Move& move)
+{
+    try {
+        Tablet tablet = tableManager->getTablet(move.tableId,
+                move.startKeyHash);
+        if (tablet.serverId != move.from ||
+                tablet.status != Tablet::NORMAL ||
+                tablet.endKeyHash < move.endKeyHash) {
+            LOG(NOTICE, "Not moving tablet %lu [0x%lx, 0x%lx]: it changed "
+                    "since its load was measured", move.tableId,
+                    move.startKeyHash, move.endKeyHash);
+            return false;
+        }
+        if (move.startKeyHash != tablet.startKeyHash)
+            tableManager->splitTablet(move.tableId, move.startKeyHash);
+        if (move.endKeyHash != tablet.endKeyHash)
+            tableManager->splitTablet(move.tableId, move.endKeyHash + 1);
+
+        LOG(NOTICE, "Moving tablet %lu [0x%lx, 0x%lx] (%.0f ops/sec) from "
+                "master %s to master %s", move.tableId, move.startKeyHash,
+                move.endKeyHash, move.opsPerSecond,
+                move.from.toString().c_str(), move.to.toString().c_str());
+        MasterClient::migrateTablet(context, move.from, move.tableId,
+                move.startKeyHash, move.endKeyHash, move.to);
+        return true;
+    } catch (const std::exception& e) {
+        LOG(WARNING, "Couldn't move tablet %lu [0x%lx, 0x%lx] from master "
+                "%s to master %s: %s", move.tableId, move.startKeyHash,
+                move.endKeyHash, move.from.toString().c_str(),
+                move.to.toString().c_str(), e.what());
+        return false;
+    }
+}
+
+/**
+ * Decide whether to move some load from the busiest master to the least
+ * busy one, and if so what.
+ *
+ * \param loads
+ *      Current load on each master. If a move is chosen, this is updated
+ *      to reflect it, so that calling this method again chooses another
+ *      one.
+ * \param[out] move
+ *      Filled in with the chosen move, if any.
+ * \return
+ *      True means a move was chosen; false means the load is balanced well
+ *      enough, or can't be improved by moving a tablet.
+ */
+bool
+TabletBalancer::chooseMove(vector<MasterLoad>* loads, Move* move)
+{
+    if (loads->size() < 2)
+        return false;
+    double total = 0;
+    MasterLoad* hot = &loads->front();
+    MasterLoad* cold = &loads->front();
+    foreach (MasterLoad& master, *loads) {
+        total += master.opsPerSecond;
+        if (master.opsPerSecond > hot->opsPerSecond)
+            hot = &master;
+        if (master.opsPerSecond < cold->opsPerSecond)
+            cold = &master;
+    }
+    double average = total / static_cast<double>(loads->size());
+    if (hot->opsPerSecond < config.minOpsPerSecond ||
+            hot->opsPerSecond <= average * (1 + config.imbalance))
+        return false;
+
+    // Ideally we'd move exactly half of the difference, which leaves the
+    // two masters equally loaded. Moving anything less than the whole
+    // difference is still an improvement.
+    double gap = hot->opsPerSecond - cold->opsPerSecond;
+    double target = gap / 2;
+    size_t chosen = hot->tablets.size();
+    double bestError = target;
+    for (size_t t = 0; t < hot->tablets.size(); t++) {
+        const TabletLoad& tablet = hot->tablets[t];
+        if (!tablet.movable || tablet.opsPerSecond <= 0)
+            continue;
+
+        // Consider moving the whole tablet.
+        double error = fabs(tablet.opsPerSecond - target);
+        if (tablet.opsPerSecond < gap && error < bestError) {
+            bestError = error;
+            chosen = t;
+            move->startKeyHash = tablet.startKeyHash;
+            move->endKeyHash = tablet.endKeyHash;
+            move->opsPerSecond = tablet.opsPerSecond;
+        }
+
+        // Consider moving a single hot key, after splitting the tablet on
+        // both sides of it.
+        for (std::map<KeyHash, double>::const_iterator it =
+                tablet.hotKeys.begin(); it != tablet.hotKeys.end(); it++) {
+            double ops = std::min(it->second, tablet.opsPerSecond);
+            error = fabs(ops - target);
+            if (ops > 0 && ops < gap && error < bestError) {
+                bestError = error;
+                chosen = t;
+                move->startKeyHash = it->first;
+                move->endKeyHash = it->first;
+                move->opsPerSecond = ops;
+            }
+        }
+
+        // Consider splitting it at each histogram boundary and moving
+        // either the part below the boundary or the part above.
+        uint32_t buckets = downCast<uint32_t>(tablet.histogram.size());
+        if (buckets != TabletManager::Tablet::ACCESS_HISTOGRAM_BUCKETS)
+            continue;
+        uint64_t width = TabletManager::Tablet::accessBucketWidth(
+                tablet.startKeyHash, tablet.endKeyHash);
+        double histogramTotal = 0;
+        foreach (double ops, tablet.histogram)
+            histogramTotal += ops;
+        if (histogramTotal <= 0)
+            continue;
+        double below = 0;
+        for (uint32_t i = 1; i < buckets; i++) {
+            uint64_t boundary = tablet.startKeyHash + i * width;
+            if (boundary > tablet.endKeyHash ||
+                    boundary <= tablet.startKeyHash)
+                break;
+            below += tablet.histogram[i - 1];
+
+            // The histogram only tells us how the tablet's load divides;
+            // scale it to the tablet's measured rate.
+            double lower = tablet.opsPerSecond * below / histogramTotal;
+            double upper = tablet.opsPerSecond - lower;
+            error = fabs(lower - target);
+            if (lower > 0 && lower < gap && error < bestError) {
+                bestError = error;
+                chosen = t;
+                move->startKeyHash = tablet.startKeyHash;
+                move->endKeyHash = boundary - 1;
+                move->opsPerSecond = lower;
+            }
+            error = fabs(upper - target);
+            if (upper > 0 && upper < gap && error < bestError) {
+                bestError = error;
+                chosen = t;
+                move->startKeyHash = boundary;
+                move->endKeyHash = tablet.endKeyHash;
+                move->opsPerSecond = upper;
+            }
+        }
+    }
+    if (chosen == hot->tablets.size())
+        return false;
+
+    move->from = hot->serverId;
+    move->to = cold->serverId;
+    move->tableId = hot->tablets[chosen].tableId;
+    hot->opsPerSecond -= move->opsPerSecond;
+    cold->opsPerSecond += move->opsPerSecond;
+
+    // Don't consider the tablet again until it has been measured in its new
+    // form.
+    hot->tablets.erase(hot->tablets.begin() + chosen);
+    return true;
+}
+
+/**
+ * Ask every master for its per-tablet counters and its hot keys, and
+ * compute the load on each tablet since the previous call.
+ *
+ * \param[out] loads
+ *      Filled in with one entry for each master that responded.
+ * \return
+ *      True means the load of every tablet is known. False means some
+ *      tablets are new since the last call (e.g. because they were just
+ *      split or moved, or this is the first call), so the caller shouldn't
+ *      act on \a loads.
+ */
+bool
+TabletBalancer::collectLoads(vector<MasterLoad>* loads)
+{
+    // Send all of the requests first, so they proceed in parallel.
+    vector<ServerId> masters;
+    vector<std::unique_ptr<GetTabletStatisticsRpc>> rpcs;
+    vector<std::unique_ptr<Buffer>> hotKeyBuffers;
+    vector<std::unique_ptr<ServerControlRpc>> hotKeyRpcs;
+    ServerId id;
+    while (true) {
+        bool end;
+        id = context->coordinatorServerList->nextServer(id,
+                ServiceMask({WireFormat::MASTER_SERVICE}), &end);
+        if (end)
+            break;
+        masters.push_back(id);
+        rpcs.emplace_back(new GetTabletStatisticsRpc(context, id));
+        hotKeyBuffers.emplace_back(new Buffer());
+        hotKeyRpcs.emplace_back(new ServerControlRpc(context, id,
+                WireFormat::GET_HOT_KEYS, NULL, 0,
+                hotKeyBuffers.back().get()));
+    }
+
+    bool complete = true;
+    SampleMap newSamples;
+    for (size_t i = 0; i < masters.size(); i++) {
+        ProtoBuf::ServerStatistics stats;
+        try {
+            rpcs[i]->wait(&stats);
+        } catch (const ServerNotUpException& e) {
+            // The master has crashed; its tablets will be recovered
+            // elsewhere and measured again there.
+            complete = false;
+            continue;
+        }
+        uint64_t now = Cycles::rdtsc();
+
+        // Hot keys are only a refinement, so a master that can't report
+        // them is still balanced by its tablet counters.
+        std::vector<HotKeySketch::HotKey> hotKeys;
+        try {
+            hotKeyRpcs[i]->wait();
+            if (!HotKeySketch::parse(hotKeyBuffers[i].get(), 0,
+                    hotKeyBuffers[i]->size(), &hotKeys))
+                hotKeys.clear();
+        } catch (const ClientException& e) {
+            hotKeys.clear();
+        }
+
+        loads->emplace_back();
+        MasterLoad& master = loads->back();
+        master.serverId = masters[i];
+        for (int j = 0; j < stats.tabletentry_size(); j++) {
+            const ProtoBuf::ServerStatistics::TabletEntry& entry =
+                    stats.tabletentry(j);
+            TabletKey key(masters[i].getId(), entry.table_id(),
+                    entry.start_key_hash(), entry.end_key_hash());
+            Sample& sample = newSamples[key];
+            sample.ops = entry.number_read_and_writes();
+            for (int k = 0; k < entry.access_histogram_size(); k++)
+                sample.histogram.push_back(entry.access_histogram(k));
+            sample.time = now;
+
+            SampleMap::iterator previous = samples.find(key);
+            if (previous == samples.end() ||
+                    previous->second.ops > sample.ops ||
+                    previous->second.time >= now) {
+                complete = false;
+                continue;
+            }
+            double seconds = Cycles::toSeconds(now - previous->second.time);
+            master.tablets.emplace_back();
+            TabletLoad& tablet = master.tablets.back();
+            tablet.tableId = entry.table_id();
+            tablet.startKeyHash = entry.start_key_hash();
+            tablet.endKeyHash = entry.end_key_hash();
+            tablet.opsPerSecond = static_cast<double>(
+                    sample.ops - previous->second.ops) / seconds;
+            tablet.movable = !tableManager->isIndexletTable(tablet.tableId);
+            foreach (const HotKeySketch::HotKey& hotKey, hotKeys) {
+                if (hotKey.tableId != tablet.tableId ||
+                        hotKey.startKeyHash != tablet.startKeyHash ||
+                        hotKey.endKeyHash != tablet.endKeyHash)
+                    continue;
+                // Use the lower bound on the count, so that a key never
+                // looks hotter than it is.
+                tablet.hotKeys[hotKey.keyHash] = HotKeySketch::toOpsPerSecond(
+                        hotKey.count - hotKey.error);
+            }
+            const vector<uint64_t>& old = previous->second.histogram;
+            for (size_t k = 0; k < sample.histogram.size(); k++) {
+                uint64_t before = (k < old.size()) ? old[k] : 0;
+                tablet.histogram.push_back(static_cast<double>(
+                        sample.histogram[k] - before) / seconds);
+            }
+            master.opsPerSecond += tablet.opsPerSecond;
+        }
+    }
+    samples.swap(newSamples);
+    return complete;
+}
+
+/**
+ * Top-level method of the balancer's thread: runs #balance periodically
+ * until halt is invoked.
+ */
+void
+TabletBalancer::main()
+try {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::chrono::microseconds interval(
+            static_cast<uint64_t>(config.intervalSeconds * 1e06));
+    while (true) {
+        if (stopped.wait_for(lock, interval, [this] {return stop;}))
+            break;
+        lock.unlock();
+        balance();
+        lock.lock();
+    }
+} catch (const std::exception& e) {
+    LOG(ERROR, "Fatal error in TabletBalancer: %s", e.what());
+    throw;
+} catch (...) {
+    LOG(ERROR, "Unknown fatal error in TabletBalancer.");
+    throw;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,202 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_TABLETBALANCER_H
+#define RAMCLOUD_TABLETBALANCER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#include "Common.h"
+#include "Key.h"
+#include "ServerId.h"
+#include "Tub.h"
+
+namespace RAMCloud {
+
+class TableManager;
+
+/**
+ * Runs on the coordinator and moves load off of overloaded masters. Every
+ * so often it asks each master how many reads and writes each of its
+ * tablets has served (see TabletManager::getStatistics), turns the counts
+ * into rates, and, if the busiest master is well above the average, moves
+ * about half the difference between it and the least busy master: either
+ * a whole tablet, or part of one after splitting it where the per-tablet
+ * access histogram says the load divides best. It also asks each master
+ * for its hottest keys (see HotKeySketch), so that a single key carrying
+ * much of a tablet's load can be moved on its own.
+ *
+ * Moves are rate-limited: at most Config::maxMovesPerRound per round, and
+ * a round only makes decisions if the loads of all tablets are known, so
+ * after tablets have been split or moved the balancer waits a round for
+ * fresh measurements before moving anything else.
+ *
+ * The balancer is off unless Config::intervalSeconds is nonzero.
+ */
+class TabletBalancer {
+  PUBLIC:
+    /**
+     * Parameters that control how aggressively the balancer moves load.
+     * See the corresponding coordinator options.
+     */
+    struct Config {
+        Config()
+            : intervalSeconds(0)
+            , imbalance(0.25)
+            , minOpsPerSecond(10000)
+            , maxMovesPerRound(1)
+        {}
+
+        /// Seconds between rounds; 0 disables the balancer.
+        double intervalSeconds;
+
+        /// A master is overloaded if its load exceeds the average load by
+        /// more than this fraction of the average.
+        double imbalance;
+
+        /// Masters serving fewer reads and writes per second than this
+        /// are never considered overloaded.
+        double minOpsPerSecond;
+
+        /// Maximum number of tablets to move in one round.
+        uint32_t maxMovesPerRound;
+    };
+
+    /// Recent load on one tablet.
+    struct TabletLoad {
+        TabletLoad()
+            : tableId(0), startKeyHash(0), endKeyHash(0), opsPerSecond(0)
+            , histogram(), hotKeys(), movable(true)
+        {}
+
+        uint64_t tableId;
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+
+        /// Reads and writes per second.
+        double opsPerSecond;
+
+        /// Reads and writes per second in each slice of the key hash range
+        /// (see TabletManager::Tablet::accessHistogram); empty if unknown.
+        vector<double> histogram;
+
+        /// Reads and writes per second of the tablet's hottest keys, by
+        /// key hash; empty if unknown.
+        std::map<KeyHash, double> hotKeys;
+
+        /// False means the tablet must stay where it is (e.g., it backs an
+        /// index); its load still counts toward its master's.
+        bool movable;
+    };
+
+    /// Recent load on one master.
+    struct MasterLoad {
+        MasterLoad() : serverId(), opsPerSecond(0), tablets() {}
+
+        ServerId serverId;
+
+        /// Reads and writes per second, summed over all of its tablets.
+        double opsPerSecond;
+
+        vector<TabletLoad> tablets;
+    };
+
+    /// A decision to move a key hash range from one master to another.
+    struct Move {
+        Move()
+            : from(), to(), tableId(0), startKeyHash(0), endKeyHash(0)
+            , opsPerSecond(0)
+        {}
+
+        ServerId from;
+        ServerId to;
+        uint64_t tableId;
+
+        /// The range to move. If it's only part of an existing tablet, the
+        /// tablet is split first.
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+
+        /// Load expected to move along with the range.
+        double opsPerSecond;
+    };
+
+    TabletBalancer(Context* context, TableManager* tableManager,
+            const Config& config);
+    ~TabletBalancer();
+    uint32_t balance();
+    void halt();
+    void start();
+
+  PRIVATE:
+    bool applyMove(const Move& move);
+    bool chooseMove(vector<MasterLoad>* loads, Move* move);
+    bool collectLoads(vector<MasterLoad>* loads);
+    void main();
+
+    /// Identifies a tablet on a particular master: server id, table id,
+    /// and first and last key hashes.
+    typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t> TabletKey;
+
+    /// The counters a master reported for one of its tablets, and when.
+    struct Sample {
+        Sample() : ops(0), histogram(), time(0) {}
+
+        /// Reads plus writes.
+        uint64_t ops;
+
+        /// See ServerStatistics.TabletEntry.access_histogram.
+        vector<uint64_t> histogram;
+
+        /// Cycles::rdtsc() when the counters were received.
+        uint64_t time;
+    };
+    typedef std::map<TabletKey, Sample> SampleMap;
+
+    /// Shared information about the coordinator.
+    Context* context;
+
+    /// Where the balancer splits tablets and checks their ownership.
+    TableManager* tableManager;
+
+    /// Copy of the configuration passed to the constructor.
+    Config config;
+
+    /// The counters from the most recent round, which the next round
+    /// subtracts to compute rates.
+    SampleMap samples;
+
+    /// Protects #stop.
+    std::mutex mutex;
+
+    /// Used to wake up #main early when halt is invoked.
+    std::condition_variable stopped;
+
+    /// Set by halt to make #main return.
+    bool stop;
+
+    /// Runs #main; empty when the balancer isn't running.
+    Tub<std::thread> thread;
+
+    DISALLOW_COPY_AND_ASSIGN(TabletBalancer);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_TABLETBALANCER_H
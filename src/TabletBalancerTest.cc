@@ -0,0 +1,280 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "HotKeySketch.h"
+#include "MockCluster.h"
+#include "TabletBalancer.h"
+
+namespace RAMCloud {
+
+class TabletBalancerTest : public ::testing::Test {
+  public:
+    TestLog::Enable logEnabler;
+    Context context;
+    MockCluster cluster;
+    TableManager* tableManager;
+    ServerConfig masterConfig;
+    TabletBalancer::Config config;
+    Tub<TabletBalancer> balancer;
+
+    TabletBalancerTest()
+        : logEnabler()
+        , context()
+        , cluster(&context)
+        , tableManager(&cluster.coordinator->tableManager)
+        , masterConfig(ServerConfig::forTesting())
+        , config()
+        , balancer()
+    {
+        Logger::get().setLogLevels(RAMCloud::SILENT_LOG_LEVEL);
+        masterConfig.services = {WireFormat::MASTER_SERVICE,
+                                 WireFormat::ADMIN_SERVICE};
+        config.minOpsPerSecond = 0;
+        balancer.construct(cluster.coordinator->context, tableManager,
+                config);
+    }
+
+    /**
+     * Add a master with a given load, made up of tablets 0x0-0xffff,
+     * 0x10000-0x1ffff, etc. of table 1, one per value in \a tabletOps.
+     */
+    void
+    addMaster(vector<TabletBalancer::MasterLoad>* loads, uint64_t id,
+            vector<double> tabletOps)
+    {
+        loads->emplace_back();
+        TabletBalancer::MasterLoad& master = loads->back();
+        master.serverId = ServerId(downCast<uint32_t>(id), 0);
+        foreach (double ops, tabletOps) {
+            master.tablets.emplace_back();
+            TabletBalancer::TabletLoad& tablet = master.tablets.back();
+            tablet.tableId = 1;
+            tablet.startKeyHash = id << 32 | master.tablets.size() << 16;
+            tablet.endKeyHash = tablet.startKeyHash + 0xffff;
+            tablet.opsPerSecond = ops;
+            master.opsPerSecond += ops;
+        }
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(TabletBalancerTest);
+};
+
+TEST_F(TabletBalancerTest, chooseMove_wholeTablet) {
+    vector<TabletBalancer::MasterLoad> loads;
+    addMaster(&loads, 1, {1000, 4000, 500});
+    addMaster(&loads, 2, {1500});
+    addMaster(&loads, 3, {3000});
+
+    TabletBalancer::Move move;
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+    EXPECT_EQ(ServerId(1, 0), move.from);
+    EXPECT_EQ(ServerId(2, 0), move.to);
+    EXPECT_EQ(1u, move.tableId);
+    EXPECT_EQ(0x100010000u, move.startKeyHash);
+    EXPECT_EQ(0x10001ffffu, move.endKeyHash);
+    EXPECT_EQ(1000, move.opsPerSecond);
+
+    // The loads reflect the move.
+    EXPECT_EQ(4500, loads[0].opsPerSecond);
+    EXPECT_EQ(2u, loads[0].tablets.size());
+    EXPECT_EQ(2500, loads[1].opsPerSecond);
+
+    // The first master is still overloaded; after another move it's
+    // balanced well enough.
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+    EXPECT_EQ(0x100030000u, move.startKeyHash);
+    EXPECT_EQ(4000, loads[0].opsPerSecond);
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+}
+
+TEST_F(TabletBalancerTest, chooseMove_balanced) {
+    vector<TabletBalancer::MasterLoad> loads;
+    TabletBalancer::Move move;
+    addMaster(&loads, 1, {1200});
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+    addMaster(&loads, 2, {1000});
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+}
+
+TEST_F(TabletBalancerTest, chooseMove_belowMinOps) {
+    vector<TabletBalancer::MasterLoad> loads;
+    TabletBalancer::Move move;
+    addMaster(&loads, 1, {100, 100});
+    addMaster(&loads, 2, {});
+    balancer->config.minOpsPerSecond = 1000;
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+    balancer->config.minOpsPerSecond = 100;
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+}
+
+TEST_F(TabletBalancerTest, chooseMove_notMovable) {
+    vector<TabletBalancer::MasterLoad> loads;
+    TabletBalancer::Move move;
+    addMaster(&loads, 1, {1000, 1000});
+    addMaster(&loads, 2, {});
+    loads[0].tablets[0].movable = false;
+    loads[0].tablets[1].movable = false;
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+    loads[0].tablets[1].movable = true;
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+    EXPECT_EQ(0x100020000u, move.startKeyHash);
+}
+
+TEST_F(TabletBalancerTest, chooseMove_split) {
+    vector<TabletBalancer::MasterLoad> loads;
+    addMaster(&loads, 1, {4000});
+    addMaster(&loads, 2, {});
+    TabletBalancer::TabletLoad& tablet = loads[0].tablets[0];
+    tablet.startKeyHash = 0;
+    tablet.endKeyHash = ~0lu;
+
+    // Without a histogram, the only choice would be to move the whole
+    // tablet, which doesn't help.
+    TabletBalancer::Move move;
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+
+    // The histogram counts are scaled to the tablet's rate; the best split
+    // leaves 1/4 + 1/8 + 1/8 of the load below the boundary.
+    tablet.histogram = {2, 0, 1, 1, 0, 3, 0, 1};
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+    EXPECT_EQ(0u, move.startKeyHash);
+    EXPECT_EQ(0x7fffffffffffffffu, move.endKeyHash);
+    EXPECT_EQ(2000, move.opsPerSecond);
+    EXPECT_EQ(0u, loads[0].tablets.size());
+    EXPECT_EQ(2000, loads[0].opsPerSecond);
+    EXPECT_EQ(2000, loads[1].opsPerSecond);
+}
+
+TEST_F(TabletBalancerTest, chooseMove_splitUpperPart) {
+    vector<TabletBalancer::MasterLoad> loads;
+    addMaster(&loads, 1, {1000, 3000});
+    addMaster(&loads, 2, {});
+    TabletBalancer::TabletLoad& tablet = loads[0].tablets[1];
+    tablet.startKeyHash = 0;
+    tablet.endKeyHash = ~0lu;
+    tablet.histogram = {0, 0, 0, 0, 0, 0, 1, 2};
+
+    TabletBalancer::Move move;
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+    EXPECT_EQ(0xe000000000000000u, move.startKeyHash);
+    EXPECT_EQ(~0lu, move.endKeyHash);
+    EXPECT_EQ(2000, move.opsPerSecond);
+}
+
+TEST_F(TabletBalancerTest, chooseMove_hotKey) {
+    vector<TabletBalancer::MasterLoad> loads;
+    addMaster(&loads, 1, {4000});
+    addMaster(&loads, 2, {});
+    TabletBalancer::TabletLoad& tablet = loads[0].tablets[0];
+    tablet.histogram = {3, 0, 0, 0, 0, 0, 0, 1};
+
+    // A single key carrying about half of the load is a better move than
+    // any split the histogram allows.
+    tablet.hotKeys[0x100011234] = 2100;
+    tablet.hotKeys[0x100015678] = 100;
+    TabletBalancer::Move move;
+    EXPECT_TRUE(balancer->chooseMove(&loads, &move));
+    EXPECT_EQ(0x100011234u, move.startKeyHash);
+    EXPECT_EQ(0x100011234u, move.endKeyHash);
+    EXPECT_EQ(2100, move.opsPerSecond);
+}
+
+TEST_F(TabletBalancerTest, chooseMove_hotKeyTooHot) {
+    vector<TabletBalancer::MasterLoad> loads;
+    addMaster(&loads, 1, {4000});
+    addMaster(&loads, 2, {});
+
+    // Moving a key that carries all of the load would just move the
+    // hot spot.
+    loads[0].tablets[0].hotKeys[0x100011234] = 5000;
+    TabletBalancer::Move move;
+    EXPECT_FALSE(balancer->chooseMove(&loads, &move));
+}
+
+TEST_F(TabletBalancerTest, collectLoads_hotKeys) {
+    MasterService* master = cluster.addServer(masterConfig)->master.get();
+    uint64_t tableId = tableManager->createTable("foo", 1);
+    HotKeySketch* sketch = master->getHotKeySketch();
+    sketch->sampleInterval = 1;
+    HotKeySketch::countdown = 0;
+    Key key(tableId, "hot", 3);
+    for (int i = 0; i < 10; i++)
+        sketch->recordRead(key);
+
+    vector<TabletBalancer::MasterLoad> loads;
+    EXPECT_FALSE(balancer->collectLoads(&loads));
+    loads.clear();
+    master->tabletManager.incrementReadCount(tableId, 0x100);
+    EXPECT_TRUE(balancer->collectLoads(&loads));
+    ASSERT_EQ(1u, loads.size());
+    ASSERT_EQ(1u, loads[0].tablets.size());
+    TabletBalancer::TabletLoad& tablet = loads[0].tablets[0];
+    ASSERT_EQ(1u, tablet.hotKeys.size());
+    EXPECT_EQ(key.getHash(), tablet.hotKeys.begin()->first);
+    EXPECT_EQ(HotKeySketch::toOpsPerSecond(10),
+            tablet.hotKeys.begin()->second);
+}
+
+TEST_F(TabletBalancerTest, balance) {
+    MasterService* master1 = cluster.addServer(masterConfig)->master.get();
+    uint64_t tableId = tableManager->createTable("foo", 1);
+    MasterService* master2 = cluster.addServer(masterConfig)->master.get();
+
+    // The first round only measures.
+    EXPECT_EQ(0u, balancer->balance());
+    for (int i = 0; i < 1000; i++) {
+        master1->tabletManager.incrementReadCount(tableId, 0x100);
+        master1->tabletManager.incrementReadCount(tableId,
+                0xf000000000000000);
+    }
+    EXPECT_EQ(1u, balancer->balance());
+    EXPECT_EQ("{ foo(id 1): { 0x0-0x1fffffffffffffff on 2.0 } "
+            "{ 0x2000000000000000-0xffffffffffffffff on 1.0 } }",
+            tableManager->debugString(true));
+    EXPECT_EQ(1U, master1->tabletManager.getNumTablets());
+    EXPECT_EQ(1U, master2->tabletManager.getNumTablets());
+
+    // The next round waits for measurements of the new tablets.
+    master1->tabletManager.incrementReadCount(tableId, 0xf000000000000000);
+    EXPECT_EQ(0u, balancer->balance());
+}
+
+TEST_F(TabletBalancerTest, applyMove_tabletChanged) {
+    cluster.addServer(masterConfig);
+    uint64_t tableId = tableManager->createTable("foo", 1);
+    TabletBalancer::Move move;
+    move.from = ServerId(5, 0);
+    move.to = ServerId(1, 0);
+    move.tableId = tableId;
+    move.endKeyHash = ~0lu;
+    TestLog::reset();
+    EXPECT_FALSE(balancer->applyMove(move));
+    EXPECT_EQ("applyMove: Not moving tablet 1 [0x0, 0xffffffffffffffff]: "
+            "it changed since its load was measured", TestLog::get());
+}
+
+TEST_F(TabletBalancerTest, startAndHalt) {
+    balancer->start();
+    EXPECT_FALSE(balancer->thread);
+
+    balancer->config.intervalSeconds = 1000;
+    balancer->start();
+    EXPECT_TRUE(balancer->thread);
+    balancer->halt();
+    EXPECT_FALSE(balancer->thread);
+}
+
+}  // namespace RAMCloud
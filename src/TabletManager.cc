@@ -16,18 +16,43 @@
 
 #include "ClientException.h"
 #include "TabletManager.h"
+#include "ThreadId.h"
 #include "TimeTrace.h"
 #include "Util.h"
 
 namespace RAMCloud {
 
+bool compareTablet(const TabletManager::Tablet &a,
+                   const TabletManager::Tablet &b);
+
 TabletManager::TabletManager()
     : tabletMap()
     , lock("TabletManager::lock")
     , numLoadingTablets(0)
+    , snapshot(new Snapshot())
+    , retiredSnapshots()
+    , retiredCounters()
+    , readers()
 {
 }
 
+/**
+ * Free the tablet snapshots and counts. No other thread may be using this
+ * TabletManager anymore.
+ */
+TabletManager::~TabletManager()
+{
+    for (TabletMap::iterator it = tabletMap.begin(); it != tabletMap.end();
+            ++it) {
+        delete it->second.counters;
+    }
+    foreach (Counters* retired, retiredCounters)
+        delete retired;
+    foreach (Snapshot* retired, retiredSnapshots)
+        delete retired;
+    delete snapshot.load();
+}
+
 /**
  * Add a new tablet to this TabletManager's list of tablets. If the tablet
  * already exists or overlaps with any other tablets, the call will fail.
@@ -59,13 +84,15 @@ TabletManager::addTablet(uint64_t tableId,
         return false;
     }
 
-    tabletMap.insert(std::make_pair(tableId,
-                     Tablet(tableId, startKeyHash, endKeyHash, state)));
+    Tablet tablet(tableId, startKeyHash, endKeyHash, state);
+    tablet.counters = new Counters();
+    tabletMap.insert(std::make_pair(tableId, tablet));
 
     if (state == TabletState::NOT_READY) {
         numLoadingTablets++;
     }
 
+    publishSnapshot(guard);
     return true;
 }
 
@@ -82,19 +109,19 @@ TabletManager::addTablet(uint64_t tableId,
  */
 bool
 TabletManager::checkAndIncrementReadCount(Key& key) {
-    SpinLock::Guard guard(lock);
-    TabletMap::iterator it = lookup(key.getTableId(), key.getHash(), guard);
+    SnapshotReader reader(this);
+    const Tablet* tablet = reader.lookup(key.getTableId(), key.getHash());
 
-    if (it == tabletMap.end())
+    if (tablet == NULL)
         return false;
-    if (it->second.state != NORMAL) {
-        if (it->second.state == TabletManager::LOCKED_FOR_MIGRATION)
+    if (tablet->state != NORMAL) {
+        if (tablet->state == TabletManager::LOCKED_FOR_MIGRATION)
             throw RetryException(HERE, 1000, 2000,
                     "Tablet is currently locked for migration!");
         return false;
     }
 
-    it->second.readCount++;
+    tablet->counters->recordRead(*tablet, key.getHash());
     return true;
 }
 
@@ -137,14 +164,16 @@ TabletManager::getTablet(Key& key, Tablet* outTablet)
 bool
 TabletManager::getTablet(uint64_t tableId, uint64_t keyHash, Tablet* outTablet)
 {
-    SpinLock::Guard guard(lock);
+    SnapshotReader reader(this);
 
-    TabletMap::iterator it = lookup(tableId, keyHash, guard);
-    if (it == tabletMap.end())
+    const Tablet* tablet = reader.lookup(tableId, keyHash);
+    if (tablet == NULL)
         return false;
 
-    if (outTablet != NULL)
-        *outTablet = it->second;
+    if (outTablet != NULL) {
+        *outTablet = *tablet;
+        tablet->counters->copyTo(outTablet);
+    }
     return true;
 }
 
@@ -183,8 +212,10 @@ TabletManager::getTablet(uint64_t tableId,
     if (t->startKeyHash != startKeyHash || t->endKeyHash != endKeyHash)
         return false;
 
-    if (outTablet != NULL)
+    if (outTablet != NULL) {
         *outTablet = *t;
+        t->counters->copyTo(outTablet);
+    }
     return true;
 }
 
@@ -203,6 +234,7 @@ TabletManager::getTablets(vector<Tablet>* outTablets)
     TabletMap::iterator it = tabletMap.begin();
     for (size_t i = 0; it != tabletMap.end(); i++) {
         outTablets->push_back(it->second);
+        it->second.counters->copyTo(&outTablets->back());
         ++it;
     }
 }
@@ -248,12 +280,14 @@ TabletManager::deleteTablet(uint64_t tableId,
         throw InternalError(HERE, STATUS_INTERNAL_ERROR);
     }
 
-    tabletMap.erase(it);
-
     if (t->state == TabletState::NOT_READY) {
         numLoadingTablets--;
     }
 
+    // Threads in a SnapshotReader may still be counting into the tablet.
+    retiredCounters.push_back(t->counters);
+    tabletMap.erase(it);
+    publishSnapshot(guard);
     return true;
 }
 
@@ -291,18 +325,22 @@ TabletManager::splitTablet(uint64_t tableId,
     // So to make it idempotent, check for this condition before you
     // decide to do the split
     if (splitKeyHash != t->startKeyHash) {
-        tabletMap.insert(std::make_pair(tableId, Tablet
-                         (tableId, splitKeyHash, t->endKeyHash, t->state)));
+        Tablet upper(tableId, splitKeyHash, t->endKeyHash, t->state);
+        upper.counters = new Counters();
         t->endKeyHash = splitKeyHash - 1;
 
         // It's unclear what to do with the counts when splitting. The old
         // behavior was to simply zero them, so for the time being we'll
         // stick with that. At the very least it's what Christian expects.
-        t->readCount = t->writeCount = 0;
+        t->counters->clear();
 
         if (t->state == TabletState::NOT_READY) {
             numLoadingTablets++;
         }
+
+        // Inserting may rehash the map, which invalidates t.
+        tabletMap.insert(std::make_pair(tableId, upper));
+        publishSnapshot(guard);
     }
 
     return true;
@@ -358,6 +396,7 @@ TabletManager::changeState(uint64_t tableId,
         numLoadingTablets--;
     }
 
+    publishSnapshot(guard);
     return true;
 }
 
@@ -378,10 +417,10 @@ TabletManager::incrementReadCount(Key& key)
 void
 TabletManager::incrementReadCount(uint64_t tableId, KeyHash keyHash)
 {
-    SpinLock::Guard guard(lock);
-    TabletMap::iterator it = lookup(tableId, keyHash, guard);
-    if (it != tabletMap.end())
-        it->second.readCount++;
+    SnapshotReader reader(this);
+    const Tablet* tablet = reader.lookup(tableId, keyHash);
+    if (tablet != NULL)
+        tablet->counters->recordRead(*tablet, keyHash);
 }
 
 /**
@@ -401,10 +440,10 @@ TabletManager::incrementWriteCount(Key& key)
 void
 TabletManager::incrementWriteCount(uint64_t tableId, KeyHash keyHash)
 {
-    SpinLock::Guard guard(lock);
-    TabletMap::iterator it = lookup(tableId, keyHash, guard);
-    if (it != tabletMap.end())
-        it->second.writeCount++;
+    SnapshotReader reader(this);
+    const Tablet* tablet = reader.lookup(tableId, keyHash);
+    if (tablet != NULL)
+        tablet->counters->recordWrite(*tablet, keyHash);
 }
 
 /**
@@ -418,15 +457,22 @@ TabletManager::getStatistics(ProtoBuf::ServerStatistics* serverStatistics)
 
     TabletMap::iterator it = tabletMap.begin();
     while (it != tabletMap.end()) {
-        Tablet* t = &it->second;
+        Tablet tablet = it->second;
+        tablet.counters->copyTo(&tablet);
+        Tablet* t = &tablet;
         ProtoBuf::ServerStatistics_TabletEntry* entry =
             serverStatistics->add_tabletentry();
         entry->set_table_id(t->tableId);
         entry->set_start_key_hash(t->startKeyHash);
         entry->set_end_key_hash(t->endKeyHash);
         uint64_t totalOperations = t->readCount + t->writeCount;
-        if (totalOperations > 0)
+        if (totalOperations > 0) {
             entry->set_number_read_and_writes(totalOperations);
+            entry->set_read_count(t->readCount);
+            entry->set_write_count(t->writeCount);
+            for (uint32_t i = 0; i < Tablet::ACCESS_HISTOGRAM_BUCKETS; i++)
+                entry->add_access_histogram(t->accessHistogram[i]);
+        }
         ++it;
     }
 }
@@ -490,8 +536,10 @@ TabletManager::toString()
     TabletMap::iterator it;
     vector<Tablet> tablets;
 
-    for (it = tabletMap.begin(); it != tabletMap.end(); ++it)
+    for (it = tabletMap.begin(); it != tabletMap.end(); ++it) {
         tablets.push_back(it->second);
+        it->second.counters->copyTo(&tablets.back());
+    }
     sort(tablets.begin(), tablets.end(), compareTablet);
 
     for (size_t i = 0; i < tablets.size(); ++i)
@@ -499,7 +547,9 @@ TabletManager::toString()
 #else
     for (TabletMap::iterator it = tabletMap.begin();
             it != tabletMap.end(); ++it) {
-       printTablet(&(it->second), &output);
+       Tablet tablet = it->second;
+       tablet.counters->copyTo(&tablet);
+       printTablet(&tablet, &output);
     }
 #endif
 
@@ -539,6 +589,174 @@ TabletManager::lookup(uint64_t tableId, uint64_t keyHash,
     return tabletMap.end();
 }
 
+/**
+ * Free the snapshots in #retiredSnapshots and the counters in
+ * #retiredCounters if no thread can be using them anymore: that is, if every
+ * count in #readers is zero. (A thread that creates a SnapshotReader after
+ * they were retired can only load a newer snapshot, which doesn't refer to
+ * them, and every count in #readers is incremented before the pointer is
+ * loaded, so seeing each count at zero, one after another, is enough.) If
+ * some thread is inside, they are kept for a later call.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+TabletManager::freeRetired(const SpinLock::Guard& lock)
+{
+    foreach (ReaderCount& reader, readers) {
+        if (reader.count.load() != 0)
+            return;
+    }
+    foreach (Snapshot* retired, retiredSnapshots)
+        delete retired;
+    retiredSnapshots.clear();
+    foreach (Counters* retired, retiredCounters)
+        delete retired;
+    retiredCounters.clear();
+}
+
+/**
+ * Replace #snapshot with a fresh copy of tabletMap. This must be invoked
+ * whenever a tablet is added, removed or changes, so that the lock-free
+ * lookups never return stale information once the change has returned.
+ *
+ * \param lock
+ *      Ensures that the caller holds the monitor lock; not actually used.
+ */
+void
+TabletManager::publishSnapshot(const SpinLock::Guard& lock)
+{
+    Snapshot* fresh = new Snapshot();
+    fresh->tablets.reserve(tabletMap.size());
+    for (TabletMap::iterator it = tabletMap.begin(); it != tabletMap.end();
+            ++it) {
+        fresh->tablets.push_back(it->second);
+    }
+    std::sort(fresh->tablets.begin(), fresh->tablets.end(), compareTablet);
+    retiredSnapshots.push_back(snapshot.exchange(fresh));
+    freeRetired(lock);
+}
+
+TabletManager::Counters::Counters()
+    : readCount(0)
+    , writeCount(0)
+{
+    for (uint32_t i = 0; i < Tablet::ACCESS_HISTOGRAM_BUCKETS; i++)
+        accessHistogram[i] = 0;
+}
+
+/**
+ * Start all counts over from zero.
+ */
+void
+TabletManager::Counters::clear()
+{
+    readCount = 0;
+    writeCount = 0;
+    for (uint32_t i = 0; i < Tablet::ACCESS_HISTOGRAM_BUCKETS; i++)
+        accessHistogram[i] = 0;
+}
+
+/**
+ * Fill in the count fields of a copy of the tablet these counts belong to.
+ */
+void
+TabletManager::Counters::copyTo(Tablet* tablet) const
+{
+    tablet->readCount = readCount.load(std::memory_order_relaxed);
+    tablet->writeCount = writeCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < Tablet::ACCESS_HISTOGRAM_BUCKETS; i++) {
+        tablet->accessHistogram[i] =
+                accessHistogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Count one read of the object with the given key hash.
+ *
+ * \param tablet
+ *      The tablet these counts belong to; gives its key hash range.
+ * \param keyHash
+ *      Key hash of the object read.
+ */
+void
+TabletManager::Counters::recordRead(const Tablet& tablet, uint64_t keyHash)
+{
+    readCount.fetch_add(1, std::memory_order_relaxed);
+    accessHistogram[(keyHash - tablet.startKeyHash) /
+            Tablet::accessBucketWidth(tablet.startKeyHash, tablet.endKeyHash)]
+            .fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Count one write of the object with the given key hash.
+ *
+ * \param tablet
+ *      The tablet these counts belong to; gives its key hash range.
+ * \param keyHash
+ *      Key hash of the object written.
+ */
+void
+TabletManager::Counters::recordWrite(const Tablet& tablet, uint64_t keyHash)
+{
+    writeCount.fetch_add(1, std::memory_order_relaxed);
+    accessHistogram[(keyHash - tablet.startKeyHash) /
+            Tablet::accessBucketWidth(tablet.startKeyHash, tablet.endKeyHash)]
+            .fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Announce the calling thread in the readers of a TabletManager, then load
+ * its current snapshot.
+ *
+ * \param tabletManager
+ *      The TabletManager whose snapshot is to be searched.
+ */
+TabletManager::SnapshotReader::SnapshotReader(TabletManager* tabletManager)
+    : reader(tabletManager->readers[ThreadId::get() % NUM_READER_COUNTS])
+    , snapshot(NULL)
+{
+    // Announce ourselves before loading the pointer, so that freeRetired
+    // can't free the snapshot underneath us; see there.
+    reader.count.fetch_add(1);
+    snapshot = tabletManager->snapshot.load();
+}
+
+TabletManager::SnapshotReader::~SnapshotReader()
+{
+    reader.count.fetch_sub(1);
+}
+
+/**
+ * Find the tablet containing a key hash in the snapshot.
+ *
+ * \param tableId
+ *      Identifier of the table to look up.
+ * \param keyHash
+ *      Key hash value corresponding to the desired tablet.
+ * \return
+ *      The tablet, or NULL if there is none. It remains valid for as long
+ *      as this SnapshotReader exists.
+ */
+const TabletManager::Tablet*
+TabletManager::SnapshotReader::lookup(uint64_t tableId, uint64_t keyHash)
+{
+    vector<Tablet>::const_iterator it = std::upper_bound(
+            snapshot->tablets.begin(), snapshot->tablets.end(), keyHash,
+            [tableId](uint64_t hash, const Tablet& tablet) {
+                if (tableId != tablet.tableId)
+                    return tableId < tablet.tableId;
+                return hash < tablet.startKeyHash;
+            });
+    if (it == snapshot->tablets.begin())
+        return NULL;
+    --it;
+    if (it->tableId != tableId || keyHash > it->endKeyHash)
+        return NULL;
+    return &*it;
+}
+
 /**
  * Construct to freeze the state of tabletManager from outside.
  *
@@ -588,8 +806,10 @@ TabletManager::Protector::getTablet(uint64_t tableId, uint64_t keyHash,
     if (it == tabletManager->tabletMap.end())
         return false;
 
-    if (outTablet != NULL)
+    if (outTablet != NULL) {
         *outTablet = it->second;
+        it->second.counters->copyTo(outTablet);
+    }
     return true;
 }
 
@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_TABLETMANAGER_H
 #define RAMCLOUD_TABLETMANAGER_H
 
+#include <atomic>
 #include <unordered_map>
 
 #include "Common.h"
@@ -42,8 +43,16 @@ namespace RAMCloud {
  * read. The downside, of course, is that the caller needs to be aware that the
  * actual state may be permuted at any time and will not be reflected in the
  * cached copy obtained during the lookup.
+ *
+ * The checks made on every object operation (getTablet() by key hash,
+ * checkAndIncrementReadCount() and the increment methods) don't acquire the
+ * lock at all: they search an immutable, sorted copy of the tablets that
+ * every change publishes anew (see #snapshot).
  */
 class TabletManager {
+  PRIVATE:
+    struct Counters;
+
   PUBLIC:
     /**
      * Each tablet is in one particular state at any point in time. This state
@@ -79,6 +88,8 @@ class TabletManager {
             , state(NOT_READY)
             , readCount(-1)
             , writeCount(-1)
+            , accessHistogram()
+            , counters(NULL)
         {
         }
 
@@ -92,9 +103,26 @@ class TabletManager {
             , state(state)
             , readCount(0)
             , writeCount(0)
+            , accessHistogram()
+            , counters(NULL)
+        {
+        }
+
+        /**
+         * Returns the number of key hashes covered by each entry of
+         * #accessHistogram for a tablet with the given range (the last
+         * entry may cover fewer). The coordinator uses this to turn
+         * histogram entries back into key hash ranges.
+         */
+        static uint64_t
+        accessBucketWidth(uint64_t startKeyHash, uint64_t endKeyHash)
         {
+            return (endKeyHash - startKeyHash) / ACCESS_HISTOGRAM_BUCKETS + 1;
         }
 
+        /// Number of entries in #accessHistogram.
+        static const uint32_t ACCESS_HISTOGRAM_BUCKETS = 8;
+
         /// The identifier of the table that this tablet describes a portion of.
         uint64_t tableId;
 
@@ -112,6 +140,18 @@ class TabletManager {
 
         /// The number of write operations performed on objects in this tablet.
         uint64_t writeCount;
+
+        /// Reads and writes of objects in this tablet, counted separately
+        /// for each of ACCESS_HISTOGRAM_BUCKETS equal slices of its key hash
+        /// range (lowest key hashes first). Tells the coordinator where to
+        /// split a hot tablet so that each half gets a share of the load.
+        uint64_t accessHistogram[ACCESS_HISTOGRAM_BUCKETS];
+
+        /// Where TabletManager really keeps the three counts above, so that
+        /// they can be incremented without its lock; the fields above are
+        /// filled in from here when a tablet is copied out to a caller.
+        /// Only TabletManager may dereference it.
+        Counters* counters;
     };
 
     /**
@@ -147,6 +187,7 @@ class TabletManager {
     };
 
     TabletManager();
+    ~TabletManager();
     bool addTablet(uint64_t tableId,
                    uint64_t startKeyHash,
                    uint64_t endKeyHash,
@@ -188,8 +229,74 @@ class TabletManager {
     /// relatively few for the same table.
     typedef std::unordered_multimap<uint64_t, Tablet> TabletMap;
 
+    /**
+     * The read and write counts of one tablet (see Tablet::readCount and
+     * the fields after it). They are updated with relaxed atomic operations,
+     * since nothing else depends on them.
+     */
+    struct Counters {
+        Counters();
+        void clear();
+        void copyTo(Tablet* tablet) const;
+        void recordRead(const Tablet& tablet, uint64_t keyHash);
+        void recordWrite(const Tablet& tablet, uint64_t keyHash);
+
+        std::atomic<uint64_t> readCount;
+        std::atomic<uint64_t> writeCount;
+        std::atomic<uint64_t> accessHistogram[Tablet::ACCESS_HISTOGRAM_BUCKETS];
+
+        DISALLOW_COPY_AND_ASSIGN(Counters);
+    };
+
+    /**
+     * An immutable copy of every tablet in tabletMap, sorted by table and
+     * then by start key hash, so that a lookup is a binary search over
+     * contiguous memory. The copies share their Counters with tabletMap.
+     */
+    struct Snapshot {
+        Snapshot() : tablets() {}
+        vector<Tablet> tablets;
+    };
+
+    /**
+     * Number of threads currently searching #snapshot, padded to a cache
+     * line of its own. Threads are spread over the #readers array by
+     * thread id, so they don't write to each other's lines.
+     */
+    struct ReaderCount {
+        ReaderCount() : count(0) {}
+        std::atomic<uint32_t> count;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+    };
+
+    /// Number of entries in #readers.
+    static const uint32_t NUM_READER_COUNTS = 64;
+
+    /**
+     * Announces the calling thread in #readers for as long as it exists,
+     * so that the Snapshot it loads (and the Counters that snapshot refers
+     * to) can't be freed until it is destroyed.
+     */
+    class SnapshotReader {
+      public:
+        explicit SnapshotReader(TabletManager* tabletManager);
+        ~SnapshotReader();
+        const Tablet* lookup(uint64_t tableId, uint64_t keyHash);
+
+      PRIVATE:
+        /// The entry of TabletManager::readers for this thread.
+        ReaderCount& reader;
+
+        /// The snapshot loaded by the constructor.
+        const Snapshot* snapshot;
+
+        DISALLOW_COPY_AND_ASSIGN(SnapshotReader);
+    };
+
+    void freeRetired(const SpinLock::Guard& lock);
     TabletMap::iterator lookup(uint64_t tableId, uint64_t keyHash,
                                const SpinLock::Guard& lock);
+    void publishSnapshot(const SpinLock::Guard& lock);
 
     /// This unordered_multimap is used to store and access all tablet data.
     TabletMap tabletMap;
@@ -204,6 +311,26 @@ class TabletManager {
     /// before corresponding transaction to complete.
     int numLoadingTablets;
 
+    /**
+     * The current Snapshot of tabletMap; never NULL. It is replaced (by
+     * publishSnapshot, with #lock held) whenever a tablet is added, removed,
+     * split or changes state, and is read without any lock.
+     */
+    std::atomic<Snapshot*> snapshot;
+
+    /**
+     * Snapshots that have been replaced, and Counters of tablets that have
+     * been deleted, that threads holding a SnapshotReader may still be
+     * using. Protected by #lock.
+     */
+    vector<Snapshot*> retiredSnapshots;
+    vector<Counters*> retiredCounters;
+
+    /// Counts of threads holding a SnapshotReader; retired snapshots and
+    /// counters can be freed once every count has been seen to be zero
+    /// after they were retired.
+    ReaderCount readers[NUM_READER_COUNTS];
+
     DISALLOW_COPY_AND_ASSIGN(TabletManager);
 };
 
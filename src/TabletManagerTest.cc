@@ -271,28 +271,63 @@ TEST_F(TabletManagerTest, getStatistics) {
             stats.ShortDebugString());
     }
 
+    // Each eighth of the key hash range gets its own histogram entry.
     Key key(58, "1", 1);
+    uint64_t bucket = key.getHash() >> 61;
+    string histogram;
+    for (uint64_t i = 0; i < 8; i++)
+        histogram += format(" access_histogram: %d", i == bucket ? 1 : 0);
     tm.incrementReadCount(key);
 
     {
         ProtoBuf::ServerStatistics stats;
         tm.getStatistics(&stats);
         EXPECT_EQ("tabletentry { table_id: 58 start_key_hash: 0 "
-            "end_key_hash: 18446744073709551615 number_read_and_writes: 1 }",
+            "end_key_hash: 18446744073709551615 number_read_and_writes: 1 "
+            "read_count: 1 write_count: 0" + histogram + " }",
             stats.ShortDebugString());
     }
 
     tm.incrementWriteCount(key);
+    histogram.clear();
+    for (uint64_t i = 0; i < 8; i++)
+        histogram += format(" access_histogram: %d", i == bucket ? 2 : 0);
 
     {
         ProtoBuf::ServerStatistics stats;
         tm.getStatistics(&stats);
         EXPECT_EQ("tabletentry { table_id: 58 start_key_hash: 0 "
-            "end_key_hash: 18446744073709551615 number_read_and_writes: 2 }",
+            "end_key_hash: 18446744073709551615 number_read_and_writes: 2 "
+            "read_count: 1 write_count: 1" + histogram + " }",
             stats.ShortDebugString());
     }
 }
 
+TEST_F(TabletManagerTest, recordAccess) {
+    tm.addTablet(1, 100, 179, TabletManager::NORMAL);
+    tm.incrementReadCount(1, 100);
+    tm.incrementReadCount(1, 109);
+    tm.incrementWriteCount(1, 110);
+    tm.incrementWriteCount(1, 179);
+    TabletManager::Tablet tablet;
+    EXPECT_TRUE(tm.getTablet(1, 100, 179, &tablet));
+    EXPECT_EQ(10U, TabletManager::Tablet::accessBucketWidth(100, 179));
+    EXPECT_EQ(2U, tablet.accessHistogram[0]);
+    EXPECT_EQ(1U, tablet.accessHistogram[1]);
+    EXPECT_EQ(1U, tablet.accessHistogram[7]);
+
+    // Splitting starts the counts over.
+    EXPECT_TRUE(tm.splitTablet(1, 140));
+    EXPECT_TRUE(tm.getTablet(1, 100, 139, &tablet));
+    EXPECT_EQ(0U, tablet.accessHistogram[0]);
+
+    // The last entry may cover fewer key hashes than the others.
+    tm.addTablet(2, 0, 8, TabletManager::NORMAL);
+    tm.incrementReadCount(2, 8);
+    EXPECT_TRUE(tm.getTablet(2, 0, 8, &tablet));
+    EXPECT_EQ(1U, tablet.accessHistogram[4]);
+}
+
 TEST_F(TabletManagerTest, getNumTablets) {
     EXPECT_EQ(0U, tm.getNumTablets());
     tm.addTablet(0, 0, 0, TabletManager::NORMAL);
@@ -372,6 +407,75 @@ TEST_F(TabletManagerTest, lookup) {
     EXPECT_EQ("end", toString(tm.lookup(3001, 2200, fakeGuard)));
 }
 
+TEST_F(TabletManagerTest, freeRetired) {
+    EXPECT_TRUE(tm.addTablet(1, 0, 9, TabletManager::NORMAL));
+    {
+        TabletManager::SnapshotReader reader(&tm);
+        const TabletManager::Tablet* tablet = reader.lookup(1, 5);
+        ASSERT_TRUE(tablet != NULL);
+        EXPECT_TRUE(tm.deleteTablet(1, 0, 9));
+        EXPECT_EQ(1U, tm.retiredSnapshots.size());
+        EXPECT_EQ(1U, tm.retiredCounters.size());
+
+        // The reader still sees the old snapshot; new lookups don't.
+        EXPECT_EQ(9U, tablet->endKeyHash);
+        tablet->counters->recordRead(*tablet, 5);
+        EXPECT_FALSE(tm.getTablet(1, 5));
+    }
+    EXPECT_TRUE(tm.addTablet(2, 0, 9, TabletManager::NORMAL));
+    EXPECT_EQ(0U, tm.retiredSnapshots.size());
+    EXPECT_EQ(0U, tm.retiredCounters.size());
+}
+
+TEST_F(TabletManagerTest, publishSnapshot) {
+    EXPECT_TRUE(tm.addTablet(2, 0, 9, TabletManager::NORMAL));
+    EXPECT_TRUE(tm.addTablet(1, 10, 19, TabletManager::NORMAL));
+    EXPECT_TRUE(tm.addTablet(1, 0, 9, TabletManager::NORMAL));
+    const TabletManager::Snapshot* snapshot = tm.snapshot.load();
+    ASSERT_EQ(3U, snapshot->tablets.size());
+    EXPECT_EQ("1 0, 1 10, 2 0", format("%lu %lu, %lu %lu, %lu %lu",
+            snapshot->tablets[0].tableId, snapshot->tablets[0].startKeyHash,
+            snapshot->tablets[1].tableId, snapshot->tablets[1].startKeyHash,
+            snapshot->tablets[2].tableId, snapshot->tablets[2].startKeyHash));
+    EXPECT_EQ(0U, tm.retiredSnapshots.size());
+
+    // State changes are visible to lock-free lookups right away.
+    TabletManager::Tablet tablet;
+    EXPECT_TRUE(tm.changeState(1, 10, 19, TabletManager::NORMAL,
+            TabletManager::NOT_READY));
+    EXPECT_TRUE(tm.getTablet(1, 15, &tablet));
+    EXPECT_EQ(TabletManager::NOT_READY, tablet.state);
+
+    // So are splits, and both halves count separately.
+    EXPECT_TRUE(tm.splitTablet(2, 5));
+    tm.incrementWriteCount(2, 7);
+    EXPECT_TRUE(tm.getTablet(2, 3, &tablet));
+    EXPECT_EQ(4U, tablet.endKeyHash);
+    EXPECT_EQ(0U, tablet.writeCount);
+    EXPECT_TRUE(tm.getTablet(2, 7, &tablet));
+    EXPECT_EQ(5U, tablet.startKeyHash);
+    EXPECT_EQ(1U, tablet.writeCount);
+}
+
+TEST_F(TabletManagerTest, SnapshotReader_lookup) {
+    EXPECT_TRUE(tm.addTablet(1000, 50, 99, TabletManager::NORMAL));
+    EXPECT_TRUE(tm.addTablet(1000, 100, 199, TabletManager::NORMAL));
+    EXPECT_TRUE(tm.addTablet(2000, 500, 599, TabletManager::NORMAL));
+    TabletManager::SnapshotReader reader(&tm);
+
+    EXPECT_TRUE(reader.lookup(1000, 49) == NULL);
+    EXPECT_EQ(50U, reader.lookup(1000, 50)->startKeyHash);
+    EXPECT_EQ(50U, reader.lookup(1000, 99)->startKeyHash);
+    EXPECT_EQ(100U, reader.lookup(1000, 100)->startKeyHash);
+    EXPECT_EQ(100U, reader.lookup(1000, 199)->startKeyHash);
+    EXPECT_TRUE(reader.lookup(1000, 200) == NULL);
+    EXPECT_TRUE(reader.lookup(1000, 550) == NULL);
+    EXPECT_TRUE(reader.lookup(1500, 70) == NULL);
+    EXPECT_EQ(2000U, reader.lookup(2000, 599)->tableId);
+    EXPECT_TRUE(reader.lookup(2000, 600) == NULL);
+    EXPECT_TRUE(reader.lookup(3000, 0) == NULL);
+}
+
 TEST_F(TabletManagerTest, protector) {
     TabletManager::Protector p(&tm);
     EXPECT_FALSE(tm.lock.try_lock());
@@ -30,6 +30,7 @@ namespace RAMCloud {
 Task::Task(TaskQueue& taskQueue)
     : taskQueue(taskQueue)
     , scheduled(false)
+    , nextScheduled(NULL)
 {
 }
 
@@ -66,16 +67,20 @@ Task::isScheduled()
  * by #taskQueue unless schedule() is called again.  It is perfectly
  * legal to call schedule() during a call to performTask(), which indicates
  * that the task should be run again in the future by the #taskQueue.
- * Calling schedule() when isScheduled() == true has no effect.
+ * Calling schedule() when isScheduled() == true has no effect (even if
+ * the priority is different).
  *
  * Importantly, creators of tasks must take care to ensure that a task is not
  * scheduled when it is destroyed, otherwise the taskQueue will exhibit
  * undefined behavior when it attempts to execute this (destroyed) task.
+ *
+ * \param priority
+ *      Tasks of higher priority are performed first.
  */
 void
-Task::schedule()
+Task::schedule(Priority priority)
 {
-    taskQueue.schedule(this);
+    taskQueue.schedule(this, priority);
 }
 
 // --- TaskQueue ---
@@ -85,8 +90,13 @@ TaskQueue::TaskQueue()
     : mutex()
     , taskAdded()
     , running(true)
+    , newTasks()
     , tasks()
+    , numTasks(0)
+    , sleepers(0)
 {
+    for (int i = 0; i < Task::NUM_PRIORITIES; i++)
+        newTasks[i] = NULL;
 }
 
 TaskQueue::~TaskQueue()
@@ -97,16 +107,14 @@ TaskQueue::~TaskQueue()
 bool
 TaskQueue::isIdle()
 {
-    Lock _(mutex);
-    return tasks.size() == 0;
+    return numTasks == 0;
 }
 
 /// Returns number of tasks waiting to run.
 size_t
 TaskQueue::outstandingTasks()
 {
-    Lock _(mutex);
-    return tasks.size();
+    return numTasks;
 }
 
 /**
@@ -184,6 +192,32 @@ TaskQueue::halt()
 
 // -- private --
 
+/**
+ * Move the tasks scheduled since the last call into #tasks, in the order
+ * in which they were scheduled. The caller must hold #mutex.
+ */
+void
+TaskQueue::collectScheduled()
+{
+    for (int priority = 0; priority < Task::NUM_PRIORITIES; priority++) {
+        if (newTasks[priority].load(std::memory_order_relaxed) == NULL)
+            continue;
+        Task* task = newTasks[priority].exchange(NULL,
+                std::memory_order_acquire);
+
+        // The list is newest first; reverse it.
+        Task* oldestFirst = NULL;
+        while (task != NULL) {
+            Task* next = task->nextScheduled;
+            task->nextScheduled = oldestFirst;
+            oldestFirst = task;
+            task = next;
+        }
+        for (task = oldestFirst; task != NULL; task = task->nextScheduled)
+            tasks[priority].push(task);
+    }
+}
+
 /**
  * Queue \a task for execution on future calls to performTask (or
  * performTasksUntilHalt()).
@@ -193,16 +227,28 @@ TaskQueue::halt()
  *
  * \param task
  *      Asynchronous job to be executed by the TaskQueue in the future.
+ * \param priority
+ *      Priority class of the task.
  */
 void
-TaskQueue::schedule(Task* task)
+TaskQueue::schedule(Task* task, Task::Priority priority)
 {
-    Lock _(mutex);
-    if (task->scheduled)
+    if (task->scheduled.exchange(true))
         return;
-    task->scheduled = true;
-    tasks.push(task);
-    taskAdded.notify_one();
+    std::atomic<Task*>& list = newTasks[priority];
+    task->nextScheduled = list.load(std::memory_order_relaxed);
+    while (!list.compare_exchange_weak(task->nextScheduled, task,
+            std::memory_order_release, std::memory_order_relaxed)) {
+        // task->nextScheduled was updated; try again.
+    }
+
+    // This pairs with getNextTask: either it sees the new task, or we see
+    // that it is about to sleep.
+    numTasks.fetch_add(1);
+    if (sleepers.load() > 0) {
+        Lock _(mutex);
+        taskAdded.notify_one();
+    }
     TEST_LOG("scheduled");
 }
 
@@ -226,16 +272,40 @@ TaskQueue::getNextTask(bool sleepIfIdle)
     while (true) {
         if (!running)
             return NULL;
-        if (!sleepIfIdle || !tasks.empty())
+        if (!sleepIfIdle || numTasks != 0)
             break;
-        taskAdded.wait(lock);
+        sleepers.fetch_add(1);
+        if (numTasks == 0)
+            taskAdded.wait(lock);
+        sleepers.fetch_sub(1);
+    }
+    collectScheduled();
+    for (int priority = Task::NUM_PRIORITIES - 1; priority >= 0; priority--) {
+        if (tasks[priority].empty())
+            continue;
+        Task* task = tasks[priority].front();
+        tasks[priority].pop();
+        numTasks--;
+        task->scheduled = false;
+        return task;
+    }
+    return NULL;
+}
+
+/**
+ * Return the task that getNextTask would return next (or NULL if none)
+ * without removing it from the queue. The caller must hold #mutex (unit
+ * tests needn't bother).
+ */
+Task*
+TaskQueue::peekNextTask()
+{
+    collectScheduled();
+    for (int priority = Task::NUM_PRIORITIES - 1; priority >= 0; priority--) {
+        if (!tasks[priority].empty())
+            return tasks[priority].front();
     }
-    if (tasks.empty())
-        return NULL;
-    Task* task = tasks.front();
-    tasks.pop();
-    task->scheduled = false;
-    return task;
+    return NULL;
 }
 
 } // namespace RAMCloud
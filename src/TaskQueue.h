@@ -16,6 +16,7 @@
 #ifndef RAMCLOUD_TASKQUEUE_H
 #define RAMCLOUD_TASKQUEUE_H
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -46,6 +47,12 @@ class Task {
     explicit Task(TaskQueue& taskQueue);
     virtual ~Task();
 
+    /**
+     * Scheduled tasks of higher priority are performed before those of
+     * lower priority; tasks are FIFO within each priority.
+     */
+    enum Priority { LOW, NORMAL, HIGH, NUM_PRIORITIES };
+
     /**
      * Pure virtual method implemented by subclasses; its execution
      * is deferred to a later time perform work asynchronously.
@@ -54,7 +61,7 @@ class Task {
     virtual void performTask() = 0;
 
     bool isScheduled();
-    void schedule();
+    void schedule(Priority priority = NORMAL);
 
   PROTECTED:
     /// Executes this Task when it isScheduled() on taskQueue.performTask().
@@ -62,9 +69,14 @@ class Task {
 
   PRIVATE:
     /// True if performTask() will be run on the next taskQueue.performTask().
-    bool scheduled;
+    std::atomic<bool> scheduled;
+
+    /// Next task in the TaskQueue's list of newly scheduled tasks; only
+    /// valid while #scheduled is true.
+    Task* nextScheduled;
 
     friend class TaskQueue;
+    DISALLOW_COPY_AND_ASSIGN(Task);
 };
 
 /**
@@ -72,6 +84,12 @@ class Task {
  * quickly schedule asynchronous jobs which are periodically checked for
  * completeness out of a performance sensitive context.
  * See Task for details on how to create tasks and related gotchas.
+ *
+ * Scheduling a task never takes a lock: it pushes the task onto a lock-free
+ * list for its priority, so threads that schedule work don't contend with
+ * the thread performing tasks (or with each other, beyond a compare-and-swap).
+ * Threads performing tasks move newly scheduled tasks from those lists into
+ * FIFO queues, under #mutex.
  */
 class TaskQueue {
   PUBLIC:
@@ -84,20 +102,22 @@ class TaskQueue {
     void halt();
 
   PRIVATE:
-    void schedule(Task* task);
+    void collectScheduled();
+    void schedule(Task* task, Task::Priority priority);
     Task* getNextTask(bool sleepIfIdle);
+    Task* peekNextTask();
 
     /**
-     * Protects all modifications to #tasks and #running; used to allow
-     * safe concurrent calls to schedule(), performTask(), and
-     * performTasksUntilHalt().
+     * Protects #tasks and #running; used to allow safe concurrent calls to
+     * performTask() and performTasksUntilHalt(). schedule() only acquires
+     * it to wake up a sleeping performTasksUntilHalt().
      */
     std::mutex mutex;
     typedef std::unique_lock<std::mutex> Lock;
 
     /**
      * Waited on during performTasksUntilHalt() if there are no tasks to run.
-     * Notified on schedule() or halt().
+     * Notified on schedule() (if #sleepers is nonzero) or halt().
      */
     std::condition_variable taskAdded;
 
@@ -108,10 +128,22 @@ class TaskQueue {
     bool running;
 
     /**
-     * Points to tasks which should be executed.
+     * Tasks scheduled since they were last collected, for each priority,
+     * in reverse order of scheduling (linked through Task::nextScheduled).
+     */
+    std::atomic<Task*> newTasks[Task::NUM_PRIORITIES];
+
+    /**
+     * Points to tasks which should be executed, for each priority.
      * Provides FIFO order for task scheduling.
      */
-    std::queue<Task*> tasks;
+    std::queue<Task*> tasks[Task::NUM_PRIORITIES];
+
+    /// Number of tasks scheduled and not yet returned by getNextTask().
+    std::atomic<size_t> numTasks;
+
+    /// Number of threads waiting on #taskAdded.
+    std::atomic<int> sleepers;
 
     friend class Task;
 };
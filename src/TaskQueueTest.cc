@@ -121,8 +121,8 @@ TEST_F(TaskQueueTest, schedule)
     task1.schedule();
     ASSERT_TRUE(task1.isScheduled());
     task1.schedule(); // check to make sure double schedules don't happen
-    ASSERT_EQ(1u, taskQueue.tasks.size());
-    EXPECT_EQ(&task1, taskQueue.tasks.front());
+    ASSERT_EQ(1u, taskQueue.outstandingTasks());
+    EXPECT_EQ(&task1, taskQueue.peekNextTask());
     taskQueue.performTask(); // clear out task queue
 }
 
@@ -131,17 +131,62 @@ TEST_F(TaskQueueTest, scheduleNested)
     ReschedulingMockTask task(taskQueue);
     task.schedule();
     ASSERT_TRUE(task.isScheduled());
-    ASSERT_EQ(1u, taskQueue.tasks.size());
-    EXPECT_EQ(&task, taskQueue.tasks.front());
+    ASSERT_EQ(1u, taskQueue.outstandingTasks());
+    EXPECT_EQ(&task, taskQueue.peekNextTask());
     taskQueue.performTask();
     EXPECT_EQ(1, task.count);
     ASSERT_TRUE(task.isScheduled());
-    ASSERT_EQ(1u, taskQueue.tasks.size());
-    EXPECT_EQ(&task, taskQueue.tasks.front());
+    ASSERT_EQ(1u, taskQueue.outstandingTasks());
+    EXPECT_EQ(&task, taskQueue.peekNextTask());
     taskQueue.performTask(); // clear out task queue
     EXPECT_EQ(2, task.count);
 }
 
+TEST_F(TaskQueueTest, schedule_priorities)
+{
+    MockTask task3(taskQueue);
+    MockTask task4(taskQueue);
+    task1.schedule(Task::LOW);
+    task2.schedule();
+    task3.schedule(Task::HIGH);
+    task4.schedule();
+    EXPECT_EQ(4u, taskQueue.outstandingTasks());
+    EXPECT_EQ(&task3, taskQueue.getNextTask(false));
+    EXPECT_EQ(&task2, taskQueue.getNextTask(false));
+    task3.schedule(Task::HIGH);
+    EXPECT_EQ(&task3, taskQueue.getNextTask(false));
+    EXPECT_EQ(&task4, taskQueue.getNextTask(false));
+    EXPECT_EQ(&task1, taskQueue.getNextTask(false));
+    EXPECT_TRUE(taskQueue.isIdle());
+}
+
+TEST_F(TaskQueueTest, schedule_concurrent)
+{
+    std::thread thread(&runTaskQueue, std::ref(taskQueue));
+    const int numTasks = 100;
+    std::vector<MockTask*> tasks;
+    for (int i = 0; i < numTasks; i++)
+        tasks.push_back(new MockTask(taskQueue));
+    std::vector<std::thread> schedulers;
+    for (int t = 0; t < 4; t++) {
+        schedulers.emplace_back([&tasks, t] {
+            for (size_t i = t; i < tasks.size(); i += 4)
+                tasks[i]->schedule();
+        });
+    }
+    foreach (std::thread& scheduler, schedulers)
+        scheduler.join();
+    for (int i = 0; i < 1000 && !taskQueue.isIdle(); i++)
+        usleep(1000);
+    EXPECT_TRUE(taskQueue.isIdle());
+    taskQueue.halt();
+    thread.join();
+    foreach (MockTask* task, tasks) {
+        EXPECT_EQ(1, task->count);
+        delete task;
+    }
+}
+
 TEST_F(TaskQueueTest, getNextTask)
 {
     EXPECT_EQ(static_cast<Task*>(NULL), taskQueue.getNextTask(false));
@@ -59,9 +59,12 @@ TcpTransport::TcpTransport(Context* context,
     : context(context)
     , locatorString()
     , listenSocket(-1)
+    , requestPlacer(NULL)
     , acceptHandler()
+    , replyFlusher()
     , sockets()
     , nextSocketId(100)
+    , socketsToFlush()
     , serverRpcPool()
     , clientRpcPool()
 {
@@ -99,6 +102,19 @@ TcpTransport::TcpTransport(Context* context,
                 errno);
     }
 
+    // With reusePort, several transports (one per DispatchShard) may listen
+    // on the same port; the kernel divides up the connections among them.
+    int reusePort = serviceLocator->getOption<int>("reusePort", 0);
+    if (reusePort != 0 && sys->setsockopt(listenSocket, SOL_SOCKET,
+            SO_REUSEPORT, &reusePort, sizeof(reusePort)) != 0) {
+        sys->close(listenSocket);
+        LOG(WARNING, "TcpTransport couldn't set SO_REUSEPORT on "
+                "listen socket: %s", strerror(errno));
+        throw TransportException(HERE,
+                "TcpTransport couldn't set SO_REUSEPORT on listen socket",
+                errno);
+    }
+
     if (sys->bind(listenSocket, &address.address,
             sizeof(address.address)) == -1) {
         sys->close(listenSocket);
@@ -118,6 +134,10 @@ TcpTransport::TcpTransport(Context* context,
 
     // Arrange to be notified whenever anyone connects to listenSocket.
     acceptHandler.construct(listenSocket, this);
+
+    if (serviceLocator->getOption<int>("batchReplies", 0) != 0) {
+        replyFlusher.construct(this);
+    }
 }
 
 /**
@@ -145,6 +165,13 @@ TcpTransport::~TcpTransport()
  */
 void
 TcpTransport::closeSocket(int fd) {
+    if (sockets[fd]->flushPending) {
+        std::vector<Socket*>::iterator it = std::find(socketsToFlush.begin(),
+                socketsToFlush.end(), sockets[fd]);
+        if (it != socketsToFlush.end()) {
+            socketsToFlush.erase(it);
+        }
+    }
     delete sockets[fd];
     sockets[fd] = NULL;
     sys->close(fd);
@@ -155,12 +182,15 @@ TcpTransport::closeSocket(int fd) {
  */
 TcpTransport::Socket::Socket(int fd, TcpTransport* transport, sockaddr_in& sin)
     : transport(transport)
+    , fd(fd)
     , id(transport->nextSocketId)
     , rpc(NULL)
     , ioHandler(fd, transport, this)
     , rpcsWaitingToReply()
     , bytesLeftToSend(0)
     , sin(sin)
+    , readAhead()
+    , flushPending(false)
 {
     transport->nextSocketId++;
 }
@@ -309,16 +339,24 @@ TcpTransport::ServerSocketHandler::handleFileEvent(int events)
     assert(socket != NULL);
     try {
         if (events & Dispatch::FileEvent::READABLE) {
-            if (socket->rpc == NULL) {
-                socket->rpc = transport->serverRpcPool.construct(socket,
-                                                                 fd, transport);
-            }
-            if (socket->rpc->message.readMessage(fd)) {
-                // The incoming request is complete; pass it off for servicing.
+            // Keep going as long as requests are complete and there are
+            // bytes read ahead: the socket may not become readable again
+            // for them.
+            do {
+                if (socket->rpc == NULL) {
+                    socket->rpc = transport->serverRpcPool.construct(socket,
+                            fd, transport);
+                }
+                if (!socket->rpc->message.readMessage(fd,
+                        &socket->readAhead)) {
+                    break;
+                }
+                // The incoming request is complete; pass it off for
+                // servicing.
                 TcpServerRpc *rpc = socket->rpc;
                 socket->rpc = NULL;
                 transport->context->workerManager->handleRpc(rpc);
-            }
+            } while (!socket->readAhead.empty());
         }
         // Check to see if this socket got closed due to an error in the
         // read handler; if so, it's neither necessary nor safe to continue
@@ -329,23 +367,9 @@ TcpTransport::ServerSocketHandler::handleFileEvent(int events)
             return;
         }
         if (events & Dispatch::FileEvent::WRITABLE) {
-            while (true) {
-                if (socket->rpcsWaitingToReply.empty()) {
-                    setEvents(Dispatch::FileEvent::READABLE);
-                    break;
-                }
-                TcpServerRpc& rpc = socket->rpcsWaitingToReply.front();
-                socket->bytesLeftToSend = TcpTransport::sendMessage(fd,
-                        rpc.message.header.nonce, &rpc.replyPayload,
-                        socket->bytesLeftToSend);
-                if (socket->bytesLeftToSend != 0) {
-                    break;
-                }
-                // The current reply is finished; start the next one, if
-                // there is one.
-                socket->rpcsWaitingToReply.pop_front();
-                transport->serverRpcPool.destroy(&rpc);
-                socket->bytesLeftToSend = -1;
+            transport->flushReplies(socket);
+            if (socket->rpcsWaitingToReply.empty()) {
+                setEvents(Dispatch::FileEvent::READABLE);
             }
         }
     } catch (TransportException& e) {
@@ -396,36 +420,12 @@ TcpTransport::sendMessage(int fd, uint64_t nonce, Buffer* payload,
 
     // Use an iovec to send everything in one kernel call: one iov
     // for header, the rest for payload.  Skip parts that have
-    // already been sent.
-    uint32_t iovecs = 1 + payload->getNumberChunks();
-    struct iovec iov[iovecs];
-    int offset;
-    int iovecIndex;
-    if (alreadySent < downCast<int>(sizeof(header))) {
-        iov[0].iov_base = reinterpret_cast<char*>(&header) + alreadySent;
-        iov[0].iov_len = sizeof(header) - alreadySent;
-        iovecIndex = 1;
-        offset = 0;
-    } else {
-        iovecIndex = 0;
-        offset = alreadySent - downCast<int>(sizeof(header));
-    }
-    Buffer::Iterator iter(payload, offset, header.len - offset);
-    while (!iter.isDone()) {
-        iov[iovecIndex].iov_base = const_cast<void*>(iter.getData());
-        iov[iovecIndex].iov_len = iter.getLength();
-        ++iovecIndex;
-
-        // There's an upper limit on the permissible number of iovecs in
-        // one outgoing message. Unfortunately, this limit does not appear
-        // to be defined publicly, so we make a guess here. If we hit the
-        // limit, stop accumulating chunks for this message: the remaining
-        // chunks will get tried in a future invocation of this method.
-        if (iovecIndex >= 100) {
-            break;
-        }
-        iter.next();
-    }
+    // already been sent.  If there are more than MAX_IOVECS chunks, the
+    // remaining chunks will get tried in a future invocation of this
+    // method.
+    struct iovec iov[MAX_IOVECS];
+    uint32_t iovecIndex = fillIovecs(&header, payload,
+            downCast<uint32_t>(alreadySent), iov, MAX_IOVECS);
 
     struct msghdr msg;
     memset(&msg, 0, sizeof(msg));
@@ -455,6 +455,138 @@ TcpTransport::sendMessage(int fd, uint64_t nonce, Buffer* payload,
     return bytesToSend - r;
 }
 
+/**
+ * Fill in iovecs describing a message (header followed by payload), so
+ * that it can be transmitted with sendmsg.
+ *
+ * \param header
+ *      Header for the message.
+ * \param payload
+ *      Contents of the message (header->len bytes).
+ * \param alreadySent
+ *      The number of leading bytes of the message (counting the header)
+ *      that have already been transmitted; they are skipped.
+ * \param iov
+ *      The iovecs are stored here.
+ * \param maxIovecs
+ *      The number of entries available at \a iov; if the message has
+ *      more chunks than this, only its first part is described.
+ *
+ * \return
+ *      The number of entries of \a iov that were filled in.
+ */
+uint32_t
+TcpTransport::fillIovecs(Header* header, Buffer* payload,
+        uint32_t alreadySent, struct iovec* iov, uint32_t maxIovecs)
+{
+    uint32_t iovecIndex = 0;
+    uint32_t offset;
+    if (alreadySent < sizeof(*header)) {
+        iov[0].iov_base = reinterpret_cast<char*>(header) + alreadySent;
+        iov[0].iov_len = sizeof(*header) - alreadySent;
+        iovecIndex = 1;
+        offset = 0;
+    } else {
+        offset = alreadySent - downCast<uint32_t>(sizeof(*header));
+    }
+    Buffer::Iterator iter(payload, offset, header->len - offset);
+    while (!iter.isDone() && iovecIndex < maxIovecs) {
+        iov[iovecIndex].iov_base = const_cast<void*>(iter.getData());
+        iov[iovecIndex].iov_len = iter.getLength();
+        ++iovecIndex;
+        iter.next();
+    }
+    return iovecIndex;
+}
+
+/**
+ * Transmit as many as possible of the replies queued on a server socket,
+ * packing as many of them as will fit into a single sendmsg call.  Replies
+ * that are sent completely are removed from the socket's
+ * rpcsWaitingToReply list and recycled.
+ *
+ * \param socket
+ *      Socket whose replies should be sent.
+ *
+ * \throw TransportException
+ *      An I/O error occurred.
+ */
+void
+TcpTransport::flushReplies(Socket* socket)
+{
+    while (!socket->rpcsWaitingToReply.empty()) {
+        // Headers must stay put until sendmsg returns; each reply uses at
+        // least one iovec, so there can't be more than MAX_IOVECS of them.
+        Header headers[MAX_IOVECS];
+        struct iovec iov[MAX_IOVECS];
+        uint32_t iovecs = 0;
+        uint32_t replies = 0;
+        size_t bytesToSend = 0;
+        foreach (TcpServerRpc& rpc, socket->rpcsWaitingToReply) {
+            if ((iovecs >= MAX_IOVECS) || (replies >= MAX_IOVECS)) {
+                break;
+            }
+            Header* header = &headers[replies];
+            header->nonce = rpc.message.header.nonce;
+            header->len = rpc.replyPayload.size();
+            uint32_t totalLength =
+                    downCast<uint32_t>(sizeof(*header)) + header->len;
+            uint32_t alreadySent = 0;
+            if ((replies == 0) && (socket->bytesLeftToSend > 0)) {
+                alreadySent = totalLength -
+                        downCast<uint32_t>(socket->bytesLeftToSend);
+            }
+            uint32_t count = fillIovecs(header, &rpc.replyPayload,
+                    alreadySent, iov + iovecs, MAX_IOVECS - iovecs);
+            for (uint32_t i = iovecs; i < iovecs + count; i++) {
+                bytesToSend += iov[i].iov_len;
+            }
+            iovecs += count;
+            replies++;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovecs;
+        ssize_t r = sys->sendmsg(socket->fd, &msg, MSG_NOSIGNAL|MSG_DONTWAIT);
+        if (r == -1) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                LOG(WARNING, "TcpTransport sendmsg error: %s",
+                        strerror(errno));
+                throw TransportException(HERE, "TcpTransport sendmsg error",
+                        errno);
+            }
+            return;
+        }
+        PerfStats::threadStats.networkOutputBytes += r;
+
+        // Retire the replies that were sent completely.
+        size_t sent = downCast<size_t>(r);
+        while (!socket->rpcsWaitingToReply.empty()) {
+            TcpServerRpc& rpc = socket->rpcsWaitingToReply.front();
+            size_t left = sizeof(Header) + rpc.replyPayload.size();
+            if (socket->bytesLeftToSend > 0) {
+                left = downCast<size_t>(socket->bytesLeftToSend);
+            }
+            if (sent < left) {
+                if (sent > 0) {
+                    socket->bytesLeftToSend = downCast<int>(left - sent);
+                }
+                break;
+            }
+            sent -= left;
+            socket->rpcsWaitingToReply.pop_front();
+            serverRpcPool.destroy(&rpc);
+            socket->bytesLeftToSend = -1;
+        }
+        if (downCast<size_t>(r) < bytesToSend) {
+            // The socket is full; wait for it to become writable.
+            return;
+        }
+    }
+}
+
 /**
  * Read bytes from a socket and generate exceptions for errors and
  * end-of-file.
@@ -465,27 +597,64 @@ TcpTransport::sendMessage(int fd, uint64_t nonce, Buffer* payload,
  *      Store incoming data here.
  * \param length
  *      Maximum number of bytes to read.
+ * \param readAhead
+ *      If non-NULL, bytes are taken from here first, and if more are needed,
+ *      the same recvmsg that reads them also refills it with whatever
+ *      follows them in the socket.
  * \return
  *      The number of bytes read.  The recv is done in non-blocking mode;
  *      if there are no bytes available then 0 is returned (0 does *not*
- *      mean end-of-file).
+ *      mean end-of-file).  If this is less than \a length, then
+ *      \a readAhead is empty.
  *
  * \throw TransportException
  *      An I/O error occurred.
  */
 
 ssize_t
-TcpTransport::recvCarefully(int fd, void* buffer, size_t length) {
-    ssize_t actual = sys->recv(fd, buffer, length, MSG_DONTWAIT);
+TcpTransport::recvCarefully(int fd, void* buffer, size_t length,
+        ReadAhead* readAhead) {
+    ssize_t actual;
+    size_t copied = 0;
+    if (readAhead == NULL) {
+        actual = sys->recv(fd, buffer, length, MSG_DONTWAIT);
+    } else {
+        if (!readAhead->empty()) {
+            copied = std::min(length,
+                    static_cast<size_t>(readAhead->end - readAhead->next));
+            memcpy(buffer, readAhead->data + readAhead->next, copied);
+            readAhead->next += downCast<uint32_t>(copied);
+            if (copied == length) {
+                return downCast<ssize_t>(copied);
+            }
+        }
+        readAhead->next = readAhead->end = 0;
+        struct iovec iov[2];
+        iov[0].iov_base = static_cast<char*>(buffer) + copied;
+        iov[0].iov_len = length - copied;
+        iov[1].iov_base = readAhead->data;
+        iov[1].iov_len = sizeof(readAhead->data);
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        actual = sys->recvmsg(fd, &msg, MSG_DONTWAIT);
+        if (actual > downCast<ssize_t>(iov[0].iov_len)) {
+            readAhead->end = downCast<uint32_t>(actual -
+                    downCast<ssize_t>(iov[0].iov_len));
+            PerfStats::threadStats.networkInputBytes += readAhead->end;
+            actual = downCast<ssize_t>(iov[0].iov_len);
+        }
+    }
     if (actual > 0) {
         PerfStats::threadStats.networkInputBytes += actual;
-        return actual;
+        return actual + downCast<ssize_t>(copied);
     }
     if (actual == 0) {
         throw TransportException(HERE, "session closed by peer");
     }
     if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-        return 0;
+        return downCast<ssize_t>(copied);
     }
     LOG(WARNING, "TcpTransport recv error: %s", strerror(errno));
     throw TransportException(HERE, "TcpTransport recv error", errno);
@@ -503,11 +672,16 @@ TcpTransport::recvCarefully(int fd, void* buffer, size_t length) {
  *      be invoked once the header for the message has been received.
  *      FindRpc will provide a buffer to use for the body of the message.
  *      This argument is typically used on clients.
+ * \param placer
+ *      If non-NULL, asked where to receive the body of the message once
+ *      enough of it has arrived; see Transport::RequestPlacer. Used with
+ *      \a buffer on servers.
  */
 TcpTransport::IncomingMessage::IncomingMessage(Buffer* buffer,
-        TcpSession* session)
+        TcpSession* session, RequestPlacer* placer)
     : header(), headerBytesReceived(0), messageBytesReceived(0),
-      messageLength(0), buffer(buffer), session(session)
+      messageLength(0), buffer(buffer), session(session), placer(placer),
+      placementPin()
 {
 }
 
@@ -528,6 +702,10 @@ TcpTransport::IncomingMessage::cancel() {
  *
  * \param fd
  *      File descriptor to use for reading message info.
+ * \param readAhead
+ *      If non-NULL, bytes already read from fd are taken from here first,
+ *      and bytes read past the end of this message are left here for the
+ *      next message (see recvCarefully).
  * \return
  *      True means the message is complete (it's present in the
  *      buffer provided to the constructor); false means we still need
@@ -538,13 +716,13 @@ TcpTransport::IncomingMessage::cancel() {
  */
 
 bool
-TcpTransport::IncomingMessage::readMessage(int fd) {
+TcpTransport::IncomingMessage::readMessage(int fd, ReadAhead* readAhead) {
     // First make sure we have received the header (it may arrive in
     // multiple chunks).
     if (headerBytesReceived < sizeof(Header)) {
         ssize_t len = TcpTransport::recvCarefully(fd,
                 reinterpret_cast<char*>(&header) + headerBytesReceived,
-                sizeof(header) - headerBytesReceived);
+                sizeof(header) - headerBytesReceived, readAhead);
         headerBytesReceived += downCast<uint32_t>(len);
         if (headerBytesReceived < sizeof(Header))
             return false;
@@ -566,19 +744,45 @@ TcpTransport::IncomingMessage::readMessage(int fd) {
     }
 
     // We have the header; now receive the message body (it may take several
-    // calls to this method before we get all of it).
+    // calls to this method before we get all of it). With a placer, only
+    // the prefix it needs to see is received first; the rest goes where it
+    // says.
     if (messageBytesReceived < messageLength) {
-        void *dest;
         if (buffer->size() == 0) {
-            dest = buffer->alloc(messageLength);
-        } else {
-            buffer->peek(messageBytesReceived, &dest);
+            uint32_t prefixLength = 0;
+            if (placer != NULL)
+                prefixLength = placer->getPrefixLength();
+            if (prefixLength == 0 || prefixLength >= messageLength) {
+                placer = NULL;
+                prefixLength = messageLength;
+            }
+            buffer->alloc(prefixLength);
+        }
+        while (messageBytesReceived < messageLength) {
+            if (messageBytesReceived == buffer->size()) {
+                // The prefix is complete.
+                uint32_t remaining = messageLength - messageBytesReceived;
+                uint32_t placedLength = 0;
+                void* placed = placer->placeRequest(
+                        buffer->getRange(0, messageBytesReceived),
+                        messageLength, &placedLength, &placementPin);
+                if (placed != NULL && placedLength <= remaining) {
+                    buffer->appendExternal(placed, placedLength);
+                    remaining -= placedLength;
+                } else {
+                    placementPin.reset();
+                }
+                if (remaining > 0)
+                    buffer->alloc(remaining);
+            }
+            void* dest;
+            uint32_t contiguous = buffer->peek(messageBytesReceived, &dest);
+            ssize_t len = TcpTransport::recvCarefully(fd, dest,
+                    contiguous, readAhead);
+            messageBytesReceived += downCast<uint32_t>(len);
+            if (static_cast<uint32_t>(len) < contiguous)
+                return false;
         }
-        ssize_t len = TcpTransport::recvCarefully(fd, dest,
-                messageLength - messageBytesReceived);
-        messageBytesReceived += downCast<uint32_t>(len);
-        if (messageBytesReceived < messageLength)
-            return false;
     }
 
     // We have the header and the message body, but we may have to discard
@@ -588,7 +792,8 @@ TcpTransport::IncomingMessage::readMessage(int fd) {
         uint32_t maxLength = header.len - messageBytesReceived;
         if (maxLength > sizeof(buffer))
             maxLength = sizeof(buffer);
-        ssize_t len = TcpTransport::recvCarefully(fd, buffer, maxLength);
+        ssize_t len = TcpTransport::recvCarefully(fd, buffer, maxLength,
+                readAhead);
         messageBytesReceived += downCast<uint32_t>(len);
         if (messageBytesReceived < header.len)
             return false;
@@ -623,6 +828,7 @@ TcpTransport::TcpSession::TcpSession(TcpTransport* transport,
     , rpcsWaitingForResponse()
     , current(NULL)
     , message()
+    , readAhead()
     , clientIoHandler()
     , alarm(transport->context->sessionAlarmTimer, this,
             (timeoutMs != 0) ? timeoutMs : DEFAULT_TIMEOUT_MS)
@@ -885,7 +1091,10 @@ TcpTransport::ClientSocketHandler::handleFileEvent(int events)
 {
     try {
         if (events & Dispatch::FileEvent::READABLE) {
-            if (session->message->readMessage(fd)) {
+            // Keep going as long as responses are complete and there are
+            // bytes read ahead: the socket may not become readable again
+            // for them.
+            while (session->message->readMessage(fd, &session->readAhead)) {
                 // This RPC is finished.
                 if (session->current != NULL) {
                     session->rpcsWaitingForResponse.erase(
@@ -897,6 +1106,9 @@ TcpTransport::ClientSocketHandler::handleFileEvent(int events)
                     session->current = NULL;
                 }
                 session->message.construct(static_cast<Buffer*>(NULL), session);
+                if (session->readAhead.empty()) {
+                    break;
+                }
             }
         }
         if (events & Dispatch::FileEvent::WRITABLE) {
@@ -933,6 +1145,16 @@ TcpTransport::TcpServerRpc::sendReply()
         // new connection); if so, just discard the RPC without sending
         // a response.
         if ((socket != NULL) && (socket->id == socketId)) {
+            if (transport->replyFlusher) {
+                // Leave the transmission to the ReplyFlusher, so that it
+                // can combine this reply with others for the same socket.
+                socket->rpcsWaitingToReply.push_back(*this);
+                if (!socket->flushPending) {
+                    socket->flushPending = true;
+                    transport->socketsToFlush.push_back(socket);
+                }
+                return;
+            }
             if (!socket->rpcsWaitingToReply.empty()) {
                 // Can't transmit the response yet; the socket is backed up.
                 socket->rpcsWaitingToReply.push_back(*this);
@@ -958,6 +1180,68 @@ TcpTransport::TcpServerRpc::sendReply()
     transport->serverRpcPool.destroy(this);
 }
 
+/**
+ * Constructor for ReplyFlushers.
+ *
+ * \param transport
+ *      The TcpTransport whose queued replies will be transmitted.
+ */
+TcpTransport::ReplyFlusher::ReplyFlusher(TcpTransport* transport)
+    : Dispatch::Poller(transport->context->dispatch, "TcpTransport")
+    , transport(transport)
+{
+    // Empty constructor body.
+}
+
+/**
+ * This method is invoked by Dispatch during each pass through its polling
+ * loop; it transmits the replies queued by sendReply since the last pass.
+ * Sockets that can't take all of their replies finish them when they
+ * become writable.
+ *
+ * \return
+ *      1 means replies were transmitted, 0 means there were none.
+ */
+int
+TcpTransport::ReplyFlusher::poll()
+{
+    if (transport->socketsToFlush.empty()) {
+        return 0;
+    }
+    std::vector<Socket*> sockets;
+    sockets.swap(transport->socketsToFlush);
+    for (size_t i = 0; i < sockets.size(); i++) {
+        Socket* socket = sockets[i];
+        socket->flushPending = false;
+        try {
+            if (socket->bytesLeftToSend > 0) {
+                // The socket is already backed up; the ServerSocketHandler
+                // will send the new replies along with the old ones.
+                continue;
+            }
+            transport->flushReplies(socket);
+            if (!socket->rpcsWaitingToReply.empty()) {
+                socket->ioHandler.setEvents(Dispatch::FileEvent::READABLE |
+                        Dispatch::FileEvent::WRITABLE);
+            }
+        } catch (TransportException& e) {
+            transport->closeSocket(socket->fd);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Replies are only queued for flushing from the dispatch thread, so the
+ * dispatcher may sleep whenever none are waiting; incoming data wakes it
+ * up through the epoll thread.
+ */
+bool
+TcpTransport::ReplyFlusher::canSleep()
+{
+    return transport->socketsToFlush.empty();
+}
+
 // See Transport::ServerRpc::getclientServiceLocator for documentation.
 string
 TcpTransport::TcpServerRpc::getClientServiceLocator()
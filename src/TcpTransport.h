@@ -35,6 +35,19 @@ namespace RAMCloud {
  * this class will be used primarily for development and as a baseline
  * for testing.  The goal is to provide an implementation that is about as
  * fast as possible, given its use of kernel-based TCP/IP.
+ *
+ * To keep system calls per RPC low, each connection reads ahead: a receive
+ * asks the kernel for the rest of the current message plus as much of what
+ * follows as fits in a ReadAhead, so a burst of small pipelined messages is
+ * picked up with one recvmsg. Outgoing messages are gathered (header plus
+ * Buffer chunks) into one sendmsg. With the "batchReplies" option, a
+ * server also defers each reply until the end of the current pass through
+ * the dispatch loop, then writes all of a connection's replies at once.
+ * A server that needs more than one core for its connections should be
+ * run on DispatchShards, each of which has its own TcpTransport and
+ * reactor thread (see the "reusePort" option). Servers honor
+ * Transport::RequestPlacer hints: the kernel copies the bulk of a placed
+ * request straight from the socket to where the service wants it.
  */
 class TcpTransport : public Transport {
   public:
@@ -50,11 +63,16 @@ class TcpTransport : public Transport {
         return locatorString;
     }
     void registerMemory(void* base, size_t bytes) {}
+    void setRequestPlacer(RequestPlacer* placer) {
+        requestPlacer = placer;
+    }
 
     class TcpServerRpc;
   PRIVATE:
     class ServerSocketHandler;
     class IncomingMessage;
+    class ReadAhead;
+    class ReplyFlusher;
     class ClientSocketHandler;
     class Socket;
     class TcpSession;
@@ -76,6 +94,31 @@ class TcpTransport : public Transport {
         uint32_t len;
     } __attribute__((packed));
 
+    /**
+     * Holds bytes that were read from a connection beyond the end of the
+     * message being received; they are consumed by the next message(s)
+     * before the socket is read again.
+     */
+    class ReadAhead {
+      public:
+        ReadAhead() : next(0), end(0), data() {}
+
+        /// True means all of the bytes read ahead have been consumed.
+        bool empty() { return next == end; }
+
+        /// Offset in #data of the first byte not yet consumed.
+        uint32_t next;
+
+        /// Offset in #data just past the last byte read ahead.
+        uint32_t end;
+
+        /// Storage for bytes read ahead; its size is the most a receive
+        /// will read past the message it is working on.
+        char data[16384];
+
+        DISALLOW_COPY_AND_ASSIGN(ReadAhead);
+    };
+
     /**
      * Used to manage the receipt of a message (on either client or server)
      * using an event-based approach.
@@ -83,10 +126,12 @@ class TcpTransport : public Transport {
     class IncomingMessage {
         friend class ServerSocketHandler;
         friend class TcpServerRpc;
+        friend class TcpTransport;
       public:
-        IncomingMessage(Buffer* buffer, TcpSession* session);
+        IncomingMessage(Buffer* buffer, TcpSession* session,
+                RequestPlacer* placer = NULL);
         void cancel();
-        bool readMessage(int fd);
+        bool readMessage(int fd, ReadAhead* readAhead = NULL);
       PRIVATE:
         Header header;
 
@@ -115,6 +160,15 @@ class TcpTransport : public Transport {
         /// the header has arrived (or NULL).
         TcpSession* session;
 
+        /// If non-NULL, consulted about where to receive the body of the
+        /// message once its first bytes have arrived (see
+        /// Transport::RequestPlacer).
+        RequestPlacer* placer;
+
+        /// Holds the pin handed out by #placer, if any, until the message
+        /// is destroyed.
+        std::shared_ptr<void> placementPin;
+
         DISALLOW_COPY_AND_ASSIGN(IncomingMessage);
     };
 
@@ -135,7 +189,8 @@ class TcpTransport : public Transport {
         string getClientServiceLocator();
       PRIVATE:
         TcpServerRpc(Socket* socket, int fd, TcpTransport* transport)
-            : fd(fd), socketId(socket->id), message(&requestPayload, NULL),
+            : fd(fd), socketId(socket->id),
+            message(&requestPayload, NULL, transport->requestPlacer),
             queueEntries(), transport(transport) { }
 
         int fd;                   /// File descriptor of the socket on
@@ -190,10 +245,20 @@ class TcpTransport : public Transport {
 
   PRIVATE:
     void closeSocket(int fd);
-    static ssize_t recvCarefully(int fd, void* buffer, size_t length);
+    static uint32_t fillIovecs(Header* header, Buffer* payload,
+            uint32_t alreadySent, struct iovec* iov, uint32_t maxIovecs);
+    void flushReplies(Socket* socket);
+    static ssize_t recvCarefully(int fd, void* buffer, size_t length,
+            ReadAhead* readAhead = NULL);
     static int sendMessage(int fd, uint64_t nonce, Buffer* payload,
             int bytesToSend);
 
+    /// The most iovecs passed to one sendmsg call.  There's an upper limit
+    /// on the permissible number of iovecs in one outgoing message.
+    /// Unfortunately, this limit does not appear to be defined publicly,
+    /// so this is a guess.
+    static const uint32_t MAX_IOVECS = 100;
+
     /**
      * An event handler that will accept connections on a socket.
      */
@@ -236,6 +301,21 @@ class TcpTransport : public Transport {
         DISALLOW_COPY_AND_ASSIGN(ClientSocketHandler);
     };
 
+    /**
+     * Used with the "batchReplies" option: once per pass through the
+     * dispatch loop, transmits the replies that sendReply has queued.
+     */
+    class ReplyFlusher : public Dispatch::Poller {
+      public:
+        explicit ReplyFlusher(TcpTransport* transport);
+        virtual int poll();
+        virtual bool canSleep();
+      PRIVATE:
+        // Transport whose replies are flushed.
+        TcpTransport* transport;
+        DISALLOW_COPY_AND_ASSIGN(ReplyFlusher);
+    };
+
     /**
      * The TCP implementation of Sessions (stored on a client to manage its
      * interactions with a particular server).
@@ -262,7 +342,7 @@ class TcpTransport : public Transport {
             address(), fd(-1), serial(1),
             rpcsWaitingToSend(), bytesLeftToSend(0),
             rpcsWaitingForResponse(), current(NULL),
-            message(), clientIoHandler(),
+            message(), readAhead(), clientIoHandler(),
             alarm(transport->context->sessionAlarmTimer, this, 0) { }
 #endif
         void close();
@@ -296,6 +376,8 @@ class TcpTransport : public Transport {
         Tub<IncomingMessage> message;
                                   /// Records state of partially-received
                                   /// reply for current.
+        ReadAhead readAhead;      /// Bytes of replies that have been read
+                                  /// from fd but not yet consumed.
         Tub<ClientSocketHandler> clientIoHandler;
                                   /// Used to get notified when response data
                                   /// arrives.
@@ -317,9 +399,16 @@ class TcpTransport : public Transport {
     /// clients.  -1 means this instance is not a server.
     int listenSocket;
 
+    /// See setRequestPlacer(); NULL means requests are received normally.
+    RequestPlacer* requestPlacer;
+
     /// Used to wait for listenSocket to become readable.
     Tub<AcceptHandler> acceptHandler;
 
+    /// Constructed only with the "batchReplies" option; transmits queued
+    /// replies for the sockets in #socketsToFlush.
+    Tub<ReplyFlusher> replyFlusher;
+
     /// Used to hold information about a file descriptor associated with
     /// a socket, on which RPC requests may arrive.
     class Socket {
@@ -327,6 +416,7 @@ class TcpTransport : public Transport {
         Socket(int fd, TcpTransport* transport, sockaddr_in& sin);
         ~Socket();
         TcpTransport* transport;  /// The parent TcpTransport object.
+        int fd;                   /// File descriptor for the connection.
         uint64_t id;              /// Unique identifier: no other Socket
                                   /// for this transport instance will use
                                   /// the same value.
@@ -348,6 +438,10 @@ class TcpTransport : public Transport {
         struct sockaddr_in sin;   /// sockaddr_in of the client host on the
                                   /// other end of the socket. Used to
                                   /// implement #getClientServiceLocator().
+        ReadAhead readAhead;      /// Bytes of requests that have been read
+                                  /// from fd but not yet consumed.
+        bool flushPending;        /// True means this socket is on the
+                                  /// transport's socketsToFlush list.
         DISALLOW_COPY_AND_ASSIGN(Socket);
     };
 
@@ -359,6 +453,10 @@ class TcpTransport : public Transport {
     /// Used to assign increasing id values to Sockets.
     uint64_t nextSocketId;
 
+    /// Sockets with replies queued by sendReply that #replyFlusher hasn't
+    /// transmitted yet (only used with the "batchReplies" option).
+    std::vector<Socket*> socketsToFlush;
+
     /// Counts the number of nonzero-size partial messages sent by
     /// sendMessage (for testing only).
     static int messageChunks;
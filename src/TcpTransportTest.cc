@@ -336,6 +336,34 @@ TEST_F(TcpTransportTest, ServerSocketHandler_handleFileEvent_reads) {
     close(fd);
 }
 
+TEST_F(TcpTransportTest, ServerSocketHandler_handleFileEvent_readsPipelined) {
+    int fd = connectToServer(&locator);
+    server.acceptHandler->handleFileEvent(Dispatch::FileEvent::READABLE);
+    EXPECT_NE(server.sockets.size(), 0U);
+    int serverFd = downCast<unsigned>(server.sockets.size()) - 1;
+
+    // Send 3 requests at once; one event should pick up all of them.
+    char requests[3 * (sizeof(TcpTransport::Header) + 3)];
+    char* p = requests;
+    for (int i = 0; i < 3; i++) {
+        TcpTransport::Header header;
+        header.nonce = i;
+        header.len = 3;
+        memcpy(p, &header, sizeof(header));
+        memcpy(p + sizeof(header), "abc", 3);
+        p += sizeof(header) + 3;
+    }
+    EXPECT_EQ(static_cast<int>(sizeof(requests)),
+        write(fd, requests, sizeof(requests)));
+    server.sockets[serverFd]->ioHandler.handleFileEvent(
+            Dispatch::FileEvent::READABLE);
+    EXPECT_TRUE(server.sockets[serverFd]->readAhead.empty());
+    EXPECT_TRUE(server.sockets[serverFd]->rpc == NULL);
+    EXPECT_EQ(3, countWaitingRequests(&server));
+
+    close(fd);
+}
+
 TEST_F(TcpTransportTest, ServerSocketHandler_handleFileEvent_writes) {
     // Generate 3 requests and respond to each; make the first response
     // too large to send entirely in sendReply, so that handleFileEvent
@@ -555,6 +583,49 @@ TEST_F(TcpTransportTest, recvCarefully_ioErrors) {
     EXPECT_EQ("TcpTransport recv error: Operation not permitted", message);
 }
 
+TEST_F(TcpTransportTest, recvCarefully_readAhead) {
+    int fd = connectToServer(&locator);
+    server.acceptHandler->handleFileEvent(Dispatch::FileEvent::READABLE);
+    int serverFd = downCast<unsigned>(server.sockets.size()) - 1;
+    TcpTransport::ReadAhead readAhead;
+    char buffer[20];
+
+    // Nothing available.
+    EXPECT_EQ(0, TcpTransport::recvCarefully(serverFd, buffer, 4,
+            &readAhead));
+
+    // Extra bytes are left in readAhead.
+    write(fd, "abcdefghij", 10);
+    EXPECT_EQ(4, TcpTransport::recvCarefully(serverFd, buffer, 4,
+            &readAhead));
+    EXPECT_EQ("abcd", string(buffer, 4));
+    EXPECT_EQ(0U, readAhead.next);
+    EXPECT_EQ(6U, readAhead.end);
+
+    // Satisfied from readAhead without touching the socket.
+    sys->recvErrno = EPERM;
+    EXPECT_EQ(2, TcpTransport::recvCarefully(serverFd, buffer, 2,
+            &readAhead));
+    EXPECT_EQ("ef", string(buffer, 2));
+    sys->recvErrno = 0;
+
+    // Partly from readAhead, the rest from the socket.
+    write(fd, "klmnopq", 7);
+    EXPECT_EQ(8, TcpTransport::recvCarefully(serverFd, buffer, 8,
+            &readAhead));
+    EXPECT_EQ("ghijklmn", string(buffer, 8));
+    EXPECT_EQ("opq", string(readAhead.data + readAhead.next,
+            readAhead.end - readAhead.next));
+
+    // Not enough bytes anywhere.
+    EXPECT_EQ(3, TcpTransport::recvCarefully(serverFd, buffer, 8,
+            &readAhead));
+    EXPECT_EQ("opq", string(buffer, 3));
+    EXPECT_TRUE(readAhead.empty());
+
+    close(fd);
+}
+
 // (IncomingMessage::cancel is tested by cancelRequest tests below.)
 
 TEST_F(TcpTransportTest, IncomingMessage_readMessage_receiveHeaderInPieces) {
@@ -710,6 +781,101 @@ TEST_F(TcpTransportTest, IncomingMessage_readMessage_discardExtraneousBytes) {
     close(fd);
 }
 
+TEST_F(TcpTransportTest, IncomingMessage_readMessage_readAhead) {
+    int fd = connectToServer(&locator);
+    server.acceptHandler->handleFileEvent(Dispatch::FileEvent::READABLE);
+    int serverFd = downCast<unsigned>(server.sockets.size()) - 1;
+    TcpTransport::ReadAhead readAhead;
+    TcpTransport::Header header;
+    header.nonce = 1;
+    header.len = 5;
+    write(fd, &header, sizeof(header));
+    write(fd, "abcde", 5);
+    header.nonce = 2;
+    header.len = 3;
+    write(fd, &header, sizeof(header));
+    write(fd, "xy", 2);
+
+    // The first message arrives in a single read, leaving the start of
+    // the second one in readAhead.
+    Buffer buffer1;
+    TcpTransport::IncomingMessage incoming1(&buffer1, NULL);
+    EXPECT_TRUE(incoming1.readMessage(serverFd, &readAhead));
+    EXPECT_EQ("abcde", TestUtil::toString(&buffer1));
+    EXPECT_EQ(14U, readAhead.end - readAhead.next);
+
+    Buffer buffer2;
+    TcpTransport::IncomingMessage incoming2(&buffer2, NULL);
+    EXPECT_FALSE(incoming2.readMessage(serverFd, &readAhead));
+    EXPECT_EQ(2U, incoming2.header.nonce);
+    EXPECT_EQ(2U, incoming2.messageBytesReceived);
+    EXPECT_TRUE(readAhead.empty());
+    write(fd, "z", 1);
+    EXPECT_TRUE(incoming2.readMessage(serverFd, &readAhead));
+    EXPECT_EQ("xyz", TestUtil::toString(&buffer2));
+
+    close(fd);
+}
+
+// Places the body of requests that start with "put", except for their
+// last byte, in #destination.
+class TestPlacer : public Transport::RequestPlacer {
+  public:
+    TestPlacer() : destination() {}
+    uint32_t getPrefixLength() { return 3; }
+    void* placeRequest(const void* prefix, uint32_t requestLength,
+            uint32_t* length, std::shared_ptr<void>* pin) {
+        if (memcmp(prefix, "put", 3) != 0)
+            return NULL;
+        *length = requestLength - 4;
+        return destination;
+    }
+    char destination[100];
+};
+
+TEST_F(TcpTransportTest, IncomingMessage_readMessage_placeRequest) {
+    int fd = connectToServer(&locator);
+    server.acceptHandler->handleFileEvent(Dispatch::FileEvent::READABLE);
+    int serverFd = downCast<unsigned>(server.sockets.size()) - 1;
+    TestPlacer placer;
+    TcpTransport::Header header;
+    header.len = 9;
+    write(fd, &header, sizeof(header));
+    write(fd, "put", 3);
+
+    Buffer buffer;
+    TcpTransport::IncomingMessage incoming(&buffer, NULL, &placer);
+    EXPECT_FALSE(incoming.readMessage(serverFd));
+    EXPECT_EQ(3U, incoming.messageBytesReceived);
+    write(fd, "abcde!", 6);
+    EXPECT_TRUE(incoming.readMessage(serverFd));
+    EXPECT_EQ("putabcde!", TestUtil::toString(&buffer));
+    EXPECT_EQ("abcde", string(placer.destination, 5));
+    void* data;
+    EXPECT_EQ(5U, buffer.peek(3, &data));
+    EXPECT_EQ(placer.destination, data);
+
+    // Not placed.
+    write(fd, &header, sizeof(header));
+    write(fd, "get012345", 9);
+    Buffer buffer2;
+    TcpTransport::IncomingMessage incoming2(&buffer2, NULL, &placer);
+    EXPECT_TRUE(incoming2.readMessage(serverFd));
+    EXPECT_EQ("get012345", TestUtil::toString(&buffer2));
+    EXPECT_EQ("abcde", string(placer.destination, 5));
+
+    // Too short to be placed.
+    header.len = 2;
+    write(fd, &header, sizeof(header));
+    write(fd, "pu", 2);
+    Buffer buffer3;
+    TcpTransport::IncomingMessage incoming3(&buffer3, NULL, &placer);
+    EXPECT_TRUE(incoming3.readMessage(serverFd));
+    EXPECT_EQ("pu", TestUtil::toString(&buffer3));
+
+    close(fd);
+}
+
 TEST_F(TcpTransportTest, sessionConstructor_socketError) {
     sys->socketErrno = EPERM;
     string message("");
@@ -1242,6 +1408,92 @@ TEST_F(TcpTransportTest, sendReply_error) {
     EXPECT_TRUE(transport->sockets[fd] == NULL);
 }
 
+TEST_F(TcpTransportTest, sendReply_batchReplies) {
+    TestLog::Enable _("~TcpServerRpc");
+    ServiceLocator batchLocator(
+            "tcp+ip:host=localhost,port=11002,batchReplies=1");
+    TcpTransport batchServer(&context, &batchLocator);
+    EXPECT_TRUE(batchServer.replyFlusher);
+    Transport::SessionRef session = client.getSession(&batchLocator);
+    MockWrapper rpc1("request1");
+    session->sendRequest(&rpc1.request, &rpc1.response, &rpc1);
+    MockWrapper rpc2("request2");
+    session->sendRequest(&rpc2.request, &rpc2.response, &rpc2);
+
+    // Replies are held until the ReplyFlusher runs.
+    Transport::ServerRpc* serverRpc = workerManager->waitForRpc(1.0);
+    EXPECT_TRUE(serverRpc != NULL);
+    serverRpc->replyPayload.fillFromString("response1");
+    serverRpc->sendReply();
+    serverRpc = workerManager->waitForRpc(1.0);
+    EXPECT_TRUE(serverRpc != NULL);
+    serverRpc->replyPayload.fillFromString("response2");
+    serverRpc->sendReply();
+    TcpTransport::Socket* socket =
+            batchServer.sockets[batchServer.sockets.size() - 1];
+    EXPECT_EQ(2U, socket->rpcsWaitingToReply.size());
+    EXPECT_TRUE(socket->flushPending);
+    EXPECT_EQ(1U, batchServer.socketsToFlush.size());
+    EXPECT_EQ("", TestLog::get());
+
+    EXPECT_EQ(1, batchServer.replyFlusher->poll());
+    EXPECT_EQ(0U, socket->rpcsWaitingToReply.size());
+    EXPECT_FALSE(socket->flushPending);
+    EXPECT_EQ(0U, batchServer.socketsToFlush.size());
+    EXPECT_EQ("~TcpServerRpc: deleted | ~TcpServerRpc: deleted",
+            TestLog::get());
+    EXPECT_EQ(0, batchServer.replyFlusher->poll());
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc1));
+    EXPECT_EQ("response1/0", TestUtil::toString(&rpc1.response));
+    EXPECT_TRUE(TestUtil::waitForRpc(&context, rpc2));
+    EXPECT_EQ("response2/0", TestUtil::toString(&rpc2.response));
+
+    // Closing a socket takes it off the list.
+    MockWrapper rpc3("request3");
+    session->sendRequest(&rpc3.request, &rpc3.response, &rpc3);
+    serverRpc = workerManager->waitForRpc(1.0);
+    EXPECT_TRUE(serverRpc != NULL);
+    serverRpc->sendReply();
+    EXPECT_EQ(1U, batchServer.socketsToFlush.size());
+    batchServer.closeSocket(downCast<int>(batchServer.sockets.size()) - 1);
+    EXPECT_EQ(0U, batchServer.socketsToFlush.size());
+}
+
+TEST_F(TcpTransportTest, flushReplies_partialSend) {
+    Transport::SessionRef session = client.getSession(&locator);
+    MockWrapper rpc1("request1");
+    session->sendRequest(&rpc1.request, &rpc1.response, &rpc1);
+    MockWrapper rpc2("request2");
+    session->sendRequest(&rpc2.request, &rpc2.response, &rpc2);
+    TcpTransport::TcpServerRpc* serverRpc1 =
+            static_cast<TcpTransport::TcpServerRpc*>(
+            workerManager->waitForRpc(1.0));
+    EXPECT_TRUE(serverRpc1 != NULL);
+    serverRpc1->replyPayload.fillFromString("response1");
+    TcpTransport::TcpServerRpc* serverRpc2 =
+            static_cast<TcpTransport::TcpServerRpc*>(
+            workerManager->waitForRpc(1.0));
+    EXPECT_TRUE(serverRpc2 != NULL);
+    serverRpc2->replyPayload.fillFromString("response2");
+    TcpTransport::Socket* socket = server.sockets[serverRpc1->fd];
+    socket->rpcsWaitingToReply.push_back(*serverRpc1);
+    socket->rpcsWaitingToReply.push_back(*serverRpc2);
+    socket->bytesLeftToSend = -1;
+
+    // The first sendmsg gets part of the second reply out.
+    uint32_t replyLength = sizeof32(TcpTransport::Header) + 10;
+    sys->sendmsgReturnCount = replyLength + 5;
+    server.flushReplies(socket);
+    EXPECT_EQ(1U, socket->rpcsWaitingToReply.size());
+    EXPECT_EQ(downCast<int>(replyLength) - 5, socket->bytesLeftToSend);
+
+    // Now the rest goes.
+    sys->sendmsgReturnCount = -1;
+    server.flushReplies(socket);
+    EXPECT_EQ(0U, socket->rpcsWaitingToReply.size());
+    EXPECT_EQ(-1, socket->bytesLeftToSend);
+}
+
 TEST_F(TcpTransportTest, sessionAlarm) {
     TestLog::Enable _;
     TcpTransport::TcpSession* session = new TcpTransport::TcpSession(
@@ -13,6 +13,10 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Fence.h"
 #include "TimeTrace.h"
 
 namespace RAMCloud {
@@ -21,6 +25,7 @@ std::vector<TimeTrace::Buffer*> TimeTrace::threadBuffers;
 TimeTrace::TraceLogger* TimeTrace::backgroundLogger = NULL;
 SpinLock TimeTrace::mutex("TimeTrace::mutex");
 Atomic<int> TimeTrace::activeReaders(0);
+TimeTrace::FlightRecorder* TimeTrace::flightRecorder = NULL;
 
 /**
  * Creates a thread-private TimeTrace::Buffer object for the current thread,
@@ -241,6 +246,53 @@ TimeTrace::printToLogBackground(Dispatch* dispatch)
     backgroundLogger = new TraceLogger(dispatch);
 }
 
+/**
+ * Start continuously appending the events of all threads to a file, in the
+ * binary format described in TimeTrace::FlightRecorder; it can be printed
+ * with scripts/ttdecode.py. Events are still kept in the thread-local
+ * buffers as well. Does nothing if a recording is already in progress.
+ *
+ * \param path
+ *      File to write; truncated if it exists. A named pipe works too, e.g.
+ *      to stream the trace to a collector on another machine.
+ * \param intervalMicros
+ *      How often to copy new events to the file. A thread that records
+ *      more events than fit in its buffer within this time loses some.
+ * \throw Exception
+ *      The file couldn't be opened.
+ */
+void
+TimeTrace::startRecording(const char* path, uint32_t intervalMicros)
+{
+    SpinLock::Guard guard(mutex);
+    if (flightRecorder != NULL)
+        return;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw Exception(HERE, format("couldn't open time trace file %s",
+                path), errno);
+    }
+    flightRecorder = new FlightRecorder(fd, intervalMicros);
+    flightRecorder->start();
+    RAMCLOUD_LOG(NOTICE, "Recording time trace to %s", path);
+}
+
+/**
+ * Stop the recording started by startRecording, once the events recorded
+ * so far have been written out.
+ */
+void
+TimeTrace::stopRecording()
+{
+    FlightRecorder* recorder;
+    {
+        SpinLock::Guard guard(mutex);
+        recorder = flightRecorder;
+        flightRecorder = NULL;
+    }
+    delete recorder;
+}
+
 /**
  * Discards all records in all of the thread-local buffers. Intended
  * primarily for unit testing.
@@ -274,11 +326,175 @@ TimeTrace::TraceLogger::handleTimerEvent()
     TimeTrace::activeReaders.add(-1);
 }
 
+/**
+ * Construct a FlightRecorder and write the file header; no events are
+ * written until drain() or start() is called.
+ *
+ * \param fd
+ *      Open file to write to; the FlightRecorder closes it.
+ * \param intervalMicros
+ *      Microseconds between passes once start() is called.
+ */
+TimeTrace::FlightRecorder::FlightRecorder(int fd, uint32_t intervalMicros)
+    : fd(fd)
+    , intervalMicros(intervalMicros)
+    , drained()
+    , formatIds()
+    , output()
+    , running(0)
+    , thread()
+{
+    FileHeader header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.cyclesPerSecond = Cycles::perSecond();
+    append(&header, sizeof(header));
+}
+
+/**
+ * Stop the background thread, if any, and write out the remaining events.
+ */
+TimeTrace::FlightRecorder::~FlightRecorder()
+{
+    if (thread) {
+        running = 0;
+        thread->join();
+    }
+    drain();
+    close(fd);
+}
+
+/**
+ * Copy the events recorded since the last call from all of the
+ * thread-local buffers to the file.
+ */
+void
+TimeTrace::FlightRecorder::drain()
+{
+    std::vector<Buffer*> buffers;
+    {
+        SpinLock::Guard guard(TimeTrace::mutex);
+        buffers = threadBuffers;
+    }
+    drained.resize(buffers.size(), 0);
+
+    // Only the oldest events can be overwritten while they are copied, so
+    // leave some slack; events that were overwritten anyway are caught
+    // by the check after copying.
+    const uint64_t maxCopy = Buffer::BUFFER_SIZE - Buffer::BUFFER_SIZE / 8;
+    std::vector<Event> copies;
+    for (uint32_t i = 0; i < buffers.size(); i++) {
+        Buffer* buffer = buffers[i];
+        uint64_t first = drained[i];
+        uint64_t end = buffer->recorded;
+        if (end < first) {
+            // The buffer was reset.
+            first = 0;
+        }
+        uint64_t lost = 0;
+        if (end - first > maxCopy) {
+            lost = end - first - maxCopy;
+            first += lost;
+        }
+        Fence::lfence();
+        copies.clear();
+        for (uint64_t n = first; n < end; n++)
+            copies.push_back(buffer->events[n & Buffer::BUFFER_MASK]);
+        Fence::lfence();
+
+        // Event n was overwritten once event n + BUFFER_SIZE was started.
+        uint64_t now = buffer->recorded;
+        uint64_t skip = 0;
+        if (now >= Buffer::BUFFER_SIZE && now - Buffer::BUFFER_SIZE >= first)
+            skip = std::min(end, now - Buffer::BUFFER_SIZE + 1) - first;
+        lost += skip;
+        drained[i] = end;
+
+        uint16_t thread = downCast<uint16_t>(i);
+        if (lost > 0) {
+            LostRecord record{LOST, thread, lost};
+            append(&record, sizeof(record));
+        }
+        for (size_t j = skip; j < copies.size(); j++) {
+            Event* event = &copies[j];
+            if (event->format == NULL)
+                continue;
+            auto it = formatIds.find(event->format);
+            if (it == formatIds.end()) {
+                uint32_t id = downCast<uint32_t>(formatIds.size());
+                it = formatIds.emplace(event->format, id).first;
+                uint16_t length = downCast<uint16_t>(
+                        std::min<size_t>(strlen(event->format), 0xffff));
+                FormatRecord record{FORMAT, id, length};
+                append(&record, sizeof(record));
+                append(event->format, length);
+            }
+            EventRecord record{EVENT, thread, it->second, event->timestamp,
+                    {event->arg0, event->arg1, event->arg2, event->arg3}};
+            append(&record, sizeof(record));
+        }
+    }
+    flush();
+}
+
+/**
+ * Start the background thread that calls drain() periodically.
+ */
+void
+TimeTrace::FlightRecorder::start()
+{
+    running = 1;
+    thread.construct(&FlightRecorder::main, this);
+}
+
+/**
+ * Add bytes to the end of the file; they are actually written by flush().
+ */
+void
+TimeTrace::FlightRecorder::append(const void* data, size_t length)
+{
+    output.append(static_cast<const char*>(data), length);
+}
+
+/**
+ * Write everything passed to append() to the file.
+ */
+void
+TimeTrace::FlightRecorder::flush()
+{
+    size_t done = 0;
+    while (done < output.size()) {
+        ssize_t count = write(fd, output.data() + done, output.size() - done);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            RAMCLOUD_LOG(ERROR, "Couldn't write time trace file: %s",
+                    strerror(errno));
+            break;
+        }
+        done += count;
+    }
+    output.clear();
+}
+
+/**
+ * Main loop of the background thread.
+ */
+void
+TimeTrace::FlightRecorder::main()
+{
+    while (running) {
+        usleep(intervalMicros);
+        drain();
+    }
+}
+
 /**
  * Construct a TimeTrace::Buffer.
  */
 TimeTrace::Buffer::Buffer()
     : nextIndex(0)
+    , recorded(0)
     , events()
 {
     // Mark all of the events invalid.
@@ -340,6 +556,10 @@ void TimeTrace::Buffer::record(uint64_t timestamp, const char* format,
     event->arg1 = arg1;
     event->arg2 = arg2;
     event->arg3 = arg3;
+
+    // The flight recorder may copy the event as soon as this is updated.
+    __asm__ __volatile__("" ::: "memory");
+    recorded = recorded + 1;
 }
 
 /**
@@ -376,6 +596,7 @@ void TimeTrace::Buffer::reset()
         events[i].format = NULL;
     }
     nextIndex = 0;
+    recorded = 0;
 }
 
 } // namespace RAMCloud
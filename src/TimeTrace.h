@@ -16,11 +16,15 @@
 #ifndef RAMCLOUD_TIMETRACE_H
 #define RAMCLOUD_TIMETRACE_H
 
+#include <thread>
+#include <unordered_map>
+
 #include "Common.h"
 #include "Atomic.h"
 #include "Cycles.h"
 #include "Logger.h"
 #include "SpinLock.h"
+#include "Tub.h"
 #include "WorkerTimer.h"
 
 namespace RAMCloud {
@@ -45,6 +49,12 @@ namespace RAMCloud {
  *
  * If you want to use a single trace buffer rather than per-thread
  * buffers, see the subclass TimeTrace::Buffer below.
+ *
+ * In addition, startRecording() turns on a "flight recorder": a background
+ * thread that continuously copies new events out of the thread-local
+ * buffers and appends them to a file in a compact binary form, so that
+ * traces can be analyzed after the fact (see scripts/ttdecode.py) without
+ * printing them, which stalls the server.
  */
 class TimeTrace {
   public:
@@ -52,6 +62,9 @@ class TimeTrace {
     static string getTrace();
     static void printToLog();
     static void printToLogBackground(Dispatch* dispatch);
+    static void startRecording(const char* path,
+            uint32_t intervalMicros = 1000);
+    static void stopRecording();
 
     /**
      * Record an event in a thread-local buffer, creating a new buffer
@@ -122,6 +135,8 @@ class TimeTrace {
     };
 
 
+    class FlightRecorder;
+
     // Points to a private per-thread TimeTrace::Buffer object; NULL means
     // no such object has been created yet for the current thread.
     static __thread Buffer* threadBuffer;
@@ -144,6 +159,9 @@ class TimeTrace {
     // could interfere with readers.
     static Atomic<int> activeReaders;
 
+    // The flight recorder started by startRecording, if any.
+    static FlightRecorder* flightRecorder;
+
     /**
      * This structure holds one entry in a TimeTrace::Buffer.
      */
@@ -195,12 +213,105 @@ class TimeTrace {
         // record method.
         int nextIndex;
 
+        // Number of events recorded since the last reset; the nth of them
+        // is in events[n & BUFFER_MASK]. Only incremented once an event is
+        // complete, so the flight recorder can copy events up to here
+        // while more are being recorded.
+        volatile uint64_t recorded;
+
         // Holds information from the most recent calls to the record method.
         TimeTrace::Event events[BUFFER_SIZE];
 
         friend class TimeTrace;
         DISALLOW_COPY_AND_ASSIGN(Buffer);
     };
+
+  PROTECTED:
+    /**
+     * Continuously appends the events recorded in all of the thread-local
+     * buffers to a file, from a background thread; see startRecording.
+     * Each pass copies the events recorded since the previous one. If a
+     * thread records more than a buffer's worth of events between passes,
+     * the overwritten events are counted in a LOST record instead.
+     *
+     * The file starts with a FileHeader, followed by a sequence of records,
+     * each starting with a RecordType byte. All values are little-endian.
+     * Format strings are written once each (FORMAT), and events refer to
+     * them by number.
+     */
+    class FlightRecorder {
+      public:
+        FlightRecorder(int fd, uint32_t intervalMicros);
+        ~FlightRecorder();
+        void drain();
+        void start();
+
+        /// Identifies a flight recorder file, and its version.
+        static const uint32_t MAGIC = 0x52545452;     // "RTTR"
+        static const uint32_t VERSION = 1;
+
+        enum RecordType : uint8_t {
+            FORMAT = 1,
+            EVENT = 2,
+            LOST = 3,
+        };
+
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            double cyclesPerSecond;     // Converts event timestamps to time.
+        } __attribute__((packed));
+
+        /// Followed by #length bytes of format string (no terminating null).
+        struct FormatRecord {
+            uint8_t type;               // FORMAT.
+            uint32_t id;                // Used for the format in EventRecords.
+            uint16_t length;
+        } __attribute__((packed));
+
+        struct EventRecord {
+            uint8_t type;               // EVENT.
+            uint16_t thread;            // Index of the thread-local buffer.
+            uint32_t format;            // Id from an earlier FormatRecord.
+            uint64_t timestamp;
+            uint32_t args[4];
+        } __attribute__((packed));
+
+        struct LostRecord {
+            uint8_t type;               // LOST.
+            uint16_t thread;
+            uint64_t count;             // Events overwritten before copying.
+        } __attribute__((packed));
+
+      PRIVATE:
+        void append(const void* data, size_t length);
+        void flush();
+        void main();
+
+        // File the records are written to; closed by the destructor.
+        int fd;
+
+        // Microseconds between passes over the buffers.
+        uint32_t intervalMicros;
+
+        // Entry i is the number of events of threadBuffers[i] already
+        // copied.
+        std::vector<uint64_t> drained;
+
+        // Id assigned to each format string written so far.
+        std::unordered_map<const char*, uint32_t> formatIds;
+
+        // Records not yet written to #fd.
+        string output;
+
+        // Cleared to make #thread exit.
+        Atomic<int> running;
+
+        // Runs main(), once start() is called.
+        Tub<std::thread> thread;
+
+        DISALLOW_COPY_AND_ASSIGN(FlightRecorder);
+    };
 };
 
 } // namespace RAMCloud
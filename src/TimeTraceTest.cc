@@ -249,4 +249,88 @@ TEST_F(TimeTraceTest, Buffer_reset) {
     EXPECT_EQ(0, buffer.nextIndex);
 }
 
+TEST_F(TimeTraceTest, startRecording_badFile) {
+    EXPECT_THROW(TimeTrace::startRecording("/nonexistent/dir/trace"),
+            Exception);
+    EXPECT_TRUE(TimeTrace::flightRecorder == NULL);
+}
+
+TEST_F(TimeTraceTest, FlightRecorder_drain) {
+    typedef TimeTrace::FlightRecorder Recorder;
+    char fileName[] = "/tmp/ramcloud-timetrace-test-delete-this-XXXXXX";
+    int fd = mkstemp(fileName);
+    std::vector<TimeTrace::Buffer*> saved;
+    saved.swap(TimeTrace::threadBuffers);
+    TimeTrace::threadBuffers.push_back(&buffer);
+    TimeTrace::threadBuffers.push_back(&buffer2);
+    {
+        Recorder recorder(fd, 1000);
+        buffer.record(100, "point %u", 1);
+        buffer2.record(150, "point %u", 2);
+        recorder.drain();
+        buffer.record(200, "point %u", 3);
+        // The second buffer wraps around before it is drained again.
+        for (uint32_t i = 0; i < TimeTrace::Buffer::BUFFER_SIZE + 10; i++)
+            buffer2.record(300 + i, "other");
+    }
+    TimeTrace::threadBuffers.swap(saved);
+
+    string contents = TestUtil::readFile(fileName);
+    unlink(fileName);
+    const char* p = contents.data();
+    const Recorder::FileHeader* header =
+            reinterpret_cast<const Recorder::FileHeader*>(p);
+    EXPECT_EQ(0x52545452U, header->magic);
+    EXPECT_GT(header->cyclesPerSecond, 0);
+    p += sizeof(*header);
+
+    const Recorder::FormatRecord* format =
+            reinterpret_cast<const Recorder::FormatRecord*>(p);
+    EXPECT_EQ(Recorder::FORMAT, format->type);
+    EXPECT_EQ(0U, format->id);
+    EXPECT_EQ("point %u", string(p + sizeof(*format), format->length));
+    p += sizeof(*format) + format->length;
+
+    const Recorder::EventRecord* event =
+            reinterpret_cast<const Recorder::EventRecord*>(p);
+    EXPECT_EQ(Recorder::EVENT, event->type);
+    EXPECT_EQ(0U, event->thread);
+    EXPECT_EQ(100U, event->timestamp);
+    EXPECT_EQ(1U, event->args[0]);
+    p += sizeof(*event);
+    event = reinterpret_cast<const Recorder::EventRecord*>(p);
+    EXPECT_EQ(1U, event->thread);
+    EXPECT_EQ(0U, event->format);
+    EXPECT_EQ(2U, event->args[0]);
+    p += sizeof(*event);
+
+    // Second pass: the format string isn't written again.
+    event = reinterpret_cast<const Recorder::EventRecord*>(p);
+    EXPECT_EQ(Recorder::EVENT, event->type);
+    EXPECT_EQ(200U, event->timestamp);
+    EXPECT_EQ(3U, event->args[0]);
+    p += sizeof(*event);
+
+    const Recorder::LostRecord* lost =
+            reinterpret_cast<const Recorder::LostRecord*>(p);
+    EXPECT_EQ(Recorder::LOST, lost->type);
+    EXPECT_EQ(1U, lost->thread);
+    uint64_t kept = TimeTrace::Buffer::BUFFER_SIZE -
+            TimeTrace::Buffer::BUFFER_SIZE / 8;
+    EXPECT_EQ(TimeTrace::Buffer::BUFFER_SIZE + 10 - kept, lost->count);
+    p += sizeof(*lost);
+    EXPECT_EQ(Recorder::FORMAT, *p);
+    EXPECT_EQ(contents.data() + contents.size(),
+            p + sizeof(Recorder::FormatRecord) + 5 +
+            kept * sizeof(Recorder::EventRecord));
+}
+
+TEST_F(TimeTraceTest, Buffer_record_countsEvents) {
+    buffer.record(100, "point a");
+    buffer.record(200, "point b");
+    EXPECT_EQ(2U, buffer.recorded);
+    buffer.reset();
+    EXPECT_EQ(0U, buffer.recorded);
+}
+
 }  // namespace RAMCloud
@@ -13,6 +13,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include "ClientLeaseAgent.h"
 #include "ClientTransactionManager.h"
 #include "ClientTransactionTask.h"
 #include "ClientException.h"
@@ -25,13 +26,21 @@ namespace RAMCloud {
  *
  * \param ramcloud
  *      Overall information about the calling client.
+ * \param snapshotIsolation
+ *      True means reads observe a snapshot of the cluster taken now and
+ *      are not validated at commit; false (the default) means the
+ *      transaction is serializable.
  */
-Transaction::Transaction(RamCloud* ramcloud)
+Transaction::Transaction(RamCloud* ramcloud, bool snapshotIsolation)
     : ramcloud(ramcloud)
     , taskPtr(new ClientTransactionTask(ramcloud))
     , commitStarted(false)
     , nextReadBatchPtr()
 {
+    ramcloud->transactionManager->waitToStartTransaction(ramcloud);
+    if (snapshotIsolation) {
+        taskPtr->snapshotTime = ramcloud->clientLeaseAgent->getClusterTime();
+    }
 }
 
 /**
@@ -253,6 +262,12 @@ Transaction::ReadOp::ReadOp(Transaction* transaction, uint64_t tableId,
     Key keyObj(tableId, key, keyLength);
     ClientTransactionTask::CacheEntry* entry = task->findCacheEntry(keyObj);
 
+    // MultiRead has no notion of snapshots, so snapshot reads always go
+    // out one at a time.
+    if (task->snapshotTime != 0) {
+        requestBatched = false;
+    }
+
     if (!requestBatched) {
         singleRequest.construct();
     } else {
@@ -265,7 +280,8 @@ Transaction::ReadOp::ReadOp(Transaction* transaction, uint64_t tableId,
             assert(singleRequest);
             buf.construct();
             singleRequest->readRpc.construct(
-                    transaction->ramcloud, tableId, key, keyLength, buf.get());
+                    transaction->ramcloud, tableId, key, keyLength, buf.get(),
+                    static_cast<const RejectRules*>(NULL), task->snapshotTime);
         } else {
             assert(batchedRequest);
 
@@ -42,6 +42,13 @@ class ClientTransactionTask;
  * It is the client's responsibility to check the return value of the commit
  * call and retry the transaction upon abort.
  *
+ * A transaction constructed with snapshot isolation reads every object as it
+ * was at the cluster time the transaction started, and only the objects it
+ * writes or removes are checked for conflicts at commit; read-only snapshot
+ * transactions therefore never abort.  Snapshot reads are served from old
+ * versions the masters retain (see the snapshotRetentionMs server option)
+ * and throw SnapshotTooOldException once those are no longer available.
+ *
  * Each Transaction object represents a single transaction attempt.  Transaction
  * objects should be discarded after the transaction either commits or aborts;
  * a single Transaction object is not intended to be reused to represent
@@ -53,7 +60,7 @@ class Transaction {
     struct ReadBatch;
 
   PUBLIC:
-    explicit Transaction(RamCloud* ramcloud);
+    explicit Transaction(RamCloud* ramcloud, bool snapshotIsolation = false);
 
     bool commit();
     void sync();
@@ -747,7 +747,8 @@ TEST_F(TransactionRecordTest, inProgress_acked) {
             service1->transactionManager.tabletManager);
 
     {
-        UnackedRpcResults::Lock lock(service1->unackedRpcResults.mutex);
+        UnackedRpcResults::Lock lock(
+                service1->unackedRpcResults.getShard(42).mutex);
         UnackedRpcResults::Client* client =
                 service1->unackedRpcResults.getOrInitClientRecord(42, lock);
         client->maxAckId = 12;
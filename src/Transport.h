@@ -17,6 +17,7 @@
 #define RAMCLOUD_TRANSPORT_H
 
 #include <atomic>
+#include <memory>
 #include <string>
 #include <boost/intrusive_ptr.hpp>
 
@@ -24,8 +25,10 @@
 #include "Buffer.h"
 #include "CodeLocation.h"
 #include "Exception.h"
+#include "LogProtector.h"
 
 namespace RAMCloud {
+class DispatchShard;
 class ServiceLocator;
 
 /**
@@ -72,9 +75,9 @@ class Transport {
         ServerRpc()
             : requestPayload()
             , replyPayload()
-            , epoch(0)
-            , activities(~0)
-            , outstandingRpcListHook()
+            , logProtectorPin()
+            , shard(NULL)
+            , arrivalTime(0)
         {}
 
       public:
@@ -105,16 +108,6 @@ class Transport {
          */
         virtual string getClientServiceLocator() = 0;
 
-        /**
-         * Returns false if the epoch was not set, else true. Used to assert
-         * that no RPCs are pushed through the WorkerManager without an epoch.
-         */
-        bool
-        epochIsSet()
-        {
-            return epoch != 0;
-        }
-
         /**
          * The incoming RPC payload, which contains a request.
          */
@@ -126,26 +119,18 @@ class Transport {
         Buffer replyPayload;
 
         /**
-         * The epoch of this RPC upon reception. ServerRpcPool will set this
-         * value automatically, tagging the incoming RPC before it is passed to
-         * the handling service's dispatch method. This number can be used later
-         * to determine if any RPCs less than or equal to a certain epoch are
-         * still outstanding in the system.
+         * Pins the epoch in which a worker started servicing this RPC until
+         * the RPC is destroyed (its reply may refer to log memory until then),
+         * so that the cleaner doesn't free anything the RPC might be using.
+         * The WorkerManager acquires the pin; individual RPCs can replace its
+         * default activities (~0, which means all activities) with a more
+         * selective value so that the RPCs will be ignored in some cases when
+         * scanning epochs.
          */
-        uint64_t epoch;
+        LogProtector::Pin logProtectorPin;
 
         /**
-         * A bit mask indicating what sorts of actions are being performed
-         * during this RPC (default: ~0, which means all activities).
-         * Individual RPCs can replace the default with a more selective
-         * value so that the RPCs will be ignored in some cases when
-         * scanning epochs. 0 means the RPC isn't doing anything that
-         * matters to anyone.
-         */
-        int activities;
-
-        /**
-         * Bit values for activities above.
+         * Bit values for the activities of logProtectorPin.
          * READ_ACTIVITY:             RPC is reading log information
          * APPEND_ACTIVITY:           RPC may add new entries to the log
          */
@@ -153,11 +138,18 @@ class Transport {
         static const int APPEND_ACTIVITY = 2;
 
         /**
-         * Hook for the list of active server RPCs that the ServerRpcPool class
-         * maintains. RPCs are added when ServerRpc-derived classes are
-         * constructed by ServerRpcPool and removed when they're destroyed.
+         * If the transport that received this RPC runs on a DispatchShard's
+         * thread, that shard (its reply must be sent from that thread);
+         * otherwise NULL.
+         */
+        DispatchShard* shard;
+
+        /**
+         * Cycles::rdtsc() time when the WorkerManager received this RPC;
+         * used to measure how long it waited for a worker thread (see
+         * RpcLatencyStats).
          */
-        IntrusiveListHook outstandingRpcListHook;
+        uint64_t arrivalTime;
 
       PRIVATE:
         DISALLOW_COPY_AND_ASSIGN(ServerRpc);
@@ -171,6 +163,7 @@ class Transport {
         explicit Session(const string& serviceLocator)
             : refCount(0)
             , serviceLocator(serviceLocator)
+            , retryBackoffMicros(0)
         {}
 
         virtual ~Session() {
@@ -231,6 +224,65 @@ class Transport {
          */
         virtual void abort() {}
 
+        /**
+         * Copy bytes directly out of the server's memory, without involving
+         * the server's CPU (one-sided RDMA). Most transports can't do this.
+         * This method is synchronous; it must be invoked in the dispatch
+         * thread (or with the Dispatch lock held).
+         * \param remoteAddress
+         *      Address of the first byte to read, in the server's address
+         *      space.
+         * \param remoteKey
+         *      Key identifying the region containing \a remoteAddress, as
+         *      returned by the server's Transport::getRemoteKey.
+         * \param length
+         *      Number of bytes to read.
+         * \param[out] dest
+         *      The bytes are copied here.
+         * \return
+         *      True means \a dest now holds the bytes; false means the read
+         *      couldn't be performed, and the caller should fall back to an
+         *      RPC.
+         */
+        virtual bool readRemote(uint64_t remoteAddress, uint32_t remoteKey,
+                uint32_t length, void* dest) {
+            return false;
+        }
+
+        /**
+         * Copy bytes directly into the server's memory, without involving
+         * the server's CPU (one-sided RDMA); the counterpart of
+         * #readRemote. Most transports can't do this. This method is
+         * synchronous: once it returns true the bytes are in the server's
+         * memory. It must be invoked in the dispatch thread (or with the
+         * Dispatch lock held).
+         * \param remoteAddress
+         *      Address in the server's address space where the first byte
+         *      is to be written.
+         * \param remoteKey
+         *      Key identifying the region containing \a remoteAddress, as
+         *      returned by the server's Transport::getRemoteKey.
+         * \param source
+         *      Holds the bytes to write.
+         * \param offset
+         *      Offset in \a source of the first byte to write.
+         * \param length
+         *      Number of bytes to write.
+         * \return
+         *      True means the bytes have been written; false means the write
+         *      couldn't be performed, and the caller should fall back to an
+         *      RPC. Nothing may be assumed about the contents of the
+         *      destination after a failed write.
+         */
+        virtual bool writeRemote(uint64_t remoteAddress, uint32_t remoteKey,
+                Buffer* source, uint32_t offset, uint32_t length) {
+            return false;
+        }
+
+        /// Returns the number of SessionRefs that currently refer to this
+        /// Session.
+        int getRefCount() const { return refCount; }
+
         friend void intrusive_ptr_add_ref(Session* session);
 
         friend void intrusive_ptr_release(Session* session);
@@ -243,6 +295,14 @@ class Transport {
         /// The service locator this Session is connected to.
         const string serviceLocator;
 
+        /// Extra delay, in microseconds, that RpcWrapper adds to the delay
+        /// a server asks for when it returns STATUS_RETRY. It grows
+        /// multiplicatively with each STATUS_RETRY from this session's
+        /// server and shrinks additively with each successful response, so
+        /// that all of the RPCs a client has outstanding to an overloaded
+        /// server back off together and return gradually.
+        std::atomic<uint32_t> retryBackoffMicros;
+
       PRIVATE:
         DISALLOW_COPY_AND_ASSIGN(Session);
     };
@@ -332,6 +392,75 @@ class Transport {
      */
     virtual void registerMemory(void* base, size_t bytes) {};
 
+    /**
+     * Find the key that clients must present in Session::readRemote (or
+     * Session::writeRemote) to access a range of memory registered with
+     * #registerMemory.
+     * \param address
+     *      First byte of the range.
+     * \param length
+     *      Number of bytes in the range.
+     * \param[out] key
+     *      Filled in with the key.
+     * \return
+     *      False means this transport doesn't support one-sided accesses,
+     *      or the range isn't contained in a registered region.
+     */
+    virtual bool getRemoteKey(const void* address, size_t length,
+            uint32_t* key) {
+        return false;
+    }
+
+    /**
+     * Lets a service choose where the bulk of an incoming request is
+     * received, so that a transport which has to copy request bytes out of
+     * the network stack anyway can put them directly where the service will
+     * keep them (for example, a backup's replica buffers) rather than in a
+     * temporary buffer the service then copies from. This is only a hint:
+     * transports may ignore it, so a service must check where the bytes of
+     * each request actually ended up (e.g. with Buffer::peek).
+     */
+    class RequestPlacer {
+      public:
+        virtual ~RequestPlacer() {}
+
+        /**
+         * Return the number of bytes at the start of a request that
+         * placeRequest() needs to see.
+         */
+        virtual uint32_t getPrefixLength() = 0;
+
+        /**
+         * Choose where to receive the rest of a request. Invoked by the
+         * transport's receiving thread once the first getPrefixLength()
+         * bytes of a request have arrived, so it must not block.
+         *
+         * \param prefix
+         *      The first getPrefixLength() bytes of the request.
+         * \param requestLength
+         *      Total bytes in the request, including \a prefix.
+         * \param[out] length
+         *      Set to the number of bytes, following \a prefix, to receive
+         *      at the returned address.
+         * \param[out] pin
+         *      May be set to keep the memory at the returned address in
+         *      place; the transport holds it until the request is
+         *      destroyed.
+         * \return
+         *      Where to receive the \a length bytes following \a prefix,
+         *      or NULL to receive the request normally.
+         */
+        virtual void* placeRequest(const void* prefix, uint32_t requestLength,
+                uint32_t* length, std::shared_ptr<void>* pin) = 0;
+    };
+
+    /**
+     * Consult \a placer (see RequestPlacer) for requests received from now
+     * on; NULL stops consulting it. The Dispatch lock must be held by the
+     * caller. The default is for transports that ignore placement hints.
+     */
+    virtual void setRequestPlacer(RequestPlacer* placer) {}
+
     /// Dump out performance and debugging statistics.
     virtual void dumpStats() {}
 
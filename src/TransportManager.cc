@@ -21,6 +21,7 @@
 #include "RawMetrics.h"
 #include "TransportManager.h"
 #include "TransportFactory.h"
+#include "ShmDriver.h"
 #include "TcpTransport.h"
 #include "UdpDriver.h"
 #include "FailSession.h"
@@ -40,6 +41,10 @@
 #include "DpdkDriver.h"
 #endif
 
+#ifdef XDP
+#include "XdpDriver.h"
+#endif
+
 namespace RAMCloud {
 
 static struct TcpTransportFactory : public TransportFactory {
@@ -62,6 +67,17 @@ static struct BasicUdpTransportFactory : public TransportFactory {
     }
 } basicUdpTransportFactory;
 
+static struct BasicShmTransportFactory : public TransportFactory {
+    BasicShmTransportFactory()
+        : TransportFactory("basic+shm") {}
+    Transport* createTransport(Context* context,
+            const ServiceLocator* localServiceLocator) {
+        return new BasicTransport(context, localServiceLocator,
+                new ShmDriver(context, localServiceLocator),
+                generateRandom());
+    }
+} basicShmTransportFactory;
+
 #ifdef ONLOAD
 static struct BasicSolarFlareTransportFactory : public TransportFactory {
     BasicSolarFlareTransportFactory()
@@ -121,6 +137,30 @@ struct BasicDpdkTransportFactory : public TransportFactory {
 static BasicDpdkTransportFactory basicDpdkTransportFactory;
 #endif
 
+#ifdef XDP
+struct BasicXdpTransportFactory : public TransportFactory {
+    BasicXdpTransportFactory()
+        : TransportFactory("basic+xdp", "basic+xdp"), driver(NULL)  {}
+    Transport* createTransport(Context* context,
+            const ServiceLocator* localServiceLocator) {
+        if (driver == NULL) {
+            LOG(WARNING, "Tried to use basic+xdp transport, but AF_XDP is "
+                    "not enabled (did you specify the --xdpInterface "
+                    "command-line option?)");
+            throw TransportException(HERE, "AF_XDP is not enabled");
+        }
+        return new BasicTransport(context, localServiceLocator,
+                driver, generateRandom());
+    }
+    void setXdpDriver(XdpDriver* driver) {
+        this->driver = driver;
+    }
+    XdpDriver* driver;
+    DISALLOW_COPY_AND_ASSIGN(BasicXdpTransportFactory);
+};
+static BasicXdpTransportFactory basicXdpTransportFactory;
+#endif
+
 /**
  * TransportManager constructor.
  * 
@@ -134,8 +174,11 @@ TransportManager::TransportManager(Context* context)
     , transports()
     , listeningLocators()
     , sessionCache()
+    , sessionLru()
+    , maxCachedSessions(0)
     , registeredBases()
     , registeredSizes()
+    , requestPlacer(NULL)
     , mutex("TransportManager::mutex")
     , sessionTimeoutMs(0)
     , mockRegistrations(0)
@@ -155,13 +198,26 @@ TransportManager::TransportManager(Context* context)
         int dpdkPort = context->options->getDpdkPort();
         if (dpdkPort >= 0) {
             basicDpdkTransportFactory.setDpdkDriver(
-                    new DpdkDriver(context, dpdkPort));
+                    new DpdkDriver(context, dpdkPort,
+                            context->options->getDpdkQueues()));
+        }
+    }
+#endif
+#ifdef XDP
+    transportFactories.push_back(&basicXdpTransportFactory);
+    if (context->options != NULL) {
+        const string& xdpInterface = context->options->getXdpInterface();
+        if (!xdpInterface.empty()) {
+            basicXdpTransportFactory.setXdpDriver(
+                    new XdpDriver(context, xdpInterface,
+                            context->options->getXdpQueue()));
         }
     }
 #endif
     transports.resize(transportFactories.size(), NULL);
     if (context->options != NULL) {
         sessionTimeoutMs = context->options->getSessionTimeout();
+        maxCachedSessions = context->options->getMaxCachedSessions();
     }
 }
 
@@ -170,6 +226,7 @@ TransportManager::~TransportManager()
     // Must clear the cache and destroy sessionRefs before the
     // transports are destroyed.
     sessionCache.clear();
+    sessionLru.clear();
 
     // Delete any mockRegistrations
 #if TESTING
@@ -217,6 +274,7 @@ TransportManager::initialize(const char* localServiceLocator)
                     transport->registerMemory(registeredBases[j],
                                               registeredSizes[j]);
                 }
+                transport->setRequestPlacer(requestPlacer);
                 if (transports[i] == NULL) {
                     transports[i] = transport;
                 } else {
@@ -269,8 +327,11 @@ TransportManager::flushSession(const string& serviceLocator)
 
     TEST_LOG("flushing session for %s", serviceLocator.c_str());
     auto it = sessionCache.find(serviceLocator);
-    if (it != sessionCache.end())
+    if (it != sessionCache.end()) {
+        if (it->second.lruPosition != sessionLru.end())
+            sessionLru.erase(it->second.lruPosition);
         sessionCache.erase(it);
+    }
 }
 
 /**
@@ -307,18 +368,56 @@ TransportManager::getSession(const string& serviceLocator)
     // First check to see if we have already opened a session for the
     // locator; this should almost always be true.
     auto it = sessionCache.find(serviceLocator);
-    if (it != sessionCache.end())
-        return it->second;
+    if (it != sessionCache.end()) {
+        if (it->second.lruPosition != sessionLru.end()) {
+            sessionLru.splice(sessionLru.end(), sessionLru,
+                    it->second.lruPosition);
+        }
+        return it->second.session;
+    }
 
     CycleCounter<RawMetric> counter;
 
     // Session was not found in the cache, so create a new one and add
     // it to the cache.
     Transport::SessionRef session(openSessionInternal(serviceLocator));
-    sessionCache.insert({serviceLocator, session});
+    SessionLru::iterator lruPosition = sessionLru.end();
+    if (maxCachedSessions != 0) {
+        lruPosition = sessionLru.insert(sessionLru.end(), serviceLocator);
+    }
+    sessionCache.insert({serviceLocator, CachedSession(session, lruPosition)});
+    if (sessionCache.size() > maxCachedSessions && maxCachedSessions != 0) {
+        evictIdleSessions();
+    }
     return session;
 }
 
+/**
+ * Close least recently used sessions that no one is using, until the
+ * cache holds no more than #maxCachedSessions (or only sessions that are
+ * in use). The caller must hold #mutex if this is a server.
+ */
+void
+TransportManager::evictIdleSessions()
+{
+    SessionLru::iterator next = sessionLru.begin();
+    while (sessionCache.size() > maxCachedSessions &&
+            next != sessionLru.end()) {
+        SessionLru::iterator lruPosition = next++;
+        auto it = sessionCache.find(*lruPosition);
+        assert(it != sessionCache.end());
+
+        // A session held only by the cache has no RPCs in progress (RPCs
+        // hold SessionRefs until they finish), and no one can get another
+        // reference to it without going through getSession.
+        if (it->second.session->getRefCount() > 1)
+            continue;
+        TEST_LOG("closing idle session for %s", lruPosition->c_str());
+        sessionLru.erase(lruPosition);
+        sessionCache.erase(it);
+    }
+}
+
 /**
  * Return a ServiceLocator string corresponding to the listening
  * ServiceLocators.
@@ -332,6 +431,24 @@ TransportManager::getListeningLocatorsString()
     return listeningLocators;
 }
 
+/**
+ * This method is invoked instead of #initialize on servers whose listening
+ * transports belong to other TransportManagers (see DispatchShard): this
+ * TransportManager then only creates transports for outgoing requests, but
+ * otherwise behaves as on any other server.
+ *
+ * \param locators
+ *      Locators the server is listening on, as returned by
+ *      getListeningLocatorsString() for the TransportManagers that are
+ *      listening.
+ */
+void
+TransportManager::setListeningLocators(const string& locators)
+{
+    isServer = true;
+    listeningLocators = locators;
+}
+
 /**
  * Given a service locator, open a new session connected to that service
  * locator.  If necessary, this method also instantiates a new transport
@@ -400,6 +517,7 @@ TransportManager::openSessionInternal(const string& serviceLocator)
                         transports[i]->registerMemory(registeredBases[j],
                                                       registeredSizes[j]);
                     }
+                    transports[i]->setRequestPlacer(requestPlacer);
                 } catch (TransportException &e) {
                     continue;
                 }
@@ -453,6 +571,38 @@ TransportManager::registerMemory(void* base, size_t bytes)
     registeredSizes.push_back(bytes);
 }
 
+/**
+ * See #Transport::getRemoteKey. The key returned is that of the first
+ * transport that supports one-sided reads of the given range.
+ */
+bool
+TransportManager::getRemoteKey(const void* address, size_t length,
+        uint32_t* key)
+{
+    Dispatch::Lock lock(context->dispatch);
+    foreach (auto transport, transports) {
+        if (transport != NULL &&
+                transport->getRemoteKey(address, length, key))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * See #Transport::setRequestPlacer. Applies to all transports, including
+ * ones created after this call.
+ */
+void
+TransportManager::setRequestPlacer(Transport::RequestPlacer* placer)
+{
+    Dispatch::Lock lock(context->dispatch);
+    foreach (auto transport, transports) {
+        if (transport != NULL)
+            transport->setRequestPlacer(placer);
+    }
+    requestPlacer = placer;
+}
+
 /**
  * Use a particular timeout value for all new transports created from now on.
  *
@@ -464,6 +614,24 @@ void TransportManager::setSessionTimeout(uint32_t timeoutMs)
     this->sessionTimeoutMs = timeoutMs;
 }
 
+/**
+ * Limit the number of idle sessions this TransportManager keeps open
+ * (see #maxCachedSessions). Sessions cached before this call aren't
+ * subject to the limit.
+ *
+ * \param maxSessions
+ *      The new limit; 0 means no limit.
+ */
+void
+TransportManager::setMaxCachedSessions(uint32_t maxSessions)
+{
+    Tub<std::lock_guard<SpinLock>> lock;
+    if (isServer) {
+        lock.construct(mutex);
+    }
+    maxCachedSessions = maxSessions;
+}
+
 /**
  * Return current timeout value (ms) for all server port created from now on.
  *
@@ -17,6 +17,7 @@
 #define RAMCLOUD_TRANSPORTMANAGER_H
 
 #include <boost/foreach.hpp>
+#include <list>
 #include <map>
 #include <set>
 
@@ -50,12 +51,16 @@ class TransportManager {
     void flushSession(const string& serviceLocator);
     Transport::SessionRef getSession(const string& serviceLocator);
     string getListeningLocatorsString();
+    void setListeningLocators(const string& locators);
     Transport::SessionRef openSession(const string& serviceLocator);
     void registerMemory(void* base, size_t bytes);
+    bool getRemoteKey(const void* address, size_t length, uint32_t* key);
+    void setRequestPlacer(Transport::RequestPlacer* placer);
     void dumpStats();
     void dumpTransportFactories();
     void setSessionTimeout(uint32_t timeoutMs);
     uint32_t getSessionTimeout() const;
+    void setMaxCachedSessions(uint32_t maxSessions);
 
 #if TESTING
     /**
@@ -86,6 +91,7 @@ class TransportManager {
         transportFactories.pop_back();
         transports.pop_back();
         sessionCache.clear();
+        sessionLru.clear();
     }
 
     struct MockRegistrar {
@@ -103,6 +109,7 @@ class TransportManager {
 #endif
 
   PRIVATE:
+    void evictIdleSessions();
     Transport::SessionRef openSessionInternal(const string& serviceLocator);
 
     /**
@@ -140,12 +147,46 @@ class TransportManager {
      */
     std::string listeningLocators;
 
+    /// Service locators of the sessions in #sessionCache, from least to
+    /// most recently used (only maintained if #maxCachedSessions is set).
+    typedef std::list<string> SessionLru;
+
+    /**
+     * An entry in #sessionCache.
+     */
+    struct CachedSession {
+        CachedSession(Transport::SessionRef session,
+                SessionLru::iterator lruPosition)
+            : session(session)
+            , lruPosition(lruPosition)
+        {}
+
+        /// The cached session.
+        Transport::SessionRef session;
+
+        /// This session's place in #sessionLru (end() if #sessionLru isn't
+        /// maintained).
+        SessionLru::iterator lruPosition;
+    };
+
     /**
      * A map from service locator to SessionRef instances for #getSession().
      * This is used as a cache so that the same SessionRef is used if
      * #getSession() is called on an existing service locator string.
      */
-    std::unordered_map<string, Transport::SessionRef> sessionCache;
+    std::unordered_map<string, CachedSession> sessionCache;
+
+    /// See SessionLru.
+    SessionLru sessionLru;
+
+    /**
+     * If nonzero, sessions are closed once the cache holds more than this
+     * many and they aren't in use (no one but the cache has a SessionRef
+     * for them), least recently used first. Clients of a large cluster use
+     * this to bound the per-session state (e.g., InfRc queue pairs) they
+     * and the servers keep. 0 means sessions stay open until flushed.
+     */
+    uint32_t maxCachedSessions;
 
     /**
      * The following variables record the parameters for all previous calls
@@ -155,6 +196,10 @@ class TransportManager {
     std::vector<void*> registeredBases;
     std::vector<size_t> registeredSizes;
 
+    /// Most recent argument to #setRequestPlacer; passed on to any new
+    /// transports too.
+    Transport::RequestPlacer* requestPlacer;
+
     /**
      * Used for mutual exclusion in multi-threaded environments.
      */
@@ -126,6 +126,43 @@ TEST_F(TransportManagerTest, getSession_reuseCachedSession) {
     EXPECT_TRUE(session.get() == session2.get());
 }
 
+TEST_F(TransportManagerTest, getSession_evictIdleSessions) {
+    TestLog::Enable _("evictIdleSessions");
+    MockTransport transport(&context);
+    manager.registerMock(&transport);
+    manager.setMaxCachedSessions(2);
+    Transport::SessionRef inUse(manager.getSession("mock:a"));
+    manager.getSession("mock:b");
+    manager.getSession("mock:c");
+    EXPECT_EQ(2U, manager.sessionCache.size());
+    EXPECT_EQ("evictIdleSessions: closing idle session for mock:b",
+            TestLog::get());
+
+    // A hit makes a session most recently used.
+    TestLog::reset();
+    manager.getSession("mock:c");
+    inUse = NULL;
+    manager.getSession("mock:a");
+    manager.getSession("mock:c");
+    manager.getSession("mock:d");
+    EXPECT_EQ("evictIdleSessions: closing idle session for mock:a",
+            TestLog::get());
+    EXPECT_EQ(2U, manager.sessionLru.size());
+    EXPECT_EQ("mock:c", manager.sessionLru.front());
+    EXPECT_EQ(4U, transport.sessionCreateCount);
+
+    // Nothing is closed while all sessions are in use.
+    TestLog::reset();
+    Transport::SessionRef c(manager.getSession("mock:c"));
+    Transport::SessionRef d(manager.getSession("mock:d"));
+    Transport::SessionRef e(manager.getSession("mock:e"));
+    EXPECT_EQ(3U, manager.sessionCache.size());
+    EXPECT_EQ("", TestLog::get());
+
+    manager.flushSession("mock:c");
+    EXPECT_EQ(2U, manager.sessionLru.size());
+}
+
 TEST_F(TransportManagerTest, getSession_registerExistingMemory) {
     TestLog::Enable _;
     manager.registerMock(NULL, "mock");
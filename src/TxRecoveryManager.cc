@@ -275,7 +275,10 @@ void
 TxRecoveryManager::RecoveryTask::performTask()
 {
     if (state == State::REQUEST_ABORT) {
-        sendRequestAbortRpc();
+        while (nextParticipantEntry != participants.end()
+                && requestAbortRpcs.size() < MAX_OUTSTANDING_RPCS) {
+            sendRequestAbortRpc();
+        }
         try {
             processRequestAbortRpcResults();
         } catch (StaleRpcException& e) {
@@ -332,12 +335,15 @@ TxRecoveryManager::RecoveryTask::performTask()
         }
     }
     if (state == State::DECIDE) {
-        sendDecisionRpc();
+        while (nextParticipantEntry != participants.end()
+                && decisionRpcs.size() < MAX_OUTSTANDING_RPCS) {
+            sendDecisionRpc();
+        }
         processDecisionRpcResults();
         if (nextParticipantEntry == participants.end()
-            && requestAbortRpcs.empty())
+            && decisionRpcs.empty())
         {
-            // Done with the request abort phase.
+            // Done with the decision phase.
             // Change state to cause next phase to execute.
             state = State::DONE;
         }
@@ -379,6 +385,7 @@ void
 TxRecoveryManager::RecoveryTask::TxRecoveryRpcWrapper::send()
 {
     state = IN_PROGRESS;
+    RpcTrace::recordSend(&request);
     session->sendRequest(&request, response, this);
 }
 
@@ -531,10 +538,11 @@ TxRecoveryManager::RecoveryTask::processDecisionRpcResults()
 {
     // Process outstanding RPCs.
     std::list<DecisionRpc>::iterator it = decisionRpcs.begin();
-    for (; it != decisionRpcs.end(); it++) {
+    while (it != decisionRpcs.end()) {
         DecisionRpc* rpc = &(*it);
 
         if (!rpc->isReady()) {
+            it++;
             continue;
         }
 
@@ -560,8 +568,10 @@ TxRecoveryManager::RecoveryTask::processDecisionRpcResults()
 }
 
 /**
- * Send out a decision rpc if not all master have been notified.  Factored out
- * mostly for ease of testing.
+ * Send out a decision rpc if not all master have been notified.  The rpc
+ * carries as many of the remaining participants owned by the same master as
+ * fit, wherever they are in the participant list.  Factored out mostly for
+ * ease of testing.
  */
 void
 TxRecoveryManager::RecoveryTask::sendDecisionRpc()
@@ -569,8 +579,10 @@ TxRecoveryManager::RecoveryTask::sendDecisionRpc()
     // Issue an additional rpc.
     DecisionRpc* nextRpc = NULL;
     Transport::SessionRef rpcSession;
-    for (; nextParticipantEntry != participants.end(); nextParticipantEntry++) {
-        Participant* entry = &(*nextParticipantEntry);
+    ParticipantList::iterator firstSkipped = participants.end();
+    ParticipantList::iterator it = nextParticipantEntry;
+    for (; it != participants.end(); it++) {
+        Participant* entry = &(*it);
         Transport::SessionRef session;
 
         if (entry->state == Participant::DECIDE) {
@@ -581,7 +593,9 @@ TxRecoveryManager::RecoveryTask::sendDecisionRpc()
             session = context->objectFinder->lookup(entry->tableId,
                                                     entry->keyHash);
         } catch (TableDoesntExistException& e) {
-            entry->state = Participant::ABORT;
+            // There is no one to tell; treat it as told so that it isn't
+            // looked up again.
+            entry->state = Participant::DECIDE;
             LOG(WARNING, "Possible transaction consistency failure; Table %lu "
                     "could not be found while recovering transaction <%lu,%lu>",
                     entry->tableId, leaseId, transactionId);
@@ -594,11 +608,19 @@ TxRecoveryManager::RecoveryTask::sendDecisionRpc()
             nextRpc = &decisionRpcs.back();
         }
 
-        if (session->serviceLocator != rpcSession->serviceLocator
-            || !nextRpc->appendOp(nextParticipantEntry)) {
+        if (session->serviceLocator != rpcSession->serviceLocator) {
+            // Left for a later rpc to that participant's master.
+            if (firstSkipped == participants.end()) {
+                firstSkipped = it;
+            }
+            continue;
+        }
+        if (!nextRpc->appendOp(it)) {
             break;
         }
     }
+    nextParticipantEntry = (firstSkipped != participants.end()) ?
+            firstSkipped : it;
     if (nextRpc) {
         nextRpc->send();
     }
@@ -692,10 +714,11 @@ TxRecoveryManager::RecoveryTask::processRequestAbortRpcResults()
 {
     // Process outstanding RPCs.
     std::list<RequestAbortRpc>::iterator it = requestAbortRpcs.begin();
-    for (; it != requestAbortRpcs.end(); it++) {
+    while (it != requestAbortRpcs.end()) {
         RequestAbortRpc* rpc = &(*it);
 
         if (!rpc->isReady()) {
+            it++;
             continue;
         }
 
@@ -722,8 +745,9 @@ TxRecoveryManager::RecoveryTask::processRequestAbortRpcResults()
 }
 
 /**
- * Send out a request abort rpc if not all master have been asked.  Factored out
- * mostly for ease of testing.
+ * Send out a request abort rpc if not all master have been asked.  As in
+ * sendDecisionRpc(), the rpc carries as many of the remaining participants
+ * owned by the same master as fit.  Factored out mostly for ease of testing.
  */
 void
 TxRecoveryManager::RecoveryTask::sendRequestAbortRpc()
@@ -731,8 +755,10 @@ TxRecoveryManager::RecoveryTask::sendRequestAbortRpc()
     // Issue an additional rpc.
     RequestAbortRpc* nextRpc = NULL;
     Transport::SessionRef rpcSession;
-    for (; nextParticipantEntry != participants.end(); nextParticipantEntry++) {
-        Participant* entry = &(*nextParticipantEntry);
+    ParticipantList::iterator firstSkipped = participants.end();
+    ParticipantList::iterator it = nextParticipantEntry;
+    for (; it != participants.end(); it++) {
+        Participant* entry = &(*it);
         Transport::SessionRef session;
 
         if (entry->state == Participant::ABORT) {
@@ -756,11 +782,18 @@ TxRecoveryManager::RecoveryTask::sendRequestAbortRpc()
             nextRpc = &requestAbortRpcs.back();
         }
 
-        if (session->serviceLocator != rpcSession->serviceLocator
-            || !nextRpc->appendOp(nextParticipantEntry)) {
+        if (session->serviceLocator != rpcSession->serviceLocator) {
+            if (firstSkipped == participants.end()) {
+                firstSkipped = it;
+            }
+            continue;
+        }
+        if (!nextRpc->appendOp(it)) {
             break;
         }
     }
+    nextParticipantEntry = (firstSkipped != participants.end()) ?
+            firstSkipped : it;
 
     if (nextRpc) {
         nextRpc->send();
@@ -207,8 +207,13 @@ class TxRecoveryManager : public WorkerTimer {
         /// List of the participants of the transaction being recovered.
         ParticipantList participants;
         /// Iterator into the participant list used to keep track of how much
-        /// process has been made.
+        /// process has been made: every participant before it has been sent
+        /// an rpc in the current phase.
         ParticipantList::iterator nextParticipantEntry;
+        /// Maximum number of rpcs a task has outstanding at once; rpcs for
+        /// all of a transaction's masters are issued together, up to this
+        /// many, rather than one per call to performTask.
+        static const uint32_t MAX_OUTSTANDING_RPCS = 8;
         /// List of outstanding decision rpcs.
         std::list<DecisionRpc> decisionRpcs;
         /// List of outstanding request abort rpcs.
@@ -210,21 +210,12 @@ TEST_F(TxRecoveryManagerTest, handleTimerEvent_basic) {
 
     EXPECT_EQ(2U, txRecoveryManager.recoveries.size());
 
+    // Both recoveries run to completion in the same pass.
     txRecoveryManager.handleTimerEvent();
     EXPECT_TRUE(txRecoveryManager.isRunning());
     txRecoveryManager.stop();
     EXPECT_EQ(2U, txRecoveryManager.recoveries.size());
 
-    txRecoveryManager.handleTimerEvent();
-    EXPECT_TRUE(txRecoveryManager.isRunning());
-    txRecoveryManager.stop();
-    EXPECT_EQ(1U, txRecoveryManager.recoveries.size());
-
-    txRecoveryManager.handleTimerEvent();
-    EXPECT_TRUE(txRecoveryManager.isRunning());
-    txRecoveryManager.stop();
-    EXPECT_EQ(1U, txRecoveryManager.recoveries.size());
-
     txRecoveryManager.handleTimerEvent();
     EXPECT_FALSE(txRecoveryManager.isRunning());
     EXPECT_EQ(0U, txRecoveryManager.recoveries.size());
@@ -403,25 +394,29 @@ TEST_F(TxRecoveryManagerTest, RecoveryTask_performTask_basic) {
     fillPList();
 
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 1 Sent, RPC 1 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 2 Sent, RPC 2 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 3 Sent, RPC 3 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 4 Sent, RPC 4 Processed
-                                // RPC 1 Sent, RPC 1 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
-    task->performTask();        // RPC 2 Sent, RPC 2 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
-    task->performTask();        // RPC 3 Sent, RPC 3 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
-    task->performTask();        // RPC 4 Sent, RPC 4 Processed
+    task->performTask();        // RPCs 1-4 Sent, RPCs 1-4 Processed
+                                // RPCs 1-4 Sent, RPCs 1-4 Processed
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::DONE, task->state);
     task->performTask();
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::DONE, task->state);
 }
 
+TEST_F(TxRecoveryManagerTest, RecoveryTask_performTask_maxOutstandingRpcs) {
+    for (uint64_t i = 1; i <= 30; i++) {
+        task->participants.emplace_back(tableId1, i, i);
+    }
+    task->nextParticipantEntry = task->participants.begin();
+
+    // Stop the rpcs from completing, so they stay outstanding.
+    Transport::SessionRef session =
+            context.transportManager->getSession("mock:host=master1");
+    static_cast<BindTransport::BindSession*>(session.get())->dontNotify = true;
+    task->performTask();
+    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
+    EXPECT_EQ(8U, task->requestAbortRpcs.size());
+    EXPECT_EQ(25U, task->nextParticipantEntry->rpcId);
+}
+
 TEST_F(TxRecoveryManagerTest, RecoveryTask_performTask_StaleRpcException) {
     // Fake the ack id forward
     ramcloud->rpcTracker->firstMissing = 100;
@@ -432,13 +427,9 @@ TEST_F(TxRecoveryManagerTest, RecoveryTask_performTask_StaleRpcException) {
 
     fillPList();
 
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 1 Sent, RPC 1 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 2 Sent, RPC 2 Processed
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
     TestLog::Enable _("performTask");
-    task->performTask();        // RPC 3 Sent, RPC 3 Rejected
+    task->performTask();        // RPCs 1-4 Sent, RPC 3 Rejected
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
     EXPECT_EQ(WireFormat::TxDecision::RECOVERED, task->decision);
     EXPECT_EQ("performTask: StaleRpcException caught", TestLog::get());
@@ -453,13 +444,9 @@ TEST_F(TxRecoveryManagerTest, RecoveryTask_performTask_ExpiredLeaseException) {
 
     fillPList();
 
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 1 Sent, RPC 1 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    task->performTask();        // RPC 2 Sent, RPC 2 Processed
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
     TestLog::Enable _("performTask");
-    task->performTask();        // RPC 3 Sent, RPC 3 Rejected
+    task->performTask();        // RPCs 1-4 Sent, RPC 3 Rejected
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
     EXPECT_EQ(WireFormat::TxDecision::RECOVERED, task->decision);
     EXPECT_EQ("performTask: ExpiredLeaseException caught", TestLog::get());
@@ -473,36 +460,16 @@ TEST_F(TxRecoveryManagerTest, RecoveryTask_performTask_TableDoesNotExist) {
 
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
 
-    task->performTask();        // RPC 1 Sent, RPC 1 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
-    EXPECT_EQ("", TestLog::get());
-    TestLog::reset();
-
-    task->performTask();        // RPC 2 Sent, RPC 2 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::REQUEST_ABORT, task->state);
+    task->performTask();        // RPCs 1-3 Sent, RPCs 1-3 Processed
+                                // RPCs 1-3 Sent, RPCs 1-3 Processed
+    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DONE, task->state);
     EXPECT_EQ("sendRequestAbortRpc: Possible transaction consistency failure; "
+              "Table 2 could not be found while recovering transaction <42,1>"
+              " | sendDecisionRpc: Possible transaction consistency failure; "
               "Table 2 could not be found while recovering transaction <42,1>",
               TestLog::get());
     TestLog::reset();
 
-    task->performTask();        // RPC 3 Sent, RPC 3 Processed
-                                // RPC 1 Sent, RPC 1 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
-    EXPECT_EQ("", TestLog::get());
-    TestLog::reset();
-
-    task->performTask();        // RPC 2 Sent, RPC 2 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DECIDE, task->state);
-    EXPECT_EQ("sendDecisionRpc: Possible transaction consistency failure; "
-              "Table 2 could not be found while recovering transaction <42,1>",
-              TestLog::get());
-    TestLog::reset();
-
-    task->performTask();        // RPC 3 Sent, RPC 3 Processed
-    EXPECT_EQ(TxRecoveryManager::RecoveryTask::DONE, task->state);
-    EXPECT_EQ("", TestLog::get());
-    TestLog::reset();
-
     task->performTask();
     EXPECT_EQ(TxRecoveryManager::RecoveryTask::DONE, task->state);
     EXPECT_EQ("", TestLog::get());
@@ -969,4 +936,39 @@ TEST_F(TxRecoveryManagerTest, sendRequestAbortRpc_basic) {
     EXPECT_EQ(4U, task->requestAbortRpcs.size());
 }
 
+TEST_F(TxRecoveryManagerTest, sendRequestAbortRpc_interleaved) {
+    task->participants.emplace_back(tableId1, 1, 2);
+    task->participants.emplace_back(tableId2, 1, 3);
+    task->participants.emplace_back(tableId1, 2, 4);
+    task->participants.emplace_back(tableId3, 1, 5);
+    task->participants.emplace_back(tableId2, 2, 6);
+
+    TxRecoveryManager::RecoveryTask::RequestAbortRpc* rpc;
+    task->nextParticipantEntry = task->participants.begin();
+
+    // Participants for the same master go in one rpc even if others come
+    // between them in the list.
+    task->sendRequestAbortRpc();
+    rpc = &task->requestAbortRpcs.back();
+    EXPECT_EQ("RequestAbortRpc :: lease{42} participantCount{2} "
+              "ParticipantList[ {1, 1, 2} {1, 2, 4} ]",
+              rpcToString(rpc));
+    EXPECT_EQ(3U, task->nextParticipantEntry->rpcId);
+
+    task->sendRequestAbortRpc();
+    rpc = &task->requestAbortRpcs.back();
+    EXPECT_EQ("RequestAbortRpc :: lease{42} participantCount{2} "
+              "ParticipantList[ {2, 1, 3} {2, 2, 6} ]",
+              rpcToString(rpc));
+    EXPECT_EQ(5U, task->nextParticipantEntry->rpcId);
+
+    task->sendRequestAbortRpc();
+    rpc = &task->requestAbortRpcs.back();
+    EXPECT_EQ("RequestAbortRpc :: lease{42} participantCount{1} "
+              "ParticipantList[ {3, 1, 5} ]",
+              rpcToString(rpc));
+    EXPECT_TRUE(task->nextParticipantEntry == task->participants.end());
+    EXPECT_EQ(3U, task->requestAbortRpcs.size());
+}
+
 }  // namespace RAMCloud
@@ -16,6 +16,7 @@
 #include <errno.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -52,7 +53,8 @@ Syscall* UdpDriver::sys = &defaultSyscall;
  *      identifying the desired socket.  If NULL then a port will be
  *      chosen by system software. Typically the socket is specified
  *      explicitly for server-side drivers but not for client-side
- *      drivers.
+ *      drivers. "gso=0" keeps the driver from using UDP generic
+ *      segmentation offload for batches of packets.
  */
 UdpDriver::UdpDriver(Context* context,
         const ServiceLocator* localServiceLocator)
@@ -66,6 +68,8 @@ UdpDriver::UdpDriver(Context* context,
     , bandwidthGbps(10)                   // Default bandwidth = 10 gbs
     , queueEstimator(0)
     , maxTransmitQueueSize(0)
+    , heldPackets()
+    , gsoEnabled(true)
     , readerThread()
     , readerThreadExit(false)
 {
@@ -74,6 +78,7 @@ UdpDriver::UdpDriver(Context* context,
         try {
             bandwidthGbps = localServiceLocator->getOption<int>("gbs");
         } catch (ServiceLocator::NoSuchKeyException& e) {}
+        gsoEnabled = localServiceLocator->getOption<int>("gso", 1) != 0;
     }
     queueEstimator.setBandwidth(1000*bandwidthGbps);
     maxTransmitQueueSize = (uint32_t) (static_cast<double>(bandwidthGbps)
@@ -94,6 +99,17 @@ UdpDriver::UdpDriver(Context* context,
     }
 
     if (localServiceLocator != NULL) {
+        // With reusePort, several drivers (one per DispatchShard) may listen
+        // on the same port; the kernel divides up the senders among them.
+        int reusePort = localServiceLocator->getOption<int>("reusePort", 0);
+        if (reusePort != 0 && sys->setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+                &reusePort, sizeof(reusePort)) != 0) {
+            int e = errno;
+            sys->close(fd);
+            throw DriverException(HERE,
+                    "UdpDriver couldn't set SO_REUSEPORT", e);
+        }
+
         IpAddress ipAddress(localServiceLocator);
         int r = sys->bind(fd, &ipAddress.address, sizeof(ipAddress.address));
         if (r == -1) {
@@ -159,6 +175,17 @@ UdpDriver::close()
     }
 }
 
+// See docs in Driver class.
+void
+UdpDriver::flushBatch()
+{
+    assert(heldPackets.depth > 0);
+    heldPackets.depth--;
+    if (heldPackets.depth == 0 && heldPackets.numPackets > 0) {
+        transmitHeldPackets();
+    }
+}
+
 // See docs in Driver class.
 uint32_t
 UdpDriver::getMaxPacketSize()
@@ -237,6 +264,38 @@ UdpDriver::sendPacket(const Address* addr,
     // one for header, the rest for payload
     uint32_t iovecs = 1 + (payload ? payload->getNumberChunks() : 0);
 
+    if (heldPackets.depth > 0 &&
+            headerLen <= TransmitBatch::MAX_HEADER_LENGTH &&
+            iovecs <= TransmitBatch::MAX_IOVECS) {
+        // Hold the packet until the batch is flushed; the caller keeps the
+        // payload data alive until then.
+        if (heldPackets.numPackets == TransmitBatch::MAX_PACKETS ||
+                heldPackets.numIovecs + iovecs > TransmitBatch::MAX_IOVECS) {
+            transmitHeldPackets();
+        }
+        TransmitBatch::Packet* packet =
+                &heldPackets.packets[heldPackets.numPackets];
+        packet->destination = static_cast<const IpAddress*>(addr)->address;
+        packet->length = totalLength;
+        packet->firstIovec = heldPackets.numIovecs;
+        packet->numIovecs = downCast<int>(iovecs);
+        memcpy(packet->header, header, headerLen);
+        struct iovec* iov = &heldPackets.iovecs[heldPackets.numIovecs];
+        iov->iov_base = packet->header;
+        iov->iov_len = headerLen;
+        iov++;
+        while (payload && !payload->isDone()) {
+            iov->iov_base = const_cast<void*>(payload->getData());
+            iov->iov_len = payload->getLength();
+            iov++;
+            payload->next();
+        }
+        heldPackets.numPackets++;
+        heldPackets.numIovecs += packet->numIovecs;
+        queueEstimator.packetQueued(totalLength, Cycles::rdtsc());
+        return;
+    }
+
     struct iovec iov[iovecs];
     iov[0].iov_base = const_cast<void*>(header);
     iov[0].iov_len = headerLen;
@@ -267,6 +326,102 @@ UdpDriver::sendPacket(const Address* addr,
     assert(static_cast<size_t>(r) == totalLength);
 }
 
+// See docs in Driver class.
+void
+UdpDriver::startBatch()
+{
+    heldPackets.depth++;
+}
+
+/**
+ * Hand all of the packets in heldPackets to the kernel, with as few
+ * messages (and system calls) as possible, and empty heldPackets.
+ */
+void
+UdpDriver::transmitHeldPackets()
+{
+    TransmitBatch* b = &heldPackets;
+    if (socketFd == -1) {
+        b->numPackets = b->numIovecs = 0;
+        return;
+    }
+
+    // Index in b->packets of the first packet of each message.
+    int firstPacket[TransmitBatch::MAX_PACKETS];
+    int numMessages = 0;
+
+    // Each iteration of this loop builds messages for the packets starting
+    // at nextPacket and sends them; it only repeats if the kernel rejected
+    // a GSO message.
+    int nextPacket = 0;
+    while (nextPacket < b->numPackets) {
+        numMessages = 0;
+        for (int i = nextPacket; i < b->numPackets; ) {
+            // With GSO, a message carries a run of packets of the same
+            // length (except that the last one may be shorter) that are
+            // going to the same place. MAX_PACKETS is small enough that a
+            // run never exceeds the kernel's limits on segments or bytes.
+            TransmitBatch::Packet* first = &b->packets[i];
+            int end = i + 1;
+            while (gsoEnabled && end < b->numPackets
+                    && b->packets[end - 1].length == first->length
+                    && b->packets[end].length <= first->length
+                    && memcmp(&b->packets[end].destination,
+                    &first->destination, sizeof(first->destination)) == 0) {
+                end++;
+            }
+            TransmitBatch::Packet* last = &b->packets[end - 1];
+
+            struct msghdr* msg = &b->messages[numMessages].msg_hdr;
+            memset(msg, 0, sizeof(*msg));
+            msg->msg_name = &first->destination;
+            msg->msg_namelen = sizeof(first->destination);
+            msg->msg_iov = &b->iovecs[first->firstIovec];
+            msg->msg_iovlen = last->firstIovec + last->numIovecs
+                    - first->firstIovec;
+#ifdef UDP_SEGMENT
+            if (end - i > 1) {
+                msg->msg_control = b->control[numMessages];
+                msg->msg_controllen = sizeof(b->control[numMessages]);
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segmentSize = downCast<uint16_t>(first->length);
+                memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+            }
+#endif
+            firstPacket[numMessages] = i;
+            numMessages++;
+            i = end;
+        }
+
+        int sent = 0;
+        nextPacket = b->numPackets;
+        while (sent < numMessages) {
+            int r = sys->sendmmsg(socketFd, &b->messages[sent],
+                    downCast<unsigned int>(numMessages - sent), 0);
+            if (r >= 0) {
+                sent += r;
+                continue;
+            }
+            if (b->messages[sent].msg_hdr.msg_controllen != 0 &&
+                    (errno == EINVAL || errno == EIO ||
+                    errno == ENOPROTOOPT)) {
+                LOG(NOTICE, "UdpDriver disabling GSO: %s", strerror(errno));
+                gsoEnabled = false;
+                nextPacket = firstPacket[sent];
+            } else {
+                LOG(WARNING, "UdpDriver error sending to socket: %s",
+                        strerror(errno));
+            }
+            break;
+        }
+    }
+    TEST_LOG("sent %d packets in %d messages", b->numPackets, numMessages);
+    b->numPackets = b->numIovecs = 0;
+}
+
 /**
  * Notify the reader thread that it should exit. Don't actually wait for the
  * thread to return here, though.
@@ -43,6 +43,7 @@ class UdpDriver : public Driver {
                        const ServiceLocator* localServiceLocator = NULL);
     virtual ~UdpDriver();
     void close();
+    virtual void flushBatch();
     virtual uint32_t getMaxPacketSize();
     virtual int getTransmitQueueSpace(uint64_t currentTime);
     virtual void receivePackets(uint32_t maxPackets,
@@ -54,6 +55,7 @@ class UdpDriver : public Driver {
                             Buffer::Iterator* payload,
                             int priority = 0);
     virtual string getServiceLocator();
+    virtual void startBatch();
 
     virtual Address* newAddress(const ServiceLocator* serviceLocator) {
         return new IpAddress(serviceLocator);
@@ -121,6 +123,73 @@ class UdpDriver : public Driver {
         }
     };
 
+    /**
+     * Holds the packets passed to sendPacket between startBatch and
+     * flushBatch, so that they can be handed to the kernel with a single
+     * sendmmsg call. Only used by the dispatch thread.
+     */
+    struct TransmitBatch {
+        /// Maximum number of packets that can be held; the batch is
+        /// transmitted early if it fills up.
+        static const int MAX_PACKETS = 32;
+
+        /// Maximum number of iovecs, across all of the held packets.
+        static const int MAX_IOVECS = 256;
+
+        /// Longest packet header that can be held; packets with longer
+        /// headers are transmitted right away.
+        static const uint32_t MAX_HEADER_LENGTH = 64;
+
+        /// One held packet.
+        struct Packet {
+            /// Where the packet is going.
+            sockaddr destination;
+
+            /// Total length of the packet, in bytes.
+            uint32_t length;
+
+            /// Index in iovecs of the packet's first iovec (its header),
+            /// and number of iovecs it uses; a packet's iovecs follow
+            /// those of the packet before it.
+            int firstIovec;
+            int numIovecs;
+
+            /// Copy of the packet header.
+            char header[MAX_HEADER_LENGTH];
+        };
+
+        TransmitBatch()
+            : depth(0)
+            , numPackets(0)
+            , numIovecs(0)
+            , packets()
+            , iovecs()
+            , messages()
+            , control()
+        {}
+
+        /// Number of calls to startBatch without a matching flushBatch.
+        int depth;
+
+        /// Number of valid entries in packets.
+        int numPackets;
+
+        /// Number of valid entries in iovecs.
+        int numIovecs;
+
+        Packet packets[MAX_PACKETS];
+        struct iovec iovecs[MAX_IOVECS];
+
+        /// Arguments for sendmmsg; with GSO, one message may carry several
+        /// packets.
+        struct mmsghdr messages[MAX_PACKETS];
+
+        /// Ancillary data (the GSO segment size) for each message.
+        char control[MAX_PACKETS][CMSG_SPACE(sizeof(uint16_t))];
+    };
+
+    void transmitHeldPackets();
+
     /// Shared RAMCloud information.
     Context* context;
 
@@ -164,6 +233,14 @@ class UdpDriver : public Driver {
     /// at any given time.
     uint32_t maxTransmitQueueSize;
 
+    /// Packets held between startBatch and flushBatch.
+    TransmitBatch heldPackets;
+
+    /// True means a run of equal-sized packets in a batch that are going
+    /// to the same destination is sent as a single UDP GSO message, which
+    /// the kernel splits into packets. Cleared if the kernel rejects GSO.
+    bool gsoEnabled;
+
     /// The following thread runs in the background to wait for kernel calls
     /// that receive packets.
     Tub<std::thread> readerThread;
@@ -13,6 +13,8 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <netinet/udp.h>
+
 #include "TestUtil.h"
 #include "MockSyscall.h"
 #include "Tub.h"
@@ -85,6 +87,23 @@ class UdpDriverTest : public ::testing::Test {
         return result;
     }
 
+    // Receives packets until count of them have arrived (or a long time
+    // goes by without any); returns their contents, separated by commas.
+    string receiveAll(UdpDriver* driver, int count) {
+        string result;
+        for (int i = 0; i < count; ) {
+            string packets = receivePackets(driver);
+            if (packets == "no packet arrived") {
+                return result + (result.empty() ? "" : ", ") + packets;
+            }
+            result.append(result.empty() ? "" : ", ");
+            result.append(packets);
+            i += 1 + downCast<int>(std::count(packets.begin(), packets.end(),
+                    ','));
+        }
+        return result;
+    }
+
     void sendMessage(UdpDriver *driver, IpAddress *address,
             const char *header, const char *payload) {
         Buffer message;
@@ -295,6 +314,81 @@ TEST_F(UdpDriverTest, sendPacket_errorInSend) {
             "Operation not permitted", TestLog::get());
 }
 
+TEST_F(UdpDriverTest, sendPacket_batch) {
+    client.gsoEnabled = false;
+    client.startBatch();
+    client.sendPacket(&serverAddress, "p1", 2, NULL);
+    sendMessage(&client, &serverAddress, "p2:", "payload");
+    client.sendPacket(&serverAddress, "p3", 2, NULL);
+    EXPECT_EQ(3, client.heldPackets.numPackets);
+    EXPECT_EQ(4, client.heldPackets.numIovecs);
+    EXPECT_EQ("", TestLog::get());
+    client.flushBatch();
+    EXPECT_EQ("transmitHeldPackets: sent 3 packets in 3 messages",
+            TestLog::get());
+    EXPECT_EQ("p1, p2:payload, p3", receiveAll(&server, 3));
+}
+
+TEST_F(UdpDriverTest, sendPacket_batchNested) {
+    client.startBatch();
+    client.startBatch();
+    client.sendPacket(&serverAddress, "p1", 2, NULL);
+    client.flushBatch();
+    EXPECT_EQ(1, client.heldPackets.numPackets);
+    client.flushBatch();
+    EXPECT_EQ(0, client.heldPackets.numPackets);
+    EXPECT_EQ("p1", receiveAll(&server, 1));
+}
+
+TEST_F(UdpDriverTest, sendPacket_batchFull) {
+    client.gsoEnabled = false;
+    client.startBatch();
+    for (int i = 0; i <= UdpDriver::TransmitBatch::MAX_PACKETS; i++) {
+        client.sendPacket(&serverAddress, "p", 1, NULL);
+    }
+    EXPECT_EQ("transmitHeldPackets: sent 32 packets in 32 messages",
+            TestLog::get());
+    EXPECT_EQ(1, client.heldPackets.numPackets);
+    client.flushBatch();
+}
+
+TEST_F(UdpDriverTest, sendPacket_headerTooLongForBatch) {
+    char header[UdpDriver::TransmitBatch::MAX_HEADER_LENGTH + 1];
+    memset(header, 'x', sizeof(header));
+    client.startBatch();
+    client.sendPacket(&serverAddress, header, sizeof32(header), NULL);
+    EXPECT_EQ(0, client.heldPackets.numPackets);
+    client.flushBatch();
+    EXPECT_EQ(string(header, sizeof(header)), receiveAll(&server, 1));
+}
+
+#ifdef UDP_SEGMENT
+TEST_F(UdpDriverTest, transmitHeldPackets_gso) {
+    client.startBatch();
+    client.sendPacket(&serverAddress, "aaa", 3, NULL);
+    client.sendPacket(&serverAddress, "bbb", 3, NULL);
+    client.sendPacket(&serverAddress, "cc", 2, NULL);
+    client.sendPacket(&serverAddress, "ddd", 3, NULL);
+    client.flushBatch();
+    EXPECT_EQ("transmitHeldPackets: sent 4 packets in 2 messages",
+            TestLog::get());
+    EXPECT_EQ("aaa, bbb, cc, ddd", receiveAll(&server, 4));
+}
+#endif
+
+TEST_F(UdpDriverTest, transmitHeldPackets_error) {
+    client.gsoEnabled = false;
+    sys->sendmmsgErrno = EPERM;
+    client.startBatch();
+    client.sendPacket(&serverAddress, "p1", 2, NULL);
+    client.flushBatch();
+    EXPECT_EQ("transmitHeldPackets: UdpDriver error sending to socket: "
+            "Operation not permitted | "
+            "transmitHeldPackets: sent 1 packets in 1 messages",
+            TestLog::get());
+    EXPECT_EQ(0, client.heldPackets.numPackets);
+}
+
 TEST_F(UdpDriverTest, stopReaderThread_basics) {
     client.stopReaderThread();
     TestUtil::waitForLog();
@@ -162,8 +162,7 @@ UnackedRpcResults::UnackedRpcResults(Context* context,
                                      AbstractLog::ReferenceFreer* freer,
                                      ClientLeaseValidator* leaseValidator,
                                      TabletManager* tabletManager)
-    : clients(20)
-    , mutex()
+    : shards()
     , default_rpclist_size(50)
     , context(context)
     , leaseValidator(leaseValidator)
@@ -178,9 +177,13 @@ UnackedRpcResults::UnackedRpcResults(Context* context,
  */
 UnackedRpcResults::~UnackedRpcResults()
 {
-    for (ClientMap::iterator it = clients.begin(); it != clients.end(); ++it) {
-        Client* client = it->second;
-        delete client;
+    for (uint32_t i = 0; i < NUM_SHARDS; i++) {
+        ClientMap& clients = shards[i].clients;
+        for (ClientMap::iterator it = clients.begin(); it != clients.end();
+                ++it) {
+            Client* client = it->second;
+            delete client;
+        }
     }
 }
 
@@ -239,12 +242,11 @@ UnackedRpcResults::checkDuplicate(WireFormat::ClientLease clientLease,
                                   uint64_t ackId,
                                   void** resultPtrOut)
 {
-    Lock lock(mutex);
+    uint64_t clientId = clientLease.leaseId;
+    Lock lock(getShard(clientId).mutex);
     *resultPtrOut = NULL;
     bool isDuplicate = false;
 
-    uint64_t clientId = clientLease.leaseId;
-
     Client* client = getOrInitClientRecord(clientId, lock);
 
     // Update lease with more up-to-date information if available to avoid
@@ -321,7 +323,7 @@ UnackedRpcResults::shouldRecover(uint64_t clientId,
                                  uint64_t ackId,
                                  LogEntryType entryType)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getOrInitClientRecord(clientId, lock);
     if (client->maxAckId < ackId)
         client->processAck(ackId, freer);
@@ -358,7 +360,7 @@ UnackedRpcResults::recordCompletion(uint64_t clientId,
                                       void* result,
                                       bool ignoreIfAcked)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
     if (ignoreIfAcked && client == NULL) {
         return;
@@ -381,7 +383,7 @@ UnackedRpcResults::recordCompletion(uint64_t clientId,
 
 /**
  * Recover a record of an RPC from RpcResult log entry.
- * It may insert a new clientId to #clients. (Protected with concurrent GC.)
+ * It may insert a new clientId to its shard. (Protected with concurrent GC.)
  * The leaseExpiration is not provided and fetched from coordinator lazily while
  * servicing an RPC from same client or during GC of cleanByTimeout().
  *
@@ -400,7 +402,7 @@ UnackedRpcResults::recoverRecord(uint64_t clientId,
                                  uint64_t ackId,
                                  void* result)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getOrInitClientRecord(clientId, lock);
 
     //1. Handle Ack.
@@ -432,7 +434,7 @@ UnackedRpcResults::recoverRecord(uint64_t clientId,
 void
 UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
 
     if (client == NULL) {
@@ -463,7 +465,7 @@ UnackedRpcResults::resetRecord(uint64_t clientId, uint64_t rpcId)
 bool
 UnackedRpcResults::isRpcAcked(uint64_t clientId, uint64_t rpcId)
 {
-    Lock lock(mutex);
+    Lock lock(getShard(clientId).mutex);
     Client* client = getClientRecord(clientId, lock);
     if (client == NULL) {
         return true;
@@ -486,7 +488,7 @@ UnackedRpcResults::SingleClientProtector::SingleClientProtector(
     : unackedRpcResults(unackedRpcResults)
     , clientId(clientId)
 {
-    Lock lock(unackedRpcResults->mutex);
+    Lock lock(unackedRpcResults->getShard(clientId).mutex);
     // Make a new client record if it doesn't exist.
     Client* client = unackedRpcResults->getOrInitClientRecord(clientId, lock);
     ++client->doNotRemove;
@@ -498,7 +500,7 @@ UnackedRpcResults::SingleClientProtector::SingleClientProtector(
  */
 UnackedRpcResults::SingleClientProtector::~SingleClientProtector()
 {
-    Lock lock(unackedRpcResults->mutex);
+    Lock lock(unackedRpcResults->getShard(clientId).mutex);
     Client* client = unackedRpcResults->getClientRecord(clientId, lock);
     assert(client != NULL);
     --client->doNotRemove;
@@ -508,26 +510,57 @@ UnackedRpcResults::SingleClientProtector::~SingleClientProtector()
  * Clean up stale clients who haven't communicated long.
  * Should not concurrently run this function in several threads.
  * Serialized by Cleaner inherited from WorkerTimer.
+ *
+ * Each call checks at most Cleaner::maxIterPerPeriod clients, picking up
+ * where the previous call left off and moving through the shards in turn;
+ * only the lock of the shard being checked is held.
  */
 void
 UnackedRpcResults::cleanByTimeout()
+{
+    int budget = Cleaner::maxIterPerPeriod;
+    for (uint32_t i = 0; i < NUM_SHARDS && budget > 0; i++) {
+        if (!cleanShard(shards[cleaner.nextShardToCheck], &budget))
+            return;
+        if (cleaner.nextClientToCheck != 0) {
+            // Ran out of budget partway through the shard.
+            return;
+        }
+        cleaner.nextShardToCheck =
+                (cleaner.nextShardToCheck + 1) % NUM_SHARDS;
+    }
+}
+
+/**
+ * Helper for cleanByTimeout: check the clients of one shard, starting at
+ * Cleaner::nextClientToCheck, and erase those whose leases have expired.
+ *
+ * \param shard
+ *      Shard to clean; it must be the one Cleaner::nextShardToCheck refers
+ *      to.
+ * \param[in,out] budget
+ *      Maximum number of clients to check; decremented for each client
+ *      checked. Cleaner::nextClientToCheck is left at the first unchecked
+ *      client, or 0 if the end of the shard was reached.
+ * \return
+ *      False if cleaning must stop for now because a tablet is NOT_READY;
+ *      true otherwise.
+ */
+bool
+UnackedRpcResults::cleanShard(Shard& shard, int* budget)
 {
     vector<ClientLease> victims;
     {
-        Lock lock(mutex);
+        Lock lock(shard.mutex);
 
         // Sweep table and pick candidates.
-        victims.reserve(Cleaner::maxIterPerPeriod / 10);
-
         ClientMap::iterator it;
         if (cleaner.nextClientToCheck) {
-            it = clients.find(cleaner.nextClientToCheck);
+            it = shard.clients.find(cleaner.nextClientToCheck);
         } else {
-            it = clients.begin();
+            it = shard.clients.begin();
         }
-        for (int i = 0; i < Cleaner::maxIterPerPeriod && it != clients.end();
-                        //&& victims.size() < Cleaner::maxCheckPerPeriod;
-             ++i, ++it) {
+        for (; *budget > 0 && it != shard.clients.end(); --*budget, ++it) {
             Client* client = it->second;
 
             ClientLease lease = {it->first,
@@ -537,7 +570,7 @@ UnackedRpcResults::cleanByTimeout()
                 victims.push_back(lease);
             }
         }
-        if (it == clients.end()) {
+        if (it == shard.clients.end()) {
             cleaner.nextClientToCheck = 0;
         } else {
             cleaner.nextClientToCheck = it->first;
@@ -547,18 +580,21 @@ UnackedRpcResults::cleanByTimeout()
     // Check with coordinator whether the lease is expired.
     // And erase entry if the lease is expired.
     for (uint32_t i = 0; i < victims.size(); ++i) {
-        Lock lock(mutex);
+        Lock lock(shard.mutex);
+        ClientMap::iterator it = shard.clients.find(victims[i].leaseId);
+        if (it == shard.clients.end())
+            continue;
+        Client* client = it->second;
         // Do not clean if this client record is protected
-        if (clients[victims[i].leaseId]->doNotRemove)
+        if (client->doNotRemove)
             continue;
         // Do not clean if there are RPCs still in progress for this client.
-        if (clients[victims[i].leaseId]->numRpcsInProgress)
+        if (client->numRpcsInProgress)
             continue;
 
         ClientLease lease = victims[i];
         if (leaseValidator->validate(lease, &lease)) {
-            clients[victims[i].leaseId]->leaseExpiration =
-                                            ClusterTime(lease.leaseExpiration);
+            client->leaseExpiration = ClusterTime(lease.leaseExpiration);
         } else {
             TabletManager::Protector tp(tabletManager);
             if (tp.notReadyTabletExists()) {
@@ -568,16 +604,18 @@ UnackedRpcResults::cleanByTimeout()
                 // recovered to make a correct GC decision, but with a tablet
                 // currently NOT_READY, it is possible to have only RpcResult
                 // recovered, not Transaction ParticipantList entry yet.
-                return;
+                return false;
             }
             // After preventing the start of tablet migration or recovery,
             // check SingleClientProtector once more before deletion.
-            if (clients[victims[i].leaseId]->doNotRemove)
+            if (client->doNotRemove)
                 continue;
 
-            clients.erase(victims[i].leaseId);
+            shard.clients.erase(it);
+            delete client;
         }
     }
+    return true;
 }
 
 /**
@@ -587,6 +625,7 @@ UnackedRpcResults::cleanByTimeout()
 bool
 UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
     Client* client;
+    ClientMap& clients = getShard(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it == clients.end()) {
         return false;
@@ -601,6 +640,21 @@ UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
     return client->hasRecord(rpcId);
 }
 
+/**
+ * Returns the number of clients with a record, summed over all shards.
+ * This method is used only for unit testing.
+ */
+size_t
+UnackedRpcResults::getNumClients()
+{
+    size_t numClients = 0;
+    for (uint32_t i = 0; i < NUM_SHARDS; i++) {
+        Lock lock(shards[i].mutex);
+        numClients += shards[i].clients.size();
+    }
+    return numClients;
+}
+
 /**
  * Constructor for the UnackedRpcResults' Cleaner.
  *
@@ -610,6 +664,7 @@ UnackedRpcResults::hasRecord(uint64_t clientId, uint64_t rpcId) {
 UnackedRpcResults::Cleaner::Cleaner(UnackedRpcResults* unackedRpcResults)
     : WorkerTimer(unackedRpcResults->context->dispatch)
     , unackedRpcResults(unackedRpcResults)
+    , nextShardToCheck(0)
     , nextClientToCheck(0)
 {
 }
@@ -747,8 +802,8 @@ UnackedRpcResults::Client::resizeRpcs(int newLen) {
  * \param clientId
  *      The id of the client whose record should be returned.
  * \param lock
- *      Used to ensure that caller has acquired UnackedRpcResults::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the shard
+ *      that holds \a clientId. Not actually used by the method.
  * \return
  *      Pointer to the client record if one exists; NULL otherwise.
  */
@@ -756,6 +811,7 @@ UnackedRpcResults::Client*
 UnackedRpcResults::getClientRecord(uint64_t clientId, Lock& lock)
 {
     Client* client = NULL;
+    ClientMap& clients = getShard(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it != clients.end()) {
         client = it->second;
@@ -770,8 +826,8 @@ UnackedRpcResults::getClientRecord(uint64_t clientId, Lock& lock)
  * \param clientId
  *      The id of the client whose record should be returned.
  * \param lock
- *      Used to ensure that caller has acquired UnackedRpcResults::mutex.
- *      Not actually used by the method.
+ *      Used to ensure that caller has acquired the mutex of the shard
+ *      that holds \a clientId. Not actually used by the method.
  * \return
  *      Pointer to the existing or newly inserted client record.
  */
@@ -779,6 +835,7 @@ UnackedRpcResults::Client*
 UnackedRpcResults::getOrInitClientRecord(uint64_t clientId, Lock& lock)
 {
     Client* client = NULL;
+    ClientMap& clients = getShard(clientId).clients;
     ClientMap::iterator it = clients.find(clientId);
     if (it != clients.end()) {
         client = it->second;
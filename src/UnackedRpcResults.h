@@ -100,6 +100,8 @@ class UnackedRpcResults {
     void cleanByTimeout();
     /// Used only for testing.
     bool hasRecord(uint64_t clientId, uint64_t rpcId);
+    /// Used only for testing.
+    size_t getNumClients();
 
     /**
      * Holds info about outstanding RPCs, which is needed to avoid re-doing
@@ -135,10 +137,15 @@ class UnackedRpcResults {
         /// The pointer to unackedRpcResults which will be cleaned.
         UnackedRpcResults* unackedRpcResults;
 
-        /// Starting point of next round of cleaning.
+        /// Shard where the next round of cleaning starts.
+        uint32_t nextShardToCheck;
+
+        /// Starting point of next round of cleaning within
+        /// #nextShardToCheck; 0 means the beginning of the shard.
         uint64_t nextClientToCheck;
 
-        /// The maximum number of clients we check for liveness.
+        /// The maximum number of clients we check for liveness in one
+        /// round; a round may span several shards.
         static const int maxIterPerPeriod = 1000;
       private:
         DISALLOW_COPY_AND_ASSIGN(Cleaner);
@@ -246,14 +253,47 @@ class UnackedRpcResults {
      * Clients are dynamically allocated and must be freed explicitly.
      */
     typedef std::unordered_map<uint64_t, Client*> ClientMap;
-    ClientMap clients;
+    typedef std::lock_guard<std::mutex> Lock;
 
     /**
-     * Monitor-style lock. Any operation on internal data structure should
-     * hold this lock.
+     * The client records are spread over this many shards, each with its
+     * own lock, so that linearizable rpcs from different clients don't
+     * serialize on one mutex and the cleaner only holds up a fraction of
+     * the clients at a time.
      */
-    std::mutex mutex;
-    typedef std::lock_guard<std::mutex> Lock;
+    static const uint32_t NUM_SHARDS = 64;
+
+    /**
+     * The records of the clients whose ids map to one shard.
+     */
+    struct Shard {
+        Shard()
+            : clients()
+            , mutex()
+        {}
+
+        ClientMap clients;
+
+        /**
+         * Monitor-style lock. Any operation on #clients or on the records
+         * in it should hold this lock.
+         */
+        std::mutex mutex;
+
+        DISALLOW_COPY_AND_ASSIGN(Shard);
+    };
+    Shard shards[NUM_SHARDS];
+
+    /**
+     * Return the shard that holds the record of a given client. Lease ids
+     * are handed out sequentially, so consecutive clients go to different
+     * shards.
+     */
+    Shard&
+    getShard(uint64_t clientId)
+    {
+        return shards[clientId % NUM_SHARDS];
+    }
 
     /**
      * This value is used as initial array size of each Client instance.
@@ -286,6 +326,7 @@ class UnackedRpcResults {
     TabletManager* tabletManager;
 
     // Helper methods
+    bool cleanShard(Shard& shard, int* budget);
     Client* getClientRecord(uint64_t clientId, Lock& lock);
     Client* getOrInitClientRecord(uint64_t clientId, Lock& lock);
 
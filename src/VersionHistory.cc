@@ -0,0 +1,164 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "VersionHistory.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct an empty VersionHistory.
+ */
+VersionHistory::VersionHistory()
+    : versions()
+    , changes()
+    , numVersions(0)
+{
+}
+
+/**
+ * Called by the log cleaner for an object that isn't current any more and is
+ * about to be cleaned out of the log. If it is recorded here, snapshots that
+ * need it can't be served any more.
+ *
+ * \param keyHash
+ *      Hash of the object's key.
+ * \param reference
+ *      Log reference of the object.
+ * \return
+ *      True if the object was recorded here (and the caller mustn't expect
+ *      prune() to return it any more); false otherwise.
+ */
+bool
+VersionHistory::discard(KeyHash keyHash, uint64_t reference)
+{
+    auto it = versions.find(keyHash);
+    if (it == versions.end())
+        return false;
+    foreach (Version& version, it->second) {
+        if (version.reference == reference) {
+            version.reference = NOT_RETAINED;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Find out which version of an object a snapshot should see.
+ *
+ * \param keyHash
+ *      Hash of the object's key.
+ * \param snapshotTime
+ *      Encoded ClusterTime at which the snapshot was taken; it must not be
+ *      behind the low-water mark last passed to prune().
+ * \param[out] reference
+ *      If false isn't returned, the reference recorded for the version the
+ *      snapshot sees: a log reference, NO_OBJECT or NOT_RETAINED.
+ * \return
+ *      False if the snapshot sees the current version of the object (or
+ *      the lack of one); true if it sees an older one.
+ */
+bool
+VersionHistory::find(KeyHash keyHash, uint64_t snapshotTime,
+        uint64_t* reference) const
+{
+    auto it = versions.find(keyHash);
+    if (it == versions.end())
+        return false;
+    foreach (const Version& version, it->second) {
+        if (version.supersededAt > snapshotTime) {
+            *reference = version.reference;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Return the time at which the current version of an object replaced the
+ * previous one, or 0 if that was before any version still recorded here.
+ *
+ * \param keyHash
+ *      Hash of the object's key.
+ */
+uint64_t
+VersionHistory::getLastChange(KeyHash keyHash) const
+{
+    auto it = versions.find(keyHash);
+    if (it == versions.end())
+        return 0;
+    return it->second.back().supersededAt;
+}
+
+/**
+ * Forget the versions that no snapshot at or after a given time can see,
+ * which are those superseded by then.
+ *
+ * \param lowWater
+ *      Encoded ClusterTime before which snapshots are no longer served.
+ * \param[out] freed
+ *      The log references of the objects forgotten are appended here; the
+ *      caller must free them.
+ */
+void
+VersionHistory::prune(uint64_t lowWater, std::vector<uint64_t>* freed)
+{
+    while (!changes.empty() && changes.front().first <= lowWater) {
+        auto it = versions.find(changes.front().second);
+        changes.pop_front();
+        if (it == versions.end())
+            continue;
+        std::deque<Version>& keyVersions = it->second;
+        while (!keyVersions.empty() &&
+                keyVersions.front().supersededAt <= lowWater) {
+            uint64_t reference = keyVersions.front().reference;
+            if (reference != NO_OBJECT && reference != NOT_RETAINED)
+                freed->push_back(reference);
+            keyVersions.pop_front();
+            numVersions--;
+        }
+        if (keyVersions.empty())
+            versions.erase(it);
+    }
+}
+
+/**
+ * Record that the current version of an object has been superseded.
+ *
+ * \param keyHash
+ *      Hash of the object's key.
+ * \param reference
+ *      Log reference of the old version, which the caller must leave in the
+ *      log until prune() returns it; NO_OBJECT if the key didn't exist, or
+ *      NOT_RETAINED if the old version has been freed.
+ * \param supersededAt
+ *      Encoded ClusterTime at which the new version becomes visible. It
+ *      must not be less than the time recorded for the key's previous
+ *      change.
+ */
+void
+VersionHistory::record(KeyHash keyHash, uint64_t reference,
+        uint64_t supersededAt)
+{
+    std::deque<Version>& keyVersions = versions[keyHash];
+    assert(keyVersions.empty() ||
+            keyVersions.back().supersededAt <= supersededAt);
+    keyVersions.emplace_back(reference, supersededAt);
+    changes.emplace_back(supersededAt, keyHash);
+    numVersions++;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,106 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef RAMCLOUD_VERSIONHISTORY_H
+#define RAMCLOUD_VERSIONHISTORY_H
+
+#include <deque>
+#include <unordered_map>
+
+#include "Common.h"
+#include "Key.h"
+
+namespace RAMCloud {
+
+/**
+ * Remembers the versions of objects that have recently been overwritten or
+ * removed, so that a master can serve reads from a snapshot of the past
+ * (see ObjectManager::readSnapshotObject) and can tell whether a key was
+ * changed after a snapshot was taken (for snapshot-isolation transactions).
+ *
+ * Each time the current version of a key is superseded, the old version's
+ * log reference is recorded along with the cluster-time at which it stopped
+ * being current. The old object stays in the log until that time falls
+ * behind a low-water mark, before which no snapshot is served any more;
+ * prune() then hands it back to be freed. The cleaner doesn't move old
+ * versions (their tombstones only last as long as the segments they were
+ * written to, so a moved copy could come back to life in a recovery); if
+ * it cleans a segment holding one first, the version is discard()ed.
+ *
+ * A version superseded at time T was current for every snapshot taken
+ * before T; a snapshot taken at T or later sees the next version.
+ *
+ * This class isn't thread-safe: ObjectManager keeps one instance for each
+ * of its hash table bucket locks, and each must only be used with the
+ * corresponding lock held.
+ */
+class VersionHistory {
+  PUBLIC:
+    /// Special values of references recorded for superseded versions.
+    enum : uint64_t {
+        /// The key had no object before the version that superseded this.
+        NO_OBJECT = 0,
+
+        /// The old version wasn't kept (for example, because it had deltas
+        /// that the new version was appended to), so snapshots that need it
+        /// can't be served.
+        NOT_RETAINED = ~0LU,
+    };
+
+    VersionHistory();
+
+    bool find(KeyHash keyHash, uint64_t snapshotTime,
+            uint64_t* reference) const;
+    bool discard(KeyHash keyHash, uint64_t reference);
+    uint64_t getLastChange(KeyHash keyHash) const;
+    void prune(uint64_t lowWater, std::vector<uint64_t>* freed);
+    void record(KeyHash keyHash, uint64_t reference, uint64_t supersededAt);
+
+    /// Return the number of versions recorded.
+    size_t size() const { return numVersions; }
+
+  PRIVATE:
+    /// A superseded version of an object.
+    struct Version {
+        Version(uint64_t reference, uint64_t supersededAt)
+            : reference(reference)
+            , supersededAt(supersededAt)
+        {}
+
+        /// Log reference of the old object, NO_OBJECT or NOT_RETAINED.
+        uint64_t reference;
+
+        /// Encoded ClusterTime at which the next version replaced this one.
+        uint64_t supersededAt;
+    };
+
+    /// The superseded versions of each key, oldest first.
+    std::unordered_map<KeyHash, std::deque<Version>> versions;
+
+    /// The keys in #versions in the order their versions were recorded,
+    /// along with the time each was recorded for. prune() works through
+    /// this, so that it needn't look at keys with no old versions to drop.
+    std::deque<std::pair<uint64_t, KeyHash>> changes;
+
+    /// Total number of Versions in #versions.
+    size_t numVersions;
+
+    DISALLOW_COPY_AND_ASSIGN(VersionHistory);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_VERSIONHISTORY_H
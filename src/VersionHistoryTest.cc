@@ -0,0 +1,97 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "TestUtil.h"
+
+#include "VersionHistory.h"
+
+namespace RAMCloud {
+
+class VersionHistoryTest : public ::testing::Test {
+  public:
+    VersionHistory history;
+
+    VersionHistoryTest()
+        : history()
+    {
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(VersionHistoryTest);
+};
+
+TEST_F(VersionHistoryTest, discard) {
+    history.record(1, 100, 10);
+    EXPECT_FALSE(history.discard(2, 100));
+    EXPECT_FALSE(history.discard(1, 200));
+    EXPECT_TRUE(history.discard(1, 100));
+
+    uint64_t reference = 0;
+    EXPECT_TRUE(history.find(1, 5, &reference));
+    EXPECT_EQ(VersionHistory::NOT_RETAINED, reference);
+
+    std::vector<uint64_t> freed;
+    history.prune(10, &freed);
+    EXPECT_EQ(0U, freed.size());
+}
+
+TEST_F(VersionHistoryTest, find) {
+    uint64_t reference = 0;
+    EXPECT_FALSE(history.find(1, 5, &reference));
+
+    history.record(1, VersionHistory::NO_OBJECT, 10);
+    history.record(1, 100, 20);
+    EXPECT_TRUE(history.find(1, 5, &reference));
+    EXPECT_EQ(VersionHistory::NO_OBJECT, reference);
+    EXPECT_TRUE(history.find(1, 10, &reference));
+    EXPECT_EQ(100U, reference);
+    EXPECT_FALSE(history.find(1, 20, &reference));
+    EXPECT_FALSE(history.find(2, 5, &reference));
+}
+
+TEST_F(VersionHistoryTest, getLastChange) {
+    EXPECT_EQ(0U, history.getLastChange(1));
+    history.record(1, 100, 10);
+    history.record(1, 200, 20);
+    EXPECT_EQ(20U, history.getLastChange(1));
+    EXPECT_EQ(0U, history.getLastChange(2));
+}
+
+TEST_F(VersionHistoryTest, prune) {
+    history.record(1, VersionHistory::NO_OBJECT, 10);
+    history.record(2, 200, 15);
+    history.record(1, 100, 20);
+    history.record(2, VersionHistory::NOT_RETAINED, 25);
+    EXPECT_EQ(4U, history.size());
+
+    std::vector<uint64_t> freed;
+    history.prune(9, &freed);
+    EXPECT_EQ(0U, freed.size());
+    EXPECT_EQ(4U, history.size());
+
+    history.prune(20, &freed);
+    ASSERT_EQ(2U, freed.size());
+    EXPECT_EQ(100U, freed[0]);
+    EXPECT_EQ(200U, freed[1]);
+    EXPECT_EQ(1U, history.size());
+    EXPECT_EQ(0U, history.getLastChange(1));
+
+    freed.clear();
+    history.prune(30, &freed);
+    EXPECT_EQ(0U, freed.size());
+    EXPECT_EQ(0U, history.size());
+}
+
+}  // namespace RAMCloud
@@ -122,6 +122,26 @@ opcodeSymbol(uint32_t opcode)
         case TX_REQUEST_ABORT:             return "TX_REQUEST_ABORT";
         case TX_HINT_FAILED:               return "TX_HINT_FAILED";
         case ECHO:                         return "ECHO";
+        case BACKUP_WRITE_BATCH:           return "BACKUP_WRITE_BATCH";
+        case LOOKUP_INDEX_KEYS_AND_READ:   return "LOOKUP_INDEX_KEYS_AND_READ";
+        case INDEX_ENTRY_BATCH:            return "INDEX_ENTRY_BATCH";
+        case READ_RANGE:                   return "READ_RANGE";
+        case PATCH:                        return "PATCH";
+        case APPEND:                       return "APPEND";
+        case UPDATE_HOT_REPLICA:           return "UPDATE_HOT_REPLICA";
+        case BULK_LOAD:                    return "BULK_LOAD";
+        case BACKUP_WRITE_FROM_REPLICAS:   return "BACKUP_WRITE_FROM_REPLICAS";
+        case READ_LOG_CHANGES:             return "READ_LOG_CHANGES";
+        case SCAN:                         return "SCAN";
+        case BACKUP_WRITE_CHAIN:           return "BACKUP_WRITE_CHAIN";
+        case BACKUP_GET_WRITE_TARGET:      return "BACKUP_GET_WRITE_TARGET";
+        case BACKUP_FIND_RECOVERY_KEY:     return "BACKUP_FIND_RECOVERY_KEY";
+        case GET_CACHED_TABLE_CONFIG:      return "GET_CACHED_TABLE_CONFIG";
+        case RENEW_LEASES:                 return "RENEW_LEASES";
+        case GET_DURABLE_POSITION:         return "GET_DURABLE_POSITION";
+        case READ_TABLE_SNAPSHOT:          return "READ_TABLE_SNAPSHOT";
+        case BACKUP_WRITE_FRAGMENT:        return "BACKUP_WRITE_FRAGMENT";
+        case BACKUP_GET_FRAGMENT:          return "BACKUP_GET_FRAGMENT";
         case ILLEGAL_RPC_TYPE:             return "ILLEGAL_RPC_TYPE";
     }
 
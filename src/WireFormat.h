@@ -130,7 +130,27 @@ enum Opcode {
     TX_REQUEST_ABORT            = 78,
     TX_HINT_FAILED              = 79,
     ECHO                        = 80,
-    ILLEGAL_RPC_TYPE            = 81, // 1 + the highest legitimate Opcode
+    BACKUP_WRITE_BATCH          = 81,
+    LOOKUP_INDEX_KEYS_AND_READ  = 82,
+    INDEX_ENTRY_BATCH           = 83,
+    READ_RANGE                  = 84,
+    PATCH                       = 85,
+    APPEND                      = 86,
+    UPDATE_HOT_REPLICA          = 87,
+    BULK_LOAD                   = 88,
+    BACKUP_WRITE_FROM_REPLICAS  = 89,
+    READ_LOG_CHANGES            = 90,
+    SCAN                        = 91,
+    BACKUP_WRITE_CHAIN          = 92,
+    BACKUP_GET_WRITE_TARGET     = 93,
+    BACKUP_FIND_RECOVERY_KEY    = 94,
+    GET_CACHED_TABLE_CONFIG     = 95,
+    RENEW_LEASES                = 96,
+    GET_DURABLE_POSITION        = 97,
+    READ_TABLE_SNAPSHOT         = 98,
+    BACKUP_WRITE_FRAGMENT       = 99,
+    BACKUP_GET_FRAGMENT         = 100,
+    ILLEGAL_RPC_TYPE            = 101, // 1 + the highest legitimate Opcode
 };
 
 /**
@@ -152,6 +172,14 @@ enum ControlOp {
     LOG_MESSAGE                 = 1010,
     RESET_METRICS               = 1011,
     QUIESCE                     = 1012,
+    GET_RPC_LATENCIES           = 1013,
+    GET_TABLE_USAGE             = 1014,
+    GET_LOG_HEALTH              = 1015,
+    START_DISPATCH_ACTIVITY     = 1016,
+    STOP_DISPATCH_ACTIVITY      = 1017,
+    GET_DISPATCH_ACTIVITY       = 1018,
+    GET_RPC_CACHE_STATS         = 1019,
+    GET_HOT_KEYS                = 1020,
 };
 
 /**
@@ -172,6 +200,10 @@ struct ClientLease {
 struct RequestCommon {
     uint16_t opcode;              /// Opcode of operation to be performed.
     uint16_t service;             /// ServiceType to invoke for this rpc.
+    uint32_t traceId;             /// Nonzero means this request belongs
+                                  /// to a sampled trace; see RpcTrace.
+    uint32_t spanId;              /// Identifies this rpc within the trace
+                                  /// given by traceId.
 } __attribute__((packed));
 
 /**
@@ -183,6 +215,10 @@ struct RequestCommon {
 struct RequestCommonWithId {
     uint16_t opcode;              /// Opcode of operation to be performed.
     uint16_t service;             /// ServiceType to invoke for this rpc.
+    uint32_t traceId;             /// Nonzero means this request belongs
+                                  /// to a sampled trace; see RpcTrace.
+    uint32_t spanId;              /// Identifies this rpc within the trace
+                                  /// given by traceId.
     uint64_t targetId;            /// ServerId for which this RPC is
                                   /// intended. 0 means "ignore this field":
                                   /// for convenience during testing.
@@ -238,6 +274,28 @@ struct RetryResponse {
 
 // The RPCs below are in alphabetical order
 
+struct Append {
+    static const Opcode opcode = APPEND;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        ClientLease lease;
+        uint64_t rpcId;
+        uint64_t ackId;
+        uint16_t keyLength;           // Length of the key in bytes.
+                                      // The actual key follows
+                                      // immediately after this header.
+        uint32_t length;              // Number of bytes to append; these
+                                      // follow immediately after the key.
+        RejectRules rejectRules;
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t version;
+    } __attribute__((packed));
+};
+
 struct BackupFree {
     static const Opcode opcode = BACKUP_FREE;
     static const ServiceType service = BACKUP_SERVICE;
@@ -251,6 +309,25 @@ struct BackupFree {
     } __attribute__((packed));
 };
 
+struct BackupFindRecoveryKey {
+    static const Opcode opcode = BACKUP_FIND_RECOVERY_KEY;
+    static const ServiceType service = BACKUP_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t recoveryId;    ///< Identifies the recovery being performed.
+        uint64_t masterId;      ///< Crashed master being recovered.
+        uint64_t partitionId;   ///< Partition of the recovery master asking.
+        uint64_t keyHash;       ///< Hash of the key to look for.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t segmentIdCount; ///< Number of uint64_t segment ids that
+                                 ///< follow: those of replicas whose
+                                 ///< recovery segments have no entries for
+                                 ///< the key.
+    } __attribute__((packed));
+};
+
 struct BackupGetRecoveryData {
     static const Opcode opcode = BACKUP_GETRECOVERYDATA;
     static const ServiceType service = BACKUP_SERVICE;
@@ -307,6 +384,10 @@ struct BackupStartReadingData {
                                    ///< The bytes of the partition map follow
                                    ///< immediately after this header. See
                                    ///< ProtoBuf::Tablets.
+        uint8_t coldStart;         ///< Nonzero if this recovery is part of
+                                   ///< a whole-cluster restart; the backup
+                                   ///< then loads the replicas of every
+                                   ///< crashed master in one pass.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -345,15 +426,26 @@ struct BackupStartReadingData {
                                    ///< closed on the backup. If it was it
                                    ///< is inherently consistent and can be
                                    ///< used without scrutiny during recovery.
-        Replica(uint64_t segmentId, uint64_t segmentEpoch, bool closed)
+        uint8_t fragmentIndex;     ///< Which erasure-coded fragment of the
+                                   ///< segment the backup holds; unused if
+                                   ///< #dataFragments is 0.
+        uint8_t dataFragments;     ///< Number of fragments needed to rebuild
+                                   ///< the segment, or 0 if the backup holds
+                                   ///< a full replica.
+        Replica(uint64_t segmentId, uint64_t segmentEpoch, bool closed,
+                uint8_t fragmentIndex = 0, uint8_t dataFragments = 0)
             : segmentId(segmentId)
             , segmentEpoch(segmentEpoch)
             , closed(closed)
+            , fragmentIndex(fragmentIndex)
+            , dataFragments(dataFragments)
         {}
         friend bool operator==(const Replica& left, const Replica& right) {
             return left.segmentId == right.segmentId &&
                    left.segmentEpoch == right.segmentEpoch &&
-                   left.closed == right.closed;
+                   left.closed == right.closed &&
+                   left.fragmentIndex == right.fragmentIndex &&
+                   left.dataFragments == right.dataFragments;
         }
     } __attribute__((packed));
 };
@@ -372,10 +464,25 @@ struct BackupStartPartitioningReplicas {
                                    ///< The bytes of the partition map follow
                                    ///< immediately after this header. See
                                    ///< ProtoBuf::Tablets.
+        uint32_t fragmentCount;    ///< Number of FragmentLocations following
+                                   ///< the partition map.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
     } __attribute__((packed));
+    /// Tells a backup holding an erasure-coded fragment of a segment where
+    /// the segment's other fragments are, so it can rebuild the segment.
+    struct FragmentLocation {
+        uint64_t segmentId;        ///< Segment the fragment belongs to.
+        uint64_t backupId;         ///< Server id of the backup holding it.
+        uint8_t fragmentIndex;     ///< Which fragment of the segment it is.
+        FragmentLocation(uint64_t segmentId, uint64_t backupId,
+                         uint8_t fragmentIndex)
+            : segmentId(segmentId)
+            , backupId(backupId)
+            , fragmentIndex(fragmentIndex)
+        {}
+    } __attribute__((packed));
 };
 
 struct BackupWrite {
@@ -394,6 +501,7 @@ struct BackupWrite {
             , primary()
             , certificateIncluded()
             , certificate()
+            , remotelyWritten()
         {}
         Request(const RequestCommonWithId& common,
                 uint64_t masterId,
@@ -405,7 +513,8 @@ struct BackupWrite {
                 bool close,
                 bool primary,
                 bool certificateIncluded,
-                const SegmentCertificate& certificate)
+                const SegmentCertificate& certificate,
+                bool remotelyWritten = false)
             : common(common)
             , masterId(masterId)
             , segmentId(segmentId)
@@ -417,6 +526,7 @@ struct BackupWrite {
             , primary(primary)
             , certificateIncluded(certificateIncluded)
             , certificate(certificate)
+            , remotelyWritten(remotelyWritten)
         {}
         RequestCommonWithId common;
         uint64_t masterId;        ///< Server from whom the request is coming.
@@ -440,8 +550,293 @@ struct BackupWrite {
                                         ///< written to storage
                                         ///< following the data included
                                         ///< in this rpc.
+        bool remotelyWritten;     ///< If true no data follows: the master
+                                  ///< has already placed it in the replica's
+                                  ///< buffer with a one-sided RDMA write
+                                  ///< (see BackupGetWriteTarget), and this
+                                  ///< rpc just tells the backup it's there.
         // Opaque byte string follows with data to write.
     } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t writeLoad;       ///< Percentage (0-100) of the backup's
+                                  ///< buffers for replica data that isn't
+                                  ///< yet on storage which are in use; see
+                                  ///< BackupStorage::getWriteLoad().
+    } __attribute__((packed));
+};
+
+/**
+ * Carries several BackupWrite operations from one master to one backup, so
+ * that writes to many replicas (for example, survivor segments closed
+ * together by the cleaner) cost a single rpc.
+ */
+struct BackupWriteBatch {
+    static const Opcode opcode = BACKUP_WRITE_BATCH;
+    static const ServiceType service = BACKUP_SERVICE;
+
+    /// Describes one write; see BackupWrite::Request for the fields.
+    struct Part {
+        uint64_t segmentId;
+        uint64_t segmentEpoch;
+        uint32_t offset;
+        uint32_t length;
+        bool open;
+        bool close;
+        bool primary;
+        bool certificateIncluded;
+        SegmentCertificate certificate;
+        // Opaque byte string of #length bytes follows with data to write.
+    } __attribute__((packed));
+
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t masterId;        ///< Server from whom the request is coming.
+        uint32_t count;           ///< Number of Parts that follow.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t writeLoad;       ///< See BackupWrite::Response.
+        uint32_t count;           ///< Number of Status values that follow,
+                                  ///< one for each Part, in order.
+    } __attribute__((packed));
+};
+
+/**
+ * A BackupWrite whose data is, at least in part, already on the backup: the
+ * bytes to write are assembled from Pieces that are either copied from other
+ * closed replicas of the same master on that backup or carried literally in
+ * the rpc. Lets the log cleaner replicate survivor segments without sending
+ * the live entries it relocated to backups that hold replicas of the
+ * segments they came from.
+ */
+struct BackupWriteFromReplicas {
+    static const Opcode opcode = BACKUP_WRITE_FROM_REPLICAS;
+    static const ServiceType service = BACKUP_SERVICE;
+
+    /// Describes one contiguous run of the bytes to write, in order.
+    struct Piece {
+        uint64_t sourceSegmentId; ///< Segment whose replica holds the bytes,
+                                  ///< or 0 if they follow in the rpc (in
+                                  ///< the order of the Pieces, after the
+                                  ///< last Piece).
+        uint32_t sourceOffset;    ///< Offset of the bytes in the source
+                                  ///< replica; unused for literal bytes.
+        uint32_t length;          ///< Number of bytes in this run.
+    } __attribute__((packed));
+
+    /// The fields up to #pieceCount are as for BackupWrite::Request; #length
+    /// is the sum of the lengths of the Pieces.
+    struct Request {
+        Request()
+            : common()
+            , masterId()
+            , segmentId()
+            , segmentEpoch()
+            , offset()
+            , length()
+            , open()
+            , close()
+            , primary()
+            , certificateIncluded()
+            , certificate()
+            , pieceCount()
+        {}
+        RequestCommonWithId common;
+        uint64_t masterId;
+        uint64_t segmentId;
+        uint64_t segmentEpoch;
+        uint32_t offset;
+        uint32_t length;
+        bool open;
+        bool close;
+        bool primary;
+        bool certificateIncluded;
+        SegmentCertificate certificate;
+        uint32_t pieceCount;      ///< Number of Pieces that follow.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t writeLoad;       ///< See BackupWrite::Response.
+    } __attribute__((packed));
+};
+
+/**
+ * A BackupWrite that the receiving backup also passes on, as a BackupWrite,
+ * to the backups holding the segment's other replicas before it replies.
+ * The master then sends the data over its own network link once rather
+ * than once per replica; see ReplicatedSegment::buildChain().
+ */
+struct BackupWriteChain {
+    static const Opcode opcode = BACKUP_WRITE_CHAIN;
+    static const ServiceType service = BACKUP_SERVICE;
+
+    /// Most backups a write can be passed on to; one per bit of
+    /// Response::forwardedMask.
+    enum { MAX_FORWARDS = 32 };
+
+    /// The fields up to #forwardCount are as for BackupWrite::Request; the
+    /// write is passed on with #primary cleared.
+    struct Request {
+        Request()
+            : common()
+            , masterId()
+            , segmentId()
+            , segmentEpoch()
+            , offset()
+            , length()
+            , open()
+            , close()
+            , primary()
+            , certificateIncluded()
+            , certificate()
+            , forwardCount()
+        {}
+        RequestCommonWithId common;
+        uint64_t masterId;
+        uint64_t segmentId;
+        uint64_t segmentEpoch;
+        uint32_t offset;
+        uint32_t length;
+        bool open;
+        bool close;
+        bool primary;
+        bool certificateIncluded;
+        SegmentCertificate certificate;
+        uint32_t forwardCount;    ///< Number of backups to pass the write
+                                  ///< on to; their 64-bit server ids follow,
+                                  ///< then the data to write.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t writeLoad;       ///< See BackupWrite::Response; for the
+                                  ///< receiving backup only.
+        uint32_t forwardedMask;   ///< Bit i is set if the i-th backup in the
+                                  ///< request stored the write as well.
+    } __attribute__((packed));
+};
+
+/**
+ * Used by a master to find where in a backup's memory it may place the data
+ * of an open replica with one-sided RDMA writes (see
+ * Transport::Session::writeRemote), so that later BackupWrites of that
+ * replica needn't carry the data.
+ */
+struct BackupGetWriteTarget {
+    static const Opcode opcode = BACKUP_GET_WRITE_TARGET;
+    static const ServiceType service = BACKUP_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t masterId;        ///< Server from whom the request is coming.
+        uint64_t segmentId;       ///< Segment whose replica is to be written.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t address;         ///< Address on the backup of the first
+                                  ///< byte of the replica, or 0 if the
+                                  ///< replica can't be written remotely.
+        uint32_t key;             ///< Key to present with writes to
+                                  ///< #address; see
+                                  ///< Transport::getRemoteKey.
+    } __attribute__((packed));
+};
+
+/**
+ * Stores one Reed-Solomon fragment of a closed segment on a backup, in place
+ * of a full replica of it; see ReplicatedSegment and ReedSolomon. The
+ * fragment is written and closed in a single rpc.
+ */
+struct BackupWriteFragment {
+    static const Opcode opcode = BACKUP_WRITE_FRAGMENT;
+    static const ServiceType service = BACKUP_SERVICE;
+    struct Request {
+        Request()
+            : common()
+            , masterId()
+            , segmentId()
+            , segmentEpoch()
+            , certificate()
+            , fragmentIndex()
+            , dataFragments()
+            , parityFragments()
+            , primary()
+            , fromReplica()
+            , length()
+            , checksum()
+        {}
+        RequestCommonWithId common;
+        uint64_t masterId;        ///< Server from whom the request is coming.
+        uint64_t segmentId;       ///< Segment the fragment was encoded from.
+        uint64_t segmentEpoch;    ///< See BackupWrite::Request.
+        SegmentCertificate certificate; ///< Certificate of the whole
+                                        ///< segment, to check it once it
+                                        ///< has been rebuilt.
+        uint8_t fragmentIndex;    ///< Which fragment this is: the first
+                                  ///< #dataFragments hold the segment itself,
+                                  ///< the rest parity.
+        uint8_t dataFragments;    ///< Fragments needed to rebuild (k).
+        uint8_t parityFragments;  ///< Parity fragments of the segment (m).
+        bool primary;             ///< See BackupWrite::Request.
+        bool fromReplica;         ///< True means no data follows: the
+                                  ///< backup computes the fragment from
+                                  ///< its closed replica of the segment.
+        uint32_t length;          ///< Bytes of fragment data.
+        uint32_t checksum;        ///< Crc32C of the fragment data.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+    } __attribute__((packed));
+};
+
+/**
+ * Used by a backup rebuilding a segment from its fragments during master
+ * recovery to collect the fragments that other backups hold.
+ */
+struct BackupGetFragment {
+    static const Opcode opcode = BACKUP_GET_FRAGMENT;
+    static const ServiceType service = BACKUP_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t masterId;        ///< Server whose segment is being rebuilt.
+        uint64_t segmentId;       ///< Segment whose fragment is wanted.
+    } __attribute__((packed));
+    struct Response {
+        Response()
+            : common()
+            , certificate()
+            , fragmentIndex()
+            , length()
+        {}
+        ResponseCommon common;
+        SegmentCertificate certificate; ///< Certificate of the whole segment
+                                        ///< the fragment was encoded from.
+        uint8_t fragmentIndex;    ///< Which fragment follows.
+        uint32_t length;          ///< Bytes of fragment data that follow.
+    } __attribute__((packed));
+};
+
+struct BulkLoad {
+    static const Opcode opcode = BULK_LOAD;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        Request()
+            : common()
+            , tableId()
+            , segmentBytes()
+            , certificate()
+        {}
+        RequestCommon common;
+        uint64_t tableId;               // Table all of the entries in the
+                                        // segment belong to.
+        uint32_t segmentBytes;          // Length of the Segment, before any
+                                        // compression.
+        SegmentCertificate certificate; // Certificate for the segment, used
+                                        // by the master to iterate over it.
+        // In buffer: a Segment containing only objects, tombstones and
+        // object deltas, all of which lie in a single tablet of tableId.
+        // If the rest of the request is shorter than segmentBytes, it holds
+        // the Segment compressed by FrameCompression::compress().
+    } __attribute__((packed));
     struct Response {
         ResponseCommon common;
     } __attribute__((packed));
@@ -478,10 +873,12 @@ struct CreateTable {
                                       // follow immediately after this header.
         uint32_t serverSpan;          // The number of servers across which
                                       // this table will be divided.
+        uint8_t keyHash;              // Key::HashFunction for a new table.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
         uint64_t tableId;             // The id of the created table.
+        uint8_t keyHash;              // Key::HashFunction of the table.
     } __attribute__((packed));
 };
 
@@ -618,10 +1015,43 @@ struct Enumerate {
                                     // (normally the last field of the object)
                                     // is omitted.
         uint64_t tabletFirstHash;
+        uint64_t lastHash;          // Objects with larger key hashes are
+                                    // not returned, and enumeration need
+                                    // not go past this hash.
         uint32_t iteratorBytes;     // Size of iterator in bytes. The
                                     // actual iterator follows
                                     // immediately after this header.
                                     // See EnumerationIterator.
+        uint32_t filterBytes;       // Size of the filter in bytes; 0 means
+                                    // every object is returned whole. The
+                                    // filter (a FilterHeader) follows the
+                                    // iterator. See EnumerationFilter.
+        bool logOrder;              // True means objects are returned in
+                                    // the order of the master's log rather
+                                    // than of its hash table, which scans
+                                    // faster but may return objects more
+                                    // than once. See Enumeration.
+    } __attribute__((packed));
+    struct FilterHeader {
+        uint16_t keyPrefixLength;   // Only objects whose primary key starts
+                                    // with these bytes (which follow this
+                                    // header) are returned.
+        uint8_t numPredicates;      // Number of Predicates following the
+                                    // key prefix.
+        uint8_t numProjections;     // Number of Projections following the
+                                    // predicates.
+    } __attribute__((packed));
+    struct Predicate {
+        uint32_t offset;            // Offset in the value of the first byte
+                                    // compared.
+        uint16_t length;            // Number of bytes compared; the operand
+                                    // follows immediately.
+        uint8_t comparison;         // EnumerationFilter::Comparison.
+    } __attribute__((packed));
+    struct Projection {
+        uint32_t offset;            // Offset in the value of the first byte
+                                    // returned.
+        uint32_t length;            // Number of bytes returned.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -667,6 +1097,24 @@ struct GetBackupConfig {
     } __attribute__((packed));
 };
 
+struct GetDurablePosition {
+    static const Opcode opcode = GET_DURABLE_POSITION;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t segmentId;           // If the master's durable position is
+        uint32_t segmentOffset;       // below this one, it syncs its log
+                                      // before responding. A zero position
+                                      // only asks for the current one.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t segmentId;           // Every entry appended to the master's
+        uint32_t segmentOffset;       // log before this position has been
+                                      // replicated to all of its backups.
+    } __attribute__((packed));
+};
+
 struct GetHeadOfLog {
     static const Opcode opcode = GET_HEAD_OF_LOG;
     static const ServiceType service = MASTER_SERVICE;
@@ -829,6 +1277,7 @@ struct GetTableId {
     struct Response {
         ResponseCommon common;
         uint64_t tableId;
+        uint8_t keyHash;              // Key::HashFunction of the table.
     } __attribute__((packed));
 };
 
@@ -838,16 +1287,46 @@ struct GetTableConfig {
     struct Request {
         RequestCommon common;
         uint64_t tableId;
-    } __attribute__((packed));
-    struct Response {
-        ResponseCommon common;
+        uint64_t knownEpoch;       // configEpoch from an earlier response
+                                   // for this table, or 0.
+        uint64_t knownVersion;     // configVersion from that response, or 0
+                                   // if the client has no copy of the
+                                   // table's configuration.
+        uint8_t flatFormat;        // Nonzero means return the configuration
+                                   // as a FlatTableConfig rather than a
+                                   // ProtoBuf::TableConfig.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t configEpoch;      // Identifies the coordinator's numbering
+                                   // of configVersion; changes whenever the
+                                   // coordinator restarts.
+        uint64_t configVersion;    // Version of the coordinator's tablet
+                                   // configuration that the response
+                                   // reflects.
+        uint8_t incremental;       // Nonzero means only the tablets changed
+                                   // since knownVersion are included (along
+                                   // with all of the indexes); the rest are
+                                   // unchanged.
         uint32_t tableConfigLength;  // Number of bytes in the tablet map.
                                    // The bytes of the tablet map follow
                                    // immediately after this header. See
-                                   // ProtoBuf::Tablets.
+                                   // ProtoBuf::TableConfig and
+                                   // FlatTableConfig.
     } __attribute__((packed));
 };
 
+// The same as GetTableConfig, but sent to a master, which answers from its
+// copy of the coordinator's configuration (see TableConfigCache). The
+// response is never incremental. Its own opcode because the master may
+// issue a GET_TABLE_CONFIG to the coordinator while serving it.
+struct GetCachedTableConfig {
+    static const Opcode opcode = GET_CACHED_TABLE_CONFIG;
+    static const ServiceType service = MASTER_SERVICE;
+    typedef GetTableConfig::Request Request;
+    typedef GetTableConfig::Response Response;
+};
+
 struct HintServerCrashed {
     static const Opcode opcode = HINT_SERVER_CRASHED;
     static const ServiceType service = COORDINATOR_SERVICE;
@@ -914,6 +1393,11 @@ struct ReadHashes {
                                         // objects are being returned or
                                         // do not exist.
         uint32_t numObjects;            // Number of objects being returned.
+        uint32_t hashesPerResponse;     // Number of hashes whose objects,
+                                        // at the average size returned
+                                        // here, would fill one response;
+                                        // clients use it to size their next
+                                        // request. 0 if nothing was returned.
 
         // In buffer: For each object being returned,
         // uint64_t version, uint32_t length and the actual object bytes
@@ -945,6 +1429,36 @@ struct InsertIndexEntry {
     } __attribute__((packed));
 };
 
+/**
+ * Used by a data master to insert and remove several index entries on one
+ * index server at once; see IndexEntryBatcher.
+ */
+struct IndexEntryBatch {
+    static const Opcode opcode = INDEX_ENTRY_BATCH;
+    static const ServiceType service = MASTER_SERVICE;
+
+    /// Describes one entry; see InsertIndexEntry::Request for the fields.
+    struct Part {
+        uint64_t tableId;
+        uint8_t indexId;
+        bool remove;                // True to remove the entry, false to
+                                    // insert it.
+        uint16_t indexKeyLength;
+        uint64_t primaryKeyHash;
+        // In buffer: Actual bytes of the index key goes here.
+    } __attribute__((packed));
+
+    struct Request {
+        RequestCommon common;
+        uint32_t count;             // Number of Parts that follow.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t count;             // Number of Status values that follow,
+                                    // one for each Part, in order.
+    } __attribute__((packed));
+};
+
 /**
  * Used by backups to determine if a particular replica is still needed
  * by a master.  This is only used in the case the backup has crashed, and
@@ -1009,6 +1523,32 @@ struct LookupIndexKeys {
     } __attribute__((packed));
 };
 
+/**
+ * Used by a client to look up primary key hashes in an index, as for
+ * LookupIndexKeys, and to read the matching objects in the same round trip
+ * if their tablet is owned by the index server too.
+ */
+struct LookupIndexKeysAndRead {
+    static const Opcode opcode = LOOKUP_INDEX_KEYS_AND_READ;
+    static const ServiceType service = MASTER_SERVICE;
+
+    /// Same as for LookupIndexKeys.
+    typedef LookupIndexKeys::Request Request;
+
+    struct Response {
+        LookupIndexKeys::Response lookup;   // Result of the lookup; this
+                                            // also holds the status.
+        uint32_t numReadHashes; // Number of the key hashes returned, from the
+                                // first, for which matching objects (if any)
+                                // are returned too. The client must read the
+                                // objects for the others with ReadHashes.
+        uint32_t numObjects;    // Number of objects being returned.
+        // In buffer: Key hashes and next key, as for LookupIndexKeys.
+        // In buffer: The matching objects, in the same format as for
+        // ReadHashes.
+    } __attribute__((packed));
+};
+
 struct MigrateTablet {
     static const Opcode opcode = MIGRATE_TABLET;
     static const ServiceType service = MASTER_SERVICE;
@@ -1030,7 +1570,7 @@ struct MultiOp {
 
     /// Type of Multi Operation
     /// Note: Make sure INVALID is always last.
-    enum OpType { INCREMENT, READ, REMOVE, WRITE, INVALID };
+    enum OpType { INCREMENT, READ, REMOVE, WRITE, PACKED_READ, INVALID };
 
     struct Request {
         RequestCommon common;
@@ -1080,6 +1620,30 @@ struct MultiOp {
             }
         } __attribute__((packed));
 
+        // A compact form of ReadPart, used by PACKED_READ requests. Parts
+        // only carry a table id when it differs from the previous part's,
+        // and only carry reject rules when there are any; responses are the
+        // same as for READ.
+        struct PackedReadPart {
+            uint8_t flags;          // Some combination of the bits below.
+
+            // In buffer: the table id (uint64_t) if flags includes
+            // NEW_TABLE, then the RejectRules if flags includes
+            // REJECT_RULES, then the key length as a varint (7 bits per
+            // byte, least significant first, high bit set on all but the
+            // last byte), then the key.
+
+            /// The part starts a new run of parts in the same table; the
+            /// first part of a request always has this set.
+            static const uint8_t NEW_TABLE = 1;
+
+            /// The part has reject rules; otherwise nothing is rejected.
+            static const uint8_t REJECT_RULES = 2;
+
+            /// Most bytes a key length can take up.
+            static const uint32_t MAX_KEY_LENGTH_BYTES = 3;
+        } __attribute__((packed));
+
         struct RemovePart {
             uint64_t tableId;
             uint16_t keyLength;
@@ -1175,6 +1739,31 @@ struct MultiOp {
     } __attribute__((packed));
 };
 
+struct Patch {
+    static const Opcode opcode = PATCH;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        ClientLease lease;
+        uint64_t rpcId;
+        uint64_t ackId;
+        uint16_t keyLength;           // Length of the key in bytes.
+                                      // The actual key follows
+                                      // immediately after this header.
+        uint32_t offset;              // Offset within the current value
+                                      // at which the new bytes go; equal
+                                      // to the value's length to append.
+        uint32_t length;              // Number of new bytes; these follow
+                                      // immediately after the key.
+        RejectRules rejectRules;
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t version;
+    } __attribute__((packed));
+};
+
 struct Ping {
     static const Opcode opcode = Opcode::PING;
     static const ServiceType service = ADMIN_SERVICE;
@@ -1217,6 +1806,7 @@ struct PrepForMigration {
         uint64_t tableId;           // TableId of the tablet we'll move.
         uint64_t firstKeyHash;      // First key in the tablet range.
         uint64_t lastKeyHash;       // Last key in the tablet range.
+        uint8_t keyHash;            // Key::HashFunction of the table.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1251,6 +1841,13 @@ struct Read {
                                       // The actual key follows
                                       // immediately after this header.
         RejectRules rejectRules;
+        uint8_t wantRemoteReadHint;   // Nonzero means the client would like
+                                      // to read the object remotely next
+                                      // time (see RemoteReadTable).
+        uint8_t allowReplica;         // Nonzero means the client accepts
+                                      // the value from a hot key replica
+                                      // (see HotKeyReplicator) and would
+                                      // like to know where they are.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1258,6 +1855,20 @@ struct Read {
         uint32_t length;              // Length of the object's value in bytes.
                                       // The actual bytes of the object follow
                                       // immediately after this header.
+        uint64_t remoteReadSlot;      // If the client asked for a hint and
+                                      // the object can be read remotely,
+                                      // address of its RemoteReadTable slot;
+                                      // otherwise 0.
+        uint32_t remoteReadSlotKey;   // Transport keys for reading the slot
+        uint32_t remoteReadObjectKey; // and the object it points to.
+        uint8_t fromReplica;          // Nonzero means the value came from a
+                                      // hot key replica rather than the
+                                      // object's master.
+        uint8_t hotReplicaCount;      // Number of other masters holding
+                                      // replicas of the object. Each one's
+                                      // service locator follows the value,
+                                      // as a uint16_t length and that many
+                                      // characters.
     } __attribute__((packed));
 };
 
@@ -1271,6 +1882,9 @@ struct ReadKeysAndValue {
                                       // The actual key follows
                                       // immediately after this header.
         RejectRules rejectRules;
+        uint64_t snapshotTime;        // If nonzero, read the object as it
+                                      // was at this encoded ClusterTime
+                                      // (rejectRules are then ignored).
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1282,6 +1896,84 @@ struct ReadKeysAndValue {
     } __attribute__((packed));
 };
 
+struct ReadLogChanges {
+    static const Opcode opcode = READ_LOG_CHANGES;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t tableId;             // Only return changes to this table.
+        uint64_t segmentId;           // Position in the log to start from,
+        uint32_t segmentOffset;       // as returned by GET_HEAD_OF_LOG or a
+                                      // previous READ_LOG_CHANGES.
+        uint32_t maxBytes;            // Most bytes of changes to return.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t segmentId;           // Position to pass to the next
+        uint32_t segmentOffset;       // READ_LOG_CHANGES.
+        uint8_t changesLost;          // Nonzero means the cleaner dropped
+                                      // some of the changes after the
+                                      // requested position; none are
+                                      // returned and the caller has to
+                                      // start over from a full copy.
+        uint32_t length;              // Number of bytes of changes following
+                                      // this header, each one a Change.
+    } __attribute__((packed));
+    struct Change {
+        uint8_t type;                 // LogEntryType: an object, tombstone
+                                      // or object delta.
+        uint32_t length;              // Length of the entry exactly as in the
+                                      // log, which follows this header.
+    } __attribute__((packed));
+};
+
+struct ReadRange {
+    static const Opcode opcode = READ_RANGE;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        uint16_t keyLength;           // Length of the key in bytes.
+                                      // The actual key follows
+                                      // immediately after this header.
+        RejectRules rejectRules;
+        uint32_t offset;              // First byte of the value to return.
+        uint32_t length;              // Most bytes to return.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t version;
+        uint32_t length;              // Number of value bytes returned; they
+                                      // follow immediately after this header.
+        uint32_t valueLength;         // Length of the object's entire value.
+    } __attribute__((packed));
+};
+
+struct ReadTableSnapshot {
+    static const Opcode opcode = READ_TABLE_SNAPSHOT;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        uint64_t tabletFirstHash;     // Identifies the tablet being read.
+        uint64_t snapshotId;          // Snapshot to continue reading, as
+                                      // returned by the previous call; 0
+                                      // takes a new snapshot of the tablet.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint64_t snapshotId;          // Pass this back to read more of the
+                                      // tablet. 0 means the tablet's snapshot
+                                      // has been read completely.
+        uint64_t tabletFirstHash;     // Where to continue: this tablet while
+                                      // snapshotId is nonzero, otherwise the
+                                      // next one (0 at the end of the table).
+        uint32_t payloadBytes;        // Size of the objects that follow this
+                                      // header, each a uint32_t size and an
+                                      // Object, as for Enumerate.
+    } __attribute__((packed));
+};
+
 struct ReassignTabletOwnership {
     static const Opcode opcode = REASSIGN_TABLET_OWNERSHIP;
     static const ServiceType service = COORDINATOR_SERVICE;
@@ -1455,6 +2147,68 @@ struct RenewLease {
     } __attribute__((packed));
 };
 
+// Renews several client leases at once, for agents that hold the leases of
+// many clients (see ClientLeaseAuthority::renewLeases).
+struct RenewLeases {
+    static const Opcode opcode = RENEW_LEASES;
+    static const ServiceType service = COORDINATOR_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint32_t leaseCount;        // Number of leaseIds that follow.
+        // In buffer: leaseCount uint64_t leaseIds.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t leaseCount;        // Number of ClientLeases that follow, in
+                                    // the order of the requested leaseIds.
+        // In buffer: leaseCount ClientLease structures.
+    } __attribute__((packed));
+};
+
+struct Scan {
+    static const Opcode opcode = SCAN;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommon common;
+        uint64_t tableId;
+        uint64_t keyHash;             // Any key hash in a tablet of the
+                                      // table on the target master; used
+                                      // only to route the request.
+        uint16_t startKeyLength;      // Smallest key to return; 0 means the
+                                      // smallest key in the table.
+        uint16_t endKeyLength;        // Exclusive end of the range; 0 means
+                                      // the range has no end.
+        uint32_t maxObjects;          // Most objects to return.
+                                      // The start key and then the end key
+                                      // follow this header.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+        uint32_t numObjects;          // Number of objects following this
+                                      // header, in key order, each an
+                                      // Object header and the object's keys
+                                      // and value.
+        uint8_t more;                 // Nonzero means the master has more
+                                      // objects in the range after the last
+                                      // one returned.
+        uint32_t numTablets;          // Number of Tablets following the
+                                      // objects: the tablets of the table
+                                      // that were scanned, which are the
+                                      // ones owned by the master throughout
+                                      // the scan.
+    } __attribute__((packed));
+    struct Object {
+        uint64_t version;
+        uint32_t length;              // Length of the keys and value that
+                                      // follow, in the format of
+                                      // Object::appendKeysAndValueToBuffer.
+    } __attribute__((packed));
+    struct Tablet {
+        uint64_t startKeyHash;
+        uint64_t endKeyHash;
+    } __attribute__((packed));
+};
+
 struct ServerControl {
     static const Opcode opcode = Opcode::SERVER_CONTROL;
     static const ServiceType service = ADMIN_SERVICE;
@@ -1631,6 +2385,7 @@ struct TakeTabletOwnership {
         uint64_t tableId;
         uint64_t firstKeyHash;
         uint64_t lastKeyHash;
+        uint8_t keyHash;            // Key::HashFunction of the table.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
@@ -1711,6 +2466,9 @@ struct TxDecision {
                                     // been recovered.
         uint32_t participantCount;  // Number of local objects participating TX
                                     // for this server.
+        uint64_t commitTime;        // Encoded ClusterTime the transaction
+                                    // committed at, for snapshot reads; 0
+                                    // lets the server pick its own.
         // List of local Participants
     } __attribute__((packed));
 
@@ -1761,6 +2519,9 @@ struct TxPrepare {
         uint32_t participantCount;  // Number of all objects participating TX
                                     // in whole cluster.
         uint32_t opCount;           // Number of operations this RPC contains.
+        uint64_t snapshotTime;      // If nonzero, the transaction runs with
+                                    // snapshot isolation and read from a
+                                    // snapshot at this encoded ClusterTime.
 
         // Following this structure, a TxPrepare request message contains,
         // - array of all TxParticipants of current transaction and
@@ -1835,6 +2596,10 @@ struct TxPrepare {
     struct Response {
         ResponseCommon common;
         Vote vote;
+        uint64_t clusterTime;       // The server's encoded ClusterTime once
+                                    // the operations were prepared; the
+                                    // commit time of a snapshot-isolation
+                                    // transaction must be later.
     } __attribute__((packed));
 };
 
@@ -1884,27 +2649,74 @@ struct TxHintFailed {
     } __attribute__((packed));
 };
 
+struct UpdateHotReplica {
+    static const Opcode opcode = UPDATE_HOT_REPLICA;
+    static const ServiceType service = MASTER_SERVICE;
+    struct Request {
+        RequestCommonWithId common;
+        uint64_t tableId;
+        uint16_t keyLength;           // Length of the key in bytes.
+        uint32_t length;              // Length of the object's value in
+                                      // bytes. The key and then the value
+                                      // follow immediately after this header.
+        uint64_t version;             // Version of the object.
+        uint32_t leaseMicros;         // The replica may be served for this
+                                      // long after it is received.
+        uint8_t remove;               // Nonzero means the object was
+                                      // removed; the replica is dropped and
+                                      // there is no value.
+    } __attribute__((packed));
+    struct Response {
+        ResponseCommon common;
+    } __attribute__((packed));
+};
+
 struct UpdateServerList {
     static const Opcode opcode = UPDATE_SERVER_LIST;
     static const ServiceType service = ADMIN_SERVICE;
     struct Request {
         RequestCommonWithId common;
+        uint32_t forwardCount;        // Number of ForwardTarget objects at
+                                      // the very end of the request: other
+                                      // servers that the recipient should
+                                      // pass the same updates on to.
+        uint32_t fanout;              // Maximum number of servers the
+                                      // recipient should forward to itself;
+                                      // each of them forwards to part of the
+                                      // rest (see
+                                      // AdminService::updateServerList).
 
         // Immediately following this header are one or more groups,
         // where each group consists of a Part object (defined below)
-        // followed by a serialized ProtoBuf::ServerList.
+        // followed by a serialized ProtoBuf::ServerList. These are
+        // followed by forwardCount ForwardTarget objects.
         struct Part {
             uint32_t serverListLength; // Number of bytes in the server list.
                                        // The bytes of the server list follow
                                        // immediately after this header. See
                                        // ProtoBuf::ServerList.
         }  __attribute__((packed));
+        struct ForwardTarget {
+            uint64_t serverId;
+        } __attribute__((packed));
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
         uint64_t currentVersion;      // The server list version number of the
                                       // RPC recipient, after processing this
                                       // request.
+
+        // If the request had forward targets, this header is followed by
+        // one ForwardResult for each of them.
+        struct ForwardResult {
+            uint64_t serverId;
+            uint64_t currentVersion;  // Server list version of serverId after
+                                      // processing the forwarded request;
+                                      // only valid if status is STATUS_OK.
+            uint32_t status;          // STATUS_OK, or STATUS_SERVER_NOT_UP
+                                      // if the update couldn't be forwarded
+                                      // to serverId.
+        } __attribute__((packed));
     } __attribute__((packed));
 };
 
@@ -1933,12 +2745,31 @@ struct Write {
                                       // keysAndValue blob in bytes.These
                                       // follow immediately after this header
         RejectRules rejectRules;
-        uint8_t async;
+        uint8_t durability;           // A Durability value.
+        uint32_t ttl;                 // Seconds after which the object
+                                      // expires, or 0 if it never does.
     } __attribute__((packed));
     struct Response {
         ResponseCommon common;
         uint64_t version;
     } __attribute__((packed));
+
+    /// Follows the Response of a successful write whose durability wasn't
+    /// ALL_REPLICAS.
+    struct Position {
+        uint64_t masterId;            // Master that wrote the object.
+        uint64_t segmentId;           // A position in its log after the
+        uint32_t segmentOffset;       // object: the write is fully durable
+                                      // once the master's
+                                      // GET_DURABLE_POSITION reaches it.
+    } __attribute__((packed));
+
+    /// How durable a write must be before the master responds to it.
+    enum Durability {
+        ALL_REPLICAS = 0,             // Replicated to all of the backups.
+        MEMORY_ONLY = 1,              // Only in the master's memory.
+        ONE_BACKUP = 2,               // Replicated to at least one backup.
+    };
 };
 
 // DON'T DEFINE NEW RPC TYPES HERE!! Put them in alphabetical order above.
@@ -14,16 +14,22 @@
  */
 
 #include <new>
+#include <sstream>
 #include "BitOps.h"
 #include "Cycles.h"
 #include "CycleCounter.h"
+#include "DispatchShard.h"
 #include "Fence.h"
 #include "Initialize.h"
 #include "LogProtector.h"
 #include "PerfStats.h"
 #include "RawMetrics.h"
+#include "RpcCacheStats.h"
+#include "RpcLatencyStats.h"
 #include "RpcLevel.h"
+#include "RpcTrace.h"
 #include "ShortMacros.h"
+#include "TableUsageStats.h"
 #include "ServerRpcPool.h"
 #include "TimeTrace.h"
 #include "WireFormat.h"
@@ -72,6 +78,13 @@ Syscall* WorkerManager::sys = &defaultSyscall;
 // time it takes to wake up the thread once it has gone to sleep (as of
 // September 2011 this time appears to be as much as 50 microseconds).
 int WorkerManager::pollMicros = 10000;
+int WorkerManager::burstCores = 0;
+int WorkerManager::sloMicros = 100;
+int WorkerManager::maxDeferMicros = 1000;
+int WorkerManager::inlineNanos = 0;
+int WorkerManager::maxQueuedRpcs = 0;
+int WorkerManager::tenantQuantumMicros = 0;
+std::unordered_map<uint64_t, int> WorkerManager::tenantWeights;
 // The following constant is used to signal a worker thread that
 // it should exit.
 #define WORKER_EXIT reinterpret_cast<Transport::ServerRpc*>(1)
@@ -85,32 +98,49 @@ int WorkerManager::pollMicros = 10000;
  *      This class will try to ensure that the number of running worker
  *      threads doesn't exceed this value. However, in order to prevent
  *      deadlocks, it may occasionally be necessary to go beyond this
- *      limit.
+ *      limit, and up to #burstCores more threads are used for requests
+ *      that would otherwise wait longer than #sloMicros.
  */
 WorkerManager::WorkerManager(Context* context, uint32_t maxCores)
     : Dispatch::Poller(context->dispatch, "WorkerManager")
     , context(context)
     , levels()
+    , opcodeCosts()
     , busyThreads()
+    , numBusyThreads(0)
     , idleThreads()
     , maxCores(maxCores)
     , rpcsWaiting(0)
+    , nextSequence(0)
+    , sloCycles(Cycles::fromMicroseconds(sloMicros))
+    , maxDeferCycles(Cycles::fromMicroseconds(maxDeferMicros))
+    , inlineCycles(Cycles::fromNanoseconds(inlineNanos))
+    , tenantQuantumCycles(Cycles::fromMicroseconds(tenantQuantumMicros))
+    , inlinePollTime(0)
+    , inlineCyclesUsed(0)
     , testingSaveRpcs(0)
     , testRpcs()
+    , opcodeActivity()
 {
     levels.resize(RpcLevel::maxLevel() + 1);
+    opcodeCosts.resize(WireFormat::ILLEGAL_RPC_TYPE);
+    for (uint32_t i = 0; i < WireFormat::ILLEGAL_RPC_TYPE; i++) {
+        opcodeActivity.push_back(context->dispatch->getActivityCounter(
+                format("rpc %s", WireFormat::opcodeSymbol(i))));
+    }
 
     // Create all the worker threads. We create enough threads to
-    // execute maxCores RPCs in parallel, *plus* one thread for each
-    // RPC level not already in use. This is sufficient to prevent
-    // distributed deadlock over worker threads.
+    // execute maxCores RPCs in parallel (plus burstCores for requests that
+    // have waited too long), *plus* one thread for each RPC level not
+    // already in use. This is sufficient to prevent distributed deadlock
+    // over worker threads.
     //
     // Note: we create threads here rather than waiting until the thread
     // is needed, because thread creation can be quite slow on Linux
     // (> 250ms sometimes, see RAM-343) and a long stall in actually
     // scheduling a thread can cause timeouts.
 
-    for (int i = maxCores + RpcLevel::maxLevel(); i > 0; i--) {
+    for (int i = maxCores + burstCores + RpcLevel::maxLevel(); i > 0; i--) {
         Worker* worker = new Worker(context);
         worker->thread.construct(workerMain, worker);
         idleThreads.push_back(worker);
@@ -147,6 +177,15 @@ WorkerManager::~WorkerManager()
 void
 WorkerManager::handleRpc(Transport::ServerRpc* rpc)
 {
+    // Requests received by a shard's transports are served from the main
+    // dispatch thread; see DispatchShard.
+    if (DispatchShard::current != NULL) {
+        DispatchShard::current->handleRpc(rpc);
+        return;
+    }
+
+    rpc->arrivalTime = Cycles::rdtsc();
+
     // Find the service for this RPC.
     const WireFormat::RequestCommon* header;
     header = rpc->requestPayload.getStart<WireFormat::RequestCommon>();
@@ -169,19 +208,24 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
             Service::prepareErrorResponse(&rpc->replyPayload,
                     STATUS_UNIMPLEMENTED_REQUEST);
         }
-        rpc->sendReply();
+        sendReply(rpc);
         return;
     }
+    Dispatch::ActivityTimer activity(context->dispatch,
+            opcodeActivity[header->opcode]);
 
     // Handle ping requests inline so that high server load can never cause a
     // server to appear offline.
     if ((header->opcode == WireFormat::PING)) {
         Service::Rpc serviceRpc(NULL, &rpc->requestPayload, &rpc->replyPayload);
         Service::handleRpc(context, &serviceRpc);
-        rpc->sendReply();
+        sendReply(rpc);
         return;
     }
 
+    if ((inlineCycles != 0) && (rpcsWaiting == 0) && runInline(rpc, header))
+        return;
+
     int level = RpcLevel::getLevel(WireFormat::Opcode(header->opcode));
     timeTrace("handleRpc processing opcode %d", header->opcode);
 #ifdef LOG_RPCS
@@ -204,26 +248,17 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
         for (int i = level; i >= 0; i--) {
             if (levels[i].requestsRunning > 0) {
                 // Can't run this request right now.
-                levels[level].waitingRpcs.push(rpc);
-                rpcsWaiting++;
+                if (shedRpc(rpc, header)) {
+                    timeTrace("RPC rejected; too many waiting");
+                    return;
+                }
+                deferRpc(rpc, WireFormat::Opcode(header->opcode), level);
                 timeTrace("RPC deferred; threads busy");
                 return;
             }
         }
     }
 
-    // Temporary code to test how much faster things would be without threads.
-#if 0
-    if (((header->opcode == WireFormat::ECHO) ||
-            (header->opcode == WireFormat::READ)) &&
-            (header->service == WireFormat::MASTER_SERVICE)) {
-        Service::Rpc serviceRpc(NULL, &rpc->requestPayload, &rpc->replyPayload);
-        Service::handleRpc(context, &serviceRpc);
-        rpc->sendReply();
-        return;
-    }
-#endif
-
     levels[level].requestsRunning++;
 
     // Hand off the RPC to a worker thread.
@@ -232,9 +267,37 @@ WorkerManager::handleRpc(Transport::ServerRpc* rpc)
     idleThreads.pop_back();
     worker->opcode = WireFormat::Opcode(header->opcode);
     worker->level = level;
+    worker->requestBytes = rpc->requestPayload.size();
     worker->handoff(rpc);
     worker->busyIndex = downCast<int>(busyThreads.size());
     busyThreads.push_back(worker);
+    numBusyThreads = downCast<uint32_t>(busyThreads.size());
+}
+
+/**
+ * This method is invoked by Dispatch when it would like to sleep. That's
+ * fine as long as no worker is servicing an RPC: the dispatch thread will
+ * be woken by the transport when the next request arrives. While RPCs are
+ * outstanding, the dispatch thread must keep polling to notice when they
+ * complete.
+ */
+bool
+WorkerManager::canSleep()
+{
+    return busyThreads.empty();
+}
+
+/**
+ * Returns how many of the cores set aside for worker threads are not
+ * currently executing RPCs. Unlike the other methods, this may be called
+ * from any thread (the LogCleaner uses it to run its threads on cores the
+ * workers leave idle); the answer may be slightly out of date.
+ */
+uint32_t
+WorkerManager::getIdleCores()
+{
+    uint32_t busy = numBusyThreads;
+    return (busy < maxCores) ? maxCores - busy : 0;
 }
 
 /**
@@ -249,6 +312,377 @@ WorkerManager::idle()
     return busyThreads.empty();
 }
 
+/**
+ * Queue a request that can't start yet because all of the worker threads
+ * it may use are busy. Requests that are expected to be quick are placed
+ * ahead of slower requests of the same tenant that arrived shortly before
+ * them, so that a burst of slow requests (a multiRead of many objects, an
+ * enumeration) doesn't leave short ones waiting behind it; see
+ * #maxDeferMicros. Requests of different tenants are started in the order
+ * given by #tenantQuantumMicros.
+ *
+ * \param rpc
+ *      The request.
+ * \param opcode
+ *      The request's opcode.
+ * \param level
+ *      The request's RpcLevel.
+ */
+void
+WorkerManager::deferRpc(Transport::ServerRpc* rpc, WireFormat::Opcode opcode,
+        int level)
+{
+    WaitingRpc waiting;
+    waiting.cycles = estimateCycles(opcode, rpc->requestPayload.size());
+    waiting.priority = rpc->arrivalTime + std::min(maxDeferCycles,
+            waiting.cycles);
+    waiting.sequence = nextSequence++;
+    waiting.rpc = rpc;
+    waiting.opcode = opcode;
+
+    Level* waitLevel = &levels[level];
+    uint64_t tenantId = getTenant(rpc, opcode);
+    Tenant& tenant = waitLevel->tenants[tenantId];
+    if (tenant.waitingRpcs.empty()) {
+        // The tenant joins the end of the round robin, with a full turn's
+        // worth of credit.
+        tenant.deficit = getQuantum(tenantId);
+        waitLevel->activeTenants.push_back(tenantId);
+    }
+    tenant.waitingRpcs.push(waiting);
+    waitLevel->numWaiting++;
+    rpcsWaiting++;
+}
+
+/**
+ * Figure out which tenant (see #tenantQuantumMicros) a request is for:
+ * the table of a read, write or other operation on objects, or the table
+ * of the first object of a multi-operation.
+ *
+ * \param rpc
+ *      The request.
+ * \param opcode
+ *      The request's opcode.
+ * \return
+ *      The request's table id, or NO_TENANT if it isn't for a table or
+ *      fair queuing is disabled.
+ */
+uint64_t
+WorkerManager::getTenant(Transport::ServerRpc* rpc,
+        WireFormat::Opcode opcode)
+{
+    if (tenantQuantumCycles == 0)
+        return NO_TENANT;
+
+    // All of these requests start with the table id.
+    uint32_t offset = sizeof32(WireFormat::RequestCommon);
+    switch (opcode) {
+        case WireFormat::APPEND:
+        case WireFormat::ENUMERATE:
+        case WireFormat::INCREMENT:
+        case WireFormat::LOOKUP_INDEX_KEYS:
+        case WireFormat::PATCH:
+        case WireFormat::READ:
+        case WireFormat::READ_HASHES:
+        case WireFormat::READ_KEYS_AND_VALUE:
+        case WireFormat::READ_RANGE:
+        case WireFormat::REMOVE:
+        case WireFormat::SCAN:
+        case WireFormat::WRITE:
+            break;
+        case WireFormat::MULTI_OP: {
+            const WireFormat::MultiOp::Request* header =
+                    rpc->requestPayload.getStart<
+                    WireFormat::MultiOp::Request>();
+            if (header == NULL)
+                return NO_TENANT;
+            offset = sizeof32(*header);
+            if (header->type == WireFormat::MultiOp::PACKED_READ) {
+                // Skip the flags of the first part, which always carries
+                // a table id.
+                offset += sizeof32(
+                    WireFormat::MultiOp::Request::PackedReadPart);
+            }
+            break;
+        }
+        default:
+            return NO_TENANT;
+    }
+    const uint64_t* tableId = rpc->requestPayload.getOffset<uint64_t>(offset);
+    return (tableId == NULL) ? NO_TENANT : *tableId;
+}
+
+/**
+ * Parse the value of the --workerTenantWeights option.
+ *
+ * \param spec
+ *      A comma-separated list of tableId:weight pairs, such as "5:4,7:2";
+ *      weights must be at least 1. May be empty.
+ * \param[out] weights
+ *      Contents are replaced with the weight of each table listed.
+ * \return
+ *      False if \a spec is malformed.
+ */
+bool
+WorkerManager::parseTenantWeights(const string& spec,
+        std::unordered_map<uint64_t, int>* weights)
+{
+    weights->clear();
+    std::istringstream stream(spec);
+    string item;
+    while (std::getline(stream, item, ',')) {
+        uint64_t tableId;
+        int weight;
+        char extra;
+        if ((sscanf(item.c_str(), "%lu:%d%c", &tableId, &weight,
+                &extra) != 2) || (weight < 1)) {
+            return false;
+        }
+        (*weights)[tableId] = weight;
+    }
+    return true;
+}
+
+/**
+ * Returns the credit, in Cycles::rdtsc ticks of expected service time, that
+ * a tenant receives for each of its turns at starting requests.
+ *
+ * \param tenantId
+ *      Identifies the tenant (see getTenant).
+ */
+int64_t
+WorkerManager::getQuantum(uint64_t tenantId)
+{
+    int weight = 1;
+    std::unordered_map<uint64_t, int>::iterator it =
+            tenantWeights.find(tenantId);
+    if (it != tenantWeights.end())
+        weight = it->second;
+    return static_cast<int64_t>(tenantQuantumCycles) * weight;
+}
+
+/**
+ * Returns the waiting request that should be started next at a level,
+ * without removing it. This is the next request of the tenant whose turn
+ * it is; tenants that have used up their credit go to the end of the
+ * round robin (with new credit for their next turn).
+ *
+ * \param level
+ *      Level whose requests are considered; must have at least one
+ *      waiting.
+ */
+const WorkerManager::WaitingRpc&
+WorkerManager::nextWaitingRpc(Level* level)
+{
+    assert(!level->activeTenants.empty());
+    Tenant* tenant = &level->tenants[level->activeTenants.front()];
+    while ((tenant->deficit <= 0) && (level->activeTenants.size() > 1)) {
+        uint64_t tenantId = level->activeTenants.front();
+        tenant->deficit += getQuantum(tenantId);
+        level->activeTenants.pop_front();
+        level->activeTenants.push_back(tenantId);
+        tenant = &level->tenants[level->activeTenants.front()];
+    }
+    return tenant->waitingRpcs.top();
+}
+
+/**
+ * Remove the request that should be started next at a level (see
+ * nextWaitingRpc) and charge its expected service time to its tenant.
+ *
+ * \param level
+ *      Level whose requests are considered; must have at least one
+ *      waiting.
+ * \return
+ *      The request to start.
+ */
+WorkerManager::WaitingRpc
+WorkerManager::popWaitingRpc(Level* level)
+{
+    WaitingRpc waiting = nextWaitingRpc(level);
+    uint64_t tenantId = level->activeTenants.front();
+    Tenant& tenant = level->tenants[tenantId];
+    tenant.waitingRpcs.pop();
+    level->numWaiting--;
+    if (tenant.waitingRpcs.empty()) {
+        level->tenants.erase(tenantId);
+        level->activeTenants.pop_front();
+    } else if (level->activeTenants.size() > 1) {
+        // A tenant that has the level to itself isn't charged, so that it
+        // doesn't run up a debt to be paid back once others show up.
+        tenant.deficit -= std::max(waiting.cycles, uint64_t(1));
+    }
+    return waiting;
+}
+
+/**
+ * Predict how long a worker will take to execute a request, from the
+ * service times of recent requests with the same opcode. A request that is
+ * larger than is typical for its opcode (e.g. a multi-operation with many
+ * objects) is assumed to take proportionally longer; smaller requests are
+ * not assumed to be faster, since fixed costs tend to dominate them.
+ *
+ * \param opcode
+ *      The request's opcode.
+ * \param requestBytes
+ *      Size of the request message.
+ * \return
+ *      The expected service time in Cycles::rdtsc ticks; 0 if no request
+ *      with this opcode has completed yet.
+ */
+uint64_t
+WorkerManager::estimateCycles(WireFormat::Opcode opcode,
+        uint32_t requestBytes)
+{
+    const OpcodeCost& cost = opcodeCosts[opcode];
+    if ((cost.requestBytes == 0) || (requestBytes <= cost.requestBytes))
+        return cost.cycles;
+    return cost.cycles * requestBytes / cost.requestBytes;
+}
+
+/**
+ * Fold the service time of a request that just finished into the estimates
+ * for its opcode.
+ *
+ * \param opcode
+ *      The request's opcode.
+ * \param serviceCycles
+ *      How long the request took to execute, in Cycles::rdtsc ticks.
+ * \param requestBytes
+ *      Size of the request message.
+ */
+void
+WorkerManager::recordCost(WireFormat::Opcode opcode, uint64_t serviceCycles,
+        uint32_t requestBytes)
+{
+    OpcodeCost& cost = opcodeCosts[opcode];
+    if (cost.cycles == 0) {
+        cost.cycles = serviceCycles;
+        cost.requestBytes = requestBytes;
+    } else {
+        cost.cycles = cost.cycles - cost.cycles/16 + serviceCycles/16;
+        cost.requestBytes = cost.requestBytes - cost.requestBytes/16
+                + requestBytes/16;
+    }
+    if (cost.cycles == 0)
+        cost.cycles = 1;
+}
+
+/**
+ * Execute a request directly in the dispatch thread if it is one of the
+ * few kinds that are known to be short and never block, and the dispatch
+ * thread's budget for such requests (#inlineNanos per pass through the
+ * polling loop) allows it. For these requests, handing off to a worker
+ * (waking it, and moving the request and the Worker state between caches)
+ * costs more than executing them.
+ *
+ * Only requests whose recent service time, as measured by workers, is
+ * known and fits the budget are executed inline; reads of large objects
+ * raise the estimate for READ and so go back to workers.
+ *
+ * \param rpc
+ *      The request.
+ * \param header
+ *      The request's header; the opcode has already been checked.
+ * \return
+ *      True means the request was executed and its reply sent; false
+ *      means it must be given to a worker as usual.
+ */
+bool
+WorkerManager::runInline(Transport::ServerRpc* rpc,
+        const WireFormat::RequestCommon* header)
+{
+    WireFormat::Opcode opcode = WireFormat::Opcode(header->opcode);
+    switch (opcode) {
+        case WireFormat::READ:
+            if (header->service != WireFormat::MASTER_SERVICE)
+                return false;
+            break;
+        case WireFormat::GET_SERVER_ID:
+            break;
+        default:
+            return false;
+    }
+    if (inlinePollTime != context->dispatch->currentTime) {
+        inlinePollTime = context->dispatch->currentTime;
+        inlineCyclesUsed = 0;
+    }
+    uint64_t estimate = estimateCycles(opcode, rpc->requestPayload.size());
+    if ((estimate == 0) || (inlineCyclesUsed + estimate > inlineCycles))
+        return false;
+
+    timeTrace("executing opcode %d inline", opcode);
+    uint64_t start = Cycles::rdtsc();
+    rpc->logProtectorPin.acquire();
+    Service::Rpc serviceRpc(NULL, &rpc->requestPayload, &rpc->replyPayload);
+    Service::handleRpc(context, &serviceRpc);
+    uint64_t serviceCycles = Cycles::rdtsc() - start;
+    inlineCyclesUsed += serviceCycles;
+    recordCost(opcode, serviceCycles, rpc->requestPayload.size());
+    RpcLatencyStats::record(opcode, start - rpc->arrivalTime, serviceCycles);
+    sendReply(rpc);
+    return true;
+}
+
+/**
+ * Decide whether a request that can't be started right away should be
+ * turned away rather than queued, because the queue already holds
+ * #maxQueuedRpcs requests. If so, reply with STATUS_RETRY right away;
+ * the suggested delay is how long the requests already waiting should
+ * take to run on maxCores threads, so that clients back off in
+ * proportion to the overload instead of adding to it.
+ *
+ * Only master requests are rejected: coordinator, backup and ping
+ * requests are few and are needed to resolve the overload (or to tell
+ * that the server is still alive).
+ *
+ * \param rpc
+ *      Request that could not be started.
+ * \param header
+ *      Header of its request message.
+ * \return
+ *      True if a retry reply was sent; the caller must not touch \a rpc
+ *      any more. False if the request should be queued as usual.
+ */
+bool
+WorkerManager::shedRpc(Transport::ServerRpc* rpc,
+        const WireFormat::RequestCommon* header)
+{
+    if ((maxQueuedRpcs <= 0) || (rpcsWaiting < maxQueuedRpcs) ||
+            (header->service != WireFormat::MASTER_SERVICE))
+        return false;
+
+    uint64_t backlog = estimateCycles(WireFormat::Opcode(header->opcode),
+            rpc->requestPayload.size()) * rpcsWaiting / maxCores;
+    uint64_t delayMicros = Cycles::toMicroseconds(backlog);
+    if (delayMicros < MIN_SHED_DELAY_MICROS)
+        delayMicros = MIN_SHED_DELAY_MICROS;
+    if (delayMicros > MAX_SHED_DELAY_MICROS)
+        delayMicros = MAX_SHED_DELAY_MICROS;
+    Service::prepareRetryResponse(&rpc->replyPayload,
+            downCast<uint32_t>(delayMicros),
+            downCast<uint32_t>(2 * delayMicros), "server is overloaded");
+    sendReply(rpc);
+    return true;
+}
+
+/**
+ * Send the reply for an RPC that has been serviced, from the thread that
+ * owns the transport it arrived on.
+ *
+ * \param rpc
+ *      RPC whose reply is ready; the caller must not touch it afterwards.
+ */
+void
+WorkerManager::sendReply(Transport::ServerRpc* rpc)
+{
+    if (rpc->shard != NULL) {
+        rpc->shard->sendReply(rpc);
+    } else {
+        rpc->sendReply();
+    }
+}
+
 /**
  * This method is invoked by Dispatch during its polling loop.  It checks
  * for completion of outstanding RPCs.
@@ -270,6 +704,8 @@ WorkerManager::poll()
             continue;
         }
         foundWork = 1;
+        Dispatch::ActivityTimer activity(context->dispatch,
+                opcodeActivity[worker->opcode]);
         Fence::enter();
         timeTrace("dispatch thread starting cleanup for opcode %d, thread %d",
                 worker->opcode, worker->threadId);
@@ -284,6 +720,8 @@ WorkerManager::poll()
         // for workers, hand off a new request to this worker ASAP.
         bool startedNewRpc = false;
         if (state != Worker::POSTPROCESSING) {
+            recordCost(worker->opcode, worker->serviceCycles,
+                    worker->requestBytes);
             levels[worker->level].requestsRunning--;
             if (rpcsWaiting) {
                 // Start an RPC with the lowest level (this is most efficient,
@@ -306,14 +744,16 @@ WorkerManager::poll()
                         // limits.
                         break;
                     }
-                    if (level->waitingRpcs.empty()) {
+                    if (level->numWaiting == 0) {
                         continue;
                     }
                     rpcsWaiting--;
                     level->requestsRunning++;
+                    WaitingRpc waiting = popWaitingRpc(level);
+                    worker->opcode = waiting.opcode;
                     worker->level = i;
-                    worker->handoff(level->waitingRpcs.front());
-                    level->waitingRpcs.pop();
+                    worker->requestBytes = waiting.rpc->requestPayload.size();
+                    worker->handoff(waiting.rpc);
                     startedNewRpc = true;
                     break;
                 }
@@ -328,7 +768,7 @@ WorkerManager::poll()
                     reinterpret_cast<uint64_t>(rpc),
                     rpc->replyPayload.size());
 #endif
-            rpc->sendReply();
+            sendReply(rpc);
             timeTrace("sent reply for opcode %d, thread %d",
                     worker->threadId, worker->opcode);
 
@@ -343,13 +783,63 @@ WorkerManager::poll()
                         worker->busyIndex;
             }
             busyThreads.pop_back();
+            numBusyThreads = downCast<uint32_t>(busyThreads.size());
             worker->busyIndex = -1;
             idleThreads.push_back(worker);
         }
     }
+    if ((rpcsWaiting > 0) && (burstCores > 0))
+        startLateRpcs();
     return foundWork;
 }
 
+/**
+ * Start waiting requests that have been queued longer than #sloMicros,
+ * using up to #burstCores worker threads beyond the core limit. The extra
+ * threads go back to sleep once the load drops, like any other idle
+ * worker. At most one thread is left for each RpcLevel, as before, so the
+ * deadlock avoidance rules in handleRpc still hold.
+ */
+void
+WorkerManager::startLateRpcs()
+{
+    uint64_t now = Cycles::rdtsc();
+    while ((rpcsWaiting > 0) &&
+            (busyThreads.size() < maxCores + downCast<uint32_t>(burstCores))) {
+        // Of the requests that would start next at each level, pick the
+        // one that has waited longest (and at least sloCycles).
+        int oldest = -1;
+        uint64_t oldestArrival = now - sloCycles;
+        for (size_t i = 0; i < levels.size(); i++) {
+            if (levels[i].numWaiting == 0)
+                continue;
+            uint64_t arrival = nextWaitingRpc(&levels[i]).rpc->arrivalTime;
+            if (arrival <= oldestArrival) {
+                oldest = downCast<int>(i);
+                oldestArrival = arrival;
+            }
+        }
+        if (oldest < 0)
+            return;
+
+        Level* level = &levels[oldest];
+        WaitingRpc waiting = popWaitingRpc(level);
+        rpcsWaiting--;
+        level->requestsRunning++;
+        assert(!idleThreads.empty());
+        Worker* worker = idleThreads.back();
+        idleThreads.pop_back();
+        worker->opcode = waiting.opcode;
+        worker->level = oldest;
+        worker->requestBytes = waiting.rpc->requestPayload.size();
+        worker->handoff(waiting.rpc);
+        worker->busyIndex = downCast<int>(busyThreads.size());
+        busyThreads.push_back(worker);
+        numBusyThreads = downCast<uint32_t>(busyThreads.size());
+        timeTrace("started late RPC with opcode %d", waiting.opcode);
+    }
+}
+
 /**
  * Wait for an RPC request to appear in the testRpcs queue, but give up if
  * it takes too long.  This method is intended only for testing (it only
@@ -417,6 +907,7 @@ WorkerManager::workerMain(Worker* worker)
                     int expected = Worker::POLLING;
                     if (worker->state.compareExchange(expected,
                                                       Worker::SLEEPING)) {
+                        uint64_t sleepStart = Cycles::rdtsc();
                         if (sys->futexWait(
                                 reinterpret_cast<int*>(&worker->state),
                                 Worker::SLEEPING) == -1) {
@@ -429,6 +920,8 @@ WorkerManager::workerMain(Worker* worker)
                                     strerror(errno));
                             }
                         }
+                        PerfStats::threadStats.workerSleepCycles +=
+                                Cycles::rdtsc() - sleepStart;
                     }
                     timeTrace("worker thread %d waking", worker->threadId);
                 }
@@ -440,12 +933,40 @@ WorkerManager::workerMain(Worker* worker)
             timeTrace("worker thread %d received opcode %d", worker->threadId,
                     worker->opcode);
 
-            worker->rpc->epoch = LogProtector::getCurrentEpoch();
+            // The dispatch thread may reuse the worker's fields as soon as
+            // the RPC is passed back, so save what's needed for statistics.
+            uint64_t serviceStart = Cycles::rdtsc();
+            uint64_t arrivalTime = worker->rpc->arrivalTime;
+            WireFormat::Opcode opcode = worker->opcode;
+
+            // If the request belongs to a sampled trace, record its
+            // progress and make any RPCs issued on its behalf join the
+            // trace. (handleRpc has already checked that the header exists.)
+            WireFormat::RequestCommon header = *worker->rpc->requestPayload.
+                    getStart<WireFormat::RequestCommon>();
+            Tub<RpcTrace::Scope> traceScope;
+            if (expect_false(header.traceId != 0)) {
+                RpcTrace::recordEvent(&header, RpcTrace::ARRIVE, arrivalTime);
+                RpcTrace::recordEvent(&header, RpcTrace::START, serviceStart);
+                uint32_t traceId = header.traceId;
+                uint32_t spanId = header.spanId;
+                traceScope.construct(traceId, spanId);
+            }
+
+            worker->rpc->logProtectorPin.acquire();
             Service::Rpc rpc(worker, &worker->rpc->requestPayload,
                     &worker->rpc->replyPayload);
+            bool cacheSampled = RpcCacheStats::startSample();
             Service::handleRpc(worker->context, &rpc);
+            if (expect_false(cacheSampled))
+                RpcCacheStats::finishSample(opcode);
+            if (expect_false(header.traceId != 0)) {
+                traceScope.destroy();
+                RpcTrace::recordEvent(&header, RpcTrace::FINISH);
+            }
 
             // Pass the RPC back to the dispatch thread for completion.
+            worker->serviceCycles = Cycles::rdtsc() - serviceStart;
             Fence::leave();
             worker->state.store(Worker::POLLING);
             timeTrace("worker thread %d completed opcode %d; "
@@ -455,6 +976,10 @@ WorkerManager::workerMain(Worker* worker)
             // Update performance statistics.
             uint64_t current = Cycles::rdtsc();
             PerfStats::threadStats.workerActiveCycles += (current - lastIdle);
+            RpcLatencyStats::record(opcode, serviceStart - arrivalTime,
+                    current - serviceStart);
+            TableUsageStats::finishRequest(current - serviceStart,
+                    serviceStart - arrivalTime);
             lastIdle = current;
         }
         TEST_LOG("exiting");
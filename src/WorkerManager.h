@@ -16,7 +16,9 @@
 #ifndef RAMCLOUD_WORKERMANAGER_H
 #define RAMCLOUD_WORKERMANAGER_H
 
+#include <deque>
 #include <queue>
+#include <unordered_map>
 
 #include "Dispatch.h"
 #include "Service.h"
@@ -41,28 +43,131 @@ class WorkerManager : Dispatch::Poller {
 
     void exitWorker();
     void handleRpc(Transport::ServerRpc* rpc);
+    bool canSleep();
+    uint32_t getIdleCores();
     bool idle();
     static void init();
     int poll();
     void setServerId(ServerId serverId);
     Transport::ServerRpc* waitForRpc(double timeoutSeconds);
+    static bool parseTenantWeights(const string& spec,
+            std::unordered_map<uint64_t, int>* weights);
 
-  PROTECTED:
-  static inline void timeTrace(const char* format,
-        uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0,
-        uint32_t arg3 = 0);
 
     /// How many microseconds worker threads should remain in their polling
     /// loop waiting for work. If no new arrives during this period the
     /// worker thread will put itself to sleep, which releases its core but
     /// will result in additional delay for the next RPC while it wakes up.
-    /// The value of this variable is typically not modified except during
-    /// testing.
+    /// Servers set this from the --workerSpinMicros option; it must be set
+    /// before the WorkerManager is constructed.
     static int pollMicros;
 
+    /// Number of worker threads, beyond maxCores, that may be used to start
+    /// requests that have waited longer than #sloMicros. 0 means the core
+    /// limit is never exceeded for this reason. Servers set this from the
+    /// --workerBurstCores option; it must be set before the WorkerManager
+    /// is constructed.
+    static int burstCores;
+
+    /// Once a waiting request has been queued for this many microseconds,
+    /// it may be started on one of the #burstCores extra threads.
+    static int sloMicros;
+
+    /// Waiting requests are started shortest first (based on the measured
+    /// service times of recent requests with the same opcode), but no
+    /// request is passed over in favor of requests that arrived more than
+    /// this many microseconds after it. 0 means requests at each level
+    /// are started in arrival order.
+    static int maxDeferMicros;
+
+    /// Short, non-blocking requests (small reads, GET_SERVER_ID) are
+    /// executed directly in the dispatch thread, skipping the handoff to a
+    /// worker, if no requests are waiting and the dispatch thread has spent
+    /// less than this many nanoseconds on such requests in the current
+    /// pass through its polling loop. 0 disables inline execution. Servers
+    /// set this from the --workerInlineNanos option; it must be set before
+    /// the WorkerManager is constructed.
+    static int inlineNanos;
+
+    /// Once this many requests are waiting for a worker, new master
+    /// requests are rejected with STATUS_RETRY, telling the client how
+    /// long the queue ahead of it should take to drain, instead of being
+    /// queued behind them. 0 means requests are always queued. Servers set
+    /// this from the --workerMaxQueue option.
+    static int maxQueuedRpcs;
+
+    /// If nonzero, the requests waiting at each level are shared out among
+    /// tenants (the tables they are for) by deficit round robin: in each
+    /// round, a tenant may start requests until their expected service
+    /// time adds up to this many microseconds times the tenant's weight,
+    /// so that one tenant's burst of slow requests (a batch job's
+    /// multiReads) can't hold up everyone else's. 0 means all requests at
+    /// a level share one queue. Servers set this from the
+    /// --workerTenantQuantumMicros option; it must be set before the
+    /// WorkerManager is constructed.
+    static int tenantQuantumMicros;
+
+    /// Weight of each tenant, by table id, for #tenantQuantumMicros;
+    /// tenants that aren't listed have weight 1. Servers set this from the
+    /// --workerTenantWeights option.
+    static std::unordered_map<uint64_t, int> tenantWeights;
+
+  PROTECTED:
+  static inline void timeTrace(const char* format,
+        uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0,
+        uint32_t arg3 = 0);
+
     /// Shared RAMCloud information.
     Context* context;
 
+    // A request that is waiting for a worker thread.
+    struct WaitingRpc {
+        /// Requests with smaller values start first: the arrival time plus
+        /// a penalty that grows with the request's expected service time
+        /// (at most maxDeferCycles).
+        uint64_t priority;
+
+        /// Breaks ties in #priority in favor of earlier arrivals.
+        uint64_t sequence;
+
+        /// The request and its opcode.
+        Transport::ServerRpc* rpc;
+        WireFormat::Opcode opcode;
+
+        /// Expected service time of the request (see estimateCycles).
+        uint64_t cycles;
+
+        bool operator>(const WaitingRpc& other) const
+        {
+            return (priority > other.priority) ||
+                    ((priority == other.priority) &&
+                    (sequence > other.sequence));
+        }
+    };
+
+    // The requests of one tenant (see #tenantQuantumMicros) that are
+    // waiting at a particular level.
+    struct Tenant {
+        Tenant()
+            : waitingRpcs()
+            , deficit(0)
+        {}
+
+        /// Requests that cannot execute until a thread becomes available,
+        /// in the order they should start.
+        std::priority_queue<WaitingRpc, std::vector<WaitingRpc>,
+                std::greater<WaitingRpc>> waitingRpcs;
+
+        /// Expected service time, in Cycles::rdtsc ticks, that the tenant's
+        /// requests may still use up in its current round; the tenant's
+        /// turn ends once this is no longer positive.
+        int64_t deficit;
+    };
+
+    // Tenant id of requests that aren't for any table, and of all requests
+    // if tenantQuantumMicros is 0.
+    enum : uint64_t { NO_TENANT = ~0UL };
+
     // This class (along with the levels variable) stores information
     // for each of the levels defined by RpcLevel; if we run low on threads
     // for servicing RPCs, we queue RPCs according to their level.
@@ -70,19 +175,46 @@ class WorkerManager : Dispatch::Poller {
       public:
         int requestsRunning;           /// The number of RPCs at this level
                                        /// that are currently executing.
-        std::queue<Transport::ServerRpc*> waitingRpcs;
+        std::unordered_map<uint64_t, Tenant> tenants;
                                        /// Requests that cannot execute until
-                                       /// a thread becomes available.
+                                       /// a thread becomes available, by
+                                       /// tenant. Tenants are removed once
+                                       /// none of their requests wait.
+        std::deque<uint64_t> activeTenants;
+                                       /// Ids of the tenants in #tenants, in
+                                       /// the round-robin order in which they
+                                       /// get to start requests; the front
+                                       /// one's turn is under way.
+        size_t numWaiting;             /// Total number of requests waiting
+                                       /// in #tenants.
         explicit Level()
             : requestsRunning(0)
-            , waitingRpcs()
+            , tenants()
+            , activeTenants()
+            , numWaiting(0)
         {}
     };
     std::vector<Level> levels;
 
+    // Recent service times of one opcode, used to predict how long a
+    // waiting request will take. Both values are exponentially weighted
+    // moving averages; 0 means no request with the opcode has completed.
+    struct OpcodeCost {
+        /// Time a worker took to execute a request, in Cycles::rdtsc ticks.
+        uint64_t cycles;
+
+        /// Size of a request message, in bytes.
+        uint64_t requestBytes;
+    };
+    std::vector<OpcodeCost> opcodeCosts;
+
     // Worker threads that are currently executing RPCs (no particular order).
     std::vector<Worker*> busyThreads;
 
+    // Number of elements in busyThreads; unlike the vector, this may be
+    // read by threads other than the dispatch thread (see getIdleCores).
+    std::atomic<uint32_t> numBusyThreads;
+
     // Worker threads that are available to execute incoming RPCs.  Threads
     // are push_back'ed and pop_back'ed (the thread with highest index was
     // the last one to go idle, so it's most likely to be POLLING and thus
@@ -97,6 +229,34 @@ class WorkerManager : Dispatch::Poller {
     // Total number of RPCs (across all Levels) in waitingRpcs queues.
     int rpcsWaiting;
 
+    // Bounds on the retry delay suggested to clients whose requests are
+    // rejected by shedRpc.
+    enum {
+        MIN_SHED_DELAY_MICROS = 1,
+        MAX_SHED_DELAY_MICROS = 10000,
+    };
+
+    // Value for the sequence field of the next WaitingRpc.
+    uint64_t nextSequence;
+
+    // sloMicros and maxDeferMicros in Cycles::rdtsc ticks.
+    uint64_t sloCycles;
+    uint64_t maxDeferCycles;
+
+    // inlineNanos in Cycles::rdtsc ticks.
+    uint64_t inlineCycles;
+
+    // tenantQuantumMicros in Cycles::rdtsc ticks.
+    uint64_t tenantQuantumCycles;
+
+    // Dispatch::currentTime of the polling pass in which inlineCyclesUsed
+    // was accumulated.
+    uint64_t inlinePollTime;
+
+    // Time spent executing requests inline during the current pass through
+    // the dispatch loop.
+    uint64_t inlineCyclesUsed;
+
     // Nonzero means save incoming RPCs rather than executing them.
     // Intended for use in unit tests only.
     int testingSaveRpcs;
@@ -105,6 +265,26 @@ class WorkerManager : Dispatch::Poller {
     // queued here, not sent to workers.
     std::queue<Transport::ServerRpc*> testRpcs;
 
+    // Dispatch activity profiler counters for the time the dispatch thread
+    // spends on each opcode (handing requests off and sending replies),
+    // indexed by opcode.
+    std::vector<Dispatch::ActivityCounter*> opcodeActivity;
+
+    void deferRpc(Transport::ServerRpc* rpc, WireFormat::Opcode opcode,
+            int level);
+    uint64_t estimateCycles(WireFormat::Opcode opcode, uint32_t requestBytes);
+    int64_t getQuantum(uint64_t tenantId);
+    uint64_t getTenant(Transport::ServerRpc* rpc, WireFormat::Opcode opcode);
+    const WaitingRpc& nextWaitingRpc(Level* level);
+    WaitingRpc popWaitingRpc(Level* level);
+    void recordCost(WireFormat::Opcode opcode, uint64_t serviceCycles,
+            uint32_t requestBytes);
+    bool runInline(Transport::ServerRpc* rpc,
+            const WireFormat::RequestCommon* header);
+    void sendReply(Transport::ServerRpc* rpc);
+    bool shedRpc(Transport::ServerRpc* rpc,
+            const WireFormat::RequestCommon* header);
+    void startLateRpcs();
     static void workerMain(Worker* worker);
     static Syscall *sys;
 
@@ -138,6 +318,10 @@ class Worker {
                                        /// then.
     WireFormat::Opcode opcode;         /// Opcode value from most recent RPC.
     int level;                         /// RpcLevel of most recent RPC.
+    uint32_t requestBytes;             /// Request size of most recent RPC.
+    uint64_t serviceCycles;            /// Time the worker spent executing
+                                       /// its most recent RPC; valid once
+                                       /// it has left the WORKING state.
     Transport::ServerRpc* rpc;         /// RPC being serviced by this worker.
                                        /// NULL means the last RPC given to
                                        /// the worker has been finished and a
@@ -190,6 +374,8 @@ class Worker {
             , threadId(0)
             , opcode(WireFormat::Opcode::ILLEGAL_RPC_TYPE)
             , level(0)
+            , requestBytes(0)
+            , serviceCycles(0)
             , rpc(NULL)
             , busyIndex(-1)
             , state(POLLING)
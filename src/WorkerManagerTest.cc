@@ -151,7 +151,7 @@ TEST_F(WorkerManagerTest, handleRpc_noHeader) {
 TEST_F(WorkerManagerTest, handleRpc_badOpcode) {
     TestLog::Enable _;
     MockTransport::MockServerRpc* rpc = new MockTransport::MockServerRpc(
-            &transport, "0x10100");
+            &transport, "0x10100 0 0");
     manager->handleRpc(rpc);
     EXPECT_EQ("handleRpc: Incoming RPC contained unknown opcode 256",
             TestLog::get());
@@ -162,9 +162,9 @@ TEST_F(WorkerManagerTest, handleRpc_badOpcode) {
 TEST_F(WorkerManagerTest, handleRpc_deferRpc) {
     // Create 2 RPCs that can be scheduled.
     MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 1");
+            &transport, "0x10002 1 0");
     MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 2");
+            &transport, "0x10002 2 0");
     manager->handleRpc(rpc1);
     manager->handleRpc(rpc2);
     EXPECT_EQ(2U, manager->busyThreads.size());
@@ -173,7 +173,7 @@ TEST_F(WorkerManagerTest, handleRpc_deferRpc) {
     // We're now past the maxCores limit, but this RPC gets scheduled
     // because it has a low level that isn't currently executing an RPC.
     MockTransport::MockServerRpc* rpc3 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 3");
+            &transport, "0x10000 3 0");
     manager->handleRpc(rpc3);
     EXPECT_EQ(3U, manager->busyThreads.size());
     EXPECT_EQ(1, manager->levels[0].requestsRunning);
@@ -181,18 +181,47 @@ TEST_F(WorkerManagerTest, handleRpc_deferRpc) {
     // The next RPC doesn't get scheduled because there's already an
     // RPC executing with a lower level.
     MockTransport::MockServerRpc* rpc4 = new MockTransport::MockServerRpc(
-            &transport, "0x10001 4");
+            &transport, "0x10001 4 0");
     manager->handleRpc(rpc4);
     EXPECT_EQ(3U, manager->busyThreads.size());
-    EXPECT_EQ(1U, manager->levels[1].waitingRpcs.size());
+    EXPECT_EQ(1U, manager->levels[1].numWaiting);
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
 }
 
+TEST_F(WorkerManagerTest, handleRpc_shedRpc) {
+    WorkerManager::maxQueuedRpcs = 1;
+    manager->handleRpc(new MockTransport::MockServerRpc(
+            &transport, "0x10002 1 0"));
+    manager->handleRpc(new MockTransport::MockServerRpc(
+            &transport, "0x10002 2 0"));
+    manager->handleRpc(new MockTransport::MockServerRpc(
+            &transport, "0x10002 3 0"));
+    EXPECT_EQ(1, manager->rpcsWaiting);
+
+    // The queue is full: a master request is turned away...
+    manager->handleRpc(new MockTransport::MockServerRpc(
+            &transport, "0x2 4 0"));
+    EXPECT_EQ(1, manager->rpcsWaiting);
+    EXPECT_STREQ("STATUS_RETRY", statusToSymbol(transport.status));
+    const WireFormat::RetryResponse* response =
+            transport.output.back().second.getStart<
+            WireFormat::RetryResponse>();
+    ASSERT_TRUE(response != NULL);
+    EXPECT_LE(1u, response->minDelayMicros);
+    EXPECT_EQ(2 * response->minDelayMicros, response->maxDelayMicros);
+
+    // ...but others are still queued.
+    manager->handleRpc(new MockTransport::MockServerRpc(
+            &transport, "0x10002 5 0"));
+    EXPECT_EQ(2, manager->rpcsWaiting);
+    WorkerManager::maxQueuedRpcs = 0;
+}
+
 TEST_F(WorkerManagerTest, handleRpc_handoffToWorker) {
     MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 1");
+            &transport, "0x10000 1 0");
     MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 2");
+            &transport, "0x10000 2 0");
     manager->handleRpc(rpc1);
     manager->handleRpc(rpc2);
     waitUntilDone(2);
@@ -200,6 +229,170 @@ TEST_F(WorkerManagerTest, handleRpc_handoffToWorker) {
     EXPECT_EQ(5U, manager->idleThreads.size());
 }
 
+TEST_F(WorkerManagerTest, deferRpc_shortRequestsFirst) {
+    manager->maxDeferCycles = 1000;
+    manager->opcodeCosts[WireFormat::READ].cycles = 100;
+    manager->opcodeCosts[WireFormat::MULTI_OP].cycles = 5000;
+    MockTransport::MockServerRpc slow(&transport, "0x10001 1 0");
+    MockTransport::MockServerRpc fast(&transport, "0x10001 2 0");
+    MockTransport::MockServerRpc late(&transport, "0x10001 3 0");
+    slow.arrivalTime = 10000;
+    fast.arrivalTime = 10500;
+    late.arrivalTime = 11200;
+
+    // The slow request's penalty is capped at maxDeferCycles, so it still
+    // goes ahead of short requests that arrive more than 1000 ticks later.
+    manager->deferRpc(&slow, WireFormat::MULTI_OP, 1);
+    manager->deferRpc(&fast, WireFormat::READ, 1);
+    manager->deferRpc(&late, WireFormat::READ, 1);
+    EXPECT_EQ(3, manager->rpcsWaiting);
+    WorkerManager::Level* level = &manager->levels[1];
+    ASSERT_EQ(3U, level->numWaiting);
+    WorkerManager::WaitingRpc waiting = manager->popWaitingRpc(level);
+    EXPECT_EQ(&fast, waiting.rpc);
+    EXPECT_EQ(WireFormat::READ, waiting.opcode);
+    EXPECT_EQ(&slow, manager->popWaitingRpc(level).rpc);
+    EXPECT_EQ(&late, manager->popWaitingRpc(level).rpc);
+    EXPECT_EQ(0U, level->numWaiting);
+    manager->rpcsWaiting = 0;
+}
+
+TEST_F(WorkerManagerTest, deferRpc_fairQueuing) {
+    manager->tenantQuantumCycles = 100;
+    manager->opcodeCosts[WireFormat::READ].cycles = 60;
+    WorkerManager::tenantWeights[5] = 2;
+    MockTransport::MockServerRpc* rpcs[9];
+    for (int i = 0; i < 9; i++) {
+        rpcs[i] = new MockTransport::MockServerRpc(&transport,
+                (i < 6) ? "13 0 0 5 0" : "13 0 0 6 0");
+        rpcs[i]->arrivalTime = i;
+        manager->deferRpc(rpcs[i], WireFormat::READ, 1);
+    }
+    WorkerManager::Level* level = &manager->levels[1];
+    EXPECT_EQ(9U, level->numWaiting);
+    EXPECT_EQ(2U, level->activeTenants.size());
+
+    // Table 5 gets twice as long a turn as table 6. Once it has the level
+    // to itself, a table runs without being charged.
+    string order;
+    while (level->numWaiting > 0) {
+        WorkerManager::WaitingRpc waiting = manager->popWaitingRpc(level);
+        order += format("%lu ", waiting.rpc->arrivalTime);
+    }
+    EXPECT_EQ("0 1 2 3 6 7 4 5 8 ", order);
+    EXPECT_EQ(0U, level->tenants.size());
+    EXPECT_EQ(0U, level->activeTenants.size());
+
+    manager->rpcsWaiting = 0;
+    WorkerManager::tenantWeights.clear();
+    for (int i = 0; i < 9; i++)
+        delete rpcs[i];
+}
+
+TEST_F(WorkerManagerTest, getTenant) {
+    MockTransport::MockServerRpc read(&transport, "13 0 0 5 0");
+    MockTransport::MockServerRpc multiRead(&transport, "25 0 0 2 1 9 0");
+    MockTransport::MockServerRpc ping(&transport, "7 0 0 5 0");
+    MockTransport::MockServerRpc shortRead(&transport, "13 0 0");
+    uint64_t none = WorkerManager::NO_TENANT;
+
+    // Fair queuing is disabled.
+    EXPECT_EQ(none, manager->getTenant(&read, WireFormat::READ));
+
+    manager->tenantQuantumCycles = 100;
+    EXPECT_EQ(5U, manager->getTenant(&read, WireFormat::READ));
+    EXPECT_EQ(9U, manager->getTenant(&multiRead, WireFormat::MULTI_OP));
+    EXPECT_EQ(none, manager->getTenant(&ping, WireFormat::PING));
+    EXPECT_EQ(none, manager->getTenant(&shortRead, WireFormat::READ));
+}
+
+TEST_F(WorkerManagerTest, parseTenantWeights) {
+    std::unordered_map<uint64_t, int> weights;
+    EXPECT_TRUE(WorkerManager::parseTenantWeights("", &weights));
+    EXPECT_EQ(0U, weights.size());
+    EXPECT_TRUE(WorkerManager::parseTenantWeights("5:4,7:2", &weights));
+    EXPECT_EQ(2U, weights.size());
+    EXPECT_EQ(4, weights[5]);
+    EXPECT_EQ(2, weights[7]);
+
+    EXPECT_FALSE(WorkerManager::parseTenantWeights("5:4,7", &weights));
+    EXPECT_FALSE(WorkerManager::parseTenantWeights("5:0", &weights));
+    EXPECT_FALSE(WorkerManager::parseTenantWeights("5:4x", &weights));
+}
+
+TEST_F(WorkerManagerTest, estimateCycles) {
+    EXPECT_EQ(0U, manager->estimateCycles(WireFormat::READ, 100));
+    manager->opcodeCosts[WireFormat::READ].cycles = 1000;
+    manager->opcodeCosts[WireFormat::READ].requestBytes = 100;
+    EXPECT_EQ(1000U, manager->estimateCycles(WireFormat::READ, 50));
+    EXPECT_EQ(1000U, manager->estimateCycles(WireFormat::READ, 100));
+    EXPECT_EQ(3000U, manager->estimateCycles(WireFormat::READ, 300));
+}
+
+TEST_F(WorkerManagerTest, recordCost) {
+    manager->recordCost(WireFormat::READ, 1600, 160);
+    EXPECT_EQ(1600U, manager->opcodeCosts[WireFormat::READ].cycles);
+    EXPECT_EQ(160U, manager->opcodeCosts[WireFormat::READ].requestBytes);
+
+    manager->recordCost(WireFormat::READ, 3200, 0);
+    EXPECT_EQ(1700U, manager->opcodeCosts[WireFormat::READ].cycles);
+    EXPECT_EQ(150U, manager->opcodeCosts[WireFormat::READ].requestBytes);
+
+    manager->recordCost(WireFormat::PING, 0, 0);
+    EXPECT_EQ(1U, manager->opcodeCosts[WireFormat::PING].cycles);
+}
+
+TEST_F(WorkerManagerTest, runInline) {
+    context.services[WireFormat::MASTER_SERVICE] = &service;
+    manager->inlineCycles = Cycles::fromSeconds(1);
+
+    // The first read goes to a worker, since its cost isn't known yet.
+    manager->handleRpc(new MockTransport::MockServerRpc(&transport,
+            "0xd 1 0"));
+    EXPECT_EQ(1U, manager->busyThreads.size());
+    waitUntilDone(1);
+    manager->poll();
+    EXPECT_NE(0U, manager->opcodeCosts[WireFormat::READ].cycles);
+
+    // Now reads run in the dispatch thread.
+    transport.outputLog.clear();
+    manager->handleRpc(new MockTransport::MockServerRpc(&transport,
+            "0xd 2 0"));
+    EXPECT_EQ(0U, manager->busyThreads.size());
+    EXPECT_NE("", transport.outputLog);
+
+    // Other opcodes and services still go to workers.
+    manager->opcodeCosts[WireFormat::WRITE].cycles = 1;
+    manager->handleRpc(new MockTransport::MockServerRpc(&transport,
+            "0xe 3 0"));
+    manager->handleRpc(new MockTransport::MockServerRpc(&transport,
+            "0x1000d 4 0"));
+    EXPECT_EQ(2U, manager->busyThreads.size());
+    waitUntilDone(2);
+    manager->poll();
+
+    // So do reads once the budget for this polling pass is used up.
+    manager->inlinePollTime = context.dispatch->currentTime;
+    manager->inlineCyclesUsed = manager->inlineCycles;
+    manager->handleRpc(new MockTransport::MockServerRpc(&transport,
+            "0xd 5 0"));
+    EXPECT_EQ(1U, manager->busyThreads.size());
+    waitUntilDone(1);
+    manager->poll();
+    context.services[WireFormat::MASTER_SERVICE] = NULL;
+}
+
+TEST_F(WorkerManagerTest, canSleep) {
+    EXPECT_TRUE(manager->canSleep());
+    MockTransport::MockServerRpc* rpc = new MockTransport::MockServerRpc(
+            &transport, "0x10000 3 4");
+    manager->handleRpc(rpc);
+    EXPECT_FALSE(manager->canSleep());
+    waitUntilDone(1);
+    manager->poll();
+    EXPECT_TRUE(manager->canSleep());
+}
+
 TEST_F(WorkerManagerTest, idle) {
     EXPECT_TRUE(manager->idle());
     // Start one RPC.
@@ -218,20 +411,20 @@ TEST_F(WorkerManagerTest, poll_scheduleWaitingRpcs) {
     // Start 2 RPCs concurrently, with 2 more waiting.
     service.gate = -1;
     MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 1");
+            &transport, "0x10000 1 0");
     MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 2");
+            &transport, "0x10000 2 0");
     MockTransport::MockServerRpc* rpc3 = new MockTransport::MockServerRpc(
-            &transport, "0x10001 3");
+            &transport, "0x10001 3 0");
     MockTransport::MockServerRpc* rpc4 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 4");
+            &transport, "0x10002 4 0");
     manager->handleRpc(rpc1);
     manager->handleRpc(rpc2);
     manager->handleRpc(rpc3);
     manager->handleRpc(rpc4);
     EXPECT_EQ(2, manager->levels[0].requestsRunning);
-    EXPECT_EQ(1U, manager->levels[1].waitingRpcs.size());
-    EXPECT_EQ(1U, manager->levels[2].waitingRpcs.size());
+    EXPECT_EQ(1U, manager->levels[1].numWaiting);
+    EXPECT_EQ(1U, manager->levels[2].numWaiting);
 
     // Allow the original requests to complete, and make sure that the
     // remaining 2 start service in the right order (e.g., the level
@@ -241,16 +434,16 @@ TEST_F(WorkerManagerTest, poll_scheduleWaitingRpcs) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(1, manager->levels[0].requestsRunning);
     EXPECT_EQ(1, manager->levels[1].requestsRunning);
-    EXPECT_EQ(0U, manager->levels[1].waitingRpcs.size());
-    EXPECT_EQ("serverReply: 0x10001 2", transport.outputLog);
+    EXPECT_EQ(0U, manager->levels[1].numWaiting);
+    EXPECT_EQ("serverReply: 0x10001 2 1", transport.outputLog);
     EXPECT_EQ(1, manager->rpcsWaiting);
     service.gate = 2;
     waitUntilDone(1);
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(0, manager->levels[0].requestsRunning);
     EXPECT_EQ(1, manager->levels[2].requestsRunning);
-    EXPECT_EQ(0U, manager->levels[2].waitingRpcs.size());
-    EXPECT_EQ("serverReply: 0x10001 2 | serverReply: 0x10001 3",
+    EXPECT_EQ(0U, manager->levels[2].numWaiting);
+    EXPECT_EQ("serverReply: 0x10001 2 1 | serverReply: 0x10001 3 1",
             transport.outputLog);
 
     // Allow the remaining requests to complete.
@@ -260,7 +453,7 @@ TEST_F(WorkerManagerTest, poll_scheduleWaitingRpcs) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
     EXPECT_EQ(0, manager->levels[2].requestsRunning);
-    EXPECT_EQ("serverReply: 0x10003 5 | serverReply: 0x10002 4",
+    EXPECT_EQ("serverReply: 0x10003 5 1 | serverReply: 0x10002 4 1",
             transport.outputLog);
 
     // There should be nothing left to do now.
@@ -273,13 +466,13 @@ TEST_F(WorkerManagerTest, poll_avoidDeadlock) {
     // Start 2 RPCs at level 2 then 1 at level 0
     service.gate = -1;
     MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 1");
+            &transport, "0x10002 1 0");
     MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 2");
+            &transport, "0x10002 2 0");
     MockTransport::MockServerRpc* rpc3 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 3");
+            &transport, "0x10000 3 0");
     MockTransport::MockServerRpc* rpc4 = new MockTransport::MockServerRpc(
-            &transport, "0x10001 4");
+            &transport, "0x10001 4 0");
     manager->handleRpc(rpc1);
     manager->handleRpc(rpc2);
     manager->handleRpc(rpc3);
@@ -287,7 +480,7 @@ TEST_F(WorkerManagerTest, poll_avoidDeadlock) {
     EXPECT_EQ(1, manager->levels[0].requestsRunning);
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
     EXPECT_EQ(2, manager->levels[2].requestsRunning);
-    EXPECT_EQ(1U, manager->levels[1].waitingRpcs.size());
+    EXPECT_EQ(1U, manager->levels[1].numWaiting);
 
     // Allow rpc3 (level 0) to complete, and make sure rpc4 (level 1) starts.
     service.gate = 3;
@@ -295,8 +488,8 @@ TEST_F(WorkerManagerTest, poll_avoidDeadlock) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(0, manager->levels[0].requestsRunning);
     EXPECT_EQ(1, manager->levels[1].requestsRunning);
-    EXPECT_EQ(0U, manager->levels[1].waitingRpcs.size());
-    EXPECT_EQ("serverReply: 0x10001 4", transport.outputLog);
+    EXPECT_EQ(0U, manager->levels[1].numWaiting);
+    EXPECT_EQ("serverReply: 0x10001 4 1", transport.outputLog);
     EXPECT_EQ(0, manager->rpcsWaiting);
 
     // Allow the remaining requests to complete.
@@ -306,8 +499,8 @@ TEST_F(WorkerManagerTest, poll_avoidDeadlock) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
     EXPECT_EQ(0, manager->levels[2].requestsRunning);
-    EXPECT_EQ("serverReply: 0x10002 5 | serverReply: 0x10003 3 | "
-            "serverReply: 0x10003 2",
+    EXPECT_EQ("serverReply: 0x10002 5 1 | serverReply: 0x10003 3 1 | "
+            "serverReply: 0x10003 2 1",
             transport.outputLog);
 
     // There should be nothing left to do now.
@@ -320,13 +513,13 @@ TEST_F(WorkerManagerTest, poll_coreLimit) {
     // Start 2 RPCs at level 2 then 1 at level 0
     service.gate = -1;
     MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 1");
+            &transport, "0x10002 1 0");
     MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
-            &transport, "0x10002 2");
+            &transport, "0x10002 2 0");
     MockTransport::MockServerRpc* rpc3 = new MockTransport::MockServerRpc(
-            &transport, "0x10000 3");
+            &transport, "0x10000 3 0");
     MockTransport::MockServerRpc* rpc4 = new MockTransport::MockServerRpc(
-            &transport, "0x10001 4");
+            &transport, "0x10001 4 0");
     manager->handleRpc(rpc1);
     manager->handleRpc(rpc2);
     manager->handleRpc(rpc3);
@@ -334,7 +527,7 @@ TEST_F(WorkerManagerTest, poll_coreLimit) {
     EXPECT_EQ(1, manager->levels[0].requestsRunning);
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
     EXPECT_EQ(2, manager->levels[2].requestsRunning);
-    EXPECT_EQ(1U, manager->levels[1].waitingRpcs.size());
+    EXPECT_EQ(1U, manager->levels[1].numWaiting);
 
     // Allow rpc1 (level 2) to complete, and make sure rpc4 (level 1)
     // doesn't start.
@@ -343,8 +536,8 @@ TEST_F(WorkerManagerTest, poll_coreLimit) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(1, manager->levels[0].requestsRunning);
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
-    EXPECT_EQ(1U, manager->levels[1].waitingRpcs.size());
-    EXPECT_EQ("serverReply: 0x10003 2", transport.outputLog);
+    EXPECT_EQ(1U, manager->levels[1].numWaiting);
+    EXPECT_EQ("serverReply: 0x10003 2 1", transport.outputLog);
     EXPECT_EQ(1, manager->rpcsWaiting);
 
     // Finish rpc2 (level 2): now rpc4 should be able to start.
@@ -354,8 +547,8 @@ TEST_F(WorkerManagerTest, poll_coreLimit) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(1, manager->levels[0].requestsRunning);
     EXPECT_EQ(1, manager->levels[1].requestsRunning);
-    EXPECT_EQ(0U, manager->levels[1].waitingRpcs.size());
-    EXPECT_EQ("serverReply: 0x10003 3", transport.outputLog);
+    EXPECT_EQ(0U, manager->levels[1].numWaiting);
+    EXPECT_EQ("serverReply: 0x10003 3 1", transport.outputLog);
     EXPECT_EQ(0, manager->rpcsWaiting);
 
     // Allow the remaining requests to complete.
@@ -365,13 +558,56 @@ TEST_F(WorkerManagerTest, poll_coreLimit) {
     EXPECT_EQ(1, manager->poll());
     EXPECT_EQ(0, manager->levels[1].requestsRunning);
     EXPECT_EQ(0, manager->levels[2].requestsRunning);
-    EXPECT_EQ("serverReply: 0x10002 5 | serverReply: 0x10001 4",
+    EXPECT_EQ("serverReply: 0x10002 5 1 | serverReply: 0x10001 4 1",
             transport.outputLog);
 
     // There should be nothing left to do now.
     EXPECT_EQ(0, manager->poll());
 }
 
+TEST_F(WorkerManagerTest, poll_startLateRpcs) {
+    int savedBurstCores = WorkerManager::burstCores;
+    WorkerManager::burstCores = 2;
+    manager->sloCycles = Cycles::fromSeconds(1000);
+
+    // Same setup as poll_coreLimit: rpc4 (level 1) has to wait.
+    service.gate = -1;
+    MockTransport::MockServerRpc* rpc1 = new MockTransport::MockServerRpc(
+            &transport, "0x10002 1 0");
+    MockTransport::MockServerRpc* rpc2 = new MockTransport::MockServerRpc(
+            &transport, "0x10002 2 0");
+    MockTransport::MockServerRpc* rpc3 = new MockTransport::MockServerRpc(
+            &transport, "0x10000 3 0");
+    MockTransport::MockServerRpc* rpc4 = new MockTransport::MockServerRpc(
+            &transport, "0x10001 4 0");
+    manager->handleRpc(rpc1);
+    manager->handleRpc(rpc2);
+    manager->handleRpc(rpc3);
+    manager->handleRpc(rpc4);
+    EXPECT_EQ(3U, manager->busyThreads.size());
+    EXPECT_EQ(1, manager->rpcsWaiting);
+
+    // It hasn't waited past the SLO yet.
+    manager->poll();
+    EXPECT_EQ(1, manager->rpcsWaiting);
+    EXPECT_EQ(0, manager->levels[1].requestsRunning);
+
+    // Now it has, so it runs on a burst thread.
+    manager->sloCycles = 0;
+    manager->poll();
+    EXPECT_EQ(0, manager->rpcsWaiting);
+    EXPECT_EQ(1, manager->levels[1].requestsRunning);
+    EXPECT_EQ(4U, manager->busyThreads.size());
+    EXPECT_EQ(WireFormat::Opcode(1), manager->busyThreads[3]->opcode);
+
+    // Allow the requests to complete.
+    service.gate = 0;
+    waitUntilDone(4);
+    manager->poll();
+    EXPECT_EQ(0U, manager->busyThreads.size());
+    WorkerManager::burstCores = savedBurstCores;
+}
+
 TEST_F(WorkerManagerTest, poll_postprocessing) {
     // This test makes sure that the POSTPROCESSING state is handled
     // correctly (along with the subsequent POLLING state).
@@ -486,10 +722,10 @@ TEST_F(WorkerManagerTest, Worker_handoff_dontCallFutex) {
     // get called in the normal case.
     sys.futexWakeErrno = EPERM;
     manager->handleRpc(
-            new MockTransport::MockServerRpc(&transport, "0x10000 99"));
+            new MockTransport::MockServerRpc(&transport, "0x10000 99 0"));
     EXPECT_EQ("", TestLog::get());
     waitUntilDone(1);
-    EXPECT_EQ("rpc: 0x10000 99", service.log);
+    EXPECT_EQ("rpc: 0x10000 99 0", service.log);
 
     // Reset error so that the WorkerManager destructor can work
     // correctly.
@@ -515,10 +751,10 @@ TEST_F(WorkerManagerTest, Worker_handoff_callFutex) {
     // Issue an RPC and make sure it completes.
     transport.outputLog.clear();
     manager->handleRpc(
-            new MockTransport::MockServerRpc(&transport, "0x10000 99"));
+            new MockTransport::MockServerRpc(&transport, "0x10000 99 0"));
     waitUntilDone(1);
     manager->poll();
-    EXPECT_EQ("serverReply: 0x10001 100", transport.outputLog);
+    EXPECT_EQ("serverReply: 0x10001 100 1", transport.outputLog);
 }
 
 TEST_F(WorkerManagerTest, Worker_replySent) {
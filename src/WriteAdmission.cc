@@ -0,0 +1,189 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ClientException.h"
+#include "Cycles.h"
+#include "LogCleaner.h"
+#include "LogHealthMonitor.h"
+#include "MasterTableMetadata.h"
+#include "SegmentManager.h"
+#include "ShortMacros.h"
+#include "WriteAdmission.h"
+
+namespace RAMCloud {
+
+/**
+ * Construct a WriteAdmission; writes are admitted freely until the log's
+ * memory utilization is found to have reached \a startUtilization, or
+ * the point at which table quotas are enforced.
+ *
+ * \param segmentManager
+ *      Provides the memory utilization of the log.
+ * \param monitor
+ *      Provides the rate at which the cleaner frees memory.
+ * \param masterTableMetadata
+ *      Provides the number of bytes each table takes up in the log.
+ * \param startUtilization
+ *      Memory utilization, as a percentage, at which writes start to be
+ *      paced. 0 means writes are never paced.
+ * \param tableQuotaBytes
+ *      Most bytes of the log that any one table may take up once the
+ *      cleaner is running. 0 means tables have no quota.
+ */
+WriteAdmission::WriteAdmission(SegmentManager* segmentManager,
+        LogHealthMonitor* monitor, MasterTableMetadata* masterTableMetadata,
+        int startUtilization, uint64_t tableQuotaBytes)
+    : segmentManager(segmentManager)
+    , monitor(monitor)
+    , masterTableMetadata(masterTableMetadata)
+    , startUtilization(startUtilization)
+    , tableQuotaBytes(tableQuotaBytes)
+    , refreshTicks(Cycles::fromSeconds(REFRESH_SECONDS))
+    , mutex("WriteAdmission::mutex")
+    , lastRefresh(0)
+    , utilization(0)
+    , bytesPerSecond(MIN_BYTES_PER_SECOND)
+    , activeTables(1)
+    , buckets()
+{
+}
+
+/**
+ * Decide whether a write may go ahead now. This is called before a write
+ * is appended to the log.
+ *
+ * \param tableId
+ *      Table being written.
+ * \param bytes
+ *      Size of the new object.
+ * \throw RetryException
+ *      The write must wait: the table has used up its quota, or its share
+ *      of the memory the cleaner is freeing. In the latter case the delay
+ *      in the exception is how long it takes until the client may write
+ *      again.
+ */
+void
+WriteAdmission::admit(uint64_t tableId, uint32_t bytes)
+{
+    uint64_t now = Cycles::rdtsc();
+    if (now - lastRefresh >= refreshTicks) {
+        SpinLock::Guard _(mutex);
+        if (now - lastRefresh >= refreshTicks)
+            refresh(now);
+    }
+    if (tableQuotaBytes > 0 &&
+            utilization >= LogCleaner::MIN_MEMORY_UTILIZATION) {
+        checkQuota(tableId, bytes);
+    }
+    if (!isPacing(utilization))
+        return;
+
+    uint32_t waitMicros;
+    {
+        SpinLock::Guard _(mutex);
+        double share = bytesPerSecond / static_cast<double>(activeTables);
+        Bucket& bucket = buckets[tableId];
+        if (bucket.lastRefill == 0) {
+            bucket.credit = share * BURST_SECONDS;
+        } else if (now > bucket.lastRefill) {
+            bucket.credit = std::min(share * BURST_SECONDS, bucket.credit +
+                    share * Cycles::toSeconds(now - bucket.lastRefill));
+        }
+        bucket.lastRefill = std::max(now, bucket.lastRefill);
+        if (bucket.credit >= 0) {
+            bucket.credit -= bytes;
+            return;
+        }
+        waitMicros = downCast<uint32_t>(std::min(1e06,
+                -bucket.credit / share * 1e06)) + 1;
+    }
+    throw RetryException(HERE, waitMicros, 2 * waitMicros,
+            "log memory is nearly full; writes are being paced");
+}
+
+/**
+ * Helper for admit() that refuses a write which would take a table past
+ * its quota.
+ *
+ * \param tableId
+ *      Table being written.
+ * \param bytes
+ *      Size of the new object.
+ * \throw RetryException
+ *      The table has reached its quota. Its usage goes down as the cleaner
+ *      reclaims its dead entries, or as its objects are deleted.
+ */
+void
+WriteAdmission::checkQuota(uint64_t tableId, uint32_t bytes)
+{
+    MasterTableMetadata::Entry* entry = masterTableMetadata->find(tableId);
+    if (entry == NULL)
+        return;
+    uint64_t byteCount = entry->stats.getByteCount();
+    if (byteCount + bytes <= tableQuotaBytes)
+        return;
+    throw RetryException(HERE, 1000, 2000,
+            "table has used up its quota of log memory");
+}
+
+/**
+ * Reread the memory utilization and the cleaner's bandwidth, recompute the
+ * rate at which writes are admitted and forget tables that are no longer
+ * being written. The caller must hold #mutex.
+ *
+ * \param now
+ *      Cycles::rdtsc() of the write being admitted.
+ */
+void
+WriteAdmission::refresh(uint64_t now)
+{
+    int current = segmentManager->getMemoryUtilization();
+    if (!isPacing(current)) {
+        if (isPacing(utilization)) {
+            LOG(NOTICE, "Memory utilization %d%%: no longer pacing writes",
+                current);
+        }
+        buckets.clear();
+    } else {
+        if (!isPacing(utilization)) {
+            LOG(NOTICE, "Memory utilization %d%%: pacing writes to the "
+                "rate of cleaning", current);
+        }
+
+        // The closer the log is to full, the smaller the fraction of the
+        // cleaner's bandwidth that is handed out, so it can catch up.
+        double headroom = static_cast<double>(100 - current) /
+                static_cast<double>(std::max(1, 100 - startUtilization));
+        bytesPerSecond = monitor->getCleaningBandwidth() *
+                std::min(1.0, headroom);
+        if (bytesPerSecond < MIN_BYTES_PER_SECOND)
+            bytesPerSecond = MIN_BYTES_PER_SECOND;
+
+        uint64_t idleTicks = Cycles::fromSeconds(IDLE_SECONDS);
+        for (auto it = buckets.begin(); it != buckets.end(); ) {
+            if (now > it->second.lastRefill &&
+                    now - it->second.lastRefill > idleTicks) {
+                it = buckets.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+    activeTables = std::max(buckets.size(), size_t(1));
+    utilization = current;
+    lastRefresh = now;
+}
+
+} // namespace RAMCloud
@@ -0,0 +1,155 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_WRITEADMISSION_H
+#define RAMCLOUD_WRITEADMISSION_H
+
+#include <atomic>
+#include <unordered_map>
+
+#include "Common.h"
+#include "SpinLock.h"
+
+namespace RAMCloud {
+
+class LogHealthMonitor;
+class MasterTableMetadata;
+class SegmentManager;
+
+/**
+ * Paces writes to a master whose log memory is nearly full, so that clients
+ * slow down to the rate at which the cleaner is freeing memory instead of
+ * filling the log and then hammering the master with retries (Log::append
+ * refuses writes once the log is full, and the master returns STATUS_RETRY
+ * without a useful delay).
+ *
+ * Once memory utilization (SegmentManager::getMemoryUtilization) reaches
+ * a configured threshold, each table gets a token bucket that is refilled
+ * at an equal share of the rate the cleaner freed memory at in the last
+ * interval sampled by the LogHealthMonitor. The rate shrinks as utilization
+ * approaches 100%, so the cleaner gains on the writers. A write to a table
+ * that has used up its credit is refused with a RetryException whose delay
+ * is how long the table's bucket takes to pay off its debt, which tells the
+ * client when to come back rather than having it retry blindly.
+ *
+ * Tables can also be held to a quota, so that a single table can't fill
+ * the log and stall writes to all the others. A table's usage is the log
+ * space its entries take up according to TableStats, which includes
+ * versions that have been overwritten or deleted but not cleaned yet. The
+ * quota is therefore only enforced once utilization is high enough for the
+ * cleaner to be running (LogCleaner::MIN_MEMORY_UTILIZATION): a table at its
+ * quota can then write as fast as the cleaner frees up its garbage, while
+ * a table that merely hasn't been cleaned yet isn't turned away while the
+ * log has plenty of room.
+ *
+ * This class is thread-safe.
+ */
+class WriteAdmission {
+  PUBLIC:
+    WriteAdmission(SegmentManager* segmentManager, LogHealthMonitor* monitor,
+            MasterTableMetadata* masterTableMetadata, int startUtilization,
+            uint64_t tableQuotaBytes);
+    void admit(uint64_t tableId, uint32_t bytes);
+
+  PRIVATE:
+    void checkQuota(uint64_t tableId, uint32_t bytes);
+    void refresh(uint64_t now);
+
+    /**
+     * Returns true if writes are paced at the given memory utilization.
+     */
+    bool
+    isPacing(int utilization) const
+    {
+        return startUtilization > 0 && utilization >= startUtilization;
+    }
+
+    /// Credit for the writes to one table.
+    struct Bucket {
+        Bucket() : credit(0), lastRefill(0) {}
+
+        /// Bytes that may still be written before writes have to wait;
+        /// negative after a write larger than the remaining credit.
+        double credit;
+
+        /// Cycles::rdtsc() when credit was last added; also tells whether
+        /// the table has been written recently.
+        uint64_t lastRefill;
+    };
+
+    /// Utilization and cleaner bandwidth are reread at most this often, in
+    /// seconds, since both take locks elsewhere.
+    static constexpr double REFRESH_SECONDS = 0.001;
+
+    /// A table whose bucket hasn't been refilled for this many seconds no
+    /// longer counts towards the tables that share the rate.
+    static constexpr double IDLE_SECONDS = 1.0;
+
+    /// Most credit that can accrue, in seconds' worth of a table's rate.
+    static constexpr double BURST_SECONDS = 0.01;
+
+    /// Writes are admitted at no less than this many bytes per second in
+    /// total, so that they never stop entirely while the cleaner has not
+    /// reported any progress yet.
+    static constexpr double MIN_BYTES_PER_SECOND = 1e06;
+
+    /// Provides the memory utilization of the log.
+    SegmentManager* segmentManager;
+
+    /// Provides the rate at which the cleaner frees memory.
+    LogHealthMonitor* monitor;
+
+    /// Provides the number of bytes each table takes up in the log.
+    MasterTableMetadata* masterTableMetadata;
+
+    /// Memory utilization (a percentage) at which writes start to be paced;
+    /// 0 means they never are.
+    const int startUtilization;
+
+    /// Most bytes of the log that any one table may take up once the
+    /// cleaner is running; 0 means tables have no quota.
+    const uint64_t tableQuotaBytes;
+
+    /// REFRESH_SECONDS in Cycles::rdtsc() ticks.
+    const uint64_t refreshTicks;
+
+    /// Protects #bytesPerSecond, #activeTables and #buckets, and is held
+    /// while #lastRefresh and #utilization change. Those two are read
+    /// without it, so that writes don't need a lock until pacing begins.
+    SpinLock mutex;
+
+    /// Cycles::rdtsc() when #utilization and #bytesPerSecond were last set.
+    std::atomic<uint64_t> lastRefresh;
+
+    /// Memory utilization as of #lastRefresh.
+    std::atomic<int> utilization;
+
+    /// Total rate at which writes are admitted, in bytes per second, as of
+    /// #lastRefresh.
+    double bytesPerSecond;
+
+    /// Number of tables written within the last IDLE_SECONDS as of
+    /// #lastRefresh; #bytesPerSecond is split evenly among them. Never 0.
+    size_t activeTables;
+
+    /// Buckets of the tables written since pacing began, by table id.
+    std::unordered_map<uint64_t, Bucket> buckets;
+
+    DISALLOW_COPY_AND_ASSIGN(WriteAdmission);
+};
+
+} // namespace RAMCloud
+
+#endif // RAMCLOUD_WRITEADMISSION_H
@@ -0,0 +1,178 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+
+#include "ClientException.h"
+#include "Cycles.h"
+#include "Log.h"
+#include "LogHealthMonitor.h"
+#include "MasterTableMetadata.h"
+#include "ServerConfig.h"
+#include "TableStats.h"
+#include "WriteAdmission.h"
+
+namespace RAMCloud {
+
+class WriteAdmissionTestHandlers : public LogEntryHandlers {
+  public:
+    uint32_t getTimestamp(LogEntryType type, Buffer& buffer) { return 0; }
+    void relocate(LogEntryType type,
+                  Buffer& oldBuffer,
+                  Log::Reference oldReference,
+                  LogEntryRelocator& relocator) { }
+};
+
+class WriteAdmissionTest : public ::testing::Test {
+  public:
+    Context context;
+    ServerId serverId;
+    ServerList serverList;
+    ServerConfig serverConfig;
+    ReplicaManager replicaManager;
+    MasterTableMetadata masterTableMetadata;
+    SegletAllocator allocator;
+    SegmentManager segmentManager;
+    WriteAdmissionTestHandlers entryHandlers;
+    Log log;
+    LogHealthMonitor monitor;
+    WriteAdmission admission;
+
+    WriteAdmissionTest()
+        : context()
+        , serverId(ServerId(57, 0))
+        , serverList(&context)
+        , serverConfig(ServerConfig::forTesting())
+        , replicaManager(&context, &serverId, 0, false, false)
+        , masterTableMetadata()
+        , allocator(&serverConfig)
+        , segmentManager(&context, &serverConfig, &serverId,
+                         allocator, replicaManager, &masterTableMetadata)
+        , entryHandlers()
+        , log(&context, &serverConfig, &entryHandlers,
+              &segmentManager, &replicaManager)
+        , monitor(context.dispatch, &log)
+        , admission(&segmentManager, &monitor, &masterTableMetadata, 90, 0)
+    {
+        Cycles::mockCyclesPerSec = 1e09;
+        Cycles::mockTscValue = 1000000000;
+
+        // The cleaner freed 10 MB/s.
+        LogHealthMonitor::Sample sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.intervalNs = 1000000000;
+        sample.memoryBytesFreed = 10000000;
+        monitor.addSample(sample);
+    }
+
+    ~WriteAdmissionTest()
+    {
+        SegmentManager::mockMemoryUtilization = 0;
+        Cycles::mockCyclesPerSec = 0;
+        Cycles::mockTscValue = 0;
+    }
+
+    DISALLOW_COPY_AND_ASSIGN(WriteAdmissionTest);
+};
+
+TEST_F(WriteAdmissionTest, admit_belowThreshold) {
+    SegmentManager::mockMemoryUtilization = 89;
+    for (int i = 0; i < 10; i++)
+        admission.admit(1, 1000000);
+    EXPECT_EQ(89, admission.utilization);
+    EXPECT_EQ(0u, admission.buckets.size());
+}
+
+TEST_F(WriteAdmissionTest, admit_paced) {
+    TestLog::Enable _("refresh");
+    SegmentManager::mockMemoryUtilization = 90;
+
+    // The bucket starts with 10 ms worth of credit, and the write that
+    // empties it may overdraw it.
+    admission.admit(1, 150000);
+    EXPECT_EQ("refresh: Memory utilization 90%: pacing writes to the rate "
+              "of cleaning", TestLog::get());
+    EXPECT_EQ(1e07, admission.bytesPerSecond);
+    EXPECT_EQ(-50000, admission.buckets[1].credit);
+
+    uint32_t minDelayMicros = 0;
+    uint32_t maxDelayMicros = 0;
+    try {
+        admission.admit(1, 10);
+    } catch (RetryException& e) {
+        minDelayMicros = e.minDelayMicros;
+        maxDelayMicros = e.maxDelayMicros;
+    }
+    EXPECT_EQ(5001u, minDelayMicros);
+    EXPECT_EQ(10002u, maxDelayMicros);
+
+    // Other tables have buckets of their own.
+    admission.admit(2, 10);
+
+    Cycles::mockTscValue += 6000000;
+    admission.admit(1, 10);
+}
+
+TEST_F(WriteAdmissionTest, admit_tableQuota) {
+    WriteAdmission quotas(&segmentManager, &monitor, &masterTableMetadata,
+            0, 1000);
+    TableStats::increment(&masterTableMetadata, 1, 900, 1);
+
+    // Quotas don't apply until the cleaner is running.
+    SegmentManager::mockMemoryUtilization = 89;
+    quotas.admit(1, 1000);
+
+    Cycles::mockTscValue += 2000000;
+    SegmentManager::mockMemoryUtilization = 90;
+    quotas.admit(1, 100);
+    EXPECT_THROW(quotas.admit(1, 101), RetryException);
+    quotas.admit(2, 1000);
+
+    // Writes aren't paced without a start utilization.
+    EXPECT_EQ(0u, quotas.buckets.size());
+
+    // The table is admitted again once the cleaner has reclaimed some of
+    // its entries.
+    TableStats::decrement(&masterTableMetadata, 1, 100, 1);
+    quotas.admit(1, 101);
+}
+
+TEST_F(WriteAdmissionTest, refresh) {
+    TestLog::Enable _("refresh");
+    SegmentManager::mockMemoryUtilization = 95;
+    admission.buckets[1].lastRefill = Cycles::mockTscValue;
+    admission.buckets[2].lastRefill = Cycles::mockTscValue - 2000000000UL;
+    admission.refresh(Cycles::mockTscValue);
+    EXPECT_EQ(95, admission.utilization);
+    EXPECT_EQ(5e06, admission.bytesPerSecond);
+    EXPECT_EQ(1u, admission.buckets.size());
+    EXPECT_EQ(1u, admission.buckets.count(1));
+    EXPECT_EQ(1u, admission.activeTables);
+
+    // A full log still admits some writes.
+    SegmentManager::mockMemoryUtilization = 100;
+    admission.refresh(Cycles::mockTscValue);
+    EXPECT_EQ(1e06, admission.bytesPerSecond);
+
+    TestLog::reset();
+    SegmentManager::mockMemoryUtilization = 50;
+    admission.refresh(Cycles::mockTscValue);
+    EXPECT_EQ("refresh: Memory utilization 50%: no longer pacing writes",
+              TestLog::get());
+    EXPECT_EQ(0u, admission.buckets.size());
+    EXPECT_EQ(1u, admission.activeTables);
+}
+
+}  // namespace RAMCloud
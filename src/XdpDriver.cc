@@ -0,0 +1,571 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <errno.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fstream>
+
+#include <linux/if_xdp.h>
+#include <xdp/xsk.h>
+
+#include "Common.h"
+#include "Cycles.h"
+#include "NetUtil.h"
+#include "PerfStats.h"
+#include "ShortMacros.h"
+#include "XdpDriver.h"
+
+namespace RAMCloud {
+
+constexpr uint16_t XdpDriver::PRIORITY_TO_PCP[8];
+
+#if TESTING
+/*
+ * Construct a mock XdpDriver, used for testing only; it has no socket, so
+ * it can only send packets to itself.
+ */
+XdpDriver::XdpDriver()
+    : context(NULL)
+    , locatorString()
+    , localMac()
+    , umemArea(NULL)
+    , umem(NULL)
+    , socket(NULL)
+    , fillRing(NULL)
+    , completionRing(NULL)
+    , rxRing(NULL)
+    , txRing(NULL)
+    , socketFd(-1)
+    , senders()
+    , freeTxFrames()
+    , releasedRxFrames()
+    , loopbackPool()
+    , loopbackPackets()
+    , mutex("XdpDriver::mutex")
+    , batchDepth(0)
+    , kickNeeded(false)
+    , bandwidthMbps(10000)
+    , queueEstimator(0)
+    , maxTransmitQueueSize(0)
+{
+    localMac.construct("01:23:45:67:89:ab");
+    locatorString = format("xdp:mac=%s", localMac->toString().c_str());
+    queueEstimator.setBandwidth(bandwidthMbps);
+    maxTransmitQueueSize = 2*getMaxPacketSize();
+}
+#endif
+
+/**
+ * Construct an XdpDriver, binding an AF_XDP socket to one receive queue of
+ * a network interface.
+ *
+ * \param context
+ *      Overall information about the RAMCloud server or client.
+ * \param interface
+ *      Name of the network interface to use, such as "eth0".
+ * \param queue
+ *      Index of the interface's receive queue to bind to; RAMCloud frames
+ *      must be steered to this queue.
+ *
+ * \throw DriverException
+ *      The socket couldn't be set up (e.g., the kernel or NIC doesn't
+ *      support AF_XDP, or the process lacks CAP_NET_RAW/CAP_BPF).
+ */
+XdpDriver::XdpDriver(Context* context, const string& interface,
+        uint32_t queue)
+    : context(context)
+    , locatorString()
+    , localMac()
+    , umemArea(NULL)
+    , umem(NULL)
+    , socket(NULL)
+    , fillRing(new xsk_ring_prod())
+    , completionRing(new xsk_ring_cons())
+    , rxRing(new xsk_ring_cons())
+    , txRing(new xsk_ring_prod())
+    , socketFd(-1)
+    , senders(new Tub<MacAddress>[RX_FRAMES])
+    , freeTxFrames()
+    , releasedRxFrames()
+    , loopbackPool()
+    , loopbackPackets()
+    , mutex("XdpDriver::mutex")
+    , batchDepth(0)
+    , kickNeeded(false)
+    , bandwidthMbps(10000)                // Default bandwidth = 10 gbs
+    , queueEstimator(0)
+    , maxTransmitQueueSize(0)
+{
+    // Find the interface's MAC address and link speed.
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", interface.c_str());
+    if (fd < 0 || ioctl(fd, SIOCGIFHWADDR, &ifr) != 0) {
+        int e = errno;
+        if (fd >= 0)
+            close(fd);
+        throw DriverException(HERE, format(
+                "XdpDriver couldn't find the MAC address of %s",
+                interface.c_str()), e);
+    }
+    close(fd);
+    localMac.construct(reinterpret_cast<uint8_t*>(ifr.ifr_hwaddr.sa_data));
+    locatorString = format("xdp:mac=%s", localMac->toString().c_str());
+
+    std::ifstream speedFile("/sys/class/net/" + interface + "/speed");
+    int speed = 0;
+    if (speedFile >> speed && speed > 0) {
+        bandwidthMbps = speed;
+    } else {
+        LOG(WARNING, "Can't retrieve the link speed of %s; "
+                "using default of %u Mbps", interface.c_str(), bandwidthMbps);
+    }
+    queueEstimator.setBandwidth(bandwidthMbps);
+    maxTransmitQueueSize = (uint32_t) (static_cast<double>(bandwidthMbps)
+            * MAX_DRAIN_TIME / 8000.0);
+    uint32_t maxPacketSize = getMaxPacketSize();
+    if (maxTransmitQueueSize < 2*maxPacketSize) {
+        // Make sure that we advertise enough space in the transmit queue to
+        // prepare the next packet while the current one is transmitting.
+        maxTransmitQueueSize = 2*maxPacketSize;
+    }
+
+    // Set up the UMEM: receive frames first, then transmit frames.
+    size_t umemSize = size_t(RX_FRAMES + TX_FRAMES) * FRAME_SIZE;
+    void* area = mmap(NULL, umemSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (area == MAP_FAILED) {
+        throw DriverException(HERE, "XdpDriver couldn't allocate UMEM",
+                errno);
+    }
+    umemArea = static_cast<char*>(area);
+
+    struct xsk_umem_config umemConfig;
+    memset(&umemConfig, 0, sizeof(umemConfig));
+    umemConfig.fill_size = RX_FRAMES;
+    umemConfig.comp_size = RING_SIZE;
+    umemConfig.frame_size = FRAME_SIZE;
+    int r = xsk_umem__create(&umem, umemArea, umemSize, fillRing,
+            completionRing, &umemConfig);
+    if (r != 0) {
+        throw DriverException(HERE, "XdpDriver couldn't create UMEM", -r);
+    }
+
+    // Prefer zero-copy; fall back to copy mode for NIC drivers that
+    // don't support it.
+    struct xsk_socket_config socketConfig;
+    memset(&socketConfig, 0, sizeof(socketConfig));
+    socketConfig.rx_size = RING_SIZE;
+    socketConfig.tx_size = RING_SIZE;
+    socketConfig.bind_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+    r = xsk_socket__create(&socket, interface.c_str(), queue, umem, rxRing,
+            txRing, &socketConfig);
+    if (r != 0) {
+        LOG(WARNING, "Zero-copy AF_XDP isn't available on %s (%s); "
+                "using copy mode", interface.c_str(), strerror(-r));
+        socketConfig.bind_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        r = xsk_socket__create(&socket, interface.c_str(), queue, umem,
+                rxRing, txRing, &socketConfig);
+    }
+    if (r != 0) {
+        socket = NULL;
+        throw DriverException(HERE, format(
+                "XdpDriver couldn't bind to queue %u of %s",
+                queue, interface.c_str()), -r);
+    }
+    socketFd = xsk_socket__fd(socket);
+
+    // Hand all of the receive frames to the NIC.
+    for (uint64_t i = 0; i < RX_FRAMES; i++) {
+        releasedRxFrames.push_back(i * FRAME_SIZE);
+    }
+    refillRxFrames();
+    for (uint64_t i = RX_FRAMES; i < RX_FRAMES + TX_FRAMES; i++) {
+        freeTxFrames.push_back(i * FRAME_SIZE);
+    }
+
+    LOG(NOTICE, "XdpDriver locator: %s, interface %s, queue %u, "
+            "bandwidth: %u Mbits/sec, maxTransmitQueueSize: %u bytes",
+            locatorString.c_str(), interface.c_str(), queue, bandwidthMbps,
+            maxTransmitQueueSize);
+}
+
+/**
+ * Destroy the XdpDriver.
+ */
+XdpDriver::~XdpDriver()
+{
+    foreach (LoopbackBuf* buffer, loopbackPackets) {
+        loopbackPool.destroy(buffer);
+    }
+    if (socket != NULL)
+        xsk_socket__delete(socket);
+    if (umem != NULL)
+        xsk_umem__delete(umem);
+    if (umemArea != NULL)
+        munmap(umemArea, size_t(RX_FRAMES + TX_FRAMES) * FRAME_SIZE);
+    delete fillRing;
+    delete completionRing;
+    delete rxRing;
+    delete txRing;
+}
+
+// See docs in Driver class.
+void
+XdpDriver::flushBatch()
+{
+    assert(batchDepth > 0);
+    batchDepth--;
+    if (batchDepth == 0) {
+        kick();
+    }
+}
+
+// See docs in Driver class.
+uint32_t
+XdpDriver::getBandwidth()
+{
+    return bandwidthMbps;
+}
+
+// See docs in Driver class.
+int
+XdpDriver::getHighestPacketPriority()
+{
+    return 7;
+}
+
+// See docs in Driver class.
+uint32_t
+XdpDriver::getMaxPacketSize()
+{
+    return MAX_PAYLOAD_SIZE;
+}
+
+// See docs in Driver class.
+int
+XdpDriver::getTransmitQueueSpace(uint64_t currentTime)
+{
+    return maxTransmitQueueSize - queueEstimator.getQueueSize(currentTime);
+}
+
+// See docs in Driver class.
+void
+XdpDriver::receivePackets(uint32_t maxPackets,
+            std::vector<Received>* receivedPackets)
+{
+    uint32_t count = 0;
+    if (!loopbackPackets.empty()) {
+        SpinLock::Guard _(mutex);
+        size_t n = std::min(loopbackPackets.size(), size_t(maxPackets));
+        for (size_t i = 0; i < n; i++) {
+            LoopbackBuf* buffer = loopbackPackets[i];
+            receivedPackets->emplace_back(buffer->sender.get(), this,
+                    buffer->length, buffer->payload);
+        }
+        loopbackPackets.erase(loopbackPackets.begin(),
+                loopbackPackets.begin() + n);
+        count += downCast<uint32_t>(n);
+    }
+    if (socket == NULL) {
+        return;
+    }
+
+    refillRxFrames();
+    reclaimTxFrames();
+    uint32_t limit = std::min(maxPackets - count,
+            static_cast<uint32_t>(MAX_PACKETS_AT_ONCE));
+    uint32_t index;
+    uint32_t frames = (limit == 0) ? 0
+            : xsk_ring_cons__peek(rxRing, limit, &index);
+    if (frames == 0) {
+        if (xsk_ring_prod__needs_wakeup(fillRing)) {
+            recvfrom(socketFd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+        }
+        return;
+    }
+
+    uint64_t discarded[MAX_PACKETS_AT_ONCE];
+    uint32_t numDiscarded = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        const struct xdp_desc* desc = xsk_ring_cons__rx_desc(rxRing,
+                index + i);
+        uint64_t frameAddress = desc->addr - desc->addr % FRAME_SIZE;
+        char* frame = umemArea + desc->addr;
+        uint32_t length;
+        char* payload = parseFrame(frame, desc->len, &length);
+        if (payload == NULL) {
+            discarded[numDiscarded++] = frameAddress;
+            continue;
+        }
+        PerfStats::threadStats.networkInputBytes += desc->len;
+        Tub<MacAddress>* sender = &senders[frameAddress / FRAME_SIZE];
+        sender->construct(reinterpret_cast<struct ether_header*>(frame)
+                ->ether_shost);
+        receivedPackets->emplace_back(sender->get(), this, length, payload);
+    }
+    xsk_ring_cons__release(rxRing, frames);
+    if (numDiscarded > 0) {
+        SpinLock::Guard _(mutex);
+        releasedRxFrames.insert(releasedRxFrames.end(), discarded,
+                discarded + numDiscarded);
+    }
+}
+
+// See docs in Driver class.
+void
+XdpDriver::release(char *payload)
+{
+    // Must sync with the dispatch thread, since this method could
+    // potentially be invoked in a worker.
+    SpinLock::Guard _(mutex);
+    if (umemArea != NULL && payload >= umemArea &&
+            payload < umemArea + size_t(RX_FRAMES) * FRAME_SIZE) {
+        uint64_t offset = payload - umemArea;
+        releasedRxFrames.push_back(offset - offset % FRAME_SIZE);
+        return;
+    }
+
+    // Note: the payload is actually contained in a LoopbackBuf structure,
+    // which we return to a pool for reuse later.
+    loopbackPool.destroy(reinterpret_cast<LoopbackBuf*>(
+            payload - OFFSET_OF(LoopbackBuf, payload)));
+}
+
+// See docs in Driver class.
+void
+XdpDriver::sendPacket(const Address* addr,
+                      const void* header,
+                      uint32_t headerLen,
+                      Buffer::Iterator* payload,
+                      int priority)
+{
+    assert(priority >= 0 && priority <= getHighestPacketPriority());
+    uint32_t etherPayloadLength = headerLen + (payload ? payload->size() : 0);
+    assert(etherPayloadLength <= MAX_PAYLOAD_SIZE);
+    const MacAddress* destination = static_cast<const MacAddress*>(addr);
+
+    if (memcmp(destination->address, localMac->address, 6) == 0) {
+        // The NIC won't deliver a frame to its sender.
+        SpinLock::Guard _(mutex);
+        LoopbackBuf* buffer = loopbackPool.construct();
+        char* p = buffer->payload;
+        memcpy(p, header, headerLen);
+        p += headerLen;
+        while (payload && !payload->isDone()) {
+            memcpy(p, payload->getData(), payload->getLength());
+            p += payload->getLength();
+            payload->next();
+        }
+        buffer->length = etherPayloadLength;
+        buffer->sender.construct(*localMac);
+        loopbackPackets.push_back(buffer);
+        return;
+    }
+    if (socket == NULL) {
+        return;
+    }
+
+    if (freeTxFrames.empty()) {
+        reclaimTxFrames();
+    }
+    uint32_t index;
+    if (freeTxFrames.empty() ||
+            xsk_ring_prod__reserve(txRing, 1, &index) != 1) {
+        RAMCLOUD_CLOG(NOTICE, "XdpDriver transmit ring is full; "
+                "dropping packet");
+        queueEstimator.setQueueSize(maxTransmitQueueSize, Cycles::rdtsc());
+        return;
+    }
+    uint64_t frameAddress = freeTxFrames.back();
+    freeTxFrames.pop_back();
+    uint32_t frameLength = fillFrame(umemArea + frameAddress, destination,
+            header, headerLen, payload, priority);
+    struct xdp_desc* desc = xsk_ring_prod__tx_desc(txRing, index);
+    desc->addr = frameAddress;
+    desc->len = frameLength;
+    xsk_ring_prod__submit(txRing, 1);
+    kickNeeded = true;
+    if (batchDepth == 0) {
+        kick();
+    }
+    queueEstimator.packetQueued(frameLength, Cycles::rdtsc());
+    PerfStats::threadStats.networkOutputBytes += frameLength;
+}
+
+// See docs in Driver class.
+string
+XdpDriver::getServiceLocator()
+{
+    return locatorString;
+}
+
+// See docs in Driver class.
+void
+XdpDriver::startBatch()
+{
+    batchDepth++;
+}
+
+/**
+ * Build an Ethernet frame (in DpdkDriver's format) for a packet.
+ *
+ * \param frame
+ *      Where to build the frame; must have room for ETHER_VLAN_HDR_LEN +
+ *      MAX_PAYLOAD_SIZE bytes.
+ * \param destination
+ *      Where the packet is going.
+ * \param header
+ *      Bytes placed in the frame ahead of those from payload.
+ * \param headerLen
+ *      Length in bytes of the data in header.
+ * \param payload
+ *      The rest of the packet; may be NULL.
+ * \param priority
+ *      Priority level of the packet (0 is the lowest).
+ * \return
+ *      The length of the frame, in bytes.
+ */
+uint32_t
+XdpDriver::fillFrame(char* frame, const MacAddress* destination,
+        const void* header, uint32_t headerLen, Buffer::Iterator* payload,
+        int priority)
+{
+    // Fill out the destination and source MAC addresses plus the Ethernet
+    // frame type (i.e., IEEE 802.1Q VLAN tagging).
+    char* p = frame;
+    struct ether_header* ethHdr = reinterpret_cast<struct ether_header*>(p);
+    memcpy(ethHdr->ether_dhost, destination->address, ETH_ALEN);
+    memcpy(ethHdr->ether_shost, localMac->address, ETH_ALEN);
+    ethHdr->ether_type = htons(ETHERTYPE_VLAN);
+    p += ETHER_HDR_LEN;
+
+    // Fill out the PCP field and the Ethernet frame type of the encapsulated
+    // frame (DEI and VLAN ID are not relevant and trivially set to 0).
+    uint16_t vlanTag[2] = {htons(PRIORITY_TO_PCP[priority]),
+                           htons(NetUtil::EthPayloadType::RAMCLOUD)};
+    memcpy(p, vlanTag, VLAN_TAG_LEN);
+    p += VLAN_TAG_LEN;
+
+    memcpy(p, header, headerLen);
+    p += headerLen;
+    while (payload && !payload->isDone()) {
+        memcpy(p, payload->getData(), payload->getLength());
+        p += payload->getLength();
+        payload->next();
+    }
+    return downCast<uint32_t>(p - frame);
+}
+
+/**
+ * Find the RAMCloud packet in a received Ethernet frame.
+ *
+ * \param frame
+ *      The frame.
+ * \param length
+ *      Length of the frame, in bytes.
+ * \param[out] payloadLength
+ *      Set to the length of the packet.
+ * \return
+ *      The start of the packet, or NULL if this isn't a RAMCloud frame.
+ */
+char*
+XdpDriver::parseFrame(char* frame, uint32_t length, uint32_t* payloadLength)
+{
+    uint32_t headerLength = ETHER_HDR_LEN;
+    if (length < headerLength) {
+        return NULL;
+    }
+    uint16_t etherType;
+    memcpy(&etherType, frame + 2*ETH_ALEN, sizeof(etherType));
+    if (etherType == htons(ETHERTYPE_VLAN)) {
+        headerLength += VLAN_TAG_LEN;
+        if (length < headerLength) {
+            return NULL;
+        }
+        memcpy(&etherType, frame + headerLength - sizeof(etherType),
+                sizeof(etherType));
+    }
+    if (etherType != htons(NetUtil::EthPayloadType::RAMCLOUD) ||
+            length - headerLength > MAX_PAYLOAD_SIZE) {
+        return NULL;
+    }
+    *payloadLength = length - headerLength;
+    return frame + headerLength;
+}
+
+/**
+ * Tell the kernel about frames added to the transmit ring, if it needs
+ * to be told.
+ */
+void
+XdpDriver::kick()
+{
+    if (!kickNeeded) {
+        return;
+    }
+    kickNeeded = false;
+    if (xsk_ring_prod__needs_wakeup(txRing)) {
+        // EAGAIN, EBUSY and ENOBUFS just mean the kernel is still busy
+        // with earlier frames; it will pick these up as well.
+        sendto(socketFd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+    }
+}
+
+/**
+ * Move frames that the NIC has finished transmitting back to
+ * #freeTxFrames.
+ */
+void
+XdpDriver::reclaimTxFrames()
+{
+    uint32_t index;
+    uint32_t frames = xsk_ring_cons__peek(completionRing, RING_SIZE, &index);
+    for (uint32_t i = 0; i < frames; i++) {
+        freeTxFrames.push_back(*xsk_ring_cons__comp_addr(completionRing,
+                index + i));
+    }
+    xsk_ring_cons__release(completionRing, frames);
+}
+
+/**
+ * Give released receive frames back to the NIC, through the fill ring.
+ */
+void
+XdpDriver::refillRxFrames()
+{
+    SpinLock::Guard _(mutex);
+    if (releasedRxFrames.empty()) {
+        return;
+    }
+    uint32_t index;
+    uint32_t frames = xsk_ring_prod__reserve(fillRing,
+            downCast<uint32_t>(releasedRxFrames.size()), &index);
+    for (uint32_t i = 0; i < frames; i++) {
+        *xsk_ring_prod__fill_addr(fillRing, index + i) = releasedRxFrames[i];
+    }
+    xsk_ring_prod__submit(fillRing, frames);
+    releasedRxFrames.erase(releasedRxFrames.begin(),
+            releasedRxFrames.begin() + frames);
+}
+
+} // namespace RAMCloud
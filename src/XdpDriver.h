@@ -0,0 +1,214 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RAMCLOUD_XDPDRIVER_H
+#define RAMCLOUD_XDPDRIVER_H
+
+#include <memory>
+#include <vector>
+
+#include "Driver.h"
+#include "MacAddress.h"
+#include "ObjectPool.h"
+#include "QueueEstimator.h"
+#include "ServiceLocator.h"
+#include "SpinLock.h"
+#include "Tub.h"
+
+// Forward declarations, so we don't have to include libxdp headers here.
+struct xsk_ring_cons;
+struct xsk_ring_prod;
+struct xsk_socket;
+struct xsk_umem;
+
+namespace RAMCloud {
+
+/**
+ * A Driver that sends and receives raw Ethernet frames through an AF_XDP
+ * socket, bypassing the kernel network stack while still using the
+ * kernel's own NIC driver (so, unlike DpdkDriver, the NIC stays usable by
+ * the rest of the system). Frames have the same format as DpdkDriver's, so
+ * the two can talk to each other.
+ *
+ * The socket is bound to one receive queue of one interface; the operator
+ * should steer RAMCloud frames (ethertype 0x88b5) to that queue, e.g. with
+ * "ethtool -N", since libxdp's default XDP program hands everything that
+ * arrives on the queue to this driver, which discards non-RAMCloud frames.
+ *
+ * Received frames are handed to the transport in place: the payload of a
+ * Received points into the UMEM frame, which goes back to the NIC's fill
+ * ring once it is released. Outgoing packets are built directly in UMEM
+ * frames. The NIC is only kicked once per batch (see startBatch). If the
+ * NIC's driver doesn't support zero-copy AF_XDP, the kernel copies frames
+ * instead and the driver logs a warning.
+ */
+class XdpDriver : public Driver {
+  PUBLIC:
+#if TESTING
+    XdpDriver();
+#endif
+    XdpDriver(Context* context, const string& interface, uint32_t queue = 0);
+    virtual ~XdpDriver();
+    virtual void flushBatch();
+    virtual uint32_t getBandwidth();
+    virtual int getHighestPacketPriority();
+    virtual uint32_t getMaxPacketSize();
+    virtual int getTransmitQueueSpace(uint64_t currentTime);
+    virtual void receivePackets(uint32_t maxPackets,
+            std::vector<Received>* receivedPackets);
+    virtual void release(char *payload);
+    virtual void sendPacket(const Address* addr,
+                            const void* header,
+                            uint32_t headerLen,
+                            Buffer::Iterator* payload,
+                            int priority = 0);
+    virtual string getServiceLocator();
+    virtual void startBatch();
+
+    virtual Address* newAddress(const ServiceLocator* serviceLocator)
+    {
+        return new MacAddress(serviceLocator->getOption<const char*>("mac"));
+    }
+
+  PRIVATE:
+    /// The MTU (Maximum Transmission Unit) of the Ethernet.
+    static const uint32_t MAX_PAYLOAD_SIZE = 1500;
+
+    /// Size of VLAN tag, in bytes. The PCP (Priority Code Point) field of
+    /// the tag carries the packet priority.
+    static const uint32_t VLAN_TAG_LEN = 4;
+
+    /// Size of Ethernet header including VLAN tag, in bytes.
+    static const uint32_t ETHER_VLAN_HDR_LEN = 14 + VLAN_TAG_LEN;
+
+    /// Map from priority levels to values of the PCP field (see
+    /// DpdkDriver::PRIORITY_TO_PCP).
+    static constexpr uint16_t PRIORITY_TO_PCP[8] =
+            {1 << 13, 0 << 13, 2 << 13, 3 << 13, 4 << 13, 5 << 13, 6 << 13,
+             7 << 13};
+
+    enum {
+        /// Size of each UMEM frame, in bytes.
+        FRAME_SIZE = 4096,
+
+        /// Number of UMEM frames used for receiving; all of them start out
+        /// in the fill ring.
+        RX_FRAMES = 4096,
+
+        /// Number of UMEM frames used for transmitting; they follow the
+        /// receive frames.
+        TX_FRAMES = 2048,
+
+        /// Number of descriptors in each of the socket's rings.
+        RING_SIZE = 2048,
+
+        /// Maximum number of frames taken from the receive ring at once.
+        MAX_PACKETS_AT_ONCE = 32,
+    };
+
+    typedef Driver::PacketBuf<MacAddress, MAX_PAYLOAD_SIZE> PacketBuf;
+
+    /// A copied packet that was sent to this driver's own MAC address
+    /// (the NIC doesn't loop those back).
+    struct LoopbackBuf : public PacketBuf {
+        LoopbackBuf()
+            : PacketBuf()
+            , length(0)
+        {}
+
+        /// Number of bytes of #payload that hold the packet.
+        uint32_t length;
+    };
+
+    uint32_t fillFrame(char* frame, const MacAddress* destination,
+            const void* header, uint32_t headerLen,
+            Buffer::Iterator* payload, int priority);
+    char* parseFrame(char* frame, uint32_t length, uint32_t* payloadLength);
+    void kick();
+    void reclaimTxFrames();
+    void refillRxFrames();
+
+    /// Shared RAMCloud information.
+    Context* context;
+
+    /// See getServiceLocator().
+    string locatorString;
+
+    /// MAC address of the interface.
+    Tub<MacAddress> localMac;
+
+    /// The memory shared with the NIC (RX_FRAMES + TX_FRAMES frames); NULL
+    /// if the socket hasn't been set up (e.g., in unit tests).
+    char* umemArea;
+
+    /// libxdp handles for the UMEM and the socket.
+    struct xsk_umem* umem;
+    struct xsk_socket* socket;
+
+    /// The socket's rings: frames for the NIC to receive into, frames the
+    /// NIC has finished transmitting, received frames and frames to
+    /// transmit.
+    struct xsk_ring_prod* fillRing;
+    struct xsk_ring_cons* completionRing;
+    struct xsk_ring_cons* rxRing;
+    struct xsk_ring_prod* txRing;
+
+    /// File descriptor of #socket, used to wake up the kernel.
+    int socketFd;
+
+    /// For each receive frame that has been handed to a transport, the
+    /// address of its sender; indexed by frame number.
+    std::unique_ptr<Tub<MacAddress>[]> senders;
+
+    /// UMEM addresses of transmit frames that aren't in use. Only used by
+    /// the dispatch thread.
+    std::vector<uint64_t> freeTxFrames;
+
+    /// UMEM addresses of receive frames that transports have released but
+    /// that haven't been put back in the fill ring yet. Protected by
+    /// #mutex, since release may be invoked by worker threads.
+    std::vector<uint64_t> releasedRxFrames;
+
+    /// Holds buffers for packets sent to ourself, and the packets waiting
+    /// to be returned by receivePackets. Protected by #mutex.
+    ObjectPool<LoopbackBuf> loopbackPool;
+    std::vector<LoopbackBuf*> loopbackPackets;
+
+    /// Serializes access to #releasedRxFrames and the loopback state.
+    SpinLock mutex;
+
+    /// Number of calls to startBatch without a matching flushBatch.
+    int batchDepth;
+
+    /// True means frames have been put in the transmit ring since the
+    /// kernel was last told about them.
+    bool kickNeeded;
+
+    /// Effective network bandwidth, in Mbits/second.
+    uint32_t bandwidthMbps;
+
+    /// Used to estimate # bytes outstanding in the NIC's transmit queue.
+    QueueEstimator queueEstimator;
+
+    /// Upper limit on how many bytes should be queued for transmission
+    /// at any given time.
+    uint32_t maxTransmitQueueSize;
+
+    DISALLOW_COPY_AND_ASSIGN(XdpDriver);
+};
+
+} // end RAMCloud
+
+#endif  // RAMCLOUD_XDPDRIVER_H
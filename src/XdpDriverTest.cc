@@ -0,0 +1,116 @@
+/* Copyright (c) 2026 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "TestUtil.h"
+#include "XdpDriver.h"
+
+namespace RAMCloud {
+
+class XdpDriverTest : public ::testing::Test {
+  public:
+    Context context;
+
+    XdpDriver driver;
+
+    TestLog::Enable logEnabler;
+
+    XdpDriverTest()
+        : context()
+        , driver()
+        , logEnabler()
+    {
+        driver.context = &context;
+    }
+
+    ~XdpDriverTest() {}
+
+  private:
+    DISALLOW_COPY_AND_ASSIGN(XdpDriverTest);
+};
+
+// Currently the AF_XDP rings cannot be effectively tested with unit tests.
+
+TEST_F(XdpDriverTest, fillFrame) {
+    MacAddress address("ff:ff:ff:ff:ff:ff");
+    string header = "ABCDEFGH";
+    string payload = "abcdefgh";
+    Buffer buffer;
+    buffer.append(payload.c_str(), downCast<uint32_t>(payload.length()));
+    Buffer::Iterator iterator(&buffer);
+
+    char frame[100];
+    uint32_t length = driver.fillFrame(frame, &address, header.c_str(),
+            downCast<uint32_t>(header.length()), &iterator, 3);
+    EXPECT_EQ(XdpDriver::ETHER_VLAN_HDR_LEN + 16, length);
+    string hexHeader;
+    for (uint32_t i = 0; i < XdpDriver::ETHER_VLAN_HDR_LEN; i++) {
+        hexHeader += format("%02x", static_cast<uint8_t>(frame[i]));
+    }
+    EXPECT_EQ("ffffffffffff" "0123456789ab" "8100" "6000" "88b5", hexHeader);
+    EXPECT_EQ("ABCDEFGHabcdefgh",
+            string(frame + XdpDriver::ETHER_VLAN_HDR_LEN, 16));
+}
+
+TEST_F(XdpDriverTest, parseFrame) {
+    MacAddress address("ff:ff:ff:ff:ff:ff");
+    char frame[100];
+    uint32_t length = driver.fillFrame(frame, &address, "hello", 5, NULL, 0);
+    uint32_t payloadLength = 0;
+    char* payload = driver.parseFrame(frame, length, &payloadLength);
+    EXPECT_EQ(frame + XdpDriver::ETHER_VLAN_HDR_LEN, payload);
+    EXPECT_EQ(5u, payloadLength);
+
+    // Untagged frame.
+    memcpy(frame + 12, frame + 16, 2);
+    memmove(frame + 14, frame + 18, 5);
+    payload = driver.parseFrame(frame, length - 4, &payloadLength);
+    EXPECT_EQ("hello", string(payload, payloadLength));
+
+    // Not a RAMCloud frame.
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    EXPECT_TRUE(driver.parseFrame(frame, length - 4, &payloadLength) == NULL);
+
+    // Runt.
+    EXPECT_TRUE(driver.parseFrame(frame, 10, &payloadLength) == NULL);
+}
+
+TEST_F(XdpDriverTest, sendPacket_loopback) {
+    MacAddress address("01:23:45:67:89:ab");
+    Buffer buffer;
+    buffer.append("payload", 7);
+    Buffer::Iterator iterator(&buffer);
+    driver.sendPacket(&address, "header:", 7, &iterator);
+
+    std::vector<Driver::Received> received;
+    driver.receivePackets(10, &received);
+    ASSERT_EQ(1u, received.size());
+    EXPECT_EQ("header:payload", string(received[0].payload, received[0].len));
+    EXPECT_EQ("01:23:45:67:89:ab", received[0].sender->toString());
+    EXPECT_EQ(1lu, driver.loopbackPool.outstandingObjects);
+    received.clear();
+    EXPECT_EQ(0lu, driver.loopbackPool.outstandingObjects);
+}
+
+TEST_F(XdpDriverTest, sendPacket_noSocket) {
+    MacAddress address("ff:ff:ff:ff:ff:ff");
+    driver.sendPacket(&address, "header:", 7, NULL);
+    std::vector<Driver::Received> received;
+    driver.receivePackets(10, &received);
+    EXPECT_EQ(0u, received.size());
+    EXPECT_EQ(0lu, (uint64_t) driver.queueEstimator.queueSize);
+}
+
+}  // namespace RAMCloud
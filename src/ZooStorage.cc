@@ -315,6 +315,68 @@ ZooStorage::set(Hint flavor, const char* name, const char* value,
     setInternal(lock, flavor, getFullName(name), value, valueLength);
 }
 
+// See documentation for ExternalStorage::setMultiple.
+void
+ZooStorage::setMultiple(const vector<Write>& writes)
+{
+    Lock lock(mutex);
+    if (lostLeadership) {
+        throw LostLeadershipException(HERE);
+    }
+    if (writes.size() == 1) {
+        const Write& write = writes[0];
+        setInternal(lock, write.flavor, getFullName(write.name.c_str()),
+                write.value.data(), downCast<int>(write.value.size()));
+        return;
+    }
+    if (writes.empty()) {
+        return;
+    }
+
+    // Try to do all of the writes in a single multi-op. The names must
+    // stay valid until it returns, and getFullName reuses one buffer.
+    vector<string> absNames;
+    absNames.reserve(writes.size());
+    foreach (const Write& write, writes) {
+        absNames.push_back(getFullName(write.name.c_str()));
+    }
+    vector<zoo_op_t> ops(writes.size());
+    vector<zoo_op_result_t> results(writes.size());
+    for (size_t i = 0; i < writes.size(); i++) {
+        const Write& write = writes[i];
+        if (write.flavor == Hint::CREATE) {
+            zoo_create_op_init(&ops[i], absNames[i].c_str(),
+                    write.value.data(), downCast<int>(write.value.size()),
+                    &ZOO_OPEN_ACL_UNSAFE, 0, NULL, 0);
+        } else {
+            zoo_set_op_init(&ops[i], absNames[i].c_str(),
+                    write.value.data(), downCast<int>(write.value.size()),
+                    -1, NULL);
+        }
+    }
+    int status = zoo_multi(zoo, downCast<int>(ops.size()), &ops[0],
+            &results[0]);
+    if (testStatus1 != 0) {
+        status = testStatus1;
+        testStatus1 = 0;
+    }
+    if (status == ZOK) {
+        return;
+    }
+
+    // Nothing was written (multi-ops are atomic). Typically a hint was
+    // incorrect or a parent node doesn't exist; setInternal knows how to
+    // deal with those (and with other errors), so fall back to writing the
+    // objects one at a time.
+    RAMCLOUD_LOG(DEBUG, "Couldn't write %lu objects at once (%s); "
+            "writing them one at a time", writes.size(), zerror(status));
+    for (size_t i = 0; i < writes.size(); i++) {
+        const Write& write = writes[i];
+        setInternal(lock, write.flavor, absNames[i].c_str(),
+                write.value.data(), downCast<int>(write.value.size()));
+    }
+}
+
 /**
  * This method does most of the work of the "set" method. It is separated
  * so that it can be invoked by both "set" and "createParent" (createParent